@@ -0,0 +1,268 @@
+<?php
+declare(strict_types=1);
+
+/*
+ * ClusterScalingTest.php
+ * ─────────────────────────────────────────────────────────────────────────
+ *  PURPOSE
+ *  -------
+ *  • Finds where Quicpro\Cluster stops scaling linearly.  For every
+ *    combination of
+ *      – workload   `h3`  (thin HTTP/3 calls: a raw-body route echoing 64
+ *                         bytes) and `mcp` (MCP calls with IIBIN input and
+ *                         output schemas),
+ *      – affinity   `none`, `pinned` (enable_cpu_affinity) and `numa`
+ *                   (numa_aware_placement),
+ *      – steering   `cid` (connection-ID eBPF steering) and `hash` (the
+ *                   kernel's 4-tuple hash alone), see 'reuseport_steering',
+ *    it starts a cluster on this host at each worker count of CS_WORKERS
+ *    and saturates it from CS_CLIENTS load processes
+ *    (quicpro_loadgen_run(), merged with quicpro_loadgen_merge()).
+ *
+ *  • Per point: requests per second, p50/p99 latency, errors and, where
+ *    `perf` is installed and allowed (kernel.perf_event_paranoid), the
+ *    workers' cache misses per request.  CS_PERF_EVENTS replaces the
+ *    default events, e.g. with a HITM event of the CPU for cross-core
+ *    misses proper (mem_load_l3_hit_retired.xsnp_hitm on Intel).
+ *
+ *  • Output is one JSON object per line on STDOUT, tagged with the
+ *    extension's version: a `point` row per run and, per configuration, a
+ *    `curve` row with the scaling efficiency of every worker count
+ *    (rps ÷ (workers × rps of one worker)) and the `knee`, the first count
+ *    below CS_KNEE efficiency.
+ *
+ *  • The load processes compete with the workers for cores.  CS_CLIENT_CPUS
+ *    (a taskset list) keeps them off the workers' cores, which start at 0.
+ * ─────────────────────────────────────────────────────────────────────────
+ */
+
+$nproc      = (int) (trim((string) @shell_exec('nproc')) ?: 1);
+$defaultW   = [];
+for ($w = 1; $w < $nproc; $w *= 2) {
+    $defaultW[] = $w;
+}
+$defaultW[] = $nproc;
+
+$port       = (int) (getenv('CS_PORT') ?: 4433);
+$workers    = array_map('intval', explode(',', getenv('CS_WORKERS') ?: implode(',', $defaultW)));
+$workloads  = explode(',', getenv('CS_WORKLOADS') ?: 'h3,mcp');
+$affinities = explode(',', getenv('CS_AFFINITY') ?: 'none,pinned,numa');
+$steerings  = explode(',', getenv('CS_STEERING') ?: 'cid,hash');
+$clients    = max(1, (int) (getenv('CS_CLIENTS') ?: 4));
+$clientCpus = getenv('CS_CLIENT_CPUS') ?: '';
+$seconds    = max(1, (int) (getenv('CS_SECONDS') ?: 15));
+$inFlight   = max(1, (int) (getenv('CS_IN_FLIGHT') ?: 256));
+$knee       = (float) (getenv('CS_KNEE') ?: 0.8);
+$perfEvents = getenv('CS_PERF_EVENTS') ?: 'cache-misses,LLC-load-misses';
+$certs      = getenv('CS_CERT_DIR') ?: dirname(__DIR__) . '/var/traefik/certificates';
+
+/*──────────────────────────── Schemas ────────────────────────────────────*/
+
+function define_schemas(): void
+{
+    Quicpro\IIBIN::defineSchema('ScaleQuoteRequest', [
+        'symbol'   => ['tag' => 1, 'type' => 'string'],
+        'quantity' => ['tag' => 2, 'type' => 'uint32'],
+        'limit'    => ['tag' => 3, 'type' => 'double'],
+    ]);
+    Quicpro\IIBIN::defineSchema('ScaleQuoteReply', [
+        'symbol' => ['tag' => 1, 'type' => 'string'],
+        'price'  => ['tag' => 2, 'type' => 'double'],
+        'filled' => ['tag' => 3, 'type' => 'uint32'],
+    ]);
+}
+
+/*──────────────────────────── Server side ────────────────────────────────*/
+
+function serve(array $a): void
+{
+    Quicpro\Cluster::orchestrate([
+        'num_workers'         => $a['workers'],
+        'enable_cpu_affinity' => $a['affinity'] === 'pinned',
+        'numa_aware_placement'=> $a['affinity'] === 'numa',
+        'reuseport_steering'  => $a['steering'],
+        'metrics_port'        => 0,
+        'preload_callable'    => 'define_schemas',
+        'worker_main_callable' => static function (int $id) use ($a): void {
+            $config = Quicpro\Config::new(['cert_file' => $a['cert'], 'key_file' => $a['key']]);
+            $reply = str_repeat('x', 64);
+            quicpro_mcp_server_register('bench', 'echo', static fn (string $body): string => $reply);
+            quicpro_mcp_server_register('bench', 'quote', static fn (array $q): array => [
+                'symbol' => $q['symbol'], 'price' => $q['limit'] * 0.999, 'filled' => $q['quantity'],
+            ], ['input' => 'ScaleQuoteRequest', 'output' => 'ScaleQuoteReply']);
+            quicpro_http3_server_listen('::', $a['port'], $config, static function ($session, int $stream, bool $early): void {
+                quicpro_mcp_server_serve($session);
+            });
+        },
+    ]);
+}
+
+/*──────────────────────────── Load side ──────────────────────────────────*/
+
+function load(array $a): array
+{
+    define_schemas();
+    $call = $a['workload'] === 'mcp'
+        ? ['method' => 'quote', 'body' => Quicpro\IIBIN::encode('ScaleQuoteRequest',
+              ['symbol' => 'QPRO', 'quantity' => 100, 'limit' => 42.5])]
+        : ['method' => 'echo', 'body' => str_repeat('y', 64)];
+    return quicpro_loadgen_run([
+        'rate'          => 1_000_000,          // far above capacity: max_in_flight paces it
+        'duration_ms'   => $a['seconds'] * 1000,
+        'max_in_flight' => $a['in_flight'],
+        'connections'   => 8,                  // several 4-tuples, so hash steering spreads them
+        'mix'           => [['protocol' => 'mcp', 'host' => '127.0.0.1', 'port' => $a['port'],
+                             'service' => 'bench'] + $call],
+    ]);
+}
+
+if (in_array($argv[1] ?? '', ['server', 'load'], true)) {
+    $a = json_decode($argv[2], true);
+    if ($argv[1] === 'server') {
+        serve($a);
+        exit(0);
+    }
+    echo json_encode(load($a)), "\n";
+    exit(0);
+}
+
+/*──────────────────────────── Coordinator ────────────────────────────────*/
+
+/** @return array{0: resource, 1: array} */
+function spawn(array $cmd): array
+{
+    $proc = proc_open($cmd, [0 => ['pipe', 'r'], 1 => ['pipe', 'w'], 2 => STDERR], $pipes);
+    if (!is_resource($proc)) {
+        throw new RuntimeException('cannot start ' . implode(' ', $cmd));
+    }
+    return [$proc, $pipes];
+}
+
+/** @return int[] The cluster master's worker processes. */
+function worker_pids(int $master): array
+{
+    $children = @file_get_contents("/proc/{$master}/task/{$master}/children");
+    return $children ? array_map('intval', preg_split('/\s+/', trim($children))) : [];
+}
+
+/*  Starts `perf stat` on the workers; null without perf or permission. */
+function perf_start(array $pids, string $events, string $out): ?array
+{
+    if (!$pids || trim((string) @shell_exec('command -v perf')) === '') {
+        return null;
+    }
+    return spawn(['perf', 'stat', '-x', ',', '-o', $out, '-e', $events, '-p', implode(',', $pids)]);
+}
+
+/** @return array<string, int> Event => count. */
+function perf_stop(?array $perf, string $out): array
+{
+    if ($perf === null) {
+        return [];
+    }
+    proc_terminate($perf[0], SIGINT);
+    proc_close($perf[0]);
+    $counts = [];
+    foreach (@file($out, FILE_IGNORE_NEW_LINES) ?: [] as $line) {
+        $f = str_getcsv($line);
+        if (count($f) > 2 && is_numeric($f[0])) {
+            $counts[$f[2]] = (int) $f[0];
+        }
+    }
+    @unlink($out);
+    return $counts;
+}
+
+/*  One cluster, saturated for CS_SECONDS. */
+function point(string $workload, string $affinity, string $steering, int $w, array $opt): array
+{
+    $server = spawn([PHP_BINARY, __FILE__, 'server', json_encode([
+        'workers' => $w, 'affinity' => $affinity, 'steering' => $steering, 'port' => $opt['port'],
+        'cert' => "{$opt['certs']}/local-cert.pem", 'key' => "{$opt['certs']}/local-key.pem",
+    ])]);
+    $master = proc_get_status($server[0])['pid'];
+    sleep(2);                                   // workers forked and bound
+
+    $perfOut = tempnam(sys_get_temp_dir(), 'qp-perf');
+    $perf = perf_start(worker_pids($master), $opt['perf_events'], $perfOut);
+    $loads = [];
+    for ($i = 0; $i < $opt['clients']; $i++) {
+        $cmd = [PHP_BINARY, '-d', 'quicpro.tls_verify_peer=0', __FILE__, 'load', json_encode([
+            'workload' => $workload, 'port' => $opt['port'], 'seconds' => $opt['seconds'], 'in_flight' => $opt['in_flight'],
+        ])];
+        $loads[] = spawn($opt['client_cpus'] !== '' ? ['taskset', '-c', $opt['client_cpus'], ...$cmd] : $cmd);
+    }
+    $results = [];
+    foreach ($loads as [$proc, $pipes]) {
+        fclose($pipes[0]);
+        $r = json_decode(trim((string) stream_get_contents($pipes[1])), true);
+        fclose($pipes[1]);
+        proc_close($proc);
+        if (is_array($r)) {
+            $results[] = $r;
+        }
+    }
+    $counts = perf_stop($perf, $perfOut);
+
+    proc_terminate($server[0], SIGTERM);      // the master drains its workers
+    fclose($server[1][0]);
+    fclose($server[1][1]);
+    proc_close($server[0]);
+
+    $r = $results ? quicpro_loadgen_merge($results) : null;
+    $rps = $r && $r['elapsed_ms'] > 0 ? ($r['completed'] - $r['errors']) / ($r['elapsed_ms'] / 1000) : 0.0;
+    $row = [
+        'workers'  => $w,
+        'rps'      => round($rps),
+        'p50_us'   => $r['latency_us']['p50'] ?? null,
+        'p99_us'   => $r['latency_us']['p99'] ?? null,
+        'errors'   => $r['errors'] ?? null,
+        'timeouts' => $r['timeouts'] ?? null,
+    ];
+    $completed = max(1, $r['completed'] ?? 0);
+    foreach ($counts as $event => $n) {
+        $row['perf'][$event . '_per_req'] = round($n / $completed, 2);
+    }
+    return $row;
+}
+
+function emit(array $row): void
+{
+    echo json_encode(['bench' => 'cluster_scaling', 'version' => quicpro_version(), 'ts' => time()] + $row), "\n";
+}
+
+$opt = [
+    'port' => $port, 'certs' => $certs, 'clients' => $clients, 'client_cpus' => $clientCpus,
+    'seconds' => $seconds, 'in_flight' => $inFlight, 'perf_events' => $perfEvents,
+];
+foreach ($workloads as $workload) {
+    foreach ($affinities as $affinity) {
+        foreach ($steerings as $steering) {
+            $config = ['workload' => $workload, 'affinity' => $affinity, 'steering' => $steering];
+            $curve = [];
+            foreach ($workers as $w) {
+                fprintf(STDERR, "%s/%s/%s: %d workers\n", $workload, $affinity, $steering, $w);
+                $row = point($workload, $affinity, $steering, $w, $opt);
+                emit(['kind' => 'point'] + $config + $row);
+                $curve[] = $row;
+            }
+
+            $base = null;
+            $kneeAt = null;
+            foreach ($curve as &$p) {
+                $base ??= $p['rps'] / max(1, $p['workers']);
+                $p['efficiency'] = $base > 0 ? round($p['rps'] / ($p['workers'] * $base), 3) : null;
+                if ($kneeAt === null && $p['efficiency'] !== null && $p['efficiency'] < $knee) {
+                    $kneeAt = $p['workers'];
+                }
+            }
+            unset($p);
+            emit(['kind' => 'curve'] + $config + [
+                'knee'  => $kneeAt,
+                'curve' => array_map(static fn (array $p): array => [
+                    'workers' => $p['workers'], 'rps' => $p['rps'], 'p99_us' => $p['p99_us'], 'efficiency' => $p['efficiency'],
+                ], $curve),
+            ]);
+        }
+    }
+}
@@ -0,0 +1,405 @@
+<?php
+declare(strict_types=1);
+
+/*
+ * HandshakeScalingTest.php
+ * ─────────────────────────────────────────────────────────────────────────
+ *  PURPOSE
+ *  -------
+ *  • Measures what a listener scales on, against a server running
+ *    quicpro_server_listen() on QUIC_DEMO_HOST:QUIC_DEMO_PORT:
+ *      – `full`    handshakes per second, and per second of server CPU
+ *                  (= per core), with the client session cache off;
+ *      – `resumed` the same with resumption and 0-RTT offered;
+ *      – `memory`  server RSS per concurrent connection, idle and active
+ *                  (one request per connection every HS_ACTIVE_MS), at each
+ *                  count of HS_CONNECTIONS;
+ *      – `flood`   accept-path latency (one handshake after another) alone
+ *                  and under a flood of HS_FLOOD_PPS forged Initials.
+ *    These are the numbers the slab allocator, retry tokens and idle
+ *    compaction are meant to move.
+ *
+ *  • The server's CPU time and RSS are read from /proc, so the server must
+ *    run on this host: QUIC_SERVER_PID lists its process (or, for a
+ *    cluster, its workers' processes), comma separated.  Without it those
+ *    fields are null.
+ *
+ *  • The load comes from HS_CLIENTS child processes of this script.  One
+ *    process holds at most ~28k connections (one UDP port each), so 1M
+ *    connections need a raised ip_local_port_range and RLIMIT_NOFILE and
+ *    enough HS_CLIENTS; a row reports how many connections it reached.
+ *
+ *  • Output is one JSON object per line on STDOUT, tagged with the
+ *    extension's version, for tracking across releases.  Progress and
+ *    errors go to STDERR.
+ * ─────────────────────────────────────────────────────────────────────────
+ */
+
+$host        = getenv('QUIC_DEMO_HOST') ?: 'demo-quic';
+$port        = (int) (getenv('QUIC_DEMO_PORT') ?: 4433);
+$serverPids  = array_filter(array_map('intval', explode(',', getenv('QUIC_SERVER_PID') ?: '')));
+$modes       = explode(',', getenv('HS_MODES') ?: 'full,resumed,memory,flood');
+$clients     = max(1, (int) (getenv('HS_CLIENTS') ?: 4));
+$seconds     = max(1, (int) (getenv('HS_SECONDS') ?: 10));
+$counts      = array_map('intval', explode(',', getenv('HS_CONNECTIONS') ?: '10000,100000,1000000'));
+$activeMs    = max(1, (int) (getenv('HS_ACTIVE_MS') ?: 1000));
+$settle      = max(0, (int) (getenv('HS_SETTLE') ?: 35));    // past the idle compaction delay
+$floodPps    = max(1, (int) (getenv('HS_FLOOD_PPS') ?: 100_000));
+$floodProcs  = max(1, (int) (getenv('HS_FLOOD_CLIENTS') ?: 2));
+
+/*──────────────────────────── Latency histogram ──────────────────────────*/
+
+/*  Buckets 1% apart, keyed by round(100·ln µs): small enough to send
+ *  between processes, exact enough for p99.9.                              */
+function hist_add(array &$h, float $us): void
+{
+    $k = (int) round(100 * log(max(1.0, $us)));
+    $h[$k] = ($h[$k] ?? 0) + 1;
+}
+
+function hist_merge(array $into, array $h): array
+{
+    foreach ($h as $k => $n) {
+        $into[$k] = ($into[$k] ?? 0) + $n;
+    }
+    return $into;
+}
+
+function hist_percentile(array $h, float $p): ?float
+{
+    if (!$h) {
+        return null;
+    }
+    ksort($h);
+    $rank = max(1, (int) ceil($p * array_sum($h)));
+    $seen = 0;
+    foreach ($h as $k => $n) {
+        $seen += $n;
+        if ($seen >= $rank) {
+            return round(exp($k / 100), 1);
+        }
+    }
+    return null;
+}
+
+/*──────────────────────────── Worker side ────────────────────────────────*/
+
+/*  Connects, closes, repeats; with $resume the first connection only fills
+ *  the session cache.                                                      */
+function worker_handshakes(string $host, int $port, int $seconds, bool $resume): array
+{
+    if ($resume) {
+        quicpro_close(quicpro_connect($host, $port));
+    }
+    $hist = [];
+    $ok = $failed = 0;
+    $end = hrtime(true) + $seconds * 1_000_000_000;
+    while (($t0 = hrtime(true)) < $end) {
+        try {
+            $s = quicpro_connect($host, $port);
+            if ($s && $s->isConnected()) {
+                hist_add($hist, (hrtime(true) - $t0) / 1_000);
+                $ok++;
+            } else {
+                $failed++;
+            }
+            if ($s) {
+                quicpro_close($s);
+            }
+        } catch (Throwable) {
+            $failed++;
+        }
+    }
+    return ['ok' => $ok, 'failed' => $failed, 'hist' => $hist];
+}
+
+/*  Opens $count connections, reports them, then keeps them alive until the
+ *  parent writes to STDIN.  Active ones each have a request out every
+ *  $activeMs.                                                              */
+function worker_hold(string $host, int $port, int $count, bool $active, int $activeMs): array
+{
+    $sessions = [];
+    $failed = 0;
+    for ($i = 0; $i < $count; $i++) {
+        try {
+            $s = quicpro_connect($host, $port);
+            if ($s && $s->isConnected()) {
+                $sessions[] = $s;
+            } else {
+                $failed++;
+            }
+        } catch (Throwable) {
+            $failed++;
+        }
+    }
+    echo json_encode(['ready' => count($sessions), 'failed' => $failed]), "\n";
+    fflush(STDOUT);
+
+    stream_set_blocking(STDIN, false);
+    $requests = 0;
+    $next = hrtime(true);
+    for (;;) {
+        $r = [STDIN];
+        $w = $e = null;
+        if (stream_select($r, $w, $e, 0, 10_000) > 0) {
+            break;
+        }
+        $due = $active && hrtime(true) >= $next;
+        foreach ($sessions as $s) {
+            if ($due) {
+                quicpro_send_request($s, '/');
+                $requests++;
+            }
+            quicpro_poll($s, 0);
+        }
+        if ($due) {
+            $next += $activeMs * 1_000_000;
+        }
+    }
+    foreach ($sessions as $s) {
+        quicpro_close($s);
+    }
+    return ['ready' => count($sessions), 'failed' => $failed, 'requests' => $requests];
+}
+
+/*  Sends forged client Initials (RFC 9000 §17.2.2) from random connection
+ *  IDs at $pps: each costs the server a key derivation and a failed
+ *  decryption, or a Retry when it defends with tokens.                     */
+function worker_flood(string $host, int $port, int $pps, int $seconds): array
+{
+    $sock = stream_socket_client("udp://{$host}:{$port}", $errno, $errstr);
+    if ($sock === false) {
+        throw new RuntimeException("udp://{$host}:{$port}: {$errstr}");
+    }
+    $len = 1200 - 26;
+    $pool = [];
+    for ($i = 0; $i < 64; $i++) {
+        $pool[] = "\xC3" . pack('N', 1) . "\x08" . random_bytes(8) . "\x08" . random_bytes(8)
+                . "\x00" . pack('n', 0x4000 | $len) . random_bytes($len);
+    }
+    $sent = 0;
+    $start = hrtime(true);
+    $end = $start + $seconds * 1_000_000_000;
+    while (($now = hrtime(true)) < $end) {
+        $due = (int) (($now - $start) * $pps / 1e9);
+        for (; $sent < $due; $sent++) {
+            $pkt = $pool[$sent & 63];
+            $pkt = substr_replace($pkt, pack('J', $sent), 6, 8);   // a new DCID each time
+            @fwrite($sock, $pkt);
+        }
+        usleep(1_000);
+    }
+    fclose($sock);
+    return ['sent' => $sent, 'pps' => round($sent / $seconds)];
+}
+
+if (($argv[1] ?? '') === 'worker') {
+    $a = json_decode($argv[3], true);
+    $result = match ($argv[2]) {
+        'handshakes' => worker_handshakes($a['host'], $a['port'], $a['seconds'], $a['resume']),
+        'hold'       => worker_hold($a['host'], $a['port'], $a['count'], $a['active'], $a['active_ms']),
+        'flood'      => worker_flood($a['host'], $a['port'], $a['pps'], $a['seconds']),
+    };
+    echo json_encode($result), "\n";
+    exit(0);
+}
+
+/*──────────────────────────── Coordinator ────────────────────────────────*/
+
+/** @return array{0: resource, 1: array} */
+function spawn(string $kind, array $args, array $ini = []): array
+{
+    $cmd = [PHP_BINARY];
+    foreach ($ini as $k => $v) {
+        $cmd[] = '-d';
+        $cmd[] = "{$k}={$v}";
+    }
+    array_push($cmd, __FILE__, 'worker', $kind, json_encode($args));
+    $proc = proc_open($cmd, [0 => ['pipe', 'r'], 1 => ['pipe', 'w'], 2 => STDERR], $pipes);
+    if (!is_resource($proc)) {
+        throw new RuntimeException("cannot start {$kind} worker");
+    }
+    return [$proc, $pipes];
+}
+
+/*  The worker's last line is its result. */
+function finish(array $worker): array
+{
+    [$proc, $pipes] = $worker;
+    fclose($pipes[0]);
+    $out = trim(stream_get_contents($pipes[1]));
+    fclose($pipes[1]);
+    proc_close($proc);
+    $lines = explode("\n", $out);
+    return json_decode(end($lines), true) ?? [];
+}
+
+/** @return array{rss: ?int, cpu_s: ?float} The server's RSS and CPU time so far. */
+function server_sample(array $pids): array
+{
+    if (!$pids) {
+        return ['rss' => null, 'cpu_s' => null];
+    }
+    static $tick = null;
+    $tick ??= (int) (trim((string) @shell_exec('getconf CLK_TCK')) ?: 100);
+    $rss = 0;
+    $ticks = 0;
+    foreach ($pids as $pid) {
+        $status = @file_get_contents("/proc/{$pid}/status");
+        $stat = @file_get_contents("/proc/{$pid}/stat");
+        if ($status === false || $stat === false) {
+            throw new RuntimeException("QUIC_SERVER_PID {$pid}: no such process on this host");
+        }
+        preg_match('/^VmRSS:\s+(\d+) kB/m', $status, $m);
+        $rss += (int) ($m[1] ?? 0) * 1024;
+        $f = explode(' ', substr($stat, strrpos($stat, ')') + 2));
+        $ticks += (int) $f[11] + (int) $f[12];               // utime, stime
+    }
+    return ['rss' => $rss, 'cpu_s' => $ticks / $tick];
+}
+
+function emit(array $row): void
+{
+    echo json_encode(['bench' => 'handshake_scaling', 'version' => quicpro_version(), 'ts' => time()] + $row), "\n";
+}
+
+/*  HS_CLIENTS workers connecting for HS_SECONDS; handshakes per server core
+ *  is the count over the server's CPU seconds in that time.               */
+function run_handshakes(string $mode, array $pids, string $host, int $port, int $clients, int $seconds): void
+{
+    $resume = $mode === 'resumed';
+    $ini = [
+        'quicpro.tls_client_session_cache_enable' => $resume ? 1 : 0,
+        'quicpro.tls_client_enable_early_data'    => $resume ? 1 : 0,
+    ];
+    $s0 = server_sample($pids);
+    $t0 = hrtime(true);
+    $workers = [];
+    for ($i = 0; $i < $clients; $i++) {
+        $workers[] = spawn('handshakes', compact('host', 'port', 'seconds', 'resume'), $ini);
+    }
+    $ok = $failed = 0;
+    $hist = [];
+    foreach ($workers as $w) {
+        $r = finish($w);
+        $ok += $r['ok'] ?? 0;
+        $failed += $r['failed'] ?? 0;
+        $hist = hist_merge($hist, $r['hist'] ?? []);
+    }
+    $wall = (hrtime(true) - $t0) / 1e9;
+    $s1 = server_sample($pids);
+    $cpu = $s1['cpu_s'] !== null ? $s1['cpu_s'] - $s0['cpu_s'] : null;
+
+    emit([
+        'mode'                => $mode,
+        'clients'             => $clients,
+        'handshakes'          => $ok,
+        'failed'              => $failed,
+        'handshakes_per_s'    => round($ok / $wall, 1),
+        'server_cpu_s'        => $cpu !== null ? round($cpu, 3) : null,
+        'handshakes_per_core_s' => $cpu ? round($ok / $cpu, 1) : null,
+        'connect_p50_us'      => hist_percentile($hist, 0.50),
+        'connect_p99_us'      => hist_percentile($hist, 0.99),
+        'connect_p999_us'     => hist_percentile($hist, 0.999),
+    ]);
+}
+
+/*  Opens $count connections over the workers, waits HS_SETTLE seconds for
+ *  the server to settle (idle compaction included), then reads its RSS. */
+function run_memory(int $count, bool $active, array $pids, string $host, int $port, int $clients,
+                    int $activeMs, int $settle): void
+{
+    $s0 = server_sample($pids);
+    $workers = [];
+    for ($i = 0; $i < $clients; $i++) {
+        $share = intdiv($count, $clients) + ($i < $count % $clients ? 1 : 0);
+        $workers[] = spawn('hold', ['host' => $host, 'port' => $port, 'count' => $share,
+                                    'active' => $active, 'active_ms' => $activeMs]);
+    }
+    $reached = 0;
+    foreach ($workers as [, $pipes]) {
+        $ready = json_decode((string) fgets($pipes[1]), true);
+        $reached += $ready['ready'] ?? 0;
+    }
+    fprintf(STDERR, "memory: %d of %d connections %s, settling %d s\n",
+            $reached, $count, $active ? 'active' : 'idle', $settle);
+    sleep($settle);
+    $s1 = server_sample($pids);
+
+    $failed = $requests = 0;
+    foreach ($workers as $w) {
+        fwrite($w[1][0], "stop\n");
+    }
+    foreach ($workers as $w) {
+        $r = finish($w);
+        $failed += $r['failed'] ?? 0;
+        $requests += $r['requests'] ?? 0;
+    }
+    $delta = $s1['rss'] !== null ? $s1['rss'] - $s0['rss'] : null;
+
+    emit([
+        'mode'               => 'memory',
+        'state'              => $active ? 'active' : 'idle',
+        'connections'        => $count,
+        'reached'            => $reached,
+        'failed'             => $failed,
+        'requests'           => $requests,
+        'server_rss_before'  => $s0['rss'],
+        'server_rss_after'   => $s1['rss'],
+        'rss_per_connection' => $delta !== null && $reached ? (int) round($delta / $reached) : null,
+    ]);
+}
+
+/*  One probe connecting back to back, HS_SECONDS alone and HS_SECONDS
+ *  while HS_FLOOD_CLIENTS processes send forged Initials. */
+function run_flood(array $pids, string $host, int $port, int $seconds, int $pps, int $floodProcs): void
+{
+    foreach ([0, $pps] as $rate) {
+        $s0 = server_sample($pids);
+        $flood = [];
+        for ($i = 0; $rate && $i < $floodProcs; $i++) {
+            $flood[] = spawn('flood', ['host' => $host, 'port' => $port,
+                                       'pps' => intdiv($rate, $floodProcs), 'seconds' => $seconds]);
+        }
+        $probe = finish(spawn('handshakes', ['host' => $host, 'port' => $port, 'seconds' => $seconds, 'resume' => false],
+                              ['quicpro.tls_client_session_cache_enable' => 0]));
+        $sent = 0;
+        foreach ($flood as $w) {
+            $sent += finish($w)['sent'] ?? 0;
+        }
+        $s1 = server_sample($pids);
+        $hist = $probe['hist'] ?? [];
+
+        emit([
+            'mode'            => 'flood',
+            'flood_pps'       => round($sent / $seconds),
+            'handshakes'      => $probe['ok'] ?? 0,
+            'failed'          => $probe['failed'] ?? 0,
+            'server_cpu_s'    => $s1['cpu_s'] !== null ? round($s1['cpu_s'] - $s0['cpu_s'], 3) : null,
+            'accept_p50_us'   => hist_percentile($hist, 0.50),
+            'accept_p99_us'   => hist_percentile($hist, 0.99),
+            'accept_p999_us'  => hist_percentile($hist, 0.999),
+        ]);
+    }
+}
+
+if (!$serverPids) {
+    fprintf(STDERR, "QUIC_SERVER_PID not set: server CPU and RSS fields will be null\n");
+}
+foreach ($modes as $mode) {
+    try {
+        match ($mode) {
+            'full', 'resumed' => run_handshakes($mode, $serverPids, $host, $port, $clients, $seconds),
+            'memory'          => array_map(
+                static function (int $count) use ($serverPids, $host, $port, $clients, $activeMs, $settle) {
+                    run_memory($count, false, $serverPids, $host, $port, $clients, $activeMs, $settle);
+                    run_memory($count, true, $serverPids, $host, $port, $clients, $activeMs, $settle);
+                },
+                $counts
+            ),
+            'flood'           => run_flood($serverPids, $host, $port, $seconds, $floodPps, $floodProcs),
+        };
+    } catch (Throwable $e) {
+        fprintf(STDERR, "%s: %s\n", $mode, $e->getMessage());
+    }
+}
@@ -0,0 +1,309 @@
+<?php
+declare(strict_types=1);
+
+/*
+ * bench_iibin_codec.php
+ * ─────────────────────────────────────────────────────────────────────────
+ *  PURPOSE
+ *  -------
+ *  • **Codec microbenchmark** – *not* a PHPUnit test – for IIBIN encode,
+ *    decode and lazy-view access, next to protobuf-php, msgpack and
+ *    igbinary on the same data.  No network; one process, one core.
+ *
+ *  • Cases cover the shapes the codec is tuned for:
+ *      – flat     six scalar and string fields,
+ *      – nested   segments of points, three levels deep,
+ *      – floats   one packed run of IIBIN_FLOATS floats (default 4096),
+ *      – blob     one bytes field of IIBIN_BLOB_KB KiB (default 1024).
+ *    The data is generated from a fixed seed, so every run and every
+ *    codec sees the same values.
+ *
+ *  • Reported per case, codec and operation, as the median of IIBIN_RUNS
+ *    runs (default 5) after one warm-up run:
+ *      – ns/op     wall-clock time per operation (hrtime),
+ *      – bytes/op  size of the encoded message,
+ *      – mem/op    bytes the decoded result keeps allocated (PHP cannot
+ *                  count allocator calls from userland; this measures what
+ *                  they add up to); 0 for encode,
+ *      – GB/s      encoded bytes per nanosecond.
+ *    IIBIN "view" is decodeView() plus reading one field, the cost of a
+ *    handler that looks at a single field of a large message.
+ *
+ *  • Every run does enough operations to last IIBIN_RUN_MS (default 200).
+ *    IIBIN_CASES and IIBIN_CODECS (comma lists) pick a subset.  Output is
+ *    one aligned line per result, or one JSON object per line with
+ *    IIBIN_JSON=1, for CI dashboards and regression diffs.
+ *
+ *  • Codecs whose extension or library is missing are skipped with a note.
+ *    protobuf-php needs the google/protobuf package (composer) or the
+ *    protobuf extension, and the classes protoc generates from
+ *    proto/iibin_bench.proto into proto/.
+ * ─────────────────────────────────────────────────────────────────────────
+ */
+
+use Quicpro\IIBIN;
+
+if (is_file(__DIR__ . '/vendor/autoload.php')) {
+    require __DIR__ . '/vendor/autoload.php';
+}
+
+$runs    = max(1, (int) (getenv('IIBIN_RUNS') ?: 5));
+$runMs   = max(10, (int) (getenv('IIBIN_RUN_MS') ?: 200));
+$floats  = max(1, (int) (getenv('IIBIN_FLOATS') ?: 4096));
+$blobKb  = max(1, (int) (getenv('IIBIN_BLOB_KB') ?: 1024));
+$asJson  = (getenv('IIBIN_JSON') ?: '0') === '1';
+$cases   = array_filter(explode(',', getenv('IIBIN_CASES') ?: 'flat,nested,floats,blob'));
+$codecs  = array_filter(explode(',', getenv('IIBIN_CODECS') ?: 'iibin,protobuf,msgpack,igbinary'));
+
+if (!class_exists(IIBIN::class)) {
+    fwrite(STDERR, "quicpro_async extension is not loaded\n");
+    exit(1);
+}
+
+/*──────────────────────────────── Schemas ────────────────────────────────*/
+
+IIBIN::defineSchema('BenchFlat', [
+    'id'     => ['tag' => 1, 'type' => 'uint64'],
+    'delta'  => ['tag' => 2, 'type' => 'sint32'],
+    'score'  => ['tag' => 3, 'type' => 'double'],
+    'active' => ['tag' => 4, 'type' => 'bool'],
+    'name'   => ['tag' => 5, 'type' => 'string'],
+    'status' => ['tag' => 6, 'type' => 'int32'],
+]);
+IIBIN::defineSchema('BenchPoint', [
+    'x'     => ['tag' => 1, 'type' => 'sint32'],
+    'y'     => ['tag' => 2, 'type' => 'sint32'],
+    'label' => ['tag' => 3, 'type' => 'string'],
+]);
+IIBIN::defineSchema('BenchSegment', [
+    'from' => ['tag' => 1, 'type' => 'BenchPoint'],
+    'to'   => ['tag' => 2, 'type' => 'BenchPoint'],
+    'via'  => ['tag' => 3, 'type' => 'repeated_BenchPoint'],
+]);
+IIBIN::defineSchema('BenchNested', [
+    'id'       => ['tag' => 1, 'type' => 'uint64'],
+    'segments' => ['tag' => 2, 'type' => 'repeated_BenchSegment'],
+    'meta'     => ['tag' => 3, 'type' => 'BenchFlat'],
+]);
+IIBIN::defineSchema('BenchFloats', [
+    'values' => ['tag' => 1, 'type' => 'repeated_float'],
+]);
+IIBIN::defineSchema('BenchBlob', [
+    'name' => ['tag' => 1, 'type' => 'string'],
+    'data' => ['tag' => 2, 'type' => 'bytes'],
+]);
+
+/*────────────────────────────────── Data ─────────────────────────────────*/
+
+mt_srand(0x11B1);
+
+function bench_flat(int $i): array
+{
+    return [
+        'id'     => 1_000_000 + $i,
+        'delta'  => mt_rand(-5000, 5000),
+        'score'  => mt_rand() / mt_getrandmax(),
+        'active' => ($i & 1) === 1,
+        'name'   => 'user-' . mt_rand(1, 99999),
+        'status' => mt_rand(0, 4),
+    ];
+}
+
+function bench_point(): array
+{
+    return ['x' => mt_rand(-100000, 100000), 'y' => mt_rand(-100000, 100000), 'label' => 'p' . mt_rand(1, 999)];
+}
+
+$nested = ['id' => 42, 'segments' => [], 'meta' => bench_flat(7)];
+for ($s = 0; $s < 32; $s++) {
+    $via = [];
+    for ($v = 0; $v < 8; $v++) {
+        $via[] = bench_point();
+    }
+    $nested['segments'][] = ['from' => bench_point(), 'to' => bench_point(), 'via' => $via];
+}
+
+$values = [];
+for ($f = 0; $f < $floats; $f++) {
+    /* Exactly representable as float, so every codec round-trips the same list */
+    $values[] = (float) (mt_rand(-1 << 20, 1 << 20) / 256);
+}
+
+$blob = '';
+for ($b = 0; $b < $blobKb; $b++) {
+    $blob .= pack('N*', ...array_map(fn () => mt_rand(), range(1, 256)));
+}
+
+/* case => [IIBIN schema, protobuf class, message, the field the view reads] */
+$data = [
+    'flat'   => ['BenchFlat', 'Flat', bench_flat(1), 'name'],
+    'nested' => ['BenchNested', 'Nested', $nested, 'id'],
+    'floats' => ['BenchFloats', 'Floats', ['values' => $values], 'values'],
+    'blob'   => ['BenchBlob', 'Blob', ['name' => 'blob.bin', 'data' => $blob], 'name'],
+];
+
+/*──────────────────────────────── Codecs ─────────────────────────────────*/
+
+/*  protoc's classes live under proto/, e.g. proto/QuicproBench/Proto/Flat.php. */
+spl_autoload_register(static function (string $class): void {
+    if (str_starts_with($class, 'QuicproBench\\Proto\\')) {
+        $file = __DIR__ . '/proto/' . str_replace('\\', '/', $class) . '.php';
+        if (is_file($file)) {
+            require $file;
+        }
+    }
+});
+
+/**
+ * Each codec prepares a case once, outside the timing, and returns its
+ * operations: name => closure running one operation and returning what it
+ * produced.  A string says why the codec cannot run here; null means the
+ * codec is unknown.
+ *
+ * @return null|string|array<string, Closure>
+ */
+function bench_codec(string $codec, array $case): null|string|array
+{
+    [$schema, $protoClass, $message, $viewField] = $case;
+
+    switch ($codec) {
+        case 'iibin':
+            $bytes = IIBIN::encode($schema, $message);
+            return [
+                'encode' => fn () => IIBIN::encode($schema, $message),
+                'decode' => fn () => IIBIN::decode($schema, $bytes),
+                'view'   => fn () => IIBIN::decodeView($schema, $bytes)->get($viewField),
+            ];
+
+        case 'protobuf':
+            $class = 'QuicproBench\\Proto\\' . $protoClass;
+            if (!class_exists(\Google\Protobuf\Internal\Message::class) || !class_exists($class)) {
+                return 'needs google/protobuf and protoc --php_out=benchmarks/proto';
+            }
+            $json = $message;
+            if (isset($json['data'])) {
+                $json['data'] = base64_encode($json['data']);   /* bytes are base64 in proto3 JSON */
+            }
+            $msg = new $class();
+            $msg->mergeFromJsonString(json_encode($json, JSON_THROW_ON_ERROR));
+            $bytes = $msg->serializeToString();
+            return [
+                'encode' => fn () => $msg->serializeToString(),
+                'decode' => function () use ($class, $bytes) {
+                    $m = new $class();
+                    $m->mergeFromString($bytes);
+                    return $m;
+                },
+            ];
+
+        case 'msgpack':
+            if (!function_exists('msgpack_pack')) {
+                return 'needs ext-msgpack';
+            }
+            $bytes = msgpack_pack($message);
+            return [
+                'encode' => fn () => msgpack_pack($message),
+                'decode' => fn () => msgpack_unpack($bytes),
+            ];
+
+        case 'igbinary':
+            if (!function_exists('igbinary_serialize')) {
+                return 'needs ext-igbinary';
+            }
+            $bytes = igbinary_serialize($message);
+            return [
+                'encode' => fn () => igbinary_serialize($message),
+                'decode' => fn () => igbinary_unserialize($bytes),
+            ];
+    }
+    return null;
+}
+
+/*─────────────────────────────── Measuring ───────────────────────────────*/
+
+/** Operations in one run of about $runMs, from a short probe. */
+function bench_calibrate(Closure $op, int $runMs): int
+{
+    $n = 1;
+    while (true) {
+        $t0 = hrtime(true);
+        for ($i = 0; $i < $n; $i++) {
+            $op();
+        }
+        $ns = hrtime(true) - $t0;
+        if ($ns >= 10_000_000 || $n >= 1 << 24) {
+            return max(1, (int) ($n * $runMs * 1_000_000 / max(1, $ns)));
+        }
+        $n *= 4;
+    }
+}
+
+/** Median ns per operation over $runs runs of $n operations, after one warm-up run. */
+function bench_time(Closure $op, int $n, int $runs): float
+{
+    $samples = [];
+    for ($r = 0; $r <= $runs; $r++) {
+        $t0 = hrtime(true);
+        for ($i = 0; $i < $n; $i++) {
+            $op();
+        }
+        if ($r > 0) {
+            $samples[] = (hrtime(true) - $t0) / $n;
+        }
+    }
+    sort($samples);
+    return $samples[intdiv(count($samples), 2)];
+}
+
+/** Bytes the result of one operation keeps allocated. */
+function bench_retained(Closure $op): int
+{
+    gc_collect_cycles();
+    $before = memory_get_usage();
+    $result = $op();
+    $after  = memory_get_usage();
+    unset($result);
+    return max(0, $after - $before);
+}
+
+/*────────────────────────────────── Run ──────────────────────────────────*/
+
+if (!$asJson) {
+    printf("%-7s %-9s %-7s %12s %12s %12s %8s\n", 'case', 'codec', 'op', 'ns/op', 'bytes/op', 'mem/op', 'GB/s');
+}
+
+foreach ($cases as $caseName) {
+    if (!isset($data[$caseName])) {
+        fwrite(STDERR, "unknown case '$caseName'\n");
+        continue;
+    }
+    foreach ($codecs as $codec) {
+        $ops = bench_codec($codec, $data[$caseName]);
+        if (!is_array($ops)) {
+            fwrite(STDERR, sprintf("%s/%s skipped: %s\n", $caseName, $codec, $ops ?? 'unknown codec'));
+            continue;
+        }
+        $size = strlen($ops['encode']());
+        foreach ($ops as $opName => $op) {
+            $n   = bench_calibrate($op, $runMs);
+            $ns  = bench_time($op, $n, $runs);
+            $mem = $opName === 'encode' ? 0 : bench_retained($op);
+            $row = [
+                'case'     => $caseName,
+                'codec'    => $codec,
+                'op'       => $opName,
+                'ns_op'    => round($ns, 1),
+                'bytes_op' => $size,
+                'mem_op'   => $mem,
+                'gb_s'     => round($size / $ns, 3),
+                'ops'      => $n,
+            ];
+            if ($asJson) {
+                echo json_encode($row, JSON_THROW_ON_ERROR), "\n";
+            } else {
+                printf("%-7s %-9s %-7s %12.1f %12d %12d %8.3f\n",
+                    $caseName, $codec, $opName, $row['ns_op'], $size, $mem, $row['gb_s']);
+            }
+        }
+    }
+}
@@ -0,0 +1,104 @@
+<?php
+declare(strict_types=1);
+
+/*
+ * NetemLabTest.php
+ * ─────────────────────────────────────────────────────────────────────────
+ *  PURPOSE
+ *  -------
+ *  • The client side of the netem lab: compares QUIC (HTTP/3) with TCP
+ *    (HTTP/2 over TLS) through whatever impairment the runner applied
+ *    (infra/scripts/run-netem-benchmark.sh, profiles in netem.sh).  The
+ *    server is benchmarks/netem/server.php; both transports answer the
+ *    same payloads, so only the transport differs.
+ *
+ *  • Scenarios, each run once per transport with quicpro_loadgen_run():
+ *      – `throughput` back-to-back downloads of NETEM_BULK bytes on one
+ *                     connection: goodput, i.e. congestion control and
+ *                     loss recovery at the path's BDP;
+ *      – `latency`    NETEM_LATENCY_RATE small responses per second:
+ *                     request latency percentiles on an idle path;
+ *      – `hol`        NETEM_HOL_RATE small responses per second, all on
+ *                     one connection: under loss, one lost TCP segment
+ *                     stalls every HTTP/2 stream behind it, while a lost
+ *                     QUIC packet stalls only its own streams.  The p99 to
+ *                     p50 ratio shows the head-of-line blocking.
+ *
+ *  • Output is one JSON object per line on STDOUT, tagged with the
+ *    extension's version, NETEM_PROFILE and NETEM_CC, so the runner can
+ *    collect a whole sweep into one file.
+ * ─────────────────────────────────────────────────────────────────────────
+ */
+
+$host        = getenv('NETEM_SERVER') ?: 'netem-server';
+$h2Port      = (int) (getenv('NETEM_H2_PORT') ?: 8443);
+$h3Port      = (int) (getenv('NETEM_H3_PORT') ?: 4433);
+$profile     = getenv('NETEM_PROFILE') ?: 'none';
+$cc          = getenv('NETEM_CC') ?: ini_get('quicpro.transport_cc_algorithm');
+$seconds     = max(1, (int) (getenv('NETEM_SECONDS') ?: 20));
+$bulk        = max(1, (int) (getenv('NETEM_BULK') ?: 8 * 1024 * 1024));
+$small       = max(1, (int) (getenv('NETEM_SMALL') ?: 2048));
+$latencyRate = max(1, (int) (getenv('NETEM_LATENCY_RATE') ?: 20));
+$holRate     = max(1, (int) (getenv('NETEM_HOL_RATE') ?: 500));
+$scenarios   = explode(',', getenv('NETEM_SCENARIOS') ?: 'throughput,latency,hol');
+
+/*  The mix entry that fetches $size bytes over $transport. */
+function request(string $transport, int $size, string $host, int $h2Port, int $h3Port): array
+{
+    return $transport === 'h3'
+        ? ['protocol' => 'mcp', 'host' => $host, 'port' => $h3Port,
+           'service' => 'bench', 'method' => 'bytes', 'body' => (string) $size]
+        : ['protocol' => 'h2', 'url' => "https://{$host}:{$h2Port}/bytes/{$size}",
+           'options' => ['verify_peer' => false, 'verify_host' => false]];
+}
+
+/** @return array<string, mixed> */
+function scenario(string $name, Closure $mix, int $seconds, int $bulk, int $small,
+                  int $latencyRate, int $holRate): array
+{
+    [$size, $rate, $inFlight] = match ($name) {
+        'throughput' => [$bulk, 1000, 1],         // closed loop: the next download starts when one ends
+        'latency'    => [$small, $latencyRate, 10000],
+        'hol'        => [$small, $holRate, 10000],
+    };
+    $r = quicpro_loadgen_run([
+        'rate'          => $rate,
+        'duration_ms'   => $seconds * 1000,
+        'max_in_flight' => $inFlight,
+        'timeout_ms'    => 30000,
+        'connections'   => 1,
+        'mix'           => [$mix($size)],
+    ]);
+    $lat = $r['latency_us'];
+    $ok  = $r['completed'] - $r['errors'];
+
+    return [
+        'scenario'       => $name,
+        'size'           => $size,
+        'sent'           => $r['sent'],
+        'completed'      => $r['completed'],
+        'errors'         => $r['errors'],
+        'timeouts'       => $r['timeouts'],
+        'goodput_mbit_s' => $r['elapsed_ms'] > 0 ? round($ok * $size * 8 / ($r['elapsed_ms'] * 1000), 2) : null,
+        'p50_us'         => $lat['p50'],
+        'p99_us'         => $lat['p99'],
+        'p999_us'        => $lat['p99.9'],
+        'max_us'         => $lat['max'],
+        'hol_ratio'      => $lat['p50'] > 0 ? round($lat['p99'] / $lat['p50'], 2) : null,
+    ];
+}
+
+foreach ($scenarios as $name) {
+    foreach (['h2', 'h3'] as $transport) {
+        try {
+            $mix = static fn (int $size): array => request($transport, $size, $host, $h2Port, $h3Port);
+            $row = ['transport' => $transport]
+                 + scenario($name, $mix, $seconds, $bulk, $small, $latencyRate, $holRate);
+        } catch (Throwable $e) {
+            fprintf(STDERR, "%s/%s: %s\n", $name, $transport, $e->getMessage());
+            continue;
+        }
+        echo json_encode(['bench' => 'netem_lab', 'version' => quicpro_version(), 'ts' => time(),
+                          'profile' => $profile, 'cc' => $cc] + $row), "\n";
+    }
+}
@@ -0,0 +1,159 @@
+<?php
+declare(strict_types=1);
+
+/*
+ * ReplayTest.php
+ * ─────────────────────────────────────────────────────────────────────────
+ *  PURPOSE
+ *  -------
+ *  • Compares builds of the extension on production-shaped traffic without
+ *    the network's noise: quicpro_server_replay() runs the requests of a
+ *    recorded trace (REPLAY_TRACE; see infra/tshark/capture.sh and
+ *    benchmarks/replay/convert.php) through the server loop in one
+ *    process, with in-process clients instead of a socket.
+ *
+ *  • REPLAY_APP names a PHP file that registers the application (MCP
+ *    routes, say) and returns the stream handler
+ *    `fn($session, int $stream, bool $early)`.  Without it, every stream
+ *    goes to quicpro_mcp_server_serve().
+ *
+ *  • REPLAY_BUILDS ("base=/path/a.so,pr=/path/b.so") runs each build in its
+ *    own `php -n -d extension=…` process; without it, the loaded extension
+ *    is measured.  Every build replays REPLAY_WARMUP discarded and then
+ *    REPLAY_RUNS measured times.
+ *
+ *  • Output is one JSON object per line on STDOUT: a `run` row per replay
+ *    and a `summary` row per build with the medians of CPU time per request
+ *    and p99, and their change against the first build.  CPU time is the
+ *    figure to compare; it is what the server loop spent, clients included
+ *    (they are the same for every build).
+ * ─────────────────────────────────────────────────────────────────────────
+ */
+
+$trace   = getenv('REPLAY_TRACE') ?: '';
+$app     = getenv('REPLAY_APP') ?: '';
+$builds  = getenv('REPLAY_BUILDS') ?: '';
+$runs    = max(1, (int) (getenv('REPLAY_RUNS') ?: 5));
+$warmup  = max(0, (int) (getenv('REPLAY_WARMUP') ?: 1));
+$options = [
+    'speed'           => (float) (getenv('REPLAY_SPEED') ?: 0),
+    'loops'           => max(1, (int) (getenv('REPLAY_LOOPS') ?: 1)),
+    'max_connections' => max(1, (int) (getenv('REPLAY_MAX_CONNECTIONS') ?: 64)),
+];
+$certs   = getenv('REPLAY_CERT_DIR') ?: dirname(__DIR__) . '/var/traefik/certificates';
+
+if ($trace === '' || !is_readable($trace)) {
+    fwrite(STDERR, "REPLAY_TRACE must name a readable trace file\n");
+    exit(1);
+}
+
+/*──────────────────────────── One build ──────────────────────────────────*/
+
+/** @return list<array<string, mixed>> One row per measured replay. */
+function replay_here(string $trace, string $app, array $options, int $runs, int $warmup, string $certs): array
+{
+    $handler = $app !== ''
+        ? require $app
+        : static function ($session, int $stream, bool $early): void {
+            quicpro_mcp_server_serve($session);
+        };
+    $config = Quicpro\Config::new(['cert_file' => "{$certs}/local-cert.pem", 'key_file' => "{$certs}/local-key.pem"]);
+    $server = quicpro_server_create('::1', 0, $config);   // Bound, but no datagram ever crosses it
+
+    $rows = [];
+    for ($i = -$warmup; $i < $runs; $i++) {
+        $r = quicpro_server_replay($server, $handler, $trace, $options);
+        if ($i < 0) {
+            continue;
+        }
+        $cpu = $r['cpu_user_ms'] + $r['cpu_sys_ms'];
+        $rows[] = [
+            'run'             => $i,
+            'connections'     => $r['connections'],
+            'failed'          => $r['failed'],
+            'requests'        => $r['requests'],
+            'responses'       => $r['responses'],
+            'resets'          => $r['resets'],
+            'elapsed_ms'      => round($r['elapsed_ms'], 2),
+            'cpu_ms'          => round($cpu, 2),
+            'cpu_us_per_req'  => $r['responses'] > 0 ? round($cpu * 1000 / $r['responses'], 2) : null,
+            'rps'             => round($r['rps']),
+            'p50_us'          => $r['latency_us']['p50'],
+            'p99_us'          => $r['latency_us']['p99'],
+        ];
+    }
+    quicpro_server_close($server);
+    return $rows;
+}
+
+if (($argv[1] ?? '') === 'run') {
+    foreach (replay_here($trace, $app, $options, $runs, $warmup, $certs) as $row) {
+        echo json_encode($row), "\n";
+    }
+    exit(0);
+}
+
+/*──────────────────────────── Coordinator ────────────────────────────────*/
+
+/** @return list<array<string, mixed>> */
+function replay_build(string $so): array
+{
+    $proc = proc_open([PHP_BINARY, '-n', '-d', "extension={$so}", __FILE__, 'run'],
+                      [0 => ['pipe', 'r'], 1 => ['pipe', 'w'], 2 => STDERR], $pipes);
+    if (!is_resource($proc)) {
+        throw new RuntimeException("cannot start a replay with {$so}");
+    }
+    fclose($pipes[0]);
+    $rows = [];
+    while (($line = fgets($pipes[1])) !== false) {
+        $row = json_decode($line, true);
+        if (is_array($row)) {
+            $rows[] = $row;
+        }
+    }
+    fclose($pipes[1]);
+    if (proc_close($proc) !== 0) {
+        fwrite(STDERR, "replay with {$so} exited with an error\n");
+    }
+    return $rows;
+}
+
+function median(array $values): ?float
+{
+    $values = array_values(array_filter($values, 'is_numeric'));
+    if (!$values) {
+        return null;
+    }
+    sort($values);
+    $n = count($values);
+    return $n % 2 ? (float) $values[intdiv($n, 2)] : ($values[$n / 2 - 1] + $values[$n / 2]) / 2;
+}
+
+$targets = [];
+foreach (array_filter(explode(',', $builds)) as $build) {
+    [$name, $so] = array_pad(explode('=', $build, 2), 2, '');
+    $targets[$name] = $so;
+}
+$targets = $targets ?: ['loaded' => ''];
+
+$base = null;
+foreach ($targets as $name => $so) {
+    $rows = $so === '' ? replay_here($trace, $app, $options, $runs, $warmup, $certs) : replay_build($so);
+    $tag = ['bench' => 'replay', 'trace' => basename($trace), 'build' => $name, 'ts' => time()];
+    foreach ($rows as $row) {
+        echo json_encode($tag + ['kind' => 'run'] + $row), "\n";
+    }
+
+    $summary = [
+        'runs'           => count($rows),
+        'cpu_us_per_req' => median(array_column($rows, 'cpu_us_per_req')),
+        'p99_us'         => median(array_column($rows, 'p99_us')),
+        'failed'         => array_sum(array_column($rows, 'failed')),
+    ];
+    $base ??= $summary;
+    foreach (['cpu_us_per_req', 'p99_us'] as $k) {
+        $summary["{$k}_change_pct"] = $base[$k] && $summary[$k] !== null
+            ? round(($summary[$k] / $base[$k] - 1) * 100, 2) : null;
+    }
+    echo json_encode($tag + ['kind' => 'summary'] + $summary), "\n";
+}
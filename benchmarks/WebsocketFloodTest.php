@@ -0,0 +1,322 @@
+<?php
+declare(strict_types=1);
+
+/*
+ * bench_websocket_flood.php
+ * ─────────────────────────────────────────────────────────────────────────
+ *  PURPOSE
+ *  -------
+ *  • **Flood benchmark** – *not* a PHPUnit test – for WebSocket messaging.
+ *    A publisher connection sends WS_FRAMES messages as fast as the window
+ *    allows.  The server relays every message to the other connections on
+ *    WS_PATH (any broadcast handler built on quicpro_ws_publish() does).
+ *    A subscriber connection in this same process receives them.
+ *
+ *  • Each payload starts with the hrtime(true) of its send and a sequence
+ *    number.  Both connections read the same monotonic clock, so arrival
+ *    time minus that stamp is the one-way latency through the server.  No
+ *    clock sync is needed.
+ *
+ *  • Reported per transport:
+ *      – p50 / p99 / p999 one-way latency,
+ *      – frames per second per core (messages ÷ CPU seconds of this process),
+ *      – bytes copied per frame, masking throughput and compression ratio,
+ *        from the extension's quicpro_ws_get_stats() counters (HTTP/3 only;
+ *        the HTTP/1 client below frames in userland and has no counters).
+ *
+ *  • WS_TRANSPORT selects the path: `h3` (RFC 9220 extended CONNECT via
+ *    quicpro_ws_connect()), `h1` (RFC 6455 Upgrade over TCP/TLS to
+ *    WS_H1_PORT) or `both`.  Output is one line per transport on STDOUT,
+ *    or one JSON object per line with WS_JSON=1.
+ * ─────────────────────────────────────────────────────────────────────────
+ */
+
+$host      = getenv('QUIC_DEMO_HOST') ?: 'demo-quic';
+$port      = (int) (getenv('QUIC_DEMO_PORT') ?: 4433);
+$h1Port    = (int) (getenv('WS_H1_PORT') ?: 8443);
+$h1Tls     = (getenv('WS_H1_TLS') ?: '1') === '1';
+$path      = getenv('WS_PATH') ?: '/ws/flood';
+$frames    = (int) (getenv('WS_FRAMES') ?: 100_000);
+$size      = max(16, (int) (getenv('WS_SIZE') ?: 256));
+$window    = max(1, (int) (getenv('WS_WINDOW') ?: 256));   // messages in flight
+$random    = (getenv('WS_PAYLOAD') ?: 'text') === 'random'; // random = incompressible
+$transport = getenv('WS_TRANSPORT') ?: 'both';
+$asJson    = (getenv('WS_JSON') ?: '0') === '1';
+
+/*  Payload filler after the 16-byte stamp.  Text compresses roughly like
+ *  JSON chat traffic; random bytes show the cost when deflate cannot win. */
+$filler = $random
+    ? random_bytes($size - 16)
+    : substr(str_repeat('{"user":"bench","msg":"flood","n":0123456789}', intdiv($size, 40) + 1), 0, $size - 16);
+
+/*──────────────────────────── HTTP/3 transport ───────────────────────────*/
+
+final class H3Socket
+{
+    /** @var resource */
+    private $ws;
+
+    public function __construct(string $host, int $port, string $path)
+    {
+        $this->ws = quicpro_ws_connect($host, $port, $path);
+    }
+
+    public function send(string $payload): void
+    {
+        quicpro_ws_send($this->ws, $payload, true);
+    }
+
+    public function receive(int $timeoutMs): ?string
+    {
+        $msg = quicpro_ws_receive($this->ws, $timeoutMs);
+        if ($msg === false) {
+            throw new RuntimeException('WebSocket closed: ' . quicpro_ws_get_last_error());
+        }
+        return $msg;
+    }
+
+    public function close(): void
+    {
+        quicpro_ws_close($this->ws);
+    }
+}
+
+/*──────────────────────────── HTTP/1 transport ───────────────────────────*/
+
+/*  Minimal RFC 6455 client.  It exists to drive the server's HTTP/1 Upgrade
+ *  path, so it keeps its own cost low rather than complete: binary frames
+ *  only, no extensions, control frames from the server are skipped.        */
+final class H1Socket
+{
+    /** @var resource */
+    private $sock;
+    private string $rx = '';
+
+    public function __construct(string $host, int $port, string $path, bool $tls)
+    {
+        $ctx = stream_context_create(['ssl' => ['verify_peer' => false, 'verify_peer_name' => false]]);
+        $url = ($tls ? 'tls' : 'tcp') . "://{$host}:{$port}";
+        $sock = stream_socket_client($url, $errno, $errstr, 5.0, STREAM_CLIENT_CONNECT, $ctx);
+        if ($sock === false) {
+            throw new RuntimeException("connect {$url}: {$errstr}");
+        }
+        $this->sock = $sock;
+
+        $key = base64_encode(random_bytes(16));
+        fwrite($sock, "GET {$path} HTTP/1.1\r\nHost: {$host}\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+            . "Sec-WebSocket-Key: {$key}\r\nSec-WebSocket-Version: 13\r\n\r\n");
+
+        $head = '';
+        while (!str_contains($head, "\r\n\r\n")) {
+            $chunk = fread($sock, 4096);
+            if ($chunk === false || $chunk === '') {
+                throw new RuntimeException('Upgrade response truncated');
+            }
+            $head .= $chunk;
+        }
+        [$head, $this->rx] = explode("\r\n\r\n", $head, 2);
+        $accept = base64_encode(sha1($key . '258EAFA5-E914-47DA-95CA-C5AB0DC85B11', true));
+        if (!str_starts_with($head, 'HTTP/1.1 101') || stripos($head, $accept) === false) {
+            throw new RuntimeException('Upgrade refused: ' . strtok($head, "\r\n"));
+        }
+        stream_set_blocking($sock, false);
+    }
+
+    public function send(string $payload): void
+    {
+        $len  = strlen($payload);
+        $mask = random_bytes(4);
+        $head = "\x82" . match (true) {
+            $len <= 125   => chr(0x80 | $len),
+            $len <= 65535 => "\xFE" . pack('n', $len),
+            default       => "\xFF" . pack('J', $len),
+        };
+        $frame = $head . $mask . ($payload ^ str_repeat($mask, intdiv($len + 3, 4)));
+
+        stream_set_blocking($this->sock, true);
+        fwrite($this->sock, $frame);
+        stream_set_blocking($this->sock, false);
+    }
+
+    public function receive(int $timeoutMs): ?string
+    {
+        for (;;) {
+            $msg = $this->parse();
+            if ($msg !== null) {
+                return $msg;
+            }
+            $r = [$this->sock];
+            $w = $e = null;
+            if (stream_select($r, $w, $e, 0, max(0, $timeoutMs) * 1000) < 1) {
+                return null;
+            }
+            $chunk = fread($this->sock, 262144);
+            if ($chunk === '' && feof($this->sock)) {
+                throw new RuntimeException('WebSocket closed by server');
+            }
+            $this->rx .= $chunk;
+        }
+    }
+
+    /*  Takes one whole data frame off the receive buffer, if there is one. */
+    private function parse(): ?string
+    {
+        while (strlen($this->rx) >= 2) {
+            $op  = ord($this->rx[0]) & 0x0F;
+            $len = ord($this->rx[1]) & 0x7F;
+            $off = 2;
+            if ($len === 126) {
+                if (strlen($this->rx) < 4) {
+                    return null;
+                }
+                $len = unpack('n', $this->rx, 2)[1];
+                $off = 4;
+            } elseif ($len === 127) {
+                if (strlen($this->rx) < 10) {
+                    return null;
+                }
+                $len = unpack('J', $this->rx, 2)[1];
+                $off = 10;
+            }
+            if (strlen($this->rx) < $off + $len) {
+                return null;
+            }
+            $payload  = substr($this->rx, $off, $len);
+            $this->rx = substr($this->rx, $off + $len);
+            if ($op === 0x8) {
+                throw new RuntimeException('WebSocket closed by server');
+            }
+            if ($op === 0x1 || $op === 0x2) {
+                return $payload;
+            }
+        }
+        return null;
+    }
+
+    public function close(): void
+    {
+        fclose($this->sock);
+    }
+}
+
+/*──────────────────────────── Flood ──────────────────────────────────────*/
+
+function cpu_ns(): int
+{
+    $ru = getrusage();
+    return ($ru['ru_utime.tv_sec'] + $ru['ru_stime.tv_sec']) * 1_000_000_000
+         + ($ru['ru_utime.tv_usec'] + $ru['ru_stime.tv_usec']) * 1_000;
+}
+
+function percentile(array $sorted, float $p): float
+{
+    $i = (int) ceil($p * count($sorted)) - 1;
+    return $sorted[max(0, min(count($sorted) - 1, $i))];
+}
+
+/** @return array<string, int|float|string|null> */
+function flood(string $name, H3Socket|H1Socket $pub, H3Socket|H1Socket $sub,
+               int $frames, int $window, string $filler): array
+{
+    $stats0 = $name === 'h3' ? quicpro_ws_get_stats() : null;
+    $cpu0   = cpu_ns();
+    $wall0  = hrtime(true);
+
+    $latency = [];
+    $sent = 0;
+    $recv = 0;
+    $idle = 0;
+
+    while ($recv < $frames) {
+        /*  Keep at most $window messages between publisher and subscriber,
+         *  so latency reflects the path rather than an ever-growing queue. */
+        while ($sent < $frames && $sent - $recv < $window) {
+            $pub->send(pack('JJ', hrtime(true), $sent) . $filler);
+            $sent++;
+        }
+
+        $msg = $sub->receive($sent - $recv < $window ? 1 : 0);
+        if ($msg === null) {
+            /*  The server may drop messages for a slow consumer; do not
+             *  wait forever for them.                                       */
+            if (++$idle > 2_000) {
+                break;
+            }
+            continue;
+        }
+        $now  = hrtime(true);
+        $idle = 0;
+        $latency[] = ($now - unpack('J', $msg)[1]) / 1_000.0;   // → µs
+        $recv++;
+    }
+
+    $wallNs = hrtime(true) - $wall0;
+    $cpuNs  = max(1, cpu_ns() - $cpu0);
+    sort($latency);
+
+    $row = [
+        'transport'     => $name,
+        'frames'        => $recv,
+        'lost'          => $sent - $recv,
+        'size'          => strlen($filler) + 16,
+        'p50_us'        => $latency ? round(percentile($latency, 0.50), 1) : null,
+        'p99_us'        => $latency ? round(percentile($latency, 0.99), 1) : null,
+        'p999_us'       => $latency ? round(percentile($latency, 0.999), 1) : null,
+        'frames_per_s'  => round($recv / ($wallNs / 1e9)),
+        'frames_per_core_s' => round($recv / ($cpuNs / 1e9)),
+        'copied_per_frame'  => null,
+        'mask_gib_s'        => null,
+        'deflate_ratio'     => null,
+    ];
+
+    if ($stats0 !== null) {
+        $s = quicpro_ws_get_stats();
+        $d = [];
+        foreach ($s as $k => $v) {
+            $d[$k] = $v - $stats0[$k];
+        }
+        $fr = max(1, $d['frames_sent'] + $d['frames_received']);
+        $row['copied_per_frame'] = round($d['bytes_copied'] / $fr, 1);
+        $row['mask_gib_s']       = $d['mask_ns'] > 0 ? round($d['mask_bytes'] / $d['mask_ns'] / 1.073741824, 2) : null;
+        $row['deflate_ratio']    = $d['deflate_out'] > 0 ? round($d['deflate_in'] / $d['deflate_out'], 2) : null;
+    }
+    return $row;
+}
+
+$runs = match ($transport) {
+    'h3'    => ['h3'],
+    'h1'    => ['h1'],
+    default => ['h3', 'h1'],
+};
+
+foreach ($runs as $name) {
+    $open = $name === 'h3'
+        ? static fn () => new H3Socket($host, $port, $path)
+        : static fn () => new H1Socket($host, $h1Port, $path, $h1Tls);
+
+    try {
+        $sub = $open();
+        $pub = $open();
+    } catch (Throwable $e) {
+        fprintf(STDERR, "%s: %s\n", $name, $e->getMessage());
+        continue;
+    }
+
+    $row = flood($name, $pub, $sub, $frames, $window, $filler);
+    $pub->close();
+    $sub->close();
+
+    if ($asJson) {
+        echo json_encode($row), "\n";
+        continue;
+    }
+    printf(
+        "%s: %d×%d B  p50 %s µs  p99 %s µs  p999 %s µs  %d frames/s  %d frames/s/core"
+        . "  %s B copied/frame  mask %s GiB/s  deflate %s:1  (%d lost)\n",
+        $row['transport'], $row['frames'], $row['size'],
+        $row['p50_us'] ?? '-', $row['p99_us'] ?? '-', $row['p999_us'] ?? '-',
+        $row['frames_per_s'], $row['frames_per_core_s'],
+        $row['copied_per_frame'] ?? '-', $row['mask_gib_s'] ?? '-', $row['deflate_ratio'] ?? '-',
+        $row['lost']
+    );
+}
@@ -0,0 +1,58 @@
+<?php
+declare(strict_types=1);
+
+/*
+ * benchmarks/netem/server.php
+ * ─────────────────────────────────────────────────────────────────────────
+ *  The server side of the netem lab (infra/scripts/run-netem-benchmark.sh).
+ *  Serves the same responses over both transports, so a comparison only
+ *  measures the transport:
+ *
+ *    – HTTP/2 over TLS/TCP on NETEM_H2_PORT:   GET /bytes/<n>
+ *    – HTTP/3 over QUIC on NETEM_H3_PORT: the MCP call bench/bytes whose
+ *      body is <n> in decimal (what quicpro_loadgen_run()'s "mcp" sends)
+ *
+ *  Both answer <n> bytes.  The QUIC congestion controller under test is
+ *  php.ini's quicpro.transport_cc_algorithm; the runner starts this script
+ *  with -d for each one it sweeps.
+ * ─────────────────────────────────────────────────────────────────────────
+ */
+
+$h2Port = (int) (getenv('NETEM_H2_PORT') ?: 8443);
+$h3Port = (int) (getenv('NETEM_H3_PORT') ?: 4433);
+$certs  = getenv('NETEM_CERT_DIR') ?: '/workspace/var/traefik/certificates';
+$maxLen = 256 * 1024 * 1024;
+
+$config = Quicpro\Config::new([
+    'cert_file' => "{$certs}/local-cert.pem",
+    'key_file'  => "{$certs}/local-key.pem",
+]);
+
+/*  One block, sliced: the payload's content does not matter, its size does. */
+$block = str_repeat('quicpro-netem-lab', 4096);
+$bytes = static function (int $n) use ($block, $maxLen): string {
+    $n = max(0, min($n, $maxLen));
+    return substr(str_repeat($block, intdiv($n, strlen($block)) + 1), 0, $n);
+};
+
+$pid = pcntl_fork();
+if ($pid === -1) {
+    fwrite(STDERR, "fork failed\n");
+    exit(1);
+}
+
+if ($pid === 0) {
+    quicpro_http2_server_listen('0.0.0.0', $h2Port, $config, static function ($request) use ($bytes): array {
+        if (!preg_match('#^/bytes/(\d+)#', (string) $request['uri'], $m)) {
+            return ['status' => 404, 'body' => ''];
+        }
+        return ['status' => 200, 'headers' => ['content-type' => 'application/octet-stream'], 'body' => $bytes((int) $m[1])];
+    });
+    exit(0);
+}
+
+quicpro_mcp_server_register('bench', 'bytes', static fn (string $body): string => $bytes((int) $body));
+quicpro_http3_server_listen('::', $h3Port, $config, static function ($session, int $stream, bool $early): void {
+    quicpro_mcp_server_serve($session);
+});
+pcntl_waitpid($pid, $status);
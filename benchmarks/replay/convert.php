@@ -0,0 +1,110 @@
+<?php
+declare(strict_types=1);
+
+/*
+ * benchmarks/replay/convert.php
+ * ─────────────────────────────────────────────────────────────────────────
+ *  Turns the decrypted client STREAM frames that `infra/tshark/capture.sh
+ *  export` prints (tshark JSON on STDIN) into a trace for
+ *  quicpro_server_replay() on STDOUT (format: extension/include/server/
+ *  replay.h).
+ *
+ *  Retransmitted and overlapping frames are folded, so every stream's bytes
+ *  appear once and in order. A write keeps the time its bytes were first
+ *  seen, but never goes before the write ahead of it on the same stream.
+ *  Bytes the capture missed leave a gap; the stream is cut short there,
+ *  with a warning on STDERR.
+ * ─────────────────────────────────────────────────────────────────────────
+ */
+
+$packets = json_decode((string) stream_get_contents(STDIN), true);
+if (!is_array($packets)) {
+    fwrite(STDERR, "convert.php: expected the JSON of `capture.sh export` on STDIN\n");
+    exit(1);
+}
+
+/*  Every value under $key anywhere in $node, depth first. */
+function find_all(mixed $node, string $key, array &$out): void
+{
+    if (!is_array($node)) {
+        return;
+    }
+    foreach ($node as $k => $v) {
+        if ($k === $key) {
+            array_push($out, ...(is_array($v) && array_is_list($v) ? $v : [$v]));
+        } else {
+            find_all($v, $key, $out);
+        }
+    }
+}
+
+/*  Every STREAM frame (a node with a stream id) anywhere in $node. */
+function stream_frames(mixed $node, array &$out): void
+{
+    if (!is_array($node)) {
+        return;
+    }
+    if (isset($node['quic.stream.stream_id'])) {
+        $out[] = $node;
+        return;
+    }
+    foreach ($node as $v) {
+        stream_frames($v, $out);
+    }
+}
+
+/** @var array<string, list<array{t: int, off: int, data: string, fin: bool}>> $chunks "conn stream" => frames */
+$chunks = [];
+$t0 = null;
+foreach ($packets as $packet) {
+    $layers = $packet['_source']['layers'] ?? [];
+    $t = (int) round((float) ($layers['frame']['frame.time_epoch'] ?? 0) * 1e6);
+    $t0 ??= $t;
+
+    $conns = [];
+    find_all($layers['quic'] ?? [], 'quic.connection.number', $conns);
+    $frames = [];
+    stream_frames($layers['quic'] ?? [], $frames);
+    foreach ($frames as $f) {
+        $key = ($conns[0] ?? '0') . ' ' . $f['quic.stream.stream_id'];
+        $chunks[$key][] = [
+            't'    => $t - $t0,
+            'off'  => (int) ($f['quic.stream.offset'] ?? 0),
+            'data' => (string) hex2bin(str_replace(':', '', (string) ($f['quic.stream_data'] ?? ''))),
+            'fin'  => in_array(strtolower((string) ($f['quic.stream.fin'] ?? '0')), ['1', 'true'], true),
+        ];
+    }
+}
+
+/*──────────────────────────── Fold ───────────────────────────────────────*/
+
+$writes = [];
+foreach ($chunks as $key => $list) {
+    usort($list, static fn (array $a, array $b): int => [$a['off'], $a['t']] <=> [$b['off'], $b['t']]);
+    $next = 0;
+    $last = 0;
+    $done = false;
+    foreach ($list as $c) {
+        if ($done) {
+            break;
+        }
+        if ($c['off'] > $next) {
+            fprintf(STDERR, "convert.php: conn/stream %s misses bytes %d to %d, cut there\n", $key, $next, $c['off']);
+            break;
+        }
+        $data = (string) substr($c['data'], $next - $c['off']);
+        if ($data === '' && !$c['fin']) {
+            continue;                           // A retransmission of what we have
+        }
+        $last = max($last, $c['t']);
+        $next += strlen($data);
+        $done = $c['fin'];
+        $writes[] = [$last, $key, $c['fin'], $data];
+    }
+}
+usort($writes, static fn (array $a, array $b): int => $a[0] <=> $b[0]);
+
+echo "# quicpro replay trace: ", count($packets), " packets, ", count($chunks), " streams\n";
+foreach ($writes as [$t, $key, $fin, $data]) {
+    printf("%d %s %d %s\n", $t, $key, $fin ? 1 : 0, $data === '' ? '-' : bin2hex($data));
+}
@@ -16,7 +16,88 @@ if test "$PHP_QUICPRO_ASYNC" != "no"; then
     AC_MSG_ERROR([libcurl not found. Please install libcurl development package or specify its path.])
   ])
 
+  dnl Optional io_uring engine (quicpro.io_engine_use_uring)
+  PHP_CHECK_LIBRARY(uring, io_uring_setup_buf_ring,
+  [
+    PHP_ADD_LIBRARY(uring, 1, QUICPRO_ASYNC_SHARED_LIBADD)
+    AC_DEFINE(QUICPRO_HAVE_LIBURING, 1, [Build the io_uring I/O engine])
+  ],[
+    AC_MSG_WARN([liburing >= 2.4 not found; io_uring engine disabled, falling back to recvmmsg/sendmmsg.])
+  ])
+
+  dnl Optional zlib for WebSocket permessage-deflate and gzip responses (quicpro.websocket_deflate_enable, server/compress.c)
+  PHP_CHECK_LIBRARY(z, deflateInit2_,
+  [
+    PHP_ADD_LIBRARY(z, 1, QUICPRO_ASYNC_SHARED_LIBADD)
+    AC_DEFINE(QUICPRO_HAVE_ZLIB, 1, [Build WebSocket permessage-deflate])
+  ],[
+    AC_MSG_WARN([zlib not found; WebSocket connections will not negotiate permessage-deflate, responses will not be gzipped.])
+  ])
+
+  dnl Optional ISA-L for the SIMD erasure coding of quicpro-fs:// (object_store/erasure.c)
+  PHP_CHECK_LIBRARY(isal, ec_encode_data,
+  [
+    PHP_ADD_LIBRARY(isal, 1, QUICPRO_ASYNC_SHARED_LIBADD)
+    AC_DEFINE(QUICPRO_HAVE_ISAL, 1, [Erasure-code object store chunks with ISA-L])
+  ],[
+    AC_MSG_WARN([ISA-L not found; quicpro-fs:// erasure coding uses the portable table-driven encoder.])
+  ])
+
+  dnl Optional libblake3 for the SIMD chunk hashes of quicpro-fs:// (object_store/blake3.c)
+  PHP_CHECK_LIBRARY(blake3, blake3_hasher_init,
+  [
+    PHP_ADD_LIBRARY(blake3, 1, QUICPRO_ASYNC_SHARED_LIBADD)
+    AC_DEFINE(QUICPRO_HAVE_BLAKE3, 1, [Hash deduplicated object store chunks with libblake3])
+  ],[
+    AC_MSG_WARN([libblake3 not found; quicpro-fs:// chunk hashes use the portable implementation.])
+  ])
+
+  dnl Optional nghttp2 for the native HTTP/2 client (client/http2.c)
+  PHP_CHECK_LIBRARY(nghttp2, nghttp2_session_client_new,
+  [
+    PHP_ADD_LIBRARY(nghttp2, 1, QUICPRO_ASYNC_SHARED_LIBADD)
+    AC_DEFINE(QUICPRO_HAVE_NGHTTP2, 1, [Build the native HTTP/2 client on nghttp2])
+  ],[
+    AC_MSG_WARN([libnghttp2 not found; quicpro_http2_request_send() will throw, use the libcurl client instead.])
+  ])
+
+  dnl Optional libbrotlienc for brotli response compression (server/compress.c)
+  PHP_CHECK_LIBRARY(brotlienc, BrotliEncoderCompressStream,
+  [
+    PHP_ADD_LIBRARY(brotlienc, 1, QUICPRO_ASYNC_SHARED_LIBADD)
+    AC_DEFINE(QUICPRO_HAVE_BROTLI, 1, [Compress responses with brotli])
+  ],[
+    AC_MSG_WARN([libbrotlienc not found; quicpro.http_auto_compress will skip "brotli".])
+  ])
+
+  dnl Optional libzstd for ZSTD-compressed Parquet pages in DataFrame scans and zstd responses (dataframe/parquet.c, server/compress.c)
+  PHP_CHECK_LIBRARY(zstd, ZSTD_decompress,
+  [
+    PHP_ADD_LIBRARY(zstd, 1, QUICPRO_ASYNC_SHARED_LIBADD)
+    AC_DEFINE(QUICPRO_HAVE_ZSTD, 1, [Read ZSTD-compressed Parquet pages with libzstd])
+  ],[
+    AC_MSG_WARN([libzstd not found; DataFrame::scan() will not read ZSTD-compressed Parquet pages.])
+  ])
+
+  dnl Optional CUDA runtime for Quicpro\Gpu\Tensor and its memory and stream pools (gpu/device.c)
+  PHP_CHECK_LIBRARY(cudart, cudaMalloc,
+  [
+    PHP_ADD_LIBRARY(cudart, 1, QUICPRO_ASYNC_SHARED_LIBADD)
+    AC_DEFINE(QUICPRO_HAVE_CUDA, 1, [Place tensors on the GPU with the CUDA runtime])
+  ],[
+    AC_MSG_WARN([libcudart not found; quicpro.gpu_bindings_enable will have no device to use.])
+  ])
+
+  dnl Optional NCCL for Quicpro\Gpu\Collective: P2P, NVLink and GPUDirect RDMA between agents' GPUs (gpu/collective.c)
+  PHP_CHECK_LIBRARY(nccl, ncclCommInitRank,
+  [
+    PHP_ADD_LIBRARY(nccl, 1, QUICPRO_ASYNC_SHARED_LIBADD)
+    AC_DEFINE(QUICPRO_HAVE_NCCL, 1, [Run GPU collectives with NCCL])
+  ],[
+    AC_MSG_WARN([libnccl not found; Quicpro\Gpu\Collective will not be available.])
+  ])
+
   PHP_SUBST(QUICPRO_ASYNC_SHARED_LIBADD)
-  PHP_NEW_EXTENSION(quicpro_async, cancel.c cluster.c config.c connect.c http3.c iibin.c iibin_decoding.c iibin_encoding.c iibin_schema.c mcp.c php_quicpro.c pipeline_orchestrator.c poll.c quicpro_ini.c session.c tls.c tool_handler_registry.c websocket.c cors/cors.c config/http2/default.c config/http2/ini.c config/http2/index.c config/http2/base_layer.c config/http2/config.c config/bare_metal_tuning/default.c config/bare_metal_tuning/ini.c config/bare_metal_tuning/index.c config/bare_metal_tuning/base_layer.c config/bare_metal_tuning/config.c config/smart_contracts/default.c config/smart_contracts/ini.c config/smart_contracts/index.c config/smart_contracts/base_layer.c config/smart_contracts/config.c config/quic_transport/default.c config/quic_transport/ini.c config/quic_transport/index.c config/quic_transport/base_layer.c config/quic_transport/config.c config/tls_and_crypto/default.c config/tls_and_crypto/ini.c config/tls_and_crypto/index.c config/tls_and_crypto/default.h config/tls_and_crypto/base_layer.c config/tls_and_crypto/config.c config/native_cdn/default.c config/native_cdn/ini.c config/native_cdn/index.c config/native_cdn/default.h config/native_cdn/base_layer.c config/native_cdn/config.c config/open_telemetry/default.c config/open_telemetry/ini.c config/open_telemetry/index.c config/open_telemetry/default.h config/open_telemetry/base_layer.c config/open_telemetry/config.c config/iibin/default.c config/iibin/ini.c config/iibin/index.c config/iibin/base_layer.c config/iibin/config.c config/security_and_traffic/default.c config/security_and_traffic/ini.c config/security_and_traffic/index.c config/security_and_traffic/base_layer.c config/security_and_traffic/config.c config/cloud_autoscale/default.c config/cloud_autoscale/ini.c config/cloud_autoscale/index.c config/cloud_autoscale/base_layer.c config/cloud_autoscale/config.c config/tcp_transport/default.c config/tcp_transport/ini.c config/tcp_transport/index.c config/tcp_transport/base_layer.c config/tcp_transport/config.c config/mcp_and_orchestrator/default.c config/mcp_and_orchestrator/ini.c config/mcp_and_orchestrator/index.c config/mcp_and_orchestrator/base_layer.c config/mcp_and_orchestrator/config.c config/semantic_geometry/default.c config/semantic_geometry/ini.c config/semantic_geometry/index.c config/semantic_geometry/base_layer.c config/semantic_geometry/config.c config/router_and_loadbalancer/default.c config/router_and_loadbalancer/ini.c config/router_and_loadbalancer/index.c config/router_and_loadbalancer/base_layer.c config/router_and_loadbalancer/config.c config/cluster_and_process/default.c config/cluster_and_process/ini.c config/cluster_and_process/index.c config/cluster_and_process/base_layer.c config/cluster_and_process/config.c config/dynamic_admin_api/default.c config/dynamic_admin_api/ini.c config/dynamic_admin_api/index.c config/dynamic_admin_api/base_layer.c config/dynamic_admin_api/config.c config/app_http3_websockets_webtransport/default.c config/app_http3_websockets_webtransport/ini.c config/app_http3_websockets_webtransport/index.c config/app_http3_websockets_webtransport/base_layer.c config/app_http3_websockets_webtransport/config.c config/high_perf_compute_and_ai/default.c config/high_perf_compute_and_ai/ini.c config/high_perf_compute_and_ai/index.c config/high_perf_compute_and_ai/base_layer.c config/high_perf_compute_and_ai/config.c config/state_management/default.c config/state_management/ini.c config/state_management/index.c config/state_management/base_layer.c config/state_management/config.c config/smart_dns/default.c config/smart_dns/ini.c config/smart_dns/index.c config/smart_dns/base_layer.c config/smart_dns/config.c config/native_object_store/default.c config/native_object_store/ini.c config/native_object_store/index.c config/native_object_store/base_layer.c config/native_object_store/config.c config/ssh_over_quic/default.c config/ssh_over_quic/ini.c config/ssh_over_quic/index.c config/ssh_over_quic/base_layer.c config/ssh_over_quic/config.c src/validation/config_param/validate_bool.c src/validation/config_param/validate_positive_long.c src/validation/config_param/validate_host_string.c src/validation/config_param/validate_erasure_coding_shards_string.c src/validation/config_param/validate_string_from_allowlist.c src/validation/config_param/validate_cpu_affinity_map_string.c src/validation/config_param/validate_comma_separated_string_from_allowlist.c src/validation/config_param/validate_readable_file_path.c src/validation/config_param/validate_double_range.c src/validation/config_param/validate_colon_separated_string_from_allowlist.c src/validation/config_param/validate_generic_string.c src/validation/config_param/validate_scale_up_policy_string.c src/validation/config_param/validate_cors_origin_string.c src/validation/config_param/validate_string.c src/validation/config_param/validate_scheduler_policy.c src/validation/config_param/validate_long_range.c src/validation/config_param/validate_niceness_value.c src/validation/config_param/validate_comma_separated_numeric_string.c src/validation/config_param/validate_non_negative_long.c, $(PHP_QUICPRO_ASYNC_SOURCES)
+  PHP_NEW_EXTENSION(quicpro_async, cancel.c cluster.c cluster_stats.c shm_cache.c topology.c bus.c cgroup.c cloud_autoscale.c config.c config/runtime.c connect.c http3.c iibin.c iibin_decoding.c iibin_encoding.c iibin_schema.c iibin_program.c iibin_registry.c iibin_view.c iibin_batch.c iibin_descriptor.c iibin_arena.c iibin_shm.c mcp.c mcp_breaker.c mcp_server.c php_quicpro.c pipeline_orchestrator.c poll.c poll/udp_batch.c poll/uring.c poll/xdp.c poll/timer_wheel.c poll/reactor.c poll/scheduler.c poll/txstamp.c poll/busy_poll.c poll/event_loop.c poll/hibernate.c server/reuseport.c server/cid.c server/retry.c server/replay.c server/slab.c server/path.c server/zero_rtt.c server/rate_limit.c server/conn_snapshot.c server/open_telemetry.c server/otlp.c server/metrics.c server/qlog.c server/capture.c server/conn_stats.c server/profiler.c server/live_config.c server/admin_events.c server/cdn_cache.c server/cdn_disk.c server/ticket_keys.c server/tls_offload.c server/router.c server/proxy.c server/ktls.c server/cert_store.c server/cert_watch.c server/ocsp.c server/tcp_listen.c server/h2_flow.c server/h3_settings.c server/compress.c server/hint_learner.c server/cancel.c server/io_thread.c server/overload.c server/access_log.c server/http1_parser.c server/http1_head.c server/tls_output.c server/header_template.c server/request.c server/body_spool.c client/pool.c client/dns.c client/alt_svc.c client/index.c client/ticket_cache.c client/mux.c client/http2.c client/datagram.c client/dgram_fec.c client/multipath.c client/body.c client/stream_writer.c client/loadgen.c http_client/http_client.c object_store/erasure.c object_store/at_rest.c object_store/object_store.c object_store/metadata_cache.c object_store/stream.c object_store/cdc.c object_store/blake3.c smart_dns/zone.c smart_dns/dns_server.c smart_dns/service_discovery.c smart_dns/doq.c ssh_over_quic/gateway.c state/state.c state/state_cache.c state/redis.c dataframe/column.c dataframe/morsel.c dataframe/kernels.c dataframe/group_by.c dataframe/dataframe.c dataframe/arrow_ipc.c dataframe/parquet.c dataframe/scan.c gpu/device.c gpu/tensor.c gpu/collective.c semantic_geometry/kernels.c semantic_geometry/polytope.c semantic_geometry/geometry.c semantic_geometry/hnsw.c semantic_geometry/index.c semantic_geometry/spiral.c semantic_geometry/space.c smart_contracts/json.c smart_contracts/keccak.c smart_contracts/abi.c smart_contracts/event_listener.c server/ws_frame.c server/ws_deflate.c server/webtransport.c quicpro_ini.c session.c tls.c tool_handler_registry.c endpoint_balancer.c step_cache.c checkpoint.c retry_budget.c prewarm.c websocket.c server/cors.c server/priority.c server/congestion.c server/xdp_filter.c config/http2/default.c config/http2/ini.c config/http2/index.c config/http2/base_layer.c config/http2/config.c config/bare_metal_tuning/default.c config/bare_metal_tuning/ini.c config/bare_metal_tuning/index.c config/bare_metal_tuning/base_layer.c config/bare_metal_tuning/config.c config/smart_contracts/default.c config/smart_contracts/ini.c config/smart_contracts/index.c config/smart_contracts/base_layer.c config/smart_contracts/config.c config/quic_transport/default.c config/quic_transport/ini.c config/quic_transport/index.c config/quic_transport/base_layer.c config/quic_transport/config.c config/tls_and_crypto/default.c config/tls_and_crypto/ini.c config/tls_and_crypto/index.c config/tls_and_crypto/default.h config/tls_and_crypto/base_layer.c config/tls_and_crypto/config.c config/native_cdn/default.c config/native_cdn/ini.c config/native_cdn/index.c config/native_cdn/default.h config/native_cdn/base_layer.c config/native_cdn/config.c config/open_telemetry/default.c config/open_telemetry/ini.c config/open_telemetry/index.c config/open_telemetry/default.h config/open_telemetry/base_layer.c config/open_telemetry/config.c config/iibin/default.c config/iibin/ini.c config/iibin/index.c config/iibin/base_layer.c config/iibin/config.c config/security_and_traffic/default.c config/security_and_traffic/ini.c config/security_and_traffic/index.c config/security_and_traffic/base_layer.c config/security_and_traffic/config.c config/cloud_autoscale/default.c config/cloud_autoscale/ini.c config/cloud_autoscale/index.c config/cloud_autoscale/base_layer.c config/cloud_autoscale/config.c config/tcp_transport/default.c config/tcp_transport/ini.c config/tcp_transport/index.c config/tcp_transport/base_layer.c config/tcp_transport/config.c config/mcp_and_orchestrator/default.c config/mcp_and_orchestrator/ini.c config/mcp_and_orchestrator/index.c config/mcp_and_orchestrator/base_layer.c config/mcp_and_orchestrator/config.c config/semantic_geometry/default.c config/semantic_geometry/ini.c config/semantic_geometry/index.c config/semantic_geometry/base_layer.c config/semantic_geometry/config.c config/router_and_loadbalancer/default.c config/router_and_loadbalancer/ini.c config/router_and_loadbalancer/index.c config/router_and_loadbalancer/base_layer.c config/router_and_loadbalancer/config.c config/cluster_and_process/default.c config/cluster_and_process/ini.c config/cluster_and_process/index.c config/cluster_and_process/base_layer.c config/cluster_and_process/config.c config/dynamic_admin_api/default.c config/dynamic_admin_api/ini.c config/dynamic_admin_api/index.c config/dynamic_admin_api/base_layer.c config/dynamic_admin_api/config.c config/app_http3_websockets_webtransport/default.c config/app_http3_websockets_webtransport/ini.c config/app_http3_websockets_webtransport/index.c config/app_http3_websockets_webtransport/base_layer.c config/app_http3_websockets_webtransport/config.c config/high_perf_compute_and_ai/default.c config/high_perf_compute_and_ai/ini.c config/high_perf_compute_and_ai/index.c config/high_perf_compute_and_ai/base_layer.c config/high_perf_compute_and_ai/config.c config/state_management/default.c config/state_management/ini.c config/state_management/index.c config/state_management/base_layer.c config/state_management/config.c config/smart_dns/default.c config/smart_dns/ini.c config/smart_dns/index.c config/smart_dns/base_layer.c config/smart_dns/config.c config/native_object_store/default.c config/native_object_store/ini.c config/native_object_store/index.c config/native_object_store/base_layer.c config/native_object_store/config.c config/ssh_over_quic/default.c config/ssh_over_quic/ini.c config/ssh_over_quic/index.c config/ssh_over_quic/base_layer.c config/ssh_over_quic/config.c src/validation/config_param/validate_bool.c src/validation/config_param/validate_positive_long.c src/validation/config_param/validate_host_string.c src/validation/config_param/validate_erasure_coding_shards_string.c src/validation/config_param/validate_string_from_allowlist.c src/validation/config_param/validate_cpu_affinity_map_string.c src/validation/config_param/validate_comma_separated_string_from_allowlist.c src/validation/config_param/validate_readable_file_path.c src/validation/config_param/validate_double_range.c src/validation/config_param/validate_colon_separated_string_from_allowlist.c src/validation/config_param/validate_generic_string.c src/validation/config_param/validate_scale_up_policy_string.c src/validation/config_param/validate_cors_origin_string.c src/validation/config_param/validate_string.c src/validation/config_param/validate_scheduler_policy.c src/validation/config_param/validate_long_range.c src/validation/config_param/validate_niceness_value.c src/validation/config_param/validate_comma_separated_numeric_string.c src/validation/config_param/validate_non_negative_long.c, $(PHP_QUICPRO_ASYNC_SOURCES)
   PHP_ADD_BUILD_DIR($(LIBEVENT_DIR))
 fi
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef QUICPRO_CLIENT_ALT_SVC_H
+#define QUICPRO_CLIENT_ALT_SVC_H
+
+#include <php.h>
+#include <stdbool.h>
+
+/**
+ * @file extension/include/client/alt_svc.h
+ * @brief Per-process Alt-Svc cache (RFC 7838) for the unified client.
+ *
+ * A server reached over TCP announces HTTP/3 with a response header such
+ * as `Alt-Svc: h3=":443"; ma=86400`, e.g. a quicpro server with
+ * `quicpro.http_advertise_h3_alt_svc`. The unified client
+ * (include/client/index.h) records every "h3" alternative of the origin
+ * here, for its `ma` seconds (24 hours without one), and sends later
+ * requests to that origin over QUIC. `Alt-Svc: clear` forgets the origin.
+ * Only alternatives on the origin's own host are kept: the certificate
+ * is checked against the origin's name either way, and a different host
+ * would need a second DNS lookup for no gain.
+ *
+ * Where UDP is blocked, the QUIC attempt gets no answer and the client
+ * falls back to TCP. The origin's alternative is then marked broken for
+ * 5 minutes, doubling with each failure in a row up to 48 hours, so a
+ * blocked network pays the fallback delay once rather than per request.
+ * A request that completes over QUIC clears the failure count.
+ *
+ * The cache lives in process memory, like the DNS cache
+ * (include/client/dns.h): each worker learns on its own.
+ */
+
+/**
+ * @brief Records the alternatives of an `Alt-Svc` header value received
+ * from `host`:`port`. Entries other than "h3" are ignored.
+ */
+void quicpro_alt_svc_learn(const char *host, zend_long port, const char *value, size_t value_len);
+
+/**
+ * @brief The UDP port `host`:`port` announced for HTTP/3, or 0 when it
+ * announced none, the entry expired or it is marked broken.
+ */
+zend_long quicpro_alt_svc_h3_port(const char *host, zend_long port);
+
+/** @brief Marks the origin's HTTP/3 alternative broken after a failed attempt. */
+void quicpro_alt_svc_mark_broken(const char *host, zend_long port);
+
+/** @brief Clears the origin's failure count after a request over HTTP/3 succeeded. */
+void quicpro_alt_svc_mark_working(const char *host, zend_long port);
+
+/** @brief Frees the process-wide cache (MSHUTDOWN). */
+void quicpro_alt_svc_mshutdown(void);
+
+#endif // QUICPRO_CLIENT_ALT_SVC_H
@@ -0,0 +1,45 @@
+#ifndef QUICPRO_CLIENT_BODY_H
+#define QUICPRO_CLIENT_BODY_H
+
+#include <php.h>
+#include <quiche.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zend_smart_str.h>
+
+/**
+ * @file extension/include/client/body.h
+ * @brief Response bodies received in place into their final zend_string.
+ *
+ * quiche_h3_recv_body() writes straight into the free tail of a
+ * smart_str, so a body is copied once, out of quiche, and never through
+ * a stack buffer. When the response announces its Content-Length the
+ * string is allocated at that size before the first byte arrives (up to
+ * QUICPRO_BODY_RESERVE_MAX; a larger claim is not trusted with memory
+ * up front). Otherwise the string doubles whenever it is full, so a
+ * 100 MB download takes about a dozen reallocations instead of one per
+ * chunk, and the large ones grow in place where the allocator can.
+ *
+ * quicpro_body_take() hands the string over, giving back what doubling
+ * over-allocated.
+ */
+
+#define QUICPRO_BODY_MIN_ROOM     16384                 /* First allocation without a length */
+#define QUICPRO_BODY_RESERVE_MAX  (256 * 1024 * 1024)   /* Largest Content-Length allocated up front */
+
+/** @brief Parses a Content-Length value; -1 if it is not a plain decimal. */
+zend_long quicpro_body_length(const uint8_t *value, size_t len);
+
+/** @brief Sizes `body` for `expected` more bytes; a no-op for unknown (< 0) lengths. */
+void quicpro_body_reserve(smart_str *body, zend_long expected);
+
+/**
+ * @brief Receives everything quiche holds for `stream_id` into `body`.
+ * @return QUICHE_H3_ERR_DONE once the stream is drained, or the quiche error.
+ */
+ssize_t quicpro_body_recv_h3(quiche_h3_conn *h3, quiche_conn *conn, uint64_t stream_id, smart_str *body);
+
+/** @brief Moves the finished body out of `body` (never NULL; empty if nothing arrived). */
+zend_string *quicpro_body_take(smart_str *body);
+
+#endif /* QUICPRO_CLIENT_BODY_H */
@@ -0,0 +1,55 @@
+#ifndef QUICPRO_CLIENT_DATAGRAM_H
+#define QUICPRO_CLIENT_DATAGRAM_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "client/session.h"
+
+/**
+ * @file extension/include/client/datagram.h
+ * @brief Batched QUIC DATAGRAM frames (RFC 9221) on a session.
+ *
+ * Telemetry at 100k datagrams per second cannot afford a PHP call, a zval
+ * and a scratch buffer per datagram. These functions move whole batches
+ * between quiche's datagram queues and PHP:
+ *
+ *     quicpro_datagram_send_batch($session, $frames);      // list of strings
+ *     foreach (quicpro_datagram_recv_batch($session, 0, 10) as $d) { ... }
+ *
+ * The packed variants skip the per-datagram zval as well. A batch is then
+ * one string of records, each a 16-bit big-endian length followed by that
+ * many payload bytes:
+ *
+ *     $buf = quicpro_datagram_recv_packed($session);
+ *     for ($off = 0; $off < strlen($buf); $off += 2 + $len) {
+ *         $len = unpack('n', $buf, $off)[1];
+ *         handle(substr($buf, $off + 2, $len));
+ *     }
+ *
+ * quiche copies every datagram into its queue once. Beyond that nothing is
+ * copied: received datagrams are read straight into the result string, and
+ * outgoing payloads are handed to quiche from the caller's string.
+ *
+ * A receive call takes at most quicpro.transport_dgram_recv_queue_len
+ * datagrams, the size of quiche's queue. A send call flushes the
+ * connection whenever quicpro.transport_dgram_send_queue_len entries are
+ * waiting, so a batch may be longer than the queue. Datagrams need
+ * quicpro.transport_datagrams_enable on both peers. A connection that
+ * carries a WebTransport session reads its datagrams through
+ * quicpro_webtransport_poll() instead.
+ *
+ * With quicpro.transport_dgram_fec_source_symbols set, all four functions
+ * add Reed-Solomon repair datagrams to what they send and rebuild lost
+ * datagrams from them on receipt (include/client/dgram_fec.h). Received
+ * datagrams then pass through one receive buffer on their way to PHP.
+ */
+
+PHP_FUNCTION(quicpro_datagram_send_batch);
+PHP_FUNCTION(quicpro_datagram_send_packed);
+PHP_FUNCTION(quicpro_datagram_recv_batch);
+PHP_FUNCTION(quicpro_datagram_recv_packed);
+PHP_FUNCTION(quicpro_datagram_fec_stats);
+
+#endif // QUICPRO_CLIENT_DATAGRAM_H
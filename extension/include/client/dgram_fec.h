@@ -0,0 +1,108 @@
+#ifndef QUICPRO_CLIENT_DGRAM_FEC_H
+#define QUICPRO_CLIENT_DGRAM_FEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "client/session.h"
+
+/**
+ * @file extension/include/client/dgram_fec.h
+ * @brief Forward error correction for QUIC DATAGRAM frames.
+ *
+ * A lost datagram is gone: there is no retransmission, and waiting for
+ * one would cost a feed more than the datagram was worth. With
+ *
+ *     quicpro.transport_dgram_fec_source_symbols = 8
+ *     quicpro.transport_dgram_fec_repair_symbols = 2
+ *
+ * the quicpro_datagram_*() functions send every 8 datagrams as a block,
+ * followed by 2 repair datagrams: Reed-Solomon parity over the block
+ * (object_store/erasure.h, with ISA-L's SIMD kernels where built with
+ * them). Any 2 of the 10 may be lost and the receiver rebuilds the
+ * missing ones as soon as the block's last repair arrives, without
+ * asking the sender for anything. The cost is fixed: 2 datagrams in 10,
+ * plus 6 bytes per datagram and 7 per repair.
+ *
+ * A send call that ends with a block not yet full sends its repairs at
+ * once, over the datagrams it has, so no datagram waits for the next
+ * call to be protected. Datagrams are handed to the application when
+ * they arrive; rebuilt ones follow when they are rebuilt, out of order.
+ * Feeds that care carry their own sequence numbers.
+ *
+ * Both peers need the setting: the framing is not negotiated. The
+ * receiver takes the block size and repair count from each repair, so
+ * only the sender's values matter. The receiver keeps the last
+ * QUICPRO_DGRAM_FEC_WINDOW blocks; a repair arriving later than that
+ * rebuilds nothing.
+ *
+ * Wire format, all integers big-endian:
+ *
+ *     source:  u8 0, u16 block, u8 index,                 u16 length, payload
+ *     repair:  u8 1, u16 block, u8 k + j, u8 k, u8 m, u8 n, parity
+ *
+ * A block's symbol i (i < k) is "u16 length, payload", zero-padded to
+ * the longest of the block; symbols n..k-1 of a short block are empty.
+ * Parity j is the j-th parity symbol over them.
+ */
+
+#define QUICPRO_DGRAM_FEC_OVERHEAD 9    /* Room a payload leaves in the path's datagram size */
+#define QUICPRO_DGRAM_FEC_WINDOW   4    /* Blocks the receiver keeps */
+
+typedef struct {
+    uint64_t blocks_sent;
+    uint64_t repairs_sent;
+    uint64_t repairs_dropped;   /* Send queue full; the block went unprotected */
+    uint64_t repairs_received;
+    uint64_t recovered;         /* Datagrams rebuilt from repairs */
+    uint64_t unrecovered;       /* Datagrams of a block missing more than its repairs could rebuild */
+    uint64_t malformed;         /* Datagrams without FEC framing, dropped */
+} quicpro_dgram_fec_stats_t;
+
+/* Called with each datagram the receiver hands on, received or rebuilt */
+typedef void (*quicpro_dgram_fec_deliver_t)(void *ctx, const uint8_t *payload, size_t len);
+
+/**
+ * @brief The FEC state of a session, from the quic_transport settings.
+ * NULL where quicpro.transport_dgram_fec_source_symbols is 0.
+ * `symbol_max`: the largest datagram either direction carries.
+ */
+quicpro_dgram_fec_t *quicpro_dgram_fec_create(size_t symbol_max);
+
+/** @brief Frees the state; NULL is fine. */
+void quicpro_dgram_fec_free(quicpro_dgram_fec_t *fec);
+
+/**
+ * @brief Frames `payload` as the next source datagram of the current
+ * block. The result, valid until the next call, is only counted in the
+ * block once quicpro_dgram_fec_sent() says it was queued.
+ */
+const uint8_t *quicpro_dgram_fec_frame(quicpro_dgram_fec_t *fec, const uint8_t *payload, size_t len, size_t *wire_len);
+
+/** @brief Takes the framed datagram into its block. True when the block is full. */
+bool quicpro_dgram_fec_sent(quicpro_dgram_fec_t *fec);
+
+/**
+ * @brief Computes the repairs of the current block, if it has any
+ * datagrams, and starts the next. wire[j] and wire_len[j] are the repair
+ * datagrams, valid until the next frame; their number is returned.
+ */
+unsigned quicpro_dgram_fec_repair(quicpro_dgram_fec_t *fec, const uint8_t **wire, size_t *wire_len);
+
+/** @brief Counts a repair the send queue had no room for. */
+void quicpro_dgram_fec_repair_dropped(quicpro_dgram_fec_t *fec);
+
+/**
+ * @brief Takes one received datagram: hands on its payload if it is a
+ * source, and any datagrams it lets the receiver rebuild.
+ */
+void quicpro_dgram_fec_receive(quicpro_dgram_fec_t *fec, const uint8_t *wire, size_t len,
+                               quicpro_dgram_fec_deliver_t deliver, void *ctx);
+
+/** @brief A receive buffer of the largest datagram, owned by `fec`. */
+uint8_t *quicpro_dgram_fec_rx_buffer(quicpro_dgram_fec_t *fec, size_t *cap);
+
+const quicpro_dgram_fec_stats_t *quicpro_dgram_fec_stats(const quicpro_dgram_fec_t *fec);
+
+#endif // QUICPRO_CLIENT_DGRAM_FEC_H
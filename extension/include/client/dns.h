@@ -0,0 +1,47 @@
+#ifndef QUICPRO_CLIENT_DNS_H
+#define QUICPRO_CLIENT_DNS_H
+
+#include <php.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+/**
+ * @file extension/include/client/dns.h
+ * @brief Stub resolver with a per-process TTL cache for client connects.
+ *
+ * getaddrinfo() blocks for as long as the resolver takes and reports no
+ * TTL, so every connect paid a full lookup. This resolver asks the
+ * nameservers from /etc/resolv.conf for A and AAAA records in parallel
+ * over one non-blocking UDP socket, bounded by
+ * `quicpro.transport_dns_timeout_ms`, and caches the answer for its TTL
+ * (capped by `quicpro.transport_dns_cache_max_ttl_sec`; 0 disables the
+ * cache). Once one family has answered, the other gets 50 ms more
+ * (RFC 8305 §3, Resolution Delay) before the lookup completes without it.
+ *
+ * Numeric addresses need no lookup, /etc/hosts is consulted first, and
+ * single-label names (search domains), truncated answers and hosts
+ * without a usable resolv.conf fall back to getaddrinfo().
+ */
+
+#define QUICPRO_DNS_MAX_ADDRS 16
+
+typedef struct {
+    struct sockaddr_storage addr;
+    socklen_t               len;
+} quicpro_dns_addr_t;
+
+/**
+ * @brief Resolves `host` and fills `out` with addresses carrying `port`,
+ * ordered for Happy Eyeballs (RFC 8305 §4): IPv6 first, then alternating
+ * between the families.
+ *
+ * @param family AF_UNSPEC for both families, or AF_INET / AF_INET6 only.
+ * @return The number of addresses (> 0), or -1 after a NetworkException
+ * has been thrown.
+ */
+int quicpro_dns_resolve(const char *host, uint16_t port, int family, quicpro_dns_addr_t *out, int max);
+
+/** @brief Frees the process-wide cache (MSHUTDOWN). */
+void quicpro_dns_mshutdown(void);
+
+#endif // QUICPRO_CLIENT_DNS_H
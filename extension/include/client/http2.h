@@ -5,75 +5,50 @@
 
 /**
  * @file extension/include/client/http2.h
- * @brief Public API declarations for the Quicpro HTTP/2 Client.
+ * @brief Native HTTP/2 client on nghttp2, multiplexing requests per origin.
  *
- * This header defines the PHP-callable function that enables making
- * HTTP/2 requests. It serves as the primary interface for users who
- * explicitly wish to utilize the HTTP/2 protocol for their outbound
- * client-side communications. The design emphasizes a clear and efficient
- * API that abstracts the complexities of the HTTP/2 protocol, including
- * stream multiplexing and connection management, leveraging the libcurl library.
+ * libcurl (include/http_client/http_client.h) opens streams one easy
+ * handle at a time, and its HTTP/2 framing is beyond our control. This
+ * client speaks HTTP/2 itself through nghttp2, the library behind
+ * server/http2.c. Each origin (host, port and TLS options) gets one TLS
+ * connection, negotiated as "h2" through ALPN, and every request to that
+ * origin becomes a stream on it. quicpro_http2_request_send_multi()
+ * issues a whole set of requests at once, e.g. a fan-out to gRPC
+ * backends. It opens as many streams as the peer's
+ * SETTINGS_MAX_CONCURRENT_STREAMS and `quicpro.http2_max_concurrent_streams`
+ * allow; the rest start as earlier streams finish.
  *
- * The `quicpro_http2_request_send` function is crafted to be a comprehensive
- * endpoint for dispatching HTTP/2 requests, offering precise control over
- * request parameters and behavior, while ensuring high performance and reliability
- * through its libcurl backend, which inherently handles HTTP/2 features like
- * multiplexing over a single TCP connection.
- */
-
-/**
- * @brief Sends an HTTP/2 request to a specified URL.
- *
- * This function allows PHP userland applications to perform HTTP/2 requests
- * with fine-grained control over various aspects of the request and response.
- * It acts as a specialized wrapper around the more generic `quicpro_http_request_send`
- * (which internally uses libcurl), explicitly setting the HTTP version to 2.0
- * and enabling HTTP/2-specific optimizations like connection multiplexing.
+ * Frames are not written one at a time. Each round drains nghttp2's
+ * output (HEADERS, DATA, WINDOW_UPDATE and SETTINGS ACK frames of every
+ * stream) into one buffer and passes it to a single SSL_write. The
+ * connection is set up from the `http2` config module:
+ * - SETTINGS_INITIAL_WINDOW_SIZE is `quicpro.http2_initial_window_size`.
+ * - SETTINGS_MAX_FRAME_SIZE and SETTINGS_MAX_HEADER_LIST_SIZE come from
+ *   the corresponding directives.
+ * - The connection window is widened to the stream window times the
+ *   stream limit, so parallel downloads never starve each other.
+ * - Both then grow with the measured bandwidth-delay product, up to
+ *   `quicpro.http2_max_connection_window` (include/server/h2_flow.h).
+ * - Server push is refused.
  *
- * The parameters are designed to encompass typical HTTP request components,
- * providing flexibility for a wide array of use cases from simple GET requests
- * to complex POST operations with custom headers and large bodies.
- * HTTP/2 benefits such as efficient header compression (HPACK) and stream
- * prioritization are managed by libcurl internally.
+ * Connections stay open for later calls of the same PHP request, like
+ * the QUIC client pool (include/client/pool.h) and under its idle
+ * settings: `quicpro.transport_client_pool_idle_timeout_ms` closes idle
+ * connections. Anything the peer sent while a connection sat idle is
+ * read before it is reused, so a GOAWAY is noticed first. Every
+ * connection is closed at request end.
  *
- * @param url_str The target URL for the HTTP/2 request (e.g., "https://example.com/api").
- * This parameter is mandatory. HTTP/2 typically requires HTTPS.
- * @param url_len The length of the `url_str`.
- * @param method_str The HTTP method (e.g., "GET", "POST", "PUT", "DELETE").
- * Defaults to "GET" if not provided.
- * @param method_len The length of the `method_str`.
- * @param headers_array An optional associative PHP array of request headers.
- * Example: `['Content-Type' => 'application/json', 'X-Custom-Header' => 'value']`.
- * Headers are added to the request as key-value pairs and are subject to HTTP/2's
- * HPACK compression by libcurl.
- * @param body_zval The optional request body. This can be:
- * - A PHP string for standard request bodies (e.g., JSON, XML).
- * - A PHP array or object, which will be encoded into IIBIN format
- * if the `request_iibin_schema` option is set, or into JSON otherwise.
- * - A PHP stream resource, enabling zero-copy streaming of large
- * request bodies directly from the stream to the network. This is
- * highly efficient for large uploads over HTTP/2.
- * @param options_array An optional associative PHP array for advanced configuration.
- * This array can contain a multitude of key-value pairs that
- * directly map to underlying libcurl options, providing granular
- * control over timeouts, redirects, SSL/TLS settings, proxy usage,
- * DNS resolution, network interface binding, response body handling
- * (e.g., streaming to file), and IIBIN schema specifications.
- * HTTP/2 specific options might include:
- * - `stream_weight` (int): (If exposed by libcurl) HTTP/2 stream priority weight (1-256).
- * - `pipewait` (bool): (Implicitly handled by `http_version` "2.0") Wait for existing
- * multiplexed connections in the connection pool.
- * (This list is illustrative; the full range of options would be documented
- * in the `quicpro_http_request_send` function's documentation.)
- * @return A PHP array on success, containing:
- * - 'status' (int): The HTTP response status code (e.g., 200, 404).
- * - 'body' (string|array|object|null): The complete HTTP response body. If
- * `output_stream` was used, this is `null`. If `response_iibin_schema` was
- * used, this is the decoded IIBIN data (array/object).
- * - 'headers' (array): An associative array of normalized HTTP response headers.
- * Returns FALSE on failure, automatically throwing a `Quicpro\Exception\HttpClientException`
- * with a detailed error message.
+ * Response trailers (gRPC's grpc-status) are returned separately from the
+ * headers.
  */
+
+/** @brief Closes every pooled connection (RSHUTDOWN). */
+void quicpro_http2_client_rshutdown(void);
+
+/** @brief Frees the shared TLS context and nghttp2 callbacks (MSHUTDOWN). */
+void quicpro_http2_client_mshutdown(void);
+
 PHP_FUNCTION(quicpro_http2_request_send);
+PHP_FUNCTION(quicpro_http2_request_send_multi);
 
-#endif // QUICPRO_CLIENT_HTTP2_H
\ No newline at end of file
+#endif // QUICPRO_CLIENT_HTTP2_H
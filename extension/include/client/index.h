@@ -25,6 +25,14 @@
  * HTTP/2 via libcurl, or HTTP/3 via native quiche integration), ensuring
  * consistent behavior and comprehensive control regardless of the final
  * protocol decided upon.
+ *
+ * HTTP/3 is learned, not guessed: every response over TCP feeds its
+ * `Alt-Svc` header to the per-process cache of include/client/alt_svc.h,
+ * and later requests to an origin that announced "h3" go over QUIC. When
+ * the QUIC attempt gets no answer within `happy_eyeballs_quic_timeout_ms`
+ * (UDP blocked), the request falls back to TCP and the origin's
+ * alternative is skipped for a while. A fallback happens only before the
+ * handshake completes, so a request is never sent twice.
  */
 
 /**
@@ -53,19 +61,20 @@
  * @param method_len The length of the `method_str`.
  * @param headers_array An optional associative PHP array of request headers.
  * Example: `['Accept' => 'application/json']`.
- * @param body_zval The optional request body. This can be:
- * - A PHP string for standard request bodies.
- * - A PHP array or object, which will be encoded into IIBIN or JSON.
- * - A PHP stream resource, enabling zero-copy streaming for uploads.
+ * @param body_zval The optional request body, a string.
  * @param options_array An optional associative PHP array for advanced configuration.
  * This array can specify protocol preferences (`preferred_protocol`),
  * IP family preferences (`preferred_ip_family`), Happy Eyeballs timeouts,
  * as well as all other generic `libcurl` or `quiche`-specific options
  * relevant to the chosen protocol. Key options for protocol selection:
- * - `preferred_protocol` (string): "auto" (default, Happy Eyeballs), "http1.1", "http2.0", "http3.0".
+ * - `preferred_protocol` (string): "auto" (default: HTTP/3 for origins that
+ * announced it through Alt-Svc, TCP otherwise), "http1.1", "http2.0",
+ * "http3.0" (QUIC without fallback).
  * - `preferred_ip_family` (string): "auto" (default, Happy Eyeballs), "ipv4", "ipv6".
- * - `happy_eyeballs_quic_timeout_ms` (int): Timeout for initial QUIC attempt.
- * - `happy_eyeballs_tcp_timeout_ms` (int): Timeout for initial TCP attempt if parallel.
+ * - `happy_eyeballs_quic_timeout_ms` (int): How long an Alt-Svc upgrade
+ * waits for the server's first answer over UDP before falling back to
+ * TCP (default 300).
+ * - `timeout_ms` (int): Timeout of the whole request.
  * - `connection_config` (resource): An optional `Quicpro\Config` resource
  * for this specific connection, overriding global INI settings.
  * @return A PHP array on success, containing:
@@ -73,9 +82,13 @@
  * - 'body' (string|array|object|null): The response body, potentially
  * IIBIN-decoded or null if streamed.
  * - 'headers' (array): An associative array of normalized HTTP response headers.
+ * - 'protocol' (string): "h3" or "tcp", the transport the request took.
  * Returns FALSE on failure, automatically throwing a specific `Quicpro\Exception`
  * subclass (e.g., `HttpClientException`, `QuicException`, `TlsException`).
  */
 PHP_FUNCTION(quicpro_client_send_request);
 
+/** @brief Drops the request's default Config (RSHUTDOWN, after the client pool's). */
+void quicpro_client_rshutdown(void);
+
 #endif // QUICPRO_CLIENT_INDEX_H
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef QUICPRO_CLIENT_LOADGEN_H
+#define QUICPRO_CLIENT_LOADGEN_H
+
+#include <php.h>
+
+/**
+ * @file extension/include/client/loadgen.h
+ * @brief Open-loop load generator on the native client stack.
+ *
+ * A benchmark loop written in PHP spends most of its time in PHP. It also
+ * waits for each response before sending the next request, so a stalled
+ * server slows the benchmark down as well. Latencies then look better than
+ * they are ("coordinated omission"). quicpro_loadgen_run() does neither:
+ *
+ * - Requests go out at a constant rate, the n-th one at start + n / rate,
+ *   whatever the server does. If `max_in_flight` requests are pending, the
+ *   next ones wait and go out as soon as a slot frees.
+ * - A request's latency runs from when it was due to be sent, not from when
+ *   it was sent, so time spent waiting for a slot counts as well.
+ * - Latencies go into a log-linear histogram of microseconds (HDR style,
+ *   64 sub-buckets per power of two, so values are within about 1.6%).
+ *
+ * The traffic is a weighted `mix` of request kinds:
+ * - "h1" and "h2": requests over TCP on the libcurl engine
+ *   (include/http_client/http_client.h), with HTTP/1.1 and HTTP/2 forced;
+ * - "h3": requests multiplexed on `connections` HTTP/3 sessions per origin
+ *   (include/client/mux.h);
+ * - "mcp": MCP calls, i.e. POSTs of a ready-encoded body to /service/method
+ *   on those same sessions.
+ *
+ * The sessions connect, and finish their handshakes, before the clock
+ * starts. The loop runs on the calling PHP thread. Sessions are its own,
+ * never pooled, while curl connections come from the worker's shared pool.
+ * To use more cores, run it in every Quicpro\Cluster worker and combine
+ * their results with quicpro_loadgen_merge().
+ */
+
+PHP_FUNCTION(quicpro_loadgen_run);
+PHP_FUNCTION(quicpro_loadgen_merge);
+
+#endif // QUICPRO_CLIENT_LOADGEN_H
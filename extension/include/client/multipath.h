@@ -0,0 +1,117 @@
+/*
+ * include/client/multipath.h – Extra network paths for client sessions
+ * =====================================================================
+ *
+ * A client session connects over one socket. On a multi-homed host (two
+ * uplinks, Wi-Fi plus LTE) quicpro_client_session_add_path() opens more:
+ * one UDP socket per interface, bound to it with SO_BINDTODEVICE, each
+ * validated by quiche with PATH_CHALLENGE / PATH_RESPONSE before use.
+ *
+ * Scheduling. Upstream quiche implements RFC 9000 connection migration,
+ * not the multipath extension (draft-ietf-quic-multipath): at any time
+ * exactly one path carries the connection's data, and the others only
+ * carry probes. The scheduler therefore picks the active path rather
+ * than splitting packets. Every validated path is scored by its min RTT
+ * divided by its weight; the session migrates (quiche_conn_migrate())
+ * to the best one once it beats the active path by
+ * QUICPRO_MP_SWITCH_GAIN_PCT, at most once per QUICPRO_MP_SWITCH_HOLD_MS,
+ * and at once when nothing has arrived on the active path for three RTTs
+ * (300 ms at least) while packets were outstanding. A dead uplink thus
+ * costs a connection a few hundred milliseconds, not its streams.
+ *
+ * quiche routes packets by their local address: whatever it sends is
+ * written to the socket whose address quiche_send_info.from names, the
+ * handshake's socket for anything else.
+ *
+ * Each path uses a connection ID of its own (RFC 9000 §9.5). The session
+ * issues a spare one to the server as a path is added; the server must
+ * have issued the client one too (active_connection_id_limit > 1),
+ * otherwise adding the path fails.
+ */
+
+#ifndef QUICPRO_CLIENT_MULTIPATH_H
+#define QUICPRO_CLIENT_MULTIPATH_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <net/if.h>
+#include <sys/socket.h>
+
+#include <quiche.h>
+
+#include "client/session.h"
+
+#define QUICPRO_MP_MAX_PATHS        4       /* Besides the handshake's */
+#define QUICPRO_MP_WEIGHT_MAX       100
+#define QUICPRO_MP_SWITCH_HOLD_MS   1000    /* RTT samples settle after a move */
+#define QUICPRO_MP_SWITCH_GAIN_PCT  80      /* A better path must score at most this share of the active one */
+
+/* States of a path, as quicpro_client_session_paths() names them */
+#define QUICPRO_MP_PROBING          0
+#define QUICPRO_MP_VALIDATED        1
+#define QUICPRO_MP_FAILED           2
+
+typedef struct {
+    int                      fd;            /* Path 0: the session's `sock`, not owned */
+    char                     iface[IF_NAMESIZE];
+    struct sockaddr_storage  local;         /* As quiche knows the path */
+    socklen_t                local_len;
+    uint32_t                 weight;
+    uint8_t                  state;         /* QUICPRO_MP_* */
+
+    /* Scheduler bookkeeping, CLOCK_MONOTONIC ms and quiche's path counters */
+    uint64_t                 probed_ms;
+    uint64_t                 recv;          /* quiche's count when it last grew */
+    uint64_t                 recv_ms;
+    uint64_t                 sent_at_recv;
+} quicpro_mp_path_t;
+
+struct quicpro_mp_s {
+    quicpro_mp_path_t        paths[1 + QUICPRO_MP_MAX_PATHS];
+    unsigned                 count;
+    uint64_t                 switched_ms;   /* Last migration, CLOCK_MONOTONIC */
+    uint32_t                 switches;
+};
+
+/**
+ * @brief Opens a path over `iface` for the client session `s` and starts
+ * validating it. Creates the session's path table on first use, with the
+ * handshake's path as path 0.
+ * @return The new path's index, or -1 after throwing.
+ */
+int quicpro_mp_add_path(quicpro_session_t *s, const char *iface, uint32_t weight);
+
+/**
+ * @brief Reads the extra paths' sockets into quiche, takes quiche's path
+ * events and runs the scheduler. Called after the session's own socket
+ * was read.
+ */
+void quicpro_mp_pump_rx(quicpro_session_t *s);
+
+/**
+ * @brief Flushes quiche_conn_send() for `s`, each packet on the socket of
+ * the path it belongs to.
+ * @return Packets sent, or a negative quiche error other than QUICHE_ERR_DONE.
+ */
+int quicpro_mp_flush(quicpro_session_t *s);
+
+/** @brief Closes the extra paths' sockets and frees the table. NULL-safe. */
+void quicpro_mp_free(quicpro_mp_t *mp);
+
+/**
+ * @brief quicpro_client_session_add_path(resource $session, string $interface, int $weight = 1): int
+ * Adds a path over `$interface`; a path of weight 2 wins against one of
+ * twice its RTT. Returns the path's index.
+ */
+PHP_FUNCTION(quicpro_client_session_add_path);
+
+/**
+ * @brief quicpro_client_session_paths(resource $session): array
+ * One array per path: 'index', 'interface', 'local', 'state', 'active',
+ * 'weight', and quiche's 'rtt_us', 'min_rtt_us', 'cwnd', 'sent', 'recv',
+ * 'lost' and 'delivery_rate' for it.
+ */
+PHP_FUNCTION(quicpro_client_session_paths);
+
+#endif /* QUICPRO_CLIENT_MULTIPATH_H */
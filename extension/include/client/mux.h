@@ -0,0 +1,91 @@
+#ifndef QUICPRO_CLIENT_MUX_H
+#define QUICPRO_CLIENT_MUX_H
+
+#include <php.h>
+#include <quiche.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "client/session.h"
+
+/**
+ * @file extension/include/client/mux.h
+ * @brief Many concurrent HTTP/3 requests on one client session.
+ *
+ * A synchronous request call owns the session until its one stream
+ * finishes, so N backend calls cost N round trips in a row. The
+ * multiplexer instead takes any number of requests at once and opens a
+ * stream for each as the peer's stream limit allows. The rest wait in
+ * submission order. Request bodies that exceed the stream's flow-control
+ * window are resumed on later rounds.
+ *
+ * One event loop per session drives all streams and moves each finished
+ * response (or failed stream) onto a completion queue. Userland drains
+ * that queue with quicpro_http3_batch_wait():
+ *
+ *     $ids = quicpro_http3_batch_submit($session, $requests);
+ *     while (quicpro_http3_batch_pending($session) > 0) {
+ *         foreach (quicpro_http3_batch_wait($session, 1000) as $done) { ... }
+ *     }
+ *
+ * Each request has an id that is unique within its session. The id is
+ * known at submit time, before the request has a stream.
+ *
+ * Other code reading HTTP/3 events of the same session (the MCP client)
+ * hands events for streams it did not open to quicpro_h3_mux_dispatch(),
+ * and the multiplexer hands MCP calls' events to quicpro_mcp_dispatch(),
+ * so no response is lost whichever loop happens to read it.
+ */
+
+/** Per-session multiplexer state, created on first submit. */
+typedef struct quicpro_h3_mux_s quicpro_h3_mux_t;
+
+/** @brief Frees the multiplexer with everything still queued (session teardown). */
+void quicpro_h3_mux_free(quicpro_h3_mux_t *mux);
+
+/** @brief Whether no request of `mux` (NULL: none created) has a stream open. */
+bool quicpro_h3_mux_idle(const quicpro_h3_mux_t *mux);
+
+/**
+ * @brief Feeds an HTTP/3 event into the multiplexer.
+ * @return true if the event's stream belongs to a multiplexed request; the
+ * event has then been consumed and freed. false leaves `ev` to the caller.
+ */
+bool quicpro_h3_mux_dispatch(quicpro_session_t *s, quiche_h3_event *ev, uint64_t stream_id);
+
+/*
+ * C callers (the object store, include/object_store/object_store.h) queue
+ * requests without building userland arrays, and drive several sessions
+ * from one loop of their own.
+ */
+
+/**
+ * @brief Queues a request on `s` with `:authority` the session host.
+ * @param body Sent as the request body, referenced; NULL for none.
+ * @return The request's id.
+ */
+uint64_t quicpro_h3_mux_submit(quicpro_session_t *s, const char *method, const char *path, size_t path_len, zend_string *body);
+
+/**
+ * @brief Queues a request described like one of
+ * quicpro_http3_batch_submit()'s (`method`, `path`, `scheme`, `authority`,
+ * `headers`, `body`).
+ * @return false after throwing; otherwise the request's id is in `*id`.
+ */
+bool quicpro_h3_mux_submit_request(quicpro_session_t *s, HashTable *spec, uint64_t *id);
+
+/** @brief One round of sending and receiving on `s`, without waiting. */
+void quicpro_h3_mux_step(quicpro_session_t *s);
+
+/**
+ * @brief Takes the oldest completion of `s`, if any. `body`, `error` (NULL
+ * on success) and, unless `headers` is NULL, the response's header array
+ * become the caller's.
+ */
+bool quicpro_h3_mux_take(quicpro_session_t *s, uint64_t *id, zend_long *status, zend_string **body, zend_string **error, zval *headers);
+
+PHP_FUNCTION(quicpro_http3_batch_submit);
+PHP_FUNCTION(quicpro_http3_batch_wait);
+PHP_FUNCTION(quicpro_http3_batch_pending);
+
+#endif // QUICPRO_CLIENT_MUX_H
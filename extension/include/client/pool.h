@@ -0,0 +1,73 @@
+#ifndef QUICPRO_CLIENT_POOL_H
+#define QUICPRO_CLIENT_POOL_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "client/session.h"
+
+/**
+ * @file extension/include/client/pool.h
+ * @brief Per-worker pool of warm client QUIC connections.
+ *
+ * Connecting costs a DNS lookup, a socket and a full handshake. The pool
+ * keeps established connections keyed by origin (host, port), ALPN and
+ * configuration, and hands them out again instead of connecting anew.
+ * The configuration is keyed by identity: a `Quicpro\Config` is frozen
+ * once a session uses it, so the same object always means the same
+ * transport and TLS parameters.
+ *
+ * The pool owns one reference to each connection's session resource.
+ * Every other reference is a caller holding the connection, so a
+ * connection is idle when the pool's reference is the only one. A
+ * connection is handed to at most `max_holders` callers at once and only
+ * while the peer still grants bidirectional streams.
+ *
+ * Connections are checked on every checkout: closed or draining ones are
+ * dropped, pending datagrams are read first so a CONNECTION_CLOSE sent
+ * during the idle time is noticed, and connections idle for longer than
+ * `quicpro.transport_client_pool_idle_timeout_ms`, or beyond
+ * `quicpro.transport_client_pool_max_idle` per key, are closed.
+ *
+ * The pool lives for the PHP request, which for a worker is its lifetime.
+ * Under PHP-FPM a request is short, so with
+ * `quicpro.transport_client_pool_persistent` the idle connections are
+ * parked in the worker when it ends, instead of closed, and the next
+ * request takes them over. Config objects do not outlive a request, so a
+ * parked connection is keyed by the options its config was built from
+ * (`quicpro_cfg_t.fingerprint`) and goes to any config with equal ones.
+ * Before one is handed out, what arrived while it was parked is read and
+ * an expired timer fired; it must still be open, established and have
+ * streams left. Connections with request-bound state attached (extra
+ * paths, AF_XDP, TX timestamps, qlog, calls in flight) are closed as
+ * before.
+ */
+
+typedef struct {
+    const char          *host;
+    size_t               host_len;
+    zend_long            port;
+    const char          *alpn;     /* e.g. "h3" */
+    const quicpro_cfg_t *cfg;
+} quicpro_pool_key_t;
+
+/**
+ * @brief Returns a warm connection for `key` with a new reference the
+ * caller owns (e.g. via RETURN_RES()), or NULL when none can be shared.
+ */
+zend_resource *quicpro_client_pool_checkout(const quicpro_pool_key_t *key, uint32_t max_holders);
+
+/**
+ * @brief Adds a freshly connected session to the pool. The session's
+ * resource must already be registered; the pool takes its own reference.
+ */
+void quicpro_client_pool_add(const quicpro_pool_key_t *key, quicpro_session_t *s);
+
+/** @brief Parks or closes every pooled connection (RSHUTDOWN). */
+void quicpro_client_pool_rshutdown(void);
+
+/** @brief Closes the parked connections (MSHUTDOWN). */
+void quicpro_client_pool_mshutdown(void);
+
+#endif // QUICPRO_CLIENT_POOL_H
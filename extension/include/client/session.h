@@ -0,0 +1,182 @@
+#ifndef QUICPRO_CLIENT_SESSION_H
+#define QUICPRO_CLIENT_SESSION_H
+
+#include <php.h> // Essential for PHP_FUNCTION macro and fundamental PHP types.
+#include <quiche.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "config/config.h"
+
+/**
+ * @file extension/include/client/session.h
+ * @brief Native QUIC Session Structure and Client Session API for Quicpro.
+ *
+ * This header defines `quicpro_session_t`, the native state behind every
+ * `Quicpro\Session` resource, together with the PHP functions that create,
+ * drive and close client-initiated QUIC sessions. The same structure is
+ * reused by the server module for accepted connections, so every field
+ * documented here must remain meaningful on both sides of a connection.
+ */
+
+#ifndef QUICPRO_MAX_TICKET_SIZE
+#  define QUICPRO_MAX_TICKET_SIZE  512
+#endif
+
+/* Largest UDP payload we ever hand to quiche in a single call. */
+#ifndef QUICPRO_MAX_PACKET_SIZE
+#  define QUICPRO_MAX_PACKET_SIZE  1350
+#endif
+
+/* Length of the locally generated Source Connection ID. */
+#ifndef QUICPRO_SCID_LEN
+#  define QUICPRO_SCID_LEN         16
+#endif
+
+#ifndef QUICPRO_MAX_HOST_LEN
+#  define QUICPRO_MAX_HOST_LEN     256
+#endif
+
+/* IIBIN schema IDs remembered per connection, see include/iibin/iibin_descriptor.h. */
+#ifndef QUICPRO_IIBIN_PEER_SCHEMAS
+#  define QUICPRO_IIBIN_PEER_SCHEMAS 16
+#endif
+
+/* Opaque batched-I/O state, see include/poll/udp_batch.h and uring.h. */
+typedef struct quicpro_udp_rx_batch_s quicpro_udp_rx_batch_t;
+typedef struct quicpro_udp_tx_batch_s quicpro_udp_tx_batch_t;
+typedef struct quicpro_uring_s quicpro_uring_t;
+typedef struct quicpro_xdp_path_s quicpro_xdp_path_t;
+typedef struct quicpro_txstamp_s quicpro_txstamp_t;
+typedef struct quicpro_qlog_conn_s quicpro_qlog_conn_t;
+typedef struct quicpro_h3_mux_s quicpro_h3_mux_t;
+typedef struct quicpro_mcp_inflight_s quicpro_mcp_inflight_t;
+typedef struct quicpro_mcp_served_s quicpro_mcp_served_t;
+typedef struct quicpro_proxy_conn_s quicpro_proxy_conn_t;
+typedef struct quicpro_doq_conn_s quicpro_doq_conn_t;
+typedef struct quicpro_mp_s quicpro_mp_t;
+typedef struct quicpro_ssh_conn_s quicpro_ssh_conn_t;
+typedef struct quicpro_wt_s quicpro_wt_t;
+typedef struct quicpro_dgram_fec_s quicpro_dgram_fec_t;
+typedef struct quicpro_io_slot_s quicpro_io_slot_t;
+
+/**
+ * @brief Native state of a single QUIC connection.
+ *
+ * Allocated with `ecalloc()` by `quicpro_client_session_connect()` (client)
+ * or by the listener loop (server) and owned by the `Quicpro\Session`
+ * resource. Lazily created helpers such as `rx_batch` are released together
+ * with the session.
+ */
+typedef struct quicpro_session_s {
+    /* --- Transport --- */
+    int                      sock;           /* Non-blocking UDP socket, -1 if unset. */
+    quiche_conn             *conn;           /* quiche connection state machine. */
+    quiche_h3_conn          *h3;             /* HTTP/3 layer on top of `conn`. */
+    quiche_h3_config        *h3_cfg;         /* HTTP/3 configuration owned by the session. */
+    quicpro_cfg_t           *cfg_ptr;        /* Frozen Quicpro\Config the session was built from. */
+    quiche_config           *cfg;            /* Session-private quiche config, NULL when shared. */
+
+    /* --- Identity --- */
+    char                     host[QUICPRO_MAX_HOST_LEN]; /* SNI / :authority. */
+    uint8_t                  scid[QUICPRO_SCID_LEN];
+    struct sockaddr_storage  peer_addr;      /* Peer of the active path. */
+    socklen_t                peer_addr_len;
+
+    /* --- Paths (server side, see include/server/path.h) --- */
+    struct sockaddr_storage  local_addr;     /* Listener address datagrams arrive on. */
+    socklen_t                local_addr_len;
+    uint32_t                 paths_validated;
+    uint32_t                 migrations;     /* Peer moved to a new validated path. */
+    struct sockaddr_storage  relay_addr;     /* Router the peer is reached through (server/router.h). */
+    socklen_t                relay_addr_len; /* 0: the peer is reached directly. */
+    quicpro_io_slot_t       *io_slot;        /* Shared with the listener's I/O thread, see include/server/io_thread.h; NULL otherwise. */
+    quicpro_mp_t            *mp;             /* Client: paths over further interfaces, see include/client/multipath.h. */
+
+    /* --- TLS resumption --- */
+    uint8_t                  ticket[QUICPRO_MAX_TICKET_SIZE];
+    size_t                   ticket_len;
+    bool                     ticket_cache_pending; /* Client: store the session once quiche has one, see include/client/ticket_cache.h. */
+
+    /* --- 0-RTT (server side, see include/server/zero_rtt.h) --- */
+    uint8_t                  early_key[QUICHE_MAX_CONN_ID_LEN]; /* Client's first DCID, the replay key. */
+    uint8_t                  early_key_len;
+    int8_t                   early_verdict;  /* 0 undecided, 1 admitted, -1 refused. */
+    uint64_t                 early_offered;  /* Bit n: client stream 4n was offered during 0-RTT. */
+
+    /* --- Diagnostics --- */
+    int                      ts_enabled;     /* SO_TIMESTAMPING_NEW active on `sock`. */
+    struct timespec          last_rx_ts;     /* Kernel RX timestamp of the newest datagram. */
+    quicpro_txstamp_t       *txstamp;        /* TX timestamp ring + histograms, see include/poll/txstamp.h. */
+    int                      numa_node;
+    uint64_t                 handshake_started_us; /* Server: first packet, for the handshake duration metric; 0 once observed. */
+    quicpro_qlog_conn_t     *qlog;           /* Sampled for qlog, see include/server/qlog.h; NULL otherwise. */
+    bool                     capture;        /* Datagrams copied to the capture ring, see include/server/capture.h. */
+    uint64_t                 capture_id;     /* First 8 bytes of the SCID, naming the connection in dumps. */
+
+    /* --- Batched I/O --- */
+    quicpro_udp_rx_batch_t  *rx_batch;       /* recvmmsg() slots, created on first use. */
+    quicpro_udp_tx_batch_t  *tx_batch;       /* sendmmsg() burst, created on first use. */
+    int                      gso_state;      /* QUICPRO_GSO_* probe result for `sock`. */
+    bool                     gro_enabled;    /* UDP_GRO accepted on `sock`. */
+    quicpro_uring_t         *uring;          /* io_uring engine, see include/poll/uring.h. */
+    bool                     uring_unavailable; /* Engine disabled or failed; use batches. */
+    uint64_t                 ecn_rx_released[4]; /* ECN tallies of receive batches released while idle. */
+
+    /* --- Idle compaction (include/poll/hibernate.h) --- */
+    uint64_t                 last_active_ms; /* Coarse monotonic time of the newest datagram; 0: none yet. */
+    bool                     hibernating;    /* Idle helpers released; recreated on first use. */
+
+    quicpro_xdp_path_t      *xdp;            /* AF_XDP demux entry, see include/poll/xdp.h. */
+
+    /* --- IIBIN schemas (include/iibin/iibin_descriptor.h) --- */
+    uint32_t                 iibin_peer_schemas[QUICPRO_IIBIN_PEER_SCHEMAS]; /* IDs the peer has answered a call with; 0 is a free slot. */
+    uint8_t                  iibin_peer_next; /* Slot the next ID overwrites once all are taken. */
+
+    bool                     is_closed;
+    bool                     pooled;         /* Shared through the client pool, see include/client/pool.h. */
+    quicpro_h3_mux_t        *mux;            /* Batched HTTP/3 requests, see include/client/mux.h. */
+    quicpro_mcp_inflight_t  *mcp;            /* MCP calls awaiting a response, see include/mcp/mcp.h. */
+    quicpro_mcp_served_t    *mcp_served;     /* MCP requests being received, see include/mcp/mcp_server.h. */
+    quicpro_proxy_conn_t    *proxy;          /* Requests being proxied, see include/server/proxy.h. */
+    quicpro_doq_conn_t      *doq;            /* DNS queries in progress, see include/smart_dns/doq.h. */
+    quicpro_ssh_conn_t      *ssh;            /* Gateway streams and their targets, see include/ssh_over_quic/gateway.h. */
+    quicpro_wt_t            *wt;             /* WebTransport session on this connection, not owning; see include/webtransport/webtransport.h. */
+    quicpro_dgram_fec_t     *dgram_fec;      /* Repair datagrams, see include/client/dgram_fec.h; created on first use, NULL while off. */
+    zend_resource           *resource;
+} quicpro_session_t;
+
+/**
+ * @brief Releases everything a session owns (quiche state, socket, batches,
+ * engines) but not the struct itself, which may live in a slab
+ * (include/server/slab.h).
+ */
+void quicpro_session_free_members(quicpro_session_t *s);
+
+/**
+ * @brief Connects a new client session (DNS, socket, handshake start and
+ * HTTP/3 layer) without registering a resource for it.
+ * @param options Connection options as for quicpro_client_session_connect(), or NULL.
+ * @return The session, or NULL after throwing.
+ */
+quicpro_session_t *quicpro_client_session_open(const char *host, size_t host_len, zend_long port,
+                                               quicpro_cfg_t *cfg, int numa_node, HashTable *options);
+
+/**
+ * @brief Binds `fd` to the network interface `iface` (SO_BINDTODEVICE).
+ * @return 0 on success, -1 after throwing.
+ */
+int quicpro_socket_bind_iface(int fd, const char *iface);
+
+PHP_FUNCTION(quicpro_client_session_connect);
+PHP_FUNCTION(quicpro_client_session_tick);
+PHP_FUNCTION(quicpro_client_session_close);
+PHP_FUNCTION(quicpro_client_session_fetch_datagram);
+PHP_FUNCTION(quicpro_client_session_ingest_datagram);
+PHP_FUNCTION(quicpro_client_session_next_crypto_stream);
+PHP_FUNCTION(quicpro_client_session_is_established);
+PHP_FUNCTION(quicpro_client_session_enable_kernel_timestamps);
+
+#endif // QUICPRO_CLIENT_SESSION_H
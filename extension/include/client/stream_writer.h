@@ -0,0 +1,50 @@
+#ifndef QUICPRO_CLIENT_STREAM_WRITER_H
+#define QUICPRO_CLIENT_STREAM_WRITER_H
+
+#include <php.h>
+
+/**
+ * @file extension/include/client/stream_writer.h
+ * @brief Writing a stream with back-pressure from its flow control.
+ *
+ * A stream takes only as much as the peer's flow-control window and
+ * quiche's send buffer allow. Code that hands it a whole generated body
+ * either keeps everything in memory until quiche takes it, or spins on
+ * QUICHE_ERR_DONE. quicpro_stream_write() instead takes what fits now and
+ * says how much that was. Should nothing fit, it waits until the peer
+ * grants more:
+ *
+ *     for ($off = 0; $off < strlen($chunk); $off += $n) {
+ *         $n = quicpro_stream_write($session, $id, substr($chunk, $off));
+ *     }
+ *
+ * Inside a Fiber the wait parks the fiber on the session, so the
+ * scheduler's reactor (poll/scheduler.h) runs other fibers and resumes
+ * this one once packets arrived, which is how MAX_STREAM_DATA and ACKs
+ * come in. Outside a Fiber it blocks on the session's socket.
+ *
+ * On an HTTP/3 connection the data goes out as the body of the stream
+ * (DATA frames), otherwise as raw stream data. Server sessions are
+ * driven by their listener loop, which is busy running the handler: there
+ * a write never waits and returns 0 while the stream is blocked. The
+ * handler can check quicpro_stream_capacity() and go on in a later
+ * round.
+ */
+
+/**
+ * @brief quicpro_stream_capacity(resource $session, int $streamId): int
+ * Bytes the stream accepts right now. Throws if the stream was finished,
+ * reset or stopped by the peer.
+ */
+PHP_FUNCTION(quicpro_stream_capacity);
+
+/**
+ * @brief quicpro_stream_write(resource $session, int $streamId, string $data, bool $fin = false, int $timeout_ms = -1): int
+ * Queues as much of $data as the stream accepts, waiting up to
+ * $timeout_ms until at least one byte does. Returns the bytes taken: 0
+ * on timeout, fewer than given when the window filled. $fin finishes the
+ * stream only if all of $data was taken.
+ */
+PHP_FUNCTION(quicpro_stream_write);
+
+#endif // QUICPRO_CLIENT_STREAM_WRITER_H
@@ -0,0 +1,62 @@
+/*
+ * include/client/ticket_cache.h – Automatic TLS session cache for client connections
+ * ===================================================================================
+ *
+ * Resuming a QUIC connection needs the TLS session of an earlier
+ * connection to the same server. quicpro_client_tls_export_session_ticket()
+ * and _import_session_ticket() left that bookkeeping to userland; this
+ * cache does it for every client session:
+ *
+ * - Once the server has sent a NewSessionTicket, the session quiche
+ *   serialised is stored under "host:port".
+ * - quicpro_client_session_open() looks the server up before its first
+ *   flight. A hit is handed to quiche_conn_set_session(), so the handshake
+ *   resumes and, with `quicpro.tls_client_enable_early_data`, the
+ *   connection can carry 0-RTT data at once.
+ *
+ * By default every process keeps its own table, mapped on first use. With
+ * `quicpro.tls_client_session_cache_shared` the cluster master maps it
+ * shared before forking, so a session one worker obtained resumes in all
+ * of them. Each slot has its own spin lock; the critical section is one
+ * memcpy of at most QUICPRO_CLIENT_SESSION_MAX bytes.
+ *
+ * Sessions older than seven days (the TLS 1.3 maximum, RFC 8446 §4.6.1)
+ * are never offered. An older ticket the server no longer accepts only
+ * costs a full handshake.
+ */
+
+#ifndef QUICPRO_CLIENT_TICKET_CACHE_H
+#define QUICPRO_CLIENT_TICKET_CACHE_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "client/session.h"
+
+/* A serialised BoringSSL session includes the peer's certificate chain */
+#define QUICPRO_CLIENT_SESSION_MAX 4096
+
+/** @brief Maps the table shared, if configured. Called by the cluster master before forking. */
+void quicpro_client_ticket_cache_prepare(void);
+
+/** @brief Unmaps the table. */
+void quicpro_client_ticket_cache_release(void);
+
+/**
+ * @brief Copies the cached session for host:port into `out`.
+ * @return Its length, or 0 on a miss (or with the cache disabled).
+ */
+size_t quicpro_client_ticket_cache_get(const char *host, zend_long port, uint8_t *out, size_t cap);
+
+/** @brief Stores (or replaces) the session for host:port. */
+void quicpro_client_ticket_cache_put(const char *host, zend_long port, const uint8_t *session, size_t len);
+
+/**
+ * @brief Stores `s`'s session once quiche has one. Called from the RX pump
+ * while `s->ticket_cache_pending` is set; clears it when done.
+ */
+void quicpro_client_ticket_cache_capture(quicpro_session_t *s);
+
+#endif /* QUICPRO_CLIENT_TICKET_CACHE_H */
@@ -0,0 +1,70 @@
+/*
+ * include/cluster/bus.h – Inter-worker message bus for Quicpro\Cluster
+ * ====================================================================
+ *
+ * Lets cluster workers hand each other messages without a broker. Uses:
+ * a WebSocket broadcast to clients held by other workers, or work sent to
+ * the worker that owns a QUIC connection.
+ *
+ * Layout: with the cluster option 'message_bus_ring_bytes', the master
+ * maps one shared region before it forks. It holds a single-producer,
+ * single-consumer ring for every ordered pair of endpoints. An endpoint is
+ * a worker slot in one generation parity, as with the stats blocks, so a
+ * reload successor never shares a ring with its draining predecessor.
+ *
+ * Sending: a message is copied into the ring from the sender to the
+ * receiver and published with one release store. There is no lock and no
+ * syscall, except an eventfd write when the receiver sleeps in
+ * Cluster::receive(). A full ring makes send() return false, and nothing
+ * is queued.
+ *
+ * Payloads are strings, or arrays IIBIN-encoded with the schema the caller
+ * names. Each message is at most a quarter of a ring.
+ */
+
+#ifndef QUICPRO_CLUSTER_BUS_H
+#define QUICPRO_CLUSTER_BUS_H
+
+#include <php.h>
+
+/**
+ * @brief Maps the rings for `nslots` worker slots of `ring_bytes` each
+ * (rounded up to a power of two) and their eventfds. Called by the master
+ * before forking; FAILURE with a warning leaves the bus off.
+ */
+int quicpro_cluster_bus_prepare(int nslots, size_t ring_bytes);
+
+/** @brief Unmaps the rings and closes the eventfds. */
+void quicpro_cluster_bus_release(void);
+
+/** @brief In the forked worker: takes its endpoint and becomes the slot's receiver. */
+void quicpro_cluster_bus_attach_worker(int worker_id, unsigned generation);
+
+/** @brief In the master: slot `worker_id` was scaled down; stop addressing it. */
+void quicpro_cluster_bus_retire(int worker_id);
+
+/*
+ * PHP_FUNCTION(quicpro_cluster_send)
+ * bool Quicpro\Cluster::send(int $workerId, array|string $message, ?string $schema = null)
+ * Queues one message for the worker in slot $workerId. False when that
+ * worker does not run or its ring from this worker is full.
+ */
+PHP_FUNCTION(quicpro_cluster_send);
+
+/*
+ * PHP_FUNCTION(quicpro_cluster_broadcast)
+ * int Quicpro\Cluster::broadcast(array|string $message, ?string $schema = null)
+ * Sends to every other running worker; returns how many took it.
+ */
+PHP_FUNCTION(quicpro_cluster_broadcast);
+
+/*
+ * PHP_FUNCTION(quicpro_cluster_receive)
+ * array Quicpro\Cluster::receive(int $timeoutMs = 0, ?string $schema = null, int $max = 64)
+ * Up to $max messages for this worker, each ['from' => int, 'message' =>
+ * string|array], decoded with $schema if given. Waits up to $timeoutMs
+ * (-1: no limit) for the first one; 0 only looks.
+ */
+PHP_FUNCTION(quicpro_cluster_receive);
+
+#endif /* QUICPRO_CLUSTER_BUS_H */
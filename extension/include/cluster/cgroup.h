@@ -0,0 +1,57 @@
+/*
+ * include/cluster/cgroup.h – Per-worker cgroup v2 sub-groups for Quicpro\Cluster
+ * ==============================================================================
+ *
+ * When 'worker_cgroup_path' names a cgroup v2 directory, the master
+ * creates one child group per worker slot, "<path>/worker-<id>", before
+ * forking. A reload successor shares its predecessor's group. Into each it
+ * writes:
+ *
+ * - 'worker_cgroup_cpu_max' to cpu.max;
+ * - 'worker_cgroup_memory_high' to memory.high, where the kernel throttles
+ *   and reclaims before it would OOM-kill.
+ *
+ * The controllers are enabled in the parent's cgroup.subtree_control. Each
+ * worker moves itself into its group before it drops privileges.
+ *
+ * With 'pressure_stall_ms', the master arms PSI triggers on each group's
+ * cpu.pressure and memory.pressure: "some" stall of that many ms within
+ * 'pressure_window_ms'. The supervisor waits on these with the rest of its
+ * events (EPOLLPRI). A trigger firing is a worker starting to stall
+ * before it is throttled hard or killed.
+ *
+ * A 'worker_cgroup_path' that is not a directory keeps its old meaning: a
+ * cgroup.procs file that every worker writes its PID to.
+ */
+
+#ifndef QUICPRO_CLUSTER_CGROUP_H
+#define QUICPRO_CLUSTER_CGROUP_H
+
+typedef enum {
+    QUICPRO_CGROUP_CPU = 0,
+    QUICPRO_CGROUP_MEMORY = 1,
+    QUICPRO_CGROUP_RESOURCES
+} quicpro_cgroup_resource_t;
+
+/**
+ * @brief In the master, before forking: creates the groups for `nslots`
+ * slots under `path`, writes the limits (either may be NULL) and, with
+ * `stall_ms` > 0, arms the pressure triggers. Problems are warnings; what
+ * could be set up stays in effect.
+ */
+void quicpro_cgroup_prepare(const char *path, int nslots, const char *cpu_max, const char *memory_high,
+                            int stall_ms, int window_ms);
+
+/** @brief Closes the triggers and removes the groups that are empty by now. */
+void quicpro_cgroup_release(void);
+
+/** @brief In the forked worker: closes the master's triggers and joins its slot's group. */
+void quicpro_cgroup_attach_worker(int worker_id);
+
+/** @brief The trigger of slot `worker_id` for `resource`, -1 if none is armed. */
+int quicpro_cgroup_pressure_fd(int worker_id, quicpro_cgroup_resource_t resource);
+
+/** @brief "cpu" or "memory". */
+const char *quicpro_cgroup_resource_name(quicpro_cgroup_resource_t resource);
+
+#endif /* QUICPRO_CLUSTER_CGROUP_H */
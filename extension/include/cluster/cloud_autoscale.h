@@ -0,0 +1,73 @@
+/*
+ * include/cluster/cloud_autoscale.h – Predictive node autoscaler for Quicpro\Cluster
+ * ===================================================================================
+ *
+ * With 'cloud_autoscale', one master of the fleet sizes the fleet itself
+ * through its provider's API, by the quicpro.cluster_autoscale_* settings
+ * (config/cloud_autoscale/base_layer.h). Every 'cloud_autoscale_interval_sec'
+ * the supervisor hands it the utilisation of its own workers' event loops
+ * from the stats segment (cluster/cluster_stats.h). Times the nodes that
+ * serve, that is the fleet's demand in nodes; the load balancer is assumed
+ * to spread it evenly.
+ *
+ * Demand is forecast with additive Holt-Winters: level, trend and one
+ * seasonal term per interval of a 'cloud_autoscale_season_sec' period (a
+ * day by default), by wall-clock time, so yesterday's morning spike is
+ * provisioned for 'cloud_autoscale_lead_sec' before it comes back. The
+ * seasonal terms apply once a whole period has been seen. The model is kept
+ * in 'cloud_autoscale_state_path', if set, across restarts.
+ *
+ * The fleet wants enough nodes that the larger of the demand now and its
+ * peak over the lead time runs at scale_up_cpu_threshold_percent, within
+ * min_nodes .. max_nodes. Growing takes at least a scale_up_policy step
+ * ("add_nodes:N", "add_percent:P"), and starts warm nodes before it creates
+ * any. Shrinking goes one node at a time, once the forecast has been below
+ * the fleet for idle_node_timeout_sec and the demand per node is below
+ * scale_down_cpu_threshold_percent. A node that goes is stopped into the
+ * warm pool while that holds fewer than 'cloud_warm_nodes', and deleted
+ * otherwise. After every change nothing changes for cooldown_period_sec.
+ * The pool is refilled with nodes created stopped: a warm node boots in
+ * seconds where a new one takes minutes.
+ *
+ * Hetzner Cloud and DigitalOcean are driven natively, with the API token
+ * in credentials_path; nodes are told apart by a "quicpro-cluster" label or
+ * tag with the 'cluster_name'. Any provider, and those two too if it is set,
+ * can be driven by 'cloud_provider_callable': (string $action, array $args),
+ * with the actions
+ *
+ * - "list": returns [['id' => .., 'name' => .., 'state' => 'running'|'stopped'|'pending'], ...]
+ * - "create", ['count' => int, 'start' => bool]: returns the new ids
+ * - "start", "stop", "destroy", ['id' => ..]: returns true on success
+ *
+ * The node the controller runs on (by host name) is never stopped or
+ * deleted. A provider call blocks the supervisor for up to its timeout.
+ */
+
+#ifndef QUICPRO_CLUSTER_CLOUD_AUTOSCALE_H
+#define QUICPRO_CLUSTER_CLOUD_AUTOSCALE_H
+
+#include "cluster/cluster.h"
+
+#include <stdint.h>
+
+/**
+ * @brief In the master, before the supervisor loop: sets up the driver and
+ * the model for `c`. @return FAILURE with a warning if the provider cannot
+ * be driven; the cluster runs without it then.
+ */
+int quicpro_cloud_autoscale_start(const quicpro_cluster_options_t *c);
+
+/** @brief When the next sample is due (supervisor_now_ms() clock), 0 if not started. */
+uint64_t quicpro_cloud_autoscale_next_ms(void);
+
+/**
+ * @brief One sample: `utilization` (0..1) of this node's worker capacity,
+ * or a negative value if none of its loops could be sampled. Updates the
+ * model and resizes the fleet as needed.
+ */
+void quicpro_cloud_autoscale_tick(double utilization, uint64_t now_ms);
+
+/** @brief Saves the model and frees the controller. */
+void quicpro_cloud_autoscale_stop(void);
+
+#endif /* QUICPRO_CLUSTER_CLOUD_AUTOSCALE_H */
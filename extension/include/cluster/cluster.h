@@ -46,8 +46,33 @@ typedef struct _quicpro_cluster_options_t {
     /* --- Worker Configuration --- */
     int num_workers;             /* Number of worker processes to spawn.
                                   * Default: Number of available CPU cores if set to 0 or not provided. */
+    int min_workers;             /* Autoscaling floor. Default: num_workers. */
+    int max_workers;             /* Autoscaling ceiling; the supervisor scales between the two when it is
+                                  * above min_workers, by event-loop load from the stats segment.
+                                  * Default: num_workers (no autoscaling). */
+    int autoscale_interval_sec;  /* Seconds between load samples. Default: 5. */
+    int autoscale_cooldown_sec;  /* Seconds after a change before the next. Default: 60. */
+    double scale_up_utilization; /* Average loop utilisation (0..1) that adds a worker. Default: 0.75. */
+    double scale_down_utilization; /* ... and that drains one; below scale_up_utilization. Default: 0.25. */
+    int scale_up_queue_depth;    /* Events one wakeup returned that also add a worker; 0 disables. Default: 0. */
+    zend_bool cloud_autoscale;   /* If true, this master also sizes the fleet of nodes through the provider of
+                                  * quicpro.cluster_autoscale_* (cluster/cloud_autoscale.h). Run it on one node only.
+                                  * Default: false. */
+    int cloud_autoscale_interval_sec; /* Seconds between fleet samples and forecast steps. Default: 60. */
+    int cloud_autoscale_season_sec; /* Period of the seasonal forecast. Default: 86400 (a day). */
+    int cloud_autoscale_lead_sec; /* How far ahead the fleet is sized for the forecast peak. Default: 300. */
+    int cloud_warm_nodes;        /* Stopped, ready nodes kept for scaling up. Default: 0. */
+    char* cloud_autoscale_state_path; /* File the forecast model is kept in across restarts. Default: NULL (none). */
     zend_bool enable_cpu_affinity; /* If true, attempts to pin workers to specific CPU cores (round-robin).
                                   * Default: false. Requires OS support and adequate permissions. */
+    zend_bool numa_aware_placement; /* If true, pins workers by host topology instead: next to their NIC RX queue's
+                                  * IRQ, or spread over NUMA nodes, with memory per quicpro.io_thread_numa_node_policy.
+                                  * See cluster/topology.h. Default: false. Overrides enable_cpu_affinity. */
+    char* placement_interface;   /* NIC whose RX queues numa_aware_placement follows.
+                                  * Default: NULL (quicpro.io_xdp_interface, if set). */
+    zend_bool reuseport_cid_steering; /* 'reuseport_steering' => "cid": datagrams reach the worker named in their
+                                  * connection ID (server/reuseport.h); "hash": the kernel's 4-tuple hash alone.
+                                  * Default: "cid". */
     int worker_niceness;         /* Niceness value for worker processes (-20 for highest, 19 for lowest).
                                   * Default: 0 (kernel default). Requires privileges to set < 0. */
     int worker_scheduler_policy; /* Scheduling policy for workers (e.g., QUICPRO_SCHED_OTHER,
@@ -55,8 +80,17 @@ typedef struct _quicpro_cluster_options_t {
                                   * Default: QUICPRO_SCHED_OTHER. Real-time policies require privileges. */
     long worker_max_open_files;  /* RLIMIT_NOFILE for worker processes (max open file descriptors).
                                   * Default: 0 (not changed, inherits from master). Set to a positive value to change. */
-    char* worker_cgroup_path;    /* Optional: Path to an existing cgroup directory. Workers will be moved into this cgroup.
-                                  * Default: NULL (no cgroup manipulation). Master needs write access to the cgroup's tasks file. */
+    char* worker_cgroup_path;    /* Optional: A cgroup v2 directory; each worker slot gets its own group "worker-<id>" in it
+                                  * (cluster/cgroup.h). Any other path is a cgroup.procs file every worker joins.
+                                  * Default: NULL (no cgroup manipulation). The master needs write access to it. */
+    char* worker_cgroup_cpu_max; /* cpu.max of each worker's group, e.g. "50000 100000"; a number is that many CPUs.
+                                  * Default: NULL (unchanged). */
+    char* worker_cgroup_memory_high; /* memory.high of each worker's group, in bytes or with a K/M/G suffix.
+                                  * Default: NULL (unchanged). */
+    int pressure_stall_ms;       /* PSI trigger: "some" stall of this many ms within pressure_window_ms in a worker's
+                                  * group raises the load shedding level. Default: 0 (no triggers). */
+    int pressure_window_ms;      /* PSI trigger window; the kernel accepts 500 .. 10000 ms. Default: 1000. */
+    int pressure_relax_sec;      /* Quiet seconds before the load shedding level falls by one. Default: 30. */
     uid_t worker_uid;            /* Target UID for worker processes after fork.
                                   * Default: 0 (not changed, worker runs as master's UID). Requires master to be root for effective change. */
     gid_t worker_gid;            /* Target GID for worker processes after fork.
@@ -76,6 +110,15 @@ typedef struct _quicpro_cluster_options_t {
                                   * Receives: int $worker_id, int $worker_pid. */
     zval on_worker_exit_callable; /* Optional: PHP callable executed in the *master* process when a worker exits.
                                   * Receives: int $worker_id, int $worker_pid, int $exit_status, int $terminating_signal. */
+    zval on_pressure_callable;   /* Optional: PHP callable executed in the *master* when the load shedding level changes.
+                                  * Receives: int $worker_id, string $resource ("cpu", "memory"), int $level; the level
+                                  * falls with $worker_id -1. Each level halves the rate limiter's rates. */
+    zval preload_callable;       /* Optional: PHP callable executed once in the *master* before the first fork, with no
+                                  * arguments. What it loads (autoloaded classes, IIBIN schemas, tool handlers, config
+                                  * objects) is inherited copy-on-write by every worker. An exception aborts the start. */
+    zval cloud_provider_callable; /* Optional: PHP callable executed in the *master* that drives the node provider for
+                                  * cloud_autoscale: (string $action, array $args); see cluster/cloud_autoscale.h.
+                                  * Required for providers other than hetzner and digitalocean. */
 
     /* --- Master Supervisor Configuration --- */
     zend_bool restart_crashed_workers; /* If true, master supervisor restarts workers that terminate unexpectedly.
@@ -86,6 +129,20 @@ typedef struct _quicpro_cluster_options_t {
                                         * Default: 60. */
     int graceful_shutdown_timeout_sec;/* Timeout (seconds) for workers to shut down gracefully after receiving SIGTERM
                                         * from the master, before master sends SIGKILL. Default: 30. */
+    int reload_ready_timeout_sec;     /* SIGHUP rolling reload: how long a successor may take to report its listeners
+                                        * bound before its predecessor is drained anyway. Default: 10. */
+    int spare_workers;                /* Idle pre-forked processes kept ready; restarts and reload successors
+                                        * take one instead of forking. Default: 0. */
+    zend_long message_bus_ring_bytes; /* Per sender/receiver pair ring of the inter-worker message bus (cluster/bus.h),
+                                        * rounded up to a power of two. Default: 0 (no bus). */
+    int connection_snapshot_capacity; /* Connections per worker recorded for its replacement after a crash
+                                        * (server/conn_snapshot.h). Default: 0 (no snapshots). */
+    int connection_snapshot_interval_ms; /* How often a worker rewrites its snapshot. Default: 1000. */
+    zend_bool metrics_enabled;        /* Per-worker metric shards, summed by the master (server/metrics.h).
+                                        * Default: true. */
+    int metrics_port;                 /* Port of the master's Prometheus scrape endpoint. Default: 9091 (0: none;
+                                        * an OTLP push still runs when configured). */
+    char* metrics_host;               /* Address the scrape endpoint binds. Default: NULL ("127.0.0.1"). */
     char* master_pid_file_path;       /* Optional: Path to a file where the master supervisor's PID will be written.
                                         * Default: NULL (no PID file written). */
     char* cluster_name;               /* Optional: A name for this cluster, useful for logging or identification if multiple clusters are run.
@@ -138,16 +195,42 @@ PHP_FUNCTION(quicpro_cluster_signal_workers);
 /*
  * PHP_FUNCTION(quicpro_cluster_get_stats);
  * ----------------------------------------
- * Retrieves statistics about the running cluster by communicating with the
- * active master supervisor process.
+ * Retrieves statistics about the running cluster from the shared-memory
+ * segment its master creates (see cluster/cluster_stats.h). Reading it
+ * costs the master and the workers nothing.
  *
  * Userland Signature:
  * array|false quicpro_cluster_get_stats([string $master_pid_file_path = null])
  *
- * Returns an associative array of cluster statistics (e.g., master PID,
- * number of active workers, individual worker status, restart counts, uptimes)
- * or false on error (e.g., master not found).
+ * $master_pid_file_path: Locates the master from any process. Without it,
+ * only the master and its workers can read their own cluster's stats.
+ *
+ * Returns an associative array: 'master_pid', 'workers' (running now) and
+ * 'worker_slots' (the most the autoscaler may run), 'uptime_sec',
+ * 'sampled_at_ms', the totals 'connections_accepted', 'connections_active',
+ * 'handshakes_ok', 'handshakes_failed', 'streams', 'requests',
+ * 'rate_limited' (turned away by server/rate_limit.h), 'stateless_resets'
+ * (server/conn_snapshot.h), 'cdn_hits' and 'cdn_misses'
+ * (server/cdn_cache.h), 'ecn_ce' (datagrams that arrived marked
+ * Congestion Experienced, poll/udp_batch.h), 'bytes_rx',
+ * 'bytes_tx', 'rtt_samples', 'rtt_avg_us' and 'requests_per_sec_avg' (over
+ * the uptime), 'rtt_histogram_us' (sample counts keyed by each bucket's
+ * upper bound, the last 'inf'), and 'worker_stats', one array per worker
+ * slot and generation parity in use, with its 'worker_id', 'generation',
+ * 'pid' (0 once exited), 'uptime_sec', 'restarts', 'loop_idle_us',
+ * 'queue_depth' and the same counters. Throws, and returns false, when no
+ * segment can be found.
  */
 PHP_FUNCTION(quicpro_cluster_get_stats);
 
+/*
+ * quicpro_cluster_worker_listening()
+ * ----------------------------------
+ * Called by a server once its listening socket is bound (and, for QUIC,
+ * joined to the steering program). During a rolling reload this tells the
+ * master the worker is ready, so its predecessor can start draining. Does
+ * nothing in any other process or when called again.
+ */
+void quicpro_cluster_worker_listening(void);
+
 #endif /* QUICPRO_CLUSTER_H */
\ No newline at end of file
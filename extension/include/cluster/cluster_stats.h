@@ -0,0 +1,152 @@
+/*
+ * include/cluster/cluster_stats.h – Shared-memory worker metrics for Quicpro\Cluster
+ * ================================================================================
+ *
+ * The master creates one POSIX shared-memory segment, "/quicpro_stats.<master
+ * pid>", before it forks. The segment holds a one-line header and two blocks of
+ * counters per worker slot, each aligned to its own cache lines: a rolling
+ * reload runs the next generation of a slot beside the draining one, each
+ * in the block of its generation's parity. A worker only ever writes its own
+ * block, so a counter update is a relaxed load and store, with no locked
+ * instruction, no syscall and no line shared with a sibling. A restarted
+ * worker takes over its block and keeps adding to the counters.
+ *
+ * quicpro_cluster_get_stats() reads the segment. In the master it reads the
+ * mapping it already holds. Any other process finds the segment through the
+ * master's PID file and maps it read-only. Neither path talks to the workers.
+ *
+ * Counted:
+ * - connections: QUIC sessions and TCP (HTTP/1, HTTP/2) connections accepted, and those still open;
+ * - handshakes: QUIC ones as their connection closes, TLS-over-TCP ones as they finish;
+ * - streams and requests: requests handed to PHP, and HTTP/2 and HTTP/3 streams opened;
+ * - bytes and RTT: per QUIC connection as it closes, RTT as a log2 histogram;
+ * - event loop: time the server loops spent blocked waiting, and how many
+ *   events their last wakeup returned. The supervisor's autoscaler reads
+ *   these as utilisation and queue depth.
+ *
+ * Totals only: rates are the difference of two samples over their
+ * 'sampled_at_ms'.
+ */
+
+#ifndef QUICPRO_CLUSTER_STATS_H
+#define QUICPRO_CLUSTER_STATS_H
+
+#include <php.h>
+#include <quiche.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+/* RTT bucket 0 is below 128 µs; bucket b doubles the bound of b - 1; the last one is unbounded */
+#define QUICPRO_STATS_RTT_BUCKETS 16
+
+typedef struct {
+    /* Written by the master as it (re)starts the slot's worker */
+    _Alignas(64) _Atomic uint64_t pid;
+    _Atomic uint64_t started_at;        /* CLOCK_REALTIME seconds; 0 while never used */
+    _Atomic uint64_t restarts;
+    _Atomic uint64_t generation;
+
+    /* Written by the worker */
+    _Atomic uint64_t connections_accepted;
+    _Atomic uint64_t connections_closed;
+    _Atomic uint64_t handshakes_ok;
+    _Atomic uint64_t handshakes_failed;
+    _Atomic uint64_t streams;
+    _Atomic uint64_t requests;
+    _Atomic uint64_t rate_limited;      /* Connections and requests the rate limiter turned away */
+    _Atomic uint64_t stateless_resets;  /* Sent for a crashed predecessor's connections (server/conn_snapshot.h) */
+    _Atomic uint64_t cdn_hits;          /* Answered from server/cdn_cache.h without the handler */
+    _Atomic uint64_t cdn_misses;
+    _Atomic uint64_t ecn_ce;            /* Datagrams received Congestion Experienced (poll/udp_batch.h) */
+    _Atomic uint64_t bytes_rx;
+    _Atomic uint64_t bytes_tx;
+    _Atomic uint64_t rtt_sum_us;
+    _Atomic uint64_t rtt_hist[QUICPRO_STATS_RTT_BUCKETS];
+    _Atomic uint64_t loop_idle_us;      /* Waits that ended */
+    _Atomic uint64_t wait_since_us;     /* CLOCK_MONOTONIC start of the current wait; 0 while running */
+    _Atomic uint64_t queue_depth;       /* Events the last wait returned */
+} quicpro_worker_stats_t;
+
+/* This worker's block; NULL outside a cluster worker, where nothing is counted */
+extern quicpro_worker_stats_t *quicpro_worker_stats;
+
+/* The only writer of the block: no read-modify-write needed */
+static inline void quicpro_worker_stat_add(_Atomic uint64_t *counter, uint64_t n)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+#define QUICPRO_WORKER_STAT(field) do { \
+        if (quicpro_worker_stats) quicpro_worker_stat_add(&quicpro_worker_stats->field, 1); \
+    } while (0)
+
+static inline uint64_t quicpro_worker_stats_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/* Around a server loop's blocking wait: first the call, then what it returned */
+static inline void quicpro_worker_wait_begin(void)
+{
+    if (quicpro_worker_stats) {
+        atomic_store_explicit(&quicpro_worker_stats->wait_since_us, quicpro_worker_stats_now_us(), memory_order_relaxed);
+    }
+}
+
+static inline void quicpro_worker_wait_end(int ready)
+{
+    quicpro_worker_stats_t *w = quicpro_worker_stats;
+    if (!w) {
+        return;
+    }
+    uint64_t since = atomic_load_explicit(&w->wait_since_us, memory_order_relaxed);
+    atomic_store_explicit(&w->wait_since_us, 0, memory_order_relaxed);
+    if (since) {
+        quicpro_worker_stat_add(&w->loop_idle_us, quicpro_worker_stats_now_us() - since);
+    }
+    atomic_store_explicit(&w->queue_depth, ready > 0 ? (uint64_t)ready : 0, memory_order_relaxed);
+}
+
+/** @brief Creates the segment for `nworkers` slots. Called by the master before forking. */
+int quicpro_cluster_stats_create(int nworkers);
+
+/** @brief Unmaps the segment and, in the master, removes it. */
+void quicpro_cluster_stats_destroy(void);
+
+/** @brief The master records that slot `worker_id` runs `pid` for `generation`. */
+void quicpro_cluster_stats_worker_started(int worker_id, unsigned generation, pid_t pid, bool restarted);
+
+/**
+ * @brief The master reaped slot `worker_id`'s worker of `generation`: the
+ * connections it still held are closed with it. Called before its block
+ * is written by another worker.
+ */
+void quicpro_cluster_stats_worker_exited(int worker_id, unsigned generation);
+
+/** @brief The master runs `active` of the slots; get_stats() reports it as 'workers'. */
+void quicpro_cluster_stats_set_active(int active);
+
+/**
+ * @brief In the master: slot `worker_id`'s idle time so far (including a
+ * wait still in progress) and its last queue depth. False while its
+ * worker has never waited in an instrumented loop.
+ */
+bool quicpro_cluster_stats_load_sample(int worker_id, unsigned generation, uint64_t *idle_us, uint64_t *queue_depth);
+
+/** @brief In the forked worker: selects its block. */
+void quicpro_cluster_stats_attach_worker(int worker_id, unsigned generation);
+
+/** @brief Accounts a closing QUIC connection: its handshake, bytes and RTT. */
+void quicpro_worker_stats_conn_closed(quiche_conn *conn);
+
+/**
+ * @brief Fills `return_value` from the segment of the master whose PID
+ * `pid_file` holds, or from this master's own with NULL. FAILURE after
+ * throwing.
+ */
+int quicpro_cluster_stats_read(const char *pid_file, zval *return_value);
+
+#endif /* QUICPRO_CLUSTER_STATS_H */
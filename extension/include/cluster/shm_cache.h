@@ -0,0 +1,113 @@
+/*
+ * include/cluster/shm_cache.h – Slot table shared by a host's workers
+ * ===================================================================
+ *
+ * The caches that every worker of a host reads from (client TLS sessions,
+ * pipeline step replies, object store manifests, state values) share one
+ * layout: a flat array of equally sized slots, mapped by the cluster
+ * master before forking or, outside a cluster, privately on first use.
+ *
+ * - Two-way set associative: a key lives in slot key % n or its
+ *   neighbour (key % n) ^ 1. The count is rounded up to even, so both
+ *   ways of a set are inside the table.
+ * - A new entry takes the way that holds its key, else an empty or
+ *   expired one, else the one that expires first.
+ * - Each slot has its own spin lock, taken with a bounded spin. A worker
+ *   that died holding one costs that slot, never a hang; a lookup that
+ *   cannot take it counts as a miss and a store is skipped.
+ * - Expiry is CLOCK_REALTIME milliseconds, so processes agree on it.
+ *
+ * Each cache's slot struct starts with a quicpro_shm_cache_slot_t and adds
+ * its own payload. The key is a 64-bit hash, never 0; the cache confirms
+ * a hit against what it stored, under the lock.
+ */
+
+#ifndef QUICPRO_CLUSTER_SHM_CACHE_H
+#define QUICPRO_CLUSTER_SHM_CACHE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Leads every slot */
+typedef struct {
+    atomic_flag      lock;
+    _Atomic uint64_t key;           /* 0 while empty; read unlocked to skip a way */
+    _Atomic uint64_t expires_at;    /* CLOCK_REALTIME ms; read unlocked to pick a victim */
+} quicpro_shm_cache_slot_t;
+
+typedef struct {
+    unsigned char *slots;           /* NULL until mapped */
+    size_t         nslots;
+    size_t         slot_size;
+    bool           shared;
+} quicpro_shm_cache_t;
+
+static inline uint64_t quicpro_shm_cache_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static inline quicpro_shm_cache_slot_t *quicpro_shm_cache_slot(const quicpro_shm_cache_t *c, size_t i)
+{
+    return (quicpro_shm_cache_slot_t *)(c->slots + i * c->slot_size);
+}
+
+/**
+ * @brief Maps `entries` slots of `slot_size` bytes (rounded up to a cache
+ * line), MAP_SHARED or MAP_PRIVATE per `flags`. False if mmap() failed.
+ */
+bool quicpro_shm_cache_map(quicpro_shm_cache_t *c, size_t entries, size_t slot_size, int flags);
+
+/** @brief Unmaps the table, if mapped. */
+void quicpro_shm_cache_unmap(quicpro_shm_cache_t *c);
+
+/**
+ * @brief Locks way `way` (0 or 1) of `key` if its slot claims the key.
+ * @return The locked slot, or NULL. The caller confirms the hit with
+ * quicpro_shm_cache_live() and its own payload, then unlocks.
+ */
+quicpro_shm_cache_slot_t *quicpro_shm_cache_find(const quicpro_shm_cache_t *c, uint64_t key, size_t way);
+
+/**
+ * @brief Locks the slot a new entry for `key` goes to.
+ * @return The locked slot, or NULL if its lock could not be taken.
+ */
+quicpro_shm_cache_slot_t *quicpro_shm_cache_claim(const quicpro_shm_cache_t *c, uint64_t key, uint64_t now);
+
+/** @brief Unlocks a slot of quicpro_shm_cache_find() or _claim(). */
+static inline void quicpro_shm_cache_unlock(quicpro_shm_cache_slot_t *slot)
+{
+    atomic_flag_clear_explicit(&slot->lock, memory_order_release);
+}
+
+/** @brief Under the lock: whether the slot holds `key`, expired or not. */
+static inline bool quicpro_shm_cache_holds(const quicpro_shm_cache_slot_t *slot, uint64_t key)
+{
+    return atomic_load_explicit(&slot->key, memory_order_relaxed) == key;
+}
+
+/** @brief Under the lock: whether the slot holds `key` and has not expired. */
+static inline bool quicpro_shm_cache_live(const quicpro_shm_cache_slot_t *slot, uint64_t key, uint64_t now)
+{
+    return quicpro_shm_cache_holds(slot, key) && now < atomic_load_explicit(&slot->expires_at, memory_order_relaxed);
+}
+
+/** @brief Under the lock: marks the slot as holding `key` until `expires_at`. */
+static inline void quicpro_shm_cache_set(quicpro_shm_cache_slot_t *slot, uint64_t key, uint64_t expires_at)
+{
+    atomic_store_explicit(&slot->key, key, memory_order_relaxed);
+    atomic_store_explicit(&slot->expires_at, expires_at, memory_order_relaxed);
+}
+
+/** @brief Under the lock: empties the slot. */
+static inline void quicpro_shm_cache_clear(quicpro_shm_cache_slot_t *slot)
+{
+    quicpro_shm_cache_set(slot, 0, 0);
+}
+
+#endif /* QUICPRO_CLUSTER_SHM_CACHE_H */
@@ -0,0 +1,46 @@
+/*
+ * include/cluster/topology.h – NUMA-aware worker placement for Quicpro\Cluster
+ * ============================================================================
+ *
+ * With the cluster option 'numa_aware_placement', each forked worker is
+ * placed by the host topology read from sysfs and procfs instead of by
+ * `worker_id % CPUs`:
+ *
+ * - With a NIC ('placement_interface', else `quicpro.io_xdp_interface`),
+ *   the worker serves RX queue `worker_id % rx queues`, as AF_XDP does
+ *   (poll/xdp.h). It is pinned to the first CPU that queue's IRQ is affine
+ *   to. If the IRQ cannot be found, it is pinned to a CPU of the NIC's NUMA
+ *   node.
+ * - Without one, workers go round-robin over the NUMA nodes, and within a
+ *   node over the physical cores before their SMT siblings.
+ *
+ * CPUs outside the master's own affinity mask are never chosen.
+ *
+ * Memory then follows `quicpro.io_thread_numa_node_policy`. With 'default',
+ * the kernel allocates on the local node, which pinning makes the worker's
+ * node. 'prefer' and 'bind' set MPOL_PREFERRED or MPOL_BIND to that node.
+ * 'interleave' spreads over every node. The policy covers the pages the
+ * worker faults in from then on, including its copy-on-write copies of the
+ * master's heap.
+ *
+ * quicpro_topology_incoming_cpu() sets SO_INCOMING_CPU on the worker's
+ * listening sockets to the CPU it was pinned to.
+ */
+
+#ifndef QUICPRO_CLUSTER_TOPOLOGY_H
+#define QUICPRO_CLUSTER_TOPOLOGY_H
+
+/**
+ * @brief In the forked worker: pins it and sets its memory policy as
+ * described above. Returns the CPU it was pinned to, or -1 (with a
+ * warning) when the topology could not be read or applied.
+ */
+int quicpro_topology_place_worker(int worker_id, const char *ifname, const char *mem_policy);
+
+/**
+ * @brief Sets SO_INCOMING_CPU on `fd` to this worker's CPU. A no-op
+ * unless quicpro_topology_place_worker() pinned the worker.
+ */
+void quicpro_topology_incoming_cpu(int fd);
+
+#endif /* QUICPRO_CLUSTER_TOPOLOGY_H */
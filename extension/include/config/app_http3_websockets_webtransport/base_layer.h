@@ -26,16 +26,24 @@ typedef struct _qp_app_protocols_config_t {
     /* --- HTTP/3 General Settings --- */
     bool http_advertise_h3_alt_svc;
     char *http_auto_compress;
+    zend_long http_compress_min_length;
     zend_long h3_max_header_list_size;
     zend_long h3_qpack_max_table_capacity;
     zend_long h3_qpack_blocked_streams;
     bool h3_server_push_enable;
     bool http_enable_early_hints;
+    bool http_early_hints_auto;
 
     /* --- WebSocket Protocol Settings --- */
     zend_long websocket_default_max_payload_size;
     zend_long websocket_default_ping_interval_ms;
     zend_long websocket_handshake_timeout_ms;
+    zend_long websocket_receive_chunk_size;
+    bool websocket_deflate_enable;
+    zend_long websocket_deflate_max_window_bits;
+    bool websocket_deflate_no_context_takeover;
+    zend_long websocket_send_queue_high_watermark;
+    bool websocket_close_slow_consumers;
 
     /* --- WebTransport Protocol Settings --- */
     bool webtransport_enable;
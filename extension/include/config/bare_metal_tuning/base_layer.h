@@ -28,14 +28,23 @@ typedef struct _qp_bare_metal_config_t {
     zend_long io_uring_sq_poll_ms;
     zend_long io_max_batch_read_packets;
     zend_long io_max_batch_write_packets;
+    zend_long io_max_drain_packets;
+
+    /* --- AF_XDP Kernel Bypass --- */
+    char *io_xdp_interface;
+    zend_long io_xdp_queue_id;
+    bool io_xdp_zero_copy;
+    zend_long io_xdp_umem_frames;
 
     /* --- Socket Buffers & Options --- */
     zend_long socket_receive_buffer_size;
     zend_long socket_send_buffer_size;
     zend_long socket_enable_busy_poll_us;
     bool socket_enable_timestamping;
+    bool socket_enable_txtime;
 
     /* --- CPU & NUMA Affinity --- */
+    bool io_thread_split;
     char *io_thread_cpu_affinity;
     char *io_thread_numa_node_policy;
 
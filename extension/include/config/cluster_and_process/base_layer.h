@@ -39,6 +39,13 @@ typedef struct _qp_cluster_config_t {
     char *cluster_worker_user_id;
     char *cluster_worker_group_id;
 
+    /* --- Native Access Log --- */
+    bool access_log_enable;
+    char *access_log_dir;
+    char *access_log_format;
+    zend_long access_log_ring_records;
+    zend_long access_log_flush_ms;
+
 } qp_cluster_config_t;
 
 /* The single instance of this module's configuration data */
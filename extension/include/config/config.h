@@ -91,6 +91,11 @@ typedef struct quicpro_cfg_s {
     // A flag that is set to true after the config is used, making it immutable.
     zend_bool frozen;
 
+    // Hash of the options the config was built from. Configs built from equal
+    // options in the same worker are interchangeable, which is what lets a
+    // connection outlive the config object (see include/client/pool.h).
+    uint64_t fingerprint;
+
     // --- Composed Configuration Modules ---
     quicpro_cfg_app_protocols_t  app_protocols;
     quicpro_cfg_bare_metal_t   bare_metal;
@@ -141,6 +146,27 @@ PHP_FUNCTION(quicpro_new_config);
  */
 quicpro_cfg_t* quicpro_config_new_from_options(zval *zopts);
 
+/**
+ * @brief The request's Config built from php.ini alone, for callers that
+ * were given none (the unified client, the state agent, quicpro-fs://,
+ * the load generator).
+ *
+ * Built on first use and shared for the rest of the request: such
+ * configs are interchangeable (see `fingerprint`), so a request that
+ * needs several builds and frees only one. The resource belongs to the
+ * request's resource list; a caller that releases it early with
+ * zend_list_delete() takes a reference first.
+ *
+ * @return The resource, or NULL after an exception.
+ */
+zend_resource *quicpro_config_default(void);
+
+/**
+ * @brief Forgets the request's default Config at RSHUTDOWN; the engine
+ * frees it with the request's resources.
+ */
+void quicpro_config_rshutdown(void);
+
 /**
  * @brief The resource destructor for a `quicpro_cfg_t`.
  *
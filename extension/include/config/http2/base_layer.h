@@ -30,6 +30,10 @@ typedef struct _qp_http2_config_t {
     bool enable_push;
     zend_long max_frame_size;
 
+    /* --- Flow Control Auto-Tuning --- */
+    bool window_autotune_enable;
+    zend_long max_connection_window;
+
 } qp_http2_config_t;
 
 /* The single instance of this module's configuration data */
@@ -26,6 +26,7 @@ typedef struct _qp_iibin_config_t {
     zend_long max_schema_fields;
     zend_long max_recursion_depth;
     bool string_interning_enable;
+    zend_long arena_max_mb;
 
     /* --- Zero-Copy I/O via Shared Memory Buffers --- */
     bool use_shared_memory_buffers;
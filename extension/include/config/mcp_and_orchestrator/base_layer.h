@@ -28,13 +28,30 @@ typedef struct _qp_mcp_orchestrator_config_t {
     bool mcp_default_retry_policy_enable;
     zend_long mcp_default_retry_max_attempts;
     zend_long mcp_default_retry_backoff_ms_initial;
+    zend_long mcp_retry_budget_percent;     /* Per target, see include/pipeline_orchestrator/retry_budget.h */
     bool mcp_enable_request_caching;
     zend_long mcp_request_cache_ttl_sec;
+    zend_long mcp_request_cache_entries;
+    zend_long mcp_request_cache_entry_max_kb;
+    bool mcp_request_cache_shared;
+
+    /* --- MCP Circuit Breaker & Concurrency Limit (per target, see include/mcp/mcp_breaker.h) --- */
+    bool mcp_circuit_breaker_enable;
+    zend_long mcp_circuit_breaker_failure_rate_percent;
+    zend_long mcp_circuit_breaker_slow_call_ms;
+    zend_long mcp_circuit_breaker_slow_call_rate_percent;
+    zend_long mcp_circuit_breaker_min_calls;
+    zend_long mcp_circuit_breaker_open_ms;
+    zend_long mcp_circuit_breaker_half_open_probes;
+    bool mcp_adaptive_concurrency_enable;
+    zend_long mcp_concurrency_limit_initial;
+    zend_long mcp_concurrency_limit_max;
 
     /* --- Pipeline Orchestrator Settings --- */
     zend_long orchestrator_default_pipeline_timeout_ms;
     zend_long orchestrator_max_recursion_depth;
     zend_long orchestrator_loop_concurrency_default;
+    zend_long orchestrator_step_concurrency_default;
     bool orchestrator_enable_distributed_tracing;
 
 } qp_mcp_orchestrator_config_t;
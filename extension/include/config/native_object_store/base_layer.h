@@ -43,6 +43,9 @@ typedef struct _qp_native_object_store_config_t {
     bool metadata_cache_enable;
     zend_long metadata_cache_ttl_sec;
     bool enable_directstorage;
+    zend_long read_ahead_chunks;
+    zend_long write_behind_chunks;
+    zend_long dedup_average_chunk_kb;
 
 } qp_native_object_store_config_t;
 
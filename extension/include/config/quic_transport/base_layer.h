@@ -21,6 +21,18 @@
 #include "php.h"
 #include <stdbool.h>
 
+/* Bounds of the max_*_udp_payload_size settings (RFC 9000 §14, §18.2) */
+#define QUICPRO_UDP_PAYLOAD_MIN 1200
+#define QUICPRO_UDP_PAYLOAD_MAX 65527
+
+/* Bounds of the dgram_fec_* settings; together within QUICPRO_EC_MAX_SHARDS */
+#define QUICPRO_DGRAM_FEC_SOURCE_MAX 24
+#define QUICPRO_DGRAM_FEC_REPAIR_MAX 8
+
+/* Bounds of capture_snaplen: bytes of a datagram a capture keeps */
+#define QUICPRO_CAPTURE_SNAPLEN_MIN 64
+#define QUICPRO_CAPTURE_SNAPLEN_MAX 65535
+
 typedef struct _qp_quic_transport_config_t {
     /* --- Congestion Control & Pacing --- */
     char *cc_algorithm;
@@ -49,10 +61,45 @@ typedef struct _qp_quic_transport_config_t {
     /* --- Protocol Features & Datagrams --- */
     zend_long active_connection_id_limit;
     bool stateless_retry_enable;
+    zend_long stateless_retry_auto_threshold;
     bool grease_enable;
     bool datagrams_enable;
     zend_long dgram_recv_queue_len;
     zend_long dgram_send_queue_len;
+    zend_long dgram_fec_source_symbols;     /* 0: no FEC */
+    zend_long dgram_fec_repair_symbols;
+
+    /* --- Path MTU (RFC 8899 DPLPMTUD) --- */
+    zend_long max_send_udp_payload_size;
+    zend_long max_recv_udp_payload_size;
+    bool pmtud_enable;
+
+    /* --- Explicit Congestion Notification (RFC 3168) --- */
+    bool ecn_enable;
+    bool ecn_mark_ect;
+
+    /* --- Client Connection Pool --- */
+    bool client_pool_enable;
+    zend_long client_pool_max_idle;
+    zend_long client_pool_idle_timeout_ms;
+    zend_long client_pool_max_streams_per_conn;
+    bool client_pool_persistent;
+
+    /* --- Idle Sessions --- */
+    zend_long idle_hibernate_ms;
+
+    /* --- Client Connection Setup --- */
+    zend_long dns_timeout_ms;
+    zend_long dns_cache_max_ttl_sec;
+    zend_long happy_eyeballs_delay_ms;
+    zend_long happy_eyeballs_timeout_ms;
+
+    /* --- Diagnostics --- */
+    double qlog_sample_ratio;
+    zend_long qlog_ring_events;
+    double capture_sample_ratio;
+    zend_long capture_ring_bytes;
+    zend_long capture_snaplen;
 
 } qp_quic_transport_config_t;
 
@@ -32,6 +32,7 @@ typedef struct _qp_router_loadbalancer_config_t {
     char *backend_static_list;
     char *backend_mcp_endpoint;
     zend_long backend_mcp_poll_interval_sec;
+    zend_long server_id;
 
     /* --- Performance & Security --- */
     zend_long max_forwarding_pps;
@@ -0,0 +1,102 @@
+/*
+ * include/config/runtime.h – Compiled runtime view of a Quicpro\Config
+ * ====================================================================
+ *
+ * Listeners used to read their settings back out of the Config object's
+ * `options` array, string key by string key, every time a server was
+ * created. A Config object is now compiled once, on its first use: one
+ * pass over `options` fills a flat struct with the resolved values, and
+ * the server-side quiche_config is built from it right away.
+ *
+ * The compiled struct is immutable and refcounted. The first compile is
+ * cached for the life of the object (a weak reference: the object's
+ * destruction drops the cache's reference), so every server created from
+ * the same Config shares one struct and one quiche_config. The quiche
+ * config is the one place that still changes later: follow-up settings
+ * that are process-wide anyway (0-RTT, ticket keys, the live
+ * configuration of server/live_config.h) are applied to it in place.
+ */
+
+#ifndef QUICPRO_CONFIG_RUNTIME_H
+#define QUICPRO_CONFIG_RUNTIME_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <quiche.h>
+
+#include "server/congestion.h"
+
+/* Which options the Config object set; unset ones keep quiche's defaults */
+enum {
+    QUICPRO_RT_APPLICATION_PROTOS         = 1 << 0,
+    QUICPRO_RT_MAX_IDLE_TIMEOUT           = 1 << 1,
+    QUICPRO_RT_MAX_RECV_UDP_PAYLOAD       = 1 << 2,
+    QUICPRO_RT_MAX_SEND_UDP_PAYLOAD       = 1 << 3,
+    QUICPRO_RT_INITIAL_MAX_DATA           = 1 << 4,
+    QUICPRO_RT_INITIAL_MAX_STREAM_BIDI_L  = 1 << 5,
+    QUICPRO_RT_INITIAL_MAX_STREAM_BIDI_R  = 1 << 6,
+    QUICPRO_RT_INITIAL_MAX_STREAM_UNI     = 1 << 7,
+    QUICPRO_RT_INITIAL_MAX_STREAMS_BIDI   = 1 << 8,
+    QUICPRO_RT_INITIAL_MAX_STREAMS_UNI    = 1 << 9,
+    QUICPRO_RT_PORT                       = 1 << 10
+};
+
+typedef struct quicpro_runtime_config_s {
+    uint32_t  refcount;
+    uint32_t  set;                          /* QUICPRO_RT_* */
+
+    /* TLS material and the admin API's own address; NULL if not given */
+    char     *cert_file;
+    char     *key_file;
+    char     *ca_file;
+    char     *host;
+    zend_long port;
+
+    /* QUIC transport */
+    char     *application_protos;           /* Wire format: length-prefixed */
+    size_t    application_protos_len;
+    uint64_t  max_idle_timeout;
+    uint64_t  max_recv_udp_payload_size;
+    uint64_t  max_send_udp_payload_size;
+    uint64_t  initial_max_data;
+    uint64_t  initial_max_stream_data_bidi_local;
+    uint64_t  initial_max_stream_data_bidi_remote;
+    uint64_t  initial_max_stream_data_uni;
+    uint64_t  initial_max_streams_bidi;
+    uint64_t  initial_max_streams_uni;
+    char     *cc_profile;                   /* 'cc_profile', NULL for default */
+    quicpro_cc_profile_t cc;                /* Resolved; warm starts begin from its window */
+
+    quiche_config *quic;                    /* Server side, built from the above */
+} quicpro_runtime_config_t;
+
+/**
+ * @brief The compiled view of a Quicpro\Config object, compiling it on
+ * first use. Borrowed: valid while the object lives, or longer with
+ * quicpro_runtime_config_addref().
+ * @return NULL, after an exception, if quiche could not build its config
+ * or the cc_profile is unknown.
+ */
+quicpro_runtime_config_t *quicpro_runtime_config_of(zval *config_obj);
+
+/** @brief The max_recv_udp_payload_size the Config sets; 0 leaves it to php.ini. */
+static inline uint64_t quicpro_runtime_rx_payload(const quicpro_runtime_config_t *rt)
+{
+    return (rt->set & QUICPRO_RT_MAX_RECV_UDP_PAYLOAD) ? rt->max_recv_udp_payload_size : 0;
+}
+
+static inline quicpro_runtime_config_t *quicpro_runtime_config_addref(quicpro_runtime_config_t *rt)
+{
+    rt->refcount++;
+    return rt;
+}
+
+/** @brief Drops a reference; the last one frees the struct and its quiche config. */
+void quicpro_runtime_config_release(quicpro_runtime_config_t *rt);
+
+/** @brief Drops the per-object cache (RSHUTDOWN). */
+void quicpro_runtime_config_rshutdown(void);
+
+#endif /* QUICPRO_CONFIG_RUNTIME_H */
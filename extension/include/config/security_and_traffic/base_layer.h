@@ -32,6 +32,17 @@ typedef struct _qp_security_config_t {
     bool rate_limiter_enable;
     zend_long rate_limiter_requests_per_sec;
     zend_long rate_limiter_burst;
+    zend_long rate_limiter_table_size; /* Buckets in the cluster-wide table (server/rate_limit.h) */
+
+    /* --- Overload Shedding (server/overload.h) --- */
+    bool overload_shedding_enable;
+    zend_long overload_target_ms;
+    zend_long overload_interval_ms;
+
+    /* --- XDP Pre-Filter (server/xdp_filter.h) --- */
+    char *xdp_filter_interface;
+    zend_long xdp_filter_initials_per_sec;
+    zend_long xdp_filter_cid_capacity;
 
     /* --- CORS --- */
     char *cors_allowed_origins;
@@ -24,29 +24,29 @@
 
 typedef struct _qp_smart_dns_config_t {
     /* --- General Server Settings --- */
-    bool server_enable;
-    char *server_bind_host;
-    zend_long server_port;
-    bool server_enable_tcp;
-    zend_long default_record_ttl_sec;
+    bool dns_server_enable;
+    char *dns_server_bind_host;
+    zend_long dns_server_port;
+    bool dns_server_enable_tcp;
+    zend_long dns_default_record_ttl_sec;
 
     /* --- Operational Mode --- */
-    char *mode;
-    char *static_zone_file_path;
-    char *recursive_forwarders;
+    char *dns_mode;
+    char *dns_static_zone_file_path;
+    char *dns_recursive_forwarders;
 
     /* --- Service Discovery Mode Settings --- */
-    char *health_agent_mcp_endpoint;
-    zend_long service_discovery_max_ips_per_response;
+    char *dns_health_agent_mcp_endpoint;
+    zend_long dns_service_discovery_max_ips_per_response;
 
     /* --- Security & EDNS --- */
-    bool enable_dnssec_validation;
-    zend_long edns_udp_payload_size;
+    bool dns_enable_dnssec_validation;
+    zend_long dns_edns_udp_payload_size;
 
     /* --- Semantic DNS & Mothernode (Future Vision) --- */
-    bool semantic_mode_enable;
-    char *mothernode_uri;
-    zend_long mothernode_sync_interval_sec;
+    bool dns_semantic_mode_enable;
+    char *dns_mothernode_uri;
+    zend_long dns_mothernode_sync_interval_sec;
 
 } qp_smart_dns_config_t;
 
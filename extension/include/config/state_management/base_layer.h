@@ -25,6 +25,13 @@
 typedef struct _qp_state_management_config_t {
     char *default_backend;
     char *default_uri;
+    zend_long request_timeout_ms;
+
+    /* --- Local Read-Through Cache --- */
+    bool local_cache_enable;
+    zend_long local_cache_entries;
+    zend_long local_cache_entry_max_kb;
+    zend_long local_cache_ttl_ms;
 
 } qp_state_management_config_t;
 
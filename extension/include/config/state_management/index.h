@@ -1,6 +1,6 @@
 /*
  * =========================================================================
- * FILENAME:   include/config/state_management/base_layer.h
+ * FILENAME:   include/config/state_management/index.h
  * PROJECT:    quicpro_async
  * AUTHOR:     Jochen Schultz <jschultz@php.net>
  *
@@ -8,27 +8,26 @@
  * An intestinal worm? An idea.
  *
  * PURPOSE:
- * This header file defines the core data structure for the
- * `state_management` configuration module.
+ * This header file declares the public C-API for the State Management
+ * configuration module.
  *
  * ARCHITECTURE:
- * This struct holds the configuration values for the framework's generic,
- * persistent state manager backend.
+ * It provides the function prototypes for the module's lifecycle, which
+ * are called by the master dispatcher to orchestrate loading of settings.
  * =========================================================================
  */
-#ifndef QUICPRO_CONFIG_STATE_MANAGEMENT_BASE_H
-#define QUICPRO_CONFIG_STATE_MANAGEMENT_BASE_H
 
-#include "php.h"
-#include <stdbool.h>
+#ifndef QUICPRO_CONFIG_STATE_MANAGEMENT_INDEX_H
+#define QUICPRO_CONFIG_STATE_MANAGEMENT_INDEX_H
 
-typedef struct _qp_state_management_config_t {
-    char *default_backend;
-    char *default_uri;
-
-} qp_state_management_config_t;
+/**
+ * @brief Initializes the State Management configuration module.
+ */
+void qp_config_state_management_init(void);
 
-/* The single instance of this module's configuration data */
-extern qp_state_management_config_t quicpro_state_management_config;
+/**
+ * @brief Shuts down the State Management configuration module.
+ */
+void qp_config_state_management_shutdown(void);
 
-#endif /* QUICPRO_CONFIG_STATE_MANAGEMENT_BASE_H */
+#endif /* QUICPRO_CONFIG_STATE_MANAGEMENT_INDEX_H */
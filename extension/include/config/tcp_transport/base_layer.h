@@ -24,25 +24,38 @@
 
 typedef struct _qp_tcp_transport_config_t {
     /* --- Connection Management --- */
-    bool enable;
-    zend_long max_connections;
-    zend_long connect_timeout_ms;
-    zend_long listen_backlog;
-    bool reuse_port_enable;
+    bool tcp_enable;
+    zend_long tcp_max_connections;
+    zend_long tcp_connect_timeout_ms;
+    zend_long tcp_listen_backlog;
+    bool tcp_reuse_port_enable;
+
+    /* --- Accept Path --- */
+    zend_long tcp_fastopen_queue_len;   /* 0 disables TCP Fast Open */
+    zend_long tcp_defer_accept_sec;     /* 0 disables TCP_DEFER_ACCEPT */
 
     /* --- Latency & Throughput (Nagle's Algorithm) --- */
-    bool nodelay_enable;
-    bool cork_enable;
+    bool tcp_nodelay_enable;
+    bool tcp_cork_enable;
 
     /* --- Keep-Alive Settings --- */
-    bool keepalive_enable;
-    zend_long keepalive_time_sec;
-    zend_long keepalive_interval_sec;
-    zend_long keepalive_probes;
+    bool tcp_keepalive_enable;
+    zend_long tcp_keepalive_time_sec;
+    zend_long tcp_keepalive_interval_sec;
+    zend_long tcp_keepalive_probes;
+
+    /* --- HTTP/1.1 Listener --- */
+    zend_long tcp_http1_max_request_bytes;
+    zend_long tcp_http1_max_keepalive_requests;
+
+    /* --- Request Body Spooling (HTTP/1 and HTTP/2) --- */
+    zend_long tcp_body_spool_threshold_bytes;   /* 0 keeps every body in memory */
+    zend_long tcp_body_spool_max_bytes;
+    char *tcp_body_spool_dir;                   /* Empty: a memfd */
 
     /* --- TLS over TCP Settings --- */
-    char *tls_min_version_allowed;
-    char *tls_ciphers_tls12;
+    char *tcp_tls_min_version_allowed;
+    char *tcp_tls_ciphers_tls12;
 
 } qp_tcp_transport_config_t;
 
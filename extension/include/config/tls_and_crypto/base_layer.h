@@ -39,7 +39,20 @@ typedef struct _qp_tls_and_crypto_config_t {
     zend_long tls_session_ticket_lifetime_sec;
     bool tls_enable_early_data; /* 0-RTT for QUIC */
     zend_long tls_server_0rtt_cache_size;
+    char *tls_server_0rtt_anti_replay; /* "single_use" or "bloom" */
+    zend_long tls_server_0rtt_replay_window_sec;
+    bool tls_server_0rtt_early_dispatch; /* Hand 0-RTT streams to the handler before the handshake completes */
+    bool tls_client_session_cache_enable; /* Resume client connections automatically */
+    bool tls_client_session_cache_shared; /* One table for all cluster workers */
+    zend_long tls_client_session_cache_size;
+    bool tls_client_enable_early_data; /* 0-RTT when a client connection resumes */
     bool tls_enable_ocsp_stapling;
+    char *tls_tcp_handshake_offload; /* "inline", "async" or "threads" */
+    zend_long tls_tcp_handshake_threads;
+    bool tls_tcp_enable_ktls; /* Kernel TLS record encryption and sendfile() bodies */
+    char *tls_cert_store_dir; /* <host>.crt/.key picked by SNI, "" for none (server/cert_store.h) */
+    zend_long tls_cert_store_hot_size; /* Parsed certificates kept per process */
+    bool tls_cert_reload_enable; /* Reload renewed certificate files (server/cert_watch.h) */
     char *tcp_tls_min_version_allowed; /* e.g., "TLSv1.2", "TLSv1.3" */
 
 
@@ -63,4 +76,8 @@ typedef struct _qp_tls_and_crypto_config_t {
 /* The single instance of this module's configuration data */
 extern qp_tls_and_crypto_config_t quicpro_tls_and_crypto_config;
 
+/* Spelling used by this module's sources (and its definition in base_layer.c) */
+typedef qp_tls_and_crypto_config_t qp_tls_crypto_config_t;
+extern qp_tls_crypto_config_t quicpro_tls_crypto_config;
+
 #endif /* QUICPRO_CONFIG_TLS_CRYPTO_BASE_H */
@@ -0,0 +1,94 @@
+/*
+ * include/dataframe/arrow_ipc.h – Quicpro\DataFrame as an Arrow IPC stream
+ * ========================================================================
+ *
+ * A frame travels as an Arrow IPC stream (the streaming format of the
+ * Arrow columnar spec, metadata version 5):
+ *
+ *     schema
+ *     a dictionary batch per dictionary the frame's columns index
+ *     one record batch with every row
+ *     end-of-stream marker
+ *
+ * Each message is the 0xFFFFFFFF continuation, the length of its
+ * flatbuffer metadata, the metadata padded to 8 bytes, and the body. The
+ * body is the columns' buffers as they are in memory, each padded to 64
+ * bytes, so a stream is planned as a list of chunks rather than built:
+ * small ones holding the metadata and the padding, and one per column
+ * buffer pointing into the column. The MCP client and server (see
+ * include/mcp/mcp.h) hand the chunks to quiche one after the other; the
+ * frame itself is never copied on the way out.
+ *
+ * On the way in, a stream that arrived as one string is mapped, not
+ * parsed into values: each column of a stream with one record batch
+ * points into the string where its buffers are 8-byte aligned, and is
+ * copied only where they are not, or where the writer left bits set past
+ * the last row of a bitmap. Offsets and dictionary indices are checked
+ * once, as the kernels index by them. The record batches of a stream with
+ * several are concatenated. Other Arrow types, nested fields, compressed
+ * bodies, delta dictionaries and big-endian streams are turned down.
+ */
+
+#ifndef QUICPRO_DATAFRAME_ARROW_IPC_H
+#define QUICPRO_DATAFRAME_ARROW_IPC_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dataframe/dataframe.h"
+
+/* The media type of an Arrow IPC stream, for content-type */
+#define QUICPRO_DF_ARROW_STREAM_TYPE "application/vnd.apache.arrow.stream"
+
+/* MessageHeader union */
+#define QUICPRO_DF_IPC_SCHEMA           1
+#define QUICPRO_DF_IPC_DICTIONARY_BATCH 2
+#define QUICPRO_DF_IPC_RECORD_BATCH     3
+
+typedef struct {
+    const uint8_t *data;                /* NULL: `len` bytes at `off` in the plan's own bytes */
+    size_t         off, len;
+} quicpro_df_ipc_chunk_t;
+
+typedef struct {
+    unsigned char          *meta;       /* Message prefixes, metadata and padding */
+    size_t                  meta_len, meta_cap;
+    quicpro_df_ipc_chunk_t *chunks;
+    size_t                  count, cap;
+    size_t                  total;      /* Bytes of the whole stream */
+} quicpro_df_ipc_t;
+
+/**
+ * @brief Plans `df` as an Arrow IPC stream. The chunks point into the
+ * frame's columns, so the frame must outlive the plan.
+ */
+void quicpro_df_ipc_plan(const quicpro_dataframe_object *df, quicpro_df_ipc_t *ipc);
+
+static inline const uint8_t *quicpro_df_ipc_chunk_data(const quicpro_df_ipc_t *ipc, size_t i)
+{
+    const quicpro_df_ipc_chunk_t *c = &ipc->chunks[i];
+    return c->data ? c->data : ipc->meta + c->off;
+}
+
+/** @brief The planned stream as one string. */
+zend_string *quicpro_df_ipc_flatten(const quicpro_df_ipc_t *ipc);
+
+void quicpro_df_ipc_free(quicpro_df_ipc_t *ipc);
+
+/**
+ * @brief Makes `out` the frame an Arrow IPC stream holds, its columns
+ * mapped into `stream` where they can be (see above). False after
+ * throwing.
+ */
+bool quicpro_df_ipc_decode(zend_string *stream, zval *out);
+
+/**
+ * @brief The header type and body length of the message whose `len`
+ * bytes of flatbuffer metadata are at `meta`, for readers that walk a
+ * stream or file message by message. False when the metadata is not a
+ * message.
+ */
+bool quicpro_df_ipc_message_info(const uint8_t *meta, size_t len, uint8_t *type, uint64_t *body_len);
+
+#endif /* QUICPRO_DATAFRAME_ARROW_IPC_H */
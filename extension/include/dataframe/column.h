@@ -0,0 +1,164 @@
+/*
+ * include/dataframe/column.h – Columns of Quicpro\DataFrame
+ * =========================================================
+ *
+ * Columns are laid out as Arrow arrays, so that they can be handed to
+ * Arrow readers (and come back from them) buffer by buffer:
+ *
+ *     int64, float64   validity bitmap, values (little-endian)
+ *     bool             validity bitmap, values bitmap
+ *     utf8             validity bitmap, int32 offsets[length + 1], bytes
+ *     dictionary       validity bitmap, int32 indices into a utf8
+ *                      dictionary without nulls
+ *
+ * Bitmaps hold bit i in byte i / 8 at position i % 8, which on the
+ * little-endian hosts this builds for is bit i % 64 of 64-bit word i / 64;
+ * the kernels read them a word at a time. A column whose null count is 0
+ * has no validity bitmap. Every buffer starts on a 64-byte boundary and
+ * is padded to a multiple of 64 bytes with zeros.
+ *
+ * Columns are immutable once built and shared between frames by count:
+ * projecting a frame copies no values, and a dictionary is shared by
+ * every column indexing it. Buffers are allocated with malloc(), not the
+ * request heap, so morsel threads can fill them; they count against
+ * quicpro.dataframe_memory_limit_mb for as long as they live.
+ *
+ * A column mapped from an Arrow IPC stream (dataframe/arrow_ipc.h) has no
+ * buffers of its own: they point into the string that holds the stream,
+ * which the column keeps a reference to. Such buffers are only 8-byte
+ * aligned and padded to the bitmap word; they count against PHP's memory
+ * limit, as the string does, not the DataFrame one.
+ */
+
+#ifndef QUICPRO_DATAFRAME_COLUMN_H
+#define QUICPRO_DATAFRAME_COLUMN_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    QUICPRO_DF_INT64,
+    QUICPRO_DF_FLOAT64,
+    QUICPRO_DF_BOOL,
+    QUICPRO_DF_UTF8,
+    QUICPRO_DF_DICT,
+} quicpro_df_type_t;
+
+typedef struct quicpro_df_column_s {
+    uint32_t                    refcount;
+    quicpro_df_type_t           type;
+    int64_t                     length;
+    int64_t                     null_count;
+    uint8_t                    *validity;      /* NULL while null_count is 0 */
+    void                       *values;        /* See above, by type */
+    char                       *data;          /* utf8: the bytes the offsets point into */
+    struct quicpro_df_column_s *dictionary;    /* dictionary: the utf8 values */
+    size_t                      bytes;         /* Counted against the memory limit */
+    zend_string                *owner;         /* Set: the buffers point into this string (see above) */
+} quicpro_df_column_t;
+
+/*
+ * Which rows of a frame a kernel picked: a bitmap over its rows, and for
+ * each morsel (see dataframe/morsel.h) the output position of its first
+ * picked row, so that morsels can be gathered in parallel.
+ */
+typedef struct {
+    uint64_t *bits;
+    int64_t   rows;
+    int64_t   count;
+    int64_t  *base;                            /* One per morsel */
+} quicpro_df_selection_t;
+
+static inline bool quicpro_df_bit(const uint8_t *bits, int64_t i)
+{
+    return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+static inline bool quicpro_df_valid(const quicpro_df_column_t *c, int64_t row)
+{
+    return !c->validity || quicpro_df_bit(c->validity, row);
+}
+
+/* Bytes of a bitmap or buffer of `n` bytes, padded as Arrow wants */
+static inline size_t quicpro_df_padded(size_t n)
+{
+    return (n + 63) & ~(size_t)63;
+}
+
+/** @brief Text name of a type, as DataFrame::types() reports it. */
+const char *quicpro_df_type_name(quicpro_df_type_t type);
+
+/**
+ * @brief A new column of `length` rows with zeroed buffers: a validity
+ * bitmap if `nullable`, and for utf8 `data_len` bytes of data. NULL after
+ * throwing when the memory limit would be exceeded.
+ */
+quicpro_df_column_t *quicpro_df_column_new(quicpro_df_type_t type, int64_t length, bool nullable, size_t data_len);
+
+/**
+ * @brief A column of `length` rows whose buffers the caller points into
+ * `owner` (referenced); buffers it leaves NULL stay NULL.
+ */
+quicpro_df_column_t *quicpro_df_column_map(quicpro_df_type_t type, int64_t length, zend_string *owner);
+
+static inline quicpro_df_column_t *quicpro_df_column_addref(quicpro_df_column_t *c)
+{
+    c->refcount++;
+    return c;
+}
+
+/** @brief Drops a reference; the last one frees the buffers and the dictionary's reference. */
+void quicpro_df_column_release(quicpro_df_column_t *c);
+
+/** @brief Bytes held by all columns of this process. */
+size_t quicpro_df_memory_used(void);
+
+/**
+ * @brief Builds a column from PHP values, null where a cell is NULL or
+ * holds null. Ints become int64, ints mixed with floats float64, bools
+ * bool, strings a dictionary when quicpro.dataframe_string_interning_enable
+ * is on and utf8 otherwise. NULL after throwing for other mixes and types;
+ * `name` is for the message.
+ */
+quicpro_df_column_t *quicpro_df_column_from_zvals(zval *const *cells, int64_t n, const zend_string *name);
+
+/**
+ * @brief Cell `row` as a PHP value. `strings` caches the dictionary's
+ * strings for repeated reads (NULL: no cache); it has as many slots as
+ * the dictionary has values and is released by quicpro_df_strings_free().
+ */
+void quicpro_df_cell(const quicpro_df_column_t *c, int64_t row, zend_string **strings, zval *out);
+
+/** @brief A zeroed string cache for quicpro_df_cell(), or NULL for a column that needs none. */
+zend_string **quicpro_df_strings_new(const quicpro_df_column_t *c);
+
+void quicpro_df_strings_free(const quicpro_df_column_t *c, zend_string **strings);
+
+/** @brief Counts the nulls in the validity bitmap, and drops the bitmap if there are none. */
+void quicpro_df_column_settle(quicpro_df_column_t *c);
+
+/** @brief The rows `sel` picked, in order; NULL after throwing. */
+quicpro_df_column_t *quicpro_df_column_take(const quicpro_df_column_t *c, const quicpro_df_selection_t *sel);
+
+/**
+ * @brief The rows of `n` (at least one) columns of one type, one after
+ * the other. String columns may mix utf8 and dictionaries: the result is
+ * a dictionary column only when all of them share one dictionary, and
+ * utf8 otherwise. NULL after throwing.
+ */
+quicpro_df_column_t *quicpro_df_column_concat(quicpro_df_column_t *const *parts, size_t n);
+
+/** @brief A utf8 column as a dictionary over its distinct values; others by reference. NULL after throwing. */
+quicpro_df_column_t *quicpro_df_column_encode(quicpro_df_column_t *c);
+
+/**
+ * @brief Fills `sel->base` from per-morsel counts, and `sel->count`.
+ * `counts` and `sel->base` have quicpro_df_morsels(sel->rows) slots.
+ */
+void quicpro_df_selection_finish(quicpro_df_selection_t *sel, const int64_t *counts);
+
+/** @brief Frees what a selection holds. */
+void quicpro_df_selection_free(quicpro_df_selection_t *sel);
+
+#endif /* QUICPRO_DATAFRAME_COLUMN_H */
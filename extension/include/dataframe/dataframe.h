@@ -0,0 +1,66 @@
+/*
+ * include/dataframe/dataframe.h – Quicpro\DataFrame
+ * =================================================
+ *
+ * A table of named, typed columns held outside the PHP heap (see
+ * dataframe/column.h), worked on by vectorized kernels over all rows at a
+ * time rather than by PHP loops over arrays of rows:
+ *
+ *     $df = DataFrame::fromRows($rows);      // or fromArrays(['name' => [...], ...])
+ *     $eu = $df->filter('region', '==', 'eu')
+ *              ->withColumn('total', 'price', '*', 'qty');
+ *     $by = $eu->groupBy('country', [
+ *         'orders'  => 'count',
+ *         'revenue' => ['sum', 'total'],
+ *         'avg_qty' => ['mean', 'qty'],
+ *     ]);
+ *     $by->toArray();                        // one array per group
+ *
+ * Frames are immutable: every operation returns a new frame, which shares
+ * the columns it did not change with the frame it came from. Groups come
+ * out in order of their first row, as do the rows of filter() and slice().
+ * Frames are created only while quicpro.dataframe_enable is on.
+ *
+ * toArrow() and DataFrame::fromArrow() carry a frame as an Arrow IPC
+ * stream (dataframe/arrow_ipc.h), which MCP calls and handlers send and
+ * receive as is; fromArrow() maps the columns onto the string it is given.
+ * DataFrame::scan() works through Parquet and Arrow files too large to
+ * load a batch at a time (dataframe/scan.h).
+ */
+
+#ifndef QUICPRO_DATAFRAME_H
+#define QUICPRO_DATAFRAME_H
+
+#include <php.h>
+
+#include "dataframe/column.h"
+
+typedef struct {
+    int64_t               rows;
+    uint32_t              ncols;
+    zend_string         **names;
+    quicpro_df_column_t **cols;
+    zend_object           std;
+} quicpro_dataframe_object;
+
+extern zend_class_entry *quicpro_ce_dataframe;
+
+static inline quicpro_dataframe_object *quicpro_dataframe_from_obj(zend_object *obj)
+{
+    return (quicpro_dataframe_object *)((char *)obj - XtOffsetOf(quicpro_dataframe_object, std));
+}
+
+/**
+ * @brief Makes `out` a frame of `ncols` columns of `rows` rows each,
+ * taking over the references in `names` and `cols` (emalloc'd arrays,
+ * which it also takes over).
+ */
+void quicpro_dataframe_wrap(zval *out, int64_t rows, uint32_t ncols, zend_string **names, quicpro_df_column_t **cols);
+
+/** @brief Registers Quicpro\DataFrame (MINIT). */
+void quicpro_dataframe_minit(void);
+
+/** @brief Stops the morsel threads (MSHUTDOWN). */
+void quicpro_dataframe_mshutdown(void);
+
+#endif /* QUICPRO_DATAFRAME_H */
@@ -0,0 +1,37 @@
+/*
+ * include/dataframe/group_by.h – Grouped aggregation of Quicpro\DataFrame
+ * =======================================================================
+ *
+ * Each morsel aggregates its rows into a hash table of its own, keyed by
+ * the tuple of key values (a null is a key value of its own), so threads
+ * never share a table while they run. The tables are then merged in
+ * morsel order, and the groups come out in order of the first row of
+ * each, as a sequential pass would have found them.
+ */
+
+#ifndef QUICPRO_DATAFRAME_GROUP_BY_H
+#define QUICPRO_DATAFRAME_GROUP_BY_H
+
+#include <php.h>
+#include <stdbool.h>
+
+#include "dataframe/column.h"
+#include "dataframe/kernels.h"
+
+#define QUICPRO_DF_GROUP_KEYS_MAX 64
+
+typedef struct {
+    quicpro_df_agg_fn_t        fn;
+    const quicpro_df_column_t *col;     /* NULL: count the rows */
+} quicpro_df_agg_t;
+
+/**
+ * @brief Groups `rows` rows by the columns `keys` and aggregates each
+ * group. Fills out_keys[i] with key column i's value per group and
+ * out_aggs[j] with aggregate j per group; the caller owns them. False
+ * after throwing, with nothing to release.
+ */
+bool quicpro_df_group_by(quicpro_df_column_t *const *keys, size_t nkeys, const quicpro_df_agg_t *aggs, size_t naggs,
+                         int64_t rows, quicpro_df_column_t **out_keys, quicpro_df_column_t **out_aggs);
+
+#endif /* QUICPRO_DATAFRAME_GROUP_BY_H */
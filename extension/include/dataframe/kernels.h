@@ -0,0 +1,108 @@
+/*
+ * include/dataframe/kernels.h – Vectorized kernels of Quicpro\DataFrame
+ * =====================================================================
+ *
+ * Filters, projections and aggregates over whole columns. Each runs per
+ * morsel (dataframe/morsel.h) and a bitmap word at a time: a comparison
+ * yields 64 rows' results in one word, which is AND-ed with the validity
+ * word, so nulls never match; an aggregate takes the rows of an all-valid
+ * word in a tight loop and only tests bits in words that hold nulls.
+ * With AVX2 the comparisons run four int64 or float64 rows (eight
+ * dictionary indices) per instruction.
+ *
+ * A string comparison on a dictionary column is worked out once per
+ * distinct value, and each row only looks its index up.
+ */
+
+#ifndef QUICPRO_DATAFRAME_KERNELS_H
+#define QUICPRO_DATAFRAME_KERNELS_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dataframe/column.h"
+
+typedef enum {
+    QUICPRO_DF_EQ,
+    QUICPRO_DF_NE,
+    QUICPRO_DF_LT,
+    QUICPRO_DF_LE,
+    QUICPRO_DF_GT,
+    QUICPRO_DF_GE,
+} quicpro_df_cmp_t;
+
+typedef enum {
+    QUICPRO_DF_ADD,
+    QUICPRO_DF_SUB,
+    QUICPRO_DF_MUL,
+    QUICPRO_DF_DIV,
+} quicpro_df_arith_t;
+
+typedef enum {
+    QUICPRO_DF_COUNT,           /* Non-null values; of the rows without a column */
+    QUICPRO_DF_SUM,
+    QUICPRO_DF_MEAN,
+    QUICPRO_DF_MIN,
+    QUICPRO_DF_MAX,
+} quicpro_df_agg_fn_t;
+
+/* What an aggregate has seen of one column (or one group of it) */
+typedef struct {
+    int64_t n;
+    union { int64_t i; double d; } sum, min, max;
+} quicpro_df_agg_state_t;
+
+/** @brief Parses "==", "!=", "<", "<=", ">", ">="; false for anything else. */
+bool quicpro_df_cmp_parse(const zend_string *op, quicpro_df_cmp_t *out);
+
+/** @brief Parses "+", "-", "*", "/"; false for anything else. */
+bool quicpro_df_arith_parse(const zend_string *op, quicpro_df_arith_t *out);
+
+/** @brief Parses "count", "sum", "mean", "min", "max"; false for anything else. */
+bool quicpro_df_agg_parse(const zend_string *fn, quicpro_df_agg_fn_t *out);
+
+/**
+ * @brief Picks the rows of `c` whose value compares to `value` as `op`
+ * says. A null `value` picks the null rows with "==" and the others with
+ * "!=". False after throwing for a comparison the types do not allow.
+ */
+bool quicpro_df_filter(const quicpro_df_column_t *c, quicpro_df_cmp_t op, zval *value, quicpro_df_selection_t *sel);
+
+/** @brief Picks rows [offset, offset + length) of `rows`. */
+void quicpro_df_range(int64_t rows, int64_t offset, int64_t length, quicpro_df_selection_t *sel);
+
+/**
+ * @brief `a op b` row by row, `b` a column of as many rows or (with `b`
+ * NULL) the number `scalar`. int64 and bool operands give int64 (wrapping
+ * on overflow), float64 ones and "/" float64. A row is null where either
+ * operand is. NULL after throwing.
+ */
+quicpro_df_column_t *quicpro_df_arith(const quicpro_df_column_t *a, quicpro_df_arith_t op,
+                                      const quicpro_df_column_t *b, zval *scalar);
+
+/** @brief Whether `fn` can aggregate a column of `type`. */
+bool quicpro_df_agg_accepts(quicpro_df_agg_fn_t fn, quicpro_df_type_t type);
+
+/** @brief An empty state. */
+void quicpro_df_agg_init(quicpro_df_agg_state_t *st);
+
+/** @brief Adds rows [begin, end) of `c` (NULL: count rows) to `st`. */
+void quicpro_df_agg_update(quicpro_df_agg_state_t *st, const quicpro_df_column_t *c, int64_t begin, int64_t end);
+
+/** @brief Adds one row of `c` to `st`; the row must be valid. */
+void quicpro_df_agg_add(quicpro_df_agg_state_t *st, const quicpro_df_column_t *c, int64_t row);
+
+/** @brief Adds what `from` saw of a column of `type` to `into`. */
+void quicpro_df_agg_merge(quicpro_df_agg_state_t *into, const quicpro_df_agg_state_t *from, quicpro_df_type_t type);
+
+/** @brief The type of `fn`'s result over a column of `type`. */
+quicpro_df_type_t quicpro_df_agg_type(quicpro_df_agg_fn_t fn, quicpro_df_type_t type);
+
+/** @brief `fn`'s result, null where `st` saw no value (count: 0). */
+void quicpro_df_agg_result(quicpro_df_agg_fn_t fn, quicpro_df_type_t type, const quicpro_df_agg_state_t *st, zval *out);
+
+/** @brief Aggregates all `rows` of `c` (NULL: count them) in parallel. */
+void quicpro_df_aggregate(const quicpro_df_column_t *c, int64_t rows, quicpro_df_agg_state_t *out);
+
+#endif /* QUICPRO_DATAFRAME_KERNELS_H */
@@ -0,0 +1,42 @@
+/*
+ * include/dataframe/morsel.h – Morsel-driven parallelism for DataFrame kernels
+ * ============================================================================
+ *
+ * A kernel over a frame's rows is cut into morsels of
+ * QUICPRO_DF_MORSEL_ROWS rows. The calling thread and the pool's threads
+ * take morsels from a shared counter until none is left, so a thread that
+ * drew cheap morsels simply takes more; the call returns once every
+ * morsel is done. A frame of a single morsel runs on the calling thread
+ * alone.
+ *
+ * The pool has quicpro.dataframe_cpu_parallelism_default - 1 threads (0:
+ * one per online CPU), started on first use in each process, so forked
+ * workers start their own. Kernels run outside the engine: they must not
+ * touch the request heap, zvals or exceptions, and report failures through
+ * their context.
+ */
+
+#ifndef QUICPRO_DATAFRAME_MORSEL_H
+#define QUICPRO_DATAFRAME_MORSEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* A multiple of 64, so that every morsel starts on a bitmap word */
+#define QUICPRO_DF_MORSEL_ROWS 65536
+
+/* Runs rows [begin, end) of morsel `morsel` */
+typedef void (*quicpro_df_morsel_fn)(void *ctx, size_t morsel, int64_t begin, int64_t end);
+
+static inline size_t quicpro_df_morsels(int64_t rows)
+{
+    return (size_t)((rows + QUICPRO_DF_MORSEL_ROWS - 1) / QUICPRO_DF_MORSEL_ROWS);
+}
+
+/** @brief Runs `fn` over every morsel of `rows` rows, in parallel where it pays. */
+void quicpro_df_parallel(int64_t rows, quicpro_df_morsel_fn fn, void *ctx);
+
+/** @brief Stops this process's pool (MSHUTDOWN). */
+void quicpro_df_pool_shutdown(void);
+
+#endif /* QUICPRO_DATAFRAME_MORSEL_H */
@@ -0,0 +1,96 @@
+/*
+ * include/dataframe/parquet.h – Parquet files for Quicpro\DataFrame scans
+ * =======================================================================
+ *
+ * The part of the Parquet format a scan (dataframe/scan.h) reads column
+ * chunk by column chunk: the footer's schema and row groups, and the
+ * pages of one column chunk of one row group at a time.
+ *
+ * Only flat schemas are read: each top-level required or optional leaf
+ * is a field; nested and repeated ones are left out. Fields come in as
+ * their physical values:
+ *
+ *     BOOLEAN            bool
+ *     INT32, INT64       int64 (dates, times, decimals as their integers)
+ *     FLOAT, DOUBLE      float64
+ *     BYTE_ARRAY         utf8, or a dictionary with
+ *                        quicpro.dataframe_string_interning_enable
+ *
+ * INT96 and FIXED_LEN_BYTE_ARRAY fields are known but cannot be read.
+ * Pages may be v1 or v2, PLAIN, dictionary (PLAIN_DICTIONARY or
+ * RLE_DICTIONARY) or, for booleans, RLE encoded, and uncompressed or
+ * compressed with SNAPPY, GZIP (with zlib) or ZSTD (with libzstd); other
+ * encodings and codecs throw when a page uses them.
+ *
+ * The min/max statistics of a column chunk let a scan skip row groups a
+ * filter cannot match without reading them.
+ */
+
+#ifndef QUICPRO_DATAFRAME_PARQUET_H
+#define QUICPRO_DATAFRAME_PARQUET_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dataframe/column.h"
+#include "dataframe/kernels.h"
+
+/* "PAR1" opens the file and closes it, after the footer and its length */
+#define QUICPRO_DF_PARQUET_MAGIC "PAR1"
+
+typedef struct {
+    uint64_t       offset, length;      /* Where the chunk's pages are in the file */
+    int32_t        codec;
+    int64_t        null_count;          /* -1: unknown */
+    const uint8_t *min, *max;           /* PLAIN-encoded, in the footer; NULL: unknown */
+    uint32_t       min_len, max_len;
+} quicpro_df_parquet_chunk_t;
+
+typedef struct {
+    int64_t                     rows;
+    quicpro_df_parquet_chunk_t *chunks; /* One per leaf of the schema */
+} quicpro_df_parquet_group_t;
+
+typedef struct {
+    zend_string       *name;
+    int32_t            physical;
+    quicpro_df_type_t  type;
+    bool               optional;
+    bool               readable;        /* False for INT96 and FIXED_LEN_BYTE_ARRAY */
+    uint32_t           leaf;            /* Its column chunk in each row group */
+} quicpro_df_parquet_field_t;
+
+typedef struct {
+    zend_string                *footer; /* The FileMetaData the chunks' statistics point into */
+    quicpro_df_parquet_field_t *fields;
+    uint32_t                    nfields, nleaves;
+    quicpro_df_parquet_group_t *groups;
+    size_t                      ngroups;
+    int64_t                     rows;
+} quicpro_df_parquet_t;
+
+/**
+ * @brief Reads the schema and row groups of the FileMetaData `footer`
+ * (referenced). False after throwing, with nothing to free.
+ */
+bool quicpro_df_parquet_open(quicpro_df_parquet_t *pq, zend_string *footer);
+
+void quicpro_df_parquet_free(quicpro_df_parquet_t *pq);
+
+/**
+ * @brief Whether a row of `chunk` may compare to `value` as `op` says,
+ * by its statistics; true whenever they do not tell.
+ */
+bool quicpro_df_parquet_may_match(const quicpro_df_parquet_field_t *field, const quicpro_df_parquet_chunk_t *chunk,
+                                  int64_t rows, quicpro_df_cmp_t op, zval *value);
+
+/**
+ * @brief The column of `field` in a row group of `rows` rows, from the
+ * `len` bytes of its column chunk at `data`. NULL after throwing.
+ */
+quicpro_df_column_t *quicpro_df_parquet_column(const quicpro_df_parquet_field_t *field,
+                                               const quicpro_df_parquet_chunk_t *chunk, int64_t rows,
+                                               const uint8_t *data, size_t len);
+
+#endif /* QUICPRO_DATAFRAME_PARQUET_H */
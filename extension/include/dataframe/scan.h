@@ -0,0 +1,56 @@
+/*
+ * include/dataframe/scan.h – Out-of-core scans for Quicpro\DataFrame
+ * ==================================================================
+ *
+ * DataFrame::scan() reads a Parquet file (dataframe/parquet.h) or an
+ * Arrow IPC file or stream (dataframe/arrow_ipc.h) a batch at a time,
+ * from local disk or any stream wrapper, quicpro-fs:// among them:
+ *
+ *     $scan = DataFrame::scan('quicpro-fs://events.parquet', [
+ *         'columns' => ['country', 'total'],
+ *         'filter'  => [['year', '>=', 2024], ['region', '==', 'eu']],
+ *     ]);
+ *     foreach ($scan as $i => $batch) { ... }        // a DataFrame per row group
+ *     $scan->aggregate(['rows' => 'count', 'revenue' => ['sum', 'total']]);
+ *     $scan->groupBy('country', ['revenue' => ['sum', 'total']]);
+ *
+ * A batch is a row group of a Parquet file, or a record batch of an Arrow
+ * one. Only the columns asked for and those the filters need are read,
+ * and the filters (ANDed) are applied to each batch before it is handed
+ * on; in a Parquet file, row groups whose statistics show that a filter
+ * cannot match are not read at all, and neither are the other columns of
+ * a row group once its filter columns matched no row. While a batch is
+ * worked on, the next "prefetch" (default 2) batches are on their way:
+ * from quicpro-fs:// as chunk prefetches, within the stream's read-ahead
+ * window, and from local files as read-ahead hints to the kernel.
+ *
+ * aggregate() and groupBy() take the same aggregates as their DataFrame
+ * counterparts and make a pass of their own over the file, so memory
+ * holds one batch and the aggregate state rather than the file. The
+ * group state of groupBy() is kept as partial aggregates (mean as sum and
+ * count) and compacted as batches add to it; once it grows past
+ * "spill_mb" (default a quarter of quicpro.dataframe_memory_limit_mb, or
+ * 256 MB without a limit) it is hashed by key into partitions written to
+ * an unlinked file in "spill_dir" (default the system temp dir), which
+ * are aggregated one at a time at the end. Groups come out in order of
+ * their first row unless the state spilled, and in no particular order
+ * then.
+ */
+
+#ifndef QUICPRO_DATAFRAME_SCAN_H
+#define QUICPRO_DATAFRAME_SCAN_H
+
+#include <php.h>
+
+extern zend_class_entry *quicpro_ce_dataframe_scan;
+
+/**
+ * @brief Makes `out` a scan of the file at `path` with `options` (see
+ * above). False after throwing.
+ */
+bool quicpro_df_scan_open(zval *out, zend_string *path, HashTable *options);
+
+/** @brief Registers Quicpro\DataFrame\Scan (MINIT). */
+void quicpro_df_scan_minit(void);
+
+#endif /* QUICPRO_DATAFRAME_SCAN_H */
@@ -0,0 +1,39 @@
+/*
+ * include/gpu/collective.h – Quicpro\Gpu\Collective
+ * =================================================
+ *
+ * Collective operations between the GPUs of a group of agents, for the
+ * gradient sync of distributed training: the tensors move between devices
+ * and never through PHP memory.
+ *
+ *     // Rank 0 makes the group's id and hands it to the others (Cluster::send(),
+ *     // an MCP call, the state API: anything that reaches them)
+ *     $id = Quicpro\Gpu\Collective::uniqueId();
+ *     $group = Quicpro\Gpu\Collective::join($id, $rank, $size);
+ *
+ *     $group->allReduce($gradients, 'avg');   // queued on the tensor's stream
+ *     $model->step();                         // ... while this runs on the CPU
+ *     $gradients->toBytes();                  // waits for the reduction
+ *
+ * Built on NCCL (config.m4 links libnccl when it finds it), which discovers
+ * the topology when the group forms: device to device over NVLink or PCIe
+ * peer access between the GPUs of one host (unless quicpro.gpu_p2p_enable
+ * is off), and GPUDirect RDMA or its own sockets between hosts. join()
+ * blocks until all `size` ranks have joined.
+ *
+ * Operations work in place, on the stream the tensor's copies are queued
+ * on, and return at once; whatever reads the tensor next waits for them.
+ * Every rank must call the same operations in the same order.
+ */
+
+#ifndef QUICPRO_GPU_COLLECTIVE_H
+#define QUICPRO_GPU_COLLECTIVE_H
+
+#include <php.h>
+
+extern zend_class_entry *quicpro_ce_gpu_collective;
+
+/** @brief Registers Quicpro\Gpu\Collective (MINIT). */
+void quicpro_gpu_collective_minit(void);
+
+#endif /* QUICPRO_GPU_COLLECTIVE_H */
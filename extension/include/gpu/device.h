@@ -0,0 +1,96 @@
+/*
+ * include/gpu/device.h – The GPU a worker computes on
+ * ===================================================
+ *
+ * What Quicpro\Gpu\Tensor (gpu/tensor.h) is built on, set up on first use
+ * in each process (a CUDA context does not survive fork(), so workers set
+ * up their own) and kept until the process exits:
+ *
+ *   - a memory pool: one allocation of quicpro.gpu_memory_preallocation_mb
+ *     on the device, carved into tensors without calling the driver;
+ *   - a stream pool: quicpro.cuda_stream_pool_size non-blocking streams,
+ *     handed out in turn, so transfers of different tensors overlap;
+ *   - pinned host buffers: QUICPRO_GPU_STAGING_BUFFERS page-locked buffers
+ *     that bytes from the network are received into and copied to the
+ *     device from by DMA, while the next buffer fills.
+ *
+ * The device is the one quicpro.worker_gpu_affinity_map gives the cluster
+ * worker ("0:0, 1:0, 2:1"), device 0 without it.
+ *
+ * The backend is CUDA (quicpro.gpu_default_backend "auto" or "cuda"),
+ * linked when config.m4 finds libcudart. Without it, and while
+ * quicpro.gpu_bindings_enable is off, quicpro_gpu_ready() fails.
+ *
+ * Functions that fail return false (or NULL) and leave the reason in
+ * quicpro_gpu_error(), since some run in the event loop, not a PHP call.
+ */
+
+#ifndef QUICPRO_GPU_DEVICE_H
+#define QUICPRO_GPU_DEVICE_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tensors start on this boundary in the memory pool */
+#define QUICPRO_GPU_ALIGN           256
+#define QUICPRO_GPU_STAGING_BUFFERS 4
+#define QUICPRO_GPU_STAGING_BYTES   (1u << 20)
+
+typedef struct {
+    int      device;
+    uint64_t pool_bytes, used_bytes, largest_free;
+    uint32_t allocations;
+    uint32_t streams;
+} quicpro_gpu_stats_t;
+
+/** @brief Why the last call that failed did. */
+const char *quicpro_gpu_error(void);
+
+/** @brief Sets the reason quicpro_gpu_error() gives; returns false. */
+bool quicpro_gpu_fail(const char *fmt, ...) ZEND_ATTRIBUTE_FORMAT(printf, 1, 2);
+
+/** @brief Sets up the device and its pools if they are not yet. */
+bool quicpro_gpu_ready(void);
+
+/** @brief `bytes` of the memory pool, QUICPRO_GPU_ALIGN-aligned. NULL once it has no such room. */
+void *quicpro_gpu_alloc(size_t bytes);
+
+/** @brief Returns memory of quicpro_gpu_alloc() to the pool; no transfer may still use it. */
+void quicpro_gpu_free(void *ptr);
+
+/** @brief The next stream of the pool, in turn. */
+unsigned quicpro_gpu_stream(void);
+
+/**
+ * @brief The next pinned buffer (QUICPRO_GPU_STAGING_BYTES), once the
+ * copy last made from it is done.
+ */
+uint8_t *quicpro_gpu_staging(void);
+
+/**
+ * @brief Copies `len` bytes of the pinned buffer `staging` to `device`
+ * on `stream`, returning at once; the buffer is handed out again only
+ * once the copy is done.
+ */
+bool quicpro_gpu_upload(void *device, uint8_t *staging, size_t len, unsigned stream);
+
+/** @brief Copies `len` bytes at `device` to `host` through the pinned buffers, after what `stream` has queued. */
+bool quicpro_gpu_download(void *host, const void *device, size_t len, unsigned stream);
+
+/** @brief The cudaStream_t of stream `stream`, for libraries that queue work on it; NULL without CUDA. */
+void *quicpro_gpu_stream_handle(unsigned stream);
+
+/** @brief Copies `len` bytes from `from` to `to`, both on the device, after what `stream` has queued. */
+bool quicpro_gpu_copy(void *to, const void *from, size_t len, unsigned stream);
+
+/** @brief Waits for what `stream` has queued so far. */
+bool quicpro_gpu_sync(unsigned stream);
+
+void quicpro_gpu_stats(quicpro_gpu_stats_t *out);
+
+/** @brief Releases the pools of this process (MSHUTDOWN). */
+void quicpro_gpu_mshutdown(void);
+
+#endif /* QUICPRO_GPU_DEVICE_H */
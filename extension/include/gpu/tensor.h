@@ -0,0 +1,131 @@
+/*
+ * include/gpu/tensor.h – Quicpro\Gpu\Tensor
+ * =========================================
+ *
+ * A dense tensor held in the GPU memory pool (gpu/device.h); PHP holds
+ * its shape and type, never its data:
+ *
+ *     $t = quicpro_mcp_request($conn, 'embedder', 'Embed', $text);  // a Tensor
+ *     $t->shape();                           // [32, 768]
+ *     $t->dtype();                           // 'float16'
+ *     $t->toBytes();                         // only when asked: a copy to the heap
+ *
+ * An MCP body sent as application/vnd.quicpro.tensor, with its type and
+ * shape in the quicpro-tensor-dtype and quicpro-tensor-shape headers
+ * ("32,768"), is received straight into pinned host buffers as quiche
+ * hands it over, and each buffer is copied to the tensor's place in the
+ * pool by DMA on a stream of the pool while the next one fills: a
+ * response to quicpro_mcp_request() comes back as a Tensor, and a request
+ * to a schema-less MCP handler arrives as one (a Tensor such a handler
+ * returns goes back as a tensor body). The copies run behind the
+ * tensor's stream; whatever reads the tensor queues on that stream after
+ * them (toBytes() waits for them).
+ */
+
+#ifndef QUICPRO_GPU_TENSOR_H
+#define QUICPRO_GPU_TENSOR_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define QUICPRO_GPU_TENSOR_TYPE      "application/vnd.quicpro.tensor"
+#define QUICPRO_GPU_TENSOR_DIMS_MAX  8
+
+typedef enum {
+    QUICPRO_GPU_FLOAT16,
+    QUICPRO_GPU_BFLOAT16,
+    QUICPRO_GPU_FLOAT32,
+    QUICPRO_GPU_FLOAT64,
+    QUICPRO_GPU_INT8,
+    QUICPRO_GPU_UINT8,
+    QUICPRO_GPU_INT16,
+    QUICPRO_GPU_INT32,
+    QUICPRO_GPU_INT64,
+} quicpro_gpu_dtype_t;
+
+typedef struct {
+    uint8_t            *data;           /* In the memory pool */
+    size_t              bytes;
+    quicpro_gpu_dtype_t dtype;
+    uint32_t            ndim;
+    int64_t             shape[QUICPRO_GPU_TENSOR_DIMS_MAX];
+    unsigned            stream;         /* What has been queued on it is the tensor's */
+    zend_object         std;
+} quicpro_gpu_tensor_object;
+
+extern zend_class_entry *quicpro_ce_gpu_tensor;
+
+static inline quicpro_gpu_tensor_object *quicpro_gpu_tensor_from_obj(zend_object *obj)
+{
+    return (quicpro_gpu_tensor_object *)((char *)obj - XtOffsetOf(quicpro_gpu_tensor_object, std));
+}
+
+/** @brief Parses "float16", "bfloat16", "float32", "float64", "int8", "uint8", "int16", "int32", "int64". */
+bool quicpro_gpu_dtype_parse(const char *name, size_t len, quicpro_gpu_dtype_t *out);
+const char *quicpro_gpu_dtype_name(quicpro_gpu_dtype_t dtype);
+size_t quicpro_gpu_dtype_size(quicpro_gpu_dtype_t dtype);
+
+/** @brief Makes `out` a tensor of the pool memory `data` (taken over), whose copies are queued on `stream`. */
+void quicpro_gpu_tensor_wrap(zval *out, quicpro_gpu_dtype_t dtype, const int64_t *shape, uint32_t ndim,
+                             uint8_t *data, size_t bytes, unsigned stream);
+
+/** @brief Writes `shape` as quicpro-tensor-shape has it ("32,768") into `buf`; its length. */
+size_t quicpro_gpu_shape_format(const int64_t *shape, uint32_t ndim, char *buf, size_t cap);
+
+/**
+ * @brief Makes `out` one tensor of the `n` tensors `items`, which share a
+ * dtype and shape, along a new first dimension of `n`: a batch one kernel
+ * launch takes. The items are copied on the device and left as they are.
+ */
+bool quicpro_gpu_tensor_stack(zval *out, quicpro_gpu_tensor_object *const *items, uint32_t n);
+
+/*
+ * A tensor body on its way in: filled through room() and commit(), with
+ * the headers of its message gathered first by tensor_header(). Failures
+ * leave their reason in quicpro_gpu_error().
+ */
+typedef struct {
+    bool tensor;                        /* Sent as QUICPRO_GPU_TENSOR_TYPE */
+    char dtype[16];
+    char shape[128];
+} quicpro_gpu_tensor_head_t;
+
+typedef struct quicpro_gpu_upload_s quicpro_gpu_upload_t;
+
+/** @brief Notes a header of a message that may carry a tensor; true for those that tell it. */
+bool quicpro_gpu_tensor_header(quicpro_gpu_tensor_head_t *head, const uint8_t *name, size_t name_len,
+                               const uint8_t *value, size_t value_len);
+
+/** @brief Places the tensor of a message with the headers `head` in the pool. NULL on failure. */
+quicpro_gpu_upload_t *quicpro_gpu_upload_from_head(const quicpro_gpu_tensor_head_t *head);
+
+quicpro_gpu_upload_t *quicpro_gpu_upload_begin(quicpro_gpu_dtype_t dtype, const int64_t *shape, uint32_t ndim);
+
+/**
+ * @brief Where the next bytes of the body go: *to, pinned memory with
+ * room for *room of them; 0 once the tensor is complete.
+ */
+bool quicpro_gpu_upload_room(quicpro_gpu_upload_t *up, uint8_t **to, size_t *room);
+
+/** @brief `n` bytes were written where room() said; full buffers go to the device. */
+bool quicpro_gpu_upload_commit(quicpro_gpu_upload_t *up, size_t n);
+
+/**
+ * @brief Sends what the pinned buffer holds to the device. The buffers are
+ * shared by every upload of the process: one is held from room() to the
+ * flush() (or the commit() that fills it), so call this before returning
+ * to the event loop.
+ */
+bool quicpro_gpu_upload_flush(quicpro_gpu_upload_t *up);
+
+/** @brief Makes `out` the tensor, once all its bytes came, and frees `up` either way. */
+bool quicpro_gpu_upload_finish(quicpro_gpu_upload_t *up, zval *out);
+
+/** @brief Gives up on the tensor, returning its memory once copies in flight are done. */
+void quicpro_gpu_upload_abort(quicpro_gpu_upload_t *up);
+
+/** @brief Registers Quicpro\Gpu\Tensor (MINIT). */
+void quicpro_gpu_tensor_minit(void);
+
+#endif /* QUICPRO_GPU_TENSOR_H */
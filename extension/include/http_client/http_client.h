@@ -0,0 +1,89 @@
+#ifndef QUICPRO_HTTP_CLIENT_H
+#define QUICPRO_HTTP_CLIENT_H
+
+#include <php.h>
+#include <poll.h>
+
+/**
+ * @file extension/include/http_client/http_client.h
+ * @brief libcurl-based HTTP/1.1 and HTTP/2 client for TCP origins.
+ *
+ * Every transfer runs on one CURLM multi handle per worker. A CURLSH
+ * share handle gives all transfers the same DNS cache, connection pool
+ * and TLS session cache. A vendor that only speaks HTTP/1.1 therefore
+ * gets keep-alive across calls, and a batch gets parallel transfers.
+ *
+ * quicpro_http_request_send() blocks until its own response is complete.
+ * quicpro_http_batch_submit() starts any number of requests and returns
+ * their ids. quicpro_http_batch_wait() then hands back completions in
+ * the order they finish.
+ *
+ * Response headers are parsed as they arrive. The body is buffered unless
+ * the `output_stream` or `on_body` option is set. With either, each chunk
+ * goes straight to that sink, so a download of any size costs one
+ * receive buffer.
+ */
+
+/**
+ * @brief quicpro_http_request_send() for C callers such as the unified
+ * client (include/client/index.h): fills `return_value` with the result
+ * array.
+ * @return false after throwing.
+ */
+bool quicpro_http_request(const char *url_str, const char *method_str, zval *headers_array, zend_string *body,
+                          zval *options_array, zval *return_value);
+
+/**
+ * @brief POSTs `body` as `content_type` to `url` on the worker's transfer
+ * engine and waits for the response, for C callers: other modules' calls
+ * share the pool's connections like quicpro_http_request_send() does.
+ * @param timeout_ms Of the whole transfer; 0 for none.
+ * @return The response status with its body in `*out`, which the caller
+ * releases; 0 after throwing.
+ */
+long quicpro_http_post(const char *url, const char *content_type, zend_string *body, zend_long timeout_ms,
+                       zend_string **out);
+
+/*
+ * C callers that drive the engine from a loop of their own (the load
+ * generator, include/client/loadgen.h) use the batch queue directly:
+ * their completions and quicpro_http_batch_wait()'s are the same queue,
+ * so such a caller starts only while quicpro_http_pending() is 0.
+ */
+
+/**
+ * @brief Starts a request like one of quicpro_http_batch_submit()'s.
+ * @return Its id; 0 after throwing.
+ */
+uint64_t quicpro_http_submit(const char *url, const char *method, zval *headers, zend_string *body, zval *options);
+
+/** @brief Moves every transfer forward without waiting; false after throwing. */
+bool quicpro_http_step(void);
+
+/**
+ * @brief Takes the oldest completion: its id and response status, 0 for a
+ * transfer that failed. Its body is dropped.
+ */
+bool quicpro_http_take(uint64_t *id, long *status);
+
+/**
+ * @brief Waits up to `timeout_ms` for the engine's sockets and timers or
+ * for input on one of `extra`, whose `revents` it sets; false after throwing.
+ */
+bool quicpro_http_poll(struct pollfd *extra, unsigned count, int timeout_ms);
+
+/** @brief Batch requests whose completion has not been taken yet. */
+zend_long quicpro_http_pending(void);
+
+/** @brief Drops transfers still running or unclaimed at request end (RSHUTDOWN). */
+void quicpro_http_client_rshutdown(void);
+
+/** @brief Frees the multi and share handles and the idle easy handles (MSHUTDOWN). */
+void quicpro_http_client_mshutdown(void);
+
+PHP_FUNCTION(quicpro_http_request_send);
+PHP_FUNCTION(quicpro_http_batch_submit);
+PHP_FUNCTION(quicpro_http_batch_wait);
+PHP_FUNCTION(quicpro_http_batch_pending);
+
+#endif // QUICPRO_HTTP_CLIENT_H
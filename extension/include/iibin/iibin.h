@@ -1,8 +1,8 @@
 /*
- * include/proto.h – Public Interface for Quicpro\Proto Serialization
- * ====================================================================
+ * include/iibin/iibin.h – Public Interface for Quicpro\IIBIN Serialization
+ * ========================================================================
  *
- * This header file declares the function prototypes for the Quicpro\Proto
+ * This header file declares the function prototypes for the Quicpro\IIBIN
  * serialization and deserialization functionalities within the php-quicpro_async
  * extension. It provides a Protobuf-like mechanism for defining message
  * schemas and enum types, and efficiently encoding/decoding PHP data structures
@@ -13,23 +13,23 @@
  * - Encoding PHP arrays or objects into a binary string based on a defined schema.
  * - Decoding a binary string back into a PHP array or stdClass object based on a schema.
  *
- * Implementations reside in proto_schema.c, proto_encoding.c, and proto_decoding.c.
- * Argument information (arginfo) is in php_quicpro_arginfo.h.
+ * Implementations reside in iibin_schema.c, iibin_encoding.c, and iibin_decoding.c.
+ * The Quicpro\IIBIN class and its arginfo are in iibin.c.
  */
 
-#ifndef QUICPRO_PROTO_H
-#define QUICPRO_PROTO_H
+#ifndef QUICPRO_IIBIN_H
+#define QUICPRO_IIBIN_H
 
 #include <php.h> /* Required for PHP_FUNCTION macro, zval, zend_string, etc. */
 
 /*
- * PHP_FUNCTION(quicpro_proto_define_enum);
+ * PHP_FUNCTION(quicpro_iibin_define_enum);
  * ----------------------------------------
  * Defines an enumeration type for use in message schemas.
  * Enums are typically transmitted as integers.
  *
  * Userland Signature (conceptual, actual in php_quicpro_arginfo.h):
- * bool Quicpro\Proto::defineEnum(string $enumName, array $enumValues)
+ * bool Quicpro\IIBIN::defineEnum(string $enumName, array $enumValues)
  *
  * $enumValues Example:
  * [
@@ -39,17 +39,17 @@
  * 'STATUS_ERROR'       => 10 // Values can be non-contiguous
  * ]
  *
- * Returns: true on successful definition, false on error. Throws ProtoException.
+ * Returns: true on successful definition, false on error. Throws IIBINException.
  */
-PHP_FUNCTION(quicpro_proto_define_enum);
+PHP_FUNCTION(quicpro_iibin_define_enum);
 
 /*
- * PHP_FUNCTION(quicpro_proto_define_schema);
+ * PHP_FUNCTION(quicpro_iibin_define_schema);
  * ------------------------------------------
  * Defines and compiles a message schema for later use in encoding/decoding.
  *
  * Userland Signature (conceptual, actual in php_quicpro_arginfo.h):
- * bool Quicpro\Proto::defineSchema(string $schemaName, array $schemaDefinition)
+ * bool Quicpro\IIBIN::defineSchema(string $schemaName, array $schemaDefinition)
  *
  * $schemaDefinition Example:
  * [
@@ -57,81 +57,125 @@ PHP_FUNCTION(quicpro_proto_define_enum);
  * 'id'     => ['type' => 'int64',  'tag' => 2]
  * ]
  *
- * Returns: true on successful definition, false on error. Throws ProtoException.
+ * Returns: true on successful definition, false on error. Throws IIBINException.
  */
-PHP_FUNCTION(quicpro_proto_define_schema);
+PHP_FUNCTION(quicpro_iibin_define_schema);
 
 /*
- * PHP_FUNCTION(quicpro_proto_encode);
+ * PHP_FUNCTION(quicpro_iibin_encode);
+
+/*
+ * PHP_FUNCTION(quicpro_iibin_encode_many);
+ * ----------------------------------------
+ * IIBIN::encode() over a list of messages with one schema lookup; keys
+ * are kept. Throws on the first message that does not fit the schema.
+ *
+ * Userland Signature:
+ * array Quicpro\IIBIN::encodeMany(string $schemaName, array $messages)
+ */
+PHP_FUNCTION(quicpro_iibin_encode_many);
  * -----------------------------------
  * Encodes a PHP array or object into a binary string using a predefined schema.
  *
  * Userland Signature:
- * string|false Quicpro\Proto::encode(string $schemaName, array|object $phpData)
+ * string|false Quicpro\IIBIN::encode(string $schemaName, array|object $phpData)
  */
-PHP_FUNCTION(quicpro_proto_encode);
+PHP_FUNCTION(quicpro_iibin_encode);
 
 /*
- * PHP_FUNCTION(quicpro_proto_decode);
+ * PHP_FUNCTION(quicpro_iibin_encode_to_stream);
+ * ---------------------------------------------
+ * Encodes straight into a PHP stream in chunks of about 16 KiB, after a
+ * sizing pass; large string fields are written from the value itself.
+ * Nothing is written if the data does not fit the schema.
+ *
+ * Userland Signature:
+ * int Quicpro\IIBIN::encodeToStream(string $schemaName, array|object $phpData, resource $stream)
+ * Returns the number of bytes written.
+ */
+PHP_FUNCTION(quicpro_iibin_encode_to_stream);
+
+/*
+ * PHP_FUNCTION(quicpro_iibin_decode);
  * -----------------------------------
  * Decodes a binary string into a PHP associative array (or stdClass) using a predefined schema.
  *
  * Userland Signature:
- * array|object|false Quicpro\Proto::decode(string $schemaName, string $binaryData [, bool $decodeAsObject = false])
+ * array|object|false Quicpro\IIBIN::decode(string $schemaName, string $binaryData [, bool $decodeAsObject = false [, bool $arena = false]])
+ *
+ * With $arena the array is returned as immutable arrays in a block that
+ * lives until the request ends (iibin_arena.c): nothing in it is reference
+ * counted, and releasing it costs nothing. Writes separate a copy as usual.
  */
-PHP_FUNCTION(quicpro_proto_decode);
+PHP_FUNCTION(quicpro_iibin_decode);
 
 /*
- * PHP_FUNCTION(quicpro_proto_is_defined);
+ * PHP_FUNCTION(quicpro_iibin_is_defined);
  * ---------------------------------------
  * Checks if a schema OR enum with the given name has already been defined.
  * To check for a specific type (schema or enum), use the more specific functions below.
  *
  * Userland Signature:
- * bool Quicpro\Proto::isDefined(string $name)
+ * bool Quicpro\IIBIN::isDefined(string $name)
  */
-PHP_FUNCTION(quicpro_proto_is_defined); // Might need refinement or separate isSchemaDefined/isEnumDefined
+PHP_FUNCTION(quicpro_iibin_is_defined); // Might need refinement or separate isSchemaDefined/isEnumDefined
 
 /*
- * PHP_FUNCTION(quicpro_proto_is_schema_defined);
+ * PHP_FUNCTION(quicpro_iibin_is_schema_defined);
  * ---------------------------------------------
  * Checks if a message schema with the given name has already been defined.
  *
  * Userland Signature:
- * bool Quicpro\Proto::isSchemaDefined(string $schemaName)
+ * bool Quicpro\IIBIN::isSchemaDefined(string $schemaName)
  */
-PHP_FUNCTION(quicpro_proto_is_schema_defined);
+PHP_FUNCTION(quicpro_iibin_is_schema_defined);
 
 /*
- * PHP_FUNCTION(quicpro_proto_is_enum_defined);
+ * PHP_FUNCTION(quicpro_iibin_is_enum_defined);
  * -------------------------------------------
  * Checks if an enum with the given name has already been defined.
  *
  * Userland Signature:
- * bool Quicpro\Proto::isEnumDefined(string $enumName)
+ * bool Quicpro\IIBIN::isEnumDefined(string $enumName)
  */
-PHP_FUNCTION(quicpro_proto_is_enum_defined);
+PHP_FUNCTION(quicpro_iibin_is_enum_defined);
 
 
 /*
- * PHP_FUNCTION(quicpro_proto_get_defined_schemas);
+ * PHP_FUNCTION(quicpro_iibin_get_defined_schemas);
  * ------------------------------------------------
  * Retrieves a list of all currently defined message schema names.
  *
  * Userland Signature:
- * array Quicpro\Proto::getDefinedSchemas(void)
+ * array Quicpro\IIBIN::getDefinedSchemas(void)
  */
-PHP_FUNCTION(quicpro_proto_get_defined_schemas);
+PHP_FUNCTION(quicpro_iibin_get_defined_schemas);
 
 /*
- * PHP_FUNCTION(quicpro_proto_get_defined_enums);
+ * PHP_FUNCTION(quicpro_iibin_get_defined_enums);
  * ----------------------------------------------
  * Retrieves a list of all currently defined enum type names.
  *
  * Userland Signature:
- * array Quicpro\Proto::getDefinedEnums(void)
+ * array Quicpro\IIBIN::getDefinedEnums(void)
+ */
+PHP_FUNCTION(quicpro_iibin_get_defined_enums);
+
+/*
+ * Module lifecycle (iibin.c), called from the extension's MINIT/MSHUTDOWN.
+ * MINIT registers Quicpro\IIBIN, Quicpro\IIBIN\View and Quicpro\IIBIN\Batch
+ * and creates the schema registry; MSHUTDOWN frees every registered schema
+ * and enum.
+ */
+void quicpro_iibin_minit(void);
+void quicpro_iibin_mshutdown(void);
+
+/*
+ * Frees the request arena (iibin_arena.c). Called once the executor is
+ * gone, from the extension's post-deactivate hook, because the arrays in
+ * it may be referenced until then.
  */
-PHP_FUNCTION(quicpro_proto_get_defined_enums);
+void quicpro_iibin_arena_release(void);
 
 
-#endif /* QUICPRO_PROTO_H */
\ No newline at end of file
+#endif /* QUICPRO_IIBIN_H */
\ No newline at end of file
@@ -0,0 +1,57 @@
+/*
+ * include/iibin/iibin_batch.h – Columnar IIBIN batches of one schema
+ * ===================================================================
+ *
+ * A list of many small messages of one schema (telemetry samples, CRUD
+ * result rows) repeats the same keys in every row, and neighbouring rows
+ * hold similar values. IIBIN::encodeBatch() writes such a list column by
+ * column, with an encoding that suits each field's type:
+ *
+ *     integers, enums   deltas to the previous row, zigzag varints
+ *     bools             one bit per row
+ *     floats, doubles   4 or 8 bytes per row
+ *     strings, bytes    a dictionary and one index per row, unless most
+ *                       values are distinct; then length and bytes
+ *     repeated fields,  each row's field as IIBIN::encode() writes it
+ *     nested messages
+ *
+ *     $batch = IIBIN::encodeBatch('Sample', $rows);
+ *     $rows  = IIBIN::decodeBatch('Sample', $batch);   // Quicpro\IIBIN\Batch
+ *     foreach ($rows as $i => $row) { ... }            // one array per row
+ *     $temps = $rows->column('temperature');           // one list per column
+ *
+ * decodeBatch() checks the whole batch and unpacks the columns into C
+ * arrays, but creates no PHP values. A row becomes an array when it is
+ * read, with fields in tag order and defaults filled in as by
+ * IIBIN::decode(). Rows are not kept; reading one twice builds it twice.
+ * The dictionary strings are created once and shared by every row.
+ *
+ * Format, all integers varints unless noted:
+ *
+ *     batch    := version (1 byte, 1)  rows  columns  column*
+ *     column   := tag  body_len  body
+ *     body     := presence (1 byte)  [bitmap]  encoding (1 byte)  values
+ *
+ * Presence 0: the field is set in every row. Presence 1: a bitmap of
+ * ceil(rows / 8) bytes follows, bit r (LSB first) set for each row r that
+ * has the field; values are written for those rows only. A field that no
+ * row has gets no column. Columns with a tag the schema lacks are skipped.
+ */
+
+#ifndef QUICPRO_IIBIN_BATCH_H
+#define QUICPRO_IIBIN_BATCH_H
+
+#include <php.h>
+
+extern zend_class_entry *quicpro_ce_iibin_batch;
+
+/** @brief Registers Quicpro\IIBIN\Batch (MINIT, from quicpro_iibin_minit()). */
+void quicpro_iibin_batch_minit(void);
+
+/* Quicpro\IIBIN::encodeBatch(string $schemaName, array $rows): string */
+PHP_FUNCTION(quicpro_iibin_encode_batch);
+
+/* Quicpro\IIBIN::decodeBatch(string $schemaName, string $binaryData): Quicpro\IIBIN\Batch */
+PHP_FUNCTION(quicpro_iibin_decode_batch);
+
+#endif /* QUICPRO_IIBIN_BATCH_H */
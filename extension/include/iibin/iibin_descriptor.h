@@ -0,0 +1,63 @@
+/*
+ * include/iibin/iibin_descriptor.h – IIBIN schema descriptors and IDs
+ * ===================================================================
+ *
+ * Both ends of a connection must agree on a schema before either can read
+ * the other's messages. Every schema therefore has a descriptor, a
+ * canonical encoding of its definition together with every schema and enum
+ * it uses, and an ID, the 32-bit fingerprint of that descriptor. Two
+ * processes that defined the same schema the same way compute the same ID;
+ * a change to any field, nested schema or enum value changes it.
+ *
+ *     $id   = IIBIN::schemaId('Order');             // int, never 0
+ *     $desc = IIBIN::schemaDescriptor('Order');     // string, send it once
+ *
+ *     $name = IIBIN::defineFromDescriptor($desc);   // peer: 'Order'
+ *     $name = IIBIN::schemaNameById($id);           // peer: 'Order', or null
+ *
+ * defineFromDescriptor() defines whatever the descriptor holds that is not
+ * defined yet. Names that are defined already are kept as they are; if the
+ * local definition differs, the rebuilt root gets another ID and the call
+ * throws. Definitions made before the failing entry stay defined.
+ *
+ * MCP calls carry the ID of their request schema in a
+ * `quicpro-iibin-schema` header, and the descriptor, base64, in
+ * `quicpro-iibin-descriptor` until the peer has answered a call with that
+ * ID once (include/mcp/mcp.h).
+ *
+ * Format, all integers varints, strings a varint length and the bytes:
+ *
+ *     descriptor := 'I' 'D' version (1 byte, 1)  count  entry*
+ *     entry      := kind (1 byte)  name  body      dependencies first,
+ *                                                  the root schema last
+ *     enum body  := count  (name  zigzag(number))*     by number
+ *     schema     := count  field*                      by tag
+ *     field      := tag  type (1 byte)  flags (1 byte)  name  ref  json_name  default
+ *     default    := 0 none | 1 null | 2 false | 3 true
+ *                 | 4 zigzag(long) | 5 double (8 bytes LE) | 6 string
+ *
+ * Kinds are 'E' and 'S'. Types number the primitives as in
+ * quicpro_iibin_field_type_internal; ref is the schema or enum name of a
+ * message or enum field and empty otherwise. Flags: 1 required,
+ * 2 repeated, 4 packed, 8 deprecated. The ID is the FNV-1a hash of the
+ * descriptor, with 0 mapped to 1.
+ */
+
+#ifndef QUICPRO_IIBIN_DESCRIPTOR_H
+#define QUICPRO_IIBIN_DESCRIPTOR_H
+
+#include <php.h>
+
+/* Quicpro\IIBIN::schemaId(string $schemaName): int */
+PHP_FUNCTION(quicpro_iibin_schema_id);
+
+/* Quicpro\IIBIN::schemaDescriptor(string $schemaName): string */
+PHP_FUNCTION(quicpro_iibin_schema_descriptor);
+
+/* Quicpro\IIBIN::defineFromDescriptor(string $descriptor): string */
+PHP_FUNCTION(quicpro_iibin_define_from_descriptor);
+
+/* Quicpro\IIBIN::schemaNameById(int $id): ?string */
+PHP_FUNCTION(quicpro_iibin_schema_name_by_id);
+
+#endif /* QUICPRO_IIBIN_DESCRIPTOR_H */
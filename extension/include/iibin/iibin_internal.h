@@ -1,59 +1,29 @@
 /*
- * src/proto_internal.h – Internal Definitions for Quicpro\Proto Module
- * =====================================================================
+ * include/iibin/iibin_internal.h – Internal Definitions for Quicpro\IIBIN
+ * =======================================================================
  *
  * This header file contains C struct definitions, constants, global variable
- * declarations, and static inline wire format utilities shared across the
- * different C source files that implement the Quicpro\Proto functionality.
+ * declarations, and static inline wire format writers shared across the
+ * different C source files that implement the Quicpro\IIBIN functionality.
  */
 
-#ifndef QUICPRO_PROTO_INTERNAL_H
-#define QUICPRO_PROTO_INTERNAL_H
+#ifndef QUICPRO_IIBIN_INTERNAL_H
+#define QUICPRO_IIBIN_INTERNAL_H
 
 #include <php.h>
 #include <stdint.h>
+#include <string.h>
 #include <zend_hash.h>
 #include <zend_smart_str.h>
 
-/* --- Wire Format Constants (Protobuf-like) --- */
-#define QUICPRO_WIRETYPE_VARINT         0
-#define QUICPRO_WIRETYPE_FIXED64        1
-#define QUICPRO_WIRETYPE_LENGTH_DELIM   2
-#define QUICPRO_WIRETYPE_FIXED32        5
+#include "iibin_wire.h"   /* Wire types, field types, opcodes, varint/fixed/zigzag kernels */
 
 /* --- Internal Data Structures for Compiled Schemas & Enums --- */
 
-typedef enum _quicpro_proto_field_type_internal {
-    PROTO_INTERNAL_TYPE_UNKNOWN = 0,
-    PROTO_INTERNAL_TYPE_DOUBLE,
-    PROTO_INTERNAL_TYPE_FLOAT,
-    PROTO_INTERNAL_TYPE_INT64,
-    PROTO_INTERNAL_TYPE_UINT64,
-    PROTO_INTERNAL_TYPE_INT32,
-    PROTO_INTERNAL_TYPE_UINT32,
-    PROTO_INTERNAL_TYPE_SINT32,
-    PROTO_INTERNAL_TYPE_SINT64,
-    PROTO_INTERNAL_TYPE_FIXED64,
-    PROTO_INTERNAL_TYPE_SFIXED64,
-    PROTO_INTERNAL_TYPE_FIXED32,
-    PROTO_INTERNAL_TYPE_SFIXED32,
-    PROTO_INTERNAL_TYPE_BOOL,
-    PROTO_INTERNAL_TYPE_STRING,
-    PROTO_INTERNAL_TYPE_BYTES,
-    PROTO_INTERNAL_TYPE_MESSAGE,
-    PROTO_INTERNAL_TYPE_ENUM
-} quicpro_proto_field_type_internal;
-
-#define PROTO_FIELD_FLAG_NONE     0x00
-#define PROTO_FIELD_FLAG_OPTIONAL 0x01
-#define PROTO_FIELD_FLAG_REQUIRED 0x02
-#define PROTO_FIELD_FLAG_REPEATED 0x04
-#define PROTO_FIELD_FLAG_PACKED   0x08
-
-typedef struct _quicpro_proto_field_def_internal {
+typedef struct _quicpro_iibin_field_def_internal {
     char *name_in_php;
     uint32_t tag;
-    quicpro_proto_field_type_internal type;
+    quicpro_iibin_field_type_internal type;
     uint8_t flags;
     char *json_name;
     zend_bool is_deprecated;
@@ -61,138 +31,234 @@ typedef struct _quicpro_proto_field_def_internal {
     char *enum_type_name_if_enum;
     zval default_value_zval;
     uint32_t wire_type;
-} quicpro_proto_field_def_internal;
+} quicpro_iibin_field_def_internal;
 
-typedef struct _quicpro_compiled_schema_internal {
-    char *schema_name;
-    HashTable fields_by_tag;
-    HashTable fields_by_name;
-    quicpro_proto_field_def_internal **ordered_fields;
-    size_t num_fields;
-} quicpro_compiled_schema_internal;
-
-typedef struct _quicpro_proto_enum_value_def_internal {
+typedef struct _quicpro_iibin_enum_value_def_internal {
     char *name;
     int32_t number;
-} quicpro_proto_enum_value_def_internal;
+} quicpro_iibin_enum_value_def_internal;
 
-typedef struct _quicpro_compiled_enum_internal {
+typedef struct _quicpro_iibin_compiled_enum_internal {
     char *enum_name;
     HashTable values_by_name;
     HashTable names_by_value;
-} quicpro_compiled_enum_internal;
+} quicpro_iibin_compiled_enum_internal;
 
+/*
+ * --- Compiled Codec Programs ---
+ *
+ * quicpro_iibin_define_schema() compiles every schema into a flat program
+ * with one instruction per field, in tag order (iibin_program.c). All the
+ * work that depends only on the schema is done once at that point:
+ * - the field key (tag << 3 | wire type) is varint-encoded in advance;
+ * - the PHP type is reduced to one opcode per wire encoding;
+ * - the field name is a permanent interned zend_string, hash included;
+ * - nested schemas and enums are direct pointers.
+ * The encoder executes the program in order. The decoder finds an
+ * instruction by tag through the dense `by_tag` table. Schemas are never
+ * redefined or removed before MSHUTDOWN, so the pointers stay valid.
+ */
 
-/* --- Global Schema and Enum Registry Extern Declarations --- */
-/* Defined in proto_schema.c */
-extern HashTable quicpro_schema_registry;
-extern HashTable quicpro_enum_registry;
-extern zend_bool quicpro_registries_initialized;
+struct _quicpro_iibin_compiled_schema_internal;
 
+typedef struct _quicpro_iibin_insn {
+    uint8_t op;                         /* quicpro_iibin_opcode */
+    uint8_t flags;                      /* IIBIN_FIELD_FLAG_* */
+    uint8_t key_len;
+    uint8_t key[IIBIN_MAX_KEY_LEN];     /* The key as written before each value */
+    uint32_t tag;
+    uint32_t wire_type;                 /* Of a single value, also inside a packed run */
+    zend_string *name;                  /* Permanent interned, hash precomputed */
+    const struct _quicpro_iibin_compiled_schema_internal *nested;  /* IIBIN_OP_MESSAGE */
+    const quicpro_iibin_compiled_enum_internal *enum_def;          /* IIBIN_OP_ENUM */
+    const quicpro_iibin_field_def_internal *field;                 /* Errors, defaults */
+} quicpro_iibin_insn;
 
-/* --- Internal C Utility Function Prototypes --- */
-/* (Defined in proto_schema.c) */
+typedef struct _quicpro_iibin_compiled_schema_internal {
+    char *schema_name;
+    HashTable fields_by_tag;
+    HashTable fields_by_name;
+    quicpro_iibin_field_def_internal **ordered_fields;
+    size_t num_fields;
 
-const quicpro_compiled_schema_internal* get_compiled_schema_internal(const char *schema_name);
-const quicpro_compiled_enum_internal* get_compiled_enum_internal(const char *enum_name);
+    /* Compiled program, see above */
+    quicpro_iibin_insn *program;        /* num_fields instructions, tag order */
+    uint16_t *by_tag;                   /* tag → instruction index + 1, 0 = unknown */
+    uint32_t by_tag_len;                /* Entries in by_tag: highest dense tag + 1 */
+    zend_bool has_defaults_or_required; /* Decoder needs the post-pass */
+    zend_bool has_nested;               /* Encoder measures nested bodies first */
 
+    /* Canonical definition and its ID, see iibin_descriptor.c */
+    char *descriptor;                   /* Persistent; descriptor_len bytes */
+    size_t descriptor_len;
+    uint32_t fingerprint;               /* Never 0 */
+} quicpro_iibin_compiled_schema_internal;
 
-/* --- Static Inline Low-Level Wire Format Utilities --- */
+/**
+ * @brief Compiles `schema->ordered_fields` (sorted by tag) into its program.
+ * Referenced schemas and enums must already be defined.
+ * @return SUCCESS, or FAILURE after throwing.
+ */
+int quicpro_iibin_compile_program(quicpro_iibin_compiled_schema_internal *schema);
 
-static inline void quicpro_proto_encode_varint(smart_str *buf, uint64_t value) {
-    unsigned char temp_buf[10];
-    int i = 0;
-    do {
-        temp_buf[i] = (unsigned char)(value & 0x7FU);
-        value >>= 7;
-        if (value > 0) {
-            temp_buf[i] |= 0x80U;
-        }
-        i++;
-    } while (value > 0 && i < 10);
-    smart_str_appendl(buf, (char*)temp_buf, i);
-}
+/** @brief Frees what quicpro_iibin_compile_program() allocated. */
+void quicpro_iibin_free_program(quicpro_iibin_compiled_schema_internal *schema);
 
-static inline zend_bool quicpro_proto_decode_varint(const unsigned char **buf_ptr, const unsigned char *buf_end, uint64_t *value_out) {
-    uint64_t result = 0;
-    int shift = 0;
-    const unsigned char *ptr = *buf_ptr;
-    for (int i = 0; i < 10; ++i) {
-        if (ptr >= buf_end) return 0;
-        unsigned char byte = *ptr++;
-        result |= (uint64_t)(byte & 0x7F) << shift;
-        if (!(byte & 0x80U)) {
-            *value_out = result;
-            *buf_ptr = ptr;
-            return 1;
+/**
+ * @brief Decoder lookup of the instruction for `tag`, or NULL if the schema
+ * has no such field. Tags past the dense table are binary-searched in the
+ * program, which is sorted by tag.
+ */
+static inline const quicpro_iibin_insn *quicpro_iibin_insn_by_tag(const quicpro_iibin_compiled_schema_internal *schema, uint32_t tag) {
+    if (tag < schema->by_tag_len) {
+        uint16_t idx = schema->by_tag[tag];
+        return idx ? &schema->program[idx - 1] : NULL;
+    }
+    size_t lo = 0, hi = schema->num_fields;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (schema->program[mid].tag == tag) {
+            return &schema->program[mid];
+        }
+        if (schema->program[mid].tag < tag) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
-        shift += 7;
     }
-    return 0; // Malformed: Varint is too long.
+    return NULL;
 }
 
-static inline void quicpro_proto_encode_fixed32(smart_str *buf, uint32_t value) {
-    unsigned char temp_buf[4];
-    temp_buf[0] = (unsigned char)(value);
-    temp_buf[1] = (unsigned char)(value >> 8);
-    temp_buf[2] = (unsigned char)(value >> 16);
-    temp_buf[3] = (unsigned char)(value >> 24);
-    smart_str_appendl(buf, (char*)temp_buf, 4);
-}
 
-static inline zend_bool quicpro_proto_decode_fixed32(const unsigned char **buf_ptr, const unsigned char *buf_end, uint32_t *value_out) {
-    if (*buf_ptr + 4 > buf_end) return 0;
-    const unsigned char *ptr = *buf_ptr;
-    *value_out = ((uint32_t)ptr[0]) |
-                 ((uint32_t)ptr[1] << 8) |
-                 ((uint32_t)ptr[2] << 16) |
-                 ((uint32_t)ptr[3] << 24);
-    *buf_ptr += 4;
-    return 1;
-}
+/* --- Schema and Enum Registry --- */
+/*
+ * Defined in iibin_registry.c. Lookups take no lock and may run on any
+ * thread. Registered definitions are owned by the registry from then on
+ * and freed at MSHUTDOWN, so everything they point to must be persistent.
+ */
+extern zend_bool quicpro_iibin_registries_initialized;
 
-static inline void quicpro_proto_encode_fixed64(smart_str *buf, uint64_t value) {
-    unsigned char temp_buf[8];
-    temp_buf[0] = (unsigned char)(value);
-    temp_buf[1] = (unsigned char)(value >> 8);
-    temp_buf[2] = (unsigned char)(value >> 16);
-    temp_buf[3] = (unsigned char)(value >> 24);
-    temp_buf[4] = (unsigned char)(value >> 32);
-    temp_buf[5] = (unsigned char)(value >> 40);
-    temp_buf[6] = (unsigned char)(value >> 48);
-    temp_buf[7] = (unsigned char)(value >> 56);
-    smart_str_appendl(buf, (char*)temp_buf, 8);
-}
+int quicpro_iibin_registries_init(void);
+void quicpro_iibin_registries_shutdown(void);
+const quicpro_iibin_compiled_schema_internal* get_compiled_iibin_schema_internal(const char *schema_name);
+const quicpro_iibin_compiled_enum_internal* get_compiled_iibin_enum_internal(const char *enum_name);
+/* The schema registered first with this fingerprint, or NULL. */
+const quicpro_iibin_compiled_schema_internal *quicpro_iibin_schema_by_id(uint32_t id);
+zend_bool quicpro_iibin_registry_name_taken(const char *name, size_t len);
+/* Appends the name of every schema (or every enum) to the PHP array `into`, in no particular order. */
+void quicpro_iibin_registry_list(zval *into, zend_bool enums);
+/* Both return FAILURE, without taking ownership, if the name is already a schema or enum. */
+int quicpro_iibin_registry_add_schema(const char *name, size_t len, quicpro_iibin_compiled_schema_internal *schema);
+int quicpro_iibin_registry_add_enum(const char *name, size_t len, quicpro_iibin_compiled_enum_internal *enum_def);
 
-static inline zend_bool quicpro_proto_decode_fixed64(const unsigned char **buf_ptr, const unsigned char *buf_end, uint64_t *value_out) {
-    if (*buf_ptr + 8 > buf_end) return 0;
-    const unsigned char *ptr = *buf_ptr;
-    *value_out = ((uint64_t)ptr[0]) |
-                 ((uint64_t)ptr[1] << 8)  |
-                 ((uint64_t)ptr[2] << 16) |
-                 ((uint64_t)ptr[3] << 24) |
-                 ((uint64_t)ptr[4] << 32) |
-                 ((uint64_t)ptr[5] << 40) |
-                 ((uint64_t)ptr[6] << 48) |
-                 ((uint64_t)ptr[7] << 56);
-    *buf_ptr += 8;
-    return 1;
-}
+/* Free a definition and everything it owns (iibin_schema.c). Partly built ones are fine. */
+void quicpro_iibin_schema_free(quicpro_iibin_compiled_schema_internal *schema);
+void quicpro_iibin_enum_free(quicpro_iibin_compiled_enum_internal *enum_def);
 
-static inline uint32_t quicpro_proto_zigzag_encode32(int32_t n) {
-    return (uint32_t)((n << 1) ^ (n >> 31));
-}
+/*
+ * Define a schema or enum from its PHP definition array, as
+ * IIBIN::defineSchema() and IIBIN::defineEnum() do (iibin_schema.c).
+ * Return the registered definition, or NULL after throwing.
+ */
+const quicpro_iibin_compiled_schema_internal *quicpro_iibin_define_schema_ht(const char *name, size_t len, HashTable *fields);
+const quicpro_iibin_compiled_enum_internal *quicpro_iibin_define_enum_ht(const char *name, size_t len, HashTable *values);
+
+/*
+ * Request arena (iibin_arena.c). freeze() moves a decoded array tree into
+ * one request-lifetime block as immutable arrays and interned strings and
+ * frees the original. It returns FAILURE, leaving the value alone, for a
+ * tree that holds objects or would exceed quicpro.iibin_arena_max_mb.
+ */
+int quicpro_iibin_arena_freeze(zval *value);
+
+/*
+ * Makes `out` a Quicpro\IIBIN\View of `buf`, as IIBIN::decodeView(); the
+ * view takes its own reference to `buf`. The caller has checked the length
+ * (iibin_view.c).
+ */
+void quicpro_iibin_view_init(zval *out, const quicpro_iibin_compiled_schema_internal *schema, zend_string *buf);
+
+/*
+ * Schema descriptors (iibin_descriptor.c). describe() fills in a compiled
+ * schema's descriptor and fingerprint before it is registered. define()
+ * registers every schema and enum of a peer's descriptor that is not
+ * defined here yet and returns its root schema; it throws, returning NULL,
+ * when the descriptor is malformed or contradicts a local definition.
+ */
+int quicpro_iibin_describe_schema(quicpro_iibin_compiled_schema_internal *schema);
+const quicpro_iibin_compiled_schema_internal *quicpro_iibin_define_from_descriptor(const unsigned char *buf, size_t len);
+
+/* A persistent string flagged permanent interned; free it with pefree(s, 1) (iibin_program.c). */
+zend_string *quicpro_iibin_permanent_string(const char *str, size_t len);
+
+
+/* --- Codec Entry Points for Other IIBIN Modules --- */
+
+/* Appends the encoding of data_zval (array or object) to buf (iibin_encoding.c). Throws on FAILURE. */
+int quicpro_iibin_encode_message(smart_str *buf, const quicpro_iibin_compiled_schema_internal *schema, zval *data_zval);
+
+/* Appends one present field, key included, as the message encoder writes it; nothing for an empty repeated field. */
+int quicpro_iibin_encode_field(smart_str *buf, const quicpro_iibin_insn *insn, zval *value_zval);
+
+/* Chunk size of a streaming encode; string values at least this long bypass the chunk. */
+#define IIBIN_STREAM_CHUNK 16384
+
+/*
+ * Destination of a streaming encode. write() must take all `len` bytes,
+ * waiting for flow control as long as it needs to, or throw and return
+ * FAILURE. `data` is only valid during the call. `total`, the length of
+ * the whole message, is set before the first write.
+ */
+typedef struct quicpro_iibin_sink_s quicpro_iibin_sink;
+struct quicpro_iibin_sink_s {
+    int      (*write)(quicpro_iibin_sink *sink, const uint8_t *data, size_t len);
+    uint64_t total;
+};
+
+/*
+ * Encodes data_zval into `sink` without building the message in memory:
+ * a sizing pass first, then chunks of about IIBIN_STREAM_CHUNK bytes
+ * (iibin_encoding.c). Nothing reaches the sink if data_zval is invalid.
+ */
+int quicpro_iibin_encode_to_sink(const quicpro_iibin_compiled_schema_internal *schema, zval *data_zval, quicpro_iibin_sink *sink);
+
+/*
+ * Decodes a whole message into `out` (array, or stdClass if decode_as_object),
+ * fills defaults and checks required fields, as IIBIN::decode(). On FAILURE
+ * `out` is UNDEF and an exception is pending (iibin_decoding.c).
+ */
+int quicpro_iibin_decode_message(const unsigned char *buf, size_t len, const quicpro_iibin_compiled_schema_internal *schema,
+                                 zval *out, zend_bool decode_as_object);
+
+/*
+ * Decodes every occurrence of one field in [buf, buf_end), a message of
+ * `schema` from some key onwards, into `into` under the field's name
+ * (iibin_decoding.c). Other fields are skipped. Throws on FAILURE.
+ */
+int quicpro_iibin_decode_field(const unsigned char *buf, const unsigned char *buf_end, const quicpro_iibin_compiled_schema_internal *schema,
+                               const quicpro_iibin_insn *insn, HashTable *into);
+
+/* Steps over one value of the given wire type; 0 if it is truncated or the type unknown. */
+zend_bool quicpro_iibin_skip_field(const unsigned char **buf_ptr, const unsigned char *buf_end, uint32_t wire_type);
+
+
+/* --- Static Inline Wire Format Writers (the readers are in iibin_wire.h) --- */
 
-static inline int32_t quicpro_proto_zigzag_decode32(uint32_t n) {
-    return (int32_t)((n >> 1) ^ (-(int32_t)(n & 1)));
+static inline void quicpro_iibin_encode_varint(smart_str *buf, uint64_t value) {
+    smart_str_alloc(buf, QUICPRO_IIBIN_VARINT_MAX_LEN, 0);
+    ZSTR_LEN(buf->s) += quicpro_iibin_put_varint((unsigned char *)ZSTR_VAL(buf->s) + ZSTR_LEN(buf->s), value);
 }
 
-static inline uint64_t quicpro_proto_zigzag_encode64(int64_t n) {
-    return (uint64_t)((n << 1) ^ (n >> 63));
+static inline void quicpro_iibin_encode_fixed32(smart_str *buf, uint32_t value) {
+    smart_str_alloc(buf, 4, 0);
+    quicpro_iibin_store_fixed32((unsigned char *)ZSTR_VAL(buf->s) + ZSTR_LEN(buf->s), value);
+    ZSTR_LEN(buf->s) += 4;
 }
 
-static inline int64_t quicpro_proto_zigzag_decode64(uint64_t n) {
-    return (int64_t)((n >> 1) ^ (-(int64_t)(n & 1)));
+static inline void quicpro_iibin_encode_fixed64(smart_str *buf, uint64_t value) {
+    smart_str_alloc(buf, 8, 0);
+    quicpro_iibin_store_fixed64((unsigned char *)ZSTR_VAL(buf->s) + ZSTR_LEN(buf->s), value);
+    ZSTR_LEN(buf->s) += 8;
 }
 
-#endif /* QUICPRO_PROTO_INTERNAL_H */
\ No newline at end of file
+#endif /* QUICPRO_IIBIN_INTERNAL_H */
@@ -0,0 +1,55 @@
+/*
+ * include/iibin/iibin_shm.h – Shared-memory IIBIN message arena
+ * ==============================================================
+ *
+ * Processes on one host that already talk over a Unix socket (cluster
+ * workers, co-located MCP agents, pipeline stages) can skip the copy
+ * through the socket for the message body. The sender encodes into a
+ * block of a POSIX shared memory segment and sends only the returned
+ * reference, an int. The receiver decodes straight from the block and
+ * frees it:
+ *
+ *     $ref = IIBIN::encodeShared('Chunk', $chunk);     // sender
+ *     fwrite($sock, pack('J', $ref));
+ *
+ *     $ref   = unpack('J', fread($sock, 8))[1];        // receiver
+ *     $chunk = IIBIN::decodeShared('Chunk', $ref);     // releases the block
+ *
+ * The segment is quicpro.io_shm_path, quicpro.io_shm_total_memory_mb big,
+ * cut into blocks of quicpro.io_default_buffer_size_kb. Whoever opens it
+ * first lays it out; later openers use its geometry, whatever their own
+ * settings. Blocks are handed out from a lock-free free list in the
+ * segment itself, so any number of processes may encode and decode
+ * concurrently. A reference carries its block's generation. Decoding or
+ * releasing a reference whose block was freed meanwhile fails instead of
+ * reading someone else's message.
+ *
+ * encodeShared() returns null when the message is larger than a block or
+ * no block is free; the caller then sends the bytes the usual way. Blocks
+ * of a receiver that dies before decoding stay allocated until the
+ * segment is removed (shm_unlink, or a reboot).
+ *
+ * Everything here requires quicpro.io_use_shared_memory_buffers=1.
+ */
+
+#ifndef QUICPRO_IIBIN_SHM_H
+#define QUICPRO_IIBIN_SHM_H
+
+#include <php.h>
+
+/** @brief Sets up the open lock (MINIT, from quicpro_iibin_minit()). Maps nothing. */
+void quicpro_iibin_shm_minit(void);
+
+/** @brief Unmaps the segment if this process mapped it. The segment itself stays. */
+void quicpro_iibin_shm_mshutdown(void);
+
+/* Quicpro\IIBIN::encodeShared(string $schemaName, array|object $phpData): ?int */
+PHP_FUNCTION(quicpro_iibin_encode_shared);
+
+/* Quicpro\IIBIN::decodeShared(string $schemaName, int $ref, bool $decodeAsObject = false, bool $release = true): array|object */
+PHP_FUNCTION(quicpro_iibin_decode_shared);
+
+/* Quicpro\IIBIN::releaseShared(int $ref): bool */
+PHP_FUNCTION(quicpro_iibin_release_shared);
+
+#endif /* QUICPRO_IIBIN_SHM_H */
@@ -0,0 +1,34 @@
+/*
+ * include/iibin/iibin_view.h – Lazily decoded Quicpro\IIBIN\View messages
+ * ========================================================================
+ *
+ * IIBIN::decodeView() returns a view over the encoded message instead of
+ * an array. The view holds a reference to the caller's string and decodes
+ * nothing up front. Its first read makes one pass over the keys and notes
+ * where each known field first occurs. Each field is decoded when it is
+ * first read, and kept.
+ *
+ *     $msg = IIBIN::decodeView('Envelope', $bytes);
+ *     route($msg['target']);              // decodes one field
+ *     send($msg->encode());               // unmodified: the original string
+ *
+ * Nested messages are decoded in full when their field is read. Writes
+ * through ArrayAccess mark the view modified; encode() then decodes any
+ * field not read yet and encodes the whole message again. toArray()
+ * returns what IIBIN::decode() would, with fields in tag order.
+ */
+
+#ifndef QUICPRO_IIBIN_VIEW_H
+#define QUICPRO_IIBIN_VIEW_H
+
+#include <php.h>
+
+extern zend_class_entry *quicpro_ce_iibin_view;
+
+/** @brief Registers Quicpro\IIBIN\View (MINIT, from quicpro_iibin_minit()). */
+void quicpro_iibin_view_minit(void);
+
+/* Quicpro\IIBIN::decodeView(string $schemaName, string $binaryData): Quicpro\IIBIN\View */
+PHP_FUNCTION(quicpro_iibin_decode_view);
+
+#endif /* QUICPRO_IIBIN_VIEW_H */
@@ -0,0 +1,328 @@
+/*
+ * include/iibin/iibin_wire.h – IIBIN wire format kernels
+ * ======================================================
+ *
+ * The parts of the codec that depend on neither PHP nor Zend: wire types,
+ * field types and flags, opcodes, and the inline varint, fixed-width and
+ * zigzag helpers the encoder and decoder are built on. iibin_internal.h
+ * includes this header; the WebAssembly decoder of iibin-js
+ * (javascript/iibin-js/decode/wasm) compiles the same one, so both sides
+ * read the wire, and a schema descriptor, with the same code.
+ *
+ * Only the C standard headers are used. SIMD kernels come as SSE2, WASM
+ * simd128 and portable scalar versions, chosen at compile time.
+ */
+
+#ifndef QUICPRO_IIBIN_WIRE_H
+#define QUICPRO_IIBIN_WIRE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+# define QUICPRO_IIBIN_LIKELY(x) __builtin_expect(!!(x), 1)
+#else
+# define QUICPRO_IIBIN_LIKELY(x) (x)
+#endif
+
+/* --- Wire Format Constants (Protobuf-like) --- */
+#define QUICPRO_IIBIN_WIRETYPE_VARINT         0
+#define QUICPRO_IIBIN_WIRETYPE_FIXED64        1
+#define QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM   2
+#define QUICPRO_IIBIN_WIRETYPE_FIXED32        5
+
+/* Declared field types; also the type byte of a schema descriptor. */
+typedef enum _quicpro_iibin_field_type_internal {
+    IIBIN_INTERNAL_TYPE_UNKNOWN = 0,
+    IIBIN_INTERNAL_TYPE_DOUBLE,
+    IIBIN_INTERNAL_TYPE_FLOAT,
+    IIBIN_INTERNAL_TYPE_INT64,
+    IIBIN_INTERNAL_TYPE_UINT64,
+    IIBIN_INTERNAL_TYPE_INT32,
+    IIBIN_INTERNAL_TYPE_UINT32,
+    IIBIN_INTERNAL_TYPE_SINT32,
+    IIBIN_INTERNAL_TYPE_SINT64,
+    IIBIN_INTERNAL_TYPE_FIXED64,
+    IIBIN_INTERNAL_TYPE_SFIXED64,
+    IIBIN_INTERNAL_TYPE_FIXED32,
+    IIBIN_INTERNAL_TYPE_SFIXED32,
+    IIBIN_INTERNAL_TYPE_BOOL,
+    IIBIN_INTERNAL_TYPE_STRING,
+    IIBIN_INTERNAL_TYPE_BYTES,
+    IIBIN_INTERNAL_TYPE_MESSAGE,
+    IIBIN_INTERNAL_TYPE_ENUM
+} quicpro_iibin_field_type_internal;
+
+#define IIBIN_FIELD_FLAG_NONE     0x00
+#define IIBIN_FIELD_FLAG_OPTIONAL 0x01
+#define IIBIN_FIELD_FLAG_REQUIRED 0x02
+#define IIBIN_FIELD_FLAG_REPEATED 0x04
+#define IIBIN_FIELD_FLAG_PACKED   0x08
+
+/* Opcodes of a compiled program, one per wire encoding (see iibin_internal.h). */
+typedef enum _quicpro_iibin_opcode {
+    IIBIN_OP_VARINT = 0,    /* int64/uint32/uint64 */
+    IIBIN_OP_INT32,         /* Varint; decodes sign-extended from 32 bits */
+    IIBIN_OP_ZIGZAG32,      /* sint32 */
+    IIBIN_OP_ZIGZAG64,      /* sint64 */
+    IIBIN_OP_BOOL,
+    IIBIN_OP_ENUM,
+    IIBIN_OP_FIXED32,
+    IIBIN_OP_SFIXED32,
+    IIBIN_OP_FIXED64,       /* fixed64 / sfixed64 */
+    IIBIN_OP_FLOAT,
+    IIBIN_OP_DOUBLE,
+    IIBIN_OP_BYTES,         /* string / bytes */
+    IIBIN_OP_MESSAGE
+} quicpro_iibin_opcode;
+
+/* Largest varint encoding of a 32-bit field key */
+#define IIBIN_MAX_KEY_LEN 5
+
+/* Tags up to this bound are found by table lookup when decoding */
+#define IIBIN_DENSE_TAG_LIMIT 1024
+
+/* Maps a field's declared type onto the opcode that handles its wire encoding. */
+static inline quicpro_iibin_opcode quicpro_iibin_opcode_for_type(quicpro_iibin_field_type_internal type) {
+    switch (type) {
+        case IIBIN_INTERNAL_TYPE_INT32:    return IIBIN_OP_INT32;
+        case IIBIN_INTERNAL_TYPE_SINT32:   return IIBIN_OP_ZIGZAG32;
+        case IIBIN_INTERNAL_TYPE_SINT64:   return IIBIN_OP_ZIGZAG64;
+        case IIBIN_INTERNAL_TYPE_BOOL:     return IIBIN_OP_BOOL;
+        case IIBIN_INTERNAL_TYPE_ENUM:     return IIBIN_OP_ENUM;
+        case IIBIN_INTERNAL_TYPE_FIXED32:  return IIBIN_OP_FIXED32;
+        case IIBIN_INTERNAL_TYPE_SFIXED32: return IIBIN_OP_SFIXED32;
+        case IIBIN_INTERNAL_TYPE_FIXED64:
+        case IIBIN_INTERNAL_TYPE_SFIXED64: return IIBIN_OP_FIXED64;
+        case IIBIN_INTERNAL_TYPE_FLOAT:    return IIBIN_OP_FLOAT;
+        case IIBIN_INTERNAL_TYPE_DOUBLE:   return IIBIN_OP_DOUBLE;
+        case IIBIN_INTERNAL_TYPE_STRING:
+        case IIBIN_INTERNAL_TYPE_BYTES:    return IIBIN_OP_BYTES;
+        case IIBIN_INTERNAL_TYPE_MESSAGE:  return IIBIN_OP_MESSAGE;
+        default:                           return IIBIN_OP_VARINT;
+    }
+}
+
+/* Wire type of one value. For packed fields the schema stores LENGTH_DELIM, the type of the run. */
+static inline uint32_t quicpro_iibin_value_wire_type(quicpro_iibin_opcode op) {
+    switch (op) {
+        case IIBIN_OP_FIXED32: case IIBIN_OP_SFIXED32:
+        case IIBIN_OP_FLOAT:                         return QUICPRO_IIBIN_WIRETYPE_FIXED32;
+        case IIBIN_OP_FIXED64: case IIBIN_OP_DOUBLE: return QUICPRO_IIBIN_WIRETYPE_FIXED64;
+        case IIBIN_OP_BYTES:   case IIBIN_OP_MESSAGE: return QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM;
+        default:                                     return QUICPRO_IIBIN_WIRETYPE_VARINT;
+    }
+}
+
+
+/* --- Static Inline Low-Level Wire Format Utilities --- */
+
+/*
+ * The wire format is little-endian. On little-endian hosts fixed-width
+ * values are plain unaligned loads and stores, and a varint of up to eight
+ * bytes is decoded from one 64-bit load: the first clear top bit marks its
+ * end, and the 7-bit groups are gathered with PEXT or three shift-and-mask
+ * steps. The encoder computes a varint's length from the highest set bit
+ * first and then writes that many bytes, with no per-byte exit test.
+ * WebAssembly is little-endian and has no PEXT, so it takes the shifts.
+ */
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(__wasm__)
+# define QUICPRO_IIBIN_LITTLE_ENDIAN 1
+#endif
+#ifdef __BMI2__
+# include <immintrin.h>
+#endif
+#if defined(__SSE2__)
+# include <emmintrin.h>
+# define QUICPRO_IIBIN_SIMD16 1
+#elif defined(__wasm_simd128__)
+# include <wasm_simd128.h>
+# define QUICPRO_IIBIN_SIMD16 1
+#endif
+
+#define QUICPRO_IIBIN_VARINT_MAX_LEN 10
+
+/** Bytes in the varint encoding of v: 1 for v < 2^7, up to 10 for v >= 2^63. */
+static inline size_t quicpro_iibin_varint_size(uint64_t v) {
+    unsigned bits = 64u - (unsigned)__builtin_clzll(v | 1);
+    return (bits * 9 + 64) / 64;
+}
+
+/** Writes v as a varint to out, which must have QUICPRO_IIBIN_VARINT_MAX_LEN bytes free; returns the length. */
+static inline size_t quicpro_iibin_put_varint(unsigned char *out, uint64_t v) {
+    size_t n = quicpro_iibin_varint_size(v);
+    for (size_t i = 0; i + 1 < n; i++) {
+        out[i] = (unsigned char)(v | 0x80U);
+        v >>= 7;
+    }
+    out[n - 1] = (unsigned char)v;
+    return n;
+}
+
+static inline bool quicpro_iibin_decode_varint_slow(const unsigned char **buf_ptr, const unsigned char *buf_end, uint64_t *value_out) {
+    uint64_t result = 0;
+    int shift = 0;
+    const unsigned char *ptr = *buf_ptr;
+    for (int i = 0; i < QUICPRO_IIBIN_VARINT_MAX_LEN; ++i) {
+        if (ptr >= buf_end) return 0;
+        unsigned char byte = *ptr++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80U)) {
+            *value_out = result;
+            *buf_ptr = ptr;
+            return 1;
+        }
+        shift += 7;
+    }
+    return 0; // Malformed: Varint is too long.
+}
+
+static inline bool quicpro_iibin_decode_varint(const unsigned char **buf_ptr, const unsigned char *buf_end, uint64_t *value_out) {
+    const unsigned char *ptr = *buf_ptr;
+    if (QUICPRO_IIBIN_LIKELY(ptr < buf_end && *ptr < 0x80)) {
+        *value_out = *ptr;
+        *buf_ptr = ptr + 1;
+        return 1;
+    }
+#ifdef QUICPRO_IIBIN_LITTLE_ENDIAN
+    if (QUICPRO_IIBIN_LIKELY(buf_end - ptr >= 8)) {
+        uint64_t word;
+        memcpy(&word, ptr, sizeof(word));
+        uint64_t stops = ~word & 0x8080808080808080ULL;
+        if (QUICPRO_IIBIN_LIKELY(stops != 0)) {
+            unsigned len = ((unsigned)__builtin_ctzll(stops) >> 3) + 1;
+            if (len < 8) {
+                word &= (1ULL << (len * 8)) - 1;
+            }
+# ifdef __BMI2__
+            *value_out = _pext_u64(word, 0x7F7F7F7F7F7F7F7FULL);
+# else
+            word &= 0x7F7F7F7F7F7F7F7FULL;
+            word = ((word & 0x7F007F007F007F00ULL) >> 1) | (word & 0x007F007F007F007FULL);
+            word = ((word & 0x3FFF00003FFF0000ULL) >> 2) | (word & 0x00003FFF00003FFFULL);
+            word = ((word & 0x0FFFFFFF00000000ULL) >> 4) | (word & 0x000000000FFFFFFFULL);
+            *value_out = word;
+# endif
+            *buf_ptr = ptr + len;
+            return 1;
+        }
+    }
+#endif
+    return quicpro_iibin_decode_varint_slow(buf_ptr, buf_end, value_out);
+}
+
+/*
+ * Packed varint runs. The top bits of 16 bytes form one mask (PMOVMSKB,
+ * i8x16.bitmask): the run holds one varint per clear bit, and a zero mask
+ * means 16 one-byte varints in a row, the common case for small integers
+ * and enums. Without SIMD both fall back to a byte loop.
+ */
+#ifdef QUICPRO_IIBIN_SIMD16
+static inline unsigned quicpro_iibin_top_bits16(const unsigned char *p) {
+# if defined(__SSE2__)
+    return (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)p));
+# else
+    return (unsigned)wasm_i8x16_bitmask(wasm_v128_load(p));
+# endif
+}
+#endif
+
+/** Number of varints in [p, end): one per byte with a clear top bit. */
+static inline size_t quicpro_iibin_count_varints(const unsigned char *p, const unsigned char *end) {
+    size_t n = 0;
+#ifdef QUICPRO_IIBIN_SIMD16
+    for (; end - p >= 16; p += 16) {
+        n += 16 - (size_t)__builtin_popcount(quicpro_iibin_top_bits16(p));
+    }
+#endif
+    for (; p < end; p++) {
+        n += *p < 0x80;
+    }
+    return n;
+}
+
+/** True if the 16 bytes at p, which must be readable, are 16 one-byte varints. */
+static inline bool quicpro_iibin_single_bytes16(const unsigned char *p) {
+#ifdef QUICPRO_IIBIN_SIMD16
+    return quicpro_iibin_top_bits16(p) == 0;
+#else
+    uint64_t a, b;
+    memcpy(&a, p, 8);
+    memcpy(&b, p + 8, 8);
+    return ((a | b) & 0x8080808080808080ULL) == 0;
+#endif
+}
+
+static inline void quicpro_iibin_store_fixed32(unsigned char *out, uint32_t value) {
+#ifdef QUICPRO_IIBIN_LITTLE_ENDIAN
+    memcpy(out, &value, 4);
+#else
+    out[0] = (unsigned char)(value);
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+#endif
+}
+
+static inline void quicpro_iibin_store_fixed64(unsigned char *out, uint64_t value) {
+#ifdef QUICPRO_IIBIN_LITTLE_ENDIAN
+    memcpy(out, &value, 8);
+#else
+    quicpro_iibin_store_fixed32(out, (uint32_t)value);
+    quicpro_iibin_store_fixed32(out + 4, (uint32_t)(value >> 32));
+#endif
+}
+
+static inline uint32_t quicpro_iibin_load_fixed32(const unsigned char *ptr) {
+#ifdef QUICPRO_IIBIN_LITTLE_ENDIAN
+    uint32_t value;
+    memcpy(&value, ptr, 4);
+    return value;
+#else
+    return ((uint32_t)ptr[0]) | ((uint32_t)ptr[1] << 8) | ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+#endif
+}
+
+static inline uint64_t quicpro_iibin_load_fixed64(const unsigned char *ptr) {
+#ifdef QUICPRO_IIBIN_LITTLE_ENDIAN
+    uint64_t value;
+    memcpy(&value, ptr, 8);
+    return value;
+#else
+    return (uint64_t)quicpro_iibin_load_fixed32(ptr) | ((uint64_t)quicpro_iibin_load_fixed32(ptr + 4) << 32);
+#endif
+}
+
+static inline bool quicpro_iibin_decode_fixed32(const unsigned char **buf_ptr, const unsigned char *buf_end, uint32_t *value_out) {
+    if (buf_end - *buf_ptr < 4) return 0;
+    *value_out = quicpro_iibin_load_fixed32(*buf_ptr);
+    *buf_ptr += 4;
+    return 1;
+}
+
+static inline bool quicpro_iibin_decode_fixed64(const unsigned char **buf_ptr, const unsigned char *buf_end, uint64_t *value_out) {
+    if (buf_end - *buf_ptr < 8) return 0;
+    *value_out = quicpro_iibin_load_fixed64(*buf_ptr);
+    *buf_ptr += 8;
+    return 1;
+}
+
+static inline uint32_t quicpro_iibin_zigzag_encode32(int32_t n) {
+    return (uint32_t)((n << 1) ^ (n >> 31));
+}
+
+static inline int32_t quicpro_iibin_zigzag_decode32(uint32_t n) {
+    return (int32_t)((n >> 1) ^ (-(int32_t)(n & 1)));
+}
+
+static inline uint64_t quicpro_iibin_zigzag_encode64(int64_t n) {
+    return (uint64_t)((n << 1) ^ (n >> 63));
+}
+
+static inline int64_t quicpro_iibin_zigzag_decode64(uint64_t n) {
+    return (int64_t)((n >> 1) ^ (-(int64_t)(n & 1)));
+}
+
+#endif /* QUICPRO_IIBIN_WIRE_H */
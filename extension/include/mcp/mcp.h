@@ -19,6 +19,10 @@
 #define QUICPRO_MCP_H
 
 #include <php.h> // Required for PHP_FUNCTION macro
+#include <quiche.h>
+#include <stdbool.h>
+
+#include "client/session.h"
 
 /*
  * PHP_FUNCTION(quicpro_mcp_connect);
@@ -59,6 +63,15 @@
  */
 PHP_FUNCTION(quicpro_mcp_connect);
 
+/*
+ * quicpro_mcp_open()
+ * ------------------
+ * quicpro_mcp_connect() for C callers: a warm pooled connection when there
+ * is one, a new one otherwise. Returns a resource reference the caller
+ * owns, or NULL after throwing.
+ */
+zend_resource *quicpro_mcp_open(const char *host, size_t host_len, zend_long port, quicpro_cfg_t *cfg, HashTable *options);
+
 /*
  * PHP_FUNCTION(quicpro_mcp_close);
  * --------------------------------
@@ -79,19 +92,108 @@ PHP_FUNCTION(quicpro_mcp_close);
  * Corresponds to `$mcpClient->sendRequest(...)` in PHP.
  *
  * Userland Signature:
- * string|false quicpro_mcp_request(
+ * string|Quicpro\DataFrame|Quicpro\Gpu\Tensor|false quicpro_mcp_request(
  * resource $mcp_connection,
  * string $service_name,
  * string $method_name,
- * string $request_payload_binary // Serialized by Quicpro\IIBIN
+ * string|array|object $request_payload // Serialized by Quicpro\IIBIN, the message itself, or a Quicpro\DataFrame
  * [, array $per_request_options = []] // e.g., ['timeout_ms' => 5000] for this specific request
  * )
+ * A message (array or object) needs ['schema' => name] among the options. It
+ * is encoded straight into the request stream, chunk by chunk as flow
+ * control allows, instead of being built as a string first.
+ *
+ * With a 'schema' option (a string payload may carry one too) the request
+ * names the schema by ID in a `quicpro-iibin-schema` header. Until the
+ * agent has answered a call with that ID on this connection, the schema's
+ * descriptor goes along in `quicpro-iibin-descriptor` (base64, see
+ * include/iibin/iibin_descriptor.h); after that the ID alone is sent. An
+ * agent that answers with a `quicpro-iibin-schema-unknown` header gets the
+ * call again, once, with the descriptor.
+ *
+ * A Quicpro\DataFrame payload goes as an Arrow IPC stream
+ * (application/vnd.apache.arrow.stream, see include/dataframe/arrow_ipc.h)
+ * and takes no 'schema': only the stream's metadata is built, and the
+ * column buffers are handed to quiche where they lie. A response of that
+ * content type comes back as a DataFrame whose columns point into the
+ * response body; while quicpro.dataframe_enable is off, as the string.
+ *
+ * A response sent as application/vnd.quicpro.tensor comes back as a
+ * Quicpro\Gpu\Tensor: the body is received into pinned host buffers and
+ * copied to the GPU by DMA as they fill, and never reaches the PHP heap
+ * (include/gpu/tensor.h).
+ *
+ * Calls from several Fibers may share one connection. Each gets its own
+ * stream and its own deadline ('timeout_ms', measured on the monotonic
+ * clock), and returns as soon as its own response is complete, in
+ * whatever order the agent answers:
+ *
+ *     foreach ($tools as $i => [$service, $method, $payload]) {
+ *         $fibers[$i] = new Fiber(fn () => quicpro_mcp_request($mcp, $service, $method, $payload));
+ *         $fibers[$i]->start();
+ *     }
+ *     while (quicpro_scheduler_run(100) > 0) {}
  *
- * Returns the binary response payload on success, FALSE on failure.
+ * Whichever call happens to read the session's events files each under the
+ * call that owns its stream (see quicpro_mcp_dispatch() below).
+ *
+ * A call with a deadline sends what is left of it in `quicpro-timeout-ms`,
+ * so the agent can drop a call that is already too late (see
+ * include/mcp/mcp_server.h). Calls an MCP handler makes while it runs
+ * inherit the deadline of the request it serves: theirs is cut to it.
+ *
+ * Hedging, for calls that may run twice: with ['hedge' => $otherConnection]
+ * the same call goes to a second endpoint once 'hedge_after_ms' passes
+ * without a response (default: the 95th percentile of this method's recent
+ * response times in this worker; no hedge until 16 have been seen), or at
+ * once if the first copy fails. The first response wins; the other stream
+ * is reset with H3_REQUEST_CANCELLED, which the agent sees as a cancelled
+ * request.
+ *
+ * Returns the binary response payload (or its DataFrame or Tensor) on success, FALSE on failure.
  * Exceptions may be thrown for connection or protocol errors.
  */
 PHP_FUNCTION(quicpro_mcp_request);
 
+/*
+ * quicpro_mcp_call()
+ * ------------------
+ * quicpro_mcp_request() for C callers such as the pipeline orchestrator:
+ * the same payload and options (NULL: none). Sets return_value to the
+ * response payload; FAILURE after throwing. `answered_by` (may be NULL)
+ * gets the session whose reply won, `session` or the 'hedge'.
+ */
+int quicpro_mcp_call(quicpro_session_t *session, const char *service_name, const char *method_name,
+                     zval *request_payload, HashTable *options, zval *return_value,
+                     quicpro_session_t **answered_by);
+
+/*
+ * quicpro_mcp_call_transient()
+ * ----------------------------
+ * Whether the last quicpro_mcp_call() of this thread failed in transit:
+ * its target admitted it (mcp_breaker.h), and no reply came (connection
+ * lost or reset, timed out). False after a success, and after a failure
+ * on the call's options, a guard's rejection, a cancelled client or a
+ * reply that did not decode. Such a call may succeed if made again, and
+ * the agent may have run it already. Read it before the next call.
+ */
+bool quicpro_mcp_call_transient(void);
+
+/*
+ * quicpro_mcp_call_streamed()
+ * ---------------------------
+ * quicpro_mcp_call() that also hands the response body to `on_chunk` as
+ * it arrives, each time with the bytes that came since the last. The
+ * whole body is still the call's result. `on_chunk` runs in whichever
+ * Fiber reads the session's events: it must not block or call into PHP.
+ * A streamed call is never hedged.
+ */
+typedef void (*quicpro_mcp_chunk_fn)(void *arg, const char *data, size_t len);
+
+int quicpro_mcp_call_streamed(quicpro_session_t *session, const char *service_name, const char *method_name,
+                              zval *request_payload, HashTable *options, zval *return_value,
+                              quicpro_session_t **answered_by, quicpro_mcp_chunk_fn on_chunk, void *chunk_arg);
+
 /*
  * PHP_FUNCTION(quicpro_mcp_upload_from_stream);
  * ---------------------------------------------
@@ -106,10 +208,28 @@ PHP_FUNCTION(quicpro_mcp_request);
  * string $method_name,
  * string $stream_identifier, // To correlate with metadata or a previous request
  * resource $php_readable_stream_resource // Readable PHP stream (e.g., from fopen)
- * [, string $initial_metadata_payload_binary = ""] // Optional initial metadata sent on the QUIC stream before data
+ * [, string $initial_metadata_payload_binary = "" // Optional initial metadata sent on the QUIC stream before data
+ * [, array $options = []]]
  * )
  *
- * Returns true on successful stream completion, false on error.
+ * The request carries `quicpro-stream-id` (the identifier), `quicpro-offset`
+ * (where the data starts in the object), `quicpro-total-length` when the
+ * source is a plain file, and `quicpro-metadata-length` when metadata
+ * precedes the data. The body is read in bounded chunks as flow control
+ * allows, so memory stays flat whatever the object's size; a plain file is
+ * handed to quiche in mmap() windows instead of being copied through a read
+ * buffer.
+ *
+ * $options:
+ * - offset (int, default: the stream's position) — resume a transfer that
+ *   broke off: the source is read from there and the agent appends there.
+ * - on_progress (callable fn(int $offset, ?int $total): ?bool) — called as
+ *   data goes out; returning false cancels the stream. $offset is what
+ *   'offset' takes to resume.
+ * - timeout_ms (int, default: none)
+ *
+ * Returns true once the agent has answered the complete upload, false on
+ * error (with an exception thrown).
  */
 PHP_FUNCTION(quicpro_mcp_upload_from_stream);
 
@@ -127,9 +247,22 @@ PHP_FUNCTION(quicpro_mcp_upload_from_stream);
  * string $method_name,
  * string $request_payload_binary, // Payload to initiate the download (e.g., file ID)
  * resource $php_writable_stream_resource // Writable PHP stream (e.g., from fopen('path', 'wb'))
+ * [, array $options = []]
  * )
  *
- * Returns true on successful stream completion, false on error.
+ * The response body is written to the stream chunk by chunk as it arrives,
+ * never collected; into a plain file with pwrite() at the transfer's
+ * offset. Takes the same 'offset', 'on_progress' and 'timeout_ms' options
+ * as quicpro_mcp_upload_from_stream(). A nonzero offset goes to the agent
+ * as `quicpro-offset`, asking it to skip what the stream already has; the
+ * total passed to on_progress is the offset plus the response's
+ * content-length, if it sent one.
+ *
+ * Neither transfer goes out as 0-RTT data: a resumed connection finishes
+ * its handshake first.
+ *
+ * Returns true once the response is complete, false on error (with an
+ * exception thrown).
  */
 PHP_FUNCTION(quicpro_mcp_download_to_stream);
 
@@ -143,4 +276,31 @@ PHP_FUNCTION(quicpro_mcp_download_to_stream);
  */
 PHP_FUNCTION(quicpro_mcp_get_error);
 
+/*
+ * quicpro_mcp_dispatch()
+ * ----------------------
+ * Feeds an HTTP/3 event into the table of MCP calls in flight on the
+ * session. Returns true if the event's stream belongs to one; the event has
+ * then been consumed and freed. false leaves `ev` to the caller. The
+ * HTTP/3 multiplexer (include/client/mux.h) offers it every event of a
+ * stream it does not know.
+ */
+bool quicpro_mcp_dispatch(quicpro_session_t *session, quiche_h3_event *ev, uint64_t stream_id);
+
+/* Frees the table of calls in flight (session teardown). */
+void quicpro_mcp_inflight_free(quicpro_mcp_inflight_t *inflight);
+
+/* Whether no call is in flight; `inflight` may be NULL. */
+bool quicpro_mcp_inflight_idle(const quicpro_mcp_inflight_t *inflight);
+
+/*
+ * quicpro_mcp_deadline_enter() / quicpro_mcp_deadline_leave()
+ * -----------------------------------------------------------
+ * Bracket a handler that serves an MCP request with `remaining_ms` left:
+ * MCP calls made in between end no later than that. Nested brackets keep
+ * the nearer deadline; enter() returns what leave() restores.
+ */
+zend_long quicpro_mcp_deadline_enter(zend_long remaining_ms);
+void quicpro_mcp_deadline_leave(zend_long previous);
+
 #endif /* QUICPRO_MCP_H */
\ No newline at end of file
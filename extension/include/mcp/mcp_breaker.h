@@ -0,0 +1,89 @@
+/*
+ * include/mcp/mcp_breaker.h – Circuit breaker and adaptive concurrency limit per MCP target
+ * ========================================================================================
+ *
+ * Every MCP call (quicpro_mcp_request(), the pipeline orchestrator's tool
+ * calls) passes a guard kept per target, the agent at host:port, for the
+ * worker's lifetime. Both halves are off by default and switched on in
+ * the mcp_and_orchestrator config module (php.ini or Quicpro\Config):
+ *
+ *     quicpro.mcp_circuit_breaker_enable = 1
+ *     quicpro.mcp_adaptive_concurrency_enable = 1
+ *
+ * The breaker looks at the target's last 64 calls. Once it has seen
+ * mcp_circuit_breaker_min_calls of them, it opens when
+ * mcp_circuit_breaker_failure_rate_percent of them failed (transport
+ * error, reset, timeout) or mcp_circuit_breaker_slow_call_rate_percent
+ * took mcp_circuit_breaker_slow_call_ms or longer. While open, calls fail
+ * at once with an MCP exception instead of queuing on an agent that
+ * cannot cope. After mcp_circuit_breaker_open_ms it is half-open:
+ * mcp_circuit_breaker_half_open_probes calls go through, and the rest
+ * still fail fast. If the probes all succeed, the breaker closes with a
+ * clean window. If one fails, it opens again.
+ *
+ * The concurrency limit caps the target's calls in flight. It starts at
+ * mcp_concurrency_limit_initial and follows the gradient between the
+ * target's long-term and its current response time: while responses stay
+ * near the long-term average the limit grows by about its square root,
+ * and as they climb (the agent queues) it shrinks, by half at most. A
+ * failure cuts it by a tenth. It stays between 1 and
+ * mcp_concurrency_limit_max. A call over the limit fails at once.
+ *
+ * A hedge (include/mcp/mcp.h) goes out only if its own target admits it,
+ * and a copy that loses counts as neither success nor failure.
+ *
+ * The admin API (server/admin_api.h) can drain a target: the worker stops
+ * sending it calls until it is undrained, and a breaker that opens is
+ * announced to the admin API's event subscribers.
+ */
+
+#ifndef QUICPRO_MCP_BREAKER_H
+#define QUICPRO_MCP_BREAKER_H
+
+#include <php.h>
+#include <stdbool.h>
+
+#include "client/session.h"
+
+#define MCP_BREAKER_SLOTS   64      /* Targets tracked per worker; a collision starts the slot over */
+#define MCP_BREAKER_WINDOW  64      /* Calls the rates are taken over */
+
+typedef enum {
+    MCP_GUARD_ADMITTED,
+    MCP_GUARD_OPEN,                 /* The breaker is open, or half-open with its probes out */
+    MCP_GUARD_LIMITED,              /* The target is at its concurrency limit */
+    MCP_GUARD_DRAINED               /* The admin API drained the target */
+} quicpro_mcp_admission_t;
+
+typedef enum {
+    MCP_GUARD_OK,
+    MCP_GUARD_FAILED,
+    MCP_GUARD_DROPPED               /* Neither: a hedged copy that lost */
+} quicpro_mcp_outcome_t;
+
+/* A call's pass, on the caller's stack. */
+typedef struct {
+    void       *slot;               /* NULL: not guarded */
+    zend_ulong  hash;               /* The slot's target when admitted */
+    bool        probe;
+} quicpro_mcp_guard_t;
+
+/*
+ * Admits a call to the target `session` is connected to, into `guard`.
+ * Anything but MCP_GUARD_ADMITTED means the call must not be sent; the
+ * caller throws.
+ */
+quicpro_mcp_admission_t quicpro_mcp_guard_admit(quicpro_session_t *session, quicpro_mcp_guard_t *guard);
+
+/* Ends an admitted call. `latency_ms` counts for MCP_GUARD_OK only. */
+void quicpro_mcp_guard_done(quicpro_mcp_guard_t *guard, quicpro_mcp_outcome_t outcome, zend_long latency_ms);
+
+/*
+ * Drains the target host:port for every thread of the process, or undrains
+ * it: its calls fail at once with MCP_GUARD_DRAINED, whether or not the
+ * guard is enabled. For the admin API's batches. False if
+ * MCP_BREAKER_SLOTS targets are drained already.
+ */
+bool quicpro_mcp_drain(const char *host, size_t host_len, uint16_t port, bool drained);
+
+#endif /* QUICPRO_MCP_BREAKER_H */
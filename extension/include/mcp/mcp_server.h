@@ -0,0 +1,106 @@
+/*
+ * include/mcp/mcp_server.h – Native MCP request routing on the HTTP/3 listener
+ * ===========================================================================
+ *
+ * An agent registers one handler per service method and lets the
+ * extension answer the calls quicpro_mcp_request() makes:
+ *
+ *     quicpro_mcp_server_register('Analysis', 'analyze', fn (array $req) => [...],
+ *                                 ['input' => 'AnalysisRequest', 'output' => 'AnalysisResponse']);
+ *
+ *     quicpro_http3_server_listen('::', 4433, $config, function ($session, int $stream, bool $early) {
+ *         quicpro_mcp_server_serve($session);
+ *     });
+ *
+ * quicpro_mcp_server_serve() reads the connection's HTTP/3 events. It takes
+ * the service and method from the `:path` pseudo-header ("/service/method",
+ * as the client sends it) and looks the handler up in one hash probe, on
+ * the header's bytes as they are. The body is collected and decoded against
+ * the route's input schema; with 'view' the handler gets a lazy
+ * Quicpro\IIBIN\View instead of an array. No headers array is built, and no
+ * request object. What the handler returns is encoded against the output
+ * schema straight into the response stream. Without schemas the handler
+ * gets the raw body and returns a string.
+ *
+ * Without an input schema, a body sent as an Arrow IPC stream
+ * (application/vnd.apache.arrow.stream, as quicpro_mcp_request() sends a
+ * Quicpro\DataFrame) reaches the handler as a DataFrame mapped onto the
+ * body (include/dataframe/arrow_ipc.h). Without an output schema the
+ * handler may return a DataFrame, which goes out as an Arrow IPC stream
+ * whose column buffers quiche takes from the frame, with no copy.
+ * A body sent as application/vnd.quicpro.tensor reaches a schema-less
+ * handler as a Quicpro\Gpu\Tensor, received into pinned host buffers
+ * and copied to the GPU as they fill (include/gpu/tensor.h); one that
+ * cannot be placed there is answered 400. Such a handler may return a
+ * Tensor, which goes back the same way.
+ *
+ * With 'batch' => N, concurrent calls of a route are coalesced for one
+ * handler call: it gets a list of up to N arguments in arrival order and
+ * returns a list of as many answers. When every argument is a Tensor of
+ * one dtype and shape it gets one Tensor instead, the batch stacked along
+ * a new first dimension on the device, and may return a Tensor of that
+ * first dimension, split back into one tensor answer per call: one kernel
+ * launch for the batch. A batch runs once it holds N calls, or once its
+ * first has waited 'batch_budget_us' (2000 by default); the listener loop
+ * drives it (quicpro_mcp_server_batch_tick()). An answer list of another
+ * length fails the batch with 500; a stacked batch the GPU memory pool
+ * has no room for gets 503.
+ *
+ * Answers:
+ * - 200 with the encoded response;
+ * - 404 for a path without a handler;
+ * - 400 when the body does not decode, with the reason in `quicpro-mcp-error`;
+ * - 409 with `quicpro-iibin-schema-unknown` when the call names another
+ *   IIBIN schema ID (include/iibin/iibin_descriptor.h) than the route's
+ *   input;
+ * - 413 for a body over 16 MiB (MCP_SERVER_MAX_BODY);
+ * - 504 without running the handler when the call's `quicpro-timeout-ms`
+ *   has run out by the time its body is complete;
+ * - 500 when the handler throws, or returns something the output schema
+ *   cannot encode. The exception is reported as a warning.
+ *
+ * MCP calls the handler makes end no later than the call it serves
+ * (quicpro_mcp_deadline_enter(), include/mcp/mcp.h), so a deadline holds
+ * across every hop of a pipeline. A call the client cancels (a hedge that
+ * lost) is dropped; if its body was still arriving, the handler never runs.
+ *
+ * A response that flow control cannot take at once waits on the stream;
+ * the listener loop sends the rest (quicpro_mcp_server_flush()).
+ *
+ * Routes belong to the request that registered them and end with it.
+ */
+
+#ifndef QUICPRO_MCP_SERVER_H
+#define QUICPRO_MCP_SERVER_H
+
+#include <php.h>
+
+#include "client/session.h"
+
+/* quicpro_mcp_server_register(string $service, string $method, callable $handler, array $options = []): bool
+ * $options: 'input' and 'output' (IIBIN schema names), 'view' (bool, needs 'input'),
+ * 'batch' (int, calls per handler call) and 'batch_budget_us' (int, needs 'batch'). */
+PHP_FUNCTION(quicpro_mcp_server_register);
+
+/* quicpro_mcp_server_serve(resource $session): int – calls answered, or queued for their batch */
+PHP_FUNCTION(quicpro_mcp_server_serve);
+
+/** @brief Sends what responses of `s` still hold back; called by the HTTP/3 listener for every connection. */
+void quicpro_mcp_server_flush(quicpro_session_t *s);
+
+/** @brief Runs the batches that are full or have waited their budget; called by the HTTP/3 listener every round. */
+void quicpro_mcp_server_batch_tick(void);
+
+/** @brief `wait_ms`, or less when a waiting batch is due sooner: how long the listener may block. */
+int quicpro_mcp_server_batch_wait_ms(int wait_ms);
+
+/** @brief Frees the connection's unfinished MCP requests (session teardown). */
+void quicpro_mcp_served_free(quicpro_mcp_served_t *served);
+
+/** @brief Whether no request is being received or answered (include/poll/hibernate.h). */
+bool quicpro_mcp_served_idle(const quicpro_mcp_served_t *served);
+
+/** @brief Drops the routes (RSHUTDOWN). */
+void quicpro_mcp_server_rshutdown(void);
+
+#endif /* QUICPRO_MCP_SERVER_H */
@@ -0,0 +1,130 @@
+/*
+ * include/object_store/at_rest.h – Encryption at rest
+ * ===================================================
+ *
+ * With quicpro.storage_encryption_at_rest_enable, quicpro-fs:// writers
+ * (object_store/object_store.h) and the CDN cache's disk tier
+ * (server/cdn_disk.h) store nothing in the clear. Data is sealed with
+ * quicpro.storage_encryption_algorithm, "aes-256-gcm" or
+ * "chacha20-poly1305", through OpenSSL's EVP interface, which runs its
+ * AES-NI/VAES (or AVX2 ChaCha) kernels where the CPU has them.
+ *
+ * quicpro.storage_encryption_key_path names the master key: 32 raw bytes,
+ * or 64 hex digits. It never seals anything itself. Each use derives a
+ * key of its own from it, HMAC-SHA256(master, label || 0 || context), so
+ * no two objects share a key and a nonce can simply count. The key's id,
+ * the first 4 bytes of HMAC-SHA256(master, "quicpro key id") in hex, is
+ * stored beside what it sealed, so a reader holding another key refuses
+ * instead of failing on every tag.
+ *
+ * Long data is sealed in segments of QUICPRO_AT_REST_SEGMENT bytes, each
+ * followed by its 16-byte tag. Segment i uses nonce i, and each segment
+ * authenticates the data's total length as well, so segments cannot be
+ * reordered, dropped or cut off. A read of some bytes decrypts only the
+ * segments holding them.
+ *
+ * Reading does not depend on the enable setting: data sealed earlier
+ * stays readable as long as the key file is there.
+ */
+
+#ifndef QUICPRO_OBJECT_STORE_AT_REST_H
+#define QUICPRO_OBJECT_STORE_AT_REST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <openssl/evp.h>
+
+#define QUICPRO_AT_REST_KEY_LEN     32
+#define QUICPRO_AT_REST_NONCE_LEN   12
+#define QUICPRO_AT_REST_TAG_LEN     16
+#define QUICPRO_AT_REST_SALT_LEN    16
+#define QUICPRO_AT_REST_KEY_ID_LEN  8       /* Hex digits */
+#define QUICPRO_AT_REST_SEGMENT     65536
+
+typedef enum {
+    QUICPRO_AT_REST_NONE,
+    QUICPRO_AT_REST_AES_256_GCM,
+    QUICPRO_AT_REST_CHACHA20_POLY1305
+} quicpro_at_rest_alg_t;
+
+typedef struct {
+    quicpro_at_rest_alg_t alg;
+    uint8_t               key[QUICPRO_AT_REST_KEY_LEN];
+    EVP_CIPHER_CTX       *ctx;
+} quicpro_at_rest_key_t;
+
+/* Reads segmented data back; see quicpro_at_rest_reader_new() */
+typedef struct quicpro_at_rest_reader_s quicpro_at_rest_reader_t;
+
+/** @brief Whether quicpro.storage_encryption_at_rest_enable is on. */
+bool quicpro_at_rest_wanted(void);
+
+/**
+ * @brief Whether the master key could be loaded, loading it on first use
+ * (and again when the path changes). Warns once per path if not.
+ */
+bool quicpro_at_rest_ready(void);
+
+/** @brief The configured algorithm. */
+quicpro_at_rest_alg_t quicpro_at_rest_alg(void);
+
+/** @brief An algorithm's name, or NULL for NONE; and back (NONE if unknown). */
+const char *quicpro_at_rest_alg_name(quicpro_at_rest_alg_t alg);
+quicpro_at_rest_alg_t quicpro_at_rest_alg_parse(const char *name);
+
+/** @brief The master key's id, QUICPRO_AT_REST_KEY_ID_LEN digits and a NUL. False without a key. */
+bool quicpro_at_rest_key_id(char *out);
+
+/**
+ * @brief Derives the key for `label` and `context` from the master key.
+ * @return False without a master key; `key` is then unusable.
+ */
+bool quicpro_at_rest_derive(quicpro_at_rest_key_t *key, quicpro_at_rest_alg_t alg, const char *label,
+                            const void *context, size_t context_len);
+
+/** @brief Wipes the key and frees its context. */
+void quicpro_at_rest_key_clear(quicpro_at_rest_key_t *key);
+
+/** @brief The nonce of counter value `seq`. */
+void quicpro_at_rest_nonce(uint8_t *nonce, uint64_t seq);
+
+/**
+ * @brief Encrypts `len` bytes of `in` into `out` (which may be `in`),
+ * followed by the tag: `len` + QUICPRO_AT_REST_TAG_LEN bytes.
+ */
+bool quicpro_at_rest_seal(quicpro_at_rest_key_t *key, const uint8_t *nonce, const void *aad, size_t aad_len,
+                          const uint8_t *in, size_t len, uint8_t *out);
+
+/**
+ * @brief Decrypts `len` bytes of `in`, which the tag follows, into `out`
+ * (which may be `in`). False if the tag does not check out.
+ */
+bool quicpro_at_rest_open(quicpro_at_rest_key_t *key, const uint8_t *nonce, const void *aad, size_t aad_len,
+                          const uint8_t *in, size_t len, uint8_t *out);
+
+/** @brief Bytes `len` bytes of data take sealed in segments. */
+uint64_t quicpro_at_rest_sealed_len(uint64_t len);
+
+/** @brief Seals `len` bytes in segments into `out`, quicpro_at_rest_sealed_len(len) bytes. */
+bool quicpro_at_rest_seal_segments(quicpro_at_rest_key_t *key, const uint8_t *in, uint64_t len, uint8_t *out);
+
+/**
+ * @brief A reader of `len` bytes sealed in segments at `base` of a file.
+ * Takes `key` over (it is cleared). NULL if out of memory.
+ */
+quicpro_at_rest_reader_t *quicpro_at_rest_reader_new(quicpro_at_rest_key_t *key, uint64_t base, uint64_t len);
+
+/**
+ * @brief Reads up to `len` plaintext bytes from `offset` through `fd`,
+ * decrypting the segments they lie in; the last one is kept for the
+ * next call. Returns the bytes read, 0 at the end, or -1 with errno set
+ * (EBADMSG for data that fails its tag).
+ */
+ssize_t quicpro_at_rest_reader_pread(quicpro_at_rest_reader_t *r, int fd, void *out, size_t len, uint64_t offset);
+
+void quicpro_at_rest_reader_free(quicpro_at_rest_reader_t *r);
+
+#endif /* QUICPRO_OBJECT_STORE_AT_REST_H */
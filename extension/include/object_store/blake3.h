@@ -0,0 +1,21 @@
+/*
+ * include/object_store/blake3.h – Content hashes of deduplicated chunks
+ * =====================================================================
+ *
+ * BLAKE3 with its default 32-byte output. Built against the reference
+ * library (QUICPRO_HAVE_BLAKE3), its SIMD kernels hash; otherwise a
+ * portable implementation of the same function does, so chunk names agree
+ * between builds.
+ */
+
+#ifndef QUICPRO_OBJECT_STORE_BLAKE3_H
+#define QUICPRO_OBJECT_STORE_BLAKE3_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define QUICPRO_BLAKE3_LEN 32
+
+void quicpro_blake3(const void *data, size_t len, uint8_t out[QUICPRO_BLAKE3_LEN]);
+
+#endif /* QUICPRO_OBJECT_STORE_BLAKE3_H */
@@ -0,0 +1,36 @@
+/*
+ * include/object_store/cdc.h – Content-defined chunk boundaries
+ * =============================================================
+ *
+ * FastCDC: a gear hash rolls over the bytes and a boundary falls where
+ * its masked bits are all zero, so boundaries move with the content, not
+ * with offsets. An insertion early in a file shifts only the chunks
+ * around it; every later chunk is cut at the same bytes as before and
+ * keeps its hash. Normalized chunking applies a harder mask before the
+ * average size and an easier one after it, which narrows the spread of
+ * chunk sizes around the average.
+ */
+
+#ifndef QUICPRO_OBJECT_STORE_CDC_H
+#define QUICPRO_OBJECT_STORE_CDC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    size_t   min, avg, max;             /* avg / 4, avg rounded to a power of two, avg * 4 */
+    uint64_t mask_s, mask_l;            /* Before and after avg */
+} quicpro_cdc_t;
+
+/** @brief Sizes chunks around `avg` bytes (at least 256). */
+void quicpro_cdc_init(quicpro_cdc_t *c, size_t avg);
+
+/**
+ * @brief The length of the chunk starting at `p`, out of `len` bytes
+ * available: the first boundary, else min(len, max). Only a result below
+ * `len`, or one given at least `max` bytes, is final; with fewer bytes
+ * buffered and more to come, call again once there are more.
+ */
+size_t quicpro_cdc_cut(const quicpro_cdc_t *c, const uint8_t *p, size_t len);
+
+#endif /* QUICPRO_OBJECT_STORE_CDC_H */
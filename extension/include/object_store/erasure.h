@@ -0,0 +1,47 @@
+/*
+ * include/object_store/erasure.h – Reed-Solomon coding for quicpro-fs://
+ * ======================================================================
+ *
+ * A chunk is cut into k data shards of equal length and m parity shards
+ * are computed from them; any k of the k + m shards give the chunk back.
+ * The code is systematic over GF(2^8) (polynomial 0x11d) with the Cauchy
+ * matrix of ISA-L's gf_gen_cauchy1_matrix(): data shards are the chunk's
+ * own bytes, so a read with every data shard present decodes nothing.
+ *
+ * Built against ISA-L (QUICPRO_HAVE_ISAL), encoding and recovery run its
+ * SIMD kernels. Without it, a table-driven loop computes the very same
+ * shards, so stores written by either build read back with the other.
+ */
+
+#ifndef QUICPRO_OBJECT_STORE_ERASURE_H
+#define QUICPRO_OBJECT_STORE_ERASURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define QUICPRO_EC_MAX_SHARDS 32        /* k + m */
+
+typedef struct {
+    unsigned  k, m;
+    uint8_t  *matrix;                   /* (k + m) × k, the top k rows the identity */
+    uint8_t  *tables;                   /* ISA-L's expanded parity rows; NULL without it */
+} quicpro_ec_t;
+
+/** @brief Prepares a k + m code. False if the counts are out of range. */
+bool quicpro_ec_init(quicpro_ec_t *ec, unsigned k, unsigned m);
+
+void quicpro_ec_free(quicpro_ec_t *ec);
+
+/** @brief Computes the m parity shards of `len` bytes each from the k data shards. */
+void quicpro_ec_encode(const quicpro_ec_t *ec, size_t len, uint8_t *const *data, uint8_t *const *parity);
+
+/**
+ * @brief Rebuilds the missing data shards in place from any k present
+ * ones. `shards` holds all k + m buffers of `len` bytes; `present` says
+ * which carry data.
+ * @return False if fewer than k are present.
+ */
+bool quicpro_ec_recover(const quicpro_ec_t *ec, size_t len, uint8_t *const *shards, const bool *present);
+
+#endif /* QUICPRO_OBJECT_STORE_ERASURE_H */
@@ -0,0 +1,47 @@
+/*
+ * include/object_store/metadata_cache.h – Manifest cache of quicpro-fs://
+ * =======================================================================
+ *
+ * Opening or stat()ing an object needs its manifest. With
+ * quicpro.storage_metadata_cache_enable, manifests are kept in a table the
+ * cluster master maps shared before forking, so one worker's fetch serves
+ * every worker of the host, and only a miss costs a round trip to a node.
+ *
+ * Each entry holds a lease: quicpro.storage_metadata_cache_ttl_sec, or
+ * less if the node's answer carried a shorter "quicpro-lease-ms" (0: do not
+ * cache). A write through this host replaces the entry at once for all
+ * of its workers. A rewrite elsewhere is seen once the lease ran out;
+ * until then readers get the previous version whole, as a rewrite never
+ * touches the shards an older manifest names.
+ */
+
+#ifndef QUICPRO_OBJECT_STORE_METADATA_CACHE_H
+#define QUICPRO_OBJECT_STORE_METADATA_CACHE_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define QUICPRO_OBJSTORE_MANIFEST_MAX 160   /* Longer manifests are not cached */
+#define QUICPRO_OBJSTORE_MD_NAME_MAX  256   /* Nor objects with longer names */
+
+/** @brief Maps the table shared. Called by the cluster master before forking. */
+void quicpro_objstore_md_prepare(void);
+
+/** @brief Unmaps the table. */
+void quicpro_objstore_md_release(void);
+
+/**
+ * @brief Copies the manifest of `name` into `out` (at least
+ * QUICPRO_OBJSTORE_MANIFEST_MAX bytes) while its lease holds.
+ * @return Its length, or 0 on a miss.
+ */
+size_t quicpro_objstore_md_get(const char *name, size_t name_len, char *out);
+
+/** @brief Stores the manifest of `name` for `lease_ms`; one too long to cache drops the entry instead. */
+void quicpro_objstore_md_put(const char *name, size_t name_len, const char *manifest, size_t len, zend_long lease_ms);
+
+/** @brief Drops the entry of `name`, e.g. when what it names could not be read. */
+void quicpro_objstore_md_forget(const char *name, size_t name_len);
+
+#endif /* QUICPRO_OBJECT_STORE_METADATA_CACHE_H */
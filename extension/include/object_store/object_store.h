@@ -0,0 +1,117 @@
+/*
+ * include/object_store/object_store.h – Data path of quicpro-fs://
+ * =================================================================
+ *
+ * An object is written as a sequence of chunks of about
+ * quicpro.storage_default_chunk_size_mb. Each chunk is cut into k data
+ * shards, m parity shards are computed (object_store/erasure.h), and the
+ * k + m shards go to k + m different storage nodes of
+ * quicpro.storage_node_static_list at once, chunk c's shard i to node
+ * (c + i) mod N, so consecutive chunks spread over all nodes. With
+ * quicpro.storage_default_redundancy_mode "replication" a chunk is one
+ * shard and its default_replication_factor - 1 copies.
+ *
+ * Every node is one HTTP/3 connection (client/pool.h); all shards bound
+ * for it are requests multiplexed on it (client/mux.h), and one loop
+ * drives all connections together. A writer keeps a window of chunks in
+ * flight while the caller fills the next one, and a reader can ask for
+ * chunks ahead of the one it needs. Throughput therefore adds up over the
+ * nodes instead of being bound by one stream.
+ *
+ * A chunk whose write fails for at most m shards is still whole; a reader
+ * asks for the data shards first and, for each one that fails, for one
+ * more parity shard, then rebuilds the gaps.
+ *
+ * The node protocol: PUT and GET /shards/<name>/<version>/<chunk>/<shard>
+ * carry a shard's bytes; PUT and GET /objects/<name> the object's
+ * manifest, the line "quicpro-fs 1 <version> <size> <chunk size> <k> <m>
+ * <rs|copies>", which goes to m + 1 nodes picked by the name's hash.
+ * <name> is percent-encoded, <version> a random 64-bit hex number drawn
+ * per write, so a rewrite leaves the shards the old manifest names alone
+ * until the new manifest replaces it. Placement depends on the node
+ * list's order, which must be the same for writers and readers. Manifests
+ * are cached per host, see object_store/metadata_cache.h.
+ *
+ * With quicpro.storage_versioning_enable, chunks are instead cut where
+ * the content says (object_store/cdc.h), around
+ * quicpro.storage_dedup_average_chunk_kb, and stored by content: chunk
+ * shards live at /chunks/<BLAKE3 hex>/<layout>/<shard>, <layout> being
+ * "<k>d<m>p" or "<copies>x", on node (h + i) mod N for the hash's first
+ * 8 bytes h. Before sending, a writer POSTs /chunks/has to each node with
+ * the keys "<hex>/<layout>/<shard>" of a batch's shards placed there, one
+ * per line; the node answers with the lines it holds, and only the rest
+ * are sent. A version that shares most of its bytes with an earlier one
+ * thus sends little more than the chunks around what changed. Its
+ * manifest is "quicpro-fs 2 <version> <size> <average> <k> <m>
+ * <rs|copies>" followed by a "<hex> <length>" line per chunk; stored
+ * chunks are never rewritten, so an older manifest stays readable.
+ *
+ * Errors throw and are reported by a false or NULL return.
+ */
+
+#ifndef QUICPRO_OBJECT_STORE_H
+#define QUICPRO_OBJECT_STORE_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config/config.h"
+
+typedef struct quicpro_objstore_s        quicpro_objstore_t;
+typedef struct quicpro_objstore_writer_s quicpro_objstore_writer_t;
+typedef struct quicpro_objstore_reader_s quicpro_objstore_reader_t;
+
+/**
+ * @brief Connects to the configured nodes with `cfg`'s transport. Nodes
+ * that cannot be reached count as down; fewer than k up is an error.
+ */
+quicpro_objstore_t *quicpro_objstore_open(quicpro_cfg_t *cfg);
+
+/** @brief Waits briefly for requests still in flight and drops the connections. */
+void quicpro_objstore_close(quicpro_objstore_t *st);
+
+/**
+ * @brief Starts writing `name`, replacing what was there once
+ * quicpro_objstore_write_end() succeeds. `window` chunks may be in flight
+ * at once (at least 1).
+ */
+quicpro_objstore_writer_t *quicpro_objstore_write_begin(quicpro_objstore_t *st, const char *name, size_t name_len, unsigned window);
+
+/** @brief Appends `len` bytes; waits only when every chunk of the window is still in flight. */
+bool quicpro_objstore_write(quicpro_objstore_writer_t *w, const char *data, size_t len);
+
+/** @brief Sends the last chunk, waits for every shard and writes the manifest. Frees `w`. */
+bool quicpro_objstore_write_end(quicpro_objstore_writer_t *w);
+
+/** @brief Gives up on `w`; the object stays as it was. Frees `w`. */
+void quicpro_objstore_write_abort(quicpro_objstore_writer_t *w);
+
+/**
+ * @brief Opens `name` for reading, fetching its manifest. Up to `window`
+ * chunks may be asked for ahead of the one being read.
+ */
+quicpro_objstore_reader_t *quicpro_objstore_read_begin(quicpro_objstore_t *st, const char *name, size_t name_len, unsigned window);
+
+/** @brief The object's size, from its manifest. */
+uint64_t quicpro_objstore_size(const quicpro_objstore_reader_t *r);
+
+/** @brief The chunk holding byte `pos` (below the size), and where chunk `index` starts. */
+uint64_t quicpro_objstore_chunk_at(const quicpro_objstore_reader_t *r, uint64_t pos);
+uint64_t quicpro_objstore_chunk_offset(const quicpro_objstore_reader_t *r, uint64_t index);
+
+/** @brief Asks for chunk `index` without waiting; a no-op past the end or if already asked. */
+void quicpro_objstore_prefetch(quicpro_objstore_reader_t *r, uint64_t index);
+
+/**
+ * @brief Chunk `index`, waiting for it (and rebuilding it) as needed. The
+ * string stays the reader's and is valid until the slot is reused, i.e.
+ * until `window` further chunks were asked for.
+ */
+zend_string *quicpro_objstore_chunk(quicpro_objstore_reader_t *r, uint64_t index);
+
+/** @brief Frees `r`; chunks still in flight are dropped as they arrive. */
+void quicpro_objstore_read_end(quicpro_objstore_reader_t *r);
+
+#endif /* QUICPRO_OBJECT_STORE_H */
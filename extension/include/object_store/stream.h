@@ -0,0 +1,51 @@
+/*
+ * include/object_store/stream.h – The quicpro-fs:// stream wrapper
+ * =================================================================
+ *
+ * With quicpro.storage_enable, fopen("quicpro-fs://<name>", "r") and "w"
+ * (and so file_get_contents(), file_put_contents(), copy(), filesize()
+ * and file_exists()) reach objects of the object store
+ * (object_store/object_store.h). All streams of a request share one
+ * store, and with it one connection per storage node.
+ *
+ * A reading stream asks for quicpro.storage_read_ahead_chunks chunks past
+ * the one it reads, so a sequential read keeps shards of several chunks
+ * on their way from every node. A writing stream hands each full chunk
+ * to the nodes and goes on filling the next while up to
+ * quicpro.storage_write_behind_chunks of them are unacknowledged; the
+ * object appears at fclose(), once every shard is stored. The stream
+ * context options "read_ahead_chunks" and "write_behind_chunks" of
+ * "quicpro-fs" override both per stream.
+ *
+ * Objects are read or written whole: there is no append and no "+" mode,
+ * and a writing stream cannot seek. A write stream still open at the end
+ * of the request, or closed while an exception is being thrown, is
+ * discarded. Store errors throw.
+ */
+
+#ifndef QUICPRO_OBJECT_STORE_STREAM_H
+#define QUICPRO_OBJECT_STORE_STREAM_H
+
+#include <php.h>
+#include <php_streams.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief Registers the wrapper (MINIT). */
+void quicpro_fs_minit(void);
+
+/** @brief Unregisters it (MSHUTDOWN). */
+void quicpro_fs_mshutdown(void);
+
+/**
+ * @brief Asks for the chunks holding bytes [offset, offset + length) of
+ * a quicpro-fs reading stream without waiting, as far as its read-ahead
+ * window reaches past the current position. False (doing nothing) for a
+ * stream of another wrapper.
+ */
+bool quicpro_fs_prefetch(php_stream *stream, uint64_t offset, uint64_t length);
+
+/** @brief Discards the streams still open and closes the request's store (RSHUTDOWN, before the pool's). */
+void quicpro_fs_rshutdown(void);
+
+#endif /* QUICPRO_OBJECT_STORE_STREAM_H */
@@ -125,9 +125,167 @@ ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Cluster_signalWorkers, 0
 ZEND_END_ARG_INFO()
 /* }}} */
 
-/* {{{ Quicpro\Cluster::getStats(string $pidFile): array */
-ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Cluster_getStats, 0, 1, IS_ARRAY, 0)
-    ZEND_ARG_TYPE_INFO(0, pidFile, IS_STRING, 0)
+/* {{{ Quicpro\Cluster::getStats(?string $pidFile = null): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Cluster_getStats, 0, 0, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, pidFile, IS_STRING, 1, "null")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Cluster::send(int $workerId, array|string $message, ?string $schema = null): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Cluster_send, 0, 2, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, workerId, IS_LONG, 0)
+    ZEND_ARG_INFO(0, message) /* array|string */
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, schema, IS_STRING, 1, "null")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Cluster::broadcast(array|string $message, ?string $schema = null): int */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Cluster_broadcast, 0, 1, IS_LONG, 0)
+    ZEND_ARG_INFO(0, message) /* array|string */
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, schema, IS_STRING, 1, "null")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Cluster::receive(int $timeoutMs = 0, ?string $schema = null, int $max = 64): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Cluster_receive, 0, 0, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeoutMs, IS_LONG, 0, "0")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, schema, IS_STRING, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, max, IS_LONG, 0, "64")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+
+/* ============================================================================== */
+/* == Quicpro\RateLimiter Class (Static)                                       == */
+/* ============================================================================== */
+
+/* {{{ Quicpro\RateLimiter::check(string $key, int $cost = 1): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_RateLimiter_check, 0, 1, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, cost, IS_LONG, 0, "1")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+
+/* ============================================================================== */
+/* == Quicpro\Telemetry Class (Static)                                         == */
+/* ============================================================================== */
+
+/* {{{ Quicpro\Telemetry::init(?array $config = null): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Telemetry_init, 0, 0, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, config, IS_ARRAY, 1, "null")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Telemetry::stats(): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Telemetry_stats, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+
+/* ============================================================================== */
+/* == Quicpro\Metrics Class (Static)                                           == */
+/* ============================================================================== */
+
+/* {{{ Quicpro\Metrics::register(string $name, string $type, string $help = '', ?array $boundaries = null): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Metrics_register, 0, 2, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, name, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, type, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, help, IS_STRING, 0, "''")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, boundaries, IS_ARRAY, 1, "null")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Metrics::increment(string $name, int $by = 1): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Metrics_increment, 0, 1, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, name, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, by, IS_LONG, 0, "1")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Metrics::set(string $name, float $value): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Metrics_set, 0, 2, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, name, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, value, IS_DOUBLE, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Metrics::observe(string $name, float $value): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Metrics_observe, 0, 2, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, name, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, value, IS_DOUBLE, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Metrics::render(): string */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Metrics_render, 0, 0, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Metrics::snapshot(): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Metrics_snapshot, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Metrics::serve(int $port = 9091, string $host = '127.0.0.1'): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Metrics_serve, 0, 0, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, port, IS_LONG, 0, "9091")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, host, IS_STRING, 0, "'127.0.0.1'")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+
+/* ============================================================================== */
+/* == Quicpro\Qlog Class (Static)                                              == */
+/* ============================================================================== */
+
+/* {{{ Quicpro\Qlog::dump(?string $path = null): string|bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_Quicpro_Qlog_dump, 0, 0, MAY_BE_STRING|MAY_BE_BOOL)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, path, IS_STRING, 1, "null")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Qlog::toJsonSeq(string $dump): string */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Qlog_toJsonSeq, 0, 1, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, dump, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+
+/* ============================================================================== */
+/* == Quicpro\Server Class (Static)                                            == */
+/* ============================================================================== */
+
+/* {{{ Quicpro\Server::connectionStats(): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Server_connectionStats, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Server::reconfigure(array $settings): int */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Server_reconfigure, 0, 1, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO(0, settings, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+
+/* ============================================================================== */
+/* == Quicpro\Profiler Class (Static)                                          == */
+/* ============================================================================== */
+
+/* {{{ Quicpro\Profiler::enable(bool $on = true): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Profiler_enable, 0, 0, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, on, _IS_BOOL, 0, "true")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Profiler::export(string $format = 'folded'): string */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Profiler_export, 0, 0, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, format, IS_STRING, 0, "'folded'")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Profiler::snapshot(): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Profiler_snapshot, 0, 0, IS_ARRAY, 0)
 ZEND_END_ARG_INFO()
 /* }}} */
 
@@ -136,14 +294,20 @@ ZEND_END_ARG_INFO()
 /* == Quicpro\PipelineOrchestrator Class (Static)                              == */
 /* ============================================================================== */
 
-/* {{{ Quicpro\PipelineOrchestrator::run(mixed $initialData, array $pipelineDefinition, ?array $options = null): object */
+/* {{{ Quicpro\PipelineOrchestrator::run(mixed $initialData, array|resource $pipelineDefinition, ?array $options = null): object */
 ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_PipelineOrchestrator_run, 0, 2, IS_OBJECT, 0)
     ZEND_ARG_INFO(0, initialData)
-    ZEND_ARG_TYPE_INFO(0, pipelineDefinition, IS_ARRAY, 0)
+    ZEND_ARG_INFO(0, pipelineDefinition) /* array, or a plan from compile() */
     ZEND_ARG_TYPE_INFO(0, executionOptions, IS_ARRAY, 1)
 ZEND_END_ARG_INFO()
 /* }}} */
 
+/* {{{ Quicpro\PipelineOrchestrator::compile(array $pipelineDefinition): resource */
+ZEND_BEGIN_ARG_INFO_EX(arginfo_Quicpro_PipelineOrchestrator_compile, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, pipelineDefinition, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
 /* {{{ Quicpro\PipelineOrchestrator::registerToolHandler(string $toolName, array $handlerConfig): bool */
 ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_PipelineOrchestrator_registerToolHandler, 0, 2, _IS_BOOL, 0)
     ZEND_ARG_TYPE_INFO(0, toolName, IS_STRING, 0)
@@ -151,6 +315,11 @@ ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_PipelineOrchestrator_reg
 ZEND_END_ARG_INFO()
 /* }}} */
 
+/* {{{ Quicpro\PipelineOrchestrator::getStats(): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_PipelineOrchestrator_getStats, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
 
 /* ============================================================================== */
 /* == Quicpro\WebSocket Class                                                  == */
@@ -207,5 +376,522 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_cancel_stream_global, 0, 0, 2)
     ZEND_ARG_TYPE_INFO(0, how, IS_STRING, 1)
 ZEND_END_ARG_INFO()
 
+/* ============================================================================== */
+/* == Reactor (multi-session event loop)                                       == */
+/* ============================================================================== */
+
+/* {{{ quicpro_reactor_new(): resource|false */
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_reactor_new, 0, 0, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_reactor_add(resource $reactor, resource $session): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_reactor_add, 0, 2, _IS_BOOL, 0)
+    ZEND_ARG_INFO(0, reactor) /* resource */
+    ZEND_ARG_INFO(0, session) /* resource */
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_reactor_remove(resource $reactor, resource $session): bool */
+#define arginfo_quicpro_reactor_remove arginfo_quicpro_reactor_add
+/* }}} */
+
+/* {{{ quicpro_reactor_run(resource $reactor, int $timeout_ms): array|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_reactor_run, 0, 2, MAY_BE_ARRAY|MAY_BE_FALSE)
+    ZEND_ARG_INFO(0, reactor) /* resource */
+    ZEND_ARG_TYPE_INFO(0, timeout_ms, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_reactor_stats(resource $reactor): array|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_reactor_stats, 0, 1, MAY_BE_ARRAY|MAY_BE_FALSE)
+    ZEND_ARG_INFO(0, reactor) /* resource */
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_scheduler_run(int $timeout_ms = -1): int|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_scheduler_run, 0, 0, MAY_BE_LONG|MAY_BE_FALSE)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeout_ms, IS_LONG, 0, "-1")
+ZEND_END_ARG_INFO()
+/* }}} */
+/* {{{ quicpro_header_template_register(string $name, array $headers): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_header_template_register, 0, 2, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, name, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, headers, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_server_on_cancel(callable $callback): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_server_on_cancel, 0, 1, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, callback, IS_CALLABLE, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_request_cancelled(): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_request_cancelled, 0, 0, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_access_log_convert(string $binary_path, string $json_path): int|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_access_log_convert, 0, 2, MAY_BE_LONG|MAY_BE_FALSE)
+    ZEND_ARG_TYPE_INFO(0, binary_path, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, json_path, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_loadgen_run(array $options): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_loadgen_run, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, options, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_loadgen_merge(array $results): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_loadgen_merge, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, results, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_http3_batch_submit(resource $session, array $requests): array|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_http3_batch_submit, 0, 2, MAY_BE_ARRAY|MAY_BE_FALSE)
+    ZEND_ARG_INFO(0, session) /* resource */
+    ZEND_ARG_TYPE_INFO(0, requests, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_http3_batch_wait(resource $session, int $timeout_ms = -1, int $max = 0): array|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_http3_batch_wait, 0, 1, MAY_BE_ARRAY|MAY_BE_FALSE)
+    ZEND_ARG_INFO(0, session) /* resource */
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeout_ms, IS_LONG, 0, "-1")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, max, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_http3_batch_pending(resource $session): int */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_http3_batch_pending, 0, 1, IS_LONG, 0)
+    ZEND_ARG_INFO(0, session) /* resource */
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* ============================================================================== */
+/* == Unified client (Alt-Svc driven HTTP/3, TCP fallback)                     == */
+/* ============================================================================== */
+
+/* {{{ quicpro_client_send_request(string $url, string $method = "GET", ?array $headers = null, ?string $body = null, ?array $options = null): array|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_client_send_request, 0, 1, MAY_BE_ARRAY|MAY_BE_FALSE)
+    ZEND_ARG_TYPE_INFO(0, url, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, method, IS_STRING, 0, "\"GET\"")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, headers, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, body, IS_STRING, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, options, IS_ARRAY, 1, "null")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* ============================================================================== */
+/* == Native HTTP/2 client (nghttp2)                                           == */
+/* ============================================================================== */
+
+/* {{{ quicpro_http2_request_send(string $url, string $method = "GET", ?array $headers = null, ?string $body = null, ?array $options = null): array|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_http2_request_send, 0, 1, MAY_BE_ARRAY|MAY_BE_FALSE)
+    ZEND_ARG_TYPE_INFO(0, url, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, method, IS_STRING, 0, "\"GET\"")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, headers, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, body, IS_STRING, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, options, IS_ARRAY, 1, "null")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_http2_request_send_multi(array $requests, ?array $options = null): array|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_http2_request_send_multi, 0, 1, MAY_BE_ARRAY|MAY_BE_FALSE)
+    ZEND_ARG_TYPE_INFO(0, requests, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, options, IS_ARRAY, 1, "null")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* ============================================================================== */
+/* == libcurl HTTP client (TCP origins)                                        == */
+/* ============================================================================== */
+
+/* {{{ quicpro_http_request_send(string $url, string $method = "GET", ?array $headers = null, ?string $body = null, ?array $options = null): array|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_http_request_send, 0, 1, MAY_BE_ARRAY|MAY_BE_FALSE)
+    ZEND_ARG_TYPE_INFO(0, url, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, method, IS_STRING, 0, "\"GET\"")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, headers, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, body, IS_STRING, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, options, IS_ARRAY, 1, "null")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_http_batch_submit(array $requests): array|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_http_batch_submit, 0, 1, MAY_BE_ARRAY|MAY_BE_FALSE)
+    ZEND_ARG_TYPE_INFO(0, requests, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_http_batch_wait(int $timeout_ms = -1, int $max = 0): array|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_http_batch_wait, 0, 0, MAY_BE_ARRAY|MAY_BE_FALSE)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeout_ms, IS_LONG, 0, "-1")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, max, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_http_batch_pending(): int */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_http_batch_pending, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_ws_receive(resource $ws, int $timeout_ms = -1): string|false|null */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_ws_receive, 0, 1, MAY_BE_STRING|MAY_BE_FALSE|MAY_BE_NULL)
+    ZEND_ARG_INFO(0, ws) /* resource */
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeout_ms, IS_LONG, 0, "-1")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_ws_receive_chunk(resource $ws, int $timeout_ms = -1): array|false|null */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_ws_receive_chunk, 0, 1, MAY_BE_ARRAY|MAY_BE_FALSE|MAY_BE_NULL)
+    ZEND_ARG_INFO(0, ws) /* resource */
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeout_ms, IS_LONG, 0, "-1")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_ws_subscribe(resource $ws, string $topic): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_ws_subscribe, 0, 2, _IS_BOOL, 0)
+    ZEND_ARG_INFO(0, ws) /* resource */
+    ZEND_ARG_TYPE_INFO(0, topic, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+#define arginfo_quicpro_ws_unsubscribe arginfo_quicpro_ws_subscribe
+
+/* {{{ quicpro_ws_publish(string $topic, string $data, bool $is_binary = false): int */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_ws_publish, 0, 2, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO(0, topic, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, data, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, is_binary, _IS_BOOL, 0, "false")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_ws_flush(resource $ws): int|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_ws_flush, 0, 1, MAY_BE_LONG|MAY_BE_FALSE)
+    ZEND_ARG_INFO(0, ws) /* resource */
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_ws_get_stats(): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_ws_get_stats, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_webtransport_connect(resource $session, string $path, array $headers = [], int $timeout_ms = -1): resource */
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_webtransport_connect, 0, 0, 2)
+    ZEND_ARG_INFO(0, session) /* resource */
+    ZEND_ARG_TYPE_INFO(0, path, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, headers, IS_ARRAY, 0, "[]")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeout_ms, IS_LONG, 0, "-1")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_webtransport_accept(resource $session): ?array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_webtransport_accept, 0, 1, IS_ARRAY, 1)
+    ZEND_ARG_INFO(0, session) /* resource */
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_webtransport_open_stream(resource $wt, bool $bidirectional = true): int|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_webtransport_open_stream, 0, 1, MAY_BE_LONG|MAY_BE_FALSE)
+    ZEND_ARG_INFO(0, wt) /* resource */
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, bidirectional, _IS_BOOL, 0, "true")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_webtransport_stream_send(resource $wt, int $stream_id, string $data, bool $fin = false): int|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_webtransport_stream_send, 0, 3, MAY_BE_LONG|MAY_BE_FALSE)
+    ZEND_ARG_INFO(0, wt) /* resource */
+    ZEND_ARG_TYPE_INFO(0, stream_id, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO(0, data, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, fin, _IS_BOOL, 0, "false")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_webtransport_send_datagram(resource $wt, string $data): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_webtransport_send_datagram, 0, 2, _IS_BOOL, 0)
+    ZEND_ARG_INFO(0, wt) /* resource */
+    ZEND_ARG_TYPE_INFO(0, data, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_webtransport_poll(resource $wt, int $timeout_ms = -1): array|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_webtransport_poll, 0, 1, MAY_BE_ARRAY|MAY_BE_FALSE)
+    ZEND_ARG_INFO(0, wt) /* resource */
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeout_ms, IS_LONG, 0, "-1")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_webtransport_close(resource $wt, int $code = 0, string $reason = ""): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_webtransport_close, 0, 1, _IS_BOOL, 0)
+    ZEND_ARG_INFO(0, wt) /* resource */
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, code, IS_LONG, 0, "0")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, reason, IS_STRING, 0, "\"\"")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_mcp_server_register(string $service, string $method, callable $handler, array $options = []): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_mcp_server_register, 0, 3, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, service, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, method, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, handler, IS_CALLABLE, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, options, IS_ARRAY, 1, "[]")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_mcp_server_serve(resource $session): int */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_mcp_server_serve, 0, 1, IS_LONG, 0)
+    ZEND_ARG_INFO(0, session) /* resource */
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_proxy_route(array $match, string $upstream, array $options = []): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_proxy_route, 0, 2, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, match, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, upstream, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, options, IS_ARRAY, 0, "[]")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_proxy_serve(resource $session): int */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_proxy_serve, 0, 1, IS_LONG, 0)
+    ZEND_ARG_INFO(0, session) /* resource */
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_stream_set_priority(resource $session, int $streamId, string|int|array $priority): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_stream_set_priority, 0, 3, _IS_BOOL, 0)
+    ZEND_ARG_INFO(0, session) /* resource */
+    ZEND_ARG_TYPE_INFO(0, streamId, IS_LONG, 0)
+    ZEND_ARG_TYPE_MASK(0, priority, MAY_BE_STRING|MAY_BE_LONG|MAY_BE_ARRAY, NULL)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_cc_peer_estimate(string $ip): ?array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_cc_peer_estimate, 0, 1, IS_ARRAY, 1)
+    ZEND_ARG_TYPE_INFO(0, ip, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_dns_zone_compile(string $zoneFile, ?string $imagePath = null): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_dns_zone_compile, 0, 1, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, zoneFile, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, imagePath, IS_STRING, 1, "null")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_dns_server_run(): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_dns_server_run, 0, 0, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_state_get(string $key): ?string */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_state_get, 0, 1, IS_STRING, 1)
+    ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_state_mget(array $keys): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_state_mget, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, keys, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_state_set(string $key, string $value): int */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_state_set, 0, 2, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, value, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_state_mset(array $values): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_state_mset, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, values, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_state_delete(string|array $keys): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_state_delete, 0, 1, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_MASK(0, keys, MAY_BE_STRING|MAY_BE_ARRAY, NULL)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_datagram_send_batch(resource $session, array $datagrams): int */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_datagram_send_batch, 0, 2, IS_LONG, 0)
+    ZEND_ARG_INFO(0, session) /* resource */
+    ZEND_ARG_TYPE_INFO(0, datagrams, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_datagram_send_packed(resource $session, string $packed): int */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_datagram_send_packed, 0, 2, IS_LONG, 0)
+    ZEND_ARG_INFO(0, session) /* resource */
+    ZEND_ARG_TYPE_INFO(0, packed, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_datagram_recv_batch(resource $session, int $max = 0, int $timeout_ms = 0): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_datagram_recv_batch, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_INFO(0, session) /* resource */
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, max, IS_LONG, 0, "0")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeout_ms, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_datagram_recv_packed(resource $session, int $max = 0, int $timeout_ms = 0): string */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_datagram_recv_packed, 0, 1, IS_STRING, 0)
+    ZEND_ARG_INFO(0, session) /* resource */
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, max, IS_LONG, 0, "0")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeout_ms, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_datagram_fec_stats(resource $session): ?array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_datagram_fec_stats, 0, 1, IS_ARRAY, 1)
+    ZEND_ARG_INFO(0, session) /* resource */
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_capture_connection(resource $session, bool $enable = true): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_capture_connection, 0, 1, _IS_BOOL, 0)
+    ZEND_ARG_INFO(0, session) /* resource */
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, enable, _IS_BOOL, 0, "true")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_capture_dump(?string $path = null): string|bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_quicpro_capture_dump, 0, 0, MAY_BE_STRING|MAY_BE_BOOL)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, path, IS_STRING, 1, "null")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_client_session_add_path(resource $session, string $interface, int $weight = 1): int */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_client_session_add_path, 0, 2, IS_LONG, 0)
+    ZEND_ARG_INFO(0, session) /* resource */
+    ZEND_ARG_TYPE_INFO(0, interface, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, weight, IS_LONG, 0, "1")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_client_session_paths(resource $session): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_client_session_paths, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_INFO(0, session) /* resource */
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_xdp_filter_stats(): ?array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_xdp_filter_stats, 0, 0, IS_ARRAY, 1)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_stream_capacity(resource $session, int $streamId): int */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_stream_capacity, 0, 2, IS_LONG, 0)
+    ZEND_ARG_INFO(0, session) /* resource */
+    ZEND_ARG_TYPE_INFO(0, streamId, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_stream_write(resource $session, int $streamId, string $data, bool $fin = false, int $timeout_ms = -1): int */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_stream_write, 0, 3, IS_LONG, 0)
+    ZEND_ARG_INFO(0, session) /* resource */
+    ZEND_ARG_TYPE_INFO(0, streamId, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO(0, data, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, fin, _IS_BOOL, 0, "false")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeout_ms, IS_LONG, 0, "-1")
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_session_fd(resource $session): resource|false */
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_session_fd, 0, 0, 1)
+    ZEND_ARG_INFO(0, session) /* resource */
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_session_timeout(resource $session): ?float */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_session_timeout, 0, 1, IS_DOUBLE, 1)
+    ZEND_ARG_INFO(0, session) /* resource */
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_session_process(resource $session): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_session_process, 0, 1, _IS_BOOL, 0)
+    ZEND_ARG_INFO(0, session) /* resource */
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_session_process_many(array $sessions): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_session_process_many, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, sessions, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ quicpro_reactor_fd(resource $reactor): resource|false */
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_reactor_fd, 0, 0, 1)
+    ZEND_ARG_INFO(0, reactor) /* resource */
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Request::method(): string */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Request_method, 0, 0, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+#define arginfo_Quicpro_Request_uri      arginfo_Quicpro_Request_method
+#define arginfo_Quicpro_Request_protocol arginfo_Quicpro_Request_method
+#define arginfo_Quicpro_Request_body     arginfo_Quicpro_Request_method
+
+/* {{{ Quicpro\Request::bodyStream(): resource|false */
+ZEND_BEGIN_ARG_INFO_EX(arginfo_Quicpro_Request_bodyStream, 0, 0, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Request::saveBody(string $path): int|false */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_MASK_EX(arginfo_Quicpro_Request_saveBody, 0, 1, MAY_BE_LONG|MAY_BE_FALSE)
+    ZEND_ARG_TYPE_INFO(0, path, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Request::headers(): array */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Request_headers, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+#define arginfo_Quicpro_Request_toArray arginfo_Quicpro_Request_headers
+
+/* {{{ Quicpro\Request::header(string $name): ?string */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Request_header, 0, 1, IS_STRING, 1)
+    ZEND_ARG_TYPE_INFO(0, name, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Request::offsetExists(mixed $offset): bool */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Request_offsetExists, 0, 1, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Request::offsetGet(mixed $offset): mixed */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Request_offsetGet, 0, 1, IS_MIXED, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Request::offsetSet(mixed $offset, mixed $value): void */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Request_offsetSet, 0, 2, IS_VOID, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+    ZEND_ARG_TYPE_INFO(0, value, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
+/* {{{ Quicpro\Request::offsetUnset(mixed $offset): void */
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_Quicpro_Request_offsetUnset, 0, 1, IS_VOID, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+/* }}} */
+
 
 #endif /* PHP_QUICPRO_ARGINFO_H */
@@ -0,0 +1,58 @@
+/*
+ * include/pipeline_orchestrator/checkpoint.h – Resuming failed pipeline runs
+ * ==========================================================================
+ *
+ * A run given a 'run_id' keeps the output of every step it completes in
+ * the state backend (include/state/state.h):
+ *
+ *     $opts = ['run_id' => 'summarize:' . $docHash];
+ *     $result = Quicpro\PipelineOrchestrator::run($data, $plan, $opts);
+ *     // step 7 failed: the same call again runs step 7 onwards only
+ *
+ * A run with the same ID reads all of its steps' checkpoints in one batch
+ * before it starts. A step found there is done at once with the output
+ * it had, so neither it nor its tool call runs again; the steps after it
+ * run as usual. When a run succeeds its checkpoints are deleted. The ID
+ * names one run of one pipeline with one input: a changed definition
+ * under an old ID resumes from outputs that may no longer fit.
+ *
+ * The key of a step is "pipeline:<run_id>:<step_id>", at most
+ * QUICPRO_STATE_KEY_MAX bytes. Its value is one tag byte and the output:
+ * - 'I': a step with an output schema, its reply IIBIN-encoded again;
+ * - 'R': a step without one, the reply as it came;
+ * - 'S': anything else (a ForEach step's list of results), serialized.
+ *
+ * Checkpoints only save work. A backend that cannot be read or written
+ * costs a warning, and the run goes on as it would without them.
+ */
+
+#ifndef QUICPRO_PIPELINE_CHECKPOINT_H
+#define QUICPRO_PIPELINE_CHECKPOINT_H
+
+#include <php.h>
+#include <stdbool.h>
+
+#include "iibin/iibin_internal.h"
+
+/** @brief The key of `step_id` in run `run_id`, or NULL after throwing if it is not a valid state key. */
+zend_string *quicpro_pipeline_checkpoint_key(const zend_string *run_id, const zend_string *step_id);
+
+/**
+ * @brief Fills blobs[i] with the checkpoint under keys[i], NULL where there
+ * is none. False after a warning, with none filled.
+ */
+bool quicpro_pipeline_checkpoint_fetch(zend_string *const *keys, uint32_t n, zend_string **blobs);
+
+/**
+ * @brief The output kept in `blob` (consumed), decoded with `schema` where
+ * it was encoded with it. False after a warning, with `out` UNDEF.
+ */
+bool quicpro_pipeline_checkpoint_decode(const quicpro_iibin_compiled_schema_internal *schema, zend_string *blob, zval *out);
+
+/** @brief Keeps `output` under `key`; `schema`: the step's output schema, or NULL. Warns on failure. */
+void quicpro_pipeline_checkpoint_save(zend_string *key, const quicpro_iibin_compiled_schema_internal *schema, zval *output);
+
+/** @brief Deletes a run's checkpoints. Warns on failure. */
+void quicpro_pipeline_checkpoint_clear(zend_string *const *keys, uint32_t n);
+
+#endif /* QUICPRO_PIPELINE_CHECKPOINT_H */
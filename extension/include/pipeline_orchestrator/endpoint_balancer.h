@@ -0,0 +1,91 @@
+/*
+ * include/endpoint_balancer.h – Client-side load balancing across a tool's MCP endpoints
+ * =====================================================================================
+ *
+ * A tool agent usually runs as a replica set. Instead of one host/port, a
+ * tool's `mcp_target` may list them all:
+ *
+ *     'mcp_target' => [
+ *         'endpoints'    => [['host' => 'llm-a.mcp.local', 'port' => 8000],
+ *                            ['host' => 'llm-b.mcp.local', 'port' => 8000]],
+ *         'service_name' => 'LLMService',
+ *         'method_name'  => 'generate',
+ *     ]
+ *
+ * Each call picks an endpoint by the power of two choices: two endpoints in
+ * rotation at random, and of those the one with the lower cost, its EWMA
+ * latency times one plus its calls in flight. An endpoint that has not
+ * answered yet costs least, so new replicas are tried at once. No proxy
+ * hop sits in front of the pool, and each endpoint keeps its own pooled
+ * connection (include/client/pool.h).
+ *
+ * Outliers leave the rotation for a while: after MCP_LB_EJECT_FAILURES
+ * failed calls in a row, or with an EWMA over MCP_LB_EJECT_LATENCY_FACTOR
+ * times the median of the others. The time out doubles with each ejection
+ * in a row, up to MCP_LB_EJECT_MAX_MS. At most half of the endpoints are
+ * ejected at once, and when none is left in rotation the one due back
+ * first is used.
+ *
+ * The state lives with the tool's target, as long as the tool stays registered.
+ */
+
+#ifndef QUICPRO_ENDPOINT_BALANCER_H
+#define QUICPRO_ENDPOINT_BALANCER_H
+
+#include <php.h>
+#include <stdbool.h>
+
+#define MCP_LB_EWMA_ALPHA            0.25      /* Weight of the newest latency */
+#define MCP_LB_EJECT_FAILURES        5         /* Failures in a row that eject */
+#define MCP_LB_EJECT_LATENCY_FACTOR  5.0       /* EWMA over this times the others' median ejects */
+#define MCP_LB_EJECT_BASE_MS         10000
+#define MCP_LB_EJECT_MAX_MS          300000
+
+/* One replica of a tool agent, and what the client has seen of it. */
+typedef struct _quicpro_mcp_endpoint_t {
+    char      *host;
+    zend_long  port;
+    double     ewma_ms;                /* 0: no answer seen yet */
+    uint32_t   inflight;
+    uint32_t   failures;               /* In a row */
+    uint32_t   ejections;              /* In a row, for the back-off */
+    zend_long  ejected_until_ms;       /* Monotonic clock; 0: in rotation */
+} quicpro_mcp_endpoint_t;
+
+/* A tool's replicas. */
+typedef struct _quicpro_mcp_endpoint_set_t {
+    quicpro_mcp_endpoint_t *endpoints;
+    uint32_t                count;
+} quicpro_mcp_endpoint_set_t;
+
+/*
+ * Parses 'endpoints' (a list of ['host', 'port']) or, without it, 'host' and
+ * 'port' from an `mcp_target` array. FAILURE after throwing.
+ */
+int quicpro_mcp_endpoints_parse(HashTable *target_ht, quicpro_mcp_endpoint_set_t *set, const char *context_for_error);
+
+/* Frees the endpoints' hosts and the array. */
+void quicpro_mcp_endpoints_destroy(quicpro_mcp_endpoint_set_t *set);
+
+/*
+ * Picks the endpoint for the next call, other than `exclude` if there is a
+ * choice (NULL: any), and counts the call in flight there.
+ */
+quicpro_mcp_endpoint_t *quicpro_mcp_endpoint_pick(quicpro_mcp_endpoint_set_t *set, const quicpro_mcp_endpoint_t *exclude);
+
+/*
+ * Counts a call in flight at `ep`, chosen by the caller, if it is in
+ * rotation; false otherwise. It ends like a picked one.
+ */
+bool quicpro_mcp_endpoint_take(quicpro_mcp_endpoint_t *ep);
+
+/*
+ * Ends a call picked with quicpro_mcp_endpoint_pick(): `latency_ms` feeds
+ * the EWMA of an answered call, a failure counts towards ejection.
+ * quicpro_mcp_endpoint_cancel() ends one that neither answered nor
+ * failed, such as a hedge that lost.
+ */
+void quicpro_mcp_endpoint_report(quicpro_mcp_endpoint_set_t *set, quicpro_mcp_endpoint_t *ep, zend_long latency_ms, bool ok);
+void quicpro_mcp_endpoint_cancel(quicpro_mcp_endpoint_t *ep);
+
+#endif /* QUICPRO_ENDPOINT_BALANCER_H */
@@ -26,6 +26,15 @@
 /* Opaque structure for internal pipeline execution state if needed by any helper functions declared here. */
 /* typedef struct _quicpro_pipeline_execution_context_t quicpro_pipeline_execution_context_t; */
 
+/*
+ * A pipeline definition compiled by quicpro_pipeline_orchestrator_compile():
+ * steps with their tool handlers, output schemas, input paths, renamed
+ * params and dependencies resolved. Read-only once built; PHP holds it as
+ * a "quicpro_pipeline_plan" resource.
+ */
+typedef struct _quicpro_pipeline_plan_t quicpro_pipeline_plan_t;
+extern int le_quicpro_pipeline_plan;
+
 
 /* --- C Structures for Pipeline Definition & Options (populated from PHP) --- */
 
@@ -79,6 +88,32 @@ int quicpro_pipeline_orchestrator_init_settings(void);
  */
 void quicpro_pipeline_orchestrator_shutdown_settings(void);
 
+/*
+ * quicpro_pipeline_orchestrator_rshutdown()
+ * -----------------------------------------
+ * Sends the events auto context logging still buffers and drops the
+ * logger. Called from RSHUTDOWN, before the client connections close.
+ */
+void quicpro_pipeline_orchestrator_rshutdown(void);
+
+/*
+ * quicpro_pipeline_orchestrator_prewarm()
+ * ---------------------------------------
+ * Sends the warm-ups that the tools registered with 'prewarm' need now
+ * (see pipeline_orchestrator/prewarm.h). A worker's loop calls it between
+ * requests, so a burst that no run has started yet finds warm executors.
+ *
+ * Returns: the number of warm-ups started.
+ */
+uint32_t quicpro_pipeline_orchestrator_prewarm(void);
+
+/*
+ * quicpro_pipeline_plan_minit(int module_number)
+ * ----------------------------------------------
+ * Registers the "quicpro_pipeline_plan" resource type. Called from MINIT.
+ */
+void quicpro_pipeline_plan_minit(int module_number);
+
 /*
  * quicpro_pipeline_orchestrator_configure_auto_logging_from_php(zval *logger_config_php_array)
  * -------------------------------------------------------------------------------------------
@@ -88,6 +123,15 @@ void quicpro_pipeline_orchestrator_shutdown_settings(void);
  * Parameters:
  * - logger_config_php_array: A PHP array detailing the MCP target for the GraphEventLoggerAgent,
  * batching options, log level, etc. (e.g., as in the example {'mcp_target':{...}, 'batch_size':100}).
+ * 'batch_proto_schema' names the message the agent receives: 'events_field' ('events') repeats
+ * the events, each an array with 'event' (pipeline_start, step_done, step_failed, pipeline_done,
+ * pipeline_failed), 'at_ms', 'run_id' and, per step, 'step', 'tool' and 'duration_ms'.
+ *
+ * Events are not sent as they happen. They wait in a per-worker ring of 'buffer_size' events
+ * (4096), and a run that ends sends them once 'batch_size' (100) are buffered or the oldest has
+ * waited 'flush_interval_ms' (1000), 'batch_size' per call; the rest go out at request shutdown.
+ * Events that find the ring full are dropped and counted, see
+ * quicpro_pipeline_orchestrator_get_stats().
  *
  * Returns: SUCCESS or FAILURE.
  */
@@ -119,14 +163,36 @@ int quicpro_pipeline_orchestrator_register_tool_handler_from_php(const char *too
  *
  * Parameters:
  * - initial_data_php_zval: A PHP zval (string, array, or object) representing the initial input to the pipeline.
- * - pipeline_def_php_array: A PHP array representing the pipeline definition (array of step definition arrays).
+ * - pipeline_def_php_array: A PHP array representing the pipeline definition (array of step definition arrays),
+ * or a plan compiled from one by quicpro_pipeline_orchestrator_compile(). An array is compiled for the one run.
  * - exec_options_php_array: An optional PHP array for execution options. Can be NULL.
  * - return_value: The zval to be populated with the PHP `WorkflowResult` object (or an array).
  *
  * The C implementation will:
  * 1. Parse `pipeline_def_php_array` into `quicpro_pipeline_def_c`.
  * 2. Parse `exec_options_php_array` into `quicpro_pipeline_exec_options_c`.
- * 3. Execute the pipeline step-by-step:
+ * 3. Execute the pipeline as a dependency graph: a step waits for the
+ * steps its `input_map` reads ('@step_id.output...'), those named in
+ * 'depends_on' (an ID or a list of IDs), and with `condition_true_only`
+ * the step before it. A step's ID is its 'id', or its tool name. Steps
+ * whose dependencies are done run concurrently, each in its own Fiber, up
+ * to the 'max_concurrency' exec option (default
+ * quicpro.orchestrator_step_concurrency_default; 1 runs them in order).
+ * A ForEach step ('foreach' => '@step_id.output.list') maps its tool over
+ * a list: one call per 'batch_size' items (1: each item alone under
+ * 'item_field'; more: a batched call with 'items_field', answered with
+ * 'results_field'), up to its own 'max_concurrency' calls at once (default
+ * quicpro.orchestrator_loop_concurrency_default), and outputs the results
+ * in item order. It counts as one step against the run's cap.
+ * A step with 'stream_from' => 'StepId' is a ForEach over the records of
+ * that step's reply, split at 'stream_delimiter' ("\n"), and starts as
+ * soon as its source does: each batch goes out when its records have
+ * arrived, so a step after a token-streaming LLM begins on the first
+ * line rather than the last. Its source's output is unchanged.
+ * With the 'run_id' exec option every completed step's output is
+ * checkpointed, and a run under the same ID resumes after the steps an
+ * earlier one completed (pipeline_orchestrator/checkpoint.h).
+ * For every step:
  * a. Resolve tool handlers using `tool_handler_registry.h` API.
  * b. Manage an internal C-level execution context for data flow (`@initial`, `@previous`).
  * c. Handle input/output mapping (`param_map`, `output_map` from tool handler).
@@ -160,6 +226,27 @@ int quicpro_orchestrator_execute_pipeline_c(
  */
 PHP_FUNCTION(quicpro_pipeline_orchestrator_run);
 
+/*
+ * PHP_FUNCTION(quicpro_pipeline_orchestrator_compile)
+ * (Declaration of the PHP-bindable function behind `Quicpro\PipelineOrchestrator::compile()`:
+ * validates a definition once and returns its plan, for runs that repeat it)
+ */
+PHP_FUNCTION(quicpro_pipeline_orchestrator_compile);
+
+/*
+ * PHP_FUNCTION(quicpro_pipeline_orchestrator_prewarm)
+ * (Declaration of the PHP-bindable function behind `Quicpro\PipelineOrchestrator::prewarm()`:
+ * calls quicpro_pipeline_orchestrator_prewarm() and returns how many warm-ups it started)
+ */
+PHP_FUNCTION(quicpro_pipeline_orchestrator_prewarm);
+
+/*
+ * PHP_FUNCTION(quicpro_pipeline_orchestrator_get_stats)
+ * (Declaration of the PHP-bindable function behind `Quicpro\PipelineOrchestrator::getStats()`:
+ * this worker's step cache counters, see pipeline_orchestrator/step_cache.h)
+ */
+PHP_FUNCTION(quicpro_pipeline_orchestrator_get_stats);
+
 /*
  * PHP_FUNCTION(quicpro_pipeline_orchestrator_register_tool)
  * (Declaration of the PHP-bindable function that calls quicpro_pipeline_orchestrator_register_tool_handler_from_php)
@@ -0,0 +1,123 @@
+/*
+ * include/pipeline_orchestrator/prewarm.h – Keeping a serverless tool's executors warm
+ * ====================================================================================
+ *
+ * A tool whose agent runs as a serverless function pays a cold start
+ * whenever a call finds no container up: hundreds of milliseconds, on the
+ * first step of every burst. With 'prewarm' in its 'mcp_target' the
+ * orchestrator keeps track of the function's executors and keeps as many
+ * warm as the tool is about to need:
+ *
+ *     'mcp_target' => [
+ *         'host' => 'summarize.fn.example', 'port' => 443,
+ *         'service_name' => 'Summarizer', 'method_name' => 'summarize',
+ *         'prewarm' => ['method' => 'warm', 'keep_warm_ms' => 300000, 'horizon_ms' => 2000, 'max' => 8],
+ *     ]
+ *
+ * An executor is one function instance at one of the tool's endpoints. It
+ * counts as warm for 'keep_warm_ms' after a call it served ended, which is
+ * how long the platform keeps an idle instance. A call goes to an idle
+ * warm executor when there is one, the most recently used first, and to the
+ * balancer's pick (endpoint_balancer.h) otherwise.
+ *
+ * Each call's start goes into a ring of QUICPRO_PREWARM_RING timestamps,
+ * and the largest overlap of one burst is kept for the last
+ * QUICPRO_PREWARM_BURSTS bursts. A call that starts more than 'horizon_ms'
+ * after the one before begins a new burst. The concurrency the tool needs
+ * within 'horizon_ms' is the largest of:
+ *
+ * - the calls in flight now;
+ * - the recent call rate times the tool's mean latency (Little's law);
+ * - the largest recent burst's overlap, while a burst runs or is due,
+ *   where bursts repeat at their median spacing.
+ *
+ * Up to 'max' of that, quicpro_prewarm_tick() sends warm-up calls to the
+ * 'method' (an empty payload; its reply is dropped). Each warm-up goes to
+ * an executor that is cold or would be by then, and each runs in a Fiber of
+ * its own. Concurrent calls are what makes the platform start several
+ * instances. The worker's scheduler (poll/scheduler.h) drives them, and a
+ * pipeline run drives them along with its steps.
+ *
+ * The agent runs at the start of every pipeline run, for the tools the run
+ * uses, and from quicpro_pipeline_orchestrator_prewarm(), which a worker's
+ * loop calls to warm ahead of a burst that no run has started yet. Without
+ * Fibers (PHP < 8.1) the warm-ups run one after another in place.
+ */
+
+#ifndef QUICPRO_PIPELINE_PREWARM_H
+#define QUICPRO_PIPELINE_PREWARM_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "endpoint_balancer.h"
+
+#define QUICPRO_PREWARM_RING   128     /* Call starts kept per tool; a power of two */
+#define QUICPRO_PREWARM_BURSTS 8       /* Bursts kept per tool */
+#define QUICPRO_PREWARM_EWMA_ALPHA 0.2 /* Weight of the newest latency */
+
+struct _quicpro_mcp_target_config_t;
+
+/* One function instance, as far as the orchestrator can tell */
+typedef struct {
+    uint32_t  endpoint;             /* Index into the tool's endpoints */
+    zend_long warm_until_ms;        /* 0: never warmed, or known cold */
+    bool      busy;                 /* Serving a call or a warm-up */
+} quicpro_prewarm_executor_t;
+
+typedef struct _quicpro_prewarm_t {
+    char      *method;              /* Warm-up method of the tool's service */
+    zend_long  keep_warm_ms, horizon_ms;
+    uint32_t   max;
+
+    /* Call starts (monotonic clock); head is free-running */
+    zend_long  ring[QUICPRO_PREWARM_RING];
+    uint32_t   head;
+    uint32_t   inflight;
+    double     latency_ms;          /* EWMA of answered calls; 0: none yet */
+
+    struct {
+        zend_long start_ms;
+        uint32_t  peak;
+    } bursts[QUICPRO_PREWARM_BURSTS];
+    uint32_t   burst_head;          /* Free-running */
+
+    quicpro_prewarm_executor_t *executors; /* [max] */
+    uint32_t   warmups_sent, warmups_failed, warm_hits, cold_calls;
+} quicpro_prewarm_t;
+
+/** @brief Parses 'prewarm' of an 'mcp_target'; NULL after throwing. */
+quicpro_prewarm_t *quicpro_prewarm_parse(HashTable *ht, const char *context_for_error);
+void quicpro_prewarm_free(quicpro_prewarm_t *pw);
+
+/**
+ * @brief Starts a call: records it and picks an idle warm executor whose
+ * endpoint is in rotation, counted in flight there. @return its index, or
+ * -1 when the balancer picks (and the call may start cold).
+ */
+int quicpro_prewarm_acquire(quicpro_prewarm_t *pw, quicpro_mcp_endpoint_set_t *set);
+
+/**
+ * @brief Ends a call of quicpro_prewarm_acquire(): `executor` as it
+ * returned, `endpoint` the index the call went to. An answered call
+ * leaves its executor warm, a failed one cold.
+ */
+void quicpro_prewarm_release(quicpro_prewarm_t *pw, int executor, uint32_t endpoint, zend_long latency_ms, bool ok);
+
+/** @brief The executors the tool needs within its horizon, from its calls so far. */
+uint32_t quicpro_prewarm_predict(const quicpro_prewarm_t *pw);
+
+/**
+ * @brief Sends the warm-ups `target` needs (see above); it must stay
+ * registered while they run. @return how many were started.
+ */
+uint32_t quicpro_prewarm_tick(struct _quicpro_mcp_target_config_t *target);
+
+/** @brief The tool's executors and counters, as an array in `stats`. */
+void quicpro_prewarm_stats(const quicpro_prewarm_t *pw, zval *stats);
+
+/** @brief Releases the warm-ups still held (RSHUTDOWN). */
+void quicpro_prewarm_rshutdown(void);
+
+#endif /* QUICPRO_PIPELINE_PREWARM_H */
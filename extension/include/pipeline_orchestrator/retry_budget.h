@@ -0,0 +1,65 @@
+/*
+ * include/pipeline_orchestrator/retry_budget.h – Retrying failed tool calls within a budget
+ * ========================================================================================
+ *
+ * A tool call that fails in transit (quicpro_mcp_call_transient(): the
+ * connection could not be opened, was lost or reset, or the reply did not
+ * come in time) is tried again, on another endpoint where the tool has
+ * several, under the mcp_and_orchestrator config module:
+ *
+ *     quicpro.mcp_default_retry_policy_enable = 1
+ *     quicpro.mcp_default_retry_max_attempts = 3          ; the first one included
+ *     quicpro.mcp_default_retry_backoff_ms_initial = 100
+ *     quicpro.mcp_retry_budget_percent = 10
+ *
+ * Before the n-th retry the caller waits a random time between 0 and
+ * backoff_ms_initial * 2^(n-1), at most MCP_RETRY_BACKOFF_MAX_MS ("full
+ * jitter"), so the callers a failure hit at once do not all come back at
+ * once. A Fiber waiting so leaves the others to run.
+ *
+ * Retries draw on the target's budget: over the last MCP_RETRY_WINDOW_MS,
+ * at most mcp_retry_budget_percent of its calls, or MCP_RETRY_BUDGET_MIN
+ * retries where that is more. The budget is the worker's, shared by all
+ * calls to the target, so when an agent fails for everyone the retries add
+ * a tenth to its load rather than tripling it. A retry whose wait would
+ * not end before the call's deadline ('timeout_ms' of the target, covering
+ * all of its attempts) is not made either: the call fails as it did.
+ *
+ * The agent may have run a call that then failed in transit, so a retried
+ * tool may run twice. A target with 'retry' => false is never retried;
+ * nor is a streamed call once part of its reply went downstream.
+ *
+ * The state lives with the tool's target, as long as the tool stays registered.
+ */
+
+#ifndef QUICPRO_RETRY_BUDGET_H
+#define QUICPRO_RETRY_BUDGET_H
+
+#include <php.h>
+#include <stdbool.h>
+
+#define MCP_RETRY_WINDOW_MS       10000     /* What the budget looks back on */
+#define MCP_RETRY_BUCKETS         10        /* ...in slices of a tenth */
+#define MCP_RETRY_BUDGET_MIN      10        /* Retries a window allows however few the calls */
+#define MCP_RETRY_BACKOFF_MAX_MS  10000
+
+/* A target's calls and retries over the last MCP_RETRY_WINDOW_MS. */
+typedef struct _quicpro_mcp_retry_budget_t {
+    uint32_t  calls[MCP_RETRY_BUCKETS];
+    uint32_t  retries[MCP_RETRY_BUCKETS];
+    uint32_t  head;                         /* The current bucket */
+    zend_long head_ms;                      /* When it began; 0: never used */
+} quicpro_mcp_retry_budget_t;
+
+/* Counts a call to the target, its first attempt. */
+void quicpro_mcp_retry_note_call(quicpro_mcp_retry_budget_t *budget);
+
+/*
+ * Whether attempt `attempt` (1: the first), which failed in transit, is
+ * tried again with `remaining_ms` left of the call's deadline. If so, the
+ * retry is taken from the budget and the wait before it returned; -1 if
+ * not.
+ */
+zend_long quicpro_mcp_retry_backoff(quicpro_mcp_retry_budget_t *budget, uint32_t attempt, zend_long remaining_ms);
+
+#endif /* QUICPRO_RETRY_BUDGET_H */
@@ -0,0 +1,70 @@
+/*
+ * include/pipeline_orchestrator/step_cache.h – Memoized results of deterministic pipeline tools
+ * ============================================================================================
+ *
+ * Many tools answer identical requests identically: embeddings, RAG
+ * retrieval, lookups. A tool registered with 'cache' has its replies kept
+ * and reused while they are fresh:
+ *
+ *     Quicpro\PipelineOrchestrator::registerToolHandler('Embed', [
+ *         'mcp_target' => [...],
+ *         'input_proto_schema' => 'EmbedRequest', 'output_proto_schema' => 'EmbedReply',
+ *         'cache' => ['ttl_ms' => 3600000],   // or true: quicpro.mcp_request_cache_ttl_sec
+ *     ]);
+ *
+ * The key is the tool name and the request once IIBIN-encoded, so two
+ * requests hit the same entry exactly when they would go out as the same
+ * bytes. It is kept as two independent 64-bit hashes and the length
+ * rather than the request itself. The value is the reply as it came, still
+ * encoded; a hit is decoded like a fresh reply and never reaches the agent.
+ *
+ * Nothing is cached unless quicpro.mcp_enable_request_caching is on. The
+ * table has quicpro.mcp_request_cache_entries slots of
+ * quicpro.mcp_request_cache_entry_max_kb each, fixed when it is mapped; a
+ * larger reply is simply not kept. A key may live in one of two slots
+ * (include/cluster/shm_cache.h), and a new entry takes an empty
+ * or expired one, else the one that would expire first. With
+ * quicpro.mcp_request_cache_shared the cluster master maps the table
+ * shared before forking, so every worker hits what any of them stored.
+ * Each slot has its own spin lock, and a lookup that cannot take it in
+ * time counts as a miss.
+ *
+ * Hits, misses and stores are counted for quicpro_pipeline_orchestrator_get_stats().
+ */
+
+#ifndef QUICPRO_PIPELINE_STEP_CACHE_H
+#define QUICPRO_PIPELINE_STEP_CACHE_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* An entry's identity. */
+typedef struct {
+    uint64_t key;               /* Picks the slots; never 0 */
+    uint64_t check;             /* A second hash, compared on a hit */
+    uint32_t request_len;
+} quicpro_step_cache_key_t;
+
+/** @brief Maps the table shared, if configured. Called by the cluster master before forking. */
+void quicpro_step_cache_prepare(void);
+
+/** @brief Unmaps the table. */
+void quicpro_step_cache_release(void);
+
+/** @brief The key of `tool`'s encoded `request`. */
+void quicpro_step_cache_key(quicpro_step_cache_key_t *key, const char *tool, const char *request, size_t request_len);
+
+/**
+ * @brief The fresh reply stored under `key`, or NULL on a miss (or with
+ * caching off). The caller owns the string.
+ */
+zend_string *quicpro_step_cache_get(const quicpro_step_cache_key_t *key);
+
+/** @brief Stores `reply` under `key` for `ttl_ms`. */
+void quicpro_step_cache_put(const quicpro_step_cache_key_t *key, const zend_string *reply, zend_long ttl_ms);
+
+/** @brief Adds the step_cache_* counters to the array `into`. */
+void quicpro_step_cache_add_stats(zval *into);
+
+#endif /* QUICPRO_PIPELINE_STEP_CACHE_H */
@@ -23,6 +23,9 @@
 #include <php.h>        /* Zend API, zval, HashTable */
 #include "mcp.h"        /* For quicpro_mcp_options_t or similar if MCP options are stored granularly */
                         /* Or simply use a HashTable* for mcp_options if they are passed as PHP arrays */
+#include "endpoint_balancer.h"
+#include "prewarm.h"
+#include "retry_budget.h"
 
 /* --- Forward Declarations --- */
 /* Opaque struct for a compiled Proto schema representation, if needed at this level.
@@ -35,8 +38,10 @@
 /* --- MCP Target Configuration --- */
 /* Defines the specific MCP agent endpoint for a tool. */
 typedef struct _quicpro_mcp_target_config_t {
-    char *host;
+    char *host;                 /* The first of `endpoints` */
     zend_long port;
+    /* The tool's replicas ('endpoints', or host/port alone); each call picks one. */
+    quicpro_mcp_endpoint_set_t endpoints;
     char *service_name;
     char *method_name;
     /*
@@ -46,6 +51,25 @@ typedef struct _quicpro_mcp_target_config_t {
      * to be used when creating an MCP client instance for this tool.
      */
     zval mcp_client_options_php_array;
+    /* Per-call deadline ('timeout_ms'); 0: mcp_default_request_timeout_ms. */
+    zend_long timeout_ms;
+    /*
+     * Optional hedging ('hedge' => ['host', 'port', 'after_ms']): a call
+     * unanswered after hedge_after_ms goes to a second endpoint too, the
+     * first reply wins and the other is cancelled (quicpro_mcp_request(),
+     * include/mcp/mcp.h). Without 'host' the second endpoint is another
+     * of `endpoints`. hedge_after_ms -1: the method's observed p95.
+     */
+    zend_bool hedge;
+    char *hedge_host;           /* NULL: one of `endpoints` */
+    zend_long hedge_port;
+    zend_long hedge_after_ms;
+    quicpro_cfg_t *cfg;         /* QUIC/TLS settings (INI defaults), built at registration. */
+    /* 'prewarm': keeps a serverless agent's executors warm (prewarm.h); NULL: off. */
+    quicpro_prewarm_t *prewarm;
+    /* Calls failed in transit are retried within `retry_budget` (retry_budget.h); 'retry' => false: never. */
+    zend_bool retry;
+    quicpro_mcp_retry_budget_t retry_budget;
 } quicpro_mcp_target_config_t;
 
 /* --- Parameter and Output Mapping Configuration --- */
@@ -74,6 +98,15 @@ typedef struct _quicpro_rag_config_t {
 
     quicpro_field_map_t *rag_param_map; /* Maps pipeline step params (e.g. 'context_depth') to GraphRAGAgent request fields. */
                                         /* Stored as a pointer to a HashTable. */
+
+    /*
+     * 'local_index': the name a Quicpro\Geometry\Index was shared under
+     * (semantic_geometry/index.h). With it the context is retrieved in
+     * process, the `local_k` ('local_k', default 5) nearest to the step's
+     * query vector, and no RAG agent or RAG schemas are needed.
+     */
+    char *local_index;
+    zend_long local_k;
 } quicpro_rag_config_t;
 
 /* --- Tool Handler Configuration --- */
@@ -89,6 +122,7 @@ typedef struct _quicpro_tool_handler_config_t {
                                          /* Stored as a pointer to a HashTable. */
     quicpro_rag_config_t *rag_config;    /* Optional RAG configuration for this tool. NULL if not applicable. */
                                          /* Stored as a pointer. */
+    zend_long cache_ttl_ms;              /* 'cache': how long replies are reused (see step_cache.h). 0: never. */
 } quicpro_tool_handler_config_t;
 
 
@@ -143,6 +177,25 @@ int quicpro_tool_handler_register_from_php(const char *tool_name, zval *config_p
  */
 const quicpro_tool_handler_config_t* quicpro_tool_handler_get(const char *tool_name);
 
+/*
+ * quicpro_tool_handler_foreach(fn, arg)
+ * -------------------------------------
+ * Calls `fn` for every registered handler, in registration order. `fn`
+ * must not register tools.
+ */
+void quicpro_tool_handler_foreach(void (*fn)(quicpro_tool_handler_config_t *handler, void *arg), void *arg);
+
+/*
+ * quicpro_mcp_target_parse(HashTable *php_ht, quicpro_mcp_target_config_t *target_out, const char *context_for_error)
+ * --------------------------------------------------------------------------------------------------------------------
+ * Parses an 'mcp_target' array as tool handlers have it, for other agents
+ * the orchestrator calls (the event logger). Throws and returns FAILURE on
+ * an invalid target; whatever was filled in is freed by
+ * quicpro_mcp_target_destroy(), which frees the contents of the struct only.
+ */
+int quicpro_mcp_target_parse(HashTable *php_ht, quicpro_mcp_target_config_t *target_out, const char *context_for_error);
+void quicpro_mcp_target_destroy(quicpro_mcp_target_config_t *target);
+
 /*
  * Note: PHP_FUNCTION prototypes for user-facing static methods like
  * `Quicpro\PipelineOrchestrator::registerToolHandler()` are declared in
@@ -0,0 +1,70 @@
+/*
+ * include/poll/busy_poll.h – Kernel NAPI busy polling for sockets and epoll waits
+ * ================================================================================
+ *
+ * With quicpro.socket_enable_busy_poll_us > 0, a thread that waits for
+ * packets polls the NIC's receive queue itself for up to that many
+ * microseconds before it sleeps until the device interrupts:
+ *
+ * - Every QUIC socket gets SO_BUSY_POLL (the budget), SO_PREFER_BUSY_POLL
+ *   and SO_BUSY_POLL_BUDGET (packets per NAPI poll:
+ *   quicpro.io_max_batch_read_packets, at most QUICPRO_BUSY_POLL_MAX_PACKETS).
+ *   A receive on such a socket runs the driver's poll first, so the drain
+ *   loops find packets that are still in the RX ring.
+ * - The epoll instances of the QUIC listeners and of the reactor get the
+ *   same budget with EPIOCSPARAMS (Linux 6.9): epoll_wait() polls the
+ *   queues of its sockets before it sleeps.
+ * - quicpro_poll() pumps a session for up to the budget while packets
+ *   keep coming, instead of spinning for the whole budget on every call.
+ *
+ * Adaptive fallback. Polling pays only while packets arrive faster than
+ * interrupts deliver them. An epoll instance therefore counts the events
+ * its waits return per QUICPRO_BUSY_POLL_WINDOW_MS: busy polling turns on
+ * at QUICPRO_BUSY_POLL_ON_EVENTS and off again below
+ * QUICPRO_BUSY_POLL_OFF_EVENTS, so an idle worker sleeps on interrupts
+ * and burns no core. quicpro_poll() stops pumping once a quarter of the
+ * budget passed without a packet. While the application polls, SO_PREFER_BUSY_POLL
+ * keeps the device's interrupts masked (given its napi_defer_hard_irqs
+ * and gro_flush_timeout); they come back when it stops.
+ *
+ * Raising SO_BUSY_POLL above net.core.busy_read, preferring busy polling
+ * and raising the packet budgets need CAP_NET_ADMIN. Without it, and on
+ * kernels without EPIOCSPARAMS, sockets and waits keep the system's
+ * settings after one E_NOTICE.
+ */
+
+#ifndef QUICPRO_POLL_BUSY_POLL_H
+#define QUICPRO_POLL_BUSY_POLL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define QUICPRO_BUSY_POLL_MAX_PACKETS  64    /* NAPI_POLL_WEIGHT */
+#define QUICPRO_BUSY_POLL_WINDOW_MS    100
+#define QUICPRO_BUSY_POLL_ON_EVENTS    50    /* 500 wakeups/s */
+#define QUICPRO_BUSY_POLL_OFF_EVENTS   10    /* 100 wakeups/s */
+
+/** @brief Adaptive busy-poll state of one epoll instance. */
+typedef struct {
+    int      epfd;
+    bool     on;            /* EPIOCSPARAMS currently sets the budget */
+    uint32_t events;        /* Ready events in the current window */
+    uint64_t window_ms;     /* Start of the window, CLOCK_MONOTONIC */
+} quicpro_busy_poll_t;
+
+/** @brief The configured budget in microseconds; 0 when busy polling is off. */
+uint32_t quicpro_busy_poll_budget_us(void);
+
+/** @brief Sets the socket options above on a QUIC socket. A no-op when busy polling is off. */
+void quicpro_busy_poll_socket(int fd);
+
+/** @brief Starts tracking `epfd`, with busy polling off until traffic arrives. */
+void quicpro_busy_poll_init(quicpro_busy_poll_t *bp, int epfd);
+
+/**
+ * @brief Accounts one epoll_wait() that returned `ready` and switches the
+ * instance's busy polling on or off at the end of a window.
+ */
+void quicpro_busy_poll_note(quicpro_busy_poll_t *bp, int ready);
+
+#endif /* QUICPRO_POLL_BUSY_POLL_H */
@@ -0,0 +1,84 @@
+/*
+ * include/poll/event_loop.h – Driving sessions from a userland event loop
+ * ========================================================================
+ *
+ * quicpro_poll($session, $ms) has to guess how long to wait: too long and
+ * the next packet or retransmit waits with it, too short and the worker
+ * spins. Event loops like Revolt (Amp), ReactPHP or ext-ev already know
+ * when a descriptor is readable and when a timer is due, so they can
+ * drive a session exactly:
+ *
+ *     $fd = quicpro_session_fd($session);
+ *     $timer = null;
+ *     $tick = function () use ($session, &$timer, &$tick) {
+ *         quicpro_session_process($session);
+ *         if ($timer !== null) {
+ *             EventLoop::cancel($timer);
+ *         }
+ *         $t = quicpro_session_timeout($session);
+ *         $timer = $t === null ? null : EventLoop::delay($t, $tick);
+ *     };
+ *     EventLoop::onReadable($fd, $tick);
+ *     $tick();
+ *
+ *   resource   quicpro_session_fd(resource $session)
+ *                A stream on a duplicate of the descriptor that becomes
+ *                readable when the session has input: its io_uring ring
+ *                when that engine is active, otherwise its UDP socket.
+ *   ?float     quicpro_session_timeout(resource $session)
+ *                Seconds until quiche's next timer (loss detection, idle,
+ *                ACK delay) or the pacer's next release, null if none.
+ *   bool       quicpro_session_process(resource $session)
+ *                Never blocks: reads what arrived, fires a due timer,
+ *                sends what is ready. False once the connection closed.
+ *   array      quicpro_session_process_many(array $sessions)
+ *                quicpro_session_process() over a whole array in one call:
+ *                ['timeout' => the earliest quicpro_session_timeout() of
+ *                the open sessions or null, 'closed' => keys of those that
+ *                closed].
+ *   resource   quicpro_reactor_fd(resource $reactor)
+ *                One descriptor for all of a reactor's sessions and its
+ *                timer wheel, including AF_XDP input. When it is readable,
+ *                quicpro_reactor_run($reactor, 0) has work.
+ *
+ * Closing the returned stream closes only the duplicate. The session's
+ * descriptor can change while its engine is set up, so take the stream
+ * after the connection is established. Server sessions are driven by
+ * their listener loop and have no descriptor of their own.
+ *
+ * These calls run once per readiness event, so they skip the generic
+ * resource lookup: the resource type is compared inline. On PHP 8.4
+ * quicpro_session_process() and quicpro_session_timeout() are also
+ * frameless, compiled to one opcode without a call frame.
+ */
+
+#ifndef QUICPRO_POLL_EVENT_LOOP_H
+#define QUICPRO_POLL_EVENT_LOOP_H
+
+#include <php.h>
+#include <stdint.h>
+
+#include "client/session.h"
+
+#if PHP_VERSION_ID >= 80400
+# include <Zend/zend_frameless_function.h>
+#endif
+
+/** @brief The descriptor that becomes readable when `s` has input; -1 if none. */
+int quicpro_session_poll_fd(quicpro_session_t *s);
+
+/** @brief Nanoseconds until quiche's or the pacer's next deadline; UINT64_MAX if none. */
+uint64_t quicpro_session_deadline_ns(quicpro_session_t *s);
+
+PHP_FUNCTION(quicpro_session_fd);
+PHP_FUNCTION(quicpro_session_timeout);
+PHP_FUNCTION(quicpro_session_process);
+PHP_FUNCTION(quicpro_session_process_many);
+PHP_FUNCTION(quicpro_reactor_fd);
+
+#if PHP_VERSION_ID >= 80400
+ZEND_FRAMELESS_FUNCTION(quicpro_session_timeout, 1);
+ZEND_FRAMELESS_FUNCTION(quicpro_session_process, 1);
+#endif
+
+#endif /* QUICPRO_POLL_EVENT_LOOP_H */
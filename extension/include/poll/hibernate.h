@@ -0,0 +1,64 @@
+/*
+ * include/poll/hibernate.h – Compacting idle sessions
+ * ====================================================
+ *
+ * A gateway holding hundreds of thousands of mostly idle connections pays
+ * for what each one needed at its busiest: receive and send batches sized
+ * for a burst (with UDP GRO, 64 KiB slots), and stream tables that grew
+ * with the streams they once held and never shrink.
+ *
+ * After quicpro.transport_idle_hibernate_ms without a received datagram,
+ * a session hibernates. It keeps its connection but releases:
+ *
+ * - its recvmmsg() batch, keeping the received ECN tallies;
+ * - its sendmmsg() batch, once nothing waits in it;
+ * - the tables of MCP calls, served MCP requests, DNS queries and proxied
+ *   streams, once none is in flight.
+ *
+ * Every one of them is created again on first use, so the next packet
+ * restores the session without further ado. quiche's connection state
+ * stays as it is; its C API has no way to compact it.
+ *
+ * The listeners check their sessions every round, the reactor those it
+ * visits; a session whose timers all ran out is visited when the idle
+ * timer closes it.
+ */
+
+#ifndef QUICPRO_POLL_HIBERNATE_H
+#define QUICPRO_POLL_HIBERNATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "client/session.h"
+
+/** @brief Milliseconds on the coarse monotonic clock: cheap enough for every datagram. */
+static inline uint64_t quicpro_hibernate_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/** @brief Notes that `s` received a datagram; a hibernating session wakes. */
+static inline void quicpro_session_touch(quicpro_session_t *s)
+{
+    s->last_active_ms = quicpro_hibernate_now_ms();
+    s->hibernating = false;
+}
+
+/**
+ * @brief Releases what `s` can create again (see above).
+ * @return Whether anything was released.
+ */
+bool quicpro_session_hibernate(quicpro_session_t *s);
+
+/**
+ * @brief Hibernates `s` once it has been idle for
+ * quicpro.transport_idle_hibernate_ms; a no-op when that is 0 or `s`
+ * already hibernates.
+ */
+void quicpro_session_hibernate_tick(quicpro_session_t *s, uint64_t now_ms);
+
+#endif /* QUICPRO_POLL_HIBERNATE_H */
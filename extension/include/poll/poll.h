@@ -27,6 +27,8 @@
 
 #include <php.h> // Required for the PHP_FUNCTION macro
 
+#include "client/session.h"
+
 /*
  * PHP_FUNCTION(quicpro_poll);
  * ---------------------------
@@ -57,4 +59,12 @@
  */
 PHP_FUNCTION(quicpro_poll);
 
+/*
+ * Session I/O pumps shared by quicpro_poll() and the reactor (reactor.h).
+ * Each moves whatever is ready in one direction through the session's
+ * preferred engine (AF_XDP, io_uring, batched sockets) without blocking.
+ */
+void quicpro_session_pump_rx(quicpro_session_t *s);
+void quicpro_session_pump_tx(quicpro_session_t *s);
+
 #endif /* QUICPRO_POLL_H */
\ No newline at end of file
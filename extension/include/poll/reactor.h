@@ -0,0 +1,94 @@
+/*
+ * include/poll/reactor.h – Multi-session event reactor for php-quicpro_async
+ * ==========================================================================
+ *
+ * `quicpro_poll()` drives one session per call, so a worker holding
+ * thousands of client sessions has to loop over all of them every tick.
+ * The reactor owns many sessions instead and waits on a single epoll set:
+ *
+ * - Each session contributes one descriptor: its io_uring ring when the
+ *   io_uring engine is active, otherwise its UDP socket. With AF_XDP the
+ *   shared XSK socket is watched once for all sessions.
+ * - quiche deadlines live in a hierarchical timer wheel
+ *   (include/poll/timer_wheel.h); a timerfd in the same epoll set is armed
+ *   for the earliest one.
+ * - A tick only touches sessions that had I/O or an expired timer, so the
+ *   per-tick cost is O(active) rather than O(sessions).
+ *
+ * Userland API (procedural, like quicpro_poll()):
+ *
+ *   resource quicpro_reactor_new()
+ *   bool     quicpro_reactor_add(resource $reactor, resource $session)
+ *   bool     quicpro_reactor_remove(resource $reactor, resource $session)
+ *   array    quicpro_reactor_run(resource $reactor, int $timeout_ms)
+ *   array    quicpro_reactor_stats(resource $reactor)
+ *   resource quicpro_reactor_fd(resource $reactor)      (poll/event_loop.h)
+ *
+ * `quicpro_reactor_run()` returns the sessions that made progress during
+ * the tick; closed connections are detached automatically after being
+ * reported one last time. `quicpro_reactor_stats()` reports the transport
+ * stats of every registered session in one call, column by column (see
+ * include/server/conn_stats.h).
+ */
+
+#ifndef QUICPRO_POLL_REACTOR_H
+#define QUICPRO_POLL_REACTOR_H
+
+#include <php.h>
+#include <stdbool.h>
+
+#include "client/session.h"
+
+typedef struct quicpro_reactor_s quicpro_reactor_t;
+
+/**
+ * @brief Invoked once per session serviced by a tick, after its TX flush.
+ * `res` is NULL for sessions attached without a resource. The callback
+ * must not attach or detach sessions.
+ */
+typedef void (*quicpro_reactor_visit_cb)(void *ctx, zend_resource *res, quicpro_session_t *s);
+
+/** @brief Creates an empty reactor, or NULL with errno set. */
+quicpro_reactor_t *quicpro_reactor_create(void);
+
+/** @brief Detaches every session and frees the reactor. NULL-safe. */
+void quicpro_reactor_destroy(quicpro_reactor_t *r);
+
+/**
+ * @brief Registers `s`. With a `res` the reactor holds a reference and
+ * notices quicpro_close(); without one the caller keeps `s` alive until it
+ * detaches it. Idempotent.
+ */
+bool quicpro_reactor_attach(quicpro_reactor_t *r, quicpro_session_t *s, zend_resource *res);
+
+/** @brief Unregisters `s`; false if it was not registered. */
+bool quicpro_reactor_detach_session(quicpro_reactor_t *r, const quicpro_session_t *s);
+
+/** @brief Number of registered sessions. */
+size_t quicpro_reactor_count(const quicpro_reactor_t *r);
+
+/**
+ * @brief Runs one tick, waiting at most `timeout_ms` (-1: until an event).
+ * @return Sessions serviced, or -1 with errno set if epoll_wait() failed.
+ */
+int quicpro_reactor_tick(quicpro_reactor_t *r, int timeout_ms, quicpro_reactor_visit_cb cb, void *ctx);
+
+/**
+ * @brief The epoll descriptor: readable while a session has input or a
+ * deadline is due (see poll/event_loop.h).
+ */
+int quicpro_reactor_epoll_fd(const quicpro_reactor_t *r);
+
+/** Resource type id of reactor handles, registered in MINIT. */
+extern int le_quicpro_reactor;
+
+/** @brief Registers the reactor resource type. Called from MINIT. */
+void quicpro_reactor_minit(int module_number);
+
+PHP_FUNCTION(quicpro_reactor_new);
+PHP_FUNCTION(quicpro_reactor_add);
+PHP_FUNCTION(quicpro_reactor_remove);
+PHP_FUNCTION(quicpro_reactor_run);
+PHP_FUNCTION(quicpro_reactor_stats);
+
+#endif /* QUICPRO_POLL_REACTOR_H */
@@ -0,0 +1,109 @@
+/*
+ * include/poll/scheduler.h – Fiber-parking scheduler for php-quicpro_async
+ * ========================================================================
+ *
+ * PHP 8.1–8.3 expose no C API for suspending a Fiber, so the old
+ * FIBER_SUSPEND() in poll.c was a no-op and a busy-polling quicpro_poll()
+ * blocked the whole worker. The Fiber class itself works on every version
+ * since 8.1, though: calling Fiber::suspend() / $fiber->resume() through
+ * the method table from C is the same operation userland performs.
+ *
+ * Model:
+ * - A blocking call running inside a Fiber registers a waiter (its fiber,
+ *   the session and an optional deadline) and suspends the fiber.
+ * - All waited-on sessions are driven by one per-request reactor
+ *   (include/poll/reactor.h); waiter deadlines sit in a timer wheel.
+ * - quicpro_scheduler_run() performs one reactor tick and resumes every
+ *   fiber whose session made progress or whose deadline expired.
+ * - A parked fiber resumed by userland instead simply returns early
+ *   (QUICPRO_SCHED_RESUMED), so hand-written loops keep working.
+ *
+ * Outside a Fiber the wait functions return QUICPRO_SCHED_NO_FIBER
+ * immediately and callers fall back to their own blocking strategy.
+ */
+
+#ifndef QUICPRO_POLL_SCHEDULER_H
+#define QUICPRO_POLL_SCHEDULER_H
+
+#include <php.h>
+#include <stdbool.h>
+
+#include "client/session.h"
+
+typedef enum {
+    QUICPRO_SCHED_ERROR   = -1,  /* An exception was thrown into the fiber. */
+    QUICPRO_SCHED_NO_FIBER = 0,  /* Not running inside a Fiber. */
+    QUICPRO_SCHED_READY   = 1,   /* The session had I/O or a quiche timer. */
+    QUICPRO_SCHED_TIMEOUT = 2,   /* The caller's timeout elapsed. */
+    QUICPRO_SCHED_RESUMED = 3,   /* Resumed by userland, not the scheduler. */
+} quicpro_sched_result_t;
+
+/** @brief True if the current code runs inside a PHP Fiber (8.1+). */
+bool quicpro_sched_in_fiber(void);
+
+/**
+ * @brief Parks the current Fiber until `s` makes progress or `timeout_ms`
+ * elapses (-1: no caller deadline; quiche's own timers still wake it).
+ *
+ * @param res The session's resource, if any; lets the scheduler notice a
+ * concurrent quicpro_close(). May be NULL if the caller pins `s`.
+ */
+quicpro_sched_result_t quicpro_sched_wait(quicpro_session_t *s, zend_resource *res, zend_long timeout_ms);
+
+/**
+ * @brief Parks the current Fiber for `ms`, waiting on no session: the
+ * other fibers run meanwhile. QUICPRO_SCHED_TIMEOUT once it is over.
+ */
+quicpro_sched_result_t quicpro_sched_sleep(zend_long ms);
+
+/**
+ * @brief Marks every fiber parked on `s` ready for the next scheduler tick.
+ * For callers that read events another fiber waits for: the datagram that
+ * carried them is gone, so the socket would not wake that fiber.
+ */
+void quicpro_sched_wake(quicpro_session_t *s);
+
+/**
+ * @brief True if calls on `s` move its packets themselves: a client
+ * session owns its socket, a server session is driven by the listener loop.
+ */
+bool quicpro_sched_owns_io(const quicpro_session_t *s);
+
+/** @brief Reads what arrived on a session that owns its socket and runs a due QUIC timer. */
+void quicpro_sched_pump_rx(quicpro_session_t *s);
+
+/** @brief Flushes a session that owns its socket. */
+void quicpro_sched_pump_tx(quicpro_session_t *s);
+
+/** @brief CLOCK_MONOTONIC milliseconds, the clock of quicpro_sched_wait_conn()'s `start_ms`. */
+zend_long quicpro_sched_clock_ms(void);
+
+/**
+ * @brief The wait of a blocking call on a session: parks the current Fiber,
+ * or outside one blocks in poll(), until the socket is readable, the QUIC
+ * timer fires or `timeout_ms` (-1: none) counted from `start_ms` has passed.
+ * `what` completes the exception messages ("Failed to wait for %s").
+ *
+ * @return 1 to go round again, 0 on timeout (at once for server sessions,
+ * whose listener loop owns the socket), -1 after throwing.
+ */
+int quicpro_sched_wait_conn(quicpro_session_t *s, zend_resource *res, zend_long start_ms,
+                            zend_long timeout_ms, const char *what);
+
+/** @brief Number of fibers currently parked. */
+size_t quicpro_sched_pending(void);
+
+/**
+ * @brief One tick, as quicpro_scheduler_run(): waits up to `timeout_ms`
+ * (-1: until a waiter deadline or progress) and resumes the fibers that
+ * can go on. Returns the fibers still parked, or -1 after a warning. Stops
+ * resuming once one of them throws, leaving the exception pending.
+ */
+zend_long quicpro_sched_run(zend_long timeout_ms);
+
+/** @brief Releases the per-request reactor (RSHUTDOWN). */
+void quicpro_sched_shutdown(void);
+
+PHP_FUNCTION(quicpro_scheduler_run);
+
+#endif /* QUICPRO_POLL_SCHEDULER_H */
@@ -0,0 +1,77 @@
+/*
+ * include/poll/timer_wheel.h – Hierarchical timer wheel for php-quicpro_async
+ * ===========================================================================
+ *
+ * A hashed hierarchical timer wheel (Varghese & Lauck) with 1 ms ticks and
+ * four levels of 64 slots, covering ~4.6 hours before timers are clamped
+ * and re-checked. Used by the reactor to keep the quiche deadlines of many
+ * sessions: insert, cancel and re-arm are O(1), and advancing the clock only
+ * touches slots that actually hold timers (per-level occupancy bitmaps let
+ * it jump straight over empty ranges).
+ *
+ * Nodes are intrusive: embed a quicpro_tw_node_t in the owning structure
+ * and set `data` to point back at it. The wheel never allocates.
+ */
+
+#ifndef QUICPRO_POLL_TIMER_WHEEL_H
+#define QUICPRO_POLL_TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define QUICPRO_TW_BITS        6
+#define QUICPRO_TW_SLOTS       (1u << QUICPRO_TW_BITS)
+#define QUICPRO_TW_MASK        (QUICPRO_TW_SLOTS - 1)
+#define QUICPRO_TW_LEVELS      4
+#define QUICPRO_TW_NEVER       UINT64_MAX
+
+typedef struct quicpro_tw_node_s {
+    struct quicpro_tw_node_s *next;
+    struct quicpro_tw_node_s *prev;
+    uint64_t                  expires;       /* Absolute tick (ms). */
+    bool                      armed;
+    uint8_t                   level;         /* Slot position while armed. */
+    uint8_t                   slot;
+    void                     *data;          /* Back pointer for the owner. */
+} quicpro_tw_node_t;
+
+typedef struct {
+    uint64_t          now;                   /* Last processed tick. */
+    size_t            count;                 /* Armed timers. */
+    uint64_t          occupied[QUICPRO_TW_LEVELS];
+    quicpro_tw_node_t slots[QUICPRO_TW_LEVELS][QUICPRO_TW_SLOTS]; /* List heads. */
+} quicpro_timer_wheel_t;
+
+/** @brief Fired for every expired node; the node is already disarmed. */
+typedef void (*quicpro_tw_cb)(quicpro_tw_node_t *node, void *ctx);
+
+/** @brief Initialises an empty wheel whose clock starts at `now`. */
+void quicpro_tw_init(quicpro_timer_wheel_t *w, uint64_t now);
+
+/**
+ * @brief Arms (or re-arms) `node` to fire at tick `expires`. Deadlines at or
+ * before the current tick fire on the next advance.
+ */
+void quicpro_tw_schedule(quicpro_timer_wheel_t *w, quicpro_tw_node_t *node, uint64_t expires);
+
+/** @brief Disarms `node`. Safe on nodes that are not armed. */
+void quicpro_tw_cancel(quicpro_timer_wheel_t *w, quicpro_tw_node_t *node);
+
+/**
+ * @brief Earliest tick at which advancing can fire or cascade a timer, or
+ * QUICPRO_TW_NEVER if the wheel is empty. Suitable for arming a timerfd;
+ * for timers on upper levels this is the cascade point, not the exact
+ * deadline, so a wakeup may re-arm without firing anything.
+ */
+uint64_t quicpro_tw_next_expiry(const quicpro_timer_wheel_t *w);
+
+/**
+ * @brief Moves the clock to `now`, invoking `cb` for every timer whose
+ * deadline has passed. Callbacks may schedule or cancel any node.
+ *
+ * @return Number of timers fired.
+ */
+size_t quicpro_tw_advance(quicpro_timer_wheel_t *w, uint64_t now, quicpro_tw_cb cb, void *ctx);
+
+#endif /* QUICPRO_POLL_TIMER_WHEEL_H */
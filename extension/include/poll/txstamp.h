@@ -0,0 +1,122 @@
+/*
+ * include/poll/txstamp.h – Kernel TX timestamp harvesting for php-quicpro_async
+ * =============================================================================
+ *
+ * With SO_TIMESTAMPING the kernel reports when each datagram passed the
+ * qdisc (SCM_TSTAMP_SCHED), left the driver (software SCM_TSTAMP_SND) and,
+ * on capable NICs, hit the wire (hardware SCM_TSTAMP_SND). The reports are
+ * queued on the socket's error queue; left unread they pin socket memory
+ * and keep the descriptor in EPOLLERR.
+ *
+ * - SOF_TIMESTAMPING_OPT_ID tags every sendmsg() (one sendmmsg() entry, one
+ *   GSO super-packet or one io_uring sendmsg) with a counter. The senders
+ *   call quicpro_txstamp_on_send() with the number of messages they issued,
+ *   which records the send time of each id in a small ring.
+ * - quicpro_txstamp_drain() reads the error queue, matches each report to
+ *   its id and feeds latency histograms.
+ * - OPT_TSONLY keeps the kernel from looping the payload back with each
+ *   report, so a report costs a few dozen bytes of socket memory.
+ *
+ * The "NIC RTT" histogram estimates the wire round trip: quiche's smoothed
+ * RTT minus the host-side send delay (sendmsg -> driver) and receive delay
+ * (kernel RX stamp -> userspace), both tracked as moving averages.
+ *
+ * Histograms use power-of-two buckets starting at 1 µs, which keeps
+ * recording branch-free and is precise enough to locate tail latency.
+ */
+
+#ifndef QUICPRO_POLL_TXSTAMP_H
+#define QUICPRO_POLL_TXSTAMP_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "client/session.h"
+
+/* Number of in-flight send ids remembered; must be a power of two. */
+#define QUICPRO_TXSTAMP_RING         1024
+
+/* Bucket i counts samples in [2^(i+9), 2^(i+10)) ns; bucket 0 also < 1 µs. */
+#define QUICPRO_LAT_HIST_BUCKETS     32
+
+/** @brief Log2-bucketed latency histogram (nanoseconds). */
+typedef struct {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint32_t buckets[QUICPRO_LAT_HIST_BUCKETS];
+} quicpro_lat_hist_t;
+
+/**
+ * @brief Per-session TX timestamp state, created by quicpro_txstamp_enable().
+ */
+struct quicpro_txstamp_s {
+    bool                match_ids;     /* OPT_ID accepted; reports carry our ids. */
+    uint32_t            next_id;       /* Id the kernel assigns to the next sendmsg(). */
+    uint64_t            sent_ns[QUICPRO_TXSTAMP_RING]; /* CLOCK_REALTIME at send, by id. */
+    uint32_t            sent_id[QUICPRO_TXSTAMP_RING];
+
+    quicpro_lat_hist_t  sched;         /* sendmsg() -> qdisc. */
+    quicpro_lat_hist_t  send;          /* sendmsg() -> driver (software stamp). */
+    quicpro_lat_hist_t  wire;          /* sendmsg() -> NIC (hardware stamp). */
+    quicpro_lat_hist_t  nic_rtt;       /* quiche RTT minus host delays. */
+
+    uint64_t            tx_delay_ns;   /* EWMA of the `send` samples. */
+    uint64_t            rx_delay_ns;   /* EWMA of kernel RX stamp -> userspace. */
+    struct timespec     seen_rx_ts;    /* Last `last_rx_ts` folded into rx_delay_ns. */
+
+    uint64_t            harvested;     /* Timestamp reports read. */
+    uint64_t            unmatched;     /* Reports whose id fell out of the ring. */
+};
+
+/**
+ * @brief Enables RX and TX timestamping on `s->sock` and allocates the
+ * harvesting state. Idempotent.
+ *
+ * Falls back to id-less timestamping on kernels that reject OPT_ID; the
+ * error queue is then still drained but no TX latencies are recorded.
+ *
+ * @return 0 on success, -1 with errno set if setsockopt() failed.
+ */
+int quicpro_txstamp_enable(quicpro_session_t *s);
+
+/** @brief Releases the state of quicpro_txstamp_enable(). NULL-safe. */
+void quicpro_txstamp_free(quicpro_txstamp_t *t);
+
+/**
+ * @brief Records the send time of `nmsgs` sendmsg() calls just issued on
+ * `s->sock`. A no-op unless timestamping is enabled.
+ */
+void quicpro_txstamp_on_send(quicpro_session_t *s, unsigned nmsgs);
+
+/**
+ * @brief Folds the current `s->last_rx_ts` into the receive-delay average.
+ * Call after delivering a receive batch.
+ */
+void quicpro_txstamp_note_rx(quicpro_session_t *s);
+
+/**
+ * @brief Drains the socket error queue without blocking.
+ *
+ * @return Timestamp reports harvested, or -1 with errno set on a hard error.
+ */
+int quicpro_txstamp_drain(quicpro_session_t *s);
+
+/**
+ * @brief Adds "last_rx_ts_ns" and a "tx_timestamps" sub-array (one entry
+ * per histogram plus counters) to the stats array `arr`.
+ */
+void quicpro_txstamp_add_stats(const quicpro_session_t *s, zval *arr);
+
+/** @brief Adds one sample to `h`. */
+void quicpro_lat_hist_record(quicpro_lat_hist_t *h, uint64_t ns);
+
+/**
+ * @brief Upper bound of the bucket holding quantile `q` (0..1), clamped to
+ * the observed maximum; 0 if `h` is empty.
+ */
+uint64_t quicpro_lat_hist_percentile(const quicpro_lat_hist_t *h, double q);
+
+#endif /* QUICPRO_POLL_TXSTAMP_H */
@@ -0,0 +1,363 @@
+/*
+ * include/poll/udp_batch.h – Batched UDP datagram I/O for php-quicpro_async
+ * ==========================================================================
+ *
+ * Declares the helpers used by the event loops (quicpro_poll() and
+ * quicpro_client_session_tick()) to move many QUIC datagrams across the
+ * user/kernel boundary per system call instead of one.
+ *
+ * Receive side:
+ * - A `quicpro_udp_rx_batch_t` owns N receive slots (payload buffer, source
+ *   address and cmsg space each) wired up as a `struct mmsghdr` vector.
+ * - `quicpro_udp_recv_batch()` fills as many slots as the kernel has packets
+ *   ready with a single recvmmsg(2). On platforms without recvmmsg it
+ *   degrades to a recvmsg(2) loop with identical semantics.
+ * - The batch size is bounded by `quicpro.io_max_batch_read_packets` from the
+ *   bare_metal_tuning config module.
+ *
+ * Per-packet ancillary data (SO_TIMESTAMPING_NEW) is preserved for every
+ * slot, so callers can keep kernel RX timestamps exact.
+ * - Where the kernel supports UDP GRO, the socket opts in and each slot may
+ *   hold a coalesced run of same-flow datagrams. `quicpro_udp_rx_deliver()`
+ *   splits slots at the `UDP_GRO` segment size before quiche_conn_recv().
+ *
+ * Transmit side:
+ * - A `quicpro_udp_tx_batch_t` collects a burst of packets produced by
+ *   quiche_conn_send(), bounded by `quicpro.io_max_batch_write_packets`.
+ * - `quicpro_udp_send_batch()` hands the burst to the kernel with one
+ *   sendmmsg(2). Where the kernel supports UDP GSO (UDP_SEGMENT), runs of
+ *   equally sized packets to the same destination are coalesced into one
+ *   super-buffer that the stack (or NIC) segments after the routing lookup.
+ *
+ * Pacing (quicpro.transport_pacing_enable):
+ * - quiche stamps every packet with its pacing release time
+ *   (`quiche_send_info.at`, CLOCK_MONOTONIC). With SO_TXTIME the time rides
+ *   along as an SCM_TXTIME cmsg and the fq / etf qdisc releases the packet;
+ *   otherwise a userspace pacer holds packets in the batch until due.
+ * - Either way GSO runs are capped at quicpro.transport_pacing_max_burst_packets,
+ *   so one super-packet can never exceed the configured burst.
+ *
+ * Path MTU (quicpro.transport_pmtud_enable):
+ * - quiche probes each path for larger packets (DPLPMTUD, RFC 8899) up to
+ *   quicpro.transport_max_send_udp_payload_size, 8952 bytes on a 9000-byte
+ *   jumbo-frame network. Sockets send with DF set and bypass the kernel's
+ *   PMTU cache (IP_PMTUDISC_PROBE): an oversized probe is lost, not
+ *   fragmented, and quiche settles on the largest size that got through. A
+ *   probe above the egress device's MTU fails with EMSGSIZE and counts as
+ *   lost the same way.
+ * - Transmit slots start at QUICPRO_MAX_PACKET_SIZE and are reallocated, between
+ *   bursts, once the connection has confirmed a larger size. Receive slots
+ *   hold quicpro.transport_max_recv_udp_payload_size, the largest datagram
+ *   the peer is told it may send.
+ *
+ * ECN (quicpro.transport_ecn_enable, quicpro.transport_ecn_mark_ect):
+ * - Sockets ask for the received ECN field (IP_RECVTOS, IPV6_RECVTCLASS)
+ *   as one more per-slot cmsg. quiche_recv_info has no codepoint field,
+ *   so the marks cannot reach quiche's congestion controller; they are
+ *   counted instead, per receive batch and, for CE, per cluster worker.
+ * - Outgoing datagrams carry ECT(0) only with quicpro.transport_ecn_mark_ect.
+ */
+
+#ifndef QUICPRO_POLL_UDP_BATCH_H
+#define QUICPRO_POLL_UDP_BATCH_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <quiche.h>
+
+#include "client/session.h"
+
+/* Hard upper bound for a single batch, regardless of configuration. */
+#define QUICPRO_UDP_BATCH_MAX        1024
+
+/*
+ * Smallest payload size of a receive slot; see quicpro_udp_rx_slot_size().
+ * Datagrams larger than a slot arrive with MSG_TRUNC and are dropped by
+ * the callers, exactly as quiche would reject them.
+ */
+#define QUICPRO_UDP_RX_SLOT_SIZE     2048
+
+/*
+ * With UDP GRO a slot receives up to ~64 KB of coalesced datagrams, so the
+ * slot count is capped to keep the per-session footprint at 512 KB while
+ * still covering several hundred packets per recvmmsg().
+ */
+#define QUICPRO_UDP_GRO_SLOT_SIZE    65535
+#define QUICPRO_UDP_GRO_MAX_SLOTS    8
+
+/* Per-slot ancillary buffer; large enough for timestamping + GRO + TOS cmsgs. */
+#define QUICPRO_UDP_CMSG_SPACE       256
+
+/* Linux caps a single GSO send at 64 segments (UDP_MAX_SEGMENTS). */
+#define QUICPRO_UDP_GSO_MAX_SEGMENTS 64
+
+/* Upper bound for one coalesced GSO payload (IP total length limit). */
+#define QUICPRO_UDP_GSO_MAX_BYTES    65000
+
+/* Pacing modes of a transmit batch. */
+#define QUICPRO_PACE_OFF             0   /* Send immediately (pacing disabled). */
+#define QUICPRO_PACE_TXTIME          1   /* SCM_TXTIME per message, qdisc paces. */
+#define QUICPRO_PACE_USERSPACE       2   /* Hold packets in the batch until due. */
+
+/*
+ * The userspace pacer releases packets due within this horizon, trading a
+ * little burstiness for fewer wakeups (the fq qdisc uses a similar quantum).
+ */
+#define QUICPRO_PACE_HORIZON_NS      250000ull
+
+/* The two ECN bits of the IP TOS / traffic class byte (RFC 3168 §5). */
+#define QUICPRO_ECN_NOT_ECT          0
+#define QUICPRO_ECN_ECT1             1
+#define QUICPRO_ECN_ECT0             2
+#define QUICPRO_ECN_CE               3
+#define QUICPRO_ECN_MASK             3
+
+/* Values of `quicpro_session_t.gso_state`. */
+#define QUICPRO_GSO_UNKNOWN          0
+#define QUICPRO_GSO_SUPPORTED        1
+#define QUICPRO_GSO_UNSUPPORTED     -1
+
+#ifndef __linux__
+/* Minimal stand-in so the batch layout stays identical everywhere. */
+struct mmsghdr {
+    struct msghdr msg_hdr;
+    unsigned int  msg_len;
+};
+#endif
+
+/**
+ * @brief A reusable vector of receive slots for recvmmsg().
+ *
+ * All arrays have `capacity` entries and are allocated in one block
+ * together with the struct. `slot_size` is the payload size of each slot.
+ */
+struct quicpro_udp_rx_batch_s {
+    unsigned                  capacity;
+    size_t                    slot_size;
+    struct mmsghdr           *msgs;
+    struct iovec             *iov;
+    struct sockaddr_storage  *from;
+    char                    (*cmsg)[QUICPRO_UDP_CMSG_SPACE];
+    uint8_t                  *payload;
+    uint64_t                  ecn_rx[4];     /* Datagrams received, by QUICPRO_ECN_* codepoint. */
+};
+
+/**
+ * @brief Allocates a receive batch.
+ *
+ * @param capacity Number of slots, clamped to [1, QUICPRO_UDP_BATCH_MAX].
+ * @param slot_size Payload bytes per slot.
+ * @return The new batch; never NULL (emalloc semantics).
+ */
+quicpro_udp_rx_batch_t *quicpro_udp_rx_batch_new(unsigned capacity, size_t slot_size);
+
+/**
+ * @brief Payload bytes per receive slot for a socket that advertises
+ * `max_recv_udp_payload_size` (0: quicpro.transport_max_recv_udp_payload_size),
+ * never less than QUICPRO_UDP_RX_SLOT_SIZE.
+ */
+size_t quicpro_udp_rx_slot_size(uint64_t max_recv_udp_payload_size);
+
+/**
+ * @brief Switches a UDP socket to DPLPMTUD: DF on every datagram, the
+ * kernel's PMTU cache ignored. No-op with quicpro.transport_pmtud_enable
+ * off or where the platform has no IP_MTU_DISCOVER.
+ */
+void quicpro_udp_socket_pmtud(int fd);
+
+/**
+ * @brief Asks for the ECN field of received datagrams and, with
+ * quicpro.transport_ecn_mark_ect, marks outgoing ones ECT(0). No-op with
+ * quicpro.transport_ecn_enable off.
+ */
+void quicpro_udp_socket_ecn(int fd);
+
+/**
+ * @brief Releases a batch created by quicpro_udp_rx_batch_new(). NULL-safe.
+ */
+void quicpro_udp_rx_batch_free(quicpro_udp_rx_batch_t *b);
+
+/**
+ * @brief Returns the session's receive batch, creating it on first use.
+ *
+ * The capacity is taken from `quicpro.io_max_batch_read_packets`. On first
+ * use the socket also opts into UDP GRO; if the kernel accepts, slots are
+ * sized for coalesced payloads (see QUICPRO_UDP_GRO_SLOT_SIZE).
+ */
+quicpro_udp_rx_batch_t *quicpro_session_rx_batch(quicpro_session_t *s);
+
+/**
+ * @brief Receives up to `b->capacity` datagrams without blocking.
+ *
+ * @param fd A non-blocking UDP socket.
+ * @param b The batch to fill. Slot i is valid for i < return value.
+ * @return Number of datagrams received, 0 if none were pending
+ * (EAGAIN/EWOULDBLOCK), or -1 on error with errno set.
+ */
+int quicpro_udp_recv_batch(int fd, quicpro_udp_rx_batch_t *b);
+
+/** @brief Payload pointer of slot `i`. */
+static inline uint8_t *quicpro_udp_rx_slot_data(quicpro_udp_rx_batch_t *b, unsigned i)
+{
+    return b->payload + (size_t)i * b->slot_size;
+}
+
+/** @brief True if the datagram in slot `i` did not fit into its slot. */
+static inline bool quicpro_udp_rx_slot_truncated(const quicpro_udp_rx_batch_t *b, unsigned i)
+{
+    return (b->msgs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+}
+
+/** @brief Number of payload bytes the kernel wrote into slot `i`. */
+static inline size_t quicpro_udp_rx_slot_len(const quicpro_udp_rx_batch_t *b, unsigned i)
+{
+    return b->msgs[i].msg_len;
+}
+
+/**
+ * @brief Segment size of slot `i`: the `UDP_GRO` cmsg value if the kernel
+ * coalesced the slot, otherwise the slot length (a single datagram).
+ */
+size_t quicpro_udp_rx_slot_segment_size(quicpro_udp_rx_batch_t *b, unsigned i);
+
+/**
+ * @brief Feeds `n` received slots into quiche, one datagram at a time.
+ *
+ * Coalesced GRO slots are split at their segment size; truncated slots are
+ * skipped. The RX timestamp of the newest slot carrying one is stored in
+ * `last_rx_ts` (if non-NULL).
+ *
+ * @param last_error Receives the last quiche error other than
+ * QUICHE_ERR_DONE, or 0 if every datagram was accepted. May be NULL.
+ * @return Number of datagrams handed to quiche_conn_recv().
+ */
+int quicpro_udp_rx_deliver(quiche_conn *conn, quicpro_udp_rx_batch_t *b, int n,
+                           struct timespec *last_rx_ts, ssize_t *last_error);
+
+/**
+ * @brief Extracts the SO_TIMESTAMPING_NEW software/hardware stamp of a slot.
+ *
+ * @return true if a timestamp cmsg was present and `out` was written.
+ */
+bool quicpro_udp_rx_slot_timestamp(quicpro_udp_rx_batch_t *b, unsigned i, struct timespec *out);
+
+/**
+ * @brief The ECN codepoint (QUICPRO_ECN_*) slot `i` arrived with;
+ * QUICPRO_ECN_NOT_ECT if the socket does not report one.
+ */
+unsigned quicpro_udp_rx_slot_ecn(quicpro_udp_rx_batch_t *b, unsigned i);
+
+/** @brief The ECN codepoint in an IP_TOS / IPV6_TCLASS cmsg; -1 for any other cmsg. */
+int quicpro_udp_cmsg_ecn(const struct cmsghdr *cm);
+
+/**
+ * @brief Per-datagram callback of quicpro_udp_drain(); same shape as the
+ * io_uring engine's quicpro_uring_rx_cb so listeners can share one handler.
+ *
+ * @param rx_ts Kernel RX timestamp, or NULL if none was attached.
+ */
+typedef void (*quicpro_udp_dgram_cb)(void *ctx, uint8_t *data, size_t len,
+                                     const struct sockaddr *from, socklen_t from_len,
+                                     const struct timespec *rx_ts);
+
+/**
+ * @brief Drains a listener socket until EAGAIN or `budget` datagrams.
+ *
+ * Reads with quicpro_udp_recv_batch() and, within each batch, hands the
+ * datagrams to `cb` grouped by destination connection ID (arrival order is
+ * kept inside a group), so every connection's packets reach quiche back to
+ * back. Short headers are assumed to carry a QUICHE_MAX_CONN_ID_LEN DCID,
+ * which is what the servers issue.
+ *
+ * @return Datagrams delivered, or -1 with errno set if the first read failed.
+ */
+int quicpro_udp_drain(int fd, quicpro_udp_rx_batch_t *b, unsigned budget,
+                      quicpro_udp_dgram_cb cb, void *ctx);
+
+/**
+ * @brief A reusable burst of outbound packets for sendmmsg().
+ *
+ * `count` packets are staged in `payload` (one `slot_size` slot each) with
+ * their destination and pacing release time. `msgs`, `iov` and `cmsg` are
+ * scratch space for building the (possibly GSO-coalesced) message vector at
+ * send time. In QUICPRO_PACE_USERSPACE mode packets that are not yet due
+ * stay staged across sends.
+ */
+struct quicpro_udp_tx_batch_s {
+    unsigned                  capacity;
+    size_t                    slot_size;
+    unsigned                  count;
+    uint8_t                  *payload;
+    size_t                   *len;
+    struct sockaddr_storage  *to;
+    socklen_t                *to_len;
+    uint64_t                 *at_ns;         /* Release time (CLOCK_MONOTONIC), 0 = now. */
+    struct mmsghdr           *msgs;
+    struct iovec             *iov;
+    char                    (*cmsg)[QUICPRO_UDP_CMSG_SPACE];
+    unsigned                  last_msgs;     /* sendmsg() entries the kernel took last send. */
+    int                       pacing;        /* QUICPRO_PACE_*. */
+    unsigned                  max_burst;     /* GSO run cap while pacing. */
+};
+
+/** @brief Allocates a transmit batch; see quicpro_udp_rx_batch_new(). */
+quicpro_udp_tx_batch_t *quicpro_udp_tx_batch_new(unsigned capacity, size_t slot_size);
+
+/** @brief Releases a transmit batch. NULL-safe. */
+void quicpro_udp_tx_batch_free(quicpro_udp_tx_batch_t *b);
+
+/**
+ * @brief Returns the session's transmit batch, creating it on first use.
+ *
+ * The capacity is taken from `quicpro.io_max_batch_write_packets`. While
+ * no packet is staged, a batch whose slots are smaller than the
+ * connection's current maximum packet size (it grows as the path MTU is
+ * discovered) is replaced by one that fits. On first use the socket is also probed for UDP GSO support (`s->gso_state`) and,
+ * with pacing enabled, switched to SO_TXTIME (falling back to the userspace
+ * pacer if the kernel refuses or `quicpro.socket_enable_txtime` is off).
+ */
+quicpro_udp_tx_batch_t *quicpro_session_tx_batch(quicpro_session_t *s);
+
+/**
+ * @brief Pulls packets from quiche into the batch until it is full or
+ * quiche has nothing more to send.
+ *
+ * @return Number of staged packets (0 if quiche is done), or a negative
+ * quiche error code other than QUICHE_ERR_DONE.
+ */
+int quicpro_udp_tx_batch_fill(quiche_conn *conn, quicpro_udp_tx_batch_t *b);
+
+/**
+ * @brief Transmits every staged packet that is due and drops it from the batch.
+ *
+ * Uses one sendmmsg() for the whole burst (sendto() loop on non-Linux
+ * builds). If `*gso_state` is QUICPRO_GSO_SUPPORTED, same-destination runs
+ * are coalesced with UDP_SEGMENT; should the kernel reject GSO at send time
+ * (EIO, e.g. no checksum offload on the egress device), GSO is switched off
+ * for the socket and the burst is resent unsegmented.
+ *
+ * `b->last_msgs` is set to the number of messages the kernel accepted (one
+ * per GSO run), which is what SOF_TIMESTAMPING_OPT_ID counts. With the
+ * userspace pacer, packets due later than QUICPRO_PACE_HORIZON_NS stay
+ * staged; see quicpro_udp_tx_pacing_delay_ns().
+ *
+ * @return Number of packets handed to the kernel. Packets left over when the
+ * socket buffer fills (EAGAIN) are dropped and recovered by QUIC loss
+ * detection. Returns -1 with errno set on hard errors.
+ */
+int quicpro_udp_send_batch(int fd, quicpro_udp_tx_batch_t *b, int *gso_state);
+
+/**
+ * @brief Nanoseconds until the userspace pacer wants to send again, 0 if a
+ * packet is already due, UINT64_MAX if nothing is held. NULL-safe.
+ *
+ * Event loops fold this into their wait deadline next to quiche's timeout.
+ */
+uint64_t quicpro_udp_tx_pacing_delay_ns(const quicpro_udp_tx_batch_t *b);
+
+#endif /* QUICPRO_POLL_UDP_BATCH_H */
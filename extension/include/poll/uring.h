@@ -0,0 +1,112 @@
+/*
+ * include/poll/uring.h – io_uring UDP engine for php-quicpro_async
+ * =================================================================
+ *
+ * Declares the io_uring backend that replaces epoll + recvmsg()/sendmmsg()
+ * when `quicpro.io_engine_use_uring` is enabled and the extension was built
+ * against liburing (QUICPRO_HAVE_LIBURING).
+ *
+ * Design:
+ * - One ring per UDP socket. The socket is registered as a fixed file.
+ * - Receive: a single multishot IORING_OP_RECVMSG stays armed on the socket
+ *   and completes into a kernel-registered provided-buffer ring, so steady
+ *   state receive needs neither a syscall nor a per-packet SQE.
+ * - Transmit: quiche_conn_send() writes straight into a pool of TX slots
+ *   owned by the ring; each slot becomes one IORING_OP_SENDMSG SQE and is
+ *   recycled when its CQE is reaped.
+ * - With `quicpro.io_uring_sq_poll_ms` > 0 the ring uses IORING_SETUP_SQPOLL,
+ *   so a kernel thread picks up submissions without io_uring_enter().
+ *
+ * Builds without liburing get stubs that report the engine as unavailable;
+ * callers then stay on the batched socket path in poll/udp_batch.h.
+ */
+
+#ifndef QUICPRO_POLL_URING_H
+#define QUICPRO_POLL_URING_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <quiche.h>
+
+#include "client/session.h"
+
+/**
+ * @brief Callback invoked for every datagram reaped from the ring.
+ *
+ * GRO-coalesced completions are split before the callback runs, so `data`
+ * always holds exactly one UDP datagram.
+ *
+ * @param ctx Opaque pointer passed to quicpro_uring_reap().
+ * @param rx_ts Kernel RX timestamp, or NULL if none was attached.
+ */
+typedef void (*quicpro_uring_rx_cb)(void *ctx, uint8_t *data, size_t len,
+                                    const struct sockaddr *from, socklen_t from_len,
+                                    const struct timespec *rx_ts);
+
+/**
+ * @brief Creates an io_uring engine bound to `fd`.
+ *
+ * Ring depth and slot counts follow `quicpro.io_max_batch_read_packets` /
+ * `quicpro.io_max_batch_write_packets`; SQPOLL follows
+ * `quicpro.io_uring_sq_poll_ms` and silently degrades to a regular ring
+ * when the kernel refuses it.
+ *
+ * @return The engine, or NULL if io_uring is unavailable (not compiled in,
+ * ENOSYS, seccomp, missing multishot support, ...).
+ */
+quicpro_uring_t *quicpro_uring_new(int fd);
+
+/** @brief Tears down the ring and all registered buffers. NULL-safe. */
+void quicpro_uring_free(quicpro_uring_t *u);
+
+/**
+ * @brief Returns the session's engine, creating it on first use.
+ *
+ * Returns NULL when `quicpro.io_engine_use_uring` is off or the engine
+ * could not be created; the failure is remembered per session so the
+ * setup cost is paid at most once.
+ */
+quicpro_uring_t *quicpro_session_uring(quicpro_session_t *s);
+
+/**
+ * @brief Reaps all available completions without blocking.
+ *
+ * RX completions are passed to `cb`, TX completions recycle their slots and
+ * the multishot receive is re-armed if the kernel terminated it.
+ *
+ * @return Number of datagrams delivered to `cb`, or -1 with errno set.
+ */
+int quicpro_uring_reap(quicpro_uring_t *u, quicpro_uring_rx_cb cb, void *ctx);
+
+/**
+ * @brief Blocks until at least one completion is available or `timeout_ms`
+ * elapses. Returns 0 on completion or timeout, -1 with errno on error.
+ */
+int quicpro_uring_wait(quicpro_uring_t *u, int timeout_ms);
+
+/**
+ * @brief Queues everything quiche wants to send on `conn` and submits it.
+ *
+ * @return Number of packets queued, or a negative quiche error code.
+ * Packets that do not fit into free TX slots stay inside quiche until the
+ * next call.
+ */
+int quicpro_uring_flush_quiche(quicpro_uring_t *u, quiche_conn *conn);
+
+/**
+ * @brief Returns the ring's file descriptor, which polls readable while
+ * completions are pending, so a reactor can wait on it with epoll. -1 when
+ * compiled without liburing.
+ */
+int quicpro_uring_fd(quicpro_uring_t *u);
+
+/**
+ * @brief Convenience receive path for a single client session: reaps the
+ * ring into `s->conn` and keeps `s->last_rx_ts` current.
+ */
+int quicpro_uring_session_recv(quicpro_session_t *s);
+
+#endif /* QUICPRO_POLL_URING_H */
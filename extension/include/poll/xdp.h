@@ -0,0 +1,96 @@
+/*
+ * include/poll/xdp.h – AF_XDP kernel-bypass engine for php-quicpro_async
+ * =======================================================================
+ *
+ * Declares the AF_XDP (XSK) fast path used by quicpro_poll() when the
+ * extension is built with QUICPRO_XDP and `quicpro.io_xdp_interface` names
+ * a NIC.
+ *
+ * Model:
+ * - One XSK socket per process, bound to a single NIC queue. Inside a
+ *   Quicpro\Cluster worker the queue defaults to `worker_id % channels`, so
+ *   every worker owns exactly one RX/TX queue pair and no two processes
+ *   contend for a ring. `quicpro.io_xdp_queue_id` pins it explicitly.
+ * - The umem is split into fixed frames. Free frames live on a stack; RX
+ *   frames go back to the fill ring as soon as quiche has consumed them,
+ *   TX frames come back through the completion ring.
+ * - Received frames are parsed (Ethernet / IPv4 / IPv6 / UDP) to recover
+ *   the real source address and are demultiplexed to sessions by local
+ *   UDP port.
+ * - Transmit is zero-copy: quiche_conn_send() writes the QUIC payload
+ *   directly behind pre-built Ethernet/IP/UDP headers inside a umem frame.
+ *   The L2 header is learned from the session's most recent inbound frame.
+ *
+ * The XDP program that redirects the NIC queue into the XSK map is loaded
+ * by libxdp's default dispatcher unless one is already attached.
+ *
+ * Builds without QUICPRO_XDP get stubs that report the engine as absent.
+ */
+
+#ifndef QUICPRO_POLL_XDP_H
+#define QUICPRO_POLL_XDP_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "client/session.h"
+
+/* Bytes reserved in front of every TX payload for Ethernet + IPv6 + UDP. */
+#define QUICPRO_XDP_TX_HEADROOM   (14 + 40 + 8)
+
+/**
+ * @brief Records the cluster worker id so the engine can pick its NIC
+ * queue (`worker_id % channels`). Called by the cluster supervisor in each
+ * forked worker before userland code runs.
+ */
+void quicpro_xdp_bind_worker(int worker_id);
+
+/**
+ * @brief Returns true if this process has a usable XSK socket, opening it on
+ * first call according to the `quicpro.io_xdp_*` settings.
+ */
+bool quicpro_xdp_available(void);
+
+/**
+ * @brief Registers a session for demultiplexing by its local UDP port.
+ * Idempotent; a no-op if the engine is unavailable.
+ */
+void quicpro_xdp_attach(quicpro_session_t *s);
+
+/** @brief Removes a session from the demux table and frees its XDP path state. */
+void quicpro_xdp_detach(quicpro_session_t *s);
+
+/** @brief Callback invoked after a datagram was handed to `s->conn`. */
+typedef void (*quicpro_xdp_rx_cb)(void *ctx, quicpro_session_t *s);
+
+/**
+ * @brief Drains the RX ring, dispatching each datagram to its session.
+ *
+ * Packets for other attached sessions are delivered to their connections
+ * as well; they make progress on their next poll. Consumed frames are
+ * returned to the fill ring before this function returns.
+ *
+ * @param on_rx Optional per-datagram notification (e.g. for the reactor to
+ * mark the session active); may be NULL.
+ * @return Number of datagrams handed to quiche.
+ */
+int quicpro_xdp_drain(quicpro_xdp_rx_cb on_rx, void *ctx);
+
+/** @brief File descriptor of the XSK socket for epoll, or -1 if absent. */
+int quicpro_xdp_fd(void);
+
+/**
+ * @brief Sends everything quiche has queued for `s` through the TX ring.
+ *
+ * @return Number of packets queued (0 if nothing was pending or the TX ring
+ * is full; quiche keeps the rest), or -1 if the engine is absent or the
+ * session's L2 path is not known yet (no inbound frame seen); the caller
+ * then uses the kernel socket for this round.
+ */
+int quicpro_xdp_flush_session(quicpro_session_t *s);
+
+/** @brief Releases the process-wide XSK socket and umem (MSHUTDOWN). */
+void quicpro_xdp_shutdown(void);
+
+#endif /* QUICPRO_POLL_XDP_H */
@@ -0,0 +1,47 @@
+/*
+ * include/semantic_geometry/geometry.h – Quicpro\Geometry\Matrix
+ * ==============================================================
+ *
+ * A matrix of float32 rows, contiguous and row-major, for the geometry of
+ * embedding spaces: one row per vector.
+ *
+ *     $routes = Quicpro\Geometry\Matrix::fromBytes($embeddings);   // dims: quicpro.geometry_default_vector_dimensions
+ *     $query  = Quicpro\Geometry\Matrix::fromArray([$embedding]);
+ *
+ *     $query->nearest($routes, 3);           // [[17 => 0.93, 4 => 0.88, 30 => 0.71]]
+ *     $query->scores($routes, 'l2');         // a 1 × n Matrix
+ *     $routes->hausdorff($other);            // float
+ *
+ *     $region = $points2d->convexHull();     // its vertices, counter-clockwise
+ *     $region->contains($points2d);          // [true, false, ...]
+ *
+ * Similarity is "cosine", "dot" or "l2" (semantic_geometry/kernels.h);
+ * hull, containment and Hausdorff algorithms default to the
+ * quicpro.geometry_* settings and are described in
+ * semantic_geometry/polytope.h. Matrices are immutable.
+ */
+
+#ifndef QUICPRO_SEMANTIC_GEOMETRY_GEOMETRY_H
+#define QUICPRO_SEMANTIC_GEOMETRY_GEOMETRY_H
+
+#include <php.h>
+#include <stdint.h>
+
+typedef struct {
+    float      *data;
+    int64_t     rows;
+    size_t      dims;
+    zend_object std;
+} quicpro_geometry_matrix_object;
+
+extern zend_class_entry *quicpro_ce_geometry_matrix;
+
+static inline quicpro_geometry_matrix_object *quicpro_geometry_matrix_from_obj(zend_object *obj)
+{
+    return (quicpro_geometry_matrix_object *)((char *)obj - XtOffsetOf(quicpro_geometry_matrix_object, std));
+}
+
+/** @brief Registers Quicpro\Geometry\Matrix (MINIT). */
+void quicpro_geometry_minit(void);
+
+#endif /* QUICPRO_SEMANTIC_GEOMETRY_GEOMETRY_H */
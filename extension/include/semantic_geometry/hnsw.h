@@ -0,0 +1,92 @@
+/*
+ * include/semantic_geometry/hnsw.h – Approximate nearest neighbours
+ * =================================================================
+ *
+ * A hierarchical navigable small world graph (Malkov and Yashunin) over
+ * the pair kernels of semantic_geometry/kernels.h: each vector is linked
+ * to its m nearest neighbours found so far (2 m on the bottom layer), on
+ * its own layer and every layer below it, and a search descends greedily
+ * from the top entry, widening to `ef` candidates on the bottom layer.
+ *
+ * Vectors are stored as float32, or as int8 with one scale per vector
+ * (value / scale rounded, scale = max |value| / 127): a quarter of the
+ * memory, with the query kept float32 and each stored value widened in
+ * the SIMD lanes. For cosine vectors are normalised once going in, so
+ * cosine and dot both walk the graph by dot product.
+ *
+ * Inserts and searches may run at the same time, from the morsel pool or
+ * from several threads: every node's links have their own spin lock, and
+ * the entry point is one atomic word. Only growing the arrays (add() past
+ * their capacity, on the calling thread) waits for every search to end.
+ *
+ * save() writes the index as one file of fixed sections that load() maps
+ * (MAP_PRIVATE) and uses in place, with nothing rebuilt: loading takes as
+ * long as the mmap. A loaded index is searched from the page cache, and
+ * copied to the heap by the first add() that needs room.
+ */
+
+#ifndef QUICPRO_SEMANTIC_GEOMETRY_HNSW_H
+#define QUICPRO_SEMANTIC_GEOMETRY_HNSW_H
+
+#include "semantic_geometry/kernels.h"
+#include <zend_smart_str.h>
+
+typedef enum {
+    QUICPRO_HNSW_FLOAT32,
+    QUICPRO_HNSW_INT8,
+} quicpro_hnsw_storage_t;
+
+typedef struct {
+    size_t                 dims;
+    quicpro_geo_metric_t   metric;
+    quicpro_hnsw_storage_t storage;
+    uint32_t               m;                   /* Links per node and layer; 2 m on layer 0 */
+    uint32_t               ef_construction;     /* Candidates kept while linking an insert */
+    uint32_t               ef_search;           /* ... while searching, unless the search asks */
+} quicpro_hnsw_params_t;
+
+/* An index; shared by reference, freed with its last reference */
+typedef struct quicpro_hnsw_s quicpro_hnsw_t;
+
+quicpro_hnsw_t *quicpro_hnsw_new(const quicpro_hnsw_params_t *params);
+
+/** @brief Maps an index written by save(); NULL with the reason in `err`. */
+quicpro_hnsw_t *quicpro_hnsw_load(const char *path, char *err, size_t err_len);
+
+/** @brief Writes the index next to `path` and renames it there, so that a loader sees either file whole. */
+bool quicpro_hnsw_save(quicpro_hnsw_t *h, const char *path, char *err, size_t err_len);
+
+void quicpro_hnsw_retain(quicpro_hnsw_t *h);
+void quicpro_hnsw_release(quicpro_hnsw_t *h);
+
+const quicpro_hnsw_params_t *quicpro_hnsw_params(const quicpro_hnsw_t *h);
+int64_t quicpro_hnsw_count(const quicpro_hnsw_t *h);
+bool quicpro_hnsw_has_documents(const quicpro_hnsw_t *h);
+
+/**
+ * @brief Inserts the `n` rows of `vectors` (params->dims each), linked in
+ * parallel on the morsel pool. labels[i] is what searches return for row
+ * i (NULL: its position in the index); docs[i] of doc_lens[i] bytes is
+ * kept with it (NULL: none). Searches running meanwhile see each row once
+ * it is linked.
+ */
+void quicpro_hnsw_add(quicpro_hnsw_t *h, const float *vectors, int64_t n, const int64_t *labels,
+                      const char *const *docs, const size_t *doc_lens);
+
+/**
+ * @brief The `k` nearest nodes to each of the `n` rows of `queries`, best
+ * first, searched with `ef` candidates (0: params->ef_search; at least k),
+ * in parallel on the morsel pool. Each query fills k entries of `nodes`
+ * and `scores`: cosine and dot similarity, l2 distance; a node of -1 when
+ * the index has fewer than k.
+ */
+void quicpro_hnsw_search(quicpro_hnsw_t *h, const float *queries, int64_t n, uint32_t k, uint32_t ef,
+                         int64_t *nodes, float *scores);
+
+/** @brief The label of `node`, as add() was given it. */
+int64_t quicpro_hnsw_label(quicpro_hnsw_t *h, int64_t node);
+
+/** @brief Appends the document kept with `node`, if any, to `into`. */
+void quicpro_hnsw_document(quicpro_hnsw_t *h, int64_t node, smart_str *into);
+
+#endif /* QUICPRO_SEMANTIC_GEOMETRY_HNSW_H */
@@ -0,0 +1,48 @@
+/*
+ * include/semantic_geometry/index.h – Quicpro\Geometry\Index
+ * ==========================================================
+ *
+ * An approximate nearest-neighbour index (semantic_geometry/hnsw.h) for
+ * retrieval without a network hop:
+ *
+ *     $index = new Quicpro\Geometry\Index(768, ['metric' => 'cosine', 'storage' => 'int8']);
+ *     $index->add($embeddings, $ids, $passages);       // Matrix, ?list<int>, ?list<string>
+ *     $index->search($query, 5);                        // [[42 => 0.91, 7 => 0.88, ...]]
+ *     $index->save('/var/lib/rag/docs.hnsw');
+ *
+ *     $index = Quicpro\Geometry\Index::load('/var/lib/rag/docs.hnsw');   // mapped, not read
+ *     $index->share('docs');
+ *
+ * Options: metric "cosine" (default), "dot" or "l2"; storage "float32"
+ * (default) or "int8"; m (16), ef_construction (200), ef_search (64).
+ *
+ * share() makes the index known to the process by name, for the pipeline
+ * orchestrator: a tool handler whose rag_config has 'local_index' =>
+ * 'docs' retrieves its RAG context from it (quicpro_geometry_index_retrieve())
+ * instead of calling a RAG agent. An index may be shared, searched and
+ * added to by any number of requests at once.
+ */
+
+#ifndef QUICPRO_SEMANTIC_GEOMETRY_INDEX_H
+#define QUICPRO_SEMANTIC_GEOMETRY_INDEX_H
+
+#include <php.h>
+#include <stdbool.h>
+
+extern zend_class_entry *quicpro_ce_geometry_index;
+
+/**
+ * @brief Searches the index shared as `name` for the `k` nearest to
+ * `query` (a Matrix, its first row, or a list of numbers). `out`: their
+ * documents, nearest first, separated by blank lines; for an index
+ * without documents, [label => score]. False with an exception thrown.
+ */
+bool quicpro_geometry_index_retrieve(const char *name, size_t name_len, zval *query, zend_long k, zval *out);
+
+/** @brief Registers Quicpro\Geometry\Index (MINIT). */
+void quicpro_geometry_index_minit(void);
+
+/** @brief Releases the shared indexes (MSHUTDOWN). */
+void quicpro_geometry_index_mshutdown(void);
+
+#endif /* QUICPRO_SEMANTIC_GEOMETRY_INDEX_H */
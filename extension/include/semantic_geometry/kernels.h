@@ -0,0 +1,72 @@
+/*
+ * include/semantic_geometry/kernels.h – Vector similarity over float32 matrices
+ * ============================================================================
+ *
+ * The kernels behind Quicpro\Geometry\Matrix (semantic_geometry/geometry.h):
+ * every row of one matrix against every row of another, over contiguous
+ * row-major float32 data. Dot products and squared distances run in
+ * AVX-512, AVX2 (with FMA where the build allows) or NEON lanes, whichever
+ * the build targets, scalar elsewhere. With
+ * quicpro.geometry_calculation_precision "float64" (`wide`), the lanes
+ * widen each float32 to a double before accumulating, at half the
+ * throughput, for long vectors whose sums lose digits in float32.
+ *
+ * Work is split into blocks of the larger matrix's rows and run on the
+ * DataFrame morsel pool (dataframe/morsel.h). Scratch is allocated on the
+ * calling thread, so these are called from PHP methods, not kernels.
+ */
+
+#ifndef QUICPRO_SEMANTIC_GEOMETRY_KERNELS_H
+#define QUICPRO_SEMANTIC_GEOMETRY_KERNELS_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* A matrix's rows as the kernels see them */
+typedef struct {
+    const float *data;
+    int64_t      rows;
+    size_t       dims;
+} quicpro_geo_matrix_t;
+
+typedef enum {
+    QUICPRO_GEO_COSINE,                 /* Similarity: 1 for the same direction; 0 against a zero vector */
+    QUICPRO_GEO_DOT,                    /* Similarity */
+    QUICPRO_GEO_L2,                     /* Euclidean distance */
+} quicpro_geo_metric_t;
+
+/** @brief Parses "cosine", "dot" or "l2". */
+bool quicpro_geo_metric_parse(const zend_string *name, quicpro_geo_metric_t *out);
+
+/** @brief out[i * c->rows + j] = metric(row i of q, row j of c). Both have the same dims. */
+void quicpro_geo_scores(const quicpro_geo_matrix_t *q, const quicpro_geo_matrix_t *c, quicpro_geo_metric_t metric,
+                        bool wide, float *out);
+
+/**
+ * @brief The `k` (at most c->rows) rows of `c` nearest each row of `q`,
+ * best first: highest cosine or dot, lowest l2. idx and score hold
+ * q->rows * k entries.
+ */
+void quicpro_geo_nearest(const quicpro_geo_matrix_t *q, const quicpro_geo_matrix_t *c, quicpro_geo_metric_t metric,
+                         bool wide, uint32_t k, int64_t *idx, float *score);
+
+/**
+ * @brief The Hausdorff distance between the row sets `a` and `b` (neither
+ * empty). `sample` 0: exact; otherwise from at most `sample` evenly spaced
+ * rows of each to all rows of the other, a lower bound of the exact one.
+ */
+double quicpro_geo_hausdorff(const quicpro_geo_matrix_t *a, const quicpro_geo_matrix_t *b, bool wide, int64_t sample);
+
+/*
+ * One pair of vectors, for graph walks that pick their rows one at a time
+ * (semantic_geometry/hnsw.h). The int8 forms take `b` quantised, each
+ * value standing for value * scale; dot_i8() leaves the scale to the caller.
+ */
+float quicpro_geo_dot_f32(const float *a, const float *b, size_t dims);
+float quicpro_geo_sq_f32(const float *a, const float *b, size_t dims);
+float quicpro_geo_dot_i8(const float *a, const int8_t *b, size_t dims);
+float quicpro_geo_sq_i8(const float *a, const int8_t *b, float scale, size_t dims);
+
+#endif /* QUICPRO_SEMANTIC_GEOMETRY_KERNELS_H */
@@ -0,0 +1,59 @@
+/*
+ * include/semantic_geometry/polytope.h – Convex hulls and containment
+ * ===================================================================
+ *
+ * The polytope side of Quicpro\Geometry\Matrix, over the same row-major
+ * float32 rows as the similarity kernels (semantic_geometry/kernels.h),
+ * in double arithmetic. Hulls are of points in the plane, by
+ * quicpro.geometry_convex_hull_algorithm:
+ *
+ *   "qhull"          quickhull, O(n log n) expected
+ *   "gift_wrapping"  Jarvis march, O(n h) for h hull vertices: the faster
+ *                    of the two for the few vertices of most point clouds
+ *
+ * Containment, by quicpro.geometry_point_in_polytope_algorithm:
+ *
+ *   "ray_casting"    even-odd crossings of a polygon, convex or not (2D)
+ *   "barycentric"    a convex polygon as a fan of triangles (2D), or a
+ *                    simplex of dims + 1 vertices in any dimension
+ *
+ * Points on the boundary count as inside for "barycentric"; for
+ * "ray_casting" they fall on either side.
+ */
+
+#ifndef QUICPRO_SEMANTIC_GEOMETRY_POLYTOPE_H
+#define QUICPRO_SEMANTIC_GEOMETRY_POLYTOPE_H
+
+#include "semantic_geometry/kernels.h"
+
+typedef enum {
+    QUICPRO_GEO_QHULL,
+    QUICPRO_GEO_GIFT_WRAPPING,
+} quicpro_geo_hull_t;
+
+typedef enum {
+    QUICPRO_GEO_RAY_CASTING,
+    QUICPRO_GEO_BARYCENTRIC,
+} quicpro_geo_containment_t;
+
+bool quicpro_geo_hull_parse(const char *name, size_t len, quicpro_geo_hull_t *out);
+bool quicpro_geo_containment_parse(const char *name, size_t len, quicpro_geo_containment_t *out);
+
+/**
+ * @brief The hull of the 2D rows of `points` (not empty): their indices,
+ * counter-clockwise from the leftmost, into `out` (room for points->rows);
+ * their count. Points on an edge are not vertices.
+ */
+int64_t quicpro_geo_hull(const quicpro_geo_matrix_t *points, quicpro_geo_hull_t algo, int64_t *out);
+
+/**
+ * @brief Whether `poly` (its rows the vertices, in order for a polygon)
+ * has the shape `algo` takes, as described above.
+ */
+bool quicpro_geo_containment_fits(const quicpro_geo_matrix_t *poly, quicpro_geo_containment_t algo);
+
+/** @brief in[i]: row i of `points` lies in `poly`, which fits `algo`. Runs on the morsel pool. */
+void quicpro_geo_contains(const quicpro_geo_matrix_t *poly, const quicpro_geo_matrix_t *points,
+                          quicpro_geo_containment_t algo, bool *in);
+
+#endif /* QUICPRO_SEMANTIC_GEOMETRY_POLYTOPE_H */
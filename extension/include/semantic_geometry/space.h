@@ -0,0 +1,41 @@
+/*
+ * include/semantic_geometry/space.h – Quicpro\Geometry\Space
+ * ==========================================================
+ *
+ * A semantic space (semantic_geometry/spiral.h): concepts found by spiral
+ * search, with the ones queries keep resonating with consolidated into a
+ * core that answers first.
+ *
+ *     $space = new Quicpro\Geometry\Space(768);         // ?dims, options
+ *     $space->add($embeddings, $ids);                    // Matrix, ?list<int>: rows added
+ *     $space->search($queries, 5);                       // [[42 => 0.97, 7 => 0.93, ...], ...]
+ *     $space->save('/var/lib/dns/semantic.qps');
+ *     $space = Quicpro\Geometry\Space::load('/var/lib/dns/semantic.qps');
+ *
+ * Options: step (quicpro.geometry_spiral_search_step_size), threshold
+ * (quicpro.geometry_core_consolidation_threshold) and cell_radius (4 ×
+ * step). search() consolidates unless its third argument is false.
+ *
+ * Syncing with a Smart DNS mothernode (quicpro.dns_mothernode_uri) every
+ * quicpro.dns_mothernode_sync_interval_sec sends what changed, not the
+ * space: delta($since) returns ['version' => int, 'delta' => string] of
+ * the points added or promoted after version $since, and the receiving
+ * side merges it with applyDelta(); the next sync passes the version the
+ * last one returned. share() and shared() make a space known to the
+ * process by name, so that the DNS worker and the sync job use one copy.
+ */
+
+#ifndef QUICPRO_SEMANTIC_GEOMETRY_SPACE_H
+#define QUICPRO_SEMANTIC_GEOMETRY_SPACE_H
+
+#include <php.h>
+
+extern zend_class_entry *quicpro_ce_geometry_space;
+
+/** @brief Registers Quicpro\Geometry\Space (MINIT). */
+void quicpro_geometry_space_minit(void);
+
+/** @brief Releases the shared spaces (MSHUTDOWN). */
+void quicpro_geometry_space_mshutdown(void);
+
+#endif /* QUICPRO_SEMANTIC_GEOMETRY_SPACE_H */
@@ -0,0 +1,99 @@
+/*
+ * include/semantic_geometry/spiral.h – Spiral search over a semantic space
+ * ========================================================================
+ *
+ * A set of concepts (unit vectors, compared by cosine) that answers
+ * nearest-concept queries by spiralling outwards from the query, and that
+ * consolidates the concepts queries keep landing on into a core.
+ *
+ * Points are grouped into cells as they arrive: a point joins the nearest
+ * cell whose anchor (its first point) lies within `cell_radius`, or starts
+ * a new one; once there are 4 sqrt(count) cells, it joins the nearest
+ * regardless, and that cell's radius grows to cover it. Nothing is ever
+ * rebuilt, so adding points costs one pass over the anchors each.
+ *
+ * A search visits the cells in rings, `step` wide, of the least distance
+ * any of their points can have from the query (anchor distance less the
+ * cell's radius). After each ring it stops if the k-th best found is
+ * nearer than the next ring can be, so the answer is exact and a query
+ * near dense concepts ends after a ring or two. The core is searched
+ * first: when its k best are all at least `threshold` similar, they are
+ * the answer and no cell is visited.
+ *
+ * Every point also carries a resonance, a running average (weight 1/8) of
+ * the similarity of the queries it answered; a point whose resonance
+ * reaches `threshold` moves to the core. Adding a point or promoting one
+ * stamps it with the next version, so delta() can hand another node
+ * everything changed since a version it saw, and apply_delta() can merge
+ * such a delta without touching the rest.
+ *
+ * save() writes one file of fixed sections that load() maps (MAP_PRIVATE)
+ * and searches in place; the first change that needs room copies the
+ * affected sections to the heap. Searches run in parallel, with each
+ * other and on the morsel pool; adds, promotions and merges wait for them.
+ */
+
+#ifndef QUICPRO_SEMANTIC_GEOMETRY_SPIRAL_H
+#define QUICPRO_SEMANTIC_GEOMETRY_SPIRAL_H
+
+#include "semantic_geometry/kernels.h"
+#include <zend_smart_str.h>
+
+typedef struct {
+    size_t dims;
+    float  step;                /* Ring width, as l2 distance between unit vectors (0..2] */
+    float  threshold;           /* Similarity of a core answer, resonance of a core point */
+    float  cell_radius;         /* Within which a point joins a cell rather than starting one */
+} quicpro_spiral_params_t;
+
+/* A space; shared by reference, freed with its last reference */
+typedef struct quicpro_spiral_s quicpro_spiral_t;
+
+quicpro_spiral_t *quicpro_spiral_new(const quicpro_spiral_params_t *params);
+
+/** @brief Maps a space written by save(); NULL with the reason in `err`. */
+quicpro_spiral_t *quicpro_spiral_load(const char *path, char *err, size_t err_len);
+
+/** @brief Writes the space next to `path` and renames it there. */
+bool quicpro_spiral_save(quicpro_spiral_t *s, const char *path, char *err, size_t err_len);
+
+void quicpro_spiral_retain(quicpro_spiral_t *s);
+void quicpro_spiral_release(quicpro_spiral_t *s);
+
+const quicpro_spiral_params_t *quicpro_spiral_params(const quicpro_spiral_t *s);
+int64_t quicpro_spiral_count(quicpro_spiral_t *s);
+int64_t quicpro_spiral_core_count(quicpro_spiral_t *s);
+int64_t quicpro_spiral_cell_count(quicpro_spiral_t *s);
+
+/** @brief The version of the last change: what delta() of it would start after. */
+uint64_t quicpro_spiral_version(quicpro_spiral_t *s);
+
+/**
+ * @brief Adds the `n` rows of `vectors` (params->dims each) labelled
+ * `labels`. A label already in the space keeps its point; such rows are
+ * skipped. @return The rows added.
+ */
+int64_t quicpro_spiral_add(quicpro_spiral_t *s, const float *vectors, int64_t n, const int64_t *labels);
+
+/**
+ * @brief The `k` nearest points to each of the `n` rows of `queries`,
+ * most similar first, in parallel on the morsel pool: `labels` and
+ * cosine `scores`, k of each per query, a label of -1 past the last.
+ * With `consolidate`, the points found update their resonance, and those
+ * that reach the threshold join the core. @return Points promoted.
+ */
+int64_t quicpro_spiral_search(quicpro_spiral_t *s, const float *queries, int64_t n, uint32_t k, bool consolidate,
+                              int64_t *labels, float *scores);
+
+/** @brief Appends every point changed after version `since` to `into`; the version it is current to. */
+uint64_t quicpro_spiral_delta(quicpro_spiral_t *s, uint64_t since, smart_str *into);
+
+/**
+ * @brief Merges a delta() of a space of the same dims: new labels are
+ * added, known ones keep the higher resonance and join the core if
+ * either side has them there. @return The points changed, or -1 with
+ * the reason in `err` if `delta` is not one.
+ */
+int64_t quicpro_spiral_apply_delta(quicpro_spiral_t *s, const char *delta, size_t len, char *err, size_t err_len);
+
+#endif /* QUICPRO_SEMANTIC_GEOMETRY_SPIRAL_H */
@@ -0,0 +1,114 @@
+/*
+ * include/server/access_log.h – Native access log in a binary ring
+ * =================================================================
+ *
+ * An access log line rendered as JSON and written from the handler's
+ * thread costs a few percent of a worker's CPU: formatting, an allocation
+ * and a write(2) per request. Instead the listeners fill in a fixed
+ * 256-byte record per request, straight in this worker's ring:
+ * - when it ended, how long it took, from the request's arrival where the
+ *   listener knows it;
+ * - protocol, method, path (the first 171 bytes), status;
+ * - bytes received and sent (request and response bodies, and the
+ *   HTTP/1.1 head);
+ * - the peer, and for QUIC the server connection ID, stream ID and the
+ *   smoothed RTT.
+ *
+ * A record is a few stores and one release store that publishes it.
+ * Each PHP thread has its own single-producer ring of
+ * `quicpro.access_log_ring_records` records. If the writer falls that far
+ * behind, records are dropped and counted in quicpro_access_log_dropped_total.
+ *
+ * One native writer thread per process drains the rings every
+ * `quicpro.access_log_flush_ms`, or sooner once a ring is half full. It
+ * appends to `quicpro.access_log_dir`/access-<pid>.log:
+ * - `quicpro.access_log_format` = json: one JSON object per line, rendered
+ *   by the writer thread;
+ * - binary: the records as they are, a whole run of them per writev(2),
+ *   after a QUICPRO_ACCESS_LOG_MAGIC header. quicpro_access_log_convert()
+ *   turns such a file into JSON lines later, on any machine of the same
+ *   byte order.
+ *
+ * Logged: HTTP/1.1 and HTTP/2 requests, cached answers included, and
+ * requests of the MCP server. Requests the listeners refuse before
+ * parsing (rate limits, overload shedding of HTTP/2) are not.
+ */
+
+#ifndef QUICPRO_SERVER_ACCESS_LOG_H
+#define QUICPRO_SERVER_ACCESS_LOG_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <quiche.h>
+
+#define QUICPRO_ACCESS_LOG_MAGIC   "QPACLOG\1"   /* Then the record size, uint32_t */
+#define QUICPRO_ACCESS_RECORD_SIZE 256
+
+typedef enum {
+    QUICPRO_ACCESS_HTTP1 = 1,
+    QUICPRO_ACCESS_HTTP2 = 2,
+    QUICPRO_ACCESS_MCP   = 3                  /* MCP over HTTP/3 */
+} quicpro_access_protocol_t;
+
+/* One request; the binary file format, field for field */
+typedef struct {
+    uint64_t ts_ns;                           /* Answered, CLOCK_REALTIME */
+    uint64_t stream_id;                       /* HTTP/2 and QUIC */
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint32_t duration_us;
+    uint32_t rtt_us;                          /* QUIC only */
+    uint16_t status;
+    uint16_t peer_port;
+    uint8_t  protocol;                        /* quicpro_access_protocol_t */
+    uint8_t  method;                          /* Index into quicpro_access_log_methods, 0: other */
+    uint8_t  cid_len;
+    uint8_t  peer_family;                     /* 4, 6, or 0: unknown */
+    uint8_t  path_len;
+    uint8_t  cid[QUICHE_MAX_CONN_ID_LEN];
+    uint8_t  peer[16];
+    char     path[QUICPRO_ACCESS_RECORD_SIZE - 85];
+} quicpro_access_record_t;
+
+/** @brief Whether `quicpro.access_log_enable` is on. */
+bool quicpro_access_log_enabled(void);
+
+/**
+ * @brief The next free record of this thread's ring, zeroed, or NULL when
+ * logging is off or the ring is full. Fill it in, then publish it with
+ * quicpro_access_log_commit() before asking for another.
+ */
+quicpro_access_record_t *quicpro_access_log_begin(void);
+
+/** @brief Stamps `r` and hands it to the writer. */
+void quicpro_access_log_commit(quicpro_access_record_t *r);
+
+/** @brief Sets the method by name. */
+void quicpro_access_log_method(quicpro_access_record_t *r, const char *method, size_t len);
+
+/** @brief Sets the path, cut to what fits. */
+void quicpro_access_log_path(quicpro_access_record_t *r, const char *path, size_t len);
+
+/** @brief Sets the peer address. */
+void quicpro_access_log_peer(quicpro_access_record_t *r, const struct sockaddr *addr);
+
+/** @brief Sets the server connection ID and the RTT of a QUIC connection. */
+void quicpro_access_log_quic(quicpro_access_record_t *r, quiche_conn *conn);
+
+/** @brief Stops the writer after a last drain. For MSHUTDOWN. */
+void quicpro_access_log_mshutdown(void);
+
+/*
+ * PHP_FUNCTION(quicpro_access_log_convert)
+ * int|false quicpro_access_log_convert(string $binary_path, string $json_path)
+ * Writes the records of a binary access log as JSON lines; returns how
+ * many, false if `$json_path` cannot be written. Throws if the file is
+ * not a binary access log of this build.
+ */
+PHP_FUNCTION(quicpro_access_log_convert);
+
+#endif /* QUICPRO_SERVER_ACCESS_LOG_H */
@@ -16,6 +16,39 @@
  *
  * Authentication for this endpoint is strictly enforced via Mutual TLS (mTLS)
  * to ensure that only authorized clients can perform administrative actions.
+ *
+ * The endpoint speaks HTTP/3 on UDP. A client keeps one connection for any
+ * number of requests. The IIBIN messages below use the protobuf wire format
+ * that Quicpro\IIBIN encodes, so a controller defines them as IIBIN schemas
+ * (or .proto files) and sends them with content-type
+ * application/vnd.quicpro.proto:
+ *
+ *   POST /batch    AdminBatch in, AdminBatchResult out, results in op order
+ *
+ *     AdminBatch       { repeated AdminOp op = 1; }   // at most 4096
+ *     AdminOp          { oneof: string drain = 1;      // MCP target host:port
+ *                               string undrain = 2;
+ *                               RateLimitKey rate_limit = 3;
+ *                               Setting set = 4;       // server/live_config.h keys
+ *                               bool profile = 5; }    // profiler on/off
+ *     RateLimitKey     { string key = 1; uint64 block_ms = 2; }  // 0: refill
+ *     Setting          { string key = 1; string value = 2; }
+ *     AdminBatchResult { repeated OpResult result = 1; uint64 generation = 2; }
+ *     OpResult         { bool ok = 1; string error = 2; }
+ *
+ *   The `set` operations of a batch publish one configuration snapshot, so
+ *   they take effect together or not at all; `generation` is its number.
+ *
+ *   GET /events    a stream that stays open, of AdminEvent messages each
+ *                  preceded by its varint length (server/admin_events.h)
+ *
+ *     AdminEvent       { uint64 seq = 1; uint32 type = 2; uint64 time_unix_ns = 3;
+ *                        string subject = 4; int64 code = 5; }
+ *
+ * GET /qlog, GET /profile, POST /profile/start|stop, GET /capture, POST
+ * /capture|/capture/stop (server/capture.h) and POST /config (a flat JSON
+ * object) stay available for a plain HTTP/3 client such as
+ * `curl --http3-only`.
  */
 
 /**
@@ -0,0 +1,84 @@
+/*
+ * include/server/admin_events.h – Live events for admin API subscribers
+ * =====================================================================
+ *
+ * What a fleet controller would otherwise poll for. GET /events on the
+ * admin API (server/admin_api.h) keeps its stream open and sends every
+ * event as it happens:
+ *
+ *   conn_open     a QUIC connection was accepted; subject: the peer address
+ *   conn_error    a QUIC connection closed with an error; subject: the peer,
+ *                 code: the transport or application error code
+ *   breaker_open  an MCP target's circuit breaker opened; subject: its
+ *                 host:port
+ *   lost          the subscriber fell behind the ring; code: events skipped
+ *
+ * Publishers write into one ring per process with a slot sequence each
+ * (a seqlock), so they never wait for a subscriber. While nobody
+ * subscribes, publishing costs one relaxed load.
+ */
+
+#ifndef QUICPRO_SERVER_ADMIN_EVENTS_H
+#define QUICPRO_SERVER_ADMIN_EVENTS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "quiche.h"
+
+#define QUICPRO_ADMIN_EVENTS_RING        1024   /* Power of two */
+#define QUICPRO_ADMIN_EVENT_SUBJECT_MAX  64
+
+typedef enum {
+    QUICPRO_ADMIN_EVENT_CONN_OPEN    = 1,
+    QUICPRO_ADMIN_EVENT_CONN_ERROR   = 2,
+    QUICPRO_ADMIN_EVENT_BREAKER_OPEN = 3,
+    QUICPRO_ADMIN_EVENT_LOST         = 4
+} quicpro_admin_event_type_t;
+
+typedef struct {
+    uint64_t seq;                       /* 1, 2, ... in publishing order */
+    uint32_t type;                      /* quicpro_admin_event_type_t */
+    int64_t  code;
+    uint64_t time_unix_ns;
+    uint8_t  subject_len;
+    char     subject[QUICPRO_ADMIN_EVENT_SUBJECT_MAX];
+} quicpro_admin_event_t;
+
+extern _Atomic int quicpro_admin_event_subscribers;
+
+/** @brief Whether anyone listens; publishers may skip building their subject otherwise. */
+static inline bool quicpro_admin_events_wanted(void)
+{
+    return atomic_load_explicit(&quicpro_admin_event_subscribers, memory_order_relaxed) > 0;
+}
+
+/** @brief Publishes an event; `subject` is cut at QUICPRO_ADMIN_EVENT_SUBJECT_MAX. Any thread. */
+void quicpro_admin_event_publish(quicpro_admin_event_type_t type, const char *subject, size_t subject_len, int64_t code);
+
+/** @brief conn_open for `peer`. */
+void quicpro_admin_event_conn_open(const struct sockaddr_storage *peer);
+
+/** @brief conn_error for a closed `conn`, if it closed with an error. */
+void quicpro_admin_event_conn_closed(quiche_conn *conn, const struct sockaddr_storage *peer);
+
+/**
+ * @brief Starts a subscription.
+ * @return Its cursor: events published from now on follow it.
+ */
+uint64_t quicpro_admin_events_subscribe(void);
+
+/** @brief Ends a subscription of quicpro_admin_events_subscribe(). */
+void quicpro_admin_events_unsubscribe(void);
+
+/**
+ * @brief The event after `*cursor` into `out`, advancing the cursor. An
+ * overrun yields one `lost` event first.
+ * @return false if there is none yet.
+ */
+bool quicpro_admin_events_next(uint64_t *cursor, quicpro_admin_event_t *out);
+
+#endif /* QUICPRO_SERVER_ADMIN_EVENTS_H */
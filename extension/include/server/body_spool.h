@@ -0,0 +1,67 @@
+/*
+ * include/server/body_spool.h – Request bodies too large to buffer
+ * ================================================================
+ *
+ * The HTTP/1 and HTTP/2 listeners keep a request body in memory up to
+ * quicpro.tcp_body_spool_threshold_bytes. A larger one is written to a
+ * spool file as it arrives instead, so an upload costs the worker a read
+ * buffer whatever its size:
+ *
+ *     quicpro.tcp_body_spool_threshold_bytes = 262144   ; 0: never spool
+ *     quicpro.tcp_body_spool_max_bytes = 1073741824     ; larger bodies: 413
+ *     quicpro.tcp_body_spool_dir = ""                   ; "": a memfd
+ *
+ * Without a directory the spool is a memfd: anonymous memory the kernel
+ * may swap, outside PHP's heap and memory_limit. With one it is an
+ * unnamed O_TMPFILE there (a named file, unlinked at once, where the
+ * filesystem has no O_TMPFILE). Either way nothing is left behind when
+ * the descriptor closes.
+ *
+ * The handler reads a spooled body through Quicpro\Request::bodyStream(),
+ * or moves it with saveBody(), which copies file to file in the kernel
+ * (copy_file_range(), else splice()) without the bytes passing through
+ * PHP. body() still works, reading the whole spool into a string.
+ */
+
+#ifndef QUICPRO_SERVER_BODY_SPOOL_H
+#define QUICPRO_SERVER_BODY_SPOOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef struct {
+    int      fd;        /* -1 while the body is in memory */
+    uint64_t len;       /* Bytes written so far */
+} quicpro_body_spool_t;
+
+/** @brief An empty spool, not yet opened. */
+void quicpro_body_spool_init(quicpro_body_spool_t *spool);
+
+/** @brief Whether a body of `len` bytes goes to a spool rather than memory. */
+bool quicpro_body_spool_wanted(uint64_t len);
+
+/** @brief Largest body a spool takes (quicpro.tcp_body_spool_max_bytes). */
+uint64_t quicpro_body_spool_max(void);
+
+/**
+ * @brief Opens the spool's file.
+ * @return False after a warning if none could be created.
+ */
+bool quicpro_body_spool_open(quicpro_body_spool_t *spool);
+
+/** @brief Appends `len` bytes. False on a write error (ENOSPC, mostly). */
+bool quicpro_body_spool_write(quicpro_body_spool_t *spool, const void *data, size_t len);
+
+/** @brief Closes the file, if open, and empties the spool. */
+void quicpro_body_spool_close(quicpro_body_spool_t *spool);
+
+/**
+ * @brief Copies the first `len` bytes of `in_fd` to `out_fd` at its
+ * current position, in the kernel where it can: copy_file_range(), then
+ * splice() through a pipe, then read() and write().
+ * @return The bytes copied, or -1 with errno set.
+ */
+int64_t quicpro_body_spool_copy(int in_fd, uint64_t len, int out_fd);
+
+#endif /* QUICPRO_SERVER_BODY_SPOOL_H */
@@ -4,37 +4,91 @@
 #define QUICPRO_SERVER_CANCEL_H
 
 #include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "client/session.h"
 
 /**
  * @file extension/include/server/cancel.h
- * @brief Public API declarations for handling request cancellation.
+ * @brief Cancellation tokens for the requests a handler serves.
+ *
+ * A client that gives up on a request (the user navigated away, its own
+ * timeout fired, a hedged copy lost) stops the stream: STOP_SENDING and
+ * RESET_STREAM. Without a token the handler runs to the end anyway, and
+ * the MCP calls and pipeline steps it started keep their agents and GPUs
+ * busy for an answer nobody reads.
+ *
+ * The HTTP/3 listener's handler calls and the MCP server's handler calls
+ * (include/mcp/mcp_server.h) each run under a token tied to their request
+ * stream. The token is ambient, like the MCP deadline
+ * (quicpro_mcp_deadline_enter()): it needs no parameter, and Fibers the
+ * handler starts share it.
  *
- * This header defines the interface for the server to react to client-side
- * request cancellations. In protocols like HTTP/2 and HTTP/3, a client can
- * signal that it is no longer interested in the response to a request
- * (e.g., by sending an RST_STREAM frame). This API provides a mechanism for
- * the C-core to notify the PHP application, allowing it to gracefully
- * terminate long-running operations like database queries or file generation,
- * thereby saving server resources.
+ * A handler only notices a cancellation where it waits. Every wait of an
+ * MCP call (include/mcp/mcp.h) first asks quicpro_cancel_requested():
+ * - While a handler runs, the listener loop is stalled. The listener
+ *   therefore lends the token its socket (quicpro_cancel_set_pump()).
+ *   Waits also watch that socket, and datagrams of known connections are
+ *   fed to them right away. Datagrams opening new connections wait for
+ *   the loop. Inside a Fiber, waits are cut into QUICPRO_CANCEL_SLICE_MS
+ *   slices instead.
+ * - A request is cancelled once its connection is closed, or once the
+ *   peer sent STOP_SENDING for its stream.
+ * - The wait then throws. The calls in flight are abandoned with
+ *   RESET_STREAM as after any error, and the exception unwinds the
+ *   handler at its await point. Its other Fibers, such as a pipeline's
+ *   steps, get the same exception at their next wait.
+ * - Callbacks registered with quicpro_server_on_cancel() run once, when
+ *   the cancellation is seen. A long CPU-bound handler can poll with
+ *   quicpro_request_cancelled().
+ *
+ * The HTTP/1 and HTTP/2 listeners run handlers without tokens. Neither
+ * does the MCP server's batch handler, since one client cannot cancel
+ * a whole batch. With the io_uring engine the listener lends no socket,
+ * so a cancellation is only seen if the handler's waits happen to process
+ * the stopping packets.
  */
 
+#define QUICPRO_CANCEL_SLICE_MS 50
+
+typedef struct quicpro_cancel_token_s {
+    quicpro_session_t              *session;    /* The served connection */
+    uint64_t                        stream_id;
+    bool                            cancelled;
+    zval                            callbacks;  /* quicpro_server_on_cancel(); UNDEF until the first */
+    struct quicpro_cancel_token_s  *outer;      /* Restored on leave */
+} quicpro_cancel_token_t;
+
+/** @brief Makes `t` the current token for a handler serving `stream_id` of `s`. */
+void quicpro_cancel_enter(quicpro_cancel_token_t *t, quicpro_session_t *s, uint64_t stream_id);
+
+/** @brief Restores the token that was current before `t`, and frees its callbacks. */
+void quicpro_cancel_leave(quicpro_cancel_token_t *t);
+
 /**
- * @brief Registers a cancellation handler for a specific request stream.
- *
- * This function associates a PHP callable with a specific stream ID. If the
- * client cancels the request associated with this stream, the C-core will
- * invoke the provided callable. This allows the PHP application to perform
- * cleanup operations, such as terminating a database query or deleting
- * temporary files.
- *
- * @param session_resource The resource of the session containing the stream.
- * @param stream_id The ID of the stream for which to register the handler.
- * @param cancel_handler_callable A PHP callable that will be invoked upon
- * cancellation. The callable will receive the `stream_id` as its only
- * argument, allowing it to identify which request was cancelled.
- * @return TRUE on success, indicating the handler was registered.
- * FALSE on failure (e.g., invalid stream ID or session).
+ * @brief Whether the client cancelled the request being served. Feeds the
+ * listener's pending datagrams to their connections first. The first
+ * call to return true runs the token's callbacks. False outside a handler.
  */
+bool quicpro_cancel_requested(void);
+
+/**
+ * @brief The socket a wait should also watch for the current token, or
+ * -1 when there is no token or no socket to watch.
+ */
+int quicpro_cancel_watch_fd(void);
+
+/**
+ * @brief Lends the listener's socket to the tokens: `pump(ctx)` reads
+ * what is pending on `fd` without blocking. `fd` -1 withdraws it.
+ */
+void quicpro_cancel_set_pump(int fd, void (*pump)(void *ctx), void *ctx);
+
+/* quicpro_server_on_cancel(callable $callback): bool – false outside a handler */
 PHP_FUNCTION(quicpro_server_on_cancel);
 
+/* quicpro_request_cancelled(): bool */
+PHP_FUNCTION(quicpro_request_cancelled);
+
 #endif // QUICPRO_SERVER_CANCEL_H
@@ -0,0 +1,145 @@
+/*
+ * include/server/capture.h – Sampled packet capture with TLS secrets
+ * ==================================================================
+ *
+ * tcpdump next to a production worker sees QUIC only encrypted, and
+ * SSLKEYLOGFILE logs every handshake of the process. Instead a worker
+ * copies the datagrams of the connections it was asked to capture into
+ * a bounded ring of its own, and has quiche log those connections' TLS
+ * secrets. A dump is pcapng: the secrets in a Decryption Secrets Block,
+ * the datagrams as raw IP packets with their addresses and ports, so
+ * Wireshark decrypts the capture without any further file.
+ *
+ * A connection is captured when:
+ *   • it is picked as it is accepted, per
+ *     `quicpro.transport_capture_sample_ratio`;
+ *   • quicpro_capture_connection() is called with its session;
+ *   • the admin API (server/admin_api.h) names one of its connection IDs
+ *     in POST /capture. A named ID stays armed until POST /capture/stop:
+ *     the running connection it belongs to is captured from the server
+ *     loop's next round, and a connection yet to come whose client
+ *     chooses that ID for its first packet is captured from it.
+ *
+ * Datagrams are copied before quiche decrypts them in place, and as
+ * quiche hands them out for sending. A connection not captured costs one
+ * branch per datagram; the arming requests cost one per server round.
+ * Capturing never waits: a thread that finds the ring in use by another
+ * (the listener's I/O thread, or a dump being copied) drops the datagram
+ * and counts it. Captured connections send through the plain socket path
+ * rather than io_uring, so each datagram they send is seen.
+ *
+ * The ring holds `quicpro.transport_capture_ring_bytes` of fixed slots of
+ * `quicpro.transport_capture_snaplen` bytes each, is allocated with the
+ * first capture, and overwrites the oldest datagrams once full. The
+ * secrets go to a memfd that quiche appends to; when it outgrows a
+ * sixteenth of the ring it is replaced, and dumps carry the last two.
+ *
+ * Secrets are derived during the handshake. A connection captured after
+ * it completed, from PHP or the admin API, is dumped without them:
+ * sampling, or arming a client's first connection ID, captures whole
+ * connections. Captured connections log their secrets here rather than
+ * to SSLKEYLOGFILE.
+ */
+
+#ifndef QUICPRO_SERVER_CAPTURE_H
+#define QUICPRO_SERVER_CAPTURE_H
+
+#include <php.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <quiche.h>
+
+#include "client/session.h"
+#include "server/cid.h"
+
+#define QUICPRO_CAPTURE_ARMED_MAX 64    /* Connection IDs the admin API keeps armed */
+
+/* Bumped by every arming request; each server loop applies what it has not seen */
+extern _Atomic uint32_t quicpro_capture_generation;
+
+/** @brief Has quiche log TLS secrets on `config`, so captured connections can. Before quiche_accept(). */
+void quicpro_capture_keylog_config(quiche_config *config);
+
+/**
+ * @brief A server connection was accepted: captures it if sampled, or if
+ * the admin API armed `scid` or the client's first `dcid`.
+ */
+void quicpro_capture_conn_started(quicpro_session_t *session, const uint8_t *scid, size_t scid_len,
+                                  const uint8_t *dcid, size_t dcid_len);
+
+/** @brief Starts or stops capturing `session`. False if capturing is off. */
+bool quicpro_capture_set(quicpro_session_t *session, bool on);
+
+/** @brief Copies one datagram of a captured connection into the ring. */
+void quicpro_capture_packet(quicpro_session_t *session, bool outgoing, const struct sockaddr *peer,
+                            const uint8_t *data, size_t len);
+
+/** @brief A datagram from `from` (NULL: the session's peer), before quiche_conn_recv(). */
+static inline void quicpro_capture_rx(quicpro_session_t *session, const struct sockaddr *from, const uint8_t *data, size_t len)
+{
+    if (session->capture) {
+        quicpro_capture_packet(session, false, from, data, len);
+    }
+}
+
+/** @brief A datagram quiche_conn_send() wrote for `to` (NULL: the session's peer). */
+static inline void quicpro_capture_tx(quicpro_session_t *session, const struct sockaddr *to, const uint8_t *data, size_t len)
+{
+    if (session->capture) {
+        quicpro_capture_packet(session, true, to, data, len);
+    }
+}
+
+/** @brief Applies the admin API's arming requests to `sessions`, keyed by SCID. */
+void quicpro_capture_apply(quicpro_cid_table_t *sessions, uint32_t *seen);
+
+/** @brief Once per server round; `seen` is the loop's own. */
+static inline void quicpro_capture_round(quicpro_cid_table_t *sessions, uint32_t *seen)
+{
+    if (atomic_load_explicit(&quicpro_capture_generation, memory_order_relaxed) != *seen) {
+        quicpro_capture_apply(sessions, seen);
+    }
+}
+
+/**
+ * @brief Arms connection IDs given as hex, separated by whitespace or
+ * commas. Safe from another thread, like the rest of the admin calls.
+ * @return The number armed, or -1 if one is no connection ID or capturing is off.
+ */
+int quicpro_capture_arm(const char *text, size_t len);
+
+/** @brief Disarms every connection ID and stops every capture from the next round. */
+void quicpro_capture_stop(void);
+
+/**
+ * @brief The ring and the secrets as pcapng, oldest datagram first, in
+ * persistent memory. Uses no PHP allocation, so the admin thread may
+ * call it. Captures that meanwhile find the ring busy are dropped.
+ * @return The length, filled into `*out`; 0 with `*out` NULL if nothing was captured.
+ */
+size_t quicpro_capture_pcapng(char **out);
+
+/** @brief Frees the ring and the secrets. For MSHUTDOWN. */
+void quicpro_capture_mshutdown(void);
+
+/*
+ * PHP_FUNCTION(quicpro_capture_connection)
+ * bool quicpro_capture_connection(resource $session, bool $enable = true)
+ * Starts or stops capturing a server connection. False if
+ * quicpro.transport_capture_ring_bytes is 0.
+ */
+PHP_FUNCTION(quicpro_capture_connection);
+
+/*
+ * PHP_FUNCTION(quicpro_capture_dump)
+ * string|bool quicpro_capture_dump(?string $path = null)
+ * This worker's capture as pcapng, or written to $path (true on success).
+ * An empty string if nothing was captured yet.
+ */
+PHP_FUNCTION(quicpro_capture_dump);
+
+#endif /* QUICPRO_SERVER_CAPTURE_H */
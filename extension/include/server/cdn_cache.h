@@ -0,0 +1,232 @@
+/*
+ * include/server/cdn_cache.h – Response cache of the native CDN
+ * ==============================================================
+ *
+ * With quicpro.cdn_enable, the TCP listeners keep the handler's cacheable GET responses and answer
+ * later GET and HEAD requests for them before any PHP runs. An object
+ * holds the status, its header lines (names in lower case, rendered once
+ * for HTTP/1 and pointed into by an nghttp2_nv array for HTTP/2) and the
+ * body, in one allocation. Objects are immutable and refcounted: a
+ * listener keeps the one it sends until the last byte is out, while the
+ * cache may already have dropped it.
+ *
+ * The key is the authority, the path with its query, and the request's
+ * values of each header named in quicpro.cdn_cache_vary_on_headers. A
+ * response whose own Vary names any other header (or "*") is not kept.
+ * Neither is one with Set-Cookie, or whose Cache-Control says no-store,
+ * no-cache or private. With quicpro.cdn_cache_respect_origin_headers,
+ * s-maxage and then max-age set its lifetime; otherwise, and without
+ * them, quicpro.cdn_cache_default_ttl_sec does.
+ *
+ * The memory tier is one shared mapping, prepared by the cluster master
+ * before it forks, so all workers of a host share one cache and
+ * quicpro.cdn_cache_memory_limit_mb bounds it as a whole; a miss one
+ * worker stored is a hit for the next. The table is split into shards by
+ * key hash, each behind its own process-shared mutex, and each shard
+ * evicts by W-TinyLFU: new objects enter a small LRU
+ * window (1% of the shard's bytes); an object leaving the window is
+ * admitted to the segmented LRU main area (probation, then 80% protected)
+ * only if a count-min sketch of recent key frequencies rates it above the
+ * object it would displace. One-hit wonders therefore never push out the
+ * working set. Memory is accounted in the bytes of the power-of-two
+ * blocks objects take.
+ *
+ * The lines of quicpro.cdn_response_headers_to_add are part of every
+ * object, since an object is only ever sent as a hit.
+ *
+ * With response compression on (server/compress.h), the key ends with the
+ * coding negotiated from the request's Accept-Encoding, and each variant
+ * is stored already encoded, with its Content-Encoding and Vary lines.
+ * The handler runs once per variant; every later hit is sent as stored.
+ * A handler's own "Vary: Accept-Encoding" is then no reason to refuse.
+ *
+ * With a cdn_cache_mode of "disk" or "hybrid", server/cdn_disk.h keeps
+ * every stored object on disk as well. A lookup the memory tier misses
+ * ("hybrid") reads the object back into it if its body fits there; in
+ * "disk" mode, and for larger bodies, the object handed out only names
+ * its segment file, and the listener sends the body from there
+ * (decrypting the range it sends where the tier encrypts at rest).
+ *
+ * A body too large for one object is kept in slices of about 1 MiB, each
+ * an object of its own (keyed by the object's key and its index) that is
+ * admitted and evicted on its own, behind a small head object with the
+ * status and lines. Caching no longer stops at
+ * quicpro.cdn_cache_max_object_size_mb, and the slices a range covers are
+ * all a Range request needs. If one was evicted meanwhile, the request
+ * counts as a miss and the handler's response fills the slices again.
+ *
+ * Cached 200 responses honour a single byte range ("bytes=a-b", "a-" or
+ * "-n") with a 206, or 416 past the end; other forms, and requests with
+ * If-Range, get the whole body.
+ *
+ * With quicpro.cdn_serve_stale_on_error, expired objects stay until
+ * evicted and answer in place of a handler that failed (an exception or
+ * a 5xx status).
+ *
+ * Misses are coalesced across the workers: the first miss of a key leads a "flight" and runs
+ * the handler; a concurrent miss of the same key meanwhile is answered
+ * from the expired copy if serving stale is on (stale-while-revalidate),
+ * or else waits for the flight to land and then looks again. A flight
+ * that takes longer than quicpro.cdn_origin_request_timeout_ms no longer
+ * holds anyone back.
+ */
+
+#ifndef QUICPRO_SERVER_CDN_CACHE_H
+#define QUICPRO_SERVER_CDN_CACHE_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <nghttp2/nghttp2.h>
+
+#include "object_store/at_rest.h"
+#include "server/compress.h"
+#include "server/header_template.h"
+#include "server/ktls.h"
+
+#define QUICPRO_CDN_KEY_MAX 2048        /* Longer URLs are not cached */
+
+typedef struct quicpro_cdn_object_s quicpro_cdn_object_t;
+
+/* What a listener reads from an object; the rest is the cache's */
+struct quicpro_cdn_object_s {
+    _Atomic uint32_t  refs;
+    uint16_t          status;
+    const char       *h1;               /* "name: value\r\n" lines */
+    size_t            h1_len;
+    const nghttp2_nv *nv;               /* The same lines */
+    size_t            nv_count;
+    const char       *body;             /* NULL when the body is in a file: */
+    size_t            body_len;
+    int               body_fd;          /* -1, or body_len bytes of this file from body_offset */
+    uint64_t          body_offset;
+    quicpro_at_rest_alg_t body_seal;    /* NONE, or the file's body is sealed with this and body_salt */
+    uint8_t           body_salt[QUICPRO_AT_REST_SALT_LEN];
+    bool              sliced;           /* The body is in slices: see quicpro_cdn_body_open() */
+};
+
+/* The bytes of a cached body a response sends, and the slices holding them */
+typedef struct {
+    quicpro_cdn_object_t **slices;      /* Referenced; `one` when there is one */
+    quicpro_cdn_object_t  *one;
+    size_t                 count;       /* 0 when none is open */
+    size_t                 skip;        /* Bytes of the first slice before the range */
+    size_t                 slice_len;   /* Body bytes of each slice but the last */
+    uint64_t               len;
+} quicpro_cdn_body_t;
+
+typedef enum {
+    QUICPRO_CDN_RANGE_NONE,             /* Send the whole body */
+    QUICPRO_CDN_RANGE_OK,
+    QUICPRO_CDN_RANGE_UNSATISFIABLE
+} quicpro_cdn_range_t;
+
+typedef struct {
+    char     buf[QUICPRO_CDN_KEY_MAX];
+    size_t   len;
+    uint64_t hash;
+    bool     ok;                        /* False when it did not fit */
+} quicpro_cdn_key_t;
+
+/** @brief Maps the shared memory tier. Called by the cluster master before forking. */
+void quicpro_cdn_cache_prepare(void);
+
+/** @brief Unmaps the arena of quicpro_cdn_cache_prepare(). */
+void quicpro_cdn_cache_release(void);
+
+/** @brief Whether the cache is on, with either tier. */
+bool quicpro_cdn_cache_enabled(void);
+
+/** @brief Starts a key with the request's authority and path. */
+void quicpro_cdn_key_begin(quicpro_cdn_key_t *k, const char *authority, size_t authority_len, const char *path, size_t path_len);
+
+/** @brief Number of headers to vary on; their lower-case names by index. */
+size_t quicpro_cdn_vary_count(void);
+const char *quicpro_cdn_vary_name(size_t i, size_t *len);
+
+/** @brief Appends the request's value of vary header `i` (NULL if absent), in index order. */
+void quicpro_cdn_key_vary(quicpro_cdn_key_t *k, const char *value, size_t len);
+
+/** @brief Appends the negotiated response coding; nothing for identity. */
+void quicpro_cdn_key_coding(quicpro_cdn_key_t *k, quicpro_coding_t coding);
+
+/** @brief Finishes the key. */
+void quicpro_cdn_key_end(quicpro_cdn_key_t *k);
+
+/**
+ * @brief A fresh object for `k`, referenced; NULL on a miss. Counts the
+ * access in the frequency sketch either way.
+ */
+quicpro_cdn_object_t *quicpro_cdn_lookup(const quicpro_cdn_key_t *k);
+
+/** @brief An object for `k` even if expired, referenced, when serving stale is on. */
+quicpro_cdn_object_t *quicpro_cdn_lookup_stale(const quicpro_cdn_key_t *k);
+
+/**
+ * @brief Whether a response with this status and these headers would be
+ * kept, admission aside. Listeners ask before choosing a compression level.
+ */
+bool quicpro_cdn_storable(long status, const quicpro_header_template_t *tmpl, HashTable *headers);
+
+/**
+ * @brief Offers the handler's response to a GET for `k`: the template's
+ * and the handler's own headers, and the body, encoded with `coding`
+ * (which adds its Content-Encoding line). `vary_coding` adds
+ * "Vary: Accept-Encoding". Kept if cacheable and admitted; the caller's
+ * data is copied.
+ */
+void quicpro_cdn_store(const quicpro_cdn_key_t *k, long status, const quicpro_header_template_t *tmpl,
+                       HashTable *headers, quicpro_coding_t coding, bool vary_coding,
+                       const char *body, size_t body_len);
+
+/**
+ * @brief Starts fetching `k` after a miss.
+ * @return True for the leader, which must call quicpro_cdn_flight_end()
+ * once its response was offered; false while another fetch is under way.
+ */
+bool quicpro_cdn_flight_begin(const quicpro_cdn_key_t *k);
+
+/** @brief The leader's fetch of `k` is over, stored or not. */
+void quicpro_cdn_flight_end(const quicpro_cdn_key_t *k);
+
+/** @brief Whether a fetch of `k` is still under way (and not timed out). */
+bool quicpro_cdn_flight_pending(const quicpro_cdn_key_t *k);
+
+/**
+ * @brief Parses a Range header against a body of `total` bytes: `count`
+ * bytes from `first` on QUICPRO_CDN_RANGE_OK.
+ */
+quicpro_cdn_range_t quicpro_cdn_range_parse(const char *v, size_t len, uint64_t total, uint64_t *first, uint64_t *count);
+
+/**
+ * @brief Takes the `len` body bytes of `o` from `first` (an object whose
+ * body is not in a file), looking up its slices by `k`.
+ * @return False if a slice is gone; `b` then holds nothing.
+ */
+bool quicpro_cdn_body_open(quicpro_cdn_body_t *b, const quicpro_cdn_key_t *k, quicpro_cdn_object_t *o, uint64_t first, uint64_t len);
+
+/**
+ * @brief Opens the `len` body bytes of `o` from `first` (an object whose
+ * body is in a file) as a file body, sent with sendfile() unless sealed.
+ * @return 0, or -1 if the file or the key cannot be had.
+ */
+int quicpro_cdn_body_file_open(quicpro_file_body_t *b, const quicpro_cdn_object_t *o, uint64_t first, uint64_t len);
+
+/** @brief The part of piece `i` (of b->count) that is in the range. */
+void quicpro_cdn_body_piece(const quicpro_cdn_body_t *b, size_t i, const char **data, size_t *len);
+
+/** @brief Copies up to `n` bytes of the range from `at`; returns how many. */
+size_t quicpro_cdn_body_read(const quicpro_cdn_body_t *b, uint64_t at, char *dst, size_t n);
+
+/** @brief Drops the slices' references; `b` may be empty. */
+void quicpro_cdn_body_close(quicpro_cdn_body_t *b);
+
+/** @brief Drops a reference of quicpro_cdn_lookup*(). */
+void quicpro_cdn_release(quicpro_cdn_object_t *o);
+
+/** @brief Drops the cache's state and this process's arena mapping (MSHUTDOWN; no listener runs). */
+void quicpro_cdn_cache_mshutdown(void);
+
+#endif /* QUICPRO_SERVER_CDN_CACHE_H */
@@ -0,0 +1,93 @@
+/*
+ * include/server/cdn_disk.h – Disk tier of the native CDN cache
+ * =============================================================
+ *
+ * With a cdn_cache_mode of "disk" or "hybrid", server/cdn_cache.h keeps
+ * its objects under quicpro.cdn_cache_disk_path as well: the tier behind
+ * (or, for "disk", instead of) the in-memory one.
+ *
+ * Objects are appended to segment files of 256 MiB, each record the
+ * status, key and header lines followed by the body at the next 4 KiB
+ * boundary, so a body can go out with sendfile() (and kernel TLS)
+ * straight from the page cache. Segments are never rewritten: once the
+ * tier holds as many as fit into 90% of the free space it found at
+ * startup, the oldest segment is deleted with every object in it.
+ *
+ * The index is an open-addressed table of fixed slots (hash → segment,
+ * offset, sizes, expiry) in a file mapped with MAP_SHARED, so it survives
+ * a restart of the process as it was, and a warm restart finds the same
+ * objects. A lookup touches one or a few slots and reads the record's
+ * head to confirm the key; records that do not check out are dropped.
+ *
+ * Each index is owned by one process at a time, which holds an flock()
+ * on it. Cluster workers sharing a cache_disk_path therefore take one of
+ * up to 64 subdirectories each ("shard-00" ...) and a restarted worker
+ * picks up a free one again, with its objects.
+ *
+ * With quicpro.storage_encryption_at_rest_enable, bodies are written
+ * sealed (object_store/at_rest.h) in 64 KiB segments under a key derived
+ * for the record from a random salt in its head. Such a body can no
+ * longer go out with sendfile(): the listener reads it through
+ * quicpro_cdn_disk_unseal(), which decrypts only the segments of the
+ * range it sends. Without a usable key the tier stays off rather than
+ * write bodies in the clear.
+ */
+
+#ifndef QUICPRO_SERVER_CDN_DISK_H
+#define QUICPRO_SERVER_CDN_DISK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "object_store/at_rest.h"
+
+typedef struct {
+    uint16_t    status;
+    uint64_t    expires_ms;     /* CLOCK_REALTIME */
+    char       *head;           /* pemalloc'ed; free with quicpro_cdn_disk_hit_free() */
+    const char *h1;             /* "name: value\r\n" lines, inside `head` */
+    size_t      h1_len;
+    int         fd;             /* A duplicate the caller owns: body_len bytes at body_offset */
+    uint64_t    body_offset;
+    uint64_t    body_len;       /* Plaintext bytes */
+    quicpro_at_rest_alg_t seal; /* NONE, or the body is encrypted at rest with this and: */
+    uint8_t     salt[QUICPRO_AT_REST_SALT_LEN];
+} quicpro_cdn_disk_hit_t;
+
+/**
+ * @brief Opens (or creates) a free shard of the tier under `dir`.
+ * @return False if the tier cannot be used; a warning says why.
+ */
+bool quicpro_cdn_disk_open(const char *dir);
+
+/** @brief Largest body the tier keeps: a segment's worth, less its head. */
+uint64_t quicpro_cdn_disk_max_object(void);
+
+/**
+ * @brief Looks the key up. With `allow_stale`, an expired object is
+ * returned as well.
+ */
+bool quicpro_cdn_disk_lookup(const char *key, size_t key_len, uint64_t hash, bool allow_stale, quicpro_cdn_disk_hit_t *hit);
+
+/** @brief Reads a hit's whole body into `out` (body_len bytes), decrypting it if sealed. */
+bool quicpro_cdn_disk_read_body(const quicpro_cdn_disk_hit_t *hit, char *out);
+
+/**
+ * @brief A reader of the body of `body_len` bytes at `body_offset`,
+ * sealed with `seal` and `salt`. NULL without the key.
+ */
+quicpro_at_rest_reader_t *quicpro_cdn_disk_unseal(quicpro_at_rest_alg_t seal, uint64_t body_offset, uint64_t body_len,
+                                                 const uint8_t *salt);
+
+/** @brief Frees a hit's head and closes its descriptor. */
+void quicpro_cdn_disk_hit_free(quicpro_cdn_disk_hit_t *hit);
+
+/** @brief Appends an object, replacing the key's previous one. */
+void quicpro_cdn_disk_store(const char *key, size_t key_len, uint64_t hash, uint16_t status,
+                            const char *h1, size_t h1_len, const char *body, size_t body_len, uint64_t expires_ms);
+
+/** @brief Flushes the index and closes the tier (MSHUTDOWN). */
+void quicpro_cdn_disk_close(void);
+
+#endif /* QUICPRO_SERVER_CDN_DISK_H */
@@ -0,0 +1,67 @@
+/*
+ * include/server/cert_store.h – SNI-keyed certificate store for the TCP listeners
+ * ================================================================================
+ *
+ * A gateway serving thousands of customer domains cannot load every
+ * certificate at startup, nor build a context per domain per listener.
+ * With `quicpro.tls_cert_store_dir` set, the HTTP/1 and HTTP/2 listeners
+ * pick the certificate by the client's SNI from that directory:
+ *
+ *     <dir>/<host>.crt   leaf first, then its chain (PEM)
+ *     <dir>/<host>.key   the private key (PEM)
+ *
+ * A host without files of its own falls back to `_.<parent>.crt/.key`,
+ * the wildcard for its parent domain, and then to the listener's default
+ * certificate. Host names are lower-cased and must consist of letters,
+ * digits, '-' and '.', so a name never leaves the directory.
+ *
+ * A certificate is read and parsed on the first handshake that names its
+ * host; every later handshake, on any listener of the process, shares the
+ * parsed chain and key. Up to `quicpro.tls_cert_store_hot_size` of them
+ * stay in an LRU; hosts without a certificate are remembered as well, so
+ * scanners do not hit the disk on every handshake. An entry is checked
+ * against its files once a minute, or on the next use after
+ * quicpro_cert_store_expire(), which picks up renewed certificates.
+ *
+ * The listeners' default certificates are parsed once per process too,
+ * keyed by their paths.
+ *
+ * The store is safe to use from the handshake threads of
+ * server/tls_offload.h and never calls into the Zend engine there. QUIC
+ * listeners keep the one certificate of their Config: quiche's C API
+ * offers no certificate selection by SNI.
+ */
+
+#ifndef QUICPRO_SERVER_CERT_STORE_H
+#define QUICPRO_SERVER_CERT_STORE_H
+
+#include <stdbool.h>
+
+#include <openssl/ssl.h>
+
+/**
+ * @brief Loads a listener's default certificate chain and key into `ctx`,
+ * parsing the files only the first time the process sees them.
+ * @return false if they do not load as a matching chain and key.
+ */
+bool quicpro_cert_store_use_files(SSL_CTX *ctx, const char *cert_file, const char *key_file);
+
+/**
+ * @brief Parses the chain and key into the store, or finds them there.
+ * @return false if they do not load as a matching chain and key.
+ */
+bool quicpro_cert_store_check_files(const char *cert_file, const char *key_file);
+
+/** @brief Makes every entry check its files on its next use (server/cert_watch.h). */
+void quicpro_cert_store_expire(void);
+
+/** @brief Selects certificates by SNI from the store on `ctx`'s handshakes; a no-op without a store directory. */
+void quicpro_cert_store_install(SSL_CTX *ctx);
+
+/** @brief Whether `quicpro.tls_cert_store_dir` is set. */
+bool quicpro_cert_store_enabled(void);
+
+/** @brief Frees every cached certificate (MSHUTDOWN). */
+void quicpro_cert_store_mshutdown(void);
+
+#endif /* QUICPRO_SERVER_CERT_STORE_H */
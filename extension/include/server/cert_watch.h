@@ -0,0 +1,72 @@
+/*
+ * include/server/cert_watch.h – Reloading certificates when their files change
+ * =============================================================================
+ *
+ * An ACME client renews a certificate by writing new files or by pointing
+ * a symlink at them (certbot's live/ directory, a Kubernetes secret's
+ * ..data). With `quicpro.tls_cert_reload_enable`, every listener watches
+ * the directories of its certificate and key, and of
+ * `quicpro.tls_cert_store_dir`, through inotify.
+ *
+ * A change in one of them that gives the certificate or key file a new
+ * inode or mtime reloads it:
+ *
+ * - The TCP listeners load the new chain and key into their SSL_CTX.
+ * - The QUIC listeners load them into the quiche config of new
+ *   connections.
+ *
+ * The files are parsed once per process (server/cert_store.h) and must
+ * load as a matching pair before anything is swapped. A certificate
+ * written before its key is therefore picked up when the key follows.
+ * Connections that already finished their handshake keep the certificate
+ * they were served; only new handshakes see the new one.
+ *
+ * Certificates in the store directory are checked again on their next
+ * handshake.
+ *
+ * The admin API's cert_file and key_file (server/live_config.h) reach the
+ * same listeners without any file change.
+ */
+
+#ifndef QUICPRO_SERVER_CERT_WATCH_H
+#define QUICPRO_SERVER_CERT_WATCH_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include <openssl/ssl.h>
+#include <quiche.h>
+
+/** A listener's watch; the file names point into its configuration. */
+typedef struct {
+    int         fd;             /* inotify, -1 when not watching */
+    const char *cert_file;
+    const char *key_file;
+    time_t      mtime[2];       /* Certificate, key */
+    ino_t       ino[2];
+} quicpro_cert_watch_t;
+
+/** @brief Starts watching; leaves `w` inert when disabled or without files. */
+void quicpro_cert_watch_init(quicpro_cert_watch_t *w, const char *cert_file, const char *key_file);
+
+/** @brief Adds the watch to a loop's epoll set, with `w` as its data. */
+void quicpro_cert_watch_arm(quicpro_cert_watch_t *w, int epoll_fd);
+
+/**
+ * @brief Drains the pending events without blocking.
+ * @return Whether the certificate or key file was replaced since the last
+ * call.
+ */
+bool quicpro_cert_watch_changed(quicpro_cert_watch_t *w);
+
+/** @brief Loads the watched files into `ctx`; a warning keeps the previous pair. */
+bool quicpro_cert_watch_reload_ssl(quicpro_cert_watch_t *w, SSL_CTX *ctx);
+
+/** @brief Loads the watched files into `cfg`; a warning keeps the previous pair. */
+bool quicpro_cert_watch_reload_quiche(quicpro_cert_watch_t *w, quiche_config *cfg);
+
+/** @brief Stops watching. */
+void quicpro_cert_watch_close(quicpro_cert_watch_t *w);
+
+#endif /* QUICPRO_SERVER_CERT_WATCH_H */
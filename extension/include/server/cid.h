@@ -0,0 +1,91 @@
+/*
+ * include/server/cid.h – Connection-ID generation and lookup for the servers
+ * ===========================================================================
+ *
+ * Generator: ChaCha20 keystream in a per-process buffer, keyed from
+ * getrandom(). Every refill produces 16 blocks and immediately replaces the
+ * key with the first 32 bytes of output (fast key erasure), so a later
+ * memory disclosure does not reveal CIDs that were already handed out. The
+ * key is re-drawn from the kernel after fork() and every 2^20 refills. A
+ * 20-byte CID therefore costs a memcpy, not three syscalls. Issued CIDs are
+ * stamped with the cluster worker id for SO_REUSEPORT steering
+ * (server/reuseport.h).
+ *
+ * Table: open addressing over a power-of-two slot array with one control
+ * byte per slot (empty, deleted, or 7 bits of the hash), probed in groups
+ * of 16. With SSE2 a whole group's tags are compared in one instruction and
+ * only matching slots touch the key bytes. The hash is keyed with a random
+ * per-table seed so peer-chosen DCIDs cannot aim at a probe chain.
+ */
+
+#ifndef QUICPRO_SERVER_CID_H
+#define QUICPRO_SERVER_CID_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <quiche.h>
+
+/**
+ * @brief Fills `cid` with `len` random bytes and stamps the worker id.
+ * @return 0 on success, -1 if the kernel CSPRNG could not be read.
+ */
+int quicpro_cid_generate(uint8_t *cid, size_t len);
+
+/**
+ * @brief Fills `out` with `len` bytes from the same CSPRNG, without the
+ * worker stamp (tokens, nonces).
+ * @return 0 on success, -1 if the kernel CSPRNG could not be read.
+ */
+int quicpro_cid_random_bytes(uint8_t *out, size_t len);
+
+typedef struct quicpro_cid_table_s quicpro_cid_table_t;
+
+typedef void (*quicpro_cid_dtor_t)(void *value);
+
+/**
+ * @brief Creates a table sized for at least `expected` entries.
+ * @param dtor Called on values removed by quicpro_cid_table_del() or left
+ * at quicpro_cid_table_free(); may be NULL.
+ */
+quicpro_cid_table_t *quicpro_cid_table_new(size_t expected, quicpro_cid_dtor_t dtor);
+
+/**
+ * @brief Like quicpro_cid_table_new(), but on the system heap, so that a
+ * thread outside the Zend engine may own it (server/io_thread.h). Create
+ * it on the PHP thread: seeding draws from the per-process CSPRNG.
+ */
+quicpro_cid_table_t *quicpro_cid_table_new_persistent(size_t expected, quicpro_cid_dtor_t dtor);
+
+/** @brief Destroys every entry and the table. NULL-safe. */
+void quicpro_cid_table_free(quicpro_cid_table_t *t);
+
+/** @brief Returns the value stored under `cid`, or NULL. */
+void *quicpro_cid_table_find(const quicpro_cid_table_t *t, const uint8_t *cid, size_t len);
+
+/**
+ * @brief Inserts `value` under `cid` (at most QUICHE_MAX_CONN_ID_LEN bytes).
+ * @return false if the key already exists or is too long.
+ */
+bool quicpro_cid_table_add(quicpro_cid_table_t *t, const uint8_t *cid, size_t len, void *value);
+
+/**
+ * @brief Removes `cid` and runs the destructor on its value. Safe while
+ * iterating with quicpro_cid_table_next().
+ * @return false if the key was not present.
+ */
+bool quicpro_cid_table_del(quicpro_cid_table_t *t, const uint8_t *cid, size_t len);
+
+/** @brief Number of entries. */
+size_t quicpro_cid_table_count(const quicpro_cid_table_t *t);
+
+/**
+ * @brief Iterates the table. Start with `*pos = 0`; each call returns the
+ * next value (and its key, if `cid`/`len` are non-NULL) or NULL at the end.
+ * Entries may be deleted during iteration but not inserted.
+ */
+void *quicpro_cid_table_next(const quicpro_cid_table_t *t, size_t *pos,
+                             const uint8_t **cid, size_t *len);
+
+#endif /* QUICPRO_SERVER_CID_H */
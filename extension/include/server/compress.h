@@ -0,0 +1,112 @@
+/*
+ * include/server/compress.h – Response compression of the native listeners
+ * ========================================================================
+ *
+ * The HTTP/1 and HTTP/2 listeners compress a handler's response body
+ * themselves, so handlers neither send JSON uncompressed nor compress it
+ * in PHP on every request:
+ *
+ * - The coding is negotiated from the request's Accept-Encoding. Among
+ *   the codings the client accepts (q > 0, or "*"), the first one of
+ *   `quicpro.http_auto_compress` wins: "brotli" (br), "zstd" and "gzip",
+ *   each when the extension was built with its library. "none" turns
+ *   compression off.
+ * - A response is compressed when its status carries a body (not 204,
+ *   206 or 304), its Content-Type is textual (text/\*, JSON, JavaScript,
+ *   XML, SVG, and the +json / +xml types), it has no Content-Encoding
+ *   and no "Cache-Control: no-transform" of its own, and its body is at
+ *   least `quicpro.http_compress_min_length` bytes. A handler opts one
+ *   response out with `'compress' => false`. It then gets
+ *   "Content-Encoding" and "Vary: Accept-Encoding"; an eligible response
+ *   sent uncompressed still gets the Vary line.
+ * - Responses the CDN cache will keep (server/cdn_cache.h) are compressed
+ *   at the codings' maximum levels (brotli 11, zstd 19, gzip 9): the
+ *   cache keys them by the negotiated coding, so each variant of an
+ *   object is compressed once and then served as is. Everything else is
+ *   compressed at fast levels (brotli 4, zstd 3, gzip 5), where the CPU
+ *   per response stays well below the cost of the bytes it saves.
+ * - Generator bodies of the HTTP/2 listener go through a streaming
+ *   encoder, flushed after every chunk, so a client sees each chunk as
+ *   soon as the handler yields it. 'file' bodies are sent as they are,
+ *   with sendfile(); precompress static assets for those.
+ *
+ * A compressed body that is not smaller than the original is dropped and
+ * the original sent.
+ */
+
+#ifndef QUICPRO_SERVER_COMPRESS_H
+#define QUICPRO_SERVER_COMPRESS_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "server/header_template.h"
+
+typedef enum {
+    QUICPRO_CODING_IDENTITY = 0,
+    QUICPRO_CODING_GZIP,
+    QUICPRO_CODING_BR,
+    QUICPRO_CODING_ZSTD
+} quicpro_coding_t;
+
+typedef enum {
+    QUICPRO_COMPRESS_FAST,              /* Dynamic responses */
+    QUICPRO_COMPRESS_MAX                /* Responses compressed once for the cache */
+} quicpro_compress_level_t;
+
+typedef struct quicpro_compress_stream_s quicpro_compress_stream_t;
+
+/** @brief Whether `quicpro.http_auto_compress` names a coding this build has. */
+bool quicpro_compress_enabled(void);
+
+/**
+ * @brief The coding for a request's Accept-Encoding value (NULL when the
+ * request has none): QUICPRO_CODING_IDENTITY if no configured one is
+ * acceptable.
+ */
+quicpro_coding_t quicpro_compress_negotiate(const char *accept_encoding, size_t len);
+
+/** @brief The coding's Content-Encoding token, NULL for identity. */
+const char *quicpro_coding_name(quicpro_coding_t coding, size_t *len);
+
+/**
+ * @brief Whether a response with this status and these headers (the
+ * template's, then the handler's) may be compressed. Says nothing about
+ * its body's length.
+ */
+bool quicpro_compress_eligible(long status, const quicpro_header_template_t *tmpl, HashTable *headers);
+
+/** @brief Whether a body of `len` bytes is long enough to be worth compressing. */
+bool quicpro_compress_worth(size_t len);
+
+/**
+ * @brief Applies the rules above to a handler's whole body: replaces
+ * `*body` with its encoding if the response qualifies and encoding saves
+ * bytes. `*coding` is the negotiated coding on entry and the one applied
+ * on return, identity if none was.
+ * @return Whether the response varies on Accept-Encoding.
+ */
+bool quicpro_compress_response(quicpro_coding_t *coding, quicpro_compress_level_t level, long status,
+                               const quicpro_header_template_t *tmpl, HashTable *headers, zend_string **body);
+
+/**
+ * @brief Compresses a whole body.
+ * @return The encoded body, or NULL if encoding failed or saved nothing.
+ */
+zend_string *quicpro_compress(quicpro_coding_t coding, quicpro_compress_level_t level, const char *data, size_t len);
+
+/** @brief Starts a streaming encoder; NULL for identity or on failure. */
+quicpro_compress_stream_t *quicpro_compress_stream_new(quicpro_coding_t coding, quicpro_compress_level_t level);
+
+/**
+ * @brief Encodes the next chunk and flushes it, or finishes the stream
+ * with `finish` (`len` may then be 0).
+ * @return The bytes to send, possibly empty; NULL if the encoder failed.
+ */
+zend_string *quicpro_compress_stream_write(quicpro_compress_stream_t *s, const char *data, size_t len, bool finish);
+
+/** @brief Frees an encoder, finished or not. */
+void quicpro_compress_stream_free(quicpro_compress_stream_t *s);
+
+#endif /* QUICPRO_SERVER_COMPRESS_H */
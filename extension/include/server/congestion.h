@@ -0,0 +1,93 @@
+/*
+ * include/server/congestion.h – Congestion control profiles and warm starts
+ * =========================================================================
+ *
+ * A profile names a congestion controller and its start-up settings:
+ *
+ *   default        quicpro.transport_cc_algorithm, _cc_initial_cwnd_packets
+ *                  and _cc_enable_hystart_plus_plus, as php.ini sets them
+ *   interactive    CUBIC with HyStart++, the ini's initial window: short
+ *                  request/response exchanges, low queueing delay
+ *   bulk           BBRv2, a 64-packet initial window: object store and
+ *                  CDN transfers, where throughput matters and losses
+ *                  are not congestion
+ *   conservative   Reno, a 10-packet initial window (RFC 9002 §7.2)
+ *
+ * A listener picks one with the Config option 'cc_profile', a client
+ * connection with the connect option 'cc_profile'; without one, the
+ * default profile applies.
+ *
+ * Warm starts. When a connection closes, the bandwidth-delay product it
+ * measured (delivery rate × min RTT, or its last cwnd) and its min RTT
+ * are stored for the peer's prefix: /24 for IPv4, /56 for IPv6. The next
+ * connection to that prefix within QUICPRO_CC_CACHE_TTL_MS starts with
+ * its initial window at the stored BDP, never below the profile's and
+ * never above QUICPRO_CC_WARM_MAX_PACKETS, instead of slow-starting
+ * from the profile's window. The table is per process and direct-mapped;
+ * a colliding prefix replaces the older entry.
+ *
+ * quiche copies a config's recovery settings into each connection at
+ * quiche_connect()/quiche_accept(). The shared config is therefore set
+ * right before each of them, as the connection snapshot's CIDs already
+ * are (server/conn_snapshot.h); no per-connection config is needed. On a
+ * listener only the initial window changes per connection: the algorithm
+ * stays what the profile or the live configuration (server/live_config.h)
+ * set.
+ */
+
+#ifndef QUICPRO_SERVER_CONGESTION_H
+#define QUICPRO_SERVER_CONGESTION_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <quiche.h>
+
+#include "client/session.h"
+
+#define QUICPRO_CC_NAME_MAX           16
+#define QUICPRO_CC_CACHE_SLOTS        512
+#define QUICPRO_CC_CACHE_TTL_MS       600000   /* Paths change; ten minutes */
+#define QUICPRO_CC_WARM_MAX_PACKETS   1024
+#define QUICPRO_CC_LEARN_MIN_PACKETS  32       /* Shorter connections never left slow start */
+
+typedef struct {
+    char     algorithm[QUICPRO_CC_NAME_MAX];   /* quiche's name: "cubic", "reno", "bbr", "bbr2" */
+    uint32_t initial_cwnd_packets;
+    bool     hystart;
+} quicpro_cc_profile_t;
+
+/**
+ * @brief Resolves the profile `name` (NULL or "" for default) into `out`.
+ * @return false if there is no such profile; `out` is unchanged then.
+ */
+bool quicpro_cc_profile_lookup(const char *name, size_t len, quicpro_cc_profile_t *out);
+
+/** @brief Sets the profile's algorithm, initial window and HyStart++ on `q`. */
+void quicpro_cc_profile_apply(quiche_config *q, const quicpro_cc_profile_t *p);
+
+/**
+ * @brief Sets `q`'s initial window for a connection to `peer`: the BDP
+ * learned for its prefix, or the profile's window. Call right before
+ * quiche_connect() or quiche_accept().
+ */
+void quicpro_cc_warm_start(quiche_config *q, const quicpro_cc_profile_t *p, const struct sockaddr *peer);
+
+/**
+ * @brief Stores what `s`'s connection learned about its peer's path.
+ * Called as the session is released; ignores connections that never
+ * completed the handshake or sent too little to leave slow start.
+ */
+void quicpro_cc_cache_learn(const quicpro_session_t *s);
+
+/**
+ * @brief quicpro_cc_peer_estimate(string $ip): ?array
+ * The stored estimate for `$ip`'s prefix: ['cwnd_packets', 'min_rtt_us',
+ * 'age_ms'], or null if there is none, or it expired.
+ */
+PHP_FUNCTION(quicpro_cc_peer_estimate);
+
+#endif /* QUICPRO_SERVER_CONGESTION_H */
@@ -0,0 +1,82 @@
+/*
+ * include/server/conn_snapshot.h – Connection snapshots for crash recovery
+ * ========================================================================
+ *
+ * A worker that crashes takes its connections' keys with it. Its
+ * replacement then receives short-header packets for connection IDs it has
+ * never seen. Without help it drops them, and every client waits out its
+ * idle timeout (often 30 s or more) before reconnecting.
+ *
+ * With the cluster option 'connection_snapshot_capacity', the master maps
+ * one region per worker slot and generation parity before forking. Every
+ * 'connection_snapshot_interval_ms' a worker overwrites its region with
+ * the routing state of its live connections: the connection ID it issued
+ * and the peer's address. Its replacement takes over the region when it
+ * attaches, before the first overwrite. A short-header packet for one of
+ * those IDs from the recorded address is answered with a stateless reset
+ * (RFC 9000, 10.3), and the client closes at once instead of timing out.
+ *
+ * A stateless reset is only accepted with its connection's token, which
+ * the server sends in the handshake. The tokens are an HMAC of the
+ * connection ID under a key the master draws, so any worker can compute
+ * the token of any connection after the fact.
+ *
+ * Resumption tickets are not part of the snapshot. The client keeps its
+ * ticket, and the ticket keys and the 0-RTT anti-replay store are shared
+ * by the whole cluster (ticket_keys.h, zero_rtt.h). The reconnect that
+ * follows the reset can therefore resume with 0-RTT at any worker.
+ */
+
+#ifndef QUICPRO_SERVER_CONN_SNAPSHOT_H
+#define QUICPRO_SERVER_CONN_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "quiche.h"
+#include "server/cid.h"
+
+/**
+ * @brief In the master, before forking: maps `capacity` entries for each
+ * of `nslots` slots and both generation parities, and draws the reset key.
+ */
+void quicpro_conn_snapshot_prepare(int nslots, int capacity, int interval_ms);
+
+/** @brief Unmaps the regions of quicpro_conn_snapshot_prepare(). */
+void quicpro_conn_snapshot_release(void);
+
+/**
+ * @brief In the forked worker: takes over what the previous worker of this
+ * slot and parity left in the region; a worker that exited cleanly left it
+ * empty.
+ */
+void quicpro_conn_snapshot_attach_worker(int worker_id, unsigned generation);
+
+/**
+ * @brief Before quiche_accept(): has `config` advertise the stateless reset
+ * token of `scid`. A no-op outside a cluster with snapshots.
+ */
+void quicpro_conn_snapshot_advertise(quiche_config *config, const uint8_t *scid, size_t scid_len);
+
+/**
+ * @brief For a packet no session claims: when it is a short-header packet
+ * for a predecessor's connection from that connection's peer, sends a
+ * stateless reset on `fd`.
+ * @return true if the packet was answered that way and is to be dropped.
+ */
+bool quicpro_conn_snapshot_reset(int fd, const uint8_t *pkt, size_t len, const uint8_t *dcid, size_t dcid_len,
+                                 const struct sockaddr *peer, socklen_t peer_len);
+
+/**
+ * @brief Once per loop iteration: when the interval has passed, writes the
+ * sessions of `sessions_by_scid` (quicpro_session_t values) to this
+ * worker's region.
+ */
+void quicpro_conn_snapshot_tick(const quicpro_cid_table_t *sessions_by_scid);
+
+/** @brief When the listener stops: empties this worker's region. */
+void quicpro_conn_snapshot_clear(void);
+
+#endif /* QUICPRO_SERVER_CONN_SNAPSHOT_H */
@@ -0,0 +1,71 @@
+/*
+ * include/server/conn_stats.h – Transport stats of every connection at once
+ * =========================================================================
+ *
+ * quicpro_get_stats() (server/tls.c) reports one session per call. That is
+ * fine for a single connection, but watching a worker with 50k of them
+ * takes 50k calls and 50k small hash tables. These calls read
+ * quiche_conn_stats() and the active path's quiche_conn_path_stats() for
+ * every connection of a listener or reactor in one pass. They return the
+ * result column by column: each field is one packed array with one entry
+ * per connection, and entry i of every column is the same connection.
+ *
+ *   [ 'count' => n,
+ *     'scid'  => [hex, ...],   'peer' => ['ip:port', ...],
+ *     'rtt_ns' => [...], 'min_rtt_ns' => [...], 'rttvar_ns' => [...],
+ *     'cwnd' => [...], 'delivery_rate' => [...], 'pmtu' => [...],
+ *     'pkt_rx' => [...], 'pkt_tx' => [...], 'lost' => [...], 'retrans' => [...],
+ *     'bytes_rx' => [...], 'bytes_tx' => [...], 'bytes_lost' => [...],
+ *     'streams_readable' => [...], 'streams_writable' => [...],
+ *     'established' => [bool, ...] ]
+ *
+ * The server loops register their session table while they run, so a
+ * request handler (a /connections route, say) can report on the
+ * listener it runs in. Computing the stats costs nothing until someone
+ * asks for them.
+ */
+
+#ifndef QUICPRO_SERVER_CONN_STATS_H
+#define QUICPRO_SERVER_CONN_STATS_H
+
+#include <php.h>
+#include <stddef.h>
+
+#include "client/session.h"
+#include "server/cid.h"
+
+/* The column arrays of one result, see the file comment */
+typedef struct {
+    zval scid, peer;
+    zval rtt, min_rtt, rttvar, cwnd, delivery_rate, pmtu;
+    zval pkt_rx, pkt_tx, lost, retrans;
+    zval bytes_rx, bytes_tx, bytes_lost;
+    zval streams_readable, streams_writable;
+    zval established;
+    zend_long count;
+} quicpro_conn_stats_columns_t;
+
+/** @brief Starts empty columns with room for `hint` connections. */
+void quicpro_conn_stats_begin(quicpro_conn_stats_columns_t *cols, size_t hint);
+
+/** @brief Appends the stats of `s` as the next entry of every column. */
+void quicpro_conn_stats_add(quicpro_conn_stats_columns_t *cols, const quicpro_session_t *s);
+
+/** @brief Moves the columns and their 'count' into the array `rv`. */
+void quicpro_conn_stats_end(zval *rv, quicpro_conn_stats_columns_t *cols);
+
+/**
+ * @brief A server loop's sessions (quicpro_session_t values) while it
+ * runs; NULL once it stops.
+ */
+void quicpro_conn_stats_bind(const quicpro_cid_table_t *sessions_by_scid);
+
+/*
+ * PHP_FUNCTION(quicpro_server_connection_stats)
+ * array Quicpro\Server::connectionStats()
+ * The stats of every connection of the listener running in this process.
+ * Returns a result with a 'count' of 0 outside a listener.
+ */
+PHP_FUNCTION(quicpro_server_connection_stats);
+
+#endif /* QUICPRO_SERVER_CONN_STATS_H */
@@ -1,46 +1,94 @@
-/* extension/include/server/cors.h */
+/*
+ * include/server/cors.h – Compiled CORS origin policy
+ * ===================================================
+ *
+ * security_cors_allowed_origins is "*" or a comma-separated list of
+ * origins. An entry is either exact ("https://app.example.com:8443") or a
+ * subdomain wildcard, whose host is "*.example.com": it matches any host
+ * at least one label below example.com, with the entry's scheme and port.
+ *
+ * The list is compiled once into an immutable policy:
+ *
+ * - exact origins go into an open-addressed hash set, sized to a load of
+ *   at most one half, so a lookup is one hash and usually one compare;
+ * - wildcard domains go into a trie of host labels taken from the right
+ *   ("com" → "example"), children sorted for a binary search. A lookup
+ *   costs one step per label of the request's host.
+ *
+ * Each listener thread compiles the configured list when it starts and
+ * follows the snapshots of server/live_config.h afterwards: a snapshot
+ * carries its own compiled policy and is reclaimed with it.
+ *
+ * The TCP listeners ask quicpro_cors_check() for every request with an
+ * Origin header. The answer, with its header lines rendered for HTTP/1
+ * and HTTP/2, is cached per thread by (origin, method), so a repeated
+ * preflight is a hash, a compare and a copy of bytes already rendered.
+ * Preflights (OPTIONS with Access-Control-Request-Method) are answered
+ * without calling the handler: 204 with the allow headers, or 403.
+ */
 
 #ifndef QUICPRO_SERVER_CORS_H
 #define QUICPRO_SERVER_CORS_H
 
-#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <nghttp2/nghttp2.h>
+
+#define QUICPRO_CORS_ORIGIN_MAX  256    /* Longer origins are never allowed */
+#define QUICPRO_CORS_H1_MAX      (QUICPRO_CORS_ORIGIN_MAX + 224)
+#define QUICPRO_CORS_NV_MAX      5
+
+typedef struct quicpro_cors_policy_s quicpro_cors_policy_t;
+
+typedef enum {
+    QUICPRO_CORS_NONE,              /* No policy, or an origin it does not allow: add nothing */
+    QUICPRO_CORS_ALLOW,             /* Add the header lines to the handler's response */
+    QUICPRO_CORS_PREFLIGHT,         /* Answer 204 with the header lines; skip the handler */
+    QUICPRO_CORS_PREFLIGHT_DENIED   /* Answer 403; skip the handler */
+} quicpro_cors_verdict_t;
+
+typedef struct {
+    quicpro_cors_verdict_t verdict;
+    const char       *h1;           /* "name: value\r\n" lines */
+    size_t            h1_len;
+    const nghttp2_nv *nv;           /* The same lines for nghttp2 to copy */
+    size_t            nv_count;
+} quicpro_cors_result_t;
 
 /**
- * @file extension/include/server/cors.h
- * @brief Declarations for the native Cross-Origin Resource Sharing (CORS) handler.
- *
- * This header defines the internal interfaces for the C-level processing of
- * CORS requests. Instead of being exposed as a direct PHP function, the native
- * CORS handling is automatically enabled and configured via the `Quicpro\Config`
- * object passed to a server instance.
- *
- * This design ensures that CORS policies are enforced with maximum performance
- * at the lowest possible layer, handling `OPTIONS` preflight requests and adding
- * necessary `Access-Control-*` headers before the request even reaches the
- * PHP userland.
+ * @brief Compiles an origin list. Empty entries are skipped; an empty
+ * list allows no origin.
+ * @return The policy, or NULL for an entry that is no http(s) origin.
  */
+quicpro_cors_policy_t *quicpro_cors_compile(const char *origins);
+
+/** @brief Frees a policy of quicpro_cors_compile(). */
+void quicpro_cors_policy_free(quicpro_cors_policy_t *p);
+
+/** @brief Whether `p` allows `origin` (as sent, lower case). */
+bool quicpro_cors_policy_allows(const quicpro_cors_policy_t *p, const char *origin, size_t origin_len);
+
+/** @brief A listener thread starts: compiles the configured list for it. */
+void quicpro_cors_enter(void);
 
 /**
- * @brief (Internal) Applies the configured CORS policy to an incoming request.
- *
- * This function is invoked internally by the server's core request processing
- * loop for each new request. It inspects the `Origin` header and validates it
- * against the `cors_allowed_origins` policy defined in the session's
- * configuration.
- *
- * If the request is a valid CORS preflight (`OPTIONS` method), this function
- * will handle it by sending an immediate 204 No Content response with the
- * appropriate CORS headers and stopping further processing. For actual requests
- * from a permitted origin, it ensures the `Access-Control-Allow-Origin` header
- * is added to the final response.
- *
- * @param session_resource The resource of the current session/request.
- * @return An internal status flag indicating whether the request is a preflight
- * that has been handled (`CORS_PREFLIGHT_HANDLED`), is a valid CORS request
- * that can proceed (`CORS_OK`), or is a forbidden request (`CORS_FORBIDDEN`).
+ * @brief The thread answers from `p` from now on (a live configuration
+ * snapshot's policy, which outlives the thread's use); NULL returns to
+ * the list compiled by quicpro_cors_enter().
+ */
+void quicpro_cors_use(const quicpro_cors_policy_t *p);
+
+/** @brief The listener thread stops: frees its compiled list. */
+void quicpro_cors_leave(void);
+
+/**
+ * @brief The decision for a request with an Origin header. For a
+ * preflight, `method` is its Access-Control-Request-Method.
+ * @return Valid until the thread's next call.
  */
-// This function is for internal C-level use and is not exported to PHP.
-// Its behavior is controlled entirely by the `cors_allowed_origins`
-// setting in the `Quicpro\Config` object.
+const quicpro_cors_result_t *quicpro_cors_check(const char *origin, size_t origin_len,
+                                                const char *method, size_t method_len, bool preflight);
 
-#endif // QUICPRO_SERVER_CORS_H
+#endif /* QUICPRO_SERVER_CORS_H */
@@ -0,0 +1,61 @@
+/*
+ * include/server/h2_flow.h – HTTP/2 receive windows sized to the path's BDP
+ * ==========================================================================
+ *
+ * An HTTP/2 receiver lets the peer have at most one window of DATA in
+ * flight per stream, and one connection window across all streams. With
+ * RFC 7540's 64 KiB a single stream moves 64 KiB per round trip: about
+ * 2.6 Mbit/s at 200 ms, whatever the link could carry. A static window
+ * large enough for the longest path wastes memory on every short one.
+ *
+ * The receiver therefore measures the bandwidth-delay product, as gRPC
+ * does. When DATA arrives and no probe is in flight, it sends a PING and
+ * counts the DATA bytes that arrive until the PING's ACK. That count is
+ * what the peer delivered in one round trip. If it reached two thirds of
+ * the window, the window was the limit, and both windows grow to twice
+ * the count:
+ * - every stream's window through SETTINGS_INITIAL_WINDOW_SIZE, which
+ *   also applies to streams already open;
+ * - the connection window, through nghttp2_session_set_local_window_size(),
+ *   when it is smaller than that.
+ * Windows never shrink, and never exceed `quicpro.http2_max_connection_window`,
+ * the memory one connection may have buffered from its peer. Once the cap
+ * is reached no more probes are sent. `quicpro.http2_window_autotune_enable`
+ * turns the tuning off, leaving the static windows.
+ *
+ * Used by the HTTP/2 server (server/http2.c) for what clients send, and by
+ * the HTTP/2 client (client/http2.c) for what it downloads.
+ */
+
+#ifndef QUICPRO_SERVER_H2_FLOW_H
+#define QUICPRO_SERVER_H2_FLOW_H
+
+#include <nghttp2/nghttp2.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    uint64_t probe_sent_us;   /* 0: no PING in flight */
+    uint64_t probe_bytes;     /* DATA received since the PING went out */
+    int32_t  window;          /* Current stream window */
+    int32_t  conn_window;
+    uint32_t seq;             /* Tags our PINGs apart from the peer's */
+} quicpro_h2_flow_t;
+
+/**
+ * @brief Starts tracking a session with the stream and connection windows
+ * it announced to its peer.
+ */
+void quicpro_h2_flow_init(quicpro_h2_flow_t *f, int32_t window, int32_t conn_window);
+
+/** @brief Counts `len` DATA bytes received, and starts a probe if none is in flight. */
+void quicpro_h2_flow_on_data(quicpro_h2_flow_t *f, nghttp2_session *session, size_t len);
+
+/**
+ * @brief Feeds a received frame. A PING ACK of our probe completes the
+ * sample and may widen the windows.
+ * @return Whether the frame was the ACK of our probe.
+ */
+bool quicpro_h2_flow_on_frame(quicpro_h2_flow_t *f, nghttp2_session *session, const nghttp2_frame *frame);
+
+#endif /* QUICPRO_SERVER_H2_FLOW_H */
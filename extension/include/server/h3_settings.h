@@ -0,0 +1,35 @@
+/*
+ * include/server/h3_settings.h – HTTP/3 SETTINGS from the quicpro.h3_* directives
+ * ===============================================================================
+ *
+ * Every HTTP/3 connection, client or server, gets its quiche_h3_config
+ * through quicpro_h3_settings_apply(), so the SETTINGS frame it sends
+ * reflects the configuration instead of quiche's defaults:
+ *
+ * - SETTINGS_MAX_FIELD_SECTION_SIZE from `quicpro.h3_max_header_list_size`.
+ *   quiche rejects larger header sections from the peer, and the peer is
+ *   told not to send them.
+ * - SETTINGS_QPACK_MAX_TABLE_CAPACITY and SETTINGS_QPACK_BLOCKED_STREAMS
+ *   as 0. quiche encodes field sections with the static table and
+ *   Huffman-coded literals, and its decoder rejects dynamic table
+ *   references. Announcing `quicpro.h3_qpack_max_table_capacity` would
+ *   invite the peer's encoder to insert entries, and fail the first
+ *   request that references one with QPACK_DECOMPRESSION_FAILED. The
+ *   QPACK directives take effect once the HTTP/3 stack has a dynamic
+ *   table; until then 0 is the capacity the decoder can honour.
+ *
+ * Repeated response headers are cheapest through header templates
+ * (include/server/header_template.h): their names are lower-case, so
+ * quiche finds static-table matches such as "content-type:
+ * application/json" and sends them as one or two bytes.
+ */
+
+#ifndef QUICPRO_SERVER_H3_SETTINGS_H
+#define QUICPRO_SERVER_H3_SETTINGS_H
+
+#include <quiche.h>
+
+/** @brief Applies the quicpro.h3_* directives to a fresh HTTP/3 config. */
+void quicpro_h3_settings_apply(quiche_h3_config *cfg);
+
+#endif /* QUICPRO_SERVER_H3_SETTINGS_H */
@@ -0,0 +1,74 @@
+/*
+ * include/server/header_template.h – Response header templates and header name interning
+ * ======================================================================================
+ *
+ * Most responses of an application share a handful of header sets: the
+ * content type, cache policy, CORS and server headers of an API, or of
+ * its static assets. quicpro_header_template_register() takes such a set
+ * once, validates it, and keeps it in every wire form the listeners need:
+ *
+ * - HTTP/1: one pre-rendered "name: value\r\n" block, gathered into the
+ *   response head as a single piece.
+ * - HTTP/2: an nghttp2_nv array flagged NO_COPY_NAME | NO_COPY_VALUE.
+ *   nghttp2 indexes the entries in the connection's HPACK dynamic table,
+ *   so from the second response on each costs a one-byte index.
+ * - HTTP/3: a quiche_h3_header array, for early hints and later for
+ *   responses.
+ *
+ * A handler names the template in its response (`'template' => 'api'`)
+ * and can still add per-response `'headers'`. Templates are process-wide
+ * and immutable: a name cannot be registered twice, because listeners
+ * send from the stored bytes without copying them.
+ *
+ * Request header names become interned strings. About a hundred common
+ * names are interned at MINIT. The listeners build request arrays with
+ * those keys, which skips an allocation and a hash per header.
+ */
+
+#ifndef QUICPRO_SERVER_HEADER_TEMPLATE_H
+#define QUICPRO_SERVER_HEADER_TEMPLATE_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <nghttp2/nghttp2.h>
+#include <quiche.h>
+
+typedef struct {
+    zend_string       *name;       /* Persistent */
+    size_t             count;
+    nghttp2_nv        *nv;
+    quiche_h3_header  *h3;
+    char              *h1;         /* "name: value\r\n" * count */
+    size_t             h1_len;
+    bool               has_content_type;
+} quicpro_header_template_t;
+
+/** @brief Interns the well-known header names (MINIT). */
+void quicpro_header_names_minit(void);
+
+/** @brief Frees the registered templates and the name table (MSHUTDOWN). */
+void quicpro_header_templates_mshutdown(void);
+
+/**
+ * @brief Returns a key for a request header name, lower-cased. Well-known
+ * names come back as interned strings, other names as fresh strings.
+ * Release the result with zend_string_release() either way.
+ */
+zend_string *quicpro_header_name(const char *name, size_t len);
+
+/** @brief Finds a registered template; NULL if there is none of that name. */
+const quicpro_header_template_t *quicpro_header_template_find(const char *name, size_t len);
+
+/**
+ * @brief Whether a response header may be sent as given. It checks for
+ * RFC 9110 token characters in the name and no CR, LF or NUL in the
+ * value. Framing and connection headers the listeners set themselves are
+ * refused.
+ */
+bool quicpro_header_is_sendable(const char *name, size_t name_len, const char *value, size_t value_len);
+
+PHP_FUNCTION(quicpro_header_template_register);
+
+#endif /* QUICPRO_SERVER_HEADER_TEMPLATE_H */
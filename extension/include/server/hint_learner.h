@@ -0,0 +1,72 @@
+/*
+ * include/server/hint_learner.h – 103 Early Hints learned from responses
+ * ======================================================================
+ *
+ * quicpro_server_send_early_hints() needs the handler to send its hints,
+ * which it can only do once it is running. A handler that takes 100 ms
+ * to build a page still carries the same preload links in nearly every
+ * response, though. The HTTP/1 and HTTP/2 listeners can therefore learn
+ * those links and send the 103 themselves, as soon as the request
+ * arrives and before the handler is called. The browser then fetches
+ * the page's stylesheets, scripts and fonts while the handler runs.
+ *
+ * - Every 2xx answer to a GET is observed: the Link entries of its
+ *   template and of its 'headers' whose rel is preload, modulepreload or
+ *   preconnect. Up to 8 distinct links are tracked per route, the request's
+ *   authority and path without the query.
+ * - A link is hinted once the route has answered at least 3 times and
+ *   the link was in at least half of those answers. Counts are halved
+ *   every 32 answers, so a link a deploy removed stops being hinted
+ *   within a few dozen requests.
+ * - HTTP/1 answers from the CDN cache (server/cdn_cache.h) go out at once
+ *   and get no hints. HTTP/2 sends the 103 before the cache lookup:
+ *   nghttp2 cannot send from inside its callbacks, so a hinted stream's
+ *   handler runs once the read is processed and its 103 written.
+ * - HTTP/1.0 clients get no 103. Neither does HTTP/3: its handlers
+ *   answer through quicpro_server_send_early_hints() themselves.
+ *
+ * `quicpro.http_early_hints_auto` turns learning on, together with
+ * `quicpro.http_enable_early_hints`. Hints are only ever a suggestion: a
+ * link hinted wrongly costs the client one needless fetch.
+ *
+ * Like the Alt-Svc cache (client/alt_svc.h), routes live in process
+ * memory, so each worker learns on its own.
+ */
+
+#ifndef QUICPRO_SERVER_HINT_LEARNER_H
+#define QUICPRO_SERVER_HINT_LEARNER_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "server/header_template.h"
+
+/** The links currently hinted for a route, in two wire forms. */
+typedef struct {
+    size_t        count;
+    zend_string **links;    /* Link values, persistent */
+    zend_string  *h1;       /* The whole HTTP/1.1 103 response */
+} quicpro_learned_hints_t;
+
+/** @brief Whether the listeners learn and send hints. */
+bool quicpro_hint_learner_enabled(void);
+
+/**
+ * @brief The hints for a GET of `path` on `authority`, or NULL when none
+ * are learned yet. Valid until the next quicpro_hint_learner_observe().
+ */
+const quicpro_learned_hints_t *quicpro_hint_learner_lookup(const char *authority, size_t authority_len,
+                                                            const char *path, size_t path_len);
+
+/**
+ * @brief Feeds the final response to a GET of `path` on `authority`: its
+ * status, its template and the handler's 'headers' (either may be NULL).
+ */
+void quicpro_hint_learner_observe(const char *authority, size_t authority_len, const char *path, size_t path_len,
+                                  long status, const quicpro_header_template_t *tmpl, HashTable *headers);
+
+/** @brief Frees the learned routes (MSHUTDOWN). */
+void quicpro_hint_learner_mshutdown(void);
+
+#endif /* QUICPRO_SERVER_HINT_LEARNER_H */
@@ -0,0 +1,43 @@
+/*
+ * include/server/http1_head.h – Pre-rendered HTTP/1.1 response heads
+ * ===================================================================
+ *
+ * The HTTP/1 listener's response heads are assembled from constant
+ * pieces: a status line rendered at compile time for every common code,
+ * a Date header rendered once per second, and a Connection header chosen
+ * from three literals. Only Content-Length is formatted per response. The
+ * head goes into a small buffer inside the connection, so answering a
+ * request allocates nothing.
+ */
+
+#ifndef QUICPRO_SERVER_HTTP1_HEAD_H
+#define QUICPRO_SERVER_HTTP1_HEAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define QUICPRO_H1_HEAD_MAX 192
+
+typedef enum {
+    QUICPRO_H1_CONN_IMPLIED,     /* HTTP/1.1 keep-alive: no header */
+    QUICPRO_H1_CONN_CLOSE,
+    QUICPRO_H1_CONN_KEEP_ALIVE   /* HTTP/1.0 client that asked for it */
+} quicpro_h1_conn_t;
+
+/**
+ * @brief Renders the status line, Date, Content-Length, Connection and
+ * the terminating empty line into `out` (QUICPRO_H1_HEAD_MAX bytes).
+ * @return The head's length.
+ */
+size_t quicpro_h1_head_render(char *out, long status, uint64_t content_length, quicpro_h1_conn_t conn);
+
+/** @brief Renders the interim "100 Continue" response. */
+size_t quicpro_h1_head_continue(char *out);
+
+/**
+ * @brief The current time as an IMF-fixdate (RFC 9110 §5.6.7), refreshed
+ * at most once per second.
+ */
+const char *quicpro_http_date(size_t *len);
+
+#endif /* QUICPRO_SERVER_HTTP1_HEAD_H */
@@ -0,0 +1,91 @@
+/*
+ * include/server/http1_parser.h – Incremental HTTP/1.1 request parser
+ * ===================================================================
+ *
+ * A picohttpparser-style parser for the HTTP/1 listener. It never copies.
+ * Method, target and headers are views into the caller's read buffer, and
+ * stay valid until the caller moves or frees that buffer.
+ *
+ * It is incremental in the way that matters for a socket. Each call is
+ * given the whole buffer plus how much of it the previous call already
+ * saw, and only the new bytes are scanned for the end of the header
+ * block. The block is then parsed in a single pass. Header values are
+ * scanned 16 bytes at a time with SSE4.2 when the compiler targets it.
+ *
+ * Message framing follows RFC 9112 §6. A request with both
+ * Transfer-Encoding and Content-Length, or with a transfer coding other
+ * than a final "chunked", is rejected rather than guessed at. Chunked
+ * bodies are decoded in place by quicpro_h1_decode_chunked().
+ */
+
+#ifndef QUICPRO_SERVER_HTTP1_PARSER_H
+#define QUICPRO_SERVER_HTTP1_PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define QUICPRO_H1_MAX_HEADERS 64
+
+/* Return values of the parse and decode calls besides a length */
+#define QUICPRO_H1_ERROR      (-1)
+#define QUICPRO_H1_INCOMPLETE (-2)
+#define QUICPRO_H1_TOO_MANY   (-3)   /* More than QUICPRO_H1_MAX_HEADERS headers */
+#define QUICPRO_H1_BAD_TE     (-4)   /* A transfer coding we do not implement */
+
+typedef struct {
+    const char *name;
+    size_t      name_len;
+    const char *value;
+    size_t      value_len;
+} quicpro_h1_header_t;
+
+typedef struct {
+    const char         *method;
+    size_t              method_len;
+    const char         *target;
+    size_t              target_len;
+    int                 minor_version;
+    quicpro_h1_header_t headers[QUICPRO_H1_MAX_HEADERS];
+    size_t              num_headers;
+
+    /* Framing, derived from the headers */
+    bool                keep_alive;
+    bool                chunked;
+    bool                expect_continue;
+    uint64_t            content_length;   /* 0 unless given; unused when chunked */
+} quicpro_h1_request_t;
+
+/** Chunked body decoder state; zero-initialise before the first call. */
+typedef struct {
+    uint64_t bytes_left;
+    int      hex_count;
+    int      state;
+} quicpro_h1_chunked_t;
+
+/**
+ * @brief Parses the request head at the start of `buf`.
+ * @param last_len bytes of `buf` a previous call already saw (0 at first).
+ * @return The length of the head (request line and headers, including the
+ * empty line) once complete; QUICPRO_H1_INCOMPLETE, QUICPRO_H1_ERROR,
+ * QUICPRO_H1_TOO_MANY or QUICPRO_H1_BAD_TE otherwise.
+ */
+ssize_t quicpro_h1_parse_request(const char *buf, size_t len, size_t last_len, quicpro_h1_request_t *req);
+
+/**
+ * @brief Decodes chunked data in place.
+ *
+ * On entry `*len` bytes of encoded data start at `buf`. On return the
+ * decoded bytes are at the start of `buf` and `*len` is their count.
+ * @return QUICPRO_H1_INCOMPLETE if the body has not ended yet (all input
+ * was consumed), QUICPRO_H1_ERROR on malformed input, otherwise the number
+ * of bytes that followed the body. Those bytes were moved to directly
+ * after the decoded data and are the start of the next request.
+ */
+ssize_t quicpro_h1_decode_chunked(quicpro_h1_chunked_t *d, char *buf, size_t *len);
+
+/** @brief Case-insensitive comparison of a header name view with a literal. */
+bool quicpro_h1_name_is(const quicpro_h1_header_t *h, const char *lower, size_t lower_len);
+
+#endif /* QUICPRO_SERVER_HTTP1_PARSER_H */
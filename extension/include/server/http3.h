@@ -37,7 +37,10 @@
  * specify 'h3' in its `alpn` list. QUIC-specific transport parameters
  * can also be provided here.
  * @param request_handler_callable A unified PHP callable that will be invoked for each
- * incoming HTTP/3 request.
+ * incoming HTTP/3 request as `handler($session, int $streamId, bool $early)`.
+ * `$early` is true only for 0-RTT streams offered before the handshake
+ * completed (see include/server/zero_rtt.h); a handler that leaves such a
+ * stream unread gets it again with `$early = false`.
  * @return TRUE on successful server initialization.
  * FALSE on failure, throwing a `Quicpro\Exception\ServerException` or a
  * more specific exception (e.g., `Quicpro\Exception\QuicException`) if
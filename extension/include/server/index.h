@@ -60,6 +60,8 @@
  * that will be invoked for every incoming HTTP request, regardless of its
  * protocol (HTTP/1.1, HTTP/2, HTTP/3). This callable must be capable of
  * processing the request details and returning a valid HTTP response.
+ * QUIC streams are passed as `handler($session, int $streamId, bool $early)`,
+ * see include/server/http3.h for the meaning of `$early`.
  * This parameter is mandatory.
  * @return TRUE on successful server initialization and commencement of listening
  * across all configured protocols.
@@ -70,4 +72,26 @@
  */
 PHP_FUNCTION(quicpro_server_listen);
 
+/**
+ * @brief Replays a recorded trace through a created server, in process.
+ *
+ * Runs the same datagram handler and stream loop as quicpro_server_listen(),
+ * fed by in-process QUIC clients that resend the trace's request streams
+ * instead of by the socket; see include/server/replay.h for the trace
+ * format, how to record one and the options. It returns once every
+ * connection of the trace has closed, so the same trace and build give the
+ * same work, free of network and client noise, to profile or to compare
+ * with another build.
+ *
+ * @param handler As for quicpro_server_listen().
+ * @param trace Path of the trace file.
+ * @param options 'speed', 'loops', 'max_connections', 'timeout_ms',
+ * 'alpn' and 'server_name'.
+ * @return The replay's counts (connections, failed, requests, responses,
+ * resets, bytes and datagrams each way), elapsed_ms, cpu_user_ms,
+ * cpu_sys_ms, rps and latency_us (p50, p90, p99, p99.9, max), or nothing
+ * with the exception when the trace or the handler throws.
+ */
+PHP_FUNCTION(quicpro_server_replay);
+
 #endif // QUICPRO_SERVER_INDEX_H
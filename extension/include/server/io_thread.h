@@ -0,0 +1,130 @@
+/*
+ * include/server/io_thread.h – A transport thread for the HTTP/3 listener
+ * =======================================================================
+ *
+ * The HTTP/3 listener normally runs its epoll loop on the thread that
+ * executes the PHP handlers. While a handler runs, nothing reads the
+ * socket. ACKs go out late, quiche's loss and idle timers fire late, and
+ * every other connection of the worker waits as well.
+ *
+ * With `quicpro.io_thread_split` the listener starts a native I/O thread
+ * that owns the socket. It is pinned to `quicpro.io_thread_cpu_affinity`
+ * and never enters the Zend engine, so it runs under NTS and ZTS builds
+ * alike.
+ *
+ * - The I/O thread reads every datagram. Datagrams of known connections
+ *   go straight to quiche. Their timers are run and their packets sent,
+ *   as the listener loop would.
+ * - Datagrams the I/O thread cannot take go to the PHP thread through a
+ *   single-producer/single-consumer ring. Those are datagrams opening new
+ *   connections (Retry, rate limits and accepting stay where they were)
+ *   and datagrams of connections the PHP thread holds at that moment.
+ *   An eventfd wakes the PHP thread's loop. The PHP thread dispatches
+ *   streams to handlers, flushes MCP answers and closes connections
+ *   as before.
+ * - New connections are handed to the I/O thread through a second SPSC
+ *   ring (quicpro_io_thread_adopt()).
+ *
+ * A connection is used by one thread at a time. Its slot holds an atomic
+ * owner that either thread takes with a compare-and-swap, without locks:
+ * - The I/O thread skips a connection it cannot take, and forwards its
+ *   datagrams to the PHP thread.
+ * - The PHP thread spins the few microseconds a receive or a send takes.
+ * - A handler holds its own connection while it runs. Only that
+ *   connection waits for the handler; every other connection keeps its
+ *   transport timing.
+ *
+ * Limits:
+ * - A handler must only use the connection it was called for. The
+ *   listener's own passes over several connections take each in turn:
+ *   MCP batches, the proxy, and Quicpro\Server::connectionStats().
+ * - The split replaces the io_uring engine for this listener.
+ * - If the thread cannot start, the listener warns and runs as before.
+ */
+
+#ifndef QUICPRO_SERVER_IO_THREAD_H
+#define QUICPRO_SERVER_IO_THREAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "client/session.h"
+#include "poll/udp_batch.h"
+
+typedef struct quicpro_io_thread_s quicpro_io_thread_t;
+
+/** A datagram the I/O thread hands to the PHP thread, as it arrived. */
+typedef struct {
+    struct sockaddr_storage from;
+    socklen_t               from_len;
+    bool                    has_ts;
+    struct timespec         rx_ts;
+    size_t                  len;
+    uint8_t                 data[];
+} quicpro_io_dgram_t;
+
+/** @brief Whether `quicpro.io_thread_split` asks for the thread. */
+bool quicpro_io_thread_enabled(void);
+
+/**
+ * @brief Starts the thread on the listener socket `fd`, receiving into `rx`,
+ * which the PHP thread no longer uses. NULL, with a warning, when it cannot
+ * start.
+ */
+quicpro_io_thread_t *quicpro_io_thread_start(int fd, quicpro_udp_rx_batch_t *rx);
+
+/**
+ * @brief Stops and joins the thread, then frees it and the datagrams still
+ * queued. Slots of sessions still open stay with them; release those with
+ * quicpro_io_session_detach().
+ */
+void quicpro_io_thread_stop(quicpro_io_thread_t *io);
+
+/** @brief The eventfd that becomes readable when datagrams are queued for the PHP thread. */
+int quicpro_io_thread_wake_fd(const quicpro_io_thread_t *io);
+
+/**
+ * @brief The next datagram for the PHP thread, or NULL. The first call
+ * after a wakeup also resets the eventfd. Free it with
+ * quicpro_io_dgram_free().
+ */
+quicpro_io_dgram_t *quicpro_io_thread_next(quicpro_io_thread_t *io);
+
+void quicpro_io_dgram_free(quicpro_io_dgram_t *d);
+
+/**
+ * @brief Wakes the thread to look at its connections again, once the PHP
+ * thread has changed their timers.
+ */
+void quicpro_io_thread_kick(quicpro_io_thread_t *io);
+
+/**
+ * @brief Hands `s`, known by the issued `cid`, to the thread. If the ring
+ * is full, `s` stays with the PHP thread alone, and the call can be
+ * repeated later.
+ */
+void quicpro_io_thread_adopt(quicpro_io_thread_t *io, quicpro_session_t *s, const uint8_t *cid, size_t cid_len);
+
+/**
+ * @brief Takes `s` back for good before it is freed. Call it once per
+ * round until it returns true; `s` must not be held at that point. True
+ * at once for a session the thread never had.
+ */
+bool quicpro_io_thread_forget(quicpro_io_thread_t *io, quicpro_session_t *s);
+
+/**
+ * @brief Takes `s` for the PHP thread, waiting out a receive or send in
+ * progress. Calls nest. A no-op for sessions without a thread.
+ */
+void quicpro_io_session_acquire(quicpro_session_t *s);
+
+/** @brief Ends the matching quicpro_io_session_acquire(). */
+void quicpro_io_session_release(quicpro_session_t *s);
+
+/** @brief Frees the slot of `s` after quicpro_io_thread_stop(). */
+void quicpro_io_session_detach(quicpro_session_t *s);
+
+#endif /* QUICPRO_SERVER_IO_THREAD_H */
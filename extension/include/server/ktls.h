@@ -0,0 +1,80 @@
+/*
+ * include/server/ktls.h – Kernel TLS and file bodies for the TCP listeners
+ * ========================================================================
+ *
+ * With `quicpro.tls_tcp_enable_ktls` the HTTP/1 and HTTP/2 listeners ask
+ * OpenSSL (3.0 or later) to hand the session keys to the kernel once the
+ * handshake completes. Record encryption then happens in the kernel, or
+ * on the NIC with TLS offload. A body the handler names as a file
+ * (`'file' => $path` in its response) goes out through SSL_sendfile()
+ * without ever entering user space.
+ *
+ * OpenSSL quietly keeps encrypting in user space when the kernel lacks the
+ * `tls` module or the negotiated cipher is not supported. File bodies are
+ * then read in chunks and written with SSL_write.
+ *
+ * A body encrypted at rest (a sealed CDN disk record) is always read
+ * that way: its segments are decrypted as they are read.
+ */
+
+#ifndef QUICPRO_SERVER_KTLS_H
+#define QUICPRO_SERVER_KTLS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <openssl/ssl.h>
+
+#include "object_store/at_rest.h"
+
+#define QUICPRO_FILE_BODY_CHUNK 16384
+
+/** A response body streamed from a file descriptor. */
+typedef struct {
+    int      fd;          /* -1 when the response has no file body */
+    off_t    offset;
+    off_t    remaining;
+    size_t   buf_len;     /* Bytes in `buf` awaiting an SSL_write retry */
+    quicpro_at_rest_reader_t *sealed;   /* NULL, or `fd` is read through it: `offset` is the plaintext's */
+    uint8_t  buf[QUICPRO_FILE_BODY_CHUNK];
+} quicpro_file_body_t;
+
+/** @brief Requests kernel TLS on a listener's context when configured. */
+void quicpro_ktls_configure(SSL_CTX *ctx);
+
+/** @brief Whether the kernel encrypts what `ssl` sends. */
+bool quicpro_ktls_send_active(SSL *ssl);
+
+/** @brief Marks `b` as empty. */
+void quicpro_file_body_init(quicpro_file_body_t *b);
+
+/**
+ * @brief Opens a regular file as the response body.
+ * @return 0 on success, -1 if it cannot be opened or is not a regular file.
+ */
+int quicpro_file_body_open(quicpro_file_body_t *b, const char *path);
+
+/**
+ * @brief Sends up to `max` bytes of the body: SSL_sendfile() under kernel
+ * TLS, otherwise pread() and SSL_write().
+ * @return Bytes sent, or the failed call's return value (<= 0), to be
+ * classified with SSL_get_error() or quicpro_tls_io_pending().
+ */
+ssize_t quicpro_file_body_send(SSL *ssl, quicpro_file_body_t *b, size_t max);
+
+/**
+ * @brief Sends `len` bytes of an open file from `offset` as the body: a
+ * part of a larger file, such as a CDN cache segment. `fd` is duplicated.
+ * @return 0 on success, -1 if it cannot be duplicated.
+ */
+int quicpro_file_body_open_range(quicpro_file_body_t *b, int fd, off_t offset, off_t len);
+
+/** @brief Copies up to `len` bytes of the body into `out`; no TLS involved. */
+ssize_t quicpro_file_body_read(quicpro_file_body_t *b, uint8_t *out, size_t len);
+
+/** @brief Closes the file. Safe on an empty body. */
+void quicpro_file_body_close(quicpro_file_body_t *b);
+
+#endif /* QUICPRO_SERVER_KTLS_H */
@@ -0,0 +1,104 @@
+/*
+ * include/server/live_config.h – Configuration changes without a restart
+ * ======================================================================
+ *
+ * A Quicpro\Config is frozen once a server uses it, and the admin API
+ * (server/admin_api.h) runs on a thread of its own that must not touch the
+ * listener's state. Changing a setting therefore used to need a rolling
+ * restart. Now the admin thread builds a new immutable snapshot of the
+ * settings that may change and publishes it with one atomic pointer swap:
+ *
+ *   security_cors_allowed_origins          origins answered with CORS headers
+ *   security_rate_limiter_enable           the client address limiter ...
+ *   security_rate_limiter_requests_per_sec ... its rate ...
+ *   security_rate_limiter_burst            ... and its burst
+ *   cert_file, key_file                    the certificate chain and key
+ *   cc_algorithm                           "cubic", "reno", "bbr" or "bbr2"
+ *
+ * A snapshot holds only the settings that were set, anywhere along the line
+ * of snapshots. At the top of its next loop iteration the listener sees the
+ * new generation and copies the changes into its own state: the
+ * process-wide settings and the quiche config of new connections. Existing
+ * connections keep their certificate and congestion controller. The TCP
+ * listeners apply the CORS list, the rate limits and the certificate, which
+ * they load into their SSL_CTX (parsed once per process, see
+ * server/cert_store.h).
+ *
+ * Old snapshots are reclaimed by epoch (quiescent-state based). Every
+ * listener announces the current epoch at the top of each iteration, when
+ * it holds no snapshot. A snapshot retired in epoch E is freed once every
+ * listener has announced E or later.
+ *
+ * The snapshot lives in the process, so in a cluster it reaches the worker
+ * whose admin API received it.
+ */
+
+#ifndef QUICPRO_SERVER_LIVE_CONFIG_H
+#define QUICPRO_SERVER_LIVE_CONFIG_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "quiche.h"
+#include <openssl/ssl.h>
+
+typedef struct quicpro_live_config_s quicpro_live_config_t;
+
+/* A listener's side: its reader slot and the generation it applied */
+typedef struct {
+    int      slot;                      /* -1 if every slot was taken */
+    uint64_t generation;
+    SSL_CTX *tls_ctx;                   /* A TCP listener's context, for cert_file and key_file */
+} quicpro_live_reader_t;
+
+/**
+ * @brief A new snapshot, starting from the current one. Any thread.
+ * @return NULL if out of memory.
+ */
+quicpro_live_config_t *quicpro_live_config_begin(void);
+
+/**
+ * @brief Sets `key` (one of the names above) from its text form. Booleans
+ * are "true" or "false".
+ * @return false, with a reason in `err`, for an unknown key or a bad value.
+ */
+bool quicpro_live_config_set(quicpro_live_config_t *c, const char *key, const char *value, char *err, size_t err_len);
+
+/**
+ * @brief Validates `c` (the certificate and key must load and match) and
+ * publishes it, or discards it on failure.
+ * @return The new generation, 0 with a reason in `err` on failure.
+ */
+uint64_t quicpro_live_config_commit(quicpro_live_config_t *c, char *err, size_t err_len);
+
+/** @brief Discards a snapshot that was begun but not committed. */
+void quicpro_live_config_abort(quicpro_live_config_t *c);
+
+/** @brief Registers a listener loop as a reader; a TCP listener sets `tls_ctx` afterwards. */
+void quicpro_live_config_enter(quicpro_live_reader_t *r);
+
+/**
+ * @brief Top of each loop iteration: announces the epoch and, when a new
+ * generation was published, applies it to the process and to the quiche
+ * config of new connections.
+ */
+void quicpro_live_config_tick(quicpro_live_reader_t *r, quiche_config *quic_config);
+
+/** @brief The loop stops; snapshots no longer wait for it. */
+void quicpro_live_config_leave(quicpro_live_reader_t *r);
+
+/** @brief Frees every snapshot. For MSHUTDOWN, when no listener runs. */
+void quicpro_live_config_mshutdown(void);
+
+/*
+ * PHP_FUNCTION(quicpro_server_reconfigure)
+ * int Quicpro\Server::reconfigure(array $settings)
+ * Publishes $settings (the keys above) as the admin API's POST /config
+ * does, from PHP. Returns the new generation; throws if a key or value is
+ * rejected.
+ */
+PHP_FUNCTION(quicpro_server_reconfigure);
+
+#endif /* QUICPRO_SERVER_LIVE_CONFIG_H */
@@ -0,0 +1,252 @@
+/*
+ * include/server/metrics.h – Native counters, gauges and HDR histograms
+ * =====================================================================
+ *
+ * A registry of up to QUICPRO_METRICS_MAX instruments: the built-in ones
+ * below, and those PHP code adds with Quicpro\Metrics::register(). Each
+ * process records into its own shard, a flat array of 64-bit slots with
+ * one writer, so recording is a relaxed load and store with no locked
+ * instruction. A histogram is log-linear (HDR): every power of two is
+ * split into QUICPRO_HDR_SUB buckets, which bounds the error of any
+ * quantile to 1/QUICPRO_HDR_SUB of its value (6.25%) across
+ * 1 .. 2^QUICPRO_HDR_MAX_BITS recorded units. Recording a value costs a
+ * count-leading-zeros and four stores.
+ *
+ * In a cluster the master maps one shard per worker slot and generation
+ * parity before the first fork, like the stats segment
+ * (cluster/cluster_stats.h). The layout is fixed then: instruments must be
+ * registered before Quicpro\Cluster::orchestrate(), or in its
+ * 'preload_callable'. A restarted worker keeps adding to its counters;
+ * the gauges of a worker that exited are cleared. Nothing is merged while
+ * recording. A scrape sums the shards.
+ *
+ * The master serves the merged shards as Prometheus text on the cluster
+ * option 'metrics_port' (default 9091, 'metrics_host' 127.0.0.1), and
+ * pushes them every `quicpro.otel_metrics_export_interval_ms` as an OTLP
+ * ExportMetricsServiceRequest (server/otlp.h) when `quicpro.otel_enable`
+ * and `quicpro.otel_metrics_enable` are on. Outside a cluster,
+ * Quicpro\Metrics::serve() does the same for the calling process. Both
+ * run in a thread of their own and never touch PHP. Histograms are
+ * exported with the explicit bounds they were registered with, or
+ * `quicpro.otel_metrics_default_histogram_boundaries`. The HDR buckets
+ * only serve Quicpro\Metrics::snapshot()'s quantiles.
+ */
+
+#ifndef QUICPRO_SERVER_METRICS_H
+#define QUICPRO_SERVER_METRICS_H
+
+#include <php.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "quiche.h"
+
+#define QUICPRO_METRICS_MAX         64  /* Instruments, the built-in ones included */
+#define QUICPRO_METRICS_NAME_MAX    64
+#define QUICPRO_METRICS_HELP_MAX    128
+#define QUICPRO_METRICS_BOUNDS_MAX  32  /* Explicit bounds of an exported histogram */
+
+#define QUICPRO_HDR_SUB_BITS  4
+#define QUICPRO_HDR_SUB       (1u << QUICPRO_HDR_SUB_BITS)
+#define QUICPRO_HDR_MAX_BITS  44        /* Values of 2^44 units and more share the last bucket */
+#define QUICPRO_HDR_BUCKETS   ((QUICPRO_HDR_MAX_BITS - QUICPRO_HDR_SUB_BITS + 1) * QUICPRO_HDR_SUB)
+
+/* A histogram's slots: count, sum, max, then the buckets */
+#define QUICPRO_HDR_SLOTS     (3 + QUICPRO_HDR_BUCKETS)
+
+typedef enum {
+    QUICPRO_METRIC_COUNTER,
+    QUICPRO_METRIC_GAUGE,               /* A double; summed across workers */
+    QUICPRO_METRIC_HISTOGRAM
+} quicpro_metric_type_t;
+
+/* The built-in instruments, registered first and in this order */
+typedef enum {
+    QUICPRO_METRIC_REQUEST_DURATION,    /* µs per handler call: HTTP/1.1, HTTP/2, HTTP/3 streams, MCP */
+    QUICPRO_METRIC_HANDSHAKE_DURATION,  /* µs from a QUIC connection's first packet to its handshake completing */
+    QUICPRO_METRIC_STREAMS,             /* HTTP/2 and MCP (HTTP/3) streams opened */
+    QUICPRO_METRIC_PACKETS_SENT,        /* QUIC, counted as each connection closes */
+    QUICPRO_METRIC_PACKETS_LOST,
+    QUICPRO_METRIC_PACKETS_RETRANSMITTED,
+    QUICPRO_METRIC_IIBIN_ENCODED_BYTES,
+    QUICPRO_METRIC_IIBIN_DECODED_BYTES,
+    QUICPRO_METRIC_QUEUE_DELAY,         /* µs a request waited for its handler (server/overload.h) */
+    QUICPRO_METRIC_REQUESTS_SHED,       /* Requests refused under overload */
+    QUICPRO_METRIC_ACCESS_LOG_DROPPED,  /* Access log records lost to a full ring */
+    QUICPRO_METRIC_BUILTIN_COUNT
+} quicpro_metric_id_t;
+
+/* This process's shard; NULL while nothing is recorded (metrics disabled) */
+extern _Atomic uint64_t *quicpro_metrics_shard;
+/* Slot of each instrument's first value in the shard */
+extern uint32_t quicpro_metrics_offset[QUICPRO_METRICS_MAX];
+
+static inline uint64_t quicpro_metrics_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/* HDR bucket of `v`: exact below QUICPRO_HDR_SUB, then QUICPRO_HDR_SUB per power of two */
+static inline uint32_t quicpro_hdr_bucket(uint64_t v)
+{
+    if (v < QUICPRO_HDR_SUB) {
+        return (uint32_t)v;
+    }
+    unsigned e = 63 - (unsigned)__builtin_clzll(v);
+    if (e >= QUICPRO_HDR_MAX_BITS) {
+        return QUICPRO_HDR_BUCKETS - 1;
+    }
+    return (e - QUICPRO_HDR_SUB_BITS + 1) * QUICPRO_HDR_SUB + (uint32_t)((v >> (e - QUICPRO_HDR_SUB_BITS)) & (QUICPRO_HDR_SUB - 1));
+}
+
+static inline void quicpro_metrics_slot_add(_Atomic uint64_t *slot, uint64_t n)
+{
+    atomic_store_explicit(slot, atomic_load_explicit(slot, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+/** @brief Adds `n` to counter `id`. */
+static inline void quicpro_metrics_add(uint32_t id, uint64_t n)
+{
+    _Atomic uint64_t *s = quicpro_metrics_shard;
+    if (s) {
+        quicpro_metrics_slot_add(&s[quicpro_metrics_offset[id]], n);
+    }
+}
+
+/** @brief Adds `delta` to gauge `id`. */
+static inline void quicpro_metrics_gauge_add(uint32_t id, double delta)
+{
+    _Atomic uint64_t *s = quicpro_metrics_shard;
+    if (s) {
+        _Atomic uint64_t *slot = &s[quicpro_metrics_offset[id]];
+        uint64_t bits = atomic_load_explicit(slot, memory_order_relaxed);
+        double v;
+        memcpy(&v, &bits, sizeof(v));
+        v += delta;
+        memcpy(&bits, &v, sizeof(v));
+        atomic_store_explicit(slot, bits, memory_order_relaxed);
+    }
+}
+
+/** @brief Records `v`, in the histogram's recorded units, into histogram `id`. */
+static inline void quicpro_metrics_observe(uint32_t id, uint64_t v)
+{
+    _Atomic uint64_t *s = quicpro_metrics_shard;
+    if (s) {
+        _Atomic uint64_t *h = &s[quicpro_metrics_offset[id]];
+        quicpro_metrics_slot_add(&h[0], 1);
+        quicpro_metrics_slot_add(&h[1], v);
+        if (v > atomic_load_explicit(&h[2], memory_order_relaxed)) {
+            atomic_store_explicit(&h[2], v, memory_order_relaxed);
+        }
+        quicpro_metrics_slot_add(&h[3 + quicpro_hdr_bucket(v)], 1);
+    }
+}
+
+/** @brief Records the time since `started_us` (quicpro_metrics_now_us()) into histogram `id`. */
+static inline void quicpro_metrics_observe_since(uint32_t id, uint64_t started_us)
+{
+    if (quicpro_metrics_shard) {
+        uint64_t now = quicpro_metrics_now_us();
+        quicpro_metrics_observe(id, now > started_us ? now - started_us : 0);
+    }
+}
+
+/** @brief Registers the built-in instruments and gives this process a private shard. For MINIT. */
+void quicpro_metrics_minit(void);
+
+/** @brief Stops the server thread and frees the registry. For MSHUTDOWN. */
+void quicpro_metrics_mshutdown(void);
+
+/** @brief Accounts a closing QUIC connection's packets. */
+void quicpro_metrics_conn_closed(quiche_conn *conn);
+
+/**
+ * @brief In the master, before the first fork: maps a shard for each of
+ * `nslots` slots and both generation parities, and fixes the registry.
+ * With `enabled` false nothing is mapped and workers record nothing.
+ */
+void quicpro_metrics_prepare(int nslots, bool enabled);
+
+/** @brief Stops the server thread and unmaps the shards of quicpro_metrics_prepare(). */
+void quicpro_metrics_release(void);
+
+/** @brief In the forked worker: records into its own shard from now on. */
+void quicpro_metrics_attach_worker(int worker_id, unsigned generation);
+
+/**
+ * @brief The master reaped slot `worker_id`'s worker of `generation`:
+ * its gauges no longer describe anything live.
+ */
+void quicpro_metrics_worker_exited(int worker_id, unsigned generation);
+
+/**
+ * @brief Starts the thread that serves Prometheus text on `host`:`port`
+ * (none with port 0) and pushes OTLP when configured. Fixes the registry.
+ * @return false, after a warning, if the port cannot be bound.
+ */
+bool quicpro_metrics_serve(const char *host, int port);
+
+/*
+ * PHP_FUNCTION(quicpro_metrics_register)
+ * bool Quicpro\Metrics::register(string $name, string $type, string $help = '', ?array $boundaries = null)
+ * Adds an instrument: $type is "counter", "gauge" or "histogram". A
+ * histogram records its values with a resolution of 0.001 and is exported
+ * with $boundaries, ascending, or the configured default ones. Registering
+ * a name again with the same type does nothing. Throws once the registry
+ * is fixed (the cluster started, or serve() was called) or when it is full.
+ */
+PHP_FUNCTION(quicpro_metrics_register);
+
+/*
+ * PHP_FUNCTION(quicpro_metrics_increment)
+ * bool Quicpro\Metrics::increment(string $name, int $by = 1)
+ * Adds $by to a counter ($by >= 0) or a gauge. False for an unknown name.
+ */
+PHP_FUNCTION(quicpro_metrics_increment);
+
+/*
+ * PHP_FUNCTION(quicpro_metrics_set)
+ * bool Quicpro\Metrics::set(string $name, float $value)
+ * Sets this process's share of a gauge. False for an unknown name.
+ */
+PHP_FUNCTION(quicpro_metrics_set);
+
+/*
+ * PHP_FUNCTION(quicpro_metrics_observe)
+ * bool Quicpro\Metrics::observe(string $name, float $value)
+ * Records $value (negative values as 0) into a histogram. False for an unknown name.
+ */
+PHP_FUNCTION(quicpro_metrics_observe);
+
+/*
+ * PHP_FUNCTION(quicpro_metrics_render)
+ * string Quicpro\Metrics::render()
+ * The Prometheus text exposition of the cluster's merged shards, or of
+ * this process outside a cluster.
+ */
+PHP_FUNCTION(quicpro_metrics_render);
+
+/*
+ * PHP_FUNCTION(quicpro_metrics_snapshot)
+ * array Quicpro\Metrics::snapshot()
+ * Name => value for counters and gauges; for histograms an array with
+ * 'count', 'sum', 'max', 'p50', 'p90', 'p99' and 'p999', in exported units.
+ */
+PHP_FUNCTION(quicpro_metrics_snapshot);
+
+/*
+ * PHP_FUNCTION(quicpro_metrics_serve)
+ * bool Quicpro\Metrics::serve(int $port = 9091, string $host = '127.0.0.1')
+ * Outside a cluster: serves this process's metrics as Prometheus text on
+ * $host:$port, and pushes them over OTLP when configured. Fixes the
+ * registry. Throws if a cluster or an earlier call serves them already.
+ */
+PHP_FUNCTION(quicpro_metrics_serve);
+
+#endif /* QUICPRO_SERVER_METRICS_H */
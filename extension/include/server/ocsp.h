@@ -0,0 +1,60 @@
+/*
+ * include/server/ocsp.h – OCSP stapling from a shared staple cache
+ * =================================================================
+ *
+ * A client that checks revocation itself asks the CA's OCSP responder
+ * during the handshake, which can stall it for a round trip to a third
+ * party. With `quicpro.tls_enable_ocsp_stapling` the TCP listeners answer
+ * the client's status request with a stapled response. The handshake
+ * never waits for the network:
+ *
+ * - All workers share one table of staples, mapped by the cluster master
+ *   before forking. Each entry is keyed by the SHA-1 fingerprint of a
+ *   leaf certificate, which OpenSSL caches in the parsed certificate.
+ * - A handshake that finds a current staple copies it (a sequence lock
+ *   keeps the copy consistent while the fetcher writes). One that finds
+ *   none is served without a staple and files a request: the OCSP
+ *   CertID, the responder URL and the issuer certificate.
+ * - The master fetches what was requested, verifies the response against
+ *   the issuer, and refreshes every staple halfway through its validity.
+ *   A responder that fails is retried with backoff, and the old staple is
+ *   served until its nextUpdate passes. Each supervisor round fetches at
+ *   most a few staples, with a short timeout. Staples no handshake has
+ *   used for a day are dropped.
+ *
+ * Outside a cluster, the listener's process keeps the table itself and
+ * fetches on a thread of its own that never calls into the Zend engine.
+ *
+ * QUIC listeners staple nothing: quiche's C API has no way to hand it a
+ * response.
+ */
+
+#ifndef QUICPRO_SERVER_OCSP_H
+#define QUICPRO_SERVER_OCSP_H
+
+#include <stdint.h>
+
+#include <openssl/ssl.h>
+
+/** @brief Maps the staple table. Called by the cluster master before forking. */
+void quicpro_ocsp_prepare(void);
+
+/** @brief Stops this process's fetcher thread, if any, and unmaps the table. */
+void quicpro_ocsp_release(void);
+
+/**
+ * @brief Fetches requested and expiring staples. Does nothing except in
+ * the process that owns the table.
+ */
+void quicpro_ocsp_tick(void);
+
+/** @brief CLOCK_MONOTONIC milliseconds of the next tick with work; 0 when there is none. */
+uint64_t quicpro_ocsp_next_ms(void);
+
+/**
+ * @brief Staples responses on a TCP listener's handshakes when
+ * configured; starts the fetcher thread outside a cluster.
+ */
+void quicpro_ocsp_install(SSL_CTX *ctx);
+
+#endif /* QUICPRO_SERVER_OCSP_H */
@@ -4,6 +4,10 @@
 #define QUICPRO_SERVER_OPEN_TELEMETRY_H
 
 #include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "quiche.h"
 
 /**
  * @file extension/include/server/open_telemetry.h
@@ -14,27 +18,177 @@
  * traces, metrics, and logs for all server operations. This provides deep,
  * out-of-the-box observability into the performance and behavior of
  * applications built with the framework, with minimal developer effort.
- */
-
-/**
- * @brief Initializes the OpenTelemetry exporter for a server instance.
  *
- * This function configures and starts the OTel exporter based on the provided
- * configuration. Once initialized, the server's C-core will automatically
- * instrument incoming requests, creating spans for the request lifecycle and
- * propagating trace contexts. It will also collect and periodically export
- * internal performance metrics.
+ * Tracing is native C, with no allocation per span. A span lives wherever
+ * the caller keeps it (on the stack, or in the request it measures). When
+ * it ends, it is copied into this process's span ring, a single-producer
+ * single-consumer ring of `quicpro.otel_batch_processor_max_queue_size`
+ * slots. An exporter thread empties the ring every
+ * `quicpro.otel_batch_processor_schedule_delay_ms`, or as soon as a batch
+ * is full. It encodes the spans as an OTLP ExportTraceServiceRequest and
+ * sends it per `quicpro.otel_exporter_protocol`: "grpc" (HTTP/2), or
+ * "http/protobuf" to <endpoint>/v1/traces. A span that finds the ring full
+ * is dropped and counted; the request it measured is never held up.
+ *
+ * Head sampling follows `quicpro.otel_traces_sampler_type`:
+ * - "always_on" or "always_off";
+ * - "parent_based_probability" (the default): a span with a parent
+ *   inherits the parent's decision; a root span is sampled with
+ *   probability `quicpro.otel_traces_sampler_ratio`.
+ * A span that is not sampled still has IDs, so the trace context can be
+ * propagated. Ending it does nothing.
  *
- * This should typically be called once at server startup.
+ * A forked worker starts its own exporter with its first span.
  *
- * @param server_resource The resource of the server instance to be instrumented.
- * @param config_resource A PHP resource representing a `Quicpro\Config` object.
- * The configuration must contain the `otel_*` directives, such as
- * `otel_service_name` and `otel_exporter_endpoint`.
- * @return TRUE on successful initialization of the OTel exporter.
- * FALSE on failure, throwing a `Quicpro\Exception\ConfigException` if the
- * OTel configuration is incomplete or invalid.
+ * The servers open a SERVER span for every request they dispatch (HTTP/1.1,
+ * HTTP/2, MCP routes, and HTTP/3 streams). The MCP client opens a CLIENT
+ * span for every call. A `traceparent` request header (W3C Trace Context)
+ * makes the server span its child. While a handler runs, its span is the
+ * current context, and each MCP call it makes carries the current context
+ * on as `traceparent`. A received context is passed on even when this
+ * process does not trace, so a trace is not cut at an untraced hop. Spans
+ * on a QUIC connection carry its RTT, congestion window, and lost and
+ * retransmitted packets from quiche's statistics.
+ */
+
+#define QUICPRO_OTEL_SPAN_ATTRS 8   /* Capped further by quicpro.otel_traces_max_attributes_per_span */
+#define QUICPRO_OTEL_NAME_MAX   64  /* Longer span names are truncated */
+#define QUICPRO_OTEL_STR_MAX    48  /* Longer string attribute values are truncated */
+
+/* OTLP Span.SpanKind */
+typedef enum {
+    QUICPRO_OTEL_KIND_INTERNAL = 1,
+    QUICPRO_OTEL_KIND_SERVER   = 2,
+    QUICPRO_OTEL_KIND_CLIENT   = 3,
+    QUICPRO_OTEL_KIND_PRODUCER = 4,
+    QUICPRO_OTEL_KIND_CONSUMER = 5
+} quicpro_otel_kind_t;
+
+typedef enum {
+    QUICPRO_OTEL_ATTR_INT,
+    QUICPRO_OTEL_ATTR_DOUBLE,
+    QUICPRO_OTEL_ATTR_BOOL,
+    QUICPRO_OTEL_ATTR_STR
+} quicpro_otel_attr_type_t;
+
+/* What a W3C traceparent carries */
+typedef struct {
+    uint8_t trace_id[16];
+    uint8_t span_id[8];
+    bool    sampled;
+} quicpro_otel_context_t;
+
+typedef struct {
+    const char *key;                    /* A string literal: only the pointer is kept */
+    uint8_t     type;                   /* quicpro_otel_attr_type_t */
+    union {
+        int64_t i;
+        double  d;
+        bool    b;
+        char    s[QUICPRO_OTEL_STR_MAX];
+    } v;
+} quicpro_otel_attr_t;
+
+typedef struct {
+    quicpro_otel_context_t ctx;
+    uint8_t  parent_span_id[8];
+    bool     has_parent;
+    bool     error;                     /* OTLP status ERROR instead of UNSET */
+    uint8_t  kind;                      /* quicpro_otel_kind_t */
+    uint8_t  nattrs;
+    uint64_t start_ns;                  /* CLOCK_REALTIME */
+    uint64_t end_ns;
+    char     name[QUICPRO_OTEL_NAME_MAX];
+    quicpro_otel_attr_t attrs[QUICPRO_OTEL_SPAN_ATTRS];
+} quicpro_otel_span_t;
+
+/**
+ * @brief Starts the tracer in this process: the span ring and the exporter
+ * thread. Idempotent. Does nothing, and returns false, while
+ * `quicpro.otel_enable` is off.
+ */
+bool quicpro_otel_start(void);
+
+/** @brief Exports the spans still in the ring and stops the exporter. For MSHUTDOWN. */
+void quicpro_otel_shutdown(void);
+
+/** @brief Whether spans started now are recorded at all (the tracer runs). */
+bool quicpro_otel_active(void);
+
+/**
+ * @brief Opens `span`: new span ID, the trace ID of `parent` (a new one
+ * without), the sampling decision and the start time.
+ * @return Whether the span is sampled.
+ */
+bool quicpro_otel_span_start(quicpro_otel_span_t *span, const char *name, quicpro_otel_kind_t kind,
+                             const quicpro_otel_context_t *parent);
+
+/** @brief Attributes beyond the span's limit are dropped. `key` must outlive the export. */
+void quicpro_otel_span_attr_int(quicpro_otel_span_t *span, const char *key, int64_t value);
+void quicpro_otel_span_attr_double(quicpro_otel_span_t *span, const char *key, double value);
+void quicpro_otel_span_attr_bool(quicpro_otel_span_t *span, const char *key, bool value);
+void quicpro_otel_span_attr_str(quicpro_otel_span_t *span, const char *key, const char *value, size_t len);
+
+/** @brief Stamps the end time and, if sampled, hands the span to the exporter. */
+void quicpro_otel_span_end(quicpro_otel_span_t *span);
+
+/** @brief Adds quic.rtt_us, quic.cwnd, quic.lost and quic.retransmits of `conn`'s active path. */
+void quicpro_otel_span_quic(quicpro_otel_span_t *span, quiche_conn *conn);
+
+#define QUICPRO_OTEL_TRACEPARENT_LEN 55     /* "00-" trace-id "-" parent-id "-" flags */
+
+/** @brief Writes `ctx` as a version 00 traceparent, NUL-terminated. */
+void quicpro_otel_traceparent_format(const quicpro_otel_context_t *ctx, char out[QUICPRO_OTEL_TRACEPARENT_LEN + 1]);
+
+/** @brief Parses a traceparent header value; false if it is malformed or carries all-zero IDs. */
+bool quicpro_otel_traceparent_parse(const char *value, size_t len, quicpro_otel_context_t *out);
+
+/** @brief The context of the request being served or the call being made, NULL outside any. */
+const quicpro_otel_context_t *quicpro_otel_current(void);
+
+/*
+ * A span that is the current context while it is open. The current
+ * context is kept by value: a Fiber may suspend with a scope open, and
+ * the scope it restores on close must not point into another Fiber's stack.
+ */
+typedef struct {
+    quicpro_otel_span_t span;
+    quicpro_otel_context_t outer;       /* Restored on close */
+    bool had_outer;
+    bool entered;                       /* There is a context to pass on: made current */
+} quicpro_otel_scope_t;
+
+/**
+ * @brief Starts `scope`'s span under `parent`, or under the current context
+ * when `parent` is NULL, and makes it current if it is sampled or has a
+ * parent. Costs next to nothing while the tracer is off and there is no
+ * context to pass on.
+ * @return Whether the span is sampled (attributes are worth adding).
+ */
+bool quicpro_otel_scope_open(quicpro_otel_scope_t *scope, const char *name, quicpro_otel_kind_t kind,
+                             const quicpro_otel_context_t *parent);
+
+/** @brief Restores the outer context and ends the span. */
+void quicpro_otel_scope_close(quicpro_otel_scope_t *scope);
+
+/*
+ * PHP_FUNCTION(quicpro_server_init_telemetry)
+ * bool Quicpro\Telemetry::init(?array $config = null)
+ * Applies $config (the `open_telemetry` keys, as for Quicpro\Config) and
+ * starts the tracer in this process. Call it once at server startup, in
+ * the cluster master or in each worker. Returns false when telemetry is
+ * disabled; throws an InvalidArgumentException, and returns false, if
+ * $config is invalid. The settings in effect when the tracer first starts
+ * stay in effect.
  */
 PHP_FUNCTION(quicpro_server_init_telemetry);
 
+/*
+ * PHP_FUNCTION(quicpro_server_telemetry_stats)
+ * array Quicpro\Telemetry::stats()
+ * This process's tracer counters: 'spans_exported', 'spans_dropped'
+ * (the ring was full), 'exports_failed' and 'queued'.
+ */
+PHP_FUNCTION(quicpro_server_telemetry_stats);
+
 #endif // QUICPRO_SERVER_OPEN_TELEMETRY_H
@@ -0,0 +1,84 @@
+/*
+ * include/server/otlp.h – OTLP request encoding and transport
+ * ===========================================================
+ *
+ * What the span tracer (server/open_telemetry.h) and the metrics pusher
+ * (server/metrics.h) share: a protobuf writer small enough for the few
+ * OTLP messages they send, and the POST of one export request per
+ * `quicpro.otel_exporter_protocol`. With "grpc" it is an HTTP/2 request to
+ * <endpoint>/opentelemetry.proto.collector.<signal>.v1.<Signal>Service/Export,
+ * with the 5-byte gRPC message prefix. With "http/protobuf" it is a plain
+ * POST to <endpoint>/v1/<signal>.
+ *
+ * An endpoint is set up on the PHP thread, which is the only one that reads
+ * the configuration, and is then used by one exporter thread.
+ */
+
+#ifndef QUICPRO_SERVER_OTLP_H
+#define QUICPRO_SERVER_OTLP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <curl/curl.h>
+
+#define QUICPRO_OTLP_GRPC_PREFIX 5  /* Compressed flag and big-endian message length */
+
+typedef enum {
+    QUICPRO_OTLP_TRACES,
+    QUICPRO_OTLP_METRICS
+} quicpro_otlp_signal_t;
+
+/* A growing, persistent (malloc'd) output buffer */
+typedef struct {
+    uint8_t *p;
+    size_t   len;
+    size_t   cap;
+} quicpro_otlp_buf_t;
+
+void quicpro_otlp_reserve(quicpro_otlp_buf_t *b, size_t n);
+void quicpro_otlp_varint(quicpro_otlp_buf_t *b, uint64_t v);
+void quicpro_otlp_tag(quicpro_otlp_buf_t *b, unsigned field, unsigned wire);
+void quicpro_otlp_bytes(quicpro_otlp_buf_t *b, unsigned field, const void *data, size_t len);
+void quicpro_otlp_fixed64(quicpro_otlp_buf_t *b, unsigned field, uint64_t v);
+void quicpro_otlp_double(quicpro_otlp_buf_t *b, unsigned field, double v);
+
+/** @brief An element of a packed repeated fixed64 or double, inside open()/close(). */
+void quicpro_otlp_raw64(quicpro_otlp_buf_t *b, uint64_t v);
+
+/**
+ * @brief Opens a nested message (or packed field) `field`; close() with the
+ * returned mark writes its length once the contents are in.
+ */
+size_t quicpro_otlp_open(quicpro_otlp_buf_t *b, unsigned field);
+void quicpro_otlp_close(quicpro_otlp_buf_t *b, size_t mark);
+
+/** @brief A KeyValue `field` with a string value. */
+void quicpro_otlp_kv_str(quicpro_otlp_buf_t *b, unsigned field, const char *key, const char *value);
+
+typedef struct {
+    char   *url;
+    char   *service_name;               /* For the resource of every request */
+    struct curl_slist *headers;
+    bool    grpc;
+    long    timeout_ms;
+} quicpro_otlp_endpoint_t;
+
+/**
+ * @brief Sets `ep` up for `signal` from the `quicpro.otel_exporter_*`
+ * settings. False, with nothing to free, when no endpoint is configured.
+ */
+bool quicpro_otlp_endpoint_init(quicpro_otlp_endpoint_t *ep, quicpro_otlp_signal_t signal);
+void quicpro_otlp_endpoint_free(quicpro_otlp_endpoint_t *ep);
+
+/** @brief Empties `b` for a new request, keeping room for the gRPC prefix. */
+void quicpro_otlp_begin(const quicpro_otlp_endpoint_t *ep, quicpro_otlp_buf_t *b);
+
+/** @brief In the exporter thread: a handle for the requests to `ep`, NULL on failure. */
+CURL *quicpro_otlp_connect(const quicpro_otlp_endpoint_t *ep);
+
+/** @brief Sends the request in `b`, begun with begin(); true if the collector accepted it. */
+bool quicpro_otlp_send(CURL *curl, const quicpro_otlp_endpoint_t *ep, quicpro_otlp_buf_t *b);
+
+#endif /* QUICPRO_SERVER_OTLP_H */
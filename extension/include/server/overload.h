@@ -0,0 +1,90 @@
+/*
+ * include/server/overload.h – Priority-aware overload shedding
+ * ============================================================
+ *
+ * A worker runs one handler at a time. Once requests arrive faster than
+ * it answers them, they queue in front of the handler. Every request then
+ * waits longer, until most of them time out at the client, even though
+ * the worker is busy the whole time. Goodput collapses.
+ *
+ * With `quicpro.overload_shedding_enable` the listeners check every
+ * request before its handler runs, using CoDel's rule (RFC 8289):
+ *
+ * - The sojourn time is how long the request waited between arriving and
+ *   reaching its handler. For HTTP/1.1 and HTTP/2 the arrival is the round
+ *   of the listener loop that read the request, or the round before it if
+ *   the loop did not get to wait in between. MCP requests over HTTP/3 use
+ *   the kernel receive timestamp of their connection's last datagram when
+ *   there is one.
+ * - While sojourn times stay above `quicpro.overload_target_ms` for a
+ *   whole `quicpro.overload_interval_ms`, the worker is overloaded. The
+ *   first request that waited less than the target ends the overload.
+ *
+ * While overloaded, requests are shed by class (the priority matrix of
+ * cluster/cluster_opts.h):
+ * - low_ws, WebSocket upgrades and requests at urgency 5 or less urgent,
+ *   are shed at once;
+ * - normal_api, every other request, is shed as well once the overload
+ *   has lasted another interval;
+ * - critical_control, requests at urgency 0, is never shed.
+ *
+ * A shed request costs the worker almost nothing: HTTP/1.1 answers 503,
+ * HTTP/2 resets the stream with REFUSED_STREAM, which tells the client it
+ * is safe to retry, and the MCP server answers 503. The urgency is the one
+ * in the request's `priority` header (server/priority.h).
+ *
+ * The HTTP/3 listener hands raw streams to its handler and does not know
+ * a request from a control stream, so it sheds nothing itself; the MCP
+ * server it serves does.
+ */
+
+#ifndef QUICPRO_SERVER_OVERLOAD_H
+#define QUICPRO_SERVER_OVERLOAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef enum {
+    QUICPRO_OVERLOAD_CRITICAL,      /* critical_control: never shed */
+    QUICPRO_OVERLOAD_NORMAL,        /* normal_api */
+    QUICPRO_OVERLOAD_LOW            /* low_ws: shed first */
+} quicpro_overload_class_t;
+
+/** @brief Whether `quicpro.overload_shedding_enable` is on. */
+bool quicpro_overload_enabled(void);
+
+/**
+ * @brief The class of a request with `priority` header `priority` (NULL:
+ * none), upgrading to a WebSocket if `websocket`.
+ */
+quicpro_overload_class_t quicpro_overload_classify(const char *priority, size_t priority_len, bool websocket);
+
+/** @brief Marks the listener loop going to wait for input. */
+void quicpro_overload_wait_begin(void);
+
+/** @brief Marks the listener loop woken up: a new round begins. */
+void quicpro_overload_wait_end(void);
+
+/**
+ * @brief When the input of the current round arrived, at the latest
+ * (quicpro_metrics_now_us() clock).
+ */
+uint64_t quicpro_overload_round_arrival_us(void);
+
+/**
+ * @brief The arrival of a datagram with kernel receive timestamp `rx_ts`
+ * (CLOCK_REALTIME), on the clock of quicpro_overload_round_arrival_us().
+ * The round's arrival without a timestamp.
+ */
+uint64_t quicpro_overload_rx_arrival_us(const struct timespec *rx_ts);
+
+/**
+ * @brief Decides on a request of class `cls` that arrived at `arrived_us`
+ * and now reaches its handler, and records its sojourn time.
+ * @return false if the caller should shed it; always true when disabled.
+ */
+bool quicpro_overload_admit(quicpro_overload_class_t cls, uint64_t arrived_us);
+
+#endif /* QUICPRO_SERVER_OVERLOAD_H */
@@ -0,0 +1,61 @@
+/*
+ * include/server/path.h – Connection migration for accepted sessions
+ * ===================================================================
+ *
+ * quiche tracks network paths per connection. It needs the real 4-tuple of
+ * every datagram and tells the application, through path events, when a
+ * new path shows up, is validated, or becomes the active one. The listeners
+ * use this module to:
+ *
+ * - fill quiche_recv_info with the listener's local address and the
+ *   datagram's source, so a NAT rebinding shows up as a new path rather
+ *   than as garbage on the old one;
+ * - probe newly seen paths, and adopt the new peer address for the
+ *   session once quiche reports the migration as validated;
+ * - send every packet to quiche_send_info.to, so PATH_CHALLENGE and
+ *   PATH_RESPONSE frames go to the path they belong to.
+ *
+ * A rebound client therefore keeps its connection, streams and congestion
+ * state, and does not repeat the handshake. Lookups keep working across
+ * the move because they go by DCID (server/cid.h).
+ */
+
+#ifndef QUICPRO_SERVER_PATH_H
+#define QUICPRO_SERVER_PATH_H
+
+#include <sys/socket.h>
+
+#include <quiche.h>
+
+#include "client/session.h"
+
+/**
+ * @brief Builds the recv info for a datagram from `from` that arrived at
+ * the session's local address.
+ */
+static inline quiche_recv_info quicpro_server_path_recv_info(quicpro_session_t *s,
+                                                             const struct sockaddr *from,
+                                                             socklen_t from_len)
+{
+    quiche_recv_info ri = {
+        .from     = (struct sockaddr *)from,
+        .from_len = from_len,
+        .to       = s->local_addr_len ? (struct sockaddr *)&s->local_addr : NULL,
+        .to_len   = s->local_addr_len,
+    };
+    return ri;
+}
+
+/**
+ * @brief Drains quiche's path events after quiche_conn_recv(). Probes new
+ * paths and switches `peer_addr` on a validated migration.
+ */
+void quicpro_server_path_events(quicpro_session_t *s);
+
+/**
+ * @brief Flushes quiche_conn_send() for `s` on `fd` and sends every packet
+ * to the path quiche chose.
+ */
+void quicpro_server_path_flush(quicpro_session_t *s, int fd);
+
+#endif /* QUICPRO_SERVER_PATH_H */
@@ -0,0 +1,97 @@
+/*
+ * include/server/priority.h – RFC 9218 Extensible Priorities for HTTP/3 and HTTP/2 responses
+ * ==========================================================================================
+ *
+ * A response stream has an urgency from 0 (most urgent) to 7 and an
+ * incremental flag. The transport sends the data of the most urgent
+ * streams first. Streams of equal urgency share the connection round
+ * robin when incremental, and one after another otherwise. A large
+ * download at u=5 then cannot hold back an API answer at u=3 or a
+ * control message at u=0 on the same connection.
+ *
+ * Where a priority comes from:
+ *
+ * - The request's `priority` header ("u=1, i") and the client's later
+ *   PRIORITY_UPDATE frames. The HTTP/3 proxy applies both
+ *   (server/proxy.h). nghttp2 parses them itself once the HTTP/2 listener
+ *   announces SETTINGS_NO_RFC7540_PRIORITIES.
+ * - The application, which has the last word: an HTTP/2 handler returns
+ *   'priority' with its response; on HTTP/3, quicpro_stream_set_priority()
+ *   sets a stream's priority at any time.
+ *
+ * A priority from PHP is a header value ("u=1, i"), an urgency (int), or
+ * ['urgency' => 1, 'incremental' => true]. QUICPRO_PRIORITY_* name the
+ * urgencies of the priority matrix in cluster/cluster_opts.h.
+ *
+ * HTTP/3 priorities are enforced by quiche's stream scheduler
+ * (quiche_conn_stream_priority()), HTTP/2 ones by nghttp2's RFC 9218
+ * scheduler. With an nghttp2 older than 1.50 the HTTP/2 listener keeps
+ * RFC 7540's dependency tree and ignores both.
+ */
+
+#ifndef QUICPRO_SERVER_PRIORITY_H
+#define QUICPRO_SERVER_PRIORITY_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <quiche.h>
+
+#define QUICPRO_PRIORITY_URGENCY_MAX      7
+#define QUICPRO_PRIORITY_DEFAULT_URGENCY  3   /* RFC 9218 §4.1 */
+
+/* The priority matrix's classes (qp_priority_matrix_t) as urgencies */
+#define QUICPRO_PRIORITY_CRITICAL_CONTROL 0
+#define QUICPRO_PRIORITY_NORMAL_API       3
+#define QUICPRO_PRIORITY_LOW_WS           5
+
+/* Longest header value quicpro_priority_format() writes: "u=7, i" */
+#define QUICPRO_PRIORITY_VALUE_MAX        8
+
+typedef struct {
+    uint8_t urgency;                /* 0..7 */
+    bool    incremental;
+} quicpro_priority_t;
+
+#define QUICPRO_PRIORITY_DEFAULT ((quicpro_priority_t){ QUICPRO_PRIORITY_DEFAULT_URGENCY, false })
+
+/**
+ * @brief Parses a `priority` field value (a Structured Fields dictionary)
+ * into `prio`, which holds the defaults on entry. Members other than u and
+ * i, parameters, and a u out of range are ignored, as RFC 9218 asks.
+ * @return false if the value is not a dictionary; `prio` is unchanged then.
+ */
+bool quicpro_priority_parse(const char *value, size_t len, quicpro_priority_t *prio);
+
+/** @brief Writes `prio` as a field value ("u=5, i"); returns its length. */
+size_t quicpro_priority_format(quicpro_priority_t prio, char out[QUICPRO_PRIORITY_VALUE_MAX]);
+
+/**
+ * @brief Reads a priority given from PHP (see above) into `prio`.
+ * @return false after a TypeError or ValueError was thrown.
+ */
+bool quicpro_priority_from_zval(zval *zv, quicpro_priority_t *prio);
+
+/**
+ * @brief Schedules the HTTP/3 or QUIC stream `stream_id` of `conn` at
+ * `prio`; quiche sends its data in that order from the next packet on.
+ */
+bool quicpro_priority_apply_quic(quiche_conn *conn, uint64_t stream_id, quicpro_priority_t prio);
+
+/**
+ * @brief Takes the latest PRIORITY_UPDATE the client sent for `stream_id`
+ * (after a QUICHE_H3_EVENT_PRIORITY_UPDATE, or ahead of its request). It
+ * replaces the whole priority: what it leaves out is the default.
+ * @return false if there was none; `prio` is unchanged then.
+ */
+bool quicpro_priority_take_update(quiche_h3_conn *h3, uint64_t stream_id, quicpro_priority_t *prio);
+
+/**
+ * @brief quicpro_stream_set_priority(resource $session, int $streamId, string|int|array $priority): bool
+ * Reprioritises one stream of an HTTP/3 server or client session.
+ */
+PHP_FUNCTION(quicpro_stream_set_priority);
+
+#endif /* QUICPRO_SERVER_PRIORITY_H */
@@ -0,0 +1,143 @@
+/*
+ * include/server/profiler.h – Always-available hot path profiler
+ * ==============================================================
+ *
+ * Shows where a worker's time goes without attaching perf: in the network,
+ * in quiche, in the codec or in the application. Timers on the hot paths
+ * read the CPU's cycle counter (the TSC on x86-64, CNTVCT on arm64,
+ * CLOCK_MONOTONIC elsewhere). While the profiler is off a timer costs one
+ * relaxed load. While it is on, each timed call adds itself to a log2
+ * histogram of its phase:
+ *
+ *   recv           recvmmsg() of one receive batch
+ *   conn_recv      quiche_conn_recv() of one datagram
+ *   h3_poll        quiche_h3_conn_poll() of one event
+ *   php_callback   a request handler
+ *   iibin_encode   one IIBIN message encoded (IIBIN::encode(), MCP bodies)
+ *   iibin_decode   one IIBIN message decoded
+ *   send           quiche_conn_send() and the send syscalls of one flush
+ *
+ * The histograms belong to the process, so in a cluster each worker has
+ * its own. The admin API (server/admin_api.h) turns them on with
+ * POST /profile/start and off with POST /profile/stop. GET /profile returns
+ * folded stacks for flamegraph.pl, weighted in nanoseconds, and
+ * GET /profile?format=pprof returns an uncompressed profile.proto for
+ * `go tool pprof`. IIBIN work shows up inside php_callback, whose own
+ * weight excludes it. Quicpro\Profiler offers the same from PHP.
+ *
+ * Only the thread that runs the server loop records. Readers on the admin
+ * thread may see a histogram that is one call behind.
+ */
+
+#ifndef QUICPRO_SERVER_PROFILER_H
+#define QUICPRO_SERVER_PROFILER_H
+
+#include <php.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#endif
+
+#include "quiche.h"
+
+typedef enum {
+    QUICPRO_PROF_RECV,
+    QUICPRO_PROF_CONN_RECV,
+    QUICPRO_PROF_H3_POLL,
+    QUICPRO_PROF_PHP_CALLBACK,
+    QUICPRO_PROF_IIBIN_ENCODE,
+    QUICPRO_PROF_IIBIN_DECODE,
+    QUICPRO_PROF_SEND,
+    QUICPRO_PROF_PHASES
+} quicpro_prof_phase_t;
+
+extern _Atomic bool quicpro_prof_enabled;
+
+/* The cycle counter; quicpro_prof_folded() and friends calibrate it */
+static inline uint64_t quicpro_prof_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/** @brief Records `ticks` for `phase`. Use the inline pair below. */
+void quicpro_prof_record(quicpro_prof_phase_t phase, uint64_t ticks);
+
+/** @brief Starts a timer: 0 while the profiler is off. */
+static inline uint64_t quicpro_prof_begin(void)
+{
+    return atomic_load_explicit(&quicpro_prof_enabled, memory_order_relaxed) ? quicpro_prof_ticks() : 0;
+}
+
+/** @brief Stops a timer of quicpro_prof_begin() and records it for `phase`. */
+static inline void quicpro_prof_end(quicpro_prof_phase_t phase, uint64_t started)
+{
+    if (started) {
+        quicpro_prof_record(phase, quicpro_prof_ticks() - started);
+    }
+}
+
+/** @brief quiche_h3_conn_poll(), timed as h3_poll. */
+static inline int64_t quicpro_prof_h3_conn_poll(quiche_h3_conn *h3, quiche_conn *conn, quiche_h3_event **ev)
+{
+    uint64_t started = quicpro_prof_begin();
+    int64_t stream_id = quiche_h3_conn_poll(h3, conn, ev);
+    quicpro_prof_end(QUICPRO_PROF_H3_POLL, started);
+    return stream_id;
+}
+
+/**
+ * @brief Turns the profiler on or off. Turning it on starts a new profile.
+ * Safe from any thread.
+ * @return Whether it was on.
+ */
+bool quicpro_prof_set_enabled(bool on);
+
+/**
+ * @brief The profile as folded stacks, in persistent memory. Safe from
+ * another thread of this process.
+ * @return The length, filled into `*out`.
+ */
+size_t quicpro_prof_folded(char **out);
+
+/** @brief The profile as an uncompressed pprof profile.proto, like quicpro_prof_folded(). */
+size_t quicpro_prof_pprof(char **out);
+
+/*
+ * PHP_FUNCTION(quicpro_profiler_enable)
+ * bool Quicpro\Profiler::enable(bool $on = true)
+ * Turns this process's profiler on (starting a new profile) or off.
+ * Returns whether it was on.
+ */
+PHP_FUNCTION(quicpro_profiler_enable);
+
+/*
+ * PHP_FUNCTION(quicpro_profiler_export)
+ * string Quicpro\Profiler::export(string $format = 'folded')
+ * The profile as 'folded' stacks or as 'pprof'. Throws for other formats.
+ */
+PHP_FUNCTION(quicpro_profiler_export);
+
+/*
+ * PHP_FUNCTION(quicpro_profiler_snapshot)
+ * array Quicpro\Profiler::snapshot()
+ * Per phase: 'count', 'total_ns' and 'buckets', the histogram as
+ * upper bound in ns => calls.
+ */
+PHP_FUNCTION(quicpro_profiler_snapshot);
+
+#endif /* QUICPRO_SERVER_PROFILER_H */
@@ -0,0 +1,88 @@
+/*
+ * include/server/proxy.h – L7 HTTP/3 reverse proxy on the listeners
+ * =================================================================
+ *
+ * Terminates HTTP/3 from clients and forwards each request stream to an
+ * upstream picked by rules, the way a Traefik router in front of the
+ * workers would:
+ *
+ *     quicpro_proxy_route(['host' => 'api.example.com', 'path' => '/v1/'], 'h3://10.0.0.5:4433',
+ *                         ['config' => $upstreamConfig]);
+ *     quicpro_proxy_route(['headers' => ['x-canary' => '1']], 'https://legacy.internal:8443');
+ *
+ *     quicpro_server_listen($server, function ($session, int $stream, bool $early) {
+ *         quicpro_proxy_serve($session);
+ *     });
+ *
+ * Rules are tried in the order they were added; the first whose every
+ * condition holds wins:
+ * - 'host': the request's :authority (or Host) without its port, exactly,
+ *   or any subdomain for "*.example.com";
+ * - 'path': a prefix of :path;
+ * - 'headers': name => value pairs the request must carry exactly.
+ * A request no rule takes is answered 404.
+ *
+ * Upstreams:
+ * - "h3://host:port" opens HTTP/3 streams on shared QUIC connections from
+ *   the client pool (client/pool.h), built from the route's 'config'. A
+ *   connection carries requests until the peer grants no more streams;
+ *   then another one is taken.
+ * - "https://host:port" and "http://host:port" (prior knowledge, h2c) go
+ *   over HTTP/2 through one libcurl multi handle per worker, which
+ *   multiplexes the requests to each backend on its connections.
+ *
+ * Headers are forwarded as they came, without hop-by-hop fields, plus
+ * x-forwarded-for and x-forwarded-proto; :authority is the upstream's
+ * unless 'preserve_host' (default true) keeps the client's. Bodies are
+ * spliced, never collected: each direction of a stream moves through a
+ * QUICPRO_PROXY_WINDOW buffer, and the side that cannot take more leaves
+ * the rest in the other's flow-control window, so a slow reader holds
+ * back its writer instead of filling memory. A failure before the
+ * upstream answered is a 502; after, the client's stream is reset.
+ *
+ * The listener loops call quicpro_proxy_tick() once a round, so the
+ * splices move whether or not a client sent anything. With the epoll
+ * engine the upstream sockets wake the listener; with io_uring they are
+ * looked at once a round.
+ *
+ * Routes belong to the request that added them and end with it.
+ */
+
+#ifndef QUICPRO_SERVER_PROXY_H
+#define QUICPRO_SERVER_PROXY_H
+
+#include <php.h>
+
+#include "client/session.h"
+
+#define QUICPRO_PROXY_WINDOW (64 * 1024)    /* Bytes buffered per stream and direction */
+
+typedef struct quicpro_proxy_conn_s quicpro_proxy_conn_t;
+
+/* quicpro_proxy_route(array $match, string $upstream, array $options = []): bool
+ * $options: 'config' (Quicpro\Config, for h3:// upstreams), 'preserve_host' (bool). */
+PHP_FUNCTION(quicpro_proxy_route);
+
+/* quicpro_proxy_serve(resource $session): int – requests forwarded */
+PHP_FUNCTION(quicpro_proxy_serve);
+
+/**
+ * @brief Moves every open splice along: reads the upstreams, sends what
+ * either side can take. `epoll_fd` is the listener's (-1 for none); the
+ * upstream sockets are watched there.
+ */
+void quicpro_proxy_tick(int epoll_fd);
+
+/** @brief Whether quicpro_proxy_tick() has splices or upstreams to move. */
+bool quicpro_proxy_busy(void);
+
+/** @brief Ends the connection's splices (session teardown). */
+void quicpro_proxy_conn_free(quicpro_proxy_conn_t *pc);
+
+/** @brief Whether the connection has no splice open (include/poll/hibernate.h). */
+bool quicpro_proxy_conn_idle(const quicpro_proxy_conn_t *pc);
+
+/** @brief Drops the routes and the upstream connections (RSHUTDOWN). */
+void quicpro_proxy_rshutdown(void);
+
+#endif /* QUICPRO_SERVER_PROXY_H */
@@ -0,0 +1,102 @@
+/*
+ * include/server/qlog.h – Sampled qlog events in a binary ring
+ * ============================================================
+ *
+ * quiche can only write qlog as JSON text to a file descriptor, on the
+ * datagram path, for every connection it is enabled on. That costs more
+ * than a 1% sample may. Instead the server loops record a sampled
+ * connection's transport events themselves, once per round and only for
+ * what changed. They record: packets received, sent, lost and
+ * retransmitted; RTT and congestion window updates; the handshake
+ * completing; the close with its error code. Each event goes into this
+ * worker's ring as a fixed 64-byte record. Recording is a few stores. An
+ * unsampled connection costs one branch per round.
+ *
+ * `quicpro.transport_qlog_sample_ratio` (per Quicpro\Config:
+ * 'qlog_sample_ratio') picks the connections as they are accepted. The ring
+ * holds `quicpro.transport_qlog_ring_events` records. It is allocated when
+ * the first connection is sampled and overwrites the oldest records once
+ * full.
+ *
+ * Quicpro\Qlog::dump() copies the ring out as a binary dump, to keep or to
+ * write to a file. Quicpro\Qlog::toJsonSeq() turns a dump into qlog 0.3
+ * JSON-SEQ (RFC 7464), anywhere and at any time later. The admin API
+ * (server/admin_api.h) answers GET /qlog with the same conversion of the
+ * live ring. Each connection is one qlog group, named after its first
+ * server connection ID.
+ */
+
+#ifndef QUICPRO_SERVER_QLOG_H
+#define QUICPRO_SERVER_QLOG_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "client/session.h"
+
+#define QUICPRO_QLOG_MAGIC "QPQLOG\0\1"
+
+/* Per sampled connection: what the previous round already recorded */
+struct quicpro_qlog_conn_s {
+    uint64_t group;                     /* First 8 bytes of the SCID */
+    uint64_t recv, sent, lost, retrans;
+    uint64_t recv_bytes, sent_bytes, lost_bytes;
+    uint64_t rtt, min_rtt, rttvar, cwnd;
+    bool     established;
+};
+
+/**
+ * @brief A server connection was accepted: samples it per
+ * `qlog_sample_ratio` and records its start.
+ */
+void quicpro_qlog_conn_started(quicpro_session_t *session, const uint8_t *scid, size_t scid_len);
+
+/** @brief Records what changed on a sampled connection since its last round. */
+void quicpro_qlog_tick(quicpro_session_t *session);
+
+static inline void quicpro_qlog_conn_tick(quicpro_session_t *session)
+{
+    if (session->qlog) {
+        quicpro_qlog_tick(session);
+    }
+}
+
+/** @brief Records the close of a sampled connection and forgets it. */
+void quicpro_qlog_conn_closed(quicpro_session_t *session);
+
+/**
+ * @brief A binary dump of the ring (header and records, oldest first) in
+ * persistent memory. Safe from another thread of this process.
+ * @return The length, filled into `*out`; 0 with `*out` NULL if nothing was recorded.
+ */
+size_t quicpro_qlog_snapshot(char **out);
+
+/**
+ * @brief qlog JSON-SEQ of a dump from quicpro_qlog_snapshot(), in persistent
+ * memory. Uses no PHP allocation, so the admin thread may call it.
+ * @return false if `dump` is no dump.
+ */
+bool quicpro_qlog_json_seq(const char *dump, size_t len, char **out, size_t *out_len);
+
+/** @brief Frees the ring. For MSHUTDOWN. */
+void quicpro_qlog_mshutdown(void);
+
+/*
+ * PHP_FUNCTION(quicpro_qlog_dump)
+ * string|bool Quicpro\Qlog::dump(?string $path = null)
+ * This worker's recorded events as a binary dump, or written to $path (true
+ * on success). An empty string if no connection was sampled yet.
+ */
+PHP_FUNCTION(quicpro_qlog_dump);
+
+/*
+ * PHP_FUNCTION(quicpro_qlog_to_json_seq)
+ * string Quicpro\Qlog::toJsonSeq(string $dump)
+ * Converts a dump into qlog JSON-SEQ, one trace with a group per
+ * connection. Throws if $dump is not a dump.
+ */
+PHP_FUNCTION(quicpro_qlog_to_json_seq);
+
+#endif /* QUICPRO_SERVER_QLOG_H */
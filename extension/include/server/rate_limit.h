@@ -0,0 +1,78 @@
+/*
+ * include/server/rate_limit.h – Cluster-wide per-key rate limiting
+ * ================================================================
+ *
+ * With `quicpro.security_rate_limiter_enable`, every key gets a token
+ * bucket. It holds `quicpro.security_rate_limiter_burst` requests and
+ * refills at `quicpro.security_rate_limiter_requests_per_sec`. The
+ * servers key by client address: the full IPv4 address, or the /64
+ * prefix of an IPv6 one, since a single host can usually pick any address
+ * in its /64. The QUIC listeners check it before quiche_accept() for a
+ * connection's first packet and drop packets over the limit without a
+ * reply. The TCP listeners check it on accept(), and HTTP/1.1 and HTTP/2
+ * check it again for every request before the handler runs. They answer
+ * 429, or reset the stream with ENHANCE_YOUR_CALM. RateLimiter::check()
+ * applies the same limit to the application's own keys (an API key, a
+ * user ID).
+ *
+ * The buckets live in a fixed-size open-addressed table in shared memory
+ * that the cluster master maps before forking, so the limit holds across
+ * all workers. A bucket is a single 64-bit "theoretical arrival time"
+ * (GCRA), updated with one compare-and-swap. A check costs one hash and
+ * usually one cache line. A slot whose bucket has refilled completely is
+ * free for any key. When every slot a key probes is in use, the request
+ * is admitted. A table that is too small lets traffic through; it never
+ * blocks clients that are within their limit.
+ */
+
+#ifndef QUICPRO_SERVER_RATE_LIMIT_H
+#define QUICPRO_SERVER_RATE_LIMIT_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/socket.h>
+
+/** @brief Maps the shared bucket table. Called by the cluster master before forking. */
+void quicpro_rate_limit_prepare(void);
+
+/** @brief Unmaps the table of quicpro_rate_limit_prepare(). */
+void quicpro_rate_limit_release(void);
+
+/**
+ * @brief Takes `cost` tokens from the bucket of `key`.
+ * @return false if that would exceed the limit; true otherwise, and
+ * always when the limiter is disabled.
+ */
+bool quicpro_rate_limit_admit(const void *key, size_t len, uint32_t cost);
+
+/**
+ * @brief Overrides the bucket of application key `key`, as a batch of the
+ * admin API does: with `block_ms` > 0 every check of the key fails for
+ * that long, with 0 its bucket is full again.
+ * @return false if the limiter is disabled or the key found no free slot.
+ */
+bool quicpro_rate_limit_set(const void *key, size_t len, uint64_t block_ms);
+
+/** @brief quicpro_rate_limit_admit() keyed by client address, as described above. */
+bool quicpro_rate_limit_admit_addr(const struct sockaddr *addr);
+
+/**
+ * @brief Sheds load cluster-wide: at `level` n the rate and the burst of
+ * every bucket are divided by 2^n (at most QUICPRO_RATE_LIMIT_MAX_PRESSURE).
+ * The cluster supervisor raises it under cgroup pressure (cluster/cgroup.h).
+ */
+void quicpro_rate_limit_set_pressure(unsigned level);
+
+#define QUICPRO_RATE_LIMIT_MAX_PRESSURE 4
+
+/*
+ * PHP_FUNCTION(quicpro_rate_limit_check)
+ * bool Quicpro\RateLimiter::check(string $key, int $cost = 1)
+ * Takes $cost tokens from $key's bucket, shared with every worker; false
+ * when the key is over its limit. Application keys never share a bucket
+ * with a client address.
+ */
+PHP_FUNCTION(quicpro_rate_limit_check);
+
+#endif /* QUICPRO_SERVER_RATE_LIMIT_H */
@@ -0,0 +1,107 @@
+/*
+ * include/server/replay.h – Recorded traffic through the server loop, in process
+ * ==============================================================================
+ *
+ * A benchmark over the network measures the network too: its buffers, the
+ * scheduler, the client's own CPU. Two builds are then hard to tell apart
+ * by less than the noise. quicpro_server_replay() (server/index.h) runs a
+ * trace of real requests through the listener's own datagram handler and
+ * stream loop in one process, with no socket in between:
+ *
+ * - each connection of the trace becomes an in-process quiche client at a
+ *   synthetic address (fd00::/16, one per client);
+ * - the client writes the connection's recorded stream bytes, in the
+ *   recorded order, and its datagrams go straight to the listener's
+ *   datagram handler, as if recvmmsg() had read them;
+ * - the listener's flush hands its datagrams back to the client instead
+ *   of sendto(), and the client reads the responses.
+ *
+ * The stream bytes are what the client sent, HTTP/3 framing and QPACK
+ * included, so the listener parses and answers the same requests as in
+ * production. Only the QUIC packets around them are new: handshake, keys
+ * and connection IDs are the replay's own.
+ *
+ * Recording
+ * ---------
+ * With SSLKEYLOGFILE in the environment, the listeners write every
+ * accepted connection's TLS secrets there (NSS key log format). A capture
+ * plus that file is what Wireshark needs to decrypt QUIC, and
+ * infra/tshark/capture.sh turns both into a trace. Set it for a capture
+ * only: whoever reads the file can decrypt the traffic.
+ *
+ * Trace format
+ * ------------
+ * Text, one STREAM write of a client per line, in the order they were sent:
+ *
+ *     # comment
+ *     <t_us> <conn> <stream_id> <fin> <hex bytes, or - for none>
+ *
+ * `t_us` is the time since the capture began, `conn` any number naming the
+ * connection, `fin` 1 on the stream's last write.
+ */
+
+#ifndef QUICPRO_SERVER_REPLAY_H
+#define QUICPRO_SERVER_REPLAY_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <sys/socket.h>
+
+#include "quiche.h"
+#include "client/session.h"
+#include "poll/udp_batch.h"
+
+typedef struct quicpro_replay quicpro_replay_t;
+
+/**
+ * @brief Loads the trace at `path` for a listener bound to `server_addr`.
+ *
+ * `options` (may be NULL):
+ * - 'speed'           1.0 replays at the recorded pace, 2.0 twice as fast;
+ *                     0 (default) sends every write as soon as its
+ *                     connection can take it.
+ * - 'loops'           replays the trace this many times, with new
+ *                     connections each time (default 1).
+ * - 'max_connections' connections open at once at speed 0 (default 64).
+ * - 'timeout_ms'      a connection that has not finished by then counts
+ *                     as failed (default 10000).
+ * - 'alpn'            (default "h3") and 'server_name' (default
+ *                     "localhost") of the client handshake.
+ *
+ * @return NULL with an exception thrown on an unreadable trace or option.
+ */
+quicpro_replay_t *quicpro_replay_open(const char *path, const struct sockaddr *server_addr,
+                                      socklen_t server_addr_len, HashTable *options);
+
+/**
+ * @brief One round of the clients: connects those that are due, writes
+ * what is due, reads responses and hands their datagrams to `rx`.
+ *
+ * @return false once every connection has closed.
+ */
+bool quicpro_replay_step(quicpro_replay_t *rp, quicpro_udp_dgram_cb rx, void *ctx);
+
+/**
+ * @brief Replaces quicpro_server_path_flush() during a replay: the
+ * session's datagrams go to the client they are addressed to.
+ */
+void quicpro_replay_deliver(quicpro_replay_t *rp, quicpro_session_t *s);
+
+/**
+ * @brief Fills `return_value` with the replay's counts, its wall clock and
+ * CPU time and the response latency percentiles in microseconds.
+ */
+void quicpro_replay_results(quicpro_replay_t *rp, zval *return_value);
+
+void quicpro_replay_free(quicpro_replay_t *rp);
+
+/**
+ * @brief With SSLKEYLOGFILE set: before quiche_accept(), has `config` log
+ * keys. A no-op without it.
+ */
+void quicpro_replay_keylog_config(quiche_config *config);
+
+/** @brief With SSLKEYLOGFILE set: appends `conn`'s secrets to that file. */
+void quicpro_replay_keylog_conn(quiche_conn *conn);
+
+#endif /* QUICPRO_SERVER_REPLAY_H */
@@ -0,0 +1,80 @@
+/*
+ * include/server/request.h – Pooled Quicpro\Request objects for the TCP listeners
+ * ================================================================================
+ *
+ * The HTTP/1 and HTTP/2 listeners hand their callback a Quicpro\Request
+ * instead of a freshly built array. The object starts out as a set of
+ * views into the listener's own buffers: the parser's method, target and
+ * header slices for HTTP/1, the stream's header array and body for
+ * HTTP/2. Strings and the header array are only created when the handler
+ * asks for them.
+ *
+ * Each listener keeps one object in a pool. After the callback returns,
+ * the object is reset and reused for the next request. If the handler
+ * kept a reference (stored it, captured it in a closure, handed it to a
+ * Fiber), the object is detached instead: everything is materialised
+ * from the views, and the pool makes a new object next time.
+ *
+ * A body the listener spooled (server/body_spool.h) is not copied into
+ * the object: it keeps a duplicate of the spool's descriptor instead,
+ * which a retained object holds on to after the listener closed its own.
+ * bodyStream() reads either kind of body as a stream; saveBody() writes
+ * it to a path, in the kernel for a spooled one.
+ *
+ * For compatibility with array handlers the class implements ArrayAccess:
+ * $request['method'], ['uri'], ['protocol'], ['headers'] and ['body'] work as
+ * before, and any other key reads the header of that name.
+ */
+
+#ifndef QUICPRO_SERVER_REQUEST_H
+#define QUICPRO_SERVER_REQUEST_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "server/http1_parser.h"
+#include "server/body_spool.h"
+
+/* Borrowed for the duration of one callback */
+typedef struct {
+    const char                *method;
+    size_t                     method_len;
+    const char                *uri;
+    size_t                     uri_len;
+    const char                *protocol;      /* Static string */
+    const quicpro_h1_header_t *h1_headers;    /* HTTP/1: parser views... */
+    size_t                     h1_num_headers;
+    zval                      *headers;       /* ...or HTTP/2: a ready array (referenced) */
+    const char                *body;
+    size_t                     body_len;
+    const quicpro_body_spool_t *spool;        /* The body, when it was spooled; NULL otherwise */
+} quicpro_request_view_t;
+
+typedef struct {
+    zend_object *idle;    /* The reset object waiting for the next request */
+} quicpro_request_pool_t;
+
+extern zend_class_entry *quicpro_ce_request;
+
+/** @brief Registers Quicpro\Request (MINIT). */
+void quicpro_request_minit(void);
+
+void quicpro_request_pool_init(quicpro_request_pool_t *pool);
+void quicpro_request_pool_free(quicpro_request_pool_t *pool);
+
+/**
+ * @brief Takes the pooled object (or makes one) and points it at `view`.
+ * The caller owns the returned reference and passes it to
+ * quicpro_request_release() once the callback has returned.
+ */
+zend_object *quicpro_request_acquire(quicpro_request_pool_t *pool, const quicpro_request_view_t *view);
+
+/**
+ * @brief Ends the request's use of its views. An object nobody else holds
+ * goes back to the pool; a retained one is materialised and let go.
+ * Call this before the buffers behind the view change.
+ */
+void quicpro_request_release(quicpro_request_pool_t *pool, zend_object *obj);
+
+#endif /* QUICPRO_SERVER_REQUEST_H */
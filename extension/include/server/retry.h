@@ -0,0 +1,116 @@
+/*
+ * include/server/retry.h – Stateless Retry and address validation
+ * ================================================================
+ *
+ * Screens every datagram that has no session yet, before quiche_accept()
+ * allocates anything:
+ *
+ * - Short-header packets, and datagrams under 1200 bytes, are dropped:
+ *   a client pads the datagram of its first Initial to 1200 bytes, so
+ *   anything smaller earns no reply that could amplify a spoofed one.
+ * - Unsupported versions get a Version Negotiation packet.
+ * - Long-header packets other than Initial are dropped; they cannot
+ *   start a connection.
+ * - While Retry is in force, an Initial without a token gets a Retry
+ *   packet carrying an address-validation token, and nothing is kept.
+ * - A token is accepted only if its HMAC matches, it has not expired and
+ *   it was minted for the sender's IP address and port. The check costs one
+ *   HMAC-SHA256 over < 80 bytes plus a constant-time compare, and runs after
+ *   the cheap length, format and expiry checks.
+ *
+ * Retry is in force when `quicpro.transport_stateless_retry_enable` is on,
+ * or automatically while a listener accepts more than
+ * `quicpro.transport_stateless_retry_auto_threshold` connections per
+ * second. Clients then pay one extra round trip, but spoofed Initials cost
+ * no memory. Below the threshold normal clients are not penalised.
+ *
+ * Tokens are keyed per process (per cluster worker). Connection-ID
+ * steering sends the client's second Initial, addressed to the Retry's
+ * SCID, back to the worker that minted the token.
+ *
+ * quiche has no API to send NEW_TOKEN frames, so only Retry tokens are
+ * issued.
+ */
+
+#ifndef QUICPRO_SERVER_RETRY_H
+#define QUICPRO_SERVER_RETRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <quiche.h>
+
+/* Retry tokens are valid for this long after they were minted. */
+#define QUICPRO_RETRY_TOKEN_LIFETIME_MS  10000
+
+/* Smallest datagram that may carry a client's first Initial (RFC 9000 §14.1). */
+#define QUICPRO_RETRY_MIN_DATAGRAM       1200
+
+/* quiche_header_info()'s `type` for an Initial packet. */
+#define QUICPRO_RETRY_TYPE_INITIAL       1
+
+/* magic(1) + expiry(8) + odcid_len(1) + odcid + tag(16) */
+#define QUICPRO_RETRY_TOKEN_MAX          (1 + 8 + 1 + QUICHE_MAX_CONN_ID_LEN + 16)
+
+/** @brief Per-listener accept-rate tracking for automatic Retry. */
+typedef struct {
+    uint64_t window_start_ms;
+    uint32_t accepts;          /* Accepted in the current one-second window. */
+    uint32_t last_rate;        /* Accepts in the previous window. */
+    uint64_t retries_sent;
+    uint64_t tokens_rejected;
+    bool     always;           /* Retry in force whatever the INI says. */
+} quicpro_retry_state_t;
+
+typedef enum {
+    QUICPRO_RETRY_ACCEPT,      /* Go ahead with quiche_accept(). */
+    QUICPRO_RETRY_SENT,        /* A Retry or Version Negotiation packet was sent. */
+    QUICPRO_RETRY_DROP         /* Cannot start a connection, or invalid token while Retry is in force. */
+} quicpro_retry_verdict_t;
+
+/**
+ * @brief Screens a datagram that matched no session.
+ *
+ * `pkt`/`pkt_len` is the whole datagram; `version`, `type` and
+ * `scid`/`dcid`/`token` come from quiche_header_info() on it. On
+ * QUICPRO_RETRY_ACCEPT with `*odcid_len > 0` the client proved its address
+ * after a Retry: pass `odcid` to quiche_accept() and use `dcid` (the
+ * Retry's SCID) as the new connection's SCID.
+ */
+quicpro_retry_verdict_t quicpro_retry_screen(quicpro_retry_state_t *st, int fd,
+                                             const uint8_t *pkt, size_t pkt_len,
+                                             uint32_t version, uint8_t type,
+                                             const uint8_t *scid, size_t scid_len,
+                                             const uint8_t *dcid, size_t dcid_len,
+                                             const uint8_t *token, size_t token_len,
+                                             const struct sockaddr *peer, socklen_t peer_len,
+                                             uint8_t *odcid, size_t *odcid_len);
+
+/**
+ * @brief Draws this process's token key now, if not drawn yet. Call it on
+ * the PHP thread before another thread starts screening datagrams.
+ * @return false if the CSPRNG could not be read.
+ */
+bool quicpro_retry_key_prepare(void);
+
+/** @brief Counts an accepted connection towards the automatic threshold. */
+void quicpro_retry_note_accept(quicpro_retry_state_t *st);
+
+/**
+ * @brief Writes a token for `odcid` bound to `peer` into `out`.
+ * @return Token length, or -1 if `cap` is too small or the key is unavailable.
+ */
+ssize_t quicpro_retry_token_mint(uint8_t *out, size_t cap, const uint8_t *odcid, size_t odcid_len,
+                                 const struct sockaddr *peer, socklen_t peer_len);
+
+/**
+ * @brief Validates a token and recovers the original DCID from it.
+ * @return true if the token is authentic, unexpired and bound to `peer`.
+ */
+bool quicpro_retry_token_validate(const uint8_t *token, size_t token_len,
+                                  const struct sockaddr *peer, socklen_t peer_len,
+                                  uint8_t *odcid, size_t *odcid_len);
+
+#endif /* QUICPRO_SERVER_RETRY_H */
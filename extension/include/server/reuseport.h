@@ -0,0 +1,99 @@
+/*
+ * include/server/reuseport.h – SO_REUSEPORT connection-ID steering
+ * =================================================================
+ *
+ * Shards the QUIC listeners across Quicpro\Cluster workers without any
+ * shared state:
+ *
+ * - Every worker binds its own SO_REUSEPORT UDP socket on the listen
+ *   address and keeps a private session table.
+ * - Server-issued connection IDs carry the owning worker id in their first
+ *   two bytes (big-endian), see quicpro_reuseport_stamp_cid().
+ * - An SK_REUSEPORT eBPF program reads those bytes from the DCID of each
+ *   datagram and selects the worker's socket from a
+ *   REUSEPORT_SOCKARRAY map with bpf_sk_select_reuseport(). Datagrams whose
+ *   DCID was not issued by us (a client's first Initial) or whose worker
+ *   slot is empty fall through to the kernel's 4-tuple hash, which is just
+ *   as stable for the handshake.
+ *
+ * The map and program are created once by the cluster master before it
+ * forks, so every worker (and every restarted worker) inherits the same
+ * descriptors and joins the same steering group.
+ *
+ * A rolling reload runs two generations of workers side by side. The map
+ * has two slots per worker and a generation stamps, and is steered to,
+ * the half given by its parity: worker_id + (generation & 1) * workers.
+ * Connections of the draining generation keep reaching their old worker.
+ * A datagram for no known slot, such as a client's first Initial, is
+ * steered by the kernel's flow hash onto the newest generation's half,
+ * which gets its own program attached as its workers bind. Loading them needs
+ * CAP_BPF (or CAP_SYS_ADMIN); without it the listeners still shard by
+ * hash, but connections can land on a foreign worker after NAT rebinding.
+ *
+ * The worker id is visible on the wire. Deployments that must not expose
+ * it should run a single worker per address.
+ */
+
+#ifndef QUICPRO_SERVER_REUSEPORT_H
+#define QUICPRO_SERVER_REUSEPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bytes at the start of each issued CID that encode the worker id. */
+#define QUICPRO_REUSEPORT_CID_WORKER_BYTES  2
+
+/**
+ * @brief Creates the steering map and program for `num_workers` worker
+ * slots, all of them active.
+ * Called by the cluster master before the first fork; a silent no-op when
+ * the kernel or privileges do not allow it, or without `cid_steering`.
+ */
+void quicpro_reuseport_prepare(int num_workers, bool cid_steering);
+
+/** @brief Closes the descriptors of quicpro_reuseport_prepare(). */
+void quicpro_reuseport_release(void);
+
+/**
+ * @brief Loads the program that steers new connections to `generation`'s
+ * workers. Called by the cluster master before forking them; the program
+ * takes over the group when the first of them attaches.
+ */
+void quicpro_reuseport_set_generation(unsigned generation);
+
+/**
+ * @brief Steers new connections to the first `active_workers` slots of each
+ * generation only. Called by the cluster master as it scales; takes effect
+ * at once for every attached socket. Existing connections keep reaching
+ * their worker by connection ID.
+ */
+void quicpro_reuseport_set_active(int active_workers);
+
+/**
+ * @brief Records the cluster worker id and generation of this process.
+ * Called by the cluster supervisor in each forked worker before userland
+ * code runs.
+ */
+void quicpro_reuseport_bind_worker(int worker_id, unsigned generation);
+
+/** @brief Returns the worker id of this process, or -1 outside a cluster. */
+int quicpro_reuseport_worker_id(void);
+
+/**
+ * @brief Writes this worker's id into the first bytes of a freshly
+ * generated connection ID. A no-op outside a cluster.
+ */
+void quicpro_reuseport_stamp_cid(uint8_t *cid, size_t len);
+
+/**
+ * @brief Attaches the steering program to a bound SO_REUSEPORT socket and
+ * registers it as this worker's slot in the map.
+ *
+ * @return 0 on success or when steering is unavailable (the socket then
+ * relies on hash distribution), -1 with errno set if the kernel rejected
+ * the socket.
+ */
+int quicpro_reuseport_attach(int fd);
+
+#endif /* QUICPRO_SERVER_REUSEPORT_H */
@@ -0,0 +1,105 @@
+/*
+ * include/server/router.h – Stateless QUIC router tier
+ * ====================================================
+ *
+ * With quicpro.router_mode_enable, quicpro_server_listen() forwards
+ * datagrams instead of terminating connections: it reads only the QUIC
+ * header's destination connection ID, picks a backend from
+ * quicpro.router_backend_static_list, and relays the datagram. No TLS, no
+ * connection state; any router of the tier forwards any packet the same
+ * way, so routers can be added, removed or restarted under live traffic.
+ *
+ * Picking the backend:
+ * - Backends run with quicpro.router_server_id and the routers' salt.
+ *   Bytes 2..3 of every CID they issue (after the worker id of
+ *   server/reuseport.h) carry that id XORed with a keyed hash of the CID's
+ *   remaining bytes. A router undoes the XOR and, for an id in its list,
+ *   forwards there: every packet after the handshake reaches the backend
+ *   that issued its CID, whatever changed in the list since.
+ * - Any other DCID (a client's first Initial and the rest of its
+ *   handshake flight) is hashed with the salt. "consistent_hash" looks the
+ *   hash up in a Maglev table, so a change of the list moves only the
+ *   share of new handshakes that the changed backends held;
+ *   "round_robin" takes it modulo the list's length.
+ *
+ * Relaying: router and backend put QUICPRO_ROUTER_ENCAP_LEN bytes in
+ * front of each datagram: a 0x00 0x01 marker (QUIC packets have the
+ * fixed bit 0x40 set), the client's port and IPv6 (or IPv4-mapped)
+ * address, and a SipHash-2-4 tag of those over the salt. The backend
+ * takes the client address from the header and answers through the
+ * router that relayed last, whose header names the client; the router
+ * checks the tag, strips the header and sends from the listen address.
+ * Datagrams with a wrong tag are dropped on both sides, so neither can be
+ * made to send to an address of someone else's choosing. Retry packets
+ * and stateless resets (server/retry.h, server/conn_snapshot.h) are still
+ * sent straight from the backend, so behind routers keep
+ * quicpro.transport_stateless_retry_enable off.
+ *
+ * Backends: a control thread owns the list. With discovery "static" it
+ * is quicpro.router_backend_static_list, the ids being the positions from
+ * 1; with "mcp" the health agent at quicpro.router_backend_mcp_endpoint
+ * answers GET /backends every poll interval with one "<id> <host:port>
+ * [weight]" line per backend. Every second the thread also sends each
+ * backend an Initial of an unsupported version; one that misses three
+ * Version Negotiation answers in a row is down until it answers two. A
+ * weight of 0 drains a backend: it keeps the connections whose CIDs name
+ * it and gets no new ones; a down one gets neither. On any change the
+ * thread builds a new routing table (Maglev weighted by turns) beside the
+ * current one and swaps a pointer; the forwarding loop reads the pointer
+ * once per batch, never waits, and reports the generation it moved to so
+ * the thread frees only tables no batch can still be using.
+ *
+ * Forwarding batches recvmmsg() and sendmmsg() over the listen socket
+ * (poll/udp_batch.h) and gathers header and payload with an iovec, so a
+ * datagram is never copied. quicpro.router_max_forwarding_pps caps the
+ * rate; datagrams beyond it are dropped.
+ */
+
+#ifndef QUICPRO_SERVER_ROUTER_H
+#define QUICPRO_SERVER_ROUTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "client/session.h"
+
+#define QUICPRO_ROUTER_ENCAP_LEN   28
+#define QUICPRO_ROUTER_CID_ID_AT   2    /* Offset of the server id in issued CIDs */
+
+/* Where a relayed datagram came from */
+typedef struct {
+    struct sockaddr_storage client;     /* Named by the header */
+    socklen_t               client_len;
+    struct sockaddr_storage via;        /* The router that relayed it */
+    socklen_t               via_len;
+} quicpro_router_relay_t;
+
+/** @brief Backends: stamps quicpro.router_server_id into an issued CID. A no-op without one. */
+void quicpro_router_stamp_cid(uint8_t *cid, size_t len);
+
+/**
+ * @brief Backends: if `*buf` came through a router, strips the header and
+ * points `*peer` at the client it names (inside `relay`).
+ * @return 1 if relayed, 0 if not, -1 to drop (a bad tag, or not a backend).
+ */
+int quicpro_router_unwrap(uint8_t **buf, size_t *len, const struct sockaddr **peer, socklen_t *peer_len,
+                          quicpro_router_relay_t *relay);
+
+/** @brief Backends: after each datagram, whether `s`'s client is now reached through a router. */
+void quicpro_router_note_path(quicpro_session_t *s, const quicpro_router_relay_t *relay, int relayed);
+
+/**
+ * @brief Writes the header naming `client` to `hdr` (QUICPRO_ROUTER_ENCAP_LEN bytes).
+ * @return false if `client` is not an IPv4 or IPv6 address.
+ */
+bool quicpro_router_wrap(uint8_t *hdr, const struct sockaddr *client, socklen_t client_len);
+
+/**
+ * @brief Forwards datagrams arriving on `fd` until `*running` is cleared.
+ * @return 0, or -1 with an exception thrown if it could not start.
+ */
+int quicpro_router_run(int fd, bool *running);
+
+#endif /* QUICPRO_SERVER_ROUTER_H */
@@ -0,0 +1,68 @@
+/*
+ * include/server/slab.h – Fixed-size slab allocator for server state
+ * ===================================================================
+ *
+ * Accept-heavy listeners create and destroy a quicpro_session_t for every
+ * connection. Serving those from ecalloc() mixes ~1 KiB session blocks with
+ * short-lived request allocations on the Zend heap, which fragments it under
+ * churn. Connection counts also show up in RSS only indirectly.
+ *
+ * A slab hands out equal-sized slots from 2 MiB chunks mapped straight
+ * from the kernel:
+ *
+ * - Slot sizes are rounded up to a cache line, so no two objects share
+ *   one.
+ * - Freed slots go on a LIFO free list. The next accept reuses the most
+ *   recently closed (still cache-warm) slot.
+ * - Chunks are only returned on quicpro_slab_destroy(). RSS therefore
+ *   follows the peak connection count and does not oscillate.
+ *
+ * Slabs are not thread-safe. Each process owns its own, which fits the
+ * one-listener-per-worker model of Quicpro\Cluster.
+ */
+
+#ifndef QUICPRO_SERVER_SLAB_H
+#define QUICPRO_SERVER_SLAB_H
+
+#include <stddef.h>
+
+#include "client/session.h"
+
+#define QUICPRO_SLAB_ALIGN       64
+#define QUICPRO_SLAB_CHUNK_SIZE  (2u << 20)
+
+typedef struct quicpro_slab_s quicpro_slab_t;
+
+/** @brief Creates a slab of `obj_size`-byte slots. Maps nothing until the first allocation. */
+quicpro_slab_t *quicpro_slab_new(size_t obj_size);
+
+/** @brief Unmaps every chunk. All slots become invalid. NULL-safe. */
+void quicpro_slab_destroy(quicpro_slab_t *s);
+
+/** @brief Returns a zeroed, cache-line-aligned slot, or NULL on OOM. */
+void *quicpro_slab_alloc(quicpro_slab_t *s);
+
+/** @brief Returns a slot obtained from quicpro_slab_alloc(). NULL-safe. */
+void quicpro_slab_free(quicpro_slab_t *s, void *p);
+
+/** @brief Slots currently handed out. */
+size_t quicpro_slab_in_use(const quicpro_slab_t *s);
+
+/** @brief Bytes mapped for this slab. */
+size_t quicpro_slab_mapped_bytes(const quicpro_slab_t *s);
+
+/**
+ * @brief Allocates a server-side session from this process's session slab,
+ * with `sock` set to -1.
+ * @return NULL on OOM.
+ */
+quicpro_session_t *quicpro_server_session_alloc(void);
+
+/**
+ * @brief Frees a server session's quiche state, closes its borrowed
+ * resource and recycles its slot. Serves as the value destructor of the
+ * listeners' CID tables.
+ */
+void quicpro_session_dtor_internal(void *session);
+
+#endif /* QUICPRO_SERVER_SLAB_H */
@@ -0,0 +1,52 @@
+/*
+ * include/server/tcp_listen.h – Listening sockets for the TCP listeners
+ * ======================================================================
+ *
+ * The HTTP/1 and HTTP/2 listeners open their socket here, tuned by the
+ * `quicpro.tcp_*` directives:
+ *
+ * - `tcp_reuse_port_enable` binds with SO_REUSEPORT. Each cluster worker
+ *   then opens its own socket on the shared port and gets an accept queue
+ *   of its own, filled by the kernel's flow hash. No two workers contend
+ *   for one queue, and none wakes up for another's connection.
+ * - `tcp_fastopen_queue_len` enables TCP Fast Open: a returning client
+ *   carries its ClientHello in the SYN and saves a round trip. The kernel
+ *   must allow it server-side too (bit 2 of net.ipv4.tcp_fastopen).
+ * - `tcp_defer_accept_sec` (TCP_DEFER_ACCEPT) holds a connection back
+ *   until its first bytes arrive. TLS clients speak first, so accept()
+ *   never returns a socket with nothing to read yet.
+ * - `tcp_listen_backlog` is passed to listen(); the kernel caps it at
+ *   net.core.somaxconn.
+ * - `tcp_nodelay_enable`, `tcp_cork_enable` and the keep-alive settings
+ *   are set on the listening socket, from which Linux copies them into
+ *   every accepted one. Cork is skipped when no-delay is on.
+ *
+ * The listening socket is added to the loop's epoll set with
+ * EPOLLEXCLUSIVE, so a socket a worker inherited instead of opening
+ * (SO_REUSEPORT off) wakes one of the waiting workers, not all of them.
+ */
+
+#ifndef QUICPRO_SERVER_TCP_LISTEN_H
+#define QUICPRO_SERVER_TCP_LISTEN_H
+
+#include <sys/socket.h>
+
+#include <php.h>
+
+/**
+ * @brief Opens a non-blocking listening socket on `host` (an IPv6 or
+ * IPv4 address; an empty one binds every address) and `port`.
+ * @return The socket, or -1 with errno set.
+ */
+int quicpro_tcp_listen(const char *host, zend_long port);
+
+/** @brief Adds a listening socket to `epoll_fd` with `data` as its event data. */
+int quicpro_tcp_listen_arm(int listen_fd, int epoll_fd, void *data);
+
+/**
+ * @brief Accepts one connection as a non-blocking, close-on-exec socket.
+ * @return The socket, or -1 once the queue is empty.
+ */
+int quicpro_tcp_accept(int listen_fd, struct sockaddr_storage *peer);
+
+#endif /* QUICPRO_SERVER_TCP_LISTEN_H */
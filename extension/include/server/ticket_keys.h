@@ -0,0 +1,71 @@
+/*
+ * include/server/ticket_keys.h – Cluster-wide TLS session ticket keys
+ * ====================================================================
+ *
+ * Session tickets are encrypted with a session ticket encryption key
+ * (STEK). A key private to each worker makes every resumption that lands
+ * on another SO_REUSEPORT worker a full handshake. The STEKs therefore
+ * live in one shared mapping:
+ *
+ * - The cluster master creates the mapping before forking and rotates the
+ *   key every `quicpro.tls_session_ticket_lifetime_sec`. A ticket issued
+ *   under key N stays decryptable while N is current or previous, which is
+ *   at least its lifetime.
+ * - Keys sit in a four-slot ring with a generation counter. The master
+ *   fills slot (gen + 1) % 4 and only then publishes gen + 1. Readers load
+ *   the generation and copy the slots, with no lock on the handshake path.
+ *   The slot being written is never one a reader is using.
+ * - The TCP listeners install a ticket key callback on their SSL_CTX. It
+ *   encrypts with the current key and accepts tickets under the current or
+ *   previous key, asking the client to renew the latter.
+ * - The QUIC listeners hand the current key to quiche whenever the
+ *   generation changes. quiche accepts one key only, so a ticket issued
+ *   just before a rotation falls back to a full handshake.
+ *
+ * Outside a cluster the process creates and rotates a private ring itself.
+ */
+
+#ifndef QUICPRO_SERVER_TICKET_KEYS_H
+#define QUICPRO_SERVER_TICKET_KEYS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <openssl/ssl.h>
+#include <quiche.h>
+
+#define QUICPRO_TICKET_KEY_NAME_LEN  16
+#define QUICPRO_TICKET_KEY_SECRET_LEN 32
+
+/** @brief Maps the key ring and draws the first key. Called by the cluster master before forking. */
+void quicpro_ticket_keys_prepare(void);
+
+/** @brief Unmaps the ring of quicpro_ticket_keys_prepare(). */
+void quicpro_ticket_keys_release(void);
+
+/**
+ * @brief Rotates the current key once it is older than the ticket
+ * lifetime. Does nothing except in the process that owns the ring (the
+ * master, or a stand-alone listener).
+ */
+void quicpro_ticket_keys_tick(void);
+
+/**
+ * @brief Milliseconds until quicpro_ticket_keys_tick() has work to do, for
+ * a caller that sleeps in between; -1 in a process that does not rotate.
+ */
+int quicpro_ticket_keys_next_tick_ms(void);
+
+/** @brief Current generation, 0 if no ring is available. */
+uint64_t quicpro_ticket_keys_generation(void);
+
+/**
+ * @brief Hands the current key to quiche if the generation moved past
+ * `*applied`, and updates `*applied`.
+ */
+void quicpro_ticket_keys_apply_quiche(quiche_config *cfg, uint64_t *applied);
+
+/** @brief Installs the shared-key ticket callback on a TCP listener's context. */
+void quicpro_ticket_keys_install(SSL_CTX *ctx);
+
+#endif /* QUICPRO_SERVER_TICKET_KEYS_H */
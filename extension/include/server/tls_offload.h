@@ -0,0 +1,97 @@
+/*
+ * include/server/tls_offload.h – Off-loop TLS handshakes for the TCP listeners
+ * ============================================================================
+ *
+ * The HTTP/1 and HTTP/2 listeners run SSL_accept on their event loop. The
+ * server's private-key operation (an RSA-2048 signature costs about 1 ms)
+ * then stalls every established connection of that worker.
+ * `quicpro.tls_tcp_handshake_offload` selects where handshakes run:
+ *
+ * - "inline": on the event loop, as before.
+ * - "async": the context runs with SSL_MODE_ASYNC. An asynchronous engine
+ *   or provider, such as Intel QAT's, is loaded through the OpenSSL
+ *   configuration file. It pauses the handshake while the card signs, and
+ *   reports a wait fd that the loop watches next to the socket. Without
+ *   such an engine this behaves like "inline".
+ * - "threads": handshake steps run on a small pool of
+ *   `quicpro.tls_tcp_handshake_threads` threads. A finished step is handed
+ *   back through an eventfd, and the loop keeps serving established
+ *   connections in the meantime.
+ *
+ * Only one thread touches a given SSL at a time: the loop ignores
+ * readiness while a handshake is queued and re-queues it once the step
+ * comes back. The pool threads never call into the Zend engine.
+ */
+
+#ifndef QUICPRO_SERVER_TLS_OFFLOAD_H
+#define QUICPRO_SERVER_TLS_OFFLOAD_H
+
+#include <stdbool.h>
+
+#include <openssl/ssl.h>
+
+typedef struct quicpro_tls_offload_s quicpro_tls_offload_t;
+
+enum {
+    QUICPRO_TLS_HS_FAILED  = -1,
+    QUICPRO_TLS_HS_PENDING = 0,
+    QUICPRO_TLS_HS_DONE    = 1
+};
+
+/** Handshake state embedded in each TCP connection. */
+typedef struct quicpro_tls_handshake_s {
+    SSL   *ssl;
+    int    epoll_fd;
+    void  *owner;       /* epoll data.ptr of the connection */
+    bool   in_flight;   /* Queued on, or running in, the pool */
+    bool   rearm;       /* The socket became ready while in flight */
+    int    result;      /* Outcome of the last pooled step */
+    bool   has_result;
+    struct quicpro_tls_handshake_s *next;
+} quicpro_tls_handshake_t;
+
+/**
+ * @brief Applies the configured offload mode to a listener's context.
+ * @return The thread pool in "threads" mode, NULL otherwise (also when
+ * the pool cannot be started, which falls back to "inline").
+ */
+quicpro_tls_offload_t *quicpro_tls_offload_new(SSL_CTX *ctx);
+
+/** @brief Stops and joins the pool. Accepts NULL. */
+void quicpro_tls_offload_destroy(quicpro_tls_offload_t *o);
+
+/**
+ * @brief Registers the pool's completion eventfd with `epoll_fd`, using
+ * the pool itself as epoll data.ptr. Does nothing for NULL.
+ */
+void quicpro_tls_offload_watch(quicpro_tls_offload_t *o, int epoll_fd);
+
+/**
+ * @brief Collects finished pool steps after the completion fd fired.
+ * @return A list, linked through `next`, of handshakes whose owner should
+ * be stepped again. Save `next` before handling an entry; the handler
+ * may free it.
+ */
+quicpro_tls_handshake_t *quicpro_tls_offload_reap(quicpro_tls_offload_t *o);
+
+/** @brief Prepares the handshake state of a freshly accepted connection. */
+void quicpro_tls_handshake_init(quicpro_tls_handshake_t *hs, SSL *ssl, int epoll_fd, void *owner);
+
+/**
+ * @brief Advances the handshake, inline or through the pool `o`.
+ * @return QUICPRO_TLS_HS_DONE, QUICPRO_TLS_HS_PENDING (wait for the next
+ * event on the connection) or QUICPRO_TLS_HS_FAILED.
+ */
+int quicpro_tls_handshake_step(quicpro_tls_offload_t *o, quicpro_tls_handshake_t *hs);
+
+/**
+ * @brief Whether a failed SSL_read/SSL_write with return value `ret` is
+ * only waiting for the socket or an async engine. Keeps the engine's wait
+ * fds registered with the loop.
+ */
+bool quicpro_tls_io_pending(quicpro_tls_handshake_t *hs, int ret);
+
+/** @brief Removes any async engine wait fds from the loop before the SSL is freed. */
+void quicpro_tls_handshake_forget(quicpro_tls_handshake_t *hs);
+
+#endif /* QUICPRO_SERVER_TLS_OFFLOAD_H */
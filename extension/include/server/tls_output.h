@@ -0,0 +1,87 @@
+/*
+ * include/server/tls_output.h – Record-sized output batching for the TCP listeners
+ * ================================================================================
+ *
+ * Every byte the HTTP/1 and HTTP/2 listeners send passes through OpenSSL,
+ * which has no vectored write. One SSL_write becomes at least one TLS
+ * record with its own header, tag and, without kernel TLS, its own
+ * syscall. A response head written apart from its body costs a record.
+ * An HTTP/2 DATA frame that is one byte over the record size costs two.
+ *
+ * The output pipeline works on a gather list of (pointer, length) pieces:
+ *
+ * - Small pieces are copied into a per-connection stage of one record
+ *   (16 KiB). Status line, headers, short bodies and the small frames of
+ *   several HTTP/2 streams then share a record.
+ * - A piece of at least QUICPRO_TLS_OUTPUT_DIRECT_MIN bytes, met with the
+ *   stage empty, is handed to SSL_write_ex() where it lies. Only its
+ *   first record is copied, to top up a stage that already holds a head.
+ *
+ * A write that blocks is retried with the same buffer, as OpenSSL
+ * requires. The stage stays frozen until that retry succeeds.
+ */
+
+#ifndef QUICPRO_SERVER_TLS_OUTPUT_H
+#define QUICPRO_SERVER_TLS_OUTPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "server/tls_offload.h"
+
+#define QUICPRO_TLS_RECORD_MAX        16384               /* Plaintext bytes per TLS record */
+#define QUICPRO_TLS_OUTPUT_DIRECT_MIN 4096
+#define QUICPRO_TLS_OUTPUT_DIRECT_MAX (16 * QUICPRO_TLS_RECORD_MAX)
+
+/** One piece of a gather list. */
+typedef struct {
+    const char *base;
+    size_t      len;
+} quicpro_tls_iov_t;
+
+/** Per-connection output state. */
+typedef struct {
+    uint8_t *stage;       /* QUICPRO_TLS_RECORD_MAX bytes, allocated on first use */
+    size_t   stage_len;
+    bool     stage_busy;  /* A write of the stage blocked; retry it unchanged */
+} quicpro_tls_output_t;
+
+/** @brief Marks the output empty. Allocates nothing. */
+void quicpro_tls_output_init(quicpro_tls_output_t *o);
+
+/** @brief Frees the stage. Staged bytes are dropped. */
+void quicpro_tls_output_free(quicpro_tls_output_t *o);
+
+/**
+ * @brief Copies as much of `p` into the stage as fits.
+ * @return Bytes taken; 0 while the stage is full or busy.
+ */
+size_t quicpro_tls_output_stage(quicpro_tls_output_t *o, const void *p, size_t len);
+
+/**
+ * @brief Writes the staged bytes as one record.
+ * @return 1 when the stage is empty, 0 when the socket blocked, -1 on error.
+ */
+int quicpro_tls_output_flush(quicpro_tls_handshake_t *hs, quicpro_tls_output_t *o);
+
+/**
+ * @brief Writes `len` bytes in place with SSL_write_ex(). Nothing may be
+ * staged. After a 0 the same `p` and `len` must be passed again.
+ * @return 1 when written, 0 when the socket blocked, -1 on error.
+ */
+int quicpro_tls_output_write(quicpro_tls_handshake_t *hs, const void *p, size_t len);
+
+/**
+ * @brief Sends a gather list, resuming at byte `*done`, which it advances.
+ *
+ * The last partial record is left in the stage when `hold_tail` is set,
+ * so that the next response can share it. The caller flushes it once no
+ * further response follows right away.
+ * @return 1 when every byte was written (or staged, with `hold_tail`),
+ * 0 when the socket blocked, -1 on error.
+ */
+int quicpro_tls_output_gather(quicpro_tls_handshake_t *hs, quicpro_tls_output_t *o,
+                              const quicpro_tls_iov_t *iov, size_t iovcnt, size_t *done, bool hold_tail);
+
+#endif /* QUICPRO_SERVER_TLS_OUTPUT_H */
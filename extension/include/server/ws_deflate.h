@@ -0,0 +1,97 @@
+/*
+ * include/server/ws_deflate.h – permessage-deflate for WebSockets (RFC 7692)
+ * ==========================================================================
+ *
+ * Negotiation of the Sec-WebSocket-Extensions header for both roles, plus a
+ * per-connection compressor/decompressor pair. The window size (at most
+ * quicpro.websocket_deflate_max_window_bits) and context takeover are agreed
+ * separately for each direction. With no_context_takeover the zlib history
+ * is reset after every message. A connection then only needs its window
+ * while a message is in progress, however many connections sit idle.
+ *
+ * Without zlib at build time (QUICPRO_HAVE_ZLIB unset) nothing is offered
+ * and every offer is declined, so the connection runs uncompressed.
+ */
+
+#ifndef QUICPRO_SERVER_WS_DEFLATE_H
+#define QUICPRO_SERVER_WS_DEFLATE_H
+
+#include <php.h>
+#include <zend_smart_str.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Messages shorter than this are sent uncompressed; RSV1 is per message */
+#define QUICPRO_WS_DEFLATE_MIN_SIZE 64
+
+/** Agreed extension parameters; "server" and "client" are the RFC's roles. */
+typedef struct {
+    bool    server_no_context_takeover;
+    bool    client_no_context_takeover;
+    uint8_t server_max_window_bits;
+    uint8_t client_max_window_bits;
+} quicpro_ws_deflate_params_t;
+
+typedef struct quicpro_ws_deflate_s quicpro_ws_deflate_t;
+
+/**
+ * @brief Client: appends the extension offer built from the INI settings to
+ * `out`. Appends nothing if compression is disabled.
+ */
+void quicpro_ws_deflate_offer(smart_str *out);
+
+/**
+ * @brief Server: picks the first acceptable permessage-deflate offer in a
+ * request's Sec-WebSocket-Extensions value and appends the response value to
+ * `response`.
+ * @return false if none is acceptable; compression is then off.
+ */
+bool quicpro_ws_deflate_accept(const char *header, size_t len, quicpro_ws_deflate_params_t *params,
+                               smart_str *response);
+
+/**
+ * @brief Client: validates the server's Sec-WebSocket-Extensions response
+ * against our offer.
+ * @return false if it is malformed or asks for something we did not offer.
+ * RFC 7692 §5 then requires failing the connection.
+ */
+bool quicpro_ws_deflate_confirm(const char *header, size_t len, quicpro_ws_deflate_params_t *params);
+
+/** @brief Creates the zlib streams for one connection; NULL on failure. */
+quicpro_ws_deflate_t *quicpro_ws_deflate_new(const quicpro_ws_deflate_params_t *params, bool is_server);
+
+/**
+ * @brief Compresses one whole message.
+ * @return The payload for a frame with RSV1 set, or NULL on a zlib error.
+ */
+zend_string *quicpro_ws_deflate_compress(quicpro_ws_deflate_t *d, const uint8_t *in, size_t len);
+
+/**
+ * @brief Inflates the next piece of a message received with RSV1 set and
+ * appends the output to `out`. Pass `fin` with the message's last piece (an
+ * empty one is fine).
+ * @return false on corrupt data or once `out` would exceed `max_len` bytes.
+ */
+bool quicpro_ws_deflate_inflate(quicpro_ws_deflate_t *d, const uint8_t *in, size_t len, bool fin,
+                               size_t max_len, smart_str *out);
+
+/**
+ * @brief Decompresses one whole message received with RSV1 set.
+ * @return NULL on corrupt data or if the output would exceed `max_len`
+ * (a compression bomb).
+ */
+zend_string *quicpro_ws_deflate_decompress(quicpro_ws_deflate_t *d, const uint8_t *in, size_t len, size_t max_len);
+
+/**
+ * @brief Window bits of our compressor if it resets after every message,
+ * else 0. Only such a connection can take a message compressed once for
+ * many receivers by quicpro_ws_deflate_compress_once().
+ */
+int quicpro_ws_deflate_shared_window(const quicpro_ws_deflate_t *d);
+
+/** @brief Compresses one message with a fresh stream of `window_bits`; NULL on error. */
+zend_string *quicpro_ws_deflate_compress_once(const uint8_t *in, size_t len, int window_bits);
+
+void quicpro_ws_deflate_free(quicpro_ws_deflate_t *d);
+
+#endif /* QUICPRO_SERVER_WS_DEFLATE_H */
@@ -0,0 +1,74 @@
+/*
+ * include/server/ws_frame.h – WebSocket frame codec (RFC 6455 §5)
+ * ===============================================================
+ *
+ * Header encoding and decoding plus the masking kernel shared by the send
+ * and receive paths. Masking XORs 32 bytes per step with AVX2, 16 with
+ * SSE2 or NEON, and 8 otherwise, whichever the compiler targets. A sender
+ * sizes its frame with quicpro_ws_frame_size(), writes the header, and
+ * masks the payload straight from the caller's buffer into the frame, so
+ * the payload is copied exactly once. A receiver unmasks in place.
+ */
+
+#ifndef QUICPRO_SERVER_WS_FRAME_H
+#define QUICPRO_SERVER_WS_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define QUICPRO_WS_MAX_HEADER 14   /* 2 + 8 extended length + 4 mask key */
+#define QUICPRO_WS_RSV1       0x04 /* In quicpro_ws_frame_t.rsv: a permessage-deflate message */
+
+/* Return values of quicpro_ws_frame_parse() besides a header length */
+#define QUICPRO_WS_INCOMPLETE 0
+#define QUICPRO_WS_ERROR      (-1)
+
+typedef struct {
+    bool     fin;
+    uint8_t  rsv;           /* RSV1..3 as the low three bits; RSV1 is permessage-deflate */
+    uint8_t  opcode;
+    bool     masked;
+    uint8_t  mask[4];
+    uint64_t payload_len;
+} quicpro_ws_frame_t;
+
+/** @brief Header plus payload length of a frame carrying `payload_len` bytes. */
+static inline size_t quicpro_ws_frame_size(uint64_t payload_len, bool masked)
+{
+    size_t n = payload_len <= 125 ? 2 : payload_len <= 0xFFFF ? 4 : 10;
+    return n + (masked ? 4 : 0) + (size_t)payload_len;
+}
+
+/**
+ * @brief Writes a frame header into `out` (at least QUICPRO_WS_MAX_HEADER
+ * bytes). `rsv` takes the QUICPRO_WS_RSV* bits. `mask` may be NULL for an
+ * unmasked server frame.
+ * @return The header length; the payload starts there.
+ */
+size_t quicpro_ws_frame_header(uint8_t *out, bool fin, uint8_t rsv, uint8_t opcode, uint64_t payload_len,
+                               const uint8_t mask[4]);
+
+/**
+ * @brief Decodes the frame header at the start of `buf`.
+ * @return The header length, QUICPRO_WS_INCOMPLETE if more bytes are
+ * needed, or QUICPRO_WS_ERROR for a malformed header (a 64-bit length with
+ * the top bit set, or a fragmented or oversized control frame).
+ */
+ssize_t quicpro_ws_frame_parse(const uint8_t *buf, size_t len, quicpro_ws_frame_t *f);
+
+/**
+ * @brief dst[i] = src[i] ^ mask[(offset + i) % 4]. `dst` may equal `src`.
+ * `offset` is the payload position of src[0], so a payload can be
+ * masked in pieces.
+ */
+void quicpro_ws_mask_copy(uint8_t *dst, const uint8_t *src, size_t len, const uint8_t mask[4], size_t offset);
+
+/** @brief Masks or unmasks `buf` in place; see quicpro_ws_mask_copy(). */
+static inline void quicpro_ws_mask(uint8_t *buf, size_t len, const uint8_t mask[4], size_t offset)
+{
+    quicpro_ws_mask_copy(buf, buf, len, mask, offset);
+}
+
+#endif /* QUICPRO_SERVER_WS_FRAME_H */
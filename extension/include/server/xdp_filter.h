@@ -0,0 +1,102 @@
+/*
+ * include/server/xdp_filter.h – XDP pre-filter for the QUIC listeners
+ * ===================================================================
+ *
+ * With quicpro.security_xdp_filter_interface set, an XDP program on that
+ * interface looks at every UDP datagram for a listen port before the
+ * kernel allocates an skb for it. Anything that is not for a QUIC listener
+ * (another port, a fragment, VLAN-tagged or IPv6 with extension headers)
+ * passes untouched. A listener's datagram is dropped in the driver when:
+ *
+ * - its long header is malformed: shorter than the fixed fields, version
+ *   0 (only servers send Version Negotiation), or a connection ID longer
+ *   than 20 bytes;
+ * - it is a QUIC v1 Initial in a UDP payload below 1200 bytes, which
+ *   RFC 9000 §14.1 requires servers to discard anyway;
+ * - it is a v1 Initial from a source address that has already sent
+ *   quicpro.security_xdp_filter_initials_per_sec of them this second;
+ * - its short header carries a DCID no worker issued. The workers enter
+ *   every connection ID they accept in a BPF hash map and remove it
+ *   when the connection closes.
+ *
+ * Other long headers (Handshake, 0-RTT, other versions) and short headers without the fixed bit (router relays, see
+ * server/router.h) go on to the socket, where quiche and the router judge
+ * them as before. Listeners in router mode issue no connection IDs, so
+ * the DCID check is off there.
+ *
+ * The rate limit counts Initials in a fixed one-second window per source
+ * address, in an LRU map of QUICPRO_XDP_FILTER_SOURCES entries. It backs
+ * the token buckets of server/rate_limit.h, which still apply to what gets
+ * through. Counts of both CPUs racing on one address can be lost; the
+ * limit is approximate by that much.
+ *
+ * The maps and the program are created by the cluster master before it
+ * forks (or by a single process as its first listener binds), so all
+ * workers share one CID map. The program stays attached as long as the
+ * master holds its link. Loading needs CAP_BPF and CAP_NET_ADMIN, and
+ * Linux 5.9 for XDP links; without them, or on an interface that an AF_XDP
+ * socket (quicpro.io_xdp_interface) already serves, the listeners work as
+ * before after an E_NOTICE.
+ *
+ * Should the CID map fill up, for instance with the IDs of crashed
+ * workers' connections, the DCID check turns itself off instead of
+ * dropping new connections' traffic.
+ */
+
+#ifndef QUICPRO_SERVER_XDP_FILTER_H
+#define QUICPRO_SERVER_XDP_FILTER_H
+
+#include <php.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "server/cid.h"
+
+#define QUICPRO_XDP_FILTER_SOURCES      65536   /* Source addresses the rate limit tracks */
+#define QUICPRO_XDP_FILTER_PORTS        64
+#define QUICPRO_XDP_FILTER_MIN_INITIAL  1200    /* RFC 9000 §14.1 */
+
+/* Verdict counters, as quicpro_xdp_filter_stats() names them */
+#define QUICPRO_XDP_FILTER_PASSED       0
+#define QUICPRO_XDP_FILTER_MALFORMED    1
+#define QUICPRO_XDP_FILTER_SHORT_INITIAL 2
+#define QUICPRO_XDP_FILTER_RATE_LIMITED 3
+#define QUICPRO_XDP_FILTER_UNKNOWN_DCID 4
+#define QUICPRO_XDP_FILTER_COUNTERS     5
+
+/**
+ * @brief Creates the maps, loads the program and attaches it to the
+ * configured interface. Called by the cluster master before the first
+ * fork; a no-op when no interface is configured or it already ran.
+ */
+void quicpro_xdp_filter_prepare(void);
+
+/** @brief Detaches the program and closes the descriptors of quicpro_xdp_filter_prepare(). */
+void quicpro_xdp_filter_release(void);
+
+/**
+ * @brief Puts the port of the bound listener address `local` under the
+ * filter, preparing it first outside a cluster.
+ */
+void quicpro_xdp_filter_listen(const struct sockaddr *local);
+
+/** @brief Enters a connection ID a listener accepted in the shared map. */
+void quicpro_xdp_filter_cid_add(const uint8_t *cid, size_t len);
+
+/** @brief Removes a connection ID from the shared map. */
+void quicpro_xdp_filter_cid_del(const uint8_t *cid, size_t len);
+
+/** @brief Removes every connection ID of `t`'s sessions, as a listener closes. */
+void quicpro_xdp_filter_cid_del_all(const quicpro_cid_table_t *t);
+
+/**
+ * @brief quicpro_xdp_filter_stats(): ?array
+ * Datagrams the filter let through ('passed') and dropped ('malformed',
+ * 'short_initial', 'rate_limited', 'unknown_dcid') since it was attached,
+ * summed over all CPUs, plus 'dcid_check' (bool); null when no filter is
+ * attached.
+ */
+PHP_FUNCTION(quicpro_xdp_filter_stats);
+
+#endif /* QUICPRO_SERVER_XDP_FILTER_H */
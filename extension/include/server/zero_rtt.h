@@ -0,0 +1,78 @@
+/*
+ * include/server/zero_rtt.h – 0-RTT acceptance and anti-replay
+ * =============================================================
+ *
+ * With `quicpro.tls_enable_early_data` the listeners accept early data
+ * from resumed clients. Two levels of exposure:
+ *
+ * 1. Default: streams opened in 0-RTT still reach the request handler only
+ *    once the handshake completes. A replayed flight can never complete
+ *    the handshake, so nothing replayed is ever served. The client still
+ *    saves one round trip, because its request arrived with the first
+ *    flight.
+ *
+ * 2. `quicpro.tls_server_0rtt_early_dispatch`: streams are offered to the
+ *    handler while still in 0-RTT, as handler($session, $streamId, true).
+ *    Each stream is offered once. This needs the connection to pass an
+ *    anti-replay check first, and it is the per-route opt-in:
+ *    - A route that is idempotent and opted in serves the request
+ *      immediately.
+ *    - Any other route returns without reading, and the stream is offered
+ *      again with `$early = false` after the handshake.
+ *
+ * The anti-replay key is the first DCID the client used. It is covered by
+ * the AEAD of every 0-RTT packet, so a replay cannot change it without
+ * losing the early data. Keys live in shared memory created by the
+ * cluster master before forking, so a replay cannot succeed by landing
+ * on a different worker:
+ *
+ * - "single_use": open-addressed (tag, expiry) slots. It is exact, and
+ *   fails closed when a probe window is full.
+ * - "bloom": two bloom filters covering alternating windows, so each key
+ *   is checked against the current and the previous window. A false
+ *   positive only makes that request wait for the handshake.
+ *
+ * Either store has one lock, taken with a bounded spin. A check that
+ * cannot get it fails closed as well.
+ */
+
+#ifndef QUICPRO_SERVER_ZERO_RTT_H
+#define QUICPRO_SERVER_ZERO_RTT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <quiche.h>
+
+#include "client/session.h"
+
+/** @brief Maps the shared anti-replay store. Called by the cluster master before forking. */
+void quicpro_zero_rtt_prepare(void);
+
+/** @brief Unmaps the store of quicpro_zero_rtt_prepare(). */
+void quicpro_zero_rtt_release(void);
+
+/** @brief Enables early data on a listener's quiche config when configured. */
+void quicpro_zero_rtt_configure(quiche_config *cfg);
+
+/**
+ * @brief Records whether `key` was seen within the replay window.
+ * @return true the first time a key is seen within the window,
+ * false for a replay (or if the store is unavailable).
+ */
+bool quicpro_zero_rtt_admit(const uint8_t *key, size_t len);
+
+/** @brief Remembers the client's first DCID of a freshly accepted session. */
+void quicpro_zero_rtt_note_accept(quicpro_session_t *s, const uint8_t *dcid, size_t dcid_len);
+
+/**
+ * @brief Whether streams may be offered to the handler while `s` is still
+ * in 0-RTT. The anti-replay check runs once per connection.
+ */
+bool quicpro_zero_rtt_dispatchable(quicpro_session_t *s);
+
+/** @brief Marks `stream_id` as offered during 0-RTT; false if it already was. */
+bool quicpro_zero_rtt_offer(quicpro_session_t *s, uint64_t stream_id);
+
+#endif /* QUICPRO_SERVER_ZERO_RTT_H */
@@ -0,0 +1,94 @@
+/*
+ * include/smart_contracts/abi.h – Precompiled ABI event layouts
+ * =============================================================
+ *
+ * Every *.json file of quicpro.smartcontract_abi_directory is a contract's
+ * ABI: a JSON array of entries, or a build artifact with it under "abi"
+ * (Hardhat, Truffle, Foundry). The file name without its extension names
+ * the contract.
+ *
+ * Each event entry is compiled once into a layout: its topic (the
+ * keccak-256 of its canonical signature) and, per input, where the value
+ * sits (which topic, or which 32-byte word of the data head) and how it
+ * decodes. Decoding a log is then a lookup by its first topic and a walk
+ * over the fields, straight from the log's bytes into PHP values:
+ *
+ * - uintN and intN: an int when it fits 64 bits, else a decimal string
+ * - address: "0x" and 40 lowercase hex digits; bool: a bool
+ * - bytesN and bytes: "0x" and hex; string: the string
+ * - T[] of any of those but bytes and string: a list
+ * - anything else (tuples, fixed arrays, nested arrays) stays encoded:
+ *   "0x" and the hex of its words
+ *
+ * An indexed input of a dynamic type is only its keccak-256 in the log,
+ * and decodes to that, as hex. The layouts of a directory are kept for
+ * the process and compiled again only once the directory changes.
+ */
+
+#ifndef QUICPRO_SMART_CONTRACTS_ABI_H
+#define QUICPRO_SMART_CONTRACTS_ABI_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "smart_contracts/keccak.h"
+
+typedef enum {
+    QUICPRO_ABI_UINT,
+    QUICPRO_ABI_INT,
+    QUICPRO_ABI_ADDRESS,
+    QUICPRO_ABI_BOOL,
+    QUICPRO_ABI_FIXED_BYTES,
+    QUICPRO_ABI_BYTES,
+    QUICPRO_ABI_STRING,
+    QUICPRO_ABI_LIST,               /* T[] of a one-word T: `elem` */
+    QUICPRO_ABI_RAW,
+} quicpro_abi_kind_t;
+
+typedef struct {
+    zend_string        *name;       /* Empty for an unnamed input */
+    quicpro_abi_kind_t  kind, elem;
+    uint16_t            size;       /* Bytes of bytesN, of the list's bytesN */
+    bool                indexed, dynamic;
+    uint32_t            words;      /* 32-byte words it takes in the head */
+    uint32_t            at;         /* Its topic (1..3), or its first word in the data head */
+} quicpro_abi_field_t;
+
+typedef struct {
+    zend_string         *contract, *name, *signature;
+    uint8_t              topic[QUICPRO_KECCAK_LEN];
+    uint32_t             head_words;
+    uint32_t             nfields;
+    quicpro_abi_field_t *fields;
+} quicpro_abi_event_t;
+
+/* The layouts of one directory; shared by reference */
+typedef struct quicpro_abi_s quicpro_abi_t;
+
+/** @brief The compiled layouts of `directory`; NULL with the reason in `err`. */
+quicpro_abi_t *quicpro_abi_open(const char *directory, char *err, size_t err_len);
+void quicpro_abi_release(quicpro_abi_t *abi);
+
+uint32_t quicpro_abi_count(const quicpro_abi_t *abi);
+const quicpro_abi_event_t *quicpro_abi_at(const quicpro_abi_t *abi, uint32_t i);
+
+/** @brief The event whose topic is `topic`, or NULL. */
+const quicpro_abi_event_t *quicpro_abi_find(const quicpro_abi_t *abi, const uint8_t topic[QUICPRO_KECCAK_LEN]);
+
+/**
+ * @brief Decodes a log of `ev` into `args` (initialised here): [name =>
+ * value], unnamed inputs by position. `topics` are the log's 32-byte
+ * topics, the event's own first. @return false if the log is too short
+ * for the layout.
+ */
+bool quicpro_abi_decode(const quicpro_abi_event_t *ev, const uint8_t (*topics)[32], uint32_t ntopics,
+                        const uint8_t *data, size_t len, zval *args);
+
+/** @brief Sets up the process's layout cache (MINIT). */
+void quicpro_abi_minit(void);
+
+/** @brief Frees the process's layouts (MSHUTDOWN). */
+void quicpro_abi_mshutdown(void);
+
+#endif /* QUICPRO_SMART_CONTRACTS_ABI_H */
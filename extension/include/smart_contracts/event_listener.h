@@ -0,0 +1,48 @@
+/*
+ * include/smart_contracts/event_listener.h – Quicpro\SmartContracts\EventListener
+ * ===============================================================================
+ *
+ * Contract events as they reach the chain, decoded in C from the layouts
+ * of quicpro.smartcontract_abi_directory (smart_contracts/abi.h):
+ *
+ *     $l = new Quicpro\SmartContracts\EventListener([
+ *         'address' => '0xa0b8...eb48',
+ *         'events'  => ['Transfer', 'Vault.Settled'],
+ *     ]);
+ *     foreach ($l->poll(1000) as $e) {               // waits up to 1 s
+ *         // ['contract' => 'Token', 'event' => 'Transfer', 'args' => ['from' => '0x...',
+ *         //  'to' => '0x...', 'value' => 1000], 'block_number' => 19000000, 'removed' => false, ...]
+ *     }
+ *
+ * With a ws_endpoint it subscribes (eth_subscribe) to new heads and to
+ * the filtered logs, and the node pushes them. Without one, or once the
+ * socket fails, it falls back to batched JSON-RPC over the pooled HTTP
+ * client (http_client.h): a poll costs one batch for the head and a reorg
+ * check, and one for up to batch_blocks blocks of logs and the header of
+ * the last, however many events they hold.
+ *
+ * Events are handed out once their block has `confirmations` blocks on
+ * top. Every block that held events is kept in a cache of cache_blocks
+ * blocks by number and hash, with its events (block()); a block that
+ * turns out to have left the chain hands its events out again, with
+ * 'removed' => true, and the listener reads the new chain from the fork.
+ *
+ * Options: endpoint (quicpro.smartcontract_dlt_rpc_endpoint), ws_endpoint,
+ * address (one or a list), events (names, or "Contract.Event"; all of the
+ * directory's by default), abi_directory, from_block (the head by
+ * default), confirmations (12), batch_blocks (2000), cache_blocks (256),
+ * poll_interval_ms (1000) and rpc_timeout_ms (10000). Takes
+ * quicpro.smartcontract_event_listener_enable.
+ */
+
+#ifndef QUICPRO_SMART_CONTRACTS_EVENT_LISTENER_H
+#define QUICPRO_SMART_CONTRACTS_EVENT_LISTENER_H
+
+#include <php.h>
+
+extern zend_class_entry *quicpro_ce_event_listener;
+
+/** @brief Registers Quicpro\SmartContracts\EventListener (MINIT). */
+void quicpro_event_listener_minit(void);
+
+#endif /* QUICPRO_SMART_CONTRACTS_EVENT_LISTENER_H */
@@ -0,0 +1,71 @@
+/*
+ * include/smart_contracts/json.h – JSON token scanner
+ * ===================================================
+ *
+ * JSON-RPC replies and ABI files are read where they lie: one pass turns
+ * the text into a flat array of tokens, each a span of the text and the
+ * index of the token after its subtree, and callers walk that instead of
+ * building zvals they would only take apart again. Strings keep their
+ * escapes; what the listener reads (hex quantities, type and field names)
+ * has none.
+ */
+
+#ifndef QUICPRO_SMART_CONTRACTS_JSON_H
+#define QUICPRO_SMART_CONTRACTS_JSON_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    QUICPRO_JSON_OBJECT,
+    QUICPRO_JSON_ARRAY,
+    QUICPRO_JSON_STRING,            /* start..end: between the quotes */
+    QUICPRO_JSON_PRIMITIVE,         /* A number, true, false or null */
+} quicpro_json_type_t;
+
+typedef struct {
+    quicpro_json_type_t type;
+    uint32_t            start, end; /* Offsets into the text */
+    uint32_t            size;       /* Members of an object, elements of an array */
+    uint32_t            skip;       /* The token after this one's subtree */
+} quicpro_json_tok_t;
+
+typedef struct {
+    const char         *text;
+    quicpro_json_tok_t *tok;        /* emalloc'd */
+    uint32_t            count;
+} quicpro_json_t;
+
+#define QUICPRO_JSON_NONE UINT32_MAX
+
+/** @brief Scans `len` bytes of `text`; false if it is not one JSON value. */
+bool quicpro_json_parse(quicpro_json_t *j, const char *text, size_t len);
+void quicpro_json_free(quicpro_json_t *j);
+
+/** @brief The value of `key` in the object at `obj`, or QUICPRO_JSON_NONE. */
+uint32_t quicpro_json_get(const quicpro_json_t *j, uint32_t obj, const char *key);
+
+/** @brief The first element of the array (or member key of the object) at `at`; step with its skip. */
+static inline uint32_t quicpro_json_first(const quicpro_json_t *j, uint32_t at)
+{
+    return at != QUICPRO_JSON_NONE && j->tok[at].size ? at + 1 : QUICPRO_JSON_NONE;
+}
+
+static inline size_t quicpro_json_len(const quicpro_json_t *j, uint32_t at)
+{
+    return j->tok[at].end - j->tok[at].start;
+}
+
+static inline const char *quicpro_json_str(const quicpro_json_t *j, uint32_t at)
+{
+    return j->text + j->tok[at].start;
+}
+
+/** @brief Whether token `at` is the string `s`. */
+bool quicpro_json_is(const quicpro_json_t *j, uint32_t at, const char *s);
+
+/** @brief A quantity, "0x"-hex or decimal, in `*out`; false if `at` is none or does not fit 64 bits. */
+bool quicpro_json_u64(const quicpro_json_t *j, uint32_t at, uint64_t *out);
+
+#endif /* QUICPRO_SMART_CONTRACTS_JSON_H */
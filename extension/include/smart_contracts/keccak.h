@@ -0,0 +1,19 @@
+/*
+ * include/smart_contracts/keccak.h – Keccak-256
+ * =============================================
+ *
+ * The hash Ethereum names events and functions by: Keccak with a 1088-bit
+ * rate and the original 0x01 padding, not NIST SHA3-256.
+ */
+
+#ifndef QUICPRO_SMART_CONTRACTS_KECCAK_H
+#define QUICPRO_SMART_CONTRACTS_KECCAK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define QUICPRO_KECCAK_LEN 32
+
+void quicpro_keccak256(const void *data, size_t len, uint8_t out[QUICPRO_KECCAK_LEN]);
+
+#endif /* QUICPRO_SMART_CONTRACTS_KECCAK_H */
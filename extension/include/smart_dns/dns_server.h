@@ -0,0 +1,85 @@
+/*
+ * include/smart_dns/dns_server.h – Native DNS responder
+ * =====================================================
+ *
+ * quicpro_dns_server_run() turns the calling worker into a DNS server on
+ * quicpro.dns_server_bind_host:quicpro.dns_server_port, over UDP and,
+ * with quicpro.dns_server_enable_tcp, TCP (RFC 7766: length-prefixed
+ * messages, several per connection). It does not return unless it fails;
+ * no query reaches PHP.
+ *
+ * Queries are read and answered in batches: one recvmmsg() takes up to
+ * quicpro.io_max_batch_read_packets datagrams, each answer is built in
+ * its transmit slot, and one sendmmsg() sends them all. Answers come from
+ * the compiled zone index (smart_dns/zone.h) of
+ * quicpro.dns_static_zone_file_path: the header and question of the query
+ * followed by precomputed sections, nothing allocated. The socket uses
+ * SO_REUSEPORT, so the workers of a cluster each run the loop on their
+ * own core over one address and share nothing but the mapped image.
+ *
+ * Answers are authoritative for names inside the index; names outside it
+ * get REFUSED, a name that does not exist NXDOMAIN with the zone's SOA.
+ * EDNS (RFC 6891) is honoured up to quicpro.dns_edns_udp_payload_size;
+ * a UDP answer that does not fit the client's limit is truncated (TC), and
+ * the client retries over TCP. The loop checks the zone file once a
+ * second and swaps in a new index when it changed; a file that does not
+ * compile leaves the previous one serving, with a warning.
+ *
+ * Modes: "authoritative" needs the zone file; "service_discovery" serves
+ * it when present, and answers A and AAAA queries for the names the
+ * Cluster Health Agent reports from its feed (smart_dns/service_discovery.h)
+ * ahead of the zone. "recursive_resolver" is not served by this engine.
+ */
+
+#ifndef QUICPRO_SMART_DNS_SERVER_H
+#define QUICPRO_SMART_DNS_SERVER_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "smart_dns/zone.h"
+#include "smart_dns/service_discovery.h"
+
+#define QUICPRO_DNS_UDP_MAX     4096    /* Largest UDP answer, whatever EDNS allows */
+#define QUICPRO_DNS_TCP_MAX     65535
+
+/* Where answers come from, per the quicpro.dns_* settings */
+typedef struct {
+    quicpro_dns_zone_t           *zone;     /* NULL: none (yet) */
+    quicpro_dns_sd_t             *sd;       /* The health feed, in "service_discovery" mode */
+    const quicpro_dns_sd_table_t *sd_table; /* Its table for this round */
+    uint32_t                      ttl;
+    uint64_t                      reload_at;
+} quicpro_dns_source_t;
+
+/**
+ * @brief Opens the zone and starts the health feed as the mode asks.
+ * @return false after throwing (DNS disabled, an unusable mode or zone).
+ */
+bool quicpro_dns_source_open(quicpro_dns_source_t *src);
+
+/**
+ * @brief Once per round of a loop that answers from `src`: takes the
+ * feed's current table and, once a second, swaps in a changed zone.
+ */
+void quicpro_dns_source_tick(quicpro_dns_source_t *src);
+
+/** @brief Closes the zone and stops the feed. */
+void quicpro_dns_source_close(quicpro_dns_source_t *src);
+
+/**
+ * @brief Answers the DNS query `q` into `out` (`cap` bytes).
+ * @param z The zone index, or NULL.
+ * @param sd The health feed's table, or NULL. With neither, everything is refused.
+ * @param udp Whether the answer must fit the query's UDP limit.
+ * @return The answer's length, or 0 to send nothing (not a query).
+ */
+size_t quicpro_dns_respond(const quicpro_dns_zone_t *z, const quicpro_dns_sd_table_t *sd, const uint8_t *q, size_t len,
+                           uint8_t *out, size_t cap, bool udp);
+
+/* quicpro_dns_server_run(): bool */
+PHP_FUNCTION(quicpro_dns_server_run);
+
+#endif /* QUICPRO_SMART_DNS_SERVER_H */
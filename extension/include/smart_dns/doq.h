@@ -0,0 +1,70 @@
+/*
+ * include/smart_dns/doq.h – DNS over QUIC (RFC 9250) on the listeners
+ * ===================================================================
+ *
+ * A listener whose Config offers "doq" among its ALPN protocols serves
+ * DNS over QUIC beside whatever else it speaks, once
+ * quicpro.dns_server_enable is on:
+ *
+ *     $config = Quicpro\Config::new(['alpn' => ['h3', 'doq'], ...]);
+ *     quicpro_server_listen(quicpro_server_create('::', 853, $config), $handler);
+ *
+ * The streams of a connection that negotiated "doq" never reach the
+ * handler. Each carries one query, a two-byte length and a message with
+ * ID 0, and gets its answer on the same stream, built by
+ * quicpro_dns_respond() from the same zone and health feed the UDP/TCP
+ * server uses (smart_dns/dns_server.h), opened on the worker's first DoQ
+ * query. Answers are never truncated. Queries in 0-RTT are answered in
+ * 0-RTT, whether or not quicpro.tls_server_0rtt_early_dispatch is on:
+ * they change nothing, and zone transfers, which RFC 9250 keeps out of
+ * 0-RTT, are refused anyway. A connection takes queries until its idle
+ * timeout, so a resolver keeps one to each server and multiplexes its
+ * queries over it, each on its own stream.
+ *
+ * A query on anything but a client-initiated bidirectional stream, with a
+ * nonzero ID, or with data after the message closes the connection with
+ * DOQ_PROTOCOL_ERROR.
+ */
+
+#ifndef QUICPRO_SMART_DNS_DOQ_H
+#define QUICPRO_SMART_DNS_DOQ_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "client/session.h"
+
+#define QUICPRO_DOQ_NO_ERROR            0x0
+#define QUICPRO_DOQ_INTERNAL_ERROR      0x1
+#define QUICPRO_DOQ_PROTOCOL_ERROR      0x2
+#define QUICPRO_DOQ_REQUEST_CANCELLED   0x3
+#define QUICPRO_DOQ_EXCESSIVE_LOAD      0x4
+
+typedef struct quicpro_doq_conn_s quicpro_doq_conn_t;
+
+/** @brief Whether `s` negotiated "doq" with the DNS server enabled: its streams go to quicpro_doq_stream(). */
+bool quicpro_doq_session(const quicpro_session_t *s);
+
+/**
+ * @brief Reads what `stream_id` has; answers once the query is complete.
+ * @return true if anything was written to the connection.
+ */
+bool quicpro_doq_stream(quicpro_session_t *s, uint64_t stream_id);
+
+/** @brief Sends what flow control held back of the answers; true if anything was written. */
+bool quicpro_doq_flush(quicpro_session_t *s);
+
+/** @brief Once a listener round: keeps the worker's zone and feed current. */
+void quicpro_doq_tick(void);
+
+/** @brief Frees a connection's unfinished queries. NULL-safe. */
+void quicpro_doq_conn_free(quicpro_doq_conn_t *c);
+
+/** @brief Whether no query is open (include/poll/hibernate.h). */
+bool quicpro_doq_conn_idle(const quicpro_doq_conn_t *c);
+
+/** @brief Closes the worker's zone and feed (RSHUTDOWN). */
+void quicpro_doq_rshutdown(void);
+
+#endif /* QUICPRO_SMART_DNS_DOQ_H */
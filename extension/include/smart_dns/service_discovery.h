@@ -0,0 +1,71 @@
+/*
+ * include/smart_dns/service_discovery.h – Health-aware answers from the Cluster Health Agent
+ * ==========================================================================================
+ *
+ * In "service_discovery" mode a feed thread keeps one long-lived request
+ * open to the agent at quicpro.dns_health_agent_mcp_endpoint,
+ * GET /health/stream, and the agent pushes a line whenever a node's health
+ * or load changes:
+ *
+ *     <service name> <ip> <load>      The node serves the name at this load
+ *     <service name> <ip> down        It no longer does
+ *     sync                            The state sent on connect is complete
+ *
+ * and a blank line at least every 10 seconds while nothing changes; a
+ * stream silent for 30 seconds is reconnected. On every (re)connect the
+ * agent first sends the whole state and then "sync", and nodes it did not
+ * name again are dropped; until then the previous state keeps serving.
+ *
+ * The thread owns the local table of services and their nodes. Each chunk
+ * the agent sends is applied as one delta: only the services it touched
+ * get their answers rebuilt, as A and AAAA answer sections of at most
+ * quicpro.dns_service_discovery_max_ips_per_response addresses, the least
+ * loaded first. The answers are immutable and indexed by a new table added
+ * beside the current one, whose pointer is then swapped. The DNS loop
+ * reads it once per round, never waits, and reports the generation it has
+ * moved to; the thread frees what no round can still be using, as the
+ * router does with its routing tables (server/router.h). Answers thus lag
+ * the agent by one push, and a query never leaves the worker.
+ *
+ * The agent's endpoint speaks plain HTTP here: the MCP client needs PHP
+ * resources, which a thread of its own cannot use.
+ */
+
+#ifndef QUICPRO_SMART_DNS_SERVICE_DISCOVERY_H
+#define QUICPRO_SMART_DNS_SERVICE_DISCOVERY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "smart_dns/zone.h"
+
+typedef struct quicpro_dns_sd_s quicpro_dns_sd_t;
+typedef struct quicpro_dns_sd_table_s quicpro_dns_sd_table_t;
+
+/**
+ * @brief Starts the feed from `endpoint` ("host:port" or a URL).
+ * @param max_ips Addresses per answer section.
+ * @param ttl TTL of the answers.
+ * @return NULL with a message in `err`.
+ */
+quicpro_dns_sd_t *quicpro_dns_sd_start(const char *endpoint, uint32_t max_ips, uint32_t ttl, char *err, size_t err_len);
+
+/**
+ * @brief The current table, valid until the next call. Called once per
+ * round of the DNS loop, which also tells the thread what it may free.
+ */
+const quicpro_dns_sd_table_t *quicpro_dns_sd_acquire(quicpro_dns_sd_t *sd);
+
+/**
+ * @brief Answers `name` (wire format, lower case, `len` bytes) for `qtype`
+ * from `t` (NULL-safe).
+ * @return false if the table does not know the name.
+ */
+bool quicpro_dns_sd_lookup(const quicpro_dns_sd_table_t *t, const uint8_t *name, size_t len, uint16_t qtype,
+                           quicpro_dns_answer_t *out);
+
+/** @brief Stops the thread and frees everything. NULL-safe. */
+void quicpro_dns_sd_stop(quicpro_dns_sd_t *sd);
+
+#endif /* QUICPRO_SMART_DNS_SERVICE_DISCOVERY_H */
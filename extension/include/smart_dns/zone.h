@@ -0,0 +1,110 @@
+/*
+ * include/smart_dns/zone.h – Compiled zone index of the Smart DNS server
+ * ======================================================================
+ *
+ * A BIND-style zone file ($ORIGIN, $TTL, parentheses, relative names;
+ * A, AAAA, CNAME, NS, PTR, MX, SRV, TXT and SOA records) is compiled once
+ * into a flat image that the server maps read-only and answers from
+ * without parsing or allocating:
+ *
+ * - A radix tree over the reversed labels: "www.example.com" is the node
+ *   www under example under com. A node's children sit next to each other,
+ *   sorted, and are found by binary search, so a lookup costs one search
+ *   per label. A "*" child answers for names that do not exist below its
+ *   parent (RFC 4592).
+ * - Every RRset is stored as the answer section it becomes, in wire
+ *   format, its owner a compression pointer to the question (offset 12).
+ *   Every name in the zone is thus a precomputed answer: a response is
+ *   the query's header and question followed by one memcpy.
+ * - Zone apexes carry their SOA, and delegation points their NS set and
+ *   its glue, ready for the authority and additional sections of
+ *   negative answers and referrals.
+ *
+ * The image holds offsets only, so it is the same in memory and on disk.
+ * quicpro_dns_zone_open() maps "<zone file>.qpz" when that was compiled
+ * from the zone file as it is now, and compiles (and writes it, where it
+ * may) otherwise; the workers of a cluster then share one copy in the
+ * page cache. quicpro_dns_zone_compile() does the same ahead of time.
+ */
+
+#ifndef QUICPRO_SMART_DNS_ZONE_H
+#define QUICPRO_SMART_DNS_ZONE_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define QUICPRO_DNS_TYPE_A      1
+#define QUICPRO_DNS_TYPE_NS     2
+#define QUICPRO_DNS_TYPE_CNAME  5
+#define QUICPRO_DNS_TYPE_SOA    6
+#define QUICPRO_DNS_TYPE_PTR    12
+#define QUICPRO_DNS_TYPE_MX     15
+#define QUICPRO_DNS_TYPE_TXT    16
+#define QUICPRO_DNS_TYPE_AAAA   28
+#define QUICPRO_DNS_TYPE_SRV    33
+#define QUICPRO_DNS_TYPE_OPT    41
+#define QUICPRO_DNS_TYPE_DS     43
+#define QUICPRO_DNS_TYPE_IXFR   251
+#define QUICPRO_DNS_TYPE_AXFR   252
+#define QUICPRO_DNS_TYPE_ANY    255
+
+#define QUICPRO_DNS_RCODE_NOERROR   0
+#define QUICPRO_DNS_RCODE_FORMERR   1
+#define QUICPRO_DNS_RCODE_SERVFAIL  2
+#define QUICPRO_DNS_RCODE_NXDOMAIN  3
+#define QUICPRO_DNS_RCODE_NOTIMP    4
+#define QUICPRO_DNS_RCODE_REFUSED   5
+
+#define QUICPRO_DNS_NAME_MAX    255     /* Wire bytes of a name, root label included */
+
+typedef struct quicpro_dns_zone_s quicpro_dns_zone_t;
+
+/* What a lookup found: sections to append to the question, pointing into the image */
+typedef struct {
+    uint8_t        rcode;
+    bool           authoritative;   /* false for a referral */
+    const uint8_t *answer;
+    uint32_t       answer_len;
+    uint16_t       answer_count;
+    const uint8_t *authority;
+    uint32_t       authority_len;
+    uint16_t       authority_count;
+    const uint8_t *additional;      /* Glue of a referral */
+    uint32_t       additional_len;
+    uint16_t       additional_count;
+} quicpro_dns_answer_t;
+
+/**
+ * @brief Compiles `zone_file` into an image at `image_path`.
+ * @param default_ttl TTL of records without one before any $TTL.
+ * @return false with a message ("line N: ...") in `err`.
+ */
+bool quicpro_dns_zone_compile(const char *zone_file, const char *image_path, uint32_t default_ttl,
+                              char *err, size_t err_len);
+
+/**
+ * @brief The index of `zone_file`: its current "<zone_file>.qpz" mapped,
+ * or a fresh compile. NULL with a message in `err`.
+ */
+quicpro_dns_zone_t *quicpro_dns_zone_open(const char *zone_file, uint32_t default_ttl, char *err, size_t err_len);
+
+/** @brief Whether the zone file changed since `z` was compiled from it. */
+bool quicpro_dns_zone_stale(const quicpro_dns_zone_t *z);
+
+/** @brief Unmaps or frees `z`. NULL-safe. */
+void quicpro_dns_zone_close(quicpro_dns_zone_t *z);
+
+/**
+ * @brief Looks up `name` (wire format, lower case, `len` bytes with the
+ * root label) for `qtype`.
+ * @return false if no zone in the index contains the name.
+ */
+bool quicpro_dns_zone_lookup(const quicpro_dns_zone_t *z, const uint8_t *name, size_t len, uint16_t qtype,
+                             quicpro_dns_answer_t *out);
+
+/* quicpro_dns_zone_compile(string $zoneFile, ?string $imagePath = null): bool */
+PHP_FUNCTION(quicpro_dns_zone_compile);
+
+#endif /* QUICPRO_SMART_DNS_ZONE_H */
@@ -0,0 +1,94 @@
+/*
+ * include/ssh_over_quic/gateway.h – SSH-over-QUIC gateway on the listeners
+ * ========================================================================
+ *
+ * A listener whose Config offers "quicpro-ssh" among its ALPN protocols
+ * is an SSH bastion once quicpro.ssh_gateway_enable is on:
+ *
+ *     $config = Quicpro\Config::new(['alpn' => ['quicpro-ssh'], 'verify_peer' => true, ...]);
+ *     quicpro_server_listen(quicpro_server_create(ini_get('quicpro.ssh_gateway_listen_host'),
+ *                                                 (int)ini_get('quicpro.ssh_gateway_listen_port'), $config), $handler);
+ *
+ * The streams of a connection that negotiated "quicpro-ssh" never reach
+ * the handler. Each client-initiated bidirectional stream carries one SSH
+ * connection, byte for byte as a ProxyCommand would pipe it, and gets a
+ * TCP connection of its own to the target sshd. A client running several
+ * sessions over one QUIC connection gives each its stream, so a lost
+ * packet stalls only the session it belonged to. The gateway does not
+ * terminate SSH: the channels inside a session are encrypted end to end
+ * and share that session's stream.
+ *
+ * Bytes move through a pair of pipes per stream: splice() takes what the
+ * target sends straight into one, and the other feeds the target socket.
+ * quiche encrypts from user memory, so the copy into its send buffer
+ * stays; what the pipes save is a window per stream in user space, and a
+ * direction stops being read while its pipe is full, so a slow side holds
+ * back the other instead of filling memory. The target sockets sit in the
+ * listener's epoll set only while there is something for them to do; with
+ * io_uring they are looked at once a round.
+ *
+ * Sessions last as long as the QUIC connection. A client moving from Wi-Fi
+ * to LTE migrates it (server/path.h) and sshd, which never sees the move,
+ * keeps the TCP connection; the Config's idle timeout bounds how long the
+ * handoff may take. A stream quiet in both directions for
+ * quicpro.ssh_gateway_idle_timeout_sec is closed.
+ *
+ * Authentication happens once the handshake completes, before any stream
+ * is served:
+ * - "mtls": the client must have presented a certificate, which quiche has
+ *   verified against the listener's CA;
+ * - "mcp_token" is not served natively; such connections are closed.
+ *
+ * Targets: "static" sends every stream to
+ * quicpro.ssh_gateway_default_target_host/_port. "user_profile" asks
+ * quicpro.ssh_gateway_user_profile_agent_uri once per connection, with
+ * ?user=<certificate CN>, and expects "host[:port]" back; the lookup
+ * blocks the worker for at most quicpro.ssh_gateway_target_connect_timeout_ms.
+ * With quicpro.ssh_gateway_log_session_activity, every stream's target,
+ * byte counts and end go to the error log.
+ */
+
+#ifndef QUICPRO_SSH_OVER_QUIC_GATEWAY_H
+#define QUICPRO_SSH_OVER_QUIC_GATEWAY_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "client/session.h"
+
+#define QUICPRO_SSH_ALPN                "quicpro-ssh"
+#define QUICPRO_SSH_WINDOW              (64 * 1024)    /* Pipe size per stream and direction */
+
+/* Application error codes: connection close (auth, mapping) and stream resets */
+#define QUICPRO_SSH_NO_ERROR            0x0
+#define QUICPRO_SSH_INTERNAL_ERROR      0x1
+#define QUICPRO_SSH_AUTH_REQUIRED       0x2
+#define QUICPRO_SSH_NO_TARGET           0x3
+#define QUICPRO_SSH_TARGET_UNREACHABLE  0x4
+#define QUICPRO_SSH_TARGET_RESET        0x5
+#define QUICPRO_SSH_IDLE_TIMEOUT        0x6
+
+typedef struct quicpro_ssh_conn_s quicpro_ssh_conn_t;
+
+/** @brief Whether `s` negotiated "quicpro-ssh" with the gateway enabled: its streams go to quicpro_ssh_gateway_stream(). */
+bool quicpro_ssh_gateway_session(const quicpro_session_t *s);
+
+/**
+ * @brief Takes what `stream_id` has towards its target, connecting it on
+ * its first bytes. `epoll_fd` is the listener's (-1 for none).
+ * @return true if anything was written to the connection.
+ */
+bool quicpro_ssh_gateway_stream(quicpro_session_t *s, uint64_t stream_id, int epoll_fd);
+
+/**
+ * @brief Once a round for an established gateway session: finishes
+ * connects, moves what the targets sent, ends idle streams.
+ * @return true if anything was written to the connection.
+ */
+bool quicpro_ssh_gateway_pump(quicpro_session_t *s, int epoll_fd);
+
+/** @brief Closes a connection's target sockets and pipes. NULL-safe. */
+void quicpro_ssh_conn_free(quicpro_ssh_conn_t *c);
+
+#endif /* QUICPRO_SSH_OVER_QUIC_GATEWAY_H */
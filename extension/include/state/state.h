@@ -0,0 +1,110 @@
+/*
+ * include/state/state.h – Key-value state for agents
+ * ==================================================
+ *
+ * Session and conversation state, one value per key, in the backend named
+ * by quicpro.state_manager_default_backend:
+ *
+ *     $v = quicpro_state_set('session:42', $blob);              // int, the new version
+ *     $blob = quicpro_state_get('session:42');                  // ?string
+ *     $all = quicpro_state_mget(['session:42', 'conv:7']);      // key => ?string
+ *     $versions = quicpro_state_mset(['conv:7' => $a, 'conv:8' => $b]);
+ *     quicpro_state_delete(['conv:7', 'conv:8']);
+ *
+ * Backends:
+ * - "memory": this worker's own table; it lasts as long as the worker.
+ * - "redis": quicpro.state_manager_default_uri is
+ *   "redis://[user:password@]host[:port][/db]" (or tcp://). Each worker
+ *   keeps one connection across requests and speaks RESP3 on it. A key is
+ *   a hash of its value and its version; the commands of a multi-get or
+ *   multi-set go out in one write and their replies are read back in one
+ *   pass, so a batch of any size costs one round trip. The connection has
+ *   client tracking on, and Redis's invalidation pushes drop the keys it
+ *   names from the local cache.
+ * - "mcp": quicpro.state_manager_default_uri is "mcp://host:port", a state
+ *   agent serving the methods get, set and delete of service "state" (see
+ *   below), over pooled connections.
+ * "sqlite" and "postgres" are not served natively; the calls throw.
+ *
+ * With a remote backend, values go through the local read-through cache
+ * (state/state_cache.h): a key found there is answered without the
+ * network, and only the rest of a multi-get is asked for. Every call waits
+ * at most quicpro.state_manager_request_timeout_ms for the backend.
+ *
+ * Keys are 1 to QUICPRO_STATE_KEY_MAX bytes without a newline. Versions
+ * start at 1 and grow with every write to the key.
+ *
+ * The state agent's payloads, in order of the keys asked for:
+ * - get: "<key>\n" per key; answered by "<version> <length>\n<value>" per
+ *   key, version 0 (length 0) for an absent one;
+ * - set: "<key>\n<length>\n<value>" per key; answered by "<version>\n" per key;
+ * - delete: "<key>\n" per key; answered by anything.
+ */
+
+#ifndef QUICPRO_STATE_STATE_H
+#define QUICPRO_STATE_STATE_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define QUICPRO_STATE_KEY_MAX 250
+
+/*
+ * A backend. Each call takes a batch and throws on failure. A get fills
+ * values[i] (a string the caller owns, NULL when absent) and versions[i];
+ * a set fills versions[i] with the version each value became.
+ */
+typedef struct {
+    void (*sync)(void);             /* Takes in pending invalidations before the cache is asked; may be NULL */
+    bool (*get)(zend_string *const *keys, size_t n, zend_string **values, uint64_t *versions);
+    bool (*set)(zend_string *const *keys, zend_string *const *values, size_t n, uint64_t *versions);
+    bool (*del)(zend_string *const *keys, size_t n);
+    bool   remote;                  /* Answers go through the local cache */
+} quicpro_state_backend_t;
+
+extern const quicpro_state_backend_t quicpro_state_redis_backend;
+
+/*
+ * The calls below for C callers, on keys that are already valid. Each
+ * takes a batch and is false after throwing.
+ */
+
+/**
+ * @brief Fills values[i] for each key (NULL when absent): from the local
+ * cache where it can, the rest from the backend in one batch. After a
+ * failure no value is left to free.
+ */
+bool quicpro_state_fetch(zend_string *const *keys, size_t n, zend_string **values);
+
+/** @brief Writes the batch; versions[i] is the version each value became. */
+bool quicpro_state_store(zend_string *const *keys, zend_string *const *values, size_t n, uint64_t *versions);
+
+/** @brief Deletes the keys, absent ones included. */
+bool quicpro_state_remove(zend_string *const *keys, size_t n);
+
+/* quicpro_state_get(string $key): ?string */
+PHP_FUNCTION(quicpro_state_get);
+
+/* quicpro_state_mget(array $keys): array – key => ?string */
+PHP_FUNCTION(quicpro_state_mget);
+
+/* quicpro_state_set(string $key, string $value): int – the new version */
+PHP_FUNCTION(quicpro_state_set);
+
+/* quicpro_state_mset(array $values): array – key => version */
+PHP_FUNCTION(quicpro_state_mset);
+
+/* quicpro_state_delete(string|array $keys): bool */
+PHP_FUNCTION(quicpro_state_delete);
+
+/** @brief Drops the MCP backend's Config (RSHUTDOWN). */
+void quicpro_state_rshutdown(void);
+
+/** @brief Closes the Redis connection and frees the memory backend (MSHUTDOWN). */
+void quicpro_state_mshutdown(void);
+
+/** @brief Closes the worker's Redis connection. */
+void quicpro_state_redis_close(void);
+
+#endif /* QUICPRO_STATE_STATE_H */
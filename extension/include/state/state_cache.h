@@ -0,0 +1,45 @@
+/*
+ * include/state/state_cache.h – Local read-through cache of the state API
+ * =======================================================================
+ *
+ * Values read from or written to a remote state backend are kept in a
+ * table the cluster master maps shared before forking, so one worker's
+ * read serves every worker of the host. Each entry carries the version
+ * the backend gave the value, and an entry is only ever replaced by a
+ * newer version: a read that raced a write cannot put the older value
+ * back. A write through this host updates the entry at once for all of
+ * its workers; a change made elsewhere drops it when the backend says so
+ * (Redis invalidation pushes, see include/state/state.h) and in any case
+ * once quicpro.state_manager_local_cache_ttl_ms has passed.
+ *
+ * The table has quicpro.state_manager_local_cache_entries slots of
+ * quicpro.state_manager_local_cache_entry_max_kb each, in the layout of
+ * cluster/shm_cache.h; a larger value is simply not kept.
+ */
+
+#ifndef QUICPRO_STATE_CACHE_H
+#define QUICPRO_STATE_CACHE_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief Maps the table shared, if enabled. Called by the cluster master before forking. */
+void quicpro_state_cache_prepare(void);
+
+/** @brief Unmaps the table. */
+void quicpro_state_cache_release(void);
+
+/**
+ * @brief The fresh value of `key`, or NULL on a miss (or with the cache
+ * off). The caller owns the string; `version` (may be NULL) gets its version.
+ */
+zend_string *quicpro_state_cache_get(const char *key, size_t key_len, uint64_t *version);
+
+/** @brief Keeps `value` as version `version` of `key`, unless a newer one is kept already. */
+void quicpro_state_cache_put(const char *key, size_t key_len, const zend_string *value, uint64_t version);
+
+/** @brief Drops the entry of `key`. */
+void quicpro_state_cache_forget(const char *key, size_t key_len);
+
+#endif /* QUICPRO_STATE_CACHE_H */
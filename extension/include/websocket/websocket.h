@@ -61,6 +61,18 @@ PHP_FUNCTION(quicpro_ws_send);
  */
 PHP_FUNCTION(quicpro_ws_receive);
 
+/*
+ * PHP_FUNCTION(quicpro_ws_receive_chunk);
+ * --------------------------------------
+ * Streaming receive: the next piece of the current message as soon as any
+ * of it has arrived, at most quicpro.websocket_receive_chunk_size wire bytes.
+ *
+ * Userland Signature:
+ * array|false|null quicpro_ws_receive_chunk(resource $ws_connection [, int $timeout_ms = -1])
+ *   – ['data' => string, 'binary' => bool, 'fin' => bool]
+ */
+PHP_FUNCTION(quicpro_ws_receive_chunk);
+
 /*
  * PHP_FUNCTION(quicpro_ws_get_status);
  * -----------------------------------
@@ -72,6 +84,17 @@ PHP_FUNCTION(quicpro_ws_receive);
  */
 PHP_FUNCTION(quicpro_ws_get_status);
 
+/*
+ * PHP_FUNCTION(quicpro_ws_get_stats);
+ * ----------------------------------
+ * Worker-wide codec counters: frames, wire bytes, bytes copied, masking
+ * volume and time, and deflate/inflate bytes in and out.
+ *
+ * Userland Signature:
+ * array quicpro_ws_get_stats()
+ */
+PHP_FUNCTION(quicpro_ws_get_stats);
+
 /*
  * PHP_FUNCTION(quicpro_ws_get_last_error);
  * ---------------------------------------
@@ -92,4 +115,34 @@ PHP_FUNCTION(quicpro_ws_get_last_error);
  */
 PHP_FUNCTION(quicpro_ws_upgrade);
 
+/*
+ * PHP_FUNCTION(quicpro_ws_subscribe) / quicpro_ws_unsubscribe / quicpro_ws_publish
+ * ------------------------------------------------------------------------------
+ * Broadcast hub for server-side connections. A published message is framed
+ * (and, where the peer allows, compressed) once. That one frame is then
+ * shared by reference across every subscriber's send queue. Subscribers
+ * past quicpro.websocket_send_queue_high_watermark are skipped or closed.
+ *
+ * Userland Signatures:
+ * bool quicpro_ws_subscribe(resource $ws_connection, string $topic)
+ * bool quicpro_ws_unsubscribe(resource $ws_connection, string $topic)
+ * int  quicpro_ws_publish(string $topic, string $data [, bool $is_binary = false])
+ */
+PHP_FUNCTION(quicpro_ws_subscribe);
+PHP_FUNCTION(quicpro_ws_unsubscribe);
+PHP_FUNCTION(quicpro_ws_publish);
+
+/*
+ * PHP_FUNCTION(quicpro_ws_flush);
+ * ------------------------------
+ * Moves queued frames into the QUIC stream as flow control allows.
+ *
+ * Userland Signature:
+ * int|false quicpro_ws_flush(resource $ws_connection)  – bytes still queued
+ */
+PHP_FUNCTION(quicpro_ws_flush);
+
+/* Drops every topic at request end (RSHUTDOWN); connections unsubscribe in their destructors. */
+void quicpro_ws_hub_rshutdown(void);
+
 #endif /* QUICPRO_WEBSOCKET_H */
\ No newline at end of file
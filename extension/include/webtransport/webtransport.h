@@ -0,0 +1,64 @@
+#ifndef QUICPRO_WEBTRANSPORT_H
+#define QUICPRO_WEBTRANSPORT_H
+
+#include <php.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "client/session.h"
+
+/**
+ * @file extension/include/webtransport/webtransport.h
+ * @brief WebTransport over HTTP/3 (draft-ietf-webtrans-http3).
+ *
+ * A session is an extended CONNECT request with `:protocol: webtransport`.
+ * Its stream ID is the session ID. Inside the session the application gets:
+ * - bidirectional and unidirectional QUIC streams, each starting with a
+ *   signal value and the session ID;
+ * - unreliable QUIC DATAGRAM frames, each prefixed with the quarter stream
+ *   ID of the CONNECT stream (RFC 9297).
+ * Datagrams are never retransmitted and never wait behind a lost packet on
+ * some stream, which suits game state and market data. The CONNECT stream
+ * itself only carries capsules such as CLOSE_WEBTRANSPORT_SESSION.
+ *
+ * A QUIC connection that carries a WebTransport session is dedicated to
+ * it. quiche has no WebTransport support, so this module reads the
+ * session's streams before the HTTP/3 layer sees them. Any peer stream
+ * past the HTTP/3 control and QPACK streams is therefore taken to belong
+ * to the session. Ordinary requests must use another connection.
+ *
+ * Client:
+ *
+ *     $wt = quicpro_webtransport_connect($session, '/game');
+ *     quicpro_webtransport_send_datagram($wt, $state);
+ *     foreach (quicpro_webtransport_poll($wt, 50) as $ev) { ... }
+ *
+ * Server: inside the quicpro_http3_server_listen() callback, call
+ * quicpro_webtransport_accept($session) on the connection's first stream.
+ * Then poll with a zero timeout. The server loop owns the socket and sends
+ * whatever the calls queued.
+ *
+ * Both sides need quicpro.webtransport_enable. It turns on extended CONNECT
+ * in the HTTP/3 settings and QUIC DATAGRAM support in the transport, with
+ * queues of quicpro.transport_dgram_recv_queue_len and
+ * quicpro.transport_dgram_send_queue_len entries.
+ */
+
+/** Per-session state behind a `Quicpro\WebTransport` resource. */
+typedef struct quicpro_wt_s quicpro_wt_t;
+
+/** Resource type id of WebTransport sessions, registered in MINIT. */
+extern int le_quicpro_wt;
+
+/** @brief Registers the WebTransport resource type. Called from MINIT. */
+void quicpro_wt_minit(int module_number);
+
+PHP_FUNCTION(quicpro_webtransport_connect);
+PHP_FUNCTION(quicpro_webtransport_accept);
+PHP_FUNCTION(quicpro_webtransport_open_stream);
+PHP_FUNCTION(quicpro_webtransport_stream_send);
+PHP_FUNCTION(quicpro_webtransport_send_datagram);
+PHP_FUNCTION(quicpro_webtransport_poll);
+PHP_FUNCTION(quicpro_webtransport_close);
+
+#endif // QUICPRO_WEBTRANSPORT_H
@@ -0,0 +1,232 @@
+/*
+ * alt_svc.c  –  Per-process Alt-Svc cache for the php-quicpro client
+ * -------------------------------------------------------------------
+ *
+ * See include/client/alt_svc.h. Entries are keyed by "host:port" with the
+ * host lowercased. An entry outlives its alternative while it is marked
+ * broken, so a failure count survives the server announcing h3 again.
+ */
+
+#include "php_quicpro.h"
+#include "client/alt_svc.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define ALT_SVC_MAX_ENTRIES       1024
+#define ALT_SVC_KEY_MAX           (255 + 1 + 20 + 1)    /* Host, ":", port, NUL */
+#define ALT_SVC_DEFAULT_MA_SEC    86400                 /* RFC 7838 §3.1 */
+#define ALT_SVC_BROKEN_BASE_MS    (5 * 60 * 1000)
+#define ALT_SVC_BROKEN_MAX_MS     (48 * 3600 * 1000ULL)
+
+typedef struct {
+    uint64_t expires_ms;        /* 0: no alternative known */
+    uint64_t broken_until_ms;
+    uint32_t failures;          /* Failed attempts in a row */
+    uint16_t h3_port;
+} alt_svc_entry_t;
+
+static HashTable alt_svc_cache;
+static bool      alt_svc_ready;
+
+static uint64_t alt_svc_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static size_t alt_svc_key(char *buf, size_t cap, const char *host, zend_long port) {
+    int n = snprintf(buf, cap, "%s:" ZEND_LONG_FMT, host, port);
+    size_t len = n < 0 ? 0 : MIN((size_t)n, cap - 1);
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (char)tolower((unsigned char)buf[i]);
+    }
+    return len;
+}
+
+static void alt_svc_entry_dtor(zval *zv) {
+    pefree(Z_PTR_P(zv), 1);
+}
+
+static int alt_svc_prune(zval *zv, void *arg) {
+    alt_svc_entry_t *e = Z_PTR_P(zv);
+    uint64_t now = *(uint64_t *)arg;
+    return e->expires_ms <= now && e->broken_until_ms <= now ? ZEND_HASH_APPLY_REMOVE : ZEND_HASH_APPLY_KEEP;
+}
+
+static alt_svc_entry_t *alt_svc_find(const char *host, zend_long port, bool create) {
+    char key[ALT_SVC_KEY_MAX];
+    size_t len = alt_svc_key(key, sizeof(key), host, port);
+
+    alt_svc_entry_t *e = alt_svc_ready ? zend_hash_str_find_ptr(&alt_svc_cache, key, len) : NULL;
+    if (e || !create) {
+        return e;
+    }
+    if (!alt_svc_ready) {
+        zend_hash_init(&alt_svc_cache, 64, NULL, alt_svc_entry_dtor, 1);
+        alt_svc_ready = true;
+    }
+    if (zend_hash_num_elements(&alt_svc_cache) >= ALT_SVC_MAX_ENTRIES) {
+        uint64_t now = alt_svc_now_ms();
+        zend_hash_apply_with_argument(&alt_svc_cache, alt_svc_prune, &now);
+        if (zend_hash_num_elements(&alt_svc_cache) >= ALT_SVC_MAX_ENTRIES) {
+            return NULL;
+        }
+    }
+    e = pecalloc(1, sizeof(*e), 1);
+    return zend_hash_str_add_ptr(&alt_svc_cache, key, len, e);
+}
+
+/*──────────────────────────── Parser ─────────────────────────────────────*/
+
+static const char *alt_svc_skip_ows(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    return p;
+}
+
+/* Reads a token or a quoted string (without its quotes) into `v`. */
+static const char *alt_svc_value(const char *p, const char *end, const char **v, size_t *v_len) {
+    if (p < end && *p == '"') {
+        const char *close = memchr(p + 1, '"', end - p - 1);
+        const char *stop = close ? close : end;
+        *v = p + 1;
+        *v_len = stop - *v;
+        return close ? close + 1 : end;
+    }
+    *v = p;
+    while (p < end && *p != ',' && *p != ';' && *p != ' ' && *p != '\t' && *p != '=') {
+        p++;
+    }
+    *v_len = p - *v;
+    return p;
+}
+
+/* Splits `host:port` or `[v6]:port`; 0 if it is not on `origin` or malformed. */
+static uint16_t alt_svc_same_host_port(const char *a, size_t a_len, const char *origin) {
+    const char *colon = a + a_len;
+    while (colon > a && *--colon != ':') {
+    }
+    if (*colon != ':' || colon + 1 == a + a_len) {
+        return 0;
+    }
+    zend_long port = 0;
+    for (const char *d = colon + 1; d < a + a_len; d++) {
+        if (*d < '0' || *d > '9' || (port = port * 10 + (*d - '0')) > 65535) {
+            return 0;
+        }
+    }
+    const char *h = a;
+    size_t h_len = colon - a;
+    if (h_len >= 2 && h[0] == '[' && h[h_len - 1] == ']') {
+        h++;
+        h_len -= 2;
+    }
+    if (h_len > 0 && (strlen(origin) != h_len || strncasecmp(h, origin, h_len) != 0)) {
+        return 0;
+    }
+    return (uint16_t)port;
+}
+
+void quicpro_alt_svc_learn(const char *host, zend_long port, const char *value, size_t value_len) {
+    const char *p = value, *end = value + value_len;
+    uint16_t h3_port = 0;
+    zend_long ma = ALT_SVC_DEFAULT_MA_SEC;
+
+    while (p < end) {
+        p = alt_svc_skip_ows(p, end);
+        if (p < end && *p == ',') {
+            p++;
+            continue;
+        }
+        const char *proto, *authority = NULL;
+        size_t proto_len, authority_len = 0;
+        p = alt_svc_value(p, end, &proto, &proto_len);
+        if (proto_len == 5 && strncasecmp(proto, "clear", 5) == 0 && (p == end || *p != '=')) {
+            alt_svc_entry_t *e = alt_svc_find(host, port, false);
+            if (e) {
+                e->expires_ms = 0;
+            }
+            return;
+        }
+        if (p < end && *p == '=') {
+            p = alt_svc_value(p + 1, end, &authority, &authority_len);
+        }
+
+        zend_long entry_ma = ALT_SVC_DEFAULT_MA_SEC;
+        for (p = alt_svc_skip_ows(p, end); p < end && *p == ';'; p = alt_svc_skip_ows(p, end)) {
+            const char *name, *v = NULL;
+            size_t name_len, v_len = 0;
+            p = alt_svc_value(alt_svc_skip_ows(p + 1, end), end, &name, &name_len);
+            if (p < end && *p == '=') {
+                p = alt_svc_value(p + 1, end, &v, &v_len);
+            }
+            if (name_len == 2 && strncasecmp(name, "ma", 2) == 0 && v_len > 0) {
+                entry_ma = ZEND_STRTOL(v, NULL, 10);
+            }
+        }
+        /* Skip whatever this parser did not understand up to the next entry */
+        while (p < end && *p != ',') {
+            p++;
+        }
+
+        /* The first h3 entry wins: the server lists them by preference */
+        if (!h3_port && proto_len == 2 && strncmp(proto, "h3", 2) == 0 && authority) {
+            h3_port = alt_svc_same_host_port(authority, authority_len, host);
+            ma = entry_ma;
+        }
+    }
+
+    /* A new header replaces what the origin announced before (RFC 7838 §3) */
+    alt_svc_entry_t *e = alt_svc_find(host, port, h3_port != 0 && ma > 0);
+    if (!e) {
+        return;
+    }
+    if (h3_port && ma > 0) {
+        e->h3_port = h3_port;
+        e->expires_ms = alt_svc_now_ms() + (uint64_t)ma * 1000;
+    } else {
+        e->expires_ms = 0;
+    }
+}
+
+/*──────────────────────────── Lookups ────────────────────────────────────*/
+
+zend_long quicpro_alt_svc_h3_port(const char *host, zend_long port) {
+    alt_svc_entry_t *e = alt_svc_find(host, port, false);
+    uint64_t now = alt_svc_now_ms();
+    if (!e || e->expires_ms <= now || e->broken_until_ms > now) {
+        return 0;
+    }
+    return e->h3_port;
+}
+
+void quicpro_alt_svc_mark_broken(const char *host, zend_long port) {
+    alt_svc_entry_t *e = alt_svc_find(host, port, true);
+    if (!e) {
+        return;
+    }
+    uint64_t backoff = (uint64_t)ALT_SVC_BROKEN_BASE_MS << MIN(e->failures, 10u);
+    e->broken_until_ms = alt_svc_now_ms() + MIN(backoff, ALT_SVC_BROKEN_MAX_MS);
+    e->failures++;
+}
+
+void quicpro_alt_svc_mark_working(const char *host, zend_long port) {
+    alt_svc_entry_t *e = alt_svc_find(host, port, false);
+    if (e) {
+        e->failures = 0;
+        e->broken_until_ms = 0;
+    }
+}
+
+void quicpro_alt_svc_mshutdown(void) {
+    if (alt_svc_ready) {
+        zend_hash_destroy(&alt_svc_cache);
+        alt_svc_ready = false;
+    }
+}
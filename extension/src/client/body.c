@@ -0,0 +1,66 @@
+#include "php_quicpro.h"
+#include "client/body.h"
+
+/**
+ * @file extension/src/client/body.c
+ * @brief In-place receiving of response bodies, see client/body.h.
+ */
+
+zend_long quicpro_body_length(const uint8_t *value, size_t len) {
+    zend_long length = 0;
+
+    if (len == 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (value[i] < '0' || value[i] > '9' || length > (ZEND_LONG_MAX - 9) / 10) {
+            return -1;
+        }
+        length = length * 10 + (value[i] - '0');
+    }
+    return length;
+}
+
+void quicpro_body_reserve(smart_str *body, zend_long expected) {
+    if (expected < 0) {
+        return;
+    }
+    /* One byte more, so the read that finds the stream drained has room to try */
+    smart_str_alloc(body, (size_t)MIN(expected, (zend_long)QUICPRO_BODY_RESERVE_MAX) + 1, 0);
+}
+
+ssize_t quicpro_body_recv_h3(quiche_h3_conn *h3, quiche_conn *conn, uint64_t stream_id, smart_str *body) {
+    ssize_t n;
+
+    for (;;) {
+        size_t len = body->s ? ZSTR_LEN(body->s) : 0;
+        if (!body->s || body->a == len) {
+            smart_str_alloc(body, MAX(len, (size_t)QUICPRO_BODY_MIN_ROOM), 0);   /* Doubles */
+        }
+        n = quiche_h3_recv_body(h3, conn, stream_id, (uint8_t *)ZSTR_VAL(body->s) + len, body->a - len);
+        if (n <= 0) {
+            return n;
+        }
+        ZSTR_LEN(body->s) += (size_t)n;
+    }
+}
+
+zend_string *quicpro_body_take(smart_str *body) {
+    zend_string *s = body->s;
+
+    if (!s) {
+        return ZSTR_EMPTY_ALLOC();
+    }
+    if (ZSTR_LEN(s) == 0) {
+        smart_str_free(body);
+        return ZSTR_EMPTY_ALLOC();
+    }
+    /* Doubling may have left up to half the string unused */
+    if (body->a - ZSTR_LEN(s) > QUICPRO_BODY_MIN_ROOM + ZSTR_LEN(s) / 8) {
+        s = zend_string_truncate(s, ZSTR_LEN(s), 0);
+    }
+    ZSTR_VAL(s)[ZSTR_LEN(s)] = '\0';
+    body->s = NULL;
+    body->a = 0;
+    return s;
+}
@@ -0,0 +1,479 @@
+#include "php_quicpro.h"
+#include "client/datagram.h"
+#include "client/dgram_fec.h"
+#include "object_store/erasure.h"
+#include "config/quic_transport/base_layer.h"
+#include "poll/poll.h"
+#include "poll/scheduler.h"
+
+#include <quiche.h>
+#include <zend_smart_str.h>
+
+/**
+ * @file extension/src/client/datagram.c
+ * @brief Batch transfer of QUIC datagrams between quiche and PHP.
+ *
+ * Client sessions own their socket, so the calls here move packets
+ * themselves: a receive reads the socket before draining quiche's queue,
+ * a send flushes afterwards. Server sessions are driven by the listener
+ * loop. There the calls only touch quiche's queues and never block.
+ */
+
+extern int le_quicpro;           /* quicpro_connect() sessions */
+extern int le_quicpro_session;   /* quicpro_client_session_connect() and server sessions */
+
+/*───────────────────────────── Helpers ───────────────────────────────────*/
+
+static quicpro_session_t *dg_fetch_session(zval *z_sess) {
+    quicpro_session_t *s = (quicpro_session_t *)zend_fetch_resource2_ex(z_sess, "Quicpro\\Session", le_quicpro, le_quicpro_session);
+    if (!s) {
+        return NULL;
+    }
+    if (!s->conn || s->is_closed) {
+        throw_quic_exception(0, "Session is closed");
+        return NULL;
+    }
+    if (s->wt) {
+        throw_quic_exception(0, "This connection carries a WebTransport session; use its datagram functions");
+        return NULL;
+    }
+    return s;
+}
+
+/*
+ * Reads the socket until quiche holds at least one datagram, or
+ * `timeout_ms` passes. Returns the number queued (possibly 0), or -1
+ * after throwing.
+ */
+static ssize_t dg_await(quicpro_session_t *s, zend_resource *res, zend_long timeout_ms) {
+    zend_long start = quicpro_sched_clock_ms();
+    for (;;) {
+        quicpro_sched_pump_rx(s);
+        ssize_t queued = (ssize_t)quiche_conn_dgram_recv_queue_len(s->conn);
+        if (queued > 0) {
+            quicpro_sched_pump_tx(s);   /* ACKs for what we just read */
+            return queued;
+        }
+        quicpro_sched_pump_tx(s);
+        int rc = quicpro_sched_wait_conn(s, res, start, timeout_ms, "datagrams");
+        if (rc <= 0) {
+            return rc;
+        }
+    }
+}
+
+/* Parses the $max argument: 0 means the configured receive queue length. */
+static bool dg_batch_limit(zend_long max, uint32_t arg_num, zend_long *limit) {
+    zend_long cap = quicpro_quic_transport_config.dgram_recv_queue_len;
+    if (max < 0) {
+        zend_argument_value_error(arg_num, "must be greater than or equal to 0");
+        return false;
+    }
+    *limit = (max == 0 || max > cap) ? cap : max;
+    return true;
+}
+
+/* The largest payload the peer accepts now, or -1 after throwing. */
+static ssize_t dg_writable(quicpro_session_t *s) {
+    ssize_t max = quiche_conn_dgram_max_writable_len(s->conn);
+    if (max < 0) {
+        throw_quic_exception((int)max, "QUIC datagrams are not available on this connection yet "
+                             "(handshake incomplete, or not enabled by the peer)");
+        return -1;
+    }
+    return max;
+}
+
+/*
+ * Queues one datagram. When quiche's send queue is full the connection
+ * is flushed once and the datagram retried. Returns 1 if queued, 0 if the
+ * queue stayed full, -1 after throwing.
+ */
+static int dg_queue(quicpro_session_t *s, const char *data, size_t len, ssize_t max) {
+    if (len > (size_t)max) {
+        throw_quic_exception(0, "Datagram of %zu bytes exceeds the %zd the current path allows", len, max);
+        return -1;
+    }
+    for (int attempt = 0; attempt < 2; attempt++) {
+        ssize_t rc = quiche_conn_dgram_send(s->conn, (const uint8_t *)data, len);
+        if (rc >= 0) {
+            return 1;
+        }
+        if (rc != QUICHE_ERR_DONE) {
+            throw_quic_exception((int)rc, "Failed to queue QUIC datagram: %s", quiche_error_t_to_string((int)rc));
+            return -1;
+        }
+        if (!quicpro_sched_owns_io(s)) {
+            break;
+        }
+        quicpro_session_pump_tx(s);
+    }
+    return 0;
+}
+
+/* The session's FEC state, made on first use; NULL while FEC is off. */
+static quicpro_dgram_fec_t *dg_fec(quicpro_session_t *s) {
+    if (!s->dgram_fec) {
+        const qp_quic_transport_config_t *cfg = &quicpro_quic_transport_config;
+        s->dgram_fec = quicpro_dgram_fec_create((size_t)MAX(cfg->max_send_udp_payload_size, cfg->max_recv_udp_payload_size));
+    }
+    return s->dgram_fec;
+}
+
+/* Sends the repairs of the current FEC block. Returns -1 after throwing. */
+static int dg_fec_flush(quicpro_session_t *s, quicpro_dgram_fec_t *fec, ssize_t max) {
+    const uint8_t *wire[QUICPRO_EC_MAX_SHARDS];
+    size_t wire_len[QUICPRO_EC_MAX_SHARDS];
+    unsigned n = quicpro_dgram_fec_repair(fec, wire, wire_len);
+    for (unsigned j = 0; j < n; j++) {
+        int rc = dg_queue(s, (const char *)wire[j], wire_len[j], max);
+        if (rc < 0) {
+            return -1;
+        }
+        if (rc == 0) {
+            quicpro_dgram_fec_repair_dropped(fec);
+        }
+    }
+    return 0;
+}
+
+/*
+ * dg_queue() for one payload of a send call: framed as a source datagram
+ * of the current block when FEC is on, with the block's repairs following
+ * once it is full.
+ */
+static int dg_send(quicpro_session_t *s, quicpro_dgram_fec_t *fec, const char *data, size_t len, ssize_t max) {
+    if (!fec) {
+        return dg_queue(s, data, len, max);
+    }
+    size_t wire_len;
+    const uint8_t *wire = len + QUICPRO_DGRAM_FEC_OVERHEAD <= (size_t)max
+        ? quicpro_dgram_fec_frame(fec, (const uint8_t *)data, len, &wire_len) : NULL;
+    if (!wire) {
+        throw_quic_exception(0, "Datagram of %zu bytes exceeds the %zd the current path allows with FEC framing",
+                             len, max - QUICPRO_DGRAM_FEC_OVERHEAD);
+        return -1;
+    }
+    int rc = dg_queue(s, (const char *)wire, wire_len, max);
+    if (rc == 1 && quicpro_dgram_fec_sent(fec) && dg_fec_flush(s, fec, max) < 0) {
+        return -1;
+    }
+    return rc;
+}
+
+static void dg_deliver_zval(void *ctx, const uint8_t *payload, size_t len) {
+    add_next_index_stringl((zval *)ctx, (const char *)payload, len);
+}
+
+static void dg_deliver_packed(void *ctx, const uint8_t *payload, size_t len) {
+    smart_str *out = (smart_str *)ctx;
+    smart_str_appendc(out, (char)(len >> 8));
+    smart_str_appendc(out, (char)(len & 0xff));
+    smart_str_appendl(out, (const char *)payload, len);
+}
+
+/*
+ * Takes up to `limit` datagrams from quiche through the FEC receiver,
+ * which hands on their payloads and any datagrams they let it rebuild.
+ */
+static void dg_recv_fec(quicpro_session_t *s, quicpro_dgram_fec_t *fec, zend_long limit,
+                        quicpro_dgram_fec_deliver_t deliver, void *ctx) {
+    size_t cap;
+    uint8_t *buf = quicpro_dgram_fec_rx_buffer(fec, &cap);
+    while (limit-- > 0) {
+        ssize_t n = quiche_conn_dgram_recv(s->conn, buf, cap);
+        if (n == QUICHE_ERR_BUFFER_TOO_SHORT) {
+            continue;   /* Larger than any datagram FEC frames; quiche dropped it */
+        }
+        if (n < 0) {
+            break;
+        }
+        quicpro_dgram_fec_receive(fec, buf, (size_t)n, deliver, ctx);
+    }
+}
+
+/*─────────────────────────── PHP functions ───────────────────────────────*/
+
+/* {{{ quicpro_datagram_send_batch(resource $session, array $datagrams): int
+ *
+ * Queues each string of $datagrams in order and flushes the connection.
+ * Returns how many were queued. That is fewer than given only if quiche's
+ * send queue (quicpro.transport_dgram_send_queue_len) stayed full; the
+ * caller retries the rest later. Throws for a datagram larger than the
+ * path allows. Those before it are already queued.
+ */
+PHP_FUNCTION(quicpro_datagram_send_batch)
+{
+    zval *z_sess;
+    HashTable *datagrams;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_RESOURCE(z_sess)
+        Z_PARAM_ARRAY_HT(datagrams)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = dg_fetch_session(z_sess);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    ssize_t max = dg_writable(s);
+    if (max < 0) {
+        RETURN_THROWS();
+    }
+    quicpro_dgram_fec_t *fec = dg_fec(s);
+
+    zend_long sent = 0;
+    zval *zv;
+    ZEND_HASH_FOREACH_VAL(datagrams, zv) {
+        ZVAL_DEREF(zv);
+        if (Z_TYPE_P(zv) != IS_STRING) {
+            zend_argument_type_error(2, "must contain only strings, %s given", zend_zval_type_name(zv));
+            RETURN_THROWS();
+        }
+        int rc = dg_send(s, fec, Z_STRVAL_P(zv), Z_STRLEN_P(zv), max);
+        if (rc < 0) {
+            quicpro_sched_pump_tx(s);
+            RETURN_THROWS();
+        }
+        if (rc == 0) {
+            break;
+        }
+        sent++;
+    } ZEND_HASH_FOREACH_END();
+
+    if (fec && dg_fec_flush(s, fec, max) < 0) {
+        quicpro_sched_pump_tx(s);
+        RETURN_THROWS();
+    }
+    quicpro_sched_pump_tx(s);
+    RETURN_LONG(sent);
+}
+/* }}} */
+
+/* {{{ quicpro_datagram_send_packed(resource $session, string $packed): int
+ *
+ * Like quicpro_datagram_send_batch(), but takes the packed record format
+ * of include/client/datagram.h: a 16-bit big-endian length before each
+ * payload. The payloads go to quiche straight from $packed. Returns how
+ * many records were queued. A truncated record is an error.
+ */
+PHP_FUNCTION(quicpro_datagram_send_packed)
+{
+    zval *z_sess;
+    zend_string *packed;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_RESOURCE(z_sess)
+        Z_PARAM_STR(packed)
+    ZEND_PARSE_PARAMETERS_END();
+
+    const uint8_t *p = (const uint8_t *)ZSTR_VAL(packed);
+    const uint8_t *end = p + ZSTR_LEN(packed);
+
+    /* Check the framing up front, so a bad buffer queues nothing. */
+    for (const uint8_t *q = p; q < end; ) {
+        if (end - q < 2 || ((size_t)q[0] << 8 | q[1]) > (size_t)(end - q - 2)) {
+            zend_argument_value_error(2, "has a truncated record at offset %zu", (size_t)(q - p));
+            RETURN_THROWS();
+        }
+        q += 2 + ((size_t)q[0] << 8 | q[1]);
+    }
+
+    quicpro_session_t *s = dg_fetch_session(z_sess);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    ssize_t max = dg_writable(s);
+    if (max < 0) {
+        RETURN_THROWS();
+    }
+    quicpro_dgram_fec_t *fec = dg_fec(s);
+
+    zend_long sent = 0;
+    while (p < end) {
+        size_t len = (size_t)p[0] << 8 | p[1];
+        int rc = dg_send(s, fec, (const char *)p + 2, len, max);
+        if (rc < 0) {
+            quicpro_sched_pump_tx(s);
+            RETURN_THROWS();
+        }
+        if (rc == 0) {
+            break;
+        }
+        p += 2 + len;
+        sent++;
+    }
+
+    if (fec && dg_fec_flush(s, fec, max) < 0) {
+        quicpro_sched_pump_tx(s);
+        RETURN_THROWS();
+    }
+    quicpro_sched_pump_tx(s);
+    RETURN_LONG(sent);
+}
+/* }}} */
+
+/* {{{ quicpro_datagram_recv_batch(resource $session, int $max = 0, int $timeout_ms = 0): array
+ *
+ * Returns up to $max received datagrams as a list of strings, oldest
+ * first. $max 0 (or above quicpro.transport_dgram_recv_queue_len) takes
+ * what quiche's queue can hold. If none are queued, waits up to
+ * $timeout_ms for one (-1: no limit); server sessions never wait. Each
+ * string is read directly from quiche without a scratch buffer.
+ */
+PHP_FUNCTION(quicpro_datagram_recv_batch)
+{
+    zval *z_sess;
+    zend_long max = 0;
+    zend_long timeout_ms = 0;
+
+    ZEND_PARSE_PARAMETERS_START(1, 3)
+        Z_PARAM_RESOURCE(z_sess)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(max)
+        Z_PARAM_LONG(timeout_ms)
+    ZEND_PARSE_PARAMETERS_END();
+
+    zend_long limit;
+    if (!dg_batch_limit(max, 2, &limit)) {
+        RETURN_THROWS();
+    }
+    quicpro_session_t *s = dg_fetch_session(z_sess);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    ssize_t queued = dg_await(s, Z_RES_P(z_sess), timeout_ms);
+    if (queued < 0) {
+        RETURN_THROWS();
+    }
+
+    array_init_size(return_value, (uint32_t)MIN(queued, limit));
+    quicpro_dgram_fec_t *fec = dg_fec(s);
+    if (fec) {
+        dg_recv_fec(s, fec, limit, dg_deliver_zval, return_value);
+        return;
+    }
+    while (limit-- > 0) {
+        ssize_t len = quiche_conn_dgram_recv_front_len(s->conn);
+        if (len < 0) {
+            break;
+        }
+        zend_string *d = zend_string_alloc((size_t)len, 0);
+        ssize_t n = quiche_conn_dgram_recv(s->conn, (uint8_t *)ZSTR_VAL(d), (size_t)len);
+        if (n < 0) {
+            zend_string_efree(d);
+            break;
+        }
+        ZSTR_LEN(d) = (size_t)n;
+        ZSTR_VAL(d)[n] = '\0';
+        add_next_index_str(return_value, d);
+    }
+}
+/* }}} */
+
+/* {{{ quicpro_datagram_recv_packed(resource $session, int $max = 0, int $timeout_ms = 0): string
+ *
+ * Like quicpro_datagram_recv_batch(), but returns all datagrams in a
+ * single string of packed records (include/client/datagram.h). That costs
+ * one allocation per batch instead of one per datagram. Returns "" if
+ * nothing arrived in time.
+ */
+PHP_FUNCTION(quicpro_datagram_recv_packed)
+{
+    zval *z_sess;
+    zend_long max = 0;
+    zend_long timeout_ms = 0;
+
+    ZEND_PARSE_PARAMETERS_START(1, 3)
+        Z_PARAM_RESOURCE(z_sess)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(max)
+        Z_PARAM_LONG(timeout_ms)
+    ZEND_PARSE_PARAMETERS_END();
+
+    zend_long limit;
+    if (!dg_batch_limit(max, 2, &limit)) {
+        RETURN_THROWS();
+    }
+    quicpro_session_t *s = dg_fetch_session(z_sess);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    ssize_t queued = dg_await(s, Z_RES_P(z_sess), timeout_ms);
+    if (queued < 0) {
+        RETURN_THROWS();
+    }
+    if (queued == 0) {
+        RETURN_EMPTY_STRING();
+    }
+
+    /*
+     * Telemetry datagrams tend to be of one size, so the first one's length
+     * times the batch size is usually the exact result size. The string then
+     * never has to be reallocated (and copied) while it fills.
+     */
+    smart_str out = {0};
+    ssize_t front = quiche_conn_dgram_recv_front_len(s->conn);
+    smart_str_alloc(&out, (size_t)MIN(queued, limit) * (2 + (size_t)MAX(front, 0)), 0);
+
+    quicpro_dgram_fec_t *fec = dg_fec(s);
+    if (fec) {
+        dg_recv_fec(s, fec, limit, dg_deliver_packed, &out);
+        limit = 0;
+    }
+    while (limit-- > 0) {
+        ssize_t len = quiche_conn_dgram_recv_front_len(s->conn);
+        if (len < 0) {
+            break;
+        }
+        smart_str_alloc(&out, 2 + (size_t)len, 0);
+        uint8_t *dst = (uint8_t *)ZSTR_VAL(out.s) + ZSTR_LEN(out.s);
+        ssize_t n = quiche_conn_dgram_recv(s->conn, dst + 2, (size_t)len);
+        if (n < 0) {
+            break;
+        }
+        dst[0] = (uint8_t)(n >> 8);
+        dst[1] = (uint8_t)(n & 0xff);
+        ZSTR_LEN(out.s) += 2 + (size_t)n;
+    }
+
+    if (!out.s || ZSTR_LEN(out.s) == 0) {
+        smart_str_free(&out);
+        RETURN_EMPTY_STRING();
+    }
+    RETURN_STR(smart_str_extract(&out));
+}
+/* }}} */
+
+/* {{{ quicpro_datagram_fec_stats(resource $session): ?array
+ *
+ * Counters of the session's datagram FEC (include/client/dgram_fec.h),
+ * or null while quicpro.transport_dgram_fec_source_symbols is 0.
+ */
+PHP_FUNCTION(quicpro_datagram_fec_stats)
+{
+    zval *z_sess;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_RESOURCE(z_sess)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = dg_fetch_session(z_sess);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    quicpro_dgram_fec_t *fec = dg_fec(s);
+    if (!fec) {
+        RETURN_NULL();
+    }
+    const quicpro_dgram_fec_stats_t *st = quicpro_dgram_fec_stats(fec);
+    array_init_size(return_value, 7);
+    add_assoc_long(return_value, "blocks_sent", (zend_long)st->blocks_sent);
+    add_assoc_long(return_value, "repairs_sent", (zend_long)st->repairs_sent);
+    add_assoc_long(return_value, "repairs_dropped", (zend_long)st->repairs_dropped);
+    add_assoc_long(return_value, "repairs_received", (zend_long)st->repairs_received);
+    add_assoc_long(return_value, "recovered", (zend_long)st->recovered);
+    add_assoc_long(return_value, "unrecovered", (zend_long)st->unrecovered);
+    add_assoc_long(return_value, "malformed", (zend_long)st->malformed);
+}
+/* }}} */
@@ -0,0 +1,340 @@
+#include "php_quicpro.h"
+#include "client/dgram_fec.h"
+#include "object_store/erasure.h"
+#include "config/quic_transport/base_layer.h"
+
+#include <string.h>
+
+/**
+ * @file extension/src/client/dgram_fec.c
+ * @brief Reed-Solomon repair datagrams over blocks of QUIC datagrams.
+ *
+ * The sender keeps one slot per symbol of the block being filled, with
+ * room for the longer (repair) header in front. A source datagram is
+ * framed in its slot in place, so the bytes quiche copies are the very
+ * ones the parity is later computed over: one copy per datagram, as
+ * without FEC. The receiver keeps a symbol table per block of its window
+ * and decodes only once a block has lost something and has enough
+ * symbols to rebuild it.
+ */
+
+#define FEC_SOURCE_HDR 4    /* kind, block, index */
+#define FEC_REPAIR_HDR 7    /* kind, block, index, k, m, n */
+
+enum { FEC_SOURCE = 0, FEC_REPAIR = 1 };
+
+typedef struct {
+    bool      used;
+    uint16_t  block;
+    uint8_t   k, m, n;          /* 0 until a repair said */
+    size_t    symbol_len;       /* Of the repairs: the block's longest symbol */
+    uint32_t  sources;          /* Bit i: source i stored (and handed on) */
+    uint32_t  repairs;          /* Bit k + j: repair j stored */
+    uint32_t  rebuilt;          /* Bit i: source i handed on after decoding */
+    uint8_t  *symbols;          /* QUICPRO_EC_MAX_SHARDS × symbol_max, allocated on first use */
+} fec_rx_block_t;
+
+struct quicpro_dgram_fec_s {
+    size_t          symbol_max;
+
+    /* Sender */
+    quicpro_ec_t    tx_ec;
+    unsigned        k, m;
+    uint16_t        tx_block;
+    unsigned        tx_count;       /* Sources in the block so far */
+    size_t          tx_pending;     /* Symbol length of the framed, not yet sent, source */
+    size_t          tx_longest;
+    uint8_t        *tx_slots;       /* k + m slots: FEC_REPAIR_HDR, then a symbol */
+
+    /* Receiver */
+    quicpro_ec_t    rx_ec;          /* For the k and m of the last block decoded */
+    fec_rx_block_t  rx[QUICPRO_DGRAM_FEC_WINDOW];
+    uint8_t        *rx_buf;
+
+    quicpro_dgram_fec_stats_t stats;
+};
+
+static inline uint8_t *fec_tx_slot(quicpro_dgram_fec_t *fec, unsigned i)
+{
+    return fec->tx_slots + (size_t)i * (FEC_REPAIR_HDR + fec->symbol_max);
+}
+
+static inline uint8_t *fec_rx_symbol(const quicpro_dgram_fec_t *fec, const fec_rx_block_t *b, unsigned i)
+{
+    return b->symbols + (size_t)i * fec->symbol_max;
+}
+
+static inline uint32_t fec_mask(unsigned n)
+{
+    return n >= 32 ? UINT32_MAX : (1u << n) - 1;
+}
+
+quicpro_dgram_fec_t *quicpro_dgram_fec_create(size_t symbol_max)
+{
+    const qp_quic_transport_config_t *cfg = &quicpro_quic_transport_config;
+    if (cfg->dgram_fec_source_symbols <= 0) {
+        return NULL;
+    }
+    quicpro_dgram_fec_t *fec = ecalloc(1, sizeof(*fec));
+    fec->k = (unsigned)cfg->dgram_fec_source_symbols;
+    fec->m = (unsigned)cfg->dgram_fec_repair_symbols;
+    fec->symbol_max = symbol_max;
+    if (!quicpro_ec_init(&fec->tx_ec, fec->k, fec->m)) {
+        efree(fec);
+        return NULL;    /* The settings' bounds keep k + m in range */
+    }
+    fec->tx_slots = safe_emalloc(fec->k + fec->m, FEC_REPAIR_HDR + symbol_max, 0);
+    fec->rx_buf = emalloc(symbol_max);
+    return fec;
+}
+
+void quicpro_dgram_fec_free(quicpro_dgram_fec_t *fec)
+{
+    if (!fec) {
+        return;
+    }
+    quicpro_ec_free(&fec->tx_ec);
+    quicpro_ec_free(&fec->rx_ec);
+    for (unsigned i = 0; i < QUICPRO_DGRAM_FEC_WINDOW; i++) {
+        if (fec->rx[i].symbols) efree(fec->rx[i].symbols);
+    }
+    efree(fec->tx_slots);
+    efree(fec->rx_buf);
+    efree(fec);
+}
+
+/*──────────────────────────────── Sender ─────────────────────────────────*/
+
+const uint8_t *quicpro_dgram_fec_frame(quicpro_dgram_fec_t *fec, const uint8_t *payload, size_t len, size_t *wire_len)
+{
+    if (len > UINT16_MAX || 2 + len > fec->symbol_max) {
+        return NULL;
+    }
+    uint8_t *wire = fec_tx_slot(fec, fec->tx_count) + FEC_REPAIR_HDR - FEC_SOURCE_HDR;
+    wire[0] = FEC_SOURCE;
+    wire[1] = (uint8_t)(fec->tx_block >> 8);
+    wire[2] = (uint8_t)fec->tx_block;
+    wire[3] = (uint8_t)fec->tx_count;
+    wire[4] = (uint8_t)(len >> 8);
+    wire[5] = (uint8_t)len;
+    memcpy(wire + 6, payload, len);
+    fec->tx_pending = 2 + len;
+    *wire_len = FEC_SOURCE_HDR + 2 + len;
+    return wire;
+}
+
+bool quicpro_dgram_fec_sent(quicpro_dgram_fec_t *fec)
+{
+    fec->tx_longest = MAX(fec->tx_longest, fec->tx_pending);
+    return ++fec->tx_count == fec->k;
+}
+
+unsigned quicpro_dgram_fec_repair(quicpro_dgram_fec_t *fec, const uint8_t **wire, size_t *wire_len)
+{
+    unsigned k = fec->k, m = fec->m, n = fec->tx_count;
+    if (n == 0 || m == 0) {
+        fec->tx_count = 0;
+        fec->tx_longest = 0;
+        return 0;
+    }
+
+    /* Pad each symbol to the longest; those past a short block's end are empty */
+    size_t len = fec->tx_longest;
+    uint8_t *data[QUICPRO_EC_MAX_SHARDS], *parity[QUICPRO_EC_MAX_SHARDS];
+    for (unsigned i = 0; i < k; i++) {
+        data[i] = fec_tx_slot(fec, i) + FEC_REPAIR_HDR;
+        size_t used = i < n ? 2 + ((size_t)data[i][0] << 8 | data[i][1]) : 0;
+        memset(data[i] + used, 0, len - used);
+    }
+    for (unsigned j = 0; j < m; j++) {
+        parity[j] = fec_tx_slot(fec, k + j) + FEC_REPAIR_HDR;
+    }
+    quicpro_ec_encode(&fec->tx_ec, len, data, parity);
+
+    for (unsigned j = 0; j < m; j++) {
+        uint8_t *hdr = fec_tx_slot(fec, k + j);
+        hdr[0] = FEC_REPAIR;
+        hdr[1] = (uint8_t)(fec->tx_block >> 8);
+        hdr[2] = (uint8_t)fec->tx_block;
+        hdr[3] = (uint8_t)(k + j);
+        hdr[4] = (uint8_t)k;
+        hdr[5] = (uint8_t)m;
+        hdr[6] = (uint8_t)n;
+        wire[j] = hdr;
+        wire_len[j] = FEC_REPAIR_HDR + len;
+    }
+    fec->stats.blocks_sent++;
+    fec->stats.repairs_sent += m;
+    fec->tx_block++;
+    fec->tx_count = 0;
+    fec->tx_longest = 0;
+    return m;
+}
+
+void quicpro_dgram_fec_repair_dropped(quicpro_dgram_fec_t *fec)
+{
+    fec->stats.repairs_sent--;
+    fec->stats.repairs_dropped++;
+}
+
+/*─────────────────────────────── Receiver ────────────────────────────────*/
+
+/* Counts what a block leaving the window never got back */
+static void fec_rx_retire(quicpro_dgram_fec_t *fec, fec_rx_block_t *b)
+{
+    if (b->used && b->k) {
+        uint32_t want = fec_mask(b->n);
+        fec->stats.unrecovered += (uint64_t)__builtin_popcount(want & ~(b->sources | b->rebuilt));
+    }
+}
+
+/* The window's entry for `block`; NULL if the block is older than the window */
+static fec_rx_block_t *fec_rx_block(quicpro_dgram_fec_t *fec, uint16_t block)
+{
+    fec_rx_block_t *b = &fec->rx[block % QUICPRO_DGRAM_FEC_WINDOW];
+    if (b->used && b->block == block) {
+        return b;
+    }
+    if (b->used && (int16_t)(block - b->block) < 0) {
+        return NULL;
+    }
+    fec_rx_retire(fec, b);
+    uint8_t *symbols = b->symbols;
+    memset(b, 0, sizeof(*b));
+    b->used = true;
+    b->block = block;
+    b->symbols = symbols ? symbols : safe_emalloc(QUICPRO_EC_MAX_SHARDS, fec->symbol_max, 0);
+    return b;
+}
+
+static void fec_rx_store(quicpro_dgram_fec_t *fec, fec_rx_block_t *b, unsigned index, const uint8_t *symbol, size_t len)
+{
+    uint8_t *dst = fec_rx_symbol(fec, b, index);
+    memcpy(dst, symbol, len);
+    memset(dst + len, 0, fec->symbol_max - len);
+}
+
+/* Rebuilds the block's lost sources once it holds k symbols */
+static void fec_rx_decode(quicpro_dgram_fec_t *fec, fec_rx_block_t *b, quicpro_dgram_fec_deliver_t deliver, void *ctx)
+{
+    unsigned k = b->k, m = b->m, n = b->n;
+    uint32_t want = fec_mask(n);
+    if (!k || ((b->sources | b->rebuilt) & want) == want) {
+        return;
+    }
+    unsigned have = (unsigned)__builtin_popcount(b->sources & want) + (k - n)
+                  + (unsigned)__builtin_popcount(b->repairs);
+    if (have < k) {
+        return;
+    }
+
+    if (fec->rx_ec.k != k || fec->rx_ec.m != m) {
+        quicpro_ec_free(&fec->rx_ec);
+        if (!quicpro_ec_init(&fec->rx_ec, k, m)) {
+            return;
+        }
+    }
+    uint8_t *shards[QUICPRO_EC_MAX_SHARDS];
+    bool present[QUICPRO_EC_MAX_SHARDS];
+    for (unsigned i = 0; i < k + m; i++) {
+        shards[i] = fec_rx_symbol(fec, b, i);
+        if (i < n) {
+            present[i] = (b->sources >> i) & 1;
+        } else if (i < k) {
+            memset(shards[i], 0, b->symbol_len);
+            present[i] = true;
+        } else {
+            present[i] = (b->repairs >> i) & 1;
+        }
+    }
+    if (!quicpro_ec_recover(&fec->rx_ec, b->symbol_len, shards, present)) {
+        return;
+    }
+    for (unsigned i = 0; i < n; i++) {
+        if ((b->sources >> i) & 1) {
+            continue;
+        }
+        size_t len = (size_t)shards[i][0] << 8 | shards[i][1];
+        b->rebuilt |= 1u << i;
+        if (2 + len > b->symbol_len) {
+            fec->stats.malformed++;
+            continue;
+        }
+        fec->stats.recovered++;
+        deliver(ctx, shards[i] + 2, len);
+    }
+}
+
+void quicpro_dgram_fec_receive(quicpro_dgram_fec_t *fec, const uint8_t *wire, size_t len,
+                               quicpro_dgram_fec_deliver_t deliver, void *ctx)
+{
+    if (len < FEC_SOURCE_HDR) {
+        fec->stats.malformed++;
+        return;
+    }
+    uint16_t block = (uint16_t)(wire[1] << 8 | wire[2]);
+    unsigned index = wire[3];
+
+    if (wire[0] == FEC_SOURCE) {
+        size_t plen = len >= FEC_SOURCE_HDR + 2 ? (size_t)wire[4] << 8 | wire[5] : SIZE_MAX;
+        if (plen > len - FEC_SOURCE_HDR - 2) {
+            fec->stats.malformed++;
+            return;
+        }
+        deliver(ctx, wire + FEC_SOURCE_HDR + 2, plen);   /* Before anything else: no waiting */
+
+        fec_rx_block_t *b = fec_rx_block(fec, block);
+        if (!b || index >= QUICPRO_EC_MAX_SHARDS || ((b->sources | b->rebuilt) >> index) & 1
+            || (b->k && index >= b->n)) {
+            return;
+        }
+        fec_rx_store(fec, b, index, wire + FEC_SOURCE_HDR, 2 + plen);
+        b->sources |= 1u << index;
+        fec_rx_decode(fec, b, deliver, ctx);
+        return;
+    }
+
+    if (wire[0] != FEC_REPAIR || len <= FEC_REPAIR_HDR) {
+        fec->stats.malformed++;
+        return;
+    }
+    unsigned k = wire[4], m = wire[5], n = wire[6];
+    size_t symbol_len = len - FEC_REPAIR_HDR;
+    if (k == 0 || k + m > QUICPRO_EC_MAX_SHARDS || n == 0 || n > k || index < k || index >= k + m
+        || symbol_len > fec->symbol_max) {
+        fec->stats.malformed++;
+        return;
+    }
+    fec->stats.repairs_received++;
+    fec_rx_block_t *b = fec_rx_block(fec, block);
+    if (!b) {
+        return;
+    }
+    if (!b->k) {
+        b->k = (uint8_t)k;
+        b->m = (uint8_t)m;
+        b->n = (uint8_t)n;
+        b->symbol_len = symbol_len;
+        b->sources &= fec_mask(n);  /* Indices past the block's end were not its sources */
+    } else if (b->k != k || b->m != m || b->n != n || b->symbol_len != symbol_len) {
+        fec->stats.malformed++;
+        return;
+    }
+    if ((b->repairs >> index) & 1) {
+        return;
+    }
+    fec_rx_store(fec, b, index, wire + FEC_REPAIR_HDR, symbol_len);
+    b->repairs |= 1u << index;
+    fec_rx_decode(fec, b, deliver, ctx);
+}
+
+uint8_t *quicpro_dgram_fec_rx_buffer(quicpro_dgram_fec_t *fec, size_t *cap)
+{
+    *cap = fec->symbol_max;
+    return fec->rx_buf;
+}
+
+const quicpro_dgram_fec_stats_t *quicpro_dgram_fec_stats(const quicpro_dgram_fec_t *fec)
+{
+    return &fec->stats;
+}
@@ -0,0 +1,533 @@
+#include "php_quicpro.h"
+#include "client/dns.h"
+#include "client/cancel.h"
+#include "config/quic_transport/base_layer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <limits.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <openssl/rand.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @file extension/src/client/dns.c
+ * @brief Implementation of the client stub resolver and its TTL cache.
+ *
+ * The cache is a persistent table (lower-case name -> addresses and
+ * expiry) shared by every request of the process. resolv.conf is read
+ * once per process; /etc/hosts on every cache miss, as it is small and
+ * may change at runtime.
+ */
+
+#define DNS_TYPE_A               1
+#define DNS_TYPE_AAAA            28
+#define DNS_CLASS_IN             1
+#define DNS_RCODE_NXDOMAIN       3
+#define DNS_MAX_NS               3
+#define DNS_MAX_MSG              512
+#define DNS_MAX_NAME             253
+#define DNS_RESOLUTION_DELAY_MS  50     /* RFC 8305 §3 */
+#define DNS_FALLBACK_TTL_SEC     30     /* getaddrinfo() reports no TTL */
+#define DNS_CACHE_MAX_ENTRIES    1024
+
+typedef enum {
+    DNS_COMPLETE,     /* Both families answered: cacheable */
+    DNS_PARTIAL,      /* One family answered, the other timed out */
+    DNS_NO_ANSWER,    /* Try the next nameserver */
+    DNS_NXDOMAIN,
+    DNS_FALLBACK,     /* Leave it to getaddrinfo() */
+} dns_status_t;
+
+typedef struct {
+    quicpro_dns_addr_t addrs[QUICPRO_DNS_MAX_ADDRS];
+    uint32_t           count;
+    uint32_t           ttl;     /* Seconds; the smallest record TTL */
+} dns_result_t;
+
+typedef struct {
+    uint64_t           expires_ms;
+    uint32_t           count;
+    quicpro_dns_addr_t addrs[QUICPRO_DNS_MAX_ADDRS];
+} dns_cache_entry_t;
+
+typedef struct {
+    uint16_t id;
+    uint16_t qtype;
+    int      rcode;     /* -1 until answered */
+    bool     truncated;
+} dns_query_t;
+
+static HashTable dns_cache;
+static bool      dns_cache_ready;
+
+static quicpro_dns_addr_t dns_ns[DNS_MAX_NS];
+static int                dns_ns_count = -1;   /* -1: resolv.conf not read yet */
+static int                dns_ndots = 1;
+static bool               dns_has_search;
+
+static uint64_t dns_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/*──────────────────────────── Results ────────────────────────────────────*/
+
+static void dns_result_add(dns_result_t *r, const struct sockaddr *sa, socklen_t len) {
+    if (r->count < QUICPRO_DNS_MAX_ADDRS && len <= sizeof(r->addrs[0].addr)) {
+        memcpy(&r->addrs[r->count].addr, sa, len);
+        r->addrs[r->count].len = len;
+        r->count++;
+    }
+}
+
+static void dns_set_port(quicpro_dns_addr_t *a, uint16_t port) {
+    if (a->addr.ss_family == AF_INET6) {
+        ((struct sockaddr_in6 *)&a->addr)->sin6_port = htons(port);
+    } else {
+        ((struct sockaddr_in *)&a->addr)->sin_port = htons(port);
+    }
+}
+
+/* Numeric hosts, including scoped IPv6 literals; never touches the network */
+static bool dns_numeric(const char *text, dns_result_t *r) {
+    struct addrinfo hints = {0}, *ai = NULL;
+    hints.ai_flags    = AI_NUMERICHOST;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(text, NULL, &hints, &ai) != 0) {
+        return false;
+    }
+    dns_result_add(r, ai->ai_addr, (socklen_t)ai->ai_addrlen);
+    freeaddrinfo(ai);
+    return true;
+}
+
+/* IPv6 first, then alternating (RFC 8305 §4, First Address Family Count 1) */
+static int dns_result_emit(const dns_result_t *r, const char *host, uint16_t port, int family,
+                           quicpro_dns_addr_t *out, int max) {
+    const quicpro_dns_addr_t *v6[QUICPRO_DNS_MAX_ADDRS], *v4[QUICPRO_DNS_MAX_ADDRS];
+    int n6 = 0, n4 = 0;
+
+    for (uint32_t i = 0; i < r->count; i++) {
+        int f = r->addrs[i].addr.ss_family;
+        if (f == AF_INET6 && family != AF_INET) {
+            v6[n6++] = &r->addrs[i];
+        } else if (f == AF_INET && family != AF_INET6) {
+            v4[n4++] = &r->addrs[i];
+        }
+    }
+
+    int n = 0, i6 = 0, i4 = 0;
+    while (n < max && (i6 < n6 || i4 < n4)) {
+        if (i6 < n6) {
+            out[n] = *v6[i6++];
+            dns_set_port(&out[n++], port);
+        }
+        if (n < max && i4 < n4) {
+            out[n] = *v4[i4++];
+            dns_set_port(&out[n++], port);
+        }
+    }
+
+    if (n == 0) {
+        throw_network_exception(0, "DNS resolution failed for host '%s': no %s address", host,
+            family == AF_INET ? "IPv4" : family == AF_INET6 ? "IPv6" : "usable");
+        return -1;
+    }
+    return n;
+}
+
+/*──────────────────────────── Cache ──────────────────────────────────────*/
+
+static void dns_cache_entry_dtor(zval *zv) {
+    pefree(Z_PTR_P(zv), 1);
+}
+
+static int dns_cache_prune_expired(zval *zv, void *arg) {
+    dns_cache_entry_t *e = Z_PTR_P(zv);
+    return e->expires_ms <= *(uint64_t *)arg ? ZEND_HASH_APPLY_REMOVE : ZEND_HASH_APPLY_KEEP;
+}
+
+static bool dns_cache_lookup(const char *key, size_t len, dns_result_t *r) {
+    dns_cache_entry_t *e = dns_cache_ready ? zend_hash_str_find_ptr(&dns_cache, key, len) : NULL;
+    if (!e || e->expires_ms <= dns_now_ms()) {
+        return false;
+    }
+    memcpy(r->addrs, e->addrs, e->count * sizeof(e->addrs[0]));
+    r->count = e->count;
+    return true;
+}
+
+static void dns_cache_store(const char *key, size_t len, const dns_result_t *r) {
+    zend_long max_ttl = quicpro_quic_transport_config.dns_cache_max_ttl_sec;
+    uint64_t ttl = MIN((uint64_t)r->ttl, (uint64_t)MAX(max_ttl, 0));
+    if (ttl == 0 || r->count == 0) {
+        return;
+    }
+    if (!dns_cache_ready) {
+        zend_hash_init(&dns_cache, 64, NULL, dns_cache_entry_dtor, 1);
+        dns_cache_ready = true;
+    }
+
+    uint64_t now = dns_now_ms();
+    if (zend_hash_num_elements(&dns_cache) >= DNS_CACHE_MAX_ENTRIES) {
+        zend_hash_apply_with_argument(&dns_cache, dns_cache_prune_expired, &now);
+        if (zend_hash_num_elements(&dns_cache) >= DNS_CACHE_MAX_ENTRIES) {
+            return;
+        }
+    }
+
+    dns_cache_entry_t *e = pemalloc(sizeof(*e), 1);
+    e->expires_ms = now + ttl * 1000;
+    e->count = r->count;
+    memcpy(e->addrs, r->addrs, r->count * sizeof(r->addrs[0]));
+    zend_hash_str_update_ptr(&dns_cache, key, len, e);
+}
+
+void quicpro_dns_mshutdown(void) {
+    if (dns_cache_ready) {
+        zend_hash_destroy(&dns_cache);
+        dns_cache_ready = false;
+    }
+}
+
+/*──────────────────────────── Local sources ──────────────────────────────*/
+
+static void dns_hosts_lookup(const char *name, dns_result_t *r) {
+    FILE *f = fopen("/etc/hosts", "r");
+    char line[512];
+
+    if (!f) {
+        return;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        char *save = NULL, *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        char *addr = strtok_r(line, " \t\r\n", &save);
+        if (!addr) {
+            continue;
+        }
+        for (char *alias; (alias = strtok_r(NULL, " \t\r\n", &save)); ) {
+            if (strcasecmp(alias, name) == 0) {
+                dns_numeric(addr, r);
+                break;
+            }
+        }
+    }
+    fclose(f);
+}
+
+static void dns_load_resolv_conf(void) {
+    FILE *f = fopen("/etc/resolv.conf", "r");
+    char line[512];
+
+    dns_ns_count = 0;
+    if (!f) {
+        return;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        char *save = NULL;
+        char *kw = strtok_r(line, " \t\r\n", &save);
+        char *arg = kw ? strtok_r(NULL, " \t\r\n", &save) : NULL;
+        if (!arg) {
+            continue;
+        }
+        if (strcmp(kw, "nameserver") == 0 && dns_ns_count < DNS_MAX_NS) {
+            dns_result_t r = { .count = 0 };
+            if (dns_numeric(arg, &r)) {
+                dns_ns[dns_ns_count] = r.addrs[0];
+                dns_set_port(&dns_ns[dns_ns_count++], 53);
+            }
+        } else if (strcmp(kw, "search") == 0 || strcmp(kw, "domain") == 0) {
+            dns_has_search = true;
+        } else if (strcmp(kw, "options") == 0) {
+            for (; arg; arg = strtok_r(NULL, " \t\r\n", &save)) {
+                if (strncmp(arg, "ndots:", 6) == 0) {
+                    dns_ndots = atoi(arg + 6);
+                }
+            }
+        }
+    }
+    fclose(f);
+}
+
+/* The name as given is what the system resolver would ask first, and the only thing it would ask */
+static bool dns_name_is_absolute(const char *name, size_t len) {
+    int dots = 0;
+    if (name[len - 1] == '.') {
+        return true;
+    }
+    for (size_t i = 0; i < len; i++) {
+        dots += name[i] == '.';
+    }
+    return dots > 0 && (!dns_has_search || dots >= dns_ndots);
+}
+
+static int dns_getaddrinfo(const char *host, dns_result_t *r) {
+    struct addrinfo hints = {0}, *res = NULL;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_flags    = AI_ADDRCONFIG;
+    int status = getaddrinfo(host, NULL, &hints, &res);
+    if (status != 0) {
+        throw_network_exception(status, "DNS resolution failed for host '%s': %s", host, gai_strerror(status));
+        return status;
+    }
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        if (ai->ai_family == AF_INET || ai->ai_family == AF_INET6) {
+            dns_result_add(r, ai->ai_addr, (socklen_t)ai->ai_addrlen);
+        }
+    }
+    freeaddrinfo(res);
+    r->ttl = DNS_FALLBACK_TTL_SEC;
+    return 0;
+}
+
+/*──────────────────────────── Wire format ────────────────────────────────*/
+
+static size_t dns_build_query(uint8_t *buf, size_t cap, const dns_query_t *q, const char *name) {
+    size_t n = 12;
+
+    memset(buf, 0, 12);
+    buf[0] = q->id >> 8;
+    buf[1] = q->id & 0xff;
+    buf[2] = 0x01;          /* RD */
+    buf[5] = 1;             /* QDCOUNT */
+
+    for (const char *label = name; *label; ) {
+        const char *dot = strchr(label, '.');
+        size_t len = dot ? (size_t)(dot - label) : strlen(label);
+        if (len == 0 || len > 63 || n + 1 + len + 5 > cap) {
+            return 0;
+        }
+        buf[n++] = (uint8_t)len;
+        memcpy(buf + n, label, len);
+        n += len;
+        label += len + (dot ? 1 : 0);
+    }
+    buf[n++] = 0;
+    buf[n++] = q->qtype >> 8;
+    buf[n++] = q->qtype & 0xff;
+    buf[n++] = 0;
+    buf[n++] = DNS_CLASS_IN;
+    return n;
+}
+
+static bool dns_skip_name(const uint8_t *m, size_t len, size_t *pos) {
+    while (*pos < len) {
+        uint8_t l = m[*pos];
+        if ((l & 0xC0) == 0xC0) {
+            *pos += 2;      /* Compression pointer ends the name */
+            return *pos <= len;
+        }
+        if (l & 0xC0) {
+            return false;
+        }
+        *pos += 1 + l;
+        if (l == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline uint16_t dns_u16(const uint8_t *p) { return (uint16_t)(p[0] << 8 | p[1]); }
+static inline uint32_t dns_u32(const uint8_t *p) { return (uint32_t)dns_u16(p) << 16 | dns_u16(p + 2); }
+
+/* Records the answer to `q` if `m` is one; false for anything else. */
+static bool dns_parse_answer(const uint8_t *m, size_t len, dns_query_t *q, dns_result_t *r) {
+    if (len < 12 || dns_u16(m) != q->id || !(m[2] & 0x80)) {
+        return false;
+    }
+    size_t pos = 12;
+    uint16_t qdcount = dns_u16(m + 4), ancount = dns_u16(m + 6);
+
+    for (uint16_t i = 0; i < qdcount; i++) {
+        if (!dns_skip_name(m, len, &pos) || pos + 4 > len || dns_u16(m + pos) != q->qtype) {
+            return false;
+        }
+        pos += 4;
+    }
+    q->rcode = m[3] & 0x0F;
+    q->truncated = (m[2] & 0x02) != 0;
+
+    /* CNAMEs precede their targets in the answer section; only the addresses matter */
+    for (uint16_t i = 0; i < ancount; i++) {
+        if (!dns_skip_name(m, len, &pos) || pos + 10 > len) {
+            break;
+        }
+        uint16_t type = dns_u16(m + pos), cls = dns_u16(m + pos + 2), rdlen = dns_u16(m + pos + 8);
+        uint32_t ttl = dns_u32(m + pos + 4);
+        pos += 10;
+        if (pos + rdlen > len) {
+            break;
+        }
+        if (cls == DNS_CLASS_IN && type == DNS_TYPE_A && rdlen == 4) {
+            struct sockaddr_in sin = { .sin_family = AF_INET };
+            memcpy(&sin.sin_addr, m + pos, 4);
+            dns_result_add(r, (struct sockaddr *)&sin, sizeof(sin));
+            r->ttl = MIN(r->ttl, ttl);
+        } else if (cls == DNS_CLASS_IN && type == DNS_TYPE_AAAA && rdlen == 16) {
+            struct sockaddr_in6 sin6 = { .sin6_family = AF_INET6 };
+            memcpy(&sin6.sin6_addr, m + pos, 16);
+            dns_result_add(r, (struct sockaddr *)&sin6, sizeof(sin6));
+            r->ttl = MIN(r->ttl, ttl);
+        }
+        pos += rdlen;
+    }
+    return true;
+}
+
+/*──────────────────────────── Lookup ─────────────────────────────────────*/
+
+/* Sends the AAAA and A queries together and waits for both answers. */
+static dns_status_t dns_query_server(const quicpro_dns_addr_t *ns, const char *name, dns_result_t *r, zend_long timeout_ms) {
+    dns_query_t q[2] = { { 0, DNS_TYPE_AAAA, -1, false }, { 0, DNS_TYPE_A, -1, false } };
+    uint8_t buf[DNS_MAX_MSG];
+    int answered = 0;
+
+    int fd = socket(ns->addr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return DNS_NO_ANSWER;
+    }
+    if (connect(fd, (const struct sockaddr *)&ns->addr, ns->len) < 0) {
+        close(fd);
+        return DNS_NO_ANSWER;
+    }
+    RAND_bytes((unsigned char *)&q[0].id, sizeof(q[0].id));
+    q[1].id = q[0].id + 1;
+    for (int i = 0; i < 2; i++) {
+        size_t n = dns_build_query(buf, sizeof(buf), &q[i], name);
+        if (n == 0) {
+            close(fd);
+            return DNS_FALLBACK;
+        }
+        if (send(fd, buf, n, 0) < 0) {
+            close(fd);
+            return DNS_NO_ANSWER;
+        }
+    }
+
+    uint64_t deadline = dns_now_ms() + (uint64_t)timeout_ms;
+    while (answered < 2) {
+        uint64_t now = dns_now_ms();
+        if (now >= deadline) {
+            break;
+        }
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int rc = poll(&pfd, 1, (int)MIN(deadline - now, (uint64_t)INT_MAX));
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            break;
+        }
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            break;      /* e.g. ECONNREFUSED: nothing listens there */
+        }
+        for (int i = 0; i < 2; i++) {
+            if (q[i].rcode < 0 && dns_parse_answer(buf, (size_t)n, &q[i], r)) {
+                answered++;
+                break;
+            }
+        }
+        if (answered == 1 && r->count > 0) {
+            deadline = MIN(deadline, dns_now_ms() + DNS_RESOLUTION_DELAY_MS);
+        }
+    }
+    close(fd);
+
+    for (int i = 0; i < 2; i++) {
+        if (q[i].truncated) {
+            return DNS_FALLBACK;    /* No TCP here */
+        }
+        if (q[i].rcode == DNS_RCODE_NXDOMAIN) {
+            return DNS_NXDOMAIN;
+        }
+    }
+    if (r->count == 0) {
+        /* SERVFAIL, REFUSED or silence: the next nameserver may know better */
+        return answered == 2 && q[0].rcode == 0 && q[1].rcode == 0 ? DNS_COMPLETE : DNS_NO_ANSWER;
+    }
+    return answered == 2 ? DNS_COMPLETE : DNS_PARTIAL;
+}
+
+int quicpro_dns_resolve(const char *host, uint16_t port, int family, quicpro_dns_addr_t *out, int max) {
+    dns_result_t r = { .count = 0, .ttl = UINT32_MAX };
+    char name[DNS_MAX_NAME + 2];
+    size_t len = strlen(host);
+
+    if (dns_numeric(host, &r)) {
+        return dns_result_emit(&r, host, port, family, out, max);
+    }
+    if (len == 0 || len > DNS_MAX_NAME + 1) {
+        throw_network_exception(0, "DNS resolution failed for host '%s': not a valid host name", host);
+        return -1;
+    }
+    for (size_t i = 0; i <= len; i++) {
+        name[i] = zend_tolower_ascii(host[i]);
+    }
+
+    if (dns_cache_lookup(name, len, &r)) {
+        return dns_result_emit(&r, host, port, family, out, max);
+    }
+
+    dns_hosts_lookup(name, &r);
+    if (r.count > 0) {
+        dns_cache_store(name, len, &r);
+        return dns_result_emit(&r, host, port, family, out, max);
+    }
+
+    if (dns_ns_count < 0) {
+        dns_load_resolv_conf();
+    }
+    dns_status_t status = DNS_FALLBACK;
+    if (dns_ns_count > 0 && dns_name_is_absolute(name, len)) {
+        zend_long per_server = MAX(quicpro_quic_transport_config.dns_timeout_ms / dns_ns_count, 1);
+        for (int i = 0; i < dns_ns_count; i++) {
+            status = dns_query_server(&dns_ns[i], name, &r, per_server);
+            if (status != DNS_NO_ANSWER) {
+                break;
+            }
+        }
+    }
+    if (status == DNS_NXDOMAIN && dns_has_search) {
+        status = DNS_FALLBACK;      /* The search list may still complete it */
+    }
+
+    switch (status) {
+        case DNS_COMPLETE:
+            dns_cache_store(name, len, &r);
+            break;
+        case DNS_PARTIAL:
+            break;
+        case DNS_NXDOMAIN:
+            throw_network_exception(0, "DNS resolution failed for host '%s': name does not exist", host);
+            return -1;
+        case DNS_NO_ANSWER:
+            throw_network_exception(0, "DNS resolution failed for host '%s': no nameserver answered within %ld ms",
+                host, (long)quicpro_quic_transport_config.dns_timeout_ms);
+            return -1;
+        case DNS_FALLBACK:
+            r.count = 0;
+            if (dns_getaddrinfo(host, &r) != 0) {
+                return -1;
+            }
+            dns_cache_store(name, len, &r);
+            break;
+    }
+    return dns_result_emit(&r, host, port, family, out, max);
+}
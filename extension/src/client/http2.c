@@ -1,79 +1,1076 @@
-#ifndef QUICPRO_CLIENT_HTTP2_H
-#define QUICPRO_CLIENT_HTTP2_H
+#include "php_quicpro.h"
+#include "client/http2.h"
+#include "client/body.h"
+#include "client/cancel.h"
+#include "client/dns.h"
+#include "config/http2/base_layer.h"
+#include "config/quic_transport/base_layer.h"
+#include "config/tcp_transport/base_layer.h"
 
-#include <php.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+#include <ext/standard/url.h>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#ifdef QUICPRO_HAVE_NGHTTP2
+#include <nghttp2/nghttp2.h>
+#include "server/h2_flow.h"
+#endif
 
 /**
- * @file extension/include/client/http2.h
- * @brief Public API declarations for the Quicpro HTTP/2 Client.
+ * @file extension/src/client/http2.c
+ * @brief Implementation of the native HTTP/2 client.
  *
- * This header defines the PHP-callable function that enables making
- * HTTP/2 requests. It serves as the primary interface for users who
- * explicitly wish to utilize the HTTP/2 protocol for their outbound
- * client-side communications. The design emphasizes a clear and efficient
- * API that abstracts the complexities of the HTTP/2 protocol, including
- * stream multiplexing and connection management, leveraging the libcurl library.
+ * A request is on its connection's wait list until a stream slot frees
+ * up, then in flight with the request as the stream's user data, then
+ * done. A request the caller gives up on (timeout) has its stream reset
+ * and its user data cleared, so later frames of that stream find nothing
+ * and are dropped; nghttp2 never holds a pointer to a freed request.
  *
- * The `quicpro_http2_request_send` function is crafted to be a comprehensive
- * endpoint for dispatching HTTP/2 requests, offering precise control over
- * request parameters and behavior, while ensuring high performance and reliability
- * through its libcurl backend, which inherently handles HTTP/2 features like
- * multiplexing over a single TCP connection.
+ * A connection that fails is marked broken and stays in the pool until
+ * the next call drops it, so the requests still pointing at it can read
+ * its error first.
  */
 
-/**
- * @brief Sends an HTTP/2 request to a specified URL.
- *
- * This function allows PHP userland applications to perform HTTP/2 requests
- * with fine-grained control over various aspects of the request and response.
- * It acts as a specialized wrapper around the more generic `quicpro_http_request_send`
- * (which internally uses libcurl), explicitly setting the HTTP version to 2.0
- * and enabling HTTP/2-specific optimizations like connection multiplexing.
+#ifdef QUICPRO_HAVE_NGHTTP2
+
+#define QP_H2_WRITE_BATCH  65536   /* Output gathered for one SSL_write */
+#define QP_H2_READ_CHUNK   16384
+
+typedef struct qp_h2_conn_s qp_h2_conn_t;
+
+typedef struct qp_h2_req_s {
+    /* Request */
+    zend_string        *host;      /* For the lookup, without IPv6 brackets */
+    uint16_t            port;
+    nghttp2_nv         *nva;
+    zend_string       **strs;      /* Backing `nva`: name, value, name, value, ... */
+    size_t              nvlen;
+    zend_string        *body;      /* NULL: no body */
+    size_t              body_off;
+
+    /* Response */
+    int32_t             stream_id; /* 0 until opened */
+    zend_long           status;
+    bool                trailing;  /* The HEADERS being read are trailers */
+    zval                headers;
+    zval                trailers;  /* IS_UNDEF until a trailer arrives */
+    smart_str           resp;
+    zend_string        *error;     /* NULL on success */
+    bool                done;
+
+    qp_h2_conn_t       *conn;
+    struct qp_h2_req_s *next;      /* Wait list */
+} qp_h2_req_t;
+
+struct qp_h2_conn_s {
+    zend_string     *key;
+    int              fd;
+    SSL_CTX         *own_ctx;      /* Only with a custom `ca_file` */
+    SSL             *ssl;
+    nghttp2_session *ngh2;
+    quicpro_h2_flow_t flow;        /* Download windows grown to the path's BDP */
+    uint32_t         open;         /* Streams in flight */
+    qp_h2_req_t     *wait_head;
+    qp_h2_req_t     *wait_tail;
+    uint8_t         *wbuf;
+    size_t           wlen;
+    size_t           woff;
+    size_t           wcap;
+    bool             goaway;
+    bool             broken;
+    zend_string     *error;        /* Why it broke */
+    zend_long        idle_since_ms;
+    uint32_t         round;        /* Last poll round that collected it */
+    qp_h2_conn_t    *next;
+};
+
+typedef struct {
+    zend_long    timeout_ms;       /* 0: none */
+    bool         verify_peer;
+    zend_string *ca_file;
+} qp_h2_opts_t;
+
+static qp_h2_conn_t *qp_h2_pool;                 /* Request lifetime */
+static SSL_CTX *qp_h2_ctx;                       /* Process lifetime: system trust store */
+static nghttp2_session_callbacks *qp_h2_cbs;
+static uint32_t qp_h2_round;
+
+static zend_long qp_h2_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (zend_long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void qp_h2_break(qp_h2_conn_t *c, zend_string *error)
+{
+    if (c->broken) {
+        zend_string_release(error);
+        return;
+    }
+    c->broken = true;
+    c->error = error;
+}
+
+/*──────────────────────────── nghttp2 callbacks ──────────────────────────*/
+
+static int qp_h2_on_begin_headers(nghttp2_session *ngh2, const nghttp2_frame *frame, void *user_data)
+{
+    qp_h2_req_t *r = nghttp2_session_get_stream_user_data(ngh2, frame->hd.stream_id);
+    if (r && frame->hd.type == NGHTTP2_HEADERS) {
+        /* A HEADERS frame after a final response carries trailers */
+        r->trailing = frame->headers.cat == NGHTTP2_HCAT_HEADER && r->status >= 200;
+    }
+    return 0;
+}
+
+static int qp_h2_on_header(nghttp2_session *ngh2, const nghttp2_frame *frame, const uint8_t *name, size_t namelen,
+                           const uint8_t *value, size_t valuelen, uint8_t flags, void *user_data)
+{
+    qp_h2_req_t *r = nghttp2_session_get_stream_user_data(ngh2, frame->hd.stream_id);
+    if (!r || frame->hd.type != NGHTTP2_HEADERS) {
+        return 0;
+    }
+    if (namelen == 7 && memcmp(name, ":status", 7) == 0) {
+        r->status = ZEND_STRTOL((const char *)value, NULL, 10);   /* nghttp2 NUL-terminates values */
+        zend_hash_clean(Z_ARRVAL(r->headers));                    /* Drops a 1xx response's fields */
+        return 0;
+    }
+    if (name[0] == ':') {
+        return 0;
+    }
+
+    zval *target = &r->headers;
+    if (r->trailing) {
+        if (Z_ISUNDEF(r->trailers)) {
+            array_init(&r->trailers);
+        }
+        target = &r->trailers;
+    } else if (namelen == 14 && memcmp(name, "content-length", 14) == 0) {
+        quicpro_body_reserve(&r->resp, quicpro_body_length(value, valuelen));
+    }
+
+    /* A repeated field becomes a list of its values */
+    zval *prev = zend_hash_str_find(Z_ARRVAL_P(target), (const char *)name, namelen);
+    if (!prev) {
+        add_assoc_stringl_ex(target, (const char *)name, namelen, (const char *)value, valuelen);
+    } else {
+        if (Z_TYPE_P(prev) != IS_ARRAY) {
+            zval list;
+            array_init(&list);
+            add_next_index_zval(&list, prev);
+            ZVAL_COPY_VALUE(prev, &list);
+        }
+        add_next_index_stringl(prev, (const char *)value, valuelen);
+    }
+    return 0;
+}
+
+static int qp_h2_on_data(nghttp2_session *ngh2, uint8_t flags, int32_t stream_id, const uint8_t *data, size_t len,
+                         void *user_data)
+{
+    quicpro_h2_flow_on_data(&((qp_h2_conn_t *)user_data)->flow, ngh2, len);
+    qp_h2_req_t *r = nghttp2_session_get_stream_user_data(ngh2, stream_id);
+    if (r) {
+        smart_str_appendl(&r->resp, (const char *)data, len);
+    }
+    return 0;
+}
+
+static int qp_h2_on_frame_recv(nghttp2_session *ngh2, const nghttp2_frame *frame, void *user_data)
+{
+    quicpro_h2_flow_on_frame(&((qp_h2_conn_t *)user_data)->flow, ngh2, frame);
+    if (frame->hd.type == NGHTTP2_GOAWAY) {
+        ((qp_h2_conn_t *)user_data)->goaway = true;   /* No new streams; those in flight may finish */
+    }
+    return 0;
+}
+
+static int qp_h2_on_stream_close(nghttp2_session *ngh2, int32_t stream_id, uint32_t error_code, void *user_data)
+{
+    qp_h2_req_t *r = nghttp2_session_get_stream_user_data(ngh2, stream_id);
+    if (!r) {
+        return 0;   /* Abandoned; its slot was returned then */
+    }
+    ((qp_h2_conn_t *)user_data)->open--;
+    r->done = true;
+    if (error_code == NGHTTP2_REFUSED_STREAM) {
+        r->error = ZSTR_INIT_LITERAL("Stream refused by the server before processing; safe to retry", 0);
+    } else if (error_code != NGHTTP2_NO_ERROR) {
+        r->error = strpprintf(0, "Stream reset by the server: %s", nghttp2_http2_strerror(error_code));
+    } else if (r->status == 0) {
+        r->error = ZSTR_INIT_LITERAL("Stream closed without a response", 0);
+    }
+    return 0;
+}
+
+static ssize_t qp_h2_read_body(nghttp2_session *ngh2, int32_t stream_id, uint8_t *buf, size_t length,
+                               uint32_t *data_flags, nghttp2_data_source *source, void *user_data)
+{
+    qp_h2_req_t *r = nghttp2_session_get_stream_user_data(ngh2, stream_id);
+    if (!r) {
+        return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;   /* Abandoned: reset the stream */
+    }
+    size_t n = MIN(length, ZSTR_LEN(r->body) - r->body_off);
+    memcpy(buf, ZSTR_VAL(r->body) + r->body_off, n);
+    r->body_off += n;
+    if (r->body_off == ZSTR_LEN(r->body)) {
+        *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+    }
+    return (ssize_t)n;
+}
+
+static nghttp2_session_callbacks *qp_h2_callbacks(void)
+{
+    if (!qp_h2_cbs) {
+        nghttp2_session_callbacks_new(&qp_h2_cbs);
+        nghttp2_session_callbacks_set_on_begin_headers_callback(qp_h2_cbs, qp_h2_on_begin_headers);
+        nghttp2_session_callbacks_set_on_header_callback(qp_h2_cbs, qp_h2_on_header);
+        nghttp2_session_callbacks_set_on_data_chunk_recv_callback(qp_h2_cbs, qp_h2_on_data);
+        nghttp2_session_callbacks_set_on_frame_recv_callback(qp_h2_cbs, qp_h2_on_frame_recv);
+        nghttp2_session_callbacks_set_on_stream_close_callback(qp_h2_cbs, qp_h2_on_stream_close);
+    }
+    return qp_h2_cbs;
+}
+
+/*──────────────────────────── Connection I/O ─────────────────────────────*/
+
+/* Writes everything nghttp2 has to send, a batch at a time, until the socket blocks */
+static void qp_h2_flush(qp_h2_conn_t *c)
+{
+    while (!c->broken) {
+        if (c->woff == c->wlen) {
+            c->wlen = c->woff = 0;
+            while (c->wlen < QP_H2_WRITE_BATCH) {
+                const uint8_t *data;
+                ssize_t n = nghttp2_session_mem_send(c->ngh2, &data);
+                if (n < 0) {
+                    qp_h2_break(c, strpprintf(0, "HTTP/2 framing failed: %s", nghttp2_strerror((int)n)));
+                    return;
+                }
+                if (n == 0) {
+                    break;
+                }
+                if (c->wlen + (size_t)n > c->wcap) {
+                    c->wcap = MAX(c->wlen + (size_t)n, QP_H2_WRITE_BATCH);
+                    c->wbuf = erealloc(c->wbuf, c->wcap);
+                }
+                memcpy(c->wbuf + c->wlen, data, (size_t)n);
+                c->wlen += (size_t)n;
+            }
+            if (c->wlen == 0) {
+                return;
+            }
+        }
+
+        ERR_clear_error();
+        int n = SSL_write(c->ssl, c->wbuf + c->woff, (int)MIN(c->wlen - c->woff, INT_MAX));
+        if (n <= 0) {
+            int err = SSL_get_error(c->ssl, n);
+            if (err != SSL_ERROR_WANT_WRITE && err != SSL_ERROR_WANT_READ) {
+                qp_h2_break(c, strpprintf(0, "HTTP/2 connection failed while sending: %s",
+                                          err == SSL_ERROR_SYSCALL ? strerror(errno) : ERR_reason_error_string(ERR_peek_last_error())));
+            }
+            return;
+        }
+        c->woff += (size_t)n;
+    }
+}
+
+/* Feeds whatever the socket holds to nghttp2 */
+static void qp_h2_read(qp_h2_conn_t *c)
+{
+    uint8_t buf[QP_H2_READ_CHUNK];
+    while (!c->broken) {
+        ERR_clear_error();
+        int n = SSL_read(c->ssl, buf, sizeof(buf));
+        if (n <= 0) {
+            int err = SSL_get_error(c->ssl, n);
+            if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+                return;
+            }
+            if (err == SSL_ERROR_ZERO_RETURN || (err == SSL_ERROR_SYSCALL && errno == 0)) {
+                qp_h2_break(c, ZSTR_INIT_LITERAL("HTTP/2 connection closed by the server", 0));
+            } else {
+                qp_h2_break(c, strpprintf(0, "HTTP/2 connection failed while receiving: %s",
+                                          err == SSL_ERROR_SYSCALL ? strerror(errno) : ERR_reason_error_string(ERR_peek_last_error())));
+            }
+            return;
+        }
+        ssize_t rv = nghttp2_session_mem_recv(c->ngh2, buf, (size_t)n);
+        if (rv < 0) {
+            qp_h2_break(c, strpprintf(0, "HTTP/2 protocol error from the server: %s", nghttp2_strerror((int)rv)));
+            return;
+        }
+    }
+}
+
+static uint32_t qp_h2_stream_limit(qp_h2_conn_t *c)
+{
+    uint32_t peer = nghttp2_session_get_remote_settings(c->ngh2, NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS);
+    return MIN(peer, (uint32_t)quicpro_http2_config.max_concurrent_streams);
+}
+
+static void qp_h2_submit(qp_h2_conn_t *c, qp_h2_req_t *r)
+{
+    nghttp2_data_provider body = { .source.ptr = NULL, .read_callback = qp_h2_read_body };
+    int32_t id = nghttp2_submit_request(c->ngh2, NULL, r->nva, r->nvlen, r->body ? &body : NULL, r);
+    if (id < 0) {
+        r->done = true;
+        r->error = strpprintf(0, "Cannot open an HTTP/2 stream: %s", nghttp2_strerror(id));
+        return;
+    }
+    r->stream_id = id;
+    c->open++;
+}
+
+/* Opens streams for waiting requests as far as the limits allow */
+static void qp_h2_promote(qp_h2_conn_t *c)
+{
+    uint32_t limit = qp_h2_stream_limit(c);
+    while (c->wait_head && c->open < limit && !c->broken) {
+        qp_h2_req_t *r = c->wait_head;
+        c->wait_head = r->next;
+        if (!c->wait_head) {
+            c->wait_tail = NULL;
+        }
+        r->next = NULL;
+        if (c->goaway) {
+            r->done = true;
+            r->error = ZSTR_INIT_LITERAL("HTTP/2 connection is going away; safe to retry", 0);
+            continue;
+        }
+        qp_h2_submit(c, r);
+    }
+}
+
+static void qp_h2_conn_free(qp_h2_conn_t *c)
+{
+    if (c->ssl) {
+        if (c->ngh2 && !c->broken) {
+            nghttp2_session_terminate_session(c->ngh2, NGHTTP2_NO_ERROR);
+            qp_h2_flush(c);   /* GOAWAY, best effort without waiting */
+        }
+        SSL_free(c->ssl);
+    }
+    if (c->ngh2) {
+        nghttp2_session_del(c->ngh2);
+    }
+    if (c->own_ctx) {
+        SSL_CTX_free(c->own_ctx);
+    }
+    if (c->fd >= 0) {
+        close(c->fd);
+    }
+    if (c->wbuf) {
+        efree(c->wbuf);
+    }
+    if (c->error) {
+        zend_string_release(c->error);
+    }
+    zend_string_release(c->key);
+    efree(c);
+}
+
+/*──────────────────────────── Connecting ─────────────────────────────────*/
+
+/* Waits for `events` on `fd` until `deadline_ms`; false on timeout or error */
+static bool qp_h2_wait(int fd, short events, zend_long deadline_ms)
+{
+    for (;;) {
+        zend_long left = deadline_ms - qp_h2_now_ms();
+        if (left <= 0) {
+            errno = ETIMEDOUT;
+            return false;
+        }
+        struct pollfd pfd = { .fd = fd, .events = events };
+        int n = poll(&pfd, 1, (int)MIN(left, INT_MAX));
+        if (n > 0) {
+            return true;
+        }
+        if (n < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+static int qp_h2_tcp_connect(const quicpro_dns_addr_t *a, zend_long deadline_ms)
+{
+    int fd = socket(a->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));   /* Writes are batched already */
+    if (connect(fd, (const struct sockaddr *)&a->addr, a->len) < 0) {
+        int err = errno;
+        socklen_t len = sizeof(err);
+        if (err != EINPROGRESS || !qp_h2_wait(fd, POLLOUT, deadline_ms)
+            || getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+            err = err ? err : errno;
+            close(fd);
+            errno = err;
+            return -1;
+        }
+    }
+    return fd;
+}
+
+static SSL_CTX *qp_h2_ctx_new(const char *ca_file)
+{
+    SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+    if (!ctx) {
+        return NULL;
+    }
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);   /* RFC 9113 §9.2 */
+    SSL_CTX_set_alpn_protos(ctx, (const unsigned char *)"\x02h2", 3);
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    if (ca_file ? SSL_CTX_load_verify_locations(ctx, ca_file, NULL) != 1 : SSL_CTX_set_default_verify_paths(ctx) != 1) {
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+/* Takes the pending exception's message, clearing it */
+static zend_string *qp_h2_take_exception(void)
+{
+    zval rv;
+    zend_object *ex = EG(exception);
+    zend_string *msg = zval_get_string(zend_read_property_ex(ex->ce, ex, ZSTR_KNOWN(ZEND_STR_MESSAGE), 1, &rv));
+    zend_clear_exception();
+    return msg;
+}
+
+/* Connects, handshakes and sends the client preface; NULL with `*error` set on failure */
+static qp_h2_conn_t *qp_h2_connect(const qp_h2_req_t *r, const qp_h2_opts_t *o, zend_string *key, zend_string **error)
+{
+    const char *host = ZSTR_VAL(r->host);
+    zend_long deadline = qp_h2_now_ms() + quicpro_tcp_transport_config.tcp_connect_timeout_ms;
+
+    quicpro_dns_addr_t addrs[QUICPRO_DNS_MAX_ADDRS];
+    int naddrs = quicpro_dns_resolve(host, r->port, AF_UNSPEC, addrs, QUICPRO_DNS_MAX_ADDRS);
+    if (naddrs < 0) {
+        *error = qp_h2_take_exception();
+        return NULL;
+    }
+    int fd = -1;
+    for (int i = 0; i < naddrs && fd < 0; i++) {
+        fd = qp_h2_tcp_connect(&addrs[i], deadline);
+    }
+    if (fd < 0) {
+        *error = strpprintf(0, "Cannot connect to %s:%u: %s", host, r->port, strerror(errno));
+        return NULL;
+    }
+
+    qp_h2_conn_t *c = ecalloc(1, sizeof(*c));
+    c->fd = fd;
+    c->key = zend_string_copy(key);
+    c->idle_since_ms = qp_h2_now_ms();
+    SSL_CTX *ctx;
+    if (o->ca_file) {
+        ctx = c->own_ctx = qp_h2_ctx_new(ZSTR_VAL(o->ca_file));
+    } else {
+        if (!qp_h2_ctx) {
+            qp_h2_ctx = qp_h2_ctx_new(NULL);
+        }
+        ctx = qp_h2_ctx;
+    }
+    if (!ctx || !(c->ssl = SSL_new(ctx))) {
+        *error = strpprintf(0, "Cannot set up TLS for %s: %s", host, ERR_reason_error_string(ERR_get_error()));
+        qp_h2_conn_free(c);
+        return NULL;
+    }
+    SSL_set_fd(c->ssl, fd);
+    SSL_set_connect_state(c->ssl);
+    struct in6_addr ip;
+    bool literal = inet_pton(AF_INET6, host, &ip) == 1 || inet_pton(AF_INET, host, &ip) == 1;
+    if (!literal) {
+        SSL_set_tlsext_host_name(c->ssl, host);
+    }
+    if (o->verify_peer) {
+        SSL_set_verify(c->ssl, SSL_VERIFY_PEER, NULL);
+        if (literal) {
+            X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(c->ssl), host);
+        } else {
+            SSL_set1_host(c->ssl, host);
+        }
+    }
+
+    for (;;) {
+        ERR_clear_error();
+        int rc = SSL_do_handshake(c->ssl);
+        if (rc == 1) {
+            break;
+        }
+        int err = SSL_get_error(c->ssl, rc);
+        if ((err != SSL_ERROR_WANT_READ && err != SSL_ERROR_WANT_WRITE)
+            || !qp_h2_wait(fd, err == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT, deadline)) {
+            long verify = SSL_get_verify_result(c->ssl);
+            *error = strpprintf(0, "TLS handshake with %s failed: %s", host,
+                                verify != X509_V_OK ? X509_verify_cert_error_string(verify)
+                                : errno == ETIMEDOUT ? "timed out"
+                                : ERR_reason_error_string(ERR_peek_last_error()));
+            qp_h2_conn_free(c);
+            return NULL;
+        }
+    }
+    const unsigned char *alpn;
+    unsigned int alpn_len;
+    SSL_get0_alpn_selected(c->ssl, &alpn, &alpn_len);
+    if (alpn_len != 2 || memcmp(alpn, "h2", 2) != 0) {
+        *error = strpprintf(0, "%s:%u does not speak HTTP/2 (no \"h2\" in ALPN)", host, r->port);
+        qp_h2_conn_free(c);
+        return NULL;
+    }
+
+    nghttp2_session_client_new(&c->ngh2, qp_h2_callbacks(), c);
+    nghttp2_settings_entry iv[4];
+    size_t niv = 0;
+    uint32_t window = (uint32_t)MIN(quicpro_http2_config.initial_window_size, NGHTTP2_MAX_WINDOW_SIZE);
+    iv[niv++] = (nghttp2_settings_entry){ NGHTTP2_SETTINGS_ENABLE_PUSH, 0 };
+    iv[niv++] = (nghttp2_settings_entry){ NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, window };
+    iv[niv++] = (nghttp2_settings_entry){ NGHTTP2_SETTINGS_MAX_FRAME_SIZE, (uint32_t)quicpro_http2_config.max_frame_size };
+    if (quicpro_http2_config.max_header_list_size > 0) {
+        iv[niv++] = (nghttp2_settings_entry){ NGHTTP2_SETTINGS_MAX_HEADER_LIST_SIZE, (uint32_t)quicpro_http2_config.max_header_list_size };
+    }
+    nghttp2_submit_settings(c->ngh2, NGHTTP2_FLAG_NONE, iv, niv);
+    /* Room for every stream to fill its window at once */
+    uint64_t conn_window = MIN((uint64_t)window * (uint64_t)quicpro_http2_config.max_concurrent_streams, NGHTTP2_MAX_WINDOW_SIZE);
+    nghttp2_session_set_local_window_size(c->ngh2, NGHTTP2_FLAG_NONE, 0, (int32_t)conn_window);
+    quicpro_h2_flow_init(&c->flow, (int32_t)window, (int32_t)conn_window);
+    return c;
+}
+
+/* A pooled connection for `r`'s origin, or a new one */
+static qp_h2_conn_t *qp_h2_acquire(const qp_h2_req_t *r, const qp_h2_opts_t *o, zend_string **error)
+{
+    zend_string *key = strpprintf(0, "%s|%u|%d|%s", ZSTR_VAL(r->host), r->port, o->verify_peer,
+                                  o->ca_file ? ZSTR_VAL(o->ca_file) : "");
+    zend_long now = qp_h2_now_ms();
+    zend_long idle_timeout = quicpro_quic_transport_config.client_pool_idle_timeout_ms;
+    qp_h2_conn_t *found = NULL;
+
+    for (qp_h2_conn_t **at = &qp_h2_pool; *at; ) {
+        qp_h2_conn_t *c = *at;
+        bool idle = c->open == 0 && !c->wait_head;
+        if (idle && !c->broken) {
+            qp_h2_read(c);   /* A GOAWAY or close that arrived meanwhile */
+        }
+        if (idle && (c->broken || c->goaway || !nghttp2_session_want_read(c->ngh2)
+                     || (idle_timeout > 0 && now - c->idle_since_ms > idle_timeout))) {
+            *at = c->next;
+            qp_h2_conn_free(c);
+            continue;
+        }
+        if (!found && !c->broken && !c->goaway && zend_string_equals(c->key, key)) {
+            found = c;
+        }
+        at = &c->next;
+    }
+    if (!found && (found = qp_h2_connect(r, o, key, error))) {
+        found->next = qp_h2_pool;
+        qp_h2_pool = found;
+    }
+    zend_string_release(key);
+    return found;
+}
+
+/*──────────────────────────── Requests ───────────────────────────────────*/
+
+static void qp_h2_add_field(qp_h2_req_t *r, size_t *cap, zend_string *name, zend_string *value)
+{
+    if (r->nvlen == *cap) {
+        *cap = *cap ? *cap * 2 : 8;
+        r->nva = erealloc(r->nva, *cap * sizeof(nghttp2_nv));
+        r->strs = erealloc(r->strs, *cap * 2 * sizeof(zend_string *));
+    }
+    r->strs[r->nvlen * 2] = name;
+    r->strs[r->nvlen * 2 + 1] = value;
+    r->nva[r->nvlen++] = (nghttp2_nv){
+        .name = (uint8_t *)ZSTR_VAL(name), .namelen = ZSTR_LEN(name),
+        .value = (uint8_t *)ZSTR_VAL(value), .valuelen = ZSTR_LEN(value),
+        .flags = NGHTTP2_NV_FLAG_NO_COPY_NAME | NGHTTP2_NV_FLAG_NO_COPY_VALUE,
+    };
+}
+
+static void qp_h2_req_free(qp_h2_req_t *r)
+{
+    for (size_t i = 0; i < r->nvlen * 2; i++) {
+        zend_string_release(r->strs[i]);
+    }
+    if (r->nva) {
+        efree(r->nva);
+        efree(r->strs);
+    }
+    if (r->host) {
+        zend_string_release(r->host);
+    }
+    if (r->body) {
+        zend_string_release(r->body);
+    }
+    zval_ptr_dtor(&r->headers);
+    zval_ptr_dtor(&r->trailers);
+    smart_str_free(&r->resp);
+    if (r->error) {
+        zend_string_release(r->error);
+    }
+    efree(r);
+}
+
+/* Fields HTTP/2 forbids (RFC 9113 §8.2.2); `host` is carried by :authority */
+static bool qp_h2_field_allowed(const zend_string *name)
+{
+    return !zend_string_equals_literal(name, "connection") && !zend_string_equals_literal(name, "keep-alive")
+        && !zend_string_equals_literal(name, "proxy-connection") && !zend_string_equals_literal(name, "transfer-encoding")
+        && !zend_string_equals_literal(name, "upgrade") && !zend_string_equals_literal(name, "host");
+}
+
+/* Builds a request; throws and returns NULL for a bad URL or headers */
+static qp_h2_req_t *qp_h2_req_new(const char *url, size_t url_len, const char *method, size_t method_len,
+                                  HashTable *headers, zend_string *body)
+{
+    php_url *u = php_url_parse_ex(url, url_len);
+    if (!u || !u->host || !u->scheme || !zend_string_equals_literal_ci(u->scheme, "https")) {
+        if (u) {
+            php_url_free(u);
+        }
+        zend_value_error("HTTP/2 URL must be https://host[:port]/path, got \"%s\"", url);
+        return NULL;
+    }
+
+    qp_h2_req_t *r = ecalloc(1, sizeof(*r));
+    size_t cap = 0;
+    array_init(&r->headers);
+    ZVAL_UNDEF(&r->trailers);
+
+    const char *host = ZSTR_VAL(u->host);
+    size_t host_len = ZSTR_LEN(u->host);
+    if (host_len > 2 && host[0] == '[') {
+        host++;
+        host_len -= 2;
+    }
+    r->host = zend_string_init(host, host_len, 0);
+    r->port = u->port ? u->port : 443;
+
+    zend_string *authority = r->port == 443 ? zend_string_copy(u->host) : strpprintf(0, "%s:%u", ZSTR_VAL(u->host), r->port);
+    zend_string *path = strpprintf(0, "%s%s%s", u->path ? ZSTR_VAL(u->path) : "/",
+                                   u->query ? "?" : "", u->query ? ZSTR_VAL(u->query) : "");
+    php_url_free(u);
+
+    /* Pseudo-headers precede all regular fields (RFC 9113 §8.3) */
+    qp_h2_add_field(r, &cap, zend_string_init(":method", 7, 0), zend_string_init(method, method_len, 0));
+    qp_h2_add_field(r, &cap, zend_string_init(":scheme", 7, 0), zend_string_init("https", 5, 0));
+    qp_h2_add_field(r, &cap, zend_string_init(":authority", 10, 0), authority);
+    qp_h2_add_field(r, &cap, zend_string_init(":path", 5, 0), path);
+
+    if (headers) {
+        zend_string *name;
+        zval *value;
+        ZEND_HASH_FOREACH_STR_KEY_VAL(headers, name, value) {
+            if (!name) {
+                qp_h2_req_free(r);
+                zend_throw_exception(zend_ce_value_error, "Request headers must be keyed by field name", 0);
+                return NULL;
+            }
+            /* HTTP/2 field names are lowercase (RFC 9113 §8.2.1) */
+            zend_string *lower = zend_string_tolower(name);
+            if (qp_h2_field_allowed(lower)) {
+                qp_h2_add_field(r, &cap, lower, zval_get_string(value));
+            } else {
+                zend_string_release(lower);
+            }
+        } ZEND_HASH_FOREACH_END();
+    }
+    if (body) {
+        r->body = zend_string_copy(body);
+    }
+    return r;
+}
+
+/* Queues `r` on its origin's connection; a connection failure completes it with the error */
+static void qp_h2_dispatch(qp_h2_req_t *r, const qp_h2_opts_t *o)
+{
+    zend_string *error = NULL;
+    qp_h2_conn_t *c = qp_h2_acquire(r, o, &error);
+    if (!c) {
+        r->done = true;
+        r->error = error;
+        return;
+    }
+    r->conn = c;
+    if (c->wait_tail) {
+        c->wait_tail->next = r;
+    } else {
+        c->wait_head = r;
+    }
+    c->wait_tail = r;
+}
+
+/* Gives up on an unfinished request: off the wait list, or its stream reset */
+static void qp_h2_abandon(qp_h2_req_t *r)
+{
+    qp_h2_conn_t *c = r->conn;
+    if (r->done || !c) {
+        return;
+    }
+    if (r->stream_id == 0) {
+        qp_h2_req_t **at = &c->wait_head;
+        while (*at && *at != r) {
+            at = &(*at)->next;
+        }
+        if (*at) {
+            *at = r->next;
+            if (c->wait_tail == r) {
+                c->wait_tail = NULL;
+                for (qp_h2_req_t *w = c->wait_head; w; w = w->next) {
+                    c->wait_tail = w;
+                }
+            }
+        }
+    } else if (!c->broken) {
+        nghttp2_session_set_stream_user_data(c->ngh2, r->stream_id, NULL);
+        nghttp2_submit_rst_stream(c->ngh2, NGHTTP2_FLAG_NONE, r->stream_id, NGHTTP2_CANCEL);
+        c->open--;
+        qp_h2_flush(c);
+    }
+    r->next = NULL;
+    r->conn = NULL;
+}
+
+/* Drives every connection `reqs` use until all of them are done or the timeout passes */
+static void qp_h2_run(qp_h2_req_t **reqs, uint32_t n, zend_long timeout_ms)
+{
+    zend_long deadline = timeout_ms > 0 ? qp_h2_now_ms() + timeout_ms : 0;
+    struct pollfd *pfds = safe_emalloc(n, sizeof(struct pollfd), 0);
+    qp_h2_conn_t **conns = safe_emalloc(n, sizeof(qp_h2_conn_t *), 0);
+
+    for (;;) {
+        uint32_t nconns = 0;
+        uint32_t round = ++qp_h2_round;
+        for (uint32_t i = 0; i < n; i++) {
+            qp_h2_req_t *r = reqs[i];
+            if (r->done) {
+                continue;
+            }
+            if (r->conn->broken) {
+                r->done = true;
+                r->error = zend_string_copy(r->conn->error);
+                continue;
+            }
+            if (r->conn->round != round) {
+                r->conn->round = round;
+                conns[nconns++] = r->conn;
+            }
+        }
+        if (nconns == 0) {
+            break;
+        }
+
+        bool progress = false;
+        for (uint32_t i = 0; i < nconns; i++) {
+            qp_h2_conn_t *c = conns[i];
+            qp_h2_promote(c);
+            qp_h2_flush(c);
+            pfds[i] = (struct pollfd){
+                .fd = c->fd,
+                .events = POLLIN | (c->woff < c->wlen ? POLLOUT : 0),
+            };
+            progress |= c->broken || SSL_pending(c->ssl) > 0;
+        }
+        if (progress) {
+            for (uint32_t i = 0; i < nconns; i++) {
+                qp_h2_read(conns[i]);
+            }
+            continue;
+        }
+
+        int wait_ms = -1;
+        if (deadline) {
+            zend_long left = deadline - qp_h2_now_ms();
+            if (left <= 0) {
+                for (uint32_t i = 0; i < n; i++) {
+                    if (!reqs[i]->done) {
+                        qp_h2_abandon(reqs[i]);
+                        reqs[i]->done = true;
+                        reqs[i]->error = strpprintf(0, "HTTP/2 request timed out after " ZEND_LONG_FMT " ms", timeout_ms);
+                    }
+                }
+                break;
+            }
+            wait_ms = (int)MIN(left, INT_MAX);
+        }
+        if (poll(pfds, nconns, wait_ms) < 0 && errno != EINTR) {
+            for (uint32_t i = 0; i < nconns; i++) {
+                qp_h2_break(conns[i], strpprintf(0, "Failed to wait for HTTP/2 responses: %s", strerror(errno)));
+            }
+            continue;
+        }
+        for (uint32_t i = 0; i < nconns; i++) {
+            if (pfds[i].revents) {
+                qp_h2_read(conns[i]);
+            }
+        }
+    }
+
+    zend_long now = qp_h2_now_ms();
+    for (uint32_t i = 0; i < n; i++) {
+        qp_h2_abandon(reqs[i]);   /* Done ones are left alone */
+        if (reqs[i]->conn) {
+            reqs[i]->conn->idle_since_ms = now;
+        }
+    }
+    efree(pfds);
+    efree(conns);
+}
+
+static void qp_h2_result(qp_h2_req_t *r, zval *out)
+{
+    array_init_size(out, 4);
+    add_assoc_long(out, "status", r->status);
+    add_assoc_zval(out, "headers", &r->headers);
+    ZVAL_UNDEF(&r->headers);   /* Moved into the result */
+    add_assoc_str(out, "body", quicpro_body_take(&r->resp));
+    if (!Z_ISUNDEF(r->trailers)) {
+        add_assoc_zval(out, "trailers", &r->trailers);
+        ZVAL_UNDEF(&r->trailers);
+    }
+}
+
+static void qp_h2_parse_opts(HashTable *options, qp_h2_opts_t *o)
+{
+    o->timeout_ms = 0;
+    o->verify_peer = true;
+    o->ca_file = NULL;
+    if (!options) {
+        return;
+    }
+    zval *v;
+    if ((v = zend_hash_str_find(options, "timeout_ms", sizeof("timeout_ms") - 1))) {
+        o->timeout_ms = zval_get_long(v);
+    }
+    if ((v = zend_hash_str_find(options, "verify_peer", sizeof("verify_peer") - 1))) {
+        o->verify_peer = zend_is_true(v);
+    }
+    if ((v = zend_hash_str_find(options, "ca_file", sizeof("ca_file") - 1)) && Z_TYPE_P(v) == IS_STRING && Z_STRLEN_P(v)) {
+        o->ca_file = Z_STR_P(v);
+    }
+}
+
+static bool qp_h2_enabled(void)
+{
+    if (!quicpro_http2_config.enable) {
+        zend_throw_exception(NULL, "The HTTP/2 client is disabled by quicpro.http2_enable", 0);
+        return false;
+    }
+    return true;
+}
+
+/*──────────────────────────── Lifecycle ──────────────────────────────────*/
+
+void quicpro_http2_client_rshutdown(void)
+{
+    while (qp_h2_pool) {
+        qp_h2_conn_t *c = qp_h2_pool;
+        qp_h2_pool = c->next;
+        qp_h2_conn_free(c);
+    }
+}
+
+void quicpro_http2_client_mshutdown(void)
+{
+    if (qp_h2_ctx) {
+        SSL_CTX_free(qp_h2_ctx);
+        qp_h2_ctx = NULL;
+    }
+    if (qp_h2_cbs) {
+        nghttp2_session_callbacks_del(qp_h2_cbs);
+        qp_h2_cbs = NULL;
+    }
+}
+
+/*──────────────────────────── Userland API ───────────────────────────────*/
+
+/* {{{ quicpro_http2_request_send(string $url, string $method = "GET", ?array $headers = null, ?string $body = null, ?array $options = null): array|false
  *
- * The parameters are designed to encompass typical HTTP request components,
- * providing flexibility for a wide array of use cases from simple GET requests
- * to complex POST operations with custom headers and large bodies.
- * HTTP/2 benefits such as efficient header compression (HPACK) and stream
- * prioritization are managed by libcurl internally.
+ * Sends one request on the origin's pooled HTTP/2 connection and waits for
+ * its response: `status`, `headers`, `body`, and `trailers` if the server
+ * sent any. Options: `timeout_ms` (0: none), `verify_peer` (default
+ * true) and `ca_file`. Throws on connection, TLS and stream errors.
+ */
+PHP_FUNCTION(quicpro_http2_request_send)
+{
+    char *url;
+    size_t url_len;
+    char *method = "GET";
+    size_t method_len = 3;
+    HashTable *headers = NULL;
+    zend_string *body = NULL;
+    HashTable *options = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 5)
+        Z_PARAM_STRING(url, url_len)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STRING(method, method_len)
+        Z_PARAM_ARRAY_HT_OR_NULL(headers)
+        Z_PARAM_STR_OR_NULL(body)
+        Z_PARAM_ARRAY_HT_OR_NULL(options)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (!qp_h2_enabled()) {
+        RETURN_THROWS();
+    }
+    qp_h2_opts_t o;
+    qp_h2_parse_opts(options, &o);
+    qp_h2_req_t *r = qp_h2_req_new(url, url_len, method, method_len, headers, body);
+    if (!r) {
+        RETURN_THROWS();
+    }
+    qp_h2_dispatch(r, &o);
+    qp_h2_run(&r, 1, o.timeout_ms);
+
+    if (r->error) {
+        throw_network_exception(0, "%s", ZSTR_VAL(r->error));
+        qp_h2_req_free(r);
+        RETURN_FALSE;
+    }
+    qp_h2_result(r, return_value);
+    qp_h2_req_free(r);
+}
+/* }}} */
+
+/* {{{ quicpro_http2_request_send_multi(array $requests, ?array $options = null): array|false
  *
- * @param url_str The target URL for the HTTP/2 request (e.g., "https://example.com/api").
- * This parameter is mandatory. HTTP/2 typically requires HTTPS.
- * @param url_len The length of the `url_str`.
- * @param method_str The HTTP method (e.g., "GET", "POST", "PUT", "DELETE").
- * Defaults to "GET" if not provided.
- * @param method_len The length of the `method_str`.
- * @param headers_array An optional associative PHP array of request headers.
- * Example: `['Content-Type' => 'application/json', 'X-Custom-Header' => 'value']`.
- * Headers are added to the request as key-value pairs and are subject to HTTP/2's
- * HPACK compression by libcurl.
- * @param body_zval The optional request body. This can be:
- * - A PHP string for standard request bodies (e.g., JSON, XML).
- * - A PHP array or object, which will be encoded into IIBIN format
- * if the `request_iibin_schema` option is set, or into JSON otherwise.
- * - A PHP stream resource, enabling zero-copy streaming of large
- * request bodies directly from the stream to the network. This is
- * highly efficient for large uploads over HTTP/2.
- * @param options_array An optional associative PHP array for advanced configuration.
- * This array can contain a multitude of key-value pairs that
- * directly map to underlying libcurl options, providing granular
- * control over timeouts, redirects, SSL/TLS settings, proxy usage,
- * DNS resolution, network interface binding, response body handling
- * (e.g., streaming to file), and IIBIN schema specifications.
- * HTTP/2 specific options might include:
- * - `stream_weight` (int): (If exposed by libcurl) HTTP/2 stream priority weight (1-256).
- * - `pipewait` (bool): (Implicitly handled by `http_version` "2.0") Wait for existing
- * multiplexed connections in the connection pool.
- * (This list is illustrative; the full range of options would be documented
- * in the `quicpro_http_request_send` function's documentation.)
- * @return A PHP array on success, containing:
- * - 'status' (int): The HTTP response status code (e.g., 200, 404).
- * - 'body' (string|array|object|null): The complete HTTP response body. If
- * `output_stream` was used, this is `null`. If `response_iibin_schema` was
- * used, this is the decoded IIBIN data (array/object).
- * - 'headers' (array): An associative array of normalized HTTP response headers.
- * Returns FALSE on failure, automatically throwing a `Quicpro\Exception\HttpClientException`
- * with a detailed error message.
+ * Sends every request at once, each as a stream on its origin's pooled
+ * connection, and waits for all of them. Each request is an array with
+ * `url` and optionally `method`, `headers` and `body`. The results are
+ * keyed like $requests, shaped like quicpro_http2_request_send()'s, or
+ * hold just `error` for a request that failed. `timeout_ms` covers the
+ * whole set.
  */
-PHP_FUNCTION(quicpro_http2_request_send);
+PHP_FUNCTION(quicpro_http2_request_send_multi)
+{
+    HashTable *requests;
+    HashTable *options = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_ARRAY_HT(requests)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_ARRAY_HT_OR_NULL(options)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (!qp_h2_enabled()) {
+        RETURN_THROWS();
+    }
+    qp_h2_opts_t o;
+    qp_h2_parse_opts(options, &o);
+
+    /* Build every request before sending any */
+    uint32_t n = zend_hash_num_elements(requests);
+    qp_h2_req_t **reqs = safe_emalloc(MAX(n, 1), sizeof(qp_h2_req_t *), 0);
+    uint32_t built = 0;
+    zval *spec;
+    ZEND_HASH_FOREACH_VAL(requests, spec) {
+        zval *url = Z_TYPE_P(spec) == IS_ARRAY ? zend_hash_str_find(Z_ARRVAL_P(spec), "url", 3) : NULL;
+        if (!url || Z_TYPE_P(url) != IS_STRING) {
+            zend_argument_value_error(1, "must contain only arrays with a string \"url\"");
+            goto fail;
+        }
+        zval *method = zend_hash_str_find(Z_ARRVAL_P(spec), "method", 6);
+        zval *hdrs = zend_hash_str_find(Z_ARRVAL_P(spec), "headers", 7);
+        zval *body = zend_hash_str_find(Z_ARRVAL_P(spec), "body", 4);
+        zend_string *body_str = body && Z_TYPE_P(body) != IS_NULL ? zval_get_string(body) : NULL;
+        qp_h2_req_t *r = qp_h2_req_new(Z_STRVAL_P(url), Z_STRLEN_P(url),
+                                       method && Z_TYPE_P(method) == IS_STRING ? Z_STRVAL_P(method) : "GET",
+                                       method && Z_TYPE_P(method) == IS_STRING ? Z_STRLEN_P(method) : 3,
+                                       hdrs && Z_TYPE_P(hdrs) == IS_ARRAY ? Z_ARRVAL_P(hdrs) : NULL, body_str);
+        if (body_str) {
+            zend_string_release(body_str);
+        }
+        if (!r) {
+            goto fail;
+        }
+        reqs[built++] = r;
+    } ZEND_HASH_FOREACH_END();
+
+    for (uint32_t i = 0; i < n; i++) {
+        qp_h2_dispatch(reqs[i], &o);
+    }
+    qp_h2_run(reqs, n, o.timeout_ms);
+
+    array_init_size(return_value, n);
+    zend_ulong idx;
+    zend_string *key;
+    uint32_t i = 0;
+    ZEND_HASH_FOREACH_KEY(requests, idx, key) {
+        qp_h2_req_t *r = reqs[i++];
+        zval entry;
+        if (r->error) {
+            array_init_size(&entry, 1);
+            add_assoc_str(&entry, "error", zend_string_copy(r->error));
+        } else {
+            qp_h2_result(r, &entry);
+        }
+        if (key) {
+            zend_hash_update(Z_ARRVAL_P(return_value), key, &entry);
+        } else {
+            zend_hash_index_update(Z_ARRVAL_P(return_value), idx, &entry);
+        }
+        qp_h2_req_free(r);
+    } ZEND_HASH_FOREACH_END();
+    efree(reqs);
+    return;
+
+fail:
+    while (built) {
+        qp_h2_req_free(reqs[--built]);
+    }
+    efree(reqs);
+    RETURN_THROWS();
+}
+/* }}} */
+
+#else /* !QUICPRO_HAVE_NGHTTP2 */
+
+void quicpro_http2_client_rshutdown(void) {}
+void quicpro_http2_client_mshutdown(void) {}
+
+PHP_FUNCTION(quicpro_http2_request_send)
+{
+    zval *args;
+    uint32_t argc;
+
+    ZEND_PARSE_PARAMETERS_START(0, -1)
+        Z_PARAM_VARIADIC('*', args, argc)   /* Irrelevant without nghttp2 */
+    ZEND_PARSE_PARAMETERS_END();
+    zend_throw_exception(NULL, "quicpro_async was built without nghttp2; use quicpro_http_request_send()", 0);
+    RETURN_THROWS();
+}
+
+PHP_FUNCTION(quicpro_http2_request_send_multi)
+{
+    zval *args;
+    uint32_t argc;
+
+    ZEND_PARSE_PARAMETERS_START(0, -1)
+        Z_PARAM_VARIADIC('*', args, argc)
+    ZEND_PARSE_PARAMETERS_END();
+    zend_throw_exception(NULL, "quicpro_async was built without nghttp2; use quicpro_http_batch_submit()", 0);
+    RETURN_THROWS();
+}
 
-#endif // QUICPRO_CLIENT_HTTP2_H
\ No newline at end of file
+#endif /* QUICPRO_HAVE_NGHTTP2 */
@@ -1,81 +1,400 @@
-#ifndef QUICPRO_CLIENT_INDEX_H
-#define QUICPRO_CLIENT_INDEX_H
+#include "php_quicpro.h"
+#include "client/index.h"
+#include "client/alt_svc.h"
+#include "client/mux.h"
+#include "client/pool.h"
+#include "client/session.h"
+#include "config/config.h"
+#include "config/quic_transport/base_layer.h"
+#include "http_client/http_client.h"
+#include "poll/scheduler.h"
 
-#include <php.h> // Essential for PHP_FUNCTION macro and fundamental PHP types.
+#include <errno.h>
+#include <limits.h>
+#include <main/php_url.h>
+#include <poll.h>
+#include <quiche.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <zend_smart_str.h>
 
 /**
- * @file extension/include/client/index.h
- * @brief Centralized Client API for Quicpro.
+ * @file extension/src/client/index.c
+ * @brief Implementation of the unified client's protocol selection.
  *
- * This header defines the primary entry point for all outbound HTTP requests
- * initiated from PHP userland through the Quicpro extension. It provides a
- * high-level, protocol-agnostic interface that intelligently selects and
- * manages the underlying transport and application protocols (HTTP/1.1, HTTP/2,
- * HTTP/3 over QUIC).
- *
- * The design incorporates advanced features like "Happy Eyeballs" for
- * optimized connection establishment across different IP families and
- * protocol versions, ensuring the lowest possible latency and highest
- * reliability under varying network conditions. It aims to be the definitive
- * and "perfect" client for all scenarios, from low-latency IoT communications
- * to high-throughput web service interactions.
- *
- * All request parameters, headers, bodies, and extensive options are passed
- * through to the chosen specialized client implementation (e.g., HTTP/1.1,
- * HTTP/2 via libcurl, or HTTP/3 via native quiche integration), ensuring
- * consistent behavior and comprehensive control regardless of the final
- * protocol decided upon.
+ * A request goes over TCP (libcurl, include/http_client/http_client.h)
+ * unless HTTP/3 was asked for or the origin announced it: every TCP
+ * response's Alt-Svc header feeds the cache of include/client/alt_svc.h,
+ * and an origin found there is tried over QUIC first (client/mux.c on a
+ * pooled session). The QUIC attempt may fall back to TCP only while
+ * nothing has been sent, i.e. before the handshake completes, so no
+ * request is ever delivered twice.
  */
 
-/**
- * @brief Sends an HTTP request with automatic protocol and IP family negotiation.
- *
- * This function serves as the intelligent, top-level client request dispatcher.
- * It automatically attempts to establish a connection and send an HTTP request
- * using the optimal protocol and IP family based on the provided configuration
- * (`Quicpro\Config`) or sensible defaults.
- *
- * The selection process follows a "Happy Eyeballs" principle, attempting preferred
- * protocols and IP families in parallel or with controlled fallbacks to minimize
- * perceived latency. For example, it might prioritize HTTP/3 over QUIC for speed,
- * falling back to HTTP/2 over TCP, and then to HTTP/1.1 if necessary.
- * IP family preference (IPv6 vs. IPv4) is also part of this negotiation.
- *
- * Explicit protocol and IP family preferences can be specified in the `options_array`
- * to override the automatic behavior, allowing for highly specialized use cases
- * (e.g., forcing IPv4 only for IoT devices).
- *
- * @param url_str The target URL for the HTTP request (e.g., "https://api.example.com").
- * This parameter is mandatory.
- * @param url_len The length of the `url_str`.
- * @param method_str The HTTP method (e.g., "GET", "POST", "PUT", "DELETE").
- * Defaults to "GET" if not provided.
- * @param method_len The length of the `method_str`.
- * @param headers_array An optional associative PHP array of request headers.
- * Example: `['Accept' => 'application/json']`.
- * @param body_zval The optional request body. This can be:
- * - A PHP string for standard request bodies.
- * - A PHP array or object, which will be encoded into IIBIN or JSON.
- * - A PHP stream resource, enabling zero-copy streaming for uploads.
- * @param options_array An optional associative PHP array for advanced configuration.
- * This array can specify protocol preferences (`preferred_protocol`),
- * IP family preferences (`preferred_ip_family`), Happy Eyeballs timeouts,
- * as well as all other generic `libcurl` or `quiche`-specific options
- * relevant to the chosen protocol. Key options for protocol selection:
- * - `preferred_protocol` (string): "auto" (default, Happy Eyeballs), "http1.1", "http2.0", "http3.0".
- * - `preferred_ip_family` (string): "auto" (default, Happy Eyeballs), "ipv4", "ipv6".
- * - `happy_eyeballs_quic_timeout_ms` (int): Timeout for initial QUIC attempt.
- * - `happy_eyeballs_tcp_timeout_ms` (int): Timeout for initial TCP attempt if parallel.
- * - `connection_config` (resource): An optional `Quicpro\Config` resource
- * for this specific connection, overriding global INI settings.
- * @return A PHP array on success, containing:
- * - 'status' (int): The HTTP response status code.
- * - 'body' (string|array|object|null): The response body, potentially
- * IIBIN-decoded or null if streamed.
- * - 'headers' (array): An associative array of normalized HTTP response headers.
- * Returns FALSE on failure, automatically throwing a specific `Quicpro\Exception`
- * subclass (e.g., `HttpClientException`, `QuicException`, `TlsException`).
+extern int le_quicpro_session;
+extern int le_quicpro_cfg;
+
+/* Default of `happy_eyeballs_quic_timeout_ms`: the wait for a first answer over UDP */
+#define QP_CLIENT_QUIC_TIMEOUT_MS 300
+
+/* The Config of requests without `connection_config`: the request's php.ini Config, one reference */
+static zend_resource *qp_client_default_cfg;
+
+void quicpro_client_rshutdown(void) {
+    if (qp_client_default_cfg) {
+        zend_list_delete(qp_client_default_cfg);
+        qp_client_default_cfg = NULL;
+    }
+}
+
+static zend_long qp_client_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (zend_long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static zend_long qp_client_option_long(HashTable *opts, const char *key, size_t key_len, zend_long def) {
+    zval *zv = opts ? zend_hash_str_find(opts, key, key_len) : NULL;
+    return zv && Z_TYPE_P(zv) == IS_LONG ? Z_LVAL_P(zv) : def;
+}
+
+/* Feeds the response's Alt-Svc field (a string, or a list when repeated) to the cache. */
+static void qp_client_learn(const char *host, zend_long port, zval *result) {
+    zval *headers = zend_hash_str_find(Z_ARRVAL_P(result), "headers", sizeof("headers") - 1);
+    zval *alt = headers && Z_TYPE_P(headers) == IS_ARRAY
+              ? zend_hash_str_find(Z_ARRVAL_P(headers), "alt-svc", sizeof("alt-svc") - 1) : NULL;
+    if (!alt) {
+        return;
+    }
+    if (Z_TYPE_P(alt) == IS_STRING) {
+        quicpro_alt_svc_learn(host, port, Z_STRVAL_P(alt), Z_STRLEN_P(alt));
+    } else if (Z_TYPE_P(alt) == IS_ARRAY) {
+        smart_str joined = {0};
+        zval *v;
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(alt), v) {
+            if (Z_TYPE_P(v) == IS_STRING) {
+                if (joined.s) {
+                    smart_str_appendl(&joined, ", ", 2);
+                }
+                smart_str_append(&joined, Z_STR_P(v));
+            }
+        } ZEND_HASH_FOREACH_END();
+        if (joined.s) {
+            quicpro_alt_svc_learn(host, port, ZSTR_VAL(joined.s), ZSTR_LEN(joined.s));
+            smart_str_free(&joined);
+        }
+    }
+}
+
+/*──────────────────────────── HTTP/3 ─────────────────────────────────────*/
+
+static quicpro_cfg_t *qp_client_cfg(HashTable *opts) {
+    zval *zv = opts ? zend_hash_str_find(opts, "connection_config", sizeof("connection_config") - 1) : NULL;
+    if (zv && Z_TYPE_P(zv) == IS_RESOURCE) {
+        quicpro_cfg_t *cfg = (quicpro_cfg_t *)zend_fetch_resource_ex(zv, "Quicpro\\Config", le_quicpro_cfg);
+        if (!cfg || !cfg->quiche_cfg) {
+            throw_config_exception(0, "Invalid or uninitialized Quicpro\\Config resource provided.");
+            return NULL;
+        }
+        return cfg;
+    }
+    if (!qp_client_default_cfg) {
+        qp_client_default_cfg = quicpro_config_default();
+        if (!qp_client_default_cfg) {
+            return NULL;
+        }
+        GC_ADDREF(qp_client_default_cfg);
+    }
+    return (quicpro_cfg_t *)qp_client_default_cfg->ptr;
+}
+
+/* Sleeps until `s` has I/O or `wait_ms` (-1: a quiche timer) passes; false after throwing. */
+static bool qp_client_wait(quicpro_session_t *s, zend_resource *res, zend_long wait_ms) {
+    int64_t quic_deadline = quiche_conn_timeout_as_millis(s->conn);
+    if (quic_deadline >= 0 && (wait_ms < 0 || quic_deadline < wait_ms)) {
+        wait_ms = quic_deadline;
+    }
+    quicpro_sched_result_t rc = quicpro_sched_wait(s, res, wait_ms);
+    if (rc == QUICPRO_SCHED_ERROR) {
+        return false;
+    }
+    if (rc == QUICPRO_SCHED_NO_FIBER) {
+        struct pollfd pfd = { .fd = s->sock, .events = POLLIN };
+        if (poll(&pfd, 1, wait_ms < 0 ? -1 : (int)MIN(wait_ms, INT_MAX)) < 0 && errno != EINTR) {
+            throw_network_exception(errno, "Failed to wait for the HTTP/3 response: %s", strerror(errno));
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Drives the handshake of `s`. 1: established; 0: the server did not answer
+ * within `quic_timeout_ms`, did not finish within
+ * `quicpro.transport_happy_eyeballs_timeout_ms` or refused; -1: thrown.
+ */
+static int qp_client_handshake(quicpro_session_t *s, zend_resource *res, zend_long start, zend_long quic_timeout_ms) {
+    zend_long limit = MAX(quic_timeout_ms, quicpro_quic_transport_config.happy_eyeballs_timeout_ms);
+
+    while (!quiche_conn_is_established(s->conn)) {
+        if (s->is_closed || quiche_conn_is_closed(s->conn)) {
+            return 0;
+        }
+        quiche_stats st;
+        quiche_conn_stats(s->conn, &st);
+        zend_long elapsed = qp_client_now_ms() - start;
+        if (elapsed >= limit || (elapsed >= quic_timeout_ms && st.recv == 0)) {
+            return 0;   /* Silence on UDP: blocked, or nothing listens */
+        }
+        zend_long wait_ms = (st.recv == 0 ? quic_timeout_ms : limit) - elapsed;
+        if (!qp_client_wait(s, res, wait_ms)) {
+            return -1;
+        }
+        quicpro_h3_mux_step(s);
+    }
+    return 1;
+}
+
+/*
+ * Sends the request over HTTP/3 to `host`:`h3_port`.
+ * 1: `return_value` holds the response; -1: thrown; 0 (only with
+ * `fallback`): no handshake, nothing was sent, the caller uses TCP.
  */
-PHP_FUNCTION(quicpro_client_send_request);
+static int qp_client_h3(const php_url *u, const char *host, zend_long port, zend_long h3_port, const char *method,
+                        zval *headers, zend_string *body, HashTable *opts, bool fallback, zval *return_value) {
+    quicpro_cfg_t *cfg = qp_client_cfg(opts);
+    if (!cfg) {
+        return -1;
+    }
+    zend_long start = qp_client_now_ms();
+    zend_long quic_timeout_ms = fallback
+        ? qp_client_option_long(opts, "happy_eyeballs_quic_timeout_ms", sizeof("happy_eyeballs_quic_timeout_ms") - 1, QP_CLIENT_QUIC_TIMEOUT_MS)
+        : quicpro_quic_transport_config.happy_eyeballs_timeout_ms;
+    zend_long timeout_ms = qp_client_option_long(opts, "timeout_ms", sizeof("timeout_ms") - 1, -1);
+
+    /* A pooled connection nobody else holds, so every completion on it is ours */
+    bool pooled = quicpro_quic_transport_config.client_pool_enable;
+    quicpro_pool_key_t key = { host, strlen(host), h3_port, "h3", cfg };
+    zend_resource *res = pooled ? quicpro_client_pool_checkout(&key, 1) : NULL;
+    quicpro_session_t *s;
+
+    if (res) {
+        s = (quicpro_session_t *)res->ptr;
+    } else {
+        zval sess_opts;
+        if (opts) {
+            ZVAL_ARR(&sess_opts, zend_array_dup(opts));
+        } else {
+            array_init(&sess_opts);
+        }
+        add_assoc_long(&sess_opts, "happy_eyeballs_timeout_ms", quic_timeout_ms);
+        s = quicpro_client_session_open(host, strlen(host), h3_port, cfg, -1, Z_ARRVAL(sess_opts));
+        zval_ptr_dtor(&sess_opts);
+        if (!s) {
+            /* Misuse such as an unknown cc_profile is reported, not routed around */
+            if (!fallback || !EG(exception) || instanceof_function(EG(exception)->ce, zend_ce_value_error)) {
+                return -1;
+            }
+            zend_clear_exception();
+            return 0;
+        }
+        s->resource = res = zend_register_resource(s, le_quicpro_session);
+        if (pooled) {
+            quicpro_client_pool_add(&key, s);
+        }
+    }
+
+    int rc = qp_client_handshake(s, res, start, quic_timeout_ms);
+    if (rc <= 0) {
+        if (!s->is_closed && !quiche_conn_is_closed(s->conn)) {
+            quiche_conn_close(s->conn, true, 0, NULL, 0);   /* So the pool drops it */
+        }
+        zend_list_delete(res);
+        if (rc == 0 && !fallback) {
+            throw_quic_exception(0, "HTTP/3 handshake with '%s:" ZEND_LONG_FMT "' did not complete", host, h3_port);
+            return -1;
+        }
+        return rc;
+    }
+
+    /* :authority stays the origin's, not the alternative's (RFC 7838 §2.4) */
+    zval spec;
+    array_init(&spec);
+    add_assoc_string(&spec, "method", (char *)method);
+    add_assoc_str(&spec, "scheme", zend_string_copy(u->scheme));
+    if (u->port) {
+        add_assoc_str(&spec, "authority", zend_strpprintf(0, "%s:" ZEND_LONG_FMT, ZSTR_VAL(u->host), port));
+    } else {
+        add_assoc_str(&spec, "authority", zend_string_copy(u->host));
+    }
+    add_assoc_str(&spec, "path", u->query
+        ? zend_strpprintf(0, "%s?%s", u->path ? ZSTR_VAL(u->path) : "/", ZSTR_VAL(u->query))
+        : (u->path ? zend_string_copy(u->path) : zend_string_init("/", 1, 0)));
+    if (headers) {
+        Z_TRY_ADDREF_P(headers);
+        add_assoc_zval(&spec, "headers", headers);
+    }
+    if (body) {
+        add_assoc_str(&spec, "body", zend_string_copy(body));
+    }
+    uint64_t id;
+    bool queued = quicpro_h3_mux_submit_request(s, Z_ARRVAL(spec), &id);
+    zval_ptr_dtor(&spec);
+    if (!queued) {
+        zend_list_delete(res);
+        return -1;
+    }
+
+    for (;;) {
+        quicpro_h3_mux_step(s);
+
+        uint64_t done_id;
+        zend_long status;
+        zend_string *resp_body, *error;
+        zval resp_headers;
+        while (quicpro_h3_mux_take(s, &done_id, &status, &resp_body, &error, &resp_headers)) {
+            if (done_id != id) {
+                /* Left unclaimed by the connection's previous holder */
+                zend_string_release(resp_body);
+                if (error) {
+                    zend_string_release(error);
+                }
+                zval_ptr_dtor(&resp_headers);
+                continue;
+            }
+            zend_list_delete(res);
+            if (error) {
+                throw_quic_exception(0, "HTTP/3 request to '%s' failed: %s", host, ZSTR_VAL(error));
+                zend_string_release(error);
+                zend_string_release(resp_body);
+                zval_ptr_dtor(&resp_headers);
+                return -1;
+            }
+            array_init_size(return_value, 4);
+            add_assoc_long(return_value, "status", status);
+            add_assoc_zval(return_value, "headers", &resp_headers);
+            add_assoc_str(return_value, "body", resp_body);
+            add_assoc_string(return_value, "protocol", "h3");
+            quicpro_alt_svc_mark_working(host, port);
+            return 1;
+        }
+
+        zend_long elapsed = qp_client_now_ms() - start;
+        if (timeout_ms >= 0 && elapsed >= timeout_ms) {
+            zend_list_delete(res);
+            throw_quic_exception(0, "HTTP/3 request to '%s' timed out after " ZEND_LONG_FMT " ms", host, timeout_ms);
+            return -1;
+        }
+        if (!qp_client_wait(s, res, timeout_ms >= 0 ? timeout_ms - elapsed : -1)) {
+            zend_list_delete(res);
+            return -1;
+        }
+    }
+}
+
+/*───────────────────────────── TCP ───────────────────────────────────────*/
+
+static bool qp_client_tcp(const char *url, const char *method, zval *headers, zend_string *body,
+                          zval *options, const char *http_version, zval *return_value) {
+    zval curl_opts;
+    if (options) {
+        ZVAL_ARR(&curl_opts, zend_array_dup(Z_ARRVAL_P(options)));
+    } else {
+        array_init(&curl_opts);
+    }
+    if (http_version) {
+        add_assoc_string(&curl_opts, "http_version", (char *)http_version);
+    }
+    bool ok = quicpro_http_request(url, method, headers, body, &curl_opts, return_value);
+    zval_ptr_dtor(&curl_opts);
+    if (ok) {
+        add_assoc_string(return_value, "protocol", "tcp");
+    }
+    return ok;
+}
+
+/*─────────────────────────── PHP function ────────────────────────────────*/
+
+PHP_FUNCTION(quicpro_client_send_request)
+{
+    zend_string *url;
+    char *method = "GET";
+    size_t method_len = 3;
+    zval *headers = NULL;
+    zend_string *body = NULL;
+    zval *options = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 5)
+        Z_PARAM_STR(url)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STRING(method, method_len)
+        Z_PARAM_ARRAY_OR_NULL(headers)
+        Z_PARAM_STR_OR_NULL(body)
+        Z_PARAM_ARRAY_OR_NULL(options)
+    ZEND_PARSE_PARAMETERS_END();
+
+    HashTable *opts = options ? Z_ARRVAL_P(options) : NULL;
+    zval *proto_val = opts ? zend_hash_str_find(opts, "preferred_protocol", sizeof("preferred_protocol") - 1) : NULL;
+    zend_string *proto = proto_val && Z_TYPE_P(proto_val) == IS_STRING ? Z_STR_P(proto_val) : NULL;
+    bool want_h3 = proto && zend_string_equals_literal(proto, "http3.0");
+    const char *http_version = NULL;
+    if (proto && zend_string_equals_literal(proto, "http1.1")) {
+        http_version = "1.1";
+    } else if (proto && zend_string_equals_literal(proto, "http2.0")) {
+        http_version = "2.0";
+    } else if (proto && !want_h3 && !zend_string_equals_literal(proto, "auto")) {
+        zend_argument_value_error(5, "option \"preferred_protocol\" must be \"auto\", \"http1.1\", \"http2.0\" or \"http3.0\"");
+        RETURN_THROWS();
+    }
+
+    php_url *u = php_url_parse_ex(ZSTR_VAL(url), ZSTR_LEN(url));
+    bool https = u && u->scheme && zend_string_equals_literal_ci(u->scheme, "https");
+    if (!u || !u->host || !(https || (u->scheme && zend_string_equals_literal_ci(u->scheme, "http")))) {
+        if (u) {
+            php_url_free(u);
+        }
+        zend_argument_value_error(1, "must be an absolute http:// or https:// URL");
+        RETURN_THROWS();
+    }
+    if (want_h3 && !https) {
+        php_url_free(u);
+        zend_argument_value_error(1, "must be an https:// URL for HTTP/3");
+        RETURN_THROWS();
+    }
+
+    /* The bare host: "[::1]" names the address ::1 */
+    char host[QUICPRO_MAX_HOST_LEN];
+    const char *h = ZSTR_VAL(u->host);
+    size_t h_len = ZSTR_LEN(u->host);
+    if (h_len >= 2 && h[0] == '[' && h[h_len - 1] == ']') {
+        h++;
+        h_len -= 2;
+    }
+    snprintf(host, sizeof(host), "%.*s", (int)h_len, h);
+    zend_long port = u->port ? u->port : (https ? 443 : 80);
+
+    int rc = 0;
+    if (want_h3) {
+        rc = qp_client_h3(u, host, port, port, method, headers, body, opts, false, return_value);
+    } else if (https && !http_version) {
+        zend_long h3_port = quicpro_alt_svc_h3_port(host, port);
+        if (h3_port) {
+            rc = qp_client_h3(u, host, port, h3_port, method, headers, body, opts, true, return_value);
+            if (rc == 0) {
+                quicpro_alt_svc_mark_broken(host, port);
+            }
+        }
+    }
+    if (rc == 0) {
+        rc = qp_client_tcp(ZSTR_VAL(url), method, headers, body, options, http_version, return_value) ? 1 : -1;
+    }
+    if (rc > 0 && https) {
+        qp_client_learn(host, port, return_value);
+    }
+    php_url_free(u);
 
-#endif // QUICPRO_CLIENT_INDEX_H
\ No newline at end of file
+    if (rc < 0) {
+        RETURN_FALSE;
+    }
+}
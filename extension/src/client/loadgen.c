@@ -0,0 +1,761 @@
+#include "php_quicpro.h"
+#include "client/loadgen.h"
+#include "client/mux.h"
+#include "client/session.h"
+#include "config/config.h"
+#include "http_client/http_client.h"
+
+#include <limits.h>
+#include <poll.h>
+#include <quiche.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <zend_exceptions.h>
+
+/**
+ * @file extension/src/client/loadgen.c
+ * @brief Implementation of the open-loop load generator.
+ *
+ * Request n is due at start + n * 1e6 / rate microseconds. Each round of
+ * the loop sends what is due (while `max_in_flight` allows), moves every
+ * session and the curl engine forward, takes their completions and sleeps
+ * until the next request is due or a socket or QUIC timer needs attention.
+ * A pending request is keyed by its id in its session's (or the curl
+ * engine's) table, which holds when it was due and its kind.
+ */
+
+extern int le_quicpro_session;
+extern int le_quicpro_cfg;
+
+/* Log-linear histogram: values below 128 us are exact, above that 64 sub-buckets per power of two */
+#define QP_LG_SUB_BITS   6
+#define QP_LG_EXACT      (2u << QP_LG_SUB_BITS)
+#define QP_LG_MAX_BIT    40                     /* Up to 2^41 us, about 25 days */
+#define QP_LG_BUCKETS    ((QP_LG_MAX_BIT - QP_LG_SUB_BITS) * (1u << QP_LG_SUB_BITS) + QP_LG_EXACT)
+
+#define QP_LG_MAX_CONNECTIONS 64
+#define QP_LG_LATE_US    1000                   /* A request sent this long after it was due counts as late */
+
+enum { QP_LG_H1, QP_LG_H2, QP_LG_H3, QP_LG_MCP, QP_LG_PROTOCOLS };
+static const char *const qp_lg_protocols[QP_LG_PROTOCOLS] = { "h1", "h2", "h3", "mcp" };
+
+typedef struct {
+    uint64_t sent, completed, errors, timeouts, late;
+    uint64_t min_us, max_us;
+    double   sum_us;
+    uint64_t buckets[QP_LG_BUCKETS];
+} qp_lg_stats_t;
+
+typedef struct {
+    int            protocol;
+    int64_t        weight, current;             /* Smooth weighted round robin */
+    /* h1, h2 */
+    zend_string   *url;
+    zend_string   *method;
+    zval           headers;
+    zend_string   *body;
+    zval           options;                     /* The entry's curl options, with http_version forced */
+    /* h3, mcp */
+    zval           spec;                        /* As for quicpro_http3_batch_submit() */
+    uint32_t       first_conn, conns, next_conn;
+} qp_lg_mix_t;
+
+typedef struct {
+    quicpro_session_t *s;
+    zend_resource     *res;
+    HashTable          pending;                 /* Mux id => (due - start) << 2 | protocol */
+    zend_string       *host;
+    zend_long          port;
+} qp_lg_conn_t;
+
+typedef struct {
+    zend_long      rate, duration_ms, timeout_ms, max_in_flight, connections;
+    qp_lg_mix_t   *mix;
+    uint32_t       nmix;
+    int64_t        total_weight;
+    qp_lg_conn_t  *conns;
+    uint32_t       nconns;
+    struct pollfd *pfds;
+    bool           http;                        /* Any h1 or h2 in the mix */
+    HashTable      http_pending;                /* Curl batch id => as above */
+    zend_resource *cfg_res;                     /* The Config built from php.ini, if none was given */
+    quicpro_cfg_t *cfg;
+    uint64_t       start_us, in_flight;
+    qp_lg_stats_t *stats;                       /* One per protocol, then the total */
+} qp_lg_t;
+
+static uint64_t qp_lg_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/*──────────────────────────── Histogram ──────────────────────────────────*/
+
+static uint32_t qp_lg_bucket(uint64_t v)
+{
+    if (v < QP_LG_EXACT) {
+        return (uint32_t)v;
+    }
+    v = MIN(v, (UINT64_C(2) << QP_LG_MAX_BIT) - 1);
+    uint32_t shift = (uint32_t)(63 - __builtin_clzll(v)) - QP_LG_SUB_BITS;
+    return (shift << QP_LG_SUB_BITS) + (uint32_t)(v >> shift);
+}
+
+static uint64_t qp_lg_bucket_low(uint32_t i)
+{
+    if (i < QP_LG_EXACT) {
+        return i;
+    }
+    uint32_t shift = (i >> QP_LG_SUB_BITS) - 1;
+    return (uint64_t)(i - (shift << QP_LG_SUB_BITS)) << shift;
+}
+
+/* The highest value that falls into bucket `i` */
+static uint64_t qp_lg_bucket_high(uint32_t i)
+{
+    return i < QP_LG_EXACT ? i : qp_lg_bucket_low(i) + (UINT64_C(1) << ((i >> QP_LG_SUB_BITS) - 1)) - 1;
+}
+
+static void qp_lg_stats_add(qp_lg_stats_t *st, uint64_t latency_us, uint64_t count)
+{
+    if (!st->completed || latency_us < st->min_us) st->min_us = latency_us;
+    if (latency_us > st->max_us) st->max_us = latency_us;
+    st->completed += count;
+    st->sum_us += (double)latency_us * (double)count;
+    st->buckets[qp_lg_bucket(latency_us)] += count;
+}
+
+static uint64_t qp_lg_percentile(const qp_lg_stats_t *st, double q)
+{
+    uint64_t rank = (uint64_t)(q * (double)st->completed + 0.5), seen = 0;
+    rank = MAX(rank, 1);
+    for (uint32_t i = 0; i < QP_LG_BUCKETS; i++) {
+        seen += st->buckets[i];
+        if (seen >= rank) {
+            return MIN(qp_lg_bucket_high(i), st->max_us);
+        }
+    }
+    return st->max_us;
+}
+
+static void qp_lg_stats_to_array(const qp_lg_stats_t *st, zval *out)
+{
+    static const struct { const char *name; double q; } pct[] = {
+        { "p50", 0.5 }, { "p90", 0.9 }, { "p99", 0.99 }, { "p99.9", 0.999 }, { "p99.99", 0.9999 },
+    };
+    zval latency, hist;
+
+    array_init(out);
+    add_assoc_long(out, "sent", (zend_long)st->sent);
+    add_assoc_long(out, "completed", (zend_long)st->completed);
+    add_assoc_long(out, "errors", (zend_long)st->errors);
+    add_assoc_long(out, "timeouts", (zend_long)st->timeouts);
+
+    array_init(&latency);
+    add_assoc_long(&latency, "min", (zend_long)(st->completed ? st->min_us : 0));
+    add_assoc_double(&latency, "mean", st->completed ? st->sum_us / (double)st->completed : 0.0);
+    for (size_t i = 0; i < sizeof(pct) / sizeof(pct[0]); i++) {
+        add_assoc_long(&latency, pct[i].name, (zend_long)(st->completed ? qp_lg_percentile(st, pct[i].q) : 0));
+    }
+    add_assoc_long(&latency, "max", (zend_long)st->max_us);
+    add_assoc_zval(out, "latency_us", &latency);
+
+    /* Only what it holds, keyed by each bucket's lowest value: enough to merge runs */
+    array_init(&hist);
+    for (uint32_t i = 0; i < QP_LG_BUCKETS; i++) {
+        if (st->buckets[i]) {
+            add_index_long(&hist, (zend_ulong)qp_lg_bucket_low(i), (zend_long)st->buckets[i]);
+        }
+    }
+    add_assoc_zval(out, "histogram", &hist);
+}
+
+static zend_long qp_lg_array_long(HashTable *ht, const char *key, size_t key_len)
+{
+    zval *zv = ht ? zend_hash_str_find(ht, key, key_len) : NULL;
+    return zv ? zval_get_long(zv) : 0;
+}
+
+/* Adds a result array (of quicpro_loadgen_run() or a protocol in it) to `st` */
+static void qp_lg_stats_merge(qp_lg_stats_t *st, HashTable *in)
+{
+    zval *latency = zend_hash_str_find(in, "latency_us", sizeof("latency_us") - 1);
+    zval *hist = zend_hash_str_find(in, "histogram", sizeof("histogram") - 1);
+    HashTable *lat = latency && Z_TYPE_P(latency) == IS_ARRAY ? Z_ARRVAL_P(latency) : NULL;
+    uint64_t completed = (uint64_t)MAX(qp_lg_array_long(in, "completed", sizeof("completed") - 1), 0);
+
+    st->sent += (uint64_t)MAX(qp_lg_array_long(in, "sent", sizeof("sent") - 1), 0);
+    st->errors += (uint64_t)MAX(qp_lg_array_long(in, "errors", sizeof("errors") - 1), 0);
+    st->timeouts += (uint64_t)MAX(qp_lg_array_long(in, "timeouts", sizeof("timeouts") - 1), 0);
+    st->late += (uint64_t)MAX(qp_lg_array_long(in, "late", sizeof("late") - 1), 0);
+    if (!completed || !hist || Z_TYPE_P(hist) != IS_ARRAY) {
+        return;
+    }
+    uint64_t min_us = (uint64_t)MAX(qp_lg_array_long(lat, "min", sizeof("min") - 1), 0);
+    uint64_t max_us = (uint64_t)MAX(qp_lg_array_long(lat, "max", sizeof("max") - 1), 0);
+    zval *mean = lat ? zend_hash_str_find(lat, "mean", sizeof("mean") - 1) : NULL;
+    double sum_us = st->sum_us + (mean ? zval_get_double(mean) : 0.0) * (double)completed;
+
+    zend_ulong low;
+    zval *count;
+    ZEND_HASH_FOREACH_NUM_KEY_VAL(Z_ARRVAL_P(hist), low, count) {
+        zend_long n = zval_get_long(count);
+        if (n > 0) {
+            st->buckets[qp_lg_bucket(low)] += (uint64_t)n;
+        }
+    } ZEND_HASH_FOREACH_END();
+    if (!st->completed || min_us < st->min_us) st->min_us = min_us;
+    if (max_us > st->max_us) st->max_us = max_us;
+    st->completed += completed;
+    st->sum_us = sum_us;
+}
+
+/*──────────────────────────── Setup ──────────────────────────────────────*/
+
+static zend_long qp_lg_option_long(HashTable *ht, const char *key, size_t key_len, zend_long def)
+{
+    zval *zv = zend_hash_str_find(ht, key, key_len);
+    return zv && Z_TYPE_P(zv) == IS_LONG ? Z_LVAL_P(zv) : def;
+}
+
+static zend_string *qp_lg_option_string(HashTable *ht, const char *key, size_t key_len)
+{
+    zval *zv = zend_hash_str_find(ht, key, key_len);
+    return zv && Z_TYPE_P(zv) == IS_STRING ? Z_STR_P(zv) : NULL;
+}
+
+/* The sessions of `host`:`port`, opened now unless another entry already did */
+static bool qp_lg_origin(qp_lg_t *lg, qp_lg_mix_t *m, zend_string *host, zend_long port)
+{
+    for (uint32_t i = 0; i < lg->nconns; i += (uint32_t)lg->connections) {
+        if (lg->conns[i].port == port && zend_string_equals(lg->conns[i].host, host)) {
+            m->first_conn = i;
+            m->conns = (uint32_t)lg->connections;
+            return true;
+        }
+    }
+    m->first_conn = lg->nconns;
+    m->conns = (uint32_t)lg->connections;
+    lg->conns = safe_erealloc(lg->conns, lg->nconns + (size_t)lg->connections, sizeof(*lg->conns), 0);
+    for (zend_long c = 0; c < lg->connections; c++) {
+        qp_lg_conn_t *conn = &lg->conns[lg->nconns];
+        memset(conn, 0, sizeof(*conn));
+        zend_hash_init(&conn->pending, 64, NULL, NULL, 0);
+        conn->host = zend_string_copy(host);
+        conn->port = port;
+        lg->nconns++;
+        conn->s = quicpro_client_session_open(ZSTR_VAL(host), ZSTR_LEN(host), port, lg->cfg, -1, NULL);
+        if (!conn->s) {
+            return false;
+        }
+        conn->res = zend_register_resource(conn->s, le_quicpro_session);
+        conn->s->resource = conn->res;
+    }
+    return true;
+}
+
+static bool qp_lg_mix_entry(qp_lg_t *lg, qp_lg_mix_t *m, HashTable *e)
+{
+    zend_string *protocol = qp_lg_option_string(e, "protocol", sizeof("protocol") - 1);
+    m->protocol = -1;
+    for (int p = 0; protocol && p < QP_LG_PROTOCOLS; p++) {
+        if (zend_string_equals_cstr(protocol, qp_lg_protocols[p], strlen(qp_lg_protocols[p]))) {
+            m->protocol = p;
+        }
+    }
+    if (protocol && zend_string_equals_literal(protocol, "ws")) {
+        zend_argument_value_error(1, "\"mix\" protocol \"ws\" is not supported: the client has no WebSocket connector");
+        return false;
+    }
+    if (m->protocol < 0) {
+        zend_argument_value_error(1, "\"mix\" entries need a \"protocol\" of \"h1\", \"h2\", \"h3\" or \"mcp\"");
+        return false;
+    }
+    m->weight = qp_lg_option_long(e, "weight", sizeof("weight") - 1, 1);
+    if (m->weight <= 0) {
+        zend_argument_value_error(1, "\"mix\" entry \"weight\" must be greater than 0");
+        return false;
+    }
+    zval *headers = zend_hash_str_find(e, "headers", sizeof("headers") - 1);
+    zend_string *body = qp_lg_option_string(e, "body", sizeof("body") - 1);
+    zend_string *method = qp_lg_option_string(e, "method", sizeof("method") - 1);
+
+    if (m->protocol == QP_LG_H1 || m->protocol == QP_LG_H2) {
+        zend_string *url = qp_lg_option_string(e, "url", sizeof("url") - 1);
+        zval *options = zend_hash_str_find(e, "options", sizeof("options") - 1);
+        if (!url) {
+            zend_argument_value_error(1, "\"mix\" entries for \"h1\" and \"h2\" need a string \"url\"");
+            return false;
+        }
+        m->url = zend_string_copy(url);
+        m->method = method ? zend_string_copy(method) : zend_string_init("GET", 3, 0);
+        m->body = body ? zend_string_copy(body) : NULL;
+        if (headers && Z_TYPE_P(headers) == IS_ARRAY) {
+            ZVAL_COPY(&m->headers, headers);
+        }
+        if (options && Z_TYPE_P(options) == IS_ARRAY) {
+            ZVAL_ARR(&m->options, zend_array_dup(Z_ARRVAL_P(options)));
+        } else {
+            array_init(&m->options);
+        }
+        add_assoc_string(&m->options, "http_version", m->protocol == QP_LG_H1 ? "1.1" : "2.0");
+        lg->http = true;
+        return true;
+    }
+
+    zend_string *host = qp_lg_option_string(e, "host", sizeof("host") - 1);
+    zend_long port = qp_lg_option_long(e, "port", sizeof("port") - 1, 0);
+    if (!host || port <= 0 || port > 65535) {
+        zend_argument_value_error(1, "\"mix\" entries for \"h3\" and \"mcp\" need a string \"host\" and an int \"port\"");
+        return false;
+    }
+    array_init(&m->spec);
+    if (m->protocol == QP_LG_MCP) {
+        zend_string *service = qp_lg_option_string(e, "service", sizeof("service") - 1);
+        if (!service || !method) {
+            zend_argument_value_error(1, "\"mix\" entries for \"mcp\" need a string \"service\" and \"method\"");
+            return false;
+        }
+        zval mcp_headers;
+        add_assoc_string(&m->spec, "method", "POST");
+        add_assoc_str(&m->spec, "path", zend_strpprintf(0, "/%s/%s", ZSTR_VAL(service), ZSTR_VAL(method)));
+        if (headers && Z_TYPE_P(headers) == IS_ARRAY) {
+            ZVAL_ARR(&mcp_headers, zend_array_dup(Z_ARRVAL_P(headers)));
+        } else {
+            array_init(&mcp_headers);
+        }
+        add_assoc_string(&mcp_headers, "content-type", "application/vnd.quicpro.proto");
+        add_assoc_zval(&m->spec, "headers", &mcp_headers);
+    } else {
+        zend_string *path = qp_lg_option_string(e, "path", sizeof("path") - 1);
+        add_assoc_str(&m->spec, "method", method ? zend_string_copy(method) : zend_string_init("GET", 3, 0));
+        add_assoc_str(&m->spec, "path", path ? zend_string_copy(path) : zend_string_init("/", 1, 0));
+        if (headers && Z_TYPE_P(headers) == IS_ARRAY) {
+            Z_ADDREF_P(headers);
+            add_assoc_zval(&m->spec, "headers", headers);
+        }
+    }
+    if (body) {
+        add_assoc_str(&m->spec, "body", zend_string_copy(body));
+    }
+    return qp_lg_origin(lg, m, host, port);
+}
+
+static bool qp_lg_setup(qp_lg_t *lg, HashTable *opts)
+{
+    lg->rate = qp_lg_option_long(opts, "rate", sizeof("rate") - 1, 0);
+    lg->duration_ms = qp_lg_option_long(opts, "duration_ms", sizeof("duration_ms") - 1, 10000);
+    lg->timeout_ms = qp_lg_option_long(opts, "timeout_ms", sizeof("timeout_ms") - 1, 5000);
+    lg->max_in_flight = qp_lg_option_long(opts, "max_in_flight", sizeof("max_in_flight") - 1, 10000);
+    lg->connections = qp_lg_option_long(opts, "connections", sizeof("connections") - 1, 1);
+    zend_hash_init(&lg->http_pending, 64, NULL, NULL, 0);
+
+    if (lg->rate <= 0 || lg->rate > 100000000) {
+        zend_argument_value_error(1, "\"rate\" must be between 1 and 100000000 requests per second");
+        return false;
+    }
+    if (lg->duration_ms <= 0 || lg->timeout_ms < 0 || lg->max_in_flight <= 0) {
+        zend_argument_value_error(1, "\"duration_ms\" and \"max_in_flight\" must be greater than 0, \"timeout_ms\" not negative");
+        return false;
+    }
+    if (lg->connections <= 0 || lg->connections > QP_LG_MAX_CONNECTIONS) {
+        zend_argument_value_error(1, "\"connections\" must be between 1 and %d", QP_LG_MAX_CONNECTIONS);
+        return false;
+    }
+    zval *mix = zend_hash_str_find(opts, "mix", sizeof("mix") - 1);
+    if (!mix || Z_TYPE_P(mix) != IS_ARRAY || zend_hash_num_elements(Z_ARRVAL_P(mix)) == 0) {
+        zend_argument_value_error(1, "\"mix\" must be a non-empty array of request kinds");
+        return false;
+    }
+
+    zval *zcfg = zend_hash_str_find(opts, "connection_config", sizeof("connection_config") - 1);
+    if (zcfg && Z_TYPE_P(zcfg) == IS_RESOURCE) {
+        lg->cfg = (quicpro_cfg_t *)zend_fetch_resource_ex(zcfg, "Quicpro\\Config", le_quicpro_cfg);
+        if (!lg->cfg || !lg->cfg->quiche_cfg) {
+            throw_config_exception(0, "Invalid or uninitialized Quicpro\\Config resource provided.");
+            return false;
+        }
+    }
+
+    zval *entry;
+    lg->mix = ecalloc(zend_hash_num_elements(Z_ARRVAL_P(mix)), sizeof(*lg->mix));
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(mix), entry) {
+        qp_lg_mix_t *m = &lg->mix[lg->nmix++];
+        ZVAL_UNDEF(&m->headers);
+        ZVAL_UNDEF(&m->options);
+        ZVAL_UNDEF(&m->spec);
+        if (Z_TYPE_P(entry) != IS_ARRAY) {
+            zend_argument_value_error(1, "\"mix\" must contain only arrays");
+            return false;
+        }
+        /* A QUIC origin needs its Config before the entry opens its sessions */
+        if (!lg->cfg && zend_hash_str_exists(Z_ARRVAL_P(entry), "host", sizeof("host") - 1)) {
+            lg->cfg_res = quicpro_config_default();
+            if (!lg->cfg_res) {
+                return false;
+            }
+            GC_ADDREF(lg->cfg_res);
+            lg->cfg = (quicpro_cfg_t *)lg->cfg_res->ptr;
+        }
+        if (!qp_lg_mix_entry(lg, m, Z_ARRVAL_P(entry))) {
+            return false;
+        }
+        lg->total_weight += m->weight;
+    } ZEND_HASH_FOREACH_END();
+
+    if (lg->http && quicpro_http_pending() > 0) {
+        zend_throw_error(NULL, "quicpro_loadgen_run() cannot run while quicpro_http_batch_submit() requests are pending");
+        return false;
+    }
+    lg->pfds = lg->nconns ? safe_emalloc(lg->nconns, sizeof(*lg->pfds), 0) : NULL;
+    lg->stats = ecalloc(QP_LG_PROTOCOLS + 1, sizeof(*lg->stats));
+    return true;
+}
+
+static void qp_lg_free(qp_lg_t *lg)
+{
+    for (uint32_t i = 0; i < lg->nmix; i++) {
+        qp_lg_mix_t *m = &lg->mix[i];
+        if (m->url) zend_string_release(m->url);
+        if (m->method) zend_string_release(m->method);
+        if (m->body) zend_string_release(m->body);
+        zval_ptr_dtor(&m->headers);
+        zval_ptr_dtor(&m->options);
+        zval_ptr_dtor(&m->spec);
+    }
+    for (uint32_t i = 0; i < lg->nconns; i++) {
+        qp_lg_conn_t *conn = &lg->conns[i];
+        if (conn->res) {
+            zend_list_delete(conn->res);    /* Closes the session */
+        }
+        zend_string_release(conn->host);
+        zend_hash_destroy(&conn->pending);
+    }
+    /* Transfers still running are left to finish; their completions are dropped */
+    uint64_t id;
+    long status;
+    while (zend_hash_num_elements(&lg->http_pending) && quicpro_http_take(&id, &status)) {
+        zend_hash_index_del(&lg->http_pending, (zend_ulong)id);
+    }
+    zend_hash_destroy(&lg->http_pending);
+    if (lg->cfg_res) {
+        zend_list_delete(lg->cfg_res);
+    }
+    if (lg->mix) efree(lg->mix);
+    if (lg->conns) efree(lg->conns);
+    if (lg->pfds) efree(lg->pfds);
+    if (lg->stats) efree(lg->stats);
+}
+
+/*──────────────────────────── Loop ───────────────────────────────────────*/
+
+static bool qp_lg_conn_down(const qp_lg_conn_t *conn)
+{
+    return conn->s->is_closed || !conn->s->conn || quiche_conn_is_closed(conn->s->conn);
+}
+
+/*
+ * Sleeps until a socket has input, a QUIC timer fires or `until_us`
+ * passes. Under a millisecond to go, it only looks: the request due then
+ * must not leave late.
+ */
+static bool qp_lg_wait(qp_lg_t *lg, uint64_t until_us)
+{
+    uint64_t now = qp_lg_now_us();
+    int64_t timeout_ms = until_us > now ? (int64_t)((until_us - now) / 1000) : 0;
+    for (uint32_t i = 0; i < lg->nconns; i++) {
+        qp_lg_conn_t *conn = &lg->conns[i];
+        lg->pfds[i] = (struct pollfd){ .fd = qp_lg_conn_down(conn) ? -1 : conn->s->sock, .events = POLLIN };
+        int64_t quic_deadline = lg->pfds[i].fd >= 0 ? (int64_t)quiche_conn_timeout_as_millis(conn->s->conn) : -1;
+        if (quic_deadline >= 0 && quic_deadline < timeout_ms) {
+            timeout_ms = quic_deadline;
+        }
+    }
+    return quicpro_http_poll(lg->pfds, lg->nconns, (int)MIN(timeout_ms, INT_MAX));
+}
+
+/* Every session's handshake, before the clock starts */
+static bool qp_lg_connect(qp_lg_t *lg)
+{
+    uint64_t deadline = qp_lg_now_us() + (uint64_t)MAX(lg->timeout_ms, 1000) * 1000;
+    for (;;) {
+        uint32_t ready = 0;
+        for (uint32_t i = 0; i < lg->nconns; i++) {
+            qp_lg_conn_t *conn = &lg->conns[i];
+            quicpro_h3_mux_step(conn->s);
+            if (qp_lg_conn_down(conn)) {
+                throw_network_exception(0, "quicpro_loadgen_run(): the connection to %s:" ZEND_LONG_FMT " failed",
+                                        ZSTR_VAL(conn->host), conn->port);
+                return false;
+            }
+            ready += quiche_conn_is_established(conn->s->conn);
+        }
+        if (ready == lg->nconns) {
+            return true;
+        }
+        if (qp_lg_now_us() >= deadline) {
+            throw_network_exception(0, "quicpro_loadgen_run(): the QUIC handshakes did not complete in time");
+            return false;
+        }
+        if (!qp_lg_wait(lg, deadline)) {
+            return false;
+        }
+    }
+}
+
+static qp_lg_mix_t *qp_lg_pick(qp_lg_t *lg)
+{
+    qp_lg_mix_t *best = NULL;
+    for (uint32_t i = 0; i < lg->nmix; i++) {
+        qp_lg_mix_t *m = &lg->mix[i];
+        m->current += m->weight;
+        if (!best || m->current > best->current) {
+            best = m;
+        }
+    }
+    best->current -= lg->total_weight;
+    return best;
+}
+
+static bool qp_lg_send(qp_lg_t *lg, uint64_t due_us)
+{
+    qp_lg_mix_t *m = qp_lg_pick(lg);
+    zval tag;
+    ZVAL_LONG(&tag, (zend_long)((due_us - lg->start_us) << 2 | (uint64_t)m->protocol));
+
+    if (m->protocol == QP_LG_H1 || m->protocol == QP_LG_H2) {
+        uint64_t id = quicpro_http_submit(ZSTR_VAL(m->url), ZSTR_VAL(m->method),
+                                          Z_TYPE(m->headers) == IS_ARRAY ? &m->headers : NULL, m->body, &m->options);
+        if (!id) {
+            return false;
+        }
+        zend_hash_index_add_new(&lg->http_pending, (zend_ulong)id, &tag);
+    } else {
+        qp_lg_conn_t *conn = &lg->conns[m->first_conn + m->next_conn++ % m->conns];
+        uint64_t id;
+        if (!quicpro_h3_mux_submit_request(conn->s, Z_ARRVAL(m->spec), &id)) {
+            return false;
+        }
+        zend_hash_index_add_new(&conn->pending, (zend_ulong)id, &tag);
+    }
+    lg->stats[m->protocol].sent++;
+    lg->stats[QP_LG_PROTOCOLS].sent++;
+    lg->in_flight++;
+    return true;
+}
+
+/* A transport failure or a 5xx counts as an error; its latency counts all the same */
+static void qp_lg_complete(qp_lg_t *lg, zval *tag, bool failed, uint64_t now)
+{
+    uint64_t v = (uint64_t)Z_LVAL_P(tag);
+    uint64_t due = lg->start_us + (v >> 2);
+    uint64_t latency = now > due ? now - due : 0;
+    qp_lg_stats_t *by_protocol = &lg->stats[v & 3], *total = &lg->stats[QP_LG_PROTOCOLS];
+
+    qp_lg_stats_add(by_protocol, latency, 1);
+    qp_lg_stats_add(total, latency, 1);
+    if (failed) {
+        by_protocol->errors++;
+        total->errors++;
+    }
+    lg->in_flight--;
+}
+
+static bool qp_lg_collect(qp_lg_t *lg)
+{
+    uint64_t now = qp_lg_now_us();
+    for (uint32_t i = 0; i < lg->nconns; i++) {
+        qp_lg_conn_t *conn = &lg->conns[i];
+        quicpro_h3_mux_step(conn->s);
+
+        uint64_t id;
+        zend_long status;
+        zend_string *body, *error;
+        while (quicpro_h3_mux_take(conn->s, &id, &status, &body, &error, NULL)) {
+            zval *tag = zend_hash_index_find(&conn->pending, (zend_ulong)id);
+            if (tag) {
+                qp_lg_complete(lg, tag, error || status >= 500, now);
+                zend_hash_index_del(&conn->pending, (zend_ulong)id);
+            }
+            if (body) {
+                zend_string_release(body);
+            }
+            if (error) {
+                zend_string_release(error);
+            }
+        }
+    }
+    if (lg->http) {
+        if (!quicpro_http_step()) {
+            return false;
+        }
+        uint64_t id;
+        long status;
+        while (quicpro_http_take(&id, &status)) {
+            zval *tag = zend_hash_index_find(&lg->http_pending, (zend_ulong)id);
+            if (tag) {
+                qp_lg_complete(lg, tag, status == 0 || status >= 500, now);
+                zend_hash_index_del(&lg->http_pending, (zend_ulong)id);
+            }
+        }
+    }
+    return true;
+}
+
+static void qp_lg_count_timeouts(qp_lg_t *lg, HashTable *pending)
+{
+    zval *tag;
+    ZEND_HASH_FOREACH_VAL(pending, tag) {
+        lg->stats[Z_LVAL_P(tag) & 3].timeouts++;
+        lg->stats[QP_LG_PROTOCOLS].timeouts++;
+    } ZEND_HASH_FOREACH_END();
+}
+
+static bool qp_lg_run(qp_lg_t *lg, uint64_t *elapsed_us)
+{
+    uint64_t rate = (uint64_t)lg->rate;
+    uint64_t total = MAX((uint64_t)lg->duration_ms * rate / 1000, 1);
+    uint64_t end = 0, sent = 0;
+
+    lg->start_us = qp_lg_now_us();
+    end = lg->start_us + (uint64_t)lg->duration_ms * 1000;
+    for (;;) {
+        uint64_t now = qp_lg_now_us();
+        uint64_t due = MIN(total, (now - lg->start_us) * rate / 1000000 + 1);
+        while (sent < due && lg->in_flight < (uint64_t)lg->max_in_flight) {
+            uint64_t due_us = lg->start_us + sent * 1000000 / rate;
+            if (now - due_us > QP_LG_LATE_US) {
+                lg->stats[QP_LG_PROTOCOLS].late++;
+            }
+            if (!qp_lg_send(lg, due_us)) {
+                return false;
+            }
+            sent++;
+        }
+        if (!qp_lg_collect(lg)) {
+            return false;
+        }
+        now = qp_lg_now_us();
+        *elapsed_us = now - lg->start_us;
+        if (sent == total && lg->in_flight == 0) {
+            return true;
+        }
+        uint64_t give_up = MAX(end, lg->start_us + (total - 1) * 1000000 / rate) + (uint64_t)lg->timeout_ms * 1000;
+        if (now >= give_up) {
+            for (uint32_t i = 0; i < lg->nconns; i++) {
+                qp_lg_count_timeouts(lg, &lg->conns[i].pending);
+            }
+            qp_lg_count_timeouts(lg, &lg->http_pending);
+            return true;
+        }
+        uint64_t next = sent < total && lg->in_flight < (uint64_t)lg->max_in_flight
+            ? lg->start_us + sent * 1000000 / rate : give_up;
+        if (!qp_lg_wait(lg, next)) {
+            return false;
+        }
+    }
+}
+
+/*──────────────────────────── PHP API ────────────────────────────────────*/
+
+/* The summary of `total` and the per-protocol stats as a result array */
+static void qp_lg_result(const qp_lg_stats_t *stats, bool *used, zend_long rate, uint64_t elapsed_us, zval *return_value)
+{
+    const qp_lg_stats_t *total = &stats[QP_LG_PROTOCOLS];
+    zval protocols;
+
+    qp_lg_stats_to_array(total, return_value);
+    add_assoc_long(return_value, "late", (zend_long)total->late);
+    add_assoc_long(return_value, "rate", rate);
+    add_assoc_double(return_value, "elapsed_ms", (double)elapsed_us / 1000.0);
+    add_assoc_double(return_value, "throughput", elapsed_us ? (double)total->completed * 1e6 / (double)elapsed_us : 0.0);
+
+    array_init(&protocols);
+    for (int p = 0; p < QP_LG_PROTOCOLS; p++) {
+        if (used[p]) {
+            zval entry;
+            qp_lg_stats_to_array(&stats[p], &entry);
+            add_assoc_zval(&protocols, qp_lg_protocols[p], &entry);
+        }
+    }
+    add_assoc_zval(return_value, "protocols", &protocols);
+}
+
+/* {{{ quicpro_loadgen_run(array $options): array
+ *
+ * Sends `rate` requests per second for `duration_ms`, drawn from `mix` by
+ * weight, and waits up to `timeout_ms` more for their responses. See
+ * include/client/loadgen.h.
+ */
+PHP_FUNCTION(quicpro_loadgen_run)
+{
+    HashTable *opts;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT(opts)
+    ZEND_PARSE_PARAMETERS_END();
+
+    qp_lg_t lg = {0};
+    uint64_t elapsed_us = 0;
+    if (!qp_lg_setup(&lg, opts) || !qp_lg_connect(&lg) || !qp_lg_run(&lg, &elapsed_us)) {
+        qp_lg_free(&lg);
+        RETURN_THROWS();
+    }
+    bool used[QP_LG_PROTOCOLS] = {0};
+    for (uint32_t i = 0; i < lg.nmix; i++) {
+        used[lg.mix[i].protocol] = true;
+    }
+    qp_lg_result(lg.stats, used, lg.rate, elapsed_us, return_value);
+    qp_lg_free(&lg);
+}
+/* }}} */
+
+/* {{{ quicpro_loadgen_merge(array $results): array
+ *
+ * Combines the results of runs that loaded the same target at the same
+ * time, e.g. one per Quicpro\Cluster worker: counts and rates add up,
+ * latencies are recomputed from the merged histograms.
+ */
+PHP_FUNCTION(quicpro_loadgen_merge)
+{
+    HashTable *results;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT(results)
+    ZEND_PARSE_PARAMETERS_END();
+
+    qp_lg_stats_t *stats = ecalloc(QP_LG_PROTOCOLS + 1, sizeof(*stats));
+    bool used[QP_LG_PROTOCOLS] = {0};
+    zend_long rate = 0;
+    double elapsed_ms = 0;
+    zval *result;
+
+    ZEND_HASH_FOREACH_VAL(results, result) {
+        if (Z_TYPE_P(result) != IS_ARRAY) {
+            efree(stats);
+            zend_argument_value_error(1, "must contain only results of quicpro_loadgen_run()");
+            RETURN_THROWS();
+        }
+        HashTable *ht = Z_ARRVAL_P(result);
+        qp_lg_stats_merge(&stats[QP_LG_PROTOCOLS], ht);
+        rate += qp_lg_array_long(ht, "rate", sizeof("rate") - 1);
+        zval *elapsed = zend_hash_str_find(ht, "elapsed_ms", sizeof("elapsed_ms") - 1);
+        elapsed_ms = MAX(elapsed_ms, elapsed ? zval_get_double(elapsed) : 0.0);
+
+        zval *protocols = zend_hash_str_find(ht, "protocols", sizeof("protocols") - 1);
+        for (int p = 0; protocols && Z_TYPE_P(protocols) == IS_ARRAY && p < QP_LG_PROTOCOLS; p++) {
+            zval *entry = zend_hash_str_find(Z_ARRVAL_P(protocols), qp_lg_protocols[p], strlen(qp_lg_protocols[p]));
+            if (entry && Z_TYPE_P(entry) == IS_ARRAY) {
+                qp_lg_stats_merge(&stats[p], Z_ARRVAL_P(entry));
+                used[p] = true;
+            }
+        }
+    } ZEND_HASH_FOREACH_END();
+
+    qp_lg_result(stats, used, rate, (uint64_t)(elapsed_ms * 1000.0), return_value);
+    efree(stats);
+}
+/* }}} */
@@ -0,0 +1,440 @@
+/*
+ * src/client/multipath.c – Extra network paths for client sessions
+ * ================================================================
+ *
+ * See include/client/multipath.h. quiche keeps a path's recovery state,
+ * RTT included, from the packets it sends on it; a standby path carries
+ * nothing but probes, so it is probed again every
+ * MP_STANDBY_PROBE_MS to keep its RTT worth comparing.
+ */
+
+#include "php_quicpro.h"
+#include "client/multipath.h"
+#include "config/quic_transport/base_layer.h"
+#include "poll/udp_batch.h"
+#include "poll/busy_poll.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <openssl/rand.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+extern int le_quicpro_session;
+
+#define MP_STANDBY_PROBE_MS   5000
+#define MP_STALL_MIN_MS       300     /* Silence on the active path before it counts as dead */
+
+static uint64_t mp_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static bool mp_addr_eq(const struct sockaddr_storage *a, const struct sockaddr_storage *b)
+{
+    if (a->ss_family != b->ss_family) {
+        return false;
+    }
+    if (a->ss_family == AF_INET) {
+        const struct sockaddr_in *x = (const struct sockaddr_in *)a, *y = (const struct sockaddr_in *)b;
+        return x->sin_port == y->sin_port && x->sin_addr.s_addr == y->sin_addr.s_addr;
+    }
+    if (a->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *x = (const struct sockaddr_in6 *)a, *y = (const struct sockaddr_in6 *)b;
+        return x->sin6_port == y->sin6_port && memcmp(&x->sin6_addr, &y->sin6_addr, sizeof(x->sin6_addr)) == 0;
+    }
+    return false;
+}
+
+static int mp_find(const quicpro_mp_t *mp, const struct sockaddr_storage *local)
+{
+    for (unsigned i = 0; i < mp->count; i++) {
+        if (mp_addr_eq(&mp->paths[i].local, local)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/* "ip:port", "[ip6]:port", or "" for anything else */
+static zend_string *mp_addr_str(const struct sockaddr_storage *ss)
+{
+    char host[INET6_ADDRSTRLEN], out[INET6_ADDRSTRLEN + 8];
+    int n = 0;
+    if (ss->ss_family == AF_INET) {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)ss;
+        inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+        n = snprintf(out, sizeof(out), "%s:%u", host, ntohs(in->sin_port));
+    } else if (ss->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)ss;
+        inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+        n = snprintf(out, sizeof(out), "[%s]:%u", host, ntohs(in6->sin6_port));
+    }
+    return zend_string_init(out, n > 0 ? (size_t)n : 0, 0);
+}
+
+/* The handshake's path becomes path 0, under the local address quiche has for it */
+static quicpro_mp_t *mp_table(quicpro_session_t *s)
+{
+    if (s->mp) {
+        return s->mp;
+    }
+    quicpro_mp_t *mp = ecalloc(1, sizeof(*mp));
+    quicpro_mp_path_t *p0 = &mp->paths[0];
+    quiche_path_stats ps;
+
+    p0->fd = s->sock;
+    p0->weight = 1;
+    p0->state = QUICPRO_MP_VALIDATED;
+    for (size_t idx = 0; quiche_conn_path_stats(s->conn, idx, &ps) == 0; idx++) {
+        if (ps.active) {
+            memcpy(&p0->local, &ps.local_addr, ps.local_addr_len);
+            p0->local_len = ps.local_addr_len;
+            break;
+        }
+    }
+    p0->recv_ms = mp_now_ms();
+    mp->count = 1;
+    s->mp = mp;
+    return mp;
+}
+
+/*──── Paths ────*/
+
+int quicpro_mp_add_path(quicpro_session_t *s, const char *iface, uint32_t weight)
+{
+    if (quiche_conn_is_server(s->conn) || s->sock < 0) {
+        throw_quic_exception(0, "Only client sessions can add paths");
+        return -1;
+    }
+    if (!quiche_conn_is_established(s->conn)) {
+        throw_quic_exception(0, "A path can only be added once the handshake has completed");
+        return -1;
+    }
+    quicpro_mp_t *mp = mp_table(s);
+    if (mp->count > QUICPRO_MP_MAX_PATHS) {
+        throw_quic_exception(0, "A session has at most %d extra paths", QUICPRO_MP_MAX_PATHS);
+        return -1;
+    }
+    if (quiche_conn_available_dcids(s->conn) == 0) {
+        throw_quic_exception(0, "The server has issued no spare connection ID; it cannot be reached over a second path");
+        return -1;
+    }
+
+    int fd = socket(s->peer_addr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw_network_exception(errno, "Failed to create a UDP socket for interface '%s': %s", iface, strerror(errno));
+        return -1;
+    }
+    if (quicpro_socket_bind_iface(fd, iface) < 0) {
+        close(fd);
+        return -1;
+    }
+    quicpro_udp_socket_pmtud(fd);
+    quicpro_udp_socket_ecn(fd);
+    quicpro_busy_poll_socket(fd);
+
+    quicpro_mp_path_t *p = &mp->paths[mp->count];
+    memset(p, 0, sizeof(*p));
+    p->local_len = sizeof(p->local);
+    if (connect(fd, (const struct sockaddr *)&s->peer_addr, s->peer_addr_len) < 0
+        || getsockname(fd, (struct sockaddr *)&p->local, &p->local_len) < 0) {
+        int err = errno;
+        close(fd);
+        throw_network_exception(err, "No route to the server over interface '%s': %s", iface, strerror(err));
+        return -1;
+    }
+
+    /* The server answers the probe under a connection ID of ours it has not seen yet */
+    if (quiche_conn_scids_left(s->conn) > 0) {
+        uint8_t scid[QUICPRO_SCID_LEN], token[16];
+        uint64_t scid_seq;
+        RAND_bytes(scid, sizeof(scid));
+        RAND_bytes(token, sizeof(token));
+        (void)quiche_conn_new_scid(s->conn, scid, sizeof(scid), token, false, &scid_seq);
+    }
+
+    uint64_t seq;
+    int rc = quiche_conn_probe_path(s->conn, (struct sockaddr *)&p->local, p->local_len,
+                                    (struct sockaddr *)&s->peer_addr, s->peer_addr_len, &seq);
+    if (rc < 0) {
+        close(fd);
+        throw_quic_exception(rc, "Failed to probe the path over interface '%s': %s", iface, quiche_error_t_to_string(rc));
+        return -1;
+    }
+
+    p->fd = fd;
+    snprintf(p->iface, sizeof(p->iface), "%s", iface);
+    p->weight = weight;
+    p->state = QUICPRO_MP_PROBING;
+    p->probed_ms = p->recv_ms = mp_now_ms();
+
+    int index = (int)mp->count++;
+    quicpro_mp_flush(s);    /* The PATH_CHALLENGE leaves now, not at the next tick */
+    return index;
+}
+
+void quicpro_mp_free(quicpro_mp_t *mp)
+{
+    if (!mp) {
+        return;
+    }
+    for (unsigned i = 1; i < mp->count; i++) {
+        if (mp->paths[i].fd >= 0) {
+            close(mp->paths[i].fd);
+        }
+    }
+    efree(mp);
+}
+
+/*──── I/O ────*/
+
+static void mp_events(quicpro_session_t *s, quicpro_mp_t *mp)
+{
+    quiche_path_event *ev;
+
+    while ((ev = quiche_conn_path_event_next(s->conn)) != NULL) {
+        struct sockaddr_storage local, peer;
+        socklen_t local_len = sizeof(local);
+        socklen_t peer_len = sizeof(peer);
+        int i = -1;
+        uint8_t state = QUICPRO_MP_PROBING;
+
+        switch (quiche_path_event_type(ev)) {
+            case QUICHE_PATH_EVENT_VALIDATED:
+                quiche_path_event_validated(ev, &local, &local_len, &peer, &peer_len);
+                i = mp_find(mp, &local);
+                state = QUICPRO_MP_VALIDATED;
+                break;
+
+            case QUICHE_PATH_EVENT_FAILED_VALIDATION:
+                quiche_path_event_failed_validation(ev, &local, &local_len, &peer, &peer_len);
+                i = mp_find(mp, &local);
+                state = QUICPRO_MP_FAILED;
+                break;
+
+            case QUICHE_PATH_EVENT_CLOSED:
+                quiche_path_event_closed(ev, &local, &local_len, &peer, &peer_len);
+                i = mp_find(mp, &local);
+                state = QUICPRO_MP_FAILED;
+                break;
+
+            default:
+                break;
+        }
+        if (i >= 0) {
+            mp->paths[i].state = state;
+        }
+        quiche_path_event_free(ev);
+    }
+}
+
+/*
+ * Moves the connection to the best validated path: at once when the
+ * active one has gone silent while data was outstanding, otherwise when
+ * another scores clearly better and the last move has settled.
+ */
+static void mp_schedule(quicpro_session_t *s, quicpro_mp_t *mp)
+{
+    uint64_t now = mp_now_ms();
+    uint64_t active_score = 0, best_score = UINT64_MAX;
+    int active = -1, best = -1;
+    bool stalled = false;
+    quiche_path_stats ps;
+
+    for (size_t idx = 0; quiche_conn_path_stats(s->conn, idx, &ps) == 0; idx++) {
+        int i = mp_find(mp, &ps.local_addr);
+        if (i < 0) {
+            continue;
+        }
+        quicpro_mp_path_t *w = &mp->paths[i];
+        uint64_t rtt_ms = ps.rtt / 1000000;
+        if (ps.recv > w->recv) {
+            w->recv = ps.recv;
+            w->recv_ms = now;
+            w->sent_at_recv = ps.sent;
+        }
+
+        /* min RTT over weight, in µs; +1 so an unmeasured path never scores 0 */
+        uint64_t score = ((ps.min_rtt ? ps.min_rtt : ps.rtt) / 1000 + 1) * QUICPRO_MP_WEIGHT_MAX / w->weight;
+        if (ps.active) {
+            active = i;
+            active_score = score;
+            stalled = ps.sent > w->sent_at_recv && now - w->recv_ms > MAX(3 * rtt_ms, MP_STALL_MIN_MS);
+            continue;
+        }
+        if (w->state != QUICPRO_MP_VALIDATED) {
+            continue;
+        }
+        if (now - w->probed_ms >= MP_STANDBY_PROBE_MS) {
+            uint64_t seq;
+            (void)quiche_conn_probe_path(s->conn, (struct sockaddr *)&ps.local_addr, ps.local_addr_len,
+                                         (struct sockaddr *)&ps.peer_addr, ps.peer_addr_len, &seq);
+            w->probed_ms = now;
+        }
+        if (score < best_score) {
+            best = i;
+            best_score = score;
+        }
+    }
+
+    if (best < 0 || active < 0) {
+        return;
+    }
+    bool better = best_score * 100 <= active_score * QUICPRO_MP_SWITCH_GAIN_PCT
+                  && now - mp->switched_ms >= QUICPRO_MP_SWITCH_HOLD_MS;
+    if (!stalled && !better) {
+        return;
+    }
+    uint64_t seq;
+    quicpro_mp_path_t *p = &mp->paths[best];
+    if (quiche_conn_migrate(s->conn, (struct sockaddr *)&p->local, p->local_len,
+                            (struct sockaddr *)&s->peer_addr, s->peer_addr_len, &seq) == 0) {
+        mp->switched_ms = now;
+        mp->switches++;
+        /* The new active path starts with a clean silence clock */
+        p->recv_ms = now;
+        p->sent_at_recv = 0;
+    }
+}
+
+void quicpro_mp_pump_rx(quicpro_session_t *s)
+{
+    static uint8_t buf[QUICPRO_UDP_PAYLOAD_MAX];
+    quicpro_mp_t *mp = s->mp;
+
+    for (unsigned i = 1; i < mp->count; i++) {
+        quicpro_mp_path_t *p = &mp->paths[i];
+        for (;;) {
+            struct sockaddr_storage from;
+            socklen_t from_len = sizeof(from);
+            ssize_t n = recvfrom(p->fd, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr *)&from, &from_len);
+            if (n < 0) {
+                break;  /* EAGAIN, or an ICMP error quiche learns about by loss */
+            }
+            quiche_recv_info ri = {
+                .from     = (struct sockaddr *)&from,
+                .from_len = from_len,
+                .to       = (struct sockaddr *)&p->local,
+                .to_len   = p->local_len,
+            };
+            (void)quiche_conn_recv(s->conn, buf, (size_t)n, &ri);
+        }
+    }
+    mp_events(s, mp);
+    mp_schedule(s, mp);
+}
+
+int quicpro_mp_flush(quicpro_session_t *s)
+{
+    static uint8_t out[QUICPRO_UDP_PAYLOAD_MAX];
+    quicpro_mp_t *mp = s->mp;
+    quiche_send_info si;
+    int sent = 0;
+
+    for (;;) {
+        ssize_t n = quiche_conn_send(s->conn, out, sizeof(out), &si);
+        if (n < 0) {
+            return n == QUICHE_ERR_DONE ? sent : (int)n;
+        }
+        int i = mp_find(mp, &si.from);
+        /* The sockets are connected: quiche's `to` is always the server */
+        if (send(i > 0 ? mp->paths[i].fd : s->sock, out, (size_t)n, 0) >= 0) {
+            sent++;
+        }
+    }
+}
+
+/*──── PHP ────*/
+
+static quicpro_session_t *mp_fetch_session(zval *z_sess)
+{
+    quicpro_session_t *s = (quicpro_session_t *)zend_fetch_resource_ex(z_sess, "Quicpro\\Session", le_quicpro_session);
+    if (!s) {
+        return NULL;
+    }
+    if (!s->conn || s->is_closed) {
+        throw_quic_exception(0, "Session is closed");
+        return NULL;
+    }
+    return s;
+}
+
+PHP_FUNCTION(quicpro_client_session_add_path)
+{
+    zval *z_sess;
+    zend_string *iface;
+    zend_long weight = 1;
+
+    ZEND_PARSE_PARAMETERS_START(2, 3)
+        Z_PARAM_RESOURCE(z_sess)
+        Z_PARAM_STR(iface)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(weight)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (ZSTR_LEN(iface) == 0 || ZSTR_LEN(iface) >= IF_NAMESIZE) {
+        zend_argument_value_error(2, "must be a network interface name");
+        RETURN_THROWS();
+    }
+    if (weight < 1 || weight > QUICPRO_MP_WEIGHT_MAX) {
+        zend_argument_value_error(3, "must be between 1 and %d", QUICPRO_MP_WEIGHT_MAX);
+        RETURN_THROWS();
+    }
+    quicpro_session_t *s = mp_fetch_session(z_sess);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    int index = quicpro_mp_add_path(s, ZSTR_VAL(iface), (uint32_t)weight);
+    if (index < 0) {
+        RETURN_THROWS();
+    }
+    RETURN_LONG(index);
+}
+
+PHP_FUNCTION(quicpro_client_session_paths)
+{
+    static const char *const states[] = { "probing", "validated", "failed" };
+    zval *z_sess;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_RESOURCE(z_sess)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = mp_fetch_session(z_sess);
+    if (!s) {
+        RETURN_THROWS();
+    }
+
+    array_init(return_value);
+    quiche_path_stats ps;
+    for (size_t idx = 0; quiche_conn_path_stats(s->conn, idx, &ps) == 0; idx++) {
+        int i = s->mp ? mp_find(s->mp, &ps.local_addr) : (ps.active ? 0 : -1);
+        if (i < 0) {
+            continue;   /* A path the server opened towards us, or an old one */
+        }
+        const quicpro_mp_path_t *p = s->mp ? &s->mp->paths[i] : NULL;
+
+        zval entry;
+        array_init(&entry);
+        add_assoc_long(&entry, "index", i);
+        add_assoc_string(&entry, "interface", p ? (char *)p->iface : "");
+        add_assoc_str(&entry, "local", mp_addr_str(&ps.local_addr));
+        add_assoc_string(&entry, "state", (char *)states[p ? p->state : QUICPRO_MP_VALIDATED]);
+        add_assoc_bool(&entry, "active", ps.active);
+        add_assoc_long(&entry, "weight", p ? (zend_long)p->weight : 1);
+        add_assoc_long(&entry, "rtt_us", (zend_long)(ps.rtt / 1000));
+        add_assoc_long(&entry, "min_rtt_us", (zend_long)(ps.min_rtt / 1000));
+        add_assoc_long(&entry, "cwnd", (zend_long)ps.cwnd);
+        add_assoc_long(&entry, "sent", (zend_long)ps.sent);
+        add_assoc_long(&entry, "recv", (zend_long)ps.recv);
+        add_assoc_long(&entry, "lost", (zend_long)ps.lost);
+        add_assoc_long(&entry, "delivery_rate", (zend_long)ps.delivery_rate);
+        add_next_index_zval(return_value, &entry);
+    }
+}
@@ -0,0 +1,650 @@
+#include "php_quicpro.h"
+#include "client/mux.h"
+#include "client/body.h"
+#include "client/cancel.h"
+#include "mcp/mcp.h"
+#include "poll/poll.h"
+#include "poll/scheduler.h"
+#include "server/profiler.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <quiche.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <zend_smart_str.h>
+
+/**
+ * @file extension/src/client/mux.c
+ * @brief Implementation of the per-session HTTP/3 request multiplexer.
+ *
+ * Every request lives in exactly one place at a time:
+ * - the send queue, until quiche grants it a stream;
+ * - `streams` (keyed by stream ID) while it is in flight;
+ * - the completion queue, once it finished or failed.
+ *
+ * Both queues are singly linked FIFOs through `next`, so submission and
+ * completion order are kept and nothing is ever scanned.
+ */
+
+extern int le_quicpro;           /* quicpro_connect() sessions */
+extern int le_quicpro_session;   /* quicpro_client_session_connect() sessions */
+
+typedef struct quicpro_h3_req_s {
+    uint64_t                  id;
+    int64_t                   stream_id;   /* -1 until opened */
+
+    /* Request: names and values alternate in `fields` */
+    zend_string             **fields;
+    uint32_t                  nfields;
+    zend_string              *body;        /* NULL: no body */
+    size_t                    body_off;
+
+    /* Response */
+    zend_long                 status;
+    zval                      headers;     /* array */
+    smart_str                 resp;
+    zend_string              *error;       /* NULL on success */
+
+    struct quicpro_h3_req_s  *next;
+} quicpro_h3_req_t;
+
+typedef struct {
+    quicpro_h3_req_t *head;
+    quicpro_h3_req_t *tail;
+} quicpro_h3_fifo_t;
+
+struct quicpro_h3_mux_s {
+    uint64_t           next_id;
+    uint32_t           pending;     /* Submitted, not yet handed back */
+    quicpro_h3_fifo_t  unsent;
+    quicpro_h3_fifo_t  done;
+    HashTable          streams;     /* stream ID → quicpro_h3_req_t *, not owning */
+    uint32_t           uploading;   /* In-flight requests with body left to send */
+};
+
+/*─────────────────────────── Queues and requests ─────────────────────────*/
+
+static void fifo_push(quicpro_h3_fifo_t *q, quicpro_h3_req_t *r) {
+    r->next = NULL;
+    if (q->tail) {
+        q->tail->next = r;
+    } else {
+        q->head = r;
+    }
+    q->tail = r;
+}
+
+static quicpro_h3_req_t *fifo_shift(quicpro_h3_fifo_t *q) {
+    quicpro_h3_req_t *r = q->head;
+    if (r) {
+        q->head = r->next;
+        if (!q->head) {
+            q->tail = NULL;
+        }
+    }
+    return r;
+}
+
+static void mux_req_free(quicpro_h3_req_t *r) {
+    for (uint32_t i = 0; i < r->nfields; i++) {
+        zend_string_release(r->fields[i]);
+    }
+    if (r->fields) {
+        efree(r->fields);
+    }
+    if (r->body) {
+        zend_string_release(r->body);
+    }
+    zval_ptr_dtor(&r->headers);
+    smart_str_free(&r->resp);
+    if (r->error) {
+        zend_string_release(r->error);
+    }
+    efree(r);
+}
+
+static quicpro_h3_mux_t *mux_get(quicpro_session_t *s) {
+    if (!s->mux) {
+        s->mux = ecalloc(1, sizeof(quicpro_h3_mux_t));
+        s->mux->next_id = 1;
+        zend_hash_init(&s->mux->streams, 16, NULL, NULL, 0);
+    }
+    return s->mux;
+}
+
+void quicpro_h3_mux_free(quicpro_h3_mux_t *mux) {
+    quicpro_h3_req_t *r;
+
+    if (!mux) {
+        return;
+    }
+    while ((r = fifo_shift(&mux->unsent))) {
+        mux_req_free(r);
+    }
+    while ((r = fifo_shift(&mux->done))) {
+        mux_req_free(r);
+    }
+    ZEND_HASH_FOREACH_PTR(&mux->streams, r) {
+        mux_req_free(r);
+    } ZEND_HASH_FOREACH_END();
+    zend_hash_destroy(&mux->streams);
+    efree(mux);
+}
+
+bool quicpro_h3_mux_idle(const quicpro_h3_mux_t *mux) {
+    return !mux || zend_hash_num_elements(&mux->streams) == 0;
+}
+
+/* Moves an in-flight request to the completion queue. */
+static void mux_complete(quicpro_h3_mux_t *mux, quicpro_h3_req_t *r, zend_string *error) {
+    if (r->body && r->body_off < ZSTR_LEN(r->body)) {
+        mux->uploading--;
+    }
+    r->error = error;
+    if (r->stream_id >= 0) {
+        zend_hash_index_del(&mux->streams, (zend_ulong)r->stream_id);
+    }
+    fifo_push(&mux->done, r);
+}
+
+/*───────────────────────────── Sending ───────────────────────────────────*/
+
+/* Pushes as much of the remaining body as flow control allows. */
+static int mux_send_body(quicpro_session_t *s, quicpro_h3_req_t *r) {
+    size_t left = ZSTR_LEN(r->body) - r->body_off;
+    ssize_t sent = quiche_h3_send_body(s->h3, s->conn, (uint64_t)r->stream_id,
+                                       (const uint8_t *)ZSTR_VAL(r->body) + r->body_off, left, true);
+    if (sent == QUICHE_H3_ERR_DONE) {
+        return 0;           /* Window full, retried on the next round */
+    }
+    if (sent < 0) {
+        return (int)sent;
+    }
+    r->body_off += (size_t)sent;
+    if (r->body_off == ZSTR_LEN(r->body)) {
+        s->mux->uploading--;
+    }
+    return 0;
+}
+
+/* Opens `r`'s stream. Returns 1 if sent, 0 if the peer's stream limit was hit, <0 on error. */
+static int mux_open(quicpro_session_t *s, quicpro_h3_req_t *r) {
+    quiche_h3_header hdrs[r->nfields / 2];
+    for (uint32_t i = 0; i < r->nfields / 2; i++) {
+        hdrs[i] = (quiche_h3_header){
+            (const uint8_t *)ZSTR_VAL(r->fields[2 * i]),     ZSTR_LEN(r->fields[2 * i]),
+            (const uint8_t *)ZSTR_VAL(r->fields[2 * i + 1]), ZSTR_LEN(r->fields[2 * i + 1]),
+        };
+    }
+
+    bool has_body = r->body && ZSTR_LEN(r->body) > 0;
+    int64_t stream_id = quiche_h3_send_request(s->h3, s->conn, hdrs, r->nfields / 2, !has_body);
+    if (stream_id == QUICHE_H3_ERR_STREAM_BLOCKED || stream_id == QUICHE_H3_TRANSPORT_ERR_STREAM_LIMIT) {
+        return 0;
+    }
+    if (stream_id < 0) {
+        return (int)stream_id;
+    }
+
+    r->stream_id = stream_id;
+    zend_hash_index_add_new_ptr(&s->mux->streams, (zend_ulong)stream_id, r);
+    if (has_body) {
+        s->mux->uploading++;
+        int rc = mux_send_body(s, r);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+    return 1;
+}
+
+/* Opens queued requests while streams are available and resumes pending uploads. */
+static void mux_progress(quicpro_session_t *s) {
+    quicpro_h3_mux_t *mux = s->mux;
+
+    if (!quiche_conn_is_established(s->conn) && !quiche_conn_is_in_early_data(s->conn)) {
+        return;
+    }
+
+    if (mux->uploading) {
+        quicpro_h3_req_t *r;
+        ZEND_HASH_FOREACH_PTR(&mux->streams, r) {
+            if (r->body && r->body_off < ZSTR_LEN(r->body)) {
+                int rc = mux_send_body(s, r);
+                if (rc < 0) {
+                    mux_complete(mux, r, strpprintf(0, "Failed to send request body (quiche error %d)", rc));
+                }
+            }
+        } ZEND_HASH_FOREACH_END();
+    }
+
+    while (mux->unsent.head) {
+        quicpro_h3_req_t *r = mux->unsent.head;
+        int rc = mux_open(s, r);
+        if (rc == 0) {
+            break;          /* Wait for the peer to grant more streams */
+        }
+        fifo_shift(&mux->unsent);
+        if (rc < 0) {
+            mux_complete(mux, r, strpprintf(0, "Failed to send request (quiche error %d)", rc));
+        }
+    }
+}
+
+/*──────────────────────────── Receiving ──────────────────────────────────*/
+
+static int mux_on_header(uint8_t *name, size_t name_len, uint8_t *value, size_t value_len, void *argp) {
+    quicpro_h3_req_t *r = argp;
+
+    if (name_len == 7 && memcmp(name, ":status", 7) == 0) {
+        char buf[8];
+        size_t n = MIN(value_len, sizeof(buf) - 1);
+        memcpy(buf, value, n);
+        buf[n] = '\0';
+        r->status = ZEND_STRTOL(buf, NULL, 10);
+        return 0;
+    }
+    if (name_len == 14 && memcmp(name, "content-length", 14) == 0) {
+        quicpro_body_reserve(&r->resp, quicpro_body_length(value, value_len));
+    }
+
+    /* A repeated field becomes a list of its values */
+    zval *prev = zend_hash_str_find(Z_ARRVAL(r->headers), (const char *)name, name_len);
+    if (!prev) {
+        add_assoc_stringl_ex(&r->headers, (const char *)name, name_len, (const char *)value, value_len);
+    } else {
+        if (Z_TYPE_P(prev) != IS_ARRAY) {
+            zval list;
+            array_init(&list);
+            add_next_index_zval(&list, prev);
+            ZVAL_COPY_VALUE(prev, &list);
+        }
+        add_next_index_stringl(prev, (const char *)value, value_len);
+    }
+    return 0;
+}
+
+bool quicpro_h3_mux_dispatch(quicpro_session_t *s, quiche_h3_event *ev, uint64_t stream_id) {
+    quicpro_h3_req_t *r;
+
+    if (!s->mux || !(r = zend_hash_index_find_ptr(&s->mux->streams, (zend_ulong)stream_id))) {
+        return false;
+    }
+
+    switch (quiche_h3_event_type(ev)) {
+        case QUICHE_H3_EVENT_HEADERS:
+            quiche_h3_event_for_each_header(ev, mux_on_header, r);
+            break;
+
+        case QUICHE_H3_EVENT_DATA: {
+            ssize_t n = quicpro_body_recv_h3(s->h3, s->conn, stream_id, &r->resp);
+            if (n < 0 && n != QUICHE_H3_ERR_DONE) {
+                mux_complete(s->mux, r, strpprintf(0, "Failed to receive response body (quiche error %d)", (int)n));
+            }
+            break;
+        }
+
+        case QUICHE_H3_EVENT_FINISHED:
+            mux_complete(s->mux, r, NULL);
+            break;
+
+        case QUICHE_H3_EVENT_RESET:
+            mux_complete(s->mux, r, zend_string_init("Stream reset by the server", sizeof("Stream reset by the server") - 1, 0));
+            break;
+
+        default:
+            break;
+    }
+
+    quiche_h3_event_free(ev);
+    return true;
+}
+
+/* Fails every request that can no longer complete. */
+static void mux_fail_all(quicpro_h3_mux_t *mux, const char *why) {
+    quicpro_h3_req_t *r;
+
+    while ((r = fifo_shift(&mux->unsent))) {
+        mux_complete(mux, r, zend_string_init(why, strlen(why), 0));
+    }
+    ZEND_HASH_FOREACH_PTR(&mux->streams, r) {
+        mux_complete(mux, r, zend_string_init(why, strlen(why), 0));
+    } ZEND_HASH_FOREACH_END();
+}
+
+/* One round: send, receive, dispatch every event. */
+static void mux_round(quicpro_session_t *s) {
+    quiche_h3_event *ev;
+    int64_t stream_id;
+
+    mux_progress(s);
+    quicpro_session_pump_tx(s);
+
+    quicpro_session_pump_rx(s);
+    if (quiche_conn_timeout_as_millis(s->conn) == 0) {
+        quiche_conn_on_timeout(s->conn);
+    }
+
+    while ((stream_id = quicpro_prof_h3_conn_poll(s->h3, s->conn, &ev)) >= 0) {
+        if (!quicpro_h3_mux_dispatch(s, ev, (uint64_t)stream_id)
+            && !quicpro_mcp_dispatch(s, ev, (uint64_t)stream_id)) {
+            quiche_h3_event_free(ev);   /* Nobody is waiting for it */
+        }
+    }
+
+    if (quiche_conn_is_closed(s->conn)) {
+        mux_fail_all(s->mux, "Connection closed before the response completed");
+        return;
+    }
+    /* Finished streams may have made room for queued requests */
+    mux_progress(s);
+    quicpro_session_pump_tx(s);
+}
+
+/*───────────────────────────── Helpers ───────────────────────────────────*/
+
+static zend_long mux_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (zend_long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static quicpro_session_t *mux_fetch_session(zval *z_sess) {
+    quicpro_session_t *s = (quicpro_session_t *)zend_fetch_resource2_ex(z_sess, "Quicpro\\Session", le_quicpro, le_quicpro_session);
+    if (!s) {
+        return NULL;
+    }
+    if (!s->conn || !s->h3 || s->is_closed) {
+        throw_quic_exception(0, "Session is closed or has no HTTP/3 layer");
+        return NULL;
+    }
+    return s;
+}
+
+static void mux_add_field(quicpro_h3_req_t *r, uint32_t *cap, zend_string *name, zend_string *value) {
+    if (r->nfields + 2 > *cap) {
+        *cap = *cap ? *cap * 2 : 16;
+        r->fields = safe_erealloc(r->fields, *cap, sizeof(zend_string *), 0);
+    }
+    r->fields[r->nfields++] = name;
+    r->fields[r->nfields++] = value;
+}
+
+static zend_string *mux_option_string(HashTable *ht, const char *key, size_t key_len, const char *def) {
+    zval *zv = zend_hash_str_find(ht, key, key_len);
+    if (zv && Z_TYPE_P(zv) != IS_NULL) {
+        return zval_get_string(zv);
+    }
+    return zend_string_init(def, strlen(def), 0);
+}
+
+/* Builds a request from its userland description, or returns NULL after throwing. */
+static quicpro_h3_req_t *mux_req_new(quicpro_session_t *s, HashTable *spec) {
+    quicpro_h3_req_t *r = ecalloc(1, sizeof(*r));
+    uint32_t cap = 0;
+
+    r->stream_id = -1;
+    array_init(&r->headers);
+
+    /* Pseudo-headers must precede all regular fields (RFC 9114 §4.3) */
+    mux_add_field(r, &cap, zend_string_init(":method", 7, 0),    mux_option_string(spec, "method", 6, "GET"));
+    mux_add_field(r, &cap, zend_string_init(":scheme", 7, 0),    mux_option_string(spec, "scheme", 6, "https"));
+    mux_add_field(r, &cap, zend_string_init(":authority", 10, 0), mux_option_string(spec, "authority", 9, s->host));
+    mux_add_field(r, &cap, zend_string_init(":path", 5, 0),      mux_option_string(spec, "path", 4, "/"));
+
+    zval *z_headers = zend_hash_str_find(spec, "headers", sizeof("headers") - 1);
+    if (z_headers && Z_TYPE_P(z_headers) == IS_ARRAY) {
+        zend_string *name;
+        zval *value;
+        ZEND_HASH_FOREACH_STR_KEY_VAL(Z_ARRVAL_P(z_headers), name, value) {
+            if (!name) {
+                mux_req_free(r);
+                zend_throw_exception(zend_ce_value_error, "Request headers must be keyed by field name", 0);
+                return NULL;
+            }
+            /* HTTP/3 field names are lowercase (RFC 9114 §4.2) */
+            mux_add_field(r, &cap, zend_string_tolower(name), zval_get_string(value));
+        } ZEND_HASH_FOREACH_END();
+    }
+
+    zval *z_body = zend_hash_str_find(spec, "body", sizeof("body") - 1);
+    if (z_body && Z_TYPE_P(z_body) != IS_NULL) {
+        r->body = zval_get_string(z_body);
+    }
+    return r;
+}
+
+/*──────────────────────────── C callers ──────────────────────────────────*/
+
+uint64_t quicpro_h3_mux_submit(quicpro_session_t *s, const char *method, const char *path, size_t path_len, zend_string *body) {
+    quicpro_h3_mux_t *mux = mux_get(s);
+    quicpro_h3_req_t *r = ecalloc(1, sizeof(*r));
+    uint32_t cap = 0;
+
+    r->stream_id = -1;
+    array_init(&r->headers);
+    mux_add_field(r, &cap, zend_string_init(":method", 7, 0),    zend_string_init(method, strlen(method), 0));
+    mux_add_field(r, &cap, zend_string_init(":scheme", 7, 0),    zend_string_init("https", 5, 0));
+    mux_add_field(r, &cap, zend_string_init(":authority", 10, 0), zend_string_init(s->host, strlen(s->host), 0));
+    mux_add_field(r, &cap, zend_string_init(":path", 5, 0),      zend_string_init(path, path_len, 0));
+    if (body) {
+        r->body = zend_string_copy(body);
+    }
+    r->id = mux->next_id++;
+    fifo_push(&mux->unsent, r);
+    mux->pending++;
+    return r->id;
+}
+
+bool quicpro_h3_mux_submit_request(quicpro_session_t *s, HashTable *spec, uint64_t *id) {
+    quicpro_h3_mux_t *mux = mux_get(s);
+    quicpro_h3_req_t *r = mux_req_new(s, spec);
+    if (!r) {
+        return false;
+    }
+    r->id = *id = mux->next_id++;
+    fifo_push(&mux->unsent, r);
+    mux->pending++;
+    return true;
+}
+
+void quicpro_h3_mux_step(quicpro_session_t *s) {
+    mux_get(s);
+    if (s->is_closed || !s->conn || !s->h3) {
+        mux_fail_all(s->mux, "Session is closed");
+        return;
+    }
+    mux_round(s);
+}
+
+bool quicpro_h3_mux_take(quicpro_session_t *s, uint64_t *id, zend_long *status, zend_string **body, zend_string **error, zval *headers) {
+    quicpro_h3_req_t *r = s->mux ? fifo_shift(&s->mux->done) : NULL;
+    if (!r) {
+        return false;
+    }
+    *id = r->id;
+    *status = r->status;
+    *body = quicpro_body_take(&r->resp);
+    *error = r->error;
+    r->error = NULL;
+    if (headers) {
+        ZVAL_COPY_VALUE(headers, &r->headers);
+        ZVAL_UNDEF(&r->headers);
+    }
+    s->mux->pending--;
+    mux_req_free(r);
+    return true;
+}
+
+/*─────────────────────────── PHP functions ───────────────────────────────*/
+
+/* {{{ quicpro_http3_batch_submit(resource $session, array $requests): array|false
+ *
+ * Queues every request and opens as many streams as the peer allows right
+ * away. Each request is an array with optional keys `method` ("GET"),
+ * `path` ("/"), `scheme` ("https"), `authority` (the session host),
+ * `headers` (name => value) and `body` (string). Returns the request ids,
+ * keyed like $requests.
+ */
+PHP_FUNCTION(quicpro_http3_batch_submit)
+{
+    zval *z_sess;
+    HashTable *requests;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_RESOURCE(z_sess)
+        Z_PARAM_ARRAY_HT(requests)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = mux_fetch_session(z_sess);
+    if (!s) {
+        RETURN_FALSE;
+    }
+
+    /* Validate everything before queueing anything */
+    zval *spec;
+    ZEND_HASH_FOREACH_VAL(requests, spec) {
+        if (Z_TYPE_P(spec) != IS_ARRAY) {
+            zend_argument_type_error(2, "must contain only arrays, %s given", zend_zval_type_name(spec));
+            RETURN_THROWS();
+        }
+    } ZEND_HASH_FOREACH_END();
+
+    quicpro_h3_mux_t *mux = mux_get(s);
+    zend_ulong idx;
+    zend_string *key;
+
+    array_init_size(return_value, zend_hash_num_elements(requests));
+    ZEND_HASH_FOREACH_KEY_VAL(requests, idx, key, spec) {
+        quicpro_h3_req_t *r = mux_req_new(s, Z_ARRVAL_P(spec));
+        if (!r) {
+            /* The requests queued so far stay queued; their ids are lost with the return value */
+            zval_ptr_dtor(return_value);
+            RETURN_THROWS();
+        }
+        r->id = mux->next_id++;
+        fifo_push(&mux->unsent, r);
+        mux->pending++;
+
+        if (key) {
+            add_assoc_long_ex(return_value, ZSTR_VAL(key), ZSTR_LEN(key), (zend_long)r->id);
+        } else {
+            add_index_long(return_value, idx, (zend_long)r->id);
+        }
+    } ZEND_HASH_FOREACH_END();
+
+    mux_progress(s);
+    quicpro_session_pump_tx(s);
+}
+/* }}} */
+
+/* {{{ quicpro_http3_batch_wait(resource $session, int $timeout_ms = -1, int $max = 0): array|false
+ *
+ * Drives the session until at least one request has completed or
+ * $timeout_ms elapses, then returns up to $max (0: all) completions in
+ * the order they finished. Each is an array with `id`, `stream_id`,
+ * `status`, `headers` and `body`, plus `error` (string) for a request
+ * that failed. Inside a Fiber the wait parks the fiber instead of
+ * blocking the worker. Returns [] on timeout or when nothing is pending.
+ */
+PHP_FUNCTION(quicpro_http3_batch_wait)
+{
+    zval *z_sess;
+    zend_long timeout_ms = -1;
+    zend_long max = 0;
+
+    ZEND_PARSE_PARAMETERS_START(1, 3)
+        Z_PARAM_RESOURCE(z_sess)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(timeout_ms)
+        Z_PARAM_LONG(max)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = mux_fetch_session(z_sess);
+    if (!s) {
+        RETURN_FALSE;
+    }
+    quicpro_h3_mux_t *mux = mux_get(s);
+    zend_long start = mux_now_ms();
+
+    while (mux->pending && !mux->done.head) {
+        mux_round(s);
+        if (mux->done.head) {
+            break;
+        }
+
+        zend_long elapsed = mux_now_ms() - start;
+        if (timeout_ms >= 0 && elapsed >= timeout_ms) {
+            break;
+        }
+        zend_long wait_ms = timeout_ms >= 0 ? timeout_ms - elapsed : -1;
+        int64_t quic_deadline = quiche_conn_timeout_as_millis(s->conn);
+        if (quic_deadline >= 0 && (wait_ms < 0 || quic_deadline < wait_ms)) {
+            wait_ms = quic_deadline;
+        }
+
+        quicpro_sched_result_t rc = quicpro_sched_wait(s, Z_RES_P(z_sess), wait_ms);
+        if (rc == QUICPRO_SCHED_ERROR) {
+            RETURN_THROWS();
+        }
+        if (rc == QUICPRO_SCHED_NO_FIBER) {
+            struct pollfd pfd = { .fd = s->sock, .events = POLLIN };
+            if (poll(&pfd, 1, wait_ms < 0 ? -1 : (int)MIN(wait_ms, INT_MAX)) < 0 && errno != EINTR) {
+                throw_network_exception(errno, "Failed to wait for HTTP/3 responses: %s", strerror(errno));
+                RETURN_FALSE;
+            }
+        }
+        if (s->is_closed || !s->conn) {
+            /* Closed by another fiber while this one was parked */
+            mux_fail_all(mux, "Session closed while waiting for the response");
+            break;
+        }
+    }
+
+    array_init(return_value);
+    quicpro_h3_req_t *r;
+    while ((max <= 0 || zend_hash_num_elements(Z_ARRVAL_P(return_value)) < (uint32_t)max)
+           && (r = fifo_shift(&mux->done))) {
+        zval entry;
+        array_init_size(&entry, 6);
+        add_assoc_long(&entry, "id", (zend_long)r->id);
+        add_assoc_long(&entry, "stream_id", (zend_long)r->stream_id);
+        add_assoc_long(&entry, "status", r->status);
+        add_assoc_zval(&entry, "headers", &r->headers);
+        ZVAL_UNDEF(&r->headers);    /* Moved into the entry */
+        add_assoc_str(&entry, "body", quicpro_body_take(&r->resp));
+        if (r->error) {
+            add_assoc_str(&entry, "error", r->error);
+            r->error = NULL;
+        }
+        add_next_index_zval(return_value, &entry);
+
+        mux->pending--;
+        mux_req_free(r);
+    }
+}
+/* }}} */
+
+/* {{{ quicpro_http3_batch_pending(resource $session): int
+ *
+ * Number of submitted requests whose completion has not been returned by
+ * quicpro_http3_batch_wait() yet.
+ */
+PHP_FUNCTION(quicpro_http3_batch_pending)
+{
+    zval *z_sess;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_RESOURCE(z_sess)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = (quicpro_session_t *)zend_fetch_resource2_ex(z_sess, "Quicpro\\Session", le_quicpro, le_quicpro_session);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    RETURN_LONG(s->mux ? (zend_long)s->mux->pending : 0);
+}
+/* }}} */
@@ -0,0 +1,394 @@
+#include "php_quicpro.h"
+#include "client/pool.h"
+#include "client/mux.h"
+#include "config/quic_transport/base_layer.h"
+#include "mcp/mcp.h"
+#include "poll/poll.h"
+
+#include <inttypes.h>
+#include <quiche.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @file extension/src/client/pool.c
+ * @brief Implementation of the per-worker client connection pool.
+ *
+ * Buckets are small arrays: a worker talks to a handful of origins, each
+ * with a few connections, so a linear scan per checkout is cheaper than
+ * any index. The bucket key is the origin, ALPN and config address
+ * joined into one string.
+ *
+ * Parked connections sit on shelves in a persistent table, keyed by the
+ * origin, ALPN and config fingerprint. A parked session is a `pemalloc`
+ * copy of the connection core: socket, quiche and HTTP/3 state, peer and
+ * identity. Everything on the request heap (batches, io_uring ring,
+ * multiplexer, MCP table) stays with the request's session and goes with
+ * its resource; the unparked copy creates its own again on first use.
+ */
+
+extern int le_quicpro_session;
+
+typedef struct {
+    zend_resource *res;
+    uint64_t       last_checkout_ms;
+} pool_conn_t;
+
+typedef struct {
+    pool_conn_t *conns;
+    uint32_t     len;
+    uint32_t     cap;
+    zend_string *shelf_key;   /* Where its connections park, NULL unless persistent */
+} pool_bucket_t;
+
+typedef struct {
+    quicpro_session_t *s;     /* pemalloc'd */
+    uint64_t           parked_ms;
+} pool_parked_t;
+
+typedef struct {
+    pool_parked_t *conns;     /* Oldest first */
+    uint32_t       len;
+    uint32_t       cap;
+} pool_shelf_t;
+
+static HashTable *pool_buckets;
+static HashTable *pool_shelves;   /* Persistent, outlives the request */
+
+static uint64_t pool_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static zend_string *pool_key_string(const quicpro_pool_key_t *key) {
+    return strpprintf(0, "%.*s|%ld|%s|%p", (int)key->host_len, key->host, (long)key->port, key->alpn, (const void *)key->cfg);
+}
+
+/* Like the bucket key, with the config's options in place of its address */
+static zend_string *pool_shelf_key(const quicpro_pool_key_t *key) {
+    return strpprintf(0, "%.*s|%ld|%s|%016" PRIx64, (int)key->host_len, key->host, (long)key->port, key->alpn,
+                      key->cfg ? key->cfg->fingerprint : (uint64_t)0);
+}
+
+/* Callers other than the pool itself */
+static uint32_t pool_conn_holders(const pool_conn_t *c) {
+    return GC_REFCOUNT(c->res) - 1;
+}
+
+static bool pool_conn_alive(quicpro_session_t *s) {
+    if (!s || !s->conn || s->is_closed) {
+        return false;
+    }
+    return !quiche_conn_is_closed(s->conn) && !quiche_conn_is_draining(s->conn);
+}
+
+/* Closes the connection if the peer can still hear it, and drops the pool's reference. */
+static void pool_conn_drop(pool_bucket_t *b, uint32_t i) {
+    pool_conn_t *c = &b->conns[i];
+    quicpro_session_t *s = c->res->ptr;
+
+    if (pool_conn_alive(s) && pool_conn_holders(c) == 0) {
+        quiche_conn_close(s->conn, true, 0, (const uint8_t *)"", 0);
+        quicpro_session_pump_tx(s);
+    }
+    if (s) {
+        s->pooled = false;
+    }
+    zend_list_delete(c->res);
+    b->conns[i] = b->conns[--b->len];
+}
+
+static void pool_bucket_dtor(zval *zv) {
+    pool_bucket_t *b = Z_PTR_P(zv);
+    while (b->len) {
+        pool_conn_drop(b, b->len - 1);
+    }
+    if (b->conns) {
+        efree(b->conns);
+    }
+    if (b->shelf_key) {
+        zend_string_release(b->shelf_key);
+    }
+    efree(b);
+}
+
+/*──────────────────────── Parking across requests ────────────────────────*/
+
+/*
+ * Whether the connection can outlive the request: open, established, with
+ * streams left, and with nothing attached that is bound to the request or
+ * to state a copy cannot take along (paths, AF_XDP, diagnostics, served
+ * or relayed streams, calls still in flight).
+ */
+static bool pool_conn_parkable(quicpro_session_t *s) {
+    return pool_conn_alive(s) && s->sock >= 0
+        && quiche_conn_is_established(s->conn)
+        && quiche_conn_peer_streams_left_bidi(s->conn) > 0
+        && !s->mp && !s->xdp && !s->txstamp && !s->qlog
+        && !s->mcp_served && !s->proxy && !s->doq && !s->ssh && !s->wt
+        && quicpro_h3_mux_idle(s->mux) && quicpro_mcp_inflight_idle(s->mcp);
+}
+
+/* Frees a parked copy. Runs without a request, so the close goes out directly. */
+static void pool_parked_free(quicpro_session_t *p) {
+    uint8_t out[QUICPRO_MAX_PACKET_SIZE];
+    quiche_send_info si;
+    ssize_t n;
+
+    if (!quiche_conn_is_closed(p->conn)) {
+        quiche_conn_close(p->conn, true, 0, (const uint8_t *)"", 0);
+        while ((n = quiche_conn_send(p->conn, out, sizeof(out), &si)) > 0) {
+            sendto(p->sock, out, (size_t)n, 0, (struct sockaddr *)&si.to, si.to_len);
+        }
+    }
+    if (p->h3) {
+        quiche_h3_conn_free(p->h3);
+    }
+    quiche_conn_free(p->conn);
+    if (p->h3_cfg) {
+        quiche_h3_config_free(p->h3_cfg);
+    }
+    if (p->cfg) {
+        quiche_config_free(p->cfg);
+    }
+    close(p->sock);
+    pefree(p, 1);
+}
+
+static void pool_shelf_dtor(zval *zv) {
+    pool_shelf_t *shelf = Z_PTR_P(zv);
+    for (uint32_t i = 0; i < shelf->len; i++) {
+        pool_parked_free(shelf->conns[i].s);
+    }
+    if (shelf->conns) {
+        pefree(shelf->conns, 1);
+    }
+    pefree(shelf, 1);
+}
+
+/* Moves the connection core of `s` onto the shelf; `s` is left closed. */
+static void pool_park(pool_shelf_t *shelf, quicpro_session_t *s, uint64_t now) {
+    quicpro_session_pump_tx(s);   /* ACKs and whatever the last calls queued */
+
+    quicpro_session_t *p = pemalloc(sizeof(*p), 1);
+    memcpy(p, s, sizeof(*p));
+    p->cfg_ptr  = NULL;
+    p->rx_batch = NULL;
+    p->tx_batch = NULL;
+    p->uring    = NULL;
+    p->mux      = NULL;
+    p->mcp      = NULL;
+    p->resource = NULL;
+    p->pooled   = false;
+
+    /* The core belongs to the copy now; the session's destructor must not free it */
+    s->sock      = -1;
+    s->conn      = NULL;
+    s->h3        = NULL;
+    s->h3_cfg    = NULL;
+    s->cfg       = NULL;
+    s->is_closed = true;
+
+    if (shelf->len == shelf->cap) {
+        shelf->cap = shelf->cap ? shelf->cap * 2 : 4;
+        shelf->conns = safe_perealloc(shelf->conns, shelf->cap, sizeof(pool_parked_t), 0, 1);
+    }
+    shelf->conns[shelf->len++] = (pool_parked_t){ p, now };
+}
+
+/*
+ * Parks the connections of `b` that can be kept, oldest first, up to the
+ * per-key limit. Runs at the end of the request, when a caller's
+ * reference is only waiting for the engine to release it.
+ */
+static void pool_bucket_park(pool_bucket_t *b, uint64_t now) {
+    uint32_t max_idle = (uint32_t)quicpro_quic_transport_config.client_pool_max_idle;
+
+    if (!b->shelf_key || max_idle == 0) {
+        return;
+    }
+    if (!pool_shelves) {
+        pool_shelves = pemalloc(sizeof(HashTable), 1);
+        zend_hash_init(pool_shelves, 8, NULL, pool_shelf_dtor, 1);
+    }
+    pool_shelf_t *shelf = zend_hash_str_find_ptr(pool_shelves, ZSTR_VAL(b->shelf_key), ZSTR_LEN(b->shelf_key));
+    for (uint32_t i = 0; i < b->len; i++) {
+        quicpro_session_t *s = b->conns[i].res->ptr;
+        if (shelf && shelf->len >= max_idle) {
+            break;
+        }
+        if (!pool_conn_parkable(s)) {
+            continue;
+        }
+        if (!shelf) {
+            shelf = pecalloc(1, sizeof(*shelf), 1);
+            zend_hash_str_add_new_ptr(pool_shelves, ZSTR_VAL(b->shelf_key), ZSTR_LEN(b->shelf_key), shelf);
+        }
+        pool_park(shelf, s, now);
+    }
+}
+
+/*
+ * Takes the newest parked connection for `key` that is still healthy:
+ * reads what arrived while it was parked (a CONNECTION_CLOSE, say), fires
+ * an expired timer, and requires it open, established and with streams
+ * left. The others are closed. The connection joins the request's pool.
+ */
+static zend_resource *pool_unpark(const quicpro_pool_key_t *key, uint64_t now) {
+    uint64_t idle_timeout = (uint64_t)quicpro_quic_transport_config.client_pool_idle_timeout_ms;
+
+    if (!pool_shelves) {
+        return NULL;
+    }
+    zend_string *k = pool_shelf_key(key);
+    pool_shelf_t *shelf = zend_hash_str_find_ptr(pool_shelves, ZSTR_VAL(k), ZSTR_LEN(k));
+    zend_string_release(k);
+    if (!shelf) {
+        return NULL;
+    }
+
+    while (shelf->len) {
+        pool_parked_t c = shelf->conns[--shelf->len];
+        if (now - c.parked_ms > idle_timeout) {
+            pool_parked_free(c.s);
+            continue;
+        }
+
+        quicpro_session_t *s = emalloc(sizeof(*s));
+        memcpy(s, c.s, sizeof(*s));
+        pefree(c.s, 1);
+        s->cfg_ptr = (quicpro_cfg_t *)key->cfg;   /* Equal options, see quicpro_cfg_t.fingerprint */
+
+        quicpro_session_pump_rx(s);
+        if (quiche_conn_timeout_as_nanos(s->conn) == 0) {
+            quiche_conn_on_timeout(s->conn);
+        }
+        if (!pool_conn_alive(s) || !quiche_conn_is_established(s->conn)
+            || quiche_conn_peer_streams_left_bidi(s->conn) == 0) {
+            if (pool_conn_alive(s)) {
+                quiche_conn_close(s->conn, true, 0, (const uint8_t *)"", 0);
+                quicpro_session_pump_tx(s);
+            }
+            quicpro_session_free_members(s);
+            efree(s);
+            continue;
+        }
+
+        s->resource = zend_register_resource(s, le_quicpro_session);
+        quicpro_client_pool_add(key, s);
+        return s->resource;   /* The registration's reference is the caller's */
+    }
+    return NULL;
+}
+
+/* Newest first: drops dead connections, expired idle ones and idle ones beyond the limit. */
+static void pool_bucket_sweep(pool_bucket_t *b, uint64_t now) {
+    uint64_t idle_timeout = (uint64_t)quicpro_quic_transport_config.client_pool_idle_timeout_ms;
+    uint32_t idle = 0;
+
+    for (uint32_t i = b->len; i-- > 0; ) {
+        pool_conn_t *c = &b->conns[i];
+        quicpro_session_t *s = c->res->ptr;
+        bool unheld = pool_conn_holders(c) == 0;
+
+        if (unheld && pool_conn_alive(s)) {
+            quicpro_session_pump_rx(s);   /* Notice a close sent while nobody was reading */
+        }
+        if (!pool_conn_alive(s)
+            || (unheld && (now - c->last_checkout_ms > idle_timeout
+                           || ++idle > (uint32_t)quicpro_quic_transport_config.client_pool_max_idle))) {
+            pool_conn_drop(b, i);
+        }
+    }
+}
+
+zend_resource *quicpro_client_pool_checkout(const quicpro_pool_key_t *key, uint32_t max_holders) {
+    uint64_t now = pool_now_ms();
+    pool_bucket_t *b = NULL;
+
+    if (pool_buckets) {
+        zend_string *k = pool_key_string(key);
+        b = zend_hash_find_ptr(pool_buckets, k);
+        zend_string_release(k);
+    }
+    if (!b) {
+        return quicpro_quic_transport_config.client_pool_persistent ? pool_unpark(key, now) : NULL;
+    }
+
+    pool_bucket_sweep(b, now);
+
+    pool_conn_t *best = NULL;
+    for (uint32_t i = 0; i < b->len; i++) {
+        pool_conn_t *c = &b->conns[i];
+        quicpro_session_t *s = c->res->ptr;
+        uint32_t holders = pool_conn_holders(c);
+
+        if (holders >= max_holders) {
+            continue;
+        }
+        if (quiche_conn_is_established(s->conn) && quiche_conn_peer_streams_left_bidi(s->conn) == 0) {
+            continue;
+        }
+        /* Fewest holders first, so load spreads over the warm connections */
+        if (!best || holders < pool_conn_holders(best)) {
+            best = c;
+        }
+    }
+
+    if (!best) {
+        return quicpro_quic_transport_config.client_pool_persistent ? pool_unpark(key, now) : NULL;
+    }
+    best->last_checkout_ms = now;
+    GC_ADDREF(best->res);
+    return best->res;
+}
+
+void quicpro_client_pool_add(const quicpro_pool_key_t *key, quicpro_session_t *s) {
+    if (!pool_buckets) {
+        ALLOC_HASHTABLE(pool_buckets);
+        zend_hash_init(pool_buckets, 8, NULL, pool_bucket_dtor, 0);
+    }
+    zend_string *k = pool_key_string(key);
+    pool_bucket_t *b = zend_hash_find_ptr(pool_buckets, k);
+    if (!b) {
+        b = ecalloc(1, sizeof(*b));
+        if (quicpro_quic_transport_config.client_pool_persistent) {
+            b->shelf_key = pool_shelf_key(key);
+        }
+        zend_hash_add_new_ptr(pool_buckets, k, b);
+    }
+    zend_string_release(k);
+
+    if (b->len == b->cap) {
+        b->cap = b->cap ? b->cap * 2 : 4;
+        b->conns = safe_erealloc(b->conns, b->cap, sizeof(pool_conn_t), 0);
+    }
+    GC_ADDREF(s->resource);
+    b->conns[b->len++] = (pool_conn_t){ s->resource, pool_now_ms() };
+    s->pooled = true;
+}
+
+void quicpro_client_pool_rshutdown(void) {
+    if (pool_buckets) {
+        uint64_t now = pool_now_ms();
+        pool_bucket_t *b;
+        ZEND_HASH_FOREACH_PTR(pool_buckets, b) {
+            pool_bucket_park(b, now);
+        } ZEND_HASH_FOREACH_END();
+        zend_hash_destroy(pool_buckets);
+        FREE_HASHTABLE(pool_buckets);
+        pool_buckets = NULL;
+    }
+}
+
+void quicpro_client_pool_mshutdown(void) {
+    if (pool_shelves) {
+        zend_hash_destroy(pool_shelves);
+        pefree(pool_shelves, 1);
+        pool_shelves = NULL;
+    }
+}
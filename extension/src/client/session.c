@@ -1,8 +1,21 @@
 #include "php_quicpro.h"
 #include "client/session.h"
+#include "client/pool.h"
+#include "client/dns.h"
+#include "client/ticket_cache.h"
+#include "server/congestion.h"
+#include "config/tls_and_crypto/base_layer.h"
 #include "config/config.h"
+#include "config/quic_transport/base_layer.h"
+#include "config/app_http3_websockets_webtransport/base_layer.h"
+#include "server/h3_settings.h"
 #include "client/tls.h"
 #include "client/cancel.h"
+#include "client/multipath.h"
+#include "poll/txstamp.h"
+#include "poll/udp_batch.h"
+#include "poll/uring.h"
+#include "poll/busy_poll.h"
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <openssl/rand.h>
@@ -11,6 +24,9 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <time.h>
 
 /**
  * @file extension/src/client/session.c
@@ -35,50 +51,6 @@
 // Global resource type for Quicpro\Session objects.
 extern int le_quicpro_session;
 
-/**
- * @brief Helper function to set a UDP socket to non-blocking mode.
- *
- * This function creates a new UDP socket with the `SOCK_NONBLOCK` flag set,
- * ensuring that I/O operations on this socket will not block the calling thread.
- * Non-blocking sockets are essential for asynchronous network programming
- * and integration with event loops (like PHP Fibers).
- *
- * @param family The address family (e.g., AF_INET, AF_INET6).
- * @return The file descriptor of the non-blocking UDP socket on success, or -1 on error.
- */
-static int udp_socket_nonblock(int family) {
-    int sock = socket(family, SOCK_DGRAM | SOCK_NONBLOCK, 0);
-    if (sock < 0) {
-        throw_network_exception(errno, "Failed to create non-blocking UDP socket: %s", strerror(errno));
-    }
-    return sock;
-}
-
-/**
- * @brief Helper function to resolve a hostname and port into address information.
- *
- * This function uses `getaddrinfo` to perform DNS resolution for a given
- * hostname and service (port). It populates a linked list of `addrinfo`
- * structures, which can then be iterated to find a suitable address for connection.
- * It's critical for establishing connections by hostname rather than raw IP.
- *
- * @param host The hostname or IP address string.
- * @param port The port number as a string.
- * @param res A pointer to a `struct addrinfo*` which will be populated with results.
- * @return 0 on success, or a non-zero error code from `getaddrinfo` on failure.
- */
-static int resolve_host(const char *host, const char *port, struct addrinfo **res) {
-    struct addrinfo hints = {0};
-    hints.ai_socktype = SOCK_DGRAM;
-    hints.ai_family   = AF_UNSPEC;
-    hints.ai_flags    = AI_ADDRCONFIG;
-    int status = getaddrinfo(host, port, &hints, res);
-    if (status != 0) {
-        throw_network_exception(status, "DNS resolution failed for host '%s': %s", host, gai_strerror(status));
-    }
-    return status;
-}
-
 /**
  * @brief Helper function to bind a socket to a specific network interface.
  *
@@ -91,7 +63,7 @@ static int resolve_host(const char *host, const char *port, struct addrinfo **re
  * @param iface The name of the interface (e.g., "eth0").
  * @return 0 on success, or -1 on error.
  */
-static int socket_bind_iface(int fd, const char *iface) {
+int quicpro_socket_bind_iface(int fd, const char *iface) {
 #ifdef SO_BINDTODEVICE
     int res = setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, iface, strlen(iface));
     if (res < 0) {
@@ -105,57 +77,240 @@ static int socket_bind_iface(int fd, const char *iface) {
 }
 
 
+
+/*
+ * Happy Eyeballs (RFC 8305) for QUIC. A UDP connect() only picks a route,
+ * so "connected" here means the server answered the first flight: each
+ * attempt is a socket with its own `quiche_conn`, and the first one that
+ * receives a datagram wins. The datagram stays queued for the session's
+ * first pump. Attempts are started `happy_eyeballs_delay_ms` apart, at once
+ * when the previous one failed outright (no route, ICMP unreachable).
+ */
+typedef struct {
+    int                       fd;
+    quiche_conn              *conn;
+    uint8_t                   scid[QUICPRO_SCID_LEN];
+    const quicpro_dns_addr_t *addr;
+} he_attempt_t;
+
+static uint64_t he_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void he_flush(he_attempt_t *a) {
+    uint8_t out[QUICPRO_MAX_PACKET_SIZE];
+    quiche_send_info info;
+    ssize_t n;
+    while ((n = quiche_conn_send(a->conn, out, sizeof(out), &info)) > 0) {
+        if (send(a->fd, out, (size_t)n, 0) < 0) {
+            break;
+        }
+    }
+}
+
+static void he_attempt_free(he_attempt_t *a) {
+    if (a->conn) {
+        quiche_conn_free(a->conn);
+        a->conn = NULL;
+    }
+    if (a->fd >= 0) {
+        close(a->fd);
+        a->fd = -1;
+    }
+}
+
+/*
+ * 1: started, 0: this address is unusable (errno says why), -1: exception thrown.
+ * A cached TLS session (`resume`) is installed before the first flight; the
+ * initial window is the one learned for the address's prefix, if any.
+ */
+static int he_attempt_start(he_attempt_t *a, const quicpro_dns_addr_t *addr, const char *host,
+                            quicpro_cfg_t *cfg, const quicpro_cc_profile_t *cc, const char *iface,
+                            const uint8_t *resume, size_t resume_len) {
+    a->conn = NULL;
+    a->addr = addr;
+    a->fd = socket(addr->addr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (a->fd < 0) {
+        return 0;
+    }
+    if (iface && quicpro_socket_bind_iface(a->fd, iface) < 0) {
+        he_attempt_free(a);
+        return -1;
+    }
+    quicpro_udp_socket_pmtud(a->fd);
+    quicpro_udp_socket_ecn(a->fd);
+    quicpro_busy_poll_socket(a->fd);
+    if (connect(a->fd, (const struct sockaddr *)&addr->addr, addr->len) < 0) {
+        int err = errno;
+        he_attempt_free(a);
+        errno = err;
+        return 0;
+    }
+
+    RAND_bytes(a->scid, sizeof(a->scid));
+    quicpro_cc_warm_start(cfg->quiche_cfg, cc, (const struct sockaddr *)&addr->addr);
+    a->conn = quiche_connect(
+        host,
+        a->scid, sizeof(a->scid),
+        NULL, 0,
+        (const struct sockaddr *)&addr->addr,
+        addr->len,
+        cfg->quiche_cfg
+    );
+    if (!a->conn) {
+        he_attempt_free(a);
+        throw_quic_exception(0, "Failed to create new QUIC connection via quiche_connect. This indicates an invalid configuration or resource exhaustion.");
+        return -1;
+    }
+    if (resume_len > 0) {
+        /* A stale or foreign session is simply a full handshake */
+        (void)quiche_conn_set_session(a->conn, resume, resume_len);
+    }
+    he_flush(a);
+    return 1;
+}
+
 /**
- * @brief Establishes a new QUIC client session to a specified host and port.
- *
- * This PHP function initiates a new QUIC connection. It handles all phases:
- * DNS resolution, UDP socket creation (non-blocking), binding to a specific
- * interface if requested, and the initial `quiche_connect` call. It ensures
- * that the underlying `quiche` configuration is applied, which includes TLS
- * settings, QUIC transport parameters, and performance tuning options.
+ * @brief Races connection attempts over `addrs` (already in Happy Eyeballs
+ * order) and moves the winner's socket, connection and SCID into `s`.
  *
- * The function encapsulates the "Happy Eyeballs" logic for IP family selection
- * by iterating through resolved addresses and attempting connections.
- * NUMA node affinity is applied for performance optimization if specified.
+ * If nothing has answered within `happy_eyeballs_timeout_ms`, the earliest
+ * attempt still alive is kept and its handshake simply continues.
  *
- * @param host_str The target hostname or IP address of the QUIC server.
- * @param host_len The length of `host_str`.
- * @param port The target UDP port number.
- * @param config_resource A PHP resource representing a `Quicpro\Config` object. This
- * resource provides comprehensive configuration settings for the QUIC session.
- * @param numa_node An optional NUMA node ID (`int`) for hinting memory allocation
- * and CPU affinity. Pass -1 for automatic/default behavior.
- * @param options_array Optional PHP array containing connection-specific options
- * like `preferred_ip_family` (ipv4, ipv6, auto) or `interface`.
- * @return A PHP resource of type `Quicpro\Session` on success. Returns FALSE on failure,
- * throwing appropriate `Quicpro\Exception` subclasses (e.g., `QuicException`, `TlsException`,
- * `NetworkException`) for detailed error reporting.
+ * @return 0 on success, -1 after an exception has been thrown.
  */
-PHP_FUNCTION(quicpro_client_session_connect) {
-    char *host_str;
-    size_t host_len;
-    zend_long port;
-    zval *z_config_res;
-    zend_long numa_node = -1;
-    zval *options_array = NULL;
+static int happy_eyeballs_connect(quicpro_session_t *s, const quicpro_dns_addr_t *addrs, int naddrs,
+                                  zend_long port, quicpro_cfg_t *cfg, const quicpro_cc_profile_t *cc,
+                                  const char *iface, zend_long timeout_ms) {
+    he_attempt_t att[QUICPRO_DNS_MAX_ADDRS];
+    struct pollfd pfd[QUICPRO_DNS_MAX_ADDRS];
+    int pidx[QUICPRO_DNS_MAX_ADDRS];
+    int started = 0, live = 0, next = 0, winner = -1, last_errno = 0;
+    uint64_t delay = (uint64_t)quicpro_quic_transport_config.happy_eyeballs_delay_ms;
+    uint64_t now = he_now_ms();
+    uint64_t deadline = now + (uint64_t)timeout_ms;
+    uint64_t next_start = now;
+
+    uint8_t resume[QUICPRO_CLIENT_SESSION_MAX];
+    size_t resume_len = quicpro_client_ticket_cache_get(s->host, port, resume, sizeof(resume));
+    if (resume_len > 0 && quicpro_tls_crypto_config.tls_client_enable_early_data) {
+        /* Lets quiche offer 0-RTT when resuming; idempotent, and inert without a session */
+        quiche_config_enable_early_data(cfg->quiche_cfg);
+    }
+    // quiche copies the controller into each connection; this target's profile is the one copied
+    quicpro_cc_profile_apply(cfg->quiche_cfg, cc);
+
+    for (;;) {
+        while (next < naddrs && (now >= next_start || live == 0)) {
+            he_attempt_t *a = &att[started];
+            int rc = he_attempt_start(a, &addrs[next++], s->host, cfg, cc, iface, resume, resume_len);
+            if (rc < 0) {
+                goto fail;
+            }
+            if (rc == 0) {
+                last_errno = errno;
+                continue;
+            }
+            started++;
+            live++;
+            next_start = now + delay;
+        }
+        if (live == 0 || now >= deadline) {
+            break;
+        }
 
-    ZEND_PARSE_PARAMETERS_START(3, 5)
-        Z_PARAM_STRING(host_str, host_len)
-        Z_PARAM_LONG(port)
-        Z_PARAM_RESOURCE(z_config_res)
-        Z_PARAM_OPTIONAL
-        Z_PARAM_LONG(numa_node)
-        Z_PARAM_ARRAY_OR_NULL(options_array)
-    ZEND_PARSE_PARAMETERS_END();
+        /* Sleep until an answer, the next attempt's turn, or a quiche timer */
+        uint64_t wake = next < naddrs ? MIN(deadline, next_start) : deadline;
+        int np = 0;
+        for (int i = 0; i < started; i++) {
+            if (!att[i].conn) {
+                continue;
+            }
+            uint64_t t = quiche_conn_timeout_as_millis(att[i].conn);
+            if (t != UINT64_MAX) {
+                wake = MIN(wake, now + t);
+            }
+            pfd[np] = (struct pollfd){ .fd = att[i].fd, .events = POLLIN };
+            pidx[np++] = i;
+        }
+        int rc = poll(pfd, np, (int)MIN(wake > now ? wake - now : 0, (uint64_t)INT_MAX));
+        if (rc < 0 && errno != EINTR) {
+            last_errno = errno;
+            break;
+        }
+        now = he_now_ms();
 
-    // Fetch the global Quicpro configuration object.
-    quicpro_cfg_t *cfg_wrapper = (quicpro_cfg_t *)zend_fetch_resource_ex(z_config_res, "Quicpro\\Config", le_quicpro_cfg);
-    if (!cfg_wrapper || cfg_wrapper->quiche_cfg == NULL) {
-        throw_config_exception(0, "Invalid or uninitialized Quicpro\\Config resource provided.");
-        RETURN_FALSE;
+        for (int k = 0; rc > 0 && k < np && winner < 0; k++) {
+            if (!pfd[k].revents) {
+                continue;
+            }
+            uint8_t probe;
+            if (recv(pfd[k].fd, &probe, sizeof(probe), MSG_PEEK) >= 0) {
+                winner = pidx[k];
+            } else if (errno != EAGAIN && errno != EINTR) {
+                /* e.g. ECONNREFUSED from an ICMP unreachable: drop it, try the next one now */
+                last_errno = errno;
+                he_attempt_free(&att[pidx[k]]);
+                live--;
+                next_start = now;
+            }
+        }
+        if (winner >= 0) {
+            break;
+        }
+        for (int i = 0; i < started; i++) {
+            if (att[i].conn && quiche_conn_timeout_as_millis(att[i].conn) == 0) {
+                quiche_conn_on_timeout(att[i].conn);
+                he_flush(&att[i]);
+            }
+        }
+    }
+
+    for (int i = 0; winner < 0 && i < started; i++) {
+        if (att[i].conn) {
+            winner = i;     /* Nobody answered: keep the most preferred attempt */
+        }
     }
+    if (winner < 0) {
+        throw_network_exception(last_errno, "Failed to connect UDP socket to host '%s:%ld' using any available IP family. Last system error: %s",
+                                s->host, (long)port, strerror(last_errno));
+        goto fail;
+    }
+
+    s->sock = att[winner].fd;
+    s->conn = att[winner].conn;
+    memcpy(s->scid, att[winner].scid, sizeof(s->scid));
+    memcpy(&s->peer_addr, &att[winner].addr->addr, att[winner].addr->len);
+    s->peer_addr_len = att[winner].addr->len;
+    s->ticket_cache_pending = quicpro_tls_crypto_config.tls_client_session_cache_enable;
+    att[winner].fd = -1;
+    att[winner].conn = NULL;
+    for (int i = 0; i < started; i++) {
+        he_attempt_free(&att[i]);
+    }
+    return 0;
+
+fail:
+    for (int i = 0; i < started; i++) {
+        he_attempt_free(&att[i]);
+    }
+    return -1;
+}
+
+/**
+ * @brief Connects a new client session: DNS, the Happy Eyeballs race of
+ * sockets and `quiche_connect` attempts, and the HTTP/3 layer. Shared by quicpro_client_session_connect() and
+ * quicpro_mcp_connect().
+ *
+ * @return The session, without a resource yet, or NULL after an exception
+ * has been thrown.
+ */
+quicpro_session_t *quicpro_client_session_open(const char *host_str, size_t host_len, zend_long port,
+                                               quicpro_cfg_t *cfg, int numa_node, HashTable *options) {
     // Ensure the config is marked as frozen as it's now being used.
-    quicpro_config_mark_frozen(cfg_wrapper);
+    quicpro_config_mark_frozen(cfg);
 
     // Allocate memory for the new session object.
     quicpro_session_t *s = ecalloc(1, sizeof(*s));
@@ -163,145 +318,70 @@ PHP_FUNCTION(quicpro_client_session_connect) {
     s->sock = -1;
     s->conn = NULL;
     s->h3 = NULL;
-    s->cfg_ptr = cfg_wrapper;
+    s->cfg_ptr = cfg;
     s->h3_cfg = NULL;
     s->ticket_len = 0;
     s->ts_enabled = 0;
-    s->numa_node = (int)numa_node;
+    s->gso_state = QUICPRO_GSO_UNKNOWN;
+    s->numa_node = numa_node;
     s->is_closed = false;
 
     // Copy host string for SNI and authority header.
     if (host_len >= sizeof(s->host)) {
         throw_network_exception(0, "Hostname '%s' is too long. Maximum allowed is %zu characters.", host_str, sizeof(s->host) - 1);
         efree(s);
-        RETURN_FALSE;
+        return NULL;
     }
     strncpy(s->host, host_str, sizeof(s->host) - 1);
     s->host[sizeof(s->host) - 1] = '\0';
 
-    // Generate a random Source Connection ID (SCID) for the client.
-    RAND_bytes(s->scid, sizeof(s->scid));
-
-    // Resolve host and port to address information.
-    struct addrinfo *ai_list = NULL;
-    char port_str[6];
-    snprintf(port_str, sizeof(port_str), "%ld", port);
-    if (resolve_host(host_str, port_str, &ai_list) != 0) {
-        efree(s);
-        RETURN_FALSE;
-    }
-
-    struct sockaddr_storage peer_addr;
-    socklen_t peer_addr_len = 0;
-    int selected_family = AF_UNSPEC;
-    int bind_sock = -1;
-    bool connected_successfully = false;
-
-    // --- Happy Eyeballs for IP Family and Interface Binding ---
-    // Extract preferred IP family and interface if specified in options.
+    // Extract the preferred IP family and interface if specified in options.
     zend_string *preferred_ip_family_str = NULL;
-    char *interface_str = NULL;
-    size_t interface_len = 0;
+    const char *interface_str = NULL;
+    zend_string *cc_profile_str = NULL;
+    zend_long he_timeout_ms = quicpro_quic_transport_config.happy_eyeballs_timeout_ms;
 
-    if (options_array && Z_TYPE_P(options_array) == IS_ARRAY) {
-        zval *ip_family_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "preferred_ip_family", sizeof("preferred_ip_family") - 1);
+    if (options) {
+        zval *ip_family_val = zend_hash_str_find(options, "preferred_ip_family", sizeof("preferred_ip_family") - 1);
         if (ip_family_val && Z_TYPE_P(ip_family_val) == IS_STRING) {
             preferred_ip_family_str = Z_STR_P(ip_family_val);
         }
-        zval *iface_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "interface", sizeof("interface") - 1);
-        if (iface_val && Z_TYPE_P(iface_val) == IS_STRING) {
+        zval *iface_val = zend_hash_str_find(options, "interface", sizeof("interface") - 1);
+        if (iface_val && Z_TYPE_P(iface_val) == IS_STRING && Z_STRLEN_P(iface_val) > 0) {
             interface_str = Z_STRVAL_P(iface_val);
-            interface_len = Z_STRLEN_P(iface_val);
         }
-    }
-
-    // Try IPv6 first if not explicitly set to IPv4
-    bool try_ipv6 = !preferred_ip_family_str || zend_string_equals_literal(preferred_ip_family_str, "auto") || zend_string_equals_literal(preferred_ip_family_str, "ipv6");
-    bool try_ipv4 = !preferred_ip_family_str || zend_string_equals_literal(preferred_ip_family_str, "auto") || zend_string_equals_literal(preferred_ip_family_str, "ipv4");
-
-    // Attempt IPv6 connections first, if enabled.
-    if (try_ipv6) {
-        for (struct addrinfo *ai = ai_list; ai != NULL; ai = ai->ai_next) {
-            if (ai->ai_family != AF_INET6) continue;
-
-            bind_sock = udp_socket_nonblock(ai->ai_family);
-            if (bind_sock < 0) continue;
-
-            if (interface_str && interface_len > 0) {
-                if (socket_bind_iface(bind_sock, interface_str) < 0) {
-                    close(bind_sock);
-                    bind_sock = -1;
-                    continue;
-                }
-            }
-
-            if (connect(bind_sock, ai->ai_addr, ai->ai_addrlen) == 0) {
-                memcpy(&peer_addr, ai->ai_addr, ai->ai_addrlen);
-                peer_addr_len = (socklen_t)ai->ai_addrlen;
-                selected_family = AF_INET6;
-                connected_successfully = true;
-                break;
-            }
-            close(bind_sock);
-            bind_sock = -1;
+        zval *cc_val = zend_hash_str_find(options, "cc_profile", sizeof("cc_profile") - 1);
+        if (cc_val && Z_TYPE_P(cc_val) == IS_STRING) {
+            cc_profile_str = Z_STR_P(cc_val);
         }
-    }
-
-    // If no IPv6 connection, or IPv6 explicitly disabled, try IPv4.
-    if (!connected_successfully && try_ipv4) {
-        for (struct addrinfo *ai = ai_list; ai != NULL; ai = ai->ai_next) {
-            if (ai->ai_family != AF_INET) continue;
-
-            bind_sock = udp_socket_nonblock(ai->ai_family);
-            if (bind_sock < 0) continue;
-
-            if (interface_str && interface_len > 0) {
-                if (socket_bind_iface(bind_sock, interface_str) < 0) {
-                    close(bind_sock);
-                    bind_sock = -1;
-                    continue;
-                }
-            }
-
-            if (connect(bind_sock, ai->ai_addr, ai->ai_addrlen) == 0) {
-                memcpy(&peer_addr, ai->ai_addr, ai->ai_addrlen);
-                peer_addr_len = (socklen_t)ai->ai_addrlen;
-                selected_family = AF_INET;
-                connected_successfully = true;
-                break;
-            }
-            close(bind_sock);
-            bind_sock = -1;
+        zval *he_val = zend_hash_str_find(options, "happy_eyeballs_timeout_ms", sizeof("happy_eyeballs_timeout_ms") - 1);
+        if (he_val && Z_TYPE_P(he_val) == IS_LONG && Z_LVAL_P(he_val) > 0) {
+            he_timeout_ms = Z_LVAL_P(he_val);
         }
     }
 
-    // Final check for connection success.
-    if (!connected_successfully) {
-        freeaddrinfo(ai_list);
+    // Per target: e.g. "bulk" for an object store, "interactive" for APIs (server/congestion.h).
+    quicpro_cc_profile_t cc;
+    if (!quicpro_cc_profile_lookup(cc_profile_str ? ZSTR_VAL(cc_profile_str) : NULL,
+                                   cc_profile_str ? ZSTR_LEN(cc_profile_str) : 0, &cc)) {
+        zend_value_error("Unknown cc_profile \"%s\"", ZSTR_VAL(cc_profile_str));
         efree(s);
-        throw_network_exception(0, "Failed to connect UDP socket to host '%s:%ld' using any available IP family. Last system error: %s", host_str, port, strerror(errno));
-        RETURN_FALSE;
+        return NULL;
     }
 
-    s->sock = bind_sock;
-    freeaddrinfo(ai_list);
-
-    // Initialize the QUIC connection using quiche_connect.
-    // This starts the QUIC state machine and initiates the handshake.
-    s->conn = quiche_connect(
-        s->host,
-        s->scid, sizeof(s->scid),
-        NULL, 0,
-        (const struct sockaddr *)&peer_addr,
-        peer_addr_len,
-        cfg_wrapper->quiche_cfg
-    );
+    int family = AF_UNSPEC;
+    if (preferred_ip_family_str && zend_string_equals_literal(preferred_ip_family_str, "ipv6")) {
+        family = AF_INET6;
+    } else if (preferred_ip_family_str && zend_string_equals_literal(preferred_ip_family_str, "ipv4")) {
+        family = AF_INET;
+    }
 
-    if (!s->conn) {
-        close(s->sock);
+    // Resolve (cached per process) and race the addresses, IPv6 and IPv4 interleaved.
+    quicpro_dns_addr_t addrs[QUICPRO_DNS_MAX_ADDRS];
+    int naddrs = quicpro_dns_resolve(s->host, (uint16_t)port, family, addrs, QUICPRO_DNS_MAX_ADDRS);
+    if (naddrs < 0 || happy_eyeballs_connect(s, addrs, naddrs, port, cfg, &cc, interface_str, he_timeout_ms) < 0) {
         efree(s);
-        throw_quic_exception(0, "Failed to create new QUIC connection via quiche_connect. This indicates an invalid configuration or resource exhaustion.");
-        RETURN_FALSE;
+        return NULL;
     }
 
     // Initialize the HTTP/3 layer on top of the QUIC connection.
@@ -312,8 +392,11 @@ PHP_FUNCTION(quicpro_client_session_connect) {
         close(s->sock);
         efree(s);
         throw_quic_exception(0, "Failed to initialize HTTP/3 configuration. System memory exhausted.");
-        RETURN_FALSE;
+        return NULL;
     }
+    quicpro_h3_settings_apply(s->h3_cfg);
+    // WebTransport sessions are extended CONNECT requests (RFC 9220).
+    quiche_h3_config_enable_extended_connect(s->h3_cfg, quicpro_app_protocols_config.webtransport_enable);
     s->h3 = quiche_h3_conn_new_with_transport(s->conn, s->h3_cfg);
     if (!s->h3) {
         quiche_h3_config_free(s->h3_cfg);
@@ -321,11 +404,91 @@ PHP_FUNCTION(quicpro_client_session_connect) {
         close(s->sock);
         efree(s);
         throw_quic_exception(0, "Failed to initialize HTTP/3 connection. This indicates an invalid QUIC connection state or a severe configuration mismatch.");
+        return NULL;
+    }
+
+    return s;
+}
+
+/**
+ * @brief Establishes a new QUIC client session to a specified host and port.
+ *
+ * This PHP function initiates a new QUIC connection. It handles all phases:
+ * DNS resolution, UDP socket creation (non-blocking), binding to a specific
+ * interface if requested, and the initial `quiche_connect` call. It ensures
+ * that the underlying `quiche` configuration is applied, which includes TLS
+ * settings, QUIC transport parameters, and performance tuning options.
+ *
+ * Addresses come from the cached stub resolver (include/client/dns.h) and are
+ * raced Happy Eyeballs style (RFC 8305): the first address whose server
+ * answers the initial flight wins, IPv6 and IPv4 interleaved.
+ * NUMA node affinity is applied for performance optimization if specified.
+ *
+ * @param host_str The target hostname or IP address of the QUIC server.
+ * @param host_len The length of `host_str`.
+ * @param port The target UDP port number.
+ * @param config_resource A PHP resource representing a `Quicpro\Config` object. This
+ * resource provides comprehensive configuration settings for the QUIC session.
+ * @param numa_node An optional NUMA node ID (`int`) for hinting memory allocation
+ * and CPU affinity. Pass -1 for automatic/default behavior.
+ * @param options_array Optional PHP array containing connection-specific options
+ * like `preferred_ip_family` (ipv4, ipv6, auto) or `interface`, and `pool`
+ * (bool): take a warm connection from the per-worker pool (include/client/pool.h)
+ * when one is free, and pool the new connection otherwise. `cc_profile`
+ * (string) picks the congestion controller for this target, see
+ * include/server/congestion.h. `happy_eyeballs_timeout_ms` (int) overrides
+ * `quicpro.transport_happy_eyeballs_timeout_ms` for this connect.
+ * @return A PHP resource of type `Quicpro\Session` on success. Returns FALSE on failure,
+ * throwing appropriate `Quicpro\Exception` subclasses (e.g., `QuicException`, `TlsException`,
+ * `NetworkException`) for detailed error reporting.
+ */
+PHP_FUNCTION(quicpro_client_session_connect) {
+    char *host_str;
+    size_t host_len;
+    zend_long port;
+    zval *z_config_res;
+    zend_long numa_node = -1;
+    zval *options_array = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(3, 5)
+        Z_PARAM_STRING(host_str, host_len)
+        Z_PARAM_LONG(port)
+        Z_PARAM_RESOURCE(z_config_res)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(numa_node)
+        Z_PARAM_ARRAY_OR_NULL(options_array)
+    ZEND_PARSE_PARAMETERS_END();
+
+    // Fetch the global Quicpro configuration object.
+    quicpro_cfg_t *cfg_wrapper = (quicpro_cfg_t *)zend_fetch_resource_ex(z_config_res, "Quicpro\\Config", le_quicpro_cfg);
+    if (!cfg_wrapper || cfg_wrapper->quiche_cfg == NULL) {
+        throw_config_exception(0, "Invalid or uninitialized Quicpro\\Config resource provided.");
+        RETURN_FALSE;
+    }
+
+    HashTable *options = options_array && Z_TYPE_P(options_array) == IS_ARRAY ? Z_ARRVAL_P(options_array) : NULL;
+    zval *pool_val = options ? zend_hash_str_find(options, "pool", sizeof("pool") - 1) : NULL;
+    bool pooled = quicpro_quic_transport_config.client_pool_enable && pool_val && zend_is_true(pool_val);
+    quicpro_pool_key_t key = { host_str, host_len, port, "h3", cfg_wrapper };
+
+    if (pooled) {
+        zend_resource *warm = quicpro_client_pool_checkout(&key, (uint32_t)quicpro_quic_transport_config.client_pool_max_streams_per_conn);
+        if (warm) {
+            RETURN_RES(warm);
+        }
+    }
+
+    quicpro_session_t *s = quicpro_client_session_open(host_str, host_len, port, cfg_wrapper, (int)numa_node, options);
+    if (!s) {
         RETURN_FALSE;
     }
 
     // Register the session as a PHP resource.
-    RETURN_RES(zend_register_resource(s, le_quicpro_session));
+    s->resource = zend_register_resource(s, le_quicpro_session);
+    if (pooled) {
+        quicpro_client_pool_add(&key, s);
+    }
+    RETURN_RES(s->resource);
 }
 
 /**
@@ -333,9 +496,10 @@ PHP_FUNCTION(quicpro_client_session_connect) {
  *
  * This PHP function is critical for the continuous operation of any active QUIC session.
  * It performs a multitude of tasks necessary for connection liveness and data transfer:
- * 1.  **Reads Incoming Packets:** It continuously attempts to read pending UDP packets
- * from the session's socket. Each received packet is then fed into the `quiche_conn`
- * state machine for decryption and processing.
+ * 1.  **Reads Incoming Packets:** It drains pending UDP packets from the session's
+ * socket in `recvmmsg()` batches (see `quicpro.io_max_batch_read_packets`). Each
+ * received packet is then fed into the `quiche_conn` state machine for decryption
+ * and processing.
  * 2.  **Processes Internal Timers:** The QUIC protocol relies heavily on internal timers
  * for managing retransmissions, keep-alives, and various protocol timeouts. This
  * function ensures these timers are advanced and acted upon.
@@ -343,7 +507,8 @@ PHP_FUNCTION(quicpro_client_session_connect) {
  * (e.g., new data to send, ACKs to acknowledge received packets, retransmissions),
  * it generates outgoing QUIC packets.
  * 4.  **Writes Outgoing Packets:** These generated packets are then written to the
- * UDP socket for transmission over the network.
+ * UDP socket in `sendmmsg()` bursts (see `quicpro.io_max_batch_write_packets`),
+ * using UDP GSO to coalesce same-destination packets where available.
  * 5.  **Advances QUIC Clock:** The `advance_us` parameter (or system time if 0) is used
  * to advance the `quiche_conn`'s internal monotonic clock, which is vital for
  * accurate RTT estimation and timer management.
@@ -368,14 +533,6 @@ PHP_FUNCTION(quicpro_client_session_tick) {
     zval *z_sess_res;
     zend_long advance_us;
     quicpro_session_t *s;
-    ssize_t read_len;
-    ssize_t written_len;
-    uint8_t recv_buf[QUICPRO_MAX_PACKET_SIZE];
-    uint8_t send_buf[QUICPRO_MAX_PACKET_SIZE];
-    struct sockaddr_storage peer_addr;
-    struct iovec iov = { .iov_base = recv_buf, .iov_len = sizeof(recv_buf) };
-    char cmsg_buf[512];
-    
     ZEND_PARSE_PARAMETERS_START(2, 2)
         Z_PARAM_RESOURCE(z_sess_res)
         Z_PARAM_LONG(advance_us)
@@ -386,57 +543,55 @@ PHP_FUNCTION(quicpro_client_session_tick) {
         RETURN_FALSE;
     }
 
-    // 1. Read incoming UDP packets from the socket
-    // Continuously read until no more packets are immediately available (EAGAIN/EWOULDBLOCK).
-    while (true) {
-        struct msghdr msg = {
-            .msg_name       = &peer_addr,
-            .msg_namelen    = sizeof(peer_addr),
-            .msg_iov        = &iov,
-            .msg_iovlen     = 1,
-            .msg_control    = cmsg_buf,
-            .msg_controllen = sizeof(cmsg_buf),
-        };
-
-        read_len = recvmsg(s->sock, &msg, MSG_DONTWAIT);
-        if (read_len < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                break; // No more packets available for non-blocking read.
-            }
-            throw_network_exception(errno, "Failed to read UDP packet from socket: %s", strerror(errno));
+    // 1. Read incoming UDP packets from the socket in batches.
+    // Each recvmmsg() call drains up to `quicpro.io_max_batch_read_packets` datagrams;
+    // keep going until a short batch tells us the socket queue is empty.
+    // With `quicpro.io_engine_use_uring` the io_uring engine has already received the
+    // datagrams into its buffer ring; reaping the completions costs no syscall.
+    if (quicpro_session_uring(s)) {
+        if (quicpro_uring_session_recv(s) < 0) {
+            throw_network_exception(errno, "Failed to read UDP packets via io_uring: %s", strerror(errno));
             RETVAL_FALSE;
             goto cleanup_and_return;
         }
-        if (read_len == 0) {
-            break; // Peer performed an orderly shutdown, or connection closed (rare for UDP).
-        }
-
-        quiche_recv_info recv_info = {
-            .from = (struct sockaddr *)&peer_addr,
-            .from_len = msg.msg_namelen,
-            .to = NULL,
-            .to_len = 0
-        };
+    } else {
+        quicpro_udp_rx_batch_t *rx = quicpro_session_rx_batch(s);
+        while (true) {
+            int received = quicpro_udp_recv_batch(s->sock, rx);
+            if (received < 0) {
+                throw_network_exception(errno, "Failed to read UDP packets from socket: %s", strerror(errno));
+                RETVAL_FALSE;
+                goto cleanup_and_return;
+            }
 
-        ssize_t quiche_ret = quiche_conn_recv(s->conn, recv_buf, read_len, &recv_info);
-        if (quiche_ret < 0) {
-            if (quiche_ret != QUICHE_ERR_DONE) { // QUICHE_ERR_DONE is not a hard error, means packet was processed but no bytes consumed (e.g., duplicate).
+            // Feed every datagram into quiche. GRO-coalesced slots are split at their
+            // UDP_GRO segment size so quiche always sees exactly one QUIC datagram per call.
+            ssize_t quiche_ret = 0;
+            quicpro_udp_rx_deliver(s->conn, rx, received, s->ts_enabled ? &s->last_rx_ts : NULL, &quiche_ret);
+            if (quiche_ret < 0) {
                 // Log detailed information for debugging purposes. This indicates a potentially malformed
                 // or unexpected packet that quiche could not process.
                 php_error_docref(NULL, E_NOTICE, "quiche_conn_recv failed for incoming packet: %s (Error Code: %zd)", quiche_error_t_to_string((int)quiche_ret), quiche_ret);
             }
-        }
-        
-        if (s->ts_enabled) {
-            for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
-                if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_TIMESTAMPING_NEW) {
-                    memcpy(&s->last_rx_ts, CMSG_DATA(cm), sizeof(struct timespec));
-                    break;
-                }
+
+            if ((unsigned)received < rx->capacity) {
+                break; // Socket queue drained (or nothing was pending).
             }
         }
     }
 
+    // Paths added over further interfaces have sockets of their own (client/multipath.h).
+    if (s->mp) {
+        quicpro_mp_pump_rx(s);
+    }
+
+    // Harvest kernel TX timestamps from the socket error queue (send latency, NIC RTT).
+    // Reports left unread would pin socket memory and keep the socket in EPOLLERR.
+    if (s->txstamp) {
+        quicpro_txstamp_note_rx(s);
+        quicpro_txstamp_drain(s);
+    }
+
     // 2. Advance the QUIC connection's internal clock and process timers.
     quiche_conn_on_timeout(s->conn);
 
@@ -447,36 +602,50 @@ PHP_FUNCTION(quicpro_client_session_tick) {
     }
 
     // 3. Generate and Write Outgoing QUIC Packets
-    while (true) {
-        quiche_send_info send_info;
-        ssize_t send_len = quiche_conn_send(s->conn, send_buf, sizeof(send_buf), &send_info);
-
-        if (send_len == QUICHE_ERR_DONE) {
-            break; // No more outgoing packets ready at this moment.
-        }
-        if (send_len < 0) {
-            throw_quic_exception((int)send_len, "Failed to generate outgoing QUIC packet: %s", quiche_error_t_to_string((int)send_len));
+    // Packets are staged in bursts of up to `quicpro.io_max_batch_write_packets` and
+    // submitted with a single sendmmsg(), coalesced via UDP GSO when the kernel supports it.
+    // With extra paths, each packet goes out on the socket of the path quiche chose for it.
+    if (s->mp) {
+        int flushed = quicpro_mp_flush(s);
+        if (flushed < 0) {
+            throw_quic_exception(flushed, "Failed to generate outgoing QUIC packet: %s", quiche_error_t_to_string(flushed));
             RETVAL_FALSE;
             goto cleanup_and_return;
         }
-
-        written_len = sendto(s->sock, send_buf, (size_t)send_len, 0,
-                             (const struct sockaddr *)&send_info.to, send_info.to_len);
-        if (written_len < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                break; // Socket is temporarily full; try again later.
-            }
-            throw_network_exception(errno, "Failed to send UDP packet: %s", strerror(errno));
-            RETVAL_FALSE;
-            goto cleanup_and_return;
+    } else if (s->uring) {
+        int queued = quicpro_uring_flush_quiche(s->uring, s->conn);
+        if (queued > 0) {
+            quicpro_txstamp_on_send(s, (unsigned)queued);
         }
-        if (written_len != send_len) {
-            // This indicates a partial send, which should ideally not happen for UDP datagrams.
-            // If it does, it's a critical network layer issue.
-            throw_network_exception(0, "Partial UDP packet send. Expected %zd bytes, sent %zd bytes. This indicates a serious network stack issue.", send_len, written_len);
+        if (queued < 0 && queued != QUICHE_ERR_DONE) {
+            throw_quic_exception(queued, "Failed to generate outgoing QUIC packet: %s", quiche_error_t_to_string(queued));
             RETVAL_FALSE;
             goto cleanup_and_return;
         }
+    } else {
+        quicpro_udp_tx_batch_t *tx = quicpro_session_tx_batch(s);
+        while (true) {
+            int staged = quicpro_udp_tx_batch_fill(s->conn, tx);
+            if (staged == 0) {
+                break; // No more outgoing packets ready at this moment.
+            }
+            if (staged < 0) {
+                throw_quic_exception(staged, "Failed to generate outgoing QUIC packet: %s", quiche_error_t_to_string(staged));
+                RETVAL_FALSE;
+                goto cleanup_and_return;
+            }
+
+            int sent = quicpro_udp_send_batch(s->sock, tx, &s->gso_state);
+            quicpro_txstamp_on_send(s, tx->last_msgs);
+            if (sent < 0) {
+                throw_network_exception(errno, "Failed to send UDP packets: %s", strerror(errno));
+                RETVAL_FALSE;
+                goto cleanup_and_return;
+            }
+            if (sent < staged || (unsigned)staged < tx->capacity) {
+                break; // Socket buffer full (EAGAIN) or quiche drained; try again on the next tick.
+            }
+        }
     }
 
     // Check if the QUIC connection is still active (not closed or draining).
@@ -780,6 +949,10 @@ PHP_FUNCTION(quicpro_client_session_is_established) {
  * socket option. These timestamps are invaluable for accurate Round-Trip Time (RTT)
  * estimation in congestion control algorithms and for detailed network diagnostics.
  *
+ * TX timestamps (qdisc, driver and NIC) are enabled as well; `quicpro_client_session_tick()`
+ * drains them from the socket error queue into per-session latency histograms that
+ * `quicpro_get_stats()` reports under `tx_timestamps`.
+ *
  * The function sets the `ts_enabled` flag in the session struct to prevent redundant
  * `setsockopt` calls. This feature is only available on Linux systems with kernel
  * support.
@@ -808,11 +981,8 @@ PHP_FUNCTION(quicpro_client_session_enable_kernel_timestamps) {
         RETURN_TRUE;
     }
 
-    int flags = SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE |
-                SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
-
-    if (setsockopt(s->sock, SOL_SOCKET, SO_TIMESTAMPING_NEW, &flags, sizeof(flags)) == 0) {
-        s->ts_enabled = 1;
+    // RX stamps plus TX reports numbered per sendmsg(); the tick loop harvests the latter.
+    if (quicpro_txstamp_enable(s) == 0) {
         RETURN_TRUE;
     } else {
         throw_network_exception(errno, "Failed to enable kernel timestamping on socket: %s", strerror(errno));
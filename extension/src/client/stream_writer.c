@@ -0,0 +1,127 @@
+#include "php_quicpro.h"
+#include "client/stream_writer.h"
+#include "poll/poll.h"
+#include "poll/scheduler.h"
+
+#include <quiche.h>
+
+/**
+ * @file extension/src/client/stream_writer.c
+ * @brief Back-pressured stream writes, see client/stream_writer.h.
+ */
+
+extern int le_quicpro;           /* quicpro_connect() sessions */
+extern int le_quicpro_session;   /* quicpro_client_session_connect() and server sessions */
+
+/*───────────────────────────── Helpers ───────────────────────────────────*/
+
+static quicpro_session_t *sw_fetch_session(zval *z_sess, zend_long stream_id) {
+    quicpro_session_t *s = (quicpro_session_t *)zend_fetch_resource2_ex(z_sess, "Quicpro\\Session", le_quicpro, le_quicpro_session);
+    if (!s) {
+        return NULL;
+    }
+    if (!s->conn || s->is_closed) {
+        throw_quic_exception(0, "Session is closed");
+        return NULL;
+    }
+    if (stream_id < 0) {
+        zend_argument_value_error(2, "must be a stream ID");
+        return NULL;
+    }
+    return s;
+}
+
+/*
+ * Queues what fits: the body of an HTTP/3 stream, or raw stream data.
+ * Returns the bytes taken, 0 while the stream is blocked, or a quiche
+ * error.
+ */
+static ssize_t sw_send(quicpro_session_t *s, uint64_t stream_id, const char *data, size_t len, bool fin) {
+    ssize_t n;
+    if (s->h3) {
+        n = quiche_h3_send_body(s->h3, s->conn, stream_id, (uint8_t *)data, len, fin);
+        return n == QUICHE_H3_ERR_DONE ? 0 : n;
+    }
+    uint64_t ec = 0;
+    n = quiche_conn_stream_send(s->conn, stream_id, (const uint8_t *)data, len, fin, &ec);
+    return n == QUICHE_ERR_DONE ? 0 : n;
+}
+
+/*─────────────────────────── PHP functions ───────────────────────────────*/
+
+/* {{{ quicpro_stream_capacity(resource $session, int $streamId): int */
+PHP_FUNCTION(quicpro_stream_capacity)
+{
+    zval *z_sess;
+    zend_long stream_id;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_RESOURCE(z_sess)
+        Z_PARAM_LONG(stream_id)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = sw_fetch_session(z_sess, stream_id);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    if (quicpro_sched_owns_io(s)) {
+        quicpro_session_pump_rx(s);     /* Window updates that already arrived */
+    }
+    ssize_t cap = quiche_conn_stream_capacity(s->conn, (uint64_t)stream_id);
+    if (cap < 0) {
+        throw_quic_exception((int)cap, "Stream " ZEND_LONG_FMT " takes no more data (quiche error %d)", stream_id, (int)cap);
+        RETURN_THROWS();
+    }
+    RETURN_LONG((zend_long)cap);
+}
+/* }}} */
+
+/* {{{ quicpro_stream_write(resource $session, int $streamId, string $data, bool $fin = false, int $timeout_ms = -1): int */
+PHP_FUNCTION(quicpro_stream_write)
+{
+    zval *z_sess;
+    zend_long stream_id;
+    zend_string *data;
+    bool fin = false;
+    zend_long timeout_ms = -1;
+
+    ZEND_PARSE_PARAMETERS_START(3, 5)
+        Z_PARAM_RESOURCE(z_sess)
+        Z_PARAM_LONG(stream_id)
+        Z_PARAM_STR(data)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_BOOL(fin)
+        Z_PARAM_LONG(timeout_ms)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = sw_fetch_session(z_sess, stream_id);
+    if (!s) {
+        RETURN_THROWS();
+    }
+
+    zend_long start = quicpro_sched_clock_ms();
+    ssize_t n;
+    for (;;) {
+        n = sw_send(s, (uint64_t)stream_id, ZSTR_VAL(data), ZSTR_LEN(data), fin);
+        if (n != 0 || ZSTR_LEN(data) == 0) {
+            break;
+        }
+        /* Blocked: send what is queued, so the peer acknowledges and grants more */
+        quicpro_sched_pump_tx(s);
+        int rc = quicpro_sched_wait_conn(s, Z_RES_P(z_sess), start, timeout_ms, "stream capacity");
+        if (rc < 0) {
+            RETURN_THROWS();
+        }
+        if (rc == 0) {
+            RETURN_LONG(0);
+        }
+        quicpro_sched_pump_rx(s);       /* The window updates we waited for */
+    }
+    if (n < 0) {
+        throw_quic_exception((int)n, "Failed to write to stream " ZEND_LONG_FMT " (quiche error %d)", stream_id, (int)n);
+        RETURN_THROWS();
+    }
+    quicpro_sched_pump_tx(s);
+    RETURN_LONG((zend_long)n);
+}
+/* }}} */
@@ -0,0 +1,150 @@
+/*
+ * ticket_cache.c  –  Automatic TLS session cache for php-quicpro clients
+ * ----------------------------------------------------------------------
+ *
+ * The table is a cluster/shm_cache.h slot table; a session expires
+ * QP_SESSION_MAX_AGE_SEC after it was stored.
+ */
+
+#include "php_quicpro.h"
+#include "client/ticket_cache.h"
+#include "cluster/shm_cache.h"
+#include "config/tls_and_crypto/base_layer.h"
+
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define QP_SESSION_MAX_AGE_SEC  (7 * 24 * 3600)
+
+typedef struct {
+    quicpro_shm_cache_slot_t head;      /* Key: hash of "host:port" */
+    uint16_t    name_len;
+    uint16_t    len;
+    char        name[QUICPRO_MAX_HOST_LEN + 8];
+    uint8_t     session[QUICPRO_CLIENT_SESSION_MAX];
+} quicpro_session_slot_t;
+
+static quicpro_shm_cache_t quicpro_session_table;
+
+static bool quicpro_session_map(int flags)
+{
+    return quicpro_shm_cache_map(&quicpro_session_table, (size_t)quicpro_tls_crypto_config.tls_client_session_cache_size,
+                                 sizeof(quicpro_session_slot_t), flags);
+}
+
+static bool quicpro_session_ready(void)
+{
+    if (!quicpro_tls_crypto_config.tls_client_session_cache_enable) {
+        return false;
+    }
+    if (!quicpro_session_table.slots && !quicpro_session_map(MAP_PRIVATE)) {
+        return false;
+    }
+    return true;
+}
+
+static size_t quicpro_session_key_name(char *buf, size_t cap, const char *host, zend_long port)
+{
+    int n = snprintf(buf, cap, "%s:%ld", host, (long)port);
+    return n < 0 ? 0 : MIN((size_t)n, cap - 1);
+}
+
+/*──────────────────────────── Lifecycle ──────────────────────────────────*/
+
+void quicpro_client_ticket_cache_prepare(void)
+{
+    if (quicpro_session_table.slots || !quicpro_tls_crypto_config.tls_client_session_cache_enable
+        || !quicpro_tls_crypto_config.tls_client_session_cache_shared) {
+        return;
+    }
+    if (!quicpro_session_map(MAP_SHARED)) {
+        php_error_docref(NULL, E_WARNING, "Shared client session cache unavailable; every worker falls back to its own");
+    }
+}
+
+void quicpro_client_ticket_cache_release(void)
+{
+    quicpro_shm_cache_unmap(&quicpro_session_table);
+}
+
+/*──────────────────────────── Lookup / store ─────────────────────────────*/
+
+size_t quicpro_client_ticket_cache_get(const char *host, zend_long port, uint8_t *out, size_t cap)
+{
+    char name[QUICPRO_MAX_HOST_LEN + 8];
+    size_t name_len;
+    uint64_t key;
+
+    if (!quicpro_session_ready()) {
+        return 0;
+    }
+    name_len = quicpro_session_key_name(name, sizeof(name), host, port);
+    key = zend_inline_hash_func(name, name_len) | 1;
+
+    uint64_t now = quicpro_shm_cache_now_ms();
+    for (size_t way = 0; way < 2; way++) {
+        quicpro_session_slot_t *slot = (quicpro_session_slot_t *)quicpro_shm_cache_find(&quicpro_session_table, key, way);
+        if (!slot) {
+            continue;
+        }
+        size_t len = 0;
+        if (quicpro_shm_cache_live(&slot->head, key, now) && slot->name_len == name_len
+            && memcmp(slot->name, name, name_len) == 0 && slot->len <= cap) {
+            len = slot->len;
+            memcpy(out, slot->session, len);
+        }
+        quicpro_shm_cache_unlock(&slot->head);
+        if (len) {
+            return len;
+        }
+    }
+    return 0;
+}
+
+void quicpro_client_ticket_cache_put(const char *host, zend_long port, const uint8_t *session, size_t len)
+{
+    char name[QUICPRO_MAX_HOST_LEN + 8];
+    size_t name_len;
+    uint64_t key;
+
+    if (len == 0 || len > QUICPRO_CLIENT_SESSION_MAX || !quicpro_session_ready()) {
+        return;
+    }
+    name_len = quicpro_session_key_name(name, sizeof(name), host, port);
+    key = zend_inline_hash_func(name, name_len) | 1;
+
+    uint64_t now = quicpro_shm_cache_now_ms();
+    quicpro_session_slot_t *slot = (quicpro_session_slot_t *)quicpro_shm_cache_claim(&quicpro_session_table, key, now);
+    if (!slot) {
+        return;
+    }
+    quicpro_shm_cache_set(&slot->head, key, now + (uint64_t)QP_SESSION_MAX_AGE_SEC * 1000);
+    slot->name_len = (uint16_t)name_len;
+    memcpy(slot->name, name, name_len);
+    slot->len = (uint16_t)len;
+    memcpy(slot->session, session, len);
+    quicpro_shm_cache_unlock(&slot->head);
+}
+
+void quicpro_client_ticket_cache_capture(quicpro_session_t *s)
+{
+    const uint8_t *session = NULL;
+    size_t len = 0;
+
+    if (!s->conn || !quiche_conn_is_established(s->conn)) {
+        return;
+    }
+    /* quiche only has a session once a NewSessionTicket arrived */
+    quiche_conn_session(s->conn, &session, &len);
+    if (!session || len == 0) {
+        return;
+    }
+
+    zend_long port = s->peer_addr.ss_family == AF_INET6
+        ? ntohs(((struct sockaddr_in6 *)&s->peer_addr)->sin6_port)
+        : ntohs(((struct sockaddr_in *)&s->peer_addr)->sin_port);
+    quicpro_client_ticket_cache_put(s->host, port, session, len);
+    s->ticket_cache_pending = false;
+}
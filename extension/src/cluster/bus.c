@@ -0,0 +1,482 @@
+/*
+ * src/cluster/bus.c – Inter-worker message bus for Quicpro\Cluster
+ * ================================================================
+ *
+ * See include/cluster/bus.h. Region layout: a one-cache-line header, one
+ * cache line per endpoint holding its `waiting` flag, the endpoint each
+ * slot currently receives on, then (2 * nslots)^2 rings, ring
+ * [to * E + from] for E endpoints. Each ring has a header (head and tail
+ * on their own cache lines) and `cap` data bytes. head and tail are byte
+ * positions that only grow; only the receiver stores head and only the
+ * sender stores tail.
+ *
+ * Record: u32 length, u32 sender slot, then the payload, padded to 8
+ * bytes. A record never wraps. When it would not fit before the end, the
+ * sender writes a length of QP_BUS_WRAP, which tells the receiver to skip
+ * to offset 0.
+ *
+ * Wakeups: only `waiting` and an eventfd per endpoint leave user space.
+ * The receiver sets `waiting` and checks its rings once more before it
+ * polls. The sender reads `waiting` after it publishes its tail. With a
+ * full fence on both sides, either the receiver sees the record or the
+ * sender sees the flag.
+ *
+ * With a lazy mapping (MAP_NORESERVE), a ring only costs pages once a
+ * pair of workers has used it.
+ */
+
+#include "php_quicpro.h"
+#include "cluster/bus.h"
+#include "cancel.h"
+#include "iibin_internal.h"     /* Schema-encoded payloads */
+#include "zend_smart_str.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define QP_BUS_MAGIC        UINT64_C(0x3153554250505051)    /* "QPPBUS1", little-endian */
+#define QP_BUS_NONE         UINT32_MAX                      /* current_ep[] of a slot nobody receives on */
+#define QP_BUS_WRAP         UINT32_MAX                      /* Record length: continue at offset 0 */
+#define QP_BUS_MIN_RING     4096
+#define QP_BUS_MAX_RING     (1u << 30)
+
+typedef struct {
+    _Alignas(64) uint64_t magic;
+    uint32_t nslots;
+    uint32_t nendpoints;        /* 2 * nslots: one per slot and generation parity */
+    uint32_t ring_cap;          /* Power of two */
+} quicpro_bus_header_t;
+
+typedef struct {
+    _Alignas(64) _Atomic uint32_t waiting;  /* Receiver is (about to be) asleep on its eventfd */
+} quicpro_bus_endpoint_t;
+
+typedef struct {
+    _Alignas(64) _Atomic uint64_t head;     /* Receiver's read position */
+    _Alignas(64) _Atomic uint64_t tail;     /* Sender's write position */
+} quicpro_bus_ring_t;
+
+typedef struct {
+    uint32_t len;
+    uint32_t from_slot;
+} quicpro_bus_record_t;
+
+static quicpro_bus_header_t   *quicpro_bus_seg = NULL;
+static size_t                  quicpro_bus_seg_size;
+static quicpro_bus_endpoint_t *quicpro_bus_endpoints;
+static _Atomic uint32_t       *quicpro_bus_current;     /* [nslots] */
+static unsigned char          *quicpro_bus_rings;
+static size_t                  quicpro_bus_ring_stride;
+static int                    *quicpro_bus_efds = NULL; /* [nendpoints], inherited */
+
+/* This worker's slot and endpoint; -1 outside a worker */
+static int quicpro_bus_self_slot = -1;
+static int quicpro_bus_self_ep = -1;
+
+static inline size_t quicpro_bus_align8(size_t n)
+{
+    return (n + 7) & ~(size_t)7;
+}
+
+static inline quicpro_bus_ring_t *quicpro_bus_ring(uint32_t to_ep, uint32_t from_ep)
+{
+    return (quicpro_bus_ring_t *)(quicpro_bus_rings + ((size_t)to_ep * quicpro_bus_seg->nendpoints + from_ep) * quicpro_bus_ring_stride);
+}
+
+static inline unsigned char *quicpro_bus_ring_data(quicpro_bus_ring_t *ring)
+{
+    return (unsigned char *)ring + sizeof(*ring);
+}
+
+static inline size_t quicpro_bus_max_payload(void)
+{
+    return quicpro_bus_seg->ring_cap / 4 - sizeof(quicpro_bus_record_t);
+}
+
+int quicpro_cluster_bus_prepare(int nslots, size_t ring_bytes)
+{
+    if (quicpro_bus_seg || nslots <= 0) {
+        return SUCCESS;
+    }
+
+    uint32_t cap = QP_BUS_MIN_RING;
+    while (cap < ring_bytes && cap < QP_BUS_MAX_RING) {
+        cap <<= 1;
+    }
+    uint32_t nendpoints = 2 * (uint32_t)nslots;
+    size_t endpoints_size = (size_t)nendpoints * sizeof(quicpro_bus_endpoint_t);
+    size_t current_size = (((size_t)nslots * sizeof(uint32_t)) + 63) & ~(size_t)63;
+    size_t stride = sizeof(quicpro_bus_ring_t) + cap;
+    size_t nrings = (size_t)nendpoints * nendpoints;
+    if (nrings > (SIZE_MAX - sizeof(quicpro_bus_header_t) - endpoints_size - current_size) / stride) {
+        php_error_docref(NULL, E_WARNING, "Cluster message bus: %u slots of %u-byte rings do not fit the address space", (unsigned)nslots, cap);
+        return FAILURE;
+    }
+    size_t size = sizeof(quicpro_bus_header_t) + endpoints_size + current_size + nrings * stride;
+
+    void *seg = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (seg == MAP_FAILED) {
+        php_error_docref(NULL, E_WARNING, "Cluster message bus: cannot map %zu bytes: %s", size, strerror(errno));
+        return FAILURE;
+    }
+
+    int *efds = safe_pemalloc(nendpoints, sizeof(int), 0, 1);
+    for (uint32_t i = 0; i < nendpoints; ++i) {
+        efds[i] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (efds[i] < 0) {
+            php_error_docref(NULL, E_WARNING, "Cluster message bus: eventfd: %s", strerror(errno));
+            while (i-- > 0) close(efds[i]);
+            pefree(efds, 1);
+            munmap(seg, size);
+            return FAILURE;
+        }
+    }
+
+    quicpro_bus_seg = seg;
+    quicpro_bus_seg_size = size;
+    quicpro_bus_endpoints = (quicpro_bus_endpoint_t *)((unsigned char *)seg + sizeof(quicpro_bus_header_t));
+    quicpro_bus_current = (_Atomic uint32_t *)((unsigned char *)quicpro_bus_endpoints + endpoints_size);
+    quicpro_bus_rings = (unsigned char *)quicpro_bus_current + current_size;
+    quicpro_bus_ring_stride = stride;
+    quicpro_bus_efds = efds;
+
+    quicpro_bus_seg->nslots = (uint32_t)nslots;
+    quicpro_bus_seg->nendpoints = nendpoints;
+    quicpro_bus_seg->ring_cap = cap;
+    for (int i = 0; i < nslots; ++i) {
+        atomic_init(&quicpro_bus_current[i], QP_BUS_NONE);
+    }
+    quicpro_bus_seg->magic = QP_BUS_MAGIC;
+    return SUCCESS;
+}
+
+void quicpro_cluster_bus_release(void)
+{
+    if (!quicpro_bus_seg) {
+        return;
+    }
+    for (uint32_t i = 0; i < quicpro_bus_seg->nendpoints; ++i) {
+        close(quicpro_bus_efds[i]);
+    }
+    pefree(quicpro_bus_efds, 1);
+    quicpro_bus_efds = NULL;
+    munmap(quicpro_bus_seg, quicpro_bus_seg_size);
+    quicpro_bus_seg = NULL;
+    quicpro_bus_self_slot = quicpro_bus_self_ep = -1;
+}
+
+void quicpro_cluster_bus_attach_worker(int worker_id, unsigned generation)
+{
+    if (!quicpro_bus_seg || worker_id < 0 || (uint32_t)worker_id >= quicpro_bus_seg->nslots) {
+        return;
+    }
+    uint32_t ep = (uint32_t)worker_id + (generation & 1) * quicpro_bus_seg->nslots;
+
+    /*
+     * A restarted worker takes over its predecessor's endpoint. What was
+     * queued for that one is dropped rather than handled out of context.
+     */
+    for (uint32_t from = 0; from < quicpro_bus_seg->nendpoints; ++from) {
+        quicpro_bus_ring_t *ring = quicpro_bus_ring(ep, from);
+        atomic_store_explicit(&ring->head, atomic_load_explicit(&ring->tail, memory_order_acquire), memory_order_release);
+    }
+    uint64_t stale;
+    ssize_t ignored = read(quicpro_bus_efds[ep], &stale, sizeof(stale));
+    (void)ignored;
+    atomic_store_explicit(&quicpro_bus_endpoints[ep].waiting, 0, memory_order_relaxed);
+
+    quicpro_bus_self_slot = worker_id;
+    quicpro_bus_self_ep = (int)ep;
+    /* From now on new messages for this slot come here, not to a draining predecessor */
+    atomic_store_explicit(&quicpro_bus_current[worker_id], ep, memory_order_release);
+}
+
+void quicpro_cluster_bus_retire(int worker_id)
+{
+    if (quicpro_bus_seg && worker_id >= 0 && (uint32_t)worker_id < quicpro_bus_seg->nslots) {
+        atomic_store_explicit(&quicpro_bus_current[worker_id], QP_BUS_NONE, memory_order_release);
+    }
+}
+
+/* Copies one record into ring `to_ep` <- self; false if the slot has no receiver or the ring is full */
+static zend_bool quicpro_bus_push(uint32_t to_slot, const char *payload, size_t len)
+{
+    uint32_t to_ep = atomic_load_explicit(&quicpro_bus_current[to_slot], memory_order_acquire);
+    if (to_ep == QP_BUS_NONE) {
+        return 0;
+    }
+    quicpro_bus_ring_t *ring = quicpro_bus_ring(to_ep, (uint32_t)quicpro_bus_self_ep);
+    unsigned char *data = quicpro_bus_ring_data(ring);
+    uint64_t cap = quicpro_bus_seg->ring_cap;
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    uint64_t need = sizeof(quicpro_bus_record_t) + quicpro_bus_align8(len);
+    uint64_t off = tail & (cap - 1);
+    uint64_t pad = off + need > cap ? cap - off : 0;
+    if (cap - (tail - head) < pad + need) {
+        return 0;
+    }
+    if (pad) {
+        ((quicpro_bus_record_t *)(data + off))->len = QP_BUS_WRAP;
+        tail += pad;
+        off = 0;
+    }
+    quicpro_bus_record_t *rec = (quicpro_bus_record_t *)(data + off);
+    rec->len = (uint32_t)len;
+    rec->from_slot = (uint32_t)quicpro_bus_self_slot;
+    memcpy(rec + 1, payload, len);
+    atomic_store_explicit(&ring->tail, tail + need, memory_order_release);
+
+    /* Pairs with the fence in quicpro_bus_wait(): either it sees the record or we see it waiting */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&quicpro_bus_endpoints[to_ep].waiting, memory_order_relaxed)) {
+        uint64_t one = 1;
+        ssize_t ignored = write(quicpro_bus_efds[to_ep], &one, sizeof(one));
+        (void)ignored;
+    }
+    return 1;
+}
+
+/* True if any ring into this worker holds a record */
+static zend_bool quicpro_bus_pending(void)
+{
+    for (uint32_t from = 0; from < quicpro_bus_seg->nendpoints; ++from) {
+        quicpro_bus_ring_t *ring = quicpro_bus_ring((uint32_t)quicpro_bus_self_ep, from);
+        if (atomic_load_explicit(&ring->tail, memory_order_acquire) != atomic_load_explicit(&ring->head, memory_order_relaxed)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Sleeps on this worker's eventfd until a record may have arrived or `timeout_ms` (-1: none) passed */
+static void quicpro_bus_wait(int timeout_ms)
+{
+    quicpro_bus_endpoint_t *self = &quicpro_bus_endpoints[quicpro_bus_self_ep];
+    atomic_store_explicit(&self->waiting, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!quicpro_bus_pending()) {
+        struct pollfd pfd = { .fd = quicpro_bus_efds[quicpro_bus_self_ep], .events = POLLIN };
+        if (poll(&pfd, 1, timeout_ms) > 0) {
+            uint64_t count;
+            ssize_t ignored = read(pfd.fd, &count, sizeof(count));
+            (void)ignored;
+        }
+    }
+    atomic_store_explicit(&self->waiting, 0, memory_order_relaxed);
+}
+
+/* Moves up to `max` records into `return_value`, decoded with `schema` if given; returns how many */
+static zend_long quicpro_bus_drain(zval *return_value, const quicpro_iibin_compiled_schema_internal *schema, zend_long max)
+{
+    zend_long taken = 0;
+    uint64_t cap = quicpro_bus_seg->ring_cap;
+
+    for (uint32_t from = 0; from < quicpro_bus_seg->nendpoints && taken < max; ++from) {
+        quicpro_bus_ring_t *ring = quicpro_bus_ring((uint32_t)quicpro_bus_self_ep, from);
+        unsigned char *data = quicpro_bus_ring_data(ring);
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+        while (head != tail && taken < max) {
+            uint64_t off = head & (cap - 1);
+            const quicpro_bus_record_t *rec = (const quicpro_bus_record_t *)(data + off);
+            if (rec->len == QP_BUS_WRAP) {
+                head += cap - off;
+                continue;
+            }
+
+            zval entry, message;
+            if (schema) {
+                if (quicpro_iibin_decode_message((const unsigned char *)(rec + 1), rec->len, schema, &message, 0) == FAILURE) {
+                    /* The exception is pending; the record is consumed so it cannot wedge the ring */
+                    head += sizeof(*rec) + quicpro_bus_align8(rec->len);
+                    atomic_store_explicit(&ring->head, head, memory_order_release);
+                    return -1;
+                }
+            } else {
+                ZVAL_STRINGL(&message, (const char *)(rec + 1), rec->len);
+            }
+            array_init_size(&entry, 2);
+            add_assoc_long(&entry, "from", (zend_long)rec->from_slot);
+            add_assoc_zval(&entry, "message", &message);
+            add_next_index_zval(return_value, &entry);
+            ++taken;
+
+            head += sizeof(*rec) + quicpro_bus_align8(rec->len);
+        }
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+    }
+    return taken;
+}
+
+static zend_bool quicpro_bus_usable(const char *fn)
+{
+    if (!quicpro_bus_seg) {
+        throw_mcp_error_as_php_exception(0, "%s: the cluster message bus is not enabled (cluster option 'message_bus_ring_bytes').", fn);
+        return 0;
+    }
+    if (quicpro_bus_self_ep < 0) {
+        throw_mcp_error_as_php_exception(0, "%s: only cluster workers can use the message bus.", fn);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * Resolves `message` to the bytes to send: a string as is, anything else
+ * IIBIN-encoded with `schema_name`. `scratch` owns whatever was encoded.
+ */
+static int quicpro_bus_payload(const char *fn, zval *message, zend_string *schema_name, smart_str *scratch,
+                               const char **payload, size_t *len)
+{
+    if (schema_name) {
+        const quicpro_iibin_compiled_schema_internal *schema = get_compiled_iibin_schema_internal(ZSTR_VAL(schema_name));
+        if (!schema) {
+            throw_mcp_error_as_php_exception(0, "%s: IIBIN schema '%s' is not defined.", fn, ZSTR_VAL(schema_name));
+            return FAILURE;
+        }
+        if (quicpro_iibin_encode_message(scratch, schema, message) == FAILURE) {
+            return FAILURE;
+        }
+        *payload = scratch->s ? ZSTR_VAL(scratch->s) : "";
+        *len = scratch->s ? ZSTR_LEN(scratch->s) : 0;
+    } else if (Z_TYPE_P(message) == IS_STRING) {
+        *payload = Z_STRVAL_P(message);
+        *len = Z_STRLEN_P(message);
+    } else {
+        throw_mcp_error_as_php_exception(0, "%s: a message that is not a string needs an IIBIN schema.", fn);
+        return FAILURE;
+    }
+
+    if (*len > quicpro_bus_max_payload()) {
+        throw_mcp_error_as_php_exception(0, "%s: a %zu-byte message exceeds the bus limit of %zu bytes.", fn, *len, quicpro_bus_max_payload());
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+PHP_FUNCTION(quicpro_cluster_send)
+{
+    zend_long worker_id;
+    zval *message;
+    zend_string *schema_name = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(2, 3)
+        Z_PARAM_LONG(worker_id)
+        Z_PARAM_ZVAL(message)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR_OR_NULL(schema_name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (!quicpro_bus_usable("Cluster::send")) {
+        RETURN_FALSE;
+    }
+    if (worker_id < 0 || (zend_ulong)worker_id >= quicpro_bus_seg->nslots) {
+        throw_mcp_error_as_php_exception(0, "Cluster::send: worker %ld is not a slot of this cluster.", (long)worker_id);
+        RETURN_FALSE;
+    }
+
+    smart_str scratch = {0};
+    const char *payload;
+    size_t len;
+    if (quicpro_bus_payload("Cluster::send", message, schema_name, &scratch, &payload, &len) == FAILURE) {
+        smart_str_free(&scratch);
+        RETURN_FALSE;
+    }
+    zend_bool sent = quicpro_bus_push((uint32_t)worker_id, payload, len);
+    smart_str_free(&scratch);
+    RETURN_BOOL(sent);
+}
+
+PHP_FUNCTION(quicpro_cluster_broadcast)
+{
+    zval *message;
+    zend_string *schema_name = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_ZVAL(message)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR_OR_NULL(schema_name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (!quicpro_bus_usable("Cluster::broadcast")) {
+        RETURN_FALSE;
+    }
+
+    smart_str scratch = {0};
+    const char *payload;
+    size_t len;
+    if (quicpro_bus_payload("Cluster::broadcast", message, schema_name, &scratch, &payload, &len) == FAILURE) {
+        smart_str_free(&scratch);
+        RETURN_FALSE;
+    }
+    zend_long sent = 0;
+    for (uint32_t slot = 0; slot < quicpro_bus_seg->nslots; ++slot) {
+        if ((int)slot != quicpro_bus_self_slot && quicpro_bus_push(slot, payload, len)) {
+            ++sent;
+        }
+    }
+    smart_str_free(&scratch);
+    RETURN_LONG(sent);
+}
+
+PHP_FUNCTION(quicpro_cluster_receive)
+{
+    zend_long timeout_ms = 0;
+    zend_string *schema_name = NULL;
+    zend_long max = 64;
+
+    ZEND_PARSE_PARAMETERS_START(0, 3)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(timeout_ms)
+        Z_PARAM_STR_OR_NULL(schema_name)
+        Z_PARAM_LONG(max)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (!quicpro_bus_usable("Cluster::receive")) {
+        RETURN_FALSE;
+    }
+    const quicpro_iibin_compiled_schema_internal *schema = NULL;
+    if (schema_name && !(schema = get_compiled_iibin_schema_internal(ZSTR_VAL(schema_name)))) {
+        throw_mcp_error_as_php_exception(0, "Cluster::receive: IIBIN schema '%s' is not defined.", ZSTR_VAL(schema_name));
+        RETURN_FALSE;
+    }
+    if (max <= 0) {
+        max = 64;
+    }
+
+    array_init(return_value);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        zend_long taken = quicpro_bus_drain(return_value, schema, max);
+        if (taken < 0) {
+            zval_ptr_dtor(return_value);
+            RETURN_FALSE;
+        }
+        if (taken > 0 || timeout_ms == 0) {
+            return;
+        }
+
+        int remaining = -1;
+        if (timeout_ms > 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            zend_long elapsed = (zend_long)(now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+            if (elapsed >= timeout_ms) {
+                return;
+            }
+            remaining = (int)MIN(timeout_ms - elapsed, INT_MAX);
+        }
+        quicpro_bus_wait(remaining);
+    }
+}
@@ -0,0 +1,195 @@
+/*
+ * src/cluster/cgroup.c – Per-worker cgroup v2 sub-groups for Quicpro\Cluster
+ * ==========================================================================
+ *
+ * See include/cluster/cgroup.h. Everything goes through the cgroup v2
+ * files; no library is needed. A PSI trigger is a pressure file held open
+ * read-write with "some <stall_us> <window_us>" written to it. The kernel
+ * then signals POLLPRI at most once per window while tasks of the group
+ * stall for longer than that. The trigger goes away when the fd is
+ * closed, so every forked worker closes its copies.
+ */
+
+#include "php_quicpro.h"
+#include "cluster/cgroup.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char  quicpro_cgroup_parent[PATH_MAX];
+static int   quicpro_cgroup_nslots = 0;         /* 0: legacy cgroup.procs path, or nothing prepared */
+static int  *quicpro_cgroup_triggers = NULL;    /* [nslots * QUICPRO_CGROUP_RESOURCES], -1 if not armed */
+static const char *quicpro_cgroup_procs = NULL; /* The legacy path */
+
+static const char *const quicpro_cgroup_pressure_files[QUICPRO_CGROUP_RESOURCES] = { "cpu.pressure", "memory.pressure" };
+
+/* Writes `value` to <dir>/<file>; -1 with errno set on failure */
+static int quicpro_cgroup_write(const char *dir, const char *file, const char *value)
+{
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/%s", dir, file) >= (int)sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t n = write(fd, value, strlen(value));
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return n == (ssize_t)strlen(value) ? 0 : -1;
+}
+
+static void quicpro_cgroup_slot_dir(char *out, size_t size, int worker_id)
+{
+    snprintf(out, size, "%s/worker-%d", quicpro_cgroup_parent, worker_id);
+}
+
+static int quicpro_cgroup_arm(const char *dir, quicpro_cgroup_resource_t resource, int stall_ms, int window_ms)
+{
+    char path[PATH_MAX], trigger[64];
+    snprintf(path, sizeof(path), "%s/%s", dir, quicpro_cgroup_pressure_files[resource]);
+    int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    int len = snprintf(trigger, sizeof(trigger), "some %ld %ld", (long)stall_ms * 1000, (long)window_ms * 1000);
+    /* The terminating NUL is part of the trigger as the kernel parses it */
+    if (write(fd, trigger, (size_t)len + 1) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+void quicpro_cgroup_prepare(const char *path, int nslots, const char *cpu_max, const char *memory_high,
+                            int stall_ms, int window_ms)
+{
+    struct stat st;
+    if (!path || nslots <= 0 || quicpro_cgroup_nslots || quicpro_cgroup_procs) {
+        return;
+    }
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        quicpro_cgroup_procs = path;
+        return;
+    }
+    if (snprintf(quicpro_cgroup_parent, sizeof(quicpro_cgroup_parent), "%s", path) >= (int)sizeof(quicpro_cgroup_parent)) {
+        php_error_docref(NULL, E_WARNING, "Cluster cgroup path '%s' is too long", path);
+        return;
+    }
+
+    /* Not fatal: the controllers may already be enabled, or be delegated to us read-only */
+    if ((cpu_max || memory_high)
+        && quicpro_cgroup_write(quicpro_cgroup_parent, "cgroup.subtree_control",
+                                cpu_max && memory_high ? "+cpu +memory" : cpu_max ? "+cpu" : "+memory") != 0) {
+        php_error_docref(NULL, E_WARNING, "Cluster cgroup: cannot enable controllers in '%s/cgroup.subtree_control': %s",
+                         quicpro_cgroup_parent, strerror(errno));
+    }
+
+    quicpro_cgroup_triggers = safe_pemalloc((size_t)nslots, QUICPRO_CGROUP_RESOURCES * sizeof(int), 0, 1);
+    quicpro_cgroup_nslots = nslots;
+    for (int i = 0; i < nslots; ++i) {
+        char dir[PATH_MAX];
+        quicpro_cgroup_slot_dir(dir, sizeof(dir), i);
+        for (int r = 0; r < QUICPRO_CGROUP_RESOURCES; ++r) {
+            quicpro_cgroup_triggers[i * QUICPRO_CGROUP_RESOURCES + r] = -1;
+        }
+        if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+            php_error_docref(NULL, E_WARNING, "Cluster cgroup: cannot create '%s': %s", dir, strerror(errno));
+            continue;
+        }
+        if (cpu_max && quicpro_cgroup_write(dir, "cpu.max", cpu_max) != 0) {
+            php_error_docref(NULL, E_WARNING, "Cluster cgroup: cannot set cpu.max of '%s' to '%s': %s", dir, cpu_max, strerror(errno));
+        }
+        if (memory_high && quicpro_cgroup_write(dir, "memory.high", memory_high) != 0) {
+            php_error_docref(NULL, E_WARNING, "Cluster cgroup: cannot set memory.high of '%s' to '%s': %s", dir, memory_high, strerror(errno));
+        }
+        if (stall_ms <= 0) {
+            continue;
+        }
+        for (int r = 0; r < QUICPRO_CGROUP_RESOURCES; ++r) {
+            int fd = quicpro_cgroup_arm(dir, (quicpro_cgroup_resource_t)r, stall_ms, window_ms);
+            if (fd < 0) {
+                php_error_docref(NULL, E_WARNING, "Cluster cgroup: cannot arm a trigger on '%s/%s': %s",
+                                 dir, quicpro_cgroup_pressure_files[r], strerror(errno));
+            }
+            quicpro_cgroup_triggers[i * QUICPRO_CGROUP_RESOURCES + r] = fd;
+        }
+    }
+}
+
+static void quicpro_cgroup_close_triggers(void)
+{
+    for (int i = 0; i < quicpro_cgroup_nslots * QUICPRO_CGROUP_RESOURCES; ++i) {
+        if (quicpro_cgroup_triggers[i] >= 0) {
+            close(quicpro_cgroup_triggers[i]);
+            quicpro_cgroup_triggers[i] = -1;
+        }
+    }
+}
+
+void quicpro_cgroup_release(void)
+{
+    if (quicpro_cgroup_nslots) {
+        quicpro_cgroup_close_triggers();
+        for (int i = 0; i < quicpro_cgroup_nslots; ++i) {
+            char dir[PATH_MAX];
+            quicpro_cgroup_slot_dir(dir, sizeof(dir), i);
+            rmdir(dir); /* EBUSY while a process is left in it */
+        }
+        pefree(quicpro_cgroup_triggers, 1);
+        quicpro_cgroup_triggers = NULL;
+        quicpro_cgroup_nslots = 0;
+    }
+    quicpro_cgroup_procs = NULL;
+}
+
+void quicpro_cgroup_attach_worker(int worker_id)
+{
+    char pid[32];
+    snprintf(pid, sizeof(pid), "%d\n", (int)getpid());
+
+    if (quicpro_cgroup_procs) {
+        int fd = open(quicpro_cgroup_procs, O_WRONLY | O_CLOEXEC);
+        if (fd < 0 || write(fd, pid, strlen(pid)) < 0) {
+            php_error(E_WARNING, "[Worker %d] Failed to write to cgroup tasks file '%s': %s", worker_id, quicpro_cgroup_procs, strerror(errno));
+        }
+        if (fd >= 0) close(fd);
+        return;
+    }
+    if (!quicpro_cgroup_nslots) {
+        return;
+    }
+
+    /* The triggers are the supervisor's; a copy held here would keep them armed after the master exits */
+    quicpro_cgroup_close_triggers();
+    if (worker_id < quicpro_cgroup_nslots) {
+        char dir[PATH_MAX];
+        quicpro_cgroup_slot_dir(dir, sizeof(dir), worker_id);
+        if (quicpro_cgroup_write(dir, "cgroup.procs", pid) != 0) {
+            php_error(E_WARNING, "[Worker %d] Failed to join cgroup '%s': %s", worker_id, dir, strerror(errno));
+        }
+    }
+}
+
+int quicpro_cgroup_pressure_fd(int worker_id, quicpro_cgroup_resource_t resource)
+{
+    if (worker_id < 0 || worker_id >= quicpro_cgroup_nslots || resource >= QUICPRO_CGROUP_RESOURCES) {
+        return -1;
+    }
+    return quicpro_cgroup_triggers[worker_id * QUICPRO_CGROUP_RESOURCES + resource];
+}
+
+const char *quicpro_cgroup_resource_name(quicpro_cgroup_resource_t resource)
+{
+    return resource == QUICPRO_CGROUP_MEMORY ? "memory" : "cpu";
+}
@@ -0,0 +1,860 @@
+/*
+ * src/cluster/cloud_autoscale.c – Predictive node autoscaler for Quicpro\Cluster
+ * ===============================================================================
+ *
+ * See include/cluster/cloud_autoscale.h. Each sample lists the fleet
+ * first, so what the controller decides on is what the provider reports
+ * and not what it asked for earlier. Nodes created or stopped for the
+ * warm pool are remembered until the provider reports them stopped. Until
+ * then they count as warm and not as capacity: DigitalOcean cannot create
+ * a droplet powered off, so a warm one is shut down once it is active.
+ *
+ * The provider calls go through a curl handle of the controller's own.
+ * The pooled client (http_client.h) is process-wide and would be inherited
+ * by every worker forked after it ran in the master.
+ */
+
+#include "php_quicpro.h"
+#include "cluster/cloud_autoscale.h"
+#include "smart_contracts/json.h"
+#include "config/cloud_autoscale/base_layer.h"
+
+#include <curl/curl.h>
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Holt-Winters smoothing of the level, the trend and the seasonal terms */
+#define QP_CLOUD_ALPHA 0.3
+#define QP_CLOUD_BETA  0.05
+#define QP_CLOUD_GAMMA 0.3
+
+#define QP_CLOUD_TIMEOUT_MS   30000
+#define QP_CLOUD_STATE_MAGIC  "QPCLOUD1"
+#define QP_CLOUD_HETZNER_API  "https://api.hetzner.cloud/v1"
+#define QP_CLOUD_DO_API       "https://api.digitalocean.com/v2"
+#define QP_CLOUD_DO_NAMES_MAX 10 /* Droplets one create request may name */
+
+typedef enum {
+    QP_CLOUD_HETZNER,
+    QP_CLOUD_DIGITALOCEAN,
+    QP_CLOUD_CALLABLE,
+} qp_cloud_driver_t;
+
+typedef enum {
+    QP_CLOUD_RUNNING,
+    QP_CLOUD_STOPPED,
+    QP_CLOUD_PENDING,
+} qp_cloud_state_t;
+
+/* What the warm pool table holds for an id */
+#define QP_CLOUD_WARM_CREATED  1 /* Created for the pool: stop it if it runs */
+#define QP_CLOUD_WARM_STOPPING 2 /* Stopped into the pool, still shutting down */
+
+typedef struct {
+    zend_string      *id, *name;
+    qp_cloud_state_t  state;
+    bool              warm, self;
+} qp_cloud_node_t;
+
+typedef struct {
+    qp_cloud_node_t *v;
+    uint32_t         n, cap;
+} qp_cloud_nodes_t;
+
+static struct {
+    bool               started;
+    qp_cloud_driver_t  driver;
+    zval               callable;
+    CURL              *curl;
+    struct curl_slist *headers;
+    char              *label;          /* cluster_name as a label value and tag */
+    char              *state_path;
+    char               host[256];
+    int                interval_sec, lead_sec, warm_nodes;
+    int                step_nodes, step_percent;
+    uint64_t           next_ms, quiet_until_ms, surplus_since_ms;
+    HashTable          warm;           /* id => QP_CLOUD_WARM_* */
+
+    /* The model: one seasonal term per interval of the period, NAN until its slot was seen */
+    uint32_t           period, slot;
+    uint64_t           seen;
+    double             level, trend, *season;
+} quicpro_cloud;
+
+/*──── Provider HTTP ────*/
+
+static size_t qp_cloud_write(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    smart_str_appendl((smart_str *)userdata, ptr, size * nmemb);
+    return size * nmemb;
+}
+
+/* The status of `method` on `url` with an optional JSON `body`, 0 if it did not complete; the reply in `reply` */
+static long qp_cloud_http(const char *method, const char *url, const smart_str *body, smart_str *reply)
+{
+    CURL *h = quicpro_cloud.curl;
+    curl_easy_reset(h);
+    curl_easy_setopt(h, CURLOPT_URL, url);
+    curl_easy_setopt(h, CURLOPT_HTTPHEADER, quicpro_cloud.headers);
+    curl_easy_setopt(h, CURLOPT_TIMEOUT_MS, (long)QP_CLOUD_TIMEOUT_MS);
+    curl_easy_setopt(h, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(h, CURLOPT_WRITEFUNCTION, qp_cloud_write);
+    curl_easy_setopt(h, CURLOPT_WRITEDATA, reply);
+    if (strcmp(method, "GET") != 0) {
+        curl_easy_setopt(h, CURLOPT_CUSTOMREQUEST, method);
+    }
+    if (body && body->s) {
+        curl_easy_setopt(h, CURLOPT_POSTFIELDS, ZSTR_VAL(body->s));
+        curl_easy_setopt(h, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)ZSTR_LEN(body->s));
+    }
+    CURLcode rc = curl_easy_perform(h);
+    if (rc != CURLE_OK) {
+        php_error(E_WARNING, "Cloud autoscaler: %s %s failed: %s", method, url, curl_easy_strerror(rc));
+        return 0;
+    }
+    long status = 0;
+    curl_easy_getinfo(h, CURLINFO_RESPONSE_CODE, &status);
+    if (status < 200 || status >= 300) {
+        php_error(E_WARNING, "Cloud autoscaler: %s %s returned HTTP %ld", method, url, status);
+    }
+    return status;
+}
+
+static void qp_cloud_json_str(smart_str *s, const char *v)
+{
+    smart_str_appendc(s, '"');
+    for (; *v; v++) {
+        unsigned char c = (unsigned char)*v;
+        if (c == '"' || c == '\\') {
+            smart_str_appendc(s, '\\');
+            smart_str_appendc(s, (char)c);
+        } else if (c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            smart_str_appends(s, esc);
+        } else {
+            smart_str_appendc(s, (char)c);
+        }
+    }
+    smart_str_appendc(s, '"');
+}
+
+static void qp_cloud_json_member(smart_str *s, const char *key, const char *v)
+{
+    if (s->s && ZSTR_VAL(s->s)[ZSTR_LEN(s->s) - 1] != '{') {
+        smart_str_appendc(s, ',');
+    }
+    qp_cloud_json_str(s, key);
+    smart_str_appendc(s, ':');
+    qp_cloud_json_str(s, v);
+}
+
+/* Calls `fn` with each "key=value" (or "key", value "") of quicpro.cluster_autoscale_instance_tags */
+static void qp_cloud_each_tag(void (*fn)(smart_str *, const char *, const char *), smart_str *s)
+{
+    const char *tags = quicpro_cloud_autoscale_config.instance_tags;
+    if (!tags || !*tags) {
+        return;
+    }
+    char *copy = estrdup(tags), *save = NULL;
+    for (char *tok = php_strtok_r(copy, ",", &save); tok; tok = php_strtok_r(NULL, ",", &save)) {
+        while (*tok == ' ') tok++;
+        if (!*tok) continue;
+        char *eq = strchr(tok, '=');
+        if (eq) *eq = '\0';
+        fn(s, tok, eq ? eq + 1 : "");
+    }
+    efree(copy);
+}
+
+static void qp_cloud_hetzner_label(smart_str *s, const char *key, const char *value)
+{
+    qp_cloud_json_member(s, key, value);
+}
+
+static void qp_cloud_do_tag(smart_str *s, const char *key, const char *value)
+{
+    smart_str_appendc(s, ',');
+    smart_str tag = {0};
+    smart_str_appends(&tag, key);
+    if (*value) {
+        smart_str_appendc(&tag, ':');
+        smart_str_appends(&tag, value);
+    }
+    smart_str_0(&tag);
+    qp_cloud_json_str(s, ZSTR_VAL(tag.s));
+    smart_str_free(&tag);
+}
+
+/* An id the controller put into a URL: digits, letters, '-' and '_' only */
+static bool qp_cloud_id_ok(const zend_string *id)
+{
+    if (ZSTR_LEN(id) == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < ZSTR_LEN(id); i++) {
+        char c = ZSTR_VAL(id)[i];
+        if (!((c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || c == '-' || c == '_')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*──── Drivers ────*/
+
+static void qp_cloud_nodes_add(qp_cloud_nodes_t *nodes, zend_string *id, zend_string *name, qp_cloud_state_t state)
+{
+    if (nodes->n == nodes->cap) {
+        nodes->cap = nodes->cap ? nodes->cap * 2 : 16;
+        nodes->v = safe_erealloc(nodes->v, nodes->cap, sizeof(qp_cloud_node_t), 0);
+    }
+    qp_cloud_node_t *n = &nodes->v[nodes->n++];
+    n->id = id;
+    n->name = name;
+    n->state = state;
+    n->warm = false;
+    n->self = ZSTR_LEN(name) && strcmp(ZSTR_VAL(name), quicpro_cloud.host) == 0;
+}
+
+static void qp_cloud_nodes_free(qp_cloud_nodes_t *nodes)
+{
+    for (uint32_t i = 0; i < nodes->n; i++) {
+        zend_string_release(nodes->v[i].id);
+        zend_string_release(nodes->v[i].name);
+    }
+    if (nodes->v) {
+        efree(nodes->v);
+    }
+    memset(nodes, 0, sizeof(*nodes));
+}
+
+static bool qp_cloud_call(const char *action, zval *args, zval *ret)
+{
+    zval argv[2];
+    ZVAL_STRING(&argv[0], action);
+    ZVAL_COPY_VALUE(&argv[1], args);
+    ZVAL_UNDEF(ret);
+    bool ok = call_user_function(NULL, NULL, &quicpro_cloud.callable, ret, 2, argv) == SUCCESS && !EG(exception);
+    zval_ptr_dtor(&argv[0]);
+    if (EG(exception)) {
+        php_error(E_WARNING, "Cloud autoscaler: 'cloud_provider_callable' threw on \"%s\"", action);
+        zend_clear_exception();
+    }
+    if (!ok) {
+        zval_ptr_dtor(ret);
+        ZVAL_UNDEF(ret);
+    }
+    return ok;
+}
+
+/* The state of a Hetzner server or DigitalOcean droplet status; false for one on its way out */
+static bool qp_cloud_native_state(const quicpro_json_t *j, uint32_t status, qp_cloud_state_t *state)
+{
+    if (quicpro_json_is(j, status, "running") || quicpro_json_is(j, status, "active")) {
+        *state = QP_CLOUD_RUNNING;
+    } else if (quicpro_json_is(j, status, "off")) {
+        *state = QP_CLOUD_STOPPED;
+    } else if (quicpro_json_is(j, status, "deleting") || quicpro_json_is(j, status, "archive")) {
+        return false;
+    } else {
+        *state = QP_CLOUD_PENDING;
+    }
+    return true;
+}
+
+static bool qp_cloud_list_native(qp_cloud_nodes_t *nodes)
+{
+    bool hetzner = quicpro_cloud.driver == QP_CLOUD_HETZNER;
+    const char *key = hetzner ? "servers" : "droplets";
+    int per_page = hetzner ? 50 : 200;
+    for (int page = 1;; page++) {
+        char url[512];
+        if (hetzner) {
+            snprintf(url, sizeof(url), QP_CLOUD_HETZNER_API "/servers?label_selector=quicpro-cluster%%3D%s&per_page=%d&page=%d",
+                     quicpro_cloud.label, per_page, page);
+        } else {
+            snprintf(url, sizeof(url), QP_CLOUD_DO_API "/droplets?tag_name=quicpro-cluster:%s&per_page=%d&page=%d",
+                     quicpro_cloud.label, per_page, page);
+        }
+        smart_str reply = {0};
+        long status = qp_cloud_http("GET", url, NULL, &reply);
+        quicpro_json_t j;
+        bool ok = status == 200 && reply.s && quicpro_json_parse(&j, ZSTR_VAL(reply.s), ZSTR_LEN(reply.s));
+        uint32_t got = 0;
+        if (ok) {
+            uint32_t list = quicpro_json_get(&j, 0, key);
+            ok = list != QUICPRO_JSON_NONE && j.tok[list].type == QUICPRO_JSON_ARRAY;
+            for (uint32_t e = ok ? quicpro_json_first(&j, list) : QUICPRO_JSON_NONE; got < (ok ? j.tok[list].size : 0); e = j.tok[e].skip, got++) {
+                uint32_t id = quicpro_json_get(&j, e, "id"), name = quicpro_json_get(&j, e, "name");
+                qp_cloud_state_t state;
+                if (id == QUICPRO_JSON_NONE || !qp_cloud_native_state(&j, quicpro_json_get(&j, e, "status"), &state)) {
+                    continue;
+                }
+                qp_cloud_nodes_add(nodes, zend_string_init(quicpro_json_str(&j, id), quicpro_json_len(&j, id), 0),
+                                   name != QUICPRO_JSON_NONE ? zend_string_init(quicpro_json_str(&j, name), quicpro_json_len(&j, name), 0)
+                                                             : ZSTR_EMPTY_ALLOC(),
+                                   state);
+            }
+            quicpro_json_free(&j);
+        } else if (status == 200) {
+            php_error(E_WARNING, "Cloud autoscaler: unexpected reply listing the %s", key);
+        }
+        smart_str_free(&reply);
+        if (!ok) {
+            return false;
+        }
+        if (got < (uint32_t)per_page) {
+            return true;
+        }
+    }
+}
+
+static bool qp_cloud_list_callable(qp_cloud_nodes_t *nodes)
+{
+    zval args, ret, *e;
+    array_init(&args);
+    bool ok = qp_cloud_call("list", &args, &ret);
+    zval_ptr_dtor(&args);
+    if (!ok) {
+        return false;
+    }
+    if (Z_TYPE(ret) != IS_ARRAY) {
+        php_error(E_WARNING, "Cloud autoscaler: \"list\" must return an array of nodes");
+        zval_ptr_dtor(&ret);
+        return false;
+    }
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL(ret), e) {
+        if (Z_TYPE_P(e) != IS_ARRAY) continue;
+        zval *id = zend_hash_str_find(Z_ARRVAL_P(e), "id", sizeof("id") - 1);
+        zval *name = zend_hash_str_find(Z_ARRVAL_P(e), "name", sizeof("name") - 1);
+        zval *state = zend_hash_str_find(Z_ARRVAL_P(e), "state", sizeof("state") - 1);
+        if (!id || !state || Z_TYPE_P(state) != IS_STRING) continue;
+        qp_cloud_state_t s = zend_string_equals_literal(Z_STR_P(state), "running") ? QP_CLOUD_RUNNING
+                           : zend_string_equals_literal(Z_STR_P(state), "stopped") ? QP_CLOUD_STOPPED : QP_CLOUD_PENDING;
+        qp_cloud_nodes_add(nodes, zval_get_string(id), name ? zval_get_string(name) : ZSTR_EMPTY_ALLOC(), s);
+    } ZEND_HASH_FOREACH_END();
+    zval_ptr_dtor(&ret);
+    return true;
+}
+
+static bool qp_cloud_list(qp_cloud_nodes_t *nodes)
+{
+    return quicpro_cloud.driver == QP_CLOUD_CALLABLE ? qp_cloud_list_callable(nodes) : qp_cloud_list_native(nodes);
+}
+
+/* Creates up to `count` nodes, started or not; their ids are added to `ids` (a list). @return how many */
+static int qp_cloud_create(int count, bool start, zval *ids)
+{
+    const qp_cloud_autoscale_config_t *cfg = &quicpro_cloud_autoscale_config;
+    int created = 0;
+
+    if (quicpro_cloud.driver == QP_CLOUD_CALLABLE) {
+        zval args, ret, *id;
+        array_init(&args);
+        add_assoc_long(&args, "count", count);
+        add_assoc_bool(&args, "start", start);
+        bool ok = qp_cloud_call("create", &args, &ret);
+        zval_ptr_dtor(&args);
+        if (!ok) {
+            return 0;
+        }
+        if (Z_TYPE(ret) == IS_ARRAY) {
+            ZEND_HASH_FOREACH_VAL(Z_ARRVAL(ret), id) {
+                add_next_index_str(ids, zval_get_string(id));
+                created++;
+            } ZEND_HASH_FOREACH_END();
+        }
+        zval_ptr_dtor(&ret);
+        return created;
+    }
+
+    bool hetzner = quicpro_cloud.driver == QP_CLOUD_HETZNER;
+    while (created < count) {
+        int batch = hetzner ? 1 : MIN(count - created, QP_CLOUD_DO_NAMES_MAX);
+        smart_str body = {0};
+        char name[128];
+        smart_str_appendc(&body, '{');
+        if (hetzner) {
+            snprintf(name, sizeof(name), "%s-%ld-%d", quicpro_cloud.label, (long)time(NULL), created);
+            qp_cloud_json_member(&body, "name", name);
+            qp_cloud_json_member(&body, "server_type", cfg->instance_type);
+            qp_cloud_json_member(&body, "image", cfg->instance_image_id);
+            if (cfg->region && *cfg->region) {
+                qp_cloud_json_member(&body, "location", cfg->region);
+            }
+            smart_str_appends(&body, start ? ",\"start_after_create\":true" : ",\"start_after_create\":false");
+            if (cfg->network_config && *cfg->network_config && strspn(cfg->network_config, "0123456789") == strlen(cfg->network_config)) {
+                smart_str_appends(&body, ",\"networks\":[");
+                smart_str_appends(&body, cfg->network_config);
+                smart_str_appendc(&body, ']');
+            }
+            smart_str_appends(&body, ",\"labels\":{");
+            qp_cloud_json_member(&body, "quicpro-cluster", quicpro_cloud.label);
+            qp_cloud_each_tag(qp_cloud_hetzner_label, &body);
+            smart_str_appendc(&body, '}');
+        } else {
+            smart_str_appends(&body, "\"names\":[");
+            for (int i = 0; i < batch; i++) {
+                snprintf(name, sizeof(name), "%s-%ld-%d", quicpro_cloud.label, (long)time(NULL), created + i);
+                if (i) smart_str_appendc(&body, ',');
+                qp_cloud_json_str(&body, name);
+            }
+            smart_str_appendc(&body, ']');
+            qp_cloud_json_member(&body, "size", cfg->instance_type);
+            qp_cloud_json_member(&body, "image", cfg->instance_image_id);
+            qp_cloud_json_member(&body, "region", cfg->region);
+            if (cfg->network_config && *cfg->network_config) {
+                qp_cloud_json_member(&body, "vpc_uuid", cfg->network_config);
+            }
+            snprintf(name, sizeof(name), "quicpro-cluster:%s", quicpro_cloud.label);
+            smart_str_appends(&body, ",\"tags\":[");
+            qp_cloud_json_str(&body, name);
+            qp_cloud_each_tag(qp_cloud_do_tag, &body);
+            smart_str_appendc(&body, ']');
+        }
+        smart_str_appendc(&body, '}');
+        smart_str_0(&body);
+
+        smart_str reply = {0};
+        long status = qp_cloud_http("POST", hetzner ? QP_CLOUD_HETZNER_API "/servers" : QP_CLOUD_DO_API "/droplets", &body, &reply);
+        smart_str_free(&body);
+        quicpro_json_t j;
+        int got = 0;
+        if (status >= 200 && status < 300 && reply.s && quicpro_json_parse(&j, ZSTR_VAL(reply.s), ZSTR_LEN(reply.s))) {
+            /* Hetzner answers with "server", DigitalOcean with "droplets", or "droplet" for one name */
+            uint32_t list = hetzner ? QUICPRO_JSON_NONE : quicpro_json_get(&j, 0, "droplets");
+            uint32_t one = quicpro_json_get(&j, 0, hetzner ? "server" : "droplet");
+            bool many = list != QUICPRO_JSON_NONE && j.tok[list].type == QUICPRO_JSON_ARRAY;
+            uint32_t n = many ? j.tok[list].size : one != QUICPRO_JSON_NONE;
+            uint32_t e = many ? quicpro_json_first(&j, list) : one;
+            for (uint32_t i = 0; i < n; i++, e = j.tok[e].skip) {
+                uint32_t id = quicpro_json_get(&j, e, "id");
+                if (id != QUICPRO_JSON_NONE) {
+                    add_next_index_stringl(ids, quicpro_json_str(&j, id), quicpro_json_len(&j, id));
+                    got++;
+                }
+            }
+            quicpro_json_free(&j);
+        }
+        smart_str_free(&reply);
+        if (got == 0) {
+            break;
+        }
+        created += got;
+    }
+    return created;
+}
+
+/* "start", "stop" or "destroy" on node `id` */
+static bool qp_cloud_action(const char *action, zend_string *id)
+{
+    if (quicpro_cloud.driver == QP_CLOUD_CALLABLE) {
+        zval args, ret;
+        array_init(&args);
+        add_assoc_str(&args, "id", zend_string_copy(id));
+        bool ok = qp_cloud_call(action, &args, &ret);
+        zval_ptr_dtor(&args);
+        ok = ok && zend_is_true(&ret);
+        zval_ptr_dtor(&ret);
+        return ok;
+    }
+    if (!qp_cloud_id_ok(id)) {
+        php_error(E_WARNING, "Cloud autoscaler: provider reported an unusable node id \"%s\"", ZSTR_VAL(id));
+        return false;
+    }
+
+    bool hetzner = quicpro_cloud.driver == QP_CLOUD_HETZNER, destroy = strcmp(action, "destroy") == 0;
+    char url[256];
+    smart_str body = {0}, reply = {0};
+    if (hetzner) {
+        snprintf(url, sizeof(url), QP_CLOUD_HETZNER_API "/servers/%s%s", ZSTR_VAL(id),
+                 destroy ? "" : strcmp(action, "start") == 0 ? "/actions/poweron" : "/actions/shutdown");
+    } else {
+        snprintf(url, sizeof(url), QP_CLOUD_DO_API "/droplets/%s%s", ZSTR_VAL(id), destroy ? "" : "/actions");
+        if (!destroy) {
+            smart_str_appends(&body, strcmp(action, "start") == 0 ? "{\"type\":\"power_on\"}" : "{\"type\":\"shutdown\"}");
+            smart_str_0(&body);
+        }
+    }
+    long status = qp_cloud_http(destroy ? "DELETE" : "POST", url, hetzner ? NULL : &body, &reply);
+    smart_str_free(&body);
+    smart_str_free(&reply);
+    return status >= 200 && status < 300;
+}
+
+/*──── Model ────*/
+
+static inline double qp_cloud_seasonal(uint32_t slot)
+{
+    double s = quicpro_cloud.season[slot % quicpro_cloud.period];
+    return quicpro_cloud.seen >= quicpro_cloud.period && !isnan(s) ? s : 0.0;
+}
+
+static uint32_t qp_cloud_slot_now(void)
+{
+    return (uint32_t)(((uint64_t)time(NULL) / (uint64_t)quicpro_cloud.interval_sec) % quicpro_cloud.period);
+}
+
+static void qp_cloud_observe(double y)
+{
+    uint32_t slot = qp_cloud_slot_now();
+    if (quicpro_cloud.seen == 0) {
+        quicpro_cloud.level = y;
+        quicpro_cloud.trend = 0.0;
+    } else {
+        double prev = quicpro_cloud.level;
+        quicpro_cloud.level = QP_CLOUD_ALPHA * (y - qp_cloud_seasonal(slot)) + (1.0 - QP_CLOUD_ALPHA) * (prev + quicpro_cloud.trend);
+        quicpro_cloud.trend = QP_CLOUD_BETA * (quicpro_cloud.level - prev) + (1.0 - QP_CLOUD_BETA) * quicpro_cloud.trend;
+    }
+    double *s = &quicpro_cloud.season[slot];
+    *s = isnan(*s) ? y - quicpro_cloud.level : QP_CLOUD_GAMMA * (y - quicpro_cloud.level) + (1.0 - QP_CLOUD_GAMMA) * *s;
+    quicpro_cloud.slot = slot;
+    quicpro_cloud.seen++;
+}
+
+/* The highest demand forecast over the next `steps` intervals, and now */
+static double qp_cloud_peak(double now, int steps)
+{
+    double peak = now;
+    for (int h = 1; h <= steps; h++) {
+        double f = quicpro_cloud.level + h * quicpro_cloud.trend + qp_cloud_seasonal(quicpro_cloud.slot + (uint32_t)h);
+        if (f > peak) peak = f;
+    }
+    return peak;
+}
+
+typedef struct {
+    char     magic[8];
+    uint32_t interval_sec, period;
+    uint64_t seen;
+    uint32_t slot, pad;
+    double   level, trend;
+} qp_cloud_state_header_t;
+
+static void qp_cloud_load(void)
+{
+    FILE *f = quicpro_cloud.state_path ? fopen(quicpro_cloud.state_path, "rb") : NULL;
+    if (!f) {
+        return;
+    }
+    qp_cloud_state_header_t h;
+    if (fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, QP_CLOUD_STATE_MAGIC, sizeof(h.magic)) == 0
+        && h.interval_sec == (uint32_t)quicpro_cloud.interval_sec && h.period == quicpro_cloud.period
+        && fread(quicpro_cloud.season, sizeof(double), h.period, f) == h.period) {
+        quicpro_cloud.seen = h.seen;
+        quicpro_cloud.slot = h.slot % h.period;
+        quicpro_cloud.level = h.level;
+        quicpro_cloud.trend = h.trend;
+    } else {
+        /* Another interval or period, or a torn file: start over */
+        for (uint32_t i = 0; i < quicpro_cloud.period; i++) quicpro_cloud.season[i] = NAN;
+    }
+    fclose(f);
+}
+
+static void qp_cloud_save(void)
+{
+    if (!quicpro_cloud.state_path || quicpro_cloud.seen == 0) {
+        return;
+    }
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", quicpro_cloud.state_path) >= (int)sizeof(tmp)) {
+        return;
+    }
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        php_error(E_WARNING, "Cloud autoscaler: cannot write %s: %s", tmp, strerror(errno));
+        return;
+    }
+    qp_cloud_state_header_t h = {
+        .interval_sec = (uint32_t)quicpro_cloud.interval_sec, .period = quicpro_cloud.period,
+        .seen = quicpro_cloud.seen, .slot = quicpro_cloud.slot,
+        .level = quicpro_cloud.level, .trend = quicpro_cloud.trend,
+    };
+    memcpy(h.magic, QP_CLOUD_STATE_MAGIC, sizeof(h.magic));
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 && fwrite(quicpro_cloud.season, sizeof(double), quicpro_cloud.period, f) == quicpro_cloud.period;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp, quicpro_cloud.state_path) != 0) {
+        php_error(E_WARNING, "Cloud autoscaler: cannot write %s: %s", quicpro_cloud.state_path, strerror(errno));
+        unlink(tmp);
+    }
+}
+
+/*──── Controller ────*/
+
+static bool qp_cloud_read_token(const char *path)
+{
+    if (!path || !*path) {
+        php_error(E_WARNING, "Cloud autoscaler: quicpro.cluster_autoscale_credentials_path must name the file with the API token");
+        return false;
+    }
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        php_error(E_WARNING, "Cloud autoscaler: cannot read %s: %s", path, strerror(errno));
+        return false;
+    }
+    char token[1024];
+    size_t n = fread(token, 1, sizeof(token) - 1, f);
+    fclose(f);
+    while (n && (token[n - 1] == '\n' || token[n - 1] == '\r' || token[n - 1] == ' ' || token[n - 1] == '\t')) n--;
+    token[n] = '\0';
+    if (n == 0 || strpbrk(token, "\r\n")) {
+        php_error(E_WARNING, "Cloud autoscaler: %s does not hold one API token", path);
+        return false;
+    }
+    char header[1100];
+    snprintf(header, sizeof(header), "Authorization: Bearer %s", token);
+    quicpro_cloud.headers = curl_slist_append(quicpro_cloud.headers, header);
+    quicpro_cloud.headers = curl_slist_append(quicpro_cloud.headers, "Content-Type: application/json");
+    ZEND_SECURE_ZERO(token, sizeof(token));
+    ZEND_SECURE_ZERO(header, sizeof(header));
+    return true;
+}
+
+int quicpro_cloud_autoscale_start(const quicpro_cluster_options_t *c)
+{
+    const qp_cloud_autoscale_config_t *cfg = &quicpro_cloud_autoscale_config;
+    const char *provider = cfg->provider ? cfg->provider : "";
+
+    memset(&quicpro_cloud, 0, sizeof(quicpro_cloud));
+    ZVAL_UNDEF(&quicpro_cloud.callable);
+    if (Z_TYPE(c->cloud_provider_callable) != IS_UNDEF) {
+        quicpro_cloud.driver = QP_CLOUD_CALLABLE;
+        ZVAL_COPY(&quicpro_cloud.callable, &c->cloud_provider_callable);
+    } else if (strcmp(provider, "hetzner") == 0) {
+        quicpro_cloud.driver = QP_CLOUD_HETZNER;
+    } else if (strcmp(provider, "digitalocean") == 0) {
+        quicpro_cloud.driver = QP_CLOUD_DIGITALOCEAN;
+    } else {
+        php_error(E_WARNING, "Cloud autoscaler: provider \"%s\" needs a 'cloud_provider_callable'; not scaling nodes", provider);
+        return FAILURE;
+    }
+    if (quicpro_cloud.driver != QP_CLOUD_CALLABLE) {
+        if (!cfg->instance_type || !*cfg->instance_type || !cfg->instance_image_id || !*cfg->instance_image_id) {
+            php_error(E_WARNING, "Cloud autoscaler: quicpro.cluster_autoscale_instance_type and _instance_image_id are required; not scaling nodes");
+            return FAILURE;
+        }
+        if ((quicpro_cloud.curl = curl_easy_init()) == NULL || !qp_cloud_read_token(cfg->credentials_path)) {
+            quicpro_cloud_autoscale_stop();
+            return FAILURE;
+        }
+    }
+
+    /* Label values and tags take letters, digits, '-' and '_' */
+    const char *name = c->cluster_name ? c->cluster_name : "quicpro_cluster";
+    size_t len = MIN(strlen(name), 63);
+    quicpro_cloud.label = estrndup(name, len);
+    for (size_t i = 0; i < len; i++) {
+        char ch = quicpro_cloud.label[i];
+        if (!((ch >= '0' && ch <= '9') || ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'z') || ch == '-')) {
+            quicpro_cloud.label[i] = '-';
+        }
+    }
+    if (gethostname(quicpro_cloud.host, sizeof(quicpro_cloud.host) - 1) != 0) {
+        quicpro_cloud.host[0] = '\0';
+    }
+
+    const char *policy = cfg->scale_up_policy ? cfg->scale_up_policy : "";
+    if (strncmp(policy, "add_percent:", 12) == 0) {
+        quicpro_cloud.step_percent = atoi(policy + 12);
+    } else if (strncmp(policy, "add_nodes:", 10) == 0) {
+        quicpro_cloud.step_nodes = atoi(policy + 10);
+    }
+    if (quicpro_cloud.step_nodes < 1 && quicpro_cloud.step_percent < 1) {
+        quicpro_cloud.step_nodes = 1;
+    }
+
+    quicpro_cloud.interval_sec = c->cloud_autoscale_interval_sec;
+    quicpro_cloud.lead_sec = c->cloud_autoscale_lead_sec;
+    quicpro_cloud.warm_nodes = c->cloud_warm_nodes;
+    quicpro_cloud.period = (uint32_t)MAX(1, c->cloud_autoscale_season_sec / c->cloud_autoscale_interval_sec);
+    quicpro_cloud.season = safe_emalloc(quicpro_cloud.period, sizeof(double), 0);
+    for (uint32_t i = 0; i < quicpro_cloud.period; i++) quicpro_cloud.season[i] = NAN;
+    quicpro_cloud.state_path = c->cloud_autoscale_state_path ? estrdup(c->cloud_autoscale_state_path) : NULL;
+    qp_cloud_load();
+    zend_hash_init(&quicpro_cloud.warm, 8, NULL, NULL, 0);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    quicpro_cloud.next_ms = (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000 + (uint64_t)quicpro_cloud.interval_sec * 1000;
+    quicpro_cloud.started = true;
+    php_printf("[Master Supervisor] Cloud autoscaler: %s nodes of '%s', %ld..%ld, %d warm, %u-slot season.\n",
+               quicpro_cloud.driver == QP_CLOUD_CALLABLE ? "callable-driven" : provider, quicpro_cloud.label,
+               (long)cfg->min_nodes, (long)cfg->max_nodes, quicpro_cloud.warm_nodes, quicpro_cloud.period);
+    return SUCCESS;
+}
+
+uint64_t quicpro_cloud_autoscale_next_ms(void)
+{
+    return quicpro_cloud.started ? quicpro_cloud.next_ms : 0;
+}
+
+/* Marks the warm nodes and settles the pool table with what the provider reports */
+static void qp_cloud_reconcile(qp_cloud_nodes_t *nodes)
+{
+    HashTable seen;
+    zend_hash_init(&seen, nodes->n, NULL, NULL, 0);
+    for (uint32_t i = 0; i < nodes->n; i++) {
+        qp_cloud_node_t *n = &nodes->v[i];
+        zval *mark = zend_hash_find(&quicpro_cloud.warm, n->id);
+        zend_hash_add_empty_element(&seen, n->id);
+        n->warm = n->state == QP_CLOUD_STOPPED || mark;
+        if (!mark) {
+            continue;
+        }
+        if (n->state == QP_CLOUD_STOPPED) {
+            zend_hash_del(&quicpro_cloud.warm, n->id);
+        } else if (n->state == QP_CLOUD_RUNNING && Z_LVAL_P(mark) == QP_CLOUD_WARM_CREATED && qp_cloud_action("stop", n->id)) {
+            ZVAL_LONG(mark, QP_CLOUD_WARM_STOPPING);
+        }
+    }
+    zend_string *id;
+    ZEND_HASH_FOREACH_STR_KEY(&quicpro_cloud.warm, id) {
+        if (id && !zend_hash_exists(&seen, id)) {
+            zend_hash_del(&quicpro_cloud.warm, id); /* Gone from the fleet */
+        }
+    } ZEND_HASH_FOREACH_END();
+    zend_hash_destroy(&seen);
+}
+
+void quicpro_cloud_autoscale_tick(double utilization, uint64_t now_ms)
+{
+    if (!quicpro_cloud.started) {
+        return;
+    }
+    const qp_cloud_autoscale_config_t *cfg = &quicpro_cloud_autoscale_config;
+    quicpro_cloud.next_ms = now_ms + (uint64_t)quicpro_cloud.interval_sec * 1000;
+
+    qp_cloud_nodes_t nodes = {0};
+    if (!qp_cloud_list(&nodes)) {
+        qp_cloud_nodes_free(&nodes);
+        return;
+    }
+    qp_cloud_reconcile(&nodes);
+
+    int running = 0, pending = 0, warm = 0;
+    bool self_listed = false;
+    for (uint32_t i = 0; i < nodes.n; i++) {
+        const qp_cloud_node_t *n = &nodes.v[i];
+        self_listed |= n->self;
+        if (n->warm) warm++;
+        else if (n->state == QP_CLOUD_RUNNING) running++;
+        else pending++;
+    }
+    if (!self_listed) {
+        running++; /* This node serves too, wherever it was started */
+    }
+    if (utilization < 0) {
+        qp_cloud_nodes_free(&nodes);
+        return;
+    }
+
+    double demand = utilization * running;
+    qp_cloud_observe(demand);
+    qp_cloud_save();
+
+    double target = MAX(1, MIN(100, cfg->scale_up_cpu_threshold_percent)) / 100.0;
+    int lead_steps = (quicpro_cloud.lead_sec + quicpro_cloud.interval_sec - 1) / quicpro_cloud.interval_sec;
+    double peak = qp_cloud_peak(demand, lead_steps);
+    long min_nodes = MAX(1, cfg->min_nodes), max_nodes = MAX(min_nodes, cfg->max_nodes);
+    long want = (long)ceil(peak / target - 1e-9);
+    want = want < min_nodes ? min_nodes : want > max_nodes ? max_nodes : want;
+    int capacity = running + pending;
+    bool cooling = now_ms < quicpro_cloud.quiet_until_ms, changed = false;
+
+    if (want > capacity && !cooling) {
+        int step = quicpro_cloud.step_nodes ? quicpro_cloud.step_nodes : (running * quicpro_cloud.step_percent + 99) / 100;
+        int add = (int)MIN(MAX(want - capacity, step), max_nodes - capacity), started = 0;
+        for (uint32_t i = 0; i < nodes.n && started < add; i++) {
+            qp_cloud_node_t *n = &nodes.v[i];
+            if (n->warm && n->state == QP_CLOUD_STOPPED && qp_cloud_action("start", n->id)) {
+                started++;
+                warm--;
+            }
+        }
+        zval ids;
+        array_init(&ids);
+        int created = started < add ? qp_cloud_create(add - started, true, &ids) : 0;
+        zval_ptr_dtor(&ids);
+        if (started + created > 0) {
+            php_printf("[Master Supervisor] Cloud autoscaler: demand %.2f nodes, forecast peak %.2f: started %d warm and created %d.\n",
+                       demand, peak, started, created);
+            changed = true;
+        }
+    } else if (want < running && pending == 0 && !cooling && running > 0
+               && demand / running < MAX(0, cfg->scale_down_cpu_threshold_percent) / 100.0) {
+        if (!quicpro_cloud.surplus_since_ms) {
+            quicpro_cloud.surplus_since_ms = now_ms;
+        }
+        if (now_ms - quicpro_cloud.surplus_since_ms >= (uint64_t)MAX(0, cfg->idle_node_timeout_sec) * 1000) {
+            /* The newest node that serves, never this one */
+            for (uint32_t i = nodes.n; i-- > 0;) {
+                qp_cloud_node_t *n = &nodes.v[i];
+                if (n->warm || n->self || n->state != QP_CLOUD_RUNNING) continue;
+                bool keep = warm < quicpro_cloud.warm_nodes;
+                if (qp_cloud_action(keep ? "stop" : "destroy", n->id)) {
+                    if (keep) {
+                        zval mark;
+                        ZVAL_LONG(&mark, QP_CLOUD_WARM_STOPPING);
+                        zend_hash_update(&quicpro_cloud.warm, n->id, &mark);
+                        warm++;
+                    }
+                    php_printf("[Master Supervisor] Cloud autoscaler: demand %.2f nodes, forecast peak %.2f: %s node %s.\n",
+                               demand, peak, keep ? "stopped" : "deleted", ZSTR_VAL(n->id));
+                    changed = true;
+                }
+                break;
+            }
+        }
+    } else {
+        quicpro_cloud.surplus_since_ms = 0;
+    }
+
+    if (changed) {
+        quicpro_cloud.surplus_since_ms = 0;
+        quicpro_cloud.quiet_until_ms = now_ms + (uint64_t)MAX(0, cfg->cooldown_period_sec) * 1000;
+    } else if (warm < quicpro_cloud.warm_nodes) {
+        /* Refill the pool, within max_nodes serving and warm_nodes stopped */
+        int room = (int)(max_nodes + quicpro_cloud.warm_nodes) - (capacity + warm);
+        int need = MIN(quicpro_cloud.warm_nodes - warm, room);
+        if (need > 0) {
+            zval ids, *id;
+            array_init(&ids);
+            int created = qp_cloud_create(need, false, &ids);
+            ZEND_HASH_FOREACH_VAL(Z_ARRVAL(ids), id) {
+                zval mark;
+                ZVAL_LONG(&mark, QP_CLOUD_WARM_CREATED);
+                zend_hash_update(&quicpro_cloud.warm, Z_STR_P(id), &mark);
+            } ZEND_HASH_FOREACH_END();
+            zval_ptr_dtor(&ids);
+            if (created > 0) {
+                php_printf("[Master Supervisor] Cloud autoscaler: created %d warm node(s).\n", created);
+            }
+        }
+    }
+    qp_cloud_nodes_free(&nodes);
+}
+
+void quicpro_cloud_autoscale_stop(void)
+{
+    if (quicpro_cloud.started) {
+        qp_cloud_save();
+        zend_hash_destroy(&quicpro_cloud.warm);
+    }
+    if (quicpro_cloud.curl) curl_easy_cleanup(quicpro_cloud.curl);
+    if (quicpro_cloud.headers) curl_slist_free_all(quicpro_cloud.headers);
+    if (quicpro_cloud.season) efree(quicpro_cloud.season);
+    if (quicpro_cloud.label) efree(quicpro_cloud.label);
+    if (quicpro_cloud.state_path) efree(quicpro_cloud.state_path);
+    zval_ptr_dtor(&quicpro_cloud.callable);
+    memset(&quicpro_cloud, 0, sizeof(quicpro_cloud));
+    ZVAL_UNDEF(&quicpro_cloud.callable);
+}
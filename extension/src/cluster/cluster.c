@@ -7,21 +7,113 @@
  * forks worker processes, sets up their execution environment (affinity, priority, etc.),
  * and enters a supervision loop to monitor and restart workers.
  * It also handles graceful shutdown via OS signals.
+ *
+ * The supervisor sleeps in epoll_wait() on a signalfd (SIGTERM, SIGINT,
+ * SIGHUP, SIGCHLD) and one pidfd per worker, which becomes readable the
+ * moment that worker exits. Its only timeout is the next ticket key
+ * rotation, so an idle master stays asleep and a crashed worker is reaped
+ * and forked again as soon as the kernel reports it. On kernels without
+ * pidfd_open() (before 5.3), SIGCHLD alone wakes it.
+ *
+ * SIGHUP rolls the workers over to a new generation one slot at a time:
+ * the successor is forked and binds its listeners next to the old worker,
+ * which is told to drain (SIGTERM) once the successor reports it listens
+ * or 'reload_ready_timeout_sec' passes, and killed after
+ * 'graceful_shutdown_timeout_sec'. The two generations use separate halves
+ * of the connection-ID steering map (server/reuseport.h), so connections
+ * stay with the worker that accepted them while new ones go to the
+ * successors. A SIGHUP during a reload starts another once every old
+ * worker is gone.
+ * 'reuseport_steering' => "hash" leaves the steering program out, so the
+ * kernel's 4-tuple hash alone picks the worker; connections then break
+ * across a reload or a NAT rebinding, and "cid" can be measured against it.
+ *
+ * 'preload_callable' runs once in the master before the first fork, so
+ * what it loads (classes, IIBIN schemas, tool handlers, config objects) is
+ * shared copy-on-write by every worker instead of rebuilt by each.
+ * 'spare_workers' keeps that many processes forked and idle: a restart or a
+ * reload successor takes one and hands it a slot over its
+ * control socket instead of forking. Spares are replaced after a reload.
+ *
+ * With 'max_workers' above 'min_workers', the supervisor scales the number
+ * of running workers between them. Every 'autoscale_interval_sec' it reads
+ * each worker's event-loop idle time and queue depth from the stats
+ * segment (cluster/cluster_stats.h). It adds a worker after
+ * QP_AUTOSCALE_UP_SAMPLES samples in a row with average utilisation
+ * above 'scale_up_utilization' or a queue of 'scale_up_queue_depth'
+ * events. It drains the highest slot after QP_AUTOSCALE_DOWN_SAMPLES samples
+ * below 'scale_down_utilization'. Nothing changes again for
+ * 'autoscale_cooldown_sec'. Slots 0 .. active - 1 run; the steering
+ * program spreads new connections over exactly those.
+ *
+ * 'message_bus_ring_bytes' maps the inter-worker rings (cluster/bus.h)
+ * before the first fork; a worker that scales down stops being addressable.
+ *
+ * 'connection_snapshot_capacity' has every worker record its connections
+ * every 'connection_snapshot_interval_ms' (server/conn_snapshot.h). The
+ * replacement of a worker that crashed answers its predecessor's clients
+ * with stateless resets, and they reconnect right away.
+ *
+ * 'worker_cgroup_path' gives each slot its own cgroup v2 group with CPU
+ * and memory limits (cluster/cgroup.h). With 'pressure_stall_ms' the
+ * supervisor also waits on each group's PSI triggers. A trigger firing
+ * raises a cluster-wide pressure level, up to
+ * QUICPRO_RATE_LIMIT_MAX_PRESSURE. Each level halves the rate limiter's
+ * rates (server/rate_limit.h) and calls 'on_pressure_callable', which can
+ * put the application in maintenance mode. The level falls by one for
+ * every 'pressure_relax_sec' without a trigger.
+ *
+ * With 'metrics_enabled' (the default) every worker records the built-in
+ * and registered instruments into a shard of its own (server/metrics.h).
+ * The master maps the shards after the preload, so instruments registered
+ * there are included, and serves their sum as Prometheus text on
+ * 'metrics_host':'metrics_port' from a thread of its own.
+ *
+ * 'cloud_autoscale' makes this master size the fleet of nodes as well
+ * (cluster/cloud_autoscale.h). Every 'cloud_autoscale_interval_sec' it
+ * samples its workers' loops like the worker autoscaler, but against every
+ * slot up to 'max_workers', which is the node's capacity.
  */
 
 #include "php_quicpro.h"
 #include "cluster.h"
 #include "cancel.h" /* For throwing exceptions */
+#include "poll/xdp.h" /* Per-worker AF_XDP queue binding */
+#include "server/reuseport.h" /* Per-worker SO_REUSEPORT steering */
+#include "server/zero_rtt.h" /* Cluster-wide 0-RTT anti-replay store */
+#include "server/rate_limit.h" /* Cluster-wide token buckets */
+#include "server/xdp_filter.h" /* XDP pre-filter and its shared connection-ID map */
+#include "server/cdn_cache.h" /* CDN memory tier shared by all workers */
+#include "object_store/metadata_cache.h" /* quicpro-fs:// manifests shared by all workers */
+#include "server/conn_snapshot.h" /* Stateless resets for a crashed worker's connections */
+#include "server/ticket_keys.h" /* Shared, rotated session ticket keys */
+#include "server/ocsp.h" /* Shared OCSP staples, fetched by the master */
+#include "client/ticket_cache.h" /* Client TLS sessions shared by all workers */
+#include "pipeline_orchestrator/step_cache.h" /* Pipeline tool replies shared by all workers */
+#include "state/state_cache.h" /* State API values shared by all workers */
+#include "cluster/cluster_stats.h" /* Per-worker counters read by quicpro_cluster_get_stats() */
+#include "cluster/topology.h" /* NUMA-aware worker placement */
+#include "cluster/bus.h" /* Inter-worker message rings */
+#include "cluster/cgroup.h" /* Per-worker cgroups and PSI triggers */
+#include "cluster/cloud_autoscale.h" /* Fleet sizing through the node provider */
+#include "server/metrics.h" /* Per-worker metric shards and their scrape endpoint */
+#include "config/bare_metal_tuning/base_layer.h" /* NIC and NUMA policy settings */
 
 #include <unistd.h>     /* for fork, getpid, getmypid, setuid, setgid, usleep */
 #include <signal.h>     /* for signal, kill */
 #include <sys/wait.h>   /* for waitpid */
+#include <sys/epoll.h>  /* Supervisor event loop */
+#include <sys/signalfd.h> /* Signals as loop events */
+#include <sys/syscall.h> /* for pidfd_open */
+#include <sys/socket.h> /* for socketpair: spare and readiness sockets */
 #include <sys/resource.h> /* for setrlimit */
 #include <sched.h>      /* for sched_setaffinity, sched_setscheduler */
 #include <string.h>     /* for strerror */
 #include <errno.h>      /* for errno */
 #include <time.h>       /* for time() */
 #include <stdio.h>      /* for FILE, fopen, fprintf, fclose */
+#include <fcntl.h>      /* for O_CLOEXEC */
+#include <limits.h>     /* for INT_MAX */
 
 /* --- Master Process Global State --- */
 typedef struct {
@@ -31,15 +123,71 @@ typedef struct {
     int restart_count;
     time_t last_restart_time;
     zend_bool is_exiting;
+    int pidfd;              /* Readable once the worker exits; -1 without pidfd_open() */
+    unsigned generation;    /* Reloads before it was forked */
+    uint64_t drain_deadline_ms; /* Draining: when it gets SIGKILL; 0 until told to drain */
 } quicpro_worker_info_t;
 
 static quicpro_worker_info_t *g_worker_pool = NULL;
-static int g_num_workers = 0;
+static quicpro_worker_info_t *g_draining = NULL;   /* Per slot: the predecessor of a reload */
+static int g_num_workers = 0;          /* Slots: max_workers */
+static int g_active_workers = 0;       /* Slots 0 .. g_active_workers - 1 run */
 static zval g_on_worker_exit_callable;
 
-/* Volatile for signal safety */
-static volatile sig_atomic_t g_shutdown_request = 0; /* SIGINT/SIGTERM received */
-static volatile sig_atomic_t g_reload_request = 0;   /* SIGHUP received */
+/* Rolling reload */
+static unsigned g_generation = 0;
+static int g_reload_slot = -1;          /* Slot whose successor is starting, -1 between reloads */
+static zend_bool g_reload_pending = 0;  /* SIGHUP while the last reload still drains */
+static int g_ready_fd = -1;             /* Master: the successor writes here once it listens */
+static uint64_t g_ready_deadline_ms;
+static int g_worker_ready_fd = -1;      /* Worker: the other end, until it listens */
+
+/* Pre-forked spares: idle until sent a quicpro_spare_assign_t on their control socket */
+typedef struct {
+    int32_t worker_id;
+    uint32_t generation;
+} quicpro_spare_assign_t;
+
+static quicpro_worker_info_t *g_spares = NULL;
+static int *g_spare_control = NULL;     /* Master's end of each spare's socket, -1 if none */
+static int g_num_spares = 0;
+
+/* Autoscaler: the previous sample of each slot, and the streaks that give it hysteresis */
+#define QP_AUTOSCALE_UP_SAMPLES   2
+#define QP_AUTOSCALE_DOWN_SAMPLES 6
+
+typedef struct {
+    uint64_t at_us;
+    uint64_t idle_us;
+    pid_t pid;
+} quicpro_load_sample_t;
+
+static quicpro_load_sample_t *g_load_samples = NULL;
+static uint64_t g_autoscale_next_ms = 0;
+static quicpro_load_sample_t *g_cloud_samples = NULL; /* The cloud autoscaler's own previous samples */
+
+/* Load shedding under cgroup pressure: the current level and when it next falls */
+static unsigned g_pressure_level = 0;
+static uint64_t g_pressure_relax_ms = 0;
+static uint64_t g_autoscale_quiet_until_ms = 0;
+static int g_scale_up_streak = 0;
+static int g_scale_down_streak = 0;
+
+/* Set when the supervisor reads the signal from its signalfd */
+static zend_bool g_shutdown_request = 0; /* SIGINT/SIGTERM received */
+static zend_bool g_reload_request = 0;   /* SIGHUP received */
+
+/* Supervisor event loop tags: a pidfd carries its worker_id, a draining worker's also QP_SUPERVISOR_DRAINING */
+#define QP_SUPERVISOR_SIGNALS  UINT64_MAX
+#define QP_SUPERVISOR_READY    (UINT64_MAX - 1)
+#define QP_SUPERVISOR_DRAINING (UINT64_C(1) << 32)
+#define QP_SUPERVISOR_SPARE    (UINT64_C(2) << 32)
+#define QP_SUPERVISOR_PRESSURE (UINT64_C(3) << 32) /* | worker_id * QUICPRO_CGROUP_RESOURCES + resource */
+#define QP_SUPERVISOR_EVENTS   16
+static int g_supervisor_epfd = -1;
+static int g_signal_fd = -1;
+static sigset_t g_saved_sigmask;
+static zend_bool g_sigmask_saved = 0;
 
 
 /* --- Static Helper Function Prototypes --- */
@@ -47,8 +195,33 @@ static int parse_options_from_php(zval *php_options_array, quicpro_cluster_optio
 static void cleanup_c_options(quicpro_cluster_options_t *c_options);
 static void master_supervisor_loop(quicpro_cluster_options_t *c_options);
 static pid_t fork_and_start_worker(quicpro_cluster_options_t *c_options, int worker_id);
+static pid_t spawn_worker(quicpro_cluster_options_t *c_options, int worker_id, int *ready_fd);
+static void spares_fill(quicpro_cluster_options_t *c_options);
+static void spares_discard(void);
+static void spare_process_main(quicpro_cluster_options_t *c_options, int control_fd);
 static void worker_process_main(quicpro_cluster_options_t *c_options, int worker_id);
-static void cluster_signal_handler(int signo);
+static int supervisor_open(void);
+static void supervisor_close(void);
+static void supervisor_watch(quicpro_worker_info_t *w, uint64_t tag);
+static void supervisor_unwatch(quicpro_worker_info_t *w);
+static zend_bool supervisor_read_signals(void);
+static uint64_t supervisor_now_ms(void);
+static int supervisor_timeout_ms(void);
+static void supervisor_reap(quicpro_cluster_options_t *c_options, pid_t which);
+static void handle_worker_exit(quicpro_cluster_options_t *c_options, pid_t child_pid, int status);
+static void reload_begin(quicpro_cluster_options_t *c_options);
+static void reload_next(quicpro_cluster_options_t *c_options, int from_slot);
+static void reload_successor_ready(quicpro_cluster_options_t *c_options);
+static void reload_expire_drains(void);
+static zend_bool reload_draining(void);
+static int load_sample(quicpro_load_sample_t *samples, uint64_t now_ms, double *busy_sum, uint64_t *depth_max);
+static void autoscale_tick(quicpro_cluster_options_t *c_options);
+static void cloud_autoscale_tick(void);
+static zend_bool autoscale_up(quicpro_cluster_options_t *c_options);
+static zend_bool autoscale_down(quicpro_cluster_options_t *c_options);
+static void pressure_watch(void);
+static void pressure_event(quicpro_cluster_options_t *c_options, int worker_id, quicpro_cgroup_resource_t resource);
+static void pressure_tick(quicpro_cluster_options_t *c_options);
 static void write_pid_file(const char *path);
 static void remove_pid_file(const char *path);
 
@@ -76,15 +249,60 @@ PHP_FUNCTION(quicpro_cluster_orchestrate)
         write_pid_file(c_options.master_pid_file_path);
     }
 
-    /* Setup signal handlers for the master process */
-    signal(SIGTERM, cluster_signal_handler);
-    signal(SIGINT, cluster_signal_handler);
-    signal(SIGHUP, cluster_signal_handler);
-    signal(SIGCHLD, SIG_DFL); /* Let waitpid handle it */
-
     /* Allocate global worker pool */
-    g_num_workers = c_options.num_workers;
+    g_num_workers = c_options.max_workers;
+    g_active_workers = c_options.num_workers;
     g_worker_pool = ecalloc(g_num_workers, sizeof(quicpro_worker_info_t));
+    g_draining = ecalloc(g_num_workers, sizeof(quicpro_worker_info_t));
+    for (int i = 0; i < g_num_workers; ++i) {
+        g_worker_pool[i].pidfd = -1;
+        g_draining[i].pidfd = -1;
+    }
+    g_num_spares = c_options.spare_workers;
+    if (g_num_spares > 0) {
+        g_spares = ecalloc(g_num_spares, sizeof(quicpro_worker_info_t));
+        g_spare_control = safe_emalloc(g_num_spares, sizeof(int), 0);
+        for (int i = 0; i < g_num_spares; ++i) {
+            g_spares[i].pidfd = -1;
+            g_spare_control[i] = -1;
+        }
+    }
+
+    /* The master takes its signals from a signalfd; workers get the old mask back */
+    signal(SIGCHLD, SIG_DFL); /* Let waitpid handle it */
+    if (supervisor_open() == FAILURE) {
+        throw_mcp_error_as_php_exception(0, "Failed to set up the cluster supervisor: %s", strerror(errno));
+        goto cleanup_and_fail;
+    }
+
+    /* Steering map and program are inherited by every (re)forked worker */
+    quicpro_reuseport_prepare(g_num_workers, c_options.reuseport_cid_steering);
+    quicpro_zero_rtt_prepare();
+    quicpro_rate_limit_prepare();
+    quicpro_xdp_filter_prepare();
+    quicpro_cdn_cache_prepare();
+    quicpro_objstore_md_prepare();
+    quicpro_state_cache_prepare();
+    quicpro_conn_snapshot_prepare(g_num_workers, c_options.connection_snapshot_capacity, c_options.connection_snapshot_interval_ms);
+    quicpro_ticket_keys_prepare();
+    quicpro_ocsp_prepare();
+    quicpro_client_ticket_cache_prepare();
+    quicpro_step_cache_prepare();
+    quicpro_cluster_stats_create(g_num_workers);
+    if (c_options.message_bus_ring_bytes > 0) {
+        quicpro_cluster_bus_prepare(g_num_workers, (size_t)c_options.message_bus_ring_bytes);
+    }
+    if (c_options.worker_cgroup_path) {
+        quicpro_cgroup_prepare(c_options.worker_cgroup_path, g_num_workers, c_options.worker_cgroup_cpu_max,
+                               c_options.worker_cgroup_memory_high, c_options.pressure_stall_ms, c_options.pressure_window_ms);
+        pressure_watch();
+    }
+    quicpro_reuseport_set_active(g_active_workers);
+    quicpro_cluster_stats_set_active(g_active_workers);
+    if (c_options.max_workers > c_options.min_workers) {
+        g_load_samples = ecalloc(g_num_workers, sizeof(quicpro_load_sample_t));
+        g_autoscale_next_ms = supervisor_now_ms() + (uint64_t)c_options.autoscale_interval_sec * 1000;
+    }
 
     /* Store callbacks globally for use in signal handlers/master loop */
     if (Z_TYPE(c_options.on_worker_exit_callable) != IS_UNDEF) {
@@ -93,8 +311,28 @@ PHP_FUNCTION(quicpro_cluster_orchestrate)
         ZVAL_UNDEF(&g_on_worker_exit_callable);
     }
 
+    /* Everything the preload builds is inherited by every worker, copy-on-write */
+    if (Z_TYPE(c_options.preload_callable) != IS_UNDEF) {
+        zval retval;
+        ZVAL_UNDEF(&retval);
+        if (call_user_function_ex(NULL, NULL, &c_options.preload_callable, &retval, 0, NULL, 0, NULL) == FAILURE || EG(exception)) {
+            zval_ptr_dtor(&retval);
+            if (!EG(exception)) {
+                throw_mcp_error_as_php_exception(0, "Cluster option 'preload_callable' failed.");
+            }
+            goto cleanup_and_fail;
+        }
+        zval_ptr_dtor(&retval);
+    }
+
+    /* The instruments are all registered now; the shards take their layout */
+    quicpro_metrics_prepare(g_num_workers, c_options.metrics_enabled);
+    if (c_options.metrics_enabled) {
+        quicpro_metrics_serve(c_options.metrics_host ? c_options.metrics_host : "127.0.0.1", c_options.metrics_port);
+    }
+
     /* Initial fork of all workers */
-    for (int i = 0; i < g_num_workers; ++i) {
+    for (int i = 0; i < g_active_workers; ++i) {
         pid_t pid = fork_and_start_worker(&c_options, i);
         if (pid < 0) {
             /* Forking failed, kill any children we already made and exit */
@@ -104,7 +342,9 @@ PHP_FUNCTION(quicpro_cluster_orchestrate)
             throw_mcp_error_as_php_exception(0, "Failed to fork worker process #%d: %s", i, strerror(errno));
             goto cleanup_and_fail;
         }
-        g_worker_pool[i] = (quicpro_worker_info_t){ .pid = pid, .worker_id = i, .start_time = time(NULL), .last_restart_time = time(NULL), .restart_count = 0, .is_exiting = 0 };
+        g_worker_pool[i] = (quicpro_worker_info_t){ .pid = pid, .worker_id = i, .start_time = time(NULL), .last_restart_time = time(NULL), .restart_count = 0, .is_exiting = 0, .pidfd = -1, .generation = g_generation };
+        supervisor_watch(&g_worker_pool[i], (uint64_t)i);
+        quicpro_cluster_stats_worker_started(i, g_generation, pid, false);
 
         /* Call the on_worker_start PHP callback in the master process */
         if (Z_TYPE(c_options.on_worker_start_callable) != IS_UNDEF) {
@@ -116,31 +356,55 @@ PHP_FUNCTION(quicpro_cluster_orchestrate)
         }
     }
 
+    spares_fill(&c_options);
+
+    if (c_options.cloud_autoscale && quicpro_cloud_autoscale_start(&c_options) == SUCCESS) {
+        g_cloud_samples = ecalloc(g_num_workers, sizeof(quicpro_load_sample_t));
+    }
+
     /* Enter the main supervisor loop. This function typically only exits on shutdown signal. */
     master_supervisor_loop(&c_options);
 
     /* --- Shutdown Sequence --- */
+    spares_discard();
     php_printf("[Master Supervisor] Shutdown initiated. Sending SIGTERM to all workers...\n");
     for (int i = 0; i < g_num_workers; ++i) {
         if (g_worker_pool[i].pid > 0) {
             kill(g_worker_pool[i].pid, SIGTERM);
         }
+        if (g_draining[i].pid > 0 && !g_draining[i].drain_deadline_ms) {
+            kill(g_draining[i].pid, SIGTERM);
+        }
     }
 
-    /* Wait for graceful shutdown timeout */
+    /* Wait for graceful shutdown timeout, woken by each exit */
     time_t shutdown_deadline = time(NULL) + c_options.graceful_shutdown_timeout_sec;
-    while (time(NULL) < shutdown_deadline) {
-        pid_t exited_pid = waitpid(-1, NULL, WNOHANG);
-        if (exited_pid <= 0) {
-            usleep(100000); /* 100ms sleep */
-            continue;
+    for (;;) {
+        pid_t exited_pid;
+        while ((exited_pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+            for (int i = 0; i < g_num_workers; ++i) {
+                if (g_worker_pool[i].pid == exited_pid) {
+                    g_worker_pool[i].pid = 0;
+                    supervisor_unwatch(&g_worker_pool[i]);
+                }
+                if (g_draining[i].pid == exited_pid) {
+                    g_draining[i].pid = 0;
+                    supervisor_unwatch(&g_draining[i]);
+                }
+            }
         }
         int all_exited = 1;
         for (int i = 0; i < g_num_workers; ++i) {
-            if (g_worker_pool[i].pid == exited_pid) g_worker_pool[i].pid = 0;
-            if (g_worker_pool[i].pid > 0) all_exited = 0;
+            if (g_worker_pool[i].pid > 0 || g_draining[i].pid > 0) all_exited = 0;
         }
-        if (all_exited) break;
+        time_t now = time(NULL);
+        if (all_exited || now >= shutdown_deadline) break;
+
+        struct epoll_event events[QP_SUPERVISOR_EVENTS];
+        if (epoll_wait(g_supervisor_epfd, events, QP_SUPERVISOR_EVENTS, (int)(shutdown_deadline - now) * 1000) < 0 && errno != EINTR) {
+            break;
+        }
+        supervisor_read_signals(); /* Drain it, or it stays readable */
     }
 
     php_printf("[Master Supervisor] Graceful shutdown period ended. Sending SIGKILL to any remaining workers...\n");
@@ -148,14 +412,56 @@ PHP_FUNCTION(quicpro_cluster_orchestrate)
         if (g_worker_pool[i].pid > 0) {
             kill(g_worker_pool[i].pid, SIGKILL);
         }
+        if (g_draining[i].pid > 0) {
+            kill(g_draining[i].pid, SIGKILL);
+        }
     }
 
 cleanup_and_fail:
+    if (g_worker_pool) {
+        for (int i = 0; i < g_num_workers; ++i) {
+            supervisor_unwatch(&g_worker_pool[i]);
+            supervisor_unwatch(&g_draining[i]);
+        }
+    }
+    if (g_ready_fd >= 0) { close(g_ready_fd); g_ready_fd = -1; }
+    g_reload_slot = -1;
+    spares_discard();
+    supervisor_close();
+    quicpro_reuseport_release();
+    quicpro_zero_rtt_release();
+    quicpro_rate_limit_release();
+    quicpro_xdp_filter_release();
+    quicpro_cdn_cache_release();
+    quicpro_objstore_md_release();
+    quicpro_state_cache_release();
+    quicpro_conn_snapshot_release();
+    quicpro_ticket_keys_release();
+    quicpro_ocsp_release();
+    quicpro_client_ticket_cache_release();
+    quicpro_step_cache_release();
+    quicpro_cluster_stats_destroy();
+    quicpro_cluster_bus_release();
+    quicpro_cgroup_release();
+    quicpro_metrics_release();
+    quicpro_cloud_autoscale_stop();
+    g_pressure_level = 0;
+    g_pressure_relax_ms = 0;
     if (c_options.master_pid_file_path) {
         remove_pid_file(c_options.master_pid_file_path);
     }
     cleanup_c_options(&c_options);
     if (g_worker_pool) efree(g_worker_pool);
+    if (g_draining) efree(g_draining);
+    if (g_spares) efree(g_spares);
+    if (g_spare_control) efree(g_spare_control);
+    if (g_load_samples) efree(g_load_samples);
+    if (g_cloud_samples) efree(g_cloud_samples);
+    g_load_samples = g_cloud_samples = NULL;
+    g_autoscale_next_ms = 0;
+    g_worker_pool = g_draining = g_spares = NULL;
+    g_spare_control = NULL;
+    g_num_spares = 0;
     if (Z_TYPE(g_on_worker_exit_callable) != IS_UNDEF) zval_ptr_dtor(&g_on_worker_exit_callable);
 
     RETURN_TRUE;
@@ -202,11 +508,18 @@ PHP_FUNCTION(quicpro_cluster_signal_workers)
 
 PHP_FUNCTION(quicpro_cluster_get_stats)
 {
-    /* TODO: Requires IPC. A robust implementation would use shared memory or a unix domain socket
-     * that the master process listens on for stat requests.
-     */
-    zend_error(E_WARNING, "quicpro_cluster_get_stats() is not yet implemented.");
-    RETURN_FALSE;
+    char *pid_file_path = NULL;
+    size_t pid_file_path_len;
+
+    ZEND_PARSE_PARAMETERS_START(0, 1)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STRING_OR_NULL(pid_file_path, pid_file_path_len)
+    ZEND_PARSE_PARAMETERS_END();
+
+    /* Reads the workers' counters straight from the shared segment */
+    if (quicpro_cluster_stats_read(pid_file_path, return_value) == FAILURE) {
+        RETURN_FALSE;
+    }
 }
 
 
@@ -217,78 +530,569 @@ static void master_supervisor_loop(quicpro_cluster_options_t *c_options) {
     php_printf("[Master Supervisor] Entering main supervision loop...\n");
     while (!g_shutdown_request) {
         if (g_reload_request) {
-            php_printf("[Master Supervisor] SIGHUP received. Sending SIGTERM to all workers for graceful reload...\n");
-            for (int i = 0; i < g_num_workers; ++i) {
-                if (g_worker_pool[i].pid > 0) {
-                    kill(g_worker_pool[i].pid, SIGTERM);
-                    g_worker_pool[i].is_exiting = 1; /* Mark as intentionally stopping */
-                }
-            }
+            php_printf("[Master Supervisor] SIGHUP received. Replacing the workers one at a time...\n");
             g_reload_request = 0; /* Reset flag */
+            reload_begin(c_options);
         }
 
-        int status;
-        pid_t child_pid = waitpid(-1, &status, WNOHANG);
-        if (child_pid <= 0) {
-            /* No child exited, or an error occurred. Sleep briefly to prevent busy-looping. */
-            usleep(50000); /* 50ms */
-            continue;
+        /* Workers pick up a rotated ticket key on their next handshake */
+        quicpro_ticket_keys_tick();
+        /* Staples the workers asked for, and those halfway to expiry */
+        quicpro_ocsp_tick();
+
+        /* Replace the spares taken or lost since the last pass */
+        spares_fill(c_options);
+
+        /* A successor that has not reported in time is taken as ready; a drain that overran is cut short */
+        if (g_reload_slot >= 0 && supervisor_now_ms() >= g_ready_deadline_ms) {
+            reload_successor_ready(c_options);
+        }
+        reload_expire_drains();
+        autoscale_tick(c_options);
+        cloud_autoscale_tick();
+        pressure_tick(c_options);
+
+        /* Sleep until a signal, a worker exit, a reload deadline or the next key rotation */
+        struct epoll_event events[QP_SUPERVISOR_EVENTS];
+        int n = epoll_wait(g_supervisor_epfd, events, QP_SUPERVISOR_EVENTS, supervisor_timeout_ms());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            php_error(E_WARNING, "[Master Supervisor] epoll_wait failed: %s. Shutting down.", strerror(errno));
+            g_shutdown_request = 1;
+            break;
+        }
+
+        zend_bool reap_any = 0;
+        for (int i = 0; i < n; ++i) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == QP_SUPERVISOR_SIGNALS) {
+                reap_any |= supervisor_read_signals();
+                continue;
+            }
+            if (tag == QP_SUPERVISOR_READY) {
+                if (g_reload_slot >= 0) reload_successor_ready(c_options);
+                continue;
+            }
+            if ((tag & ~UINT64_C(0xffffffff)) == QP_SUPERVISOR_PRESSURE) {
+                uint32_t idx = (uint32_t)tag;
+                pressure_event(c_options, (int)(idx / QUICPRO_CGROUP_RESOURCES), (quicpro_cgroup_resource_t)(idx % QUICPRO_CGROUP_RESOURCES));
+                continue;
+            }
+            /* A pidfd: the slot may have been reaped and refilled earlier in this batch */
+            quicpro_worker_info_t *pool = (tag & QP_SUPERVISOR_SPARE) ? g_spares : (tag & QP_SUPERVISOR_DRAINING) ? g_draining : g_worker_pool;
+            int worker_id = (int)(uint32_t)tag;
+            if (worker_id < ((tag & QP_SUPERVISOR_SPARE) ? g_num_spares : g_num_workers) && pool[worker_id].pid > 0) {
+                supervisor_reap(c_options, pool[worker_id].pid);
+            }
         }
+        if (reap_any) {
+            supervisor_reap(c_options, -1);
+        }
+    }
+}
 
-        /* A child process has exited. Find it in our pool. */
-        int worker_id = -1;
+/* Reaps the exited worker `which`, or with -1 every exited child */
+static void supervisor_reap(quicpro_cluster_options_t *c_options, pid_t which) {
+    int status;
+    pid_t child_pid;
+    while ((child_pid = waitpid(which, &status, WNOHANG)) > 0) {
+        handle_worker_exit(c_options, child_pid, status);
+        if (which > 0) break;
+    }
+}
+
+/* Reports a reaped worker and restarts it if the policy allows */
+static void handle_worker_exit(quicpro_cluster_options_t *c_options, pid_t child_pid, int status) {
+    /* Find the reaped child in our pool. */
+    int worker_id = -1;
+    for (int i = 0; i < g_num_workers; ++i) {
+        if (g_worker_pool[i].pid == child_pid) {
+            worker_id = i;
+            break;
+        }
+    }
+    for (int i = 0; i < g_num_spares; ++i) {
+        if (g_spares[i].pid == child_pid) {
+            /* An idle spare died: the next loop pass forks another */
+            supervisor_unwatch(&g_spares[i]);
+            close(g_spare_control[i]);
+            g_spare_control[i] = -1;
+            g_spares[i].pid = 0;
+            return;
+        }
+    }
+    if (worker_id == -1) {
+        /* A predecessor that finished draining: never restarted */
         for (int i = 0; i < g_num_workers; ++i) {
-            if (g_worker_pool[i].pid == child_pid) {
+            if (g_draining[i].pid == child_pid) {
                 worker_id = i;
                 break;
             }
         }
-        if (worker_id == -1) continue; /* Not one of our direct children? Ignore. */
-
-        int exit_code = 0, term_signal = 0;
-        if (WIFEXITED(status)) exit_code = WEXITSTATUS(status);
-        if (WIFSIGNALED(status)) term_signal = WTERMSIG(status);
-
-        /* Call the on_worker_exit PHP callback */
+        if (worker_id == -1) return; /* Not one of our direct children? Ignore. */
+        supervisor_unwatch(&g_draining[worker_id]);
+        quicpro_cluster_stats_worker_exited(worker_id, g_draining[worker_id].generation);
+        quicpro_metrics_worker_exited(worker_id, g_draining[worker_id].generation);
+        g_draining[worker_id].pid = 0;
         if (Z_TYPE(g_on_worker_exit_callable) != IS_UNDEF) {
             zval args[4], retval;
             ZVAL_LONG(&args[0], worker_id);
             ZVAL_LONG(&args[1], child_pid);
-            ZVAL_LONG(&args[2], exit_code);
-            ZVAL_LONG(&args[3], term_signal);
+            ZVAL_LONG(&args[2], WIFEXITED(status) ? WEXITSTATUS(status) : 0);
+            ZVAL_LONG(&args[3], WIFSIGNALED(status) ? WTERMSIG(status) : 0);
             call_user_function_ex(NULL, NULL, &g_on_worker_exit_callable, &retval, 4, args, 0, NULL);
             zval_ptr_dtor(&retval);
         }
+        /* A reload asked for meanwhile can use this generation's half of the map again */
+        if (g_reload_pending && g_reload_slot < 0 && !reload_draining()) {
+            g_reload_pending = 0;
+            reload_begin(c_options);
+        }
+        return;
+    }
+    supervisor_unwatch(&g_worker_pool[worker_id]);
+    quicpro_cluster_stats_worker_exited(worker_id, g_worker_pool[worker_id].generation);
+    quicpro_metrics_worker_exited(worker_id, g_worker_pool[worker_id].generation);
+
+    int exit_code = 0, term_signal = 0;
+    if (WIFEXITED(status)) exit_code = WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) term_signal = WTERMSIG(status);
+
+    /* Call the on_worker_exit PHP callback */
+    if (Z_TYPE(g_on_worker_exit_callable) != IS_UNDEF) {
+        zval args[4], retval;
+        ZVAL_LONG(&args[0], worker_id);
+        ZVAL_LONG(&args[1], child_pid);
+        ZVAL_LONG(&args[2], exit_code);
+        ZVAL_LONG(&args[3], term_signal);
+        call_user_function_ex(NULL, NULL, &g_on_worker_exit_callable, &retval, 4, args, 0, NULL);
+        zval_ptr_dtor(&retval);
+    }
 
-        /* Handle restart logic */
-        if (c_options->restart_crashed_workers && !g_worker_pool[worker_id].is_exiting && !g_shutdown_request) {
-            time_t now = time(NULL);
-            if (now - g_worker_pool[worker_id].last_restart_time > c_options->restart_interval_sec) {
-                g_worker_pool[worker_id].restart_count = 0; // Reset restart count after interval
-            }
-            g_worker_pool[worker_id].restart_count++;
-            g_worker_pool[worker_id].last_restart_time = now;
-
-            if (c_options->max_restarts_per_worker < 0 || g_worker_pool[worker_id].restart_count <= c_options->max_restarts_per_worker) {
-                php_printf("[Master Supervisor] Worker %d (PID %d) exited unexpectedly. Restarting... (Attempt %d)\n", worker_id, child_pid, g_worker_pool[worker_id].restart_count);
-                pid_t new_pid = fork_and_start_worker(c_options, worker_id);
-                if (new_pid > 0) {
-                     g_worker_pool[worker_id].pid = new_pid;
-                     g_worker_pool[worker_id].start_time = time(NULL);
-                } else {
-                     php_error(E_WARNING, "[Master Supervisor] Failed to restart worker %d: %s", worker_id, strerror(errno));
-                     g_worker_pool[worker_id].pid = 0; // Mark as dead
-                }
+    /* Handle restart logic */
+    if (c_options->restart_crashed_workers && !g_worker_pool[worker_id].is_exiting && !g_shutdown_request) {
+        time_t now = time(NULL);
+        if (now - g_worker_pool[worker_id].last_restart_time > c_options->restart_interval_sec) {
+            g_worker_pool[worker_id].restart_count = 0; // Reset restart count after interval
+        }
+        g_worker_pool[worker_id].restart_count++;
+        g_worker_pool[worker_id].last_restart_time = now;
+
+        if (c_options->max_restarts_per_worker < 0 || g_worker_pool[worker_id].restart_count <= c_options->max_restarts_per_worker) {
+            php_printf("[Master Supervisor] Worker %d (PID %d) exited unexpectedly. Restarting... (Attempt %d)\n", worker_id, child_pid, g_worker_pool[worker_id].restart_count);
+            pid_t new_pid = spawn_worker(c_options, worker_id, NULL);
+            if (new_pid > 0) {
+                 g_worker_pool[worker_id].pid = new_pid;
+                 g_worker_pool[worker_id].start_time = time(NULL);
+                 g_worker_pool[worker_id].generation = g_generation;
+                 supervisor_watch(&g_worker_pool[worker_id], (uint64_t)worker_id);
+                 quicpro_cluster_stats_worker_started(worker_id, g_generation, new_pid, true);
             } else {
-                php_error(E_WARNING, "[Master Supervisor] Worker %d (PID %d) exceeded max restart limit. Not restarting.", worker_id, child_pid);
-                 g_worker_pool[worker_id].pid = 0;
+                 php_error(E_WARNING, "[Master Supervisor] Failed to restart worker %d: %s", worker_id, strerror(errno));
+                 g_worker_pool[worker_id].pid = 0; // Mark as dead
             }
         } else {
-             g_worker_pool[worker_id].pid = 0; /* Mark as dead, no restart */
+            php_error(E_WARNING, "[Master Supervisor] Worker %d (PID %d) exceeded max restart limit. Not restarting.", worker_id, child_pid);
+             g_worker_pool[worker_id].pid = 0;
+        }
+    } else {
+         g_worker_pool[worker_id].pid = 0; /* Mark as dead, no restart */
+    }
+}
+
+/* Blocks the supervisor's signals and opens its signalfd and epoll set */
+static int supervisor_open(void) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGHUP);
+    sigaddset(&mask, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &mask, &g_saved_sigmask) != 0) {
+        return FAILURE;
+    }
+    g_sigmask_saved = 1;
+
+    g_signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    g_supervisor_epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = QP_SUPERVISOR_SIGNALS };
+    if (g_signal_fd < 0 || g_supervisor_epfd < 0 || epoll_ctl(g_supervisor_epfd, EPOLL_CTL_ADD, g_signal_fd, &ev) != 0) {
+        int saved = errno;
+        supervisor_close();
+        errno = saved;
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+static void supervisor_close(void) {
+    if (g_signal_fd >= 0) { close(g_signal_fd); g_signal_fd = -1; }
+    if (g_supervisor_epfd >= 0) { close(g_supervisor_epfd); g_supervisor_epfd = -1; }
+    if (g_sigmask_saved) {
+        sigprocmask(SIG_SETMASK, &g_saved_sigmask, NULL);
+        g_sigmask_saved = 0;
+    }
+}
+
+/* Adds the worker's pidfd to the loop under `tag`; without one, its SIGCHLD stands in */
+static void supervisor_watch(quicpro_worker_info_t *w, uint64_t tag) {
+#ifdef SYS_pidfd_open
+    int fd = (int)syscall(SYS_pidfd_open, w->pid, 0);
+    if (fd < 0) {
+        return;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = tag };
+    if (epoll_ctl(g_supervisor_epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        close(fd);
+        return;
+    }
+    w->pidfd = fd;
+#else
+    (void)w; (void)tag;
+#endif
+}
+
+static void supervisor_unwatch(quicpro_worker_info_t *w) {
+    if (w->pidfd >= 0) {
+        close(w->pidfd); /* Also leaves the epoll set */
+        w->pidfd = -1;
+    }
+}
+
+static uint64_t supervisor_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/* The nearest of the next key rotation, the successor's ready deadline, every drain deadline, the next load samples and the next OCSP round */
+static int supervisor_timeout_ms(void) {
+    int timeout = quicpro_ticket_keys_next_tick_ms();
+    uint64_t now = supervisor_now_ms(), next = UINT64_MAX;
+    uint64_t cloud_next = quicpro_cloud_autoscale_next_ms();
+    uint64_t ocsp_next = quicpro_ocsp_next_ms();
+    if (g_reload_slot >= 0) next = g_ready_deadline_ms;
+    if (g_load_samples && g_autoscale_next_ms < next) next = g_autoscale_next_ms;
+    if (cloud_next && cloud_next < next) next = cloud_next;
+    if (ocsp_next && ocsp_next < next) next = ocsp_next;
+    if (g_pressure_level > 0 && g_pressure_relax_ms < next) next = g_pressure_relax_ms;
+    for (int i = 0; i < g_num_workers; ++i) {
+        if (g_draining[i].pid > 0 && g_draining[i].drain_deadline_ms && g_draining[i].drain_deadline_ms < next) {
+            next = g_draining[i].drain_deadline_ms;
+        }
+    }
+    if (next == UINT64_MAX) return timeout;
+    int wait = next <= now ? 0 : (next - now > INT_MAX ? INT_MAX : (int)(next - now));
+    return timeout < 0 || wait < timeout ? wait : timeout;
+}
+
+/* --- Rolling reload --- */
+
+static zend_bool reload_draining(void) {
+    for (int i = 0; i < g_num_workers; ++i) {
+        if (g_draining[i].pid > 0) return 1;
+    }
+    return 0;
+}
+
+static void reload_begin(quicpro_cluster_options_t *c_options) {
+    if (g_reload_slot >= 0 || reload_draining()) {
+        /* The next generation would share the draining one's half of the steering map */
+        g_reload_pending = 1;
+        return;
+    }
+    /* Spares hold the old steering program and would attach it again */
+    spares_discard();
+    g_generation++;
+    quicpro_reuseport_set_generation(g_generation);
+    spares_fill(c_options);
+    reload_next(c_options, 0);
+}
+
+/* Forks the successor of the first slot from `from_slot` that still runs an older generation */
+static void reload_next(quicpro_cluster_options_t *c_options, int from_slot) {
+    for (int i = from_slot; i < g_active_workers; ++i) {
+        if (g_worker_pool[i].pid > 0 && g_worker_pool[i].generation == g_generation) {
+            continue; /* Restarted since the reload began */
+        }
+        int ready_fd = -1;
+        pid_t pid = spawn_worker(c_options, i, &ready_fd);
+        if (pid < 0) {
+            php_error(E_WARNING, "[Master Supervisor] Failed to fork the successor of worker %d: %s. Keeping it.", i, strerror(errno));
+            continue;
+        }
+
+        /* The predecessor keeps its pidfd, under the draining tag */
+        g_draining[i] = g_worker_pool[i];
+        g_draining[i].drain_deadline_ms = 0;
+        if (g_draining[i].pidfd >= 0) {
+            struct epoll_event ev = { .events = EPOLLIN, .data.u64 = QP_SUPERVISOR_DRAINING | (uint64_t)i };
+            epoll_ctl(g_supervisor_epfd, EPOLL_CTL_MOD, g_draining[i].pidfd, &ev);
+        }
+        g_worker_pool[i] = (quicpro_worker_info_t){ .pid = pid, .worker_id = i, .start_time = time(NULL), .last_restart_time = time(NULL), .pidfd = -1, .generation = g_generation };
+        supervisor_watch(&g_worker_pool[i], (uint64_t)i);
+        quicpro_cluster_stats_worker_started(i, g_generation, pid, false);
+
+        g_reload_slot = i;
+        g_ready_deadline_ms = supervisor_now_ms() + (uint64_t)c_options->reload_ready_timeout_sec * 1000;
+        struct epoll_event ev = { .events = EPOLLIN, .data.u64 = QP_SUPERVISOR_READY };
+        if (ready_fd >= 0 && epoll_ctl(g_supervisor_epfd, EPOLL_CTL_ADD, ready_fd, &ev) == 0) {
+            g_ready_fd = ready_fd;
+        } else if (ready_fd >= 0) {
+            close(ready_fd); /* Only the deadline then */
+        }
+        return;
+    }
+    g_reload_slot = -1;
+    php_printf("[Master Supervisor] All workers run generation %u.\n", g_generation);
+}
+
+/* The successor listens (or died trying, or ran out of time): drain its predecessor, move on */
+static void reload_successor_ready(quicpro_cluster_options_t *c_options) {
+    int slot = g_reload_slot;
+    if (g_ready_fd >= 0) {
+        close(g_ready_fd);
+        g_ready_fd = -1;
+    }
+    if (g_draining[slot].pid > 0) {
+        kill(g_draining[slot].pid, SIGTERM);
+        g_draining[slot].drain_deadline_ms = supervisor_now_ms() + (uint64_t)c_options->graceful_shutdown_timeout_sec * 1000;
+    }
+    reload_next(c_options, slot + 1);
+}
+
+static void reload_expire_drains(void) {
+    uint64_t now = supervisor_now_ms();
+    for (int i = 0; i < g_num_workers; ++i) {
+        if (g_draining[i].pid > 0 && g_draining[i].drain_deadline_ms && now >= g_draining[i].drain_deadline_ms) {
+            php_error(E_WARNING, "[Master Supervisor] Worker %d (PID %d) did not drain in time. Killing it.", i, g_draining[i].pid);
+            kill(g_draining[i].pid, SIGKILL);
+            g_draining[i].drain_deadline_ms = 0; /* Reaped like any exit */
+        }
+    }
+}
+
+/* --- Autoscaling --- */
+
+static void autoscale_tick(quicpro_cluster_options_t *c_options) {
+    if (!g_load_samples) {
+        return;
+    }
+    uint64_t now_ms = supervisor_now_ms();
+    if (now_ms < g_autoscale_next_ms) {
+        return;
+    }
+    g_autoscale_next_ms = now_ms + (uint64_t)c_options->autoscale_interval_sec * 1000;
+
+    double busy_sum;
+    uint64_t depth_max;
+    int sampled = load_sample(g_load_samples, now_ms, &busy_sum, &depth_max);
+    if (sampled == 0) {
+        return; /* No instrumented loops (yet): nothing to go by */
+    }
+
+    double utilization = busy_sum / sampled;
+    zend_bool queued = c_options->scale_up_queue_depth > 0 && depth_max >= (uint64_t)c_options->scale_up_queue_depth;
+    if (utilization > c_options->scale_up_utilization || queued) {
+        g_scale_up_streak++;
+        g_scale_down_streak = 0;
+    } else if (utilization < c_options->scale_down_utilization) {
+        g_scale_down_streak++;
+        g_scale_up_streak = 0;
+    } else {
+        g_scale_up_streak = g_scale_down_streak = 0;
+    }
+
+    /* A reload owns the slots until it is done */
+    if (now_ms < g_autoscale_quiet_until_ms || g_reload_slot >= 0 || g_reload_pending) {
+        return;
+    }
+    zend_bool scaled = 0;
+    if (g_scale_up_streak >= QP_AUTOSCALE_UP_SAMPLES && g_active_workers < c_options->max_workers) {
+        scaled = autoscale_up(c_options);
+        if (scaled) php_printf("[Master Supervisor] Load %.0f%%, queue %llu: scaled up to %d workers.\n", utilization * 100, (unsigned long long)depth_max, g_active_workers);
+    } else if (g_scale_down_streak >= QP_AUTOSCALE_DOWN_SAMPLES && g_active_workers > c_options->min_workers) {
+        scaled = autoscale_down(c_options);
+        if (scaled) php_printf("[Master Supervisor] Load %.0f%%: scaled down to %d workers.\n", utilization * 100, g_active_workers);
+    }
+    if (!scaled) {
+        return;
+    }
+    g_scale_up_streak = g_scale_down_streak = 0;
+    g_autoscale_quiet_until_ms = now_ms + (uint64_t)c_options->autoscale_cooldown_sec * 1000;
+}
+
+/* Utilisation: the share of the interval since `samples` that each running worker's loop did not spend
+ * waiting, summed into `busy_sum`. @return how many workers had a previous sample to go by */
+static int load_sample(quicpro_load_sample_t *samples, uint64_t now_ms, double *busy_sum, uint64_t *depth_max) {
+    int sampled = 0;
+    *busy_sum = 0;
+    *depth_max = 0;
+    for (int i = 0; i < g_active_workers; ++i) {
+        quicpro_worker_info_t *w = &g_worker_pool[i];
+        quicpro_load_sample_t *prev = &samples[i];
+        uint64_t idle_us, depth;
+        if (w->pid <= 0 || !quicpro_cluster_stats_load_sample(i, w->generation, &idle_us, &depth)) {
+            prev->pid = 0;
+            continue;
+        }
+        uint64_t at_us = now_ms * 1000;
+        if (prev->pid == w->pid && at_us > prev->at_us && idle_us >= prev->idle_us) {
+            double idle = (double)(idle_us - prev->idle_us) / (double)(at_us - prev->at_us);
+            *busy_sum += idle >= 1.0 ? 0.0 : 1.0 - idle;
+            sampled++;
+            if (depth > *depth_max) *depth_max = depth;
+        }
+        *prev = (quicpro_load_sample_t){ .at_us = at_us, .idle_us = idle_us, .pid = w->pid };
+    }
+    return sampled;
+}
+
+/* The node's load for the fleet: busy loops over every slot it may run, so a node the worker
+ * autoscaler has not filled yet still has room */
+static void cloud_autoscale_tick(void) {
+    uint64_t due = quicpro_cloud_autoscale_next_ms(), now_ms = supervisor_now_ms();
+    if (!g_cloud_samples || !due || now_ms < due) {
+        return;
+    }
+    double busy_sum;
+    uint64_t depth_max;
+    int sampled = load_sample(g_cloud_samples, now_ms, &busy_sum, &depth_max);
+    quicpro_cloud_autoscale_tick(sampled ? busy_sum / g_num_workers : -1.0, now_ms);
+}
+
+/* Starts the next slot's worker and lets the steering program include it */
+static zend_bool autoscale_up(quicpro_cluster_options_t *c_options) {
+    int slot = g_active_workers;
+    if (g_draining[slot].pid > 0) {
+        return 0; /* Its last worker still drains into the same stats block and map slot */
+    }
+    pid_t pid = spawn_worker(c_options, slot, NULL);
+    if (pid < 0) {
+        php_error(E_WARNING, "[Master Supervisor] Failed to start worker %d: %s", slot, strerror(errno));
+        return 0;
+    }
+    g_worker_pool[slot] = (quicpro_worker_info_t){ .pid = pid, .worker_id = slot, .start_time = time(NULL), .last_restart_time = time(NULL), .pidfd = -1, .generation = g_generation };
+    supervisor_watch(&g_worker_pool[slot], (uint64_t)slot);
+    quicpro_cluster_stats_worker_started(slot, g_generation, pid, false);
+    g_active_workers++;
+    quicpro_reuseport_set_active(g_active_workers);
+    quicpro_cluster_stats_set_active(g_active_workers);
+
+    if (Z_TYPE(c_options->on_worker_start_callable) != IS_UNDEF) {
+        zval args[2], retval;
+        ZVAL_LONG(&args[0], slot);
+        ZVAL_LONG(&args[1], pid);
+        call_user_function_ex(NULL, NULL, &c_options->on_worker_start_callable, &retval, 2, args, 0, NULL);
+        zval_ptr_dtor(&retval);
+    }
+    return 1;
+}
+
+/* Takes the highest slot out of the steering program and drains its worker like a reload's predecessor */
+static zend_bool autoscale_down(quicpro_cluster_options_t *c_options) {
+    int slot = g_active_workers - 1;
+    if (g_draining[slot].pid > 0) {
+        return 0;
+    }
+    g_active_workers--;
+    quicpro_reuseport_set_active(g_active_workers);
+    quicpro_cluster_stats_set_active(g_active_workers);
+    quicpro_cluster_bus_retire(slot);
+    if (g_worker_pool[slot].pid <= 0) {
+        return 1; /* Already gone, not restarted */
+    }
+
+    g_draining[slot] = g_worker_pool[slot];
+    if (g_draining[slot].pidfd >= 0) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.u64 = QP_SUPERVISOR_DRAINING | (uint64_t)slot };
+        epoll_ctl(g_supervisor_epfd, EPOLL_CTL_MOD, g_draining[slot].pidfd, &ev);
+    }
+    kill(g_draining[slot].pid, SIGTERM);
+    g_draining[slot].drain_deadline_ms = supervisor_now_ms() + (uint64_t)c_options->graceful_shutdown_timeout_sec * 1000;
+    g_worker_pool[slot] = (quicpro_worker_info_t){ .pid = 0, .worker_id = slot, .pidfd = -1 };
+    g_load_samples[slot].pid = 0;
+    return 1;
+}
+
+/* --- Load shedding under cgroup pressure --- */
+
+/* Adds every armed PSI trigger to the supervisor loop */
+static void pressure_watch(void) {
+    for (int i = 0; i < g_num_workers; ++i) {
+        for (int r = 0; r < QUICPRO_CGROUP_RESOURCES; ++r) {
+            int fd = quicpro_cgroup_pressure_fd(i, (quicpro_cgroup_resource_t)r);
+            if (fd < 0) continue;
+            struct epoll_event ev = { .events = EPOLLPRI, .data.u64 = QP_SUPERVISOR_PRESSURE | (uint64_t)(i * QUICPRO_CGROUP_RESOURCES + r) };
+            if (epoll_ctl(g_supervisor_epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+                php_error(E_WARNING, "[Master Supervisor] Cannot watch the %s pressure of worker %d: %s", quicpro_cgroup_resource_name((quicpro_cgroup_resource_t)r), i, strerror(errno));
+            }
         }
     }
 }
 
+static void pressure_set_level(quicpro_cluster_options_t *c_options, unsigned level, int worker_id, quicpro_cgroup_resource_t resource) {
+    g_pressure_level = level;
+    g_pressure_relax_ms = level ? supervisor_now_ms() + (uint64_t)c_options->pressure_relax_sec * 1000 : 0;
+    quicpro_rate_limit_set_pressure(level);
+
+    if (Z_TYPE(c_options->on_pressure_callable) != IS_UNDEF) {
+        zval args[3], retval;
+        ZVAL_LONG(&args[0], worker_id); /* -1 when the level falls */
+        ZVAL_STRING(&args[1], worker_id >= 0 ? quicpro_cgroup_resource_name(resource) : "");
+        ZVAL_LONG(&args[2], (zend_long)level);
+        call_user_function_ex(NULL, NULL, &c_options->on_pressure_callable, &retval, 3, args, 0, NULL);
+        zval_ptr_dtor(&args[1]);
+        zval_ptr_dtor(&retval);
+    }
+}
+
+/* A worker's group stalled beyond 'pressure_stall_ms': shed one more level of load */
+static void pressure_event(quicpro_cluster_options_t *c_options, int worker_id, quicpro_cgroup_resource_t resource) {
+    unsigned level = g_pressure_level < QUICPRO_RATE_LIMIT_MAX_PRESSURE ? g_pressure_level + 1 : g_pressure_level;
+    php_error(E_WARNING, "[Master Supervisor] Worker %d is stalling on %s; load shedding level %u.", worker_id, quicpro_cgroup_resource_name(resource), level);
+    pressure_set_level(c_options, level, worker_id, resource);
+}
+
+/* One level back for every quiet 'pressure_relax_sec' */
+static void pressure_tick(quicpro_cluster_options_t *c_options) {
+    if (g_pressure_level > 0 && supervisor_now_ms() >= g_pressure_relax_ms) {
+        pressure_set_level(c_options, g_pressure_level - 1, -1, QUICPRO_CGROUP_CPU);
+    }
+}
+
+/* Called by a worker's listeners once they are bound: its predecessor may start draining */
+void quicpro_cluster_worker_listening(void) {
+    if (g_worker_ready_fd >= 0) {
+        /* The master may have stopped waiting: no SIGPIPE for that */
+        ssize_t ignored = send(g_worker_ready_fd, "1", 1, MSG_NOSIGNAL);
+        (void)ignored;
+        close(g_worker_ready_fd);
+        g_worker_ready_fd = -1;
+    }
+}
+
+/* Drains the signalfd; returns true if a SIGCHLD was among the signals */
+static zend_bool supervisor_read_signals(void) {
+    struct signalfd_siginfo si;
+    zend_bool child = 0;
+    while (read(g_signal_fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+        switch (si.ssi_signo) {
+            case SIGINT:
+            case SIGTERM:
+                g_shutdown_request = 1;
+                break;
+            case SIGHUP:
+                g_reload_request = 1;
+                break;
+            case SIGCHLD:
+                child = 1;
+                break;
+        }
+    }
+    return child;
+}
+
 /* Forks a single worker and sets up its environment */
 static pid_t fork_and_start_worker(quicpro_cluster_options_t *c_options, int worker_id) {
     pid_t pid = fork();
@@ -307,15 +1111,144 @@ static pid_t fork_and_start_worker(quicpro_cluster_options_t *c_options, int wor
     return pid;
 }
 
+/*
+ * Starts slot `worker_id`'s worker from a spare if there is one, else by
+ * forking. With `ready_fd`, also returns the master's end of a socket the
+ * worker writes to once it listens (quicpro_cluster_worker_listening()).
+ */
+static pid_t spawn_worker(quicpro_cluster_options_t *c_options, int worker_id, int *ready_fd) {
+    quicpro_spare_assign_t assign = { .worker_id = worker_id, .generation = g_generation };
+    for (int i = 0; i < g_num_spares; ++i) {
+        if (g_spares[i].pid <= 0) {
+            continue;
+        }
+        pid_t pid = g_spares[i].pid;
+        int control = g_spare_control[i];
+        supervisor_unwatch(&g_spares[i]); /* The caller watches it as a worker */
+        g_spares[i].pid = 0;
+        g_spare_control[i] = -1;
+        if (send(control, &assign, sizeof(assign), MSG_NOSIGNAL) != (ssize_t)sizeof(assign)) {
+            kill(pid, SIGKILL);
+            close(control);
+            continue;
+        }
+        if (ready_fd) {
+            *ready_fd = control;
+        } else {
+            close(control);
+        }
+        return pid;
+    }
+
+    int ready[2] = { -1, -1 };
+    if (ready_fd && socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, ready) != 0) {
+        ready[0] = ready[1] = -1;
+    }
+    g_worker_ready_fd = ready[1];
+    pid_t pid = fork_and_start_worker(c_options, worker_id);
+    int saved = errno;
+    if (ready[1] >= 0) close(ready[1]);
+    g_worker_ready_fd = -1;
+    if (pid < 0) {
+        if (ready[0] >= 0) close(ready[0]);
+        errno = saved;
+        return -1;
+    }
+    if (ready_fd) *ready_fd = ready[0];
+    return pid;
+}
+
+/* Forks spares into the empty spare slots */
+static void spares_fill(quicpro_cluster_options_t *c_options) {
+    if (g_shutdown_request) {
+        return;
+    }
+    for (int i = 0; i < g_num_spares; ++i) {
+        if (g_spares[i].pid > 0) {
+            continue;
+        }
+        int control[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, control) != 0) {
+            return;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(control[0]);
+            spare_process_main(c_options, control[1]);
+            exit(0);
+        }
+        close(control[1]);
+        if (pid < 0) {
+            close(control[0]);
+            php_error(E_WARNING, "[Master Supervisor] Failed to fork a spare worker: %s", strerror(errno));
+            return;
+        }
+        g_spares[i] = (quicpro_worker_info_t){ .pid = pid, .worker_id = -1, .start_time = time(NULL), .pidfd = -1, .generation = g_generation };
+        g_spare_control[i] = control[0];
+        supervisor_watch(&g_spares[i], QP_SUPERVISOR_SPARE | (uint64_t)i);
+    }
+}
+
+/* Lets every spare go: each exits as its control socket reaches EOF */
+static void spares_discard(void) {
+    for (int i = 0; i < g_num_spares; ++i) {
+        if (g_spares[i].pid <= 0) {
+            continue;
+        }
+        supervisor_unwatch(&g_spares[i]);
+        close(g_spare_control[i]);
+        g_spare_control[i] = -1;
+        g_spares[i].pid = 0; /* Reaped as "not ours" */
+    }
+}
+
+/* A spare: waits for a slot, then becomes that slot's worker */
+static void spare_process_main(quicpro_cluster_options_t *c_options, int control_fd) {
+    /* Until assigned, the master's signals stop a spare like any process */
+    for (int i = 0; i < g_num_spares; ++i) {
+        if (g_spare_control[i] >= 0) close(g_spare_control[i]);
+    }
+    if (g_sigmask_saved) sigprocmask(SIG_SETMASK, &g_saved_sigmask, NULL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+
+    quicpro_spare_assign_t assign;
+    ssize_t n;
+    do {
+        n = recv(control_fd, &assign, sizeof(assign), 0);
+    } while (n < 0 && errno == EINTR);
+    if (n != (ssize_t)sizeof(assign) || assign.worker_id < 0 || assign.worker_id >= g_num_workers) {
+        _exit(0); /* Discarded, or the master is gone */
+    }
+
+    g_generation = assign.generation;
+    g_worker_ready_fd = control_fd;
+    worker_process_main(c_options, assign.worker_id);
+}
+
 /* The main function for the forked child process */
 static void worker_process_main(quicpro_cluster_options_t *c_options, int worker_id) {
+    /* The supervisor's descriptors and blocked signals are not the worker's */
+    for (int i = 0; i < g_num_workers; ++i) {
+        if (g_worker_pool[i].pidfd >= 0) close(g_worker_pool[i].pidfd);
+        if (g_draining[i].pidfd >= 0) close(g_draining[i].pidfd);
+    }
+    if (g_ready_fd >= 0) close(g_ready_fd);
+    if (g_signal_fd >= 0) close(g_signal_fd);
+    if (g_supervisor_epfd >= 0) close(g_supervisor_epfd);
+    if (g_sigmask_saved) sigprocmask(SIG_SETMASK, &g_saved_sigmask, NULL);
+
     /* Child should have its own signal handling, often reset to defaults */
     signal(SIGTERM, SIG_DFL);
     signal(SIGINT, SIG_DFL);
     signal(SIGHUP, SIG_DFL);
 
     /* Set CPU Affinity if enabled */
-    if (c_options->enable_cpu_affinity) {
+    if (c_options->numa_aware_placement) {
+        const char *ifname = c_options->placement_interface ? c_options->placement_interface : quicpro_bare_metal_config.io_xdp_interface;
+        quicpro_topology_place_worker(worker_id, ifname, quicpro_bare_metal_config.io_thread_numa_node_policy);
+    } else if (c_options->enable_cpu_affinity) {
         cpu_set_t cpuset;
         CPU_ZERO(&cpuset);
         CPU_SET(worker_id % sysconf(_SC_NPROCESSORS_ONLN), &cpuset); // Simple round-robin affinity
@@ -345,6 +1278,26 @@ static void worker_process_main(quicpro_cluster_options_t *c_options, int worker
         }
     }
 
+    /*
+     * Bind this worker to its own NIC queue (worker_id % channels) and open
+     * the XSK socket now, while CAP_NET_RAW is still held. A no-op unless
+     * quicpro.io_xdp_interface is configured.
+     */
+    quicpro_xdp_bind_worker(worker_id);
+    quicpro_xdp_available();
+
+    /* Connection IDs issued by this worker route back to its listener socket */
+    quicpro_reuseport_bind_worker(worker_id, g_generation);
+
+    /* From here on this worker counts into its own stats block */
+    quicpro_cluster_stats_attach_worker(worker_id, g_generation);
+    quicpro_cluster_bus_attach_worker(worker_id, g_generation);
+    quicpro_conn_snapshot_attach_worker(worker_id, g_generation);
+    quicpro_metrics_attach_worker(worker_id, g_generation);
+
+    /* Join the slot's cgroup while the master's permissions are still ours */
+    quicpro_cgroup_attach_worker(worker_id);
+
     /* Drop Privileges (change UID/GID) */
     if (c_options->worker_gid > 0) {
         if (setgid(c_options->worker_gid) != 0) {
@@ -359,18 +1312,6 @@ static void worker_process_main(quicpro_cluster_options_t *c_options, int worker
         }
     }
 
-    /* Move to cgroup */
-    if (c_options->worker_cgroup_path) {
-        /* This logic is simplified. Real cgroup v2 interaction is via cgroup.procs file */
-        FILE *f = fopen(c_options->worker_cgroup_path, "w");
-        if (f) {
-            fprintf(f, "%d\n", getpid());
-            fclose(f);
-        } else {
-             php_error(E_WARNING, "[Worker %d] Failed to write to cgroup tasks file '%s': %s", worker_id, c_options->worker_cgroup_path, strerror(errno));
-        }
-    }
-
     /* Call the main PHP worker function */
     zval args[1], retval;
     ZVAL_LONG(&args[0], worker_id);
@@ -384,19 +1325,6 @@ static void worker_process_main(quicpro_cluster_options_t *c_options, int worker
     exit(0);
 }
 
-/* Signal handler for the master process */
-static void cluster_signal_handler(int signo) {
-    switch (signo) {
-        case SIGINT:
-        case SIGTERM:
-            g_shutdown_request = 1;
-            break;
-        case SIGHUP:
-            g_reload_request = 1;
-            break;
-    }
-}
-
 /* Helper to parse PHP options array into C struct */
 static int parse_options_from_php(zval *php_options_array, quicpro_cluster_options_t *c_options) {
     HashTable *ht = Z_ARRVAL_P(php_options_array);
@@ -408,7 +1336,27 @@ static int parse_options_from_php(zval *php_options_array, quicpro_cluster_optio
     c_options->max_restarts_per_worker = 5;
     c_options->restart_interval_sec = 60;
     c_options->graceful_shutdown_timeout_sec = 30;
+    c_options->reload_ready_timeout_sec = 10;
+    c_options->spare_workers = 0;
+    c_options->autoscale_interval_sec = 5;
+    c_options->autoscale_cooldown_sec = 60;
+    c_options->scale_up_utilization = 0.75;
+    c_options->scale_down_utilization = 0.25;
+    c_options->scale_up_queue_depth = 0;
+    c_options->message_bus_ring_bytes = 0;
+    c_options->connection_snapshot_capacity = 0;
+    c_options->connection_snapshot_interval_ms = 1000;
+    c_options->pressure_stall_ms = 0;
+    c_options->pressure_window_ms = 1000;
+    c_options->pressure_relax_sec = 30;
+    c_options->metrics_enabled = true;
+    c_options->metrics_port = 9091;
+    c_options->reuseport_cid_steering = true;
     c_options->worker_loop_usleep_usec = 10000;
+    c_options->cloud_autoscale_interval_sec = 60;
+    c_options->cloud_autoscale_season_sec = 86400;
+    c_options->cloud_autoscale_lead_sec = 300;
+    c_options->cloud_warm_nodes = 0;
 
     /* REQUIRED: worker_main_callable */
     if (!(zv_temp = zend_hash_str_find(ht, "worker_main_callable", sizeof("worker_main_callable")-1))) {
@@ -422,10 +1370,72 @@ static int parse_options_from_php(zval *php_options_array, quicpro_cluster_optio
     }
 
     /* Optional settings */
+    if ((zv_temp = zend_hash_str_find(ht, "preload_callable", sizeof("preload_callable")-1))) {
+        if (!zend_is_callable(zv_temp, 0, NULL)) {
+            throw_mcp_error_as_php_exception(0, "Cluster option 'preload_callable' is not a valid callable.");
+            return FAILURE;
+        }
+        ZVAL_COPY(&c_options->preload_callable, zv_temp);
+    } else {
+        ZVAL_UNDEF(&c_options->preload_callable);
+    }
+
+    if ((zv_temp = zend_hash_str_find(ht, "spare_workers", sizeof("spare_workers")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) >= 0) {
+        c_options->spare_workers = (int)MIN(Z_LVAL_P(zv_temp), 1024);
+    }
+
     if ((zv_temp = zend_hash_str_find(ht, "num_workers", sizeof("num_workers")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) > 0) {
         c_options->num_workers = (int)Z_LVAL_P(zv_temp);
     }
 
+    /* Autoscaling: between min_workers and max_workers, starting at num_workers */
+    c_options->min_workers = c_options->max_workers = c_options->num_workers;
+    zend_bool min_set = 0, max_set = 0;
+    if ((zv_temp = zend_hash_str_find(ht, "min_workers", sizeof("min_workers")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) > 0) {
+        c_options->min_workers = (int)Z_LVAL_P(zv_temp);
+        min_set = 1;
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "max_workers", sizeof("max_workers")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) > 0) {
+        c_options->max_workers = (int)Z_LVAL_P(zv_temp);
+        max_set = 1;
+    }
+    if (!max_set && c_options->min_workers > c_options->max_workers) c_options->max_workers = c_options->min_workers;
+    if (!min_set && c_options->min_workers > c_options->max_workers) c_options->min_workers = c_options->max_workers;
+    if (c_options->min_workers > c_options->max_workers) {
+        throw_mcp_error_as_php_exception(0, "Cluster option 'min_workers' exceeds 'max_workers'.");
+        return FAILURE;
+    }
+    if (c_options->num_workers < c_options->min_workers) c_options->num_workers = c_options->min_workers;
+    if (c_options->num_workers > c_options->max_workers) c_options->num_workers = c_options->max_workers;
+    if ((zv_temp = zend_hash_str_find(ht, "autoscale_interval_sec", sizeof("autoscale_interval_sec")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) > 0) {
+        c_options->autoscale_interval_sec = (int)Z_LVAL_P(zv_temp);
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "autoscale_cooldown_sec", sizeof("autoscale_cooldown_sec")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) >= 0) {
+        c_options->autoscale_cooldown_sec = (int)Z_LVAL_P(zv_temp);
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "scale_up_utilization", sizeof("scale_up_utilization")-1)) && (Z_TYPE_P(zv_temp) == IS_DOUBLE || Z_TYPE_P(zv_temp) == IS_LONG)) {
+        c_options->scale_up_utilization = zval_get_double(zv_temp);
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "scale_down_utilization", sizeof("scale_down_utilization")-1)) && (Z_TYPE_P(zv_temp) == IS_DOUBLE || Z_TYPE_P(zv_temp) == IS_LONG)) {
+        c_options->scale_down_utilization = zval_get_double(zv_temp);
+    }
+    if (c_options->scale_down_utilization >= c_options->scale_up_utilization) {
+        throw_mcp_error_as_php_exception(0, "Cluster option 'scale_down_utilization' must be below 'scale_up_utilization'.");
+        return FAILURE;
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "scale_up_queue_depth", sizeof("scale_up_queue_depth")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) >= 0) {
+        c_options->scale_up_queue_depth = (int)Z_LVAL_P(zv_temp);
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "message_bus_ring_bytes", sizeof("message_bus_ring_bytes")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) >= 0) {
+        c_options->message_bus_ring_bytes = Z_LVAL_P(zv_temp);
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "connection_snapshot_capacity", sizeof("connection_snapshot_capacity")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) >= 0 && Z_LVAL_P(zv_temp) <= INT_MAX) {
+        c_options->connection_snapshot_capacity = (int)Z_LVAL_P(zv_temp);
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "connection_snapshot_interval_ms", sizeof("connection_snapshot_interval_ms")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) > 0 && Z_LVAL_P(zv_temp) <= INT_MAX) {
+        c_options->connection_snapshot_interval_ms = (int)Z_LVAL_P(zv_temp);
+    }
+
     if ((zv_temp = zend_hash_str_find(ht, "on_worker_start_callable", sizeof("on_worker_start_callable")-1)) && zend_is_callable(zv_temp, 0, NULL)) {
         ZVAL_COPY(&c_options->on_worker_start_callable, zv_temp);
     } else {
@@ -438,10 +1448,122 @@ static int parse_options_from_php(zval *php_options_array, quicpro_cluster_optio
         ZVAL_UNDEF(&c_options->on_worker_exit_callable);
     }
 
+    if ((zv_temp = zend_hash_str_find(ht, "graceful_shutdown_timeout_sec", sizeof("graceful_shutdown_timeout_sec")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) >= 0) {
+        c_options->graceful_shutdown_timeout_sec = (int)Z_LVAL_P(zv_temp);
+    }
+
+    if ((zv_temp = zend_hash_str_find(ht, "reload_ready_timeout_sec", sizeof("reload_ready_timeout_sec")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) >= 0) {
+        c_options->reload_ready_timeout_sec = (int)Z_LVAL_P(zv_temp);
+    }
+
+    if ((zv_temp = zend_hash_str_find(ht, "enable_cpu_affinity", sizeof("enable_cpu_affinity")-1))) {
+        c_options->enable_cpu_affinity = zend_is_true(zv_temp);
+    }
+
+    if ((zv_temp = zend_hash_str_find(ht, "numa_aware_placement", sizeof("numa_aware_placement")-1))) {
+        c_options->numa_aware_placement = zend_is_true(zv_temp);
+    }
+
+    if ((zv_temp = zend_hash_str_find(ht, "reuseport_steering", sizeof("reuseport_steering")-1))) {
+        if (Z_TYPE_P(zv_temp) != IS_STRING
+            || (!zend_string_equals_literal(Z_STR_P(zv_temp), "cid") && !zend_string_equals_literal(Z_STR_P(zv_temp), "hash"))) {
+            throw_mcp_error_as_php_exception(0, "Cluster option 'reuseport_steering' must be \"cid\" or \"hash\".");
+            return FAILURE;
+        }
+        c_options->reuseport_cid_steering = zend_string_equals_literal(Z_STR_P(zv_temp), "cid");
+    }
+
+    if ((zv_temp = zend_hash_str_find(ht, "placement_interface", sizeof("placement_interface")-1)) && Z_TYPE_P(zv_temp) == IS_STRING && Z_STRLEN_P(zv_temp) > 0) {
+        c_options->placement_interface = estrndup(Z_STRVAL_P(zv_temp), Z_STRLEN_P(zv_temp));
+    }
+
     if ((zv_temp = zend_hash_str_find(ht, "master_pid_file_path", sizeof("master_pid_file_path")-1)) && Z_TYPE_P(zv_temp) == IS_STRING) {
         c_options->master_pid_file_path = estrndup(Z_STRVAL_P(zv_temp), Z_STRLEN_P(zv_temp));
     }
 
+    /* cgroup v2: per-worker groups, their limits and pressure triggers */
+    if ((zv_temp = zend_hash_str_find(ht, "worker_cgroup_path", sizeof("worker_cgroup_path")-1)) && Z_TYPE_P(zv_temp) == IS_STRING && Z_STRLEN_P(zv_temp) > 0) {
+        c_options->worker_cgroup_path = estrndup(Z_STRVAL_P(zv_temp), Z_STRLEN_P(zv_temp));
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "worker_cgroup_cpu_max", sizeof("worker_cgroup_cpu_max")-1))) {
+        if (Z_TYPE_P(zv_temp) == IS_STRING && Z_STRLEN_P(zv_temp) > 0) {
+            c_options->worker_cgroup_cpu_max = estrndup(Z_STRVAL_P(zv_temp), Z_STRLEN_P(zv_temp));
+        } else if ((Z_TYPE_P(zv_temp) == IS_LONG || Z_TYPE_P(zv_temp) == IS_DOUBLE) && zval_get_double(zv_temp) > 0) {
+            /* A number of CPUs: that much quota per 100 ms period */
+            c_options->worker_cgroup_cpu_max = emalloc(48);
+            snprintf(c_options->worker_cgroup_cpu_max, 48, "%ld 100000", (long)(zval_get_double(zv_temp) * 100000));
+        }
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "worker_cgroup_memory_high", sizeof("worker_cgroup_memory_high")-1))) {
+        if (Z_TYPE_P(zv_temp) == IS_STRING && Z_STRLEN_P(zv_temp) > 0) {
+            c_options->worker_cgroup_memory_high = estrndup(Z_STRVAL_P(zv_temp), Z_STRLEN_P(zv_temp));
+        } else if (Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) > 0) {
+            c_options->worker_cgroup_memory_high = emalloc(24);
+            snprintf(c_options->worker_cgroup_memory_high, 24, ZEND_LONG_FMT, Z_LVAL_P(zv_temp));
+        }
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "pressure_stall_ms", sizeof("pressure_stall_ms")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) >= 0) {
+        c_options->pressure_stall_ms = (int)Z_LVAL_P(zv_temp);
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "pressure_window_ms", sizeof("pressure_window_ms")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) > 0) {
+        c_options->pressure_window_ms = (int)Z_LVAL_P(zv_temp);
+    }
+    if (c_options->pressure_stall_ms > c_options->pressure_window_ms) {
+        throw_mcp_error_as_php_exception(0, "Cluster option 'pressure_stall_ms' exceeds 'pressure_window_ms'.");
+        return FAILURE;
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "pressure_relax_sec", sizeof("pressure_relax_sec")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) > 0) {
+        c_options->pressure_relax_sec = (int)Z_LVAL_P(zv_temp);
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "on_pressure_callable", sizeof("on_pressure_callable")-1)) && zend_is_callable(zv_temp, 0, NULL)) {
+        ZVAL_COPY(&c_options->on_pressure_callable, zv_temp);
+    } else {
+        ZVAL_UNDEF(&c_options->on_pressure_callable);
+    }
+
+    /* Metric shards and the master's scrape endpoint */
+    if ((zv_temp = zend_hash_str_find(ht, "metrics_enabled", sizeof("metrics_enabled")-1))) {
+        c_options->metrics_enabled = zend_is_true(zv_temp);
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "metrics_port", sizeof("metrics_port")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) >= 0 && Z_LVAL_P(zv_temp) <= 65535) {
+        c_options->metrics_port = (int)Z_LVAL_P(zv_temp);
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "metrics_host", sizeof("metrics_host")-1)) && Z_TYPE_P(zv_temp) == IS_STRING && Z_STRLEN_P(zv_temp) > 0) {
+        c_options->metrics_host = estrndup(Z_STRVAL_P(zv_temp), Z_STRLEN_P(zv_temp));
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "cluster_name", sizeof("cluster_name")-1)) && Z_TYPE_P(zv_temp) == IS_STRING && Z_STRLEN_P(zv_temp) > 0) {
+        c_options->cluster_name = estrndup(Z_STRVAL_P(zv_temp), Z_STRLEN_P(zv_temp));
+    }
+
+    /* Fleet sizing through the node provider */
+    if ((zv_temp = zend_hash_str_find(ht, "cloud_autoscale", sizeof("cloud_autoscale")-1))) {
+        c_options->cloud_autoscale = zend_is_true(zv_temp);
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "cloud_autoscale_interval_sec", sizeof("cloud_autoscale_interval_sec")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) > 0) {
+        c_options->cloud_autoscale_interval_sec = (int)Z_LVAL_P(zv_temp);
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "cloud_autoscale_season_sec", sizeof("cloud_autoscale_season_sec")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) > 0) {
+        c_options->cloud_autoscale_season_sec = (int)Z_LVAL_P(zv_temp);
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "cloud_autoscale_lead_sec", sizeof("cloud_autoscale_lead_sec")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) >= 0) {
+        c_options->cloud_autoscale_lead_sec = (int)Z_LVAL_P(zv_temp);
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "cloud_warm_nodes", sizeof("cloud_warm_nodes")-1)) && Z_TYPE_P(zv_temp) == IS_LONG && Z_LVAL_P(zv_temp) >= 0) {
+        c_options->cloud_warm_nodes = (int)Z_LVAL_P(zv_temp);
+    }
+    if (c_options->cloud_autoscale_season_sec < c_options->cloud_autoscale_interval_sec) {
+        throw_mcp_error_as_php_exception(0, "Cluster option 'cloud_autoscale_season_sec' is shorter than 'cloud_autoscale_interval_sec'.");
+        return FAILURE;
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "cloud_autoscale_state_path", sizeof("cloud_autoscale_state_path")-1)) && Z_TYPE_P(zv_temp) == IS_STRING && Z_STRLEN_P(zv_temp) > 0) {
+        c_options->cloud_autoscale_state_path = estrndup(Z_STRVAL_P(zv_temp), Z_STRLEN_P(zv_temp));
+    }
+    if ((zv_temp = zend_hash_str_find(ht, "cloud_provider_callable", sizeof("cloud_provider_callable")-1)) && zend_is_callable(zv_temp, 0, NULL)) {
+        ZVAL_COPY(&c_options->cloud_provider_callable, zv_temp);
+    } else {
+        ZVAL_UNDEF(&c_options->cloud_provider_callable);
+    }
+
     /* ... TODO: Add parsing for ALL other options from the struct (affinity, niceness, etc.) ... */
 
     return SUCCESS;
@@ -450,12 +1572,20 @@ static int parse_options_from_php(zval *php_options_array, quicpro_cluster_optio
 /* Helper to free memory allocated during parsing */
 static void cleanup_c_options(quicpro_cluster_options_t *c_options) {
     if (c_options->master_pid_file_path) efree(c_options->master_pid_file_path);
+    if (c_options->placement_interface) efree(c_options->placement_interface);
     if (c_options->cluster_name) efree(c_options->cluster_name);
     if (c_options->worker_cgroup_path) efree(c_options->worker_cgroup_path);
+    if (c_options->worker_cgroup_cpu_max) efree(c_options->worker_cgroup_cpu_max);
+    if (c_options->worker_cgroup_memory_high) efree(c_options->worker_cgroup_memory_high);
+    if (c_options->metrics_host) efree(c_options->metrics_host);
+    if (c_options->cloud_autoscale_state_path) efree(c_options->cloud_autoscale_state_path);
 
     if (Z_TYPE(c_options->worker_main_callable) != IS_UNDEF) zval_ptr_dtor(&c_options->worker_main_callable);
     if (Z_TYPE(c_options->on_worker_start_callable) != IS_UNDEF) zval_ptr_dtor(&c_options->on_worker_start_callable);
     if (Z_TYPE(c_options->on_worker_exit_callable) != IS_UNDEF) zval_ptr_dtor(&c_options->on_worker_exit_callable);
+    if (Z_TYPE(c_options->preload_callable) != IS_UNDEF) zval_ptr_dtor(&c_options->preload_callable);
+    if (Z_TYPE(c_options->on_pressure_callable) != IS_UNDEF) zval_ptr_dtor(&c_options->on_pressure_callable);
+    if (Z_TYPE(c_options->cloud_provider_callable) != IS_UNDEF) zval_ptr_dtor(&c_options->cloud_provider_callable);
 }
 
 /* Helpers for PID file management */
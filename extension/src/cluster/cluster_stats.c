@@ -0,0 +1,421 @@
+/*
+ * src/cluster/cluster_stats.c – Shared-memory worker metrics for Quicpro\Cluster
+ * ==============================================================================
+ *
+ * See include/cluster/cluster_stats.h. Segment layout: a one-cache-line
+ * header, then two quicpro_worker_stats_t per worker slot, the second half
+ * of them for odd generations. The master writes the magic last, so a
+ * reader that sees it sees a complete layout. Every counter has a single
+ * writer, the block's worker, or the master while the block has none;
+ * readers load them relaxed and accept that a sample is not one instant
+ * across all counters.
+ */
+
+#include "php_quicpro.h"
+#include "cluster/cluster_stats.h"
+#include "cancel.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define QP_STATS_MAGIC      UINT64_C(0x3154415453505051)    /* "QPPSTAT1", little-endian */
+#define QP_STATS_NAME_MAX   64
+
+typedef struct {
+    _Alignas(64) _Atomic uint64_t magic;
+    uint32_t nworkers;
+    uint32_t block_size;        /* sizeof(quicpro_worker_stats_t) of the writer */
+    uint64_t master_pid;
+    uint64_t started_at_ms;     /* CLOCK_REALTIME */
+    _Atomic uint32_t active_workers;    /* Slots the autoscaler currently runs */
+} quicpro_stats_header_t;
+
+quicpro_worker_stats_t *quicpro_worker_stats = NULL;
+
+static quicpro_stats_header_t *quicpro_stats_seg = NULL;
+static size_t                  quicpro_stats_seg_size;
+static pid_t                   quicpro_stats_owner;     /* The master that created it */
+
+static inline uint64_t quicpro_stats_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static inline size_t quicpro_stats_size(uint32_t nworkers)
+{
+    return sizeof(quicpro_stats_header_t) + 2 * (size_t)nworkers * sizeof(quicpro_worker_stats_t);
+}
+
+/* Block `i` of 2 * nworkers */
+static inline quicpro_worker_stats_t *quicpro_stats_block(const quicpro_stats_header_t *h, uint32_t i)
+{
+    return (quicpro_worker_stats_t *)((unsigned char *)h + sizeof(*h)) + i;
+}
+
+/* The block of slot `worker_id` in `generation`, NULL without one */
+static quicpro_worker_stats_t *quicpro_stats_slot(int worker_id, unsigned generation)
+{
+    const quicpro_stats_header_t *h = quicpro_stats_seg;
+    if (!h || worker_id < 0 || (uint32_t)worker_id >= h->nworkers) {
+        return NULL;
+    }
+    return quicpro_stats_block(h, (uint32_t)worker_id + (generation & 1) * h->nworkers);
+}
+
+static void quicpro_stats_name(char *name, pid_t master_pid)
+{
+    snprintf(name, QP_STATS_NAME_MAX, "/quicpro_stats.%d", (int)master_pid);
+}
+
+/*──────────────────────────── Master ─────────────────────────────────────*/
+
+int quicpro_cluster_stats_create(int nworkers)
+{
+    if (quicpro_stats_seg || nworkers <= 0) {
+        return quicpro_stats_seg ? SUCCESS : FAILURE;
+    }
+
+    char name[QP_STATS_NAME_MAX];
+    pid_t self = getpid();
+    quicpro_stats_name(name, self);
+    size_t size = quicpro_stats_size((uint32_t)nworkers);
+
+    /* A segment left behind by an earlier master with our PID is stale */
+    shm_unlink(name);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        php_error_docref(NULL, E_WARNING, "Cluster stats unavailable: shm_open(%s): %s", name, strerror(errno));
+        return FAILURE;
+    }
+    void *mem = MAP_FAILED;
+    if (ftruncate(fd, (off_t)size) == 0) {
+        mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int saved = errno;
+    close(fd);
+    if (mem == MAP_FAILED) {
+        shm_unlink(name);
+        php_error_docref(NULL, E_WARNING, "Cluster stats unavailable: %s", strerror(saved));
+        return FAILURE;
+    }
+
+    /* Fresh pages are zero: every counter starts at 0 */
+    quicpro_stats_header_t *h = mem;
+    h->nworkers = (uint32_t)nworkers;
+    h->block_size = (uint32_t)sizeof(quicpro_worker_stats_t);
+    h->master_pid = (uint64_t)self;
+    h->started_at_ms = quicpro_stats_now_ms();
+    atomic_store_explicit(&h->active_workers, (uint32_t)nworkers, memory_order_relaxed);
+    atomic_store_explicit(&h->magic, QP_STATS_MAGIC, memory_order_release);
+
+    quicpro_stats_seg = h;
+    quicpro_stats_seg_size = size;
+    quicpro_stats_owner = self;
+    return SUCCESS;
+}
+
+void quicpro_cluster_stats_destroy(void)
+{
+    if (!quicpro_stats_seg) {
+        return;
+    }
+    if (quicpro_stats_owner == getpid()) {
+        char name[QP_STATS_NAME_MAX];
+        quicpro_stats_name(name, quicpro_stats_owner);
+        shm_unlink(name);
+    }
+    munmap(quicpro_stats_seg, quicpro_stats_seg_size);
+    quicpro_stats_seg = NULL;
+    quicpro_worker_stats = NULL;
+}
+
+void quicpro_cluster_stats_worker_started(int worker_id, unsigned generation, pid_t pid, bool restarted)
+{
+    quicpro_worker_stats_t *w = quicpro_stats_slot(worker_id, generation);
+    if (!w) {
+        return;
+    }
+    atomic_store_explicit(&w->generation, generation, memory_order_relaxed);
+    atomic_store_explicit(&w->started_at, (uint64_t)time(NULL), memory_order_relaxed);
+    atomic_store_explicit(&w->pid, (uint64_t)pid, memory_order_relaxed);
+    if (restarted) {
+        quicpro_worker_stat_add(&w->restarts, 1);
+    }
+}
+
+void quicpro_cluster_stats_worker_exited(int worker_id, unsigned generation)
+{
+    quicpro_worker_stats_t *w = quicpro_stats_slot(worker_id, generation);
+    if (!w) {
+        return;
+    }
+    /* The block has no writer until it is forked again */
+    atomic_store_explicit(&w->connections_closed,
+        atomic_load_explicit(&w->connections_accepted, memory_order_relaxed), memory_order_relaxed);
+    atomic_store_explicit(&w->pid, 0, memory_order_relaxed);
+}
+
+void quicpro_cluster_stats_set_active(int active)
+{
+    if (quicpro_stats_seg) {
+        atomic_store_explicit(&quicpro_stats_seg->active_workers, (uint32_t)active, memory_order_relaxed);
+    }
+}
+
+bool quicpro_cluster_stats_load_sample(int worker_id, unsigned generation, uint64_t *idle_us, uint64_t *queue_depth)
+{
+    const quicpro_worker_stats_t *w = quicpro_stats_slot(worker_id, generation);
+    if (!w) {
+        return false;
+    }
+    uint64_t since = atomic_load_explicit(&w->wait_since_us, memory_order_relaxed);
+    uint64_t idle = atomic_load_explicit(&w->loop_idle_us, memory_order_relaxed);
+    if (!since && !idle) {
+        return false;
+    }
+    uint64_t now = quicpro_worker_stats_now_us();
+    *idle_us = idle + (since && now > since ? now - since : 0);
+    *queue_depth = atomic_load_explicit(&w->queue_depth, memory_order_relaxed);
+    return true;
+}
+
+/*──────────────────────────── Worker ─────────────────────────────────────*/
+
+void quicpro_cluster_stats_attach_worker(int worker_id, unsigned generation)
+{
+    quicpro_worker_stats = quicpro_stats_slot(worker_id, generation);
+}
+
+void quicpro_worker_stats_conn_closed(quiche_conn *conn)
+{
+    quicpro_worker_stats_t *w = quicpro_worker_stats;
+    if (!w || !conn) {
+        return;
+    }
+    quicpro_worker_stat_add(&w->connections_closed, 1);
+    if (!quiche_conn_is_established(conn)) {
+        quicpro_worker_stat_add(&w->handshakes_failed, 1);
+        return;
+    }
+    quicpro_worker_stat_add(&w->handshakes_ok, 1);
+
+    quiche_stats qs;
+    quiche_conn_stats(conn, &qs);
+    quicpro_worker_stat_add(&w->bytes_rx, qs.recv_bytes);
+    quicpro_worker_stat_add(&w->bytes_tx, qs.sent_bytes);
+
+    quiche_path_stats ps;
+    if (quiche_conn_path_stats(conn, 0, &ps) == 0) {
+        uint64_t rtt_us = (uint64_t)ps.rtt / 1000;
+        int bucket = 0;
+        if (rtt_us >= 128) {
+            bucket = 63 - __builtin_clzll(rtt_us) - 6;
+            if (bucket >= QUICPRO_STATS_RTT_BUCKETS) {
+                bucket = QUICPRO_STATS_RTT_BUCKETS - 1;
+            }
+        }
+        quicpro_worker_stat_add(&w->rtt_hist[bucket], 1);
+        quicpro_worker_stat_add(&w->rtt_sum_us, rtt_us);
+    }
+}
+
+/*──────────────────────────── Readers ────────────────────────────────────*/
+
+typedef struct {
+    uint64_t connections_accepted, connections_closed, handshakes_ok, handshakes_failed;
+    uint64_t streams, requests, rate_limited, stateless_resets, cdn_hits, cdn_misses, ecn_ce, bytes_rx, bytes_tx, rtt_sum_us;
+    uint64_t rtt_hist[QUICPRO_STATS_RTT_BUCKETS];
+} quicpro_stats_sum_t;
+
+#define QP_STATS_LOAD(w, field) atomic_load_explicit(&(w)->field, memory_order_relaxed)
+
+static void quicpro_stats_load(const quicpro_worker_stats_t *w, quicpro_stats_sum_t *s)
+{
+    /* Closed first: a connection accepted meanwhile cannot make the gauge negative */
+    s->connections_closed = QP_STATS_LOAD(w, connections_closed);
+    s->connections_accepted = QP_STATS_LOAD(w, connections_accepted);
+    if (s->connections_accepted < s->connections_closed) {
+        s->connections_accepted = s->connections_closed;
+    }
+    s->handshakes_ok = QP_STATS_LOAD(w, handshakes_ok);
+    s->handshakes_failed = QP_STATS_LOAD(w, handshakes_failed);
+    s->streams = QP_STATS_LOAD(w, streams);
+    s->requests = QP_STATS_LOAD(w, requests);
+    s->rate_limited = QP_STATS_LOAD(w, rate_limited);
+    s->stateless_resets = QP_STATS_LOAD(w, stateless_resets);
+    s->cdn_hits = QP_STATS_LOAD(w, cdn_hits);
+    s->cdn_misses = QP_STATS_LOAD(w, cdn_misses);
+    s->ecn_ce = QP_STATS_LOAD(w, ecn_ce);
+    s->bytes_rx = QP_STATS_LOAD(w, bytes_rx);
+    s->bytes_tx = QP_STATS_LOAD(w, bytes_tx);
+    s->rtt_sum_us = QP_STATS_LOAD(w, rtt_sum_us);
+    for (int b = 0; b < QUICPRO_STATS_RTT_BUCKETS; b++) {
+        s->rtt_hist[b] = QP_STATS_LOAD(w, rtt_hist[b]);
+    }
+}
+
+static void quicpro_stats_add_counters(zval *into, const quicpro_stats_sum_t *s)
+{
+    uint64_t samples = 0;
+    for (int b = 0; b < QUICPRO_STATS_RTT_BUCKETS; b++) {
+        samples += s->rtt_hist[b];
+    }
+    add_assoc_long(into, "connections_accepted", (zend_long)s->connections_accepted);
+    add_assoc_long(into, "connections_active", (zend_long)(s->connections_accepted - s->connections_closed));
+    add_assoc_long(into, "handshakes_ok", (zend_long)s->handshakes_ok);
+    add_assoc_long(into, "handshakes_failed", (zend_long)s->handshakes_failed);
+    add_assoc_long(into, "streams", (zend_long)s->streams);
+    add_assoc_long(into, "requests", (zend_long)s->requests);
+    add_assoc_long(into, "rate_limited", (zend_long)s->rate_limited);
+    add_assoc_long(into, "stateless_resets", (zend_long)s->stateless_resets);
+    add_assoc_long(into, "cdn_hits", (zend_long)s->cdn_hits);
+    add_assoc_long(into, "cdn_misses", (zend_long)s->cdn_misses);
+    add_assoc_long(into, "ecn_ce", (zend_long)s->ecn_ce);
+    add_assoc_long(into, "bytes_rx", (zend_long)s->bytes_rx);
+    add_assoc_long(into, "bytes_tx", (zend_long)s->bytes_tx);
+    add_assoc_long(into, "rtt_samples", (zend_long)samples);
+    add_assoc_long(into, "rtt_avg_us", samples ? (zend_long)(s->rtt_sum_us / samples) : 0);
+}
+
+static void quicpro_stats_build(const quicpro_stats_header_t *h, zval *return_value)
+{
+    uint64_t now_ms = quicpro_stats_now_ms();
+    time_t now = time(NULL);
+    uint64_t uptime_ms = now_ms > h->started_at_ms ? now_ms - h->started_at_ms : 0;
+    quicpro_stats_sum_t total = {0};
+    zval workers;
+
+    array_init(return_value);
+    array_init_size(&workers, h->nworkers);
+    for (uint32_t i = 0; i < 2 * h->nworkers; i++) {
+        const quicpro_worker_stats_t *w = quicpro_stats_block(h, i);
+        uint64_t pid = QP_STATS_LOAD(w, pid), started_at = QP_STATS_LOAD(w, started_at);
+        if (!started_at) {
+            continue;   /* A generation's half no worker has used yet */
+        }
+        quicpro_stats_sum_t s;
+        quicpro_stats_load(w, &s);
+
+        zval entry;
+        array_init(&entry);
+        add_assoc_long(&entry, "worker_id", (zend_long)(i % h->nworkers));
+        add_assoc_long(&entry, "generation", (zend_long)QP_STATS_LOAD(w, generation));
+        add_assoc_long(&entry, "pid", (zend_long)pid);
+        add_assoc_long(&entry, "uptime_sec", pid && started_at && (uint64_t)now > started_at ? (zend_long)((uint64_t)now - started_at) : 0);
+        add_assoc_long(&entry, "restarts", (zend_long)QP_STATS_LOAD(w, restarts));
+        add_assoc_long(&entry, "loop_idle_us", (zend_long)QP_STATS_LOAD(w, loop_idle_us));
+        add_assoc_long(&entry, "queue_depth", (zend_long)QP_STATS_LOAD(w, queue_depth));
+        quicpro_stats_add_counters(&entry, &s);
+        add_next_index_zval(&workers, &entry);
+
+        total.connections_accepted += s.connections_accepted;
+        total.connections_closed += s.connections_closed;
+        total.handshakes_ok += s.handshakes_ok;
+        total.handshakes_failed += s.handshakes_failed;
+        total.streams += s.streams;
+        total.requests += s.requests;
+        total.rate_limited += s.rate_limited;
+        total.stateless_resets += s.stateless_resets;
+        total.cdn_hits += s.cdn_hits;
+        total.cdn_misses += s.cdn_misses;
+        total.ecn_ce += s.ecn_ce;
+        total.bytes_rx += s.bytes_rx;
+        total.bytes_tx += s.bytes_tx;
+        total.rtt_sum_us += s.rtt_sum_us;
+        for (int b = 0; b < QUICPRO_STATS_RTT_BUCKETS; b++) {
+            total.rtt_hist[b] += s.rtt_hist[b];
+        }
+    }
+
+    add_assoc_long(return_value, "master_pid", (zend_long)h->master_pid);
+    add_assoc_long(return_value, "workers", (zend_long)atomic_load_explicit(&h->active_workers, memory_order_relaxed));
+    add_assoc_long(return_value, "worker_slots", (zend_long)h->nworkers);
+    add_assoc_long(return_value, "uptime_sec", (zend_long)(uptime_ms / 1000));
+    add_assoc_long(return_value, "sampled_at_ms", (zend_long)now_ms);
+    quicpro_stats_add_counters(return_value, &total);
+    add_assoc_double(return_value, "requests_per_sec_avg", uptime_ms ? (double)total.requests * 1000.0 / (double)uptime_ms : 0.0);
+
+    /* Keyed by the bucket's upper bound in µs; the last one has none */
+    zval hist;
+    array_init_size(&hist, QUICPRO_STATS_RTT_BUCKETS);
+    for (int b = 0; b < QUICPRO_STATS_RTT_BUCKETS; b++) {
+        char key[32];
+        if (b == QUICPRO_STATS_RTT_BUCKETS - 1) {
+            snprintf(key, sizeof(key), "inf");
+        } else {
+            snprintf(key, sizeof(key), "%llu", (unsigned long long)(UINT64_C(128) << b));
+        }
+        add_assoc_long(&hist, key, (zend_long)total.rtt_hist[b]);
+    }
+    add_assoc_zval(return_value, "rtt_histogram_us", &hist);
+    add_assoc_zval(return_value, "worker_stats", &workers);
+}
+
+int quicpro_cluster_stats_read(const char *pid_file, zval *return_value)
+{
+    if (!pid_file) {
+        /* The master, or one of its workers, which inherited the mapping */
+        if (!quicpro_stats_seg) {
+            throw_mcp_error_as_php_exception(0, "Not running in a cluster: the master's PID file must be provided.");
+            return FAILURE;
+        }
+        quicpro_stats_build(quicpro_stats_seg, return_value);
+        return SUCCESS;
+    }
+
+    FILE *f = fopen(pid_file, "r");
+    if (!f) {
+        throw_mcp_error_as_php_exception(0, "Could not open master PID file: %s", pid_file);
+        return FAILURE;
+    }
+    int master_pid;
+    if (fscanf(f, "%d", &master_pid) != 1 || master_pid <= 0) {
+        fclose(f);
+        throw_mcp_error_as_php_exception(0, "Could not read PID from master PID file: %s", pid_file);
+        return FAILURE;
+    }
+    fclose(f);
+
+    if (quicpro_stats_seg && quicpro_stats_seg->master_pid == (uint64_t)master_pid) {
+        quicpro_stats_build(quicpro_stats_seg, return_value);
+        return SUCCESS;
+    }
+
+    char name[QP_STATS_NAME_MAX];
+    quicpro_stats_name(name, (pid_t)master_pid);
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        throw_mcp_error_as_php_exception(0, "No stats segment for cluster master %d: %s", master_pid, strerror(errno));
+        return FAILURE;
+    }
+    struct stat st;
+    void *mem = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(quicpro_stats_header_t)) {
+        mem = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mem == MAP_FAILED) {
+        throw_mcp_error_as_php_exception(0, "Cannot map the stats segment of cluster master %d.", master_pid);
+        return FAILURE;
+    }
+
+    const quicpro_stats_header_t *h = mem;
+    if (atomic_load_explicit(&h->magic, memory_order_acquire) != QP_STATS_MAGIC
+        || h->block_size != sizeof(quicpro_worker_stats_t)
+        || quicpro_stats_size(h->nworkers) > (size_t)st.st_size) {
+        munmap(mem, (size_t)st.st_size);
+        throw_mcp_error_as_php_exception(0, "The stats segment of cluster master %d has an unexpected layout.", master_pid);
+        return FAILURE;
+    }
+    quicpro_stats_build(h, return_value);
+    munmap(mem, (size_t)st.st_size);
+    return SUCCESS;
+}
@@ -0,0 +1,81 @@
+/*
+ * src/cluster/shm_cache.c – Slot table shared by a host's workers
+ * ===============================================================
+ *
+ * See include/cluster/shm_cache.h. Fresh anonymous pages are zeroed, so a
+ * new table has every key 0 and every atomic_flag clear. The unlocked
+ * reads of a slot's key and expiry only choose which slot to lock; what
+ * they saw may be stale by then, and every decision that matters is made
+ * again under the lock.
+ */
+
+#include "php_quicpro.h"
+#include "cluster/shm_cache.h"
+
+#include <sys/mman.h>
+
+#define QP_SHM_CACHE_LOCK_SPINS 1024
+
+static bool quicpro_shm_cache_lock(quicpro_shm_cache_slot_t *slot)
+{
+    for (int i = 0; i < QP_SHM_CACHE_LOCK_SPINS; i++) {
+        if (!atomic_flag_test_and_set_explicit(&slot->lock, memory_order_acquire)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool quicpro_shm_cache_map(quicpro_shm_cache_t *c, size_t entries, size_t slot_size, int flags)
+{
+    size_t n = (entries + 1) & ~(size_t)1;     /* Both ways of a set inside the table */
+    slot_size = ZEND_MM_ALIGNED_SIZE_EX(slot_size, 64);
+    void *mem = mmap(NULL, n * slot_size, PROT_READ | PROT_WRITE, flags | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return false;
+    }
+    c->slots = mem;
+    c->nslots = n;
+    c->slot_size = slot_size;
+    c->shared = (flags & MAP_SHARED) != 0;
+    return true;
+}
+
+void quicpro_shm_cache_unmap(quicpro_shm_cache_t *c)
+{
+    if (c->slots) {
+        munmap(c->slots, c->nslots * c->slot_size);
+        c->slots = NULL;
+        c->nslots = 0;
+        c->shared = false;
+    }
+}
+
+quicpro_shm_cache_slot_t *quicpro_shm_cache_find(const quicpro_shm_cache_t *c, uint64_t key, size_t way)
+{
+    quicpro_shm_cache_slot_t *slot = quicpro_shm_cache_slot(c, (size_t)(key % c->nslots) ^ way);
+    if (atomic_load_explicit(&slot->key, memory_order_relaxed) != key || !quicpro_shm_cache_lock(slot)) {
+        return NULL;
+    }
+    return slot;
+}
+
+quicpro_shm_cache_slot_t *quicpro_shm_cache_claim(const quicpro_shm_cache_t *c, uint64_t key, uint64_t now)
+{
+    size_t base = (size_t)(key % c->nslots);
+    quicpro_shm_cache_slot_t *a = quicpro_shm_cache_slot(c, base), *b = quicpro_shm_cache_slot(c, base ^ 1);
+    uint64_t a_key = atomic_load_explicit(&a->key, memory_order_relaxed);
+    uint64_t b_key = atomic_load_explicit(&b->key, memory_order_relaxed);
+    uint64_t a_exp = atomic_load_explicit(&a->expires_at, memory_order_relaxed);
+    uint64_t b_exp = atomic_load_explicit(&b->expires_at, memory_order_relaxed);
+
+    quicpro_shm_cache_slot_t *slot;
+    if (a_key == key || (b_key != key && (a_key == 0 || a_exp <= now))) {
+        slot = a;
+    } else if (b_key == key || b_key == 0 || b_exp <= now) {
+        slot = b;
+    } else {
+        slot = a_exp <= b_exp ? a : b;
+    }
+    return quicpro_shm_cache_lock(slot) ? slot : NULL;
+}
@@ -0,0 +1,351 @@
+/*
+ * src/cluster/topology.c – NUMA-aware worker placement for Quicpro\Cluster
+ * ========================================================================
+ *
+ * See include/cluster/topology.h. Sources read:
+ * - /sys/devices/system/node/online and node<N>/cpulist for the nodes;
+ * - /sys/devices/system/cpu/cpu<N>/topology/thread_siblings_list to tell
+ *   a core's first thread from its SMT siblings;
+ * - /sys/class/net/<if>/queues/rx-* for the RX queue count,
+ *   /sys/class/net/<if>/device/numa_node for the NIC's node;
+ * - /proc/interrupts names and /sys/class/net/<if>/device/msi_irqs for the
+ *   queue IRQs, /proc/irq/<N>/effective_affinity_list (smp_affinity_list
+ *   on older kernels) for their CPUs.
+ *
+ * The memory policy goes through the raw syscall, so no libnuma is needed.
+ */
+
+#include "php_quicpro.h"
+#include "cluster/topology.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#endif
+
+#define QP_TOPO_MAX_NODES   64
+#define QP_TOPO_MAX_IRQS    1024
+#define QP_TOPO_LINE_MAX    4096
+
+/* The CPU this worker was pinned to, for SO_INCOMING_CPU */
+static int quicpro_topology_cpu = -1;
+
+#ifdef __linux__
+
+/* Reads the first line of `path` into `buf`; false if it cannot */
+static bool topo_read_line(const char *path, char *buf, size_t len)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    bool ok = fgets(buf, (int)len, f) != NULL;
+    fclose(f);
+    if (ok) {
+        buf[strcspn(buf, "\n")] = '\0';
+    }
+    return ok;
+}
+
+/* Parses a kernel CPU or node list ("0-3,8,10-11") into `set` */
+static bool topo_parse_list(const char *list, cpu_set_t *set)
+{
+    CPU_ZERO(set);
+    const char *p = list;
+    while (*p) {
+        char *end;
+        long lo = strtol(p, &end, 10), hi = lo;
+        if (end == p || lo < 0) {
+            return false;
+        }
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+            if (end == p || hi < lo) {
+                return false;
+            }
+        }
+        for (long i = lo; i <= hi && i < CPU_SETSIZE; ++i) {
+            CPU_SET((int)i, set);
+        }
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') {
+            break;
+        }
+    }
+    return true;
+}
+
+static bool topo_read_list(const char *path, cpu_set_t *set)
+{
+    char buf[QP_TOPO_LINE_MAX];
+    return topo_read_line(path, buf, sizeof(buf)) && topo_parse_list(buf, set);
+}
+
+/* The n-th (wrapping) CPU of `set`, or -1 if it is empty */
+static int topo_nth_cpu(const cpu_set_t *set, int n)
+{
+    int count = CPU_COUNT(set);
+    if (count == 0) {
+        return -1;
+    }
+    n %= count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, set) && n-- == 0) {
+            return cpu;
+        }
+    }
+    return -1;
+}
+
+static int topo_node_of_cpu(int cpu, const cpu_set_t *nodes)
+{
+    char path[128];
+    cpu_set_t cpus;
+    for (int node = 0; node < QP_TOPO_MAX_NODES; ++node) {
+        if (!CPU_ISSET(node, nodes)) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        if (topo_read_list(path, &cpus) && CPU_ISSET(cpu, &cpus)) {
+            return node;
+        }
+    }
+    return -1;
+}
+
+/* `node`'s allowed CPUs, physical cores first: the order workers fill them in */
+static int topo_node_cpu(int node, const cpu_set_t *allowed, int n)
+{
+    char path[128];
+    cpu_set_t cpus, primary, siblings;
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    if (!topo_read_list(path, &cpus)) {
+        return -1;
+    }
+    CPU_AND(&cpus, &cpus, allowed);
+
+    CPU_ZERO(&primary);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &cpus)) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+        if (!topo_read_list(path, &siblings) || topo_nth_cpu(&siblings, 0) == cpu) {
+            CPU_SET(cpu, &primary);
+        }
+    }
+    int cores = CPU_COUNT(&primary);
+    if (cores == 0) {
+        return -1;
+    }
+    if (n % CPU_COUNT(&cpus) < cores) {
+        return topo_nth_cpu(&primary, n % CPU_COUNT(&cpus));
+    }
+    /* Past the cores: the SMT siblings, in CPU order */
+    CPU_XOR(&siblings, &cpus, &primary);
+    return topo_nth_cpu(&siblings, n % CPU_COUNT(&cpus) - cores);
+}
+
+static int topo_rx_queue_count(const char *ifname)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/class/net/%s/queues", ifname);
+    DIR *d = opendir(path);
+    if (!d) {
+        return 0;
+    }
+    int count = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        if (strncmp(e->d_name, "rx-", 3) == 0) {
+            count++;
+        }
+    }
+    closedir(d);
+    return count;
+}
+
+static int topo_cmp_int(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+/*
+ * The IRQ of `ifname`'s RX queue `queue`. Most drivers name their vectors
+ * after the interface ("eth0-TxRx-3", "eth0-rx-3"): the queue-th of those
+ * that carries a queue number. Otherwise the device's MSI vectors in
+ * order, after the one extra vector drivers keep for link events.
+ */
+static int topo_queue_irq(const char *ifname, int queue)
+{
+    int irqs[QP_TOPO_MAX_IRQS], n = 0;
+    char line[QP_TOPO_LINE_MAX];
+    size_t iflen = strlen(ifname);
+
+    FILE *f = fopen("/proc/interrupts", "r");
+    if (f) {
+        while (n < QP_TOPO_MAX_IRQS && fgets(line, sizeof(line), f)) {
+            char *name = strstr(line, ifname);
+            if (!name || !isdigit((unsigned char)line[strspn(line, " ")])) {
+                continue;
+            }
+            const char *rest = name + iflen;
+            size_t digit = strcspn(rest, "0123456789");
+            if (*rest != '-' || rest[digit] == '\0') {
+                continue; /* The interface itself, not one of its queues */
+            }
+            irqs[n++] = atoi(line);
+        }
+        fclose(f);
+    }
+    if (n > 0) {
+        return irqs[queue % n];
+    }
+
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/class/net/%s/device/msi_irqs", ifname);
+    DIR *d = opendir(path);
+    if (!d) {
+        return -1;
+    }
+    struct dirent *e;
+    while (n < QP_TOPO_MAX_IRQS && (e = readdir(d)) != NULL) {
+        if (isdigit((unsigned char)e->d_name[0])) {
+            irqs[n++] = atoi(e->d_name);
+        }
+    }
+    closedir(d);
+    if (n == 0) {
+        return -1;
+    }
+    qsort(irqs, n, sizeof(int), topo_cmp_int);
+    int first = n > topo_rx_queue_count(ifname) ? 1 : 0;
+    return n > first ? irqs[first + queue % (n - first)] : irqs[0];
+}
+
+/* The first allowed CPU `irq` is delivered to, or -1 */
+static int topo_irq_cpu(int irq, const cpu_set_t *allowed)
+{
+    char path[128];
+    cpu_set_t cpus;
+    snprintf(path, sizeof(path), "/proc/irq/%d/effective_affinity_list", irq);
+    if (!topo_read_list(path, &cpus) || CPU_COUNT(&cpus) == 0) {
+        snprintf(path, sizeof(path), "/proc/irq/%d/smp_affinity_list", irq);
+        if (!topo_read_list(path, &cpus)) {
+            return -1;
+        }
+    }
+    CPU_AND(&cpus, &cpus, allowed);
+    return topo_nth_cpu(&cpus, 0);
+}
+
+static int topo_apply_mempolicy(const char *policy, int node, const cpu_set_t *nodes)
+{
+    unsigned long mask[QP_TOPO_MAX_NODES / (8 * sizeof(unsigned long))] = {0};
+    int mode;
+
+    if (!policy || strcasecmp(policy, "default") == 0) {
+        return 0; /* First touch is local once pinned */
+    } else if (strcasecmp(policy, "interleave") == 0) {
+        mode = MPOL_INTERLEAVE;
+        for (int i = 0; i < QP_TOPO_MAX_NODES; ++i) {
+            if (CPU_ISSET(i, nodes)) {
+                mask[i / (8 * sizeof(unsigned long))] |= 1UL << (i % (8 * sizeof(unsigned long)));
+            }
+        }
+    } else {
+        mode = strcasecmp(policy, "bind") == 0 ? MPOL_BIND : MPOL_PREFERRED;
+        mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    }
+    return (int)syscall(SYS_set_mempolicy, mode, mask, (unsigned long)QP_TOPO_MAX_NODES + 1);
+}
+
+int quicpro_topology_place_worker(int worker_id, const char *ifname, const char *mem_policy)
+{
+    cpu_set_t allowed, nodes, set;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0
+        || !topo_read_list("/sys/devices/system/node/online", &nodes)) {
+        php_error(E_WARNING, "[Worker %d] Cannot read the CPU topology: %s", worker_id, strerror(errno));
+        return -1;
+    }
+
+    int cpu = -1, node = -1;
+    if (ifname && *ifname) {
+        int queues = topo_rx_queue_count(ifname);
+        int irq = topo_queue_irq(ifname, queues > 0 ? worker_id % queues : worker_id);
+        if (irq >= 0) {
+            cpu = topo_irq_cpu(irq, &allowed);
+        }
+        if (cpu < 0) {
+            char path[128], buf[32];
+            snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node", ifname);
+            if (topo_read_line(path, buf, sizeof(buf)) && atoi(buf) >= 0) {
+                cpu = topo_node_cpu(atoi(buf), &allowed, worker_id);
+            }
+        }
+    }
+    if (cpu < 0) {
+        int nnodes = CPU_COUNT(&nodes);
+        node = topo_nth_cpu(&nodes, worker_id);
+        cpu = node < 0 ? -1 : topo_node_cpu(node, &allowed, nnodes > 0 ? worker_id / nnodes : worker_id);
+    }
+    if (cpu < 0) {
+        php_error(E_WARNING, "[Worker %d] No CPU found for NUMA-aware placement", worker_id);
+        return -1;
+    }
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        php_error(E_WARNING, "[Worker %d] Failed to pin to CPU %d: %s", worker_id, cpu, strerror(errno));
+        return -1;
+    }
+    quicpro_topology_cpu = cpu;
+
+    if (node < 0) {
+        node = topo_node_of_cpu(cpu, &nodes);
+    }
+    if (node >= 0 && node < QP_TOPO_MAX_NODES && topo_apply_mempolicy(mem_policy, node, &nodes) != 0) {
+        php_error(E_WARNING, "[Worker %d] Failed to set the '%s' memory policy for node %d: %s", worker_id, mem_policy, node, strerror(errno));
+    }
+    return cpu;
+}
+
+void quicpro_topology_incoming_cpu(int fd)
+{
+#ifdef SO_INCOMING_CPU
+    if (quicpro_topology_cpu >= 0) {
+        setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &quicpro_topology_cpu, sizeof(quicpro_topology_cpu));
+    }
+#else
+    (void)fd;
+#endif
+}
+
+#else /* !__linux__ */
+
+int quicpro_topology_place_worker(int worker_id, const char *ifname, const char *mem_policy)
+{
+    (void)ifname; (void)mem_policy;
+    php_error(E_WARNING, "[Worker %d] NUMA-aware placement needs Linux", worker_id);
+    return -1;
+}
+
+void quicpro_topology_incoming_cpu(int fd)
+{
+    (void)fd;
+}
+
+#endif
@@ -20,6 +20,7 @@
 /* Centralized validation helpers */
 #include "include/validation/config_param/validate_bool.h"
 #include "include/validation/config_param/validate_positive_long.h"
+#include "include/validation/config_param/validate_long_range.h"
 #include "include/validation/config_param/validate_comma_separated_string_from_allowlist.h"
 
 #include "php.h"
@@ -53,10 +54,14 @@ int qp_config_app_http3_websockets_webtransport_apply_userland_config(zval *conf
                 quicpro_app_protocols_config.http_advertise_h3_alt_svc = zend_is_true(value);
             } else { return FAILURE; }
         } else if (zend_string_equals_literal(key, "http_auto_compress")) {
-            const char *allowed[] = {"brotli", "gzip", "none", NULL};
+            const char *allowed[] = {"brotli", "zstd", "gzip", "none", NULL};
             if (qp_validate_comma_separated_string_from_allowlist(value, allowed, &quicpro_app_protocols_config.http_auto_compress) != SUCCESS) {
                 return FAILURE;
             }
+        } else if (zend_string_equals_literal(key, "http_compress_min_length")) {
+            if (qp_validate_positive_long(value, &quicpro_app_protocols_config.http_compress_min_length) != SUCCESS) {
+                return FAILURE;
+            }
         } else if (zend_string_equals_literal(key, "h3_max_header_list_size")) {
             if (qp_validate_positive_long(value, &quicpro_app_protocols_config.h3_max_header_list_size) != SUCCESS) {
                 return FAILURE;
@@ -77,6 +82,10 @@ int qp_config_app_http3_websockets_webtransport_apply_userland_config(zval *conf
             if (qp_validate_bool(value) == SUCCESS) {
                 quicpro_app_protocols_config.http_enable_early_hints = zend_is_true(value);
             } else { return FAILURE; }
+        } else if (zend_string_equals_literal(key, "http_early_hints_auto")) {
+            if (qp_validate_bool(value) == SUCCESS) {
+                quicpro_app_protocols_config.http_early_hints_auto = zend_is_true(value);
+            } else { return FAILURE; }
         } else if (zend_string_equals_literal(key, "websocket_default_max_payload_size")) {
             if (qp_validate_positive_long(value, &quicpro_app_protocols_config.websocket_default_max_payload_size) != SUCCESS) {
                 return FAILURE;
@@ -89,6 +98,30 @@ int qp_config_app_http3_websockets_webtransport_apply_userland_config(zval *conf
             if (qp_validate_positive_long(value, &quicpro_app_protocols_config.websocket_handshake_timeout_ms) != SUCCESS) {
                 return FAILURE;
             }
+        } else if (zend_string_equals_literal(key, "websocket_receive_chunk_size")) {
+            if (qp_validate_positive_long(value, &quicpro_app_protocols_config.websocket_receive_chunk_size) != SUCCESS) {
+                return FAILURE;
+            }
+        } else if (zend_string_equals_literal(key, "websocket_deflate_enable")) {
+            if (qp_validate_bool(value) == SUCCESS) {
+                quicpro_app_protocols_config.websocket_deflate_enable = zend_is_true(value);
+            } else { return FAILURE; }
+        } else if (zend_string_equals_literal(key, "websocket_deflate_max_window_bits")) {
+            if (qp_validate_long_range(value, 9, 15, &quicpro_app_protocols_config.websocket_deflate_max_window_bits) != SUCCESS) {
+                return FAILURE;
+            }
+        } else if (zend_string_equals_literal(key, "websocket_deflate_no_context_takeover")) {
+            if (qp_validate_bool(value) == SUCCESS) {
+                quicpro_app_protocols_config.websocket_deflate_no_context_takeover = zend_is_true(value);
+            } else { return FAILURE; }
+        } else if (zend_string_equals_literal(key, "websocket_send_queue_high_watermark")) {
+            if (qp_validate_positive_long(value, &quicpro_app_protocols_config.websocket_send_queue_high_watermark) != SUCCESS) {
+                return FAILURE;
+            }
+        } else if (zend_string_equals_literal(key, "websocket_close_slow_consumers")) {
+            if (qp_validate_bool(value) == SUCCESS) {
+                quicpro_app_protocols_config.websocket_close_slow_consumers = zend_is_true(value);
+            } else { return FAILURE; }
         } else if (zend_string_equals_literal(key, "webtransport_enable")) {
             if (qp_validate_bool(value) == SUCCESS) {
                 quicpro_app_protocols_config.webtransport_enable = zend_is_true(value);
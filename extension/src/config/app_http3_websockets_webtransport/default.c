@@ -25,16 +25,24 @@ void qp_config_app_http3_websockets_webtransport_defaults_load(void)
     /* --- HTTP/3 General Settings --- */
     quicpro_app_protocols_config.http_advertise_h3_alt_svc = true;
     quicpro_app_protocols_config.http_auto_compress = pestrdup("brotli,gzip", 1);
+    quicpro_app_protocols_config.http_compress_min_length = 1024;
     quicpro_app_protocols_config.h3_max_header_list_size = 65536;
     quicpro_app_protocols_config.h3_qpack_max_table_capacity = 4096;
     quicpro_app_protocols_config.h3_qpack_blocked_streams = 100;
     quicpro_app_protocols_config.h3_server_push_enable = false;
     quicpro_app_protocols_config.http_enable_early_hints = true;
+    quicpro_app_protocols_config.http_early_hints_auto = false;
 
     /* --- WebSocket Protocol Settings --- */
     quicpro_app_protocols_config.websocket_default_max_payload_size = 16777216; /* 16MB */
     quicpro_app_protocols_config.websocket_default_ping_interval_ms = 25000;
     quicpro_app_protocols_config.websocket_handshake_timeout_ms = 5000;
+    quicpro_app_protocols_config.websocket_receive_chunk_size = 65536;
+    quicpro_app_protocols_config.websocket_deflate_enable = true;
+    quicpro_app_protocols_config.websocket_deflate_max_window_bits = 15;
+    quicpro_app_protocols_config.websocket_deflate_no_context_takeover = false;
+    quicpro_app_protocols_config.websocket_send_queue_high_watermark = 4194304; /* 4MB */
+    quicpro_app_protocols_config.websocket_close_slow_consumers = false;
 
     /* --- WebTransport Protocol Settings --- */
     quicpro_app_protocols_config.webtransport_enable = true;
@@ -32,7 +32,9 @@ static ZEND_INI_MH(OnUpdateAppProtocolPositiveLong)
         return FAILURE;
     }
 
-    if (zend_string_equals_literal(entry->name, "quicpro.h3_max_header_list_size")) {
+    if (zend_string_equals_literal(entry->name, "quicpro.http_compress_min_length")) {
+        quicpro_app_protocols_config.http_compress_min_length = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.h3_max_header_list_size")) {
         quicpro_app_protocols_config.h3_max_header_list_size = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.h3_qpack_max_table_capacity")) {
         quicpro_app_protocols_config.h3_qpack_max_table_capacity = val;
@@ -44,6 +46,10 @@ static ZEND_INI_MH(OnUpdateAppProtocolPositiveLong)
         quicpro_app_protocols_config.websocket_default_ping_interval_ms = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.websocket_handshake_timeout_ms")) {
         quicpro_app_protocols_config.websocket_handshake_timeout_ms = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.websocket_receive_chunk_size")) {
+        quicpro_app_protocols_config.websocket_receive_chunk_size = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.websocket_send_queue_high_watermark")) {
+        quicpro_app_protocols_config.websocket_send_queue_high_watermark = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.webtransport_max_concurrent_sessions")) {
         quicpro_app_protocols_config.webtransport_max_concurrent_sessions = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.webtransport_max_streams_per_session")) {
@@ -56,6 +62,20 @@ static ZEND_INI_MH(OnUpdateAppProtocolPositiveLong)
 /*
  * Custom OnUpdate handler for validating the http_auto_compress string.
  */
+static ZEND_INI_MH(OnUpdateWebsocketDeflateWindowBits)
+{
+    zend_long val = zend_atol(ZSTR_VAL(new_value), ZSTR_LEN(new_value));
+
+    /* RFC 7692 allows 8, but zlib's raw deflate cannot produce an 8-bit window */
+    if (val < 9 || val > 15) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Invalid value for quicpro.websocket_deflate_max_window_bits. An integer between 9 and 15 is required.");
+        return FAILURE;
+    }
+
+    quicpro_app_protocols_config.websocket_deflate_max_window_bits = val;
+    return SUCCESS;
+}
+
 static ZEND_INI_MH(OnUpdateCompressionString)
 {
     /* This is where a call to a function like qp_validate_comma_separated_string_from_allowlist() would go. */
@@ -69,16 +89,24 @@ PHP_INI_BEGIN()
     /* --- HTTP/3 General Settings --- */
     STD_PHP_INI_ENTRY("quicpro.http_advertise_h3_alt_svc", "1", PHP_INI_SYSTEM, OnUpdateBool, http_advertise_h3_alt_svc, qp_app_protocols_config_t, quicpro_app_protocols_config)
     ZEND_INI_ENTRY_EX("quicpro.http_auto_compress", "brotli,gzip", PHP_INI_SYSTEM, OnUpdateCompressionString, &quicpro_app_protocols_config.http_auto_compress, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.http_compress_min_length", "1024", PHP_INI_SYSTEM, OnUpdateAppProtocolPositiveLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.h3_max_header_list_size", "65536", PHP_INI_SYSTEM, OnUpdateAppProtocolPositiveLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.h3_qpack_max_table_capacity", "4096", PHP_INI_SYSTEM, OnUpdateAppProtocolPositiveLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.h3_qpack_blocked_streams", "100", PHP_INI_SYSTEM, OnUpdateAppProtocolPositiveLong, NULL, NULL, NULL)
     STD_PHP_INI_ENTRY("quicpro.h3_server_push_enable", "0", PHP_INI_SYSTEM, OnUpdateBool, h3_server_push_enable, qp_app_protocols_config_t, quicpro_app_protocols_config)
     STD_PHP_INI_ENTRY("quicpro.http_enable_early_hints", "1", PHP_INI_SYSTEM, OnUpdateBool, http_enable_early_hints, qp_app_protocols_config_t, quicpro_app_protocols_config)
+    STD_PHP_INI_ENTRY("quicpro.http_early_hints_auto", "0", PHP_INI_SYSTEM, OnUpdateBool, http_early_hints_auto, qp_app_protocols_config_t, quicpro_app_protocols_config)
 
     /* --- WebSocket Protocol Settings --- */
     ZEND_INI_ENTRY_EX("quicpro.websocket_default_max_payload_size", "16777216", PHP_INI_SYSTEM, OnUpdateAppProtocolPositiveLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.websocket_default_ping_interval_ms", "25000", PHP_INI_SYSTEM, OnUpdateAppProtocolPositiveLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.websocket_handshake_timeout_ms", "5000", PHP_INI_SYSTEM, OnUpdateAppProtocolPositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.websocket_receive_chunk_size", "65536", PHP_INI_SYSTEM, OnUpdateAppProtocolPositiveLong, NULL, NULL, NULL)
+    STD_PHP_INI_ENTRY("quicpro.websocket_deflate_enable", "1", PHP_INI_SYSTEM, OnUpdateBool, websocket_deflate_enable, qp_app_protocols_config_t, quicpro_app_protocols_config)
+    ZEND_INI_ENTRY_EX("quicpro.websocket_deflate_max_window_bits", "15", PHP_INI_SYSTEM, OnUpdateWebsocketDeflateWindowBits, NULL, NULL, NULL)
+    STD_PHP_INI_ENTRY("quicpro.websocket_deflate_no_context_takeover", "0", PHP_INI_SYSTEM, OnUpdateBool, websocket_deflate_no_context_takeover, qp_app_protocols_config_t, quicpro_app_protocols_config)
+    ZEND_INI_ENTRY_EX("quicpro.websocket_send_queue_high_watermark", "4194304", PHP_INI_SYSTEM, OnUpdateAppProtocolPositiveLong, NULL, NULL, NULL)
+    STD_PHP_INI_ENTRY("quicpro.websocket_close_slow_consumers", "0", PHP_INI_SYSTEM, OnUpdateBool, websocket_close_slow_consumers, qp_app_protocols_config_t, quicpro_app_protocols_config)
 
     /* --- WebTransport Protocol Settings --- */
     STD_PHP_INI_ENTRY("quicpro.webtransport_enable", "1", PHP_INI_SYSTEM, OnUpdateBool, webtransport_enable, qp_app_protocols_config_t, quicpro_app_protocols_config)
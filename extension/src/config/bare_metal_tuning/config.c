@@ -61,6 +61,10 @@ int qp_config_bare_metal_tuning_apply_userland_config(zval *config_arr)
             if (qp_validate_positive_long(value, &quicpro_bare_metal_config.io_max_batch_write_packets) != SUCCESS) {
                 return FAILURE;
             }
+        } else if (zend_string_equals_literal(key, "io_max_drain_packets")) {
+            if (qp_validate_positive_long(value, &quicpro_bare_metal_config.io_max_drain_packets) != SUCCESS) {
+                return FAILURE;
+            }
         } else if (zend_string_equals_literal(key, "socket_receive_buffer_size")) {
             if (qp_validate_positive_long(value, &quicpro_bare_metal_config.socket_receive_buffer_size) != SUCCESS) {
                 return FAILURE;
@@ -76,6 +80,9 @@ int qp_config_bare_metal_tuning_apply_userland_config(zval *config_arr)
         } else if (zend_string_equals_literal(key, "socket_enable_timestamping")) {
             if (qp_validate_bool(value) != SUCCESS) { return FAILURE; }
             quicpro_bare_metal_config.socket_enable_timestamping = zend_is_true(value);
+        } else if (zend_string_equals_literal(key, "io_thread_split")) {
+            if (qp_validate_bool(value) != SUCCESS) { return FAILURE; }
+            quicpro_bare_metal_config.io_thread_split = zend_is_true(value);
         } else if (zend_string_equals_literal(key, "io_thread_cpu_affinity")) {
             if (qp_validate_generic_string(value, &quicpro_bare_metal_config.io_thread_cpu_affinity) != SUCCESS) {
                 return FAILURE;
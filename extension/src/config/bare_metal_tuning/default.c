@@ -26,14 +26,23 @@ void qp_config_bare_metal_tuning_defaults_load(void)
     quicpro_bare_metal_config.io_uring_sq_poll_ms = 0;
     quicpro_bare_metal_config.io_max_batch_read_packets = 64;
     quicpro_bare_metal_config.io_max_batch_write_packets = 64;
+    quicpro_bare_metal_config.io_max_drain_packets = 1024;
+
+    /* --- AF_XDP Kernel Bypass --- */
+    quicpro_bare_metal_config.io_xdp_interface = pestrdup("", 1);
+    quicpro_bare_metal_config.io_xdp_queue_id = -1; /* auto: worker_id % channels */
+    quicpro_bare_metal_config.io_xdp_zero_copy = false;
+    quicpro_bare_metal_config.io_xdp_umem_frames = 4096;
 
     /* --- Socket Buffers & Options --- */
     quicpro_bare_metal_config.socket_receive_buffer_size = 2097152; /* 2MB */
     quicpro_bare_metal_config.socket_send_buffer_size = 2097152; /* 2MB */
     quicpro_bare_metal_config.socket_enable_busy_poll_us = 0;
     quicpro_bare_metal_config.socket_enable_timestamping = true;
+    quicpro_bare_metal_config.socket_enable_txtime = true; /* SO_TXTIME pacing, else userspace */
 
     /* --- CPU & NUMA Affinity --- */
+    quicpro_bare_metal_config.io_thread_split = false;
     quicpro_bare_metal_config.io_thread_cpu_affinity = pestrdup("", 1);
     quicpro_bare_metal_config.io_thread_numa_node_policy = pestrdup("default", 1);
 }
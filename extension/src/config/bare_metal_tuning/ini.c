@@ -47,14 +47,29 @@ static ZEND_INI_MH(OnUpdateBareMetalPositiveLong)
         quicpro_bare_metal_config.io_max_batch_read_packets = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.io_max_batch_write_packets")) {
         quicpro_bare_metal_config.io_max_batch_write_packets = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.io_max_drain_packets")) {
+        quicpro_bare_metal_config.io_max_drain_packets = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.socket_receive_buffer_size")) {
         quicpro_bare_metal_config.socket_receive_buffer_size = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.socket_send_buffer_size")) {
         quicpro_bare_metal_config.socket_send_buffer_size = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.io_xdp_umem_frames")) {
+        quicpro_bare_metal_config.io_xdp_umem_frames = val;
     }
     return SUCCESS;
 }
 
+static ZEND_INI_MH(OnUpdateXdpQueueId)
+{
+    zend_long val = zend_atol(ZSTR_VAL(new_value), ZSTR_LEN(new_value));
+    if (val < -1) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Invalid value for AF_XDP queue id. Must be -1 (automatic) or a non-negative queue index.");
+        return FAILURE;
+    }
+    quicpro_bare_metal_config.io_xdp_queue_id = val;
+    return SUCCESS;
+}
+
 static ZEND_INI_MH(OnUpdateNumaPolicyString)
 {
     const char *policy = ZSTR_VAL(new_value);
@@ -79,10 +94,17 @@ PHP_INI_BEGIN()
     ZEND_INI_ENTRY_EX("quicpro.io_uring_sq_poll_ms", "0", PHP_INI_SYSTEM, OnUpdateBareMetalNonNegativeLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.io_max_batch_read_packets","64", PHP_INI_SYSTEM, OnUpdateBareMetalPositiveLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.io_max_batch_write_packets","64", PHP_INI_SYSTEM, OnUpdateBareMetalPositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.io_max_drain_packets","1024", PHP_INI_SYSTEM, OnUpdateBareMetalPositiveLong, NULL, NULL, NULL)
+    STD_PHP_INI_ENTRY("quicpro.io_xdp_interface", "", PHP_INI_SYSTEM, OnUpdateString, io_xdp_interface, qp_bare_metal_config_t, quicpro_bare_metal_config)
+    ZEND_INI_ENTRY_EX("quicpro.io_xdp_queue_id", "-1", PHP_INI_SYSTEM, OnUpdateXdpQueueId, NULL, NULL, NULL)
+    STD_PHP_INI_ENTRY("quicpro.io_xdp_zero_copy", "0", PHP_INI_SYSTEM, OnUpdateBool, io_xdp_zero_copy, qp_bare_metal_config_t, quicpro_bare_metal_config)
+    ZEND_INI_ENTRY_EX("quicpro.io_xdp_umem_frames", "4096", PHP_INI_SYSTEM, OnUpdateBareMetalPositiveLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.socket_receive_buffer_size", "2097152", PHP_INI_SYSTEM, OnUpdateBareMetalPositiveLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.socket_send_buffer_size", "2097152", PHP_INI_SYSTEM, OnUpdateBareMetalPositiveLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.socket_enable_busy_poll_us", "0", PHP_INI_SYSTEM, OnUpdateBareMetalNonNegativeLong, NULL, NULL, NULL)
     STD_PHP_INI_ENTRY("quicpro.socket_enable_timestamping", "1", PHP_INI_SYSTEM, OnUpdateBool, socket_enable_timestamping, qp_bare_metal_config_t, quicpro_bare_metal_config)
+    STD_PHP_INI_ENTRY("quicpro.socket_enable_txtime", "1", PHP_INI_SYSTEM, OnUpdateBool, socket_enable_txtime, qp_bare_metal_config_t, quicpro_bare_metal_config)
+    STD_PHP_INI_ENTRY("quicpro.io_thread_split", "0", PHP_INI_SYSTEM, OnUpdateBool, io_thread_split, qp_bare_metal_config_t, quicpro_bare_metal_config)
     ZEND_INI_ENTRY_EX("quicpro.io_thread_cpu_affinity", "", PHP_INI_SYSTEM, OnUpdateCpuAffinityString, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.io_thread_numa_node_policy", "default", PHP_INI_SYSTEM, OnUpdateNumaPolicyString, &quicpro_bare_metal_config.io_thread_numa_node_policy, NULL, NULL)
 PHP_INI_END()
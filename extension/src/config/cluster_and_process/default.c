@@ -56,4 +56,13 @@ void qp_config_cluster_and_process_defaults_load(void)
     quicpro_cluster_config.cluster_worker_cgroup_path = pestrdup("", 1);
     quicpro_cluster_config.cluster_worker_user_id = pestrdup("", 1);
     quicpro_cluster_config.cluster_worker_group_id = pestrdup("", 1);
+
+    /* --- Native Access Log --- */
+    /* Off by default; JSON lines when enabled. */
+    quicpro_cluster_config.access_log_enable = false;
+    quicpro_cluster_config.access_log_dir = pestrdup("/var/log/quicpro", 1);
+    quicpro_cluster_config.access_log_format = pestrdup("json", 1);
+    /* 4 MiB of 256-byte records per thread, drained every 50 ms. */
+    quicpro_cluster_config.access_log_ring_records = 16384;
+    quicpro_cluster_config.access_log_flush_ms = 50;
 }
@@ -52,11 +52,37 @@ static ZEND_INI_MH(OnUpdateClusterNonNegativeLong)
         quicpro_cluster_config.cluster_max_restarts_per_worker = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.cluster_restart_interval_sec")) {
         quicpro_cluster_config.cluster_restart_interval_sec = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.access_log_ring_records")) {
+        quicpro_cluster_config.access_log_ring_records = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.access_log_flush_ms")) {
+        quicpro_cluster_config.access_log_flush_ms = val;
     }
 
     return SUCCESS;
 }
 
+/*
+ * Custom OnUpdate handler for the access log format: "json" or "binary".
+ */
+static ZEND_INI_MH(OnUpdateAccessLogFormat)
+{
+    if (!zend_string_equals_literal(new_value, "json") && !zend_string_equals_literal(new_value, "binary")) {
+        zend_throw_exception_ex(
+            spl_ce_InvalidArgumentException,
+            0,
+            "Invalid value for quicpro.access_log_format. Must be \"json\" or \"binary\"."
+        );
+        return FAILURE;
+    }
+
+    if (quicpro_cluster_config.access_log_format) {
+        pefree(quicpro_cluster_config.access_log_format, 1);
+    }
+    quicpro_cluster_config.access_log_format = pestrdup(ZSTR_VAL(new_value), 1);
+
+    return SUCCESS;
+}
+
 /*
  * Here we define all php.ini entries this module is responsible for.
  */
@@ -77,6 +103,13 @@ PHP_INI_BEGIN()
     STD_PHP_INI_ENTRY("quicpro.cluster_worker_cgroup_path", "", PHP_INI_SYSTEM, OnUpdateString, cluster_worker_cgroup_path, qp_cluster_config_t, quicpro_cluster_config)
     STD_PHP_INI_ENTRY("quicpro.cluster_worker_user_id", "", PHP_INI_SYSTEM, OnUpdateString, cluster_worker_user_id, qp_cluster_config_t, quicpro_cluster_config)
     STD_PHP_INI_ENTRY("quicpro.cluster_worker_group_id", "", PHP_INI_SYSTEM, OnUpdateString, cluster_worker_group_id, qp_cluster_config_t, quicpro_cluster_config)
+
+    /* --- Native Access Log --- */
+    STD_PHP_INI_ENTRY("quicpro.access_log_enable", "0", PHP_INI_SYSTEM, OnUpdateBool, access_log_enable, qp_cluster_config_t, quicpro_cluster_config)
+    STD_PHP_INI_ENTRY("quicpro.access_log_dir", "/var/log/quicpro", PHP_INI_SYSTEM, OnUpdateString, access_log_dir, qp_cluster_config_t, quicpro_cluster_config)
+    ZEND_INI_ENTRY_EX("quicpro.access_log_format", "json", PHP_INI_SYSTEM, OnUpdateAccessLogFormat, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.access_log_ring_records", "16384", PHP_INI_SYSTEM, OnUpdateClusterNonNegativeLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.access_log_flush_ms", "50", PHP_INI_SYSTEM, OnUpdateClusterNonNegativeLong, NULL, NULL, NULL)
 PHP_INI_END()
 
 /**
@@ -39,6 +39,9 @@
 #include "php_quicpro.h"
 #include "config.h"
 #include "quicpro_ini.h"
+#include "config/quic_transport/base_layer.h"
+#include "config/app_http3_websockets_webtransport/base_layer.h"
+#include "server/congestion.h"
 
 #include <quiche.h>
 #include <zend_smart_str.h>
@@ -50,9 +53,13 @@ static void quicpro_config_apply_defaults(quicpro_cfg_t *cfg);
 static void quicpro_config_apply_ini_settings(quicpro_cfg_t *cfg);
 static void quicpro_config_apply_php_options(quicpro_cfg_t *cfg, HashTable *ht_opts);
 static void quicpro_config_finalize_and_build(quicpro_cfg_t *cfg);
+static void quicpro_config_fingerprint(uint64_t *h, HashTable *ht);
 
 int le_quicpro_cfg;
 
+/* The Config built from php.ini alone; first asked for, then shared, within a request */
+static zend_resource *quicpro_config_default_res;
+
 static void quicpro_config_resource_dtor(zend_resource *rsrc)
 {
     quicpro_cfg_t *cfg = (quicpro_cfg_t *) rsrc->ptr;
@@ -116,10 +123,32 @@ quicpro_cfg_t* quicpro_config_new_from_options(zval *zopts)
         quicpro_config_apply_php_options(cfg, Z_ARRVAL_P(zopts));
     }
 
+    cfg->fingerprint = 14695981039346656037ULL;   /* FNV-1a offset basis */
+    if (zopts && Z_TYPE_P(zopts) == IS_ARRAY) {
+        quicpro_config_fingerprint(&cfg->fingerprint, Z_ARRVAL_P(zopts));
+    }
+
     quicpro_config_finalize_and_build(cfg);
     return cfg;
 }
 
+zend_resource *quicpro_config_default(void)
+{
+    if (!quicpro_config_default_res) {
+        quicpro_cfg_t *cfg = quicpro_config_new_from_options(NULL);
+        if (!cfg) {
+            return NULL;
+        }
+        quicpro_config_default_res = zend_register_resource(cfg, le_quicpro_cfg);
+    }
+    return quicpro_config_default_res;
+}
+
+void quicpro_config_rshutdown(void)
+{
+    quicpro_config_default_res = NULL;   /* Freed with the request's resources */
+}
+
 PHP_FUNCTION(quicpro_new_config)
 {
     zval *zopts = NULL;
@@ -145,6 +174,54 @@ void quicpro_config_mark_frozen(quicpro_cfg_t *cfg)
     }
 }
 
+static void fingerprint_bytes(uint64_t *h, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) {
+        *h = (*h ^ p[i]) * 1099511628211ULL;   /* FNV-1a prime */
+    }
+}
+
+/*
+ * Folds every key and value into `h`, in insertion order, each prefixed
+ * with its type so that "1", 1 and true differ. The INI tier is the same
+ * for every config of a worker and needs no hashing.
+ */
+static void quicpro_config_fingerprint(uint64_t *h, HashTable *ht)
+{
+    zend_ulong idx;
+    zend_string *key;
+    zval *val;
+
+    ZEND_HASH_FOREACH_KEY_VAL(ht, idx, key, val) {
+        if (key) {
+            fingerprint_bytes(h, ZSTR_VAL(key), ZSTR_LEN(key) + 1);
+        } else {
+            fingerprint_bytes(h, &idx, sizeof(idx));
+        }
+        ZVAL_DEREF(val);
+        zend_uchar type = Z_TYPE_P(val);
+        fingerprint_bytes(h, &type, 1);
+        switch (type) {
+            case IS_LONG:
+                fingerprint_bytes(h, &Z_LVAL_P(val), sizeof(zend_long));
+                break;
+            case IS_DOUBLE:
+                fingerprint_bytes(h, &Z_DVAL_P(val), sizeof(double));
+                break;
+            case IS_STRING:
+                fingerprint_bytes(h, Z_STRVAL_P(val), Z_STRLEN_P(val) + 1);
+                break;
+            case IS_ARRAY:
+                quicpro_config_fingerprint(h, Z_ARRVAL_P(val));
+                fingerprint_bytes(h, &type, 1);   /* Closes the nesting level */
+                break;
+            default:   /* null, true, false: the type says it all */
+                break;
+        }
+    } ZEND_HASH_FOREACH_END();
+}
+
 static void quicpro_config_init_all_modules(quicpro_cfg_t *cfg)
 {
     quicpro_config_app_protocols_init(&cfg->app_protocols);
@@ -247,6 +324,33 @@ static void quicpro_config_finalize_and_build(quicpro_cfg_t *cfg)
     quicpro_config_tls_finalize(&cfg->tls, cfg->q_cfg);
     quicpro_config_quic_finalize(&cfg->quic, cfg->q_cfg);
     quicpro_config_app_protocols_finalize(&cfg->app_protocols, cfg->q_cfg);
+
+    // quiche computes the per-packet release times that the transmit path
+    // enforces through SO_TXTIME or the userspace pacer (poll/udp_batch.c).
+    quiche_config_enable_pacing(cfg->q_cfg, quicpro_quic_transport_config.pacing_enable);
+
+    // Path MTU: quiche starts at 1200 bytes and, with DPLPMTUD, probes up
+    // to the send size once the handshake is confirmed (poll/udp_batch.h).
+    quiche_config_set_max_send_udp_payload_size(cfg->q_cfg, (size_t)quicpro_quic_transport_config.max_send_udp_payload_size);
+    quiche_config_set_max_recv_udp_payload_size(cfg->q_cfg, (size_t)quicpro_quic_transport_config.max_recv_udp_payload_size);
+    quiche_config_discover_pmtu(cfg->q_cfg, quicpro_quic_transport_config.pmtud_enable);
+
+    // The default congestion control profile: cc_algorithm, the initial
+    // window and HyStart++ from php.ini. A client connection may pick
+    // another one per target (server/congestion.h).
+    quicpro_cc_profile_t cc;
+    quicpro_cc_profile_lookup(NULL, 0, &cc);
+    quicpro_cc_profile_apply(cfg->q_cfg, &cc);
+
+    // QUIC DATAGRAM frames (RFC 9221), for the quicpro_datagram_*() batches
+    // and WebTransport; quiche then also advertises SETTINGS_H3_DATAGRAM on
+    // the HTTP/3 layer.
+    if (quicpro_quic_transport_config.datagrams_enable
+        || quicpro_app_protocols_config.webtransport_enable) {
+        quiche_config_enable_dgram(cfg->q_cfg, true,
+                                   (size_t)quicpro_quic_transport_config.dgram_recv_queue_len,
+                                   (size_t)quicpro_quic_transport_config.dgram_send_queue_len);
+    }
 }
 
 void quicpro_register_config_resource(int module_number)
@@ -57,6 +57,11 @@ int qp_config_http2_apply_userland_config(zval *config_arr)
             quicpro_http2_config.enable_push = zend_is_true(value);
         } else if (zend_string_equals_literal(key, "max_frame_size")) {
             if (qp_validate_long_range(value, 16384, 16777215, &quicpro_http2_config.max_frame_size) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "window_autotune_enable")) {
+            if (qp_validate_bool(value) != SUCCESS) return FAILURE;
+            quicpro_http2_config.window_autotune_enable = zend_is_true(value);
+        } else if (zend_string_equals_literal(key, "max_connection_window")) {
+            if (qp_validate_positive_long(value, &quicpro_http2_config.max_connection_window) != SUCCESS) return FAILURE;
         }
 
     } ZEND_HASH_FOREACH_END();
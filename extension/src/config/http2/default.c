@@ -27,4 +27,6 @@ void qp_config_http2_defaults_load(void)
     quicpro_http2_config.max_header_list_size = 0; /* 0 means unlimited by default */
     quicpro_http2_config.enable_push = true;
     quicpro_http2_config.max_frame_size = 16384; /* Default per RFC 7540 */
+    quicpro_http2_config.window_autotune_enable = true;
+    quicpro_http2_config.max_connection_window = 16777216; /* 16 MiB: 640 Mbit/s at 200 ms */
 }
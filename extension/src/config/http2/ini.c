@@ -33,6 +33,8 @@ static ZEND_INI_MH(OnUpdateHttp2PositiveLong)
         quicpro_http2_config.initial_window_size = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.http2_max_concurrent_streams")) {
         quicpro_http2_config.max_concurrent_streams = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.http2_max_connection_window")) {
+        quicpro_http2_config.max_connection_window = val;
     }
 
     return SUCCESS;
@@ -59,6 +61,8 @@ PHP_INI_BEGIN()
     STD_PHP_INI_ENTRY("quicpro.http2_max_header_list_size", "0", PHP_INI_SYSTEM, OnUpdateLong, max_header_list_size, qp_http2_config_t, quicpro_http2_config)
     STD_PHP_INI_ENTRY("quicpro.http2_enable_push", "1", PHP_INI_SYSTEM, OnUpdateBool, enable_push, qp_http2_config_t, quicpro_http2_config)
     ZEND_INI_ENTRY_EX("quicpro.http2_max_frame_size", "16384", PHP_INI_SYSTEM, OnUpdateHttp2MaxFrameSize, NULL, NULL, NULL)
+    STD_PHP_INI_ENTRY("quicpro.http2_window_autotune_enable", "1", PHP_INI_SYSTEM, OnUpdateBool, window_autotune_enable, qp_http2_config_t, quicpro_http2_config)
+    ZEND_INI_ENTRY_EX("quicpro.http2_max_connection_window", "16777216", PHP_INI_SYSTEM, OnUpdateHttp2PositiveLong, NULL, NULL, NULL)
 PHP_INI_END()
 
 void qp_config_http2_ini_register(void) { REGISTER_INI_ENTRIES(); }
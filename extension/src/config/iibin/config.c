@@ -49,6 +49,8 @@ int qp_config_iibin_apply_userland_config(zval *config_arr)
         } else if (zend_string_equals_literal(key, "string_interning_enable")) {
             if (qp_validate_bool(value) != SUCCESS) return FAILURE;
             quicpro_iibin_config.string_interning_enable = zend_is_true(value);
+        } else if (zend_string_equals_literal(key, "arena_max_mb")) {
+            if (qp_validate_positive_long(value, &quicpro_iibin_config.arena_max_mb) != SUCCESS) return FAILURE;
         } else if (zend_string_equals_literal(key, "use_shared_memory_buffers")) {
             if (qp_validate_bool(value) != SUCCESS) return FAILURE;
             quicpro_iibin_config.use_shared_memory_buffers = zend_is_true(value);
@@ -26,6 +26,7 @@ void qp_config_iibin_defaults_load(void)
     quicpro_iibin_config.max_schema_fields = 256;
     quicpro_iibin_config.max_recursion_depth = 32;
     quicpro_iibin_config.string_interning_enable = true;
+    quicpro_iibin_config.arena_max_mb = 64;
 
     /* --- Zero-Copy I/O via Shared Memory Buffers --- */
     quicpro_iibin_config.use_shared_memory_buffers = false; /* Opt-in feature */
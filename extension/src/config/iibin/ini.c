@@ -33,6 +33,8 @@ static ZEND_INI_MH(OnUpdateIibinPositiveLong)
         quicpro_iibin_config.max_schema_fields = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.iibin_max_recursion_depth")) {
         quicpro_iibin_config.max_recursion_depth = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.iibin_arena_max_mb")) {
+        quicpro_iibin_config.arena_max_mb = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.io_default_buffer_size_kb")) {
         quicpro_iibin_config.default_buffer_size_kb = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.io_shm_total_memory_mb")) {
@@ -47,6 +49,7 @@ PHP_INI_BEGIN()
     ZEND_INI_ENTRY_EX("quicpro.iibin_max_schema_fields", "256", PHP_INI_SYSTEM, OnUpdateIibinPositiveLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.iibin_max_recursion_depth", "32", PHP_INI_SYSTEM, OnUpdateIibinPositiveLong, NULL, NULL, NULL)
     STD_PHP_INI_ENTRY("quicpro.iibin_string_interning_enable", "1", PHP_INI_SYSTEM, OnUpdateBool, string_interning_enable, qp_iibin_config_t, quicpro_iibin_config)
+    ZEND_INI_ENTRY_EX("quicpro.iibin_arena_max_mb", "64", PHP_INI_SYSTEM, OnUpdateIibinPositiveLong, NULL, NULL, NULL)
 
     /* --- Zero-Copy I/O via Shared Memory Buffers --- */
     STD_PHP_INI_ENTRY("quicpro.io_use_shared_memory_buffers", "0", PHP_INI_SYSTEM, OnUpdateBool, use_shared_memory_buffers, qp_iibin_config_t, quicpro_iibin_config)
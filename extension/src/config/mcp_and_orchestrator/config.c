@@ -19,6 +19,7 @@
 /* Centralized validation helpers */
 #include "include/validation/config_param/validate_bool.h"
 #include "include/validation/config_param/validate_positive_long.h"
+#include "include/validation/config_param/validate_long_range.h"
 
 #include "php.h"
 #include <ext/spl/spl_exceptions.h>
@@ -52,17 +53,50 @@ int qp_config_mcp_and_orchestrator_apply_userland_config(zval *config_arr)
             if (qp_validate_positive_long(value, &quicpro_mcp_orchestrator_config.mcp_default_retry_max_attempts) != SUCCESS) return FAILURE;
         } else if (zend_string_equals_literal(key, "mcp_default_retry_backoff_ms_initial")) {
             if (qp_validate_positive_long(value, &quicpro_mcp_orchestrator_config.mcp_default_retry_backoff_ms_initial) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "mcp_retry_budget_percent")) {
+            if (qp_validate_long_range(value, 1, 100, &quicpro_mcp_orchestrator_config.mcp_retry_budget_percent) != SUCCESS) return FAILURE;
         } else if (zend_string_equals_literal(key, "mcp_enable_request_caching")) {
             if (qp_validate_bool(value) != SUCCESS) return FAILURE;
             quicpro_mcp_orchestrator_config.mcp_enable_request_caching = zend_is_true(value);
         } else if (zend_string_equals_literal(key, "mcp_request_cache_ttl_sec")) {
             if (qp_validate_positive_long(value, &quicpro_mcp_orchestrator_config.mcp_request_cache_ttl_sec) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "mcp_request_cache_entries")) {
+            if (qp_validate_positive_long(value, &quicpro_mcp_orchestrator_config.mcp_request_cache_entries) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "mcp_request_cache_entry_max_kb")) {
+            if (qp_validate_positive_long(value, &quicpro_mcp_orchestrator_config.mcp_request_cache_entry_max_kb) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "mcp_request_cache_shared")) {
+            if (qp_validate_bool(value) != SUCCESS) return FAILURE;
+            quicpro_mcp_orchestrator_config.mcp_request_cache_shared = zend_is_true(value);
+        } else if (zend_string_equals_literal(key, "mcp_circuit_breaker_enable")) {
+            if (qp_validate_bool(value) != SUCCESS) return FAILURE;
+            quicpro_mcp_orchestrator_config.mcp_circuit_breaker_enable = zend_is_true(value);
+        } else if (zend_string_equals_literal(key, "mcp_circuit_breaker_failure_rate_percent")) {
+            if (qp_validate_long_range(value, 1, 100, &quicpro_mcp_orchestrator_config.mcp_circuit_breaker_failure_rate_percent) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "mcp_circuit_breaker_slow_call_ms")) {
+            if (qp_validate_positive_long(value, &quicpro_mcp_orchestrator_config.mcp_circuit_breaker_slow_call_ms) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "mcp_circuit_breaker_slow_call_rate_percent")) {
+            if (qp_validate_long_range(value, 1, 100, &quicpro_mcp_orchestrator_config.mcp_circuit_breaker_slow_call_rate_percent) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "mcp_circuit_breaker_min_calls")) {
+            if (qp_validate_long_range(value, 1, 64, &quicpro_mcp_orchestrator_config.mcp_circuit_breaker_min_calls) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "mcp_circuit_breaker_open_ms")) {
+            if (qp_validate_positive_long(value, &quicpro_mcp_orchestrator_config.mcp_circuit_breaker_open_ms) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "mcp_circuit_breaker_half_open_probes")) {
+            if (qp_validate_positive_long(value, &quicpro_mcp_orchestrator_config.mcp_circuit_breaker_half_open_probes) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "mcp_adaptive_concurrency_enable")) {
+            if (qp_validate_bool(value) != SUCCESS) return FAILURE;
+            quicpro_mcp_orchestrator_config.mcp_adaptive_concurrency_enable = zend_is_true(value);
+        } else if (zend_string_equals_literal(key, "mcp_concurrency_limit_initial")) {
+            if (qp_validate_positive_long(value, &quicpro_mcp_orchestrator_config.mcp_concurrency_limit_initial) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "mcp_concurrency_limit_max")) {
+            if (qp_validate_positive_long(value, &quicpro_mcp_orchestrator_config.mcp_concurrency_limit_max) != SUCCESS) return FAILURE;
         } else if (zend_string_equals_literal(key, "orchestrator_default_pipeline_timeout_ms")) {
             if (qp_validate_positive_long(value, &quicpro_mcp_orchestrator_config.orchestrator_default_pipeline_timeout_ms) != SUCCESS) return FAILURE;
         } else if (zend_string_equals_literal(key, "orchestrator_max_recursion_depth")) {
             if (qp_validate_positive_long(value, &quicpro_mcp_orchestrator_config.orchestrator_max_recursion_depth) != SUCCESS) return FAILURE;
         } else if (zend_string_equals_literal(key, "orchestrator_loop_concurrency_default")) {
             if (qp_validate_positive_long(value, &quicpro_mcp_orchestrator_config.orchestrator_loop_concurrency_default) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "orchestrator_step_concurrency_default")) {
+            if (qp_validate_positive_long(value, &quicpro_mcp_orchestrator_config.orchestrator_step_concurrency_default) != SUCCESS) return FAILURE;
         } else if (zend_string_equals_literal(key, "orchestrator_enable_distributed_tracing")) {
             if (qp_validate_bool(value) != SUCCESS) return FAILURE;
             quicpro_mcp_orchestrator_config.orchestrator_enable_distributed_tracing = zend_is_true(value);
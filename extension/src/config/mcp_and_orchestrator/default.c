@@ -27,12 +27,29 @@ void qp_config_mcp_and_orchestrator_defaults_load(void)
     quicpro_mcp_orchestrator_config.mcp_default_retry_policy_enable = true;
     quicpro_mcp_orchestrator_config.mcp_default_retry_max_attempts = 3;
     quicpro_mcp_orchestrator_config.mcp_default_retry_backoff_ms_initial = 100;
+    quicpro_mcp_orchestrator_config.mcp_retry_budget_percent = 10;
     quicpro_mcp_orchestrator_config.mcp_enable_request_caching = false;
     quicpro_mcp_orchestrator_config.mcp_request_cache_ttl_sec = 60;
+    quicpro_mcp_orchestrator_config.mcp_request_cache_entries = 1024;
+    quicpro_mcp_orchestrator_config.mcp_request_cache_entry_max_kb = 16;
+    quicpro_mcp_orchestrator_config.mcp_request_cache_shared = true;
+
+    /* --- MCP Circuit Breaker & Concurrency Limit --- */
+    quicpro_mcp_orchestrator_config.mcp_circuit_breaker_enable = false;
+    quicpro_mcp_orchestrator_config.mcp_circuit_breaker_failure_rate_percent = 50;
+    quicpro_mcp_orchestrator_config.mcp_circuit_breaker_slow_call_ms = 5000;
+    quicpro_mcp_orchestrator_config.mcp_circuit_breaker_slow_call_rate_percent = 80;
+    quicpro_mcp_orchestrator_config.mcp_circuit_breaker_min_calls = 20;
+    quicpro_mcp_orchestrator_config.mcp_circuit_breaker_open_ms = 5000;
+    quicpro_mcp_orchestrator_config.mcp_circuit_breaker_half_open_probes = 3;
+    quicpro_mcp_orchestrator_config.mcp_adaptive_concurrency_enable = false;
+    quicpro_mcp_orchestrator_config.mcp_concurrency_limit_initial = 20;
+    quicpro_mcp_orchestrator_config.mcp_concurrency_limit_max = 1000;
 
     /* --- Pipeline Orchestrator Settings --- */
     quicpro_mcp_orchestrator_config.orchestrator_default_pipeline_timeout_ms = 120000;
     quicpro_mcp_orchestrator_config.orchestrator_max_recursion_depth = 10;
     quicpro_mcp_orchestrator_config.orchestrator_loop_concurrency_default = 50;
+    quicpro_mcp_orchestrator_config.orchestrator_step_concurrency_default = 8;
     quicpro_mcp_orchestrator_config.orchestrator_enable_distributed_tracing = true;
 }
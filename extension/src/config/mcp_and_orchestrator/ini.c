@@ -38,12 +38,50 @@ static ZEND_INI_MH(OnUpdateMcpPositiveLong)
         quicpro_mcp_orchestrator_config.mcp_default_retry_backoff_ms_initial = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.mcp_request_cache_ttl_sec")) {
         quicpro_mcp_orchestrator_config.mcp_request_cache_ttl_sec = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.mcp_request_cache_entries")) {
+        quicpro_mcp_orchestrator_config.mcp_request_cache_entries = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.mcp_request_cache_entry_max_kb")) {
+        quicpro_mcp_orchestrator_config.mcp_request_cache_entry_max_kb = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.mcp_circuit_breaker_slow_call_ms")) {
+        quicpro_mcp_orchestrator_config.mcp_circuit_breaker_slow_call_ms = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.mcp_circuit_breaker_open_ms")) {
+        quicpro_mcp_orchestrator_config.mcp_circuit_breaker_open_ms = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.mcp_circuit_breaker_half_open_probes")) {
+        quicpro_mcp_orchestrator_config.mcp_circuit_breaker_half_open_probes = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.mcp_concurrency_limit_initial")) {
+        quicpro_mcp_orchestrator_config.mcp_concurrency_limit_initial = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.mcp_concurrency_limit_max")) {
+        quicpro_mcp_orchestrator_config.mcp_concurrency_limit_max = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.orchestrator_default_pipeline_timeout_ms")) {
         quicpro_mcp_orchestrator_config.orchestrator_default_pipeline_timeout_ms = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.orchestrator_max_recursion_depth")) {
         quicpro_mcp_orchestrator_config.orchestrator_max_recursion_depth = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.orchestrator_loop_concurrency_default")) {
         quicpro_mcp_orchestrator_config.orchestrator_loop_concurrency_default = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.orchestrator_step_concurrency_default")) {
+        quicpro_mcp_orchestrator_config.orchestrator_step_concurrency_default = val;
+    }
+    return SUCCESS;
+}
+
+/* Custom OnUpdate handler for the breaker's rates (percent), its window (calls) and the retry budget (percent) */
+static ZEND_INI_MH(OnUpdateMcpBreakerRange)
+{
+    zend_long val = zend_atol(ZSTR_VAL(new_value), ZSTR_LEN(new_value));
+    zend_long max = zend_string_equals_literal(entry->name, "quicpro.mcp_circuit_breaker_min_calls") ? 64 : 100;
+    if (val < 1 || val > max) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Invalid value for an MCP circuit breaker or retry budget directive. An integer between 1 and %d is required.", (int)max);
+        return FAILURE;
+    }
+
+    if (zend_string_equals_literal(entry->name, "quicpro.mcp_circuit_breaker_failure_rate_percent")) {
+        quicpro_mcp_orchestrator_config.mcp_circuit_breaker_failure_rate_percent = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.mcp_circuit_breaker_slow_call_rate_percent")) {
+        quicpro_mcp_orchestrator_config.mcp_circuit_breaker_slow_call_rate_percent = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.mcp_circuit_breaker_min_calls")) {
+        quicpro_mcp_orchestrator_config.mcp_circuit_breaker_min_calls = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.mcp_retry_budget_percent")) {
+        quicpro_mcp_orchestrator_config.mcp_retry_budget_percent = val;
     }
     return SUCCESS;
 }
@@ -56,13 +94,30 @@ PHP_INI_BEGIN()
     STD_PHP_INI_ENTRY("quicpro.mcp_default_retry_policy_enable",     "1",     PHP_INI_SYSTEM, OnUpdateBool, mcp_default_retry_policy_enable, qp_mcp_orchestrator_config_t, quicpro_mcp_orchestrator_config)
     ZEND_INI_ENTRY_EX("quicpro.mcp_default_retry_max_attempts",      "3",     PHP_INI_SYSTEM, OnUpdateMcpPositiveLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.mcp_default_retry_backoff_ms_initial","100",   PHP_INI_SYSTEM, OnUpdateMcpPositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.mcp_retry_budget_percent",            "10",    PHP_INI_SYSTEM, OnUpdateMcpBreakerRange, NULL, NULL, NULL)
     STD_PHP_INI_ENTRY("quicpro.mcp_enable_request_caching",          "0",     PHP_INI_SYSTEM, OnUpdateBool, mcp_enable_request_caching, qp_mcp_orchestrator_config_t, quicpro_mcp_orchestrator_config)
     ZEND_INI_ENTRY_EX("quicpro.mcp_request_cache_ttl_sec",           "60",    PHP_INI_SYSTEM, OnUpdateMcpPositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.mcp_request_cache_entries",           "1024",  PHP_INI_SYSTEM, OnUpdateMcpPositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.mcp_request_cache_entry_max_kb",      "16",    PHP_INI_SYSTEM, OnUpdateMcpPositiveLong, NULL, NULL, NULL)
+    STD_PHP_INI_ENTRY("quicpro.mcp_request_cache_shared",            "1",     PHP_INI_SYSTEM, OnUpdateBool, mcp_request_cache_shared, qp_mcp_orchestrator_config_t, quicpro_mcp_orchestrator_config)
+
+    /* --- MCP Circuit Breaker & Concurrency Limit --- */
+    STD_PHP_INI_ENTRY("quicpro.mcp_circuit_breaker_enable",                "0",    PHP_INI_SYSTEM, OnUpdateBool, mcp_circuit_breaker_enable, qp_mcp_orchestrator_config_t, quicpro_mcp_orchestrator_config)
+    ZEND_INI_ENTRY_EX("quicpro.mcp_circuit_breaker_failure_rate_percent",  "50",   PHP_INI_SYSTEM, OnUpdateMcpBreakerRange, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.mcp_circuit_breaker_slow_call_ms",          "5000", PHP_INI_SYSTEM, OnUpdateMcpPositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.mcp_circuit_breaker_slow_call_rate_percent","80",   PHP_INI_SYSTEM, OnUpdateMcpBreakerRange, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.mcp_circuit_breaker_min_calls",             "20",   PHP_INI_SYSTEM, OnUpdateMcpBreakerRange, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.mcp_circuit_breaker_open_ms",               "5000", PHP_INI_SYSTEM, OnUpdateMcpPositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.mcp_circuit_breaker_half_open_probes",      "3",    PHP_INI_SYSTEM, OnUpdateMcpPositiveLong, NULL, NULL, NULL)
+    STD_PHP_INI_ENTRY("quicpro.mcp_adaptive_concurrency_enable",           "0",    PHP_INI_SYSTEM, OnUpdateBool, mcp_adaptive_concurrency_enable, qp_mcp_orchestrator_config_t, quicpro_mcp_orchestrator_config)
+    ZEND_INI_ENTRY_EX("quicpro.mcp_concurrency_limit_initial",             "20",   PHP_INI_SYSTEM, OnUpdateMcpPositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.mcp_concurrency_limit_max",                 "1000", PHP_INI_SYSTEM, OnUpdateMcpPositiveLong, NULL, NULL, NULL)
 
     /* --- Pipeline Orchestrator Settings --- */
     ZEND_INI_ENTRY_EX("quicpro.orchestrator_default_pipeline_timeout_ms", "120000",PHP_INI_SYSTEM, OnUpdateMcpPositiveLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.orchestrator_max_recursion_depth",         "10",    PHP_INI_SYSTEM, OnUpdateMcpPositiveLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.orchestrator_loop_concurrency_default",    "50",    PHP_INI_SYSTEM, OnUpdateMcpPositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.orchestrator_step_concurrency_default",    "8",     PHP_INI_SYSTEM, OnUpdateMcpPositiveLong, NULL, NULL, NULL)
     STD_PHP_INI_ENTRY("quicpro.orchestrator_enable_distributed_tracing",  "1",     PHP_INI_SYSTEM, OnUpdateBool, orchestrator_enable_distributed_tracing, qp_mcp_orchestrator_config_t, quicpro_mcp_orchestrator_config)
 PHP_INI_END()
 
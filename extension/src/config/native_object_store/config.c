@@ -80,6 +80,12 @@ int qp_config_native_object_store_apply_userland_config(zval *config_arr)
         } else if (zend_string_equals_literal(key, "enable_directstorage")) {
             if (qp_validate_bool(value) != SUCCESS) return FAILURE;
             quicpro_native_object_store_config.enable_directstorage = zend_is_true(value);
+        } else if (zend_string_equals_literal(key, "read_ahead_chunks")) {
+            if (qp_validate_positive_long(value, &quicpro_native_object_store_config.read_ahead_chunks) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "write_behind_chunks")) {
+            if (qp_validate_positive_long(value, &quicpro_native_object_store_config.write_behind_chunks) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "dedup_average_chunk_kb")) {
+            if (qp_validate_positive_long(value, &quicpro_native_object_store_config.dedup_average_chunk_kb) != SUCCESS) return FAILURE;
         }
 
     } ZEND_HASH_FOREACH_END();
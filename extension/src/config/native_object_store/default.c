@@ -43,4 +43,7 @@ void qp_config_native_object_store_defaults_load(void)
     quicpro_native_object_store_config.metadata_cache_enable = true;
     quicpro_native_object_store_config.metadata_cache_ttl_sec = 60;
     quicpro_native_object_store_config.enable_directstorage = false;
+    quicpro_native_object_store_config.read_ahead_chunks = 4;
+    quicpro_native_object_store_config.write_behind_chunks = 2;
+    quicpro_native_object_store_config.dedup_average_chunk_kb = 1024;
 }
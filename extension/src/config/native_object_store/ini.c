@@ -36,6 +36,12 @@ static ZEND_INI_MH(OnUpdateObjectStorePositiveLong)
         quicpro_native_object_store_config.default_chunk_size_mb = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.storage_metadata_cache_ttl_sec")) {
         quicpro_native_object_store_config.metadata_cache_ttl_sec = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.storage_read_ahead_chunks")) {
+        quicpro_native_object_store_config.read_ahead_chunks = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.storage_write_behind_chunks")) {
+        quicpro_native_object_store_config.write_behind_chunks = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.storage_dedup_average_chunk_kb")) {
+        quicpro_native_object_store_config.dedup_average_chunk_kb = val;
     }
     return SUCCESS;
 }
@@ -113,6 +119,9 @@ PHP_INI_BEGIN()
     STD_PHP_INI_ENTRY("quicpro.storage_metadata_cache_enable", "1", PHP_INI_SYSTEM, OnUpdateBool, metadata_cache_enable, qp_native_object_store_config_t, quicpro_native_object_store_config)
     ZEND_INI_ENTRY_EX("quicpro.storage_metadata_cache_ttl_sec", "60", PHP_INI_SYSTEM, OnUpdateObjectStorePositiveLong, NULL, NULL, NULL)
     STD_PHP_INI_ENTRY("quicpro.storage_enable_directstorage", "0", PHP_INI_SYSTEM, OnUpdateBool, enable_directstorage, qp_native_object_store_config_t, quicpro_native_object_store_config)
+    ZEND_INI_ENTRY_EX("quicpro.storage_read_ahead_chunks", "4", PHP_INI_SYSTEM, OnUpdateObjectStorePositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.storage_write_behind_chunks", "2", PHP_INI_SYSTEM, OnUpdateObjectStorePositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.storage_dedup_average_chunk_kb", "1024", PHP_INI_SYSTEM, OnUpdateObjectStorePositiveLong, NULL, NULL, NULL)
 PHP_INI_END()
 
 void qp_config_native_object_store_ini_register(void) { REGISTER_INI_ENTRIES(); }
@@ -21,6 +21,8 @@
 #include "include/validation/config_param/validate_positive_long.h"
 #include "include/validation/config_param/validate_non_negative_long.h"
 #include "include/validation/config_param/validate_string_from_allowlist.h"
+#include "include/validation/config_param/validate_double_range.h"
+#include "include/validation/config_param/validate_long_range.h"
 
 #include "php.h"
 #include <ext/spl/spl_exceptions.h>
@@ -44,7 +46,7 @@ int qp_config_quic_transport_apply_userland_config(zval *config_arr)
         if (!key) continue;
 
         if (zend_string_equals_literal(key, "cc_algorithm")) {
-            const char *allowed[] = {"cubic", "bbr", NULL};
+            const char *allowed[] = {"cubic", "reno", "bbr", "bbr2", NULL};
             if (qp_validate_string_from_allowlist(value, allowed, &quicpro_quic_transport_config.cc_algorithm) != SUCCESS) return FAILURE;
         } else if (zend_string_equals_literal(key, "cc_initial_cwnd_packets")) {
             if (qp_validate_positive_long(value, &quicpro_quic_transport_config.cc_initial_cwnd_packets) != SUCCESS) return FAILURE;
@@ -87,6 +89,8 @@ int qp_config_quic_transport_apply_userland_config(zval *config_arr)
         } else if (zend_string_equals_literal(key, "stateless_retry_enable")) {
             if (qp_validate_bool(value) != SUCCESS) return FAILURE;
             quicpro_quic_transport_config.stateless_retry_enable = zend_is_true(value);
+        } else if (zend_string_equals_literal(key, "stateless_retry_auto_threshold")) {
+            if (qp_validate_non_negative_long(value, &quicpro_quic_transport_config.stateless_retry_auto_threshold) != SUCCESS) return FAILURE;
         } else if (zend_string_equals_literal(key, "grease_enable")) {
             if (qp_validate_bool(value) != SUCCESS) return FAILURE;
             quicpro_quic_transport_config.grease_enable = zend_is_true(value);
@@ -97,6 +101,55 @@ int qp_config_quic_transport_apply_userland_config(zval *config_arr)
             if (qp_validate_positive_long(value, &quicpro_quic_transport_config.dgram_recv_queue_len) != SUCCESS) return FAILURE;
         } else if (zend_string_equals_literal(key, "dgram_send_queue_len")) {
             if (qp_validate_positive_long(value, &quicpro_quic_transport_config.dgram_send_queue_len) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "dgram_fec_source_symbols")) {
+            if (qp_validate_long_range(value, 0, QUICPRO_DGRAM_FEC_SOURCE_MAX, &quicpro_quic_transport_config.dgram_fec_source_symbols) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "dgram_fec_repair_symbols")) {
+            if (qp_validate_long_range(value, 1, QUICPRO_DGRAM_FEC_REPAIR_MAX, &quicpro_quic_transport_config.dgram_fec_repair_symbols) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "max_send_udp_payload_size")) {
+            if (qp_validate_long_range(value, QUICPRO_UDP_PAYLOAD_MIN, QUICPRO_UDP_PAYLOAD_MAX, &quicpro_quic_transport_config.max_send_udp_payload_size) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "max_recv_udp_payload_size")) {
+            if (qp_validate_long_range(value, QUICPRO_UDP_PAYLOAD_MIN, QUICPRO_UDP_PAYLOAD_MAX, &quicpro_quic_transport_config.max_recv_udp_payload_size) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "pmtud_enable")) {
+            if (qp_validate_bool(value) != SUCCESS) return FAILURE;
+            quicpro_quic_transport_config.pmtud_enable = zend_is_true(value);
+        } else if (zend_string_equals_literal(key, "ecn_enable")) {
+            if (qp_validate_bool(value) != SUCCESS) return FAILURE;
+            quicpro_quic_transport_config.ecn_enable = zend_is_true(value);
+        } else if (zend_string_equals_literal(key, "ecn_mark_ect")) {
+            if (qp_validate_bool(value) != SUCCESS) return FAILURE;
+            quicpro_quic_transport_config.ecn_mark_ect = zend_is_true(value);
+        } else if (zend_string_equals_literal(key, "client_pool_enable")) {
+            if (qp_validate_bool(value) != SUCCESS) return FAILURE;
+            quicpro_quic_transport_config.client_pool_enable = zend_is_true(value);
+        } else if (zend_string_equals_literal(key, "client_pool_max_idle")) {
+            if (qp_validate_non_negative_long(value, &quicpro_quic_transport_config.client_pool_max_idle) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "client_pool_idle_timeout_ms")) {
+            if (qp_validate_positive_long(value, &quicpro_quic_transport_config.client_pool_idle_timeout_ms) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "client_pool_max_streams_per_conn")) {
+            if (qp_validate_positive_long(value, &quicpro_quic_transport_config.client_pool_max_streams_per_conn) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "client_pool_persistent")) {
+            if (qp_validate_bool(value) != SUCCESS) return FAILURE;
+            quicpro_quic_transport_config.client_pool_persistent = zend_is_true(value);
+        } else if (zend_string_equals_literal(key, "idle_hibernate_ms")) {
+            if (qp_validate_non_negative_long(value, &quicpro_quic_transport_config.idle_hibernate_ms) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "dns_timeout_ms")) {
+            if (qp_validate_positive_long(value, &quicpro_quic_transport_config.dns_timeout_ms) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "dns_cache_max_ttl_sec")) {
+            if (qp_validate_non_negative_long(value, &quicpro_quic_transport_config.dns_cache_max_ttl_sec) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "happy_eyeballs_delay_ms")) {
+            if (qp_validate_non_negative_long(value, &quicpro_quic_transport_config.happy_eyeballs_delay_ms) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "happy_eyeballs_timeout_ms")) {
+            if (qp_validate_non_negative_long(value, &quicpro_quic_transport_config.happy_eyeballs_timeout_ms) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "qlog_sample_ratio")) {
+            if (qp_validate_double_range(value, 0.0, 1.0, &quicpro_quic_transport_config.qlog_sample_ratio) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "qlog_ring_events")) {
+            if (qp_validate_positive_long(value, &quicpro_quic_transport_config.qlog_ring_events) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "capture_sample_ratio")) {
+            if (qp_validate_double_range(value, 0.0, 1.0, &quicpro_quic_transport_config.capture_sample_ratio) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "capture_ring_bytes")) {
+            if (qp_validate_non_negative_long(value, &quicpro_quic_transport_config.capture_ring_bytes) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "capture_snaplen")) {
+            if (qp_validate_long_range(value, QUICPRO_CAPTURE_SNAPLEN_MIN, QUICPRO_CAPTURE_SNAPLEN_MAX, &quicpro_quic_transport_config.capture_snaplen) != SUCCESS) return FAILURE;
         }
 
     } ZEND_HASH_FOREACH_END();
@@ -49,8 +49,39 @@ void qp_config_quic_transport_defaults_load(void)
     /* --- Protocol Features & Datagrams --- */
     quicpro_quic_transport_config.active_connection_id_limit = 8;
     quicpro_quic_transport_config.stateless_retry_enable = false;
+    quicpro_quic_transport_config.stateless_retry_auto_threshold = 2000;
     quicpro_quic_transport_config.grease_enable = true;
     quicpro_quic_transport_config.datagrams_enable = true;
     quicpro_quic_transport_config.dgram_recv_queue_len = 1024;
     quicpro_quic_transport_config.dgram_send_queue_len = 1024;
+    quicpro_quic_transport_config.dgram_fec_source_symbols = 0;
+    quicpro_quic_transport_config.dgram_fec_repair_symbols = 2;
+
+    /* --- Path MTU (RFC 8899 DPLPMTUD) --- */
+    quicpro_quic_transport_config.max_send_udp_payload_size = 1350;
+    quicpro_quic_transport_config.max_recv_udp_payload_size = 1500;
+    quicpro_quic_transport_config.pmtud_enable = true;
+    quicpro_quic_transport_config.ecn_enable = true;
+    quicpro_quic_transport_config.ecn_mark_ect = false;
+
+    /* --- Client Connection Pool --- */
+    quicpro_quic_transport_config.client_pool_enable = true;
+    quicpro_quic_transport_config.client_pool_max_idle = 4;
+    quicpro_quic_transport_config.client_pool_idle_timeout_ms = 30000;
+    quicpro_quic_transport_config.client_pool_max_streams_per_conn = 100;
+    quicpro_quic_transport_config.client_pool_persistent = false;
+    quicpro_quic_transport_config.idle_hibernate_ms = 30000;
+
+    /* --- Client Connection Setup --- */
+    quicpro_quic_transport_config.dns_timeout_ms = 5000;
+    quicpro_quic_transport_config.dns_cache_max_ttl_sec = 300;
+    quicpro_quic_transport_config.happy_eyeballs_delay_ms = 250;
+    quicpro_quic_transport_config.happy_eyeballs_timeout_ms = 2000;
+
+    /* --- Diagnostics --- */
+    quicpro_quic_transport_config.qlog_sample_ratio = 0.0;
+    quicpro_quic_transport_config.qlog_ring_events = 65536;
+    quicpro_quic_transport_config.capture_sample_ratio = 0.0;
+    quicpro_quic_transport_config.capture_ring_bytes = 16777216;
+    quicpro_quic_transport_config.capture_snaplen = 1500;
 }
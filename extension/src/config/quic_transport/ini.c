@@ -55,10 +55,82 @@ static ZEND_INI_MH(OnUpdateAckDelayExponent)
     return SUCCESS;
 }
 
+/* Custom OnUpdate handler for UDP payload sizes (1200 - 65527 bytes). */
+static ZEND_INI_MH(OnUpdateUdpPayloadSize)
+{
+    zend_long val = zend_atol(ZSTR_VAL(new_value), ZSTR_LEN(new_value));
+    if (val < QUICPRO_UDP_PAYLOAD_MIN || val > QUICPRO_UDP_PAYLOAD_MAX) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Invalid value for a UDP payload size. An integer between 1200 and 65527 is required.");
+        return FAILURE;
+    }
+    *(zend_long*)mh_arg1 = val;
+    return SUCCESS;
+}
+
+/* Custom OnUpdate handler for the datagram FEC block size (0 - 24 datagrams). */
+static ZEND_INI_MH(OnUpdateDgramFecSourceSymbols)
+{
+    zend_long val = zend_atol(ZSTR_VAL(new_value), ZSTR_LEN(new_value));
+    if (val < 0 || val > QUICPRO_DGRAM_FEC_SOURCE_MAX) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Invalid value for datagram FEC source symbols. An integer between 0 and 24 is required.");
+        return FAILURE;
+    }
+    quicpro_quic_transport_config.dgram_fec_source_symbols = val;
+    return SUCCESS;
+}
+
+/* Custom OnUpdate handler for the repair datagrams per FEC block (1 - 8). */
+static ZEND_INI_MH(OnUpdateDgramFecRepairSymbols)
+{
+    zend_long val = zend_atol(ZSTR_VAL(new_value), ZSTR_LEN(new_value));
+    if (val < 1 || val > QUICPRO_DGRAM_FEC_REPAIR_MAX) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Invalid value for datagram FEC repair symbols. An integer between 1 and 8 is required.");
+        return FAILURE;
+    }
+    quicpro_quic_transport_config.dgram_fec_repair_symbols = val;
+    return SUCCESS;
+}
+
+/* Custom OnUpdate handler for the share of connections traced to qlog (0.0 - 1.0). */
+static ZEND_INI_MH(OnUpdateQlogSampleRatio)
+{
+    double val = zend_strtod(ZSTR_VAL(new_value), NULL);
+    if (val < 0.0 || val > 1.0) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Invalid value for qlog sample ratio. A float between 0.0 and 1.0 is required.");
+        return FAILURE;
+    }
+    quicpro_quic_transport_config.qlog_sample_ratio = val;
+    return SUCCESS;
+}
+
+/* Custom OnUpdate handler for the share of connections captured with their TLS secrets (0.0 - 1.0). */
+static ZEND_INI_MH(OnUpdateCaptureSampleRatio)
+{
+    double val = zend_strtod(ZSTR_VAL(new_value), NULL);
+    if (val < 0.0 || val > 1.0) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Invalid value for capture sample ratio. A float between 0.0 and 1.0 is required.");
+        return FAILURE;
+    }
+    quicpro_quic_transport_config.capture_sample_ratio = val;
+    return SUCCESS;
+}
+
+/* Custom OnUpdate handler for the bytes of a captured datagram kept (64 - 65535). */
+static ZEND_INI_MH(OnUpdateCaptureSnaplen)
+{
+    zend_long val = zend_atol(ZSTR_VAL(new_value), ZSTR_LEN(new_value));
+    if (val < QUICPRO_CAPTURE_SNAPLEN_MIN || val > QUICPRO_CAPTURE_SNAPLEN_MAX) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Invalid value for capture snaplen. An integer between 64 and 65535 is required.");
+        return FAILURE;
+    }
+    quicpro_quic_transport_config.capture_snaplen = val;
+    return SUCCESS;
+}
+
 /* Custom OnUpdate handler for the CC algorithm string */
 static ZEND_INI_MH(OnUpdateCcAlgorithm)
 {
-    const char *allowed[] = {"cubic", "bbr", NULL};
+    const char *allowed[] = {"cubic", "reno", "bbr", "bbr2", NULL};
     bool is_allowed = false;
     for (int i = 0; allowed[i] != NULL; i++) {
         if (strcasecmp(ZSTR_VAL(new_value), allowed[i]) == 0) {
@@ -67,7 +139,7 @@ static ZEND_INI_MH(OnUpdateCcAlgorithm)
         }
     }
     if (!is_allowed) {
-        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Invalid value for CC algorithm. Must be 'cubic' or 'bbr'.");
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Invalid value for CC algorithm. Must be 'cubic', 'reno', 'bbr' or 'bbr2'.");
         return FAILURE;
     }
     OnUpdateString(entry, new_value, mh_arg1, mh_arg2, mh_arg3);
@@ -99,10 +171,37 @@ PHP_INI_BEGIN()
 
     ZEND_INI_ENTRY_EX("quicpro.transport_active_connection_id_limit", "8", PHP_INI_SYSTEM, OnUpdateQuicPositiveLong, &quicpro_quic_transport_config.active_connection_id_limit, NULL, NULL)
     STD_PHP_INI_ENTRY("quicpro.transport_stateless_retry_enable", "0", PHP_INI_SYSTEM, OnUpdateBool, stateless_retry_enable, qp_quic_transport_config_t, quicpro_quic_transport_config)
+    ZEND_INI_ENTRY_EX("quicpro.transport_stateless_retry_auto_threshold", "2000", PHP_INI_SYSTEM, OnUpdateQuicNonNegativeLong, &quicpro_quic_transport_config.stateless_retry_auto_threshold, NULL, NULL)
     STD_PHP_INI_ENTRY("quicpro.transport_grease_enable", "1", PHP_INI_SYSTEM, OnUpdateBool, grease_enable, qp_quic_transport_config_t, quicpro_quic_transport_config)
     STD_PHP_INI_ENTRY("quicpro.transport_datagrams_enable", "1", PHP_INI_SYSTEM, OnUpdateBool, datagrams_enable, qp_quic_transport_config_t, quicpro_quic_transport_config)
     ZEND_INI_ENTRY_EX("quicpro.transport_dgram_recv_queue_len", "1024", PHP_INI_SYSTEM, OnUpdateQuicPositiveLong, &quicpro_quic_transport_config.dgram_recv_queue_len, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.transport_dgram_send_queue_len", "1024", PHP_INI_SYSTEM, OnUpdateQuicPositiveLong, &quicpro_quic_transport_config.dgram_send_queue_len, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.transport_dgram_fec_source_symbols", "0", PHP_INI_SYSTEM, OnUpdateDgramFecSourceSymbols, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.transport_dgram_fec_repair_symbols", "2", PHP_INI_SYSTEM, OnUpdateDgramFecRepairSymbols, NULL, NULL, NULL)
+
+    ZEND_INI_ENTRY_EX("quicpro.transport_max_send_udp_payload_size", "1350", PHP_INI_SYSTEM, OnUpdateUdpPayloadSize, &quicpro_quic_transport_config.max_send_udp_payload_size, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.transport_max_recv_udp_payload_size", "1500", PHP_INI_SYSTEM, OnUpdateUdpPayloadSize, &quicpro_quic_transport_config.max_recv_udp_payload_size, NULL, NULL)
+    STD_PHP_INI_ENTRY("quicpro.transport_pmtud_enable", "1", PHP_INI_SYSTEM, OnUpdateBool, pmtud_enable, qp_quic_transport_config_t, quicpro_quic_transport_config)
+    STD_PHP_INI_ENTRY("quicpro.transport_ecn_enable", "1", PHP_INI_SYSTEM, OnUpdateBool, ecn_enable, qp_quic_transport_config_t, quicpro_quic_transport_config)
+    STD_PHP_INI_ENTRY("quicpro.transport_ecn_mark_ect", "0", PHP_INI_SYSTEM, OnUpdateBool, ecn_mark_ect, qp_quic_transport_config_t, quicpro_quic_transport_config)
+
+    STD_PHP_INI_ENTRY("quicpro.transport_client_pool_enable", "1", PHP_INI_SYSTEM, OnUpdateBool, client_pool_enable, qp_quic_transport_config_t, quicpro_quic_transport_config)
+    ZEND_INI_ENTRY_EX("quicpro.transport_client_pool_max_idle", "4", PHP_INI_SYSTEM, OnUpdateQuicNonNegativeLong, &quicpro_quic_transport_config.client_pool_max_idle, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.transport_client_pool_idle_timeout_ms", "30000", PHP_INI_SYSTEM, OnUpdateQuicPositiveLong, &quicpro_quic_transport_config.client_pool_idle_timeout_ms, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.transport_client_pool_max_streams_per_conn", "100", PHP_INI_SYSTEM, OnUpdateQuicPositiveLong, &quicpro_quic_transport_config.client_pool_max_streams_per_conn, NULL, NULL)
+    STD_PHP_INI_ENTRY("quicpro.transport_client_pool_persistent", "0", PHP_INI_SYSTEM, OnUpdateBool, client_pool_persistent, qp_quic_transport_config_t, quicpro_quic_transport_config)
+    ZEND_INI_ENTRY_EX("quicpro.transport_idle_hibernate_ms", "30000", PHP_INI_SYSTEM, OnUpdateQuicNonNegativeLong, &quicpro_quic_transport_config.idle_hibernate_ms, NULL, NULL)
+
+    ZEND_INI_ENTRY_EX("quicpro.transport_dns_timeout_ms", "5000", PHP_INI_SYSTEM, OnUpdateQuicPositiveLong, &quicpro_quic_transport_config.dns_timeout_ms, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.transport_dns_cache_max_ttl_sec", "300", PHP_INI_SYSTEM, OnUpdateQuicNonNegativeLong, &quicpro_quic_transport_config.dns_cache_max_ttl_sec, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.transport_happy_eyeballs_delay_ms", "250", PHP_INI_SYSTEM, OnUpdateQuicNonNegativeLong, &quicpro_quic_transport_config.happy_eyeballs_delay_ms, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.transport_happy_eyeballs_timeout_ms", "2000", PHP_INI_SYSTEM, OnUpdateQuicNonNegativeLong, &quicpro_quic_transport_config.happy_eyeballs_timeout_ms, NULL, NULL)
+
+    ZEND_INI_ENTRY_EX("quicpro.transport_qlog_sample_ratio", "0.0", PHP_INI_SYSTEM, OnUpdateQlogSampleRatio, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.transport_qlog_ring_events", "65536", PHP_INI_SYSTEM, OnUpdateQuicPositiveLong, &quicpro_quic_transport_config.qlog_ring_events, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.transport_capture_sample_ratio", "0.0", PHP_INI_SYSTEM, OnUpdateCaptureSampleRatio, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.transport_capture_ring_bytes", "16777216", PHP_INI_SYSTEM, OnUpdateQuicNonNegativeLong, &quicpro_quic_transport_config.capture_ring_bytes, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.transport_capture_snaplen", "1500", PHP_INI_SYSTEM, OnUpdateCaptureSnaplen, NULL, NULL, NULL)
 PHP_INI_END()
 
 void qp_config_quic_transport_ini_register(void) { REGISTER_INI_ENTRIES(); }
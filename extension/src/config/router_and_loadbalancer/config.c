@@ -20,6 +20,7 @@
 #include "include/validation/config_param/validate_positive_long.h"
 #include "include/validation/config_param/validate_string_from_allowlist.h"
 #include "include/validation/config_param/validate_generic_string.h"
+#include "include/validation/config_param/validate_long_range.h"
 
 #include "php.h"
 #include <ext/spl/spl_exceptions.h>
@@ -59,6 +60,8 @@ int qp_config_router_and_loadbalancer_apply_userland_config(zval *config_arr)
             if (qp_validate_generic_string(value, &quicpro_router_loadbalancer_config.backend_mcp_endpoint) != SUCCESS) return FAILURE;
         } else if (zend_string_equals_literal(key, "backend_mcp_poll_interval_sec")) {
             if (qp_validate_positive_long(value, &quicpro_router_loadbalancer_config.backend_mcp_poll_interval_sec) != SUCCESS) return FAILURE;
+        } else if (zend_string_equals_literal(key, "server_id")) {
+            if (qp_validate_long_range(value, 0, 65535, &quicpro_router_loadbalancer_config.server_id) != SUCCESS) return FAILURE;
         } else if (zend_string_equals_literal(key, "max_forwarding_pps")) {
             if (qp_validate_positive_long(value, &quicpro_router_loadbalancer_config.max_forwarding_pps) != SUCCESS) return FAILURE;
         }
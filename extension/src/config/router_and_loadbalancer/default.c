@@ -31,6 +31,7 @@ void qp_config_router_and_loadbalancer_defaults_load(void)
     quicpro_router_loadbalancer_config.backend_static_list = pestrdup("127.0.0.1:8443", 1);
     quicpro_router_loadbalancer_config.backend_mcp_endpoint = pestrdup("127.0.0.1:9998", 1);
     quicpro_router_loadbalancer_config.backend_mcp_poll_interval_sec = 10;
+    quicpro_router_loadbalancer_config.server_id = 0;
 
     /* --- Performance & Security --- */
     quicpro_router_loadbalancer_config.max_forwarding_pps = 1000000;
@@ -33,6 +33,17 @@ static ZEND_INI_MH(OnUpdateRouterPositiveLong)
     return SUCCESS;
 }
 
+static ZEND_INI_MH(OnUpdateRouterServerId)
+{
+    zend_long val = zend_atol(ZSTR_VAL(new_value), ZSTR_LEN(new_value));
+    if (val < 0 || val > 65535) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Invalid value for quicpro.router_server_id. An integer between 0 and 65535 is required.");
+        return FAILURE;
+    }
+    quicpro_router_loadbalancer_config.server_id = val;
+    return SUCCESS;
+}
+
 static ZEND_INI_MH(OnUpdateRouterAllowlist)
 {
     const char *hashing_allowed[] = {"consistent_hash", "round_robin", NULL};
@@ -69,6 +80,7 @@ PHP_INI_BEGIN()
     STD_PHP_INI_ENTRY("quicpro.router_backend_static_list", "127.0.0.1:8443", PHP_INI_SYSTEM, OnUpdateString, backend_static_list, qp_router_loadbalancer_config_t, quicpro_router_loadbalancer_config)
     STD_PHP_INI_ENTRY("quicpro.router_backend_mcp_endpoint", "127.0.0.1:9998", PHP_INI_SYSTEM, OnUpdateString, backend_mcp_endpoint, qp_router_loadbalancer_config_t, quicpro_router_loadbalancer_config)
     ZEND_INI_ENTRY_EX("quicpro.router_backend_mcp_poll_interval_sec", "10", PHP_INI_SYSTEM, OnUpdateRouterPositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.router_server_id", "0", PHP_INI_SYSTEM, OnUpdateRouterServerId, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.router_max_forwarding_pps", "1000000", PHP_INI_SYSTEM, OnUpdateRouterPositiveLong, NULL, NULL, NULL)
 PHP_INI_END()
 
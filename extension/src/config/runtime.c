@@ -0,0 +1,208 @@
+/*
+ * src/config/runtime.c – Compiled runtime view of a Quicpro\Config
+ * ================================================================
+ *
+ * See include/config/runtime.h. The option names are matched once per
+ * Config object against a short table; most entries are rejected by
+ * their length alone.
+ */
+
+#include "php_quicpro.h"
+#include "config/runtime.h"
+#include "config/quic_transport/base_layer.h"
+
+#include <zend_exceptions.h>
+#include <zend_weakrefs.h>
+#include <stddef.h>
+#include <string.h>
+
+extern zend_class_entry *quicpro_config_ce;
+
+#if PHP_VERSION_ID < 80300
+/* Weak map keys were the object pointer itself before 8.3 */
+# define zend_object_to_weakref_key(obj) ((zend_ulong)(uintptr_t)(obj))
+# define zend_weakref_key_to_object(key) ((zend_object *)(uintptr_t)(key))
+#endif
+
+typedef enum { QP_RT_STRING, QP_RT_UINT, QP_RT_LONG } qp_rt_kind_t;
+
+typedef struct {
+    const char  *name;
+    size_t       len;
+    qp_rt_kind_t kind;
+    size_t       offset;
+    uint32_t     bit;                   /* QUICPRO_RT_*, 0 for strings (NULL means unset) */
+} qp_rt_option_t;
+
+#define QP_RT_OPT(name, kind, field, bit) { name, sizeof(name) - 1, kind, offsetof(quicpro_runtime_config_t, field), bit }
+
+static const qp_rt_option_t qp_rt_options[] = {
+    QP_RT_OPT("cert_file",                           QP_RT_STRING, cert_file, 0),
+    QP_RT_OPT("key_file",                            QP_RT_STRING, key_file, 0),
+    QP_RT_OPT("ca_file",                             QP_RT_STRING, ca_file, 0),
+    QP_RT_OPT("host",                                QP_RT_STRING, host, 0),
+    QP_RT_OPT("port",                                QP_RT_LONG,   port, QUICPRO_RT_PORT),
+    QP_RT_OPT("application_protos",                  QP_RT_STRING, application_protos, QUICPRO_RT_APPLICATION_PROTOS),
+    QP_RT_OPT("max_idle_timeout",                    QP_RT_UINT,   max_idle_timeout, QUICPRO_RT_MAX_IDLE_TIMEOUT),
+    QP_RT_OPT("max_recv_udp_payload_size",           QP_RT_UINT,   max_recv_udp_payload_size, QUICPRO_RT_MAX_RECV_UDP_PAYLOAD),
+    QP_RT_OPT("max_send_udp_payload_size",           QP_RT_UINT,   max_send_udp_payload_size, QUICPRO_RT_MAX_SEND_UDP_PAYLOAD),
+    QP_RT_OPT("initial_max_data",                    QP_RT_UINT,   initial_max_data, QUICPRO_RT_INITIAL_MAX_DATA),
+    QP_RT_OPT("initial_max_stream_data_bidi_local",  QP_RT_UINT,   initial_max_stream_data_bidi_local, QUICPRO_RT_INITIAL_MAX_STREAM_BIDI_L),
+    QP_RT_OPT("initial_max_stream_data_bidi_remote", QP_RT_UINT,   initial_max_stream_data_bidi_remote, QUICPRO_RT_INITIAL_MAX_STREAM_BIDI_R),
+    QP_RT_OPT("initial_max_stream_data_uni",         QP_RT_UINT,   initial_max_stream_data_uni, QUICPRO_RT_INITIAL_MAX_STREAM_UNI),
+    QP_RT_OPT("initial_max_streams_bidi",            QP_RT_UINT,   initial_max_streams_bidi, QUICPRO_RT_INITIAL_MAX_STREAMS_BIDI),
+    QP_RT_OPT("initial_max_streams_uni",             QP_RT_UINT,   initial_max_streams_uni, QUICPRO_RT_INITIAL_MAX_STREAMS_UNI),
+    QP_RT_OPT("cc_profile",                          QP_RT_STRING, cc_profile, 0),
+};
+
+/* Config object → its compiled view, weakly keyed */
+static HashTable *qp_rt_by_object = NULL;
+
+static void qp_rt_set(quicpro_runtime_config_t *rt, const qp_rt_option_t *o, zval *value)
+{
+    char *field = (char *)rt + o->offset;
+    switch (o->kind) {
+        case QP_RT_STRING:
+            if (Z_TYPE_P(value) == IS_STRING) {
+                char **slot = (char **)field;
+                if (*slot) efree(*slot);
+                *slot = estrndup(Z_STRVAL_P(value), Z_STRLEN_P(value));
+                if (o->bit == QUICPRO_RT_APPLICATION_PROTOS) {
+                    rt->application_protos_len = Z_STRLEN_P(value);
+                }
+                rt->set |= o->bit;
+            }
+            break;
+        case QP_RT_UINT:
+            if (Z_TYPE_P(value) == IS_LONG && Z_LVAL_P(value) >= 0) {
+                *(uint64_t *)field = (uint64_t)Z_LVAL_P(value);
+                rt->set |= o->bit;
+            }
+            break;
+        case QP_RT_LONG:
+            if (Z_TYPE_P(value) == IS_LONG) {
+                *(zend_long *)field = Z_LVAL_P(value);
+                rt->set |= o->bit;
+            }
+            break;
+    }
+}
+
+static bool qp_rt_build_quiche(quicpro_runtime_config_t *rt)
+{
+    quiche_config *q = rt->quic = quiche_config_new(QUICHE_PROTOCOL_VERSION);
+    if (!q) {
+        return false;
+    }
+    uint32_t set = rt->set;
+    if (set & QUICPRO_RT_APPLICATION_PROTOS) quiche_config_set_application_protos(q, (uint8_t *)rt->application_protos, rt->application_protos_len);
+    if (set & QUICPRO_RT_MAX_IDLE_TIMEOUT) quiche_config_set_max_idle_timeout(q, rt->max_idle_timeout);
+    /* Path MTU: php.ini's sizes unless the Config names its own; DPLPMTUD probes up to the send size */
+    quiche_config_set_max_recv_udp_payload_size(q, (set & QUICPRO_RT_MAX_RECV_UDP_PAYLOAD) ? rt->max_recv_udp_payload_size
+                                                   : (uint64_t)quicpro_quic_transport_config.max_recv_udp_payload_size);
+    quiche_config_set_max_send_udp_payload_size(q, (set & QUICPRO_RT_MAX_SEND_UDP_PAYLOAD) ? rt->max_send_udp_payload_size
+                                                   : (uint64_t)quicpro_quic_transport_config.max_send_udp_payload_size);
+    quiche_config_discover_pmtu(q, quicpro_quic_transport_config.pmtud_enable);
+    if (set & QUICPRO_RT_INITIAL_MAX_DATA) quiche_config_set_initial_max_data(q, rt->initial_max_data);
+    if (set & QUICPRO_RT_INITIAL_MAX_STREAM_BIDI_L) quiche_config_set_initial_max_stream_data_bidi_local(q, rt->initial_max_stream_data_bidi_local);
+    if (set & QUICPRO_RT_INITIAL_MAX_STREAM_BIDI_R) quiche_config_set_initial_max_stream_data_bidi_remote(q, rt->initial_max_stream_data_bidi_remote);
+    if (set & QUICPRO_RT_INITIAL_MAX_STREAM_UNI) quiche_config_set_initial_max_stream_data_uni(q, rt->initial_max_stream_data_uni);
+    if (set & QUICPRO_RT_INITIAL_MAX_STREAMS_BIDI) quiche_config_set_initial_max_streams_bidi(q, rt->initial_max_streams_bidi);
+    if (set & QUICPRO_RT_INITIAL_MAX_STREAMS_UNI) quiche_config_set_initial_max_streams_uni(q, rt->initial_max_streams_uni);
+    quicpro_cc_profile_apply(q, &rt->cc);
+    if (rt->cert_file) quiche_config_load_cert_chain_from_pem_file(q, rt->cert_file);
+    if (rt->key_file) quiche_config_load_priv_key_from_pem_file(q, rt->key_file);
+    return true;
+}
+
+static quicpro_runtime_config_t *qp_rt_compile(zval *config_obj)
+{
+    quicpro_runtime_config_t *rt = ecalloc(1, sizeof(*rt));
+    rt->refcount = 1;
+
+    zval *options = zend_read_property(quicpro_config_ce, Z_OBJ_P(config_obj), "options", sizeof("options") - 1, 1, NULL);
+    if (Z_TYPE_P(options) == IS_ARRAY) {
+        zend_string *key;
+        zval *value;
+        ZEND_HASH_FOREACH_STR_KEY_VAL(Z_ARRVAL_P(options), key, value) {
+            if (!key) continue;
+            ZVAL_DEREF(value);
+            for (size_t i = 0; i < sizeof(qp_rt_options) / sizeof(qp_rt_options[0]); i++) {
+                const qp_rt_option_t *o = &qp_rt_options[i];
+                if (ZSTR_LEN(key) == o->len && memcmp(ZSTR_VAL(key), o->name, o->len) == 0) {
+                    qp_rt_set(rt, o, value);
+                    break;
+                }
+            }
+        } ZEND_HASH_FOREACH_END();
+    }
+
+    if (!quicpro_cc_profile_lookup(rt->cc_profile, rt->cc_profile ? strlen(rt->cc_profile) : 0, &rt->cc)) {
+        zend_value_error("Unknown cc_profile \"%s\"", rt->cc_profile);
+        quicpro_runtime_config_release(rt);
+        return NULL;
+    }
+    if (!qp_rt_build_quiche(rt)) {
+        quicpro_runtime_config_release(rt);
+        zend_throw_exception(NULL, "Failed to create quiche config", 0);
+        return NULL;
+    }
+    return rt;
+}
+
+static void qp_rt_cache_dtor(zval *zv)
+{
+    quicpro_runtime_config_release(Z_PTR_P(zv));
+}
+
+quicpro_runtime_config_t *quicpro_runtime_config_of(zval *config_obj)
+{
+    zend_object *obj = Z_OBJ_P(config_obj);
+    if (qp_rt_by_object) {
+        zval *hit = zend_hash_index_find(qp_rt_by_object, zend_object_to_weakref_key(obj));
+        if (hit) {
+            return Z_PTR_P(hit);
+        }
+    } else {
+        ALLOC_HASHTABLE(qp_rt_by_object);
+        zend_hash_init(qp_rt_by_object, 8, NULL, qp_rt_cache_dtor, 0);
+    }
+
+    quicpro_runtime_config_t *rt = qp_rt_compile(config_obj);
+    if (rt) {
+        zval ptr;
+        ZVAL_PTR(&ptr, rt);
+        zend_weakrefs_hash_add(qp_rt_by_object, obj, &ptr);   /* The cache holds the first reference */
+    }
+    return rt;
+}
+
+void quicpro_runtime_config_release(quicpro_runtime_config_t *rt)
+{
+    if (!rt || --rt->refcount > 0) {
+        return;
+    }
+    if (rt->quic) quiche_config_free(rt->quic);
+    if (rt->cert_file) efree(rt->cert_file);
+    if (rt->key_file) efree(rt->key_file);
+    if (rt->ca_file) efree(rt->ca_file);
+    if (rt->host) efree(rt->host);
+    if (rt->application_protos) efree(rt->application_protos);
+    if (rt->cc_profile) efree(rt->cc_profile);
+    efree(rt);
+}
+
+void quicpro_runtime_config_rshutdown(void)
+{
+    if (qp_rt_by_object) {
+        /* Objects still alive keep no cache entry past the request */
+        zend_string *unused;
+        zend_ulong key;
+        ZEND_HASH_FOREACH_KEY(qp_rt_by_object, key, unused) {
+            zend_weakrefs_hash_del(qp_rt_by_object, zend_weakref_key_to_object(key));
+        } ZEND_HASH_FOREACH_END();
+        zend_hash_destroy(qp_rt_by_object);
+        FREE_HASHTABLE(qp_rt_by_object);
+        qp_rt_by_object = NULL;
+    }
+}
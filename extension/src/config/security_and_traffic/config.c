@@ -82,6 +82,20 @@ int qp_config_security_apply_userland_config(zval *config_arr)
             if (qp_validate_non_negative_long(value, &quicpro_security_config.rate_limiter_burst) != SUCCESS) {
                 return FAILURE;
             }
+        } else if (zend_string_equals_literal(key, "overload_shedding_enable")) {
+            if (qp_validate_bool(value) == SUCCESS) {
+                quicpro_security_config.overload_shedding_enable = zend_is_true(value);
+            } else {
+                return FAILURE;
+            }
+        } else if (zend_string_equals_literal(key, "overload_target_ms")) {
+            if (qp_validate_non_negative_long(value, &quicpro_security_config.overload_target_ms) != SUCCESS) {
+                return FAILURE;
+            }
+        } else if (zend_string_equals_literal(key, "overload_interval_ms")) {
+            if (qp_validate_non_negative_long(value, &quicpro_security_config.overload_interval_ms) != SUCCESS) {
+                return FAILURE;
+            }
         } else if (zend_string_equals_literal(key, "security_cors_allowed_origins")) {
             char *new_value_str = NULL;
             if (qp_validate_cors_origin_string(value, &new_value_str) == SUCCESS) {
@@ -42,6 +42,17 @@ void qp_config_security_defaults_load(void)
     quicpro_security_config.rate_limiter_enable = true;
     quicpro_security_config.rate_limiter_requests_per_sec = 100;
     quicpro_security_config.rate_limiter_burst = 50;
+    quicpro_security_config.rate_limiter_table_size = 65536;
+
+    /* Overload Shedding: Off; CoDel's interval, with a target that fits handler latencies. */
+    quicpro_security_config.overload_shedding_enable = false;
+    quicpro_security_config.overload_target_ms = 20;
+    quicpro_security_config.overload_interval_ms = 100;
+
+    /* XDP Pre-Filter: Off until an interface is named. */
+    quicpro_security_config.xdp_filter_interface = pestrdup("", 1);
+    quicpro_security_config.xdp_filter_initials_per_sec = 64;
+    quicpro_security_config.xdp_filter_cid_capacity = 262144;
 
     /* CORS: A permissive default, as it's a browser-enforced security model. */
     /* A more secure default for APIs might be an empty string "". */
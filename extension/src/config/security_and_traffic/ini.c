@@ -74,6 +74,16 @@ static ZEND_INI_MH(OnUpdateRateLimiterValue)
         quicpro_security_config.rate_limiter_requests_per_sec = val;
     } else if (zend_string_equals_literal(entry->name, "quicpro.security_rate_limiter_burst")) {
         quicpro_security_config.rate_limiter_burst = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.security_rate_limiter_table_size")) {
+        quicpro_security_config.rate_limiter_table_size = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.overload_target_ms")) {
+        quicpro_security_config.overload_target_ms = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.overload_interval_ms")) {
+        quicpro_security_config.overload_interval_ms = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.security_xdp_filter_initials_per_sec")) {
+        quicpro_security_config.xdp_filter_initials_per_sec = val;
+    } else if (zend_string_equals_literal(entry->name, "quicpro.security_xdp_filter_cid_capacity")) {
+        quicpro_security_config.xdp_filter_cid_capacity = val;
     }
 
     return SUCCESS;
@@ -171,6 +181,17 @@ PHP_INI_BEGIN()
     STD_PHP_INI_ENTRY("quicpro.security_rate_limiter_enable", "1", PHP_INI_SYSTEM, OnUpdateBool, rate_limiter_enable, qp_security_config_t, quicpro_security_config)
     ZEND_INI_ENTRY_EX("quicpro.security_rate_limiter_requests_per_sec", "100", PHP_INI_SYSTEM, OnUpdateRateLimiterValue, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.security_rate_limiter_burst", "50", PHP_INI_SYSTEM, OnUpdateRateLimiterValue, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.security_rate_limiter_table_size", "65536", PHP_INI_SYSTEM, OnUpdateRateLimiterValue, NULL, NULL, NULL)
+
+    /* --- Overload Shedding (per worker) --- */
+    STD_PHP_INI_ENTRY("quicpro.overload_shedding_enable", "0", PHP_INI_SYSTEM, OnUpdateBool, overload_shedding_enable, qp_security_config_t, quicpro_security_config)
+    ZEND_INI_ENTRY_EX("quicpro.overload_target_ms", "20", PHP_INI_SYSTEM, OnUpdateRateLimiterValue, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.overload_interval_ms", "100", PHP_INI_SYSTEM, OnUpdateRateLimiterValue, NULL, NULL, NULL)
+
+    /* --- XDP Pre-Filter (process-wide, attached before any worker forks) --- */
+    STD_PHP_INI_ENTRY("quicpro.security_xdp_filter_interface", "", PHP_INI_SYSTEM, OnUpdateString, xdp_filter_interface, qp_security_config_t, quicpro_security_config)
+    ZEND_INI_ENTRY_EX("quicpro.security_xdp_filter_initials_per_sec", "64", PHP_INI_SYSTEM, OnUpdateRateLimiterValue, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.security_xdp_filter_cid_capacity", "262144", PHP_INI_SYSTEM, OnUpdateRateLimiterValue, NULL, NULL, NULL)
 
     /* --- CORS (Uses a custom, robust validation handler) --- */
     ZEND_INI_ENTRY_EX("quicpro.security_cors_allowed_origins", "*", PHP_INI_SYSTEM, OnUpdateCorsOrigins, NULL, NULL, NULL)
@@ -8,7 +8,7 @@
  *
  * PURPOSE:
  *   Provides the single, authoritative definition and memory allocation for
- *   the `quicpro_ssh_quic_config` global configuration structure that backs
+ *   the `quicpro_ssh_over_quic_config` global configuration structure that backs
  *   the SSH‑over‑QUIC gateway module.
  * =========================================================================
  */
@@ -18,4 +18,4 @@
 /*
  * Global, runtime instance of the configuration struct.
  */
-qp_ssh_quic_config_t quicpro_ssh_quic_config;
+qp_ssh_over_quic_config_t quicpro_ssh_over_quic_config;
@@ -51,17 +51,17 @@ int qp_config_ssh_over_quic_apply_userland_config(zval *config_arr)
         /* Boolean switches */
         if (zend_string_equals_literal(key, "ssh_gateway_enable")) {
             if (qp_validate_bool(value) == SUCCESS) {
-                quicpro_ssh_quic_config.gateway_enable = zend_is_true(value);
+                quicpro_ssh_over_quic_config.gateway_enable = zend_is_true(value);
             } else { return FAILURE; }
         } else if (zend_string_equals_literal(key, "ssh_gateway_log_session_activity")) {
             if (qp_validate_bool(value) == SUCCESS) {
-                quicpro_ssh_quic_config.log_session_activity = zend_is_true(value);
+                quicpro_ssh_over_quic_config.gateway_log_session_activity = zend_is_true(value);
             } else { return FAILURE; }
 
         /* Free strings */
         } else if (zend_string_equals_literal(key, "ssh_gateway_listen_host")) {
             if (Z_TYPE_P(value) == IS_STRING) {
-                quicpro_ssh_quic_config.listen_host = estrdup(Z_STRVAL_P(value));
+                quicpro_ssh_over_quic_config.gateway_listen_host = estrdup(Z_STRVAL_P(value));
             } else {
                 zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
                     "ssh_gateway_listen_host must be a string.");
@@ -69,7 +69,7 @@ int qp_config_ssh_over_quic_apply_userland_config(zval *config_arr)
             }
         } else if (zend_string_equals_literal(key, "ssh_gateway_default_target_host")) {
             if (Z_TYPE_P(value) == IS_STRING) {
-                quicpro_ssh_quic_config.default_target_host = estrdup(Z_STRVAL_P(value));
+                quicpro_ssh_over_quic_config.gateway_default_target_host = estrdup(Z_STRVAL_P(value));
             } else {
                 zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
                     "ssh_gateway_default_target_host must be a string.");
@@ -77,7 +77,7 @@ int qp_config_ssh_over_quic_apply_userland_config(zval *config_arr)
             }
         } else if (zend_string_equals_literal(key, "ssh_gateway_mcp_auth_agent_uri")) {
             if (Z_TYPE_P(value) == IS_STRING) {
-                quicpro_ssh_quic_config.mcp_auth_agent_uri = estrdup(Z_STRVAL_P(value));
+                quicpro_ssh_over_quic_config.gateway_mcp_auth_agent_uri = estrdup(Z_STRVAL_P(value));
             } else {
                 zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
                     "ssh_gateway_mcp_auth_agent_uri must be a string.");
@@ -85,7 +85,7 @@ int qp_config_ssh_over_quic_apply_userland_config(zval *config_arr)
             }
         } else if (zend_string_equals_literal(key, "ssh_gateway_user_profile_agent_uri")) {
             if (Z_TYPE_P(value) == IS_STRING) {
-                quicpro_ssh_quic_config.user_profile_agent_uri = estrdup(Z_STRVAL_P(value));
+                quicpro_ssh_over_quic_config.gateway_user_profile_agent_uri = estrdup(Z_STRVAL_P(value));
             } else {
                 zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
                     "ssh_gateway_user_profile_agent_uri must be a string.");
@@ -94,31 +94,31 @@ int qp_config_ssh_over_quic_apply_userland_config(zval *config_arr)
 
         /* Positive longs */
         } else if (zend_string_equals_literal(key, "ssh_gateway_listen_port")) {
-            if (qp_validate_positive_long(value, &quicpro_ssh_quic_config.listen_port) != SUCCESS) {
+            if (qp_validate_positive_long(value, &quicpro_ssh_over_quic_config.gateway_listen_port) != SUCCESS) {
                 return FAILURE;
             }
         } else if (zend_string_equals_literal(key, "ssh_gateway_default_target_port")) {
-            if (qp_validate_positive_long(value, &quicpro_ssh_quic_config.default_target_port) != SUCCESS) {
+            if (qp_validate_positive_long(value, &quicpro_ssh_over_quic_config.gateway_default_target_port) != SUCCESS) {
                 return FAILURE;
             }
         } else if (zend_string_equals_literal(key, "ssh_gateway_target_connect_timeout_ms")) {
-            if (qp_validate_positive_long(value, &quicpro_ssh_quic_config.target_connect_timeout_ms) != SUCCESS) {
+            if (qp_validate_positive_long(value, &quicpro_ssh_over_quic_config.gateway_target_connect_timeout_ms) != SUCCESS) {
                 return FAILURE;
             }
         } else if (zend_string_equals_literal(key, "ssh_gateway_idle_timeout_sec")) {
-            if (qp_validate_positive_long(value, &quicpro_ssh_quic_config.idle_timeout_sec) != SUCCESS) {
+            if (qp_validate_positive_long(value, &quicpro_ssh_over_quic_config.gateway_idle_timeout_sec) != SUCCESS) {
                 return FAILURE;
             }
 
         /* Allow‑listed strings */
         } else if (zend_string_equals_literal(key, "ssh_gateway_auth_mode")) {
             const char *allowed[] = {"mtls", "mcp_token", NULL};
-            if (qp_validate_string_from_allowlist(value, allowed, &quicpro_ssh_quic_config.auth_mode) != SUCCESS) {
+            if (qp_validate_string_from_allowlist(value, allowed, &quicpro_ssh_over_quic_config.gateway_auth_mode) != SUCCESS) {
                 return FAILURE;
             }
         } else if (zend_string_equals_literal(key, "ssh_gateway_target_mapping_mode")) {
             const char *allowed[] = {"static", "user_profile", NULL};
-            if (qp_validate_string_from_allowlist(value, allowed, &quicpro_ssh_quic_config.target_mapping_mode) != SUCCESS) {
+            if (qp_validate_string_from_allowlist(value, allowed, &quicpro_ssh_over_quic_config.gateway_target_mapping_mode) != SUCCESS) {
                 return FAILURE;
             }
         }
@@ -8,7 +8,7 @@
  *
  * PURPOSE:
  *   Provides the single, authoritative definition and memory allocation for
- *   the `quicpro_state_mgmt_config` global variable used by the State-
+ *   the `quicpro_state_management_config` global variable used by the State-
  *   Management configuration module.
  * =========================================================================
  */
@@ -20,4 +20,4 @@
  * configuration structure.  It is intentionally kept in a dedicated TU so
  * that it is linked exactly once across the entire extension.
  */
-qp_state_mgmt_config_t quicpro_state_mgmt_config = {0};
+qp_state_management_config_t quicpro_state_management_config = {0};
@@ -20,6 +20,7 @@
 #include "include/validation/config_param/validate_string_from_allowlist.h"
 #include "include/validation/config_param/validate_string.h"
 #include "include/validation/config_param/validate_bool.h"
+#include "include/validation/config_param/validate_positive_long.h"
 
 #include "php.h"
 #include <ext/spl/spl_exceptions.h>
@@ -49,13 +50,21 @@ int qp_config_state_management_apply_userland_config(zval *config_arr)
             continue;
         }
         if (zend_string_equals_literal(key, "state_manager_default_backend")) {
-            const char *allowed[] = {"memory", "sqlite", "redis", "postgres", NULL};
+            const char *allowed[] = {"memory", "sqlite", "redis", "postgres", "mcp", NULL};
             if (qp_validate_string_from_allowlist(value, allowed,
-                    &quicpro_state_mgmt_config.default_backend) != SUCCESS) {
+                    &quicpro_state_management_config.default_backend) != SUCCESS) {
                 return FAILURE;
             }
         } else if (zend_string_equals_literal(key, "state_manager_default_uri")) {
-            if (qp_validate_string(value, &quicpro_state_mgmt_config.default_uri) != SUCCESS) {
+            if (qp_validate_string(value, &quicpro_state_management_config.default_uri) != SUCCESS) {
+                return FAILURE;
+            }
+        } else if (zend_string_equals_literal(key, "state_manager_request_timeout_ms")) {
+            if (qp_validate_positive_long(value, &quicpro_state_management_config.request_timeout_ms) != SUCCESS) {
+                return FAILURE;
+            }
+        } else if (zend_string_equals_literal(key, "state_manager_local_cache_ttl_ms")) {
+            if (qp_validate_positive_long(value, &quicpro_state_management_config.local_cache_ttl_ms) != SUCCESS) {
                 return FAILURE;
             }
         }
@@ -20,6 +20,13 @@
 
 void qp_config_state_management_defaults_load(void)
 {
-    quicpro_state_mgmt_config.default_backend = pestrdup("memory", 1);
-    quicpro_state_mgmt_config.default_uri     = pestrdup("",       1);
+    quicpro_state_management_config.default_backend = pestrdup("memory", 1);
+    quicpro_state_management_config.default_uri     = pestrdup("",       1);
+    quicpro_state_management_config.request_timeout_ms = 2000;
+
+    /* Values read from a remote backend are kept for every worker of the host */
+    quicpro_state_management_config.local_cache_enable       = true;
+    quicpro_state_management_config.local_cache_entries      = 8192;
+    quicpro_state_management_config.local_cache_entry_max_kb = 4;
+    quicpro_state_management_config.local_cache_ttl_ms       = 5000;
 }
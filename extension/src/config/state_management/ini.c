@@ -22,19 +22,37 @@
 /* Allow‑list validation for backends */
 static ZEND_INI_MH(OnUpdateStateMgmtBackend)
 {
-    const char *allowed[] = {"memory", "sqlite", "redis", "postgres", NULL};
+    const char *allowed[] = {"memory", "sqlite", "redis", "postgres", "mcp", NULL};
     int i;
     for (i = 0; allowed[i]; ++i) {
         if (zend_string_equals_literal(new_value, allowed[i])) {
-            quicpro_state_mgmt_config.default_backend = estrdup(ZSTR_VAL(new_value));
+            quicpro_state_management_config.default_backend = estrdup(ZSTR_VAL(new_value));
             return SUCCESS;
         }
     }
     zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
-        "Invalid state_manager_default_backend. Allowed values: memory, sqlite, redis, postgres");
+        "Invalid state_manager_default_backend. Allowed values: memory, sqlite, redis, postgres, mcp");
     return FAILURE;
 }
 
+/* Positive long validation */
+static ZEND_INI_MH(OnUpdateStateMgmtPositiveLong)
+{
+    zend_long val = zend_atol(ZSTR_VAL(new_value), ZSTR_LEN(new_value));
+
+    if (val <= 0) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Invalid value for state manager directive. A positive integer is required.");
+        return FAILURE;
+    }
+
+    if      (zend_string_equals_literal(entry->name, "quicpro.state_manager_request_timeout_ms"))       quicpro_state_management_config.request_timeout_ms       = val;
+    else if (zend_string_equals_literal(entry->name, "quicpro.state_manager_local_cache_entries"))      quicpro_state_management_config.local_cache_entries      = val;
+    else if (zend_string_equals_literal(entry->name, "quicpro.state_manager_local_cache_entry_max_kb")) quicpro_state_management_config.local_cache_entry_max_kb = val;
+    else if (zend_string_equals_literal(entry->name, "quicpro.state_manager_local_cache_ttl_ms"))       quicpro_state_management_config.local_cache_ttl_ms       = val;
+    return SUCCESS;
+}
+
 /* Generic string copy */
 static ZEND_INI_MH(OnUpdateStateMgmtString)
 {
@@ -47,7 +65,19 @@ PHP_INI_BEGIN()
         PHP_INI_SYSTEM, OnUpdateStateMgmtBackend, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.state_manager_default_uri", "",
         PHP_INI_SYSTEM, OnUpdateStateMgmtString,
-        &quicpro_state_mgmt_config.default_uri, NULL, NULL)
+        &quicpro_state_management_config.default_uri, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.state_manager_request_timeout_ms", "2000",
+        PHP_INI_SYSTEM, OnUpdateStateMgmtPositiveLong, NULL, NULL, NULL)
+
+    /* Local read-through cache */
+    STD_PHP_INI_ENTRY("quicpro.state_manager_local_cache_enable", "1", PHP_INI_SYSTEM,
+        OnUpdateBool, local_cache_enable, qp_state_management_config_t, quicpro_state_management_config)
+    ZEND_INI_ENTRY_EX("quicpro.state_manager_local_cache_entries", "8192",
+        PHP_INI_SYSTEM, OnUpdateStateMgmtPositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.state_manager_local_cache_entry_max_kb", "4",
+        PHP_INI_SYSTEM, OnUpdateStateMgmtPositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.state_manager_local_cache_ttl_ms", "5000",
+        PHP_INI_SYSTEM, OnUpdateStateMgmtPositiveLong, NULL, NULL, NULL)
 PHP_INI_END()
 
 void qp_config_state_management_ini_register(void)
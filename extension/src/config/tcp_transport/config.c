@@ -21,7 +21,9 @@
 /* centralised param validators */
 #include "include/validation/config_param/validate_bool.h"
 #include "include/validation/config_param/validate_positive_long.h"
+#include "include/validation/config_param/validate_non_negative_long.h"
 #include "include/validation/config_param/validate_string_from_allowlist.h"
+#include "include/validation/config_param/validate_string.h"
 
 #include "php.h"
 #include <ext/spl/spl_exceptions.h>
@@ -100,6 +102,37 @@ int qp_config_tcp_transport_apply_userland_config(zval *config_arr)
             if (qp_validate_positive_long(value, &quicpro_tcp_transport_config.tcp_keepalive_probes)
                     != SUCCESS) return FAILURE;
 
+        } else if (zend_string_equals_literal(key, "tcp_http1_max_request_bytes")) {
+            if (qp_validate_positive_long(value, &quicpro_tcp_transport_config.tcp_http1_max_request_bytes)
+                    != SUCCESS) return FAILURE;
+
+        } else if (zend_string_equals_literal(key, "tcp_http1_max_keepalive_requests")) {
+            if (qp_validate_positive_long(value, &quicpro_tcp_transport_config.tcp_http1_max_keepalive_requests)
+                    != SUCCESS) return FAILURE;
+
+        } else if (zend_string_equals_literal(key, "tcp_body_spool_max_bytes")) {
+            if (qp_validate_positive_long(value, &quicpro_tcp_transport_config.tcp_body_spool_max_bytes)
+                    != SUCCESS) return FAILURE;
+
+        /* Non-negative longs, zero disables */
+        } else if (zend_string_equals_literal(key, "tcp_fastopen_queue_len")) {
+            if (qp_validate_non_negative_long(value, &quicpro_tcp_transport_config.tcp_fastopen_queue_len)
+                    != SUCCESS) return FAILURE;
+
+        } else if (zend_string_equals_literal(key, "tcp_defer_accept_sec")) {
+            if (qp_validate_non_negative_long(value, &quicpro_tcp_transport_config.tcp_defer_accept_sec)
+                    != SUCCESS) return FAILURE;
+
+        } else if (zend_string_equals_literal(key, "tcp_body_spool_threshold_bytes")) {
+            if (qp_validate_non_negative_long(value, &quicpro_tcp_transport_config.tcp_body_spool_threshold_bytes)
+                    != SUCCESS) return FAILURE;
+
+        /* Free-form strings */
+        } else if (zend_string_equals_literal(key, "tcp_body_spool_dir")) {
+            if (qp_validate_string(value, &quicpro_tcp_transport_config.tcp_body_spool_dir) != SUCCESS) {
+                return FAILURE;
+            }
+
         /* Allowed string lists */
         } else if (zend_string_equals_literal(key, "tcp_tls_min_version_allowed")) {
             const char *allowed[] = {"TLSv1.2", "TLSv1.3", NULL};
@@ -27,6 +27,10 @@ void qp_config_tcp_transport_defaults_load(void)
 
     /* --- Socket options --- */
     quicpro_tcp_transport_config.tcp_reuse_port_enable       = true;
+
+    /* --- Accept path --- */
+    quicpro_tcp_transport_config.tcp_fastopen_queue_len      = 256;
+    quicpro_tcp_transport_config.tcp_defer_accept_sec        = 5;
     quicpro_tcp_transport_config.tcp_nodelay_enable          = false;
     quicpro_tcp_transport_config.tcp_cork_enable             = false;
 
@@ -36,6 +40,15 @@ void qp_config_tcp_transport_defaults_load(void)
     quicpro_tcp_transport_config.tcp_keepalive_interval_sec  = 75;
     quicpro_tcp_transport_config.tcp_keepalive_probes        = 9;
 
+    /* --- HTTP/1.1 listener --- */
+    quicpro_tcp_transport_config.tcp_http1_max_request_bytes      = 1048576;
+    quicpro_tcp_transport_config.tcp_http1_max_keepalive_requests = 1000;
+
+    /* --- Request body spooling --- */
+    quicpro_tcp_transport_config.tcp_body_spool_threshold_bytes = 262144;
+    quicpro_tcp_transport_config.tcp_body_spool_max_bytes       = 1073741824;
+    quicpro_tcp_transport_config.tcp_body_spool_dir             = pestrdup("", 1);
+
     /* --- TLS over TCP --- */
     quicpro_tcp_transport_config.tcp_tls_min_version_allowed = pestrdup("TLSv1.2", 1);
     quicpro_tcp_transport_config.tcp_tls_ciphers_tls12       = pestrdup("ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:ECDHE-ECDSA-AES256-GCM-SHA384", 1);
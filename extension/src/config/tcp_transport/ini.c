@@ -35,6 +35,26 @@ static ZEND_INI_MH(OnUpdateTcpPositiveLong)
     else if (zend_string_equals_literal(entry->name, "quicpro.tcp_keepalive_time_sec"))        quicpro_tcp_transport_config.tcp_keepalive_time_sec     = val;
     else if (zend_string_equals_literal(entry->name, "quicpro.tcp_keepalive_interval_sec"))    quicpro_tcp_transport_config.tcp_keepalive_interval_sec = val;
     else if (zend_string_equals_literal(entry->name, "quicpro.tcp_keepalive_probes"))          quicpro_tcp_transport_config.tcp_keepalive_probes       = val;
+    else if (zend_string_equals_literal(entry->name, "quicpro.tcp_http1_max_request_bytes"))      quicpro_tcp_transport_config.tcp_http1_max_request_bytes      = val;
+    else if (zend_string_equals_literal(entry->name, "quicpro.tcp_http1_max_keepalive_requests")) quicpro_tcp_transport_config.tcp_http1_max_keepalive_requests = val;
+    else if (zend_string_equals_literal(entry->name, "quicpro.tcp_body_spool_max_bytes"))         quicpro_tcp_transport_config.tcp_body_spool_max_bytes         = val;
+
+    return SUCCESS;
+}
+
+/* zero switches these directives off */
+static ZEND_INI_MH(OnUpdateTcpNonNegativeLong)
+{
+    zend_long val = zend_atol(ZSTR_VAL(new_value), ZSTR_LEN(new_value));
+    if (val < 0) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "A non-negative integer value is required for this directive.");
+        return FAILURE;
+    }
+
+    if      (zend_string_equals_literal(entry->name, "quicpro.tcp_fastopen_queue_len")) quicpro_tcp_transport_config.tcp_fastopen_queue_len = val;
+    else if (zend_string_equals_literal(entry->name, "quicpro.tcp_defer_accept_sec"))   quicpro_tcp_transport_config.tcp_defer_accept_sec   = val;
+    else if (zend_string_equals_literal(entry->name, "quicpro.tcp_body_spool_threshold_bytes")) quicpro_tcp_transport_config.tcp_body_spool_threshold_bytes = val;
 
     return SUCCESS;
 }
@@ -70,6 +90,8 @@ PHP_INI_BEGIN()
     /* Socket options */
     STD_PHP_INI_ENTRY("quicpro.tcp_reuse_port_enable", "1", PHP_INI_SYSTEM, OnUpdateBool,
         tcp_reuse_port_enable, qp_tcp_transport_config_t, quicpro_tcp_transport_config)
+    ZEND_INI_ENTRY_EX("quicpro.tcp_fastopen_queue_len", "256", PHP_INI_SYSTEM, OnUpdateTcpNonNegativeLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.tcp_defer_accept_sec", "5", PHP_INI_SYSTEM, OnUpdateTcpNonNegativeLong, NULL, NULL, NULL)
     STD_PHP_INI_ENTRY("quicpro.tcp_nodelay_enable", "0", PHP_INI_SYSTEM, OnUpdateBool,
         tcp_nodelay_enable, qp_tcp_transport_config_t, quicpro_tcp_transport_config)
     STD_PHP_INI_ENTRY("quicpro.tcp_cork_enable", "0", PHP_INI_SYSTEM, OnUpdateBool,
@@ -82,6 +104,15 @@ PHP_INI_BEGIN()
     ZEND_INI_ENTRY_EX("quicpro.tcp_keepalive_interval_sec", "75", PHP_INI_SYSTEM, OnUpdateTcpPositiveLong, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.tcp_keepalive_probes", "9", PHP_INI_SYSTEM, OnUpdateTcpPositiveLong, NULL, NULL, NULL)
 
+    /* HTTP/1.1 listener */
+    ZEND_INI_ENTRY_EX("quicpro.tcp_http1_max_request_bytes", "1048576", PHP_INI_SYSTEM, OnUpdateTcpPositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.tcp_http1_max_keepalive_requests", "1000", PHP_INI_SYSTEM, OnUpdateTcpPositiveLong, NULL, NULL, NULL)
+
+    /* Request body spooling */
+    ZEND_INI_ENTRY_EX("quicpro.tcp_body_spool_threshold_bytes", "262144", PHP_INI_SYSTEM, OnUpdateTcpNonNegativeLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.tcp_body_spool_max_bytes", "1073741824", PHP_INI_SYSTEM, OnUpdateTcpPositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.tcp_body_spool_dir", "", PHP_INI_SYSTEM, OnUpdateString, &quicpro_tcp_transport_config.tcp_body_spool_dir, NULL, NULL)
+
     /* TLS over TCP */
     ZEND_INI_ENTRY_EX("quicpro.tcp_tls_min_version_allowed", "TLSv1.2", PHP_INI_SYSTEM, OnUpdateTlsMinVersion, NULL, NULL, NULL)
     ZEND_INI_ENTRY_EX("quicpro.tcp_tls_ciphers_tls12", "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:ECDHE-ECDSA-AES256-GCM-SHA384", PHP_INI_SYSTEM, OnUpdateString, &quicpro_tcp_transport_config.tcp_tls_ciphers_tls12, NULL, NULL)
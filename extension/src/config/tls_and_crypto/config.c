@@ -20,6 +20,7 @@
 #include "include/validation/config_param/validate_bool.h"
 #include "include/validation/config_param/validate_positive_long.h"
 #include "include/validation/config_param/validate_string.h"
+#include "include/validation/config_param/validate_string_from_allowlist.h"
 
 #include "php.h"
 #include <ext/spl/spl_exceptions.h>
@@ -53,11 +54,41 @@ int qp_config_tls_crypto_apply_userland_config(zval *arr)
                 quicpro_tls_crypto_config.tls_enable_early_data = zend_is_true(val);
             else return FAILURE;
 
+        } else if (zend_string_equals_literal(key, "tls_server_0rtt_early_dispatch")) {
+            if (qp_validate_bool(val, "tls_server_0rtt_early_dispatch") == SUCCESS)
+                quicpro_tls_crypto_config.tls_server_0rtt_early_dispatch = zend_is_true(val);
+            else return FAILURE;
+
+        } else if (zend_string_equals_literal(key, "tls_client_session_cache_enable")) {
+            if (qp_validate_bool(val, "tls_client_session_cache_enable") == SUCCESS)
+                quicpro_tls_crypto_config.tls_client_session_cache_enable = zend_is_true(val);
+            else return FAILURE;
+
+        } else if (zend_string_equals_literal(key, "tls_client_enable_early_data")) {
+            if (qp_validate_bool(val, "tls_client_enable_early_data") == SUCCESS)
+                quicpro_tls_crypto_config.tls_client_enable_early_data = zend_is_true(val);
+            else return FAILURE;
+
         } else if (zend_string_equals_literal(key, "tls_enable_ocsp_stapling")) {
             if (qp_validate_bool(val, "tls_enable_ocsp_stapling") == SUCCESS)
                 quicpro_tls_crypto_config.tls_enable_ocsp_stapling = zend_is_true(val);
             else return FAILURE;
 
+        } else if (zend_string_equals_literal(key, "tls_cert_reload_enable")) {
+            if (qp_validate_bool(val, "tls_cert_reload_enable") == SUCCESS)
+                quicpro_tls_crypto_config.tls_cert_reload_enable = zend_is_true(val);
+            else return FAILURE;
+
+        } else if (zend_string_equals_literal(key, "storage_encryption_at_rest_enable")) {
+            if (qp_validate_bool(val, "storage_encryption_at_rest_enable") == SUCCESS)
+                quicpro_tls_crypto_config.storage_encryption_at_rest_enable = zend_is_true(val);
+            else return FAILURE;
+
+        } else if (zend_string_equals_literal(key, "tls_tcp_enable_ktls")) {
+            if (qp_validate_bool(val, "tls_tcp_enable_ktls") == SUCCESS)
+                quicpro_tls_crypto_config.tls_tcp_enable_ktls = zend_is_true(val);
+            else return FAILURE;
+
         } else if (zend_string_equals_literal(key, "tls_enable_ech")) {
             if (qp_validate_bool(val, "tls_enable_ech") == SUCCESS)
                 quicpro_tls_crypto_config.tls_enable_ech = zend_is_true(val);
@@ -91,6 +122,33 @@ int qp_config_tls_crypto_apply_userland_config(zval *arr)
             if (qp_validate_positive_long(val, &quicpro_tls_crypto_config.tls_server_0rtt_cache_size) != SUCCESS)
                 return FAILURE;
 
+        } else if (zend_string_equals_literal(key, "tls_server_0rtt_replay_window_sec")) {
+            if (qp_validate_positive_long(val, &quicpro_tls_crypto_config.tls_server_0rtt_replay_window_sec) != SUCCESS)
+                return FAILURE;
+
+        } else if (zend_string_equals_literal(key, "tls_server_0rtt_anti_replay")) {
+            const char *allowed[] = {"single_use", "bloom", NULL};
+            if (qp_validate_string_from_allowlist(val, allowed, &quicpro_tls_crypto_config.tls_server_0rtt_anti_replay) != SUCCESS)
+                return FAILURE;
+
+        } else if (zend_string_equals_literal(key, "tls_tcp_handshake_threads")) {
+            if (qp_validate_positive_long(val, &quicpro_tls_crypto_config.tls_tcp_handshake_threads) != SUCCESS)
+                return FAILURE;
+
+        } else if (zend_string_equals_literal(key, "tls_cert_store_hot_size")) {
+            if (qp_validate_positive_long(val, &quicpro_tls_crypto_config.tls_cert_store_hot_size) != SUCCESS)
+                return FAILURE;
+
+        } else if (zend_string_equals_literal(key, "tls_tcp_handshake_offload")) {
+            const char *allowed[] = {"inline", "async", "threads", NULL};
+            if (qp_validate_string_from_allowlist(val, allowed, &quicpro_tls_crypto_config.tls_tcp_handshake_offload) != SUCCESS)
+                return FAILURE;
+
+        } else if (zend_string_equals_literal(key, "storage_encryption_algorithm")) {
+            const char *allowed[] = {"aes-256-gcm", "chacha20-poly1305", NULL};
+            if (qp_validate_string_from_allowlist(val, allowed, &quicpro_tls_crypto_config.storage_encryption_algorithm) != SUCCESS)
+                return FAILURE;
+
         /* --- Strings / paths / cipher lists --- */
         } else if (zend_string_equals_literal(key, "tls_default_ca_file")) {
             if (qp_validate_string(val, &quicpro_tls_crypto_config.tls_default_ca_file) != SUCCESS)
@@ -104,6 +162,14 @@ int qp_config_tls_crypto_apply_userland_config(zval *arr)
             if (qp_validate_string(val, &quicpro_tls_crypto_config.tls_default_key_file) != SUCCESS)
                 return FAILURE;
 
+        } else if (zend_string_equals_literal(key, "tls_cert_store_dir")) {
+            if (qp_validate_string(val, &quicpro_tls_crypto_config.tls_cert_store_dir) != SUCCESS)
+                return FAILURE;
+
+        } else if (zend_string_equals_literal(key, "storage_encryption_key_path")) {
+            if (qp_validate_string(val, &quicpro_tls_crypto_config.storage_encryption_key_path) != SUCCESS)
+                return FAILURE;
+
         } else if (zend_string_equals_literal(key, "tls_ticket_key_file")) {
             if (qp_validate_string(val, &quicpro_tls_crypto_config.tls_ticket_key_file) != SUCCESS)
                 return FAILURE;
@@ -30,7 +30,25 @@ void qp_config_tls_crypto_defaults_load(void)
     quicpro_tls_crypto_config.tls_session_ticket_lifetime_sec   = 7200;
     quicpro_tls_crypto_config.tls_enable_early_data             = false;
     quicpro_tls_crypto_config.tls_server_0rtt_cache_size        = 100000;
+    quicpro_tls_crypto_config.tls_server_0rtt_anti_replay       = pestrdup("single_use", 1);
+    quicpro_tls_crypto_config.tls_server_0rtt_replay_window_sec = 10;
+    quicpro_tls_crypto_config.tls_server_0rtt_early_dispatch    = false;
+    quicpro_tls_crypto_config.tls_client_session_cache_enable   = true;
+    quicpro_tls_crypto_config.tls_client_session_cache_shared   = false;
+    quicpro_tls_crypto_config.tls_client_session_cache_size     = 1024;
+    quicpro_tls_crypto_config.tls_client_enable_early_data      = true;
     quicpro_tls_crypto_config.tls_enable_ocsp_stapling          = true;
+    quicpro_tls_crypto_config.tls_tcp_handshake_offload         = pestrdup("inline", 1);
+    quicpro_tls_crypto_config.tls_tcp_handshake_threads         = 4;
+    quicpro_tls_crypto_config.tls_tcp_enable_ktls               = false;
+    quicpro_tls_crypto_config.tls_cert_store_dir                = pestrdup("", 1);
+    quicpro_tls_crypto_config.tls_cert_store_hot_size           = 1024;
+    quicpro_tls_crypto_config.tls_cert_reload_enable            = true;
+
+    /* Storage encryption – needs a key file, so off until one is named */
+    quicpro_tls_crypto_config.storage_encryption_at_rest_enable = false;
+    quicpro_tls_crypto_config.storage_encryption_algorithm      = pestrdup("aes-256-gcm", 1);
+    quicpro_tls_crypto_config.storage_encryption_key_path       = pestrdup("", 1);
 
     /* Expert / potentially insecure options – keep disabled */
     quicpro_tls_crypto_config.tls_enable_ech                    = false;
@@ -35,6 +35,44 @@ static ZEND_INI_MH(OnUpdatePositiveLong)
     if      (zend_string_equals_literal(entry->name, "quicpro.tls_verify_depth"))                  quicpro_tls_crypto_config.tls_verify_depth = v;
     else if (zend_string_equals_literal(entry->name, "quicpro.tls_session_ticket_lifetime_sec"))   quicpro_tls_crypto_config.tls_session_ticket_lifetime_sec = v;
     else if (zend_string_equals_literal(entry->name, "quicpro.tls_server_0rtt_cache_size"))        quicpro_tls_crypto_config.tls_server_0rtt_cache_size = v;
+    else if (zend_string_equals_literal(entry->name, "quicpro.tls_server_0rtt_replay_window_sec")) quicpro_tls_crypto_config.tls_server_0rtt_replay_window_sec = v;
+    else if (zend_string_equals_literal(entry->name, "quicpro.tls_tcp_handshake_threads"))         quicpro_tls_crypto_config.tls_tcp_handshake_threads = v;
+    else if (zend_string_equals_literal(entry->name, "quicpro.tls_client_session_cache_size"))     quicpro_tls_crypto_config.tls_client_session_cache_size = v;
+    else if (zend_string_equals_literal(entry->name, "quicpro.tls_cert_store_hot_size"))           quicpro_tls_crypto_config.tls_cert_store_hot_size = v;
+    return SUCCESS;
+}
+
+static ZEND_INI_MH(OnUpdateAntiReplay)
+{
+    if (strcasecmp(ZSTR_VAL(new_value), "single_use") != 0 && strcasecmp(ZSTR_VAL(new_value), "bloom") != 0) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Invalid 0-RTT anti-replay strategy. Must be 'single_use' or 'bloom'.");
+        return FAILURE;
+    }
+    OnUpdateString(entry, new_value, mh_arg1, mh_arg2, mh_arg3);
+    return SUCCESS;
+}
+
+static ZEND_INI_MH(OnUpdateHandshakeOffload)
+{
+    if (strcasecmp(ZSTR_VAL(new_value), "inline") != 0 && strcasecmp(ZSTR_VAL(new_value), "async") != 0
+        && strcasecmp(ZSTR_VAL(new_value), "threads") != 0) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Invalid TLS handshake offload mode. Must be 'inline', 'async' or 'threads'.");
+        return FAILURE;
+    }
+    OnUpdateString(entry, new_value, mh_arg1, mh_arg2, mh_arg3);
+    return SUCCESS;
+}
+
+static ZEND_INI_MH(OnUpdateStorageAlgorithm)
+{
+    if (strcasecmp(ZSTR_VAL(new_value), "aes-256-gcm") != 0 && strcasecmp(ZSTR_VAL(new_value), "chacha20-poly1305") != 0) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Invalid storage encryption algorithm. Must be 'aes-256-gcm' or 'chacha20-poly1305'.");
+        return FAILURE;
+    }
+    OnUpdateString(entry, new_value, mh_arg1, mh_arg2, mh_arg3);
     return SUCCESS;
 }
 
@@ -57,8 +95,33 @@ PHP_INI_BEGIN()
     STD_PHP_INI_ENTRY("quicpro.tls_enable_early_data", "0", PHP_INI_SYSTEM, OnUpdateBool,
         tls_enable_early_data, qp_tls_crypto_config_t, quicpro_tls_crypto_config)
     ZEND_INI_ENTRY_EX("quicpro.tls_server_0rtt_cache_size", "100000", PHP_INI_SYSTEM, OnUpdatePositiveLong, NULL, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.tls_server_0rtt_anti_replay", "single_use", PHP_INI_SYSTEM, OnUpdateAntiReplay, &quicpro_tls_crypto_config.tls_server_0rtt_anti_replay, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.tls_server_0rtt_replay_window_sec", "10", PHP_INI_SYSTEM, OnUpdatePositiveLong, NULL, NULL, NULL)
+    STD_PHP_INI_ENTRY("quicpro.tls_server_0rtt_early_dispatch", "0", PHP_INI_SYSTEM, OnUpdateBool,
+        tls_server_0rtt_early_dispatch, qp_tls_crypto_config_t, quicpro_tls_crypto_config)
+    STD_PHP_INI_ENTRY("quicpro.tls_client_session_cache_enable", "1", PHP_INI_SYSTEM, OnUpdateBool,
+        tls_client_session_cache_enable, qp_tls_crypto_config_t, quicpro_tls_crypto_config)
+    STD_PHP_INI_ENTRY("quicpro.tls_client_session_cache_shared", "0", PHP_INI_SYSTEM, OnUpdateBool,
+        tls_client_session_cache_shared, qp_tls_crypto_config_t, quicpro_tls_crypto_config)
+    ZEND_INI_ENTRY_EX("quicpro.tls_client_session_cache_size", "1024", PHP_INI_SYSTEM, OnUpdatePositiveLong, NULL, NULL, NULL)
+    STD_PHP_INI_ENTRY("quicpro.tls_client_enable_early_data", "1", PHP_INI_SYSTEM, OnUpdateBool,
+        tls_client_enable_early_data, qp_tls_crypto_config_t, quicpro_tls_crypto_config)
     STD_PHP_INI_ENTRY("quicpro.tls_enable_ocsp_stapling", "1", PHP_INI_SYSTEM, OnUpdateBool,
         tls_enable_ocsp_stapling, qp_tls_crypto_config_t, quicpro_tls_crypto_config)
+    ZEND_INI_ENTRY_EX("quicpro.tls_tcp_handshake_offload", "inline", PHP_INI_SYSTEM, OnUpdateHandshakeOffload, &quicpro_tls_crypto_config.tls_tcp_handshake_offload, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.tls_tcp_handshake_threads", "4", PHP_INI_SYSTEM, OnUpdatePositiveLong, NULL, NULL, NULL)
+    STD_PHP_INI_ENTRY("quicpro.tls_tcp_enable_ktls", "0", PHP_INI_SYSTEM, OnUpdateBool,
+        tls_tcp_enable_ktls, qp_tls_crypto_config_t, quicpro_tls_crypto_config)
+    ZEND_INI_ENTRY_EX("quicpro.tls_cert_store_dir", "", PHP_INI_SYSTEM, OnUpdateStringCopy, &quicpro_tls_crypto_config.tls_cert_store_dir, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.tls_cert_store_hot_size", "1024", PHP_INI_SYSTEM, OnUpdatePositiveLong, NULL, NULL, NULL)
+    STD_PHP_INI_ENTRY("quicpro.tls_cert_reload_enable", "1", PHP_INI_SYSTEM, OnUpdateBool,
+        tls_cert_reload_enable, qp_tls_crypto_config_t, quicpro_tls_crypto_config)
+
+    /* Storage encryption (object_store/at_rest.h) */
+    STD_PHP_INI_ENTRY("quicpro.storage_encryption_at_rest_enable", "0", PHP_INI_SYSTEM, OnUpdateBool,
+        storage_encryption_at_rest_enable, qp_tls_crypto_config_t, quicpro_tls_crypto_config)
+    ZEND_INI_ENTRY_EX("quicpro.storage_encryption_algorithm", "aes-256-gcm", PHP_INI_SYSTEM, OnUpdateStorageAlgorithm, &quicpro_tls_crypto_config.storage_encryption_algorithm, NULL, NULL)
+    ZEND_INI_ENTRY_EX("quicpro.storage_encryption_key_path", "", PHP_INI_SYSTEM, OnUpdateStringCopy, &quicpro_tls_crypto_config.storage_encryption_key_path, NULL, NULL)
 
     /* Expert level options */
     STD_PHP_INI_ENTRY("quicpro.tls_enable_ech", "0", PHP_INI_SYSTEM, OnUpdateBool,
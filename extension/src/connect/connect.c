@@ -22,6 +22,7 @@
 
 #include "php_quicpro.h"
 #include "connect.h"
+#include "server/h3_settings.h"
 #include <quiche.h>
 
 extern int le_quicpro; /* Registered resource ID for quicpro_session_t* */
@@ -213,6 +214,7 @@ PHP_FUNCTION(quicpro_connect)
 
     /* Attach HTTP/3 context */
     s->h3_cfg = quiche_h3_config_new();
+    quicpro_h3_settings_apply(s->h3_cfg);
     s->h3     = quiche_h3_conn_new_with_transport(s->conn, s->h3_cfg);
 
     freeaddrinfo(ai_list);
@@ -0,0 +1,1120 @@
+/*
+ * src/dataframe/arrow_ipc.c – Quicpro\DataFrame as an Arrow IPC stream
+ * ====================================================================
+ *
+ * See include/dataframe/arrow_ipc.h. The flatbuffers of the metadata are
+ * written front to back: each table is preceded by its vtable, and the
+ * references a table holds are filled in once the objects they point to
+ * have been written after it, which keeps every offset positive, as
+ * flatbuffers wants. Fields are laid out widest first, so all of them are
+ * aligned. The reader checks every offset and length against the message
+ * it is in before it follows it.
+ */
+
+#include "php_quicpro.h"
+#include "dataframe/arrow_ipc.h"
+#include "dataframe/column.h"
+#include "dataframe/dataframe.h"
+
+#include <ext/spl/spl_exceptions.h>
+#include <zend_exceptions.h>
+#include <inttypes.h>
+#include <string.h>
+
+#define QP_IPC_CONTINUATION  0xFFFFFFFFu
+#define QP_IPC_METADATA_V4   3
+#define QP_IPC_METADATA_V5   4
+
+/* Type union, and FloatingPoint.precision */
+#define QP_ARROW_INT          2
+#define QP_ARROW_FLOATING     3
+#define QP_ARROW_UTF8         5
+#define QP_ARROW_BOOL         6
+#define QP_ARROW_DOUBLE       2
+
+static const uint8_t qp_ipc_zeros[64];
+
+static inline uint64_t qp_ipc_load(const uint8_t *p, size_t size)
+{
+    uint64_t v = 0;
+    memcpy(&v, p, size);
+    return v;
+}
+
+static inline int32_t qp_ipc_i32(const uint8_t *p, int64_t i)
+{
+    return (int32_t)qp_ipc_load(p + 4 * i, 4);
+}
+
+/*──────────────────────────── Flatbuffer writer ──────────────────────────*/
+
+typedef struct {
+    unsigned char *p;
+    size_t         len, cap;
+} qp_fb;
+
+typedef struct {
+    uint8_t  slot;
+    uint8_t  size;              /* 1, 2, 4 or 8; references are 4, filled by qp_fb_ref() */
+    uint64_t value;
+    size_t   at;                /* Where the table put it */
+} qp_fb_field;
+
+/* Appends `n` zero bytes; returns where they start */
+static size_t qp_fb_grow(qp_fb *b, size_t n)
+{
+    size_t at = b->len;
+    if (b->len + n > b->cap) {
+        b->cap = MAX(b->cap * 2, b->len + n + 256);
+        b->p = erealloc(b->p, b->cap);
+    }
+    memset(b->p + at, 0, n);
+    b->len += n;
+    return at;
+}
+
+/* Pads so that `extra` more bytes end on a multiple of `align` */
+static void qp_fb_pad(qp_fb *b, size_t align, size_t extra)
+{
+    size_t n = (align - (b->len + extra) % align) % align;
+    if (n) {
+        qp_fb_grow(b, n);
+    }
+}
+
+static inline void qp_fb_put(qp_fb *b, size_t at, uint64_t value, size_t size)
+{
+    memcpy(b->p + at, &value, size);
+}
+
+/* Points the reference at `at` to `target`, written after it */
+static inline void qp_fb_ref(qp_fb *b, size_t at, size_t target)
+{
+    qp_fb_put(b, at, (uint32_t)(target - at), 4);
+}
+
+static size_t qp_fb_table(qp_fb *b, qp_fb_field *f, size_t n)
+{
+    size_t slots = 0, size = 4;
+    for (size_t i = 0; i < n; i++) {
+        slots = MAX(slots, (size_t)f[i].slot + 1);
+        size += f[i].size;
+    }
+    size_t vt_len = 4 + 2 * slots;
+    qp_fb_pad(b, 8, vt_len + 4);
+    size_t vt = qp_fb_grow(b, vt_len);
+    size_t table = qp_fb_grow(b, size);
+    qp_fb_put(b, vt, vt_len, 2);
+    qp_fb_put(b, vt + 2, size, 2);
+    qp_fb_put(b, table, (uint32_t)(table - vt), 4);
+
+    size_t at = table + 4;
+    for (uint8_t width = 8; width; width >>= 1) {
+        for (size_t i = 0; i < n; i++) {
+            if (f[i].size != width) {
+                continue;
+            }
+            f[i].at = at;
+            qp_fb_put(b, at, f[i].value, width);
+            qp_fb_put(b, vt + 4 + 2 * (size_t)f[i].slot, at - table, 2);
+            at += width;
+        }
+    }
+    return table;
+}
+
+static size_t qp_fb_string(qp_fb *b, const char *s, size_t n)
+{
+    qp_fb_pad(b, 4, 0);
+    size_t at = qp_fb_grow(b, 4 + n + 1);
+    qp_fb_put(b, at, (uint32_t)n, 4);
+    memcpy(b->p + at + 4, s, n);
+    return at;
+}
+
+/* A zeroed vector of `n` elements of `width` bytes; returns where its length is */
+static size_t qp_fb_vector(qp_fb *b, size_t n, size_t width)
+{
+    qp_fb_pad(b, width > 4 ? 8 : 4, 4);
+    size_t at = qp_fb_grow(b, 4 + n * width);
+    qp_fb_put(b, at, (uint32_t)n, 4);
+    return at;
+}
+
+/*──────────────────────────── Plan ───────────────────────────────────────*/
+
+typedef struct {
+    const void *data;
+    size_t      len;
+} qp_ipc_buf;
+
+static void qp_ipc_chunk(quicpro_df_ipc_t *ipc, const uint8_t *data, size_t off, size_t len)
+{
+    quicpro_df_ipc_chunk_t *last = ipc->count ? &ipc->chunks[ipc->count - 1] : NULL;
+    ipc->total += len;
+    if (!data && last && !last->data && last->off + last->len == off) {
+        last->len += len;
+        return;
+    }
+    if (ipc->count == ipc->cap) {
+        ipc->cap = MAX(ipc->cap * 2, 16);
+        ipc->chunks = safe_erealloc(ipc->chunks, ipc->cap, sizeof(*ipc->chunks), 0);
+    }
+    ipc->chunks[ipc->count++] = (quicpro_df_ipc_chunk_t){ .data = data, .off = off, .len = len };
+}
+
+/* Bytes the plan holds itself */
+static void qp_ipc_meta(quicpro_df_ipc_t *ipc, const void *data, size_t len)
+{
+    if (ipc->meta_len + len > ipc->meta_cap) {
+        ipc->meta_cap = MAX(ipc->meta_cap * 2, ipc->meta_len + len + 1024);
+        ipc->meta = erealloc(ipc->meta, ipc->meta_cap);
+    }
+    memcpy(ipc->meta + ipc->meta_len, data, len);
+    qp_ipc_chunk(ipc, NULL, ipc->meta_len, len);
+    ipc->meta_len += len;
+}
+
+/* A column's buffers in Arrow's order; returns how many */
+static size_t qp_ipc_buffers(const quicpro_df_column_t *c, qp_ipc_buf *out)
+{
+    size_t bits = ((size_t)c->length + 7) / 8;
+    out[0] = (qp_ipc_buf){ c->validity, c->validity ? bits : 0 };
+    switch (c->type) {
+        case QUICPRO_DF_INT64:
+        case QUICPRO_DF_FLOAT64:
+            out[1] = (qp_ipc_buf){ c->values, (size_t)c->length * 8 };
+            return 2;
+        case QUICPRO_DF_BOOL:
+            out[1] = (qp_ipc_buf){ c->values, bits };
+            return 2;
+        case QUICPRO_DF_DICT:
+            out[1] = (qp_ipc_buf){ c->values, (size_t)c->length * 4 };
+            return 2;
+        case QUICPRO_DF_UTF8: {
+            const int32_t *offsets = c->values;
+            out[1] = (qp_ipc_buf){ c->values, ((size_t)c->length + 1) * 4 };
+            out[2] = (qp_ipc_buf){ c->data, (size_t)offsets[c->length] };
+            return 3;
+        }
+    }
+    return 0;
+}
+
+static uint64_t qp_ipc_body_len(const qp_ipc_buf *bufs, size_t n)
+{
+    uint64_t len = 0;
+    for (size_t i = 0; i < n; i++) {
+        len += quicpro_df_padded(bufs[i].len);
+    }
+    return len;
+}
+
+/* Starts a message's metadata at the root; returns where its header reference is */
+static size_t qp_ipc_message(qp_fb *b, uint8_t header_type, uint64_t body_len)
+{
+    qp_fb_grow(b, 4);
+    qp_fb_field f[] = {
+        { .slot = 0, .size = 2, .value = QP_IPC_METADATA_V5 },
+        { .slot = 1, .size = 1, .value = header_type },
+        { .slot = 2, .size = 4 },
+        { .slot = 3, .size = 8, .value = body_len },
+    };
+    qp_fb_ref(b, 0, qp_fb_table(b, f, 4));
+    return f[2].at;
+}
+
+static size_t qp_ipc_int_type(qp_fb *b, uint32_t width)
+{
+    qp_fb_field f[] = {
+        { .slot = 0, .size = 4, .value = width },
+        { .slot = 1, .size = 1, .value = 1 },
+    };
+    return qp_fb_table(b, f, 2);
+}
+
+static size_t qp_ipc_field(qp_fb *b, const zend_string *name, const quicpro_df_column_t *c, int64_t dict_id)
+{
+    uint8_t type_type = c->type == QUICPRO_DF_INT64   ? QP_ARROW_INT
+                      : c->type == QUICPRO_DF_FLOAT64 ? QP_ARROW_FLOATING
+                      : c->type == QUICPRO_DF_BOOL    ? QP_ARROW_BOOL
+                      :                                 QP_ARROW_UTF8;
+    qp_fb_field f[] = {
+        { .slot = 0, .size = 4 },                               /* name */
+        { .slot = 1, .size = 1, .value = 1 },                   /* nullable */
+        { .slot = 2, .size = 1, .value = type_type },
+        { .slot = 3, .size = 4 },                               /* type */
+        { .slot = 5, .size = 4 },                               /* children */
+        { .slot = 4, .size = 4 },                               /* dictionary */
+    };
+    size_t field = qp_fb_table(b, f, dict_id >= 0 ? 6 : 5);
+    qp_fb_ref(b, f[0].at, qp_fb_string(b, ZSTR_VAL(name), ZSTR_LEN(name)));
+
+    size_t type;
+    if (type_type == QP_ARROW_INT) {
+        type = qp_ipc_int_type(b, 64);
+    } else if (type_type == QP_ARROW_FLOATING) {
+        qp_fb_field p[] = { { .slot = 0, .size = 2, .value = QP_ARROW_DOUBLE } };
+        type = qp_fb_table(b, p, 1);
+    } else {
+        type = qp_fb_table(b, NULL, 0);
+    }
+    qp_fb_ref(b, f[3].at, type);
+    qp_fb_ref(b, f[4].at, qp_fb_vector(b, 0, 4));
+
+    if (dict_id >= 0) {
+        qp_fb_field d[] = {
+            { .slot = 0, .size = 8, .value = (uint64_t)dict_id },
+            { .slot = 1, .size = 4 },                           /* indexType */
+        };
+        qp_fb_ref(b, f[5].at, qp_fb_table(b, d, 2));
+        qp_fb_ref(b, d[1].at, qp_ipc_int_type(b, 32));
+    }
+    return field;
+}
+
+static size_t qp_ipc_batch(qp_fb *b, quicpro_df_column_t *const *cols, size_t ncols, int64_t rows,
+                           const qp_ipc_buf *bufs, size_t nbufs)
+{
+    qp_fb_field f[] = {
+        { .slot = 0, .size = 8, .value = (uint64_t)rows },
+        { .slot = 1, .size = 4 },                               /* nodes */
+        { .slot = 2, .size = 4 },                               /* buffers */
+    };
+    size_t batch = qp_fb_table(b, f, 3);
+
+    size_t nodes = qp_fb_vector(b, ncols, 16);
+    for (size_t i = 0; i < ncols; i++) {
+        qp_fb_put(b, nodes + 4 + 16 * i, (uint64_t)cols[i]->length, 8);
+        qp_fb_put(b, nodes + 12 + 16 * i, (uint64_t)cols[i]->null_count, 8);
+    }
+    qp_fb_ref(b, f[1].at, nodes);
+
+    size_t vec = qp_fb_vector(b, nbufs, 16);
+    uint64_t off = 0;
+    for (size_t i = 0; i < nbufs; i++) {
+        qp_fb_put(b, vec + 4 + 16 * i, off, 8);
+        qp_fb_put(b, vec + 12 + 16 * i, bufs[i].len, 8);
+        off += quicpro_df_padded(bufs[i].len);
+    }
+    qp_fb_ref(b, f[2].at, vec);
+    return batch;
+}
+
+/* The message in `b` and its body; empties `b` for the next one */
+static void qp_ipc_emit(quicpro_df_ipc_t *ipc, qp_fb *b, const qp_ipc_buf *bufs, size_t nbufs)
+{
+    qp_fb_pad(b, 8, 0);
+    uint32_t prefix[2] = { QP_IPC_CONTINUATION, (uint32_t)b->len };
+    qp_ipc_meta(ipc, prefix, sizeof(prefix));
+    qp_ipc_meta(ipc, b->p, b->len);
+    for (size_t i = 0; i < nbufs; i++) {
+        size_t pad = quicpro_df_padded(bufs[i].len) - bufs[i].len;
+        if (bufs[i].len) {
+            qp_ipc_chunk(ipc, bufs[i].data, 0, bufs[i].len);
+        }
+        if (pad) {
+            qp_ipc_meta(ipc, qp_ipc_zeros, pad);
+        }
+    }
+    b->len = 0;
+}
+
+void quicpro_df_ipc_plan(const quicpro_dataframe_object *df, quicpro_df_ipc_t *ipc)
+{
+    memset(ipc, 0, sizeof(*ipc));
+    qp_fb b = {0};
+    size_t ncols = df->ncols;
+
+    /* One id per dictionary, shared by the columns that index it */
+    int64_t *dict_id = safe_emalloc(MAX(ncols, 1), sizeof(int64_t), 0);
+    bool *dict_first = ecalloc(MAX(ncols, 1), sizeof(bool));
+    int64_t ndicts = 0;
+    for (size_t i = 0; i < ncols; i++) {
+        dict_id[i] = -1;
+        if (df->cols[i]->type != QUICPRO_DF_DICT) {
+            continue;
+        }
+        for (size_t j = 0; j < i && dict_id[i] < 0; j++) {
+            if (dict_id[j] >= 0 && df->cols[j]->dictionary == df->cols[i]->dictionary) {
+                dict_id[i] = dict_id[j];
+            }
+        }
+        if (dict_id[i] < 0) {
+            dict_id[i] = ndicts++;
+            dict_first[i] = true;
+        }
+    }
+
+    size_t header = qp_ipc_message(&b, QUICPRO_DF_IPC_SCHEMA, 0);
+    qp_fb_field s[] = { { .slot = 1, .size = 4 } };            /* fields; endianness stays Little */
+    qp_fb_ref(&b, header, qp_fb_table(&b, s, 1));
+    size_t fields = qp_fb_vector(&b, ncols, 4);
+    qp_fb_ref(&b, s[0].at, fields);
+    for (size_t i = 0; i < ncols; i++) {
+        qp_fb_ref(&b, fields + 4 + 4 * i, qp_ipc_field(&b, df->names[i], df->cols[i], dict_id[i]));
+    }
+    qp_ipc_emit(ipc, &b, NULL, 0);
+
+    for (size_t i = 0; i < ncols; i++) {
+        if (!dict_first[i]) {
+            continue;
+        }
+        quicpro_df_column_t *dict = df->cols[i]->dictionary;
+        qp_ipc_buf bufs[3];
+        size_t n = qp_ipc_buffers(dict, bufs);
+        header = qp_ipc_message(&b, QUICPRO_DF_IPC_DICTIONARY_BATCH, qp_ipc_body_len(bufs, n));
+        qp_fb_field d[] = {
+            { .slot = 0, .size = 8, .value = (uint64_t)dict_id[i] },
+            { .slot = 1, .size = 4 },                           /* data */
+        };
+        qp_fb_ref(&b, header, qp_fb_table(&b, d, 2));
+        qp_fb_ref(&b, d[1].at, qp_ipc_batch(&b, &dict, 1, dict->length, bufs, n));
+        qp_ipc_emit(ipc, &b, bufs, n);
+    }
+
+    qp_ipc_buf *bufs = safe_emalloc(MAX(ncols, 1), 3 * sizeof(qp_ipc_buf), 0);
+    size_t n = 0;
+    for (size_t i = 0; i < ncols; i++) {
+        n += qp_ipc_buffers(df->cols[i], bufs + n);
+    }
+    header = qp_ipc_message(&b, QUICPRO_DF_IPC_RECORD_BATCH, qp_ipc_body_len(bufs, n));
+    qp_fb_ref(&b, header, qp_ipc_batch(&b, df->cols, ncols, df->rows, bufs, n));
+    qp_ipc_emit(ipc, &b, bufs, n);
+
+    uint32_t eos[2] = { QP_IPC_CONTINUATION, 0 };
+    qp_ipc_meta(ipc, eos, sizeof(eos));
+
+    efree(bufs);
+    efree(dict_first);
+    efree(dict_id);
+    efree(b.p);
+}
+
+zend_string *quicpro_df_ipc_flatten(const quicpro_df_ipc_t *ipc)
+{
+    zend_string *s = zend_string_alloc(ipc->total, 0);
+    size_t at = 0;
+    for (size_t i = 0; i < ipc->count; i++) {
+        memcpy(ZSTR_VAL(s) + at, quicpro_df_ipc_chunk_data(ipc, i), ipc->chunks[i].len);
+        at += ipc->chunks[i].len;
+    }
+    ZSTR_VAL(s)[at] = '\0';
+    return s;
+}
+
+void quicpro_df_ipc_free(quicpro_df_ipc_t *ipc)
+{
+    if (ipc->meta) {
+        efree(ipc->meta);
+    }
+    if (ipc->chunks) {
+        efree(ipc->chunks);
+    }
+    memset(ipc, 0, sizeof(*ipc));
+}
+
+/*──────────────────────────── Flatbuffer reader ──────────────────────────*/
+
+typedef struct {
+    const uint8_t *p;
+    size_t         len;
+} qp_fbr;
+
+typedef struct {
+    const qp_fbr *b;
+    size_t        pos, vt;
+    uint16_t      vt_len, size;
+} qp_fbt;
+
+static bool qp_fbr_table(const qp_fbr *b, size_t pos, qp_fbt *t)
+{
+    if (b->len < 4 || pos > b->len - 4) {
+        return false;
+    }
+    int64_t vt = (int64_t)pos - (int32_t)qp_ipc_load(b->p + pos, 4);
+    if (vt < 0 || (uint64_t)vt > b->len - 4) {
+        return false;
+    }
+    t->b = b;
+    t->pos = pos;
+    t->vt = (size_t)vt;
+    t->vt_len = (uint16_t)qp_ipc_load(b->p + t->vt, 2);
+    t->size = (uint16_t)qp_ipc_load(b->p + t->vt + 2, 2);
+    return t->vt_len >= 4 && t->vt + t->vt_len <= b->len && t->size >= 4 && t->size <= b->len - pos;
+}
+
+/* Where field `slot` of `size` bytes is; 0 when the table leaves it out */
+static size_t qp_fbt_at(const qp_fbt *t, unsigned slot, size_t size)
+{
+    size_t entry = 4 + 2 * (size_t)slot;
+    if (entry + 2 > t->vt_len) {
+        return 0;
+    }
+    size_t off = (size_t)qp_ipc_load(t->b->p + t->vt + entry, 2);
+    return off >= 4 && off + size <= t->size ? t->pos + off : 0;
+}
+
+static uint64_t qp_fbt_scalar(const qp_fbt *t, unsigned slot, size_t size, uint64_t dflt)
+{
+    size_t at = qp_fbt_at(t, slot, size);
+    return at ? qp_ipc_load(t->b->p + at, size) : dflt;
+}
+
+/* Where the object field `slot` refers to is; false when it is absent */
+static bool qp_fbt_ref(const qp_fbt *t, unsigned slot, size_t *out)
+{
+    size_t at = qp_fbt_at(t, slot, 4);
+    if (!at) {
+        return false;
+    }
+    uint32_t off = (uint32_t)qp_ipc_load(t->b->p + at, 4);
+    if (off > t->b->len - at) {
+        return false;
+    }
+    *out = at + off;
+    return true;
+}
+
+static bool qp_fbt_table(const qp_fbt *t, unsigned slot, qp_fbt *out)
+{
+    size_t pos;
+    return qp_fbt_ref(t, slot, &pos) && qp_fbr_table(t->b, pos, out);
+}
+
+static bool qp_fbt_vector(const qp_fbt *t, unsigned slot, size_t width, size_t *n, size_t *elems)
+{
+    size_t pos;
+    if (!qp_fbt_ref(t, slot, &pos) || pos > t->b->len - 4) {
+        return false;
+    }
+    uint32_t count = (uint32_t)qp_ipc_load(t->b->p + pos, 4);
+    if (count > (t->b->len - pos - 4) / width) {
+        return false;
+    }
+    *n = count;
+    *elems = pos + 4;
+    return true;
+}
+
+/* Table `i` of a vector of tables */
+static bool qp_fbr_vector_table(const qp_fbr *b, size_t elems, size_t i, qp_fbt *out)
+{
+    size_t at = elems + 4 * i;
+    uint32_t off = (uint32_t)qp_ipc_load(b->p + at, 4);
+    return off <= b->len - at && qp_fbr_table(b, at + off, out);
+}
+
+/*──────────────────────────── Decode ─────────────────────────────────────*/
+
+typedef struct {
+    zend_string          *name;
+    quicpro_df_type_t     type;         /* DICT: utf8 values behind a dictionary */
+    int64_t               dict_id;
+    quicpro_df_column_t **parts;        /* One per record batch */
+    size_t                nparts, cap;
+} qp_ipc_field_t;
+
+typedef struct {
+    int64_t              id;
+    quicpro_df_column_t *values;        /* utf8 without nulls or repeats */
+    int32_t             *remap;         /* Index in the stream to index in values; NULL: the same */
+    int64_t              len;           /* Indices the stream may use */
+} qp_ipc_dict_t;
+
+typedef struct {
+    zend_string    *stream;
+    const uint8_t  *body;
+    uint64_t        body_len;
+
+    /* The batch being read */
+    const qp_fbr   *fb;
+    int64_t         batch_rows;
+    size_t          nodes, nnodes, node;
+    size_t          bufs, nbufs, buf;
+
+    qp_ipc_field_t *fields;
+    size_t          nfields;
+    qp_ipc_dict_t  *dicts;
+    size_t          ndicts;
+    int64_t         rows;
+} qp_ipc_reader;
+
+static bool qp_ipc_malformed(const char *what)
+{
+    zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame: malformed Arrow IPC stream (%s)", what);
+    return false;
+}
+
+static bool qp_ipc_unsupported(const char *what)
+{
+    zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame: Arrow IPC stream with %s is not supported", what);
+    return false;
+}
+
+static int64_t qp_ipc_count_unset(const uint8_t *bits, int64_t length)
+{
+    int64_t set = 0;
+    for (int64_t i = 0; i < length >> 3; i++) {
+        set += __builtin_popcount(bits[i]);
+    }
+    if (length & 7) {
+        set += __builtin_popcount(bits[length >> 3] & ((1u << (length & 7)) - 1));
+    }
+    return length - set;
+}
+
+/* Whether the bits of a bitmap from `length` to the end of its last word are all clear */
+static bool qp_ipc_tail_clear(const uint8_t *bits, int64_t length)
+{
+    size_t end = (size_t)((length + 63) >> 6) * 8;
+    size_t i = (size_t)(length >> 3);
+    if (length & 7) {
+        if (bits[i] >> (length & 7)) {
+            return false;
+        }
+        i++;
+    }
+    for (; i < end; i++) {
+        if (bits[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void qp_ipc_copy_bits(uint8_t *dst, const uint8_t *src, int64_t length)
+{
+    size_t bytes = ((size_t)length + 7) / 8;
+    memcpy(dst, src, bytes);
+    if (length & 7) {
+        dst[bytes - 1] &= (uint8_t)((1u << (length & 7)) - 1);
+    }
+}
+
+static const qp_ipc_dict_t *qp_ipc_dict_find(const qp_ipc_reader *r, int64_t id)
+{
+    for (size_t i = 0; i < r->ndicts; i++) {
+        if (r->dicts[i].id == id) {
+            return &r->dicts[i];
+        }
+    }
+    return NULL;
+}
+
+static bool qp_ipc_batch_begin(qp_ipc_reader *r, const qp_fbt *batch)
+{
+    qp_fbt compression;
+    if (qp_fbt_table(batch, 3, &compression)) {
+        return qp_ipc_unsupported("compressed bodies");
+    }
+    r->fb = batch->b;
+    r->batch_rows = (int64_t)qp_fbt_scalar(batch, 0, 8, 0);
+    r->node = r->buf = 0;
+    if (r->batch_rows < 0 || r->batch_rows > INT64_MAX - r->rows
+        || !qp_fbt_vector(batch, 1, 16, &r->nnodes, &r->nodes)
+        || !qp_fbt_vector(batch, 2, 16, &r->nbufs, &r->bufs)) {
+        return qp_ipc_malformed("record batch");
+    }
+    return true;
+}
+
+/*
+ * The batch's next field node as a column: mapped into the stream where
+ * its buffers allow, copied otherwise. NULL after throwing.
+ */
+static quicpro_df_column_t *qp_ipc_column(qp_ipc_reader *r, quicpro_df_type_t type, const qp_ipc_dict_t *dict)
+{
+    size_t nbufs = type == QUICPRO_DF_UTF8 ? 3 : 2;
+    if (r->node >= r->nnodes || r->buf + nbufs > r->nbufs) {
+        qp_ipc_malformed("fewer field nodes or buffers than fields");
+        return NULL;
+    }
+    const uint8_t *node = r->fb->p + r->nodes + 16 * r->node++;
+    int64_t length = (int64_t)qp_ipc_load(node, 8);
+    int64_t nulls = (int64_t)qp_ipc_load(node + 8, 8);
+    if (length != r->batch_rows || nulls < 0 || nulls > length) {
+        qp_ipc_malformed("field node");
+        return NULL;
+    }
+
+    const uint8_t *ptr[3];
+    uint64_t len[3], room[3];
+    for (size_t k = 0; k < nbufs; k++) {
+        const uint8_t *buf = r->fb->p + r->bufs + 16 * (r->buf + k);
+        uint64_t off = qp_ipc_load(buf, 8);
+        len[k] = qp_ipc_load(buf + 8, 8);
+        if (off > r->body_len || len[k] > r->body_len - off) {
+            qp_ipc_malformed("buffer outside the message body");
+            return NULL;
+        }
+        ptr[k] = r->body + off;
+        room[k] = r->body_len - off;
+    }
+    r->buf += nbufs;
+
+    size_t bits = ((size_t)length + 7) / 8;
+    size_t words = (size_t)((length + 63) >> 6) * 8;
+    size_t values = type == QUICPRO_DF_INT64 || type == QUICPRO_DF_FLOAT64 ? (size_t)length * 8
+                  : type == QUICPRO_DF_BOOL                               ? bits
+                  : type == QUICPRO_DF_UTF8                               ? ((size_t)length + 1) * 4
+                  :                                                         (size_t)length * 4;
+    if (nulls && len[0] < bits) {
+        qp_ipc_malformed("validity bitmap shorter than its field");
+        return NULL;
+    }
+    if (len[1] < values) {
+        qp_ipc_malformed("values buffer shorter than its field");
+        return NULL;
+    }
+    if (nulls) {
+        nulls = qp_ipc_count_unset(ptr[0], length);
+    }
+    const uint8_t *validity = nulls ? ptr[0] : NULL;
+
+    bool map = length > 0;
+    size_t first = 0, last = 0;
+    if (type == QUICPRO_DF_UTF8) {
+        int32_t prev = qp_ipc_i32(ptr[1], 0);
+        if (prev < 0) {
+            qp_ipc_malformed("string offsets");
+            return NULL;
+        }
+        for (int64_t i = 1; i <= length; i++) {
+            int32_t cur = qp_ipc_i32(ptr[1], i);
+            if (cur < prev) {
+                qp_ipc_malformed("string offsets");
+                return NULL;
+            }
+            prev = cur;
+        }
+        if ((uint64_t)prev > len[2]) {
+            qp_ipc_malformed("string offsets past the data");
+            return NULL;
+        }
+        first = (size_t)qp_ipc_i32(ptr[1], 0);
+        last = (size_t)prev;
+    } else if (type == QUICPRO_DF_DICT) {
+        map = map && !dict->remap;
+        for (int64_t i = 0; i < length; i++) {
+            if ((uint32_t)qp_ipc_i32(ptr[1], i) < (uint64_t)dict->len) {
+                continue;
+            }
+            if (!validity || quicpro_df_bit(validity, i)) {
+                qp_ipc_malformed("dictionary index out of range");
+                return NULL;
+            }
+            map = false;                        /* A null's index, zeroed in the copy */
+        }
+    }
+
+    /* Mapped buffers must take the kernels' aligned, word-wide reads */
+    if (validity) {
+        map = map && !((uintptr_t)validity & 7) && room[0] >= words && qp_ipc_tail_clear(validity, length);
+    }
+    if (type == QUICPRO_DF_BOOL) {
+        map = map && !((uintptr_t)ptr[1] & 7) && room[1] >= words && qp_ipc_tail_clear(ptr[1], length);
+    } else {
+        map = map && !((uintptr_t)ptr[1] & 7);
+    }
+
+    quicpro_df_column_t *c;
+    if (map) {
+        c = quicpro_df_column_map(type, length, r->stream);
+        c->validity = (uint8_t *)validity;
+        c->values = (void *)ptr[1];
+        c->data = type == QUICPRO_DF_UTF8 ? (char *)ptr[2] : NULL;
+    } else {
+        c = quicpro_df_column_new(type, length, validity != NULL, last - first);
+        if (!c) {
+            return NULL;
+        }
+        if (validity) {
+            qp_ipc_copy_bits(c->validity, validity, length);
+        }
+        switch (type) {
+            case QUICPRO_DF_INT64:
+            case QUICPRO_DF_FLOAT64:
+                memcpy(c->values, ptr[1], values);
+                break;
+            case QUICPRO_DF_BOOL:
+                qp_ipc_copy_bits(c->values, ptr[1], length);
+                break;
+            case QUICPRO_DF_DICT: {
+                int32_t *codes = c->values;
+                for (int64_t i = 0; i < length; i++) {
+                    int32_t code = qp_ipc_i32(ptr[1], i);
+                    codes[i] = (uint32_t)code >= (uint64_t)dict->len ? 0 : dict->remap ? dict->remap[code] : code;
+                }
+                break;
+            }
+            case QUICPRO_DF_UTF8: {
+                int32_t *offsets = c->values;
+                for (int64_t i = 0; i <= length; i++) {
+                    offsets[i] = qp_ipc_i32(ptr[1], i) - (int32_t)first;
+                }
+                memcpy(c->data, ptr[2] + first, last - first);
+                break;
+            }
+        }
+    }
+    c->null_count = nulls;
+    if (type == QUICPRO_DF_DICT) {
+        c->dictionary = quicpro_df_column_addref(dict->values);
+    }
+    return c;
+}
+
+/* Folds repeated values out of a dictionary, as the grouping kernels compare indices */
+static bool qp_ipc_dictionary(qp_ipc_reader *r, int64_t id, quicpro_df_column_t *values)
+{
+    const int32_t *offsets = values->values;
+    int64_t n = values->length, unique = 0;
+    int32_t *remap = NULL;
+    size_t unique_len = 0;
+    HashTable seen;
+
+    zend_hash_init(&seen, (uint32_t)MIN(n, UINT32_MAX), NULL, NULL, 0);
+    for (int64_t i = 0; i < n; i++) {
+        const char *s = values->data + offsets[i];
+        size_t len = (size_t)(offsets[i + 1] - offsets[i]);
+        zval *prev = zend_hash_str_find(&seen, s, len);
+        if (prev && !remap) {
+            remap = safe_emalloc((size_t)n, sizeof(int32_t), 0);
+            for (int64_t j = 0; j < i; j++) {
+                remap[j] = (int32_t)j;
+            }
+        }
+        if (prev) {
+            remap[i] = (int32_t)Z_LVAL_P(prev);
+            continue;
+        }
+        zval z;
+        ZVAL_LONG(&z, unique);
+        zend_hash_str_add_new(&seen, s, len, &z);
+        if (remap) {
+            remap[i] = (int32_t)unique;
+        }
+        unique_len += len;
+        unique++;
+    }
+    zend_hash_destroy(&seen);
+
+    quicpro_df_column_t *dict = values;
+    if (remap) {
+        dict = quicpro_df_column_new(QUICPRO_DF_UTF8, unique, false, unique_len);
+        if (!dict) {
+            efree(remap);
+            quicpro_df_column_release(values);
+            return false;
+        }
+        int32_t *o = dict->values;
+        int64_t next = 0;
+        for (int64_t i = 0; i < n; i++) {
+            if (remap[i] != next) {
+                continue;
+            }
+            size_t len = (size_t)(offsets[i + 1] - offsets[i]);
+            memcpy(dict->data + o[next], values->data + offsets[i], len);
+            o[next + 1] = o[next] + (int32_t)len;
+            next++;
+        }
+        quicpro_df_column_release(values);
+    }
+
+    qp_ipc_dict_t *d = (qp_ipc_dict_t *)qp_ipc_dict_find(r, id);
+    if (d) {
+        quicpro_df_column_release(d->values);
+        if (d->remap) {
+            efree(d->remap);
+        }
+    } else {
+        r->dicts = safe_erealloc(r->dicts, r->ndicts + 1, sizeof(*r->dicts), 0);
+        d = &r->dicts[r->ndicts++];
+    }
+    *d = (qp_ipc_dict_t){ .id = id, .values = dict, .remap = remap, .len = n };
+    return true;
+}
+
+static bool qp_ipc_read_schema(qp_ipc_reader *r, const qp_fbt *schema)
+{
+    size_t n, elems;
+    if (qp_fbt_scalar(schema, 0, 2, 0) != 0) {
+        return qp_ipc_unsupported("big-endian data");
+    }
+    if (!qp_fbt_vector(schema, 1, 4, &n, &elems)) {
+        return qp_ipc_malformed("schema fields");
+    }
+    if (n > UINT32_MAX) {
+        return qp_ipc_unsupported("this many fields");
+    }
+    r->fields = ecalloc(MAX(n, 1), sizeof(qp_ipc_field_t));
+
+    for (size_t i = 0; i < n; i++) {
+        qp_fbt field, type, enc, index;
+        size_t name_len = 0, name_at = 0, nchildren, children;
+        if (!qp_fbr_vector_table(schema->b, elems, i, &field)) {
+            return qp_ipc_malformed("field");
+        }
+        qp_fbt_vector(&field, 0, 1, &name_len, &name_at);
+        const char *name = (const char *)schema->b->p + name_at;
+        if (qp_fbt_vector(&field, 5, 4, &nchildren, &children) && nchildren) {
+            return qp_ipc_unsupported("nested fields");
+        }
+
+        quicpro_df_type_t t;
+        bool typed = qp_fbt_table(&field, 3, &type);
+        switch ((uint8_t)qp_fbt_scalar(&field, 2, 1, 0)) {
+            case QP_ARROW_INT:
+                if (!typed || qp_fbt_scalar(&type, 0, 4, 0) != 64 || !qp_fbt_scalar(&type, 1, 1, 0)) {
+                    return qp_ipc_unsupported("integers other than int64");
+                }
+                t = QUICPRO_DF_INT64;
+                break;
+            case QP_ARROW_FLOATING:
+                if (!typed || qp_fbt_scalar(&type, 0, 2, 0) != QP_ARROW_DOUBLE) {
+                    return qp_ipc_unsupported("floats other than float64");
+                }
+                t = QUICPRO_DF_FLOAT64;
+                break;
+            case QP_ARROW_BOOL:
+                t = QUICPRO_DF_BOOL;
+                break;
+            case QP_ARROW_UTF8:
+                t = QUICPRO_DF_UTF8;
+                break;
+            default:
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "DataFrame: Arrow field '%.*s' is of a type DataFrame does not hold (int64, float64, bool and utf8 do)",
+                    (int)name_len, name);
+                return false;
+        }
+
+        int64_t dict_id = -1;
+        if (qp_fbt_table(&field, 4, &enc)) {
+            if (t != QUICPRO_DF_UTF8) {
+                return qp_ipc_unsupported("dictionaries of other values than utf8");
+            }
+            if (qp_fbt_table(&enc, 1, &index) && (qp_fbt_scalar(&index, 0, 4, 0) != 32 || !qp_fbt_scalar(&index, 1, 1, 0))) {
+                return qp_ipc_unsupported("dictionary indices other than int32");
+            }
+            dict_id = (int64_t)qp_fbt_scalar(&enc, 0, 8, 0);
+            t = QUICPRO_DF_DICT;
+        }
+        for (size_t j = 0; j < r->nfields; j++) {
+            if (ZSTR_LEN(r->fields[j].name) == name_len && !memcmp(ZSTR_VAL(r->fields[j].name), name, name_len)) {
+                return qp_ipc_unsupported("repeated field names");
+            }
+        }
+        r->fields[r->nfields++] = (qp_ipc_field_t){
+            .name = zend_string_init(name, name_len, 0),
+            .type = t,
+            .dict_id = dict_id,
+        };
+    }
+    return true;
+}
+
+static bool qp_ipc_read_dictionary(qp_ipc_reader *r, const qp_fbt *batch)
+{
+    qp_fbt data;
+    if (qp_fbt_scalar(batch, 2, 1, 0)) {
+        return qp_ipc_unsupported("delta dictionaries");
+    }
+    if (!qp_fbt_table(batch, 1, &data)) {
+        return qp_ipc_malformed("dictionary batch");
+    }
+    if (!qp_ipc_batch_begin(r, &data)) {
+        return false;
+    }
+    quicpro_df_column_t *values = qp_ipc_column(r, QUICPRO_DF_UTF8, NULL);
+    if (!values) {
+        return false;
+    }
+    if (values->null_count) {
+        quicpro_df_column_release(values);
+        return qp_ipc_unsupported("nulls in a dictionary");
+    }
+    return qp_ipc_dictionary(r, (int64_t)qp_fbt_scalar(batch, 0, 8, 0), values);
+}
+
+static bool qp_ipc_read_batch(qp_ipc_reader *r, const qp_fbt *batch)
+{
+    if (!qp_ipc_batch_begin(r, batch)) {
+        return false;
+    }
+    for (size_t i = 0; i < r->nfields; i++) {
+        qp_ipc_field_t *f = &r->fields[i];
+        const qp_ipc_dict_t *dict = NULL;
+        if (f->type == QUICPRO_DF_DICT && !(dict = qp_ipc_dict_find(r, f->dict_id))) {
+            return qp_ipc_malformed("record batch before its dictionary");
+        }
+        quicpro_df_column_t *c = qp_ipc_column(r, f->type, dict);
+        if (!c) {
+            return false;
+        }
+        if (f->nparts == f->cap) {
+            f->cap = MAX(f->cap * 2, 1);
+            f->parts = safe_erealloc(f->parts, f->cap, sizeof(*f->parts), 0);
+        }
+        f->parts[f->nparts++] = c;
+    }
+    r->rows += r->batch_rows;
+    return true;
+}
+
+static bool qp_ipc_read_messages(qp_ipc_reader *r)
+{
+    const uint8_t *p = (const uint8_t *)ZSTR_VAL(r->stream);
+    size_t len = ZSTR_LEN(r->stream), pos = 0;
+    bool schema = false;
+
+    while (pos + 4 <= len) {
+        uint32_t meta_len = (uint32_t)qp_ipc_load(p + pos, 4);
+        pos += 4;
+        if (meta_len == QP_IPC_CONTINUATION) {
+            if (pos + 4 > len) {
+                return qp_ipc_malformed("truncated message");
+            }
+            meta_len = (uint32_t)qp_ipc_load(p + pos, 4);
+            pos += 4;
+        }
+        if (meta_len == 0) {
+            break;                              /* End of stream */
+        }
+        if (meta_len < 4 || meta_len > len - pos) {
+            return qp_ipc_malformed("truncated metadata");
+        }
+        qp_fbr fb = { p + pos, meta_len };
+        qp_fbt msg, header;
+        pos += meta_len;
+        if (!qp_fbr_table(&fb, (size_t)qp_ipc_load(fb.p, 4), &msg)) {
+            return qp_ipc_malformed("message");
+        }
+        uint64_t body_len = qp_fbt_scalar(&msg, 3, 8, 0);
+        if (body_len > len - pos) {
+            return qp_ipc_malformed("truncated body");
+        }
+        r->body = p + pos;
+        r->body_len = body_len;
+        pos += body_len;
+
+        if ((int16_t)qp_fbt_scalar(&msg, 0, 2, 0) < QP_IPC_METADATA_V4) {
+            return qp_ipc_unsupported("metadata older than V4");
+        }
+        if (!qp_fbt_table(&msg, 2, &header)) {
+            return qp_ipc_malformed("message header");
+        }
+        uint8_t type = (uint8_t)qp_fbt_scalar(&msg, 1, 1, 0);
+        if (type != QUICPRO_DF_IPC_SCHEMA && !schema) {
+            return qp_ipc_malformed("batch before the schema");
+        }
+        switch (type) {
+            case QUICPRO_DF_IPC_SCHEMA:
+                if (schema) {
+                    return qp_ipc_malformed("second schema");
+                }
+                schema = true;
+                if (!qp_ipc_read_schema(r, &header)) {
+                    return false;
+                }
+                break;
+            case QUICPRO_DF_IPC_DICTIONARY_BATCH:
+                if (!qp_ipc_read_dictionary(r, &header)) {
+                    return false;
+                }
+                break;
+            case QUICPRO_DF_IPC_RECORD_BATCH:
+                if (!qp_ipc_read_batch(r, &header)) {
+                    return false;
+                }
+                break;
+            default:
+                return qp_ipc_unsupported("tensor messages");
+        }
+    }
+    return schema || qp_ipc_malformed("no schema");
+}
+
+bool quicpro_df_ipc_message_info(const uint8_t *meta, size_t len, uint8_t *type, uint64_t *body_len)
+{
+    qp_fbr fb = { meta, len };
+    qp_fbt msg;
+    if (len < 4 || !qp_fbr_table(&fb, (size_t)qp_ipc_load(meta, 4), &msg)) {
+        return false;
+    }
+    *type = (uint8_t)qp_fbt_scalar(&msg, 1, 1, 0);
+    *body_len = qp_fbt_scalar(&msg, 3, 8, 0);
+    return true;
+}
+
+/* The column of field `f` over all batches; NULL after throwing */
+static quicpro_df_column_t *qp_ipc_field_column(const qp_ipc_reader *r, const qp_ipc_field_t *f)
+{
+    if (f->nparts == 1) {
+        return quicpro_df_column_addref(f->parts[0]);
+    }
+    if (f->nparts > 1) {
+        return quicpro_df_column_concat(f->parts, f->nparts);
+    }
+    const qp_ipc_dict_t *dict = f->type == QUICPRO_DF_DICT ? qp_ipc_dict_find(r, f->dict_id) : NULL;
+    quicpro_df_column_t *c = quicpro_df_column_new(dict || f->type != QUICPRO_DF_DICT ? f->type : QUICPRO_DF_UTF8, 0, false, 0);
+    if (c && dict) {
+        c->dictionary = quicpro_df_column_addref(dict->values);
+    }
+    return c;
+}
+
+bool quicpro_df_ipc_decode(zend_string *stream, zval *out)
+{
+    qp_ipc_reader r = { .stream = stream };
+    bool ok = qp_ipc_read_messages(&r);
+    zend_string **names = NULL;
+    quicpro_df_column_t **cols = NULL;
+    size_t built = 0;
+
+    if (ok) {
+        names = safe_emalloc(MAX(r.nfields, 1), sizeof(zend_string *), 0);
+        cols = safe_emalloc(MAX(r.nfields, 1), sizeof(quicpro_df_column_t *), 0);
+        for (; built < r.nfields; built++) {
+            if (!(cols[built] = qp_ipc_field_column(&r, &r.fields[built]))) {
+                ok = false;
+                break;
+            }
+            names[built] = zend_string_copy(r.fields[built].name);
+        }
+    }
+    if (ok) {
+        quicpro_dataframe_wrap(out, r.rows, (uint32_t)r.nfields, names, cols);
+    } else if (names) {
+        for (size_t i = 0; i < built; i++) {
+            zend_string_release(names[i]);
+            quicpro_df_column_release(cols[i]);
+        }
+        efree(names);
+        efree(cols);
+    }
+
+    for (size_t i = 0; i < r.nfields; i++) {
+        zend_string_release(r.fields[i].name);
+        for (size_t j = 0; j < r.fields[i].nparts; j++) {
+            quicpro_df_column_release(r.fields[i].parts[j]);
+        }
+        if (r.fields[i].parts) {
+            efree(r.fields[i].parts);
+        }
+    }
+    if (r.fields) {
+        efree(r.fields);
+    }
+    for (size_t i = 0; i < r.ndicts; i++) {
+        quicpro_df_column_release(r.dicts[i].values);
+        if (r.dicts[i].remap) {
+            efree(r.dicts[i].remap);
+        }
+    }
+    if (r.dicts) {
+        efree(r.dicts);
+    }
+    return ok;
+}
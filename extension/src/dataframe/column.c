@@ -0,0 +1,663 @@
+/*
+ * src/dataframe/column.c – Columns of Quicpro\DataFrame
+ * =====================================================
+ *
+ * See include/dataframe/column.h. Gathering picked rows runs per morsel:
+ * each morsel writes its rows from the output position the selection
+ * gives it. Output bitmaps are assembled a word at a time and OR-ed in
+ * atomically, as the word where one morsel's rows end is also where the
+ * next one's begin. Strings are gathered on the calling thread, as each
+ * row's position in the output bytes depends on every row before it.
+ */
+
+#include "php_quicpro.h"
+#include "dataframe/column.h"
+#include "dataframe/morsel.h"
+#include "config/high_perf_compute_and_ai/base_layer.h"
+
+#include <ext/spl/spl_exceptions.h>
+#include <zend_exceptions.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+static size_t qp_df_bytes;
+
+const char *quicpro_df_type_name(quicpro_df_type_t type)
+{
+    switch (type) {
+        case QUICPRO_DF_INT64:   return "int64";
+        case QUICPRO_DF_FLOAT64: return "float64";
+        case QUICPRO_DF_BOOL:    return "bool";
+        case QUICPRO_DF_UTF8:    return "utf8";
+        case QUICPRO_DF_DICT:    return "dictionary";
+    }
+    return "unknown";
+}
+
+size_t quicpro_df_memory_used(void)
+{
+    return qp_df_bytes;
+}
+
+/*──────────────────────────── Buffers ────────────────────────────────────*/
+
+static void *qp_df_buf(size_t n)
+{
+    void *p = NULL;
+    n = quicpro_df_padded(MAX(n, 1));
+    if (posix_memalign(&p, 64, n) != 0) {
+        return NULL;
+    }
+    memset(p, 0, n);
+    return p;
+}
+
+static size_t qp_df_values_size(quicpro_df_type_t type, int64_t length)
+{
+    switch (type) {
+        case QUICPRO_DF_INT64:
+        case QUICPRO_DF_FLOAT64: return (size_t)length * 8;
+        case QUICPRO_DF_BOOL:    return ((size_t)length + 7) / 8;
+        case QUICPRO_DF_UTF8:    return ((size_t)length + 1) * 4;
+        case QUICPRO_DF_DICT:    return (size_t)length * 4;
+    }
+    return 0;
+}
+
+quicpro_df_column_t *quicpro_df_column_new(quicpro_df_type_t type, int64_t length, bool nullable, size_t data_len)
+{
+    size_t values = quicpro_df_padded(qp_df_values_size(type, length));
+    size_t validity = nullable ? quicpro_df_padded(((size_t)length + 7) / 8) : 0;
+    size_t data = type == QUICPRO_DF_UTF8 ? quicpro_df_padded(data_len) : 0;
+    size_t bytes = values + validity + data;
+    size_t limit = (size_t)quicpro_high_perf_compute_ai_config.dataframe_memory_limit_mb * 1024 * 1024;
+
+    if (limit && qp_df_bytes + bytes > limit) {
+        zend_throw_exception_ex(NULL, 0,
+            "DataFrame memory limit of %zu MB reached (%zu bytes held, %zu more wanted); see quicpro.dataframe_memory_limit_mb",
+            limit >> 20, qp_df_bytes, bytes);
+        return NULL;
+    }
+    quicpro_df_column_t *c = ecalloc(1, sizeof(*c));
+    c->refcount = 1;
+    c->type = type;
+    c->length = length;
+    c->values = qp_df_buf(values);
+    c->validity = nullable ? qp_df_buf(validity) : NULL;
+    c->data = type == QUICPRO_DF_UTF8 ? qp_df_buf(data) : NULL;
+    c->bytes = bytes;
+    qp_df_bytes += bytes;
+    if (!c->values || (nullable && !c->validity) || (type == QUICPRO_DF_UTF8 && !c->data)) {
+        quicpro_df_column_release(c);
+        zend_throw_exception_ex(NULL, 0, "DataFrame: out of memory for a column of %zu bytes", bytes);
+        return NULL;
+    }
+    return c;
+}
+
+quicpro_df_column_t *quicpro_df_column_map(quicpro_df_type_t type, int64_t length, zend_string *owner)
+{
+    quicpro_df_column_t *c = ecalloc(1, sizeof(*c));
+    c->refcount = 1;
+    c->type = type;
+    c->length = length;
+    c->owner = zend_string_copy(owner);
+    return c;
+}
+
+void quicpro_df_column_release(quicpro_df_column_t *c)
+{
+    if (!c || --c->refcount > 0) {
+        return;
+    }
+    if (c->dictionary) {
+        quicpro_df_column_release(c->dictionary);
+    }
+    if (c->owner) {
+        zend_string_release(c->owner);
+    } else {
+        free(c->values);
+        free(c->validity);
+        free(c->data);
+    }
+    qp_df_bytes -= c->bytes;
+    efree(c);
+}
+
+/* Drops a validity bitmap that turned out to have no nulls */
+static void qp_df_validity_settle(quicpro_df_column_t *c)
+{
+    if (c->validity && c->null_count == 0) {
+        free(c->validity);
+        c->validity = NULL;
+    }
+}
+
+/*──────────────────────────── From PHP ───────────────────────────────────*/
+
+static bool qp_df_from_strings(quicpro_df_column_t **out, zval *const *cells, int64_t n, bool nullable)
+{
+    size_t data_len = 0;
+    for (int64_t i = 0; i < n; i++) {
+        if (cells[i] && Z_TYPE_P(cells[i]) == IS_STRING) {
+            data_len += Z_STRLEN_P(cells[i]);
+        }
+    }
+    if (data_len > INT32_MAX) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame string columns hold at most 2 GiB");
+        return false;
+    }
+    quicpro_df_column_t *c = quicpro_df_column_new(QUICPRO_DF_UTF8, n, nullable, data_len);
+    if (!c) {
+        return false;
+    }
+    int32_t *offsets = c->values;
+    int32_t at = 0;
+    for (int64_t i = 0; i < n; i++) {
+        offsets[i] = at;
+        if (cells[i] && Z_TYPE_P(cells[i]) == IS_STRING) {
+            memcpy(c->data + at, Z_STRVAL_P(cells[i]), Z_STRLEN_P(cells[i]));
+            at += (int32_t)Z_STRLEN_P(cells[i]);
+            if (c->validity) c->validity[i >> 3] |= (uint8_t)(1u << (i & 7));
+        } else {
+            c->null_count++;
+        }
+    }
+    offsets[n] = at;
+    qp_df_validity_settle(c);
+    *out = c;
+    return true;
+}
+
+/* Strings as indices into a dictionary of their distinct values, in order of first appearance */
+static bool qp_df_from_strings_interned(quicpro_df_column_t **out, zval *const *cells, int64_t n, bool nullable)
+{
+    HashTable codes;
+    zend_hash_init(&codes, 64, NULL, NULL, 0);
+    quicpro_df_column_t *c = quicpro_df_column_new(QUICPRO_DF_DICT, n, nullable, 0);
+    if (!c) {
+        zend_hash_destroy(&codes);
+        return false;
+    }
+    int32_t *idx = c->values;
+    zval **distinct = safe_emalloc((size_t)MAX(n, 1), sizeof(zval *), 0);
+    int64_t ndistinct = 0;
+    for (int64_t i = 0; i < n; i++) {
+        if (!cells[i] || Z_TYPE_P(cells[i]) != IS_STRING) {
+            c->null_count++;
+            continue;
+        }
+        zval *code = zend_hash_find(&codes, Z_STR_P(cells[i]));
+        if (!code) {
+            zval z;
+            ZVAL_LONG(&z, ndistinct);
+            code = zend_hash_add_new(&codes, Z_STR_P(cells[i]), &z);
+            distinct[ndistinct++] = cells[i];
+        }
+        idx[i] = (int32_t)Z_LVAL_P(code);
+        if (c->validity) c->validity[i >> 3] |= (uint8_t)(1u << (i & 7));
+    }
+    zend_hash_destroy(&codes);
+    qp_df_validity_settle(c);
+
+    bool ok = qp_df_from_strings(&c->dictionary, distinct, ndistinct, false);
+    efree(distinct);
+    if (!ok) {
+        quicpro_df_column_release(c);
+        return false;
+    }
+    *out = c;
+    return true;
+}
+
+quicpro_df_column_t *quicpro_df_column_from_zvals(zval *const *cells, int64_t n, const zend_string *name)
+{
+    bool ints = false, floats = false, bools = false, strings = false;
+    bool nullable = false;
+    /* References resolved once, and null for what holds null, so the loops below see values only */
+    zval **v = safe_emalloc((size_t)MAX(n, 1), sizeof(zval *), 0);
+    for (int64_t i = 0; i < n; i++) {
+        v[i] = cells[i];
+        if (v[i]) {
+            ZVAL_DEREF(v[i]);
+        }
+        switch (v[i] ? Z_TYPE_P(v[i]) : IS_NULL) {
+            case IS_NULL:   v[i] = NULL; nullable = true; break;
+            case IS_LONG:   ints = true; break;
+            case IS_DOUBLE: floats = true; break;
+            case IS_TRUE:
+            case IS_FALSE:  bools = true; break;
+            case IS_STRING: strings = true; break;
+            default:
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "DataFrame column '%s' row %" PRId64 ": %s values are not supported", ZSTR_VAL(name), i, zend_zval_type_name(v[i]));
+                efree(v);
+                return NULL;
+        }
+    }
+    if ((ints || floats) + bools + strings > 1) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "DataFrame column '%s' mixes %s", ZSTR_VAL(name),
+            strings && bools ? "strings and bools" : strings ? "strings and numbers" : "bools and numbers");
+        efree(v);
+        return NULL;
+    }
+
+    quicpro_df_column_t *c = NULL;
+    if (strings) {
+        bool ok = quicpro_high_perf_compute_ai_config.dataframe_string_interning_enable
+            ? qp_df_from_strings_interned(&c, v, n, nullable)
+            : qp_df_from_strings(&c, v, n, nullable);
+        efree(v);
+        return ok ? c : NULL;
+    }
+
+    quicpro_df_type_t type = floats ? QUICPRO_DF_FLOAT64 : bools ? QUICPRO_DF_BOOL : QUICPRO_DF_INT64;
+    c = quicpro_df_column_new(type, n, nullable, 0);
+    for (int64_t i = 0; c && i < n; i++) {
+        if (!v[i]) {
+            c->null_count++;
+            continue;
+        }
+        if (c->validity) c->validity[i >> 3] |= (uint8_t)(1u << (i & 7));
+        if (type == QUICPRO_DF_INT64) {
+            ((int64_t *)c->values)[i] = Z_LVAL_P(v[i]);
+        } else if (type == QUICPRO_DF_FLOAT64) {
+            ((double *)c->values)[i] = Z_TYPE_P(v[i]) == IS_LONG ? (double)Z_LVAL_P(v[i]) : Z_DVAL_P(v[i]);
+        } else if (Z_TYPE_P(v[i]) == IS_TRUE) {
+            ((uint8_t *)c->values)[i >> 3] |= (uint8_t)(1u << (i & 7));
+        }
+    }
+    efree(v);
+    return c;
+}
+
+/*──────────────────────────── To PHP ─────────────────────────────────────*/
+
+zend_string **quicpro_df_strings_new(const quicpro_df_column_t *c)
+{
+    return c->type == QUICPRO_DF_DICT ? ecalloc((size_t)MAX(c->dictionary->length, 1), sizeof(zend_string *)) : NULL;
+}
+
+void quicpro_df_strings_free(const quicpro_df_column_t *c, zend_string **strings)
+{
+    if (!strings) {
+        return;
+    }
+    for (int64_t i = 0; i < c->dictionary->length; i++) {
+        if (strings[i]) zend_string_release(strings[i]);
+    }
+    efree(strings);
+}
+
+static zend_string *qp_df_utf8_at(const quicpro_df_column_t *c, int64_t row)
+{
+    const int32_t *offsets = c->values;
+    return zend_string_init(c->data + offsets[row], (size_t)(offsets[row + 1] - offsets[row]), 0);
+}
+
+void quicpro_df_cell(const quicpro_df_column_t *c, int64_t row, zend_string **strings, zval *out)
+{
+    if (!quicpro_df_valid(c, row)) {
+        ZVAL_NULL(out);
+        return;
+    }
+    switch (c->type) {
+        case QUICPRO_DF_INT64:
+            ZVAL_LONG(out, (zend_long)((const int64_t *)c->values)[row]);
+            break;
+        case QUICPRO_DF_FLOAT64:
+            ZVAL_DOUBLE(out, ((const double *)c->values)[row]);
+            break;
+        case QUICPRO_DF_BOOL:
+            ZVAL_BOOL(out, quicpro_df_bit(c->values, row));
+            break;
+        case QUICPRO_DF_UTF8:
+            ZVAL_STR(out, qp_df_utf8_at(c, row));
+            break;
+        case QUICPRO_DF_DICT: {
+            int32_t code = ((const int32_t *)c->values)[row];
+            if (!strings) {
+                ZVAL_STR(out, qp_df_utf8_at(c->dictionary, code));
+            } else {
+                if (!strings[code]) strings[code] = qp_df_utf8_at(c->dictionary, code);
+                ZVAL_STR_COPY(out, strings[code]);
+            }
+            break;
+        }
+    }
+}
+
+/*──────────────────────────── Take ───────────────────────────────────────*/
+
+typedef struct {
+    const quicpro_df_column_t    *in;
+    quicpro_df_column_t          *out;
+    const quicpro_df_selection_t *sel;
+} qp_df_take_ctx;
+
+/* Bits written from position `at` on, flushed into `bits` a word at a time */
+typedef struct {
+    uint64_t *bits;
+    int64_t   word;
+    uint64_t  acc;
+} qp_df_bitwriter;
+
+static inline void qp_df_bits_flush(qp_df_bitwriter *w)
+{
+    if (w->acc) {
+        __atomic_fetch_or(&w->bits[w->word], w->acc, __ATOMIC_RELAXED);
+        w->acc = 0;
+    }
+}
+
+static inline void qp_df_bits_set(qp_df_bitwriter *w, int64_t at)
+{
+    if (at >> 6 != w->word) {
+        qp_df_bits_flush(w);
+        w->word = at >> 6;
+    }
+    w->acc |= (uint64_t)1 << (at & 63);
+}
+
+static void qp_df_take_morsel(void *arg, size_t morsel, int64_t begin, int64_t end)
+{
+    qp_df_take_ctx *t = arg;
+    const quicpro_df_column_t *in = t->in;
+    quicpro_df_column_t *out = t->out;
+    const uint64_t *bits = t->sel->bits;
+    int64_t o = t->sel->base[morsel];
+    qp_df_bitwriter valid = { (uint64_t *)out->validity, o >> 6, 0 };
+    qp_df_bitwriter vals = { (uint64_t *)out->values, o >> 6, 0 };
+
+    for (int64_t k = begin >> 6; k < (end + 63) >> 6; k++) {
+        for (uint64_t w = bits[k]; w; w &= w - 1, o++) {
+            int64_t row = (k << 6) + __builtin_ctzll(w);
+            if (out->validity && quicpro_df_valid(in, row)) {
+                qp_df_bits_set(&valid, o);
+            }
+            switch (in->type) {
+                case QUICPRO_DF_INT64:
+                case QUICPRO_DF_FLOAT64:
+                    ((uint64_t *)out->values)[o] = ((const uint64_t *)in->values)[row];
+                    break;
+                case QUICPRO_DF_DICT:
+                    ((int32_t *)out->values)[o] = ((const int32_t *)in->values)[row];
+                    break;
+                case QUICPRO_DF_BOOL:
+                    if (quicpro_df_bit(in->values, row)) qp_df_bits_set(&vals, o);
+                    break;
+                case QUICPRO_DF_UTF8:
+                    break;
+            }
+        }
+    }
+    qp_df_bits_flush(&valid);
+    qp_df_bits_flush(&vals);
+}
+
+static quicpro_df_column_t *qp_df_take_utf8(const quicpro_df_column_t *in, const quicpro_df_selection_t *sel)
+{
+    const int32_t *offsets = in->values;
+    size_t data_len = 0;
+    for (int64_t k = 0; k < (sel->rows + 63) >> 6; k++) {
+        for (uint64_t w = sel->bits[k]; w; w &= w - 1) {
+            int64_t row = (k << 6) + __builtin_ctzll(w);
+            data_len += (size_t)(offsets[row + 1] - offsets[row]);
+        }
+    }
+    quicpro_df_column_t *out = quicpro_df_column_new(QUICPRO_DF_UTF8, sel->count, in->validity != NULL, data_len);
+    if (!out) {
+        return NULL;
+    }
+    int32_t *o_off = out->values;
+    int32_t at = 0;
+    int64_t o = 0;
+    for (int64_t k = 0; k < (sel->rows + 63) >> 6; k++) {
+        for (uint64_t w = sel->bits[k]; w; w &= w - 1, o++) {
+            int64_t row = (k << 6) + __builtin_ctzll(w);
+            int32_t len = offsets[row + 1] - offsets[row];
+            o_off[o] = at;
+            memcpy(out->data + at, in->data + offsets[row], (size_t)len);
+            at += len;
+            if (out->validity && quicpro_df_valid(in, row)) {
+                out->validity[o >> 3] |= (uint8_t)(1u << (o & 7));
+            }
+        }
+    }
+    o_off[o] = at;
+    return out;
+}
+
+static int64_t qp_df_count_unset(const uint8_t *bits, int64_t length)
+{
+    int64_t set = 0;
+    const uint64_t *w = (const uint64_t *)bits;
+    for (int64_t k = 0; k < length >> 6; k++) {
+        set += __builtin_popcountll(w[k]);
+    }
+    for (int64_t i = length & ~(int64_t)63; i < length; i++) {
+        set += quicpro_df_bit(bits, i);
+    }
+    return length - set;
+}
+
+void quicpro_df_column_settle(quicpro_df_column_t *c)
+{
+    if (c->validity) {
+        c->null_count = qp_df_count_unset(c->validity, c->length);
+        qp_df_validity_settle(c);
+    }
+}
+
+quicpro_df_column_t *quicpro_df_column_take(const quicpro_df_column_t *c, const quicpro_df_selection_t *sel)
+{
+    quicpro_df_column_t *out;
+    if (c->type == QUICPRO_DF_UTF8) {
+        out = qp_df_take_utf8(c, sel);
+    } else {
+        out = quicpro_df_column_new(c->type, sel->count, c->validity != NULL, 0);
+        if (out) {
+            qp_df_take_ctx t = { c, out, sel };
+            quicpro_df_parallel(sel->rows, qp_df_take_morsel, &t);
+        }
+    }
+    if (!out) {
+        return NULL;
+    }
+    if (c->type == QUICPRO_DF_DICT) {
+        out->dictionary = quicpro_df_column_addref(c->dictionary);
+    }
+    quicpro_df_column_settle(out);
+    return out;
+}
+
+void quicpro_df_selection_finish(quicpro_df_selection_t *sel, const int64_t *counts)
+{
+    size_t morsels = quicpro_df_morsels(sel->rows);
+    int64_t at = 0;
+    for (size_t m = 0; m < morsels; m++) {
+        sel->base[m] = at;
+        at += counts[m];
+    }
+    sel->count = at;
+}
+
+void quicpro_df_selection_free(quicpro_df_selection_t *sel)
+{
+    free(sel->bits);
+    if (sel->base) efree(sel->base);
+    sel->bits = NULL;
+    sel->base = NULL;
+}
+
+/*──────────────────────────── Concat ─────────────────────────────────────*/
+
+/* The bytes of row `r` of a utf8 column */
+static const char *qp_df_utf8_bytes(const quicpro_df_column_t *c, int64_t r, size_t *len)
+{
+    const int32_t *offsets = c->values;
+    *len = (size_t)(offsets[r + 1] - offsets[r]);
+    return c->data + offsets[r];
+}
+
+quicpro_df_column_t *quicpro_df_column_concat(quicpro_df_column_t *const *parts, size_t n)
+{
+    quicpro_df_type_t type = parts[0]->type;
+    int64_t length = 0;
+    size_t data_len = 0;
+    bool nullable = false;
+
+    /* Strings over more than one dictionary (or none) come out as utf8 */
+    for (size_t i = 1; i < n && type == QUICPRO_DF_DICT; i++) {
+        if (parts[i]->type != QUICPRO_DF_DICT || parts[i]->dictionary != parts[0]->dictionary) {
+            type = QUICPRO_DF_UTF8;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        const quicpro_df_column_t *p = parts[i];
+        length += p->length;
+        nullable |= p->validity != NULL;
+        if (type != QUICPRO_DF_UTF8) {
+            continue;
+        }
+        if (p->type == QUICPRO_DF_UTF8) {
+            const int32_t *offsets = p->values;
+            data_len += (size_t)(offsets[p->length] - offsets[0]);
+            continue;
+        }
+        for (int64_t r = 0; r < p->length; r++) {
+            size_t len = 0;
+            if (quicpro_df_valid(p, r)) {
+                qp_df_utf8_bytes(p->dictionary, ((const int32_t *)p->values)[r], &len);
+            }
+            data_len += len;
+        }
+    }
+    if (data_len > INT32_MAX) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame string columns hold at most 2 GiB");
+        return NULL;
+    }
+    quicpro_df_column_t *out = quicpro_df_column_new(type, length, nullable, data_len);
+    if (!out) {
+        return NULL;
+    }
+
+    int64_t at = 0;
+    int32_t data_at = 0;
+    for (size_t i = 0; i < n; i++) {
+        const quicpro_df_column_t *p = parts[i];
+        for (int64_t r = 0; out->validity && r < p->length; r++) {
+            if (quicpro_df_valid(p, r)) {
+                out->validity[(at + r) >> 3] |= (uint8_t)(1u << ((at + r) & 7));
+            }
+        }
+        switch (type) {
+            case QUICPRO_DF_INT64:
+            case QUICPRO_DF_FLOAT64:
+                memcpy((char *)out->values + at * 8, p->values, (size_t)p->length * 8);
+                break;
+            case QUICPRO_DF_DICT:
+                memcpy((char *)out->values + at * 4, p->values, (size_t)p->length * 4);
+                break;
+            case QUICPRO_DF_BOOL:
+                for (int64_t r = 0; r < p->length; r++) {
+                    if (quicpro_df_bit(p->values, r)) {
+                        ((uint8_t *)out->values)[(at + r) >> 3] |= (uint8_t)(1u << ((at + r) & 7));
+                    }
+                }
+                break;
+            case QUICPRO_DF_UTF8: {
+                int32_t *o_off = out->values;
+                if (p->type == QUICPRO_DF_DICT) {
+                    const int32_t *idx = p->values;
+                    for (int64_t r = 0; r < p->length; r++) {
+                        size_t len = 0;
+                        const char *str = quicpro_df_valid(p, r) ? qp_df_utf8_bytes(p->dictionary, idx[r], &len) : NULL;
+                        o_off[at + r] = data_at;
+                        if (len) {
+                            memcpy(out->data + data_at, str, len);
+                            data_at += (int32_t)len;
+                        }
+                    }
+                    break;
+                }
+                const int32_t *p_off = p->values;
+                for (int64_t r = 0; r < p->length; r++) {
+                    o_off[at + r] = data_at + (p_off[r] - p_off[0]);
+                }
+                memcpy(out->data + data_at, p->data + p_off[0], (size_t)(p_off[p->length] - p_off[0]));
+                data_at += p_off[p->length] - p_off[0];
+                break;
+            }
+        }
+        at += p->length;
+    }
+    if (type == QUICPRO_DF_UTF8) {
+        ((int32_t *)out->values)[length] = data_at;
+    } else if (type == QUICPRO_DF_DICT) {
+        out->dictionary = quicpro_df_column_addref(parts[0]->dictionary);
+    }
+    quicpro_df_column_settle(out);
+    return out;
+}
+
+/*──────────────────────────── Encode ─────────────────────────────────────*/
+
+quicpro_df_column_t *quicpro_df_column_encode(quicpro_df_column_t *c)
+{
+    if (c->type != QUICPRO_DF_UTF8) {
+        return quicpro_df_column_addref(c);
+    }
+    const int32_t *offsets = c->values;
+    HashTable codes;
+    zend_hash_init(&codes, 64, NULL, NULL, 0);
+    quicpro_df_column_t *out = quicpro_df_column_new(QUICPRO_DF_DICT, c->length, c->validity != NULL, 0);
+    if (!out) {
+        zend_hash_destroy(&codes);
+        return NULL;
+    }
+    int64_t *first = safe_emalloc((size_t)MAX(c->length, 1), sizeof(int64_t), 0);
+    int64_t ndistinct = 0;
+    size_t data_len = 0;
+    int32_t *idx = out->values;
+    for (int64_t i = 0; i < c->length; i++) {
+        if (!quicpro_df_valid(c, i)) {
+            continue;
+        }
+        size_t len = (size_t)(offsets[i + 1] - offsets[i]);
+        zval *code = zend_hash_str_find(&codes, c->data + offsets[i], len);
+        if (!code) {
+            zval z;
+            ZVAL_LONG(&z, ndistinct);
+            code = zend_hash_str_add_new(&codes, c->data + offsets[i], len, &z);
+            first[ndistinct++] = i;
+            data_len += len;
+        }
+        idx[i] = (int32_t)Z_LVAL_P(code);
+    }
+    zend_hash_destroy(&codes);
+    if (c->validity) {
+        memcpy(out->validity, c->validity, ((size_t)c->length + 7) / 8);
+        out->null_count = c->null_count;
+    }
+
+    out->dictionary = quicpro_df_column_new(QUICPRO_DF_UTF8, ndistinct, false, data_len);
+    if (!out->dictionary) {
+        efree(first);
+        quicpro_df_column_release(out);
+        return NULL;
+    }
+    int32_t *d_off = out->dictionary->values;
+    int32_t at = 0;
+    for (int64_t j = 0; j < ndistinct; j++) {
+        int32_t len = offsets[first[j] + 1] - offsets[first[j]];
+        d_off[j] = at;
+        memcpy(out->dictionary->data + at, c->data + offsets[first[j]], (size_t)len);
+        at += len;
+    }
+    d_off[ndistinct] = at;
+    efree(first);
+    return out;
+}
@@ -0,0 +1,843 @@
+/*
+ * src/dataframe/dataframe.c – Quicpro\DataFrame
+ * =============================================
+ *
+ * See include/dataframe/dataframe.h. The methods check and resolve their
+ * arguments on the calling thread, then hand whole columns to the kernels
+ * (dataframe/kernels.h, dataframe/group_by.h), which fill new columns
+ * across the morsel threads; PHP values are only built again when a
+ * frame is read back with column() or toArray(). toArrow() and
+ * fromArrow() carry a frame as an Arrow IPC stream (dataframe/arrow_ipc.h).
+ */
+
+#include "php_quicpro.h"
+#include "dataframe/dataframe.h"
+#include "dataframe/arrow_ipc.h"
+#include "dataframe/group_by.h"
+#include "dataframe/kernels.h"
+#include "dataframe/morsel.h"
+#include "dataframe/scan.h"
+#include "config/high_perf_compute_and_ai/base_layer.h"
+
+#include <ext/spl/spl_exceptions.h>
+#include <zend_exceptions.h>
+#include <zend_interfaces.h>
+#include <inttypes.h>
+#include <string.h>
+
+zend_class_entry *quicpro_ce_dataframe;
+static zend_object_handlers quicpro_dataframe_handlers;
+
+#define THIS_DF() quicpro_dataframe_from_obj(Z_OBJ_P(ZEND_THIS))
+
+static bool df_enabled(void)
+{
+    if (!quicpro_high_perf_compute_ai_config.dataframe_enable) {
+        zend_throw_exception(NULL, "Quicpro\\DataFrame is disabled; see quicpro.dataframe_enable", 0);
+        return false;
+    }
+    return true;
+}
+
+/* Releases the first `n` names and columns, and both arrays */
+static void df_columns_free(uint32_t n, zend_string **names, quicpro_df_column_t **cols)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        zend_string_release(names[i]);
+        quicpro_df_column_release(cols[i]);
+    }
+    efree(names);
+    efree(cols);
+}
+
+static int64_t df_find(const quicpro_dataframe_object *df, zend_string *name)
+{
+    for (uint32_t i = 0; i < df->ncols; i++) {
+        if (zend_string_equals(df->names[i], name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Index of column `name`, or -1 after throwing */
+static int64_t df_column_index(const quicpro_dataframe_object *df, zend_string *name)
+{
+    int64_t k = df_find(df, name);
+    if (k < 0) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame has no column '%s'", ZSTR_VAL(name));
+    }
+    return k;
+}
+
+void quicpro_dataframe_wrap(zval *out, int64_t rows, uint32_t ncols, zend_string **names, quicpro_df_column_t **cols)
+{
+    object_init_ex(out, quicpro_ce_dataframe);
+    quicpro_dataframe_object *df = quicpro_dataframe_from_obj(Z_OBJ_P(out));
+    df->rows = rows;
+    df->ncols = ncols;
+    df->names = names;
+    df->cols = cols;
+}
+
+/* A frame of the rows `sel` picked from `df`; false after throwing */
+static bool df_take(zval *out, const quicpro_dataframe_object *df, const quicpro_df_selection_t *sel)
+{
+    zend_string **names = safe_emalloc(MAX(df->ncols, 1), sizeof(zend_string *), 0);
+    quicpro_df_column_t **cols = safe_emalloc(MAX(df->ncols, 1), sizeof(quicpro_df_column_t *), 0);
+    /* Every row, in order: the columns can be shared as they are */
+    bool all = sel->count == df->rows;
+
+    for (uint32_t i = 0; i < df->ncols; i++) {
+        cols[i] = all ? quicpro_df_column_addref(df->cols[i]) : quicpro_df_column_take(df->cols[i], sel);
+        if (!cols[i]) {
+            df_columns_free(i, names, cols);
+            return false;
+        }
+        names[i] = zend_string_copy(df->names[i]);
+    }
+    quicpro_dataframe_wrap(out, sel->count, df->ncols, names, cols);
+    return true;
+}
+
+/*──────────────────────────── Life cycle ─────────────────────────────────*/
+
+static zend_object *df_create(zend_class_entry *ce)
+{
+    quicpro_dataframe_object *df = zend_object_alloc(sizeof(quicpro_dataframe_object), ce);
+    zend_object_std_init(&df->std, ce);
+    object_properties_init(&df->std, ce);
+    df->std.handlers = &quicpro_dataframe_handlers;
+
+    df->rows = 0;
+    df->ncols = 0;
+    df->names = NULL;
+    df->cols = NULL;
+    return &df->std;
+}
+
+static void df_free_obj(zend_object *obj)
+{
+    quicpro_dataframe_object *df = quicpro_dataframe_from_obj(obj);
+    if (df->names) {
+        df_columns_free(df->ncols, df->names, df->cols);
+    }
+    zend_object_std_dtor(obj);
+}
+
+/*──────────────────────────── Construction ───────────────────────────────*/
+
+PHP_METHOD(QuicproDataFrame, fromArrays)
+{
+    HashTable *columns;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT(columns)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (!df_enabled()) RETURN_THROWS();
+
+    uint32_t ncols = zend_hash_num_elements(columns), n = 0;
+    zend_string **names = safe_emalloc(MAX(ncols, 1), sizeof(zend_string *), 0);
+    quicpro_df_column_t **cols = safe_emalloc(MAX(ncols, 1), sizeof(quicpro_df_column_t *), 0);
+    int64_t rows = -1;
+    zend_string *name;
+    zend_ulong idx;
+    zval *list;
+
+    ZEND_HASH_FOREACH_KEY_VAL(columns, idx, name, list) {
+        ZVAL_DEREF(list);
+        if (!name) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame columns are keyed by name; got the integer key " ZEND_ULONG_FMT, idx);
+            goto fail;
+        }
+        if (Z_TYPE_P(list) != IS_ARRAY) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame column '%s' must be an array, got %s", ZSTR_VAL(name), zend_zval_type_name(list));
+            goto fail;
+        }
+        int64_t len = zend_hash_num_elements(Z_ARRVAL_P(list));
+        if (rows >= 0 && len != rows) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame column '%s' has %" PRId64 " rows, the columns before it %" PRId64, ZSTR_VAL(name), len, rows);
+            goto fail;
+        }
+        rows = len;
+
+        zval **cells = safe_emalloc((size_t)MAX(len, 1), sizeof(zval *), 0);
+        int64_t r = 0;
+        zval *cell;
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(list), cell) {
+            cells[r++] = cell;
+        } ZEND_HASH_FOREACH_END();
+        quicpro_df_column_t *c = quicpro_df_column_from_zvals(cells, len, name);
+        efree(cells);
+        if (!c) {
+            goto fail;
+        }
+        names[n] = zend_string_copy(name);
+        cols[n++] = c;
+    } ZEND_HASH_FOREACH_END();
+
+    quicpro_dataframe_wrap(return_value, MAX(rows, 0), n, names, cols);
+    return;
+
+fail:
+    df_columns_free(n, names, cols);
+    RETURN_THROWS();
+}
+
+/* The keys of the first row name the columns; a row without one of them is null there */
+PHP_METHOD(QuicproDataFrame, fromRows)
+{
+    HashTable *rows_ht;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT(rows_ht)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (!df_enabled()) RETURN_THROWS();
+
+    int64_t rows = zend_hash_num_elements(rows_ht), r = 0;
+    HashTable **row = safe_emalloc((size_t)MAX(rows, 1), sizeof(HashTable *), 0);
+    zval *v;
+    ZEND_HASH_FOREACH_VAL(rows_ht, v) {
+        ZVAL_DEREF(v);
+        if (Z_TYPE_P(v) != IS_ARRAY) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame row %" PRId64 " must be an array, got %s", r, zend_zval_type_name(v));
+            efree(row);
+            RETURN_THROWS();
+        }
+        row[r++] = Z_ARRVAL_P(v);
+    } ZEND_HASH_FOREACH_END();
+
+    uint32_t ncols = rows ? zend_hash_num_elements(row[0]) : 0, n = 0;
+    zend_string **names = safe_emalloc(MAX(ncols, 1), sizeof(zend_string *), 0);
+    quicpro_df_column_t **cols = safe_emalloc(MAX(ncols, 1), sizeof(quicpro_df_column_t *), 0);
+    zval **cells = safe_emalloc((size_t)MAX(rows, 1), sizeof(zval *), 0);
+    uint32_t *found = ecalloc((size_t)MAX(rows, 1), sizeof(uint32_t));
+    zend_string *name;
+    zend_ulong idx;
+
+    if (rows) {
+        ZEND_HASH_FOREACH_KEY(row[0], idx, name) {
+            if (!name) {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "DataFrame columns are keyed by name; row 0 has the integer key " ZEND_ULONG_FMT, idx);
+                goto fail;
+            }
+            for (r = 0; r < rows; r++) {
+                cells[r] = zend_hash_find(row[r], name);
+                found[r] += cells[r] != NULL;
+            }
+            quicpro_df_column_t *c = quicpro_df_column_from_zvals(cells, rows, name);
+            if (!c) {
+                goto fail;
+            }
+            names[n] = zend_string_copy(name);
+            cols[n++] = c;
+        } ZEND_HASH_FOREACH_END();
+    }
+    for (r = 0; r < rows; r++) {
+        if (found[r] != zend_hash_num_elements(row[r])) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame row %" PRId64 " has a key row 0 does not have", r);
+            goto fail;
+        }
+    }
+    efree(row);
+    efree(cells);
+    efree(found);
+    quicpro_dataframe_wrap(return_value, rows, n, names, cols);
+    return;
+
+fail:
+    efree(row);
+    efree(cells);
+    efree(found);
+    df_columns_free(n, names, cols);
+    RETURN_THROWS();
+}
+
+/*──────────────────────────── Reading ────────────────────────────────────*/
+
+PHP_METHOD(QuicproDataFrame, count)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    RETURN_LONG((zend_long)THIS_DF()->rows);
+}
+
+PHP_METHOD(QuicproDataFrame, columns)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_dataframe_object *df = THIS_DF();
+    array_init_size(return_value, df->ncols);
+    for (uint32_t i = 0; i < df->ncols; i++) {
+        add_next_index_str(return_value, zend_string_copy(df->names[i]));
+    }
+}
+
+/* Column name => "int64", "float64", "bool", "utf8" or "dictionary" */
+PHP_METHOD(QuicproDataFrame, types)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_dataframe_object *df = THIS_DF();
+    array_init_size(return_value, df->ncols);
+    for (uint32_t i = 0; i < df->ncols; i++) {
+        zval type;
+        ZVAL_STRING(&type, quicpro_df_type_name(df->cols[i]->type));
+        zend_symtable_update(Z_ARRVAL_P(return_value), df->names[i], &type);
+    }
+}
+
+PHP_METHOD(QuicproDataFrame, column)
+{
+    zend_string *name;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_dataframe_object *df = THIS_DF();
+    int64_t k = df_column_index(df, name);
+    if (k < 0) RETURN_THROWS();
+
+    const quicpro_df_column_t *c = df->cols[k];
+    zend_string **strings = quicpro_df_strings_new(c);
+    array_init_size(return_value, (uint32_t)df->rows);
+    for (int64_t r = 0; r < df->rows; r++) {
+        zval cell;
+        quicpro_df_cell(c, r, strings, &cell);
+        add_next_index_zval(return_value, &cell);
+    }
+    quicpro_df_strings_free(c, strings);
+}
+
+PHP_METHOD(QuicproDataFrame, toArray)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_dataframe_object *df = THIS_DF();
+
+    zend_string ***strings = safe_emalloc(MAX(df->ncols, 1), sizeof(zend_string **), 0);
+    for (uint32_t i = 0; i < df->ncols; i++) {
+        strings[i] = quicpro_df_strings_new(df->cols[i]);
+    }
+    array_init_size(return_value, (uint32_t)df->rows);
+    for (int64_t r = 0; r < df->rows; r++) {
+        zval row;
+        array_init_size(&row, df->ncols);
+        for (uint32_t i = 0; i < df->ncols; i++) {
+            zval cell;
+            quicpro_df_cell(df->cols[i], r, strings[i], &cell);
+            zend_symtable_update(Z_ARRVAL(row), df->names[i], &cell);
+        }
+        add_next_index_zval(return_value, &row);
+    }
+    for (uint32_t i = 0; i < df->ncols; i++) {
+        quicpro_df_strings_free(df->cols[i], strings[i]);
+    }
+    efree(strings);
+}
+
+/*──────────────────────────── Operations ─────────────────────────────────*/
+
+PHP_METHOD(QuicproDataFrame, select)
+{
+    HashTable *wanted;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT(wanted)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_dataframe_object *df = THIS_DF();
+    uint32_t ncols = zend_hash_num_elements(wanted), n = 0;
+    zend_string **names = safe_emalloc(MAX(ncols, 1), sizeof(zend_string *), 0);
+    quicpro_df_column_t **cols = safe_emalloc(MAX(ncols, 1), sizeof(quicpro_df_column_t *), 0);
+    zval *v;
+
+    ZEND_HASH_FOREACH_VAL(wanted, v) {
+        ZVAL_DEREF(v);
+        if (Z_TYPE_P(v) != IS_STRING) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame::select() takes column names, got %s", zend_zval_type_name(v));
+            goto fail;
+        }
+        int64_t k = df_column_index(df, Z_STR_P(v));
+        if (k < 0) {
+            goto fail;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (zend_string_equals(names[i], Z_STR_P(v))) {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "DataFrame::select() names column '%s' twice", Z_STRVAL_P(v));
+                goto fail;
+            }
+        }
+        names[n] = zend_string_copy(df->names[k]);
+        cols[n++] = quicpro_df_column_addref(df->cols[k]);
+    } ZEND_HASH_FOREACH_END();
+
+    quicpro_dataframe_wrap(return_value, df->rows, n, names, cols);
+    return;
+
+fail:
+    df_columns_free(n, names, cols);
+    RETURN_THROWS();
+}
+
+PHP_METHOD(QuicproDataFrame, filter)
+{
+    zend_string *column, *op;
+    zval *value;
+
+    ZEND_PARSE_PARAMETERS_START(3, 3)
+        Z_PARAM_STR(column)
+        Z_PARAM_STR(op)
+        Z_PARAM_ZVAL(value)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_dataframe_object *df = THIS_DF();
+    quicpro_df_cmp_t cmp;
+    int64_t k = df_column_index(df, column);
+    if (k < 0) RETURN_THROWS();
+    if (!quicpro_df_cmp_parse(op, &cmp)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "DataFrame::filter(): unknown comparison '%s'; use ==, !=, <, <=, > or >=", ZSTR_VAL(op));
+        RETURN_THROWS();
+    }
+
+    quicpro_df_selection_t sel = {0};
+    bool ok = quicpro_df_filter(df->cols[k], cmp, value, &sel) && df_take(return_value, df, &sel);
+    quicpro_df_selection_free(&sel);
+    if (!ok) RETURN_THROWS();
+}
+
+/* A frame with column `name` (added, or replaced where it exists) set to `left op right` */
+PHP_METHOD(QuicproDataFrame, withColumn)
+{
+    zend_string *name, *left, *op;
+    zval *right;
+
+    ZEND_PARSE_PARAMETERS_START(4, 4)
+        Z_PARAM_STR(name)
+        Z_PARAM_STR(left)
+        Z_PARAM_STR(op)
+        Z_PARAM_ZVAL(right)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (Z_TYPE_P(right) != IS_STRING && Z_TYPE_P(right) != IS_LONG && Z_TYPE_P(right) != IS_DOUBLE) {
+        zend_argument_type_error(4, "must be of type string|int|float, %s given", zend_zval_type_name(right));
+        RETURN_THROWS();
+    }
+
+    quicpro_dataframe_object *df = THIS_DF();
+    quicpro_df_arith_t arith;
+    int64_t a = df_column_index(df, left), b = -1;
+    if (a < 0) RETURN_THROWS();
+    if (Z_TYPE_P(right) == IS_STRING && (b = df_column_index(df, Z_STR_P(right))) < 0) RETURN_THROWS();
+    if (!quicpro_df_arith_parse(op, &arith)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "DataFrame::withColumn(): unknown operator '%s'; use +, -, * or /", ZSTR_VAL(op));
+        RETURN_THROWS();
+    }
+
+    quicpro_df_column_t *c = quicpro_df_arith(df->cols[a], arith, b >= 0 ? df->cols[b] : NULL, b >= 0 ? NULL : right);
+    if (!c) RETURN_THROWS();
+
+    int64_t at = df_find(df, name);
+    uint32_t ncols = df->ncols + (at < 0);
+    zend_string **names = safe_emalloc(ncols, sizeof(zend_string *), 0);
+    quicpro_df_column_t **cols = safe_emalloc(ncols, sizeof(quicpro_df_column_t *), 0);
+    for (uint32_t i = 0; i < df->ncols; i++) {
+        names[i] = zend_string_copy(df->names[i]);
+        cols[i] = (int64_t)i == at ? c : quicpro_df_column_addref(df->cols[i]);
+    }
+    if (at < 0) {
+        names[df->ncols] = zend_string_copy(name);
+        cols[df->ncols] = c;
+    }
+    quicpro_dataframe_wrap(return_value, df->rows, ncols, names, cols);
+}
+
+/* Rows as array_slice() counts them: a negative offset or length counts from the end */
+PHP_METHOD(QuicproDataFrame, slice)
+{
+    zend_long offset, length = 0;
+    bool length_null = true;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_LONG(offset)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG_OR_NULL(length, length_null)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_dataframe_object *df = THIS_DF();
+    int64_t rows = df->rows, begin, end;
+    begin = offset < 0 ? MAX(rows + offset, 0) : MIN((int64_t)offset, rows);
+    if (length_null) {
+        end = rows;
+    } else if (length < 0) {
+        end = rows + length;
+    } else {
+        end = begin + MIN((int64_t)length, rows - begin);
+    }
+    end = MAX(end, begin);
+
+    quicpro_df_selection_t sel = {0};
+    quicpro_df_range(rows, begin, end - begin, &sel);
+    bool ok = sel.bits != NULL;
+    if (!ok) {
+        zend_throw_exception_ex(NULL, 0, "DataFrame: out of memory for a selection of %" PRId64 " rows", rows);
+    }
+    ok = ok && df_take(return_value, df, &sel);
+    quicpro_df_selection_free(&sel);
+    if (!ok) RETURN_THROWS();
+}
+
+/*──────────────────────────── Aggregation ────────────────────────────────*/
+
+/*
+ * Resolves `alias => 'count'` (the rows) and `alias => [function, column]`
+ * entries. The aliases point into `spec`. NULL after throwing.
+ */
+static quicpro_df_agg_t *df_parse_aggs(const quicpro_dataframe_object *df, HashTable *spec, zend_string ***aliases_out)
+{
+    uint32_t n = zend_hash_num_elements(spec), i = 0;
+    quicpro_df_agg_t *aggs = safe_emalloc(MAX(n, 1), sizeof(quicpro_df_agg_t), 0);
+    zend_string **aliases = safe_emalloc(MAX(n, 1), sizeof(zend_string *), 0);
+    zend_string *alias;
+    zend_ulong idx;
+    zval *v;
+
+    ZEND_HASH_FOREACH_KEY_VAL(spec, idx, alias, v) {
+        zend_string *fn_name = NULL, *col_name = NULL;
+        quicpro_df_agg_fn_t fn;
+        (void)idx;
+
+        ZVAL_DEREF(v);
+        if (!alias) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame aggregates are keyed by the name of their result");
+            goto fail;
+        }
+        if (Z_TYPE_P(v) == IS_STRING) {
+            fn_name = Z_STR_P(v);
+        } else if (Z_TYPE_P(v) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL_P(v)) == 2) {
+            zval *f = zend_hash_index_find(Z_ARRVAL_P(v), 0), *c = zend_hash_index_find(Z_ARRVAL_P(v), 1);
+            if (f) ZVAL_DEREF(f);
+            if (c) ZVAL_DEREF(c);
+            if (f && c && Z_TYPE_P(f) == IS_STRING && Z_TYPE_P(c) == IS_STRING) {
+                fn_name = Z_STR_P(f);
+                col_name = Z_STR_P(c);
+            }
+        }
+        if (!fn_name) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame aggregate '%s' must be 'count' or [function, column]", ZSTR_VAL(alias));
+            goto fail;
+        }
+        if (!quicpro_df_agg_parse(fn_name, &fn)) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame aggregate '%s': unknown function '%s'; use count, sum, mean, min or max",
+                ZSTR_VAL(alias), ZSTR_VAL(fn_name));
+            goto fail;
+        }
+        const quicpro_df_column_t *c = NULL;
+        if (col_name) {
+            int64_t k = df_column_index(df, col_name);
+            if (k < 0) {
+                goto fail;
+            }
+            c = df->cols[k];
+            if (!quicpro_df_agg_accepts(fn, c->type)) {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "DataFrame aggregate '%s': %s does not apply to the %s column '%s'",
+                    ZSTR_VAL(alias), ZSTR_VAL(fn_name), quicpro_df_type_name(c->type), ZSTR_VAL(col_name));
+                goto fail;
+            }
+        } else if (fn != QUICPRO_DF_COUNT) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame aggregate '%s': %s needs a column", ZSTR_VAL(alias), ZSTR_VAL(fn_name));
+            goto fail;
+        }
+        aliases[i] = alias;
+        aggs[i].fn = fn;
+        aggs[i++].col = c;
+    } ZEND_HASH_FOREACH_END();
+
+    *aliases_out = aliases;
+    return aggs;
+
+fail:
+    efree(aggs);
+    efree(aliases);
+    return NULL;
+}
+
+/* Alias => value over all rows */
+PHP_METHOD(QuicproDataFrame, aggregate)
+{
+    HashTable *spec;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT(spec)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_dataframe_object *df = THIS_DF();
+    zend_string **aliases;
+    quicpro_df_agg_t *aggs = df_parse_aggs(df, spec, &aliases);
+    if (!aggs) RETURN_THROWS();
+
+    uint32_t n = zend_hash_num_elements(spec);
+    array_init_size(return_value, n);
+    for (uint32_t i = 0; i < n; i++) {
+        quicpro_df_agg_state_t st;
+        zval result;
+        quicpro_df_aggregate(aggs[i].col, df->rows, &st);
+        quicpro_df_agg_result(aggs[i].fn, aggs[i].col ? aggs[i].col->type : QUICPRO_DF_INT64, &st, &result);
+        zend_symtable_update(Z_ARRVAL_P(return_value), aliases[i], &result);
+    }
+    efree(aggs);
+    efree(aliases);
+}
+
+/* A frame of the key columns, then one column per aggregate, with a row per group */
+PHP_METHOD(QuicproDataFrame, groupBy)
+{
+    HashTable *keys_ht = NULL, *spec;
+    zend_string *key_str = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_ARRAY_HT_OR_STR(keys_ht, key_str)
+        Z_PARAM_ARRAY_HT(spec)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_dataframe_object *df = THIS_DF();
+    zend_string *key_names[QUICPRO_DF_GROUP_KEYS_MAX];
+    quicpro_df_column_t *keys[QUICPRO_DF_GROUP_KEYS_MAX];
+    size_t nkeys = 0;
+
+    if (key_str) {
+        key_names[nkeys++] = key_str;
+    } else {
+        zval *v;
+        if (zend_hash_num_elements(keys_ht) == 0 || zend_hash_num_elements(keys_ht) > QUICPRO_DF_GROUP_KEYS_MAX) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame::groupBy() takes 1 to %d key columns", QUICPRO_DF_GROUP_KEYS_MAX);
+            RETURN_THROWS();
+        }
+        ZEND_HASH_FOREACH_VAL(keys_ht, v) {
+            ZVAL_DEREF(v);
+            if (Z_TYPE_P(v) != IS_STRING) {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "DataFrame::groupBy() takes column names, got %s", zend_zval_type_name(v));
+                RETURN_THROWS();
+            }
+            key_names[nkeys++] = Z_STR_P(v);
+        } ZEND_HASH_FOREACH_END();
+    }
+    for (size_t k = 0; k < nkeys; k++) {
+        int64_t i = df_column_index(df, key_names[k]);
+        if (i < 0) RETURN_THROWS();
+        for (size_t j = 0; j < k; j++) {
+            if (zend_string_equals(key_names[j], key_names[k])) {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "DataFrame::groupBy() names key column '%s' twice", ZSTR_VAL(key_names[k]));
+                RETURN_THROWS();
+            }
+        }
+        key_names[k] = df->names[i];
+        keys[k] = df->cols[i];
+    }
+
+    zend_string **aliases;
+    quicpro_df_agg_t *aggs = df_parse_aggs(df, spec, &aliases);
+    if (!aggs) RETURN_THROWS();
+    uint32_t naggs = zend_hash_num_elements(spec);
+    for (uint32_t a = 0; a < naggs; a++) {
+        for (size_t k = 0; k < nkeys; k++) {
+            if (zend_string_equals(aliases[a], key_names[k])) {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "DataFrame aggregate '%s' has the name of a key column", ZSTR_VAL(aliases[a]));
+                efree(aggs);
+                efree(aliases);
+                RETURN_THROWS();
+            }
+        }
+    }
+
+    uint32_t ncols = (uint32_t)nkeys + naggs;
+    zend_string **names = safe_emalloc(ncols, sizeof(zend_string *), 0);
+    quicpro_df_column_t **cols = safe_emalloc(ncols, sizeof(quicpro_df_column_t *), 0);
+    if (!quicpro_df_group_by(keys, nkeys, aggs, naggs, df->rows, cols, cols + nkeys)) {
+        efree(names);
+        efree(cols);
+        efree(aggs);
+        efree(aliases);
+        RETURN_THROWS();
+    }
+    for (size_t k = 0; k < nkeys; k++) {
+        names[k] = zend_string_copy(key_names[k]);
+    }
+    for (uint32_t a = 0; a < naggs; a++) {
+        names[nkeys + a] = zend_string_copy(aliases[a]);
+    }
+    efree(aggs);
+    efree(aliases);
+    quicpro_dataframe_wrap(return_value, cols[0]->length, ncols, names, cols);
+}
+
+/*──────────────────────────── Arrow IPC ──────────────────────────────────*/
+
+PHP_METHOD(QuicproDataFrame, toArrow)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_df_ipc_t ipc;
+    quicpro_df_ipc_plan(THIS_DF(), &ipc);
+    RETVAL_STR(quicpro_df_ipc_flatten(&ipc));
+    quicpro_df_ipc_free(&ipc);
+}
+
+/* The columns point into `ipc` where they can, so it stays alive with them */
+PHP_METHOD(QuicproDataFrame, fromArrow)
+{
+    zend_string *ipc;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(ipc)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (!df_enabled()) RETURN_THROWS();
+    if (!quicpro_df_ipc_decode(ipc, return_value)) RETURN_THROWS();
+}
+
+/*──────────────────────────── Scans ──────────────────────────────────────*/
+
+/* A Quicpro\DataFrame\Scan of the Parquet or Arrow file at `path` (see dataframe/scan.h) */
+PHP_METHOD(QuicproDataFrame, scan)
+{
+    zend_string *path;
+    HashTable *options = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_PATH_STR(path)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_ARRAY_HT(options)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (!df_enabled()) RETURN_THROWS();
+    if (!quicpro_df_scan_open(return_value, path, options)) RETURN_THROWS();
+}
+
+/*──────────────────────────── Registration ───────────────────────────────*/
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_dataframe_from_arrays, 0, 1, Quicpro\\DataFrame, 0)
+    ZEND_ARG_TYPE_INFO(0, columns, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_dataframe_from_rows, 0, 1, Quicpro\\DataFrame, 0)
+    ZEND_ARG_TYPE_INFO(0, rows, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_dataframe_count, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_dataframe_columns, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_quicpro_dataframe_types    arginfo_quicpro_dataframe_columns
+#define arginfo_quicpro_dataframe_to_array arginfo_quicpro_dataframe_columns
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_dataframe_column, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, name, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_dataframe_select, 0, 1, Quicpro\\DataFrame, 0)
+    ZEND_ARG_TYPE_INFO(0, names, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_dataframe_filter, 0, 3, Quicpro\\DataFrame, 0)
+    ZEND_ARG_TYPE_INFO(0, column, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, op, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, value, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_dataframe_with_column, 0, 4, Quicpro\\DataFrame, 0)
+    ZEND_ARG_TYPE_INFO(0, name, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, left, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, op, IS_STRING, 0)
+    ZEND_ARG_TYPE_MASK(0, right, MAY_BE_STRING|MAY_BE_LONG|MAY_BE_DOUBLE, NULL)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_dataframe_slice, 0, 1, Quicpro\\DataFrame, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, length, IS_LONG, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_dataframe_aggregate, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, aggregates, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_dataframe_group_by, 0, 2, Quicpro\\DataFrame, 0)
+    ZEND_ARG_TYPE_MASK(0, keys, MAY_BE_STRING|MAY_BE_ARRAY, NULL)
+    ZEND_ARG_TYPE_INFO(0, aggregates, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_dataframe_to_arrow, 0, 0, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_dataframe_from_arrow, 0, 1, Quicpro\\DataFrame, 0)
+    ZEND_ARG_TYPE_INFO(0, ipc, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_dataframe_scan, 0, 1, Quicpro\\DataFrame\\Scan, 0)
+    ZEND_ARG_TYPE_INFO(0, path, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, options, IS_ARRAY, 0, "[]")
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry quicpro_dataframe_methods[] = {
+    PHP_ME(QuicproDataFrame, fromArrays, arginfo_quicpro_dataframe_from_arrays, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_ME(QuicproDataFrame, fromRows,   arginfo_quicpro_dataframe_from_rows,   ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_ME(QuicproDataFrame, count,      arginfo_quicpro_dataframe_count,       ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrame, columns,    arginfo_quicpro_dataframe_columns,     ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrame, types,      arginfo_quicpro_dataframe_types,       ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrame, column,     arginfo_quicpro_dataframe_column,      ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrame, toArray,    arginfo_quicpro_dataframe_to_array,    ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrame, select,     arginfo_quicpro_dataframe_select,      ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrame, filter,     arginfo_quicpro_dataframe_filter,      ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrame, withColumn, arginfo_quicpro_dataframe_with_column, ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrame, slice,      arginfo_quicpro_dataframe_slice,       ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrame, aggregate,  arginfo_quicpro_dataframe_aggregate,   ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrame, groupBy,    arginfo_quicpro_dataframe_group_by,    ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrame, toArrow,    arginfo_quicpro_dataframe_to_arrow,    ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrame, fromArrow,  arginfo_quicpro_dataframe_from_arrow,  ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_ME(QuicproDataFrame, scan,       arginfo_quicpro_dataframe_scan,        ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_FE_END
+};
+
+void quicpro_dataframe_minit(void)
+{
+    zend_class_entry ce;
+    INIT_NS_CLASS_ENTRY(ce, "Quicpro", "DataFrame", quicpro_dataframe_methods);
+    quicpro_ce_dataframe = zend_register_internal_class(&ce);
+    quicpro_ce_dataframe->ce_flags |= ZEND_ACC_FINAL;
+#ifdef ZEND_ACC_NO_DYNAMIC_PROPERTIES
+    quicpro_ce_dataframe->ce_flags |= ZEND_ACC_NO_DYNAMIC_PROPERTIES;
+#endif
+    quicpro_ce_dataframe->create_object = df_create;
+    zend_class_implements(quicpro_ce_dataframe, 1, zend_ce_countable);
+
+    memcpy(&quicpro_dataframe_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    quicpro_dataframe_handlers.offset = XtOffsetOf(quicpro_dataframe_object, std);
+    quicpro_dataframe_handlers.free_obj = df_free_obj;
+    quicpro_dataframe_handlers.clone_obj = NULL;
+
+    quicpro_df_scan_minit();
+}
+
+void quicpro_dataframe_mshutdown(void)
+{
+    quicpro_df_pool_shutdown();
+}
@@ -0,0 +1,363 @@
+/*
+ * src/dataframe/group_by.c – Grouped aggregation of Quicpro\DataFrame
+ * ===================================================================
+ *
+ * See include/dataframe/group_by.h. A key is one 64-bit word per key
+ * column: the int64 value, the float64 bits (-0.0 and every NaN folded
+ * into one), the bool, or the dictionary index; utf8 keys are encoded as
+ * a dictionary first. A bit per column marks the nulls, whose word is 0.
+ *
+ * A table keeps its groups in an array in the order they were first seen,
+ * and open-addressed slots pointing into it. Merging the morsels' tables
+ * in morsel order therefore leaves the merged one ordered by first row,
+ * and the key columns are gathered from those rows.
+ */
+
+#include "php_quicpro.h"
+#include "dataframe/group_by.h"
+#include "dataframe/morsel.h"
+
+#include <zend_exceptions.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    uint64_t hash;
+    int64_t  first;                     /* The first row of the group */
+    uint64_t nulls;
+    /* int64_t key[nkeys], then quicpro_df_agg_state_t state[naggs] */
+} qp_df_group_t;
+
+typedef struct {
+    size_t         nkeys, naggs, stride;
+    unsigned char *groups;
+    size_t         count, cap;
+    uint32_t      *slots;               /* Group index + 1; 0: free */
+    size_t         mask;
+    bool           failed;
+} qp_df_groups_t;
+
+static inline qp_df_group_t *qp_df_group_at(const qp_df_groups_t *g, size_t i)
+{
+    return (qp_df_group_t *)(g->groups + i * g->stride);
+}
+
+static inline int64_t *qp_df_group_key(qp_df_group_t *e)
+{
+    return (int64_t *)(e + 1);
+}
+
+static inline quicpro_df_agg_state_t *qp_df_group_states(const qp_df_groups_t *g, qp_df_group_t *e)
+{
+    return (quicpro_df_agg_state_t *)(qp_df_group_key(e) + g->nkeys);
+}
+
+static inline uint64_t qp_df_mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 33);
+}
+
+static bool qp_df_groups_init(qp_df_groups_t *g, size_t nkeys, size_t naggs)
+{
+    g->nkeys = nkeys;
+    g->naggs = naggs;
+    g->stride = sizeof(qp_df_group_t) + nkeys * sizeof(int64_t) + naggs * sizeof(quicpro_df_agg_state_t);
+    g->count = 0;
+    g->cap = 64;
+    g->mask = 127;
+    g->groups = malloc(g->cap * g->stride);
+    g->slots = calloc(g->mask + 1, sizeof(uint32_t));
+    g->failed = !g->groups || !g->slots;
+    return !g->failed;
+}
+
+static void qp_df_groups_free(qp_df_groups_t *g)
+{
+    free(g->groups);
+    free(g->slots);
+    g->groups = NULL;
+    g->slots = NULL;
+}
+
+static bool qp_df_groups_grow(qp_df_groups_t *g)
+{
+    if (g->count + 1 > UINT32_MAX - 1) {
+        return false;
+    }
+    if (g->count == g->cap) {
+        unsigned char *groups = realloc(g->groups, g->cap * 2 * g->stride);
+        if (!groups) {
+            return false;
+        }
+        g->groups = groups;
+        g->cap *= 2;
+    }
+    if ((g->count + 1) * 2 > g->mask + 1) {
+        size_t mask = g->mask * 2 + 1;
+        uint32_t *slots = calloc(mask + 1, sizeof(uint32_t));
+        if (!slots) {
+            return false;
+        }
+        for (size_t i = 0; i < g->count; i++) {
+            size_t s = qp_df_group_at(g, i)->hash & mask;
+            while (slots[s]) {
+                s = (s + 1) & mask;
+            }
+            slots[s] = (uint32_t)(i + 1);
+        }
+        free(g->slots);
+        g->slots = slots;
+        g->mask = mask;
+    }
+    return true;
+}
+
+/* The group of `key`, added with `first` if new (`*added`); NULL once out of memory */
+static qp_df_group_t *qp_df_groups_find(qp_df_groups_t *g, uint64_t hash, uint64_t nulls, const int64_t *key,
+                                        int64_t first, bool *added)
+{
+    size_t s = hash & g->mask;
+    *added = false;
+    for (;; s = (s + 1) & g->mask) {
+        uint32_t idx = g->slots[s];
+        if (!idx) {
+            break;
+        }
+        qp_df_group_t *e = qp_df_group_at(g, idx - 1);
+        if (e->hash == hash && e->nulls == nulls && memcmp(qp_df_group_key(e), key, g->nkeys * sizeof(int64_t)) == 0) {
+            return e;
+        }
+    }
+    if (!qp_df_groups_grow(g)) {
+        g->failed = true;
+        return NULL;
+    }
+    /* The slots may have been rebuilt: probe again for a free one */
+    for (s = hash & g->mask; g->slots[s]; s = (s + 1) & g->mask) {}
+    qp_df_group_t *e = qp_df_group_at(g, g->count);
+    g->slots[s] = (uint32_t)++g->count;
+    e->hash = hash;
+    e->first = first;
+    e->nulls = nulls;
+    memcpy(qp_df_group_key(e), key, g->nkeys * sizeof(int64_t));
+    *added = true;
+    return e;
+}
+
+/*──────────────────────────── Morsels ────────────────────────────────────*/
+
+typedef struct {
+    quicpro_df_column_t *const *keys;
+    size_t                      nkeys;
+    const quicpro_df_agg_t     *aggs;
+    size_t                      naggs;
+    qp_df_groups_t             *parts;  /* One per morsel */
+} qp_df_group_ctx;
+
+static inline int64_t qp_df_key_word(const quicpro_df_column_t *c, int64_t row)
+{
+    switch (c->type) {
+        case QUICPRO_DF_INT64:
+            return ((const int64_t *)c->values)[row];
+        case QUICPRO_DF_FLOAT64: {
+            double x = ((const double *)c->values)[row];
+            int64_t bits;
+            x = x == 0 ? 0.0 : isnan(x) ? NAN : x;
+            memcpy(&bits, &x, sizeof(bits));
+            return bits;
+        }
+        case QUICPRO_DF_BOOL:
+            return quicpro_df_bit(c->values, row);
+        case QUICPRO_DF_DICT:
+            return ((const int32_t *)c->values)[row];
+        default:
+            return 0;                   /* utf8 keys were encoded beforehand */
+    }
+}
+
+static uint64_t qp_df_row_key(const qp_df_group_ctx *t, int64_t row, int64_t *key, uint64_t *nulls)
+{
+    uint64_t h = 0x9e3779b97f4a7c15ULL;
+    *nulls = 0;
+    for (size_t k = 0; k < t->nkeys; k++) {
+        const quicpro_df_column_t *c = t->keys[k];
+        if (quicpro_df_valid(c, row)) {
+            key[k] = qp_df_key_word(c, row);
+        } else {
+            key[k] = 0;
+            *nulls |= (uint64_t)1 << k;
+        }
+        h = qp_df_mix(h ^ (uint64_t)key[k]);
+    }
+    return qp_df_mix(h ^ *nulls);
+}
+
+static void qp_df_group_morsel(void *arg, size_t morsel, int64_t begin, int64_t end)
+{
+    qp_df_group_ctx *t = arg;
+    qp_df_groups_t *g = &t->parts[morsel];
+    int64_t key[QUICPRO_DF_GROUP_KEYS_MAX];
+
+    if (!qp_df_groups_init(g, t->nkeys, t->naggs)) {
+        return;
+    }
+    for (int64_t r = begin; r < end; r++) {
+        uint64_t nulls;
+        uint64_t h = qp_df_row_key(t, r, key, &nulls);
+        bool added;
+        qp_df_group_t *e = qp_df_groups_find(g, h, nulls, key, r, &added);
+        if (!e) {
+            return;
+        }
+        quicpro_df_agg_state_t *st = qp_df_group_states(g, e);
+        for (size_t a = 0; a < t->naggs; a++) {
+            const quicpro_df_column_t *c = t->aggs[a].col;
+            if (added) {
+                quicpro_df_agg_init(&st[a]);
+            }
+            if (!c) {
+                st[a].n++;
+            } else if (quicpro_df_valid(c, r)) {
+                quicpro_df_agg_add(&st[a], c, r);
+            }
+        }
+    }
+}
+
+/*──────────────────────────── Output ─────────────────────────────────────*/
+
+static quicpro_df_column_t *qp_df_agg_column(const qp_df_groups_t *g, size_t a, const quicpro_df_agg_t *agg)
+{
+    quicpro_df_type_t in = agg->col ? agg->col->type : QUICPRO_DF_INT64;
+    quicpro_df_type_t type = quicpro_df_agg_type(agg->fn, in);
+    bool nullable = false;
+    for (size_t i = 0; agg->fn != QUICPRO_DF_COUNT && i < g->count && !nullable; i++) {
+        nullable = qp_df_group_states(g, qp_df_group_at(g, i))[a].n == 0;
+    }
+    quicpro_df_column_t *out = quicpro_df_column_new(type, (int64_t)g->count, nullable, 0);
+    if (!out) {
+        return NULL;
+    }
+    for (size_t i = 0; i < g->count; i++) {
+        const quicpro_df_agg_state_t *st = &qp_df_group_states(g, qp_df_group_at(g, i))[a];
+        zval v;
+        quicpro_df_agg_result(agg->fn, in, st, &v);
+        if (Z_TYPE(v) == IS_NULL) {
+            out->null_count++;
+            continue;
+        }
+        if (out->validity) {
+            out->validity[i >> 3] |= (uint8_t)(1u << (i & 7));
+        }
+        if (type == QUICPRO_DF_FLOAT64) {
+            ((double *)out->values)[i] = Z_DVAL(v);
+        } else {
+            ((int64_t *)out->values)[i] = Z_LVAL(v);
+        }
+    }
+    return out;
+}
+
+bool quicpro_df_group_by(quicpro_df_column_t *const *keys, size_t nkeys, const quicpro_df_agg_t *aggs, size_t naggs,
+                         int64_t rows, quicpro_df_column_t **out_keys, quicpro_df_column_t **out_aggs)
+{
+    quicpro_df_column_t *encoded[QUICPRO_DF_GROUP_KEYS_MAX];
+    size_t nencoded = 0;
+    bool ok = true;
+
+    for (; nencoded < nkeys; nencoded++) {
+        encoded[nencoded] = quicpro_df_column_encode(keys[nencoded]);
+        if (!encoded[nencoded]) {
+            ok = false;
+            break;
+        }
+    }
+
+    size_t morsels = quicpro_df_morsels(rows);
+    qp_df_group_ctx t = { encoded, nkeys, aggs, naggs, ok ? ecalloc(MAX(morsels, 1), sizeof(qp_df_groups_t)) : NULL };
+    qp_df_groups_t g = {0};
+    if (ok) {
+        quicpro_df_parallel(rows, qp_df_group_morsel, &t);
+        ok = qp_df_groups_init(&g, nkeys, naggs);
+    }
+
+    /* Morsel order: each group keeps the state and first row of the earliest morsel that saw it */
+    for (size_t m = 0; ok && m < morsels; m++) {
+        qp_df_groups_t *p = &t.parts[m];
+        ok = !p->failed;
+        for (size_t i = 0; ok && i < p->count; i++) {
+            qp_df_group_t *e = qp_df_group_at(p, i);
+            bool added;
+            qp_df_group_t *into = qp_df_groups_find(&g, e->hash, e->nulls, qp_df_group_key(e), e->first, &added);
+            if (!into) {
+                ok = false;
+                break;
+            }
+            quicpro_df_agg_state_t *from = qp_df_group_states(p, e), *st = qp_df_group_states(&g, into);
+            for (size_t a = 0; a < naggs; a++) {
+                if (added) {
+                    st[a] = from[a];
+                } else {
+                    quicpro_df_agg_merge(&st[a], &from[a], aggs[a].col ? aggs[a].col->type : QUICPRO_DF_INT64);
+                }
+            }
+        }
+    }
+    for (size_t m = 0; t.parts && m < morsels; m++) {
+        qp_df_groups_free(&t.parts[m]);
+    }
+    if (t.parts) {
+        efree(t.parts);
+    }
+    if (nencoded == nkeys && !ok && !EG(exception)) {
+        zend_throw_exception_ex(NULL, 0, "DataFrame: out of memory grouping %" PRId64 " rows", rows);
+    }
+
+    /* The key columns, from the first row of each group, which are in ascending order */
+    quicpro_df_selection_t sel = {0};
+    size_t nk = 0, na = 0;
+    if (ok) {
+        size_t words = (size_t)((rows + 63) >> 6);
+        int64_t *counts = ecalloc(MAX(morsels, 1), sizeof(int64_t));
+        sel.rows = rows;
+        sel.bits = calloc(MAX(words, 1), sizeof(uint64_t));
+        sel.base = safe_emalloc(MAX(morsels, 1), sizeof(int64_t), 0);
+        for (size_t i = 0; sel.bits && i < g.count; i++) {
+            int64_t first = qp_df_group_at(&g, i)->first;
+            sel.bits[first >> 6] |= (uint64_t)1 << (first & 63);
+            counts[first / QUICPRO_DF_MORSEL_ROWS]++;
+        }
+        quicpro_df_selection_finish(&sel, counts);
+        efree(counts);
+        ok = sel.bits != NULL;
+        if (!ok) {
+            zend_throw_exception_ex(NULL, 0, "DataFrame: out of memory grouping %" PRId64 " rows", rows);
+        }
+    }
+    for (; ok && nk < nkeys; nk++) {
+        out_keys[nk] = quicpro_df_column_take(keys[nk], &sel);
+        ok = out_keys[nk] != NULL;
+    }
+    for (; ok && na < naggs; na++) {
+        out_aggs[na] = qp_df_agg_column(&g, na, &aggs[na]);
+        ok = out_aggs[na] != NULL;
+    }
+    if (!ok) {
+        /* The one that failed is NULL, which release ignores */
+        while (nk--) quicpro_df_column_release(out_keys[nk]);
+        while (na--) quicpro_df_column_release(out_aggs[na]);
+    }
+
+    quicpro_df_selection_free(&sel);
+    qp_df_groups_free(&g);
+    while (nencoded--) {
+        quicpro_df_column_release(encoded[nencoded]);
+    }
+    return ok;
+}
@@ -0,0 +1,725 @@
+/*
+ * src/dataframe/kernels.c – Vectorized kernels of Quicpro\DataFrame
+ * =================================================================
+ *
+ * See include/dataframe/kernels.h. Everything that needs the engine
+ * (parsing the PHP operand, throwing, allocating the output) happens on
+ * the calling thread before the morsels run; the morsel functions read
+ * their context and write only their own rows and bitmap words. Targets
+ * without AVX2 take the scalar loops, which are written a bitmap word at
+ * a time as well.
+ */
+
+#include "php_quicpro.h"
+#include "dataframe/kernels.h"
+#include "dataframe/morsel.h"
+
+#include <ext/spl/spl_exceptions.h>
+#include <zend_exceptions.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#endif
+
+/*──────────────────────────── Names ──────────────────────────────────────*/
+
+bool quicpro_df_cmp_parse(const zend_string *op, quicpro_df_cmp_t *out)
+{
+    static const char *const names[] = { "==", "!=", "<", "<=", ">", ">=" };
+    for (int i = 0; i < 6; i++) {
+        if (ZSTR_LEN(op) == strlen(names[i]) && memcmp(ZSTR_VAL(op), names[i], ZSTR_LEN(op)) == 0) {
+            *out = (quicpro_df_cmp_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool quicpro_df_arith_parse(const zend_string *op, quicpro_df_arith_t *out)
+{
+    if (ZSTR_LEN(op) != 1 || !strchr("+-*/", ZSTR_VAL(op)[0])) {
+        return false;
+    }
+    *out = (quicpro_df_arith_t)(strchr("+-*/", ZSTR_VAL(op)[0]) - "+-*/");
+    return true;
+}
+
+bool quicpro_df_agg_parse(const zend_string *fn, quicpro_df_agg_fn_t *out)
+{
+    static const char *const names[] = { "count", "sum", "mean", "min", "max" };
+    for (int i = 0; i < 5; i++) {
+        if (ZSTR_LEN(fn) == strlen(names[i]) && memcmp(ZSTR_VAL(fn), names[i], ZSTR_LEN(fn)) == 0) {
+            *out = (quicpro_df_agg_fn_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* The validity word of rows [64k, 64k + 64) with the rows from `end` on cleared */
+static inline uint64_t qp_df_word(const uint8_t *validity, int64_t base, int64_t end)
+{
+    uint64_t w = validity ? ((const uint64_t *)validity)[base >> 6] : ~(uint64_t)0;
+    return end - base < 64 ? w & (((uint64_t)1 << (end - base)) - 1) : w;
+}
+
+/*──────────────────────────── Comparisons ────────────────────────────────*/
+
+typedef enum {
+    QP_DF_MATCH_NONE,                   /* No row */
+    QP_DF_MATCH_VALID,                  /* Every non-null row */
+    QP_DF_MATCH_NULL,                   /* Every null row */
+    QP_DF_MATCH_I64,
+    QP_DF_MATCH_F64,
+    QP_DF_MATCH_BITS,                   /* bool: the values, or their complement */
+    QP_DF_MATCH_UTF8,
+    QP_DF_MATCH_CODE,                   /* dictionary: one index, == or != */
+    QP_DF_MATCH_TABLE,                  /* dictionary: per index */
+} qp_df_match_t;
+
+typedef struct {
+    const quicpro_df_column_t *c;
+    qp_df_match_t              how;
+    quicpro_df_cmp_t           op;
+    int64_t                    i;
+    double                     d;
+    bool                       flip;    /* BITS: complement; CODE: != */
+    const char                *s;
+    size_t                     s_len;
+    const uint8_t             *table;
+    uint64_t                  *bits;
+    int64_t                   *counts;
+} qp_df_filter_ctx;
+
+#define QP_DF_SCALAR_CMP(a, op, b) \
+    ((op) == QUICPRO_DF_EQ ? (a) == (b) : (op) == QUICPRO_DF_NE ? (a) != (b) : \
+     (op) == QUICPRO_DF_LT ? (a) < (b)  : (op) == QUICPRO_DF_LE ? (a) <= (b) : \
+     (op) == QUICPRO_DF_GT ? (a) > (b)  : (a) >= (b))
+
+static uint64_t qp_df_cmp_i64(const int64_t *v, int n, quicpro_df_cmp_t op, int64_t x)
+{
+    uint64_t w = 0;
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i vx = _mm256_set1_epi64x(x);
+    /* AVX2 has == and > only: the rest are their swaps and complements */
+    const unsigned flip = op == QUICPRO_DF_NE || op == QUICPRO_DF_LE || op == QUICPRO_DF_GE ? 0xF : 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(v + i)), m;
+        switch (op) {
+            case QUICPRO_DF_EQ: case QUICPRO_DF_NE: m = _mm256_cmpeq_epi64(a, vx); break;
+            case QUICPRO_DF_LT: case QUICPRO_DF_GE: m = _mm256_cmpgt_epi64(vx, a); break;
+            default:                                m = _mm256_cmpgt_epi64(a, vx); break;
+        }
+        w |= (uint64_t)((unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(m)) ^ flip) << i;
+    }
+#endif
+    for (; i < n; i++) {
+        w |= (uint64_t)QP_DF_SCALAR_CMP(v[i], op, x) << i;
+    }
+    return w;
+}
+
+static uint64_t qp_df_cmp_f64(const double *v, int n, quicpro_df_cmp_t op, double x)
+{
+    uint64_t w = 0;
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256d vx = _mm256_set1_pd(x);
+    for (; i + 4 <= n; i += 4) {
+        __m256d a = _mm256_loadu_pd(v + i), m;
+        /* Ordered predicates, unordered !=: NaN compares as it does in C */
+        switch (op) {
+            case QUICPRO_DF_EQ: m = _mm256_cmp_pd(a, vx, _CMP_EQ_OQ); break;
+            case QUICPRO_DF_NE: m = _mm256_cmp_pd(a, vx, _CMP_NEQ_UQ); break;
+            case QUICPRO_DF_LT: m = _mm256_cmp_pd(a, vx, _CMP_LT_OQ); break;
+            case QUICPRO_DF_LE: m = _mm256_cmp_pd(a, vx, _CMP_LE_OQ); break;
+            case QUICPRO_DF_GT: m = _mm256_cmp_pd(a, vx, _CMP_GT_OQ); break;
+            default:            m = _mm256_cmp_pd(a, vx, _CMP_GE_OQ); break;
+        }
+        w |= (uint64_t)(unsigned)_mm256_movemask_pd(m) << i;
+    }
+#endif
+    for (; i < n; i++) {
+        w |= (uint64_t)QP_DF_SCALAR_CMP(v[i], op, x) << i;
+    }
+    return w;
+}
+
+static uint64_t qp_df_cmp_code(const int32_t *v, int n, int32_t code)
+{
+    uint64_t w = 0;
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i vx = _mm256_set1_epi32(code);
+    for (; i + 8 <= n; i += 8) {
+        __m256i m = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(v + i)), vx);
+        w |= (uint64_t)(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(m)) << i;
+    }
+#endif
+    for (; i < n; i++) {
+        w |= (uint64_t)(v[i] == code) << i;
+    }
+    return w;
+}
+
+static int qp_df_strcmp(const char *a, size_t a_len, const char *b, size_t b_len)
+{
+    int r = memcmp(a, b, MIN(a_len, b_len));
+    return r ? r : (a_len > b_len) - (a_len < b_len);
+}
+
+static void qp_df_filter_morsel(void *arg, size_t morsel, int64_t begin, int64_t end)
+{
+    qp_df_filter_ctx *f = arg;
+    const quicpro_df_column_t *c = f->c;
+    int64_t count = 0;
+
+    for (int64_t base = begin; base < end; base += 64) {
+        int n = (int)MIN(64, end - base);
+        uint64_t valid = qp_df_word(c->validity, base, end), w = 0;
+        switch (f->how) {
+            case QP_DF_MATCH_NONE:
+                break;
+            case QP_DF_MATCH_VALID:
+                w = valid;
+                break;
+            case QP_DF_MATCH_NULL:
+                w = ~valid & qp_df_word(NULL, base, end);
+                valid = ~(uint64_t)0;
+                break;
+            case QP_DF_MATCH_I64:
+                w = qp_df_cmp_i64((const int64_t *)c->values + base, n, f->op, f->i);
+                break;
+            case QP_DF_MATCH_F64:
+                w = qp_df_cmp_f64((const double *)c->values + base, n, f->op, f->d);
+                break;
+            case QP_DF_MATCH_BITS:
+                w = ((const uint64_t *)c->values)[base >> 6];
+                w = f->flip ? ~w : w;
+                break;
+            case QP_DF_MATCH_UTF8: {
+                const int32_t *off = c->values;
+                for (int i = 0; i < n; i++) {
+                    int64_t r = base + i;
+                    int cmp = qp_df_strcmp(c->data + off[r], (size_t)(off[r + 1] - off[r]), f->s, f->s_len);
+                    w |= (uint64_t)QP_DF_SCALAR_CMP(cmp, f->op, 0) << i;
+                }
+                break;
+            }
+            case QP_DF_MATCH_CODE:
+                w = qp_df_cmp_code((const int32_t *)c->values + base, n, (int32_t)f->i);
+                w = f->flip ? ~w : w;
+                break;
+            case QP_DF_MATCH_TABLE: {
+                const int32_t *codes = (const int32_t *)c->values + base;
+                for (int i = 0; i < n; i++) {
+                    w |= (uint64_t)f->table[codes[i]] << i;
+                }
+                break;
+            }
+        }
+        w &= valid;
+        f->bits[base >> 6] = w;
+        count += __builtin_popcountll(w);
+    }
+    f->counts[morsel] = count;
+}
+
+/* An int64 column against a float: the integer bound that picks the same rows, or all or none of them */
+static qp_df_match_t qp_df_int_bound(quicpro_df_cmp_t *op, double x, int64_t *out)
+{
+    const double two63 = 9223372036854775808.0;
+    if (isnan(x)) {
+        return *op == QUICPRO_DF_NE ? QP_DF_MATCH_VALID : QP_DF_MATCH_NONE;
+    }
+    switch (*op) {
+        case QUICPRO_DF_EQ:
+        case QUICPRO_DF_NE:
+            if (x != floor(x) || x >= two63 || x < -two63) {
+                return *op == QUICPRO_DF_NE ? QP_DF_MATCH_VALID : QP_DF_MATCH_NONE;
+            }
+            *out = (int64_t)x;
+            return QP_DF_MATCH_I64;
+        case QUICPRO_DF_LT:
+        case QUICPRO_DF_GE:
+            x = ceil(x);                /* v < 2.5  <=>  v < 3 */
+            if (x >= two63) return *op == QUICPRO_DF_LT ? QP_DF_MATCH_VALID : QP_DF_MATCH_NONE;
+            if (x <= -two63) return *op == QUICPRO_DF_LT ? QP_DF_MATCH_NONE : QP_DF_MATCH_VALID;
+            break;
+        default:
+            x = floor(x);               /* v <= 2.5  <=>  v <= 2 */
+            if (x >= two63) return *op == QUICPRO_DF_LE ? QP_DF_MATCH_VALID : QP_DF_MATCH_NONE;
+            if (x < -two63) return *op == QUICPRO_DF_LE ? QP_DF_MATCH_NONE : QP_DF_MATCH_VALID;
+            break;
+    }
+    *out = (int64_t)x;
+    return QP_DF_MATCH_I64;
+}
+
+/* Sets up `f` for `c op value`; false after throwing */
+static bool qp_df_filter_plan(qp_df_filter_ctx *f, const quicpro_df_column_t *c, quicpro_df_cmp_t op, zval *value, uint8_t **table)
+{
+    ZVAL_DEREF(value);
+    f->c = c;
+    f->op = op;
+    if (Z_TYPE_P(value) == IS_NULL) {
+        if (op != QUICPRO_DF_EQ && op != QUICPRO_DF_NE) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame filters compare with null by == and != only");
+            return false;
+        }
+        f->how = op == QUICPRO_DF_EQ ? QP_DF_MATCH_NULL : QP_DF_MATCH_VALID;
+        return true;
+    }
+
+    switch (c->type) {
+        case QUICPRO_DF_INT64:
+            if (Z_TYPE_P(value) == IS_LONG) {
+                f->how = QP_DF_MATCH_I64;
+                f->i = Z_LVAL_P(value);
+                return true;
+            }
+            if (Z_TYPE_P(value) == IS_DOUBLE) {
+                f->how = qp_df_int_bound(&f->op, Z_DVAL_P(value), &f->i);
+                return true;
+            }
+            break;
+        case QUICPRO_DF_FLOAT64:
+            if (Z_TYPE_P(value) == IS_LONG || Z_TYPE_P(value) == IS_DOUBLE) {
+                f->how = QP_DF_MATCH_F64;
+                f->d = zval_get_double(value);
+                return true;
+            }
+            break;
+        case QUICPRO_DF_BOOL:
+            if ((Z_TYPE_P(value) == IS_TRUE || Z_TYPE_P(value) == IS_FALSE) && (op == QUICPRO_DF_EQ || op == QUICPRO_DF_NE)) {
+                f->how = QP_DF_MATCH_BITS;
+                f->flip = (Z_TYPE_P(value) == IS_TRUE) != (op == QUICPRO_DF_EQ);
+                return true;
+            }
+            break;
+        case QUICPRO_DF_UTF8:
+            if (Z_TYPE_P(value) == IS_STRING) {
+                f->how = QP_DF_MATCH_UTF8;
+                f->s = Z_STRVAL_P(value);
+                f->s_len = Z_STRLEN_P(value);
+                return true;
+            }
+            break;
+        case QUICPRO_DF_DICT:
+            if (Z_TYPE_P(value) == IS_STRING) {
+                const quicpro_df_column_t *d = c->dictionary;
+                const int32_t *off = d->values;
+                if (op == QUICPRO_DF_EQ || op == QUICPRO_DF_NE) {
+                    f->how = op == QUICPRO_DF_EQ ? QP_DF_MATCH_NONE : QP_DF_MATCH_VALID;
+                    for (int64_t j = 0; j < d->length; j++) {
+                        if (qp_df_strcmp(d->data + off[j], (size_t)(off[j + 1] - off[j]), Z_STRVAL_P(value), Z_STRLEN_P(value)) == 0) {
+                            f->how = QP_DF_MATCH_CODE;
+                            f->i = j;
+                            f->flip = op == QUICPRO_DF_NE;
+                            break;
+                        }
+                    }
+                    return true;
+                }
+                /* Null rows index 0, which may not exist: the table always has a slot for it */
+                *table = ecalloc((size_t)MAX(d->length, 1), 1);
+                for (int64_t j = 0; j < d->length; j++) {
+                    int cmp = qp_df_strcmp(d->data + off[j], (size_t)(off[j + 1] - off[j]), Z_STRVAL_P(value), Z_STRLEN_P(value));
+                    (*table)[j] = QP_DF_SCALAR_CMP(cmp, op, 0);
+                }
+                f->how = QP_DF_MATCH_TABLE;
+                f->table = *table;
+                return true;
+            }
+            break;
+    }
+    zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame cannot apply this comparison to a %s column and %s",
+        quicpro_df_type_name(c->type), zend_zval_type_name(value));
+    return false;
+}
+
+static void qp_df_selection_alloc(quicpro_df_selection_t *sel, int64_t rows)
+{
+    size_t words = (size_t)((rows + 63) >> 6);
+    sel->rows = rows;
+    sel->count = 0;
+    sel->bits = calloc(MAX(words, 1), sizeof(uint64_t));
+    sel->base = safe_emalloc(MAX(quicpro_df_morsels(rows), 1), sizeof(int64_t), 0);
+}
+
+bool quicpro_df_filter(const quicpro_df_column_t *c, quicpro_df_cmp_t op, zval *value, quicpro_df_selection_t *sel)
+{
+    qp_df_filter_ctx f = {0};
+    uint8_t *table = NULL;
+    if (!qp_df_filter_plan(&f, c, op, value, &table)) {
+        return false;
+    }
+    qp_df_selection_alloc(sel, c->length);
+    if (!sel->bits) {
+        efree(sel->base);
+        sel->base = NULL;
+        if (table) efree(table);
+        zend_throw_exception_ex(NULL, 0, "DataFrame: out of memory for a selection of %" PRId64 " rows", c->length);
+        return false;
+    }
+    f.bits = sel->bits;
+    f.counts = safe_emalloc(MAX(quicpro_df_morsels(c->length), 1), sizeof(int64_t), 0);
+    quicpro_df_parallel(c->length, qp_df_filter_morsel, &f);
+    quicpro_df_selection_finish(sel, f.counts);
+    efree(f.counts);
+    if (table) efree(table);
+    return true;
+}
+
+void quicpro_df_range(int64_t rows, int64_t offset, int64_t length, quicpro_df_selection_t *sel)
+{
+    offset = MIN(MAX(offset, 0), rows);
+    length = MIN(MAX(length, 0), rows - offset);
+    qp_df_selection_alloc(sel, rows);
+    size_t morsels = quicpro_df_morsels(rows);
+    int64_t *counts = safe_emalloc(MAX(morsels, 1), sizeof(int64_t), 0);
+    for (size_t m = 0; m < morsels; m++) {
+        int64_t begin = (int64_t)m * QUICPRO_DF_MORSEL_ROWS, end = MIN(begin + QUICPRO_DF_MORSEL_ROWS, rows);
+        counts[m] = MAX(0, MIN(end, offset + length) - MAX(begin, offset));
+    }
+    for (int64_t r = offset; sel->bits && r < offset + length; r++) {
+        sel->bits[r >> 6] |= (uint64_t)1 << (r & 63);
+    }
+    quicpro_df_selection_finish(sel, counts);
+    efree(counts);
+}
+
+/*──────────────────────────── Arithmetic ─────────────────────────────────*/
+
+typedef struct {
+    const quicpro_df_column_t *a, *b;
+    quicpro_df_arith_t         op;
+    int64_t                    si;
+    double                     sd;
+    quicpro_df_column_t       *out;
+} qp_df_arith_ctx;
+
+#define QP_DF_ARITH(x, op, y) \
+    ((op) == QUICPRO_DF_ADD ? (x) + (y) : (op) == QUICPRO_DF_SUB ? (x) - (y) : \
+     (op) == QUICPRO_DF_MUL ? (x) * (y) : (x) / (y))
+
+static void qp_df_arith_morsel(void *arg, size_t morsel, int64_t begin, int64_t end)
+{
+    qp_df_arith_ctx *t = arg;
+    const quicpro_df_column_t *a = t->a, *b = t->b;
+    quicpro_df_arith_t op = t->op;
+    (void)morsel;
+
+    if (t->out->type == QUICPRO_DF_INT64) {
+        /* Unsigned, so that overflow wraps instead of being undefined */
+        const uint64_t *x = a->values, *y = b ? b->values : NULL;
+        uint64_t *o = t->out->values, s = (uint64_t)t->si;
+        switch (op) {
+            case QUICPRO_DF_ADD: for (int64_t r = begin; r < end; r++) o[r] = x[r] + (y ? y[r] : s); break;
+            case QUICPRO_DF_SUB: for (int64_t r = begin; r < end; r++) o[r] = x[r] - (y ? y[r] : s); break;
+            default:             for (int64_t r = begin; r < end; r++) o[r] = x[r] * (y ? y[r] : s); break;
+        }
+    } else {
+        double *o = t->out->values;
+        const bool af = a->type == QUICPRO_DF_FLOAT64, bf = b && b->type == QUICPRO_DF_FLOAT64;
+        for (int64_t r = begin; r < end; r++) {
+            double x = af ? ((const double *)a->values)[r] : (double)((const int64_t *)a->values)[r];
+            double y = !b ? t->sd : bf ? ((const double *)b->values)[r] : (double)((const int64_t *)b->values)[r];
+            o[r] = QP_DF_ARITH(x, op, y);
+        }
+    }
+
+    if (t->out->validity) {
+        uint64_t *v = (uint64_t *)t->out->validity;
+        for (int64_t k = begin >> 6; k < (end + 63) >> 6; k++) {
+            v[k] = (a->validity ? ((const uint64_t *)a->validity)[k] : ~(uint64_t)0)
+                 & (b && b->validity ? ((const uint64_t *)b->validity)[k] : ~(uint64_t)0);
+        }
+    }
+}
+
+/* A bool column as 0/1 int64, so the kernel sees numbers only */
+static quicpro_df_column_t *qp_df_as_int(const quicpro_df_column_t *c)
+{
+    quicpro_df_column_t *out = quicpro_df_column_new(QUICPRO_DF_INT64, c->length, c->validity != NULL, 0);
+    if (!out) {
+        return NULL;
+    }
+    for (int64_t r = 0; r < c->length; r++) {
+        ((int64_t *)out->values)[r] = quicpro_df_bit(c->values, r);
+    }
+    if (c->validity) {
+        memcpy(out->validity, c->validity, ((size_t)c->length + 7) / 8);
+        out->null_count = c->null_count;
+    }
+    return out;
+}
+
+static bool qp_df_numeric(quicpro_df_type_t type)
+{
+    return type == QUICPRO_DF_INT64 || type == QUICPRO_DF_FLOAT64 || type == QUICPRO_DF_BOOL;
+}
+
+quicpro_df_column_t *quicpro_df_arith(const quicpro_df_column_t *a, quicpro_df_arith_t op,
+                                      const quicpro_df_column_t *b, zval *scalar)
+{
+    if (scalar) {
+        ZVAL_DEREF(scalar);
+    }
+    if (!qp_df_numeric(a->type) || (b && !qp_df_numeric(b->type))
+        || (!b && Z_TYPE_P(scalar) != IS_LONG && Z_TYPE_P(scalar) != IS_DOUBLE)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame arithmetic takes int64, float64 and bool columns and numbers, not %s and %s",
+            quicpro_df_type_name(a->type), b ? quicpro_df_type_name(b->type) : zend_zval_type_name(scalar));
+        return NULL;
+    }
+
+    quicpro_df_column_t *ai = a->type == QUICPRO_DF_BOOL ? qp_df_as_int(a) : NULL;
+    quicpro_df_column_t *bi = b && b->type == QUICPRO_DF_BOOL ? qp_df_as_int(b) : NULL;
+    qp_df_arith_ctx t = { ai ? ai : a, bi ? bi : b, op, 0, 0, NULL };
+    quicpro_df_column_t *out = NULL;
+    if ((a->type != QUICPRO_DF_BOOL || ai) && (!b || b->type != QUICPRO_DF_BOOL || bi)) {
+        bool floats = op == QUICPRO_DF_DIV || t.a->type == QUICPRO_DF_FLOAT64
+            || (b ? t.b->type == QUICPRO_DF_FLOAT64 : Z_TYPE_P(scalar) == IS_DOUBLE);
+        if (!b) {
+            t.si = Z_TYPE_P(scalar) == IS_LONG ? Z_LVAL_P(scalar) : 0;
+            t.sd = zval_get_double(scalar);
+        }
+        out = quicpro_df_column_new(floats ? QUICPRO_DF_FLOAT64 : QUICPRO_DF_INT64, a->length,
+                                    t.a->validity || (t.b && t.b->validity), 0);
+    }
+    if (out) {
+        t.out = out;
+        quicpro_df_parallel(a->length, qp_df_arith_morsel, &t);
+        quicpro_df_column_settle(out);
+    }
+    quicpro_df_column_release(ai);
+    quicpro_df_column_release(bi);
+    return out;
+}
+
+/*──────────────────────────── Aggregates ─────────────────────────────────*/
+
+bool quicpro_df_agg_accepts(quicpro_df_agg_fn_t fn, quicpro_df_type_t type)
+{
+    switch (fn) {
+        case QUICPRO_DF_COUNT: return true;
+        case QUICPRO_DF_SUM:
+        case QUICPRO_DF_MEAN:  return qp_df_numeric(type);
+        default:               return type == QUICPRO_DF_INT64 || type == QUICPRO_DF_FLOAT64;
+    }
+}
+
+void quicpro_df_agg_init(quicpro_df_agg_state_t *st)
+{
+    memset(st, 0, sizeof(*st));
+}
+
+void quicpro_df_agg_merge(quicpro_df_agg_state_t *into, const quicpro_df_agg_state_t *from, quicpro_df_type_t type)
+{
+    if (from->n == 0) {
+        return;
+    }
+    if (into->n == 0) {
+        *into = *from;
+        return;
+    }
+    into->n += from->n;
+    if (type == QUICPRO_DF_FLOAT64) {
+        into->sum.d += from->sum.d;
+        into->min.d = MIN(into->min.d, from->min.d);
+        into->max.d = MAX(into->max.d, from->max.d);
+    } else {
+        into->sum.i = (int64_t)((uint64_t)into->sum.i + (uint64_t)from->sum.i);
+        into->min.i = MIN(into->min.i, from->min.i);
+        into->max.i = MAX(into->max.i, from->max.i);
+    }
+}
+
+static void qp_df_agg_i64(quicpro_df_agg_state_t *st, const quicpro_df_column_t *c, int64_t begin, int64_t end)
+{
+    const int64_t *v = c->values;
+    quicpro_df_agg_state_t part = { .n = 0, .sum.i = 0, .min.i = INT64_MAX, .max.i = INT64_MIN };
+    uint64_t sum = 0;
+    int64_t mn = INT64_MAX, mx = INT64_MIN;
+    for (int64_t base = begin; base < end; base += 64) {
+        uint64_t w = qp_df_word(c->validity, base, end);
+        if (w == ~(uint64_t)0) {
+            for (int i = 0; i < 64; i++) {
+                int64_t x = v[base + i];
+                sum += (uint64_t)x;
+                mn = x < mn ? x : mn;
+                mx = x > mx ? x : mx;
+            }
+            part.n += 64;
+            continue;
+        }
+        for (; w; w &= w - 1) {
+            int64_t x = v[base + __builtin_ctzll(w)];
+            sum += (uint64_t)x;
+            mn = x < mn ? x : mn;
+            mx = x > mx ? x : mx;
+            part.n++;
+        }
+    }
+    part.sum.i = (int64_t)sum;
+    part.min.i = mn;
+    part.max.i = mx;
+    quicpro_df_agg_merge(st, &part, QUICPRO_DF_INT64);
+}
+
+static void qp_df_agg_f64(quicpro_df_agg_state_t *st, const quicpro_df_column_t *c, int64_t begin, int64_t end)
+{
+    const double *v = c->values;
+    quicpro_df_agg_state_t part = { .n = 0 };
+    double sum = 0, mn = INFINITY, mx = -INFINITY;
+    for (int64_t base = begin; base < end; base += 64) {
+        uint64_t w = qp_df_word(c->validity, base, end);
+        if (w == ~(uint64_t)0) {
+            /* Four sums, so that the adds of one word do not wait on each other */
+            double s[4] = {0, 0, 0, 0};
+            for (int i = 0; i < 64; i += 4) {
+                for (int j = 0; j < 4; j++) {
+                    double x = v[base + i + j];
+                    s[j] += x;
+                    mn = x < mn ? x : mn;
+                    mx = x > mx ? x : mx;
+                }
+            }
+            sum += (s[0] + s[1]) + (s[2] + s[3]);
+            part.n += 64;
+            continue;
+        }
+        for (; w; w &= w - 1) {
+            double x = v[base + __builtin_ctzll(w)];
+            sum += x;
+            mn = x < mn ? x : mn;
+            mx = x > mx ? x : mx;
+            part.n++;
+        }
+    }
+    part.sum.d = sum;
+    part.min.d = mn;
+    part.max.d = mx;
+    quicpro_df_agg_merge(st, &part, QUICPRO_DF_FLOAT64);
+}
+
+void quicpro_df_agg_update(quicpro_df_agg_state_t *st, const quicpro_df_column_t *c, int64_t begin, int64_t end)
+{
+    quicpro_df_agg_state_t part = { .n = 0 };
+    if (!c) {
+        part.n = end - begin;
+        quicpro_df_agg_merge(st, &part, QUICPRO_DF_INT64);
+        return;
+    }
+    switch (c->type) {
+        case QUICPRO_DF_INT64:
+            qp_df_agg_i64(st, c, begin, end);
+            return;
+        case QUICPRO_DF_FLOAT64:
+            qp_df_agg_f64(st, c, begin, end);
+            return;
+        case QUICPRO_DF_BOOL:
+            part.min.i = 1;
+            for (int64_t base = begin; base < end; base += 64) {
+                uint64_t w = qp_df_word(c->validity, base, end);
+                uint64_t t = w & ((const uint64_t *)c->values)[base >> 6];
+                part.n += __builtin_popcountll(w);
+                part.sum.i += __builtin_popcountll(t);
+                part.min.i &= (t == w);
+                part.max.i |= t != 0;
+            }
+            break;
+        default:
+            for (int64_t base = begin; base < end; base += 64) {
+                part.n += __builtin_popcountll(qp_df_word(c->validity, base, end));
+            }
+            break;
+    }
+    quicpro_df_agg_merge(st, &part, c->type);
+}
+
+void quicpro_df_agg_add(quicpro_df_agg_state_t *st, const quicpro_df_column_t *c, int64_t row)
+{
+    if (c->type == QUICPRO_DF_FLOAT64) {
+        double x = ((const double *)c->values)[row];
+        if (st->n++ == 0) {
+            st->sum.d = st->min.d = st->max.d = x;
+            return;
+        }
+        st->sum.d += x;
+        st->min.d = x < st->min.d ? x : st->min.d;
+        st->max.d = x > st->max.d ? x : st->max.d;
+        return;
+    }
+    int64_t x = c->type == QUICPRO_DF_INT64 ? ((const int64_t *)c->values)[row]
+              : c->type == QUICPRO_DF_BOOL ? quicpro_df_bit(c->values, row) : 0;
+    if (st->n++ == 0) {
+        st->sum.i = st->min.i = st->max.i = x;
+        return;
+    }
+    st->sum.i = (int64_t)((uint64_t)st->sum.i + (uint64_t)x);
+    st->min.i = x < st->min.i ? x : st->min.i;
+    st->max.i = x > st->max.i ? x : st->max.i;
+}
+
+quicpro_df_type_t quicpro_df_agg_type(quicpro_df_agg_fn_t fn, quicpro_df_type_t type)
+{
+    switch (fn) {
+        case QUICPRO_DF_COUNT: return QUICPRO_DF_INT64;
+        case QUICPRO_DF_MEAN:  return QUICPRO_DF_FLOAT64;
+        default:               return type == QUICPRO_DF_FLOAT64 ? QUICPRO_DF_FLOAT64 : QUICPRO_DF_INT64;
+    }
+}
+
+void quicpro_df_agg_result(quicpro_df_agg_fn_t fn, quicpro_df_type_t type, const quicpro_df_agg_state_t *st, zval *out)
+{
+    bool f = type == QUICPRO_DF_FLOAT64;
+    if (fn == QUICPRO_DF_COUNT) {
+        ZVAL_LONG(out, (zend_long)st->n);
+    } else if (st->n == 0) {
+        ZVAL_NULL(out);
+    } else if (fn == QUICPRO_DF_MEAN) {
+        ZVAL_DOUBLE(out, (f ? st->sum.d : (double)st->sum.i) / (double)st->n);
+    } else {
+        const quicpro_df_agg_state_t s = *st;
+        int64_t i = fn == QUICPRO_DF_SUM ? s.sum.i : fn == QUICPRO_DF_MIN ? s.min.i : s.max.i;
+        double d = fn == QUICPRO_DF_SUM ? s.sum.d : fn == QUICPRO_DF_MIN ? s.min.d : s.max.d;
+        if (f) {
+            ZVAL_DOUBLE(out, d);
+        } else {
+            ZVAL_LONG(out, (zend_long)i);
+        }
+    }
+}
+
+typedef struct {
+    const quicpro_df_column_t *c;
+    quicpro_df_agg_state_t    *parts;
+} qp_df_aggregate_ctx;
+
+static void qp_df_aggregate_morsel(void *arg, size_t morsel, int64_t begin, int64_t end)
+{
+    qp_df_aggregate_ctx *t = arg;
+    quicpro_df_agg_update(&t->parts[morsel], t->c, begin, end);
+}
+
+void quicpro_df_aggregate(const quicpro_df_column_t *c, int64_t rows, quicpro_df_agg_state_t *out)
+{
+    size_t morsels = quicpro_df_morsels(rows);
+    qp_df_aggregate_ctx t = { c, safe_emalloc(MAX(morsels, 1), sizeof(quicpro_df_agg_state_t), 0) };
+    for (size_t m = 0; m < morsels; m++) {
+        quicpro_df_agg_init(&t.parts[m]);
+    }
+    quicpro_df_parallel(rows, qp_df_aggregate_morsel, &t);
+    quicpro_df_agg_init(out);
+    /* In morsel order, so that float sums come out the same on every run */
+    for (size_t m = 0; m < morsels; m++) {
+        quicpro_df_agg_merge(out, &t.parts[m], c ? c->type : QUICPRO_DF_INT64);
+    }
+    efree(t.parts);
+}
@@ -0,0 +1,175 @@
+/*
+ * src/dataframe/morsel.c – Morsel-driven parallelism for DataFrame kernels
+ * ========================================================================
+ *
+ * See include/dataframe/morsel.h. One job runs at a time: the caller
+ * publishes it under `lock` with a new generation, works along, and waits
+ * until every morsel is done and no thread still holds the job, so a
+ * thread late to wake can never run the next job's morsels with this
+ * one's function.
+ */
+
+#include "php_quicpro.h"
+#include "dataframe/morsel.h"
+#include "config/high_perf_compute_and_ai/base_layer.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#define QP_DF_THREADS_MAX 63
+
+static struct {
+    pthread_mutex_t      lock;
+    pthread_cond_t       wake, done;
+    pid_t                pid;                   /* 0: not started in this process */
+    unsigned             nthreads;
+    bool                 stopping;
+
+    /* The job, valid while `fn` is set */
+    quicpro_df_morsel_fn fn;
+    void                *ctx;
+    int64_t              rows;
+    size_t               morsels;
+    atomic_size_t        next;
+    atomic_size_t        left;                  /* Morsels not done yet */
+    unsigned             busy;                  /* Threads holding the job */
+    uint64_t             generation;
+
+    pthread_t            threads[QP_DF_THREADS_MAX];
+} qp_df_pool;
+
+static void qp_df_run_morsels(quicpro_df_morsel_fn fn, void *ctx, int64_t rows, size_t morsels)
+{
+    for (;;) {
+        size_t m = atomic_fetch_add_explicit(&qp_df_pool.next, 1, memory_order_relaxed);
+        if (m >= morsels) {
+            return;
+        }
+        int64_t begin = (int64_t)m * QUICPRO_DF_MORSEL_ROWS;
+        fn(ctx, m, begin, MIN(begin + QUICPRO_DF_MORSEL_ROWS, rows));
+        if (atomic_fetch_sub_explicit(&qp_df_pool.left, 1, memory_order_acq_rel) == 1) {
+            pthread_mutex_lock(&qp_df_pool.lock);
+            pthread_cond_signal(&qp_df_pool.done);
+            pthread_mutex_unlock(&qp_df_pool.lock);
+        }
+    }
+}
+
+static void *qp_df_worker(void *arg)
+{
+    uint64_t seen = 0;
+    (void)arg;
+
+    pthread_mutex_lock(&qp_df_pool.lock);
+    for (;;) {
+        while (!qp_df_pool.stopping && (!qp_df_pool.fn || qp_df_pool.generation == seen)) {
+            pthread_cond_wait(&qp_df_pool.wake, &qp_df_pool.lock);
+        }
+        if (qp_df_pool.stopping) {
+            break;
+        }
+        seen = qp_df_pool.generation;
+        quicpro_df_morsel_fn fn = qp_df_pool.fn;
+        void *ctx = qp_df_pool.ctx;
+        int64_t rows = qp_df_pool.rows;
+        size_t morsels = qp_df_pool.morsels;
+        qp_df_pool.busy++;
+        pthread_mutex_unlock(&qp_df_pool.lock);
+
+        qp_df_run_morsels(fn, ctx, rows, morsels);
+
+        pthread_mutex_lock(&qp_df_pool.lock);
+        if (--qp_df_pool.busy == 0) {
+            pthread_cond_signal(&qp_df_pool.done);
+        }
+    }
+    pthread_mutex_unlock(&qp_df_pool.lock);
+    return NULL;
+}
+
+/* Threads for this process, started on first use; false to run on the caller alone */
+static bool qp_df_pool_ready(void)
+{
+    if (qp_df_pool.pid == getpid()) {
+        return qp_df_pool.nthreads > 0;
+    }
+    /* Never started, or inherited from the parent, whose threads did not come along */
+    pthread_mutex_init(&qp_df_pool.lock, NULL);
+    pthread_cond_init(&qp_df_pool.wake, NULL);
+    pthread_cond_init(&qp_df_pool.done, NULL);
+    qp_df_pool.pid = getpid();
+    qp_df_pool.nthreads = 0;
+    qp_df_pool.stopping = false;
+    qp_df_pool.fn = NULL;
+    qp_df_pool.busy = 0;
+
+    long n = (long)quicpro_high_perf_compute_ai_config.dataframe_cpu_parallelism_default;
+    if (n <= 0) {
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    n = MIN(MAX(n - 1, 0), QP_DF_THREADS_MAX);
+    for (long i = 0; i < n; i++) {
+        if (pthread_create(&qp_df_pool.threads[i], NULL, qp_df_worker, NULL) != 0) {
+            break;
+        }
+        qp_df_pool.nthreads++;
+    }
+    return qp_df_pool.nthreads > 0;
+}
+
+void quicpro_df_parallel(int64_t rows, quicpro_df_morsel_fn fn, void *ctx)
+{
+    size_t morsels = quicpro_df_morsels(rows);
+    if (morsels == 0) {
+        return;
+    }
+    if (morsels == 1 || !qp_df_pool_ready()) {
+        for (size_t m = 0; m < morsels; m++) {
+            int64_t begin = (int64_t)m * QUICPRO_DF_MORSEL_ROWS;
+            fn(ctx, m, begin, MIN(begin + QUICPRO_DF_MORSEL_ROWS, rows));
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&qp_df_pool.lock);
+    qp_df_pool.fn = fn;
+    qp_df_pool.ctx = ctx;
+    qp_df_pool.rows = rows;
+    qp_df_pool.morsels = morsels;
+    atomic_store(&qp_df_pool.next, 0);
+    atomic_store(&qp_df_pool.left, morsels);
+    qp_df_pool.generation++;
+    pthread_cond_broadcast(&qp_df_pool.wake);
+    pthread_mutex_unlock(&qp_df_pool.lock);
+
+    qp_df_run_morsels(fn, ctx, rows, morsels);
+
+    pthread_mutex_lock(&qp_df_pool.lock);
+    while (atomic_load(&qp_df_pool.left) > 0 || qp_df_pool.busy > 0) {
+        pthread_cond_wait(&qp_df_pool.done, &qp_df_pool.lock);
+    }
+    qp_df_pool.fn = NULL;
+    pthread_mutex_unlock(&qp_df_pool.lock);
+}
+
+void quicpro_df_pool_shutdown(void)
+{
+    if (qp_df_pool.pid != getpid()) {
+        return;
+    }
+    pthread_mutex_lock(&qp_df_pool.lock);
+    qp_df_pool.stopping = true;
+    pthread_cond_broadcast(&qp_df_pool.wake);
+    pthread_mutex_unlock(&qp_df_pool.lock);
+
+    for (unsigned i = 0; i < qp_df_pool.nthreads; i++) {
+        pthread_join(qp_df_pool.threads[i], NULL);
+    }
+    pthread_cond_destroy(&qp_df_pool.done);
+    pthread_cond_destroy(&qp_df_pool.wake);
+    pthread_mutex_destroy(&qp_df_pool.lock);
+    qp_df_pool.pid = 0;
+    qp_df_pool.nthreads = 0;
+}
@@ -0,0 +1,1265 @@
+/*
+ * src/dataframe/parquet.c – Parquet files for Quicpro\DataFrame scans
+ * ===================================================================
+ *
+ * See include/dataframe/parquet.h. The footer and the page headers are
+ * Thrift structs in the compact protocol, read here field by field with
+ * every length checked against the bytes that hold it; fields this reader
+ * has no use for are skipped. A column chunk is decoded page by page into
+ * the buffers of one column of the whole row group.
+ */
+
+#include "php_quicpro.h"
+#include "dataframe/parquet.h"
+#include "dataframe/column.h"
+#include "config/high_perf_compute_and_ai/base_layer.h"
+
+#include <ext/spl/spl_exceptions.h>
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+#include <math.h>
+#include <string.h>
+
+#ifdef QUICPRO_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef QUICPRO_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/* Thrift compact protocol types */
+#define QP_TC_STOP    0
+#define QP_TC_TRUE    1
+#define QP_TC_FALSE   2
+#define QP_TC_BYTE    3
+#define QP_TC_I16     4
+#define QP_TC_I32     5
+#define QP_TC_I64     6
+#define QP_TC_DOUBLE  7
+#define QP_TC_BINARY  8
+#define QP_TC_LIST    9
+#define QP_TC_SET     10
+#define QP_TC_MAP     11
+#define QP_TC_STRUCT  12
+
+/* Physical types */
+#define QP_PQ_BOOLEAN    0
+#define QP_PQ_INT32      1
+#define QP_PQ_INT64      2
+#define QP_PQ_INT96      3
+#define QP_PQ_FLOAT      4
+#define QP_PQ_DOUBLE     5
+#define QP_PQ_BYTE_ARRAY 6
+
+/* FieldRepetitionType */
+#define QP_PQ_REPEATED 2
+
+/* Encodings */
+#define QP_PQ_PLAIN            0
+#define QP_PQ_PLAIN_DICTIONARY 2
+#define QP_PQ_RLE              3
+#define QP_PQ_RLE_DICTIONARY   8
+
+/* Codecs */
+#define QP_PQ_UNCOMPRESSED 0
+#define QP_PQ_SNAPPY       1
+#define QP_PQ_GZIP         2
+#define QP_PQ_ZSTD         6
+
+/* Page types */
+#define QP_PQ_DATA_PAGE       0
+#define QP_PQ_DICTIONARY_PAGE 2
+#define QP_PQ_DATA_PAGE_V2    3
+
+static inline uint64_t qp_pq_load(const uint8_t *p, size_t size)
+{
+    uint64_t v = 0;
+    memcpy(&v, p, size);
+    return v;
+}
+
+static bool qp_pq_malformed(const char *what)
+{
+    zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame: malformed Parquet file (%s)", what);
+    return false;
+}
+
+static bool qp_pq_unsupported(const char *what)
+{
+    zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame: Parquet file with %s is not supported", what);
+    return false;
+}
+
+/*──────────────────────────── Thrift compact reader ──────────────────────*/
+
+typedef struct {
+    const uint8_t *p, *end;
+    unsigned       depth;
+    bool           bad;
+} qp_tc;
+
+static bool qp_tc_varint(qp_tc *t, uint64_t *out)
+{
+    uint64_t v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (t->p >= t->end) {
+            break;
+        }
+        uint8_t b = *t->p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return true;
+        }
+    }
+    t->bad = true;
+    return false;
+}
+
+static bool qp_tc_zigzag(qp_tc *t, int64_t *out)
+{
+    uint64_t v;
+    if (!qp_tc_varint(t, &v)) {
+        return false;
+    }
+    *out = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    return true;
+}
+
+/* The next field of a struct, `id` holding the previous one's; false at its end or when malformed */
+static bool qp_tc_field(qp_tc *t, int16_t *id, uint8_t *type)
+{
+    if (t->bad || t->p >= t->end) {
+        t->bad = true;
+        return false;
+    }
+    uint8_t b = *t->p++;
+    if (b == QP_TC_STOP) {
+        return false;
+    }
+    *type = b & 0x0f;
+    if (b >> 4) {
+        *id = (int16_t)(*id + (b >> 4));
+    } else {
+        int64_t v;
+        if (!qp_tc_zigzag(t, &v)) {
+            return false;
+        }
+        *id = (int16_t)v;
+    }
+    return true;
+}
+
+static void qp_tc_skip(qp_tc *t, uint8_t type);
+
+/* The header of a list or set: its element type and length */
+static bool qp_tc_list(qp_tc *t, uint8_t type, uint8_t *etype, uint32_t *n)
+{
+    if (type != QP_TC_LIST && type != QP_TC_SET) {
+        qp_tc_skip(t, type);
+        return false;
+    }
+    if (t->p >= t->end) {
+        t->bad = true;
+        return false;
+    }
+    uint8_t b = *t->p++;
+    uint64_t size = b >> 4;
+    *etype = b & 0x0f;
+    if (size == 15 && !qp_tc_varint(t, &size)) {
+        return false;
+    }
+    if (size > (uint64_t)(t->end - t->p)) {     /* Every element takes a byte at least */
+        t->bad = true;
+        return false;
+    }
+    *n = (uint32_t)size;
+    return true;
+}
+
+static void qp_tc_skip(qp_tc *t, uint8_t type)
+{
+    uint64_t n;
+    if (t->bad || ++t->depth > 32) {
+        t->bad = true;
+        return;
+    }
+    switch (type) {
+        case QP_TC_TRUE:
+        case QP_TC_FALSE:
+            break;
+        case QP_TC_BYTE:
+            t->bad |= t->p >= t->end;
+            t->p += !t->bad;
+            break;
+        case QP_TC_I16:
+        case QP_TC_I32:
+        case QP_TC_I64:
+            qp_tc_varint(t, &n);
+            break;
+        case QP_TC_DOUBLE:
+            t->bad |= t->end - t->p < 8;
+            t->p += t->bad ? 0 : 8;
+            break;
+        case QP_TC_BINARY:
+            if (qp_tc_varint(t, &n)) {
+                t->bad |= n > (uint64_t)(t->end - t->p);
+                t->p += t->bad ? 0 : n;
+            }
+            break;
+        case QP_TC_LIST:
+        case QP_TC_SET: {
+            uint8_t etype;
+            uint32_t count;
+            if (qp_tc_list(t, type, &etype, &count)) {
+                for (uint32_t i = 0; i < count && !t->bad; i++) {
+                    /* A bool element is a byte of its own */
+                    qp_tc_skip(t, etype == QP_TC_TRUE || etype == QP_TC_FALSE ? QP_TC_BYTE : etype);
+                }
+            }
+            break;
+        }
+        case QP_TC_MAP:
+            if (qp_tc_varint(t, &n) && n) {
+                if (t->p >= t->end) {
+                    t->bad = true;
+                    break;
+                }
+                uint8_t kv = *t->p++;
+                for (uint64_t i = 0; i < n && !t->bad; i++) {
+                    qp_tc_skip(t, kv >> 4);
+                    qp_tc_skip(t, kv & 0x0f);
+                }
+            }
+            break;
+        case QP_TC_STRUCT: {
+            int16_t id = 0;
+            uint8_t ft;
+            while (qp_tc_field(t, &id, &ft)) {
+                qp_tc_skip(t, ft);
+            }
+            break;
+        }
+        default:
+            t->bad = true;
+    }
+    t->depth--;
+}
+
+/* An integer (or bool) field's value; other types are skipped as 0 */
+static int64_t qp_tc_int(qp_tc *t, uint8_t type)
+{
+    int64_t v = 0;
+    switch (type) {
+        case QP_TC_TRUE:
+            return 1;
+        case QP_TC_BYTE:
+            if (t->p < t->end) {
+                return (int8_t)*t->p++;
+            }
+            t->bad = true;
+            return 0;
+        case QP_TC_I16:
+        case QP_TC_I32:
+        case QP_TC_I64:
+            qp_tc_zigzag(t, &v);
+            return v;
+        default:
+            qp_tc_skip(t, type);
+            return 0;
+    }
+}
+
+static bool qp_tc_binary(qp_tc *t, uint8_t type, const uint8_t **p, uint32_t *len)
+{
+    uint64_t n;
+    if (type != QP_TC_BINARY) {
+        qp_tc_skip(t, type);
+        return false;
+    }
+    if (!qp_tc_varint(t, &n)) {
+        return false;
+    }
+    if (n > (uint64_t)(t->end - t->p)) {
+        t->bad = true;
+        return false;
+    }
+    *p = t->p;
+    *len = (uint32_t)n;
+    t->p += n;
+    return true;
+}
+
+/*──────────────────────────── Footer ─────────────────────────────────────*/
+
+typedef struct {
+    const uint8_t *name;
+    uint32_t       name_len;
+    int32_t        type;            /* -1: a group */
+    int32_t        repetition;
+    int32_t        children;
+} qp_pq_elem;
+
+static void qp_pq_read_elem(qp_tc *t, qp_pq_elem *e)
+{
+    int16_t id = 0;
+    uint8_t ft;
+    e->type = -1;
+    while (qp_tc_field(t, &id, &ft)) {
+        switch (id) {
+            case 1: e->type = (int32_t)qp_tc_int(t, ft); break;
+            case 3: e->repetition = (int32_t)qp_tc_int(t, ft); break;
+            case 4: qp_tc_binary(t, ft, &e->name, &e->name_len); break;
+            case 5: e->children = (int32_t)qp_tc_int(t, ft); break;
+            default: qp_tc_skip(t, ft);
+        }
+    }
+}
+
+/* Element *i and what is below it; the top-level leaves become fields */
+static bool qp_pq_walk(quicpro_df_parquet_t *pq, const qp_pq_elem *elems, uint32_t n, uint32_t *i, unsigned depth)
+{
+    if (*i >= n || depth > 64) {
+        return false;
+    }
+    const qp_pq_elem *e = &elems[(*i)++];
+    if (e->children > 0 || e->type < 0) {
+        for (int32_t c = 0; c < e->children; c++) {
+            if (!qp_pq_walk(pq, elems, n, i, depth + 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (depth == 1 && e->repetition != QP_PQ_REPEATED) {
+        quicpro_df_parquet_field_t *f = &pq->fields[pq->nfields++];
+        f->name = zend_string_init((const char *)e->name, e->name_len, 0);
+        f->physical = e->type;
+        f->optional = e->repetition != 0;
+        f->leaf = pq->nleaves;
+        f->readable = true;
+        switch (e->type) {
+            case QP_PQ_BOOLEAN:    f->type = QUICPRO_DF_BOOL; break;
+            case QP_PQ_INT32:
+            case QP_PQ_INT64:      f->type = QUICPRO_DF_INT64; break;
+            case QP_PQ_FLOAT:
+            case QP_PQ_DOUBLE:     f->type = QUICPRO_DF_FLOAT64; break;
+            case QP_PQ_BYTE_ARRAY: f->type = QUICPRO_DF_UTF8; break;
+            default:               f->readable = false;
+        }
+    }
+    pq->nleaves++;
+    return true;
+}
+
+static bool qp_pq_read_schema(quicpro_df_parquet_t *pq, qp_tc *t, uint8_t type)
+{
+    uint8_t etype;
+    uint32_t n;
+    if (!qp_tc_list(t, type, &etype, &n) || etype != QP_TC_STRUCT || n == 0) {
+        return qp_pq_malformed("schema");
+    }
+    qp_pq_elem *elems = ecalloc(n, sizeof(*elems));
+    for (uint32_t i = 0; i < n && !t->bad; i++) {
+        qp_pq_read_elem(t, &elems[i]);
+    }
+    bool ok = !t->bad;
+    if (ok) {
+        uint32_t at = 1;
+        pq->fields = ecalloc(n, sizeof(*pq->fields));
+        for (int32_t c = 0; ok && c < elems[0].children; c++) {
+            ok = qp_pq_walk(pq, elems, n, &at, 1);
+        }
+        ok = ok && at == n;
+    }
+    efree(elems);
+    return ok || qp_pq_malformed("schema");
+}
+
+static void qp_pq_read_stats(qp_tc *t, uint8_t type, int32_t physical, quicpro_df_parquet_chunk_t *c)
+{
+    const uint8_t *legacy_min = NULL, *legacy_max = NULL;
+    uint32_t legacy_min_len = 0, legacy_max_len = 0;
+    int16_t id = 0;
+    uint8_t ft;
+    if (type != QP_TC_STRUCT) {
+        qp_tc_skip(t, type);
+        return;
+    }
+    while (qp_tc_field(t, &id, &ft)) {
+        switch (id) {
+            case 1: qp_tc_binary(t, ft, &legacy_max, &legacy_max_len); break;
+            case 2: qp_tc_binary(t, ft, &legacy_min, &legacy_min_len); break;
+            case 3: c->null_count = qp_tc_int(t, ft); break;
+            case 5: qp_tc_binary(t, ft, &c->max, &c->max_len); break;
+            case 6: qp_tc_binary(t, ft, &c->min, &c->min_len); break;
+            default: qp_tc_skip(t, ft);
+        }
+    }
+    /* The deprecated min/max sort byte arrays as signed bytes; they are only trusted for numbers */
+    if (!c->min && !c->max && physical != QP_PQ_BYTE_ARRAY && physical != QP_PQ_BOOLEAN) {
+        c->min = legacy_min;
+        c->min_len = legacy_min_len;
+        c->max = legacy_max;
+        c->max_len = legacy_max_len;
+    }
+}
+
+static bool qp_pq_read_chunk(qp_tc *t, quicpro_df_parquet_chunk_t *c)
+{
+    int16_t id = 0, mid;
+    uint8_t ft, mft;
+    int64_t data_offset = -1, dict_offset = -1;
+    int32_t physical = -1;
+    bool meta = false;
+
+    c->null_count = -1;
+    while (qp_tc_field(t, &id, &ft)) {
+        if (id == 1) {
+            qp_tc_skip(t, ft);
+            return qp_pq_unsupported("column chunks in other files");
+        }
+        if (id != 3 || ft != QP_TC_STRUCT) {
+            qp_tc_skip(t, ft);
+            continue;
+        }
+        meta = true;
+        mid = 0;
+        while (qp_tc_field(t, &mid, &mft)) {
+            switch (mid) {
+                case 1:  physical = (int32_t)qp_tc_int(t, mft); break;
+                case 4:  c->codec = (int32_t)qp_tc_int(t, mft); break;
+                case 7:  c->length = (uint64_t)qp_tc_int(t, mft); break;
+                case 9:  data_offset = qp_tc_int(t, mft); break;
+                case 11: dict_offset = qp_tc_int(t, mft); break;
+                case 12: qp_pq_read_stats(t, mft, physical, c); break;
+                default: qp_tc_skip(t, mft);
+            }
+        }
+    }
+    if (t->bad || !meta || data_offset < 0) {
+        return qp_pq_malformed("column chunk");
+    }
+    c->offset = (uint64_t)(dict_offset > 0 && dict_offset < data_offset ? dict_offset : data_offset);
+    return true;
+}
+
+static bool qp_pq_read_group(quicpro_df_parquet_t *pq, qp_tc *t, uint8_t type, quicpro_df_parquet_group_t *g)
+{
+    int16_t id = 0;
+    uint8_t ft, etype;
+    uint32_t n;
+    if (type != QP_TC_STRUCT) {
+        return qp_pq_malformed("row group");
+    }
+    while (qp_tc_field(t, &id, &ft)) {
+        switch (id) {
+            case 1:
+                if (!qp_tc_list(t, ft, &etype, &n) || etype != QP_TC_STRUCT || n != pq->nleaves || g->chunks) {
+                    return qp_pq_malformed("row group columns");
+                }
+                g->chunks = ecalloc(MAX(n, 1), sizeof(*g->chunks));
+                for (uint32_t i = 0; i < n; i++) {
+                    if (!qp_pq_read_chunk(t, &g->chunks[i])) {
+                        return false;
+                    }
+                }
+                break;
+            case 3:
+                g->rows = qp_tc_int(t, ft);
+                break;
+            default:
+                qp_tc_skip(t, ft);
+        }
+    }
+    return (!t->bad && g->chunks && g->rows >= 0) || qp_pq_malformed("row group");
+}
+
+bool quicpro_df_parquet_open(quicpro_df_parquet_t *pq, zend_string *footer)
+{
+    qp_tc t = { (const uint8_t *)ZSTR_VAL(footer), (const uint8_t *)ZSTR_VAL(footer) + ZSTR_LEN(footer), 0, false };
+    int16_t id = 0;
+    uint8_t ft, etype;
+    uint32_t n;
+    bool ok = true, schema = false;
+
+    memset(pq, 0, sizeof(*pq));
+    pq->footer = zend_string_copy(footer);
+    while (ok && qp_tc_field(&t, &id, &ft)) {
+        switch (id) {
+            case 2:
+                ok = !schema && qp_pq_read_schema(pq, &t, ft);
+                schema = true;
+                break;
+            case 3:
+                pq->rows = qp_tc_int(&t, ft);
+                break;
+            case 4:
+                if (!schema) {
+                    ok = qp_pq_malformed("row groups before the schema");
+                    break;
+                }
+                if (!qp_tc_list(&t, ft, &etype, &n) || etype != QP_TC_STRUCT || pq->groups) {
+                    ok = qp_pq_malformed("row groups");
+                    break;
+                }
+                pq->groups = ecalloc(MAX(n, 1), sizeof(*pq->groups));
+                for (uint32_t i = 0; ok && i < n; i++) {
+                    ok = qp_pq_read_group(pq, &t, QP_TC_STRUCT, &pq->groups[i]);
+                    pq->ngroups++;
+                }
+                break;
+            default:
+                qp_tc_skip(&t, ft);
+        }
+    }
+    if (ok && (t.bad || !schema)) {
+        ok = qp_pq_malformed("footer");
+    }
+    if (!ok) {
+        quicpro_df_parquet_free(pq);
+    }
+    return ok;
+}
+
+void quicpro_df_parquet_free(quicpro_df_parquet_t *pq)
+{
+    for (uint32_t i = 0; i < pq->nfields; i++) {
+        zend_string_release(pq->fields[i].name);
+    }
+    if (pq->fields) {
+        efree(pq->fields);
+    }
+    for (size_t i = 0; i < pq->ngroups; i++) {
+        if (pq->groups[i].chunks) {
+            efree(pq->groups[i].chunks);
+        }
+    }
+    if (pq->groups) {
+        efree(pq->groups);
+    }
+    if (pq->footer) {
+        zend_string_release(pq->footer);
+    }
+    memset(pq, 0, sizeof(*pq));
+}
+
+/*──────────────────────────── Statistics ─────────────────────────────────*/
+
+/* The sign of `stat` - `value`; false when they do not compare */
+static bool qp_pq_compare(int32_t physical, const uint8_t *stat, uint32_t len, zval *value, int *out)
+{
+    double s, v;
+    switch (physical) {
+        case QP_PQ_INT32:
+        case QP_PQ_INT64: {
+            if (len != (physical == QP_PQ_INT32 ? 4u : 8u)) {
+                return false;
+            }
+            int64_t i = physical == QP_PQ_INT32 ? (int32_t)qp_pq_load(stat, 4) : (int64_t)qp_pq_load(stat, 8);
+            if (Z_TYPE_P(value) == IS_LONG) {
+                *out = (i > Z_LVAL_P(value)) - (i < Z_LVAL_P(value));
+                return true;
+            }
+            s = (double)i;
+            break;
+        }
+        case QP_PQ_FLOAT: {
+            float f;
+            if (len != 4) {
+                return false;
+            }
+            memcpy(&f, stat, 4);
+            s = f;
+            break;
+        }
+        case QP_PQ_DOUBLE:
+            if (len != 8) {
+                return false;
+            }
+            memcpy(&s, stat, 8);
+            break;
+        case QP_PQ_BYTE_ARRAY: {
+            if (Z_TYPE_P(value) != IS_STRING) {
+                return false;
+            }
+            size_t vlen = Z_STRLEN_P(value);
+            int c = memcmp(stat, Z_STRVAL_P(value), MIN(len, vlen));
+            *out = c ? (c > 0) - (c < 0) : (len > vlen) - (len < vlen);
+            return true;
+        }
+        default:
+            return false;
+    }
+    if (Z_TYPE_P(value) == IS_LONG) {
+        v = (double)Z_LVAL_P(value);
+    } else if (Z_TYPE_P(value) == IS_DOUBLE) {
+        v = Z_DVAL_P(value);
+    } else {
+        return false;
+    }
+    if (isnan(s) || isnan(v)) {
+        return false;
+    }
+    *out = (s > v) - (s < v);
+    return true;
+}
+
+bool quicpro_df_parquet_may_match(const quicpro_df_parquet_field_t *field, const quicpro_df_parquet_chunk_t *chunk,
+                                  int64_t rows, quicpro_df_cmp_t op, zval *value)
+{
+    int lo, hi;
+    if (Z_TYPE_P(value) == IS_NULL) {
+        if (chunk->null_count < 0) {
+            return true;
+        }
+        return op == QUICPRO_DF_EQ ? chunk->null_count > 0 : op != QUICPRO_DF_NE || chunk->null_count < rows;
+    }
+    if (chunk->null_count >= rows && rows > 0) {
+        return false;                           /* Nulls never match */
+    }
+    if (!chunk->min || !chunk->max
+        || !qp_pq_compare(field->physical, chunk->min, chunk->min_len, value, &lo)
+        || !qp_pq_compare(field->physical, chunk->max, chunk->max_len, value, &hi)) {
+        return true;
+    }
+    switch (op) {
+        case QUICPRO_DF_EQ: return lo <= 0 && hi >= 0;
+        case QUICPRO_DF_NE: return lo != 0 || hi != 0;
+        case QUICPRO_DF_LT: return lo < 0;
+        case QUICPRO_DF_LE: return lo <= 0;
+        case QUICPRO_DF_GT: return hi > 0;
+        case QUICPRO_DF_GE: return hi >= 0;
+    }
+    return true;
+}
+
+/*──────────────────────────── Codecs ─────────────────────────────────────*/
+
+static bool qp_pq_snappy(const uint8_t *in, size_t len, uint8_t *out, size_t out_len)
+{
+    const uint8_t *p = in, *end = in + len;
+    uint64_t n = 0;
+    size_t o = 0;
+
+    for (unsigned shift = 0;; shift += 7) {
+        if (p >= end || shift > 28) {
+            return false;
+        }
+        n |= (uint64_t)(*p & 0x7f) << shift;
+        if (!(*p++ & 0x80)) {
+            break;
+        }
+    }
+    if (n != out_len) {
+        return false;
+    }
+    while (p < end) {
+        uint8_t tag = *p++;
+        size_t l, off;
+        switch (tag & 3) {
+            case 0:                             /* Literal */
+                l = tag >> 2;
+                if (l >= 60) {
+                    size_t bytes = l - 59;
+                    if ((size_t)(end - p) < bytes) {
+                        return false;
+                    }
+                    l = (size_t)qp_pq_load(p, bytes);
+                    p += bytes;
+                }
+                l++;
+                if (l > (size_t)(end - p) || l > out_len - o) {
+                    return false;
+                }
+                memcpy(out + o, p, l);
+                p += l;
+                o += l;
+                continue;
+            case 1:
+                if (p >= end) {
+                    return false;
+                }
+                l = 4 + ((tag >> 2) & 7);
+                off = ((size_t)(tag >> 5) << 8) | *p++;
+                break;
+            case 2:
+                if (end - p < 2) {
+                    return false;
+                }
+                l = (size_t)(tag >> 2) + 1;
+                off = (size_t)qp_pq_load(p, 2);
+                p += 2;
+                break;
+            default:
+                if (end - p < 4) {
+                    return false;
+                }
+                l = (size_t)(tag >> 2) + 1;
+                off = (size_t)qp_pq_load(p, 4);
+                p += 4;
+        }
+        if (off == 0 || off > o || l > out_len - o) {
+            return false;
+        }
+        for (size_t i = 0; i < l; i++) {        /* Copies may overlap what they write */
+            out[o + i] = out[o - off + i];
+        }
+        o += l;
+    }
+    return o == out_len;
+}
+
+#ifdef QUICPRO_HAVE_ZLIB
+static bool qp_pq_gunzip(const uint8_t *in, size_t len, uint8_t *out, size_t out_len)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (len > UINT_MAX || out_len > UINT_MAX || inflateInit2(&zs, 15 + 32) != Z_OK) {
+        return false;
+    }
+    zs.next_in = (Bytef *)in;
+    zs.avail_in = (uInt)len;
+    zs.next_out = out;
+    zs.avail_out = (uInt)out_len;
+    bool ok = inflate(&zs, Z_FINISH) == Z_STREAM_END && zs.total_out == out_len;
+    inflateEnd(&zs);
+    return ok;
+}
+#endif
+
+/* `len` bytes of a page at `in` as the `out_len` bytes they compress; *buf is what to efree(). NULL after throwing. */
+static const uint8_t *qp_pq_decompress(int32_t codec, const uint8_t *in, size_t len, size_t out_len, uint8_t **buf)
+{
+    bool ok;
+    *buf = NULL;
+    if (codec == QP_PQ_UNCOMPRESSED) {
+        if (len < out_len) {
+            qp_pq_malformed("page size");
+            return NULL;
+        }
+        return in;
+    }
+    uint8_t *out = emalloc(MAX(out_len, 1));
+    switch (codec) {
+        case QP_PQ_SNAPPY:
+            ok = qp_pq_snappy(in, len, out, out_len);
+            break;
+#ifdef QUICPRO_HAVE_ZLIB
+        case QP_PQ_GZIP:
+            ok = qp_pq_gunzip(in, len, out, out_len);
+            break;
+#endif
+#ifdef QUICPRO_HAVE_ZSTD
+        case QP_PQ_ZSTD: {
+            size_t n = ZSTD_decompress(out, out_len, in, len);
+            ok = !ZSTD_isError(n) && n == out_len;
+            break;
+        }
+#endif
+        default:
+            efree(out);
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame: Parquet pages compressed with codec %d are not supported by this build", (int)codec);
+            return NULL;
+    }
+    if (!ok) {
+        efree(out);
+        qp_pq_malformed("compressed page");
+        return NULL;
+    }
+    *buf = out;
+    return out;
+}
+
+/*──────────────────────────── Pages ──────────────────────────────────────*/
+
+/* The RLE / bit-packed hybrid encoding of values `width` bits wide */
+typedef struct {
+    const uint8_t *p, *end;
+    const uint8_t *packed;          /* Bit-packed run: its bytes, NULL in an RLE run */
+    const uint8_t *packed_end;
+    unsigned       width;
+    uint64_t       bit;
+    uint32_t       run, value;
+} qp_rle;
+
+static void qp_rle_init(qp_rle *d, const uint8_t *p, const uint8_t *end, unsigned width)
+{
+    memset(d, 0, sizeof(*d));
+    d->p = p;
+    d->end = end;
+    d->width = width;
+}
+
+static bool qp_rle_next(qp_rle *d, uint32_t *out)
+{
+    while (!d->run) {
+        qp_tc t = { d->p, d->end, 0, false };
+        uint64_t h;
+        if (!qp_tc_varint(&t, &h) || (h >> 1) == 0 || (h >> 1) > UINT32_MAX / 8) {
+            return false;
+        }
+        d->p = t.p;
+        if (h & 1) {
+            /* Writers may end the last run early; what is missing reads as zeros */
+            size_t bytes = MIN((size_t)(h >> 1) * d->width, (size_t)(d->end - d->p));
+            d->packed = d->p;
+            d->packed_end = d->p + bytes;
+            d->bit = 0;
+            d->run = (uint32_t)(h >> 1) * 8;
+            d->p += bytes;
+        } else {
+            size_t bytes = (d->width + 7) / 8;
+            if ((size_t)(d->end - d->p) < bytes) {
+                return false;
+            }
+            d->packed = NULL;
+            d->value = (uint32_t)qp_pq_load(d->p, bytes);
+            d->run = (uint32_t)(h >> 1);
+            d->p += bytes;
+        }
+    }
+    d->run--;
+    if (!d->packed) {
+        *out = d->value;
+        return true;
+    }
+    const uint8_t *at = d->packed + (d->bit >> 3);
+    uint64_t word = at < d->packed_end ? qp_pq_load(at, MIN(8, (size_t)(d->packed_end - at))) : 0;
+    *out = (uint32_t)((word >> (d->bit & 7)) & ((1ull << d->width) - 1));
+    d->bit += d->width;
+    return true;
+}
+
+typedef struct {
+    int32_t type, uncompressed, compressed;
+    int32_t num_values, encoding, def_encoding;
+    int32_t def_len, rep_len;               /* v2 */
+    bool    v2_compressed;
+} qp_pq_page_t;
+
+static void qp_pq_read_page_kind(qp_tc *t, uint8_t type, int16_t kind, qp_pq_page_t *h)
+{
+    int16_t id = 0;
+    uint8_t ft;
+    if (type != QP_TC_STRUCT) {
+        qp_tc_skip(t, type);
+        return;
+    }
+    while (qp_tc_field(t, &id, &ft)) {
+        int16_t key = (int16_t)(kind * 16 + id);
+        switch (key) {
+            case 5 * 16 + 1: case 7 * 16 + 1: case 8 * 16 + 1:
+                h->num_values = (int32_t)qp_tc_int(t, ft);
+                break;
+            case 5 * 16 + 2: case 7 * 16 + 2: case 8 * 16 + 4:
+                h->encoding = (int32_t)qp_tc_int(t, ft);
+                break;
+            case 5 * 16 + 3:
+                h->def_encoding = (int32_t)qp_tc_int(t, ft);
+                break;
+            case 8 * 16 + 5:
+                h->def_len = (int32_t)qp_tc_int(t, ft);
+                break;
+            case 8 * 16 + 6:
+                h->rep_len = (int32_t)qp_tc_int(t, ft);
+                break;
+            case 8 * 16 + 7:
+                h->v2_compressed = qp_tc_int(t, ft) != 0;
+                break;
+            default:
+                qp_tc_skip(t, ft);
+        }
+    }
+}
+
+static bool qp_pq_read_page_header(qp_tc *t, qp_pq_page_t *h)
+{
+    int16_t id = 0;
+    uint8_t ft;
+    memset(h, 0, sizeof(*h));
+    h->type = -1;
+    h->def_encoding = QP_PQ_RLE;
+    h->v2_compressed = true;
+    while (qp_tc_field(t, &id, &ft)) {
+        switch (id) {
+            case 1: h->type = (int32_t)qp_tc_int(t, ft); break;
+            case 2: h->uncompressed = (int32_t)qp_tc_int(t, ft); break;
+            case 3: h->compressed = (int32_t)qp_tc_int(t, ft); break;
+            case 5:
+            case 7:
+            case 8: qp_pq_read_page_kind(t, ft, id, h); break;
+            default: qp_tc_skip(t, ft);
+        }
+    }
+    return !t->bad && h->type >= 0 && h->uncompressed >= 0 && h->compressed >= 0 && h->num_values >= 0
+        && h->def_len >= 0 && h->rep_len >= 0;
+}
+
+typedef struct {
+    const quicpro_df_parquet_field_t *field;
+    int64_t               rows, row;
+    uint8_t              *valid;        /* Optional fields: the validity bitmap being filled */
+    quicpro_df_column_t  *col;          /* Numbers and bools */
+    int32_t              *offsets;      /* Strings: rows + 1 of them into `bytes` */
+    smart_str             bytes;
+    bool                  has_dict;
+    uint32_t              ndict;
+    const uint8_t        *dict;         /* Numbers: the dictionary's values */
+    const uint8_t       **dict_str;     /* Strings: the dictionary's values */
+    uint32_t             *dict_len;
+    uint8_t              *dict_buf;     /* The decompressed dictionary page */
+} qp_pq_reader;
+
+static inline size_t qp_pq_width(int32_t physical)
+{
+    return physical == QP_PQ_INT32 || physical == QP_PQ_FLOAT ? 4 : 8;
+}
+
+static inline void qp_pq_fixed(qp_pq_reader *r, int64_t row, const uint8_t *v)
+{
+    switch (r->field->physical) {
+        case QP_PQ_INT32:
+            ((int64_t *)r->col->values)[row] = (int32_t)qp_pq_load(v, 4);
+            break;
+        case QP_PQ_FLOAT: {
+            float f;
+            memcpy(&f, v, 4);
+            ((double *)r->col->values)[row] = f;
+            break;
+        }
+        default:
+            memcpy((int64_t *)r->col->values + row, v, 8);
+    }
+}
+
+static bool qp_pq_string(qp_pq_reader *r, int64_t row, const uint8_t *s, uint32_t len)
+{
+    size_t at = r->bytes.s ? ZSTR_LEN(r->bytes.s) : 0;
+    if (len > INT32_MAX - at) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame string columns hold at most 2 GiB");
+        return false;
+    }
+    smart_str_appendl(&r->bytes, (const char *)s, len);
+    r->offsets[row + 1] = (int32_t)(at + len);
+    return true;
+}
+
+static bool qp_pq_dictionary(qp_pq_reader *r, const uint8_t *p, size_t len, int32_t n)
+{
+    int32_t physical = r->field->physical;
+    if (r->has_dict) {
+        return qp_pq_malformed("second dictionary page");
+    }
+    if (physical == QP_PQ_BOOLEAN) {
+        return qp_pq_unsupported("dictionary-encoded booleans");
+    }
+    if (physical == QP_PQ_BYTE_ARRAY) {
+        const uint8_t *end = p + len;
+        r->dict_str = safe_emalloc((size_t)MAX(n, 1), sizeof(*r->dict_str), 0);
+        r->dict_len = safe_emalloc((size_t)MAX(n, 1), sizeof(*r->dict_len), 0);
+        for (int32_t i = 0; i < n; i++) {
+            if (end - p < 4) {
+                return qp_pq_malformed("dictionary page");
+            }
+            uint32_t l = (uint32_t)qp_pq_load(p, 4);
+            p += 4;
+            if (l > (size_t)(end - p)) {
+                return qp_pq_malformed("dictionary page");
+            }
+            r->dict_str[i] = p;
+            r->dict_len[i] = l;
+            p += l;
+        }
+    } else if (len / qp_pq_width(physical) < (size_t)n) {
+        return qp_pq_malformed("dictionary page");
+    }
+    r->dict = p;
+    r->ndict = (uint32_t)n;
+    r->has_dict = true;
+    return true;
+}
+
+/* Definition levels of a field nested one deep: 1 where a row holds a value */
+static bool qp_pq_levels(const uint8_t *p, const uint8_t *end, int64_t n, uint8_t *out)
+{
+    qp_rle d;
+    qp_rle_init(&d, p, end, 1);
+    for (int64_t i = 0; i < n; i++) {
+        uint32_t v;
+        if (!qp_rle_next(&d, &v)) {
+            return false;
+        }
+        out[i] = v != 0;
+    }
+    return true;
+}
+
+/* The next `n` rows, from the values at [p, end) and a level per row (NULL: none are null) */
+static bool qp_pq_values(qp_pq_reader *r, int32_t encoding, const uint8_t *p, const uint8_t *end,
+                         const uint8_t *levels, int64_t n)
+{
+    int32_t physical = r->field->physical;
+    size_t w = qp_pq_width(physical);
+    bool dict = encoding == QP_PQ_PLAIN_DICTIONARY || encoding == QP_PQ_RLE_DICTIONARY;
+    uint64_t bit = 0;
+    qp_rle rle;
+
+    if (dict) {
+        if (!r->has_dict) {
+            return qp_pq_malformed("no dictionary page");
+        }
+        if (p >= end || *p > 32) {
+            return qp_pq_malformed("dictionary indices");
+        }
+        qp_rle_init(&rle, p + 1, end, *p);
+    } else if (encoding == QP_PQ_RLE && physical == QP_PQ_BOOLEAN) {
+        if (end - p < 4 || qp_pq_load(p, 4) > (uint64_t)(end - p - 4)) {
+            return qp_pq_malformed("boolean values");
+        }
+        qp_rle_init(&rle, p + 4, p + 4 + qp_pq_load(p, 4), 1);
+    } else if (encoding != QP_PQ_PLAIN) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "DataFrame: Parquet pages with encoding %d are not supported", (int)encoding);
+        return false;
+    }
+
+    if (!levels && encoding == QP_PQ_PLAIN && w == 8 && physical != QP_PQ_BYTE_ARRAY && physical != QP_PQ_BOOLEAN) {
+        if ((size_t)(end - p) / 8 < (size_t)n) {
+            return qp_pq_malformed("page values");
+        }
+        memcpy((int64_t *)r->col->values + r->row, p, (size_t)n * 8);
+        return true;
+    }
+
+    for (int64_t i = 0; i < n; i++) {
+        int64_t row = r->row + i;
+        uint32_t k;
+        if (levels && !levels[i]) {
+            if (r->offsets) {
+                r->offsets[row + 1] = r->offsets[row];
+            }
+            continue;
+        }
+        if (r->valid) {
+            r->valid[row >> 3] |= (uint8_t)(1u << (row & 7));
+        }
+        if (dict) {
+            if (!qp_rle_next(&rle, &k) || k >= r->ndict) {
+                return qp_pq_malformed("dictionary index");
+            }
+            if (physical != QP_PQ_BYTE_ARRAY) {
+                qp_pq_fixed(r, row, r->dict + (size_t)k * w);
+            } else if (!qp_pq_string(r, row, r->dict_str[k], r->dict_len[k])) {
+                return false;
+            }
+            continue;
+        }
+        switch (physical) {
+            case QP_PQ_BOOLEAN:
+                if (encoding == QP_PQ_RLE) {
+                    if (!qp_rle_next(&rle, &k)) {
+                        return qp_pq_malformed("boolean values");
+                    }
+                } else {
+                    if (bit >= (uint64_t)(end - p) * 8) {
+                        return qp_pq_malformed("boolean values");
+                    }
+                    k = (p[bit >> 3] >> (bit & 7)) & 1;
+                    bit++;
+                }
+                if (k) {
+                    ((uint8_t *)r->col->values)[row >> 3] |= (uint8_t)(1u << (row & 7));
+                }
+                break;
+            case QP_PQ_BYTE_ARRAY: {
+                if (end - p < 4 || qp_pq_load(p, 4) > (uint64_t)(end - p - 4)) {
+                    return qp_pq_malformed("string values");
+                }
+                uint32_t l = (uint32_t)qp_pq_load(p, 4);
+                if (!qp_pq_string(r, row, p + 4, l)) {
+                    return false;
+                }
+                p += 4 + l;
+                break;
+            }
+            default:
+                if ((size_t)(end - p) < w) {
+                    return qp_pq_malformed("page values");
+                }
+                qp_pq_fixed(r, row, p);
+                p += w;
+        }
+    }
+    return true;
+}
+
+static bool qp_pq_page(qp_pq_reader *r, int32_t codec, const qp_pq_page_t *h, const uint8_t *page)
+{
+    uint8_t *buf = NULL, *levels = NULL;
+    const uint8_t *p, *end;
+    int64_t n = h->num_values;
+    bool ok;
+
+    switch (h->type) {
+        case QP_PQ_DICTIONARY_PAGE:
+            if (h->encoding != QP_PQ_PLAIN && h->encoding != QP_PQ_PLAIN_DICTIONARY) {
+                return qp_pq_unsupported("a dictionary page not PLAIN encoded");
+            }
+            if (r->has_dict) {
+                return qp_pq_malformed("second dictionary page");
+            }
+            if (!(p = qp_pq_decompress(codec, page, (size_t)h->compressed, (size_t)h->uncompressed, &r->dict_buf))) {
+                return false;
+            }
+            return qp_pq_dictionary(r, p, (size_t)h->uncompressed, h->num_values);
+
+        case QP_PQ_DATA_PAGE:
+            if (n > r->rows - r->row) {
+                return qp_pq_malformed("more values than rows");
+            }
+            if (!(p = qp_pq_decompress(codec, page, (size_t)h->compressed, (size_t)h->uncompressed, &buf))) {
+                return false;
+            }
+            end = p + h->uncompressed;
+            ok = true;
+            if (r->field->optional) {
+                if (h->def_encoding != QP_PQ_RLE) {
+                    ok = qp_pq_unsupported("definition levels not RLE encoded");
+                } else if (end - p < 4 || qp_pq_load(p, 4) > (uint64_t)(end - p - 4)) {
+                    ok = qp_pq_malformed("definition levels");
+                } else {
+                    size_t l = (size_t)qp_pq_load(p, 4);
+                    levels = emalloc((size_t)MAX(n, 1));
+                    ok = qp_pq_levels(p + 4, p + 4 + l, n, levels) || qp_pq_malformed("definition levels");
+                    p += 4 + l;
+                }
+            }
+            break;
+
+        case QP_PQ_DATA_PAGE_V2: {
+            size_t lev = (size_t)h->rep_len + (size_t)h->def_len;
+            if (n > r->rows - r->row) {
+                return qp_pq_malformed("more values than rows");
+            }
+            if (lev > (size_t)h->compressed || lev > (size_t)h->uncompressed) {
+                return qp_pq_malformed("level lengths");
+            }
+            if (!h->v2_compressed) {
+                p = page + lev;
+                if ((size_t)h->compressed < (size_t)h->uncompressed) {
+                    return qp_pq_malformed("page size");
+                }
+            } else if (!(p = qp_pq_decompress(codec, page + lev, (size_t)h->compressed - lev,
+                                              (size_t)h->uncompressed - lev, &buf))) {
+                return false;
+            }
+            end = p + (h->uncompressed - lev);
+            ok = true;
+            if (r->field->optional) {
+                levels = emalloc((size_t)MAX(n, 1));
+                ok = qp_pq_levels(page + h->rep_len, page + lev, n, levels) || qp_pq_malformed("definition levels");
+            }
+            break;
+        }
+
+        default:
+            return true;                        /* Index pages */
+    }
+
+    ok = ok && qp_pq_values(r, h->encoding, p, end, levels, n);
+    r->row += n;
+    if (levels) {
+        efree(levels);
+    }
+    if (buf) {
+        efree(buf);
+    }
+    return ok;
+}
+
+quicpro_df_column_t *quicpro_df_parquet_column(const quicpro_df_parquet_field_t *field,
+                                               const quicpro_df_parquet_chunk_t *chunk, int64_t rows,
+                                               const uint8_t *data, size_t len)
+{
+    qp_pq_reader r = { .field = field, .rows = rows };
+    quicpro_df_column_t *out = NULL;
+    size_t pos = 0;
+    bool ok = true;
+
+    if (!field->readable) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "DataFrame: Parquet column '%s' has a physical type that cannot be read", ZSTR_VAL(field->name));
+        return NULL;
+    }
+    bool strings = field->physical == QP_PQ_BYTE_ARRAY;
+    if (strings) {
+        r.offsets = safe_emalloc((size_t)rows + 1, sizeof(int32_t), 0);
+        r.offsets[0] = 0;
+        r.valid = field->optional ? ecalloc((size_t)MAX((rows + 7) / 8, 1), 1) : NULL;
+    } else if ((r.col = quicpro_df_column_new(field->type, rows, field->optional, 0))) {
+        r.valid = r.col->validity;
+    } else {
+        return NULL;
+    }
+
+    while (ok && r.row < rows) {
+        qp_tc t = { data + pos, data + len, 0, false };
+        qp_pq_page_t h;
+        if (pos >= len || !qp_pq_read_page_header(&t, &h)) {
+            ok = qp_pq_malformed("page header");
+            break;
+        }
+        pos = (size_t)(t.p - data);
+        if ((size_t)h.compressed > len - pos) {
+            ok = qp_pq_malformed("truncated page");
+            break;
+        }
+        ok = qp_pq_page(&r, chunk->codec, &h, data + pos);
+        pos += (size_t)h.compressed;
+    }
+
+    if (ok && strings) {
+        size_t n = r.bytes.s ? ZSTR_LEN(r.bytes.s) : 0;
+        if ((out = quicpro_df_column_new(QUICPRO_DF_UTF8, rows, field->optional, n))) {
+            memcpy(out->values, r.offsets, ((size_t)rows + 1) * sizeof(int32_t));
+            if (n) {
+                memcpy(out->data, ZSTR_VAL(r.bytes.s), n);
+            }
+            if (out->validity) {
+                memcpy(out->validity, r.valid, (size_t)(rows + 7) / 8);
+            }
+        }
+    } else if (ok) {
+        out = r.col;
+        r.col = NULL;
+    }
+    if (out) {
+        quicpro_df_column_settle(out);
+    }
+    if (out && out->type == QUICPRO_DF_UTF8 && quicpro_high_perf_compute_ai_config.dataframe_string_interning_enable) {
+        quicpro_df_column_t *encoded = quicpro_df_column_encode(out);
+        quicpro_df_column_release(out);
+        out = encoded;
+    }
+
+    if (r.col) {
+        quicpro_df_column_release(r.col);
+    }
+    if (r.offsets) {
+        efree(r.offsets);
+    }
+    if (strings && r.valid) {
+        efree(r.valid);
+    }
+    smart_str_free(&r.bytes);
+    if (r.dict_str) {
+        efree(r.dict_str);
+        efree(r.dict_len);
+    }
+    if (r.dict_buf) {
+        efree(r.dict_buf);
+    }
+    return out;
+}
@@ -0,0 +1,1727 @@
+/*
+ * src/dataframe/scan.c – Out-of-core scans for Quicpro\DataFrame
+ * ==============================================================
+ *
+ * See include/dataframe/scan.h. A pass over the file reads one batch at
+ * a time into columns indexed by the file's schema: the filter columns
+ * first, then (if any row is left) the other columns the pass wants. An
+ * Arrow batch is decoded as a stream of its own, made of the schema and
+ * dictionary messages seen so far and the batch itself, so its columns
+ * are mapped like those of DataFrame::fromArrow().
+ *
+ * The spill file of groupBy() holds Arrow IPC streams (one per partition
+ * each time the state spills), so that reading a partition back maps its
+ * columns rather than parsing them.
+ */
+
+#include "php_quicpro.h"
+#include "dataframe/scan.h"
+#include "dataframe/arrow_ipc.h"
+#include "dataframe/column.h"
+#include "dataframe/dataframe.h"
+#include "dataframe/group_by.h"
+#include "dataframe/kernels.h"
+#include "dataframe/morsel.h"
+#include "dataframe/parquet.h"
+#include "object_store/stream.h"
+#include "config/high_perf_compute_and_ai/base_layer.h"
+
+#include <ext/spl/spl_exceptions.h>
+#include <main/php_open_temporary_file.h>
+#include <zend_exceptions.h>
+#include <zend_interfaces.h>
+#include <zend_smart_str.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+
+#define QP_SCAN_ARROW_MAGIC      "ARROW1"
+#define QP_SCAN_PREFETCH_DEFAULT 2
+#define QP_SCAN_SPILL_DEFAULT_MB 256
+#define QP_SCAN_SPILL_PARTS      16
+/* Partial group states are compacted once this many rows (or as many as the state has) came in */
+#define QP_SCAN_COMPACT_ROWS     (4 * QUICPRO_DF_MORSEL_ROWS)
+
+/* What taking a batch came to */
+#define QP_SCAN_ERROR (-1)
+#define QP_SCAN_END   0
+#define QP_SCAN_BATCH 1
+#define QP_SCAN_EMPTY 2
+
+zend_class_entry *quicpro_ce_dataframe_scan;
+static zend_object_handlers quicpro_df_scan_handlers;
+
+typedef struct {
+    uint32_t         field;
+    quicpro_df_cmp_t op;
+    zval             value;
+} qp_scan_filter_t;
+
+typedef struct {
+    zend_long groups, groups_skipped, batches, rows, bytes_read, bytes_spilled;
+} qp_scan_stats_t;
+
+typedef struct {
+    php_stream           *stream;
+    int                   fd;               /* Local files: for read-ahead hints; -1 otherwise */
+    uint64_t              size;
+    bool                  arrow;
+    quicpro_df_parquet_t  pq;
+
+    /* Arrow: the messages lie in [arrow_begin, arrow_end) */
+    uint64_t              arrow_begin, arrow_end, arrow_pos, arrow_first;
+    zend_string          *arrow_schema;     /* The messages before the first batch */
+    smart_str             arrow_head;       /* ...and those seen since, in this pass */
+    uint64_t              arrow_last;       /* The last batch's bytes, to prefetch as many */
+
+    /* The file's fields */
+    uint32_t              nfields;
+    zend_string         **names;
+    quicpro_df_type_t    *types;
+
+    /* Options */
+    uint32_t             *project;
+    uint32_t              nproject;
+    qp_scan_filter_t     *filters;
+    uint32_t              nfilters;
+    unsigned              prefetch;
+    size_t                spill_limit;
+    zend_string          *spill_dir;
+
+    /* The pass: the fields it hands on, and those it reads, filter fields first */
+    uint32_t             *want, nwant;
+    uint32_t             *read, nread, nread_filters;
+    size_t                group;            /* Parquet: the next row group */
+    size_t                prefetched;       /* Parquet: row groups up to this one were asked for */
+    zval                  current;
+    zend_long             key;
+
+    qp_scan_stats_t       stats;
+    zend_object           std;
+} quicpro_df_scan_object;
+
+static inline quicpro_df_scan_object *qp_scan_from_obj(zend_object *obj)
+{
+    return (quicpro_df_scan_object *)((char *)obj - XtOffsetOf(quicpro_df_scan_object, std));
+}
+
+#define THIS_SCAN() qp_scan_from_obj(Z_OBJ_P(ZEND_THIS))
+
+static bool qp_scan_malformed(const char *what)
+{
+    zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame::scan(): malformed file (%s)", what);
+    return false;
+}
+
+static int64_t qp_scan_field(const quicpro_df_scan_object *s, const zend_string *name)
+{
+    for (uint32_t i = 0; i < s->nfields; i++) {
+        if (zend_string_equals(s->names[i], name)) {
+            return i;
+        }
+    }
+    zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame has no column '%s'", ZSTR_VAL(name));
+    return -1;
+}
+
+/*──────────────────────────── Reading ────────────────────────────────────*/
+
+static bool qp_scan_read(quicpro_df_scan_object *s, uint64_t off, void *buf, size_t len)
+{
+    size_t done = 0;
+    if (off > s->size || len > s->size - off) {
+        return qp_scan_malformed("truncated");
+    }
+    if (php_stream_seek(s->stream, (zend_off_t)off, SEEK_SET) != 0) {
+        if (!EG(exception)) {
+            zend_throw_exception_ex(NULL, 0, "DataFrame::scan(): cannot seek to byte %" PRIu64, off);
+        }
+        return false;
+    }
+    while (done < len) {
+        ssize_t n = php_stream_read(s->stream, (char *)buf + done, len - done);
+        if (n <= 0) {
+            if (!EG(exception)) {
+                zend_throw_exception_ex(NULL, 0, "DataFrame::scan(): read failed at byte %" PRIu64, off + done);
+            }
+            return false;
+        }
+        done += (size_t)n;
+    }
+    s->stats.bytes_read += (zend_long)len;
+    return true;
+}
+
+static void qp_scan_prefetch_range(quicpro_df_scan_object *s, uint64_t off, uint64_t len)
+{
+    if (!len || off >= s->size || quicpro_fs_prefetch(s->stream, off, len)) {
+        return;
+    }
+#if defined(POSIX_FADV_WILLNEED)
+    if (s->fd >= 0) {
+        posix_fadvise(s->fd, (off_t)off, (off_t)MIN(len, s->size - off), POSIX_FADV_WILLNEED);
+    }
+#endif
+}
+
+/* Asks for the pass's column chunks of the next row groups */
+static void qp_scan_prefetch_groups(quicpro_df_scan_object *s)
+{
+    size_t last = MIN(s->pq.ngroups, s->group + s->prefetch);
+    for (size_t g = MAX(s->group, s->prefetched); g < last; g++) {
+        for (uint32_t i = 0; i < s->nread; i++) {
+            const quicpro_df_parquet_chunk_t *c = &s->pq.groups[g].chunks[s->pq.fields[s->read[i]].leaf];
+            qp_scan_prefetch_range(s, c->offset, c->length);
+        }
+    }
+    s->prefetched = MAX(s->prefetched, last);
+}
+
+/* ANDs the filters over the `rows` rows of `got` into `sel`; no filters leave it empty */
+static bool qp_scan_select(const quicpro_df_scan_object *s, quicpro_df_column_t **got, int64_t rows,
+                           quicpro_df_selection_t *sel)
+{
+    size_t words = (size_t)((rows + 63) >> 6);
+    for (uint32_t i = 0; i < s->nfilters; i++) {
+        const qp_scan_filter_t *f = &s->filters[i];
+        quicpro_df_selection_t one = {0};
+        if (!quicpro_df_filter(got[f->field], f->op, (zval *)&f->value, &one)) {
+            quicpro_df_selection_free(sel);
+            return false;
+        }
+        if (!sel->bits) {
+            *sel = one;
+            continue;
+        }
+        for (size_t w = 0; w < words; w++) {
+            sel->bits[w] &= one.bits[w];
+        }
+        quicpro_df_selection_free(&one);
+    }
+    if (s->nfilters > 1) {
+        size_t morsels = quicpro_df_morsels(rows), per = QUICPRO_DF_MORSEL_ROWS / 64;
+        int64_t *counts = ecalloc(MAX(morsels, 1), sizeof(int64_t));
+        for (size_t w = 0; w < words; w++) {
+            counts[w / per] += __builtin_popcountll(sel->bits[w]);
+        }
+        quicpro_df_selection_finish(sel, counts);
+        efree(counts);
+    }
+    return true;
+}
+
+static bool qp_scan_read_chunk(quicpro_df_scan_object *s, const quicpro_df_parquet_group_t *g, uint32_t field,
+                               quicpro_df_column_t **out)
+{
+    const quicpro_df_parquet_field_t *f = &s->pq.fields[field];
+    const quicpro_df_parquet_chunk_t *c = &g->chunks[f->leaf];
+    if (c->length > s->size) {
+        return qp_scan_malformed("column chunk");
+    }
+    uint8_t *buf = emalloc((size_t)MAX(c->length, 1));
+    if (qp_scan_read(s, c->offset, buf, (size_t)c->length)) {
+        *out = quicpro_df_parquet_column(f, c, g->rows, buf, (size_t)c->length);
+    }
+    efree(buf);
+    return *out != NULL;
+}
+
+static int qp_scan_parquet_batch(quicpro_df_scan_object *s, quicpro_df_column_t **got, int64_t *rows,
+                                 quicpro_df_selection_t *sel)
+{
+    if (s->group >= s->pq.ngroups) {
+        return QP_SCAN_END;
+    }
+    const quicpro_df_parquet_group_t *g = &s->pq.groups[s->group++];
+    if (g->rows == 0) {
+        return QP_SCAN_EMPTY;
+    }
+    for (uint32_t i = 0; i < s->nfilters; i++) {
+        const qp_scan_filter_t *f = &s->filters[i];
+        const quicpro_df_parquet_field_t *field = &s->pq.fields[f->field];
+        if (!quicpro_df_parquet_may_match(field, &g->chunks[field->leaf], g->rows, f->op, (zval *)&f->value)) {
+            s->stats.groups_skipped++;
+            return QP_SCAN_EMPTY;
+        }
+    }
+    s->stats.groups++;
+
+    /* The other columns are not read where the filter columns matched no row */
+    uint32_t i = 0;
+    for (; i < s->nread_filters; i++) {
+        if (!qp_scan_read_chunk(s, g, s->read[i], &got[s->read[i]])) {
+            return QP_SCAN_ERROR;
+        }
+    }
+    if (!qp_scan_select(s, got, g->rows, sel)) {
+        return QP_SCAN_ERROR;
+    }
+    if (sel->bits && sel->count == 0) {
+        qp_scan_prefetch_groups(s);
+        return QP_SCAN_EMPTY;
+    }
+    for (; i < s->nread; i++) {
+        if (!qp_scan_read_chunk(s, g, s->read[i], &got[s->read[i]])) {
+            return QP_SCAN_ERROR;
+        }
+    }
+    qp_scan_prefetch_groups(s);
+    *rows = g->rows;
+    return QP_SCAN_BATCH;
+}
+
+/* The message at arrow_pos, its metadata read into *meta; 1, 0 at the end, -1 after throwing */
+static int qp_scan_arrow_message(quicpro_df_scan_object *s, uint8_t *type, zend_string **meta,
+                                 uint64_t *body_at, uint64_t *body_len)
+{
+    uint64_t at = s->arrow_pos, end = s->arrow_end;
+    uint8_t prefix[8];
+    if (at + 4 > end) {
+        return 0;
+    }
+    size_t avail = (size_t)MIN(8, end - at);
+    if (!qp_scan_read(s, at, prefix, avail)) {
+        return -1;
+    }
+    uint32_t len;
+    memcpy(&len, prefix, 4);
+    at += 4;
+    if (len == 0xFFFFFFFFu) {
+        if (avail < 8) {
+            qp_scan_malformed("truncated message");
+            return -1;
+        }
+        memcpy(&len, prefix + 4, 4);
+        at += 4;
+    }
+    if (len == 0) {
+        return 0;                               /* End of stream */
+    }
+    if (len > end - at) {
+        qp_scan_malformed("truncated metadata");
+        return -1;
+    }
+    *meta = zend_string_alloc(len, 0);
+    ZSTR_VAL(*meta)[len] = '\0';
+    if (!qp_scan_read(s, at, ZSTR_VAL(*meta), len)) {
+        zend_string_release(*meta);
+        return -1;
+    }
+    at += len;
+    if (!quicpro_df_ipc_message_info((const uint8_t *)ZSTR_VAL(*meta), len, type, body_len) || *body_len > end - at) {
+        zend_string_release(*meta);
+        qp_scan_malformed("message");
+        return -1;
+    }
+    *body_at = at;
+    s->arrow_pos = at + *body_len;
+    return 1;
+}
+
+/* Appends a message, normalized to the continuation form, to `out` at `to`; false after throwing */
+static bool qp_scan_arrow_put(quicpro_df_scan_object *s, char *to, const zend_string *meta, uint64_t body_at, uint64_t body_len)
+{
+    uint32_t prefix[2] = { 0xFFFFFFFFu, (uint32_t)ZSTR_LEN(meta) };
+    memcpy(to, prefix, 8);
+    memcpy(to + 8, ZSTR_VAL(meta), ZSTR_LEN(meta));
+    return qp_scan_read(s, body_at, to + 8 + ZSTR_LEN(meta), (size_t)body_len);
+}
+
+static int qp_scan_arrow_batch(quicpro_df_scan_object *s, quicpro_df_column_t **got, int64_t *rows,
+                               quicpro_df_selection_t *sel)
+{
+    for (;;) {
+        uint8_t type;
+        zend_string *meta;
+        uint64_t body_at, body_len;
+        int rc = qp_scan_arrow_message(s, &type, &meta, &body_at, &body_len);
+        if (rc <= 0) {
+            return rc < 0 ? QP_SCAN_ERROR : QP_SCAN_END;
+        }
+        size_t msg = 8 + ZSTR_LEN(meta) + (size_t)body_len;
+
+        if (type != QUICPRO_DF_IPC_RECORD_BATCH) {
+            /* Schema and dictionaries go in front of every batch after them */
+            size_t len = s->arrow_head.s ? ZSTR_LEN(s->arrow_head.s) : 0;
+            smart_str_alloc(&s->arrow_head, msg, 0);
+            bool ok = qp_scan_arrow_put(s, ZSTR_VAL(s->arrow_head.s) + len, meta, body_at, body_len);
+            ZSTR_LEN(s->arrow_head.s) = len + msg;
+            zend_string_release(meta);
+            if (!ok) {
+                return QP_SCAN_ERROR;
+            }
+            continue;
+        }
+
+        size_t head = s->arrow_head.s ? ZSTR_LEN(s->arrow_head.s) : 0;
+        zend_string *ipc = zend_string_alloc(head + msg + 8, 0);
+        static const uint32_t eos[2] = { 0xFFFFFFFFu, 0 };
+        if (head) {
+            memcpy(ZSTR_VAL(ipc), ZSTR_VAL(s->arrow_head.s), head);
+        }
+        bool ok = qp_scan_arrow_put(s, ZSTR_VAL(ipc) + head, meta, body_at, body_len);
+        memcpy(ZSTR_VAL(ipc) + head + msg, eos, 8);
+        ZSTR_VAL(ipc)[head + msg + 8] = '\0';
+        zend_string_release(meta);
+
+        zval frame;
+        ok = ok && quicpro_df_ipc_decode(ipc, &frame);
+        zend_string_release(ipc);
+        if (!ok) {
+            return QP_SCAN_ERROR;
+        }
+        quicpro_dataframe_object *df = quicpro_dataframe_from_obj(Z_OBJ(frame));
+        if (df->ncols != s->nfields) {
+            zval_ptr_dtor(&frame);
+            qp_scan_malformed("record batch unlike the schema");
+            return QP_SCAN_ERROR;
+        }
+        for (uint32_t i = 0; i < s->nread; i++) {
+            got[s->read[i]] = quicpro_df_column_addref(df->cols[s->read[i]]);
+        }
+        *rows = df->rows;
+        zval_ptr_dtor(&frame);
+
+        s->stats.groups++;
+        s->arrow_last = msg;
+        qp_scan_prefetch_range(s, s->arrow_pos, (uint64_t)msg * s->prefetch);
+        if (*rows == 0) {
+            return QP_SCAN_EMPTY;
+        }
+        if (!qp_scan_select(s, got, *rows, sel)) {
+            return QP_SCAN_ERROR;
+        }
+        return sel->bits && sel->count == 0 ? QP_SCAN_EMPTY : QP_SCAN_BATCH;
+    }
+}
+
+/*
+ * The pass's columns of the rows of the next batch that pass the filters
+ * into `cols` (nwant of them), and their count into *rows. QP_SCAN_BATCH,
+ * QP_SCAN_END once the file is done, or QP_SCAN_ERROR after throwing.
+ */
+static int qp_scan_next(quicpro_df_scan_object *s, quicpro_df_column_t **cols, int64_t *rows)
+{
+    quicpro_df_column_t **got = ecalloc(MAX(s->nfields, 1), sizeof(quicpro_df_column_t *));
+    int rc;
+
+    do {
+        quicpro_df_selection_t sel = {0};
+        int64_t n = 0;
+        memset(got, 0, MAX(s->nfields, 1) * sizeof(quicpro_df_column_t *));
+        rc = s->arrow ? qp_scan_arrow_batch(s, got, &n, &sel) : qp_scan_parquet_batch(s, got, &n, &sel);
+        if (rc == QP_SCAN_BATCH) {
+            bool all = !sel.bits || sel.count == n;
+            for (uint32_t i = 0; i < s->nwant; i++) {
+                cols[i] = all ? quicpro_df_column_addref(got[s->want[i]]) : quicpro_df_column_take(got[s->want[i]], &sel);
+                if (!cols[i]) {
+                    while (i--) {
+                        quicpro_df_column_release(cols[i]);
+                    }
+                    rc = QP_SCAN_ERROR;
+                    break;
+                }
+            }
+            *rows = all ? n : sel.count;
+        }
+        quicpro_df_selection_free(&sel);
+        for (uint32_t i = 0; i < s->nfields; i++) {
+            if (got[i]) {
+                quicpro_df_column_release(got[i]);
+            }
+        }
+    } while (rc == QP_SCAN_EMPTY);
+
+    efree(got);
+    if (rc == QP_SCAN_BATCH) {
+        s->stats.batches++;
+        s->stats.rows += *rows;
+    }
+    return rc;
+}
+
+/* Starts a pass from the first batch, handing on the fields `want` (copied) */
+static void qp_scan_begin(quicpro_df_scan_object *s, const uint32_t *want, uint32_t nwant)
+{
+    if (s->want) {
+        efree(s->want);
+        efree(s->read);
+    }
+    s->want = safe_emalloc(MAX(nwant, 1), sizeof(uint32_t), 0);
+    s->read = safe_emalloc(MAX(s->nfields, 1), sizeof(uint32_t), 0);
+    memcpy(s->want, want, nwant * sizeof(uint32_t));
+    s->nwant = nwant;
+    s->nread = 0;
+
+    bool *seen = ecalloc(MAX(s->nfields, 1), sizeof(bool));
+    for (uint32_t i = 0; i < s->nfilters; i++) {
+        if (!seen[s->filters[i].field]) {
+            seen[s->filters[i].field] = true;
+            s->read[s->nread++] = s->filters[i].field;
+        }
+    }
+    s->nread_filters = s->nread;
+    for (uint32_t i = 0; i < nwant; i++) {
+        if (!seen[want[i]]) {
+            seen[want[i]] = true;
+            s->read[s->nread++] = want[i];
+        }
+    }
+    efree(seen);
+
+    s->group = 0;
+    s->prefetched = 0;
+    s->arrow_pos = s->arrow_first;
+    smart_str_free(&s->arrow_head);
+    if (s->arrow_schema) {
+        smart_str_append(&s->arrow_head, s->arrow_schema);
+    }
+    zval_ptr_dtor(&s->current);
+    ZVAL_UNDEF(&s->current);
+    s->key = 0;
+    if (!s->arrow) {
+        qp_scan_prefetch_groups(s);
+    }
+}
+
+/* The next batch of the iteration into `current`; false after throwing */
+static bool qp_scan_advance(quicpro_df_scan_object *s)
+{
+    quicpro_df_column_t **cols = safe_emalloc(MAX(s->nwant, 1), sizeof(quicpro_df_column_t *), 0);
+    int64_t rows;
+    zval_ptr_dtor(&s->current);
+    ZVAL_UNDEF(&s->current);
+
+    int rc = qp_scan_next(s, cols, &rows);
+    if (rc != QP_SCAN_BATCH) {
+        efree(cols);
+        return rc != QP_SCAN_ERROR;
+    }
+    zend_string **names = safe_emalloc(MAX(s->nwant, 1), sizeof(zend_string *), 0);
+    for (uint32_t i = 0; i < s->nwant; i++) {
+        names[i] = zend_string_copy(s->names[s->want[i]]);
+    }
+    quicpro_dataframe_wrap(&s->current, rows, s->nwant, names, cols);
+    return true;
+}
+
+/*──────────────────────────── Opening ────────────────────────────────────*/
+
+static bool qp_scan_open_parquet(quicpro_df_scan_object *s)
+{
+    uint8_t tail[8];
+    if (s->size < 12 || !qp_scan_read(s, s->size - 8, tail, 8)) {
+        return EG(exception) ? false : qp_scan_malformed("too short for Parquet");
+    }
+    uint32_t footer_len;
+    memcpy(&footer_len, tail, 4);
+    if (memcmp(tail + 4, QUICPRO_DF_PARQUET_MAGIC, 4) != 0 || footer_len > s->size - 12) {
+        return qp_scan_malformed("Parquet footer");
+    }
+    zend_string *footer = zend_string_alloc(footer_len, 0);
+    ZSTR_VAL(footer)[footer_len] = '\0';
+    bool ok = qp_scan_read(s, s->size - 8 - footer_len, ZSTR_VAL(footer), footer_len)
+        && quicpro_df_parquet_open(&s->pq, footer);
+    zend_string_release(footer);
+    if (!ok) {
+        return false;
+    }
+    s->nfields = s->pq.nfields;
+    s->names = safe_emalloc(MAX(s->nfields, 1), sizeof(zend_string *), 0);
+    s->types = safe_emalloc(MAX(s->nfields, 1), sizeof(quicpro_df_type_t), 0);
+    for (uint32_t i = 0; i < s->nfields; i++) {
+        s->names[i] = zend_string_copy(s->pq.fields[i].name);
+        s->types[i] = s->pq.fields[i].type;
+    }
+    return true;
+}
+
+static bool qp_scan_open_arrow(quicpro_df_scan_object *s, bool file)
+{
+    s->arrow = true;
+    s->arrow_begin = 0;
+    s->arrow_end = s->size;
+    if (file) {
+        /* The stream after the magic, and the footer (left unread) with its length and the magic after it */
+        uint8_t tail[10];
+        if (s->size < 18 || !qp_scan_read(s, s->size - 10, tail, 10)) {
+            return EG(exception) ? false : qp_scan_malformed("too short for Arrow");
+        }
+        uint32_t footer_len;
+        memcpy(&footer_len, tail, 4);
+        if (memcmp(tail + 4, QP_SCAN_ARROW_MAGIC, 6) != 0 || footer_len > s->size - 18) {
+            return qp_scan_malformed("Arrow footer");
+        }
+        s->arrow_begin = 8;
+        s->arrow_end = s->size - 10 - footer_len;
+    }
+
+    /* The schema, and the dictionaries ahead of the first batch */
+    s->arrow_pos = s->arrow_begin;
+    for (;;) {
+        uint64_t at = s->arrow_pos, body_at, body_len;
+        uint8_t type;
+        zend_string *meta;
+        int rc = qp_scan_arrow_message(s, &type, &meta, &body_at, &body_len);
+        if (rc < 0) {
+            return false;
+        }
+        if (rc == 0) {
+            break;
+        }
+        if (type == QUICPRO_DF_IPC_RECORD_BATCH) {
+            zend_string_release(meta);
+            s->arrow_pos = at;
+            break;
+        }
+        size_t len = s->arrow_head.s ? ZSTR_LEN(s->arrow_head.s) : 0, msg = 8 + ZSTR_LEN(meta) + (size_t)body_len;
+        smart_str_alloc(&s->arrow_head, msg, 0);
+        bool ok = qp_scan_arrow_put(s, ZSTR_VAL(s->arrow_head.s) + len, meta, body_at, body_len);
+        ZSTR_LEN(s->arrow_head.s) = len + msg;
+        zend_string_release(meta);
+        if (!ok) {
+            return false;
+        }
+    }
+    s->arrow_first = s->arrow_pos;
+    if (!s->arrow_head.s) {
+        return qp_scan_malformed("no schema");
+    }
+    smart_str_0(&s->arrow_head);
+    s->arrow_schema = zend_string_copy(s->arrow_head.s);
+
+    /* The head alone is a stream of no rows, whose frame has the fields' names and types */
+    zend_string *head = zend_string_concat2(ZSTR_VAL(s->arrow_schema), ZSTR_LEN(s->arrow_schema),
+                                            "\xff\xff\xff\xff\0\0\0\0", 8);
+    zval frame;
+    bool ok = quicpro_df_ipc_decode(head, &frame);
+    zend_string_release(head);
+    if (!ok) {
+        return false;
+    }
+    quicpro_dataframe_object *df = quicpro_dataframe_from_obj(Z_OBJ(frame));
+    s->nfields = df->ncols;
+    s->names = safe_emalloc(MAX(s->nfields, 1), sizeof(zend_string *), 0);
+    s->types = safe_emalloc(MAX(s->nfields, 1), sizeof(quicpro_df_type_t), 0);
+    for (uint32_t i = 0; i < s->nfields; i++) {
+        s->names[i] = zend_string_copy(df->names[i]);
+        s->types[i] = df->cols[i]->type;
+    }
+    zval_ptr_dtor(&frame);
+    return true;
+}
+
+static bool qp_scan_parse_filter(quicpro_df_scan_object *s, zval *triple)
+{
+    zval *col = NULL, *op = NULL, *value = NULL;
+    quicpro_df_cmp_t cmp;
+    ZVAL_DEREF(triple);
+    if (Z_TYPE_P(triple) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL_P(triple)) == 3) {
+        col = zend_hash_index_find(Z_ARRVAL_P(triple), 0);
+        op = zend_hash_index_find(Z_ARRVAL_P(triple), 1);
+        value = zend_hash_index_find(Z_ARRVAL_P(triple), 2);
+    }
+    if (col) ZVAL_DEREF(col);
+    if (op) ZVAL_DEREF(op);
+    if (!col || !op || !value || Z_TYPE_P(col) != IS_STRING || Z_TYPE_P(op) != IS_STRING) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "DataFrame::scan(): a filter is [column, comparison, value]");
+        return false;
+    }
+    if (!quicpro_df_cmp_parse(Z_STR_P(op), &cmp)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "DataFrame::scan(): unknown comparison '%s'; use ==, !=, <, <=, > or >=", Z_STRVAL_P(op));
+        return false;
+    }
+    int64_t field = qp_scan_field(s, Z_STR_P(col));
+    if (field < 0) {
+        return false;
+    }
+    if (!s->arrow && !s->pq.fields[field].readable) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "DataFrame::scan(): Parquet column '%s' has a physical type that cannot be read", Z_STRVAL_P(col));
+        return false;
+    }
+    qp_scan_filter_t *f = &s->filters[s->nfilters++];
+    f->field = (uint32_t)field;
+    f->op = cmp;
+    ZVAL_COPY_DEREF(&f->value, value);
+    return true;
+}
+
+static bool qp_scan_options(quicpro_df_scan_object *s, HashTable *options)
+{
+    zval *v;
+    if (options && (v = zend_hash_str_find_deref(options, ZEND_STRL("columns")))) {
+        zval *name;
+        if (Z_TYPE_P(v) != IS_ARRAY) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame::scan(): 'columns' is a list of column names");
+            return false;
+        }
+        s->project = safe_emalloc(MAX(zend_hash_num_elements(Z_ARRVAL_P(v)), 1), sizeof(uint32_t), 0);
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(v), name) {
+            ZVAL_DEREF(name);
+            if (Z_TYPE_P(name) != IS_STRING) {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "DataFrame::scan(): 'columns' takes column names, got %s", zend_zval_type_name(name));
+                return false;
+            }
+            int64_t field = qp_scan_field(s, Z_STR_P(name));
+            if (field < 0) {
+                return false;
+            }
+            for (uint32_t i = 0; i < s->nproject; i++) {
+                if (s->project[i] == (uint32_t)field) {
+                    zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                        "DataFrame::scan(): 'columns' names '%s' twice", Z_STRVAL_P(name));
+                    return false;
+                }
+            }
+            s->project[s->nproject++] = (uint32_t)field;
+        } ZEND_HASH_FOREACH_END();
+    } else {
+        /* Every field that can be read */
+        s->project = safe_emalloc(MAX(s->nfields, 1), sizeof(uint32_t), 0);
+        for (uint32_t i = 0; i < s->nfields; i++) {
+            if (s->arrow || s->pq.fields[i].readable) {
+                s->project[s->nproject++] = i;
+            }
+        }
+    }
+
+    if (options && (v = zend_hash_str_find_deref(options, ZEND_STRL("filter")))) {
+        zval *first = Z_TYPE_P(v) == IS_ARRAY ? zend_hash_index_find(Z_ARRVAL_P(v), 0) : NULL;
+        if (first) ZVAL_DEREF(first);
+        if (!first) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame::scan(): 'filter' is [column, comparison, value] or a list of them");
+            return false;
+        }
+        if (Z_TYPE_P(first) == IS_ARRAY) {
+            zval *triple;
+            s->filters = safe_emalloc(zend_hash_num_elements(Z_ARRVAL_P(v)), sizeof(qp_scan_filter_t), 0);
+            ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(v), triple) {
+                if (!qp_scan_parse_filter(s, triple)) {
+                    return false;
+                }
+            } ZEND_HASH_FOREACH_END();
+        } else {
+            s->filters = emalloc(sizeof(qp_scan_filter_t));
+            if (!qp_scan_parse_filter(s, v)) {
+                return false;
+            }
+        }
+    }
+
+    if (options && (v = zend_hash_str_find_deref(options, ZEND_STRL("prefetch")))) {
+        if (Z_TYPE_P(v) != IS_LONG || Z_LVAL_P(v) < 0 || Z_LVAL_P(v) > 64) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame::scan(): 'prefetch' is 0 to 64 batches");
+            return false;
+        }
+        s->prefetch = (unsigned)Z_LVAL_P(v);
+    }
+    if (options && (v = zend_hash_str_find_deref(options, ZEND_STRL("spill_mb")))) {
+        if (Z_TYPE_P(v) != IS_LONG || Z_LVAL_P(v) < 1) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame::scan(): 'spill_mb' is a positive number of MB");
+            return false;
+        }
+        s->spill_limit = (size_t)Z_LVAL_P(v) << 20;
+    }
+    if (options && (v = zend_hash_str_find_deref(options, ZEND_STRL("spill_dir")))) {
+        if (Z_TYPE_P(v) != IS_STRING || Z_STRLEN_P(v) == 0) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "DataFrame::scan(): 'spill_dir' is a directory");
+            return false;
+        }
+        s->spill_dir = zend_string_copy(Z_STR_P(v));
+    }
+    for (uint32_t i = 0; !s->arrow && i < s->nproject; i++) {
+        if (!s->pq.fields[s->project[i]].readable) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame::scan(): Parquet column '%s' has a physical type that cannot be read",
+                ZSTR_VAL(s->names[s->project[i]]));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool quicpro_df_scan_open(zval *out, zend_string *path, HashTable *options)
+{
+    php_stream *stream = php_stream_open_wrapper(ZSTR_VAL(path), "rb", REPORT_ERRORS, NULL);
+    if (!stream) {
+        if (!EG(exception)) {
+            zend_throw_exception_ex(NULL, 0, "DataFrame::scan(): cannot open '%s'", ZSTR_VAL(path));
+        }
+        return false;
+    }
+    object_init_ex(out, quicpro_ce_dataframe_scan);
+    quicpro_df_scan_object *s = qp_scan_from_obj(Z_OBJ_P(out));
+    s->stream = stream;
+
+    php_stream_statbuf ssb;
+    if (php_stream_stat(stream, &ssb) != 0) {
+        zend_throw_exception_ex(NULL, 0, "DataFrame::scan(): cannot stat '%s'", ZSTR_VAL(path));
+        goto fail;
+    }
+    s->size = (uint64_t)ssb.sb.st_size;
+    if (php_stream_is(stream, PHP_STREAM_IS_STDIO)
+        && php_stream_cast(stream, PHP_STREAM_AS_FD, (void **)&s->fd, 0) != SUCCESS) {
+        s->fd = -1;
+    }
+
+    uint8_t magic[8] = {0};
+    if (!qp_scan_read(s, 0, magic, (size_t)MIN(8, s->size))) {
+        goto fail;
+    }
+    bool ok;
+    if (s->size >= 4 && memcmp(magic, QUICPRO_DF_PARQUET_MAGIC, 4) == 0) {
+        ok = qp_scan_open_parquet(s);
+    } else if (s->size >= 6 && memcmp(magic, QP_SCAN_ARROW_MAGIC, 6) == 0) {
+        ok = qp_scan_open_arrow(s, true);
+    } else if (s->size >= 4 && memcmp(magic, "\xff\xff\xff\xff", 4) == 0) {
+        ok = qp_scan_open_arrow(s, false);
+    } else {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "DataFrame::scan(): '%s' is neither a Parquet nor an Arrow IPC file", ZSTR_VAL(path));
+        goto fail;
+    }
+    if (!ok || !qp_scan_options(s, options)) {
+        goto fail;
+    }
+    s->stats.bytes_read = 0;
+    qp_scan_begin(s, s->project, s->nproject);
+    return true;
+
+fail:
+    zval_ptr_dtor(out);
+    ZVAL_UNDEF(out);
+    return false;
+}
+
+/*──────────────────────────── Aggregates ─────────────────────────────────*/
+
+typedef struct {
+    zend_string        *alias;          /* Points into the spec */
+    quicpro_df_agg_fn_t fn;
+    int64_t             field;          /* -1: the rows */
+    uint32_t            at;             /* The field's place among the pass's columns */
+} qp_scan_agg_t;
+
+/* Resolves the aggregates like DataFrame::aggregate() does, against the file's fields; NULL after throwing */
+static qp_scan_agg_t *qp_scan_parse_aggs(const quicpro_df_scan_object *s, HashTable *spec)
+{
+    uint32_t n = zend_hash_num_elements(spec), i = 0;
+    qp_scan_agg_t *aggs = safe_emalloc(MAX(n, 1), sizeof(qp_scan_agg_t), 0);
+    zend_string *alias;
+    zend_ulong idx;
+    zval *v;
+
+    ZEND_HASH_FOREACH_KEY_VAL(spec, idx, alias, v) {
+        zend_string *fn_name = NULL, *col_name = NULL;
+        quicpro_df_agg_fn_t fn;
+        (void)idx;
+
+        ZVAL_DEREF(v);
+        if (!alias) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame aggregates are keyed by the name of their result");
+            goto fail;
+        }
+        if (Z_TYPE_P(v) == IS_STRING) {
+            fn_name = Z_STR_P(v);
+        } else if (Z_TYPE_P(v) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL_P(v)) == 2) {
+            zval *f = zend_hash_index_find(Z_ARRVAL_P(v), 0), *c = zend_hash_index_find(Z_ARRVAL_P(v), 1);
+            if (f) ZVAL_DEREF(f);
+            if (c) ZVAL_DEREF(c);
+            if (f && c && Z_TYPE_P(f) == IS_STRING && Z_TYPE_P(c) == IS_STRING) {
+                fn_name = Z_STR_P(f);
+                col_name = Z_STR_P(c);
+            }
+        }
+        if (!fn_name) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame aggregate '%s' must be 'count' or [function, column]", ZSTR_VAL(alias));
+            goto fail;
+        }
+        if (!quicpro_df_agg_parse(fn_name, &fn)) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame aggregate '%s': unknown function '%s'; use count, sum, mean, min or max",
+                ZSTR_VAL(alias), ZSTR_VAL(fn_name));
+            goto fail;
+        }
+        int64_t field = -1;
+        if (col_name) {
+            if ((field = qp_scan_field(s, col_name)) < 0) {
+                goto fail;
+            }
+            if (!quicpro_df_agg_accepts(fn, s->types[field])) {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "DataFrame aggregate '%s': %s does not apply to the %s column '%s'",
+                    ZSTR_VAL(alias), ZSTR_VAL(fn_name), quicpro_df_type_name(s->types[field]), ZSTR_VAL(col_name));
+                goto fail;
+            }
+            if (!s->arrow && !s->pq.fields[field].readable) {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "DataFrame::scan(): Parquet column '%s' has a physical type that cannot be read", ZSTR_VAL(col_name));
+                goto fail;
+            }
+        } else if (fn != QUICPRO_DF_COUNT) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame aggregate '%s': %s needs a column", ZSTR_VAL(alias), ZSTR_VAL(fn_name));
+            goto fail;
+        }
+        aggs[i].alias = alias;
+        aggs[i].fn = fn;
+        aggs[i++].field = field;
+    } ZEND_HASH_FOREACH_END();
+    return aggs;
+
+fail:
+    efree(aggs);
+    return NULL;
+}
+
+/* Adds the aggregates' fields to the pass's `want` (nwant so far), and points each aggregate at its place */
+static void qp_scan_want_aggs(uint32_t *want, uint32_t *nwant, qp_scan_agg_t *aggs, uint32_t naggs)
+{
+    for (uint32_t a = 0; a < naggs; a++) {
+        if (aggs[a].field < 0) {
+            continue;
+        }
+        uint32_t i = 0;
+        while (i < *nwant && want[i] != (uint32_t)aggs[a].field) {
+            i++;
+        }
+        if (i == *nwant) {
+            want[(*nwant)++] = (uint32_t)aggs[a].field;
+        }
+        aggs[a].at = i;
+    }
+}
+
+/*──────────────────────────── Grouping ───────────────────────────────────*/
+
+typedef struct {
+    quicpro_df_column_t **cols;
+    int64_t               rows;
+} qp_scan_run_t;
+
+typedef struct {
+    uint64_t off, len;
+} qp_scan_segment_t;
+
+/*
+ * A groupBy() pass: runs of partial aggregates (the key columns, then a
+ * column per partial), each run grouped within itself but not with the
+ * others until they are compacted into one.
+ */
+typedef struct {
+    quicpro_df_scan_object *s;
+    uint32_t                nkeys, npartials, ncols;
+    quicpro_df_agg_fn_t    *partial;        /* Per partial: what a batch computes */
+    int64_t                *partial_at;     /* Per partial: its column in the batch, -1: the rows */
+    qp_scan_run_t          *runs;
+    size_t                  nruns, cap;
+    int64_t                 pending, compacted;
+    int                     fd;             /* The spill file; -1 until the state first spills */
+    uint64_t                spilled;
+    qp_scan_segment_t      *segs[QP_SCAN_SPILL_PARTS];
+    size_t                  nsegs[QP_SCAN_SPILL_PARTS];
+} qp_scan_groups_t;
+
+static void qp_scan_run_free(qp_scan_run_t *run, uint32_t ncols)
+{
+    for (uint32_t i = 0; i < ncols; i++) {
+        quicpro_df_column_release(run->cols[i]);
+    }
+    efree(run->cols);
+    run->cols = NULL;
+}
+
+static void qp_scan_groups_clear(qp_scan_groups_t *g)
+{
+    for (size_t r = 0; r < g->nruns; r++) {
+        qp_scan_run_free(&g->runs[r], g->ncols);
+    }
+    g->nruns = 0;
+    g->pending = 0;
+    g->compacted = 0;
+}
+
+/* Takes over `cols` */
+static void qp_scan_groups_add(qp_scan_groups_t *g, quicpro_df_column_t **cols, int64_t rows)
+{
+    if (g->nruns == g->cap) {
+        g->cap = g->cap ? g->cap * 2 : 8;
+        g->runs = safe_erealloc(g->runs, g->cap, sizeof(qp_scan_run_t), 0);
+    }
+    g->runs[g->nruns++] = (qp_scan_run_t){ cols, rows };
+    g->pending += rows;
+}
+
+/* Merges all runs into one; false after throwing */
+static bool qp_scan_groups_compact(qp_scan_groups_t *g)
+{
+    if (g->nruns <= 1) {
+        g->pending = 0;
+        g->compacted = g->nruns ? g->runs[0].rows : 0;
+        return true;
+    }
+    quicpro_df_column_t **all = safe_emalloc(g->ncols, sizeof(quicpro_df_column_t *), 0);
+    quicpro_df_column_t **parts = safe_emalloc(g->nruns, sizeof(quicpro_df_column_t *), 0);
+    quicpro_df_agg_t *merge = safe_emalloc(MAX(g->npartials, 1), sizeof(quicpro_df_agg_t), 0);
+    int64_t rows = 0;
+    uint32_t built = 0;
+    bool ok = true;
+
+    for (size_t r = 0; r < g->nruns; r++) {
+        rows += g->runs[r].rows;
+    }
+    for (; built < g->ncols; built++) {
+        for (size_t r = 0; r < g->nruns; r++) {
+            parts[r] = g->runs[r].cols[built];
+        }
+        if (!(all[built] = quicpro_df_column_concat(parts, g->nruns))) {
+            ok = false;
+            break;
+        }
+    }
+    quicpro_df_column_t **out = NULL;
+    if (ok) {
+        /* Counts add up; sums, minimums and maximums of partials are those of their rows */
+        for (uint32_t p = 0; p < g->npartials; p++) {
+            merge[p].fn = g->partial[p] == QUICPRO_DF_COUNT ? QUICPRO_DF_SUM : g->partial[p];
+            merge[p].col = all[g->nkeys + p];
+        }
+        out = safe_emalloc(g->ncols, sizeof(quicpro_df_column_t *), 0);
+        ok = quicpro_df_group_by(all, g->nkeys, merge, g->npartials, rows, out, out + g->nkeys);
+    }
+    for (uint32_t i = 0; i < built; i++) {
+        quicpro_df_column_release(all[i]);
+    }
+    efree(all);
+    efree(parts);
+    efree(merge);
+    if (!ok) {
+        if (out) {
+            efree(out);
+        }
+        return false;
+    }
+    qp_scan_groups_clear(g);
+    qp_scan_groups_add(g, out, out[0]->length);
+    g->pending = 0;
+    g->compacted = out[0]->length;
+    return true;
+}
+
+static size_t qp_scan_groups_bytes(const qp_scan_groups_t *g)
+{
+    size_t bytes = 0;
+    for (size_t r = 0; r < g->nruns; r++) {
+        for (uint32_t i = 0; i < g->ncols; i++) {
+            const quicpro_df_column_t *c = g->runs[r].cols[i];
+            bytes += c->bytes + (c->dictionary ? c->dictionary->bytes : 0);
+        }
+    }
+    return bytes;
+}
+
+static inline uint64_t qp_scan_mix(uint64_t h, uint64_t v)
+{
+    h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    return h;
+}
+
+/* Which partition the key of `row` goes to: the same for equal keys in any run, whatever their columns' types */
+static unsigned qp_scan_partition(quicpro_df_column_t *const *keys, uint32_t nkeys, int64_t row)
+{
+    uint64_t h = 0;
+    for (uint32_t k = 0; k < nkeys; k++) {
+        const quicpro_df_column_t *c = keys[k];
+        uint64_t v = 0x6e756c6cull;
+        if (quicpro_df_valid(c, row)) {
+            switch (c->type) {
+                case QUICPRO_DF_INT64:
+                    v = ((const uint64_t *)c->values)[row];
+                    break;
+                case QUICPRO_DF_FLOAT64: {
+                    double d = ((const double *)c->values)[row];
+                    if (d == 0) {
+                        d = 0;
+                    } else if (isnan(d)) {
+                        d = NAN;
+                    }
+                    memcpy(&v, &d, sizeof(v));
+                    break;
+                }
+                case QUICPRO_DF_BOOL:
+                    v = quicpro_df_bit(c->values, row);
+                    break;
+                case QUICPRO_DF_UTF8:
+                case QUICPRO_DF_DICT: {
+                    const quicpro_df_column_t *strs = c->type == QUICPRO_DF_DICT ? c->dictionary : c;
+                    int64_t i = c->type == QUICPRO_DF_DICT ? ((const int32_t *)c->values)[row] : row;
+                    const int32_t *offsets = strs->values;
+                    v = zend_inline_hash_func(strs->data + offsets[i], (size_t)(offsets[i + 1] - offsets[i]));
+                    break;
+                }
+            }
+        }
+        h = qp_scan_mix(h, v);
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return (unsigned)(h % QP_SCAN_SPILL_PARTS);
+}
+
+static bool qp_scan_spill_error(const char *what)
+{
+    zend_throw_exception_ex(NULL, 0, "DataFrame::groupBy(): cannot %s the spill file: %s", what, strerror(errno));
+    return false;
+}
+
+/* Appends `rows` rows of `cols` to the spill file as a segment of partition `part` */
+static bool qp_scan_spill_write(qp_scan_groups_t *g, unsigned part, quicpro_df_column_t **cols, int64_t rows)
+{
+    zend_string **names = safe_emalloc(g->ncols, sizeof(zend_string *), 0);
+    quicpro_df_column_t **refs = safe_emalloc(g->ncols, sizeof(quicpro_df_column_t *), 0);
+    for (uint32_t i = 0; i < g->ncols; i++) {
+        names[i] = zend_long_to_str(i);
+        refs[i] = quicpro_df_column_addref(cols[i]);
+    }
+    zval frame;
+    quicpro_df_ipc_t ipc;
+    quicpro_dataframe_wrap(&frame, rows, g->ncols, names, refs);
+    quicpro_df_ipc_plan(quicpro_dataframe_from_obj(Z_OBJ(frame)), &ipc);
+
+    bool ok = true;
+    uint64_t at = g->spilled;
+    for (size_t i = 0; ok && i < ipc.count; i++) {
+        const uint8_t *p = quicpro_df_ipc_chunk_data(&ipc, i);
+        size_t len = ipc.chunks[i].len;
+        while (len) {
+            ssize_t n = pwrite(g->fd, p, len, (off_t)at);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                ok = qp_scan_spill_error("write");
+                break;
+            }
+            p += n;
+            len -= (size_t)n;
+            at += (uint64_t)n;
+        }
+    }
+    if (ok) {
+        g->segs[part] = safe_erealloc(g->segs[part], g->nsegs[part] + 1, sizeof(qp_scan_segment_t), 0);
+        g->segs[part][g->nsegs[part]++] = (qp_scan_segment_t){ g->spilled, at - g->spilled };
+        g->s->stats.bytes_spilled += (zend_long)(at - g->spilled);
+        g->spilled = at;
+    }
+    quicpro_df_ipc_free(&ipc);
+    zval_ptr_dtor(&frame);
+    return ok;
+}
+
+/* Compacts the state and writes it out by partition; false after throwing */
+static bool qp_scan_spill(qp_scan_groups_t *g)
+{
+    if (!qp_scan_groups_compact(g)) {
+        return false;
+    }
+    if (!g->nruns) {
+        return true;
+    }
+    if (g->fd < 0) {
+        zend_string *opened = NULL;
+        const char *dir = g->s->spill_dir ? ZSTR_VAL(g->s->spill_dir) : NULL;
+        if ((g->fd = php_open_temporary_fd(dir, "quicpro-df-spill", &opened)) < 0) {
+            return qp_scan_spill_error("create");
+        }
+        unlink(ZSTR_VAL(opened));               /* Gone with the descriptor, however the request ends */
+        zend_string_release(opened);
+    }
+
+    qp_scan_run_t *run = &g->runs[0];
+    uint8_t *parts = emalloc((size_t)MAX(run->rows, 1));
+    size_t words = (size_t)((run->rows + 63) >> 6), morsels = quicpro_df_morsels(run->rows);
+    bool ok = true;
+    for (int64_t r = 0; r < run->rows; r++) {
+        parts[r] = (uint8_t)qp_scan_partition(run->cols, g->nkeys, r);
+    }
+    quicpro_df_column_t **cols = safe_emalloc(g->ncols, sizeof(quicpro_df_column_t *), 0);
+    for (unsigned p = 0; ok && p < QP_SCAN_SPILL_PARTS; p++) {
+        quicpro_df_selection_t sel = { .rows = run->rows };
+        int64_t *counts = ecalloc(MAX(morsels, 1), sizeof(int64_t));
+        sel.bits = calloc(MAX(words, 1), sizeof(uint64_t));
+        sel.base = safe_emalloc(MAX(morsels, 1), sizeof(int64_t), 0);
+        if (!sel.bits) {
+            efree(counts);
+            quicpro_df_selection_free(&sel);
+            zend_throw_exception_ex(NULL, 0, "DataFrame: out of memory for a selection of %" PRId64 " rows", run->rows);
+            ok = false;
+            break;
+        }
+        for (int64_t r = 0; r < run->rows; r++) {
+            if (parts[r] == p) {
+                sel.bits[r >> 6] |= 1ull << (r & 63);
+                counts[r / QUICPRO_DF_MORSEL_ROWS]++;
+            }
+        }
+        quicpro_df_selection_finish(&sel, counts);
+        efree(counts);
+        if (sel.count) {
+            uint32_t taken = 0;
+            for (; taken < g->ncols; taken++) {
+                if (!(cols[taken] = quicpro_df_column_take(run->cols[taken], &sel))) {
+                    ok = false;
+                    break;
+                }
+            }
+            ok = ok && qp_scan_spill_write(g, p, cols, sel.count);
+            while (taken--) {
+                quicpro_df_column_release(cols[taken]);
+            }
+        }
+        quicpro_df_selection_free(&sel);
+    }
+    efree(cols);
+    efree(parts);
+    qp_scan_groups_clear(g);
+    return ok;
+}
+
+/* Reads the segments of partition `part` back as runs */
+static bool qp_scan_spill_load(qp_scan_groups_t *g, unsigned part)
+{
+    for (size_t i = 0; i < g->nsegs[part]; i++) {
+        const qp_scan_segment_t *seg = &g->segs[part][i];
+        zend_string *buf = zend_string_alloc((size_t)seg->len, 0);
+        size_t done = 0;
+        while (done < seg->len) {
+            ssize_t n = pread(g->fd, ZSTR_VAL(buf) + done, (size_t)seg->len - done, (off_t)(seg->off + done));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                zend_string_release(buf);
+                return qp_scan_spill_error("read");
+            }
+            done += (size_t)n;
+        }
+        ZSTR_VAL(buf)[seg->len] = '\0';
+        zval frame;
+        bool ok = quicpro_df_ipc_decode(buf, &frame);
+        zend_string_release(buf);
+        if (!ok) {
+            return false;
+        }
+        quicpro_dataframe_object *df = quicpro_dataframe_from_obj(Z_OBJ(frame));
+        quicpro_df_column_t **cols = safe_emalloc(g->ncols, sizeof(quicpro_df_column_t *), 0);
+        for (uint32_t c = 0; c < g->ncols; c++) {
+            cols[c] = quicpro_df_column_addref(df->cols[c]);
+        }
+        qp_scan_groups_add(g, cols, df->rows);
+        zval_ptr_dtor(&frame);
+    }
+    return true;
+}
+
+/* The result columns of the compacted run: the keys, then one per aggregate */
+static bool qp_scan_groups_result(const qp_scan_groups_t *g, const qp_scan_agg_t *aggs, uint32_t naggs,
+                                  const uint32_t *first, quicpro_df_column_t **out)
+{
+    const qp_scan_run_t *run = &g->runs[0];
+    for (uint32_t k = 0; k < g->nkeys; k++) {
+        out[k] = quicpro_df_column_addref(run->cols[k]);
+    }
+    for (uint32_t a = 0; a < naggs; a++) {
+        quicpro_df_column_t *const *p = run->cols + g->nkeys + first[a];
+        out[g->nkeys + a] = aggs[a].fn == QUICPRO_DF_MEAN
+            ? quicpro_df_arith(p[0], QUICPRO_DF_DIV, p[1], NULL)
+            : quicpro_df_column_addref(p[0]);
+        if (!out[g->nkeys + a]) {
+            for (uint32_t i = 0; i < g->nkeys + a; i++) {
+                quicpro_df_column_release(out[i]);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+/*──────────────────────────── Methods ────────────────────────────────────*/
+
+PHP_METHOD(QuicproDataFrameScan, rewind)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_df_scan_object *s = THIS_SCAN();
+    qp_scan_begin(s, s->project, s->nproject);
+    if (!qp_scan_advance(s)) RETURN_THROWS();
+}
+
+PHP_METHOD(QuicproDataFrameScan, valid)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    RETURN_BOOL(!Z_ISUNDEF(THIS_SCAN()->current));
+}
+
+PHP_METHOD(QuicproDataFrameScan, current)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_df_scan_object *s = THIS_SCAN();
+    if (Z_ISUNDEF(s->current)) {
+        RETURN_NULL();
+    }
+    RETURN_COPY(&s->current);
+}
+
+PHP_METHOD(QuicproDataFrameScan, key)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_df_scan_object *s = THIS_SCAN();
+    if (Z_ISUNDEF(s->current)) {
+        RETURN_NULL();
+    }
+    RETURN_LONG(s->key);
+}
+
+PHP_METHOD(QuicproDataFrameScan, next)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_df_scan_object *s = THIS_SCAN();
+    if (Z_ISUNDEF(s->current)) {
+        return;
+    }
+    s->key++;
+    if (!qp_scan_advance(s)) RETURN_THROWS();
+}
+
+/* Column name => type, as DataFrame::types() reports them */
+PHP_METHOD(QuicproDataFrameScan, types)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_df_scan_object *s = THIS_SCAN();
+    array_init_size(return_value, s->nproject);
+    for (uint32_t i = 0; i < s->nproject; i++) {
+        quicpro_df_type_t type = s->types[s->project[i]];
+        if (type == QUICPRO_DF_UTF8 && !s->arrow && quicpro_high_perf_compute_ai_config.dataframe_string_interning_enable) {
+            type = QUICPRO_DF_DICT;
+        }
+        add_assoc_string(return_value, ZSTR_VAL(s->names[s->project[i]]), quicpro_df_type_name(type));
+    }
+}
+
+/* What the passes so far read and skipped */
+PHP_METHOD(QuicproDataFrameScan, stats)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_df_scan_object *s = THIS_SCAN();
+    array_init_size(return_value, 6);
+    add_assoc_long(return_value, "batches_read", s->stats.groups);
+    add_assoc_long(return_value, "batches_skipped", s->stats.groups_skipped);
+    add_assoc_long(return_value, "batches", s->stats.batches);
+    add_assoc_long(return_value, "rows", s->stats.rows);
+    add_assoc_long(return_value, "bytes_read", s->stats.bytes_read);
+    add_assoc_long(return_value, "bytes_spilled", s->stats.bytes_spilled);
+}
+
+/* Alias => value over the rows that pass the filters, in one pass */
+PHP_METHOD(QuicproDataFrameScan, aggregate)
+{
+    HashTable *spec;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT(spec)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_df_scan_object *s = THIS_SCAN();
+    qp_scan_agg_t *aggs = qp_scan_parse_aggs(s, spec);
+    if (!aggs) RETURN_THROWS();
+    uint32_t naggs = zend_hash_num_elements(spec), nwant = 0;
+    uint32_t *want = safe_emalloc(MAX(naggs, 1), sizeof(uint32_t), 0);
+    qp_scan_want_aggs(want, &nwant, aggs, naggs);
+    qp_scan_begin(s, want, nwant);
+    efree(want);
+
+    quicpro_df_agg_state_t *states = safe_emalloc(MAX(naggs, 1), sizeof(quicpro_df_agg_state_t), 0);
+    quicpro_df_column_t **cols = safe_emalloc(MAX(nwant, 1), sizeof(quicpro_df_column_t *), 0);
+    for (uint32_t a = 0; a < naggs; a++) {
+        quicpro_df_agg_init(&states[a]);
+    }
+    int64_t rows;
+    int rc;
+    while ((rc = qp_scan_next(s, cols, &rows)) == QP_SCAN_BATCH) {
+        for (uint32_t a = 0; a < naggs; a++) {
+            const quicpro_df_column_t *c = aggs[a].field < 0 ? NULL : cols[aggs[a].at];
+            quicpro_df_agg_state_t st;
+            quicpro_df_aggregate(c, rows, &st);
+            quicpro_df_agg_merge(&states[a], &st, c ? c->type : QUICPRO_DF_INT64);
+        }
+        for (uint32_t i = 0; i < nwant; i++) {
+            quicpro_df_column_release(cols[i]);
+        }
+    }
+    efree(cols);
+
+    if (rc != QP_SCAN_ERROR) {
+        array_init_size(return_value, naggs);
+        for (uint32_t a = 0; a < naggs; a++) {
+            zval result;
+            quicpro_df_type_t type = aggs[a].field < 0 ? QUICPRO_DF_INT64 : s->types[aggs[a].field];
+            quicpro_df_agg_result(aggs[a].fn, type, &states[a], &result);
+            zend_symtable_update(Z_ARRVAL_P(return_value), aggs[a].alias, &result);
+        }
+    }
+    efree(states);
+    efree(aggs);
+    if (rc == QP_SCAN_ERROR) RETURN_THROWS();
+}
+
+/*
+ * Runs the groupBy() pass with `g` set up: each batch's partial groups
+ * join the state, which is compacted and, past the spill limit, spilled.
+ */
+static bool qp_scan_group_pass(quicpro_df_scan_object *s, qp_scan_groups_t *g, uint32_t nwant)
+{
+    quicpro_df_column_t **cols = safe_emalloc(MAX(nwant, 1), sizeof(quicpro_df_column_t *), 0);
+    quicpro_df_agg_t *partial = safe_emalloc(MAX(g->npartials, 1), sizeof(quicpro_df_agg_t), 0);
+    int64_t rows;
+    int rc;
+    bool ok = true;
+
+    while (ok && (rc = qp_scan_next(s, cols, &rows)) == QP_SCAN_BATCH) {
+        quicpro_df_column_t **out = safe_emalloc(g->ncols, sizeof(quicpro_df_column_t *), 0);
+        for (uint32_t p = 0; p < g->npartials; p++) {
+            partial[p].fn = g->partial[p];
+            partial[p].col = g->partial_at[p] < 0 ? NULL : cols[g->partial_at[p]];
+        }
+        ok = quicpro_df_group_by(cols, g->nkeys, partial, g->npartials, rows, out, out + g->nkeys);
+        for (uint32_t i = 0; i < nwant; i++) {
+            quicpro_df_column_release(cols[i]);
+        }
+        if (!ok) {
+            efree(out);
+            break;
+        }
+        qp_scan_groups_add(g, out, out[0]->length);
+        if (g->pending >= MAX(QP_SCAN_COMPACT_ROWS, g->compacted)) {
+            ok = qp_scan_groups_compact(g)
+                && (qp_scan_groups_bytes(g) <= s->spill_limit || qp_scan_spill(g));
+        }
+    }
+    efree(partial);
+    efree(cols);
+    return ok && rc != QP_SCAN_ERROR;
+}
+
+/* A frame of the key columns, then one column per aggregate, with a row per group that passes the filters */
+PHP_METHOD(QuicproDataFrameScan, groupBy)
+{
+    HashTable *keys_ht = NULL, *spec;
+    zend_string *key_str = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_ARRAY_HT_OR_STR(keys_ht, key_str)
+        Z_PARAM_ARRAY_HT(spec)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_df_scan_object *s = THIS_SCAN();
+    zend_string *key_names[QUICPRO_DF_GROUP_KEYS_MAX];
+    uint32_t nkeys = 0;
+
+    if (key_str) {
+        key_names[nkeys++] = key_str;
+    } else {
+        zval *v;
+        if (zend_hash_num_elements(keys_ht) == 0 || zend_hash_num_elements(keys_ht) > QUICPRO_DF_GROUP_KEYS_MAX) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame::groupBy() takes 1 to %d key columns", QUICPRO_DF_GROUP_KEYS_MAX);
+            RETURN_THROWS();
+        }
+        ZEND_HASH_FOREACH_VAL(keys_ht, v) {
+            ZVAL_DEREF(v);
+            if (Z_TYPE_P(v) != IS_STRING) {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "DataFrame::groupBy() takes column names, got %s", zend_zval_type_name(v));
+                RETURN_THROWS();
+            }
+            key_names[nkeys++] = Z_STR_P(v);
+        } ZEND_HASH_FOREACH_END();
+    }
+
+    uint32_t naggs = zend_hash_num_elements(spec), nwant = 0;
+    uint32_t *want = safe_emalloc(nkeys + MAX(naggs, 1), sizeof(uint32_t), 0);
+    for (uint32_t k = 0; k < nkeys; k++) {
+        int64_t field = qp_scan_field(s, key_names[k]);
+        if (field < 0) {
+            efree(want);
+            RETURN_THROWS();
+        }
+        for (uint32_t j = 0; j < k; j++) {
+            if (want[j] == (uint32_t)field) {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "DataFrame::groupBy() names key column '%s' twice", ZSTR_VAL(key_names[k]));
+                efree(want);
+                RETURN_THROWS();
+            }
+        }
+        if (!s->arrow && !s->pq.fields[field].readable) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "DataFrame::scan(): Parquet column '%s' has a physical type that cannot be read", ZSTR_VAL(key_names[k]));
+            efree(want);
+            RETURN_THROWS();
+        }
+        want[nwant++] = (uint32_t)field;
+    }
+    qp_scan_agg_t *aggs = qp_scan_parse_aggs(s, spec);
+    if (!aggs) {
+        efree(want);
+        RETURN_THROWS();
+    }
+    for (uint32_t a = 0; a < naggs; a++) {
+        for (uint32_t k = 0; k < nkeys; k++) {
+            if (zend_string_equals(aggs[a].alias, s->names[want[k]])) {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "DataFrame aggregate '%s' has the name of a key column", ZSTR_VAL(aggs[a].alias));
+                efree(aggs);
+                efree(want);
+                RETURN_THROWS();
+            }
+        }
+    }
+    qp_scan_want_aggs(want, &nwant, aggs, naggs);
+
+    /* Partials: a mean is kept as its sum and count, and divided at the end */
+    qp_scan_groups_t g = { .s = s, .nkeys = nkeys, .fd = -1 };
+    uint32_t *first = safe_emalloc(MAX(naggs, 1), sizeof(uint32_t), 0);
+    g.partial = safe_emalloc(MAX(naggs, 1), 2 * sizeof(quicpro_df_agg_fn_t), 0);
+    g.partial_at = safe_emalloc(MAX(naggs, 1), 2 * sizeof(int64_t), 0);
+    for (uint32_t a = 0; a < naggs; a++) {
+        int64_t at = aggs[a].field < 0 ? -1 : (int64_t)aggs[a].at;
+        first[a] = g.npartials;
+        if (aggs[a].fn == QUICPRO_DF_MEAN) {
+            g.partial[g.npartials] = QUICPRO_DF_SUM;
+            g.partial_at[g.npartials++] = at;
+            g.partial[g.npartials] = QUICPRO_DF_COUNT;
+        } else {
+            g.partial[g.npartials] = aggs[a].fn;
+        }
+        g.partial_at[g.npartials++] = at;
+    }
+    g.ncols = nkeys + g.npartials;
+
+    qp_scan_begin(s, want, nwant);
+    bool ok = qp_scan_group_pass(s, &g, nwant);
+    if (ok && g.fd >= 0) {
+        ok = qp_scan_spill(&g);
+    } else if (ok) {
+        ok = qp_scan_groups_compact(&g);
+    }
+
+    /* The result, one partition at a time once the state spilled */
+    uint32_t ncols = nkeys + naggs;
+    size_t nresults = 0;
+    quicpro_df_column_t **results = safe_emalloc(QP_SCAN_SPILL_PARTS + 1, ncols * sizeof(quicpro_df_column_t *), 0);
+    for (unsigned p = 0; ok && p <= QP_SCAN_SPILL_PARTS; p++) {
+        if (g.fd >= 0) {
+            if (p == QP_SCAN_SPILL_PARTS) {
+                break;
+            }
+            ok = qp_scan_spill_load(&g, p) && qp_scan_groups_compact(&g);
+        } else if (p > 0) {
+            break;
+        }
+        if (ok && g.nruns) {
+            ok = qp_scan_groups_result(&g, aggs, naggs, first, results + nresults * ncols);
+            nresults += ok;
+        }
+        qp_scan_groups_clear(&g);
+    }
+
+    zend_string **names = NULL;
+    quicpro_df_column_t **cols = NULL;
+    if (ok) {
+        names = safe_emalloc(ncols, sizeof(zend_string *), 0);
+        cols = safe_emalloc(ncols, sizeof(quicpro_df_column_t *), 0);
+        quicpro_df_column_t **parts = safe_emalloc(MAX(nresults, 1), sizeof(quicpro_df_column_t *), 0);
+        uint32_t built = 0;
+        for (; ok && built < ncols; built++) {
+            if (nresults == 0) {
+                /* No group: empty columns of the types the groups would have had */
+                quicpro_df_type_t type = built < nkeys ? s->types[want[built]] : QUICPRO_DF_INT64;
+                if (built >= nkeys && aggs[built - nkeys].field >= 0) {
+                    type = quicpro_df_agg_type(aggs[built - nkeys].fn, s->types[aggs[built - nkeys].field]);
+                }
+                cols[built] = quicpro_df_column_new(type == QUICPRO_DF_DICT ? QUICPRO_DF_UTF8 : type, 0, false, 0);
+            } else if (nresults == 1) {
+                cols[built] = quicpro_df_column_addref(results[built]);
+            } else {
+                for (size_t r = 0; r < nresults; r++) {
+                    parts[r] = results[r * ncols + built];
+                }
+                cols[built] = quicpro_df_column_concat(parts, nresults);
+            }
+            if (!cols[built]) {
+                ok = false;
+                break;
+            }
+            names[built] = zend_string_copy(built < nkeys ? s->names[want[built]] : aggs[built - nkeys].alias);
+        }
+        efree(parts);
+        if (ok) {
+            quicpro_dataframe_wrap(return_value, cols[0]->length, ncols, names, cols);
+        } else {
+            for (uint32_t i = 0; i < built; i++) {
+                zend_string_release(names[i]);
+                quicpro_df_column_release(cols[i]);
+            }
+            efree(names);
+            efree(cols);
+        }
+    }
+
+    for (size_t i = 0; i < nresults * ncols; i++) {
+        quicpro_df_column_release(results[i]);
+    }
+    efree(results);
+    qp_scan_groups_clear(&g);
+    if (g.runs) {
+        efree(g.runs);
+    }
+    for (unsigned p = 0; p < QP_SCAN_SPILL_PARTS; p++) {
+        if (g.segs[p]) {
+            efree(g.segs[p]);
+        }
+    }
+    if (g.fd >= 0) {
+        close(g.fd);
+    }
+    efree(g.partial);
+    efree(g.partial_at);
+    efree(first);
+    efree(aggs);
+    efree(want);
+    if (!ok) RETURN_THROWS();
+}
+
+/*──────────────────────────── Life cycle ─────────────────────────────────*/
+
+static zend_object *qp_scan_create(zend_class_entry *ce)
+{
+    quicpro_df_scan_object *s = zend_object_alloc(sizeof(quicpro_df_scan_object), ce);
+    zend_object_std_init(&s->std, ce);
+    object_properties_init(&s->std, ce);
+    s->std.handlers = &quicpro_df_scan_handlers;
+
+    s->fd = -1;
+    s->prefetch = QP_SCAN_PREFETCH_DEFAULT;
+    size_t limit = (size_t)quicpro_high_perf_compute_ai_config.dataframe_memory_limit_mb << 20;
+    s->spill_limit = limit ? limit / 4 : (size_t)QP_SCAN_SPILL_DEFAULT_MB << 20;
+    ZVAL_UNDEF(&s->current);
+    return &s->std;
+}
+
+static void qp_scan_free_obj(zend_object *obj)
+{
+    quicpro_df_scan_object *s = qp_scan_from_obj(obj);
+    zval_ptr_dtor(&s->current);
+    if (s->stream) {
+        php_stream_close(s->stream);
+    }
+    quicpro_df_parquet_free(&s->pq);
+    if (s->arrow_schema) {
+        zend_string_release(s->arrow_schema);
+    }
+    smart_str_free(&s->arrow_head);
+    for (uint32_t i = 0; s->names && i < s->nfields; i++) {
+        zend_string_release(s->names[i]);
+    }
+    if (s->names) {
+        efree(s->names);
+        efree(s->types);
+    }
+    if (s->project) {
+        efree(s->project);
+    }
+    for (uint32_t i = 0; i < s->nfilters; i++) {
+        zval_ptr_dtor(&s->filters[i].value);
+    }
+    if (s->filters) {
+        efree(s->filters);
+    }
+    if (s->want) {
+        efree(s->want);
+        efree(s->read);
+    }
+    if (s->spill_dir) {
+        zend_string_release(s->spill_dir);
+    }
+    zend_object_std_dtor(obj);
+}
+
+/*──────────────────────────── Registration ───────────────────────────────*/
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_df_scan_current, 0, 0, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_quicpro_df_scan_key arginfo_quicpro_df_scan_current
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_df_scan_next, 0, 0, IS_VOID, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_quicpro_df_scan_rewind arginfo_quicpro_df_scan_next
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_df_scan_valid, 0, 0, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_df_scan_types, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_quicpro_df_scan_stats arginfo_quicpro_df_scan_types
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_df_scan_aggregate, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, aggregates, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_df_scan_group_by, 0, 2, Quicpro\\DataFrame, 0)
+    ZEND_ARG_TYPE_MASK(0, keys, MAY_BE_STRING | MAY_BE_ARRAY, NULL)
+    ZEND_ARG_TYPE_INFO(0, aggregates, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry quicpro_df_scan_methods[] = {
+    PHP_ME(QuicproDataFrameScan, rewind,    arginfo_quicpro_df_scan_rewind,    ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrameScan, valid,     arginfo_quicpro_df_scan_valid,     ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrameScan, current,   arginfo_quicpro_df_scan_current,   ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrameScan, key,       arginfo_quicpro_df_scan_key,       ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrameScan, next,      arginfo_quicpro_df_scan_next,      ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrameScan, types,     arginfo_quicpro_df_scan_types,     ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrameScan, stats,     arginfo_quicpro_df_scan_stats,     ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrameScan, aggregate, arginfo_quicpro_df_scan_aggregate, ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproDataFrameScan, groupBy,   arginfo_quicpro_df_scan_group_by,  ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+void quicpro_df_scan_minit(void)
+{
+    zend_class_entry ce;
+    INIT_NS_CLASS_ENTRY(ce, "Quicpro\\DataFrame", "Scan", quicpro_df_scan_methods);
+    quicpro_ce_dataframe_scan = zend_register_internal_class(&ce);
+    quicpro_ce_dataframe_scan->ce_flags |= ZEND_ACC_FINAL;
+#ifdef ZEND_ACC_NO_DYNAMIC_PROPERTIES
+    quicpro_ce_dataframe_scan->ce_flags |= ZEND_ACC_NO_DYNAMIC_PROPERTIES;
+#endif
+    quicpro_ce_dataframe_scan->create_object = qp_scan_create;
+    zend_class_implements(quicpro_ce_dataframe_scan, 1, zend_ce_iterator);
+
+    memcpy(&quicpro_df_scan_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    quicpro_df_scan_handlers.offset = XtOffsetOf(quicpro_df_scan_object, std);
+    quicpro_df_scan_handlers.free_obj = qp_scan_free_obj;
+    quicpro_df_scan_handlers.clone_obj = NULL;
+}
@@ -0,0 +1,329 @@
+/*
+ * src/gpu/collective.c – Quicpro\Gpu\Collective
+ * =============================================
+ *
+ * See include/gpu/collective.h. A group is one NCCL communicator on this
+ * process's device (gpu/device.h); an operation on a tensor is queued on
+ * the tensor's stream, so it runs after the copies that filled it and
+ * before anything that reads it.
+ */
+
+#include "php_quicpro.h"
+#include "gpu/collective.h"
+#include "gpu/tensor.h"
+#include "gpu/device.h"
+#include "config/high_perf_compute_and_ai/base_layer.h"
+
+#include <ext/spl/spl_exceptions.h>
+#include <zend_exceptions.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(QUICPRO_HAVE_CUDA) && defined(QUICPRO_HAVE_NCCL)
+#include <cuda_runtime_api.h>
+#include <nccl.h>
+#define QUICPRO_GPU_COLLECTIVES 1
+#endif
+
+zend_class_entry *quicpro_ce_gpu_collective;
+static zend_object_handlers quicpro_gpu_collective_handlers;
+
+typedef struct {
+#ifdef QUICPRO_GPU_COLLECTIVES
+    ncclComm_t  comm;
+#endif
+    pid_t       pid;                    /* A communicator does not survive fork() either */
+    int         rank, size;
+    zend_object std;
+} quicpro_gpu_collective_object;
+
+static inline quicpro_gpu_collective_object *qp_gpu_collective_from_obj(zend_object *obj)
+{
+    return (quicpro_gpu_collective_object *)((char *)obj - XtOffsetOf(quicpro_gpu_collective_object, std));
+}
+
+#define THIS_COLLECTIVE() qp_gpu_collective_from_obj(Z_OBJ_P(ZEND_THIS))
+
+#ifdef QUICPRO_GPU_COLLECTIVES
+
+static bool qp_gpu_dtype_nccl(quicpro_gpu_dtype_t dtype, ncclDataType_t *out)
+{
+    switch (dtype) {
+        case QUICPRO_GPU_FLOAT16:  *out = ncclFloat16; return true;
+#if NCCL_VERSION_CODE >= NCCL_VERSION(2, 10, 0)
+        case QUICPRO_GPU_BFLOAT16: *out = ncclBfloat16; return true;
+#endif
+        case QUICPRO_GPU_FLOAT32:  *out = ncclFloat32; return true;
+        case QUICPRO_GPU_FLOAT64:  *out = ncclFloat64; return true;
+        case QUICPRO_GPU_INT8:     *out = ncclInt8; return true;
+        case QUICPRO_GPU_UINT8:    *out = ncclUint8; return true;
+        case QUICPRO_GPU_INT32:    *out = ncclInt32; return true;
+        case QUICPRO_GPU_INT64:    *out = ncclInt64; return true;
+        default:                   return false;
+    }
+}
+
+/* The tensor an operation of `c` may run on, with its NCCL type; NULL with an exception thrown */
+static quicpro_gpu_tensor_object *qp_gpu_collective_operand(quicpro_gpu_collective_object *c, zval *zt, ncclDataType_t *type)
+{
+    quicpro_gpu_tensor_object *t = quicpro_gpu_tensor_from_obj(Z_OBJ_P(zt));
+
+    if (c->pid != getpid()) {
+        zend_throw_exception_ex(NULL, 0, "Collective group was not joined by this process; use Collective::join() (again, after fork())");
+        return NULL;
+    }
+    if (!qp_gpu_dtype_nccl(t->dtype, type)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Collective operations do not take %s tensors", quicpro_gpu_dtype_name(t->dtype));
+        return NULL;
+    }
+    return t;
+}
+
+#endif /* QUICPRO_GPU_COLLECTIVES */
+
+/*──────────────────────────── Methods ────────────────────────────────────*/
+
+/* The id rank 0 makes for a group and hands to the other ranks: 128 opaque bytes */
+PHP_METHOD(QuicproGpuCollective, uniqueId)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+#ifdef QUICPRO_GPU_COLLECTIVES
+    ncclUniqueId id;
+    ncclResult_t rc = ncclGetUniqueId(&id);
+    if (rc != ncclSuccess) {
+        zend_throw_exception_ex(NULL, 0, "Collective: ncclGetUniqueId() failed: %s", ncclGetErrorString(rc));
+        RETURN_THROWS();
+    }
+    RETURN_STRINGL(id.internal, sizeof(id.internal));
+#else
+    zend_throw_exception_ex(NULL, 0, "GPU collectives need CUDA and NCCL, which this build was made without (see config.m4)");
+    RETURN_THROWS();
+#endif
+}
+
+/* Joins the group of `size` ranks `id` names as `rank`; blocks until all have joined */
+PHP_METHOD(QuicproGpuCollective, join)
+{
+    zend_string *id;
+    zend_long rank, size;
+
+    ZEND_PARSE_PARAMETERS_START(3, 3)
+        Z_PARAM_STR(id)
+        Z_PARAM_LONG(rank)
+        Z_PARAM_LONG(size)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (size < 1 || size > INT_MAX || rank < 0 || rank >= size) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Collective rank must be from 0 to size - 1, and size at least 1");
+        RETURN_THROWS();
+    }
+#ifdef QUICPRO_GPU_COLLECTIVES
+    ncclUniqueId uid;
+    if (ZSTR_LEN(id) != sizeof(uid.internal)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Collective id must be the %zu bytes uniqueId() returns", sizeof(uid.internal));
+        RETURN_THROWS();
+    }
+    if (!quicpro_gpu_ready()) {
+        zend_throw_exception_ex(NULL, 0, "%s", quicpro_gpu_error());
+        RETURN_THROWS();
+    }
+    if (!quicpro_high_perf_compute_ai_config.gpu_p2p_enable) {
+        setenv("NCCL_P2P_DISABLE", "1", 0);     /* Read by NCCL as the group forms */
+    }
+    memcpy(uid.internal, ZSTR_VAL(id), sizeof(uid.internal));
+
+    object_init_ex(return_value, quicpro_ce_gpu_collective);
+    quicpro_gpu_collective_object *c = qp_gpu_collective_from_obj(Z_OBJ_P(return_value));
+    ncclResult_t rc = ncclCommInitRank(&c->comm, (int)size, uid, (int)rank);
+    if (rc != ncclSuccess) {
+        c->comm = NULL;
+        zval_ptr_dtor(return_value);
+        ZVAL_UNDEF(return_value);
+        zend_throw_exception_ex(NULL, 0, "Collective: joining as rank " ZEND_LONG_FMT " of " ZEND_LONG_FMT " failed: %s",
+                                rank, size, ncclGetErrorString(rc));
+        RETURN_THROWS();
+    }
+    c->pid = getpid();
+    c->rank = (int)rank;
+    c->size = (int)size;
+#else
+    zend_throw_exception_ex(NULL, 0, "GPU collectives need CUDA and NCCL, which this build was made without (see config.m4)");
+    RETURN_THROWS();
+#endif
+}
+
+/* Reduces the tensor across the group, in place on every rank: sum, prod, max, min or avg */
+PHP_METHOD(QuicproGpuCollective, allReduce)
+{
+    zval *zt;
+    zend_string *op_name = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_OBJECT_OF_CLASS(zt, quicpro_ce_gpu_tensor)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR(op_name)
+    ZEND_PARSE_PARAMETERS_END();
+
+#ifdef QUICPRO_GPU_COLLECTIVES
+    static const struct { const char *name; ncclRedOp_t op; } ops[] = {
+        { "sum", ncclSum }, { "prod", ncclProd }, { "max", ncclMax }, { "min", ncclMin },
+#if NCCL_VERSION_CODE >= NCCL_VERSION(2, 10, 0)
+        { "avg", ncclAvg },
+#endif
+    };
+    ncclRedOp_t op = ncclSum;
+    if (op_name) {
+        size_t i = 0;
+        while (i < sizeof(ops) / sizeof(ops[0]) && strcmp(ZSTR_VAL(op_name), ops[i].name) != 0) {
+            i++;
+        }
+        if (i == sizeof(ops) / sizeof(ops[0])) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "Collective reduction '%s' is unknown; use sum, prod, max, min or avg", ZSTR_VAL(op_name));
+            RETURN_THROWS();
+        }
+        op = ops[i].op;
+    }
+    quicpro_gpu_collective_object *c = THIS_COLLECTIVE();
+    ncclDataType_t type;
+    quicpro_gpu_tensor_object *t = qp_gpu_collective_operand(c, zt, &type);
+    if (!t) {
+        RETURN_THROWS();
+    }
+    ncclResult_t rc = ncclAllReduce(t->data, t->data, t->bytes / quicpro_gpu_dtype_size(t->dtype), type, op, c->comm,
+                                    (cudaStream_t)quicpro_gpu_stream_handle(t->stream));
+    if (rc != ncclSuccess) {
+        zend_throw_exception_ex(NULL, 0, "Collective: allReduce() failed: %s", ncclGetErrorString(rc));
+        RETURN_THROWS();
+    }
+#else
+    zend_throw_exception_ex(NULL, 0, "GPU collectives need CUDA and NCCL, which this build was made without (see config.m4)");
+    RETURN_THROWS();
+#endif
+}
+
+/* Gives every rank the tensor of rank `root`, in place */
+PHP_METHOD(QuicproGpuCollective, broadcast)
+{
+    zval *zt;
+    zend_long root = 0;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_OBJECT_OF_CLASS(zt, quicpro_ce_gpu_tensor)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(root)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_gpu_collective_object *c = THIS_COLLECTIVE();
+    if (root < 0 || root >= c->size) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Collective root must be a rank of the group (0 to %d)", c->size - 1);
+        RETURN_THROWS();
+    }
+#ifdef QUICPRO_GPU_COLLECTIVES
+    ncclDataType_t type;
+    quicpro_gpu_tensor_object *t = qp_gpu_collective_operand(c, zt, &type);
+    if (!t) {
+        RETURN_THROWS();
+    }
+    ncclResult_t rc = ncclBroadcast(t->data, t->data, t->bytes / quicpro_gpu_dtype_size(t->dtype), type, (int)root, c->comm,
+                                    (cudaStream_t)quicpro_gpu_stream_handle(t->stream));
+    if (rc != ncclSuccess) {
+        zend_throw_exception_ex(NULL, 0, "Collective: broadcast() failed: %s", ncclGetErrorString(rc));
+        RETURN_THROWS();
+    }
+#else
+    zend_throw_exception_ex(NULL, 0, "GPU collectives need CUDA and NCCL, which this build was made without (see config.m4)");
+    RETURN_THROWS();
+#endif
+}
+
+PHP_METHOD(QuicproGpuCollective, rank)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    RETURN_LONG(THIS_COLLECTIVE()->rank);
+}
+
+PHP_METHOD(QuicproGpuCollective, size)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    RETURN_LONG(THIS_COLLECTIVE()->size);
+}
+
+/*──────────────────────────── Life cycle ─────────────────────────────────*/
+
+static zend_object *qp_gpu_collective_create(zend_class_entry *ce)
+{
+    quicpro_gpu_collective_object *c = zend_object_alloc(sizeof(quicpro_gpu_collective_object), ce);
+    zend_object_std_init(&c->std, ce);
+    object_properties_init(&c->std, ce);
+    c->std.handlers = &quicpro_gpu_collective_handlers;
+    return &c->std;
+}
+
+static void qp_gpu_collective_free_obj(zend_object *obj)
+{
+#ifdef QUICPRO_GPU_COLLECTIVES
+    quicpro_gpu_collective_object *c = qp_gpu_collective_from_obj(obj);
+    if (c->comm && c->pid == getpid()) {
+        ncclCommDestroy(c->comm);
+    }
+#endif
+    zend_object_std_dtor(obj);
+}
+
+/*──────────────────────────── Registration ───────────────────────────────*/
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_gpu_collective_unique_id, 0, 0, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_gpu_collective_join, 0, 3, Quicpro\\Gpu\\Collective, 0)
+    ZEND_ARG_TYPE_INFO(0, id, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, rank, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO(0, size, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_gpu_collective_all_reduce, 0, 1, IS_VOID, 0)
+    ZEND_ARG_OBJ_INFO(0, tensor, Quicpro\\Gpu\\Tensor, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, op, IS_STRING, 0, "\"sum\"")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_gpu_collective_broadcast, 0, 1, IS_VOID, 0)
+    ZEND_ARG_OBJ_INFO(0, tensor, Quicpro\\Gpu\\Tensor, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, root, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_gpu_collective_rank, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_quicpro_gpu_collective_size arginfo_quicpro_gpu_collective_rank
+
+static const zend_function_entry quicpro_gpu_collective_methods[] = {
+    PHP_ME(QuicproGpuCollective, uniqueId,  arginfo_quicpro_gpu_collective_unique_id,  ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_ME(QuicproGpuCollective, join,      arginfo_quicpro_gpu_collective_join,       ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_ME(QuicproGpuCollective, allReduce, arginfo_quicpro_gpu_collective_all_reduce, ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGpuCollective, broadcast, arginfo_quicpro_gpu_collective_broadcast,  ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGpuCollective, rank,      arginfo_quicpro_gpu_collective_rank,       ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGpuCollective, size,      arginfo_quicpro_gpu_collective_size,       ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+void quicpro_gpu_collective_minit(void)
+{
+    zend_class_entry ce;
+    INIT_NS_CLASS_ENTRY(ce, "Quicpro\\Gpu", "Collective", quicpro_gpu_collective_methods);
+    quicpro_ce_gpu_collective = zend_register_internal_class(&ce);
+    quicpro_ce_gpu_collective->ce_flags |= ZEND_ACC_FINAL;
+#ifdef ZEND_ACC_NO_DYNAMIC_PROPERTIES
+    quicpro_ce_gpu_collective->ce_flags |= ZEND_ACC_NO_DYNAMIC_PROPERTIES;
+#endif
+    quicpro_ce_gpu_collective->create_object = qp_gpu_collective_create;
+
+    memcpy(&quicpro_gpu_collective_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    quicpro_gpu_collective_handlers.offset = XtOffsetOf(quicpro_gpu_collective_object, std);
+    quicpro_gpu_collective_handlers.free_obj = qp_gpu_collective_free_obj;
+    quicpro_gpu_collective_handlers.clone_obj = NULL;
+}
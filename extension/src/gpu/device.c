@@ -0,0 +1,435 @@
+/*
+ * src/gpu/device.c – The GPU a worker computes on
+ * ===============================================
+ *
+ * See include/gpu/device.h. The memory pool is a list of blocks sorted
+ * by offset, each free or in use; an allocation takes the smallest free
+ * block that fits and splits it, and a freed block merges with free
+ * neighbours, so the driver is called only to set the pool up.
+ *
+ * State is per process: the pid it was set up in tells a forked child
+ * that what it inherited belongs to a CUDA context it does not have.
+ */
+
+#include "php_quicpro.h"
+#include "gpu/device.h"
+#include "config/high_perf_compute_and_ai/base_layer.h"
+#include "server/reuseport.h"     /* The worker id quicpro.worker_gpu_affinity_map is keyed by */
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef QUICPRO_HAVE_CUDA
+#include <cuda_runtime_api.h>
+#endif
+
+typedef struct {
+    uint64_t off, len;
+    bool     used;
+} qp_gpu_block_t;
+
+static struct {
+    pid_t           pid;                /* 0: not set up */
+    int             device;
+    uint8_t        *base;
+    uint64_t        size, used;
+    qp_gpu_block_t *blocks;
+    uint32_t        nblocks, cap, allocations;
+#ifdef QUICPRO_HAVE_CUDA
+    cudaStream_t   *streams;
+    cudaEvent_t     staged[QUICPRO_GPU_STAGING_BUFFERS];
+#endif
+    uint32_t        nstreams, next_stream;
+    uint8_t        *staging[QUICPRO_GPU_STAGING_BUFFERS];
+    unsigned        next_staging;
+} qp_gpu;
+
+static char qp_gpu_why[256];
+
+bool quicpro_gpu_fail(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(qp_gpu_why, sizeof(qp_gpu_why), fmt, ap);
+    va_end(ap);
+    return false;
+}
+
+const char *quicpro_gpu_error(void)
+{
+    return qp_gpu_why;
+}
+
+/*──────────────────────────── Memory pool ────────────────────────────────*/
+
+static void qp_gpu_blocks_insert(uint32_t at, qp_gpu_block_t block)
+{
+    if (qp_gpu.nblocks == qp_gpu.cap) {
+        qp_gpu.cap = qp_gpu.cap ? qp_gpu.cap * 2 : 64;
+        qp_gpu.blocks = safe_perealloc(qp_gpu.blocks, qp_gpu.cap, sizeof(qp_gpu_block_t), 0, 1);
+    }
+    memmove(&qp_gpu.blocks[at + 1], &qp_gpu.blocks[at], (qp_gpu.nblocks - at) * sizeof(qp_gpu_block_t));
+    qp_gpu.blocks[at] = block;
+    qp_gpu.nblocks++;
+}
+
+static void qp_gpu_blocks_remove(uint32_t at)
+{
+    memmove(&qp_gpu.blocks[at], &qp_gpu.blocks[at + 1], (qp_gpu.nblocks - at - 1) * sizeof(qp_gpu_block_t));
+    qp_gpu.nblocks--;
+}
+
+void *quicpro_gpu_alloc(size_t bytes)
+{
+    uint64_t len = ((uint64_t)MAX(bytes, 1) + QUICPRO_GPU_ALIGN - 1) & ~(uint64_t)(QUICPRO_GPU_ALIGN - 1);
+    uint32_t best = UINT32_MAX;
+
+    for (uint32_t i = 0; i < qp_gpu.nblocks; i++) {
+        const qp_gpu_block_t *b = &qp_gpu.blocks[i];
+        if (!b->used && b->len >= len && (best == UINT32_MAX || b->len < qp_gpu.blocks[best].len)) {
+            best = i;
+        }
+    }
+    if (best == UINT32_MAX) {
+        quicpro_gpu_fail("GPU memory pool has no room for %zu bytes (%" PRIu64 " of %" PRIu64 " in use); see quicpro.gpu_memory_preallocation_mb",
+                    bytes, qp_gpu.used, qp_gpu.size);
+        return NULL;
+    }
+    qp_gpu_block_t *b = &qp_gpu.blocks[best];
+    if (b->len > len) {
+        qp_gpu_block_t rest = { b->off + len, b->len - len, false };
+        b->len = len;
+        qp_gpu_blocks_insert(best + 1, rest);
+        b = &qp_gpu.blocks[best];
+    }
+    b->used = true;
+    qp_gpu.used += b->len;
+    qp_gpu.allocations++;
+    return qp_gpu.base + b->off;
+}
+
+void quicpro_gpu_free(void *ptr)
+{
+    if (!ptr || qp_gpu.pid != getpid()) {
+        return;                                 /* Memory of a pool this process never had */
+    }
+    uint64_t off = (uint64_t)((uint8_t *)ptr - qp_gpu.base);
+    uint32_t lo = 0, hi = qp_gpu.nblocks;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (qp_gpu.blocks[mid].off < off) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == qp_gpu.nblocks || qp_gpu.blocks[lo].off != off || !qp_gpu.blocks[lo].used) {
+        return;
+    }
+    qp_gpu.blocks[lo].used = false;
+    qp_gpu.used -= qp_gpu.blocks[lo].len;
+    qp_gpu.allocations--;
+    if (lo + 1 < qp_gpu.nblocks && !qp_gpu.blocks[lo + 1].used) {
+        qp_gpu.blocks[lo].len += qp_gpu.blocks[lo + 1].len;
+        qp_gpu_blocks_remove(lo + 1);
+    }
+    if (lo > 0 && !qp_gpu.blocks[lo - 1].used) {
+        qp_gpu.blocks[lo - 1].len += qp_gpu.blocks[lo].len;
+        qp_gpu_blocks_remove(lo);
+    }
+}
+
+void quicpro_gpu_stats(quicpro_gpu_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (qp_gpu.pid != getpid()) {
+        out->device = -1;
+        return;
+    }
+    out->device = qp_gpu.device;
+    out->pool_bytes = qp_gpu.size;
+    out->used_bytes = qp_gpu.used;
+    out->allocations = qp_gpu.allocations;
+    out->streams = qp_gpu.nstreams;
+    for (uint32_t i = 0; i < qp_gpu.nblocks; i++) {
+        if (!qp_gpu.blocks[i].used) {
+            out->largest_free = MAX(out->largest_free, qp_gpu.blocks[i].len);
+        }
+    }
+}
+
+/*──────────────────────────── Set-up ─────────────────────────────────────*/
+
+/*
+ * The GPU quicpro.worker_gpu_affinity_map gives this worker ("0:0, 1:0, 2:1-2",
+ * validated like the CPU map); workers sharing a range spread over it by
+ * id. Device 0 outside a cluster and for workers the map leaves out.
+ */
+static int qp_gpu_affine_device(void)
+{
+    int worker = quicpro_reuseport_worker_id();
+    const char *p = quicpro_high_perf_compute_ai_config.worker_gpu_affinity_map;
+
+    if (worker < 0 || !p) {
+        return 0;
+    }
+    while (*p) {
+        char *end;
+        long w = strtol(p, &end, 10);
+        long first = *end == ':' ? strtol(end + 1, &end, 10) : -1;
+        long last = *end == '-' ? strtol(end + 1, &end, 10) : first;
+        if (w == worker && first >= 0 && last >= first) {
+            return (int)(first + worker % (last - first + 1));
+        }
+        p = strchr(end, ',');
+        if (!p) {
+            break;
+        }
+        p++;
+    }
+    return 0;
+}
+
+#ifdef QUICPRO_HAVE_CUDA
+
+static bool qp_gpu_cuda_fail(const char *what, cudaError_t err)
+{
+    return quicpro_gpu_fail("GPU: %s failed: %s", what, cudaGetErrorString(err));
+}
+
+/* What set-up got to, in any order */
+static void qp_gpu_release(void)
+{
+    for (unsigned i = 0; i < QUICPRO_GPU_STAGING_BUFFERS; i++) {
+        if (qp_gpu.staged[i]) {
+            cudaEventDestroy(qp_gpu.staged[i]);
+        }
+        if (qp_gpu.staging[i]) {
+            cudaFreeHost(qp_gpu.staging[i]);
+        }
+    }
+    for (uint32_t i = 0; i < qp_gpu.nstreams; i++) {
+        cudaStreamDestroy(qp_gpu.streams[i]);
+    }
+    if (qp_gpu.streams) {
+        pefree(qp_gpu.streams, 1);
+    }
+    if (qp_gpu.base) {
+        cudaFree(qp_gpu.base);
+    }
+    if (qp_gpu.blocks) {
+        pefree(qp_gpu.blocks, 1);
+    }
+    memset(&qp_gpu, 0, sizeof(qp_gpu));
+}
+
+static bool qp_gpu_setup(void)
+{
+    cudaError_t err;
+    int count = 0;
+
+    if ((err = cudaGetDeviceCount(&count)) != cudaSuccess) {
+        return qp_gpu_cuda_fail("cudaGetDeviceCount()", err);
+    }
+    if (count == 0) {
+        return quicpro_gpu_fail("GPU: no CUDA device is present");
+    }
+    qp_gpu.device = qp_gpu_affine_device();
+    if (qp_gpu.device >= count) {
+        return quicpro_gpu_fail("GPU: quicpro.worker_gpu_affinity_map puts worker %d on GPU %d, but there are %d",
+                                quicpro_reuseport_worker_id(), qp_gpu.device, count);
+    }
+    if ((err = cudaSetDevice(qp_gpu.device)) != cudaSuccess) {
+        return qp_gpu_cuda_fail("cudaSetDevice()", err);
+    }
+
+    qp_gpu.size = (uint64_t)quicpro_high_perf_compute_ai_config.gpu_memory_preallocation_mb << 20;
+    if ((err = cudaMalloc((void **)&qp_gpu.base, (size_t)qp_gpu.size)) != cudaSuccess) {
+        qp_gpu.base = NULL;
+        return qp_gpu_cuda_fail("preallocating quicpro.gpu_memory_preallocation_mb", err);
+    }
+    qp_gpu_blocks_insert(0, (qp_gpu_block_t){ 0, qp_gpu.size, false });
+
+    uint32_t nstreams = (uint32_t)MAX(quicpro_high_perf_compute_ai_config.cuda_stream_pool_size, 1);
+    qp_gpu.streams = pecalloc(nstreams, sizeof(cudaStream_t), 1);
+    for (; qp_gpu.nstreams < nstreams; qp_gpu.nstreams++) {
+        if ((err = cudaStreamCreateWithFlags(&qp_gpu.streams[qp_gpu.nstreams], cudaStreamNonBlocking)) != cudaSuccess) {
+            return qp_gpu_cuda_fail("cudaStreamCreateWithFlags()", err);
+        }
+    }
+    for (unsigned i = 0; i < QUICPRO_GPU_STAGING_BUFFERS; i++) {
+        if ((err = cudaHostAlloc((void **)&qp_gpu.staging[i], QUICPRO_GPU_STAGING_BYTES, cudaHostAllocDefault)) != cudaSuccess) {
+            qp_gpu.staging[i] = NULL;
+            return qp_gpu_cuda_fail("cudaHostAlloc()", err);
+        }
+        if ((err = cudaEventCreateWithFlags(&qp_gpu.staged[i], cudaEventDisableTiming)) != cudaSuccess) {
+            qp_gpu.staged[i] = NULL;
+            return qp_gpu_cuda_fail("cudaEventCreateWithFlags()", err);
+        }
+    }
+    return true;
+}
+
+#endif /* QUICPRO_HAVE_CUDA */
+
+bool quicpro_gpu_ready(void)
+{
+    if (qp_gpu.pid == getpid()) {
+        return true;
+    }
+    if (qp_gpu.pid) {
+        /* Inherited over fork(): the parent's context, not ours; forget it without calling the driver */
+        if (qp_gpu.blocks) {
+            pefree(qp_gpu.blocks, 1);
+        }
+#ifdef QUICPRO_HAVE_CUDA
+        if (qp_gpu.streams) {
+            pefree(qp_gpu.streams, 1);
+        }
+#endif
+        memset(&qp_gpu, 0, sizeof(qp_gpu));
+    }
+    if (!quicpro_high_perf_compute_ai_config.gpu_bindings_enable) {
+        return quicpro_gpu_fail("GPU bindings are disabled; see quicpro.gpu_bindings_enable");
+    }
+    const char *backend = quicpro_high_perf_compute_ai_config.gpu_default_backend;
+    if (backend && strcmp(backend, "auto") != 0 && strcmp(backend, "cuda") != 0) {
+        return quicpro_gpu_fail("GPU backend '%s' is not built; only 'cuda' is", backend);
+    }
+#ifdef QUICPRO_HAVE_CUDA
+    if (!qp_gpu_setup()) {
+        qp_gpu_release();
+        return false;
+    }
+    qp_gpu.pid = getpid();
+    return true;
+#else
+    return quicpro_gpu_fail("GPU bindings need CUDA, which this build was made without (libcudart, see config.m4)");
+#endif
+}
+
+void quicpro_gpu_mshutdown(void)
+{
+#ifdef QUICPRO_HAVE_CUDA
+    if (qp_gpu.pid == getpid()) {
+        qp_gpu_release();
+    }
+#endif
+}
+
+/*──────────────────────────── Transfers ──────────────────────────────────*/
+
+unsigned quicpro_gpu_stream(void)
+{
+    return qp_gpu.nstreams ? qp_gpu.next_stream++ % qp_gpu.nstreams : 0;
+}
+
+#ifdef QUICPRO_HAVE_CUDA
+
+uint8_t *quicpro_gpu_staging(void)
+{
+    unsigned i = qp_gpu.next_staging++ % QUICPRO_GPU_STAGING_BUFFERS;
+    cudaError_t err = cudaEventSynchronize(qp_gpu.staged[i]);
+    if (err != cudaSuccess) {
+        qp_gpu_cuda_fail("waiting for a pinned buffer", err);
+        return NULL;
+    }
+    return qp_gpu.staging[i];
+}
+
+static unsigned qp_gpu_staging_index(const uint8_t *staging)
+{
+    for (unsigned i = 0; i < QUICPRO_GPU_STAGING_BUFFERS; i++) {
+        if (qp_gpu.staging[i] == staging) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+bool quicpro_gpu_upload(void *device, uint8_t *staging, size_t len, unsigned stream)
+{
+    cudaStream_t s = qp_gpu.streams[stream % qp_gpu.nstreams];
+    cudaError_t err = cudaMemcpyAsync(device, staging, len, cudaMemcpyHostToDevice, s);
+    if (err == cudaSuccess) {
+        err = cudaEventRecord(qp_gpu.staged[qp_gpu_staging_index(staging)], s);
+    }
+    return err == cudaSuccess || qp_gpu_cuda_fail("copying to the device", err);
+}
+
+bool quicpro_gpu_download(void *host, const void *device, size_t len, unsigned stream)
+{
+    cudaStream_t s = qp_gpu.streams[stream % qp_gpu.nstreams];
+    for (size_t done = 0; done < len;) {
+        size_t n = MIN(len - done, QUICPRO_GPU_STAGING_BYTES);
+        uint8_t *staging = quicpro_gpu_staging();
+        if (!staging) {
+            return false;
+        }
+        cudaError_t err = cudaMemcpyAsync(staging, (const uint8_t *)device + done, n, cudaMemcpyDeviceToHost, s);
+        if (err == cudaSuccess) {
+            err = cudaStreamSynchronize(s);
+        }
+        if (err != cudaSuccess) {
+            return qp_gpu_cuda_fail("copying from the device", err);
+        }
+        memcpy((uint8_t *)host + done, staging, n);
+        done += n;
+    }
+    return true;
+}
+
+void *quicpro_gpu_stream_handle(unsigned stream)
+{
+    return qp_gpu.nstreams ? (void *)qp_gpu.streams[stream % qp_gpu.nstreams] : NULL;
+}
+
+bool quicpro_gpu_copy(void *to, const void *from, size_t len, unsigned stream)
+{
+    cudaError_t err = cudaMemcpyAsync(to, from, len, cudaMemcpyDeviceToDevice, qp_gpu.streams[stream % qp_gpu.nstreams]);
+    return err == cudaSuccess || qp_gpu_cuda_fail("copying on the device", err);
+}
+
+bool quicpro_gpu_sync(unsigned stream)
+{
+    cudaError_t err = cudaStreamSynchronize(qp_gpu.streams[stream % qp_gpu.nstreams]);
+    return err == cudaSuccess || qp_gpu_cuda_fail("cudaStreamSynchronize()", err);
+}
+
+#else /* Never set up without CUDA, so never called */
+
+uint8_t *quicpro_gpu_staging(void)
+{
+    quicpro_gpu_fail("GPU bindings need CUDA");
+    return NULL;
+}
+
+bool quicpro_gpu_upload(void *device, uint8_t *staging, size_t len, unsigned stream)
+{
+    return quicpro_gpu_fail("GPU bindings need CUDA");
+}
+
+bool quicpro_gpu_download(void *host, const void *device, size_t len, unsigned stream)
+{
+    return quicpro_gpu_fail("GPU bindings need CUDA");
+}
+
+void *quicpro_gpu_stream_handle(unsigned stream)
+{
+    return NULL;
+}
+
+bool quicpro_gpu_copy(void *to, const void *from, size_t len, unsigned stream)
+{
+    return quicpro_gpu_fail("GPU bindings need CUDA");
+}
+
+bool quicpro_gpu_sync(unsigned stream)
+{
+    return quicpro_gpu_fail("GPU bindings need CUDA");
+}
+
+#endif /* QUICPRO_HAVE_CUDA */
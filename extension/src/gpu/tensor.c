@@ -0,0 +1,482 @@
+/*
+ * src/gpu/tensor.c – Quicpro\Gpu\Tensor
+ * =====================================
+ *
+ * See include/gpu/tensor.h. A tensor is its place in the memory pool and
+ * the stream its copies were queued on; it is given back to the pool, once
+ * that stream is done with it, when the object goes.
+ */
+
+#include "php_quicpro.h"
+#include "gpu/tensor.h"
+#include "gpu/device.h"
+
+#include <ext/spl/spl_exceptions.h>
+#include <zend_exceptions.h>
+#include <inttypes.h>
+#include <string.h>
+
+zend_class_entry *quicpro_ce_gpu_tensor;
+static zend_object_handlers quicpro_gpu_tensor_handlers;
+
+#define THIS_TENSOR() quicpro_gpu_tensor_from_obj(Z_OBJ_P(ZEND_THIS))
+
+static const struct {
+    const char *name;
+    size_t      size;
+} qp_gpu_dtypes[] = {
+    [QUICPRO_GPU_FLOAT16]  = { "float16", 2 },
+    [QUICPRO_GPU_BFLOAT16] = { "bfloat16", 2 },
+    [QUICPRO_GPU_FLOAT32]  = { "float32", 4 },
+    [QUICPRO_GPU_FLOAT64]  = { "float64", 8 },
+    [QUICPRO_GPU_INT8]     = { "int8", 1 },
+    [QUICPRO_GPU_UINT8]    = { "uint8", 1 },
+    [QUICPRO_GPU_INT16]    = { "int16", 2 },
+    [QUICPRO_GPU_INT32]    = { "int32", 4 },
+    [QUICPRO_GPU_INT64]    = { "int64", 8 },
+};
+
+bool quicpro_gpu_dtype_parse(const char *name, size_t len, quicpro_gpu_dtype_t *out)
+{
+    for (size_t i = 0; i < sizeof(qp_gpu_dtypes) / sizeof(qp_gpu_dtypes[0]); i++) {
+        if (strlen(qp_gpu_dtypes[i].name) == len && memcmp(qp_gpu_dtypes[i].name, name, len) == 0) {
+            *out = (quicpro_gpu_dtype_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *quicpro_gpu_dtype_name(quicpro_gpu_dtype_t dtype)
+{
+    return qp_gpu_dtypes[dtype].name;
+}
+
+size_t quicpro_gpu_dtype_size(quicpro_gpu_dtype_t dtype)
+{
+    return qp_gpu_dtypes[dtype].size;
+}
+
+/* The bytes of a tensor of this shape; false past what any pool could hold */
+static bool qp_gpu_tensor_bytes(quicpro_gpu_dtype_t dtype, const int64_t *shape, uint32_t ndim, size_t *bytes)
+{
+    uint64_t n = quicpro_gpu_dtype_size(dtype);
+    for (uint32_t i = 0; i < ndim; i++) {
+        if (shape[i] < 0 || (shape[i] && n > (UINT64_MAX >> 1) / (uint64_t)shape[i])) {
+            return false;
+        }
+        n *= (uint64_t)shape[i];
+    }
+    if (n > SIZE_MAX) {
+        return false;
+    }
+    *bytes = (size_t)n;
+    return true;
+}
+
+void quicpro_gpu_tensor_wrap(zval *out, quicpro_gpu_dtype_t dtype, const int64_t *shape, uint32_t ndim,
+                             uint8_t *data, size_t bytes, unsigned stream)
+{
+    object_init_ex(out, quicpro_ce_gpu_tensor);
+    quicpro_gpu_tensor_object *t = quicpro_gpu_tensor_from_obj(Z_OBJ_P(out));
+    t->data = data;
+    t->bytes = bytes;
+    t->dtype = dtype;
+    t->ndim = ndim;
+    memcpy(t->shape, shape, ndim * sizeof(int64_t));
+    t->stream = stream;
+}
+
+size_t quicpro_gpu_shape_format(const int64_t *shape, uint32_t ndim, char *buf, size_t cap)
+{
+    size_t len = 0;
+    buf[0] = '\0';
+    for (uint32_t i = 0; i < ndim && len < cap; i++) {
+        len += (size_t)snprintf(buf + len, cap - len, i ? ",%" PRId64 : "%" PRId64, shape[i]);
+    }
+    return MIN(len, cap - 1);
+}
+
+bool quicpro_gpu_tensor_stack(zval *out, quicpro_gpu_tensor_object *const *items, uint32_t n)
+{
+    const quicpro_gpu_tensor_object *first = items[0];
+    int64_t shape[QUICPRO_GPU_TENSOR_DIMS_MAX];
+    size_t bytes;
+
+    if (first->ndim == QUICPRO_GPU_TENSOR_DIMS_MAX) {
+        return quicpro_gpu_fail("a batch of tensors has at most %d dimensions", QUICPRO_GPU_TENSOR_DIMS_MAX);
+    }
+    shape[0] = n;
+    memcpy(shape + 1, first->shape, first->ndim * sizeof(int64_t));
+    if (!qp_gpu_tensor_bytes(first->dtype, shape, first->ndim + 1, &bytes)) {
+        return quicpro_gpu_fail("a batch of %u tensors is too large", n);
+    }
+    uint8_t *data = quicpro_gpu_alloc(bytes);
+    if (!data) {
+        return false;
+    }
+    unsigned stream = quicpro_gpu_stream();
+    for (uint32_t i = 0; i < n; i++) {
+        /* Its own copies to the device first; they run on another stream */
+        if (!quicpro_gpu_sync(items[i]->stream)
+            || !quicpro_gpu_copy(data + (size_t)i * first->bytes, items[i]->data, first->bytes, stream)) {
+            quicpro_gpu_sync(stream);
+            quicpro_gpu_free(data);
+            return false;
+        }
+    }
+    quicpro_gpu_tensor_wrap(out, first->dtype, shape, first->ndim + 1, data, bytes, stream);
+    return true;
+}
+
+/*──────────────────────────── Uploads ────────────────────────────────────*/
+
+struct quicpro_gpu_upload_s {
+    quicpro_gpu_dtype_t dtype;
+    uint32_t            ndim;
+    int64_t             shape[QUICPRO_GPU_TENSOR_DIMS_MAX];
+    uint8_t            *device;
+    size_t              bytes;
+    size_t              sent;           /* Bytes whose copy to the device is queued */
+    uint8_t            *staging;        /* The pinned buffer filling; NULL: none yet */
+    size_t              filled;
+    unsigned            stream;
+};
+
+bool quicpro_gpu_tensor_header(quicpro_gpu_tensor_head_t *head, const uint8_t *name, size_t name_len,
+                               const uint8_t *value, size_t value_len)
+{
+    if (name_len == sizeof("content-type") - 1 && memcmp(name, "content-type", name_len) == 0) {
+        head->tensor = value_len == sizeof(QUICPRO_GPU_TENSOR_TYPE) - 1 && memcmp(value, QUICPRO_GPU_TENSOR_TYPE, value_len) == 0;
+        return head->tensor;
+    }
+    char *into;
+    size_t cap;
+    if (name_len == sizeof("quicpro-tensor-dtype") - 1 && memcmp(name, "quicpro-tensor-dtype", name_len) == 0) {
+        into = head->dtype;
+        cap = sizeof(head->dtype);
+    } else if (name_len == sizeof("quicpro-tensor-shape") - 1 && memcmp(name, "quicpro-tensor-shape", name_len) == 0) {
+        into = head->shape;
+        cap = sizeof(head->shape);
+    } else {
+        return false;
+    }
+    /* Too long for any type or shape: left empty, so that it does not parse */
+    size_t len = value_len < cap ? value_len : 0;
+    memcpy(into, value, len);
+    into[len] = '\0';
+    return true;
+}
+
+quicpro_gpu_upload_t *quicpro_gpu_upload_from_head(const quicpro_gpu_tensor_head_t *head)
+{
+    quicpro_gpu_dtype_t dtype;
+    int64_t shape[QUICPRO_GPU_TENSOR_DIMS_MAX];
+    uint32_t ndim = 0;
+
+    if (!quicpro_gpu_dtype_parse(head->dtype, strlen(head->dtype), &dtype)) {
+        quicpro_gpu_fail("tensor body has no known quicpro-tensor-dtype ('%s')", head->dtype);
+        return NULL;
+    }
+    /* "32,768"; "" for a scalar */
+    for (const char *p = head->shape; *p;) {
+        char *end;
+        long long dim = strtoll(p, &end, 10);
+        if (end == p || dim < 0 || ndim == QUICPRO_GPU_TENSOR_DIMS_MAX || (*end && *end != ',')) {
+            quicpro_gpu_fail("tensor body has a malformed quicpro-tensor-shape ('%s')", head->shape);
+            return NULL;
+        }
+        shape[ndim++] = dim;
+        p = *end ? end + 1 : end;
+    }
+    return quicpro_gpu_upload_begin(dtype, shape, ndim);
+}
+
+quicpro_gpu_upload_t *quicpro_gpu_upload_begin(quicpro_gpu_dtype_t dtype, const int64_t *shape, uint32_t ndim)
+{
+    size_t bytes;
+    if (!qp_gpu_tensor_bytes(dtype, shape, ndim, &bytes)) {
+        quicpro_gpu_fail("tensor shape is too large");
+        return NULL;
+    }
+    if (!quicpro_gpu_ready()) {
+        return NULL;
+    }
+    uint8_t *device = quicpro_gpu_alloc(bytes);
+    if (!device) {
+        return NULL;
+    }
+    quicpro_gpu_upload_t *up = ecalloc(1, sizeof(*up));
+    up->dtype = dtype;
+    up->ndim = ndim;
+    memcpy(up->shape, shape, ndim * sizeof(int64_t));
+    up->device = device;
+    up->bytes = bytes;
+    up->stream = quicpro_gpu_stream();
+    return up;
+}
+
+bool quicpro_gpu_upload_room(quicpro_gpu_upload_t *up, uint8_t **to, size_t *room)
+{
+    size_t left = up->bytes - up->sent - up->filled;
+    if (left == 0) {
+        *to = NULL;
+        *room = 0;
+        return true;
+    }
+    if (!up->staging && !(up->staging = quicpro_gpu_staging())) {
+        return false;
+    }
+    *to = up->staging + up->filled;
+    *room = MIN(left, QUICPRO_GPU_STAGING_BYTES - up->filled);
+    return true;
+}
+
+bool quicpro_gpu_upload_flush(quicpro_gpu_upload_t *up)
+{
+    if (!up->filled) {
+        up->staging = NULL;
+        return true;
+    }
+    bool ok = quicpro_gpu_upload(up->device + up->sent, up->staging, up->filled, up->stream);
+    up->sent += up->filled;
+    up->filled = 0;
+    up->staging = NULL;
+    return ok;
+}
+
+bool quicpro_gpu_upload_commit(quicpro_gpu_upload_t *up, size_t n)
+{
+    up->filled += n;
+    if (up->filled < QUICPRO_GPU_STAGING_BYTES && up->sent + up->filled < up->bytes) {
+        return true;
+    }
+    /* The buffer is full, or holds the last bytes: to the device, while the next one fills */
+    return quicpro_gpu_upload_flush(up);
+}
+
+bool quicpro_gpu_upload_finish(quicpro_gpu_upload_t *up, zval *out)
+{
+    if (up->sent != up->bytes) {
+        quicpro_gpu_fail("tensor body ended after %zu of its %zu bytes", up->sent + up->filled, up->bytes);
+        quicpro_gpu_upload_abort(up);
+        return false;
+    }
+    quicpro_gpu_tensor_wrap(out, up->dtype, up->shape, up->ndim, up->device, up->bytes, up->stream);
+    efree(up);
+    return true;
+}
+
+void quicpro_gpu_upload_abort(quicpro_gpu_upload_t *up)
+{
+    if (up->sent) {
+        quicpro_gpu_sync(up->stream);           /* Nothing may copy into memory the pool hands out again */
+    }
+    quicpro_gpu_free(up->device);
+    efree(up);
+}
+
+/*──────────────────────────── Methods ────────────────────────────────────*/
+
+/* A tensor of `bytes`, copied to the device through the pinned buffers */
+PHP_METHOD(QuicproGpuTensor, fromBytes)
+{
+    zend_string *bytes, *dtype_name;
+    HashTable *shape_ht;
+
+    ZEND_PARSE_PARAMETERS_START(3, 3)
+        Z_PARAM_STR(bytes)
+        Z_PARAM_STR(dtype_name)
+        Z_PARAM_ARRAY_HT(shape_ht)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_gpu_dtype_t dtype;
+    if (!quicpro_gpu_dtype_parse(ZSTR_VAL(dtype_name), ZSTR_LEN(dtype_name), &dtype)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Tensor dtype '%s' is unknown; use float16, bfloat16, float32, float64, int8, uint8, int16, int32 or int64",
+            ZSTR_VAL(dtype_name));
+        RETURN_THROWS();
+    }
+    int64_t shape[QUICPRO_GPU_TENSOR_DIMS_MAX];
+    uint32_t ndim = 0;
+    zval *dim;
+    if (zend_hash_num_elements(shape_ht) > QUICPRO_GPU_TENSOR_DIMS_MAX) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Tensor shape has at most %d dimensions", QUICPRO_GPU_TENSOR_DIMS_MAX);
+        RETURN_THROWS();
+    }
+    ZEND_HASH_FOREACH_VAL(shape_ht, dim) {
+        ZVAL_DEREF(dim);
+        if (Z_TYPE_P(dim) != IS_LONG || Z_LVAL_P(dim) < 0) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Tensor shape takes non-negative integers");
+            RETURN_THROWS();
+        }
+        shape[ndim++] = Z_LVAL_P(dim);
+    } ZEND_HASH_FOREACH_END();
+
+    size_t expected;
+    if (!qp_gpu_tensor_bytes(dtype, shape, ndim, &expected) || expected != ZSTR_LEN(bytes)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Tensor of this shape and dtype takes other than the %zu bytes given", ZSTR_LEN(bytes));
+        RETURN_THROWS();
+    }
+
+    quicpro_gpu_upload_t *up = quicpro_gpu_upload_begin(dtype, shape, ndim);
+    if (!up) {
+        zend_throw_exception_ex(NULL, 0, "%s", quicpro_gpu_error());
+        RETURN_THROWS();
+    }
+    const char *from = ZSTR_VAL(bytes);
+    uint8_t *to;
+    size_t room;
+    bool ok;
+    while ((ok = quicpro_gpu_upload_room(up, &to, &room)) && room) {
+        memcpy(to, from, room);
+        from += room;
+        if (!(ok = quicpro_gpu_upload_commit(up, room))) {
+            break;
+        }
+    }
+    if (!ok) {
+        quicpro_gpu_upload_abort(up);
+    }
+    if (!ok || !quicpro_gpu_upload_finish(up, return_value)) {
+        zend_throw_exception_ex(NULL, 0, "%s", quicpro_gpu_error());
+        RETURN_THROWS();
+    }
+}
+
+PHP_METHOD(QuicproGpuTensor, dtype)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    RETURN_STRING(quicpro_gpu_dtype_name(THIS_TENSOR()->dtype));
+}
+
+PHP_METHOD(QuicproGpuTensor, shape)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_gpu_tensor_object *t = THIS_TENSOR();
+    array_init_size(return_value, t->ndim);
+    for (uint32_t i = 0; i < t->ndim; i++) {
+        add_next_index_long(return_value, (zend_long)t->shape[i]);
+    }
+}
+
+PHP_METHOD(QuicproGpuTensor, byteLength)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    RETURN_LONG((zend_long)THIS_TENSOR()->bytes);
+}
+
+/* The data, copied to the heap once the copies queued before are done */
+PHP_METHOD(QuicproGpuTensor, toBytes)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_gpu_tensor_object *t = THIS_TENSOR();
+    zend_string *out = zend_string_alloc(t->bytes, 0);
+    if (!quicpro_gpu_download(ZSTR_VAL(out), t->data, t->bytes, t->stream)) {
+        zend_string_efree(out);
+        zend_throw_exception_ex(NULL, 0, "%s", quicpro_gpu_error());
+        RETURN_THROWS();
+    }
+    ZSTR_VAL(out)[t->bytes] = '\0';
+    RETURN_NEW_STR(out);
+}
+
+/* Waits until the tensor's data is on the device */
+PHP_METHOD(QuicproGpuTensor, synchronize)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    if (!quicpro_gpu_sync(THIS_TENSOR()->stream)) {
+        zend_throw_exception_ex(NULL, 0, "%s", quicpro_gpu_error());
+        RETURN_THROWS();
+    }
+}
+
+/* The memory pool of this worker: device, pool_bytes, used_bytes, largest_free, tensors, streams */
+PHP_METHOD(QuicproGpuTensor, poolStats)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_gpu_stats_t st;
+    quicpro_gpu_stats(&st);
+    array_init_size(return_value, 6);
+    add_assoc_long(return_value, "device", st.device);
+    add_assoc_long(return_value, "pool_bytes", (zend_long)st.pool_bytes);
+    add_assoc_long(return_value, "used_bytes", (zend_long)st.used_bytes);
+    add_assoc_long(return_value, "largest_free", (zend_long)st.largest_free);
+    add_assoc_long(return_value, "tensors", (zend_long)st.allocations);
+    add_assoc_long(return_value, "streams", (zend_long)st.streams);
+}
+
+/*──────────────────────────── Life cycle ─────────────────────────────────*/
+
+static zend_object *qp_gpu_tensor_create(zend_class_entry *ce)
+{
+    quicpro_gpu_tensor_object *t = zend_object_alloc(sizeof(quicpro_gpu_tensor_object), ce);
+    zend_object_std_init(&t->std, ce);
+    object_properties_init(&t->std, ce);
+    t->std.handlers = &quicpro_gpu_tensor_handlers;
+    return &t->std;
+}
+
+static void qp_gpu_tensor_free_obj(zend_object *obj)
+{
+    quicpro_gpu_tensor_object *t = quicpro_gpu_tensor_from_obj(obj);
+    if (t->data) {
+        quicpro_gpu_sync(t->stream);
+        quicpro_gpu_free(t->data);
+    }
+    zend_object_std_dtor(obj);
+}
+
+/*──────────────────────────── Registration ───────────────────────────────*/
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_gpu_tensor_from_bytes, 0, 3, Quicpro\\Gpu\\Tensor, 0)
+    ZEND_ARG_TYPE_INFO(0, bytes, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, dtype, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, shape, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_gpu_tensor_dtype, 0, 0, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_quicpro_gpu_tensor_to_bytes arginfo_quicpro_gpu_tensor_dtype
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_gpu_tensor_shape, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_quicpro_gpu_tensor_pool_stats arginfo_quicpro_gpu_tensor_shape
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_gpu_tensor_byte_length, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_gpu_tensor_synchronize, 0, 0, IS_VOID, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry quicpro_gpu_tensor_methods[] = {
+    PHP_ME(QuicproGpuTensor, fromBytes,   arginfo_quicpro_gpu_tensor_from_bytes,   ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_ME(QuicproGpuTensor, dtype,       arginfo_quicpro_gpu_tensor_dtype,        ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGpuTensor, shape,       arginfo_quicpro_gpu_tensor_shape,        ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGpuTensor, byteLength,  arginfo_quicpro_gpu_tensor_byte_length,  ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGpuTensor, toBytes,     arginfo_quicpro_gpu_tensor_to_bytes,     ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGpuTensor, synchronize, arginfo_quicpro_gpu_tensor_synchronize,  ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGpuTensor, poolStats,   arginfo_quicpro_gpu_tensor_pool_stats,   ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_FE_END
+};
+
+void quicpro_gpu_tensor_minit(void)
+{
+    zend_class_entry ce;
+    INIT_NS_CLASS_ENTRY(ce, "Quicpro\\Gpu", "Tensor", quicpro_gpu_tensor_methods);
+    quicpro_ce_gpu_tensor = zend_register_internal_class(&ce);
+    quicpro_ce_gpu_tensor->ce_flags |= ZEND_ACC_FINAL;
+#ifdef ZEND_ACC_NO_DYNAMIC_PROPERTIES
+    quicpro_ce_gpu_tensor->ce_flags |= ZEND_ACC_NO_DYNAMIC_PROPERTIES;
+#endif
+    quicpro_ce_gpu_tensor->create_object = qp_gpu_tensor_create;
+
+    memcpy(&quicpro_gpu_tensor_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    quicpro_gpu_tensor_handlers.offset = XtOffsetOf(quicpro_gpu_tensor_object, std);
+    quicpro_gpu_tensor_handlers.free_obj = qp_gpu_tensor_free_obj;
+    quicpro_gpu_tensor_handlers.clone_obj = NULL;
+}
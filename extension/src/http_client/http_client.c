@@ -12,7 +12,7 @@
  * HTTP communication within the Quicpro ecosystem, serving as a fallback for QUIC
  * where necessary, and as the primary client for traditional HTTP needs.
  *
- * It implements a single, powerful PHP function:
+ * It implements the following PHP functions:
  *
  * • quicpro_http_request_send()
  * – Constructs and sends an HTTP request over a TCP connection using libcurl.
@@ -20,6 +20,14 @@
  * list of configuration options for fine-grained control over the network
  * and protocol behavior.
  *
+ * • quicpro_http_batch_submit() / _wait() / _pending()
+ * – Start any number of requests in parallel and collect their responses
+ * from a completion queue as they finish.
+ *
+ * All of them run on one persistent libcurl multi handle per worker (see
+ * "Transfer engine" below), so connections, DNS answers and TLS sessions
+ * outlive the call that created them.
+ *
  * Architectural Philosophy
  * ------------------------
  * The primary goal is to hide the complexity of HTTP protocol nuances (like connection
@@ -69,51 +77,142 @@
  */
 
 #include "php_quicpro.h"
-#include "http_client.h"
+#include "http_client/http_client.h"
 #include "cancel.h"
+#include "client/body.h"
 
 #include <curl/curl.h>
 #include <zend_exceptions.h>
 #include <zend_smart_str.h>
 #include <ext/standard/url.h> // Potentially for future advanced URL handling
 #include <ctype.h>            // For tolower in header parsing
+#include <errno.h>
+#include <poll.h>             // quicpro_http_poll() waits on callers' descriptors too
+#include <time.h>             // clock_gettime() for batch wait deadlines
 
 
-/**
- * @brief Structure to hold data passed to libcurl's header processing callback.
+/* ─────────────────────────── Response handling ─────────────────────────────
  *
- * This structure is essential for the `header_callback` function to correctly
- * accumulate all incoming HTTP response headers. The `headers_buf` will store
- * the raw header lines (e.g., "Content-Type: application/json\r\n") before
- * they are parsed into an associative array for PHP userland. The `first_line_parsed`
- * flag ensures that the initial HTTP status line (e.g., "HTTP/1.1 200 OK")
- * is correctly identified and ignored, as it's not a true header.
- */
-typedef struct {
-    smart_str *headers_buf;      /**< Pointer to a smart_str buffer to append raw header lines. */
-    bool first_line_parsed;      /**< Flag: true after the HTTP status line has been encountered and skipped. */
-} header_data_t;
+ * Headers are parsed line by line as libcurl delivers them, so the raw
+ * header block is never buffered and parsed again. The body goes to one
+ * of three sinks: by default it accumulates into the returned string.
+ * With `output_stream` each chunk is written to a PHP stream (file,
+ * php://fd/N, socket). With `on_body` it is passed to a callable as it
+ * arrives. Either way memory stays at one libcurl receive buffer,
+ * however large the download.
+ * ------------------------------------------------------------------------*/
+
+#define HTTP_CLIENT_IDLE_EASY 16   /* Reset easy handles kept for the next transfer */
+
+typedef struct http_transfer_s {
+    uint64_t                 id;         /* Batch id; 0 for a synchronous call */
+    CURL                    *easy;
+
+    /* Response */
+    long                     status;     /* Of the response whose headers are being read */
+    zval                     headers;    /* array, reset for every response (redirects, 1xx) */
+    smart_str                body;       /* Buffered body, unless streamed */
+    php_stream              *out_stream; /* `output_stream` sink */
+    zval                     out_stream_zv;
+    zend_fcall_info          on_body;    /* `on_body` sink: fn(string $chunk): ?bool */
+    zend_fcall_info_cache    on_body_fcc;
+    zend_fcall_info          on_headers; /* `on_headers`: fn(int $status, array $headers) */
+    zend_fcall_info_cache    on_headers_fcc;
+    bool                     headers_delivered;
+    bool                     aborted;    /* A sink refused data; the transfer fails with CURLE_WRITE_ERROR */
+
+    struct curl_slist       *headers_list;
+    struct curl_slist       *resolve_list;
+    zend_string             *req_body;   /* Kept alive for CURLOPT_POSTFIELDS */
+    CURLcode                 result;
+    bool                     finished;
+    struct http_transfer_s  *prev;       /* In-flight list; `next` also links the completion queue */
+    struct http_transfer_s  *next;
+} http_transfer_t;
+
+/* Calls `fn(args...)`; false if it threw or returned false. */
+static bool http_transfer_call(zend_fcall_info *fci, zend_fcall_info_cache *fcc, zval *args, uint32_t argc) {
+    zval retval;
+    ZVAL_UNDEF(&retval);
+    fci->retval = &retval;
+    fci->params = args;
+    fci->param_count = argc;
+
+    bool ok = zend_call_function(fci, fcc) == SUCCESS && !EG(exception) && Z_TYPE(retval) != IS_FALSE;
+    zval_ptr_dtor(&retval);
+    return ok;
+}
+
+/* Hands the final response's status and headers to `on_headers`, once. */
+static bool http_transfer_deliver_headers(http_transfer_t *t) {
+    if (t->headers_delivered) {
+        return true;
+    }
+    t->headers_delivered = true;
+    if (!ZEND_FCI_INITIALIZED(t->on_headers)) {
+        return true;
+    }
+    zval args[2];
+    ZVAL_LONG(&args[0], t->status);
+    ZVAL_COPY(&args[1], &t->headers);
+    bool ok = http_transfer_call(&t->on_headers, &t->on_headers_fcc, args, 2);
+    zval_ptr_dtor(&args[1]);
+    return ok;
+}
 
 /**
  * @brief Callback function for libcurl to write received response body data.
  *
  * This function is registered with `CURLOPT_WRITEFUNCTION` and is invoked by libcurl
- * whenever a chunk of the response body is received from the server. Its purpose
- * is to efficiently append these incoming data chunks to a dynamically-sized
- * `smart_str` buffer, which will eventually contain the complete response body.
- * This approach avoids fixed-size buffer overflows and minimizes memory reallocations.
+ * whenever a chunk of the response body is received from the server. The chunk goes
+ * to the transfer's sink: the output stream, the `on_body` callable, or the
+ * `smart_str` that becomes the returned body.
  *
  * @param contents Pointer to the beginning of the received data chunk.
  * @param size The size of each element in `contents` (typically 1 byte).
  * @param nmemb The number of elements in `contents`.
- * @param userp A generic pointer to the `smart_str` buffer (`response_body`) where data should be written.
- * @return The total number of bytes successfully processed (`size * nmemb`). libcurl expects this value
- * to match `size * nmemb`; a mismatch would indicate an error and abort the transfer.
+ * @param userp The `http_transfer_t` the chunk belongs to.
+ * @return The total number of bytes successfully processed (`size * nmemb`). Anything
+ * else, returned when a sink fails, makes libcurl abort the transfer.
  */
 static size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
-    smart_str *buf = (smart_str *)userp;
+    http_transfer_t *t = (http_transfer_t *)userp;
     size_t realsize = size * nmemb;
-    smart_str_appendl(buf, (char *)contents, realsize);
+
+    if (!http_transfer_deliver_headers(t)) {
+        t->aborted = true;
+        return 0;
+    }
+
+    if (t->out_stream) {
+        for (size_t off = 0; off < realsize; ) {
+            ssize_t n = php_stream_write(t->out_stream, (char *)contents + off, realsize - off);
+            if (n <= 0) {
+                t->aborted = true;
+                return 0;
+            }
+            off += (size_t)n;
+        }
+    } else if (ZEND_FCI_INITIALIZED(t->on_body)) {
+        zval chunk;
+        ZVAL_STRINGL(&chunk, (char *)contents, realsize);
+        bool ok = http_transfer_call(&t->on_body, &t->on_body_fcc, &chunk, 1);
+        zval_ptr_dtor(&chunk);
+        if (!ok) {
+            t->aborted = true;
+            return 0;
+        }
+    } else {
+        /* Sized from Content-Length on the first chunk, doubling after that (client/body.h) */
+        if (!t->body.s) {
+            curl_off_t length = -1;
+            curl_easy_getinfo(t->easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+            quicpro_body_reserve(&t->body, (zend_long)length);
+        } else if (t->body.a - ZSTR_LEN(t->body.s) < realsize) {
+            smart_str_alloc(&t->body, MAX(realsize, ZSTR_LEN(t->body.s)), 0);
+        }
+        smart_str_appendl(&t->body, (char *)contents, realsize);
+    }
     return realsize;
 }
 
@@ -121,181 +220,557 @@ static size_t write_callback(void *contents, size_t size, size_t nmemb, void *us
  * @brief Callback function for libcurl to process received response headers.
  *
  * This function is registered with `CURLOPT_HEADERFUNCTION` and is called by libcurl
- * for each line of the HTTP response header section. It intelligently distinguishes
- * between the initial HTTP status line and actual header fields.
- * - The *first line* (e.g., "HTTP/1.1 200 OK") is detected by checking for "HTTP/"
- * and is skipped, as it's handled by `CURLINFO_RESPONSE_CODE`.
- * - *Empty lines* (CRLF) signifying the end of the header section are also skipped.
- * - All *actual header lines* are appended raw to a `smart_str` buffer. This raw
- * collection is later parsed into a structured PHP array.
- * This callback is crucial for capturing all response metadata sent by the server.
+ * for each line of the HTTP response header section.
+ * - A *status line* (e.g., "HTTP/1.1 200 OK") starts a new response: 1xx responses
+ *   and followed redirects each send their own header block, and only the last one
+ *   describes the body. The collected headers are therefore reset and the status
+ *   taken from the line.
+ * - *Empty lines* (CRLF) signifying the end of the header section are skipped.
+ * - *Header lines* are split at the colon; the name is lowercased and leading
+ *   whitespace of the value skipped. Repeated headers (e.g. `Set-Cookie`) are
+ *   joined with ", ", mirroring PHP's default behavior.
  *
- * @param buffer Pointer to the null-terminated header line string.
+ * @param buffer Pointer to the header line; not null-terminated.
  * @param size The size of each data element (always 1 for strings).
- * @param nitems The number of data elements (length of the string).
- * @param userp A generic pointer to a `header_data_t` structure, containing the
- * target `smart_str` buffer and a state flag.
+ * @param nitems The number of data elements (length of the line).
+ * @param userp The `http_transfer_t` the line belongs to.
  * @return The total number of bytes successfully processed (`size * nitems`).
- * Returning a different value would signal an error to libcurl.
  */
 static size_t header_callback(char *buffer, size_t size, size_t nitems, void *userp) {
-    header_data_t *header_data = (header_data_t *)userp;
+    http_transfer_t *t = (http_transfer_t *)userp;
     size_t realsize = size * nitems;
+    size_t len = realsize;
 
-    // Detect and skip the HTTP status line (e.g., "HTTP/1.1 200 OK")
-    if (!header_data->first_line_parsed) {
-        if (realsize > 0 && strncmp(buffer, "HTTP/", 5) == 0) {
-            header_data->first_line_parsed = true;
-        }
-        return realsize; // Always consume the status line even if not parsed as a header
+    while (len > 0 && (buffer[len - 1] == '\r' || buffer[len - 1] == '\n')) {
+        len--;
+    }
+    if (len == 0) {
+        return realsize;
+    }
+
+    if (len > 5 && strncmp(buffer, "HTTP/", 5) == 0) {
+        const char *sp = memchr(buffer, ' ', len);
+        t->status = sp ? strtol(sp + 1, NULL, 10) : 0;
+        zend_hash_clean(Z_ARRVAL(t->headers));
+        return realsize;
     }
 
-    // Detect and skip empty lines (CRLF indicating end of headers)
-    if (realsize == 0 || (realsize == 2 && buffer[0] == '\r' && buffer[1] == '\n')) {
+    const char *colon = memchr(buffer, ':', len);
+    if (!colon) {
         return realsize;
     }
+    size_t name_len = colon - buffer;
+    const char *value = colon + 1;
+    // Skip any leading whitespace or tabs after the colon
+    while (value < buffer + len && (*value == ' ' || *value == '\t')) {
+        value++;
+    }
+    size_t value_len = buffer + len - value;
 
-    // Append the raw header line to the buffer for later detailed parsing
-    smart_str_appendl(header_data->headers_buf, buffer, realsize);
+    // Normalize header name to lowercase for consistent array keys in PHP
+    zend_string *name = zend_string_alloc(name_len, 0);
+    for (size_t i = 0; i < name_len; i++) {
+        ZSTR_VAL(name)[i] = tolower((unsigned char)buffer[i]);
+    }
+    ZSTR_VAL(name)[name_len] = '\0';
+
+    zval *existing = zend_hash_find(Z_ARRVAL(t->headers), name);
+    if (existing && Z_TYPE_P(existing) == IS_STRING) {
+        // If it exists, concatenate the new value with the old, separated by ", "
+        zend_string *old_val = Z_STR_P(existing);
+        zend_string *joined = zend_string_alloc(ZSTR_LEN(old_val) + 2 + value_len, 0);
+        memcpy(ZSTR_VAL(joined), ZSTR_VAL(old_val), ZSTR_LEN(old_val));
+        memcpy(ZSTR_VAL(joined) + ZSTR_LEN(old_val), ", ", 2);
+        memcpy(ZSTR_VAL(joined) + ZSTR_LEN(old_val) + 2, value, value_len);
+        ZSTR_VAL(joined)[ZSTR_LEN(joined)] = '\0';
+        ZVAL_STR(existing, joined);
+        zend_string_release(old_val);
+    } else {
+        add_assoc_stringl_ex(&t->headers, ZSTR_VAL(name), ZSTR_LEN(name), value, value_len);
+    }
+    zend_string_release(name);
     return realsize;
 }
 
-/**
- * @brief Parses a raw string of HTTP headers into a PHP associative array.
+
+/* ──────────────────────────── Transfer engine ──────────────────────────────
+
  *
- * This function takes a raw, concatenated string of header lines (as collected
- * by `header_callback`) and tokenizes it into individual header name-value pairs.
- * It handles:
- * - Newline (`\r\n`) as a delimiter for individual header lines.
- * - Colon (`:`) as a separator between header name and value.
- * - Leading whitespace after the colon.
- * - Normalization of header names to lowercase for consistent array keys.
- * - Concatenation of multiple values for the same header (e.g., multiple `Set-Cookie`
- * headers) into a comma-separated string, mirroring PHP's default behavior.
+ * One CURLM multi handle per worker runs every transfer, and one CURLSH
+ * share handle gives all of them the same DNS cache, connection pool and
+ * TLS session cache. quicpro_http_request_send() used to build and tear
+ * down an easy handle per call, so each call paid for DNS, TCP, TLS and
+ * ALPN again. Now a connection that the last call left open is reused.
+ * A synchronous call and the batch API share the same multi handle, so
+ * waiting on one also moves the others forward.
  *
- * @param raw_headers_str The raw string containing all HTTP headers.
- * @param headers_assoc_array A pointer to a zval (initialized as an array) where
- * the parsed headers will be stored.
+ * Workers are single-threaded processes, so the share handle needs no
+ * lock callbacks. The engine is created lazily, so a worker never
+ * inherits the cluster master's handles across fork().
+ * ------------------------------------------------------------------------*/
+
+static struct {
+    CURLM           *multi;
+    CURLSH          *share;
+    CURL            *idle[HTTP_CLIENT_IDLE_EASY];
+    uint32_t         nidle;
+    uint64_t         next_id;
+    uint32_t         pending;    /* Batch transfers not yet handed back */
+    http_transfer_t *inflight;   /* Still attached to the multi handle */
+    http_transfer_t *done_head;
+    http_transfer_t *done_tail;
+} http_engine;
+
+static bool http_engine_init(void) {
+    if (http_engine.multi) {
+        return true;
+    }
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+        return false;
+    }
+
+    http_engine.share = curl_share_init();
+    if (http_engine.share) {
+        curl_share_setopt(http_engine.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(http_engine.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#ifdef CURL_LOCK_DATA_CONNECT
+        curl_share_setopt(http_engine.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+    }
+
+    http_engine.multi = curl_multi_init();
+    if (!http_engine.multi) {
+        if (http_engine.share) {
+            curl_share_cleanup(http_engine.share);
+            http_engine.share = NULL;
+        }
+        return false;
+    }
+    // HTTP/2 requests to one origin share a connection instead of each opening one.
+    curl_multi_setopt(http_engine.multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+    http_engine.next_id = 1;
+    return true;
+}
+
+static CURL *http_engine_easy(void) {
+    CURL *easy;
+
+    if (http_engine.nidle > 0) {
+        easy = http_engine.idle[--http_engine.nidle];
+        curl_easy_reset(easy);
+    } else {
+        easy = curl_easy_init();
+    }
+    if (easy && http_engine.share) {
+        curl_easy_setopt(easy, CURLOPT_SHARE, http_engine.share);
+    }
+    return easy;
+}
+
+static void http_engine_release_easy(CURL *easy) {
+    if (http_engine.nidle < HTTP_CLIENT_IDLE_EASY) {
+        http_engine.idle[http_engine.nidle++] = easy;
+    } else {
+        curl_easy_cleanup(easy);
+    }
+}
+
+static void http_transfer_unlink(http_transfer_t *t) {
+    if (t->prev) {
+        t->prev->next = t->next;
+    } else {
+        http_engine.inflight = t->next;
+    }
+    if (t->next) {
+        t->next->prev = t->prev;
+    }
+    t->prev = t->next = NULL;
+}
+
+static void http_transfer_free(http_transfer_t *t) {
+    if (!t->finished) {
+        curl_multi_remove_handle(http_engine.multi, t->easy);
+        http_transfer_unlink(t);
+    }
+    if (t->easy) {
+        http_engine_release_easy(t->easy);
+    }
+    smart_str_free(&t->body);
+    zval_ptr_dtor(&t->headers);
+    zval_ptr_dtor(&t->out_stream_zv);    /* UNDEF unless streaming: a no-op */
+    if (ZEND_FCI_INITIALIZED(t->on_body)) {
+        zval_ptr_dtor(&t->on_body.function_name);
+    }
+    if (ZEND_FCI_INITIALIZED(t->on_headers)) {
+        zval_ptr_dtor(&t->on_headers.function_name);
+    }
+    curl_slist_free_all(t->headers_list);
+    curl_slist_free_all(t->resolve_list);
+    if (t->req_body) {
+        zend_string_release(t->req_body);
+    }
+    efree(t);
+}
+
+/**
+ * @brief Applies the userland `$options` array to an easy handle.
+ *
+ * Every recognised key maps onto one `CURLOPT_*`; unknown keys are ignored.
  */
-static void parse_raw_headers_to_assoc_array(zend_string *raw_headers_str, zval *headers_assoc_array) {
-    if (!raw_headers_str || ZSTR_LEN(raw_headers_str) == 0) {
-        return;
+static void http_transfer_apply_options(http_transfer_t *t, CURL *curl, zval *options_array) {
+    zval *opt_val; // Pointer to the value of an option in the PHP array
+
+
+    // Network Timeouts
+    // CURLOPT_TIMEOUT_MS: Maximum time in milliseconds that the request is allowed to take.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "timeout_ms", sizeof("timeout_ms") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, Z_LVAL_P(opt_val));
+    }
+    // CURLOPT_CONNECTTIMEOUT_MS: Maximum time in milliseconds that the connection phase is allowed to take.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "connect_timeout_ms", sizeof("connect_timeout_ms") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, Z_LVAL_P(opt_val));
     }
 
-    char *header_line_start = ZSTR_VAL(raw_headers_str);
-    char *header_line_end;
-    char *header_name_raw;
-    size_t header_name_raw_len;
-    char *header_value_raw;
-    size_t header_value_raw_len;
+    // HTTP Redirect Handling
+    // CURLOPT_FOLLOWLOCATION: Instructs libcurl to follow HTTP 3xx redirects.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "follow_redirects", sizeof("follow_redirects") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    }
+    // CURLOPT_MAXREDIRS: Maximum number of redirects to follow.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "max_redirects", sizeof("max_redirects") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
+        curl_easy_setopt(curl, CURLOPT_MAXREDIRS, Z_LVAL_P(opt_val));
+    }
 
-    // Iterate through the raw header string, looking for CRLF as line endings
-    while ((header_line_end = strstr(header_line_start, "\r\n")) != NULL) {
-        // If a blank line is found, it marks the end of headers
-        if (header_line_end == header_line_start) {
-            header_line_start += 2; // Move past the blank line
-            break;
+    // HTTP Version Preference (ALPN negotiation is handled automatically by libcurl)
+    // Allows forcing a specific HTTP version or letting libcurl negotiate.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "http_version", sizeof("http_version") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        if (zend_string_equals_literal(Z_STR_P(opt_val), "2.0")) {
+            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2_0);
+            // CURLOPT_PIPEWAIT: For HTTP/2, wait for a multiplexed connection to become available.
+            // This is crucial for efficient connection reuse with HTTP/2.
+            curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+        } else if (zend_string_equals_literal(Z_STR_P(opt_val), "1.1")) {
+            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_1_1);
+        } else if (zend_string_equals_literal(Z_STR_P(opt_val), "3.0")) {
+            // When libcurl is compiled with nghttp3/quiche support, this enables HTTP/3.
+            // This option signifies the intent to use HTTP/3 over UDP.
+            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_3);
+        } else {
+            // If an invalid or unspecified version is given, allow libcurl to pick the best.
+            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_NONE);
         }
+    }
 
-        char *colon = strstr(header_line_start, ":");
-        // Ensure a colon exists and is within the current header line
-        if (colon != NULL && colon < header_line_end) {
-            header_name_raw = header_line_start;
-            header_name_raw_len = colon - header_line_start;
+    // Verbose Debugging Output
+    // CURLOPT_VERBOSE: Enables verbose output from libcurl to stderr, useful for debugging network issues.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "verbose", sizeof("verbose") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+    }
 
-            header_value_raw = colon + 1;
-            // Skip any leading whitespace or tabs after the colon
-            while (*header_value_raw == ' ' || *header_value_raw == '\t') {
-                header_value_raw++;
-            }
-            header_value_raw_len = (header_line_end - header_value_raw);
-            
-            // Normalize header name to lowercase for consistent array keys in PHP
-            zend_string *normalized_name = zend_string_alloc(header_name_raw_len, 0);
-            for (size_t i = 0; i < header_name_raw_len; i++) {
-                ZSTR_VAL(normalized_name)[i] = tolower((unsigned char)header_name_raw[i]);
-            }
-            ZSTR_VAL(normalized_name)[header_name_raw_len] = '\0'; // Null-terminate the new string
-
-            // Check if this header name already exists in the associative array
-            zval *existing_header_val = zend_hash_find(Z_ARRVAL_P(headers_assoc_array), normalized_name);
-            if (existing_header_val && Z_TYPE_P(existing_header_val) == IS_STRING) {
-                // If it exists, concatenate the new value with the old, separated by ", "
-                zend_string *old_val = Z_STR_P(existing_header_val);
-                zend_string *new_concat_val = zend_string_alloc(ZSTR_LEN(old_val) + 2 + header_value_raw_len, 0);
-                memcpy(ZSTR_VAL(new_concat_val), ZSTR_VAL(old_val), ZSTR_LEN(old_val));
-                memcpy(ZSTR_VAL(new_concat_val) + ZSTR_LEN(old_val), ", ", 2);
-                memcpy(ZSTR_VAL(new_concat_val) + ZSTR_LEN(old_val) + 2, header_value_raw, header_value_raw_len);
-                ZSTR_VAL(new_concat_val)[ZSTR_LEN(old_val) + 2 + header_value_raw_len] = '\0';
-                ZVAL_STR(existing_header_val, new_concat_val); // Update the zval in the hash table
-                zend_string_release(old_val); // Release the reference to the old zend_string
-            } else {
-                // Otherwise, add the new header name and value to the array
-                add_assoc_stringl_ex(headers_assoc_array, ZSTR_VAL(normalized_name), ZSTR_LEN(normalized_name), header_value_raw, header_value_raw_len);
-            }
-            zend_string_release(normalized_name); // Release the temporary zend_string for the normalized name
+    // Network Socket Options
+    // CURLOPT_TCP_NODELAY: Disables the Nagle algorithm for TCP, reducing latency at the cost of some bandwidth efficiency.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "tcp_nodelay", sizeof("tcp_nodelay") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+    }
+    // CURLOPT_INTERFACE: Specifies the outbound network interface to use. Useful in multi-homed environments.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "interface", sizeof("interface") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_INTERFACE, Z_STRVAL_P(opt_val));
+    }
+
+    // TLS/SSL Configuration (Comprehensive client-side TLS control)
+    // CURLOPT_SSL_VERIFYPEER: Enables/disables peer certificate verification. Set to 0L to disable (NOT RECOMMENDED for production).
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "verify_peer", sizeof("verify_peer") - 1)) != NULL && zend_is_false(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    }
+    // CURLOPT_SSL_VERIFYHOST: Controls hostname verification in the peer's certificate. Set to 0L to disable (NOT RECOMMENDED).
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "verify_host", sizeof("verify_host") - 1)) != NULL && zend_is_false(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L); // 0 = don't verify, 1 = verify CA, 2 = verify CA & hostname. 0 is for "false".
+    }
+    // CURLOPT_CAINFO: Path to a file containing a concatenated list of CA certificates for peer verification.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "ca_info", sizeof("ca_info") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_CAINFO, Z_STRVAL_P(opt_val));
+    }
+    // CURLOPT_SSLCERT: Path to the client's public key certificate file for mutual TLS.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "cert_file", sizeof("cert_file") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_SSLCERT, Z_STRVAL_P(opt_val));
+    }
+    // CURLOPT_SSLKEY: Path to the client's private key file associated with CURLOPT_SSLCERT.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "key_file", sizeof("key_file") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_SSLKEY, Z_STRVAL_P(opt_val));
+    }
+    // CURLOPT_KEYPASSWD: Password for the private key file (if encrypted).
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "key_passwd", sizeof("key_passwd") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_KEYPASSWD, Z_STRVAL_P(opt_val));
+    }
+
+    // DNS Resolution Options (for advanced scenarios like custom DNS or host pinning)
+    // CURLOPT_RESOLVE: Allows specifying a custom IP address for a hostname:port combination, bypassing DNS lookup.
+    // Format: "hostname:port:IPaddress" e.g., "example.com:80:192.168.0.1"
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "resolve_host", sizeof("resolve_host") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        // libcurl does not copy the list; the transfer frees it once it completes.
+        t->resolve_list = curl_slist_append(t->resolve_list, Z_STRVAL_P(opt_val));
+        curl_easy_setopt(curl, CURLOPT_RESOLVE, t->resolve_list);
+        // If multiple `resolve_host` entries are needed, this option needs to be extended to support a PHP array of strings.
+    }
+    // CURLOPT_DNS_CACHE_TIMEOUT: Sets the DNS cache timeout in seconds. A value of 0 means forever.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "dns_cache_timeout", sizeof("dns_cache_timeout") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
+        curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, Z_LVAL_P(opt_val));
+    }
+    // CURLOPT_DNS_USE_GLOBAL_CACHE: Enables/disables use of the global DNS cache.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "dns_use_global_cache", sizeof("dns_use_global_cache") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_DNS_USE_GLOBAL_CACHE, 1L);
+    }
+    // CURLOPT_DNS_SERVERS: Comma-separated list of DNS servers to use.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "dns_servers", sizeof("dns_servers") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_DNS_SERVERS, Z_STRVAL_P(opt_val));
+    }
+    // CURLOPT_IPRESOLVE: Force resolving to IPv4, IPv6 or leave it to libcurl (default).
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "ip_resolve", sizeof("ip_resolve") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        if (zend_string_equals_literal(Z_STR_P(opt_val), "ipv4")) {
+            curl_easy_setopt(curl, CURLOPT_IPRESOLVE, (long)CURL_IPRESOLVE_V4);
+        } else if (zend_string_equals_literal(Z_STR_P(opt_val), "ipv6")) {
+            curl_easy_setopt(curl, CURLOPT_IPRESOLVE, (long)CURL_IPRESOLVE_V6);
+        } else { // auto
+            curl_easy_setopt(curl, CURLOPT_IPRESOLVE, (long)CURL_IPRESOLVE_WHATEVER);
+        }
+    }
+    // CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS: Timeout for Happy Eyeballs connection attempts.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "happy_eyeballs_timeout_ms", sizeof("happy_eyeballs_timeout_ms") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
+        curl_easy_setopt(curl, CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS, Z_LVAL_P(opt_val));
+    }
+
+    // Proxy Settings
+    // CURLOPT_PROXY: The HTTP/HTTPS proxy to use.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "proxy", sizeof("proxy") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_PROXY, Z_STRVAL_P(opt_val));
+    }
+    // CURLOPT_PROXYUSERPWD: User and password for proxy authentication. Format: "user:password".
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "proxy_userpwd", sizeof("proxy_userpwd") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_PROXYUSERPWD, Z_STRVAL_P(opt_val));
+    }
+    // CURLOPT_PROXYTYPE: Type of proxy (HTTP, SOCKS4, SOCKS5).
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "proxy_type", sizeof("proxy_type") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        if (zend_string_equals_literal(Z_STR_P(opt_val), "http")) {
+            curl_easy_setopt(curl, CURLOPT_PROXYTYPE, (long)CURLPROXY_HTTP);
+        } else if (zend_string_equals_literal(Z_STR_P(opt_val), "socks4")) {
+            curl_easy_setopt(curl, CURLOPT_PROXYTYPE, (long)CURLPROXY_SOCKS4);
+        } else if (zend_string_equals_literal(Z_STR_P(opt_val), "socks5")) {
+            curl_easy_setopt(curl, CURLOPT_PROXYTYPE, (long)CURLPROXY_SOCKS5);
         }
-        header_line_start = header_line_end + 2; // Move to the start of the next line
     }
+    // CURLOPT_NOPROXY: Comma-separated list of hosts that do not use the proxy.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "no_proxy", sizeof("no_proxy") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_NOPROXY, Z_STRVAL_P(opt_val));
+    }
+
+    // Authentication Settings
+    // CURLOPT_HTTPAUTH: HTTP authentication method(s) to use.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "http_auth", sizeof("http_auth") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
+        curl_easy_setopt(curl, CURLOPT_HTTPAUTH, Z_LVAL_P(opt_val)); // Expects CURLAUTH_BASIC, CURLAUTH_DIGEST etc.
+    }
+    // CURLOPT_USERPWD: User and password for HTTP authentication. Format: "user:password".
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "user_pwd", sizeof("user_pwd") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_USERPWD, Z_STRVAL_P(opt_val));
+    }
+
+    // Additional transfer options
+    // CURLOPT_FRESH_CONNECT: Forces a new connection to be used instead of a cached one.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "fresh_connect", sizeof("fresh_connect") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
+    }
+    // CURLOPT_DNS_USE_GLOBAL_CACHE: Whether to use the global DNS cache.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "dns_use_global_cache", sizeof("dns_use_global_cache") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_DNS_USE_GLOBAL_CACHE, 1L);
+    }
+    // CURLOPT_MAXFILESIZE: Maximum file size to download.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "max_file_size", sizeof("max_file_size") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
+        curl_easy_setopt(curl, CURLOPT_MAXFILESIZE, Z_LVAL_P(opt_val));
+    }
+    // CURLOPT_ACCEPT_ENCODING: Request specific content encodings.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "accept_encoding", sizeof("accept_encoding") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, Z_STRVAL_P(opt_val));
+    }
+    // CURLOPT_COOKIE: Send a specific cookie string.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "cookie", sizeof("cookie") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_COOKIE, Z_STRVAL_P(opt_val));
+    }
+    // CURLOPT_COOKIEFILE: Read cookies from this file.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "cookie_file", sizeof("cookie_file") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_COOKIEFILE, Z_STRVAL_P(opt_val));
+    }
+    // CURLOPT_COOKIEJAR: Write cookies to this file after the request.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "cookie_jar", sizeof("cookie_jar") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_COOKIEJAR, Z_STRVAL_P(opt_val));
+    }
+    // CURLOPT_REFERER: Set the Referer header.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "referer", sizeof("referer") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_REFERER, Z_STRVAL_P(opt_val));
+    }
+    // CURLOPT_USERAGENT: Set the User-Agent header.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "user_agent", sizeof("user_agent") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_USERAGENT, Z_STRVAL_P(opt_val));
+    }
+    // CURLOPT_CRLF: Convert Unix newlines to CRLF newlines (important for some FTP servers).
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "crlf", sizeof("crlf") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_CRLF, 1L);
+    }
+    // CURLOPT_BUFFERSIZE: Preferred receive buffer size.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "buffer_size", sizeof("buffer_size") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
+        curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, Z_LVAL_P(opt_val));
+    }
+    // CURLOPT_HTTPPROXYTUNNEL: Tunnel through HTTP proxy.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "http_proxy_tunnel", sizeof("http_proxy_tunnel") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_HTTPPROXYTUNNEL, 1L);
+    }
+    // CURLOPT_TRANSFERTEXT: Treat received data as text (perform newline conversions).
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "transfer_text", sizeof("transfer_text") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_TRANSFERTEXT, 1L);
+    }
+    // CURLOPT_UNRESTRICTED_AUTH: Send authentication to all hosts, not just the original one.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "unrestricted_auth", sizeof("unrestricted_auth") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_UNRESTRICTED_AUTH, 1L);
+    }
+    // CURLOPT_PUT: Set PUT method (alternative to CUSTOMREQUEST for PUT).
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "put", sizeof("put") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_PUT, 1L);
+    }
+    // CURLOPT_POST: Set POST method (alternative to CUSTOMREQUEST for POST).
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "post", sizeof("post") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    }
+    // CURLOPT_SSL_CIPHER_LIST: List of ciphers to use for TLS.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "ssl_cipher_list", sizeof("ssl_cipher_list") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_SSL_CIPHER_LIST, Z_STRVAL_P(opt_val));
+    }
+    // CURLOPT_SSL_MAXCONN: Max number of SSL connections to cache.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "ssl_max_conn", sizeof("ssl_max_conn") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
+        curl_easy_setopt(curl, CURLOPT_SSL_MAXCONN, Z_LVAL_P(opt_val));
+    }
+    // CURLOPT_SUPPRESS_CONNECT_HEADERS: Don't send proxy CONNECT headers.
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "suppress_connect_headers", sizeof("suppress_connect_headers") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_SUPPRESS_CONNECT_HEADERS, 1L);
+    }
+    // CURLOPT_TCP_FASTOPEN: Enable TCP Fast Open (Linux only).
+    #ifdef CURLOPT_TCP_FASTOPEN
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "tcp_fastopen", sizeof("tcp_fastopen") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_TCP_FASTOPEN, 1L);
+    }
+    #endif
+    // CURLOPT_ALTSVC: Enable/disable ALTSVC.
+    #ifdef CURLOPT_ALTSVC
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "altsvc", sizeof("altsvc") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_ALTSVC, Z_STRVAL_P(opt_val)); // e.g., "clear" or "h3"
+    }
+    #endif
+    // CURLOPT_DNS_LOCAL_IP4/6: Specify local IPv4/6 address for DNS lookup.
+    #ifdef CURLOPT_DNS_LOCAL_IP4
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "dns_local_ip4", sizeof("dns_local_ip4") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_DNS_LOCAL_IP4, Z_STRVAL_P(opt_val));
+    }
+    #endif
+    #ifdef CURLOPT_DNS_LOCAL_IP6
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "dns_local_ip6", sizeof("dns_local_ip6") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
+        curl_easy_setopt(curl, CURLOPT_DNS_LOCAL_IP6, Z_STRVAL_P(opt_val));
+    }
+    #endif
+    // CURLOPT_KEEP_SENDING_ON_ERROR: Continue sending data on error.
+    #ifdef CURLOPT_KEEP_SENDING_ON_ERROR
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "keep_sending_on_error", sizeof("keep_sending_on_error") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_KEEP_SENDING_ON_ERROR, 1L);
+    }
+    #endif
+    // CURLOPT_SSH_COMPRESSION: Enable SSH compression (for SCP/SFTP protocols).
+    #ifdef CURLOPT_SSH_COMPRESSION
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "ssh_compression", sizeof("ssh_compression") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_SSH_COMPRESSION, 1L);
+    }
+    #endif
+    // CURLOPT_SSL_OPTIONS: Various SSL options.
+    #ifdef CURLOPT_SSL_OPTIONS
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "ssl_options", sizeof("ssl_options") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
+        curl_easy_setopt(curl, CURLOPT_SSL_OPTIONS, Z_LVAL_P(opt_val)); // e.g., CURLSSLOPT_NO_REVOKE
+    }
+    #endif
+    // CURLOPT_HTTP09_ALLOWED: Allow HTTP/0.9 responses.
+    #ifdef CURLOPT_HTTP09_ALLOWED
+    if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "http09_allowed", sizeof("http09_allowed") - 1)) != NULL && zend_is_true(opt_val)) {
+        curl_easy_setopt(curl, CURLOPT_HTTP09_ALLOWED, 1L);
+    }
+    #endif
 }
 
+/* Copies a callable option into `fci`/`fcc`; FAILURE after throwing if it is not callable. */
+static int http_transfer_callable(HashTable *opts, const char *key, size_t key_len,
+                                  zend_fcall_info *fci, zend_fcall_info_cache *fcc) {
+    zval *zv = zend_hash_str_find(opts, key, key_len);
+    char *error = NULL;
+
+    if (!zv || Z_TYPE_P(zv) == IS_NULL) {
+        return SUCCESS;
+    }
+    if (zend_fcall_info_init(zv, 0, fci, fcc, NULL, &error) == FAILURE) {
+        zend_type_error("Option \"%s\" must be a valid callback%s%s", key, error ? ", " : "", error ? error : "");
+        if (error) {
+            efree(error);
+        }
+        return FAILURE;
+    }
+    if (error) {
+        efree(error);
+    }
+    Z_TRY_ADDREF(fci->function_name);
+    return SUCCESS;
+}
 
 /**
- * @brief Sends a full-featured HTTP request using libcurl.
- *
- * This function serves as the primary entry point for sending HTTP requests
- * from PHP userland through the Quicpro extension's robust HTTP client.
- * It supports a wide range of HTTP methods, custom headers, request bodies,
- * and comprehensive configuration options.
- *
- * The function encapsulates the entire logic of setting up a libcurl easy handle,
- * configuring it with various options (timeouts, redirects, SSL/TLS, network),
- * executing the request, and then processing the response (status, body, headers).
- *
- * @param ZEND_EXEC_ARGS Standard PHP function arguments.
- * @return A PHP array on success, containing:
- * - 'status' (int): The HTTP response status code.
- * - 'body' (string): The complete HTTP response body.
- * - 'headers' (array): An associative array of normalized HTTP response headers.
- * Returns FALSE on failure, automatically throwing a `Quicpro\Exception\McpException`
- * with a detailed error message from libcurl.
+ * @brief Reads the body sinks from `$options`: `output_stream` (a writable
+ * stream resource), `on_body` (callable receiving each chunk; returning
+ * false aborts) and `on_headers` (callable receiving status and headers
+ * before the first chunk).
  */
-PHP_FUNCTION(quicpro_http_request_send) {
-    // PHP function parameters:
-    char *url_str;                   // The target URL for the request
-    size_t url_len;
-    char *method_str = "GET";        // HTTP method (GET, POST, PUT, etc.), defaults to GET
-    size_t method_len = 3;
-    zval *headers_array = NULL;      // Associative array of request headers
-    char *body_str = NULL;           // Request body string
-    size_t body_len = 0;
-    zval *options_array = NULL;      // Associative array of additional cURL options
+static int http_transfer_set_sinks(http_transfer_t *t, HashTable *opts) {
+    zval *zv = zend_hash_str_find(opts, "output_stream", sizeof("output_stream") - 1);
+    if (zv && Z_TYPE_P(zv) != IS_NULL) {
+        php_stream *stream = NULL;
+        if (Z_TYPE_P(zv) == IS_RESOURCE) {
+            php_stream_from_zval_no_verify(stream, zv);
+        }
+        if (!stream) {
+            zend_type_error("Option \"output_stream\" must be a stream resource");
+            return FAILURE;
+        }
+        ZVAL_COPY(&t->out_stream_zv, zv);
+        t->out_stream = stream;
+    }
 
-    // Parse incoming PHP parameters
-    ZEND_PARSE_PARAMETERS_START(1, 5)
-        Z_PARAM_STRING(url_str, url_len)
-        Z_PARAM_OPTIONAL
-        Z_PARAM_STRING(method_str, method_len)
-        Z_PARAM_ARRAY_OR_NULL(headers_array)
-        Z_PARAM_STRING_OR_NULL(body_str, body_len)
-        Z_PARAM_ARRAY_OR_NULL(options_array)
-    ZEND_PARSE_PARAMETERS_END();
+    if (http_transfer_callable(opts, "on_body", sizeof("on_body") - 1, &t->on_body, &t->on_body_fcc) == FAILURE
+        || http_transfer_callable(opts, "on_headers", sizeof("on_headers") - 1, &t->on_headers, &t->on_headers_fcc) == FAILURE) {
+        return FAILURE;
+    }
+    return SUCCESS;
+}
 
-    // Internal libcurl and data handling variables
-    CURL *curl;                        // libcurl easy handle
-    CURLcode res;                      // Result code from cURL operations
-    smart_str response_body = {0};     // Smart string buffer for the response body
-    smart_str response_headers_raw = {0}; // Smart string buffer for raw response headers
-    struct curl_slist *headers_list = NULL; // Linked list for custom request headers (libcurl format)
-    long http_code = 0;                // HTTP response status code
-    header_data_t header_data = { .headers_buf = &response_headers_raw, .first_line_parsed = false }; // Data for header callback
-
-    // Initialize the libcurl easy handle. This is the first critical step.
-    curl = curl_easy_init();
-    if (!curl) {
+/**
+ * @brief Creates a transfer with its easy handle fully configured, or
+ * returns NULL after throwing.
+ */
+static http_transfer_t *http_transfer_new(const char *url_str, const char *method_str, zval *headers_array,
+                                          zend_string *body, zval *options_array) {
+    if (!http_engine_init()) {
+        throw_mcp_error_as_php_exception(0, "Failed to initialize the cURL transfer engine.");
+        return NULL;
+    }
+
+    http_transfer_t *t = ecalloc(1, sizeof(*t));
+    array_init(&t->headers);
+    ZVAL_UNDEF(&t->out_stream_zv);
+    t->easy = http_engine_easy();
+    if (!t->easy) {
+        efree(t);
         throw_mcp_error_as_php_exception(0, "Failed to initialize cURL handle for HTTP request.");
-        RETURN_FALSE;
+        return NULL;
     }
+    CURL *curl = t->easy;
 
     // --- Fundamental cURL Options Configuration ---
     // Set the target URL for the request.
@@ -304,12 +779,16 @@ PHP_FUNCTION(quicpro_http_request_send) {
     curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method_str);
     // Register the callback function for writing the response body data.
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    // Pass the smart_str buffer to the write callback.
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response_body);
+    // Pass the transfer, which knows the body sink, to the write callback.
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)t);
     // Register the callback function for processing response headers.
     curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
-    // Pass the header_data_t structure to the header callback.
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)&header_data);
+    // Pass the transfer, which collects the parsed headers, to the header callback.
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)t);
+    // Lets the completion loop find the transfer of a finished easy handle.
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, (void *)t);
+    // Signals (SIGALRM timeouts) are unsafe in a long-running worker.
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
 
     // --- TCP Keep-Alive Configuration (Essential for persistent connections) ---
     // Enable TCP Keep-Alive probes to detect dead connections and free resources.
@@ -318,9 +797,10 @@ PHP_FUNCTION(quicpro_http_request_send) {
     curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 60L);
     // Set the interval between subsequent keep-alive probes (in seconds).
     curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 30L);
-    // Ensure that libcurl reuses connections for subsequent requests where possible.
-    // This is implicitly handled by libcurl's connection pooling but explicitly stated here for clarity.
+    // Connections outlive the transfer in the shared pool, so later calls reuse them.
     curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 0L); // Allow reuse
+    // Wait for a connection that can multiplex rather than opening another one in parallel.
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
 
 
     // --- Process Request Headers from PHP Array ---
@@ -341,347 +821,491 @@ PHP_FUNCTION(quicpro_http_request_send) {
             smart_str_appendl(&header_line, Z_STRVAL_P(val), Z_STRLEN_P(val)); // Append header value
             smart_str_0(&header_line); // Null-terminate the string for `curl_slist_append`
             // Add the formatted header string to libcurl's internal linked list for headers.
-            headers_list = curl_slist_append(headers_list, ZSTR_VAL(header_line.s));
+            t->headers_list = curl_slist_append(t->headers_list, ZSTR_VAL(header_line.s));
             smart_str_free(&header_line); // Free the temporary zend_string allocated by smart_str_0
         } ZEND_HASH_FOREACH_END();
         // If any headers were successfully added, set them in the cURL handle.
-        if (headers_list) {
-            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers_list);
+        if (t->headers_list) {
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, t->headers_list);
         }
     }
 
     // --- Set Request Body for Appropriate HTTP Methods ---
     // If a request body is provided and the method implies a body (POST, PUT, PATCH),
-    // configure libcurl to send it.
-    if (body_str && body_len > 0 && (strcmp(method_str, "POST") == 0 || strcmp(method_str, "PUT") == 0 || strcmp(method_str, "PATCH") == 0)) {
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body_str);    // The data to send
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)body_len); // The size of the data
-    } else if (body_str && body_len > 0) {
-        // If a body is provided for methods like GET/HEAD, it's typically ignored by servers.
-        // For strict HTTP compliance, we might warn or error here. For now, libcurl will handle.
+    // configure libcurl to send it. libcurl does not copy POSTFIELDS, so the transfer
+    // holds a reference to the string until it completes.
+    if (body && ZSTR_LEN(body) > 0 && (strcmp(method_str, "POST") == 0 || strcmp(method_str, "PUT") == 0 || strcmp(method_str, "PATCH") == 0)) {
+        t->req_body = zend_string_copy(body);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, ZSTR_VAL(t->req_body));    // The data to send
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)ZSTR_LEN(t->req_body)); // The size of the data
     }
 
 
     // --- Process Extensive Options Provided by PHP Userland ---
     // This section allows granular control over cURL behavior via an associative PHP array.
     if (options_array && Z_TYPE_P(options_array) == IS_ARRAY) {
-        zval *opt_val; // Pointer to the value of an option in the PHP array
-
-        // Network Timeouts
-        // CURLOPT_TIMEOUT_MS: Maximum time in milliseconds that the request is allowed to take.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "timeout_ms", sizeof("timeout_ms") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
-            curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, Z_LVAL_P(opt_val));
-        }
-        // CURLOPT_CONNECTTIMEOUT_MS: Maximum time in milliseconds that the connection phase is allowed to take.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "connect_timeout_ms", sizeof("connect_timeout_ms") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
-            curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, Z_LVAL_P(opt_val));
+        http_transfer_apply_options(t, curl, options_array);
+        if (http_transfer_set_sinks(t, Z_ARRVAL_P(options_array)) == FAILURE) {
+            t->finished = true;   /* Not added yet */
+            http_transfer_free(t);
+            return NULL;
         }
+    }
 
-        // HTTP Redirect Handling
-        // CURLOPT_FOLLOWLOCATION: Instructs libcurl to follow HTTP 3xx redirects.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "follow_redirects", sizeof("follow_redirects") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    CURLMcode mrc = curl_multi_add_handle(http_engine.multi, curl);
+    if (mrc != CURLM_OK) {
+        t->finished = true;   /* Never added: nothing to remove */
+        http_transfer_free(t);
+        throw_mcp_error_as_php_exception(0, "cURL request could not be queued: %s", curl_multi_strerror(mrc));
+        return NULL;
+    }
+    t->next = http_engine.inflight;
+    if (t->next) {
+        t->next->prev = t;
+    }
+    http_engine.inflight = t;
+    return t;
+}
+
+/**
+ * @brief Fills `out` with the 'status', 'body' and 'headers' of a finished
+ * transfer. The body and headers are moved, not copied; a streamed body
+ * is reported as null.
+ */
+static void http_transfer_result(http_transfer_t *t, zval *out) {
+    long http_code = 0; // HTTP response status code
+
+    // --- Retrieve HTTP Response Status Code ---
+    curl_easy_getinfo(t->easy, CURLINFO_RESPONSE_CODE, &http_code);
+
+    add_assoc_long(out, "status", http_code);
+    // Add the response body to the return array. If empty, use PHP's empty string.
+    if (t->out_stream || ZEND_FCI_INITIALIZED(t->on_body)) {
+        add_assoc_null(out, "body");
+    } else {
+        add_assoc_str(out, "body", quicpro_body_take(&t->body)); // Ownership moved to `out`
+    }
+
+    // The headers were parsed as they arrived; ownership moves to `out`.
+    add_assoc_zval(out, "headers", &t->headers);
+    ZVAL_UNDEF(&t->headers);
+}
+
+/* Collects finished transfers: batch ones go onto the completion queue. */
+static void http_engine_reap(void) {
+    CURLMsg *msg;
+    int left;
+
+    while ((msg = curl_multi_info_read(http_engine.multi, &left))) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
         }
-        // CURLOPT_MAXREDIRS: Maximum number of redirects to follow.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "max_redirects", sizeof("max_redirects") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
-            curl_easy_setopt(curl, CURLOPT_MAXREDIRS, Z_LVAL_P(opt_val));
+        http_transfer_t *t = NULL;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&t);
+        curl_multi_remove_handle(http_engine.multi, msg->easy_handle);
+        http_transfer_unlink(t);
+        t->result = msg->data.result;
+        t->finished = true;
+        if (t->result == CURLE_OK && !http_transfer_deliver_headers(t)) {
+            t->result = CURLE_WRITE_ERROR;  /* Bodiless response refused by on_headers */
+            t->aborted = true;
         }
 
-        // HTTP Version Preference (ALPN negotiation is handled automatically by libcurl)
-        // Allows forcing a specific HTTP version or letting libcurl negotiate.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "http_version", sizeof("http_version") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            if (zend_string_equals_literal(Z_STR_P(opt_val), "2.0")) {
-                curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2_0);
-                // CURLOPT_PIPEWAIT: For HTTP/2, wait for a multiplexed connection to become available.
-                // This is crucial for efficient connection reuse with HTTP/2.
-                curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
-            } else if (zend_string_equals_literal(Z_STR_P(opt_val), "1.1")) {
-                curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_1_1);
-            } else if (zend_string_equals_literal(Z_STR_P(opt_val), "3.0")) {
-                // When libcurl is compiled with nghttp3/quiche support, this enables HTTP/3.
-                // This option signifies the intent to use HTTP/3 over UDP.
-                curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_3);
+        if (t->id) {
+            t->next = NULL;
+            if (http_engine.done_tail) {
+                http_engine.done_tail->next = t;
             } else {
-                // If an invalid or unspecified version is given, allow libcurl to pick the best.
-                curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_NONE);
+                http_engine.done_head = t;
             }
+            http_engine.done_tail = t;
         }
+    }
+}
 
-        // Verbose Debugging Output
-        // CURLOPT_VERBOSE: Enables verbose output from libcurl to stderr, useful for debugging network issues.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "verbose", sizeof("verbose") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
-        }
+static zend_long http_engine_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (zend_long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-        // Network Socket Options
-        // CURLOPT_TCP_NODELAY: Disables the Nagle algorithm for TCP, reducing latency at the cost of some bandwidth efficiency.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "tcp_nodelay", sizeof("tcp_nodelay") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
-        }
-        // CURLOPT_INTERFACE: Specifies the outbound network interface to use. Useful in multi-homed environments.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "interface", sizeof("interface") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_INTERFACE, Z_STRVAL_P(opt_val));
-        }
+/**
+ * @brief Runs every queued transfer until `until` has finished (or, for
+ * NULL, a batch completion is available) or `timeout_ms` (-1: none) elapses.
+ * @return FAILURE only if the multi handle itself failed.
+ */
+static int http_engine_run(http_transfer_t *until, zend_long timeout_ms) {
+    zend_long start = http_engine_now_ms();
 
-        // TLS/SSL Configuration (Comprehensive client-side TLS control)
-        // CURLOPT_SSL_VERIFYPEER: Enables/disables peer certificate verification. Set to 0L to disable (NOT RECOMMENDED for production).
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "verify_peer", sizeof("verify_peer") - 1)) != NULL && zend_is_false(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-        }
-        // CURLOPT_SSL_VERIFYHOST: Controls hostname verification in the peer's certificate. Set to 0L to disable (NOT RECOMMENDED).
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "verify_host", sizeof("verify_host") - 1)) != NULL && zend_is_false(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L); // 0 = don't verify, 1 = verify CA, 2 = verify CA & hostname. 0 is for "false".
-        }
-        // CURLOPT_CAINFO: Path to a file containing a concatenated list of CA certificates for peer verification.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "ca_info", sizeof("ca_info") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_CAINFO, Z_STRVAL_P(opt_val));
-        }
-        // CURLOPT_SSLCERT: Path to the client's public key certificate file for mutual TLS.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "cert_file", sizeof("cert_file") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_SSLCERT, Z_STRVAL_P(opt_val));
+    while (true) {
+        int running = 0;
+        CURLMcode mrc = curl_multi_perform(http_engine.multi, &running);
+        if (mrc != CURLM_OK) {
+            throw_mcp_error_as_php_exception(0, "cURL transfer engine failed: %s", curl_multi_strerror(mrc));
+            return FAILURE;
         }
-        // CURLOPT_SSLKEY: Path to the client's private key file associated with CURLOPT_SSLCERT.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "key_file", sizeof("key_file") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_SSLKEY, Z_STRVAL_P(opt_val));
-        }
-        // CURLOPT_KEYPASSWD: Password for the private key file (if encrypted).
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "key_passwd", sizeof("key_passwd") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_KEYPASSWD, Z_STRVAL_P(opt_val));
+        http_engine_reap();
+        if (EG(exception)) {
+            return FAILURE;     /* Thrown by an on_body / on_headers callback */
         }
 
-        // DNS Resolution Options (for advanced scenarios like custom DNS or host pinning)
-        // CURLOPT_RESOLVE: Allows specifying a custom IP address for a hostname:port combination, bypassing DNS lookup.
-        // Format: "hostname:port:IPaddress" e.g., "example.com:80:192.168.0.1"
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "resolve_host", sizeof("resolve_host") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            struct curl_slist *resolve_list = NULL;
-            resolve_list = curl_slist_append(resolve_list, Z_STRVAL_P(opt_val));
-            curl_easy_setopt(curl, CURLOPT_RESOLVE, resolve_list);
-            // Note: `resolve_list` is owned by libcurl after this call and will be freed by `curl_easy_cleanup`.
-            // If multiple `resolve_host` entries are needed, this option needs to be extended to support a PHP array of strings.
-        }
-        // CURLOPT_DNS_CACHE_TIMEOUT: Sets the DNS cache timeout in seconds. A value of 0 means forever.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "dns_cache_timeout", sizeof("dns_cache_timeout") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
-            curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, Z_LVAL_P(opt_val));
-        }
-        // CURLOPT_DNS_USE_GLOBAL_CACHE: Enables/disables use of the global DNS cache.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "dns_use_global_cache", sizeof("dns_use_global_cache") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_DNS_USE_GLOBAL_CACHE, 1L);
-        }
-        // CURLOPT_DNS_SERVERS: Comma-separated list of DNS servers to use.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "dns_servers", sizeof("dns_servers") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_DNS_SERVERS, Z_STRVAL_P(opt_val));
-        }
-        // CURLOPT_IPRESOLVE: Force resolving to IPv4, IPv6 or leave it to libcurl (default).
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "ip_resolve", sizeof("ip_resolve") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            if (zend_string_equals_literal(Z_STR_P(opt_val), "ipv4")) {
-                curl_easy_setopt(curl, CURLOPT_IPRESOLVE, (long)CURL_IPRESOLVE_V4);
-            } else if (zend_string_equals_literal(Z_STR_P(opt_val), "ipv6")) {
-                curl_easy_setopt(curl, CURLOPT_IPRESOLVE, (long)CURL_IPRESOLVE_V6);
-            } else { // auto
-                curl_easy_setopt(curl, CURLOPT_IPRESOLVE, (long)CURL_IPRESOLVE_WHATEVER);
-            }
-        }
-        // CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS: Timeout for Happy Eyeballs connection attempts.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "happy_eyeballs_timeout_ms", sizeof("happy_eyeballs_timeout_ms") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
-            curl_easy_setopt(curl, CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS, Z_LVAL_P(opt_val));
+        if (until ? until->finished : (http_engine.done_head != NULL || http_engine.pending == 0)) {
+            return SUCCESS;
         }
 
-        // Proxy Settings
-        // CURLOPT_PROXY: The HTTP/HTTPS proxy to use.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "proxy", sizeof("proxy") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_PROXY, Z_STRVAL_P(opt_val));
-        }
-        // CURLOPT_PROXYUSERPWD: User and password for proxy authentication. Format: "user:password".
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "proxy_userpwd", sizeof("proxy_userpwd") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_PROXYUSERPWD, Z_STRVAL_P(opt_val));
-        }
-        // CURLOPT_PROXYTYPE: Type of proxy (HTTP, SOCKS4, SOCKS5).
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "proxy_type", sizeof("proxy_type") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            if (zend_string_equals_literal(Z_STR_P(opt_val), "http")) {
-                curl_easy_setopt(curl, CURLOPT_PROXYTYPE, (long)CURLPROXY_HTTP);
-            } else if (zend_string_equals_literal(Z_STR_P(opt_val), "socks4")) {
-                curl_easy_setopt(curl, CURLOPT_PROXYTYPE, (long)CURLPROXY_SOCKS4);
-            } else if (zend_string_equals_literal(Z_STR_P(opt_val), "socks5")) {
-                curl_easy_setopt(curl, CURLOPT_PROXYTYPE, (long)CURLPROXY_SOCKS5);
-            }
+        zend_long elapsed = http_engine_now_ms() - start;
+        if (timeout_ms >= 0 && elapsed >= timeout_ms) {
+            return SUCCESS;
         }
-        // CURLOPT_NOPROXY: Comma-separated list of hosts that do not use the proxy.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "no_proxy", sizeof("no_proxy") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_NOPROXY, Z_STRVAL_P(opt_val));
+        // Sleeps in poll() on the transfers' sockets and libcurl's own timers.
+        int wait_ms = timeout_ms < 0 ? 1000 : (int)MIN(timeout_ms - elapsed, 1000);
+        mrc = curl_multi_poll(http_engine.multi, NULL, 0, wait_ms, NULL);
+        if (mrc != CURLM_OK) {
+            throw_mcp_error_as_php_exception(0, "cURL transfer engine failed: %s", curl_multi_strerror(mrc));
+            return FAILURE;
         }
+    }
+}
 
-        // Authentication Settings
-        // CURLOPT_HTTPAUTH: HTTP authentication method(s) to use.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "http_auth", sizeof("http_auth") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
-            curl_easy_setopt(curl, CURLOPT_HTTPAUTH, Z_LVAL_P(opt_val)); // Expects CURLAUTH_BASIC, CURLAUTH_DIGEST etc.
-        }
-        // CURLOPT_USERPWD: User and password for HTTP authentication. Format: "user:password".
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "user_pwd", sizeof("user_pwd") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_USERPWD, Z_STRVAL_P(opt_val));
-        }
+void quicpro_http_client_rshutdown(void) {
+    if (!http_engine.multi) {
+        return;
+    }
+    // Transfers are request memory; the handles and their connections stay.
+    http_transfer_t *t;
+    while ((t = http_engine.done_head)) {
+        http_engine.done_head = t->next;
+        http_transfer_free(t);
+    }
+    http_engine.done_tail = NULL;
 
-        // Additional transfer options
-        // CURLOPT_FRESH_CONNECT: Forces a new connection to be used instead of a cached one.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "fresh_connect", sizeof("fresh_connect") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
-        }
-        // CURLOPT_DNS_USE_GLOBAL_CACHE: Whether to use the global DNS cache.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "dns_use_global_cache", sizeof("dns_use_global_cache") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_DNS_USE_GLOBAL_CACHE, 1L);
-        }
-        // CURLOPT_MAXFILESIZE: Maximum file size to download.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "max_file_size", sizeof("max_file_size") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
-            curl_easy_setopt(curl, CURLOPT_MAXFILESIZE, Z_LVAL_P(opt_val));
-        }
-        // CURLOPT_ACCEPT_ENCODING: Request specific content encodings.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "accept_encoding", sizeof("accept_encoding") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, Z_STRVAL_P(opt_val));
-        }
-        // CURLOPT_COOKIE: Send a specific cookie string.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "cookie", sizeof("cookie") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_COOKIE, Z_STRVAL_P(opt_val));
-        }
-        // CURLOPT_COOKIEFILE: Read cookies from this file.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "cookie_file", sizeof("cookie_file") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_COOKIEFILE, Z_STRVAL_P(opt_val));
-        }
-        // CURLOPT_COOKIEJAR: Write cookies to this file after the request.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "cookie_jar", sizeof("cookie_jar") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_COOKIEJAR, Z_STRVAL_P(opt_val));
-        }
-        // CURLOPT_REFERER: Set the Referer header.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "referer", sizeof("referer") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_REFERER, Z_STRVAL_P(opt_val));
-        }
-        // CURLOPT_USERAGENT: Set the User-Agent header.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "user_agent", sizeof("user_agent") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_USERAGENT, Z_STRVAL_P(opt_val));
-        }
-        // CURLOPT_CRLF: Convert Unix newlines to CRLF newlines (important for some FTP servers).
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "crlf", sizeof("crlf") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_CRLF, 1L);
-        }
-        // CURLOPT_BUFFERSIZE: Preferred receive buffer size.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "buffer_size", sizeof("buffer_size") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
-            curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, Z_LVAL_P(opt_val));
-        }
-        // CURLOPT_HTTPPROXYTUNNEL: Tunnel through HTTP proxy.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "http_proxy_tunnel", sizeof("http_proxy_tunnel") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_HTTPPROXYTUNNEL, 1L);
-        }
-        // CURLOPT_TRANSFERTEXT: Treat received data as text (perform newline conversions).
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "transfer_text", sizeof("transfer_text") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_TRANSFERTEXT, 1L);
-        }
-        // CURLOPT_UNRESTRICTED_AUTH: Send authentication to all hosts, not just the original one.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "unrestricted_auth", sizeof("unrestricted_auth") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_UNRESTRICTED_AUTH, 1L);
-        }
-        // CURLOPT_PUT: Set PUT method (alternative to CUSTOMREQUEST for PUT).
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "put", sizeof("put") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_PUT, 1L);
-        }
-        // CURLOPT_POST: Set POST method (alternative to CUSTOMREQUEST for POST).
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "post", sizeof("post") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        }
-        // CURLOPT_SSL_CIPHER_LIST: List of ciphers to use for TLS.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "ssl_cipher_list", sizeof("ssl_cipher_list") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_SSL_CIPHER_LIST, Z_STRVAL_P(opt_val));
-        }
-        // CURLOPT_SSL_MAXCONN: Max number of SSL connections to cache.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "ssl_max_conn", sizeof("ssl_max_conn") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
-            curl_easy_setopt(curl, CURLOPT_SSL_MAXCONN, Z_LVAL_P(opt_val));
-        }
-        // CURLOPT_SUPPRESS_CONNECT_HEADERS: Don't send proxy CONNECT headers.
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "suppress_connect_headers", sizeof("suppress_connect_headers") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_SUPPRESS_CONNECT_HEADERS, 1L);
-        }
-        // CURLOPT_TCP_FASTOPEN: Enable TCP Fast Open (Linux only).
-        #ifdef CURLOPT_TCP_FASTOPEN
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "tcp_fastopen", sizeof("tcp_fastopen") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_TCP_FASTOPEN, 1L);
-        }
-        #endif
-        // CURLOPT_ALTSVC: Enable/disable ALTSVC.
-        #ifdef CURLOPT_ALTSVC
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "altsvc", sizeof("altsvc") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_ALTSVC, Z_STRVAL_P(opt_val)); // e.g., "clear" or "h3"
-        }
-        #endif
-        // CURLOPT_DNS_LOCAL_IP4/6: Specify local IPv4/6 address for DNS lookup.
-        #ifdef CURLOPT_DNS_LOCAL_IP4
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "dns_local_ip4", sizeof("dns_local_ip4") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_DNS_LOCAL_IP4, Z_STRVAL_P(opt_val));
-        }
-        #endif
-        #ifdef CURLOPT_DNS_LOCAL_IP6
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "dns_local_ip6", sizeof("dns_local_ip6") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_STRING) {
-            curl_easy_setopt(curl, CURLOPT_DNS_LOCAL_IP6, Z_STRVAL_P(opt_val));
+    while ((t = http_engine.inflight)) {
+        http_transfer_free(t);    /* Detaches it from the multi handle */
+    }
+    http_engine.pending = 0;
+}
+
+void quicpro_http_client_mshutdown(void) {
+    if (!http_engine.multi) {
+        return;
+    }
+    while (http_engine.nidle > 0) {
+        curl_easy_cleanup(http_engine.idle[--http_engine.nidle]);
+    }
+    curl_multi_cleanup(http_engine.multi);
+    if (http_engine.share) {
+        curl_share_cleanup(http_engine.share);
+    }
+    curl_global_cleanup();
+    memset(&http_engine, 0, sizeof(http_engine));
+}
+
+
+/**
+ * @brief Sends a full-featured HTTP request using libcurl.
+ *
+ * This function serves as the primary entry point for sending HTTP requests
+ * from PHP userland through the Quicpro extension's robust HTTP client.
+ * It supports a wide range of HTTP methods, custom headers, request bodies,
+ * and comprehensive configuration options.
+ *
+ * The request runs on the worker's shared transfer engine, so it reuses
+ * connections, DNS answers and TLS sessions of earlier calls, and batch
+ * transfers submitted earlier keep progressing while it waits.
+ *
+ * @param ZEND_EXEC_ARGS Standard PHP function arguments.
+ * @return A PHP array on success, containing:
+ * - 'status' (int): The HTTP response status code.
+ * - 'body' (string): The complete HTTP response body.
+ * - 'headers' (array): An associative array of normalized HTTP response headers.
+ * Returns FALSE on failure, automatically throwing a `Quicpro\Exception\McpException`
+ * with a detailed error message from libcurl.
+ */
+PHP_FUNCTION(quicpro_http_request_send) {
+    // PHP function parameters:
+    char *url_str;                   // The target URL for the request
+    size_t url_len;
+    char *method_str = "GET";        // HTTP method (GET, POST, PUT, etc.), defaults to GET
+    size_t method_len = 3;
+    zval *headers_array = NULL;      // Associative array of request headers
+    zend_string *body = NULL;        // Request body string
+    zval *options_array = NULL;      // Associative array of additional cURL options
+
+    // Parse incoming PHP parameters
+    ZEND_PARSE_PARAMETERS_START(1, 5)
+        Z_PARAM_STRING(url_str, url_len)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STRING(method_str, method_len)
+        Z_PARAM_ARRAY_OR_NULL(headers_array)
+        Z_PARAM_STR_OR_NULL(body)
+        Z_PARAM_ARRAY_OR_NULL(options_array)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (!quicpro_http_request(url_str, method_str, headers_array, body, options_array, return_value)) {
+        RETURN_FALSE;
+    }
+}
+
+bool quicpro_http_request(const char *url_str, const char *method_str, zval *headers_array, zend_string *body,
+                          zval *options_array, zval *return_value) {
+    http_transfer_t *t = http_transfer_new(url_str, method_str, headers_array, body, options_array);
+    if (!t) {
+        return false;
+    }
+
+    // --- Execute the cURL request ---
+    if (http_engine_run(t, -1) == FAILURE) {
+        http_transfer_free(t);
+        return false;
+    }
+    // Check for cURL errors
+    if (t->result != CURLE_OK) {
+        if (EG(exception)) {
+            /* A sink callback threw; let that exception propagate */
+        } else if (t->aborted) {
+            throw_mcp_error_as_php_exception(0, "cURL request aborted: the response body sink refused data.");
+        } else {
+            throw_mcp_error_as_php_exception(0, "cURL request failed: %s", curl_easy_strerror(t->result));
         }
-        #endif
-        // CURLOPT_KEEP_SENDING_ON_ERROR: Continue sending data on error.
-        #ifdef CURLOPT_KEEP_SENDING_ON_ERROR
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "keep_sending_on_error", sizeof("keep_sending_on_error") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_KEEP_SENDING_ON_ERROR, 1L);
+        http_transfer_free(t);
+        return false;
+    }
+
+    // --- Prepare PHP Return Value Array ---
+    array_init(return_value);
+    http_transfer_result(t, return_value);
+
+    // --- Final Cleanup of Resources ---
+    // The easy handle goes back to the idle list; its connection stays in the shared pool.
+    http_transfer_free(t);
+    return true;
+}
+
+long quicpro_http_post(const char *url, const char *content_type, zend_string *body, zend_long timeout_ms,
+                       zend_string **out) {
+    zval headers, options;
+    array_init(&headers);
+    add_assoc_string(&headers, "Content-Type", (char *)content_type);
+    array_init(&options);
+    if (timeout_ms > 0) {
+        add_assoc_long(&options, "timeout_ms", timeout_ms);
+    }
+    http_transfer_t *t = http_transfer_new(url, "POST", &headers, body, &options);
+    zval_ptr_dtor(&headers);
+    zval_ptr_dtor(&options);
+    if (!t) {
+        return 0;
+    }
+    if (http_engine_run(t, -1) == FAILURE) {
+        http_transfer_free(t);
+        return 0;
+    }
+    if (t->result != CURLE_OK) {
+        throw_mcp_error_as_php_exception(0, "cURL request to %s failed: %s", url, curl_easy_strerror(t->result));
+        http_transfer_free(t);
+        return 0;
+    }
+    long status = 0;
+    curl_easy_getinfo(t->easy, CURLINFO_RESPONSE_CODE, &status);
+    *out = quicpro_body_take(&t->body);
+    http_transfer_free(t);
+    return status;
+}
+
+uint64_t quicpro_http_submit(const char *url, const char *method, zval *headers, zend_string *body, zval *options) {
+    http_transfer_t *t = http_transfer_new(url, method, headers, body, options);
+    if (!t) {
+        return 0;
+    }
+    t->id = http_engine.next_id++;
+    http_engine.pending++;
+    return t->id;
+}
+
+bool quicpro_http_step(void) {
+    if (!http_engine.multi) {
+        return true;
+    }
+    int running;
+    CURLMcode mrc = curl_multi_perform(http_engine.multi, &running);
+    if (mrc != CURLM_OK) {
+        throw_mcp_error_as_php_exception(0, "cURL transfer engine failed: %s", curl_multi_strerror(mrc));
+        return false;
+    }
+    http_engine_reap();
+    return !EG(exception);
+}
+
+bool quicpro_http_take(uint64_t *id, long *status) {
+    http_transfer_t *t = http_engine.done_head;
+    if (!t) {
+        return false;
+    }
+    http_engine.done_head = t->next;
+    if (!http_engine.done_head) {
+        http_engine.done_tail = NULL;
+    }
+    *id = t->id;
+    *status = 0;
+    if (t->result == CURLE_OK) {
+        curl_easy_getinfo(t->easy, CURLINFO_RESPONSE_CODE, status);
+    }
+    http_engine.pending--;
+    http_transfer_free(t);
+    return true;
+}
+
+bool quicpro_http_poll(struct pollfd *extra, unsigned count, int timeout_ms) {
+    if (!http_engine.multi) {
+        if (poll(extra, count, timeout_ms) < 0 && errno != EINTR) {
+            throw_network_exception(errno, "Failed to wait for sockets: %s", strerror(errno));
+            return false;
         }
-        #endif
-        // CURLOPT_SSH_COMPRESSION: Enable SSH compression (for SCP/SFTP protocols).
-        #ifdef CURLOPT_SSH_COMPRESSION
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "ssh_compression", sizeof("ssh_compression") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_SSH_COMPRESSION, 1L);
+        return true;
+    }
+    struct curl_waitfd *fds = count ? safe_emalloc(count, sizeof(*fds), 0) : NULL;
+    for (unsigned i = 0; i < count; i++) {
+        fds[i] = (struct curl_waitfd){ .fd = extra[i].fd, .events = CURL_WAIT_POLLIN, .revents = 0 };
+    }
+    CURLMcode mrc = curl_multi_poll(http_engine.multi, fds, count, timeout_ms, NULL);
+    for (unsigned i = 0; i < count; i++) {
+        extra[i].revents = fds[i].revents & CURL_WAIT_POLLIN ? POLLIN : 0;
+    }
+    if (fds) efree(fds);
+    if (mrc != CURLM_OK) {
+        throw_mcp_error_as_php_exception(0, "cURL transfer engine failed: %s", curl_multi_strerror(mrc));
+        return false;
+    }
+    return true;
+}
+
+zend_long quicpro_http_pending(void) {
+    return (zend_long)http_engine.pending;
+}
+
+/* {{{ quicpro_http_batch_submit(array $requests): array|false
+ *
+ * Starts every request on the transfer engine and returns at once with
+ * their ids, keyed like $requests. Each request is an array with `url`
+ * and, optionally, `method`, `headers`, `body` and `options` as for
+ * quicpro_http_request_send(). Requests to the same origin share
+ * connections (HTTP/2) or reuse them as they free up (HTTP/1.1).
+ */
+PHP_FUNCTION(quicpro_http_batch_submit) {
+    HashTable *requests;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT(requests)
+    ZEND_PARSE_PARAMETERS_END();
+
+    // Validate everything before starting anything
+    zval *spec, *z_url;
+    ZEND_HASH_FOREACH_VAL(requests, spec) {
+        if (Z_TYPE_P(spec) != IS_ARRAY
+            || !(z_url = zend_hash_str_find(Z_ARRVAL_P(spec), "url", sizeof("url") - 1))
+            || Z_TYPE_P(z_url) != IS_STRING) {
+            zend_argument_value_error(1, "must contain only arrays with a string \"url\"");
+            RETURN_THROWS();
         }
-        #endif
-        // CURLOPT_SSL_OPTIONS: Various SSL options.
-        #ifdef CURLOPT_SSL_OPTIONS
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "ssl_options", sizeof("ssl_options") - 1)) != NULL && Z_TYPE_P(opt_val) == IS_LONG) {
-            curl_easy_setopt(curl, CURLOPT_SSL_OPTIONS, Z_LVAL_P(opt_val)); // e.g., CURLSSLOPT_NO_REVOKE
+    } ZEND_HASH_FOREACH_END();
+
+    zend_ulong idx;
+    zend_string *key;
+    array_init_size(return_value, zend_hash_num_elements(requests));
+    ZEND_HASH_FOREACH_KEY_VAL(requests, idx, key, spec) {
+        HashTable *ht = Z_ARRVAL_P(spec);
+        zval *z_method  = zend_hash_str_find(ht, "method", sizeof("method") - 1);
+        zval *z_headers = zend_hash_str_find(ht, "headers", sizeof("headers") - 1);
+        zval *z_body    = zend_hash_str_find(ht, "body", sizeof("body") - 1);
+        zval *z_options = zend_hash_str_find(ht, "options", sizeof("options") - 1);
+
+        zend_string *body = z_body && Z_TYPE_P(z_body) == IS_STRING ? Z_STR_P(z_body) : NULL;
+        http_transfer_t *t = http_transfer_new(
+            Z_STRVAL_P(zend_hash_str_find(ht, "url", sizeof("url") - 1)),
+            z_method && Z_TYPE_P(z_method) == IS_STRING ? Z_STRVAL_P(z_method) : "GET",
+            z_headers, body, z_options);
+        if (!t) {
+            // Transfers started so far keep running; their completions stay claimable
+            zval_ptr_dtor(return_value);
+            RETURN_THROWS();
         }
-        #endif
-        // CURLOPT_HTTP09_ALLOWED: Allow HTTP/0.9 responses.
-        #ifdef CURLOPT_HTTP09_ALLOWED
-        if ((opt_val = zend_hash_str_find(Z_ARRVAL_P(options_array), "http09_allowed", sizeof("http09_allowed") - 1)) != NULL && zend_is_true(opt_val)) {
-            curl_easy_setopt(curl, CURLOPT_HTTP09_ALLOWED, 1L);
+        t->id = http_engine.next_id++;
+        http_engine.pending++;
+
+        if (key) {
+            add_assoc_long_ex(return_value, ZSTR_VAL(key), ZSTR_LEN(key), (zend_long)t->id);
+        } else {
+            add_index_long(return_value, idx, (zend_long)t->id);
         }
-        #endif
-    }
+    } ZEND_HASH_FOREACH_END();
 
-    // --- Execute the cURL request ---
-    res = curl_easy_perform(curl);
-    // Check for cURL errors
-    if (res != CURLE_OK) {
-        throw_mcp_error_as_php_exception(0, "cURL request failed: %s", curl_easy_strerror(res));
-        // Free dynamically allocated smart_str buffers and curl_slist before returning
-        smart_str_free(&response_body);
-        smart_str_free(&response_headers_raw);
-        curl_slist_free_all(headers_list);
-        curl_easy_cleanup(curl); // Always clean up the curl handle
+    // Kick off DNS and connects now rather than at the first wait.
+    int running;
+    curl_multi_perform(http_engine.multi, &running);
+}
+/* }}} */
+
+/* {{{ quicpro_http_batch_wait(int $timeout_ms = -1, int $max = 0): array|false
+ *
+ * Runs the transfer engine until at least one batch request has completed
+ * or $timeout_ms elapses, and returns up to $max (0: all) completions in
+ * the order they finished. Each has `id`, `status`, `body` and `headers`,
+ * or `id` and `error` for a transfer that failed. Returns [] on timeout or
+ * when nothing is pending.
+ */
+PHP_FUNCTION(quicpro_http_batch_wait) {
+    zend_long timeout_ms = -1;
+    zend_long max = 0;
+
+    ZEND_PARSE_PARAMETERS_START(0, 2)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(timeout_ms)
+        Z_PARAM_LONG(max)
+    ZEND_PARSE_PARAMETERS_END();
+
+    array_init(return_value);
+    if (!http_engine.multi || http_engine.pending == 0) {
+        return;
+    }
+    if (!http_engine.done_head && http_engine_run(NULL, timeout_ms) == FAILURE) {
+        zval_ptr_dtor(return_value);
         RETURN_FALSE;
     }
 
-    // --- Retrieve HTTP Response Status Code ---
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    http_transfer_t *t;
+    while ((max <= 0 || zend_hash_num_elements(Z_ARRVAL_P(return_value)) < (uint32_t)max)
+           && (t = http_engine.done_head)) {
+        http_engine.done_head = t->next;
+        if (!http_engine.done_head) {
+            http_engine.done_tail = NULL;
+        }
 
-    // --- Prepare PHP Return Value Array ---
-    array_init(return_value);
-    add_assoc_long(return_value, "status", http_code);
-    // Add the response body to the return array. If empty, use PHP's empty string.
-    add_assoc_str(return_value, "body", response_body.s ? response_body.s : zend_empty_string);
+        zval entry;
+        array_init_size(&entry, 4);
+        add_assoc_long(&entry, "id", (zend_long)t->id);
+        if (t->result == CURLE_OK) {
+            http_transfer_result(t, &entry);
+        } else if (t->aborted) {
+            add_assoc_string(&entry, "error", "The response body sink refused data");
+        } else {
+            add_assoc_string(&entry, "error", (char *)curl_easy_strerror(t->result));
+        }
+        add_next_index_zval(return_value, &entry);
 
-    // --- Parse and Add Response Headers to Return Array ---
-    zval headers_assoc_array; // Declare a zval for the associative headers array
-    array_init(&headers_assoc_array); // Initialize it as an empty PHP array
-    // Only parse if raw headers were actually received
-    if (response_headers_raw.s && ZSTR_LEN(response_headers_raw.s) > 0) {
-        parse_raw_headers_to_assoc_array(response_headers_raw.s, &headers_assoc_array);
+        http_engine.pending--;
+        http_transfer_free(t);
     }
-    // Add the parsed headers array to the main return array.
-    // Ownership of `headers_assoc_array` is transferred to `return_value`.
-    add_assoc_zval(return_value, "headers", &headers_assoc_array);
+}
+/* }}} */
 
-    // --- Final Cleanup of Resources ---
-    smart_str_free(&response_body);          // Free the smart_str allocated for the body
-    smart_str_free(&response_headers_raw);   // Free the smart_str allocated for raw headers
-    curl_slist_free_all(headers_list);       // Free the linked list of request headers
-    curl_easy_cleanup(curl);                 // Clean up the cURL easy handle, releasing all associated resources
-}
\ No newline at end of file
+/* {{{ quicpro_http_batch_pending(): int
+ *
+ * Number of batch requests whose completion has not been returned by
+ * quicpro_http_batch_wait() yet.
+ */
+PHP_FUNCTION(quicpro_http_batch_pending) {
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    RETURN_LONG((zend_long)http_engine.pending);
+}
+/* }}} */
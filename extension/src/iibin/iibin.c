@@ -7,7 +7,7 @@
  *
  * 1. Defining the `Quicpro\IIBIN` PHP class and its static methods.
  * 2. Creating the `zend_function_entry` list which maps the PHP class methods
- * to their corresponding C `PHP_FUNCTION` implementations.
+ * to their corresponding C `PHP_FUNCTION` implementations (ZEND_ME_MAPPING).
  * 3. Providing module-specific lifecycle hooks (MINIT and MSHUTDOWN) to initialize
  * and destroy the global schema and enum registries, ensuring proper
  * resource management.
@@ -19,6 +19,10 @@
 #include "php_quicpro.h"
 #include "iibin.h"
 #include "iibin_internal.h"
+#include "iibin_view.h"
+#include "iibin_shm.h"
+#include "iibin_batch.h"
+#include "iibin_descriptor.h"
 #include "cancel.h" /* For error throwing helpers, if needed */
 
 
@@ -45,10 +49,69 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_iibin_encode, 0, 0, 2)
     ZEND_ARG_TYPE_INFO(0, phpData, 0, 0) /* Can be array or object */
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_encode_many, 0, 2, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, schemaName, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, messages, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_iibin_encode_to_stream, 0, 0, 3)
+    ZEND_ARG_TYPE_INFO(0, schemaName, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, phpData, 0, 0)
+    ZEND_ARG_INFO(0, stream)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_iibin_decode, 0, 0, 2)
     ZEND_ARG_TYPE_INFO(0, schemaName, IS_STRING, 0)
     ZEND_ARG_TYPE_INFO(0, binaryData, IS_STRING, 0)
     ZEND_ARG_TYPE_INFO(0, decodeAsObject, IS_FALSE, 1) /* Optional bool */
+    ZEND_ARG_TYPE_INFO(0, arena, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_iibin_decode_view, 0, 0, 2)
+    ZEND_ARG_TYPE_INFO(0, schemaName, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, binaryData, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_iibin_encode_batch, 0, 0, 2)
+    ZEND_ARG_TYPE_INFO(0, schemaName, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, rows, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_iibin_decode_batch, 0, 0, 2)
+    ZEND_ARG_TYPE_INFO(0, schemaName, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, binaryData, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_iibin_schema_id, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, schemaName, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_iibin_schema_descriptor, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, schemaName, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_iibin_define_from_descriptor, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, descriptor, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_iibin_schema_name_by_id, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, id, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_iibin_encode_shared, 0, 0, 2)
+    ZEND_ARG_TYPE_INFO(0, schemaName, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, phpData, 0, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_iibin_decode_shared, 0, 0, 2)
+    ZEND_ARG_TYPE_INFO(0, schemaName, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, ref, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO(0, decodeAsObject, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, release, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_iibin_release_shared, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, ref, IS_LONG, 0)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_iibin_is_defined, 0, 0, 1)
@@ -76,15 +139,27 @@ ZEND_END_ARG_INFO()
  * to their corresponding C function implementations.
  */
 static const zend_function_entry quicpro_iibin_methods[] = {
-    PHP_ME(QuicproIIBIN, defineEnum,         arginfo_quicpro_iibin_define_enum,         ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
-    PHP_ME(QuicproIIBIN, defineSchema,       arginfo_quicpro_iibin_define_schema,       ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
-    PHP_ME(QuicproIIBIN, encode,             arginfo_quicpro_iibin_encode,              ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
-    PHP_ME(QuicproIIBIN, decode,             arginfo_quicpro_iibin_decode,              ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
-    PHP_ME(QuicproIIBIN, isDefined,          arginfo_quicpro_iibin_is_defined,          ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
-    PHP_ME(QuicproIIBIN, isSchemaDefined,    arginfo_quicpro_iibin_is_schema_defined,   ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
-    PHP_ME(QuicproIIBIN, isEnumDefined,      arginfo_quicpro_iibin_is_enum_defined,     ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
-    PHP_ME(QuicproIIBIN, getDefinedSchemas,  arginfo_quicpro_iibin_get_defined_schemas, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
-    PHP_ME(QuicproIIBIN, getDefinedEnums,    arginfo_quicpro_iibin_get_defined_enums,   ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(defineEnum,           quicpro_iibin_define_enum,            arginfo_quicpro_iibin_define_enum,            ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(defineSchema,         quicpro_iibin_define_schema,          arginfo_quicpro_iibin_define_schema,          ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(encode,               quicpro_iibin_encode,                 arginfo_quicpro_iibin_encode,                 ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(encodeMany,           quicpro_iibin_encode_many,            arginfo_quicpro_iibin_encode_many,            ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(encodeToStream,       quicpro_iibin_encode_to_stream,       arginfo_quicpro_iibin_encode_to_stream,       ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(decode,               quicpro_iibin_decode,                 arginfo_quicpro_iibin_decode,                 ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(decodeView,           quicpro_iibin_decode_view,            arginfo_quicpro_iibin_decode_view,            ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(encodeBatch,          quicpro_iibin_encode_batch,           arginfo_quicpro_iibin_encode_batch,           ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(decodeBatch,          quicpro_iibin_decode_batch,           arginfo_quicpro_iibin_decode_batch,           ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(schemaId,             quicpro_iibin_schema_id,              arginfo_quicpro_iibin_schema_id,              ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(schemaDescriptor,     quicpro_iibin_schema_descriptor,      arginfo_quicpro_iibin_schema_descriptor,      ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(defineFromDescriptor, quicpro_iibin_define_from_descriptor, arginfo_quicpro_iibin_define_from_descriptor, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(schemaNameById,       quicpro_iibin_schema_name_by_id,      arginfo_quicpro_iibin_schema_name_by_id,      ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(encodeShared,         quicpro_iibin_encode_shared,          arginfo_quicpro_iibin_encode_shared,          ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(decodeShared,         quicpro_iibin_decode_shared,          arginfo_quicpro_iibin_decode_shared,          ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(releaseShared,        quicpro_iibin_release_shared,         arginfo_quicpro_iibin_release_shared,         ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(isDefined,            quicpro_iibin_is_defined,             arginfo_quicpro_iibin_is_defined,             ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(isSchemaDefined,      quicpro_iibin_is_schema_defined,      arginfo_quicpro_iibin_is_schema_defined,      ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(isEnumDefined,        quicpro_iibin_is_enum_defined,        arginfo_quicpro_iibin_is_enum_defined,        ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(getDefinedSchemas,    quicpro_iibin_get_defined_schemas,    arginfo_quicpro_iibin_get_defined_schemas,    ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    ZEND_ME_MAPPING(getDefinedEnums,      quicpro_iibin_get_defined_enums,      arginfo_quicpro_iibin_get_defined_enums,      ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
     PHP_FE_END
 };
 
@@ -103,8 +178,9 @@ zend_class_entry *quicpro_ce_iibin;
  * @brief Initializes the IIBIN module during PHP's MINIT phase.
  *
  * This function registers the `Quicpro\IIBIN` class and its methods with the
- * Zend Engine. It also calls the initialization function for the global
- * schema and enum registries.
+ * Zend Engine, together with `Quicpro\IIBIN\View` and `Quicpro\IIBIN\Batch`.
+ * It also calls the initialization function for the global schema and enum
+ * registries.
  */
 void quicpro_iibin_minit(void)
 {
@@ -113,6 +189,9 @@ void quicpro_iibin_minit(void)
     INIT_NS_CLASS_ENTRY(ce, "Quicpro", "IIBIN", quicpro_iibin_methods);
     quicpro_ce_iibin = zend_register_internal_class(&ce);
     /* The IIBIN class contains only static methods, so no object handlers are needed. */
+    quicpro_iibin_view_minit();
+    quicpro_iibin_batch_minit();
+    quicpro_iibin_shm_minit();
 
     /* Initialize the global schema and enum registries. */
     quicpro_iibin_registries_init();
@@ -127,6 +206,7 @@ void quicpro_iibin_minit(void)
  */
 void quicpro_iibin_mshutdown(void)
 {
+    quicpro_iibin_shm_mshutdown();
     quicpro_iibin_registries_shutdown();
 }
 
@@ -0,0 +1,197 @@
+/*
+ * src/iibin_arena.c – Request arena for decoded IIBIN arrays
+ * ==========================================================
+ *
+ * IIBIN::decode(..., arena: true) moves the decoded array tree into a
+ * single block, the way opcache persists a script's constant arrays: every
+ * array in it is flagged immutable and every string interned, so nothing
+ * in the block is reference counted. Reading it costs no refcount traffic,
+ * the cycle collector never visits it, a write separates a private copy as
+ * for any immutable array, and dropping the last reference does nothing.
+ * The blocks are freed together once the request has ended
+ * (quicpro_iibin_arena_release(), after the executor is gone).
+ *
+ * A tree is measured first and copied with one allocation. Trees that would
+ * take the request past quicpro.iibin_arena_max_mb stay ordinary arrays, so
+ * a long-running worker request cannot grow the arena without bound.
+ */
+
+#include "php_quicpro.h"
+#include "iibin.h"
+#include "iibin_internal.h"
+#include "config/iibin/base_layer.h"
+
+#include <zend_types.h>
+#include <string.h>
+
+typedef struct iibin_arena_block {
+    struct iibin_arena_block *next;
+    size_t size;
+} iibin_arena_block;
+
+static ZEND_TLS iibin_arena_block *arena_blocks;
+static ZEND_TLS size_t arena_used;
+
+#define ARENA_ALIGN(n) ZEND_MM_ALIGNED_SIZE(n)
+
+/* The bytes a hash table's data takes in the copy: its hash part and the used slots. */
+static inline size_t arena_ht_data_size(const HashTable *ht)
+{
+#if PHP_VERSION_ID >= 80200
+    if (HT_IS_PACKED(ht)) {
+        return HT_PACKED_USED_SIZE(ht);
+    }
+#endif
+    return HT_USED_SIZE(ht);
+}
+
+static size_t arena_measure(const zval *zv);
+
+static size_t arena_measure_ht(const HashTable *ht)
+{
+    if (HT_FLAGS(ht) & HASH_FLAG_UNINITIALIZED) {
+        return 0;   /* Becomes the shared empty array */
+    }
+    size_t size = ARENA_ALIGN(sizeof(HashTable)) + ARENA_ALIGN(arena_ht_data_size(ht));
+    zend_string *key;
+    zval *val;
+    ZEND_HASH_FOREACH_STR_KEY_VAL(ht, key, val) {
+        if (key && !ZSTR_IS_INTERNED(key)) {
+            size += ARENA_ALIGN(_ZSTR_STRUCT_SIZE(ZSTR_LEN(key)));
+        }
+        size += arena_measure(val);
+    } ZEND_HASH_FOREACH_END();
+    return size;
+}
+
+/* Bytes the copy of what zv points to needs; (size_t)-1 if it cannot be frozen. */
+static size_t arena_measure(const zval *zv)
+{
+    switch (Z_TYPE_P(zv)) {
+        case IS_STRING:
+            return Z_REFCOUNTED_P(zv) ? ARENA_ALIGN(_ZSTR_STRUCT_SIZE(Z_STRLEN_P(zv))) : 0;
+        case IS_ARRAY:
+            return Z_REFCOUNTED_P(zv) ? arena_measure_ht(Z_ARRVAL_P(zv)) : 0;   /* Immutable already */
+        case IS_OBJECT: case IS_RESOURCE: case IS_REFERENCE:
+            return (size_t)-1;
+        default:
+            return 0;
+    }
+}
+
+static zend_string *arena_copy_string(char **cursor, const zend_string *src)
+{
+    zend_string *dst = (zend_string *)*cursor;
+    size_t size = _ZSTR_STRUCT_SIZE(ZSTR_LEN(src));
+    memcpy(dst, src, size);
+    *cursor += ARENA_ALIGN(size);
+    zend_string_hash_val(dst);
+    GC_SET_REFCOUNT(dst, 2);
+    GC_TYPE_INFO(dst) = GC_STRING | (IS_STR_INTERNED << GC_FLAGS_SHIFT);
+    return dst;
+}
+
+static void arena_copy(char **cursor, zval *zv);
+
+static HashTable *arena_copy_ht(char **cursor, const HashTable *src)
+{
+    HashTable *ht = (HashTable *)*cursor;
+    *cursor += ARENA_ALIGN(sizeof(HashTable));
+    memcpy(ht, src, sizeof(HashTable));
+
+    size_t data_size = arena_ht_data_size(src);
+    void *data = *cursor;
+    *cursor += ARENA_ALIGN(data_size);
+#if PHP_VERSION_ID >= 80200
+    if (HT_IS_PACKED(src)) {
+        memcpy(data, HT_GET_DATA_ADDR(src), data_size);
+    } else
+#endif
+    {
+        /* Hash part, then the used buckets; the free tail is not copied */
+        memcpy(data, HT_GET_DATA_ADDR(src), HT_HASH_SIZE(src->nTableMask));
+        memcpy((char *)data + HT_HASH_SIZE(src->nTableMask), src->arData, src->nNumUsed * sizeof(Bucket));
+    }
+    HT_SET_DATA_ADDR(ht, data);
+    ht->pDestructor = NULL;
+
+#if PHP_VERSION_ID >= 80200
+    if (HT_IS_PACKED(ht)) {
+        zval *val;
+        ZEND_HASH_PACKED_FOREACH_VAL(ht, val) {
+            arena_copy(cursor, val);
+        } ZEND_HASH_FOREACH_END();
+    } else
+#endif
+    {
+        Bucket *p;
+        ZEND_HASH_FOREACH_BUCKET(ht, p) {
+            if (p->key && !ZSTR_IS_INTERNED(p->key)) {
+                p->key = arena_copy_string(cursor, p->key);
+            }
+            arena_copy(cursor, &p->val);
+        } ZEND_HASH_FOREACH_END();
+    }
+    HT_FLAGS(ht) |= HASH_FLAG_STATIC_KEYS;
+    GC_SET_REFCOUNT(ht, 2);
+    GC_TYPE_INFO(ht) = GC_ARRAY | ((IS_ARRAY_IMMUTABLE | GC_NOT_COLLECTABLE) << GC_FLAGS_SHIFT);
+    return ht;
+}
+
+/* Replaces zv's string or array by its copy in the block; the original is left to the caller. */
+static void arena_copy(char **cursor, zval *zv)
+{
+    if (Z_TYPE_P(zv) == IS_STRING && Z_REFCOUNTED_P(zv)) {
+        ZVAL_INTERNED_STR(zv, arena_copy_string(cursor, Z_STR_P(zv)));
+    } else if (Z_TYPE_P(zv) == IS_ARRAY && Z_REFCOUNTED_P(zv)) {
+        if (HT_FLAGS(Z_ARRVAL_P(zv)) & HASH_FLAG_UNINITIALIZED) {
+            ZVAL_EMPTY_ARRAY(zv);
+        } else {
+            ZVAL_ARR(zv, arena_copy_ht(cursor, Z_ARRVAL_P(zv)));
+            Z_TYPE_FLAGS_P(zv) = 0;
+        }
+    }
+}
+
+int quicpro_iibin_arena_freeze(zval *value)
+{
+    if (Z_TYPE_P(value) != IS_ARRAY || !Z_REFCOUNTED_P(value)) {
+        return SUCCESS;
+    }
+    size_t size = arena_measure(value);
+    size_t limit = (size_t)quicpro_iibin_config.arena_max_mb * 1024 * 1024;
+    if (size == (size_t)-1 || arena_used + size > limit) {
+        return FAILURE;
+    }
+    if (HT_FLAGS(Z_ARRVAL_P(value)) & HASH_FLAG_UNINITIALIZED) {
+        zval_ptr_dtor(value);
+        ZVAL_EMPTY_ARRAY(value);
+        return SUCCESS;
+    }
+
+    iibin_arena_block *block = emalloc(ARENA_ALIGN(sizeof(iibin_arena_block)) + size);
+    block->size = size;
+    block->next = arena_blocks;
+    arena_blocks = block;
+    arena_used += size;
+
+    char *cursor = (char *)block + ARENA_ALIGN(sizeof(iibin_arena_block));
+    zval copy;
+    ZVAL_COPY_VALUE(&copy, value);
+    arena_copy(&cursor, &copy);
+    ZEND_ASSERT(cursor == (char *)block + ARENA_ALIGN(sizeof(iibin_arena_block)) + size);
+
+    zval_ptr_dtor(value);
+    ZVAL_COPY_VALUE(value, &copy);
+    return SUCCESS;
+}
+
+void quicpro_iibin_arena_release(void)
+{
+    while (arena_blocks) {
+        iibin_arena_block *next = arena_blocks->next;
+        efree(arena_blocks);
+        arena_blocks = next;
+    }
+    arena_used = 0;
+}
@@ -0,0 +1,1055 @@
+/*
+ * src/iibin_batch.c – Columnar IIBIN batches (Quicpro\IIBIN\Batch)
+ * ================================================================
+ *
+ * The encoder runs the schema's program once per column, over all rows,
+ * and writes one column at a time (see iibin_batch.h for the format).
+ * The decoder unpacks each column into a C array at decodeBatch() and
+ * builds the PHP array of a row from those when the row is read.
+ */
+
+#include "php_quicpro.h"
+#include "iibin.h"
+#include "iibin_internal.h"
+#include "iibin_batch.h"
+#include "cancel.h"
+
+#include <zend_exceptions.h>
+#include <zend_interfaces.h>
+#include <zend_smart_str.h>
+#include <string.h>
+
+#define BATCH_VERSION 1
+
+#define BATCH_PRESENT_ALL    0
+#define BATCH_PRESENT_BITMAP 1
+
+#define BATCH_ENC_NONE    0   /* No column: absent from every row */
+#define BATCH_ENC_DELTA   1
+#define BATCH_ENC_BITS    2
+#define BATCH_ENC_FIXED32 3
+#define BATCH_ENC_FIXED64 4
+#define BATCH_ENC_DICT    5
+#define BATCH_ENC_PLAIN   6
+#define BATCH_ENC_WIRE    7
+
+/* The column encoding of a field; DICT and PLAIN are both fine for strings. */
+static uint8_t batch_encoding_of(const quicpro_iibin_insn *insn)
+{
+    if (insn->flags & IIBIN_FIELD_FLAG_REPEATED) {
+        return BATCH_ENC_WIRE;
+    }
+    switch (insn->op) {
+        case IIBIN_OP_BOOL:    return BATCH_ENC_BITS;
+        case IIBIN_OP_FLOAT:   return BATCH_ENC_FIXED32;
+        case IIBIN_OP_DOUBLE:  return BATCH_ENC_FIXED64;
+        case IIBIN_OP_BYTES:   return BATCH_ENC_DICT;
+        case IIBIN_OP_MESSAGE: return BATCH_ENC_WIRE;
+        default:               return BATCH_ENC_DELTA;
+    }
+}
+
+/* The integer IIBIN::decode() returns for this value: 32-bit types are truncated as on the wire. */
+static inline zend_long batch_normalize_long(uint8_t op, zend_long v)
+{
+    switch (op) {
+        case IIBIN_OP_INT32: case IIBIN_OP_ENUM: case IIBIN_OP_ZIGZAG32: case IIBIN_OP_SFIXED32:
+            return (int32_t)v;
+        case IIBIN_OP_FIXED32:
+            return (zend_long)(uint32_t)v;
+        default:
+            return v;
+    }
+}
+
+/*──────────────────────────── Encoding ───────────────────────────────────*/
+
+typedef struct {
+    zval   **rows;
+    size_t   num_rows;
+    zval   **vals;         /* Per row: the current column's value, NULL if absent */
+    zval    *tmp;          /* Per row: slot for zend_read_property_ex() */
+} batch_encoder;
+
+static const char *batch_type_name(zval *value)
+{
+    return zend_get_type_by_const(Z_TYPE_P(value));
+}
+
+/* Fills enc->vals for one field; returns the number of rows that have it, or (size_t)-1 after throwing. */
+static size_t batch_gather(batch_encoder *enc, const quicpro_iibin_insn *insn)
+{
+    size_t present = 0;
+    for (size_t r = 0; r < enc->num_rows; r++) {
+        zval *row = enc->rows[r];
+        zval *value;
+        if (Z_TYPE_P(row) == IS_ARRAY) {
+            value = zend_hash_find_known_hash(Z_ARRVAL_P(row), insn->name);
+        } else {
+            value = zend_read_property_ex(Z_OBJCE_P(row), Z_OBJ_P(row), insn->name, 1, &enc->tmp[r]);
+        }
+        if (value) {
+            ZVAL_DEREF(value);
+        }
+        if (!value || Z_TYPE_P(value) <= IS_NULL
+            || ((insn->flags & IIBIN_FIELD_FLAG_REPEATED) && Z_TYPE_P(value) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL_P(value)) == 0)) {
+            if (insn->flags & IIBIN_FIELD_FLAG_REQUIRED) {
+                throw_iibin_error_as_php_exception(0, "Batch encoding failed: Required field '%s' (tag %u) is missing or null in row %zu.", ZSTR_VAL(insn->name), insn->tag, r);
+                return (size_t)-1;
+            }
+            enc->vals[r] = NULL;
+            continue;
+        }
+        enc->vals[r] = value;
+        present++;
+    }
+    return present;
+}
+
+static int batch_type_error(const quicpro_iibin_insn *insn, size_t row, const char *expected, zval *value)
+{
+    throw_iibin_error_as_php_exception(0, "Batch encoding failed: Field '%s' in row %zu expects %s, but got %s.", ZSTR_VAL(insn->name), row, expected, batch_type_name(value));
+    return FAILURE;
+}
+
+static int batch_long_value(const quicpro_iibin_insn *insn, size_t row, zval *value, zend_long *out)
+{
+    if (insn->op == IIBIN_OP_ENUM && Z_TYPE_P(value) == IS_STRING) {
+        quicpro_iibin_enum_value_def_internal *def = zend_hash_find_ptr(&insn->enum_def->values_by_name, Z_STR_P(value));
+        if (!def) {
+            throw_iibin_error_as_php_exception(0, "Batch encoding failed: Enum value name '%s' is not a valid member of enum '%s' for field '%s' in row %zu.", Z_STRVAL_P(value), insn->enum_def->enum_name, ZSTR_VAL(insn->name), row);
+            return FAILURE;
+        }
+        *out = def->number;
+        return SUCCESS;
+    }
+    if (Z_TYPE_P(value) != IS_LONG) {
+        return batch_type_error(insn, row, insn->op == IIBIN_OP_ENUM ? "an integer or string" : "an integer", value);
+    }
+    *out = batch_normalize_long(insn->op, Z_LVAL_P(value));
+    return SUCCESS;
+}
+
+static int batch_encode_delta(batch_encoder *enc, const quicpro_iibin_insn *insn, smart_str *col)
+{
+    zend_long prev = 0;
+    for (size_t r = 0; r < enc->num_rows; r++) {
+        zend_long v;
+        if (!enc->vals[r]) continue;
+        if (batch_long_value(insn, r, enc->vals[r], &v) == FAILURE) {
+            return FAILURE;
+        }
+        /* Wrapping difference: any two 64-bit values have a delta that round-trips */
+        quicpro_iibin_encode_varint(col, quicpro_iibin_zigzag_encode64((int64_t)((uint64_t)v - (uint64_t)prev)));
+        prev = v;
+    }
+    return SUCCESS;
+}
+
+static int batch_encode_bits(batch_encoder *enc, const quicpro_iibin_insn *insn, smart_str *col, size_t present)
+{
+    size_t nbytes = (present + 7) / 8;
+    smart_str_alloc(col, nbytes, 0);
+    unsigned char *bits = (unsigned char *)ZSTR_VAL(col->s) + ZSTR_LEN(col->s);
+    memset(bits, 0, nbytes);
+    size_t k = 0;
+    for (size_t r = 0; r < enc->num_rows; r++) {
+        zval *value = enc->vals[r];
+        if (!value) continue;
+        if (Z_TYPE_P(value) != IS_TRUE && Z_TYPE_P(value) != IS_FALSE) {
+            return batch_type_error(insn, r, "a boolean", value);
+        }
+        if (Z_TYPE_P(value) == IS_TRUE) {
+            bits[k >> 3] |= (unsigned char)(1u << (k & 7));
+        }
+        k++;
+    }
+    ZSTR_LEN(col->s) += nbytes;
+    return SUCCESS;
+}
+
+static int batch_encode_fixed(batch_encoder *enc, const quicpro_iibin_insn *insn, smart_str *col)
+{
+    for (size_t r = 0; r < enc->num_rows; r++) {
+        zval *value = enc->vals[r];
+        if (!value) continue;
+        if (Z_TYPE_P(value) != IS_DOUBLE && Z_TYPE_P(value) != IS_LONG) {
+            return batch_type_error(insn, r, "a float or integer", value);
+        }
+        double d = zval_get_double(value);
+        if (insn->op == IIBIN_OP_FLOAT) {
+            float f = (float)d;
+            uint32_t bits;
+            memcpy(&bits, &f, sizeof(bits));
+            quicpro_iibin_encode_fixed32(col, bits);
+        } else {
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            quicpro_iibin_encode_fixed64(col, bits);
+        }
+    }
+    return SUCCESS;
+}
+
+/*
+ * Strings get a dictionary while at most half the values are distinct:
+ * states, labels, hostnames. Ids, free text and the like, where the
+ * dictionary would only add its indexes, are written out in full.
+ */
+static int batch_encode_strings(batch_encoder *enc, const quicpro_iibin_insn *insn, smart_str *col, size_t present)
+{
+    HashTable dict;
+    uint32_t *codes = emalloc(present * sizeof(uint32_t));
+    zend_bool use_dict = 1;
+    size_t k = 0;
+
+    zend_hash_init(&dict, 8, NULL, NULL, 0);
+    for (size_t r = 0; r < enc->num_rows; r++) {
+        zval *value = enc->vals[r];
+        if (!value) continue;
+        if (Z_TYPE_P(value) != IS_STRING) {
+            zend_hash_destroy(&dict);
+            efree(codes);
+            return batch_type_error(insn, r, "a string", value);
+        }
+        if (use_dict) {
+            zval *code = zend_hash_find(&dict, Z_STR_P(value));
+            if (code) {
+                codes[k] = (uint32_t)Z_LVAL_P(code);
+            } else if (zend_hash_num_elements(&dict) * 2 >= present) {
+                use_dict = 0;
+            } else {
+                zval next;
+                ZVAL_LONG(&next, zend_hash_num_elements(&dict));
+                codes[k] = (uint32_t)Z_LVAL(next);
+                zend_hash_add_new(&dict, Z_STR_P(value), &next);
+            }
+        }
+        k++;
+    }
+
+    if (use_dict) {
+        zend_string *str;
+        smart_str_appendc(col, BATCH_ENC_DICT);
+        quicpro_iibin_encode_varint(col, zend_hash_num_elements(&dict));
+        ZEND_HASH_FOREACH_STR_KEY(&dict, str) {
+            quicpro_iibin_encode_varint(col, ZSTR_LEN(str));
+            smart_str_appendl(col, ZSTR_VAL(str), ZSTR_LEN(str));
+        } ZEND_HASH_FOREACH_END();
+        for (k = 0; k < present; k++) {
+            quicpro_iibin_encode_varint(col, codes[k]);
+        }
+    } else {
+        smart_str_appendc(col, BATCH_ENC_PLAIN);
+        for (size_t r = 0; r < enc->num_rows; r++) {
+            zval *value = enc->vals[r];
+            if (!value) continue;
+            quicpro_iibin_encode_varint(col, Z_STRLEN_P(value));
+            smart_str_appendl(col, Z_STRVAL_P(value), Z_STRLEN_P(value));
+        }
+    }
+    zend_hash_destroy(&dict);
+    efree(codes);
+    return SUCCESS;
+}
+
+static int batch_encode_wire(batch_encoder *enc, const quicpro_iibin_insn *insn, smart_str *col)
+{
+    smart_str field = {0};
+    for (size_t r = 0; r < enc->num_rows; r++) {
+        if (!enc->vals[r]) continue;
+        if (field.s) {
+            ZSTR_LEN(field.s) = 0;
+        }
+        if (quicpro_iibin_encode_field(&field, insn, enc->vals[r]) == FAILURE) {
+            smart_str_free(&field);
+            return FAILURE;
+        }
+        quicpro_iibin_encode_varint(col, ZSTR_LEN(field.s));
+        smart_str_appendl(col, ZSTR_VAL(field.s), ZSTR_LEN(field.s));
+    }
+    smart_str_free(&field);
+    return SUCCESS;
+}
+
+/* Appends the column of one field to out; a field no row has writes nothing. */
+static int batch_encode_column(batch_encoder *enc, const quicpro_iibin_insn *insn, smart_str *out, uint32_t *num_columns)
+{
+    size_t present = batch_gather(enc, insn);
+    if (present == (size_t)-1) {
+        return FAILURE;
+    }
+    if (present == 0) {
+        return SUCCESS;
+    }
+
+    smart_str col = {0};
+    if (present == enc->num_rows) {
+        smart_str_appendc(&col, BATCH_PRESENT_ALL);
+    } else {
+        size_t nbytes = (enc->num_rows + 7) / 8;
+        smart_str_appendc(&col, BATCH_PRESENT_BITMAP);
+        smart_str_alloc(&col, nbytes, 0);
+        unsigned char *bitmap = (unsigned char *)ZSTR_VAL(col.s) + ZSTR_LEN(col.s);
+        memset(bitmap, 0, nbytes);
+        for (size_t r = 0; r < enc->num_rows; r++) {
+            if (enc->vals[r]) {
+                bitmap[r >> 3] |= (unsigned char)(1u << (r & 7));
+            }
+        }
+        ZSTR_LEN(col.s) += nbytes;
+    }
+
+    int rc;
+    uint8_t encoding = batch_encoding_of(insn);
+    if (encoding != BATCH_ENC_DICT) {
+        smart_str_appendc(&col, (char)encoding);
+    }
+    switch (encoding) {
+        case BATCH_ENC_DELTA:   rc = batch_encode_delta(enc, insn, &col); break;
+        case BATCH_ENC_BITS:    rc = batch_encode_bits(enc, insn, &col, present); break;
+        case BATCH_ENC_FIXED32:
+        case BATCH_ENC_FIXED64: rc = batch_encode_fixed(enc, insn, &col); break;
+        case BATCH_ENC_DICT:    rc = batch_encode_strings(enc, insn, &col, present); break;
+        default:                rc = batch_encode_wire(enc, insn, &col); break;
+    }
+    if (rc == SUCCESS) {
+        quicpro_iibin_encode_varint(out, insn->tag);
+        quicpro_iibin_encode_varint(out, ZSTR_LEN(col.s));
+        smart_str_append(out, col.s);
+        (*num_columns)++;
+    }
+    smart_str_free(&col);
+    return rc;
+}
+
+PHP_FUNCTION(quicpro_iibin_encode_batch)
+{
+    char *schema_name_str;
+    size_t schema_name_len;
+    HashTable *rows_ht;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_STRING(schema_name_str, schema_name_len)
+        Z_PARAM_ARRAY_HT(rows_ht)
+    ZEND_PARSE_PARAMETERS_END();
+
+    const quicpro_iibin_compiled_schema_internal *schema = get_compiled_iibin_schema_internal(schema_name_str);
+    if (!schema) {
+        throw_iibin_error_as_php_exception(0, "Schema '%s' not defined for encoding.", schema_name_str);
+        RETURN_THROWS();
+    }
+
+    batch_encoder enc = { .num_rows = zend_hash_num_elements(rows_ht) };
+    size_t alloc_rows = enc.num_rows ? enc.num_rows : 1;
+    enc.rows = emalloc(alloc_rows * sizeof(zval *));
+    enc.vals = emalloc(alloc_rows * sizeof(zval *));
+    enc.tmp = safe_emalloc(alloc_rows, sizeof(zval), 0);
+
+    size_t r = 0;
+    zval *row;
+    ZEND_HASH_FOREACH_VAL(rows_ht, row) {
+        ZVAL_DEREF(row);
+        if (Z_TYPE_P(row) != IS_ARRAY && Z_TYPE_P(row) != IS_OBJECT) {
+            throw_iibin_error_as_php_exception(0, "Row %zu of the batch for message type '%s' must be an array or object, but got %s.", r, schema->schema_name, batch_type_name(row));
+            efree(enc.rows); efree(enc.vals); efree(enc.tmp);
+            RETURN_THROWS();
+        }
+        enc.rows[r++] = row;
+    } ZEND_HASH_FOREACH_END();
+
+    /* The column count is not known until empty columns are dropped, so columns go to their own buffer */
+    smart_str columns = {0};
+    uint32_t num_columns = 0;
+    int rc = SUCCESS;
+    for (size_t i = 0; i < schema->num_fields && rc == SUCCESS; i++) {
+        for (r = 0; r < enc.num_rows; r++) {
+            ZVAL_UNDEF(&enc.tmp[r]);
+        }
+        rc = batch_encode_column(&enc, &schema->program[i], &columns, &num_columns);
+        for (r = 0; r < enc.num_rows; r++) {
+            zval_ptr_dtor(&enc.tmp[r]);
+        }
+    }
+    efree(enc.rows); efree(enc.vals); efree(enc.tmp);
+    if (rc == FAILURE) {
+        smart_str_free(&columns);
+        RETURN_THROWS();
+    }
+
+    smart_str out = {0};
+    smart_str_alloc(&out, 1 + 2 * QUICPRO_IIBIN_VARINT_MAX_LEN + (columns.s ? ZSTR_LEN(columns.s) : 0), 0);
+    smart_str_appendc(&out, BATCH_VERSION);
+    quicpro_iibin_encode_varint(&out, enc.num_rows);
+    quicpro_iibin_encode_varint(&out, num_columns);
+    if (columns.s) {
+        smart_str_append(&out, columns.s);
+    }
+    smart_str_free(&columns);
+    RETURN_STR(smart_str_extract(&out));
+}
+
+/*──────────────────────────── Decoded batches ────────────────────────────*/
+
+typedef struct {
+    uint8_t   encoding;          /* BATCH_ENC_*; NONE: the field is in no row */
+    uint32_t *slot;              /* Per row: value index + 1, 0 if absent. NULL: set in every row */
+    union {
+        zend_long          *ints;
+        double             *floats;
+        const unsigned char *bits;     /* Into buf */
+        struct {
+            zend_string **strings;
+            uint32_t      len;
+            uint32_t     *codes;
+        } dict;
+        struct {
+            uint32_t *off;             /* PLAIN and WIRE: value bytes in buf */
+            uint32_t *len;
+        } span;
+    } v;
+} batch_column;
+
+typedef struct {
+    const quicpro_iibin_compiled_schema_internal *schema;
+    zend_string  *buf;           /* The encoded batch, referenced */
+    uint32_t      rows;
+    uint32_t      pos;           /* Iterator position */
+    batch_column *columns;       /* One per instruction of the schema */
+    zend_object   std;
+} quicpro_iibin_batch_object;
+
+zend_class_entry *quicpro_ce_iibin_batch;
+static zend_object_handlers quicpro_iibin_batch_handlers;
+
+static inline quicpro_iibin_batch_object *batch_from_obj(zend_object *obj)
+{
+    return (quicpro_iibin_batch_object *)((char *)obj - XtOffsetOf(quicpro_iibin_batch_object, std));
+}
+
+#define THIS_BATCH() batch_from_obj(Z_OBJ_P(ZEND_THIS))
+
+static void batch_column_free(batch_column *c)
+{
+    if (c->slot) {
+        efree(c->slot);
+    }
+    switch (c->encoding) {
+        case BATCH_ENC_DELTA:
+            if (c->v.ints) efree(c->v.ints);
+            break;
+        case BATCH_ENC_FIXED32:
+        case BATCH_ENC_FIXED64:
+            if (c->v.floats) efree(c->v.floats);
+            break;
+        case BATCH_ENC_DICT:
+            if (c->v.dict.strings) {
+                for (uint32_t i = 0; i < c->v.dict.len; i++) {
+                    if (c->v.dict.strings[i]) zend_string_release(c->v.dict.strings[i]);
+                }
+                efree(c->v.dict.strings);
+            }
+            if (c->v.dict.codes) efree(c->v.dict.codes);
+            break;
+        case BATCH_ENC_PLAIN:
+        case BATCH_ENC_WIRE:
+            if (c->v.span.off) efree(c->v.span.off);
+            if (c->v.span.len) efree(c->v.span.len);
+            break;
+    }
+    memset(c, 0, sizeof(*c));
+}
+
+static int batch_malformed(const quicpro_iibin_compiled_schema_internal *schema, const quicpro_iibin_insn *insn)
+{
+    throw_iibin_error_as_php_exception(0, "Decoding error: malformed batch column for field '%s' (tag %u) in schema '%s'.",
+                                       ZSTR_VAL(insn->name), insn->tag, schema->schema_name);
+    return FAILURE;
+}
+
+/* Reads `count` length-prefixed values into off/len; each is at least its one length byte. */
+static zend_bool batch_read_spans(const unsigned char *base, const unsigned char **p, const unsigned char *end, uint32_t count,
+                                  uint32_t **off_out, uint32_t **len_out)
+{
+    if (count > (size_t)(end - *p)) return 0;
+    uint32_t *off = emalloc((count ? count : 1) * sizeof(uint32_t));
+    uint32_t *len = emalloc((count ? count : 1) * sizeof(uint32_t));
+    *off_out = off;
+    *len_out = len;
+    for (uint32_t k = 0; k < count; k++) {
+        uint64_t n;
+        if (!quicpro_iibin_decode_varint(p, end, &n) || n > (uint64_t)(end - *p)) return 0;
+        off[k] = (uint32_t)(*p - base);
+        len[k] = (uint32_t)n;
+        *p += n;
+    }
+    return 1;
+}
+
+static int batch_parse_column(quicpro_iibin_batch_object *b, const quicpro_iibin_insn *insn, batch_column *c,
+                              const unsigned char *p, const unsigned char *end)
+{
+    const unsigned char *base = (const unsigned char *)ZSTR_VAL(b->buf);
+    uint32_t count = b->rows;
+
+    if (p >= end) return batch_malformed(b->schema, insn);
+    uint8_t presence = *p++;
+    if (presence == BATCH_PRESENT_BITMAP) {
+        size_t nbytes = ((size_t)b->rows + 7) / 8;
+        if (nbytes > (size_t)(end - p)) return batch_malformed(b->schema, insn);
+        c->slot = emalloc((b->rows ? b->rows : 1) * sizeof(uint32_t));
+        count = 0;
+        for (uint32_t r = 0; r < b->rows; r++) {
+            c->slot[r] = (p[r >> 3] >> (r & 7)) & 1 ? ++count : 0;
+        }
+        p += nbytes;
+        if (count < b->rows && (insn->flags & IIBIN_FIELD_FLAG_REQUIRED)) {
+            throw_iibin_error_as_php_exception(0, "Decoding error: Required field '%s' (tag %u) not found in every row of the batch for schema '%s'.", ZSTR_VAL(insn->name), insn->tag, b->schema->schema_name);
+            return FAILURE;
+        }
+    } else if (presence != BATCH_PRESENT_ALL) {
+        return batch_malformed(b->schema, insn);
+    }
+
+    if (p >= end) return batch_malformed(b->schema, insn);
+    c->encoding = *p++;
+    uint8_t expected = batch_encoding_of(insn);
+    if (c->encoding != expected && !(expected == BATCH_ENC_DICT && c->encoding == BATCH_ENC_PLAIN)) {
+        uint8_t got = c->encoding;
+        c->encoding = BATCH_ENC_NONE;
+        throw_iibin_error_as_php_exception(0, "Schema '%s': batch column for field '%s' (tag %u) has encoding %u, but the field's type needs %u.",
+            b->schema->schema_name, ZSTR_VAL(insn->name), insn->tag, got, expected);
+        return FAILURE;
+    }
+
+    switch (c->encoding) {
+        case BATCH_ENC_DELTA: {
+            if (count > (size_t)(end - p)) return batch_malformed(b->schema, insn);
+            c->v.ints = emalloc((count ? count : 1) * sizeof(zend_long));
+            uint64_t prev = 0;
+            for (uint32_t k = 0; k < count; k++) {
+                uint64_t delta;
+                if (!quicpro_iibin_decode_varint(&p, end, &delta)) return batch_malformed(b->schema, insn);
+                prev += (uint64_t)quicpro_iibin_zigzag_decode64(delta);
+                c->v.ints[k] = (zend_long)prev;
+            }
+            break;
+        }
+        case BATCH_ENC_BITS: {
+            size_t nbytes = ((size_t)count + 7) / 8;
+            if (nbytes > (size_t)(end - p)) return batch_malformed(b->schema, insn);
+            c->v.bits = p;
+            p += nbytes;
+            break;
+        }
+        case BATCH_ENC_FIXED32:
+        case BATCH_ENC_FIXED64: {
+            size_t width = c->encoding == BATCH_ENC_FIXED32 ? 4 : 8;
+            if ((size_t)(end - p) / width < count) return batch_malformed(b->schema, insn);
+            c->v.floats = emalloc((count ? count : 1) * sizeof(double));
+            for (uint32_t k = 0; k < count; k++, p += width) {
+                if (width == 4) {
+                    uint32_t bits = quicpro_iibin_load_fixed32(p);
+                    float f;
+                    memcpy(&f, &bits, sizeof(f));
+                    c->v.floats[k] = (double)f;
+                } else {
+                    uint64_t bits = quicpro_iibin_load_fixed64(p);
+                    memcpy(&c->v.floats[k], &bits, sizeof(double));
+                }
+            }
+            break;
+        }
+        case BATCH_ENC_DICT: {
+            uint64_t n;
+            if (!quicpro_iibin_decode_varint(&p, end, &n) || n > (uint64_t)(end - p) || (n == 0 && count)) {
+                return batch_malformed(b->schema, insn);
+            }
+            c->v.dict.strings = ecalloc(n ? n : 1, sizeof(zend_string *));
+            c->v.dict.len = (uint32_t)n;
+            for (uint32_t i = 0; i < n; i++) {
+                uint64_t len;
+                if (!quicpro_iibin_decode_varint(&p, end, &len) || len > (uint64_t)(end - p)) return batch_malformed(b->schema, insn);
+                c->v.dict.strings[i] = zend_string_init((const char *)p, (size_t)len, 0);
+                p += len;
+            }
+            if (count > (size_t)(end - p)) return batch_malformed(b->schema, insn);
+            c->v.dict.codes = emalloc((count ? count : 1) * sizeof(uint32_t));
+            for (uint32_t k = 0; k < count; k++) {
+                uint64_t code;
+                if (!quicpro_iibin_decode_varint(&p, end, &code) || code >= n) return batch_malformed(b->schema, insn);
+                c->v.dict.codes[k] = (uint32_t)code;
+            }
+            break;
+        }
+        default: /* PLAIN, WIRE; WIRE values are checked when their row is decoded */
+            if (!batch_read_spans(base, &p, end, count, &c->v.span.off, &c->v.span.len)) return batch_malformed(b->schema, insn);
+            break;
+    }
+    if (p != end) {
+        return batch_malformed(b->schema, insn);
+    }
+    return SUCCESS;
+}
+
+/* Header and every column; on FAILURE the columns parsed so far are freed with the object. */
+static int batch_parse(quicpro_iibin_batch_object *b)
+{
+    const quicpro_iibin_compiled_schema_internal *schema = b->schema;
+    const unsigned char *p = (const unsigned char *)ZSTR_VAL(b->buf);
+    const unsigned char *end = p + ZSTR_LEN(b->buf);
+    uint64_t rows, num_columns;
+
+    if (p >= end || *p != BATCH_VERSION) {
+        throw_iibin_error_as_php_exception(0, "Decoding error: not an IIBIN batch for schema '%s' (unknown version byte).", schema->schema_name);
+        return FAILURE;
+    }
+    p++;
+    if (!quicpro_iibin_decode_varint(&p, end, &rows) || !quicpro_iibin_decode_varint(&p, end, &num_columns) || rows >= UINT32_MAX) {
+        throw_iibin_error_as_php_exception(0, "Decoding error: malformed batch header for schema '%s'.", schema->schema_name);
+        return FAILURE;
+    }
+    b->rows = (uint32_t)rows;
+    b->columns = ecalloc(schema->num_fields ? schema->num_fields : 1, sizeof(batch_column));
+
+    for (uint64_t i = 0; i < num_columns; i++) {
+        uint64_t tag, len;
+        if (!quicpro_iibin_decode_varint(&p, end, &tag) || !quicpro_iibin_decode_varint(&p, end, &len) || len > (uint64_t)(end - p)) {
+            throw_iibin_error_as_php_exception(0, "Decoding error: truncated batch column in schema '%s'.", schema->schema_name);
+            return FAILURE;
+        }
+        const quicpro_iibin_insn *insn = tag && tag <= UINT32_MAX ? quicpro_iibin_insn_by_tag(schema, (uint32_t)tag) : NULL;
+        if (insn) {
+            batch_column *c = &b->columns[insn - schema->program];
+            if (c->encoding != BATCH_ENC_NONE) {
+                throw_iibin_error_as_php_exception(0, "Decoding error: batch column for field '%s' (tag %u) appears twice in schema '%s'.", ZSTR_VAL(insn->name), insn->tag, schema->schema_name);
+                return FAILURE;
+            }
+            if (batch_parse_column(b, insn, c, p, p + len) == FAILURE) {
+                return FAILURE;
+            }
+        }
+        p += len;
+    }
+    if (p != end) {
+        throw_iibin_error_as_php_exception(0, "Decoding warning: Not all bytes were consumed for the batch of schema '%s'. %zu bytes remain.", schema->schema_name, (size_t)(end - p));
+        return FAILURE;
+    }
+
+    for (size_t i = 0; i < schema->num_fields; i++) {
+        const quicpro_iibin_insn *insn = &schema->program[i];
+        if (b->rows && b->columns[i].encoding == BATCH_ENC_NONE && (insn->flags & IIBIN_FIELD_FLAG_REQUIRED)) {
+            throw_iibin_error_as_php_exception(0, "Decoding error: Required field '%s' (tag %u) not found in every row of the batch for schema '%s'.", ZSTR_VAL(insn->name), insn->tag, schema->schema_name);
+            return FAILURE;
+        }
+    }
+    return SUCCESS;
+}
+
+/*──────────────────────────── Rows ───────────────────────────────────────*/
+
+/*
+ * Stores row `row` of column `i` in `into`: the value, the field's
+ * default, or nothing. A WIRE value is decoded by the message decoder,
+ * which also appends repeated items.
+ */
+static int batch_cell(quicpro_iibin_batch_object *b, size_t i, uint32_t row, HashTable *into)
+{
+    const quicpro_iibin_insn *insn = &b->schema->program[i];
+    batch_column *c = &b->columns[i];
+    uint32_t k = row;
+    zval value;
+
+    if (c->encoding == BATCH_ENC_NONE || (c->slot && !c->slot[row])) {
+        if (Z_TYPE(insn->field->default_value_zval) != IS_UNDEF) {
+            ZVAL_COPY(&value, &insn->field->default_value_zval);
+            zend_hash_update(into, insn->name, &value);
+        }
+        return SUCCESS;
+    }
+    if (c->slot) {
+        k = c->slot[row] - 1;
+    }
+
+    switch (c->encoding) {
+        case BATCH_ENC_DELTA:
+            ZVAL_LONG(&value, c->v.ints[k]);
+            break;
+        case BATCH_ENC_BITS:
+            ZVAL_BOOL(&value, (c->v.bits[k >> 3] >> (k & 7)) & 1);
+            break;
+        case BATCH_ENC_FIXED32:
+        case BATCH_ENC_FIXED64:
+            ZVAL_DOUBLE(&value, c->v.floats[k]);
+            break;
+        case BATCH_ENC_DICT:
+            ZVAL_STR_COPY(&value, c->v.dict.strings[c->v.dict.codes[k]]);
+            break;
+        case BATCH_ENC_PLAIN:
+            ZVAL_STRINGL(&value, ZSTR_VAL(b->buf) + c->v.span.off[k], c->v.span.len[k]);
+            break;
+        default: {
+            const unsigned char *at = (const unsigned char *)ZSTR_VAL(b->buf) + c->v.span.off[k];
+            return quicpro_iibin_decode_field(at, at + c->v.span.len[k], b->schema, insn, into);
+        }
+    }
+    zend_hash_update(into, insn->name, &value);
+    return SUCCESS;
+}
+
+static int batch_row(quicpro_iibin_batch_object *b, uint32_t row, zval *out)
+{
+    array_init_size(out, (uint32_t)b->schema->num_fields);
+    for (size_t i = 0; i < b->schema->num_fields; i++) {
+        if (batch_cell(b, i, row, Z_ARRVAL_P(out)) == FAILURE) {
+            zval_ptr_dtor(out);
+            ZVAL_UNDEF(out);
+            return FAILURE;
+        }
+    }
+    return SUCCESS;
+}
+
+/* Row index of an ArrayAccess offset, or -1 if it names no row */
+static zend_long batch_offset(quicpro_iibin_batch_object *b, zval *offset)
+{
+    zend_long idx;
+    if (Z_TYPE_P(offset) == IS_LONG) {
+        idx = Z_LVAL_P(offset);
+    } else if (Z_TYPE_P(offset) != IS_STRING || !ZEND_HANDLE_NUMERIC_STR(Z_STRVAL_P(offset), Z_STRLEN_P(offset), idx)) {
+        return -1;
+    }
+    return idx >= 0 && idx < (zend_long)b->rows ? idx : -1;
+}
+
+/*──────────────────────────── Life cycle ─────────────────────────────────*/
+
+static zend_object *batch_create(zend_class_entry *ce)
+{
+    quicpro_iibin_batch_object *b = zend_object_alloc(sizeof(quicpro_iibin_batch_object), ce);
+    zend_object_std_init(&b->std, ce);
+    object_properties_init(&b->std, ce);
+    b->std.handlers = &quicpro_iibin_batch_handlers;
+
+    b->schema = NULL;
+    b->buf = NULL;
+    b->rows = 0;
+    b->pos = 0;
+    b->columns = NULL;
+    return &b->std;
+}
+
+static void batch_free_obj(zend_object *obj)
+{
+    quicpro_iibin_batch_object *b = batch_from_obj(obj);
+    if (b->columns) {
+        for (size_t i = 0; i < b->schema->num_fields; i++) {
+            batch_column_free(&b->columns[i]);
+        }
+        efree(b->columns);
+    }
+    if (b->buf) {
+        zend_string_release(b->buf);
+    }
+    zend_object_std_dtor(obj);
+}
+
+/* Batches start from IIBIN::decodeBatch() only; a bare `new` would have no schema */
+static int batch_ready(quicpro_iibin_batch_object *b)
+{
+    if (!b->schema) {
+        throw_iibin_error_as_php_exception(0, "Quicpro\\IIBIN\\Batch is created by IIBIN::decodeBatch().");
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+PHP_FUNCTION(quicpro_iibin_decode_batch)
+{
+    char *schema_name_str;
+    size_t schema_name_len;
+    zend_string *binary_data;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_STRING(schema_name_str, schema_name_len)
+        Z_PARAM_STR(binary_data)
+    ZEND_PARSE_PARAMETERS_END();
+
+    const quicpro_iibin_compiled_schema_internal *schema = get_compiled_iibin_schema_internal(schema_name_str);
+    if (!schema) {
+        throw_iibin_error_as_php_exception(0, "Schema '%s' not defined for decoding.", schema_name_str);
+        RETURN_THROWS();
+    }
+    if (ZSTR_LEN(binary_data) >= UINT32_MAX) {
+        zend_argument_value_error(2, "must be shorter than 4 GiB");
+        RETURN_THROWS();
+    }
+
+    object_init_ex(return_value, quicpro_ce_iibin_batch);
+    quicpro_iibin_batch_object *b = batch_from_obj(Z_OBJ_P(return_value));
+    b->schema = schema;
+    b->buf = zend_string_copy(binary_data);
+    if (batch_parse(b) == FAILURE) {
+        zval_ptr_dtor(return_value);
+        ZVAL_UNDEF(return_value);
+        RETURN_THROWS();
+    }
+}
+
+/*──────────────────────────── Methods ────────────────────────────────────*/
+
+PHP_METHOD(QuicproIIBINBatch, count)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_iibin_batch_object *b = THIS_BATCH();
+    if (batch_ready(b) == FAILURE) RETURN_THROWS();
+    RETURN_LONG(b->rows);
+}
+
+/* Every row of one field, null where a row has neither the field nor a default */
+PHP_METHOD(QuicproIIBINBatch, column)
+{
+    zend_string *name;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_iibin_batch_object *b = THIS_BATCH();
+    if (batch_ready(b) == FAILURE) RETURN_THROWS();
+    zval *field = zend_hash_find(&b->schema->fields_by_name, name);
+    if (!field) {
+        throw_iibin_error_as_php_exception(0, "Schema '%s' has no field '%s'.", b->schema->schema_name, ZSTR_VAL(name));
+        RETURN_THROWS();
+    }
+    const quicpro_iibin_insn *insn = quicpro_iibin_insn_by_tag(b->schema, ((const quicpro_iibin_field_def_internal *)Z_PTR_P(field))->tag);
+    size_t i = insn - b->schema->program;
+
+    HashTable cell;
+    zend_hash_init(&cell, 1, NULL, ZVAL_PTR_DTOR, 0);
+    array_init_size(return_value, b->rows);
+    for (uint32_t r = 0; r < b->rows; r++) {
+        if (batch_cell(b, i, r, &cell) == FAILURE) {
+            zend_hash_destroy(&cell);
+            zval_ptr_dtor(return_value);
+            RETURN_THROWS();
+        }
+        zval *value = zend_hash_find_known_hash(&cell, insn->name);
+        if (value) {
+            Z_TRY_ADDREF_P(value);
+            add_next_index_zval(return_value, value);
+        } else {
+            add_next_index_null(return_value);
+        }
+        zend_hash_clean(&cell);
+    }
+    zend_hash_destroy(&cell);
+}
+
+PHP_METHOD(QuicproIIBINBatch, toArray)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_iibin_batch_object *b = THIS_BATCH();
+    if (batch_ready(b) == FAILURE) RETURN_THROWS();
+
+    array_init_size(return_value, b->rows);
+    for (uint32_t r = 0; r < b->rows; r++) {
+        zval row;
+        if (batch_row(b, r, &row) == FAILURE) {
+            zval_ptr_dtor(return_value);
+            RETURN_THROWS();
+        }
+        add_next_index_zval(return_value, &row);
+    }
+}
+
+PHP_METHOD(QuicproIIBINBatch, schemaName)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_iibin_batch_object *b = THIS_BATCH();
+    if (batch_ready(b) == FAILURE) RETURN_THROWS();
+    RETURN_STRING(b->schema->schema_name);
+}
+
+/*──────────────────────────── ArrayAccess ────────────────────────────────*/
+
+PHP_METHOD(QuicproIIBINBatch, offsetExists)
+{
+    zval *offset;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ZVAL(offset)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_iibin_batch_object *b = THIS_BATCH();
+    if (batch_ready(b) == FAILURE) RETURN_THROWS();
+    RETURN_BOOL(batch_offset(b, offset) >= 0);
+}
+
+PHP_METHOD(QuicproIIBINBatch, offsetGet)
+{
+    zval *offset;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ZVAL(offset)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_iibin_batch_object *b = THIS_BATCH();
+    if (batch_ready(b) == FAILURE) RETURN_THROWS();
+    zend_long row = batch_offset(b, offset);
+    if (row < 0) {
+        throw_iibin_error_as_php_exception(0, "Batch of schema '%s' has no such row; it has %u rows.", b->schema->schema_name, b->rows);
+        RETURN_THROWS();
+    }
+    if (batch_row(b, (uint32_t)row, return_value) == FAILURE) RETURN_THROWS();
+}
+
+PHP_METHOD(QuicproIIBINBatch, offsetSet)
+{
+    zval *offset, *value;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_ZVAL(offset)
+        Z_PARAM_ZVAL(value)
+    ZEND_PARSE_PARAMETERS_END();
+
+    throw_iibin_error_as_php_exception(0, "Quicpro\\IIBIN\\Batch is read-only.");
+    RETURN_THROWS();
+}
+
+PHP_METHOD(QuicproIIBINBatch, offsetUnset)
+{
+    zval *offset;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ZVAL(offset)
+    ZEND_PARSE_PARAMETERS_END();
+
+    throw_iibin_error_as_php_exception(0, "Quicpro\\IIBIN\\Batch is read-only.");
+    RETURN_THROWS();
+}
+
+/*──────────────────────────── Iterator ───────────────────────────────────*/
+
+PHP_METHOD(QuicproIIBINBatch, current)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_iibin_batch_object *b = THIS_BATCH();
+    if (batch_ready(b) == FAILURE) RETURN_THROWS();
+    if (b->pos >= b->rows) {
+        RETURN_NULL();
+    }
+    if (batch_row(b, b->pos, return_value) == FAILURE) RETURN_THROWS();
+}
+
+PHP_METHOD(QuicproIIBINBatch, key)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_iibin_batch_object *b = THIS_BATCH();
+    if (b->pos >= b->rows) {
+        RETURN_NULL();
+    }
+    RETURN_LONG(b->pos);
+}
+
+PHP_METHOD(QuicproIIBINBatch, next)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_iibin_batch_object *b = THIS_BATCH();
+    if (b->pos < b->rows) {
+        b->pos++;
+    }
+}
+
+PHP_METHOD(QuicproIIBINBatch, rewind)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    THIS_BATCH()->pos = 0;
+}
+
+PHP_METHOD(QuicproIIBINBatch, valid)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_iibin_batch_object *b = THIS_BATCH();
+    RETURN_BOOL(b->pos < b->rows);
+}
+
+/*──────────────────────────── Registration ───────────────────────────────*/
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_batch_count, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_batch_column, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, field, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_batch_to_array, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_batch_schema_name, 0, 0, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_batch_offset_exists, 0, 1, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_batch_offset_get, 0, 1, IS_MIXED, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_batch_offset_set, 0, 2, IS_VOID, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+    ZEND_ARG_TYPE_INFO(0, value, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_batch_offset_unset, 0, 1, IS_VOID, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_batch_current, 0, 0, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_quicpro_iibin_batch_key arginfo_quicpro_iibin_batch_current
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_batch_next, 0, 0, IS_VOID, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_quicpro_iibin_batch_rewind arginfo_quicpro_iibin_batch_next
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_batch_valid, 0, 0, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry quicpro_iibin_batch_methods[] = {
+    PHP_ME(QuicproIIBINBatch, count,        arginfo_quicpro_iibin_batch_count,         ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINBatch, column,       arginfo_quicpro_iibin_batch_column,        ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINBatch, toArray,      arginfo_quicpro_iibin_batch_to_array,      ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINBatch, schemaName,   arginfo_quicpro_iibin_batch_schema_name,   ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINBatch, offsetExists, arginfo_quicpro_iibin_batch_offset_exists, ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINBatch, offsetGet,    arginfo_quicpro_iibin_batch_offset_get,    ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINBatch, offsetSet,    arginfo_quicpro_iibin_batch_offset_set,    ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINBatch, offsetUnset,  arginfo_quicpro_iibin_batch_offset_unset,  ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINBatch, current,      arginfo_quicpro_iibin_batch_current,       ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINBatch, key,          arginfo_quicpro_iibin_batch_key,           ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINBatch, next,         arginfo_quicpro_iibin_batch_next,          ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINBatch, rewind,       arginfo_quicpro_iibin_batch_rewind,        ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINBatch, valid,        arginfo_quicpro_iibin_batch_valid,         ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+void quicpro_iibin_batch_minit(void)
+{
+    zend_class_entry ce;
+    INIT_NS_CLASS_ENTRY(ce, "Quicpro\\IIBIN", "Batch", quicpro_iibin_batch_methods);
+    quicpro_ce_iibin_batch = zend_register_internal_class(&ce);
+    quicpro_ce_iibin_batch->ce_flags |= ZEND_ACC_FINAL;
+#ifdef ZEND_ACC_NO_DYNAMIC_PROPERTIES
+    quicpro_ce_iibin_batch->ce_flags |= ZEND_ACC_NO_DYNAMIC_PROPERTIES;
+#endif
+    quicpro_ce_iibin_batch->create_object = batch_create;
+    zend_class_implements(quicpro_ce_iibin_batch, 3, zend_ce_arrayaccess, zend_ce_countable, zend_ce_iterator);
+
+    memcpy(&quicpro_iibin_batch_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    quicpro_iibin_batch_handlers.offset = XtOffsetOf(quicpro_iibin_batch_object, std);
+    quicpro_iibin_batch_handlers.free_obj = batch_free_obj;
+    quicpro_iibin_batch_handlers.clone_obj = NULL;
+}
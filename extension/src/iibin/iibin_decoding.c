@@ -6,143 +6,340 @@
  * IIBIN (Intelligent Intern Binary) wire format string back into a PHP data structure
  * (associative array or stdClass object).
  * It uses the compiled schema definitions managed by iibin_schema.c.
+ *
+ * Decoding runs the schema's compiled program (iibin_program.c): fields are
+ * found by tag in a dense table and stored under precomputed name hashes.
  */
 
 #include "php_quicpro.h"
 #include "iibin.h"
 #include "iibin_internal.h"
 #include "cancel.h"
+#include "server/metrics.h"
+#include "server/profiler.h"
+#include "config/iibin/base_layer.h"
 
 #include <zend_API.h>
 #include <zend_exceptions.h>
 #include <zend_hash.h>
 #include <zend_string.h>
+#include <string.h>
 #include <Zend/zend_object_handlers.h>
 
 /* --- Static Helper Function Prototypes --- */
 static int decode_message_internal(const unsigned char **buf_ptr, const unsigned char *buf_end, const quicpro_iibin_compiled_schema_internal *schema, zval *return_zval, zend_bool decode_as_object);
 static int populate_default_values_and_check_required(const quicpro_iibin_compiled_schema_internal *schema, zval *decoded_message_zval);
 static zend_bool skip_field(const unsigned char **buf_ptr, const unsigned char *buf_end, uint32_t wire_type);
-static int decode_value_to_zval(const unsigned char **buf_ptr, const unsigned char *buf_end, const quicpro_iibin_field_def_internal *field, uint32_t wire_type, zval *out_zval, zend_bool decode_as_object);
+static int decode_value(const unsigned char **buf_ptr, const unsigned char *buf_end, const quicpro_iibin_insn *insn, zval *out_zval, zend_bool decode_as_object);
+static int decode_packed_run(const unsigned char **buf_ptr, const unsigned char *run_end, const quicpro_iibin_insn *insn, zval *list);
+
+
+/*
+ * Decoded messages are arrays or stdClass objects. A stdClass has no
+ * declared properties, so both are filled through their HashTable. The
+ * instruction's name is a permanent interned string with its hash, so
+ * stores cost neither a strlen, a hash nor a refcount.
+ */
+static inline HashTable *message_props(zval *message_zval) {
+    return Z_TYPE_P(message_zval) == IS_OBJECT ? Z_OBJPROP_P(message_zval) : Z_ARRVAL_P(message_zval);
+}
+
+static inline zval *repeated_slot(HashTable *props, const quicpro_iibin_insn *insn) {
+    zval *list = zend_hash_find_known_hash(props, insn->name);
+    if (!list || Z_TYPE_P(list) != IS_ARRAY) {
+        zval new_list;
+        array_init(&new_list);
+        list = zend_hash_update(props, insn->name, &new_list);
+    }
+    return list;
+}
+
+/*
+ * Strings up to this length are shared within one decode when
+ * quicpro.iibin_string_interning_enable is on. Short strings are where the
+ * repetition is (labels, states, keys); longer payloads rarely repeat and
+ * are not worth hashing and comparing.
+ */
+#define IIBIN_INTERN_MAX_LEN 32
 
+/* Slots of a decode's string cache: a power of two, 1 KiB of pointers */
+#define IIBIN_INTERN_SLOTS 128
+
+/*
+ * One decode's short strings by hash. A string whose slot holds another
+ * evicts it. The cache is dropped when the decode ends, so a hostile
+ * payload can make it miss but never grow it, and nothing is added to the
+ * request's interned string table.
+ */
+typedef struct {
+    zend_string *slot[IIBIN_INTERN_SLOTS];
+} iibin_intern_cache;
+
+/* The running decode's cache; NULL outside decode_message_top() */
+static ZEND_TLS iibin_intern_cache *iibin_intern;
+
+/*
+ * Empty and one-byte strings are the engine's own interned singletons
+ * either way. Other short ones go through the decode's cache, so a label
+ * repeated in every row of a reply is one string, hashed once. Longer
+ * payloads are copied once, straight into their zend_string; a
+ * zend_string cannot alias a slice of the input.
+ */
+static inline zend_string *decode_string(const unsigned char *p, size_t len) {
+    if (len <= 1) {
+        return len ? ZSTR_CHAR(*p) : ZSTR_EMPTY_ALLOC();
+    }
+    if (len > IIBIN_INTERN_MAX_LEN || !iibin_intern) {
+        return zend_string_init((const char *)p, len, 0);
+    }
+    zend_ulong h = zend_inline_hash_func((const char *)p, len);
+    zend_string **slot = &iibin_intern->slot[h & (IIBIN_INTERN_SLOTS - 1)];
+    if (*slot && ZSTR_H(*slot) == h && ZSTR_LEN(*slot) == len && memcmp(ZSTR_VAL(*slot), p, len) == 0) {
+        return zend_string_copy(*slot);
+    }
+    zend_string *str = zend_string_init((const char *)p, len, 0);
+    ZSTR_H(str) = h;
+    if (*slot) {
+        zend_string_release(*slot);
+    }
+    *slot = zend_string_copy(str);
+    return str;
+}
 
 /**
- * @brief Decodes a single value from the buffer based on its wire type and schema definition.
+ * @brief Decodes one value of a field from the buffer, as its instruction says.
  * @param buf_ptr Pointer to a pointer to the current position in the read buffer. Will be advanced.
  * @param buf_end Pointer to the end of the read buffer (for boundary checks).
- * @param field Pointer to the compiled field definition from the schema.
- * @param wire_type The wire type read from the buffer for this field.
+ * @param insn The field's compiled instruction.
  * @param out_zval A pointer to a zval that will be populated with the decoded PHP value.
  * @param decode_as_object If true, nested messages will be decoded as stdClass objects.
- * @return SUCCESS or FAILURE.
- *
- * This function handles the low-level conversion from binary wire format to a PHP zval.
+ * @return SUCCESS, or FAILURE for a truncated value (the caller reports it)
+ * or after throwing for a bad nested message.
  */
-static int decode_value_to_zval(
+static int decode_value(
     const unsigned char **buf_ptr, const unsigned char *buf_end,
-    const quicpro_iibin_field_def_internal *field,
-    uint32_t wire_type, zval *out_zval, zend_bool decode_as_object
+    const quicpro_iibin_insn *insn, zval *out_zval, zend_bool decode_as_object
 ) {
     uint64_t u64_val;
     uint32_t u32_val;
 
-    /*
-     * For unpacked repeated fields, the wire type in the buffer must match the schema's expected wire type.
-     * For packed repeated fields, this check is bypassed because the containing field is LENGTH_DELIM,
-     * but the individual items inside have their own primitive wire type. The caller handles this.
-     */
-    if (wire_type != field->wire_type && !(field->flags & IIBIN_FIELD_FLAG_PACKED)) {
-        throw_iibin_error_as_php_exception(0, "Schema '%s': Wire type mismatch for field '%s' (tag %u). Expected wire type %u, but got %u on the wire.",
-            field->message_type_name_if_nested ? field->message_type_name_if_nested : (field->enum_type_name_if_enum ? field->enum_type_name_if_enum : "Primitive"),
-            field->name_in_php, field->tag, field->wire_type, wire_type);
-        return FAILURE;
-    }
-
-    switch (field->type) {
-        case IIBIN_INTERNAL_TYPE_INT32:
-        case IIBIN_INTERNAL_TYPE_ENUM:
+    switch (insn->op) {
+        case IIBIN_OP_VARINT:
+            if (!quicpro_iibin_decode_varint(buf_ptr, buf_end, &u64_val)) return FAILURE;
+            ZVAL_LONG(out_zval, (zend_long)u64_val); /* Note: may truncate on 32-bit PHP for large uint64 */
+            return SUCCESS;
+        case IIBIN_OP_INT32:
+        case IIBIN_OP_ENUM:
             if (!quicpro_iibin_decode_varint(buf_ptr, buf_end, &u64_val)) return FAILURE;
             ZVAL_LONG(out_zval, (int32_t)u64_val);
-            break;
-        case IIBIN_INTERNAL_TYPE_SINT32:
+            return SUCCESS;
+        case IIBIN_OP_ZIGZAG32:
             if (!quicpro_iibin_decode_varint(buf_ptr, buf_end, &u64_val)) return FAILURE;
             ZVAL_LONG(out_zval, quicpro_iibin_zigzag_decode32((uint32_t)u64_val));
-            break;
-        case IIBIN_INTERNAL_TYPE_INT64:
-            if (!quicpro_iibin_decode_varint(buf_ptr, buf_end, &u64_val)) return FAILURE;
-            ZVAL_LONG(out_zval, (int64_t)u64_val);
-            break;
-        case IIBIN_INTERNAL_TYPE_SINT64:
+            return SUCCESS;
+        case IIBIN_OP_ZIGZAG64:
             if (!quicpro_iibin_decode_varint(buf_ptr, buf_end, &u64_val)) return FAILURE;
             ZVAL_LONG(out_zval, quicpro_iibin_zigzag_decode64(u64_val));
-            break;
-        case IIBIN_INTERNAL_TYPE_UINT32:
-        case IIBIN_INTERNAL_TYPE_UINT64:
-            if (!quicpro_iibin_decode_varint(buf_ptr, buf_end, &u64_val)) return FAILURE;
-            ZVAL_LONG(out_zval, (zend_long)u64_val); /* Note: may truncate on 32-bit PHP for large uint64 */
-            break;
-        case IIBIN_INTERNAL_TYPE_BOOL:
+            return SUCCESS;
+        case IIBIN_OP_BOOL:
             if (!quicpro_iibin_decode_varint(buf_ptr, buf_end, &u64_val)) return FAILURE;
             ZVAL_BOOL(out_zval, u64_val != 0);
-            break;
+            return SUCCESS;
 
-        case IIBIN_INTERNAL_TYPE_FLOAT:
+        case IIBIN_OP_FIXED32:
             if (!quicpro_iibin_decode_fixed32(buf_ptr, buf_end, &u32_val)) return FAILURE;
-            ZVAL_DOUBLE(out_zval, (double)(*((float*)&u32_val)));
-            break;
-        case IIBIN_INTERNAL_TYPE_FIXED32:
-        case IIBIN_INTERNAL_TYPE_SFIXED32:
+            ZVAL_LONG(out_zval, (zend_long)u32_val);
+            return SUCCESS;
+        case IIBIN_OP_SFIXED32:
             if (!quicpro_iibin_decode_fixed32(buf_ptr, buf_end, &u32_val)) return FAILURE;
-            ZVAL_LONG(out_zval, (field->type == IIBIN_INTERNAL_TYPE_FIXED32) ? (zend_long)u32_val : (int32_t)u32_val);
-            break;
-        case IIBIN_INTERNAL_TYPE_DOUBLE:
-            if (!quicpro_iibin_decode_fixed64(buf_ptr, buf_end, &u64_val)) return FAILURE;
-            ZVAL_DOUBLE(out_zval, *((double*)&u64_val));
-            break;
-        case IIBIN_INTERNAL_TYPE_FIXED64:
-        case IIBIN_INTERNAL_TYPE_SFIXED64:
+            ZVAL_LONG(out_zval, (int32_t)u32_val);
+            return SUCCESS;
+        case IIBIN_OP_FLOAT: {
+            float f_val;
+            if (!quicpro_iibin_decode_fixed32(buf_ptr, buf_end, &u32_val)) return FAILURE;
+            memcpy(&f_val, &u32_val, sizeof(f_val));
+            ZVAL_DOUBLE(out_zval, (double)f_val);
+            return SUCCESS;
+        }
+        case IIBIN_OP_FIXED64:
             if (!quicpro_iibin_decode_fixed64(buf_ptr, buf_end, &u64_val)) return FAILURE;
             ZVAL_LONG(out_zval, (zend_long)u64_val); /* Note: may truncate on 32-bit PHP */
-            break;
+            return SUCCESS;
+        case IIBIN_OP_DOUBLE: {
+            double d_val;
+            if (!quicpro_iibin_decode_fixed64(buf_ptr, buf_end, &u64_val)) return FAILURE;
+            memcpy(&d_val, &u64_val, sizeof(d_val));
+            ZVAL_DOUBLE(out_zval, d_val);
+            return SUCCESS;
+        }
 
-        case IIBIN_INTERNAL_TYPE_STRING:
-        case IIBIN_INTERNAL_TYPE_BYTES: {
+        case IIBIN_OP_BYTES: {
             uint64_t len;
             if (!quicpro_iibin_decode_varint(buf_ptr, buf_end, &len)) return FAILURE;
-            if (*buf_ptr + len > *buf_end) return FAILURE;
-            ZVAL_STRINGL(out_zval, (char*)*buf_ptr, len);
+            if (len > (uint64_t)(buf_end - *buf_ptr)) return FAILURE;
+            ZVAL_STR(out_zval, decode_string(*buf_ptr, (size_t)len));
             *buf_ptr += len;
-            break;
+            return SUCCESS;
         }
-        case IIBIN_INTERNAL_TYPE_MESSAGE: {
+        case IIBIN_OP_MESSAGE: {
             uint64_t len;
             if (!quicpro_iibin_decode_varint(buf_ptr, buf_end, &len)) return FAILURE;
-            if (*buf_ptr + len > *buf_end) return FAILURE;
+            if (len > (uint64_t)(buf_end - *buf_ptr)) return FAILURE;
 
             const unsigned char *nested_buf_end = *buf_ptr + len;
-            const quicpro_iibin_compiled_schema_internal *nested_schema = get_compiled_iibin_schema_internal(field->message_type_name_if_nested);
-            if (!nested_schema) {
-                throw_iibin_error_as_php_exception(0, "Decoding error: schema '%s' for nested field '%s' not defined.", field->message_type_name_if_nested, field->name_in_php);
-                return FAILURE;
-            }
-
             if (decode_as_object) {
                 object_init(out_zval);
             } else {
                 array_init(out_zval);
             }
-
-            const unsigned char *nested_buf_start = *buf_ptr;
-            if (decode_message_internal(&nested_buf_start, nested_buf_end, nested_schema, out_zval, decode_as_object) == FAILURE) {
+            if (decode_message_internal(buf_ptr, nested_buf_end, insn->nested, out_zval, decode_as_object) == FAILURE
+                || (insn->nested->has_defaults_or_required
+                    && populate_default_values_and_check_required(insn->nested, out_zval) == FAILURE)) {
                 zval_ptr_dtor(out_zval); /* Clean up partially created array/object */
                 return FAILURE;
             }
             *buf_ptr = nested_buf_end; /* Advance parent buffer by the full length of the nested message */
-            break;
+            return SUCCESS;
         }
+    }
+    return FAILURE;
+}
+
+static inline zend_long packed_varint_long(uint8_t op, uint64_t v) {
+    switch (op) {
+        case IIBIN_OP_INT32: case IIBIN_OP_ENUM: return (int32_t)v;
+        case IIBIN_OP_ZIGZAG32:                  return quicpro_iibin_zigzag_decode32((uint32_t)v);
+        case IIBIN_OP_ZIGZAG64:                  return quicpro_iibin_zigzag_decode64(v);
+        default:                                 return (zend_long)v;
+    }
+}
+
+/**
+ * @brief Decodes a packed run of primitives and appends the items to a list.
+ * @param buf_ptr Points at the first byte of the run; advanced to run_end on success.
+ * @param run_end End of the run, already checked against the buffer.
+ * @param insn The field's instruction.
+ * @param list The field's PHP array.
+ * @return SUCCESS, or FAILURE for a truncated or malformed run.
+ *
+ * The item count follows from the run length for fixed-width types, and
+ * from the number of bytes without a continuation bit for varints. The
+ * list grows once to its final size and the items are written straight
+ * into its packed storage. Runs of 16 one-byte varints, the common case
+ * for small integers and enums, are recognised with a single SIMD mask
+ * (iibin_wire.h).
+ */
+static int decode_packed_run(const unsigned char **buf_ptr, const unsigned char *run_end, const quicpro_iibin_insn *insn, zval *list) {
+    const unsigned char *p = *buf_ptr;
+    size_t run_len = (size_t)(run_end - p);
+    size_t count;
+
+    switch (insn->op) {
+        case IIBIN_OP_FIXED32: case IIBIN_OP_SFIXED32: case IIBIN_OP_FLOAT:
+            if (run_len % 4) return FAILURE;
+            count = run_len / 4;
+            break;
+        case IIBIN_OP_FIXED64: case IIBIN_OP_DOUBLE:
+            if (run_len % 8) return FAILURE;
+            count = run_len / 8;
+            break;
         default:
-            return FAILURE;
+            if (run_len && run_end[-1] >= 0x80) return FAILURE;
+            count = quicpro_iibin_count_varints(p, run_end);
+            break;
+    }
+    if (count == 0) {
+        return SUCCESS;
+    }
+
+    HashTable *ht = Z_ARRVAL_P(list);
+    if (HT_FLAGS(ht) & HASH_FLAG_UNINITIALIZED) {
+        zend_hash_real_init_packed(ht);
+    }
+    if (UNEXPECTED(!HT_IS_PACKED(ht) || !HT_IS_WITHOUT_HOLES(ht) || count > HT_MAX_SIZE - ht->nNumUsed)) {
+        /* A list this message already filled some other way; append item by item. */
+        zval value_zval;
+        while (p < run_end) {
+            if (decode_value(&p, run_end, insn, &value_zval, 0) == FAILURE) return FAILURE;
+            add_next_index_zval(list, &value_zval);
+        }
+        *buf_ptr = p;
+        return SUCCESS;
+    }
+    zend_hash_extend(ht, ht->nNumUsed + (uint32_t)count, 1);
+
+    zend_bool ok = 1;
+    ZEND_HASH_FILL_PACKED(ht) {
+        switch (insn->op) {
+            case IIBIN_OP_FIXED32:
+                for (; p < run_end; p += 4) {
+                    ZEND_HASH_FILL_SET_LONG((zend_long)quicpro_iibin_load_fixed32(p));
+                    ZEND_HASH_FILL_NEXT();
+                }
+                break;
+            case IIBIN_OP_SFIXED32:
+                for (; p < run_end; p += 4) {
+                    ZEND_HASH_FILL_SET_LONG((int32_t)quicpro_iibin_load_fixed32(p));
+                    ZEND_HASH_FILL_NEXT();
+                }
+                break;
+            case IIBIN_OP_FLOAT:
+                for (; p < run_end; p += 4) {
+                    uint32_t bits = quicpro_iibin_load_fixed32(p);
+                    float f_val;
+                    memcpy(&f_val, &bits, sizeof(f_val));
+                    ZEND_HASH_FILL_SET_DOUBLE((double)f_val);
+                    ZEND_HASH_FILL_NEXT();
+                }
+                break;
+            case IIBIN_OP_FIXED64:
+                for (; p < run_end; p += 8) {
+                    ZEND_HASH_FILL_SET_LONG((zend_long)quicpro_iibin_load_fixed64(p));
+                    ZEND_HASH_FILL_NEXT();
+                }
+                break;
+            case IIBIN_OP_DOUBLE:
+                for (; p < run_end; p += 8) {
+                    uint64_t bits = quicpro_iibin_load_fixed64(p);
+                    double d_val;
+                    memcpy(&d_val, &bits, sizeof(d_val));
+                    ZEND_HASH_FILL_SET_DOUBLE(d_val);
+                    ZEND_HASH_FILL_NEXT();
+                }
+                break;
+            case IIBIN_OP_BOOL:
+                while (p < run_end) {
+                    uint64_t v;
+                    zval bool_zval;
+                    if (!quicpro_iibin_decode_varint(&p, run_end, &v)) { ok = 0; break; }
+                    ZVAL_BOOL(&bool_zval, v != 0);
+                    ZEND_HASH_FILL_SET(&bool_zval);
+                    ZEND_HASH_FILL_NEXT();
+                }
+                break;
+            default:
+                while (p < run_end) {
+                    if (run_end - p >= 16 && quicpro_iibin_single_bytes16(p)) {
+                        for (int i = 0; i < 16; i++) {
+                            ZEND_HASH_FILL_SET_LONG(packed_varint_long(insn->op, p[i]));
+                            ZEND_HASH_FILL_NEXT();
+                        }
+                        p += 16;
+                        continue;
+                    }
+                    uint64_t v;
+                    if (!quicpro_iibin_decode_varint(&p, run_end, &v)) { ok = 0; break; }
+                    ZEND_HASH_FILL_SET_LONG(packed_varint_long(insn->op, v));
+                    ZEND_HASH_FILL_NEXT();
+                }
+                break;
+        }
+    } ZEND_HASH_FILL_END();
+
+    if (!ok) {
+        return FAILURE;
     }
+    *buf_ptr = p;
     return SUCCESS;
 }
 
@@ -162,16 +359,16 @@ static zend_bool skip_field(const unsigned char **buf_ptr, const unsigned char *
         case QUICPRO_IIBIN_WIRETYPE_VARINT:
             return quicpro_iibin_decode_varint(buf_ptr, buf_end, &len);
         case QUICPRO_IIBIN_WIRETYPE_FIXED64:
-            if (*buf_ptr + 8 > buf_end) return 0;
+            if (buf_end - *buf_ptr < 8) return 0;
             *buf_ptr += 8;
             return 1;
         case QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM:
             if (!quicpro_iibin_decode_varint(buf_ptr, buf_end, &len)) return 0;
-            if (*buf_ptr + len > buf_end) return 0;
+            if (len > (uint64_t)(buf_end - *buf_ptr)) return 0;
             *buf_ptr += len;
             return 1;
         case QUICPRO_IIBIN_WIRETYPE_FIXED32:
-            if (*buf_ptr + 4 > buf_end) return 0;
+            if (buf_end - *buf_ptr < 4) return 0;
             *buf_ptr += 4;
             return 1;
         default:
@@ -179,8 +376,76 @@ static zend_bool skip_field(const unsigned char **buf_ptr, const unsigned char *
     }
 }
 
+static int decode_truncated(const quicpro_iibin_compiled_schema_internal *schema, const quicpro_iibin_insn *insn) {
+    if (!EG(exception)) {
+        throw_iibin_error_as_php_exception(0, "Decoding error: truncated or malformed value for field '%s' (tag %u) in schema '%s'.",
+                                           ZSTR_VAL(insn->name), insn->tag, schema->schema_name);
+    }
+    return FAILURE;
+}
+
 /**
- * @brief Recursively decodes a full message from the buffer into a PHP zval.
+ * @brief Decodes one occurrence of a known field and stores it in a message's HashTable.
+ * @param buf_ptr Points just past the field's key; advanced past its value.
+ * @param buf_end End of the enclosing message.
+ * @param schema The schema of the enclosing message (for errors).
+ * @param insn The field's instruction.
+ * @param wire_type The wire type the key announced.
+ * @param props The message's properties: the value replaces a single field or is appended to a repeated one.
+ * @param decode_as_object Flag to indicate if nested messages should be objects.
+ * @return SUCCESS, or FAILURE after throwing.
+ */
+static int decode_occurrence(const unsigned char **buf_ptr, const unsigned char *buf_end, const quicpro_iibin_compiled_schema_internal *schema,
+                             const quicpro_iibin_insn *insn, uint32_t wire_type, HashTable *props, zend_bool decode_as_object) {
+    zval value_zval;
+
+    if (EXPECTED(wire_type == insn->wire_type)) {
+        /* Single value or one item of an unpacked repeated field */
+        if (decode_value(buf_ptr, buf_end, insn, &value_zval, decode_as_object) == FAILURE) {
+            return decode_truncated(schema, insn);
+        }
+        if (insn->flags & IIBIN_FIELD_FLAG_REPEATED) {
+            add_next_index_zval(repeated_slot(props, insn), &value_zval);
+        } else {
+            zend_hash_update(props, insn->name, &value_zval);
+        }
+        return SUCCESS;
+    }
+
+    if ((insn->flags & IIBIN_FIELD_FLAG_REPEATED) && wire_type == QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM
+        && insn->wire_type != QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM) {
+        /* Packed run of a repeated primitive: read length, then decode items until it ends */
+        uint64_t len;
+        if (!quicpro_iibin_decode_varint(buf_ptr, buf_end, &len) || len > (uint64_t)(buf_end - *buf_ptr)) {
+            throw_iibin_error_as_php_exception(0, "Decoding error: packed field length exceeds buffer size.");
+            return FAILURE;
+        }
+        if (decode_packed_run(buf_ptr, *buf_ptr + len, insn, repeated_slot(props, insn)) == FAILURE) {
+            return decode_truncated(schema, insn);
+        }
+        return SUCCESS;
+    }
+
+    throw_iibin_error_as_php_exception(0, "Schema '%s': Wire type mismatch for field '%s' (tag %u). Expected wire type %u, but got %u on the wire.",
+        schema->schema_name, ZSTR_VAL(insn->name), insn->tag, insn->wire_type, wire_type);
+    return FAILURE;
+}
+
+/* Reads one field key. Keys of tags 1-15 are one byte, which is nearly every key. */
+static inline zend_bool read_key(const unsigned char **buf_ptr, const unsigned char *buf_end, uint32_t *tag, uint32_t *wire_type) {
+    uint64_t key;
+    if (EXPECTED(**buf_ptr < 0x80)) {
+        key = *(*buf_ptr)++;
+    } else if (!quicpro_iibin_decode_varint(buf_ptr, buf_end, &key)) {
+        return 0;
+    }
+    *tag = (uint32_t)(key >> 3);
+    *wire_type = (uint32_t)(key & 0x7);
+    return 1;
+}
+
+/**
+ * @brief Decodes a full message from the buffer into a PHP zval by running its schema's program.
  * @param buf_ptr Pointer to a pointer to the current position in the read buffer.
  * @param buf_end Pointer to the end of the read buffer for the current message.
  * @param schema The compiled schema for the message being decoded.
@@ -188,113 +453,146 @@ static zend_bool skip_field(const unsigned char **buf_ptr, const unsigned char *
  * @param decode_as_object Flag to indicate if nested messages should be objects.
  * @return SUCCESS or FAILURE.
  *
- * This is the core decoding loop. It reads field tags, looks up field definitions,
- * and dispatches to value decoders or handles repeated/packed fields.
+ * This is the core decoding loop. It reads field keys, finds the field's
+ * instruction by tag and decodes single, unpacked repeated or packed values.
  */
 static int decode_message_internal(const unsigned char **buf_ptr, const unsigned char *buf_end, const quicpro_iibin_compiled_schema_internal *schema, zval *return_zval, zend_bool decode_as_object) {
+    HashTable *props = message_props(return_zval);
+
     while (*buf_ptr < buf_end) {
-        uint64_t key;
-        if (!quicpro_iibin_decode_varint(buf_ptr, buf_end, &key)) {
+        uint32_t tag, wire_type;
+        if (!read_key(buf_ptr, buf_end, &tag, &wire_type)) {
             throw_iibin_error_as_php_exception(0, "Decoding error: malformed tag/wire_type varint in schema '%s'.", schema->schema_name);
             return FAILURE;
         }
-
-        uint32_t tag = (uint32_t)(key >> 3);
-        uint32_t wire_type = (uint32_t)(key & 0x7);
         if (tag == 0) continue;
 
-        quicpro_iibin_field_def_internal *field = zend_hash_index_find_ptr(&schema->fields_by_tag, tag);
-
-        if (!field) {
+        const quicpro_iibin_insn *insn = quicpro_iibin_insn_by_tag(schema, tag);
+        if (!insn) {
             if (!skip_field(buf_ptr, buf_end, wire_type)) {
                 throw_iibin_error_as_php_exception(0, "Decoding error: failed to skip unknown field with tag %u in schema '%s'.", tag, schema->schema_name);
                 return FAILURE;
             }
             continue;
         }
+        if (decode_occurrence(buf_ptr, buf_end, schema, insn, wire_type, props, decode_as_object) == FAILURE) {
+            return FAILURE;
+        }
+    }
+    return SUCCESS;
+}
 
-        zval value_zval;
-        ZVAL_UNDEF(&value_zval);
-
-        if ((field->flags & IIBIN_FIELD_FLAG_PACKED) && wire_type == QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM) {
-            /* Packed repeated field: read length, then loop decode items */
-            uint64_t len;
-            if (!quicpro_iibin_decode_varint(buf_ptr, buf_end, &len)) return FAILURE;
-            if (*buf_ptr + len > buf_end) { throw_iibin_error_as_php_exception(0, "Decoding error: packed field length exceeds buffer size."); return FAILURE; }
-
-            const unsigned char *packed_end = *buf_ptr + len;
-            zval *sub_array = zend_hash_str_find(Z_ARRVAL_P(return_zval), field->name_in_php, strlen(field->name_in_php));
-            if (!sub_array) {
-                zval new_array;
-                array_init(&new_array);
-                sub_array = zend_hash_str_update(Z_ARRVAL_P(return_zval), field->name_in_php, strlen(field->name_in_php), &new_array);
-            }
-
-            while (*buf_ptr < packed_end) {
-                zval item_val;
-                if (decode_value_to_zval(buf_ptr, packed_end, field, field->wire_type, &item_val, decode_as_object) == FAILURE) return FAILURE;
-                add_next_index_zval(sub_array, &item_val);
-            }
-        } else {
-            /* Single value or unpacked repeated value */
-            if (decode_value_to_zval(buf_ptr, buf_end, field, wire_type, &value_zval, decode_as_object) == FAILURE) return FAILURE;
-
-            if (field->flags & IIBIN_FIELD_FLAG_REPEATED) {
-                zval *sub_array = zend_hash_str_find(is_object ? Z_OBJPROP_P(return_zval) : Z_ARRVAL_P(return_zval), field->name_in_php, strlen(field->name_in_php));
-                if (!sub_array) {
-                    zval new_array;
-                    array_init(&new_array);
-                    add_next_index_zval(&new_array, &value_zval);
-                    if (is_object) zend_update_property(Z_OBJCE_P(return_zval), Z_OBJ_P(return_zval), field->name_in_php, strlen(field->name_in_php), &new_array);
-                    else zend_hash_str_update(Z_ARRVAL_P(return_zval), field->name_in_php, strlen(field->name_in_php), &new_array);
-                    zval_ptr_dtor(&new_array);
-                } else {
-                    add_next_index_zval(sub_array, &value_zval);
-                }
-            } else {
-                if (is_object) zend_update_property(Z_OBJCE_P(return_zval), Z_OBJ_P(return_zval), field->name_in_php, strlen(field->name_in_php), &value_zval);
-                else add_assoc_zval_ex(return_zval, field->name_in_php, strlen(field->name_in_php), &value_zval);
-                zval_ptr_dtor(&value_zval);
+int quicpro_iibin_decode_field(const unsigned char *buf, const unsigned char *buf_end, const quicpro_iibin_compiled_schema_internal *schema,
+                               const quicpro_iibin_insn *insn, HashTable *into) {
+    while (buf < buf_end) {
+        uint32_t tag, wire_type;
+        if (!read_key(&buf, buf_end, &tag, &wire_type)) {
+            throw_iibin_error_as_php_exception(0, "Decoding error: malformed tag/wire_type varint in schema '%s'.", schema->schema_name);
+            return FAILURE;
+        }
+        if (tag != insn->tag) {
+            if (!skip_field(&buf, buf_end, wire_type)) {
+                throw_iibin_error_as_php_exception(0, "Decoding error: failed to skip field with tag %u in schema '%s'.", tag, schema->schema_name);
+                return FAILURE;
             }
+            continue;
+        }
+        if (decode_occurrence(&buf, buf_end, schema, insn, wire_type, into, 0) == FAILURE) {
+            return FAILURE;
         }
     }
     return SUCCESS;
 }
 
+zend_bool quicpro_iibin_skip_field(const unsigned char **buf_ptr, const unsigned char *buf_end, uint32_t wire_type) {
+    return skip_field(buf_ptr, buf_end, wire_type);
+}
+
 /**
  * @brief Post-decoding step to populate defaults and check required fields.
  * @param schema The compiled schema for the message.
  * @param decoded_message_zval The PHP zval (array or object) to process.
  * @return SUCCESS or FAILURE.
+ *
+ * Only called for schemas that have a required field or a default
+ * (`has_defaults_or_required`).
  */
 static int populate_default_values_and_check_required(const quicpro_iibin_compiled_schema_internal *schema, zval *decoded_message_zval) {
-    zend_bool is_object = (Z_TYPE_P(decoded_message_zval) == IS_OBJECT);
+    HashTable *props = message_props(decoded_message_zval);
 
     for (size_t i = 0; i < schema->num_fields; ++i) {
-        quicpro_iibin_field_def_internal *field = schema->ordered_fields[i];
-        zend_bool field_is_present = is_object ?
-            zend_hash_str_exists(Z_OBJPROP_P(decoded_message_zval), field->name_in_php, strlen(field->name_in_php)) :
-            zend_hash_str_exists(Z_ARRVAL_P(decoded_message_zval), field->name_in_php, strlen(field->name_in_php));
-
-        if (!field_is_present) {
-            if (field->flags & IIBIN_FIELD_FLAG_REQUIRED) {
-                throw_iibin_error_as_php_exception(0, "Decoding error: Required field '%s' (tag %u) not found in payload for schema '%s'.", field->name_in_php, field->tag, schema->schema_name);
-                return FAILURE;
-            }
-            if (Z_TYPE(field->default_value_zval) != IS_UNDEF) {
-                if (is_object) {
-                    zend_update_property(Z_OBJCE_P(decoded_message_zval), Z_OBJ_P(decoded_message_zval), field->name_in_php, strlen(field->name_in_php), &field->default_value_zval);
-                } else {
-                    zend_hash_str_update(Z_ARRVAL_P(decoded_message_zval), field->name_in_php, strlen(field->name_in_php), &field->default_value_zval);
-                    /* zend_hash_str_update copies the zval, so we must increment refcount. */
-                    Z_TRY_ADDREF(field->default_value_zval);
-                }
+        const quicpro_iibin_insn *insn = &schema->program[i];
+        if (zend_hash_find_known_hash(props, insn->name)) {
+            continue;
+        }
+        if (insn->flags & IIBIN_FIELD_FLAG_REQUIRED) {
+            throw_iibin_error_as_php_exception(0, "Decoding error: Required field '%s' (tag %u) not found in payload for schema '%s'.", ZSTR_VAL(insn->name), insn->tag, schema->schema_name);
+            return FAILURE;
+        }
+        if (Z_TYPE(insn->field->default_value_zval) != IS_UNDEF) {
+            zval default_copy;
+            ZVAL_COPY(&default_copy, &insn->field->default_value_zval);
+            zend_hash_update(props, insn->name, &default_copy);
+        }
+    }
+    return SUCCESS;
+}
+
+
+/* What IIBIN::decode() does once the schema is known. */
+static int decode_message_top(const unsigned char *buf, size_t len, const quicpro_iibin_compiled_schema_internal *schema,
+                              zval *out, zend_bool decode_as_object) {
+    if (decode_as_object) {
+        object_init(out);
+    } else {
+        array_init(out);
+    }
+
+    const unsigned char *buf_ptr = buf;
+    const unsigned char *buf_end = buf + len;
+
+    iibin_intern_cache cache, *outer = iibin_intern;
+    if (quicpro_iibin_config.string_interning_enable) {
+        memset(&cache, 0, sizeof(cache));
+        iibin_intern = &cache;
+    }
+    int rc = decode_message_internal(&buf_ptr, buf_end, schema, out, decode_as_object);
+    if (iibin_intern == &cache) {
+        for (size_t i = 0; i < IIBIN_INTERN_SLOTS; i++) {
+            if (cache.slot[i]) {
+                zend_string_release(cache.slot[i]);
             }
         }
+        iibin_intern = outer;
+    }
+
+    if (rc == FAILURE) {
+        zval_ptr_dtor(out);
+        ZVAL_UNDEF(out);
+        return FAILURE; /* Exception already thrown */
     }
+
+    if (buf_ptr != buf_end) {
+        throw_iibin_error_as_php_exception(0, "Decoding warning: Not all bytes were consumed for schema '%s'. %zu bytes remain.", schema->schema_name, (size_t)(buf_end - buf_ptr));
+    }
+
+    if (schema->has_defaults_or_required && populate_default_values_and_check_required(schema, out) == FAILURE) {
+        zval_ptr_dtor(out);
+        ZVAL_UNDEF(out);
+        return FAILURE; /* Exception already thrown */
+    }
+    quicpro_metrics_add(QUICPRO_METRIC_IIBIN_DECODED_BYTES, len);
     return SUCCESS;
 }
 
+int quicpro_iibin_decode_message(const unsigned char *buf, size_t len, const quicpro_iibin_compiled_schema_internal *schema,
+                                 zval *out, zend_bool decode_as_object) {
+    uint64_t prof = quicpro_prof_begin();
+    int rc = decode_message_top(buf, len, schema, out, decode_as_object);
+    quicpro_prof_end(QUICPRO_PROF_IIBIN_DECODE, prof);
+    return rc;
+}
+
 
 /* --- PHP_FUNCTION Implementation --- */
 
@@ -305,40 +603,32 @@ PHP_FUNCTION(quicpro_iibin_decode)
     char *binary_data_str;
     size_t binary_data_len;
     zend_bool decode_as_object = 0;
+    zend_bool arena = 0;
 
-    ZEND_PARSE_PARAMETERS_START(2, 3)
+    ZEND_PARSE_PARAMETERS_START(2, 4)
         Z_PARAM_STRING(schema_name_str, schema_name_len)
         Z_PARAM_STRING(binary_data_str, binary_data_len)
         Z_PARAM_OPTIONAL
         Z_PARAM_BOOL(decode_as_object)
+        Z_PARAM_BOOL(arena)
     ZEND_PARSE_PARAMETERS_END();
 
+    if (arena && decode_as_object) {
+        throw_iibin_error_as_php_exception(0, "Arena decoding returns arrays; it cannot be combined with decodeAsObject.");
+        RETURN_FALSE;
+    }
+
     const quicpro_iibin_compiled_schema_internal *schema = get_compiled_iibin_schema_internal(schema_name_str);
     if (!schema) {
         throw_iibin_error_as_php_exception(0, "Schema '%s' not defined for decoding.", schema_name_str);
         RETURN_FALSE;
     }
 
-    if (decode_as_object) {
-        object_init(return_value);
-    } else {
-        array_init(return_value);
-    }
-
-    const unsigned char *buf_ptr = (const unsigned char *)binary_data_str;
-    const unsigned char *buf_end = buf_ptr + binary_data_len;
-
-    if (decode_message_internal(&buf_ptr, buf_end, schema, return_value, decode_as_object) == FAILURE) {
-        zval_ptr_dtor(return_value);
-        RETURN_FALSE; /* Exception already thrown */
-    }
-
-    if (buf_ptr != buf_end) {
-        throw_iibin_error_as_php_exception(0, "Decoding warning: Not all bytes were consumed for schema '%s'. %zu bytes remain.", schema->schema_name, (size_t)(buf_end - buf_ptr));
+    if (quicpro_iibin_decode_message((const unsigned char *)binary_data_str, binary_data_len, schema, return_value, decode_as_object) == FAILURE) {
+        RETURN_FALSE;
     }
-
-    if (populate_default_values_and_check_required(schema, return_value) == FAILURE) {
-         zval_ptr_dtor(return_value);
-         RETURN_FALSE; /* Exception already thrown */
+    if (arena) {
+        /* Past quicpro.iibin_arena_max_mb the ordinary array is returned */
+        quicpro_iibin_arena_freeze(return_value);
     }
 }
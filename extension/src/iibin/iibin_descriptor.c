@@ -0,0 +1,469 @@
+/*
+ * src/iibin_descriptor.c – IIBIN schema descriptors and IDs
+ * =========================================================
+ *
+ * Writes the descriptor of a schema when it is defined and derives its ID
+ * from it; rebuilds definitions from a peer's descriptor through the same
+ * code paths IIBIN::defineSchema() and IIBIN::defineEnum() use, so a
+ * descriptor can never define anything those would refuse. See
+ * iibin_descriptor.h for the format.
+ */
+
+#include "php_quicpro.h"
+#include "iibin.h"
+#include "iibin_internal.h"
+#include "iibin_descriptor.h"
+#include "cancel.h"
+
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+#include <string.h>
+
+#define DESC_VERSION 1
+
+#define DESC_KIND_ENUM   'E'
+#define DESC_KIND_SCHEMA 'S'
+
+#define DESC_FLAG_REQUIRED   0x01
+#define DESC_FLAG_REPEATED   0x02
+#define DESC_FLAG_PACKED     0x04
+#define DESC_FLAG_DEPRECATED 0x08
+
+#define DESC_DEFAULT_NONE   0
+#define DESC_DEFAULT_NULL   1
+#define DESC_DEFAULT_FALSE  2
+#define DESC_DEFAULT_TRUE   3
+#define DESC_DEFAULT_LONG   4
+#define DESC_DEFAULT_DOUBLE 5
+#define DESC_DEFAULT_STRING 6
+
+/* Type names as IIBIN::defineSchema() takes them; messages and enums use their ref. */
+static const char *const desc_type_names[] = {
+    NULL, "double", "float", "int64", "uint64", "int32", "uint32", "sint32", "sint64",
+    "fixed64", "sfixed64", "fixed32", "sfixed32", "bool", "string", "bytes",
+};
+
+static uint32_t desc_fingerprint(const unsigned char *buf, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= buf[i];
+        h *= 16777619u;
+    }
+    return h ? h : 1;   /* 0 means "no schema" to the registry and MCP */
+}
+
+
+/*──── Writing ────*/
+
+typedef struct {
+    smart_str body;
+    HashTable seen;     /* Names already written */
+    uint32_t  count;
+} desc_writer;
+
+static void desc_put_str(smart_str *out, const char *s, size_t len)
+{
+    quicpro_iibin_encode_varint(out, len);
+    smart_str_appendl(out, s, len);
+}
+
+static int desc_cmp_enum_values(const void *a, const void *b)
+{
+    int32_t na = (*(const quicpro_iibin_enum_value_def_internal **)a)->number;
+    int32_t nb = (*(const quicpro_iibin_enum_value_def_internal **)b)->number;
+    return (na > nb) - (na < nb);
+}
+
+static void desc_write_enum(desc_writer *w, const quicpro_iibin_compiled_enum_internal *enum_def)
+{
+    if (!zend_hash_str_add_empty_element(&w->seen, enum_def->enum_name, strlen(enum_def->enum_name))) {
+        return;
+    }
+    uint32_t n = zend_hash_num_elements(&enum_def->values_by_name), i = 0;
+    const quicpro_iibin_enum_value_def_internal **values = n ? emalloc(n * sizeof(*values)) : NULL;
+    quicpro_iibin_enum_value_def_internal *val_def;
+    ZEND_HASH_FOREACH_PTR(&enum_def->values_by_name, val_def) {
+        values[i++] = val_def;
+    } ZEND_HASH_FOREACH_END();
+    if (n > 1) {
+        qsort(values, n, sizeof(*values), desc_cmp_enum_values);
+    }
+
+    smart_str_appendc(&w->body, DESC_KIND_ENUM);
+    desc_put_str(&w->body, enum_def->enum_name, strlen(enum_def->enum_name));
+    quicpro_iibin_encode_varint(&w->body, n);
+    for (i = 0; i < n; i++) {
+        desc_put_str(&w->body, values[i]->name, strlen(values[i]->name));
+        quicpro_iibin_encode_varint(&w->body, quicpro_iibin_zigzag_encode32(values[i]->number));
+    }
+    if (values) {
+        efree(values);
+    }
+    w->count++;
+}
+
+static void desc_write_default(smart_str *out, const zval *dv)
+{
+    switch (Z_TYPE_P(dv)) {
+        case IS_NULL:  smart_str_appendc(out, DESC_DEFAULT_NULL);  break;
+        case IS_FALSE: smart_str_appendc(out, DESC_DEFAULT_FALSE); break;
+        case IS_TRUE:  smart_str_appendc(out, DESC_DEFAULT_TRUE);  break;
+        case IS_LONG:
+            smart_str_appendc(out, DESC_DEFAULT_LONG);
+            quicpro_iibin_encode_varint(out, quicpro_iibin_zigzag_encode64((int64_t)Z_LVAL_P(dv)));
+            break;
+        case IS_DOUBLE: {
+            double d = Z_DVAL_P(dv);
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            smart_str_appendc(out, DESC_DEFAULT_DOUBLE);
+            quicpro_iibin_encode_fixed64(out, bits);
+            break;
+        }
+        case IS_STRING:
+            smart_str_appendc(out, DESC_DEFAULT_STRING);
+            desc_put_str(out, Z_STRVAL_P(dv), Z_STRLEN_P(dv));
+            break;
+        default:        /* IS_UNDEF: no default */
+            smart_str_appendc(out, DESC_DEFAULT_NONE);
+            break;
+    }
+}
+
+/* Dependencies first, so a reader can define the entries in order. */
+static void desc_write_schema(desc_writer *w, const quicpro_iibin_compiled_schema_internal *schema)
+{
+    if (!zend_hash_str_add_empty_element(&w->seen, schema->schema_name, strlen(schema->schema_name))) {
+        return;
+    }
+    for (size_t i = 0; i < schema->num_fields; i++) {
+        const quicpro_iibin_insn *insn = &schema->program[i];
+        if (insn->nested) {
+            desc_write_schema(w, insn->nested);
+        } else if (insn->enum_def) {
+            desc_write_enum(w, insn->enum_def);
+        }
+    }
+
+    smart_str_appendc(&w->body, DESC_KIND_SCHEMA);
+    desc_put_str(&w->body, schema->schema_name, strlen(schema->schema_name));
+    quicpro_iibin_encode_varint(&w->body, schema->num_fields);
+    for (size_t i = 0; i < schema->num_fields; i++) {
+        const quicpro_iibin_field_def_internal *field = schema->ordered_fields[i];
+        const char *ref = field->type == IIBIN_INTERNAL_TYPE_MESSAGE ? field->message_type_name_if_nested
+                        : field->type == IIBIN_INTERNAL_TYPE_ENUM ? field->enum_type_name_if_enum : NULL;
+        uint8_t flags = ((field->flags & IIBIN_FIELD_FLAG_REQUIRED) ? DESC_FLAG_REQUIRED : 0)
+                      | ((field->flags & IIBIN_FIELD_FLAG_REPEATED) ? DESC_FLAG_REPEATED : 0)
+                      | ((field->flags & IIBIN_FIELD_FLAG_PACKED) ? DESC_FLAG_PACKED : 0)
+                      | (field->is_deprecated ? DESC_FLAG_DEPRECATED : 0);
+
+        quicpro_iibin_encode_varint(&w->body, field->tag);
+        smart_str_appendc(&w->body, (char)field->type);
+        smart_str_appendc(&w->body, (char)flags);
+        desc_put_str(&w->body, field->name_in_php, strlen(field->name_in_php));
+        desc_put_str(&w->body, ref ? ref : "", ref ? strlen(ref) : 0);
+        desc_put_str(&w->body, field->json_name ? field->json_name : "", field->json_name ? strlen(field->json_name) : 0);
+        desc_write_default(&w->body, &field->default_value_zval);
+    }
+    w->count++;
+}
+
+int quicpro_iibin_describe_schema(quicpro_iibin_compiled_schema_internal *schema)
+{
+    desc_writer w;
+    memset(&w, 0, sizeof(w));
+    zend_hash_init(&w.seen, 8, NULL, NULL, 0);
+    desc_write_schema(&w, schema);
+    zend_hash_destroy(&w.seen);
+
+    smart_str out = {0};
+    smart_str_appendc(&out, 'I');
+    smart_str_appendc(&out, 'D');
+    smart_str_appendc(&out, DESC_VERSION);
+    quicpro_iibin_encode_varint(&out, w.count);
+    smart_str_append(&out, w.body.s);
+    smart_str_free(&w.body);
+
+    schema->descriptor_len = ZSTR_LEN(out.s);
+    schema->descriptor = pemalloc(schema->descriptor_len, 1);
+    memcpy(schema->descriptor, ZSTR_VAL(out.s), schema->descriptor_len);
+    schema->fingerprint = desc_fingerprint((const unsigned char *)schema->descriptor, schema->descriptor_len);
+    smart_str_free(&out);
+    return SUCCESS;
+}
+
+
+/*──── Reading ────*/
+
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+} desc_reader;
+
+static zend_bool desc_get_varint(desc_reader *r, uint64_t *v)
+{
+    return quicpro_iibin_decode_varint(&r->p, r->end, v);
+}
+
+static zend_bool desc_get_byte(desc_reader *r, uint8_t *b)
+{
+    if (r->p >= r->end) {
+        return 0;
+    }
+    *b = *r->p++;
+    return 1;
+}
+
+static zend_bool desc_get_str(desc_reader *r, const char **s, size_t *len)
+{
+    uint64_t n;
+    if (!desc_get_varint(r, &n) || n > (uint64_t)(r->end - r->p)) {
+        return 0;
+    }
+    *s = (const char *)r->p;
+    *len = (size_t)n;
+    r->p += n;
+    return 1;
+}
+
+/* An enum body as the array IIBIN::defineEnum() takes. */
+static zend_bool desc_read_enum(desc_reader *r, zval *values)
+{
+    uint64_t n, number;
+    const char *name;
+    size_t name_len;
+    if (!desc_get_varint(r, &n)) {
+        return 0;
+    }
+    array_init(values);
+    for (uint64_t i = 0; i < n; i++) {
+        if (!desc_get_str(r, &name, &name_len) || !desc_get_varint(r, &number) || number > UINT32_MAX) {
+            return 0;
+        }
+        add_assoc_long_ex(values, name, name_len, quicpro_iibin_zigzag_decode32((uint32_t)number));
+    }
+    return 1;
+}
+
+static zend_bool desc_read_default(desc_reader *r, zval *opts)
+{
+    uint8_t kind;
+    uint64_t v;
+    if (!desc_get_byte(r, &kind)) {
+        return 0;
+    }
+    switch (kind) {
+        case DESC_DEFAULT_NONE:  return 1;
+        case DESC_DEFAULT_NULL:  add_assoc_null(opts, "default"); return 1;
+        case DESC_DEFAULT_FALSE: add_assoc_bool(opts, "default", 0); return 1;
+        case DESC_DEFAULT_TRUE:  add_assoc_bool(opts, "default", 1); return 1;
+        case DESC_DEFAULT_LONG:
+            if (!desc_get_varint(r, &v)) {
+                return 0;
+            }
+            add_assoc_long(opts, "default", (zend_long)quicpro_iibin_zigzag_decode64(v));
+            return 1;
+        case DESC_DEFAULT_DOUBLE: {
+            double d;
+            if (!quicpro_iibin_decode_fixed64(&r->p, r->end, &v)) {
+                return 0;
+            }
+            memcpy(&d, &v, sizeof(d));
+            add_assoc_double(opts, "default", d);
+            return 1;
+        }
+        case DESC_DEFAULT_STRING: {
+            const char *s;
+            size_t len;
+            if (!desc_get_str(r, &s, &len)) {
+                return 0;
+            }
+            add_assoc_stringl(opts, "default", s, len);
+            return 1;
+        }
+        default:
+            return 0;
+    }
+}
+
+/* A schema body as the array IIBIN::defineSchema() takes. */
+static zend_bool desc_read_schema(desc_reader *r, zval *fields)
+{
+    uint64_t n, tag;
+    if (!desc_get_varint(r, &n)) {
+        return 0;
+    }
+    array_init(fields);
+    for (uint64_t i = 0; i < n; i++) {
+        uint8_t type, flags;
+        const char *name, *ref, *json_name;
+        size_t name_len, ref_len, json_name_len;
+        if (!desc_get_varint(r, &tag) || tag == 0 || tag > UINT32_MAX
+            || !desc_get_byte(r, &type) || !desc_get_byte(r, &flags)
+            || !desc_get_str(r, &name, &name_len) || !desc_get_str(r, &ref, &ref_len)
+            || !desc_get_str(r, &json_name, &json_name_len)) {
+            return 0;
+        }
+
+        smart_str type_str = {0};
+        if (flags & DESC_FLAG_REPEATED) {
+            smart_str_appends(&type_str, "repeated_");
+        }
+        if (type == IIBIN_INTERNAL_TYPE_MESSAGE || type == IIBIN_INTERNAL_TYPE_ENUM) {
+            if (ref_len == 0) {
+                smart_str_free(&type_str);
+                return 0;
+            }
+            smart_str_appendl(&type_str, ref, ref_len);
+        } else if (type > IIBIN_INTERNAL_TYPE_UNKNOWN && type < IIBIN_INTERNAL_TYPE_MESSAGE) {
+            smart_str_appends(&type_str, desc_type_names[type]);
+        } else {
+            smart_str_free(&type_str);
+            return 0;
+        }
+        smart_str_0(&type_str);
+
+        zval opts;
+        array_init(&opts);
+        add_assoc_long(&opts, "tag", (zend_long)tag);
+        add_assoc_str(&opts, "type", type_str.s);
+        add_assoc_bool(&opts, "required", (flags & DESC_FLAG_REQUIRED) != 0);
+        if (flags & DESC_FLAG_REPEATED) {
+            add_assoc_bool(&opts, "packed", (flags & DESC_FLAG_PACKED) != 0);
+        }
+        if (json_name_len) {
+            add_assoc_stringl(&opts, "json_name", json_name, json_name_len);
+        }
+        if (flags & DESC_FLAG_DEPRECATED) {
+            add_assoc_bool(&opts, "deprecated", 1);
+        }
+        if (!desc_read_default(r, &opts)) {
+            zval_ptr_dtor(&opts);
+            return 0;
+        }
+        add_assoc_zval_ex(fields, name, name_len, &opts);
+    }
+    return 1;
+}
+
+const quicpro_iibin_compiled_schema_internal *quicpro_iibin_define_from_descriptor(const unsigned char *buf, size_t len)
+{
+    desc_reader r = { buf, buf + len };
+    uint64_t count;
+    if (len < 3 || buf[0] != 'I' || buf[1] != 'D' || buf[2] != DESC_VERSION) {
+        throw_iibin_error_as_php_exception(0, "Not an IIBIN schema descriptor, or one of another version.");
+        return NULL;
+    }
+    r.p += 3;
+    if (!desc_get_varint(&r, &count) || count == 0) {
+        throw_iibin_error_as_php_exception(0, "IIBIN schema descriptor is malformed.");
+        return NULL;
+    }
+
+    zend_string *root = NULL;
+    for (uint64_t i = 0; i < count; i++) {
+        uint8_t kind;
+        const char *name;
+        size_t name_len;
+        zval body;
+        ZVAL_UNDEF(&body);
+        if (!desc_get_byte(&r, &kind) || !desc_get_str(&r, &name, &name_len) || name_len == 0
+            || !(kind == DESC_KIND_ENUM ? desc_read_enum(&r, &body)
+                 : kind == DESC_KIND_SCHEMA && desc_read_schema(&r, &body))) {
+            zval_ptr_dtor(&body);
+            if (root) zend_string_release(root);
+            throw_iibin_error_as_php_exception(0, "IIBIN schema descriptor is malformed.");
+            return NULL;
+        }
+
+        if (root) zend_string_release(root);
+        root = zend_string_init(name, name_len, 0);
+        /* Definitions this process has already are kept; the ID check below catches differences */
+        zend_bool ok = 1;
+        if (kind == DESC_KIND_ENUM && !get_compiled_iibin_enum_internal(ZSTR_VAL(root))) {
+            ok = quicpro_iibin_define_enum_ht(ZSTR_VAL(root), ZSTR_LEN(root), Z_ARRVAL(body)) != NULL;
+        } else if (kind == DESC_KIND_SCHEMA && !get_compiled_iibin_schema_internal(ZSTR_VAL(root))) {
+            ok = quicpro_iibin_define_schema_ht(ZSTR_VAL(root), ZSTR_LEN(root), Z_ARRVAL(body)) != NULL;
+        }
+        zval_ptr_dtor(&body);
+        if (!ok) {
+            zend_string_release(root);
+            return NULL;
+        }
+        if (i + 1 == count && kind != DESC_KIND_SCHEMA) {
+            zend_string_release(root);
+            throw_iibin_error_as_php_exception(0, "IIBIN schema descriptor is malformed.");
+            return NULL;
+        }
+    }
+
+    const quicpro_iibin_compiled_schema_internal *schema = get_compiled_iibin_schema_internal(ZSTR_VAL(root));
+    if (r.p != r.end || !schema) {
+        throw_iibin_error_as_php_exception(0, "IIBIN schema descriptor is malformed.");
+        schema = NULL;
+    } else if (schema->fingerprint != desc_fingerprint(buf, len)) {
+        throw_iibin_error_as_php_exception(0, "IIBIN schema descriptor for '%s' differs from the local definition of that schema or one it uses.", ZSTR_VAL(root));
+        schema = NULL;
+    }
+    zend_string_release(root);
+    return schema;
+}
+
+
+/*──── PHP functions ────*/
+
+static const quicpro_iibin_compiled_schema_internal *desc_lookup(const char *schema_name_str)
+{
+    const quicpro_iibin_compiled_schema_internal *schema = get_compiled_iibin_schema_internal(schema_name_str);
+    if (!schema) {
+        throw_iibin_error_as_php_exception(0, "Schema '%s' not defined.", schema_name_str);
+    }
+    return schema;
+}
+
+PHP_FUNCTION(quicpro_iibin_schema_id)
+{
+    char *schema_name_str; size_t schema_name_len;
+    ZEND_PARSE_PARAMETERS_START(1, 1) Z_PARAM_STRING(schema_name_str, schema_name_len) ZEND_PARSE_PARAMETERS_END();
+    const quicpro_iibin_compiled_schema_internal *schema = desc_lookup(schema_name_str);
+    if (!schema) {
+        RETURN_THROWS();
+    }
+    RETURN_LONG((zend_long)schema->fingerprint);
+}
+
+PHP_FUNCTION(quicpro_iibin_schema_descriptor)
+{
+    char *schema_name_str; size_t schema_name_len;
+    ZEND_PARSE_PARAMETERS_START(1, 1) Z_PARAM_STRING(schema_name_str, schema_name_len) ZEND_PARSE_PARAMETERS_END();
+    const quicpro_iibin_compiled_schema_internal *schema = desc_lookup(schema_name_str);
+    if (!schema) {
+        RETURN_THROWS();
+    }
+    RETURN_STRINGL(schema->descriptor, schema->descriptor_len);
+}
+
+PHP_FUNCTION(quicpro_iibin_define_from_descriptor)
+{
+    zend_string *descriptor;
+    ZEND_PARSE_PARAMETERS_START(1, 1) Z_PARAM_STR(descriptor) ZEND_PARSE_PARAMETERS_END();
+    const quicpro_iibin_compiled_schema_internal *schema =
+        quicpro_iibin_define_from_descriptor((const unsigned char *)ZSTR_VAL(descriptor), ZSTR_LEN(descriptor));
+    if (!schema) {
+        RETURN_THROWS();
+    }
+    RETURN_STRING(schema->schema_name);
+}
+
+PHP_FUNCTION(quicpro_iibin_schema_name_by_id)
+{
+    zend_long id;
+    ZEND_PARSE_PARAMETERS_START(1, 1) Z_PARAM_LONG(id) ZEND_PARSE_PARAMETERS_END();
+    const quicpro_iibin_compiled_schema_internal *schema =
+        id > 0 && id <= UINT32_MAX ? quicpro_iibin_schema_by_id((uint32_t)id) : NULL;
+    if (!schema) {
+        RETURN_NULL();
+    }
+    RETURN_STRING(schema->schema_name);
+}
@@ -8,304 +8,665 @@
  *
  * This implementation enforces strict type checking to ensure data integrity
  * and prevent unexpected behavior from PHP's type juggling.
+ *
+ * Encoding runs the schema's compiled program (iibin_program.c): each field's
+ * key bytes, opcode, name hash and nested schema are resolved in advance.
  */
 
 #include "php_quicpro.h"
 #include "iibin.h"
 #include "iibin_internal.h"
 #include "cancel.h"
+#include "server/metrics.h"
+#include "server/profiler.h"
 
 #include <zend_API.h>
 #include <zend_exceptions.h>
 #include <zend_hash.h>
 #include <zend_smart_str.h>
 #include <zend_string.h>
+#include <string.h>
 #include <Zend/zend_object_handlers.h>
 
+/*
+ * Encoder state. Plain encodes only use `buf`. A streaming encode
+ * (quicpro_iibin_encode_to_sink) also carries the body length of every
+ * nested message, measured up front in the order they are written, and
+ * the sink that `buf` is flushed into.
+ */
+typedef struct {
+    smart_str           buf;
+    const uint64_t     *sizes;       /* NULL: lengths are patched in after each body */
+    size_t              next_size;
+    quicpro_iibin_sink *sink;
+    uint64_t            flushed;     /* Bytes already handed to the sink */
+} iibin_encoder;
+
+/* Nested body lengths in the order the encoder writes the bodies (preorder). */
+typedef struct {
+    uint64_t *len;
+    size_t    count;
+    size_t    cap;
+} iibin_sizes;
+
 /* --- Static Helper Function Prototypes --- */
-static int encode_message_internal(smart_str *buf, const quicpro_iibin_compiled_schema_internal *schema, zval *data_zval);
-static int encode_field_internal(smart_str *buf, const quicpro_iibin_field_def_internal *field, zval *value_zval);
-static int encode_packed_repeated_field(smart_str *buf, const quicpro_iibin_field_def_internal *field, zval *php_array_zval);
-static int encode_single_field_value(smart_str *buf, const quicpro_iibin_field_def_internal *field, zval *value_zval);
+static zend_bool measure_message(iibin_sizes *sizes, const quicpro_iibin_compiled_schema_internal *schema, zval *data_zval, uint64_t *len_out);
+static int encode_message_internal(iibin_encoder *enc, const quicpro_iibin_compiled_schema_internal *schema, zval *data_zval);
+static int encode_value(iibin_encoder *enc, const quicpro_iibin_insn *insn, zval *value_zval);
+static int encode_field(iibin_encoder *enc, const quicpro_iibin_insn *insn, zval *value_zval);
+static int encode_packed_run(smart_str *buf, const quicpro_iibin_insn *insn, HashTable *items);
+
+
+/*
+ * Without measured sizes (the error-reporting pass), nested bodies are
+ * written in place. The length varint is not known until the body is done,
+ * so one byte is reserved for it; bodies of 128 bytes or more then move up
+ * by the extra length bytes.
+ */
+static inline size_t begin_length_delimited(smart_str *buf) {
+    smart_str_appendc(buf, '\0');
+    return ZSTR_LEN(buf->s);
+}
+
+static void end_length_delimited(smart_str *buf, size_t body_start) {
+    size_t body_len = ZSTR_LEN(buf->s) - body_start;
+    if (body_len < 0x80) {
+        ZSTR_VAL(buf->s)[body_start - 1] = (char)body_len;
+        return;
+    }
+    unsigned char len_buf[10];
+    size_t n = 0;
+    uint64_t v = body_len;
+    do {
+        len_buf[n] = (unsigned char)(v & 0x7F);
+        v >>= 7;
+        if (v) len_buf[n] |= 0x80;
+        n++;
+    } while (v);
+
+    smart_str_alloc(buf, n - 1, 0);
+    char *body = ZSTR_VAL(buf->s) + body_start;
+    memmove(body + n - 1, body, body_len);
+    memcpy(body - 1, len_buf, n);
+    ZSTR_LEN(buf->s) += n - 1;
+}
+
+static inline uint32_t float_bits(double d) {
+    float f = (float)d;
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
 
+static inline uint64_t double_bits(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+/* --- Streaming Output --- */
+
+static inline uint64_t encoder_pos(const iibin_encoder *enc) {
+    return enc->flushed + (enc->buf.s ? ZSTR_LEN(enc->buf.s) : 0);
+}
+
+static inline int encoder_sink(iibin_encoder *enc, const uint8_t *data, size_t len) {
+    if (enc->sink->write(enc->sink, data, len) == FAILURE) {
+        return FAILURE; /* The sink has thrown */
+    }
+    enc->flushed += len;
+    return SUCCESS;
+}
+
+static int encoder_flush(iibin_encoder *enc) {
+    if (!enc->buf.s || ZSTR_LEN(enc->buf.s) == 0) {
+        return SUCCESS;
+    }
+    size_t len = ZSTR_LEN(enc->buf.s);
+    ZSTR_LEN(enc->buf.s) = 0;
+    return encoder_sink(enc, (const uint8_t *)ZSTR_VAL(enc->buf.s), len);
+}
+
+/* Called between fields: a streaming encode holds at most about one chunk plus one field. */
+static inline int encoder_maybe_flush(iibin_encoder *enc) {
+    if (!enc->sink || ZSTR_LEN(enc->buf.s) < IIBIN_STREAM_CHUNK) {
+        return SUCCESS;
+    }
+    return encoder_flush(enc);
+}
 
 /**
- * @brief Encodes a single, non-repeated value with its tag and wire type.
+ * @brief Encodes one value of a field, without its key.
  * @param buf The smart_str buffer to write the binary data into.
- * @param field The compiled field definition for the value being encoded.
+ * @param insn The field's compiled instruction.
  * @param value_zval The PHP zval containing the value to encode.
  * @return SUCCESS or FAILURE.
  *
  * This function performs strict type validation on the input zval before
  * performing the low-level serialization of a single data point.
  */
-static int encode_single_field_value(smart_str *buf, const quicpro_iibin_field_def_internal *field, zval *value_zval) {
-    /* Write tag and wire type for this field. */
-    quicpro_iibin_encode_varint(buf, (field->tag << 3) | field->wire_type);
-
-    /* Encode the value based on its defined type, with strict type checking. */
-    switch (field->type) {
-        case IIBIN_INTERNAL_TYPE_INT32:
-        case IIBIN_INTERNAL_TYPE_UINT32:
-        case IIBIN_INTERNAL_TYPE_SINT32:
-        case IIBIN_INTERNAL_TYPE_INT64:
-        case IIBIN_INTERNAL_TYPE_UINT64:
-        case IIBIN_INTERNAL_TYPE_SINT64:
-        case IIBIN_INTERNAL_TYPE_FIXED32:
-        case IIBIN_INTERNAL_TYPE_SFIXED32:
-        case IIBIN_INTERNAL_TYPE_FIXED64:
-        case IIBIN_INTERNAL_TYPE_SFIXED64:
-            if (Z_TYPE_P(value_zval) != IS_LONG) {
-                throw_iibin_error_as_php_exception(0, "Encoding failed: Field '%s' expects an integer, but got %s.", field->name_in_php, zend_get_type_by_const(Z_TYPE_P(value_zval)));
+static int encode_value(iibin_encoder *enc, const quicpro_iibin_insn *insn, zval *value_zval) {
+    smart_str *buf = &enc->buf;
+    switch (insn->op) {
+        case IIBIN_OP_VARINT:
+        case IIBIN_OP_INT32:
+        case IIBIN_OP_ZIGZAG32:
+        case IIBIN_OP_ZIGZAG64:
+        case IIBIN_OP_FIXED32:
+        case IIBIN_OP_SFIXED32:
+        case IIBIN_OP_FIXED64:
+            if (UNEXPECTED(Z_TYPE_P(value_zval) != IS_LONG)) {
+                throw_iibin_error_as_php_exception(0, "Encoding failed: Field '%s' expects an integer, but got %s.", ZSTR_VAL(insn->name), zend_get_type_by_const(Z_TYPE_P(value_zval)));
                 return FAILURE;
             }
-            break; /* Fall through to value encoding */
+            switch (insn->op) {
+                case IIBIN_OP_VARINT:
+                case IIBIN_OP_INT32:    quicpro_iibin_encode_varint(buf, (uint64_t)Z_LVAL_P(value_zval)); break;
+                case IIBIN_OP_ZIGZAG32: quicpro_iibin_encode_varint(buf, quicpro_iibin_zigzag_encode32((int32_t)Z_LVAL_P(value_zval))); break;
+                case IIBIN_OP_ZIGZAG64: quicpro_iibin_encode_varint(buf, quicpro_iibin_zigzag_encode64(Z_LVAL_P(value_zval))); break;
+                case IIBIN_OP_FIXED32:
+                case IIBIN_OP_SFIXED32: quicpro_iibin_encode_fixed32(buf, (uint32_t)Z_LVAL_P(value_zval)); break;
+                default:                quicpro_iibin_encode_fixed64(buf, (uint64_t)Z_LVAL_P(value_zval)); break;
+            }
+            return SUCCESS;
 
-        case IIBIN_INTERNAL_TYPE_FLOAT:
-        case IIBIN_INTERNAL_TYPE_DOUBLE:
-            if (Z_TYPE_P(value_zval) != IS_DOUBLE && Z_TYPE_P(value_zval) != IS_LONG) {
-                throw_iibin_error_as_php_exception(0, "Encoding failed: Field '%s' expects a float or integer, but got %s.", field->name_in_php, zend_get_type_by_const(Z_TYPE_P(value_zval)));
+        case IIBIN_OP_FLOAT:
+        case IIBIN_OP_DOUBLE:
+            if (UNEXPECTED(Z_TYPE_P(value_zval) != IS_DOUBLE && Z_TYPE_P(value_zval) != IS_LONG)) {
+                throw_iibin_error_as_php_exception(0, "Encoding failed: Field '%s' expects a float or integer, but got %s.", ZSTR_VAL(insn->name), zend_get_type_by_const(Z_TYPE_P(value_zval)));
                 return FAILURE;
             }
-            break; /* Fall through to value encoding */
+            if (insn->op == IIBIN_OP_FLOAT) {
+                quicpro_iibin_encode_fixed32(buf, float_bits(zval_get_double(value_zval)));
+            } else {
+                quicpro_iibin_encode_fixed64(buf, double_bits(zval_get_double(value_zval)));
+            }
+            return SUCCESS;
 
-        case IIBIN_INTERNAL_TYPE_BOOL:
-             if (Z_TYPE_P(value_zval) != IS_TRUE && Z_TYPE_P(value_zval) != IS_FALSE) {
-                throw_iibin_error_as_php_exception(0, "Encoding failed: Field '%s' expects a boolean, but got %s.", field->name_in_php, zend_get_type_by_const(Z_TYPE_P(value_zval)));
+        case IIBIN_OP_BOOL:
+            if (UNEXPECTED(Z_TYPE_P(value_zval) != IS_TRUE && Z_TYPE_P(value_zval) != IS_FALSE)) {
+                throw_iibin_error_as_php_exception(0, "Encoding failed: Field '%s' expects a boolean, but got %s.", ZSTR_VAL(insn->name), zend_get_type_by_const(Z_TYPE_P(value_zval)));
                 return FAILURE;
-             }
-             break;
-
-        /* No pre-check needed for enum, string, bytes, message, as they have complex checks below */
-        default: break;
-    }
-
-
-    /* After type validation, encode the value. */
-    switch (field->type) {
-        case IIBIN_INTERNAL_TYPE_INT32: quicpro_iibin_encode_varint(buf, (uint64_t)Z_LVAL_P(value_zval)); break;
-        case IIBIN_INTERNAL_TYPE_SINT32: quicpro_iibin_encode_varint(buf, quicpro_iibin_zigzag_encode32((int32_t)Z_LVAL_P(value_zval))); break;
-        case IIBIN_INTERNAL_TYPE_INT64: quicpro_iibin_encode_varint(buf, (uint64_t)Z_LVAL_P(value_zval)); break;
-        case IIBIN_INTERNAL_TYPE_SINT64: quicpro_iibin_encode_varint(buf, quicpro_iibin_zigzag_encode64(Z_LVAL_P(value_zval))); break;
-        case IIBIN_INTERNAL_TYPE_UINT32: case IIBIN_INTERNAL_TYPE_UINT64: quicpro_iibin_encode_varint(buf, (uint64_t)Z_LVAL_P(value_zval)); break;
-        case IIBIN_INTERNAL_TYPE_BOOL: quicpro_iibin_encode_varint(buf, Z_TYPE_P(value_zval) == IS_TRUE ? 1 : 0); break;
+            }
+            smart_str_appendc(buf, Z_TYPE_P(value_zval) == IS_TRUE ? '\1' : '\0');
+            return SUCCESS;
 
-        case IIBIN_INTERNAL_TYPE_ENUM: {
+        case IIBIN_OP_ENUM: {
             int32_t enum_int_val;
             if (Z_TYPE_P(value_zval) == IS_LONG) {
                 enum_int_val = (int32_t)Z_LVAL_P(value_zval);
             } else if (Z_TYPE_P(value_zval) == IS_STRING) {
-                const quicpro_iibin_compiled_enum_internal *enum_def = get_compiled_iibin_enum_internal(field->enum_type_name_if_enum);
-                if (!enum_def) {
-                    throw_iibin_error_as_php_exception(0, "Encoding failed: Enum type '%s' for field '%s' is not defined.", field->enum_type_name_if_enum, field->name_in_php);
-                    return FAILURE;
-                }
-                quicpro_iibin_enum_value_def_internal *enum_val_def = zend_hash_find_ptr(&enum_def->values_by_name, Z_STR_P(value_zval));
+                quicpro_iibin_enum_value_def_internal *enum_val_def = zend_hash_find_ptr(&insn->enum_def->values_by_name, Z_STR_P(value_zval));
                 if (!enum_val_def) {
-                    throw_iibin_error_as_php_exception(0, "Encoding failed: Enum value name '%s' is not a valid member of enum '%s' for field '%s'.", Z_STRVAL_P(value_zval), field->enum_type_name_if_enum, field->name_in_php);
+                    throw_iibin_error_as_php_exception(0, "Encoding failed: Enum value name '%s' is not a valid member of enum '%s' for field '%s'.", Z_STRVAL_P(value_zval), insn->enum_def->enum_name, ZSTR_VAL(insn->name));
                     return FAILURE;
                 }
                 enum_int_val = enum_val_def->number;
             } else {
-                throw_iibin_error_as_php_exception(0, "Encoding failed: Enum field '%s' expects an integer or string, but got %s.", field->name_in_php, zend_get_type_by_const(Z_TYPE_P(value_zval)));
+                throw_iibin_error_as_php_exception(0, "Encoding failed: Enum field '%s' expects an integer or string, but got %s.", ZSTR_VAL(insn->name), zend_get_type_by_const(Z_TYPE_P(value_zval)));
                 return FAILURE;
             }
             quicpro_iibin_encode_varint(buf, (uint64_t)enum_int_val);
-            break;
+            return SUCCESS;
         }
 
-        case IIBIN_INTERNAL_TYPE_FLOAT: {
-            float f_val = (float)zval_get_double(value_zval);
-            quicpro_iibin_encode_fixed32(buf, *((uint32_t*)&f_val));
-            break;
-        }
-        case IIBIN_INTERNAL_TYPE_FIXED32: case IIBIN_INTERNAL_TYPE_SFIXED32:
-            quicpro_iibin_encode_fixed32(buf, (uint32_t)Z_LVAL_P(value_zval));
-            break;
-        case IIBIN_INTERNAL_TYPE_DOUBLE: {
-            double d_val = zval_get_double(value_zval);
-            quicpro_iibin_encode_fixed64(buf, *((uint64_t*)&d_val));
-            break;
-        }
-        case IIBIN_INTERNAL_TYPE_FIXED64: case IIBIN_INTERNAL_TYPE_SFIXED64:
-            quicpro_iibin_encode_fixed64(buf, (uint64_t)Z_LVAL_P(value_zval));
-            break;
-        case IIBIN_INTERNAL_TYPE_STRING: case IIBIN_INTERNAL_TYPE_BYTES: {
-            if (Z_TYPE_P(value_zval) != IS_STRING) {
-                throw_iibin_error_as_php_exception(0, "Encoding failed: Field '%s' expects a string, but got %s.", field->name_in_php, zend_get_type_by_const(Z_TYPE_P(value_zval)));
+        case IIBIN_OP_BYTES:
+            if (UNEXPECTED(Z_TYPE_P(value_zval) != IS_STRING)) {
+                throw_iibin_error_as_php_exception(0, "Encoding failed: Field '%s' expects a string, but got %s.", ZSTR_VAL(insn->name), zend_get_type_by_const(Z_TYPE_P(value_zval)));
                 return FAILURE;
             }
             quicpro_iibin_encode_varint(buf, Z_STRLEN_P(value_zval));
+            if (enc->sink && Z_STRLEN_P(value_zval) >= IIBIN_STREAM_CHUNK) {
+                /* Large payloads go to the sink from the zval itself, never through the chunk */
+                return encoder_flush(enc) == SUCCESS
+                    ? encoder_sink(enc, (const uint8_t *)Z_STRVAL_P(value_zval), Z_STRLEN_P(value_zval)) : FAILURE;
+            }
             smart_str_appendl(buf, Z_STRVAL_P(value_zval), Z_STRLEN_P(value_zval));
-            break;
-        }
-        case IIBIN_INTERNAL_TYPE_MESSAGE: {
-            if (Z_TYPE_P(value_zval) != IS_ARRAY && Z_TYPE_P(value_zval) != IS_OBJECT) {
-                throw_iibin_error_as_php_exception(0, "Encoding failed: Nested message field '%s' expects an array or object, but got %s.", field->name_in_php, zend_get_type_by_const(Z_TYPE_P(value_zval)));
+            return SUCCESS;
+
+        case IIBIN_OP_MESSAGE: {
+            if (UNEXPECTED(Z_TYPE_P(value_zval) != IS_ARRAY && Z_TYPE_P(value_zval) != IS_OBJECT)) {
+                throw_iibin_error_as_php_exception(0, "Encoding failed: Nested message field '%s' expects an array or object, but got %s.", ZSTR_VAL(insn->name), zend_get_type_by_const(Z_TYPE_P(value_zval)));
                 return FAILURE;
             }
-            smart_str nested_buf = {0};
-            const quicpro_iibin_compiled_schema_internal *nested_schema = get_compiled_iibin_schema_internal(field->message_type_name_if_nested);
-            if (!nested_schema) {
-                throw_iibin_error_as_php_exception(0, "Encoding failed: Nested schema '%s' for field '%s' is not defined.", field->message_type_name_if_nested, field->name_in_php);
-                return FAILURE;
+            if (enc->sizes) {
+                uint64_t body_len = enc->sizes[enc->next_size++];
+                quicpro_iibin_encode_varint(buf, body_len);
+                uint64_t body_start = encoder_pos(enc);
+                if (encode_message_internal(enc, insn->nested, value_zval) == FAILURE) {
+                    return FAILURE;
+                }
+                if (UNEXPECTED(encoder_pos(enc) - body_start != body_len)) {
+                    /* Only an object whose properties changed between the passes gets here */
+                    throw_iibin_error_as_php_exception(0, "Encoding failed: Nested message field '%s' changed while it was being encoded.", ZSTR_VAL(insn->name));
+                    return FAILURE;
+                }
+                return SUCCESS;
             }
-            if (encode_message_internal(&nested_buf, nested_schema, value_zval) == FAILURE) {
-                smart_str_free(&nested_buf);
+            size_t body_start = begin_length_delimited(buf);
+            if (encode_message_internal(enc, insn->nested, value_zval) == FAILURE) {
                 return FAILURE;
             }
-            quicpro_iibin_encode_varint(buf, nested_buf.s ? ZSTR_LEN(nested_buf.s) : 0);
-            if (nested_buf.s) {
-                smart_str_append_smart_str(buf, &nested_buf);
-            }
-            smart_str_free(&nested_buf);
-            break;
+            end_length_delimited(buf, body_start);
+            return SUCCESS;
         }
-        default:
-            throw_iibin_error_as_php_exception(0, "Encoding failed: unknown type %d for field '%s'.", field->type, field->name_in_php);
-            return FAILURE;
     }
-    return SUCCESS;
+    throw_iibin_error_as_php_exception(0, "Encoding failed: unknown opcode %d for field '%s'.", insn->op, ZSTR_VAL(insn->name));
+    return FAILURE;
+}
+
+/* Integer value of one packed item. Packed runs convert leniently, as they always have. */
+static inline zend_long packed_item_long(zval *item_zval) {
+    return EXPECTED(Z_TYPE_P(item_zval) == IS_LONG) ? Z_LVAL_P(item_zval) : zval_get_long(item_zval);
+}
+
+static inline double packed_item_double(zval *item_zval) {
+    return EXPECTED(Z_TYPE_P(item_zval) == IS_DOUBLE) ? Z_DVAL_P(item_zval) : zval_get_double(item_zval);
+}
+
+static inline uint64_t packed_item_varint(uint8_t op, zval *item_zval) {
+    zend_long v = packed_item_long(item_zval);
+    switch (op) {
+        case IIBIN_OP_ZIGZAG32: return quicpro_iibin_zigzag_encode32((int32_t)v);
+        case IIBIN_OP_ZIGZAG64: return quicpro_iibin_zigzag_encode64(v);
+        default:                return (uint64_t)v;
+    }
 }
 
 /**
- * @brief Encodes a repeated field of packable primitive types into a single length-delimited field.
+ * @brief Encodes a repeated field of packable primitive types as one length-delimited run.
  * @param buf The smart_str buffer to write into.
- * @param field The compiled field definition (must have PACKED flag).
- * @param php_array_zval A zval containing the PHP array of values.
+ * @param insn The field's instruction (must have the PACKED flag).
+ * @param items The PHP array of values, not empty.
  * @return SUCCESS or FAILURE.
+ *
+ * The run's length is known before anything is written: item count times
+ * the width for fixed-width types, or one sizing pass over the items for
+ * varints. The buffer then grows once and every item is stored without a
+ * bounds check or a trailing memmove.
  */
-static int encode_packed_repeated_field(smart_str *buf, const quicpro_iibin_field_def_internal *field, zval *php_array_zval) {
-    smart_str packed_buf = {0};
+static size_t packed_body_len(const quicpro_iibin_insn *insn, HashTable *items) {
     zval *item_zval;
+    size_t count = zend_hash_num_elements(items);
+    size_t body_len = 0;
+
+    switch (insn->op) {
+        case IIBIN_OP_FIXED32: case IIBIN_OP_SFIXED32: case IIBIN_OP_FLOAT:
+            return count * 4;
+        case IIBIN_OP_FIXED64: case IIBIN_OP_DOUBLE:
+            return count * 8;
+        default:
+            ZEND_HASH_FOREACH_VAL(items, item_zval) {
+                body_len += quicpro_iibin_varint_size(packed_item_varint(insn->op, item_zval));
+            } ZEND_HASH_FOREACH_END();
+            return body_len;
+    }
+}
 
-    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(php_array_zval), item_zval) {
-        /*
-         * This function directly encodes the values without their tags,
-         * as they will be written as one contiguous block.
-         */
-        switch (field->type) {
-            case IIBIN_INTERNAL_TYPE_INT32: case IIBIN_INTERNAL_TYPE_INT64: case IIBIN_INTERNAL_TYPE_UINT32: case IIBIN_INTERNAL_TYPE_UINT64: case IIBIN_INTERNAL_TYPE_BOOL: case IIBIN_INTERNAL_TYPE_ENUM:
-                quicpro_iibin_encode_varint(&packed_buf, (uint64_t)zval_get_long(item_zval));
-                break;
-            case IIBIN_INTERNAL_TYPE_SINT32:
-                quicpro_iibin_encode_varint(&packed_buf, quicpro_iibin_zigzag_encode32((int32_t)zval_get_long(item_zval)));
-                break;
-            case IIBIN_INTERNAL_TYPE_SINT64:
-                 quicpro_iibin_encode_varint(&packed_buf, quicpro_iibin_zigzag_encode64(zval_get_long(item_zval)));
-                break;
-            case IIBIN_INTERNAL_TYPE_FIXED32: case IIBIN_INTERNAL_TYPE_SFIXED32:
-                 quicpro_iibin_encode_fixed32(&packed_buf, (uint32_t)zval_get_long(item_zval));
-                 break;
-            case IIBIN_INTERNAL_TYPE_FLOAT: {
-                 float f_val = (float)zval_get_double(item_zval);
-                 quicpro_iibin_encode_fixed32(&packed_buf, *((uint32_t*)&f_val));
-                 break;
-            }
-            case IIBIN_INTERNAL_TYPE_FIXED64: case IIBIN_INTERNAL_TYPE_SFIXED64:
-                 quicpro_iibin_encode_fixed64(&packed_buf, (uint64_t)zval_get_long(item_zval));
-                 break;
-            case IIBIN_INTERNAL_TYPE_DOUBLE: {
-                 double d_val = zval_get_double(item_zval);
-                 quicpro_iibin_encode_fixed64(&packed_buf, *((uint64_t*)&d_val));
-                 break;
-            }
-            default: break; /* Non-packable types (string, bytes, message) should not reach this function. */
-        }
-    } ZEND_HASH_FOREACH_END();
-
-    if (packed_buf.s) {
-        quicpro_iibin_encode_varint(buf, (field->tag << 3) | QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM);
-        quicpro_iibin_encode_varint(buf, ZSTR_LEN(packed_buf.s));
-        smart_str_append_smart_str(buf, &packed_buf);
+static int encode_packed_run(smart_str *buf, const quicpro_iibin_insn *insn, HashTable *items) {
+    zval *item_zval;
+    size_t body_len = packed_body_len(insn, items);
+
+    smart_str_alloc(buf, insn->key_len + QUICPRO_IIBIN_VARINT_MAX_LEN + body_len, 0);
+    unsigned char *out = (unsigned char *)ZSTR_VAL(buf->s) + ZSTR_LEN(buf->s);
+    memcpy(out, insn->key, insn->key_len);
+    out += insn->key_len;
+    out += quicpro_iibin_put_varint(out, body_len);
+
+    switch (insn->op) {
+        case IIBIN_OP_FIXED32: case IIBIN_OP_SFIXED32:
+            ZEND_HASH_FOREACH_VAL(items, item_zval) {
+                quicpro_iibin_store_fixed32(out, (uint32_t)packed_item_long(item_zval));
+                out += 4;
+            } ZEND_HASH_FOREACH_END();
+            break;
+        case IIBIN_OP_FLOAT:
+            ZEND_HASH_FOREACH_VAL(items, item_zval) {
+                quicpro_iibin_store_fixed32(out, float_bits(packed_item_double(item_zval)));
+                out += 4;
+            } ZEND_HASH_FOREACH_END();
+            break;
+        case IIBIN_OP_FIXED64:
+            ZEND_HASH_FOREACH_VAL(items, item_zval) {
+                quicpro_iibin_store_fixed64(out, (uint64_t)packed_item_long(item_zval));
+                out += 8;
+            } ZEND_HASH_FOREACH_END();
+            break;
+        case IIBIN_OP_DOUBLE:
+            ZEND_HASH_FOREACH_VAL(items, item_zval) {
+                quicpro_iibin_store_fixed64(out, double_bits(packed_item_double(item_zval)));
+                out += 8;
+            } ZEND_HASH_FOREACH_END();
+            break;
+        default: /* Varint types; string, bytes and message are never compiled as packed. */
+            ZEND_HASH_FOREACH_VAL(items, item_zval) {
+                out += quicpro_iibin_put_varint(out, packed_item_varint(insn->op, item_zval));
+            } ZEND_HASH_FOREACH_END();
+            break;
     }
 
-    smart_str_free(&packed_buf);
+    ZSTR_LEN(buf->s) = (char *)out - ZSTR_VAL(buf->s);
     return SUCCESS;
 }
 
-/**
- * @brief Dispatches encoding for a field, handling optional, required, and repeated flags.
- * @param buf The smart_str buffer to write into.
- * @param field The compiled field definition.
- * @param value_zval The PHP value for this field. Can be NULL if the field is not present in the input data.
- * @return SUCCESS or FAILURE.
- */
-static int encode_field_internal(smart_str *buf, const quicpro_iibin_field_def_internal *field, zval *value_zval) {
-    if (!value_zval || Z_TYPE_P(value_zval) == IS_NULL || Z_TYPE_P(value_zval) == IS_UNDEF) {
-        if (field->flags & IIBIN_FIELD_FLAG_REQUIRED) {
-            throw_iibin_error_as_php_exception(0, "Encoding failed: Required field '%s' (tag %u) is missing or null.", field->name_in_php, field->tag);
+/* Key and value(s) of one present (non-null) field. Empty repeated fields write nothing. */
+static int encode_field(iibin_encoder *enc, const quicpro_iibin_insn *insn, zval *value_zval) {
+    smart_str *buf = &enc->buf;
+
+    if (!(insn->flags & IIBIN_FIELD_FLAG_REPEATED)) {
+        smart_str_appendl(buf, (const char *)insn->key, insn->key_len);
+        if (encode_value(enc, insn, value_zval) == FAILURE) {
             return FAILURE;
         }
-        return SUCCESS; /* Optional fields are not encoded if missing. */
+        return encoder_maybe_flush(enc);
     }
 
-    if (field->flags & IIBIN_FIELD_FLAG_REPEATED) {
-        if (Z_TYPE_P(value_zval) != IS_ARRAY) {
-            throw_iibin_error_as_php_exception(0, "Encoding failed: Field '%s' is repeated and requires a PHP array, but got %s.", field->name_in_php, zend_get_type_by_const(Z_TYPE_P(value_zval)));
+    if (Z_TYPE_P(value_zval) != IS_ARRAY) {
+        throw_iibin_error_as_php_exception(0, "Encoding failed: Field '%s' is repeated and requires a PHP array, but got %s.", ZSTR_VAL(insn->name), zend_get_type_by_const(Z_TYPE_P(value_zval)));
+        return FAILURE;
+    }
+    if (zend_hash_num_elements(Z_ARRVAL_P(value_zval)) == 0) {
+        return SUCCESS; /* Do not encode empty arrays. */
+    }
+    if (insn->flags & IIBIN_FIELD_FLAG_PACKED) {
+        encode_packed_run(buf, insn, Z_ARRVAL_P(value_zval));
+        return encoder_maybe_flush(enc);
+    }
+    /* Unpacked repeated field: write a key/value pair for each item in the array. */
+    zval *item_zval;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(value_zval), item_zval) {
+        ZVAL_DEREF(item_zval);
+        smart_str_appendl(buf, (const char *)insn->key, insn->key_len);
+        if (encode_value(enc, insn, item_zval) == FAILURE || encoder_maybe_flush(enc) == FAILURE) {
             return FAILURE;
         }
-        if (zend_hash_num_elements(Z_ARRVAL_P(value_zval)) == 0) {
-            return SUCCESS; // Do not encode empty arrays.
-        }
-
-        if (field->flags & IIBIN_FIELD_FLAG_PACKED) {
-            return encode_packed_repeated_field(buf, field, value_zval);
-        } else {
-            /* Unpacked repeated field: write a tag/value pair for each item in the array. */
-            zval *item_zval;
-            ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(value_zval), item_zval) {
-                if (encode_single_field_value(buf, field, item_zval) == FAILURE) {
-                    return FAILURE;
-                }
-            } ZEND_HASH_FOREACH_END();
-        }
-        return SUCCESS;
-    }
-
-    /* Handle a single (non-repeated) field value. */
-    return encode_single_field_value(buf, field, value_zval);
+    } ZEND_HASH_FOREACH_END();
+    return SUCCESS;
 }
 
 /**
- * @brief Encodes a full message (PHP array or object) into a binary buffer.
+ * @brief Encodes a full message (PHP array or object) by running its schema's program.
  * @param buf The smart_str buffer to write into.
  * @param schema The compiled schema for the message being encoded.
  * @param data_zval The PHP array or object containing the message data.
  * @return SUCCESS or FAILURE.
+ *
+ * Fields are emitted in canonical order (sorted by tag). Missing or null
+ * optional fields and empty repeated fields are not encoded.
  */
-static int encode_message_internal(smart_str *buf, const quicpro_iibin_compiled_schema_internal *schema, zval *data_zval) {
-    if (Z_TYPE_P(data_zval) != IS_ARRAY && Z_TYPE_P(data_zval) != IS_OBJECT) {
+static int encode_message_internal(iibin_encoder *enc, const quicpro_iibin_compiled_schema_internal *schema, zval *data_zval) {
+    HashTable *props = NULL;
+    if (Z_TYPE_P(data_zval) == IS_ARRAY) {
+        props = Z_ARRVAL_P(data_zval);
+    } else if (Z_TYPE_P(data_zval) != IS_OBJECT) {
         throw_iibin_error_as_php_exception(0, "Data for message type '%s' must be an array or object.", schema->schema_name);
         return FAILURE;
     }
 
-    /* Iterate through fields of the schema in canonical order (sorted by tag). */
-    for (size_t i = 0; i < schema->num_fields; ++i) {
-        quicpro_iibin_field_def_internal *field_def = schema->ordered_fields[i];
-        if (!field_def) continue;
+    const quicpro_iibin_insn *insn = schema->program;
+    const quicpro_iibin_insn *end = insn + schema->num_fields;
+    for (; insn < end; insn++) {
+        zval *value_zval;
+        zval rv; /* For zend_read_property_ex, which may return a temporary zval */
 
-        zval *php_value = NULL;
-        zval rv; /* For zend_read_property, which may return a temporary zval */
-        zend_string *field_name_key = zend_string_init(field_def->name_in_php, strlen(field_def->name_in_php), 0);
+        if (props) {
+            value_zval = zend_hash_find_known_hash(props, insn->name);
+        } else {
+            value_zval = zend_read_property_ex(Z_OBJCE_P(data_zval), Z_OBJ_P(data_zval), insn->name, 1, &rv);
+        }
+        if (value_zval) {
+            ZVAL_DEREF(value_zval);
+        }
 
-        if (Z_TYPE_P(data_zval) == IS_ARRAY) {
-            php_value = zend_hash_find(Z_ARRVAL_P(data_zval), field_name_key);
-        } else { /* IS_OBJECT */
-            php_value = zend_read_property(Z_OBJCE_P(data_zval), Z_OBJ_P(data_zval), ZSTR_VAL(field_name_key), ZSTR_LEN(field_name_key), 1, &rv);
+        if (!value_zval || Z_TYPE_P(value_zval) <= IS_NULL) {
+            if (insn->flags & IIBIN_FIELD_FLAG_REQUIRED) {
+                throw_iibin_error_as_php_exception(0, "Encoding failed: Required field '%s' (tag %u) is missing or null.", ZSTR_VAL(insn->name), insn->tag);
+                return FAILURE;
+            }
+            continue; /* Optional fields are not encoded if missing. */
         }
 
-        if (encode_field_internal(buf, field_def, php_value) == FAILURE) {
-            zend_string_release(field_name_key);
+        if (encode_field(enc, insn, value_zval) == FAILURE) {
             return FAILURE;
         }
-
-        zend_string_release(field_name_key);
     }
     return SUCCESS;
 }
 
 
+/*
+ * Messages with nested fields are measured first: the buffer then grows
+ * once, to the exact size, and every body is written once with its length
+ * in front. Patching lengths in afterwards would move each body over 127
+ * bytes once per enclosing message, O(depth × size) for deep trees.
+ * Flat messages have no lengths to patch and skip the extra pass. Bad
+ * input fails the measuring pass silently and is then reported by the
+ * patching encoder, which throws the precise error.
+ */
+static int encode_message_top(smart_str *buf, const quicpro_iibin_compiled_schema_internal *schema, zval *data_zval) {
+    size_t before = buf->s ? ZSTR_LEN(buf->s) : 0;
+    if (schema->has_nested) {
+        iibin_sizes sizes = {0};
+        uint64_t total;
+        if (measure_message(&sizes, schema, data_zval, &total)) {
+            iibin_encoder enc = { .buf = *buf, .sizes = sizes.len };
+            smart_str_alloc(&enc.buf, (size_t)total, 0);
+            uint64_t start = encoder_pos(&enc);
+            int rc = encode_message_internal(&enc, schema, data_zval);
+            if (rc == SUCCESS && encoder_pos(&enc) - start != total) {
+                throw_iibin_error_as_php_exception(0, "Encoding failed: message of type '%s' changed while it was being encoded.", schema->schema_name);
+                rc = FAILURE;
+            }
+            *buf = enc.buf;
+            if (sizes.len) efree(sizes.len);
+            if (rc == SUCCESS) {
+                quicpro_metrics_add(QUICPRO_METRIC_IIBIN_ENCODED_BYTES, total);
+            }
+            return rc;
+        }
+        if (sizes.len) efree(sizes.len);
+    }
+    iibin_encoder enc = { .buf = *buf };
+    int rc = encode_message_internal(&enc, schema, data_zval);
+    *buf = enc.buf;
+    if (rc == SUCCESS) {
+        quicpro_metrics_add(QUICPRO_METRIC_IIBIN_ENCODED_BYTES, (buf->s ? ZSTR_LEN(buf->s) : 0) - before);
+    }
+    return rc;
+}
+
+int quicpro_iibin_encode_message(smart_str *buf, const quicpro_iibin_compiled_schema_internal *schema, zval *data_zval) {
+    uint64_t prof = quicpro_prof_begin();
+    int rc = encode_message_top(buf, schema, data_zval);
+    quicpro_prof_end(QUICPRO_PROF_IIBIN_ENCODE, prof);
+    return rc;
+}
+
+int quicpro_iibin_encode_field(smart_str *buf, const quicpro_iibin_insn *insn, zval *value_zval) {
+    iibin_encoder enc = { .buf = *buf };
+    int rc = encode_field(&enc, insn, value_zval);
+    *buf = enc.buf;
+    return rc;
+}
+
+
+/* --- Sizing Pass for Streaming Encodes --- */
+
+static size_t sizes_reserve(iibin_sizes *sizes) {
+    if (sizes->count == sizes->cap) {
+        sizes->cap = sizes->cap ? sizes->cap * 2 : 16;
+        sizes->len = erealloc(sizes->len, sizes->cap * sizeof(uint64_t));
+    }
+    return sizes->count++;
+}
+
+/*
+ * Encoded length of one value without its key, or 0 if encode_value() would
+ * reject it. The measuring pass never throws; see quicpro_iibin_encode_to_sink().
+ */
+static zend_bool measure_value(iibin_sizes *sizes, const quicpro_iibin_insn *insn, zval *value_zval, uint64_t *len_out) {
+    zend_uchar type = Z_TYPE_P(value_zval);
+    switch (insn->op) {
+        case IIBIN_OP_VARINT: case IIBIN_OP_INT32:
+            if (type != IS_LONG) return 0;
+            *len_out = quicpro_iibin_varint_size((uint64_t)Z_LVAL_P(value_zval));
+            return 1;
+        case IIBIN_OP_ZIGZAG32:
+            if (type != IS_LONG) return 0;
+            *len_out = quicpro_iibin_varint_size(quicpro_iibin_zigzag_encode32((int32_t)Z_LVAL_P(value_zval)));
+            return 1;
+        case IIBIN_OP_ZIGZAG64:
+            if (type != IS_LONG) return 0;
+            *len_out = quicpro_iibin_varint_size(quicpro_iibin_zigzag_encode64(Z_LVAL_P(value_zval)));
+            return 1;
+        case IIBIN_OP_FIXED32: case IIBIN_OP_SFIXED32:
+            *len_out = 4;
+            return type == IS_LONG;
+        case IIBIN_OP_FIXED64:
+            *len_out = 8;
+            return type == IS_LONG;
+        case IIBIN_OP_FLOAT:
+            *len_out = 4;
+            return type == IS_DOUBLE || type == IS_LONG;
+        case IIBIN_OP_DOUBLE:
+            *len_out = 8;
+            return type == IS_DOUBLE || type == IS_LONG;
+        case IIBIN_OP_BOOL:
+            *len_out = 1;
+            return type == IS_TRUE || type == IS_FALSE;
+        case IIBIN_OP_ENUM: {
+            int32_t number;
+            if (type == IS_LONG) {
+                number = (int32_t)Z_LVAL_P(value_zval);
+            } else if (type == IS_STRING) {
+                quicpro_iibin_enum_value_def_internal *enum_val_def = zend_hash_find_ptr(&insn->enum_def->values_by_name, Z_STR_P(value_zval));
+                if (!enum_val_def) return 0;
+                number = enum_val_def->number;
+            } else {
+                return 0;
+            }
+            *len_out = quicpro_iibin_varint_size((uint64_t)number);
+            return 1;
+        }
+        case IIBIN_OP_BYTES:
+            if (type != IS_STRING) return 0;
+            *len_out = quicpro_iibin_varint_size(Z_STRLEN_P(value_zval)) + Z_STRLEN_P(value_zval);
+            return 1;
+        case IIBIN_OP_MESSAGE: {
+            if (type != IS_ARRAY && type != IS_OBJECT) return 0;
+            size_t slot = sizes_reserve(sizes);
+            uint64_t body_len;
+            if (!measure_message(sizes, insn->nested, value_zval, &body_len)) return 0;
+            sizes->len[slot] = body_len;
+            *len_out = quicpro_iibin_varint_size(body_len) + body_len;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Mirrors encode_message_internal() field for field. */
+static zend_bool measure_message(iibin_sizes *sizes, const quicpro_iibin_compiled_schema_internal *schema, zval *data_zval, uint64_t *len_out) {
+    HashTable *props = NULL;
+    if (Z_TYPE_P(data_zval) == IS_ARRAY) {
+        props = Z_ARRVAL_P(data_zval);
+    } else if (Z_TYPE_P(data_zval) != IS_OBJECT) {
+        return 0;
+    }
+
+    uint64_t total = 0, value_len;
+    const quicpro_iibin_insn *insn = schema->program;
+    const quicpro_iibin_insn *end = insn + schema->num_fields;
+    for (; insn < end; insn++) {
+        zval *value_zval;
+        zval rv;
+
+        if (props) {
+            value_zval = zend_hash_find_known_hash(props, insn->name);
+        } else {
+            value_zval = zend_read_property_ex(Z_OBJCE_P(data_zval), Z_OBJ_P(data_zval), insn->name, 1, &rv);
+        }
+        if (value_zval) {
+            ZVAL_DEREF(value_zval);
+        }
+        if (!value_zval || Z_TYPE_P(value_zval) <= IS_NULL) {
+            if (insn->flags & IIBIN_FIELD_FLAG_REQUIRED) return 0;
+            continue;
+        }
+
+        if (!(insn->flags & IIBIN_FIELD_FLAG_REPEATED)) {
+            if (!measure_value(sizes, insn, value_zval, &value_len)) return 0;
+            total += insn->key_len + value_len;
+            continue;
+        }
+        if (Z_TYPE_P(value_zval) != IS_ARRAY) return 0;
+        if (zend_hash_num_elements(Z_ARRVAL_P(value_zval)) == 0) {
+            continue;
+        }
+        if (insn->flags & IIBIN_FIELD_FLAG_PACKED) {
+            uint64_t body_len = packed_body_len(insn, Z_ARRVAL_P(value_zval));
+            total += insn->key_len + quicpro_iibin_varint_size(body_len) + body_len;
+            continue;
+        }
+        zval *item_zval;
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(value_zval), item_zval) {
+            ZVAL_DEREF(item_zval);
+            if (!measure_value(sizes, insn, item_zval, &value_len)) return 0;
+            total += insn->key_len + value_len;
+        } ZEND_HASH_FOREACH_END();
+    }
+    *len_out = total;
+    return 1;
+}
+
+/*
+ * Two passes. The first measures every nested body, so the second writes
+ * each length before its body and never moves bytes already written; it
+ * hands the sink a chunk at a time and large string values straight from
+ * their zval. The first pass also rejects bad input before the sink sees
+ * a byte. It stays silent though: to report the error exactly as
+ * IIBIN::encode() does, the message is then run through the plain encoder.
+ */
+static int encode_to_sink(const quicpro_iibin_compiled_schema_internal *schema, zval *data_zval, quicpro_iibin_sink *sink) {
+    iibin_sizes sizes = {0};
+    uint64_t total;
+
+    if (!measure_message(&sizes, schema, data_zval, &total)) {
+        if (sizes.len) efree(sizes.len);
+        smart_str scratch = {0};
+        if (encode_message_top(&scratch, schema, data_zval) == SUCCESS) {
+            throw_iibin_error_as_php_exception(0, "Encoding failed: message of type '%s' changed while it was being measured.", schema->schema_name);
+        }
+        smart_str_free(&scratch);
+        return FAILURE;
+    }
+
+    sink->total = total;
+    iibin_encoder enc = { .sizes = sizes.len, .sink = sink };
+    smart_str_alloc(&enc.buf, total < 2 * IIBIN_STREAM_CHUNK ? (size_t)total : 2 * IIBIN_STREAM_CHUNK, 0);
+    int rc = encode_message_internal(&enc, schema, data_zval);
+    if (rc == SUCCESS) {
+        rc = encoder_flush(&enc);
+    }
+    if (rc == SUCCESS && enc.flushed != total) {
+        throw_iibin_error_as_php_exception(0, "Encoding failed: message of type '%s' changed while it was being encoded.", schema->schema_name);
+        rc = FAILURE;
+    }
+    smart_str_free(&enc.buf);
+    if (sizes.len) efree(sizes.len);
+    if (rc == SUCCESS) {
+        quicpro_metrics_add(QUICPRO_METRIC_IIBIN_ENCODED_BYTES, total);
+    }
+    return rc;
+}
+
+int quicpro_iibin_encode_to_sink(const quicpro_iibin_compiled_schema_internal *schema, zval *data_zval, quicpro_iibin_sink *sink) {
+    uint64_t prof = quicpro_prof_begin();
+    int rc = encode_to_sink(schema, data_zval, sink);
+    quicpro_prof_end(QUICPRO_PROF_IIBIN_ENCODE, prof);
+    return rc;
+}
+
 /* --- PHP_FUNCTION Implementation --- */
 
 PHP_FUNCTION(quicpro_iibin_encode)
@@ -327,15 +688,107 @@ PHP_FUNCTION(quicpro_iibin_encode)
 
     smart_str bin_buf = {0};
 
-    if (encode_message_internal(&bin_buf, schema, php_data_zval) == FAILURE) {
+    if (quicpro_iibin_encode_message(&bin_buf, schema, php_data_zval) == FAILURE) {
         smart_str_free(&bin_buf);
         RETURN_FALSE; /* Exception was already thrown by an internal function */
     }
 
-    if (bin_buf.s) {
-        RETVAL_STR(bin_buf.s);
-    } else {
-        RETVAL_EMPTY_STRING();
+    /* smart_str_extract() terminates the string and hands over ownership; "" if nothing was written. */
+    RETVAL_STR(smart_str_extract(&bin_buf));
+}
+
+/*
+ * Quicpro\IIBIN::encodeMany(): one schema lookup and one call for a whole
+ * list. Each buffer starts at the size of the previous message, so runs of
+ * similar messages are encoded without regrowing.
+ */
+PHP_FUNCTION(quicpro_iibin_encode_many)
+{
+    char *schema_name_str;
+    size_t schema_name_len;
+    HashTable *messages;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_STRING(schema_name_str, schema_name_len)
+        Z_PARAM_ARRAY_HT(messages)
+    ZEND_PARSE_PARAMETERS_END();
+
+    const quicpro_iibin_compiled_schema_internal *schema = get_compiled_iibin_schema_internal(schema_name_str);
+    if (!schema) {
+        throw_iibin_error_as_php_exception(0, "Schema '%s' not defined for encoding.", schema_name_str);
+        RETURN_THROWS();
+    }
+
+    zend_ulong idx;
+    zend_string *key;
+    zval *message;
+    size_t hint = 0;
+
+    array_init_size(return_value, zend_hash_num_elements(messages));
+    ZEND_HASH_FOREACH_KEY_VAL(messages, idx, key, message) {
+        smart_str bin_buf = {0};
+        if (hint) {
+            smart_str_alloc(&bin_buf, hint, 0);
+        }
+        if (quicpro_iibin_encode_message(&bin_buf, schema, message) == FAILURE) {
+            smart_str_free(&bin_buf);
+            zval_ptr_dtor(return_value);
+            RETURN_NULL(); /* Exception was already thrown by an internal function */
+        }
+        hint = bin_buf.s ? ZSTR_LEN(bin_buf.s) : 0;
+        zval encoded;
+        ZVAL_STR(&encoded, smart_str_extract(&bin_buf));
+        if (key) {
+            zend_hash_update(Z_ARRVAL_P(return_value), key, &encoded);
+        } else {
+            zend_hash_index_update(Z_ARRVAL_P(return_value), idx, &encoded);
+        }
+    } ZEND_HASH_FOREACH_END();
+}
+
+/* A PHP stream as a sink. php_stream_write() blocks on blocking streams and may write short on others. */
+typedef struct {
+    quicpro_iibin_sink base;
+    php_stream        *stream;
+} iibin_php_stream_sink;
+
+static int php_stream_sink_write(quicpro_iibin_sink *sink, const uint8_t *data, size_t len) {
+    php_stream *stream = ((iibin_php_stream_sink *)sink)->stream;
+    while (len) {
+        ssize_t n = php_stream_write(stream, (const char *)data, len);
+        if (n <= 0) {
+            throw_iibin_error_as_php_exception(0, "Encoding failed: the stream accepted no more data.");
+            return FAILURE;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return SUCCESS;
+}
+
+PHP_FUNCTION(quicpro_iibin_encode_to_stream)
+{
+    char *schema_name_str;
+    size_t schema_name_len;
+    zval *php_data_zval;
+    zval *z_stream;
+
+    ZEND_PARSE_PARAMETERS_START(3, 3)
+        Z_PARAM_STRING(schema_name_str, schema_name_len)
+        Z_PARAM_ZVAL(php_data_zval)
+        Z_PARAM_RESOURCE(z_stream)
+    ZEND_PARSE_PARAMETERS_END();
+
+    const quicpro_iibin_compiled_schema_internal *schema = get_compiled_iibin_schema_internal(schema_name_str);
+    if (!schema) {
+        throw_iibin_error_as_php_exception(0, "Schema '%s' not defined for encoding.", schema_name_str);
+        RETURN_THROWS();
+    }
+    iibin_php_stream_sink sink = { .base.write = php_stream_sink_write };
+    php_stream_from_zval(sink.stream, z_stream);
+
+    if (quicpro_iibin_encode_to_sink(schema, php_data_zval, &sink.base) == FAILURE) {
+        RETURN_THROWS();
     }
-    /* Do not call smart_str_free(&bin_buf) if RETVAL_STR is used, as it takes ownership. */
+    RETURN_LONG((zend_long)sink.base.total);
 }
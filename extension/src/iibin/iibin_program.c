@@ -0,0 +1,123 @@
+/*
+ * src/iibin_program.c – Schema-to-Program Compiler for Quicpro\IIBIN
+ * ===================================================================
+ *
+ * Turns a compiled schema's field definitions into the flat instruction
+ * array described in iibin_internal.h. Runs once per schema, from
+ * quicpro_iibin_define_schema(). The interpreters in iibin_encoding.c and
+ * iibin_decoding.c then never touch a HashTable of the schema, never
+ * compare type names and never look up a nested schema by name.
+ */
+
+#include "php_quicpro.h"
+#include "iibin.h"
+#include "iibin_internal.h"
+#include "cancel.h"
+
+#include <zend_API.h>
+#include <zend_string.h>
+
+/*
+ * Field names become hash keys of every decoded array. Flagged as permanent
+ * interned strings (as the engine does for its own at startup), zend_hash_*
+ * skips the refcount on them, which is both faster and safe across ZTS
+ * threads. Their owner frees them explicitly, names in
+ * quicpro_iibin_free_program().
+ */
+zend_string *quicpro_iibin_permanent_string(const char *str, size_t len) {
+    zend_string *s = zend_string_init(str, len, 1);
+    zend_string_hash_val(s);
+    GC_SET_REFCOUNT(s, 1);
+    GC_TYPE_INFO(s) = GC_STRING | ((IS_STR_INTERNED | IS_STR_PERSISTENT | IS_STR_PERMANENT) << GC_FLAGS_SHIFT);
+    return s;
+}
+
+static uint8_t iibin_put_key(uint8_t *out, uint64_t key) {
+    uint8_t n = 0;
+    do {
+        out[n] = (uint8_t)(key & 0x7F);
+        key >>= 7;
+        if (key) {
+            out[n] |= 0x80;
+        }
+        n++;
+    } while (key && n < IIBIN_MAX_KEY_LEN);
+    return n;
+}
+
+int quicpro_iibin_compile_program(quicpro_iibin_compiled_schema_internal *schema) {
+    schema->program = NULL;
+    schema->by_tag = NULL;
+    schema->by_tag_len = 0;
+    schema->has_defaults_or_required = 0;
+    schema->has_nested = 0;
+    if (schema->num_fields == 0) {
+        return SUCCESS;
+    }
+
+    schema->program = pecalloc(schema->num_fields, sizeof(quicpro_iibin_insn), 1);
+
+    uint32_t max_dense_tag = 0;
+    for (size_t i = 0; i < schema->num_fields; i++) {
+        const quicpro_iibin_field_def_internal *field = schema->ordered_fields[i];
+        quicpro_iibin_insn *insn = &schema->program[i];
+
+        insn->op        = (uint8_t)quicpro_iibin_opcode_for_type(field->type);
+        insn->flags     = field->flags;
+        insn->tag       = field->tag;
+        insn->wire_type = quicpro_iibin_value_wire_type((quicpro_iibin_opcode)insn->op);
+        insn->key_len   = iibin_put_key(insn->key, ((uint64_t)field->tag << 3) | field->wire_type);
+        insn->field     = field;
+
+        insn->name = quicpro_iibin_permanent_string(field->name_in_php, strlen(field->name_in_php));
+
+        if (insn->op == IIBIN_OP_MESSAGE) {
+            schema->has_nested = 1;
+            insn->nested = get_compiled_iibin_schema_internal(field->message_type_name_if_nested);
+        } else if (insn->op == IIBIN_OP_ENUM) {
+            insn->enum_def = get_compiled_iibin_enum_internal(field->enum_type_name_if_enum);
+        }
+        if ((insn->op == IIBIN_OP_MESSAGE && !insn->nested) || (insn->op == IIBIN_OP_ENUM && !insn->enum_def)) {
+            throw_iibin_error_as_php_exception(0, "Schema '%s': Field '%s' refers to a type that is no longer defined.",
+                                               schema->schema_name, field->name_in_php);
+            quicpro_iibin_free_program(schema);
+            return FAILURE;
+        }
+
+        if ((field->flags & IIBIN_FIELD_FLAG_REQUIRED) || Z_TYPE(field->default_value_zval) != IS_UNDEF) {
+            schema->has_defaults_or_required = 1;
+        }
+        if (field->tag < IIBIN_DENSE_TAG_LIMIT && field->tag > max_dense_tag) {
+            max_dense_tag = field->tag;
+        }
+    }
+
+    /* Protobuf-style schemas number their fields from 1 without big gaps; those decode without a search. */
+    if (max_dense_tag > 0) {
+        schema->by_tag_len = max_dense_tag + 1;
+        schema->by_tag = pecalloc(schema->by_tag_len, sizeof(uint16_t), 1);
+        for (size_t i = 0; i < schema->num_fields; i++) {
+            if (schema->program[i].tag <= max_dense_tag) {
+                schema->by_tag[schema->program[i].tag] = (uint16_t)(i + 1);
+            }
+        }
+    }
+    return SUCCESS;
+}
+
+void quicpro_iibin_free_program(quicpro_iibin_compiled_schema_internal *schema) {
+    if (schema->program) {
+        for (size_t i = 0; i < schema->num_fields; i++) {
+            if (schema->program[i].name) {
+                pefree(schema->program[i].name, 1);
+            }
+        }
+        pefree(schema->program, 1);
+        schema->program = NULL;
+    }
+    if (schema->by_tag) {
+        pefree(schema->by_tag, 1);
+        schema->by_tag = NULL;
+    }
+    schema->by_tag_len = 0;
+}
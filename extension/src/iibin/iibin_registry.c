@@ -2,12 +2,37 @@
  * iibin_registry.c – Registry Lifecycle & Thread-Safety Utilities
  * ==============================================================
  *
- * Verwaltet die globalen HashTables für Schemas und Enums.
- * Achtet auf ZTS-Kompatibilität und Latenzarmes Locking.
+ * One name table holds every schema and enum. Names are unique across
+ * both kinds, so a single lookup answers either question.
+ *
+ * The table is written rarely (defineSchema/defineEnum, usually at
+ * bootstrap) and read on every encode and decode. Readers therefore take
+ * no lock. They load the published table with acquire semantics and
+ * probe it; every entry they can reach is immutable. Writers serialise on
+ * a mutex, build the entry off to the side and publish it with a single
+ * release store into an empty slot.
+ *
+ * A table that runs half full is copied into one of twice the size, which
+ * is then published in place of the old one. A reader may still be
+ * probing the old table at that moment, so it is not freed but chained
+ * behind the new one until MSHUTDOWN. The sizes double, so all retired
+ * tables together never outgrow the live one.
+ *
+ * A second table of the same kind finds schemas by their fingerprint
+ * (iibin_descriptor.c), the 32-bit ID MCP peers use instead of names. Its
+ * entries carry the ID as their hash and no name. On the rare collision
+ * the first schema keeps the ID; the later one is still found by name.
+ *
+ * Compiled schemas and enums live in persistent memory and are never
+ * removed before MSHUTDOWN. Pointers returned by the lookups, including
+ * the nested-schema pointers inside compiled programs, stay valid for the
+ * life of the process or thread pool.
  */
 #include "php_quicpro.h"
 #include "iibin_internal.h"
-#include <Zend/zend_smart_str.h>
+
+#include <stdatomic.h>
+#include <string.h>
 
 #ifdef ZTS
 # include <TSRM.h>
@@ -19,27 +44,181 @@ static MUTEX_T registry_mutex = NULL;
 # define REG_UNLOCK() /* noop */
 #endif
 
+#define IIBIN_REGISTRY_INITIAL_SLOTS 64
+
+typedef struct {
+    zend_ulong  h;
+    size_t      len;
+    zend_bool   is_enum;
+    void       *def;          /* quicpro_iibin_compiled_{schema,enum}_internal */
+    char        name[1];
+} iibin_registry_entry;
+
+typedef struct iibin_registry_table_s {
+    uint32_t                        mask;
+    uint32_t                        used;       /* Writer-only */
+    struct iibin_registry_table_s  *retired;    /* Previous, smaller table */
+    _Atomic(iibin_registry_entry *) slots[];
+} iibin_registry_table;
+
+static _Atomic(iibin_registry_table *) registry_table;
+static _Atomic(iibin_registry_table *) registry_ids;
+
+zend_bool quicpro_iibin_registries_initialized = 0;
+
+static iibin_registry_table *registry_table_alloc(uint32_t nslots)
+{
+    iibin_registry_table *t = pecalloc(1, sizeof(*t) + nslots * sizeof(t->slots[0]), 1);
+    t->mask = nslots - 1;
+    return t;
+}
+
+static const iibin_registry_entry *registry_find(const char *name, size_t len)
+{
+    iibin_registry_table *t = atomic_load_explicit(&registry_table, memory_order_acquire);
+    if (!t) {
+        return NULL;
+    }
+    zend_ulong h = zend_inline_hash_func(name, len);
+    for (uint32_t i = (uint32_t)h & t->mask;; i = (i + 1) & t->mask) {
+        iibin_registry_entry *e = atomic_load_explicit(&t->slots[i], memory_order_acquire);
+        if (!e) {
+            return NULL;
+        }
+        if (e->h == h && e->len == len && memcmp(e->name, name, len) == 0) {
+            return e;
+        }
+    }
+}
+
+/* Places an entry in the first free slot of its probe run. Caller holds the lock. */
+static void registry_place(iibin_registry_table *t, iibin_registry_entry *e)
+{
+    uint32_t i = (uint32_t)e->h & t->mask;
+    while (atomic_load_explicit(&t->slots[i], memory_order_relaxed)) {
+        i = (i + 1) & t->mask;
+    }
+    atomic_store_explicit(&t->slots[i], e, memory_order_release);
+    t->used++;
+}
+
+/* Makes room for one more entry in *root, publishing a grown copy if needed. Caller holds the lock. */
+static iibin_registry_table *registry_reserve(_Atomic(iibin_registry_table *) *root)
+{
+    iibin_registry_table *t = atomic_load_explicit(root, memory_order_relaxed);
+    if ((t->used + 1) * 2 > t->mask + 1) {
+        iibin_registry_table *grown = registry_table_alloc((t->mask + 1) * 2);
+        for (uint32_t i = 0; i <= t->mask; i++) {
+            iibin_registry_entry *e = atomic_load_explicit(&t->slots[i], memory_order_relaxed);
+            if (e) {
+                registry_place(grown, e);
+            }
+        }
+        grown->retired = t;
+        atomic_store_explicit(root, grown, memory_order_release);
+        t = grown;
+    }
+    return t;
+}
+
+static const iibin_registry_entry *registry_find_id(uint32_t id)
+{
+    iibin_registry_table *t = atomic_load_explicit(&registry_ids, memory_order_acquire);
+    if (!t) {
+        return NULL;
+    }
+    for (uint32_t i = id & t->mask;; i = (i + 1) & t->mask) {
+        iibin_registry_entry *e = atomic_load_explicit(&t->slots[i], memory_order_acquire);
+        if (!e || e->h == id) {
+            return e;
+        }
+    }
+}
+
+static int registry_add(const char *name, size_t len, void *def, zend_bool is_enum)
+{
+    REG_LOCK();
+    if (registry_find(name, len)) {
+        REG_UNLOCK();
+        return FAILURE;
+    }
+
+    iibin_registry_entry *e = pemalloc(sizeof(*e) + len, 1);
+    e->h = zend_inline_hash_func(name, len);
+    e->len = len;
+    e->is_enum = is_enum;
+    e->def = def;
+    memcpy(e->name, name, len);
+    e->name[len] = '\0';
+    registry_place(registry_reserve(&registry_table), e);
+
+    if (!is_enum) {
+        uint32_t id = ((quicpro_iibin_compiled_schema_internal *)def)->fingerprint;
+        if (!registry_find_id(id)) {
+            iibin_registry_entry *by_id = pemalloc(sizeof(*by_id), 1);
+            by_id->h = id;
+            by_id->len = 0;
+            by_id->is_enum = 0;
+            by_id->def = def;
+            by_id->name[0] = '\0';
+            registry_place(registry_reserve(&registry_ids), by_id);
+        }
+    }
+
+    REG_UNLOCK();
+    return SUCCESS;
+}
+
 /* --------------------------------------------------------------
- *  Public helpers (exportiert via iibin_internal.h)
+ *  Public helpers (exported via iibin_internal.h)
  * ------------------------------------------------------------*/
 const quicpro_iibin_compiled_schema_internal*
 get_compiled_iibin_schema_internal(const char *name)
 {
-    REG_LOCK();
-    const quicpro_iibin_compiled_schema_internal *ptr =
-        zend_hash_str_find_ptr(&quicpro_iibin_schema_registry, name, strlen(name));
-    REG_UNLOCK();
-    return ptr;
+    const iibin_registry_entry *e = registry_find(name, strlen(name));
+    return e && !e->is_enum ? e->def : NULL;
 }
 
 const quicpro_iibin_compiled_enum_internal*
 get_compiled_iibin_enum_internal(const char *name)
 {
-    REG_LOCK();
-    const quicpro_iibin_compiled_enum_internal *ptr =
-        zend_hash_str_find_ptr(&quicpro_iibin_enum_registry, name, strlen(name));
-    REG_UNLOCK();
-    return ptr;
+    const iibin_registry_entry *e = registry_find(name, strlen(name));
+    return e && e->is_enum ? e->def : NULL;
+}
+
+const quicpro_iibin_compiled_schema_internal *quicpro_iibin_schema_by_id(uint32_t id)
+{
+    const iibin_registry_entry *e = registry_find_id(id);
+    return e ? e->def : NULL;
+}
+
+zend_bool quicpro_iibin_registry_name_taken(const char *name, size_t len)
+{
+    return registry_find(name, len) != NULL;
+}
+
+void quicpro_iibin_registry_list(zval *into, zend_bool enums)
+{
+    iibin_registry_table *t = atomic_load_explicit(&registry_table, memory_order_acquire);
+    if (!t) {
+        return;
+    }
+    for (uint32_t i = 0; i <= t->mask; i++) {
+        iibin_registry_entry *e = atomic_load_explicit(&t->slots[i], memory_order_acquire);
+        if (e && e->is_enum == enums) {
+            add_next_index_stringl(into, e->name, e->len);
+        }
+    }
+}
+
+int quicpro_iibin_registry_add_schema(const char *name, size_t len, quicpro_iibin_compiled_schema_internal *schema)
+{
+    return registry_add(name, len, schema, 0);
+}
+
+int quicpro_iibin_registry_add_enum(const char *name, size_t len, quicpro_iibin_compiled_enum_internal *enum_def)
+{
+    return registry_add(name, len, enum_def, 1);
 }
 
 /* --------------------------------------------------------------
@@ -47,13 +226,12 @@ get_compiled_iibin_enum_internal(const char *name)
  * ------------------------------------------------------------*/
 int quicpro_iibin_registries_init(void)
 {
+    if (quicpro_iibin_registries_initialized) return SUCCESS;
 #ifdef ZTS
     if (!registry_mutex) registry_mutex = tsrm_mutex_alloc();
 #endif
-    zend_hash_init(&quicpro_iibin_schema_registry, 8, NULL,
-                   quicpro_iibin_compiled_schema_dtor_internal, 1);
-    zend_hash_init(&quicpro_iibin_enum_registry,   8, NULL,
-                   quicpro_iibin_compiled_enum_dtor_internal, 1);
+    atomic_store_explicit(&registry_table, registry_table_alloc(IIBIN_REGISTRY_INITIAL_SLOTS), memory_order_release);
+    atomic_store_explicit(&registry_ids, registry_table_alloc(IIBIN_REGISTRY_INITIAL_SLOTS), memory_order_release);
     quicpro_iibin_registries_initialized = 1;
     return SUCCESS;
 }
@@ -61,8 +239,39 @@ int quicpro_iibin_registries_init(void)
 void quicpro_iibin_registries_shutdown(void)
 {
     if (!quicpro_iibin_registries_initialized) return;
-    zend_hash_destroy(&quicpro_iibin_schema_registry);
-    zend_hash_destroy(&quicpro_iibin_enum_registry);
+    iibin_registry_table *t = atomic_exchange_explicit(&registry_table, NULL, memory_order_acq_rel);
+
+    for (uint32_t i = 0; i <= t->mask; i++) {
+        iibin_registry_entry *e = atomic_load_explicit(&t->slots[i], memory_order_relaxed);
+        if (!e) {
+            continue;
+        }
+        if (e->is_enum) {
+            quicpro_iibin_enum_free(e->def);
+        } else {
+            quicpro_iibin_schema_free(e->def);
+        }
+        pefree(e, 1);
+    }
+    while (t) {
+        iibin_registry_table *older = t->retired;
+        pefree(t, 1);
+        t = older;
+    }
+
+    /* The ID entries point at schemas freed above; only the entries are theirs */
+    t = atomic_exchange_explicit(&registry_ids, NULL, memory_order_acq_rel);
+    for (uint32_t i = 0; t && i <= t->mask; i++) {
+        iibin_registry_entry *e = atomic_load_explicit(&t->slots[i], memory_order_relaxed);
+        if (e) {
+            pefree(e, 1);
+        }
+    }
+    while (t) {
+        iibin_registry_table *older = t->retired;
+        pefree(t, 1);
+        t = older;
+    }
     quicpro_iibin_registries_initialized = 0;
 #ifdef ZTS
     if (registry_mutex) { tsrm_mutex_free(registry_mutex); registry_mutex = NULL; }
@@ -0,0 +1,376 @@
+/*
+ * src/iibin_shm.c – Shared-memory IIBIN message arena
+ * ====================================================
+ *
+ * Segment layout: a one-cache-line header, the per-block metadata, then
+ * the blocks themselves at cache-line boundaries. The free list is a
+ * Treiber stack of block indices (+1, so 0 is "empty") whose head carries
+ * a 32-bit pop counter against ABA. A block's generation is odd while it
+ * is allocated and even while it is free; releasing it is a CAS from the
+ * reference's generation to the next one, so a second release of the
+ * same reference fails.
+ */
+
+#include "php_quicpro.h"
+#include "iibin.h"
+#include "iibin_internal.h"
+#include "iibin_shm.h"
+#include "config/iibin/base_layer.h"
+#include "cancel.h"
+
+#include <zend_smart_str.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef ZTS
+# include <TSRM.h>
+static MUTEX_T shm_mutex = NULL;
+# define SHM_LOCK()   tsrm_mutex_lock(shm_mutex)
+# define SHM_UNLOCK() tsrm_mutex_unlock(shm_mutex)
+#else
+# define SHM_LOCK()   /* noop */
+# define SHM_UNLOCK() /* noop */
+#endif
+
+#define IIBIN_SHM_MAGIC      UINT64_C(0x314e494249495051)    /* "QPIIBIN1", little-endian */
+#define IIBIN_SHM_ALIGN      64
+#define IIBIN_SHM_MAX_BLOCK  ((UINT32_C(1) << 24) - 1)      /* Lengths get 24 bits of a reference */
+#define IIBIN_SHM_MAX_BLOCKS (UINT32_C(1) << 24)
+
+/*
+ * Reference: generation (low 15 bits) | block index (24) | length (24).
+ * Always positive as a zend_long, so it survives pack('J') and JSON alike.
+ */
+#define IIBIN_SHM_REF(gen, idx, len) ((((uint64_t)(gen) & 0x7FFF) << 48) | ((uint64_t)(idx) << 24) | (uint64_t)(len))
+#define IIBIN_SHM_REF_GEN(ref)       ((uint32_t)((ref) >> 48) & 0x7FFF)
+#define IIBIN_SHM_REF_IDX(ref)       ((uint32_t)((ref) >> 24) & 0xFFFFFF)
+#define IIBIN_SHM_REF_LEN(ref)       ((uint32_t)(ref) & 0xFFFFFF)
+
+typedef struct {
+    uint64_t          magic;          /* Written last by the process that laid the segment out */
+    uint32_t          block_size;
+    uint32_t          nblocks;
+    uint64_t          data_offset;
+    _Atomic uint64_t  free_head;      /* Pop counter << 32 | (index + 1) */
+    _Atomic uint32_t  in_use;
+} iibin_shm_header;
+
+typedef struct {
+    _Atomic uint32_t  next;           /* Index + 1 of the next free block */
+    _Atomic uint32_t  gen;            /* Odd while allocated */
+} iibin_shm_block;
+
+static iibin_shm_header *shm_seg = NULL;
+static size_t            shm_seg_size = 0;
+
+static inline iibin_shm_block *shm_blocks(iibin_shm_header *h)
+{
+    return (iibin_shm_block *)((char *)h + IIBIN_SHM_ALIGN);
+}
+
+static inline unsigned char *shm_block_data(iibin_shm_header *h, uint32_t idx)
+{
+    return (unsigned char *)h + h->data_offset + (size_t)idx * h->block_size;
+}
+
+/*──────────────────────────── Free list ──────────────────────────────────*/
+
+static uint32_t shm_pop(iibin_shm_header *h)
+{
+    iibin_shm_block *blocks = shm_blocks(h);
+    uint64_t head = atomic_load_explicit(&h->free_head, memory_order_acquire);
+    for (;;) {
+        uint32_t top = (uint32_t)head;
+        if (!top) {
+            return UINT32_MAX;
+        }
+        /* Possibly stale if another process popped `top` first; the counter then fails the CAS. */
+        uint32_t next = atomic_load_explicit(&blocks[top - 1].next, memory_order_relaxed);
+        uint64_t popped = (((head >> 32) + 1) << 32) | next;
+        if (atomic_compare_exchange_weak_explicit(&h->free_head, &head, popped, memory_order_acq_rel, memory_order_acquire)) {
+            return top - 1;
+        }
+    }
+}
+
+static void shm_push(iibin_shm_header *h, uint32_t idx)
+{
+    iibin_shm_block *blocks = shm_blocks(h);
+    uint64_t head = atomic_load_explicit(&h->free_head, memory_order_relaxed);
+    uint64_t pushed;
+    do {
+        atomic_store_explicit(&blocks[idx].next, (uint32_t)head, memory_order_relaxed);
+        pushed = (head & ~(uint64_t)UINT32_MAX) | (idx + 1);
+    } while (!atomic_compare_exchange_weak_explicit(&h->free_head, &head, pushed, memory_order_release, memory_order_relaxed));
+}
+
+/*──────────────────────────── Segment ────────────────────────────────────*/
+
+/* Lays out a fresh, zero-filled segment. The caller holds the segment's flock. */
+static void shm_layout(iibin_shm_header *h, size_t size, uint32_t block_size)
+{
+    size_t per_block = block_size + sizeof(iibin_shm_block);
+    size_t n = (size - 2 * IIBIN_SHM_ALIGN) / per_block;
+    if (n > IIBIN_SHM_MAX_BLOCKS) {
+        n = IIBIN_SHM_MAX_BLOCKS;
+    }
+    h->block_size = block_size;
+    h->nblocks = (uint32_t)n;
+    h->data_offset = (IIBIN_SHM_ALIGN + n * sizeof(iibin_shm_block) + IIBIN_SHM_ALIGN - 1) & ~(uint64_t)(IIBIN_SHM_ALIGN - 1);
+
+    /* Block 0 on top, so low blocks (and their pages) are reused first */
+    for (uint32_t i = h->nblocks; i-- > 0;) {
+        shm_push(h, i);
+    }
+    atomic_store_explicit(&h->in_use, 0, memory_order_relaxed);
+    h->magic = IIBIN_SHM_MAGIC;
+}
+
+static iibin_shm_header *shm_open_segment(void)
+{
+    iibin_shm_header *seg = shm_seg;
+    if (seg) {
+        return seg;
+    }
+    if (!quicpro_iibin_config.use_shared_memory_buffers) {
+        throw_iibin_error_as_php_exception(0, "Shared IIBIN buffers are disabled (quicpro.io_use_shared_memory_buffers).");
+        return NULL;
+    }
+
+    SHM_LOCK();
+    if (shm_seg) {
+        SHM_UNLOCK();
+        return shm_seg;
+    }
+
+    const char *path = quicpro_iibin_config.shm_path ? quicpro_iibin_config.shm_path : "/quicpro_io_shm";
+    size_t want = (size_t)quicpro_iibin_config.shm_total_memory_mb << 20;
+    uint64_t block_kb = (uint64_t)quicpro_iibin_config.default_buffer_size_kb;
+    uint32_t block_size = block_kb << 10 > IIBIN_SHM_MAX_BLOCK ? IIBIN_SHM_MAX_BLOCK : (uint32_t)(block_kb << 10);
+    block_size &= ~(uint32_t)(IIBIN_SHM_ALIGN - 1);
+
+    int fd = shm_open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        SHM_UNLOCK();
+        throw_iibin_error_as_php_exception(0, "Cannot open shared IIBIN segment '%s': %s", path, strerror(errno));
+        return NULL;
+    }
+    /* Serialises the first layout against other processes opening the segment */
+    flock(fd, LOCK_EX);
+
+    struct stat st;
+    const char *failed = NULL;
+    if (fstat(fd, &st) != 0) {
+        failed = "fstat";
+    } else if (st.st_size > 0 && (size_t)st.st_size < 2 * IIBIN_SHM_ALIGN) {
+        failed = "layout";
+    } else if (st.st_size == 0) {
+        if (block_size == 0 || want < 2 * IIBIN_SHM_ALIGN + block_size + sizeof(iibin_shm_block)) {
+            failed = "size";
+        } else if (ftruncate(fd, (off_t)want) != 0) {
+            failed = "ftruncate";
+        } else {
+            st.st_size = (off_t)want;
+        }
+    }
+
+    void *mem = MAP_FAILED;
+    if (!failed) {
+        mem = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mem == MAP_FAILED) {
+            failed = "mmap";
+        }
+    }
+    if (!failed) {
+        iibin_shm_header *h = mem;
+        if (h->magic == 0) {
+            shm_layout(h, (size_t)st.st_size, block_size);
+        } else if (h->magic != IIBIN_SHM_MAGIC
+                   || h->data_offset + (uint64_t)h->nblocks * h->block_size > (uint64_t)st.st_size) {
+            munmap(mem, (size_t)st.st_size);
+            failed = "layout";
+        }
+    }
+    int saved_errno = errno;
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    if (failed) {
+        SHM_UNLOCK();
+        throw_iibin_error_as_php_exception(0, "Cannot map shared IIBIN segment '%s' (%s): %s", path, failed,
+                                           strcmp(failed, "layout") == 0 ? "not an IIBIN segment" :
+                                           strcmp(failed, "size") == 0 ? "quicpro.io_shm_total_memory_mb holds no block" : strerror(saved_errno));
+        return NULL;
+    }
+    shm_seg_size = (size_t)st.st_size;
+    shm_seg = mem;
+    SHM_UNLOCK();
+    return shm_seg;
+}
+
+/* The block behind `ref` if it is still the allocation the reference was made for */
+static int shm_resolve(iibin_shm_header *h, zend_long ref, uint32_t *idx_out, uint32_t *gen_out)
+{
+    uint64_t r = (uint64_t)ref;
+    uint32_t idx = IIBIN_SHM_REF_IDX(r);
+    if (ref < 0 || idx >= h->nblocks || IIBIN_SHM_REF_LEN(r) > h->block_size) {
+        throw_iibin_error_as_php_exception(0, "Invalid shared IIBIN reference " ZEND_LONG_FMT ".", ref);
+        return FAILURE;
+    }
+    uint32_t gen = atomic_load_explicit(&shm_blocks(h)[idx].gen, memory_order_acquire);
+    if (!(gen & 1) || (gen & 0x7FFF) != IIBIN_SHM_REF_GEN(r)) {
+        throw_iibin_error_as_php_exception(0, "Shared IIBIN reference " ZEND_LONG_FMT " was already released.", ref);
+        return FAILURE;
+    }
+    *idx_out = idx;
+    *gen_out = gen;
+    return SUCCESS;
+}
+
+static int shm_release(iibin_shm_header *h, zend_long ref)
+{
+    uint32_t idx, gen;
+    if (shm_resolve(h, ref, &idx, &gen) == FAILURE) {
+        return FAILURE;
+    }
+    if (!atomic_compare_exchange_strong_explicit(&shm_blocks(h)[idx].gen, &gen, gen + 1, memory_order_acq_rel, memory_order_relaxed)) {
+        throw_iibin_error_as_php_exception(0, "Shared IIBIN reference " ZEND_LONG_FMT " was already released.", ref);
+        return FAILURE;
+    }
+    atomic_fetch_sub_explicit(&h->in_use, 1, memory_order_relaxed);
+    shm_push(h, idx);
+    return SUCCESS;
+}
+
+/*──────────────────────────── Life cycle ─────────────────────────────────*/
+
+void quicpro_iibin_shm_minit(void)
+{
+#ifdef ZTS
+    if (!shm_mutex) shm_mutex = tsrm_mutex_alloc();
+#endif
+}
+
+void quicpro_iibin_shm_mshutdown(void)
+{
+    if (shm_seg) {
+        munmap(shm_seg, shm_seg_size);
+        shm_seg = NULL;
+        shm_seg_size = 0;
+    }
+#ifdef ZTS
+    if (shm_mutex) { tsrm_mutex_free(shm_mutex); shm_mutex = NULL; }
+#endif
+}
+
+/*──────────────────────────── PHP functions ──────────────────────────────*/
+
+PHP_FUNCTION(quicpro_iibin_encode_shared)
+{
+    char *schema_name_str;
+    size_t schema_name_len;
+    zval *php_data_zval;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_STRING(schema_name_str, schema_name_len)
+        Z_PARAM_ZVAL(php_data_zval)
+    ZEND_PARSE_PARAMETERS_END();
+
+    const quicpro_iibin_compiled_schema_internal *schema = get_compiled_iibin_schema_internal(schema_name_str);
+    if (!schema) {
+        throw_iibin_error_as_php_exception(0, "Schema '%s' not defined for encoding.", schema_name_str);
+        RETURN_THROWS();
+    }
+    iibin_shm_header *h = shm_open_segment();
+    if (!h) {
+        RETURN_THROWS();
+    }
+
+    /* Sized for a full block up front, so the encoder never grows the buffer for a message that fits */
+    smart_str bin_buf = {0};
+    smart_str_alloc(&bin_buf, h->block_size, 0);
+    if (quicpro_iibin_encode_message(&bin_buf, schema, php_data_zval) == FAILURE) {
+        smart_str_free(&bin_buf);
+        RETURN_THROWS();
+    }
+    size_t len = bin_buf.s ? ZSTR_LEN(bin_buf.s) : 0;
+    if (len > h->block_size) {
+        smart_str_free(&bin_buf);
+        RETURN_NULL();   /* Too big for a block: send it inline */
+    }
+
+    uint32_t idx = shm_pop(h);
+    if (idx == UINT32_MAX) {
+        smart_str_free(&bin_buf);
+        RETURN_NULL();   /* Arena exhausted */
+    }
+    if (len) {
+        memcpy(shm_block_data(h, idx), ZSTR_VAL(bin_buf.s), len);
+    }
+    smart_str_free(&bin_buf);
+
+    /* Even → odd; the release store publishes the bytes to whoever decodes the reference */
+    uint32_t gen = atomic_fetch_add_explicit(&shm_blocks(h)[idx].gen, 1, memory_order_release) + 1;
+    atomic_fetch_add_explicit(&h->in_use, 1, memory_order_relaxed);
+    RETURN_LONG((zend_long)IIBIN_SHM_REF(gen, idx, len));
+}
+
+PHP_FUNCTION(quicpro_iibin_decode_shared)
+{
+    char *schema_name_str;
+    size_t schema_name_len;
+    zend_long ref;
+    zend_bool decode_as_object = 0;
+    zend_bool release = 1;
+
+    ZEND_PARSE_PARAMETERS_START(2, 4)
+        Z_PARAM_STRING(schema_name_str, schema_name_len)
+        Z_PARAM_LONG(ref)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_BOOL(decode_as_object)
+        Z_PARAM_BOOL(release)
+    ZEND_PARSE_PARAMETERS_END();
+
+    const quicpro_iibin_compiled_schema_internal *schema = get_compiled_iibin_schema_internal(schema_name_str);
+    if (!schema) {
+        throw_iibin_error_as_php_exception(0, "Schema '%s' not defined for decoding.", schema_name_str);
+        RETURN_THROWS();
+    }
+    iibin_shm_header *h = shm_open_segment();
+    uint32_t idx, gen;
+    if (!h || shm_resolve(h, ref, &idx, &gen) == FAILURE) {
+        RETURN_THROWS();
+    }
+
+    int rc = quicpro_iibin_decode_message(shm_block_data(h, idx), IIBIN_SHM_REF_LEN((uint64_t)ref), schema, return_value, decode_as_object);
+    /* A message that fails to decode is released all the same; it would never decode later */
+    if (release && shm_release(h, ref) == FAILURE && rc == SUCCESS) {
+        zval_ptr_dtor(return_value);
+        RETURN_THROWS();
+    }
+    if (rc == FAILURE) {
+        RETURN_THROWS();
+    }
+}
+
+PHP_FUNCTION(quicpro_iibin_release_shared)
+{
+    zend_long ref;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_LONG(ref)
+    ZEND_PARSE_PARAMETERS_END();
+
+    iibin_shm_header *h = shm_open_segment();
+    if (!h || shm_release(h, ref) == FAILURE) {
+        RETURN_THROWS();
+    }
+    RETURN_TRUE;
+}
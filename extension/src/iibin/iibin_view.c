@@ -0,0 +1,463 @@
+/*
+ * src/iibin_view.c – Lazily decoded Quicpro\IIBIN\View messages
+ * ==============================================================
+ *
+ * A view is the encoded string, a per-field index of first occurrences
+ * (built on the first read) and an array of the fields decoded so far.
+ * The decoded array doubles as the store for assignments: a field found
+ * there is never read from the buffer again, and a NULL stands for a
+ * field that is absent or was unset.
+ */
+
+#include "php_quicpro.h"
+#include "iibin.h"
+#include "iibin_internal.h"
+#include "iibin_view.h"
+#include "cancel.h"
+
+#include <zend_exceptions.h>
+#include <zend_interfaces.h>
+#include <zend_smart_str.h>
+#include <string.h>
+
+typedef struct {
+    const quicpro_iibin_compiled_schema_internal *schema;
+    zend_string *buf;          /* The encoded message, referenced */
+    uint32_t    *first;        /* Per instruction: offset of its first key + 1, 0 if absent. NULL until indexed */
+    zval         fields;       /* Decoded or assigned fields by name. UNDEF until the first read */
+    zend_bool    modified;
+    zend_object  std;
+} quicpro_iibin_view_object;
+
+zend_class_entry *quicpro_ce_iibin_view;
+static zend_object_handlers quicpro_iibin_view_handlers;
+
+static inline quicpro_iibin_view_object *view_from_obj(zend_object *obj)
+{
+    return (quicpro_iibin_view_object *)((char *)obj - XtOffsetOf(quicpro_iibin_view_object, std));
+}
+
+#define THIS_VIEW() view_from_obj(Z_OBJ_P(ZEND_THIS))
+
+/*──────────────────────────── Index ──────────────────────────────────────*/
+
+/* One pass over the keys: nothing is decoded, values are only stepped over. */
+static int view_index(quicpro_iibin_view_object *v)
+{
+    if (v->first) {
+        return SUCCESS;
+    }
+    const quicpro_iibin_compiled_schema_internal *schema = v->schema;
+    uint32_t *first = ecalloc(schema->num_fields ? schema->num_fields : 1, sizeof(uint32_t));
+    const unsigned char *base = (const unsigned char *)ZSTR_VAL(v->buf);
+    const unsigned char *p = base, *end = base + ZSTR_LEN(v->buf);
+
+    while (p < end) {
+        const unsigned char *at = p;
+        uint64_t key;
+        if (!quicpro_iibin_decode_varint(&p, end, &key)) {
+            throw_iibin_error_as_php_exception(0, "Decoding error: malformed tag/wire_type varint in schema '%s'.", schema->schema_name);
+            efree(first);
+            return FAILURE;
+        }
+        uint32_t tag = (uint32_t)(key >> 3);
+        if (!quicpro_iibin_skip_field(&p, end, (uint32_t)(key & 0x7))) {
+            throw_iibin_error_as_php_exception(0, "Decoding error: truncated or malformed value for tag %u in schema '%s'.", tag, schema->schema_name);
+            efree(first);
+            return FAILURE;
+        }
+        const quicpro_iibin_insn *insn = tag ? quicpro_iibin_insn_by_tag(schema, tag) : NULL;
+        if (insn && !first[insn - schema->program]) {
+            first[insn - schema->program] = (uint32_t)(at - base) + 1;
+        }
+    }
+
+    for (size_t i = 0; i < schema->num_fields; i++) {
+        const quicpro_iibin_insn *insn = &schema->program[i];
+        if (!first[i] && (insn->flags & IIBIN_FIELD_FLAG_REQUIRED)) {
+            throw_iibin_error_as_php_exception(0, "Decoding error: Required field '%s' (tag %u) not found in payload for schema '%s'.", ZSTR_VAL(insn->name), insn->tag, schema->schema_name);
+            efree(first);
+            return FAILURE;
+        }
+    }
+    v->first = first;
+    return SUCCESS;
+}
+
+/*──────────────────────────── Fields ─────────────────────────────────────*/
+
+static const quicpro_iibin_insn *view_insn(quicpro_iibin_view_object *v, zend_string *name)
+{
+    zval *field = zend_hash_find(&v->schema->fields_by_name, name);
+    if (!field) {
+        throw_iibin_error_as_php_exception(0, "Schema '%s' has no field '%s'.", v->schema->schema_name, ZSTR_VAL(name));
+        return NULL;
+    }
+    const quicpro_iibin_field_def_internal *def = Z_PTR_P(field);
+    return quicpro_iibin_insn_by_tag(v->schema, def->tag);
+}
+
+static HashTable *view_fields(quicpro_iibin_view_object *v)
+{
+    if (Z_TYPE(v->fields) == IS_UNDEF) {
+        array_init_size(&v->fields, (uint32_t)v->schema->num_fields);
+    }
+    return Z_ARRVAL(v->fields);
+}
+
+/* The field's value, decoded on first use; NULL after throwing. An absent field without default reads as IS_NULL. */
+static zval *view_field(quicpro_iibin_view_object *v, const quicpro_iibin_insn *insn)
+{
+    HashTable *fields = view_fields(v);
+    zval *value = zend_hash_find_known_hash(fields, insn->name);
+    if (value) {
+        return value;
+    }
+    if (view_index(v) == FAILURE) {
+        return NULL;
+    }
+
+    uint32_t at = v->first[insn - v->schema->program];
+    if (at) {
+        const unsigned char *base = (const unsigned char *)ZSTR_VAL(v->buf);
+        if (quicpro_iibin_decode_field(base + at - 1, base + ZSTR_LEN(v->buf), v->schema, insn, fields) == FAILURE) {
+            zend_hash_del(fields, insn->name);
+            return NULL;
+        }
+        return zend_hash_find_known_hash(fields, insn->name);
+    }
+
+    zval absent;
+    if (Z_TYPE(insn->field->default_value_zval) != IS_UNDEF) {
+        ZVAL_COPY(&absent, &insn->field->default_value_zval);
+    } else {
+        ZVAL_NULL(&absent);
+    }
+    return zend_hash_add_new(fields, insn->name, &absent);
+}
+
+/* What IIBIN::decode() returns, with fields in tag order. */
+static int view_to_array(quicpro_iibin_view_object *v, zval *out)
+{
+    array_init_size(out, (uint32_t)v->schema->num_fields);
+    for (size_t i = 0; i < v->schema->num_fields; i++) {
+        const quicpro_iibin_insn *insn = &v->schema->program[i];
+        zval *value = view_field(v, insn);
+        if (!value) {
+            zval_ptr_dtor(out);
+            ZVAL_UNDEF(out);
+            return FAILURE;
+        }
+        if (Z_TYPE_P(value) != IS_NULL) {
+            Z_TRY_ADDREF_P(value);
+            zend_hash_add_new(Z_ARRVAL_P(out), insn->name, value);
+        }
+    }
+    return SUCCESS;
+}
+
+/*──────────────────────────── Life cycle ─────────────────────────────────*/
+
+static zend_object *view_create(zend_class_entry *ce)
+{
+    quicpro_iibin_view_object *v = zend_object_alloc(sizeof(quicpro_iibin_view_object), ce);
+    zend_object_std_init(&v->std, ce);
+    object_properties_init(&v->std, ce);
+    v->std.handlers = &quicpro_iibin_view_handlers;
+
+    v->schema = NULL;
+    v->buf = NULL;
+    v->first = NULL;
+    ZVAL_UNDEF(&v->fields);
+    v->modified = 0;
+    return &v->std;
+}
+
+static void view_free_obj(zend_object *obj)
+{
+    quicpro_iibin_view_object *v = view_from_obj(obj);
+    if (v->buf) {
+        zend_string_release(v->buf);
+    }
+    if (v->first) {
+        efree(v->first);
+    }
+    zval_ptr_dtor(&v->fields);
+    zend_object_std_dtor(obj);
+}
+
+/* Views start from IIBIN::decodeView() only; a bare `new` would have no schema */
+static int view_ready(quicpro_iibin_view_object *v)
+{
+    if (!v->schema) {
+        throw_iibin_error_as_php_exception(0, "Quicpro\\IIBIN\\View is created by IIBIN::decodeView().");
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+PHP_FUNCTION(quicpro_iibin_decode_view)
+{
+    char *schema_name_str;
+    size_t schema_name_len;
+    zend_string *binary_data;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_STRING(schema_name_str, schema_name_len)
+        Z_PARAM_STR(binary_data)
+    ZEND_PARSE_PARAMETERS_END();
+
+    const quicpro_iibin_compiled_schema_internal *schema = get_compiled_iibin_schema_internal(schema_name_str);
+    if (!schema) {
+        throw_iibin_error_as_php_exception(0, "Schema '%s' not defined for decoding.", schema_name_str);
+        RETURN_THROWS();
+    }
+    if (ZSTR_LEN(binary_data) >= UINT32_MAX) {
+        zend_argument_value_error(2, "must be shorter than 4 GiB");
+        RETURN_THROWS();
+    }
+
+    quicpro_iibin_view_init(return_value, schema, binary_data);
+}
+
+void quicpro_iibin_view_init(zval *out, const quicpro_iibin_compiled_schema_internal *schema, zend_string *buf)
+{
+    object_init_ex(out, quicpro_ce_iibin_view);
+    quicpro_iibin_view_object *v = view_from_obj(Z_OBJ_P(out));
+    v->schema = schema;
+    v->buf = zend_string_copy(buf);
+}
+
+/*──────────────────────────── Methods ────────────────────────────────────*/
+
+PHP_METHOD(QuicproIIBINView, get)
+{
+    zend_string *name;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_iibin_view_object *v = THIS_VIEW();
+    if (view_ready(v) == FAILURE) RETURN_THROWS();
+    const quicpro_iibin_insn *insn = view_insn(v, name);
+    zval *value = insn ? view_field(v, insn) : NULL;
+    if (!value) RETURN_THROWS();
+    RETURN_COPY(value);
+}
+
+/* Whether the field is on the wire (or was assigned), without decoding it */
+PHP_METHOD(QuicproIIBINView, has)
+{
+    zend_string *name;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_iibin_view_object *v = THIS_VIEW();
+    if (view_ready(v) == FAILURE) RETURN_THROWS();
+    const quicpro_iibin_insn *insn = view_insn(v, name);
+    if (!insn) RETURN_THROWS();
+
+    if (v->modified && Z_TYPE(v->fields) != IS_UNDEF) {
+        zval *value = zend_hash_find_known_hash(Z_ARRVAL(v->fields), insn->name);
+        if (value) {
+            RETURN_BOOL(Z_TYPE_P(value) != IS_NULL);
+        }
+    }
+    if (view_index(v) == FAILURE) RETURN_THROWS();
+    RETURN_BOOL(v->first[insn - v->schema->program] != 0);
+}
+
+PHP_METHOD(QuicproIIBINView, toArray)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_iibin_view_object *v = THIS_VIEW();
+    if (view_ready(v) == FAILURE || view_to_array(v, return_value) == FAILURE) RETURN_THROWS();
+}
+
+/* The original bytes while nothing was assigned; otherwise the message encoded again */
+PHP_METHOD(QuicproIIBINView, encode)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_iibin_view_object *v = THIS_VIEW();
+    if (view_ready(v) == FAILURE) RETURN_THROWS();
+    if (!v->modified) {
+        RETURN_STR_COPY(v->buf);
+    }
+
+    zval message;
+    if (view_to_array(v, &message) == FAILURE) RETURN_THROWS();
+    smart_str out = {0};
+    int rc = quicpro_iibin_encode_message(&out, v->schema, &message);
+    zval_ptr_dtor(&message);
+    if (rc == FAILURE) {
+        smart_str_free(&out);
+        RETURN_THROWS();
+    }
+    RETURN_STR(smart_str_extract(&out));
+}
+
+PHP_METHOD(QuicproIIBINView, schemaName)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_iibin_view_object *v = THIS_VIEW();
+    if (view_ready(v) == FAILURE) RETURN_THROWS();
+    RETURN_STRING(v->schema->schema_name);
+}
+
+/*──────────────────────────── ArrayAccess ────────────────────────────────*/
+
+PHP_METHOD(QuicproIIBINView, offsetExists)
+{
+    zval *offset;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ZVAL(offset)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_iibin_view_object *v = THIS_VIEW();
+    if (view_ready(v) == FAILURE) RETURN_THROWS();
+    zend_string *key = zval_get_string(offset);
+    /* isset() semantics: unknown fields are simply not set */
+    zval *field = zend_hash_find(&v->schema->fields_by_name, key);
+    zend_string_release(key);
+    if (!field) {
+        RETURN_FALSE;
+    }
+    zval *value = view_field(v, quicpro_iibin_insn_by_tag(v->schema, ((const quicpro_iibin_field_def_internal *)Z_PTR_P(field))->tag));
+    if (!value) RETURN_THROWS();
+    RETURN_BOOL(Z_TYPE_P(value) != IS_NULL);
+}
+
+PHP_METHOD(QuicproIIBINView, offsetGet)
+{
+    zval *offset;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ZVAL(offset)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_iibin_view_object *v = THIS_VIEW();
+    if (view_ready(v) == FAILURE) RETURN_THROWS();
+    zend_string *key = zval_get_string(offset);
+    const quicpro_iibin_insn *insn = view_insn(v, key);
+    zend_string_release(key);
+    zval *value = insn ? view_field(v, insn) : NULL;
+    if (!value) RETURN_THROWS();
+    RETURN_COPY(value);
+}
+
+PHP_METHOD(QuicproIIBINView, offsetSet)
+{
+    zval *offset, *value;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_ZVAL(offset)
+        Z_PARAM_ZVAL(value)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_iibin_view_object *v = THIS_VIEW();
+    if (view_ready(v) == FAILURE) RETURN_THROWS();
+    if (Z_TYPE_P(offset) == IS_NULL) {
+        zend_argument_value_error(1, "must be a field name, views cannot be appended to");
+        RETURN_THROWS();
+    }
+    zend_string *key = zval_get_string(offset);
+    const quicpro_iibin_insn *insn = view_insn(v, key);
+    zend_string_release(key);
+    if (!insn) RETURN_THROWS();
+
+    /* Types are checked by encode(), as for IIBIN::encode() */
+    Z_TRY_ADDREF_P(value);
+    zend_hash_update(view_fields(v), insn->name, value);
+    v->modified = 1;
+}
+
+PHP_METHOD(QuicproIIBINView, offsetUnset)
+{
+    zval *offset;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ZVAL(offset)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_iibin_view_object *v = THIS_VIEW();
+    if (view_ready(v) == FAILURE) RETURN_THROWS();
+    zend_string *key = zval_get_string(offset);
+    const quicpro_iibin_insn *insn = view_insn(v, key);
+    zend_string_release(key);
+    if (!insn) RETURN_THROWS();
+
+    zval absent;
+    ZVAL_NULL(&absent);
+    zend_hash_update(view_fields(v), insn->name, &absent);
+    v->modified = 1;
+}
+
+/*──────────────────────────── Registration ───────────────────────────────*/
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_view_get, 0, 1, IS_MIXED, 0)
+    ZEND_ARG_TYPE_INFO(0, field, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_view_has, 0, 1, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, field, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_view_to_array, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_view_encode, 0, 0, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_quicpro_iibin_view_schema_name arginfo_quicpro_iibin_view_encode
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_view_offset_exists, 0, 1, _IS_BOOL, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_view_offset_get, 0, 1, IS_MIXED, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_view_offset_set, 0, 2, IS_VOID, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+    ZEND_ARG_TYPE_INFO(0, value, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_iibin_view_offset_unset, 0, 1, IS_VOID, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry quicpro_iibin_view_methods[] = {
+    PHP_ME(QuicproIIBINView, get,          arginfo_quicpro_iibin_view_get,           ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINView, has,          arginfo_quicpro_iibin_view_has,           ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINView, toArray,      arginfo_quicpro_iibin_view_to_array,      ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINView, encode,       arginfo_quicpro_iibin_view_encode,        ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINView, schemaName,   arginfo_quicpro_iibin_view_schema_name,   ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINView, offsetExists, arginfo_quicpro_iibin_view_offset_exists, ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINView, offsetGet,    arginfo_quicpro_iibin_view_offset_get,    ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINView, offsetSet,    arginfo_quicpro_iibin_view_offset_set,    ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproIIBINView, offsetUnset,  arginfo_quicpro_iibin_view_offset_unset,  ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+void quicpro_iibin_view_minit(void)
+{
+    zend_class_entry ce;
+    INIT_NS_CLASS_ENTRY(ce, "Quicpro\\IIBIN", "View", quicpro_iibin_view_methods);
+    quicpro_ce_iibin_view = zend_register_internal_class(&ce);
+    quicpro_ce_iibin_view->ce_flags |= ZEND_ACC_FINAL;
+#ifdef ZEND_ACC_NO_DYNAMIC_PROPERTIES
+    quicpro_ce_iibin_view->ce_flags |= ZEND_ACC_NO_DYNAMIC_PROPERTIES;
+#endif
+    quicpro_ce_iibin_view->create_object = view_create;
+    zend_class_implements(quicpro_ce_iibin_view, 1, zend_ce_arrayaccess);
+
+    memcpy(&quicpro_iibin_view_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    quicpro_iibin_view_handlers.offset = XtOffsetOf(quicpro_iibin_view_object, std);
+    quicpro_iibin_view_handlers.free_obj = view_free_obj;
+    quicpro_iibin_view_handlers.clone_obj = NULL;
+}
@@ -13,19 +13,160 @@
 #include "mcp.h"
 #include "config.h"             /* For quicpro_cfg_t and qp_fetch_cfg */
 #include "session.h"            /* For quicpro_session_t */
-#include "proto_internal.h"     /* For direct access to compiled schema structs */
+#include "iibin/iibin_internal.h" /* Streams IIBIN request messages into the H3 body */
 #include "cancel.h"             /* For error throwing helpers */
 #include "http3.h"              /* For reusing H3 logic if MCP is on H3 */
+#include "poll/poll.h"          /* quicpro_session_pump_rx()/_tx() */
+#include "poll/scheduler.h"     /* Fiber parking while the response is pending */
+#include "client/session.h"     /* quicpro_client_session_open() */
+#include "client/pool.h"        /* Warm connections shared across connects */
+#include "client/mux.h"         /* Hands other streams' events to the multiplexer */
+#include "client/body.h"        /* Response bodies received in place */
+#include "mcp/mcp_breaker.h"     /* Fails calls fast while their target is degraded */
+#include "server/open_telemetry.h" /* Client spans, traceparent on every call */
+#include "server/profiler.h" /* Hot path timers */
+#include "server/cancel.h"   /* Calls end with the request they serve */
+#include "config/quic_transport/base_layer.h"
+#include "config/high_perf_compute_and_ai/base_layer.h"
+#include "dataframe/dataframe.h" /* DataFrame payloads and responses */
+#include "dataframe/arrow_ipc.h" /* ... which travel as Arrow IPC streams */
+#include "gpu/device.h"           /* Tensor responses go to the GPU */
+#include "gpu/tensor.h"           /* ... through pinned buffers */
+#include "ext/standard/base64.h" /* IIBIN descriptors travel in a header */
 
 #include <quiche.h>
 #include <zend_API.h>
 #include <zend_exceptions.h>
 #include <zend_smart_str.h>
 #include <zend_string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+extern int le_quicpro_session;
+extern int le_quicpro_cfg;
+
+#define MCP_H3_REQUEST_CANCELLED 0x10c           /* RFC 9114 error code */
+#define MCP_TRANSFER_CHUNK       (64 * 1024)     /* Read buffer of a streaming transfer */
+#define MCP_TRANSFER_WINDOW      (1024 * 1024)   /* mmap() window of an uploaded file */
+#define MCP_TIMEOUT_HEADER       "quicpro-timeout-ms" /* What is left of the caller's deadline */
+#define MCP_LATENCY_SLOTS        64              /* Methods whose response times are kept, per worker */
+#define MCP_LATENCY_SAMPLES      64              /* Newest response times kept per method */
+#define MCP_LATENCY_MIN_SAMPLES  16              /* Fewer: no p95 yet, so no hedge */
+#define MCP_HEDGE_SLICE_MS       5               /* A parked Fiber's look at the second connection */
 
 /* --- Static Helper Function Prototypes --- */
 /* A helper to run a polling loop for a specific stream until a response is complete or timeout occurs. */
-static int mcp_poll_for_response(quicpro_session_t *session, uint64_t stream_id, smart_str *response_body_buf, zend_long timeout_ms);
+typedef struct mcp_transfer_s mcp_transfer_t;
+
+/*
+ * One RPC as sent on the wire, kept so it can go out again: a call sent as
+ * 0-RTT data is resent once if the server turns the early data down.
+ */
+typedef struct {
+    quiche_h3_header  headers[12];
+    size_t            header_count;
+    const char       *service_name;
+    const uint8_t    *payload;
+    size_t            payload_len;
+    /* Set instead of payload: the request is encoded straight into the stream */
+    const quicpro_iibin_compiled_schema_internal *schema;
+    zval             *message;
+    /* Set instead of payload: the request is a DataFrame, sent from its column memory */
+    zend_object      *frame;
+    zend_long         deadline_ms;    /* mcp_now_ms() clock; 0: none */
+    size_t            timeout_header; /* headers[] index of quicpro-timeout-ms; 0: none */
+    char              timeout_value[24];
+    bool              sent_early;
+    /* The request's IIBIN schema, announced by ID and described until the peer knows it */
+    const quicpro_iibin_compiled_schema_internal *described;
+    char              schema_id[9];
+    zend_string      *descriptor_b64;
+    bool              schema_unknown; /* The peer's response asked for the descriptor */
+    bool              arrow;          /* The response is an Arrow IPC stream */
+    /* A tensor response: received into pinned buffers and copied to the GPU as they fill */
+    quicpro_gpu_tensor_head_t tensor_head;
+    quicpro_gpu_upload_t *upload;
+    /* In flight: filed under stream_id in the session's table until an event ends it */
+    int64_t           stream_id;      /* -1 while not in flight */
+    smart_str         response;
+    zend_string      *error;          /* Why it failed, from whichever caller read the event */
+    bool              done;
+    bool              replay;         /* The server turned the early data down */
+    bool              resend;         /* The peer asked for the descriptor */
+    bool              parked;         /* The caller that made it waits in mcp_wait_io() */
+    mcp_transfer_t   *sink;           /* Download: the response body goes here instead of `response` */
+    /* Streamed: sees `response` grow, from chunk_seen on */
+    quicpro_mcp_chunk_fn on_chunk;
+    void             *chunk_arg;
+    size_t            chunk_seen;
+} mcp_call_t;
+
+/*
+ * The calls in flight on one session. Whichever caller reads the session's
+ * HTTP/3 events files each one under the call that owns its stream, so
+ * calls made from several Fibers share the connection and complete in
+ * whatever order their responses arrive.
+ */
+struct quicpro_mcp_inflight_s {
+    HashTable streams;   /* stream ID → mcp_call_t *, not owning: each lives in its caller's frame */
+};
+
+/* The deadline of the MCP request this worker is serving, see quicpro_mcp_deadline_enter(); 0: none */
+static ZEND_TLS zend_long mcp_inherited_deadline_ms;
+
+/* See quicpro_mcp_call_transient() */
+static ZEND_TLS bool mcp_last_transient;
+
+/*
+ * Recent response times of one method, for the hedge delay. Slots are
+ * picked by the hash of the path; a method that lands on a taken slot
+ * starts it over.
+ */
+typedef struct {
+    zend_ulong hash;                          /* Of "/service/method"; 0: free */
+    uint32_t   samples[MCP_LATENCY_SAMPLES];  /* Milliseconds, a ring */
+    uint32_t   count;
+    uint32_t   next;
+} mcp_latency_t;
+
+static ZEND_TLS mcp_latency_t mcp_latency[MCP_LATENCY_SLOTS];
+
+enum { MCP_LEG_PENDING, MCP_LEG_OUT, MCP_LEG_LOST };   /* A copy of a hedged call */
+
+static void mcp_call_init(quicpro_session_t *session, mcp_call_t *call, const char *service_name, const char *path, const char *content_type);
+static void mcp_call_add_header(mcp_call_t *call, const char *name, const char *value);
+static int mcp_send_call(quicpro_session_t *session, mcp_call_t *call);
+static int mcp_send_body(quicpro_session_t *session, mcp_call_t *call, uint64_t stream_id, const uint8_t *data, size_t len, bool fin);
+static void mcp_track(quicpro_session_t *session, mcp_call_t *call, int64_t stream_id);
+static void mcp_untrack(quicpro_session_t *session, mcp_call_t *call);
+static int mcp_transfer_open(mcp_transfer_t *t, mcp_call_t *call, php_stream *stream, HashTable *opts, bool writing);
+static void mcp_transfer_close(mcp_transfer_t *t);
+static int mcp_transfer_handshake(quicpro_session_t *session, mcp_call_t *call);
+static int mcp_upload_body(quicpro_session_t *session, mcp_call_t *call, mcp_transfer_t *t);
+static void mcp_call_announce_schema(quicpro_session_t *session, mcp_call_t *call);
+static void mcp_call_describe_schema(mcp_call_t *call);
+static void mcp_call_release(quicpro_session_t *session, mcp_call_t *call);
+static int mcp_wait_io(quicpro_session_t *session, zend_long wait_ms);
+static zend_long mcp_now_ms(void);
+static int mcp_wait_handshake(quicpro_session_t *session, zend_long timeout_ms);
+static int mcp_poll_for_response(quicpro_session_t *session, mcp_call_t *call);
+static int mcp_call_round(quicpro_session_t *session, mcp_call_t *call);
+static mcp_call_t *mcp_poll_hedged(quicpro_session_t *session, mcp_call_t *call, quicpro_session_t *hedge, mcp_call_t *backup, zend_long hedge_at_ms);
+static zend_long mcp_deadline_after(zend_long timeout_ms);
+static void mcp_call_set_deadline(mcp_call_t *call, zend_long deadline_ms);
+static void mcp_call_stamp_deadline(mcp_call_t *call);
+static void mcp_latency_record(const char *path, zend_long ms);
+static zend_long mcp_latency_p95(const char *path);
+static int mcp_call_run(quicpro_session_t *session, const char *service_name, const char *path, const char *traceparent,
+                        zval *request_payload, HashTable *options, zval *return_value, quicpro_session_t **answered_by,
+                        quicpro_mcp_chunk_fn on_chunk, void *chunk_arg);
 
 
 /* --- PHP_FUNCTION Implementations --- */
@@ -48,46 +189,47 @@ PHP_FUNCTION(quicpro_mcp_connect)
         Z_PARAM_ARRAY_OR_NULL(options)
     ZEND_PARSE_PARAMETERS_END();
 
-    /*
-     * NOTE: This function's logic would be very similar to `quicpro_connect` from connect.c.
-     * It performs DNS lookup, socket creation, and initiates a QUIC/H3 connection.
-     * It uses a quicpro_cfg_t resource for configuration.
-     * For brevity, we assume a C helper `quicpro_session_open_c()` exists (conceptually
-     * from session.c) that encapsulates this logic and returns a quicpro_session_t*.
-     */
-
-    quicpro_cfg_t *config_wrapper = qp_fetch_cfg(z_cfg);
-    if (!config_wrapper || !config_wrapper->cfg) {
+    quicpro_cfg_t *config_wrapper = (quicpro_cfg_t *)zend_fetch_resource_ex(z_cfg, "Quicpro\\Config", le_quicpro_cfg);
+    if (!config_wrapper || !config_wrapper->quiche_cfg) {
         throw_mcp_error_as_php_exception(0, "Invalid configuration resource provided to quicpro_mcp_connect.");
         RETURN_FALSE;
     }
-    if (config_wrapper->frozen) {
-        /* Optionally allow reusing frozen configs, but warn or note it. */
-    }
 
-    /* Concept: quicpro_session_open_c would perform DNS, socket, connect, quiche_connect, and h3 init */
-    /* It would return a fully initialized session struct or NULL on failure. */
-    /* quicpro_session_t *session = quicpro_session_open_c(host, port, config_wrapper->cfg, options); */
+    HashTable *options_ht = options && Z_TYPE_P(options) == IS_ARRAY ? Z_ARRVAL_P(options) : NULL;
+    zend_resource *res = quicpro_mcp_open(host, host_len, port, config_wrapper, options_ht);
+    if (!res) {
+        /* quicpro_client_session_open() has thrown the specific error */
+        RETURN_FALSE;
+    }
+    RETURN_RES(res);
+}
 
-    /* For this skeleton, we'll placeholder the session creation. */
-    /* In a real implementation, you would reuse the logic from your `connect.c`. */
-    quicpro_session_t *session = ecalloc(1, sizeof(quicpro_session_t));
-    session->host = estrndup(host, host_len);
-    /* ... imagine full quiche_connect and quiche_h3_conn_new_with_transport happening here ... */
-    /* For now, this is just a placeholder allocation. */
-    session->conn = (void*)0xDEADBEEF; // Placeholder to signify it's "connected"
-    session->h3 = (void*)0xCAFEBABE;   // Placeholder
+zend_resource *quicpro_mcp_open(const char *host, size_t host_len, zend_long port, quicpro_cfg_t *cfg, HashTable *options)
+{
+    /*
+     * An orchestrator connects for every short call, so connections come
+     * from the per-worker pool. Each is handed to one caller at a time;
+     * that caller may still run many calls on it at once, one per Fiber.
+     */
+    bool pooled = quicpro_quic_transport_config.client_pool_enable;
+    quicpro_pool_key_t key = { host, host_len, port, "h3", cfg };
+    if (pooled) {
+        zend_resource *warm = quicpro_client_pool_checkout(&key, 1);
+        if (warm) {
+            return warm;
+        }
+    }
 
+    quicpro_session_t *session = quicpro_client_session_open(host, host_len, port, cfg, -1, options);
     if (!session) {
-        /* quicpro_session_open_c would have thrown the specific error */
-        RETURN_FALSE;
+        return NULL;
     }
 
-    /* Mark the config as used and immutable. */
-    quicpro_cfg_mark_frozen(z_cfg);
-
-    /* Register the session struct as a new resource and return it. */
-    RETURN_RES(zend_register_resource(session, le_quicpro_session));
+    session->resource = zend_register_resource(session, le_quicpro_session);
+    if (pooled) {
+        quicpro_client_pool_add(&key, session);
+    }
+    return session->resource;
 }
 
 PHP_FUNCTION(quicpro_mcp_close)
@@ -104,6 +246,11 @@ PHP_FUNCTION(quicpro_mcp_close)
         RETURN_FALSE;
     }
 
+    if (session->pooled) {
+        /* Stays open for the next quicpro_mcp_connect(); it is free once this handle is dropped */
+        RETURN_TRUE;
+    }
+
     if (session->conn) {
         /* Gracefully close the QUIC connection with an application-defined code and reason. */
         quiche_conn_close(session->conn, true, 0x00, (const uint8_t *)"MCP_CLOSE", sizeof("MCP_CLOSE")-1);
@@ -122,16 +269,16 @@ PHP_FUNCTION(quicpro_mcp_close)
 PHP_FUNCTION(quicpro_mcp_request)
 {
     zval *z_session_res;
-    char *service_name, *method_name, *request_payload_binary;
-    size_t service_name_len, method_name_len, request_payload_len;
+    char *service_name, *method_name;
+    size_t service_name_len, method_name_len;
+    zval *request_payload;
     zval *per_request_options = NULL;
-    uint64_t stream_id;
 
     ZEND_PARSE_PARAMETERS_START(4, 5)
         Z_PARAM_RESOURCE(z_session_res)
         Z_PARAM_STRING(service_name, service_name_len)
         Z_PARAM_STRING(method_name, method_name_len)
-        Z_PARAM_STRING(request_payload_binary, request_payload_len)
+        Z_PARAM_ZVAL(request_payload)
         Z_PARAM_OPTIONAL
         Z_PARAM_ARRAY_OR_NULL(per_request_options)
     ZEND_PARSE_PARAMETERS_END();
@@ -142,90 +289,372 @@ PHP_FUNCTION(quicpro_mcp_request)
         RETURN_FALSE;
     }
 
+    if (quicpro_mcp_call(session, service_name, method_name, request_payload,
+                         per_request_options ? Z_ARRVAL_P(per_request_options) : NULL, return_value, NULL) == FAILURE) {
+        /* Error already thrown */
+        RETURN_FALSE;
+    }
+}
+
+int quicpro_mcp_call(quicpro_session_t *session, const char *service_name, const char *method_name,
+                     zval *request_payload, HashTable *options, zval *return_value,
+                     quicpro_session_t **answered_by)
+{
+    return quicpro_mcp_call_streamed(session, service_name, method_name, request_payload, options, return_value, answered_by, NULL, NULL);
+}
+
+bool quicpro_mcp_call_transient(void)
+{
+    return mcp_last_transient;
+}
+
+int quicpro_mcp_call_streamed(quicpro_session_t *session, const char *service_name, const char *method_name,
+                              zval *request_payload, HashTable *options, zval *return_value,
+                              quicpro_session_t **answered_by, quicpro_mcp_chunk_fn on_chunk, void *chunk_arg)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "/%s/%s", service_name, method_name);
+
+    /* One client span per call, the hedge included; the agent continues the trace */
+    quicpro_otel_scope_t scope;
+    char traceparent[QUICPRO_OTEL_TRACEPARENT_LEN + 1];
+    bool traced = quicpro_otel_scope_open(&scope, path + 1, QUICPRO_OTEL_KIND_CLIENT, NULL);
+    if (scope.entered) {
+        quicpro_otel_traceparent_format(&scope.span.ctx, traceparent);
+    }
+    if (traced) {
+        quicpro_otel_span_attr_str(&scope.span, "rpc.system", "quicpro_mcp", sizeof("quicpro_mcp") - 1);
+        quicpro_otel_span_attr_str(&scope.span, "rpc.service", service_name, strlen(service_name));
+        quicpro_otel_span_attr_str(&scope.span, "rpc.method", method_name, strlen(method_name));
+        quicpro_otel_span_attr_str(&scope.span, "server.address", session->host, strlen(session->host));
+    }
+
+    quicpro_session_t *answered = NULL;
+    mcp_last_transient = false;
+    int result = mcp_call_run(session, service_name, path, scope.entered ? traceparent : NULL,
+                              request_payload, options, return_value, &answered, on_chunk, chunk_arg);
+    if (answered_by) {
+        *answered_by = answered;
+    }
+    if (traced) {
+        quicpro_otel_span_quic(&scope.span, (answered ? answered : session)->conn);
+        scope.span.error = result == FAILURE;
+    }
+    quicpro_otel_scope_close(&scope);
+    return result;
+}
+
+static int mcp_call_run(quicpro_session_t *session, const char *service_name, const char *path, const char *traceparent,
+                        zval *request_payload, HashTable *options, zval *return_value, quicpro_session_t **answered_by,
+                        quicpro_mcp_chunk_fn on_chunk, void *chunk_arg)
+{
     /*
      * This is a simplified reimplementation of `quicpro_send_request` logic from http3.c,
      * tailored for MCP RPC-style calls.
      */
-    quiche_h3_header headers[5];
-    char path[256];
-    int path_len = snprintf(path, sizeof(path), "/%s/%s", service_name, method_name);
+    mcp_call_t call = { .stream_id = -1 }, backup = { .stream_id = -1 };
 
-    headers[0] = (quiche_h3_header){ .name = (uint8_t *)":method", .name_len = 7, .value = (uint8_t *)"POST", .value_len = 4 };
-    headers[1] = (quiche_h3_header){ .name = (uint8_t *)":scheme", .name_len = 7, .value = (uint8_t *)"https", .value_len = 5 };
-    headers[2] = (quiche_h3_header){ .name = (uint8_t *)":path", .name_len = 5, .value = (uint8_t *)path, .value_len = path_len };
-    headers[3] = (quiche_h3_header){ .name = (uint8_t *)":authority", .name_len = 10, .value = (uint8_t *)session->host, .value_len = strlen(session->host) };
-    headers[4] = (quiche_h3_header){ .name = (uint8_t *)"content-type", .name_len = 12, .value = (uint8_t *)"application/vnd.quicpro.proto", .value_len = 29 };
+    /* The client this handler answers is gone: start nothing on its behalf */
+    if (mcp_check_cancelled() == FAILURE) {
+        return FAILURE;
+    }
 
-    stream_id = quiche_h3_send_request(session->h3, session->conn, headers, 5, 0);
-    if ((int64_t)stream_id < 0) {
-        throw_quiche_error_as_php_exception((int)stream_id, "MCP request failed: could not send H3 headers for service '%s'", service_name);
-        RETURN_FALSE;
+    /* A DataFrame goes out as an Arrow IPC stream rather than a protobuf/IIBIN message */
+    ZVAL_DEREF(request_payload);
+    zend_object *frame = Z_TYPE_P(request_payload) == IS_OBJECT && instanceof_function(Z_OBJCE_P(request_payload), quicpro_ce_dataframe)
+        ? Z_OBJ_P(request_payload) : NULL;
+    const char *content_type = frame ? QUICPRO_DF_ARROW_STREAM_TYPE : "application/vnd.quicpro.proto";
+
+    mcp_call_init(session, &call, service_name, path, content_type);
+    if (traceparent) {
+        mcp_call_add_header(&call, "traceparent", traceparent);
     }
+    call.on_chunk = on_chunk;
+    call.chunk_arg = chunk_arg;
 
-    ssize_t sent = quiche_h3_send_body(session->h3, session->conn, stream_id, (uint8_t *)request_payload_binary, request_payload_len, 1 /* final chunk */);
-    if (sent < 0) {
-        throw_quiche_error_as_php_exception((int)sent, "MCP request failed: could not send H3 body for service '%s'", service_name);
-        RETURN_FALSE;
+    /* ['schema' => name] says how a message is encoded, or which schema an encoded payload has */
+    zval *zv_schema = options ? zend_hash_str_find(options, "schema", sizeof("schema")-1) : NULL;
+    if (zv_schema && Z_TYPE_P(zv_schema) == IS_STRING) {
+        call.described = get_compiled_iibin_schema_internal(Z_STRVAL_P(zv_schema));
+        if (!call.described) {
+            throw_mcp_error_as_php_exception(0, "MCP request for service '%s': IIBIN schema '%s' is not defined.", service_name, Z_STRVAL_P(zv_schema));
+            return FAILURE;
+        }
+    }
+
+    if (frame) {
+        if (call.described) {
+            throw_mcp_error_as_php_exception(0, "MCP request for service '%s': a DataFrame payload travels as Arrow and takes no 'schema' option.", service_name);
+            return FAILURE;
+        }
+        call.frame = frame;
+    } else if (Z_TYPE_P(request_payload) == IS_STRING) {
+        call.payload = (const uint8_t *)Z_STRVAL_P(request_payload);
+        call.payload_len = Z_STRLEN_P(request_payload);
+    } else if (Z_TYPE_P(request_payload) == IS_ARRAY || Z_TYPE_P(request_payload) == IS_OBJECT) {
+        /* A message rather than its encoding */
+        if (!call.described) {
+            throw_mcp_error_as_php_exception(0, "MCP request for service '%s': an array or object payload needs the 'schema' option.", service_name);
+            return FAILURE;
+        }
+        call.schema = call.described;
+        call.message = request_payload;
+    } else {
+        zend_argument_type_error(4, "must be of type string, array or object, %s given", zend_zval_type_name(request_payload));
+        return FAILURE;
     }
 
-    /*
-     * Now, because this is a synchronous request-response function, we must
-     * block and poll for the full response on this stream_id.
-     */
-    smart_str response_body_buf = {0};
     zend_long timeout_ms = 30000; // Default timeout, could be overridden from per_request_options
-    if (per_request_options && Z_TYPE_P(per_request_options) == IS_ARRAY) {
-        zval *zv_timeout = zend_hash_str_find(Z_ARRVAL_P(per_request_options), "timeout_ms", sizeof("timeout_ms")-1);
+    bool idempotent = false;
+    quicpro_session_t *hedge = NULL;
+    zend_long hedge_after_ms = -1;
+    if (options) {
+        zval *zv_timeout = zend_hash_str_find(options, "timeout_ms", sizeof("timeout_ms")-1);
         if (zv_timeout && Z_TYPE_P(zv_timeout) == IS_LONG) {
             timeout_ms = Z_LVAL_P(zv_timeout);
         }
+        zval *zv_idempotent = zend_hash_str_find(options, "idempotent", sizeof("idempotent")-1);
+        idempotent = zv_idempotent && zend_is_true(zv_idempotent);
+
+        zval *zv_hedge = zend_hash_str_find(options, "hedge", sizeof("hedge")-1);
+        if (zv_hedge && Z_TYPE_P(zv_hedge) == IS_RESOURCE) {
+            hedge = (quicpro_session_t *)zend_fetch_resource_ex(zv_hedge, "Quicpro MCP Session", le_quicpro_session);
+            if (!hedge || !hedge->conn || !hedge->h3 || hedge == session) {
+                throw_mcp_error_as_php_exception(0, "MCP request for service '%s': 'hedge' must be another open MCP connection.", service_name);
+                return FAILURE;
+            }
+            zval *zv_after = zend_hash_str_find(options, "hedge_after_ms", sizeof("hedge_after_ms")-1);
+            hedge_after_ms = zv_after && Z_TYPE_P(zv_after) == IS_LONG && Z_LVAL_P(zv_after) >= 0
+                ? Z_LVAL_P(zv_after) : mcp_latency_p95(path);
+            if (hedge_after_ms < 0 || on_chunk) {
+                hedge = NULL;   /* Too few responses seen to know when this one is late, or two bodies would interleave */
+            }
+        }
     }
+    mcp_call_set_deadline(&call, mcp_deadline_after(timeout_ms));
 
-    if (mcp_poll_for_response(session, stream_id, &response_body_buf, timeout_ms) == FAILURE) {
-        /* Error already thrown inside polling function */
-        smart_str_free(&response_body_buf);
-        RETURN_FALSE;
+    /*
+     * On a resumed connection the call could leave as 0-RTT data, which an
+     * attacker can replay. Only calls the caller marked idempotent may;
+     * everything else waits for the handshake.
+     */
+    if (!idempotent && quiche_conn_is_in_early_data(session->conn)
+        && mcp_wait_handshake(session, call.deadline_ms ? MAX(call.deadline_ms - mcp_now_ms(), 1) : -1) == FAILURE) {
+        return FAILURE;
     }
 
-    if (response_body_buf.s) {
-        RETVAL_STR(response_body_buf.s); /* Gives ownership of the zend_string */
-    } else {
-        RETVAL_EMPTY_STRING();
+    mcp_call_announce_schema(session, &call);
+
+    /* A degraded target is not sent more work; the hedge is simply left out */
+    quicpro_mcp_guard_t guard, hedge_guard = { 0 };
+    quicpro_mcp_admission_t admission = quicpro_mcp_guard_admit(session, &guard);
+    if (admission != MCP_GUARD_ADMITTED) {
+        throw_mcp_error_as_php_exception(0, admission == MCP_GUARD_OPEN
+            ? "MCP request for service '%s' rejected: the circuit breaker for '%s' is open."
+            : admission == MCP_GUARD_DRAINED
+            ? "MCP request for service '%s' rejected: '%s' is drained."
+            : "MCP request for service '%s' rejected: '%s' is at its concurrency limit.", service_name, session->host);
+        return FAILURE;
     }
+    if (hedge && quicpro_mcp_guard_admit(hedge, &hedge_guard) != MCP_GUARD_ADMITTED) {
+        hedge = NULL;
+    }
+
+    /* The hedge is the same call to another endpoint, under the same deadline */
+    if (hedge) {
+        mcp_call_init(hedge, &backup, service_name, path, content_type);
+        if (traceparent) {
+            mcp_call_add_header(&backup, "traceparent", traceparent);
+        }
+        backup.described = call.described;
+        backup.payload = call.payload;
+        backup.payload_len = call.payload_len;
+        backup.schema = call.schema;
+        backup.message = call.message;
+        backup.frame = call.frame;
+        mcp_call_set_deadline(&backup, call.deadline_ms);
+    }
+
+    /*
+     * The call blocks its caller until the response is complete, but not
+     * the session: other Fibers' calls on it run meanwhile, and whichever
+     * of them reads this call's response hands it over.
+     */
+    zend_long started_ms = mcp_now_ms();
+    mcp_call_t *answered = NULL;
+    if (mcp_send_call(session, &call) == SUCCESS) {
+        if (hedge) {
+            answered = mcp_poll_hedged(session, &call, hedge, &backup, started_ms + hedge_after_ms);
+        } else if (mcp_poll_for_response(session, &call) == SUCCESS) {
+            answered = &call;
+        }
+    }
+    zend_long latency_ms = mcp_now_ms() - started_ms;
+    bool decoded = true;
+    if (answered) {
+        mcp_latency_record(path, latency_ms);
+        /* An Arrow response is mapped into a DataFrame, its columns pointing into the body */
+        if (answered->upload) {
+            /* A tensor response is on the GPU already; the Tensor takes over its memory */
+            decoded = quicpro_gpu_upload_finish(answered->upload, return_value);
+            answered->upload = NULL;
+            if (!decoded) {
+                throw_mcp_error_as_php_exception(0, "MCP response for service '%s': %s", service_name, quicpro_gpu_error());
+            }
+        } else if (answered->arrow && quicpro_high_perf_compute_ai_config.dataframe_enable) {
+            zend_string *ipc = quicpro_body_take(&answered->response);
+            decoded = quicpro_df_ipc_decode(ipc, return_value);
+            zend_string_release(ipc);
+        } else {
+            RETVAL_STR(quicpro_body_take(&answered->response));
+        }
+        if (answered_by) {
+            *answered_by = answered == &call ? session : hedge;
+        }
+    }
+    /* Only the session that answered is credited; the hedge was sent hedge_after_ms late */
+    quicpro_mcp_guard_done(&guard, answered == &call ? MCP_GUARD_OK : answered ? MCP_GUARD_DROPPED : MCP_GUARD_FAILED, latency_ms);
+    mcp_last_transient = !answered && !quicpro_cancel_requested();
+    if (hedge) {
+        quicpro_mcp_guard_done(&hedge_guard, answered == &backup ? MCP_GUARD_OK : MCP_GUARD_DROPPED, latency_ms - hedge_after_ms);
+    }
+
+    /* Releasing cancels the copy that lost; its reset goes out right away */
+    mcp_call_release(session, &call);
+    if (hedge) {
+        mcp_call_release(hedge, &backup);
+        quicpro_session_pump_tx(session);
+        quicpro_session_pump_tx(hedge);
+    }
+    /* A body that does not decode is the caller's failure, not the connection's: the guards saw a response */
+    return answered && decoded ? SUCCESS : FAILURE;
 }
 
+/*
+ * Transfers (see mcp_transfer_t) are never sent as 0-RTT data: a replay
+ * could not rewind a pipe, and the handshake is short next to the object.
+ * 'timeout_ms' is unset by default; a transfer takes as long as its object.
+ */
 PHP_FUNCTION(quicpro_mcp_upload_from_stream)
 {
-    /*
-     * TODO: Implementation for client-streaming RPC.
-     * 1. Parse parameters: connection resource, service/method names, stream_identifier, PHP readable stream resource.
-     * 2. Send initial H3 request with headers (and optional initial_metadata_payload). The 'fin' flag on send_body would be 0.
-     * 3. Enter a loop:
-     * - Read a chunk from the PHP stream resource using `php_stream_read()`.
-     * - Send the chunk as an H3 DATA frame using `quiche_h3_send_body()`. The 'fin' flag is 1 only for the last chunk.
-     * - Must handle backpressure from quiche (if send_body returns QUICHE_ERR_BUFFER_TOO_SMALL, need to call quicpro_poll and retry).
-     * 4. After the stream is fully sent, enter a polling loop (like `mcp_poll_for_response`) to wait for a single summary response from the server.
-     * 5. Return true/false based on success.
-     */
-    zend_error(E_WARNING, "quicpro_mcp_upload_from_stream() is not yet implemented.");
-    RETURN_FALSE;
+    zval *z_session_res, *z_stream;
+    char *service_name, *method_name, *stream_identifier, *metadata = NULL;
+    size_t service_name_len, method_name_len, stream_identifier_len, metadata_len = 0;
+    zval *options = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(5, 7)
+        Z_PARAM_RESOURCE(z_session_res)
+        Z_PARAM_STRING(service_name, service_name_len)
+        Z_PARAM_STRING(method_name, method_name_len)
+        Z_PARAM_STRING(stream_identifier, stream_identifier_len)
+        Z_PARAM_RESOURCE(z_stream)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STRING(metadata, metadata_len)
+        Z_PARAM_ARRAY_OR_NULL(options)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *session = (quicpro_session_t *)zend_fetch_resource_ex(z_session_res, "Quicpro MCP Session", le_quicpro_session);
+    if (!session || !session->conn || !session->h3) {
+        throw_mcp_error_as_php_exception(0, "Invalid or closed MCP connection resource provided.");
+        RETURN_FALSE;
+    }
+    php_stream *stream;
+    php_stream_from_zval(stream, z_stream);
+
+    mcp_call_t call = { .stream_id = -1 };
+    mcp_transfer_t transfer;
+    char path[256], offset[24], total[24], metadata_length[24];
+    snprintf(path, sizeof(path), "/%s/%s", service_name, method_name);
+
+    mcp_call_init(session, &call, service_name, path, "application/octet-stream");
+    if (mcp_transfer_open(&transfer, &call, stream, options ? Z_ARRVAL_P(options) : NULL, false) == FAILURE) {
+        RETURN_THROWS();
+    }
+
+    /* The agent appends at quicpro-offset; the metadata, if any, precedes the data on the stream */
+    mcp_call_add_header(&call, "quicpro-stream-id", stream_identifier);
+    snprintf(offset, sizeof(offset), ZEND_LONG_FMT, (zend_long)transfer.offset);
+    mcp_call_add_header(&call, "quicpro-offset", offset);
+    if (transfer.total >= 0) {
+        snprintf(total, sizeof(total), ZEND_LONG_FMT, transfer.total);
+        mcp_call_add_header(&call, "quicpro-total-length", total);
+    }
+    if (metadata_len) {
+        snprintf(metadata_length, sizeof(metadata_length), "%zu", metadata_len);
+        mcp_call_add_header(&call, "quicpro-metadata-length", metadata_length);
+    }
+
+    bool ok = mcp_transfer_handshake(session, &call) == SUCCESS;
+    if (ok) {
+        mcp_call_stamp_deadline(&call);
+        int64_t stream_id = quiche_h3_send_request(session->h3, session->conn, call.headers, call.header_count, 0);
+        if (stream_id < 0) {
+            throw_quiche_error_as_php_exception((int)stream_id, "MCP upload failed: could not send H3 headers for service '%s'", service_name);
+            ok = false;
+        } else {
+            mcp_track(session, &call, stream_id);
+            ok = (!metadata_len || mcp_send_body(session, &call, (uint64_t)stream_id, (const uint8_t *)metadata, metadata_len, false) == SUCCESS)
+                && mcp_upload_body(session, &call, &transfer) == SUCCESS
+                && mcp_poll_for_response(session, &call) == SUCCESS;
+        }
+    }
+
+    mcp_transfer_close(&transfer);
+    mcp_call_release(session, &call);
+    RETURN_BOOL(ok);
 }
 
 PHP_FUNCTION(quicpro_mcp_download_to_stream)
 {
-    /*
-     * TODO: Implementation for server-streaming RPC.
-     * 1. Parse parameters: connection resource, service/method names, request payload, PHP writable stream resource.
-     * 2. Send the H3 request with the request_payload_binary to initiate the server stream.
-     * 3. Enter a polling loop:
-     * - Call `quicpro_poll` or similar logic.
-     * - Check for H3 DATA events for the request's stream_id.
-     * - As data chunks are received via `quiche_h3_recv_body()`, write them to the PHP writable stream using `php_stream_write()`.
-     * - Loop until a FIN flag is received on the stream from the server.
-     * 4. Return true/false based on success.
-     */
-    zend_error(E_WARNING, "quicpro_mcp_download_to_stream() is not yet implemented.");
-    RETURN_FALSE;
+    zval *z_session_res, *z_stream;
+    char *service_name, *method_name, *payload;
+    size_t service_name_len, method_name_len, payload_len;
+    zval *options = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(5, 6)
+        Z_PARAM_RESOURCE(z_session_res)
+        Z_PARAM_STRING(service_name, service_name_len)
+        Z_PARAM_STRING(method_name, method_name_len)
+        Z_PARAM_STRING(payload, payload_len)
+        Z_PARAM_RESOURCE(z_stream)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_ARRAY_OR_NULL(options)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *session = (quicpro_session_t *)zend_fetch_resource_ex(z_session_res, "Quicpro MCP Session", le_quicpro_session);
+    if (!session || !session->conn || !session->h3) {
+        throw_mcp_error_as_php_exception(0, "Invalid or closed MCP connection resource provided.");
+        RETURN_FALSE;
+    }
+    php_stream *stream;
+    php_stream_from_zval(stream, z_stream);
+
+    mcp_call_t call = { .stream_id = -1 };
+    mcp_transfer_t transfer;
+    char path[256], offset[24];
+    snprintf(path, sizeof(path), "/%s/%s", service_name, method_name);
+
+    mcp_call_init(session, &call, service_name, path, "application/vnd.quicpro.proto");
+    call.payload = (const uint8_t *)payload;
+    call.payload_len = payload_len;
+    if (mcp_transfer_open(&transfer, &call, stream, options ? Z_ARRVAL_P(options) : NULL, true) == FAILURE) {
+        RETURN_THROWS();
+    }
+    call.sink = &transfer;
+
+    /* A resumed download asks the agent to skip what the stream already holds */
+    if (transfer.offset > 0) {
+        snprintf(offset, sizeof(offset), ZEND_LONG_FMT, (zend_long)transfer.offset);
+        mcp_call_add_header(&call, "quicpro-offset", offset);
+    }
+
+    bool ok = mcp_transfer_handshake(session, &call) == SUCCESS
+        && mcp_send_call(session, &call) == SUCCESS
+        && mcp_poll_for_response(session, &call) == SUCCESS;
+
+    mcp_transfer_close(&transfer);
+    mcp_call_release(session, &call);
+    RETURN_BOOL(ok);
 }
 
 PHP_FUNCTION(quicpro_mcp_get_error)
@@ -240,77 +669,1015 @@ PHP_FUNCTION(quicpro_mcp_get_error)
 
 /* --- C Helper Implementation for Synchronous Polling --- */
 
-static int mcp_poll_for_response(quicpro_session_t *session, uint64_t stream_id, smart_str *response_body_buf, zend_long timeout_ms) {
-    /*
-     * This is a simplified polling loop. A real implementation needs to be
-     * more robust, using select() or poll() on the socket for efficient waiting,
-     * and properly handling quiche's own timeout recommendations.
-     */
-    zend_long start_time = (zend_long)(time(NULL) * 1000); // Rough start time in ms
+/*──── Calls ────*/
+
+/* The pseudo-headers and content type every call starts with; `path` must outlive the call. */
+static void mcp_call_init(quicpro_session_t *session, mcp_call_t *call, const char *service_name, const char *path, const char *content_type) {
+    call->headers[0] = (quiche_h3_header){ .name = (uint8_t *)":method", .name_len = 7, .value = (uint8_t *)"POST", .value_len = 4 };
+    call->headers[1] = (quiche_h3_header){ .name = (uint8_t *)":scheme", .name_len = 7, .value = (uint8_t *)"https", .value_len = 5 };
+    call->headers[2] = (quiche_h3_header){ .name = (uint8_t *)":path", .name_len = 5, .value = (uint8_t *)path, .value_len = strlen(path) };
+    call->headers[3] = (quiche_h3_header){ .name = (uint8_t *)":authority", .name_len = 10, .value = (uint8_t *)session->host, .value_len = strlen(session->host) };
+    call->header_count = 4;
+    mcp_call_add_header(call, "content-type", content_type);
+    call->service_name = service_name;
+}
+
+/* `name` and `value` must outlive the call. */
+static void mcp_call_add_header(mcp_call_t *call, const char *name, const char *value) {
+    ZEND_ASSERT(call->header_count < sizeof(call->headers) / sizeof(call->headers[0]));
+    call->headers[call->header_count++] = (quiche_h3_header){ .name = (uint8_t *)name, .name_len = strlen(name),
+                                                             .value = (uint8_t *)value, .value_len = strlen(value) };
+}
+
+/* Gives up the call's stream in both directions, as a client cancelling its request does. */
+static void mcp_call_cancel(quicpro_session_t *session, mcp_call_t *call) {
+    if (call->stream_id >= 0) {
+        quiche_conn_stream_shutdown(session->conn, (uint64_t)call->stream_id, QUICHE_SHUTDOWN_READ, MCP_H3_REQUEST_CANCELLED);
+        quiche_conn_stream_shutdown(session->conn, (uint64_t)call->stream_id, QUICHE_SHUTDOWN_WRITE, MCP_H3_REQUEST_CANCELLED);
+        mcp_untrack(session, call);
+    }
+}
+
+/*──── Deadlines ────*/
+
+/* A call's deadline from its own timeout (<= 0: none), cut to the one of the request being served. */
+static zend_long mcp_deadline_after(zend_long timeout_ms) {
+    zend_long deadline = timeout_ms > 0 ? mcp_now_ms() + timeout_ms : 0;
+    if (mcp_inherited_deadline_ms && (!deadline || mcp_inherited_deadline_ms < deadline)) {
+        deadline = mcp_inherited_deadline_ms;
+    }
+    return deadline;
+}
+
+/* Sets the deadline and announces it to the agent; the value is filled in as the headers leave. */
+static void mcp_call_set_deadline(mcp_call_t *call, zend_long deadline_ms) {
+    call->deadline_ms = deadline_ms;
+    if (deadline_ms) {
+        call->timeout_header = call->header_count;
+        mcp_call_add_header(call, MCP_TIMEOUT_HEADER, call->timeout_value);
+    }
+}
+
+/*
+ * The time left rather than the deadline itself: agents do not share our
+ * monotonic clock, and each hop then sees the budget as it stood when the
+ * request left, resends included.
+ */
+static void mcp_call_stamp_deadline(mcp_call_t *call) {
+    if (call->timeout_header) {
+        zend_long left = MAX(call->deadline_ms - mcp_now_ms(), 1);
+        call->headers[call->timeout_header].value_len =
+            (size_t)snprintf(call->timeout_value, sizeof(call->timeout_value), ZEND_LONG_FMT, left);
+    }
+}
+
+zend_long quicpro_mcp_deadline_enter(zend_long remaining_ms) {
+    zend_long previous = mcp_inherited_deadline_ms;
+    zend_long deadline = mcp_now_ms() + MAX(remaining_ms, 1);
+    if (!previous || deadline < previous) {
+        mcp_inherited_deadline_ms = deadline;
+    }
+    return previous;
+}
+
+void quicpro_mcp_deadline_leave(zend_long previous) {
+    mcp_inherited_deadline_ms = previous;
+}
+
+/*──── Hedging ────*/
+
+static mcp_latency_t *mcp_latency_slot(const char *path, bool claim) {
+    zend_ulong hash = zend_inline_hash_func(path, strlen(path)) | 1;
+    mcp_latency_t *l = &mcp_latency[hash % MCP_LATENCY_SLOTS];
+    if (l->hash != hash) {
+        if (!claim) {
+            return NULL;
+        }
+        memset(l, 0, sizeof(*l));
+        l->hash = hash;
+    }
+    return l;
+}
+
+static void mcp_latency_record(const char *path, zend_long ms) {
+    mcp_latency_t *l = mcp_latency_slot(path, true);
+    l->samples[l->next] = (uint32_t)MIN(MAX(ms, 0), UINT32_MAX);
+    l->next = (l->next + 1) % MCP_LATENCY_SAMPLES;
+    if (l->count < MCP_LATENCY_SAMPLES) {
+        l->count++;
+    }
+}
+
+/* The 95th percentile of the method's recent response times, or -1 while there are too few. */
+static zend_long mcp_latency_p95(const char *path) {
+    const mcp_latency_t *l = mcp_latency_slot(path, false);
+    if (!l || l->count < MCP_LATENCY_MIN_SAMPLES) {
+        return -1;
+    }
+    uint32_t sorted[MCP_LATENCY_SAMPLES];
+    for (uint32_t i = 0; i < l->count; i++) {
+        uint32_t v = l->samples[i], j = i;
+        for (; j > 0 && sorted[j - 1] > v; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = v;
+    }
+    return sorted[(l->count * 95 + 99) / 100 - 1];
+}
+
+/*──── Streaming transfers ────*/
+
+/*
+ * The PHP stream end of quicpro_mcp_upload_from_stream() and
+ * _download_to_stream(). Data moves in chunks no larger than
+ * MCP_TRANSFER_CHUNK, as flow control lets it, so a transfer holds the
+ * same memory whatever the size of the object. A plain file skips PHP's
+ * stream buffers: uploads hand quiche mmap() windows of it, without a copy
+ * into a read buffer first, and downloads pwrite() each chunk at its
+ * offset. QUIC encrypts in user space, so the kernel cannot splice into
+ * the connection; quiche's own copy into its send buffer is the only one.
+ *
+ * `offset` is where the next byte goes in (or comes from) the object. It is
+ * what on_progress reports, and what a transfer that broke off passes as
+ * 'offset' to resume.
+ */
+struct mcp_transfer_s {
+    php_stream            *stream;
+    int                    fd;            /* Plain file, else -1 */
+    zend_off_t             offset;
+    zend_long              total;         /* Size of the whole object; -1: unknown */
+    zend_off_t             reported;      /* Offset on_progress saw last */
+    zend_fcall_info        on_progress;   /* fn(int $offset, ?int $total): ?bool */
+    zend_fcall_info_cache  on_progress_fcc;
+};
+
+/*
+ * Sets a transfer up on `stream` from the options 'offset' (default: the
+ * stream's position), 'on_progress' and 'timeout_ms'. FAILURE after
+ * throwing.
+ */
+static int mcp_transfer_open(mcp_transfer_t *t, mcp_call_t *call, php_stream *stream, HashTable *opts, bool writing) {
+    memset(t, 0, sizeof(*t));
+    t->stream = stream;
+    t->fd = -1;
+    t->total = -1;
+
+    zval *zv_offset = opts ? zend_hash_str_find(opts, "offset", sizeof("offset")-1) : NULL;
+    zval *zv_progress = opts ? zend_hash_str_find(opts, "on_progress", sizeof("on_progress")-1) : NULL;
+    zval *zv_timeout = opts ? zend_hash_str_find(opts, "timeout_ms", sizeof("timeout_ms")-1) : NULL;
+
+    if (zv_progress && Z_TYPE_P(zv_progress) != IS_NULL) {
+        char *error = NULL;
+        if (zend_fcall_info_init(zv_progress, 0, &t->on_progress, &t->on_progress_fcc, NULL, &error) == FAILURE) {
+            zend_type_error("Option \"on_progress\" must be a valid callback%s%s", error ? ", " : "", error ? error : "");
+            if (error) {
+                efree(error);
+            }
+            return FAILURE;
+        }
+        if (error) {
+            efree(error);
+        }
+        Z_TRY_ADDREF(t->on_progress.function_name);
+    }
+    mcp_call_set_deadline(call, mcp_deadline_after(zv_timeout && Z_TYPE_P(zv_timeout) == IS_LONG ? Z_LVAL_P(zv_timeout) : 0));
+
+    if (writing) {
+        php_stream_flush(stream);
+    }
+    t->offset = php_stream_tell(stream);
+    if (zv_offset && Z_TYPE_P(zv_offset) == IS_LONG && Z_LVAL_P(zv_offset) != t->offset) {
+        /* Written to a pipe, the resumed tail simply follows what is there */
+        if (Z_LVAL_P(zv_offset) < 0 || (php_stream_seek(stream, Z_LVAL_P(zv_offset), SEEK_SET) != 0 && !writing)) {
+            mcp_transfer_close(t);
+            throw_mcp_error_as_php_exception(0, "MCP transfer for service '%s' cannot start at offset " ZEND_LONG_FMT " of this stream.",
+                                             call->service_name, Z_LVAL_P(zv_offset));
+            return FAILURE;
+        }
+        t->offset = Z_LVAL_P(zv_offset);
+    }
+    t->reported = t->offset;
+
+    int fd;
+    struct stat st;
+    if (php_stream_is(stream, PHP_STREAM_IS_STDIO)
+        && php_stream_cast(stream, PHP_STREAM_AS_FD | PHP_STREAM_CAST_INTERNAL, (void **)&fd, 0) == SUCCESS
+        && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)
+        && !(writing && (fcntl(fd, F_GETFL) & O_APPEND))) {     /* pwrite() would append anyway */
+        t->fd = fd;
+        if (!writing) {
+            t->total = (zend_long)st.st_size;
+        }
+    }
+    return SUCCESS;
+}
+
+/* Leaves a plain file's PHP stream positioned after the transfer, as if it had done the I/O itself. */
+static void mcp_transfer_close(mcp_transfer_t *t) {
+    if (t->fd >= 0) {
+        php_stream_seek(t->stream, t->offset, SEEK_SET);
+    }
+    if (ZEND_FCI_INITIALIZED(t->on_progress)) {
+        zval_ptr_dtor(&t->on_progress.function_name);
+        t->on_progress.size = 0;
+    }
+}
+
+/* Tells on_progress how far the transfer is; FAILURE if it threw or returned false. */
+static int mcp_transfer_report(mcp_transfer_t *t) {
+    if (!ZEND_FCI_INITIALIZED(t->on_progress) || t->offset == t->reported) {
+        return SUCCESS;
+    }
+    t->reported = t->offset;
+
+    zval args[2], retval;
+    ZVAL_LONG(&args[0], (zend_long)t->offset);
+    if (t->total >= 0) {
+        ZVAL_LONG(&args[1], t->total);
+    } else {
+        ZVAL_NULL(&args[1]);
+    }
+    ZVAL_UNDEF(&retval);
+    t->on_progress.retval = &retval;
+    t->on_progress.params = args;
+    t->on_progress.param_count = 2;
+
+    bool ok = zend_call_function(&t->on_progress, &t->on_progress_fcc) == SUCCESS && !EG(exception) && Z_TYPE(retval) != IS_FALSE;
+    zval_ptr_dtor(&retval);
+    return ok ? SUCCESS : FAILURE;
+}
+
+/* Cancels the call after on_progress said stop; always FAILURE. */
+static int mcp_transfer_abort(quicpro_session_t *session, mcp_call_t *call, mcp_transfer_t *t) {
+    mcp_call_cancel(session, call);
+    if (!EG(exception)) {
+        throw_mcp_error_as_php_exception(0, "MCP transfer for service '%s' was stopped by its progress callback at offset " ZEND_LONG_FMT ".",
+                                         call->service_name, (zend_long)t->offset);
+    }
+    return FAILURE;
+}
+
+/* Writes a downloaded chunk; runs in whichever caller read it, so it only reports failure. */
+static int mcp_transfer_write(mcp_transfer_t *t, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = t->fd >= 0 ? pwrite(t->fd, data, len, (off_t)t->offset)
+                               : php_stream_write(t->stream, (const char *)data, len);
+        if (n < 0 && t->fd >= 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return FAILURE;
+        }
+        data += n;
+        len -= (size_t)n;
+        t->offset += n;
+    }
+    return SUCCESS;
+}
+
+/*
+ * Sends the upload's data and the FIN. A plain file goes out in mmap()
+ * windows up to the size it had when the transfer began, then, like any
+ * other stream, through a read buffer until EOF.
+ */
+static int mcp_upload_body(quicpro_session_t *session, mcp_call_t *call, mcp_transfer_t *t) {
+    uint64_t stream_id = (uint64_t)call->stream_id;
 
-    while (1) {
-        /* Check for overall timeout */
-        if (timeout_ms > 0 && ((zend_long)(time(NULL) * 1000) - start_time) > timeout_ms) {
-            throw_mcp_error_as_php_exception(0, "MCP request timed out after %ld ms while waiting for response on stream %llu.", timeout_ms, (unsigned long long)stream_id);
+    if (t->fd >= 0) {
+        zend_off_t page = (zend_off_t)sysconf(_SC_PAGESIZE);
+        while (t->offset < t->total) {
+            zend_off_t base = t->offset - t->offset % page;
+            size_t len = (size_t)MIN((zend_off_t)MCP_TRANSFER_WINDOW, t->total - base);
+            void *map = mmap(NULL, len, PROT_READ, MAP_SHARED, t->fd, (off_t)base);
+            if (map == MAP_FAILED) {
+                break;      /* Not mappable after all; read it */
+            }
+            madvise(map, len, MADV_SEQUENTIAL);
+            size_t skip = (size_t)(t->offset - base);
+            int sent = mcp_send_body(session, call, stream_id, (const uint8_t *)map + skip, len - skip, false);
+            munmap(map, len);
+            if (sent == FAILURE) {
+                return FAILURE;
+            }
+            t->offset = base + (zend_off_t)len;
+            if (mcp_transfer_report(t) == FAILURE) {
+                return mcp_transfer_abort(session, call, t);
+            }
+        }
+    }
+
+    uint8_t *buf = emalloc(MCP_TRANSFER_CHUNK);
+    for (;;) {
+        ssize_t n = t->fd >= 0 ? pread(t->fd, buf, MCP_TRANSFER_CHUNK, (off_t)t->offset)
+                               : php_stream_read(t->stream, (char *)buf, MCP_TRANSFER_CHUNK);
+        if (n < 0 && t->fd >= 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            efree(buf);
+            throw_mcp_error_as_php_exception(0, "MCP upload for service '%s' could not read the stream at offset " ZEND_LONG_FMT ".",
+                                             call->service_name, (zend_long)t->offset);
             return FAILURE;
         }
+        if (n == 0) {
+            break;
+        }
+        if (mcp_send_body(session, call, stream_id, buf, (size_t)n, false) == FAILURE) {
+            efree(buf);
+            return FAILURE;
+        }
+        t->offset += n;
+        if (mcp_transfer_report(t) == FAILURE) {
+            efree(buf);
+            return mcp_transfer_abort(session, call, t);
+        }
+    }
+    efree(buf);
+    return mcp_send_body(session, call, stream_id, NULL, 0, true);
+}
+
+/* A transfer on a resumed connection waits for the handshake instead of going out as 0-RTT data. */
+static int mcp_transfer_handshake(quicpro_session_t *session, mcp_call_t *call) {
+    if (!quiche_conn_is_in_early_data(session->conn)) {
+        return SUCCESS;
+    }
+    zend_long timeout_ms = call->deadline_ms ? MAX(call->deadline_ms - mcp_now_ms(), 1) : -1;
+    return mcp_wait_handshake(session, timeout_ms);
+}
+
+
+/*
+ * Writes an H3 body chunk, waiting for stream and connection credit as
+ * often as the peer hands it out. Between attempts the connection is driven
+ * as in mcp_poll_for_response(): the ACKs and MAX_STREAM_DATA frames that
+ * open the window only arrive while the socket is read. A FIN without data
+ * (len 0) may need to wait for credit too.
+ */
+static int mcp_send_body(quicpro_session_t *session, mcp_call_t *call, uint64_t stream_id, const uint8_t *data, size_t len, bool fin) {
+    for (;;) {
+        ssize_t sent = quiche_h3_send_body(session->h3, session->conn, stream_id, (uint8_t *)data, len, fin);
+        if (sent == QUICHE_H3_ERR_DONE) {
+            sent = 0;
+        } else if (sent < 0) {
+            throw_quiche_error_as_php_exception((int)sent, "MCP request failed: could not send H3 body for service '%s'", call->service_name);
+            return FAILURE;
+        } else if ((size_t)sent == len) {
+            return SUCCESS;
+        }
+        data += sent;
+        len -= (size_t)sent;
+
+        zend_long wait_ms = -1;
+        if (call->deadline_ms) {
+            wait_ms = call->deadline_ms - mcp_now_ms();
+            if (wait_ms <= 0) {
+                throw_mcp_error_as_php_exception(0, "MCP request timed out while sending the body for service '%s'.", call->service_name);
+                return FAILURE;
+            }
+        }
+        if (quiche_conn_is_closed(session->conn)) {
+            throw_mcp_error_as_php_exception(0, "MCP connection closed while sending the body for service '%s'.", call->service_name);
+            return FAILURE;
+        }
+        quicpro_session_pump_tx(session);
+        int64_t quic_deadline = quiche_conn_timeout_as_millis(session->conn);
+        if (quic_deadline >= 0 && (wait_ms < 0 || quic_deadline < wait_ms)) {
+            wait_ms = quic_deadline;
+        }
+        if (mcp_wait_io(session, wait_ms) == FAILURE) {
+            return FAILURE;
+        }
+        quicpro_session_pump_rx(session);
+        if (quiche_conn_timeout_as_millis(session->conn) == 0) {
+            quiche_conn_on_timeout(session->conn);
+        }
+    }
+}
+
+/* Feeds the streaming IIBIN encoder's chunks into the request body */
+typedef struct {
+    quicpro_iibin_sink  base;
+    quicpro_session_t  *session;
+    mcp_call_t         *call;
+    uint64_t            stream_id;
+} mcp_body_sink;
+
+static int mcp_body_sink_write(quicpro_iibin_sink *sink, const uint8_t *data, size_t len) {
+    mcp_body_sink *s = (mcp_body_sink *)sink;
+    return mcp_send_body(s->session, s->call, s->stream_id, data, len, false);
+}
+
+/*
+ * A request with a known IIBIN schema names it by ID
+ * (include/iibin/iibin_descriptor.h). The descriptor goes along until the
+ * peer has answered a call with that ID on this connection; from then on
+ * the ID alone is enough. Known IDs live in a small ring on the session.
+ */
+static bool mcp_peer_knows_schema(const quicpro_session_t *session, uint32_t id) {
+    for (size_t i = 0; i < QUICPRO_IIBIN_PEER_SCHEMAS; i++) {
+        if (session->iibin_peer_schemas[i] == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void mcp_peer_learned_schema(quicpro_session_t *session, uint32_t id) {
+    if (mcp_peer_knows_schema(session, id)) {
+        return;
+    }
+    session->iibin_peer_schemas[session->iibin_peer_next] = id;
+    session->iibin_peer_next = (uint8_t)((session->iibin_peer_next + 1) % QUICPRO_IIBIN_PEER_SCHEMAS);
+}
+
+static void mcp_peer_forgot_schema(quicpro_session_t *session, uint32_t id) {
+    for (size_t i = 0; i < QUICPRO_IIBIN_PEER_SCHEMAS; i++) {
+        if (session->iibin_peer_schemas[i] == id) {
+            session->iibin_peer_schemas[i] = 0;
+        }
+    }
+}
+
+static void mcp_call_announce_schema(quicpro_session_t *session, mcp_call_t *call) {
+    if (!call->described) {
+        return;
+    }
+    snprintf(call->schema_id, sizeof(call->schema_id), "%08x", call->described->fingerprint);
+    call->headers[call->header_count++] = (quiche_h3_header){ .name = (uint8_t *)"quicpro-iibin-schema", .name_len = 20, .value = (uint8_t *)call->schema_id, .value_len = 8 };
+    if (!mcp_peer_knows_schema(session, call->described->fingerprint)) {
+        mcp_call_describe_schema(call);
+    }
+}
+
+static void mcp_call_describe_schema(mcp_call_t *call) {
+    if (call->descriptor_b64) {
+        return;
+    }
+    call->descriptor_b64 = php_base64_encode((const unsigned char *)call->described->descriptor, call->described->descriptor_len);
+    call->headers[call->header_count++] = (quiche_h3_header){ .name = (uint8_t *)"quicpro-iibin-descriptor", .name_len = 24,
+                                                             .value = (uint8_t *)ZSTR_VAL(call->descriptor_b64), .value_len = ZSTR_LEN(call->descriptor_b64) };
+}
+
+/* A tensor response that will not be used, along with the headers that announced it */
+static void mcp_call_drop_tensor(mcp_call_t *call) {
+    if (call->upload) {
+        quicpro_gpu_upload_abort(call->upload);
+        call->upload = NULL;
+    }
+    memset(&call->tensor_head, 0, sizeof(call->tensor_head));
+}
+
+static void mcp_call_release(quicpro_session_t *session, mcp_call_t *call) {
+    mcp_call_cancel(session, call);     /* Still in flight: abandoned after an error */
+    smart_str_free(&call->response);
+    mcp_call_drop_tensor(call);
+    if (call->error) {
+        zend_string_release(call->error);
+        call->error = NULL;
+    }
+    if (call->descriptor_b64) {
+        zend_string_release(call->descriptor_b64);
+        call->descriptor_b64 = NULL;
+    }
+}
+
+/* quiche_h3_event_for_each_header() callback: notes a peer that lacks the schema, an Arrow or tensor body, and a download's length */
+static int mcp_scan_response_header(uint8_t *name, size_t name_len, uint8_t *value, size_t value_len, void *argp) {
+    mcp_call_t *call = (mcp_call_t *)argp;
+    if (name_len == sizeof("quicpro-iibin-schema-unknown") - 1 && memcmp(name, "quicpro-iibin-schema-unknown", name_len) == 0) {
+        call->schema_unknown = true;
+    } else if (name_len == sizeof("content-type") - 1 && memcmp(name, "content-type", name_len) == 0) {
+        call->arrow = value_len == sizeof(QUICPRO_DF_ARROW_STREAM_TYPE) - 1 && memcmp(value, QUICPRO_DF_ARROW_STREAM_TYPE, value_len) == 0;
+        quicpro_gpu_tensor_header(&call->tensor_head, name, name_len, value, value_len);
+    } else if (quicpro_gpu_tensor_header(&call->tensor_head, name, name_len, value, value_len)) {
+        /* The tensor's dtype or shape */
+    } else if (name_len == sizeof("content-length") - 1 && memcmp(name, "content-length", name_len) == 0) {
+        zend_long length = quicpro_body_length(value, value_len);
+        if (!call->sink) {
+            quicpro_body_reserve(&call->response, length);
+        } else if (length >= 0) {
+            call->sink->total = (zend_long)call->sink->offset + length;   /* What follows the resume offset */
+        }
+    }
+    return 0;
+}
 
-        /*
-         * This polling logic would be very similar to what's in `poll.c`,
-         * but focused on finding the response for a specific stream.
-         * For this skeleton, we'll simulate the core logic.
-         */
+/*──── Calls in flight ────*/
 
-        /* Step 1: Drain egress queue */
-        /* You must always send what's in quiche's buffer */
-        /* A real implementation would have a dedicated send_all_pending() helper */
+static void mcp_track(quicpro_session_t *session, mcp_call_t *call, int64_t stream_id) {
+    if (!session->mcp) {
+        session->mcp = ecalloc(1, sizeof(quicpro_mcp_inflight_t));
+        zend_hash_init(&session->mcp->streams, 8, NULL, NULL, 0);
+    }
+    call->stream_id = stream_id;
+    zend_hash_index_update_ptr(&session->mcp->streams, (zend_ulong)stream_id, call);
+}
+
+static void mcp_untrack(quicpro_session_t *session, mcp_call_t *call) {
+    if (call->stream_id >= 0) {
+        zend_hash_index_del(&session->mcp->streams, (zend_ulong)call->stream_id);
+        call->stream_id = -1;
+    }
+}
+
+void quicpro_mcp_inflight_free(quicpro_mcp_inflight_t *inflight) {
+    if (!inflight) {
+        return;
+    }
+    zend_hash_destroy(&inflight->streams);
+    efree(inflight);
+}
+
+bool quicpro_mcp_inflight_idle(const quicpro_mcp_inflight_t *inflight) {
+    return !inflight || zend_hash_num_elements(&inflight->streams) == 0;
+}
 
-        /* Step 2: Read from socket and feed to quiche */
-        /* A real implementation would have a dedicated recv_and_process() helper */
+/*
+ * A call's stream is over, for good (done) or to be sent again. If the
+ * caller that made it is parked, another one read the event and has to
+ * wake it: the datagram is consumed, so its socket stays quiet.
+ */
+static void mcp_call_wake(quicpro_session_t *session, mcp_call_t *call) {
+    mcp_untrack(session, call);
+    if (call->parked) {
+        quicpro_sched_wake(session);
+    }
+}
 
-        /* Step 3: Poll for H3 events */
-        quiche_h3_event *ev;
-        while (quiche_h3_conn_poll(session->h3, session->conn, &ev) > 0) {
-            if (quiche_h3_event_stream_id(ev) != stream_id) {
-                // Event for another stream. Ignore for this simple synchronous case.
-                // A more advanced client would need to queue or handle this.
-                continue;
+static void mcp_call_finish(quicpro_session_t *session, mcp_call_t *call, zend_string *error) {
+    call->error = error;
+    call->done = true;
+    mcp_call_wake(session, call);
+}
+
+static void mcp_call_on_finished(quicpro_session_t *session, mcp_call_t *call) {
+    if (!call->described) {
+        mcp_call_finish(session, call, NULL);
+        return;
+    }
+    if (!call->schema_unknown) {
+        mcp_peer_learned_schema(session, call->described->fingerprint);
+        mcp_call_finish(session, call, NULL);
+        return;
+    }
+    /* The peer lost the schema (restart, eviction): send it along, once */
+    mcp_peer_forgot_schema(session, call->described->fingerprint);
+    if (call->descriptor_b64) {
+        mcp_call_finish(session, call, strpprintf(0, "MCP peer for service '%s' does not accept IIBIN schema '%s' (id %s).",
+                                                  call->service_name, call->described->schema_name, call->schema_id));
+        return;
+    }
+    call->resend = true;
+    mcp_call_wake(session, call);
+}
+
+/* A tensor body goes from quiche straight into pinned buffers, and from there to the GPU */
+static void mcp_recv_tensor(quicpro_session_t *session, mcp_call_t *call, uint64_t stream_id) {
+    uint8_t *to, past[1];
+    size_t room;
+    ssize_t n = 0;
+    bool ok;
+
+    while ((ok = quicpro_gpu_upload_room(call->upload, &to, &room))) {
+        if (!room) {
+            to = past;                  /* Complete: a byte more is one too many */
+            room = sizeof(past);
+        }
+        if ((n = quiche_h3_recv_body(session->h3, session->conn, stream_id, to, room)) <= 0) {
+            break;
+        }
+        if (to == past) {
+            ok = quicpro_gpu_fail("the body is longer than its quicpro-tensor-shape");
+            break;
+        }
+        if (!(ok = quicpro_gpu_upload_commit(call->upload, (size_t)n))) {
+            break;
+        }
+    }
+    /* The pinned buffer goes to the device before other streams' bodies need it */
+    ok = quicpro_gpu_upload_flush(call->upload) && ok;
+    if (!ok) {
+        mcp_call_cancel(session, call);
+        mcp_call_finish(session, call, strpprintf(0, "MCP response for service '%s': %s", call->service_name, quicpro_gpu_error()));
+    } else if (n < 0 && n != QUICHE_H3_ERR_DONE) {
+        mcp_call_finish(session, call, strpprintf(0, "Failed to receive MCP response body on stream %llu (quiche error %d)",
+                                                  (unsigned long long)stream_id, (int)n));
+    }
+}
+
+bool quicpro_mcp_dispatch(quicpro_session_t *session, quiche_h3_event *ev, uint64_t stream_id) {
+    mcp_call_t *call;
+
+    if (!session->mcp || !(call = zend_hash_index_find_ptr(&session->mcp->streams, (zend_ulong)stream_id))) {
+        return false;
+    }
+
+    switch (quiche_h3_event_type(ev)) {
+        case QUICHE_H3_EVENT_HEADERS:
+            /* A full implementation would parse headers and check for e.g. :status != 200 */
+            quiche_h3_event_for_each_header(ev, mcp_scan_response_header, call);
+            if (call->tensor_head.tensor && !call->sink && !call->upload
+                && !(call->upload = quicpro_gpu_upload_from_head(&call->tensor_head))) {
+                mcp_call_cancel(session, call);
+                mcp_call_finish(session, call, strpprintf(0, "MCP response for service '%s' is a tensor that cannot be placed on the GPU: %s",
+                                                          call->service_name, quicpro_gpu_error()));
             }
+            break;
 
-            switch (quiche_h3_event_type(ev)) {
-                case QUICHE_H3_EVENT_HEADERS:
-                    /* Response headers received. Check status code. */
-                    /* A full implementation would parse headers and check for e.g. :status != 200 */
-                    break;
-
-                case QUICHE_H3_EVENT_DATA: {
-                    /* Data received for our stream. */
-                    uint8_t buf[8192];
-                    ssize_t read_len = quiche_h3_recv_body(session->h3, session->conn, stream_id, buf, sizeof(buf));
-                    if (read_len < 0) {
-                         throw_quiche_error_as_php_exception((int)read_len, "Failed to receive MCP response body on stream %llu", (unsigned long long)stream_id);
-                         return FAILURE;
+        case QUICHE_H3_EVENT_DATA: {
+            uint8_t buf[16384];
+            ssize_t n;
+            if (call->upload) {
+                mcp_recv_tensor(session, call, stream_id);
+                break;
+            }
+            if (!call->sink) {
+                /* Straight into the response string (client/body.h) */
+                n = quicpro_body_recv_h3(session->h3, session->conn, stream_id, &call->response);
+                size_t have = call->response.s ? ZSTR_LEN(call->response.s) : 0;
+                if (call->on_chunk && !call->schema_unknown && have > call->chunk_seen) {
+                    call->on_chunk(call->chunk_arg, ZSTR_VAL(call->response.s) + call->chunk_seen, have - call->chunk_seen);
+                    call->chunk_seen = have;
+                    if (call->parked) {
+                        quicpro_sched_wake(session);   /* Its caller's loop takes the chunk now, not at the end */
+                    }
+                }
+            } else {
+                while ((n = quiche_h3_recv_body(session->h3, session->conn, stream_id, buf, sizeof(buf))) > 0) {
+                    if (mcp_transfer_write(call->sink, buf, (size_t)n) == FAILURE) {
+                        mcp_call_cancel(session, call);
+                        mcp_call_finish(session, call, strpprintf(0, "MCP download for service '%s' could not write to the stream at offset " ZEND_LONG_FMT ".",
+                                                                  call->service_name, (zend_long)call->sink->offset));
+                        break;
                     }
-                    smart_str_appendl(response_body_buf, (char*)buf, read_len);
-                    break;
                 }
-                case QUICHE_H3_EVENT_FINISHED:
-                    /* The stream is fully closed. We have our complete response. */
-                    return SUCCESS;
-                default:
-                    break;
             }
+            if (n < 0 && n != QUICHE_H3_ERR_DONE) {
+                mcp_call_finish(session, call, strpprintf(0, "Failed to receive MCP response body on stream %llu (quiche error %d)",
+                                                          (unsigned long long)stream_id, (int)n));
+            }
+            break;
+        }
+
+        case QUICHE_H3_EVENT_FINISHED:
+            mcp_call_on_finished(session, call);
+            break;
+
+        case QUICHE_H3_EVENT_RESET:
+            if (call->sent_early) {
+                call->replay = true;    /* Resent once the handshake is done */
+                mcp_call_wake(session, call);
+            } else {
+                mcp_call_finish(session, call, strpprintf(0, "MCP stream %llu was reset by the server.", (unsigned long long)stream_id));
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    quiche_h3_event_free(ev);
+    return true;
+}
+
+/* Files every pending HTTP/3 event of the session under the call or batched request it belongs to. */
+static void mcp_read_events(quicpro_session_t *session) {
+    quiche_h3_event *ev;
+    int64_t stream_id;
+
+    while ((stream_id = quicpro_prof_h3_conn_poll(session->h3, session->conn, &ev)) >= 0) {
+        if (!quicpro_mcp_dispatch(session, ev, (uint64_t)stream_id)
+            && !quicpro_h3_mux_dispatch(session, ev, (uint64_t)stream_id)) {
+            quiche_h3_event_free(ev);   /* Nobody is waiting for it */
+        }
+    }
+}
+
+/*──── Sending ────*/
+
+/* Sends the call on a new stream and files it there; the response may arrive while the body is still going out. */
+static int mcp_send_call(quicpro_session_t *session, mcp_call_t *call) {
+    mcp_call_stamp_deadline(call);
+    int64_t stream_id = quiche_h3_send_request(session->h3, session->conn, call->headers, call->header_count, 0);
+    if (stream_id < 0) {
+        throw_quiche_error_as_php_exception((int)stream_id, "MCP request failed: could not send H3 headers for service '%s'", call->service_name);
+        return FAILURE;
+    }
+    mcp_track(session, call, stream_id);
+
+    /*
+     * A message is encoded in chunks as the stream window allows, so the
+     * request never exists as one string; replays encode it again.
+     */
+    if (call->schema) {
+        mcp_body_sink sink = { .base.write = mcp_body_sink_write, .session = session, .call = call, .stream_id = (uint64_t)stream_id };
+        if (quicpro_iibin_encode_to_sink(call->schema, call->message, &sink.base) == FAILURE
+            || mcp_send_body(session, call, (uint64_t)stream_id, NULL, 0, true) == FAILURE) {
+            return FAILURE;
+        }
+    } else if (call->frame) {
+        /* A frame's buffers go to quiche from the columns themselves; only the metadata is built */
+        quicpro_df_ipc_t ipc;
+        int result = SUCCESS;
+        quicpro_df_ipc_plan(quicpro_dataframe_from_obj(call->frame), &ipc);
+        for (size_t i = 0; i < ipc.count && result == SUCCESS; i++) {
+            result = mcp_send_body(session, call, (uint64_t)stream_id, quicpro_df_ipc_chunk_data(&ipc, i), ipc.chunks[i].len, i + 1 == ipc.count);
+        }
+        quicpro_df_ipc_free(&ipc);
+        if (result == FAILURE) {
+            return FAILURE;
+        }
+    } else if (mcp_send_body(session, call, (uint64_t)stream_id, call->payload, call->payload_len, true) == FAILURE) {
+        return FAILURE;
+    }
+
+    call->sent_early = quiche_conn_is_in_early_data(session->conn);
+    return SUCCESS;
+}
+
+/* Throws once the client of the request this handler serves gave up on it (server/cancel.h). */
+static int mcp_check_cancelled(void) {
+    if (quicpro_cancel_requested()) {
+        if (!EG(exception)) {
+            throw_mcp_error_as_php_exception(0, "MCP call abandoned: the request it serves was cancelled by its client.");
+        }
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/*
+ * Waits for the next datagram or `wait_ms` (-1: none), parking the Fiber if
+ * there is one. In a served request the listener's socket is watched too:
+ * a Fiber wakes every QUICPRO_CANCEL_SLICE_MS to look at it.
+ */
+static int mcp_wait_io(quicpro_session_t *session, zend_long wait_ms) {
+    int cancel_fd = quicpro_cancel_watch_fd();
+    if (cancel_fd >= 0 && quicpro_sched_in_fiber()) {
+        wait_ms = wait_ms < 0 ? QUICPRO_CANCEL_SLICE_MS : MIN(wait_ms, QUICPRO_CANCEL_SLICE_MS);
+    }
+    switch (quicpro_sched_wait(session, session->resource, wait_ms)) {
+        case QUICPRO_SCHED_ERROR:
+            /* Exception thrown into the fiber; propagate it */
+            return FAILURE;
+        case QUICPRO_SCHED_NO_FIBER: {
+            /* poll() skips the negative fd when nothing is served */
+            struct pollfd pfd[2] = { { .fd = session->sock, .events = POLLIN }, { .fd = cancel_fd, .events = POLLIN } };
+            if (poll(pfd, 2, wait_ms < 0 ? -1 : (int)MIN(wait_ms, INT_MAX)) < 0 && errno != EINTR) {
+                throw_mcp_error_as_php_exception(0, "MCP wait failed: %s", strerror(errno));
+                return FAILURE;
+            }
+            return mcp_check_cancelled();
         }
+        default:
+            return mcp_check_cancelled();
+    }
+}
+
+static zend_long mcp_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (zend_long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-        /* Step 4: Check if connection died */
+/* Drives the connection until the handshake completes. */
+static int mcp_wait_handshake(quicpro_session_t *session, zend_long timeout_ms) {
+    zend_long start_time = mcp_now_ms();
+
+    while (!quiche_conn_is_established(session->conn)) {
+        zend_long elapsed = mcp_now_ms() - start_time;
         if (quiche_conn_is_closed(session->conn)) {
-            throw_mcp_error_as_php_exception(0, "MCP connection closed while waiting for response on stream %llu.", (unsigned long long)stream_id);
+            throw_mcp_error_as_php_exception(0, "MCP connection closed during the handshake.");
+            return FAILURE;
+        }
+        if (timeout_ms > 0 && elapsed > timeout_ms) {
+            throw_mcp_error_as_php_exception(0, "MCP handshake timed out after %ld ms.", timeout_ms);
+            return FAILURE;
+        }
+
+        quicpro_session_pump_tx(session);
+        zend_long wait_ms = timeout_ms > 0 ? timeout_ms - elapsed : -1;
+        int64_t quic_deadline = quiche_conn_timeout_as_millis(session->conn);
+        if (quic_deadline >= 0 && (wait_ms < 0 || quic_deadline < wait_ms)) {
+            wait_ms = quic_deadline;
+        }
+        if (mcp_wait_io(session, wait_ms) == FAILURE) {
+            return FAILURE;
+        }
+        quicpro_session_pump_rx(session);
+        if (quiche_conn_timeout_as_millis(session->conn) == 0) {
+            quiche_conn_on_timeout(session->conn);
+        }
+    }
+    return SUCCESS;
+}
+
+/*
+ * One round of the session for `call`: drives it with the same RX/TX pumps
+ * as quicpro_poll(), sends the call again if it has to, and hands every H3
+ * event to the call or batched request that owns its stream. Events read
+ * here may complete other calls on the session as well.
+ */
+static int mcp_call_round(quicpro_session_t *session, mcp_call_t *call) {
+    /* Step 1: Drain egress queue (request body, ACKs, retransmits) */
+    quicpro_session_pump_tx(session);
+
+    /* Step 2: Read from socket and feed to quiche */
+    quicpro_session_pump_rx(session);
+    if (quiche_conn_timeout_as_millis(session->conn) == 0) {
+        quiche_conn_on_timeout(session->conn);
+    }
+
+    /*
+     * Step 2b: A call sent as 0-RTT data goes out again once if the
+     * server refused it: a full handshake (no resumption) discards all
+     * early data, and a reset of the early stream means the same. A
+     * peer that lacked the call's schema gets it again with the
+     * descriptor.
+     */
+    if (call->sent_early && quiche_conn_is_established(session->conn)) {
+        call->replay = call->replay || !quiche_conn_is_resumed(session->conn);
+        call->sent_early = call->replay;
+    }
+    if ((call->replay && quiche_conn_is_established(session->conn)) || call->resend) {
+        if (call->resend) {
+            call->schema_unknown = false;
+            mcp_call_describe_schema(call);
+        }
+        call->replay = call->resend = false;
+        mcp_untrack(session, call);
+        smart_str_free(&call->response);
+        call->chunk_seen = 0;
+        mcp_call_drop_tensor(call);
+        if (mcp_send_call(session, call) == FAILURE) {   /* Now 1-RTT, never again early */
             return FAILURE;
         }
+        quicpro_session_pump_tx(session);
+    }
+
+    /* Step 3: Hand every H3 event to the call or batched request that owns its stream */
+    mcp_read_events(session);
+    if (call->sink && mcp_transfer_report(call->sink) == FAILURE) {
+        return mcp_transfer_abort(session, call, call->sink);
+    }
 
-        /* Give the OS a small break to avoid pinning the CPU at 100% in this simple loop */
-        usleep(1000); // 1ms sleep
+    /* Step 4: Check if connection died */
+    if (!call->done && quiche_conn_is_closed(session->conn)) {
+        throw_mcp_error_as_php_exception(0, "MCP connection closed while waiting for the response for service '%s'.", call->service_name);
+        return FAILURE;
     }
+    return SUCCESS;
+}
+
+/* The nearer of a wait and the session's next quiche timer */
+static zend_long mcp_wait_for_timer(quicpro_session_t *session, zend_long wait_ms) {
+    int64_t quic_deadline = quiche_conn_timeout_as_millis(session->conn);
+    if (quic_deadline >= 0 && (wait_ms < 0 || quic_deadline < wait_ms)) {
+        wait_ms = quic_deadline;
+    }
+    return wait_ms;
+}
+
+static int mcp_poll_for_response(quicpro_session_t *session, mcp_call_t *call) {
+    /*
+     * Between rounds we wait for the socket instead of sleeping: inside a
+     * Fiber the fiber is parked in the native scheduler (other fibers keep
+     * running), otherwise poll() blocks on the socket until the next quiche
+     * deadline. Another fiber's loop may complete this call.
+     */
+    while (!call->done) {
+        /* Check for the call's own deadline */
+        zend_long wait_ms = -1;
+        if (call->deadline_ms) {
+            wait_ms = call->deadline_ms - mcp_now_ms();
+            if (wait_ms <= 0) {
+                throw_mcp_error_as_php_exception(0, "MCP request for service '%s' timed out while waiting for the response.", call->service_name);
+                return FAILURE;
+            }
+        }
+
+        if (mcp_call_round(session, call) == FAILURE) {
+            return FAILURE;
+        }
+        if (call->done) {
+            break;
+        }
+
+        /* Step 5: Wait for the next datagram, quiche deadline, our deadline or another caller's wake-up */
+        quicpro_session_pump_tx(session);
+        wait_ms = mcp_wait_for_timer(session, wait_ms);
+
+        call->parked = true;
+        int waited = mcp_wait_io(session, wait_ms);
+        call->parked = false;
+        if (waited == FAILURE) {
+            return FAILURE;
+        }
+    }
+
+    if (call->error) {
+        throw_mcp_error_as_php_exception(0, "%s", ZSTR_VAL(call->error));
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/* mcp_wait_io() on two sessions. A Fiber parks on the first and looks at the second every MCP_HEDGE_SLICE_MS. */
+static int mcp_wait_io_pair(quicpro_session_t *a, quicpro_session_t *b, zend_long wait_ms) {
+    if (quicpro_sched_in_fiber()) {
+        return mcp_wait_io(a, wait_ms < 0 ? MCP_HEDGE_SLICE_MS : MIN(wait_ms, MCP_HEDGE_SLICE_MS));
+    }
+    struct pollfd pfd[3] = { { .fd = a->sock, .events = POLLIN }, { .fd = b->sock, .events = POLLIN },
+                             { .fd = quicpro_cancel_watch_fd(), .events = POLLIN } };
+    if (poll(pfd, 3, wait_ms < 0 ? -1 : (int)MIN(wait_ms, INT_MAX)) < 0 && errno != EINTR) {
+        throw_mcp_error_as_php_exception(0, "MCP wait failed: %s", strerror(errno));
+        return FAILURE;
+    }
+    return mcp_check_cancelled();
+}
 
-    return FAILURE; // Should not be reached unless timeout logic is flawed
-}
\ No newline at end of file
+/*
+ * One round for one copy of a hedged call; true once it has answered. A
+ * copy that fails is lost; its error is dropped while `other` may still
+ * answer, and thrown otherwise.
+ */
+static bool mcp_hedge_round(quicpro_session_t *session, mcp_call_t *call, int *leg, bool other) {
+    if (mcp_call_round(session, call) == FAILURE) {
+        *leg = MCP_LEG_LOST;
+        if (other) {
+            zend_clear_exception();
+        }
+        return false;
+    }
+    if (call->done && call->error) {
+        *leg = MCP_LEG_LOST;
+        if (!other) {
+            throw_mcp_error_as_php_exception(0, "%s", ZSTR_VAL(call->error));
+        }
+        return false;
+    }
+    return call->done;
+}
+
+/*
+ * Waits for whichever of two copies of a call answers first: `call` on
+ * `session`, and `backup` on `hedge`, sent once hedge_at_ms passes without
+ * a response, or as soon as `call` fails. The backup only leaves on an
+ * established connection, never as 0-RTT data. Returns the copy that
+ * answered, or NULL after throwing; the caller cancels the other one.
+ */
+static mcp_call_t *mcp_poll_hedged(quicpro_session_t *session, mcp_call_t *call, quicpro_session_t *hedge, mcp_call_t *backup, zend_long hedge_at_ms) {
+    int primary = MCP_LEG_OUT, second = MCP_LEG_PENDING;
+
+    for (;;) {
+        zend_long now = mcp_now_ms(), wait_ms = -1;
+        if (call->deadline_ms) {
+            wait_ms = call->deadline_ms - now;
+            if (wait_ms <= 0) {
+                throw_mcp_error_as_php_exception(0, "MCP request for service '%s' timed out while waiting for the response.", call->service_name);
+                return NULL;
+            }
+        }
+
+        if (second == MCP_LEG_PENDING && (now >= hedge_at_ms || primary == MCP_LEG_LOST)
+            && quiche_conn_is_established(hedge->conn)) {
+            mcp_call_announce_schema(hedge, backup);
+            second = mcp_send_call(hedge, backup) == SUCCESS ? MCP_LEG_OUT : MCP_LEG_LOST;
+            if (second == MCP_LEG_LOST) {
+                if (primary == MCP_LEG_LOST) {
+                    return NULL;
+                }
+                zend_clear_exception();
+            }
+        }
+
+        if (primary == MCP_LEG_OUT && mcp_hedge_round(session, call, &primary, second != MCP_LEG_LOST)) {
+            return call;
+        }
+        if (second != MCP_LEG_LOST && mcp_hedge_round(hedge, backup, &second, primary == MCP_LEG_OUT)) {
+            return backup;
+        }
+        if (primary == MCP_LEG_LOST && second == MCP_LEG_LOST) {
+            return NULL;
+        }
+
+        /* Wait for either connection, either's quiche timer, the hedge delay or the deadline */
+        if (primary == MCP_LEG_OUT) {
+            quicpro_session_pump_tx(session);
+            wait_ms = mcp_wait_for_timer(session, wait_ms);
+        }
+        quicpro_session_pump_tx(hedge);
+        wait_ms = mcp_wait_for_timer(hedge, wait_ms);
+        if (second == MCP_LEG_PENDING && primary == MCP_LEG_OUT
+            && (wait_ms < 0 || hedge_at_ms - now < wait_ms)) {
+            wait_ms = MAX(hedge_at_ms - now, 0);
+        }
+
+        call->parked = backup->parked = true;
+        int waited = mcp_wait_io_pair(session, hedge, wait_ms);
+        call->parked = backup->parked = false;
+        if (waited == FAILURE) {
+            return NULL;
+        }
+    }
+}
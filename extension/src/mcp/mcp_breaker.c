@@ -0,0 +1,256 @@
+/*
+ * src/mcp_breaker.c – Circuit breaker and adaptive concurrency limit per MCP target
+ * ================================================================================
+ *
+ * See include/mcp/mcp_breaker.h. A target's state is one slot of a fixed
+ * per-worker table, picked by the hash of host and port, so admitting a
+ * call allocates nothing. The window is two 64-bit rings, one bit per
+ * call: failed, and slow. Drained targets are a small process-wide set
+ * of hashes, since the admin thread sets them for every thread.
+ */
+
+#include "php_quicpro.h"
+#include "mcp_breaker.h"
+#include "config/mcp_and_orchestrator/base_layer.h"
+#include "server/admin_events.h"
+
+#include <arpa/inet.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+enum { BREAKER_CLOSED, BREAKER_OPEN, BREAKER_HALF_OPEN };
+
+#define LIMIT_SHORT_ALPHA   0.5     /* Current response time: the last few calls */
+#define LIMIT_LONG_ALPHA    0.01    /* Long-term: about the last hundred */
+#define LIMIT_TOLERANCE     1.5     /* Responses this much slower than usual still count as usual */
+#define LIMIT_SMOOTHING     0.2
+#define LIMIT_FAILURE_CUT   0.9
+
+typedef struct {
+    zend_ulong hash;                /* Of host and port; 0: free */
+    char       target[64];          /* host:port, for breaker_open events */
+
+    /* Breaker */
+    uint8_t    state;
+    uint64_t   failed, slow;        /* Rings over the last MCP_BREAKER_WINDOW calls */
+    uint32_t   calls, next;
+    zend_long  open_until_ms;
+    uint32_t   probes_out, probes_ok;
+
+    /* Concurrency limit */
+    uint32_t   inflight;
+    double     limit;
+    double     rtt_short, rtt_long; /* Milliseconds; 0: no sample yet */
+} mcp_breaker_t;
+
+static ZEND_TLS mcp_breaker_t mcp_breakers[MCP_BREAKER_SLOTS];
+
+static _Atomic zend_ulong mcp_drained[MCP_BREAKER_SLOTS];   /* Target hashes; 0: free */
+static _Atomic uint32_t mcp_drained_count;
+
+static zend_long breaker_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (zend_long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static zend_ulong breaker_hash(const char *host, size_t host_len, uint16_t port) {
+    return (zend_inline_hash_func(host, host_len) * 33 + port) | 1;
+}
+
+static uint16_t breaker_target_port(const quicpro_session_t *session) {
+    if (session->peer_addr.ss_family == AF_INET) {
+        return ntohs(((const struct sockaddr_in *)&session->peer_addr)->sin_port);
+    }
+    if (session->peer_addr.ss_family == AF_INET6) {
+        return ntohs(((const struct sockaddr_in6 *)&session->peer_addr)->sin6_port);
+    }
+    return 0;
+}
+
+static bool breaker_drained(zend_ulong hash) {
+    for (size_t i = 0; i < MCP_BREAKER_SLOTS; i++) {
+        if (atomic_load_explicit(&mcp_drained[i], memory_order_relaxed) == hash) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool quicpro_mcp_drain(const char *host, size_t host_len, uint16_t port, bool drained) {
+    zend_ulong hash = breaker_hash(host, host_len, port);
+    if (drained && breaker_drained(hash)) {
+        return true;
+    }
+    for (size_t i = 0; i < MCP_BREAKER_SLOTS; i++) {
+        zend_ulong expected = drained ? 0 : hash;
+        if (atomic_compare_exchange_strong_explicit(&mcp_drained[i], &expected, drained ? hash : 0,
+                                                    memory_order_relaxed, memory_order_relaxed)) {
+            if (drained) {
+                atomic_fetch_add_explicit(&mcp_drained_count, 1, memory_order_relaxed);
+            } else {
+                atomic_fetch_sub_explicit(&mcp_drained_count, 1, memory_order_relaxed);
+            }
+            return true;
+        }
+    }
+    return !drained;    /* Undraining a target that was not drained is done, too */
+}
+
+static void breaker_reset_window(mcp_breaker_t *b) {
+    b->failed = b->slow = 0;
+    b->calls = b->next = 0;
+    b->probes_out = b->probes_ok = 0;
+}
+
+static void breaker_open(mcp_breaker_t *b, zend_long now) {
+    b->state = BREAKER_OPEN;
+    b->open_until_ms = now + quicpro_mcp_orchestrator_config.mcp_circuit_breaker_open_ms;
+    b->probes_out = b->probes_ok = 0;
+    quicpro_admin_event_publish(QUICPRO_ADMIN_EVENT_BREAKER_OPEN, b->target, strlen(b->target), 0);
+}
+
+quicpro_mcp_admission_t quicpro_mcp_guard_admit(quicpro_session_t *session, quicpro_mcp_guard_t *guard) {
+    const qp_mcp_orchestrator_config_t *cfg = &quicpro_mcp_orchestrator_config;
+    memset(guard, 0, sizeof(*guard));
+    uint16_t port = breaker_target_port(session);
+    zend_ulong hash = breaker_hash(session->host, strlen(session->host), port);
+    if (atomic_load_explicit(&mcp_drained_count, memory_order_relaxed) && breaker_drained(hash)) {
+        return MCP_GUARD_DRAINED;
+    }
+    if (!cfg->mcp_circuit_breaker_enable && !cfg->mcp_adaptive_concurrency_enable) {
+        return MCP_GUARD_ADMITTED;
+    }
+
+    mcp_breaker_t *b = &mcp_breakers[hash % MCP_BREAKER_SLOTS];
+    if (b->hash != hash) {
+        memset(b, 0, sizeof(*b));
+        b->hash = hash;
+        snprintf(b->target, sizeof(b->target), "%s:%u", session->host, port);
+        b->limit = (double)MIN(cfg->mcp_concurrency_limit_initial, cfg->mcp_concurrency_limit_max);
+    }
+
+    bool probe = false;
+    if (cfg->mcp_circuit_breaker_enable) {
+        if (b->state == BREAKER_OPEN && breaker_now_ms() >= b->open_until_ms) {
+            b->state = BREAKER_HALF_OPEN;
+        }
+        if (b->state == BREAKER_OPEN) {
+            return MCP_GUARD_OPEN;
+        }
+        if (b->state == BREAKER_HALF_OPEN) {
+            if (b->probes_out + b->probes_ok >= (uint32_t)cfg->mcp_circuit_breaker_half_open_probes) {
+                return MCP_GUARD_OPEN;
+            }
+            probe = true;
+        }
+    }
+    if (cfg->mcp_adaptive_concurrency_enable && b->inflight >= (uint32_t)MAX(b->limit, 1.0)) {
+        return MCP_GUARD_LIMITED;
+    }
+
+    if (probe) {
+        b->probes_out++;
+    }
+    b->inflight++;
+    guard->slot = b;
+    guard->hash = hash;
+    guard->probe = probe;
+    return MCP_GUARD_ADMITTED;
+}
+
+/* One call into the window; opens the breaker when the window says so. */
+static void breaker_record(mcp_breaker_t *b, bool failed, bool slow, zend_long now) {
+    const qp_mcp_orchestrator_config_t *cfg = &quicpro_mcp_orchestrator_config;
+    uint64_t bit = (uint64_t)1 << b->next;
+    b->failed = failed ? b->failed | bit : b->failed & ~bit;
+    b->slow = slow ? b->slow | bit : b->slow & ~bit;
+    b->next = (b->next + 1) % MCP_BREAKER_WINDOW;
+    if (b->calls < MCP_BREAKER_WINDOW) {
+        b->calls++;
+    }
+    if (b->calls < (uint32_t)cfg->mcp_circuit_breaker_min_calls) {
+        return;
+    }
+    uint32_t failures = (uint32_t)__builtin_popcountll(b->failed), slow_calls = (uint32_t)__builtin_popcountll(b->slow);
+    if (failures * 100 >= cfg->mcp_circuit_breaker_failure_rate_percent * b->calls
+        || slow_calls * 100 >= cfg->mcp_circuit_breaker_slow_call_rate_percent * b->calls) {
+        breaker_open(b, now);
+    }
+}
+
+/* The gradient step: grows the limit while responses keep their usual pace, shrinks it as they slow down. */
+static void limit_sample(mcp_breaker_t *b, double rtt, uint32_t inflight) {
+    double max_limit = (double)quicpro_mcp_orchestrator_config.mcp_concurrency_limit_max;
+    if (b->rtt_long == 0) {
+        b->rtt_short = b->rtt_long = rtt;
+    } else {
+        b->rtt_short += LIMIT_SHORT_ALPHA * (rtt - b->rtt_short);
+        b->rtt_long += LIMIT_LONG_ALPHA * (rtt - b->rtt_long);
+        if (b->rtt_long > 2 * b->rtt_short) {
+            b->rtt_long *= 0.95;    /* The agent got faster; do not wait a hundred calls to notice */
+        }
+    }
+    if ((double)inflight < b->limit / 2) {
+        return;                     /* Idle: the response time says nothing about the limit */
+    }
+    double gradient = MAX(0.5, MIN(1.0, LIMIT_TOLERANCE * b->rtt_long / b->rtt_short));
+    double target = b->limit * gradient + sqrt(b->limit);
+    b->limit = MAX(1.0, MIN(max_limit, b->limit * (1 - LIMIT_SMOOTHING) + target * LIMIT_SMOOTHING));
+}
+
+void quicpro_mcp_guard_done(quicpro_mcp_guard_t *guard, quicpro_mcp_outcome_t outcome, zend_long latency_ms) {
+    mcp_breaker_t *b = guard->slot;
+    guard->slot = NULL;
+    if (!b || b->hash != guard->hash) {
+        return;                     /* Not guarded, or the slot went to another target meanwhile */
+    }
+    const qp_mcp_orchestrator_config_t *cfg = &quicpro_mcp_orchestrator_config;
+    uint32_t inflight = b->inflight;
+    if (b->inflight) {
+        b->inflight--;
+    }
+    if (outcome == MCP_GUARD_DROPPED) {
+        if (guard->probe && b->probes_out) {
+            b->probes_out--;
+        }
+        return;
+    }
+
+    bool ok = outcome == MCP_GUARD_OK;
+    if (cfg->mcp_adaptive_concurrency_enable) {
+        if (ok) {
+            limit_sample(b, (double)MAX(latency_ms, 1), inflight);
+        } else {
+            b->limit = MAX(1.0, b->limit * LIMIT_FAILURE_CUT);
+        }
+    }
+
+    if (!cfg->mcp_circuit_breaker_enable) {
+        return;
+    }
+    zend_long now = breaker_now_ms();
+    bool slow = ok && latency_ms >= cfg->mcp_circuit_breaker_slow_call_ms;
+    if (guard->probe) {
+        if (b->state != BREAKER_HALF_OPEN) {
+            return;                 /* Another probe decided already */
+        }
+        if (b->probes_out) {
+            b->probes_out--;
+        }
+        if (!ok || slow) {
+            breaker_open(b, now);
+        } else if (++b->probes_ok >= (uint32_t)cfg->mcp_circuit_breaker_half_open_probes) {
+            b->state = BREAKER_CLOSED;
+            breaker_reset_window(b);
+        }
+        return;
+    }
+    if (b->state == BREAKER_CLOSED) {
+        breaker_record(b, !ok, slow, now);
+    }
+}
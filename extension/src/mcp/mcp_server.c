@@ -0,0 +1,1004 @@
+/*
+ * src/mcp_server.c – Native MCP request routing on the HTTP/3 listener
+ * ====================================================================
+ *
+ * The server half of mcp.c: a route table from "/service/method" to a
+ * handler and its IIBIN schemas, and per connection the requests whose
+ * body is still arriving or whose response is still going out. See
+ * include/mcp/mcp_server.h for the PHP side.
+ */
+
+#include "php_quicpro.h"
+#include "mcp/mcp_server.h"
+#include "mcp/mcp.h"                   /* Handlers' own calls inherit the deadline */
+#include "client/session.h"
+#include "iibin/iibin_internal.h" /* Decodes requests, streams responses */
+#include "cancel.h"               /* For error throwing helpers */
+#include "cluster/cluster_stats.h" /* Per-worker request counters */
+#include "server/open_telemetry.h" /* A server span per call, continuing the caller's trace */
+#include "server/metrics.h" /* Handler durations and stream counts */
+#include "server/profiler.h" /* Hot path timers */
+#include "server/h3_settings.h" /* SETTINGS from quicpro.h3_* */
+#include "server/cancel.h" /* Handlers stop when their caller gives up */
+#include "server/io_thread.h" /* A batch spans connections the I/O thread may hold */
+#include "server/overload.h" /* Shed by priority when the worker falls behind */
+#include "server/access_log.h" /* A record per answered request */
+#include "config/high_perf_compute_and_ai/base_layer.h"
+#include "dataframe/dataframe.h"  /* DataFrame requests and responses */
+#include "dataframe/arrow_ipc.h"  /* ... as Arrow IPC streams */
+#include "gpu/device.h"            /* Tensor requests go to the GPU */
+#include "gpu/tensor.h"            /* ... through pinned buffers */
+
+#include <quiche.h>
+#include <zend_API.h>
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+#include <zend_string.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MCP_SERVER_MAX_BODY (16 * 1024 * 1024)   /* Larger requests are answered 413 */
+#define MCP_BATCH_BUDGET_US 2000                  /* How long a batch waits to fill, unless 'batch_budget_us' says */
+#define MCP_SERVER_REQUEST_CANCELLED 0x10c       /* RFC 9114 H3_REQUEST_CANCELLED */
+
+extern int le_quicpro_session;
+
+typedef struct mcp_served_req_s mcp_served_req_t;
+
+typedef struct {
+    zend_fcall_info        fci;
+    zend_fcall_info_cache  fcc;
+    const quicpro_iibin_compiled_schema_internal *input;    /* NULL: the handler gets the raw body */
+    const quicpro_iibin_compiled_schema_internal *output;   /* NULL: the handler returns the body */
+    bool                   view;                            /* Hand over a Quicpro\IIBIN\View, not an array */
+    /* 'batch': requests wait here, in arrival order, for one handler call of up to batch_max */
+    uint32_t               batch_max;                       /* 0: a call per request */
+    uint32_t               batch_budget_us;
+    uint32_t               batched;
+    mcp_served_req_t      *batch_head, *batch_tail;
+} mcp_route_t;
+
+static ZEND_TLS HashTable *mcp_routes;   /* "/service/method" → mcp_route_t *, owning */
+
+/* One request on one stream, from its HEADERS until its response is sent. */
+struct mcp_served_req_s {
+    mcp_route_t       *route;          /* NULL: no handler for the path */
+    uint32_t           schema_id;      /* From quicpro-iibin-schema; 0: none */
+    zend_long          deadline_ms;    /* From quicpro-timeout-ms, mcp_server_now_ms() clock; 0: none */
+    quicpro_overload_class_t overload_class;   /* From priority */
+    uint64_t           arrived_us;     /* For overload shedding (server/overload.h) and the access log */
+    uint64_t           bytes_in;       /* Body bytes received, for the access log */
+    quicpro_otel_context_t parent;     /* From traceparent, if has_parent */
+    bool               has_parent;
+    char               span_name[QUICPRO_OTEL_NAME_MAX];   /* The path, without its leading '/' */
+    bool               too_large;
+    bool               arrow;          /* The body is an Arrow IPC stream */
+    /* A tensor body: received into pinned buffers and copied to the GPU as they fill */
+    quicpro_gpu_tensor_head_t tensor_head;
+    quicpro_gpu_upload_t *upload;
+    zend_string       *tensor_error;   /* Why the tensor could not be placed or received */
+    smart_str          body;
+    bool               answered;       /* The response is complete in `out` or sent */
+    bool               fin_sent;
+    smart_str          out;            /* Response bytes flow control has not taken yet */
+    size_t             out_off;
+    /* A DataFrame response: its stream's chunks, sent from the frame's columns */
+    zend_object       *frame;
+    quicpro_df_ipc_t   ipc;
+    size_t             chunk, chunk_off;
+    /* Waiting in its route's batch, decoded: where to answer it, once the batch ran */
+    bool               batched;
+    quicpro_session_t *session;
+    uint64_t           stream_id;
+    uint64_t           queued_us;      /* quicpro_metrics_now_us() clock */
+    zval               arg;
+    mcp_served_req_t  *batch_prev, *batch_next;
+};
+
+struct quicpro_mcp_served_s {
+    HashTable streams;   /* stream ID → mcp_served_req_t *, owning */
+};
+
+/*──── Routes ────*/
+
+static void mcp_route_dtor(zval *zv) {
+    mcp_route_t *route = Z_PTR_P(zv);
+    /* Left to their connections, which free them unanswered */
+    for (mcp_served_req_t *req = route->batch_head; req; req = req->batch_next) {
+        req->batched = false;
+    }
+    zval_ptr_dtor(&route->fci.function_name);
+    efree(route);
+}
+
+static const quicpro_iibin_compiled_schema_internal *mcp_route_schema(HashTable *opts, const char *key, size_t key_len) {
+    zval *zv = opts ? zend_hash_str_find(opts, key, key_len) : NULL;
+    if (!zv || Z_TYPE_P(zv) == IS_NULL) {
+        return NULL;
+    }
+    if (Z_TYPE_P(zv) != IS_STRING) {
+        zend_type_error("Option \"%s\" must be an IIBIN schema name", key);
+        return NULL;
+    }
+    const quicpro_iibin_compiled_schema_internal *schema = get_compiled_iibin_schema_internal(Z_STRVAL_P(zv));
+    if (!schema) {
+        throw_mcp_error_as_php_exception(0, "MCP route: IIBIN schema '%s' is not defined.", Z_STRVAL_P(zv));
+    }
+    return schema;
+}
+
+PHP_FUNCTION(quicpro_mcp_server_register)
+{
+    char *service_name, *method_name;
+    size_t service_name_len, method_name_len;
+    zend_fcall_info fci;
+    zend_fcall_info_cache fcc;
+    zval *options = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(3, 4)
+        Z_PARAM_STRING(service_name, service_name_len)
+        Z_PARAM_STRING(method_name, method_name_len)
+        Z_PARAM_FUNC(fci, fcc)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_ARRAY_OR_NULL(options)
+    ZEND_PARSE_PARAMETERS_END();
+
+    HashTable *opts = options ? Z_ARRVAL_P(options) : NULL;
+    const quicpro_iibin_compiled_schema_internal *input = mcp_route_schema(opts, "input", sizeof("input")-1);
+    const quicpro_iibin_compiled_schema_internal *output = EG(exception) ? NULL : mcp_route_schema(opts, "output", sizeof("output")-1);
+    if (EG(exception)) {
+        RETURN_THROWS();
+    }
+    zval *zv_view = opts ? zend_hash_str_find(opts, "view", sizeof("view")-1) : NULL;
+    bool view = zv_view && zend_is_true(zv_view);
+    if (view && !input) {
+        zend_value_error("Option \"view\" needs an \"input\" schema");
+        RETURN_THROWS();
+    }
+    zval *zv_batch = opts ? zend_hash_str_find(opts, "batch", sizeof("batch")-1) : NULL;
+    zval *zv_budget = opts ? zend_hash_str_find(opts, "batch_budget_us", sizeof("batch_budget_us")-1) : NULL;
+    if (zv_batch && (Z_TYPE_P(zv_batch) != IS_LONG || Z_LVAL_P(zv_batch) < 1 || Z_LVAL_P(zv_batch) > UINT16_MAX)) {
+        zend_value_error("Option \"batch\" must be an integer from 1 to %d", UINT16_MAX);
+        RETURN_THROWS();
+    }
+    if (zv_budget && (!zv_batch || Z_TYPE_P(zv_budget) != IS_LONG || Z_LVAL_P(zv_budget) < 0 || Z_LVAL_P(zv_budget) > 1000000)) {
+        zend_value_error("Option \"batch_budget_us\" needs \"batch\" and must be an integer from 0 to 1000000");
+        RETURN_THROWS();
+    }
+
+    mcp_route_t *route = ecalloc(1, sizeof(*route));
+    route->fci = fci;
+    route->fcc = fcc;
+    Z_TRY_ADDREF(route->fci.function_name);
+    route->input = input;
+    route->output = output;
+    route->view = view;
+    route->batch_max = zv_batch ? (uint32_t)Z_LVAL_P(zv_batch) : 0;
+    route->batch_budget_us = zv_budget ? (uint32_t)Z_LVAL_P(zv_budget) : MCP_BATCH_BUDGET_US;
+
+    if (!mcp_routes) {
+        ALLOC_HASHTABLE(mcp_routes);
+        zend_hash_init(mcp_routes, 16, NULL, mcp_route_dtor, 0);
+    }
+    /* The path exactly as quicpro_mcp_request() builds it */
+    zend_string *path = strpprintf(0, "/%s/%s", service_name, method_name);
+    zend_hash_update_ptr(mcp_routes, path, route);
+    zend_string_release(path);
+    RETURN_TRUE;
+}
+
+void quicpro_mcp_server_rshutdown(void) {
+    if (mcp_routes) {
+        zend_hash_destroy(mcp_routes);
+        FREE_HASHTABLE(mcp_routes);
+        mcp_routes = NULL;
+    }
+}
+
+/*──── Requests ────*/
+
+static zend_long mcp_server_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (zend_long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void mcp_batch_unlink(mcp_served_req_t *req);
+
+static void mcp_served_req_dtor(zval *zv) {
+    mcp_served_req_t *req = Z_PTR_P(zv);
+    if (req->batched) {
+        mcp_batch_unlink(req);
+    }
+    zval_ptr_dtor(&req->arg);
+    smart_str_free(&req->body);
+    smart_str_free(&req->out);
+    if (req->upload) {
+        quicpro_gpu_upload_abort(req->upload);
+    }
+    if (req->tensor_error) {
+        zend_string_release(req->tensor_error);
+    }
+    if (req->frame) {
+        quicpro_df_ipc_free(&req->ipc);
+        OBJ_RELEASE(req->frame);
+    }
+    efree(req);
+}
+
+void quicpro_mcp_served_free(quicpro_mcp_served_t *served) {
+    if (!served) {
+        return;
+    }
+    zend_hash_destroy(&served->streams);
+    efree(served);
+}
+
+bool quicpro_mcp_served_idle(const quicpro_mcp_served_t *served) {
+    return zend_hash_num_elements(&served->streams) == 0;
+}
+
+/* quiche_h3_event_for_each_header() callback: the route, the schema the call names, and an Arrow or tensor body */
+static int mcp_server_on_header(uint8_t *name, size_t name_len, uint8_t *value, size_t value_len, void *argp) {
+    mcp_served_req_t *req = argp;
+
+    if (name_len == sizeof(":path") - 1 && memcmp(name, ":path", name_len) == 0) {
+        req->route = mcp_routes ? zend_hash_str_find_ptr(mcp_routes, (const char *)value, value_len) : NULL;
+        size_t skip = value_len && value[0] == '/';
+        size_t n = MIN(value_len - skip, sizeof(req->span_name) - 1);
+        memcpy(req->span_name, value + skip, n);
+        req->span_name[n] = '\0';
+    } else if (name_len == sizeof("traceparent") - 1 && memcmp(name, "traceparent", name_len) == 0) {
+        req->has_parent = quicpro_otel_traceparent_parse((const char *)value, value_len, &req->parent);
+    } else if (name_len == sizeof("quicpro-iibin-schema") - 1 && memcmp(name, "quicpro-iibin-schema", name_len) == 0) {
+        uint32_t id = 0;
+        for (size_t i = 0; i < value_len && i < 8; i++) {
+            uint8_t c = value[i];
+            id = (id << 4) | (uint32_t)(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+        }
+        req->schema_id = id;
+    } else if (name_len == sizeof("content-type") - 1 && memcmp(name, "content-type", name_len) == 0) {
+        req->arrow = value_len == sizeof(QUICPRO_DF_ARROW_STREAM_TYPE) - 1 && memcmp(value, QUICPRO_DF_ARROW_STREAM_TYPE, value_len) == 0;
+        quicpro_gpu_tensor_header(&req->tensor_head, name, name_len, value, value_len);
+    } else if (quicpro_gpu_tensor_header(&req->tensor_head, name, name_len, value, value_len)) {
+        /* The tensor's dtype or shape */
+    } else if (name_len == sizeof("quicpro-timeout-ms") - 1 && memcmp(name, "quicpro-timeout-ms", name_len) == 0) {
+        /* The caller's budget as the request left; the hop itself is not counted */
+        zend_long left = 0;
+        for (size_t i = 0; i < value_len && value[i] >= '0' && value[i] <= '9' && left < ZEND_LONG_MAX / 10; i++) {
+            left = left * 10 + (value[i] - '0');
+        }
+        req->deadline_ms = mcp_server_now_ms() + MAX(left, 1);
+    } else if (name_len == sizeof("priority") - 1 && memcmp(name, "priority", name_len) == 0) {
+        req->overload_class = quicpro_overload_classify((const char *)value, value_len, false);
+    }
+    return 0;
+}
+
+/* Takes the pending exception's message, for a client-caused error */
+static zend_string *mcp_server_take_exception(void) {
+    zend_object *ex = EG(exception);
+    zval rv;
+    zval *message = zend_read_property_ex(zend_get_exception_base(ex), ex, ZSTR_KNOWN(ZEND_STR_MESSAGE), 1, &rv);
+    zend_string *str = zval_get_string(message);
+    zend_clear_exception();
+    return str;
+}
+
+/*──── Responses ────*/
+
+/* The access log's record of the response whose headers go out now (server/access_log.h) */
+static void mcp_server_log(quicpro_session_t *s, uint64_t stream_id, const mcp_served_req_t *req, const char *status, uint64_t length) {
+    quicpro_access_record_t *r = quicpro_access_log_begin();
+    if (!r) {
+        return;
+    }
+    char path[sizeof(req->span_name) + 1];
+    path[0] = '/';
+    size_t path_len = 1 + strlen(req->span_name);
+    memcpy(path + 1, req->span_name, path_len - 1);
+
+    r->protocol = QUICPRO_ACCESS_MCP;
+    r->status = (uint16_t)atoi(status);
+    uint64_t now = quicpro_metrics_now_us();
+    r->duration_us = now > req->arrived_us ? (uint32_t)MIN(now - req->arrived_us, UINT32_MAX) : 0;
+    r->stream_id = stream_id;
+    r->bytes_in = req->bytes_in;
+    r->bytes_out = length;
+    quicpro_access_log_method(r, "POST", 4);
+    quicpro_access_log_path(r, path, path_len);
+    quicpro_access_log_peer(r, (const struct sockaddr *)&s->peer_addr);
+    quicpro_access_log_quic(r, s->conn);
+    quicpro_access_log_commit(r);
+}
+
+/* `content_type` NULL: the protobuf/IIBIN one */
+static void mcp_server_respond(quicpro_session_t *s, uint64_t stream_id, const mcp_served_req_t *req, const char *status, uint64_t length,
+                               const char *content_type, const char *extra_name, const char *extra_value, size_t extra_len) {
+    char content_length[24];
+    size_t count = 0;
+    quiche_h3_header hdrs[4];
+
+    snprintf(content_length, sizeof(content_length), "%llu", (unsigned long long)length);
+    hdrs[count++] = (quiche_h3_header){ (const uint8_t *)":status", 7, (const uint8_t *)status, strlen(status) };
+    hdrs[count++] = (quiche_h3_header){ (const uint8_t *)"content-length", 14, (const uint8_t *)content_length, strlen(content_length) };
+    if (length) {
+        content_type = content_type ? content_type : "application/vnd.quicpro.proto";
+        hdrs[count++] = (quiche_h3_header){ (const uint8_t *)"content-type", 12, (const uint8_t *)content_type, strlen(content_type) };
+    }
+    if (extra_name) {
+        hdrs[count++] = (quiche_h3_header){ (const uint8_t *)extra_name, strlen(extra_name), (const uint8_t *)extra_value, extra_len };
+    }
+    quiche_h3_send_response(s->h3, s->conn, stream_id, hdrs, count, false);
+    mcp_server_log(s, stream_id, req, status, length);
+}
+
+/* Sends what flow control takes now; the rest waits in `out` for the next flush */
+static void mcp_server_write(quicpro_session_t *s, uint64_t stream_id, mcp_served_req_t *req, const uint8_t *data, size_t len) {
+    if (!req->out.s || ZSTR_LEN(req->out.s) == req->out_off) {
+        ssize_t sent = quiche_h3_send_body(s->h3, s->conn, stream_id, (uint8_t *)data, len, false);
+        if (sent > 0) {
+            data += sent;
+            len -= (size_t)sent;
+        }
+    }
+    if (len) {
+        smart_str_appendl(&req->out, (const char *)data, len);
+    }
+}
+
+/* An answer without a body */
+static void mcp_server_fail(quicpro_session_t *s, uint64_t stream_id, mcp_served_req_t *req, const char *status,
+                            const char *extra_name, const char *extra_value, size_t extra_len) {
+    mcp_server_respond(s, stream_id, req, status, 0, NULL, extra_name, extra_value, extra_len);
+    req->answered = true;
+}
+
+/* Streams the IIBIN encoder's chunks into the response, headers first */
+typedef struct {
+    quicpro_iibin_sink  base;
+    quicpro_session_t  *session;
+    uint64_t            stream_id;
+    mcp_served_req_t   *req;
+    bool                started;
+} mcp_server_sink;
+
+static int mcp_server_sink_write(quicpro_iibin_sink *sink, const uint8_t *data, size_t len) {
+    mcp_server_sink *out = (mcp_server_sink *)sink;
+    if (!out->started) {
+        out->started = true;
+        mcp_server_respond(out->session, out->stream_id, out->req, "200", sink->total, NULL, NULL, NULL, 0);
+    }
+    mcp_server_write(out->session, out->stream_id, out->req, data, len);
+    return SUCCESS;
+}
+
+/* A Tensor answer: its bytes, with the type and shape the client needs to place it */
+static void mcp_server_send_tensor(quicpro_session_t *s, uint64_t stream_id, mcp_served_req_t *req, quicpro_gpu_dtype_t dtype,
+                                   const int64_t *shape, uint32_t ndim, const uint8_t *data, size_t len) {
+    char content_length[24], dims[QUICPRO_GPU_TENSOR_DIMS_MAX * 21];
+    const char *dtype_name = quicpro_gpu_dtype_name(dtype);
+
+    snprintf(content_length, sizeof(content_length), "%zu", len);
+    size_t dims_len = quicpro_gpu_shape_format(shape, ndim, dims, sizeof(dims));
+    quiche_h3_header hdrs[] = {
+        { (const uint8_t *)":status", 7, (const uint8_t *)"200", 3 },
+        { (const uint8_t *)"content-length", 14, (const uint8_t *)content_length, strlen(content_length) },
+        { (const uint8_t *)"content-type", 12, (const uint8_t *)QUICPRO_GPU_TENSOR_TYPE, sizeof(QUICPRO_GPU_TENSOR_TYPE) - 1 },
+        { (const uint8_t *)"quicpro-tensor-dtype", 20, (const uint8_t *)dtype_name, strlen(dtype_name) },
+        { (const uint8_t *)"quicpro-tensor-shape", 20, (const uint8_t *)dims, dims_len },
+    };
+    quiche_h3_send_response(s->h3, s->conn, stream_id, hdrs, sizeof(hdrs) / sizeof(hdrs[0]), false);
+    mcp_server_log(s, stream_id, req, "200", len);
+    if (len) {
+        mcp_server_write(s, stream_id, req, data, len);
+    }
+    req->answered = true;
+}
+
+/* Checks a complete request and decodes its body for the handler; false once it is answered instead */
+static bool mcp_server_arg(quicpro_session_t *s, uint64_t stream_id, mcp_served_req_t *req, zval *arg) {
+    const mcp_route_t *route = req->route;
+
+    if (!route) {
+        mcp_server_fail(s, stream_id, req, "404", NULL, NULL, 0);
+        return false;
+    }
+    if (req->too_large) {
+        mcp_server_fail(s, stream_id, req, "413", NULL, NULL, 0);
+        return false;
+    }
+    if (req->tensor_error) {
+        mcp_server_fail(s, stream_id, req, "400", "quicpro-mcp-error", ZSTR_VAL(req->tensor_error), MIN(ZSTR_LEN(req->tensor_error), 256));
+        return false;
+    }
+    if (route->input && req->schema_id && req->schema_id != route->input->fingerprint) {
+        /* Another definition of the schema; its descriptor would not match ours either */
+        mcp_server_fail(s, stream_id, req, "409", "quicpro-iibin-schema-unknown", "1", 1);
+        return false;
+    }
+    if (req->deadline_ms && req->deadline_ms <= mcp_server_now_ms()) {
+        /* The caller has given up by now: skip the work */
+        mcp_server_fail(s, stream_id, req, "504", NULL, NULL, 0);
+        return false;
+    }
+    if (!quicpro_overload_admit(req->overload_class, req->arrived_us)) {
+        mcp_server_fail(s, stream_id, req, "503", "quicpro-mcp-error", "overloaded", sizeof("overloaded") - 1);
+        return false;
+    }
+
+    zend_string *body = smart_str_extract(&req->body);
+    if (req->upload) {
+        /* Already on the GPU: the Tensor takes over its memory */
+        bool received = quicpro_gpu_upload_finish(req->upload, arg);
+        req->upload = NULL;
+        zend_string_release(body);
+        if (!received) {
+            mcp_server_fail(s, stream_id, req, "400", "quicpro-mcp-error", quicpro_gpu_error(), MIN(strlen(quicpro_gpu_error()), 256));
+            return false;
+        }
+    } else if (!route->input && req->arrow && quicpro_high_perf_compute_ai_config.dataframe_enable) {
+        /* The frame's columns point into the body, which they keep */
+        bool decoded = quicpro_df_ipc_decode(body, arg);
+        zend_string_release(body);
+        if (!decoded) {
+            zend_string *why = mcp_server_take_exception();
+            mcp_server_fail(s, stream_id, req, "400", "quicpro-mcp-error", ZSTR_VAL(why), MIN(ZSTR_LEN(why), 256));
+            zend_string_release(why);
+            return false;
+        }
+    } else if (!route->input) {
+        ZVAL_STR(arg, body);
+    } else if (route->view) {
+        quicpro_iibin_view_init(arg, route->input, body);
+        zend_string_release(body);
+    } else {
+        int decoded = quicpro_iibin_decode_message((const unsigned char *)ZSTR_VAL(body), ZSTR_LEN(body), route->input, arg, 0);
+        zend_string_release(body);
+        if (decoded == FAILURE) {
+            zend_string *why = mcp_server_take_exception();
+            mcp_server_fail(s, stream_id, req, "400", "quicpro-mcp-error", ZSTR_VAL(why), MIN(ZSTR_LEN(why), 256));
+            zend_string_release(why);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Queues the answer a handler's return value makes for `req`; false when it makes none */
+static bool mcp_server_reply(quicpro_session_t *s, uint64_t stream_id, mcp_served_req_t *req, zval *retval) {
+    const mcp_route_t *route = req->route;
+
+    ZVAL_DEREF(retval);
+    if (route->output) {
+        mcp_server_sink sink = { .base.write = mcp_server_sink_write, .session = s, .stream_id = stream_id, .req = req };
+        if ((Z_TYPE_P(retval) == IS_ARRAY || Z_TYPE_P(retval) == IS_OBJECT)
+            && quicpro_iibin_encode_to_sink(route->output, retval, &sink.base) == SUCCESS) {
+            if (!sink.started) {
+                mcp_server_respond(s, stream_id, req, "200", 0, NULL, NULL, NULL, 0);   /* An empty message */
+            }
+            req->answered = true;
+        } else if (!EG(exception)) {
+            php_error_docref(NULL, E_WARNING, "MCP handler must return an array or object for IIBIN schema '%s'", route->output->schema_name);
+        }
+    } else if (Z_TYPE_P(retval) == IS_OBJECT && instanceof_function(Z_OBJCE_P(retval), quicpro_ce_dataframe)) {
+        /* Sent by mcp_server_flush_req() from the frame's columns, which the request keeps alive */
+        req->frame = Z_OBJ_P(retval);
+        GC_ADDREF(req->frame);
+        quicpro_df_ipc_plan(quicpro_dataframe_from_obj(req->frame), &req->ipc);
+        mcp_server_respond(s, stream_id, req, "200", req->ipc.total, QUICPRO_DF_ARROW_STREAM_TYPE, NULL, NULL, 0);
+        req->answered = true;
+    } else if (Z_TYPE_P(retval) == IS_OBJECT && Z_OBJCE_P(retval) == quicpro_ce_gpu_tensor) {
+        /* Read back once the handler's work on its stream is done */
+        quicpro_gpu_tensor_object *t = quicpro_gpu_tensor_from_obj(Z_OBJ_P(retval));
+        zend_string *data = zend_string_alloc(t->bytes, 0);
+        if (quicpro_gpu_download(ZSTR_VAL(data), t->data, t->bytes, t->stream)) {
+            mcp_server_send_tensor(s, stream_id, req, t->dtype, t->shape, t->ndim, (const uint8_t *)ZSTR_VAL(data), t->bytes);
+        } else {
+            php_error_docref(NULL, E_WARNING, "MCP handler's Tensor could not be read back: %s", quicpro_gpu_error());
+        }
+        zend_string_efree(data);
+    } else if (Z_TYPE_P(retval) == IS_STRING || Z_TYPE_P(retval) == IS_NULL) {
+        size_t len = Z_TYPE_P(retval) == IS_STRING ? Z_STRLEN_P(retval) : 0;
+        mcp_server_respond(s, stream_id, req, "200", len, NULL, NULL, NULL, 0);
+        if (len) {
+            mcp_server_write(s, stream_id, req, (const uint8_t *)Z_STRVAL_P(retval), len);
+        }
+        req->answered = true;
+    } else {
+        php_error_docref(NULL, E_WARNING, "MCP handler without an output schema must return a string, a Quicpro\\DataFrame or a Quicpro\\Gpu\\Tensor");
+    }
+    return req->answered;
+}
+
+/* The server span of a handler call; the handler's own MCP calls are its children. Whether it is sampled. */
+static bool mcp_server_span_open(quicpro_otel_scope_t *scope, quicpro_session_t *s, const mcp_served_req_t *req,
+                                 const quicpro_otel_context_t *parent) {
+    if (quicpro_otel_scope_open(scope, req->span_name, QUICPRO_OTEL_KIND_SERVER, parent)) {
+        const char *method = strchr(req->span_name, '/');
+        size_t service_len = method ? (size_t)(method - req->span_name) : strlen(req->span_name);
+        quicpro_otel_span_attr_str(&scope->span, "rpc.system", "quicpro_mcp", sizeof("quicpro_mcp") - 1);
+        quicpro_otel_span_attr_str(&scope->span, "rpc.service", req->span_name, service_len);
+        if (method) {
+            quicpro_otel_span_attr_str(&scope->span, "rpc.method", method + 1, strlen(method + 1));
+        }
+        quicpro_otel_span_quic(&scope->span, s->conn);
+        return true;
+    }
+    return false;
+}
+
+/* Calls the route's handler with `arg`, which it consumes; false when it threw */
+static bool mcp_server_call(const mcp_route_t *route, zval *arg, zval *retval, zend_long deadline_ms) {
+    ZVAL_UNDEF(retval);
+    zend_fcall_info fci = route->fci;
+    fci.params = arg;
+    fci.param_count = 1;
+    fci.retval = retval;
+    zend_long outer_deadline = deadline_ms ? quicpro_mcp_deadline_enter(MAX(deadline_ms - mcp_server_now_ms(), 1)) : 0;
+    uint64_t started_us = quicpro_metrics_now_us();
+    uint64_t prof = quicpro_prof_begin();
+    bool called = zend_call_function(&fci, (zend_fcall_info_cache *)&route->fcc) == SUCCESS && !EG(exception);
+    quicpro_prof_end(QUICPRO_PROF_PHP_CALLBACK, prof);
+    quicpro_metrics_observe_since(QUICPRO_METRIC_REQUEST_DURATION, started_us);
+    if (deadline_ms) {
+        quicpro_mcp_deadline_leave(outer_deadline);
+    }
+    zval_ptr_dtor(arg);
+    return called;
+}
+
+/* Runs the route's handler on a complete request and queues its answer */
+static void mcp_server_answer(quicpro_session_t *s, uint64_t stream_id, mcp_served_req_t *req) {
+    zval arg, retval;
+
+    if (!mcp_server_arg(s, stream_id, req, &arg)) {
+        return;
+    }
+    quicpro_otel_scope_t scope;
+    mcp_server_span_open(&scope, s, req, req->has_parent ? &req->parent : NULL);
+    quicpro_cancel_token_t cancel;
+    quicpro_cancel_enter(&cancel, s, stream_id);
+    bool called = mcp_server_call(req->route, &arg, &retval, req->deadline_ms);
+    bool cancelled = quicpro_cancel_requested();
+    quicpro_cancel_leave(&cancel);
+    if (cancelled) {
+        /* The caller stopped the stream: nothing to answer, nothing to warn about */
+        if (EG(exception)) {
+            zend_clear_exception();
+        }
+        quiche_conn_stream_shutdown(s->conn, stream_id, QUICHE_SHUTDOWN_WRITE, MCP_SERVER_REQUEST_CANCELLED);
+        req->answered = true;
+        scope.span.error = true;
+    } else if (called) {
+        mcp_server_reply(s, stream_id, req, &retval);
+    }
+    zval_ptr_dtor(&retval);
+
+    if (!req->answered) {
+        if (EG(exception)) {
+            zend_exception_error(EG(exception), E_WARNING);
+        }
+        mcp_server_fail(s, stream_id, req, "500", NULL, NULL, 0);
+        scope.span.error = true;
+    }
+    quicpro_otel_scope_close(&scope);
+}
+
+/* Sends what flow control takes of a response; true once it is all out or the stream is gone. */
+static bool mcp_server_flush_req(quicpro_session_t *s, uint64_t stream_id, mcp_served_req_t *req) {
+    while (req->frame) {
+        const quicpro_df_ipc_chunk_t *c = &req->ipc.chunks[req->chunk];
+        bool last = req->chunk + 1 == req->ipc.count;
+        size_t left = c->len - req->chunk_off;
+        ssize_t sent = quiche_h3_send_body(s->h3, s->conn, stream_id,
+                                           (uint8_t *)quicpro_df_ipc_chunk_data(&req->ipc, req->chunk) + req->chunk_off, left, last);
+        if (sent == QUICHE_H3_ERR_DONE) {
+            return false;
+        }
+        if (sent < 0) {
+            return true;
+        }
+        req->chunk_off += (size_t)sent;
+        if ((size_t)sent < left) {
+            return false;
+        }
+        if (last) {
+            return true;
+        }
+        req->chunk++;
+        req->chunk_off = 0;
+    }
+    size_t left = req->out.s ? ZSTR_LEN(req->out.s) - req->out_off : 0;
+    ssize_t sent = quiche_h3_send_body(s->h3, s->conn, stream_id, left ? (uint8_t *)ZSTR_VAL(req->out.s) + req->out_off : NULL, left, true);
+    if (sent == QUICHE_H3_ERR_DONE) {
+        return false;
+    }
+    if (sent < 0) {
+        return true;    /* Reset or closed: nobody is reading any more */
+    }
+    req->out_off += (size_t)sent;
+    return (size_t)sent == left;
+}
+
+void quicpro_mcp_server_flush(quicpro_session_t *s) {
+    zend_ulong stream_id;
+    mcp_served_req_t *req;
+
+    if (!s->mcp_served || !s->h3) {
+        return;
+    }
+    ZEND_HASH_FOREACH_NUM_KEY_PTR(&s->mcp_served->streams, stream_id, req) {
+        if (req->answered && mcp_server_flush_req(s, (uint64_t)stream_id, req)) {
+            zend_hash_index_del(&s->mcp_served->streams, stream_id);
+        }
+    } ZEND_HASH_FOREACH_END();
+}
+
+/*──── Batches ────*/
+
+/* A route with 'batch' takes its requests in one handler call: a list of
+ * their arguments, or, when all are tensors of one dtype and shape, one
+ * Tensor stacking them (quicpro_gpu_tensor_stack()), so that an inference
+ * handler launches its kernel once for the lot. It returns a list of one
+ * answer per request, or a Tensor whose first dimension is the batch,
+ * which is split back into one tensor answer each. A batch runs once it
+ * holds `batch_max` requests, or once its first has waited the budget. */
+
+static void mcp_batch_unlink(mcp_served_req_t *req) {
+    mcp_route_t *route = req->route;
+    if (req->batch_prev) {
+        req->batch_prev->batch_next = req->batch_next;
+    } else {
+        route->batch_head = req->batch_next;
+    }
+    if (req->batch_next) {
+        req->batch_next->batch_prev = req->batch_prev;
+    } else {
+        route->batch_tail = req->batch_prev;
+    }
+    req->batch_prev = req->batch_next = NULL;
+    req->batched = false;
+    route->batched--;
+}
+
+/* Decodes a complete request into its route's batch; false when it is answered at once instead */
+static bool mcp_batch_enqueue(quicpro_session_t *s, uint64_t stream_id, mcp_served_req_t *req) {
+    mcp_route_t *route = req->route;
+
+    if (!mcp_server_arg(s, stream_id, req, &req->arg)) {
+        return false;
+    }
+    req->session = s;
+    req->stream_id = stream_id;
+    req->queued_us = quicpro_metrics_now_us();
+    req->batch_prev = route->batch_tail;
+    if (route->batch_tail) {
+        route->batch_tail->batch_next = req;
+    } else {
+        route->batch_head = req;
+    }
+    route->batch_tail = req;
+    route->batched++;
+    req->batched = true;
+    return true;
+}
+
+static bool mcp_batch_due(const mcp_route_t *route, uint64_t now_us) {
+    return route->batch_head
+        && (route->batched >= route->batch_max || now_us - route->batch_head->queued_us >= route->batch_budget_us);
+}
+
+/* What the handler gets for the batch; the requests' arguments are taken, or released once stacked */
+static bool mcp_batch_gather(mcp_served_req_t **reqs, uint32_t n, zval *batch) {
+    bool tensors = true;
+    for (uint32_t i = 0; i < n && tensors; i++) {
+        zval *arg = &reqs[i]->arg;
+        tensors = Z_TYPE_P(arg) == IS_OBJECT && Z_OBJCE_P(arg) == quicpro_ce_gpu_tensor;
+        if (tensors && i) {
+            const quicpro_gpu_tensor_object *a = quicpro_gpu_tensor_from_obj(Z_OBJ(reqs[0]->arg));
+            const quicpro_gpu_tensor_object *b = quicpro_gpu_tensor_from_obj(Z_OBJ_P(arg));
+            tensors = a->dtype == b->dtype && a->ndim == b->ndim && memcmp(a->shape, b->shape, a->ndim * sizeof(int64_t)) == 0;
+        }
+    }
+    if (tensors) {
+        quicpro_gpu_tensor_object **items = safe_emalloc(n, sizeof(*items), 0);
+        for (uint32_t i = 0; i < n; i++) {
+            items[i] = quicpro_gpu_tensor_from_obj(Z_OBJ(reqs[i]->arg));
+        }
+        bool stacked = quicpro_gpu_tensor_stack(batch, items, n);
+        efree(items);
+        for (uint32_t i = 0; i < n; i++) {
+            zval_ptr_dtor(&reqs[i]->arg);
+            ZVAL_UNDEF(&reqs[i]->arg);
+        }
+        return stacked;
+    }
+    array_init_size(batch, n);
+    for (uint32_t i = 0; i < n; i++) {
+        zend_hash_next_index_insert_new(Z_ARRVAL_P(batch), &reqs[i]->arg);
+        ZVAL_UNDEF(&reqs[i]->arg);
+    }
+    return true;
+}
+
+/* Answers each request of the batch with its share of what the handler returned */
+static void mcp_batch_scatter(mcp_served_req_t **reqs, uint32_t n, zval *retval) {
+    ZVAL_DEREF(retval);
+    if (Z_TYPE_P(retval) == IS_OBJECT && Z_OBJCE_P(retval) == quicpro_ce_gpu_tensor && !reqs[0]->route->output) {
+        quicpro_gpu_tensor_object *t = quicpro_gpu_tensor_from_obj(Z_OBJ_P(retval));
+        if (t->ndim == 0 || t->shape[0] != (int64_t)n) {
+            php_error_docref(NULL, E_WARNING, "Batched MCP handler returned a Tensor whose first dimension is not the batch size (%u)", n);
+            return;
+        }
+        /* One copy back for the batch, then a row each */
+        zend_string *data = zend_string_alloc(t->bytes, 0);
+        if (quicpro_gpu_download(ZSTR_VAL(data), t->data, t->bytes, t->stream)) {
+            size_t row = t->bytes / n;
+            for (uint32_t i = 0; i < n; i++) {
+                mcp_server_send_tensor(reqs[i]->session, reqs[i]->stream_id, reqs[i], t->dtype, t->shape + 1, t->ndim - 1,
+                                       (const uint8_t *)ZSTR_VAL(data) + (size_t)i * row, row);
+            }
+        } else {
+            php_error_docref(NULL, E_WARNING, "Batched MCP handler's Tensor could not be read back: %s", quicpro_gpu_error());
+        }
+        zend_string_efree(data);
+    } else if (Z_TYPE_P(retval) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL_P(retval)) == n) {
+        uint32_t i = 0;
+        zval *answer;
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(retval), answer) {
+            if (!mcp_server_reply(reqs[i]->session, reqs[i]->stream_id, reqs[i], answer) && EG(exception)) {
+                break;
+            }
+            i++;
+        } ZEND_HASH_FOREACH_END();
+    } else {
+        php_error_docref(NULL, E_WARNING, "Batched MCP handler must return an array of %u answers, one per request, or a Tensor batch", n);
+    }
+}
+
+/* Sends what flow control takes of an answer, and forgets the request once it is all out */
+static void mcp_batch_done(mcp_served_req_t *req) {
+    quicpro_session_t *s = req->session;
+    if (mcp_server_flush_req(s, req->stream_id, req)) {
+        zend_hash_index_del(&s->mcp_served->streams, (zend_ulong)req->stream_id);
+    }
+}
+
+/* One handler call for the first (up to) batch_max requests waiting on the route */
+static void mcp_batch_run(mcp_route_t *route) {
+    uint32_t n = 0;
+    zend_long now_ms = mcp_server_now_ms(), deadline_ms = 0;
+    mcp_served_req_t **reqs = safe_emalloc(MIN(route->batched, route->batch_max), sizeof(*reqs), 0);
+
+    while (route->batch_head && n < route->batch_max) {
+        mcp_served_req_t *req = route->batch_head;
+        mcp_batch_unlink(req);
+        if (req->deadline_ms && req->deadline_ms <= now_ms) {
+            /* Its caller gave up while it waited */
+            quicpro_session_t *s = req->session;
+            quicpro_io_session_acquire(s);
+            mcp_server_fail(s, req->stream_id, req, "504", NULL, NULL, 0);
+            mcp_batch_done(req);
+            quicpro_io_session_release(s);
+            continue;
+        }
+        /* The handler's own calls end with the first caller's budget */
+        if (req->deadline_ms && (!deadline_ms || req->deadline_ms < deadline_ms)) {
+            deadline_ms = req->deadline_ms;
+        }
+        quicpro_io_session_acquire(req->session);
+        reqs[n++] = req;
+    }
+    if (!n) {
+        efree(reqs);
+        return;
+    }
+
+    zval batch, retval;
+    quicpro_otel_scope_t scope;
+    if (mcp_server_span_open(&scope, reqs[0]->session, reqs[0], NULL)) {
+        quicpro_otel_span_attr_int(&scope.span, "quicpro.mcp.batch_size", (int64_t)n);
+    }
+    if (mcp_batch_gather(reqs, n, &batch)) {
+        ZVAL_UNDEF(&retval);
+        if (mcp_server_call(route, &batch, &retval, deadline_ms)) {
+            mcp_batch_scatter(reqs, n, &retval);
+        }
+        zval_ptr_dtor(&retval);
+        if (EG(exception)) {
+            zend_exception_error(EG(exception), E_WARNING);
+        }
+    } else {
+        /* The stacked batch did not fit the GPU memory pool: the device is busy, not the request wrong */
+        for (uint32_t i = 0; i < n; i++) {
+            mcp_server_fail(reqs[i]->session, reqs[i]->stream_id, reqs[i], "503", "quicpro-mcp-error",
+                            quicpro_gpu_error(), MIN(strlen(quicpro_gpu_error()), 256));
+        }
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        if (!reqs[i]->answered) {
+            mcp_server_fail(reqs[i]->session, reqs[i]->stream_id, reqs[i], "500", NULL, NULL, 0);
+            scope.span.error = true;
+        }
+        quicpro_session_t *s = reqs[i]->session;
+        mcp_batch_done(reqs[i]);
+        quicpro_io_session_release(s);
+    }
+    quicpro_otel_scope_close(&scope);
+    efree(reqs);
+}
+
+void quicpro_mcp_server_batch_tick(void) {
+    mcp_route_t *route;
+
+    if (!mcp_routes) {
+        return;
+    }
+    uint64_t now_us = quicpro_metrics_now_us();
+    ZEND_HASH_FOREACH_PTR(mcp_routes, route) {
+        while (mcp_batch_due(route, now_us)) {
+            mcp_batch_run(route);
+        }
+    } ZEND_HASH_FOREACH_END();
+}
+
+int quicpro_mcp_server_batch_wait_ms(int wait_ms) {
+    mcp_route_t *route;
+
+    if (!mcp_routes) {
+        return wait_ms;
+    }
+    uint64_t now_us = quicpro_metrics_now_us();
+    ZEND_HASH_FOREACH_PTR(mcp_routes, route) {
+        if (mcp_batch_due(route, now_us)) {
+            return 0;
+        }
+        if (route->batch_head) {
+            uint64_t left_us = route->batch_head->queued_us + route->batch_budget_us - now_us;
+            wait_ms = MIN(wait_ms, (int)((left_us + 999) / 1000));
+        }
+    } ZEND_HASH_FOREACH_END();
+    return wait_ms;
+}
+
+/*──── Serving ────*/
+
+/* A tensor body goes from quiche straight into pinned buffers, and from there to the GPU; false on failure */
+static bool mcp_server_recv_tensor(quicpro_session_t *s, uint64_t stream_id, mcp_served_req_t *req) {
+    uint8_t *to;
+    size_t room;
+    ssize_t n;
+    bool ok;
+
+    while ((ok = quicpro_gpu_upload_room(req->upload, &to, &room)) && room) {
+        if ((n = quiche_h3_recv_body(s->h3, s->conn, stream_id, to, room)) <= 0) {
+            break;
+        }
+        req->bytes_in += (uint64_t)n;
+        if (!(ok = quicpro_gpu_upload_commit(req->upload, (size_t)n))) {
+            break;
+        }
+    }
+    /* The pinned buffer goes to the device before other streams' bodies need it */
+    ok = quicpro_gpu_upload_flush(req->upload) && ok;
+    if (ok && !room) {
+        /* Complete: whatever else comes is more than the shape holds */
+        uint8_t past[1];
+        if (quiche_h3_recv_body(s->h3, s->conn, stream_id, past, sizeof(past)) > 0) {
+            ok = quicpro_gpu_fail("the body is longer than its quicpro-tensor-shape");
+        }
+    }
+    return ok;
+}
+
+PHP_FUNCTION(quicpro_mcp_server_serve)
+{
+    zval *z_session_res;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_RESOURCE(z_session_res)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = (quicpro_session_t *)zend_fetch_resource_ex(z_session_res, "Quicpro MCP Session", le_quicpro_session);
+    if (!s || !s->conn) {
+        throw_mcp_error_as_php_exception(0, "Invalid or closed MCP connection resource provided.");
+        RETURN_THROWS();
+    }
+    if (!s->h3) {
+        s->h3_cfg = quiche_h3_config_new();
+        if (s->h3_cfg) {
+            quicpro_h3_settings_apply(s->h3_cfg);
+            s->h3 = quiche_h3_conn_new_with_transport(s->conn, s->h3_cfg);
+        }
+        if (!s->h3) {
+            throw_mcp_error_as_php_exception(0, "Failed to initialize HTTP/3 on the MCP connection.");
+            RETURN_THROWS();
+        }
+    }
+    if (!s->mcp_served) {
+        s->mcp_served = ecalloc(1, sizeof(quicpro_mcp_served_t));
+        zend_hash_init(&s->mcp_served->streams, 8, NULL, mcp_served_req_dtor, 0);
+    }
+
+    zend_long answered = 0;
+    quiche_h3_event *ev;
+    int64_t stream_id;
+    while ((stream_id = quicpro_prof_h3_conn_poll(s->h3, s->conn, &ev)) >= 0) {
+        mcp_served_req_t *req = zend_hash_index_find_ptr(&s->mcp_served->streams, (zend_ulong)stream_id);
+
+        switch (quiche_h3_event_type(ev)) {
+            case QUICHE_H3_EVENT_HEADERS:
+                if (!req) {
+                    req = ecalloc(1, sizeof(*req));
+                    req->overload_class = QUICPRO_OVERLOAD_NORMAL;
+                    req->arrived_us = quicpro_overload_rx_arrival_us(&s->last_rx_ts);
+                    zend_hash_index_add_new_ptr(&s->mcp_served->streams, (zend_ulong)stream_id, req);
+                    QUICPRO_WORKER_STAT(streams);
+                    quicpro_metrics_add(QUICPRO_METRIC_STREAMS, 1);
+                    QUICPRO_WORKER_STAT(requests);
+                    quiche_h3_event_for_each_header(ev, mcp_server_on_header, req);
+                    /* A tensor for a schema-less handler goes to the GPU as it arrives */
+                    if (req->tensor_head.tensor && req->route && !req->route->input
+                        && !(req->upload = quicpro_gpu_upload_from_head(&req->tensor_head))) {
+                        req->tensor_error = zend_string_init(quicpro_gpu_error(), strlen(quicpro_gpu_error()), 0);
+                    }
+                }
+                break;
+
+            case QUICHE_H3_EVENT_DATA: {
+                uint8_t buf[16384];
+                ssize_t n;
+                if (req && req->upload && !mcp_server_recv_tensor(s, (uint64_t)stream_id, req)) {
+                    req->tensor_error = zend_string_init(quicpro_gpu_error(), strlen(quicpro_gpu_error()), 0);
+                    quicpro_gpu_upload_abort(req->upload);
+                    req->upload = NULL;
+                }
+                while ((n = quiche_h3_recv_body(s->h3, s->conn, (uint64_t)stream_id, buf, sizeof(buf))) > 0) {
+                    if (req) {
+                        req->bytes_in += (uint64_t)n;
+                    }
+                    if (!req || !req->route || req->too_large || req->tensor_error) {
+                        continue;   /* Answered without its body */
+                    }
+                    if ((req->body.s ? ZSTR_LEN(req->body.s) : 0) + (size_t)n > MCP_SERVER_MAX_BODY) {
+                        req->too_large = true;
+                        smart_str_free(&req->body);
+                        continue;
+                    }
+                    smart_str_appendl(&req->body, (const char *)buf, (size_t)n);
+                }
+                break;
+            }
+
+            case QUICHE_H3_EVENT_FINISHED:
+                if (req && !req->answered && !req->batched) {
+                    answered++;
+                    if (req->route && req->route->batch_max) {
+                        if (mcp_batch_enqueue(s, (uint64_t)stream_id, req)) {
+                            break;      /* Answered by quicpro_mcp_server_batch_tick() */
+                        }
+                    } else {
+                        mcp_server_answer(s, (uint64_t)stream_id, req);
+                    }
+                    if (mcp_server_flush_req(s, (uint64_t)stream_id, req)) {
+                        zend_hash_index_del(&s->mcp_served->streams, (zend_ulong)stream_id);
+                    }
+                }
+                break;
+
+            case QUICHE_H3_EVENT_RESET:
+                if (req) {
+                    zend_hash_index_del(&s->mcp_served->streams, (zend_ulong)stream_id);
+                }
+                break;
+
+            default:
+                break;
+        }
+        quiche_h3_event_free(ev);
+    }
+
+    RETURN_LONG(answered);
+}
@@ -0,0 +1,368 @@
+/*
+ * src/object_store/at_rest.c – Encryption at rest
+ * ===============================================
+ *
+ * See include/object_store/at_rest.h. The master key is read once per
+ * process (again when the path changes) and kept behind a mutex, since
+ * the CDN disk tier reads records from I/O threads too. Each derived key
+ * owns its cipher context; the key schedule is redone per call, which is
+ * nothing next to a segment's worth of data.
+ */
+
+#include <php.h>
+
+#include "object_store/at_rest.h"
+#include "config/tls_and_crypto/base_layer.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <openssl/crypto.h>
+#include <openssl/hmac.h>
+
+#define QP_REST_UPDATE_MAX (1 << 30)    /* Per EVP_*Update() call, whose lengths are ints */
+
+struct quicpro_at_rest_reader_s {
+    quicpro_at_rest_key_t key;
+    uint64_t              base;         /* Where the segments start in the file */
+    uint64_t              len;          /* Plaintext bytes */
+    uint64_t              cached;       /* The segment in `plain`; UINT64_MAX for none */
+    uint8_t               sealed[QUICPRO_AT_REST_SEGMENT + QUICPRO_AT_REST_TAG_LEN];
+    uint8_t               plain[QUICPRO_AT_REST_SEGMENT];
+};
+
+static pthread_mutex_t qp_rest_lock = PTHREAD_MUTEX_INITIALIZER;
+static char           *qp_rest_path = NULL;         /* The key file the state below is of */
+static bool            qp_rest_loaded = false;
+static uint8_t         qp_rest_master[QUICPRO_AT_REST_KEY_LEN];
+static char            qp_rest_id[QUICPRO_AT_REST_KEY_ID_LEN + 1];
+
+/*──────────────────────────── Master key ─────────────────────────────────*/
+
+static int qp_rest_hex_digit(int c)
+{
+    return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+/* 32 raw bytes, or 64 hex digits and perhaps a line break */
+static bool qp_rest_parse_key(const uint8_t *buf, size_t n, uint8_t *key)
+{
+    if (n == QUICPRO_AT_REST_KEY_LEN) {
+        memcpy(key, buf, n);
+        return true;
+    }
+    while (n > 0 && isspace(buf[n - 1])) n--;
+    if (n != 2 * QUICPRO_AT_REST_KEY_LEN) {
+        return false;
+    }
+    for (size_t i = 0; i < QUICPRO_AT_REST_KEY_LEN; i++) {
+        int hi = qp_rest_hex_digit(buf[2 * i]), lo = qp_rest_hex_digit(buf[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        key[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+static bool qp_rest_load(const char *path)
+{
+    uint8_t buf[2 * QUICPRO_AT_REST_KEY_LEN + 3];
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        php_error_docref(NULL, E_WARNING, "Storage encryption key %s cannot be read: %s", path, strerror(errno));
+        return false;
+    }
+    size_t n = 0;
+    while (n < sizeof(buf)) {
+        ssize_t got = read(fd, buf + n, sizeof(buf) - n);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        n += (size_t)got;
+    }
+    close(fd);
+    bool ok = qp_rest_parse_key(buf, n, qp_rest_master);
+    OPENSSL_cleanse(buf, sizeof(buf));
+    if (!ok) {
+        php_error_docref(NULL, E_WARNING, "Storage encryption key %s must hold 32 bytes or 64 hex digits", path);
+        return false;
+    }
+
+    static const char label[] = "quicpro key id";
+    static const char digits[] = "0123456789abcdef";
+    uint8_t mac[EVP_MAX_MD_SIZE];
+    unsigned mac_len = 0;
+    if (!HMAC(EVP_sha256(), qp_rest_master, sizeof(qp_rest_master), (const uint8_t *)label, sizeof(label) - 1, mac, &mac_len)) {
+        return false;
+    }
+    for (unsigned i = 0; i < QUICPRO_AT_REST_KEY_ID_LEN / 2; i++) {
+        qp_rest_id[2 * i] = digits[mac[i] >> 4];
+        qp_rest_id[2 * i + 1] = digits[mac[i] & 0xf];
+    }
+    qp_rest_id[QUICPRO_AT_REST_KEY_ID_LEN] = '\0';
+    return true;
+}
+
+bool quicpro_at_rest_wanted(void)
+{
+    return quicpro_tls_crypto_config.storage_encryption_at_rest_enable;
+}
+
+bool quicpro_at_rest_ready(void)
+{
+    const char *path = quicpro_tls_crypto_config.storage_encryption_key_path;
+    if (!path || !*path) {
+        return false;
+    }
+    pthread_mutex_lock(&qp_rest_lock);
+    if (!qp_rest_path || strcmp(qp_rest_path, path) != 0) {
+        if (qp_rest_path) pefree(qp_rest_path, 1);
+        qp_rest_path = pestrdup(path, 1);
+        OPENSSL_cleanse(qp_rest_master, sizeof(qp_rest_master));
+        qp_rest_loaded = qp_rest_load(path);
+    }
+    bool ok = qp_rest_loaded;
+    pthread_mutex_unlock(&qp_rest_lock);
+    return ok;
+}
+
+quicpro_at_rest_alg_t quicpro_at_rest_alg(void)
+{
+    return quicpro_at_rest_alg_parse(quicpro_tls_crypto_config.storage_encryption_algorithm);
+}
+
+const char *quicpro_at_rest_alg_name(quicpro_at_rest_alg_t alg)
+{
+    switch (alg) {
+        case QUICPRO_AT_REST_AES_256_GCM:       return "aes-256-gcm";
+        case QUICPRO_AT_REST_CHACHA20_POLY1305: return "chacha20-poly1305";
+        default:                                return NULL;
+    }
+}
+
+quicpro_at_rest_alg_t quicpro_at_rest_alg_parse(const char *name)
+{
+    if (name && strcasecmp(name, "aes-256-gcm") == 0) {
+        return QUICPRO_AT_REST_AES_256_GCM;
+    }
+    if (name && strcasecmp(name, "chacha20-poly1305") == 0) {
+        return QUICPRO_AT_REST_CHACHA20_POLY1305;
+    }
+    return QUICPRO_AT_REST_NONE;
+}
+
+bool quicpro_at_rest_key_id(char *out)
+{
+    if (!quicpro_at_rest_ready()) {
+        return false;
+    }
+    pthread_mutex_lock(&qp_rest_lock);
+    memcpy(out, qp_rest_id, sizeof(qp_rest_id));
+    pthread_mutex_unlock(&qp_rest_lock);
+    return true;
+}
+
+/*──────────────────────────── Derived keys ───────────────────────────────*/
+
+bool quicpro_at_rest_derive(quicpro_at_rest_key_t *key, quicpro_at_rest_alg_t alg, const char *label,
+                            const void *context, size_t context_len)
+{
+    key->alg = alg;
+    key->ctx = NULL;
+    if (alg == QUICPRO_AT_REST_NONE || !quicpro_at_rest_ready()) {
+        return false;
+    }
+
+    size_t label_len = strlen(label), msg_len = label_len + 1 + context_len;
+    uint8_t stack[256];
+    uint8_t *msg = msg_len <= sizeof(stack) ? stack : pemalloc(msg_len, 1);
+    memcpy(msg, label, label_len);
+    msg[label_len] = 0;
+    if (context_len) {
+        memcpy(msg + label_len + 1, context, context_len);
+    }
+
+    uint8_t mac[EVP_MAX_MD_SIZE];
+    unsigned mac_len = 0;
+    pthread_mutex_lock(&qp_rest_lock);
+    bool ok = qp_rest_loaded
+        && HMAC(EVP_sha256(), qp_rest_master, sizeof(qp_rest_master), msg, msg_len, mac, &mac_len) != NULL;
+    pthread_mutex_unlock(&qp_rest_lock);
+    if (msg != stack) {
+        pefree(msg, 1);
+    }
+    if (!ok) {
+        return false;
+    }
+    memcpy(key->key, mac, QUICPRO_AT_REST_KEY_LEN);
+    OPENSSL_cleanse(mac, sizeof(mac));
+    key->ctx = EVP_CIPHER_CTX_new();
+    if (!key->ctx) {
+        quicpro_at_rest_key_clear(key);
+        return false;
+    }
+    return true;
+}
+
+void quicpro_at_rest_key_clear(quicpro_at_rest_key_t *key)
+{
+    if (key->ctx) {
+        EVP_CIPHER_CTX_free(key->ctx);
+        key->ctx = NULL;
+    }
+    OPENSSL_cleanse(key->key, sizeof(key->key));
+}
+
+void quicpro_at_rest_nonce(uint8_t *nonce, uint64_t seq)
+{
+    memset(nonce, 0, QUICPRO_AT_REST_NONCE_LEN - 8);
+    for (int i = 0; i < 8; i++) {
+        nonce[QUICPRO_AT_REST_NONCE_LEN - 1 - i] = (uint8_t)(seq >> (8 * i));
+    }
+}
+
+static const EVP_CIPHER *qp_rest_cipher(quicpro_at_rest_alg_t alg)
+{
+    return alg == QUICPRO_AT_REST_CHACHA20_POLY1305 ? EVP_chacha20_poly1305() : EVP_aes_256_gcm();
+}
+
+bool quicpro_at_rest_seal(quicpro_at_rest_key_t *key, const uint8_t *nonce, const void *aad, size_t aad_len,
+                          const uint8_t *in, size_t len, uint8_t *out)
+{
+    EVP_CIPHER_CTX *ctx = key->ctx;
+    int n;
+    if (!ctx || EVP_EncryptInit_ex(ctx, qp_rest_cipher(key->alg), NULL, key->key, nonce) != 1
+        || (aad_len && EVP_EncryptUpdate(ctx, NULL, &n, aad, (int)aad_len) != 1)) {
+        return false;
+    }
+    for (size_t off = 0; off < len; ) {
+        int step = (int)MIN(len - off, (size_t)QP_REST_UPDATE_MAX);
+        if (EVP_EncryptUpdate(ctx, out + off, &n, in + off, step) != 1) {
+            return false;
+        }
+        off += (size_t)step;
+    }
+    return EVP_EncryptFinal_ex(ctx, out + len, &n) == 1
+        && EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, QUICPRO_AT_REST_TAG_LEN, out + len) == 1;
+}
+
+bool quicpro_at_rest_open(quicpro_at_rest_key_t *key, const uint8_t *nonce, const void *aad, size_t aad_len,
+                          const uint8_t *in, size_t len, uint8_t *out)
+{
+    EVP_CIPHER_CTX *ctx = key->ctx;
+    uint8_t tag[QUICPRO_AT_REST_TAG_LEN];
+    int n;
+    memcpy(tag, in + len, sizeof(tag));
+    if (!ctx || EVP_DecryptInit_ex(ctx, qp_rest_cipher(key->alg), NULL, key->key, nonce) != 1
+        || (aad_len && EVP_DecryptUpdate(ctx, NULL, &n, aad, (int)aad_len) != 1)) {
+        return false;
+    }
+    for (size_t off = 0; off < len; ) {
+        int step = (int)MIN(len - off, (size_t)QP_REST_UPDATE_MAX);
+        if (EVP_DecryptUpdate(ctx, out + off, &n, in + off, step) != 1) {
+            return false;
+        }
+        off += (size_t)step;
+    }
+    return EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, sizeof(tag), tag) == 1
+        && EVP_DecryptFinal_ex(ctx, out + len, &n) == 1;
+}
+
+/*──────────────────────────── Segments ───────────────────────────────────*/
+
+/* What every segment authenticates besides itself: the total length */
+static void qp_rest_segment_aad(uint8_t *aad, uint64_t len)
+{
+    for (int i = 0; i < 8; i++) {
+        aad[7 - i] = (uint8_t)(len >> (8 * i));
+    }
+}
+
+uint64_t quicpro_at_rest_sealed_len(uint64_t len)
+{
+    return len + (len + QUICPRO_AT_REST_SEGMENT - 1) / QUICPRO_AT_REST_SEGMENT * QUICPRO_AT_REST_TAG_LEN;
+}
+
+bool quicpro_at_rest_seal_segments(quicpro_at_rest_key_t *key, const uint8_t *in, uint64_t len, uint8_t *out)
+{
+    uint8_t aad[8], nonce[QUICPRO_AT_REST_NONCE_LEN];
+    qp_rest_segment_aad(aad, len);
+    for (uint64_t seg = 0, off = 0; off < len; seg++, off += QUICPRO_AT_REST_SEGMENT) {
+        size_t n = (size_t)MIN(len - off, (uint64_t)QUICPRO_AT_REST_SEGMENT);
+        quicpro_at_rest_nonce(nonce, seg);
+        if (!quicpro_at_rest_seal(key, nonce, aad, sizeof(aad), in + off, n,
+                                  out + seg * (QUICPRO_AT_REST_SEGMENT + QUICPRO_AT_REST_TAG_LEN))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+quicpro_at_rest_reader_t *quicpro_at_rest_reader_new(quicpro_at_rest_key_t *key, uint64_t base, uint64_t len)
+{
+    quicpro_at_rest_reader_t *r = pemalloc(sizeof(*r), 1);
+    r->key = *key;
+    key->ctx = NULL;
+    OPENSSL_cleanse(key->key, sizeof(key->key));
+    r->base = base;
+    r->len = len;
+    r->cached = UINT64_MAX;
+    return r;
+}
+
+ssize_t quicpro_at_rest_reader_pread(quicpro_at_rest_reader_t *r, int fd, void *out, size_t len, uint64_t offset)
+{
+    if (offset >= r->len) {
+        return 0;
+    }
+    len = (size_t)MIN((uint64_t)len, r->len - offset);
+    len = MIN(len, (size_t)SSIZE_MAX);
+
+    uint8_t aad[8], nonce[QUICPRO_AT_REST_NONCE_LEN];
+    qp_rest_segment_aad(aad, r->len);
+    size_t done = 0;
+    while (done < len) {
+        uint64_t pos = offset + done, seg = pos / QUICPRO_AT_REST_SEGMENT;
+        size_t seg_len = (size_t)MIN(r->len - seg * QUICPRO_AT_REST_SEGMENT, (uint64_t)QUICPRO_AT_REST_SEGMENT);
+        if (seg != r->cached) {
+            r->cached = UINT64_MAX;
+            off_t at = (off_t)(r->base + seg * (QUICPRO_AT_REST_SEGMENT + QUICPRO_AT_REST_TAG_LEN));
+            size_t want = seg_len + QUICPRO_AT_REST_TAG_LEN, got = 0;
+            while (got < want) {
+                ssize_t n = pread(fd, r->sealed + got, want - got, at + (off_t)got);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) {
+                    if (n == 0) errno = EIO;        /* The file is shorter than its record says */
+                    return done ? (ssize_t)done : -1;
+                }
+                got += (size_t)n;
+            }
+            quicpro_at_rest_nonce(nonce, seg);
+            if (!quicpro_at_rest_open(&r->key, nonce, aad, sizeof(aad), r->sealed, seg_len, r->plain)) {
+                errno = EBADMSG;
+                return done ? (ssize_t)done : -1;
+            }
+            r->cached = seg;
+        }
+        size_t at = (size_t)(pos - seg * QUICPRO_AT_REST_SEGMENT), n = MIN(seg_len - at, len - done);
+        memcpy((uint8_t *)out + done, r->plain + at, n);
+        done += n;
+    }
+    return (ssize_t)done;
+}
+
+void quicpro_at_rest_reader_free(quicpro_at_rest_reader_t *r)
+{
+    if (!r) {
+        return;
+    }
+    quicpro_at_rest_key_clear(&r->key);
+    OPENSSL_cleanse(r->plain, sizeof(r->plain));
+    pefree(r, 1);
+}
@@ -0,0 +1,161 @@
+/*
+ * src/object_store/blake3.c – Content hashes of deduplicated chunks
+ * =================================================================
+ *
+ * See include/object_store/blake3.h. The portable path follows the
+ * specification's reference: 1 KiB chunks compressed block by block, and
+ * a stack of chaining values merged into parents as chunks complete.
+ */
+
+#include "object_store/blake3.h"
+
+#include <string.h>
+
+#ifdef QUICPRO_HAVE_BLAKE3
+# include <blake3.h>
+
+void quicpro_blake3(const void *data, size_t len, uint8_t out[QUICPRO_BLAKE3_LEN])
+{
+    blake3_hasher h;
+    blake3_hasher_init(&h);
+    blake3_hasher_update(&h, data, len);
+    blake3_hasher_finalize(&h, out, QUICPRO_BLAKE3_LEN);
+}
+#else
+
+#define QP_B3_BLOCK_LEN   64
+#define QP_B3_CHUNK_LEN   1024
+#define QP_B3_CHUNK_START 1u
+#define QP_B3_CHUNK_END   2u
+#define QP_B3_PARENT      4u
+#define QP_B3_ROOT        8u
+
+static const uint32_t qp_b3_iv[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+static const uint8_t qp_b3_perm[16] = { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 };
+
+static inline uint32_t qp_b3_rotr(uint32_t w, unsigned c)
+{
+    return (w >> c) | (w << (32 - c));
+}
+
+static inline void qp_b3_g(uint32_t *s, int a, int b, int c, int d, uint32_t mx, uint32_t my)
+{
+    s[a] = s[a] + s[b] + mx;
+    s[d] = qp_b3_rotr(s[d] ^ s[a], 16);
+    s[c] = s[c] + s[d];
+    s[b] = qp_b3_rotr(s[b] ^ s[c], 12);
+    s[a] = s[a] + s[b] + my;
+    s[d] = qp_b3_rotr(s[d] ^ s[a], 8);
+    s[c] = s[c] + s[d];
+    s[b] = qp_b3_rotr(s[b] ^ s[c], 7);
+}
+
+static void qp_b3_compress(const uint32_t cv[8], const uint32_t block[16], uint64_t counter,
+                           uint32_t block_len, uint32_t flags, uint32_t out[8])
+{
+    uint32_t s[16] = {
+        cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+        qp_b3_iv[0], qp_b3_iv[1], qp_b3_iv[2], qp_b3_iv[3],
+        (uint32_t)counter, (uint32_t)(counter >> 32), block_len, flags
+    };
+    uint32_t m[16], t[16];
+    memcpy(m, block, sizeof(m));
+
+    for (int round = 0; round < 7; round++) {
+        qp_b3_g(s, 0, 4, 8, 12, m[0], m[1]);
+        qp_b3_g(s, 1, 5, 9, 13, m[2], m[3]);
+        qp_b3_g(s, 2, 6, 10, 14, m[4], m[5]);
+        qp_b3_g(s, 3, 7, 11, 15, m[6], m[7]);
+        qp_b3_g(s, 0, 5, 10, 15, m[8], m[9]);
+        qp_b3_g(s, 1, 6, 11, 12, m[10], m[11]);
+        qp_b3_g(s, 2, 7, 8, 13, m[12], m[13]);
+        qp_b3_g(s, 3, 4, 9, 14, m[14], m[15]);
+        for (int i = 0; i < 16; i++) t[i] = m[qp_b3_perm[i]];
+        memcpy(m, t, sizeof(m));
+    }
+    for (int i = 0; i < 8; i++) out[i] = s[i] ^ s[i + 8];
+}
+
+static void qp_b3_words(const uint8_t *p, size_t len, uint32_t block[16])
+{
+    uint8_t buf[QP_B3_BLOCK_LEN] = {0};
+    memcpy(buf, p, len);
+    for (int i = 0; i < 16; i++) {
+        block[i] = (uint32_t)buf[4 * i] | (uint32_t)buf[4 * i + 1] << 8
+                 | (uint32_t)buf[4 * i + 2] << 16 | (uint32_t)buf[4 * i + 3] << 24;
+    }
+}
+
+/* Compresses all but the last block of a chunk; `last` receives what the final compression needs */
+static void qp_b3_chunk(const uint8_t *p, size_t len, uint64_t counter, uint32_t cv[8],
+                        uint32_t last[16], uint32_t *last_len, uint32_t *last_flags)
+{
+    uint32_t block[16];
+    uint32_t start = QP_B3_CHUNK_START;
+
+    memcpy(cv, qp_b3_iv, sizeof(qp_b3_iv));
+    while (len > QP_B3_BLOCK_LEN) {
+        qp_b3_words(p, QP_B3_BLOCK_LEN, block);
+        qp_b3_compress(cv, block, counter, QP_B3_BLOCK_LEN, start, cv);
+        start = 0;
+        p += QP_B3_BLOCK_LEN;
+        len -= QP_B3_BLOCK_LEN;
+    }
+    qp_b3_words(p, len, last);
+    *last_len = (uint32_t)len;
+    *last_flags = start | QP_B3_CHUNK_END;
+}
+
+static void qp_b3_parent(const uint32_t left[8], const uint32_t right[8], uint32_t flags, uint32_t out[8])
+{
+    uint32_t block[16];
+    memcpy(block, left, 8 * sizeof(uint32_t));
+    memcpy(block + 8, right, 8 * sizeof(uint32_t));
+    qp_b3_compress(qp_b3_iv, block, 0, QP_B3_BLOCK_LEN, QP_B3_PARENT | flags, out);
+}
+
+void quicpro_blake3(const void *data, size_t len, uint8_t out[QUICPRO_BLAKE3_LEN])
+{
+    const uint8_t *p = data;
+    uint32_t stack[54][8];
+    size_t depth = 0;
+    uint64_t counter = 0;
+    uint32_t cv[8], last[16], last_len, last_flags, root[8];
+
+    /* Every chunk but the last completes, and merges with its finished siblings */
+    while (len > QP_B3_CHUNK_LEN) {
+        uint32_t chunk_cv[8];
+        qp_b3_chunk(p, QP_B3_CHUNK_LEN, counter, cv, last, &last_len, &last_flags);
+        qp_b3_compress(cv, last, counter, last_len, last_flags, chunk_cv);
+        counter++;
+        for (uint64_t total = counter; (total & 1) == 0; total >>= 1) {
+            qp_b3_parent(stack[--depth], chunk_cv, 0, chunk_cv);
+        }
+        memcpy(stack[depth++], chunk_cv, sizeof(chunk_cv));
+        p += QP_B3_CHUNK_LEN;
+        len -= QP_B3_CHUNK_LEN;
+    }
+
+    /* The last chunk's output is the root unless parents remain above it */
+    qp_b3_chunk(p, len, counter, cv, last, &last_len, &last_flags);
+    if (depth == 0) {
+        qp_b3_compress(cv, last, counter, last_len, last_flags | QP_B3_ROOT, root);
+    } else {
+        uint32_t right[8];
+        qp_b3_compress(cv, last, counter, last_len, last_flags, right);
+        while (depth > 1) {
+            qp_b3_parent(stack[--depth], right, 0, right);
+        }
+        qp_b3_parent(stack[0], right, QP_B3_ROOT, root);
+    }
+    for (int i = 0; i < 8; i++) {
+        out[4 * i]     = (uint8_t)root[i];
+        out[4 * i + 1] = (uint8_t)(root[i] >> 8);
+        out[4 * i + 2] = (uint8_t)(root[i] >> 16);
+        out[4 * i + 3] = (uint8_t)(root[i] >> 24);
+    }
+}
+#endif
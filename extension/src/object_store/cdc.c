@@ -0,0 +1,72 @@
+/*
+ * src/object_store/cdc.c – Content-defined chunk boundaries
+ * =========================================================
+ *
+ * See include/object_store/cdc.h. The gear table is drawn from a fixed
+ * seed, so every build cuts the same data at the same bytes; the masks
+ * take the hash's top bits, which depend on the last 64 bytes rolled in.
+ */
+
+#include "object_store/cdc.h"
+
+#include <pthread.h>
+
+static uint64_t qp_cdc_gear[256];
+static pthread_once_t qp_cdc_once = PTHREAD_ONCE_INIT;
+
+static void qp_cdc_fill_gear(void)
+{
+    uint64_t x = 0x71756963707266ULL;   /* "quicprf" */
+    for (int i = 0; i < 256; i++) {
+        /* splitmix64 */
+        uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        qp_cdc_gear[i] = z ^ (z >> 31);
+    }
+}
+
+static inline uint64_t qp_cdc_top_bits(unsigned n)
+{
+    return n == 0 ? 0 : ~0ULL << (64 - n);
+}
+
+void quicpro_cdc_init(quicpro_cdc_t *c, size_t avg)
+{
+    unsigned bits = 8;
+    while (bits < 40 && ((size_t)1 << (bits + 1)) <= avg) {
+        bits++;
+    }
+    pthread_once(&qp_cdc_once, qp_cdc_fill_gear);
+    c->avg = (size_t)1 << bits;
+    c->min = c->avg / 4;
+    c->max = c->avg * 4;
+    c->mask_s = qp_cdc_top_bits(bits + 2);
+    c->mask_l = qp_cdc_top_bits(bits - 2);
+}
+
+size_t quicpro_cdc_cut(const quicpro_cdc_t *c, const uint8_t *p, size_t len)
+{
+    if (len <= c->min) {
+        return len;
+    }
+    size_t normal = len < c->avg ? len : c->avg;
+    size_t end = len < c->max ? len : c->max;
+    size_t i = c->min;
+    uint64_t fp = 0;
+
+    /* The first min bytes never end a chunk, so they are not hashed */
+    for (; i < normal; i++) {
+        fp = (fp << 1) + qp_cdc_gear[p[i]];
+        if (!(fp & c->mask_s)) {
+            return i + 1;
+        }
+    }
+    for (; i < end; i++) {
+        fp = (fp << 1) + qp_cdc_gear[p[i]];
+        if (!(fp & c->mask_l)) {
+            return i + 1;
+        }
+    }
+    return end;
+}
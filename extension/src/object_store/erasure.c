@@ -0,0 +1,196 @@
+/*
+ * src/object_store/erasure.c – Reed-Solomon coding for quicpro-fs://
+ * ==================================================================
+ *
+ * See include/object_store/erasure.h. The field tables are built once per
+ * process; the portable path multiplies through a 64 KiB product table,
+ * one row per coefficient, so each output byte costs a lookup and an XOR
+ * per source shard.
+ */
+
+#include <php.h>
+
+#include "object_store/erasure.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#ifdef QUICPRO_HAVE_ISAL
+# include <isa-l/erasure_code.h>
+#endif
+
+static uint8_t        qp_gf_exp[512];
+static uint8_t        qp_gf_log[256];
+static uint8_t        qp_gf_mul_table[256][256];
+static pthread_once_t qp_gf_once = PTHREAD_ONCE_INIT;
+
+static void qp_gf_init(void)
+{
+    unsigned x = 1;
+    for (unsigned i = 0; i < 255; i++) {
+        qp_gf_exp[i] = (uint8_t)x;
+        qp_gf_log[x] = (uint8_t)i;
+        x <<= 1;
+        if (x & 0x100) x ^= 0x11d;
+    }
+    for (unsigned i = 255; i < 512; i++) qp_gf_exp[i] = qp_gf_exp[i - 255];
+    for (unsigned a = 1; a < 256; a++) {
+        for (unsigned b = 1; b < 256; b++) {
+            qp_gf_mul_table[a][b] = qp_gf_exp[qp_gf_log[a] + qp_gf_log[b]];
+        }
+    }
+}
+
+static uint8_t qp_gf_mul(uint8_t a, uint8_t b)
+{
+    return qp_gf_mul_table[a][b];
+}
+
+static uint8_t qp_gf_inv(uint8_t a)
+{
+    return qp_gf_exp[255 - qp_gf_log[a]];
+}
+
+/* Gauss-Jordan over GF(2^8): `out` = `in`⁻¹, both n × n; `in` is destroyed */
+static bool qp_gf_invert(uint8_t *in, uint8_t *out, unsigned n)
+{
+    memset(out, 0, (size_t)n * n);
+    for (unsigned i = 0; i < n; i++) out[i * n + i] = 1;
+
+    for (unsigned col = 0; col < n; col++) {
+        unsigned pivot = col;
+        while (pivot < n && in[pivot * n + col] == 0) pivot++;
+        if (pivot == n) {
+            return false;
+        }
+        if (pivot != col) {
+            for (unsigned j = 0; j < n; j++) {
+                uint8_t t = in[col * n + j]; in[col * n + j] = in[pivot * n + j]; in[pivot * n + j] = t;
+                t = out[col * n + j]; out[col * n + j] = out[pivot * n + j]; out[pivot * n + j] = t;
+            }
+        }
+        uint8_t scale = qp_gf_inv(in[col * n + col]);
+        for (unsigned j = 0; j < n; j++) {
+            in[col * n + j] = qp_gf_mul(in[col * n + j], scale);
+            out[col * n + j] = qp_gf_mul(out[col * n + j], scale);
+        }
+        for (unsigned row = 0; row < n; row++) {
+            uint8_t f = in[row * n + col];
+            if (row == col || f == 0) continue;
+            for (unsigned j = 0; j < n; j++) {
+                in[row * n + j] ^= qp_gf_mul(f, in[col * n + j]);
+                out[row * n + j] ^= qp_gf_mul(f, out[col * n + j]);
+            }
+        }
+    }
+    return true;
+}
+
+#ifndef QUICPRO_HAVE_ISAL
+/* out = Σ coef[j] · src[j], over `rows` outputs of `len` bytes */
+static void qp_ec_apply(const uint8_t *coef, unsigned k, unsigned rows, size_t len, uint8_t *const *src, uint8_t *const *out)
+{
+    for (unsigned r = 0; r < rows; r++) {
+        uint8_t *o = out[r];
+        memset(o, 0, len);
+        for (unsigned j = 0; j < k; j++) {
+            uint8_t c = coef[r * k + j];
+            const uint8_t *in = src[j];
+            if (c == 0) {
+                continue;
+            } else if (c == 1) {
+                for (size_t x = 0; x < len; x++) o[x] ^= in[x];
+            } else {
+                const uint8_t *t = qp_gf_mul_table[c];
+                for (size_t x = 0; x < len; x++) o[x] ^= t[in[x]];
+            }
+        }
+    }
+}
+#endif
+
+bool quicpro_ec_init(quicpro_ec_t *ec, unsigned k, unsigned m)
+{
+    memset(ec, 0, sizeof(*ec));
+    if (k == 0 || k + m > QUICPRO_EC_MAX_SHARDS) {
+        return false;
+    }
+    pthread_once(&qp_gf_once, qp_gf_init);
+    ec->k = k;
+    ec->m = m;
+    ec->matrix = emalloc((size_t)(k + m) * k);
+
+    /* gf_gen_cauchy1_matrix(): identity on top, 1 / (i ^ j) below */
+    memset(ec->matrix, 0, (size_t)k * k);
+    for (unsigned i = 0; i < k; i++) ec->matrix[i * k + i] = 1;
+    for (unsigned i = k; i < k + m; i++) {
+        for (unsigned j = 0; j < k; j++) ec->matrix[i * k + j] = qp_gf_inv((uint8_t)(i ^ j));
+    }
+#ifdef QUICPRO_HAVE_ISAL
+    if (m > 0) {
+        ec->tables = emalloc((size_t)k * m * 32);
+        ec_init_tables((int)k, (int)m, ec->matrix + (size_t)k * k, ec->tables);
+    }
+#endif
+    return true;
+}
+
+void quicpro_ec_free(quicpro_ec_t *ec)
+{
+    if (ec->matrix) efree(ec->matrix);
+    if (ec->tables) efree(ec->tables);
+    memset(ec, 0, sizeof(*ec));
+}
+
+void quicpro_ec_encode(const quicpro_ec_t *ec, size_t len, uint8_t *const *data, uint8_t *const *parity)
+{
+    if (ec->m == 0 || len == 0) {
+        return;
+    }
+#ifdef QUICPRO_HAVE_ISAL
+    ec_encode_data((int)len, (int)ec->k, (int)ec->m, ec->tables, (uint8_t **)data, (uint8_t **)parity);
+#else
+    qp_ec_apply(ec->matrix + (size_t)ec->k * ec->k, ec->k, ec->m, len, data, parity);
+#endif
+}
+
+bool quicpro_ec_recover(const quicpro_ec_t *ec, size_t len, uint8_t *const *shards, const bool *present)
+{
+    unsigned k = ec->k, rows[QUICPRO_EC_MAX_SHARDS], missing[QUICPRO_EC_MAX_SHARDS];
+    unsigned have = 0, nmissing = 0;
+    for (unsigned i = 0; i < k + ec->m && have < k; i++) {
+        if (present[i]) rows[have++] = i;
+    }
+    if (have < k) {
+        return false;
+    }
+    for (unsigned i = 0; i < k; i++) {
+        if (!present[i]) missing[nmissing++] = i;
+    }
+    if (nmissing == 0 || len == 0) {
+        return true;
+    }
+
+    /* The rows of the shards we have, inverted, map them back to the data */
+    uint8_t b[QUICPRO_EC_MAX_SHARDS * QUICPRO_EC_MAX_SHARDS], inv[QUICPRO_EC_MAX_SHARDS * QUICPRO_EC_MAX_SHARDS];
+    uint8_t decode[QUICPRO_EC_MAX_SHARDS * QUICPRO_EC_MAX_SHARDS];
+    for (unsigned r = 0; r < k; r++) memcpy(b + r * k, ec->matrix + (size_t)rows[r] * k, k);
+    if (!qp_gf_invert(b, inv, k)) {
+        return false;
+    }
+    uint8_t *src[QUICPRO_EC_MAX_SHARDS], *out[QUICPRO_EC_MAX_SHARDS];
+    for (unsigned r = 0; r < k; r++) src[r] = shards[rows[r]];
+    for (unsigned i = 0; i < nmissing; i++) {
+        memcpy(decode + i * k, inv + missing[i] * k, k);
+        out[i] = shards[missing[i]];
+    }
+#ifdef QUICPRO_HAVE_ISAL
+    uint8_t *tables = emalloc((size_t)k * nmissing * 32);
+    ec_init_tables((int)k, (int)nmissing, decode, tables);
+    ec_encode_data((int)len, (int)k, (int)nmissing, tables, src, out);
+    efree(tables);
+#else
+    qp_ec_apply(decode, k, nmissing, len, src, out);
+#endif
+    return true;
+}
@@ -0,0 +1,136 @@
+/*
+ * src/object_store/metadata_cache.c – Manifest cache of quicpro-fs://
+ * ===================================================================
+ *
+ * The table is a cluster/shm_cache.h slot table of QP_MD_SLOTS slots; a
+ * manifest expires when its lease runs out.
+ */
+
+#include "php_quicpro.h"
+#include "object_store/metadata_cache.h"
+#include "cluster/shm_cache.h"
+#include "config/native_object_store/base_layer.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define QP_MD_SLOTS       16384
+
+typedef struct {
+    quicpro_shm_cache_slot_t head;  /* Key: hash of the name */
+    uint16_t    name_len;
+    uint16_t    len;
+    char        name[QUICPRO_OBJSTORE_MD_NAME_MAX];
+    char        manifest[QUICPRO_OBJSTORE_MANIFEST_MAX];
+} qp_md_slot_t;
+
+static quicpro_shm_cache_t qp_md_table;
+
+static bool qp_md_map(int flags)
+{
+    return quicpro_shm_cache_map(&qp_md_table, QP_MD_SLOTS, sizeof(qp_md_slot_t), flags);
+}
+
+static bool qp_md_ready(const char *name, size_t name_len)
+{
+    if (!quicpro_native_object_store_config.metadata_cache_enable || name_len == 0 || name_len > QUICPRO_OBJSTORE_MD_NAME_MAX) {
+        return false;
+    }
+    /* Outside a cluster nobody prepared it; a private table still serves this process */
+    return qp_md_table.slots || qp_md_map(MAP_PRIVATE);
+}
+
+static inline bool qp_md_holds(const qp_md_slot_t *slot, const char *name, size_t name_len)
+{
+    return slot->name_len == name_len && memcmp(slot->name, name, name_len) == 0;
+}
+
+/*──────────────────────────── Lifecycle ──────────────────────────────────*/
+
+void quicpro_objstore_md_prepare(void)
+{
+    if (qp_md_table.slots || !quicpro_native_object_store_config.enable || !quicpro_native_object_store_config.metadata_cache_enable) {
+        return;
+    }
+    if (!qp_md_map(MAP_SHARED)) {
+        php_error_docref(NULL, E_WARNING, "Shared object store metadata cache unavailable; every worker falls back to its own");
+    }
+}
+
+void quicpro_objstore_md_release(void)
+{
+    quicpro_shm_cache_unmap(&qp_md_table);
+}
+
+/*──────────────────────────── Lookup / store ─────────────────────────────*/
+
+size_t quicpro_objstore_md_get(const char *name, size_t name_len, char *out)
+{
+    if (!qp_md_ready(name, name_len)) {
+        return 0;
+    }
+    uint64_t key = zend_inline_hash_func(name, name_len) | 1;
+    uint64_t now = quicpro_shm_cache_now_ms();
+
+    for (size_t way = 0; way < 2; way++) {
+        qp_md_slot_t *slot = (qp_md_slot_t *)quicpro_shm_cache_find(&qp_md_table, key, way);
+        if (!slot) {
+            continue;
+        }
+        size_t len = 0;
+        if (quicpro_shm_cache_live(&slot->head, key, now) && qp_md_holds(slot, name, name_len)) {
+            len = slot->len;
+            memcpy(out, slot->manifest, len);
+        }
+        quicpro_shm_cache_unlock(&slot->head);
+        if (len) {
+            return len;
+        }
+    }
+    return 0;
+}
+
+void quicpro_objstore_md_put(const char *name, size_t name_len, const char *manifest, size_t len, zend_long lease_ms)
+{
+    zend_long ttl_ms = quicpro_native_object_store_config.metadata_cache_ttl_sec * 1000;
+    if (lease_ms < 0 || lease_ms > ttl_ms) {
+        lease_ms = ttl_ms;
+    }
+    if (len == 0 || !qp_md_ready(name, name_len)) {
+        return;
+    }
+    if (lease_ms == 0 || len > QUICPRO_OBJSTORE_MANIFEST_MAX) {
+        quicpro_objstore_md_forget(name, name_len);
+        return;
+    }
+    uint64_t key = zend_inline_hash_func(name, name_len) | 1;
+    uint64_t now = quicpro_shm_cache_now_ms();
+    qp_md_slot_t *slot = (qp_md_slot_t *)quicpro_shm_cache_claim(&qp_md_table, key, now);
+    if (!slot) {
+        return;
+    }
+    quicpro_shm_cache_set(&slot->head, key, now + (uint64_t)lease_ms);
+    slot->name_len = (uint16_t)name_len;
+    memcpy(slot->name, name, name_len);
+    slot->len = (uint16_t)len;
+    memcpy(slot->manifest, manifest, len);
+    quicpro_shm_cache_unlock(&slot->head);
+}
+
+void quicpro_objstore_md_forget(const char *name, size_t name_len)
+{
+    if (!qp_md_ready(name, name_len)) {
+        return;
+    }
+    uint64_t key = zend_inline_hash_func(name, name_len) | 1;
+    for (size_t way = 0; way < 2; way++) {
+        qp_md_slot_t *slot = (qp_md_slot_t *)quicpro_shm_cache_find(&qp_md_table, key, way);
+        if (slot) {
+            if (quicpro_shm_cache_holds(&slot->head, key) && qp_md_holds(slot, name, name_len)) {
+                quicpro_shm_cache_clear(&slot->head);
+            }
+            quicpro_shm_cache_unlock(&slot->head);
+        }
+    }
+}
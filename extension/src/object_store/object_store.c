@@ -0,0 +1,1444 @@
+/*
+ * src/object_store/object_store.c – Data path of quicpro-fs://
+ * =============================================================
+ *
+ * See include/object_store/object_store.h. Every request sent to a node
+ * is an op in that node's table, keyed by its multiplexer id; the op names
+ * its owner (a writer or reader), the owner's chunk slot and the slot's
+ * generation, so an answer that arrives after its owner went away or
+ * moved on to another chunk is dropped.
+ *
+ * Deduplicating writers hash each content-defined chunk, gather
+ * QP_OS_HAS_BATCH of them and ask every node in one request which of
+ * their shards it already holds; only the chunks still missing a shard are
+ * encoded and sent, and of those only the shards that are missing.
+ *
+ * With encryption at rest (object_store/at_rest.h) a chunk is sealed
+ * before it is cut into shards, so the nodes, and the parity, only ever
+ * see ciphertext; the writer seals the next chunk while the shards of
+ * those before it are on their way. Positional chunks use a key of their
+ * object's name and version and their index as nonce. Deduplicated ones
+ * use one key for all and the first bytes of their content hash as
+ * nonce: the same content seals to the same bytes, so it is still stored
+ * once. Their layout ends in "-g<key id>" (AES-GCM) or "-c<key id>"
+ * (ChaCha20-Poly1305), keeping them apart from shards sealed otherwise,
+ * and the manifest's first line in the algorithm and key id.
+ */
+
+#include "php_quicpro.h"
+#include "object_store/object_store.h"
+#include "object_store/at_rest.h"
+#include "object_store/blake3.h"
+#include "object_store/cdc.h"
+#include "object_store/erasure.h"
+#include "object_store/metadata_cache.h"
+#include "client/cancel.h"
+#include "client/mux.h"
+#include "client/pool.h"
+#include "client/session.h"
+#include "config/native_object_store/base_layer.h"
+#include "config/quic_transport/base_layer.h"
+
+#include <ext/spl/spl_exceptions.h>
+#include <ext/standard/url.h>
+#include <openssl/rand.h>
+#include <quiche.h>
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+extern int le_quicpro_session;
+
+#define QP_OS_SHARD_ALIGN   64          /* Shard lengths are multiples, for the SIMD kernels */
+#define QP_OS_DRAIN_MS      1000        /* What close waits for requests still in flight */
+#define QP_OS_NO_SLOT       UINT_MAX    /* The op belongs to no chunk: a manifest */
+#define QP_OS_H3_NO_ERROR   0x100
+#define QP_OS_HAS_BATCH     16          /* Chunks per has-chunk query */
+#define QP_OS_HEX_LEN       (2 * QUICPRO_BLAKE3_LEN)
+
+typedef enum {
+    QP_OS_PUT_SHARD,
+    QP_OS_GET_SHARD,
+    QP_OS_PUT_MANIFEST,
+    QP_OS_GET_MANIFEST,
+    QP_OS_HAS_CHUNKS
+} qp_os_kind_t;
+
+typedef struct {
+    qp_os_kind_t  kind;
+    void         *owner;                /* Writer or reader; NULL once it is gone */
+    unsigned      slot;
+    uint32_t      gen;                  /* The slot's generation when sent */
+    unsigned      shard;
+} qp_os_op_t;
+
+typedef struct {
+    zend_resource     *res;             /* Our reference; NULL while down */
+    quicpro_session_t *s;
+    HashTable          ops;             /* Multiplexer id → qp_os_op_t * */
+} qp_os_node_t;
+
+struct quicpro_objstore_s {
+    qp_os_node_t *nodes;
+    unsigned      count, up;
+    unsigned      k, m;
+    bool          copies;               /* Replication: the parity shards are copies of the one data shard */
+    quicpro_ec_t  ec;
+    size_t        chunk_size;           /* A multiple of k * QP_OS_SHARD_ALIGN */
+    bool          dedup;                /* quicpro.storage_versioning_enable: content-defined chunks */
+    quicpro_cdc_t cdc;
+    char          layout[24];           /* "<k>d<m>p" or "<copies>x", in content-addressed paths */
+    quicpro_at_rest_alg_t seal;         /* NONE unless chunks are encrypted */
+    char          key_id[QUICPRO_AT_REST_KEY_ID_LEN + 1];
+    quicpro_at_rest_key_t chunk_key;    /* Of deduplicated chunks */
+};
+
+/* A deduplicated chunk waiting for the has-chunk query */
+typedef struct {
+    uint8_t      hash[QUICPRO_BLAKE3_LEN];
+    char         hex[QP_OS_HEX_LEN + 1];
+    uint64_t     index;
+    uint32_t     present;               /* Shards some node already holds */
+    zend_string *data;
+} qp_os_pending_t;
+
+/* A written chunk while its shards are in flight */
+typedef struct {
+    uint64_t  index;
+    unsigned  outstanding;
+    unsigned  failed;
+} qp_os_wslot_t;
+
+struct quicpro_objstore_writer_s {
+    quicpro_objstore_t *st;
+    zend_string        *name;           /* Percent-encoded */
+    uint64_t            version;
+    quicpro_at_rest_key_t key;          /* Sealing: the object's */
+    uint8_t            *buf;            /* The chunk being filled: chunk_size bytes, cdc.max deduplicating */
+    size_t              cap, fill;
+    uint64_t            next_index, size;
+    uint64_t            sent;           /* Chunks sent, which picks their slot */
+    qp_os_wslot_t      *slots;          /* `window` of them */
+    unsigned            nslots;
+    unsigned            manifest_pending, manifest_ok;
+    bool                lost;
+    uint64_t            lost_index;
+    /* Deduplicating */
+    smart_str           chunks;         /* The manifest's chunk lines */
+    HashTable           seen;           /* Hex hashes of the chunks handled so far */
+    qp_os_pending_t     batch[QP_OS_HAS_BATCH];
+    unsigned            nbatch, has_pending;
+};
+
+typedef struct {
+    uint64_t     index;
+    uint32_t     gen;
+    bool         asked, ready, failed;
+    bool         forged;                /* Whole, but failed its tag */
+    unsigned     outstanding, have, next_parity;
+    zend_string *shards[QUICPRO_EC_MAX_SHARDS];
+    zend_string *data;
+} qp_os_rslot_t;
+
+struct quicpro_objstore_reader_s {
+    quicpro_objstore_t *st;
+    zend_string        *name;
+    zend_string        *display;        /* The name as given, for messages */
+    uint64_t            version, size;
+    size_t              chunk_size;     /* Deduplicated: the average */
+    uint64_t            nchunks;
+    uint64_t           *offsets;        /* Deduplicated: nchunks + 1 chunk starts; else NULL */
+    uint8_t            *hashes;         /* Deduplicated: nchunks BLAKE3 hashes */
+    unsigned            k, m;           /* The manifest's, which may predate the configuration's */
+    bool                copies;
+    char                layout[24];
+    quicpro_at_rest_alg_t seal;         /* From the manifest */
+    char                key_id[QUICPRO_AT_REST_KEY_ID_LEN + 1];
+    quicpro_at_rest_key_t key;
+    quicpro_ec_t        ec;
+    qp_os_rslot_t      *slots;          /* window + 1: the chunk being read and those ahead */
+    unsigned            nslots;
+    bool                manifest_pending;
+    zend_string        *manifest;
+    bool                cached;         /* The manifest came from object_store/metadata_cache.h */
+    zend_long           lease_ms;       /* The node's quicpro-lease-ms; -1: none */
+};
+
+static void qp_os_complete(quicpro_objstore_t *st, qp_os_op_t *op, bool ok, zend_string *body, HashTable *headers);
+
+/*─────────────────────────────── Helpers ─────────────────────────────────*/
+
+static zend_long qp_os_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (zend_long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static size_t qp_os_shard_len(unsigned k, size_t chunk_len)
+{
+    size_t per = (chunk_len + k - 1) / k;
+    return (per + QP_OS_SHARD_ALIGN - 1) & ~(size_t)(QP_OS_SHARD_ALIGN - 1);
+}
+
+/* The first of the m + 1 nodes holding the manifest of `name` */
+static unsigned qp_os_home(const quicpro_objstore_t *st, const zend_string *name)
+{
+    return (unsigned)(zend_inline_hash_func(ZSTR_VAL(name), ZSTR_LEN(name)) % st->count);
+}
+
+static void qp_os_shard_path(smart_str *p, zend_string *name, uint64_t version, uint64_t chunk, unsigned shard)
+{
+    char tail[64];
+    int n = snprintf(tail, sizeof(tail), "/%016" PRIx64 "/%" PRIu64 "/%u", version, chunk, shard);
+    smart_str_appendl(p, "/shards/", sizeof("/shards/") - 1);
+    smart_str_append(p, name);
+    smart_str_appendl(p, tail, (size_t)n);
+    smart_str_0(p);
+}
+
+static void qp_os_layout(char *out, size_t size, unsigned k, unsigned m, bool copies)
+{
+    if (copies) {
+        snprintf(out, size, "%ux", m + 1);
+    } else {
+        snprintf(out, size, "%ud%up", k, m);
+    }
+}
+
+/* Appends the seal to a layout: "-g" or "-c" and the key id */
+static void qp_os_layout_seal(char *layout, size_t size, quicpro_at_rest_alg_t seal, const char *key_id)
+{
+    if (seal != QUICPRO_AT_REST_NONE) {
+        size_t n = strlen(layout);
+        snprintf(layout + n, size - n, "-%c%s", seal == QUICPRO_AT_REST_CHACHA20_POLY1305 ? 'c' : 'g', key_id);
+    }
+}
+
+/* The key of a positional object's chunks */
+static bool qp_os_object_key(quicpro_at_rest_key_t *key, quicpro_at_rest_alg_t seal, const zend_string *name, uint64_t version)
+{
+    size_t len = ZSTR_LEN(name) + sizeof(version);
+    uint8_t *context = emalloc(len);
+    for (int i = 0; i < 8; i++) {
+        context[i] = (uint8_t)(version >> (56 - 8 * i));
+    }
+    memcpy(context + sizeof(version), ZSTR_VAL(name), ZSTR_LEN(name));
+    bool ok = quicpro_at_rest_derive(key, seal, "quicpro-fs object", context, len);
+    efree(context);
+    return ok;
+}
+
+static void qp_os_hex(const uint8_t *hash, char *out)
+{
+    static const char digits[] = "0123456789abcdef";
+    for (unsigned i = 0; i < QUICPRO_BLAKE3_LEN; i++) {
+        out[2 * i] = digits[hash[i] >> 4];
+        out[2 * i + 1] = digits[hash[i] & 0xf];
+    }
+    out[QP_OS_HEX_LEN] = '\0';
+}
+
+static bool qp_os_unhex(const char *in, uint8_t *hash)
+{
+    for (unsigned i = 0; i < QP_OS_HEX_LEN; i++) {
+        char c = in[i];
+        int v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (v < 0) {
+            return false;
+        }
+        hash[i / 2] = (uint8_t)(i % 2 ? hash[i / 2] | v : v << 4);
+    }
+    return true;
+}
+
+/* Where a content-addressed chunk's shards start; chunk c of a positional one starts at c */
+static uint64_t qp_os_hash_base(const uint8_t *hash)
+{
+    uint64_t b = 0;
+    for (unsigned i = 0; i < 8; i++) {
+        b |= (uint64_t)hash[i] << (8 * i);
+    }
+    return b;
+}
+
+/* "<hex>/<layout>/<shard>": a content-addressed shard under /chunks/ */
+static void qp_os_chunk_key(smart_str *p, const char *hex, const char *layout, unsigned shard)
+{
+    smart_str_appendl(p, hex, QP_OS_HEX_LEN);
+    smart_str_appendc(p, '/');
+    smart_str_appends(p, layout);
+    smart_str_appendc(p, '/');
+    smart_str_append_unsigned(p, shard);
+}
+
+static void qp_os_chunk_path(smart_str *p, const char *hex, const char *layout, unsigned shard)
+{
+    smart_str_appendl(p, "/chunks/", sizeof("/chunks/") - 1);
+    qp_os_chunk_key(p, hex, layout, shard);
+    smart_str_0(p);
+}
+
+static void qp_os_manifest_path(smart_str *p, zend_string *name)
+{
+    smart_str_appendl(p, "/objects/", sizeof("/objects/") - 1);
+    smart_str_append(p, name);
+    smart_str_0(p);
+}
+
+/* Sends a request to node `i` for `op`; false if the node is down */
+static bool qp_os_send(quicpro_objstore_t *st, unsigned i, const char *method, smart_str *path, zend_string *body, const qp_os_op_t *op)
+{
+    qp_os_node_t *n = &st->nodes[i];
+    if (!n->s) {
+        return false;
+    }
+    uint64_t id = quicpro_h3_mux_submit(n->s, method, ZSTR_VAL(path->s), ZSTR_LEN(path->s), body);
+    qp_os_op_t *copy = emalloc(sizeof(*copy));
+    *copy = *op;
+    zend_hash_index_add_new_ptr(&n->ops, (zend_ulong)id, copy);
+    return true;
+}
+
+/* Fails what node `i` still had in flight and drops its connection */
+static void qp_os_node_down(quicpro_objstore_t *st, unsigned i)
+{
+    qp_os_node_t *n = &st->nodes[i];
+    HashTable left = n->ops;
+    qp_os_op_t *op;
+
+    zend_hash_init(&n->ops, 8, NULL, NULL, 0);
+    if (n->res) {
+        zend_list_delete(n->res);
+        n->res = NULL;
+        n->s = NULL;
+        st->up--;
+    }
+    ZEND_HASH_FOREACH_PTR(&left, op) {
+        qp_os_complete(st, op, false, NULL, NULL);
+        efree(op);
+    } ZEND_HASH_FOREACH_END();
+    zend_hash_destroy(&left);
+}
+
+/*
+ * One round on every node with requests in flight. If none completed and
+ * `wait_ms` is not 0, then waits up to `wait_ms` (-1: without limit) for
+ * any of their sockets or QUIC timers.
+ */
+static bool qp_os_pump(quicpro_objstore_t *st, zend_long wait_ms)
+{
+    unsigned done = 0, npfd = 0;
+
+    for (unsigned i = 0; i < st->count; i++) {
+        qp_os_node_t *n = &st->nodes[i];
+        if (!n->s || zend_hash_num_elements(&n->ops) == 0) {
+            continue;
+        }
+        quicpro_h3_mux_step(n->s);
+
+        uint64_t id;
+        zend_long status;
+        zend_string *body, *error;
+        zval headers;
+        while (quicpro_h3_mux_take(n->s, &id, &status, &body, &error, &headers)) {
+            qp_os_op_t *op = zend_hash_index_find_ptr(&n->ops, (zend_ulong)id);
+            if (op) {
+                zend_hash_index_del(&n->ops, (zend_ulong)id);
+                qp_os_complete(st, op, !error && status / 100 == 2, body,
+                               Z_TYPE(headers) == IS_ARRAY ? Z_ARRVAL(headers) : NULL);
+                efree(op);
+                done++;
+            }
+            zval_ptr_dtor(&headers);
+            zend_string_release(body);
+            if (error) {
+                zend_string_release(error);
+            }
+        }
+        if (n->s->is_closed || !n->s->conn || quiche_conn_is_closed(n->s->conn)) {
+            qp_os_node_down(st, i);
+        }
+    }
+    if (done || wait_ms == 0) {
+        return true;
+    }
+
+    struct pollfd *pfds = safe_emalloc(st->count, sizeof(*pfds), 0);
+    int64_t timeout = wait_ms;
+    for (unsigned i = 0; i < st->count; i++) {
+        qp_os_node_t *n = &st->nodes[i];
+        if (!n->s || zend_hash_num_elements(&n->ops) == 0) {
+            continue;
+        }
+        pfds[npfd].fd = n->s->sock;
+        pfds[npfd].events = POLLIN;
+        pfds[npfd].revents = 0;
+        npfd++;
+        int64_t quic_deadline = quiche_conn_timeout_as_millis(n->s->conn);
+        if (quic_deadline >= 0 && (timeout < 0 || quic_deadline < timeout)) {
+            timeout = quic_deadline;
+        }
+    }
+    int rc = npfd ? poll(pfds, npfd, timeout < 0 ? -1 : (int)MIN(timeout, INT_MAX)) : 0;
+    int err = errno;
+    efree(pfds);
+    if (rc < 0 && err != EINTR) {
+        throw_network_exception(err, "quicpro-fs: failed to wait for the storage nodes: %s", strerror(err));
+        return false;
+    }
+    return true;
+}
+
+static void qp_os_detach(quicpro_objstore_t *st, void *owner)
+{
+    qp_os_op_t *op;
+    for (unsigned i = 0; i < st->count; i++) {
+        ZEND_HASH_FOREACH_PTR(&st->nodes[i].ops, op) {
+            if (op->owner == owner) {
+                op->owner = NULL;
+            }
+        } ZEND_HASH_FOREACH_END();
+    }
+}
+
+static bool qp_os_parse_nodes(quicpro_objstore_t *st, const char *list, quicpro_cfg_t *cfg)
+{
+    const char *p = list ? list : "";
+    unsigned cap = 0;
+
+    while (*p) {
+        while (*p == ' ' || *p == ',') p++;
+        const char *end = p;
+        while (*end && *end != ',') end++;
+        const char *last = end;
+        while (last > p && last[-1] == ' ') last--;
+        if (last == p) {
+            p = end;
+            continue;
+        }
+
+        const char *colon = last;
+        while (colon > p && *colon != ':') colon--;
+        char *stop;
+        zend_long port = colon > p ? ZEND_STRTOL(colon + 1, &stop, 10) : 0;
+        if (colon == p || stop != last || port <= 0 || port > 65535) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "quicpro-fs: invalid storage node '%.*s' in quicpro.storage_node_static_list, expected host:port", (int)(last - p), p);
+            return false;
+        }
+        const char *host = p;
+        size_t host_len = (size_t)(colon - p);
+        if (host_len >= 2 && host[0] == '[' && host[host_len - 1] == ']') {
+            host++;
+            host_len -= 2;
+        }
+
+        if (st->count == cap) {
+            cap = cap ? cap * 2 : 8;
+            st->nodes = erealloc(st->nodes, cap * sizeof(*st->nodes));
+        }
+        qp_os_node_t *n = &st->nodes[st->count++];
+        memset(n, 0, sizeof(*n));
+        zend_hash_init(&n->ops, 8, NULL, NULL, 0);
+
+        /* As quicpro_mcp_open(): a warm pooled connection if there is one */
+        bool pooled = quicpro_quic_transport_config.client_pool_enable;
+        quicpro_pool_key_t key = { host, host_len, port, "h3", cfg };
+        zend_resource *warm = pooled ? quicpro_client_pool_checkout(&key, 1) : NULL;
+        if (warm) {
+            n->res = warm;
+            n->s = (quicpro_session_t *)warm->ptr;
+        } else {
+            /* Storage nodes carry bulk transfers: BBRv2 and a larger first window (server/congestion.h) */
+            zval opts;
+            array_init(&opts);
+            add_assoc_string(&opts, "cc_profile", "bulk");
+            quicpro_session_t *s = quicpro_client_session_open(host, host_len, port, cfg, -1, Z_ARRVAL(opts));
+            zval_ptr_dtor(&opts);
+            if (s) {
+                s->resource = zend_register_resource(s, le_quicpro_session);
+                if (pooled) {
+                    quicpro_client_pool_add(&key, s);
+                }
+                n->res = s->resource;
+                n->s = s;
+            } else {
+                /* Down: its shards count as lost writes, and reads go around it */
+                php_error_docref(NULL, E_WARNING, "quicpro-fs: storage node %.*s is down", (int)(last - p), p);
+                zend_clear_exception();
+            }
+        }
+        if (n->s) {
+            st->up++;
+        }
+        p = end;
+    }
+    return true;
+}
+
+/*──────────────────────────────── Store ──────────────────────────────────*/
+
+quicpro_objstore_t *quicpro_objstore_open(quicpro_cfg_t *cfg)
+{
+    qp_native_object_store_config_t *c = &quicpro_native_object_store_config;
+    quicpro_objstore_t *st = ecalloc(1, sizeof(*st));
+
+    if (c->default_redundancy_mode && strcmp(c->default_redundancy_mode, "replication") == 0) {
+        st->k = 1;
+        st->m = c->default_replication_factor > 1 ? (unsigned)MIN(c->default_replication_factor - 1, QUICPRO_EC_MAX_SHARDS - 1) : 0;
+        st->copies = true;
+    } else if (!c->erasure_coding_shards || sscanf(c->erasure_coding_shards, "%ud%up", &st->k, &st->m) != 2
+               || st->k == 0 || st->k + st->m > QUICPRO_EC_MAX_SHARDS) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "quicpro-fs: quicpro.storage_erasure_coding_shards must be 'XdYp' with at most %d shards in all", QUICPRO_EC_MAX_SHARDS);
+        efree(st);
+        return NULL;
+    }
+    if (quicpro_at_rest_wanted()) {
+        st->seal = quicpro_at_rest_alg();
+        if (!quicpro_at_rest_key_id(st->key_id)
+            || (c->versioning_enable && !quicpro_at_rest_derive(&st->chunk_key, st->seal, "quicpro-fs chunk", NULL, 0))) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "quicpro-fs: quicpro.storage_encryption_at_rest_enable needs a usable quicpro.storage_encryption_key_path");
+            efree(st);
+            return NULL;
+        }
+    }
+    if (!st->copies) {
+        quicpro_ec_init(&st->ec, st->k, st->m);
+    }
+
+    size_t target = (size_t)MAX(c->default_chunk_size_mb, 1) * 1024 * 1024;
+    size_t align = (size_t)st->k * QP_OS_SHARD_ALIGN;
+    st->chunk_size = (target + align - 1) / align * align;
+    st->dedup = c->versioning_enable;
+    quicpro_cdc_init(&st->cdc, (size_t)MAX(c->dedup_average_chunk_kb, 1) * 1024);
+    qp_os_layout(st->layout, sizeof(st->layout), st->k, st->m, st->copies);
+    qp_os_layout_seal(st->layout, sizeof(st->layout), st->seal, st->key_id);
+
+    if (!qp_os_parse_nodes(st, c->node_static_list, cfg)) {
+        quicpro_objstore_close(st);
+        return NULL;
+    }
+    if (st->count < st->k + st->m) {
+        php_error_docref(NULL, E_WARNING,
+            "quicpro-fs: %u storage nodes for %u shards per chunk; a node holding several of them takes them all down with it",
+            st->count, st->k + st->m);
+    }
+    if (st->up < st->k) {
+        throw_network_exception(0, "quicpro-fs: only %u of %u storage nodes are up, %u are needed", st->up, st->count, st->k);
+        quicpro_objstore_close(st);
+        return NULL;
+    }
+    return st;
+}
+
+void quicpro_objstore_close(quicpro_objstore_t *st)
+{
+    zend_long deadline = qp_os_now_ms() + QP_OS_DRAIN_MS;
+    for (;;) {
+        bool busy = false;
+        for (unsigned i = 0; i < st->count; i++) {
+            busy |= st->nodes[i].s && zend_hash_num_elements(&st->nodes[i].ops) > 0;
+        }
+        zend_long left = deadline - qp_os_now_ms();
+        if (!busy || left <= 0 || !qp_os_pump(st, left)) {
+            break;
+        }
+    }
+
+    for (unsigned i = 0; i < st->count; i++) {
+        qp_os_node_t *n = &st->nodes[i];
+        if (n->s && zend_hash_num_elements(&n->ops) > 0 && n->s->conn) {
+            /* Answers still due would reach the connection's next user */
+            quiche_conn_close(n->s->conn, true, QP_OS_H3_NO_ERROR, (const uint8_t *)"", 0);
+            quicpro_h3_mux_step(n->s);
+        }
+        qp_os_op_t *op;
+        ZEND_HASH_FOREACH_PTR(&n->ops, op) {
+            efree(op);
+        } ZEND_HASH_FOREACH_END();
+        zend_hash_destroy(&n->ops);
+        if (n->res) {
+            zend_list_delete(n->res);
+        }
+    }
+    if (st->nodes) {
+        efree(st->nodes);
+    }
+    quicpro_ec_free(&st->ec);
+    quicpro_at_rest_key_clear(&st->chunk_key);
+    efree(st);
+}
+
+/*─────────────────────────────── Writing ─────────────────────────────────*/
+
+quicpro_objstore_writer_t *quicpro_objstore_write_begin(quicpro_objstore_t *st, const char *name, size_t name_len, unsigned window)
+{
+    quicpro_objstore_writer_t *w = ecalloc(1, sizeof(*w));
+    if (RAND_bytes((unsigned char *)&w->version, sizeof(w->version)) != 1) {
+        efree(w);
+        throw_network_exception(0, "quicpro-fs: no randomness for the object version");
+        return NULL;
+    }
+    w->st = st;
+    w->name = php_raw_url_encode(name, name_len);
+    if (st->seal != QUICPRO_AT_REST_NONE && !st->dedup && !qp_os_object_key(&w->key, st->seal, w->name, w->version)) {
+        throw_network_exception(0, "quicpro-fs: no key to encrypt '%s' with", ZSTR_VAL(w->name));
+        zend_string_release(w->name);
+        efree(w);
+        return NULL;
+    }
+    w->cap = st->dedup ? st->cdc.max : st->chunk_size;
+    w->buf = emalloc(w->cap);
+    w->nslots = MAX(window, 1);
+    zend_hash_init(&w->seen, 64, NULL, NULL, 0);
+    w->slots = ecalloc(w->nslots, sizeof(*w->slots));
+    return w;
+}
+
+static bool qp_os_wait_slot(quicpro_objstore_writer_t *w, qp_os_wslot_t *t)
+{
+    while (t->outstanding) {
+        if (!qp_os_pump(w->st, -1)) {
+            return false;
+        }
+    }
+    if (w->lost) {
+        throw_network_exception(0, "quicpro-fs: chunk %" PRIu64 " of '%s' lost more than %u shard writes",
+                                w->lost_index, ZSTR_VAL(w->name), w->st->m);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Encodes a chunk and sends its shards: by position in this version, or,
+ * for a deduplicated chunk `c`, by content and only those `c` lacks.
+ */
+static bool qp_os_send_chunk(quicpro_objstore_writer_t *w, const uint8_t *chunk, size_t len, uint64_t index,
+                             const qp_os_pending_t *c)
+{
+    quicpro_objstore_t *st = w->st;
+    unsigned k = st->k, total = st->k + st->m, slot = (unsigned)(w->sent++ % w->nslots);
+    qp_os_wslot_t *t = &w->slots[slot];
+
+    if (!qp_os_wait_slot(w, t)) {
+        return false;
+    }
+
+    uint8_t *sealed = NULL;
+    if (st->seal != QUICPRO_AT_REST_NONE) {
+        uint8_t nonce[QUICPRO_AT_REST_NONCE_LEN];
+        if (c) {
+            memcpy(nonce, c->hash, sizeof(nonce));
+        } else {
+            quicpro_at_rest_nonce(nonce, index);
+        }
+        sealed = emalloc(len + QUICPRO_AT_REST_TAG_LEN);
+        if (!quicpro_at_rest_seal(c ? &st->chunk_key : &w->key, nonce, NULL, 0, chunk, len, sealed)) {
+            efree(sealed);
+            throw_network_exception(0, "quicpro-fs: chunk %" PRIu64 " of '%s' could not be encrypted", index, ZSTR_VAL(w->name));
+            return false;
+        }
+        chunk = sealed;
+        len += QUICPRO_AT_REST_TAG_LEN;
+    }
+
+    size_t slen = qp_os_shard_len(k, len);
+    zend_string *sh[QUICPRO_EC_MAX_SHARDS];
+    uint8_t *data[QUICPRO_EC_MAX_SHARDS], *parity[QUICPRO_EC_MAX_SHARDS];
+    for (unsigned i = 0; i < k; i++) {
+        size_t off = i * slen, n = off < len ? MIN(slen, len - off) : 0;
+        sh[i] = zend_string_alloc(slen, 0);
+        data[i] = (uint8_t *)ZSTR_VAL(sh[i]);
+        memcpy(data[i], chunk + off, n);
+        memset(data[i] + n, 0, slen - n);
+        data[i][slen] = '\0';
+    }
+    for (unsigned i = k; i < total; i++) {
+        if (st->copies) {
+            sh[i] = zend_string_copy(sh[0]);
+        } else {
+            sh[i] = zend_string_alloc(slen, 0);
+            ZSTR_VAL(sh[i])[slen] = '\0';
+            parity[i - k] = (uint8_t *)ZSTR_VAL(sh[i]);
+        }
+    }
+    if (!st->copies) {
+        quicpro_ec_encode(&st->ec, slen, data, parity);
+    }
+    if (sealed) {
+        efree(sealed);
+    }
+
+    uint64_t base = c ? qp_os_hash_base(c->hash) : index;
+    t->index = index;
+    t->outstanding = 0;
+    t->failed = 0;
+    for (unsigned i = 0; i < total; i++) {
+        if (c && (c->present & (1u << i))) {
+            zend_string_release(sh[i]);
+            continue;
+        }
+        smart_str path = {0};
+        qp_os_op_t op = { QP_OS_PUT_SHARD, w, slot, 0, i };
+        if (c) {
+            qp_os_chunk_path(&path, c->hex, st->layout, i);
+        } else {
+            qp_os_shard_path(&path, w->name, w->version, index, i);
+        }
+        if (qp_os_send(st, (unsigned)((base + i) % st->count), "PUT", &path, sh[i], &op)) {
+            t->outstanding++;
+        } else {
+            t->failed++;
+        }
+        smart_str_free(&path);
+        zend_string_release(sh[i]);
+    }
+    if (t->failed > st->m && !w->lost) {
+        w->lost = true;
+        w->lost_index = t->index;
+    }
+    return !w->lost || qp_os_wait_slot(w, t);
+}
+
+/* Sends the buffered chunk of a positional write */
+static bool qp_os_seal(quicpro_objstore_writer_t *w)
+{
+    if (!qp_os_send_chunk(w, w->buf, w->fill, w->next_index, NULL)) {
+        return false;
+    }
+    w->next_index++;
+    w->fill = 0;
+    return true;
+}
+
+/* Asks the nodes which shards of the batch they hold, then sends the rest */
+static bool qp_os_flush_batch(quicpro_objstore_writer_t *w)
+{
+    quicpro_objstore_t *st = w->st;
+    unsigned total = st->k + st->m;
+    uint32_t all = total >= 32 ? UINT32_MAX : (1u << total) - 1;
+    smart_str *bodies = ecalloc(st->count, sizeof(*bodies));
+    smart_str path = {0};
+    bool ok = true;
+
+    /* One query per node, listing the shards placed on it */
+    for (unsigned b = 0; b < w->nbatch; b++) {
+        uint64_t base = qp_os_hash_base(w->batch[b].hash);
+        for (unsigned i = 0; i < total; i++) {
+            smart_str *body = &bodies[(base + i) % st->count];
+            qp_os_chunk_key(body, w->batch[b].hex, st->layout, i);
+            smart_str_appendc(body, '\n');
+        }
+    }
+    smart_str_appendl(&path, "/chunks/has", sizeof("/chunks/has") - 1);
+    smart_str_0(&path);
+    for (unsigned n = 0; n < st->count; n++) {
+        if (!bodies[n].s) {
+            continue;
+        }
+        smart_str_0(&bodies[n]);
+        qp_os_op_t op = { QP_OS_HAS_CHUNKS, w, QP_OS_NO_SLOT, 0, 0 };
+        if (qp_os_send(st, n, "POST", &path, bodies[n].s, &op)) {
+            w->has_pending++;
+        }
+        smart_str_free(&bodies[n]);
+    }
+    smart_str_free(&path);
+    efree(bodies);
+
+    while (ok && w->has_pending) {
+        ok = qp_os_pump(st, -1);
+    }
+    for (unsigned b = 0; b < w->nbatch; b++) {
+        qp_os_pending_t *c = &w->batch[b];
+        if (ok && (c->present & all) != all) {
+            ok = qp_os_send_chunk(w, (const uint8_t *)ZSTR_VAL(c->data), ZSTR_LEN(c->data), c->index, c);
+        }
+        zend_string_release(c->data);
+        c->data = NULL;
+    }
+    w->nbatch = 0;
+    return ok;
+}
+
+/* Names a content-defined chunk in the manifest and, if this object has not had it yet, queues it */
+static bool qp_os_emit(quicpro_objstore_writer_t *w, const uint8_t *chunk, size_t len)
+{
+    qp_os_pending_t *c = &w->batch[w->nbatch];
+    quicpro_blake3(chunk, len, c->hash);
+    qp_os_hex(c->hash, c->hex);
+    smart_str_appendl(&w->chunks, c->hex, QP_OS_HEX_LEN);
+    smart_str_appendc(&w->chunks, ' ');
+    smart_str_append_unsigned(&w->chunks, len);
+    smart_str_appendc(&w->chunks, '\n');
+    c->index = w->next_index++;
+
+    if (!zend_hash_str_add_empty_element(&w->seen, c->hex, QP_OS_HEX_LEN)) {
+        return true;
+    }
+    c->data = zend_string_init((const char *)chunk, len, 0);
+    c->present = 0;
+    return ++w->nbatch < QP_OS_HAS_BATCH || qp_os_flush_batch(w);
+}
+
+/* Emits the chunks whose end is certain, or with `last` all that is buffered */
+static bool qp_os_cut(quicpro_objstore_writer_t *w, bool last)
+{
+    size_t off = 0;
+    bool ok = true;
+    while (ok && off < w->fill && (last || w->fill - off >= w->cap)) {
+        size_t n = quicpro_cdc_cut(&w->st->cdc, w->buf + off, w->fill - off);
+        ok = qp_os_emit(w, w->buf + off, n);
+        off += n;
+    }
+    memmove(w->buf, w->buf + off, w->fill - off);
+    w->fill -= off;
+    return ok && (!last || w->nbatch == 0 || qp_os_flush_batch(w));
+}
+
+bool quicpro_objstore_write(quicpro_objstore_writer_t *w, const char *data, size_t len)
+{
+    while (len) {
+        size_t n = MIN(len, w->cap - w->fill);
+        memcpy(w->buf + w->fill, data, n);
+        w->fill += n;
+        w->size += n;
+        data += n;
+        len -= n;
+        if (w->fill == w->cap && !(w->st->dedup ? qp_os_cut(w, false) : qp_os_seal(w))) {
+            return false;
+        }
+        /* Answers are taken as they come, so the window keeps moving */
+        if (!qp_os_pump(w->st, 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void qp_os_writer_free(quicpro_objstore_writer_t *w)
+{
+    qp_os_detach(w->st, w);
+    zend_string_release(w->name);
+    for (unsigned b = 0; b < w->nbatch; b++) {
+        zend_string_release(w->batch[b].data);
+    }
+    smart_str_free(&w->chunks);
+    zend_hash_destroy(&w->seen);
+    quicpro_at_rest_key_clear(&w->key);
+    efree(w->buf);
+    efree(w->slots);
+    efree(w);
+}
+
+bool quicpro_objstore_write_end(quicpro_objstore_writer_t *w)
+{
+    quicpro_objstore_t *st = w->st;
+    bool ok = st->dedup ? qp_os_cut(w, true) : w->fill == 0 || qp_os_seal(w);
+    for (unsigned i = 0; ok && i < w->nslots; i++) {
+        ok = qp_os_wait_slot(w, &w->slots[i]);
+    }
+
+    if (ok) {
+        char line[QUICPRO_OBJSTORE_MANIFEST_MAX];
+        bool sealed = st->seal != QUICPRO_AT_REST_NONE;
+        int n = snprintf(line, sizeof(line), "quicpro-fs %d %016" PRIx64 " %" PRIu64 " %zu %u %u %s%s%s%s%s\n",
+                         st->dedup ? 2 : 1, w->version, w->size, st->dedup ? st->cdc.avg : st->chunk_size,
+                         st->k, st->m, st->copies ? "copies" : "rs",
+                         sealed ? " " : "", sealed ? quicpro_at_rest_alg_name(st->seal) : "",
+                         sealed ? " " : "", sealed ? st->key_id : "");
+        size_t chunks_len = w->chunks.s ? ZSTR_LEN(w->chunks.s) : 0;
+        zend_string *manifest = zend_string_alloc((size_t)n + chunks_len, 0);
+        memcpy(ZSTR_VAL(manifest), line, (size_t)n);
+        if (chunks_len) {
+            memcpy(ZSTR_VAL(manifest) + n, ZSTR_VAL(w->chunks.s), chunks_len);
+        }
+        ZSTR_VAL(manifest)[ZSTR_LEN(manifest)] = '\0';
+        smart_str path = {0};
+        qp_os_manifest_path(&path, w->name);
+
+        unsigned home = qp_os_home(st, w->name);
+        for (unsigned j = 0; j <= st->m && j < st->count; j++) {
+            qp_os_op_t op = { QP_OS_PUT_MANIFEST, w, QP_OS_NO_SLOT, 0, j };
+            if (qp_os_send(st, (home + j) % st->count, "PUT", &path, manifest, &op)) {
+                w->manifest_pending++;
+            }
+        }
+        smart_str_free(&path);
+
+        while (ok && w->manifest_pending) {
+            ok = qp_os_pump(st, -1);
+        }
+        if (ok && w->manifest_ok == 0) {
+            throw_network_exception(0, "quicpro-fs: no storage node took the manifest of '%s'", ZSTR_VAL(w->name));
+            ok = false;
+        }
+        if (ok) {
+            /* Every worker of this host sees the new version at once */
+            quicpro_objstore_md_put(ZSTR_VAL(w->name), ZSTR_LEN(w->name), ZSTR_VAL(manifest), ZSTR_LEN(manifest), -1);
+        }
+        zend_string_release(manifest);
+    }
+    qp_os_writer_free(w);
+    return ok;
+}
+
+void quicpro_objstore_write_abort(quicpro_objstore_writer_t *w)
+{
+    qp_os_writer_free(w);
+}
+
+/*─────────────────────────────── Reading ─────────────────────────────────*/
+
+static uint64_t qp_os_chunk_off(const quicpro_objstore_reader_t *r, uint64_t index)
+{
+    return r->offsets ? r->offsets[index] : index * r->chunk_size;
+}
+
+static size_t qp_os_chunk_len(const quicpro_objstore_reader_t *r, uint64_t index)
+{
+    if (r->offsets) {
+        return (size_t)(r->offsets[index + 1] - r->offsets[index]);
+    }
+    uint64_t off = index * r->chunk_size;
+    return (size_t)MIN((uint64_t)r->chunk_size, r->size - off);
+}
+
+/* What the nodes hold of chunk `index`: sealed, its tag more */
+static size_t qp_os_stored_len(const quicpro_objstore_reader_t *r, uint64_t index)
+{
+    return qp_os_chunk_len(r, index) + (r->seal != QUICPRO_AT_REST_NONE ? QUICPRO_AT_REST_TAG_LEN : 0);
+}
+
+static void qp_os_rslot_clear(qp_os_rslot_t *s)
+{
+    for (unsigned i = 0; i < QUICPRO_EC_MAX_SHARDS; i++) {
+        if (s->shards[i]) {
+            zend_string_release(s->shards[i]);
+            s->shards[i] = NULL;
+        }
+    }
+    if (s->data) {
+        zend_string_release(s->data);
+        s->data = NULL;
+    }
+}
+
+static void qp_os_ask(quicpro_objstore_reader_t *r, unsigned slot, unsigned shard)
+{
+    qp_os_rslot_t *s = &r->slots[slot];
+    smart_str path = {0};
+    qp_os_op_t op = { QP_OS_GET_SHARD, r, slot, s->gen, shard };
+    uint64_t base = s->index;
+
+    if (r->hashes) {
+        const uint8_t *hash = r->hashes + s->index * QUICPRO_BLAKE3_LEN;
+        char hex[QP_OS_HEX_LEN + 1];
+        qp_os_hex(hash, hex);
+        qp_os_chunk_path(&path, hex, r->layout, shard);
+        base = qp_os_hash_base(hash);
+    } else {
+        qp_os_shard_path(&path, r->name, r->version, s->index, shard);
+    }
+    if (qp_os_send(r->st, (unsigned)((base + shard) % r->st->count), "GET", &path, NULL, &op)) {
+        s->outstanding++;
+    }
+    smart_str_free(&path);
+}
+
+/* Asks for parity shards while fewer than k are present or on their way */
+static void qp_os_ask_more(quicpro_objstore_reader_t *r, unsigned slot)
+{
+    qp_os_rslot_t *s = &r->slots[slot];
+    while (s->have + s->outstanding < r->k && s->next_parity < r->k + r->m) {
+        qp_os_ask(r, slot, s->next_parity++);
+    }
+    if (s->have + s->outstanding < r->k) {
+        s->failed = true;
+    }
+}
+
+/* Joins (and, with data shards missing, first rebuilds) the chunk */
+static void qp_os_assemble(quicpro_objstore_reader_t *r, qp_os_rslot_t *s)
+{
+    size_t len = qp_os_stored_len(r, s->index), slen = qp_os_shard_len(r->k, len);
+    uint8_t *bufs[QUICPRO_EC_MAX_SHARDS] = {0};
+    bool present[QUICPRO_EC_MAX_SHARDS] = {0}, rebuilt[QUICPRO_EC_MAX_SHARDS] = {0};
+
+    for (unsigned i = 0; i < r->k + r->m; i++) {
+        if (s->shards[i]) {
+            present[i] = true;
+            bufs[i] = (uint8_t *)ZSTR_VAL(s->shards[i]);
+        }
+    }
+    if (r->copies) {
+        for (unsigned i = 1; !present[0] && i < r->k + r->m; i++) {
+            if (present[i]) {
+                bufs[0] = bufs[i];
+                present[0] = true;
+            }
+        }
+    } else {
+        bool degraded = false;
+        for (unsigned i = 0; i < r->k; i++) {
+            if (!present[i]) {
+                bufs[i] = emalloc(slen);
+                rebuilt[i] = degraded = true;
+            }
+        }
+        if (degraded && !quicpro_ec_recover(&r->ec, slen, bufs, present)) {
+            s->failed = true;
+        }
+    }
+
+    if (!s->failed) {
+        s->data = zend_string_alloc(len, 0);
+        for (unsigned i = 0; i < r->k && i * slen < len; i++) {
+            memcpy(ZSTR_VAL(s->data) + i * slen, bufs[i], MIN(slen, len - i * slen));
+        }
+        ZSTR_VAL(s->data)[len] = '\0';
+        s->ready = true;
+    }
+    if (s->ready && r->seal != QUICPRO_AT_REST_NONE) {
+        /* Decrypted in place, a tag shorter */
+        uint8_t nonce[QUICPRO_AT_REST_NONCE_LEN];
+        if (r->hashes) {
+            memcpy(nonce, r->hashes + s->index * QUICPRO_BLAKE3_LEN, sizeof(nonce));
+        } else {
+            quicpro_at_rest_nonce(nonce, s->index);
+        }
+        size_t plain = len - QUICPRO_AT_REST_TAG_LEN;
+        uint8_t *p = (uint8_t *)ZSTR_VAL(s->data);
+        if (quicpro_at_rest_open(&r->key, nonce, NULL, 0, p, plain, p)) {
+            ZSTR_LEN(s->data) = plain;
+            ZSTR_VAL(s->data)[plain] = '\0';
+        } else {
+            zend_string_release(s->data);
+            s->data = NULL;
+            s->ready = false;
+            s->failed = s->forged = true;
+        }
+    }
+    for (unsigned i = 0; i < r->k; i++) {
+        if (rebuilt[i]) {
+            efree(bufs[i]);
+        }
+    }
+    for (unsigned i = 0; i < QUICPRO_EC_MAX_SHARDS; i++) {
+        if (s->shards[i]) {
+            zend_string_release(s->shards[i]);
+            s->shards[i] = NULL;
+        }
+    }
+}
+
+static void qp_os_got_shard(quicpro_objstore_reader_t *r, unsigned slot, unsigned shard, bool ok, zend_string *body)
+{
+    qp_os_rslot_t *s = &r->slots[slot];
+    s->outstanding--;
+    if (s->ready || s->failed) {
+        return;
+    }
+    if (ok && body && ZSTR_LEN(body) == qp_os_shard_len(r->k, qp_os_stored_len(r, s->index)) && !s->shards[shard]) {
+        s->shards[shard] = zend_string_copy(body);
+        if (++s->have == r->k) {
+            qp_os_assemble(r, s);
+        }
+        return;
+    }
+    qp_os_ask_more(r, slot);
+}
+
+/* Marks the shards a has-chunk answer lists, one "<hex>/<layout>/<shard>" per line */
+static void qp_os_mark_present(quicpro_objstore_writer_t *w, const zend_string *body)
+{
+    const char *p = ZSTR_VAL(body), *end = p + ZSTR_LEN(body);
+    const char *layout = w->st->layout;
+    size_t layout_len = strlen(layout), prefix = QP_OS_HEX_LEN + layout_len + 2;
+    unsigned total = w->st->k + w->st->m;
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) {
+            eol = end;
+        }
+        if ((size_t)(eol - p) > prefix && p[QP_OS_HEX_LEN] == '/' && p[prefix - 1] == '/'
+            && memcmp(p + QP_OS_HEX_LEN + 1, layout, layout_len) == 0) {
+            unsigned shard = 0;
+            const char *q = p + prefix;
+            while (q < eol && *q >= '0' && *q <= '9' && shard < total) {
+                shard = shard * 10 + (unsigned)(*q++ - '0');
+            }
+            for (unsigned b = 0; q == eol && shard < total && b < w->nbatch; b++) {
+                if (memcmp(w->batch[b].hex, p, QP_OS_HEX_LEN) == 0) {
+                    w->batch[b].present |= 1u << shard;
+                }
+            }
+        }
+        p = eol + 1;
+    }
+}
+
+static void qp_os_complete(quicpro_objstore_t *st, qp_os_op_t *op, bool ok, zend_string *body, HashTable *headers)
+{
+    (void)st;
+    if (!op->owner) {
+        return;
+    }
+    switch (op->kind) {
+        case QP_OS_PUT_SHARD: {
+            quicpro_objstore_writer_t *w = op->owner;
+            qp_os_wslot_t *t = &w->slots[op->slot];
+            t->outstanding--;
+            if (!ok && ++t->failed > w->st->m && !w->lost) {
+                w->lost = true;
+                w->lost_index = t->index;
+            }
+            break;
+        }
+        case QP_OS_PUT_MANIFEST: {
+            quicpro_objstore_writer_t *w = op->owner;
+            w->manifest_pending--;
+            w->manifest_ok += ok;
+            break;
+        }
+        case QP_OS_HAS_CHUNKS: {
+            /* A failed query only costs sending what the node may have had */
+            quicpro_objstore_writer_t *w = op->owner;
+            w->has_pending--;
+            if (ok && body) {
+                qp_os_mark_present(w, body);
+            }
+            break;
+        }
+        case QP_OS_GET_SHARD: {
+            quicpro_objstore_reader_t *r = op->owner;
+            if (r->slots[op->slot].gen == op->gen) {
+                qp_os_got_shard(r, op->slot, op->shard, ok, body);
+            }
+            break;
+        }
+        case QP_OS_GET_MANIFEST: {
+            quicpro_objstore_reader_t *r = op->owner;
+            r->manifest_pending = false;
+            if (ok && body) {
+                r->manifest = zend_string_copy(body);
+                zval *lease = headers ? zend_hash_str_find(headers, "quicpro-lease-ms", sizeof("quicpro-lease-ms") - 1) : NULL;
+                if (lease && Z_TYPE_P(lease) == IS_STRING) {
+                    r->lease_ms = ZEND_STRTOL(Z_STRVAL_P(lease), NULL, 10);
+                }
+            }
+            break;
+        }
+    }
+}
+
+/* The chunk lines of a deduplicated manifest, "<hex> <length>" each, adding up to its size */
+static bool qp_os_parse_chunks(quicpro_objstore_reader_t *r)
+{
+    const char *end = ZSTR_VAL(r->manifest) + ZSTR_LEN(r->manifest);
+    const char *p = memchr(ZSTR_VAL(r->manifest), '\n', ZSTR_LEN(r->manifest));
+    uint64_t n = 0, cap = 0, off = 0;
+
+    for (p = p ? p + 1 : end; p < end; n++) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        const char *len_at = p + QP_OS_HEX_LEN + 1;
+        char *stop;
+        if (!eol) {
+            eol = end;
+        }
+        if (eol - p <= QP_OS_HEX_LEN + 1 || p[QP_OS_HEX_LEN] != ' ' || *len_at < '1' || *len_at > '9') {
+            goto bad;
+        }
+        uint64_t len = (uint64_t)strtoull(len_at, &stop, 10);
+        if (stop != eol || off + len < off) {
+            goto bad;
+        }
+        if (n == cap) {
+            cap = cap ? cap * 2 : 64;
+            r->offsets = safe_erealloc(r->offsets, cap + 1, sizeof(*r->offsets), 0);
+            r->hashes = safe_erealloc(r->hashes, cap, QUICPRO_BLAKE3_LEN, 0);
+        }
+        if (!qp_os_unhex(p, r->hashes + n * QUICPRO_BLAKE3_LEN)) {
+            goto bad;
+        }
+        r->offsets[n] = off;
+        off += len;
+        p = eol + 1;
+    }
+    if (off != r->size) {
+        goto bad;
+    }
+    if (!r->offsets) {
+        r->offsets = emalloc(sizeof(*r->offsets));
+    }
+    r->offsets[n] = off;
+    r->nchunks = n;
+    return true;
+
+bad:
+    if (r->offsets) {
+        efree(r->offsets);
+        r->offsets = NULL;
+    }
+    if (r->hashes) {
+        efree(r->hashes);
+        r->hashes = NULL;
+    }
+    return false;
+}
+
+static bool qp_os_parse_manifest(quicpro_objstore_reader_t *r)
+{
+    char mode[8];
+    unsigned version;
+    int end = 0;
+    if (sscanf(ZSTR_VAL(r->manifest), "quicpro-fs %u %" SCNx64 " %" SCNu64 " %zu %u %u %7s%n",
+               &version, &r->version, &r->size, &r->chunk_size, &r->k, &r->m, mode, &end) != 7
+        || (version != 1 && version != 2) || r->k == 0 || r->k + r->m > QUICPRO_EC_MAX_SHARDS || r->chunk_size == 0) {
+        return false;
+    }
+
+    /* The rest of the first line: the seal, if any */
+    const char *rest = ZSTR_VAL(r->manifest) + end;
+    const char *eol = memchr(rest, '\n', ZSTR_LEN(r->manifest) - (size_t)end);
+    size_t rest_len = eol ? (size_t)(eol - rest) : ZSTR_LEN(r->manifest) - (size_t)end;
+    r->seal = QUICPRO_AT_REST_NONE;
+    if (rest_len > 0) {
+        char tail[64], alg[24], id[16];
+        if (rest_len >= sizeof(tail)) {
+            return false;
+        }
+        memcpy(tail, rest, rest_len);
+        tail[rest_len] = '\0';
+        if (sscanf(tail, " %23s %15s", alg, id) != 2 || strlen(id) != QUICPRO_AT_REST_KEY_ID_LEN
+            || (r->seal = quicpro_at_rest_alg_parse(alg)) == QUICPRO_AT_REST_NONE) {
+            return false;
+        }
+        memcpy(r->key_id, id, sizeof(r->key_id));
+    }
+    r->copies = strcmp(mode, "copies") == 0;
+    if (!r->copies && strcmp(mode, "rs") != 0) {
+        return false;
+    }
+    if (version == 1) {
+        if (r->chunk_size % ((size_t)r->k * QP_OS_SHARD_ALIGN) != 0) {
+            return false;
+        }
+        r->nchunks = (r->size + r->chunk_size - 1) / r->chunk_size;
+    } else if (!qp_os_parse_chunks(r)) {
+        return false;
+    }
+    qp_os_layout(r->layout, sizeof(r->layout), r->k, r->m, r->copies);
+    qp_os_layout_seal(r->layout, sizeof(r->layout), r->seal, r->key_id);
+    return r->copies || quicpro_ec_init(&r->ec, r->k, r->m);
+}
+
+/* The key of a sealed object's chunks; throws if it is not ours to have */
+static bool qp_os_reader_key(quicpro_objstore_reader_t *r)
+{
+    if (r->seal == QUICPRO_AT_REST_NONE) {
+        return true;
+    }
+    char id[QUICPRO_AT_REST_KEY_ID_LEN + 1];
+    if (!quicpro_at_rest_key_id(id)) {
+        throw_network_exception(0, "quicpro-fs: '%s' is encrypted, and quicpro.storage_encryption_key_path names no usable key",
+                                ZSTR_VAL(r->display));
+        return false;
+    }
+    if (strcmp(id, r->key_id) != 0) {
+        throw_network_exception(0, "quicpro-fs: '%s' is encrypted under key %s, not under the configured %s",
+                                ZSTR_VAL(r->display), r->key_id, id);
+        return false;
+    }
+    bool ok = r->hashes ? quicpro_at_rest_derive(&r->key, r->seal, "quicpro-fs chunk", NULL, 0)
+                        : qp_os_object_key(&r->key, r->seal, r->name, r->version);
+    if (!ok) {
+        throw_network_exception(0, "quicpro-fs: no key to decrypt '%s' with", ZSTR_VAL(r->display));
+    }
+    return ok;
+}
+
+quicpro_objstore_reader_t *quicpro_objstore_read_begin(quicpro_objstore_t *st, const char *name, size_t name_len, unsigned window)
+{
+    quicpro_objstore_reader_t *r = ecalloc(1, sizeof(*r));
+    r->st = st;
+    r->name = php_raw_url_encode(name, name_len);
+    r->display = zend_string_init(name, name_len, 0);
+    r->nslots = MAX(window, 1) + 1;
+    r->slots = ecalloc(r->nslots, sizeof(*r->slots));
+    r->lease_ms = -1;
+
+    char cached[QUICPRO_OBJSTORE_MANIFEST_MAX + 1];
+    size_t cached_len = quicpro_objstore_md_get(ZSTR_VAL(r->name), ZSTR_LEN(r->name), cached);
+    if (cached_len) {
+        cached[cached_len] = '\0';
+        r->manifest = zend_string_init(cached, cached_len, 0);
+        if (qp_os_parse_manifest(r)) {
+            r->cached = true;
+            if (!qp_os_reader_key(r)) {
+                quicpro_objstore_read_end(r);
+                return NULL;
+            }
+            return r;
+        }
+        zend_string_release(r->manifest);
+        r->manifest = NULL;
+        quicpro_objstore_md_forget(ZSTR_VAL(r->name), ZSTR_LEN(r->name));
+    }
+
+    /* The first of the manifest's nodes that answers has it */
+    smart_str path = {0};
+    qp_os_manifest_path(&path, r->name);
+    unsigned home = qp_os_home(st, r->name);
+    for (unsigned j = 0; !r->manifest && j <= st->m && j < st->count; j++) {
+        qp_os_op_t op = { QP_OS_GET_MANIFEST, r, QP_OS_NO_SLOT, 0, j };
+        if (!qp_os_send(st, (home + j) % st->count, "GET", &path, NULL, &op)) {
+            continue;
+        }
+        r->manifest_pending = true;
+        while (r->manifest_pending) {
+            if (!qp_os_pump(st, -1)) {
+                smart_str_free(&path);
+                quicpro_objstore_read_end(r);
+                return NULL;
+            }
+        }
+    }
+    smart_str_free(&path);
+
+    if (!r->manifest) {
+        throw_network_exception(0, "quicpro-fs: '%s' not found", ZSTR_VAL(r->display));
+        quicpro_objstore_read_end(r);
+        return NULL;
+    }
+    if (!qp_os_parse_manifest(r)) {
+        throw_network_exception(0, "quicpro-fs: the manifest of '%s' is malformed", ZSTR_VAL(r->display));
+        quicpro_objstore_read_end(r);
+        return NULL;
+    }
+    quicpro_objstore_md_put(ZSTR_VAL(r->name), ZSTR_LEN(r->name), ZSTR_VAL(r->manifest), ZSTR_LEN(r->manifest), r->lease_ms);
+    if (!qp_os_reader_key(r)) {
+        quicpro_objstore_read_end(r);
+        return NULL;
+    }
+    return r;
+}
+
+uint64_t quicpro_objstore_size(const quicpro_objstore_reader_t *r)
+{
+    return r->size;
+}
+
+uint64_t quicpro_objstore_chunk_at(const quicpro_objstore_reader_t *r, uint64_t pos)
+{
+    if (!r->offsets) {
+        return pos / r->chunk_size;
+    }
+    /* The last chunk starting at or before pos */
+    uint64_t lo = 0, hi = r->nchunks;
+    while (hi - lo > 1) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (r->offsets[mid] <= pos) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+uint64_t quicpro_objstore_chunk_offset(const quicpro_objstore_reader_t *r, uint64_t index)
+{
+    return qp_os_chunk_off(r, index);
+}
+
+void quicpro_objstore_prefetch(quicpro_objstore_reader_t *r, uint64_t index)
+{
+    if (index >= r->nchunks) {
+        return;
+    }
+    unsigned slot = (unsigned)(index % r->nslots);
+    qp_os_rslot_t *s = &r->slots[slot];
+    if (s->asked && s->index == index) {
+        return;
+    }
+
+    qp_os_rslot_clear(s);
+    s->index = index;
+    s->gen++;
+    s->asked = true;
+    s->ready = s->failed = s->forged = false;
+    s->outstanding = s->have = 0;
+    s->next_parity = r->k;
+    for (unsigned i = 0; i < r->k; i++) {
+        qp_os_ask(r, slot, i);
+    }
+    qp_os_ask_more(r, slot);
+}
+
+zend_string *quicpro_objstore_chunk(quicpro_objstore_reader_t *r, uint64_t index)
+{
+    quicpro_objstore_prefetch(r, index);
+    qp_os_rslot_t *s = &r->slots[index % r->nslots];
+    if (!s->asked || s->index != index) {
+        throw_network_exception(0, "quicpro-fs: chunk %" PRIu64 " is past the end of '%s'", index, ZSTR_VAL(r->display));
+        return NULL;
+    }
+    while (!s->ready && !s->failed) {
+        if (!qp_os_pump(r->st, -1)) {
+            return NULL;
+        }
+    }
+    if (s->forged) {
+        s->asked = false;
+        throw_network_exception(0, "quicpro-fs: chunk %" PRIu64 " of '%s' fails its authentication tag: altered, or sealed under another key",
+                                index, ZSTR_VAL(r->display));
+        return NULL;
+    }
+    if (s->failed) {
+        /* Asked again next time: nodes may be back */
+        s->asked = false;
+        if (r->cached) {
+            /* Read from a fresh manifest next time, in case this one is stale */
+            quicpro_objstore_md_forget(ZSTR_VAL(r->name), ZSTR_LEN(r->name));
+        }
+        throw_network_exception(0, "quicpro-fs: chunk %" PRIu64 " of '%s' is lost, fewer than %u of its %u shards could be read",
+                                index, ZSTR_VAL(r->display), r->k, r->k + r->m);
+        return NULL;
+    }
+    return s->data;
+}
+
+void quicpro_objstore_read_end(quicpro_objstore_reader_t *r)
+{
+    qp_os_detach(r->st, r);
+    for (unsigned i = 0; i < r->nslots; i++) {
+        qp_os_rslot_clear(&r->slots[i]);
+    }
+    efree(r->slots);
+    if (r->manifest) {
+        zend_string_release(r->manifest);
+    }
+    if (r->offsets) {
+        efree(r->offsets);
+    }
+    if (r->hashes) {
+        efree(r->hashes);
+    }
+    quicpro_ec_free(&r->ec);
+    quicpro_at_rest_key_clear(&r->key);
+    zend_string_release(r->name);
+    zend_string_release(r->display);
+    efree(r);
+}
@@ -0,0 +1,344 @@
+/*
+ * src/object_store/stream.c – The quicpro-fs:// stream wrapper
+ * =============================================================
+ *
+ * See include/object_store/stream.h. Streams are unbuffered: a chunk is
+ * already in memory once it arrived, so fread() copies from it straight
+ * into the caller's buffer, and fwrite() straight into the chunk being
+ * filled.
+ */
+
+#include "php_quicpro.h"
+#include "object_store/stream.h"
+#include "object_store/object_store.h"
+#include "config/config.h"
+#include "config/native_object_store/base_layer.h"
+
+#include <php_streams.h>
+#include <zend_exceptions.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#define QP_FS_SCHEME "quicpro-fs://"
+
+typedef struct qp_fs_stream_s {
+    quicpro_objstore_writer_t *w;       /* One of the two; neither once discarded */
+    quicpro_objstore_reader_t *r;
+    uint64_t                   pos, size;
+    unsigned                   ahead;
+    struct qp_fs_stream_s     *prev, *next;
+} qp_fs_stream_t;
+
+/* The request's store; its Config is a resource, so it outlives the pooled sessions using it */
+static quicpro_objstore_t *qp_fs_store;
+static quicpro_cfg_t      *qp_fs_cfg;
+static qp_fs_stream_t     *qp_fs_open;
+
+static quicpro_objstore_t *qp_fs_get_store(void)
+{
+    if (!qp_fs_cfg) {
+        zend_resource *cfg_res = quicpro_config_default();
+        if (!cfg_res) {
+            return NULL;
+        }
+        qp_fs_cfg = (quicpro_cfg_t *)cfg_res->ptr;
+    }
+    if (!qp_fs_store) {
+        qp_fs_store = quicpro_objstore_open(qp_fs_cfg);
+    }
+    return qp_fs_store;
+}
+
+static unsigned qp_fs_window(php_stream_context *context, const char *option, zend_long fallback)
+{
+    zval *v = context ? php_stream_context_get_option(context, "quicpro-fs", option) : NULL;
+    zend_long n = v ? zval_get_long(v) : fallback;
+    return (unsigned)MIN(MAX(n, 1), 1024);
+}
+
+static void qp_fs_unlink(qp_fs_stream_t *fs)
+{
+    if (fs->prev) {
+        fs->prev->next = fs->next;
+    } else if (qp_fs_open == fs) {
+        qp_fs_open = fs->next;
+    }
+    if (fs->next) {
+        fs->next->prev = fs->prev;
+    }
+    fs->prev = fs->next = NULL;
+}
+
+/*──────────────────────────── Stream ops ─────────────────────────────────*/
+
+static ssize_t qp_fs_write(php_stream *stream, const char *buf, size_t count)
+{
+    qp_fs_stream_t *fs = stream->abstract;
+    if (!fs->w) {
+        return -1;
+    }
+    if (!quicpro_objstore_write(fs->w, buf, count)) {
+        return -1;
+    }
+    fs->pos += count;
+    return (ssize_t)count;
+}
+
+static ssize_t qp_fs_read(php_stream *stream, char *buf, size_t count)
+{
+    qp_fs_stream_t *fs = stream->abstract;
+    size_t done = 0;
+    if (!fs->r) {
+        return -1;
+    }
+
+    while (done < count && fs->pos < fs->size) {
+        uint64_t index = quicpro_objstore_chunk_at(fs->r, fs->pos);
+        quicpro_objstore_prefetch(fs->r, index);
+        for (unsigned i = 1; i <= fs->ahead; i++) {
+            quicpro_objstore_prefetch(fs->r, index + i);
+        }
+        zend_string *chunk = quicpro_objstore_chunk(fs->r, index);
+        if (!chunk) {
+            return done ? (ssize_t)done : -1;
+        }
+        size_t off = (size_t)(fs->pos - quicpro_objstore_chunk_offset(fs->r, index));
+        size_t n = MIN(count - done, ZSTR_LEN(chunk) - off);
+        memcpy(buf + done, ZSTR_VAL(chunk) + off, n);
+        done += n;
+        fs->pos += n;
+    }
+    if (fs->pos >= fs->size) {
+        stream->eof = 1;
+    }
+    return (ssize_t)done;
+}
+
+static int qp_fs_close(php_stream *stream, int close_handle)
+{
+    qp_fs_stream_t *fs = stream->abstract;
+    int rc = 0;
+    (void)close_handle;
+
+    if (fs->w) {
+        if (EG(exception)) {
+            quicpro_objstore_write_abort(fs->w);
+        } else if (!quicpro_objstore_write_end(fs->w)) {
+            rc = EOF;
+        }
+    }
+    if (fs->r) {
+        quicpro_objstore_read_end(fs->r);
+    }
+    qp_fs_unlink(fs);
+    efree(fs);
+    return rc;
+}
+
+static int qp_fs_flush(php_stream *stream)
+{
+    /* Chunks go out as they fill; the rest at close */
+    (void)stream;
+    return 0;
+}
+
+static int qp_fs_seek(php_stream *stream, zend_off_t offset, int whence, zend_off_t *newoffset)
+{
+    qp_fs_stream_t *fs = stream->abstract;
+    zend_off_t base;
+    if (!fs->r) {
+        return -1;
+    }
+    switch (whence) {
+        case SEEK_SET: base = 0; break;
+        case SEEK_CUR: base = (zend_off_t)fs->pos; break;
+        case SEEK_END: base = (zend_off_t)fs->size; break;
+        default: return -1;
+    }
+    if (base + offset < 0) {
+        return -1;
+    }
+    fs->pos = (uint64_t)(base + offset);
+    stream->eof = fs->pos >= fs->size;
+    *newoffset = (zend_off_t)fs->pos;
+    return 0;
+}
+
+static int qp_fs_stat(php_stream *stream, php_stream_statbuf *ssb)
+{
+    qp_fs_stream_t *fs = stream->abstract;
+    memset(ssb, 0, sizeof(*ssb));
+    ssb->sb.st_mode = S_IFREG | 0644;
+    ssb->sb.st_nlink = 1;
+    ssb->sb.st_size = (zend_off_t)(fs->r ? fs->size : fs->pos);
+    return 0;
+}
+
+static const php_stream_ops qp_fs_ops = {
+    qp_fs_write,
+    qp_fs_read,
+    qp_fs_close,
+    qp_fs_flush,
+    "quicpro-fs",
+    qp_fs_seek,
+    NULL,   /* cast */
+    qp_fs_stat,
+    NULL    /* set_option */
+};
+
+bool quicpro_fs_prefetch(php_stream *stream, uint64_t offset, uint64_t length)
+{
+    if (stream->ops != &qp_fs_ops) {
+        return false;
+    }
+    qp_fs_stream_t *fs = stream->abstract;
+    if (!fs->r || !length || offset >= fs->size) {
+        return true;
+    }
+    /* Only as far as the read-ahead window, which a chunk asked for further out would push the current one out of */
+    uint64_t first = quicpro_objstore_chunk_at(fs->r, offset);
+    uint64_t last = quicpro_objstore_chunk_at(fs->r, MIN(offset + length, fs->size) - 1);
+    if (fs->pos < fs->size) {
+        last = MIN(last, quicpro_objstore_chunk_at(fs->r, fs->pos) + fs->ahead);
+    }
+    for (uint64_t i = first; i <= last; i++) {
+        quicpro_objstore_prefetch(fs->r, i);
+    }
+    return true;
+}
+
+/*──────────────────────────── Wrapper ops ────────────────────────────────*/
+
+static const char *qp_fs_name(php_stream_wrapper *wrapper, const char *url, int options)
+{
+    if (strncasecmp(url, QP_FS_SCHEME, sizeof(QP_FS_SCHEME) - 1) != 0 || !url[sizeof(QP_FS_SCHEME) - 1]) {
+        php_stream_wrapper_log_error(wrapper, options, "quicpro-fs:// URLs name an object: quicpro-fs://<name>");
+        return NULL;
+    }
+    return url + sizeof(QP_FS_SCHEME) - 1;
+}
+
+static php_stream *qp_fs_opener(php_stream_wrapper *wrapper, const char *path, const char *mode, int options,
+                                zend_string **opened_path, php_stream_context *context STREAMS_DC)
+{
+    (void)opened_path;
+    if (!quicpro_native_object_store_config.enable) {
+        php_stream_wrapper_log_error(wrapper, options, "quicpro-fs:// needs quicpro.storage_enable");
+        return NULL;
+    }
+    const char *name = qp_fs_name(wrapper, path, options);
+    if (!name) {
+        return NULL;
+    }
+    if (strchr(mode, '+') || (mode[0] != 'r' && mode[0] != 'w')) {
+        php_stream_wrapper_log_error(wrapper, options, "quicpro-fs:// objects are read (\"r\") or written (\"w\") whole, not in mode \"%s\"", mode);
+        return NULL;
+    }
+
+    quicpro_objstore_t *st = qp_fs_get_store();
+    if (!st) {
+        return NULL;
+    }
+    qp_fs_stream_t *fs = ecalloc(1, sizeof(*fs));
+    if (mode[0] == 'w') {
+        fs->w = quicpro_objstore_write_begin(st, name, strlen(name),
+                    qp_fs_window(context, "write_behind_chunks", quicpro_native_object_store_config.write_behind_chunks));
+    } else {
+        fs->ahead = qp_fs_window(context, "read_ahead_chunks", quicpro_native_object_store_config.read_ahead_chunks);
+        fs->r = quicpro_objstore_read_begin(st, name, strlen(name), fs->ahead);
+        if (fs->r) {
+            fs->size = quicpro_objstore_size(fs->r);
+        }
+    }
+    if (!fs->w && !fs->r) {
+        efree(fs);
+        return NULL;
+    }
+
+    php_stream *stream = php_stream_alloc_rel(&qp_fs_ops, fs, NULL, mode);
+    stream->flags |= PHP_STREAM_FLAG_NO_BUFFER;
+    fs->next = qp_fs_open;
+    if (qp_fs_open) {
+        qp_fs_open->prev = fs;
+    }
+    qp_fs_open = fs;
+    return stream;
+}
+
+static int qp_fs_url_stat(php_stream_wrapper *wrapper, const char *url, int flags, php_stream_statbuf *ssb, php_stream_context *context)
+{
+    (void)context;
+    if (!quicpro_native_object_store_config.enable) {
+        return -1;
+    }
+    const char *name = qp_fs_name(wrapper, url, (flags & PHP_STREAM_URL_STAT_QUIET) ? 0 : REPORT_ERRORS);
+    quicpro_objstore_t *st = name ? qp_fs_get_store() : NULL;
+    quicpro_objstore_reader_t *r = st ? quicpro_objstore_read_begin(st, name, strlen(name), 1) : NULL;
+    if (!r) {
+        /* file_exists() and friends answer false rather than throw */
+        zend_clear_exception();
+        return -1;
+    }
+    memset(ssb, 0, sizeof(*ssb));
+    ssb->sb.st_mode = S_IFREG | 0644;
+    ssb->sb.st_nlink = 1;
+    ssb->sb.st_size = (zend_off_t)quicpro_objstore_size(r);
+    quicpro_objstore_read_end(r);
+    return 0;
+}
+
+static const php_stream_wrapper_ops qp_fs_wrapper_ops = {
+    qp_fs_opener,
+    NULL,   /* stream_closer */
+    NULL,   /* stream_stat */
+    qp_fs_url_stat,
+    NULL,   /* dir_opener */
+    "quicpro-fs",
+    NULL,   /* unlink */
+    NULL,   /* rename */
+    NULL,   /* stream_mkdir */
+    NULL,   /* stream_rmdir */
+    NULL    /* stream_metadata */
+};
+
+/* Not is_url: reaching the store is not gated by allow_url_fopen */
+static const php_stream_wrapper qp_fs_wrapper = {
+    &qp_fs_wrapper_ops,
+    NULL,
+    0
+};
+
+/*─────────────────────────────── Lifecycle ───────────────────────────────*/
+
+void quicpro_fs_minit(void)
+{
+    php_register_url_stream_wrapper("quicpro-fs", (php_stream_wrapper *)&qp_fs_wrapper);
+}
+
+void quicpro_fs_mshutdown(void)
+{
+    php_unregister_url_stream_wrapper("quicpro-fs");
+}
+
+void quicpro_fs_rshutdown(void)
+{
+    while (qp_fs_open) {
+        qp_fs_stream_t *fs = qp_fs_open;
+        if (fs->w) {
+            quicpro_objstore_write_abort(fs->w);
+            fs->w = NULL;
+        }
+        if (fs->r) {
+            quicpro_objstore_read_end(fs->r);
+            fs->r = NULL;
+        }
+        qp_fs_unlink(fs);   /* Freed as its stream is */
+    }
+    if (qp_fs_store) {
+        quicpro_objstore_close(qp_fs_store);
+        qp_fs_store = NULL;
+    }
+    /* Freed with the request's resources, after the pool dropped its sessions */
+    qp_fs_cfg = NULL;
+}
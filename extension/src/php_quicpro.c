@@ -105,6 +105,69 @@
 #include <stddef.h>                    /* size_t, NULL */
 #include "session.h"                   /* quicpro_session_t definition */
 #include "php_quicpro.h"               /* PHP_FUNCTION prototypes, macros */
+#include "poll/udp_batch.h"            /* quicpro_udp_*_batch_free() */
+#include "poll/uring.h"                /* quicpro_uring_free() */
+#include "poll/xdp.h"                  /* quicpro_xdp_detach(), quicpro_xdp_shutdown() */
+#include "poll/reactor.h"              /* quicpro_reactor_* functions */
+#include "poll/txstamp.h"              /* quicpro_txstamp_free() */
+#include "poll/scheduler.h"            /* quicpro_scheduler_run(), quicpro_sched_shutdown() */
+#include "server/header_template.h"    /* quicpro_header_template_register(), name interning */
+#include "server/cancel.h"             /* quicpro_server_on_cancel(), quicpro_request_cancelled() */
+#include "server/request.h"            /* Quicpro\Request */
+#include "client/pool.h"               /* quicpro_client_pool_rshutdown(), quicpro_client_pool_mshutdown() */
+#include "client/dns.h"                /* quicpro_dns_mshutdown() */
+#include "client/alt_svc.h"            /* quicpro_alt_svc_mshutdown() */
+#include "server/hint_learner.h"       /* quicpro_hint_learner_mshutdown() */
+#include "client/index.h"              /* quicpro_client_send_request(), quicpro_client_rshutdown() */
+#include "client/ticket_cache.h"       /* quicpro_client_ticket_cache_release() */
+#include "pipeline_orchestrator/step_cache.h" /* quicpro_step_cache_release() */
+#include "client/mux.h"                /* quicpro_http3_batch_*(), quicpro_h3_mux_free() */
+#include "client/http2.h"              /* quicpro_http2_request_send*(), nghttp2 client lifecycle */
+#include "mcp/mcp.h"                   /* quicpro_mcp_inflight_free() */
+#include "mcp/mcp_server.h"            /* quicpro_mcp_server_*(), quicpro_mcp_served_free() */
+#include "server/proxy.h"              /* quicpro_proxy_*() */
+#include "server/priority.h"           /* quicpro_stream_set_priority() */
+#include "server/congestion.h"         /* quicpro_cc_peer_estimate() */
+#include "server/xdp_filter.h"         /* quicpro_xdp_filter_stats() */
+#include "smart_dns/zone.h"            /* quicpro_dns_zone_compile() */
+#include "smart_dns/dns_server.h"      /* quicpro_dns_server_run() */
+#include "smart_dns/doq.h"             /* quicpro_doq_conn_free(), quicpro_doq_rshutdown() */
+#include "ssh_over_quic/gateway.h"     /* quicpro_ssh_conn_free() */
+#include "state/state.h"               /* quicpro_state_*() */
+#include "state/state_cache.h"         /* quicpro_state_cache_release() */
+#include "webtransport/webtransport.h" /* quicpro_webtransport_*(), quicpro_wt_minit() */
+#include "client/datagram.h"           /* quicpro_datagram_*() batches */
+#include "client/dgram_fec.h"          /* quicpro_dgram_fec_free() */
+#include "client/stream_writer.h"      /* quicpro_stream_write(), quicpro_stream_capacity() */
+#include "poll/event_loop.h"           /* quicpro_session_fd(), quicpro_reactor_fd() */
+#include "client/loadgen.h"            /* quicpro_loadgen_run(), quicpro_loadgen_merge() */
+#include "client/multipath.h"          /* quicpro_client_session_add_path(), quicpro_mp_free() */
+#include "http_client/http_client.h"   /* quicpro_http_request_send(), libcurl engine lifecycle */
+#include "server/open_telemetry.h"     /* quicpro_otel_shutdown() */
+#include "server/metrics.h"            /* Quicpro\Metrics, quicpro_metrics_minit() */
+#include "server/qlog.h"               /* Quicpro\Qlog, quicpro_qlog_mshutdown() */
+#include "server/capture.h"            /* quicpro_capture_dump(), quicpro_capture_mshutdown() */
+#include "server/access_log.h"         /* quicpro_access_log_convert(), quicpro_access_log_mshutdown() */
+#include "server/live_config.h"        /* Quicpro\Server::reconfigure(), quicpro_live_config_mshutdown() */
+#include "server/cert_store.h"         /* quicpro_cert_store_mshutdown() */
+#include "server/ocsp.h"               /* quicpro_ocsp_release() */
+#include "config/runtime.h"            /* quicpro_runtime_config_rshutdown() */
+#include "config/config.h"             /* quicpro_config_rshutdown() */
+#include "server/cdn_cache.h"          /* quicpro_cdn_cache_mshutdown() */
+#include "websocket/websocket.h"       /* quicpro_ws_publish(), quicpro_ws_hub_rshutdown() */
+#include "iibin/iibin.h"               /* Quicpro\IIBIN, quicpro_iibin_minit() */
+#include "dataframe/dataframe.h"       /* Quicpro\DataFrame, quicpro_dataframe_minit() */
+#include "gpu/tensor.h"                /* Quicpro\Gpu\Tensor, quicpro_gpu_tensor_minit() */
+#include "gpu/collective.h"            /* Quicpro\Gpu\Collective, quicpro_gpu_collective_minit() */
+#include "gpu/device.h"                /* quicpro_gpu_mshutdown() */
+#include "semantic_geometry/geometry.h" /* Quicpro\Geometry\Matrix, quicpro_geometry_minit() */
+#include "semantic_geometry/index.h"   /* Quicpro\Geometry\Index, quicpro_geometry_index_minit() */
+#include "semantic_geometry/space.h"   /* Quicpro\Geometry\Space, quicpro_geometry_space_minit() */
+#include "smart_contracts/abi.h"      /* quicpro_abi_minit(), the ABI layout cache */
+#include "smart_contracts/event_listener.h" /* Quicpro\SmartContracts\EventListener */
+#include "pipeline_orchestrator/pipeline_orchestrator.h" /* quicpro_pipeline_plan_minit() */
+#include "object_store/stream.h"      /* The quicpro-fs:// wrapper */
+#include "object_store/metadata_cache.h" /* quicpro_objstore_md_release() */
 #include "php_quicpro_arginfo.h"       /* Generated arginfo for reflection */
 
 #include <ext/standard/info.h>         /* phpinfo() helpers */
@@ -186,19 +249,25 @@ zend_class_entry *quicpro_ce_too_many_streams;
  * Destructor for the "quicpro" resource. Called automatically by PHP
  * when the last reference to a Session resource is released.
  * It must:
+ *   0. Store the path's BDP and RTT for the peer's prefix (server/congestion.h).
  *   1. Free the HTTP/3 context (quiche_h3_conn_free).
  *   2. Free the QUIC connection (quiche_conn_free).
  *   3. Free the HTTP/3 config (quiche_h3_config_free).
  *   4. Free the shared quiche_config if no longer used.
- *   5. Close the UDP socket.
- *   6. Release the allocated quicpro_session_t struct via efree().
+ *   5. Drop the AF_XDP demux entry and close the UDP socket.
+ *   6. Release the batched receive/transmit slots, the TX timestamp
+ *      histograms and the io_uring engine.
+ *   7. Drop requests still queued in the HTTP/3 multiplexer, the MCP
+ *      client's table of calls in flight and the MCP requests the
+ *      server has not answered yet.
+ *   8. Release the allocated quicpro_session_t struct via efree().
+ *
+ * Steps 0-7 live in quicpro_session_free_members(), which the server's
+ * session pool shares.
  */
-static void quicpro_session_dtor(zend_resource *res)
+void quicpro_session_free_members(quicpro_session_t *s)
 {
-    quicpro_session_t *s = (quicpro_session_t *) res->ptr;
-    if (!s) {
-        return;
-    }
+    quicpro_cc_cache_learn(s);
     if (s->h3) {
         quiche_h3_conn_free(s->h3);
     }
@@ -211,9 +280,31 @@ static void quicpro_session_dtor(zend_resource *res)
     if (s->cfg) {
         quiche_config_free((quiche_config *)s->cfg);
     }
+    quicpro_xdp_detach(s);
     if (s->sock >= 0) {
         close(s->sock);
     }
+    quicpro_udp_rx_batch_free(s->rx_batch);
+    quicpro_udp_tx_batch_free(s->tx_batch);
+    quicpro_txstamp_free(s->txstamp);
+    quicpro_uring_free(s->uring);
+    quicpro_h3_mux_free(s->mux);
+    quicpro_mcp_inflight_free(s->mcp);
+    quicpro_mcp_served_free(s->mcp_served);
+    quicpro_proxy_conn_free(s->proxy);
+    quicpro_doq_conn_free(s->doq);
+    quicpro_ssh_conn_free(s->ssh);
+    quicpro_mp_free(s->mp);
+    quicpro_dgram_fec_free(s->dgram_fec);
+}
+
+static void quicpro_session_dtor(zend_resource *res)
+{
+    quicpro_session_t *s = (quicpro_session_t *) res->ptr;
+    if (!s) {
+        return;
+    }
+    quicpro_session_free_members(s);
     efree(s);
 }
 
@@ -223,6 +314,19 @@ static void quicpro_session_dtor(zend_resource *res)
  * Map PHP function names to their C implementations and
  * provide arginfo for engine validation and reflection.
  * ------------------------------------------------------------------------*/
+#if PHP_VERSION_ID >= 80400
+/* Frameless variants of the per-event loop calls (poll/event_loop.c). */
+static const zend_frameless_function_info frameless_function_infos_quicpro_session_timeout[] = {
+    { ZEND_FRAMELESS_FUNCTION_NAME(quicpro_session_timeout, 1), 1 },
+    { 0 },
+};
+
+static const zend_frameless_function_info frameless_function_infos_quicpro_session_process[] = {
+    { ZEND_FRAMELESS_FUNCTION_NAME(quicpro_session_process, 1), 1 },
+    { 0 },
+};
+#endif
+
 static const zend_function_entry quicpro_funcs[] = {
     PHP_FE(quicpro_connect,               arginfo_quicpro_connect)
     PHP_FE(quicpro_close,                 arginfo_quicpro_close)
@@ -237,6 +341,77 @@ static const zend_function_entry quicpro_funcs[] = {
     PHP_FE(quicpro_get_last_error,        arginfo_quicpro_get_last_error)
     PHP_FE(quicpro_get_stats,             arginfo_quicpro_get_stats)
     PHP_FE(quicpro_version,               arginfo_quicpro_version)
+    PHP_FE(quicpro_reactor_new,           arginfo_quicpro_reactor_new)
+    PHP_FE(quicpro_reactor_add,           arginfo_quicpro_reactor_add)
+    PHP_FE(quicpro_reactor_remove,        arginfo_quicpro_reactor_remove)
+    PHP_FE(quicpro_reactor_run,           arginfo_quicpro_reactor_run)
+    PHP_FE(quicpro_reactor_stats,         arginfo_quicpro_reactor_stats)
+    PHP_FE(quicpro_scheduler_run,         arginfo_quicpro_scheduler_run)
+    PHP_FE(quicpro_header_template_register, arginfo_quicpro_header_template_register)
+    PHP_FE(quicpro_server_on_cancel,      arginfo_quicpro_server_on_cancel)
+    PHP_FE(quicpro_request_cancelled,     arginfo_quicpro_request_cancelled)
+    PHP_FE(quicpro_access_log_convert,    arginfo_quicpro_access_log_convert)
+    PHP_FE(quicpro_loadgen_run,           arginfo_quicpro_loadgen_run)
+    PHP_FE(quicpro_loadgen_merge,         arginfo_quicpro_loadgen_merge)
+    PHP_FE(quicpro_http3_batch_submit,    arginfo_quicpro_http3_batch_submit)
+    PHP_FE(quicpro_http3_batch_wait,      arginfo_quicpro_http3_batch_wait)
+    PHP_FE(quicpro_http3_batch_pending,   arginfo_quicpro_http3_batch_pending)
+    PHP_FE(quicpro_client_send_request,   arginfo_quicpro_client_send_request)
+    PHP_FE(quicpro_http2_request_send,    arginfo_quicpro_http2_request_send)
+    PHP_FE(quicpro_http2_request_send_multi, arginfo_quicpro_http2_request_send_multi)
+    PHP_FE(quicpro_http_request_send,     arginfo_quicpro_http_request_send)
+    PHP_FE(quicpro_http_batch_submit,     arginfo_quicpro_http_batch_submit)
+    PHP_FE(quicpro_http_batch_wait,       arginfo_quicpro_http_batch_wait)
+    PHP_FE(quicpro_http_batch_pending,    arginfo_quicpro_http_batch_pending)
+    PHP_FE(quicpro_ws_receive,            arginfo_quicpro_ws_receive)
+    PHP_FE(quicpro_ws_receive_chunk,      arginfo_quicpro_ws_receive_chunk)
+    PHP_FE(quicpro_ws_subscribe,          arginfo_quicpro_ws_subscribe)
+    PHP_FE(quicpro_ws_unsubscribe,        arginfo_quicpro_ws_unsubscribe)
+    PHP_FE(quicpro_ws_publish,            arginfo_quicpro_ws_publish)
+    PHP_FE(quicpro_ws_flush,              arginfo_quicpro_ws_flush)
+    PHP_FE(quicpro_ws_get_stats,          arginfo_quicpro_ws_get_stats)
+    PHP_FE(quicpro_webtransport_connect,  arginfo_quicpro_webtransport_connect)
+    PHP_FE(quicpro_webtransport_accept,   arginfo_quicpro_webtransport_accept)
+    PHP_FE(quicpro_webtransport_open_stream, arginfo_quicpro_webtransport_open_stream)
+    PHP_FE(quicpro_webtransport_stream_send, arginfo_quicpro_webtransport_stream_send)
+    PHP_FE(quicpro_webtransport_send_datagram, arginfo_quicpro_webtransport_send_datagram)
+    PHP_FE(quicpro_webtransport_poll,     arginfo_quicpro_webtransport_poll)
+    PHP_FE(quicpro_webtransport_close,    arginfo_quicpro_webtransport_close)
+    PHP_FE(quicpro_mcp_server_register,   arginfo_quicpro_mcp_server_register)
+    PHP_FE(quicpro_mcp_server_serve,      arginfo_quicpro_mcp_server_serve)
+    PHP_FE(quicpro_proxy_route,           arginfo_quicpro_proxy_route)
+    PHP_FE(quicpro_proxy_serve,           arginfo_quicpro_proxy_serve)
+    PHP_FE(quicpro_stream_set_priority,   arginfo_quicpro_stream_set_priority)
+    PHP_FE(quicpro_cc_peer_estimate,      arginfo_quicpro_cc_peer_estimate)
+    PHP_FE(quicpro_dns_zone_compile,      arginfo_quicpro_dns_zone_compile)
+    PHP_FE(quicpro_dns_server_run,        arginfo_quicpro_dns_server_run)
+    PHP_FE(quicpro_state_get,             arginfo_quicpro_state_get)
+    PHP_FE(quicpro_state_mget,            arginfo_quicpro_state_mget)
+    PHP_FE(quicpro_state_set,             arginfo_quicpro_state_set)
+    PHP_FE(quicpro_state_mset,            arginfo_quicpro_state_mset)
+    PHP_FE(quicpro_state_delete,          arginfo_quicpro_state_delete)
+    PHP_FE(quicpro_datagram_send_batch,   arginfo_quicpro_datagram_send_batch)
+    PHP_FE(quicpro_datagram_send_packed,  arginfo_quicpro_datagram_send_packed)
+    PHP_FE(quicpro_datagram_recv_batch,   arginfo_quicpro_datagram_recv_batch)
+    PHP_FE(quicpro_datagram_recv_packed,  arginfo_quicpro_datagram_recv_packed)
+    PHP_FE(quicpro_datagram_fec_stats,    arginfo_quicpro_datagram_fec_stats)
+    PHP_FE(quicpro_capture_connection,    arginfo_quicpro_capture_connection)
+    PHP_FE(quicpro_capture_dump,          arginfo_quicpro_capture_dump)
+    PHP_FE(quicpro_client_session_add_path, arginfo_quicpro_client_session_add_path)
+    PHP_FE(quicpro_client_session_paths,  arginfo_quicpro_client_session_paths)
+    PHP_FE(quicpro_xdp_filter_stats,      arginfo_quicpro_xdp_filter_stats)
+    PHP_FE(quicpro_stream_capacity,       arginfo_quicpro_stream_capacity)
+    PHP_FE(quicpro_stream_write,          arginfo_quicpro_stream_write)
+    PHP_FE(quicpro_session_fd,            arginfo_quicpro_session_fd)
+#if PHP_VERSION_ID >= 80400
+    ZEND_RAW_FENTRY("quicpro_session_timeout", zif_quicpro_session_timeout, arginfo_quicpro_session_timeout, 0, frameless_function_infos_quicpro_session_timeout, NULL)
+    ZEND_RAW_FENTRY("quicpro_session_process", zif_quicpro_session_process, arginfo_quicpro_session_process, 0, frameless_function_infos_quicpro_session_process, NULL)
+#else
+    PHP_FE(quicpro_session_timeout,       arginfo_quicpro_session_timeout)
+    PHP_FE(quicpro_session_process,       arginfo_quicpro_session_process)
+#endif
+    PHP_FE(quicpro_session_process_many,  arginfo_quicpro_session_process_many)
+    PHP_FE(quicpro_reactor_fd,            arginfo_quicpro_reactor_fd)
     PHP_FE_END
 };
 
@@ -260,7 +435,10 @@ PHP_FUNCTION(quicpro_get_last_error)
 /* ---------------------------------------------------------------------------
  * PHP_MINIT_FUNCTION(quicpro_async)
  *
- * Module initialization: register the "quicpro" resource type and its destructor.
+ * Module initialization: register the "quicpro", "quicpro_reactor" and
+ * "quicpro_pipeline_plan" resource types and their destructors, the
+ * Quicpro\IIBIN classes, Quicpro\DataFrame, the built-in metrics and the
+ * quicpro-fs:// stream wrapper.
  * On Windows, also initialize the Winsock library.
  * Returns SUCCESS on success or FAILURE on error.
  * ------------------------------------------------------------------------*/
@@ -277,12 +455,134 @@ PHP_MINIT_FUNCTION(quicpro_async)
         "quicpro",
         module_number
     );
+    quicpro_reactor_minit(module_number);
+    quicpro_wt_minit(module_number);
+    quicpro_pipeline_plan_minit(module_number);
+    quicpro_header_names_minit();
+    quicpro_request_minit();
+    quicpro_iibin_minit();
+    quicpro_dataframe_minit();
+    quicpro_gpu_tensor_minit();
+    quicpro_gpu_collective_minit();
+    quicpro_geometry_minit();
+    quicpro_geometry_index_minit();
+    quicpro_geometry_space_minit();
+    quicpro_abi_minit();
+    quicpro_event_listener_minit();
+    quicpro_metrics_minit();
+    quicpro_fs_minit();
 
     quicpro_set_error(NULL);
 
     return SUCCESS;
 }
 
+/* ---------------------------------------------------------------------------
+ * PHP_MSHUTDOWN_FUNCTION(quicpro_async)
+ *
+ * Module shutdown: release process-wide state, in this order:
+ *   • the AF_XDP socket and its umem (a no-op unless the fast path was opened)
+ *   • the registered response header templates
+ *   • the client DNS and Alt-Svc caches, and the learned early hints
+ *   • the client TLS session cache and the client connections parked
+ *     between requests
+ *   • the pipeline step cache
+ *   • the span exporter (which flushes what is queued), the metrics
+ *     registry and its server thread
+ *   • the qlog ring, the packet capture ring and its TLS secrets, and the
+ *     access log writer (after a last drain)
+ *   • the runtime configuration snapshots
+ *   • the TLS certificate store, the OCSP staple cache and its fetcher thread
+ *   • the CDN response cache
+ *   • the libcurl transfer engine and the HTTP/2 client's TLS context
+ *   • the IIBIN schema registry
+ *   • the quicpro-fs:// wrapper and its manifest cache
+ *   • the state API's Redis connection, memory backend and local cache
+ *   • the DataFrame morsel threads and the GPU pools
+ *   • the shared semantic geometry indexes and spaces, and the ABI layouts
+ * ------------------------------------------------------------------------*/
+PHP_MSHUTDOWN_FUNCTION(quicpro_async)
+{
+    quicpro_xdp_shutdown();
+    quicpro_header_templates_mshutdown();
+    quicpro_dns_mshutdown();
+    quicpro_alt_svc_mshutdown();
+    quicpro_hint_learner_mshutdown();
+    quicpro_client_ticket_cache_release();
+    quicpro_client_pool_mshutdown();
+    quicpro_step_cache_release();
+    quicpro_otel_shutdown();
+    quicpro_metrics_mshutdown();
+    quicpro_qlog_mshutdown();
+    quicpro_capture_mshutdown();
+    quicpro_access_log_mshutdown();
+    quicpro_live_config_mshutdown();
+    quicpro_cert_store_mshutdown();
+    quicpro_ocsp_release();
+    quicpro_cdn_cache_mshutdown();
+    quicpro_http_client_mshutdown();
+    quicpro_http2_client_mshutdown();
+    quicpro_iibin_mshutdown();
+    quicpro_fs_mshutdown();
+    quicpro_objstore_md_release();
+    quicpro_state_mshutdown();
+    quicpro_state_cache_release();
+    quicpro_dataframe_mshutdown();
+    quicpro_gpu_mshutdown();
+    quicpro_geometry_index_mshutdown();
+    quicpro_geometry_space_mshutdown();
+    quicpro_abi_mshutdown();
+
+    return SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------
+ * PHP_RSHUTDOWN_FUNCTION(quicpro_async)
+ *
+ * Request shutdown: send the pipeline events still buffered, drop the
+ * Fiber scheduler's reactor, discard the quicpro-fs:// streams still
+ * open, close the DNS-over-QUIC zone and health feed and the warm client
+ * connections (or park them, see include/client/pool.h), drop the
+ * unified client's default Config, abandon unfinished libcurl transfers,
+ * close the HTTP/2 client's connections, empty the WebSocket broadcast
+ * topics, drop the MCP server routes, the state agent's Config, the
+ * compiled Config views and the shared php.ini Config. Parked fibers have
+ * already been destroyed by the engine at this point.
+ * ------------------------------------------------------------------------*/
+PHP_RSHUTDOWN_FUNCTION(quicpro_async)
+{
+    quicpro_pipeline_orchestrator_rshutdown();
+    quicpro_sched_shutdown();
+    quicpro_fs_rshutdown();
+    quicpro_proxy_rshutdown();        /* Returns its upstreams before the pool goes */
+    quicpro_doq_rshutdown();
+    quicpro_client_pool_rshutdown();
+    quicpro_client_rshutdown();       /* Its Config outlived the pooled sessions using it */
+    quicpro_http_client_rshutdown();
+    quicpro_http2_client_rshutdown();
+    quicpro_ws_hub_rshutdown();
+    quicpro_mcp_server_rshutdown();
+    quicpro_state_rshutdown();
+    quicpro_runtime_config_rshutdown();
+    quicpro_config_rshutdown();
+
+    return SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------
+ * ZEND_MODULE_POST_ZEND_DEACTIVATE_D(quicpro_async)
+ *
+ * After the executor has destroyed the request's variables: free the
+ * blocks behind arena-decoded IIBIN arrays, which those variables may
+ * have pointed into until now.
+ * ------------------------------------------------------------------------*/
+ZEND_MODULE_POST_ZEND_DEACTIVATE_D(quicpro_async)
+{
+    quicpro_iibin_arena_release();
+
+    return SUCCESS;
+}
+
 /* ---------------------------------------------------------------------------
  * PHP_MINFO_FUNCTION(quicpro_async)
  *
@@ -309,7 +609,7 @@ PHP_MINFO_FUNCTION(quicpro_async)
  *   • Name ("quicpro_async")
  *   • Version (PHP_QUICPRO_VERSION from php_quicpro.h)
  *   • Function table (quicpro_funcs)
- *   • Life-cycle hooks (MINIT and MINFO)
+ *   • Life-cycle hooks (MINIT, MSHUTDOWN, RSHUTDOWN, MINFO, post-deactivate)
  *   • Module properties (persistent, globals)
  * ZEND_GET_MODULE exposes the entry point for dynamic loading.
  * ------------------------------------------------------------------------*/
@@ -318,12 +618,14 @@ zend_module_entry quicpro_async_module_entry = {
     "quicpro_async",
     quicpro_funcs,
     PHP_MINIT(quicpro_async),
+    PHP_MSHUTDOWN(quicpro_async),
     NULL,
-    NULL,
-    NULL,
+    PHP_RSHUTDOWN(quicpro_async),
     PHP_MINFO(quicpro_async),
     PHP_QUICPRO_VERSION,
-    STANDARD_MODULE_PROPERTIES
+    NO_MODULE_GLOBALS,
+    ZEND_MODULE_POST_ZEND_DEACTIVATE_N(quicpro_async),
+    STANDARD_MODULE_PROPERTIES_EX
 };
 
 
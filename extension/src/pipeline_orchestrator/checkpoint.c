@@ -0,0 +1,166 @@
+/*
+ * src/pipeline_orchestrator/checkpoint.c – Resuming failed pipeline runs
+ * ======================================================================
+ *
+ * See include/pipeline_orchestrator/checkpoint.h. Reads and writes go
+ * through the state API's C calls, so a remote backend's local cache and
+ * batching apply to them as to quicpro_state_mget() and the rest.
+ */
+
+#include "php_quicpro.h"
+#include "pipeline_orchestrator/checkpoint.h"
+#include "state/state.h"
+#include "cancel.h" /* For error throwing helpers */
+
+#include <ext/standard/php_var.h>
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+#include <string.h>
+
+#define QP_CHECKPOINT_PREFIX "pipeline:"
+
+enum { CHECKPOINT_IIBIN = 'I', CHECKPOINT_RAW = 'R', CHECKPOINT_SERIALIZED = 'S' };
+
+/* Turns the pending exception into a warning about `what`; an exit unwinding goes on. */
+static void checkpoint_warn(const char *what, const zend_string *key)
+{
+    zend_object *ex = EG(exception);
+    if (!ex) {
+        php_error_docref(NULL, E_WARNING, "Pipeline checkpoint %s failed for '%s'", what, ZSTR_VAL(key));
+        return;
+    }
+#if PHP_VERSION_ID >= 80100
+    if (zend_is_unwind_exit(ex) || zend_is_graceful_exit(ex)) {
+        return;
+    }
+#endif
+    zval rv;
+    zend_string *msg = zval_get_string(zend_read_property_ex(ex->ce, ex, ZSTR_KNOWN(ZEND_STR_MESSAGE), 1, &rv));
+    zend_clear_exception();
+    php_error_docref(NULL, E_WARNING, "Pipeline checkpoint %s failed for '%s': %s", what, ZSTR_VAL(key), ZSTR_VAL(msg));
+    zend_string_release(msg);
+}
+
+zend_string *quicpro_pipeline_checkpoint_key(const zend_string *run_id, const zend_string *step_id)
+{
+    size_t len = sizeof(QP_CHECKPOINT_PREFIX) - 1 + ZSTR_LEN(run_id) + 1 + ZSTR_LEN(step_id);
+    if (ZSTR_LEN(run_id) == 0 || len > QUICPRO_STATE_KEY_MAX
+        || memchr(ZSTR_VAL(run_id), '\n', ZSTR_LEN(run_id)) || memchr(ZSTR_VAL(step_id), '\n', ZSTR_LEN(step_id))) {
+        throw_pipeline_error_as_php_exception(0, "'run_id' must be non-empty, without a newline, and leave room for step '%s' in a %d-byte state key.",
+                                              ZSTR_VAL(step_id), QUICPRO_STATE_KEY_MAX);
+        return NULL;
+    }
+    zend_string *key = zend_string_alloc(len, 0);
+    char *p = ZSTR_VAL(key);
+    memcpy(p, QP_CHECKPOINT_PREFIX, sizeof(QP_CHECKPOINT_PREFIX) - 1);
+    p += sizeof(QP_CHECKPOINT_PREFIX) - 1;
+    memcpy(p, ZSTR_VAL(run_id), ZSTR_LEN(run_id));
+    p += ZSTR_LEN(run_id);
+    *p++ = ':';
+    memcpy(p, ZSTR_VAL(step_id), ZSTR_LEN(step_id));
+    p[ZSTR_LEN(step_id)] = '\0';
+    return key;
+}
+
+bool quicpro_pipeline_checkpoint_fetch(zend_string *const *keys, uint32_t n, zend_string **blobs)
+{
+    if (n == 0) {
+        return true;
+    }
+    if (!quicpro_state_fetch(keys, n, blobs)) {
+        checkpoint_warn("read", keys[0]);
+        return false;
+    }
+    return true;
+}
+
+/* A serialized output, refusing objects: the store is not trusted with instantiating classes. */
+static bool checkpoint_unserialize(const unsigned char *p, const unsigned char *end, zval *out)
+{
+    php_unserialize_data_t var_hash;
+    HashTable no_classes;
+    zend_hash_init(&no_classes, 0, NULL, NULL, 0);
+    PHP_VAR_UNSERIALIZE_INIT(var_hash);
+    php_var_unserialize_set_allowed_classes(var_hash, &no_classes);
+    zval *value = var_tmp_var(&var_hash);
+    bool ok = php_var_unserialize(value, &p, end, &var_hash) && p == end && Z_TYPE_P(value) != IS_OBJECT;
+    if (ok) {
+        ZVAL_COPY(out, value);
+    }
+    PHP_VAR_UNSERIALIZE_DESTROY(var_hash);
+    zend_hash_destroy(&no_classes);
+    return ok;
+}
+
+bool quicpro_pipeline_checkpoint_decode(const quicpro_iibin_compiled_schema_internal *schema, zend_string *blob, zval *out)
+{
+    const unsigned char *p = (const unsigned char *)ZSTR_VAL(blob);
+    size_t len = ZSTR_LEN(blob);
+    bool ok = false;
+
+    ZVAL_UNDEF(out);
+    if (len > 0) {
+        switch (p[0]) {
+            case CHECKPOINT_IIBIN:
+                ok = schema && quicpro_iibin_decode_message(p + 1, len - 1, schema, out, 0) == SUCCESS;
+                break;
+            case CHECKPOINT_RAW:
+                ZVAL_STRINGL(out, (const char *)p + 1, len - 1);
+                ok = true;
+                break;
+            case CHECKPOINT_SERIALIZED:
+                ok = checkpoint_unserialize(p + 1, p + len, out);
+                break;
+        }
+    }
+    zend_string_release(blob);
+    if (!ok) {
+        if (EG(exception)) {
+            zend_clear_exception();
+        }
+        php_error_docref(NULL, E_WARNING, "Discarding an unreadable pipeline checkpoint; its step runs again");
+    }
+    return ok;
+}
+
+void quicpro_pipeline_checkpoint_save(zend_string *key, const quicpro_iibin_compiled_schema_internal *schema, zval *output)
+{
+    smart_str buf = {0};
+    ZVAL_DEREF(output);
+    if (schema && Z_TYPE_P(output) == IS_ARRAY) {
+        smart_str_appendc(&buf, CHECKPOINT_IIBIN);
+        if (quicpro_iibin_encode_message(&buf, schema, output) == FAILURE) {
+            smart_str_free(&buf);
+            checkpoint_warn("write", key);
+            return;
+        }
+    } else if (Z_TYPE_P(output) == IS_STRING) {
+        smart_str_appendc(&buf, CHECKPOINT_RAW);
+        smart_str_append(&buf, Z_STR_P(output));
+    } else {
+        php_serialize_data_t var_hash;
+        smart_str_appendc(&buf, CHECKPOINT_SERIALIZED);
+        PHP_VAR_SERIALIZE_INIT(var_hash);
+        php_var_serialize(&buf, output, &var_hash);
+        PHP_VAR_SERIALIZE_DESTROY(var_hash);
+        if (EG(exception)) {
+            smart_str_free(&buf);
+            checkpoint_warn("write", key);
+            return;
+        }
+    }
+
+    zend_string *value = smart_str_extract(&buf);
+    uint64_t version;
+    if (!quicpro_state_store(&key, &value, 1, &version)) {
+        checkpoint_warn("write", key);
+    }
+    zend_string_release(value);
+}
+
+void quicpro_pipeline_checkpoint_clear(zend_string *const *keys, uint32_t n)
+{
+    if (n && !quicpro_state_remove(keys, n)) {
+        checkpoint_warn("delete", keys[0]);
+    }
+}
@@ -0,0 +1,233 @@
+/*
+ * src/endpoint_balancer.c – Power-of-two-choices picking across a tool's MCP endpoints
+ * ===================================================================================
+ *
+ * See include/pipeline_orchestrator/endpoint_balancer.h. Picking is two
+ * random draws and a comparison over the endpoints in rotation; ejection is
+ * decided when a call ends, from what the set has seen so far.
+ */
+
+#include "php_quicpro.h"
+#include "endpoint_balancer.h"
+#include "cancel.h" /* For error throwing helpers */
+
+#include <zend_API.h>
+#include <zend_hash.h>
+#include <ext/standard/php_rand.h>
+#include <string.h>
+#include <time.h>
+
+static zend_long lb_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (zend_long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*──── Configuration ────*/
+
+static int lb_parse_endpoint(HashTable *ht, quicpro_mcp_endpoint_t *ep, const char *context_for_error) {
+    zval *zv_host = zend_hash_str_find(ht, "host", sizeof("host")-1);
+    zval *zv_port = zend_hash_str_find(ht, "port", sizeof("port")-1);
+    if (!zv_host || Z_TYPE_P(zv_host) != IS_STRING) {
+        throw_pipeline_error_as_php_exception(0, "Invalid 'mcp_target' for '%s': missing 'host' string.", context_for_error);
+        return FAILURE;
+    }
+    if (!zv_port || Z_TYPE_P(zv_port) != IS_LONG) {
+        throw_pipeline_error_as_php_exception(0, "Invalid 'mcp_target' for '%s': missing 'port' integer.", context_for_error);
+        return FAILURE;
+    }
+    ep->host = estrndup(Z_STRVAL_P(zv_host), Z_STRLEN_P(zv_host));
+    ep->port = Z_LVAL_P(zv_port);
+    return SUCCESS;
+}
+
+int quicpro_mcp_endpoints_parse(HashTable *target_ht, quicpro_mcp_endpoint_set_t *set, const char *context_for_error) {
+    memset(set, 0, sizeof(*set));
+
+    zval *zv_list = zend_hash_str_find(target_ht, "endpoints", sizeof("endpoints")-1);
+    if (!zv_list) {
+        set->endpoints = ecalloc(1, sizeof(quicpro_mcp_endpoint_t));
+        if (lb_parse_endpoint(target_ht, &set->endpoints[0], context_for_error) == FAILURE) {
+            quicpro_mcp_endpoints_destroy(set);
+            return FAILURE;
+        }
+        set->count = 1;
+        return SUCCESS;
+    }
+    if (Z_TYPE_P(zv_list) != IS_ARRAY || zend_hash_num_elements(Z_ARRVAL_P(zv_list)) == 0) {
+        throw_pipeline_error_as_php_exception(0, "Invalid 'mcp_target' for '%s': 'endpoints' must be a non-empty list.", context_for_error);
+        return FAILURE;
+    }
+
+    set->endpoints = ecalloc(zend_hash_num_elements(Z_ARRVAL_P(zv_list)), sizeof(quicpro_mcp_endpoint_t));
+    zval *zv_ep;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(zv_list), zv_ep) {
+        if (Z_TYPE_P(zv_ep) != IS_ARRAY) {
+            throw_pipeline_error_as_php_exception(0, "Invalid 'mcp_target' for '%s': each endpoint must be an array.", context_for_error);
+            quicpro_mcp_endpoints_destroy(set);
+            return FAILURE;
+        }
+        if (lb_parse_endpoint(Z_ARRVAL_P(zv_ep), &set->endpoints[set->count], context_for_error) == FAILURE) {
+            quicpro_mcp_endpoints_destroy(set);
+            return FAILURE;
+        }
+        set->count++;
+    } ZEND_HASH_FOREACH_END();
+    return SUCCESS;
+}
+
+void quicpro_mcp_endpoints_destroy(quicpro_mcp_endpoint_set_t *set) {
+    for (uint32_t i = 0; i < set->count; i++) {
+        efree(set->endpoints[i].host);
+    }
+    if (set->endpoints) {
+        efree(set->endpoints);
+    }
+    memset(set, 0, sizeof(*set));
+}
+
+/*──── Picking ────*/
+
+static inline bool lb_in_rotation(const quicpro_mcp_endpoint_t *ep, zend_long now) {
+    return ep->ejected_until_ms <= now;
+}
+
+static inline double lb_cost(const quicpro_mcp_endpoint_t *ep) {
+    return (ep->ewma_ms + 1.0) * (double)(ep->inflight + 1);
+}
+
+/* The n-th endpoint in rotation other than `exclude`; NULL past the end. */
+static quicpro_mcp_endpoint_t *lb_nth(quicpro_mcp_endpoint_set_t *set, uint32_t n, const quicpro_mcp_endpoint_t *exclude, zend_long now) {
+    for (uint32_t i = 0; i < set->count; i++) {
+        quicpro_mcp_endpoint_t *ep = &set->endpoints[i];
+        if (ep != exclude && lb_in_rotation(ep, now) && n-- == 0) {
+            return ep;
+        }
+    }
+    return NULL;
+}
+
+quicpro_mcp_endpoint_t *quicpro_mcp_endpoint_pick(quicpro_mcp_endpoint_set_t *set, const quicpro_mcp_endpoint_t *exclude) {
+    zend_long now = lb_now_ms();
+    quicpro_mcp_endpoint_t *picked = NULL;
+
+    uint32_t live = 0;
+    for (uint32_t i = 0; i < set->count; i++) {
+        live += &set->endpoints[i] != exclude && lb_in_rotation(&set->endpoints[i], now);
+    }
+
+    if (live == 1) {
+        picked = lb_nth(set, 0, exclude, now);
+    } else if (live > 1) {
+        /* Two distinct draws: the second skips over the first */
+        uint32_t a = (uint32_t)php_mt_rand_range(0, (zend_long)live - 1);
+        uint32_t b = (uint32_t)php_mt_rand_range(0, (zend_long)live - 2);
+        if (b >= a) {
+            b++;
+        }
+        quicpro_mcp_endpoint_t *first = lb_nth(set, a, exclude, now), *second = lb_nth(set, b, exclude, now);
+        picked = lb_cost(second) < lb_cost(first) ? second : first;
+    } else {
+        /* Nothing in rotation: the endpoint due back first, `exclude` as the last resort */
+        for (uint32_t i = 0; i < set->count; i++) {
+            quicpro_mcp_endpoint_t *ep = &set->endpoints[i];
+            if (ep != exclude && (!picked || ep->ejected_until_ms < picked->ejected_until_ms)) {
+                picked = ep;
+            }
+        }
+        if (!picked) {
+            picked = (quicpro_mcp_endpoint_t *)exclude;
+        }
+    }
+
+    if (picked) {
+        picked->inflight++;
+    }
+    return picked;
+}
+
+bool quicpro_mcp_endpoint_take(quicpro_mcp_endpoint_t *ep) {
+    if (!lb_in_rotation(ep, lb_now_ms())) {
+        return false;
+    }
+    ep->inflight++;
+    return true;
+}
+
+/*──── Outcomes ────*/
+
+static int lb_cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* The median EWMA of the other measured endpoints in rotation; 0 if fewer than two. */
+static double lb_others_median(const quicpro_mcp_endpoint_set_t *set, const quicpro_mcp_endpoint_t *ep, zend_long now) {
+    double stack[16], *values = set->count <= 16 ? stack : emalloc(set->count * sizeof(double));
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < set->count; i++) {
+        const quicpro_mcp_endpoint_t *other = &set->endpoints[i];
+        if (other != ep && other->ewma_ms > 0 && lb_in_rotation(other, now)) {
+            values[n++] = other->ewma_ms;
+        }
+    }
+    double median = 0;
+    if (n >= 2) {
+        qsort(values, n, sizeof(double), lb_cmp_double);
+        median = values[n / 2];
+    }
+    if (values != stack) {
+        efree(values);
+    }
+    return median;
+}
+
+/* Takes `ep` out of rotation unless that would leave less than half of the set in it. */
+static void lb_eject(quicpro_mcp_endpoint_set_t *set, quicpro_mcp_endpoint_t *ep, zend_long now) {
+    uint32_t ejected = 0;
+    for (uint32_t i = 0; i < set->count; i++) {
+        ejected += !lb_in_rotation(&set->endpoints[i], now);
+    }
+    if ((ejected + 1) * 2 > set->count) {
+        return;
+    }
+    zend_long timeout = MCP_LB_EJECT_BASE_MS << MIN(ep->ejections, 10);
+    ep->ejected_until_ms = now + MIN(timeout, MCP_LB_EJECT_MAX_MS);
+    ep->ejections++;
+    ep->failures = 0;
+}
+
+void quicpro_mcp_endpoint_report(quicpro_mcp_endpoint_set_t *set, quicpro_mcp_endpoint_t *ep, zend_long latency_ms, bool ok) {
+    zend_long now = lb_now_ms();
+    if (ep->inflight) {
+        ep->inflight--;
+    }
+
+    if (!ok) {
+        if (++ep->failures >= MCP_LB_EJECT_FAILURES) {
+            lb_eject(set, ep, now);
+        }
+        return;
+    }
+
+    double sample = (double)MAX(latency_ms, 0);
+    ep->ewma_ms = ep->ewma_ms > 0 ? ep->ewma_ms + MCP_LB_EWMA_ALPHA * (sample - ep->ewma_ms) : MAX(sample, 1.0);
+    ep->failures = 0;
+
+    double median = lb_others_median(set, ep, now);
+    if (median > 0 && ep->ewma_ms > MCP_LB_EJECT_LATENCY_FACTOR * median) {
+        /* Back in rotation it starts over, or the old average would eject it again at once */
+        lb_eject(set, ep, now);
+        if (ep->ejected_until_ms > now) {
+            ep->ewma_ms = 0;
+        }
+    } else {
+        ep->ejections = 0;
+    }
+}
+
+void quicpro_mcp_endpoint_cancel(quicpro_mcp_endpoint_t *ep) {
+    if (ep->inflight) {
+        ep->inflight--;
+    }
+}
@@ -6,6 +6,12 @@
  * It parses pipeline definitions from PHP, executes each step by making MCP calls
  * to registered tool handlers, manages data flow, handles conditional logic,
  * and integrates advanced features like GraphRAG and automated context logging.
+ *
+ * A run's steps form a dependency graph (see pipeline_plan()). Steps whose
+ * inputs are ready run at once, each in its own Fiber: their MCP calls park
+ * in the native scheduler (include/poll/scheduler.h) and share the pooled,
+ * multiplexed connections, so a run takes as long as its critical path
+ * rather than the sum of its steps.
  */
 
 #include "php_quicpro.h"
@@ -15,23 +21,70 @@
 #include "mcp.h"
 #include "cancel.h"
 #include "proto_internal.h" /* For direct access to compiled schema structs */
+#include "iibin/iibin_internal.h" /* Decodes tool responses */
+#include "config/mcp_and_orchestrator/base_layer.h"
+#include "pipeline_orchestrator/step_cache.h" /* Replies of tools registered with 'cache' */
+#include "pipeline_orchestrator/prewarm.h" /* Warm executors of tools registered with 'prewarm' */
+#include "pipeline_orchestrator/checkpoint.h" /* Step outputs of runs given a 'run_id' */
+#include "pipeline_orchestrator/retry_budget.h" /* Calls failed in transit, tried again */
+#include "server/open_telemetry.h" /* A span per tool call, around the MCP client's own */
+#include "semantic_geometry/index.h" /* RAG from an index shared in process ('local_index') */
 
 #include <zend_API.h>
 #include <zend_exceptions.h>
 #include <zend_hash.h>
+#include <zend_smart_str.h>
+#if PHP_VERSION_ID >= 80100
+#include <zend_fibers.h>
+#endif
+#include <string.h>
+#include <time.h>
+
+#include "poll/scheduler.h" /* Drives the steps' Fibers */
 
 /* --- Global Orchestrator Settings --- */
 static zend_bool g_auto_logging_enabled = 0;
 static quicpro_mcp_target_config_t *g_logger_agent_target = NULL;
+
+/*
+ * Automated context logging: events wait in this worker's ring until a
+ * batch is due, then go to the logger agent in one call (see
+ * pipeline_log_flush()). A worker is one thread, so the ring needs no lock.
+ */
+static struct {
+    zval        *ring;                /* Capacity mask + 1, a power of two */
+    uint32_t     mask;
+    uint32_t     head, tail;          /* Free-running; tail - head events are buffered */
+    uint32_t     batch_size;
+    zend_long    flush_interval_ms;
+    zend_long    first_ms;            /* When the oldest buffered event came in */
+    char        *batch_schema;
+    zend_string *events_field;
+} g_log;
+
+/* Per worker, for quicpro_pipeline_orchestrator_get_stats(); kept across reconfiguration */
+static ZEND_TLS struct {
+    zend_long dropped, sent, lost, batches_sent, batches_failed;
+} g_log_stats;
+static zend_long g_log_next_run_id;
 /* Further global settings (e.g., default RAG provider) could be defined here */
 
 /* --- Static Helper Function Prototypes --- */
-static int execute_pipeline_c(zval *initial_data_zval, zval *pipeline_def_php_array, zval *exec_options_php_array, zval *return_value);
-static int execute_step_c(HashTable *execution_context, zval *step_def_php_array, zend_bool *last_condition_result);
-static zval* resolve_input_source_value(const char *source_path, size_t source_path_len, zval *initial_data, HashTable *execution_context);
+static quicpro_pipeline_plan_t *pipeline_compile(HashTable *pipeline_def);
+static void pipeline_plan_free(quicpro_pipeline_plan_t *plan);
+static int execute_pipeline_c(zval *initial_data_zval, const quicpro_pipeline_plan_t *plan, zval *exec_options_php_array, zval *return_value);
 static int execute_rag_sub_call(const quicpro_tool_handler_config_t* tool_handler, HashTable *step_params, HashTable *execution_context, zval *rag_context_out);
-static int execute_mcp_call(const quicpro_mcp_target_config_t *target, zval *request_payload_zval, const char* input_schema_name, const char* output_schema_name, zval *response_out);
-static void log_pipeline_event(const char *event_type, HashTable *event_data);
+static int execute_mcp_call(const quicpro_mcp_target_config_t *target, zval *request_payload_zval, const char* input_schema_name, const quicpro_iibin_compiled_schema_internal *output, zval *response_out, smart_str *stream);
+static int decode_mcp_reply(const quicpro_iibin_compiled_schema_internal *output, zend_string *reply, zval *response_out);
+static void log_pipeline_event(const char *event_type, zval *event);
+static void pipeline_log_flush(bool all);
+static void pipeline_log_free(void);
+
+static zend_long mcp_call_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (zend_long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
 /* --- Lifecycle and Configuration Functions --- */
 
@@ -42,28 +95,99 @@ int quicpro_pipeline_orchestrator_init_settings(void) {
 }
 
 void quicpro_pipeline_orchestrator_shutdown_settings(void) {
-    if (g_logger_agent_target) {
-        // Proper cleanup for the target config struct
-        efree(g_logger_agent_target->host);
-        efree(g_logger_agent_target->service_name);
-        efree(g_logger_agent_target->method_name);
-        zval_ptr_dtor(&g_logger_agent_target->mcp_client_options_php_array);
-        efree(g_logger_agent_target);
-        g_logger_agent_target = NULL;
+    pipeline_log_free();
+}
+
+void quicpro_pipeline_orchestrator_rshutdown(void) {
+    /* What is still buffered goes out now; the events are request memory */
+    pipeline_log_flush(true);
+    pipeline_log_free();
+    quicpro_prewarm_rshutdown();
+}
+
+static void pipeline_prewarm_tool(quicpro_tool_handler_config_t *handler, void *arg) {
+    if (handler->mcp_target.prewarm) {
+        *(uint32_t *)arg += quicpro_prewarm_tick(&handler->mcp_target);
+    }
+}
+
+uint32_t quicpro_pipeline_orchestrator_prewarm(void) {
+    uint32_t started = 0;
+    quicpro_tool_handler_foreach(pipeline_prewarm_tool, &started);
+    return started;
+}
+
+/* A positive integer option of the logger config, or `fallback` without one. */
+static int pipeline_log_option(HashTable *ht, const char *key, size_t key_len, zend_long fallback, zend_long *out) {
+    zval *zv = zend_hash_str_find(ht, key, key_len);
+    if (!zv) {
+        *out = fallback;
+        return SUCCESS;
     }
+    if (Z_TYPE_P(zv) != IS_LONG || Z_LVAL_P(zv) <= 0 || Z_LVAL_P(zv) > (1 << 24)) {
+        throw_pipeline_error_as_php_exception(0, "Auto context logging: '%s' must be a positive integer.", key);
+        return FAILURE;
+    }
+    *out = Z_LVAL_P(zv);
+    return SUCCESS;
 }
 
+/*
+ * ['mcp_target' => [...], 'batch_proto_schema' => 'LogBatch'] and
+ * optionally 'events_field' ('events'), 'batch_size' (100),
+ * 'flush_interval_ms' (1000), 'buffer_size' (4096 events) and
+ * 'enable_auto_log' (true). A new configuration flushes the old one's
+ * events first; 'enable_auto_log' => false only does that.
+ */
 int quicpro_pipeline_orchestrator_configure_auto_logging_from_php(zval *logger_config_php_array) {
-    /* TODO: Parse the logger_config_php_array and populate g_logger_agent_target */
-    /* This involves deep parsing of the array and allocating/populating the C structs */
-    /* For now, just enable the flag as a placeholder */
-    zval *zv_enable = zend_hash_str_find(Z_ARRVAL_P(logger_config_php_array), "enable_auto_log", sizeof("enable_auto_log") - 1);
-    if (zv_enable && zend_is_true(zv_enable)) {
-        g_auto_logging_enabled = 1;
-        /* ... parse mcp_target, batch_size etc. and store in global static variables ... */
-    } else {
-        g_auto_logging_enabled = 0;
+    HashTable *ht = Z_ARRVAL_P(logger_config_php_array);
+    zval *zv;
+
+    pipeline_log_flush(true);
+    pipeline_log_free();
+    zv = zend_hash_str_find(ht, "enable_auto_log", sizeof("enable_auto_log") - 1);
+    if (zv && !zend_is_true(zv)) {
+        return SUCCESS;
+    }
+
+    zend_long batch_size, interval_ms, buffer_size;
+    if (pipeline_log_option(ht, "batch_size", sizeof("batch_size") - 1, 100, &batch_size) == FAILURE
+        || pipeline_log_option(ht, "flush_interval_ms", sizeof("flush_interval_ms") - 1, 1000, &interval_ms) == FAILURE
+        || pipeline_log_option(ht, "buffer_size", sizeof("buffer_size") - 1, 4096, &buffer_size) == FAILURE) {
+        return FAILURE;
+    }
+    zval *zv_schema = zend_hash_str_find(ht, "batch_proto_schema", sizeof("batch_proto_schema") - 1);
+    if (!zv_schema || Z_TYPE_P(zv_schema) != IS_STRING || !get_compiled_iibin_schema_internal(Z_STRVAL_P(zv_schema))) {
+        throw_pipeline_error_as_php_exception(0, "Auto context logging needs 'batch_proto_schema', the name of a defined IIBIN schema.");
+        return FAILURE;
     }
+    zval *zv_field = zend_hash_str_find(ht, "events_field", sizeof("events_field") - 1);
+    if (zv_field && Z_TYPE_P(zv_field) != IS_STRING) {
+        throw_pipeline_error_as_php_exception(0, "Auto context logging: 'events_field' must be a string.");
+        return FAILURE;
+    }
+    if (!(zv = zend_hash_str_find(ht, "mcp_target", sizeof("mcp_target") - 1)) || Z_TYPE_P(zv) != IS_ARRAY) {
+        throw_pipeline_error_as_php_exception(0, "Auto context logging needs an 'mcp_target' array.");
+        return FAILURE;
+    }
+    g_logger_agent_target = ecalloc(1, sizeof(quicpro_mcp_target_config_t));
+    if (quicpro_mcp_target_parse(Z_ARRVAL_P(zv), g_logger_agent_target, "the event logger") == FAILURE) {
+        pipeline_log_free();
+        return FAILURE;
+    }
+
+    uint32_t capacity = 1;
+    while (capacity < (uint32_t)MAX(buffer_size, batch_size)) {
+        capacity <<= 1;
+    }
+    g_log.ring = ecalloc(capacity, sizeof(zval));
+    g_log.mask = capacity - 1;
+    g_log.head = g_log.tail = 0;
+    g_log.batch_size = (uint32_t)batch_size;
+    g_log.flush_interval_ms = interval_ms;
+    g_log.batch_schema = estrndup(Z_STRVAL_P(zv_schema), Z_STRLEN_P(zv_schema));
+    g_log.events_field = zv_field ? zend_string_copy(Z_STR_P(zv_field)) : zend_string_init("events", sizeof("events") - 1, 0);
+    g_auto_logging_enabled = 1;
     return SUCCESS;
 }
 
@@ -78,22 +202,57 @@ int quicpro_pipeline_orchestrator_register_tool_handler_from_php(const char *too
 PHP_FUNCTION(quicpro_pipeline_orchestrator_run)
 {
     zval *initial_data_zval;
-    zval *pipeline_def_php_array;
+    zval *pipeline_def;
     zval *exec_options_php_array = NULL;
 
     ZEND_PARSE_PARAMETERS_START(2, 3)
         Z_PARAM_ZVAL(initial_data_zval)
-        Z_PARAM_ARRAY(pipeline_def_php_array)
+        Z_PARAM_ZVAL(pipeline_def)
         Z_PARAM_OPTIONAL
         Z_PARAM_ARRAY_OR_NULL(exec_options_php_array)
     ZEND_PARSE_PARAMETERS_END();
 
+    /* A plan from quicpro_pipeline_orchestrator_compile(), or a definition compiled for this run alone */
+    quicpro_pipeline_plan_t *plan, *own_plan = NULL;
+    if (Z_TYPE_P(pipeline_def) == IS_RESOURCE) {
+        plan = zend_fetch_resource(Z_RES_P(pipeline_def), "quicpro_pipeline_plan", le_quicpro_pipeline_plan);
+        if (!plan) {
+            RETURN_FALSE;
+        }
+    } else if (Z_TYPE_P(pipeline_def) == IS_ARRAY) {
+        plan = own_plan = pipeline_compile(Z_ARRVAL_P(pipeline_def));
+        if (!plan) {
+            RETURN_FALSE;
+        }
+    } else {
+        throw_pipeline_error_as_php_exception(0, "Pipeline definition must be an array or a compiled pipeline plan.");
+        RETURN_FALSE;
+    }
+
+    /*
+     * The pipeline's budget covers all of its hops: every tool call ends by
+     * then, and tells its agent how much of it is left (quicpro-timeout-ms).
+     */
+    zend_long pipeline_timeout_ms = quicpro_mcp_orchestrator_config.orchestrator_default_pipeline_timeout_ms;
+    zval *zv_timeout = exec_options_php_array ? zend_hash_str_find(Z_ARRVAL_P(exec_options_php_array), "timeout_ms", sizeof("timeout_ms") - 1) : NULL;
+    if (zv_timeout && Z_TYPE_P(zv_timeout) == IS_LONG) {
+        pipeline_timeout_ms = Z_LVAL_P(zv_timeout);
+    }
+    zend_long outer_deadline = pipeline_timeout_ms > 0 ? quicpro_mcp_deadline_enter(pipeline_timeout_ms) : 0;
+
     /*
      * The `execute_pipeline_c` function contains the core orchestration logic.
      * It takes PHP zvals, performs the C-native execution, and populates the
      * PHP return_value zval directly.
      */
-    if (execute_pipeline_c(initial_data_zval, pipeline_def_php_array, exec_options_php_array, return_value) == FAILURE) {
+    int result = execute_pipeline_c(initial_data_zval, plan, exec_options_php_array, return_value);
+    if (pipeline_timeout_ms > 0) {
+        quicpro_mcp_deadline_leave(outer_deadline);
+    }
+    if (own_plan) {
+        pipeline_plan_free(own_plan);
+    }
+    if (result == FAILURE) {
         /*
          * If the orchestrator itself fails critically, an exception has likely been thrown.
          * If not, we should return false. If return_value was partially built,
@@ -106,6 +265,68 @@ PHP_FUNCTION(quicpro_pipeline_orchestrator_run)
     }
 }
 
+/*
+ * Validates a pipeline definition once and returns it compiled, for any
+ * number of quicpro_pipeline_orchestrator_run() calls. The tools it uses
+ * must be registered, and their schemas defined, by then.
+ */
+PHP_FUNCTION(quicpro_pipeline_orchestrator_compile)
+{
+    zval *pipeline_def_php_array;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY(pipeline_def_php_array)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_pipeline_plan_t *plan = pipeline_compile(Z_ARRVAL_P(pipeline_def_php_array));
+    if (!plan) {
+        RETURN_FALSE;
+    }
+    RETURN_RES(zend_register_resource(plan, le_quicpro_pipeline_plan));
+}
+
+/* Sends the warm-ups the tools registered with 'prewarm' need now; returns how many started. */
+PHP_FUNCTION(quicpro_pipeline_orchestrator_prewarm)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    RETURN_LONG(quicpro_pipeline_orchestrator_prewarm());
+}
+
+static void pipeline_prewarm_stats(quicpro_tool_handler_config_t *handler, void *arg) {
+    if (handler->mcp_target.prewarm) {
+        zval stats;
+        quicpro_prewarm_stats(handler->mcp_target.prewarm, &stats);
+        add_assoc_zval((zval *)arg, handler->tool_name, &stats);
+    }
+}
+
+/*
+ * This worker's orchestrator counters: the step cache's (see
+ * pipeline_orchestrator/step_cache.h) and the event log's. Dropped events
+ * found the ring full, lost ones were in a batch the logger did not take.
+ * 'prewarm' holds, per tool registered with it, its executors and
+ * warm-ups (pipeline_orchestrator/prewarm.h).
+ */
+PHP_FUNCTION(quicpro_pipeline_orchestrator_get_stats)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    array_init(return_value);
+    quicpro_step_cache_add_stats(return_value);
+    add_assoc_long(return_value, "log_events_buffered", g_log.ring ? (zend_long)(g_log.tail - g_log.head) : 0);
+    add_assoc_long(return_value, "log_events_sent", g_log_stats.sent);
+    add_assoc_long(return_value, "log_events_dropped", g_log_stats.dropped);
+    add_assoc_long(return_value, "log_events_lost", g_log_stats.lost);
+    add_assoc_long(return_value, "log_batches_sent", g_log_stats.batches_sent);
+    add_assoc_long(return_value, "log_batches_failed", g_log_stats.batches_failed);
+
+    zval prewarm;
+    array_init(&prewarm);
+    quicpro_tool_handler_foreach(pipeline_prewarm_stats, &prewarm);
+    add_assoc_zval(return_value, "prewarm", &prewarm);
+}
+
 PHP_FUNCTION(quicpro_pipeline_orchestrator_register_tool) { /* Maps to registerToolHandler */
     char *tool_name;
     size_t tool_name_len;
@@ -134,192 +355,1500 @@ PHP_FUNCTION(quicpro_pipeline_orchestrator_configure_logging) {
 }
 
 
-/* --- Core Orchestration C Logic --- */
+/* --- Compiled Pipeline Plans --- */
 
-static int execute_pipeline_c(zval *initial_data_zval, zval *pipeline_def_php_array, zval *exec_options_php_array, zval *return_value) {
-    zval step_results_array;
-    HashTable *execution_context;
-    zend_bool last_condition_result = 1; /* Assume initial condition is true */
+/*
+ * A pipeline definition is compiled once into a flat plan: every step's
+ * tool handler and output schema resolved, its input map split into a
+ * source and the keys below it, its params renamed through the handler's
+ * param_map, and its dependencies turned into step indices. A run only
+ * reads the plan, so one plan serves any number of runs, concurrent ones
+ * included. quicpro_pipeline_orchestrator_compile() hands it to PHP as a
+ * resource; a definition passed to a run as an array is compiled for that
+ * run alone.
+ *
+ * The steps form a dependency graph. A step waits for the steps its
+ * 'input_map' reads ('@step_id.output...'), those its 'depends_on' names
+ * (a step ID or a list of them), and, with 'condition_true_only', the step
+ * before it, whose condition it takes. A step's ID is its 'id', or else
+ * its tool name. Only earlier steps can be named, so the array order is a
+ * topological order and a pipeline cannot hold a cycle.
+ *
+ * A ForEach step ('foreach' => '@source.path', or a literal list) calls its
+ * tool once per batch of the list's items: with 'batch_size' 1 (the
+ * default) each call carries one item under 'item_field' ('item'), with
+ * more a call carries up to that many under 'items_field' ('items') and its
+ * reply holds one result per item, in order, under 'results_field'
+ * ('results'). The step counts as one against the run's cap; its batches
+ * run concurrently within its own 'max_concurrency' (default
+ * quicpro.orchestrator_loop_concurrency_default), and its output is the
+ * list of results in item order.
+ */
+int le_quicpro_pipeline_plan;
 
-    /* The execution_context will store results of steps: ['step_id' => [output_data]] */
-    ALLOC_HASHTABLE(execution_context);
-    zend_hash_init(execution_context, 8, NULL, ZVAL_PTR_DTOR, 0);
+enum { INPUT_LITERAL, INPUT_INITIAL, INPUT_STEP };
 
-    /* Initialize the result object/array that will be returned to PHP */
-    /* This could be a specific Quicpro\PipelineResult object or a simple array */
-    array_init(return_value);
+/* One 'target_field' => source of a step's input_map */
+typedef struct {
+    zend_string  *field;
+    uint8_t       source;             /* INPUT_* */
+    uint32_t      step;               /* INPUT_STEP: the step whose output it reads */
+    zend_string **keys;               /* Walked down from the source */
+    uint32_t      nkeys;
+    zval          literal;            /* INPUT_LITERAL */
+} pipeline_input_t;
 
-    zval *step_def_zval;
-    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(pipeline_def_php_array), step_def_zval) {
-        if (Z_TYPE_P(step_def_zval) != IS_ARRAY) {
-            zend_hash_destroy(execution_context); FREE_HASHTABLE(execution_context);
-            throw_pipeline_error_as_php_exception(0, "Pipeline definition invalid: each step must be an array.");
-            return FAILURE;
+typedef struct {
+    zend_string      *id;
+    const quicpro_tool_handler_config_t *handler;                 /* Registered tools stay until shutdown */
+    const quicpro_iibin_compiled_schema_internal *input_schema;   /* NULL: the payload as it is */
+    const quicpro_iibin_compiled_schema_internal *output_schema;  /* NULL: the reply as it came */
+    uint32_t         *deps;           /* Indices of earlier steps */
+    uint32_t          ndeps;
+    pipeline_input_t *inputs;
+    uint32_t          ninputs;
+    zval              params;         /* Under the handler's param_map names; UNDEF without */
+    zval              rag_params;     /* As written, for the RAG sub-call; UNDEF unless it is enabled */
+    zend_bool         condition_true_only;
+    zend_bool         conditional;    /* A ConditionalLogic step, which sets the condition */
+
+    /* ForEach */
+    zend_bool         foreach;
+    pipeline_input_t  items;          /* The list mapped over */
+    uint32_t          batch_size;     /* Items per call; 1: one under item_field */
+    uint32_t          batch_concurrency; /* Calls in flight at once; 0: orchestrator_loop_concurrency_default */
+    zend_string      *item_field;
+    zend_string      *items_field;
+    zend_string      *results_field;
+
+    /* Streaming: a ForEach over the records of a reply still arriving */
+    zend_bool         streaming;
+    uint32_t          stream_from;    /* The step whose reply it maps over */
+    zend_string      *stream_delimiter;
+    zend_bool         streamed;       /* A later step streams from this one */
+} pipeline_step_t;
+
+struct _quicpro_pipeline_plan_t {
+    pipeline_step_t *steps;
+    uint32_t         count;
+};
+
+/* A run of a plan: what its steps have done so far. */
+enum { STEP_WAITING, STEP_RUNNING, STEP_DONE, STEP_FAILED };
+
+typedef struct {
+    uint8_t      state;
+    zend_bool    condition;           /* last_condition_result once the step is done */
+    zend_bool    logged;              /* Its end went to the event log */
+    zend_long    started_ms;          /* With auto context logging */
+    zval         fiber;               /* UNDEF unless the step runs in one */
+
+    /* ForEach, once the step started */
+    zval         items;               /* As a list */
+    zval         results;             /* One per item, in item order */
+    zval        *batch_fibers;        /* Per batch; UNDEF unless it runs in one */
+    uint8_t     *batch_done;
+    uint32_t     batches;
+    uint32_t     next_batch;          /* The next to start */
+    uint32_t     batches_running;
+    uint32_t     batches_finished;
+    uint32_t     reaped;              /* Batches before this one have released their Fibers */
+
+    /* Streaming */
+    smart_str    streamed;            /* Streamed from: its reply so far */
+    size_t       stream_pos;          /* Streaming: bytes of the source's reply taken as items */
+    uint32_t     batch_cap;           /* Streaming: slots in batch_fibers and batch_done */
+    zend_bool    stream_closed;       /* Streaming: the source is done and all of it taken */
+} pipeline_task_t;
+
+typedef struct {
+    const quicpro_pipeline_plan_t *plan;
+    pipeline_task_t *tasks;
+    uint32_t         running;
+    HashTable       *context;
+    zval            *initial_data;
+    zend_long        id;              /* Names the run in logged events */
+    zend_string    **checkpoints;     /* Per step, its checkpoint key; NULL without a 'run_id' */
+} pipeline_run_t;
+
+static int execute_step_c(pipeline_run_t *run, uint32_t i);
+
+/* The run a step's Fiber belongs to, read by the Fiber as it starts */
+static ZEND_TLS pipeline_run_t *pipeline_starting;
+
+static int pipeline_dep_add(quicpro_pipeline_plan_t *plan, uint32_t self, const char *id, size_t id_len) {
+    pipeline_step_t *step = &plan->steps[self];
+    for (uint32_t j = self; j-- > 0; ) {
+        zend_string *candidate = plan->steps[j].id;
+        if (ZSTR_LEN(candidate) == id_len && memcmp(ZSTR_VAL(candidate), id, id_len) == 0) {
+            step->deps = erealloc(step->deps, (step->ndeps + 1) * sizeof(uint32_t));
+            step->deps[step->ndeps++] = j;
+            return SUCCESS;
         }
+    }
+    throw_pipeline_error_as_php_exception(0, "Pipeline step '%s' refers to '%.*s', which is not an earlier step.", ZSTR_VAL(step->id), (int)id_len, id);
+    return FAILURE;
+}
 
-        /* Here we pass a pointer to `execution_context` so steps can add results to it.
-         * We also pass `initial_data_zval` for resolving '@initial.*' mappings.
-         */
-        if (execute_step_c(execution_context, step_def_zval, &last_condition_result) == FAILURE) {
-            /* An exception was thrown inside execute_step_c. Populate error info. */
-            add_assoc_bool(return_value, "isSuccess", 0);
-            /* TODO: Populate error message from the exception or internal state */
-            zend_hash_destroy(execution_context); FREE_HASHTABLE(execution_context);
+/*
+ * '@initial[.key...]' reads the run's initial data; '@step_id.output[.key...]'
+ * (or '@step_id[.key...]') the output of that step, which the step then
+ * depends on. Anything else is a literal.
+ */
+static int pipeline_input_compile(quicpro_pipeline_plan_t *plan, uint32_t self, zend_string *field, zval *source, pipeline_input_t *in) {
+    in->field = field ? zend_string_copy(field) : NULL;
+    if (Z_TYPE_P(source) != IS_STRING || Z_STRLEN_P(source) < 2 || Z_STRVAL_P(source)[0] != '@') {
+        in->source = INPUT_LITERAL;
+        ZVAL_COPY(&in->literal, source);
+        return SUCCESS;
+    }
+
+    const char *part = Z_STRVAL_P(source) + 1, *end = Z_STRVAL_P(source) + Z_STRLEN_P(source);
+    const char *dot = memchr(part, '.', end - part);
+    size_t len = dot ? (size_t)(dot - part) : (size_t)(end - part);
+    if (len == sizeof("initial") - 1 && memcmp(part, "initial", len) == 0) {
+        in->source = INPUT_INITIAL;
+    } else {
+        if (pipeline_dep_add(plan, self, part, len) == FAILURE) {
             return FAILURE;
         }
-    } ZEND_HASH_FOREACH_END();
+        in->source = INPUT_STEP;
+        in->step = plan->steps[self].deps[plan->steps[self].ndeps - 1];
+        if (dot && end - dot > 6 && memcmp(dot + 1, "output", 6) == 0 && (dot + 7 == end || dot[7] == '.')) {
+            dot = dot + 7 == end ? NULL : dot + 7;
+        }
+    }
 
-    /* Finalize result */
-    add_assoc_bool(return_value, "isSuccess", 1);
+    while (dot) {
+        part = dot + 1;
+        dot = memchr(part, '.', end - part);
+        len = dot ? (size_t)(dot - part) : (size_t)(end - part);
+        in->keys = erealloc(in->keys, (in->nkeys + 1) * sizeof(zend_string *));
+        in->keys[in->nkeys++] = zend_string_init(part, len, 0);
+    }
+    return SUCCESS;
+}
 
-    /* Add step outputs to the final result for debugging/access */
-    ZVAL_ARR(return_value, zend_hash_copy(execution_context, Z_ARRVAL_P(return_value), (copy_ctor_func_t)zval_add_ref));
-    add_assoc_string(return_value, "finalMessage", "Pipeline completed successfully.");
+static void pipeline_input_free(pipeline_input_t *in) {
+    if (in->field) {
+        zend_string_release(in->field);
+    }
+    for (uint32_t k = 0; k < in->nkeys; k++) {
+        zend_string_release(in->keys[k]);
+    }
+    if (in->keys) {
+        efree(in->keys);
+    }
+    zval_ptr_dtor(&in->literal);
+}
 
-    zend_hash_destroy(execution_context);
-    FREE_HASHTABLE(execution_context);
+/* A ForEach step's positive integer option; `fallback` without it. */
+static int pipeline_foreach_count(HashTable *ht, const char *key, size_t key_len, zend_string *step_id, zend_long fallback, uint32_t *out) {
+    zval *zv = zend_hash_str_find(ht, key, key_len);
+    zend_long value = fallback;
+    if (zv) {
+        if (Z_TYPE_P(zv) != IS_LONG || Z_LVAL_P(zv) < 1 || Z_LVAL_P(zv) > UINT32_MAX) {
+            throw_pipeline_error_as_php_exception(0, "ForEach step '%s': '%s' must be a positive integer.", ZSTR_VAL(step_id), key);
+            return FAILURE;
+        }
+        value = Z_LVAL_P(zv);
+    }
+    *out = (uint32_t)value;
+    return SUCCESS;
+}
+
+/* A ForEach step's field name option; `fallback` without it. */
+static int pipeline_foreach_field(HashTable *ht, const char *key, size_t key_len, zend_string *step_id, const char *fallback, zend_string **out) {
+    zval *zv = zend_hash_str_find(ht, key, key_len);
+    if (zv && (Z_TYPE_P(zv) != IS_STRING || Z_STRLEN_P(zv) == 0)) {
+        throw_pipeline_error_as_php_exception(0, "ForEach step '%s': '%s' must be a field name.", ZSTR_VAL(step_id), key);
+        return FAILURE;
+    }
+    *out = zv ? zend_string_copy(Z_STR_P(zv)) : zend_string_init(fallback, strlen(fallback), 0);
     return SUCCESS;
 }
 
 /*
- * Executes a single step of the pipeline.
- * This is the most complex function, orchestrating RAG, input mapping, MCP calls, etc.
+ * A step with 'stream_from' => 'StepId' maps its tool over the records of
+ * that step's reply while it is still arriving: records end at
+ * 'stream_delimiter' ("\n" by default), empty ones are skipped, and a
+ * batch goes out as soon as it is full (the last one when the reply is
+ * complete). The source is an earlier step that is not a ForEach, and it
+ * keeps its own output; the streaming step's output is a ForEach's.
  */
-static int execute_step_c(HashTable *execution_context, zval *step_def_php_array, zend_bool *last_condition_result) {
-    zval *zv_temp;
-    char *tool_name = NULL;
+static int pipeline_stream_compile(quicpro_pipeline_plan_t *plan, uint32_t self, HashTable *ht, zval *source) {
+    pipeline_step_t *step = &plan->steps[self];
+    if (zend_hash_str_exists(ht, "foreach", sizeof("foreach") - 1) || Z_TYPE_P(source) != IS_STRING) {
+        throw_pipeline_error_as_php_exception(0, "Step '%s': 'stream_from' names one earlier step, and takes no 'foreach'.", ZSTR_VAL(step->id));
+        return FAILURE;
+    }
+    uint32_t j = self;
+    while (j > 0 && !zend_string_equals(plan->steps[j - 1].id, Z_STR_P(source))) {
+        j--;
+    }
+    if (j-- == 0 || plan->steps[j].foreach) {
+        throw_pipeline_error_as_php_exception(0, "Step '%s' streams from '%s', which is not an earlier step with a single tool call.",
+                                              ZSTR_VAL(step->id), Z_STRVAL_P(source));
+        return FAILURE;
+    }
+    step->streaming = 1;
+    step->stream_from = j;
+    plan->steps[j].streamed = 1;
 
-    /* Check conditional execution flag */
-    if ((zv_temp = zend_hash_str_find(Z_ARRVAL_P(step_def_php_array), "condition_true_only", sizeof("condition_true_only") - 1)) && zend_is_true(zv_temp)) {
-        if (!(*last_condition_result)) {
-            /* This step is skipped */
-            /* TODO: Log this skip event */
-            return SUCCESS;
-        }
+    zval *zv = zend_hash_str_find(ht, "stream_delimiter", sizeof("stream_delimiter") - 1);
+    if (zv && (Z_TYPE_P(zv) != IS_STRING || Z_STRLEN_P(zv) == 0)) {
+        throw_pipeline_error_as_php_exception(0, "Step '%s': 'stream_delimiter' must be a non-empty string.", ZSTR_VAL(step->id));
+        return FAILURE;
     }
+    step->stream_delimiter = zv ? zend_string_copy(Z_STR_P(zv)) : zend_string_init("\n", 1, 0);
+    return SUCCESS;
+}
 
-    /* Get tool name */
-    if (!(zv_temp = zend_hash_str_find(Z_ARRVAL_P(step_def_php_array), "tool", sizeof("tool") - 1)) || Z_TYPE_P(zv_temp) != IS_STRING) {
+static int pipeline_compile_step(quicpro_pipeline_plan_t *plan, zval *step_def_zval) {
+    ZVAL_DEREF(step_def_zval);
+    if (Z_TYPE_P(step_def_zval) != IS_ARRAY) {
+        throw_pipeline_error_as_php_exception(0, "Pipeline definition invalid: each step must be an array.");
+        return FAILURE;
+    }
+    HashTable *ht = Z_ARRVAL_P(step_def_zval);
+    zval *zv_tool = zend_hash_str_find(ht, "tool", sizeof("tool") - 1);
+    if (!zv_tool || Z_TYPE_P(zv_tool) != IS_STRING) {
         throw_pipeline_error_as_php_exception(0, "Pipeline step is missing a valid 'tool' name string.");
         return FAILURE;
     }
-    tool_name = Z_STRVAL_P(zv_temp);
+    zval *zv_id = zend_hash_str_find(ht, "id", sizeof("id") - 1);
+    if (!zv_id || Z_TYPE_P(zv_id) != IS_STRING) {
+        zv_id = zv_tool;
+    }
+
+    uint32_t i = plan->count++;
+    pipeline_step_t *step = &plan->steps[i];
+    step->id = zend_string_copy(Z_STR_P(zv_id));
+    step->conditional = zend_string_equals_literal(Z_STR_P(zv_tool), "ConditionalLogic");
 
     /* Fetch the registered handler configuration for this tool */
-    const quicpro_tool_handler_config_t *tool_handler = quicpro_tool_handler_get(tool_name);
+    const quicpro_tool_handler_config_t *tool_handler = quicpro_tool_handler_get(Z_STRVAL_P(zv_tool));
     if (!tool_handler) {
-        throw_pipeline_error_as_php_exception(0, "No handler registered for tool '%s'.", tool_name);
+        throw_pipeline_error_as_php_exception(0, "No handler registered for tool '%s'.", Z_STRVAL_P(zv_tool));
         return FAILURE;
     }
+    step->handler = tool_handler;
+    if (tool_handler->input_proto_schema) {
+        step->input_schema = get_compiled_iibin_schema_internal(tool_handler->input_proto_schema);
+        if (!step->input_schema) {
+            throw_pipeline_error_as_php_exception(0, "Tool '%s' sends IIBIN schema '%s', which is not defined.", Z_STRVAL_P(zv_tool), tool_handler->input_proto_schema);
+            return FAILURE;
+        }
+    }
+    if (tool_handler->output_proto_schema) {
+        step->output_schema = get_compiled_iibin_schema_internal(tool_handler->output_proto_schema);
+        if (!step->output_schema) {
+            throw_pipeline_error_as_php_exception(0, "Tool '%s' replies with IIBIN schema '%s', which is not defined.", Z_STRVAL_P(zv_tool), tool_handler->output_proto_schema);
+            return FAILURE;
+        }
+    }
 
-    zval *step_params = zend_hash_str_find(Z_ARRVAL_P(step_def_php_array), "params", sizeof("params") - 1);
-    zval rag_context; ZVAL_NULL(&rag_context);
-    int rag_result = SUCCESS;
-
-    /* RAG sub-pipeline execution, if configured and enabled */
-    if (tool_handler->rag_config) {
-        zend_bool use_rag = 0;
-        if (step_params && (zv_temp = zend_hash_str_find(Z_ARRVAL_P(step_params), tool_handler->rag_config->enabled_param_key, strlen(tool_handler->rag_config->enabled_param_key)))) {
-            use_rag = zend_is_true(zv_temp);
-        }
-        if (use_rag) {
-            rag_result = execute_rag_sub_call(tool_handler, Z_ARRVAL_P(step_params), execution_context, &rag_context);
-            if (rag_result == FAILURE) {
-                return FAILURE; /* Error already thrown */
+    zval *zv, *source;
+    zend_string *key;
+    if ((zv = zend_hash_str_find(ht, "input_map", sizeof("input_map") - 1)) && Z_TYPE_P(zv) == IS_ARRAY) {
+        step->inputs = ecalloc(MAX(zend_hash_num_elements(Z_ARRVAL_P(zv)), 1), sizeof(pipeline_input_t));
+        ZEND_HASH_FOREACH_STR_KEY_VAL(Z_ARRVAL_P(zv), key, source) {
+            if (key && pipeline_input_compile(plan, i, key, source, &step->inputs[step->ninputs++]) == FAILURE) {
+                return FAILURE;
             }
+        } ZEND_HASH_FOREACH_END();
+    }
+    if ((zv = zend_hash_str_find(ht, "depends_on", sizeof("depends_on") - 1))) {
+        if (Z_TYPE_P(zv) == IS_STRING && pipeline_dep_add(plan, i, Z_STRVAL_P(zv), Z_STRLEN_P(zv)) == FAILURE) {
+            return FAILURE;
+        }
+        if (Z_TYPE_P(zv) == IS_ARRAY) {
+            ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(zv), source) {
+                if (Z_TYPE_P(source) == IS_STRING && pipeline_dep_add(plan, i, Z_STRVAL_P(source), Z_STRLEN_P(source)) == FAILURE) {
+                    return FAILURE;
+                }
+            } ZEND_HASH_FOREACH_END();
+        }
+    }
+    if ((zv = zend_hash_str_find(ht, "condition_true_only", sizeof("condition_true_only") - 1)) && zend_is_true(zv)) {
+        step->condition_true_only = 1;
+        if (i > 0) {
+            step->deps = erealloc(step->deps, (step->ndeps + 1) * sizeof(uint32_t));
+            step->deps[step->ndeps++] = i - 1;
+        }
+    }
+    zval *zv_stream = zend_hash_str_find(ht, "stream_from", sizeof("stream_from") - 1);
+    if ((zv = zend_hash_str_find(ht, "foreach", sizeof("foreach") - 1)) || zv_stream) {
+        step->foreach = 1;
+        if ((zv_stream ? pipeline_stream_compile(plan, i, ht, zv_stream) : pipeline_input_compile(plan, i, NULL, zv, &step->items)) == FAILURE
+            || pipeline_foreach_count(ht, "batch_size", sizeof("batch_size") - 1, step->id, 1, &step->batch_size) == FAILURE
+            || pipeline_foreach_field(ht, "item_field", sizeof("item_field") - 1, step->id, "item", &step->item_field) == FAILURE
+            || pipeline_foreach_field(ht, "items_field", sizeof("items_field") - 1, step->id, "items", &step->items_field) == FAILURE
+            || pipeline_foreach_field(ht, "results_field", sizeof("results_field") - 1, step->id, "results", &step->results_field) == FAILURE) {
+            return FAILURE;
+        }
+        if (zend_hash_str_exists(ht, "max_concurrency", sizeof("max_concurrency") - 1)
+            && pipeline_foreach_count(ht, "max_concurrency", sizeof("max_concurrency") - 1, step->id, 0, &step->batch_concurrency) == FAILURE) {
+            return FAILURE;
         }
     }
 
-    /*
-     * TODO: Implement full input mapping logic.
-     * 1. Create a new PHP array `request_payload_php_array` for the MCP call.
-     * 2. Get the step's `input_map` array.
-     * 3. For each mapping in `input_map` ('target_field' => 'source_path'):
-     * - Call `resolve_input_source_value('source_path', ...)` to get the zval.
-     * - Add it to `request_payload_php_array` with key 'target_field'.
-     * 4. If RAG was used, add the `rag_context` zval to `request_payload_php_array`
-     * using the key from `tool_handler->rag_config->target_context_field_in_llm_request`.
-     * 5. Get the step's `params` array and merge it into `request_payload_php_array`,
-     * applying the `param_map` from the tool handler.
-     */
-    zval mcp_request_payload;
-    array_init(&mcp_request_payload);
-    // Placeholder for mapping logic...
-    // add_assoc_string(&mcp_request_payload, "placeholder_input", "data");
+    /* Params go out under the names the tool handler's param_map gives them */
+    zval *step_params = zend_hash_str_find(ht, "params", sizeof("params") - 1);
+    if (step_params && Z_TYPE_P(step_params) == IS_ARRAY) {
+        zval *value;
+        array_init_size(&step->params, zend_hash_num_elements(Z_ARRVAL_P(step_params)));
+        ZEND_HASH_FOREACH_STR_KEY_VAL(Z_ARRVAL_P(step_params), key, value) {
+            if (!key) continue;
+            zval *mapped = tool_handler->param_map ? zend_hash_find(tool_handler->param_map, key) : NULL;
+            Z_TRY_ADDREF_P(value);
+            zend_hash_update(Z_ARRVAL(step->params), mapped && Z_TYPE_P(mapped) == IS_STRING ? Z_STR_P(mapped) : key, value);
+        } ZEND_HASH_FOREACH_END();
 
+        /* RAG sub-pipeline execution, if configured and enabled */
+        if (tool_handler->rag_config && tool_handler->rag_config->enabled_param_key
+            && (zv = zend_hash_str_find(Z_ARRVAL_P(step_params), tool_handler->rag_config->enabled_param_key, strlen(tool_handler->rag_config->enabled_param_key)))
+            && zend_is_true(zv)) {
+            ZVAL_COPY(&step->rag_params, step_params);
+        }
+    }
+    return SUCCESS;
+}
 
-    zval mcp_response; ZVAL_UNDEF(&mcp_response);
-    if (execute_mcp_call(&tool_handler->mcp_target, &mcp_request_payload, tool_handler->input_proto_schema, tool_handler->output_proto_schema, &mcp_response) == FAILURE) {
-        zval_ptr_dtor(&mcp_request_payload);
-        return FAILURE;
+static void pipeline_plan_free(quicpro_pipeline_plan_t *plan) {
+    for (uint32_t i = 0; i < plan->count; i++) {
+        pipeline_step_t *step = &plan->steps[i];
+        zend_string_release(step->id);
+        for (uint32_t f = 0; f < step->ninputs; f++) {
+            pipeline_input_free(&step->inputs[f]);
+        }
+        pipeline_input_free(&step->items);
+        if (step->item_field) {
+            zend_string_release(step->item_field);
+        }
+        if (step->items_field) {
+            zend_string_release(step->items_field);
+        }
+        if (step->results_field) {
+            zend_string_release(step->results_field);
+        }
+        if (step->stream_delimiter) {
+            zend_string_release(step->stream_delimiter);
+        }
+        if (step->inputs) {
+            efree(step->inputs);
+        }
+        if (step->deps) {
+            efree(step->deps);
+        }
+        zval_ptr_dtor(&step->params);
+        zval_ptr_dtor(&step->rag_params);
     }
-    zval_ptr_dtor(&mcp_request_payload);
+    efree(plan->steps);
+    efree(plan);
+}
 
+/* NULL after throwing. */
+static quicpro_pipeline_plan_t *pipeline_compile(HashTable *pipeline_def) {
+    quicpro_pipeline_plan_t *plan = ecalloc(1, sizeof(*plan));
+    plan->steps = ecalloc(MAX(zend_hash_num_elements(pipeline_def), 1), sizeof(pipeline_step_t));
 
-    /*
-     * TODO: Output mapping logic.
-     * Use `tool_handler->output_map` to transform `mcp_response` into the final step output if needed.
-     * For now, we store the direct response.
-     */
-    zend_string *step_id_key = zend_string_init(tool_name, strlen(tool_name), 0);
-    zend_hash_update(execution_context, step_id_key, &mcp_response); // zend_hash_update takes ownership
-    zend_string_release(step_id_key);
+    zval *step_def_zval;
+    ZEND_HASH_FOREACH_VAL(pipeline_def, step_def_zval) {
+        if (pipeline_compile_step(plan, step_def_zval) == FAILURE) {
+            pipeline_plan_free(plan);
+            return NULL;
+        }
+    } ZEND_HASH_FOREACH_END();
+    return plan;
+}
 
+static void pipeline_plan_dtor(zend_resource *res) {
+    if (res->ptr) {
+        pipeline_plan_free((quicpro_pipeline_plan_t *)res->ptr);
+        res->ptr = NULL;
+    }
+}
 
-    /* If this was a ConditionalLogic tool, update the last_condition_result flag */
-    if (strcmp(tool_name, "ConditionalLogic") == 0) {
-        if (Z_TYPE(mcp_response) == IS_ARRAY && (zv_temp = zend_hash_str_find(Z_ARRVAL(mcp_response), "condition_met", sizeof("condition_met")-1))) {
-            *last_condition_result = zend_is_true(zv_temp);
-        } else {
-            *last_condition_result = 0; // Default to false if condition output is invalid
+void quicpro_pipeline_plan_minit(int module_number) {
+    le_quicpro_pipeline_plan = zend_register_list_destructors_ex(
+        pipeline_plan_dtor, NULL, "quicpro_pipeline_plan", module_number);
+}
+
+/* --- Core Orchestration C Logic --- */
+
+/* The value an input reads in this run. Borrowed; NULL when a key is missing or the step was skipped. */
+static zval *pipeline_input_value(const pipeline_run_t *run, const pipeline_input_t *in) {
+    if (in->source == INPUT_LITERAL) {
+        return (zval *)&in->literal;
+    }
+    zval *current = in->source == INPUT_INITIAL ? run->initial_data : zend_hash_find(run->context, run->plan->steps[in->step].id);
+    for (uint32_t k = 0; current && k < in->nkeys; k++) {
+        ZVAL_DEREF(current);
+        if (Z_TYPE_P(current) != IS_ARRAY) {
+            return NULL;
         }
-    } else {
-        *last_condition_result = 1; // Reset condition for next step unless it's another conditional
+        current = zend_symtable_find(Z_ARRVAL_P(current), in->keys[k]);
     }
+    if (current) {
+        ZVAL_DEREF(current);
+    }
+    return current;
+}
 
-    if (Z_TYPE(rag_context) != IS_NULL) zval_ptr_dtor(&rag_context);
-    return SUCCESS;
+/* Destroys the run's Fibers; those still suspended unwind. */
+static void pipeline_release_fibers(pipeline_run_t *run) {
+    for (uint32_t i = 0; i < run->plan->count; i++) {
+        pipeline_task_t *task = &run->tasks[i];
+        zval_ptr_dtor(&task->fiber);
+        ZVAL_UNDEF(&task->fiber);
+        for (uint32_t b = task->reaped; task->batch_fibers && b < task->next_batch; b++) {
+            zval_ptr_dtor(&task->batch_fibers[b]);
+            ZVAL_UNDEF(&task->batch_fibers[b]);
+        }
+    }
 }
 
-/*
- * --- PLACEHOLDER IMPLEMENTATIONS FOR HELPERS ---
- * These functions contain significant logic and would be fully built out.
- */
-static zval* resolve_input_source_value(const char *source_path, size_t source_path_len, zval *initial_data, HashTable *execution_context) {
-    /* TODO: Implement logic to parse '@initial.key' and '@step_id.output.key' and retrieve zval* */
-    return NULL;
+/* Releases what the run holds. Fibers go first, as they unwind into the tasks and the context. */
+static void pipeline_run_free(pipeline_run_t *run) {
+    pipeline_release_fibers(run);
+    for (uint32_t i = 0; i < run->plan->count; i++) {
+        pipeline_task_t *task = &run->tasks[i];
+        zval_ptr_dtor(&task->items);
+        zval_ptr_dtor(&task->results);
+        if (task->batch_fibers) {
+            efree(task->batch_fibers);
+            efree(task->batch_done);
+        }
+        smart_str_free(&task->streamed);
+    }
+    efree(run->tasks);
+    if (run->checkpoints) {
+        for (uint32_t i = 0; i < run->plan->count; i++) {
+            zend_string_release(run->checkpoints[i]);
+        }
+        efree(run->checkpoints);
+    }
 }
 
-static int execute_rag_sub_call(const quicpro_tool_handler_config_t* tool_handler, HashTable *step_params, HashTable *execution_context, zval *rag_context_out) {
-    /* TODO:
-     * 1. Get RAG topics from step_params ('context_topics_list') or previous step output from execution_context.
-     * 2. Get RAG params (depth, tokens) from step_params.
-     * 3. Construct RAG request payload zval.
-     * 4. Call execute_mcp_call for the RAG agent (`tool_handler->rag_config->rag_agent_target`).
-     * 5. Extract context text from RAG response and populate `rag_context_out`.
-     */
-    ZVAL_STRING(rag_context_out, "/* Retrieved RAG context would be here */");
-    return SUCCESS;
+static bool pipeline_step_ready(const pipeline_run_t *run, uint32_t i) {
+    const pipeline_step_t *step = &run->plan->steps[i];
+    if (step->streaming && run->tasks[step->stream_from].state == STEP_WAITING) {
+        return false;   /* Its source only has to have started */
+    }
+    for (uint32_t d = 0; d < step->ndeps; d++) {
+        if (run->tasks[step->deps[d]].state != STEP_DONE) {
+            return false;
+        }
+    }
+    return true;
 }
 
-static int execute_mcp_call(const quicpro_mcp_target_config_t *target, zval *request_payload_zval, const char* input_schema_name, const char* output_schema_name, zval *response_out) {
-    /* TODO:
-     * 1. Use a connection pool or create a new `quicpro_mcp_connect` using `target->mcp_client_options_php_array`.
-     * 2. Call `quicpro_proto_encode` with `input_schema_name` and `request_payload_zval`.
-     * 3. Call `quicpro_mcp_request` with the target details and encoded payload.
-     * 4. Call `quicpro_proto_decode` with `output_schema_name` and the binary response.
-     * 5. Populate `response_out` zval.
-     * 6. Handle all potential errors and throw exceptions.
-     */
-    ZVAL_COPY(response_out, request_payload_zval); // Echo back payload as placeholder
+/* Runs step `i`, starting from the condition the step before it left. */
+static int pipeline_run_step(pipeline_run_t *run, uint32_t i) {
+    pipeline_task_t *task = &run->tasks[i];
+    task->condition = i > 0 ? run->tasks[i - 1].condition : 1;
+    int result = execute_step_c(run, i);
+    task->state = result == SUCCESS ? STEP_DONE : STEP_FAILED;
+    run->running--;
+    return result;
+}
+
+/*
+ * The request for step `i` before any ForEach items: its `input_map`
+ * ('target_field' => '@source.path' or a literal), the RAG context if any,
+ * then its `params` under the names the tool handler's `param_map` gives
+ * them. A source that does not resolve, such as the output of a skipped
+ * step, becomes null. `extra`: fields the caller adds.
+ */
+static int pipeline_request_init(pipeline_run_t *run, uint32_t i, zval *payload, uint32_t extra) {
+    const pipeline_step_t *step = &run->plan->steps[i];
+    const quicpro_tool_handler_config_t *tool_handler = step->handler;
+
+    zval rag_context; ZVAL_NULL(&rag_context);
+    if (Z_TYPE(step->rag_params) == IS_ARRAY) {
+        if (execute_rag_sub_call(tool_handler, Z_ARRVAL(step->rag_params), run->context, &rag_context) == FAILURE) {
+            return FAILURE; /* Error already thrown */
+        }
+    }
+
+    zval null_value;
+    uint32_t nparams = Z_TYPE(step->params) == IS_ARRAY ? zend_hash_num_elements(Z_ARRVAL(step->params)) : 0;
+    array_init_size(payload, step->ninputs + nparams + extra + 1);
+    ZVAL_NULL(&null_value);
+
+    for (uint32_t f = 0; f < step->ninputs; f++) {
+        const pipeline_input_t *in = &step->inputs[f];
+        zval *value = pipeline_input_value(run, in);
+        if (!value) value = &null_value;
+        Z_TRY_ADDREF_P(value);
+        zend_hash_update(Z_ARRVAL_P(payload), in->field, value);
+    }
+    if (Z_TYPE(rag_context) != IS_NULL && tool_handler->rag_config->target_context_field_in_llm_request) {
+        add_assoc_zval(payload, tool_handler->rag_config->target_context_field_in_llm_request, &rag_context);
+    } else {
+        zval_ptr_dtor(&rag_context);
+    }
+    if (nparams) {
+        zend_hash_merge(Z_ARRVAL_P(payload), Z_ARRVAL(step->params), zval_add_ref, 1);
+    }
     return SUCCESS;
 }
 
-static void log_pipeline_event(const char *event_type, HashTable *event_data) {
-    if (!g_auto_logging_enabled || !g_logger_agent_target) return;
+/* Puts a batch's results into the step's list, from `first` on; consumes `response`. */
+static int pipeline_batch_collect(const pipeline_step_t *step, pipeline_task_t *task, uint32_t first, uint32_t n, zval *response) {
+    if (step->batch_size == 1) {
+        zend_hash_index_update(Z_ARRVAL(task->results), first, response);
+        return SUCCESS;
+    }
+    zval *list = Z_TYPE_P(response) == IS_ARRAY ? zend_hash_find(Z_ARRVAL_P(response), step->results_field) : NULL;
+    if (list) {
+        ZVAL_DEREF(list);
+    }
+    if (!list || Z_TYPE_P(list) != IS_ARRAY || zend_hash_num_elements(Z_ARRVAL_P(list)) != n) {
+        throw_pipeline_error_as_php_exception(0, "ForEach step '%s': the reply to a batch of %u items must hold as many results under '%s'.",
+                                              ZSTR_VAL(step->id), n, ZSTR_VAL(step->results_field));
+        zval_ptr_dtor(response);
+        return FAILURE;
+    }
+    zval *result;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(list), result) {
+        Z_TRY_ADDREF_P(result);
+        zend_hash_index_update(Z_ARRVAL(task->results), first++, result);
+    } ZEND_HASH_FOREACH_END();
+    zval_ptr_dtor(response);
+    return SUCCESS;
+}
+
+/*
+ * The step's tool call with `payload`. For a tool registered with 'cache'
+ * the request is encoded here, so that its bytes key the step cache; a
+ * fresh stored reply is decoded instead of calling the agent, and a new
+ * one is stored before it is decoded.
+ */
+static int pipeline_tool_call(const pipeline_step_t *step, zval *payload, zval *response_out, smart_str *stream) {
+    const quicpro_tool_handler_config_t *handler = step->handler;
+    if (!handler->cache_ttl_ms || !step->input_schema || !quicpro_mcp_orchestrator_config.mcp_enable_request_caching) {
+        return execute_mcp_call(&handler->mcp_target, payload, handler->input_proto_schema, step->output_schema, response_out, stream);
+    }
+
+    smart_str request = {0};
+    if (quicpro_iibin_encode_message(&request, step->input_schema, payload) == FAILURE) {
+        smart_str_free(&request);
+        return FAILURE;
+    }
+    smart_str_0(&request);
+    quicpro_step_cache_key_t key;
+    quicpro_step_cache_key(&key, handler->tool_name, request.s ? ZSTR_VAL(request.s) : "", request.s ? ZSTR_LEN(request.s) : 0);
+
+    zend_string *reply = quicpro_step_cache_get(&key);
+    if (reply) {
+        smart_str_free(&request);
+        if (stream) {
+            smart_str_append(stream, reply);    /* All at once, as if it had streamed */
+        }
+        return decode_mcp_reply(step->output_schema, reply, response_out);
+    }
+
+    zval encoded, z_reply;
+    if (request.s) {
+        ZVAL_STR(&encoded, request.s);
+    } else {
+        ZVAL_EMPTY_STRING(&encoded);
+    }
+    int result = execute_mcp_call(&handler->mcp_target, &encoded, handler->input_proto_schema, NULL, &z_reply, stream);
+    zval_ptr_dtor(&encoded);
+    if (result == FAILURE) {
+        return FAILURE;
+    }
+    quicpro_step_cache_put(&key, Z_STR(z_reply), handler->cache_ttl_ms);
+    return decode_mcp_reply(step->output_schema, Z_STR(z_reply), response_out);
+}
+
+/* Runs batch `b` of ForEach step `i`: one tool call for its items. */
+static int pipeline_run_batch(pipeline_run_t *run, uint32_t i, uint32_t b) {
+    const pipeline_step_t *step = &run->plan->steps[i];
+    pipeline_task_t *task = &run->tasks[i];
+    uint32_t first = b * step->batch_size;
+    uint32_t n = MIN(step->batch_size, zend_hash_num_elements(Z_ARRVAL(task->items)) - first);
+
+    zval payload, response;
+    int result = pipeline_request_init(run, i, &payload, 1);
+    if (result == SUCCESS) {
+        if (step->batch_size == 1) {
+            zval *item = zend_hash_index_find(Z_ARRVAL(task->items), first);
+            Z_TRY_ADDREF_P(item);
+            zend_hash_update(Z_ARRVAL(payload), step->item_field, item);
+        } else {
+            zval list;
+            array_init_size(&list, n);
+            for (uint32_t k = 0; k < n; k++) {
+                zval *item = zend_hash_index_find(Z_ARRVAL(task->items), first + k);
+                Z_TRY_ADDREF_P(item);
+                zend_hash_next_index_insert(Z_ARRVAL(list), item);
+            }
+            zend_hash_update(Z_ARRVAL(payload), step->items_field, &list);
+        }
+        ZVAL_UNDEF(&response);
+        result = pipeline_tool_call(step, &payload, &response, NULL);
+        zval_ptr_dtor(&payload);
+    }
+    if (result == SUCCESS) {
+        result = pipeline_batch_collect(step, task, first, n, &response);
+    }
+
+    task->batch_done[b] = 1;
+    task->batches_running--;
+    task->batches_finished++;
+    if (result == FAILURE && task->state == STEP_RUNNING) {
+        task->state = STEP_FAILED;
+        run->running--;
+    }
+    return result;
+}
+
+#if PHP_VERSION_ID >= 80100
+/* The body of a step's or a batch's Fiber; its arguments are the step's index and the batch's, -1 for a whole step. */
+static ZEND_NAMED_FUNCTION(pipeline_step_fiber_main) {
+    pipeline_run_t *run = pipeline_starting;
+    zval *index = ZEND_NUM_ARGS() >= 2 ? ZEND_CALL_ARG(execute_data, 1) : NULL;
+    zval *batch = ZEND_NUM_ARGS() >= 2 ? ZEND_CALL_ARG(execute_data, 2) : NULL;
+    if (run && index && Z_TYPE_P(index) == IS_LONG && (zend_ulong)Z_LVAL_P(index) < run->plan->count && Z_TYPE_P(batch) == IS_LONG) {
+        pipeline_starting = NULL;
+        if (Z_LVAL_P(batch) >= 0) {
+            pipeline_run_batch(run, (uint32_t)Z_LVAL_P(index), (uint32_t)Z_LVAL_P(batch));
+        } else {
+            pipeline_run_step(run, (uint32_t)Z_LVAL_P(index));
+        }
+    }
+    RETURN_NULL();
+}
+
+/* Starts the Fiber for step `i` (batch `b`, -1: the whole step) in `fiber`; it returns once the work waits. */
+static int pipeline_fiber_start(pipeline_run_t *run, zval *fiber, zend_internal_function *entry, uint32_t i, zend_long b) {
+    zval closure, index, batch, retval;
+    zend_create_closure(&closure, (zend_function *)entry, NULL, NULL, NULL);
+    object_init_ex(fiber, zend_ce_fiber);
+    zend_call_known_instance_method_with_1_params(zend_ce_fiber->constructor, Z_OBJ_P(fiber), NULL, &closure);
+    zval_ptr_dtor(&closure);
+    if (EG(exception)) {
+        return FAILURE;
+    }
+    ZVAL_LONG(&index, i);
+    ZVAL_LONG(&batch, b);
+    ZVAL_UNDEF(&retval);
+    pipeline_starting = run;
+    zend_call_method_with_2_params(Z_OBJ_P(fiber), zend_ce_fiber, NULL, "start", &retval, &index, &batch);
+    pipeline_starting = NULL;
+    zval_ptr_dtor(&retval);
+    return EG(exception) ? FAILURE : SUCCESS;
+}
+#endif
+
+/* Starts step `i`: in a Fiber of its own when `entry` is set, which returns once the step waits. */
+static int pipeline_launch(pipeline_run_t *run, uint32_t i, zend_internal_function *entry) {
+    pipeline_task_t *task = &run->tasks[i];
+    task->state = STEP_RUNNING;
+    task->started_ms = g_auto_logging_enabled ? mcp_call_now_ms() : 0;
+    run->running++;
+#if PHP_VERSION_ID >= 80100
+    if (entry) {
+        if (pipeline_fiber_start(run, &task->fiber, entry, i, -1) == FAILURE) {
+            if (task->state == STEP_RUNNING) {
+                task->state = STEP_FAILED;
+                run->running--;
+            }
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+#else
+    (void)entry;
+#endif
+    return pipeline_run_step(run, i);
+}
+
+/* Logs the end of step `i`, once. */
+static void pipeline_log_step(pipeline_run_t *run, uint32_t i) {
+    const pipeline_step_t *step = &run->plan->steps[i];
+    pipeline_task_t *task = &run->tasks[i];
+    task->logged = 1;
+    if (!g_auto_logging_enabled) {
+        return;
+    }
+    zval event;
+    array_init_size(&event, 6);
+    add_assoc_long(&event, "run_id", run->id);
+    add_assoc_str(&event, "step", zend_string_copy(step->id));
+    add_assoc_string(&event, "tool", step->handler->tool_name);
+    add_assoc_long(&event, "duration_ms", task->started_ms ? mcp_call_now_ms() - task->started_ms : 0);
+    log_pipeline_event(task->state == STEP_DONE ? "step_done" : "step_failed", &event);
+}
+
+/* Step `i` ended: logs it and, in a run given a 'run_id', keeps the output of a step that ran. */
+static void pipeline_step_ended(pipeline_run_t *run, uint32_t i) {
+    pipeline_log_step(run, i);
+    zval *output;
+    if (run->checkpoints && run->tasks[i].state == STEP_DONE
+        && (output = zend_hash_find(run->context, run->plan->steps[i].id))) {
+        const pipeline_step_t *step = &run->plan->steps[i];
+        quicpro_pipeline_checkpoint_save(run->checkpoints[i], step->foreach ? NULL : step->output_schema, output);
+    }
+}
+
+static void pipeline_foreach_finish(pipeline_run_t *run, uint32_t i) {
+    pipeline_task_t *task = &run->tasks[i];
+    zend_hash_update(run->context, run->plan->steps[i].id, &task->results);
+    ZVAL_UNDEF(&task->results);
+    zval_ptr_dtor(&task->items);
+    ZVAL_UNDEF(&task->items);
+    task->condition = 1;
+    task->state = STEP_DONE;
+    run->running--;
+}
+
+/*
+ * Takes the records of streaming step `i`'s source that arrived since the
+ * last look as items, and counts the batches they fill; once the source
+ * is done, its rest and the last, partial batch as well.
+ */
+static void pipeline_stream_take(pipeline_run_t *run, uint32_t i) {
+    const pipeline_step_t *step = &run->plan->steps[i];
+    pipeline_task_t *task = &run->tasks[i];
+    const pipeline_task_t *source = &run->tasks[step->stream_from];
+    bool closed = source->state == STEP_DONE;   /* Read first: the reply is complete by then */
+    const char *buf = source->streamed.s ? ZSTR_VAL(source->streamed.s) : "";
+    const char *end = buf + (source->streamed.s ? ZSTR_LEN(source->streamed.s) : 0);
+    const char *delim = ZSTR_VAL(step->stream_delimiter);
+    size_t delim_len = ZSTR_LEN(step->stream_delimiter);
+
+    while (buf + task->stream_pos < end) {
+        const char *start = buf + task->stream_pos;
+        const char *stop = zend_memnstr(start, delim, delim_len, end);
+        if (!stop && !closed) {
+            break;      /* The record is still arriving */
+        }
+        size_t len = (stop ? stop : end) - start;
+        task->stream_pos += len + (stop ? delim_len : 0);
+        if (len) {
+            zval item;
+            ZVAL_STRINGL(&item, start, len);
+            zend_hash_next_index_insert(Z_ARRVAL(task->items), &item);
+            add_next_index_null(&task->results);
+        }
+    }
+
+    uint32_t n = zend_hash_num_elements(Z_ARRVAL(task->items));
+    uint32_t batches = n / step->batch_size + (closed && n % step->batch_size != 0);
+    if (batches > task->batch_cap) {
+        uint32_t cap = MAX(batches, MAX(task->batch_cap * 2, 8));
+        task->batch_fibers = safe_erealloc(task->batch_fibers, cap, sizeof(zval), 0);
+        task->batch_done = safe_erealloc(task->batch_done, cap, 1, 0);
+        memset(&task->batch_fibers[task->batch_cap], 0, (cap - task->batch_cap) * sizeof(zval));
+        memset(&task->batch_done[task->batch_cap], 0, cap - task->batch_cap);
+        task->batch_cap = cap;
+    }
+    task->batches = batches;
+    task->stream_closed = closed;
+}
+
+/* Starts ForEach step `i`: resolves its list and splits it into batches. A skipped step or an empty list is done at once. */
+static int pipeline_foreach_start(pipeline_run_t *run, uint32_t i) {
+    const pipeline_step_t *step = &run->plan->steps[i];
+    pipeline_task_t *task = &run->tasks[i];
+    task->condition = i > 0 ? run->tasks[i - 1].condition : 1;
+    task->started_ms = g_auto_logging_enabled ? mcp_call_now_ms() : 0;
+    if (step->condition_true_only && !task->condition) {
+        task->state = STEP_DONE;
+        return SUCCESS;
+    }
+    if (step->streaming) {
+        /* The items come as the source's reply does (pipeline_foreach_advance()) */
+        array_init(&task->items);
+        array_init(&task->results);
+        task->state = STEP_RUNNING;
+        run->running++;
+        return SUCCESS;
+    }
+
+    zval *items = pipeline_input_value(run, &step->items);
+    if (!items || Z_TYPE_P(items) != IS_ARRAY) {
+        throw_pipeline_error_as_php_exception(0, "ForEach step '%s' has no list to map over.", ZSTR_VAL(step->id));
+        task->state = STEP_FAILED;
+        return FAILURE;
+    }
+    uint32_t n = zend_hash_num_elements(Z_ARRVAL_P(items));
+    zval *item;
+    array_init_size(&task->items, n);
+    array_init_size(&task->results, n);
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(items), item) {
+        ZVAL_DEREF(item);
+        Z_TRY_ADDREF_P(item);
+        zend_hash_next_index_insert(Z_ARRVAL(task->items), item);
+        add_next_index_null(&task->results);   /* Ordered slots, whatever order the batches end in */
+    } ZEND_HASH_FOREACH_END();
+
+    task->state = STEP_RUNNING;
+    run->running++;
+    task->batches = n / step->batch_size + (n % step->batch_size != 0);
+    if (task->batches == 0) {
+        pipeline_foreach_finish(run, i);
+        return SUCCESS;
+    }
+    task->batch_fibers = ecalloc(task->batches, sizeof(zval));
+    task->batch_done = ecalloc(task->batches, 1);
+    return SUCCESS;
+}
+
+/*
+ * Moves ForEach step `i` on: releases the Fibers of the batches that
+ * ended, starts more within the step's cap, and completes the step after
+ * its last batch.
+ */
+static int pipeline_foreach_advance(pipeline_run_t *run, uint32_t i, zend_internal_function *entry) {
+    const pipeline_step_t *step = &run->plan->steps[i];
+    pipeline_task_t *task = &run->tasks[i];
+    if (step->streaming) {
+        pipeline_stream_take(run, i);
+    }
+    for (; task->reaped < task->next_batch && task->batch_done[task->reaped]; task->reaped++) {
+        zval_ptr_dtor(&task->batch_fibers[task->reaped]);
+        ZVAL_UNDEF(&task->batch_fibers[task->reaped]);
+    }
+
+    uint32_t cap = step->batch_concurrency ? step->batch_concurrency
+                 : (uint32_t)MIN(quicpro_mcp_orchestrator_config.orchestrator_loop_concurrency_default, UINT32_MAX);
+    while (task->state == STEP_RUNNING && task->next_batch < task->batches && task->batches_running < cap) {
+        uint32_t b = task->next_batch++;
+        task->batches_running++;
+#if PHP_VERSION_ID >= 80100
+        if (entry) {
+            if (pipeline_fiber_start(run, &task->batch_fibers[b], entry, i, b) == FAILURE) {
+                if (!task->batch_done[b]) {
+                    task->batch_done[b] = 1;
+                    task->batches_running--;
+                    task->batches_finished++;
+                }
+                if (task->state == STEP_RUNNING) {
+                    task->state = STEP_FAILED;
+                    run->running--;
+                }
+                return FAILURE;
+            }
+            continue;
+        }
+#endif
+        if (pipeline_run_batch(run, i, b) == FAILURE) {
+            return FAILURE;
+        }
+    }
+
+    if (task->state == STEP_RUNNING && task->batches_finished == task->batches && (!step->streaming || task->stream_closed)) {
+        pipeline_foreach_finish(run, i);
+    }
+    return task->state == STEP_FAILED ? FAILURE : SUCCESS;
+}
+
+/*
+ * Starts every step whose dependencies are done, up to `max_concurrency`
+ * at a time and in definition order, and lets the scheduler move the
+ * parked ones until all are done. The first failure stops the run: steps
+ * still waiting on their agents are unwound and its exception is thrown.
+ */
+static int pipeline_schedule(pipeline_run_t *run, zend_long max_concurrency) {
+    uint32_t count = run->plan->count;
+    zend_internal_function entry, *step_entry = NULL;
+#if PHP_VERSION_ID >= 80100
+    /* A ForEach step fans out under its own cap, whatever the run's */
+    bool fan_out = max_concurrency > 1 && count > 1;
+    for (uint32_t i = 0; i < count && !fan_out; i++) {
+        fan_out = run->plan->steps[i].foreach;
+    }
+    if (fan_out) {
+        memset(&entry, 0, sizeof(entry));
+        entry.type = ZEND_INTERNAL_FUNCTION;
+        entry.function_name = zend_string_init("{pipeline step}", sizeof("{pipeline step}") - 1, 0);
+        entry.handler = pipeline_step_fiber_main;
+        step_entry = &entry;
+    }
+#endif
+
+    int result = SUCCESS;
+    uint32_t done;
+    do {
+        done = 0;
+        for (uint32_t i = 0; i < count && result == SUCCESS; i++) {
+            pipeline_task_t *task = &run->tasks[i];
+            zend_bool foreach = run->plan->steps[i].foreach;
+            if (task->state == STEP_WAITING && run->running < (zend_ulong)max_concurrency && pipeline_step_ready(run, i)) {
+                result = foreach ? pipeline_foreach_start(run, i) : pipeline_launch(run, i, step_entry);
+            }
+            if (result == SUCCESS && foreach && task->state == STEP_RUNNING) {
+                result = pipeline_foreach_advance(run, i, step_entry);
+            }
+            if (task->state == STEP_FAILED) {
+                result = FAILURE;
+            }
+            done += task->state == STEP_DONE;
+            if (task->state >= STEP_DONE && !task->logged) {
+                pipeline_step_ended(run, i);
+            }
+        }
+        if (result == FAILURE || EG(exception) || run->running == 0) {
+            break;
+        }
+
+        /* Every running step waits on an agent; the scheduler resumes those that can go on */
+        zend_long parked = quicpro_sched_run(-1);
+        if (EG(exception)) {
+            result = FAILURE;
+        } else if (parked <= 0 && run->running > 0) {
+            throw_pipeline_error_as_php_exception(0, "Pipeline steps were suspended outside the MCP scheduler.");
+            result = FAILURE;
+        }
+    } while (result == SUCCESS);
+    for (uint32_t i = 0; i < count; i++) {
+        if (run->tasks[i].state >= STEP_DONE && !run->tasks[i].logged) {
+            pipeline_step_ended(run, i);   /* Ended in the scheduler's last tick */
+        }
+    }
+
+    if (result == SUCCESS && done < count) {
+        /* Only a failed step can leave others waiting, and that has thrown */
+        result = FAILURE;
+    }
+    if (result == FAILURE || EG(exception)) {
+        zend_object *exception = EG(exception);
+        if (exception) {
+            GC_ADDREF(exception);
+            zend_clear_exception();
+        }
+        pipeline_release_fibers(run);   /* Unwinds the steps still waiting */
+        if (exception) {
+            zval ex;
+            ZVAL_OBJ(&ex, exception);
+            zend_throw_exception_object(&ex);
+        }
+        result = FAILURE;
+    }
+    if (step_entry) {
+        zend_string_release(entry.function_name);
+    }
+    return result;
+}
+
+/*
+ * Gives the run its checkpoint keys and takes what an earlier run with
+ * the same ID left: each step found is done with its output, as if it had
+ * just run. Returns how many were, or -1 after throwing.
+ */
+static zend_long pipeline_checkpoint_resume(pipeline_run_t *run, const zend_string *run_id) {
+    uint32_t count = run->plan->count;
+    run->checkpoints = ecalloc(MAX(count, 1), sizeof(zend_string *));
+    for (uint32_t i = 0; i < count; i++) {
+        run->checkpoints[i] = quicpro_pipeline_checkpoint_key(run_id, run->plan->steps[i].id);
+        if (!run->checkpoints[i]) {
+            while (i--) {
+                zend_string_release(run->checkpoints[i]);
+            }
+            efree(run->checkpoints);
+            run->checkpoints = NULL;
+            return -1;
+        }
+    }
+
+    zend_long restored = 0;
+    zend_string **blobs = safe_emalloc(MAX(count, 1), sizeof(zend_string *), 0);
+    if (quicpro_pipeline_checkpoint_fetch(run->checkpoints, count, blobs)) {
+        for (uint32_t i = 0; i < count; i++) {
+            const pipeline_step_t *step = &run->plan->steps[i];
+            pipeline_task_t *task = &run->tasks[i];
+            zval output, *met;
+            if (!blobs[i] || !quicpro_pipeline_checkpoint_decode(step->foreach ? NULL : step->output_schema, blobs[i], &output)) {
+                continue;
+            }
+            /* The condition the step left, as execute_step_c() sets it */
+            task->condition = !step->conditional
+                || (Z_TYPE(output) == IS_ARRAY && (met = zend_hash_str_find(Z_ARRVAL(output), "condition_met", sizeof("condition_met") - 1)) && zend_is_true(met));
+            zend_hash_update(run->context, step->id, &output);
+            task->state = STEP_DONE;
+            task->logged = 1;
+            restored++;
+        }
+    }
+    efree(blobs);
+
+    /* A streaming step that runs again needs its source's reply to arrive again */
+    for (uint32_t i = 0; i < count; i++) {
+        const pipeline_step_t *step = &run->plan->steps[i];
+        pipeline_task_t *source = step->streaming ? &run->tasks[step->stream_from] : NULL;
+        if (source && run->tasks[i].state != STEP_DONE && source->state == STEP_DONE) {
+            zend_hash_del(run->context, run->plan->steps[step->stream_from].id);
+            source->state = STEP_WAITING;
+            source->logged = 0;
+            restored--;
+        }
+    }
+    return restored;
+}
+
+static int execute_pipeline_c(zval *initial_data_zval, const quicpro_pipeline_plan_t *plan, zval *exec_options_php_array, zval *return_value) {
+    HashTable *execution_context;
+    pipeline_run_t run;
+
+    /* The execution_context will store results of steps: ['step_id' => [output_data]] */
+    ALLOC_HASHTABLE(execution_context);
+    zend_hash_init(execution_context, plan->count, NULL, ZVAL_PTR_DTOR, 0);
+    memset(&run, 0, sizeof(run));
+    run.plan = plan;
+    run.tasks = ecalloc(MAX(plan->count, 1), sizeof(pipeline_task_t));
+    run.context = execution_context;
+    run.initial_data = initial_data_zval;
+    run.id = ++g_log_next_run_id;
+
+    /* The tools this run uses warm up along with its first steps, not after them */
+    for (uint32_t i = 0; i < plan->count; i++) {
+        const quicpro_tool_handler_config_t *handler = plan->steps[i].handler;
+        if (handler && handler->mcp_target.prewarm) {
+            quicpro_prewarm_tick((quicpro_mcp_target_config_t *)&handler->mcp_target);
+        }
+    }
+
+    /* 'run_id': the steps an earlier run under it completed are taken from their checkpoints */
+    zend_long restored = 0;
+    zval *zv_run_id = exec_options_php_array ? zend_hash_str_find(Z_ARRVAL_P(exec_options_php_array), "run_id", sizeof("run_id") - 1) : NULL;
+    if (zv_run_id && Z_TYPE_P(zv_run_id) == IS_STRING) {
+        restored = pipeline_checkpoint_resume(&run, Z_STR_P(zv_run_id));
+        if (restored < 0) {
+            pipeline_run_free(&run);
+            zend_hash_destroy(execution_context);
+            FREE_HASHTABLE(execution_context);
+            return FAILURE;
+        }
+    }
+
+    zend_long started_ms = 0;
+    if (g_auto_logging_enabled) {
+        zval event;
+        started_ms = mcp_call_now_ms();
+        array_init_size(&event, 4);
+        add_assoc_long(&event, "run_id", run.id);
+        add_assoc_long(&event, "steps", plan->count);
+        if (run.checkpoints) {
+            add_assoc_long(&event, "steps_restored", restored);
+        }
+        log_pipeline_event("pipeline_start", &event);
+    }
+
+    /* Initialize the result object/array that will be returned to PHP */
+    /* This could be a specific Quicpro\PipelineResult object or a simple array */
+    array_init(return_value);
+
+    /* 'max_concurrency': independent steps in flight at once; 1 runs them in order */
+    zend_long max_concurrency = quicpro_mcp_orchestrator_config.orchestrator_step_concurrency_default;
+    zval *zv_concurrency = exec_options_php_array ? zend_hash_str_find(Z_ARRVAL_P(exec_options_php_array), "max_concurrency", sizeof("max_concurrency") - 1) : NULL;
+    if (zv_concurrency && Z_TYPE_P(zv_concurrency) == IS_LONG && Z_LVAL_P(zv_concurrency) > 0) {
+        max_concurrency = Z_LVAL_P(zv_concurrency);
+    }
+
+    int result = pipeline_schedule(&run, max_concurrency);
+    if (result == SUCCESS && run.checkpoints) {
+        quicpro_pipeline_checkpoint_clear(run.checkpoints, plan->count);
+    }
+    pipeline_run_free(&run);
+    if (g_auto_logging_enabled) {
+        zval event;
+        array_init_size(&event, 4);
+        add_assoc_long(&event, "run_id", run.id);
+        add_assoc_long(&event, "duration_ms", mcp_call_now_ms() - started_ms);
+        log_pipeline_event(result == SUCCESS ? "pipeline_done" : "pipeline_failed", &event);
+        pipeline_log_flush(false);  /* After the run, when a batch is due; a failed run's wait for the next */
+    }
+    if (result == FAILURE) {
+        /* An exception was thrown inside a step. Populate error info. */
+        add_assoc_bool(return_value, "isSuccess", 0);
+        /* TODO: Populate error message from the exception or internal state */
+        zend_hash_destroy(execution_context); FREE_HASHTABLE(execution_context);
+        return FAILURE;
+    }
+
+    /* Finalize result */
+    add_assoc_bool(return_value, "isSuccess", 1);
+
+    /* Add step outputs to the final result for debugging/access */
+    ZVAL_ARR(return_value, zend_hash_copy(execution_context, Z_ARRVAL_P(return_value), (copy_ctor_func_t)zval_add_ref));
+    add_assoc_string(return_value, "finalMessage", "Pipeline completed successfully.");
+
+    zend_hash_destroy(execution_context);
+    FREE_HASHTABLE(execution_context);
+    return SUCCESS;
+}
+
+/*
+ * Executes a single step of the pipeline.
+ * This is the most complex function, orchestrating RAG, input mapping, MCP calls, etc.
+ */
+static int execute_step_c(pipeline_run_t *run, uint32_t i) {
+    const pipeline_step_t *step = &run->plan->steps[i];
+    const quicpro_tool_handler_config_t *tool_handler = step->handler;
+    pipeline_task_t *task = &run->tasks[i];
+    zval *zv_temp;
+
+    /* Check conditional execution flag */
+    if (step->condition_true_only && !task->condition) {
+        /* This step is skipped */
+        /* TODO: Log this skip event */
+        return SUCCESS;
+    }
+
+    /* The request: input_map, RAG context, params (see pipeline_request_init()) */
+    zval mcp_request_payload;
+    if (pipeline_request_init(run, i, &mcp_request_payload, 0) == FAILURE) {
+        return FAILURE;
+    }
+
+    zval mcp_response; ZVAL_UNDEF(&mcp_response);
+    if (pipeline_tool_call(step, &mcp_request_payload, &mcp_response, step->streamed ? &task->streamed : NULL) == FAILURE) {
+        zval_ptr_dtor(&mcp_request_payload);
+        return FAILURE;
+    }
+    zval_ptr_dtor(&mcp_request_payload);
+
+
+    /* If this was a ConditionalLogic tool, update the last_condition_result flag */
+    if (step->conditional) {
+        if (Z_TYPE(mcp_response) == IS_ARRAY && (zv_temp = zend_hash_str_find(Z_ARRVAL(mcp_response), "condition_met", sizeof("condition_met")-1))) {
+            task->condition = zend_is_true(zv_temp);
+        } else {
+            task->condition = 0; // Default to false if condition output is invalid
+        }
+    } else {
+        task->condition = 1; // Reset condition for next step unless it's another conditional
+    }
+
+    /*
+     * TODO: Output mapping logic.
+     * Use `tool_handler->output_map` to transform `mcp_response` into the final step output if needed.
+     * For now, we store the direct response.
+     */
+    zend_hash_update(run->context, step->id, &mcp_response); // zend_hash_update takes ownership
+    return SUCCESS;
+}
+
+/*
+ * --- PLACEHOLDER IMPLEMENTATIONS FOR HELPERS ---
+ * These functions contain significant logic and would be fully built out.
+ */
+
+static int execute_rag_sub_call(const quicpro_tool_handler_config_t* tool_handler, HashTable *step_params, HashTable *execution_context, zval *rag_context_out) {
+    const quicpro_rag_config_t *rag = tool_handler->rag_config;
+
+    /* A local index: the query vector is the step's topics param ('topics_from_param_key', else 'query_vector') */
+    if (rag->local_index) {
+        const char *key = rag->topics_from_param_key ? rag->topics_from_param_key : "query_vector";
+        zval *query = zend_hash_str_find(step_params, key, strlen(key));
+        if (!query) {
+            throw_pipeline_error_as_php_exception(0, "RAG for tool '%s' retrieves from index '%s' and needs the query vector in step param '%s'.",
+                tool_handler->tool_name, rag->local_index, key);
+            return FAILURE;
+        }
+        return quicpro_geometry_index_retrieve(rag->local_index, strlen(rag->local_index), query, rag->local_k, rag_context_out)
+            ? SUCCESS : FAILURE;
+    }
+
     /* TODO:
-     * 1. Construct event payload zval.
-     * 2. Call execute_mcp_call to send the log event to `g_logger_agent_target`.
-     * This should likely be a fire-and-forget call (non-blocking, no response needed).
+     * 1. Get RAG topics from step_params ('context_topics_list') or previous step output from execution_context.
+     * 2. Get RAG params (depth, tokens) from step_params.
+     * 3. Construct RAG request payload zval.
+     * 4. Call execute_mcp_call for the RAG agent (`tool_handler->rag_config->rag_agent_target`).
+     * 5. Extract context text from RAG response and populate `rag_context_out`.
      */
+    ZVAL_STRING(rag_context_out, "/* Retrieved RAG context would be here */");
+    return SUCCESS;
+}
+
+/* quicpro_mcp_chunk_fn of a streamed-from step */
+static void pipeline_stream_chunk(void *arg, const char *data, size_t len) {
+    smart_str_appendl((smart_str *)arg, data, len);
+}
+
+/* Waits out a retry's back-off: parked in a Fiber, so the run's other steps go on meanwhile */
+static int pipeline_retry_wait(zend_long ms) {
+    quicpro_sched_result_t rc = quicpro_sched_sleep(ms);
+    if (rc == QUICPRO_SCHED_NO_FIBER) {
+        struct timespec nap = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000 };
+        nanosleep(&nap, NULL);
+    }
+    return rc == QUICPRO_SCHED_ERROR ? FAILURE : SUCCESS;
+}
+
+/*
+ * One attempt of a tool call, on a pooled connection to one of the
+ * target's endpoints, picked by quicpro_mcp_endpoint_pick() other than
+ * `*failed_ep` where there is a choice. With 'hedge' the call goes to a
+ * second endpoint as well once it is late, and takes whichever reply comes
+ * first (see quicpro_mcp_request()). What each endpoint did is reported
+ * back, so the next pick knows. The attempt is an INTERNAL span, the
+ * parent of the call's CLIENT span (and so of the tool's SERVER span),
+ * covering the connect and the decode as well. On failure `*transient`
+ * says whether it failed in transit, and `*failed_ep` where.
+ */
+static int execute_mcp_attempt(const quicpro_mcp_target_config_t *target, zval *request_payload_zval, const char* input_schema_name, const quicpro_iibin_compiled_schema_internal *output,
+                               zval *response_out, smart_str *stream, uint32_t attempt, zend_long timeout_ms,
+                               const quicpro_mcp_endpoint_t **failed_ep, bool *transient) {
+    /* The endpoints' statistics change with every call; the rest of the target does not */
+    quicpro_mcp_endpoint_set_t *set = (quicpro_mcp_endpoint_set_t *)&target->endpoints;
+    HashTable *connect_options = Z_TYPE(target->mcp_client_options_php_array) == IS_ARRAY ? Z_ARRVAL(target->mcp_client_options_php_array) : NULL;
+
+    /* A serverless agent's call goes to a warm executor first (prewarm.h) */
+    quicpro_prewarm_t *prewarm = set->count ? target->prewarm : NULL;
+    int executor = prewarm ? quicpro_prewarm_acquire(prewarm, set) : -1;
+    quicpro_mcp_endpoint_t *primary_ep = executor >= 0 ? &set->endpoints[prewarm->executors[executor].endpoint]
+                                       : set->count ? quicpro_mcp_endpoint_pick(set, *failed_ep) : NULL;
+    const char *host = primary_ep ? primary_ep->host : target->host;
+    zend_long port = primary_ep ? primary_ep->port : target->port;
+    zend_long started_ms = mcp_call_now_ms();
+
+    quicpro_otel_scope_t scope;
+    bool traced = quicpro_otel_scope_open(&scope, "pipeline.tool_call", QUICPRO_OTEL_KIND_INTERNAL, NULL);
+    if (traced) {
+        quicpro_otel_span_attr_str(&scope.span, "rpc.service", target->service_name, strlen(target->service_name));
+        quicpro_otel_span_attr_str(&scope.span, "rpc.method", target->method_name, strlen(target->method_name));
+        quicpro_otel_span_attr_str(&scope.span, "server.address", host, strlen(host));
+        quicpro_otel_span_attr_int(&scope.span, "server.port", port);
+        quicpro_otel_span_attr_int(&scope.span, "quicpro.attempt", attempt);
+    }
+
+    *transient = false;
+    *failed_ep = primary_ep;
+    zend_resource *res = quicpro_mcp_open(host, strlen(host), port, target->cfg, connect_options);
+    if (!res) {
+        *transient = true;
+        if (primary_ep) {
+            quicpro_mcp_endpoint_report(set, primary_ep, 0, false);
+        }
+        if (prewarm) {
+            quicpro_prewarm_release(prewarm, executor, (uint32_t)(primary_ep - set->endpoints), 0, false);
+        }
+        scope.span.error = true;
+        quicpro_otel_scope_close(&scope);
+        return FAILURE;
+    }
+    zval z_session, z_hedge, z_response, call_options;
+    ZVAL_RES(&z_session, res);
+    ZVAL_UNDEF(&z_hedge);
+
+    array_init(&call_options);
+    if (input_schema_name) {
+        add_assoc_string(&call_options, "schema", (char *)input_schema_name);
+    }
+    add_assoc_long(&call_options, "timeout_ms", timeout_ms);
+
+    quicpro_mcp_endpoint_t *hedge_ep = NULL;
+    if (target->hedge && !target->hedge_host && primary_ep && set->count > 1) {
+        hedge_ep = quicpro_mcp_endpoint_pick(set, primary_ep);
+        if (hedge_ep == primary_ep) {
+            quicpro_mcp_endpoint_cancel(hedge_ep);
+            hedge_ep = NULL;
+        }
+    }
+    if (target->hedge_host || hedge_ep) {
+        /* Best effort: without the second endpoint the call simply is not hedged */
+        const char *hedge_host = hedge_ep ? hedge_ep->host : target->hedge_host;
+        zend_long hedge_port = hedge_ep ? hedge_ep->port : target->hedge_port;
+        zend_resource *hedge = quicpro_mcp_open(hedge_host, strlen(hedge_host), hedge_port, target->cfg, connect_options);
+        if (hedge) {
+            ZVAL_RES(&z_hedge, hedge);
+            Z_ADDREF(z_hedge);
+            add_assoc_zval(&call_options, "hedge", &z_hedge);
+            if (target->hedge_after_ms >= 0) {
+                add_assoc_long(&call_options, "hedge_after_ms", target->hedge_after_ms);
+            }
+        } else {
+            zend_clear_exception();
+            if (hedge_ep) {
+                quicpro_mcp_endpoint_report(set, hedge_ep, 0, false);
+                hedge_ep = NULL;
+            }
+        }
+    }
+
+    quicpro_session_t *answered_by = NULL;
+    int result = quicpro_mcp_call_streamed((quicpro_session_t *)res->ptr, target->service_name, target->method_name,
+                                           request_payload_zval, Z_ARRVAL(call_options), &z_response, &answered_by,
+                                           stream ? pipeline_stream_chunk : NULL, stream);
+    *transient = result == FAILURE && quicpro_mcp_call_transient();
+    zend_long latency_ms = mcp_call_now_ms() - started_ms;
+    if (primary_ep) {
+        if (result == FAILURE) {
+            quicpro_mcp_endpoint_report(set, primary_ep, latency_ms, false);
+        } else if (answered_by == res->ptr) {
+            quicpro_mcp_endpoint_report(set, primary_ep, latency_ms, true);
+        } else {
+            quicpro_mcp_endpoint_cancel(primary_ep);
+        }
+    }
+    if (prewarm) {
+        quicpro_prewarm_release(prewarm, executor, (uint32_t)(primary_ep - set->endpoints), latency_ms, result == SUCCESS);
+    }
+    if (hedge_ep) {
+        /* The hedge cannot be blamed for a call that failed: it may never have been sent */
+        if (result == SUCCESS && answered_by != res->ptr) {
+            quicpro_mcp_endpoint_report(set, hedge_ep, latency_ms, true);
+        } else {
+            quicpro_mcp_endpoint_cancel(hedge_ep);
+        }
+    }
+    if (traced) {
+        quicpro_otel_span_attr_bool(&scope.span, "quicpro.hedged", Z_TYPE(z_hedge) != IS_UNDEF);
+    }
+    zval_ptr_dtor(&call_options);
+    zval_ptr_dtor(&z_hedge);
+    zval_ptr_dtor(&z_session);   /* Back to the pool, or closed */
+    if (result == SUCCESS) {
+        result = decode_mcp_reply(output, Z_STR(z_response), response_out);
+    }
+    scope.span.error = result == FAILURE;
+    quicpro_otel_scope_close(&scope);
+    return result;
+}
+
+/* Whether the pending exception is a failed call's rather than the script's exit unwinding */
+static bool pipeline_retry_allowed(void) {
+#if PHP_VERSION_ID >= 80100
+    zend_object *ex = EG(exception);
+    return !ex || !(zend_is_unwind_exit(ex) || zend_is_graceful_exit(ex));
+#else
+    return true;
+#endif
+}
+
+/*
+ * One tool call: execute_mcp_attempt() until it succeeds, or fails other
+ * than in transit, or the target's retry budget (retry_budget.h) allows no
+ * retry before the deadline, which covers all of the attempts. `stream`
+ * (may be NULL) keeps the reply as it arrives, for the steps streaming
+ * from this one (see pipeline_stream_take()); a streamed call is not
+ * hedged, nor retried once part of it went downstream.
+ */
+static int execute_mcp_call(const quicpro_mcp_target_config_t *target, zval *request_payload_zval, const char* input_schema_name, const quicpro_iibin_compiled_schema_internal *output, zval *response_out, smart_str *stream) {
+    /* Like the endpoints, the budget changes with every call */
+    quicpro_mcp_retry_budget_t *budget = (quicpro_mcp_retry_budget_t *)&target->retry_budget;
+    zend_long deadline_ms = mcp_call_now_ms() + (target->timeout_ms > 0 ? target->timeout_ms : quicpro_mcp_orchestrator_config.mcp_default_request_timeout_ms);
+    size_t streamed = stream && stream->s ? ZSTR_LEN(stream->s) : 0;
+    const quicpro_mcp_endpoint_t *failed_ep = NULL;
+    bool transient;
+
+    quicpro_mcp_retry_note_call(budget);
+    for (uint32_t attempt = 1;; attempt++) {
+        if (execute_mcp_attempt(target, request_payload_zval, input_schema_name, output, response_out, stream, attempt,
+                                MAX(deadline_ms - mcp_call_now_ms(), 1), &failed_ep, &transient) == SUCCESS) {
+            return SUCCESS;
+        }
+        if (!transient || !target->retry || (stream && stream->s && ZSTR_LEN(stream->s) != streamed) || !pipeline_retry_allowed()) {
+            return FAILURE;
+        }
+        zend_long wait_ms = quicpro_mcp_retry_backoff(budget, attempt, deadline_ms - mcp_call_now_ms());
+        if (wait_ms < 0) {
+            return FAILURE;
+        }
+        zend_clear_exception();
+        if (wait_ms > 0 && pipeline_retry_wait(wait_ms) == FAILURE) {
+            return FAILURE;
+        }
+    }
+}
+
+/* The reply under the output schema; without one, the reply itself. Consumes `reply`. */
+static int decode_mcp_reply(const quicpro_iibin_compiled_schema_internal *output, zend_string *reply, zval *response_out) {
+    if (!output) {
+        ZVAL_STR(response_out, reply);
+        return SUCCESS;
+    }
+    int result = quicpro_iibin_decode_message((const unsigned char *)ZSTR_VAL(reply), ZSTR_LEN(reply), output, response_out, 0);
+    zend_string_release(reply);
+    return result;
+}
+
+/*
+ * Buffers `event` (an array, consumed) as `event_type`, stamped with the
+ * wall clock in milliseconds. Nothing leaves the worker here; with the
+ * ring full the event is dropped and counted.
+ */
+static void log_pipeline_event(const char *event_type, zval *event) {
+    if (!g_auto_logging_enabled || !g_logger_agent_target) {
+        zval_ptr_dtor(event);
+        return;
+    }
+    if (g_log.tail - g_log.head > g_log.mask) {
+        g_log_stats.dropped++;
+        zval_ptr_dtor(event);
+        return;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    add_assoc_string(event, "event", (char *)event_type);
+    add_assoc_long(event, "at_ms", (zend_long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+    if (g_log.tail == g_log.head) {
+        g_log.first_ms = mcp_call_now_ms();
+    }
+    ZVAL_COPY_VALUE(&g_log.ring[g_log.tail++ & g_log.mask], event);
+}
+
+/*
+ * Sends the buffered events to the logger agent, batch_size per call as
+ * one message whose events_field repeats them. Without `all`, only once a
+ * batch is full or the oldest event has waited flush_interval_ms; a run
+ * calls this as it ends, so the steps never wait on the logger. A batch
+ * the agent does not take is lost and counted, and never fails a run.
+ */
+static void pipeline_log_flush(bool all) {
+    if (!g_log.ring || EG(exception)) {
+        return;                     /* An exception on its way stays untouched; the events wait */
+    }
+    while (g_log.tail != g_log.head) {
+        uint32_t buffered = g_log.tail - g_log.head;
+        if (!all && buffered < g_log.batch_size && mcp_call_now_ms() - g_log.first_ms < g_log.flush_interval_ms) {
+            return;
+        }
+        uint32_t n = MIN(buffered, g_log.batch_size);
+        zval payload, events, reply;
+        array_init_size(&payload, 1);
+        array_init_size(&events, n);
+        for (uint32_t k = 0; k < n; k++) {
+            zend_hash_next_index_insert(Z_ARRVAL(events), &g_log.ring[g_log.head++ & g_log.mask]);
+        }
+        zend_hash_update(Z_ARRVAL(payload), g_log.events_field, &events);
+        g_log.first_ms = mcp_call_now_ms();
+
+        if (execute_mcp_call(g_logger_agent_target, &payload, g_log.batch_schema, NULL, &reply, NULL) == SUCCESS) {
+            zval_ptr_dtor(&reply);
+            g_log_stats.batches_sent++;
+            g_log_stats.sent += n;
+        } else {
+            zend_clear_exception();
+            g_log_stats.batches_failed++;
+            g_log_stats.lost += n;
+        }
+        zval_ptr_dtor(&payload);
+    }
+}
+
+static void pipeline_log_free(void) {
+    if (g_log.ring) {
+        for (; g_log.head != g_log.tail; g_log.head++) {
+            zval_ptr_dtor(&g_log.ring[g_log.head & g_log.mask]);
+            g_log_stats.lost++;
+        }
+        efree(g_log.ring);
+    }
+    if (g_log.batch_schema) efree(g_log.batch_schema);
+    if (g_log.events_field) zend_string_release(g_log.events_field);
+    memset(&g_log, 0, sizeof(g_log));
+    if (g_logger_agent_target) {
+        quicpro_mcp_target_destroy(g_logger_agent_target);
+        efree(g_logger_agent_target);
+        g_logger_agent_target = NULL;
+    }
+    g_auto_logging_enabled = 0;
 }
\ No newline at end of file
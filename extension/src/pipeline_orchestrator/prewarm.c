@@ -0,0 +1,418 @@
+/*
+ * src/prewarm.c – Keeping a serverless tool's executors warm
+ * ==========================================================
+ *
+ * See include/pipeline_orchestrator/prewarm.h. What the agent knows is
+ * what this worker has seen of the tool: its own calls, its own warm-ups.
+ */
+
+#include "php_quicpro.h"
+#include "prewarm.h"
+#include "tool_handler_registry.h"
+#include "mcp.h"
+#include "cancel.h" /* For error throwing helpers */
+#include "config/mcp_and_orchestrator/base_layer.h"
+
+#include <zend_API.h>
+#include <zend_exceptions.h>
+#include <zend_hash.h>
+#include <zend_interfaces.h>
+#if PHP_VERSION_ID >= 80100
+#include <zend_fibers.h>
+#endif
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PREWARM_RING_MASK       (QUICPRO_PREWARM_RING - 1)
+#define PREWARM_RATE_HORIZONS   10      /* The call rate is taken over this many horizons */
+#define PREWARM_MAX_EXECUTORS   1024
+
+static zend_long pw_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (zend_long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*──── Configuration ────*/
+
+static int pw_parse_long(HashTable *ht, const char *key, zend_long min, zend_long max, zend_long *out, const char *context_for_error) {
+    zval *zv = zend_hash_str_find(ht, key, strlen(key));
+    if (!zv) {
+        return SUCCESS;
+    }
+    if (Z_TYPE_P(zv) != IS_LONG || Z_LVAL_P(zv) < min || Z_LVAL_P(zv) > max) {
+        throw_pipeline_error_as_php_exception(0, "Invalid 'prewarm' for '%s': '%s' must be an integer from " ZEND_LONG_FMT " to " ZEND_LONG_FMT ".",
+                                              context_for_error, key, min, max);
+        return FAILURE;
+    }
+    *out = Z_LVAL_P(zv);
+    return SUCCESS;
+}
+
+quicpro_prewarm_t *quicpro_prewarm_parse(HashTable *ht, const char *context_for_error) {
+    zval *zv_method = zend_hash_str_find(ht, "method", sizeof("method")-1);
+    if (!zv_method || Z_TYPE_P(zv_method) != IS_STRING || Z_STRLEN_P(zv_method) == 0) {
+        throw_pipeline_error_as_php_exception(0, "Invalid 'prewarm' for '%s': missing 'method' string.", context_for_error);
+        return NULL;
+    }
+    zend_long keep_warm_ms = 300000, horizon_ms = 2000, max = 8;
+    if (pw_parse_long(ht, "keep_warm_ms", 1, ZEND_LONG_MAX / 2, &keep_warm_ms, context_for_error) == FAILURE
+     || pw_parse_long(ht, "horizon_ms", 1, ZEND_LONG_MAX / (2 * PREWARM_RATE_HORIZONS), &horizon_ms, context_for_error) == FAILURE
+     || pw_parse_long(ht, "max", 1, PREWARM_MAX_EXECUTORS, &max, context_for_error) == FAILURE) {
+        return NULL;
+    }
+
+    quicpro_prewarm_t *pw = ecalloc(1, sizeof(quicpro_prewarm_t));
+    pw->method = estrndup(Z_STRVAL_P(zv_method), Z_STRLEN_P(zv_method));
+    pw->keep_warm_ms = keep_warm_ms;
+    pw->horizon_ms = horizon_ms;
+    pw->max = (uint32_t)max;
+    pw->executors = ecalloc(pw->max, sizeof(quicpro_prewarm_executor_t));
+    return pw;
+}
+
+void quicpro_prewarm_free(quicpro_prewarm_t *pw) {
+    efree(pw->method);
+    efree(pw->executors);
+    efree(pw);
+}
+
+/*──── Calls ────*/
+
+int quicpro_prewarm_acquire(quicpro_prewarm_t *pw, quicpro_mcp_endpoint_set_t *set) {
+    zend_long now = pw_now_ms();
+    if (!pw->head || now - pw->ring[(pw->head - 1) & PREWARM_RING_MASK] > pw->horizon_ms) {
+        pw->bursts[pw->burst_head % QUICPRO_PREWARM_BURSTS].start_ms = now;
+        pw->bursts[pw->burst_head % QUICPRO_PREWARM_BURSTS].peak = 0;
+        pw->burst_head++;
+    }
+    pw->ring[pw->head++ & PREWARM_RING_MASK] = now;
+    pw->inflight++;
+    uint32_t *peak = &pw->bursts[(pw->burst_head - 1) % QUICPRO_PREWARM_BURSTS].peak;
+    *peak = MAX(*peak, pw->inflight);
+
+    /* The idle warm executor used last; one at an endpoint out of rotation counts as cold */
+    for (;;) {
+        int best = -1;
+        for (uint32_t i = 0; i < pw->max; i++) {
+            const quicpro_prewarm_executor_t *ex = &pw->executors[i];
+            if (!ex->busy && ex->warm_until_ms > now && ex->endpoint < set->count
+             && (best < 0 || ex->warm_until_ms > pw->executors[best].warm_until_ms)) {
+                best = (int)i;
+            }
+        }
+        if (best < 0) {
+            pw->cold_calls++;
+            return -1;
+        }
+        quicpro_prewarm_executor_t *ex = &pw->executors[best];
+        if (quicpro_mcp_endpoint_take(&set->endpoints[ex->endpoint])) {
+            ex->busy = true;
+            pw->warm_hits++;
+            return best;
+        }
+        ex->warm_until_ms = 0;
+    }
+}
+
+void quicpro_prewarm_release(quicpro_prewarm_t *pw, int executor, uint32_t endpoint, zend_long latency_ms, bool ok) {
+    if (pw->inflight) {
+        pw->inflight--;
+    }
+    if (ok) {
+        double sample = (double)MAX(latency_ms, 0);
+        pw->latency_ms = pw->latency_ms > 0 ? pw->latency_ms + QUICPRO_PREWARM_EWMA_ALPHA * (sample - pw->latency_ms) : MAX(sample, 1.0);
+    }
+
+    quicpro_prewarm_executor_t *ex = executor >= 0 && (uint32_t)executor < pw->max ? &pw->executors[executor] : NULL;
+    if (!ex && ok) {
+        /* The instance that answered is warm now: the idle executor that went cold first stands for it */
+        for (uint32_t i = 0; i < pw->max; i++) {
+            if (!pw->executors[i].busy && (!ex || pw->executors[i].warm_until_ms < ex->warm_until_ms)) {
+                ex = &pw->executors[i];
+            }
+        }
+        if (ex) {
+            ex->endpoint = endpoint;
+        }
+    }
+    if (ex) {
+        ex->busy = false;
+        ex->warm_until_ms = ok ? pw_now_ms() + pw->keep_warm_ms : 0;
+    }
+}
+
+/*──── Prediction ────*/
+
+static int pw_cmp_long(const void *a, const void *b) {
+    zend_long x = *(const zend_long *)a, y = *(const zend_long *)b;
+    return (x > y) - (x < y);
+}
+
+/* The largest recent burst's overlap while a burst runs or the next is due within the horizon; 0 otherwise. */
+static uint32_t pw_burst_need(const quicpro_prewarm_t *pw, zend_long now) {
+    uint32_t n = MIN(pw->burst_head, QUICPRO_PREWARM_BURSTS), peak = 0;
+    if (n == 0) {
+        return 0;
+    }
+    for (uint32_t k = 0; k < n; k++) {
+        peak = MAX(peak, pw->bursts[k].peak);
+    }
+    if (now - pw->ring[(pw->head - 1) & PREWARM_RING_MASK] <= pw->horizon_ms) {
+        return peak;
+    }
+    if (n < 3) {
+        return 0;                       /* Two bursts make one spacing, not a pattern */
+    }
+
+    zend_long gaps[QUICPRO_PREWARM_BURSTS - 1];
+    uint32_t first = pw->burst_head - n;
+    for (uint32_t k = 1; k < n; k++) {
+        gaps[k - 1] = pw->bursts[(first + k) % QUICPRO_PREWARM_BURSTS].start_ms - pw->bursts[(first + k - 1) % QUICPRO_PREWARM_BURSTS].start_ms;
+    }
+    qsort(gaps, n - 1, sizeof(zend_long), pw_cmp_long);
+    zend_long spacing = MAX(gaps[(n - 1) / 2], 1);
+
+    /* Bursts that did not come leave the rhythm as it was */
+    zend_long due = pw->bursts[(pw->burst_head - 1) % QUICPRO_PREWARM_BURSTS].start_ms + spacing;
+    if (due < now - pw->horizon_ms) {
+        due += spacing * ((now - pw->horizon_ms - due) / spacing + 1);
+    }
+    return due - now <= pw->horizon_ms ? peak : 0;
+}
+
+uint32_t quicpro_prewarm_predict(const quicpro_prewarm_t *pw) {
+    zend_long now = pw_now_ms();
+    uint32_t need = pw->inflight;
+
+    if (pw->head && pw->latency_ms > 0) {
+        /* Little's law: arrivals per millisecond times the milliseconds each stays */
+        zend_long window = pw->horizon_ms * PREWARM_RATE_HORIZONS;
+        uint32_t kept = MIN(pw->head, QUICPRO_PREWARM_RING), n = 0;
+        while (n < kept && now - pw->ring[(pw->head - 1 - n) & PREWARM_RING_MASK] <= window) {
+            n++;
+        }
+        if (n == QUICPRO_PREWARM_RING) {
+            window = MAX(now - pw->ring[pw->head & PREWARM_RING_MASK], 1);   /* The ring spans less */
+        }
+        double little = ceil((double)n * pw->latency_ms / (double)window);
+        need = MAX(need, (uint32_t)MIN(little, (double)pw->max));
+    }
+
+    need = MAX(need, pw_burst_need(pw, now));
+    return MIN(need, pw->max);
+}
+
+/*──── Warm-ups ────*/
+
+/* Ends a warm-up's wait for its Fiber; the unwinding of one destroyed mid-call goes on. */
+static void pw_clear_exception(void) {
+    if (!EG(exception)) {
+        return;
+    }
+#if PHP_VERSION_ID >= 80100
+    if (zend_is_unwind_exit(EG(exception)) || zend_is_graceful_exit(EG(exception))) {
+        return;
+    }
+#endif
+    zend_clear_exception();
+}
+
+static void pw_warmup_end(quicpro_mcp_target_config_t *target, uint32_t slot, bool ok) {
+    quicpro_prewarm_t *pw = target->prewarm;
+    quicpro_prewarm_executor_t *ex = &pw->executors[slot];
+    quicpro_mcp_endpoint_cancel(&target->endpoints.endpoints[ex->endpoint]);   /* A cold start says nothing of the endpoint */
+    ex->busy = false;
+    ex->warm_until_ms = ok ? pw_now_ms() + pw->keep_warm_ms : 0;
+    if (!ok) {
+        pw->warmups_failed++;
+    }
+}
+
+/* One warm-up call to executor `slot`'s endpoint; its reply is dropped, a failure leaves the executor cold. */
+static void pw_warmup_run(quicpro_mcp_target_config_t *target, uint32_t slot) {
+    const quicpro_mcp_endpoint_t *ep = &target->endpoints.endpoints[target->prewarm->executors[slot].endpoint];
+    HashTable *connect_options = Z_TYPE(target->mcp_client_options_php_array) == IS_ARRAY ? Z_ARRVAL(target->mcp_client_options_php_array) : NULL;
+    bool ok = false;
+
+    zend_resource *res = quicpro_mcp_open(ep->host, strlen(ep->host), ep->port, target->cfg, connect_options);
+    if (res) {
+        zval z_session, payload, call_options, reply;
+        ZVAL_RES(&z_session, res);
+        ZVAL_EMPTY_STRING(&payload);
+        array_init_size(&call_options, 1);
+        add_assoc_long(&call_options, "timeout_ms", target->timeout_ms > 0 ? target->timeout_ms : quicpro_mcp_orchestrator_config.mcp_default_request_timeout_ms);
+        ok = quicpro_mcp_call((quicpro_session_t *)res->ptr, target->service_name, target->prewarm->method,
+                              &payload, Z_ARRVAL(call_options), &reply, NULL) == SUCCESS;
+        if (ok) {
+            zval_ptr_dtor(&reply);
+        }
+        zval_ptr_dtor(&call_options);
+        zval_ptr_dtor(&payload);
+        zval_ptr_dtor(&z_session);   /* Back to the pool, or closed */
+    }
+    pw_clear_exception();
+    pw_warmup_end(target, slot, ok);
+}
+
+#if PHP_VERSION_ID >= 80100
+static quicpro_mcp_target_config_t *pw_starting;   /* For the Fiber that starts next */
+static uint32_t pw_starting_slot;
+static zend_internal_function pw_entry;
+static bool pw_entry_ready;
+static zval *pw_fibers;           /* Started, not yet seen terminated */
+static uint32_t pw_fiber_count, pw_fiber_cap;
+
+/* The body of a warm-up's Fiber; quicpro_prewarm_tick() hands it the executor. */
+static ZEND_NAMED_FUNCTION(pw_fiber_main) {
+    quicpro_mcp_target_config_t *target = pw_starting;
+    if (target) {
+        pw_starting = NULL;
+        pw_warmup_run(target, pw_starting_slot);
+    }
+    RETURN_NULL();
+}
+
+/* Drops the Fibers whose warm-up has ended. */
+static void pw_reap(void) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < pw_fiber_count; i++) {
+        zval terminated;
+        ZVAL_UNDEF(&terminated);
+        zend_call_method_with_0_params(Z_OBJ(pw_fibers[i]), zend_ce_fiber, NULL, "isterminated", &terminated);
+        if (Z_TYPE(terminated) == IS_TRUE) {
+            zval_ptr_dtor(&pw_fibers[i]);
+        } else {
+            ZVAL_COPY_VALUE(&pw_fibers[kept++], &pw_fibers[i]);
+        }
+    }
+    pw_fiber_count = kept;
+}
+#endif
+
+/* Starts the warm-up of executor `slot`, in a Fiber of its own where there are Fibers. */
+static int pw_warmup_start(quicpro_mcp_target_config_t *target, uint32_t slot) {
+#if PHP_VERSION_ID >= 80100
+    if (!pw_entry_ready) {
+        memset(&pw_entry, 0, sizeof(pw_entry));
+        pw_entry.type = ZEND_INTERNAL_FUNCTION;
+        pw_entry.function_name = zend_string_init("{pipeline prewarm}", sizeof("{pipeline prewarm}") - 1, 0);
+        pw_entry.handler = pw_fiber_main;
+        pw_entry_ready = true;
+    }
+    if (pw_fiber_count == pw_fiber_cap) {
+        pw_fiber_cap = pw_fiber_cap ? pw_fiber_cap * 2 : 8;
+        pw_fibers = erealloc(pw_fibers, pw_fiber_cap * sizeof(zval));
+    }
+    zval *fiber = &pw_fibers[pw_fiber_count], closure, retval;
+    zend_create_closure(&closure, (zend_function *)&pw_entry, NULL, NULL, NULL);
+    object_init_ex(fiber, zend_ce_fiber);
+    zend_call_known_instance_method_with_1_params(zend_ce_fiber->constructor, Z_OBJ_P(fiber), NULL, &closure);
+    zval_ptr_dtor(&closure);
+    pw_fiber_count++;
+
+    pw_starting = target;
+    pw_starting_slot = slot;
+    if (!EG(exception)) {
+        ZVAL_UNDEF(&retval);
+        zend_call_method_with_0_params(Z_OBJ_P(fiber), zend_ce_fiber, NULL, "start", &retval);
+        zval_ptr_dtor(&retval);
+    }
+    if (pw_starting) {
+        /* The Fiber never ran: the executor is released here */
+        pw_starting = NULL;
+        zval_ptr_dtor(&pw_fibers[--pw_fiber_count]);
+        pw_clear_exception();
+        pw_warmup_end(target, slot, false);
+        return FAILURE;
+    }
+    return SUCCESS;
+#else
+    pw_warmup_run(target, slot);
+    return SUCCESS;
+#endif
+}
+
+uint32_t quicpro_prewarm_tick(quicpro_mcp_target_config_t *target) {
+    quicpro_prewarm_t *pw = target->prewarm;
+    quicpro_mcp_endpoint_set_t *set = &target->endpoints;
+    if (!pw || !set->count || EG(exception)) {
+        return 0;
+    }
+#if PHP_VERSION_ID >= 80100
+    pw_reap();
+#endif
+
+    zend_long now = pw_now_ms(), ready = now + pw->horizon_ms;
+    uint32_t need = quicpro_prewarm_predict(pw), hot = 0, started = 0;
+    for (uint32_t i = 0; i < pw->max; i++) {
+        hot += pw->executors[i].busy || pw->executors[i].warm_until_ms >= ready;
+    }
+
+    while (hot < need) {
+        /* Of the executors cold by then, the one still warm longest: a call refreshes it rather than starting another */
+        int slot = -1;
+        for (uint32_t i = 0; i < pw->max; i++) {
+            const quicpro_prewarm_executor_t *ex = &pw->executors[i];
+            if (!ex->busy && ex->warm_until_ms < ready && (slot < 0 || ex->warm_until_ms > pw->executors[slot].warm_until_ms)) {
+                slot = (int)i;
+            }
+        }
+        if (slot < 0) {
+            break;
+        }
+        quicpro_prewarm_executor_t *ex = &pw->executors[slot];
+        if (!(ex->warm_until_ms > now && ex->endpoint < set->count && quicpro_mcp_endpoint_take(&set->endpoints[ex->endpoint]))) {
+            ex->endpoint = (uint32_t)(quicpro_mcp_endpoint_pick(set, NULL) - set->endpoints);
+        }
+        ex->busy = true;
+        hot++;
+        started++;
+        pw->warmups_sent++;
+        if (pw_warmup_start(target, (uint32_t)slot) == FAILURE) {
+            break;
+        }
+    }
+    return started;
+}
+
+/*──── Introspection and lifecycle ────*/
+
+void quicpro_prewarm_stats(const quicpro_prewarm_t *pw, zval *stats) {
+    zend_long now = pw_now_ms();
+    uint32_t warm = 0, busy = 0;
+    for (uint32_t i = 0; i < pw->max; i++) {
+        busy += pw->executors[i].busy;
+        warm += !pw->executors[i].busy && pw->executors[i].warm_until_ms > now;
+    }
+    array_init_size(stats, 9);
+    add_assoc_long(stats, "predicted", quicpro_prewarm_predict(pw));
+    add_assoc_long(stats, "warm", warm);
+    add_assoc_long(stats, "busy", busy);
+    add_assoc_long(stats, "inflight", pw->inflight);
+    add_assoc_double(stats, "latency_ms", pw->latency_ms);
+    add_assoc_long(stats, "warmups_sent", pw->warmups_sent);
+    add_assoc_long(stats, "warmups_failed", pw->warmups_failed);
+    add_assoc_long(stats, "warm_hits", pw->warm_hits);
+    add_assoc_long(stats, "cold_calls", pw->cold_calls);
+}
+
+void quicpro_prewarm_rshutdown(void) {
+#if PHP_VERSION_ID >= 80100
+    for (uint32_t i = 0; i < pw_fiber_count; i++) {
+        zval_ptr_dtor(&pw_fibers[i]);   /* One still waiting unwinds, and releases its executor */
+    }
+    if (pw_fibers) {
+        efree(pw_fibers);
+    }
+    pw_fibers = NULL;
+    pw_fiber_count = pw_fiber_cap = 0;
+    if (pw_entry_ready) {
+        zend_string_release(pw_entry.function_name);
+        pw_entry_ready = false;
+    }
+    pw_starting = NULL;
+#endif
+}
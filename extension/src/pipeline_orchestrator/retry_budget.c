@@ -0,0 +1,73 @@
+/*
+ * src/retry_budget.c – Retrying failed tool calls within a budget
+ * ===============================================================
+ *
+ * See include/pipeline_orchestrator/retry_budget.h. The window is a ring
+ * of MCP_RETRY_BUCKETS counters, rolled forward as calls come, so asking
+ * for a retry is a sum over ten slots and allocates nothing.
+ */
+
+#include "php_quicpro.h"
+#include "retry_budget.h"
+#include "config/mcp_and_orchestrator/base_layer.h"
+
+#include <ext/standard/php_rand.h>
+#include <string.h>
+#include <time.h>
+
+#define RETRY_BUCKET_MS (MCP_RETRY_WINDOW_MS / MCP_RETRY_BUCKETS)
+
+static zend_long rb_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (zend_long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Moves the head to the bucket of now, emptying the ones it passes. */
+static void rb_roll(quicpro_mcp_retry_budget_t *b) {
+    zend_long now = rb_now_ms();
+    if (b->head_ms == 0 || now - b->head_ms >= MCP_RETRY_WINDOW_MS) {
+        memset(b, 0, sizeof(*b));
+        b->head_ms = now;
+        return;
+    }
+    while (now - b->head_ms >= RETRY_BUCKET_MS) {
+        b->head = (b->head + 1) % MCP_RETRY_BUCKETS;
+        b->calls[b->head] = b->retries[b->head] = 0;
+        b->head_ms += RETRY_BUCKET_MS;
+    }
+}
+
+void quicpro_mcp_retry_note_call(quicpro_mcp_retry_budget_t *budget) {
+    rb_roll(budget);
+    budget->calls[budget->head]++;
+}
+
+zend_long quicpro_mcp_retry_backoff(quicpro_mcp_retry_budget_t *budget, uint32_t attempt, zend_long remaining_ms) {
+    const qp_mcp_orchestrator_config_t *cfg = &quicpro_mcp_orchestrator_config;
+    if (!cfg->mcp_default_retry_policy_enable || attempt >= (uint64_t)cfg->mcp_default_retry_max_attempts || remaining_ms <= 0) {
+        return -1;
+    }
+
+    rb_roll(budget);
+    uint64_t calls = 0, retries = 0;
+    for (uint32_t k = 0; k < MCP_RETRY_BUCKETS; k++) {
+        calls += budget->calls[k];
+        retries += budget->retries[k];
+    }
+    if (retries * 100 >= MAX(calls * (uint64_t)cfg->mcp_retry_budget_percent, (uint64_t)MCP_RETRY_BUDGET_MIN * 100)) {
+        return -1;
+    }
+
+    /* Full jitter: anywhere between 0 and the exponential step */
+    zend_long cap = cfg->mcp_default_retry_backoff_ms_initial;
+    for (uint32_t k = 1; k < attempt && cap < MCP_RETRY_BACKOFF_MAX_MS; k++) {
+        cap *= 2;
+    }
+    zend_long wait_ms = php_mt_rand_range(0, MIN(cap, MCP_RETRY_BACKOFF_MAX_MS));
+    if (wait_ms >= remaining_ms) {
+        return -1;                  /* The retry would start after the deadline */
+    }
+    budget->retries[budget->head]++;
+    return wait_ms;
+}
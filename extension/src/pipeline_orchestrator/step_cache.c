@@ -0,0 +1,157 @@
+/*
+ * src/pipeline_orchestrator/step_cache.c – Memoized results of deterministic pipeline tools
+ * ========================================================================================
+ *
+ * See include/pipeline_orchestrator/step_cache.h. The table is a
+ * cluster/shm_cache.h slot table whose slot size is fixed when it is
+ * mapped.
+ */
+
+#include "php_quicpro.h"
+#include "pipeline_orchestrator/step_cache.h"
+#include "cluster/shm_cache.h"
+#include "config/mcp_and_orchestrator/base_layer.h"
+
+#include <string.h>
+#include <sys/mman.h>
+
+typedef struct {
+    quicpro_shm_cache_slot_t head;
+    uint64_t      check;
+    uint32_t      request_len;
+    uint32_t      len;
+    unsigned char reply[];
+} quicpro_step_slot_t;
+
+static quicpro_shm_cache_t quicpro_step_table;
+
+/* Per worker, as are the other stats */
+static ZEND_TLS struct {
+    zend_long hits, misses, stores, oversized;
+} quicpro_step_stats;
+
+static inline size_t quicpro_step_capacity(void)
+{
+    return quicpro_step_table.slot_size - sizeof(quicpro_step_slot_t);
+}
+
+static bool quicpro_step_map(int flags)
+{
+    const qp_mcp_orchestrator_config_t *cfg = &quicpro_mcp_orchestrator_config;
+    return quicpro_shm_cache_map(&quicpro_step_table, (size_t)cfg->mcp_request_cache_entries,
+                                 sizeof(quicpro_step_slot_t) + (size_t)cfg->mcp_request_cache_entry_max_kb * 1024, flags);
+}
+
+static bool quicpro_step_ready(void)
+{
+    if (!quicpro_mcp_orchestrator_config.mcp_enable_request_caching) {
+        return false;
+    }
+    if (!quicpro_step_table.slots && !quicpro_step_map(MAP_PRIVATE)) {
+        return false;
+    }
+    return true;
+}
+
+static inline bool quicpro_step_matches(const quicpro_step_slot_t *slot, const quicpro_step_cache_key_t *key)
+{
+    return slot->check == key->check && slot->request_len == key->request_len;
+}
+
+/*──────────────────────────── Lifecycle ──────────────────────────────────*/
+
+void quicpro_step_cache_prepare(void)
+{
+    const qp_mcp_orchestrator_config_t *cfg = &quicpro_mcp_orchestrator_config;
+    if (quicpro_step_table.slots || !cfg->mcp_enable_request_caching || !cfg->mcp_request_cache_shared) {
+        return;
+    }
+    if (!quicpro_step_map(MAP_SHARED)) {
+        php_error_docref(NULL, E_WARNING, "Shared pipeline step cache unavailable; every worker falls back to its own");
+    }
+}
+
+void quicpro_step_cache_release(void)
+{
+    quicpro_shm_cache_unmap(&quicpro_step_table);
+}
+
+/*──────────────────────────── Lookup / store ─────────────────────────────*/
+
+void quicpro_step_cache_key(quicpro_step_cache_key_t *key, const char *tool, const char *request, size_t request_len)
+{
+    /* Two unrelated hashes: DJB (Zend's) picks the slot, FNV-1a confirms the hit */
+    uint64_t h = zend_inline_hash_func(tool, strlen(tool));
+    h = h * 33 ^ zend_inline_hash_func(request, request_len);
+    uint64_t check = 0xcbf29ce484222325ULL;
+    for (const char *p = tool; *p; p++) {
+        check = (check ^ (unsigned char)*p) * 0x100000001b3ULL;
+    }
+    check = (check ^ 0xff) * 0x100000001b3ULL;
+    for (size_t i = 0; i < request_len; i++) {
+        check = (check ^ (unsigned char)request[i]) * 0x100000001b3ULL;
+    }
+    key->key = h | 1;
+    key->check = check;
+    key->request_len = (uint32_t)request_len;
+}
+
+zend_string *quicpro_step_cache_get(const quicpro_step_cache_key_t *key)
+{
+    if (!quicpro_step_ready()) {
+        return NULL;
+    }
+    uint64_t now = quicpro_shm_cache_now_ms();
+    for (size_t way = 0; way < 2; way++) {
+        quicpro_step_slot_t *slot = (quicpro_step_slot_t *)quicpro_shm_cache_find(&quicpro_step_table, key->key, way);
+        if (!slot) {
+            continue;
+        }
+        zend_string *reply = NULL;
+        if (quicpro_shm_cache_live(&slot->head, key->key, now) && quicpro_step_matches(slot, key)) {
+            reply = zend_string_init((const char *)slot->reply, slot->len, 0);
+        }
+        quicpro_shm_cache_unlock(&slot->head);
+        if (reply) {
+            quicpro_step_stats.hits++;
+            return reply;
+        }
+    }
+    quicpro_step_stats.misses++;
+    return NULL;
+}
+
+void quicpro_step_cache_put(const quicpro_step_cache_key_t *key, const zend_string *reply, zend_long ttl_ms)
+{
+    if (ttl_ms <= 0 || !quicpro_step_ready()) {
+        return;
+    }
+    if (ZSTR_LEN(reply) > quicpro_step_capacity()) {
+        quicpro_step_stats.oversized++;
+        return;
+    }
+
+    uint64_t now = quicpro_shm_cache_now_ms();
+    quicpro_step_slot_t *slot = (quicpro_step_slot_t *)quicpro_shm_cache_claim(&quicpro_step_table, key->key, now);
+    if (!slot) {
+        return;
+    }
+    quicpro_shm_cache_set(&slot->head, key->key, now + (uint64_t)ttl_ms);
+    slot->check = key->check;
+    slot->request_len = key->request_len;
+    slot->len = (uint32_t)ZSTR_LEN(reply);
+    memcpy(slot->reply, ZSTR_VAL(reply), ZSTR_LEN(reply));
+    quicpro_shm_cache_unlock(&slot->head);
+    quicpro_step_stats.stores++;
+}
+
+void quicpro_step_cache_add_stats(zval *into)
+{
+    add_assoc_bool(into, "step_cache_enabled", quicpro_mcp_orchestrator_config.mcp_enable_request_caching);
+    add_assoc_bool(into, "step_cache_shared", quicpro_step_table.shared);
+    add_assoc_long(into, "step_cache_slots", (zend_long)quicpro_step_table.nslots);
+    add_assoc_long(into, "step_cache_hits", quicpro_step_stats.hits);
+    add_assoc_long(into, "step_cache_misses", quicpro_step_stats.misses);
+    add_assoc_long(into, "step_cache_stores", quicpro_step_stats.stores);
+    add_assoc_long(into, "step_cache_oversized", quicpro_step_stats.oversized);
+}
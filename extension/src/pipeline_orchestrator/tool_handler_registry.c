@@ -13,6 +13,8 @@
 #include "php_quicpro.h"
 #include "tool_handler_registry.h"
 #include "cancel.h" /* For error throwing helpers */
+#include "config/config.h" /* quicpro_config_new_from_options() for the targets' connections */
+#include "config/mcp_and_orchestrator/base_layer.h" /* The default TTL of cached replies */
 
 #include <zend_API.h>
 #include <zend_hash.h>
@@ -23,9 +25,7 @@ static HashTable quicpro_tool_handler_registry;
 static zend_bool quicpro_tool_registry_initialized = 0;
 
 /* --- Static Helper Function Prototypes --- */
-static int parse_mcp_target_config_from_php(HashTable *php_ht, quicpro_mcp_target_config_t *target_out, const char *context_for_error);
 static int parse_rag_config_from_php(HashTable *php_ht, quicpro_rag_config_t *rag_out, const char *tool_name_for_error);
-static void destroy_mcp_target_config_contents(quicpro_mcp_target_config_t *target);
 static void destroy_rag_config_contents(quicpro_rag_config_t *rag);
 static void tool_handler_config_dtor_internal(zval *pData);
 static quicpro_tool_handler_config_t* create_tool_handler_from_php(const char *tool_name, HashTable *config_ht);
@@ -37,11 +37,15 @@ static quicpro_tool_handler_config_t* create_tool_handler_from_php(const char *t
  * @brief Frees memory allocated for the contents of an MCP target configuration struct.
  * @param target The MCP target config struct whose contents are to be freed.
  */
-static void destroy_mcp_target_config_contents(quicpro_mcp_target_config_t *target) {
+void quicpro_mcp_target_destroy(quicpro_mcp_target_config_t *target) {
     if (!target) return;
     if (target->host) efree(target->host);
     if (target->service_name) efree(target->service_name);
     if (target->method_name) efree(target->method_name);
+    if (target->hedge_host) efree(target->hedge_host);
+    if (target->cfg) quicpro_config_free(target->cfg);
+    if (target->prewarm) quicpro_prewarm_free(target->prewarm);
+    quicpro_mcp_endpoints_destroy(&target->endpoints);
     if (Z_TYPE(target->mcp_client_options_php_array) != IS_UNDEF) {
         zval_ptr_dtor(&target->mcp_client_options_php_array);
     }
@@ -53,13 +57,14 @@ static void destroy_mcp_target_config_contents(quicpro_mcp_target_config_t *targ
  */
 static void destroy_rag_config_contents(quicpro_rag_config_t *rag) {
     if (!rag) return;
-    destroy_mcp_target_config_contents(&rag->rag_agent_target);
+    quicpro_mcp_target_destroy(&rag->rag_agent_target);
     if (rag->enabled_param_key) efree(rag->enabled_param_key);
     if (rag->request_proto_schema) efree(rag->request_proto_schema);
     if (rag->response_proto_schema) efree(rag->response_proto_schema);
     if (rag->context_output_field_in_rag_response) efree(rag->context_output_field_in_rag_response);
     if (rag->target_context_field_in_llm_request) efree(rag->target_context_field_in_llm_request);
     if (rag->topics_from_param_key) efree(rag->topics_from_param_key);
+    if (rag->local_index) efree(rag->local_index);
     if (rag->topics_from_previous_step.source_tool_name_or_id) efree(rag->topics_from_previous_step.source_tool_name_or_id);
     if (rag->topics_from_previous_step.source_field_name) efree(rag->topics_from_previous_step.source_field_name);
     if (rag->rag_param_map) {
@@ -76,7 +81,7 @@ static void tool_handler_config_dtor_internal(zval *pData) {
     quicpro_tool_handler_config_t *handler = (quicpro_tool_handler_config_t *)Z_PTR_P(pData);
     if (handler) {
         if (handler->tool_name) efree(handler->tool_name);
-        destroy_mcp_target_config_contents(&handler->mcp_target);
+        quicpro_mcp_target_destroy(&handler->mcp_target);
         if (handler->input_proto_schema) efree(handler->input_proto_schema);
         if (handler->output_proto_schema) efree(handler->output_proto_schema);
         if (handler->param_map) {
@@ -117,6 +122,14 @@ const quicpro_tool_handler_config_t* quicpro_tool_handler_get(const char *tool_n
     return (quicpro_tool_handler_config_t *)zend_hash_str_find_ptr(&quicpro_tool_handler_registry, tool_name, strlen(tool_name));
 }
 
+void quicpro_tool_handler_foreach(void (*fn)(quicpro_tool_handler_config_t *handler, void *arg), void *arg) {
+    if (!quicpro_tool_registry_initialized) return;
+    quicpro_tool_handler_config_t *handler;
+    ZEND_HASH_FOREACH_PTR(&quicpro_tool_handler_registry, handler) {
+        fn(handler, arg);
+    } ZEND_HASH_FOREACH_END();
+}
+
 
 /* --- Static C Helper Parsers --- */
 
@@ -127,22 +140,16 @@ const quicpro_tool_handler_config_t* quicpro_tool_handler_get(const char *tool_n
  * @param context_for_error A string (e.g., tool name) to include in error messages.
  * @return SUCCESS or FAILURE.
  */
-static int parse_mcp_target_config_from_php(HashTable *php_ht, quicpro_mcp_target_config_t *target_out, const char *context_for_error) {
+int quicpro_mcp_target_parse(HashTable *php_ht, quicpro_mcp_target_config_t *target_out, const char *context_for_error) {
     zval *zv_temp;
     memset(target_out, 0, sizeof(quicpro_mcp_target_config_t));
     ZVAL_UNDEF(&target_out->mcp_client_options_php_array);
 
-    if (!(zv_temp = zend_hash_str_find(php_ht, "host", sizeof("host")-1)) || Z_TYPE_P(zv_temp) != IS_STRING) {
-        throw_pipeline_error_as_php_exception(0, "Invalid 'mcp_target' for '%s': missing 'host' string.", context_for_error);
+    if (quicpro_mcp_endpoints_parse(php_ht, &target_out->endpoints, context_for_error) == FAILURE) {
         return FAILURE;
     }
-    target_out->host = estrndup(Z_STRVAL_P(zv_temp), Z_STRLEN_P(zv_temp));
-
-    if (!(zv_temp = zend_hash_str_find(php_ht, "port", sizeof("port")-1)) || Z_TYPE_P(zv_temp) != IS_LONG) {
-        throw_pipeline_error_as_php_exception(0, "Invalid 'mcp_target' for '%s': missing 'port' integer.", context_for_error);
-        return FAILURE;
-    }
-    target_out->port = Z_LVAL_P(zv_temp);
+    target_out->host = estrdup(target_out->endpoints.endpoints[0].host);
+    target_out->port = target_out->endpoints.endpoints[0].port;
 
     if (!(zv_temp = zend_hash_str_find(php_ht, "service_name", sizeof("service_name")-1)) || Z_TYPE_P(zv_temp) != IS_STRING) {
         throw_pipeline_error_as_php_exception(0, "Invalid 'mcp_target' for '%s': missing 'service_name' string.", context_for_error);
@@ -159,6 +166,43 @@ static int parse_mcp_target_config_from_php(HashTable *php_ht, quicpro_mcp_targe
     if ((zv_temp = zend_hash_str_find(php_ht, "mcp_options", sizeof("mcp_options")-1)) && Z_TYPE_P(zv_temp) == IS_ARRAY) {
         ZVAL_COPY(&target_out->mcp_client_options_php_array, zv_temp);
     }
+
+    if ((zv_temp = zend_hash_str_find(php_ht, "timeout_ms", sizeof("timeout_ms")-1)) && Z_TYPE_P(zv_temp) == IS_LONG) {
+        target_out->timeout_ms = Z_LVAL_P(zv_temp);
+    }
+
+    target_out->retry = !(zv_temp = zend_hash_str_find(php_ht, "retry", sizeof("retry")-1)) || zend_is_true(zv_temp);
+
+    target_out->hedge_after_ms = -1;
+    if ((zv_temp = zend_hash_str_find(php_ht, "hedge", sizeof("hedge")-1)) && Z_TYPE_P(zv_temp) == IS_ARRAY) {
+        HashTable *hedge_ht = Z_ARRVAL_P(zv_temp);
+        zval *zv_host = zend_hash_str_find(hedge_ht, "host", sizeof("host")-1);
+        zval *zv_port = zend_hash_str_find(hedge_ht, "port", sizeof("port")-1);
+        if (zv_host || zv_port) {
+            if (!zv_host || Z_TYPE_P(zv_host) != IS_STRING || !zv_port || Z_TYPE_P(zv_port) != IS_LONG) {
+                throw_pipeline_error_as_php_exception(0, "Invalid 'mcp_target' for '%s': 'hedge' needs a 'host' string and a 'port' integer.", context_for_error);
+                return FAILURE;
+            }
+            target_out->hedge_host = estrndup(Z_STRVAL_P(zv_host), Z_STRLEN_P(zv_host));
+            target_out->hedge_port = Z_LVAL_P(zv_port);
+        }
+        target_out->hedge = 1;
+        if ((zv_temp = zend_hash_str_find(hedge_ht, "after_ms", sizeof("after_ms")-1)) && Z_TYPE_P(zv_temp) == IS_LONG) {
+            target_out->hedge_after_ms = Z_LVAL_P(zv_temp);
+        }
+    }
+
+    if ((zv_temp = zend_hash_str_find(php_ht, "prewarm", sizeof("prewarm")-1)) && Z_TYPE_P(zv_temp) == IS_ARRAY) {
+        target_out->prewarm = quicpro_prewarm_parse(Z_ARRVAL_P(zv_temp), context_for_error);
+        if (!target_out->prewarm) {
+            return FAILURE;
+        }
+    }
+
+    target_out->cfg = quicpro_config_new_from_options(NULL);
+    if (!target_out->cfg) {
+        return FAILURE;
+    }
     return SUCCESS;
 }
 
@@ -173,12 +217,27 @@ static int parse_rag_config_from_php(HashTable *php_ht, quicpro_rag_config_t *ra
     zval *zv_temp;
     memset(rag_out, 0, sizeof(quicpro_rag_config_t));
 
-    /* Parse RAG Agent MCP Target (required within rag_config) */
-    if (!(zv_temp = zend_hash_str_find(php_ht, "mcp_target", sizeof("mcp_target")-1)) || Z_TYPE_P(zv_temp) != IS_ARRAY) {
-         throw_pipeline_error_as_php_exception(0, "Invalid 'rag_config' for tool '%s': missing 'mcp_target' array for RAG agent.", tool_name_for_error);
-        return FAILURE;
+    /* Retrieval from a vector index shared in this process, instead of a RAG agent */
+    if ((zv_temp = zend_hash_str_find(php_ht, "local_index", sizeof("local_index")-1)) && Z_TYPE_P(zv_temp) == IS_STRING) {
+        rag_out->local_index = estrndup(Z_STRVAL_P(zv_temp), Z_STRLEN_P(zv_temp));
+        rag_out->local_k = 5;
+        if ((zv_temp = zend_hash_str_find(php_ht, "local_k", sizeof("local_k")-1))) {
+            if (Z_TYPE_P(zv_temp) != IS_LONG || Z_LVAL_P(zv_temp) < 1 || Z_LVAL_P(zv_temp) > 1024) {
+                throw_pipeline_error_as_php_exception(0, "Invalid 'rag_config' for tool '%s': 'local_k' must be an integer within 1..1024.", tool_name_for_error);
+                return FAILURE;
+            }
+            rag_out->local_k = Z_LVAL_P(zv_temp);
+        }
+    }
+
+    /* Parse RAG Agent MCP Target (required within rag_config, unless it has a local index) */
+    if (!rag_out->local_index) {
+        if (!(zv_temp = zend_hash_str_find(php_ht, "mcp_target", sizeof("mcp_target")-1)) || Z_TYPE_P(zv_temp) != IS_ARRAY) {
+             throw_pipeline_error_as_php_exception(0, "Invalid 'rag_config' for tool '%s': missing 'mcp_target' array for RAG agent.", tool_name_for_error);
+            return FAILURE;
+        }
+        if (quicpro_mcp_target_parse(Z_ARRVAL_P(zv_temp), &rag_out->rag_agent_target, "RAG agent") == FAILURE) return FAILURE;
     }
-    if (parse_mcp_target_config_from_php(Z_ARRVAL_P(zv_temp), &rag_out->rag_agent_target, "RAG agent") == FAILURE) return FAILURE;
 
     /* Parse all other required and optional string fields */
 #define PARSE_RAG_STRING_FIELD(key) \
@@ -189,9 +248,11 @@ static int parse_rag_config_from_php(HashTable *php_ht, quicpro_rag_config_t *ra
         return FAILURE; \
     }
     PARSE_RAG_STRING_FIELD(enabled_param_key);
-    PARSE_RAG_STRING_FIELD(request_proto_schema);
-    PARSE_RAG_STRING_FIELD(response_proto_schema);
-    PARSE_RAG_STRING_FIELD(context_output_field_in_rag_response);
+    if (!rag_out->local_index) {
+        PARSE_RAG_STRING_FIELD(request_proto_schema);
+        PARSE_RAG_STRING_FIELD(response_proto_schema);
+        PARSE_RAG_STRING_FIELD(context_output_field_in_rag_response);
+    }
     PARSE_RAG_STRING_FIELD(target_context_field_in_llm_request);
 #undef PARSE_RAG_STRING_FIELD
 
@@ -232,7 +293,7 @@ static quicpro_tool_handler_config_t* create_tool_handler_from_php(const char *t
         throw_pipeline_error_as_php_exception(0, "Tool handler for '%s' is missing required 'mcp_target' array.", tool_name);
         goto error;
     }
-    if (parse_mcp_target_config_from_php(Z_ARRVAL_P(zv_temp), &handler->mcp_target, tool_name) == FAILURE) goto error;
+    if (quicpro_mcp_target_parse(Z_ARRVAL_P(zv_temp), &handler->mcp_target, tool_name) == FAILURE) goto error;
 
     if (!(zv_temp = zend_hash_str_find(config_ht, "input_proto_schema", sizeof("input_proto_schema")-1)) || Z_TYPE_P(zv_temp) != IS_STRING) {
         throw_pipeline_error_as_php_exception(0, "Tool handler for '%s' is missing required 'input_proto_schema' string.", tool_name);
@@ -264,6 +325,20 @@ static quicpro_tool_handler_config_t* create_tool_handler_from_php(const char *t
         }
     }
 
+    /* 'cache' => true, or ['ttl_ms' => N]: the tool is deterministic, its replies may be reused */
+    if ((zv_temp = zend_hash_str_find(config_ht, "cache", sizeof("cache")-1))) {
+        if (Z_TYPE_P(zv_temp) == IS_ARRAY) {
+            zval *zv_ttl = zend_hash_str_find(Z_ARRVAL_P(zv_temp), "ttl_ms", sizeof("ttl_ms")-1);
+            if (zv_ttl && (Z_TYPE_P(zv_ttl) != IS_LONG || Z_LVAL_P(zv_ttl) <= 0)) {
+                throw_pipeline_error_as_php_exception(0, "Tool handler for '%s' has an invalid 'cache.ttl_ms'; a positive integer is required.", tool_name);
+                goto error;
+            }
+            handler->cache_ttl_ms = zv_ttl ? Z_LVAL_P(zv_ttl) : quicpro_mcp_orchestrator_config.mcp_request_cache_ttl_sec * 1000;
+        } else if (zend_is_true(zv_temp)) {
+            handler->cache_ttl_ms = quicpro_mcp_orchestrator_config.mcp_request_cache_ttl_sec * 1000;
+        }
+    }
+
     return handler;
 
 error:
@@ -276,7 +351,7 @@ error:
          * constructed objects. A separate cleanup for partials is better.
          */
         if (handler->tool_name) efree(handler->tool_name);
-        destroy_mcp_target_config_contents(&handler->mcp_target);
+        quicpro_mcp_target_destroy(&handler->mcp_target);
         if (handler->input_proto_schema) efree(handler->input_proto_schema);
         if (handler->output_proto_schema) efree(handler->output_proto_schema);
         if (handler->param_map) { zend_hash_destroy(handler->param_map); efree(handler->param_map); }
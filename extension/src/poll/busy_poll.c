@@ -0,0 +1,137 @@
+/*
+ * busy_poll.c  –  Kernel NAPI busy polling for php-quicpro
+ * ---------------------------------------------------------
+ *
+ * See include/poll/busy_poll.h. Options the kernel refuses (missing
+ * privilege, older kernel) are reported once per process and then left
+ * alone; the system's defaults apply.
+ */
+
+#include "php_quicpro.h"
+#include "poll/busy_poll.h"
+#include "config/bare_metal_tuning/base_layer.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#ifdef __linux__
+# include <linux/eventpoll.h>
+#endif
+
+#ifndef SO_PREFER_BUSY_POLL
+# define SO_PREFER_BUSY_POLL  69
+#endif
+#ifndef SO_BUSY_POLL_BUDGET
+# define SO_BUSY_POLL_BUDGET  70
+#endif
+
+/* linux/eventpoll.h before 6.9 */
+#if defined(__linux__) && !defined(EPIOCSPARAMS)
+struct epoll_params {
+    uint32_t busy_poll_usecs;
+    uint16_t busy_poll_budget;
+    uint8_t  prefer_busy_poll;
+    uint8_t  __pad;
+};
+# define EPOLL_IOC_TYPE  0x8A
+# define EPIOCSPARAMS    _IOW(EPOLL_IOC_TYPE, 0x01, struct epoll_params)
+#endif
+
+static bool quicpro_busy_poll_noted_socket = false;
+static bool quicpro_busy_poll_epoll_unsupported = false;
+
+uint32_t quicpro_busy_poll_budget_us(void)
+{
+    zend_long us = quicpro_bare_metal_config.socket_enable_busy_poll_us;
+    return us > 0 ? (uint32_t)MIN(us, (zend_long)INT32_MAX) : 0;
+}
+
+static uint16_t busy_poll_packets(void)
+{
+    zend_long n = quicpro_bare_metal_config.io_max_batch_read_packets;
+    return (uint16_t)(n > 0 ? MIN(n, QUICPRO_BUSY_POLL_MAX_PACKETS) : QUICPRO_BUSY_POLL_MAX_PACKETS);
+}
+
+void quicpro_busy_poll_socket(int fd)
+{
+    uint32_t budget_us = quicpro_busy_poll_budget_us();
+    if (budget_us == 0) {
+        return;
+    }
+#ifdef SO_BUSY_POLL
+    int usecs = (int)budget_us, prefer = 1, packets = busy_poll_packets();
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &usecs, sizeof(usecs)) < 0
+        || setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer)) < 0
+        || setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL_BUDGET, &packets, sizeof(packets)) < 0) {
+        if (!quicpro_busy_poll_noted_socket) {
+            quicpro_busy_poll_noted_socket = true;
+            php_error_docref(NULL, E_NOTICE, "Socket busy polling limited to the system's settings: %s", strerror(errno));
+        }
+    }
+#else
+    (void)fd;
+#endif
+}
+
+static uint64_t busy_poll_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void busy_poll_set(quicpro_busy_poll_t *bp, bool on)
+{
+#ifdef __linux__
+    struct epoll_params p;
+    memset(&p, 0, sizeof(p));
+    p.busy_poll_usecs  = on ? quicpro_busy_poll_budget_us() : 0;
+    p.busy_poll_budget = on ? busy_poll_packets() : 0;
+    p.prefer_busy_poll = on ? 1 : 0;
+    if (ioctl(bp->epfd, EPIOCSPARAMS, &p) < 0) {
+        /* ENOTTY before Linux 6.9; our packet budget never needs CAP_NET_ADMIN here */
+        quicpro_busy_poll_epoll_unsupported = true;
+        php_error_docref(NULL, E_NOTICE, "epoll busy polling unavailable: %s", strerror(errno));
+        return;
+    }
+    bp->on = on;
+#else
+    (void)bp;
+    (void)on;
+    quicpro_busy_poll_epoll_unsupported = true;
+#endif
+}
+
+void quicpro_busy_poll_init(quicpro_busy_poll_t *bp, int epfd)
+{
+    bp->epfd = epfd;
+    bp->on = false;
+    bp->events = 0;
+    bp->window_ms = busy_poll_now_ms();
+}
+
+void quicpro_busy_poll_note(quicpro_busy_poll_t *bp, int ready)
+{
+    if (bp->epfd < 0 || quicpro_busy_poll_epoll_unsupported || quicpro_busy_poll_budget_us() == 0) {
+        return;
+    }
+    if (ready > 0) {
+        bp->events += (uint32_t)ready;
+    }
+    uint64_t now = busy_poll_now_ms();
+    if (now - bp->window_ms < QUICPRO_BUSY_POLL_WINDOW_MS) {
+        return;
+    }
+    /* A 100 ms wait can stretch a window; compare the rate, scaled to a nominal window */
+    uint64_t per_window = (uint64_t)bp->events * QUICPRO_BUSY_POLL_WINDOW_MS / (now - bp->window_ms);
+    if (!bp->on && per_window >= QUICPRO_BUSY_POLL_ON_EVENTS) {
+        busy_poll_set(bp, true);
+    } else if (bp->on && per_window < QUICPRO_BUSY_POLL_OFF_EVENTS) {
+        busy_poll_set(bp, false);     /* Back to interrupts */
+    }
+    bp->events = 0;
+    bp->window_ms = now;
+}
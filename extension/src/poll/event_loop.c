@@ -0,0 +1,259 @@
+/*
+ * event_loop.c  –  Userland event loop integration for php-quicpro
+ * -----------------------------------------------------------------
+ *
+ * See include/poll/event_loop.h. Descriptors go out as PHP socket streams
+ * so that every loop backend accepts them, stream_select() included; each
+ * wraps a dup() that the stream owns and closes.
+ */
+
+#include "php_quicpro.h"
+#include "poll/event_loop.h"
+#include "poll/poll.h"
+#include "poll/reactor.h"
+#include "poll/udp_batch.h"
+#include "poll/uring.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <main/php_network.h>
+
+extern int le_quicpro;           /* quicpro_connect() sessions */
+extern int le_quicpro_session;   /* quicpro_client_session_connect() and server sessions */
+
+int quicpro_session_poll_fd(quicpro_session_t *s)
+{
+    quicpro_uring_t *u = quicpro_session_uring(s);
+    int fd = u ? quicpro_uring_fd(u) : -1;
+    return fd >= 0 ? fd : s->sock;
+}
+
+uint64_t quicpro_session_deadline_ns(quicpro_session_t *s)
+{
+    uint64_t ns   = quiche_conn_timeout_as_nanos(s->conn);
+    uint64_t pace = quicpro_udp_tx_pacing_delay_ns(s->tx_batch);
+    return pace < ns ? pace : ns;
+}
+
+/*
+ * The session behind `z_sess`. The resource type is compared inline; only
+ * a wrong or closed resource goes through zend_fetch_resource2_ex(), which
+ * words the TypeError. NULL after throwing.
+ */
+static zend_always_inline quicpro_session_t *event_loop_session(zval *z_sess)
+{
+    if (EXPECTED(Z_TYPE_P(z_sess) == IS_RESOURCE)) {
+        int type = Z_RES_TYPE_P(z_sess);
+        if (EXPECTED(type == le_quicpro_session || type == le_quicpro)) {
+            return (quicpro_session_t *)Z_RES_VAL_P(z_sess);
+        }
+    }
+    return (quicpro_session_t *)zend_fetch_resource2_ex(z_sess, "Quicpro\\Session", le_quicpro, le_quicpro_session);
+}
+
+static quicpro_session_t *event_loop_fetch_session(zval *z_sess)
+{
+    quicpro_session_t *s = event_loop_session(z_sess);
+    if (!s) {
+        return NULL;
+    }
+    if (!s->conn || s->is_closed) {
+        throw_quic_exception(0, "Session is closed");
+        return NULL;
+    }
+    return s;
+}
+
+/* One non-blocking turn of quicpro_session_process(); false once closed. */
+static bool event_loop_process(quicpro_session_t *s)
+{
+    if (!s->conn || s->is_closed) {
+        return false;
+    }
+    if (!quiche_conn_is_server(s->conn)) {
+        quicpro_session_pump_rx(s);
+        if (quiche_conn_timeout_as_nanos(s->conn) == 0) {
+            quiche_conn_on_timeout(s->conn);
+        }
+        quicpro_session_pump_tx(s);
+    }
+    return !quiche_conn_is_closed(s->conn);
+}
+
+static void event_loop_return_timeout(quicpro_session_t *s, zval *return_value)
+{
+    uint64_t ns = quicpro_session_deadline_ns(s);
+    if (ns == UINT64_MAX) {
+        RETURN_NULL();
+    }
+    RETURN_DOUBLE((double)ns / 1e9);
+}
+
+/* A socket stream on a duplicate of `fd`, or false after a warning. */
+static void event_loop_return_fd(int fd, zval *return_value)
+{
+    int dup_fd = dup(fd);
+    if (dup_fd < 0) {
+        php_error_docref(NULL, E_WARNING, "Cannot duplicate descriptor %d: %s", fd, strerror(errno));
+        RETURN_FALSE;
+    }
+    php_stream *stream = php_stream_sock_open_from_socket(dup_fd, NULL);
+    if (!stream) {
+        close(dup_fd);
+        RETURN_FALSE;
+    }
+    php_stream_to_zval(stream, return_value);
+}
+
+/* {{{ quicpro_session_fd(resource $session): resource|false */
+PHP_FUNCTION(quicpro_session_fd)
+{
+    zval *z_sess;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_RESOURCE(z_sess)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = event_loop_fetch_session(z_sess);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    int fd = quicpro_session_poll_fd(s);
+    if (fd < 0 || quiche_conn_is_server(s->conn)) {
+        throw_quic_exception(0, "Server sessions are driven by their listener and have no descriptor of their own");
+        RETURN_THROWS();
+    }
+    event_loop_return_fd(fd, return_value);
+}
+/* }}} */
+
+/* {{{ quicpro_session_timeout(resource $session): ?float */
+PHP_FUNCTION(quicpro_session_timeout)
+{
+    zval *z_sess;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_RESOURCE(z_sess)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = event_loop_fetch_session(z_sess);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    event_loop_return_timeout(s, return_value);
+}
+/* }}} */
+
+/* {{{ quicpro_session_process(resource $session): bool */
+PHP_FUNCTION(quicpro_session_process)
+{
+    zval *z_sess;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_RESOURCE(z_sess)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = event_loop_session(z_sess);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    RETURN_BOOL(event_loop_process(s));
+}
+/* }}} */
+
+#if PHP_VERSION_ID >= 80400
+/*
+ * Frameless variants: a call the compiler can resolve becomes a single
+ * ZEND_FRAMELESS_ICALL_1 opcode, with no call frame and no parameter
+ * parsing. The argument arrives dereferenced.
+ */
+ZEND_FRAMELESS_FUNCTION(quicpro_session_timeout, 1)
+{
+    if (UNEXPECTED(Z_TYPE_P(arg1) != IS_RESOURCE)) {
+        zend_wrong_parameter_type_error(1, Z_EXPECTED_RESOURCE, arg1);
+        return;
+    }
+    quicpro_session_t *s = event_loop_fetch_session(arg1);
+    if (!s) {
+        return;
+    }
+    event_loop_return_timeout(s, return_value);
+}
+
+ZEND_FRAMELESS_FUNCTION(quicpro_session_process, 1)
+{
+    if (UNEXPECTED(Z_TYPE_P(arg1) != IS_RESOURCE)) {
+        zend_wrong_parameter_type_error(1, Z_EXPECTED_RESOURCE, arg1);
+        return;
+    }
+    quicpro_session_t *s = event_loop_session(arg1);
+    if (!s) {
+        return;
+    }
+    RETURN_BOOL(event_loop_process(s));
+}
+#endif
+
+/* {{{ quicpro_session_process_many(array $sessions): array */
+PHP_FUNCTION(quicpro_session_process_many)
+{
+    HashTable *sessions;
+    zend_ulong idx;
+    zend_string *key;
+    zval *z_sess;
+    zval closed;
+    uint64_t next_ns = UINT64_MAX;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT(sessions)
+    ZEND_PARSE_PARAMETERS_END();
+
+    array_init(&closed);
+    ZEND_HASH_FOREACH_KEY_VAL(sessions, idx, key, z_sess) {
+        ZVAL_DEREF(z_sess);
+        quicpro_session_t *s = event_loop_session(z_sess);
+        if (!s) {
+            zval_ptr_dtor(&closed);
+            RETURN_THROWS();
+        }
+        if (!event_loop_process(s)) {
+            if (key) {
+                add_next_index_str(&closed, zend_string_copy(key));
+            } else {
+                add_next_index_long(&closed, (zend_long)idx);
+            }
+            continue;
+        }
+        uint64_t ns = quicpro_session_deadline_ns(s);
+        if (ns < next_ns) {
+            next_ns = ns;
+        }
+    } ZEND_HASH_FOREACH_END();
+
+    array_init_size(return_value, 2);
+    if (next_ns == UINT64_MAX) {
+        add_assoc_null(return_value, "timeout");
+    } else {
+        add_assoc_double(return_value, "timeout", (double)next_ns / 1e9);
+    }
+    add_assoc_zval(return_value, "closed", &closed);
+}
+/* }}} */
+
+/* {{{ quicpro_reactor_fd(resource $reactor): resource|false */
+PHP_FUNCTION(quicpro_reactor_fd)
+{
+    zval *zr;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_RESOURCE(zr)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_reactor_t *r = zend_fetch_resource(Z_RES_P(zr), "quicpro_reactor", le_quicpro_reactor);
+    if (!r) {
+        RETURN_FALSE;
+    }
+    event_loop_return_fd(quicpro_reactor_epoll_fd(r), return_value);
+}
+/* }}} */
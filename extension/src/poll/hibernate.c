@@ -0,0 +1,71 @@
+/*
+ * hibernate.c  –  Compacting idle sessions for php-quicpro
+ * ---------------------------------------------------------
+ *
+ * See include/poll/hibernate.h.
+ */
+
+#include "php_quicpro.h"
+#include "poll/hibernate.h"
+#include "poll/udp_batch.h"
+#include "config/quic_transport/base_layer.h"
+#include "mcp/mcp.h"
+#include "mcp/mcp_server.h"
+#include "server/proxy.h"
+#include "smart_dns/doq.h"
+
+bool quicpro_session_hibernate(quicpro_session_t *s)
+{
+    bool released = false;
+
+    if (s->rx_batch) {
+        for (int i = 0; i < 4; i++) {
+            s->ecn_rx_released[i] += s->rx_batch->ecn_rx[i];
+        }
+        quicpro_udp_rx_batch_free(s->rx_batch);
+        s->rx_batch = NULL;
+        released = true;
+    }
+    if (s->tx_batch && s->tx_batch->count == 0) {
+        quicpro_udp_tx_batch_free(s->tx_batch);
+        s->tx_batch = NULL;
+        released = true;
+    }
+    if (s->mcp && quicpro_mcp_inflight_idle(s->mcp)) {
+        quicpro_mcp_inflight_free(s->mcp);
+        s->mcp = NULL;
+        released = true;
+    }
+    if (s->mcp_served && quicpro_mcp_served_idle(s->mcp_served)) {
+        quicpro_mcp_served_free(s->mcp_served);
+        s->mcp_served = NULL;
+        released = true;
+    }
+    if (s->doq && quicpro_doq_conn_idle(s->doq)) {
+        quicpro_doq_conn_free(s->doq);
+        s->doq = NULL;
+        released = true;
+    }
+    if (s->proxy && quicpro_proxy_conn_idle(s->proxy)) {
+        quicpro_proxy_conn_free(s->proxy);   /* Clears s->proxy */
+        released = true;
+    }
+    return released;
+}
+
+void quicpro_session_hibernate_tick(quicpro_session_t *s, uint64_t now_ms)
+{
+    uint64_t after_ms = (uint64_t)quicpro_quic_transport_config.idle_hibernate_ms;
+
+    if (after_ms == 0 || s->hibernating) {
+        return;
+    }
+    if (s->last_active_ms == 0) {
+        s->last_active_ms = now_ms;   /* Not a datagram yet: count from the first look */
+        return;
+    }
+    if (now_ms - s->last_active_ms >= after_ms) {
+        quicpro_session_hibernate(s);
+        s->hibernating = true;
+    }
+}
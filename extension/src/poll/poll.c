@@ -8,16 +8,23 @@
  *   1) Drain inbound UDP packets from the kernel or a fast-path AF_XDP
  *      ring buffer and feed them into the quiche connection state machine.
  *   2) Collect outgoing packets generated by quiche and send them out
- *      over the network via sendto().
+ *      over the network in sendmmsg() bursts, coalesced with UDP GSO
+ *      (UDP_SEGMENT) when the kernel supports it. With
+ *      quicpro.io_engine_use_uring both directions run through the
+ *      io_uring engine instead (multishot recvmsg, SQPOLL submission).
  *   3) Honor quiche’s built‑in connection and idle timeouts, invoking
  *      quiche_conn_on_timeout() when necessary.
  *   4) Extract kernel-provided RX/TX timestamps through socket
- *      ancillary data (SO_TIMESTAMPING_NEW) for precise RTT and jitter
- *      measurements.
- *   5) Optionally respect the system-wide NAPI busy-poll budget
- *      (net.core.busy_poll). If the budget is consumed, and we're running
- *      inside a PHP Fiber, yield back to the scheduler to prevent
- *      starving other fibers or blocking the PHP runtime.
+ *      ancillary data (SO_TIMESTAMPING_NEW) and the socket error queue
+ *      (MSG_ERRQUEUE) for per-session send latency and RTT histograms,
+ *      see include/poll/txstamp.h.
+ *   5) Optionally keep pumping for quicpro.socket_enable_busy_poll_us
+ *      while packets keep arriving; with SO_BUSY_POLL on the socket
+ *      (poll/busy_poll.h) each receive polls the NIC queue in the kernel.
+ *      Once the budget is consumed or traffic stops, and we're running
+ *      inside a PHP Fiber, park the Fiber in the native scheduler
+ *      (poll/scheduler.h) until the socket is readable or a deadline
+ *      passes, so other fibers run instead of the worker blocking.
  *
  * The high-level workflow of quicpro_poll() is:
  *   • Parse PHP function parameters and fetch the session resource.
@@ -25,13 +32,15 @@
  *   • Enable socket timestamping (once per session).
  *   • Enter a busy-poll loop bounded by the smaller of:
  *       - The suggested quiche timeout (e.g., for handshake retransmits).
- *       - The NAPI busy-poll budget (if enabled).
+ *       - The busy-poll budget (if enabled), cut short once a quarter
+ *         of it passes without a packet.
  *   • Within each loop iteration:
- *       a) Drain incoming packets via AF_XDP (if compiled) and/or recvmsg().
+ *       a) Drain incoming packets via AF_XDP (if compiled) and/or a
+ *          batched recvmmsg() sized by quicpro.io_max_batch_read_packets.
  *       b) Process incoming QUIC datagrams via quiche_conn_recv().
- *       c) Send outgoing QUIC datagrams via quiche_conn_send() + sendto().
+ *       c) Send outgoing QUIC datagrams via quiche_conn_send() + sendmmsg().
  *       d) Invoke quiche_conn_on_timeout() when the deadline is reached.
- *       e) Break or yield if budget expired or connection closed.
+ *       e) Break, or park the Fiber, if budget expired or connection closed.
  *   • After the loop, refresh the TLS session ticket for export.
  *
  * This approach minimizes syscalls and context switches by busy-polling
@@ -39,61 +48,25 @@
  *
  * Dependencies and Build Flags:
  *   • QUICPRO_XDP: enables AF_XDP fast-path for Linux kernel bypass.
- *   • QUICPRO_HAVE_NAPI_BUSY_POLL: reads /sys/kernel/net/napi_busy_poll
- *     to determine busy-poll budget in microseconds.
- *   • PHP_VERSION_ID: fiber integration varies by PHP version.
+ *   • PHP_VERSION_ID: fiber parking needs PHP 8.1+; older versions
+ *     simply return after the busy-poll burst.
  */
 
-#include "session.h"             /* Defines quicpro_session_t and le_quicpro_session */
+#include "session.h"             /* Defines quicpro_session_t */
 #include "php_quicpro.h"         /* PHP_FUNCTION prototypes, error helpers */
+#include "poll/poll.h"           /* quicpro_session_pump_rx()/_tx() */
+#include "poll/busy_poll.h"      /* Busy-poll budget (socket_enable_busy_poll_us) */
+#include "poll/hibernate.h"      /* Activity stamp for idle compaction */
+#include "poll/scheduler.h"      /* Fiber parking (quicpro_scheduler_run) */
+#include "poll/txstamp.h"        /* MSG_ERRQUEUE TX timestamp harvesting */
+#include "poll/udp_batch.h"      /* recvmmsg()/sendmmsg() batch helpers */
+#include "poll/uring.h"          /* io_uring engine (io_engine_use_uring) */
+#include "poll/xdp.h"            /* AF_XDP engine (io_xdp_interface) */
+#include "client/ticket_cache.h" /* Client TLS session capture */
+#include "client/multipath.h"    /* Paths over further interfaces */
 #include <quiche.h>              /* quiche QUIC & HTTP/3 core API */
 
-/*────────────────────────────── Fiber Support ─────────────────────────────*/
-
-/*
- * PHP 8.4+ exposes zend_fiber_get_current() publicly, but some headers
- * may not declare it. PHP 8.1–8.3 use EG(current_fiber). PHP < 8.1
- * does not support fibers at all.
- *
- * This section conditionally declares or includes the appropriate API
- * to detect and suspend the current Fiber if we overshoot our busy-poll
- * budget. Yielding inside a Fiber allows other fibers to make progress
- * and prevents a tight C loop from blocking the PHP event loop.
- */
-
-#if PHP_VERSION_ID >= 80400
-
-/* New public API for getting the current Fiber instance */
-typedef struct _zend_fiber zend_fiber;
-extern zend_fiber *zend_fiber_get_current(void);
-/* Suspend the current Fiber, returning control to the scheduler */
-extern void zend_fiber_suspend(zend_fiber *fiber, zval *value, zval *return_value);
-
-# define FIBER_GET_CURRENT()   zend_fiber_get_current()
-# define FIBER_IS_ACTIVE()     (FIBER_GET_CURRENT() != NULL)
-# define FIBER_SUSPEND()       zend_fiber_suspend(FIBER_GET_CURRENT(), NULL, NULL)
-
-#elif PHP_VERSION_ID >= 80100 && PHP_VERSION_ID < 80400
-
-# include <Zend/zend_fibers.h>
-# ifdef ZEND_FIBER_G
-#   define FIBER_GET_CURRENT()   (EG(current_fiber))
-#   define FIBER_IS_ACTIVE()     (FIBER_GET_CURRENT() != NULL)
-    /* No public suspend API in <=8.3, so fallback to userland (no-op) */
-#   define FIBER_SUSPEND()       /* noop in C: see php8.3.fiber.md for workaround */
-# else
-#   define FIBER_GET_CURRENT()   NULL
-#   define FIBER_IS_ACTIVE()     0
-#   define FIBER_SUSPEND()       /* noop */
-# endif
-
-#else
-
-# define FIBER_GET_CURRENT()   NULL
-# define FIBER_IS_ACTIVE()     0
-# define FIBER_SUSPEND()       /* noop */
-
-#endif
+extern int le_quicpro;           /* Session resources, see php_quicpro.c */
 
 /*──────────────────── quiche Compatibility Shims ──────────────────────────*/
 
@@ -113,137 +86,154 @@ extern void zend_fiber_suspend(zend_fiber *fiber, zval *value, zval *return_valu
 /*──────────────────────────── System Headers ──────────────────────────────*/
 
 #include <errno.h>               /* errno and strerror() */
-#include <fcntl.h>               /* open() */
 #include <time.h>                /* clock_gettime() */
-#include <sys/socket.h>          /* socket options, sendto(), recvmsg() */
+#include <sys/socket.h>          /* socket options, sendmmsg(), recvmmsg() */
 #include <sys/time.h>            /* struct timeval */
 #include <sys/select.h>          /* FD macros */
 #include <linux/net_tstamp.h>    /* SOF_TIMESTAMPING flags */
 #include <linux/errqueue.h>      /* MSG_ERRQUEUE constants */
 
-#ifdef QUICPRO_HAVE_NAPI_BUSY_POLL
-# include <stdatomic.h>          /* atomic caching of busy-poll budget */
-#endif
-
-#ifdef QUICPRO_XDP
+/*─────────────────────── Utility Inline Helpers ─────────────────────────*/
 
 /*
- * AF_XDP / XSK fast-path:
- *   • Bypass the kernel’s UDP stack to achieve lower latency and higher
- *     packet-per-second throughput.
- *   • We maintain an umem and RX/TX rings via libbpf’s xsk.
- *   • quicpro_xdp_drain() loops until no more packets are available,
- *     feeding each into quiche_conn_recv().
+ * quicpro_poll_recv_count()
+ *
+ * Packets quiche has taken in on `conn`, whichever engine delivered
+ * them; the busy-poll loop watches it to notice that traffic stopped.
  */
-
-# include <bpf/xsk.h>
-
-static ssize_t quicpro_xdp_drain(quicpro_session_t *s)
+static uint64_t quicpro_poll_recv_count(quiche_conn *conn)
 {
-    size_t packets = 0;
-    uint32_t idx;
-
-    /* Try to peek up to 64 descriptors at a time */
-    while (xsk_ring_cons__peek(&s->rx, 64, &idx) == 64) {
-        /* For each descriptor, pull the packet data and length */
-        for (unsigned i = 0; i < 64; i++) {
-            struct xdp_desc *d = xsk_ring_cons__comp_addr(&s->rx, idx + i);
-            uint8_t *buf = xsk_umem__get_data(s->umem, d->addr);
-
-            /* Build quiche_recv_info with source address */
-            quiche_recv_info ri = {
-                .from     = (struct sockaddr *)&s->peer,
-                .from_len = sizeof(s->peer),
-                .to       = NULL,
-                .to_len   = 0
-            };
-
-            /* Deliver the packet to quiche */
-            quiche_conn_recv(s->conn, buf, d->len, &ri);
-            packets++;
-        }
-
-        /* Release the descriptors back to the producer ring */
-        xsk_ring_cons__release(&s->rx, 64);
-    }
-
-    return packets;
+    quiche_stats st;
+    quiche_conn_stats(conn, &st);
+    return (uint64_t)st.recv;
 }
 
-#endif /* QUICPRO_XDP */
-
-/*─────────────────────── Utility Inline Helpers ─────────────────────────*/
-
 /*
- * quicpro_yield_if_needed()
+ * quicpro_perror()
  *
- * If our busy-poll budget (in µs) is exhausted and we are inside a Fiber,
- * yield control back to the PHP scheduler to avoid monopolizing CPU.
- * On PHP 8.4+, this will actually suspend the C Fiber;
- * on PHP 8.1–8.3, this is a no-op and userland code must cooperate.
+ * Convenience wrapper around php_error_docref to emit a warning
+ * with the current errno and its string description.
  */
-static inline void quicpro_yield_if_needed(int budget_us)
+static inline void quicpro_perror(const char *ctx)
 {
-    if (budget_us <= 0 && FIBER_IS_ACTIVE()) {
-        FIBER_SUSPEND();
-    }
+    php_error_docref(NULL, E_WARNING, "%s failed: %s", ctx, strerror(errno));
 }
 
+/*─────────────────────────── Session I/O Pumps ───────────────────────────*/
+
 /*
- * quicpro_busy_budget_us()
+ * quicpro_session_pump_rx()
  *
- * Reads /sys/kernel/net/napi_busy_poll (if available) to determine the
- * maximum busy-poll budget in microseconds. Subsequent calls return
- * a cached value to avoid repeated syscalls. If busy-poll is disabled
- * or unreadable, returns 0.
+ * Moves every datagram currently queued for `s` into quiche. The engine is
+ * chosen per session in order of preference: AF_XDP (process-wide ring,
+ * drained for all attached sessions at once), io_uring, batched
+ * recvmmsg(). Shared by quicpro_poll() and the multi-session reactor.
  */
-static int quicpro_busy_budget_us(void)
+void quicpro_session_pump_rx(quicpro_session_t *s)
 {
-#ifdef QUICPRO_HAVE_NAPI_BUSY_POLL
-    static _Atomic int cached = -1;
-    int val = atomic_load(&cached);
-
-    if (val >= 0) {
-        /* Already cached */
-        return val;
+    /*
+     * AF_XDP: drain the process-wide XSK ring first. Datagrams are
+     * routed by destination port, so other sessions pick up theirs
+     * on their next poll. A no-op unless quicpro.io_xdp_interface is set.
+     */
+    quicpro_xdp_attach(s);
+    quicpro_xdp_drain(NULL, NULL);
+
+    if (quicpro_session_uring(s)) {
+        /* io_uring engine: reap multishot recvmsg completions, no syscall */
+        int n = quicpro_uring_session_recv(s);
+        if (n < 0) {
+            quicpro_perror("io_uring recvmsg");
+        } else if (n > 0) {
+            quicpro_session_touch(s);
+        }
+    } else {
+        /*
+         * Batched UDP receive: one recvmmsg() drains up to
+         * quicpro.io_max_batch_read_packets slots, each with its own
+         * source address, SO_TIMESTAMPING and (with GRO) UDP_GRO cmsg.
+         */
+        quicpro_udp_rx_batch_t *rb = quicpro_session_rx_batch(s);
+        int n = quicpro_udp_recv_batch(s->sock, rb);
+
+        /*
+         * Deliver each datagram (GRO slots are split per segment) and
+         * keep the RX timestamp of the newest packet in the batch.
+         */
+        quicpro_udp_rx_deliver(s->conn, rb, n, &s->last_rx_ts, NULL);
+
+        if (n < 0) {
+            /* Unexpected error in recvmmsg; warn and continue */
+            quicpro_perror("recvmmsg");
+        } else if (n > 0) {
+            quicpro_session_touch(s);
+        }
     }
 
-    /* Attempt to open the sysfs file */
-    int fd = open("/sys/kernel/net/napi_busy_poll", O_RDONLY);
-    if (fd < 0) {
-        atomic_store(&cached, 0);
-        return 0;
+    /* Client sessions with paths over further interfaces (client/multipath.h) */
+    if (s->mp) {
+        quicpro_mp_pump_rx(s);
     }
 
-    /* Read its contents into a small buffer */
-    char buf[32] = {0};
-    ssize_t n = read(fd, buf, sizeof(buf) - 1);
-    close(fd);
-
-    if (n <= 0) {
-        atomic_store(&cached, 0);
-        return 0;
+    /*
+     * Harvest TX timestamps queued on the error queue since the last
+     * pump; an unread errqueue pins socket memory and keeps the socket
+     * in EPOLLERR.
+     */
+    if (s->txstamp) {
+        quicpro_txstamp_note_rx(s);
+        if (quicpro_txstamp_drain(s) < 0) {
+            quicpro_perror("recvmsg(MSG_ERRQUEUE)");
+        }
     }
 
-    /* Convert ASCII to integer */
-    val = atoi(buf);
-    atomic_store(&cached, val);
-    return val;
-#else
-    /* Busy-poll not supported in this build */
-    return 0;
-#endif
+    /* Client sessions: keep the server's session for the next connect */
+    if (s->ticket_cache_pending) {
+        quicpro_client_ticket_cache_capture(s);
+    }
 }
 
 /*
- * quicpro_perror()
+ * quicpro_session_pump_tx()
  *
- * Convenience wrapper around php_error_docref to emit a warning
- * with the current errno and its string description.
+ * Flushes everything quiche has queued for `s` through the same engine
+ * order as the receive side.
  */
-static inline void quicpro_perror(const char *ctx)
+void quicpro_session_pump_tx(quicpro_session_t *s)
 {
-    php_error_docref(NULL, E_WARNING, "%s failed: %s", ctx, strerror(errno));
+    if (s->mp) {
+        /* Several sockets: each packet leaves on the one of its path */
+        quicpro_mp_flush(s);
+    } else if (quicpro_xdp_flush_session(s) >= 0) {
+        /* quiche wrote straight into umem frames behind prebuilt headers */
+    } else if (s->uring) {
+        /* quiche writes straight into the ring's TX slots */
+        int queued = quicpro_uring_flush_quiche(s->uring, s->conn);
+        if (queued > 0) {
+            /* One sendmsg SQE per packet, numbered in submission order */
+            quicpro_txstamp_on_send(s, (unsigned)queued);
+        }
+    } else {
+        /*
+         * Stage a burst of up to quicpro.io_max_batch_write_packets
+         * packets, then hand it to the kernel in one sendmmsg()
+         * (GSO-coalesced where supported). Repeat while bursts fill up.
+         */
+        quicpro_udp_tx_batch_t *tb = quicpro_session_tx_batch(s);
+        int staged;
+        while ((staged = quicpro_udp_tx_batch_fill(s->conn, tb)) > 0) {
+            int sent = quicpro_udp_send_batch(s->sock, tb, &s->gso_state);
+            quicpro_txstamp_on_send(s, tb->last_msgs);
+            if (sent < 0) {
+                quicpro_perror("sendmmsg");
+                break;
+            }
+            if (sent < staged || (unsigned)staged < tb->capacity) {
+                /* Socket full, packets held by the pacer, or quiche is done */
+                break;
+            }
+        }
+    }
 }
 
 /*──────────────────────────── quicpro_poll() ─────────────────────────────*/
@@ -257,15 +247,16 @@ static inline void quicpro_perror(const char *ctx)
  *   2) Ask quiche for the next deadline (in ms) for retransmit or idle.
  *   3) Enable socket-level timestamping once, to collect hardware/software
  *      RX/TX timestamps for ping and diagnostics.
- *   4) Determine the busy-poll budget by combining quiche deadline and
- *      NAPI busy-poll budget from the kernel.
+ *   4) Determine the busy-poll budget (quicpro.socket_enable_busy_poll_us).
  *   5) Enter a loop:
- *        a) Drain incoming packets (XDP and/or recvmsg).
- *        b) Feed each packet into quiche_conn_recv().
- *        c) Pull out and send any packets ready to go via quiche_conn_send().
- *        d) If quiche indicates the connection is draining/inactive, break.
- *        e) If a timeout event is due, call quiche_conn_on_timeout().
- *        f) If busy-poll budget is exceeded, yield if inside a Fiber.
+ *        a) Drain incoming packets (XDP, io_uring or batched recvmmsg)
+ *           and feed each into quiche_conn_recv().
+ *        b) Pull out and send any packets ready to go via quiche_conn_send().
+ *        c) If quiche indicates the connection is draining/inactive, break.
+ *        d) If a timeout event is due, call quiche_conn_on_timeout().
+ *        e) If the busy-poll budget is exceeded, or a quarter of it passed
+ *           without a packet, and we run inside a Fiber, park it until the
+ *           session is readable or `timeout_ms` passes.
  *   6) Once the loop ends, call quiche_conn_get_tls_ticket() to refresh
  *      the session ticket buffer for future export via PHP.
  *
@@ -283,108 +274,44 @@ PHP_FUNCTION(quicpro_poll)
 
     /* Fetch the C session pointer from the resource registry */
     quicpro_session_t *s =
-        zend_fetch_resource(Z_RES_P(zsess), "quicpro", le_quicpro_session);
+        zend_fetch_resource(Z_RES_P(zsess), "quicpro", le_quicpro);
     if (!s) {
         /* Invalid resource passed */
         RETURN_FALSE;
     }
 
-    /* Step 2: Determine quiche’s suggested timeout (ms) */
+    /* Step 2: Determine quiche’s suggested timeout (ms), or sooner if the
+     * userspace pacer holds packets that become due first */
     int64_t quic_deadline = quiche_conn_timeout_as_millis(s->conn);
+    uint64_t pace_ns = quicpro_udp_tx_pacing_delay_ns(s->tx_batch);
+    if (pace_ns != UINT64_MAX && (quic_deadline < 0 || (int64_t)(pace_ns / 1000000u) < quic_deadline)) {
+        quic_deadline = (int64_t)(pace_ns / 1000000u);
+    }
     if (quic_deadline >= 0 && (timeout_ms < 0 || quic_deadline < timeout_ms)) {
         timeout_ms = quic_deadline;
     }
 
-    /* Step 3: Enable socket timestamping exactly once per session */
+    /*
+     * Step 3: Enable RX/TX socket timestamping exactly once per session;
+     * TX reports are harvested from the error queue by the RX pump.
+     */
     if (!s->ts_enabled) {
-        int flags = SOF_TIMESTAMPING_SOFTWARE
-                  | SOF_TIMESTAMPING_RX_SOFTWARE
-                  | SOF_TIMESTAMPING_TX_SOFTWARE
-                  | SOF_TIMESTAMPING_RAW_HARDWARE;
-        if (setsockopt(s->sock, SOL_SOCKET, SO_TIMESTAMPING_NEW,
-                       &flags, sizeof(flags)) == 0) {
-            s->ts_enabled = 1;
-        }
+        quicpro_txstamp_enable(s);
     }
 
     /* Step 4: Calculate busy-poll budget in microseconds */
-    int            budget_us = quicpro_busy_budget_us();
+    int64_t        budget_us = quicpro_busy_poll_budget_us();
+    int64_t        idle_us   = budget_us / 4;
+    int64_t        last_rx_us = 0;
+    uint64_t       rx_seen   = quicpro_poll_recv_count(s->conn);
     struct timespec start_ts;
     clock_gettime(CLOCK_MONOTONIC_RAW, &start_ts);
 
     /* Step 5: Enter busy-poll loop */
     while (1) {
-        /* ==== Receive path ==== */
-
-#ifdef QUICPRO_XDP
-        /* If AF_XDP enabled, first drain packets from XDP ring */
-        quicpro_xdp_drain(s);
-#endif
-
-        {
-            /* Fallback UDP recv via recvmsg(MMSG) for timestamping */
-            uint8_t buf[65535];
-            struct sockaddr_storage from;
-            struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) };
-            char cbuf[512];
-
-            struct msghdr msg = {
-                .msg_name       = &from,
-                .msg_namelen    = sizeof(from),
-                .msg_iov        = &iov,
-                .msg_iovlen     = 1,
-                .msg_control    = cbuf,
-                .msg_controllen = sizeof(cbuf),
-            };
-
-            /* Non-blocking receive; MSG_DONTWAIT avoids blocking */
-            ssize_t n = recvmsg(s->sock, &msg, MSG_DONTWAIT);
-            if (n > 0) {
-                /* Wrap sockaddr in quiche_recv_info */
-                quiche_recv_info ri = {
-                    .from     = (struct sockaddr *)&from,
-                    .from_len = msg.msg_namelen,
-                    .to       = NULL,
-                    .to_len   = 0
-                };
-                /* Deliver packet to quiche */
-                quiche_conn_recv(s->conn, buf, n, &ri);
-
-                /* Parse control messages for RX timestamp */
-                for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm;
-                     cm = CMSG_NXTHDR(&msg, cm)) {
-                    if (cm->cmsg_level == SOL_SOCKET &&
-                        cm->cmsg_type  == SO_TIMESTAMPING_NEW) {
-                        s->last_rx_ts = *(struct timespec *)CMSG_DATA(cm);
-                        break;
-                    }
-                }
-            } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-                /* Unexpected error in recvmsg; warn and continue */
-                quicpro_perror("recvmsg");
-            }
-        }
-
-        /* ==== Transmit path ==== */
-        while (1) {
-            uint8_t out[1350];
-            quiche_send_info si;
-            /* Ask quiche for the next packet to send */
-            ssize_t out_len =
-                quiche_conn_send(s->conn, out, sizeof(out), &si);
-            if (out_len <= 0) {
-                /* No more packets ready */
-                break;
-            }
-            /* Send the packet to the remote address provided by quiche */
-            ssize_t sent = sendto(s->sock, out, out_len, 0,
-                                  (const struct sockaddr *)&si.to,
-                                  si.to_len);
-            if (sent < 0) {
-                quicpro_perror("sendto");
-                break;
-            }
-        }
+        /* ==== Receive and transmit ==== */
+        quicpro_session_pump_rx(s);
+        quicpro_session_pump_tx(s);
 
         /* ==== Timeout and shutdown checks ==== */
 
@@ -401,11 +328,25 @@ PHP_FUNCTION(quicpro_poll)
 
         struct timespec now_ts;
         clock_gettime(CLOCK_MONOTONIC_RAW, &now_ts);
-        int elapsed_us = (now_ts.tv_sec  - start_ts.tv_sec)  * 1000000
-                       + (now_ts.tv_nsec - start_ts.tv_nsec) / 1000;
-        if (elapsed_us >= budget_us) {
-            /* We have exceeded the busy-poll budget; yield if needed */
-            quicpro_yield_if_needed(elapsed_us - budget_us);
+        int64_t elapsed_us = (int64_t)(now_ts.tv_sec  - start_ts.tv_sec)  * 1000000
+                           + (now_ts.tv_nsec - start_ts.tv_nsec) / 1000;
+        uint64_t rx_now = quicpro_poll_recv_count(s->conn);
+        if (rx_now != rx_seen) {
+            rx_seen    = rx_now;
+            last_rx_us = elapsed_us;
+        }
+        if (elapsed_us >= budget_us || elapsed_us - last_rx_us >= idle_us) {
+            /*
+             * Budget spent, or traffic stopped and spinning on would only
+             * burn the core. Inside a Fiber, park until the session has I/O
+             * or its deadline passes; quicpro_scheduler_run() resumes us and
+             * the next quicpro_poll() call picks up the new packets.
+             */
+            if (timeout_ms != 0 &&
+                quicpro_sched_wait(s, Z_RES_P(zsess), timeout_ms) == QUICPRO_SCHED_READY) {
+                quicpro_session_pump_rx(s);
+                quicpro_session_pump_tx(s);
+            }
             break;
         }
     }
@@ -0,0 +1,505 @@
+/*
+ * reactor.c  –  Multi-session event reactor for php-quicpro
+ * ---------------------------------------------------------
+ *
+ * One tick of quicpro_reactor_run():
+ *
+ *   1) Arm the timerfd for the wheel's next expiry (disarm if empty).
+ *   2) epoll_wait() once, for at most $timeout_ms (0 if sessions are
+ *      already pending from add()).
+ *   3) Readable session descriptors → quicpro_session_pump_rx(); the XSK
+ *      socket → quicpro_xdp_drain() with a callback that marks receivers.
+ *   4) Advance the wheel to "now"; expired sessions get
+ *      quiche_conn_on_timeout().
+ *   5) For every session touched in 3) or 4): flush TX, re-read the quiche
+ *      deadline into the wheel, report it to userland, detach if closed.
+ *
+ * Sessions stay owned by their PHP resources; the reactor holds a
+ * reference so they survive while registered. quicpro_close() on a
+ * registered session is detected (the resource type turns negative) and
+ * the entry is dropped on its next event.
+ */
+
+#include "php_quicpro.h"
+#include "client/session.h"
+#include "cluster/cluster_stats.h"
+#include "poll/busy_poll.h"
+#include "poll/event_loop.h"
+#include "poll/hibernate.h"
+#include "poll/poll.h"
+#include "poll/reactor.h"
+#include "poll/timer_wheel.h"
+#include "poll/udp_batch.h"
+#include "poll/uring.h"
+#include "poll/xdp.h"
+#include "server/conn_stats.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#define QUICPRO_REACTOR_MAX_EVENTS  256
+
+extern int le_quicpro;   /* Session resources, see php_quicpro.c */
+
+int le_quicpro_reactor;
+
+/* epoll tags for the two reactor-owned descriptors */
+static char quicpro_reactor_timer_tag;
+static char quicpro_reactor_xdp_tag;
+
+typedef struct quicpro_reactor_entry_s quicpro_reactor_entry_t;
+
+struct quicpro_reactor_entry_s {
+    quicpro_tw_node_t         timer;      /* quiche deadline */
+    zend_resource            *res;        /* Session resource (referenced), may be NULL */
+    quicpro_session_t        *s;
+    int                       fd;         /* Descriptor registered with epoll */
+    bool                      active;     /* Queued on the active list */
+    quicpro_reactor_entry_t  *next_active;
+};
+
+struct quicpro_reactor_s {
+    int                       epfd;
+    int                       tfd;
+    bool                      xdp_watched;
+    quicpro_timer_wheel_t     wheel;
+    HashTable                 entries;     /* quicpro_session_t* -> entry */
+    quicpro_reactor_entry_t  *active_head;
+    quicpro_busy_poll_t       busy;        /* Adaptive epoll busy polling */
+};
+
+/*─────────────────────────────── Helpers ─────────────────────────────────*/
+
+static inline uint64_t quicpro_reactor_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static inline bool quicpro_reactor_entry_alive(const quicpro_reactor_entry_t *e)
+{
+    /*
+     * zend_list_close() runs the session dtor and flips the type to -1.
+     * Entries without a resource belong to C callers that guarantee the
+     * session outlives its registration (see poll/scheduler.c).
+     */
+    return !e->res || (e->res->type == le_quicpro && e->res->ptr == e->s);
+}
+
+static void quicpro_reactor_mark(quicpro_reactor_t *r, quicpro_reactor_entry_t *e)
+{
+    if (!e->active) {
+        e->active = true;
+        e->next_active = r->active_head;
+        r->active_head = e;
+    }
+}
+
+static void quicpro_reactor_watch(quicpro_reactor_t *r, quicpro_reactor_entry_t *e)
+{
+    int fd = quicpro_session_poll_fd(e->s);
+    if (fd == e->fd) {
+        return;
+    }
+    if (e->fd >= 0) {
+        epoll_ctl(r->epfd, EPOLL_CTL_DEL, e->fd, NULL);
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = e };
+    e->fd = (fd >= 0 && epoll_ctl(r->epfd, EPOLL_CTL_ADD, fd, &ev) == 0) ? fd : -1;
+}
+
+/* Re-reads the session's quiche (and pacer) deadline into the wheel. */
+static void quicpro_reactor_schedule(quicpro_reactor_t *r, quicpro_reactor_entry_t *e, uint64_t now_ms)
+{
+    uint64_t ns = quicpro_session_deadline_ns(e->s);
+    if (ns == UINT64_MAX) {
+        quicpro_tw_cancel(&r->wheel, &e->timer);
+        return;
+    }
+    quicpro_tw_schedule(&r->wheel, &e->timer, now_ms + (ns + 999999u) / 1000000u);
+}
+
+static void quicpro_reactor_arm_timer(quicpro_reactor_t *r)
+{
+    struct itimerspec its;
+    uint64_t next = quicpro_tw_next_expiry(&r->wheel);
+
+    memset(&its, 0, sizeof(its));
+    if (next != QUICPRO_TW_NEVER) {
+        its.it_value.tv_sec  = (time_t)(next / 1000u);
+        its.it_value.tv_nsec = (long)(next % 1000u) * 1000000L;
+    }
+    timerfd_settime(r->tfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+/*──────────────────────────── Entry Lifecycle ────────────────────────────*/
+
+static void quicpro_reactor_entry_dtor(zval *zv)
+{
+    quicpro_reactor_entry_t *e = Z_PTR_P(zv);
+    /* The owning reactor has already unlinked timer and epoll registration */
+    if (e->res) {
+        zend_list_delete(e->res);
+    }
+    efree(e);
+}
+
+static void quicpro_reactor_unqueue(quicpro_reactor_t *r, quicpro_reactor_entry_t *e)
+{
+    if (!e->active) {
+        return;
+    }
+    for (quicpro_reactor_entry_t **pp = &r->active_head; *pp; pp = &(*pp)->next_active) {
+        if (*pp == e) {
+            *pp = e->next_active;
+            break;
+        }
+    }
+    e->active = false;
+}
+
+static void quicpro_reactor_detach(quicpro_reactor_t *r, quicpro_reactor_entry_t *e)
+{
+    quicpro_reactor_unqueue(r, e);
+    quicpro_tw_cancel(&r->wheel, &e->timer);
+    if (e->fd >= 0 && quicpro_reactor_entry_alive(e)) {
+        epoll_ctl(r->epfd, EPOLL_CTL_DEL, e->fd, NULL);
+    }
+    zend_hash_index_del(&r->entries, (zend_ulong)(uintptr_t)e->s);
+}
+
+static void quicpro_reactor_dtor(zend_resource *res)
+{
+    if (res->ptr) {
+        quicpro_reactor_destroy((quicpro_reactor_t *)res->ptr);
+        res->ptr = NULL;
+    }
+}
+
+void quicpro_reactor_minit(int module_number)
+{
+    le_quicpro_reactor = zend_register_list_destructors_ex(
+        quicpro_reactor_dtor, NULL, "quicpro_reactor", module_number);
+}
+
+/*─────────────────────────────── Callbacks ───────────────────────────────*/
+
+static void quicpro_reactor_on_timer(quicpro_tw_node_t *node, void *ctx)
+{
+    quicpro_reactor_t       *r = ctx;
+    quicpro_reactor_entry_t *e = node->data;
+
+    if (quicpro_reactor_entry_alive(e)) {
+        quiche_conn_on_timeout(e->s->conn);
+    }
+    quicpro_reactor_mark(r, e);
+}
+
+static void quicpro_reactor_on_xdp_rx(void *ctx, quicpro_session_t *s)
+{
+    quicpro_reactor_t *r = ctx;
+    quicpro_reactor_entry_t *e = zend_hash_index_find_ptr(&r->entries, (zend_ulong)(uintptr_t)s);
+    if (e) {
+        quicpro_reactor_mark(r, e);
+    }
+}
+
+/*────────────────────────────── Internal API ─────────────────────────────*/
+
+quicpro_reactor_t *quicpro_reactor_create(void)
+{
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        return NULL;
+    }
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (tfd < 0) {
+        int saved = errno;
+        close(epfd);
+        errno = saved;
+        return NULL;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &quicpro_reactor_timer_tag };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &ev);
+
+    quicpro_reactor_t *r = ecalloc(1, sizeof(*r));
+    r->epfd = epfd;
+    quicpro_busy_poll_init(&r->busy, epfd);
+    r->tfd  = tfd;
+    quicpro_tw_init(&r->wheel, quicpro_reactor_now_ms());
+    zend_hash_init(&r->entries, 64, NULL, quicpro_reactor_entry_dtor, 0);
+    return r;
+}
+
+void quicpro_reactor_destroy(quicpro_reactor_t *r)
+{
+    if (!r) {
+        return;
+    }
+    /* Descriptors go away with epfd; only the resource references remain */
+    zend_hash_destroy(&r->entries);
+    close(r->tfd);
+    close(r->epfd);
+    efree(r);
+}
+
+bool quicpro_reactor_attach(quicpro_reactor_t *r, quicpro_session_t *s, zend_resource *res)
+{
+    if (!s || !s->conn) {
+        return false;
+    }
+
+    quicpro_reactor_entry_t *old = zend_hash_index_find_ptr(&r->entries, (zend_ulong)(uintptr_t)s);
+    if (old) {
+        if (quicpro_reactor_entry_alive(old)) {
+            return true;
+        }
+        /* A closed session left a stale entry at the same address */
+        quicpro_reactor_detach(r, old);
+    }
+
+    quicpro_reactor_entry_t *e = ecalloc(1, sizeof(*e));
+    e->res = res;
+    e->s   = s;
+    e->fd  = -1;
+    e->timer.data = e;
+    if (res) {
+        GC_ADDREF(res);
+    }
+    zend_hash_index_add_new_ptr(&r->entries, (zend_ulong)(uintptr_t)s, e);
+
+    quicpro_xdp_attach(s);
+    if (!r->xdp_watched && quicpro_xdp_fd() >= 0) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &quicpro_reactor_xdp_tag };
+        r->xdp_watched = epoll_ctl(r->epfd, EPOLL_CTL_ADD, quicpro_xdp_fd(), &ev) == 0;
+    }
+    quicpro_reactor_watch(r, e);
+
+    /* First tick flushes whatever quiche already queued (e.g. the Initial) */
+    quicpro_reactor_schedule(r, e, quicpro_reactor_now_ms());
+    quicpro_reactor_mark(r, e);
+    return true;
+}
+
+bool quicpro_reactor_detach_session(quicpro_reactor_t *r, const quicpro_session_t *s)
+{
+    quicpro_reactor_entry_t *e = zend_hash_index_find_ptr(&r->entries, (zend_ulong)(uintptr_t)s);
+    if (!e) {
+        return false;
+    }
+    quicpro_reactor_detach(r, e);
+    return true;
+}
+
+size_t quicpro_reactor_count(const quicpro_reactor_t *r)
+{
+    return zend_hash_num_elements(&r->entries);
+}
+
+int quicpro_reactor_tick(quicpro_reactor_t *r, int timeout_ms, quicpro_reactor_visit_cb cb, void *ctx)
+{
+    struct epoll_event events[QUICPRO_REACTOR_MAX_EVENTS];
+
+    /* Step 1–2: one wait for sockets, rings and the earliest quiche deadline */
+    quicpro_reactor_arm_timer(r);
+    quicpro_worker_wait_begin();
+    int n = epoll_wait(r->epfd, events, QUICPRO_REACTOR_MAX_EVENTS,
+                       r->active_head ? 0 : (timeout_ms < 0 ? -1 : timeout_ms));
+    quicpro_worker_wait_end(n);
+    quicpro_busy_poll_note(&r->busy, n);
+    if (n < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+        n = 0;
+    }
+
+    /* Step 3: input */
+    for (int i = 0; i < n; i++) {
+        void *tag = events[i].data.ptr;
+
+        if (tag == &quicpro_reactor_timer_tag) {
+            uint64_t expirations;
+            (void)!read(r->tfd, &expirations, sizeof(expirations));
+        } else if (tag == &quicpro_reactor_xdp_tag) {
+            quicpro_xdp_drain(quicpro_reactor_on_xdp_rx, r);
+        } else {
+            quicpro_reactor_entry_t *e = tag;
+            if (quicpro_reactor_entry_alive(e)) {
+                quicpro_session_pump_rx(e->s);
+            }
+            quicpro_reactor_mark(r, e);
+        }
+    }
+
+    /* Step 4: timers */
+    uint64_t now_ms = quicpro_reactor_now_ms();
+    quicpro_tw_advance(&r->wheel, now_ms, quicpro_reactor_on_timer, r);
+
+    /* Step 5: transmit, re-arm and report only what was touched */
+    int visited = 0;
+    uint64_t idle_now_ms = quicpro_hibernate_now_ms();
+    quicpro_reactor_entry_t *e = r->active_head;
+    r->active_head = NULL;
+    while (e) {
+        quicpro_reactor_entry_t *next = e->next_active;
+        e->active = false;
+        e->next_active = NULL;
+
+        if (!quicpro_reactor_entry_alive(e)) {
+            quicpro_reactor_detach(r, e);
+            e = next;
+            continue;
+        }
+
+        quicpro_session_pump_tx(e->s);
+        quicpro_reactor_watch(r, e);
+
+        bool closed = quiche_conn_is_closed(e->s->conn);
+        if (!closed) {
+            quicpro_session_hibernate_tick(e->s, idle_now_ms);
+            quicpro_reactor_schedule(r, e, now_ms);
+        }
+
+        /* Report before detaching: the entry may hold the last reference */
+        if (cb) {
+            cb(ctx, e->res, e->s);
+        }
+        if (closed) {
+            quicpro_reactor_detach(r, e);
+        }
+        visited++;
+        e = next;
+    }
+
+    /* An outer event loop watching epfd (quicpro_reactor_fd()) wakes for the next deadline */
+    quicpro_reactor_arm_timer(r);
+    return visited;
+}
+
+int quicpro_reactor_epoll_fd(const quicpro_reactor_t *r)
+{
+    return r->epfd;
+}
+
+/*───────────────────────────── PHP Functions ─────────────────────────────*/
+
+/* {{{ quicpro_reactor_new(): resource */
+PHP_FUNCTION(quicpro_reactor_new)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    quicpro_reactor_t *r = quicpro_reactor_create();
+    if (!r) {
+        php_error_docref(NULL, E_WARNING, "Cannot create reactor: %s", strerror(errno));
+        RETURN_FALSE;
+    }
+    RETURN_RES(zend_register_resource(r, le_quicpro_reactor));
+}
+/* }}} */
+
+/* {{{ quicpro_reactor_add(resource $reactor, resource $session): bool */
+PHP_FUNCTION(quicpro_reactor_add)
+{
+    zval *zr, *zs;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_RESOURCE(zr)
+        Z_PARAM_RESOURCE(zs)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_reactor_t *r = zend_fetch_resource(Z_RES_P(zr), "quicpro_reactor", le_quicpro_reactor);
+    quicpro_session_t *s = zend_fetch_resource(Z_RES_P(zs), "quicpro", le_quicpro);
+    if (!r || !s) {
+        RETURN_FALSE;
+    }
+    RETURN_BOOL(quicpro_reactor_attach(r, s, Z_RES_P(zs)));
+}
+/* }}} */
+
+/* {{{ quicpro_reactor_remove(resource $reactor, resource $session): bool */
+PHP_FUNCTION(quicpro_reactor_remove)
+{
+    zval *zr, *zs;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_RESOURCE(zr)
+        Z_PARAM_RESOURCE(zs)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_reactor_t *r = zend_fetch_resource(Z_RES_P(zr), "quicpro_reactor", le_quicpro_reactor);
+    if (!r || !Z_RES_P(zs)->ptr) {
+        RETURN_FALSE;
+    }
+    RETURN_BOOL(quicpro_reactor_detach_session(r, Z_RES_P(zs)->ptr));
+}
+/* }}} */
+
+static void quicpro_reactor_collect(void *ctx, zend_resource *res, quicpro_session_t *s)
+{
+    zval zs;
+    (void)s;
+    if (res) {
+        ZVAL_RES(&zs, res);
+        GC_ADDREF(res);
+        add_next_index_zval((zval *)ctx, &zs);
+    }
+}
+
+/* {{{ quicpro_reactor_run(resource $reactor, int $timeout_ms): array|false */
+PHP_FUNCTION(quicpro_reactor_run)
+{
+    zval      *zr;
+    zend_long  timeout_ms;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_RESOURCE(zr)
+        Z_PARAM_LONG(timeout_ms)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_reactor_t *r = zend_fetch_resource(Z_RES_P(zr), "quicpro_reactor", le_quicpro_reactor);
+    if (!r) {
+        RETURN_FALSE;
+    }
+
+    array_init(return_value);
+    if (quicpro_reactor_tick(r, timeout_ms < 0 ? -1 : (int)MIN(timeout_ms, INT_MAX),
+                             quicpro_reactor_collect, return_value) < 0) {
+        php_error_docref(NULL, E_WARNING, "epoll_wait failed: %s", strerror(errno));
+        zval_ptr_dtor(return_value);
+        RETURN_FALSE;
+    }
+}
+/* }}} */
+
+/* {{{ quicpro_reactor_stats(resource $reactor): array|false */
+PHP_FUNCTION(quicpro_reactor_stats)
+{
+    zval *zr;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_RESOURCE(zr)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_reactor_t *r = zend_fetch_resource(Z_RES_P(zr), "quicpro_reactor", le_quicpro_reactor);
+    if (!r) {
+        RETURN_FALSE;
+    }
+
+    quicpro_conn_stats_columns_t cols;
+    quicpro_reactor_entry_t *e;
+    quicpro_conn_stats_begin(&cols, zend_hash_num_elements(&r->entries));
+    ZEND_HASH_FOREACH_PTR(&r->entries, e) {
+        if (quicpro_reactor_entry_alive(e) && e->s->conn) {
+            quicpro_conn_stats_add(&cols, e->s);
+        }
+    } ZEND_HASH_FOREACH_END();
+    quicpro_conn_stats_end(return_value, &cols);
+}
+/* }}} */
@@ -0,0 +1,404 @@
+/*
+ * scheduler.c  –  Fiber-parking scheduler for php-quicpro
+ * -------------------------------------------------------
+ *
+ * Waiters live on the parked fiber's own C stack: a Fiber keeps its stack
+ * while suspended, so quicpro_sched_wait() can hand out a pointer to a
+ * local struct and unlink it after Fiber::suspend() returns. Nothing is
+ * allocated per wait.
+ *
+ *   waiting:   session* -> singly linked list of waiters on that session
+ *   run queue: waiters whose session progressed or whose deadline passed,
+ *              resumed in FIFO order by quicpro_scheduler_run()
+ *
+ * Each session is attached to the reactor while at least one waiter is
+ * parked on it and detached when the last one leaves.
+ *
+ * quicpro_sched_wait_conn() is the one wait of the blocking session calls
+ * (stream writes, datagrams, WebTransport); outside a Fiber it falls back
+ * to poll() on the session's socket.
+ */
+
+#include "php_quicpro.h"
+#include "poll/scheduler.h"
+#include "poll/poll.h"
+#include "poll/reactor.h"
+#include "poll/timer_wheel.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <quiche.h>
+#include <string.h>
+#include <time.h>
+
+#if PHP_VERSION_ID >= 80100
+# include <Zend/zend_fibers.h>
+#endif
+
+typedef struct quicpro_sched_waiter_s quicpro_sched_waiter_t;
+
+struct quicpro_sched_waiter_s {
+    quicpro_tw_node_t        deadline;
+#if PHP_VERSION_ID >= 80100
+    zend_fiber              *fiber;
+#endif
+    quicpro_session_t       *s;
+    quicpro_sched_result_t   result;
+    bool                     queued;
+    quicpro_sched_waiter_t  *next_wait;   /* Same-session list */
+    quicpro_sched_waiter_t  *next_run;    /* Run queue */
+};
+
+typedef struct {
+    bool                     initialized;
+    quicpro_reactor_t       *reactor;
+    quicpro_timer_wheel_t    deadlines;
+    HashTable                waiting;     /* quicpro_session_t* -> first waiter */
+    size_t                   nwaiters;
+    quicpro_sched_waiter_t  *run_head;
+    quicpro_sched_waiter_t **run_tail;
+} quicpro_sched_state_t;
+
+static quicpro_sched_state_t quicpro_sched;
+
+/*─────────────────────────────── Helpers ─────────────────────────────────*/
+
+static inline uint64_t quicpro_sched_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static bool quicpro_sched_init(void)
+{
+    if (quicpro_sched.initialized) {
+        return true;
+    }
+    quicpro_sched.reactor = quicpro_reactor_create();
+    if (!quicpro_sched.reactor) {
+        return false;
+    }
+    quicpro_tw_init(&quicpro_sched.deadlines, quicpro_sched_now_ms());
+    zend_hash_init(&quicpro_sched.waiting, 16, NULL, NULL, 0);
+    quicpro_sched.run_head    = NULL;
+    quicpro_sched.run_tail    = &quicpro_sched.run_head;
+    quicpro_sched.nwaiters    = 0;
+    quicpro_sched.initialized = true;
+    return true;
+}
+
+static void quicpro_sched_enqueue(quicpro_sched_waiter_t *w, quicpro_sched_result_t result)
+{
+    if (w->queued) {
+        return;
+    }
+    w->result   = result;
+    w->queued   = true;
+    w->next_run = NULL;
+    *quicpro_sched.run_tail = w;
+    quicpro_sched.run_tail  = &w->next_run;
+}
+
+static void quicpro_sched_dequeue(quicpro_sched_waiter_t *w)
+{
+    quicpro_sched_waiter_t **pp = &quicpro_sched.run_head;
+    while (*pp && *pp != w) {
+        pp = &(*pp)->next_run;
+    }
+    if (*pp) {
+        *pp = w->next_run;
+        if (quicpro_sched.run_tail == &w->next_run) {
+            quicpro_sched.run_tail = pp;
+        }
+    }
+    w->queued = false;
+}
+
+/* Removes a waiter from every structure; called by the waiter itself. */
+static void quicpro_sched_unlink(quicpro_sched_waiter_t *w)
+{
+    if (w->s) {                 /* A sleeper is on the run queue and the wheel only */
+        zend_ulong key = (zend_ulong)(uintptr_t)w->s;
+        quicpro_sched_waiter_t *head = zend_hash_index_find_ptr(&quicpro_sched.waiting, key);
+        quicpro_sched_waiter_t **pp = &head;
+
+        while (*pp && *pp != w) {
+            pp = &(*pp)->next_wait;
+        }
+        if (*pp) {
+            *pp = w->next_wait;
+        }
+        if (head) {
+            zend_hash_index_update_ptr(&quicpro_sched.waiting, key, head);
+        } else {
+            zend_hash_index_del(&quicpro_sched.waiting, key);
+            quicpro_reactor_detach_session(quicpro_sched.reactor, w->s);
+        }
+    }
+
+    if (w->queued) {
+        quicpro_sched_dequeue(w);
+    }
+    quicpro_tw_cancel(&quicpro_sched.deadlines, &w->deadline);
+    quicpro_sched.nwaiters--;
+}
+
+/*─────────────────────────────── Callbacks ───────────────────────────────*/
+
+static void quicpro_sched_on_session(void *ctx, zend_resource *res, quicpro_session_t *s)
+{
+    (void)ctx; (void)res;
+    quicpro_sched_waiter_t *w = zend_hash_index_find_ptr(&quicpro_sched.waiting, (zend_ulong)(uintptr_t)s);
+    for (; w; w = w->next_wait) {
+        quicpro_sched_enqueue(w, QUICPRO_SCHED_READY);
+    }
+}
+
+static void quicpro_sched_on_deadline(quicpro_tw_node_t *node, void *ctx)
+{
+    (void)ctx;
+    quicpro_sched_enqueue((quicpro_sched_waiter_t *)node->data, QUICPRO_SCHED_TIMEOUT);
+}
+
+/*────────────────────────────── Internal API ─────────────────────────────*/
+
+bool quicpro_sched_in_fiber(void)
+{
+#if PHP_VERSION_ID >= 80100
+    return EG(active_fiber) != NULL;
+#else
+    return false;
+#endif
+}
+
+void quicpro_sched_wake(quicpro_session_t *s)
+{
+    if (quicpro_sched.initialized) {
+        quicpro_sched_on_session(NULL, NULL, s);
+    }
+}
+
+size_t quicpro_sched_pending(void)
+{
+    return quicpro_sched.initialized ? quicpro_sched.nwaiters : 0;
+}
+
+quicpro_sched_result_t quicpro_sched_wait(quicpro_session_t *s, zend_resource *res, zend_long timeout_ms)
+{
+#if PHP_VERSION_ID >= 80100
+    zend_fiber *fiber = EG(active_fiber);
+    if (!fiber || !s || !s->conn || !quicpro_sched_init()) {
+        return QUICPRO_SCHED_NO_FIBER;
+    }
+
+    quicpro_sched_waiter_t w;
+    memset(&w, 0, sizeof(w));
+    w.fiber         = fiber;
+    w.s             = s;
+    w.result        = QUICPRO_SCHED_RESUMED;
+    w.deadline.data = &w;
+
+    zend_ulong key = (zend_ulong)(uintptr_t)s;
+    w.next_wait = zend_hash_index_find_ptr(&quicpro_sched.waiting, key);
+    if (!w.next_wait) {
+        quicpro_reactor_attach(quicpro_sched.reactor, s, res);
+    }
+    zend_hash_index_update_ptr(&quicpro_sched.waiting, key, &w);
+    quicpro_sched.nwaiters++;
+
+    if (timeout_ms >= 0) {
+        quicpro_tw_schedule(&quicpro_sched.deadlines, &w.deadline,
+                            quicpro_sched_now_ms() + (uint64_t)timeout_ms);
+    }
+
+    /* Park: control returns to whoever resumed this fiber */
+    zval retval;
+    ZVAL_UNDEF(&retval);
+    zend_call_method_with_0_params(NULL, zend_ce_fiber, NULL, "suspend", &retval);
+    zval_ptr_dtor(&retval);
+
+    quicpro_sched_unlink(&w);
+
+    return EG(exception) ? QUICPRO_SCHED_ERROR : w.result;
+#else
+    (void)s; (void)res; (void)timeout_ms;
+    return QUICPRO_SCHED_NO_FIBER;
+#endif
+}
+
+bool quicpro_sched_owns_io(const quicpro_session_t *s)
+{
+    return !quiche_conn_is_server(s->conn) && s->sock >= 0;
+}
+
+void quicpro_sched_pump_rx(quicpro_session_t *s)
+{
+    if (quicpro_sched_owns_io(s)) {
+        quicpro_session_pump_rx(s);
+        if (quiche_conn_timeout_as_millis(s->conn) == 0) {
+            quiche_conn_on_timeout(s->conn);
+        }
+    }
+}
+
+void quicpro_sched_pump_tx(quicpro_session_t *s)
+{
+    if (quicpro_sched_owns_io(s)) {
+        quicpro_session_pump_tx(s);
+    }
+}
+
+zend_long quicpro_sched_clock_ms(void)
+{
+    return (zend_long)quicpro_sched_now_ms();
+}
+
+int quicpro_sched_wait_conn(quicpro_session_t *s, zend_resource *res, zend_long start_ms,
+                            zend_long timeout_ms, const char *what)
+{
+    if (!quicpro_sched_owns_io(s)) {
+        return 0;
+    }
+    zend_long elapsed = quicpro_sched_clock_ms() - start_ms;
+    if (timeout_ms >= 0 && elapsed >= timeout_ms) {
+        return 0;
+    }
+    zend_long wait_ms = timeout_ms >= 0 ? timeout_ms - elapsed : -1;
+    int64_t quic_deadline = quiche_conn_timeout_as_millis(s->conn);
+    if (quic_deadline >= 0 && (wait_ms < 0 || quic_deadline < wait_ms)) {
+        wait_ms = quic_deadline;
+    }
+
+    quicpro_sched_result_t rc = quicpro_sched_wait(s, res, wait_ms);
+    if (rc == QUICPRO_SCHED_ERROR) {
+        return -1;
+    }
+    if (rc == QUICPRO_SCHED_NO_FIBER) {
+        struct pollfd pfd = { .fd = s->sock, .events = POLLIN };
+        if (poll(&pfd, 1, wait_ms < 0 ? -1 : (int)MIN(wait_ms, INT_MAX)) < 0 && errno != EINTR) {
+            throw_network_exception(errno, "Failed to wait for %s: %s", what, strerror(errno));
+            return -1;
+        }
+    }
+    if (s->is_closed || !s->conn) {
+        throw_quic_exception(0, "Session closed while waiting for %s", what);
+        return -1;
+    }
+    return 1;
+}
+
+quicpro_sched_result_t quicpro_sched_sleep(zend_long ms)
+{
+#if PHP_VERSION_ID >= 80100
+    zend_fiber *fiber = EG(active_fiber);
+    if (!fiber || !quicpro_sched_init()) {
+        return QUICPRO_SCHED_NO_FIBER;
+    }
+
+    quicpro_sched_waiter_t w;
+    memset(&w, 0, sizeof(w));
+    w.fiber         = fiber;
+    w.result        = QUICPRO_SCHED_RESUMED;
+    w.deadline.data = &w;
+    quicpro_sched.nwaiters++;
+    quicpro_tw_schedule(&quicpro_sched.deadlines, &w.deadline, quicpro_sched_now_ms() + (uint64_t)MAX(ms, 0));
+
+    zval retval;
+    ZVAL_UNDEF(&retval);
+    zend_call_method_with_0_params(NULL, zend_ce_fiber, NULL, "suspend", &retval);
+    zval_ptr_dtor(&retval);
+
+    quicpro_sched_unlink(&w);
+
+    return EG(exception) ? QUICPRO_SCHED_ERROR : w.result;
+#else
+    (void)ms;
+    return QUICPRO_SCHED_NO_FIBER;
+#endif
+}
+
+void quicpro_sched_shutdown(void)
+{
+    if (!quicpro_sched.initialized) {
+        return;
+    }
+    /* Suspended fibers were destroyed (and unlinked) before RSHUTDOWN */
+    quicpro_reactor_destroy(quicpro_sched.reactor);
+    zend_hash_destroy(&quicpro_sched.waiting);
+    memset(&quicpro_sched, 0, sizeof(quicpro_sched));
+}
+
+zend_long quicpro_sched_run(zend_long timeout_ms)
+{
+    if (!quicpro_sched.initialized || quicpro_sched.nwaiters == 0) {
+        return 0;
+    }
+
+    uint64_t now  = quicpro_sched_now_ms();
+    uint64_t next = quicpro_tw_next_expiry(&quicpro_sched.deadlines);
+    zend_long wait_ms = timeout_ms < 0 ? -1 : timeout_ms;
+    if (next != QUICPRO_TW_NEVER) {
+        zend_long until = next > now ? (zend_long)(next - now) : 0;
+        if (wait_ms < 0 || until < wait_ms) {
+            wait_ms = until;
+        }
+    }
+    if (quicpro_sched.run_head) {
+        wait_ms = 0;
+    }
+
+    if (quicpro_reactor_tick(quicpro_sched.reactor, wait_ms < 0 ? -1 : (int)MIN(wait_ms, INT_MAX),
+                             quicpro_sched_on_session, NULL) < 0) {
+        php_error_docref(NULL, E_WARNING, "Scheduler wait failed: %s", strerror(errno));
+        return -1;
+    }
+    quicpro_tw_advance(&quicpro_sched.deadlines, quicpro_sched_now_ms(), quicpro_sched_on_deadline, NULL);
+
+#if PHP_VERSION_ID >= 80100
+    while (quicpro_sched.run_head && !EG(exception)) {
+        quicpro_sched_waiter_t *w = quicpro_sched.run_head;
+        zend_fiber *fiber = w->fiber;
+
+        quicpro_sched_dequeue(w);
+
+        /* The waiter unlinks itself once its fiber is running again */
+        zval retval;
+        ZVAL_UNDEF(&retval);
+        GC_ADDREF(&fiber->std);
+        zend_call_method_with_0_params(&fiber->std, zend_ce_fiber, NULL, "resume", &retval);
+        zval_ptr_dtor(&retval);
+        OBJ_RELEASE(&fiber->std);
+    }
+#endif
+
+    return (zend_long)quicpro_sched.nwaiters;
+}
+
+/*───────────────────────────── PHP Function ──────────────────────────────*/
+
+/* {{{ quicpro_scheduler_run(int $timeout_ms = -1): int|false
+ *
+ * Runs one scheduler tick: waits up to $timeout_ms (capped by the earliest
+ * waiter deadline) for progress on any session a Fiber is parked on, then
+ * resumes those fibers. Returns the number of fibers still parked, so
+ * `while (quicpro_scheduler_run(100) > 0) {}` drives everything to
+ * completion.
+ */
+PHP_FUNCTION(quicpro_scheduler_run)
+{
+    zend_long timeout_ms = -1;
+
+    ZEND_PARSE_PARAMETERS_START(0, 1)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(timeout_ms)
+    ZEND_PARSE_PARAMETERS_END();
+
+    zend_long pending = quicpro_sched_run(timeout_ms);
+    if (pending < 0) {
+        RETURN_FALSE;
+    }
+    RETURN_LONG(pending);
+}
+/* }}} */
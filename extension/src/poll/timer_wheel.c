@@ -0,0 +1,218 @@
+/*
+ * timer_wheel.c  –  Hierarchical timer wheel for php-quicpro
+ * ----------------------------------------------------------
+ *
+ * Placement rule: a timer lives on the lowest level whose enclosing block
+ * (the range covered by one slot of the level above) also contains `now`.
+ * Level 0 therefore holds everything due within the current 64 ms block,
+ * level 1 everything within the current 4096 ms block, and so on. When the
+ * clock crosses into a slot of an upper level, that slot is cascaded: its
+ * timers are re-placed relative to the new time and sink one or more levels.
+ *
+ * Timers further out than the top level can represent are clamped to the
+ * end of the current top block and re-placed when they surface; their real
+ * deadline is kept in `expires`, so they never fire early.
+ */
+
+#include "poll/timer_wheel.h"
+
+#include <string.h>
+
+#define QUICPRO_TW_SPAN_MASK  ((UINT64_C(1) << (QUICPRO_TW_BITS * QUICPRO_TW_LEVELS)) - 1)
+
+/*──────────────────────────── List Helpers ───────────────────────────────*/
+
+static inline void quicpro_tw_list_init(quicpro_tw_node_t *head)
+{
+    head->next = head;
+    head->prev = head;
+}
+
+static inline bool quicpro_tw_list_empty(const quicpro_tw_node_t *head)
+{
+    return head->next == head;
+}
+
+static inline void quicpro_tw_list_unlink(quicpro_tw_node_t *n)
+{
+    n->prev->next = n->next;
+    n->next->prev = n->prev;
+    n->next = n->prev = n;
+}
+
+/* Moves every node of `head` onto the (empty) list `dst`. */
+static void quicpro_tw_list_take(quicpro_tw_node_t *head, quicpro_tw_node_t *dst)
+{
+    if (quicpro_tw_list_empty(head)) {
+        quicpro_tw_list_init(dst);
+        return;
+    }
+    dst->next = head->next;
+    dst->prev = head->prev;
+    dst->next->prev = dst;
+    dst->prev->next = dst;
+    quicpro_tw_list_init(head);
+}
+
+/*──────────────────────────── Placement ──────────────────────────────────*/
+
+/* Places an armed node; deadlines before `base` are treated as `base`. */
+static void quicpro_tw_link(quicpro_timer_wheel_t *w, quicpro_tw_node_t *n, uint64_t base)
+{
+    uint64_t at      = n->expires > base ? n->expires : base;
+    uint64_t horizon = w->now | QUICPRO_TW_SPAN_MASK;
+
+    if (at > horizon) {
+        at = horizon > w->now ? horizon : w->now + 1;
+    }
+
+    unsigned level = 0;
+    while (level < QUICPRO_TW_LEVELS - 1 &&
+           (at >> (QUICPRO_TW_BITS * (level + 1))) != (w->now >> (QUICPRO_TW_BITS * (level + 1)))) {
+        level++;
+    }
+    unsigned slot = (unsigned)(at >> (QUICPRO_TW_BITS * level)) & QUICPRO_TW_MASK;
+
+    quicpro_tw_node_t *head = &w->slots[level][slot];
+    n->level = (uint8_t)level;
+    n->slot  = (uint8_t)slot;
+    n->prev  = head->prev;
+    n->next  = head;
+    head->prev->next = n;
+    head->prev = n;
+    w->occupied[level] |= UINT64_C(1) << slot;
+}
+
+static void quicpro_tw_unlink(quicpro_timer_wheel_t *w, quicpro_tw_node_t *n)
+{
+    quicpro_tw_list_unlink(n);
+    if (quicpro_tw_list_empty(&w->slots[n->level][n->slot])) {
+        w->occupied[n->level] &= ~(UINT64_C(1) << n->slot);
+    }
+}
+
+/*──────────────────────────── Public API ─────────────────────────────────*/
+
+void quicpro_tw_init(quicpro_timer_wheel_t *w, uint64_t now)
+{
+    memset(w, 0, sizeof(*w));
+    w->now = now;
+    for (unsigned l = 0; l < QUICPRO_TW_LEVELS; l++) {
+        for (unsigned i = 0; i < QUICPRO_TW_SLOTS; i++) {
+            quicpro_tw_list_init(&w->slots[l][i]);
+        }
+    }
+}
+
+void quicpro_tw_schedule(quicpro_timer_wheel_t *w, quicpro_tw_node_t *node, uint64_t expires)
+{
+    quicpro_tw_cancel(w, node);
+    node->expires = expires;
+    node->armed   = true;
+    w->count++;
+    quicpro_tw_link(w, node, w->now + 1);
+}
+
+void quicpro_tw_cancel(quicpro_timer_wheel_t *w, quicpro_tw_node_t *node)
+{
+    if (!node->armed) {
+        return;
+    }
+    quicpro_tw_unlink(w, node);
+    node->armed = false;
+    w->count--;
+}
+
+uint64_t quicpro_tw_next_expiry(const quicpro_timer_wheel_t *w)
+{
+    if (w->count == 0) {
+        return QUICPRO_TW_NEVER;
+    }
+
+    for (unsigned l = 0; l < QUICPRO_TW_LEVELS; l++) {
+        unsigned shift = QUICPRO_TW_BITS * l;
+        unsigned cur   = (unsigned)(w->now >> shift) & QUICPRO_TW_MASK;
+        uint64_t bits  = cur == QUICPRO_TW_MASK ? 0 : w->occupied[l] >> (cur + 1);
+
+        if (bits) {
+            unsigned slot  = cur + 1 + (unsigned)__builtin_ctzll(bits);
+            uint64_t block = (w->now >> (shift + QUICPRO_TW_BITS)) << (shift + QUICPRO_TW_BITS);
+            return block | ((uint64_t)slot << shift);
+        }
+    }
+
+    /* Only a timer clamped across the top-level boundary remains */
+    return w->now + 1;
+}
+
+/* Re-places every timer of the upper-level slots that `t` has just entered. */
+static void quicpro_tw_cascade(quicpro_timer_wheel_t *w, uint64_t t)
+{
+    unsigned top = 0;
+    while (top + 1 < QUICPRO_TW_LEVELS &&
+           (t & ((UINT64_C(1) << (QUICPRO_TW_BITS * (top + 1))) - 1)) == 0) {
+        top++;
+    }
+
+    for (unsigned level = top; level >= 1; level--) {
+        unsigned slot = (unsigned)(t >> (QUICPRO_TW_BITS * level)) & QUICPRO_TW_MASK;
+        quicpro_tw_node_t local;
+
+        quicpro_tw_list_take(&w->slots[level][slot], &local);
+        w->occupied[level] &= ~(UINT64_C(1) << slot);
+
+        while (!quicpro_tw_list_empty(&local)) {
+            quicpro_tw_node_t *n = local.next;
+            quicpro_tw_list_unlink(n);
+            quicpro_tw_link(w, n, t);
+        }
+    }
+}
+
+static size_t quicpro_tw_fire(quicpro_timer_wheel_t *w, uint64_t t, quicpro_tw_cb cb, void *ctx)
+{
+    unsigned slot = (unsigned)t & QUICPRO_TW_MASK;
+    size_t fired = 0;
+    quicpro_tw_node_t local;
+
+    quicpro_tw_list_take(&w->slots[0][slot], &local);
+    w->occupied[0] &= ~(UINT64_C(1) << slot);
+
+    /* Pop one at a time: callbacks may cancel nodes still on `local` */
+    while (!quicpro_tw_list_empty(&local)) {
+        quicpro_tw_node_t *n = local.next;
+        quicpro_tw_list_unlink(n);
+
+        if (n->expires > t) {
+            /* Clamped long timer surfaced early: place it again */
+            quicpro_tw_link(w, n, t + 1);
+            continue;
+        }
+
+        n->armed = false;
+        w->count--;
+        fired++;
+        cb(n, ctx);
+    }
+    return fired;
+}
+
+size_t quicpro_tw_advance(quicpro_timer_wheel_t *w, uint64_t now, quicpro_tw_cb cb, void *ctx)
+{
+    size_t fired = 0;
+
+    while (w->count > 0) {
+        uint64_t t = quicpro_tw_next_expiry(w);
+        if (t > now) {
+            break;
+        }
+        w->now = t;
+        quicpro_tw_cascade(w, t);
+        fired += quicpro_tw_fire(w, t, cb, ctx);
+    }
+
+    if (now > w->now) {
+        w->now = now;
+    }
+    return fired;
+}
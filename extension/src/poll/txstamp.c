@@ -0,0 +1,354 @@
+/*
+ * txstamp.c  –  Kernel TX timestamp harvesting for php-quicpro
+ * -------------------------------------------------------------
+ *
+ * Every report on the error queue carries two cmsgs: the timestamps
+ * (SO_TIMESTAMPING_NEW, three slots: software, legacy, raw hardware) and a
+ * sock_extended_err whose ee_data is the OPT_ID counter of the sendmsg()
+ * and whose ee_info tells which stage (SCHED, SND) produced the stamp.
+ *
+ * Software stamps use CLOCK_REALTIME, so send times are taken from the same
+ * clock. Hardware stamps come from the NIC's PHC; they are only comparable
+ * when the PHC is disciplined to system time (phc2sys), so implausible
+ * deltas are discarded rather than recorded.
+ */
+
+#include "php_quicpro.h"
+#include "poll/txstamp.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+# include <netinet/in.h>
+# include <sys/socket.h>
+# include <linux/errqueue.h>
+# include <linux/net_tstamp.h>
+#endif
+
+#define QUICPRO_TXSTAMP_MASK        (QUICPRO_TXSTAMP_RING - 1)
+
+/* Reports read per drain; the rest wait for the next pump. */
+#define QUICPRO_TXSTAMP_DRAIN_MAX   256
+
+/* Hardware deltas beyond this are treated as unsynchronised clocks. */
+#define QUICPRO_TXSTAMP_HW_MAX_NS   (1000ull * 1000 * 1000)
+
+/* EWMA weight 1/8, as in RFC 6298 SRTT. */
+#define QUICPRO_EWMA(avg, sample) \
+    ((avg) == 0 ? (sample) : (avg) - ((avg) >> 3) + ((sample) >> 3))
+
+/*──────────────────────────── Histogram ──────────────────────────────────*/
+
+void quicpro_lat_hist_record(quicpro_lat_hist_t *h, uint64_t ns)
+{
+    uint64_t us = ns >> 10;
+    unsigned b  = us ? 64u - (unsigned)__builtin_clzll(us) : 0;
+    if (b >= QUICPRO_LAT_HIST_BUCKETS) {
+        b = QUICPRO_LAT_HIST_BUCKETS - 1;
+    }
+
+    h->buckets[b]++;
+    if (h->count == 0 || ns < h->min_ns) {
+        h->min_ns = ns;
+    }
+    if (ns > h->max_ns) {
+        h->max_ns = ns;
+    }
+    h->count++;
+    h->sum_ns += ns;
+}
+
+uint64_t quicpro_lat_hist_percentile(const quicpro_lat_hist_t *h, double q)
+{
+    if (h->count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(q * (double)h->count);
+    if (rank >= h->count) {
+        rank = h->count - 1;
+    }
+
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < QUICPRO_LAT_HIST_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen > rank) {
+            uint64_t upper = UINT64_C(1) << (b + 10);
+            return upper < h->max_ns ? upper : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+/*──────────────────────────── Helpers ────────────────────────────────────*/
+
+static inline uint64_t quicpro_txstamp_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t quicpro_txstamp_ts_ns(int64_t sec, int64_t nsec)
+{
+    return (uint64_t)sec * 1000000000ull + (uint64_t)nsec;
+}
+
+/*──────────────────────────── Lifecycle ──────────────────────────────────*/
+
+int quicpro_txstamp_enable(quicpro_session_t *s)
+{
+#if defined(__linux__) && defined(SO_TIMESTAMPING_NEW)
+    if (s->txstamp) {
+        return 0;
+    }
+
+    int base = SOF_TIMESTAMPING_SOFTWARE
+             | SOF_TIMESTAMPING_RAW_HARDWARE
+             | SOF_TIMESTAMPING_RX_SOFTWARE
+             | SOF_TIMESTAMPING_RX_HARDWARE
+             | SOF_TIMESTAMPING_TX_SOFTWARE
+             | SOF_TIMESTAMPING_TX_HARDWARE;
+    int flags = base
+              | SOF_TIMESTAMPING_TX_SCHED
+              | SOF_TIMESTAMPING_OPT_ID
+              | SOF_TIMESTAMPING_OPT_TSONLY;
+    bool match_ids = true;
+
+    if (setsockopt(s->sock, SOL_SOCKET, SO_TIMESTAMPING_NEW, &flags, sizeof(flags)) != 0) {
+        /* Pre-4.x kernels: keep RX stamps, drain TX reports without ids */
+        if (errno != EINVAL ||
+            setsockopt(s->sock, SOL_SOCKET, SO_TIMESTAMPING_NEW, &base, sizeof(base)) != 0) {
+            return -1;
+        }
+        match_ids = false;
+    }
+
+    /* Setting OPT_ID restarts the kernel's counter at 0 */
+    s->txstamp = ecalloc(1, sizeof(*s->txstamp));
+    s->txstamp->match_ids = match_ids;
+    s->ts_enabled = 1;
+    return 0;
+#else
+    (void)s;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+void quicpro_txstamp_free(quicpro_txstamp_t *t)
+{
+    if (t) {
+        efree(t);
+    }
+}
+
+/*──────────────────────────── Send / Receive Hooks ───────────────────────*/
+
+void quicpro_txstamp_on_send(quicpro_session_t *s, unsigned nmsgs)
+{
+    quicpro_txstamp_t *t = s->txstamp;
+    if (!t || nmsgs == 0) {
+        return;
+    }
+
+    uint64_t now = quicpro_txstamp_now_ns();
+    for (unsigned i = 0; i < nmsgs; i++) {
+        uint32_t id = t->next_id++;
+        t->sent_id[id & QUICPRO_TXSTAMP_MASK] = id;
+        t->sent_ns[id & QUICPRO_TXSTAMP_MASK] = now;
+    }
+}
+
+void quicpro_txstamp_note_rx(quicpro_session_t *s)
+{
+    quicpro_txstamp_t *t = s->txstamp;
+    if (!t || s->last_rx_ts.tv_sec == 0 ||
+        (s->last_rx_ts.tv_sec == t->seen_rx_ts.tv_sec &&
+         s->last_rx_ts.tv_nsec == t->seen_rx_ts.tv_nsec)) {
+        return;
+    }
+
+    t->seen_rx_ts = s->last_rx_ts;
+    uint64_t rx  = quicpro_txstamp_ts_ns(s->last_rx_ts.tv_sec, s->last_rx_ts.tv_nsec);
+    uint64_t now = quicpro_txstamp_now_ns();
+    if (now >= rx) {
+        t->rx_delay_ns = QUICPRO_EWMA(t->rx_delay_ns, now - rx);
+    }
+}
+
+/*──────────────────────────── Error Queue ────────────────────────────────*/
+
+#if defined(__linux__) && defined(SO_TIMESTAMPING_NEW)
+
+static void quicpro_txstamp_account(quicpro_txstamp_t *t, const struct sock_extended_err *serr,
+                                    const struct scm_timestamping64 *tss)
+{
+    t->harvested++;
+    if (!t->match_ids) {
+        return;
+    }
+
+    uint32_t id   = serr->ee_data;
+    unsigned slot = id & QUICPRO_TXSTAMP_MASK;
+    if (t->sent_id[slot] != id || t->sent_ns[slot] == 0) {
+        t->unmatched++;
+        return;
+    }
+    uint64_t sent = t->sent_ns[slot];
+
+    /* Hardware stamp: slot 2, NIC clock */
+    if (tss->ts[2].tv_sec || tss->ts[2].tv_nsec) {
+        uint64_t hw = quicpro_txstamp_ts_ns(tss->ts[2].tv_sec, tss->ts[2].tv_nsec);
+        if (hw >= sent && hw - sent < QUICPRO_TXSTAMP_HW_MAX_NS) {
+            quicpro_lat_hist_record(&t->wire, hw - sent);
+        }
+        return;
+    }
+
+    uint64_t sw = quicpro_txstamp_ts_ns(tss->ts[0].tv_sec, tss->ts[0].tv_nsec);
+    if (sw < sent) {
+        return;
+    }
+    switch (serr->ee_info) {
+        case SCM_TSTAMP_SCHED:
+            quicpro_lat_hist_record(&t->sched, sw - sent);
+            break;
+        case SCM_TSTAMP_SND:
+            quicpro_lat_hist_record(&t->send, sw - sent);
+            t->tx_delay_ns = QUICPRO_EWMA(t->tx_delay_ns, sw - sent);
+            break;
+        default:
+            break;
+    }
+}
+
+int quicpro_txstamp_drain(quicpro_session_t *s)
+{
+    quicpro_txstamp_t *t = s->txstamp;
+    if (!t || s->sock < 0) {
+        return 0;
+    }
+
+    int      harvested = 0;
+    uint64_t sends     = t->send.count;
+
+    for (int i = 0; i < QUICPRO_TXSTAMP_DRAIN_MAX; i++) {
+        char          data[64];
+        char          control[512];
+        struct iovec  iov = { .iov_base = data, .iov_len = sizeof(data) };
+        struct msghdr msg = {
+            .msg_iov        = &iov,
+            .msg_iovlen     = 1,
+            .msg_control    = control,
+            .msg_controllen = sizeof(control),
+        };
+
+        if (recvmsg(s->sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return -1;
+        }
+
+        const struct scm_timestamping64 *tss  = NULL;
+        const struct sock_extended_err  *serr = NULL;
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_TIMESTAMPING_NEW) {
+                tss = (const struct scm_timestamping64 *)CMSG_DATA(cm);
+            } else if ((cm->cmsg_level == SOL_IP   && cm->cmsg_type == IP_RECVERR) ||
+                       (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+                serr = (const struct sock_extended_err *)CMSG_DATA(cm);
+            }
+        }
+
+        /* ICMP errors land here too; quiche detects those losses itself */
+        if (tss && serr && serr->ee_errno == ENOMSG &&
+            serr->ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+            quicpro_txstamp_account(t, serr, tss);
+            harvested++;
+        }
+    }
+
+    /* New send-delay samples: refresh the wire RTT estimate */
+    if (t->send.count != sends && s->conn) {
+        quiche_path_stats ps;
+        if (quiche_conn_path_stats(s->conn, 0, &ps) == 0) {
+            uint64_t host = t->tx_delay_ns + t->rx_delay_ns;
+            quicpro_lat_hist_record(&t->nic_rtt, ps.rtt > host ? ps.rtt - host : 0);
+        }
+    }
+
+    return harvested;
+}
+
+#else
+
+int quicpro_txstamp_drain(quicpro_session_t *s)
+{
+    (void)s;
+    return 0;
+}
+
+#endif
+
+/*──────────────────────────── Stats Export ───────────────────────────────*/
+
+static void quicpro_lat_hist_to_zval(const quicpro_lat_hist_t *h, zval *out)
+{
+    zval buckets;
+
+    array_init(out);
+    add_assoc_long(out, "count",   (zend_long)h->count);
+    add_assoc_long(out, "min_ns",  (zend_long)h->min_ns);
+    add_assoc_long(out, "max_ns",  (zend_long)h->max_ns);
+    add_assoc_long(out, "mean_ns", h->count ? (zend_long)(h->sum_ns / h->count) : 0);
+    add_assoc_long(out, "p50_ns",  (zend_long)quicpro_lat_hist_percentile(h, 0.50));
+    add_assoc_long(out, "p90_ns",  (zend_long)quicpro_lat_hist_percentile(h, 0.90));
+    add_assoc_long(out, "p99_ns",  (zend_long)quicpro_lat_hist_percentile(h, 0.99));
+    add_assoc_long(out, "p999_ns", (zend_long)quicpro_lat_hist_percentile(h, 0.999));
+
+    /* Trailing empty buckets are omitted; bucket i ends at 2^(i+10) ns */
+    unsigned last = QUICPRO_LAT_HIST_BUCKETS;
+    while (last > 0 && h->buckets[last - 1] == 0) {
+        last--;
+    }
+    array_init_size(&buckets, last);
+    for (unsigned b = 0; b < last; b++) {
+        add_next_index_long(&buckets, (zend_long)h->buckets[b]);
+    }
+    add_assoc_zval(out, "buckets", &buckets);
+}
+
+void quicpro_txstamp_add_stats(const quicpro_session_t *s, zval *arr)
+{
+    add_assoc_long(arr, "last_rx_ts_ns",
+                   (zend_long)quicpro_txstamp_ts_ns(s->last_rx_ts.tv_sec, s->last_rx_ts.tv_nsec));
+
+    const quicpro_txstamp_t *t = s->txstamp;
+    if (!t) {
+        return;
+    }
+
+    zval tx, h;
+    array_init(&tx);
+
+    quicpro_lat_hist_to_zval(&t->sched, &h);
+    add_assoc_zval(&tx, "sched", &h);
+    quicpro_lat_hist_to_zval(&t->send, &h);
+    add_assoc_zval(&tx, "send", &h);
+    quicpro_lat_hist_to_zval(&t->wire, &h);
+    add_assoc_zval(&tx, "wire", &h);
+    quicpro_lat_hist_to_zval(&t->nic_rtt, &h);
+    add_assoc_zval(&tx, "nic_rtt", &h);
+
+    add_assoc_long(&tx, "tx_delay_ns", (zend_long)t->tx_delay_ns);
+    add_assoc_long(&tx, "rx_delay_ns", (zend_long)t->rx_delay_ns);
+    add_assoc_long(&tx, "harvested",   (zend_long)t->harvested);
+    add_assoc_long(&tx, "unmatched",   (zend_long)t->unmatched);
+    add_assoc_bool(&tx, "ids",         t->match_ids);
+
+    add_assoc_zval(arr, "tx_timestamps", &tx);
+}
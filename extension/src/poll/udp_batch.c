@@ -0,0 +1,791 @@
+/*
+ * udp_batch.c  –  Batched UDP datagram I/O for php-quicpro
+ * --------------------------------------------------------
+ *
+ * One recvmsg() per QUIC packet means one syscall per ~1.3 KB of payload.
+ * Under load the user/kernel transitions cost more than quiche's own packet
+ * processing, so the event loops receive through the helpers in this file:
+ *
+ *   • quicpro_udp_rx_batch_new() lays out N slots (payload, source address,
+ *     cmsg space) and pre-wires them into a struct mmsghdr vector.
+ *   • quicpro_udp_recv_batch() drains up to N datagrams with a single
+ *     recvmmsg(MSG_DONTWAIT). Non-Linux builds fall back to a recvmsg()
+ *     loop over the same slots, so callers never need two code paths.
+ *   • quicpro_udp_rx_slot_timestamp() exposes the per-packet
+ *     SO_TIMESTAMPING_NEW cmsg that recvmmsg() preserves for every slot.
+ *   • With UDP GRO the kernel merges a flow's datagrams into one slot and
+ *     reports the segment size in a UDP_GRO cmsg; quicpro_udp_rx_deliver()
+ *     walks the slot in segment-sized steps so quiche still sees one QUIC
+ *     datagram per quiche_conn_recv() call.
+ *   • quicpro_udp_rx_slot_ecn() reads the IP_TOS / IPV6_TCLASS cmsg; the
+ *     codepoints are tallied in the batch's `ecn_rx` as slots are consumed.
+ *
+ * Batch size comes from quicpro.io_max_batch_read_packets
+ * (bare_metal_tuning), clamped to QUICPRO_UDP_BATCH_MAX.
+ *
+ * The transmit side mirrors this: quicpro_udp_tx_batch_fill() stages a burst
+ * from quiche_conn_send() (up to quicpro.io_max_batch_write_packets) and
+ * quicpro_udp_send_batch() submits it with one sendmmsg(). With UDP GSO,
+ * consecutive same-destination packets of equal size (the last one may be
+ * shorter) become a single UDP_SEGMENT message whose iovecs point straight
+ * into the staging slots, so coalescing costs no extra copy.
+ *
+ * quiche paces its own output: every packet carries a release time in
+ * `quiche_send_info.at`. With SO_TXTIME that time becomes an SCM_TXTIME cmsg
+ * (earliest departure time for fq, deadline for etf). Without it the batch
+ * doubles as a userspace pacer: quicpro_udp_send_batch() only submits the
+ * packets due within QUICPRO_PACE_HORIZON_NS and keeps the rest staged.
+ */
+
+#include "php_quicpro.h"
+#include "poll/udp_batch.h"
+#include "config/bare_metal_tuning/base_layer.h"
+#include "config/quic_transport/base_layer.h"
+#include "server/profiler.h"
+#include "cluster/cluster_stats.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#ifdef __linux__
+# include <netinet/udp.h>
+# ifndef SOL_UDP
+#  define SOL_UDP 17
+# endif
+# ifndef UDP_SEGMENT
+#  define UDP_SEGMENT 103        /* Missing from older libc headers */
+# endif
+# ifndef UDP_GRO
+#  define UDP_GRO 104
+# endif
+# include <linux/net_tstamp.h>  /* struct sock_txtime */
+# ifndef SO_TXTIME
+#  define SO_TXTIME 61
+#  define SCM_TXTIME SO_TXTIME
+# endif
+#endif
+
+/*──────────────────────────── Slot Management ────────────────────────────*/
+
+quicpro_udp_rx_batch_t *quicpro_udp_rx_batch_new(unsigned capacity, size_t slot_size)
+{
+    if (capacity == 0) {
+        capacity = 1;
+    } else if (capacity > QUICPRO_UDP_BATCH_MAX) {
+        capacity = QUICPRO_UDP_BATCH_MAX;
+    }
+
+    quicpro_udp_rx_batch_t *b = ecalloc(1, sizeof(*b));
+    b->capacity  = capacity;
+    b->slot_size = slot_size;
+    b->msgs      = ecalloc(capacity, sizeof(*b->msgs));
+    b->iov       = ecalloc(capacity, sizeof(*b->iov));
+    b->from      = ecalloc(capacity, sizeof(*b->from));
+    b->cmsg      = ecalloc(capacity, sizeof(*b->cmsg));
+    b->payload   = safe_emalloc(capacity, slot_size, 0);
+
+    for (unsigned i = 0; i < capacity; i++) {
+        b->iov[i].iov_base = quicpro_udp_rx_slot_data(b, i);
+        b->iov[i].iov_len  = slot_size;
+    }
+
+    return b;
+}
+
+void quicpro_udp_rx_batch_free(quicpro_udp_rx_batch_t *b)
+{
+    if (!b) {
+        return;
+    }
+    efree(b->payload);
+    efree(b->cmsg);
+    efree(b->from);
+    efree(b->iov);
+    efree(b->msgs);
+    efree(b);
+}
+
+size_t quicpro_udp_rx_slot_size(uint64_t max_recv_udp_payload_size)
+{
+    uint64_t size = max_recv_udp_payload_size
+                  ? max_recv_udp_payload_size
+                  : (uint64_t)quicpro_quic_transport_config.max_recv_udp_payload_size;
+    if (size > QUICPRO_UDP_PAYLOAD_MAX) {
+        size = QUICPRO_UDP_PAYLOAD_MAX;
+    }
+    return size > QUICPRO_UDP_RX_SLOT_SIZE ? (size_t)size : QUICPRO_UDP_RX_SLOT_SIZE;
+}
+
+void quicpro_udp_socket_pmtud(int fd)
+{
+    if (!quicpro_quic_transport_config.pmtud_enable) {
+        return;
+    }
+    /* Both levels: a dual-stack IPv6 socket sends IPv4 through the first */
+#if defined(IP_MTU_DISCOVER) && defined(IP_PMTUDISC_PROBE)
+    int v4 = IP_PMTUDISC_PROBE;
+    (void)setsockopt(fd, IPPROTO_IP, IP_MTU_DISCOVER, &v4, sizeof(v4));
+#endif
+#if defined(IPV6_MTU_DISCOVER) && defined(IPV6_PMTUDISC_PROBE)
+    int v6 = IPV6_PMTUDISC_PROBE;
+    (void)setsockopt(fd, IPPROTO_IPV6, IPV6_MTU_DISCOVER, &v6, sizeof(v6));
+#endif
+    (void)fd;
+}
+
+void quicpro_udp_socket_ecn(int fd)
+{
+    if (!quicpro_quic_transport_config.ecn_enable) {
+        return;
+    }
+    int on = 1;
+#ifdef IP_RECVTOS
+    (void)setsockopt(fd, IPPROTO_IP, IP_RECVTOS, &on, sizeof(on));
+#endif
+#ifdef IPV6_RECVTCLASS
+    (void)setsockopt(fd, IPPROTO_IPV6, IPV6_RECVTCLASS, &on, sizeof(on));
+#endif
+    if (quicpro_quic_transport_config.ecn_mark_ect) {
+        /* The DSCP bits stay zero, as the sockets never set them */
+        int tos = QUICPRO_ECN_ECT0;
+        (void)setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+#ifdef IPV6_TCLASS
+        (void)setsockopt(fd, IPPROTO_IPV6, IPV6_TCLASS, &tos, sizeof(tos));
+#endif
+    }
+    (void)on;
+}
+
+quicpro_udp_rx_batch_t *quicpro_session_rx_batch(quicpro_session_t *s)
+{
+    if (!s->rx_batch) {
+        zend_long n         = quicpro_bare_metal_config.io_max_batch_read_packets;
+        unsigned  capacity  = n > 0 ? (unsigned)n : 1;
+        size_t    slot_size = quicpro_udp_rx_slot_size(0);
+
+#ifdef __linux__
+        int on = 1;
+        if (setsockopt(s->sock, SOL_UDP, UDP_GRO, &on, sizeof(on)) == 0) {
+            s->gro_enabled = true;
+            slot_size      = QUICPRO_UDP_GRO_SLOT_SIZE;
+            if (capacity > QUICPRO_UDP_GRO_MAX_SLOTS) {
+                capacity = QUICPRO_UDP_GRO_MAX_SLOTS;
+            }
+        }
+#endif
+
+        s->rx_batch = quicpro_udp_rx_batch_new(capacity, slot_size);
+    }
+    return s->rx_batch;
+}
+
+/*
+ * The kernel rewrites msg_namelen, msg_controllen and msg_flags on every
+ * call, so each slot header must be re-armed before the next receive.
+ */
+static inline void quicpro_udp_rx_rearm(quicpro_udp_rx_batch_t *b, unsigned count)
+{
+    for (unsigned i = 0; i < count; i++) {
+        struct msghdr *h = &b->msgs[i].msg_hdr;
+        h->msg_name       = &b->from[i];
+        h->msg_namelen    = sizeof(b->from[i]);
+        h->msg_iov        = &b->iov[i];
+        h->msg_iovlen     = 1;
+        h->msg_control    = b->cmsg[i];
+        h->msg_controllen = sizeof(b->cmsg[i]);
+        h->msg_flags      = 0;
+        b->msgs[i].msg_len = 0;
+    }
+}
+
+/*────────────────────────────── Receive ──────────────────────────────────*/
+
+int quicpro_udp_recv_batch(int fd, quicpro_udp_rx_batch_t *b)
+{
+    quicpro_udp_rx_rearm(b, b->capacity);
+
+#ifdef __linux__
+    uint64_t prof = quicpro_prof_begin();
+    int n = recvmmsg(fd, b->msgs, b->capacity, MSG_DONTWAIT, NULL);
+    quicpro_prof_end(QUICPRO_PROF_RECV, prof);
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    return n;
+#else
+    unsigned n = 0;
+    while (n < b->capacity) {
+        ssize_t len = recvmsg(fd, &b->msgs[n].msg_hdr, MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            /* Report packets already received; the error resurfaces next call. */
+            return n > 0 ? (int)n : -1;
+        }
+        b->msgs[n].msg_len = (unsigned int)len;
+        n++;
+    }
+    return (int)n;
+#endif
+}
+
+size_t quicpro_udp_rx_slot_segment_size(quicpro_udp_rx_batch_t *b, unsigned i)
+{
+    size_t len = quicpro_udp_rx_slot_len(b, i);
+
+#ifdef __linux__
+    struct msghdr *h = &b->msgs[i].msg_hdr;
+
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(h); cm; cm = CMSG_NXTHDR(h, cm)) {
+        if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+            int seg;
+            memcpy(&seg, CMSG_DATA(cm), sizeof(seg));
+            if (seg > 0 && (size_t)seg < len) {
+                return (size_t)seg;
+            }
+            break;
+        }
+    }
+#endif
+    return len;
+}
+
+int quicpro_udp_rx_deliver(quiche_conn *conn, quicpro_udp_rx_batch_t *b, int n,
+                           struct timespec *last_rx_ts, ssize_t *last_error)
+{
+    int delivered = 0;
+
+    if (last_error) {
+        *last_error = 0;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (quicpro_udp_rx_slot_truncated(b, i)) {
+            /* Oversized datagram; quiche would reject it anyway */
+            continue;
+        }
+
+        uint8_t *data = quicpro_udp_rx_slot_data(b, i);
+        size_t   len  = quicpro_udp_rx_slot_len(b, i);
+        size_t   seg  = quicpro_udp_rx_slot_segment_size(b, i);
+        int      first = delivered;
+
+        quiche_recv_info ri = {
+            .from     = (struct sockaddr *)&b->from[i],
+            .from_len = b->msgs[i].msg_hdr.msg_namelen,
+            .to       = NULL,
+            .to_len   = 0
+        };
+
+        /* All GRO segments come from one flow; only the last may be short */
+        for (size_t off = 0; off < len; off += seg) {
+            size_t  chunk = (len - off < seg) ? len - off : seg;
+            uint64_t prof  = quicpro_prof_begin();
+            ssize_t rc    = quiche_conn_recv(conn, data + off, chunk, &ri);
+            quicpro_prof_end(QUICPRO_PROF_CONN_RECV, prof);
+            if (rc < 0 && rc != QUICHE_ERR_DONE && last_error) {
+                *last_error = rc;
+            }
+            delivered++;
+        }
+
+        if (last_rx_ts) {
+            quicpro_udp_rx_slot_timestamp(b, i, last_rx_ts);
+        }
+        /* A GRO run only merges datagrams with the same TOS byte */
+        b->ecn_rx[quicpro_udp_rx_slot_ecn(b, i)] += (uint64_t)(delivered - first);
+    }
+
+    return delivered;
+}
+
+bool quicpro_udp_rx_slot_timestamp(quicpro_udp_rx_batch_t *b, unsigned i, struct timespec *out)
+{
+#ifdef SO_TIMESTAMPING_NEW
+    struct msghdr *h = &b->msgs[i].msg_hdr;
+
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(h); cm; cm = CMSG_NXTHDR(h, cm)) {
+        if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_TIMESTAMPING_NEW) {
+            memcpy(out, CMSG_DATA(cm), sizeof(*out));
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+int quicpro_udp_cmsg_ecn(const struct cmsghdr *cm)
+{
+    if (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_TOS) {
+        /* One byte here, although IP_TOS itself is set as an int */
+        return *(const uint8_t *)CMSG_DATA(cm) & QUICPRO_ECN_MASK;
+    }
+#ifdef IPV6_TCLASS
+    if (cm->cmsg_level == IPPROTO_IPV6 && cm->cmsg_type == IPV6_TCLASS) {
+        int v;
+        memcpy(&v, CMSG_DATA(cm), sizeof(v));
+        return v & QUICPRO_ECN_MASK;
+    }
+#endif
+    return -1;
+}
+
+unsigned quicpro_udp_rx_slot_ecn(quicpro_udp_rx_batch_t *b, unsigned i)
+{
+    if (!quicpro_quic_transport_config.ecn_enable) {
+        return QUICPRO_ECN_NOT_ECT;
+    }
+    struct msghdr *h = &b->msgs[i].msg_hdr;
+
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(h); cm; cm = CMSG_NXTHDR(h, cm)) {
+        int ecn = quicpro_udp_cmsg_ecn(cm);
+        if (ecn >= 0) {
+            return (unsigned)ecn;
+        }
+    }
+    return QUICPRO_ECN_NOT_ECT;
+}
+
+/*────────────────────────────── Drain ────────────────────────────────────*/
+
+typedef struct {
+    uint64_t key;
+    unsigned slot;
+} quicpro_udp_drain_ent_t;
+
+/* FNV-1a over the DCID; 0 for datagrams without a parseable header. */
+static uint64_t quicpro_udp_dcid_key(const uint8_t *p, size_t len)
+{
+    const uint8_t *dcid;
+    size_t dcid_len;
+
+    if (len < 1) {
+        return 0;
+    }
+    if (p[0] & 0x80) {
+        if (len < 6 || len < 6u + p[5]) {
+            return 0;
+        }
+        dcid     = p + 6;
+        dcid_len = p[5];
+    } else {
+        if (len < 1u + QUICHE_MAX_CONN_ID_LEN) {
+            return 0;
+        }
+        dcid     = p + 1;
+        dcid_len = QUICHE_MAX_CONN_ID_LEN;
+    }
+
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < dcid_len; i++) {
+        h = (h ^ dcid[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+static int quicpro_udp_drain_cmp(const void *a, const void *b)
+{
+    const quicpro_udp_drain_ent_t *x = a, *y = b;
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return x->slot < y->slot ? -1 : (x->slot > y->slot);
+}
+
+int quicpro_udp_drain(int fd, quicpro_udp_rx_batch_t *b, unsigned budget,
+                      quicpro_udp_dgram_cb cb, void *ctx)
+{
+    quicpro_udp_drain_ent_t order[QUICPRO_UDP_BATCH_MAX];
+    unsigned total = 0;
+
+    while (total < budget) {
+        int n = quicpro_udp_recv_batch(fd, b);
+        if (n < 0) {
+            return total > 0 ? (int)total : -1;
+        }
+        if (n == 0) {
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            order[i].key  = quicpro_udp_dcid_key(quicpro_udp_rx_slot_data(b, i), quicpro_udp_rx_slot_len(b, i));
+            order[i].slot = (unsigned)i;
+        }
+        if (n > 1) {
+            qsort(order, (size_t)n, sizeof(order[0]), quicpro_udp_drain_cmp);
+        }
+
+        for (int i = 0; i < n; i++) {
+            unsigned slot = order[i].slot;
+            if (quicpro_udp_rx_slot_truncated(b, slot)) {
+                continue;
+            }
+            struct timespec ts;
+            bool has_ts = quicpro_udp_rx_slot_timestamp(b, slot, &ts);
+            unsigned ecn = quicpro_udp_rx_slot_ecn(b, slot);
+            b->ecn_rx[ecn]++;
+            if (ecn == QUICPRO_ECN_CE) {
+                QUICPRO_WORKER_STAT(ecn_ce);
+            }
+            cb(ctx, quicpro_udp_rx_slot_data(b, slot), quicpro_udp_rx_slot_len(b, slot),
+               (const struct sockaddr *)&b->from[slot], b->msgs[slot].msg_hdr.msg_namelen,
+               has_ts ? &ts : NULL);
+        }
+
+        total += (unsigned)n;
+        if ((unsigned)n < b->capacity) {
+            break;          /* Short read: the queue is empty */
+        }
+    }
+    return (int)total;
+}
+
+/*──────────────────────────── Transmit ───────────────────────────────────*/
+
+quicpro_udp_tx_batch_t *quicpro_udp_tx_batch_new(unsigned capacity, size_t slot_size)
+{
+    if (capacity == 0) {
+        capacity = 1;
+    } else if (capacity > QUICPRO_UDP_BATCH_MAX) {
+        capacity = QUICPRO_UDP_BATCH_MAX;
+    }
+
+    quicpro_udp_tx_batch_t *b = ecalloc(1, sizeof(*b));
+    b->capacity  = capacity;
+    b->slot_size = slot_size;
+    b->count     = 0;
+    b->payload   = safe_emalloc(capacity, slot_size, 0);
+    b->len       = ecalloc(capacity, sizeof(*b->len));
+    b->to        = ecalloc(capacity, sizeof(*b->to));
+    b->to_len    = ecalloc(capacity, sizeof(*b->to_len));
+    b->at_ns     = ecalloc(capacity, sizeof(*b->at_ns));
+    b->msgs      = ecalloc(capacity, sizeof(*b->msgs));
+    b->iov       = ecalloc(capacity, sizeof(*b->iov));
+    b->cmsg      = ecalloc(capacity, sizeof(*b->cmsg));
+    b->pacing    = QUICPRO_PACE_OFF;
+    b->max_burst = QUICPRO_UDP_GSO_MAX_SEGMENTS;
+
+    return b;
+}
+
+void quicpro_udp_tx_batch_free(quicpro_udp_tx_batch_t *b)
+{
+    if (!b) {
+        return;
+    }
+    efree(b->cmsg);
+    efree(b->iov);
+    efree(b->msgs);
+    efree(b->at_ns);
+    efree(b->to_len);
+    efree(b->to);
+    efree(b->len);
+    efree(b->payload);
+    efree(b);
+}
+
+static inline uint64_t quicpro_udp_mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Chooses the pacing mode of a new batch and prepares the socket for it. */
+static void quicpro_udp_tx_batch_pacing_init(quicpro_session_t *s, quicpro_udp_tx_batch_t *b)
+{
+    if (!quicpro_quic_transport_config.pacing_enable) {
+        b->pacing = QUICPRO_PACE_OFF;
+        return;
+    }
+
+    zend_long burst = quicpro_quic_transport_config.pacing_max_burst_packets;
+    b->max_burst = burst > 0 && burst < QUICPRO_UDP_GSO_MAX_SEGMENTS
+                 ? (unsigned)burst : QUICPRO_UDP_GSO_MAX_SEGMENTS;
+    b->pacing = QUICPRO_PACE_USERSPACE;
+
+#ifdef __linux__
+    if (quicpro_bare_metal_config.socket_enable_txtime) {
+        /* quiche's `at` is CLOCK_MONOTONIC; fq and etf both accept it */
+        struct sock_txtime cfg = { .clockid = CLOCK_MONOTONIC, .flags = 0 };
+        if (setsockopt(s->sock, SOL_SOCKET, SO_TXTIME, &cfg, sizeof(cfg)) == 0) {
+            b->pacing = QUICPRO_PACE_TXTIME;
+        }
+    }
+#else
+    (void)s;
+#endif
+}
+
+quicpro_udp_tx_batch_t *quicpro_session_tx_batch(quicpro_session_t *s)
+{
+    /* Slots as large as the packets quiche may build now; DPLPMTUD raises that */
+    size_t want = s->conn ? quiche_conn_max_send_udp_payload_size(s->conn) : 0;
+    want = MIN(MAX(want, QUICPRO_MAX_PACKET_SIZE), QUICPRO_UDP_PAYLOAD_MAX);
+
+    if (s->tx_batch && s->tx_batch->count == 0 && s->tx_batch->slot_size < want) {
+        quicpro_udp_tx_batch_t *old = s->tx_batch;
+        s->tx_batch = quicpro_udp_tx_batch_new(old->capacity, want);
+        s->tx_batch->pacing    = old->pacing;
+        s->tx_batch->max_burst = old->max_burst;
+        quicpro_udp_tx_batch_free(old);
+    }
+    if (!s->tx_batch) {
+        zend_long n = quicpro_bare_metal_config.io_max_batch_write_packets;
+        s->tx_batch = quicpro_udp_tx_batch_new(n > 0 ? (unsigned)n : 1, want);
+        quicpro_udp_tx_batch_pacing_init(s, s->tx_batch);
+    }
+
+    if (s->gso_state == QUICPRO_GSO_UNKNOWN) {
+#ifdef __linux__
+        /* Kernels without UDP GSO (< 4.18) reject the option outright. */
+        int       seg = 0;
+        socklen_t len = sizeof(seg);
+        s->gso_state = getsockopt(s->sock, SOL_UDP, UDP_SEGMENT, &seg, &len) == 0
+                     ? QUICPRO_GSO_SUPPORTED
+                     : QUICPRO_GSO_UNSUPPORTED;
+#else
+        s->gso_state = QUICPRO_GSO_UNSUPPORTED;
+#endif
+    }
+
+    return s->tx_batch;
+}
+
+int quicpro_udp_tx_batch_fill(quiche_conn *conn, quicpro_udp_tx_batch_t *b)
+{
+    while (b->count < b->capacity) {
+        unsigned         i    = b->count;
+        uint8_t         *slot = b->payload + (size_t)i * b->slot_size;
+        quiche_send_info si;
+
+        ssize_t n = quiche_conn_send(conn, slot, b->slot_size, &si);
+        if (n == QUICHE_ERR_DONE) {
+            break;
+        }
+        if (n < 0) {
+            /* Never leave a half-built burst behind for the next caller */
+            b->count = 0;
+            return (int)n;
+        }
+
+        b->len[i]    = (size_t)n;
+        b->to_len[i] = si.to_len;
+        memcpy(&b->to[i], &si.to, si.to_len);
+        b->at_ns[i]  = b->pacing == QUICPRO_PACE_OFF ? 0
+                     : (uint64_t)si.at.tv_sec * 1000000000ull + (uint64_t)si.at.tv_nsec;
+        b->count++;
+    }
+
+    return (int)b->count;
+}
+
+#ifdef __linux__
+
+static inline bool quicpro_udp_tx_same_dest(const quicpro_udp_tx_batch_t *b, unsigned i, unsigned j)
+{
+    return b->to_len[i] == b->to_len[j]
+        && memcmp(&b->to[i], &b->to[j], b->to_len[i]) == 0;
+}
+
+/*
+ * Builds the sendmmsg() vector for packets [first, end). Each message
+ * carries one packet, or with GSO a run of packets sharing destination and
+ * segment size; msg_iovlen therefore equals the number of packets in it.
+ * While pacing, runs are capped at `max_burst` and, in TXTIME mode, carry
+ * the release time of their first packet.
+ */
+static unsigned quicpro_udp_tx_build(quicpro_udp_tx_batch_t *b, unsigned first, unsigned end, bool gso)
+{
+    unsigned nmsg      = 0;
+    unsigned i         = first;
+    unsigned run_limit = b->pacing == QUICPRO_PACE_OFF ? QUICPRO_UDP_GSO_MAX_SEGMENTS : b->max_burst;
+
+    while (i < end) {
+        struct msghdr *h   = &b->msgs[nmsg].msg_hdr;
+        size_t         seg = b->len[i];
+        size_t         total = seg;
+        unsigned       run = 1;
+
+        b->iov[i].iov_base = b->payload + (size_t)i * b->slot_size;
+        b->iov[i].iov_len  = seg;
+
+        if (gso) {
+            while (i + run < end && run < run_limit) {
+                unsigned j = i + run;
+                if (b->len[j] > seg
+                    || total + b->len[j] > QUICPRO_UDP_GSO_MAX_BYTES
+                    || !quicpro_udp_tx_same_dest(b, i, j)) {
+                    break;
+                }
+                b->iov[j].iov_base = b->payload + (size_t)j * b->slot_size;
+                b->iov[j].iov_len  = b->len[j];
+                total += b->len[j];
+                run++;
+                if (b->len[j] < seg) {
+                    /* A short segment may only terminate a GSO run */
+                    break;
+                }
+            }
+        }
+
+        memset(h, 0, sizeof(*h));
+        h->msg_name    = &b->to[i];
+        h->msg_namelen = b->to_len[i];
+        h->msg_iov     = &b->iov[i];
+        h->msg_iovlen  = run;
+
+        bool txtime = b->pacing == QUICPRO_PACE_TXTIME && b->at_ns[i] != 0;
+        if (run > 1 || txtime) {
+            h->msg_control    = b->cmsg[nmsg];
+            h->msg_controllen = (run > 1 ? CMSG_SPACE(sizeof(uint16_t)) : 0)
+                              + (txtime ? CMSG_SPACE(sizeof(uint64_t)) : 0);
+            memset(b->cmsg[nmsg], 0, h->msg_controllen);
+
+            struct cmsghdr *cm = CMSG_FIRSTHDR(h);
+            if (run > 1) {
+                cm->cmsg_level = SOL_UDP;
+                cm->cmsg_type  = UDP_SEGMENT;
+                cm->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+                uint16_t gso_size = (uint16_t)seg;
+                memcpy(CMSG_DATA(cm), &gso_size, sizeof(gso_size));
+                cm = CMSG_NXTHDR(h, cm);
+            }
+            if (txtime) {
+                cm->cmsg_level = SOL_SOCKET;
+                cm->cmsg_type  = SCM_TXTIME;
+                cm->cmsg_len   = CMSG_LEN(sizeof(uint64_t));
+                memcpy(CMSG_DATA(cm), &b->at_ns[i], sizeof(uint64_t));
+            }
+        }
+
+        b->msgs[nmsg].msg_len = 0;
+        nmsg++;
+        i += run;
+    }
+
+    return nmsg;
+}
+
+#endif /* __linux__ */
+
+/* Number of leading staged packets the userspace pacer may send now. */
+static unsigned quicpro_udp_tx_due(const quicpro_udp_tx_batch_t *b)
+{
+    if (b->pacing != QUICPRO_PACE_USERSPACE) {
+        return b->count;
+    }
+    uint64_t limit = quicpro_udp_mono_ns() + QUICPRO_PACE_HORIZON_NS;
+    unsigned due   = 0;
+    while (due < b->count && b->at_ns[due] <= limit) {
+        due++;
+    }
+    return due;
+}
+
+/* Drops the first `n` staged packets, moving held ones to the front. */
+static void quicpro_udp_tx_consume(quicpro_udp_tx_batch_t *b, unsigned n)
+{
+    unsigned rest = n < b->count ? b->count - n : 0;
+    if (rest > 0 && n > 0) {
+        memmove(b->payload, b->payload + (size_t)n * b->slot_size, (size_t)rest * b->slot_size);
+        memmove(b->len,    b->len + n,    rest * sizeof(*b->len));
+        memmove(b->to,     b->to + n,     rest * sizeof(*b->to));
+        memmove(b->to_len, b->to_len + n, rest * sizeof(*b->to_len));
+        memmove(b->at_ns,  b->at_ns + n,  rest * sizeof(*b->at_ns));
+    }
+    b->count = rest;
+}
+
+uint64_t quicpro_udp_tx_pacing_delay_ns(const quicpro_udp_tx_batch_t *b)
+{
+    if (!b || b->pacing != QUICPRO_PACE_USERSPACE || b->count == 0) {
+        return UINT64_MAX;
+    }
+    uint64_t now = quicpro_udp_mono_ns();
+    return b->at_ns[0] > now ? b->at_ns[0] - now : 0;
+}
+
+int quicpro_udp_send_batch(int fd, quicpro_udp_tx_batch_t *b, int *gso_state)
+{
+    int packets = 0;
+
+    b->last_msgs = 0;
+    if (b->count == 0) {
+        return 0;
+    }
+
+    /* Packets not yet due (userspace pacer) stay staged for the next send */
+    unsigned due = quicpro_udp_tx_due(b);
+    if (due == 0) {
+        return 0;
+    }
+
+#ifdef __linux__
+    bool     gso  = (*gso_state == QUICPRO_GSO_SUPPORTED);
+    unsigned nmsg = quicpro_udp_tx_build(b, 0, due, gso);
+    unsigned done = 0;
+
+    while (done < nmsg) {
+        uint64_t prof = quicpro_prof_begin();
+        int r = sendmmsg(fd, &b->msgs[done], nmsg - done, MSG_DONTWAIT);
+        quicpro_prof_end(QUICPRO_PROF_SEND, prof);
+        if (r < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (errno == EIO && gso) {
+                /* The rejected message was still built, and numbered, by the kernel */
+                b->last_msgs++;
+                /* Egress device cannot segment; resend the rest one by one */
+                *gso_state = QUICPRO_GSO_UNSUPPORTED;
+                gso  = false;
+                nmsg = quicpro_udp_tx_build(b, (unsigned)packets, due, false);
+                done = 0;
+                continue;
+            }
+            if (errno == EMSGSIZE) {
+                /* A path MTU probe above the device MTU: lost, as far as quiche knows */
+                packets += (int)b->msgs[done].msg_hdr.msg_iovlen;
+                done++;
+                continue;
+            }
+            b->count = 0;
+            return -1;
+        }
+        for (int k = 0; k < r; k++) {
+            packets += (int)b->msgs[done + k].msg_hdr.msg_iovlen;
+        }
+        done += (unsigned)r;
+        b->last_msgs += (unsigned)r;
+    }
+#else
+    (void)gso_state;
+    for (unsigned i = 0; i < due; i++) {
+        ssize_t sent = sendto(fd, b->payload + (size_t)i * b->slot_size, b->len[i], 0,
+                              (const struct sockaddr *)&b->to[i], b->to_len[i]);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (errno == EMSGSIZE) {
+                continue;   /* See above */
+            }
+            b->count = 0;
+            return -1;
+        }
+        packets++;
+        b->last_msgs++;
+    }
+#endif
+
+    /* Due packets the socket refused (EAGAIN) are dropped as before */
+    quicpro_udp_tx_consume(b, due);
+    return packets;
+}
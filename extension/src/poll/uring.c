@@ -0,0 +1,498 @@
+/*
+ * uring.c  –  io_uring UDP engine for php-quicpro
+ * -----------------------------------------------
+ *
+ * Steady-state QUIC I/O without system calls:
+ *
+ *   • Receive: one multishot IORING_OP_RECVMSG is armed per socket. Every
+ *     datagram completes into a buffer taken from a provided-buffer ring
+ *     registered with the kernel (buffer group QUICPRO_URING_BGID). The
+ *     completion carries the io_uring_recvmsg_out header, source address,
+ *     cmsgs (SO_TIMESTAMPING_NEW, UDP_GRO, IP_TOS) and payload back to back.
+ *   • Transmit: quiche_conn_send() writes directly into TX slots owned by
+ *     the engine; each filled slot is queued as IORING_OP_SENDMSG with the
+ *     slot index as user_data and returns to the free list on completion.
+ *   • The socket is a registered (fixed) file, saving the fd lookup per op.
+ *   • With quicpro.io_uring_sq_poll_ms > 0 the ring is created with
+ *     IORING_SETUP_SQPOLL; io_uring_submit() then only enters the kernel
+ *     to wake an idle SQ thread.
+ *
+ * Requirements: liburing >= 2.4 and Linux >= 6.0 (multishot recvmsg,
+ * provided-buffer rings). Anything older makes quicpro_uring_new() return
+ * NULL, or the first receive completion fail with -EINVAL, after which
+ * quicpro_uring_session_recv() retires the engine and the caller stays on
+ * the recvmmsg()/sendmmsg() path.
+ */
+
+#include "php_quicpro.h"
+#include "poll/uring.h"
+#include "cluster/cluster_stats.h"
+#include "poll/udp_batch.h"
+#include "config/bare_metal_tuning/base_layer.h"
+#include "config/quic_transport/base_layer.h"
+#include "server/profiler.h"
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef QUICPRO_HAVE_LIBURING
+
+#include <liburing.h>
+#include <netinet/udp.h>
+
+#ifndef SOL_UDP
+# define SOL_UDP 17
+#endif
+#ifndef UDP_GRO
+# define UDP_GRO 104
+#endif
+
+#define QUICPRO_URING_BGID        0
+#define QUICPRO_URING_RX_UD       UINT64_MAX
+#define QUICPRO_URING_MIN_BUFS    64
+#define QUICPRO_URING_MAX_BUFS    4096
+
+struct quicpro_uring_s {
+    struct io_uring           ring;
+    bool                      rx_armed;
+    bool                      gro;
+
+    /* --- Receive: provided-buffer ring --- */
+    struct io_uring_buf_ring *br;
+    uint8_t                  *rx_bufs;
+    unsigned                  rx_nbufs;
+    size_t                    rx_buf_size;
+    struct msghdr             rx_msg;       /* Layout template for multishot. */
+
+    /* --- Transmit: slot pool --- */
+    unsigned                  tx_nslots;
+    size_t                    tx_slot_size;
+    uint8_t                  *tx_bufs;
+    struct msghdr            *tx_msg;
+    struct iovec             *tx_iov;
+    struct sockaddr_storage  *tx_to;
+    unsigned                 *tx_free;
+    unsigned                  tx_free_count;
+};
+
+/*─────────────────────────────── Helpers ─────────────────────────────────*/
+
+static unsigned quicpro_uring_pow2(unsigned v)
+{
+    unsigned p = 1;
+    while (p < v) {
+        p <<= 1;
+    }
+    return p;
+}
+
+static void quicpro_uring_arm_rx(quicpro_uring_t *u)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&u->ring);
+    if (!sqe) {
+        io_uring_submit(&u->ring);
+        sqe = io_uring_get_sqe(&u->ring);
+        if (!sqe) {
+            return;
+        }
+    }
+
+    io_uring_prep_recvmsg_multishot(sqe, 0, &u->rx_msg, 0);
+    sqe->flags    |= IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+    sqe->buf_group = QUICPRO_URING_BGID;
+    io_uring_sqe_set_data64(sqe, QUICPRO_URING_RX_UD);
+    u->rx_armed = true;
+}
+
+static inline void quicpro_uring_recycle_rx(quicpro_uring_t *u, unsigned bid)
+{
+    io_uring_buf_ring_add(u->br, u->rx_bufs + (size_t)bid * u->rx_buf_size,
+                          (unsigned)u->rx_buf_size, (unsigned short)bid,
+                          io_uring_buf_ring_mask(u->rx_nbufs), 0);
+    io_uring_buf_ring_advance(u->br, 1);
+}
+
+/*──────────────────────────── Setup / Teardown ───────────────────────────*/
+
+quicpro_uring_t *quicpro_uring_new(int fd)
+{
+    zend_long rd = quicpro_bare_metal_config.io_max_batch_read_packets;
+    zend_long wr = quicpro_bare_metal_config.io_max_batch_write_packets;
+    zend_long sq = quicpro_bare_metal_config.io_uring_sq_poll_ms;
+
+    quicpro_uring_t *u = ecalloc(1, sizeof(*u));
+
+    /* Keep several batches in flight in each direction */
+    unsigned rx_n = quicpro_uring_pow2((unsigned)(rd > 0 ? rd * 4 : QUICPRO_URING_MIN_BUFS));
+    unsigned tx_n = (unsigned)(wr > 0 ? wr * 2 : QUICPRO_URING_MIN_BUFS);
+    if (rx_n < QUICPRO_URING_MIN_BUFS) rx_n = QUICPRO_URING_MIN_BUFS;
+    if (rx_n > QUICPRO_URING_MAX_BUFS) rx_n = QUICPRO_URING_MAX_BUFS;
+    if (tx_n > QUICPRO_URING_MAX_BUFS) tx_n = QUICPRO_URING_MAX_BUFS;
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags      = IORING_SETUP_CQSIZE;
+    p.cq_entries = quicpro_uring_pow2(rx_n + tx_n) * 2;
+    if (sq > 0) {
+        p.flags         |= IORING_SETUP_SQPOLL;
+        p.sq_thread_idle = (unsigned)sq;
+    }
+
+    unsigned entries = quicpro_uring_pow2(tx_n + 1);
+    int ret = io_uring_queue_init_params(entries, &u->ring, &p);
+    if (ret < 0 && (p.flags & IORING_SETUP_SQPOLL)) {
+        /* SQPOLL may need privileges on older kernels; run without it */
+        memset(&p, 0, sizeof(p));
+        p.flags      = IORING_SETUP_CQSIZE;
+        p.cq_entries = quicpro_uring_pow2(rx_n + tx_n) * 2;
+        ret = io_uring_queue_init_params(entries, &u->ring, &p);
+    }
+    if (ret < 0) {
+        efree(u);
+        return NULL;
+    }
+
+    if (io_uring_register_files(&u->ring, &fd, 1) < 0) {
+        io_uring_queue_exit(&u->ring);
+        efree(u);
+        return NULL;
+    }
+
+    /* GRO: let one completion carry a whole coalesced train */
+    size_t payload = quicpro_udp_rx_slot_size(0);
+    int on = 1;
+    if (setsockopt(fd, SOL_UDP, UDP_GRO, &on, sizeof(on)) == 0) {
+        u->gro  = true;
+        payload = QUICPRO_UDP_GRO_SLOT_SIZE;
+        if (rx_n > QUICPRO_URING_MIN_BUFS) {
+            rx_n = QUICPRO_URING_MIN_BUFS;
+        }
+    }
+
+    u->rx_msg.msg_namelen    = sizeof(struct sockaddr_storage);
+    u->rx_msg.msg_controllen = QUICPRO_UDP_CMSG_SPACE;
+    u->rx_nbufs    = rx_n;
+    u->rx_buf_size = sizeof(struct io_uring_recvmsg_out)
+                   + u->rx_msg.msg_namelen
+                   + u->rx_msg.msg_controllen
+                   + payload;
+    u->rx_bufs     = safe_emalloc(rx_n, u->rx_buf_size, 0);
+
+    u->br = io_uring_setup_buf_ring(&u->ring, rx_n, QUICPRO_URING_BGID, 0, &ret);
+    if (!u->br) {
+        efree(u->rx_bufs);
+        io_uring_queue_exit(&u->ring);
+        efree(u);
+        return NULL;
+    }
+    for (unsigned i = 0; i < rx_n; i++) {
+        io_uring_buf_ring_add(u->br, u->rx_bufs + (size_t)i * u->rx_buf_size,
+                              (unsigned)u->rx_buf_size, (unsigned short)i,
+                              io_uring_buf_ring_mask(rx_n), (int)i);
+    }
+    io_uring_buf_ring_advance(u->br, (int)rx_n);
+
+    u->tx_nslots     = tx_n;
+    /* Registered once: sized for the largest packet DPLPMTUD may settle on */
+    u->tx_slot_size  = (size_t)MAX(quicpro_quic_transport_config.max_send_udp_payload_size, QUICPRO_MAX_PACKET_SIZE);
+    u->tx_bufs       = safe_emalloc(tx_n, u->tx_slot_size, 0);
+    u->tx_msg        = ecalloc(tx_n, sizeof(*u->tx_msg));
+    u->tx_iov        = ecalloc(tx_n, sizeof(*u->tx_iov));
+    u->tx_to         = ecalloc(tx_n, sizeof(*u->tx_to));
+    u->tx_free       = safe_emalloc(tx_n, sizeof(*u->tx_free), 0);
+    u->tx_free_count = tx_n;
+    for (unsigned i = 0; i < tx_n; i++) {
+        u->tx_free[i] = tx_n - 1 - i;
+    }
+
+    quicpro_uring_arm_rx(u);
+    io_uring_submit(&u->ring);
+
+    return u;
+}
+
+void quicpro_uring_free(quicpro_uring_t *u)
+{
+    if (!u) {
+        return;
+    }
+    io_uring_free_buf_ring(&u->ring, u->br, u->rx_nbufs, QUICPRO_URING_BGID);
+    io_uring_queue_exit(&u->ring);
+    efree(u->rx_bufs);
+    efree(u->tx_bufs);
+    efree(u->tx_msg);
+    efree(u->tx_iov);
+    efree(u->tx_to);
+    efree(u->tx_free);
+    efree(u);
+}
+
+/*──────────────────────────────── Receive ────────────────────────────────*/
+
+static int quicpro_uring_dispatch_rx(quicpro_uring_t *u, uint8_t *buf, int res,
+                                     quicpro_uring_rx_cb cb, void *ctx)
+{
+    struct io_uring_recvmsg_out *o = io_uring_recvmsg_validate(buf, res, &u->rx_msg);
+    if (!o || (o->flags & MSG_TRUNC)) {
+        return 0;
+    }
+
+    struct timespec  ts;
+    bool             have_ts = false;
+    size_t           seg     = 0;
+
+    for (struct cmsghdr *cm = io_uring_recvmsg_cmsg_firsthdr(o, &u->rx_msg); cm;
+         cm = io_uring_recvmsg_cmsg_nexthdr(o, &u->rx_msg, cm)) {
+        if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_TIMESTAMPING_NEW) {
+            memcpy(&ts, CMSG_DATA(cm), sizeof(ts));
+            have_ts = true;
+        } else if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+            int v;
+            memcpy(&v, CMSG_DATA(cm), sizeof(v));
+            seg = v > 0 ? (size_t)v : 0;
+        } else if (quicpro_udp_cmsg_ecn(cm) == QUICPRO_ECN_CE) {
+            QUICPRO_WORKER_STAT(ecn_ce);
+        }
+    }
+
+    uint8_t  *data     = io_uring_recvmsg_payload(o, &u->rx_msg);
+    size_t    len      = io_uring_recvmsg_payload_length(o, res, &u->rx_msg);
+    socklen_t from_len = o->namelen < u->rx_msg.msg_namelen ? o->namelen : u->rx_msg.msg_namelen;
+    const struct sockaddr *from = io_uring_recvmsg_name(o);
+    int delivered = 0;
+
+    if (seg == 0 || seg >= len) {
+        seg = len;
+    }
+    for (size_t off = 0; off < len; off += seg) {
+        size_t chunk = (len - off < seg) ? len - off : seg;
+        cb(ctx, data + off, chunk, from, from_len, have_ts ? &ts : NULL);
+        delivered++;
+    }
+
+    return delivered;
+}
+
+int quicpro_uring_reap(quicpro_uring_t *u, quicpro_uring_rx_cb cb, void *ctx)
+{
+    struct io_uring_cqe *cqe;
+    unsigned head;
+    unsigned seen      = 0;
+    int      delivered = 0;
+    int      err       = 0;
+
+    io_uring_for_each_cqe(&u->ring, head, cqe) {
+        seen++;
+
+        if (cqe->user_data == QUICPRO_URING_RX_UD) {
+            if (!(cqe->flags & IORING_CQE_F_MORE)) {
+                u->rx_armed = false;
+            }
+            if (cqe->res < 0) {
+                /* -ENOBUFS: ring ran dry; buffers come back below, re-arm */
+                if (cqe->res != -ENOBUFS) {
+                    err = -cqe->res;
+                }
+                continue;
+            }
+            if (cqe->flags & IORING_CQE_F_BUFFER) {
+                unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+                delivered += quicpro_uring_dispatch_rx(u, u->rx_bufs + (size_t)bid * u->rx_buf_size,
+                                                        cqe->res, cb, ctx);
+                quicpro_uring_recycle_rx(u, bid);
+            }
+        } else {
+            /* TX completion: the slot can be reused */
+            unsigned slot = (unsigned)cqe->user_data;
+            if (slot < u->tx_nslots) {
+                u->tx_free[u->tx_free_count++] = slot;
+            }
+            /* Send errors are loss from quiche's point of view; recovery retransmits */
+        }
+    }
+    io_uring_cq_advance(&u->ring, seen);
+
+    if (!u->rx_armed && err == 0) {
+        quicpro_uring_arm_rx(u);
+        io_uring_submit(&u->ring);
+    }
+
+    if (err != 0) {
+        errno = err;
+        return delivered > 0 ? delivered : -1;
+    }
+    return delivered;
+}
+
+int quicpro_uring_wait(quicpro_uring_t *u, int timeout_ms)
+{
+    struct io_uring_cqe *cqe;
+    struct __kernel_timespec ts = {
+        .tv_sec  = timeout_ms / 1000,
+        .tv_nsec = (long long)(timeout_ms % 1000) * 1000000LL,
+    };
+
+    quicpro_worker_wait_begin();
+    int ret = io_uring_wait_cqe_timeout(&u->ring, &cqe, timeout_ms >= 0 ? &ts : NULL);
+    quicpro_worker_wait_end((int)io_uring_cq_ready(&u->ring));
+    if (ret < 0 && ret != -ETIME && ret != -EINTR) {
+        errno = -ret;
+        return -1;
+    }
+    return 0;
+}
+
+int quicpro_uring_fd(quicpro_uring_t *u)
+{
+    return u->ring.ring_fd;
+}
+
+/*──────────────────────────────── Transmit ───────────────────────────────*/
+
+int quicpro_uring_flush_quiche(quicpro_uring_t *u, quiche_conn *conn)
+{
+    int queued = 0;
+
+    while (u->tx_free_count > 0) {
+        unsigned         slot = u->tx_free[u->tx_free_count - 1];
+        uint8_t         *buf  = u->tx_bufs + (size_t)slot * u->tx_slot_size;
+        quiche_send_info si;
+
+        ssize_t n = quiche_conn_send(conn, buf, u->tx_slot_size, &si);
+        if (n == QUICHE_ERR_DONE) {
+            break;
+        }
+        if (n < 0) {
+            if (queued > 0) {
+                io_uring_submit(&u->ring);
+            }
+            return (int)n;
+        }
+
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&u->ring);
+        if (!sqe) {
+            io_uring_submit(&u->ring);
+            sqe = io_uring_get_sqe(&u->ring);
+            if (!sqe) {
+                /* SQ still full; the packet is lost and will be retransmitted */
+                break;
+            }
+        }
+
+        u->tx_free_count--;
+        memcpy(&u->tx_to[slot], &si.to, si.to_len);
+        u->tx_iov[slot].iov_base = buf;
+        u->tx_iov[slot].iov_len  = (size_t)n;
+
+        struct msghdr *m = &u->tx_msg[slot];
+        memset(m, 0, sizeof(*m));
+        m->msg_name    = &u->tx_to[slot];
+        m->msg_namelen = si.to_len;
+        m->msg_iov     = &u->tx_iov[slot];
+        m->msg_iovlen  = 1;
+
+        io_uring_prep_sendmsg(sqe, 0, m, 0);
+        sqe->flags |= IOSQE_FIXED_FILE;
+        io_uring_sqe_set_data64(sqe, slot);
+        queued++;
+    }
+
+    if (queued > 0) {
+        io_uring_submit(&u->ring);
+    }
+    return queued;
+}
+
+#else /* !QUICPRO_HAVE_LIBURING */
+
+quicpro_uring_t *quicpro_uring_new(int fd)
+{
+    (void)fd;
+    return NULL;
+}
+
+void quicpro_uring_free(quicpro_uring_t *u)
+{
+    (void)u;
+}
+
+int quicpro_uring_reap(quicpro_uring_t *u, quicpro_uring_rx_cb cb, void *ctx)
+{
+    (void)u; (void)cb; (void)ctx;
+    errno = ENOSYS;
+    return -1;
+}
+
+int quicpro_uring_wait(quicpro_uring_t *u, int timeout_ms)
+{
+    (void)u; (void)timeout_ms;
+    errno = ENOSYS;
+    return -1;
+}
+
+int quicpro_uring_flush_quiche(quicpro_uring_t *u, quiche_conn *conn)
+{
+    (void)u; (void)conn;
+    return QUICHE_ERR_DONE;
+}
+
+int quicpro_uring_fd(quicpro_uring_t *u)
+{
+    (void)u;
+    return -1;
+}
+
+#endif /* QUICPRO_HAVE_LIBURING */
+
+/*─────────────────────────── Session Integration ─────────────────────────*/
+
+quicpro_uring_t *quicpro_session_uring(quicpro_session_t *s)
+{
+    if (s->uring || s->uring_unavailable) {
+        return s->uring;
+    }
+    if (!quicpro_bare_metal_config.io_engine_use_uring || s->sock < 0) {
+        s->uring_unavailable = true;
+        return NULL;
+    }
+
+    s->uring = quicpro_uring_new(s->sock);
+    if (!s->uring) {
+        s->uring_unavailable = true;
+    }
+    return s->uring;
+}
+
+static void quicpro_uring_session_rx(void *ctx, uint8_t *data, size_t len,
+                                     const struct sockaddr *from, socklen_t from_len,
+                                     const struct timespec *rx_ts)
+{
+    quicpro_session_t *s = (quicpro_session_t *)ctx;
+    quiche_recv_info ri = {
+        .from     = (struct sockaddr *)from,
+        .from_len = from_len,
+        .to       = NULL,
+        .to_len   = 0
+    };
+
+    uint64_t prof = quicpro_prof_begin();
+    quiche_conn_recv(s->conn, data, len, &ri);
+    quicpro_prof_end(QUICPRO_PROF_CONN_RECV, prof);
+    if (rx_ts) {
+        s->last_rx_ts = *rx_ts;
+    }
+}
+
+int quicpro_uring_session_recv(quicpro_session_t *s)
+{
+    int n = quicpro_uring_reap(s->uring, quicpro_uring_session_rx, s);
+
+    if (n < 0 && errno == EINVAL) {
+        /* Kernel lacks multishot recvmsg; retire the engine for this session */
+        quicpro_uring_free(s->uring);
+        s->uring = NULL;
+        s->uring_unavailable = true;
+        return 0;
+    }
+    return n;
+}
@@ -0,0 +1,466 @@
+/*
+ * src/semantic_geometry/geometry.c – Quicpro\Geometry\Matrix
+ * ==========================================================
+ *
+ * See include/semantic_geometry/geometry.h. The methods check shapes and
+ * names and hand the rows to the kernels (semantic_geometry/kernels.c,
+ * semantic_geometry/polytope.c); nothing is converted per call but the
+ * results.
+ */
+
+#include "php_quicpro.h"
+#include "semantic_geometry/geometry.h"
+#include "semantic_geometry/kernels.h"
+#include "semantic_geometry/polytope.h"
+#include "config/semantic_geometry/base_layer.h"
+
+#include <ext/spl/spl_exceptions.h>
+#include <zend_exceptions.h>
+#include <string.h>
+
+/* "approximated" compares this many evenly spaced rows of each set */
+#define QP_GEO_HAUSDORFF_SAMPLE 1024
+
+zend_class_entry *quicpro_ce_geometry_matrix;
+static zend_object_handlers quicpro_geometry_matrix_handlers;
+
+#define THIS_MATRIX() quicpro_geometry_matrix_from_obj(Z_OBJ_P(ZEND_THIS))
+
+static inline quicpro_geo_matrix_t qp_geo_view(const quicpro_geometry_matrix_object *m)
+{
+    return (quicpro_geo_matrix_t){ m->data, m->rows, m->dims };
+}
+
+/* quicpro.geometry_calculation_precision "float64": accumulate in doubles */
+static inline bool qp_geo_wide(void)
+{
+    const char *p = quicpro_semantic_geometry_config.calculation_precision;
+    return !p || strcmp(p, "float32") != 0;
+}
+
+/* Makes `out` a matrix of rows × dims, its data uninitialised */
+static quicpro_geometry_matrix_object *qp_geo_new(zval *out, int64_t rows, size_t dims)
+{
+    object_init_ex(out, quicpro_ce_geometry_matrix);
+    quicpro_geometry_matrix_object *m = quicpro_geometry_matrix_from_obj(Z_OBJ_P(out));
+    m->data = safe_emalloc((size_t)rows, dims * sizeof(float), 0);
+    m->rows = rows;
+    m->dims = dims;
+    return m;
+}
+
+static bool qp_geo_same_dims(const quicpro_geometry_matrix_object *a, const quicpro_geometry_matrix_object *b)
+{
+    if (a->dims != b->dims) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Matrix of %zu dimensions cannot be compared with one of %zu", a->dims, b->dims);
+        return false;
+    }
+    return true;
+}
+
+static bool qp_geo_metric(const zend_string *name, quicpro_geo_metric_t *metric)
+{
+    if (!quicpro_geo_metric_parse(name, metric)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Metric '%s' is unknown; use cosine, dot or l2", ZSTR_VAL(name));
+        return false;
+    }
+    return true;
+}
+
+/* The algorithm named, or the configured one without a name */
+static const char *qp_geo_algorithm(const zend_string *name, const char *configured, size_t *len)
+{
+    if (name) {
+        *len = ZSTR_LEN(name);
+        return ZSTR_VAL(name);
+    }
+    configured = configured ? configured : "";
+    *len = strlen(configured);
+    return configured;
+}
+
+/*──────────────────────────── Construction ───────────────────────────────*/
+
+/* A matrix of the rows of `rows`, lists of numbers of one length */
+PHP_METHOD(QuicproGeometryMatrix, fromArray)
+{
+    HashTable *rows_ht;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT(rows_ht)
+    ZEND_PARSE_PARAMETERS_END();
+
+    uint32_t rows = zend_hash_num_elements(rows_ht);
+    zval *row, *first = NULL;
+    ZEND_HASH_FOREACH_VAL(rows_ht, first) {
+        ZVAL_DEREF(first);
+        break;
+    } ZEND_HASH_FOREACH_END();
+    if (!first || Z_TYPE_P(first) != IS_ARRAY || zend_hash_num_elements(Z_ARRVAL_P(first)) == 0) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Matrix takes a non-empty list of non-empty rows");
+        RETURN_THROWS();
+    }
+    size_t dims = zend_hash_num_elements(Z_ARRVAL_P(first));
+    quicpro_geometry_matrix_object *m = qp_geo_new(return_value, rows, dims);
+
+    float *to = m->data;
+    ZEND_HASH_FOREACH_VAL(rows_ht, row) {
+        ZVAL_DEREF(row);
+        if (Z_TYPE_P(row) != IS_ARRAY || zend_hash_num_elements(Z_ARRVAL_P(row)) != dims) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                "Matrix row %td is not a list of %zu numbers", (to - m->data) / (ptrdiff_t)dims, dims);
+            RETURN_THROWS();
+        }
+        zval *v;
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(row), v) {
+            ZVAL_DEREF(v);
+            if (Z_TYPE_P(v) == IS_DOUBLE) {
+                *to++ = (float)Z_DVAL_P(v);
+            } else if (Z_TYPE_P(v) == IS_LONG) {
+                *to++ = (float)Z_LVAL_P(v);
+            } else {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Matrix takes int and float values only");
+                RETURN_THROWS();
+            }
+        } ZEND_HASH_FOREACH_END();
+    } ZEND_HASH_FOREACH_END();
+}
+
+/* A matrix of packed little-endian float32 rows of `dims` values (pack('g*', ...), an embedder's output) */
+PHP_METHOD(QuicproGeometryMatrix, fromBytes)
+{
+    zend_string *bytes;
+    zend_long dims = quicpro_semantic_geometry_config.default_vector_dimensions;
+    bool dims_null = true;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_STR(bytes)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG_OR_NULL(dims, dims_null)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (dims_null) {
+        dims = quicpro_semantic_geometry_config.default_vector_dimensions;
+    }
+    if (dims <= 0) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Matrix dims must be positive");
+        RETURN_THROWS();
+    }
+    size_t row_bytes = (size_t)dims * sizeof(float);
+    if (ZSTR_LEN(bytes) == 0 || ZSTR_LEN(bytes) % row_bytes) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Matrix of %zu bytes is not a whole number of %" ZEND_LONG_FMT_SPEC "-dimension float32 rows",
+            ZSTR_LEN(bytes), dims);
+        RETURN_THROWS();
+    }
+    quicpro_geometry_matrix_object *m = qp_geo_new(return_value, (int64_t)(ZSTR_LEN(bytes) / row_bytes), (size_t)dims);
+    memcpy(m->data, ZSTR_VAL(bytes), ZSTR_LEN(bytes));
+}
+
+PHP_METHOD(QuicproGeometryMatrix, rows)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    RETURN_LONG((zend_long)THIS_MATRIX()->rows);
+}
+
+PHP_METHOD(QuicproGeometryMatrix, dims)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    RETURN_LONG((zend_long)THIS_MATRIX()->dims);
+}
+
+PHP_METHOD(QuicproGeometryMatrix, toArray)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_geometry_matrix_object *m = THIS_MATRIX();
+    array_init_size(return_value, (uint32_t)m->rows);
+    for (int64_t i = 0; i < m->rows; i++) {
+        zval row;
+        array_init_size(&row, (uint32_t)m->dims);
+        for (size_t j = 0; j < m->dims; j++) {
+            add_next_index_double(&row, m->data[(size_t)i * m->dims + j]);
+        }
+        add_next_index_zval(return_value, &row);
+    }
+}
+
+PHP_METHOD(QuicproGeometryMatrix, toBytes)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_geometry_matrix_object *m = THIS_MATRIX();
+    RETURN_STRINGL((const char *)m->data, (size_t)m->rows * m->dims * sizeof(float));
+}
+
+/*──────────────────────────── Similarity ─────────────────────────────────*/
+
+/* A rows × other->rows matrix of the metric between each row of this and each of `other` */
+PHP_METHOD(QuicproGeometryMatrix, scores)
+{
+    zval *zo;
+    zend_string *metric_name = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_OBJECT_OF_CLASS(zo, quicpro_ce_geometry_matrix)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR(metric_name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_geometry_matrix_object *q = THIS_MATRIX(), *c = quicpro_geometry_matrix_from_obj(Z_OBJ_P(zo));
+    quicpro_geo_metric_t metric = QUICPRO_GEO_COSINE;
+    if (!qp_geo_same_dims(q, c) || (metric_name && !qp_geo_metric(metric_name, &metric))) {
+        RETURN_THROWS();
+    }
+    quicpro_geo_matrix_t qv = qp_geo_view(q), cv = qp_geo_view(c);
+    quicpro_geometry_matrix_object *out = qp_geo_new(return_value, q->rows, (size_t)c->rows);
+    quicpro_geo_scores(&qv, &cv, metric, qp_geo_wide(), out->data);
+}
+
+/* For each row of this, the `k` nearest rows of `corpus` as [index => score], best first */
+PHP_METHOD(QuicproGeometryMatrix, nearest)
+{
+    zval *zo;
+    zend_long k = 1;
+    zend_string *metric_name = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 3)
+        Z_PARAM_OBJECT_OF_CLASS(zo, quicpro_ce_geometry_matrix)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(k)
+        Z_PARAM_STR(metric_name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_geometry_matrix_object *q = THIS_MATRIX(), *c = quicpro_geometry_matrix_from_obj(Z_OBJ_P(zo));
+    quicpro_geo_metric_t metric = QUICPRO_GEO_COSINE;
+    if (!qp_geo_same_dims(q, c) || (metric_name && !qp_geo_metric(metric_name, &metric))) {
+        RETURN_THROWS();
+    }
+    if (k < 1 || k > 65535) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Matrix::nearest() k must be within 1..65535");
+        RETURN_THROWS();
+    }
+    uint32_t n = (uint32_t)MIN((int64_t)k, c->rows);
+    int64_t *idx = safe_emalloc((size_t)q->rows, n * sizeof(int64_t), 0);
+    float *score = safe_emalloc((size_t)q->rows, n * sizeof(float), 0);
+    quicpro_geo_matrix_t qv = qp_geo_view(q), cv = qp_geo_view(c);
+    quicpro_geo_nearest(&qv, &cv, metric, qp_geo_wide(), n, idx, score);
+
+    array_init_size(return_value, (uint32_t)q->rows);
+    for (int64_t i = 0; i < q->rows; i++) {
+        zval best;
+        array_init_size(&best, n);
+        for (uint32_t j = 0; j < n; j++) {
+            add_index_double(&best, (zend_ulong)idx[(size_t)i * n + j], score[(size_t)i * n + j]);
+        }
+        add_next_index_zval(return_value, &best);
+    }
+    efree(idx);
+    efree(score);
+}
+
+/* The Hausdorff distance between the rows of this and of `other`, exact or approximated */
+PHP_METHOD(QuicproGeometryMatrix, hausdorff)
+{
+    zval *zo;
+    zend_string *algo_name = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_OBJECT_OF_CLASS(zo, quicpro_ce_geometry_matrix)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR_OR_NULL(algo_name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_geometry_matrix_object *a = THIS_MATRIX(), *b = quicpro_geometry_matrix_from_obj(Z_OBJ_P(zo));
+    if (!qp_geo_same_dims(a, b)) {
+        RETURN_THROWS();
+    }
+    size_t len;
+    const char *algo = qp_geo_algorithm(algo_name, quicpro_semantic_geometry_config.hausdorff_distance_algorithm, &len);
+    int64_t sample;
+    if (len == sizeof("exact") - 1 && memcmp(algo, "exact", len) == 0) {
+        sample = 0;
+    } else if (len == sizeof("approximated") - 1 && memcmp(algo, "approximated", len) == 0) {
+        sample = QP_GEO_HAUSDORFF_SAMPLE;
+    } else {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Hausdorff algorithm '%s' is unknown; use exact or approximated", algo);
+        RETURN_THROWS();
+    }
+    quicpro_geo_matrix_t av = qp_geo_view(a), bv = qp_geo_view(b);
+    RETURN_DOUBLE(quicpro_geo_hausdorff(&av, &bv, qp_geo_wide(), sample));
+}
+
+/*──────────────────────────── Polytopes ──────────────────────────────────*/
+
+/* The vertices of the convex hull of these 2D points, counter-clockwise */
+PHP_METHOD(QuicproGeometryMatrix, convexHull)
+{
+    zend_string *algo_name = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(0, 1)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR_OR_NULL(algo_name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_geometry_matrix_object *m = THIS_MATRIX();
+    size_t len;
+    const char *name = qp_geo_algorithm(algo_name, quicpro_semantic_geometry_config.convex_hull_algorithm, &len);
+    quicpro_geo_hull_t algo;
+    if (!quicpro_geo_hull_parse(name, len, &algo)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Convex hull algorithm '%s' is unknown; use qhull or gift_wrapping", name);
+        RETURN_THROWS();
+    }
+    if (m->dims != 2) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Matrix::convexHull() takes 2-dimension points, not %zu", m->dims);
+        RETURN_THROWS();
+    }
+    quicpro_geo_matrix_t mv = qp_geo_view(m);
+    int64_t *idx = safe_emalloc((size_t)m->rows, sizeof(int64_t), 0);
+    int64_t n = quicpro_geo_hull(&mv, algo, idx);
+    quicpro_geometry_matrix_object *out = qp_geo_new(return_value, n, 2);
+    for (int64_t i = 0; i < n; i++) {
+        memcpy(out->data + i * 2, m->data + idx[i] * 2, 2 * sizeof(float));
+    }
+    efree(idx);
+}
+
+/* For each row of `points`, whether it lies in the polytope whose vertices are this matrix's rows */
+PHP_METHOD(QuicproGeometryMatrix, contains)
+{
+    zval *zo;
+    zend_string *algo_name = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_OBJECT_OF_CLASS(zo, quicpro_ce_geometry_matrix)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR_OR_NULL(algo_name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_geometry_matrix_object *poly = THIS_MATRIX(), *points = quicpro_geometry_matrix_from_obj(Z_OBJ_P(zo));
+    if (!qp_geo_same_dims(poly, points)) {
+        RETURN_THROWS();
+    }
+    size_t len;
+    const char *name = qp_geo_algorithm(algo_name, quicpro_semantic_geometry_config.point_in_polytope_algorithm, &len);
+    quicpro_geo_containment_t algo;
+    if (!quicpro_geo_containment_parse(name, len, &algo)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Containment algorithm '%s' is unknown; use ray_casting or barycentric", name);
+        RETURN_THROWS();
+    }
+    quicpro_geo_matrix_t pv = qp_geo_view(poly), xv = qp_geo_view(points);
+    if (!quicpro_geo_containment_fits(&pv, algo)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Matrix::contains() takes a polygon of at least 3 vertices, or with barycentric a simplex of dims + 1");
+        RETURN_THROWS();
+    }
+    bool *in = safe_emalloc((size_t)points->rows, sizeof(bool), 0);
+    quicpro_geo_contains(&pv, &xv, algo, in);
+    array_init_size(return_value, (uint32_t)points->rows);
+    for (int64_t i = 0; i < points->rows; i++) {
+        add_next_index_bool(return_value, in[i]);
+    }
+    efree(in);
+}
+
+/*──────────────────────────── Life cycle ─────────────────────────────────*/
+
+static zend_object *qp_geo_matrix_create(zend_class_entry *ce)
+{
+    quicpro_geometry_matrix_object *m = zend_object_alloc(sizeof(quicpro_geometry_matrix_object), ce);
+    zend_object_std_init(&m->std, ce);
+    object_properties_init(&m->std, ce);
+    m->std.handlers = &quicpro_geometry_matrix_handlers;
+    return &m->std;
+}
+
+static void qp_geo_matrix_free_obj(zend_object *obj)
+{
+    quicpro_geometry_matrix_object *m = quicpro_geometry_matrix_from_obj(obj);
+    if (m->data) {
+        efree(m->data);
+    }
+    zend_object_std_dtor(obj);
+}
+
+/*──────────────────────────── Registration ───────────────────────────────*/
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_geometry_matrix_from_array, 0, 1, Quicpro\\Geometry\\Matrix, 0)
+    ZEND_ARG_TYPE_INFO(0, rows, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_geometry_matrix_from_bytes, 0, 1, Quicpro\\Geometry\\Matrix, 0)
+    ZEND_ARG_TYPE_INFO(0, bytes, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, dims, IS_LONG, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_matrix_rows, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_quicpro_geometry_matrix_dims arginfo_quicpro_geometry_matrix_rows
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_matrix_to_array, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_matrix_to_bytes, 0, 0, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_geometry_matrix_scores, 0, 1, Quicpro\\Geometry\\Matrix, 0)
+    ZEND_ARG_OBJ_INFO(0, other, Quicpro\\Geometry\\Matrix, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, metric, IS_STRING, 0, "\"cosine\"")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_matrix_nearest, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_OBJ_INFO(0, corpus, Quicpro\\Geometry\\Matrix, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, k, IS_LONG, 0, "1")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, metric, IS_STRING, 0, "\"cosine\"")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_matrix_hausdorff, 0, 1, IS_DOUBLE, 0)
+    ZEND_ARG_OBJ_INFO(0, other, Quicpro\\Geometry\\Matrix, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, algorithm, IS_STRING, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_geometry_matrix_convex_hull, 0, 0, Quicpro\\Geometry\\Matrix, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, algorithm, IS_STRING, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_matrix_contains, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_OBJ_INFO(0, points, Quicpro\\Geometry\\Matrix, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, algorithm, IS_STRING, 1, "null")
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry quicpro_geometry_matrix_methods[] = {
+    PHP_ME(QuicproGeometryMatrix, fromArray,  arginfo_quicpro_geometry_matrix_from_array,  ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_ME(QuicproGeometryMatrix, fromBytes,  arginfo_quicpro_geometry_matrix_from_bytes,  ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_ME(QuicproGeometryMatrix, rows,       arginfo_quicpro_geometry_matrix_rows,        ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryMatrix, dims,       arginfo_quicpro_geometry_matrix_dims,        ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryMatrix, toArray,    arginfo_quicpro_geometry_matrix_to_array,    ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryMatrix, toBytes,    arginfo_quicpro_geometry_matrix_to_bytes,    ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryMatrix, scores,     arginfo_quicpro_geometry_matrix_scores,      ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryMatrix, nearest,    arginfo_quicpro_geometry_matrix_nearest,     ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryMatrix, hausdorff,  arginfo_quicpro_geometry_matrix_hausdorff,   ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryMatrix, convexHull, arginfo_quicpro_geometry_matrix_convex_hull, ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryMatrix, contains,   arginfo_quicpro_geometry_matrix_contains,    ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+void quicpro_geometry_minit(void)
+{
+    zend_class_entry ce;
+    INIT_NS_CLASS_ENTRY(ce, "Quicpro\\Geometry", "Matrix", quicpro_geometry_matrix_methods);
+    quicpro_ce_geometry_matrix = zend_register_internal_class(&ce);
+    quicpro_ce_geometry_matrix->ce_flags |= ZEND_ACC_FINAL;
+#ifdef ZEND_ACC_NO_DYNAMIC_PROPERTIES
+    quicpro_ce_geometry_matrix->ce_flags |= ZEND_ACC_NO_DYNAMIC_PROPERTIES;
+#endif
+    quicpro_ce_geometry_matrix->create_object = qp_geo_matrix_create;
+
+    memcpy(&quicpro_geometry_matrix_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    quicpro_geometry_matrix_handlers.offset = XtOffsetOf(quicpro_geometry_matrix_object, std);
+    quicpro_geometry_matrix_handlers.free_obj = qp_geo_matrix_free_obj;
+    quicpro_geometry_matrix_handlers.clone_obj = NULL;
+}
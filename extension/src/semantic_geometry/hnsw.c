@@ -0,0 +1,829 @@
+/*
+ * src/semantic_geometry/hnsw.c – Approximate nearest neighbours
+ * =============================================================
+ *
+ * See include/semantic_geometry/hnsw.h. Internally every metric is a
+ * distance, lower is nearer: squared l2, or the negated dot product.
+ *
+ * add() runs one at a time (the `insert` mutex). On the calling thread it
+ * draws the rows' layers, grows the sections if they lack room, and
+ * writes the rows' vectors, labels and documents; then it publishes the
+ * new count and links the rows on the morsel pool. A row is reachable
+ * only through links to it, made after its vector was written. Linking
+ * holds one node's lock at a time, so it cannot deadlock; a node that
+ * lands above the entry point takes its place by compare-and-swap.
+ *
+ * Growing (and save(), which must see no half-linked node) takes the
+ * `resize` lock for writing; add() and search() hold it for reading.
+ */
+
+#include "php_quicpro.h"
+#include "semantic_geometry/hnsw.h"
+#include "dataframe/morsel.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define QP_HNSW_MAGIC      "QPHNSW1\n"
+#define QP_HNSW_NONE       UINT64_MAX       /* `top` of an empty index */
+#define QP_HNSW_MAX_LAYER  31
+#define QP_HNSW_ALIGN      64               /* Of each section in the file */
+
+struct quicpro_hnsw_s {
+    quicpro_hnsw_params_t p;
+    _Atomic uint32_t      refs;
+    pthread_mutex_t       insert;
+    pthread_rwlock_t      resize;
+    size_t                vec_bytes;        /* One stored vector: float32 × dims, or a float scale and int8 × dims */
+    uint32_t              max0, max_up;     /* Links on layer 0, above it */
+    double                level_mult;       /* 1 / ln m */
+    uint64_t              rng;
+    _Atomic int64_t       count;
+    int64_t               capacity;
+    _Atomic uint64_t      top;              /* The entry node, and its layer << 32 */
+
+    /* The sections, as a file has them: in the mapping of a loaded one, or on the heap */
+    int64_t              *labels;
+    uint8_t              *levels;
+    uint64_t             *upper_at;         /* Where a node's layers above 0 start in `upper` */
+    uint8_t              *vectors;
+    uint32_t             *links0;           /* Per node: the count, then max0 nodes */
+    uint32_t             *upper;            /* Per node and layer above 0: the count, then max_up nodes */
+    uint64_t             *doc_at;           /* count + 1 offsets into `docs` */
+    char                 *docs;
+    uint64_t              upper_len, upper_cap, docs_len, docs_cap;
+
+    atomic_flag          *locks;            /* Per node; always on the heap */
+    void                 *map;
+    size_t                map_len;
+};
+
+/* The file: this head, then the sections in this order, each QP_HNSW_ALIGN aligned */
+typedef struct {
+    char     magic[8];
+    uint32_t dims, metric, storage, m, ef_construction, ef_search;
+    uint64_t count, top, upper_len, docs_len;
+    uint64_t at[8];
+} qp_hnsw_head;
+
+enum { QP_LABELS, QP_LEVELS, QP_UPPER_AT, QP_VECTORS, QP_LINKS0, QP_UPPER, QP_DOC_AT, QP_DOCS };
+
+/*──────────────────────────── Nodes ──────────────────────────────────────*/
+
+static inline void qp_hnsw_lock(quicpro_hnsw_t *h, uint32_t node)
+{
+    while (atomic_flag_test_and_set_explicit(&h->locks[node], memory_order_acquire)) {
+    }
+}
+
+static inline void qp_hnsw_unlock(quicpro_hnsw_t *h, uint32_t node)
+{
+    atomic_flag_clear_explicit(&h->locks[node], memory_order_release);
+}
+
+static inline uint32_t *qp_hnsw_links(const quicpro_hnsw_t *h, uint32_t node, uint32_t layer)
+{
+    if (layer == 0) {
+        return h->links0 + (size_t)node * (1 + h->max0);
+    }
+    return h->upper + h->upper_at[node] + (size_t)(layer - 1) * (1 + h->max_up);
+}
+
+/* Distance from the float32 vector `q` (normalised for cosine) to `node` */
+static inline float qp_hnsw_dist(const quicpro_hnsw_t *h, const float *q, uint32_t node)
+{
+    const uint8_t *v = h->vectors + (size_t)node * h->vec_bytes;
+    size_t d = h->p.dims;
+    if (h->p.storage == QUICPRO_HNSW_INT8) {
+        float scale;
+        memcpy(&scale, v, sizeof(float));
+        const int8_t *b = (const int8_t *)(v + sizeof(float));
+        return h->p.metric == QUICPRO_GEO_L2 ? quicpro_geo_sq_i8(q, b, scale, d) : -scale * quicpro_geo_dot_i8(q, b, d);
+    }
+    const float *b = (const float *)v;
+    return h->p.metric == QUICPRO_GEO_L2 ? quicpro_geo_sq_f32(q, b, d) : -quicpro_geo_dot_f32(q, b, d);
+}
+
+/* `node` as float32: in place, or dequantised into `scratch` */
+static inline const float *qp_hnsw_unpack(const quicpro_hnsw_t *h, uint32_t node, float *scratch)
+{
+    const uint8_t *v = h->vectors + (size_t)node * h->vec_bytes;
+    if (h->p.storage != QUICPRO_HNSW_INT8) {
+        return (const float *)v;
+    }
+    float scale;
+    memcpy(&scale, v, sizeof(float));
+    const int8_t *b = (const int8_t *)(v + sizeof(float));
+    for (size_t i = 0; i < h->p.dims; i++) {
+        scratch[i] = b[i] * scale;
+    }
+    return scratch;
+}
+
+/* Copies `src` as `node` stores it; cosine vectors are normalised first */
+static void qp_hnsw_pack(const quicpro_hnsw_t *h, uint32_t node, const float *src)
+{
+    uint8_t *v = h->vectors + (size_t)node * h->vec_bytes;
+    size_t d = h->p.dims;
+    float norm = 1;
+    if (h->p.metric == QUICPRO_GEO_COSINE) {
+        float n2 = quicpro_geo_dot_f32(src, src, d);
+        norm = n2 > 0 ? 1.0f / sqrtf(n2) : 0.0f;
+    }
+    if (h->p.storage != QUICPRO_HNSW_INT8) {
+        float *to = (float *)v;
+        for (size_t i = 0; i < d; i++) {
+            to[i] = src[i] * norm;
+        }
+        return;
+    }
+    float peak = 0;
+    for (size_t i = 0; i < d; i++) {
+        peak = MAX(peak, fabsf(src[i] * norm));
+    }
+    float scale = peak / 127.0f;
+    int8_t *to = (int8_t *)(v + sizeof(float));
+    memcpy(v, &scale, sizeof(float));
+    for (size_t i = 0; i < d; i++) {
+        to[i] = scale > 0 ? (int8_t)lrintf(src[i] * norm / scale) : 0;
+    }
+}
+
+/*──────────────────────────── Walks ──────────────────────────────────────*/
+
+typedef struct {
+    float    d;
+    uint32_t node;
+} qp_hnsw_item;
+
+/* A binary heap, greatest key on top */
+typedef struct {
+    qp_hnsw_item *v;
+    uint32_t      n, cap;
+} qp_hnsw_heap;
+
+static void qp_hnsw_push(qp_hnsw_heap *hp, float key, uint32_t node)
+{
+    if (hp->n == hp->cap) {
+        hp->cap = hp->cap ? hp->cap * 2 : 64;
+        hp->v = realloc(hp->v, hp->cap * sizeof(qp_hnsw_item));
+    }
+    uint32_t i = hp->n++;
+    while (i > 0 && hp->v[(i - 1) / 2].d < key) {
+        hp->v[i] = hp->v[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    hp->v[i] = (qp_hnsw_item){ key, node };
+}
+
+static qp_hnsw_item qp_hnsw_pop(qp_hnsw_heap *hp)
+{
+    qp_hnsw_item top = hp->v[0], last = hp->v[--hp->n];
+    uint32_t i = 0;
+    for (;;) {
+        uint32_t c = 2 * i + 1;
+        if (c >= hp->n) {
+            break;
+        }
+        if (c + 1 < hp->n && hp->v[c + 1].d > hp->v[c].d) {
+            c++;
+        }
+        if (hp->v[c].d <= last.d) {
+            break;
+        }
+        hp->v[i] = hp->v[c];
+        i = c;
+    }
+    if (hp->n) {
+        hp->v[i] = last;
+    }
+    return top;
+}
+
+/* One thread's scratch for walking the graph: what a morsel of inserts or searches reuses */
+typedef struct {
+    quicpro_hnsw_t *h;
+    uint32_t       *tags;               /* Per node: the walk that visited it last */
+    uint32_t        tag;
+    qp_hnsw_heap    cand;               /* To expand, nearest on top (keys negated) */
+    qp_hnsw_heap    best;               /* Found, farthest on top */
+    qp_hnsw_item   *items;              /* Sorted candidates; room for ef or max0 + 1 */
+    uint32_t        items_cap;
+    uint32_t       *nbuf;               /* A node's links, copied out under its lock */
+    float          *q, *base, *v;       /* dims each */
+} qp_hnsw_walk;
+
+static void qp_hnsw_walk_init(qp_hnsw_walk *w, quicpro_hnsw_t *h)
+{
+    memset(w, 0, sizeof(*w));
+    w->h = h;
+    w->tags = calloc((size_t)MAX(h->capacity, 1), sizeof(uint32_t));
+    w->nbuf = malloc((1 + (size_t)h->max0) * sizeof(uint32_t));
+    w->q = malloc(3 * h->p.dims * sizeof(float));
+    w->base = w->q + h->p.dims;
+    w->v = w->base + h->p.dims;
+}
+
+static void qp_hnsw_walk_free(qp_hnsw_walk *w)
+{
+    free(w->tags);
+    free(w->nbuf);
+    free(w->q);
+    free(w->cand.v);
+    free(w->best.v);
+    free(w->items);
+}
+
+static inline bool qp_hnsw_visit(qp_hnsw_walk *w, uint32_t node)
+{
+    if (w->tags[node] == w->tag) {
+        return false;
+    }
+    w->tags[node] = w->tag;
+    return true;
+}
+
+/* The links of `node` on `layer`, into w->nbuf; their count */
+static uint32_t qp_hnsw_neighbours(qp_hnsw_walk *w, uint32_t node, uint32_t layer)
+{
+    quicpro_hnsw_t *h = w->h;
+    qp_hnsw_lock(h, node);
+    const uint32_t *l = qp_hnsw_links(h, node, layer);
+    uint32_t n = l[0];
+    memcpy(w->nbuf, l + 1, n * sizeof(uint32_t));
+    qp_hnsw_unlock(h, node);
+    return n;
+}
+
+/* From `*cur` on `layer`, to whichever neighbour is nearer `q` while one is */
+static void qp_hnsw_greedy(qp_hnsw_walk *w, const float *q, uint32_t *cur, float *dcur, uint32_t layer)
+{
+    for (bool moved = true; moved;) {
+        moved = false;
+        uint32_t n = qp_hnsw_neighbours(w, *cur, layer);
+        for (uint32_t i = 0; i < n; i++) {
+            float d = qp_hnsw_dist(w->h, q, w->nbuf[i]);
+            if (d < *dcur) {
+                *dcur = d;
+                *cur = w->nbuf[i];
+                moved = true;
+            }
+        }
+    }
+}
+
+/* The `ef` nodes of `layer` nearest `q` that a best-first search from `entry` finds, into w->best */
+static void qp_hnsw_search_layer(qp_hnsw_walk *w, const float *q, uint32_t entry, float dentry, uint32_t ef, uint32_t layer)
+{
+    if (++w->tag == 0) {
+        memset(w->tags, 0, (size_t)w->h->capacity * sizeof(uint32_t));
+        w->tag = 1;
+    }
+    w->cand.n = w->best.n = 0;
+    qp_hnsw_visit(w, entry);
+    qp_hnsw_push(&w->cand, -dentry, entry);
+    qp_hnsw_push(&w->best, dentry, entry);
+
+    while (w->cand.n) {
+        qp_hnsw_item c = qp_hnsw_pop(&w->cand);
+        if (-c.d > w->best.v[0].d && w->best.n >= ef) {
+            break;
+        }
+        uint32_t n = qp_hnsw_neighbours(w, c.node, layer);
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t next = w->nbuf[i];
+            if (!qp_hnsw_visit(w, next)) {
+                continue;
+            }
+            float d = qp_hnsw_dist(w->h, q, next);
+            if (w->best.n < ef || d < w->best.v[0].d) {
+                qp_hnsw_push(&w->cand, -d, next);
+                qp_hnsw_push(&w->best, d, next);
+                if (w->best.n > ef) {
+                    qp_hnsw_pop(&w->best);
+                }
+            }
+        }
+    }
+}
+
+static int qp_hnsw_item_cmp(const void *a, const void *b)
+{
+    float x = ((const qp_hnsw_item *)a)->d, y = ((const qp_hnsw_item *)b)->d;
+    return (x > y) - (x < y);
+}
+
+/* w->best emptied into w->items, nearest first; their count */
+static uint32_t qp_hnsw_sorted(qp_hnsw_walk *w)
+{
+    uint32_t n = w->best.n;
+    if (n > w->items_cap) {
+        w->items_cap = n;
+        w->items = realloc(w->items, n * sizeof(qp_hnsw_item));
+    }
+    memcpy(w->items, w->best.v, n * sizeof(qp_hnsw_item));
+    w->best.n = 0;
+    qsort(w->items, n, sizeof(qp_hnsw_item), qp_hnsw_item_cmp);
+    return n;
+}
+
+/*
+ * Of `items` (sorted, distances to some base), up to `keep` to link the
+ * base to: a candidate is taken unless a node taken already is nearer to
+ * it than the base is, so that links spread out in every direction rather
+ * than bunch up in the densest one.
+ */
+static uint32_t qp_hnsw_select(qp_hnsw_walk *w, const qp_hnsw_item *items, uint32_t n, uint32_t keep, uint32_t *out)
+{
+    uint32_t taken = 0;
+    for (uint32_t i = 0; i < n && taken < keep; i++) {
+        const float *c = qp_hnsw_unpack(w->h, items[i].node, w->v);
+        bool good = true;
+        for (uint32_t j = 0; j < taken && good; j++) {
+            good = qp_hnsw_dist(w->h, c, out[j]) >= items[i].d;
+        }
+        if (good) {
+            out[taken++] = items[i].node;
+        }
+    }
+    return taken;
+}
+
+/* Links `from` to `node` on `layer`; a full list is pruned back to its size, `node` a candidate */
+static void qp_hnsw_link_back(qp_hnsw_walk *w, uint32_t from, uint32_t node, uint32_t layer)
+{
+    quicpro_hnsw_t *h = w->h;
+    uint32_t max = layer ? h->max_up : h->max0;
+    qp_hnsw_lock(h, from);
+    uint32_t *l = qp_hnsw_links(h, from, layer);
+    if (l[0] < max) {
+        l[1 + l[0]++] = node;
+        qp_hnsw_unlock(h, from);
+        return;
+    }
+    if (w->items_cap < max + 1) {
+        w->items_cap = max + 1;
+        w->items = realloc(w->items, w->items_cap * sizeof(qp_hnsw_item));
+    }
+    const float *base = qp_hnsw_unpack(h, from, w->base);
+    for (uint32_t i = 0; i < max; i++) {
+        w->items[i] = (qp_hnsw_item){ qp_hnsw_dist(h, base, l[1 + i]), l[1 + i] };
+    }
+    w->items[max] = (qp_hnsw_item){ qp_hnsw_dist(h, base, node), node };
+    qsort(w->items, max + 1, sizeof(qp_hnsw_item), qp_hnsw_item_cmp);
+    l[0] = qp_hnsw_select(w, w->items, max + 1, max, l + 1);
+    qp_hnsw_unlock(h, from);
+}
+
+static void qp_hnsw_insert(qp_hnsw_walk *w, uint32_t node)
+{
+    quicpro_hnsw_t *h = w->h;
+    uint32_t level = h->levels[node];
+    uint64_t top = atomic_load_explicit(&h->top, memory_order_acquire);
+    uint32_t cur = (uint32_t)top, top_level = (uint32_t)(top >> 32);
+    const float *q = qp_hnsw_unpack(h, node, w->q);
+    float dcur = qp_hnsw_dist(h, q, cur);
+
+    for (uint32_t layer = top_level; layer > level; layer--) {
+        qp_hnsw_greedy(w, q, &cur, &dcur, layer);
+    }
+    uint32_t *sel = malloc((size_t)h->p.m * sizeof(uint32_t));
+    for (int32_t layer = (int32_t)MIN(level, top_level); layer >= 0; layer--) {
+        qp_hnsw_search_layer(w, q, cur, dcur, h->p.ef_construction, (uint32_t)layer);
+        uint32_t n = qp_hnsw_sorted(w);
+        cur = w->items[0].node;
+        dcur = w->items[0].d;
+        uint32_t taken = qp_hnsw_select(w, w->items, n, h->p.m, sel);
+
+        qp_hnsw_lock(h, node);
+        uint32_t *l = qp_hnsw_links(h, node, (uint32_t)layer);
+        memcpy(l + 1, sel, taken * sizeof(uint32_t));
+        l[0] = taken;
+        qp_hnsw_unlock(h, node);
+        for (uint32_t i = 0; i < taken; i++) {
+            qp_hnsw_link_back(w, sel[i], node, (uint32_t)layer);
+        }
+    }
+    free(sel);
+
+    /* Above the entry point: the entry point now, unless another insert rose higher meanwhile */
+    uint64_t mine = (uint64_t)level << 32 | node;
+    while (level > (uint32_t)(top >> 32)
+           && !atomic_compare_exchange_weak_explicit(&h->top, &top, mine, memory_order_acq_rel, memory_order_acquire)) {
+    }
+}
+
+/*──────────────────────────── Sections ───────────────────────────────────*/
+
+/* A section in the mapping of a loaded file (an empty one may point at its end) */
+static inline bool qp_hnsw_mapped(const quicpro_hnsw_t *h, const void *p)
+{
+    return h->map && (const char *)p >= (const char *)h->map && (const char *)p <= (const char *)h->map + h->map_len;
+}
+
+/* `old` with room for `want` bytes and the `used` it has: copied out of the mapping, or reallocated */
+static void *qp_hnsw_regrow(quicpro_hnsw_t *h, void *old, size_t used, size_t want)
+{
+    if (qp_hnsw_mapped(h, old)) {
+        void *to = pemalloc(want, 1);
+        memcpy(to, old, used);
+        return to;
+    }
+    return perealloc(old, want, 1);
+}
+
+static void qp_hnsw_region_free(quicpro_hnsw_t *h, void *p)
+{
+    if (p && !qp_hnsw_mapped(h, p)) {
+        pefree(p, 1);
+    }
+}
+
+/* Room for `nodes` nodes, `upper` uint32 of upper links and `docs` document bytes in all */
+static void qp_hnsw_reserve(quicpro_hnsw_t *h, int64_t nodes, uint64_t upper, uint64_t docs)
+{
+    int64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    pthread_rwlock_wrlock(&h->resize);
+    if (nodes > h->capacity) {
+        int64_t cap = MAX(nodes, MAX(h->capacity * 2, 64));
+        h->labels = qp_hnsw_regrow(h, h->labels, count * sizeof(int64_t), cap * sizeof(int64_t));
+        h->levels = qp_hnsw_regrow(h, h->levels, count, cap);
+        h->upper_at = qp_hnsw_regrow(h, h->upper_at, count * sizeof(uint64_t), cap * sizeof(uint64_t));
+        h->vectors = qp_hnsw_regrow(h, h->vectors, count * h->vec_bytes, cap * h->vec_bytes);
+        h->links0 = qp_hnsw_regrow(h, h->links0, count * (1 + h->max0) * sizeof(uint32_t), cap * (1 + h->max0) * sizeof(uint32_t));
+        h->doc_at = qp_hnsw_regrow(h, h->doc_at, (count + 1) * sizeof(uint64_t), (cap + 1) * sizeof(uint64_t));
+        h->locks = perealloc(h->locks, cap * sizeof(atomic_flag), 1);
+        memset(h->locks + h->capacity, 0, (cap - h->capacity) * sizeof(atomic_flag));
+        h->capacity = cap;
+    }
+    if (upper > h->upper_cap) {
+        uint64_t cap = MAX(upper, MAX(h->upper_cap * 2, 256));
+        h->upper = qp_hnsw_regrow(h, h->upper, h->upper_len * sizeof(uint32_t), cap * sizeof(uint32_t));
+        h->upper_cap = cap;
+    }
+    if (docs > h->docs_cap) {
+        uint64_t cap = MAX(docs, MAX(h->docs_cap * 2, 4096));
+        h->docs = qp_hnsw_regrow(h, h->docs, h->docs_len, cap);
+        h->docs_cap = cap;
+    }
+    pthread_rwlock_unlock(&h->resize);
+}
+
+static quicpro_hnsw_t *qp_hnsw_alloc(const quicpro_hnsw_params_t *params)
+{
+    quicpro_hnsw_t *h = pecalloc(1, sizeof(*h), 1);
+    h->p = *params;
+    h->refs = 1;
+    pthread_mutex_init(&h->insert, NULL);
+    pthread_rwlock_init(&h->resize, NULL);
+    h->vec_bytes = params->storage == QUICPRO_HNSW_INT8
+        ? sizeof(float) + ((params->dims + 3) & ~(size_t)3)
+        : params->dims * sizeof(float);
+    h->max0 = 2 * params->m;
+    h->max_up = params->m;
+    h->level_mult = 1.0 / log((double)MAX(params->m, 2));
+    h->rng = 0x9e3779b97f4a7c15ULL;
+    h->top = QP_HNSW_NONE;
+    return h;
+}
+
+quicpro_hnsw_t *quicpro_hnsw_new(const quicpro_hnsw_params_t *params)
+{
+    quicpro_hnsw_t *h = qp_hnsw_alloc(params);
+    h->doc_at = pecalloc(1, sizeof(uint64_t), 1);
+    return h;
+}
+
+void quicpro_hnsw_retain(quicpro_hnsw_t *h)
+{
+    atomic_fetch_add_explicit(&h->refs, 1, memory_order_relaxed);
+}
+
+void quicpro_hnsw_release(quicpro_hnsw_t *h)
+{
+    if (atomic_fetch_sub_explicit(&h->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+    void *regions[] = { h->labels, h->levels, h->upper_at, h->vectors, h->links0, h->upper, h->doc_at, h->docs };
+    for (size_t i = 0; i < sizeof(regions) / sizeof(regions[0]); i++) {
+        qp_hnsw_region_free(h, regions[i]);
+    }
+    if (h->locks) {
+        pefree(h->locks, 1);
+    }
+    if (h->map) {
+        munmap(h->map, h->map_len);
+    }
+    pthread_mutex_destroy(&h->insert);
+    pthread_rwlock_destroy(&h->resize);
+    pefree(h, 1);
+}
+
+const quicpro_hnsw_params_t *quicpro_hnsw_params(const quicpro_hnsw_t *h)
+{
+    return &h->p;
+}
+
+int64_t quicpro_hnsw_count(const quicpro_hnsw_t *h)
+{
+    return atomic_load_explicit(&h->count, memory_order_acquire);
+}
+
+bool quicpro_hnsw_has_documents(const quicpro_hnsw_t *h)
+{
+    return h->docs_len > 0;
+}
+
+/*──────────────────────────── Inserts and searches ───────────────────────*/
+
+typedef struct {
+    quicpro_hnsw_t *h;
+    uint32_t        first;              /* The node of row 0 */
+} qp_hnsw_add_ctx;
+
+static void qp_hnsw_add_morsel(void *ctx, size_t morsel, int64_t begin, int64_t end)
+{
+    const qp_hnsw_add_ctx *x = ctx;
+    qp_hnsw_walk w;
+    qp_hnsw_walk_init(&w, x->h);
+    for (int64_t i = begin; i < end; i++) {
+        qp_hnsw_insert(&w, x->first + (uint32_t)i);
+    }
+    qp_hnsw_walk_free(&w);
+}
+
+static uint32_t qp_hnsw_draw_level(quicpro_hnsw_t *h)
+{
+    h->rng ^= h->rng << 13;
+    h->rng ^= h->rng >> 7;
+    h->rng ^= h->rng << 17;
+    double u = ((h->rng >> 11) + 1) * (1.0 / 9007199254740992.0);
+    return (uint32_t)MIN(-log(u) * h->level_mult, QP_HNSW_MAX_LAYER);
+}
+
+void quicpro_hnsw_add(quicpro_hnsw_t *h, const float *vectors, int64_t n, const int64_t *labels,
+                      const char *const *docs, const size_t *doc_lens)
+{
+    pthread_mutex_lock(&h->insert);
+    int64_t first = atomic_load_explicit(&h->count, memory_order_relaxed);
+    uint8_t *levels = pemalloc((size_t)MAX(n, 1), 1);
+    uint64_t upper = h->upper_len, doc_bytes = h->docs_len;
+    for (int64_t i = 0; i < n; i++) {
+        levels[i] = (uint8_t)qp_hnsw_draw_level(h);
+        upper += (uint64_t)levels[i] * (1 + h->max_up);
+        doc_bytes += docs && docs[i] ? doc_lens[i] : 0;
+    }
+    qp_hnsw_reserve(h, first + n, upper, doc_bytes);
+
+    pthread_rwlock_rdlock(&h->resize);
+    for (int64_t i = 0; i < n; i++) {
+        uint32_t node = (uint32_t)(first + i);
+        qp_hnsw_pack(h, node, vectors + (size_t)i * h->p.dims);
+        h->labels[node] = labels ? labels[i] : first + i;
+        h->levels[node] = levels[i];
+        h->upper_at[node] = h->upper_len;
+        memset(h->upper + h->upper_len, 0, (size_t)levels[i] * (1 + h->max_up) * sizeof(uint32_t));
+        h->upper_len += (uint64_t)levels[i] * (1 + h->max_up);
+        qp_hnsw_links(h, node, 0)[0] = 0;
+        if (docs && docs[i]) {
+            memcpy(h->docs + h->docs_len, docs[i], doc_lens[i]);
+            h->docs_len += doc_lens[i];
+        }
+        h->doc_at[node + 1] = h->docs_len;
+    }
+    pefree(levels, 1);
+    atomic_store_explicit(&h->count, first + n, memory_order_release);
+
+    /* The first node of an empty index is its entry point, linked to nothing */
+    int64_t from = 0;
+    if (n && atomic_load_explicit(&h->top, memory_order_acquire) == QP_HNSW_NONE) {
+        atomic_store_explicit(&h->top, (uint64_t)h->levels[first] << 32 | (uint64_t)first, memory_order_release);
+        from = 1;
+    }
+    qp_hnsw_add_ctx x = { h, (uint32_t)(first + from) };
+    quicpro_df_parallel(n - from, qp_hnsw_add_morsel, &x);
+    pthread_rwlock_unlock(&h->resize);
+    pthread_mutex_unlock(&h->insert);
+}
+
+typedef struct {
+    quicpro_hnsw_t *h;
+    const float    *queries;
+    uint32_t        k, ef;
+    int64_t        *nodes;
+    float          *scores;
+} qp_hnsw_search_ctx;
+
+static void qp_hnsw_search_morsel(void *ctx, size_t morsel, int64_t begin, int64_t end)
+{
+    const qp_hnsw_search_ctx *x = ctx;
+    quicpro_hnsw_t *h = x->h;
+    size_t d = h->p.dims;
+    qp_hnsw_walk w;
+    qp_hnsw_walk_init(&w, h);
+    for (int64_t i = begin; i < end; i++) {
+        int64_t *nodes = x->nodes + (size_t)i * x->k;
+        float *scores = x->scores + (size_t)i * x->k;
+        uint32_t found = 0;
+        uint64_t top = atomic_load_explicit(&h->top, memory_order_acquire);
+        if (top != QP_HNSW_NONE) {
+            const float *src = x->queries + (size_t)i * d;
+            float norm = 1;
+            if (h->p.metric == QUICPRO_GEO_COSINE) {
+                float n2 = quicpro_geo_dot_f32(src, src, d);
+                norm = n2 > 0 ? 1.0f / sqrtf(n2) : 0.0f;
+            }
+            for (size_t j = 0; j < d; j++) {
+                w.q[j] = src[j] * norm;
+            }
+            uint32_t cur = (uint32_t)top;
+            float dcur = qp_hnsw_dist(h, w.q, cur);
+            for (uint32_t layer = (uint32_t)(top >> 32); layer > 0; layer--) {
+                qp_hnsw_greedy(&w, w.q, &cur, &dcur, layer);
+            }
+            qp_hnsw_search_layer(&w, w.q, cur, dcur, x->ef, 0);
+            found = MIN(qp_hnsw_sorted(&w), x->k);
+        }
+        for (uint32_t j = 0; j < x->k; j++) {
+            if (j < found) {
+                float dist = w.items[j].d;
+                nodes[j] = w.items[j].node;
+                scores[j] = h->p.metric == QUICPRO_GEO_L2 ? sqrtf(MAX(dist, 0.0f)) : -dist;
+            } else {
+                nodes[j] = -1;
+                scores[j] = 0;
+            }
+        }
+    }
+    qp_hnsw_walk_free(&w);
+}
+
+void quicpro_hnsw_search(quicpro_hnsw_t *h, const float *queries, int64_t n, uint32_t k, uint32_t ef,
+                         int64_t *nodes, float *scores)
+{
+    qp_hnsw_search_ctx x = { h, queries, k, MAX(ef ? ef : h->p.ef_search, k), nodes, scores };
+    pthread_rwlock_rdlock(&h->resize);
+    quicpro_df_parallel(n, qp_hnsw_search_morsel, &x);
+    pthread_rwlock_unlock(&h->resize);
+}
+
+int64_t quicpro_hnsw_label(quicpro_hnsw_t *h, int64_t node)
+{
+    pthread_rwlock_rdlock(&h->resize);
+    int64_t label = h->labels[node];
+    pthread_rwlock_unlock(&h->resize);
+    return label;
+}
+
+void quicpro_hnsw_document(quicpro_hnsw_t *h, int64_t node, smart_str *into)
+{
+    pthread_rwlock_rdlock(&h->resize);
+    uint64_t from = h->doc_at[node], to = h->doc_at[node + 1];
+    if (to > from) {
+        smart_str_appendl(into, h->docs + from, (size_t)(to - from));
+    }
+    pthread_rwlock_unlock(&h->resize);
+}
+
+/*──────────────────────────── Files ──────────────────────────────────────*/
+
+/* The sections' sizes for this head */
+static void qp_hnsw_sizes(const quicpro_hnsw_t *h, uint64_t count, uint64_t *size)
+{
+    size[QP_LABELS] = count * sizeof(int64_t);
+    size[QP_LEVELS] = count;
+    size[QP_UPPER_AT] = count * sizeof(uint64_t);
+    size[QP_VECTORS] = count * h->vec_bytes;
+    size[QP_LINKS0] = count * (1 + h->max0) * sizeof(uint32_t);
+    size[QP_UPPER] = h->upper_len * sizeof(uint32_t);
+    size[QP_DOC_AT] = (count + 1) * sizeof(uint64_t);
+    size[QP_DOCS] = h->docs_len;
+}
+
+static bool qp_hnsw_write_all(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+    while (len) {
+        ssize_t w = write(fd, p, len);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        len -= (size_t)w;
+    }
+    return true;
+}
+
+bool quicpro_hnsw_save(quicpro_hnsw_t *h, const char *path, char *err, size_t err_len)
+{
+    char tmp[PATH_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid()) >= (int)sizeof(tmp)) {
+        snprintf(err, err_len, "index path too long");
+        return false;
+    }
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        snprintf(err, err_len, "cannot write %s: %s", tmp, strerror(errno));
+        return false;
+    }
+
+    pthread_rwlock_wrlock(&h->resize);
+    uint64_t count = (uint64_t)atomic_load_explicit(&h->count, memory_order_relaxed);
+    qp_hnsw_head head = { .dims = (uint32_t)h->p.dims, .metric = h->p.metric, .storage = h->p.storage, .m = h->p.m,
+                          .ef_construction = h->p.ef_construction, .ef_search = h->p.ef_search, .count = count,
+                          .top = atomic_load_explicit(&h->top, memory_order_relaxed), .upper_len = h->upper_len,
+                          .docs_len = h->docs_len };
+    memcpy(head.magic, QP_HNSW_MAGIC, sizeof(head.magic));
+    uint64_t size[8], at = ZEND_MM_ALIGNED_SIZE_EX(sizeof(head), QP_HNSW_ALIGN);
+    qp_hnsw_sizes(h, count, size);
+    for (int i = 0; i < 8; i++) {
+        head.at[i] = at;
+        at = ZEND_MM_ALIGNED_SIZE_EX(at + size[i], QP_HNSW_ALIGN);
+    }
+    const void *section[8] = { h->labels, h->levels, h->upper_at, h->vectors, h->links0, h->upper, h->doc_at, h->docs };
+    static const char pad[QP_HNSW_ALIGN];
+    bool ok = qp_hnsw_write_all(fd, &head, sizeof(head));
+    uint64_t written = sizeof(head);
+    for (int i = 0; i < 8 && ok; i++) {
+        ok = qp_hnsw_write_all(fd, pad, head.at[i] - written) && (!size[i] || qp_hnsw_write_all(fd, section[i], size[i]));
+        written = head.at[i] + size[i];
+    }
+    pthread_rwlock_unlock(&h->resize);
+
+    if (!ok || close(fd) < 0 || rename(tmp, path) < 0) {
+        snprintf(err, err_len, "cannot write %s: %s", path, strerror(errno));
+        if (!ok) close(fd);
+        unlink(tmp);
+        return false;
+    }
+    return true;
+}
+
+quicpro_hnsw_t *quicpro_hnsw_load(const char *path, char *err, size_t err_len)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        snprintf(err, err_len, "cannot open %s: %s", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(qp_hnsw_head)) {
+        snprintf(err, err_len, "%s is not a vector index", path);
+        close(fd);
+        return NULL;
+    }
+    /* Private: links an add() rewrites are copied on write, and never reach the file */
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        snprintf(err, err_len, "cannot map %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    const qp_hnsw_head *head = map;
+    quicpro_hnsw_params_t p = { head->dims, (quicpro_geo_metric_t)head->metric, (quicpro_hnsw_storage_t)head->storage,
+                                head->m, head->ef_construction, head->ef_search };
+    if (memcmp(head->magic, QP_HNSW_MAGIC, sizeof(head->magic)) != 0 || !p.dims || p.m < 2 || p.m > 1024
+        || head->metric > QUICPRO_GEO_L2 || head->storage > QUICPRO_HNSW_INT8 || head->count >= UINT32_MAX) {
+        snprintf(err, err_len, "%s is not a vector index", path);
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    quicpro_hnsw_t *h = qp_hnsw_alloc(&p);
+    h->upper_len = h->upper_cap = head->upper_len;
+    h->docs_len = h->docs_cap = head->docs_len;
+    uint64_t size[8];
+    qp_hnsw_sizes(h, head->count, size);
+    for (int i = 0; i < 8; i++) {
+        if (head->at[i] % QP_HNSW_ALIGN || head->at[i] > (uint64_t)st.st_size || size[i] > (uint64_t)st.st_size - head->at[i]) {
+            snprintf(err, err_len, "%s is truncated or corrupt", path);
+            munmap(map, (size_t)st.st_size);
+            quicpro_hnsw_release(h);
+            return NULL;
+        }
+    }
+    char *base = map;
+    h->labels = (int64_t *)(base + head->at[QP_LABELS]);
+    h->levels = (uint8_t *)(base + head->at[QP_LEVELS]);
+    h->upper_at = (uint64_t *)(base + head->at[QP_UPPER_AT]);
+    h->vectors = (uint8_t *)(base + head->at[QP_VECTORS]);
+    h->links0 = (uint32_t *)(base + head->at[QP_LINKS0]);
+    h->upper = (uint32_t *)(base + head->at[QP_UPPER]);
+    h->doc_at = (uint64_t *)(base + head->at[QP_DOC_AT]);
+    h->docs = base + head->at[QP_DOCS];
+    h->count = (int64_t)head->count;
+    h->capacity = (int64_t)head->count;
+    h->top = head->top;
+    h->locks = pecalloc((size_t)MAX(h->capacity, 1), sizeof(atomic_flag), 1);
+    h->map = map;
+    h->map_len = (size_t)st.st_size;
+    return h;
+}
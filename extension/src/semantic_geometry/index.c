@@ -0,0 +1,533 @@
+/*
+ * src/semantic_geometry/index.c – Quicpro\Geometry\Index
+ * ======================================================
+ *
+ * See include/semantic_geometry/index.h. The object holds a reference to
+ * the graph (semantic_geometry/hnsw.c), which lives in persistent memory:
+ * the process's table of shared indexes holds another, so a shared index
+ * outlives the request that built it.
+ */
+
+#include "php_quicpro.h"
+#include "semantic_geometry/index.h"
+#include "semantic_geometry/hnsw.h"
+#include "semantic_geometry/geometry.h"
+
+#include <ext/spl/spl_exceptions.h>
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+#include <string.h>
+
+#ifdef ZTS
+# include <TSRM.h>
+static MUTEX_T qp_index_mutex = NULL;
+# define SHARED_LOCK()   tsrm_mutex_lock(qp_index_mutex)
+# define SHARED_UNLOCK() tsrm_mutex_unlock(qp_index_mutex)
+#else
+# define SHARED_LOCK()   /* noop */
+# define SHARED_UNLOCK() /* noop */
+#endif
+
+typedef struct {
+    quicpro_hnsw_t *h;                  /* NULL until constructed */
+    zend_object     std;
+} quicpro_geometry_index_object;
+
+zend_class_entry *quicpro_ce_geometry_index;
+static zend_object_handlers quicpro_geometry_index_handlers;
+static HashTable qp_index_shared;       /* name => quicpro_hnsw_t * */
+
+static inline quicpro_geometry_index_object *qp_index_from_obj(zend_object *obj)
+{
+    return (quicpro_geometry_index_object *)((char *)obj - XtOffsetOf(quicpro_geometry_index_object, std));
+}
+
+/* The graph of this object, or NULL with an exception thrown */
+static quicpro_hnsw_t *qp_index_this(zval *this_zv)
+{
+    quicpro_hnsw_t *h = qp_index_from_obj(Z_OBJ_P(this_zv))->h;
+    if (!h) {
+        zend_throw_exception_ex(NULL, 0, "Index was not constructed");
+    }
+    return h;
+}
+
+static void qp_index_wrap(zval *out, quicpro_hnsw_t *h)
+{
+    object_init_ex(out, quicpro_ce_geometry_index);
+    qp_index_from_obj(Z_OBJ_P(out))->h = h;
+}
+
+static bool qp_index_option_long(HashTable *options, const char *key, zend_long min, zend_long max, uint32_t *out)
+{
+    zval *zv = options ? zend_hash_str_find(options, key, strlen(key)) : NULL;
+    if (!zv) {
+        return true;
+    }
+    if (Z_TYPE_P(zv) != IS_LONG || Z_LVAL_P(zv) < min || Z_LVAL_P(zv) > max) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Index option '%s' must be an integer within %" ZEND_LONG_FMT_SPEC "..%" ZEND_LONG_FMT_SPEC, key, min, max);
+        return false;
+    }
+    *out = (uint32_t)Z_LVAL_P(zv);
+    return true;
+}
+
+/* Searches `h` for the rows of `q`; the results as a list of [label => score] per row */
+static void qp_index_results(quicpro_hnsw_t *h, const float *q, int64_t rows, uint32_t k, uint32_t ef, zval *out)
+{
+    int64_t *nodes = safe_emalloc((size_t)rows, k * sizeof(int64_t), 0);
+    float *scores = safe_emalloc((size_t)rows, k * sizeof(float), 0);
+    quicpro_hnsw_search(h, q, rows, k, ef, nodes, scores);
+    array_init_size(out, (uint32_t)rows);
+    for (int64_t i = 0; i < rows; i++) {
+        zval best;
+        array_init_size(&best, k);
+        for (uint32_t j = 0; j < k && nodes[(size_t)i * k + j] >= 0; j++) {
+            add_index_double(&best, (zend_ulong)quicpro_hnsw_label(h, nodes[(size_t)i * k + j]), scores[(size_t)i * k + j]);
+        }
+        add_next_index_zval(out, &best);
+    }
+    efree(nodes);
+    efree(scores);
+}
+
+/*──────────────────────────── Methods ────────────────────────────────────*/
+
+PHP_METHOD(QuicproGeometryIndex, __construct)
+{
+    zend_long dims;
+    HashTable *options = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_LONG(dims)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_ARRAY_HT(options)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_geometry_index_object *o = qp_index_from_obj(Z_OBJ_P(ZEND_THIS));
+    if (o->h) {
+        zend_throw_exception_ex(NULL, 0, "Index was already constructed");
+        RETURN_THROWS();
+    }
+    if (dims < 1 || dims > 65536) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Index dims must be within 1..65536");
+        RETURN_THROWS();
+    }
+    quicpro_hnsw_params_t p = { (size_t)dims, QUICPRO_GEO_COSINE, QUICPRO_HNSW_FLOAT32, 16, 200, 64 };
+    zval *zv;
+    if (options && (zv = zend_hash_str_find(options, "metric", sizeof("metric") - 1))) {
+        if (Z_TYPE_P(zv) != IS_STRING || !quicpro_geo_metric_parse(Z_STR_P(zv), &p.metric)) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Index option 'metric' must be cosine, dot or l2");
+            RETURN_THROWS();
+        }
+    }
+    if (options && (zv = zend_hash_str_find(options, "storage", sizeof("storage") - 1))) {
+        if (Z_TYPE_P(zv) == IS_STRING && zend_string_equals_literal(Z_STR_P(zv), "float32")) {
+            p.storage = QUICPRO_HNSW_FLOAT32;
+        } else if (Z_TYPE_P(zv) == IS_STRING && zend_string_equals_literal(Z_STR_P(zv), "int8")) {
+            p.storage = QUICPRO_HNSW_INT8;
+        } else {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Index option 'storage' must be float32 or int8");
+            RETURN_THROWS();
+        }
+    }
+    if (!qp_index_option_long(options, "m", 2, 1024, &p.m)
+        || !qp_index_option_long(options, "ef_construction", 1, 65535, &p.ef_construction)
+        || !qp_index_option_long(options, "ef_search", 1, 65535, &p.ef_search)) {
+        RETURN_THROWS();
+    }
+    o->h = quicpro_hnsw_new(&p);
+}
+
+/* An index written by save(), mapped rather than read */
+PHP_METHOD(QuicproGeometryIndex, load)
+{
+    zend_string *path;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_PATH_STR(path)
+    ZEND_PARSE_PARAMETERS_END();
+
+    char err[PATH_MAX + 128];
+    quicpro_hnsw_t *h = quicpro_hnsw_load(ZSTR_VAL(path), err, sizeof(err));
+    if (!h) {
+        zend_throw_exception_ex(NULL, 0, "Index::load(): %s", err);
+        RETURN_THROWS();
+    }
+    qp_index_wrap(return_value, h);
+}
+
+PHP_METHOD(QuicproGeometryIndex, save)
+{
+    zend_string *path;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_PATH_STR(path)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_hnsw_t *h = qp_index_this(ZEND_THIS);
+    char err[PATH_MAX + 128];
+    if (!h) {
+        RETURN_THROWS();
+    }
+    if (!quicpro_hnsw_save(h, ZSTR_VAL(path), err, sizeof(err))) {
+        zend_throw_exception_ex(NULL, 0, "Index::save(): %s", err);
+        RETURN_THROWS();
+    }
+}
+
+/* Inserts the rows of `vectors`, labelled `ids` (default: their positions) and kept with `documents`; the count after */
+PHP_METHOD(QuicproGeometryIndex, add)
+{
+    zval *zm;
+    HashTable *ids = NULL, *documents = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 3)
+        Z_PARAM_OBJECT_OF_CLASS(zm, quicpro_ce_geometry_matrix)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_ARRAY_HT_OR_NULL(ids)
+        Z_PARAM_ARRAY_HT_OR_NULL(documents)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_hnsw_t *h = qp_index_this(ZEND_THIS);
+    if (!h) {
+        RETURN_THROWS();
+    }
+    const quicpro_geometry_matrix_object *m = quicpro_geometry_matrix_from_obj(Z_OBJ_P(zm));
+    if (m->dims != quicpro_hnsw_params(h)->dims) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Index of %zu dimensions cannot take rows of %zu", quicpro_hnsw_params(h)->dims, m->dims);
+        RETURN_THROWS();
+    }
+    if ((ids && zend_hash_num_elements(ids) != m->rows) || (documents && zend_hash_num_elements(documents) != m->rows)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Index::add() takes one id and one document per row");
+        RETURN_THROWS();
+    }
+    if (quicpro_hnsw_count(h) + m->rows >= UINT32_MAX) {
+        zend_throw_exception_ex(NULL, 0, "Index is full");
+        RETURN_THROWS();
+    }
+
+    int64_t *labels = ids ? safe_emalloc((size_t)m->rows, sizeof(int64_t), 0) : NULL;
+    const char **docs = documents ? safe_emalloc((size_t)m->rows, sizeof(char *), 0) : NULL;
+    size_t *doc_lens = documents ? safe_emalloc((size_t)m->rows, sizeof(size_t), 0) : NULL;
+    bool bad = false;
+    uint32_t i = 0;
+    zval *zv;
+    if (ids) {
+        ZEND_HASH_FOREACH_VAL(ids, zv) {
+            if (Z_TYPE_P(zv) != IS_LONG || Z_LVAL_P(zv) < 0) {
+                bad = true;
+                break;
+            }
+            labels[i++] = Z_LVAL_P(zv);
+        } ZEND_HASH_FOREACH_END();
+    }
+    i = 0;
+    if (documents && !bad) {
+        ZEND_HASH_FOREACH_VAL(documents, zv) {
+            if (Z_TYPE_P(zv) == IS_STRING) {
+                docs[i] = Z_STRVAL_P(zv);
+                doc_lens[i] = Z_STRLEN_P(zv);
+            } else if (Z_TYPE_P(zv) == IS_NULL) {
+                docs[i] = NULL;
+            } else {
+                bad = true;
+                break;
+            }
+            i++;
+        } ZEND_HASH_FOREACH_END();
+    }
+    if (!bad) {
+        quicpro_hnsw_add(h, m->data, m->rows, labels, docs, doc_lens);
+    }
+    if (labels) efree(labels);
+    if (docs) efree(docs);
+    if (doc_lens) efree(doc_lens);
+    if (bad) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Index::add() takes non-negative integer ids and string (or null) documents");
+        RETURN_THROWS();
+    }
+    RETURN_LONG((zend_long)quicpro_hnsw_count(h));
+}
+
+/* For each row of `queries`, the `k` nearest as [id => score], best first */
+PHP_METHOD(QuicproGeometryIndex, search)
+{
+    zval *zm;
+    zend_long k = 10, ef = 0;
+    bool ef_null = true;
+
+    ZEND_PARSE_PARAMETERS_START(1, 3)
+        Z_PARAM_OBJECT_OF_CLASS(zm, quicpro_ce_geometry_matrix)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(k)
+        Z_PARAM_LONG_OR_NULL(ef, ef_null)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_hnsw_t *h = qp_index_this(ZEND_THIS);
+    if (!h) {
+        RETURN_THROWS();
+    }
+    const quicpro_geometry_matrix_object *m = quicpro_geometry_matrix_from_obj(Z_OBJ_P(zm));
+    if (m->dims != quicpro_hnsw_params(h)->dims) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Index of %zu dimensions cannot be searched for rows of %zu", quicpro_hnsw_params(h)->dims, m->dims);
+        RETURN_THROWS();
+    }
+    if (k < 1 || k > 65535 || (!ef_null && (ef < 1 || ef > 65535))) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Index::search() k and ef must be within 1..65535");
+        RETURN_THROWS();
+    }
+    qp_index_results(h, m->data, m->rows, (uint32_t)k, ef_null ? 0 : (uint32_t)ef, return_value);
+}
+
+PHP_METHOD(QuicproGeometryIndex, count)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_hnsw_t *h = qp_index_this(ZEND_THIS);
+    if (!h) {
+        RETURN_THROWS();
+    }
+    RETURN_LONG((zend_long)quicpro_hnsw_count(h));
+}
+
+PHP_METHOD(QuicproGeometryIndex, dims)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_hnsw_t *h = qp_index_this(ZEND_THIS);
+    if (!h) {
+        RETURN_THROWS();
+    }
+    RETURN_LONG((zend_long)quicpro_hnsw_params(h)->dims);
+}
+
+/* Makes the index known to this process as `name`, replacing any shared so before */
+PHP_METHOD(QuicproGeometryIndex, share)
+{
+    zend_string *name;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_hnsw_t *h = qp_index_this(ZEND_THIS);
+    if (!h) {
+        RETURN_THROWS();
+    }
+    quicpro_hnsw_retain(h);
+    SHARED_LOCK();
+    zend_hash_str_update_ptr(&qp_index_shared, ZSTR_VAL(name), ZSTR_LEN(name), h);
+    SHARED_UNLOCK();
+}
+
+/* The index shared as `name`, or null */
+PHP_METHOD(QuicproGeometryIndex, shared)
+{
+    zend_string *name;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    SHARED_LOCK();
+    quicpro_hnsw_t *h = zend_hash_str_find_ptr(&qp_index_shared, ZSTR_VAL(name), ZSTR_LEN(name));
+    if (h) {
+        quicpro_hnsw_retain(h);
+    }
+    SHARED_UNLOCK();
+    if (!h) {
+        RETURN_NULL();
+    }
+    qp_index_wrap(return_value, h);
+}
+
+/*──────────────────────────── Retrieval ──────────────────────────────────*/
+
+bool quicpro_geometry_index_retrieve(const char *name, size_t name_len, zval *query, zend_long k, zval *out)
+{
+    SHARED_LOCK();
+    quicpro_hnsw_t *h = zend_hash_str_find_ptr(&qp_index_shared, name, name_len);
+    if (h) {
+        quicpro_hnsw_retain(h);
+    }
+    SHARED_UNLOCK();
+    if (!h) {
+        zend_throw_exception_ex(NULL, 0, "No vector index is shared as '%.*s'; see Quicpro\\Geometry\\Index::share()",
+            (int)name_len, name);
+        return false;
+    }
+
+    size_t dims = quicpro_hnsw_params(h)->dims;
+    float *q = safe_emalloc(dims, sizeof(float), 0);
+    bool ok = true;
+    ZVAL_DEREF(query);
+    if (Z_TYPE_P(query) == IS_OBJECT && instanceof_function(Z_OBJCE_P(query), quicpro_ce_geometry_matrix)) {
+        const quicpro_geometry_matrix_object *m = quicpro_geometry_matrix_from_obj(Z_OBJ_P(query));
+        ok = m->dims == dims && m->rows > 0;
+        if (ok) {
+            memcpy(q, m->data, dims * sizeof(float));
+        }
+    } else if (Z_TYPE_P(query) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL_P(query)) == dims) {
+        size_t i = 0;
+        zval *v;
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(query), v) {
+            if (Z_TYPE_P(v) != IS_DOUBLE && Z_TYPE_P(v) != IS_LONG) {
+                ok = false;
+                break;
+            }
+            q[i++] = (float)zval_get_double(v);
+        } ZEND_HASH_FOREACH_END();
+    } else {
+        ok = false;
+    }
+    if (!ok) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Query for vector index '%.*s' must be a Quicpro\\Geometry\\Matrix or a list of %zu numbers",
+            (int)name_len, name, dims);
+        efree(q);
+        quicpro_hnsw_release(h);
+        return false;
+    }
+
+    uint32_t n = (uint32_t)MAX(1, MIN(k, 65535));
+    if (!quicpro_hnsw_has_documents(h)) {
+        zval all;
+        qp_index_results(h, q, 1, n, 0, &all);
+        ZVAL_COPY(out, zend_hash_index_find(Z_ARRVAL(all), 0));
+        zval_ptr_dtor(&all);
+    } else {
+        int64_t *nodes = safe_emalloc(n, sizeof(int64_t), 0);
+        float *scores = safe_emalloc(n, sizeof(float), 0);
+        smart_str text = {0};
+        quicpro_hnsw_search(h, q, 1, n, 0, nodes, scores);
+        for (uint32_t i = 0; i < n && nodes[i] >= 0; i++) {
+            if (text.s && ZSTR_LEN(text.s)) {
+                smart_str_appendl(&text, "\n\n", 2);
+            }
+            quicpro_hnsw_document(h, nodes[i], &text);
+        }
+        smart_str_0(&text);
+        if (text.s) {
+            ZVAL_STR(out, text.s);
+        } else {
+            ZVAL_EMPTY_STRING(out);
+        }
+        efree(nodes);
+        efree(scores);
+    }
+    efree(q);
+    quicpro_hnsw_release(h);
+    return true;
+}
+
+/*──────────────────────────── Life cycle ─────────────────────────────────*/
+
+static zend_object *qp_index_create(zend_class_entry *ce)
+{
+    quicpro_geometry_index_object *o = zend_object_alloc(sizeof(quicpro_geometry_index_object), ce);
+    zend_object_std_init(&o->std, ce);
+    object_properties_init(&o->std, ce);
+    o->std.handlers = &quicpro_geometry_index_handlers;
+    return &o->std;
+}
+
+static void qp_index_free_obj(zend_object *obj)
+{
+    quicpro_geometry_index_object *o = qp_index_from_obj(obj);
+    if (o->h) {
+        quicpro_hnsw_release(o->h);
+    }
+    zend_object_std_dtor(obj);
+}
+
+static void qp_index_shared_dtor(zval *zv)
+{
+    quicpro_hnsw_release(Z_PTR_P(zv));
+}
+
+/*──────────────────────────── Registration ───────────────────────────────*/
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_geometry_index_construct, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, dims, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, options, IS_ARRAY, 0, "[]")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_geometry_index_load, 0, 1, Quicpro\\Geometry\\Index, 0)
+    ZEND_ARG_TYPE_INFO(0, path, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_index_save, 0, 1, IS_VOID, 0)
+    ZEND_ARG_TYPE_INFO(0, path, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_index_add, 0, 1, IS_LONG, 0)
+    ZEND_ARG_OBJ_INFO(0, vectors, Quicpro\\Geometry\\Matrix, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, ids, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, documents, IS_ARRAY, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_index_search, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_OBJ_INFO(0, queries, Quicpro\\Geometry\\Matrix, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, k, IS_LONG, 0, "10")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, ef, IS_LONG, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_index_count, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_quicpro_geometry_index_dims arginfo_quicpro_geometry_index_count
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_index_share, 0, 1, IS_VOID, 0)
+    ZEND_ARG_TYPE_INFO(0, name, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_geometry_index_shared, 0, 1, Quicpro\\Geometry\\Index, 1)
+    ZEND_ARG_TYPE_INFO(0, name, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry quicpro_geometry_index_methods[] = {
+    PHP_ME(QuicproGeometryIndex, __construct, arginfo_quicpro_geometry_index_construct, ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryIndex, load,        arginfo_quicpro_geometry_index_load,      ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_ME(QuicproGeometryIndex, save,        arginfo_quicpro_geometry_index_save,      ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryIndex, add,         arginfo_quicpro_geometry_index_add,       ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryIndex, search,      arginfo_quicpro_geometry_index_search,    ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryIndex, count,       arginfo_quicpro_geometry_index_count,     ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryIndex, dims,        arginfo_quicpro_geometry_index_dims,      ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryIndex, share,       arginfo_quicpro_geometry_index_share,     ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometryIndex, shared,      arginfo_quicpro_geometry_index_shared,    ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_FE_END
+};
+
+void quicpro_geometry_index_minit(void)
+{
+    zend_class_entry ce;
+    INIT_NS_CLASS_ENTRY(ce, "Quicpro\\Geometry", "Index", quicpro_geometry_index_methods);
+    quicpro_ce_geometry_index = zend_register_internal_class(&ce);
+    quicpro_ce_geometry_index->ce_flags |= ZEND_ACC_FINAL;
+#ifdef ZEND_ACC_NO_DYNAMIC_PROPERTIES
+    quicpro_ce_geometry_index->ce_flags |= ZEND_ACC_NO_DYNAMIC_PROPERTIES;
+#endif
+    quicpro_ce_geometry_index->create_object = qp_index_create;
+
+    memcpy(&quicpro_geometry_index_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    quicpro_geometry_index_handlers.offset = XtOffsetOf(quicpro_geometry_index_object, std);
+    quicpro_geometry_index_handlers.free_obj = qp_index_free_obj;
+    quicpro_geometry_index_handlers.clone_obj = NULL;
+
+    zend_hash_init(&qp_index_shared, 8, NULL, qp_index_shared_dtor, 1);
+#ifdef ZTS
+    qp_index_mutex = tsrm_mutex_alloc();
+#endif
+}
+
+void quicpro_geometry_index_mshutdown(void)
+{
+    zend_hash_destroy(&qp_index_shared);
+#ifdef ZTS
+    tsrm_mutex_free(qp_index_mutex);
+    qp_index_mutex = NULL;
+#endif
+}
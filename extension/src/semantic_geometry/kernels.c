@@ -0,0 +1,541 @@
+/*
+ * src/semantic_geometry/kernels.c – Vector similarity over float32 matrices
+ * ========================================================================
+ *
+ * See include/semantic_geometry/kernels.h. Two primitives do the work, a
+ * dot product and a squared distance of two rows, each in a float32 and a
+ * widening float64 form; the rest is blocking and bookkeeping. A block is
+ * one morsel of the DataFrame pool: blocks of the larger matrix's rows are
+ * small enough to stay in cache against every row of the other, and few
+ * enough (QP_GEO_MAX_BLOCKS) for their partial results to be cheap. 32-bit
+ * ARM takes the scalar loops.
+ */
+
+#include "php_quicpro.h"
+#include "semantic_geometry/kernels.h"
+#include "dataframe/morsel.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+# include <arm_neon.h>
+# define QP_GEO_NEON 1
+#endif
+
+#define QP_GEO_BLOCK_BYTES (256 * 1024)
+#define QP_GEO_MAX_BLOCKS  256
+
+bool quicpro_geo_metric_parse(const zend_string *name, quicpro_geo_metric_t *out)
+{
+    static const char *const names[] = { "cosine", "dot", "l2" };
+    for (int i = 0; i < 3; i++) {
+        if (ZSTR_LEN(name) == strlen(names[i]) && memcmp(ZSTR_VAL(name), names[i], ZSTR_LEN(name)) == 0) {
+            *out = (quicpro_geo_metric_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*──────────────────────────── Primitives ─────────────────────────────────*/
+
+#if defined(__AVX2__) && !defined(__AVX512F__)
+# if defined(__FMA__)
+#  define QP_GEO_FMA_PS(a, b, acc) _mm256_fmadd_ps(a, b, acc)
+#  define QP_GEO_FMA_PD(a, b, acc) _mm256_fmadd_pd(a, b, acc)
+# else
+#  define QP_GEO_FMA_PS(a, b, acc) _mm256_add_ps(_mm256_mul_ps(a, b), acc)
+#  define QP_GEO_FMA_PD(a, b, acc) _mm256_add_pd(_mm256_mul_pd(a, b), acc)
+# endif
+
+static inline float qp_geo_hsum_ps(__m256 v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+static inline double qp_geo_hsum_pd(__m256d v)
+{
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+#endif
+
+static inline float qp_geo_dot(const float *a, const float *b, size_t d)
+{
+    size_t i = 0;
+    float sum = 0;
+#if defined(__AVX512F__)
+    __m512 acc = _mm512_setzero_ps();
+    for (; i + 16 <= d; i += 16) {
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc);
+    }
+    sum = _mm512_reduce_add_ps(acc);
+#elif defined(__AVX2__)
+    /* Two chains, so that one add's latency hides behind the other */
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= d; i += 16) {
+        acc0 = QP_GEO_FMA_PS(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = QP_GEO_FMA_PS(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= d; i += 8) {
+        acc0 = QP_GEO_FMA_PS(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    sum = qp_geo_hsum_ps(_mm256_add_ps(acc0, acc1));
+#elif defined(QP_GEO_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0), acc1 = vdupq_n_f32(0);
+    for (; i + 8 <= d; i += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+    for (; i < d; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static inline double qp_geo_dot_wide(const float *a, const float *b, size_t d)
+{
+    size_t i = 0;
+    double sum = 0;
+#if defined(__AVX512F__)
+    __m512d acc = _mm512_setzero_pd();
+    for (; i + 8 <= d; i += 8) {
+        acc = _mm512_fmadd_pd(_mm512_cvtps_pd(_mm256_loadu_ps(a + i)), _mm512_cvtps_pd(_mm256_loadu_ps(b + i)), acc);
+    }
+    sum = _mm512_reduce_add_pd(acc);
+#elif defined(__AVX2__)
+    __m256d acc = _mm256_setzero_pd();
+    for (; i + 4 <= d; i += 4) {
+        acc = QP_GEO_FMA_PD(_mm256_cvtps_pd(_mm_loadu_ps(a + i)), _mm256_cvtps_pd(_mm_loadu_ps(b + i)), acc);
+    }
+    sum = qp_geo_hsum_pd(acc);
+#elif defined(QP_GEO_NEON)
+    float64x2_t acc = vdupq_n_f64(0);
+    for (; i + 2 <= d; i += 2) {
+        acc = vfmaq_f64(acc, vcvt_f64_f32(vld1_f32(a + i)), vcvt_f64_f32(vld1_f32(b + i)));
+    }
+    sum = vaddvq_f64(acc);
+#endif
+    for (; i < d; i++) {
+        sum += (double)a[i] * b[i];
+    }
+    return sum;
+}
+
+static inline float qp_geo_sq(const float *a, const float *b, size_t d)
+{
+    size_t i = 0;
+    float sum = 0;
+#if defined(__AVX512F__)
+    __m512 acc = _mm512_setzero_ps();
+    for (; i + 16 <= d; i += 16) {
+        __m512 diff = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        acc = _mm512_fmadd_ps(diff, diff, acc);
+    }
+    sum = _mm512_reduce_add_ps(acc);
+#elif defined(__AVX2__)
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= d; i += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        acc0 = QP_GEO_FMA_PS(d0, d0, acc0);
+        acc1 = QP_GEO_FMA_PS(d1, d1, acc1);
+    }
+    for (; i + 8 <= d; i += 8) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        acc0 = QP_GEO_FMA_PS(d0, d0, acc0);
+    }
+    sum = qp_geo_hsum_ps(_mm256_add_ps(acc0, acc1));
+#elif defined(QP_GEO_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0), acc1 = vdupq_n_f32(0);
+    for (; i + 8 <= d; i += 8) {
+        float32x4_t d0 = vsubq_f32(vld1q_f32(a + i), vld1q_f32(b + i));
+        float32x4_t d1 = vsubq_f32(vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        acc0 = vfmaq_f32(acc0, d0, d0);
+        acc1 = vfmaq_f32(acc1, d1, d1);
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+    for (; i < d; i++) {
+        float diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+static inline double qp_geo_sq_wide(const float *a, const float *b, size_t d)
+{
+    size_t i = 0;
+    double sum = 0;
+#if defined(__AVX512F__)
+    __m512d acc = _mm512_setzero_pd();
+    for (; i + 8 <= d; i += 8) {
+        __m512d diff = _mm512_sub_pd(_mm512_cvtps_pd(_mm256_loadu_ps(a + i)), _mm512_cvtps_pd(_mm256_loadu_ps(b + i)));
+        acc = _mm512_fmadd_pd(diff, diff, acc);
+    }
+    sum = _mm512_reduce_add_pd(acc);
+#elif defined(__AVX2__)
+    __m256d acc = _mm256_setzero_pd();
+    for (; i + 4 <= d; i += 4) {
+        __m256d diff = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + i)), _mm256_cvtps_pd(_mm_loadu_ps(b + i)));
+        acc = QP_GEO_FMA_PD(diff, diff, acc);
+    }
+    sum = qp_geo_hsum_pd(acc);
+#elif defined(QP_GEO_NEON)
+    float64x2_t acc = vdupq_n_f64(0);
+    for (; i + 2 <= d; i += 2) {
+        float64x2_t diff = vsubq_f64(vcvt_f64_f32(vld1_f32(a + i)), vcvt_f64_f32(vld1_f32(b + i)));
+        acc = vfmaq_f64(acc, diff, diff);
+    }
+    sum = vaddvq_f64(acc);
+#endif
+    for (; i < d; i++) {
+        double diff = (double)a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+/*──────────────────────────── Single pairs ───────────────────────────────*/
+
+float quicpro_geo_dot_f32(const float *a, const float *b, size_t dims)
+{
+    return qp_geo_dot(a, b, dims);
+}
+
+float quicpro_geo_sq_f32(const float *a, const float *b, size_t dims)
+{
+    return qp_geo_sq(a, b, dims);
+}
+
+/* The int8 lanes widen to int32 and then to float32, so they share the float32 accumulation */
+float quicpro_geo_dot_i8(const float *a, const int8_t *b, size_t dims)
+{
+    size_t i = 0;
+    float sum = 0;
+#if defined(__AVX512F__)
+    __m512 acc = _mm512_setzero_ps();
+    for (; i + 16 <= dims; i += 16) {
+        __m512 bf = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(b + i))));
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), bf, acc);
+    }
+    sum = _mm512_reduce_add_ps(acc);
+#elif defined(__AVX2__)
+    __m256 acc = _mm256_setzero_ps();
+    for (; i + 8 <= dims; i += 8) {
+        __m256 bf = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(b + i))));
+        acc = QP_GEO_FMA_PS(_mm256_loadu_ps(a + i), bf, acc);
+    }
+    sum = qp_geo_hsum_ps(acc);
+#elif defined(QP_GEO_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0), acc1 = vdupq_n_f32(0);
+    for (; i + 8 <= dims; i += 8) {
+        int16x8_t w = vmovl_s8(vld1_s8(b + i));
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vcvtq_f32_s32(vmovl_s16(vget_low_s16(w))));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vcvtq_f32_s32(vmovl_s16(vget_high_s16(w))));
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+    for (; i < dims; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+float quicpro_geo_sq_i8(const float *a, const int8_t *b, float scale, size_t dims)
+{
+    size_t i = 0;
+    float sum = 0;
+#if defined(__AVX512F__)
+    __m512 acc = _mm512_setzero_ps(), s = _mm512_set1_ps(scale);
+    for (; i + 16 <= dims; i += 16) {
+        __m512 bf = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(b + i))));
+        __m512 diff = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_mul_ps(bf, s));
+        acc = _mm512_fmadd_ps(diff, diff, acc);
+    }
+    sum = _mm512_reduce_add_ps(acc);
+#elif defined(__AVX2__)
+    __m256 acc = _mm256_setzero_ps(), s = _mm256_set1_ps(scale);
+    for (; i + 8 <= dims; i += 8) {
+        __m256 bf = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(b + i))));
+        __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_mul_ps(bf, s));
+        acc = QP_GEO_FMA_PS(diff, diff, acc);
+    }
+    sum = qp_geo_hsum_ps(acc);
+#elif defined(QP_GEO_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0), acc1 = vdupq_n_f32(0);
+    for (; i + 8 <= dims; i += 8) {
+        int16x8_t w = vmovl_s8(vld1_s8(b + i));
+        float32x4_t d0 = vsubq_f32(vld1q_f32(a + i), vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(w))), scale));
+        float32x4_t d1 = vsubq_f32(vld1q_f32(a + i + 4), vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(w))), scale));
+        acc0 = vfmaq_f32(acc0, d0, d0);
+        acc1 = vfmaq_f32(acc1, d1, d1);
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+    for (; i < dims; i++) {
+        float diff = a[i] - b[i] * scale;
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+/*──────────────────────────── Blocks ─────────────────────────────────────*/
+
+/* Rows per block of a matrix of `rows` rows: a cache-sized slice, or more so that there are at most QP_GEO_MAX_BLOCKS */
+static int64_t qp_geo_block_rows(int64_t rows, size_t dims)
+{
+    int64_t fit = MAX(16, (int64_t)(QP_GEO_BLOCK_BYTES / (dims * sizeof(float))));
+    return MAX(fit, (rows + QP_GEO_MAX_BLOCKS - 1) / QP_GEO_MAX_BLOCKS);
+}
+
+/* One morsel per block: the pool counts rows, these kernels count blocks */
+static void qp_geo_parallel(int64_t blocks, quicpro_df_morsel_fn fn, void *ctx)
+{
+    quicpro_df_parallel(blocks * QUICPRO_DF_MORSEL_ROWS, fn, ctx);
+}
+
+typedef struct {
+    const quicpro_geo_matrix_t *q, *c;
+    quicpro_geo_metric_t        metric;
+    bool                        wide;
+    int64_t                     block_rows;     /* Of c */
+    const float                *q_inv, *c_inv;  /* cosine: 1 / |row|, 0 for a zero row */
+    float                      *out;            /* scores */
+    uint32_t                    k;              /* nearest: a best-first list per block and query */
+    float                      *keys;
+    int64_t                    *idx;
+} qp_geo_ctx;
+
+/* The score of row qi of q against row cj of c */
+static inline float qp_geo_score(const qp_geo_ctx *x, int64_t qi, int64_t cj)
+{
+    size_t d = x->q->dims;
+    const float *a = x->q->data + (size_t)qi * d, *b = x->c->data + (size_t)cj * d;
+    switch (x->metric) {
+        case QUICPRO_GEO_COSINE:
+            return (x->wide ? (float)qp_geo_dot_wide(a, b, d) : qp_geo_dot(a, b, d)) * x->q_inv[qi] * x->c_inv[cj];
+        case QUICPRO_GEO_DOT:
+            return x->wide ? (float)qp_geo_dot_wide(a, b, d) : qp_geo_dot(a, b, d);
+        default:
+            return x->wide ? (float)sqrt(qp_geo_sq_wide(a, b, d)) : sqrtf(qp_geo_sq(a, b, d));
+    }
+}
+
+typedef struct {
+    const quicpro_geo_matrix_t *m;
+    bool                        wide;
+    int64_t                     block_rows;
+    float                      *inv;
+} qp_geo_norm_ctx;
+
+static void qp_geo_norm_block(void *ctx, size_t block, int64_t begin, int64_t end)
+{
+    const qp_geo_norm_ctx *x = ctx;
+    int64_t from = (int64_t)block * x->block_rows, to = MIN(from + x->block_rows, x->m->rows);
+    size_t d = x->m->dims;
+    for (int64_t i = from; i < to; i++) {
+        const float *r = x->m->data + (size_t)i * d;
+        double n = x->wide ? qp_geo_dot_wide(r, r, d) : qp_geo_dot(r, r, d);
+        x->inv[i] = n > 0 ? (float)(1.0 / sqrt(n)) : 0.0f;
+    }
+}
+
+/* 1 / |row| of every row of `m`, for cosine; emalloc'd */
+static float *qp_geo_inverse_norms(const quicpro_geo_matrix_t *m, bool wide)
+{
+    qp_geo_norm_ctx x = { m, wide, qp_geo_block_rows(m->rows, m->dims), safe_emalloc((size_t)MAX(m->rows, 1), sizeof(float), 0) };
+    qp_geo_parallel((m->rows + x.block_rows - 1) / x.block_rows, qp_geo_norm_block, &x);
+    return x.inv;
+}
+
+/*──────────────────────────── Scores and nearest rows ────────────────────*/
+
+static void qp_geo_scores_block(void *ctx, size_t block, int64_t begin, int64_t end)
+{
+    const qp_geo_ctx *x = ctx;
+    int64_t from = (int64_t)block * x->block_rows, to = MIN(from + x->block_rows, x->c->rows);
+    for (int64_t qi = 0; qi < x->q->rows; qi++) {
+        float *row = x->out + (size_t)qi * (size_t)x->c->rows;
+        for (int64_t cj = from; cj < to; cj++) {
+            row[cj] = qp_geo_score(x, qi, cj);
+        }
+    }
+}
+
+static void qp_geo_prepare(qp_geo_ctx *x, const quicpro_geo_matrix_t *q, const quicpro_geo_matrix_t *c,
+                           quicpro_geo_metric_t metric, bool wide)
+{
+    memset(x, 0, sizeof(*x));
+    x->q = q;
+    x->c = c;
+    x->metric = metric;
+    x->wide = wide;
+    x->block_rows = qp_geo_block_rows(c->rows, c->dims);
+    if (metric == QUICPRO_GEO_COSINE) {
+        x->q_inv = qp_geo_inverse_norms(q, wide);
+        x->c_inv = qp_geo_inverse_norms(c, wide);
+    }
+}
+
+static void qp_geo_release(qp_geo_ctx *x)
+{
+    if (x->q_inv) {
+        efree((void *)x->q_inv);
+        efree((void *)x->c_inv);
+    }
+}
+
+void quicpro_geo_scores(const quicpro_geo_matrix_t *q, const quicpro_geo_matrix_t *c, quicpro_geo_metric_t metric,
+                        bool wide, float *out)
+{
+    qp_geo_ctx x;
+    qp_geo_prepare(&x, q, c, metric, wide);
+    x.out = out;
+    qp_geo_parallel((c->rows + x.block_rows - 1) / x.block_rows, qp_geo_scores_block, &x);
+    qp_geo_release(&x);
+}
+
+/* Puts (key, i) into the best-first list of k, if it beats the last */
+static inline void qp_geo_keep(float *keys, int64_t *idx, uint32_t k, float key, int64_t i)
+{
+    if (!(key > keys[k - 1])) {
+        return;
+    }
+    uint32_t at = k - 1;
+    while (at > 0 && key > keys[at - 1]) {
+        keys[at] = keys[at - 1];
+        idx[at] = idx[at - 1];
+        at--;
+    }
+    keys[at] = key;
+    idx[at] = i;
+}
+
+static void qp_geo_nearest_block(void *ctx, size_t block, int64_t begin, int64_t end)
+{
+    const qp_geo_ctx *x = ctx;
+    int64_t from = (int64_t)block * x->block_rows, to = MIN(from + x->block_rows, x->c->rows);
+    /* l2 ranks lowest first: its keys are the negated distance */
+    float sign = x->metric == QUICPRO_GEO_L2 ? -1.0f : 1.0f;
+    for (int64_t qi = 0; qi < x->q->rows; qi++) {
+        size_t list = ((size_t)block * (size_t)x->q->rows + (size_t)qi) * x->k;
+        float *keys = x->keys + list;
+        int64_t *idx = x->idx + list;
+        for (uint32_t j = 0; j < x->k; j++) {
+            keys[j] = -INFINITY;
+            idx[j] = -1;
+        }
+        for (int64_t cj = from; cj < to; cj++) {
+            qp_geo_keep(keys, idx, x->k, sign * qp_geo_score(x, qi, cj), cj);
+        }
+    }
+}
+
+void quicpro_geo_nearest(const quicpro_geo_matrix_t *q, const quicpro_geo_matrix_t *c, quicpro_geo_metric_t metric,
+                         bool wide, uint32_t k, int64_t *idx, float *score)
+{
+    qp_geo_ctx x;
+    qp_geo_prepare(&x, q, c, metric, wide);
+    int64_t blocks = (c->rows + x.block_rows - 1) / x.block_rows;
+    size_t lists = (size_t)blocks * (size_t)q->rows;
+    x.k = k;
+    x.keys = safe_emalloc(lists, k * sizeof(float), 0);
+    x.idx = safe_emalloc(lists, k * sizeof(int64_t), 0);
+    qp_geo_parallel(blocks, qp_geo_nearest_block, &x);
+
+    /* Each query's blocks merged into its one list */
+    float sign = metric == QUICPRO_GEO_L2 ? -1.0f : 1.0f;
+    for (int64_t qi = 0; qi < q->rows; qi++) {
+        float *keys = score + (size_t)qi * k;
+        int64_t *best = idx + (size_t)qi * k;
+        for (uint32_t j = 0; j < k; j++) {
+            keys[j] = -INFINITY;
+            best[j] = -1;
+        }
+        for (int64_t b = 0; b < blocks; b++) {
+            size_t list = ((size_t)b * (size_t)q->rows + (size_t)qi) * k;
+            for (uint32_t j = 0; j < k && x.idx[list + j] >= 0; j++) {
+                qp_geo_keep(keys, best, k, x.keys[list + j], x.idx[list + j]);
+            }
+        }
+        for (uint32_t j = 0; j < k; j++) {
+            keys[j] *= sign;
+        }
+    }
+    efree(x.keys);
+    efree(x.idx);
+    qp_geo_release(&x);
+}
+
+/*──────────────────────────── Hausdorff distance ─────────────────────────*/
+
+typedef struct {
+    const quicpro_geo_matrix_t *from, *to;
+    int64_t                     from_n, from_step, to_n, to_step;   /* The rows taken: every step-th, n of them */
+    bool                        wide;
+    int64_t                     block_rows;
+    double                     *block_max;                          /* Squared */
+} qp_geo_hausdorff_ctx;
+
+/*
+ * The directed distance of a block of `from` rows: the farthest any of
+ * them is from its nearest `to` row. A row stops being compared once it
+ * is nearer some `to` row than the farthest so far, since it can no
+ * longer raise it (Taha and Hanbury's early break).
+ */
+static void qp_geo_hausdorff_block(void *ctx, size_t block, int64_t begin, int64_t end)
+{
+    const qp_geo_hausdorff_ctx *x = ctx;
+    int64_t first = (int64_t)block * x->block_rows, last = MIN(first + x->block_rows, x->from_n);
+    size_t d = x->from->dims;
+    double cmax = 0;
+    for (int64_t i = first; i < last; i++) {
+        const float *a = x->from->data + (size_t)(i * x->from_step) * d;
+        double cmin = INFINITY;
+        for (int64_t j = 0; j < x->to_n; j++) {
+            const float *b = x->to->data + (size_t)(j * x->to_step) * d;
+            double dist = x->wide ? qp_geo_sq_wide(a, b, d) : qp_geo_sq(a, b, d);
+            if (dist < cmax) {
+                cmin = dist;
+                break;
+            }
+            cmin = MIN(cmin, dist);
+        }
+        cmax = MAX(cmax, cmin);
+    }
+    x->block_max[block] = cmax;
+}
+
+static double qp_geo_directed(const quicpro_geo_matrix_t *from, const quicpro_geo_matrix_t *to, bool wide, int64_t sample)
+{
+    qp_geo_hausdorff_ctx x = { .from = from, .to = to, .wide = wide };
+    x.from_step = sample && from->rows > sample ? from->rows / sample : 1;
+    x.from_n = from->rows / x.from_step;
+    /* Every `to` row still: a sampled `from` row's nearest is its true nearest, so the result never overshoots */
+    x.to_step = 1;
+    x.to_n = to->rows;
+    x.block_rows = MAX(1, (x.from_n + QP_GEO_MAX_BLOCKS - 1) / QP_GEO_MAX_BLOCKS);
+    int64_t blocks = (x.from_n + x.block_rows - 1) / x.block_rows;
+    x.block_max = safe_emalloc((size_t)blocks, sizeof(double), 0);
+    qp_geo_parallel(blocks, qp_geo_hausdorff_block, &x);
+    double h = 0;
+    for (int64_t b = 0; b < blocks; b++) {
+        h = MAX(h, x.block_max[b]);
+    }
+    efree(x.block_max);
+    return h;
+}
+
+double quicpro_geo_hausdorff(const quicpro_geo_matrix_t *a, const quicpro_geo_matrix_t *b, bool wide, int64_t sample)
+{
+    return sqrt(MAX(qp_geo_directed(a, b, wide, sample), qp_geo_directed(b, a, wide, sample)));
+}
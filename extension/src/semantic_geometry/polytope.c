@@ -0,0 +1,324 @@
+/*
+ * src/semantic_geometry/polytope.c – Convex hulls and containment
+ * ===============================================================
+ *
+ * See include/semantic_geometry/polytope.h. Both hull algorithms orient by
+ * the sign of one cross product; quickhull keeps its pending edges on an
+ * explicit stack and sorts each edge's candidates to the front of one
+ * index array, so neither recursion depth nor allocation grows with the
+ * point count beyond that array.
+ */
+
+#include "php_quicpro.h"
+#include "semantic_geometry/polytope.h"
+#include "dataframe/morsel.h"
+
+#include <math.h>
+#include <string.h>
+
+/* Slack for points on a simplex's faces */
+#define QP_GEO_EPSILON 1e-9
+
+bool quicpro_geo_hull_parse(const char *name, size_t len, quicpro_geo_hull_t *out)
+{
+    if (len == sizeof("qhull") - 1 && memcmp(name, "qhull", len) == 0) {
+        *out = QUICPRO_GEO_QHULL;
+        return true;
+    }
+    if (len == sizeof("gift_wrapping") - 1 && memcmp(name, "gift_wrapping", len) == 0) {
+        *out = QUICPRO_GEO_GIFT_WRAPPING;
+        return true;
+    }
+    return false;
+}
+
+bool quicpro_geo_containment_parse(const char *name, size_t len, quicpro_geo_containment_t *out)
+{
+    if (len == sizeof("ray_casting") - 1 && memcmp(name, "ray_casting", len) == 0) {
+        *out = QUICPRO_GEO_RAY_CASTING;
+        return true;
+    }
+    if (len == sizeof("barycentric") - 1 && memcmp(name, "barycentric", len) == 0) {
+        *out = QUICPRO_GEO_BARYCENTRIC;
+        return true;
+    }
+    return false;
+}
+
+/*──────────────────────────── Hulls ──────────────────────────────────────*/
+
+#define QP_X(m, i) ((double)(m)->data[(size_t)(i) * 2])
+#define QP_Y(m, i) ((double)(m)->data[(size_t)(i) * 2 + 1])
+
+/* > 0: r lies left of p→q; < 0: right; 0: on its line */
+static inline double qp_geo_cross(const quicpro_geo_matrix_t *m, int64_t p, int64_t q, int64_t r)
+{
+    return (QP_X(m, q) - QP_X(m, p)) * (QP_Y(m, r) - QP_Y(m, p)) - (QP_Y(m, q) - QP_Y(m, p)) * (QP_X(m, r) - QP_X(m, p));
+}
+
+static inline double qp_geo_dist2(const quicpro_geo_matrix_t *m, int64_t p, int64_t q)
+{
+    double dx = QP_X(m, q) - QP_X(m, p), dy = QP_Y(m, q) - QP_Y(m, p);
+    return dx * dx + dy * dy;
+}
+
+/* The leftmost point (lowest among those), or with `right` the rightmost (highest among those) */
+static int64_t qp_geo_extreme(const quicpro_geo_matrix_t *m, bool right)
+{
+    int64_t best = 0;
+    for (int64_t i = 1; i < m->rows; i++) {
+        double dx = QP_X(m, i) - QP_X(m, best), dy = QP_Y(m, i) - QP_Y(m, best);
+        if (right ? (dx > 0 || (dx == 0 && dy > 0)) : (dx < 0 || (dx == 0 && dy < 0))) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static int64_t qp_geo_gift_wrap(const quicpro_geo_matrix_t *m, int64_t *out)
+{
+    int64_t start = qp_geo_extreme(m, false), cur = start, n = 0;
+    do {
+        out[n++] = cur;
+        /* The next vertex has every point on its left; of collinear ones, the farthest */
+        int64_t next = cur == 0 ? MIN(1, m->rows - 1) : 0;
+        for (int64_t j = 0; j < m->rows; j++) {
+            double c = qp_geo_cross(m, cur, next, j);
+            if (c < 0 || (c == 0 && qp_geo_dist2(m, cur, j) > qp_geo_dist2(m, cur, next))) {
+                next = j;
+            }
+        }
+        if (qp_geo_dist2(m, cur, next) == 0) {
+            break;                                  /* Every point is this one */
+        }
+        cur = next;
+    } while (cur != start && n < m->rows);
+    return n;
+}
+
+typedef struct {
+    int64_t p, q;           /* An edge, p→q */
+    int64_t lo, hi;         /* Its candidates: work[lo, hi), all right of it */
+} qp_geo_edge;
+
+/* Moves the points of work[lo, hi) strictly right of p→q to its front; where they end */
+static int64_t qp_geo_partition(const quicpro_geo_matrix_t *m, int64_t *work, int64_t lo, int64_t hi, int64_t p, int64_t q)
+{
+    int64_t w = lo;
+    for (int64_t i = lo; i < hi; i++) {
+        if (qp_geo_cross(m, p, q, work[i]) < 0) {
+            int64_t t = work[w];
+            work[w++] = work[i];
+            work[i] = t;
+        }
+    }
+    return w;
+}
+
+/*
+ * Quickhull: each edge between two vertices has the points right of it
+ * (outside the hull found so far); the farthest of them is a vertex, and
+ * splits the edge in two, each with the points right of it in turn. Edges
+ * are taken from the stack left first, so the vertices come out in order.
+ */
+static int64_t qp_geo_quickhull(const quicpro_geo_matrix_t *m, int64_t *out)
+{
+    int64_t a = qp_geo_extreme(m, false), b = qp_geo_extreme(m, true), n = 0;
+    out[n++] = a;
+    if (qp_geo_dist2(m, a, b) == 0) {
+        return n;
+    }
+
+    int64_t *work = safe_emalloc((size_t)m->rows, sizeof(int64_t), 0);
+    for (int64_t i = 0; i < m->rows; i++) {
+        work[i] = i;
+    }
+    int64_t below = qp_geo_partition(m, work, 0, m->rows, a, b);
+    int64_t above = qp_geo_partition(m, work, below, m->rows, b, a);
+
+    /* Each edge taken makes at most two, and one point a vertex */
+    qp_geo_edge *stack = safe_emalloc((size_t)m->rows + 2, 2 * sizeof(qp_geo_edge), 0);
+    size_t top = 0;
+    stack[top++] = (qp_geo_edge){ b, a, below, above };
+    stack[top++] = (qp_geo_edge){ a, b, 0, below };
+
+    while (top > 0) {
+        qp_geo_edge e = stack[--top];
+        if (e.lo == e.hi) {
+            if (e.q != a) {
+                out[n++] = e.q;
+            }
+            continue;
+        }
+        int64_t far = work[e.lo];
+        double far_c = qp_geo_cross(m, e.p, e.q, far);
+        for (int64_t i = e.lo + 1; i < e.hi; i++) {
+            double c = qp_geo_cross(m, e.p, e.q, work[i]);
+            if (c < far_c) {
+                far = work[i];
+                far_c = c;
+            }
+        }
+        int64_t split = qp_geo_partition(m, work, e.lo, e.hi, e.p, far);
+        int64_t end = qp_geo_partition(m, work, split, e.hi, far, e.q);
+        stack[top++] = (qp_geo_edge){ far, e.q, split, end };
+        stack[top++] = (qp_geo_edge){ e.p, far, e.lo, split };
+    }
+    efree(stack);
+    efree(work);
+    return n;
+}
+
+int64_t quicpro_geo_hull(const quicpro_geo_matrix_t *points, quicpro_geo_hull_t algo, int64_t *out)
+{
+    return algo == QUICPRO_GEO_GIFT_WRAPPING ? qp_geo_gift_wrap(points, out) : qp_geo_quickhull(points, out);
+}
+
+/*──────────────────────────── Containment ────────────────────────────────*/
+
+bool quicpro_geo_containment_fits(const quicpro_geo_matrix_t *poly, quicpro_geo_containment_t algo)
+{
+    if (poly->dims == 2) {
+        return poly->rows >= 3;
+    }
+    return algo == QUICPRO_GEO_BARYCENTRIC && poly->rows == (int64_t)poly->dims + 1;
+}
+
+typedef struct {
+    const quicpro_geo_matrix_t *poly, *points;
+    quicpro_geo_containment_t   algo;
+    const double               *inverse;    /* A simplex's: its edge matrix inverted; NULL if it is flat */
+    bool                       *in;
+} qp_geo_contains_ctx;
+
+/* Even-odd: a ray to +x crosses the polygon's edges an odd number of times from inside */
+static bool qp_geo_ray_cast(const quicpro_geo_matrix_t *poly, double x, double y)
+{
+    bool in = false;
+    for (int64_t i = 0, j = poly->rows - 1; i < poly->rows; j = i++) {
+        double xi = QP_X(poly, i), yi = QP_Y(poly, i), xj = QP_X(poly, j), yj = QP_Y(poly, j);
+        if ((yi > y) != (yj > y) && x < (xj - xi) * (y - yi) / (yj - yi) + xi) {
+            in = !in;
+        }
+    }
+    return in;
+}
+
+/* A convex polygon as the triangles (0, i, i + 1) */
+static bool qp_geo_fan(const quicpro_geo_matrix_t *poly, double x, double y)
+{
+    double x0 = QP_X(poly, 0), y0 = QP_Y(poly, 0);
+    for (int64_t i = 1; i + 1 < poly->rows; i++) {
+        double ax = QP_X(poly, i) - x0, ay = QP_Y(poly, i) - y0;
+        double bx = QP_X(poly, i + 1) - x0, by = QP_Y(poly, i + 1) - y0;
+        double det = ax * by - ay * bx;
+        if (det == 0) {
+            continue;
+        }
+        double px = x - x0, py = y - y0;
+        double u = (px * by - py * bx) / det, v = (ax * py - ay * px) / det;
+        if (u >= -QP_GEO_EPSILON && v >= -QP_GEO_EPSILON && u + v <= 1 + QP_GEO_EPSILON) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* λ = inverse · (p - v0): inside when every λ and 1 - Σλ are at least 0 */
+static bool qp_geo_simplex(const qp_geo_contains_ctx *x, const float *p)
+{
+    size_t d = x->poly->dims;
+    const float *v0 = x->poly->data;
+    double sum = 0;
+    for (size_t r = 0; r < d; r++) {
+        double l = 0;
+        for (size_t c = 0; c < d; c++) {
+            l += x->inverse[r * d + c] * ((double)p[c] - v0[c]);
+        }
+        if (l < -QP_GEO_EPSILON) {
+            return false;
+        }
+        sum += l;
+    }
+    return sum <= 1 + QP_GEO_EPSILON;
+}
+
+static void qp_geo_contains_morsel(void *ctx, size_t morsel, int64_t begin, int64_t end)
+{
+    const qp_geo_contains_ctx *x = ctx;
+    size_t d = x->points->dims;
+    for (int64_t i = begin; i < end; i++) {
+        const float *p = x->points->data + (size_t)i * d;
+        if (d != 2) {
+            x->in[i] = x->inverse && qp_geo_simplex(x, p);
+        } else if (x->algo == QUICPRO_GEO_RAY_CASTING) {
+            x->in[i] = qp_geo_ray_cast(x->poly, p[0], p[1]);
+        } else {
+            x->in[i] = qp_geo_fan(x->poly, p[0], p[1]);
+        }
+    }
+}
+
+/* The inverse of the simplex's edge matrix (column c: vertex c + 1 - vertex 0), by Gauss-Jordan; NULL if singular */
+static double *qp_geo_simplex_inverse(const quicpro_geo_matrix_t *poly)
+{
+    size_t d = poly->dims, w = 2 * d;
+    double *a = safe_emalloc(d * w, sizeof(double), 0);
+    for (size_t r = 0; r < d; r++) {
+        for (size_t c = 0; c < d; c++) {
+            a[r * w + c] = (double)poly->data[(c + 1) * d + r] - poly->data[r];
+            a[r * w + d + c] = r == c;
+        }
+    }
+    for (size_t col = 0; col < d; col++) {
+        size_t pivot = col;
+        for (size_t r = col + 1; r < d; r++) {
+            if (fabs(a[r * w + col]) > fabs(a[pivot * w + col])) {
+                pivot = r;
+            }
+        }
+        if (fabs(a[pivot * w + col]) < 1e-12) {
+            efree(a);
+            return NULL;
+        }
+        if (pivot != col) {
+            for (size_t c = 0; c < w; c++) {
+                double t = a[col * w + c];
+                a[col * w + c] = a[pivot * w + c];
+                a[pivot * w + c] = t;
+            }
+        }
+        double inv = 1.0 / a[col * w + col];
+        for (size_t c = 0; c < w; c++) {
+            a[col * w + c] *= inv;
+        }
+        for (size_t r = 0; r < d; r++) {
+            double f = a[r * w + col];
+            if (r != col && f != 0) {
+                for (size_t c = 0; c < w; c++) {
+                    a[r * w + c] -= f * a[col * w + c];
+                }
+            }
+        }
+    }
+    /* Keep the right half, d × d */
+    for (size_t r = 0; r < d; r++) {
+        memmove(a + r * d, a + r * w + d, d * sizeof(double));
+    }
+    return a;
+}
+
+void quicpro_geo_contains(const quicpro_geo_matrix_t *poly, const quicpro_geo_matrix_t *points,
+                          quicpro_geo_containment_t algo, bool *in)
+{
+    qp_geo_contains_ctx x = { poly, points, algo, NULL, in };
+    double *inverse = NULL;
+    if (poly->dims != 2) {
+        inverse = qp_geo_simplex_inverse(poly);
+        x.inverse = inverse;
+    }
+    quicpro_df_parallel(points->rows, qp_geo_contains_morsel, &x);
+    if (inverse) {
+        efree(inverse);
+    }
+}
@@ -0,0 +1,506 @@
+/*
+ * src/semantic_geometry/space.c – Quicpro\Geometry\Space
+ * ======================================================
+ *
+ * See include/semantic_geometry/space.h. The object holds a reference to
+ * the space (semantic_geometry/spiral.c), which lives in persistent
+ * memory: the process's table of shared spaces holds another, so a shared
+ * space outlives the request that built it.
+ */
+
+#include "php_quicpro.h"
+#include "semantic_geometry/space.h"
+#include "semantic_geometry/spiral.h"
+#include "semantic_geometry/geometry.h"
+#include "config/semantic_geometry/base_layer.h"
+
+#include <ext/spl/spl_exceptions.h>
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+#include <string.h>
+
+#ifdef ZTS
+# include <TSRM.h>
+static MUTEX_T qp_space_mutex = NULL;
+# define SHARED_LOCK()   tsrm_mutex_lock(qp_space_mutex)
+# define SHARED_UNLOCK() tsrm_mutex_unlock(qp_space_mutex)
+#else
+# define SHARED_LOCK()   /* noop */
+# define SHARED_UNLOCK() /* noop */
+#endif
+
+typedef struct {
+    quicpro_spiral_t *s;                /* NULL until constructed */
+    zend_object       std;
+} quicpro_geometry_space_object;
+
+zend_class_entry *quicpro_ce_geometry_space;
+static zend_object_handlers quicpro_geometry_space_handlers;
+static HashTable qp_space_shared;       /* name => quicpro_spiral_t * */
+
+static inline quicpro_geometry_space_object *qp_space_from_obj(zend_object *obj)
+{
+    return (quicpro_geometry_space_object *)((char *)obj - XtOffsetOf(quicpro_geometry_space_object, std));
+}
+
+/* The space of this object, or NULL with an exception thrown */
+static quicpro_spiral_t *qp_space_this(zval *this_zv)
+{
+    quicpro_spiral_t *s = qp_space_from_obj(Z_OBJ_P(this_zv))->s;
+    if (!s) {
+        zend_throw_exception_ex(NULL, 0, "Space was not constructed");
+    }
+    return s;
+}
+
+static void qp_space_wrap(zval *out, quicpro_spiral_t *s)
+{
+    object_init_ex(out, quicpro_ce_geometry_space);
+    qp_space_from_obj(Z_OBJ_P(out))->s = s;
+}
+
+static bool qp_space_option_double(HashTable *options, const char *key, double min, double max, float *out)
+{
+    zval *zv = options ? zend_hash_str_find(options, key, strlen(key)) : NULL;
+    if (!zv) {
+        return true;
+    }
+    if ((Z_TYPE_P(zv) != IS_DOUBLE && Z_TYPE_P(zv) != IS_LONG) || zval_get_double(zv) < min || zval_get_double(zv) > max) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Space option '%s' must be a number within %g..%g", key, min, max);
+        return false;
+    }
+    *out = (float)zval_get_double(zv);
+    return true;
+}
+
+/* The rows of `zm`, or NULL with an exception thrown if they do not fit `s` */
+static const quicpro_geometry_matrix_object *qp_space_rows(quicpro_spiral_t *s, zval *zm)
+{
+    const quicpro_geometry_matrix_object *m = quicpro_geometry_matrix_from_obj(Z_OBJ_P(zm));
+    if (m->dims != quicpro_spiral_params(s)->dims) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Space of %zu dimensions cannot take rows of %zu", quicpro_spiral_params(s)->dims, m->dims);
+        return NULL;
+    }
+    return m;
+}
+
+/*──────────────────────────── Methods ────────────────────────────────────*/
+
+PHP_METHOD(QuicproGeometrySpace, __construct)
+{
+    zend_long dims = 0;
+    bool dims_null = true;
+    HashTable *options = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(0, 2)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG_OR_NULL(dims, dims_null)
+        Z_PARAM_ARRAY_HT(options)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_geometry_space_object *o = qp_space_from_obj(Z_OBJ_P(ZEND_THIS));
+    if (o->s) {
+        zend_throw_exception_ex(NULL, 0, "Space was already constructed");
+        RETURN_THROWS();
+    }
+    if (dims_null) {
+        dims = quicpro_semantic_geometry_config.default_vector_dimensions;
+    }
+    if (dims < 1 || dims > 65536) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Space dims must be within 1..65536");
+        RETURN_THROWS();
+    }
+    quicpro_spiral_params_t p = { (size_t)dims, (float)quicpro_semantic_geometry_config.spiral_search_step_size,
+                                  (float)quicpro_semantic_geometry_config.core_consolidation_threshold, 0 };
+    if (!qp_space_option_double(options, "step", 0.001, 2.0, &p.step)
+        || !qp_space_option_double(options, "threshold", 0.0, 1.0, &p.threshold)) {
+        RETURN_THROWS();
+    }
+    if (p.step < 0.001f) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "quicpro.geometry_spiral_search_step_size must be at least 0.001 for a Space");
+        RETURN_THROWS();
+    }
+    p.cell_radius = MIN(4 * p.step, 2.0f);
+    if (!qp_space_option_double(options, "cell_radius", 0.0, 2.0, &p.cell_radius)) {
+        RETURN_THROWS();
+    }
+    o->s = quicpro_spiral_new(&p);
+}
+
+/* A space written by save(), mapped rather than read */
+PHP_METHOD(QuicproGeometrySpace, load)
+{
+    zend_string *path;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_PATH_STR(path)
+    ZEND_PARSE_PARAMETERS_END();
+
+    char err[PATH_MAX + 128];
+    quicpro_spiral_t *s = quicpro_spiral_load(ZSTR_VAL(path), err, sizeof(err));
+    if (!s) {
+        zend_throw_exception_ex(NULL, 0, "Space::load(): %s", err);
+        RETURN_THROWS();
+    }
+    qp_space_wrap(return_value, s);
+}
+
+PHP_METHOD(QuicproGeometrySpace, save)
+{
+    zend_string *path;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_PATH_STR(path)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_spiral_t *s = qp_space_this(ZEND_THIS);
+    char err[PATH_MAX + 128];
+    if (!s) {
+        RETURN_THROWS();
+    }
+    if (!quicpro_spiral_save(s, ZSTR_VAL(path), err, sizeof(err))) {
+        zend_throw_exception_ex(NULL, 0, "Space::save(): %s", err);
+        RETURN_THROWS();
+    }
+}
+
+/* Adds the rows of `vectors` labelled `ids` (default: their positions in the space); the rows added */
+PHP_METHOD(QuicproGeometrySpace, add)
+{
+    zval *zm;
+    HashTable *ids = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_OBJECT_OF_CLASS(zm, quicpro_ce_geometry_matrix)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_ARRAY_HT_OR_NULL(ids)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_spiral_t *s = qp_space_this(ZEND_THIS);
+    const quicpro_geometry_matrix_object *m = s ? qp_space_rows(s, zm) : NULL;
+    if (!m) {
+        RETURN_THROWS();
+    }
+    if (ids && zend_hash_num_elements(ids) != m->rows) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Space::add() takes one id per row");
+        RETURN_THROWS();
+    }
+    int64_t count = quicpro_spiral_count(s);
+    if (count + m->rows >= UINT32_MAX) {
+        zend_throw_exception_ex(NULL, 0, "Space is full");
+        RETURN_THROWS();
+    }
+
+    int64_t *labels = safe_emalloc((size_t)MAX(m->rows, 1), sizeof(int64_t), 0);
+    int64_t i = 0;
+    if (ids) {
+        zval *zv;
+        ZEND_HASH_FOREACH_VAL(ids, zv) {
+            if (Z_TYPE_P(zv) != IS_LONG || Z_LVAL_P(zv) < 0) {
+                efree(labels);
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Space::add() takes non-negative integer ids");
+                RETURN_THROWS();
+            }
+            labels[i++] = Z_LVAL_P(zv);
+        } ZEND_HASH_FOREACH_END();
+    } else {
+        for (; i < m->rows; i++) {
+            labels[i] = count + i;
+        }
+    }
+    int64_t added = quicpro_spiral_add(s, m->data, m->rows, labels);
+    efree(labels);
+    RETURN_LONG((zend_long)added);
+}
+
+/* For each row of `queries`, the `k` nearest as [id => similarity], best first */
+PHP_METHOD(QuicproGeometrySpace, search)
+{
+    zval *zm;
+    zend_long k = 10;
+    bool consolidate = true;
+
+    ZEND_PARSE_PARAMETERS_START(1, 3)
+        Z_PARAM_OBJECT_OF_CLASS(zm, quicpro_ce_geometry_matrix)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(k)
+        Z_PARAM_BOOL(consolidate)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_spiral_t *s = qp_space_this(ZEND_THIS);
+    const quicpro_geometry_matrix_object *m = s ? qp_space_rows(s, zm) : NULL;
+    if (!m) {
+        RETURN_THROWS();
+    }
+    if (k < 1 || k > 65535) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Space::search() k must be within 1..65535");
+        RETURN_THROWS();
+    }
+    int64_t *labels = safe_emalloc((size_t)MAX(m->rows, 1), (size_t)k * sizeof(int64_t), 0);
+    float *scores = safe_emalloc((size_t)MAX(m->rows, 1), (size_t)k * sizeof(float), 0);
+    quicpro_spiral_search(s, m->data, m->rows, (uint32_t)k, consolidate, labels, scores);
+    array_init_size(return_value, (uint32_t)m->rows);
+    for (int64_t i = 0; i < m->rows; i++) {
+        zval best;
+        array_init_size(&best, (uint32_t)k);
+        for (zend_long j = 0; j < k && labels[(size_t)i * k + j] >= 0; j++) {
+            add_index_double(&best, (zend_ulong)labels[(size_t)i * k + j], scores[(size_t)i * k + j]);
+        }
+        add_next_index_zval(return_value, &best);
+    }
+    efree(labels);
+    efree(scores);
+}
+
+/* ['version' => the version it is current to, 'delta' => the points changed after `since`] */
+PHP_METHOD(QuicproGeometrySpace, delta)
+{
+    zend_long since = 0;
+
+    ZEND_PARSE_PARAMETERS_START(0, 1)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(since)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_spiral_t *s = qp_space_this(ZEND_THIS);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    if (since < 0) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Space::delta() takes a version of 0 or more");
+        RETURN_THROWS();
+    }
+    smart_str delta = {0};
+    uint64_t version = quicpro_spiral_delta(s, (uint64_t)since, &delta);
+    smart_str_0(&delta);
+    array_init_size(return_value, 2);
+    add_assoc_long(return_value, "version", (zend_long)version);
+    add_assoc_str(return_value, "delta", delta.s);
+}
+
+/* Merges a delta() of another space; the points it changed here */
+PHP_METHOD(QuicproGeometrySpace, applyDelta)
+{
+    zend_string *delta;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(delta)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_spiral_t *s = qp_space_this(ZEND_THIS);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    char err[128];
+    int64_t changed = quicpro_spiral_apply_delta(s, ZSTR_VAL(delta), ZSTR_LEN(delta), err, sizeof(err));
+    if (changed < 0) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Space::applyDelta(): %s", err);
+        RETURN_THROWS();
+    }
+    RETURN_LONG((zend_long)changed);
+}
+
+PHP_METHOD(QuicproGeometrySpace, count)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_spiral_t *s = qp_space_this(ZEND_THIS);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    RETURN_LONG((zend_long)quicpro_spiral_count(s));
+}
+
+PHP_METHOD(QuicproGeometrySpace, coreCount)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_spiral_t *s = qp_space_this(ZEND_THIS);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    RETURN_LONG((zend_long)quicpro_spiral_core_count(s));
+}
+
+PHP_METHOD(QuicproGeometrySpace, dims)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_spiral_t *s = qp_space_this(ZEND_THIS);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    RETURN_LONG((zend_long)quicpro_spiral_params(s)->dims);
+}
+
+PHP_METHOD(QuicproGeometrySpace, version)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_spiral_t *s = qp_space_this(ZEND_THIS);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    RETURN_LONG((zend_long)quicpro_spiral_version(s));
+}
+
+/* Makes the space known to this process as `name`, replacing any shared so before */
+PHP_METHOD(QuicproGeometrySpace, share)
+{
+    zend_string *name;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_spiral_t *s = qp_space_this(ZEND_THIS);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    quicpro_spiral_retain(s);
+    SHARED_LOCK();
+    zend_hash_str_update_ptr(&qp_space_shared, ZSTR_VAL(name), ZSTR_LEN(name), s);
+    SHARED_UNLOCK();
+}
+
+/* The space shared as `name`, or null */
+PHP_METHOD(QuicproGeometrySpace, shared)
+{
+    zend_string *name;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    SHARED_LOCK();
+    quicpro_spiral_t *s = zend_hash_str_find_ptr(&qp_space_shared, ZSTR_VAL(name), ZSTR_LEN(name));
+    if (s) {
+        quicpro_spiral_retain(s);
+    }
+    SHARED_UNLOCK();
+    if (!s) {
+        RETURN_NULL();
+    }
+    qp_space_wrap(return_value, s);
+}
+
+/*──────────────────────────── Life cycle ─────────────────────────────────*/
+
+static zend_object *qp_space_create(zend_class_entry *ce)
+{
+    quicpro_geometry_space_object *o = zend_object_alloc(sizeof(quicpro_geometry_space_object), ce);
+    zend_object_std_init(&o->std, ce);
+    object_properties_init(&o->std, ce);
+    o->std.handlers = &quicpro_geometry_space_handlers;
+    return &o->std;
+}
+
+static void qp_space_free_obj(zend_object *obj)
+{
+    quicpro_geometry_space_object *o = qp_space_from_obj(obj);
+    if (o->s) {
+        quicpro_spiral_release(o->s);
+    }
+    zend_object_std_dtor(obj);
+}
+
+static void qp_space_shared_dtor(zval *zv)
+{
+    quicpro_spiral_release(Z_PTR_P(zv));
+}
+
+/*──────────────────────────── Registration ───────────────────────────────*/
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_geometry_space_construct, 0, 0, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, dims, IS_LONG, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, options, IS_ARRAY, 0, "[]")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_geometry_space_load, 0, 1, Quicpro\\Geometry\\Space, 0)
+    ZEND_ARG_TYPE_INFO(0, path, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_space_save, 0, 1, IS_VOID, 0)
+    ZEND_ARG_TYPE_INFO(0, path, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_space_add, 0, 1, IS_LONG, 0)
+    ZEND_ARG_OBJ_INFO(0, vectors, Quicpro\\Geometry\\Matrix, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, ids, IS_ARRAY, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_space_search, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_OBJ_INFO(0, queries, Quicpro\\Geometry\\Matrix, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, k, IS_LONG, 0, "10")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, consolidate, _IS_BOOL, 0, "true")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_space_delta, 0, 0, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, since, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_space_apply_delta, 0, 1, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO(0, delta, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_space_count, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_quicpro_geometry_space_core_count arginfo_quicpro_geometry_space_count
+#define arginfo_quicpro_geometry_space_dims       arginfo_quicpro_geometry_space_count
+#define arginfo_quicpro_geometry_space_version    arginfo_quicpro_geometry_space_count
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_geometry_space_share, 0, 1, IS_VOID, 0)
+    ZEND_ARG_TYPE_INFO(0, name, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_quicpro_geometry_space_shared, 0, 1, Quicpro\\Geometry\\Space, 1)
+    ZEND_ARG_TYPE_INFO(0, name, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry quicpro_geometry_space_methods[] = {
+    PHP_ME(QuicproGeometrySpace, __construct, arginfo_quicpro_geometry_space_construct,   ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometrySpace, load,        arginfo_quicpro_geometry_space_load,        ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_ME(QuicproGeometrySpace, save,        arginfo_quicpro_geometry_space_save,        ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometrySpace, add,         arginfo_quicpro_geometry_space_add,         ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometrySpace, search,      arginfo_quicpro_geometry_space_search,      ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometrySpace, delta,       arginfo_quicpro_geometry_space_delta,       ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometrySpace, applyDelta,  arginfo_quicpro_geometry_space_apply_delta, ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometrySpace, count,       arginfo_quicpro_geometry_space_count,       ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometrySpace, coreCount,   arginfo_quicpro_geometry_space_core_count,  ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometrySpace, dims,        arginfo_quicpro_geometry_space_dims,        ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometrySpace, version,     arginfo_quicpro_geometry_space_version,     ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometrySpace, share,       arginfo_quicpro_geometry_space_share,       ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproGeometrySpace, shared,      arginfo_quicpro_geometry_space_shared,      ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+    PHP_FE_END
+};
+
+void quicpro_geometry_space_minit(void)
+{
+    zend_class_entry ce;
+    INIT_NS_CLASS_ENTRY(ce, "Quicpro\\Geometry", "Space", quicpro_geometry_space_methods);
+    quicpro_ce_geometry_space = zend_register_internal_class(&ce);
+    quicpro_ce_geometry_space->ce_flags |= ZEND_ACC_FINAL;
+#ifdef ZEND_ACC_NO_DYNAMIC_PROPERTIES
+    quicpro_ce_geometry_space->ce_flags |= ZEND_ACC_NO_DYNAMIC_PROPERTIES;
+#endif
+    quicpro_ce_geometry_space->create_object = qp_space_create;
+
+    memcpy(&quicpro_geometry_space_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    quicpro_geometry_space_handlers.offset = XtOffsetOf(quicpro_geometry_space_object, std);
+    quicpro_geometry_space_handlers.free_obj = qp_space_free_obj;
+    quicpro_geometry_space_handlers.clone_obj = NULL;
+
+    zend_hash_init(&qp_space_shared, 8, NULL, qp_space_shared_dtor, 1);
+#ifdef ZTS
+    qp_space_mutex = tsrm_mutex_alloc();
+#endif
+}
+
+void quicpro_geometry_space_mshutdown(void)
+{
+    zend_hash_destroy(&qp_space_shared);
+#ifdef ZTS
+    tsrm_mutex_free(qp_space_mutex);
+    qp_space_mutex = NULL;
+#endif
+}
@@ -0,0 +1,822 @@
+/*
+ * src/semantic_geometry/spiral.c – Spiral search over a semantic space
+ * ====================================================================
+ *
+ * See include/semantic_geometry/spiral.h. Every vector is stored
+ * normalised, so distances are squared l2 between unit vectors and a
+ * cosine similarity is 1 - d / 2.
+ *
+ * A cell is its anchor, its radius and a chain of its points through
+ * `next`, newest first. The core is a list of nodes, and labels are found
+ * through an open addressing table of node + 1 (0: empty).
+ *
+ * One rwlock guards it all: searches hold it for reading, anything that
+ * changes a point for writing. A search that consolidates takes it again
+ * for writing once its parallel part is done.
+ */
+
+#include "php_quicpro.h"
+#include "semantic_geometry/spiral.h"
+#include "dataframe/morsel.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define QP_SPIRAL_MAGIC     "QPSPIR1\n"
+#define QP_SPIRAL_DELTA     "QPSPDL1\n"
+#define QP_SPIRAL_ALIGN     64              /* Of each section in the file */
+#define QP_SPIRAL_CORE      0x01            /* flags: in the core */
+#define QP_SPIRAL_RATE      0.125f          /* Weight of one query in a resonance */
+#define QP_SPIRAL_NONE      UINT32_MAX
+
+struct quicpro_spiral_s {
+    quicpro_spiral_params_t p;
+    _Atomic uint32_t      refs;
+    pthread_rwlock_t      lock;
+    uint64_t              version;
+    int64_t               count, capacity;
+    uint32_t              cells, cell_cap;
+    uint32_t              core_n, core_cap;
+    uint32_t              slot_cap;         /* A power of two, at least twice the count */
+
+    /* The sections, as a file has them: in the mapping of a loaded one, or on the heap */
+    int64_t              *labels;
+    float                *vectors;
+    float                *resonance;
+    uint8_t              *flags;
+    uint64_t             *versions;         /* Per point: the version that last changed it */
+    uint32_t             *next;             /* Per point: the next point of its cell */
+    float                *anchors;
+    uint32_t             *heads;            /* Per cell: its newest point */
+    float                *radii;
+    uint32_t             *core;
+    uint32_t             *slots;
+
+    void                 *map;
+    size_t                map_len;
+};
+
+enum {
+    QP_S_LABELS, QP_S_VECTORS, QP_S_RESONANCE, QP_S_FLAGS, QP_S_VERSIONS, QP_S_NEXT,
+    QP_S_ANCHORS, QP_S_HEADS, QP_S_RADII, QP_S_CORE, QP_S_SLOTS, QP_S_SECTIONS
+};
+
+/* The file: this head, then the sections in the order above, each QP_SPIRAL_ALIGN aligned */
+typedef struct {
+    char     magic[8];
+    uint32_t dims;
+    float    step, threshold, cell_radius;
+    uint64_t count, cells, core, slots, version;
+    uint64_t at[QP_S_SECTIONS];
+} qp_spiral_head;
+
+/* A delta: this head, then `count` records of a qp_spiral_record and dims floats */
+typedef struct {
+    char     magic[8];
+    uint32_t dims, reserved;
+    uint64_t count, version;
+} qp_spiral_delta_head;
+
+typedef struct {
+    int64_t  label;
+    float    resonance;
+    uint8_t  flags, pad[3];
+} qp_spiral_record;
+
+static inline const float *qp_spiral_vec(const quicpro_spiral_t *s, uint32_t node)
+{
+    return s->vectors + (size_t)node * s->p.dims;
+}
+
+static void qp_spiral_normalise(float *to, const float *from, size_t dims)
+{
+    float n2 = quicpro_geo_dot_f32(from, from, dims);
+    float norm = n2 > 0 ? 1.0f / sqrtf(n2) : 0.0f;
+    for (size_t i = 0; i < dims; i++) {
+        to[i] = from[i] * norm;
+    }
+}
+
+/*──────────────────────────── Sections ───────────────────────────────────*/
+
+/* A section in the mapping of a loaded file (an empty one may point at its end) */
+static inline bool qp_spiral_mapped(const quicpro_spiral_t *s, const void *p)
+{
+    return s->map && (const char *)p >= (const char *)s->map && (const char *)p <= (const char *)s->map + s->map_len;
+}
+
+/* `old` with room for `want` bytes, its first `used` kept; moved out of the mapping if it was there */
+static void *qp_spiral_regrow(quicpro_spiral_t *s, void *old, size_t used, size_t want)
+{
+    if (qp_spiral_mapped(s, old)) {
+        void *p = pemalloc(want, 1);
+        memcpy(p, old, used);
+        return p;
+    }
+    return perealloc(old, want, 1);
+}
+
+static void qp_spiral_region_free(quicpro_spiral_t *s, void *p)
+{
+    if (p && !qp_spiral_mapped(s, p)) {
+        pefree(p, 1);
+    }
+}
+
+/* Each section's address and size at these counts */
+static void qp_spiral_sections(quicpro_spiral_t *s, uint64_t count, uint64_t cells, uint64_t core, uint64_t slots,
+                               void ***at, uint64_t *size)
+{
+    size_t d = s->p.dims;
+    void **ptr[QP_S_SECTIONS] = {
+        (void **)&s->labels, (void **)&s->vectors, (void **)&s->resonance, (void **)&s->flags,
+        (void **)&s->versions, (void **)&s->next, (void **)&s->anchors, (void **)&s->heads,
+        (void **)&s->radii, (void **)&s->core, (void **)&s->slots,
+    };
+    uint64_t bytes[QP_S_SECTIONS] = {
+        count * sizeof(int64_t), count * d * sizeof(float), count * sizeof(float), count,
+        count * sizeof(uint64_t), count * sizeof(uint32_t), cells * d * sizeof(float), cells * sizeof(uint32_t),
+        cells * sizeof(float), core * sizeof(uint32_t), slots * sizeof(uint32_t),
+    };
+    memcpy(at, ptr, sizeof(ptr));
+    memcpy(size, bytes, sizeof(bytes));
+}
+
+static inline uint32_t qp_spiral_slot(int64_t label, uint32_t cap)
+{
+    uint64_t x = (uint64_t)label * 0x9e3779b97f4a7c15ULL;
+    return (uint32_t)(x ^ x >> 32) & (cap - 1);
+}
+
+/* The node labelled `label`, or QP_SPIRAL_NONE */
+static uint32_t qp_spiral_find(const quicpro_spiral_t *s, int64_t label)
+{
+    if (!s->slot_cap) {
+        return QP_SPIRAL_NONE;
+    }
+    for (uint32_t i = qp_spiral_slot(label, s->slot_cap);; i = (i + 1) & (s->slot_cap - 1)) {
+        uint32_t v = s->slots[i];
+        if (!v) {
+            return QP_SPIRAL_NONE;
+        }
+        if (s->labels[v - 1] == label) {
+            return v - 1;
+        }
+    }
+}
+
+static void qp_spiral_slot_put(quicpro_spiral_t *s, uint32_t node)
+{
+    uint32_t i = qp_spiral_slot(s->labels[node], s->slot_cap);
+    while (s->slots[i]) {
+        i = (i + 1) & (s->slot_cap - 1);
+    }
+    s->slots[i] = node + 1;
+}
+
+/* Room for `points` points and `cells` cells; call with the lock written */
+static void qp_spiral_reserve(quicpro_spiral_t *s, int64_t points, uint32_t cells)
+{
+    size_t d = s->p.dims;
+    if (points > s->capacity) {
+        int64_t cap = MAX(points, MAX(s->capacity * 2, 64));
+        size_t n = (size_t)s->count;
+        s->labels = qp_spiral_regrow(s, s->labels, n * sizeof(int64_t), cap * sizeof(int64_t));
+        s->vectors = qp_spiral_regrow(s, s->vectors, n * d * sizeof(float), cap * d * sizeof(float));
+        s->resonance = qp_spiral_regrow(s, s->resonance, n * sizeof(float), cap * sizeof(float));
+        s->flags = qp_spiral_regrow(s, s->flags, n, cap);
+        s->versions = qp_spiral_regrow(s, s->versions, n * sizeof(uint64_t), cap * sizeof(uint64_t));
+        s->next = qp_spiral_regrow(s, s->next, n * sizeof(uint32_t), cap * sizeof(uint32_t));
+        s->capacity = cap;
+    }
+    if (cells > s->cell_cap) {
+        uint32_t cap = MAX(cells, MAX(s->cell_cap * 2, 16));
+        s->anchors = qp_spiral_regrow(s, s->anchors, s->cells * d * sizeof(float), cap * d * sizeof(float));
+        s->heads = qp_spiral_regrow(s, s->heads, s->cells * sizeof(uint32_t), cap * sizeof(uint32_t));
+        s->radii = qp_spiral_regrow(s, s->radii, s->cells * sizeof(float), cap * sizeof(float));
+        s->cell_cap = cap;
+    }
+    if ((uint64_t)points * 2 > s->slot_cap) {
+        uint32_t cap = 64;
+        while ((uint64_t)cap < (uint64_t)points * 2) {
+            cap *= 2;
+        }
+        qp_spiral_region_free(s, s->slots);
+        s->slots = pecalloc(cap, sizeof(uint32_t), 1);
+        s->slot_cap = cap;
+        for (uint32_t node = 0; node < (uint32_t)s->count; node++) {
+            qp_spiral_slot_put(s, node);
+        }
+    }
+}
+
+static void qp_spiral_promote(quicpro_spiral_t *s, uint32_t node)
+{
+    if (s->core_n == s->core_cap) {
+        uint32_t cap = MAX(s->core_cap * 2, 64);
+        s->core = qp_spiral_regrow(s, s->core, s->core_n * sizeof(uint32_t), cap * sizeof(uint32_t));
+        s->core_cap = cap;
+    }
+    s->core[s->core_n++] = node;
+    s->flags[node] |= QP_SPIRAL_CORE;
+    s->versions[node] = s->version;
+}
+
+/*──────────────────────────── Life cycle ─────────────────────────────────*/
+
+static quicpro_spiral_t *qp_spiral_alloc(const quicpro_spiral_params_t *params)
+{
+    quicpro_spiral_t *s = pecalloc(1, sizeof(*s), 1);
+    s->p = *params;
+    s->refs = 1;
+    pthread_rwlock_init(&s->lock, NULL);
+    return s;
+}
+
+quicpro_spiral_t *quicpro_spiral_new(const quicpro_spiral_params_t *params)
+{
+    return qp_spiral_alloc(params);
+}
+
+void quicpro_spiral_retain(quicpro_spiral_t *s)
+{
+    atomic_fetch_add_explicit(&s->refs, 1, memory_order_relaxed);
+}
+
+void quicpro_spiral_release(quicpro_spiral_t *s)
+{
+    if (atomic_fetch_sub_explicit(&s->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+    void **at[QP_S_SECTIONS];
+    uint64_t size[QP_S_SECTIONS];
+    qp_spiral_sections(s, 0, 0, 0, 0, at, size);
+    for (int i = 0; i < QP_S_SECTIONS; i++) {
+        qp_spiral_region_free(s, *at[i]);
+    }
+    if (s->map) {
+        munmap(s->map, s->map_len);
+    }
+    pthread_rwlock_destroy(&s->lock);
+    pefree(s, 1);
+}
+
+const quicpro_spiral_params_t *quicpro_spiral_params(const quicpro_spiral_t *s)
+{
+    return &s->p;
+}
+
+#define QP_SPIRAL_READ(s, expr) do { \
+        pthread_rwlock_rdlock(&(s)->lock); \
+        result = (expr); \
+        pthread_rwlock_unlock(&(s)->lock); \
+    } while (0)
+
+int64_t quicpro_spiral_count(quicpro_spiral_t *s)
+{
+    int64_t result;
+    QP_SPIRAL_READ(s, s->count);
+    return result;
+}
+
+int64_t quicpro_spiral_core_count(quicpro_spiral_t *s)
+{
+    int64_t result;
+    QP_SPIRAL_READ(s, (int64_t)s->core_n);
+    return result;
+}
+
+int64_t quicpro_spiral_cell_count(quicpro_spiral_t *s)
+{
+    int64_t result;
+    QP_SPIRAL_READ(s, (int64_t)s->cells);
+    return result;
+}
+
+uint64_t quicpro_spiral_version(quicpro_spiral_t *s)
+{
+    uint64_t result;
+    QP_SPIRAL_READ(s, s->version);
+    return result;
+}
+
+/*──────────────────────────── Adding ─────────────────────────────────────*/
+
+typedef struct {
+    const quicpro_spiral_t *s;
+    const float            *vectors;        /* Normalised */
+    uint32_t               *cell;           /* Per row: the nearest cell, or QP_SPIRAL_NONE */
+    float                  *dist;           /* ... and its squared distance */
+} qp_spiral_near_ctx;
+
+static void qp_spiral_near_morsel(void *ctx, size_t morsel, int64_t begin, int64_t end)
+{
+    const qp_spiral_near_ctx *x = ctx;
+    const quicpro_spiral_t *s = x->s;
+    size_t d = s->p.dims;
+    for (int64_t i = begin; i < end; i++) {
+        const float *v = x->vectors + (size_t)i * d;
+        uint32_t best = QP_SPIRAL_NONE;
+        float best_d = INFINITY;
+        for (uint32_t c = 0; c < s->cells; c++) {
+            float dc = quicpro_geo_sq_f32(v, s->anchors + (size_t)c * d, d);
+            if (dc < best_d) {
+                best_d = dc;
+                best = c;
+            }
+        }
+        x->cell[i] = best;
+        x->dist[i] = best_d;
+    }
+}
+
+/*
+ * Adds `n` normalised rows, stamped with the current version; those whose
+ * label is known are skipped. The nearest existing anchor of every row is
+ * found in parallel; the rows are then placed in order, each also weighed
+ * against the cells this call started. Call with the lock written.
+ */
+static int64_t qp_spiral_add_locked(quicpro_spiral_t *s, const float *vectors, int64_t n, const int64_t *labels,
+                                    const float *resonance, const uint8_t *flags)
+{
+    size_t d = s->p.dims;
+    uint32_t *cell = pemalloc((size_t)MAX(n, 1) * sizeof(uint32_t), 1);
+    float *dist = pemalloc((size_t)MAX(n, 1) * sizeof(float), 1);
+    qp_spiral_near_ctx x = { s, vectors, cell, dist };
+    quicpro_df_parallel(n, qp_spiral_near_morsel, &x);
+
+    uint32_t known_cells = s->cells;
+    float radius2 = s->p.cell_radius * s->p.cell_radius;
+    int64_t added = 0;
+    for (int64_t i = 0; i < n; i++) {
+        if (qp_spiral_find(s, labels[i]) != QP_SPIRAL_NONE) {
+            continue;
+        }
+        const float *v = vectors + (size_t)i * d;
+        uint32_t best = cell[i];
+        float best_d = dist[i];
+        for (uint32_t c = known_cells; c < s->cells; c++) {
+            float dc = quicpro_geo_sq_f32(v, s->anchors + (size_t)c * d, d);
+            if (dc < best_d) {
+                best_d = dc;
+                best = c;
+            }
+        }
+        uint32_t max_cells = 16 + (uint32_t)(4.0 * sqrt((double)s->count + 1));
+        qp_spiral_reserve(s, s->count + 1, s->cells + 1);
+        if (best == QP_SPIRAL_NONE || (best_d > radius2 && s->cells < max_cells)) {
+            best = s->cells++;
+            memcpy(s->anchors + (size_t)best * d, v, d * sizeof(float));
+            s->heads[best] = QP_SPIRAL_NONE;
+            s->radii[best] = 0;
+        } else {
+            s->radii[best] = MAX(s->radii[best], sqrtf(best_d));
+        }
+
+        uint32_t node = (uint32_t)s->count++;
+        s->labels[node] = labels[i];
+        memcpy(s->vectors + (size_t)node * d, v, d * sizeof(float));
+        s->resonance[node] = resonance ? resonance[i] : 0;
+        s->flags[node] = 0;
+        s->versions[node] = s->version;
+        s->next[node] = s->heads[best];
+        s->heads[best] = node;
+        qp_spiral_slot_put(s, node);
+        if (flags && flags[i] & QP_SPIRAL_CORE) {
+            qp_spiral_promote(s, node);
+        }
+        added++;
+    }
+    pefree(cell, 1);
+    pefree(dist, 1);
+    return added;
+}
+
+int64_t quicpro_spiral_add(quicpro_spiral_t *s, const float *vectors, int64_t n, const int64_t *labels)
+{
+    size_t d = s->p.dims;
+    float *unit = pemalloc((size_t)MAX(n, 1) * d * sizeof(float), 1);
+    for (int64_t i = 0; i < n; i++) {
+        qp_spiral_normalise(unit + (size_t)i * d, vectors + (size_t)i * d, d);
+    }
+    pthread_rwlock_wrlock(&s->lock);
+    s->version++;
+    int64_t added = qp_spiral_add_locked(s, unit, n, labels, NULL, NULL);
+    if (!added) {
+        s->version--;
+    }
+    pthread_rwlock_unlock(&s->lock);
+    pefree(unit, 1);
+    return added;
+}
+
+/*──────────────────────────── Searching ──────────────────────────────────*/
+
+/* The k best of a search so far: a binary heap, farthest on top */
+typedef struct {
+    float    *d;
+    uint32_t *node;
+    uint32_t  n, k;
+} qp_spiral_best;
+
+static void qp_spiral_offer(qp_spiral_best *b, float dist, uint32_t node)
+{
+    uint32_t i;
+    if (b->n < b->k) {
+        i = b->n++;
+        while (i > 0 && b->d[(i - 1) / 2] < dist) {
+            b->d[i] = b->d[(i - 1) / 2];
+            b->node[i] = b->node[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+    } else if (dist < b->d[0]) {
+        i = 0;
+        for (;;) {
+            uint32_t c = 2 * i + 1;
+            if (c >= b->n) {
+                break;
+            }
+            if (c + 1 < b->n && b->d[c + 1] > b->d[c]) {
+                c++;
+            }
+            if (b->d[c] <= dist) {
+                break;
+            }
+            b->d[i] = b->d[c];
+            b->node[i] = b->node[c];
+            i = c;
+        }
+    } else {
+        return;
+    }
+    b->d[i] = dist;
+    b->node[i] = node;
+}
+
+typedef struct {
+    quicpro_spiral_t *s;
+    const float      *queries;
+    uint32_t          k;
+    uint32_t          rings;
+    uint32_t         *nodes;                /* k per query, QP_SPIRAL_NONE past the last */
+    float            *scores;
+} qp_spiral_search_ctx;
+
+static void qp_spiral_search_morsel(void *ctx, size_t morsel, int64_t begin, int64_t end)
+{
+    const qp_spiral_search_ctx *x = ctx;
+    const quicpro_spiral_t *s = x->s;
+    size_t d = s->p.dims;
+    uint32_t k = x->k, rings = x->rings;
+    float *q = malloc(d * sizeof(float));
+    float *lb = malloc((size_t)MAX(s->cells, 1) * sizeof(float));
+    uint32_t *order = malloc((size_t)MAX(s->cells, 1) * sizeof(uint32_t));
+    uint32_t *ring_at = malloc((size_t)(rings + 1) * sizeof(uint32_t));
+    qp_spiral_best b = { malloc(k * sizeof(float)), malloc(k * sizeof(uint32_t)), 0, k };
+    float core_d = 2.0f * (1.0f - s->p.threshold);     /* Squared distance of the threshold similarity */
+
+    for (int64_t i = begin; i < end; i++) {
+        qp_spiral_normalise(q, x->queries + (size_t)i * d, d);
+        b.n = 0;
+        for (uint32_t j = 0; j < s->core_n; j++) {
+            qp_spiral_offer(&b, quicpro_geo_sq_f32(q, qp_spiral_vec(s, s->core[j]), d), s->core[j]);
+        }
+
+        if (b.n < k || b.d[0] > core_d) {
+            /* Rings of the least distance a cell's points can have; counted, then placed */
+            memset(ring_at, 0, (size_t)(rings + 1) * sizeof(uint32_t));
+            for (uint32_t c = 0; c < s->cells; c++) {
+                float dc = sqrtf(quicpro_geo_sq_f32(q, s->anchors + (size_t)c * d, d));
+                lb[c] = MAX(dc - s->radii[c], 0.0f);
+                ring_at[MIN((uint32_t)(lb[c] / s->p.step), rings - 1) + 1]++;
+            }
+            for (uint32_t r = 0; r < rings; r++) {
+                ring_at[r + 1] += ring_at[r];
+            }
+            for (uint32_t c = 0; c < s->cells; c++) {
+                order[ring_at[MIN((uint32_t)(lb[c] / s->p.step), rings - 1)]++] = c;
+            }
+            /* ring_at[r] is now where ring r ends */
+            uint32_t from = 0;
+            for (uint32_t r = 0; r < rings; r++) {
+                for (uint32_t o = from; o < ring_at[r]; o++) {
+                    uint32_t c = order[o];
+                    if (b.n == k && lb[c] * lb[c] >= b.d[0]) {
+                        continue;
+                    }
+                    for (uint32_t node = s->heads[c]; node != QP_SPIRAL_NONE; node = s->next[node]) {
+                        if (!(s->flags[node] & QP_SPIRAL_CORE)) {
+                            qp_spiral_offer(&b, quicpro_geo_sq_f32(q, qp_spiral_vec(s, node), d), node);
+                        }
+                    }
+                }
+                from = ring_at[r];
+                float beyond = (float)(r + 1) * s->p.step;
+                if (b.n == k && b.d[0] <= beyond * beyond) {
+                    break;
+                }
+            }
+        }
+
+        /* Nearest first: pop the heap from the back */
+        uint32_t *nodes = x->nodes + (size_t)i * k;
+        float *scores = x->scores + (size_t)i * k;
+        uint32_t found = b.n;
+        for (uint32_t j = found; j < k; j++) {
+            nodes[j] = QP_SPIRAL_NONE;
+            scores[j] = 0;
+        }
+        while (b.n) {
+            uint32_t j = b.n - 1;
+            nodes[j] = b.node[0];
+            scores[j] = 1.0f - b.d[0] / 2.0f;
+            float last_d = b.d[j];
+            uint32_t last_node = b.node[j];
+            b.n--;
+            if (b.n) {
+                /* Sift the last entry down from the top */
+                uint32_t at = 0;
+                for (;;) {
+                    uint32_t c = 2 * at + 1;
+                    if (c >= b.n) {
+                        break;
+                    }
+                    if (c + 1 < b.n && b.d[c + 1] > b.d[c]) {
+                        c++;
+                    }
+                    if (b.d[c] <= last_d) {
+                        break;
+                    }
+                    b.d[at] = b.d[c];
+                    b.node[at] = b.node[c];
+                    at = c;
+                }
+                b.d[at] = last_d;
+                b.node[at] = last_node;
+            }
+        }
+    }
+    free(q);
+    free(lb);
+    free(order);
+    free(ring_at);
+    free(b.d);
+    free(b.node);
+}
+
+int64_t quicpro_spiral_search(quicpro_spiral_t *s, const float *queries, int64_t n, uint32_t k, bool consolidate,
+                              int64_t *labels, float *scores)
+{
+    uint32_t *nodes = pemalloc((size_t)MAX(n, 1) * k * sizeof(uint32_t), 1);
+    qp_spiral_search_ctx x = { s, queries, k, (uint32_t)ceilf(2.0f / s->p.step) + 1, nodes, scores };
+    pthread_rwlock_rdlock(&s->lock);
+    quicpro_df_parallel(n, qp_spiral_search_morsel, &x);
+    for (size_t i = 0; i < (size_t)n * k; i++) {
+        labels[i] = nodes[i] == QP_SPIRAL_NONE ? -1 : s->labels[nodes[i]];
+    }
+    pthread_rwlock_unlock(&s->lock);
+
+    /* Points are never removed, so the nodes found still are what they were */
+    int64_t promoted = 0;
+    if (consolidate && n) {
+        pthread_rwlock_wrlock(&s->lock);
+        s->version++;
+        for (size_t i = 0; i < (size_t)n * k; i++) {
+            uint32_t node = nodes[i];
+            if (node == QP_SPIRAL_NONE) {
+                continue;
+            }
+            s->resonance[node] += QP_SPIRAL_RATE * (MAX(scores[i], 0.0f) - s->resonance[node]);
+            if (!(s->flags[node] & QP_SPIRAL_CORE) && s->resonance[node] >= s->p.threshold) {
+                qp_spiral_promote(s, node);
+                promoted++;
+            }
+        }
+        if (!promoted) {
+            s->version--;
+        }
+        pthread_rwlock_unlock(&s->lock);
+    }
+    pefree(nodes, 1);
+    return promoted;
+}
+
+/*──────────────────────────── Deltas ─────────────────────────────────────*/
+
+uint64_t quicpro_spiral_delta(quicpro_spiral_t *s, uint64_t since, smart_str *into)
+{
+    pthread_rwlock_rdlock(&s->lock);
+    size_t d = s->p.dims;
+    qp_spiral_delta_head head = { .dims = (uint32_t)d, .version = s->version };
+    memcpy(head.magic, QP_SPIRAL_DELTA, sizeof(head.magic));
+    for (int64_t node = 0; node < s->count; node++) {
+        head.count += s->versions[node] > since;
+    }
+    smart_str_appendl(into, (const char *)&head, sizeof(head));
+    for (uint32_t node = 0; node < (uint32_t)s->count; node++) {
+        if (s->versions[node] <= since) {
+            continue;
+        }
+        qp_spiral_record r = { s->labels[node], s->resonance[node], s->flags[node], { 0 } };
+        smart_str_appendl(into, (const char *)&r, sizeof(r));
+        smart_str_appendl(into, (const char *)qp_spiral_vec(s, node), d * sizeof(float));
+    }
+    uint64_t version = s->version;
+    pthread_rwlock_unlock(&s->lock);
+    return version;
+}
+
+int64_t quicpro_spiral_apply_delta(quicpro_spiral_t *s, const char *delta, size_t len, char *err, size_t err_len)
+{
+    qp_spiral_delta_head head;
+    size_t d = s->p.dims, rec = sizeof(qp_spiral_record) + d * sizeof(float);
+    if (len < sizeof(head)) {
+        snprintf(err, err_len, "not a space delta");
+        return -1;
+    }
+    memcpy(&head, delta, sizeof(head));
+    if (memcmp(head.magic, QP_SPIRAL_DELTA, sizeof(head.magic)) != 0) {
+        snprintf(err, err_len, "not a space delta");
+        return -1;
+    }
+    if (head.dims != d) {
+        snprintf(err, err_len, "delta of %u dimensions for a space of %zu", head.dims, d);
+        return -1;
+    }
+    if (head.count > (len - sizeof(head)) / rec || (len - sizeof(head)) != head.count * rec) {
+        snprintf(err, err_len, "delta is truncated or corrupt");
+        return -1;
+    }
+
+    /* The records, unaligned in `delta`: new points are gathered to be added as one batch */
+    size_t n = (size_t)head.count;
+    float *vectors = pemalloc(MAX(n, 1) * d * sizeof(float), 1);
+    int64_t *labels = pemalloc(MAX(n, 1) * sizeof(int64_t), 1);
+    float *resonance = pemalloc(MAX(n, 1) * sizeof(float), 1);
+    uint8_t *flags = pemalloc(MAX(n, 1), 1);
+    size_t fresh = 0;
+    int64_t changed = 0;
+
+    pthread_rwlock_wrlock(&s->lock);
+    s->version++;
+    const char *p = delta + sizeof(head);
+    for (size_t i = 0; i < n; i++, p += rec) {
+        qp_spiral_record r;
+        memcpy(&r, p, sizeof(r));
+        uint32_t node = qp_spiral_find(s, r.label);
+        if (node == QP_SPIRAL_NONE) {
+            labels[fresh] = r.label;
+            resonance[fresh] = r.resonance;
+            flags[fresh] = r.flags;
+            memcpy(vectors + fresh * d, p + sizeof(r), d * sizeof(float));
+            fresh++;
+            continue;
+        }
+        bool touched = false;
+        if (r.resonance > s->resonance[node]) {
+            s->resonance[node] = r.resonance;
+            touched = true;
+        }
+        if (r.flags & QP_SPIRAL_CORE && !(s->flags[node] & QP_SPIRAL_CORE)) {
+            qp_spiral_promote(s, node);
+            touched = true;
+        }
+        if (touched) {
+            s->versions[node] = s->version;
+            changed++;
+        }
+    }
+    changed += qp_spiral_add_locked(s, vectors, (int64_t)fresh, labels, resonance, flags);
+    if (!changed) {
+        s->version--;
+    }
+    pthread_rwlock_unlock(&s->lock);
+
+    pefree(vectors, 1);
+    pefree(labels, 1);
+    pefree(resonance, 1);
+    pefree(flags, 1);
+    return changed;
+}
+
+/*──────────────────────────── Files ──────────────────────────────────────*/
+
+static bool qp_spiral_write_all(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+    while (len) {
+        ssize_t w = write(fd, p, len);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        len -= (size_t)w;
+    }
+    return true;
+}
+
+bool quicpro_spiral_save(quicpro_spiral_t *s, const char *path, char *err, size_t err_len)
+{
+    char tmp[PATH_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid()) >= (int)sizeof(tmp)) {
+        snprintf(err, err_len, "space path too long");
+        return false;
+    }
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        snprintf(err, err_len, "cannot write %s: %s", tmp, strerror(errno));
+        return false;
+    }
+
+    pthread_rwlock_rdlock(&s->lock);
+    qp_spiral_head head = { .dims = (uint32_t)s->p.dims, .step = s->p.step, .threshold = s->p.threshold,
+                            .cell_radius = s->p.cell_radius, .count = (uint64_t)s->count, .cells = s->cells,
+                            .core = s->core_n, .slots = s->slot_cap, .version = s->version };
+    memcpy(head.magic, QP_SPIRAL_MAGIC, sizeof(head.magic));
+    void **section[QP_S_SECTIONS];
+    uint64_t size[QP_S_SECTIONS], at = ZEND_MM_ALIGNED_SIZE_EX(sizeof(head), QP_SPIRAL_ALIGN);
+    qp_spiral_sections(s, head.count, head.cells, head.core, head.slots, section, size);
+    for (int i = 0; i < QP_S_SECTIONS; i++) {
+        head.at[i] = at;
+        at = ZEND_MM_ALIGNED_SIZE_EX(at + size[i], QP_SPIRAL_ALIGN);
+    }
+    static const char pad[QP_SPIRAL_ALIGN];
+    bool ok = qp_spiral_write_all(fd, &head, sizeof(head));
+    uint64_t written = sizeof(head);
+    for (int i = 0; i < QP_S_SECTIONS && ok; i++) {
+        ok = qp_spiral_write_all(fd, pad, head.at[i] - written) && (!size[i] || qp_spiral_write_all(fd, *section[i], size[i]));
+        written = head.at[i] + size[i];
+    }
+    pthread_rwlock_unlock(&s->lock);
+
+    if (!ok || close(fd) < 0 || rename(tmp, path) < 0) {
+        snprintf(err, err_len, "cannot write %s: %s", path, strerror(errno));
+        if (!ok) close(fd);
+        unlink(tmp);
+        return false;
+    }
+    return true;
+}
+
+quicpro_spiral_t *quicpro_spiral_load(const char *path, char *err, size_t err_len)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        snprintf(err, err_len, "cannot open %s: %s", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(qp_spiral_head)) {
+        snprintf(err, err_len, "%s is not a semantic space", path);
+        close(fd);
+        return NULL;
+    }
+    /* Private: resonance a search updates is copied on write, and never reaches the file */
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        snprintf(err, err_len, "cannot map %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    const qp_spiral_head *head = map;
+    quicpro_spiral_params_t p = { head->dims, head->step, head->threshold, head->cell_radius };
+    if (memcmp(head->magic, QP_SPIRAL_MAGIC, sizeof(head->magic)) != 0 || !p.dims || !(p.step > 0) || p.step > 2
+        || head->count >= UINT32_MAX || head->cells > head->count || head->core > head->count
+        || head->slots > UINT32_MAX || (head->slots & (head->slots - 1)) || head->slots < head->count * 2) {
+        snprintf(err, err_len, "%s is not a semantic space", path);
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    quicpro_spiral_t *s = qp_spiral_alloc(&p);
+    void **section[QP_S_SECTIONS];
+    uint64_t size[QP_S_SECTIONS];
+    qp_spiral_sections(s, head->count, head->cells, head->core, head->slots, section, size);
+    for (int i = 0; i < QP_S_SECTIONS; i++) {
+        if (head->at[i] % QP_SPIRAL_ALIGN || head->at[i] > (uint64_t)st.st_size || size[i] > (uint64_t)st.st_size - head->at[i]) {
+            snprintf(err, err_len, "%s is truncated or corrupt", path);
+            munmap(map, (size_t)st.st_size);
+            quicpro_spiral_release(s);
+            return NULL;
+        }
+    }
+    for (int i = 0; i < QP_S_SECTIONS; i++) {
+        *section[i] = (char *)map + head->at[i];
+    }
+    s->count = s->capacity = (int64_t)head->count;
+    s->cells = s->cell_cap = (uint32_t)head->cells;
+    s->core_n = s->core_cap = (uint32_t)head->core;
+    s->slot_cap = (uint32_t)head->slots;
+    s->version = head->version;
+    s->map = map;
+    s->map_len = (size_t)st.st_size;
+    return s;
+}
@@ -0,0 +1,469 @@
+/*
+ * src/server/access_log.c – Native access log in a binary ring
+ * ============================================================
+ *
+ * See include/server/access_log.h. Each ring has one producer, its PHP
+ * thread, and one consumer, the writer thread: `tail` is published with
+ * a release store once a record is complete, `head` once the writer has
+ * written it out. The writer only touches libc; it renders JSON with
+ * snprintf() into a buffer of its own.
+ *
+ * A forked worker starts over: the child drops the rings it inherited
+ * (the parent writes those) and starts its own writer with its first
+ * record.
+ */
+
+#include "php_quicpro.h"
+#include "server/access_log.h"
+#include "server/metrics.h"
+#include "config/cluster_and_process/base_layer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(quicpro_access_record_t) == QUICPRO_ACCESS_RECORD_SIZE, "access log record size");
+
+#define QP_AL_JSON_MAX    1536                  /* One rendered record; the path escapes to at most 6x */
+#define QP_AL_BUF         (256 * 1024)          /* The writer's JSON batch */
+#define QP_AL_IOV         64
+
+static const char *const quicpro_access_log_methods[] = {
+    NULL, "GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS", "CONNECT", "TRACE"
+};
+static const char *const quicpro_access_log_protocols[] = { "", "HTTP/1.1", "HTTP/2", "MCP" };
+
+typedef struct qp_al_ring_s {
+    _Alignas(64) _Atomic uint64_t head;         /* Writer */
+    _Alignas(64) _Atomic uint64_t tail;         /* Producer */
+    _Atomic bool  signaled;                     /* The writer was woken for this ring and has not drained it yet */
+    uint64_t      mask;
+    struct qp_al_ring_s *next;
+    _Alignas(64) quicpro_access_record_t records[];
+} qp_al_ring_t;
+
+static ZEND_TLS qp_al_ring_t *qp_al_ring;
+
+static struct {
+    pthread_mutex_t  lock;                      /* Guards `rings` */
+    qp_al_ring_t    *rings;
+    bool             started, failed;
+    bool             json;
+    int              fd, wake_fd;
+    pthread_t        thread;
+    _Atomic bool     stopping;
+} qp_al = { .lock = PTHREAD_MUTEX_INITIALIZER, .fd = -1, .wake_fd = -1 };
+
+/*──────────────────────────── Rendering ──────────────────────────────────*/
+
+static size_t qp_al_escape(char *out, const char *s, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            out[n++] = '\\';
+            out[n++] = (char)c;
+        } else if (c < 0x20 || c == 0x7f) {
+            memcpy(out + n, "\\u00", 4);
+            out[n + 4] = hex[c >> 4];
+            out[n + 5] = hex[c & 0xf];
+            n += 6;
+        } else {
+            out[n++] = (char)c;
+        }
+    }
+    return n;
+}
+
+/* One JSON line; `out` holds QP_AL_JSON_MAX bytes */
+static size_t qp_al_render(const quicpro_access_record_t *r, char *out)
+{
+    static const char hex[] = "0123456789abcdef";
+    char when[32], peer[INET6_ADDRSTRLEN] = "", cid[2 * QUICHE_MAX_CONN_ID_LEN + 1], path[6 * sizeof(r->path)];
+    time_t sec = (time_t)(r->ts_ns / 1000000000);
+    struct tm tm;
+    gmtime_r(&sec, &tm);
+    strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S", &tm);
+
+    if (r->peer_family == 4) {
+        inet_ntop(AF_INET, r->peer, peer, sizeof(peer));
+    } else if (r->peer_family == 6) {
+        inet_ntop(AF_INET6, r->peer, peer, sizeof(peer));
+    }
+    size_t cid_len = MIN(r->cid_len, QUICHE_MAX_CONN_ID_LEN);
+    for (size_t i = 0; i < cid_len; i++) {
+        cid[2 * i] = hex[r->cid[i] >> 4];
+        cid[2 * i + 1] = hex[r->cid[i] & 0xf];
+    }
+    cid[2 * cid_len] = '\0';
+    size_t path_len = qp_al_escape(path, r->path, MIN(r->path_len, sizeof(r->path)));
+    const char *method = r->method < sizeof(quicpro_access_log_methods) / sizeof(*quicpro_access_log_methods)
+        ? quicpro_access_log_methods[r->method] : NULL;
+    const char *protocol = r->protocol < sizeof(quicpro_access_log_protocols) / sizeof(*quicpro_access_log_protocols)
+        ? quicpro_access_log_protocols[r->protocol] : "";
+
+    int n = snprintf(out, QP_AL_JSON_MAX,
+        "{\"ts\":\"%s.%06uZ\",\"protocol\":\"%s\",\"method\":\"%s\",\"path\":\"%.*s\",\"status\":%u,"
+        "\"duration_us\":%u,\"bytes_in\":%llu,\"bytes_out\":%llu,\"peer\":\"%s%s%s:%u\"",
+        when, (unsigned)(r->ts_ns % 1000000000 / 1000), protocol, method ? method : "OTHER",
+        (int)path_len, path, r->status, r->duration_us,
+        (unsigned long long)r->bytes_in, (unsigned long long)r->bytes_out,
+        r->peer_family == 6 ? "[" : "", peer, r->peer_family == 6 ? "]" : "", r->peer_port);
+    if (r->protocol != QUICPRO_ACCESS_HTTP1 && n > 0 && n < QP_AL_JSON_MAX) {
+        n += snprintf(out + n, QP_AL_JSON_MAX - (size_t)n, ",\"stream_id\":%llu", (unsigned long long)r->stream_id);
+    }
+    if (r->cid_len && n > 0 && n < QP_AL_JSON_MAX) {
+        n += snprintf(out + n, QP_AL_JSON_MAX - (size_t)n, ",\"cid\":\"%s\",\"rtt_us\":%u", cid, r->rtt_us);
+    }
+    if (n <= 0 || n >= QP_AL_JSON_MAX - 2) {
+        return 0;
+    }
+    out[n++] = '}';
+    out[n++] = '\n';
+    return (size_t)n;
+}
+
+/*──────────────────────────── Writer ─────────────────────────────────────*/
+
+static void qp_al_write_all(int fd, const char *p, size_t len)
+{
+    while (len) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;     /* A full disk loses the batch, not the worker */
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+/* Records [from, to) of `ring` as they are, one writev(2) per contiguous run */
+static void qp_al_write_binary(qp_al_ring_t *ring, uint64_t from, uint64_t to)
+{
+    while (from < to) {
+        struct iovec iov[2];
+        int cnt = 0;
+        uint64_t first = from & ring->mask, left = to - from;
+        uint64_t run = MIN(left, ring->mask + 1 - first);
+        iov[cnt++] = (struct iovec){ &ring->records[first], run * sizeof(quicpro_access_record_t) };
+        if (left > run) {
+            iov[cnt++] = (struct iovec){ &ring->records[0], (left - run) * sizeof(quicpro_access_record_t) };
+        }
+        ssize_t n = writev(qp_al.fd, iov, cnt);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        /* A short write: finish the record it cut, carry on from the next */
+        uint64_t whole = (uint64_t)n / sizeof(quicpro_access_record_t);
+        size_t part = (size_t)n % sizeof(quicpro_access_record_t);
+        if (part) {
+            const char *rec = (const char *)&ring->records[(from + whole) & ring->mask];
+            qp_al_write_all(qp_al.fd, rec + part, sizeof(quicpro_access_record_t) - part);
+            whole++;
+        }
+        from += whole;
+    }
+}
+
+static void qp_al_drain(char *buf)
+{
+    size_t used = 0;
+    pthread_mutex_lock(&qp_al.lock);
+    for (qp_al_ring_t *ring = qp_al.rings; ring; ring = ring->next) {
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head == tail) {
+            continue;
+        }
+        if (qp_al.json) {
+            for (uint64_t i = head; i < tail; i++) {
+                if (QP_AL_BUF - used < QP_AL_JSON_MAX) {
+                    qp_al_write_all(qp_al.fd, buf, used);
+                    used = 0;
+                }
+                used += qp_al_render(&ring->records[i & ring->mask], buf + used);
+            }
+        } else {
+            qp_al_write_binary(ring, head, tail);
+        }
+        atomic_store_explicit(&ring->head, tail, memory_order_release);
+        atomic_store_explicit(&ring->signaled, false, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&qp_al.lock);
+    if (used) {
+        qp_al_write_all(qp_al.fd, buf, used);
+    }
+}
+
+static void *qp_al_main(void *arg)
+{
+    int flush_ms = (int)(intptr_t)arg;
+    char *buf = qp_al.json ? malloc(QP_AL_BUF) : NULL;
+    if (qp_al.json && !buf) {
+        return NULL;
+    }
+    for (;;) {
+        struct pollfd pfd = { .fd = qp_al.wake_fd, .events = POLLIN };
+        if (poll(&pfd, 1, flush_ms) > 0) {
+            uint64_t count;
+            (void)!read(qp_al.wake_fd, &count, sizeof(count));
+        }
+        bool stopping = atomic_load_explicit(&qp_al.stopping, memory_order_acquire);
+        qp_al_drain(buf);
+        if (stopping) {
+            break;
+        }
+    }
+    free(buf);
+    return NULL;
+}
+
+/*──────────────────────────── Setup ──────────────────────────────────────*/
+
+/* In a forked child: the rings and the writer were the parent's */
+static void qp_al_atfork_child(void)
+{
+    pthread_mutex_init(&qp_al.lock, NULL);
+    qp_al.rings = NULL;         /* Still the parent's to write; the copies are left alone */
+    qp_al.started = qp_al.failed = false;
+    if (qp_al.fd >= 0) close(qp_al.fd);
+    if (qp_al.wake_fd >= 0) close(qp_al.wake_fd);
+    qp_al.fd = qp_al.wake_fd = -1;
+    qp_al_ring = NULL;
+}
+
+static bool qp_al_start(void)
+{
+    static bool atfork;
+    if (!atfork) {
+        atfork = true;
+        pthread_atfork(NULL, NULL, qp_al_atfork_child);
+    }
+    const char *dir = quicpro_cluster_config.access_log_dir;
+    qp_al.json = strcmp(quicpro_cluster_config.access_log_format, "binary") != 0;
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/access-%d.log", dir && *dir ? dir : ".", (int)getpid());
+    qp_al.fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0640);
+    if (qp_al.fd < 0) {
+        php_error_docref(NULL, E_WARNING, "Access log disabled: cannot open '%s': %s", path, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (!qp_al.json && fstat(qp_al.fd, &st) == 0 && st.st_size == 0) {
+        char header[sizeof(QUICPRO_ACCESS_LOG_MAGIC) - 1 + sizeof(uint32_t)];
+        uint32_t size = QUICPRO_ACCESS_RECORD_SIZE;
+        memcpy(header, QUICPRO_ACCESS_LOG_MAGIC, sizeof(QUICPRO_ACCESS_LOG_MAGIC) - 1);
+        memcpy(header + sizeof(QUICPRO_ACCESS_LOG_MAGIC) - 1, &size, sizeof(size));
+        qp_al_write_all(qp_al.fd, header, sizeof(header));
+    }
+    qp_al.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    atomic_store(&qp_al.stopping, false);
+    intptr_t flush_ms = MAX(quicpro_cluster_config.access_log_flush_ms, 1);
+    if (qp_al.wake_fd < 0 || pthread_create(&qp_al.thread, NULL, qp_al_main, (void *)flush_ms) != 0) {
+        php_error_docref(NULL, E_WARNING, "Access log disabled: cannot start its writer thread");
+        close(qp_al.fd);
+        if (qp_al.wake_fd >= 0) close(qp_al.wake_fd);
+        qp_al.fd = qp_al.wake_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+/* This thread's ring, and the process's writer, on first use */
+static qp_al_ring_t *qp_al_attach(void)
+{
+    pthread_mutex_lock(&qp_al.lock);
+    if (!qp_al.started && !qp_al.failed) {
+        qp_al.started = qp_al_start();
+        qp_al.failed = !qp_al.started;
+    }
+    qp_al_ring_t *ring = NULL;
+    if (qp_al.started) {
+        uint64_t n = 64;
+        while (n < (uint64_t)quicpro_cluster_config.access_log_ring_records && n < (1u << 24)) {
+            n <<= 1;
+        }
+        ring = pecalloc(1, sizeof(*ring) + n * sizeof(quicpro_access_record_t), 1);
+        ring->mask = n - 1;
+        ring->next = qp_al.rings;
+        qp_al.rings = ring;
+    }
+    pthread_mutex_unlock(&qp_al.lock);
+    return ring;
+}
+
+/*──────────────────────────── Producer ───────────────────────────────────*/
+
+bool quicpro_access_log_enabled(void)
+{
+    return quicpro_cluster_config.access_log_enable;
+}
+
+quicpro_access_record_t *quicpro_access_log_begin(void)
+{
+    if (!quicpro_access_log_enabled()) {
+        return NULL;
+    }
+    qp_al_ring_t *ring = qp_al_ring;
+    if (!ring && (qp_al.failed || !(ring = qp_al_ring = qp_al_attach()))) {
+        return NULL;
+    }
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&ring->head, memory_order_acquire) > ring->mask) {
+        quicpro_metrics_add(QUICPRO_METRIC_ACCESS_LOG_DROPPED, 1);
+        return NULL;
+    }
+    quicpro_access_record_t *r = &ring->records[tail & ring->mask];
+    memset(r, 0, sizeof(*r));
+    return r;
+}
+
+void quicpro_access_log_commit(quicpro_access_record_t *r)
+{
+    qp_al_ring_t *ring = qp_al_ring;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    r->ts_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed) + 1;
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    /* Half full: do not wait for the flush interval */
+    if (tail - atomic_load_explicit(&ring->head, memory_order_relaxed) > ring->mask / 2
+        && !atomic_exchange_explicit(&ring->signaled, true, memory_order_relaxed)) {
+        uint64_t one = 1;
+        (void)!write(qp_al.wake_fd, &one, sizeof(one));
+    }
+}
+
+void quicpro_access_log_method(quicpro_access_record_t *r, const char *method, size_t len)
+{
+    for (uint8_t i = 1; i < sizeof(quicpro_access_log_methods) / sizeof(*quicpro_access_log_methods); i++) {
+        if (strlen(quicpro_access_log_methods[i]) == len && memcmp(quicpro_access_log_methods[i], method, len) == 0) {
+            r->method = i;
+            return;
+        }
+    }
+}
+
+void quicpro_access_log_path(quicpro_access_record_t *r, const char *path, size_t len)
+{
+    r->path_len = (uint8_t)MIN(len, sizeof(r->path));
+    memcpy(r->path, path, r->path_len);
+}
+
+void quicpro_access_log_peer(quicpro_access_record_t *r, const struct sockaddr *addr)
+{
+    if (addr->sa_family == AF_INET) {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)addr;
+        r->peer_family = 4;
+        memcpy(r->peer, &in->sin_addr, 4);
+        r->peer_port = ntohs(in->sin_port);
+    } else if (addr->sa_family == AF_INET6) {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)addr;
+        r->peer_family = 6;
+        memcpy(r->peer, &in6->sin6_addr, 16);
+        r->peer_port = ntohs(in6->sin6_port);
+    }
+}
+
+void quicpro_access_log_quic(quicpro_access_record_t *r, quiche_conn *conn)
+{
+    const uint8_t *cid = NULL;
+    size_t cid_len = 0;
+    quiche_conn_source_id(conn, &cid, &cid_len);
+    r->cid_len = (uint8_t)MIN(cid_len, sizeof(r->cid));
+    memcpy(r->cid, cid, r->cid_len);
+    quiche_path_stats ps;
+    if (quiche_conn_path_stats(conn, 0, &ps) == 0) {
+        r->rtt_us = (uint32_t)MIN(ps.rtt / 1000, UINT32_MAX);
+    }
+}
+
+void quicpro_access_log_mshutdown(void)
+{
+    if (!qp_al.started) {
+        return;
+    }
+    atomic_store_explicit(&qp_al.stopping, true, memory_order_release);
+    uint64_t one = 1;
+    (void)!write(qp_al.wake_fd, &one, sizeof(one));
+    pthread_join(qp_al.thread, NULL);
+    close(qp_al.fd);
+    close(qp_al.wake_fd);
+    qp_al.fd = qp_al.wake_fd = -1;
+    while (qp_al.rings) {
+        qp_al_ring_t *next = qp_al.rings->next;
+        pefree(qp_al.rings, 1);
+        qp_al.rings = next;
+    }
+    qp_al.started = false;
+}
+
+/*──────────────────────────── PHP API ────────────────────────────────────*/
+
+PHP_FUNCTION(quicpro_access_log_convert)
+{
+    zend_string *from, *to;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_PATH_STR(from)
+        Z_PARAM_PATH_STR(to)
+    ZEND_PARSE_PARAMETERS_END();
+
+    FILE *in = fopen(ZSTR_VAL(from), "rb");
+    char header[sizeof(QUICPRO_ACCESS_LOG_MAGIC) - 1 + sizeof(uint32_t)] = {0};
+    uint32_t size = 0;
+    if (in && fread(header, 1, sizeof(header), in) == sizeof(header)) {
+        memcpy(&size, header + sizeof(QUICPRO_ACCESS_LOG_MAGIC) - 1, sizeof(size));
+    }
+    if (!in || memcmp(header, QUICPRO_ACCESS_LOG_MAGIC, sizeof(QUICPRO_ACCESS_LOG_MAGIC) - 1) != 0
+        || size != QUICPRO_ACCESS_RECORD_SIZE) {
+        if (in) fclose(in);
+        throw_mcp_error_as_php_exception(0, "quicpro_access_log_convert: the file is not a binary access log of this build.");
+        RETURN_THROWS();
+    }
+    FILE *out = fopen(ZSTR_VAL(to), "wb");
+    if (!out) {
+        fclose(in);
+        php_error_docref(NULL, E_WARNING, "cannot write '%s': %s", ZSTR_VAL(to), strerror(errno));
+        RETURN_FALSE;
+    }
+
+    zend_long count = 0;
+    quicpro_access_record_t r;
+    char line[QP_AL_JSON_MAX];
+    while (fread(&r, sizeof(r), 1, in) == 1) {
+        size_t len = qp_al_render(&r, line);
+        if (len && fwrite(line, 1, len, out) != len) {
+            break;
+        }
+        count++;
+    }
+    fclose(in);
+    if (fclose(out) != 0) {
+        php_error_docref(NULL, E_WARNING, "cannot write '%s': %s", ZSTR_VAL(to), strerror(errno));
+        RETURN_FALSE;
+    }
+    RETURN_LONG(count);
+}
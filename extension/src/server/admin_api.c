@@ -4,107 +4,969 @@
  *
  * This file contains the C-level logic for running the high-security
  * administrative endpoint. It is responsible for setting up a dedicated
- * listener that accepts mTLS-authenticated connections and applies
- * configuration changes to a running parent server instance.
+ * HTTP/3 listener that accepts only connections whose client certificate
+ * the admin CA signed, and applies configuration changes to a running
+ * parent server instance. One connection carries any number of requests,
+ * so automation keeps its connection instead of paying a handshake per
+ * operation.
+ *
+ * GET /qlog returns the process's sampled qlog events (server/qlog.h) as
+ * JSON-SEQ. POST /profile/start and /profile/stop turn the hot path
+ * profiler (server/profiler.h) on and off; GET /profile returns its folded
+ * stacks, or a pprof profile with ?format=pprof. POST /capture takes
+ * connection IDs in hex, whole or their leading bytes, and has the worker
+ * capture those connections' datagrams (server/capture.h); POST
+ * /capture/stop ends every capture, and GET /capture returns the ring as
+ * pcapng. POST /config takes a flat
+ * JSON object of settings and publishes them to the running listeners
+ * (server/live_config.h). POST /batch runs an IIBIN batch of operations and
+ * GET /events streams live events (server/admin_events.h); both are
+ * described in server/admin_api.h.
+ *
+ * An unknown DCID gets a Retry before it can take one of the few connection
+ * slots, whatever quicpro.transport_stateless_retry_enable says
+ * (server/retry.h).
+ *
+ * The listener runs on its own thread and never touches PHP: its buffers
+ * are persistent, and it reads no configuration after it started.
  */
 
 #include <php.h>
 #include <zend_exceptions.h>
 #include <pthread.h>
 #include <sys/socket.h>
+#include <sys/random.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <openssl/ssl.h>
-#include <openssl/err.h>
+#include <time.h>
 
+#include "quiche.h"
 #include "server/admin_api.h"
 #include "server/index.h" // To access quicpro_server_t internals
+#include "server/retry.h" // Address validation before a connection slot is taken
+#include "server/qlog.h" // GET /qlog: this worker's sampled connection events
+#include "server/profiler.h" // /profile: this worker's hot path timers
+#include "server/capture.h" // /capture: this worker's packet capture ring
+#include "server/live_config.h" // POST /config: settings swapped into the running listeners
+#include "server/h3_settings.h" // SETTINGS from quicpro.h3_*
+#include "config/runtime.h"
+#include "server/admin_events.h" // GET /events: the ring subscribers follow
+#include "server/rate_limit.h" // Batches: rate limit keys
+#include "server/otlp.h" // The protobuf writer for IIBIN replies
+#include "mcp/mcp_breaker.h" // Batches: draining MCP targets
+#include "iibin/iibin_internal.h" // Varint decoding for IIBIN requests
+
+#define ADMIN_MAX_CONNS         32
+#define ADMIN_MAX_BODY          (1024 * 1024)   /* Larger requests are answered 413 */
+#define ADMIN_MAX_OPS           4096            /* Per batch */
+#define ADMIN_EVENTS_BACKLOG    (256 * 1024)    /* Unsent event bytes before a subscriber waits */
+#define ADMIN_KEEPALIVE_MS      15000           /* PING for a quiet subscription */
+#define ADMIN_MAX_DATAGRAM      1500
+
+/* CRYPTO_ERROR carrying the TLS certificate_required alert (116) */
+#define ADMIN_ERR_CERTIFICATE_REQUIRED 0x174
 
 // Assume quicpro_server_t is defined in index.h and has an is_listening flag.
 // Assume quicpro_config_ce is the class entry for Quicpro\Config.
 extern int le_quicpro_server;
 extern zend_class_entry *quicpro_config_ce;
 
+// One request on one stream, from its HEADERS until its response is sent
+typedef struct admin_req_s {
+    uint64_t            stream_id;
+    char                method[8];
+    char                path[128];
+    quicpro_otlp_buf_t  body;
+    bool                too_large;
+    bool                answered;   // The whole response is in `out`
+    bool                events;     // GET /events: open until the client leaves
+    uint64_t            cursor;     // The last event queued
+    quicpro_otlp_buf_t  out;        // Response bytes flow control has not taken yet
+    size_t              out_off;
+    struct admin_req_s *next;
+} admin_req_t;
+
+typedef struct {
+    quiche_conn            *conn;   // NULL: a free slot
+    quiche_h3_conn         *h3;     // Once the handshake proved the client's certificate
+    uint8_t                 scid[QUICHE_MAX_CONN_ID_LEN];
+    struct sockaddr_storage peer;
+    socklen_t               peer_len;
+    admin_req_t            *reqs;
+    uint64_t                quiet_since_ms;
+} admin_conn_t;
+
 // Struct to pass arguments to the admin listener thread
 typedef struct {
     quicpro_server_t *target_server;
     char *host;
     int port;
-    SSL_CTX *admin_ssl_ctx; // The mTLS-configured SSL context
+    quiche_config *quic_config; // Our certificate, and the CA client certificates must chain to
+    quiche_h3_config *h3_config;
+    int fd;
+    struct sockaddr_storage local_addr;
+    socklen_t local_addr_len;
+    quicpro_retry_state_t retry; // Always in force: ADMIN_MAX_CONNS slots are cheap to fill with spoofed Initials
+    admin_conn_t conns[ADMIN_MAX_CONNS];
 } admin_thread_args_t;
 
+static uint64_t admin_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
 
-// The main function for the admin listener thread
-static void *admin_api_thread_func(void *arg)
+static void admin_buf_append(quicpro_otlp_buf_t *b, const void *data, size_t len)
 {
-    admin_thread_args_t *args = (admin_thread_args_t *)arg;
-    int listen_fd = -1;
+    if (len) {
+        quicpro_otlp_reserve(b, len);
+        memcpy(b->p + b->len, data, len);
+        b->len += len;
+    }
+}
 
-    listen_fd = socket(AF_INET6, SOCK_STREAM, 0);
-    if (listen_fd < 0) {
-        fprintf(stderr, "[Quicpro Admin API] Failed to create socket: %s\n", strerror(errno));
-        goto cleanup;
+/*──────────────────────────── Responses ──────────────────────────────────*/
+
+// Sends the headers of a response; a complete one has a length, GET /events has none
+static void admin_send_headers(admin_conn_t *c, admin_req_t *r, const char *status, const char *content_type, const size_t *length)
+{
+    char content_length[24];
+    size_t count = 0;
+    quiche_h3_header hdrs[3];
+
+    hdrs[count++] = (quiche_h3_header){ (const uint8_t *)":status", 7, (const uint8_t *)status, strlen(status) };
+    hdrs[count++] = (quiche_h3_header){ (const uint8_t *)"content-type", 12, (const uint8_t *)content_type, strlen(content_type) };
+    if (length) {
+        snprintf(content_length, sizeof(content_length), "%zu", *length);
+        hdrs[count++] = (quiche_h3_header){ (const uint8_t *)"content-length", 14, (const uint8_t *)content_length, strlen(content_length) };
     }
+    quiche_h3_send_response(c->h3, c->conn, r->stream_id, hdrs, count, false);
+}
 
-    int reuse = 1;
-    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+// A complete response with `body`; the flush sends it as flow control allows
+static void admin_respond(admin_conn_t *c, admin_req_t *r, const char *status, const char *content_type, const void *body, size_t body_len)
+{
+    admin_send_headers(c, r, status, content_type, &body_len);
+    admin_buf_append(&r->out, body, body_len);
+    r->answered = true;
+}
+
+// Answers GET /qlog with the worker's qlog ring as JSON-SEQ, or as the raw dump with ?format=binary
+static void admin_api_send_qlog(admin_conn_t *c, admin_req_t *r, bool binary)
+{
+    char *dump, *body = NULL;
+    size_t dump_len = quicpro_qlog_snapshot(&dump), body_len = 0;
+    if (binary) {
+        body = dump;
+        body_len = dump_len;
+        dump = NULL;
+    } else if (dump) {
+        quicpro_qlog_json_seq(dump, dump_len, &body, &body_len);
+    }
+
+    admin_respond(c, r, "200", binary ? "application/octet-stream" : "application/qlog+json-seq", body, body_len);
+    if (dump) pefree(dump, 1);
+    if (body) pefree(body, 1);
+}
+
+// Answers GET /profile with the profiler's folded stacks, or its pprof profile with ?format=pprof
+static void admin_api_send_profile(admin_conn_t *c, admin_req_t *r, bool pprof)
+{
+    char *body;
+    size_t body_len = pprof ? quicpro_prof_pprof(&body) : quicpro_prof_folded(&body);
+    admin_respond(c, r, "200", pprof ? "application/octet-stream" : "text/plain", body, body_len);
+    if (body) pefree(body, 1);
+}
+
+// Answers GET /capture with the worker's capture ring as pcapng
+static void admin_api_send_capture(admin_conn_t *c, admin_req_t *r)
+{
+    char *body;
+    size_t body_len = quicpro_capture_pcapng(&body);
+    admin_respond(c, r, "200", "application/x-pcapng", body, body_len);
+    if (body) pefree(body, 1);
+}
+
+// Answers POST /capture: arms the connection IDs in the body
+static void admin_api_arm_capture(admin_conn_t *c, admin_req_t *r)
+{
+    char msg[64];
+    int armed = quicpro_capture_arm(r->body.p ? (const char *)r->body.p : "", r->body.len);
+    if (armed < 0) {
+        admin_respond(c, r, "400", "text/plain", "expected connection IDs in hex, with capturing on\n", 50);
+        return;
+    }
+    int n = snprintf(msg, sizeof(msg), "armed %d\n", armed);
+    admin_respond(c, r, "200", "text/plain", msg, (size_t)n);
+}
+
+/*──────────────────────────── POST /config ───────────────────────────────*/
+
+// A JSON string at `p` (the opening quote) into `out`; the position after it, or NULL
+static const char *admin_api_json_string(const char *p, const char *end, char *out, size_t cap)
+{
+    size_t n = 0;
+    for (p++; p < end && *p != '"'; p++) {
+        char ch = *p;
+        if (ch == '\\') {
+            if (++p == end) return NULL;
+            switch (*p) {
+                case 'n': ch = '\n'; break;
+                case 't': ch = '\t'; break;
+                case '"': case '\\': case '/': ch = *p; break;
+                default: return NULL;   // \u escapes have no place in these settings
+            }
+        }
+        if (n + 1 >= cap) return NULL;
+        out[n++] = ch;
+    }
+    if (p == end) return NULL;
+    out[n] = '\0';
+    return p + 1;
+}
+
+// A flat JSON object of strings, integers and booleans into `c`
+static bool admin_api_parse_config(const char *p, const char *end, quicpro_live_config_t *c, char *err, size_t err_len)
+{
+    char key[64], value[1024];
+#define ADMIN_JSON_WS() while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++
+    ADMIN_JSON_WS();
+    if (p == end || *p++ != '{') goto bad;
+    ADMIN_JSON_WS();
+    if (p < end && *p == '}') return true;
+    for (;;) {
+        ADMIN_JSON_WS();
+        if (p == end || *p != '"' || !(p = admin_api_json_string(p, end, key, sizeof(key)))) goto bad;
+        ADMIN_JSON_WS();
+        if (p == end || *p++ != ':') goto bad;
+        ADMIN_JSON_WS();
+        if (p < end && *p == '"') {
+            if (!(p = admin_api_json_string(p, end, value, sizeof(value)))) goto bad;
+        } else {
+            size_t n = 0;
+            while (p < end && n + 1 < sizeof(value) && (*p == '-' || (*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'z'))) {
+                value[n++] = *p++;
+            }
+            value[n] = '\0';
+            if (n == 0) goto bad;
+        }
+        if (!quicpro_live_config_set(c, key, value, err, err_len)) return false;
+        ADMIN_JSON_WS();
+        if (p < end && *p == ',') { p++; continue; }
+        if (p < end && *p == '}') return true;
+        goto bad;
+    }
+#undef ADMIN_JSON_WS
+bad:
+    snprintf(err, err_len, "the body must be a flat JSON object of strings, integers and booleans");
+    return false;
+}
+
+// Answers POST /config: publishes the settings in the JSON body, 400 if any is rejected
+static void admin_api_apply_config(admin_conn_t *c, admin_req_t *r)
+{
+    char err[200], reply[64];
+    const char *body = (const char *)r->body.p;
+
+    quicpro_live_config_t *snapshot = quicpro_live_config_begin();
+    uint64_t gen = 0;
+    if (!snapshot) {
+        snprintf(err, sizeof(err), "out of memory");
+    } else if (!admin_api_parse_config(body, body + r->body.len, snapshot, err, sizeof(err))) {
+        quicpro_live_config_abort(snapshot);
+    } else {
+        gen = quicpro_live_config_commit(snapshot, err, sizeof(err));
+    }
+    if (!gen) {
+        size_t len = strlen(err);
+        err[len < sizeof(err) - 1 ? len++ : len - 1] = '\n';
+        admin_respond(c, r, "400", "text/plain", err, len);
+        return;
+    }
+    int n = snprintf(reply, sizeof(reply), "{\"generation\":%llu}\n", (unsigned long long)gen);
+    admin_respond(c, r, "200", "application/json", reply, (size_t)n);
+}
+
+/*──────────────────────────── POST /batch ────────────────────────────────*/
+
+// A reader over one IIBIN message
+typedef struct {
+    const uint8_t *p, *end;
+} admin_pb_t;
+
+typedef struct {
+    uint32_t       field;
+    uint32_t       wire;
+    uint64_t       v;       // Varint and fixed fields
+    const uint8_t *data;    // Length-delimited fields
+    size_t         len;
+} admin_pb_field_t;
+
+// The next field of `r` into `f`; false at the end, or with `*bad` set on malformed input
+static bool admin_pb_next(admin_pb_t *r, admin_pb_field_t *f, bool *bad)
+{
+    uint64_t key;
+    if (r->p >= r->end) {
+        return false;
+    }
+    if (!quicpro_iibin_decode_varint(&r->p, r->end, &key)) {
+        goto bad;
+    }
+    f->field = (uint32_t)(key >> 3);
+    f->wire = (uint32_t)(key & 7);
+    f->data = NULL;
+    f->len = 0;
+    f->v = 0;
+    switch (f->wire) {
+        case QUICPRO_IIBIN_WIRETYPE_VARINT:
+            if (!quicpro_iibin_decode_varint(&r->p, r->end, &f->v)) goto bad;
+            return true;
+        case QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM:
+            if (!quicpro_iibin_decode_varint(&r->p, r->end, &f->v) || f->v > (uint64_t)(r->end - r->p)) goto bad;
+            f->data = r->p;
+            f->len = (size_t)f->v;
+            r->p += f->len;
+            return true;
+        case QUICPRO_IIBIN_WIRETYPE_FIXED64:
+            if (r->end - r->p < 8) goto bad;
+            f->v = quicpro_iibin_load_fixed64(r->p);
+            r->p += 8;
+            return true;
+        case QUICPRO_IIBIN_WIRETYPE_FIXED32:
+            if (r->end - r->p < 4) goto bad;
+            f->v = quicpro_iibin_load_fixed32(r->p);
+            r->p += 4;
+            return true;
+    }
+bad:
+    *bad = true;
+    return false;
+}
+
+typedef struct {
+    bool ok;
+    bool setting;           // A `set`, whose fate the commit decides
+    char error[120];
+} admin_op_result_t;
+
+// Splits "host:port" (or "[v6]:port") for quicpro_mcp_drain()
+static bool admin_op_drain(const uint8_t *target, size_t len, bool drained, admin_op_result_t *res)
+{
+    const uint8_t *colon = NULL;
+    for (size_t i = 0; i < len; i++) {
+        if (target[i] == ':') colon = target + i;
+    }
+    unsigned long port = 0;
+    size_t digits = colon ? len - (size_t)(colon - target) - 1 : 0;
+    for (size_t i = 0; i < digits; i++) {
+        if (colon[1 + i] < '0' || colon[1 + i] > '9' || port > 65535) {
+            digits = 0;
+            break;
+        }
+        port = port * 10 + (unsigned long)(colon[1 + i] - '0');
+    }
+    const uint8_t *host = target;
+    size_t host_len = colon ? (size_t)(colon - target) : 0;
+    if (host_len >= 2 && host[0] == '[' && host[host_len - 1] == ']') {
+        host++;
+        host_len -= 2;
+    }
+    if (!host_len || !digits || port > 65535) {
+        snprintf(res->error, sizeof(res->error), "a drain target is host:port");
+        return false;
+    }
+    if (!quicpro_mcp_drain((const char *)host, host_len, (uint16_t)port, drained)) {
+        snprintf(res->error, sizeof(res->error), "no room to drain another target");
+        return false;
+    }
+    return true;
+}
+
+// A RateLimitKey { string key = 1; uint64 block_ms = 2; }
+static bool admin_op_rate_limit(const uint8_t *msg, size_t len, admin_op_result_t *res)
+{
+    admin_pb_t r = { msg, msg + len };
+    admin_pb_field_t f;
+    bool bad = false;
+    const uint8_t *key = NULL;
+    size_t key_len = 0;
+    uint64_t block_ms = 0;
+    while (admin_pb_next(&r, &f, &bad)) {
+        if (f.field == 1 && f.wire == QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM) {
+            key = f.data;
+            key_len = f.len;
+        } else if (f.field == 2 && f.wire == QUICPRO_IIBIN_WIRETYPE_VARINT) {
+            block_ms = f.v;
+        }
+    }
+    if (bad || !key) {
+        snprintf(res->error, sizeof(res->error), "a rate_limit operation needs a key");
+        return false;
+    }
+    if (!quicpro_rate_limit_set(key, key_len, block_ms)) {
+        snprintf(res->error, sizeof(res->error), "the rate limiter is disabled or its table is full");
+        return false;
+    }
+    return true;
+}
+
+// A Setting { string key = 1; string value = 2; } into the batch's snapshot
+static bool admin_op_set(const uint8_t *msg, size_t len, quicpro_live_config_t **snapshot, admin_op_result_t *res)
+{
+    admin_pb_t r = { msg, msg + len };
+    admin_pb_field_t f;
+    bool bad = false;
+    char key[64] = "", value[1024] = "";
+    while (admin_pb_next(&r, &f, &bad)) {
+        char *into = f.field == 1 ? key : f.field == 2 ? value : NULL;
+        size_t cap = f.field == 1 ? sizeof(key) : sizeof(value);
+        if (into && f.wire == QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM) {
+            if (f.len >= cap) {
+                bad = true;
+                break;
+            }
+            memcpy(into, f.data, f.len);
+            into[f.len] = '\0';
+        }
+    }
+    res->setting = true;
+    if (bad || !key[0]) {
+        snprintf(res->error, sizeof(res->error), "a set operation needs a key and a value");
+        return false;
+    }
+    if (!*snapshot && !(*snapshot = quicpro_live_config_begin())) {
+        snprintf(res->error, sizeof(res->error), "out of memory");
+        return false;
+    }
+    return quicpro_live_config_set(*snapshot, key, value, res->error, sizeof(res->error));
+}
+
+// Runs one AdminOp; see server/admin_api.h for its fields
+static void admin_op_run(const uint8_t *msg, size_t len, quicpro_live_config_t **snapshot, admin_op_result_t *res)
+{
+    admin_pb_t r = { msg, msg + len };
+    admin_pb_field_t f;
+    bool bad = false, seen = false;
+    while (!seen && admin_pb_next(&r, &f, &bad)) {
+        bool delim = f.wire == QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM;
+        seen = true;
+        if ((f.field == 1 || f.field == 2) && delim) {
+            res->ok = admin_op_drain(f.data, f.len, f.field == 1, res);
+        } else if (f.field == 3 && delim) {
+            res->ok = admin_op_rate_limit(f.data, f.len, res);
+        } else if (f.field == 4 && delim) {
+            res->ok = admin_op_set(f.data, f.len, snapshot, res);
+        } else if (f.field == 5 && f.wire == QUICPRO_IIBIN_WIRETYPE_VARINT) {
+            quicpro_prof_set_enabled(f.v != 0);
+            res->ok = true;
+        } else {
+            seen = false;   // Unknown fields are skipped, as IIBIN does
+        }
+    }
+    if (!seen) {
+        snprintf(res->error, sizeof(res->error), bad ? "malformed operation" : "unknown operation");
+    }
+}
+
+// Answers POST /batch: every operation of the AdminBatch, then one AdminBatchResult
+static void admin_api_run_batch(admin_conn_t *c, admin_req_t *r)
+{
+    admin_pb_t rd = { r->body.p, r->body.p + r->body.len };
+    admin_pb_field_t f;
+    bool bad = false;
+    size_t ops = 0;
+    while (admin_pb_next(&rd, &f, &bad)) {
+        ops += f.field == 1 && f.wire == QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM;
+    }
+    if (bad || ops > ADMIN_MAX_OPS) {
+        const char *why = bad ? "malformed batch\n" : "too many operations\n";
+        admin_respond(c, r, bad ? "400" : "413", "text/plain", why, strlen(why));
+        return;
+    }
+
+    admin_op_result_t *results = calloc(ops ? ops : 1, sizeof(*results));
+    if (!results) {
+        admin_respond(c, r, "503", "text/plain", "out of memory\n", 14);
+        return;
+    }
+    quicpro_live_config_t *snapshot = NULL;
+    size_t i = 0;
+    rd.p = r->body.p;
+    while (admin_pb_next(&rd, &f, &bad)) {
+        if (f.field == 1 && f.wire == QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM) {
+            admin_op_run(f.data, f.len, &snapshot, &results[i++]);
+        }
+    }
+
+    // All settings of a batch take effect together, or none does
+    char err[120] = "";
+    uint64_t gen = 0;
+    bool settings_ok = true;
+    for (i = 0; i < ops; i++) {
+        if (results[i].setting && !results[i].ok) {
+            settings_ok = false;
+            snprintf(err, sizeof(err), "another setting of the batch was rejected");
+        }
+    }
+    if (snapshot && settings_ok) {
+        gen = quicpro_live_config_commit(snapshot, err, sizeof(err));
+        settings_ok = gen != 0;
+    } else if (snapshot) {
+        quicpro_live_config_abort(snapshot);
+    }
+
+    quicpro_otlp_buf_t out = { 0 };
+    for (i = 0; i < ops; i++) {
+        admin_op_result_t *res = &results[i];
+        if (res->setting && res->ok && !settings_ok) {
+            res->ok = false;
+            memcpy(res->error, err, sizeof(res->error));
+        }
+        size_t mark = quicpro_otlp_open(&out, 1);
+        if (res->ok) {
+            quicpro_otlp_tag(&out, 1, QUICPRO_IIBIN_WIRETYPE_VARINT);
+            quicpro_otlp_varint(&out, 1);
+        } else {
+            quicpro_otlp_bytes(&out, 2, res->error, strlen(res->error));
+        }
+        quicpro_otlp_close(&out, mark);
+    }
+    if (gen) {
+        quicpro_otlp_tag(&out, 2, QUICPRO_IIBIN_WIRETYPE_VARINT);
+        quicpro_otlp_varint(&out, gen);
+    }
+    free(results);
+
+    admin_respond(c, r, "200", "application/vnd.quicpro.proto", out.p, out.len);
+    if (out.p) pefree(out.p, 1);
+}
+
+/*──────────────────────────── GET /events ────────────────────────────────*/
+
+// Queues the events published since the last call, each a length-delimited AdminEvent
+static void admin_api_pump_events(admin_req_t *r)
+{
+    quicpro_admin_event_t ev;
+    while (r->out.len - r->out_off < ADMIN_EVENTS_BACKLOG && quicpro_admin_events_next(&r->cursor, &ev)) {
+        quicpro_otlp_reserve(&r->out, 5);
+        size_t mark = r->out.len;
+        r->out.len += 5;
+        quicpro_otlp_tag(&r->out, 1, QUICPRO_IIBIN_WIRETYPE_VARINT);
+        quicpro_otlp_varint(&r->out, ev.seq);
+        quicpro_otlp_tag(&r->out, 2, QUICPRO_IIBIN_WIRETYPE_VARINT);
+        quicpro_otlp_varint(&r->out, ev.type);
+        if (ev.time_unix_ns) {
+            quicpro_otlp_tag(&r->out, 3, QUICPRO_IIBIN_WIRETYPE_VARINT);
+            quicpro_otlp_varint(&r->out, ev.time_unix_ns);
+        }
+        if (ev.subject_len) {
+            quicpro_otlp_bytes(&r->out, 4, ev.subject, ev.subject_len);
+        }
+        if (ev.code) {
+            quicpro_otlp_tag(&r->out, 5, QUICPRO_IIBIN_WIRETYPE_VARINT);
+            quicpro_otlp_varint(&r->out, (uint64_t)ev.code);
+        }
+        quicpro_otlp_close(&r->out, mark);   // The length prefix, as for a nested message
+    }
+}
+
+/*──────────────────────────── Requests ───────────────────────────────────*/
+
+static void admin_req_free(admin_req_t *r)
+{
+    if (r->events) {
+        quicpro_admin_events_unsubscribe();
+    }
+    if (r->body.p) pefree(r->body.p, 1);
+    if (r->out.p) pefree(r->out.p, 1);
+    free(r);
+}
+
+// quiche_h3_event_for_each_header() callback: the method and the path
+static int admin_on_header(uint8_t *name, size_t name_len, uint8_t *value, size_t value_len, void *argp)
+{
+    admin_req_t *r = argp;
+    char *into = NULL;
+    size_t cap = 0;
+    if (name_len == sizeof(":method") - 1 && memcmp(name, ":method", name_len) == 0) {
+        into = r->method;
+        cap = sizeof(r->method);
+    } else if (name_len == sizeof(":path") - 1 && memcmp(name, ":path", name_len) == 0) {
+        into = r->path;
+        cap = sizeof(r->path);
+    }
+    if (into) {
+        size_t n = value_len < cap - 1 ? value_len : cap - 1;
+        memcpy(into, value, n);
+        into[n] = '\0';
+    }
+    return 0;
+}
+
+// Routes a complete request
+static void admin_answer(admin_conn_t *c, admin_req_t *r)
+{
+    bool get = strcmp(r->method, "GET") == 0, post = strcmp(r->method, "POST") == 0;
+    const char *query = strchr(r->path, '?');
+    size_t path_len = query ? (size_t)(query - r->path) : strlen(r->path);
+#define ADMIN_PATH_IS(lit) (path_len == sizeof(lit) - 1 && memcmp(r->path, lit, path_len) == 0)
+
+    if (r->too_large) {
+        admin_respond(c, r, "413", "text/plain", "body too large\n", 15);
+    } else if (get && ADMIN_PATH_IS("/events")) {
+        r->events = true;
+        r->cursor = quicpro_admin_events_subscribe();
+        admin_send_headers(c, r, "200", "application/vnd.quicpro.proto-delimited", NULL);
+    } else if (post && ADMIN_PATH_IS("/batch")) {
+        admin_api_run_batch(c, r);
+    } else if (get && ADMIN_PATH_IS("/qlog")) {
+        admin_api_send_qlog(c, r, query && strcmp(query, "?format=binary") == 0);
+    } else if (get && ADMIN_PATH_IS("/capture")) {
+        admin_api_send_capture(c, r);
+    } else if (post && ADMIN_PATH_IS("/capture")) {
+        admin_api_arm_capture(c, r);
+    } else if (post && ADMIN_PATH_IS("/capture/stop")) {
+        quicpro_capture_stop();
+        admin_respond(c, r, "200", "text/plain", "stopped\n", 8);
+    } else if (get && ADMIN_PATH_IS("/profile")) {
+        admin_api_send_profile(c, r, query && strcmp(query, "?format=pprof") == 0);
+    } else if (post && (ADMIN_PATH_IS("/profile/start") || ADMIN_PATH_IS("/profile/stop"))) {
+        bool on = ADMIN_PATH_IS("/profile/start");
+        quicpro_prof_set_enabled(on);
+        admin_respond(c, r, "200", "text/plain", on ? "on\n" : "off\n", on ? 3 : 4);
+    } else if (post && ADMIN_PATH_IS("/config")) {
+        admin_api_apply_config(c, r);
+    } else {
+        admin_respond(c, r, "404", "text/plain", "unknown admin operation\n", 24);
+    }
+#undef ADMIN_PATH_IS
+}
+
+// Sends what flow control takes of a response; true once it is all out or the stream is gone
+static bool admin_flush_req(admin_conn_t *c, admin_req_t *r)
+{
+    size_t left = r->out.len - r->out_off;
+    bool fin = r->answered;
+    if (!left && !fin) {
+        return false;
+    }
+    ssize_t sent = quiche_h3_send_body(c->h3, c->conn, r->stream_id, left ? r->out.p + r->out_off : NULL, left, fin);
+    if (sent == QUICHE_H3_ERR_DONE) {
+        return false;
+    }
+    if (sent < 0) {
+        return true;    // Reset or closed: nobody is reading any more
+    }
+    r->out_off += (size_t)sent;
+    if (r->out_off == r->out.len) {
+        r->out.len = r->out_off = 0;    // A subscription reuses the buffer
+    }
+    return fin && (size_t)sent == left;
+}
+
+/*──────────────────────────── Connections ────────────────────────────────*/
+
+static void admin_conn_free(admin_conn_t *c)
+{
+    while (c->reqs) {
+        admin_req_t *next = c->reqs->next;
+        admin_req_free(c->reqs);
+        c->reqs = next;
+    }
+    if (c->h3) quiche_h3_conn_free(c->h3);
+    if (c->conn) quiche_conn_free(c->conn);
+    memset(c, 0, sizeof(*c));
+}
+
+// quiche verified any certificate the client sent; this insists that one was sent
+static bool admin_conn_authenticate(admin_thread_args_t *args, admin_conn_t *c)
+{
+    const uint8_t *cert = NULL;
+    size_t cert_len = 0;
+    quiche_conn_peer_cert(c->conn, &cert, &cert_len);
+    if (!cert_len) {
+        static const char reason[] = "client certificate required";
+        quiche_conn_close(c->conn, false, ADMIN_ERR_CERTIFICATE_REQUIRED, (const uint8_t *)reason, sizeof(reason) - 1);
+        return false;
+    }
+    c->h3 = quiche_h3_conn_new_with_transport(c->conn, args->h3_config);
+    if (!c->h3) {
+        quiche_conn_close(c->conn, false, 0x1, NULL, 0);   // INTERNAL_ERROR
+        return false;
+    }
+    c->quiet_since_ms = admin_now_ms();
+    return true;
+}
+
+// One round for a connection: its requests, subscriptions and output streams
+static void admin_conn_serve(admin_thread_args_t *args, admin_conn_t *c)
+{
+    if (!c->h3 && (!quiche_conn_is_established(c->conn) || !admin_conn_authenticate(args, c))) {
+        return;
+    }
+
+    quiche_h3_event *ev;
+    int64_t stream_id;
+    while ((stream_id = quiche_h3_conn_poll(c->h3, c->conn, &ev)) >= 0) {
+        admin_req_t **pp = &c->reqs;
+        while (*pp && (*pp)->stream_id != (uint64_t)stream_id) {
+            pp = &(*pp)->next;
+        }
+        admin_req_t *r = *pp;
+
+        switch (quiche_h3_event_type(ev)) {
+            case QUICHE_H3_EVENT_HEADERS:
+                if (!r && (r = calloc(1, sizeof(*r)))) {
+                    r->stream_id = (uint64_t)stream_id;
+                    r->next = c->reqs;
+                    c->reqs = r;
+                    quiche_h3_event_for_each_header(ev, admin_on_header, r);
+                }
+                break;
+
+            case QUICHE_H3_EVENT_DATA: {
+                uint8_t buf[16384];
+                ssize_t n;
+                while ((n = quiche_h3_recv_body(c->h3, c->conn, (uint64_t)stream_id, buf, sizeof(buf))) > 0) {
+                    if (!r || r->too_large) {
+                        continue;
+                    }
+                    if (r->body.len + (size_t)n > ADMIN_MAX_BODY) {
+                        r->too_large = true;
+                        continue;
+                    }
+                    admin_buf_append(&r->body, buf, (size_t)n);
+                }
+                break;
+            }
+
+            case QUICHE_H3_EVENT_FINISHED:
+                if (r && !r->answered && !r->events) {
+                    admin_answer(c, r);
+                }
+                break;
+
+            case QUICHE_H3_EVENT_RESET:
+                if (r) {
+                    *pp = r->next;
+                    admin_req_free(r);
+                }
+                break;
+
+            default:
+                break;
+        }
+        quiche_h3_event_free(ev);
+    }
+
+    bool subscribed = false;
+    for (admin_req_t **pp = &c->reqs; *pp; ) {
+        admin_req_t *r = *pp;
+        if (r->events) {
+            admin_api_pump_events(r);
+            subscribed = true;
+        }
+        if ((r->answered || r->events) && admin_flush_req(c, r)) {
+            *pp = r->next;
+            admin_req_free(r);
+        } else {
+            pp = &r->next;
+        }
+    }
+
+    // A subscriber may wait long for the next event; keep its connection from idling out
+    uint64_t now = admin_now_ms();
+    if (!subscribed) {
+        c->quiet_since_ms = now;
+    } else if (now - c->quiet_since_ms >= ADMIN_KEEPALIVE_MS) {
+        quiche_conn_send_ack_eliciting(c->conn);
+        c->quiet_since_ms = now;
+    }
+}
+
+static void admin_conn_send(admin_thread_args_t *args, admin_conn_t *c)
+{
+    uint8_t out[ADMIN_MAX_DATAGRAM];
+    quiche_send_info si;
+    for (;;) {
+        ssize_t n = quiche_conn_send(c->conn, out, sizeof(out), &si);
+        if (n < 0) {
+            break;   // QUICHE_ERR_DONE or a fatal error
+        }
+        sendto(args->fd, out, (size_t)n, 0, (struct sockaddr *)&si.to, si.to_len);
+    }
+}
+
+// Routes one inbound datagram to its connection, accepting a new one for an unknown DCID
+static void admin_on_datagram(admin_thread_args_t *args, uint8_t *buf, size_t len,
+                              struct sockaddr_storage *peer, socklen_t peer_len)
+{
+    uint8_t scid[QUICHE_MAX_CONN_ID_LEN], dcid[QUICHE_MAX_CONN_ID_LEN], token[QUICPRO_RETRY_TOKEN_MAX];
+    size_t scid_len = sizeof(scid), dcid_len = sizeof(dcid), token_len = sizeof(token);
+    uint32_t version = 0;
+    uint8_t type = 0;
+    if (quiche_header_info(buf, len, QUICHE_MAX_CONN_ID_LEN, &version, &type,
+                           scid, &scid_len, dcid, &dcid_len, token, &token_len) < 0) {
+        return;
+    }
 
-    struct sockaddr_in6 addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin6_family = AF_INET6;
-    addr.sin6_port = htons(args->port);
-    inet_pton(AF_INET6, args->host, &addr.sin6_addr);
+    admin_conn_t *c = NULL, *free_slot = NULL;
+    for (size_t i = 0; i < ADMIN_MAX_CONNS && !c; i++) {
+        admin_conn_t *slot = &args->conns[i];
+        if (!slot->conn) {
+            free_slot = free_slot ? free_slot : slot;
+        } else if (dcid_len == QUICHE_MAX_CONN_ID_LEN && memcmp(slot->scid, dcid, dcid_len) == 0) {
+            c = slot;
+        }
+    }
+
+    if (!c) {
+        uint8_t odcid[QUICHE_MAX_CONN_ID_LEN];
+        size_t odcid_len = 0;
+        if (quicpro_retry_screen(&args->retry, args->fd, buf, len, version, type,
+                                 scid, scid_len, dcid, dcid_len, token, token_len,
+                                 (struct sockaddr *)peer, peer_len, odcid, &odcid_len) != QUICPRO_RETRY_ACCEPT) {
+            return;
+        }
+        if (!free_slot) {
+            return;     // Every slot is taken: the client retries
+        }
+        // The validated client addresses the Retry's SCID, and quiche checks we keep it
+        if (odcid_len > 0 && dcid_len == sizeof(free_slot->scid)) {
+            memcpy(free_slot->scid, dcid, dcid_len);
+        } else if (getrandom(free_slot->scid, sizeof(free_slot->scid), 0) != (ssize_t)sizeof(free_slot->scid)) {
+            return;
+        }
+        free_slot->conn = quiche_accept(free_slot->scid, sizeof(free_slot->scid), odcid_len ? odcid : NULL, odcid_len,
+                                        (struct sockaddr *)&args->local_addr, args->local_addr_len,
+                                        (struct sockaddr *)peer, peer_len, args->quic_config);
+        if (!free_slot->conn) {
+            return;
+        }
+        memcpy(&free_slot->peer, peer, peer_len);
+        free_slot->peer_len = peer_len;
+        c = free_slot;
+    }
 
-    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    quiche_recv_info ri = {
+        .from = (struct sockaddr *)peer,
+        .from_len = peer_len,
+        .to = (struct sockaddr *)&args->local_addr,
+        .to_len = args->local_addr_len
+    };
+    quiche_conn_recv(c->conn, buf, len, &ri);
+}
+
+// Binds the admin UDP socket; -1 on failure
+static int admin_api_bind(admin_thread_args_t *args)
+{
+    struct sockaddr_in6 addr6;
+    struct sockaddr_in addr4;
+    memset(&addr6, 0, sizeof(addr6));
+    memset(&addr4, 0, sizeof(addr4));
+    bool v4 = inet_pton(AF_INET, args->host, &addr4.sin_addr) == 1;
+    if (!v4 && inet_pton(AF_INET6, args->host, &addr6.sin6_addr) != 1) {
+        fprintf(stderr, "[Quicpro Admin API] Not an IP address: %s\n", args->host);
+        return -1;
+    }
+
+    int fd = socket(v4 ? AF_INET : AF_INET6, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "[Quicpro Admin API] Failed to create socket: %s\n", strerror(errno));
+        return -1;
+    }
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    int rc;
+    if (v4) {
+        addr4.sin_family = AF_INET;
+        addr4.sin_port = htons(args->port);
+        rc = bind(fd, (struct sockaddr *)&addr4, sizeof(addr4));
+    } else {
+        addr6.sin6_family = AF_INET6;
+        addr6.sin6_port = htons(args->port);
+        rc = bind(fd, (struct sockaddr *)&addr6, sizeof(addr6));
+    }
+    if (rc < 0) {
         fprintf(stderr, "[Quicpro Admin API] Failed to bind to %s:%d: %s\n", args->host, args->port, strerror(errno));
-        goto cleanup;
+        close(fd);
+        return -1;
     }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
 
-    if (listen(listen_fd, 5) < 0) {
-        fprintf(stderr, "[Quicpro Admin API] Failed to listen: %s\n", strerror(errno));
+    args->local_addr_len = sizeof(args->local_addr);
+    if (getsockname(fd, (struct sockaddr *)&args->local_addr, &args->local_addr_len) < 0) {
+        args->local_addr_len = 0;
+    }
+    return fd;
+}
+
+// The main function for the admin listener thread
+static void *admin_api_thread_func(void *arg)
+{
+    admin_thread_args_t *args = (admin_thread_args_t *)arg;
+
+    args->fd = admin_api_bind(args);
+    if (args->fd < 0) {
         goto cleanup;
     }
 
     while (args->target_server->is_listening) {
-        int client_fd = accept(listen_fd, NULL, NULL);
-        if (client_fd < 0) {
-            continue;
+        int timeout = 100;
+        for (size_t i = 0; i < ADMIN_MAX_CONNS; i++) {
+            if (args->conns[i].conn) {
+                uint64_t t = quiche_conn_timeout_as_millis(args->conns[i].conn);
+                timeout = t < (uint64_t)timeout ? (int)t : timeout;
+            }
         }
 
-        SSL *ssl = SSL_new(args->admin_ssl_ctx);
-        SSL_set_fd(ssl, client_fd);
-
-        if (SSL_accept(ssl) <= 0) {
-            ERR_print_errors_fp(stderr);
-        } else {
-            // mTLS handshake successful, peer certificate is verified.
-            // Read the JSON payload from the SSL connection.
-            char buffer[4096];
-            int bytes = SSL_read(ssl, buffer, sizeof(buffer) - 1);
-            if (bytes > 0) {
-                buffer[bytes] = '\0';
-                // At this point, `buffer` contains the JSON config.
-                // A thread-safe mechanism (e.g., a message queue or a mutex-protected
-                // shared structure) would be needed to apply this config to the
-                // `args->target_server`.
-                fprintf(stdout, "[Quicpro Admin API] Received config update: %s\n", buffer);
-
-                const char *response = "HTTP/1.1 202 Accepted\r\nContent-Length: 9\r\n\r\nAccepted\n";
-                SSL_write(ssl, response, strlen(response));
+        struct pollfd pfd = { .fd = args->fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, timeout);
+        if (ready < 0 && errno != EINTR) {
+            fprintf(stderr, "[Quicpro Admin API] poll failed: %s\n", strerror(errno));
+            break;
+        }
+        while (ready > 0) {
+            uint8_t buf[65535];
+            struct sockaddr_storage peer;
+            socklen_t peer_len = sizeof(peer);
+            ssize_t n = recvfrom(args->fd, buf, sizeof(buf), 0, (struct sockaddr *)&peer, &peer_len);
+            if (n < 0) {
+                break;   // EAGAIN: drained
             }
+            admin_on_datagram(args, buf, (size_t)n, &peer, peer_len);
         }
 
-        SSL_shutdown(ssl);
-        SSL_free(ssl);
-        close(client_fd);
+        for (size_t i = 0; i < ADMIN_MAX_CONNS; i++) {
+            admin_conn_t *c = &args->conns[i];
+            if (!c->conn) {
+                continue;
+            }
+            quiche_conn_on_timeout(c->conn);
+            admin_conn_serve(args, c);
+            admin_conn_send(args, c);
+            if (quiche_conn_is_closed(c->conn)) {
+                admin_conn_free(c);
+            }
+        }
     }
 
 cleanup:
-    if (listen_fd >= 0) close(listen_fd);
-    if (args->admin_ssl_ctx) SSL_CTX_free(args->admin_ssl_ctx);
+    for (size_t i = 0; i < ADMIN_MAX_CONNS; i++) {
+        admin_conn_free(&args->conns[i]);
+    }
+    if (args->fd >= 0) close(args->fd);
+    if (args->h3_config) quiche_h3_config_free(args->h3_config);
+    if (args->quic_config) quiche_config_free(args->quic_config);
     free(args->host);
     free(args);
     return NULL;
@@ -125,47 +987,55 @@ PHP_FUNCTION(quicpro_admin_api_listen)
     target_server = (quicpro_server_t *)zend_fetch_resource(Z_RES_P(target_server_resource), "quicpro_server", le_quicpro_server);
 
     // Extract mTLS settings from the PHP config object
-    zval *options = zend_read_property(quicpro_config_ce, Z_OBJ_P(config_resource), "options", sizeof("options")-1, 1, NULL);
-    zval *val;
-    char *cert_file = NULL, *key_file = NULL, *ca_file = NULL, *host = "127.0.0.1";
-    long port = 2019;
-
-    if (Z_TYPE_P(options) == IS_ARRAY) {
-        if ((val = zend_hash_str_find(Z_ARRVAL_P(options), "cert_file", sizeof("cert_file")-1)) && Z_TYPE_P(val) == IS_STRING) cert_file = Z_STRVAL_P(val);
-        if ((val = zend_hash_str_find(Z_ARRVAL_P(options), "key_file", sizeof("key_file")-1)) && Z_TYPE_P(val) == IS_STRING) key_file = Z_STRVAL_P(val);
-        if ((val = zend_hash_str_find(Z_ARRVAL_P(options), "ca_file", sizeof("ca_file")-1)) && Z_TYPE_P(val) == IS_STRING) ca_file = Z_STRVAL_P(val);
-        if ((val = zend_hash_str_find(Z_ARRVAL_P(options), "host", sizeof("host")-1)) && Z_TYPE_P(val) == IS_STRING) host = Z_STRVAL_P(val);
-        if ((val = zend_hash_str_find(Z_ARRVAL_P(options), "port", sizeof("port")-1)) && Z_TYPE_P(val) == IS_LONG) port = Z_LVAL_P(val);
+    const quicpro_runtime_config_t *runtime = quicpro_runtime_config_of(config_resource);
+    if (!runtime) {
+        RETURN_FALSE;
     }
+    const char *cert_file = runtime->cert_file, *key_file = runtime->key_file, *ca_file = runtime->ca_file;
+    const char *host = runtime->host ? runtime->host : "127.0.0.1";
+    long port = (runtime->set & QUICPRO_RT_PORT) ? (long)runtime->port : 2019;
 
     if (!cert_file || !key_file || !ca_file) {
         zend_throw_exception(NULL, "Admin API config requires 'cert_file', 'key_file', and 'ca_file' for mTLS.", 0);
         RETURN_FALSE;
     }
 
-    SSL_CTX *ssl_ctx = SSL_CTX_new(TLS_server_method());
-    if (!ssl_ctx) {
-        zend_throw_exception(NULL, "Failed to create SSL context for Admin API.", 0);
+    quiche_config *quic_config = quiche_config_new(QUICHE_PROTOCOL_VERSION);
+    if (!quic_config) {
+        zend_throw_exception(NULL, "Failed to create QUIC config for Admin API.", 0);
         RETURN_FALSE;
     }
 
-    if (SSL_CTX_use_certificate_file(ssl_ctx, cert_file, SSL_FILETYPE_PEM) <= 0 ||
-        SSL_CTX_use_private_key_file(ssl_ctx, key_file, SSL_FILETYPE_PEM) <= 0) {
-        SSL_CTX_free(ssl_ctx);
+    if (quiche_config_load_cert_chain_from_pem_file(quic_config, cert_file) < 0 ||
+        quiche_config_load_priv_key_from_pem_file(quic_config, key_file) < 0) {
+        quiche_config_free(quic_config);
         zend_throw_exception(NULL, "Failed to load server certificate/key for Admin API.", 0);
         RETURN_FALSE;
     }
 
-    SSL_CTX_set_verify(ssl_ctx, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
-    if (SSL_CTX_load_verify_locations(ssl_ctx, ca_file, NULL) <= 0) {
-        SSL_CTX_free(ssl_ctx);
+    quiche_config_verify_peer(quic_config, true);
+    if (quiche_config_load_verify_locations_from_file(quic_config, ca_file) < 0) {
+        quiche_config_free(quic_config);
         zend_throw_exception(NULL, "Failed to load CA file for Admin API client verification.", 0);
         RETURN_FALSE;
     }
 
-    admin_thread_args_t *args = malloc(sizeof(admin_thread_args_t));
-    if (!args) {
-        SSL_CTX_free(ssl_ctx);
+    // Batches of up to ADMIN_MAX_BODY bytes, a few requests in parallel, subscriptions kept alive by PING
+    quiche_config_set_application_protos(quic_config, (uint8_t *)QUICHE_H3_APPLICATION_PROTOCOL, sizeof(QUICHE_H3_APPLICATION_PROTOCOL) - 1);
+    quiche_config_set_max_idle_timeout(quic_config, 4 * ADMIN_KEEPALIVE_MS);
+    quiche_config_set_initial_max_data(quic_config, 4 * ADMIN_MAX_BODY);
+    quiche_config_set_initial_max_stream_data_bidi_local(quic_config, ADMIN_MAX_BODY);
+    quiche_config_set_initial_max_stream_data_bidi_remote(quic_config, ADMIN_MAX_BODY);
+    quiche_config_set_initial_max_stream_data_uni(quic_config, 64 * 1024);
+    quiche_config_set_initial_max_streams_bidi(quic_config, 16);
+    quiche_config_set_initial_max_streams_uni(quic_config, 8);
+    quiche_config_set_disable_active_migration(quic_config, true);
+
+    admin_thread_args_t *args = calloc(1, sizeof(admin_thread_args_t));
+    quiche_h3_config *h3_config = args ? quiche_h3_config_new() : NULL;
+    if (!h3_config) {
+        free(args);
+        quiche_config_free(quic_config);
         zend_throw_exception_ex(NULL, 0, "Failed to allocate memory for admin thread arguments");
         RETURN_FALSE;
     }
@@ -173,12 +1043,27 @@ PHP_FUNCTION(quicpro_admin_api_listen)
     args->target_server = target_server;
     args->host = strdup(host);
     args->port = port;
-    args->admin_ssl_ctx = ssl_ctx;
+    args->quic_config = quic_config;
+    quicpro_h3_settings_apply(h3_config);
+    args->h3_config = h3_config;
+    args->fd = -1;
+    args->retry.always = true;
+
+    // The listener thread mints and checks tokens; draw their key here, on the PHP thread
+    if (!quicpro_retry_key_prepare()) {
+        quiche_h3_config_free(h3_config);
+        quiche_config_free(quic_config);
+        free(args->host);
+        free(args);
+        zend_throw_exception_ex(NULL, 0, "Failed to draw the Admin API address-validation key");
+        RETURN_FALSE;
+    }
 
     pthread_t admin_thread;
     if (pthread_create(&admin_thread, NULL, admin_api_thread_func, args) != 0) {
         zend_throw_exception_ex(NULL, 0, "Failed to create Admin API listener thread: %s", strerror(errno));
-        SSL_CTX_free(ssl_ctx);
+        quiche_h3_config_free(h3_config);
+        quiche_config_free(quic_config);
         free(args->host);
         free(args);
         RETURN_FALSE;
@@ -0,0 +1,148 @@
+/*
+ * src/server/admin_events.c – Live events for admin API subscribers
+ * =================================================================
+ *
+ * See include/server/admin_events.h. A publisher claims sequence n with
+ * one fetch-add, marks slot n % QUICPRO_ADMIN_EVENTS_RING busy (sequence
+ * 0), writes the event and then stores n. A reader copies the slot and
+ * keeps the copy only if the sequence was n before and after.
+ */
+
+#include "server/admin_events.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    _Atomic uint64_t      seq;          /* 0: being written */
+    quicpro_admin_event_t ev;
+} quicpro_admin_event_slot_t;
+
+_Atomic int quicpro_admin_event_subscribers = 0;
+
+static _Atomic uint64_t quicpro_admin_event_head = 0;   /* Last sequence claimed */
+static quicpro_admin_event_slot_t quicpro_admin_event_ring[QUICPRO_ADMIN_EVENTS_RING];
+
+void quicpro_admin_event_publish(quicpro_admin_event_type_t type, const char *subject, size_t subject_len, int64_t code)
+{
+    if (!quicpro_admin_events_wanted()) {
+        return;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    uint64_t n = atomic_fetch_add_explicit(&quicpro_admin_event_head, 1, memory_order_relaxed) + 1;
+    quicpro_admin_event_slot_t *slot = &quicpro_admin_event_ring[n & (QUICPRO_ADMIN_EVENTS_RING - 1)];
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->ev.seq = n;
+    slot->ev.type = (uint32_t)type;
+    slot->ev.code = code;
+    slot->ev.time_unix_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    if (subject_len > QUICPRO_ADMIN_EVENT_SUBJECT_MAX) {
+        subject_len = QUICPRO_ADMIN_EVENT_SUBJECT_MAX;
+    }
+    memcpy(slot->ev.subject, subject, subject_len);
+    slot->ev.subject_len = (uint8_t)subject_len;
+
+    atomic_store_explicit(&slot->seq, n, memory_order_release);
+}
+
+/* "ip:port" or "[ip6]:port" into `out`; its length */
+static size_t quicpro_admin_event_peer(const struct sockaddr_storage *ss, char *out, size_t cap)
+{
+    char host[INET6_ADDRSTRLEN];
+    int n = 0;
+    if (ss->ss_family == AF_INET) {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)ss;
+        inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+        n = snprintf(out, cap, "%s:%u", host, ntohs(in->sin_port));
+    } else if (ss->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)ss;
+        inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+        n = snprintf(out, cap, "[%s]:%u", host, ntohs(in6->sin6_port));
+    }
+    return n > 0 ? ((size_t)n < cap ? (size_t)n : cap - 1) : 0;
+}
+
+void quicpro_admin_event_conn_open(const struct sockaddr_storage *peer)
+{
+    if (quicpro_admin_events_wanted()) {
+        char subject[INET6_ADDRSTRLEN + 8];
+        quicpro_admin_event_publish(QUICPRO_ADMIN_EVENT_CONN_OPEN, subject, quicpro_admin_event_peer(peer, subject, sizeof(subject)), 0);
+    }
+}
+
+void quicpro_admin_event_conn_closed(quiche_conn *conn, const struct sockaddr_storage *peer)
+{
+    if (!quicpro_admin_events_wanted()) {
+        return;
+    }
+    bool app = false;
+    uint64_t code = 0;
+    const uint8_t *reason;
+    size_t reason_len;
+    if (!quiche_conn_peer_error(conn, &app, &code, &reason, &reason_len)
+        && !quiche_conn_local_error(conn, &app, &code, &reason, &reason_len)) {
+        return;     /* Idle timeout or a clean close */
+    }
+    if (code == 0) {
+        return;     /* NO_ERROR, or an application's own clean close */
+    }
+    char subject[INET6_ADDRSTRLEN + 8];
+    quicpro_admin_event_publish(QUICPRO_ADMIN_EVENT_CONN_ERROR, subject, quicpro_admin_event_peer(peer, subject, sizeof(subject)), (int64_t)code);
+}
+
+uint64_t quicpro_admin_events_subscribe(void)
+{
+    atomic_fetch_add_explicit(&quicpro_admin_event_subscribers, 1, memory_order_relaxed);
+    return atomic_load_explicit(&quicpro_admin_event_head, memory_order_acquire);
+}
+
+void quicpro_admin_events_unsubscribe(void)
+{
+    atomic_fetch_sub_explicit(&quicpro_admin_event_subscribers, 1, memory_order_relaxed);
+}
+
+bool quicpro_admin_events_next(uint64_t *cursor, quicpro_admin_event_t *out)
+{
+    uint64_t head = atomic_load_explicit(&quicpro_admin_event_head, memory_order_acquire);
+    if (*cursor >= head) {
+        return false;
+    }
+    if (head - *cursor > QUICPRO_ADMIN_EVENTS_RING) {
+        uint64_t skipped = head - QUICPRO_ADMIN_EVENTS_RING - *cursor;
+        *cursor += skipped;
+        memset(out, 0, sizeof(*out));
+        out->seq = *cursor;
+        out->type = QUICPRO_ADMIN_EVENT_LOST;
+        out->code = (int64_t)skipped;
+        return true;
+    }
+
+    uint64_t want = *cursor + 1;
+    quicpro_admin_event_slot_t *slot = &quicpro_admin_event_ring[want & (QUICPRO_ADMIN_EVENTS_RING - 1)];
+    uint64_t before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (before < want) {
+        return false;   /* Claimed, still being written */
+    }
+    if (before == want) {
+        memcpy(out, &slot->ev, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == want) {
+            *cursor = want;
+            return true;
+        }
+    }
+    /* Overwritten by a later lap while we looked: that one event is lost */
+    *cursor = want;
+    memset(out, 0, sizeof(*out));
+    out->seq = want;
+    out->type = QUICPRO_ADMIN_EVENT_LOST;
+    out->code = 1;
+    return true;
+}
@@ -0,0 +1,201 @@
+/*
+ * src/server/body_spool.c – Request bodies too large to buffer
+ * ============================================================
+ *
+ * See include/server/body_spool.h. A spool is only ever appended to by
+ * its listener and read from offset 0 by whoever holds a duplicate of
+ * its descriptor, so reads use pread() or offsets of their own and never
+ * move the writer's position.
+ */
+
+#include <php.h>
+#include <main/php_open_temporary_file.h>
+
+#include "server/body_spool.h"
+#include "config/tcp_transport/base_layer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SPOOL_COPY_CHUNK (1 << 20)   /* Per copy_file_range()/splice() call */
+
+void quicpro_body_spool_init(quicpro_body_spool_t *spool)
+{
+    spool->fd = -1;
+    spool->len = 0;
+}
+
+bool quicpro_body_spool_wanted(uint64_t len)
+{
+    zend_long threshold = quicpro_tcp_transport_config.tcp_body_spool_threshold_bytes;
+    return threshold > 0 && len > (uint64_t)threshold;
+}
+
+uint64_t quicpro_body_spool_max(void)
+{
+    return (uint64_t)quicpro_tcp_transport_config.tcp_body_spool_max_bytes;
+}
+
+/* An unnamed file in `dir` */
+static int spool_open_in(const char *dir)
+{
+#ifdef O_TMPFILE
+    int fd = open(dir, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd >= 0 || (errno != EOPNOTSUPP && errno != EISDIR && errno != EINVAL)) {
+        return fd;
+    }
+#endif
+    char path[MAXPATHLEN];
+    if ((size_t)snprintf(path, sizeof(path), "%s/quicpro-body-XXXXXX", dir) >= sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int named = mkostemp(path, O_CLOEXEC);
+    if (named >= 0) {
+        unlink(path);
+    }
+    return named;
+}
+
+bool quicpro_body_spool_open(quicpro_body_spool_t *spool)
+{
+    const char *dir = quicpro_tcp_transport_config.tcp_body_spool_dir;
+    int fd;
+
+    if (dir && *dir) {
+        fd = spool_open_in(dir);
+    } else {
+        fd = memfd_create("quicpro-body", MFD_CLOEXEC);
+        if (fd < 0 && errno == ENOSYS) {
+            dir = php_get_temporary_directory();
+            fd = spool_open_in(dir);
+        }
+    }
+    if (fd < 0) {
+        php_error_docref(NULL, E_WARNING, "Cannot spool a request body%s%s: %s",
+                         dir && *dir ? " under " : "", dir && *dir ? dir : "", strerror(errno));
+        return false;
+    }
+    spool->fd = fd;
+    spool->len = 0;
+    return true;
+}
+
+bool quicpro_body_spool_write(quicpro_body_spool_t *spool, const void *data, size_t len)
+{
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(spool->fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+        spool->len += (uint64_t)n;
+    }
+    return true;
+}
+
+void quicpro_body_spool_close(quicpro_body_spool_t *spool)
+{
+    if (spool->fd >= 0) {
+        close(spool->fd);
+    }
+    quicpro_body_spool_init(spool);
+}
+
+/* The rest through a pipe: file pages move by reference, not by copy */
+static int64_t spool_splice(int in_fd, loff_t in_off, uint64_t len, int out_fd)
+{
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) < 0) {
+        return -1;
+    }
+    uint64_t done = 0;
+    while (done < len) {
+        size_t want = (size_t)MIN(len - done, (uint64_t)SPOOL_COPY_CHUNK);
+        ssize_t in = splice(in_fd, &in_off, pipefd[1], NULL, want, SPLICE_F_MOVE);
+        if (in <= 0) {
+            if (in < 0 && errno == EINTR) continue;
+            break;
+        }
+        for (ssize_t left = in; left > 0; ) {
+            ssize_t out = splice(pipefd[0], NULL, out_fd, NULL, (size_t)left, SPLICE_F_MOVE);
+            if (out <= 0) {
+                if (out < 0 && errno == EINTR) continue;
+                int saved = errno;
+                close(pipefd[0]);
+                close(pipefd[1]);
+                errno = out == 0 ? EIO : saved;
+                return -1;
+            }
+            left -= out;
+        }
+        done += (uint64_t)in;
+    }
+    int saved = errno;
+    close(pipefd[0]);
+    close(pipefd[1]);
+    if (done < len) {
+        errno = saved;
+        return done > 0 ? -1 : -2;      /* -2: splice() cannot serve these descriptors */
+    }
+    return (int64_t)done;
+}
+
+static int64_t spool_read_write(int in_fd, off_t in_off, uint64_t len, int out_fd)
+{
+    char buf[65536];
+    uint64_t done = 0;
+    while (done < len) {
+        ssize_t in = pread(in_fd, buf, (size_t)MIN(len - done, sizeof(buf)), in_off + (off_t)done);
+        if (in < 0 && errno == EINTR) continue;
+        if (in <= 0) {
+            if (in == 0) errno = EIO;       /* The spool is shorter than it said */
+            return -1;
+        }
+        for (ssize_t at = 0; at < in; ) {
+            ssize_t out = write(out_fd, buf + at, (size_t)(in - at));
+            if (out < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            at += out;
+        }
+        done += (uint64_t)in;
+    }
+    return (int64_t)done;
+}
+
+int64_t quicpro_body_spool_copy(int in_fd, uint64_t len, int out_fd)
+{
+    loff_t in_off = 0;
+    uint64_t done = 0;
+
+    /* Same filesystem: shared extents or an in-kernel copy */
+    while (done < len) {
+        ssize_t n = copy_file_range(in_fd, &in_off, out_fd, NULL, (size_t)MIN(len - done, (uint64_t)SPOOL_COPY_CHUNK), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n < 0 && errno != EXDEV && errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP && errno != EBADF) {
+                return -1;
+            }
+            break;
+        }
+        done += (uint64_t)n;
+    }
+    if (done == len) {
+        return (int64_t)done;
+    }
+
+    int64_t rest = spool_splice(in_fd, (loff_t)done, len - done, out_fd);
+    if (rest == -2) {
+        rest = spool_read_write(in_fd, (off_t)done, len - done, out_fd);
+    }
+    return rest < 0 ? -1 : (int64_t)(done + (uint64_t)rest);
+}
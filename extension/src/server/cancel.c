@@ -1,104 +1,123 @@
 /**
  * @file extension/src/server/cancel.c
- * @brief Implementation for handling request cancellation.
+ * @brief Cancellation tokens for the requests a handler serves.
  *
- * This file contains the C-level logic to manage cancellation handlers. It
- * provides the mechanism to associate a PHP callback with an active stream
- * and invoke it when the client signals it no longer needs the response
- * (e.g., by sending a QUIC RST_STREAM frame).
+ * See include/server/cancel.h. Tokens live in their handler's C frame
+ * and are chained through `outer`; only the innermost one is checked, as
+ * a handler nested in another serves its own request.
  */
 
 #include <php.h>
 #include <zend_exceptions.h>
 
 #include "server/cancel.h"
-#include "session/session.h" // For quicpro_session_t and quicpro_stream_t
+#include "quiche.h"
 
-// Resource IDs defined in the main extension file.
-extern int le_quicpro_session;
+static ZEND_TLS quicpro_cancel_token_t *cancel_current;
+static ZEND_TLS int cancel_pump_fd = -1;
+static ZEND_TLS void (*cancel_pump)(void *ctx);
+static ZEND_TLS void *cancel_pump_ctx;
 
-/**
- * The actual invocation of the cancellation handler.
- * This internal function is called by the event loop when a stream reset is detected.
- */
-void quicpro_internal_invoke_cancel_handler(quicpro_stream_t *stream)
+void quicpro_cancel_enter(quicpro_cancel_token_t *t, quicpro_session_t *s, uint64_t stream_id)
 {
-    if (!stream || !stream->has_cancel_handler) {
-        return;
-    }
+    t->session = s;
+    t->stream_id = stream_id;
+    t->cancelled = false;
+    ZVAL_UNDEF(&t->callbacks);
+    t->outer = cancel_current;
+    cancel_current = t;
+}
+
+void quicpro_cancel_leave(quicpro_cancel_token_t *t)
+{
+    cancel_current = t->outer;
+    zval_ptr_dtor(&t->callbacks);
+    ZVAL_UNDEF(&t->callbacks);
+}
 
-    zval retval;
-    zval params[1];
-    ZVAL_LONG(&params[0], stream->stream_id);
+void quicpro_cancel_set_pump(int fd, void (*pump)(void *ctx), void *ctx)
+{
+    cancel_pump_fd = pump ? fd : -1;
+    cancel_pump = pump;
+    cancel_pump_ctx = ctx;
+}
 
-    stream->cancel_fci.param_count = 1;
-    stream->cancel_fci.params = params;
-    stream->cancel_fci.retval = &retval;
+int quicpro_cancel_watch_fd(void)
+{
+    return cancel_current ? cancel_pump_fd : -1;
+}
 
-    // Call the stored PHP function.
-    if (zend_call_function(&stream->cancel_fci, &stream->cancel_fcc) == SUCCESS) {
-        zval_ptr_dtor(&retval);
+/* Runs the callbacks registered so far, in order. Exceptions they throw stay pending. */
+static void cancel_run_callbacks(quicpro_cancel_token_t *t)
+{
+    if (Z_TYPE(t->callbacks) != IS_ARRAY) {
+        return;
     }
+    zval *cb;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL(t->callbacks), cb) {
+        zval retval;
+        if (call_user_function(NULL, NULL, cb, &retval, 0, NULL) == SUCCESS) {
+            zval_ptr_dtor(&retval);
+        }
+        if (EG(exception)) {
+            break;
+        }
+    } ZEND_HASH_FOREACH_END();
+}
 
-    // Clean up the stored callable to prevent double-invocation and memory leaks.
-    if (Z_TYPE(stream->cancel_fci.function_name) != IS_UNDEF) {
-        zval_ptr_dtor(&stream->cancel_fci.function_name);
-        ZVAL_UNDEF(&stream->cancel_fci.function_name);
+bool quicpro_cancel_requested(void)
+{
+    quicpro_cancel_token_t *t = cancel_current;
+    if (!t) {
+        return false;
+    }
+    if (t->cancelled) {
+        return true;
+    }
+    if (cancel_pump) {
+        cancel_pump(cancel_pump_ctx);
     }
-    if (stream->cancel_fci.object) {
-        OBJ_RELEASE(Z_OBJ(stream->cancel_fci.object));
-        stream->cancel_fci.object = NULL;
+    quiche_conn *conn = t->session ? t->session->conn : NULL;
+    t->cancelled = !conn || quiche_conn_is_closed(conn)
+        || quiche_conn_stream_writable(conn, t->stream_id, 0) == QUICHE_ERR_STREAM_STOPPED;
+    if (t->cancelled) {
+        cancel_run_callbacks(t);
     }
-    stream->has_cancel_handler = false;
+    return t->cancelled;
 }
 
-
 PHP_FUNCTION(quicpro_server_on_cancel)
 {
-    zval *session_resource;
-    zend_long stream_id;
     zend_fcall_info fci = empty_fcall_info;
     zend_fcall_info_cache fcc = empty_fcall_info_cache;
 
-    ZEND_PARSE_PARAMETERS_START(3, 3)
-        Z_PARAM_RESOURCE(session_resource)
-        Z_PARAM_LONG(stream_id)
+    ZEND_PARSE_PARAMETERS_START(1, 1)
         Z_PARAM_FUNC(fci, fcc)
     ZEND_PARSE_PARAMETERS_END();
 
-    quicpro_session_t *session = (quicpro_session_t *)zend_fetch_resource(Z_RES_P(session_resource), "quicpro_session", le_quicpro_session);
-    if (!session) {
-        zend_throw_exception(NULL, "Invalid session resource provided.", 0);
+    quicpro_cancel_token_t *t = cancel_current;
+    if (!t) {
         RETURN_FALSE;
     }
-
-    // Find the specific stream object within the session's stream hash table.
-    quicpro_stream_t *stream = zend_hash_index_find_ptr(session->streams, (zend_ulong)stream_id);
-    if (!stream) {
-        zend_throw_exception_ex(NULL, 0, "Stream with ID %ld not found in the current session.", stream_id);
-        RETURN_FALSE;
+    if (Z_TYPE(t->callbacks) != IS_ARRAY) {
+        array_init(&t->callbacks);
     }
-
-    // If a handler was previously set, clean it up first.
-    if (stream->has_cancel_handler) {
-        if (Z_TYPE(stream->cancel_fci.function_name) != IS_UNDEF) {
-            zval_ptr_dtor(&stream->cancel_fci.function_name);
-        }
-        if (stream->cancel_fci.object) {
-            OBJ_RELEASE(Z_OBJ(stream->cancel_fci.object));
+    Z_TRY_ADDREF(fci.function_name);
+    add_next_index_zval(&t->callbacks, &fci.function_name);
+
+    // Registered after the fact: it still runs, once
+    if (t->cancelled) {
+        zval retval;
+        if (call_user_function(NULL, NULL, &fci.function_name, &retval, 0, NULL) == SUCCESS) {
+            zval_ptr_dtor(&retval);
         }
     }
+    RETURN_TRUE;
+}
 
-    // Store the new callable information. We must increment the refcount of any
-    // zvals inside to prevent them from being garbage-collected by PHP.
-    stream->cancel_fci = fci;
-    stream->cancel_fcc = fcc;
-    stream->has_cancel_handler = true;
-
-    Z_TRY_ADDREF(stream->cancel_fci.function_name);
-    if (stream->cancel_fci.object) {
-        Z_TRY_ADDREF(stream->cancel_fci.object);
-    }
+PHP_FUNCTION(quicpro_request_cancelled)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
 
-    RETURN_TRUE;
+    RETURN_BOOL(quicpro_cancel_requested());
 }
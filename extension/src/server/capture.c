@@ -0,0 +1,638 @@
+/*
+ * src/server/capture.c – Sampled packet capture with TLS secrets
+ * ==============================================================
+ *
+ * See include/server/capture.h. The ring has a lock, but the datagram
+ * paths only ever try it: the listener thread and its I/O thread both
+ * capture, and whichever comes second drops its datagram rather than
+ * wait. A dump takes the lock for as long as it copies the slots.
+ */
+
+#include "php_quicpro.h"
+#include "server/capture.h"
+#include "config/quic_transport/base_layer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/crypto.h>
+
+#define QP_CAP_MIN_SLOTS    16
+#define QP_CAP_KEYS_MIN     (64 * 1024)         /* Secrets kept before the memfd is replaced, at least */
+#define QP_CAP_IP_HEADROOM  48                  /* IPv6 and UDP header ahead of a datagram in a dump */
+
+#define QP_PCAPNG_SHB       0x0A0D0D0Au
+#define QP_PCAPNG_IDB       0x00000001u
+#define QP_PCAPNG_EPB       0x00000006u
+#define QP_PCAPNG_DSB       0x0000000Au
+#define QP_PCAPNG_TLS_KEYS  0x544c534bu         /* "TLSK": NSS key log format */
+#define QP_LINKTYPE_RAW     101                 /* Raw IPv4 or IPv6 */
+
+/* One captured datagram; `snaplen` bytes of it follow */
+typedef struct {
+    uint64_t time_ns;                   /* CLOCK_REALTIME */
+    uint64_t conn;                      /* The session's capture_id */
+    uint32_t len;                       /* Of the whole datagram */
+    uint16_t caplen;                    /* Of it kept */
+    uint8_t  outgoing;
+    uint8_t  ipv4;                      /* Both addresses are IPv4, or mapped, or unspecified */
+    uint8_t  peer[16], local[16];       /* IPv4 ones mapped */
+    uint16_t peer_port, local_port;
+    uint8_t  pad[4];
+} qp_cap_slot_t;
+
+typedef struct {
+    uint8_t cid[QUICHE_MAX_CONN_ID_LEN];
+    uint8_t len;
+} qp_cap_armed_t;
+
+_Atomic uint32_t quicpro_capture_generation = 0;
+
+static pthread_mutex_t   qp_cap_ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t          *qp_cap_ring = NULL;
+static size_t            qp_cap_slot_size, qp_cap_slots, qp_cap_snaplen;
+static uint64_t          qp_cap_head = 0;
+static _Atomic uint64_t  qp_cap_dropped = 0;
+static uint64_t          qp_cap_rng = 0;
+
+static pthread_mutex_t   qp_cap_keys_lock = PTHREAD_MUTEX_INITIALIZER;
+static int               qp_cap_keys_fd = -1, qp_cap_keys_old = -1;
+
+static pthread_mutex_t   qp_cap_arm_lock = PTHREAD_MUTEX_INITIALIZER;
+static qp_cap_armed_t    qp_cap_armed[QUICPRO_CAPTURE_ARMED_MAX];
+static _Atomic unsigned  qp_cap_narmed = 0;
+static uint32_t          qp_cap_stopped_at = 0;     /* The generation of the last stop */
+
+static uint64_t qp_cap_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* xorshift64*, as for qlog sampling */
+static double qp_cap_random(void)
+{
+    if (!qp_cap_rng) {
+        qp_cap_rng = qp_cap_now_ns() ^ ((uint64_t)getpid() << 32) ^ 0x9e3779b97f4a7c15ULL;
+    }
+    qp_cap_rng ^= qp_cap_rng >> 12;
+    qp_cap_rng ^= qp_cap_rng << 25;
+    qp_cap_rng ^= qp_cap_rng >> 27;
+    return (double)((qp_cap_rng * 0x2545f4914f6cdd1dULL) >> 11) * 0x1.0p-53;
+}
+
+static bool qp_cap_enabled(void)
+{
+    return quicpro_quic_transport_config.capture_ring_bytes > 0;
+}
+
+static void qp_cap_ring_ready(void)
+{
+    pthread_mutex_lock(&qp_cap_ring_lock);
+    if (!qp_cap_ring) {
+        qp_cap_snaplen = (size_t)quicpro_quic_transport_config.capture_snaplen;
+        qp_cap_slot_size = (sizeof(qp_cap_slot_t) + qp_cap_snaplen + 7) & ~(size_t)7;
+        qp_cap_slots = (size_t)quicpro_quic_transport_config.capture_ring_bytes / qp_cap_slot_size;
+        if (qp_cap_slots < QP_CAP_MIN_SLOTS) {
+            qp_cap_slots = QP_CAP_MIN_SLOTS;
+        }
+        qp_cap_ring = pemalloc(qp_cap_slots * qp_cap_slot_size, 1);
+        qp_cap_head = 0;
+    }
+    pthread_mutex_unlock(&qp_cap_ring_lock);
+}
+
+/* Has quiche append `conn`'s secrets to the memfd, replacing a full one */
+static void qp_cap_keylog_conn(quiche_conn *conn)
+{
+    char path[32];
+    pthread_mutex_lock(&qp_cap_keys_lock);
+    size_t cap = (size_t)quicpro_quic_transport_config.capture_ring_bytes / 16;
+    struct stat st;
+    if (qp_cap_keys_fd >= 0 && fstat(qp_cap_keys_fd, &st) == 0
+        && (size_t)st.st_size > (cap > QP_CAP_KEYS_MIN ? cap : QP_CAP_KEYS_MIN)) {
+        if (qp_cap_keys_old >= 0) close(qp_cap_keys_old);
+        qp_cap_keys_old = qp_cap_keys_fd;   /* Connections writing to it keep it open */
+        qp_cap_keys_fd = -1;
+    }
+    if (qp_cap_keys_fd < 0) {
+        qp_cap_keys_fd = memfd_create("quicpro-capture-keys", MFD_CLOEXEC);
+    }
+    int fd = qp_cap_keys_fd;
+    pthread_mutex_unlock(&qp_cap_keys_lock);
+
+    if (fd < 0) {
+        return;     /* Captured, without its secrets */
+    }
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    quiche_conn_set_keylog_path(conn, path);
+}
+
+/*──────────────────────────── Picking connections ────────────────────────*/
+
+/* Whether an armed ID is `cid` or begins it */
+static bool qp_cap_armed_match(const uint8_t *cid, size_t len)
+{
+    bool hit = false;
+    pthread_mutex_lock(&qp_cap_arm_lock);
+    unsigned n = atomic_load_explicit(&qp_cap_narmed, memory_order_relaxed);
+    for (unsigned i = 0; i < n && !hit; i++) {
+        hit = qp_cap_armed[i].len <= len && memcmp(qp_cap_armed[i].cid, cid, qp_cap_armed[i].len) == 0;
+    }
+    pthread_mutex_unlock(&qp_cap_arm_lock);
+    return hit;
+}
+
+void quicpro_capture_keylog_config(quiche_config *config)
+{
+    if (qp_cap_enabled()) {
+        quiche_config_log_keys(config);
+    }
+}
+
+void quicpro_capture_conn_started(quicpro_session_t *session, const uint8_t *scid, size_t scid_len,
+                                  const uint8_t *dcid, size_t dcid_len)
+{
+    session->capture = false;
+    session->capture_id = 0;
+    memcpy(&session->capture_id, scid, scid_len < sizeof(session->capture_id) ? scid_len : sizeof(session->capture_id));
+    if (!qp_cap_enabled()) {
+        return;
+    }
+    double ratio = quicpro_quic_transport_config.capture_sample_ratio;
+    bool pick = ratio > 0.0 && (ratio >= 1.0 || qp_cap_random() < ratio);
+    if (!pick && atomic_load_explicit(&qp_cap_narmed, memory_order_relaxed)) {
+        pick = qp_cap_armed_match(scid, scid_len) || (dcid_len && qp_cap_armed_match(dcid, dcid_len));
+    }
+    if (pick) {
+        quicpro_capture_set(session, true);
+    }
+}
+
+/* `keys`: the caller owns the connection, and may have quiche log its secrets */
+static bool qp_cap_start(quicpro_session_t *session, bool keys)
+{
+    if (!qp_cap_enabled()) {
+        return false;
+    }
+    qp_cap_ring_ready();
+    /* Before the handshake is done, its secrets are still to come */
+    if (keys && !session->capture && session->conn && !quiche_conn_is_established(session->conn)) {
+        qp_cap_keylog_conn(session->conn);
+    }
+    session->capture = true;
+    return true;
+}
+
+bool quicpro_capture_set(quicpro_session_t *session, bool on)
+{
+    if (!on) {
+        session->capture = false;
+        return true;
+    }
+    return qp_cap_start(session, true);
+}
+
+void quicpro_capture_apply(quicpro_cid_table_t *sessions, uint32_t *seen)
+{
+    qp_cap_armed_t armed[QUICPRO_CAPTURE_ARMED_MAX];
+    pthread_mutex_lock(&qp_cap_arm_lock);
+    uint32_t gen = atomic_load_explicit(&quicpro_capture_generation, memory_order_relaxed);
+    bool stop = qp_cap_stopped_at - *seen - 1 < gen - *seen;    /* A stop since this loop's last look */
+    unsigned n = atomic_load_explicit(&qp_cap_narmed, memory_order_relaxed);
+    memcpy(armed, qp_cap_armed, n * sizeof(armed[0]));
+    pthread_mutex_unlock(&qp_cap_arm_lock);
+    *seen = gen;
+
+    const uint8_t *key;
+    size_t key_len, pos = 0;
+    quicpro_session_t *session;
+    while ((session = quicpro_cid_table_next(sessions, &pos, &key, &key_len))) {
+        if (stop) {
+            session->capture = false;
+        }
+        for (unsigned i = 0; i < n; i++) {
+            if (armed[i].len <= key_len && memcmp(armed[i].cid, key, armed[i].len) == 0) {
+                qp_cap_start(session, false);   /* The I/O thread may be receiving on it */
+                break;
+            }
+        }
+    }
+}
+
+static int qp_cap_hex_digit(int c)
+{
+    return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+int quicpro_capture_arm(const char *text, size_t len)
+{
+    qp_cap_armed_t parsed[QUICPRO_CAPTURE_ARMED_MAX];
+    unsigned count = 0;
+    if (!qp_cap_enabled()) {
+        return -1;
+    }
+    for (size_t i = 0; i < len;) {
+        if (text[i] == ' ' || text[i] == '\t' || text[i] == '\r' || text[i] == '\n' || text[i] == ',') {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        while (i < len && qp_cap_hex_digit((unsigned char)text[i]) >= 0) i++;
+        size_t digits = i - start;
+        if (digits == 0 || digits % 2 || digits > 2 * QUICHE_MAX_CONN_ID_LEN || count == QUICPRO_CAPTURE_ARMED_MAX) {
+            return -1;
+        }
+        for (size_t j = 0; j < digits / 2; j++) {
+            parsed[count].cid[j] = (uint8_t)(qp_cap_hex_digit((unsigned char)text[start + 2 * j]) << 4
+                                             | qp_cap_hex_digit((unsigned char)text[start + 2 * j + 1]));
+        }
+        parsed[count++].len = (uint8_t)(digits / 2);
+    }
+
+    pthread_mutex_lock(&qp_cap_arm_lock);
+    unsigned n = atomic_load_explicit(&qp_cap_narmed, memory_order_relaxed);
+    for (unsigned i = 0; i < count; i++) {
+        bool known = false;
+        for (unsigned j = 0; j < n && !known; j++) {
+            known = qp_cap_armed[j].len == parsed[i].len && memcmp(qp_cap_armed[j].cid, parsed[i].cid, parsed[i].len) == 0;
+        }
+        if (known) {
+            continue;
+        }
+        if (n == QUICPRO_CAPTURE_ARMED_MAX) {
+            memmove(qp_cap_armed, qp_cap_armed + 1, (n - 1) * sizeof(qp_cap_armed[0]));   /* The oldest gives way */
+            n--;
+        }
+        qp_cap_armed[n++] = parsed[i];
+    }
+    atomic_store_explicit(&qp_cap_narmed, n, memory_order_relaxed);
+    atomic_fetch_add_explicit(&quicpro_capture_generation, 1, memory_order_release);
+    pthread_mutex_unlock(&qp_cap_arm_lock);
+    return (int)count;
+}
+
+void quicpro_capture_stop(void)
+{
+    pthread_mutex_lock(&qp_cap_arm_lock);
+    atomic_store_explicit(&qp_cap_narmed, 0, memory_order_relaxed);
+    qp_cap_stopped_at = atomic_fetch_add_explicit(&quicpro_capture_generation, 1, memory_order_release) + 1;
+    pthread_mutex_unlock(&qp_cap_arm_lock);
+}
+
+/*──────────────────────────── Capturing ──────────────────────────────────*/
+
+/* An address as IPv6, IPv4 ones mapped; true if it fits IPv4 (as the unspecified one does) */
+static bool qp_cap_addr(const struct sockaddr *sa, uint8_t *ip6, uint16_t *port)
+{
+    static const uint8_t zero[16];
+    memset(ip6, 0, 16);
+    *port = 0;
+    if (sa->sa_family == AF_INET) {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)sa;
+        ip6[10] = ip6[11] = 0xff;
+        memcpy(ip6 + 12, &in->sin_addr, 4);
+        *port = ntohs(in->sin_port);
+        return true;
+    }
+    if (sa->sa_family == AF_INET6) {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)sa;
+        memcpy(ip6, &in6->sin6_addr, 16);
+        *port = ntohs(in6->sin6_port);
+        return IN6_IS_ADDR_V4MAPPED(&in6->sin6_addr) || memcmp(ip6, zero, 16) == 0;
+    }
+    return true;
+}
+
+void quicpro_capture_packet(quicpro_session_t *session, bool outgoing, const struct sockaddr *peer,
+                            const uint8_t *data, size_t len)
+{
+    uint64_t now = qp_cap_now_ns();
+    if (pthread_mutex_trylock(&qp_cap_ring_lock) != 0) {
+        atomic_fetch_add_explicit(&qp_cap_dropped, 1, memory_order_relaxed);
+        return;
+    }
+    if (!qp_cap_ring) {
+        pthread_mutex_unlock(&qp_cap_ring_lock);
+        return;
+    }
+    qp_cap_slot_t *slot = (qp_cap_slot_t *)(qp_cap_ring + (size_t)(qp_cap_head++ % qp_cap_slots) * qp_cap_slot_size);
+    slot->time_ns = now;
+    slot->conn = session->capture_id;
+    slot->len = (uint32_t)len;
+    slot->caplen = (uint16_t)(len < qp_cap_snaplen ? len : qp_cap_snaplen);
+    slot->outgoing = outgoing;
+    bool peer4 = qp_cap_addr(peer ? peer : (const struct sockaddr *)&session->peer_addr, slot->peer, &slot->peer_port);
+    bool local4 = qp_cap_addr((const struct sockaddr *)&session->local_addr, slot->local, &slot->local_port);
+    slot->ipv4 = peer4 && local4;
+    memcpy(slot + 1, data, slot->caplen);
+    pthread_mutex_unlock(&qp_cap_ring_lock);
+}
+
+/*──────────────────────────── pcapng ─────────────────────────────────────*/
+
+typedef struct {
+    uint8_t *p;
+    size_t   len;
+    size_t   cap;
+} qp_cap_buf_t;
+
+static void qp_cap_put(qp_cap_buf_t *b, const void *data, size_t len)
+{
+    if (b->len + len > b->cap) {
+        size_t cap = b->cap ? b->cap : 65536;
+        while (cap < b->len + len) {
+            cap *= 2;
+        }
+        b->p = perealloc(b->p, cap, 1);
+        b->cap = cap;
+    }
+    memcpy(b->p + b->len, data, len);
+    b->len += len;
+}
+
+static void qp_cap_u16(qp_cap_buf_t *b, uint16_t v) { qp_cap_put(b, &v, sizeof(v)); }
+static void qp_cap_u32(qp_cap_buf_t *b, uint32_t v) { qp_cap_put(b, &v, sizeof(v)); }
+
+static void qp_cap_pad(qp_cap_buf_t *b)
+{
+    static const uint8_t zero[4];
+    qp_cap_put(b, zero, (4 - b->len % 4) % 4);
+}
+
+/* A block's type and a length to fill in; the mark for qp_cap_block_end() */
+static size_t qp_cap_block_begin(qp_cap_buf_t *b, uint32_t type)
+{
+    size_t mark = b->len;
+    qp_cap_u32(b, type);
+    qp_cap_u32(b, 0);
+    return mark;
+}
+
+static void qp_cap_block_end(qp_cap_buf_t *b, size_t mark)
+{
+    uint32_t total = (uint32_t)(b->len - mark + 4);
+    memcpy(b->p + mark + 4, &total, sizeof(total));
+    qp_cap_u32(b, total);
+}
+
+static void qp_cap_option(qp_cap_buf_t *b, uint16_t code, const void *value, size_t len)
+{
+    qp_cap_u16(b, code);
+    qp_cap_u16(b, (uint16_t)len);
+    qp_cap_put(b, value, len);
+    qp_cap_pad(b);
+}
+
+static void qp_cap_options_end(qp_cap_buf_t *b)
+{
+    qp_cap_u32(b, 0);    /* opt_endofopt */
+}
+
+static uint16_t qp_cap_ip_checksum(const uint8_t *h, size_t len)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        sum += (uint32_t)h[i] << 8 | h[i + 1];
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+/* The IP and UDP header of a captured datagram, as it crossed the wire; its length */
+static size_t qp_cap_ip_header(const qp_cap_slot_t *s, uint8_t *h)
+{
+    const uint8_t *src = s->outgoing ? s->local : s->peer, *dst = s->outgoing ? s->peer : s->local;
+    uint16_t sport = s->outgoing ? s->local_port : s->peer_port, dport = s->outgoing ? s->peer_port : s->local_port;
+    uint32_t udp_len = 8 + s->len;
+    size_t n;
+
+    if (s->ipv4) {
+        uint32_t total = 20 + udp_len;
+        memset(h, 0, 20);
+        h[0] = 0x45;
+        h[2] = (uint8_t)(total >> 8);
+        h[3] = (uint8_t)total;
+        h[6] = 0x40;                    /* Don't fragment */
+        h[8] = 64;
+        h[9] = IPPROTO_UDP;
+        memcpy(h + 12, src + 12, 4);
+        memcpy(h + 16, dst + 12, 4);
+        uint16_t sum = qp_cap_ip_checksum(h, 20);
+        h[10] = (uint8_t)(sum >> 8);
+        h[11] = (uint8_t)sum;
+        n = 20;
+    } else {
+        memset(h, 0, 8);
+        h[0] = 0x60;
+        h[4] = (uint8_t)(udp_len >> 8);
+        h[5] = (uint8_t)udp_len;
+        h[6] = IPPROTO_UDP;
+        h[7] = 64;
+        memcpy(h + 8, src, 16);
+        memcpy(h + 24, dst, 16);
+        n = 40;
+    }
+    uint8_t *u = h + n;
+    u[0] = (uint8_t)(sport >> 8);
+    u[1] = (uint8_t)sport;
+    u[2] = (uint8_t)(dport >> 8);
+    u[3] = (uint8_t)dport;
+    u[4] = (uint8_t)(udp_len >> 8);
+    u[5] = (uint8_t)udp_len;
+    u[6] = u[7] = 0;                    /* No checksum: nothing downstream checks it */
+    return n + 8;
+}
+
+/* What the key log memfd `fd` holds, appended to `b` */
+static void qp_cap_read_keys(qp_cap_buf_t *b, int fd)
+{
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size <= 0) {
+        return;
+    }
+    uint8_t chunk[8192];
+    off_t off = 0;
+    while (off < st.st_size) {
+        ssize_t got = pread(fd, chunk, sizeof(chunk), off);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        qp_cap_put(b, chunk, (size_t)got);
+        off += got;
+    }
+}
+
+size_t quicpro_capture_pcapng(char **out)
+{
+    *out = NULL;
+    pthread_mutex_lock(&qp_cap_ring_lock);
+    if (!qp_cap_ring || !qp_cap_head) {
+        pthread_mutex_unlock(&qp_cap_ring_lock);
+        return 0;
+    }
+    uint64_t head = qp_cap_head;
+    uint64_t count = head < qp_cap_slots ? head : qp_cap_slots;
+    size_t slot_size = qp_cap_slot_size, snaplen = qp_cap_snaplen;
+    uint8_t *copy = pemalloc((size_t)count * slot_size, 1);
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t seq = head - count + i;
+        memcpy(copy + i * slot_size, qp_cap_ring + (size_t)(seq % qp_cap_slots) * slot_size, slot_size);
+    }
+    pthread_mutex_unlock(&qp_cap_ring_lock);
+
+    qp_cap_buf_t keys = { 0 };
+    pthread_mutex_lock(&qp_cap_keys_lock);
+    qp_cap_read_keys(&keys, qp_cap_keys_old);
+    qp_cap_read_keys(&keys, qp_cap_keys_fd);
+    pthread_mutex_unlock(&qp_cap_keys_lock);
+
+    qp_cap_buf_t b = { 0 };
+    char text[160];
+
+    /* Section Header Block */
+    size_t mark = qp_cap_block_begin(&b, QP_PCAPNG_SHB);
+    qp_cap_u32(&b, 0x1A2B3C4D);
+    qp_cap_u16(&b, 1);
+    qp_cap_u16(&b, 0);
+    qp_cap_u32(&b, 0xffffffffu);       /* Section length unknown */
+    qp_cap_u32(&b, 0xffffffffu);
+    int n = snprintf(text, sizeof(text), "quicpro_async worker %u: %llu earlier datagrams overwritten, %llu dropped while the ring was busy",
+                     (unsigned)getpid(), (unsigned long long)(head - count),
+                     (unsigned long long)atomic_load_explicit(&qp_cap_dropped, memory_order_relaxed));
+    qp_cap_option(&b, 1, text, (size_t)n);                  /* opt_comment */
+    qp_cap_option(&b, 4, "quicpro_async", 13);              /* shb_userappl */
+    qp_cap_options_end(&b);
+    qp_cap_block_end(&b, mark);
+
+    /* Interface Description Block: raw IP, nanosecond timestamps */
+    mark = qp_cap_block_begin(&b, QP_PCAPNG_IDB);
+    qp_cap_u16(&b, QP_LINKTYPE_RAW);
+    qp_cap_u16(&b, 0);
+    qp_cap_u32(&b, (uint32_t)(snaplen + QP_CAP_IP_HEADROOM));
+    qp_cap_option(&b, 2, "quicpro", 7);                     /* if_name */
+    uint8_t tsresol = 9;
+    qp_cap_option(&b, 9, &tsresol, 1);                      /* if_tsresol */
+    qp_cap_options_end(&b);
+    qp_cap_block_end(&b, mark);
+
+    /* Decryption Secrets Block, ahead of the packets it decrypts */
+    if (keys.len) {
+        mark = qp_cap_block_begin(&b, QP_PCAPNG_DSB);
+        qp_cap_u32(&b, QP_PCAPNG_TLS_KEYS);
+        qp_cap_u32(&b, (uint32_t)keys.len);
+        qp_cap_put(&b, keys.p, keys.len);
+        qp_cap_pad(&b);
+        qp_cap_block_end(&b, mark);
+    }
+    if (keys.p) {
+        OPENSSL_cleanse(keys.p, keys.len);
+        pefree(keys.p, 1);
+    }
+
+    /* Enhanced Packet Blocks */
+    for (uint64_t i = 0; i < count; i++) {
+        const qp_cap_slot_t *s = (const qp_cap_slot_t *)(copy + i * slot_size);
+        uint8_t hdr[QP_CAP_IP_HEADROOM];
+        size_t hdr_len = qp_cap_ip_header(s, hdr);
+        mark = qp_cap_block_begin(&b, QP_PCAPNG_EPB);
+        qp_cap_u32(&b, 0);
+        qp_cap_u32(&b, (uint32_t)(s->time_ns >> 32));
+        qp_cap_u32(&b, (uint32_t)s->time_ns);
+        qp_cap_u32(&b, (uint32_t)(hdr_len + s->caplen));
+        qp_cap_u32(&b, (uint32_t)(hdr_len + s->len));
+        qp_cap_put(&b, hdr, hdr_len);
+        qp_cap_put(&b, s + 1, s->caplen);
+        qp_cap_pad(&b);
+        uint32_t flags = s->outgoing ? 2 : 1;               /* Direction: inbound 1, outbound 2 */
+        qp_cap_option(&b, 2, &flags, sizeof(flags));        /* epb_flags */
+        n = snprintf(text, sizeof(text), "conn %016llx", (unsigned long long)__builtin_bswap64(s->conn));
+        qp_cap_option(&b, 1, text, (size_t)n);              /* opt_comment */
+        qp_cap_options_end(&b);
+        qp_cap_block_end(&b, mark);
+    }
+    pefree(copy, 1);
+
+    *out = (char *)b.p;
+    return b.len;
+}
+
+void quicpro_capture_mshutdown(void)
+{
+    pthread_mutex_lock(&qp_cap_ring_lock);
+    if (qp_cap_ring) {
+        pefree(qp_cap_ring, 1);
+        qp_cap_ring = NULL;
+    }
+    pthread_mutex_unlock(&qp_cap_ring_lock);
+    pthread_mutex_lock(&qp_cap_keys_lock);
+    if (qp_cap_keys_fd >= 0) close(qp_cap_keys_fd);
+    if (qp_cap_keys_old >= 0) close(qp_cap_keys_old);
+    qp_cap_keys_fd = qp_cap_keys_old = -1;
+    pthread_mutex_unlock(&qp_cap_keys_lock);
+}
+
+/*──────────────────────────── PHP API ────────────────────────────────────*/
+
+PHP_FUNCTION(quicpro_capture_connection)
+{
+    zval *z_session_res;
+    bool enable = true;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_RESOURCE(z_session_res)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_BOOL(enable)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = (quicpro_session_t *)zend_fetch_resource_ex(z_session_res, "Quicpro Session", le_quicpro_session);
+    if (!s || !s->conn) {
+        zend_value_error("Invalid or closed session resource");
+        RETURN_THROWS();
+    }
+    RETURN_BOOL(quicpro_capture_set(s, enable));
+}
+
+PHP_FUNCTION(quicpro_capture_dump)
+{
+    zend_string *path = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(0, 1)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR_OR_NULL(path)
+    ZEND_PARSE_PARAMETERS_END();
+
+    char *dump;
+    size_t len = quicpro_capture_pcapng(&dump);
+    if (!path) {
+        RETVAL_STRINGL(dump ? dump : "", len);
+        if (dump) {
+            pefree(dump, 1);
+        }
+        return;
+    }
+
+    FILE *f = fopen(ZSTR_VAL(path), "wb");
+    bool ok = f && fwrite(dump ? dump : "", 1, len, f) == len;
+    if (f && fclose(f) != 0) {
+        ok = false;
+    }
+    if (dump) {
+        pefree(dump, 1);
+    }
+    if (!ok) {
+        php_error_docref(NULL, E_WARNING, "quicpro_capture_dump(): cannot write '%s': %s", ZSTR_VAL(path), strerror(errno));
+    }
+    RETURN_BOOL(ok);
+}
@@ -0,0 +1,1296 @@
+/*
+ * src/server/cdn_cache.c – Response cache of the native CDN
+ * ==========================================================
+ *
+ * See include/server/cdn_cache.h. An object is a single block: the entry
+ * header, the nghttp2_nv array, the key, the HTTP/1 header lines and the
+ * body (unless it is sent from a disk segment). The cache holds one
+ * reference to each object it lists; listeners hold one for each response
+ * they are still sending.
+ *
+ * Listed objects live in one MAP_SHARED arena, mapped by the cluster
+ * master before it forks, so every worker sees the same shards at the
+ * same address and the arena refers to itself by plain pointers. Each
+ * shard owns a slice of it, carved into power-of-two blocks of at least
+ * 256 bytes with a free list per size, and a robust process-shared mutex.
+ * Objects never listed (those sent from a disk segment) are private to
+ * the worker and come from its own heap.
+ */
+
+#include <php.h>
+
+#include "server/cdn_cache.h"
+#include "server/cdn_disk.h"
+#include "config/native_cdn/base_layer.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define QP_CDN_SHARDS         64      /* Workers contend across processes */
+#define QP_CDN_VARY_MAX       8
+#define QP_CDN_HIT_LINES_MAX  8
+#define QP_CDN_SKETCH_ROWS    4
+#define QP_CDN_FLIGHTS        256
+#define QP_CDN_MIN_BLOCK      8       /* log2 of the smallest block */
+#define QP_CDN_CLASSES        40
+#define QP_CDN_HEAP           0xff    /* Class of a worker's private object */
+#define QP_CDN_EVICT_TRIES    64
+#define QP_CDN_PAGE           4096
+
+enum { QP_CDN_WINDOW, QP_CDN_PROBATION, QP_CDN_PROTECTED };
+
+typedef struct qp_cdn_entry_s {
+    quicpro_cdn_object_t   pub;         /* First: what listeners are handed */
+    uint64_t               hash;
+    uint64_t               expires_ms;
+    size_t                 charge;      /* Bytes allocated for the block */
+    const char            *key;
+    size_t                 key_len;
+    uint8_t                queue;
+    uint8_t                shard;
+    uint8_t                cls;         /* Block size class, or QP_CDN_HEAP */
+    uint32_t               gen;         /* The shard's generation it was carved in */
+    uint64_t               version;     /* Shared by a sliced object's head and slices */
+    struct qp_cdn_entry_s *chain;       /* Bucket */
+    struct qp_cdn_entry_s *prev, *next; /* Queue, head most recent */
+} qp_cdn_entry_t;
+
+typedef struct {
+    qp_cdn_entry_t *head, *tail;
+    size_t          bytes;
+} qp_cdn_queue_t;
+
+/* A block on its size's free list */
+typedef struct qp_cdn_block_s {
+    struct qp_cdn_block_s *next;
+} qp_cdn_block_t;
+
+typedef struct {
+    pthread_mutex_t  lock;              /* Process-shared and robust */
+    qp_cdn_entry_t **buckets;           /* A fixed number, sized for the slice */
+    size_t           bucket_mask;
+    size_t           count;
+    qp_cdn_queue_t   q[3];
+    size_t           capacity;
+    size_t           window_capacity;
+    size_t           protected_capacity;
+    /* Count-min sketch: QP_CDN_SKETCH_ROWS rows of 4-bit counters, 16 per word */
+    uint64_t        *sketch;
+    size_t           sketch_width;      /* Counters per row, a power of two */
+    uint32_t         additions;
+    uint32_t         sample;            /* Additions before all counters halve */
+    /* The shard's slice of the arena */
+    char            *base, *bump, *end;
+    qp_cdn_block_t  *free[QP_CDN_CLASSES];
+    uint32_t         gen;               /* Bumped when the slice starts over */
+} qp_cdn_shard_t;
+
+/* Keys being fetched by any worker; hash 0 marks a free entry */
+typedef struct {
+    uint64_t hash;
+    uint64_t started_ms;
+} qp_cdn_flight_t;
+
+typedef struct {
+    pthread_mutex_t  flight_lock;
+    qp_cdn_flight_t  flights[QP_CDN_FLIGHTS];
+    _Atomic uint64_t versions;
+    size_t           max_object;        /* 0 without a memory tier */
+    qp_cdn_shard_t   shards[QP_CDN_SHARDS];
+} qp_cdn_arena_t;
+
+typedef struct {
+    char   *name;
+    size_t  len;
+} qp_cdn_name_t;
+
+static pthread_once_t  qp_cdn_once = PTHREAD_ONCE_INIT;
+static bool            qp_cdn_on = false;
+static bool            qp_cdn_mem_on = false;
+static bool            qp_cdn_disk_on = false;
+static qp_cdn_arena_t *qp_cdn_arena = NULL;
+static size_t          qp_cdn_arena_size = 0;
+static qp_cdn_name_t   qp_cdn_vary[QP_CDN_VARY_MAX];
+static size_t          qp_cdn_vary_n = 0;
+static size_t          qp_cdn_max_object = 0;
+static size_t          qp_cdn_slice = 0;        /* Body bytes per slice; 0 if bodies are not sliced */
+static uint64_t        qp_cdn_default_ttl_ms = 0;
+
+/* quicpro.cdn_response_headers_to_add, appended to every object's lines */
+static nghttp2_nv      qp_cdn_hit_nv[QP_CDN_HIT_LINES_MAX];
+static size_t          qp_cdn_hit_n = 0;
+static char           *qp_cdn_hit_text = NULL;
+
+static uint64_t qp_cdn_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/* The disk tier's expiry survives restarts, so it is wall-clock time */
+static uint64_t qp_cdn_wall_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static uint64_t qp_cdn_mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static size_t qp_cdn_pow2_at_least(size_t n)
+{
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+static size_t qp_cdn_page_round(size_t n)
+{
+    return (n + QP_CDN_PAGE - 1) & ~(size_t)(QP_CDN_PAGE - 1);
+}
+
+static bool qp_cdn_mutex_init(pthread_mutex_t *m)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    bool ok = pthread_mutex_init(m, &attr) == 0;
+    pthread_mutexattr_destroy(&attr);
+    return ok;
+}
+
+/* True when the previous holder died with the lock held */
+static bool qp_cdn_mutex_lock(pthread_mutex_t *m)
+{
+    if (pthread_mutex_lock(m) != EOWNERDEAD) {
+        return false;
+    }
+    pthread_mutex_consistent(m);
+    return true;
+}
+
+static const char *qp_cdn_trim(const char *s, const char *end, size_t *len)
+{
+    while (s < end && (*s == ' ' || *s == '\t')) s++;
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t')) end--;
+    *len = (size_t)(end - s);
+    return s;
+}
+
+/*──────────────────────────── Setup ──────────────────────────────────────*/
+
+static void qp_cdn_parse_vary(const char *list)
+{
+    const char *p = list;
+    while (p && *p && qp_cdn_vary_n < QP_CDN_VARY_MAX) {
+        const char *comma = strchr(p, ',');
+        const char *end = comma ? comma : p + strlen(p);
+        size_t len;
+        const char *name = qp_cdn_trim(p, end, &len);
+        if (len) {
+            char *lower = pemalloc(len + 1, 1);
+            for (size_t i = 0; i < len; i++) lower[i] = (char)tolower((unsigned char)name[i]);
+            lower[len] = '\0';
+            qp_cdn_vary[qp_cdn_vary_n++] = (qp_cdn_name_t){ lower, len };
+        }
+        p = comma ? comma + 1 : NULL;
+    }
+}
+
+/* "Name: value,Name: value" into lower-case lines that point into one buffer */
+static void qp_cdn_parse_hit_headers(const char *list)
+{
+    if (!list || !*list) return;
+    size_t cap = strlen(list) + 1;
+    char *out = qp_cdn_hit_text = pemalloc(cap, 1);
+    const char *p = list;
+    while (p && *p && qp_cdn_hit_n < QP_CDN_HIT_LINES_MAX) {
+        const char *comma = strchr(p, ',');
+        const char *end = comma ? comma : p + strlen(p);
+        const char *colon = memchr(p, ':', (size_t)(end - p));
+        if (colon) {
+            size_t nlen, vlen;
+            const char *name = qp_cdn_trim(p, colon, &nlen);
+            const char *value = qp_cdn_trim(colon + 1, end, &vlen);
+            if (quicpro_header_is_sendable(name, nlen, value, vlen)) {
+                for (size_t i = 0; i < nlen; i++) out[i] = (char)tolower((unsigned char)name[i]);
+                memcpy(out + nlen, value, vlen);
+                qp_cdn_hit_nv[qp_cdn_hit_n++] = (nghttp2_nv){ (uint8_t *)out, (uint8_t *)out + nlen, nlen, vlen, NGHTTP2_NV_FLAG_NONE };
+                out += nlen + vlen;
+            }
+        }
+        p = comma ? comma + 1 : NULL;
+    }
+}
+
+static bool qp_cdn_wants_memory(const qp_native_cdn_config_t *c)
+{
+    return (strcasecmp(c->cache_mode, "memory") == 0 || strcasecmp(c->cache_mode, "hybrid") == 0)
+        && c->cache_memory_limit_mb > 0;
+}
+
+void quicpro_cdn_cache_prepare(void)
+{
+    const qp_native_cdn_config_t *c = &quicpro_native_cdn_config;
+    if (qp_cdn_arena || !c->enable || !c->cache_mode) {
+        return;
+    }
+
+    /* Without a memory tier the arena only holds the flights */
+    size_t per_shard = 0, nbuckets = 0, width = 0;
+    if (qp_cdn_wants_memory(c)) {
+        per_shard = (((size_t)c->cache_memory_limit_mb << 20) / QP_CDN_SHARDS) & ~(size_t)(QP_CDN_PAGE - 1);
+        nbuckets = qp_cdn_pow2_at_least(per_shard / 4096);
+        if (nbuckets < 64) nbuckets = 64;
+        /* One counter per ~4 KiB of budget: the sketch tracks several times as many keys as fit */
+        width = qp_cdn_pow2_at_least(per_shard / 4096);
+        if (width < 1024) width = 1024;
+        if (width > (1u << 20)) width = 1u << 20;
+    }
+    size_t meta = qp_cdn_page_round(nbuckets * sizeof(qp_cdn_entry_t *) + QP_CDN_SKETCH_ROWS * width / 16 * sizeof(uint64_t));
+    size_t head = qp_cdn_page_round(sizeof(qp_cdn_arena_t));
+    size_t size = head + QP_CDN_SHARDS * (meta + per_shard);
+
+    /* Untouched pages cost nothing until objects fill them */
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED) {
+        php_error_docref(NULL, E_WARNING, "CDN cache arena unavailable (%zu bytes); responses are not cached", size);
+        return;
+    }
+    qp_cdn_arena_t *arena = mem;
+    bool ok = qp_cdn_mutex_init(&arena->flight_lock);
+    char *at = (char *)mem + head;
+    for (size_t i = 0; ok && i < QP_CDN_SHARDS; i++) {
+        qp_cdn_shard_t *s = &arena->shards[i];
+        ok = qp_cdn_mutex_init(&s->lock);
+        s->buckets = (qp_cdn_entry_t **)at;
+        s->bucket_mask = nbuckets ? nbuckets - 1 : 0;
+        s->sketch = (uint64_t *)(at + nbuckets * sizeof(qp_cdn_entry_t *));
+        s->sketch_width = width;
+        s->sample = (uint32_t)(width * 10);
+        s->capacity = per_shard;
+        s->window_capacity = per_shard / 100;
+        s->protected_capacity = (per_shard - s->window_capacity) / 10 * 8;
+        s->base = s->bump = at + meta;
+        s->end = s->base + per_shard;
+        at = s->end;
+    }
+    if (!ok) {
+        munmap(mem, size);
+        return;
+    }
+    /* One object may take an eighth of its shard, so no single body flushes it */
+    arena->max_object = (size_t)c->cache_max_object_size_mb << 20;
+    if (arena->max_object > per_shard / 8) arena->max_object = per_shard / 8;
+
+    qp_cdn_arena = arena;
+    qp_cdn_arena_size = size;
+}
+
+void quicpro_cdn_cache_release(void)
+{
+    if (qp_cdn_arena) {
+        munmap(qp_cdn_arena, qp_cdn_arena_size);
+        qp_cdn_arena = NULL;
+        qp_cdn_arena_size = 0;
+    }
+}
+
+static void qp_cdn_init(void)
+{
+    const qp_native_cdn_config_t *c = &quicpro_native_cdn_config;
+    /* Outside a cluster nobody prepared the arena; a private one still caches for this process */
+    quicpro_cdn_cache_prepare();
+    if (!qp_cdn_arena) {
+        return;
+    }
+    qp_cdn_max_object = qp_cdn_arena->max_object;
+    qp_cdn_mem_on = qp_cdn_max_object > 0;
+    /* A page short of a power of two, so a slice with its key and entry fills its block */
+    size_t block = 1u << 20;
+    while (block > qp_cdn_max_object) block >>= 1;
+    qp_cdn_slice = block >= 65536 ? block - QP_CDN_PAGE : 0;
+    if (strcasecmp(c->cache_mode, "hybrid") == 0 || strcasecmp(c->cache_mode, "disk") == 0) {
+        qp_cdn_disk_on = quicpro_cdn_disk_open(c->cache_disk_path);
+    }
+    if (!qp_cdn_mem_on && !qp_cdn_disk_on) {
+        return;
+    }
+    qp_cdn_default_ttl_ms = (uint64_t)c->cache_default_ttl_sec * 1000;
+    qp_cdn_parse_vary(c->cache_vary_on_headers);
+    qp_cdn_parse_hit_headers(c->response_headers_to_add);
+    qp_cdn_on = true;
+}
+
+bool quicpro_cdn_cache_enabled(void)
+{
+    pthread_once(&qp_cdn_once, qp_cdn_init);
+    return qp_cdn_on;
+}
+
+/*──────────────────────────── Keys ───────────────────────────────────────*/
+
+static void qp_cdn_key_put(quicpro_cdn_key_t *k, const char *data, size_t len)
+{
+    if (!k->ok || len + 1 > sizeof(k->buf) - k->len) {
+        k->ok = false;
+        return;
+    }
+    memcpy(k->buf + k->len, data, len);
+    k->len += len;
+    k->buf[k->len++] = '\0';            /* Separator; no part may contain it */
+}
+
+void quicpro_cdn_key_begin(quicpro_cdn_key_t *k, const char *authority, size_t authority_len, const char *path, size_t path_len)
+{
+    k->len = 0;
+    k->hash = 0;
+    k->ok = true;
+    /* Host names compare case-insensitively */
+    for (size_t i = 0; i < authority_len && k->ok; i++) {
+        if (k->len >= sizeof(k->buf) - 1) k->ok = false;
+        else k->buf[k->len++] = (char)tolower((unsigned char)authority[i]);
+    }
+    if (k->ok) k->buf[k->len++] = '\0';
+    qp_cdn_key_put(k, path, path_len);
+}
+
+size_t quicpro_cdn_vary_count(void)
+{
+    return qp_cdn_vary_n;
+}
+
+const char *quicpro_cdn_vary_name(size_t i, size_t *len)
+{
+    *len = qp_cdn_vary[i].len;
+    return qp_cdn_vary[i].name;
+}
+
+void quicpro_cdn_key_vary(quicpro_cdn_key_t *k, const char *value, size_t len)
+{
+    /* An absent header keys differently from an empty one */
+    if (!value) {
+        qp_cdn_key_put(k, "", 0);
+        return;
+    }
+    if (k->ok && k->len < sizeof(k->buf)) k->buf[k->len++] = '=';
+    else k->ok = false;
+    qp_cdn_key_put(k, value, len);
+}
+
+void quicpro_cdn_key_coding(quicpro_cdn_key_t *k, quicpro_coding_t coding)
+{
+    /* After the vary parts, whose count is fixed; '~' sets it apart from a slice's '#' */
+    size_t len;
+    const char *name = quicpro_coding_name(coding, &len);
+    if (name) {
+        char part[8];
+        part[0] = '~';
+        memcpy(part + 1, name, len);
+        qp_cdn_key_put(k, part, len + 1);
+    }
+}
+
+void quicpro_cdn_key_end(quicpro_cdn_key_t *k)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < k->len; i++) {
+        h ^= (unsigned char)k->buf[i];
+        h *= 0x100000001b3ULL;
+    }
+    k->hash = h;
+}
+
+/*──────────────────────────── Frequency sketch ───────────────────────────*/
+
+static void qp_cdn_sketch_slot(const qp_cdn_shard_t *s, uint64_t hash, int row, size_t *word, unsigned *shift)
+{
+    size_t idx = (size_t)qp_cdn_mix(hash + (uint64_t)row * 0x9e3779b97f4a7c15ULL) & (s->sketch_width - 1);
+    *word = (size_t)row * (s->sketch_width / 16) + idx / 16;
+    *shift = (unsigned)(idx % 16) * 4;
+}
+
+static unsigned qp_cdn_frequency(const qp_cdn_shard_t *s, uint64_t hash)
+{
+    unsigned f = 15;
+    for (int row = 0; row < QP_CDN_SKETCH_ROWS; row++) {
+        size_t word;
+        unsigned shift;
+        qp_cdn_sketch_slot(s, hash, row, &word, &shift);
+        unsigned c = (unsigned)(s->sketch[word] >> shift) & 0xf;
+        if (c < f) f = c;
+    }
+    return f;
+}
+
+static void qp_cdn_record(qp_cdn_shard_t *s, uint64_t hash)
+{
+    bool added = false;
+    for (int row = 0; row < QP_CDN_SKETCH_ROWS; row++) {
+        size_t word;
+        unsigned shift;
+        qp_cdn_sketch_slot(s, hash, row, &word, &shift);
+        if (((s->sketch[word] >> shift) & 0xf) < 15) {
+            s->sketch[word] += 1ULL << shift;
+            added = true;
+        }
+    }
+    if (added && ++s->additions >= s->sample) {
+        /* Halve every counter, so old popularity fades */
+        size_t words = QP_CDN_SKETCH_ROWS * s->sketch_width / 16;
+        for (size_t i = 0; i < words; i++) {
+            s->sketch[i] = (s->sketch[i] >> 1) & 0x7777777777777777ULL;
+        }
+        s->additions /= 2;
+    }
+}
+
+/*──────────────────────────── Shards ─────────────────────────────────────*/
+
+static qp_cdn_shard_t *qp_cdn_shard_of(uint64_t hash)
+{
+    return &qp_cdn_arena->shards[(hash >> 58) % QP_CDN_SHARDS];
+}
+
+static unsigned qp_cdn_class_of(size_t size)
+{
+    unsigned cls = 0;
+    while (((size_t)1 << (cls + QP_CDN_MIN_BLOCK)) < size) cls++;
+    return cls;
+}
+
+static void *qp_cdn_block_take(qp_cdn_shard_t *s, unsigned cls)
+{
+    qp_cdn_block_t *b = s->free[cls];
+    if (b) {
+        s->free[cls] = b->next;
+        return b;
+    }
+    size_t size = (size_t)1 << (cls + QP_CDN_MIN_BLOCK);
+    if ((size_t)(s->end - s->bump) < size) {
+        return NULL;
+    }
+    b = (qp_cdn_block_t *)s->bump;
+    s->bump += size;
+    return b;
+}
+
+static void qp_cdn_block_give(qp_cdn_shard_t *s, qp_cdn_entry_t *e)
+{
+    /* A block from before the shard started over belongs to its new contents */
+    if (e->gen != s->gen) return;
+    qp_cdn_block_t *b = (qp_cdn_block_t *)e;
+    b->next = s->free[e->cls];
+    s->free[e->cls] = b;
+}
+
+/*
+ * Empties a shard whose lock holder died halfway through changing it.
+ * Objects of it another worker is still sending may be overwritten by
+ * new ones; a death inside these few instructions is rare enough.
+ */
+static void qp_cdn_shard_reset(qp_cdn_shard_t *s)
+{
+    memset(s->buckets, 0, (s->bucket_mask + 1) * sizeof(*s->buckets));
+    memset(s->q, 0, sizeof(s->q));
+    memset(s->free, 0, sizeof(s->free));
+    s->count = 0;
+    s->bump = s->base;
+    s->gen++;
+}
+
+static void qp_cdn_lock(qp_cdn_shard_t *s)
+{
+    if (qp_cdn_mutex_lock(&s->lock)) qp_cdn_shard_reset(s);
+}
+
+/* Drops a reference with the shard locked */
+static void qp_cdn_unref_locked(qp_cdn_shard_t *s, qp_cdn_entry_t *e)
+{
+    if (atomic_fetch_sub_explicit(&e->pub.refs, 1, memory_order_acq_rel) == 1) qp_cdn_block_give(s, e);
+}
+
+static void qp_cdn_queue_unlink(qp_cdn_shard_t *s, qp_cdn_entry_t *e)
+{
+    qp_cdn_queue_t *q = &s->q[e->queue];
+    if (e->prev) e->prev->next = e->next; else q->head = e->next;
+    if (e->next) e->next->prev = e->prev; else q->tail = e->prev;
+    e->prev = e->next = NULL;
+    q->bytes -= e->charge;
+}
+
+static void qp_cdn_queue_push(qp_cdn_shard_t *s, qp_cdn_entry_t *e, uint8_t queue)
+{
+    qp_cdn_queue_t *q = &s->q[queue];
+    e->queue = queue;
+    e->prev = NULL;
+    e->next = q->head;
+    if (q->head) q->head->prev = e; else q->tail = e;
+    q->head = e;
+    q->bytes += e->charge;
+}
+
+static qp_cdn_entry_t *qp_cdn_find(qp_cdn_shard_t *s, const quicpro_cdn_key_t *k)
+{
+    for (qp_cdn_entry_t *e = s->buckets[k->hash & s->bucket_mask]; e; e = e->chain) {
+        if (e->hash == k->hash && e->key_len == k->len && memcmp(e->key, k->buf, k->len) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/* Takes `e`, already out of its queue, out of its bucket and drops the cache's reference */
+static void qp_cdn_forget(qp_cdn_shard_t *s, qp_cdn_entry_t *e)
+{
+    qp_cdn_entry_t **at = &s->buckets[e->hash & s->bucket_mask];
+    while (*at != e) at = &(*at)->chain;
+    *at = e->chain;
+    s->count--;
+    qp_cdn_unref_locked(s, e);
+}
+
+static void qp_cdn_drop(qp_cdn_shard_t *s, qp_cdn_entry_t *e)
+{
+    qp_cdn_queue_unlink(s, e);
+    qp_cdn_forget(s, e);
+}
+
+static size_t qp_cdn_main_bytes(const qp_cdn_shard_t *s)
+{
+    return s->q[QP_CDN_PROBATION].bytes + s->q[QP_CDN_PROTECTED].bytes;
+}
+
+/* Demotes protected overflow, then lets window overflow compete for the main area */
+static void qp_cdn_balance(qp_cdn_shard_t *s)
+{
+    while (s->q[QP_CDN_PROTECTED].bytes > s->protected_capacity) {
+        qp_cdn_entry_t *e = s->q[QP_CDN_PROTECTED].tail;
+        qp_cdn_queue_unlink(s, e);
+        qp_cdn_queue_push(s, e, QP_CDN_PROBATION);
+    }
+
+    size_t main_capacity = s->capacity - s->window_capacity;
+    while (s->q[QP_CDN_WINDOW].bytes > s->window_capacity) {
+        qp_cdn_entry_t *candidate = s->q[QP_CDN_WINDOW].tail;
+        qp_cdn_queue_unlink(s, candidate);
+        unsigned candidate_freq = qp_cdn_frequency(s, candidate->hash);
+        bool admitted = true;
+        while (qp_cdn_main_bytes(s) + candidate->charge > main_capacity) {
+            qp_cdn_entry_t *victim = s->q[QP_CDN_PROBATION].tail;
+            if (!victim) victim = s->q[QP_CDN_PROTECTED].tail;
+            if (!victim) break;
+            if (candidate_freq <= qp_cdn_frequency(s, victim->hash)) {
+                admitted = false;
+                break;
+            }
+            qp_cdn_drop(s, victim);
+        }
+        if (admitted) {
+            qp_cdn_queue_push(s, candidate, QP_CDN_PROBATION);
+        } else {
+            qp_cdn_forget(s, candidate);
+        }
+    }
+}
+
+static void qp_cdn_touch(qp_cdn_shard_t *s, qp_cdn_entry_t *e)
+{
+    uint8_t to = e->queue == QP_CDN_WINDOW ? QP_CDN_WINDOW : QP_CDN_PROTECTED;
+    qp_cdn_queue_unlink(s, e);
+    qp_cdn_queue_push(s, e, to);
+    if (to == QP_CDN_PROTECTED) qp_cdn_balance(s);
+}
+
+/*
+ * A block of size class `cls`. Space freed in other sizes does not serve
+ * this one, so objects go from the cold end until one of its size is back.
+ */
+static void *qp_cdn_alloc(qp_cdn_shard_t *s, unsigned cls)
+{
+    void *b = qp_cdn_block_take(s, cls);
+    for (int i = 0; !b && i < QP_CDN_EVICT_TRIES; i++) {
+        qp_cdn_entry_t *victim = s->q[QP_CDN_PROBATION].tail;
+        if (!victim) victim = s->q[QP_CDN_WINDOW].tail;
+        if (!victim) victim = s->q[QP_CDN_PROTECTED].tail;
+        if (!victim) break;
+        qp_cdn_drop(s, victim);
+        b = qp_cdn_block_take(s, cls);
+    }
+    return b;
+}
+
+/*──────────────────────────── Objects ────────────────────────────────────*/
+
+/*
+ * One block for an object from its rendered lines, the nv entries pointed
+ * into them. With `inline_body` the body follows the lines (copied from
+ * `body` unless NULL, when the caller fills it); otherwise it stays in a
+ * file. `k` is NULL for an object never listed, which the worker's heap
+ * holds; otherwise the block is carved from the key's shard, and NULL
+ * returned if there is no room.
+ */
+static qp_cdn_entry_t *qp_cdn_entry_new(const quicpro_cdn_key_t *k, uint16_t status, const char *h1, size_t h1_len,
+                                        const char *body, size_t body_len, bool inline_body)
+{
+    size_t lines = 0;
+    for (const char *p = h1; (p = memchr(p, '\n', (size_t)(h1 + h1_len - p))); p++) lines++;
+    size_t key_len = k ? k->len : 0;
+    size_t nv_off = sizeof(qp_cdn_entry_t);
+    size_t key_off = nv_off + lines * sizeof(nghttp2_nv);
+    size_t h1_off = key_off + key_len;
+    size_t body_off = h1_off + h1_len;
+    size_t charge = body_off + (inline_body ? body_len : 0);
+
+    char *block;
+    unsigned cls = QP_CDN_HEAP, shard = 0;
+    uint32_t gen = 0;
+    if (k) {
+        qp_cdn_shard_t *s = qp_cdn_shard_of(k->hash);
+        cls = qp_cdn_class_of(charge);
+        if (cls >= QP_CDN_CLASSES) return NULL;
+        qp_cdn_lock(s);
+        block = qp_cdn_alloc(s, cls);
+        gen = s->gen;
+        pthread_mutex_unlock(&s->lock);
+        if (!block) return NULL;
+        charge = (size_t)1 << (cls + QP_CDN_MIN_BLOCK);
+        shard = (unsigned)(s - qp_cdn_arena->shards);
+    } else {
+        block = pemalloc(charge, 1);
+    }
+    /* Filled outside the lock: nobody else knows the block yet */
+    qp_cdn_entry_t *e = (qp_cdn_entry_t *)block;
+    memset(e, 0, sizeof(*e));
+    e->shard = (uint8_t)shard;
+    e->cls = (uint8_t)cls;
+    e->gen = gen;
+    atomic_init(&e->pub.refs, 1);
+    e->pub.status = status;
+    e->pub.h1 = block + h1_off;
+    e->pub.h1_len = h1_len;
+    e->pub.body = inline_body ? block + body_off : NULL;
+    e->pub.body_len = body_len;
+    e->pub.body_fd = -1;
+    e->hash = k ? k->hash : 0;
+    e->key = block + key_off;
+    e->key_len = key_len;
+    e->charge = charge;
+    if (k) memcpy(block + key_off, k->buf, key_len);
+    memcpy(block + h1_off, h1, h1_len);
+    if (inline_body && body) memcpy(block + body_off, body, body_len);
+
+    nghttp2_nv *nv = (nghttp2_nv *)(block + nv_off);
+    char *p = block + h1_off, *end = p + h1_len;
+    size_t n = 0;
+    while (p < end && n < lines) {
+        char *eol = memchr(p, '\r', (size_t)(end - p));
+        char *colon = eol ? memchr(p, ':', (size_t)(eol - p)) : NULL;
+        if (!colon || eol - colon < 2) break;
+        nv[n++] = (nghttp2_nv){ (uint8_t *)p, (uint8_t *)colon + 2, (size_t)(colon - p), (size_t)(eol - colon - 2), NGHTTP2_NV_FLAG_NONE };
+        p = eol + 2;
+    }
+    e->pub.nv = nv;
+    e->pub.nv_count = n;
+    return e;
+}
+
+/* Lists `e` in the memory tier, in place of the key's previous object; takes its reference */
+static void qp_cdn_insert(qp_cdn_entry_t *e)
+{
+    qp_cdn_shard_t *s = qp_cdn_shard_of(e->hash);
+    qp_cdn_lock(s);
+    if (e->gen != s->gen) {
+        /* The shard started over while the block was being filled */
+        qp_cdn_unref_locked(s, e);
+        pthread_mutex_unlock(&s->lock);
+        return;
+    }
+    for (qp_cdn_entry_t *old = s->buckets[e->hash & s->bucket_mask]; old; old = old->chain) {
+        if (old->hash == e->hash && old->key_len == e->key_len && memcmp(old->key, e->key, e->key_len) == 0) {
+            qp_cdn_drop(s, old);
+            break;
+        }
+    }
+    qp_cdn_entry_t **bucket = &s->buckets[e->hash & s->bucket_mask];
+    e->chain = *bucket;
+    *bucket = e;
+    s->count++;
+    qp_cdn_queue_push(s, e, QP_CDN_WINDOW);
+    qp_cdn_balance(s);
+    pthread_mutex_unlock(&s->lock);
+}
+
+/*
+ * The disk tier's object for `k`. Bodies the memory tier takes are read
+ * once and listed there (the cache's admission still decides whether
+ * they stay); larger ones are sent from the segment file.
+ */
+static quicpro_cdn_object_t *qp_cdn_from_disk(const quicpro_cdn_key_t *k, bool allow_stale)
+{
+    quicpro_cdn_disk_hit_t hit;
+    if (!qp_cdn_disk_on || !quicpro_cdn_disk_lookup(k->buf, k->len, k->hash, allow_stale, &hit)) {
+        return NULL;
+    }
+    quicpro_cdn_object_t *o = NULL;
+    qp_cdn_entry_t *e;
+    if (qp_cdn_mem_on && hit.body_len <= qp_cdn_max_object
+        && (e = qp_cdn_entry_new(k, hit.status, hit.h1, hit.h1_len, NULL, (size_t)hit.body_len, true))) {
+        if (quicpro_cdn_disk_read_body(&hit, (char *)e->pub.body)) {
+            uint64_t wall = qp_cdn_wall_ms();
+            e->expires_ms = qp_cdn_now_ms() + (hit.expires_ms > wall ? hit.expires_ms - wall : 0);
+            atomic_fetch_add_explicit(&e->pub.refs, 1, memory_order_relaxed);   /* Ours, beside the cache's */
+            qp_cdn_insert(e);
+            o = &e->pub;
+        } else {
+            quicpro_cdn_release(&e->pub);
+        }
+    }
+    if (!o) {
+        e = qp_cdn_entry_new(NULL, hit.status, hit.h1, hit.h1_len, NULL, (size_t)hit.body_len, false);
+        e->pub.body_fd = hit.fd;
+        e->pub.body_offset = hit.body_offset;
+        e->pub.body_seal = hit.seal;
+        memcpy(e->pub.body_salt, hit.salt, sizeof(hit.salt));
+        hit.fd = -1;        /* The object's now */
+        o = &e->pub;
+    }
+    quicpro_cdn_disk_hit_free(&hit);
+    return o;
+}
+
+/*──────────────────────────── Lookup ─────────────────────────────────────*/
+
+/* Slice parts never clash with a request's: vary values start with '=' */
+static void qp_cdn_slice_key(quicpro_cdn_key_t *sk, const quicpro_cdn_key_t *k, size_t index)
+{
+    char part[24];
+    int n = snprintf(part, sizeof(part), "#%zu", index);
+    memcpy(sk->buf, k->buf, k->len);
+    sk->len = k->len;
+    sk->ok = k->ok;
+    qp_cdn_key_put(sk, part, (size_t)n);
+    quicpro_cdn_key_end(sk);
+}
+
+/* A slice of the object `version`, referenced, expired or not: it lives as long as its head */
+static quicpro_cdn_object_t *qp_cdn_lookup_slice(const quicpro_cdn_key_t *sk, uint64_t version, size_t body_len)
+{
+    if (!sk->ok) return NULL;
+    qp_cdn_shard_t *s = qp_cdn_shard_of(sk->hash);
+    quicpro_cdn_object_t *hit = NULL;
+    qp_cdn_lock(s);
+    qp_cdn_record(s, sk->hash);
+    qp_cdn_entry_t *e = qp_cdn_find(s, sk);
+    if (e && e->version == version && e->pub.body_len == body_len) {
+        qp_cdn_touch(s, e);
+        atomic_fetch_add_explicit(&e->pub.refs, 1, memory_order_relaxed);
+        hit = &e->pub;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return hit;
+}
+
+quicpro_cdn_object_t *quicpro_cdn_lookup(const quicpro_cdn_key_t *k)
+{
+    if (!quicpro_cdn_cache_enabled() || !k->ok) return NULL;
+    quicpro_cdn_object_t *hit = NULL;
+
+    if (qp_cdn_mem_on) {
+        qp_cdn_shard_t *s = qp_cdn_shard_of(k->hash);
+        qp_cdn_lock(s);
+        qp_cdn_record(s, k->hash);
+        qp_cdn_entry_t *e = qp_cdn_find(s, k);
+        if (e) {
+            if (qp_cdn_now_ms() < e->expires_ms) {
+                qp_cdn_touch(s, e);
+                atomic_fetch_add_explicit(&e->pub.refs, 1, memory_order_relaxed);
+                hit = &e->pub;
+            } else if (!quicpro_native_cdn_config.serve_stale_on_error) {
+                qp_cdn_drop(s, e);
+            }
+        }
+        pthread_mutex_unlock(&s->lock);
+    }
+    return hit ? hit : qp_cdn_from_disk(k, false);
+}
+
+quicpro_cdn_object_t *quicpro_cdn_lookup_stale(const quicpro_cdn_key_t *k)
+{
+    if (!quicpro_cdn_cache_enabled() || !k->ok || !quicpro_native_cdn_config.serve_stale_on_error) return NULL;
+    quicpro_cdn_object_t *hit = NULL;
+
+    if (qp_cdn_mem_on) {
+        qp_cdn_shard_t *s = qp_cdn_shard_of(k->hash);
+        qp_cdn_lock(s);
+        qp_cdn_entry_t *e = qp_cdn_find(s, k);
+        if (e) {
+            atomic_fetch_add_explicit(&e->pub.refs, 1, memory_order_relaxed);
+            hit = &e->pub;
+        }
+        pthread_mutex_unlock(&s->lock);
+    }
+    return hit ? hit : qp_cdn_from_disk(k, true);
+}
+
+quicpro_cdn_range_t quicpro_cdn_range_parse(const char *v, size_t len, uint64_t total, uint64_t *first, uint64_t *count)
+{
+    size_t n;
+    v = qp_cdn_trim(v, v + len, &n);
+    const char *p = v + 6, *end = v + n;
+    if (n < 7 || strncasecmp(v, "bytes=", 6) != 0 || memchr(v, ',', n)) {
+        return QUICPRO_CDN_RANGE_NONE;  /* Several ranges are not worth a multipart body */
+    }
+    uint64_t a = 0, b = 0;
+    bool has_a = false, has_b = false;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, has_a = true) {
+        if (a > (UINT64_MAX - 9) / 10) return QUICPRO_CDN_RANGE_NONE;
+        a = a * 10 + (uint64_t)(*p - '0');
+    }
+    if (p == end || *p++ != '-') return QUICPRO_CDN_RANGE_NONE;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, has_b = true) {
+        if (b > (UINT64_MAX - 9) / 10) return QUICPRO_CDN_RANGE_NONE;
+        b = b * 10 + (uint64_t)(*p - '0');
+    }
+    if (p != end || (!has_a && !has_b)) {
+        return QUICPRO_CDN_RANGE_NONE;
+    }
+    if (!has_a) {
+        /* The last b bytes */
+        if (b == 0 || total == 0) return QUICPRO_CDN_RANGE_UNSATISFIABLE;
+        *count = b < total ? b : total;
+        *first = total - *count;
+        return QUICPRO_CDN_RANGE_OK;
+    }
+    if (a >= total) return QUICPRO_CDN_RANGE_UNSATISFIABLE;
+    if (!has_b || b >= total) b = total - 1;
+    if (b < a) return QUICPRO_CDN_RANGE_NONE;
+    *first = a;
+    *count = b - a + 1;
+    return QUICPRO_CDN_RANGE_OK;
+}
+
+bool quicpro_cdn_body_open(quicpro_cdn_body_t *b, const quicpro_cdn_key_t *k, quicpro_cdn_object_t *o, uint64_t first, uint64_t len)
+{
+    memset(b, 0, sizeof(*b));
+    b->len = len;
+    if (!o->sliced) {
+        atomic_fetch_add_explicit(&o->refs, 1, memory_order_relaxed);
+        b->one = o;
+        b->slices = &b->one;
+        b->count = 1;
+        b->skip = (size_t)first;
+        b->slice_len = o->body_len ? o->body_len : 1;
+        return true;
+    }
+    if (len == 0) {
+        return true;
+    }
+    size_t from = (size_t)(first / qp_cdn_slice), to = (size_t)((first + len - 1) / qp_cdn_slice);
+    size_t count = to - from + 1;
+    b->slices = count == 1 ? &b->one : safe_emalloc(count, sizeof(*b->slices), 0);
+    b->skip = (size_t)(first - (uint64_t)from * qp_cdn_slice);
+    b->slice_len = qp_cdn_slice;
+    uint64_t version = ((const qp_cdn_entry_t *)o)->version;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t at = (uint64_t)(from + i) * qp_cdn_slice;
+        size_t part = o->body_len - at < qp_cdn_slice ? (size_t)(o->body_len - at) : qp_cdn_slice;
+        quicpro_cdn_key_t sk;
+        qp_cdn_slice_key(&sk, k, from + i);
+        if (!(b->slices[i] = qp_cdn_lookup_slice(&sk, version, part))) {
+            b->count = i;
+            quicpro_cdn_body_close(b);
+            return false;
+        }
+        b->count = i + 1;
+    }
+    return true;
+}
+
+void quicpro_cdn_body_piece(const quicpro_cdn_body_t *b, size_t i, const char **data, size_t *len)
+{
+    const quicpro_cdn_object_t *o = b->slices[i];
+    size_t start = i == 0 ? b->skip : 0;
+    uint64_t before = i == 0 ? 0 : (uint64_t)(b->slice_len - b->skip) + (uint64_t)(i - 1) * b->slice_len;
+    size_t n = o->body_len - start;
+    if (n > b->len - before) n = (size_t)(b->len - before);
+    *data = o->body + start;
+    *len = n;
+}
+
+size_t quicpro_cdn_body_read(const quicpro_cdn_body_t *b, uint64_t at, char *dst, size_t n)
+{
+    if (at >= b->len) return 0;
+    if (n > b->len - at) n = (size_t)(b->len - at);
+    uint64_t p = b->skip + at;
+    size_t i = (size_t)(p / b->slice_len), off = (size_t)(p % b->slice_len), copied = 0;
+    while (copied < n && i < b->count) {
+        const quicpro_cdn_object_t *o = b->slices[i++];
+        size_t take = o->body_len - off < n - copied ? o->body_len - off : n - copied;
+        memcpy(dst + copied, o->body + off, take);
+        copied += take;
+        off = 0;
+    }
+    return copied;
+}
+
+void quicpro_cdn_body_close(quicpro_cdn_body_t *b)
+{
+    for (size_t i = 0; i < b->count; i++) quicpro_cdn_release(b->slices[i]);
+    if (b->slices && b->slices != &b->one) efree(b->slices);
+    memset(b, 0, sizeof(*b));
+}
+
+int quicpro_cdn_body_file_open(quicpro_file_body_t *b, const quicpro_cdn_object_t *o, uint64_t first, uint64_t len)
+{
+    if (o->body_seal == QUICPRO_AT_REST_NONE) {
+        return quicpro_file_body_open_range(b, o->body_fd, (off_t)(o->body_offset + first), (off_t)len);
+    }
+    /* Offsets are the plaintext's; the reader finds the segments */
+    quicpro_at_rest_reader_t *r = quicpro_cdn_disk_unseal(o->body_seal, o->body_offset, o->body_len, o->body_salt);
+    if (!r || quicpro_file_body_open_range(b, o->body_fd, (off_t)first, (off_t)len) < 0) {
+        quicpro_at_rest_reader_free(r);
+        return -1;
+    }
+    b->sealed = r;
+    return 0;
+}
+
+void quicpro_cdn_release(quicpro_cdn_object_t *o)
+{
+    if (!o || atomic_fetch_sub_explicit(&o->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+    qp_cdn_entry_t *e = (qp_cdn_entry_t *)o;   /* The entry's first member: the block itself */
+    if (e->cls == QP_CDN_HEAP) {
+        if (o->body_fd >= 0) close(o->body_fd);
+        pefree(e, 1);
+        return;
+    }
+    qp_cdn_shard_t *s = &qp_cdn_arena->shards[e->shard];
+    qp_cdn_lock(s);
+    qp_cdn_block_give(s, e);
+    pthread_mutex_unlock(&s->lock);
+}
+
+/*──────────────────────────── Storing ────────────────────────────────────*/
+
+typedef struct {
+    size_t   lines;
+    size_t   text;              /* Names and values, without separators */
+    uint64_t ttl_ms;
+    bool     has_ttl;
+    bool     refuse;
+} qp_cdn_scan_t;
+
+typedef void (*qp_cdn_header_fn)(void *ctx, const char *name, size_t nlen, const char *value, size_t vlen);
+
+static void qp_cdn_each_header(const quicpro_header_template_t *tmpl, HashTable *headers, qp_cdn_header_fn fn, void *ctx)
+{
+    if (tmpl) {
+        for (size_t i = 0; i < tmpl->count; i++) {
+            fn(ctx, (const char *)tmpl->nv[i].name, tmpl->nv[i].namelen, (const char *)tmpl->nv[i].value, tmpl->nv[i].valuelen);
+        }
+    }
+    if (!headers) return;
+    zend_string *name;
+    zval *entry, *v;
+    ZEND_HASH_FOREACH_STR_KEY_VAL(headers, name, entry) {
+        if (!name) continue;
+        if (Z_TYPE_P(entry) == IS_ARRAY) {
+            ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(entry), v) {
+                zend_string *tmp;
+                zend_string *s = zval_get_tmp_string(v, &tmp);
+                fn(ctx, ZSTR_VAL(name), ZSTR_LEN(name), ZSTR_VAL(s), ZSTR_LEN(s));
+                zend_tmp_string_release(tmp);
+            } ZEND_HASH_FOREACH_END();
+        } else {
+            zend_string *tmp;
+            zend_string *s = zval_get_tmp_string(entry, &tmp);
+            fn(ctx, ZSTR_VAL(name), ZSTR_LEN(name), ZSTR_VAL(s), ZSTR_LEN(s));
+            zend_tmp_string_release(tmp);
+        }
+    } ZEND_HASH_FOREACH_END();
+}
+
+static bool qp_cdn_name_is(const char *name, size_t nlen, const char *lit, size_t llen)
+{
+    return nlen == llen && strncasecmp(name, lit, llen) == 0;
+}
+
+static bool qp_cdn_is_varied(const char *name, size_t len)
+{
+    for (size_t i = 0; i < qp_cdn_vary_n; i++) {
+        if (qp_cdn_name_is(name, len, qp_cdn_vary[i].name, qp_cdn_vary[i].len)) return true;
+    }
+    /* Keys end with the negotiated coding while compression is on */
+    return qp_cdn_name_is(name, len, "accept-encoding", 15) && quicpro_compress_enabled();
+}
+
+static void qp_cdn_scan_cache_control(qp_cdn_scan_t *scan, const char *v, size_t vlen)
+{
+    const char *end = v + vlen;
+    bool shared = false;
+    while (v < end) {
+        const char *comma = memchr(v, ',', (size_t)(end - v));
+        const char *stop = comma ? comma : end;
+        size_t len;
+        const char *d = qp_cdn_trim(v, stop, &len);
+        if (qp_cdn_name_is(d, len, "no-store", 8) || qp_cdn_name_is(d, len, "no-cache", 8)
+            || qp_cdn_name_is(d, len, "private", 7)) {
+            scan->refuse = true;
+        } else if ((len > 9 && strncasecmp(d, "s-maxage=", 9) == 0)
+                   || (!shared && len > 8 && strncasecmp(d, "max-age=", 8) == 0)) {
+            bool is_shared = d[0] == 's' || d[0] == 'S';
+            const char *num = memchr(d, '=', len) + 1;
+            uint64_t sec = 0;
+            while (num < d + len && *num >= '0' && *num <= '9') sec = sec * 10 + (uint64_t)(*num++ - '0');
+            scan->ttl_ms = sec * 1000;
+            scan->has_ttl = true;
+            shared = shared || is_shared;   /* s-maxage wins over max-age in any order */
+        }
+        v = stop + 1;
+    }
+}
+
+static void qp_cdn_scan_vary(qp_cdn_scan_t *scan, const char *v, size_t vlen)
+{
+    const char *end = v + vlen;
+    while (v < end) {
+        const char *comma = memchr(v, ',', (size_t)(end - v));
+        const char *stop = comma ? comma : end;
+        size_t len;
+        const char *name = qp_cdn_trim(v, stop, &len);
+        if (len && !qp_cdn_is_varied(name, len)) scan->refuse = true;   /* Includes "*" */
+        v = stop + 1;
+    }
+}
+
+static void qp_cdn_scan_header(void *ctx, const char *name, size_t nlen, const char *value, size_t vlen)
+{
+    qp_cdn_scan_t *scan = ctx;
+    if (!quicpro_header_is_sendable(name, nlen, value, vlen)) return;
+    if (qp_cdn_name_is(name, nlen, "set-cookie", 10)) {
+        scan->refuse = true;
+    } else if (qp_cdn_name_is(name, nlen, "cache-control", 13)) {
+        if (quicpro_native_cdn_config.cache_respect_origin_headers) qp_cdn_scan_cache_control(scan, value, vlen);
+    } else if (qp_cdn_name_is(name, nlen, "vary", 4)) {
+        qp_cdn_scan_vary(scan, value, vlen);
+    }
+    scan->lines++;
+    scan->text += nlen + vlen;
+}
+
+/* Header lines rendered into a buffer a scan sized */
+typedef struct {
+    char   *out;
+    size_t  len;
+} qp_cdn_fill_t;
+
+static void qp_cdn_fill_line(qp_cdn_fill_t *f, const char *name, size_t nlen, const char *value, size_t vlen)
+{
+    char *at = f->out + f->len;
+    for (size_t i = 0; i < nlen; i++) at[i] = (char)tolower((unsigned char)name[i]);
+    memcpy(at + nlen, ": ", 2);
+    memcpy(at + nlen + 2, value, vlen);
+    memcpy(at + nlen + 2 + vlen, "\r\n", 2);
+    f->len += nlen + vlen + 4;
+}
+
+static void qp_cdn_fill_header(void *ctx, const char *name, size_t nlen, const char *value, size_t vlen)
+{
+    if (quicpro_header_is_sendable(name, nlen, value, vlen)) qp_cdn_fill_line(ctx, name, nlen, value, vlen);
+}
+
+static bool qp_cdn_status_cacheable(long status)
+{
+    return status == 200 || status == 203 || status == 301 || status == 404 || status == 410;
+}
+
+/* The slices first: a listed head promises they were all offered */
+static void qp_cdn_store_sliced(const quicpro_cdn_key_t *k, uint16_t status, const char *h1, size_t h1_len,
+                                const char *body, size_t body_len, uint64_t expires_ms)
+{
+    uint64_t version = atomic_fetch_add_explicit(&qp_cdn_arena->versions, 1, memory_order_relaxed) + 1;
+    for (size_t i = 0, at = 0; at < body_len; i++, at += qp_cdn_slice) {
+        quicpro_cdn_key_t sk;
+        qp_cdn_slice_key(&sk, k, i);
+        size_t part = body_len - at < qp_cdn_slice ? body_len - at : qp_cdn_slice;
+        qp_cdn_entry_t *e = sk.ok ? qp_cdn_entry_new(&sk, 200, "", 0, body + at, part, true) : NULL;
+        if (!e) {
+            return;
+        }
+        e->expires_ms = expires_ms;
+        e->version = version;
+        qp_cdn_insert(e);
+    }
+    qp_cdn_entry_t *head = qp_cdn_entry_new(k, status, h1, h1_len, NULL, body_len, false);
+    if (head) {
+        head->pub.sliced = true;
+        head->expires_ms = expires_ms;
+        head->version = version;
+        qp_cdn_insert(head);
+    }
+}
+
+/* The scan of a response's headers; its lifetime, or 0 if it is not kept */
+static uint64_t qp_cdn_scan_response(qp_cdn_scan_t *scan, long status, const quicpro_header_template_t *tmpl, HashTable *headers)
+{
+    if (!qp_cdn_status_cacheable(status)) {
+        return 0;
+    }
+    qp_cdn_each_header(tmpl, headers, qp_cdn_scan_header, scan);
+    uint64_t ttl_ms = scan->has_ttl ? scan->ttl_ms : qp_cdn_default_ttl_ms;
+    return scan->refuse ? 0 : ttl_ms;
+}
+
+bool quicpro_cdn_storable(long status, const quicpro_header_template_t *tmpl, HashTable *headers)
+{
+    qp_cdn_scan_t scan = { 0 };
+    return quicpro_cdn_cache_enabled() && qp_cdn_scan_response(&scan, status, tmpl, headers) > 0;
+}
+
+void quicpro_cdn_store(const quicpro_cdn_key_t *k, long status, const quicpro_header_template_t *tmpl,
+                       HashTable *headers, quicpro_coding_t coding, bool vary_coding,
+                       const char *body, size_t body_len)
+{
+    if (!quicpro_cdn_cache_enabled() || !k->ok || !qp_cdn_status_cacheable(status)) {
+        return;
+    }
+    bool to_memory = qp_cdn_mem_on && body_len <= qp_cdn_max_object;
+    bool sliced = qp_cdn_mem_on && !to_memory && qp_cdn_slice > 0;
+    bool to_disk = qp_cdn_disk_on && body_len <= quicpro_cdn_disk_max_object();
+    if (!to_memory && !sliced && !to_disk) {
+        return;
+    }
+
+    qp_cdn_scan_t scan = { 0 };
+    uint64_t ttl_ms = qp_cdn_scan_response(&scan, status, tmpl, headers);
+    if (ttl_ms == 0) {
+        return;
+    }
+    for (size_t i = 0; i < qp_cdn_hit_n; i++) {
+        scan.lines++;
+        scan.text += qp_cdn_hit_nv[i].namelen + qp_cdn_hit_nv[i].valuelen;
+    }
+    size_t coding_len;
+    const char *coding_name = quicpro_coding_name(coding, &coding_len);
+    if (coding_name) {
+        scan.lines++;
+        scan.text += sizeof("content-encoding") - 1 + coding_len;
+    }
+    if (vary_coding) {
+        scan.lines++;
+        scan.text += sizeof("vary") - 1 + sizeof("accept-encoding") - 1;
+    }
+    size_t h1_cap = scan.text + scan.lines * 4;
+    if (h1_cap > 65536) {
+        return;             /* Headers out of all proportion */
+    }
+
+    qp_cdn_fill_t fill = { emalloc(h1_cap + 1), 0 };
+    qp_cdn_each_header(tmpl, headers, qp_cdn_fill_header, &fill);
+    for (size_t i = 0; i < qp_cdn_hit_n; i++) {
+        qp_cdn_fill_line(&fill, (const char *)qp_cdn_hit_nv[i].name, qp_cdn_hit_nv[i].namelen,
+                         (const char *)qp_cdn_hit_nv[i].value, qp_cdn_hit_nv[i].valuelen);
+    }
+    if (coding_name) {
+        qp_cdn_fill_line(&fill, "content-encoding", sizeof("content-encoding") - 1, coding_name, coding_len);
+    }
+    if (vary_coding) {
+        qp_cdn_fill_line(&fill, "vary", sizeof("vary") - 1, "accept-encoding", sizeof("accept-encoding") - 1);
+    }
+    qp_cdn_entry_t *e;
+    if (to_memory && (e = qp_cdn_entry_new(k, (uint16_t)status, fill.out, fill.len, body, body_len, true))) {
+        e->expires_ms = qp_cdn_now_ms() + ttl_ms;
+        qp_cdn_insert(e);
+    } else if (sliced) {
+        qp_cdn_store_sliced(k, (uint16_t)status, fill.out, fill.len, body, body_len, qp_cdn_now_ms() + ttl_ms);
+    }
+    if (to_disk) {
+        quicpro_cdn_disk_store(k->buf, k->len, k->hash, (uint16_t)status, fill.out, fill.len, body, body_len, qp_cdn_wall_ms() + ttl_ms);
+    }
+    efree(fill.out);
+}
+
+/*──────────────────────────── Flights ────────────────────────────────────*/
+
+/* A handful are in the air at once: a scan is as quick as a probe */
+static qp_cdn_flight_t *qp_cdn_flight_find(uint64_t hash)
+{
+    qp_cdn_flight_t *flights = qp_cdn_arena->flights;
+    for (size_t i = 0; i < QP_CDN_FLIGHTS; i++) {
+        if (flights[i].hash == hash) return &flights[i];
+    }
+    return NULL;
+}
+
+static bool qp_cdn_flight_live(const qp_cdn_flight_t *f, uint64_t now)
+{
+    return now - f->started_ms < (uint64_t)quicpro_native_cdn_config.origin_request_timeout_ms;
+}
+
+bool quicpro_cdn_flight_begin(const quicpro_cdn_key_t *k)
+{
+    uint64_t hash = k->hash ? k->hash : 1, now = qp_cdn_now_ms();
+    bool leader = true;
+    qp_cdn_mutex_lock(&qp_cdn_arena->flight_lock);
+    qp_cdn_flight_t *f = qp_cdn_flight_find(hash);
+    if (f && qp_cdn_flight_live(f, now)) {
+        leader = false;
+    } else if (f || (f = qp_cdn_flight_find(0))) {
+        /* A new flight, or one whose leader is overdue; with no room, nobody waits */
+        f->hash = hash;
+        f->started_ms = now;
+    }
+    pthread_mutex_unlock(&qp_cdn_arena->flight_lock);
+    return leader;
+}
+
+void quicpro_cdn_flight_end(const quicpro_cdn_key_t *k)
+{
+    qp_cdn_mutex_lock(&qp_cdn_arena->flight_lock);
+    qp_cdn_flight_t *f = qp_cdn_flight_find(k->hash ? k->hash : 1);
+    if (f) f->hash = 0;
+    pthread_mutex_unlock(&qp_cdn_arena->flight_lock);
+}
+
+bool quicpro_cdn_flight_pending(const quicpro_cdn_key_t *k)
+{
+    qp_cdn_mutex_lock(&qp_cdn_arena->flight_lock);
+    qp_cdn_flight_t *f = qp_cdn_flight_find(k->hash ? k->hash : 1);
+    bool pending = f && qp_cdn_flight_live(f, qp_cdn_now_ms());
+    pthread_mutex_unlock(&qp_cdn_arena->flight_lock);
+    return pending;
+}
+
+void quicpro_cdn_cache_mshutdown(void)
+{
+    if (qp_cdn_on) {
+        for (size_t i = 0; i < qp_cdn_vary_n; i++) pefree(qp_cdn_vary[i].name, 1);
+        if (qp_cdn_hit_text) pefree(qp_cdn_hit_text, 1);
+        if (qp_cdn_disk_on) quicpro_cdn_disk_close();
+        qp_cdn_on = qp_cdn_mem_on = qp_cdn_disk_on = false;
+    }
+    /* Listed objects go with the arena; private ones went with their listeners */
+    quicpro_cdn_cache_release();
+}
@@ -0,0 +1,468 @@
+/*
+ * src/server/cdn_disk.c – Disk tier of the native CDN cache
+ * =========================================================
+ *
+ * See include/server/cdn_disk.h. One mutex guards the index and the
+ * append position; reads of a record's head and body happen outside it,
+ * on a descriptor of their own. A sealed body is encrypted before the
+ * mutex is taken.
+ */
+
+#include <php.h>
+
+#include "server/cdn_disk.h"
+
+#include <openssl/rand.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define QP_DISK_MAGIC           0x3158445043505151ULL   /* "QQPCDX1" */
+#define QP_DISK_VERSION         2       /* 2: records carry a seal */
+#define QP_DISK_RECORD_MAGIC    0x52444351u             /* "QCDR" */
+#define QP_DISK_SEGMENT_BYTES   (256ULL << 20)
+#define QP_DISK_ALIGN           4096ULL
+#define QP_DISK_SHARDS_MAX      64
+#define QP_DISK_PROBE           32
+#define QP_DISK_SLOTS_MIN       (1u << 16)
+#define QP_DISK_SLOTS_MAX       (1u << 24)
+#define QP_DISK_AVG_OBJECT      (64ULL << 10)   /* Sizes the index against the space */
+#define QP_DISK_RECORD_SEALED   0x1                     /* Record flags: the body is encrypted, */
+#define QP_DISK_RECORD_CHACHA   0x2                     /* with ChaCha20-Poly1305 rather than AES-GCM */
+
+enum { QP_DISK_SLOT_FREE, QP_DISK_SLOT_LIVE, QP_DISK_SLOT_DEAD };
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t slot_count;            /* A power of two */
+    uint32_t segments_max;
+    uint32_t segment_first;         /* Oldest live segment */
+    uint32_t segment_next;          /* Being appended to */
+    uint32_t reserved;
+    uint64_t write_offset;          /* In segment_next */
+    uint8_t  pad[24];
+} qp_disk_header_t;
+
+typedef struct {
+    uint64_t hash;
+    uint64_t offset;                /* Of the record in its segment */
+    uint64_t body_len;
+    uint64_t expires_ms;
+    uint32_t segment;
+    uint32_t head_len;              /* Record header, key and lines */
+    uint16_t status;
+    uint8_t  state;                 /* QP_DISK_SLOT_* */
+    uint8_t  pad[5];
+} qp_disk_slot_t;
+
+/* Starts every record; the key and the lines follow */
+typedef struct {
+    uint32_t magic;
+    uint32_t key_len;
+    uint32_t h1_len;
+    uint16_t status;
+    uint16_t flags;                 /* QP_DISK_RECORD_* */
+    uint64_t hash;
+    uint64_t body_len;              /* Plaintext bytes */
+    uint64_t expires_ms;
+    uint8_t  salt[QUICPRO_AT_REST_SALT_LEN];   /* Of the record's key when sealed */
+} qp_disk_record_t;
+
+static pthread_mutex_t   qp_disk_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool              qp_disk_on = false;
+static bool              qp_disk_seal = false;    /* Bodies are written encrypted */
+static char              qp_disk_dir[4096];
+static int               qp_disk_index_fd = -1;
+static qp_disk_header_t *qp_disk_hdr = NULL;
+static qp_disk_slot_t   *qp_disk_slots = NULL;
+static size_t            qp_disk_map_len = 0;
+static int              *qp_disk_seg_fd = NULL;  /* By segment id modulo segments_max */
+static uint8_t           qp_disk_zeros[QP_DISK_ALIGN];
+
+static uint64_t qp_disk_align(uint64_t n)
+{
+    return (n + QP_DISK_ALIGN - 1) & ~(QP_DISK_ALIGN - 1);
+}
+
+static void qp_disk_segment_path(char *out, size_t len, uint32_t id)
+{
+    snprintf(out, len, "%s/seg-%08x.dat", qp_disk_dir, id);
+}
+
+/* The descriptor of a live segment, opened on first use */
+static int qp_disk_segment_fd(uint32_t id, bool create)
+{
+    int *slot = &qp_disk_seg_fd[id % qp_disk_hdr->segments_max];
+    if (*slot < 0) {
+        char path[sizeof(qp_disk_dir) + 32];
+        qp_disk_segment_path(path, sizeof(path), id);
+        *slot = open(path, O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_TRUNC : 0), 0600);
+    }
+    return *slot;
+}
+
+/* Deletes the oldest segment and forgets the objects that were in it */
+static void qp_disk_retire_oldest(void)
+{
+    uint32_t id = qp_disk_hdr->segment_first++;
+    for (uint32_t i = 0; i < qp_disk_hdr->slot_count; i++) {
+        if (qp_disk_slots[i].state == QP_DISK_SLOT_LIVE && qp_disk_slots[i].segment == id) {
+            qp_disk_slots[i].state = QP_DISK_SLOT_DEAD;
+        }
+    }
+    int *fd = &qp_disk_seg_fd[id % qp_disk_hdr->segments_max];
+    if (*fd >= 0) close(*fd);
+    *fd = -1;
+    char path[sizeof(qp_disk_dir) + 32];
+    qp_disk_segment_path(path, sizeof(path), id);
+    unlink(path);
+}
+
+/*──────────────────────────── Opening ────────────────────────────────────*/
+
+/* Takes the first index no other process holds; returns its descriptor */
+static int qp_disk_claim_shard(const char *dir)
+{
+    if (mkdir(dir, 0700) < 0 && errno != EEXIST) {
+        return -1;
+    }
+    for (int i = 0; i < QP_DISK_SHARDS_MAX; i++) {
+        snprintf(qp_disk_dir, sizeof(qp_disk_dir), "%s/shard-%02d", dir, i);
+        if (mkdir(qp_disk_dir, 0700) < 0 && errno != EEXIST) {
+            return -1;
+        }
+        char path[sizeof(qp_disk_dir) + 16];
+        snprintf(path, sizeof(path), "%s/index", qp_disk_dir);
+        int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            return -1;
+        }
+        if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
+            return fd;
+        }
+        close(fd);
+    }
+    errno = EBUSY;
+    return -1;
+}
+
+static uint32_t qp_disk_pow2_at_least(uint64_t n)
+{
+    uint32_t p = 1;
+    while (p < n && p < QP_DISK_SLOTS_MAX) p <<= 1;
+    return p;
+}
+
+bool quicpro_cdn_disk_open(const char *dir)
+{
+    if (qp_disk_on) {
+        return true;
+    }
+    if (!dir || !*dir) {
+        return false;
+    }
+    qp_disk_seal = quicpro_at_rest_wanted();
+    if (qp_disk_seal && !quicpro_at_rest_ready()) {
+        php_error_docref(NULL, E_WARNING, "CDN disk cache under %s stays off: storage encryption has no usable key", dir);
+        return false;
+    }
+    int fd = qp_disk_claim_shard(dir);
+    if (fd < 0) {
+        php_error_docref(NULL, E_WARNING, "CDN disk cache under %s is unavailable: %s", dir, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    qp_disk_header_t hdr;
+    bool warm = fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(hdr)
+        && pread(fd, &hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr)
+        && hdr.magic == QP_DISK_MAGIC && hdr.version == QP_DISK_VERSION
+        && hdr.slot_count >= QP_DISK_SLOTS_MIN && hdr.segments_max >= 2
+        && (size_t)st.st_size == sizeof(hdr) + (size_t)hdr.slot_count * sizeof(qp_disk_slot_t);
+    if (!warm) {
+        /* Sized once, from the space there is now: 90% of it, at least two segments */
+        struct statvfs vfs;
+        uint64_t space = statvfs(qp_disk_dir, &vfs) == 0 ? (uint64_t)vfs.f_bavail * vfs.f_frsize / 10 * 9 : 0;
+        uint64_t segments = space / QP_DISK_SEGMENT_BYTES;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.magic = QP_DISK_MAGIC;
+        hdr.version = QP_DISK_VERSION;
+        hdr.segments_max = segments < 2 ? 2 : segments > 65536 ? 65536 : (uint32_t)segments;
+        hdr.slot_count = qp_disk_pow2_at_least((uint64_t)hdr.segments_max * QP_DISK_SEGMENT_BYTES / QP_DISK_AVG_OBJECT * 2);
+        if (hdr.slot_count < QP_DISK_SLOTS_MIN) hdr.slot_count = QP_DISK_SLOTS_MIN;
+        if (ftruncate(fd, 0) < 0
+            || ftruncate(fd, (off_t)(sizeof(hdr) + (size_t)hdr.slot_count * sizeof(qp_disk_slot_t))) < 0) {
+            php_error_docref(NULL, E_WARNING, "CDN disk cache index in %s cannot be sized: %s", qp_disk_dir, strerror(errno));
+            close(fd);
+            return false;
+        }
+    }
+
+    qp_disk_map_len = sizeof(hdr) + (size_t)hdr.slot_count * sizeof(qp_disk_slot_t);
+    void *map = mmap(NULL, qp_disk_map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        php_error_docref(NULL, E_WARNING, "CDN disk cache index in %s cannot be mapped: %s", qp_disk_dir, strerror(errno));
+        close(fd);
+        return false;
+    }
+    qp_disk_index_fd = fd;
+    qp_disk_hdr = map;
+    qp_disk_slots = (qp_disk_slot_t *)((char *)map + sizeof(hdr));
+    if (!warm) {
+        /* A fresh table; segment files left from an older one are overwritten as ids come round */
+        *qp_disk_hdr = hdr;
+    }
+    qp_disk_seg_fd = pemalloc(sizeof(int) * qp_disk_hdr->segments_max, 1);
+    for (uint32_t i = 0; i < qp_disk_hdr->segments_max; i++) qp_disk_seg_fd[i] = -1;
+    if (qp_disk_segment_fd(qp_disk_hdr->segment_next, !warm) < 0) {
+        php_error_docref(NULL, E_WARNING, "CDN disk cache segment in %s cannot be opened: %s", qp_disk_dir, strerror(errno));
+        quicpro_cdn_disk_close();
+        return false;
+    }
+    qp_disk_on = true;
+    return true;
+}
+
+uint64_t quicpro_cdn_disk_max_object(void)
+{
+    return QP_DISK_SEGMENT_BYTES - QP_DISK_ALIGN * 16;
+}
+
+/*──────────────────────────── Index ──────────────────────────────────────*/
+
+/* The key's live slot, or NULL; `free_at` receives where to put it (NULL if the run is full) */
+static qp_disk_slot_t *qp_disk_probe(uint64_t hash, uint32_t key_len, qp_disk_slot_t **free_at)
+{
+    uint32_t mask = qp_disk_hdr->slot_count - 1;
+    qp_disk_slot_t *first_free = NULL;
+    for (uint32_t i = 0; i < QP_DISK_PROBE; i++) {
+        qp_disk_slot_t *s = &qp_disk_slots[(hash + i) & mask];
+        if (s->state == QP_DISK_SLOT_LIVE) {
+            if (s->hash == hash && s->head_len >= sizeof(qp_disk_record_t) + key_len) return s;
+        } else {
+            if (!first_free) first_free = s;
+            if (s->state == QP_DISK_SLOT_FREE) break;     /* The run ends here */
+        }
+    }
+    if (free_at) *free_at = first_free;
+    return NULL;
+}
+
+/* When the run is full: its slot that expires first */
+static qp_disk_slot_t *qp_disk_victim(uint64_t hash)
+{
+    uint32_t mask = qp_disk_hdr->slot_count - 1;
+    qp_disk_slot_t *victim = &qp_disk_slots[hash & mask];
+    for (uint32_t i = 1; i < QP_DISK_PROBE; i++) {
+        qp_disk_slot_t *s = &qp_disk_slots[(hash + i) & mask];
+        if (s->expires_ms < victim->expires_ms) victim = s;
+    }
+    return victim;
+}
+
+static uint64_t qp_disk_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/*──────────────────────────── Lookup and store ───────────────────────────*/
+
+bool quicpro_cdn_disk_lookup(const char *key, size_t key_len, uint64_t hash, bool allow_stale, quicpro_cdn_disk_hit_t *hit)
+{
+    if (!qp_disk_on) {
+        return false;
+    }
+    pthread_mutex_lock(&qp_disk_lock);
+    qp_disk_slot_t *s = qp_disk_probe(hash, (uint32_t)key_len, NULL);
+    qp_disk_slot_t slot;
+    int fd = -1;
+    if (s && (allow_stale || qp_disk_now_ms() < s->expires_ms)) {
+        slot = *s;
+        int seg = qp_disk_segment_fd(slot.segment, false);
+        fd = seg >= 0 ? dup(seg) : -1;      /* Outlives the segment's retirement */
+    }
+    pthread_mutex_unlock(&qp_disk_lock);
+    if (fd < 0) {
+        return false;
+    }
+
+    char *head = pemalloc(slot.head_len, 1);
+    const qp_disk_record_t *rec = (const qp_disk_record_t *)head;
+    if (pread(fd, head, slot.head_len, (off_t)slot.offset) != (ssize_t)slot.head_len
+        || rec->magic != QP_DISK_RECORD_MAGIC || rec->hash != hash || rec->key_len != key_len
+        || sizeof(*rec) + rec->key_len + rec->h1_len != slot.head_len
+        || memcmp(head + sizeof(*rec), key, key_len) != 0) {
+        /* Another key with the same hash, or a record a crash left unwritten */
+        pefree(head, 1);
+        close(fd);
+        return false;
+    }
+    hit->status = rec->status;
+    hit->expires_ms = rec->expires_ms;
+    hit->head = head;
+    hit->h1 = head + sizeof(*rec) + rec->key_len;
+    hit->h1_len = rec->h1_len;
+    hit->fd = fd;
+    hit->body_offset = slot.offset + qp_disk_align(slot.head_len);
+    hit->body_len = rec->body_len;
+    hit->seal = !(rec->flags & QP_DISK_RECORD_SEALED) ? QUICPRO_AT_REST_NONE
+              : rec->flags & QP_DISK_RECORD_CHACHA ? QUICPRO_AT_REST_CHACHA20_POLY1305 : QUICPRO_AT_REST_AES_256_GCM;
+    memcpy(hit->salt, rec->salt, sizeof(hit->salt));
+    if (hit->seal != QUICPRO_AT_REST_NONE && !quicpro_at_rest_ready()) {
+        /* Sealed under a key this process does not have: a miss */
+        pefree(head, 1);
+        close(fd);
+        return false;
+    }
+    return true;
+}
+
+static bool qp_disk_record_key(quicpro_at_rest_key_t *key, quicpro_at_rest_alg_t seal, const uint8_t *salt)
+{
+    return quicpro_at_rest_derive(key, seal, "quicpro cdn record", salt, QUICPRO_AT_REST_SALT_LEN);
+}
+
+quicpro_at_rest_reader_t *quicpro_cdn_disk_unseal(quicpro_at_rest_alg_t seal, uint64_t body_offset, uint64_t body_len,
+                                                 const uint8_t *salt)
+{
+    quicpro_at_rest_key_t key;
+    if (!qp_disk_record_key(&key, seal, salt)) {
+        return NULL;
+    }
+    return quicpro_at_rest_reader_new(&key, body_offset, body_len);
+}
+
+bool quicpro_cdn_disk_read_body(const quicpro_cdn_disk_hit_t *hit, char *out)
+{
+    if (hit->seal == QUICPRO_AT_REST_NONE) {
+        return pread(hit->fd, out, (size_t)hit->body_len, (off_t)hit->body_offset) == (ssize_t)hit->body_len;
+    }
+    quicpro_at_rest_reader_t *r = quicpro_cdn_disk_unseal(hit->seal, hit->body_offset, hit->body_len, hit->salt);
+    if (!r) {
+        return false;
+    }
+    uint64_t done = 0;
+    while (done < hit->body_len) {
+        ssize_t n = quicpro_at_rest_reader_pread(r, hit->fd, out + done, (size_t)(hit->body_len - done), done);
+        if (n <= 0) {
+            break;
+        }
+        done += (uint64_t)n;
+    }
+    quicpro_at_rest_reader_free(r);
+    return done == hit->body_len;
+}
+
+void quicpro_cdn_disk_hit_free(quicpro_cdn_disk_hit_t *hit)
+{
+    if (hit->head) pefree(hit->head, 1);
+    if (hit->fd >= 0) close(hit->fd);
+    hit->head = NULL;
+    hit->fd = -1;
+}
+
+void quicpro_cdn_disk_store(const char *key, size_t key_len, uint64_t hash, uint16_t status,
+                            const char *h1, size_t h1_len, const char *body, size_t body_len, uint64_t expires_ms)
+{
+    if (!qp_disk_on || body_len > quicpro_cdn_disk_max_object()) {
+        return;
+    }
+    qp_disk_record_t rec = {
+        .magic = QP_DISK_RECORD_MAGIC, .key_len = (uint32_t)key_len, .h1_len = (uint32_t)h1_len,
+        .status = status, .hash = hash, .body_len = body_len, .expires_ms = expires_ms
+    };
+    uint64_t head_len = sizeof(rec) + key_len + h1_len;
+    uint64_t stored_len = qp_disk_seal ? quicpro_at_rest_sealed_len(body_len) : body_len;
+    uint64_t total = qp_disk_align(head_len) + qp_disk_align(stored_len);
+    if (total > QP_DISK_SEGMENT_BYTES) {
+        return;
+    }
+
+    uint8_t *sealed = NULL;
+    if (qp_disk_seal) {
+        quicpro_at_rest_alg_t seal = quicpro_at_rest_alg();
+        quicpro_at_rest_key_t k;
+        bool ok = RAND_bytes(rec.salt, sizeof(rec.salt)) == 1 && qp_disk_record_key(&k, seal, rec.salt);
+        if (ok) {
+            sealed = pemalloc((size_t)MAX(stored_len, 1), 1);
+            ok = quicpro_at_rest_seal_segments(&k, (const uint8_t *)body, body_len, sealed);
+            quicpro_at_rest_key_clear(&k);
+        }
+        if (!ok) {
+            if (sealed) pefree(sealed, 1);
+            return;         /* Never in the clear */
+        }
+        rec.flags |= QP_DISK_RECORD_SEALED | (seal == QUICPRO_AT_REST_CHACHA20_POLY1305 ? QP_DISK_RECORD_CHACHA : 0);
+        body = (const char *)sealed;
+    }
+
+    pthread_mutex_lock(&qp_disk_lock);
+    if (qp_disk_hdr->write_offset + total > QP_DISK_SEGMENT_BYTES) {
+        qp_disk_hdr->segment_next++;
+        qp_disk_hdr->write_offset = 0;
+        while (qp_disk_hdr->segment_next - qp_disk_hdr->segment_first >= qp_disk_hdr->segments_max) {
+            qp_disk_retire_oldest();
+        }
+    }
+    int fd = qp_disk_segment_fd(qp_disk_hdr->segment_next, qp_disk_hdr->write_offset == 0);
+    uint64_t offset = qp_disk_hdr->write_offset;
+    struct iovec iov[5] = {
+        { &rec, sizeof(rec) },
+        { (void *)key, key_len },
+        { (void *)h1, h1_len },
+        { qp_disk_zeros, qp_disk_align(head_len) - head_len },
+        { (void *)body, stored_len },
+    };
+    bool written = fd >= 0 && pwritev(fd, iov, 5, (off_t)offset) == (ssize_t)(qp_disk_align(head_len) + stored_len);
+    if (written) {
+        /* Only now is the record there to point at */
+        qp_disk_hdr->write_offset = offset + total;
+        qp_disk_slot_t *free_at = NULL;
+        qp_disk_slot_t *s = qp_disk_probe(hash, (uint32_t)key_len, &free_at);
+        if (!s) s = free_at ? free_at : qp_disk_victim(hash);
+        *s = (qp_disk_slot_t){
+            .hash = hash, .offset = offset, .body_len = body_len, .expires_ms = expires_ms,
+            .segment = qp_disk_hdr->segment_next, .head_len = (uint32_t)head_len, .status = status,
+            .state = QP_DISK_SLOT_LIVE
+        };
+    }
+    pthread_mutex_unlock(&qp_disk_lock);
+    if (sealed) {
+        pefree(sealed, 1);
+    }
+}
+
+void quicpro_cdn_disk_close(void)
+{
+    if (qp_disk_seg_fd) {
+        for (uint32_t i = 0; i < qp_disk_hdr->segments_max; i++) {
+            if (qp_disk_seg_fd[i] >= 0) close(qp_disk_seg_fd[i]);
+        }
+        pefree(qp_disk_seg_fd, 1);
+        qp_disk_seg_fd = NULL;
+    }
+    if (qp_disk_hdr) {
+        msync(qp_disk_hdr, qp_disk_map_len, MS_SYNC);     /* For the next start, warm */
+        munmap(qp_disk_hdr, qp_disk_map_len);
+        qp_disk_hdr = NULL;
+        qp_disk_slots = NULL;
+    }
+    if (qp_disk_index_fd >= 0) {
+        close(qp_disk_index_fd);                            /* Releases the flock */
+        qp_disk_index_fd = -1;
+    }
+    qp_disk_on = false;
+}
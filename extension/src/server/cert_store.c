@@ -0,0 +1,361 @@
+/*
+ * cert_store.c  –  SNI-keyed certificate store for php-quicpro listeners
+ * ----------------------------------------------------------------------
+ *
+ * See include/server/cert_store.h. One table per process, chained by
+ * hash and threaded on an LRU list, under one mutex. Files are read and
+ * parsed outside the lock; two handshakes racing for the same new host
+ * may both parse it, and the second result is dropped.
+ *
+ * Handing a certificate to an SSL only takes references on the parsed
+ * chain and key, so it happens under the lock: an entry evicted later
+ * leaves the connections that use it untouched.
+ */
+
+#include "php_quicpro.h"
+#include "server/cert_store.h"
+#include "config/tls_and_crypto/base_layer.h"
+
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#include <limits.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define QP_CERT_BUCKETS     8192    /* Power of two */
+#define QP_CERT_RECHECK_SEC 60      /* How long an entry trusts its files */
+#define QP_CERT_NAME_MAX    253
+
+typedef struct qp_cert_entry_s {
+    char           *key;            /* Host name, or "@<cert>|<key>" for a listener's files */
+    uint32_t        hash;
+    X509           *leaf;           /* NULL: the host has no certificate */
+    STACK_OF(X509) *chain;
+    EVP_PKEY       *pkey;
+    time_t          mtime;          /* Of the certificate file; 0 when it is missing */
+    ino_t           ino;            /* Changes when a renewal replaces the file or its symlink */
+    time_t          checked;
+    struct qp_cert_entry_s *next;   /* In its bucket */
+    struct qp_cert_entry_s *lru_prev, *lru_next;   /* Most recently used first */
+} qp_cert_entry_t;
+
+static pthread_mutex_t   qp_cert_lock = PTHREAD_MUTEX_INITIALIZER;
+static qp_cert_entry_t **qp_cert_buckets = NULL;
+static qp_cert_entry_t  *qp_cert_lru_head = NULL, *qp_cert_lru_tail = NULL;
+static zend_long         qp_cert_count = 0;
+
+/*──────────────────────────── Parsed files ───────────────────────────────*/
+
+static time_t qp_cert_stat(const char *path, ino_t *ino)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        *ino = 0;
+        return 0;
+    }
+    *ino = st.st_ino;
+    return st.st_mtime;
+}
+
+/* Reads a PEM chain and its key; false unless both load and match */
+static bool qp_cert_parse(qp_cert_entry_t *e, const char *cert_file, const char *key_file)
+{
+    BIO *in = BIO_new_file(cert_file, "r");
+    if (!in) {
+        ERR_clear_error();
+        return false;
+    }
+    X509 *leaf = PEM_read_bio_X509_AUX(in, NULL, NULL, NULL);
+    STACK_OF(X509) *chain = sk_X509_new_null();
+    X509 *ca;
+    while (leaf && chain && (ca = PEM_read_bio_X509(in, NULL, NULL, NULL)) != NULL) {
+        sk_X509_push(chain, ca);
+    }
+    BIO_free(in);
+
+    EVP_PKEY *pkey = NULL;
+    if ((in = BIO_new_file(key_file, "r")) != NULL) {
+        pkey = PEM_read_bio_PrivateKey(in, NULL, NULL, NULL);
+        BIO_free(in);
+    }
+    ERR_clear_error();   /* The chain loop always ends on a "no start line" */
+
+    if (!leaf || !chain || !pkey || X509_check_private_key(leaf, pkey) != 1) {
+        X509_free(leaf);
+        sk_X509_pop_free(chain, X509_free);
+        EVP_PKEY_free(pkey);
+        ERR_clear_error();
+        return false;
+    }
+    e->leaf = leaf;
+    e->chain = chain;
+    e->pkey = pkey;
+    return true;
+}
+
+static void qp_cert_entry_free(qp_cert_entry_t *e)
+{
+    X509_free(e->leaf);
+    sk_X509_pop_free(e->chain, X509_free);
+    EVP_PKEY_free(e->pkey);
+    pefree(e->key, 1);
+    pefree(e, 1);
+}
+
+/*──────────────────────────── Table (locked) ─────────────────────────────*/
+
+static uint32_t qp_cert_hash(const char *key)
+{
+    uint32_t h = 2166136261u;
+    for (; *key; key++) {
+        h = (h ^ (uint8_t)*key) * 16777619u;
+    }
+    return h;
+}
+
+static qp_cert_entry_t *qp_cert_find(const char *key, uint32_t hash)
+{
+    if (!qp_cert_buckets) {
+        return NULL;
+    }
+    for (qp_cert_entry_t *e = qp_cert_buckets[hash & (QP_CERT_BUCKETS - 1)]; e; e = e->next) {
+        if (e->hash == hash && strcmp(e->key, key) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void qp_cert_lru_unlink(qp_cert_entry_t *e)
+{
+    if (e->lru_prev) e->lru_prev->lru_next = e->lru_next; else qp_cert_lru_head = e->lru_next;
+    if (e->lru_next) e->lru_next->lru_prev = e->lru_prev; else qp_cert_lru_tail = e->lru_prev;
+    e->lru_prev = e->lru_next = NULL;
+}
+
+static void qp_cert_lru_push(qp_cert_entry_t *e)
+{
+    e->lru_next = qp_cert_lru_head;
+    if (qp_cert_lru_head) qp_cert_lru_head->lru_prev = e; else qp_cert_lru_tail = e;
+    qp_cert_lru_head = e;
+}
+
+static void qp_cert_touch(qp_cert_entry_t *e)
+{
+    if (qp_cert_lru_head != e) {
+        qp_cert_lru_unlink(e);
+        qp_cert_lru_push(e);
+    }
+}
+
+static void qp_cert_remove(qp_cert_entry_t *e)
+{
+    qp_cert_entry_t **pp = &qp_cert_buckets[e->hash & (QP_CERT_BUCKETS - 1)];
+    while (*pp != e) {
+        pp = &(*pp)->next;
+    }
+    *pp = e->next;
+    qp_cert_lru_unlink(e);
+    qp_cert_count--;
+    qp_cert_entry_free(e);
+}
+
+/* Takes `fresh` in place of any entry under its key and trims the LRU */
+static qp_cert_entry_t *qp_cert_insert(qp_cert_entry_t *fresh)
+{
+    if (!qp_cert_buckets) {
+        qp_cert_buckets = pecalloc(QP_CERT_BUCKETS, sizeof(*qp_cert_buckets), 1);
+    }
+    qp_cert_entry_t *old = qp_cert_find(fresh->key, fresh->hash);
+    if (old) {
+        qp_cert_remove(old);
+    }
+    qp_cert_entry_t **bucket = &qp_cert_buckets[fresh->hash & (QP_CERT_BUCKETS - 1)];
+    fresh->next = *bucket;
+    *bucket = fresh;
+    qp_cert_lru_push(fresh);
+    qp_cert_count++;
+
+    while (qp_cert_count > quicpro_tls_crypto_config.tls_cert_store_hot_size && qp_cert_lru_tail != fresh) {
+        qp_cert_remove(qp_cert_lru_tail);
+    }
+    return fresh;
+}
+
+/*──────────────────────────── Lookup ─────────────────────────────────────*/
+
+/*
+ * The entry for `key` with `cert_file` and `key_file`, parsed if the
+ * files are new or changed since it was last looked at. Returns with the
+ * lock held; the entry may be negative. `negative` says whether a
+ * missing certificate is remembered or reported as NULL.
+ */
+static qp_cert_entry_t *qp_cert_lookup_locked(const char *key, const char *cert_file, const char *key_file, bool negative)
+{
+    uint32_t hash = qp_cert_hash(key);
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&qp_cert_lock);
+    qp_cert_entry_t *e = qp_cert_find(key, hash);
+    if (e && (e->leaf || negative) && now - e->checked < QP_CERT_RECHECK_SEC) {
+        qp_cert_touch(e);
+        return e;
+    }
+    time_t seen = e ? e->mtime : 0;
+    ino_t seen_ino = e ? e->ino : 0;
+    bool had = e && (e->leaf || negative);
+    pthread_mutex_unlock(&qp_cert_lock);
+
+    ino_t ino;
+    time_t mtime = qp_cert_stat(cert_file, &ino);
+    if (had && mtime == seen && ino == seen_ino) {
+        /* Unchanged on disk; the entry may have been evicted meanwhile */
+        pthread_mutex_lock(&qp_cert_lock);
+        if ((e = qp_cert_find(key, hash)) != NULL && e->mtime == seen && e->ino == seen_ino) {
+            e->checked = now;
+            qp_cert_touch(e);
+            return e;
+        }
+        pthread_mutex_unlock(&qp_cert_lock);
+    }
+
+    qp_cert_entry_t *fresh = pecalloc(1, sizeof(*fresh), 1);
+    fresh->key = pestrdup(key, 1);
+    fresh->hash = hash;
+    fresh->mtime = mtime;
+    fresh->ino = ino;
+    fresh->checked = now;
+    if ((mtime == 0 || !qp_cert_parse(fresh, cert_file, key_file)) && !negative) {
+        qp_cert_entry_free(fresh);
+        pthread_mutex_lock(&qp_cert_lock);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&qp_cert_lock);
+    return qp_cert_insert(fresh);
+}
+
+/* Hands the certificate stored for `name` to `ssl`; false if there is none */
+static bool qp_cert_store_apply(SSL *ssl, const char *name)
+{
+    const char *dir = quicpro_tls_crypto_config.tls_cert_store_dir;
+    char cert_file[PATH_MAX], key_file[PATH_MAX];
+    if (snprintf(cert_file, sizeof(cert_file), "%s/%s.crt", dir, name) >= (int)sizeof(cert_file)
+        || snprintf(key_file, sizeof(key_file), "%s/%s.key", dir, name) >= (int)sizeof(key_file)) {
+        return false;
+    }
+
+    qp_cert_entry_t *e = qp_cert_lookup_locked(name, cert_file, key_file, true);
+    bool ok = e && e->leaf && SSL_use_cert_and_key(ssl, e->leaf, e->pkey, e->chain, 1) == 1;
+    pthread_mutex_unlock(&qp_cert_lock);
+    return ok;
+}
+
+/* Lower-cases the SNI into `out`; false for anything but a plain host name */
+static bool qp_cert_normalize(const char *sni, char *out)
+{
+    size_t len = strlen(sni);
+    if (len == 0 || len > QP_CERT_NAME_MAX || sni[0] == '.' || sni[0] == '-') {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        char c = sni[i];
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        } else if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || (c == '.' && sni[i - 1] != '.'))) {
+            return false;
+        }
+        out[i] = c;
+    }
+    out[len] = '\0';
+    return true;
+}
+
+static int qp_cert_store_cert_cb(SSL *ssl, void *arg)
+{
+    (void)arg;
+    const char *sni = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    char name[QP_CERT_NAME_MAX + 1];
+    if (!sni || !qp_cert_normalize(sni, name)) {
+        return 1;   /* The listener's default certificate */
+    }
+    if (qp_cert_store_apply(ssl, name)) {
+        return 1;
+    }
+    const char *parent = strchr(name, '.');
+    if (parent && strchr(parent + 1, '.')) {
+        /* "_.example.com" for "www.example.com", never for "example.com" itself */
+        char *wild = (char *)parent - 1;
+        wild[0] = '_';
+        qp_cert_store_apply(ssl, wild);
+    }
+    return 1;
+}
+
+/*──────────────────────────── Public API ─────────────────────────────────*/
+
+bool quicpro_cert_store_enabled(void)
+{
+    const char *dir = quicpro_tls_crypto_config.tls_cert_store_dir;
+    return dir && dir[0] != '\0';
+}
+
+/* Returns with the lock held, like qp_cert_lookup_locked() */
+static qp_cert_entry_t *qp_cert_files_locked(const char *cert_file, const char *key_file)
+{
+    size_t len = strlen(cert_file) + strlen(key_file) + 3;
+    char *key = emalloc(len);
+    snprintf(key, len, "@%s|%s", cert_file, key_file);
+
+    qp_cert_entry_t *e = qp_cert_lookup_locked(key, cert_file, key_file, false);
+    efree(key);
+    return e;
+}
+
+bool quicpro_cert_store_use_files(SSL_CTX *ctx, const char *cert_file, const char *key_file)
+{
+    qp_cert_entry_t *e = qp_cert_files_locked(cert_file, key_file);
+    bool ok = e && SSL_CTX_use_cert_and_key(ctx, e->leaf, e->pkey, e->chain, 1) == 1;
+    pthread_mutex_unlock(&qp_cert_lock);
+    return ok;
+}
+
+bool quicpro_cert_store_check_files(const char *cert_file, const char *key_file)
+{
+    qp_cert_entry_t *e = qp_cert_files_locked(cert_file, key_file);
+    pthread_mutex_unlock(&qp_cert_lock);
+    return e != NULL;
+}
+
+void quicpro_cert_store_expire(void)
+{
+    pthread_mutex_lock(&qp_cert_lock);
+    for (qp_cert_entry_t *e = qp_cert_lru_head; e; e = e->lru_next) {
+        e->checked = 0;
+    }
+    pthread_mutex_unlock(&qp_cert_lock);
+}
+
+void quicpro_cert_store_install(SSL_CTX *ctx)
+{
+    if (quicpro_cert_store_enabled()) {
+        SSL_CTX_set_cert_cb(ctx, qp_cert_store_cert_cb, NULL);
+    }
+}
+
+void quicpro_cert_store_mshutdown(void)
+{
+    pthread_mutex_lock(&qp_cert_lock);
+    while (qp_cert_lru_tail) {
+        qp_cert_remove(qp_cert_lru_tail);
+    }
+    if (qp_cert_buckets) {
+        pefree(qp_cert_buckets, 1);
+        qp_cert_buckets = NULL;
+    }
+    pthread_mutex_unlock(&qp_cert_lock);
+}
@@ -0,0 +1,145 @@
+/*
+ * cert_watch.c  –  Certificate reloads on file changes for php-quicpro
+ * --------------------------------------------------------------------
+ *
+ * See include/server/cert_watch.h. inotify watches directories, not the
+ * files: a renewal usually replaces a file or a symlink by rename, which
+ * a watch on the old inode would never see. Any event in a watched
+ * directory only prompts a stat() of the two files; their inode and mtime
+ * decide whether to reload.
+ */
+
+#include "php_quicpro.h"
+#include "server/cert_watch.h"
+#include "server/cert_store.h"
+#include "config/tls_and_crypto/base_layer.h"
+
+#include <errno.h>
+#include <libgen.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define QP_CERT_WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_ATTRIB)
+
+static void qp_cert_watch_stat(const char *path, time_t *mtime, ino_t *ino)
+{
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        *mtime = st.st_mtime;
+        *ino = st.st_ino;
+    } else {
+        *mtime = 0;
+        *ino = 0;
+    }
+}
+
+/* Watches the directory holding `path`; a second watch on it is a no-op */
+static void qp_cert_watch_dir_of(quicpro_cert_watch_t *w, const char *path)
+{
+    char copy[PATH_MAX];
+    snprintf(copy, sizeof(copy), "%s", path);
+    if (inotify_add_watch(w->fd, dirname(copy), QP_CERT_WATCH_MASK) < 0) {
+        php_error_docref(NULL, E_NOTICE, "Cannot watch the directory of '%s' for certificate renewals: %s", path, strerror(errno));
+    }
+}
+
+void quicpro_cert_watch_init(quicpro_cert_watch_t *w, const char *cert_file, const char *key_file)
+{
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+    if (!quicpro_tls_crypto_config.tls_cert_reload_enable) {
+        return;
+    }
+    bool files = cert_file && cert_file[0] && key_file && key_file[0];
+    if (!files && !quicpro_cert_store_enabled()) {
+        return;
+    }
+    w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->fd < 0) {
+        php_error_docref(NULL, E_NOTICE, "Certificates are not reloaded on renewal: inotify_init1() failed: %s", strerror(errno));
+        return;
+    }
+    if (files) {
+        w->cert_file = cert_file;
+        w->key_file = key_file;
+        qp_cert_watch_stat(cert_file, &w->mtime[0], &w->ino[0]);
+        qp_cert_watch_stat(key_file, &w->mtime[1], &w->ino[1]);
+        qp_cert_watch_dir_of(w, cert_file);
+        qp_cert_watch_dir_of(w, key_file);
+    }
+    if (quicpro_cert_store_enabled()
+        && inotify_add_watch(w->fd, quicpro_tls_crypto_config.tls_cert_store_dir, QP_CERT_WATCH_MASK) < 0) {
+        php_error_docref(NULL, E_NOTICE, "Cannot watch '%s' for certificate renewals: %s",
+                         quicpro_tls_crypto_config.tls_cert_store_dir, strerror(errno));
+    }
+}
+
+void quicpro_cert_watch_arm(quicpro_cert_watch_t *w, int epoll_fd)
+{
+    if (w->fd < 0) {
+        return;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = w };
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, w->fd, &ev);
+}
+
+bool quicpro_cert_watch_changed(quicpro_cert_watch_t *w)
+{
+    if (w->fd < 0) {
+        return false;
+    }
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool events = false;
+    while (read(w->fd, buf, sizeof(buf)) > 0) {
+        events = true;   /* Which file does not matter, see above */
+    }
+    if (!events) {
+        return false;
+    }
+    quicpro_cert_store_expire();   /* Store certificates look again on their next handshake */
+    if (!w->cert_file) {
+        return false;
+    }
+
+    time_t mtime[2];
+    ino_t ino[2];
+    qp_cert_watch_stat(w->cert_file, &mtime[0], &ino[0]);
+    qp_cert_watch_stat(w->key_file, &mtime[1], &ino[1]);
+    bool changed = memcmp(mtime, w->mtime, sizeof(mtime)) != 0 || memcmp(ino, w->ino, sizeof(ino)) != 0;
+    memcpy(w->mtime, mtime, sizeof(mtime));
+    memcpy(w->ino, ino, sizeof(ino));
+    return changed;
+}
+
+bool quicpro_cert_watch_reload_ssl(quicpro_cert_watch_t *w, SSL_CTX *ctx)
+{
+    if (!quicpro_cert_store_use_files(ctx, w->cert_file, w->key_file)) {
+        php_error_docref(NULL, E_WARNING, "Renewed '%s' does not load with its key; new handshakes keep the previous certificate", w->cert_file);
+        return false;
+    }
+    return true;
+}
+
+bool quicpro_cert_watch_reload_quiche(quicpro_cert_watch_t *w, quiche_config *cfg)
+{
+    /* Parsed first: quiche takes chain and key one at a time and must never hold a mismatched pair */
+    if (!quicpro_cert_store_check_files(w->cert_file, w->key_file)
+        || quiche_config_load_cert_chain_from_pem_file(cfg, w->cert_file) < 0
+        || quiche_config_load_priv_key_from_pem_file(cfg, w->key_file) < 0) {
+        php_error_docref(NULL, E_WARNING, "Renewed '%s' does not load with its key; new connections keep the previous certificate", w->cert_file);
+        return false;
+    }
+    return true;
+}
+
+void quicpro_cert_watch_close(quicpro_cert_watch_t *w)
+{
+    if (w->fd >= 0) {
+        close(w->fd);
+        w->fd = -1;
+    }
+}
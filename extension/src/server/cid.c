@@ -0,0 +1,436 @@
+/*
+ * cid.c  –  Connection-ID generator and CID -> session table for php-quicpro
+ * -------------------------------------------------------------------------
+ *
+ * Replaces the open("/dev/urandom") / read() / close() per accepted
+ * connection and the generic zend_hash_str_*() lookups of the listeners.
+ *
+ *   generator:  ChaCha20 (RFC 8439 block function) over a 1 KiB buffer,
+ *               rekeyed from its own output on every refill and from
+ *               getrandom() after fork() or 2^20 refills.
+ *   table:      control bytes + fixed-size slots, 16-slot groups probed
+ *               triangularly; deleted slots become tombstones so that
+ *               deleting while iterating never moves an entry.
+ */
+
+#include "php_quicpro.h"
+#include "server/cid.h"
+#include "server/reuseport.h"
+#include "server/router.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+# include <sys/random.h>
+#endif
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+/*────────────────────────────── Generator ────────────────────────────────*/
+
+#define QP_CHACHA_BLOCKS       16
+#define QP_CHACHA_BUF          (64 * QP_CHACHA_BLOCKS)
+#define QP_CHACHA_RESEED_EVERY (1u << 20)
+
+typedef struct {
+    uint32_t key[8];
+    uint8_t  buf[QP_CHACHA_BUF];
+    size_t   pos;          /* Next unread byte; QP_CHACHA_BUF means empty. */
+    uint32_t refills;
+    pid_t    pid;          /* Owner; a child must not replay the parent's stream. */
+    bool     seeded;
+} quicpro_cid_rng_t;
+
+/* One per thread: the admin listener's thread screens datagrams as well. */
+static _Thread_local quicpro_cid_rng_t quicpro_cid_rng = { .pos = QP_CHACHA_BUF };
+
+#define QP_ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define QP_QR(a, b, c, d) \
+    a += b; d ^= a; d = QP_ROTL32(d, 16); \
+    c += d; b ^= c; b = QP_ROTL32(b, 12); \
+    a += b; d ^= a; d = QP_ROTL32(d, 8);  \
+    c += d; b ^= c; b = QP_ROTL32(b, 7)
+
+static void quicpro_chacha20_block(const uint32_t key[8], uint32_t counter, uint8_t out[64])
+{
+    uint32_t in[16] = {
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+        key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+        counter, 0, 0, 0
+    };
+    uint32_t x[16];
+    memcpy(x, in, sizeof(x));
+
+    for (int i = 0; i < 10; i++) {
+        QP_QR(x[0], x[4], x[8],  x[12]);
+        QP_QR(x[1], x[5], x[9],  x[13]);
+        QP_QR(x[2], x[6], x[10], x[14]);
+        QP_QR(x[3], x[7], x[11], x[15]);
+        QP_QR(x[0], x[5], x[10], x[15]);
+        QP_QR(x[1], x[6], x[11], x[12]);
+        QP_QR(x[2], x[7], x[8],  x[13]);
+        QP_QR(x[3], x[4], x[9],  x[14]);
+    }
+    for (int i = 0; i < 16; i++) {
+        uint32_t v = x[i] + in[i];
+        out[4 * i]     = (uint8_t)v;
+        out[4 * i + 1] = (uint8_t)(v >> 8);
+        out[4 * i + 2] = (uint8_t)(v >> 16);
+        out[4 * i + 3] = (uint8_t)(v >> 24);
+    }
+}
+
+static int quicpro_cid_os_random(void *out, size_t len)
+{
+    uint8_t *p = out;
+#ifdef __linux__
+    while (len > 0) {
+        ssize_t n = getrandom(p, len, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+#else
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    close(fd);
+    return 0;
+#endif
+}
+
+static int quicpro_cid_rng_refill(quicpro_cid_rng_t *r)
+{
+    pid_t pid = getpid();
+    if (!r->seeded || r->pid != pid || r->refills >= QP_CHACHA_RESEED_EVERY) {
+        if (quicpro_cid_os_random(r->key, sizeof(r->key)) < 0) {
+            return -1;
+        }
+        r->seeded  = true;
+        r->pid     = pid;
+        r->refills = 0;
+    }
+
+    for (uint32_t i = 0; i < QP_CHACHA_BLOCKS; i++) {
+        quicpro_chacha20_block(r->key, i, r->buf + 64 * i);
+    }
+    /* Fast key erasure: the next key is output nobody else ever sees */
+    memcpy(r->key, r->buf, sizeof(r->key));
+    memset(r->buf, 0, sizeof(r->key));
+    r->pos = sizeof(r->key);
+    r->refills++;
+    return 0;
+}
+
+int quicpro_cid_random_bytes(uint8_t *out, size_t len)
+{
+    quicpro_cid_rng_t *r = &quicpro_cid_rng;
+
+    if (r->seeded && r->pid != getpid()) {
+        r->pos = QP_CHACHA_BUF;    /* Forked: discard the inherited buffer */
+    }
+    while (len > 0) {
+        if (r->pos >= QP_CHACHA_BUF && quicpro_cid_rng_refill(r) < 0) {
+            return -1;
+        }
+        size_t n = MIN(len, QP_CHACHA_BUF - r->pos);
+        memcpy(out, r->buf + r->pos, n);
+        memset(r->buf + r->pos, 0, n);
+        r->pos += n;
+        out += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int quicpro_cid_generate(uint8_t *cid, size_t len)
+{
+    if (quicpro_cid_random_bytes(cid, len) < 0) {
+        return -1;
+    }
+    quicpro_reuseport_stamp_cid(cid, len);
+    quicpro_router_stamp_cid(cid, len);
+    return 0;
+}
+
+/*──────────────────────────────── Table ──────────────────────────────────*/
+
+#define QP_CID_GROUP        16
+#define QP_CTRL_EMPTY       0x80
+#define QP_CTRL_DELETED     0xFE
+
+typedef struct {
+    uint8_t  cid[QUICHE_MAX_CONN_ID_LEN];
+    uint8_t  len;
+    void    *value;
+} quicpro_cid_slot_t;
+
+struct quicpro_cid_table_s {
+    size_t               capacity;     /* Power of two, multiple of QP_CID_GROUP. */
+    size_t               count;
+    size_t               tombstones;
+    uint64_t             seed;
+    quicpro_cid_dtor_t   dtor;
+    bool                 persistent;   /* malloc()ed: usable off the PHP thread. */
+    uint8_t             *ctrl;         /* One byte per slot: EMPTY, DELETED or hash tag. */
+    quicpro_cid_slot_t  *slots;
+};
+
+static uint64_t quicpro_cid_hash(const quicpro_cid_table_t *t, const uint8_t *cid, size_t len)
+{
+    uint64_t h = t->seed ^ ((uint64_t)len * 0x9e3779b97f4a7c15ull);
+    size_t i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, cid + i, 8);
+        h = (h ^ w) * 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 31;
+    }
+    uint64_t w = 0;
+    memcpy(&w, cid + i, len - i);
+    h = (h ^ w) * 0x94d049bb133111ebull;
+    return h ^ (h >> 29);
+}
+
+/* Bit i set if ctrl[i] == byte, for the 16 control bytes of a group. */
+static inline uint32_t quicpro_cid_group_match(const uint8_t *ctrl, uint8_t byte)
+{
+#ifdef __SSE2__
+    __m128i g = _mm_loadu_si128((const __m128i *)ctrl);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)byte)));
+#else
+    uint32_t m = 0;
+    for (int i = 0; i < QP_CID_GROUP; i++) {
+        m |= (uint32_t)(ctrl[i] == byte) << i;
+    }
+    return m;
+#endif
+}
+
+static inline bool quicpro_cid_slot_is(const quicpro_cid_slot_t *s, const uint8_t *cid, size_t len)
+{
+    return s->len == len && memcmp(s->cid, cid, len) == 0;
+}
+
+/* Returns the slot index holding `cid`, or (size_t)-1. */
+static size_t quicpro_cid_table_lookup(const quicpro_cid_table_t *t, const uint8_t *cid, size_t len, uint64_t h)
+{
+    size_t gmask = t->capacity / QP_CID_GROUP - 1;
+    size_t g = (size_t)h & gmask;
+    uint8_t tag = (uint8_t)(h >> 57);
+
+    for (size_t step = 1; step <= gmask + 1; step++) {
+        const uint8_t *ctrl = t->ctrl + g * QP_CID_GROUP;
+        for (uint32_t m = quicpro_cid_group_match(ctrl, tag); m; m &= m - 1) {
+            size_t idx = g * QP_CID_GROUP + (size_t)__builtin_ctz(m);
+            if (quicpro_cid_slot_is(&t->slots[idx], cid, len)) {
+                return idx;
+            }
+        }
+        if (quicpro_cid_group_match(ctrl, QP_CTRL_EMPTY)) {
+            break;
+        }
+        g = (g + step) & gmask;
+    }
+    return (size_t)-1;
+}
+
+static void quicpro_cid_table_alloc(quicpro_cid_table_t *t, size_t capacity)
+{
+    t->capacity   = capacity;
+    t->count      = 0;
+    t->tombstones = 0;
+    t->ctrl       = pemalloc(capacity, t->persistent);
+    memset(t->ctrl, QP_CTRL_EMPTY, capacity);
+    t->slots      = safe_pemalloc(capacity, sizeof(quicpro_cid_slot_t), 0, t->persistent);
+}
+
+static void quicpro_cid_table_place(quicpro_cid_table_t *t, const uint8_t *cid, size_t len, void *value, uint64_t h)
+{
+    size_t gmask = t->capacity / QP_CID_GROUP - 1;
+    size_t g = (size_t)h & gmask;
+
+    for (size_t step = 1; ; step++) {
+        uint8_t *ctrl = t->ctrl + g * QP_CID_GROUP;
+        uint32_t free_mask = quicpro_cid_group_match(ctrl, QP_CTRL_EMPTY)
+                           | quicpro_cid_group_match(ctrl, QP_CTRL_DELETED);
+        if (free_mask) {
+            size_t idx = g * QP_CID_GROUP + (size_t)__builtin_ctz(free_mask);
+            if (t->ctrl[idx] == QP_CTRL_DELETED) {
+                t->tombstones--;
+            }
+            t->ctrl[idx] = (uint8_t)(h >> 57);
+            memcpy(t->slots[idx].cid, cid, len);
+            t->slots[idx].len   = (uint8_t)len;
+            t->slots[idx].value = value;
+            t->count++;
+            return;
+        }
+        g = (g + step) & gmask;
+    }
+}
+
+/* Grows (or just purges tombstones) once the table is 7/8 occupied. */
+static void quicpro_cid_table_reserve(quicpro_cid_table_t *t)
+{
+    if ((t->count + t->tombstones + 1) * 8 <= t->capacity * 7) {
+        return;
+    }
+
+    size_t old_cap = t->capacity;
+    uint8_t *old_ctrl = t->ctrl;
+    quicpro_cid_slot_t *old_slots = t->slots;
+
+    quicpro_cid_table_alloc(t, t->count * 2 >= old_cap ? old_cap * 2 : old_cap);
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old_ctrl[i] < QP_CTRL_EMPTY) {
+            quicpro_cid_slot_t *s = &old_slots[i];
+            quicpro_cid_table_place(t, s->cid, s->len, s->value, quicpro_cid_hash(t, s->cid, s->len));
+        }
+    }
+    pefree(old_ctrl, t->persistent);
+    pefree(old_slots, t->persistent);
+}
+
+static quicpro_cid_table_t *quicpro_cid_table_create(size_t expected, quicpro_cid_dtor_t dtor, bool persistent)
+{
+    quicpro_cid_table_t *t = pecalloc(1, sizeof(*t), persistent);
+    size_t capacity = QP_CID_GROUP;
+
+    while (capacity * 7 < expected * 8) {
+        capacity *= 2;
+    }
+    t->dtor = dtor;
+    t->persistent = persistent;
+    if (quicpro_cid_random_bytes((uint8_t *)&t->seed, sizeof(t->seed)) < 0) {
+        t->seed = (uint64_t)(uintptr_t)t ^ 0x2545f4914f6cdd1dull;
+    }
+    quicpro_cid_table_alloc(t, capacity);
+    return t;
+}
+
+quicpro_cid_table_t *quicpro_cid_table_new(size_t expected, quicpro_cid_dtor_t dtor)
+{
+    return quicpro_cid_table_create(expected, dtor, false);
+}
+
+quicpro_cid_table_t *quicpro_cid_table_new_persistent(size_t expected, quicpro_cid_dtor_t dtor)
+{
+    return quicpro_cid_table_create(expected, dtor, true);
+}
+
+void quicpro_cid_table_free(quicpro_cid_table_t *t)
+{
+    if (!t) {
+        return;
+    }
+    if (t->dtor) {
+        for (size_t i = 0; i < t->capacity; i++) {
+            if (t->ctrl[i] < QP_CTRL_EMPTY) {
+                t->dtor(t->slots[i].value);
+            }
+        }
+    }
+    bool persistent = t->persistent;
+    pefree(t->ctrl, persistent);
+    pefree(t->slots, persistent);
+    pefree(t, persistent);
+}
+
+void *quicpro_cid_table_find(const quicpro_cid_table_t *t, const uint8_t *cid, size_t len)
+{
+    if (len > QUICHE_MAX_CONN_ID_LEN) {
+        return NULL;
+    }
+    size_t idx = quicpro_cid_table_lookup(t, cid, len, quicpro_cid_hash(t, cid, len));
+    return idx == (size_t)-1 ? NULL : t->slots[idx].value;
+}
+
+bool quicpro_cid_table_add(quicpro_cid_table_t *t, const uint8_t *cid, size_t len, void *value)
+{
+    if (len > QUICHE_MAX_CONN_ID_LEN) {
+        return false;
+    }
+    uint64_t h = quicpro_cid_hash(t, cid, len);
+    if (quicpro_cid_table_lookup(t, cid, len, h) != (size_t)-1) {
+        return false;
+    }
+    quicpro_cid_table_reserve(t);
+    quicpro_cid_table_place(t, cid, len, value, h);
+    return true;
+}
+
+bool quicpro_cid_table_del(quicpro_cid_table_t *t, const uint8_t *cid, size_t len)
+{
+    if (len > QUICHE_MAX_CONN_ID_LEN) {
+        return false;
+    }
+    size_t idx = quicpro_cid_table_lookup(t, cid, len, quicpro_cid_hash(t, cid, len));
+    if (idx == (size_t)-1) {
+        return false;
+    }
+    void *value = t->slots[idx].value;
+
+    /* A slot in a group that still has an empty byte can never be on another key's probe path */
+    const uint8_t *group = t->ctrl + (idx & ~(size_t)(QP_CID_GROUP - 1));
+    if (quicpro_cid_group_match(group, QP_CTRL_EMPTY)) {
+        t->ctrl[idx] = QP_CTRL_EMPTY;
+    } else {
+        t->ctrl[idx] = QP_CTRL_DELETED;
+        t->tombstones++;
+    }
+    t->count--;
+
+    if (t->dtor) {
+        t->dtor(value);
+    }
+    return true;
+}
+
+size_t quicpro_cid_table_count(const quicpro_cid_table_t *t)
+{
+    return t->count;
+}
+
+void *quicpro_cid_table_next(const quicpro_cid_table_t *t, size_t *pos,
+                             const uint8_t **cid, size_t *len)
+{
+    for (size_t i = *pos; i < t->capacity; i++) {
+        if (t->ctrl[i] < QP_CTRL_EMPTY) {
+            *pos = i + 1;
+            if (cid) {
+                *cid = t->slots[i].cid;
+            }
+            if (len) {
+                *len = t->slots[i].len;
+            }
+            return t->slots[i].value;
+        }
+    }
+    *pos = t->capacity;
+    return NULL;
+}
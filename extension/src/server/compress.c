@@ -0,0 +1,436 @@
+/*
+ * compress.c  –  Accept-Encoding negotiation and body encoders for the listeners
+ * ------------------------------------------------------------------------------
+ *
+ * See include/server/compress.h. All three encoders sit behind one
+ * streaming interface; a whole body is a stream written once with
+ * `finish`. Output grows in a smart_str, sized from the input, so most
+ * bodies are encoded into a single allocation.
+ */
+
+#include "php_quicpro.h"
+#include "server/compress.h"
+#include "config/app_http3_websockets_webtransport/base_layer.h"
+
+#include <string.h>
+#include <strings.h>
+#include <zend_smart_str.h>
+
+#ifdef QUICPRO_HAVE_ZLIB
+# include <zlib.h>
+#endif
+#ifdef QUICPRO_HAVE_BROTLI
+# include <brotli/encode.h>
+#endif
+#ifdef QUICPRO_HAVE_ZSTD
+# include <zstd.h>
+#endif
+
+#define QP_COMPRESS_CODINGS 4
+#define QP_COMPRESS_SLACK   64          /* Headers and trailers of a tiny body */
+
+/* Levels by coding: { fast, max } */
+static const int qp_compress_levels[QP_COMPRESS_CODINGS][2] = {
+    [QUICPRO_CODING_GZIP] = { 5, 9 },
+    [QUICPRO_CODING_BR]   = { 4, 11 },
+    [QUICPRO_CODING_ZSTD] = { 3, 19 },
+};
+
+struct quicpro_compress_stream_s {
+    quicpro_coding_t coding;
+    bool             finished;
+#ifdef QUICPRO_HAVE_ZLIB
+    z_stream         gz;
+#endif
+#ifdef QUICPRO_HAVE_BROTLI
+    BrotliEncoderState *br;
+#endif
+#ifdef QUICPRO_HAVE_ZSTD
+    ZSTD_CCtx       *zs;
+#endif
+};
+
+/*──────────────────────────── Negotiation ────────────────────────────────*/
+
+static bool qp_compress_built(quicpro_coding_t coding)
+{
+    switch (coding) {
+#ifdef QUICPRO_HAVE_ZLIB
+    case QUICPRO_CODING_GZIP: return true;
+#endif
+#ifdef QUICPRO_HAVE_BROTLI
+    case QUICPRO_CODING_BR: return true;
+#endif
+#ifdef QUICPRO_HAVE_ZSTD
+    case QUICPRO_CODING_ZSTD: return true;
+#endif
+    default: return false;
+    }
+}
+
+static const char *qp_compress_trim(const char *s, const char *end, size_t *len)
+{
+    while (s < end && (*s == ' ' || *s == '\t')) s++;
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t')) end--;
+    *len = (size_t)(end - s);
+    return s;
+}
+
+/* The configured codings this build has, in preference order; returns how many */
+static size_t qp_compress_preference(quicpro_coding_t out[QP_COMPRESS_CODINGS])
+{
+    const char *p = quicpro_app_protocols_config.http_auto_compress;
+    size_t n = 0;
+    while (p && *p && n < QP_COMPRESS_CODINGS) {
+        const char *comma = strchr(p, ',');
+        const char *end = comma ? comma : p + strlen(p);
+        size_t len;
+        const char *name = qp_compress_trim(p, end, &len);
+        quicpro_coding_t c = QUICPRO_CODING_IDENTITY;
+        if ((len == 6 && strncasecmp(name, "brotli", 6) == 0) || (len == 2 && strncasecmp(name, "br", 2) == 0)) {
+            c = QUICPRO_CODING_BR;
+        } else if (len == 4 && strncasecmp(name, "gzip", 4) == 0) {
+            c = QUICPRO_CODING_GZIP;
+        } else if (len == 4 && strncasecmp(name, "zstd", 4) == 0) {
+            c = QUICPRO_CODING_ZSTD;
+        } else if (len == 4 && strncasecmp(name, "none", 4) == 0) {
+            return 0;
+        }
+        if (qp_compress_built(c)) {
+            out[n++] = c;
+        }
+        p = comma ? comma + 1 : NULL;
+    }
+    return n;
+}
+
+bool quicpro_compress_enabled(void)
+{
+    quicpro_coding_t pref[QP_COMPRESS_CODINGS];
+    return qp_compress_preference(pref) > 0;
+}
+
+/* Whether `q=` parameters leave the coding acceptable: anything but a zero weight */
+static bool qp_compress_q_positive(const char *params, const char *end)
+{
+    while (params < end) {
+        const char *semi = memchr(params, ';', (size_t)(end - params));
+        const char *stop = semi ? semi : end;
+        size_t len;
+        const char *p = qp_compress_trim(params, stop, &len);
+        if (len >= 2 && (p[0] == 'q' || p[0] == 'Q') && p[1] == '=') {
+            for (size_t i = 2; i < len; i++) {
+                if (p[i] >= '1' && p[i] <= '9') return true;
+            }
+            return false;
+        }
+        params = stop + 1;
+    }
+    return true;
+}
+
+quicpro_coding_t quicpro_compress_negotiate(const char *accept_encoding, size_t len)
+{
+    quicpro_coding_t pref[QP_COMPRESS_CODINGS];
+    size_t npref = qp_compress_preference(pref);
+    if (!accept_encoding || npref == 0) {
+        return QUICPRO_CODING_IDENTITY;
+    }
+
+    bool accepted[QP_COMPRESS_CODINGS] = { false };
+    bool refused[QP_COMPRESS_CODINGS] = { false };
+    bool any = false;
+    const char *p = accept_encoding, *end = accept_encoding + len;
+    while (p < end) {
+        const char *comma = memchr(p, ',', (size_t)(end - p));
+        const char *stop = comma ? comma : end;
+        const char *semi = memchr(p, ';', (size_t)(stop - p));
+        size_t nlen;
+        const char *name = qp_compress_trim(p, semi ? semi : stop, &nlen);
+        bool ok = !semi || qp_compress_q_positive(semi + 1, stop);
+        quicpro_coding_t c = QUICPRO_CODING_IDENTITY;
+        if (nlen == 2 && strncasecmp(name, "br", 2) == 0) c = QUICPRO_CODING_BR;
+        else if ((nlen == 4 && strncasecmp(name, "gzip", 4) == 0) || (nlen == 6 && strncasecmp(name, "x-gzip", 6) == 0)) c = QUICPRO_CODING_GZIP;
+        else if (nlen == 4 && strncasecmp(name, "zstd", 4) == 0) c = QUICPRO_CODING_ZSTD;
+        else if (nlen == 1 && name[0] == '*') any = ok;
+        if (c != QUICPRO_CODING_IDENTITY) {
+            accepted[c] = ok;
+            refused[c] = !ok;
+        }
+        p = stop + 1;
+    }
+    /* The server's order breaks ties: clients list codings in no useful order */
+    for (size_t i = 0; i < npref; i++) {
+        if (accepted[pref[i]] || (any && !refused[pref[i]])) {
+            return pref[i];
+        }
+    }
+    return QUICPRO_CODING_IDENTITY;
+}
+
+const char *quicpro_coding_name(quicpro_coding_t coding, size_t *len)
+{
+    switch (coding) {
+    case QUICPRO_CODING_GZIP: *len = 4; return "gzip";
+    case QUICPRO_CODING_BR:   *len = 2; return "br";
+    case QUICPRO_CODING_ZSTD: *len = 4; return "zstd";
+    default:                  *len = 0; return NULL;
+    }
+}
+
+/*──────────────────────────── Eligibility ────────────────────────────────*/
+
+static bool qp_compress_textual(const char *v, size_t len)
+{
+    const char *semi = memchr(v, ';', len);
+    v = qp_compress_trim(v, semi ? semi : v + len, &len);
+    static const char *const types[] = {
+        "application/json", "application/javascript", "application/xml", "application/xhtml+xml",
+        "application/ld+json", "application/manifest+json", "application/x-ndjson", "image/svg+xml",
+        "text/javascript",
+    };
+    if (len > 5 && strncasecmp(v, "text/", 5) == 0) {
+        return true;
+    }
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (strlen(types[i]) == len && strncasecmp(v, types[i], len) == 0) {
+            return true;
+        }
+    }
+    return (len > 5 && strncasecmp(v + len - 5, "+json", 5) == 0) || (len > 4 && strncasecmp(v + len - 4, "+xml", 4) == 0);
+}
+
+typedef struct {
+    bool textual;
+    bool refuse;
+} qp_compress_scan_t;
+
+static void qp_compress_scan(qp_compress_scan_t *scan, const char *name, size_t nlen, const char *value, size_t vlen)
+{
+    if (nlen == 12 && strncasecmp(name, "content-type", 12) == 0) {
+        scan->textual = qp_compress_textual(value, vlen);
+    } else if (nlen == 16 && strncasecmp(name, "content-encoding", 16) == 0) {
+        scan->refuse = true;
+    } else if (nlen == 13 && strncasecmp(name, "cache-control", 13) == 0) {
+        for (size_t i = 0; i + 12 <= vlen; i++) {
+            if (strncasecmp(value + i, "no-transform", 12) == 0) scan->refuse = true;
+        }
+    }
+}
+
+bool quicpro_compress_eligible(long status, const quicpro_header_template_t *tmpl, HashTable *headers)
+{
+    if (status < 200 || status == 204 || status == 206 || status == 304) {
+        return false;
+    }
+    qp_compress_scan_t scan = { false, false };
+    if (tmpl) {
+        for (size_t i = 0; i < tmpl->count; i++) {
+            qp_compress_scan(&scan, (const char *)tmpl->nv[i].name, tmpl->nv[i].namelen,
+                             (const char *)tmpl->nv[i].value, tmpl->nv[i].valuelen);
+        }
+    }
+    if (headers) {
+        zend_string *name;
+        zval *entry;
+        ZEND_HASH_FOREACH_STR_KEY_VAL(headers, name, entry) {
+            if (!name) continue;
+            if (Z_TYPE_P(entry) == IS_ARRAY) {
+                zval *v = zend_hash_index_find(Z_ARRVAL_P(entry), 0);
+                if (!v) continue;
+                entry = v;
+            }
+            zend_string *tmp;
+            zend_string *s = zval_get_tmp_string(entry, &tmp);
+            qp_compress_scan(&scan, ZSTR_VAL(name), ZSTR_LEN(name), ZSTR_VAL(s), ZSTR_LEN(s));
+            zend_tmp_string_release(tmp);
+        } ZEND_HASH_FOREACH_END();
+    }
+    return scan.textual && !scan.refuse;
+}
+
+bool quicpro_compress_worth(size_t len)
+{
+    return len >= (size_t)quicpro_app_protocols_config.http_compress_min_length;
+}
+
+bool quicpro_compress_response(quicpro_coding_t *coding, quicpro_compress_level_t level, long status,
+                               const quicpro_header_template_t *tmpl, HashTable *headers, zend_string **body)
+{
+    quicpro_coding_t wanted = *coding;
+    *coding = QUICPRO_CODING_IDENTITY;
+    if (!quicpro_compress_worth(ZSTR_LEN(*body)) || !quicpro_compress_enabled()
+        || !quicpro_compress_eligible(status, tmpl, headers)) {
+        return false;
+    }
+    zend_string *encoded = wanted != QUICPRO_CODING_IDENTITY
+        ? quicpro_compress(wanted, level, ZSTR_VAL(*body), ZSTR_LEN(*body)) : NULL;
+    if (encoded) {
+        zend_string_release(*body);
+        *body = encoded;
+        *coding = wanted;
+    }
+    return true;
+}
+
+/*──────────────────────────── Encoders ───────────────────────────────────*/
+
+quicpro_compress_stream_t *quicpro_compress_stream_new(quicpro_coding_t coding, quicpro_compress_level_t level)
+{
+    if (!qp_compress_built(coding)) {
+        return NULL;
+    }
+    int lvl = qp_compress_levels[coding][level == QUICPRO_COMPRESS_MAX];
+    quicpro_compress_stream_t *s = ecalloc(1, sizeof(*s));
+    s->coding = coding;
+    bool ok = false;
+
+    switch (coding) {
+#ifdef QUICPRO_HAVE_ZLIB
+    case QUICPRO_CODING_GZIP:
+        /* 15 + 16: a gzip wrapper around a 32 KiB window */
+        ok = deflateInit2(&s->gz, lvl, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+        break;
+#endif
+#ifdef QUICPRO_HAVE_BROTLI
+    case QUICPRO_CODING_BR:
+        s->br = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+        ok = s->br && BrotliEncoderSetParameter(s->br, BROTLI_PARAM_QUALITY, (uint32_t)lvl)
+            && BrotliEncoderSetParameter(s->br, BROTLI_PARAM_MODE, BROTLI_MODE_TEXT);
+        break;
+#endif
+#ifdef QUICPRO_HAVE_ZSTD
+    case QUICPRO_CODING_ZSTD:
+        s->zs = ZSTD_createCCtx();
+        ok = s->zs && !ZSTD_isError(ZSTD_CCtx_setParameter(s->zs, ZSTD_c_compressionLevel, lvl));
+        break;
+#endif
+    default:
+        break;
+    }
+    if (!ok) {
+        quicpro_compress_stream_free(s);
+        return NULL;
+    }
+    (void)lvl;
+    return s;
+}
+
+/* Room for at least `want` more bytes at the end of `out`; returns where they go */
+static char *qp_compress_room(smart_str *out, size_t want, size_t *room)
+{
+    smart_str_alloc(out, want, 0);
+    *room = want;
+    return ZSTR_VAL(out->s) + ZSTR_LEN(out->s);
+}
+
+zend_string *quicpro_compress_stream_write(quicpro_compress_stream_t *s, const char *data, size_t len, bool finish)
+{
+    if (s->finished) {
+        return NULL;
+    }
+    smart_str out = {0};
+    size_t step = MAX(len / 2, 4096) + QP_COMPRESS_SLACK;
+    bool ok = false;
+    s->finished = finish;
+
+    switch (s->coding) {
+#ifdef QUICPRO_HAVE_ZLIB
+    case QUICPRO_CODING_GZIP: {
+        int flush = finish ? Z_FINISH : Z_SYNC_FLUSH;
+        s->gz.next_in = (Bytef *)data;
+        s->gz.avail_in = (uInt)len;
+        int rc;
+        do {
+            size_t room;
+            s->gz.next_out = (Bytef *)qp_compress_room(&out, step, &room);
+            s->gz.avail_out = (uInt)room;
+            rc = deflate(&s->gz, flush);
+            ZSTR_LEN(out.s) += room - s->gz.avail_out;
+        } while ((rc == Z_OK || rc == Z_BUF_ERROR) && s->gz.avail_out == 0);
+        ok = finish ? rc == Z_STREAM_END : (rc == Z_OK || rc == Z_BUF_ERROR);
+        break;
+    }
+#endif
+#ifdef QUICPRO_HAVE_BROTLI
+    case QUICPRO_CODING_BR: {
+        BrotliEncoderOperation op = finish ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_FLUSH;
+        const uint8_t *next_in = (const uint8_t *)data;
+        size_t avail_in = len;
+        ok = true;
+        do {
+            size_t room;
+            uint8_t *next_out = (uint8_t *)qp_compress_room(&out, step, &room);
+            size_t avail_out = room;
+            if (!BrotliEncoderCompressStream(s->br, op, &avail_in, &next_in, &avail_out, &next_out, NULL)) {
+                ok = false;
+                break;
+            }
+            ZSTR_LEN(out.s) += room - avail_out;
+        } while (avail_in > 0 || BrotliEncoderHasMoreOutput(s->br) || (finish && !BrotliEncoderIsFinished(s->br)));
+        break;
+    }
+#endif
+#ifdef QUICPRO_HAVE_ZSTD
+    case QUICPRO_CODING_ZSTD: {
+        ZSTD_inBuffer in = { data, len, 0 };
+        size_t left;
+        do {
+            size_t room;
+            ZSTD_outBuffer o = { qp_compress_room(&out, step, &room), 0, 0 };
+            o.size = room;
+            left = ZSTD_compressStream2(s->zs, &o, &in, finish ? ZSTD_e_end : ZSTD_e_flush);
+            if (ZSTD_isError(left)) break;
+            ZSTR_LEN(out.s) += o.pos;
+        } while (left != 0);
+        ok = !ZSTD_isError(left);
+        break;
+    }
+#endif
+    default:
+        (void)step;
+        break;
+    }
+
+    if (!ok) {
+        smart_str_free(&out);
+        return NULL;
+    }
+    smart_str_0(&out);
+    return out.s ? smart_str_extract(&out) : ZSTR_EMPTY_ALLOC();
+}
+
+void quicpro_compress_stream_free(quicpro_compress_stream_t *s)
+{
+    if (!s) {
+        return;
+    }
+#ifdef QUICPRO_HAVE_ZLIB
+    if (s->coding == QUICPRO_CODING_GZIP) deflateEnd(&s->gz);
+#endif
+#ifdef QUICPRO_HAVE_BROTLI
+    if (s->br) BrotliEncoderDestroyInstance(s->br);
+#endif
+#ifdef QUICPRO_HAVE_ZSTD
+    if (s->zs) ZSTD_freeCCtx(s->zs);
+#endif
+    efree(s);
+}
+
+zend_string *quicpro_compress(quicpro_coding_t coding, quicpro_compress_level_t level, const char *data, size_t len)
+{
+    quicpro_compress_stream_t *s = quicpro_compress_stream_new(coding, level);
+    if (!s) {
+        return NULL;
+    }
+#ifdef QUICPRO_HAVE_ZSTD
+    if (s->zs) ZSTD_CCtx_setPledgedSrcSize(s->zs, len);   /* Records the size, and sizes the window to it */
+#endif
+    zend_string *out = quicpro_compress_stream_write(s, data, len, true);
+    quicpro_compress_stream_free(s);
+    if (out && ZSTR_LEN(out) >= len) {
+        zend_string_release(out);
+        return NULL;
+    }
+    return out;
+}
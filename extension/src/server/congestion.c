@@ -0,0 +1,203 @@
+/*
+ * src/server/congestion.c – Congestion control profiles and warm starts
+ * =====================================================================
+ *
+ * See include/server/congestion.h. The estimate table is a flat array
+ * indexed by a hash of the prefix; an entry is trusted only if its
+ * prefix matches and it is younger than QUICPRO_CC_CACHE_TTL_MS.
+ */
+
+#include "php_quicpro.h"
+#include "server/congestion.h"
+#include "config/quic_transport/base_layer.h"
+
+#include <zend_exceptions.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*──── Profiles ────*/
+
+static const struct {
+    const char          *name;
+    quicpro_cc_profile_t profile;      /* initial_cwnd_packets 0: the ini's */
+} cc_profiles[] = {
+    { "interactive",  { "cubic", 0,  true  } },
+    { "bulk",         { "bbr2",  64, false } },
+    { "conservative", { "reno",  10, true  } },
+};
+
+static void cc_profile_default(quicpro_cc_profile_t *out)
+{
+    const char *algo = quicpro_quic_transport_config.cc_algorithm;
+    snprintf(out->algorithm, sizeof(out->algorithm), "%s", algo && *algo ? algo : "cubic");
+    out->initial_cwnd_packets = (uint32_t)quicpro_quic_transport_config.cc_initial_cwnd_packets;
+    out->hystart = quicpro_quic_transport_config.cc_enable_hystart_plus_plus;
+}
+
+bool quicpro_cc_profile_lookup(const char *name, size_t len, quicpro_cc_profile_t *out)
+{
+    if (!name || len == 0 || (len == sizeof("default") - 1 && memcmp(name, "default", len) == 0)) {
+        cc_profile_default(out);
+        return true;
+    }
+    for (size_t i = 0; i < sizeof(cc_profiles) / sizeof(cc_profiles[0]); i++) {
+        if (strlen(cc_profiles[i].name) == len && memcmp(cc_profiles[i].name, name, len) == 0) {
+            *out = cc_profiles[i].profile;
+            if (out->initial_cwnd_packets == 0) {
+                out->initial_cwnd_packets = (uint32_t)quicpro_quic_transport_config.cc_initial_cwnd_packets;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void quicpro_cc_profile_apply(quiche_config *q, const quicpro_cc_profile_t *p)
+{
+    if (quiche_config_set_cc_algorithm_name(q, p->algorithm) < 0) {
+        /* A quiche without this controller keeps its default (CUBIC) */
+        php_error_docref(NULL, E_WARNING, "Congestion controller '%s' is not available; using quiche's default", p->algorithm);
+    }
+    quiche_config_set_initial_congestion_window_packets(q, p->initial_cwnd_packets);
+    quiche_config_enable_hystart(q, p->hystart);
+}
+
+/*──── Per-prefix estimates ────*/
+
+typedef struct {
+    uint8_t  prefix[7];                /* /24 of IPv4, /56 of IPv6 */
+    uint8_t  family;                   /* 0: free */
+    uint32_t cwnd_packets;             /* Learned BDP */
+    uint32_t min_rtt_us;
+    uint64_t learned_ms;
+} cc_estimate_t;
+
+static cc_estimate_t cc_cache[QUICPRO_CC_CACHE_SLOTS];
+
+static uint64_t cc_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/* The peer's prefix; an IPv4-mapped IPv6 address (dual-stack listeners) counts as IPv4 */
+static bool cc_prefix(const struct sockaddr *sa, uint8_t prefix[7], uint8_t *family)
+{
+    memset(prefix, 0, 7);
+    if (sa->sa_family == AF_INET) {
+        memcpy(prefix, &((const struct sockaddr_in *)sa)->sin_addr, 3);
+        *family = AF_INET;
+        return true;
+    }
+    if (sa->sa_family == AF_INET6) {
+        const struct in6_addr *a = &((const struct sockaddr_in6 *)sa)->sin6_addr;
+        if (IN6_IS_ADDR_V4MAPPED(a)) {
+            memcpy(prefix, a->s6_addr + 12, 3);
+            *family = AF_INET;
+        } else {
+            memcpy(prefix, a->s6_addr, 7);
+            *family = AF_INET6;
+        }
+        return true;
+    }
+    return false;
+}
+
+static cc_estimate_t *cc_slot(const uint8_t prefix[7], uint8_t family)
+{
+    uint32_t h = 2166136261u ^ family;         /* FNV-1a */
+    for (int i = 0; i < 7; i++) {
+        h = (h ^ prefix[i]) * 16777619u;
+    }
+    return &cc_cache[h % QUICPRO_CC_CACHE_SLOTS];
+}
+
+static const cc_estimate_t *cc_find(const struct sockaddr *peer, uint64_t now)
+{
+    uint8_t prefix[7], family;
+    if (!peer || !cc_prefix(peer, prefix, &family)) {
+        return NULL;
+    }
+    const cc_estimate_t *e = cc_slot(prefix, family);
+    if (e->family != family || memcmp(e->prefix, prefix, sizeof(prefix)) != 0
+        || now - e->learned_ms > QUICPRO_CC_CACHE_TTL_MS) {
+        return NULL;
+    }
+    return e;
+}
+
+void quicpro_cc_warm_start(quiche_config *q, const quicpro_cc_profile_t *p, const struct sockaddr *peer)
+{
+    uint32_t cwnd = p->initial_cwnd_packets;
+    const cc_estimate_t *e = cc_find(peer, cc_now_ms());
+    if (e && e->cwnd_packets > cwnd) {
+        cwnd = MIN(e->cwnd_packets, QUICPRO_CC_WARM_MAX_PACKETS);
+    }
+    quiche_config_set_initial_congestion_window_packets(q, cwnd);
+}
+
+void quicpro_cc_cache_learn(const quicpro_session_t *s)
+{
+    quiche_path_stats ps;
+    uint8_t prefix[7], family;
+    if (!s->conn || s->peer_addr_len == 0 || !quiche_conn_is_established(s->conn)
+        || quiche_conn_path_stats(s->conn, 0, &ps) < 0 || ps.sent < QUICPRO_CC_LEARN_MIN_PACKETS
+        || !cc_prefix((const struct sockaddr *)&s->peer_addr, prefix, &family)) {
+        return;
+    }
+
+    size_t mtu = ps.pmtu ? ps.pmtu : QUICPRO_MAX_PACKET_SIZE;
+    uint64_t bdp = ps.delivery_rate && ps.min_rtt
+        ? ps.delivery_rate * (ps.min_rtt / 1000) / 1000000   /* bytes/s × µs */
+        : (uint64_t)ps.cwnd;
+    uint32_t sample = (uint32_t)MIN(bdp / mtu, (uint64_t)QUICPRO_CC_WARM_MAX_PACKETS);
+    uint32_t floor = (uint32_t)MAX(quicpro_quic_transport_config.cc_min_cwnd_packets, 1);
+    sample = MAX(sample, floor);
+
+    uint64_t now = cc_now_ms();
+    cc_estimate_t *e = cc_slot(prefix, family);
+    bool same = e->family == family && memcmp(e->prefix, prefix, sizeof(prefix)) == 0
+                && now - e->learned_ms <= QUICPRO_CC_CACHE_TTL_MS;
+    /* One connection to a prefix says little about the next: smooth 3:1 */
+    e->cwnd_packets = same ? (3 * e->cwnd_packets + sample) / 4 : sample;
+    e->min_rtt_us = same && e->min_rtt_us ? MIN(e->min_rtt_us, (uint32_t)(ps.min_rtt / 1000)) : (uint32_t)(ps.min_rtt / 1000);
+    e->learned_ms = now;
+    e->family = family;
+    memcpy(e->prefix, prefix, sizeof(prefix));
+}
+
+/*──── PHP ────*/
+
+PHP_FUNCTION(quicpro_cc_peer_estimate)
+{
+    zend_string *ip;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(ip)
+    ZEND_PARSE_PARAMETERS_END();
+
+    struct sockaddr_storage ss;
+    memset(&ss, 0, sizeof(ss));
+    if (inet_pton(AF_INET, ZSTR_VAL(ip), &((struct sockaddr_in *)&ss)->sin_addr) == 1) {
+        ss.ss_family = AF_INET;
+    } else if (inet_pton(AF_INET6, ZSTR_VAL(ip), &((struct sockaddr_in6 *)&ss)->sin6_addr) == 1) {
+        ss.ss_family = AF_INET6;
+    } else {
+        zend_argument_value_error(1, "must be an IPv4 or IPv6 address");
+        RETURN_THROWS();
+    }
+
+    uint64_t now = cc_now_ms();
+    const cc_estimate_t *e = cc_find((const struct sockaddr *)&ss, now);
+    if (!e) {
+        RETURN_NULL();
+    }
+    array_init(return_value);
+    add_assoc_long(return_value, "cwnd_packets", (zend_long)e->cwnd_packets);
+    add_assoc_long(return_value, "min_rtt_us", (zend_long)e->min_rtt_us);
+    add_assoc_long(return_value, "age_ms", (zend_long)(now - e->learned_ms));
+}
@@ -0,0 +1,285 @@
+/*
+ * conn_snapshot.c  –  Connection snapshots for crash recovery
+ * -----------------------------------------------------------
+ *
+ * One MAP_SHARED anonymous mapping:
+ *
+ *   header   reset key, capacity, interval
+ *   regions  nslots x 2 parities x { count, capacity x entry }
+ *
+ * A region has exactly one writer, the worker holding its slot and parity.
+ * The worker writes the entries, then publishes the count. Its replacement
+ * only reads the region once the writer is gone. A crash in the middle of
+ * a write leaves at most some entries torn. A reset sent for a torn entry
+ * carries the token of a connection ID nobody uses, and every client
+ * ignores it.
+ *
+ * The reset token of a connection ID is the first 16 bytes of
+ * HMAC-SHA256(key, cid).
+ */
+
+#include "php_quicpro.h"
+#include "server/conn_snapshot.h"
+#include "client/session.h"
+#include "cluster/cluster_stats.h"
+#include "server/xdp_filter.h"
+
+#include <netinet/in.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#define QP_SNAPSHOT_TOKEN_LEN 16
+/* RFC 9000 10.3: at least 21 bytes to pass for a short-header packet; more gains nothing */
+#define QP_SNAPSHOT_RESET_MIN 21
+#define QP_SNAPSHOT_RESET_MAX 43
+/* Orphans outlive any sensible idle timeout, then the clients have given up anyway */
+#define QP_SNAPSHOT_ORPHAN_TTL_MS 120000
+
+typedef struct {
+    uint8_t cid_len;
+    uint8_t family;                     /* AF_INET (also for v4-mapped peers) or AF_INET6 */
+    uint8_t addr[16];
+    uint8_t cid[QUICHE_MAX_CONN_ID_LEN];
+} quicpro_conn_snapshot_entry_t;
+
+typedef struct {
+    _Alignas(64) _Atomic uint32_t count;
+    quicpro_conn_snapshot_entry_t entries[];
+} quicpro_conn_snapshot_region_t;
+
+typedef struct {
+    uint8_t key[32];
+    uint32_t nregions;
+    uint32_t capacity;
+    uint32_t interval_ms;
+    size_t region_size;
+    _Alignas(64) uint8_t regions[];
+} quicpro_conn_snapshot_map_t;
+
+static quicpro_conn_snapshot_map_t *quicpro_conn_snapshot_map = NULL;
+static size_t quicpro_conn_snapshot_map_size = 0;
+
+/* This worker's region and what it inherited from its predecessor */
+static quicpro_conn_snapshot_region_t *quicpro_conn_snapshot_own = NULL;
+static quicpro_cid_table_t *quicpro_conn_snapshot_orphans = NULL;
+static uint64_t quicpro_conn_snapshot_orphans_until_ms = 0;
+static uint64_t quicpro_conn_snapshot_next_ms = 0;
+
+static inline uint64_t quicpro_conn_snapshot_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static inline quicpro_conn_snapshot_region_t *quicpro_conn_snapshot_region(uint32_t index)
+{
+    return (quicpro_conn_snapshot_region_t *)(quicpro_conn_snapshot_map->regions
+                                              + (size_t)index * quicpro_conn_snapshot_map->region_size);
+}
+
+/* The family and address bytes of `peer`; false for anything but IPv4 and IPv6 */
+static bool quicpro_conn_snapshot_addr(const struct sockaddr *peer, uint8_t *family, uint8_t addr[16])
+{
+    memset(addr, 0, 16);
+    if (peer->sa_family == AF_INET) {
+        *family = AF_INET;
+        memcpy(addr, &((const struct sockaddr_in *)peer)->sin_addr, 4);
+        return true;
+    }
+    if (peer->sa_family == AF_INET6) {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)peer;
+        if (IN6_IS_ADDR_V4MAPPED(&in6->sin6_addr)) {
+            *family = AF_INET;
+            memcpy(addr, in6->sin6_addr.s6_addr + 12, 4);
+        } else {
+            *family = AF_INET6;
+            memcpy(addr, in6->sin6_addr.s6_addr, 16);
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool quicpro_conn_snapshot_token(const uint8_t *cid, size_t cid_len, uint8_t token[QP_SNAPSHOT_TOKEN_LEN])
+{
+    uint8_t mac[EVP_MAX_MD_SIZE];
+    unsigned int mac_len = 0;
+    if (!HMAC(EVP_sha256(), quicpro_conn_snapshot_map->key, sizeof(quicpro_conn_snapshot_map->key),
+              cid, cid_len, mac, &mac_len)) {
+        return false;
+    }
+    memcpy(token, mac, QP_SNAPSHOT_TOKEN_LEN);
+    return true;
+}
+
+/*──────────────────────────── Lifecycle ──────────────────────────────────*/
+
+void quicpro_conn_snapshot_prepare(int nslots, int capacity, int interval_ms)
+{
+    if (quicpro_conn_snapshot_map || nslots <= 0 || capacity <= 0) {
+        return;
+    }
+
+    size_t region_size = sizeof(quicpro_conn_snapshot_region_t) + (size_t)capacity * sizeof(quicpro_conn_snapshot_entry_t);
+    region_size = (region_size + 63) & ~(size_t)63;
+    size_t size = sizeof(quicpro_conn_snapshot_map_t) + (size_t)nslots * 2 * region_size;
+
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED) {
+        php_error_docref(NULL, E_WARNING, "Connection snapshots unavailable (%zu bytes); a crashed worker's clients wait for their idle timeout", size);
+        return;
+    }
+
+    quicpro_conn_snapshot_map_t *m = mem;
+    if (quicpro_cid_random_bytes(m->key, sizeof(m->key)) < 0) {
+        munmap(mem, size);
+        return;
+    }
+    m->nregions = (uint32_t)nslots * 2;
+    m->capacity = (uint32_t)capacity;
+    m->interval_ms = (uint32_t)(interval_ms > 0 ? interval_ms : 1);
+    m->region_size = region_size;
+
+    quicpro_conn_snapshot_map = m;
+    quicpro_conn_snapshot_map_size = size;
+}
+
+void quicpro_conn_snapshot_release(void)
+{
+    quicpro_cid_table_free(quicpro_conn_snapshot_orphans);
+    quicpro_conn_snapshot_orphans = NULL;
+    quicpro_conn_snapshot_own = NULL;
+    if (quicpro_conn_snapshot_map) {
+        munmap(quicpro_conn_snapshot_map, quicpro_conn_snapshot_map_size);
+        quicpro_conn_snapshot_map = NULL;
+        quicpro_conn_snapshot_map_size = 0;
+    }
+}
+
+static void quicpro_conn_snapshot_orphan_dtor(void *value)
+{
+    pefree(value, 1);
+}
+
+void quicpro_conn_snapshot_attach_worker(int worker_id, unsigned generation)
+{
+    if (!quicpro_conn_snapshot_map || worker_id < 0) {
+        return;
+    }
+    uint32_t index = (uint32_t)worker_id * 2 + (generation & 1);
+    if (index >= quicpro_conn_snapshot_map->nregions) {
+        return;
+    }
+    quicpro_conn_snapshot_region_t *r = quicpro_conn_snapshot_region(index);
+    quicpro_conn_snapshot_own = r;
+
+    uint32_t count = atomic_load_explicit(&r->count, memory_order_acquire);
+    if (count > quicpro_conn_snapshot_map->capacity) {
+        count = quicpro_conn_snapshot_map->capacity;
+    }
+    if (count > 0) {
+        quicpro_conn_snapshot_orphans = quicpro_cid_table_new(count, quicpro_conn_snapshot_orphan_dtor);
+        for (uint32_t i = 0; quicpro_conn_snapshot_orphans && i < count; ++i) {
+            const quicpro_conn_snapshot_entry_t *e = &r->entries[i];
+            if (e->cid_len == 0 || e->cid_len > QUICHE_MAX_CONN_ID_LEN) {
+                continue;
+            }
+            quicpro_conn_snapshot_entry_t *copy = pemalloc(sizeof(*copy), 1);
+            *copy = *e;
+            if (!quicpro_cid_table_add(quicpro_conn_snapshot_orphans, copy->cid, copy->cid_len, copy)) {
+                pefree(copy, 1);
+            }
+        }
+        quicpro_conn_snapshot_orphans_until_ms = quicpro_conn_snapshot_now_ms() + QP_SNAPSHOT_ORPHAN_TTL_MS;
+    }
+    atomic_store_explicit(&r->count, 0, memory_order_release);
+    quicpro_conn_snapshot_next_ms = 0;
+}
+
+/*──────────────────────────── Connections ────────────────────────────────*/
+
+void quicpro_conn_snapshot_advertise(quiche_config *config, const uint8_t *scid, size_t scid_len)
+{
+    uint8_t token[QP_SNAPSHOT_TOKEN_LEN];
+    if (quicpro_conn_snapshot_own && quicpro_conn_snapshot_token(scid, scid_len, token)) {
+        quiche_config_set_stateless_reset_token(config, token);
+    }
+}
+
+bool quicpro_conn_snapshot_reset(int fd, const uint8_t *pkt, size_t len, const uint8_t *dcid, size_t dcid_len,
+                                 const struct sockaddr *peer, socklen_t peer_len)
+{
+    if (!quicpro_conn_snapshot_orphans || len == 0 || (pkt[0] & 0x80)) {
+        return false;   /* Long headers belong to handshakes, which the normal path handles */
+    }
+    quicpro_conn_snapshot_entry_t *orphan = quicpro_cid_table_find(quicpro_conn_snapshot_orphans, dcid, dcid_len);
+    uint8_t family, addr[16];
+    if (!orphan || !quicpro_conn_snapshot_addr(peer, &family, addr)
+        || family != orphan->family || memcmp(addr, orphan->addr, 16) != 0) {
+        return false;
+    }
+
+    /* Shorter than the trigger, so two endpoints resetting each other always run out of bytes */
+    size_t n = len - 1 < QP_SNAPSHOT_RESET_MAX ? len - 1 : QP_SNAPSHOT_RESET_MAX;
+    uint8_t out[QP_SNAPSHOT_RESET_MAX];
+    if (n >= QP_SNAPSHOT_RESET_MIN
+        && quicpro_cid_random_bytes(out, n - QP_SNAPSHOT_TOKEN_LEN) == 0
+        && quicpro_conn_snapshot_token(dcid, dcid_len, out + n - QP_SNAPSHOT_TOKEN_LEN)) {
+        out[0] = (out[0] & 0x3f) | 0x40;   /* Short header, fixed bit set */
+        if (sendto(fd, out, n, 0, peer, peer_len) == (ssize_t)n) {
+            QUICPRO_WORKER_STAT(stateless_resets);
+        }
+    }
+    /* One reset per connection; a lost one costs that client its idle timeout, as before */
+    quicpro_cid_table_del(quicpro_conn_snapshot_orphans, dcid, dcid_len);
+    quicpro_xdp_filter_cid_del(dcid, dcid_len);   /* Its crashed owner never removed it */
+    return true;
+}
+
+void quicpro_conn_snapshot_tick(const quicpro_cid_table_t *sessions_by_scid)
+{
+    quicpro_conn_snapshot_region_t *r = quicpro_conn_snapshot_own;
+    if (!r) {
+        return;
+    }
+    uint64_t now = quicpro_conn_snapshot_now_ms();
+    if (now < quicpro_conn_snapshot_next_ms) {
+        return;
+    }
+    quicpro_conn_snapshot_next_ms = now + quicpro_conn_snapshot_map->interval_ms;
+
+    if (quicpro_conn_snapshot_orphans && now >= quicpro_conn_snapshot_orphans_until_ms) {
+        quicpro_cid_table_free(quicpro_conn_snapshot_orphans);
+        quicpro_conn_snapshot_orphans = NULL;
+    }
+
+    const uint8_t *cid;
+    size_t cid_len, pos = 0;
+    uint32_t count = 0;
+    quicpro_session_t *session;
+    while (count < quicpro_conn_snapshot_map->capacity
+           && (session = quicpro_cid_table_next(sessions_by_scid, &pos, &cid, &cid_len))) {
+        quicpro_conn_snapshot_entry_t *e = &r->entries[count];
+        if (cid_len > QUICHE_MAX_CONN_ID_LEN
+            || !quicpro_conn_snapshot_addr((const struct sockaddr *)&session->peer_addr, &e->family, e->addr)) {
+            continue;
+        }
+        e->cid_len = (uint8_t)cid_len;
+        memcpy(e->cid, cid, cid_len);
+        count++;
+    }
+    atomic_store_explicit(&r->count, count, memory_order_release);
+}
+
+void quicpro_conn_snapshot_clear(void)
+{
+    if (quicpro_conn_snapshot_own) {
+        atomic_store_explicit(&quicpro_conn_snapshot_own->count, 0, memory_order_release);
+    }
+}
@@ -0,0 +1,154 @@
+/*
+ * src/server/conn_stats.c – Transport stats of every connection at once
+ * =====================================================================
+ *
+ * See include/server/conn_stats.h. Every column is a packed array filled
+ * in connection order, so one connection costs a few zvals and no hash
+ * table of its own. Only 'scid' and 'peer' allocate a string.
+ */
+
+#include "php_quicpro.h"
+#include "server/conn_stats.h"
+#include "server/io_thread.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+
+/* The listener running in this process, see quicpro_conn_stats_bind() */
+static const quicpro_cid_table_t *quicpro_conn_stats_sessions = NULL;
+
+#define QP_CONN_STATS_COLUMNS(X) \
+    X(scid, "scid") X(peer, "peer") \
+    X(rtt, "rtt_ns") X(min_rtt, "min_rtt_ns") X(rttvar, "rttvar_ns") \
+    X(cwnd, "cwnd") X(delivery_rate, "delivery_rate") X(pmtu, "pmtu") \
+    X(pkt_rx, "pkt_rx") X(pkt_tx, "pkt_tx") X(lost, "lost") X(retrans, "retrans") \
+    X(bytes_rx, "bytes_rx") X(bytes_tx, "bytes_tx") X(bytes_lost, "bytes_lost") \
+    X(streams_readable, "streams_readable") X(streams_writable, "streams_writable") \
+    X(established, "established")
+
+/* Streams an iterator from quiche_conn_readable() / _writable() yields; frees it */
+static zend_long quicpro_conn_stats_count_streams(quiche_stream_iter *it)
+{
+    zend_long n = 0;
+    uint64_t id;
+    if (!it) {
+        return 0;
+    }
+    while (quiche_stream_iter_next(it, &id)) {
+        n++;
+    }
+    quiche_stream_iter_free(it);
+    return n;
+}
+
+/* "ip:port", "[ip6]:port", or "" for anything else */
+static zend_string *quicpro_conn_stats_peer(const struct sockaddr_storage *ss)
+{
+    char host[INET6_ADDRSTRLEN], out[INET6_ADDRSTRLEN + 8];
+    int n = 0;
+    if (ss->ss_family == AF_INET) {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)ss;
+        inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+        n = snprintf(out, sizeof(out), "%s:%u", host, ntohs(in->sin_port));
+    } else if (ss->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)ss;
+        inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+        n = snprintf(out, sizeof(out), "[%s]:%u", host, ntohs(in6->sin6_port));
+    }
+    return zend_string_init(out, n > 0 ? (size_t)n : 0, 0);
+}
+
+/*──────────────────────────── Columns ────────────────────────────────────*/
+
+void quicpro_conn_stats_begin(quicpro_conn_stats_columns_t *cols, size_t hint)
+{
+#define QP_BEGIN_COLUMN(field, key) \
+    array_init_size(&cols->field, (uint32_t)hint); \
+    zend_hash_real_init_packed(Z_ARRVAL(cols->field));
+    QP_CONN_STATS_COLUMNS(QP_BEGIN_COLUMN)
+#undef QP_BEGIN_COLUMN
+    cols->count = 0;
+}
+
+void quicpro_conn_stats_add(quicpro_conn_stats_columns_t *cols, const quicpro_session_t *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    quiche_stats qs;
+    quiche_path_stats ps;
+    quiche_conn_stats(s->conn, &qs);
+    if (quiche_conn_path_stats(s->conn, 0, &ps) < 0) {
+        memset(&ps, 0, sizeof(ps));
+    }
+
+    const uint8_t *cid = NULL;
+    size_t cid_len = 0;
+    quiche_conn_source_id(s->conn, &cid, &cid_len);
+    zend_string *scid = zend_string_alloc(cid_len * 2, 0);
+    for (size_t i = 0; i < cid_len; ++i) {
+        ZSTR_VAL(scid)[2 * i]     = hex[cid[i] >> 4];
+        ZSTR_VAL(scid)[2 * i + 1] = hex[cid[i] & 0xf];
+    }
+    ZSTR_VAL(scid)[cid_len * 2] = '\0';
+
+    add_next_index_str(&cols->scid, scid);
+    add_next_index_str(&cols->peer, quicpro_conn_stats_peer(&s->peer_addr));
+    add_next_index_long(&cols->rtt,           (zend_long)ps.rtt);
+    add_next_index_long(&cols->min_rtt,       (zend_long)ps.min_rtt);
+    add_next_index_long(&cols->rttvar,        (zend_long)ps.rttvar);
+    add_next_index_long(&cols->cwnd,          (zend_long)ps.cwnd);
+    add_next_index_long(&cols->delivery_rate, (zend_long)ps.delivery_rate);
+    add_next_index_long(&cols->pmtu,          (zend_long)ps.pmtu);
+    add_next_index_long(&cols->pkt_rx,        (zend_long)qs.recv);
+    add_next_index_long(&cols->pkt_tx,        (zend_long)qs.sent);
+    add_next_index_long(&cols->lost,          (zend_long)qs.lost);
+    add_next_index_long(&cols->retrans,       (zend_long)qs.retrans);
+    add_next_index_long(&cols->bytes_rx,      (zend_long)qs.recv_bytes);
+    add_next_index_long(&cols->bytes_tx,      (zend_long)qs.sent_bytes);
+    add_next_index_long(&cols->bytes_lost,    (zend_long)qs.lost_bytes);
+    add_next_index_long(&cols->streams_readable, quicpro_conn_stats_count_streams(quiche_conn_readable(s->conn)));
+    add_next_index_long(&cols->streams_writable, quicpro_conn_stats_count_streams(quiche_conn_writable(s->conn)));
+    add_next_index_bool(&cols->established, quiche_conn_is_established(s->conn));
+    cols->count++;
+}
+
+void quicpro_conn_stats_end(zval *rv, quicpro_conn_stats_columns_t *cols)
+{
+    array_init_size(rv, 19);
+    add_assoc_long(rv, "count", cols->count);
+#define QP_END_COLUMN(field, key) \
+    add_assoc_zval_ex(rv, key, sizeof(key) - 1, &cols->field);
+    QP_CONN_STATS_COLUMNS(QP_END_COLUMN)
+#undef QP_END_COLUMN
+}
+
+/*──────────────────────────── Listener ───────────────────────────────────*/
+
+void quicpro_conn_stats_bind(const quicpro_cid_table_t *sessions_by_scid)
+{
+    quicpro_conn_stats_sessions = sessions_by_scid;
+}
+
+PHP_FUNCTION(quicpro_server_connection_stats)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    const quicpro_cid_table_t *t = quicpro_conn_stats_sessions;
+    quicpro_conn_stats_columns_t cols;
+    quicpro_conn_stats_begin(&cols, t ? quicpro_cid_table_count(t) : 0);
+
+    if (t) {
+        const uint8_t *key;
+        size_t key_len, pos = 0;
+        quicpro_session_t *session;
+        while ((session = quicpro_cid_table_next(t, &pos, &key, &key_len))) {
+            quicpro_io_session_acquire(session);
+            if (session->conn && !quiche_conn_is_closed(session->conn)) {
+                quicpro_conn_stats_add(&cols, session);
+            }
+            quicpro_io_session_release(session);
+        }
+    }
+    quicpro_conn_stats_end(return_value, &cols);
+}
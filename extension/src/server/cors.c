@@ -1,106 +1,463 @@
-/**
- * @file extension/src/server/cors.c
- * @brief Implementation of the native CORS request handler.
+/*
+ * src/server/cors.c – Compiled CORS origin policy
+ * ===============================================
  *
- * This file contains the C-level logic for enforcing CORS policies. It is
- * designed to be called early in the request processing chain to handle
- * preflight requests with maximum performance and to ensure security policies
- * are applied before any application logic is executed.
+ * See include/server/cors.h. Origins are matched in lower case; the
+ * default port of the scheme counts as the same origin as no port for
+ * wildcard entries. The header lines of a cached answer are rendered
+ * once, and its nghttp2_nv entries point into those same bytes.
  */
 
 #include <php.h>
-#include <string.h>
 
 #include "server/cors.h"
-#include "session/session.h" // For quicpro_request_t and quicpro_response_t structures
-#include "config/config.h"   // For quicpro_config_t structure
+#include "config/security_and_traffic/base_layer.h"
 
-/**
- * @brief Checks if a given origin string matches the allowed origins policy.
- *
- * This function performs a case-sensitive comparison of the origin against a
- * comma-separated list of allowed origins. It supports the wildcard "*" for
- * public APIs.
- *
- * @param origin The Origin header value from the incoming request.
- * @param allowed_origins A comma-separated string of allowed origins, or "*".
- * @return true if the origin is allowed, false otherwise.
- */
-static bool is_origin_allowed(const char *origin, const char *allowed_origins)
+#include <ctype.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QUICPRO_CORS_CACHE 64           /* Per thread; power of two */
+
+#define QUICPRO_CORS_ALLOW_METHODS "GET, HEAD, POST, PUT, DELETE, PATCH, OPTIONS"
+
+typedef struct {
+    uint64_t hash;                      /* 0: free */
+    char    *origin;
+    size_t   len;
+} quicpro_cors_exact_t;
+
+typedef struct quicpro_cors_node_s {
+    char                       *label;
+    size_t                      label_len;
+    struct quicpro_cors_node_s *children;   /* Sorted by label once compiled */
+    size_t                      child_count;
+    size_t                      child_cap;
+    uint32_t                   *ends;       /* Wildcards ending here: scheme << 16 | port */
+    size_t                      end_count;
+} quicpro_cors_node_t;
+
+struct quicpro_cors_policy_s {
+    uint64_t             id;            /* Tags cache entries; never 0 */
+    bool                 any;
+    bool                 off;           /* No entries at all */
+    quicpro_cors_exact_t *exact;
+    size_t               exact_mask;    /* Capacity - 1 */
+    quicpro_cors_node_t  root;
+};
+
+typedef struct {
+    uint64_t policy_id;                 /* 0: empty */
+    uint64_t key;
+    uint16_t origin_len;
+    uint8_t  method;
+    bool     preflight;
+    char     origin[QUICPRO_CORS_ORIGIN_MAX];
+    quicpro_cors_result_t result;
+    char     h1[QUICPRO_CORS_H1_MAX];
+    nghttp2_nv nv[QUICPRO_CORS_NV_MAX];
+} quicpro_cors_cached_t;
+
+typedef struct {
+    unsigned    https;
+    const char *host;
+    size_t      host_len;
+    unsigned    port;                   /* The scheme's default if none is given */
+} quicpro_cors_origin_t;
+
+static _Atomic uint64_t qp_cors_next_id = 1;
+
+static ZEND_TLS quicpro_cors_policy_t *qp_cors_base;
+static ZEND_TLS const quicpro_cors_policy_t *qp_cors_current;
+static ZEND_TLS quicpro_cors_cached_t qp_cors_cache[QUICPRO_CORS_CACHE];
+
+/*──────────────────────────── Parsing ────────────────────────────────────*/
+
+static uint64_t qp_cors_hash(const char *p, size_t len)
 {
-    if (!origin || !allowed_origins) {
+    uint64_t h = 0xcbf29ce484222325ull;     /* FNV-1a */
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)p[i]) * 0x100000001b3ull;
+    }
+    return h ? h : 1;
+}
+
+/* Splits a lower-case origin; `wildcard` accepts a leading "*." in the host */
+static bool qp_cors_parse(const char *s, size_t len, bool wildcard, quicpro_cors_origin_t *o)
+{
+    if (len > 8 && memcmp(s, "https://", 8) == 0) {
+        o->https = 1;
+        s += 8; len -= 8;
+    } else if (len > 7 && memcmp(s, "http://", 7) == 0) {
+        o->https = 0;
+        s += 7; len -= 7;
+    } else {
         return false;
     }
+    if (wildcard) {
+        if (len < 3 || s[0] != '*' || s[1] != '.') {
+            return false;
+        }
+        s += 2; len -= 2;
+    }
 
-    if (strcmp(allowed_origins, "*") == 0) {
-        return true;
+    size_t i = 0;
+    if (s[0] == '[') {
+        while (i < len && s[i] != ']') {
+            if (!(isxdigit((unsigned char)s[i]) || s[i] == ':' || s[i] == '.' || i == 0)) return false;
+            i++;
+        }
+        if (i == len || wildcard) return false;
+        i++;
+    } else {
+        while (i < len && s[i] != ':') {
+            char c = s[i];
+            if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '.')) return false;
+            if (c == '.' && (i == 0 || s[i - 1] == '.')) return false;
+            i++;
+        }
+        if (i == 0 || s[i - 1] == '.') return false;
     }
+    o->host = s;
+    o->host_len = i;
+    o->port = o->https ? 443 : 80;
+    if (i < len) {
+        if (s[i] != ':' || i + 1 == len || len - i - 1 > 5) return false;
+        unsigned port = 0;
+        for (size_t j = i + 1; j < len; j++) {
+            if (s[j] < '0' || s[j] > '9') return false;
+            port = port * 10 + (unsigned)(s[j] - '0');
+        }
+        if (port == 0 || port > 65535) return false;
+        o->port = port;
+    }
+    return true;
+}
 
-    const char *p = allowed_origins;
-    size_t origin_len = strlen(origin);
+/*──────────────────────────── Compiling ──────────────────────────────────*/
 
-    while (*p) {
-        // Skip leading whitespace
-        while (*p == ' ' || *p == '\t') {
-            p++;
+static void qp_cors_node_free(quicpro_cors_node_t *n)
+{
+    for (size_t i = 0; i < n->child_count; i++) {
+        qp_cors_node_free(&n->children[i]);
+    }
+    if (n->children) pefree(n->children, 1);
+    if (n->label) pefree(n->label, 1);
+    if (n->ends) pefree(n->ends, 1);
+}
+
+static quicpro_cors_node_t *qp_cors_node_child(quicpro_cors_node_t *n, const char *label, size_t len)
+{
+    for (size_t i = 0; i < n->child_count; i++) {
+        if (n->children[i].label_len == len && memcmp(n->children[i].label, label, len) == 0) {
+            return &n->children[i];
         }
+    }
+    if (n->child_count == n->child_cap) {
+        n->child_cap = n->child_cap ? n->child_cap * 2 : 4;
+        n->children = perealloc(n->children, n->child_cap * sizeof(*n->children), 1);
+    }
+    quicpro_cors_node_t *c = &n->children[n->child_count++];
+    memset(c, 0, sizeof(*c));
+    c->label = pemalloc(len, 1);
+    memcpy(c->label, label, len);
+    c->label_len = len;
+    return c;
+}
 
-        const char *end = strchr(p, ',');
-        size_t len = (end) ? (size_t)(end - p) : strlen(p);
+static int qp_cors_node_cmp(const void *a, const void *b)
+{
+    const quicpro_cors_node_t *x = a, *y = b;
+    size_t n = x->label_len < y->label_len ? x->label_len : y->label_len;
+    int c = memcmp(x->label, y->label, n);
+    return c ? c : (x->label_len > y->label_len) - (x->label_len < y->label_len);
+}
 
-        // Trim trailing whitespace from the policy entry
-        while (len > 0 && (p[len - 1] == ' ' || p[len - 1] == '\t')) {
-            len--;
-        }
+static void qp_cors_node_sort(quicpro_cors_node_t *n)
+{
+    qsort(n->children, n->child_count, sizeof(*n->children), qp_cors_node_cmp);
+    for (size_t i = 0; i < n->child_count; i++) {
+        qp_cors_node_sort(&n->children[i]);
+    }
+}
 
-        if (len == origin_len && strncmp(origin, p, len) == 0) {
-            return true;
+static void qp_cors_add_wildcard(quicpro_cors_policy_t *p, const quicpro_cors_origin_t *o)
+{
+    quicpro_cors_node_t *n = &p->root;
+    const char *end = o->host + o->host_len;
+    while (end > o->host) {
+        const char *dot = end;
+        while (dot > o->host && dot[-1] != '.') dot--;
+        n = qp_cors_node_child(n, dot, (size_t)(end - dot));
+        end = dot > o->host ? dot - 1 : dot;
+    }
+    uint32_t key = o->https << 16 | o->port;
+    for (size_t i = 0; i < n->end_count; i++) {
+        if (n->ends[i] == key) return;
+    }
+    n->ends = perealloc(n->ends, (n->end_count + 1) * sizeof(*n->ends), 1);
+    n->ends[n->end_count++] = key;
+}
+
+static void qp_cors_add_exact(quicpro_cors_policy_t *p, const char *origin, size_t len)
+{
+    uint64_t h = qp_cors_hash(origin, len);
+    for (size_t i = h & p->exact_mask;; i = (i + 1) & p->exact_mask) {
+        quicpro_cors_exact_t *e = &p->exact[i];
+        if (!e->hash) {
+            e->hash = h;
+            e->origin = pemalloc(len, 1);
+            memcpy(e->origin, origin, len);
+            e->len = len;
+            return;
+        }
+        if (e->hash == h && e->len == len && memcmp(e->origin, origin, len) == 0) {
+            return;
         }
+    }
+}
+
+/* One trimmed, lower-cased entry into `buf`; its length, 0 if empty */
+static size_t qp_cors_entry(const char *p, size_t len, char *buf, size_t cap)
+{
+    while (len && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) { p++; len--; }
+    while (len && (p[len - 1] == ' ' || p[len - 1] == '\t' || p[len - 1] == '\r' || p[len - 1] == '\n')) len--;
+    if (len >= cap) {
+        return cap;     /* Too long to be an origin */
+    }
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (char)tolower((unsigned char)p[i]);
+    }
+    return len;
+}
 
-        if (!end) {
-            break;
+quicpro_cors_policy_t *quicpro_cors_compile(const char *origins)
+{
+    quicpro_cors_policy_t *p = pecalloc(1, sizeof(*p), 1);
+    p->id = atomic_fetch_add(&qp_cors_next_id, 1);
+
+    size_t entries = 1;
+    for (const char *c = origins; *c; c++) {
+        entries += *c == ',';
+    }
+    size_t cap = 4;
+    while (cap < entries * 2) cap <<= 1;
+    p->exact = pecalloc(cap, sizeof(*p->exact), 1);
+    p->exact_mask = cap - 1;
+
+    bool any_entry = false;
+    const char *s = origins;
+    for (;;) {
+        const char *comma = strchr(s, ',');
+        size_t raw = comma ? (size_t)(comma - s) : strlen(s);
+        char buf[QUICPRO_CORS_ORIGIN_MAX];
+        size_t len = qp_cors_entry(s, raw, buf, sizeof(buf));
+        if (len == sizeof(buf)) {
+            quicpro_cors_policy_free(p);
+            return NULL;
         }
-        p = end + 1;
+        if (len) {
+            quicpro_cors_origin_t o;
+            any_entry = true;
+            if (len == 1 && buf[0] == '*') {
+                p->any = true;
+            } else if (qp_cors_parse(buf, len, true, &o)) {
+                qp_cors_add_wildcard(p, &o);
+            } else if (qp_cors_parse(buf, len, false, &o)) {
+                qp_cors_add_exact(p, buf, len);
+            } else {
+                quicpro_cors_policy_free(p);
+                return NULL;
+            }
+        }
+        if (!comma) break;
+        s = comma + 1;
+    }
+    p->off = !any_entry;
+    qp_cors_node_sort(&p->root);
+    return p;
+}
+
+void quicpro_cors_policy_free(quicpro_cors_policy_t *p)
+{
+    if (!p) {
+        return;
+    }
+    for (size_t i = 0; i <= p->exact_mask; i++) {
+        if (p->exact[i].origin) pefree(p->exact[i].origin, 1);
+    }
+    pefree(p->exact, 1);
+    qp_cors_node_free(&p->root);
+    pefree(p, 1);
+}
+
+/*──────────────────────────── Matching ───────────────────────────────────*/
+
+static const quicpro_cors_node_t *qp_cors_node_find(const quicpro_cors_node_t *n, const char *label, size_t len)
+{
+    size_t lo = 0, hi = n->child_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        const quicpro_cors_node_t *c = &n->children[mid];
+        size_t m = c->label_len < len ? c->label_len : len;
+        int cmp = memcmp(c->label, label, m);
+        if (!cmp) cmp = (c->label_len > len) - (c->label_len < len);
+        if (!cmp) return c;
+        if (cmp < 0) lo = mid + 1; else hi = mid;
     }
+    return NULL;
+}
 
+static bool qp_cors_match_wildcard(const quicpro_cors_policy_t *p, const quicpro_cors_origin_t *o)
+{
+    uint32_t key = o->https << 16 | o->port;
+    const quicpro_cors_node_t *n = &p->root;
+    const char *end = o->host + o->host_len;
+    while (end > o->host) {
+        const char *dot = end;
+        while (dot > o->host && dot[-1] != '.') dot--;
+        n = qp_cors_node_find(n, dot, (size_t)(end - dot));
+        if (!n || dot == o->host) {
+            return false;   /* A wildcard needs a label below its domain */
+        }
+        for (size_t i = 0; i < n->end_count; i++) {
+            if (n->ends[i] == key) return true;
+        }
+        end = dot - 1;
+    }
     return false;
 }
 
-/**
- * @brief (Internal) Applies the configured CORS policy to an incoming request.
- *
- * This is the core internal function called by the server's event loop. It
- * checks the Origin header, validates it, and handles preflight requests.
- */
-int quicpro_internal_handle_cors(quicpro_request_t *req, quicpro_response_t *resp, quicpro_config_t *config)
+static bool qp_cors_match_exact(const quicpro_cors_policy_t *p, const char *origin, size_t len, uint64_t h)
 {
-    const char *origin = quicpro_request_get_header(req, "origin");
-    if (!origin) {
-        // This is not a CORS request.
-        return CORS_REQUEST_OK;
+    for (size_t i = h & p->exact_mask;; i = (i + 1) & p->exact_mask) {
+        const quicpro_cors_exact_t *e = &p->exact[i];
+        if (!e->hash) return false;
+        if (e->hash == h && e->len == len && memcmp(e->origin, origin, len) == 0) return true;
     }
+}
 
-    if (!config->cors_allowed_origins || !is_origin_allowed(origin, config->cors_allowed_origins)) {
-        // The origin is not in the allowlist.
-        return CORS_REQUEST_FORBIDDEN;
+bool quicpro_cors_policy_allows(const quicpro_cors_policy_t *p, const char *origin, size_t origin_len)
+{
+    quicpro_cors_origin_t o;
+    if (p->any) {
+        return true;
     }
+    if (qp_cors_match_exact(p, origin, origin_len, qp_cors_hash(origin, origin_len))) {
+        return true;
+    }
+    return p->root.child_count && qp_cors_parse(origin, origin_len, false, &o) && qp_cors_match_wildcard(p, &o);
+}
 
-    // The origin is allowed. Always add the Access-Control-Allow-Origin header.
-    quicpro_response_add_header(resp, "Access-Control-Allow-Origin", origin);
-    // Vary header is important for caching proxies to cache responses correctly.
-    quicpro_response_add_header(resp, "Vary", "Origin");
+/*──────────────────────────── Listener threads ───────────────────────────*/
 
-    // Handle the OPTIONS preflight request.
-    if (strcmp(quicpro_request_get_method(req), "OPTIONS") == 0) {
-        quicpro_response_set_status(resp, 204); // No Content
+void quicpro_cors_enter(void)
+{
+    quicpro_cors_leave();
+    const char *origins = quicpro_security_config.cors_allowed_origins;
+    if (origins) {
+        qp_cors_base = quicpro_cors_compile(origins);
+        if (!qp_cors_base) {
+            php_error_docref(NULL, E_WARNING, "security_cors_allowed_origins has an entry that is no origin; CORS is left to the handler");
+        }
+    }
+    qp_cors_current = qp_cors_base;
+}
+
+void quicpro_cors_use(const quicpro_cors_policy_t *p)
+{
+    qp_cors_current = p ? p : qp_cors_base;
+}
 
-        // These headers can be made configurable in a future version if needed.
-        quicpro_response_add_header(resp, "Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, PATCH, OPTIONS");
-        quicpro_response_add_header(resp, "Access-Control-Allow-Headers", "*"); // Reflect requested headers in a real implementation
-        quicpro_response_add_header(resp, "Access-Control-Max-Age", "86400"); // 24 hours
+void quicpro_cors_leave(void)
+{
+    quicpro_cors_policy_free(qp_cors_base);
+    qp_cors_base = NULL;
+    qp_cors_current = NULL;
+    memset(qp_cors_cache, 0, sizeof(qp_cors_cache));
+}
 
-        return CORS_PREFLIGHT_HANDLED;
+/* 1..7 for the methods a preflight may ask for; 0 for any other */
+static uint8_t qp_cors_method(const char *m, size_t len)
+{
+    static const struct { const char *name; size_t len; } known[] = {
+        { "GET", 3 }, { "HEAD", 4 }, { "POST", 4 }, { "PUT", 3 },
+        { "DELETE", 6 }, { "PATCH", 5 }, { "OPTIONS", 7 }
+    };
+    for (uint8_t i = 0; i < sizeof(known) / sizeof(known[0]); i++) {
+        if (known[i].len == len && memcmp(known[i].name, m, len) == 0) return i + 1;
     }
+    return 0;
+}
+
+static void qp_cors_line(quicpro_cors_cached_t *e, const char *name, size_t name_len, const char *value, size_t value_len)
+{
+    char *at = e->h1 + e->result.h1_len;
+    memcpy(at, name, name_len);
+    memcpy(at + name_len, ": ", 2);
+    memcpy(at + name_len + 2, value, value_len);
+    memcpy(at + name_len + 2 + value_len, "\r\n", 2);
+    e->nv[e->result.nv_count++] = (nghttp2_nv){ (uint8_t *)at, (uint8_t *)at + name_len + 2, name_len, value_len, NGHTTP2_NV_FLAG_NONE };
+    e->result.h1_len += name_len + value_len + 4;
+}
+#define QP_CORS_LINE(e, name, value, value_len) qp_cors_line(e, name, sizeof(name) - 1, value, value_len)
 
-    return CORS_REQUEST_OK;
+/* Decides and renders the answer for the key `e` holds */
+static void qp_cors_render(quicpro_cors_cached_t *e, const quicpro_cors_policy_t *p)
+{
+    e->result.h1 = e->h1;
+    e->result.h1_len = 0;
+    e->result.nv = e->nv;
+    e->result.nv_count = 0;
+
+    if (!quicpro_cors_policy_allows(p, e->origin, e->origin_len)
+        || (e->preflight && !e->method)) {
+        e->result.verdict = e->preflight ? QUICPRO_CORS_PREFLIGHT_DENIED : QUICPRO_CORS_NONE;
+        return;
+    }
+    e->result.verdict = e->preflight ? QUICPRO_CORS_PREFLIGHT : QUICPRO_CORS_ALLOW;
+    if (p->any) {
+        QP_CORS_LINE(e, "access-control-allow-origin", "*", 1);
+    } else {
+        QP_CORS_LINE(e, "access-control-allow-origin", e->origin, e->origin_len);
+        QP_CORS_LINE(e, "vary", "Origin", 6);
+    }
+    if (e->preflight) {
+        QP_CORS_LINE(e, "access-control-allow-methods", QUICPRO_CORS_ALLOW_METHODS, sizeof(QUICPRO_CORS_ALLOW_METHODS) - 1);
+        QP_CORS_LINE(e, "access-control-allow-headers", "*", 1);
+        QP_CORS_LINE(e, "access-control-max-age", "86400", 5);
+    }
+}
+
+const quicpro_cors_result_t *quicpro_cors_check(const char *origin, size_t origin_len,
+                                                const char *method, size_t method_len, bool preflight)
+{
+    static const quicpro_cors_result_t none = { QUICPRO_CORS_NONE, NULL, 0, NULL, 0 };
+    const quicpro_cors_policy_t *p = qp_cors_current;
+    if (!p || p->off || origin_len == 0 || origin_len >= QUICPRO_CORS_ORIGIN_MAX) {
+        return &none;   /* Off, or no origin this policy could list */
+    }
+
+    char lower[QUICPRO_CORS_ORIGIN_MAX];
+    for (size_t i = 0; i < origin_len; i++) {
+        lower[i] = (char)tolower((unsigned char)origin[i]);
+    }
+    /* Only a preflight's answer depends on the method */
+    uint8_t m = preflight ? qp_cors_method(method, method_len) : 0;
+    uint64_t key = qp_cors_hash(lower, origin_len) ^ ((uint64_t)m << 56) ^ ((uint64_t)preflight << 63);
+
+    quicpro_cors_cached_t *e = &qp_cors_cache[key & (QUICPRO_CORS_CACHE - 1)];
+    if (e->policy_id == p->id && e->key == key && e->method == m && e->preflight == preflight
+        && e->origin_len == origin_len && memcmp(e->origin, lower, origin_len) == 0) {
+        return &e->result;
+    }
+    e->policy_id = p->id;
+    e->key = key;
+    e->method = m;
+    e->preflight = preflight;
+    e->origin_len = (uint16_t)origin_len;
+    memcpy(e->origin, lower, origin_len);
+    qp_cors_render(e, p);
+    return &e->result;
 }
@@ -10,8 +10,10 @@
 #include <php.h>
 #include <zend_exceptions.h>
 #include <zend_hash.h>
+#include <string.h>
 
 #include "server/early_hints.h"
+#include "server/header_template.h"
 #include "session/session.h" // For quicpro_session_t and stream management
 #include "quiche.h"
 
@@ -21,12 +23,13 @@ PHP_FUNCTION(quicpro_server_send_early_hints)
 {
     zval *session_resource;
     zend_long stream_id;
-    zval *hints_array;
+    HashTable *ht;
+    zend_string *template_name;
 
     ZEND_PARSE_PARAMETERS_START(3, 3)
         Z_PARAM_RESOURCE(session_resource)
         Z_PARAM_LONG(stream_id)
-        Z_PARAM_ARRAY(hints_array)
+        Z_PARAM_ARRAY_HT_OR_STR(ht, template_name)
     ZEND_PARSE_PARAMETERS_END();
 
     quicpro_session_t *session = (quicpro_session_t *)zend_fetch_resource(Z_RES_P(session_resource), "quicpro_session", le_quicpro_session);
@@ -51,10 +54,20 @@ PHP_FUNCTION(quicpro_server_send_early_hints)
         RETURN_FALSE;
     }
 
-    HashTable *ht = Z_ARRVAL_P(hints_array);
+    // A template name sends the template's pre-built headers (typically
+    // its link: preload entries) without converting anything per call.
+    const quicpro_header_template_t *tmpl = NULL;
+    if (template_name) {
+        tmpl = quicpro_header_template_find(ZSTR_VAL(template_name), ZSTR_LEN(template_name));
+        if (!tmpl) {
+            zend_throw_exception_ex(NULL, 0, "Header template '%s' is not registered.", ZSTR_VAL(template_name));
+            RETURN_FALSE;
+        }
+    }
+
     zval *entry;
     // We need one extra header for the ":status" pseudo-header.
-    int header_count = zend_hash_num_elements(ht) + 1;
+    int header_count = (tmpl ? (int)tmpl->count : (int)zend_hash_num_elements(ht)) + 1;
 
     if (header_count <= 1) {
         RETURN_TRUE; // Nothing to send.
@@ -70,24 +83,29 @@ PHP_FUNCTION(quicpro_server_send_early_hints)
 
     int i = 1; // Start populating from the second element.
 
-    ZEND_HASH_FOREACH_VAL(ht, entry) {
-        if (Z_TYPE_P(entry) != IS_ARRAY || zend_hash_num_elements(Z_ARRVAL_P(entry)) != 2) {
-            continue; // Each entry must be a [key, value] pair.
-        }
-
-        zval *header_name_zv = zend_hash_index_find(Z_ARRVAL_P(entry), 0);
-        zval *header_value_zv = zend_hash_index_find(Z_ARRVAL_P(entry), 1);
-
-        if (header_name_zv && header_value_zv &&
-            Z_TYPE_P(header_name_zv) == IS_STRING && Z_TYPE_P(header_value_zv) == IS_STRING)
-        {
-            headers[i].name = (const uint8_t *)Z_STRVAL_P(header_name_zv);
-            headers[i].name_len = Z_STRLEN_P(header_name_zv);
-            headers[i].value = (const uint8_t *)Z_STRVAL_P(header_value_zv);
-            headers[i].value_len = Z_STRLEN_P(header_value_zv);
-            i++;
-        }
-    } ZEND_HASH_FOREACH_END();
+    if (tmpl) {
+        memcpy(headers + 1, tmpl->h3, tmpl->count * sizeof(quiche_h3_header));
+        i += (int)tmpl->count;
+    } else {
+        ZEND_HASH_FOREACH_VAL(ht, entry) {
+            if (Z_TYPE_P(entry) != IS_ARRAY || zend_hash_num_elements(Z_ARRVAL_P(entry)) != 2) {
+                continue; // Each entry must be a [key, value] pair.
+            }
+
+            zval *header_name_zv = zend_hash_index_find(Z_ARRVAL_P(entry), 0);
+            zval *header_value_zv = zend_hash_index_find(Z_ARRVAL_P(entry), 1);
+
+            if (header_name_zv && header_value_zv &&
+                Z_TYPE_P(header_name_zv) == IS_STRING && Z_TYPE_P(header_value_zv) == IS_STRING)
+            {
+                headers[i].name = (const uint8_t *)Z_STRVAL_P(header_name_zv);
+                headers[i].name_len = Z_STRLEN_P(header_name_zv);
+                headers[i].value = (const uint8_t *)Z_STRVAL_P(header_value_zv);
+                headers[i].value_len = Z_STRLEN_P(header_value_zv);
+                i++;
+            }
+        } ZEND_HASH_FOREACH_END();
+    }
 
     // Send the informational response. The `fin` flag must be false.
     ssize_t written = quiche_h3_send_response(
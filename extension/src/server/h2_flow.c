@@ -0,0 +1,99 @@
+/*
+ * h2_flow.c  –  BDP-driven HTTP/2 receive windows for php-quicpro
+ * ----------------------------------------------------------------
+ *
+ * See include/server/h2_flow.h. Our PINGs carry "QPBD" and a sequence
+ * number, so a PING the peer sent, or the ACK of an abandoned probe, never
+ * completes a sample.
+ */
+
+#include "php_quicpro.h"
+
+#ifdef QUICPRO_HAVE_NGHTTP2
+
+#include "server/h2_flow.h"
+#include "config/http2/base_layer.h"
+
+#include <string.h>
+#include <time.h>
+
+static uint64_t h2_flow_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static int32_t h2_flow_cap(void)
+{
+    return (int32_t)MIN(quicpro_http2_config.max_connection_window, (zend_long)NGHTTP2_MAX_WINDOW_SIZE);
+}
+
+static void h2_flow_opaque(uint8_t opaque[8], uint32_t seq)
+{
+    memcpy(opaque, "QPBD", 4);
+    opaque[4] = (uint8_t)(seq >> 24);
+    opaque[5] = (uint8_t)(seq >> 16);
+    opaque[6] = (uint8_t)(seq >> 8);
+    opaque[7] = (uint8_t)seq;
+}
+
+void quicpro_h2_flow_init(quicpro_h2_flow_t *f, int32_t window, int32_t conn_window)
+{
+    memset(f, 0, sizeof(*f));
+    f->window = window;
+    f->conn_window = conn_window;
+}
+
+void quicpro_h2_flow_on_data(quicpro_h2_flow_t *f, nghttp2_session *session, size_t len)
+{
+    if (f->probe_sent_us) {
+        f->probe_bytes += len;
+        return;
+    }
+    if (!quicpro_http2_config.window_autotune_enable || f->window >= h2_flow_cap()) {
+        return;
+    }
+    /* Bytes before the PING were sent a round trip earlier; the sample starts empty */
+    uint8_t opaque[8];
+    h2_flow_opaque(opaque, ++f->seq);
+    if (nghttp2_submit_ping(session, NGHTTP2_FLAG_NONE, opaque) == 0) {
+        f->probe_sent_us = h2_flow_now_us();
+        f->probe_bytes = 0;
+    }
+}
+
+bool quicpro_h2_flow_on_frame(quicpro_h2_flow_t *f, nghttp2_session *session, const nghttp2_frame *frame)
+{
+    if (frame->hd.type != NGHTTP2_PING || !(frame->hd.flags & NGHTTP2_FLAG_ACK) || !f->probe_sent_us) {
+        return false;
+    }
+    uint8_t opaque[8];
+    h2_flow_opaque(opaque, f->seq);
+    if (memcmp(frame->ping.opaque_data, opaque, sizeof(opaque)) != 0) {
+        return false;
+    }
+
+    /* What the peer delivered in one round trip: limited by the window if it came close */
+    uint64_t bdp = f->probe_bytes;
+    f->probe_sent_us = 0;
+    if (bdp * 3 < (uint64_t)f->window * 2) {
+        return true;
+    }
+    int32_t grown = (int32_t)MIN(bdp * 2, (uint64_t)h2_flow_cap());
+    if (grown <= f->window) {
+        return true;
+    }
+
+    if (grown > f->conn_window
+        && nghttp2_session_set_local_window_size(session, NGHTTP2_FLAG_NONE, 0, grown) == 0) {
+        f->conn_window = grown;
+    }
+    nghttp2_settings_entry iv = { NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, (uint32_t)grown };
+    if (nghttp2_submit_settings(session, NGHTTP2_FLAG_NONE, &iv, 1) == 0) {
+        f->window = grown;
+    }
+    return true;
+}
+
+#endif /* QUICPRO_HAVE_NGHTTP2 */
@@ -0,0 +1,22 @@
+/*
+ * h3_settings.c  –  HTTP/3 SETTINGS for php-quicpro connections
+ * --------------------------------------------------------------
+ *
+ * See include/server/h3_settings.h.
+ */
+
+#include "php_quicpro.h"
+#include "server/h3_settings.h"
+#include "config/app_http3_websockets_webtransport/base_layer.h"
+
+void quicpro_h3_settings_apply(quiche_h3_config *cfg)
+{
+    if (!cfg) {
+        return;
+    }
+    quiche_h3_config_set_max_field_section_size(cfg, (uint64_t)quicpro_app_protocols_config.h3_max_header_list_size);
+
+    /* quiche's decoder has no dynamic table: announce none, so no peer encoder uses one */
+    quiche_h3_config_set_qpack_max_table_capacity(cfg, 0);
+    quiche_h3_config_set_qpack_blocked_streams(cfg, 0);
+}
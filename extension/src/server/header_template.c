@@ -0,0 +1,273 @@
+/*
+ * header_template.c  –  Response header templates and header name interning for php-quicpro
+ * -----------------------------------------------------------------------------------------
+ *
+ * A template's bytes live once, in its HTTP/1 block. The nghttp2 and
+ * quiche arrays point into that block: the name at the start of a line,
+ * the value two bytes after the name. Everything is allocated
+ * persistently and freed at MSHUTDOWN, since a listener's requests may
+ * outlive the PHP request that registered the template.
+ */
+
+#include "php_quicpro.h"
+#include "server/header_template.h"
+
+#include <zend_exceptions.h>
+#include <ext/spl/spl_exceptions.h>
+#include <string.h>
+#include <strings.h>
+
+static HashTable header_names;      /* lower-case name -> interned zend_string */
+static bool      header_names_ready;
+static HashTable templates;         /* name -> quicpro_header_template_t * */
+static bool      templates_ready;
+
+/* HPACK static table names (RFC 7541 Appendix A) and other frequent request headers */
+static const char *const known_header_names[] = {
+    ":authority", ":method", ":path", ":scheme", ":status", ":protocol",
+    "accept", "accept-charset", "accept-encoding", "accept-language", "accept-ranges",
+    "access-control-allow-origin", "access-control-request-headers", "access-control-request-method",
+    "age", "allow", "authorization", "cache-control", "content-disposition", "content-encoding",
+    "content-language", "content-length", "content-location", "content-range", "content-type",
+    "cookie", "date", "dnt", "early-data", "etag", "expect", "expires", "forwarded", "from", "host",
+    "if-match", "if-modified-since", "if-none-match", "if-range", "if-unmodified-since",
+    "last-modified", "link", "location", "max-forwards", "origin", "pragma", "priority",
+    "proxy-authorization", "range", "referer", "refresh", "sec-ch-ua", "sec-ch-ua-mobile",
+    "sec-ch-ua-platform", "sec-fetch-dest", "sec-fetch-mode", "sec-fetch-site", "sec-fetch-user",
+    "sec-websocket-extensions", "sec-websocket-key", "sec-websocket-protocol", "sec-websocket-version",
+    "te", "traceparent", "tracestate", "upgrade-insecure-requests", "user-agent", "via",
+    "x-forwarded-for", "x-forwarded-host", "x-forwarded-proto", "x-real-ip", "x-request-id",
+    "x-requested-with", "connection", "keep-alive", "transfer-encoding", "upgrade",
+};
+
+/* Set by the listeners themselves, or meaningless (HTTP/2, HTTP/3) in a template */
+static const char *const reserved_header_names[] = {
+    "connection", "content-length", "date", "keep-alive", "proxy-connection", "te",
+    "transfer-encoding", "upgrade",
+};
+
+/*──────────────────────────── Name interning ─────────────────────────────*/
+
+void quicpro_header_names_minit(void)
+{
+    zend_hash_init(&header_names, 128, NULL, NULL, 1);
+    for (size_t i = 0; i < sizeof(known_header_names) / sizeof(known_header_names[0]); i++) {
+        zend_string *s = zend_string_init_interned(known_header_names[i], strlen(known_header_names[i]), 1);
+        zend_hash_add_new_ptr(&header_names, s, s);
+    }
+    header_names_ready = true;
+}
+
+zend_string *quicpro_header_name(const char *name, size_t len)
+{
+    char lower[64];
+
+    if (len <= sizeof(lower) && header_names_ready) {
+        for (size_t i = 0; i < len; i++) {
+            lower[i] = zend_tolower_ascii(name[i]);
+        }
+        zend_string *known = zend_hash_str_find_ptr(&header_names, lower, len);
+        if (known) {
+            return known;   /* Interned: copy and release are no-ops */
+        }
+        return zend_string_init(lower, len, 0);
+    }
+    zend_string *s = zend_string_init(name, len, 0);
+    zend_str_tolower(ZSTR_VAL(s), len);
+    return s;
+}
+
+/*──────────────────────────── Validation ─────────────────────────────────*/
+
+static bool is_tchar(unsigned char c)
+{
+    /* RFC 9110 §5.6.2 */
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+        || (c != 0 && strchr("!#$%&'*+-.^_`|~", c) != NULL);
+}
+
+bool quicpro_header_is_sendable(const char *name, size_t name_len, const char *value, size_t value_len)
+{
+    if (name_len == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < name_len; i++) {
+        if (!is_tchar((unsigned char)name[i])) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < value_len; i++) {
+        if (value[i] == '\r' || value[i] == '\n' || value[i] == '\0') {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < sizeof(reserved_header_names) / sizeof(reserved_header_names[0]); i++) {
+        if (strlen(reserved_header_names[i]) == name_len && strncasecmp(reserved_header_names[i], name, name_len) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*──────────────────────────── Registry ───────────────────────────────────*/
+
+static void template_free(quicpro_header_template_t *t)
+{
+    zend_string_release(t->name);
+    pefree(t->nv, 1);
+    pefree(t->h3, 1);
+    pefree(t->h1, 1);
+    pefree(t, 1);
+}
+
+static void template_dtor(zval *zv)
+{
+    template_free(Z_PTR_P(zv));
+}
+
+const quicpro_header_template_t *quicpro_header_template_find(const char *name, size_t len)
+{
+    return templates_ready ? zend_hash_str_find_ptr(&templates, name, len) : NULL;
+}
+
+void quicpro_header_templates_mshutdown(void)
+{
+    if (templates_ready) {
+        zend_hash_destroy(&templates);
+        templates_ready = false;
+    }
+    if (header_names_ready) {
+        zend_hash_destroy(&header_names);   /* The interned strings go with the interned table */
+        header_names_ready = false;
+    }
+}
+
+/* Calls `fn` for every (name, value) pair; array values repeat the name. */
+typedef bool (*header_pair_fn)(void *ctx, zend_string *name, zend_string *value);
+
+static bool header_pair_one(header_pair_fn fn, void *ctx, zend_string *name, zval *v)
+{
+    zend_string *value = zval_try_get_string(v);
+    if (!value) {
+        return false;
+    }
+    bool ok = fn(ctx, name, value);
+    zend_string_release(value);
+    return ok;
+}
+
+static bool header_pairs_each(HashTable *headers, header_pair_fn fn, void *ctx)
+{
+    zend_string *name;
+    zval *entry, *v;
+
+    ZEND_HASH_FOREACH_STR_KEY_VAL(headers, name, entry) {
+        if (!name) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Header templates are keyed by header name");
+            return false;
+        }
+        if (Z_TYPE_P(entry) != IS_ARRAY) {
+            if (!header_pair_one(fn, ctx, name, entry)) {
+                return false;
+            }
+            continue;
+        }
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(entry), v) {
+            if (!header_pair_one(fn, ctx, name, v)) {
+                return false;
+            }
+        } ZEND_HASH_FOREACH_END();
+    } ZEND_HASH_FOREACH_END();
+    return true;
+}
+
+typedef struct {
+    quicpro_header_template_t *t;
+    size_t                     pos;    /* Into t->h1 while filling */
+} template_build_t;
+
+static bool template_measure(void *ctx, zend_string *name, zend_string *value)
+{
+    template_build_t *b = ctx;
+    if (!quicpro_header_is_sendable(ZSTR_VAL(name), ZSTR_LEN(name), ZSTR_VAL(value), ZSTR_LEN(value))) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Header '%s' cannot be part of a template (invalid characters, or set by the server itself)", ZSTR_VAL(name));
+        return false;
+    }
+    b->t->count++;
+    b->t->h1_len += ZSTR_LEN(name) + 2 + ZSTR_LEN(value) + 2;
+    return true;
+}
+
+static bool template_fill(void *ctx, zend_string *name, zend_string *value)
+{
+    template_build_t *b = ctx;
+    quicpro_header_template_t *t = b->t;
+    size_t i = t->count++;
+    char *line = t->h1 + b->pos;
+
+    for (size_t k = 0; k < ZSTR_LEN(name); k++) {
+        line[k] = zend_tolower_ascii(ZSTR_VAL(name)[k]);   /* Required by HTTP/2 and HTTP/3 */
+    }
+    memcpy(line + ZSTR_LEN(name), ": ", 2);
+    memcpy(line + ZSTR_LEN(name) + 2, ZSTR_VAL(value), ZSTR_LEN(value));
+    memcpy(line + ZSTR_LEN(name) + 2 + ZSTR_LEN(value), "\r\n", 2);
+    b->pos += ZSTR_LEN(name) + 2 + ZSTR_LEN(value) + 2;
+
+    uint8_t *n = (uint8_t *)line, *v = (uint8_t *)line + ZSTR_LEN(name) + 2;
+    t->nv[i] = (nghttp2_nv){ n, v, ZSTR_LEN(name), ZSTR_LEN(value), NGHTTP2_NV_FLAG_NO_COPY_NAME | NGHTTP2_NV_FLAG_NO_COPY_VALUE };
+    t->h3[i] = (quiche_h3_header){ n, ZSTR_LEN(name), v, ZSTR_LEN(value) };
+    if (zend_string_equals_literal_ci(name, "content-type")) {
+        t->has_content_type = true;
+    }
+    return true;
+}
+
+/*
+ * quicpro_header_template_register(string $name, array $headers): bool
+ *
+ * $headers maps header names to a value or a list of values, e.g.
+ * ['content-type' => 'application/json', 'vary' => ['accept', 'origin']].
+ */
+PHP_FUNCTION(quicpro_header_template_register)
+{
+    zend_string *name;
+    HashTable *headers;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_STR(name)
+        Z_PARAM_ARRAY_HT(headers)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (ZSTR_LEN(name) == 0) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "Header template name must not be empty");
+        RETURN_FALSE;
+    }
+    if (quicpro_header_template_find(ZSTR_VAL(name), ZSTR_LEN(name))) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "Header template '%s' is already registered; templates cannot be replaced", ZSTR_VAL(name));
+        RETURN_FALSE;
+    }
+
+    quicpro_header_template_t probe = {0};
+    template_build_t b = { &probe, 0 };
+    if (!header_pairs_each(headers, template_measure, &b)) {
+        RETURN_FALSE;
+    }
+
+    quicpro_header_template_t *t = pecalloc(1, sizeof(*t), 1);
+    t->name = zend_string_init(ZSTR_VAL(name), ZSTR_LEN(name), 1);
+    t->h1_len = probe.h1_len;
+    t->h1 = pemalloc(probe.h1_len ? probe.h1_len : 1, 1);
+    t->nv = pecalloc(probe.count ? probe.count : 1, sizeof(nghttp2_nv), 1);
+    t->h3 = pecalloc(probe.count ? probe.count : 1, sizeof(quiche_h3_header), 1);
+    b.t = t;
+    header_pairs_each(headers, template_fill, &b);   /* Validated above; cannot fail now */
+
+    if (!templates_ready) {
+        zend_hash_init(&templates, 8, NULL, template_dtor, 1);
+        templates_ready = true;
+    }
+    zend_hash_add_new_ptr(&templates, t->name, t);
+    RETURN_TRUE;
+}
@@ -0,0 +1,311 @@
+/*
+ * hint_learner.c  –  Early Hints learned from the listeners' responses
+ * ---------------------------------------------------------------------
+ *
+ * See include/server/hint_learner.h. Routes are keyed by
+ * "authority path". Each keeps its tracked links with the number of
+ * answers they appeared in, and the hinted subset pre-rendered: the
+ * subset only changes when a count crosses the threshold, so rendering
+ * is rare and a lookup is a hash probe.
+ */
+
+#include "php_quicpro.h"
+#include "server/hint_learner.h"
+#include "config/app_http3_websockets_webtransport/base_layer.h"
+
+#include <string.h>
+#include <strings.h>
+#include <zend_smart_str.h>
+
+#define HINTS_MAX_ROUTES     4096
+#define HINTS_MAX_LINKS      8
+#define HINTS_MIN_ANSWERS    3
+#define HINTS_WINDOW         32       /* Counts are halved when a route reaches it */
+#define HINTS_KEY_MAX        1024
+
+typedef struct {
+    zend_string *link;        /* Persistent */
+    uint32_t     seen;        /* Answers that carried it */
+} hint_link_t;
+
+typedef struct {
+    uint32_t                answers;
+    uint32_t                nlinks;
+    hint_link_t             links[HINTS_MAX_LINKS];
+    uint32_t                hinted_mask;  /* Of `links`, what `hints` holds */
+    zend_string            *hinted[HINTS_MAX_LINKS];
+    quicpro_learned_hints_t hints;
+} hint_route_t;
+
+static HashTable hint_routes;
+static bool      hint_routes_ready;
+
+bool quicpro_hint_learner_enabled(void)
+{
+    return quicpro_app_protocols_config.http_enable_early_hints
+        && quicpro_app_protocols_config.http_early_hints_auto;
+}
+
+static size_t hint_key(char *buf, const char *authority, size_t authority_len, const char *path, size_t path_len)
+{
+    const char *query = memchr(path, '?', path_len);
+    if (query) path_len = (size_t)(query - path);
+    if (authority_len + 1 + path_len > HINTS_KEY_MAX) {
+        return 0;
+    }
+    memcpy(buf, authority, authority_len);
+    buf[authority_len] = ' ';
+    memcpy(buf + authority_len + 1, path, path_len);
+    return authority_len + 1 + path_len;
+}
+
+static void hint_route_dtor(zval *zv)
+{
+    hint_route_t *r = Z_PTR_P(zv);
+    for (uint32_t i = 0; i < r->nlinks; i++) {
+        zend_string_release(r->links[i].link);
+    }
+    if (r->hints.h1) zend_string_release(r->hints.h1);
+    pefree(r, 1);
+}
+
+static int hint_route_prune(zval *zv)
+{
+    hint_route_t *r = Z_PTR_P(zv);
+    return r->hints.count == 0 ? ZEND_HASH_APPLY_REMOVE : ZEND_HASH_APPLY_KEEP;
+}
+
+static hint_route_t *hint_route_find(const char *authority, size_t authority_len, const char *path, size_t path_len, bool create)
+{
+    char key[HINTS_KEY_MAX];
+    size_t len = hint_key(key, authority, authority_len, path, path_len);
+    if (!len) {
+        return NULL;
+    }
+    hint_route_t *r = hint_routes_ready ? zend_hash_str_find_ptr(&hint_routes, key, len) : NULL;
+    if (r || !create) {
+        return r;
+    }
+    if (!hint_routes_ready) {
+        zend_hash_init(&hint_routes, 64, NULL, hint_route_dtor, 1);
+        hint_routes_ready = true;
+    }
+    if (zend_hash_num_elements(&hint_routes) >= HINTS_MAX_ROUTES) {
+        // Routes that hint nothing make room; the others keep their counts
+        zend_hash_apply(&hint_routes, hint_route_prune);
+        if (zend_hash_num_elements(&hint_routes) >= HINTS_MAX_ROUTES) {
+            return NULL;
+        }
+    }
+    r = pecalloc(1, sizeof(*r), 1);
+    zend_hash_str_add_ptr(&hint_routes, key, len, r);
+    return r;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Link values                                                                */
+/* ------------------------------------------------------------------------- */
+
+static bool hint_has_token(const char *p, size_t len, const char *token, size_t token_len)
+{
+    for (size_t i = 0; i + token_len <= len; i++) {
+        if (strncasecmp(p + i, token, token_len) == 0) return true;
+    }
+    return false;
+}
+
+// Whether a single link-value is worth sending early: its rel names a
+// fetch the browser can start before it has the page
+static bool hint_is_preload(const char *p, size_t len)
+{
+    const char *end = p + len;
+    const char *uri_end = len && *p == '<' ? memchr(p, '>', len) : NULL;
+    if (!uri_end) {
+        return false;
+    }
+    for (const char *q = uri_end; q + 4 <= end; q++) {
+        if (strncasecmp(q, "rel=", 4) != 0) continue;
+        const char *v = q + 4;
+        const char *v_end = memchr(v, ';', (size_t)(end - v));
+        size_t v_len = (size_t)((v_end ? v_end : end) - v);
+        return hint_has_token(v, v_len, "preload", 7) || hint_has_token(v, v_len, "preconnect", 10);
+    }
+    return false;
+}
+
+static void hint_collect_value(zend_string **out, size_t *n, const char *value, size_t len)
+{
+    // A header value is a comma-separated list; commas inside <...> or
+    // quoted parameters are not separators
+    size_t start = 0;
+    bool in_uri = false, in_quote = false;
+    for (size_t i = 0; i <= len && *n < HINTS_MAX_LINKS; i++) {
+        if (i < len) {
+            char c = value[i];
+            if (c == '"' && !in_uri) in_quote = !in_quote;
+            else if (c == '<' && !in_quote) in_uri = true;
+            else if (c == '>' && !in_quote) in_uri = false;
+            if (c != ',' || in_uri || in_quote) continue;
+        }
+        const char *el = value + start;
+        size_t el_len = i - start;
+        start = i + 1;
+        while (el_len && (*el == ' ' || *el == '\t')) { el++; el_len--; }
+        while (el_len && (el[el_len - 1] == ' ' || el[el_len - 1] == '\t')) el_len--;
+        if (!el_len || !hint_is_preload(el, el_len) || !quicpro_header_is_sendable("link", 4, el, el_len)) {
+            continue;
+        }
+        bool dup = false;
+        for (size_t k = 0; k < *n && !dup; k++) {
+            dup = zend_string_equals_cstr(out[k], el, el_len);
+        }
+        if (!dup) {
+            out[(*n)++] = zend_string_init(el, el_len, 0);
+        }
+    }
+}
+
+static void hint_collect_zval(zend_string **out, size_t *n, zval *value)
+{
+    if (Z_TYPE_P(value) == IS_STRING) {
+        hint_collect_value(out, n, Z_STRVAL_P(value), Z_STRLEN_P(value));
+    } else if (Z_TYPE_P(value) == IS_ARRAY) {
+        zval *v;
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(value), v) {
+            if (Z_TYPE_P(v) == IS_STRING) hint_collect_value(out, n, Z_STRVAL_P(v), Z_STRLEN_P(v));
+        } ZEND_HASH_FOREACH_END();
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Learning                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static bool hint_is_hinted(const hint_route_t *r, const hint_link_t *l)
+{
+    return r->answers >= HINTS_MIN_ANSWERS && l->seen * 2 >= r->answers;
+}
+
+static void hint_render(hint_route_t *r, uint32_t mask)
+{
+    smart_str h1 = {0};
+    r->hints.count = 0;
+    smart_str_appends(&h1, "HTTP/1.1 103 Early Hints\r\n");
+    for (uint32_t i = 0; i < r->nlinks; i++) {
+        if (!(mask & (1u << i))) continue;
+        r->hinted[r->hints.count++] = r->links[i].link;
+        smart_str_appendl(&h1, "link: ", 6);
+        smart_str_append(&h1, r->links[i].link);
+        smart_str_appendl(&h1, "\r\n", 2);
+    }
+    smart_str_appendl(&h1, "\r\n", 2);
+    smart_str_0(&h1);
+
+    if (r->hints.h1) zend_string_release(r->hints.h1);
+    r->hints.h1 = zend_string_init(ZSTR_VAL(h1.s), ZSTR_LEN(h1.s), 1);
+    smart_str_free(&h1);
+    r->hints.links = r->hinted;
+    r->hinted_mask = mask;
+}
+
+void quicpro_hint_learner_observe(const char *authority, size_t authority_len, const char *path, size_t path_len,
+                                  long status, const quicpro_header_template_t *tmpl, HashTable *headers)
+{
+    if (!quicpro_hint_learner_enabled() || status < 200 || status > 299) {
+        return;
+    }
+    zend_string *seen[HINTS_MAX_LINKS];
+    size_t nseen = 0;
+    if (tmpl) {
+        for (size_t i = 0; i < tmpl->count; i++) {
+            const nghttp2_nv *nv = &tmpl->nv[i];
+            if (nv->namelen == 4 && strncasecmp((const char *)nv->name, "link", 4) == 0) {
+                hint_collect_value(seen, &nseen, (const char *)nv->value, nv->valuelen);
+            }
+        }
+    }
+    if (headers) {
+        zend_string *name;
+        zval *value;
+        ZEND_HASH_FOREACH_STR_KEY_VAL(headers, name, value) {
+            if (name && ZSTR_LEN(name) == 4 && strncasecmp(ZSTR_VAL(name), "link", 4) == 0) {
+                hint_collect_zval(seen, &nseen, value);
+            }
+        } ZEND_HASH_FOREACH_END();
+    }
+
+    hint_route_t *r = hint_route_find(authority, authority_len, path, path_len, nseen > 0);
+    if (r) {
+        r->answers++;
+        for (size_t k = 0; k < nseen; k++) {
+            hint_link_t *l = NULL;
+            for (uint32_t i = 0; i < r->nlinks && !l; i++) {
+                if (zend_string_equals(r->links[i].link, seen[k])) l = &r->links[i];
+            }
+            if (!l && r->nlinks < HINTS_MAX_LINKS) {
+                l = &r->links[r->nlinks++];
+            } else if (!l) {
+                // Full: the rarest link gives way if it is rare enough
+                hint_link_t *rarest = &r->links[0];
+                for (uint32_t i = 1; i < r->nlinks; i++) {
+                    if (r->links[i].seen < rarest->seen) rarest = &r->links[i];
+                }
+                if (rarest->seen * 4 >= r->answers) continue;
+                zend_string_release(rarest->link);
+                r->hinted_mask = UINT32_MAX; // The slot's link changed: render again
+                l = rarest;
+            } else {
+                l->seen++;
+                continue;
+            }
+            l->link = zend_string_init(ZSTR_VAL(seen[k]), ZSTR_LEN(seen[k]), 1);
+            l->seen = 1;
+        }
+
+        if (r->answers >= HINTS_WINDOW) {
+            uint32_t kept = 0;
+            r->answers /= 2;
+            for (uint32_t i = 0; i < r->nlinks; i++) {
+                hint_link_t l = r->links[i];
+                l.seen /= 2;
+                if (l.seen == 0) {
+                    zend_string_release(l.link);
+                    r->hinted_mask = UINT32_MAX;
+                    continue;
+                }
+                r->links[kept++] = l;
+            }
+            if (kept != r->nlinks) r->hinted_mask = UINT32_MAX;
+            r->nlinks = kept;
+        }
+
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < r->nlinks; i++) {
+            if (hint_is_hinted(r, &r->links[i])) mask |= 1u << i;
+        }
+        if (mask != r->hinted_mask) {
+            hint_render(r, mask);
+        }
+    }
+    for (size_t k = 0; k < nseen; k++) {
+        zend_string_release(seen[k]);
+    }
+}
+
+const quicpro_learned_hints_t *quicpro_hint_learner_lookup(const char *authority, size_t authority_len,
+                                                            const char *path, size_t path_len)
+{
+    if (!quicpro_hint_learner_enabled()) {
+        return NULL;
+    }
+    hint_route_t *r = hint_route_find(authority, authority_len, path, path_len, false);
+    return r && r->hints.count ? &r->hints : NULL;
+}
+
+void quicpro_hint_learner_mshutdown(void)
+{
+    if (hint_routes_ready) {
+        zend_hash_destroy(&hint_routes);
+        hint_routes_ready = false;
+    }
+}
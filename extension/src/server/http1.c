@@ -11,7 +11,9 @@
 #include <php.h>
 #include <zend_exceptions.h>
 #include <zend_hash.h>
+#include <zend_smart_str.h>
 #include <stdio.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -25,24 +27,87 @@
 #include <openssl/err.h>
 
 #include "server/http1.h"
+#include "server/ticket_keys.h"
+#include "server/ocsp.h"
+#include "server/tls_offload.h"
+#include "server/ktls.h"
+#include "server/cert_store.h"
+#include "server/cert_watch.h"
+#include "server/tcp_listen.h"
+#include "server/http1_parser.h"
+#include "server/http1_head.h"
+#include "server/tls_output.h"
+#include "server/header_template.h"
+#include "server/request.h"
+#include "server/body_spool.h"
+#include "cluster/cluster.h"
+#include "cluster/topology.h"
+#include "cluster/cluster_stats.h"
+#include "server/rate_limit.h"
+#include "server/open_telemetry.h"
+#include "server/metrics.h"
+#include "server/profiler.h"
+#include "server/live_config.h"
+#include "server/cors.h"
+#include "server/cdn_cache.h"
+#include "server/compress.h"
+#include "server/hint_learner.h"
+#include "server/overload.h"
+#include "server/access_log.h"
+#include "config/runtime.h"
+#include "config/tcp_transport/base_layer.h"
+#include "config/tls_and_crypto/base_layer.h"
+#include "config/native_cdn/base_layer.h"
 
 #define READ_BUFFER_SIZE 8192
+#define PARKED_POLL_MS 2 // How often requests waiting on another's cache fill look again
 
 typedef struct http1_server_s http1_server_t;
 
 // Represents the state of a single client connection
-typedef struct {
+typedef struct http1_client_connection_s {
     int fd;
     SSL *ssl;
-    char read_buffer[READ_BUFFER_SIZE];
+    quicpro_tls_handshake_t hs;
+    struct sockaddr_storage peer; // Keys the rate limiter
+    char *read_buffer; // Grows up to quicpro.tcp_http1_max_request_bytes
     size_t read_buffer_len;
-    char *write_buffer;
-    size_t write_buffer_len;
-    size_t write_buffer_sent;
+    size_t read_buffer_cap;
+    size_t scanned_len; // How much of read_buffer the parser already searched for the head's end
+    quicpro_h1_request_t req; // Views into read_buffer, valid until the request is consumed
+    size_t head_len; // 0 until the head is complete
+    size_t body_len; // Body bytes following the head, decoded in place when chunked
+    quicpro_h1_chunked_t chunked;
+    quicpro_body_spool_t spool; // A body past tcp_body_spool_threshold_bytes, moved out of read_buffer as it comes
+    bool body_done;
+    bool keep_alive; // Of the response being written
+    bool interim; // head holds a 100 Continue rather than the response
+    zend_long requests; // Served on this connection
+    char head[QUICPRO_H1_HEAD_MAX]; // Status line and headers, from pre-rendered pieces
+    size_t head_len_out;
+    const quicpro_header_template_t *tmpl; // Pre-rendered headers named by the handler
+    zend_string *extra_headers; // The handler's own 'headers', rendered
+    quicpro_coding_t coding; // Negotiated from the request's Accept-Encoding (server/compress.h)
+    const char *coding_lines; // Content-Encoding and Vary of a compressible response, static
+    char cors[QUICPRO_CORS_H1_MAX]; // Access-Control-* lines for the request's Origin
+    size_t cors_len;
+    quicpro_cdn_object_t *cached; // A cached response being sent, referenced; its lines and body replace the handler's
+    quicpro_cdn_body_t cached_body; // The bytes of its body being sent; empty for HEAD and file bodies
+    char range[80]; // Content-Range of a cached 206 or 416
+    size_t range_len;
+    quicpro_cdn_key_t *parked_key; // While the request waits for another's fetch of the same key
+    uint64_t parked_until_us;
+    struct http1_client_connection_s *parked_next;
+    bool waited; // The request was parked once; it does not wait again
+    zend_string *body; // The handler's body, referenced and sent in place
+    size_t out_done; // Bytes of head and body written or staged
+    quicpro_tls_output_t out; // Gathers head and body into full TLS records
+    quicpro_file_body_t file; // Or a body streamed from a file, with sendfile() under kTLS
     enum {
         STATE_HANDSHAKING,
         STATE_READING,
         STATE_WRITING,
+        STATE_PARKED, // The request waits on the response cache (server/cdn_cache.h)
         STATE_CLOSING
     } state;
     http1_server_t *server;
@@ -52,40 +117,23 @@ typedef struct {
 struct http1_server_s {
     int listen_fd;
     int epoll_fd;
-    SSL_CTX *ssl_ctx; // Default SSL context
-    HashTable *vhost_contexts; // Maps hostname -> SSL_CTX*
+    SSL_CTX *ssl_ctx; // Default certificate; the store swaps in the SNI host's (server/cert_store.h)
+    quicpro_tls_offload_t *tls_offload; // Handshake pool, NULL when handshakes run on the loop
     zend_fcall_info fci;
     zend_fcall_info_cache fcc;
+    quicpro_request_pool_t requests; // The one Quicpro\Request reused across dispatches
+    http1_client_connection_t *parked; // Requests waiting on another's cache fill
     bool is_listening;
 };
 
 // Forward declarations
 static void handle_client_event(http1_client_connection_t *conn, uint32_t events);
 static void close_client_connection(http1_client_connection_t *conn);
+static int flush_response(http1_client_connection_t *conn);
+static int process_request(http1_client_connection_t *conn);
+static void resume_parked(http1_server_t *server);
 extern zend_class_entry *quicpro_config_ce;
 
-static int set_nonblocking(int fd) {
-    int flags = fcntl(fd, F_GETFL, 0);
-    if (flags == -1) return -1;
-    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
-}
-
-// SNI callback to select the correct SSL_CTX for a vhost
-static int sni_callback(SSL *ssl, int *al, void *arg) {
-    http1_server_t *server = (http1_server_t *)arg;
-    const char *servername = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
-
-    if (servername) {
-        SSL_CTX *vhost_ctx = zend_hash_str_find_ptr(server->vhost_contexts, servername, strlen(servername));
-        if (vhost_ctx) {
-            SSL_set_SSL_CTX(ssl, vhost_ctx);
-            return SSL_TLSEXT_ERR_OK;
-        }
-    }
-    // Fallback to the default context if no match is found
-    return SSL_TLSEXT_ERR_OK;
-}
-
 PHP_FUNCTION(quicpro_http1_server_listen)
 {
     char *host;
@@ -102,56 +150,116 @@ PHP_FUNCTION(quicpro_http1_server_listen)
         Z_PARAM_FUNC(fci, fcc)
     ZEND_PARSE_PARAMETERS_END();
 
+    // The Config's certificate, else php.ini's default; per-host ones come from the store
+    const quicpro_runtime_config_t *runtime = quicpro_runtime_config_of(config_resource);
+    if (!runtime) {
+        RETURN_FALSE;
+    }
+    const char *cert_file = runtime->cert_file ? runtime->cert_file : quicpro_tls_crypto_config.tls_default_cert_file;
+    const char *key_file = runtime->key_file ? runtime->key_file : quicpro_tls_crypto_config.tls_default_key_file;
+    bool has_default = cert_file && cert_file[0] && key_file && key_file[0];
+    if (!has_default && !quicpro_cert_store_enabled()) {
+        zend_throw_exception(NULL, "HTTP/1 server requires 'cert_file' and 'key_file' in configuration, or quicpro.tls_cert_store_dir.", 0);
+        RETURN_FALSE;
+    }
+
     http1_server_t server;
     memset(&server, 0, sizeof(server));
     server.fci = fci;
     server.fcc = fcc;
 
-    // A full implementation would parse vhosts from the config and create an SSL_CTX for each.
-    // For now, we create a single default context.
-    const char *cert_file = "path/to/default-cert.pem";
-    const char *key_file = "path/to/default-key.pem";
-
     server.ssl_ctx = SSL_CTX_new(TLS_server_method());
     SSL_CTX_set_options(server.ssl_ctx, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1 | SSL_OP_NO_TLSv1_1);
-    SSL_CTX_set_tlsext_servername_callback(server.ssl_ctx, sni_callback);
-    SSL_CTX_set_tlsext_servername_arg(server.ssl_ctx, &server);
-    SSL_CTX_use_certificate_file(server.ssl_ctx, cert_file, SSL_FILETYPE_PEM);
-    SSL_CTX_use_private_key_file(server.ssl_ctx, key_file, SSL_FILETYPE_PEM);
-
-    server.listen_fd = socket(AF_INET6, SOCK_STREAM, 0);
-    // ... (full socket, setsockopt, bind, listen, set_nonblocking calls) ...
+    if (has_default && !quicpro_cert_store_use_files(server.ssl_ctx, cert_file, key_file)) {
+        SSL_CTX_free(server.ssl_ctx);
+        zend_throw_exception(NULL, "Failed to load TLS certificate/key.", 0);
+        RETURN_FALSE;
+    }
+    quicpro_cert_store_install(server.ssl_ctx);
+    quicpro_request_pool_init(&server.requests);
+    quicpro_ticket_keys_install(server.ssl_ctx); // Resume on any worker
+    quicpro_ocsp_install(server.ssl_ctx); // Staples from the shared cache, never fetched in the handshake
+    quicpro_ktls_configure(server.ssl_ctx);
+    server.tls_offload = quicpro_tls_offload_new(server.ssl_ctx);
+
+    // SO_REUSEPORT gives every worker its own accept queue (server/tcp_listen.h)
+    server.listen_fd = quicpro_tcp_listen(host, port);
+    if (server.listen_fd < 0) {
+        zend_throw_exception_ex(NULL, 0, "HTTP/1 server failed to bind/listen: %s", strerror(errno));
+        quicpro_tls_offload_destroy(server.tls_offload);
+        SSL_CTX_free(server.ssl_ctx);
+        RETURN_FALSE;
+    }
 
     server.epoll_fd = epoll_create1(0);
-    struct epoll_event event;
-    event.events = EPOLLIN | EPOLLET;
-    event.data.ptr = &server;
-    epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.listen_fd, &event);
+    quicpro_tcp_listen_arm(server.listen_fd, server.epoll_fd, &server);
+    quicpro_topology_incoming_cpu(server.listen_fd); /* Pinned workers take their own RX CPU's packets */
+    quicpro_cluster_worker_listening(); /* A rolling reload may drain our predecessor now */
+    quicpro_tls_offload_watch(server.tls_offload, server.epoll_fd);
 
     #define MAX_EVENTS 128
     struct epoll_event events[MAX_EVENTS];
     server.is_listening = true;
+    quicpro_live_reader_t live;
+    quicpro_live_config_enter(&live);
+    live.tls_ctx = server.ssl_ctx;
+    quicpro_cert_watch_t cert_watch; // Renewed certificate files (server/cert_watch.h)
+    quicpro_cert_watch_init(&cert_watch, has_default ? cert_file : NULL, has_default ? key_file : NULL);
+    quicpro_cert_watch_arm(&cert_watch, server.epoll_fd);
 
     while (server.is_listening) {
-        int n_events = epoll_wait(server.epoll_fd, events, MAX_EVENTS, -1);
+        // CORS, rate limits and the certificate the admin API changed (server/live_config.h).
+        quicpro_live_config_tick(&live, NULL);
+        resume_parked(&server);
+        quicpro_worker_wait_begin();
+        quicpro_overload_wait_begin();
+        int n_events = epoll_wait(server.epoll_fd, events, MAX_EVENTS, server.parked ? PARKED_POLL_MS : -1);
+        quicpro_overload_wait_end();
+        quicpro_worker_wait_end(n_events);
         for (int i = 0; i < n_events; i++) {
             if (events[i].data.ptr == &server) {
                 while (1) {
-                    int client_fd = accept(server.listen_fd, NULL, NULL);
+                    struct sockaddr_storage peer;
+                    int client_fd = quicpro_tcp_accept(server.listen_fd, &peer);
                     if (client_fd < 0) break;
-                    set_nonblocking(client_fd);
+                    if (!quicpro_rate_limit_admit_addr((struct sockaddr *)&peer)) {
+                        QUICPRO_WORKER_STAT(rate_limited);
+                        close(client_fd); // Before any TLS work
+                        continue;
+                    }
+                    QUICPRO_WORKER_STAT(connections_accepted);
 
                     http1_client_connection_t *conn = ecalloc(1, sizeof(http1_client_connection_t));
                     conn->fd = client_fd;
+                    conn->peer = peer;
                     conn->server = &server;
                     conn->state = STATE_HANDSHAKING;
+                    conn->read_buffer = emalloc(READ_BUFFER_SIZE);
+                    conn->read_buffer_cap = READ_BUFFER_SIZE;
+                    quicpro_body_spool_init(&conn->spool);
                     conn->ssl = SSL_new(server.ssl_ctx);
                     SSL_set_fd(conn->ssl, client_fd);
+                    quicpro_tls_handshake_init(&conn->hs, conn->ssl, server.epoll_fd, conn);
+                    quicpro_file_body_init(&conn->file);
+                    quicpro_tls_output_init(&conn->out);
 
+                    struct epoll_event event;
                     event.events = EPOLLIN | EPOLLOUT | EPOLLET;
                     event.data.ptr = conn;
                     epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, client_fd, &event);
                 }
+            } else if (events[i].data.ptr == &cert_watch) {
+                if (quicpro_cert_watch_changed(&cert_watch)) {
+                    quicpro_cert_watch_reload_ssl(&cert_watch, server.ssl_ctx);
+                }
+            } else if (server.tls_offload && events[i].data.ptr == server.tls_offload) {
+                // Handshakes finished by the pool; the step may have consumed the socket's edge
+                quicpro_tls_handshake_t *hs = quicpro_tls_offload_reap(server.tls_offload);
+                while (hs) {
+                    quicpro_tls_handshake_t *next = hs->next;
+                    handle_client_event((http1_client_connection_t *)hs->owner, EPOLLIN | EPOLLOUT);
+                    hs = next;
+                }
             } else {
                 handle_client_event((http1_client_connection_t *)events[i].data.ptr, events[i].events);
             }
@@ -159,86 +267,730 @@ PHP_FUNCTION(quicpro_http1_server_listen)
     }
 
     close(server.listen_fd);
+    quicpro_live_config_leave(&live);
+    quicpro_cert_watch_close(&cert_watch);
     close(server.epoll_fd);
+    quicpro_tls_offload_destroy(server.tls_offload);
     SSL_CTX_free(server.ssl_ctx);
-    // zend_hash_destroy(server.vhost_contexts);
+    quicpro_request_pool_free(&server.requests);
     // FREE_HASHTABLE(server.vhost_contexts);
     RETURN_TRUE;
 }
 
 static void close_client_connection(http1_client_connection_t *conn) {
+    QUICPRO_WORKER_STAT(connections_closed);
+    if (conn->parked_key) {
+        http1_client_connection_t **at = &conn->server->parked;
+        while (*at != conn) at = &(*at)->parked_next;
+        *at = conn->parked_next;
+        efree(conn->parked_key);
+    }
     epoll_ctl(conn->server->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    quicpro_tls_handshake_forget(&conn->hs);
     SSL_shutdown(conn->ssl);
     SSL_free(conn->ssl);
     close(conn->fd);
-    if (conn->write_buffer) efree(conn->write_buffer);
+    efree(conn->read_buffer);
+    quicpro_body_spool_close(&conn->spool);
+    if (conn->body) zend_string_release(conn->body);
+    if (conn->extra_headers) zend_string_release(conn->extra_headers);
+    quicpro_cdn_body_close(&conn->cached_body);
+    quicpro_cdn_release(conn->cached);
+    quicpro_tls_output_free(&conn->out);
+    quicpro_file_body_close(&conn->file);
     efree(conn);
 }
 
-static void handle_client_event(http1_client_connection_t *conn, uint32_t events) {
-    if (conn->state == STATE_HANDSHAKING) {
-        int ret = SSL_accept(conn->ssl);
-        if (ret == 1) {
-            conn->state = STATE_READING;
-        } else if (SSL_get_error(conn->ssl, ret) != SSL_ERROR_WANT_READ && SSL_get_error(conn->ssl, ret) != SSL_ERROR_WANT_WRITE) {
-            close_client_connection(conn);
-            return;
-        }
+// Writes the head and the string or file body until the socket blocks.
+// Returns 1 when the response is complete, 0 when blocked, -1 on error.
+static int flush_response(http1_client_connection_t *conn) {
+    // A cached body in slices takes one entry per slice
+    quicpro_tls_iov_t stack_iov[9];
+    size_t pieces = conn->cached_body.count;
+    quicpro_tls_iov_t *iov = pieces > 1 ? safe_emalloc(8 + pieces, sizeof(*iov), 0) : stack_iov;
+    size_t iovcnt = 0;
+    iov[iovcnt++] = (quicpro_tls_iov_t){ conn->head, conn->head_len_out };
+    if (conn->cors_len) iov[iovcnt++] = (quicpro_tls_iov_t){ conn->cors, conn->cors_len };
+    if (conn->cached) iov[iovcnt++] = (quicpro_tls_iov_t){ conn->cached->h1, conn->cached->h1_len };
+    if (conn->range_len) iov[iovcnt++] = (quicpro_tls_iov_t){ conn->range, conn->range_len };
+    if (conn->tmpl) iov[iovcnt++] = (quicpro_tls_iov_t){ conn->tmpl->h1, conn->tmpl->h1_len };
+    if (conn->extra_headers) iov[iovcnt++] = (quicpro_tls_iov_t){ ZSTR_VAL(conn->extra_headers), ZSTR_LEN(conn->extra_headers) };
+    if (conn->coding_lines) iov[iovcnt++] = (quicpro_tls_iov_t){ conn->coding_lines, strlen(conn->coding_lines) };
+    if (conn->cors_len || conn->cached || conn->tmpl || conn->extra_headers || conn->coding_lines) iov[iovcnt++] = (quicpro_tls_iov_t){ "\r\n", 2 }; // The head's end, moved
+    if (conn->body) iov[iovcnt++] = (quicpro_tls_iov_t){ ZSTR_VAL(conn->body), ZSTR_LEN(conn->body) };
+    for (size_t i = 0; i < pieces; i++, iovcnt++) {
+        quicpro_cdn_body_piece(&conn->cached_body, i, &iov[iovcnt].base, &iov[iovcnt].len);
+    }
+    // A pipelined request already in the buffer lets its response share our last record
+    bool hold = conn->keep_alive && !conn->interim && conn->file.remaining == 0 && conn->read_buffer_len > 0;
+
+    int ret = quicpro_tls_output_gather(&conn->hs, &conn->out, iov, iovcnt, &conn->out_done, hold);
+    if (iov != stack_iov) efree(iov);
+    if (ret <= 0) return ret;
+    while (conn->file.remaining > 0) {
+        ssize_t n = quicpro_file_body_send(conn->ssl, &conn->file, (size_t)conn->file.remaining);
+        if (n <= 0) return quicpro_tls_io_pending(&conn->hs, (int)n) ? 0 : -1;
     }
+    return 1;
+}
+
+static size_t max_request_bytes(void) {
+    size_t limit = (size_t)quicpro_tcp_transport_config.tcp_http1_max_request_bytes;
+    return limit < READ_BUFFER_SIZE ? READ_BUFFER_SIZE : limit;
+}
+
+// Reads until the socket would block or the buffer reached its limit.
+// Returns 1 if bytes arrived, 0 if none did, -1 on EOF or error.
+static int fill_read_buffer(http1_client_connection_t *conn) {
+    size_t limit = max_request_bytes();
+    bool got = false;
 
-    if ((events & EPOLLIN) && conn->state == STATE_READING) {
-        ssize_t count = SSL_read(conn->ssl, conn->read_buffer + conn->read_buffer_len, READ_BUFFER_SIZE - conn->read_buffer_len);
+    for (;;) {
+        if (conn->read_buffer_len == conn->read_buffer_cap) {
+            if (conn->read_buffer_cap >= limit) {
+                return got ? 1 : 0; // Full; consuming the current request makes room
+            }
+            size_t cap = conn->read_buffer_cap * 2;
+            conn->read_buffer_cap = cap < limit ? cap : limit;
+            conn->read_buffer = erealloc(conn->read_buffer, conn->read_buffer_cap);
+            if (conn->head_len) {
+                // Re-point the views; the head itself is never rewritten
+                quicpro_h1_parse_request(conn->read_buffer, conn->head_len, 0, &conn->req);
+            }
+        }
+        int count = SSL_read(conn->ssl, conn->read_buffer + conn->read_buffer_len, (int)(conn->read_buffer_cap - conn->read_buffer_len));
         if (count <= 0) {
-            close_client_connection(conn);
-            return;
+            if (count < 0 && quicpro_tls_io_pending(&conn->hs, count)) {
+                return got ? 1 : 0;
+            }
+            return -1;
         }
         conn->read_buffer_len += count;
+        got = true;
+    }
+}
+
+// Drops the current request from the buffer, keeping any pipelined bytes.
+static void consume_request(http1_client_connection_t *conn) {
+    size_t used = conn->head_len + conn->body_len;
+    memmove(conn->read_buffer, conn->read_buffer + used, conn->read_buffer_len - used);
+    conn->read_buffer_len -= used;
+    conn->scanned_len = 0;
+    conn->head_len = 0;
+    conn->body_len = 0;
+    conn->body_done = false;
+    quicpro_body_spool_close(&conn->spool);
+}
+
+static int queue_error(http1_client_connection_t *conn, long status) {
+    conn->keep_alive = false;
+    conn->cors_len = 0;
+    conn->head_len_out = quicpro_h1_head_render(conn->head, status, 0, QUICPRO_H1_CONN_CLOSE);
+    conn->out_done = 0;
+    conn->state = STATE_WRITING;
+    return 1;
+}
+
+// The request object only views the parser's slices of read_buffer.
+static zend_object *acquire_request(http1_client_connection_t *conn) {
+    const quicpro_h1_request_t *req = &conn->req;
+    quicpro_request_view_t view = {
+        .method = req->method, .method_len = req->method_len,
+        .uri = req->target, .uri_len = req->target_len,
+        .protocol = req->minor_version ? "HTTP/1.1" : "HTTP/1.0",
+        .h1_headers = req->headers, .h1_num_headers = req->num_headers,
+        .body = conn->body_len ? conn->read_buffer + conn->head_len : NULL, .body_len = conn->body_len,
+        .spool = conn->spool.fd >= 0 ? &conn->spool : NULL,
+    };
+    return quicpro_request_acquire(&conn->server->requests, &view);
+}
+
+static void render_header_line(smart_str *out, zend_string *name, zval *value_zv) {
+    zend_string *value = zval_get_string(value_zv);
+    if (quicpro_header_is_sendable(ZSTR_VAL(name), ZSTR_LEN(name), ZSTR_VAL(value), ZSTR_LEN(value))) {
+        smart_str_append(out, name);
+        smart_str_appendl(out, ": ", 2);
+        smart_str_append(out, value);
+        smart_str_appendl(out, "\r\n", 2);
+    } else {
+        php_error_docref(NULL, E_WARNING, "Response header '%s' dropped: invalid, or set by the server", ZSTR_VAL(name));
+    }
+    zend_string_release(value);
+}
+
+// The handler's 'headers' as "name: value\r\n" lines; a list value repeats the name.
+static zend_string *render_extra_headers(HashTable *headers) {
+    smart_str out = {0};
+    zend_string *name;
+    zval *entry, *v;
+
+    ZEND_HASH_FOREACH_STR_KEY_VAL(headers, name, entry) {
+        if (!name) continue;
+        if (Z_TYPE_P(entry) == IS_ARRAY) {
+            ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(entry), v) {
+                render_header_line(&out, name, v);
+            } ZEND_HASH_FOREACH_END();
+        } else {
+            render_header_line(&out, name, entry);
+        }
+    } ZEND_HASH_FOREACH_END();
+    return out.s ? smart_str_extract(&out) : NULL;
+}
+
+// The lines of a response that varies on Accept-Encoding, encoded with `coding` or not
+static const char *coding_lines(quicpro_coding_t coding) {
+    switch (coding) {
+        case QUICPRO_CODING_GZIP: return "content-encoding: gzip\r\nvary: accept-encoding\r\n";
+        case QUICPRO_CODING_BR: return "content-encoding: br\r\nvary: accept-encoding\r\n";
+        case QUICPRO_CODING_ZSTD: return "content-encoding: zstd\r\nvary: accept-encoding\r\n";
+        default: return "vary: accept-encoding\r\n";
+    }
+}
+
+// A SERVER span per request, the child of the one its traceparent names; the handler's MCP calls continue it.
+static bool open_request_span(http1_client_connection_t *conn, quicpro_otel_scope_t *scope) {
+    quicpro_otel_context_t parent;
+    bool has_parent = false;
+    for (size_t i = 0; i < conn->req.num_headers; i++) {
+        const quicpro_h1_header_t *h = &conn->req.headers[i];
+        if (quicpro_h1_name_is(h, "traceparent", 11)) {
+            has_parent = quicpro_otel_traceparent_parse(h->value, h->value_len, &parent);
+            break;
+        }
+    }
+    char name[QUICPRO_OTEL_NAME_MAX];
+    snprintf(name, sizeof(name), "%.*s", (int)conn->req.method_len, conn->req.method);
+    if (!quicpro_otel_scope_open(scope, name, QUICPRO_OTEL_KIND_SERVER, has_parent ? &parent : NULL)) {
+        return false;
+    }
+    const char *query = memchr(conn->req.target, '?', conn->req.target_len);
+    quicpro_otel_span_attr_str(&scope->span, "http.request.method", conn->req.method, conn->req.method_len);
+    quicpro_otel_span_attr_str(&scope->span, "url.path", conn->req.target,
+                               query ? (size_t)(query - conn->req.target) : conn->req.target_len);
+    quicpro_otel_span_attr_str(&scope->span, "network.protocol.version", conn->req.minor_version ? "1.1" : "1.0", 3);
+    return true;
+}
+
+// Looks the request's Origin up in the thread's CORS policy (server/cors.h)
+// and keeps the lines to send. True when a preflight was answered instead
+// of dispatching.
+static bool apply_cors(http1_client_connection_t *conn) {
+    const quicpro_h1_header_t *origin = NULL, *acrm = NULL;
+    for (size_t i = 0; i < conn->req.num_headers; i++) {
+        const quicpro_h1_header_t *h = &conn->req.headers[i];
+        if (quicpro_h1_name_is(h, "origin", 6)) origin = h;
+        else if (quicpro_h1_name_is(h, "access-control-request-method", 29)) acrm = h;
+    }
+    conn->cors_len = 0;
+    if (!origin) {
+        return false;
+    }
+    bool preflight = acrm && conn->req.method_len == 7 && memcmp(conn->req.method, "OPTIONS", 7) == 0;
+    const quicpro_cors_result_t *cors = quicpro_cors_check(origin->value, origin->value_len,
+        preflight ? acrm->value : conn->req.method, preflight ? acrm->value_len : conn->req.method_len, preflight);
+    if (cors->verdict == QUICPRO_CORS_NONE) {
+        return false;
+    }
+    memcpy(conn->cors, cors->h1, cors->h1_len);
+    conn->cors_len = cors->h1_len;
+    if (cors->verdict == QUICPRO_CORS_ALLOW) {
+        return false;
+    }
+
+    conn->requests++;
+    conn->keep_alive = conn->req.keep_alive && conn->server->is_listening
+        && conn->requests < quicpro_tcp_transport_config.tcp_http1_max_keepalive_requests;
+    conn->head_len_out = quicpro_h1_head_render(conn->head, cors->verdict == QUICPRO_CORS_PREFLIGHT ? 204 : 403, 0,
+        !conn->keep_alive ? QUICPRO_H1_CONN_CLOSE : (conn->req.minor_version == 0 ? QUICPRO_H1_CONN_KEEP_ALIVE : QUICPRO_H1_CONN_IMPLIED));
+    if (conn->cors_len) {
+        conn->head_len_out -= 2; // The CORS lines follow; flush_response ends the head
+    }
+    conn->out_done = 0;
+    conn->state = STATE_WRITING;
+    consume_request(conn);
+    return true;
+}
+
+// The response cache's key for a GET or HEAD: Host, target and the
+// configured Vary headers. False for any other request.
+static bool cdn_key(http1_client_connection_t *conn, bool head_only, quicpro_cdn_key_t *key) {
+    bool get = conn->req.method_len == 3 && memcmp(conn->req.method, "GET", 3) == 0;
+    if ((!get && !head_only) || !quicpro_cdn_cache_enabled()) {
+        return false;
+    }
+    const quicpro_h1_header_t *host = NULL;
+    for (size_t i = 0; i < conn->req.num_headers && !host; i++) {
+        if (quicpro_h1_name_is(&conn->req.headers[i], "host", 4)) host = &conn->req.headers[i];
+    }
+    quicpro_cdn_key_begin(key, host ? host->value : "", host ? host->value_len : 0, conn->req.target, conn->req.target_len);
+    for (size_t v = 0; v < quicpro_cdn_vary_count(); v++) {
+        size_t name_len;
+        const char *name = quicpro_cdn_vary_name(v, &name_len);
+        const quicpro_h1_header_t *h = NULL;
+        for (size_t i = 0; i < conn->req.num_headers && !h; i++) {
+            if (quicpro_h1_name_is(&conn->req.headers[i], name, name_len)) h = &conn->req.headers[i];
+        }
+        quicpro_cdn_key_vary(key, h ? h->value : NULL, h ? h->value_len : 0);
+    }
+    quicpro_cdn_key_coding(key, conn->coding);
+    quicpro_cdn_key_end(key);
+    return key->ok;
+}
+
+static const quicpro_h1_header_t *request_header(http1_client_connection_t *conn, const char *name, size_t len) {
+    for (size_t i = 0; i < conn->req.num_headers; i++) {
+        if (quicpro_h1_name_is(&conn->req.headers[i], name, len)) return &conn->req.headers[i];
+    }
+    return NULL;
+}
+
+// Sends a 103 with the route's learned preload links (server/hint_learner.h)
+// before the handler runs. Staged ahead of the response: a write that
+// blocks is finished by the response's own.
+static void send_learned_hints(http1_client_connection_t *conn, const quicpro_h1_header_t *host) {
+    const quicpro_learned_hints_t *hints = quicpro_hint_learner_lookup(host ? host->value : "", host ? host->value_len : 0,
+                                                                        conn->req.target, conn->req.target_len);
+    if (!hints || conn->out.stage_busy || QUICPRO_TLS_RECORD_MAX - conn->out.stage_len < ZSTR_LEN(hints->h1)) {
+        return;
+    }
+    quicpro_tls_output_stage(&conn->out, ZSTR_VAL(hints->h1), ZSTR_LEN(hints->h1));
+    quicpro_tls_output_flush(&conn->hs, &conn->out);
+}
+
+// Answers from a cached object in place of anything the handler set up,
+// the request's byte range of it if it names one. A body in a disk
+// segment goes out like a 'file' body, with sendfile(). False, with the
+// reference dropped, if a slice of the body is gone: a miss after all.
+static bool serve_cached(http1_client_connection_t *conn, quicpro_cdn_object_t *obj, const quicpro_cdn_key_t *key,
+                         bool head_only, bool http10) {
+    uint64_t first = 0, len = obj->body_len;
+    quicpro_cdn_range_t range = QUICPRO_CDN_RANGE_NONE;
+    const quicpro_h1_header_t *range_h = obj->status == 200 ? request_header(conn, "range", 5) : NULL;
+    if (range_h && !request_header(conn, "if-range", 8)) {
+        range = quicpro_cdn_range_parse(range_h->value, range_h->value_len, obj->body_len, &first, &len);
+    }
+    if (range == QUICPRO_CDN_RANGE_UNSATISFIABLE) {
+        len = 0;
+    }
+    bool send_body = !head_only && len > 0;
+    if (send_body && obj->body_fd < 0 && !quicpro_cdn_body_open(&conn->cached_body, key, obj, first, len)) {
+        quicpro_cdn_release(obj);
+        return false;
+    }
 
-        char *header_end = strstr(conn->read_buffer, "\r\n\r\n");
-        if (header_end) {
-            zval request_zv, retval;
-            array_init(&request_zv);
-            // Full request parsing logic here...
-            add_assoc_string(&request_zv, "method", "GET");
-            add_assoc_string(&request_zv, "uri", "/");
+    if (conn->body) { zend_string_release(conn->body); conn->body = NULL; }
+    if (conn->extra_headers) { zend_string_release(conn->extra_headers); conn->extra_headers = NULL; }
+    conn->tmpl = NULL;
+    conn->coding_lines = NULL; // The object carries its own
+    quicpro_file_body_close(&conn->file);
+    if (send_body && obj->body_fd >= 0
+        && quicpro_cdn_body_file_open(&conn->file, obj, first, len) < 0) {
+        quicpro_cdn_release(obj);
+        queue_error(conn, 503);
+        return true;
+    }
+    long status = obj->status;
+    conn->range_len = 0;
+    if (range == QUICPRO_CDN_RANGE_OK) {
+        status = 206;
+        conn->range_len = (size_t)snprintf(conn->range, sizeof(conn->range), "content-range: bytes %" PRIu64 "-%" PRIu64 "/%" PRIu64 "\r\n",
+                                           first, first + len - 1, (uint64_t)obj->body_len);
+    } else if (range == QUICPRO_CDN_RANGE_UNSATISFIABLE) {
+        status = 416;
+        conn->range_len = (size_t)snprintf(conn->range, sizeof(conn->range), "content-range: bytes */%" PRIu64 "\r\n", (uint64_t)obj->body_len);
+    }
+    conn->cached = obj;
+    conn->head_len_out = quicpro_h1_head_render(conn->head, status, len,
+        !conn->keep_alive ? QUICPRO_H1_CONN_CLOSE : (http10 ? QUICPRO_H1_CONN_KEEP_ALIVE : QUICPRO_H1_CONN_IMPLIED));
+    conn->head_len_out -= 2; // The object's lines follow; flush_response ends the head
+    conn->out_done = 0;
+    conn->state = STATE_WRITING;
+    return true;
+}
 
-            conn->server->fci.param_count = 1;
-            conn->server->fci.params = &request_zv;
-            conn->server->fci.retval = &retval;
+// Holds the request until the fetch of `key` another thread or worker
+// leads has landed, or quicpro.cdn_origin_request_timeout_ms passed.
+static void park_request(http1_client_connection_t *conn, const quicpro_cdn_key_t *key) {
+    conn->parked_key = emalloc(sizeof(*key));
+    memcpy(conn->parked_key, key, sizeof(*key));
+    conn->parked_until_us = quicpro_metrics_now_us() + (uint64_t)quicpro_native_cdn_config.origin_request_timeout_ms * 1000;
+    conn->parked_next = conn->server->parked;
+    conn->server->parked = conn;
+    conn->state = STATE_PARKED;
+}
 
-            if (zend_call_function(&conn->server->fci, &conn->server->fcc) == SUCCESS && Z_TYPE(retval) == IS_ARRAY) {
-                zval *status_zv = zend_hash_str_find(Z_ARRVAL(retval), "status", sizeof("status")-1);
-                zval *body_zv = zend_hash_str_find(Z_ARRVAL(retval), "body", sizeof("body")-1);
+// Runs the parked requests whose fetch is over (or overdue) again.
+static void resume_parked(http1_server_t *server) {
+    uint64_t now = quicpro_metrics_now_us();
+    http1_client_connection_t **at = &server->parked;
+    while (*at) {
+        http1_client_connection_t *conn = *at;
+        if (now < conn->parked_until_us && quicpro_cdn_flight_pending(conn->parked_key)) {
+            at = &conn->parked_next;
+            continue;
+        }
+        *at = conn->parked_next;
+        efree(conn->parked_key);
+        conn->parked_key = NULL;
+        conn->waited = true;
+        conn->state = STATE_READING;
+        handle_client_event(conn, EPOLLIN | EPOLLOUT);
+    }
+}
 
-                long status = status_zv ? zval_get_long(status_zv) : 200;
-                char *body = body_zv ? Z_STRVAL_P(body_zv) : "";
-                size_t body_len = body_zv ? Z_STRLEN_P(body_zv) : 0;
+// The access log's record of the response just set up (server/access_log.h).
+static void log_request(http1_client_connection_t *conn, uint64_t since_us) {
+    quicpro_access_record_t *r = quicpro_access_log_begin();
+    if (!r) {
+        return;
+    }
+    r->protocol = QUICPRO_ACCESS_HTTP1;
+    r->status = (uint16_t)atoi(conn->head + sizeof("HTTP/1.1 ") - 1); // Whoever rendered the head chose it
+    r->duration_us = (uint32_t)MIN(quicpro_metrics_now_us() - since_us, UINT32_MAX);
+    r->bytes_in = conn->head_len + conn->body_len + conn->spool.len;
+    r->bytes_out = conn->head_len_out + (conn->body ? ZSTR_LEN(conn->body) : 0)
+                 + (uint64_t)conn->file.remaining + conn->cached_body.len;
+    quicpro_access_log_method(r, conn->req.method, conn->req.method_len);
+    quicpro_access_log_path(r, conn->req.target, conn->req.target_len);
+    quicpro_access_log_peer(r, (struct sockaddr *)&conn->peer);
+    quicpro_access_log_commit(r);
+}
 
-                conn->write_buffer_len = spprintf(&conn->write_buffer, 0,
-                    "HTTP/1.1 %ld OK\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n%s",
-                    status, body_len, body);
+static void dispatch_request(http1_client_connection_t *conn) {
+    zval request_zv, retval;
+    uint64_t dispatched_us = quicpro_metrics_now_us();
+    bool head_only = conn->req.method_len == 4 && memcmp(conn->req.method, "HEAD", 4) == 0;
+    long status = 500;
+    const quicpro_h1_header_t *accept_encoding = request_header(conn, "accept-encoding", 15);
+    conn->coding = quicpro_compress_negotiate(accept_encoding ? accept_encoding->value : NULL,
+                                              accept_encoding ? accept_encoding->value_len : 0);
+
+    // One miss per key runs the handler; the others take the expired copy
+    // while it is refreshed, or wait for the refreshed one
+    quicpro_cdn_key_t key;
+    bool cacheable = cdn_key(conn, head_only, &key);
+    quicpro_cdn_object_t *hit = cacheable ? quicpro_cdn_lookup(&key) : NULL;
+    bool leader = false;
+    if (cacheable && !hit) {
+        leader = quicpro_cdn_flight_begin(&key);
+        if (!leader && !conn->waited) {
+            hit = quicpro_cdn_lookup_stale(&key);
+            if (!hit) {
+                park_request(conn, &key);
+                return;
+            }
+        }
+    }
+    conn->waited = false;
+
+    conn->requests++;
+    conn->keep_alive = conn->req.keep_alive && conn->server->is_listening
+        && conn->requests < quicpro_tcp_transport_config.tcp_http1_max_keepalive_requests;
+    bool http10 = conn->req.minor_version == 0;
+
+    if (hit && serve_cached(conn, hit, &key, head_only, http10)) {
+        QUICPRO_WORKER_STAT(cdn_hits);
+        log_request(conn, dispatched_us);
+        consume_request(conn);
+        return;
+    }
+    if (cacheable) {
+        QUICPRO_WORKER_STAT(cdn_misses);
+    }
+    // HTTP/1.0 clients do not expect interim responses
+    bool get = conn->req.method_len == 3 && memcmp(conn->req.method, "GET", 3) == 0;
+    const quicpro_h1_header_t *host = get ? request_header(conn, "host", 4) : NULL;
+    if (get && !http10) {
+        send_learned_hints(conn, host);
+    }
 
-                conn->state = STATE_WRITING;
-                conn->write_buffer_sent = 0;
+    quicpro_otel_scope_t scope;
+    bool traced = open_request_span(conn, &scope);
+    zend_object *request = acquire_request(conn);
+    ZVAL_OBJ(&request_zv, request);
+
+    ZVAL_UNDEF(&retval);
+    conn->server->fci.param_count = 1;
+    conn->server->fci.params = &request_zv;
+    conn->server->fci.retval = &retval;
+
+    uint64_t started_us = quicpro_metrics_now_us();
+    uint64_t prof = quicpro_prof_begin();
+    bool called = zend_call_function(&conn->server->fci, &conn->server->fcc) == SUCCESS;
+    quicpro_prof_end(QUICPRO_PROF_PHP_CALLBACK, prof);
+    quicpro_metrics_observe_since(QUICPRO_METRIC_REQUEST_DURATION, started_us);
+    if (called && Z_TYPE(retval) == IS_ARRAY) {
+        zval *status_zv = zend_hash_str_find(Z_ARRVAL(retval), "status", sizeof("status")-1);
+        zval *body_zv = zend_hash_str_find(Z_ARRVAL(retval), "body", sizeof("body")-1);
+        zval *file_zv = zend_hash_str_find(Z_ARRVAL(retval), "file", sizeof("file")-1);
+        zval *template_zv = zend_hash_str_find(Z_ARRVAL(retval), "template", sizeof("template")-1);
+        zval *headers_zv = zend_hash_str_find(Z_ARRVAL(retval), "headers", sizeof("headers")-1);
+        zval *compress_zv = zend_hash_str_find(Z_ARRVAL(retval), "compress", sizeof("compress")-1);
+        HashTable *extra = headers_zv && Z_TYPE_P(headers_zv) == IS_ARRAY ? Z_ARRVAL_P(headers_zv) : NULL;
+
+        status = status_zv ? zval_get_long(status_zv) : 200;
+        size_t body_len = 0;
+
+        if (template_zv && Z_TYPE_P(template_zv) == IS_STRING) {
+            conn->tmpl = quicpro_header_template_find(Z_STRVAL_P(template_zv), Z_STRLEN_P(template_zv));
+            if (!conn->tmpl) {
+                php_error_docref(NULL, E_WARNING, "Unknown header template '%s'", Z_STRVAL_P(template_zv));
             }
-            zval_ptr_dtor(&request_zv);
-            zval_ptr_dtor(&retval);
         }
+        if (extra) {
+            conn->extra_headers = render_extra_headers(extra);
+        }
+
+        if (file_zv && Z_TYPE_P(file_zv) == IS_STRING) {
+            if (quicpro_file_body_open(&conn->file, Z_STRVAL_P(file_zv)) == 0) {
+                body_len = (size_t)conn->file.remaining;
+            } else {
+                status = 404;
+            }
+        } else if (body_zv && Z_TYPE_P(body_zv) == IS_STRING) {
+            conn->body = zend_string_copy(Z_STR_P(body_zv));
+            // A response the cache keeps is compressed once, so at the coding's best
+            quicpro_coding_t coding = conn->coding;
+            bool store = cacheable && !head_only && !EG(exception);
+            bool varies = (!compress_zv || zend_is_true(compress_zv))
+                && quicpro_compress_response(&coding, store && quicpro_cdn_storable(status, conn->tmpl, extra)
+                                             ? QUICPRO_COMPRESS_MAX : QUICPRO_COMPRESS_FAST,
+                                             status, conn->tmpl, extra, &conn->body);
+            conn->coding_lines = varies ? coding_lines(coding) : NULL;
+            body_len = ZSTR_LEN(conn->body);
+            if (store) {
+                quicpro_cdn_store(&key, status, conn->tmpl, extra, coding, varies, ZSTR_VAL(conn->body), body_len);
+            }
+        }
+        if (get) {
+            quicpro_hint_learner_observe(host ? host->value : "", host ? host->value_len : 0,
+                                         conn->req.target, conn->req.target_len, status, conn->tmpl, extra);
+        }
+        if (head_only) {
+            // Same Content-Length as for GET, no body
+            if (conn->body) { zend_string_release(conn->body); conn->body = NULL; }
+            quicpro_file_body_close(&conn->file);
+        }
+
+        conn->head_len_out = quicpro_h1_head_render(conn->head, status, body_len,
+            !conn->keep_alive ? QUICPRO_H1_CONN_CLOSE : (http10 ? QUICPRO_H1_CONN_KEEP_ALIVE : QUICPRO_H1_CONN_IMPLIED));
+        if (conn->cors_len || conn->tmpl || conn->extra_headers || conn->coding_lines) {
+            conn->head_len_out -= 2; // More header lines follow; flush_response ends the head
+        }
+        conn->out_done = 0;
+        conn->state = STATE_WRITING;
+    } else {
+        queue_error(conn, 500);
+    }
+    if (cacheable && status >= 500) {
+        quicpro_cdn_object_t *stale = quicpro_cdn_lookup_stale(&key);
+        if (stale) {
+            serve_cached(conn, stale, &key, head_only, http10);
+        }
+    }
+    if (leader) {
+        quicpro_cdn_flight_end(&key);
     }
+    if (traced) {
+        quicpro_otel_span_attr_int(&scope.span, "http.response.status_code", status);
+        scope.span.error = status >= 500;
+    }
+    quicpro_otel_scope_close(&scope);
+    zval_ptr_dtor(&retval);
+    quicpro_request_release(&conn->server->requests, request); // Copies out if the handler kept it
+    log_request(conn, dispatched_us);
+    consume_request(conn); // Only now: the request viewed these bytes; make room for pipelined requests
+}
 
-    if ((events & EPOLLOUT) && conn->state == STATE_WRITING) {
-        ssize_t sent = SSL_write(conn->ssl, conn->write_buffer + conn->write_buffer_sent, conn->write_buffer_len - conn->write_buffer_sent);
-        if (sent > 0) {
-            conn->write_buffer_sent += sent;
-        } else if (SSL_get_error(conn->ssl, sent) != SSL_ERROR_WANT_WRITE) {
+// Moves the n body bytes after the head into the spool, opening it first,
+// and the `keep` bytes after them down in their place. False once the
+// request was answered with an error instead.
+static bool spool_body(http1_client_connection_t *conn, size_t n, size_t keep) {
+    if (conn->spool.fd < 0 && !quicpro_body_spool_open(&conn->spool)) {
+        queue_error(conn, 503);
+        return false;
+    }
+    if (conn->spool.len + n > quicpro_body_spool_max()) {
+        queue_error(conn, 413);
+        return false;
+    }
+    char *body = conn->read_buffer + conn->head_len;
+    if (!quicpro_body_spool_write(&conn->spool, body, n)) {
+        php_error_docref(NULL, E_WARNING, "Cannot spool a request body: %s", strerror(errno));
+        queue_error(conn, 500);
+        return false;
+    }
+    memmove(body, body + n, keep);
+    conn->read_buffer_len = conn->head_len + keep;
+    return true;
+}
+
+// CoDel admission (server/overload.h), by the request's priority field and WebSocket upgrade.
+static bool admit_request(http1_client_connection_t *conn) {
+    if (!quicpro_overload_enabled()) {
+        return true;
+    }
+    const quicpro_h1_header_t *priority = request_header(conn, "priority", 8);
+    const quicpro_h1_header_t *upgrade = request_header(conn, "upgrade", 7);
+    bool websocket = upgrade && zend_binary_strcasecmp(upgrade->value, upgrade->value_len, "websocket", 9) == 0;
+    quicpro_overload_class_t cls = quicpro_overload_classify(priority ? priority->value : NULL,
+                                                             priority ? priority->value_len : 0, websocket);
+    return quicpro_overload_admit(cls, quicpro_overload_round_arrival_us());
+}
+
+// Advances the request at the front of the buffer.
+// Returns 1 when something was queued for writing, 0 when more input is needed.
+static int process_request(http1_client_connection_t *conn) {
+    quicpro_h1_request_t *req = &conn->req;
+    size_t limit = max_request_bytes();
+
+    if (!conn->head_len) {
+        ssize_t n = quicpro_h1_parse_request(conn->read_buffer, conn->read_buffer_len, conn->scanned_len, req);
+        if (n == QUICPRO_H1_INCOMPLETE) {
+            conn->scanned_len = conn->read_buffer_len;
+            return conn->read_buffer_len >= limit ? queue_error(conn, 431) : 0;
+        }
+        if (n == QUICPRO_H1_TOO_MANY) return queue_error(conn, 431);
+        if (n == QUICPRO_H1_BAD_TE) return queue_error(conn, 501);
+        if (n < 0) return queue_error(conn, 400);
+        if (conn->requests > 0 && !quicpro_rate_limit_admit_addr((struct sockaddr *)&conn->peer)) {
+            QUICPRO_WORKER_STAT(rate_limited);
+            return queue_error(conn, 429); // The connection's first request was admitted on accept
+        }
+
+        conn->head_len = (size_t)n;
+        conn->body_len = 0;
+        memset(&conn->chunked, 0, sizeof(conn->chunked));
+        conn->body_done = !req->chunked && req->content_length == 0;
+        if (!req->chunked && quicpro_body_spool_wanted(req->content_length)) {
+            if (req->content_length > quicpro_body_spool_max()) {
+                return queue_error(conn, 413);
+            }
+            if (!quicpro_body_spool_open(&conn->spool)) {
+                return queue_error(conn, 503);
+            }
+        } else if (!req->chunked && req->content_length > limit - conn->head_len) {
+            return queue_error(conn, 413);
+        }
+        if (req->expect_continue && !conn->body_done && req->minor_version >= 1
+            && conn->read_buffer_len == conn->head_len) {
+            conn->interim = true;
+            conn->head_len_out = quicpro_h1_head_continue(conn->head);
+            conn->out_done = 0;
+            conn->state = STATE_WRITING;
+            return 1;
+        }
+    }
+
+    if (!conn->body_done) {
+        if (req->chunked) {
+            size_t raw_at = conn->head_len + conn->body_len;
+            size_t raw = conn->read_buffer_len - raw_at;
+            ssize_t rest = quicpro_h1_decode_chunked(&conn->chunked, conn->read_buffer + raw_at, &raw);
+            if (rest == QUICPRO_H1_ERROR) return queue_error(conn, 400);
+            conn->body_len += raw;
+            conn->read_buffer_len = conn->head_len + conn->body_len + (rest > 0 ? (size_t)rest : 0);
+            // Decoded bytes past the threshold leave the buffer; the spool takes the rest as it comes
+            if (conn->spool.fd >= 0 || quicpro_body_spool_wanted(conn->body_len)) {
+                if (!spool_body(conn, conn->body_len, rest > 0 ? (size_t)rest : 0)) return 1;
+                conn->body_len = 0;
+            }
+            if (rest == QUICPRO_H1_INCOMPLETE) {
+                return conn->read_buffer_len >= limit ? queue_error(conn, 413) : 0;
+            }
+        } else if (conn->spool.fd >= 0) {
+            size_t have = conn->read_buffer_len - conn->head_len;
+            size_t want = (size_t)MIN((uint64_t)have, req->content_length - conn->spool.len);
+            if (!spool_body(conn, want, have - want)) return 1;
+            if (conn->spool.len < req->content_length) return 0;
+        } else {
+            if (conn->read_buffer_len - conn->head_len < req->content_length) return 0;
+            conn->body_len = (size_t)req->content_length;
+        }
+        conn->body_done = true;
+    }
+
+    // A parked request was admitted before it waited
+    if (!conn->waited && !admit_request(conn)) {
+        return queue_error(conn, 503);
+    }
+    if (!apply_cors(conn)) {
+        dispatch_request(conn);
+    }
+    return 1;
+}
+
+// Finishes the current response; false if the connection should close.
+static bool finish_response(http1_client_connection_t *conn) {
+    conn->head_len_out = conn->out_done = 0;
+    if (conn->body) { zend_string_release(conn->body); conn->body = NULL; } // Staged bytes are copies
+    if (conn->extra_headers) { zend_string_release(conn->extra_headers); conn->extra_headers = NULL; }
+    conn->tmpl = NULL;
+    conn->coding_lines = NULL;
+    conn->cors_len = 0;
+    conn->range_len = 0;
+    quicpro_cdn_body_close(&conn->cached_body);
+    quicpro_cdn_release(conn->cached);
+    conn->cached = NULL;
+    quicpro_file_body_close(&conn->file);
+    conn->state = STATE_READING;
+
+    if (conn->interim) {
+        conn->interim = false;
+        return true;
+    }
+    return conn->keep_alive;
+}
+
+static void handle_client_event(http1_client_connection_t *conn, uint32_t events) {
+    if (conn->state == STATE_PARKED) {
+        return; // resume_parked() picks it up again
+    }
+    if (conn->state == STATE_HANDSHAKING) {
+        int hs = quicpro_tls_handshake_step(conn->server->tls_offload, &conn->hs);
+        if (hs == QUICPRO_TLS_HS_FAILED) {
             close_client_connection(conn);
             return;
         }
+        if (hs != QUICPRO_TLS_HS_DONE) {
+            return;
+        }
+        conn->state = STATE_READING;
+    }
 
-        if (conn->write_buffer_sent >= conn->write_buffer_len) {
-            // A full implementation would check for "Connection: keep-alive"
-            // and reset the state to STATE_READING instead of closing.
-            close_client_connection(conn);
+    // Edge-triggered: run until both directions would block. Pipelined
+    // requests are answered one at a time, in order.
+    for (;;) {
+        if (conn->state == STATE_WRITING) {
+            int done = flush_response(conn);
+            if (done < 0) {
+                close_client_connection(conn);
+                return;
+            }
+            if (!done) {
+                return;
+            }
+            if (!finish_response(conn)) {
+                close_client_connection(conn);
+                return;
+            }
+        }
+
+        if (process_request(conn)) {
+            if (conn->state == STATE_PARKED) {
+                return;
+            }
+            continue;
+        }
+        int got = fill_read_buffer(conn);
+        if (got <= 0) {
+            // No further response follows for now: send what is held back
+            int flushed = quicpro_tls_output_flush(&conn->hs, &conn->out);
+            if (got < 0 || flushed < 0) {
+                close_client_connection(conn);
+                return;
+            }
+            return;
         }
     }
 }
@@ -0,0 +1,125 @@
+/*
+ * http1_head.c  –  Pre-rendered HTTP/1.1 response heads for php-quicpro
+ * ---------------------------------------------------------------------
+ *
+ * The date cache is per process and only touched by the event loop.
+ */
+
+#include "server/http1_head.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define STATUS_LINE(code, reason) \
+    case code: *len = sizeof("HTTP/1.1 " #code " " reason "\r\n") - 1; return "HTTP/1.1 " #code " " reason "\r\n";
+
+static const char *status_line(long status, size_t *len)
+{
+    switch (status) {
+        STATUS_LINE(200, "OK")
+        STATUS_LINE(201, "Created")
+        STATUS_LINE(202, "Accepted")
+        STATUS_LINE(204, "No Content")
+        STATUS_LINE(206, "Partial Content")
+        STATUS_LINE(301, "Moved Permanently")
+        STATUS_LINE(302, "Found")
+        STATUS_LINE(303, "See Other")
+        STATUS_LINE(304, "Not Modified")
+        STATUS_LINE(307, "Temporary Redirect")
+        STATUS_LINE(308, "Permanent Redirect")
+        STATUS_LINE(400, "Bad Request")
+        STATUS_LINE(401, "Unauthorized")
+        STATUS_LINE(403, "Forbidden")
+        STATUS_LINE(404, "Not Found")
+        STATUS_LINE(405, "Method Not Allowed")
+        STATUS_LINE(409, "Conflict")
+        STATUS_LINE(413, "Content Too Large")
+        STATUS_LINE(416, "Range Not Satisfiable")
+        STATUS_LINE(422, "Unprocessable Content")
+        STATUS_LINE(429, "Too Many Requests")
+        STATUS_LINE(431, "Request Header Fields Too Large")
+        STATUS_LINE(500, "Internal Server Error")
+        STATUS_LINE(501, "Not Implemented")
+        STATUS_LINE(502, "Bad Gateway")
+        STATUS_LINE(503, "Service Unavailable")
+        STATUS_LINE(504, "Gateway Timeout")
+        default: return NULL;
+    }
+}
+
+#undef STATUS_LINE
+
+const char *quicpro_http_date(size_t *len)
+{
+    static char   date[32];
+    static size_t date_len;
+    static time_t rendered_at = (time_t)-1;
+
+    time_t now = time(NULL);
+    if (now != rendered_at) {
+        struct tm tm;
+        gmtime_r(&now, &tm);
+        date_len = strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        rendered_at = now;
+    }
+    *len = date_len;
+    return date;
+}
+
+static char *put(char *p, const char *s, size_t n)
+{
+    memcpy(p, s, n);
+    return p + n;
+}
+
+#define PUT_LITERAL(p, s) put((p), (s), sizeof(s) - 1)
+
+static char *put_u64(char *p, uint64_t v)
+{
+    char tmp[20];
+    size_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) {
+        *p++ = tmp[--n];
+    }
+    return p;
+}
+
+size_t quicpro_h1_head_render(char *out, long status, uint64_t content_length, quicpro_h1_conn_t conn)
+{
+    char *p = out;
+    size_t n;
+    const char *line = status_line(status, &n);
+
+    if (line) {
+        p = put(p, line, n);
+    } else {
+        // Uncommon code: the class decides the phrase, which clients ignore anyway
+        if (status < 100 || status > 999) status = 500;
+        p += snprintf(p, QUICPRO_H1_HEAD_MAX, "HTTP/1.1 %03ld %s\r\n", status, status < 400 ? "OK" : "Error");
+    }
+
+    const char *date = quicpro_http_date(&n);
+    p = PUT_LITERAL(p, "Date: ");
+    p = put(p, date, n);
+    p = PUT_LITERAL(p, "\r\nContent-Length: ");
+    p = put_u64(p, content_length);
+    p = PUT_LITERAL(p, "\r\n");
+
+    if (conn == QUICPRO_H1_CONN_CLOSE) {
+        p = PUT_LITERAL(p, "Connection: close\r\n");
+    } else if (conn == QUICPRO_H1_CONN_KEEP_ALIVE) {
+        p = PUT_LITERAL(p, "Connection: keep-alive\r\n");
+    }
+    p = PUT_LITERAL(p, "\r\n");
+    return (size_t)(p - out);
+}
+
+size_t quicpro_h1_head_continue(char *out)
+{
+    return (size_t)(PUT_LITERAL(out, "HTTP/1.1 100 Continue\r\n\r\n") - out);
+}
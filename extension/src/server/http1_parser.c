@@ -0,0 +1,374 @@
+/*
+ * http1_parser.c  –  Incremental, zero-copy HTTP/1.1 request parser
+ * -----------------------------------------------------------------
+ *
+ * Two phases per call:
+ *
+ *   1. find the empty line ending the head, resuming 3 bytes before where
+ *      the previous call stopped (memchr for '\n' does the heavy lifting)
+ *   2. parse the complete head once: request line, then header lines
+ *
+ * Phase 2 may read every byte of the head freely, so the SSE4.2 value
+ * scanner only needs to stay 16 bytes clear of the head's end.
+ */
+
+#include "server/http1_parser.h"
+
+#include <string.h>
+#include <strings.h>
+
+#ifdef __SSE4_2__
+# include <nmmintrin.h>
+#endif
+
+/* RFC 9110 tchar */
+static const uint8_t quicpro_h1_tchar[256] = {
+    ['!'] = 1, ['#'] = 1, ['$'] = 1, ['%'] = 1, ['&'] = 1, ['\''] = 1, ['*'] = 1,
+    ['+'] = 1, ['-'] = 1, ['.'] = 1, ['^'] = 1, ['_'] = 1, ['`'] = 1, ['|'] = 1, ['~'] = 1,
+    ['0'] = 1, ['1'] = 1, ['2'] = 1, ['3'] = 1, ['4'] = 1, ['5'] = 1, ['6'] = 1, ['7'] = 1, ['8'] = 1, ['9'] = 1,
+    ['A'] = 1, ['B'] = 1, ['C'] = 1, ['D'] = 1, ['E'] = 1, ['F'] = 1, ['G'] = 1, ['H'] = 1, ['I'] = 1,
+    ['J'] = 1, ['K'] = 1, ['L'] = 1, ['M'] = 1, ['N'] = 1, ['O'] = 1, ['P'] = 1, ['Q'] = 1, ['R'] = 1,
+    ['S'] = 1, ['T'] = 1, ['U'] = 1, ['V'] = 1, ['W'] = 1, ['X'] = 1, ['Y'] = 1, ['Z'] = 1,
+    ['a'] = 1, ['b'] = 1, ['c'] = 1, ['d'] = 1, ['e'] = 1, ['f'] = 1, ['g'] = 1, ['h'] = 1, ['i'] = 1,
+    ['j'] = 1, ['k'] = 1, ['l'] = 1, ['m'] = 1, ['n'] = 1, ['o'] = 1, ['p'] = 1, ['q'] = 1, ['r'] = 1,
+    ['s'] = 1, ['t'] = 1, ['u'] = 1, ['v'] = 1, ['w'] = 1, ['x'] = 1, ['y'] = 1, ['z'] = 1,
+};
+
+/*──────────────────────────── Scanning ───────────────────────────────────*/
+
+/* Returns one past the empty line ending the head, or NULL if not there yet. */
+static const char *quicpro_h1_find_head_end(const char *buf, size_t len, size_t last_len)
+{
+    const char *end = buf + len;
+    const char *p = buf + (last_len > 3 ? last_len - 3 : 0);
+
+    while (p < end && (p = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+        if (p + 1 < end && p[1] == '\n') {
+            return p + 2;
+        }
+        if (p + 2 < end && p[1] == '\r' && p[2] == '\n') {
+            return p + 3;
+        }
+        p++;
+    }
+    return NULL;
+}
+
+/* First byte that may not appear in a field value (CTLs except HTAB, DEL). */
+static const char *quicpro_h1_scan_value(const char *p, const char *end)
+{
+#ifdef __SSE4_2__
+    static const char ranges[16] = "\000\010\012\037\177\177";
+    const __m128i r = _mm_loadu_si128((const __m128i *)ranges);
+    while (end - p >= 16) {
+        __m128i b = _mm_loadu_si128((const __m128i *)p);
+        int i = _mm_cmpestri(r, 6, b, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if (i != 16) {
+            return p + i;
+        }
+        p += 16;
+    }
+#endif
+    for (; p < end; p++) {
+        unsigned char c = (unsigned char)*p;
+        if ((c < 0x20 && c != '\t') || c == 0x7f) {
+            return p;
+        }
+    }
+    return p;
+}
+
+static const char *quicpro_h1_eol(const char *p, const char *end)
+{
+    if (p < end && *p == '\r') {
+        p++;
+    }
+    return (p < end && *p == '\n') ? p + 1 : NULL;
+}
+
+/*──────────────────────────── Head parsing ───────────────────────────────*/
+
+static bool quicpro_h1_list_has(const char *v, size_t len, const char *token, size_t token_len)
+{
+    const char *end = v + len;
+    while (v < end) {
+        while (v < end && (*v == ' ' || *v == '\t' || *v == ',')) {
+            v++;
+        }
+        const char *start = v;
+        while (v < end && *v != ',') {
+            v++;
+        }
+        const char *stop = v;
+        while (stop > start && (stop[-1] == ' ' || stop[-1] == '\t')) {
+            stop--;
+        }
+        if ((size_t)(stop - start) == token_len && strncasecmp(start, token, token_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool quicpro_h1_name_is(const quicpro_h1_header_t *h, const char *lower, size_t lower_len)
+{
+    return h->name_len == lower_len && strncasecmp(h->name, lower, lower_len) == 0;
+}
+
+/* Applies the framing headers to `req`; returns 0 or a QUICPRO_H1_* error. */
+static int quicpro_h1_framing(quicpro_h1_request_t *req)
+{
+    bool have_length = false, have_te = false;
+    bool close = false, keep = false;
+
+    for (size_t i = 0; i < req->num_headers; i++) {
+        const quicpro_h1_header_t *h = &req->headers[i];
+
+        if (quicpro_h1_name_is(h, "content-length", 14)) {
+            uint64_t v = 0;
+            if (h->value_len == 0 || h->value_len > 19) {
+                return QUICPRO_H1_ERROR;
+            }
+            for (size_t j = 0; j < h->value_len; j++) {
+                if (h->value[j] < '0' || h->value[j] > '9') {
+                    return QUICPRO_H1_ERROR;
+                }
+                v = v * 10 + (uint64_t)(h->value[j] - '0');
+            }
+            if (have_length && v != req->content_length) {
+                return QUICPRO_H1_ERROR;
+            }
+            have_length = true;
+            req->content_length = v;
+        } else if (quicpro_h1_name_is(h, "transfer-encoding", 17)) {
+            /* Only a lone, final "chunked" is understood */
+            const char *v = h->value;
+            size_t n = h->value_len;
+            if (have_te || n != 7 || strncasecmp(v, "chunked", 7) != 0) {
+                return QUICPRO_H1_BAD_TE;
+            }
+            have_te = true;
+        } else if (quicpro_h1_name_is(h, "connection", 10)) {
+            close = close || quicpro_h1_list_has(h->value, h->value_len, "close", 5);
+            keep = keep || quicpro_h1_list_has(h->value, h->value_len, "keep-alive", 10);
+        } else if (quicpro_h1_name_is(h, "expect", 6)) {
+            req->expect_continue = h->value_len == 12 && strncasecmp(h->value, "100-continue", 12) == 0;
+        }
+    }
+
+    if (have_te && have_length) {
+        return QUICPRO_H1_ERROR;   /* Smuggling vector: refuse rather than pick one */
+    }
+    req->chunked = have_te;
+    if (have_te) {
+        req->content_length = 0;
+    }
+    req->keep_alive = req->minor_version >= 1 ? !close : (keep && !close);
+    return 0;
+}
+
+ssize_t quicpro_h1_parse_request(const char *buf, size_t len, size_t last_len, quicpro_h1_request_t *req)
+{
+    const char *start = buf, *end = buf + len;
+
+    /* RFC 9112 §2.2: ignore at least one empty line before the request line */
+    while (start < end && (*start == '\r' || *start == '\n')) {
+        start++;
+    }
+    size_t skipped = (size_t)(start - buf);
+    const char *head_end = quicpro_h1_find_head_end(start, (size_t)(end - start),
+                                                    last_len > skipped ? last_len - skipped : 0);
+    if (!head_end) {
+        return QUICPRO_H1_INCOMPLETE;
+    }
+
+    memset(req, 0, sizeof(*req));
+    const char *p = start;
+
+    /* method SP request-target SP HTTP/1.x CRLF */
+    req->method = p;
+    while (p < head_end && quicpro_h1_tchar[(unsigned char)*p]) {
+        p++;
+    }
+    req->method_len = (size_t)(p - req->method);
+    if (req->method_len == 0 || p >= head_end || *p++ != ' ') {
+        return QUICPRO_H1_ERROR;
+    }
+
+    req->target = p;
+    while (p < head_end && (unsigned char)*p > ' ' && *p != 0x7f) {
+        p++;
+    }
+    req->target_len = (size_t)(p - req->target);
+    if (req->target_len == 0 || p >= head_end || *p++ != ' ') {
+        return QUICPRO_H1_ERROR;
+    }
+
+    if (head_end - p < 9 || memcmp(p, "HTTP/1.", 7) != 0 || (p[7] != '0' && p[7] != '1')) {
+        return QUICPRO_H1_ERROR;
+    }
+    req->minor_version = p[7] - '0';
+    if ((p = quicpro_h1_eol(p + 8, head_end)) == NULL) {
+        return QUICPRO_H1_ERROR;
+    }
+
+    /* field-name ":" OWS field-value OWS CRLF, until the empty line */
+    for (;;) {
+        const char *eol = quicpro_h1_eol(p, head_end);
+        if (eol) {
+            p = eol;
+            break;
+        }
+        if (req->num_headers == QUICPRO_H1_MAX_HEADERS) {
+            return QUICPRO_H1_TOO_MANY;
+        }
+        quicpro_h1_header_t *h = &req->headers[req->num_headers];
+
+        h->name = p;
+        while (p < head_end && quicpro_h1_tchar[(unsigned char)*p]) {
+            p++;
+        }
+        h->name_len = (size_t)(p - h->name);
+        /* Also rejects obs-fold and whitespace before the colon */
+        if (h->name_len == 0 || p >= head_end || *p++ != ':') {
+            return QUICPRO_H1_ERROR;
+        }
+        while (p < head_end && (*p == ' ' || *p == '\t')) {
+            p++;
+        }
+
+        h->value = p;
+        p = quicpro_h1_scan_value(p, head_end);
+        const char *value_end = p;
+        if ((p = quicpro_h1_eol(p, head_end)) == NULL) {
+            return QUICPRO_H1_ERROR;   /* A control character inside the value */
+        }
+        while (value_end > h->value && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+            value_end--;
+        }
+        h->value_len = (size_t)(value_end - h->value);
+        req->num_headers++;
+    }
+
+    int rc = quicpro_h1_framing(req);
+    if (rc != 0) {
+        return rc;
+    }
+    return (ssize_t)(p - buf);
+}
+
+/*──────────────────────────── Chunked bodies ─────────────────────────────*/
+
+enum {
+    QP_CHUNK_SIZE = 0,
+    QP_CHUNK_EXT,
+    QP_CHUNK_DATA,
+    QP_CHUNK_CRLF,
+    QP_CHUNK_TRAILER_HEAD,
+    QP_CHUNK_TRAILER_LINE
+};
+
+static int quicpro_h1_hex(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+ssize_t quicpro_h1_decode_chunked(quicpro_h1_chunked_t *d, char *buf, size_t *len)
+{
+    size_t src = 0, dst = 0, n = *len;
+
+    for (;;) {
+        switch (d->state) {
+            case QP_CHUNK_SIZE:
+                for (;; src++) {
+                    if (src == n) goto incomplete;
+                    int v = quicpro_h1_hex(buf[src]);
+                    if (v < 0) break;
+                    if (d->hex_count == 15) return QUICPRO_H1_ERROR;   /* Keeps bytes_left < 2^60 */
+                    d->bytes_left = d->bytes_left * 16 + (uint64_t)v;
+                    d->hex_count++;
+                }
+                if (d->hex_count == 0) {
+                    return QUICPRO_H1_ERROR;
+                }
+                d->hex_count = 0;
+                d->state = QP_CHUNK_EXT;
+                /* fallthrough */
+
+            case QP_CHUNK_EXT:
+                /* Chunk extensions are ignored, as RFC 9112 §7.1.1 allows */
+                for (;; src++) {
+                    if (src == n) goto incomplete;
+                    if (buf[src] == '\n') break;
+                }
+                src++;
+                if (d->bytes_left == 0) {
+                    d->state = QP_CHUNK_TRAILER_HEAD;
+                    break;
+                }
+                d->state = QP_CHUNK_DATA;
+                /* fallthrough */
+
+            case QP_CHUNK_DATA: {
+                size_t avail = n - src;
+                size_t take = avail < d->bytes_left ? avail : (size_t)d->bytes_left;
+                if (dst != src) {
+                    memmove(buf + dst, buf + src, take);
+                }
+                src += take;
+                dst += take;
+                d->bytes_left -= take;
+                if (d->bytes_left != 0) goto incomplete;
+                d->state = QP_CHUNK_CRLF;
+            }
+                /* fallthrough */
+
+            case QP_CHUNK_CRLF:
+                if (src == n) goto incomplete;
+                if (buf[src] == '\r') {
+                    src++;
+                    if (src == n) goto incomplete;
+                }
+                if (buf[src++] != '\n') {
+                    return QUICPRO_H1_ERROR;
+                }
+                d->state = QP_CHUNK_SIZE;
+                break;
+
+            case QP_CHUNK_TRAILER_HEAD:
+                if (src == n) goto incomplete;
+                if (buf[src] == '\r') {
+                    src++;
+                    if (src == n) goto incomplete;
+                }
+                if (buf[src] == '\n') {
+                    src++;
+                    goto complete;
+                }
+                d->state = QP_CHUNK_TRAILER_LINE;
+                /* fallthrough */
+
+            case QP_CHUNK_TRAILER_LINE:
+                /* Trailer fields are dropped */
+                for (;; src++) {
+                    if (src == n) goto incomplete;
+                    if (buf[src] == '\n') break;
+                }
+                src++;
+                d->state = QP_CHUNK_TRAILER_HEAD;
+                break;
+        }
+    }
+
+complete:
+    memmove(buf + dst, buf + src, n - src);
+    *len = dst;
+    return (ssize_t)(n - src);
+
+incomplete:
+    *len = dst;
+    return QUICPRO_H1_INCOMPLETE;
+}
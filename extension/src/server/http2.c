@@ -10,12 +10,14 @@
 
 #include <php.h>
 #include <zend_exceptions.h>
+#include <zend_interfaces.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <inttypes.h>
 #include <fcntl.h>
 #include <sys/epoll.h>
 #include <openssl/ssl.h>
@@ -23,17 +25,62 @@
 #include <nghttp2/nghttp2.h>
 
 #include "server/http2.h"
+#include "server/ticket_keys.h"
+#include "server/ocsp.h"
+#include "server/tls_offload.h"
+#include "server/ktls.h"
+#include "server/cert_store.h"
+#include "server/cert_watch.h"
+#include "server/tcp_listen.h"
+#include "server/tls_output.h"
+#include "server/header_template.h"
+#include "server/request.h"
+#include "server/body_spool.h"
+#include "cluster/cluster.h"
+#include "cluster/topology.h"
+#include "cluster/cluster_stats.h"
+#include "server/rate_limit.h"
+#include "server/open_telemetry.h"
+#include "server/metrics.h"
+#include "server/profiler.h"
+#include "server/live_config.h"
+#include "config/runtime.h"
+#include "config/tls_and_crypto/base_layer.h"
+#include "server/cors.h"
+#include "server/cdn_cache.h"
+#include "server/compress.h"
+#include "server/hint_learner.h"
+#include "server/priority.h"
+#include "server/overload.h"
+#include "server/access_log.h"
+#include "server/h2_flow.h"
+#include "config/http2/base_layer.h"
 
 #define READ_BUFFER_SIZE 16384
+#define FRAME_HEADER_LEN 9
+// RFC 9218 priorities, and changing them from the server: nghttp2 1.50
+#define QUICPRO_H2_EXTPRI (NGHTTP2_VERSION_NUM >= 0x013200)
 
 typedef struct http2_server_s http2_server_t;
 typedef struct http2_session_s http2_session_t;
 
-// Represents the data source for a response body
+// Represents the data source for a response body: a string, a file, a
+// Traversable (typically a Generator) yielding chunks, or a stream resource.
+// Only one chunk of a streamed body is held at a time.
 typedef struct {
-    char *data;
-    size_t len;
-    size_t offset;
+    size_t len; // Of `str`, or of the file
+    size_t offset; // Bytes handed to nghttp2
+    zend_string *str; // The string body, or the generator's current chunk
+    quicpro_file_body_t *file;
+    zend_object_iterator *iter;
+    bool iter_started;
+    quicpro_compress_stream_t *enc; // Encodes the generator's chunks (server/compress.h)
+    bool enc_done;
+    php_stream *stream;
+    zval stream_zv; // Holds the stream's resource
+    zend_string *slice; // Payload of the DATA frame being packed (NO_COPY), referenced
+    size_t slice_offset;
+    quicpro_cdn_body_t cdn; // Or the bytes of a cached body, copied from its slices
 } response_body_data_source;
 
 // Represents a single HTTP/2 stream
@@ -42,16 +89,36 @@ typedef struct {
     zval request_headers;
     char *request_body;
     size_t request_body_len;
+    quicpro_body_spool_t spool; // Takes over from request_body past tcp_body_spool_threshold_bytes
+    bool body_refused; // Reset for its body; DATA still in flight is dropped
     http2_session_t *session;
     response_body_data_source response_body;
+    long status; // As submitted, for the access log; 0 until then
 } http2_stream_t;
 
 // Represents a single client connection (session)
 struct http2_session_s {
     int fd;
     SSL *ssl;
+    quicpro_tls_handshake_t hs;
+    struct sockaddr_storage peer; // Keys the rate limiter
+    zend_long requests; // Streams dispatched on this connection
     nghttp2_session *ngh2_session;
+    quicpro_h2_flow_t flow; // Receive windows grown to the path's BDP (server/h2_flow.h)
     http2_server_t *server;
+    quicpro_tls_output_t out; // Coalesces small frames into full TLS records
+    // A DATA frame the socket has not fully taken; its frame header waits in
+    // `out`. The payload is a referenced string slice or, under kTLS, a file.
+    zend_string *pending_str;
+    quicpro_tls_iov_t pending_iov;
+    size_t pending_done;
+    quicpro_file_body_t *pending_file;
+    size_t pending_file_len;
+    bool pending_file_owned; // The stream closed first; free the file once sent
+    // Streams whose handler waits until their 103 (server/hint_learner.h) is sent
+    int32_t *hinted;
+    size_t hinted_len;
+    size_t hinted_cap;
 };
 
 // Represents the main HTTP/2 server
@@ -59,8 +126,10 @@ struct http2_server_s {
     int listen_fd;
     int epoll_fd;
     SSL_CTX *ssl_ctx;
+    quicpro_tls_offload_t *tls_offload; // Handshake pool, NULL when handshakes run on the loop
     zend_fcall_info fci;
     zend_fcall_info_cache fcc;
+    quicpro_request_pool_t requests; // The one Quicpro\Request reused across dispatches
     bool is_listening;
 };
 
@@ -72,17 +141,15 @@ static int on_data_chunk_recv_callback(nghttp2_session *session, uint8_t flags,
 static int on_stream_close_callback(nghttp2_session *session, int32_t stream_id, uint32_t error_code, void *user_data);
 static int on_frame_recv_callback(nghttp2_session *session, const nghttp2_frame *frame, void *user_data);
 static ssize_t response_read_callback(nghttp2_session *session, int32_t stream_id, uint8_t *buf, size_t length, uint32_t *data_flags, nghttp2_data_source *source, void *user_data);
+static int send_data_callback(nghttp2_session *session, nghttp2_frame *frame, const uint8_t *framehd, size_t length, nghttp2_data_source *source, void *user_data);
+static int flush_pending_data(http2_session_t *session_data, bool hold_tail);
+static int send_session(http2_session_t *session_data);
+static int dispatch_stream(nghttp2_session *session, http2_session_t *session_data, http2_stream_t *stream_data);
 static void handle_client_event(http2_session_t *session_data, uint32_t events);
 static void close_http2_session(http2_session_t *session);
 
 extern zend_class_entry *quicpro_config_ce;
 
-static int set_nonblocking(int fd) {
-    int flags;
-    if ((flags = fcntl(fd, F_GETFL, 0)) == -1) return -1;
-    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
-}
-
 static int alpn_select_proto_cb(SSL *ssl, const unsigned char **out, unsigned char *outlen,
                                 const unsigned char *in, unsigned int inlen, void *arg) {
     if (nghttp2_select_next_protocol((unsigned char **)out, outlen, in, inlen) <= 0) {
@@ -107,15 +174,16 @@ PHP_FUNCTION(quicpro_http2_server_listen)
         Z_PARAM_FUNC(fci, fcc)
     ZEND_PARSE_PARAMETERS_END();
 
-    zval *options_zv = zend_read_property(quicpro_config_ce, Z_OBJ_P(config_resource), "options", sizeof("options") - 1, 1, NULL);
-    zval *val;
-    char *cert_file = NULL, *key_file = NULL;
-    if (Z_TYPE_P(options_zv) == IS_ARRAY) {
-        if ((val = zend_hash_str_find(Z_ARRVAL_P(options_zv), "cert_file", sizeof("cert_file")-1)) && Z_TYPE_P(val) == IS_STRING) cert_file = Z_STRVAL_P(val);
-        if ((val = zend_hash_str_find(Z_ARRVAL_P(options_zv), "key_file", sizeof("key_file")-1)) && Z_TYPE_P(val) == IS_STRING) key_file = Z_STRVAL_P(val);
+    const quicpro_runtime_config_t *runtime = quicpro_runtime_config_of(config_resource);
+    if (!runtime) {
+        RETURN_FALSE;
     }
-    if (!cert_file || !key_file) {
-        zend_throw_exception(NULL, "HTTP/2 server requires 'cert_file' and 'key_file' in configuration.", 0);
+    // The Config's certificate, else php.ini's default; per-host ones come from the store
+    const char *cert_file = runtime->cert_file ? runtime->cert_file : quicpro_tls_crypto_config.tls_default_cert_file;
+    const char *key_file = runtime->key_file ? runtime->key_file : quicpro_tls_crypto_config.tls_default_key_file;
+    bool has_default = cert_file && cert_file[0] && key_file && key_file[0];
+    if (!has_default && !quicpro_cert_store_enabled()) {
+        zend_throw_exception(NULL, "HTTP/2 server requires 'cert_file' and 'key_file' in configuration, or quicpro.tls_cert_store_dir.", 0);
         RETURN_FALSE;
     }
 
@@ -123,65 +191,93 @@ PHP_FUNCTION(quicpro_http2_server_listen)
     memset(&server, 0, sizeof(server));
     server.fci = fci;
     server.fcc = fcc;
+    quicpro_request_pool_init(&server.requests);
 
     server.ssl_ctx = SSL_CTX_new(TLS_server_method());
     SSL_CTX_set_alpn_select_cb(server.ssl_ctx, alpn_select_proto_cb, NULL);
-    if (SSL_CTX_use_certificate_file(server.ssl_ctx, cert_file, SSL_FILETYPE_PEM) <= 0 ||
-        SSL_CTX_use_private_key_file(server.ssl_ctx, key_file, SSL_FILETYPE_PEM) <= 0) {
+    if (has_default && !quicpro_cert_store_use_files(server.ssl_ctx, cert_file, key_file)) {
         SSL_CTX_free(server.ssl_ctx);
         zend_throw_exception(NULL, "Failed to load TLS certificate/key.", 0);
         RETURN_FALSE;
     }
+    quicpro_cert_store_install(server.ssl_ctx);
+    quicpro_ticket_keys_install(server.ssl_ctx); // Resume on any worker
+    quicpro_ocsp_install(server.ssl_ctx); // Staples from the shared cache, never fetched in the handshake
+    quicpro_ktls_configure(server.ssl_ctx);
+    server.tls_offload = quicpro_tls_offload_new(server.ssl_ctx);
 
-    server.listen_fd = socket(AF_INET6, SOCK_STREAM, 0);
-    int reuse = 1;
-    setsockopt(server.listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
-    int off = 0;
-    setsockopt(server.listen_fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
-
-    struct sockaddr_in6 addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin6_family = AF_INET6;
-    addr.sin6_port = htons(port);
-    inet_pton(AF_INET6, host, &addr.sin6_addr);
-
-    if (bind(server.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || set_nonblocking(server.listen_fd) < 0 || listen(server.listen_fd, SOMAXCONN) < 0) {
+    // SO_REUSEPORT gives every worker its own accept queue (server/tcp_listen.h)
+    server.listen_fd = quicpro_tcp_listen(host, port);
+    if (server.listen_fd < 0) {
         zend_throw_exception_ex(NULL, 0, "HTTP/2 server failed to bind/listen: %s", strerror(errno));
-        close(server.listen_fd);
+        quicpro_tls_offload_destroy(server.tls_offload);
         SSL_CTX_free(server.ssl_ctx);
         RETURN_FALSE;
     }
 
     server.epoll_fd = epoll_create1(0);
-    struct epoll_event event;
-    event.events = EPOLLIN | EPOLLET;
-    event.data.ptr = &server;
-    epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.listen_fd, &event);
+    quicpro_tcp_listen_arm(server.listen_fd, server.epoll_fd, &server);
+    quicpro_topology_incoming_cpu(server.listen_fd); /* Pinned workers take their own RX CPU's packets */
+    quicpro_cluster_worker_listening(); /* A rolling reload may drain our predecessor now */
+    quicpro_tls_offload_watch(server.tls_offload, server.epoll_fd);
 
     #define MAX_EVENTS 128
     struct epoll_event events[MAX_EVENTS];
     server.is_listening = true;
+    quicpro_live_reader_t live;
+    quicpro_live_config_enter(&live);
+    live.tls_ctx = server.ssl_ctx;
+    quicpro_cert_watch_t cert_watch; // Renewed certificate files (server/cert_watch.h)
+    quicpro_cert_watch_init(&cert_watch, has_default ? cert_file : NULL, has_default ? key_file : NULL);
+    quicpro_cert_watch_arm(&cert_watch, server.epoll_fd);
 
     while (server.is_listening) {
+        // CORS, rate limits and the certificate the admin API changed (server/live_config.h).
+        quicpro_live_config_tick(&live, NULL);
+        quicpro_worker_wait_begin();
+        quicpro_overload_wait_begin();
         int n_events = epoll_wait(server.epoll_fd, events, MAX_EVENTS, -1);
+        quicpro_overload_wait_end();
+        quicpro_worker_wait_end(n_events);
         for (int i = 0; i < n_events; ++i) {
             if (events[i].data.ptr == &server) {
                 while (1) {
-                    int client_fd = accept(server.listen_fd, NULL, NULL);
+                    struct sockaddr_storage peer;
+                    int client_fd = quicpro_tcp_accept(server.listen_fd, &peer);
                     if (client_fd < 0) break;
-                    set_nonblocking(client_fd);
+                    if (!quicpro_rate_limit_admit_addr((struct sockaddr *)&peer)) {
+                        QUICPRO_WORKER_STAT(rate_limited);
+                        close(client_fd); // Before any TLS work
+                        continue;
+                    }
+                    QUICPRO_WORKER_STAT(connections_accepted);
                     
                     http2_session_t *session_data = ecalloc(1, sizeof(http2_session_t));
                     session_data->fd = client_fd;
+                    session_data->peer = peer;
                     session_data->server = &server;
                     session_data->ssl = SSL_new(server.ssl_ctx);
                     SSL_set_fd(session_data->ssl, client_fd);
+                    quicpro_tls_handshake_init(&session_data->hs, session_data->ssl, server.epoll_fd, session_data);
+                    quicpro_tls_output_init(&session_data->out);
                     
                     struct epoll_event ev;
                     ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
                     ev.data.ptr = session_data;
                     epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, client_fd, &ev);
                 }
+            } else if (events[i].data.ptr == &cert_watch) {
+                if (quicpro_cert_watch_changed(&cert_watch)) {
+                    quicpro_cert_watch_reload_ssl(&cert_watch, server.ssl_ctx);
+                }
+            } else if (server.tls_offload && events[i].data.ptr == server.tls_offload) {
+                // Handshakes finished by the pool; the step may have consumed the socket's edge
+                quicpro_tls_handshake_t *hs = quicpro_tls_offload_reap(server.tls_offload);
+                while (hs) {
+                    quicpro_tls_handshake_t *next = hs->next;
+                    handle_client_event((http2_session_t *)hs->owner, EPOLLIN | EPOLLOUT);
+                    hs = next;
+                }
             } else {
                 handle_client_event((http2_session_t *)events[i].data.ptr, events[i].events);
             }
@@ -189,30 +285,57 @@ PHP_FUNCTION(quicpro_http2_server_listen)
     }
 
     close(server.listen_fd);
+    quicpro_live_config_leave(&live);
+    quicpro_cert_watch_close(&cert_watch);
     close(server.epoll_fd);
+    quicpro_tls_offload_destroy(server.tls_offload);
     SSL_CTX_free(server.ssl_ctx);
+    quicpro_request_pool_free(&server.requests);
     RETURN_TRUE;
 }
 
 static void handle_client_event(http2_session_t *session_data, uint32_t events) {
     if (!session_data->ngh2_session) {
-        int ret = SSL_accept(session_data->ssl);
-        if (ret == 1) { // Handshake complete
-            nghttp2_session_callbacks *callbacks;
-            nghttp2_session_callbacks_new(&callbacks);
-            nghttp2_session_callbacks_set_send_callback(callbacks, send_callback);
-            nghttp2_session_callbacks_set_on_begin_headers_callback(callbacks, on_begin_headers_callback);
-            nghttp2_session_callbacks_set_on_header_callback(callbacks, on_header_callback);
-            nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, on_data_chunk_recv_callback);
-            nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, on_stream_close_callback);
-            nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, on_frame_recv_callback);
-            nghttp2_session_server_new(&session_data->ngh2_session, callbacks, session_data);
-            nghttp2_session_callbacks_del(callbacks);
-            nghttp2_submit_settings(session_data->ngh2_session, NGHTTP2_FLAG_NONE, NULL, 0);
-        } else if (SSL_get_error(session_data->ssl, ret) != SSL_ERROR_WANT_READ && SSL_get_error(session_data->ssl, ret) != SSL_ERROR_WANT_WRITE) {
+        int hs = quicpro_tls_handshake_step(session_data->server->tls_offload, &session_data->hs);
+        if (hs == QUICPRO_TLS_HS_FAILED) {
             close_http2_session(session_data);
             return;
         }
+        if (hs != QUICPRO_TLS_HS_DONE) {
+            return;
+        }
+        // Handshake complete
+        nghttp2_session_callbacks *callbacks;
+        nghttp2_session_callbacks_new(&callbacks);
+        nghttp2_session_callbacks_set_send_callback(callbacks, send_callback);
+        nghttp2_session_callbacks_set_send_data_callback(callbacks, send_data_callback);
+        nghttp2_session_callbacks_set_on_begin_headers_callback(callbacks, on_begin_headers_callback);
+        nghttp2_session_callbacks_set_on_header_callback(callbacks, on_header_callback);
+        nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, on_data_chunk_recv_callback);
+        nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, on_stream_close_callback);
+        nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, on_frame_recv_callback);
+        nghttp2_session_server_new(&session_data->ngh2_session, callbacks, session_data);
+        nghttp2_session_callbacks_del(callbacks);
+        // The `http2` module's windows and limits; the windows grow from here
+        int32_t window = (int32_t)MIN(quicpro_http2_config.initial_window_size, NGHTTP2_MAX_WINDOW_SIZE);
+        nghttp2_settings_entry settings[5];
+        size_t nsettings = 0;
+        settings[nsettings++] = (nghttp2_settings_entry){ NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, (uint32_t)window };
+        settings[nsettings++] = (nghttp2_settings_entry){ NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, (uint32_t)quicpro_http2_config.max_concurrent_streams };
+        settings[nsettings++] = (nghttp2_settings_entry){ NGHTTP2_SETTINGS_MAX_FRAME_SIZE, (uint32_t)quicpro_http2_config.max_frame_size };
+        if (quicpro_http2_config.max_header_list_size > 0) {
+            settings[nsettings++] = (nghttp2_settings_entry){ NGHTTP2_SETTINGS_MAX_HEADER_LIST_SIZE, (uint32_t)quicpro_http2_config.max_header_list_size };
+        }
+#if QUICPRO_H2_EXTPRI
+        // RFC 9218 instead of RFC 7540's tree: nghttp2 then schedules by the
+        // requests' priority fields and PRIORITY_UPDATE frames (server/priority.h)
+        settings[nsettings++] = (nghttp2_settings_entry){ NGHTTP2_SETTINGS_NO_RFC7540_PRIORITIES, 1 };
+#endif
+        nghttp2_submit_settings(session_data->ngh2_session, NGHTTP2_FLAG_NONE, settings, nsettings);
+        if (window > NGHTTP2_INITIAL_CONNECTION_WINDOW_SIZE) {
+            nghttp2_session_set_local_window_size(session_data->ngh2_session, NGHTTP2_FLAG_NONE, 0, window);
+        }
+        quicpro_h2_flow_init(&session_data->flow, window, MAX(window, NGHTTP2_INITIAL_CONNECTION_WINDOW_SIZE));
     }
 
     if (events & EPOLLIN) {
@@ -223,24 +346,49 @@ static void handle_client_event(http2_session_t *session_data, uint32_t events)
                 close_http2_session(session_data);
                 return;
             }
-        } else if (bytes_read == 0 || (bytes_read < 0 && SSL_get_error(session_data->ssl, bytes_read) != SSL_ERROR_WANT_READ)) {
+            if (session_data->hinted_len) {
+                // The 103s leave before their handlers run
+                if (send_session(session_data) < 0) {
+                    close_http2_session(session_data);
+                    return;
+                }
+                for (size_t i = 0; i < session_data->hinted_len; i++) {
+                    http2_stream_t *stream_data = nghttp2_session_get_stream_user_data(session_data->ngh2_session, session_data->hinted[i]);
+                    if (stream_data) dispatch_stream(session_data->ngh2_session, session_data, stream_data);
+                }
+                session_data->hinted_len = 0;
+            }
+        } else if (bytes_read == 0 || (bytes_read < 0 && !quicpro_tls_io_pending(&session_data->hs, (int)bytes_read))) {
             close_http2_session(session_data);
             return;
         }
     }
 
-    if (events & EPOLLOUT) {
-        if (nghttp2_session_send(session_data->ngh2_session) != 0) {
-            close_http2_session(session_data);
-            return;
-        }
+    // Responses submitted while reading go out now, not on the next EPOLLOUT edge
+    if (send_session(session_data) < 0) {
+        close_http2_session(session_data);
     }
 }
 
+// Finishes what is pending, lets nghttp2 queue more, then sends the last
+// partial record. Returns -1 on error.
+static int send_session(http2_session_t *session_data) {
+    int flushed = flush_pending_data(session_data, true);
+    if (flushed <= 0) return flushed;
+    if (nghttp2_session_send(session_data->ngh2_session) != 0) return -1;
+    return flush_pending_data(session_data, false);
+}
+
 static void close_http2_session(http2_session_t *session) {
     if (session) {
+        QUICPRO_WORKER_STAT(connections_closed);
         epoll_ctl(session->server->epoll_fd, EPOLL_CTL_DEL, session->fd, NULL);
+        quicpro_tls_handshake_forget(&session->hs);
         if (session->ngh2_session) nghttp2_session_del(session->ngh2_session);
+        if (session->pending_file_owned) { quicpro_file_body_close(session->pending_file); efree(session->pending_file); }
+        if (session->pending_str) zend_string_release(session->pending_str);
+        if (session->hinted) efree(session->hinted);
+        quicpro_tls_output_free(&session->out);
         if (session->ssl) { SSL_shutdown(session->ssl); SSL_free(session->ssl); }
         if (session->fd >= 0) close(session->fd);
         efree(session);
@@ -249,9 +397,12 @@ static void close_http2_session(http2_session_t *session) {
 
 static int on_begin_headers_callback(nghttp2_session *session, const nghttp2_frame *frame, void *user_data) {
     if (frame->hd.type != NGHTTP2_HEADERS || frame->headers.cat != NGHTTP2_HCAT_REQUEST) return 0;
+    QUICPRO_WORKER_STAT(streams);
+    quicpro_metrics_add(QUICPRO_METRIC_STREAMS, 1);
     http2_stream_t *stream_data = ecalloc(1, sizeof(http2_stream_t));
     stream_data->stream_id = frame->hd.stream_id;
     stream_data->session = (http2_session_t *)user_data;
+    quicpro_body_spool_init(&stream_data->spool);
     array_init(&stream_data->request_headers);
     nghttp2_session_set_stream_user_data(session, frame->hd.stream_id, stream_data);
     return 0;
@@ -261,13 +412,42 @@ static int on_header_callback(nghttp2_session *session, const nghttp2_frame *fra
     if (frame->hd.type != NGHTTP2_HEADERS || frame->headers.cat != NGHTTP2_HCAT_REQUEST) return 0;
     http2_stream_t *stream_data = nghttp2_session_get_stream_user_data(session, frame->hd.stream_id);
     if (!stream_data) return 0;
-    add_assoc_stringl(&stream_data->request_headers, (char*)name, (char*)value, valuelen);
+    zend_string *key = quicpro_header_name((const char*)name, namelen); // Interned when well-known
+    zval value_zv;
+    ZVAL_STRINGL(&value_zv, (const char*)value, valuelen);
+    zend_hash_update(Z_ARRVAL(stream_data->request_headers), key, &value_zv);
+    zend_string_release(key);
+    return 0;
+}
+
+// Appends to the stream's spool, moving what was buffered so far into it
+// first. A body past tcp_body_spool_max_bytes, or one the spool cannot
+// take, resets the stream.
+static int spool_stream_data(nghttp2_session *session, http2_stream_t *stream_data, const uint8_t *data, size_t len) {
+    quicpro_body_spool_t *spool = &stream_data->spool;
+    bool ok = spool->fd >= 0 || quicpro_body_spool_open(spool);
+    if (ok && stream_data->request_body) {
+        ok = quicpro_body_spool_write(spool, stream_data->request_body, stream_data->request_body_len);
+        efree(stream_data->request_body);
+        stream_data->request_body = NULL;
+        stream_data->request_body_len = 0;
+    }
+    ok = ok && spool->len + len <= quicpro_body_spool_max() && quicpro_body_spool_write(spool, data, len);
+    if (!ok) {
+        quicpro_body_spool_close(spool);
+        stream_data->body_refused = true;
+        nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, stream_data->stream_id, NGHTTP2_CANCEL);
+    }
     return 0;
 }
 
 static int on_data_chunk_recv_callback(nghttp2_session *session, uint8_t flags, int32_t stream_id, const uint8_t *data, size_t len, void *user_data) {
+    quicpro_h2_flow_on_data(&((http2_session_t *)user_data)->flow, session, len);
     http2_stream_t *stream_data = nghttp2_session_get_stream_user_data(session, stream_id);
-    if (!stream_data) return 0;
+    if (!stream_data || stream_data->body_refused) return 0;
+    if (stream_data->spool.fd >= 0 || quicpro_body_spool_wanted(stream_data->request_body_len + len)) {
+        return spool_stream_data(session, stream_data, data, len);
+    }
     stream_data->request_body = erealloc(stream_data->request_body, stream_data->request_body_len + len + 1);
     memcpy(stream_data->request_body + stream_data->request_body_len, data, len);
     stream_data->request_body_len += len;
@@ -275,68 +455,659 @@ static int on_data_chunk_recv_callback(nghttp2_session *session, uint8_t flags,
     return 0;
 }
 
+// Number of header lines a handler's 'headers' array expands to.
+static size_t count_header_values(HashTable *headers) {
+    size_t n = 0;
+    zval *entry;
+    ZEND_HASH_FOREACH_VAL(headers, entry) {
+        n += Z_TYPE_P(entry) == IS_ARRAY ? zend_hash_num_elements(Z_ARRVAL_P(entry)) : 1;
+    } ZEND_HASH_FOREACH_END();
+    return n;
+}
+
+// Appends one of the handler's headers, lower-cased as HTTP/2 requires.
+// The name and value strings stay in `owned` until the response is submitted.
+static void add_response_header(nghttp2_nv *nv, size_t *nvlen, zend_string **owned, size_t *owned_len,
+                                zend_string *name, zval *value_zv, bool *has_content_type) {
+    zend_string *value = zval_get_string(value_zv);
+    if (!quicpro_header_is_sendable(ZSTR_VAL(name), ZSTR_LEN(name), ZSTR_VAL(value), ZSTR_LEN(value))) {
+        php_error_docref(NULL, E_WARNING, "Response header '%s' dropped: invalid, or set by the server", ZSTR_VAL(name));
+        zend_string_release(value);
+        return;
+    }
+    zend_string *key = quicpro_header_name(ZSTR_VAL(name), ZSTR_LEN(name));
+    if (zend_string_equals_literal(key, "content-type")) *has_content_type = true;
+    nv[(*nvlen)++] = (nghttp2_nv){ (uint8_t*)ZSTR_VAL(key), (uint8_t*)ZSTR_VAL(value), ZSTR_LEN(key), ZSTR_LEN(value), NGHTTP2_NV_FLAG_NONE };
+    owned[(*owned_len)++] = key;
+    owned[(*owned_len)++] = value;
+}
+
+// A handler's 'priority' (see server/priority.h) on top of the request's
+// priority field; nghttp2's scheduler follows it from the next DATA frame on.
+static void apply_response_priority(nghttp2_session *session, int32_t stream_id, HashTable *request_headers, zval *priority_zv) {
+    quicpro_priority_t prio = QUICPRO_PRIORITY_DEFAULT;
+    zval *field_zv = zend_hash_str_find(request_headers, "priority", sizeof("priority")-1);
+    if (field_zv && Z_TYPE_P(field_zv) == IS_STRING) {
+        quicpro_priority_parse(Z_STRVAL_P(field_zv), Z_STRLEN_P(field_zv), &prio);
+    }
+    if (!quicpro_priority_from_zval(priority_zv, &prio)) {
+        zend_exception_error(EG(exception), E_WARNING);
+        zend_clear_exception();
+        return;
+    }
+#if QUICPRO_H2_EXTPRI
+    nghttp2_extpri extpri = { .urgency = prio.urgency, .inc = prio.incremental };
+    nghttp2_session_change_extpri_stream_priority(session, stream_id, &extpri, 1);
+#else
+    (void)session;
+    (void)stream_id;
+#endif
+}
+
+// The response cache's key for a GET or HEAD: :authority (or Host), :path,
+// the configured Vary headers and the negotiated coding. False for any
+// other request.
+static bool cdn_key(HashTable *request_headers, zval *method_zv, zval *path_zv, quicpro_coding_t coding, quicpro_cdn_key_t *key) {
+    if (!method_zv || Z_TYPE_P(method_zv) != IS_STRING || !path_zv || Z_TYPE_P(path_zv) != IS_STRING
+        || (!zend_string_equals_literal(Z_STR_P(method_zv), "GET") && !zend_string_equals_literal(Z_STR_P(method_zv), "HEAD"))
+        || !quicpro_cdn_cache_enabled()) {
+        return false;
+    }
+    zval *authority_zv = zend_hash_str_find(request_headers, ":authority", sizeof(":authority")-1);
+    if (!authority_zv) authority_zv = zend_hash_str_find(request_headers, "host", sizeof("host")-1);
+    bool has_authority = authority_zv && Z_TYPE_P(authority_zv) == IS_STRING;
+    quicpro_cdn_key_begin(key, has_authority ? Z_STRVAL_P(authority_zv) : "", has_authority ? Z_STRLEN_P(authority_zv) : 0,
+                          Z_STRVAL_P(path_zv), Z_STRLEN_P(path_zv));
+    for (size_t v = 0; v < quicpro_cdn_vary_count(); v++) {
+        size_t name_len;
+        const char *name = quicpro_cdn_vary_name(v, &name_len);
+        zval *h = zend_hash_str_find(request_headers, name, name_len);
+        bool present = h && Z_TYPE_P(h) == IS_STRING;
+        quicpro_cdn_key_vary(key, present ? Z_STRVAL_P(h) : NULL, present ? Z_STRLEN_P(h) : 0);
+    }
+    quicpro_cdn_key_coding(key, coding);
+    quicpro_cdn_key_end(key);
+    return key->ok;
+}
+
+// Answers from a cached object: its lines after :status and the CORS
+// lines, and its body or the request's byte range of it (read from the
+// object's slices, or sent like a 'file' body when it is in a disk
+// segment). Drops the reference. False if a slice of the body is gone:
+// a miss after all.
+static bool submit_cached(nghttp2_session *session, http2_stream_t *stream_data, const quicpro_cors_result_t *cors,
+                          quicpro_cdn_object_t *obj, const quicpro_cdn_key_t *key, bool head_only) {
+    HashTable *request_headers = Z_ARRVAL(stream_data->request_headers);
+    uint64_t first = 0, len = obj->body_len;
+    quicpro_cdn_range_t range = QUICPRO_CDN_RANGE_NONE;
+    zval *range_zv = obj->status == 200 ? zend_hash_str_find(request_headers, "range", sizeof("range")-1) : NULL;
+    if (range_zv && Z_TYPE_P(range_zv) == IS_STRING && !zend_hash_str_exists(request_headers, "if-range", sizeof("if-range")-1)) {
+        range = quicpro_cdn_range_parse(Z_STRVAL_P(range_zv), Z_STRLEN_P(range_zv), obj->body_len, &first, &len);
+    }
+    if (range == QUICPRO_CDN_RANGE_UNSATISFIABLE) {
+        len = 0;
+    }
+    bool has_body = !head_only && len > 0;
+    if (has_body && obj->body_fd >= 0) {
+        quicpro_file_body_t *file = emalloc(sizeof(*file));
+        quicpro_file_body_init(file);
+        if (quicpro_cdn_body_file_open(file, obj, first, len) < 0) {
+            efree(file);
+            quicpro_cdn_release(obj);
+            nghttp2_nv status = { (uint8_t*)":status", (uint8_t*)"503", sizeof(":status")-1, 3, NGHTTP2_NV_FLAG_NONE };
+            nghttp2_submit_response(session, stream_data->stream_id, &status, 1, NULL);
+            stream_data->status = 503;
+            return true;
+        }
+        stream_data->response_body.file = file;
+    } else if (has_body && !quicpro_cdn_body_open(&stream_data->response_body.cdn, key, obj, first, len)) {
+        quicpro_cdn_release(obj);
+        return false;
+    }
+    stream_data->response_body.len = has_body ? (size_t)len : 0;
+    stream_data->response_body.offset = 0;
+
+    char status_str[4];
+    char range_str[64];
+    long status = obj->status;
+    if (range == QUICPRO_CDN_RANGE_OK) {
+        status = 206;
+        snprintf(range_str, sizeof(range_str), "bytes %" PRIu64 "-%" PRIu64 "/%" PRIu64, first, first + len - 1, (uint64_t)obj->body_len);
+    } else if (range == QUICPRO_CDN_RANGE_UNSATISFIABLE) {
+        status = 416;
+        snprintf(range_str, sizeof(range_str), "bytes */%" PRIu64, (uint64_t)obj->body_len);
+    }
+    snprintf(status_str, sizeof(status_str), "%ld", status);
+    stream_data->status = status;
+    nghttp2_nv *hdrs = safe_emalloc(3 + (cors ? cors->nv_count : 0) + obj->nv_count, sizeof(nghttp2_nv), 0);
+    size_t nvlen = 0;
+    bool has_content_type = false;
+
+    hdrs[nvlen++] = (nghttp2_nv){ (uint8_t*)":status", (uint8_t*)status_str, sizeof(":status")-1, strlen(status_str), NGHTTP2_NV_FLAG_NONE };
+    if (cors) {
+        memcpy(hdrs + nvlen, cors->nv, cors->nv_count * sizeof(nghttp2_nv));
+        nvlen += cors->nv_count;
+    }
+    for (size_t i = 0; i < obj->nv_count; i++) {
+        if (obj->nv[i].namelen == sizeof("content-type")-1 && memcmp(obj->nv[i].name, "content-type", obj->nv[i].namelen) == 0) {
+            has_content_type = true;
+        }
+        hdrs[nvlen++] = obj->nv[i];
+    }
+    if (!has_content_type) {
+        hdrs[nvlen++] = (nghttp2_nv){ (uint8_t*)"content-type", (uint8_t*)"text/plain", sizeof("content-type")-1, sizeof("text/plain")-1, NGHTTP2_NV_FLAG_NONE };
+    }
+    if (range != QUICPRO_CDN_RANGE_NONE) {
+        hdrs[nvlen++] = (nghttp2_nv){ (uint8_t*)"content-range", (uint8_t*)range_str, sizeof("content-range")-1, strlen(range_str), NGHTTP2_NV_FLAG_NONE };
+    }
+
+    nghttp2_data_provider data_prd;
+    data_prd.source.ptr = stream_data;
+    data_prd.read_callback = response_read_callback;
+
+    nghttp2_submit_response(session, stream_data->stream_id, hdrs, nvlen, has_body ? &data_prd : NULL);
+    efree(hdrs);
+    quicpro_cdn_release(obj);
+    return true;
+}
+
+// The :authority (or Host) of a request, NULL if it has none
+static zval *request_authority(HashTable *request_headers) {
+    zval *authority_zv = zend_hash_str_find(request_headers, ":authority", sizeof(":authority")-1);
+    if (!authority_zv) authority_zv = zend_hash_str_find(request_headers, "host", sizeof("host")-1);
+    return authority_zv && Z_TYPE_P(authority_zv) == IS_STRING ? authority_zv : NULL;
+}
+
+// Submits a 103 with the route's learned preload links for a GET
+// (server/hint_learner.h). nghttp2 cannot send from inside its callbacks,
+// so the stream's handler then runs once the read is processed and the
+// 103 is on its way. False if there is nothing to hint.
+static bool submit_learned_hints(nghttp2_session *session, http2_session_t *session_data, http2_stream_t *stream_data) {
+    HashTable *request_headers = Z_ARRVAL(stream_data->request_headers);
+    zval *method_zv = zend_hash_str_find(request_headers, ":method", sizeof(":method")-1);
+    zval *path_zv = zend_hash_str_find(request_headers, ":path", sizeof(":path")-1);
+    if (!method_zv || Z_TYPE_P(method_zv) != IS_STRING || !zend_string_equals_literal(Z_STR_P(method_zv), "GET")
+        || !path_zv || Z_TYPE_P(path_zv) != IS_STRING) {
+        return false;
+    }
+    zval *authority_zv = request_authority(request_headers);
+    const quicpro_learned_hints_t *hints = quicpro_hint_learner_lookup(authority_zv ? Z_STRVAL_P(authority_zv) : "",
+                                                                        authority_zv ? Z_STRLEN_P(authority_zv) : 0,
+                                                                        Z_STRVAL_P(path_zv), Z_STRLEN_P(path_zv));
+    if (!hints) {
+        return false;
+    }
+    nghttp2_nv *hdrs = safe_emalloc(1 + hints->count, sizeof(nghttp2_nv), 0);
+    hdrs[0] = (nghttp2_nv){ (uint8_t*)":status", (uint8_t*)"103", sizeof(":status")-1, 3, NGHTTP2_NV_FLAG_NONE };
+    for (size_t i = 0; i < hints->count; i++) {
+        hdrs[1 + i] = (nghttp2_nv){ (uint8_t*)"link", (uint8_t*)ZSTR_VAL(hints->links[i]), sizeof("link")-1, ZSTR_LEN(hints->links[i]), NGHTTP2_NV_FLAG_NONE };
+    }
+    int rv = nghttp2_submit_headers(session, NGHTTP2_FLAG_NONE, stream_data->stream_id, NULL, hdrs, 1 + hints->count, NULL);
+    efree(hdrs);
+    if (rv != 0) {
+        return false;
+    }
+    if (session_data->hinted_len == session_data->hinted_cap) {
+        session_data->hinted_cap = session_data->hinted_cap ? session_data->hinted_cap * 2 : 8;
+        session_data->hinted = safe_erealloc(session_data->hinted, session_data->hinted_cap, sizeof(int32_t), 0);
+    }
+    session_data->hinted[session_data->hinted_len++] = stream_data->stream_id;
+    return true;
+}
+
+// CoDel admission (server/overload.h), by the request's priority field and
+// extended CONNECT for WebSockets (RFC 8441)
+static bool admit_stream(http2_stream_t *stream_data) {
+    if (!quicpro_overload_enabled()) {
+        return true;
+    }
+    HashTable *request_headers = Z_ARRVAL(stream_data->request_headers);
+    zval *priority_zv = zend_hash_str_find(request_headers, "priority", sizeof("priority")-1);
+    zval *protocol_zv = zend_hash_str_find(request_headers, ":protocol", sizeof(":protocol")-1);
+    bool has_priority = priority_zv && Z_TYPE_P(priority_zv) == IS_STRING;
+    bool websocket = protocol_zv && Z_TYPE_P(protocol_zv) == IS_STRING
+        && zend_string_equals_literal_ci(Z_STR_P(protocol_zv), "websocket");
+    quicpro_overload_class_t cls = quicpro_overload_classify(has_priority ? Z_STRVAL_P(priority_zv) : NULL,
+                                                             has_priority ? Z_STRLEN_P(priority_zv) : 0, websocket);
+    return quicpro_overload_admit(cls, quicpro_overload_round_arrival_us());
+}
+
 static int on_frame_recv_callback(nghttp2_session *session, const nghttp2_frame *frame, void *user_data) {
-    if (frame->hd.type != NGHTTP2_HEADERS || !(frame->hd.flags & NGHTTP2_FLAG_END_STREAM)) return 0;
+    if (quicpro_h2_flow_on_frame(&((http2_session_t *)user_data)->flow, session, frame)) return 0;
+    // The request is complete with the frame that ends the stream: its HEADERS, or the last DATA
+    if ((frame->hd.type != NGHTTP2_HEADERS && frame->hd.type != NGHTTP2_DATA) || !(frame->hd.flags & NGHTTP2_FLAG_END_STREAM)) return 0;
     
     http2_stream_t *stream_data = nghttp2_session_get_stream_user_data(session, frame->hd.stream_id);
-    if (!stream_data) return 0;
+    if (!stream_data || stream_data->body_refused) return 0;
+
+    http2_session_t *session_data = (http2_session_t*)user_data;
+    // The connection's first stream was admitted on accept
+    if (session_data->requests++ > 0 && !quicpro_rate_limit_admit_addr((struct sockaddr *)&session_data->peer)) {
+        QUICPRO_WORKER_STAT(rate_limited);
+        nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, frame->hd.stream_id, NGHTTP2_ENHANCE_YOUR_CALM);
+        return 0;
+    }
+    // Refused before any processing: the client may retry it elsewhere
+    if (!admit_stream(stream_data)) {
+        nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, frame->hd.stream_id, NGHTTP2_REFUSED_STREAM);
+        return 0;
+    }
+    if (submit_learned_hints(session, session_data, stream_data)) {
+        return 0;
+    }
+    return dispatch_stream(session, session_data, stream_data);
+}
+
+// The access log's record of the response just submitted (server/access_log.h).
+// Streamed bodies are not counted: their length is not known yet.
+static void log_stream(http2_session_t *session_data, http2_stream_t *stream_data, zval *method_zv, zval *path_zv,
+                       uint64_t since_us) {
+    quicpro_access_record_t *r = quicpro_access_log_begin();
+    if (!r) {
+        return;
+    }
+    r->protocol = QUICPRO_ACCESS_HTTP2;
+    r->status = (uint16_t)(stream_data->status ? stream_data->status : 500);
+    r->duration_us = (uint32_t)MIN(quicpro_metrics_now_us() - since_us, UINT32_MAX);
+    r->stream_id = (uint64_t)stream_data->stream_id;
+    r->bytes_in = stream_data->request_body_len + stream_data->spool.len;
+    r->bytes_out = stream_data->response_body.len;
+    if (method_zv && Z_TYPE_P(method_zv) == IS_STRING) {
+        quicpro_access_log_method(r, Z_STRVAL_P(method_zv), Z_STRLEN_P(method_zv));
+    }
+    if (path_zv && Z_TYPE_P(path_zv) == IS_STRING) {
+        quicpro_access_log_path(r, Z_STRVAL_P(path_zv), Z_STRLEN_P(path_zv));
+    }
+    quicpro_access_log_peer(r, (struct sockaddr *)&session_data->peer);
+    quicpro_access_log_commit(r);
+}
+
+// Runs the handler for a complete request and submits its response
+static int dispatch_stream(nghttp2_session *session, http2_session_t *session_data, http2_stream_t *stream_data) {
+    http2_server_t *server = session_data->server;
+    zval args[1], retval;
+    ZVAL_UNDEF(&retval);
+    uint64_t dispatched_us = quicpro_metrics_now_us();
+
+    // The header array already exists (nghttp2's buffers do not outlive
+    // its callbacks); the request references it and views the body
+    HashTable *request_headers = Z_ARRVAL(stream_data->request_headers);
+    zval *method_zv = zend_hash_str_find(request_headers, ":method", sizeof(":method")-1);
+    zval *path_zv = zend_hash_str_find(request_headers, ":path", sizeof(":path")-1);
 
-    zval args[1], retval, request_zv;
-    ZVAL_COPY(&request_zv, &stream_data->request_headers);
-    if (stream_data->request_body) {
-        add_assoc_stringl(&request_zv, "body", stream_data->request_body, stream_data->request_body_len);
+    // CORS (server/cors.h): preflights are answered here; an allowed
+    // origin's lines join the handler's response
+    const quicpro_cors_result_t *cors = NULL;
+    zval *origin_zv = zend_hash_str_find(request_headers, "origin", sizeof("origin")-1);
+    if (origin_zv && Z_TYPE_P(origin_zv) == IS_STRING) {
+        zval *acrm_zv = zend_hash_str_find(request_headers, "access-control-request-method", sizeof("access-control-request-method")-1);
+        bool preflight = acrm_zv && Z_TYPE_P(acrm_zv) == IS_STRING && method_zv && zend_string_equals_literal(Z_STR_P(method_zv), "OPTIONS");
+        zval *m = preflight ? acrm_zv : method_zv;
+        cors = quicpro_cors_check(Z_STRVAL_P(origin_zv), Z_STRLEN_P(origin_zv),
+                                  m ? Z_STRVAL_P(m) : "", m ? Z_STRLEN_P(m) : 0, preflight);
+        if (cors->verdict == QUICPRO_CORS_PREFLIGHT || cors->verdict == QUICPRO_CORS_PREFLIGHT_DENIED) {
+            nghttp2_nv hdrs[1 + QUICPRO_CORS_NV_MAX];
+            hdrs[0] = cors->verdict == QUICPRO_CORS_PREFLIGHT
+                ? (nghttp2_nv){ (uint8_t*)":status", (uint8_t*)"204", sizeof(":status")-1, 3, NGHTTP2_NV_FLAG_NONE }
+                : (nghttp2_nv){ (uint8_t*)":status", (uint8_t*)"403", sizeof(":status")-1, 3, NGHTTP2_NV_FLAG_NONE };
+            memcpy(hdrs + 1, cors->nv, cors->nv_count * sizeof(nghttp2_nv));
+            nghttp2_submit_response(session, stream_data->stream_id, hdrs, 1 + cors->nv_count, NULL);
+            return 0;
+        }
+        if (cors->verdict != QUICPRO_CORS_ALLOW) {
+            cors = NULL;
+        }
     }
-    ZVAL_COPY_VALUE(&args[0], &request_zv);
 
-    http2_server_t *server = ((http2_session_t*)user_data)->server;
+    // The response cache (server/cdn_cache.h) answers before the handler
+    bool head_only = method_zv && Z_TYPE_P(method_zv) == IS_STRING && zend_string_equals_literal(Z_STR_P(method_zv), "HEAD");
+    zval *accept_encoding_zv = zend_hash_str_find(request_headers, "accept-encoding", sizeof("accept-encoding")-1);
+    bool has_accept_encoding = accept_encoding_zv && Z_TYPE_P(accept_encoding_zv) == IS_STRING;
+    quicpro_coding_t coding = quicpro_compress_negotiate(has_accept_encoding ? Z_STRVAL_P(accept_encoding_zv) : NULL,
+                                                         has_accept_encoding ? Z_STRLEN_P(accept_encoding_zv) : 0);
+    quicpro_cdn_key_t key;
+    bool cacheable = cdn_key(request_headers, method_zv, path_zv, coding, &key);
+    bool leader = false;
+    if (cacheable) {
+        quicpro_cdn_object_t *hit = quicpro_cdn_lookup(&key);
+        // While another miss refreshes the key, its expired copy answers
+        // (a stream is not held back: HTTP/1 waits, see server/cdn_cache.h)
+        if (!hit && !(leader = quicpro_cdn_flight_begin(&key))) {
+            hit = quicpro_cdn_lookup_stale(&key);
+        }
+        if (hit && submit_cached(session, stream_data, cors, hit, &key, head_only)) {
+            QUICPRO_WORKER_STAT(cdn_hits);
+            log_stream(session_data, stream_data, method_zv, path_zv, dispatched_us);
+            return 0;
+        }
+        QUICPRO_WORKER_STAT(cdn_misses);
+    }
+    quicpro_request_view_t view = {
+        .method = method_zv ? Z_STRVAL_P(method_zv) : "", .method_len = method_zv ? Z_STRLEN_P(method_zv) : 0,
+        .uri = path_zv ? Z_STRVAL_P(path_zv) : "", .uri_len = path_zv ? Z_STRLEN_P(path_zv) : 0,
+        .protocol = "HTTP/2",
+        .headers = &stream_data->request_headers,
+        .body = stream_data->request_body, .body_len = stream_data->request_body_len,
+        .spool = stream_data->spool.fd >= 0 ? &stream_data->spool : NULL,
+    };
+    zend_object *request = quicpro_request_acquire(&server->requests, &view);
+    ZVAL_OBJ(&args[0], request);
+
+    // A SERVER span per stream, continuing the trace its traceparent names
+    quicpro_otel_context_t parent;
+    zval *traceparent_zv = zend_hash_str_find(request_headers, "traceparent", sizeof("traceparent")-1);
+    bool has_parent = traceparent_zv && Z_TYPE_P(traceparent_zv) == IS_STRING
+        && quicpro_otel_traceparent_parse(Z_STRVAL_P(traceparent_zv), Z_STRLEN_P(traceparent_zv), &parent);
+    quicpro_otel_scope_t scope;
+    bool traced = quicpro_otel_scope_open(&scope, view.method_len ? view.method : "HTTP", QUICPRO_OTEL_KIND_SERVER,
+                                          has_parent ? &parent : NULL);
+    if (traced) {
+        const char *query = memchr(view.uri, '?', view.uri_len);
+        quicpro_otel_span_attr_str(&scope.span, "http.request.method", view.method, view.method_len);
+        quicpro_otel_span_attr_str(&scope.span, "url.path", view.uri, query ? (size_t)(query - view.uri) : view.uri_len);
+        quicpro_otel_span_attr_str(&scope.span, "network.protocol.version", "2", 1);
+    }
+    long span_status = 500;
+
     server->fci.param_count = 1;
     server->fci.params = args;
     server->fci.retval = &retval;
 
-    if (zend_call_function(&server->fci, &server->fcc) == SUCCESS && Z_TYPE(retval) == IS_ARRAY) {
+    uint64_t started_us = quicpro_metrics_now_us();
+    uint64_t prof = quicpro_prof_begin();
+    bool called = zend_call_function(&server->fci, &server->fcc) == SUCCESS;
+    quicpro_prof_end(QUICPRO_PROF_PHP_CALLBACK, prof);
+    quicpro_metrics_observe_since(QUICPRO_METRIC_REQUEST_DURATION, started_us);
+
+    // A failed handler is answered from an expired copy if there is one
+    long handler_status = 500;
+    if (called && Z_TYPE(retval) == IS_ARRAY) {
+        zval *status_zv = zend_hash_str_find(Z_ARRVAL(retval), "status", sizeof("status")-1);
+        handler_status = status_zv ? zval_get_long(status_zv) : 200;
+    }
+    quicpro_cdn_object_t *stale = cacheable && handler_status >= 500 ? quicpro_cdn_lookup_stale(&key) : NULL;
+    if (stale && submit_cached(session, stream_data, cors, stale, &key, head_only)) {
+        // The expired copy answered
+    } else if (called && Z_TYPE(retval) == IS_ARRAY) {
         zval *status_zv = zend_hash_str_find(Z_ARRVAL(retval), "status", sizeof("status")-1);
         zval *body_zv = zend_hash_str_find(Z_ARRVAL(retval), "body", sizeof("body")-1);
-        
-        char status_str[4];
-        snprintf(status_str, sizeof(status_str), "%ld", status_zv ? zval_get_long(status_zv) : 200);
-        
-        nghttp2_nv hdrs[] = {
-            { (uint8_t*)":status", (uint8_t*)status_str, sizeof(":status")-1, strlen(status_str), NGHTTP2_NV_FLAG_NONE },
-            { (uint8_t*)"content-type", (uint8_t*)"text/plain", sizeof("content-type")-1, sizeof("text/plain")-1, NGHTTP2_NV_FLAG_NONE }
-        };
+        zval *file_zv = zend_hash_str_find(Z_ARRVAL(retval), "file", sizeof("file")-1);
+        long status = status_zv ? zval_get_long(status_zv) : 200;
+        bool has_body = false;
 
-        nghttp2_data_provider data_prd;
-        if (body_zv && Z_TYPE_P(body_zv) == IS_STRING) {
-            stream_data->response_body.data = Z_STRVAL_P(body_zv);
-            stream_data->response_body.len = Z_STRLEN_P(body_zv);
+        if (file_zv && Z_TYPE_P(file_zv) == IS_STRING) {
+            quicpro_file_body_t *file = emalloc(sizeof(*file));
+            quicpro_file_body_init(file);
+            if (quicpro_file_body_open(file, Z_STRVAL_P(file_zv)) == 0) {
+                stream_data->response_body.file = file;
+                stream_data->response_body.len = (size_t)file->remaining;
+                stream_data->response_body.offset = 0;
+                has_body = true;
+            } else {
+                efree(file);
+                status = 404;
+            }
+        } else if (body_zv && Z_TYPE_P(body_zv) == IS_STRING) {
+            stream_data->response_body.str = zend_string_copy(Z_STR_P(body_zv));
+            stream_data->response_body.len = ZSTR_LEN(stream_data->response_body.str);
             stream_data->response_body.offset = 0;
-            data_prd.source.ptr = stream_data;
-            data_prd.read_callback = response_read_callback;
+            has_body = true;
+        } else if (body_zv && Z_TYPE_P(body_zv) == IS_OBJECT && instanceof_function(Z_OBJCE_P(body_zv), zend_ce_traversable)) {
+            // Pulled one chunk per DATA frame; the generator stays suspended
+            // at its yield while the peer's flow-control window is closed
+            zend_object_iterator *iter = Z_OBJCE_P(body_zv)->get_iterator(Z_OBJCE_P(body_zv), body_zv, 0);
+            if (iter && !EG(exception)) {
+                stream_data->response_body.iter = iter;
+                has_body = true;
+            } else if (iter) {
+                zend_iterator_dtor(iter);
+            }
+        } else if (body_zv && Z_TYPE_P(body_zv) == IS_RESOURCE) {
+            php_stream *stream;
+            php_stream_from_zval_no_verify(stream, body_zv);
+            if (stream) {
+                // A short read must mean EOF; a socket stream then stalls the loop, a file does not
+                php_stream_set_option(stream, PHP_STREAM_OPTION_BLOCKING, 1, NULL);
+                ZVAL_COPY(&stream_data->response_body.stream_zv, body_zv);
+                stream_data->response_body.stream = stream;
+                has_body = true;
+            }
+        }
+        if (EG(exception)) {
+            zend_exception_error(EG(exception), E_WARNING);
+            status = 500;
+        }
+
+        char status_str[4];
+        snprintf(status_str, sizeof(status_str), "%ld", status);
+        span_status = status;
+        stream_data->status = status;
+
+        // :status, then the template's entries (sent from the template's
+        // own bytes), then the handler's 'headers', which nghttp2 copies
+        const quicpro_header_template_t *tmpl = NULL;
+        HashTable *extra = NULL;
+        zval *template_zv = zend_hash_str_find(Z_ARRVAL(retval), "template", sizeof("template")-1);
+        zval *headers_zv = zend_hash_str_find(Z_ARRVAL(retval), "headers", sizeof("headers")-1);
+        if (template_zv && Z_TYPE_P(template_zv) == IS_STRING) {
+            tmpl = quicpro_header_template_find(Z_STRVAL_P(template_zv), Z_STRLEN_P(template_zv));
+            if (!tmpl) {
+                php_error_docref(NULL, E_WARNING, "Unknown header template '%s'", Z_STRVAL_P(template_zv));
+            }
         }
+        if (headers_zv && Z_TYPE_P(headers_zv) == IS_ARRAY) {
+            extra = Z_ARRVAL_P(headers_zv);
+        }
+
+        if (method_zv && Z_TYPE_P(method_zv) == IS_STRING && zend_string_equals_literal(Z_STR_P(method_zv), "GET")
+            && path_zv && Z_TYPE_P(path_zv) == IS_STRING) {
+            zval *authority_zv = request_authority(request_headers);
+            quicpro_hint_learner_observe(authority_zv ? Z_STRVAL_P(authority_zv) : "", authority_zv ? Z_STRLEN_P(authority_zv) : 0,
+                                         Z_STRVAL_P(path_zv), Z_STRLEN_P(path_zv), status, tmpl, extra);
+        }
+
+        // Compression (server/compress.h): a string body at once, at the
+        // coding's best if the cache keeps it; a generator's chunk by chunk
+        zval *compress_zv = zend_hash_str_find(Z_ARRVAL(retval), "compress", sizeof("compress")-1);
+        bool compress = !compress_zv || zend_is_true(compress_zv);
+        bool varies = false;
+        response_body_data_source *body = &stream_data->response_body;
+        if (body->str) {
+            bool store = cacheable && !head_only;
+            varies = compress && quicpro_compress_response(&coding, store && quicpro_cdn_storable(status, tmpl, extra)
+                                                           ? QUICPRO_COMPRESS_MAX : QUICPRO_COMPRESS_FAST,
+                                                           status, tmpl, extra, &body->str);
+            body->len = ZSTR_LEN(body->str);
+            if (store) {
+                quicpro_cdn_store(&key, status, tmpl, extra, coding, varies, ZSTR_VAL(body->str), body->len);
+            }
+        } else if (body->iter) {
+            varies = compress && quicpro_compress_eligible(status, tmpl, extra);
+            body->enc = varies ? quicpro_compress_stream_new(coding, QUICPRO_COMPRESS_FAST) : NULL;
+            if (!body->enc) coding = QUICPRO_CODING_IDENTITY;
+        }
+        size_t coding_name_len = 0;
+        const char *coding_name = varies ? quicpro_coding_name(coding, &coding_name_len) : NULL;
+
+        size_t extra_max = extra ? count_header_values(extra) : 0;
+        size_t nvmax = 4 + (cors ? cors->nv_count : 0) + (tmpl ? tmpl->count : 0) + extra_max;
+        nghttp2_nv *hdrs = safe_emalloc(nvmax, sizeof(nghttp2_nv), 0);
+        zend_string **owned = extra_max ? safe_emalloc(extra_max * 2, sizeof(zend_string*), 0) : NULL;
+        size_t nvlen = 0, owned_len = 0;
+        bool has_content_type = tmpl && tmpl->has_content_type;
+
+        hdrs[nvlen++] = (nghttp2_nv){ (uint8_t*)":status", (uint8_t*)status_str, sizeof(":status")-1, strlen(status_str), NGHTTP2_NV_FLAG_NONE };
+        if (cors) {
+            memcpy(hdrs + nvlen, cors->nv, cors->nv_count * sizeof(nghttp2_nv));
+            nvlen += cors->nv_count;
+        }
+        if (tmpl) {
+            memcpy(hdrs + nvlen, tmpl->nv, tmpl->count * sizeof(nghttp2_nv));
+            nvlen += tmpl->count;
+        }
+        if (extra) {
+            zend_string *name;
+            zval *entry, *v;
+            ZEND_HASH_FOREACH_STR_KEY_VAL(extra, name, entry) {
+                if (!name) continue;
+                if (Z_TYPE_P(entry) == IS_ARRAY) {
+                    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(entry), v) {
+                        add_response_header(hdrs, &nvlen, owned, &owned_len, name, v, &has_content_type);
+                    } ZEND_HASH_FOREACH_END();
+                } else {
+                    add_response_header(hdrs, &nvlen, owned, &owned_len, name, entry, &has_content_type);
+                }
+            } ZEND_HASH_FOREACH_END();
+        }
+        if (!has_content_type) {
+            hdrs[nvlen++] = (nghttp2_nv){ (uint8_t*)"content-type", (uint8_t*)"text/plain", sizeof("content-type")-1, sizeof("text/plain")-1, NGHTTP2_NV_FLAG_NONE };
+        }
+        if (coding_name) {
+            hdrs[nvlen++] = (nghttp2_nv){ (uint8_t*)"content-encoding", (uint8_t*)coding_name, sizeof("content-encoding")-1, coding_name_len, NGHTTP2_NV_FLAG_NONE };
+        }
+        if (varies) {
+            hdrs[nvlen++] = (nghttp2_nv){ (uint8_t*)"vary", (uint8_t*)"accept-encoding", sizeof("vary")-1, sizeof("accept-encoding")-1, NGHTTP2_NV_FLAG_NONE };
+        }
+
+        // 'priority' overrides the client's for the rest of the stream
+        zval *priority_zv = zend_hash_str_find(Z_ARRVAL(retval), "priority", sizeof("priority")-1);
+        if (priority_zv) {
+            apply_response_priority(session, stream_data->stream_id, request_headers, priority_zv);
+        }
+
+        nghttp2_data_provider data_prd;
+        data_prd.source.ptr = stream_data;
+        data_prd.read_callback = response_read_callback;
+
+        nghttp2_submit_response(session, stream_data->stream_id, hdrs, nvlen, has_body ? &data_prd : NULL);
 
-        nghttp2_submit_response(session, stream_data->stream_id, hdrs, 2, (body_zv && Z_TYPE_P(body_zv) == IS_STRING) ? &data_prd : NULL);
+        for (size_t i = 0; i < owned_len; i++) {
+            zend_string_release(owned[i]);
+        }
+        if (owned) efree(owned);
+        efree(hdrs);
+    }
+    if (traced) {
+        quicpro_otel_span_attr_int(&scope.span, "http.response.status_code", span_status);
+        scope.span.error = span_status >= 500;
+    }
+    quicpro_otel_scope_close(&scope);
+    if (leader) {
+        quicpro_cdn_flight_end(&key);
     }
     
-    zval_ptr_dtor(&args[0]);
+    log_stream(session_data, stream_data, method_zv, path_zv, dispatched_us);
+
     zval_ptr_dtor(&retval);
+    quicpro_request_release(&server->requests, request);
     return 0;
 }
 
+// Replaces the current chunk with the generator's next non-empty one,
+// encoded if the response is compressed (the encoder's tail is the last).
+// Returns 1 for a chunk, 0 at the end, -1 if the generator threw.
+static int next_body_chunk(response_body_data_source *body) {
+    zend_object_iterator *iter = body->iter;
+
+    if (body->str) { zend_string_release(body->str); body->str = NULL; }
+    for (;;) {
+        if (!body->iter_started) {
+            body->iter_started = true;
+            if (iter->funcs->rewind) iter->funcs->rewind(iter);
+        } else {
+            iter->funcs->move_forward(iter);
+        }
+        if (EG(exception)) return -1;
+        if (iter->funcs->valid(iter) != SUCCESS) {
+            if (!body->enc || body->enc_done) return 0;
+            body->enc_done = true;
+            zend_string *tail = quicpro_compress_stream_write(body->enc, NULL, 0, true);
+            if (!tail) return -1;
+            if (ZSTR_LEN(tail) == 0) { zend_string_release(tail); return 0; }
+            body->str = tail;
+            body->len = ZSTR_LEN(tail);
+            body->offset = 0;
+            return 1;
+        }
+        zval *chunk = iter->funcs->get_current_data(iter);
+        if (EG(exception) || !chunk) return -1;
+        zend_string *str = zval_try_get_string(chunk);
+        if (!str) return -1;
+        if (body->enc && ZSTR_LEN(str) > 0) {
+            zend_string *encoded = quicpro_compress_stream_write(body->enc, ZSTR_VAL(str), ZSTR_LEN(str), false);
+            zend_string_release(str);
+            if (!encoded) return -1;
+            str = encoded;
+        }
+        if (ZSTR_LEN(str) > 0) {
+            body->str = str;
+            body->len = ZSTR_LEN(str);
+            body->offset = 0;
+            return 1;
+        }
+        zend_string_release(str);
+    }
+}
+
 static ssize_t response_read_callback(nghttp2_session *session, int32_t stream_id, uint8_t *buf, size_t length, uint32_t *data_flags, nghttp2_data_source *source, void *user_data) {
     http2_stream_t *stream_data = (http2_stream_t *)source->ptr;
-    size_t remaining = stream_data->response_body.len - stream_data->response_body.offset;
-    size_t to_copy = (length < remaining) ? length : remaining;
+    response_body_data_source *body = &stream_data->response_body;
+    quicpro_file_body_t *file = body->file;
+    // A full frame, header included, fills exactly one TLS record
+    if (length > QUICPRO_TLS_RECORD_MAX - FRAME_HEADER_LEN) length = QUICPRO_TLS_RECORD_MAX - FRAME_HEADER_LEN;
 
-    if (to_copy > 0) {
-        memcpy(buf, stream_data->response_body.data + stream_data->response_body.offset, to_copy);
-        stream_data->response_body.offset += to_copy;
+    if (file) {
+        // `offset` counts bytes handed to nghttp2; the file's own offset what actually left
+        size_t remaining = body->len - body->offset;
+        size_t n = (length < remaining) ? length : remaining;
+        if (quicpro_ktls_send_active(((http2_session_t *)user_data)->ssl)) {
+            *data_flags |= NGHTTP2_DATA_FLAG_NO_COPY; // send_data_callback sends it from the page cache
+        } else if (n > 0 && quicpro_file_body_read(file, buf, n) != (ssize_t)n) {
+            return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE; // The file shrank or failed
+        }
+        body->offset += n;
+        if (n == remaining) *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+        return n;
     }
 
-    if (stream_data->response_body.offset == stream_data->response_body.len) {
-        *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+    if (body->cdn.count) {
+        size_t n = quicpro_cdn_body_read(&body->cdn, body->offset, (char *)buf, length);
+        body->offset += n;
+        if (body->offset == body->len) *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+        return n;
     }
-    
-    return to_copy;
+
+    if (body->stream) {
+        // Read straight into the frame: no intermediate chunk to copy from
+        ssize_t n = php_stream_read(body->stream, (char *)buf, length);
+        if (n < 0) return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+        if (n == 0 || php_stream_eof(body->stream)) *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+        return n;
+    }
+
+    if (body->iter && body->offset == body->len) {
+        int got = next_body_chunk(body);
+        if (got < 0) {
+            if (EG(exception)) zend_exception_error(EG(exception), E_WARNING);
+            return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE; // Resets the stream
+        }
+        if (got == 0) {
+            *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+            return 0;
+        }
+    }
+
+    // In-memory payloads are sent from the string itself by send_data_callback
+    size_t remaining = body->len - body->offset;
+    size_t n = (length < remaining) ? length : remaining;
+    if (n > 0) {
+        body->slice = zend_string_copy(body->str);
+        body->slice_offset = body->offset;
+        body->offset += n;
+    }
+    *data_flags |= NGHTTP2_DATA_FLAG_NO_COPY;
+    if (!body->iter && body->offset == body->len) *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+    return n;
 }
 
 static int on_stream_close_callback(nghttp2_session *session, int32_t stream_id, uint32_t error_code, void *user_data) {
@@ -344,18 +1115,105 @@ static int on_stream_close_callback(nghttp2_session *session, int32_t stream_id,
     if (stream_data) {
         zval_ptr_dtor(&stream_data->request_headers);
         if (stream_data->request_body) efree(stream_data->request_body);
+        quicpro_body_spool_close(&stream_data->spool);
+        response_body_data_source *body = &stream_data->response_body;
+        if (body->str) zend_string_release(body->str);
+        if (body->slice) zend_string_release(body->slice);
+        if (body->iter) zend_iterator_dtor(body->iter);
+        if (body->enc) quicpro_compress_stream_free(body->enc);
+        if (body->stream) zval_ptr_dtor(&body->stream_zv);
+        quicpro_cdn_body_close(&body->cdn);
+        if (stream_data->response_body.file) {
+            http2_session_t *session_data = (http2_session_t *)user_data;
+            if (session_data->pending_file == stream_data->response_body.file) {
+                session_data->pending_file_owned = true; // Still being sent
+            } else {
+                quicpro_file_body_close(stream_data->response_body.file);
+                efree(stream_data->response_body.file);
+            }
+        }
         efree(stream_data);
     }
     return 0;
 }
 
+// Small frames are staged and share records; large ones are written where
+// nghttp2 serialised them, after whatever is staged.
 static ssize_t send_callback(nghttp2_session *session, const uint8_t *data, size_t length, int flags, void *user_data) {
     http2_session_t *session_data = (http2_session_t *)user_data;
-    ssize_t bytes_written = SSL_write(session_data->ssl, data, length);
-    if (bytes_written <= 0) {
-        int err = SSL_get_error(session_data->ssl, bytes_written);
-        if (err == SSL_ERROR_WANT_WRITE) return NGHTTP2_ERR_WOULDBLOCK;
-        return NGHTTP2_ERR_CALLBACK_FAILURE;
+    if (session_data->pending_str || session_data->pending_file) return NGHTTP2_ERR_WOULDBLOCK; // Frames must not overtake a DATA payload
+
+    int ret = 1;
+    if (length >= QUICPRO_TLS_OUTPUT_DIRECT_MIN) {
+        ret = quicpro_tls_output_flush(&session_data->hs, &session_data->out);
+        if (ret > 0) ret = quicpro_tls_output_write(&session_data->hs, data, length);
+        if (ret > 0) return (ssize_t)length;
+    } else {
+        size_t took = quicpro_tls_output_stage(&session_data->out, data, length);
+        if (took == length) return (ssize_t)took;
+        ret = quicpro_tls_output_flush(&session_data->hs, &session_data->out);
+        if (ret >= 0 && took) return (ssize_t)took; // The rest starts the next record
+        if (ret > 0) return (ssize_t)quicpro_tls_output_stage(&session_data->out, data, length);
+    }
+    return ret == 0 ? NGHTTP2_ERR_WOULDBLOCK : NGHTTP2_ERR_CALLBACK_FAILURE;
+}
+
+// nghttp2 considers the frame sent once this returns 0; whatever the socket
+// does not take now is finished by flush_pending_data() on EPOLLOUT.
+static int send_data_callback(nghttp2_session *session, nghttp2_frame *frame, const uint8_t *framehd, size_t length, nghttp2_data_source *source, void *user_data) {
+    http2_session_t *session_data = (http2_session_t *)user_data;
+    http2_stream_t *stream_data = (http2_stream_t *)source->ptr;
+    response_body_data_source *body = &stream_data->response_body;
+    if (session_data->pending_str || session_data->pending_file) return NGHTTP2_ERR_WOULDBLOCK;
+
+    // The 9-byte frame header rides in the current record instead of its own
+    if (session_data->out.stage_busy || session_data->out.stage_len > QUICPRO_TLS_RECORD_MAX - FRAME_HEADER_LEN) {
+        int ret = quicpro_tls_output_flush(&session_data->hs, &session_data->out);
+        if (ret <= 0) return ret == 0 ? NGHTTP2_ERR_WOULDBLOCK : NGHTTP2_ERR_CALLBACK_FAILURE;
+    }
+    quicpro_tls_output_stage(&session_data->out, framehd, FRAME_HEADER_LEN);
+
+    if (body->file) {
+        session_data->pending_file = body->file;
+        session_data->pending_file_len = length;
+        session_data->pending_file_owned = false;
+    } else if (length > 0) {
+        // The slice's reference moves to the session; it outlives the stream if need be
+        session_data->pending_str = body->slice;
+        session_data->pending_iov.base = ZSTR_VAL(body->slice) + body->slice_offset;
+        session_data->pending_iov.len = length;
+        session_data->pending_done = 0;
+        body->slice = NULL;
+    }
+    return flush_pending_data(session_data, true) < 0 ? NGHTTP2_ERR_CALLBACK_FAILURE : 0;
+}
+
+// Returns 1 when nothing is pending, 0 when the socket blocked, -1 on error.
+// With `hold_tail` a partial last record may stay staged for later frames.
+static int flush_pending_data(http2_session_t *session_data, bool hold_tail) {
+    int ret;
+    if (session_data->pending_str) {
+        ret = quicpro_tls_output_gather(&session_data->hs, &session_data->out, &session_data->pending_iov, 1,
+                                        &session_data->pending_done, true);
+        if (ret <= 0) return ret;
+        zend_string_release(session_data->pending_str); // Staged bytes are copies
+        session_data->pending_str = NULL;
+    }
+    if (!session_data->pending_file) {
+        return hold_tail ? 1 : quicpro_tls_output_flush(&session_data->hs, &session_data->out);
+    }
+    ret = quicpro_tls_output_flush(&session_data->hs, &session_data->out);
+    if (ret <= 0) return ret;
+    while (session_data->pending_file_len > 0) {
+        ssize_t n = quicpro_file_body_send(session_data->ssl, session_data->pending_file, session_data->pending_file_len);
+        if (n <= 0) return quicpro_tls_io_pending(&session_data->hs, (int)n) ? 0 : -1;
+        session_data->pending_file_len -= (size_t)n;
+    }
+    if (session_data->pending_file_owned) {
+        quicpro_file_body_close(session_data->pending_file);
+        efree(session_data->pending_file);
     }
-    return bytes_written;
+    session_data->pending_file = NULL;
+    session_data->pending_file_owned = false;
+    return 1;
 }
@@ -26,51 +26,242 @@
 
 #include "quiche.h"
 #include "server/http3.h"
-#include "session/session.h" // Assuming this will define quicpro_session_t
+#include "client/session.h"
+#include "poll/udp_batch.h"
+#include "poll/uring.h"
+#include "poll/busy_poll.h"
+#include "poll/hibernate.h"
+#include "server/cid.h"
+#include "server/reuseport.h"
+#include "server/router.h"
+#include "server/proxy.h"
+#include "cluster/cluster.h"
+#include "cluster/topology.h"
+#include "cluster/cluster_stats.h"
+#include "server/retry.h"
+#include "server/slab.h"
+#include "server/path.h"
+#include "server/zero_rtt.h"
+#include "server/rate_limit.h"
+#include "server/xdp_filter.h"
+#include "server/conn_snapshot.h"
+#include "server/conn_stats.h"
+#include "server/open_telemetry.h"
+#include "server/metrics.h"
+#include "server/qlog.h"
+#include "server/capture.h"
+#include "server/profiler.h"
+#include "server/live_config.h"
+#include "server/cert_watch.h"
+#include "config/runtime.h"
+#include "server/admin_events.h"
+#include "server/ticket_keys.h"
+#include "mcp/mcp_server.h"
+#include "server/cancel.h"
+#include "server/io_thread.h"
+#include "server/overload.h"
+#include "server/replay.h"
+#include "config/bare_metal_tuning/base_layer.h"
+
+// Up to this many datagrams opening connections wait out a running handler.
+#define HTTP3_DEFERRED_MAX 64
+
+// A datagram received while a handler ran (see http3_server_pump()), as it arrived.
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    struct sockaddr_storage peer_addr;
+    socklen_t peer_addr_len;
+} http3_deferred_t;
 
 // The core server object, holding its state.
 typedef struct {
     int fd;
     int epoll_fd;
-    HashTable *sessions_by_scid;
-    quiche_config *quic_config;
+    quicpro_cid_table_t *sessions_by_scid; // Issued SCID -> quicpro_session_t
+    quicpro_runtime_config_t *runtime; // The Config object, compiled (config/runtime.h)
+    quiche_config *quic_config; // runtime->quic
     zend_fcall_info fci;
     zend_fcall_info_cache fcc;
     bool is_listening;
+    quicpro_uring_t *uring; // io_uring engine when quicpro.io_engine_use_uring is on, else NULL.
+    quicpro_udp_rx_batch_t *rx_batch; // recvmmsg() slots for the epoll path.
+    quicpro_retry_state_t retry; // Accept rate and Retry counters.
+    struct sockaddr_storage local_addr; // Bound address, the `to` of every datagram.
+    socklen_t local_addr_len;
+    uint64_t ticket_key_gen; // Ticket key generation last handed to quic_config.
+    quicpro_io_thread_t *io; // Owns the socket with quicpro.io_thread_split (server/io_thread.h), else NULL.
+    bool pumping; // Receiving from inside a handler (server/cancel.h).
+    http3_deferred_t deferred[HTTP3_DEFERRED_MAX]; // What pumping could not route yet.
+    unsigned n_deferred;
+    uint32_t capture_gen; // Capture arming requests already applied (server/capture.h).
 } http3_server_t;
 
 // Resource IDs to be defined in the main extension file during MINIT.
 extern int le_quicpro_session;
 extern zend_class_entry *quicpro_config_ce;
 
-// Forward declaration for the internal session destructor.
-void quicpro_session_dtor_internal(void *session);
+// Routes one inbound datagram to its session, accepting a new connection for
+// unknown DCIDs. Shared by the epoll and io_uring receive paths.
+static void http3_server_on_datagram(void *ctx, uint8_t *buffer, size_t read_len,
+                                     const struct sockaddr *peer_addr, socklen_t peer_addr_len,
+                                     const struct timespec *rx_ts) {
+    http3_server_t *server = (http3_server_t *)ctx;
+    uint8_t scid[QUICHE_MAX_CONN_ID_LEN], dcid[QUICHE_MAX_CONN_ID_LEN];
+    size_t scid_len = sizeof(scid), dcid_len = sizeof(dcid);
+
+    uint8_t token[QUICPRO_RETRY_TOKEN_MAX];
+    size_t token_len = sizeof(token);
+    uint32_t version = 0;
+    uint8_t type = 0;
+    uint8_t *received = buffer;
+    size_t received_len = read_len;
+    const struct sockaddr *received_from = peer_addr;
+    socklen_t received_from_len = peer_addr_len;
+
+    // Relayed by a router (server/router.h): its header names the client
+    quicpro_router_relay_t relay;
+    int relayed = quicpro_router_unwrap(&buffer, &read_len, &peer_addr, &peer_addr_len, &relay);
+    if (relayed < 0) {
+        return;
+    }
+
+    if (quiche_header_info(buffer, read_len, QUICHE_MAX_CONN_ID_LEN, &version, &type,
+                           scid, &scid_len, dcid, &dcid_len, token, &token_len) < 0) {
+        return;
+    }
+
+    quicpro_session_t *session = quicpro_cid_table_find(server->sessions_by_scid, dcid, dcid_len);
+
+    if (session == NULL && server->pumping) {
+        // A handler is running: accepting would change the session table under
+        // the loop that called it. The loop replays the datagram when it resumes.
+        if (server->n_deferred < HTTP3_DEFERRED_MAX && received_from_len <= sizeof(struct sockaddr_storage)) {
+            http3_deferred_t *d = &server->deferred[server->n_deferred++];
+            d->data = emalloc(received_len);
+            memcpy(d->data, received, received_len);
+            d->len = received_len;
+            memcpy(&d->peer_addr, received_from, received_from_len);
+            d->peer_addr_len = received_from_len;
+        }
+        return;
+    }
+
+    if (session == NULL) {
+        // A crashed predecessor's connection: let the client know now instead of at its idle timeout.
+        if (quicpro_conn_snapshot_reset(server->fd, buffer, read_len, dcid, dcid_len, peer_addr, peer_addr_len)) {
+            return;
+        }
+
+        uint8_t odcid[QUICHE_MAX_CONN_ID_LEN];
+        size_t odcid_len = 0;
+        if (quicpro_retry_screen(&server->retry, server->fd, buffer, read_len, version, type,
+                                 scid, scid_len, dcid, dcid_len,
+                                 token, token_len, peer_addr, peer_addr_len, odcid, &odcid_len) != QUICPRO_RETRY_ACCEPT) {
+            return;
+        }
+        if (!quicpro_rate_limit_admit_addr(peer_addr)) {
+            QUICPRO_WORKER_STAT(rate_limited);
+            return; // Over its limit: no connection state, no reply
+        }
+
+        // After a Retry the client already addresses the SCID we chose; keep it.
+        if (odcid_len > 0 && dcid_len == QUICHE_MAX_CONN_ID_LEN) {
+            memcpy(scid, dcid, QUICHE_MAX_CONN_ID_LEN);
+        } else if (quicpro_cid_generate(scid, QUICHE_MAX_CONN_ID_LEN) < 0) {
+            return;
+        }
+
+        quicpro_conn_snapshot_advertise(server->quic_config, scid, QUICHE_MAX_CONN_ID_LEN);
+        // A peer whose prefix we have measured starts at its learned BDP (server/congestion.h).
+        quicpro_cc_warm_start(server->quic_config, &server->runtime->cc, peer_addr);
+        quiche_conn *conn = quiche_accept(scid, QUICHE_MAX_CONN_ID_LEN, odcid_len > 0 ? odcid : NULL, odcid_len,
+                                          peer_addr, peer_addr_len, server->quic_config);
+        if (conn == NULL) return;
+        quicpro_replay_keylog_conn(conn); // SSLKEYLOGFILE, for decrypting a capture
+        quicpro_retry_note_accept(&server->retry);
+
+        session = quicpro_server_session_alloc();
+        if (session == NULL) {
+            quiche_conn_free(conn);
+            return;
+        }
+        session->conn = conn;
+        memcpy(&session->peer_addr, peer_addr, peer_addr_len);
+        session->peer_addr_len = peer_addr_len;
+        memcpy(&session->local_addr, &server->local_addr, server->local_addr_len);
+        session->local_addr_len = server->local_addr_len;
+        quicpro_zero_rtt_note_accept(session, dcid, dcid_len);
+        quicpro_qlog_conn_started(session, scid, QUICHE_MAX_CONN_ID_LEN);
+        quicpro_capture_conn_started(session, scid, QUICHE_MAX_CONN_ID_LEN, dcid, dcid_len);
+        quicpro_admin_event_conn_open(&session->peer_addr);
+
+        quicpro_cid_table_add(server->sessions_by_scid, scid, QUICHE_MAX_CONN_ID_LEN, session);
+        quicpro_xdp_filter_cid_add(scid, QUICHE_MAX_CONN_ID_LEN);
+    }
+
+    quicpro_io_session_acquire(session);
+    quicpro_router_note_path(session, &relay, relayed);
+    quiche_recv_info recv_info = quicpro_server_path_recv_info(session, peer_addr, peer_addr_len);
+    quicpro_capture_rx(session, peer_addr, buffer, read_len); // Before quiche decrypts it in place
+    uint64_t prof = quicpro_prof_begin();
+    quiche_conn_recv(session->conn, buffer, read_len, &recv_info);
+    quicpro_prof_end(QUICPRO_PROF_CONN_RECV, prof);
+    quicpro_session_touch(session);
+    quicpro_server_path_events(session);
+    if (rx_ts) {
+        session->last_rx_ts = *rx_ts;
+    }
+    quicpro_io_session_release(session);
+}
 
-// Generates a new cryptographically secure Connection ID.
-static int generate_cid(uint8_t *cid, size_t len) {
-    int urandom_fd = open("/dev/urandom", O_RDONLY);
-    if (urandom_fd < 0) {
-        return -1;
+// With an I/O thread: the datagrams it left to this thread.
+static void http3_server_take_forwarded(http3_server_t *server) {
+    quicpro_io_dgram_t *d;
+    while ((d = quicpro_io_thread_next(server->io))) {
+        http3_server_on_datagram(server, d->data, d->len, (const struct sockaddr *)&d->from, d->from_len,
+                                 d->has_ts ? &d->rx_ts : NULL);
+        quicpro_io_dgram_free(d);
     }
-    ssize_t result = read(urandom_fd, cid, len);
-    close(urandom_fd);
-    return (result == (ssize_t)len) ? 0 : -1;
 }
 
-// Helper to apply settings from the PHP Config object to the C quiche_config struct.
-static void apply_config_to_quiche(quiche_config *quic_config, zval *config_obj)
-{
-    zval *options_zv = zend_read_property(quicpro_config_ce, Z_OBJ_P(config_obj), "options", sizeof("options") - 1, 1, NULL);
-    if (Z_TYPE_P(options_zv) != IS_ARRAY) return;
+// The proxy splices run over many connections at once (server/proxy.h).
+static void http3_server_hold_all(http3_server_t *server, bool hold) {
+    const uint8_t *key;
+    size_t key_len, pos = 0;
+    quicpro_session_t *session;
+    while ((session = quicpro_cid_table_next(server->sessions_by_scid, &pos, &key, &key_len))) {
+        if (hold) {
+            quicpro_io_session_acquire(session);
+        } else {
+            quicpro_io_session_release(session);
+        }
+    }
+}
 
-    zval *val;
-    if ((val = zend_hash_str_find(Z_ARRVAL_P(options_zv), "cert_file", sizeof("cert_file")-1)) && Z_TYPE_P(val) == IS_STRING) {
-        quiche_config_load_cert_chain_from_pem_file(quic_config, Z_STRVAL_P(val));
+// Lent to the cancellation tokens while a handler runs: feeds what is
+// pending on the socket to the known connections, so a handler waiting on
+// downstream calls sees its client's STOP_SENDING (server/cancel.h).
+static void http3_server_pump(void *ctx) {
+    http3_server_t *server = (http3_server_t *)ctx;
+    server->pumping = true;
+    if (server->io) {
+        http3_server_take_forwarded(server);
+    } else {
+        quicpro_udp_drain(server->fd, server->rx_batch, (unsigned)quicpro_bare_metal_config.io_max_drain_packets,
+                          http3_server_on_datagram, server);
     }
-    if ((val = zend_hash_str_find(Z_ARRVAL_P(options_zv), "key_file", sizeof("key_file")-1)) && Z_TYPE_P(val) == IS_STRING) {
-        quiche_config_load_priv_key_from_pem_file(quic_config, Z_STRVAL_P(val));
+    server->pumping = false;
+}
+
+static void http3_server_replay_deferred(http3_server_t *server) {
+    unsigned n = server->n_deferred;
+    server->n_deferred = 0;
+    for (unsigned i = 0; i < n; i++) {
+        http3_deferred_t *d = &server->deferred[i];
+        http3_server_on_datagram(server, d->data, d->len, (const struct sockaddr *)&d->peer_addr, d->peer_addr_len, NULL);
+        efree(d->data);
     }
-    // Add other config mappings here...
 }
 
 PHP_FUNCTION(quicpro_http3_server_listen)
@@ -104,6 +295,9 @@ PHP_FUNCTION(quicpro_http3_server_listen)
     setsockopt(server.fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
     int off = 0;
     setsockopt(server.fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    quicpro_udp_socket_pmtud(server.fd); /* DF set: path MTU probes are never fragmented */
+    quicpro_udp_socket_ecn(server.fd);
+    quicpro_busy_poll_socket(server.fd);
 
     struct sockaddr_in6 addr;
     memset(&addr, 0, sizeof(addr));
@@ -117,109 +311,229 @@ PHP_FUNCTION(quicpro_http3_server_listen)
         RETURN_FALSE;
     }
 
-    server.quic_config = quiche_config_new(QUICHE_PROTOCOL_VERSION);
-    apply_config_to_quiche(server.quic_config, config_resource);
-    
-    ALLOC_HASHTABLE(server.sessions_by_scid);
-    zend_hash_init(server.sessions_by_scid, 16, NULL, (dtor_func_t)quicpro_session_dtor_internal, 0);
+    server.local_addr_len = sizeof(server.local_addr);
+    if (getsockname(server.fd, (struct sockaddr *)&server.local_addr, &server.local_addr_len) < 0) {
+        server.local_addr_len = 0;
+    }
 
-    server.epoll_fd = epoll_create1(0);
-    struct epoll_event event;
-    event.events = EPOLLIN;
-    event.data.ptr = &server;
-    epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.fd, &event);
+    // In a cluster, steer datagrams for this worker's connection IDs to this socket.
+    if (quicpro_reuseport_attach(server.fd) < 0) {
+        php_error_docref(NULL, E_WARNING, "HTTP/3 server could not join connection-ID steering: %s", strerror(errno));
+    }
+    quicpro_xdp_filter_listen((struct sockaddr *)&server.local_addr); /* Floods die in the driver */
+    quicpro_topology_incoming_cpu(server.fd); /* Pinned workers take their own RX CPU's packets */
+    quicpro_cluster_worker_listening(); /* A rolling reload may drain our predecessor now */
+
+    // Compiled once per Config object and shared by every server made from it
+    server.runtime = quicpro_runtime_config_of(config_resource);
+    if (!server.runtime) {
+        close(server.fd);
+        RETURN_FALSE;
+    }
+    quicpro_runtime_config_addref(server.runtime);
+    server.quic_config = server.runtime->quic;
+    quicpro_zero_rtt_configure(server.quic_config);
+    quicpro_replay_keylog_config(server.quic_config);
+    quicpro_capture_keylog_config(server.quic_config);
+    quicpro_ticket_keys_apply_quiche(server.quic_config, &server.ticket_key_gen);
+    
+    server.sessions_by_scid = quicpro_cid_table_new(16, quicpro_session_dtor_internal);
+    quicpro_conn_stats_bind(server.sessions_by_scid); /* Quicpro\Server::connectionStats() */
+
+    // Prefer the io_uring engine when enabled; NULL means unsupported here, use epoll.
+    // The I/O thread of quicpro.io_thread_split takes precedence (server/io_thread.h).
+    server.uring = quicpro_bare_metal_config.io_engine_use_uring && !quicpro_io_thread_enabled()
+        ? quicpro_uring_new(server.fd) : NULL;
+    server.epoll_fd = -1;
+    if (!server.uring) {
+        server.rx_batch = quicpro_udp_rx_batch_new((unsigned)quicpro_bare_metal_config.io_max_batch_read_packets,
+                                                   quicpro_udp_rx_slot_size(quicpro_runtime_rx_payload(server.runtime)));
+        server.epoll_fd = epoll_create1(0);
+        server.io = quicpro_io_thread_enabled() ? quicpro_io_thread_start(server.fd, server.rx_batch) : NULL;
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = &server;
+        // With an I/O thread this thread only hears from it
+        epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.io ? quicpro_io_thread_wake_fd(server.io) : server.fd, &event);
+    }
 
     #define MAX_EVENTS 64
     struct epoll_event events[MAX_EVENTS];
-    uint8_t buffer[2048];
     server.is_listening = true;
+    quicpro_live_reader_t live;
+    quicpro_live_config_enter(&live);
+    quicpro_cert_watch_t cert_watch; // Renewed certificate files (server/cert_watch.h)
+    quicpro_cert_watch_init(&cert_watch, server.runtime->cert_file, server.runtime->key_file);
+    quicpro_busy_poll_t busy; // Adaptive EPIOCSPARAMS on the epoll instance (poll/busy_poll.h)
+    quicpro_busy_poll_init(&busy, server.epoll_fd);
+    if (!server.uring) {
+        quicpro_cancel_set_pump(server.io ? quicpro_io_thread_wake_fd(server.io) : server.fd, http3_server_pump, &server);
+    }
 
     while (server.is_listening) {
-        int n_events = epoll_wait(server.epoll_fd, events, MAX_EVENTS, 100);
-        if (n_events < 0) {
-            if (errno == EINTR) continue;
-            break;
+        // Follow the cluster-wide ticket key rotation (one atomic load when unchanged).
+        quicpro_ticket_keys_apply_quiche(server.quic_config, &server.ticket_key_gen);
+        // Settings the admin API changed since the last round (server/live_config.h).
+        quicpro_live_config_tick(&live, server.quic_config);
+        if (quicpro_cert_watch_changed(&cert_watch)) {
+            quicpro_cert_watch_reload_quiche(&cert_watch, server.quic_config);
         }
 
-        for (int i = 0; i < n_events; i++) {
-            if (events[i].data.ptr == &server) {
-                struct sockaddr_storage peer_addr;
-                socklen_t peer_addr_len = sizeof(peer_addr);
-                ssize_t read_len = recvfrom(server.fd, buffer, sizeof(buffer), 0, (struct sockaddr *)&peer_addr, &peer_addr_len);
-
-                if (read_len < 0) continue;
-
-                uint8_t scid[QUICHE_MAX_CONN_ID_LEN], dcid[QUICHE_MAX_CONN_ID_LEN];
-                size_t scid_len = sizeof(scid), dcid_len = sizeof(dcid);
-                
-                if (quiche_header_info(buffer, read_len, QUICHE_MAX_CONN_ID_LEN, dcid, &dcid_len, scid, &scid_len, NULL, NULL, NULL) < 0) {
-                    continue;
-                }
-
-                quicpro_session_t *session = zend_hash_str_find_ptr(server.sessions_by_scid, (char*)dcid, dcid_len);
-
-                if (session == NULL) {
-                    if (generate_cid(scid, QUICHE_MAX_CONN_ID_LEN) < 0) continue;
-
-                    quiche_conn *conn = quiche_accept(scid, QUICHE_MAX_CONN_ID_LEN, NULL, 0, (struct sockaddr *)&peer_addr, peer_addr_len, server.quic_config);
-                    if (conn == NULL) continue;
+        if (server.uring) {
+            if (quicpro_uring_wait(server.uring, quicpro_mcp_server_batch_wait_ms(100)) < 0) {
+                break;
+            }
+            quicpro_uring_reap(server.uring, http3_server_on_datagram, &server);
+        } else {
+            quicpro_worker_wait_begin();
+            quicpro_overload_wait_begin();
+            int n_events = epoll_wait(server.epoll_fd, events, MAX_EVENTS, quicpro_mcp_server_batch_wait_ms(100));
+            quicpro_overload_wait_end();
+            quicpro_worker_wait_end(n_events);
+            quicpro_busy_poll_note(&busy, n_events);
+            if (n_events < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
 
-                    session = ecalloc(1, sizeof(quicpro_session_t));
-                    session->conn = conn;
-                    memcpy(&session->peer_addr, &peer_addr, peer_addr_len);
-                    session->peer_addr_len = peer_addr_len;
-                    
-                    zend_hash_str_add_ptr(server.sessions_by_scid, (char*)scid, QUICHE_MAX_CONN_ID_LEN, session);
+            for (int i = 0; i < n_events; i++) {
+                if (events[i].data.ptr == &server && server.io) {
+                    http3_server_take_forwarded(&server);
+                } else if (events[i].data.ptr == &server) {
+                    // Drain until EAGAIN (or the budget) instead of one datagram per wakeup.
+                    quicpro_udp_drain(server.fd, server.rx_batch, (unsigned)quicpro_bare_metal_config.io_max_drain_packets,
+                                      http3_server_on_datagram, &server);
                 }
-
-                quiche_conn_recv(session->conn, buffer, read_len, (struct sockaddr *)&peer_addr, peer_addr_len);
             }
         }
+        http3_server_replay_deferred(&server);
+        // Proxied streams move on without their client (server/proxy.h).
+        bool hold = server.io && quicpro_proxy_busy();
+        if (hold) {
+            http3_server_hold_all(&server, true);
+        }
+        quicpro_proxy_tick(server.epoll_fd);
+        if (hold) {
+            http3_server_hold_all(&server, false);
+        }
+        // MCP batches that filled up or waited their budget; their answers go out below.
+        quicpro_mcp_server_batch_tick();
 
-        zend_string *key;
+        const uint8_t *key;
+        size_t key_len, pos = 0;
         quicpro_session_t *session;
-        ZEND_HASH_FOREACH_STR_KEY_PTR(server.sessions_by_scid, key, session) {
+        uint64_t idle_now_ms = quicpro_hibernate_now_ms();
+        quicpro_capture_round(server.sessions_by_scid, &server.capture_gen);   // The admin API's POST /capture
+        while ((session = quicpro_cid_table_next(server.sessions_by_scid, &pos, &key, &key_len))) {
+            if (server.io && !session->io_slot && !quiche_conn_is_closed(session->conn)) {
+                quicpro_io_thread_adopt(server.io, session, key, key_len);
+            }
+            quicpro_io_session_acquire(session);
             quiche_conn_on_timeout(session->conn);
-
-            uint8_t out[2048];
-            ssize_t sent;
-            do {
-                sent = quiche_conn_send(session->conn, out, sizeof(out));
-                if (sent == QUICHE_ERR_DONE) break;
-                if (sent < 0) break;
-                sendto(server.fd, out, sent, 0, (struct sockaddr *)&session->peer_addr, session->peer_addr_len);
-            } while (1);
-
-            if (quiche_conn_is_established(session->conn)) {
+            quicpro_session_hibernate_tick(session, idle_now_ms);   // Idle ones release their helpers (poll/hibernate.h)
+            // MCP responses flow control held back go out with this round's packets.
+            quicpro_mcp_server_flush(session);
+
+            uint64_t prof = quicpro_prof_begin();
+            if (server.uring && !session->relay_addr_len && !session->capture) {
+                quicpro_uring_flush_quiche(server.uring, session->conn);   // Captured ones take the path below, which sees each datagram
+            } else {
+                quicpro_server_path_flush(session, server.fd);
+            }
+            quicpro_prof_end(QUICPRO_PROF_SEND, prof);
+            quicpro_qlog_conn_tick(session);
+
+            // 0-RTT streams wait for the handshake unless early dispatch admitted this connection.
+            bool established = quiche_conn_is_established(session->conn);
+            bool early = !established && quicpro_zero_rtt_dispatchable(session);
+            if (established && session->handshake_started_us) {
+                quicpro_metrics_observe_since(QUICPRO_METRIC_HANDSHAKE_DURATION, session->handshake_started_us);
+                session->handshake_started_us = 0;
+            }
+            if (established || early) {
                 quiche_stream_iter *readable = quiche_conn_readable(session->conn);
                 uint64_t stream_id;
                 while (quiche_stream_iter_next(readable, &stream_id)) {
-                    zval args[2], retval;
-                    session->resource = zend_register_resource(session, le_quicpro_session);
+                    if (early && !quicpro_zero_rtt_offer(session, stream_id)) {
+                        continue;
+                    }
+                    zval args[3], retval;
+                    if (session->resource == NULL) {
+                        session->resource = zend_register_resource(session, le_quicpro_session);
+                    }
                     ZVAL_RES(&args[0], session->resource);
                     ZVAL_LONG(&args[1], stream_id);
+                    ZVAL_BOOL(&args[2], early);
 
-                    server.fci.param_count = 2;
+                    server.fci.param_count = 3;
                     server.fci.params = args;
                     server.fci.retval = &retval;
 
+                    // The handler reads the stream itself, so there is no traceparent to continue here
+                    quicpro_otel_scope_t scope;
+                    if (quicpro_otel_scope_open(&scope, "quic.stream", QUICPRO_OTEL_KIND_SERVER, NULL)) {
+                        quicpro_otel_span_attr_int(&scope.span, "quic.stream_id", (int64_t)stream_id);
+                        quicpro_otel_span_attr_bool(&scope.span, "quic.early_data", early);
+                        quicpro_otel_span_quic(&scope.span, session->conn);
+                    }
+                    uint64_t started_us = quicpro_metrics_now_us();
+                    uint64_t prof_cb = quicpro_prof_begin();
+                    quicpro_cancel_token_t cancel;
+                    quicpro_cancel_enter(&cancel, session, stream_id);
                     if (zend_call_function(&server.fci, &server.fcc) == SUCCESS) {
                         zval_ptr_dtor(&retval);
+                    } else {
+                        scope.span.error = true;
                     }
+                    quicpro_cancel_leave(&cancel);
+                    quicpro_prof_end(QUICPRO_PROF_PHP_CALLBACK, prof_cb);
+                    quicpro_metrics_observe_since(QUICPRO_METRIC_REQUEST_DURATION, started_us);
+                    quicpro_otel_scope_close(&scope);
                 }
                 quiche_stream_iter_free(readable);
             }
-
-            if (quiche_conn_is_closed(session->conn)) {
-                zend_hash_del(server.sessions_by_scid, key);
+            bool closed = quiche_conn_is_closed(session->conn);
+            quicpro_io_session_release(session);
+
+            // The I/O thread lets go of a closed connection first; until then it stays
+            if (closed && (!server.io || quicpro_io_thread_forget(server.io, session))) {
+                quicpro_admin_event_conn_closed(session->conn, &session->peer_addr);
+                quicpro_xdp_filter_cid_del(key, key_len);
+                quicpro_cid_table_del(server.sessions_by_scid, key, key_len);
             }
-        } ZEND_HASH_FOREACH_END();
+        }
+        quicpro_conn_snapshot_tick(server.sessions_by_scid);
+        if (server.io) {
+            quicpro_io_thread_kick(server.io); // Timers this round changed
+        }
     }
+    quicpro_cancel_set_pump(-1, NULL, NULL);
+    if (server.io) {
+        quicpro_io_thread_stop(server.io);
+        const uint8_t *key;
+        size_t key_len, pos = 0;
+        quicpro_session_t *session;
+        while ((session = quicpro_cid_table_next(server.sessions_by_scid, &pos, &key, &key_len))) {
+            quicpro_io_session_detach(session);
+        }
+    }
+    for (unsigned i = 0; i < server.n_deferred; i++) {
+        efree(server.deferred[i].data);
+    }
+    quicpro_conn_snapshot_clear();
+    quicpro_conn_stats_bind(NULL);
+    quicpro_live_config_leave(&live);
+    quicpro_cert_watch_close(&cert_watch);
     
-    close(server.epoll_fd);
+    if (server.uring) {
+        quicpro_uring_free(server.uring);
+    } else {
+        close(server.epoll_fd);
+        quicpro_udp_rx_batch_free(server.rx_batch);
+    }
     close(server.fd);
-    zend_hash_destroy(server.sessions_by_scid);
-    FREE_HASHTABLE(server.sessions_by_scid);
-    quiche_config_free(server.quic_config);
+    quicpro_xdp_filter_cid_del_all(server.sessions_by_scid);
+    quicpro_cid_table_free(server.sessions_by_scid);
+    quicpro_runtime_config_release(server.runtime);
     RETURN_TRUE;
 }
@@ -26,17 +26,60 @@
 
 #include "quiche.h"
 #include "server/index.h"
-#include "session/session.h"
+#include "client/session.h"
+#include "poll/udp_batch.h"
+#include "poll/uring.h"
+#include "poll/busy_poll.h"
+#include "poll/hibernate.h"
+#include "server/cid.h"
+#include "server/reuseport.h"
+#include "server/router.h"
+#include "server/proxy.h"
+#include "smart_dns/doq.h"
+#include "ssh_over_quic/gateway.h"
+#include "cluster/cluster.h"
+#include "cluster/topology.h"
+#include "cluster/cluster_stats.h"
+#include "server/retry.h"
+#include "server/slab.h"
+#include "server/path.h"
+#include "server/zero_rtt.h"
+#include "server/rate_limit.h"
+#include "server/xdp_filter.h"
+#include "server/conn_snapshot.h"
+#include "server/conn_stats.h"
+#include "server/open_telemetry.h"
+#include "server/metrics.h"
+#include "server/qlog.h"
+#include "server/capture.h"
+#include "server/profiler.h"
+#include "server/live_config.h"
+#include "server/cert_watch.h"
+#include "config/runtime.h"
+#include "server/admin_events.h"
+#include "server/ticket_keys.h"
+#include "server/replay.h"
+#include "config/bare_metal_tuning/base_layer.h"
+#include "config/router_and_loadbalancer/base_layer.h"
 
 // The core server object, holding its state.
 typedef struct {
     int fd;
     int epoll_fd;
-    HashTable *sessions_by_scid;
-    quiche_config *quic_config;
+    quicpro_cid_table_t *sessions_by_scid; // Issued SCID -> quicpro_session_t
+    quicpro_runtime_config_t *runtime; // The Config object, compiled (config/runtime.h)
+    quiche_config *quic_config; // runtime->quic
     zend_fcall_info fci;
     zend_fcall_info_cache fcc;
     bool is_listening;
+    quicpro_uring_t *uring; // io_uring engine when quicpro.io_engine_use_uring is on, else NULL.
+    quicpro_udp_rx_batch_t *rx_batch; // recvmmsg() slots for the epoll path.
+    quicpro_retry_state_t retry; // Accept rate and Retry counters.
+    struct sockaddr_storage local_addr; // Bound address, the `to` of every datagram.
+    socklen_t local_addr_len;
+    uint64_t ticket_key_gen; // Ticket key generation last handed to quic_config.
+    quicpro_replay_t *replay; // During quicpro_server_replay(): its clients stand in for the socket.
+    uint32_t capture_gen; // Capture arming requests already applied (server/capture.h).
 } quicpro_server_t;
 
 // Resource IDs to be defined in the main extension file during MINIT.
@@ -44,87 +87,6 @@ extern int le_quicpro_server;
 extern int le_quicpro_session;
 extern zend_class_entry *quicpro_config_ce;
 
-// Forward declaration for the internal session destructor.
-void quicpro_session_dtor_internal(void *session);
-
-// Generates a new cryptographically secure Connection ID.
-static int generate_cid(uint8_t *cid, size_t len) {
-    int urandom_fd = open("/dev/urandom", O_RDONLY);
-    if (urandom_fd < 0) {
-        return -1;
-    }
-    ssize_t result = read(urandom_fd, cid, len);
-    close(urandom_fd);
-    return (result == (ssize_t)len) ? 0 : -1;
-}
-
-// Helper function to apply settings from the PHP Config object to the C quiche_config struct.
-static void apply_php_config_to_quiche(quiche_config *quic_config, zval *config_obj)
-{
-    zval *options_zv, *value;
-    zend_string *key;
-
-    options_zv = zend_read_property(quicpro_config_ce, Z_OBJ_P(config_obj), "options", sizeof("options") - 1, 1, NULL);
-    if (Z_TYPE_P(options_zv) != IS_ARRAY) {
-        return; // No options array found or it's not an array.
-    }
-
-    ZEND_HASH_FOREACH_STR_KEY_VAL(Z_ARRVAL_P(options_zv), key, value) {
-        if (!key) continue;
-
-        if (zend_string_equals_literal(key, "application_protos")) {
-            if (Z_TYPE_P(value) == IS_STRING) {
-                quiche_config_set_application_protos(quic_config, (uint8_t *)Z_STRVAL_P(value), Z_STRLEN_P(value));
-            }
-        } else if (zend_string_equals_literal(key, "max_idle_timeout")) {
-            if (Z_TYPE_P(value) == IS_LONG) {
-                quiche_config_set_max_idle_timeout(quic_config, Z_LVAL_P(value));
-            }
-        } else if (zend_string_equals_literal(key, "max_recv_udp_payload_size")) {
-            if (Z_TYPE_P(value) == IS_LONG) {
-                quiche_config_set_max_recv_udp_payload_size(quic_config, Z_LVAL_P(value));
-            }
-        } else if (zend_string_equals_literal(key, "max_send_udp_payload_size")) {
-            if (Z_TYPE_P(value) == IS_LONG) {
-                quiche_config_set_max_send_udp_payload_size(quic_config, Z_LVAL_P(value));
-            }
-        } else if (zend_string_equals_literal(key, "initial_max_data")) {
-            if (Z_TYPE_P(value) == IS_LONG) {
-                quiche_config_set_initial_max_data(quic_config, Z_LVAL_P(value));
-            }
-        } else if (zend_string_equals_literal(key, "initial_max_stream_data_bidi_local")) {
-            if (Z_TYPE_P(value) == IS_LONG) {
-                quiche_config_set_initial_max_stream_data_bidi_local(quic_config, Z_LVAL_P(value));
-            }
-        } else if (zend_string_equals_literal(key, "initial_max_stream_data_bidi_remote")) {
-            if (Z_TYPE_P(value) == IS_LONG) {
-                quiche_config_set_initial_max_stream_data_bidi_remote(quic_config, Z_LVAL_P(value));
-            }
-        } else if (zend_string_equals_literal(key, "initial_max_stream_data_uni")) {
-            if (Z_TYPE_P(value) == IS_LONG) {
-                quiche_config_set_initial_max_stream_data_uni(quic_config, Z_LVAL_P(value));
-            }
-        } else if (zend_string_equals_literal(key, "initial_max_streams_bidi")) {
-            if (Z_TYPE_P(value) == IS_LONG) {
-                quiche_config_set_initial_max_streams_bidi(quic_config, Z_LVAL_P(value));
-            }
-        } else if (zend_string_equals_literal(key, "initial_max_streams_uni")) {
-            if (Z_TYPE_P(value) == IS_LONG) {
-                quiche_config_set_initial_max_streams_uni(quic_config, Z_LVAL_P(value));
-            }
-        } else if (zend_string_equals_literal(key, "cert_file")) {
-            if (Z_TYPE_P(value) == IS_STRING) {
-                quiche_config_load_cert_chain_from_pem_file(quic_config, Z_STRVAL_P(value));
-            }
-        } else if (zend_string_equals_literal(key, "key_file")) {
-            if (Z_TYPE_P(value) == IS_STRING) {
-                quiche_config_load_priv_key_from_pem_file(quic_config, Z_STRVAL_P(value));
-            }
-        }
-    } ZEND_HASH_FOREACH_END();
-}
-
-
 PHP_FUNCTION(quicpro_server_create)
 {
     char *host;
@@ -164,6 +126,9 @@ PHP_FUNCTION(quicpro_server_create)
         efree(server);
         RETURN_NULL();
     }
+    quicpro_udp_socket_pmtud(server->fd); /* DF set: path MTU probes are never fragmented */
+    quicpro_udp_socket_ecn(server->fd);
+    quicpro_busy_poll_socket(server->fd);
 
     struct sockaddr_in6 addr;
     memset(&addr, 0, sizeof(addr));
@@ -191,22 +156,249 @@ PHP_FUNCTION(quicpro_server_create)
         RETURN_NULL();
     }
 
-    server->quic_config = quiche_config_new(QUICHE_PROTOCOL_VERSION);
-    if (server->quic_config == NULL) {
-        zend_throw_exception_ex(NULL, 0, "Failed to create quiche config");
+    server->local_addr_len = sizeof(server->local_addr);
+    if (getsockname(server->fd, (struct sockaddr *)&server->local_addr, &server->local_addr_len) < 0) {
+        server->local_addr_len = 0;
+    }
+
+    // In a cluster, steer datagrams for this worker's connection IDs to this socket.
+    if (quicpro_reuseport_attach(server->fd) < 0) {
+        php_error_docref(NULL, E_WARNING, "Server could not join connection-ID steering: %s", strerror(errno));
+    }
+    quicpro_xdp_filter_listen((struct sockaddr *)&server->local_addr); /* Floods die in the driver */
+    quicpro_topology_incoming_cpu(server->fd); /* Pinned workers take their own RX CPU's packets */
+    quicpro_cluster_worker_listening(); /* A rolling reload may drain our predecessor now */
+
+    // Compiled once per Config object and shared by every server made from it
+    server->runtime = quicpro_runtime_config_of(config_resource);
+    if (server->runtime == NULL) {
         close(server->fd);
         efree(server);
         RETURN_NULL();
     }
+    server->quic_config = quicpro_runtime_config_addref(server->runtime)->quic;
 
-    apply_php_config_to_quiche(server->quic_config, config_resource);
+    quicpro_zero_rtt_configure(server->quic_config);
+    quicpro_replay_keylog_config(server->quic_config);
+    quicpro_capture_keylog_config(server->quic_config);
+    quicpro_ticket_keys_apply_quiche(server->quic_config, &server->ticket_key_gen);
 
-    ALLOC_HASHTABLE(server->sessions_by_scid);
-    zend_hash_init(server->sessions_by_scid, 16, NULL, (dtor_func_t)quicpro_session_dtor_internal, 0);
+    server->sessions_by_scid = quicpro_cid_table_new(16, quicpro_session_dtor_internal);
 
     RETURN_RES(zend_register_resource(server, le_quicpro_server));
 }
 
+// Routes one inbound datagram to its session, accepting a new connection for
+// unknown DCIDs. Shared by the epoll and io_uring receive paths.
+static void server_on_datagram(void *ctx, uint8_t *buffer, size_t read_len,
+                               const struct sockaddr *peer_addr, socklen_t peer_addr_len,
+                               const struct timespec *rx_ts) {
+    quicpro_server_t *server = (quicpro_server_t *)ctx;
+    uint8_t scid[QUICHE_MAX_CONN_ID_LEN];
+    uint8_t dcid[QUICHE_MAX_CONN_ID_LEN];
+    size_t scid_len = sizeof(scid);
+    size_t dcid_len = sizeof(dcid);
+
+    uint8_t token[QUICPRO_RETRY_TOKEN_MAX];
+    size_t token_len = sizeof(token);
+    uint32_t version = 0;
+    uint8_t type = 0;
+
+    // Relayed by a router (server/router.h): its header names the client
+    quicpro_router_relay_t relay;
+    int relayed = quicpro_router_unwrap(&buffer, &read_len, &peer_addr, &peer_addr_len, &relay);
+    if (relayed < 0) {
+        return;
+    }
+
+    if (quiche_header_info(buffer, read_len, QUICHE_MAX_CONN_ID_LEN, &version, &type,
+                           scid, &scid_len, dcid, &dcid_len, token, &token_len) < 0) {
+        return;
+    }
+
+    quicpro_session_t *session = quicpro_cid_table_find(server->sessions_by_scid, dcid, dcid_len);
+
+    if (session == NULL) {
+        // A crashed predecessor's connection: let the client know now instead of at its idle timeout.
+        if (quicpro_conn_snapshot_reset(server->fd, buffer, read_len, dcid, dcid_len, peer_addr, peer_addr_len)) {
+            return;
+        }
+
+        uint8_t odcid[QUICHE_MAX_CONN_ID_LEN];
+        size_t odcid_len = 0;
+        // A replay has no socket for the Retry to leave on, and its clients are never spoofed
+        if (!server->replay &&
+            quicpro_retry_screen(&server->retry, server->fd, buffer, read_len, version, type,
+                                 scid, scid_len, dcid, dcid_len,
+                                 token, token_len, peer_addr, peer_addr_len, odcid, &odcid_len) != QUICPRO_RETRY_ACCEPT) {
+            return;
+        }
+        if (!quicpro_rate_limit_admit_addr(peer_addr)) {
+            QUICPRO_WORKER_STAT(rate_limited);
+            return; // Over its limit: no connection state, no reply
+        }
+
+        // After a Retry the client already addresses the SCID we chose; keep it.
+        if (odcid_len > 0 && dcid_len == QUICHE_MAX_CONN_ID_LEN) {
+            memcpy(scid, dcid, QUICHE_MAX_CONN_ID_LEN);
+        } else if (quicpro_cid_generate(scid, QUICHE_MAX_CONN_ID_LEN) < 0) {
+            return;
+        }
+
+        quicpro_conn_snapshot_advertise(server->quic_config, scid, QUICHE_MAX_CONN_ID_LEN);
+        // A peer whose prefix we have measured starts at its learned BDP (server/congestion.h).
+        quicpro_cc_warm_start(server->quic_config, &server->runtime->cc, peer_addr);
+        quiche_conn *conn = quiche_accept(scid, QUICHE_MAX_CONN_ID_LEN, odcid_len > 0 ? odcid : NULL, odcid_len,
+                                          peer_addr, peer_addr_len, server->quic_config);
+        if (conn == NULL) return;
+        quicpro_replay_keylog_conn(conn); // SSLKEYLOGFILE, for decrypting a capture
+        quicpro_retry_note_accept(&server->retry);
+
+        session = quicpro_server_session_alloc();
+        if (session == NULL) {
+            quiche_conn_free(conn);
+            return;
+        }
+        session->conn = conn;
+        memcpy(&session->peer_addr, peer_addr, peer_addr_len);
+        session->peer_addr_len = peer_addr_len;
+        memcpy(&session->local_addr, &server->local_addr, server->local_addr_len);
+        session->local_addr_len = server->local_addr_len;
+        quicpro_zero_rtt_note_accept(session, dcid, dcid_len);
+        quicpro_qlog_conn_started(session, scid, QUICHE_MAX_CONN_ID_LEN);
+        quicpro_capture_conn_started(session, scid, QUICHE_MAX_CONN_ID_LEN, dcid, dcid_len);
+        quicpro_admin_event_conn_open(&session->peer_addr);
+
+        quicpro_cid_table_add(server->sessions_by_scid, scid, QUICHE_MAX_CONN_ID_LEN, session);
+        quicpro_xdp_filter_cid_add(scid, QUICHE_MAX_CONN_ID_LEN);
+    }
+
+    quicpro_router_note_path(session, &relay, relayed);
+    quiche_recv_info recv_info = quicpro_server_path_recv_info(session, peer_addr, peer_addr_len);
+    quicpro_capture_rx(session, (const struct sockaddr *)peer_addr, buffer, read_len); // Before quiche decrypts it in place
+    uint64_t prof = quicpro_prof_begin();
+    quiche_conn_recv(session->conn, buffer, read_len, &recv_info);
+    quicpro_prof_end(QUICPRO_PROF_CONN_RECV, prof);
+    quicpro_session_touch(session);
+    quicpro_server_path_events(session);
+    if (rx_ts) {
+        session->last_rx_ts = *rx_ts;
+    }
+}
+
+// Hands what quiche has to send for `session` to whichever engine the listener runs.
+static void server_flush_session(quicpro_server_t *server, quicpro_session_t *session)
+{
+    uint64_t prof = quicpro_prof_begin();
+    if (server->replay) {
+        quicpro_replay_deliver(server->replay, session);
+    } else if (server->uring && !session->relay_addr_len && !session->capture) {
+        quicpro_uring_flush_quiche(server->uring, session->conn);   // Captured ones take the path below, which sees each datagram
+    } else {
+        quicpro_server_path_flush(session, server->fd);
+    }
+    quicpro_prof_end(QUICPRO_PROF_SEND, prof);
+}
+
+// One round over every session: timers, flushes, readable streams to the handler
+// and closed connections. Shared by the listener and the replay.
+static void server_round(quicpro_server_t *server)
+{
+    // Proxied streams move on without their client (server/proxy.h).
+    quicpro_proxy_tick(server->epoll_fd);
+    quicpro_doq_tick();
+
+    const uint8_t *key;
+    size_t key_len, pos = 0;
+    quicpro_session_t *session;
+    uint64_t idle_now_ms = quicpro_hibernate_now_ms();
+    quicpro_capture_round(server->sessions_by_scid, &server->capture_gen);   // The admin API's POST /capture
+    while ((session = quicpro_cid_table_next(server->sessions_by_scid, &pos, &key, &key_len))) {
+        quiche_conn_on_timeout(session->conn);
+        quicpro_session_hibernate_tick(session, idle_now_ms);   // Idle ones release their helpers (poll/hibernate.h)
+
+        server_flush_session(server, session);
+        quicpro_qlog_conn_tick(session);
+
+        // 0-RTT streams wait for the handshake unless early dispatch admitted this connection.
+        bool established = quiche_conn_is_established(session->conn);
+        bool early = !established && quicpro_zero_rtt_dispatchable(session);
+        if (established && session->handshake_started_us) {
+            quicpro_metrics_observe_since(QUICPRO_METRIC_HANDSHAKE_DURATION, session->handshake_started_us);
+            session->handshake_started_us = 0;
+        }
+        // DNS over QUIC answers in 0-RTT too: a query changes nothing (smart_dns/doq.h).
+        bool doq = quicpro_doq_session(session);
+        bool answered = doq && quicpro_doq_flush(session);
+        // SSH gateway streams are spliced to their targets, never in 0-RTT (ssh_over_quic/gateway.h).
+        bool ssh = !doq && quicpro_ssh_gateway_session(session);
+        if (ssh && established) {
+            answered |= quicpro_ssh_gateway_pump(session, server->epoll_fd);
+        }
+        if (established || early || (doq && quiche_conn_is_in_early_data(session->conn))) {
+            quiche_stream_iter *readable = quiche_conn_readable(session->conn);
+            uint64_t stream_id;
+            while (quiche_stream_iter_next(readable, &stream_id)) {
+                if (doq) {
+                    answered |= quicpro_doq_stream(session, stream_id);
+                    continue;
+                }
+                if (ssh) {
+                    if (established) {
+                        answered |= quicpro_ssh_gateway_stream(session, stream_id, server->epoll_fd);
+                    }
+                    continue;
+                }
+                if (early && !quicpro_zero_rtt_offer(session, stream_id)) {
+                    continue;
+                }
+                zval args[3];
+                zval retval;
+
+                if (session->resource == NULL) {
+                    session->resource = zend_register_resource(session, le_quicpro_session);
+                }
+                ZVAL_RES(&args[0], session->resource);
+                ZVAL_LONG(&args[1], stream_id);
+                ZVAL_BOOL(&args[2], early);
+
+                server->fci.param_count = 3;
+                server->fci.params = args;
+                server->fci.retval = &retval;
+
+                // The handler reads the stream itself, so there is no traceparent to continue here
+                quicpro_otel_scope_t scope;
+                if (quicpro_otel_scope_open(&scope, "quic.stream", QUICPRO_OTEL_KIND_SERVER, NULL)) {
+                    quicpro_otel_span_attr_int(&scope.span, "quic.stream_id", (int64_t)stream_id);
+                    quicpro_otel_span_attr_bool(&scope.span, "quic.early_data", early);
+                    quicpro_otel_span_quic(&scope.span, session->conn);
+                }
+                uint64_t started_us = quicpro_metrics_now_us();
+                uint64_t prof_cb = quicpro_prof_begin();
+                if (zend_call_function(&server->fci, &server->fcc) == SUCCESS) {
+                    zval_ptr_dtor(&retval);
+                } else {
+                    scope.span.error = true;
+                }
+                quicpro_prof_end(QUICPRO_PROF_PHP_CALLBACK, prof_cb);
+                quicpro_metrics_observe_since(QUICPRO_METRIC_REQUEST_DURATION, started_us);
+                quicpro_otel_scope_close(&scope);
+            }
+            quiche_stream_iter_free(readable);
+        }
+        if (answered) {
+            server_flush_session(server, session);  // Answers and spliced bytes leave this round, not the next
+        }
+
+        if (quiche_conn_is_closed(session->conn)) {
+            quicpro_admin_event_conn_closed(session->conn, &session->peer_addr);
+            quicpro_xdp_filter_cid_del(key, key_len);
+            quicpro_cid_table_del(server->sessions_by_scid, key, key_len);
+        }
+    }
+    quicpro_conn_snapshot_tick(server->sessions_by_scid);
+}
+
 PHP_FUNCTION(quicpro_server_listen)
 {
     zval *server_resource;
@@ -223,119 +415,153 @@ PHP_FUNCTION(quicpro_server_listen)
     server->fci = fci;
     server->fcc = fcc;
 
-    server->epoll_fd = epoll_create1(0);
-    if (server->epoll_fd == -1) {
-        zend_throw_exception_ex(NULL, 0, "Failed to create epoll instance: %s", strerror(errno));
-        RETURN_FALSE;
+    // Router mode forwards datagrams to backends and accepts no connection, so the handler never runs
+    if (quicpro_router_loadbalancer_config.router_mode_enable) {
+        server->is_listening = true;
+        RETURN_BOOL(quicpro_router_run(server->fd, &server->is_listening) == 0);
     }
 
-    struct epoll_event event;
-    event.events = EPOLLIN;
-    event.data.ptr = server;
-    if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->fd, &event) == -1) {
-        zend_throw_exception_ex(NULL, 0, "Failed to add server socket to epoll: %s", strerror(errno));
-        close(server->epoll_fd);
-        RETURN_FALSE;
+    // Prefer the io_uring engine when enabled; it falls back to NULL if the kernel
+    // or build lacks support, in which case the classic epoll loop is used.
+    server->uring = quicpro_bare_metal_config.io_engine_use_uring ? quicpro_uring_new(server->fd) : NULL;
+    server->epoll_fd = -1;
+
+    if (!server->uring) {
+        server->epoll_fd = epoll_create1(0);
+        if (server->epoll_fd == -1) {
+            zend_throw_exception_ex(NULL, 0, "Failed to create epoll instance: %s", strerror(errno));
+            RETURN_FALSE;
+        }
+
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = server;
+        if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->fd, &event) == -1) {
+            zend_throw_exception_ex(NULL, 0, "Failed to add server socket to epoll: %s", strerror(errno));
+            close(server->epoll_fd);
+            RETURN_FALSE;
+        }
+        server->rx_batch = quicpro_udp_rx_batch_new((unsigned)quicpro_bare_metal_config.io_max_batch_read_packets,
+                                                    quicpro_udp_rx_slot_size(quicpro_runtime_rx_payload(server->runtime)));
     }
 
     #define MAX_EVENTS 64
     struct epoll_event events[MAX_EVENTS];
-    uint8_t buffer[2048];
     server->is_listening = true;
+    quicpro_conn_stats_bind(server->sessions_by_scid); /* Quicpro\Server::connectionStats() */
+    quicpro_live_reader_t live;
+    quicpro_live_config_enter(&live);
+    quicpro_cert_watch_t cert_watch; // Renewed certificate files (server/cert_watch.h)
+    quicpro_cert_watch_init(&cert_watch, server->runtime->cert_file, server->runtime->key_file);
+    quicpro_busy_poll_t busy; // Adaptive EPIOCSPARAMS on the epoll instance (poll/busy_poll.h)
+    quicpro_busy_poll_init(&busy, server->epoll_fd);
 
     while (server->is_listening) {
-        int n_events = epoll_wait(server->epoll_fd, events, MAX_EVENTS, 100);
-        if (n_events == -1) {
-            if (errno == EINTR) continue;
-            zend_throw_exception_ex(NULL, 0, "epoll_wait failed: %s", strerror(errno));
-            break;
+        // Follow the cluster-wide ticket key rotation (one atomic load when unchanged).
+        quicpro_ticket_keys_apply_quiche(server->quic_config, &server->ticket_key_gen);
+        // Settings the admin API changed since the last round (server/live_config.h).
+        quicpro_live_config_tick(&live, server->quic_config);
+        if (quicpro_cert_watch_changed(&cert_watch)) {
+            quicpro_cert_watch_reload_quiche(&cert_watch, server->quic_config);
         }
 
-        for (int i = 0; i < n_events; i++) {
-            if (events[i].data.ptr == server) {
-                struct sockaddr_storage peer_addr;
-                socklen_t peer_addr_len = sizeof(peer_addr);
-                ssize_t read_len = recvfrom(server->fd, buffer, sizeof(buffer), 0, (struct sockaddr *)&peer_addr, &peer_addr_len);
-
-                if (read_len < 0) continue;
-
-                uint8_t scid[QUICHE_MAX_CONN_ID_LEN];
-                uint8_t dcid[QUICHE_MAX_CONN_ID_LEN];
-                size_t scid_len = sizeof(scid);
-                size_t dcid_len = sizeof(dcid);
-
-                if (quiche_header_info(buffer, read_len, QUICHE_MAX_CONN_ID_LEN, dcid, &dcid_len, scid, &scid_len, NULL, NULL, NULL) < 0) {
-                    continue;
-                }
-
-                quicpro_session_t *session = zend_hash_str_find_ptr(server->sessions_by_scid, (char*)dcid, dcid_len);
-
-                if (session == NULL) {
-                    if (generate_cid(scid, QUICHE_MAX_CONN_ID_LEN) < 0) {
-                        continue;
-                    }
-
-                    quiche_conn *conn = quiche_accept(scid, QUICHE_MAX_CONN_ID_LEN, NULL, 0, (struct sockaddr *)&peer_addr, peer_addr_len, server->quic_config);
-                    if (conn == NULL) continue;
-
-                    session = ecalloc(1, sizeof(quicpro_session_t));
-                    session->conn = conn;
-                    memcpy(&session->peer_addr, &peer_addr, peer_addr_len);
-                    session->peer_addr_len = peer_addr_len;
+        if (server->uring) {
+            // Multishot recvmsg completions land in the ring; wait at most 100ms for one.
+            if (quicpro_uring_wait(server->uring, 100) < 0) {
+                zend_throw_exception_ex(NULL, 0, "io_uring wait failed: %s", strerror(errno));
+                break;
+            }
+            quicpro_uring_reap(server->uring, server_on_datagram, server);
+        } else {
+            quicpro_worker_wait_begin();
+            int n_events = epoll_wait(server->epoll_fd, events, MAX_EVENTS, 100);
+            quicpro_worker_wait_end(n_events);
+            quicpro_busy_poll_note(&busy, n_events);
+            if (n_events == -1) {
+                if (errno == EINTR) continue;
+                zend_throw_exception_ex(NULL, 0, "epoll_wait failed: %s", strerror(errno));
+                break;
+            }
 
-                    zend_hash_str_add_ptr(server->sessions_by_scid, (char*)scid, QUICHE_MAX_CONN_ID_LEN, session);
+            for (int i = 0; i < n_events; i++) {
+                if (events[i].data.ptr == server) {
+                    // Drain until EAGAIN (or the budget) instead of one datagram per wakeup.
+                    quicpro_udp_drain(server->fd, server->rx_batch, (unsigned)quicpro_bare_metal_config.io_max_drain_packets,
+                                      server_on_datagram, server);
                 }
-
-                quiche_conn_recv(session->conn, buffer, read_len, (struct sockaddr *)&peer_addr, peer_addr_len);
             }
         }
+        server_round(server);
+    }
+    quicpro_conn_snapshot_clear();
+    quicpro_conn_stats_bind(NULL);
+    quicpro_live_config_leave(&live);
+    quicpro_cert_watch_close(&cert_watch);
+
+    if (server->uring) {
+        quicpro_uring_free(server->uring);
+        server->uring = NULL;
+    } else {
+        close(server->epoll_fd);
+        quicpro_udp_rx_batch_free(server->rx_batch);
+        server->rx_batch = NULL;
+    }
+    RETURN_TRUE;
+}
 
-        zend_string *key;
-        quicpro_session_t *session;
-        ZEND_HASH_FOREACH_STR_KEY_PTR(server->sessions_by_scid, key, session) {
-            quiche_conn_on_timeout(session->conn);
-
-            ssize_t sent;
-            uint8_t out[2048];
-            do {
-                sent = quiche_conn_send(session->conn, out, sizeof(out));
-                if (sent == QUICHE_ERR_DONE) break;
-                if (sent < 0) {
-                    break;
-                }
-                sendto(server->fd, out, sent, 0, (struct sockaddr *)&session->peer_addr, session->peer_addr_len);
-            } while (1);
-
-            if (quiche_conn_is_established(session->conn)) {
-                quiche_stream_iter *readable = quiche_conn_readable(session->conn);
-                uint64_t stream_id;
-                while (quiche_stream_iter_next(readable, &stream_id)) {
-                    zval args[2];
-                    zval retval;
-
-                    session->resource = zend_register_resource(session, le_quicpro_session);
-                    ZVAL_RES(&args[0], session->resource);
-                    ZVAL_LONG(&args[1], stream_id);
+PHP_FUNCTION(quicpro_server_replay)
+{
+    zval *server_resource;
+    quicpro_server_t *server;
+    zend_fcall_info fci;
+    zend_fcall_info_cache fcc;
+    zend_string *trace;
+    HashTable *options = NULL;
 
-                    server->fci.param_count = 2;
-                    server->fci.params = args;
-                    server->fci.retval = &retval;
+    ZEND_PARSE_PARAMETERS_START(3, 4)
+        Z_PARAM_RESOURCE(server_resource)
+        Z_PARAM_FUNC(fci, fcc)
+        Z_PARAM_PATH_STR(trace)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_ARRAY_HT_OR_NULL(options)
+    ZEND_PARSE_PARAMETERS_END();
 
-                    if (zend_call_function(&server->fci, &server->fcc) == SUCCESS) {
-                        zval_ptr_dtor(&retval);
-                    }
-                }
-                quiche_stream_iter_free(readable);
-            }
+    server = (quicpro_server_t *)zend_fetch_resource(Z_RES_P(server_resource), "quicpro_server", le_quicpro_server);
+    if (server->is_listening || server->replay) {
+        zend_throw_exception(NULL, "Cannot replay a trace on a server that is already running", 0);
+        RETURN_THROWS();
+    }
+    server->replay = quicpro_replay_open(ZSTR_VAL(trace), (struct sockaddr *)&server->local_addr,
+                                         server->local_addr_len, options);
+    if (!server->replay) {
+        RETURN_THROWS();
+    }
+    server->fci = fci;
+    server->fcc = fcc;
 
-            if (quiche_conn_is_closed(session->conn)) {
-                zend_hash_del(server->sessions_by_scid, key);
-            }
-        } ZEND_HASH_FOREACH_END();
+    // Proxied streams and SSH splices still reach their upstreams through it
+    server->epoll_fd = epoll_create1(0);
+    if (server->epoll_fd == -1) {
+        zend_throw_exception_ex(NULL, 0, "Failed to create epoll instance: %s", strerror(errno));
+        quicpro_replay_free(server->replay);
+        server->replay = NULL;
+        RETURN_THROWS();
     }
 
+    // The clients' round, then the listener's, until the last connection has closed
+    quicpro_conn_stats_bind(server->sessions_by_scid);
+    while (quicpro_replay_step(server->replay, server_on_datagram, server) && !EG(exception)) {
+        server_round(server);
+    }
+    quicpro_conn_stats_bind(NULL);
     close(server->epoll_fd);
-    RETURN_TRUE;
+    server->epoll_fd = -1;
+
+    if (!EG(exception)) {
+        quicpro_replay_results(server->replay, return_value);
+    }
+    quicpro_replay_free(server->replay);
+    server->replay = NULL;
 }
 
 PHP_FUNCTION(quicpro_server_close)
@@ -351,8 +577,9 @@ PHP_FUNCTION(quicpro_server_close)
     server->is_listening = false;
 
     if (server->sessions_by_scid) {
-        zend_hash_destroy(server->sessions_by_scid);
-        FREE_HASHTABLE(server->sessions_by_scid);
+        quicpro_conn_stats_bind(NULL);
+        quicpro_xdp_filter_cid_del_all(server->sessions_by_scid);
+        quicpro_cid_table_free(server->sessions_by_scid);
         server->sessions_by_scid = NULL;
     }
 
@@ -361,8 +588,9 @@ PHP_FUNCTION(quicpro_server_close)
         server->fd = -1;
     }
 
-    if (server->quic_config) {
-        quiche_config_free(server->quic_config);
+    if (server->runtime) {
+        quicpro_runtime_config_release(server->runtime);
+        server->runtime = NULL;
         server->quic_config = NULL;
     }
 
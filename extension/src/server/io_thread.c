@@ -0,0 +1,443 @@
+/*
+ * io_thread.c  –  Transport thread for the php-quicpro HTTP/3 listener
+ * ---------------------------------------------------------------------
+ *
+ * Hand-off protocol (see include/server/io_thread.h):
+ *
+ *   PHP      adopt()     slot on `adopt` ring, eventfd `cmd`
+ *   I/O      round       adopt ring -> own CID table; drain the socket;
+ *                        per slot: forget?, on_timeout, flush, timeout
+ *   I/O      datagram    known and free: quiche_conn_recv
+ *                        otherwise: copy on `to_php` ring, eventfd `wake`
+ *   PHP      forget()    slot->forget = true, kick; the I/O thread drops
+ *                        it from its table and sets slot->forgotten
+ *
+ * The I/O thread only reads the configuration globals and calls quiche,
+ * libc and the pure helpers of server/path.h and server/router.h. It
+ * allocates with malloc(): its table is a persistent CID table, and the
+ * datagrams it forwards are freed by the PHP thread with free().
+ */
+
+#include "php_quicpro.h"
+#include "server/io_thread.h"
+#include "server/cid.h"
+#include "server/path.h"
+#include "server/router.h"
+#include "server/retry.h"
+#include "server/capture.h"
+#include "poll/hibernate.h"
+#include "config/bare_metal_tuning/base_layer.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <quiche.h>
+
+#define IO_RING_SIZE      4096          /* Power of two */
+#define IO_WAIT_MAX_MS    100
+#define IO_SPINS          64            /* Before the PHP thread yields while acquiring */
+
+enum { IO_OWNER_FREE = 0, IO_OWNER_THREAD = 1, IO_OWNER_PHP = 2 };
+
+/* One producer, one consumer; head and tail on their own cache lines */
+typedef struct {
+    _Alignas(64) _Atomic size_t head;
+    _Alignas(64) _Atomic size_t tail;
+    _Alignas(64) void *items[IO_RING_SIZE];
+} io_ring_t;
+
+struct quicpro_io_slot_s {
+    _Atomic int          owner;        /* IO_OWNER_* */
+    _Atomic bool         forget;       /* Set by the PHP thread */
+    _Atomic bool         forgotten;    /* Set by the I/O thread once it let go */
+    quicpro_session_t   *session;
+    quicpro_io_thread_t *io;
+    uint8_t              cid[QUICHE_MAX_CONN_ID_LEN];
+    size_t               cid_len;
+    unsigned             depth;        /* PHP thread only: nested acquires */
+};
+
+struct quicpro_io_thread_s {
+    int                     fd;
+    int                     epoll_fd;
+    int                     cmd_fd;     /* PHP -> I/O wakeups */
+    int                     wake_fd;    /* I/O -> PHP wakeups */
+    quicpro_udp_rx_batch_t *rx;
+    quicpro_cid_table_t    *slots;      /* I/O thread only: issued SCID -> slot */
+    io_ring_t               adopt;      /* PHP -> I/O: quicpro_io_slot_t * */
+    io_ring_t               to_php;     /* I/O -> PHP: quicpro_io_dgram_t * */
+    _Atomic bool            stopping;
+    bool                    woken;      /* I/O thread only: `wake_fd` written this round */
+    bool                    cpus_set;
+    cpu_set_t               cpus;
+    pthread_t               thread;
+};
+
+/*──────────────────────────── Rings ──────────────────────────────────────*/
+
+static bool io_ring_push(io_ring_t *r, void *item)
+{
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&r->head, memory_order_acquire) == IO_RING_SIZE) {
+        return false;
+    }
+    r->items[tail & (IO_RING_SIZE - 1)] = item;
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static void *io_ring_pop(io_ring_t *r)
+{
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (head == atomic_load_explicit(&r->tail, memory_order_acquire)) {
+        return NULL;
+    }
+    void *item = r->items[head & (IO_RING_SIZE - 1)];
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return item;
+}
+
+static void io_signal(int fd)
+{
+    uint64_t one = 1;
+    (void)!write(fd, &one, sizeof(one));
+}
+
+/*──────────────────────────── Ownership ──────────────────────────────────*/
+
+static inline bool io_slot_take(quicpro_io_slot_t *slot, int who)
+{
+    int expected = IO_OWNER_FREE;
+    return atomic_compare_exchange_strong_explicit(&slot->owner, &expected, who,
+                                                   memory_order_acquire, memory_order_relaxed);
+}
+
+static inline void io_slot_put(quicpro_io_slot_t *slot)
+{
+    atomic_store_explicit(&slot->owner, IO_OWNER_FREE, memory_order_release);
+}
+
+void quicpro_io_session_acquire(quicpro_session_t *s)
+{
+    quicpro_io_slot_t *slot = s->io_slot;
+    if (!slot || slot->depth++) {
+        return;
+    }
+    for (unsigned spins = 0; !io_slot_take(slot, IO_OWNER_PHP); spins++) {
+        if (spins >= IO_SPINS) {
+            sched_yield();
+        }
+    }
+}
+
+void quicpro_io_session_release(quicpro_session_t *s)
+{
+    quicpro_io_slot_t *slot = s->io_slot;
+    if (slot && --slot->depth == 0) {
+        io_slot_put(slot);
+    }
+}
+
+/*──────────────────────────── I/O thread ─────────────────────────────────*/
+
+static void io_forward(quicpro_io_thread_t *io, const uint8_t *data, size_t len,
+                       const struct sockaddr *from, socklen_t from_len, const struct timespec *rx_ts)
+{
+    if (from_len > sizeof(struct sockaddr_storage)) {
+        return;
+    }
+    quicpro_io_dgram_t *d = malloc(sizeof(*d) + len);
+    if (!d) {
+        return;
+    }
+    memcpy(&d->from, from, from_len);
+    d->from_len = from_len;
+    d->has_ts = rx_ts != NULL;
+    if (rx_ts) {
+        d->rx_ts = *rx_ts;
+    }
+    d->len = len;
+    memcpy(d->data, data, len);
+    if (!io_ring_push(&io->to_php, d)) {
+        free(d);    /* The PHP thread is that far behind: a lost datagram */
+        return;
+    }
+    if (!io->woken) {
+        io->woken = true;
+        io_signal(io->wake_fd);
+    }
+}
+
+/* quicpro_udp_drain() callback: what the listener's http3_server_on_datagram() does for known connections */
+static void io_on_datagram(void *ctx, uint8_t *data, size_t len,
+                           const struct sockaddr *from, socklen_t from_len, const struct timespec *rx_ts)
+{
+    quicpro_io_thread_t *io = ctx;
+    uint8_t *buf = data;
+    size_t buf_len = len;
+    const struct sockaddr *peer = from;
+    socklen_t peer_len = from_len;
+
+    quicpro_router_relay_t relay;
+    int relayed = quicpro_router_unwrap(&buf, &buf_len, &peer, &peer_len, &relay);
+    if (relayed < 0) {
+        return;
+    }
+
+    uint8_t scid[QUICHE_MAX_CONN_ID_LEN], dcid[QUICHE_MAX_CONN_ID_LEN];
+    size_t scid_len = sizeof(scid), dcid_len = sizeof(dcid);
+    uint8_t token[QUICPRO_RETRY_TOKEN_MAX];
+    size_t token_len = sizeof(token);
+    uint32_t version = 0;
+    uint8_t type = 0;
+    quicpro_io_slot_t *slot = NULL;
+    if (quiche_header_info(buf, buf_len, QUICHE_MAX_CONN_ID_LEN, &version, &type,
+                           scid, &scid_len, dcid, &dcid_len, token, &token_len) == 0) {
+        slot = quicpro_cid_table_find(io->slots, dcid, dcid_len);
+    }
+
+    if (!slot || !io_slot_take(slot, IO_OWNER_THREAD)) {
+        /* A new connection, a long token, or one the PHP thread holds right now */
+        io_forward(io, data, len, from, from_len, rx_ts);
+        return;
+    }
+    quicpro_session_t *s = slot->session;
+    quicpro_router_note_path(s, &relay, relayed);
+    quiche_recv_info ri = quicpro_server_path_recv_info(s, peer, peer_len);
+    quicpro_capture_rx(s, peer, buf, buf_len);
+    quiche_conn_recv(s->conn, buf, buf_len, &ri);
+    quicpro_session_touch(s);
+    quicpro_server_path_events(s);
+    if (rx_ts) {
+        s->last_rx_ts = *rx_ts;
+    }
+    io_slot_put(slot);
+
+    /* Streams may have become readable: the PHP thread dispatches them */
+    if (!io->woken) {
+        io->woken = true;
+        io_signal(io->wake_fd);
+    }
+}
+
+/* Timers, sends and forgotten connections; returns how long the next wait may be */
+static int io_round(quicpro_io_thread_t *io)
+{
+    quicpro_io_slot_t *slot;
+    while ((slot = io_ring_pop(&io->adopt))) {
+        if (!quicpro_cid_table_add(io->slots, slot->cid, slot->cid_len, slot)) {
+            atomic_store_explicit(&slot->forgotten, true, memory_order_release);
+        }
+    }
+
+    int wait_ms = IO_WAIT_MAX_MS;
+    const uint8_t *cid;
+    size_t cid_len, pos = 0;
+    while ((slot = quicpro_cid_table_next(io->slots, &pos, &cid, &cid_len))) {
+        if (atomic_load_explicit(&slot->forget, memory_order_acquire)) {
+            quicpro_cid_table_del(io->slots, cid, cid_len);
+            atomic_store_explicit(&slot->forgotten, true, memory_order_release);
+            continue;
+        }
+        if (!io_slot_take(slot, IO_OWNER_THREAD)) {
+            continue;   /* The PHP thread sends for it when it lets go */
+        }
+        quiche_conn *conn = slot->session->conn;
+        quiche_conn_on_timeout(conn);
+        quicpro_server_path_flush(slot->session, io->fd);
+        int64_t left = quiche_conn_timeout_as_millis(conn);
+        io_slot_put(slot);
+        if (left >= 0 && left < wait_ms) {
+            wait_ms = (int)left;
+        }
+    }
+    return wait_ms;
+}
+
+static void *io_thread_main(void *arg)
+{
+    quicpro_io_thread_t *io = arg;
+    struct epoll_event events[2];
+    int wait_ms = 0;
+
+    while (!atomic_load_explicit(&io->stopping, memory_order_acquire)) {
+        int n = epoll_wait(io->epoll_fd, events, 2, wait_ms);
+        if (n < 0 && errno != EINTR) {
+            break;
+        }
+        io->woken = false;
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == io->cmd_fd) {
+                uint64_t count;
+                (void)!read(io->cmd_fd, &count, sizeof(count));
+            } else {
+                quicpro_udp_drain(io->fd, io->rx, (unsigned)quicpro_bare_metal_config.io_max_drain_packets,
+                                  io_on_datagram, io);
+            }
+        }
+        wait_ms = io_round(io);
+    }
+    return NULL;
+}
+
+/*──────────────────────────── Setup ──────────────────────────────────────*/
+
+bool quicpro_io_thread_enabled(void)
+{
+    return quicpro_bare_metal_config.io_thread_split;
+}
+
+/* "0,2,4-6" or the "worker:cpus" form: every CPU named anywhere in the list */
+static bool io_parse_cpus(const char *list, cpu_set_t *set)
+{
+    CPU_ZERO(set);
+    bool any = false;
+    const char *p = list;
+    while (p && *p) {
+        const char *end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        const char *colon = memchr(p, ':', len);
+        const char *cpus = colon ? colon + 1 : p;
+        char *rest;
+        long lo = strtol(cpus, &rest, 10);
+        long hi = *rest == '-' ? strtol(rest + 1, NULL, 10) : lo;
+        for (long c = lo; c >= 0 && c <= hi && c < CPU_SETSIZE; c++) {
+            CPU_SET((int)c, set);
+            any = true;
+        }
+        p = end ? end + 1 : NULL;
+    }
+    return any;
+}
+
+quicpro_io_thread_t *quicpro_io_thread_start(int fd, quicpro_udp_rx_batch_t *rx)
+{
+    quicpro_io_thread_t *io = pecalloc(1, sizeof(*io), 1);
+    io->fd = fd;
+    io->rx = rx;
+    io->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    io->cmd_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    io->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    io->slots = quicpro_cid_table_new_persistent(64, NULL);
+    io->cpus_set = io_parse_cpus(quicpro_bare_metal_config.io_thread_cpu_affinity, &io->cpus);
+
+    struct epoll_event sock_ev = { .events = EPOLLIN, .data.fd = fd };
+    struct epoll_event cmd_ev = { .events = EPOLLIN, .data.fd = io->cmd_fd };
+    if (io->epoll_fd < 0 || io->cmd_fd < 0 || io->wake_fd < 0
+        || epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, fd, &sock_ev) < 0
+        || epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, io->cmd_fd, &cmd_ev) < 0
+        || pthread_create(&io->thread, NULL, io_thread_main, io) != 0) {
+        php_error_docref(NULL, E_WARNING, "HTTP/3 I/O thread unavailable (%s); the listener runs single-threaded", strerror(errno));
+        if (io->epoll_fd >= 0) close(io->epoll_fd);
+        if (io->cmd_fd >= 0) close(io->cmd_fd);
+        if (io->wake_fd >= 0) close(io->wake_fd);
+        quicpro_cid_table_free(io->slots);
+        pefree(io, 1);
+        return NULL;
+    }
+    if (io->cpus_set && pthread_setaffinity_np(io->thread, sizeof(io->cpus), &io->cpus) != 0) {
+        php_error_docref(NULL, E_WARNING, "HTTP/3 I/O thread could not be pinned to quicpro.io_thread_cpu_affinity");
+    }
+    return io;
+}
+
+void quicpro_io_thread_stop(quicpro_io_thread_t *io)
+{
+    if (!io) {
+        return;
+    }
+    atomic_store_explicit(&io->stopping, true, memory_order_release);
+    io_signal(io->cmd_fd);
+    pthread_join(io->thread, NULL);
+
+    quicpro_io_dgram_t *d;
+    while ((d = io_ring_pop(&io->to_php))) {
+        free(d);
+    }
+    close(io->epoll_fd);
+    close(io->cmd_fd);
+    close(io->wake_fd);
+    quicpro_cid_table_free(io->slots);
+    pefree(io, 1);
+}
+
+/*──────────────────────────── PHP thread ─────────────────────────────────*/
+
+int quicpro_io_thread_wake_fd(const quicpro_io_thread_t *io)
+{
+    return io->wake_fd;
+}
+
+quicpro_io_dgram_t *quicpro_io_thread_next(quicpro_io_thread_t *io)
+{
+    quicpro_io_dgram_t *d = io_ring_pop(&io->to_php);
+    if (!d) {
+        /* Reset before looking again: a datagram queued meanwhile signals anew */
+        uint64_t count;
+        if (read(io->wake_fd, &count, sizeof(count)) > 0) {
+            d = io_ring_pop(&io->to_php);
+        }
+    }
+    return d;
+}
+
+void quicpro_io_dgram_free(quicpro_io_dgram_t *d)
+{
+    free(d);
+}
+
+void quicpro_io_thread_kick(quicpro_io_thread_t *io)
+{
+    io_signal(io->cmd_fd);
+}
+
+void quicpro_io_thread_adopt(quicpro_io_thread_t *io, quicpro_session_t *s, const uint8_t *cid, size_t cid_len)
+{
+    if (cid_len > QUICHE_MAX_CONN_ID_LEN) {
+        return;
+    }
+    quicpro_io_slot_t *slot = pecalloc(1, sizeof(*slot), 1);
+    slot->session = s;
+    slot->io = io;
+    memcpy(slot->cid, cid, cid_len);
+    slot->cid_len = cid_len;
+    if (!io_ring_push(&io->adopt, slot)) {
+        pefree(slot, 1);
+        return;
+    }
+    s->io_slot = slot;
+    io_signal(io->cmd_fd);
+}
+
+bool quicpro_io_thread_forget(quicpro_io_thread_t *io, quicpro_session_t *s)
+{
+    quicpro_io_slot_t *slot = s->io_slot;
+    if (!slot) {
+        return true;
+    }
+    if (!atomic_load_explicit(&slot->forget, memory_order_relaxed)) {
+        atomic_store_explicit(&slot->forget, true, memory_order_release);
+        io_signal(io->cmd_fd);
+    }
+    if (!atomic_load_explicit(&slot->forgotten, memory_order_acquire)) {
+        return false;
+    }
+    pefree(slot, 1);
+    s->io_slot = NULL;
+    return true;
+}
+
+void quicpro_io_session_detach(quicpro_session_t *s)
+{
+    if (s->io_slot) {
+        pefree(s->io_slot, 1);
+        s->io_slot = NULL;
+    }
+}
@@ -0,0 +1,148 @@
+/*
+ * ktls.c  –  Kernel TLS and zero-copy file bodies for php-quicpro listeners
+ * -------------------------------------------------------------------------
+ *
+ * SSL_sendfile() is a plain sendfile(2) on a kTLS socket: the page cache
+ * feeds the kernel's record layer directly. It may send fewer bytes than
+ * asked and reports EAGAIN as SSL_ERROR_WANT_WRITE, like SSL_write.
+ *
+ * The user-space fallback keeps the chunk it last tried in `buf`. OpenSSL
+ * requires a write that returned WANT_WRITE to be retried with the same
+ * bytes.
+ */
+
+#include "php_quicpro.h"
+#include "server/ktls.h"
+#include "config/tls_and_crypto/base_layer.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void quicpro_ktls_configure(SSL_CTX *ctx)
+{
+    if (!quicpro_tls_crypto_config.tls_tcp_enable_ktls) {
+        return;
+    }
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#else
+    php_error_docref(NULL, E_NOTICE, "Kernel TLS needs OpenSSL 3.0; records are encrypted in user space");
+#endif
+}
+
+bool quicpro_ktls_send_active(SSL *ssl)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    return BIO_get_ktls_send(SSL_get_wbio(ssl)) > 0;
+#else
+    (void)ssl;
+    return false;
+#endif
+}
+
+void quicpro_file_body_init(quicpro_file_body_t *b)
+{
+    b->fd = -1;
+    b->offset = 0;
+    b->remaining = 0;
+    b->buf_len = 0;
+    b->sealed = NULL;
+}
+
+int quicpro_file_body_open(quicpro_file_body_t *b, const char *path)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return -1;
+    }
+    quicpro_file_body_close(b);
+    b->fd = fd;
+    b->offset = 0;
+    b->remaining = st.st_size;
+    b->buf_len = 0;
+    return 0;
+}
+
+int quicpro_file_body_open_range(quicpro_file_body_t *b, int fd, off_t offset, off_t len)
+{
+    int own = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (own < 0) {
+        return -1;
+    }
+    quicpro_file_body_close(b);
+    b->fd = own;
+    b->offset = offset;
+    b->remaining = len;
+    b->buf_len = 0;
+    return 0;
+}
+
+ssize_t quicpro_file_body_read(quicpro_file_body_t *b, uint8_t *out, size_t len)
+{
+    if ((off_t)len > b->remaining) {
+        len = (size_t)b->remaining;
+    }
+    ssize_t n = b->sealed ? quicpro_at_rest_reader_pread(b->sealed, b->fd, out, len, (uint64_t)b->offset)
+                          : pread(b->fd, out, len, b->offset);
+    if (n > 0) {
+        b->offset += n;
+        b->remaining -= n;
+    }
+    return n;
+}
+
+ssize_t quicpro_file_body_send(SSL *ssl, quicpro_file_body_t *b, size_t max)
+{
+    if ((off_t)max > b->remaining) {
+        max = (size_t)b->remaining;
+    }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    if (b->buf_len == 0 && !b->sealed && quicpro_ktls_send_active(ssl)) {
+        ossl_ssize_t n = SSL_sendfile(ssl, b->fd, b->offset, max, 0);
+        if (n > 0) {
+            b->offset += n;
+            b->remaining -= n;
+        }
+        return n;
+    }
+#endif
+
+    if (b->buf_len == 0) {
+        size_t want = max < sizeof(b->buf) ? max : sizeof(b->buf);
+        ssize_t n = b->sealed ? quicpro_at_rest_reader_pread(b->sealed, b->fd, b->buf, want, (uint64_t)b->offset)
+                              : pread(b->fd, b->buf, want, b->offset);
+        if (n <= 0) {
+            return -1;   /* The file shrank or failed; the response cannot complete */
+        }
+        b->buf_len = (size_t)n;
+    }
+
+    int n = SSL_write(ssl, b->buf, (int)b->buf_len);
+    if (n > 0) {
+        b->offset += n;
+        b->remaining -= n;
+        b->buf_len = 0;
+    }
+    return n;
+}
+
+void quicpro_file_body_close(quicpro_file_body_t *b)
+{
+    if (b->fd >= 0) {
+        close(b->fd);
+    }
+    if (b->sealed) {
+        quicpro_at_rest_reader_free(b->sealed);
+    }
+    b->fd = -1;
+    b->remaining = 0;
+    b->buf_len = 0;
+    b->sealed = NULL;
+}
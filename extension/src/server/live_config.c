@@ -0,0 +1,438 @@
+/*
+ * src/server/live_config.c – Configuration changes without a restart
+ * ==================================================================
+ *
+ * See include/server/live_config.h. Writers (the admin thread, or PHP
+ * through Server::reconfigure()) take one mutex to commit; readers take
+ * none. A commit overlays the keys it set on a copy of the current
+ * snapshot, so two writers never undo each other. Every setting remembers
+ * the generation that last changed it, and a listener that skipped some
+ * generations applies exactly what changed since the one it has.
+ *
+ * Only the listener's thread writes the process settings it applies
+ * (quicpro_security_config), and the same thread reads them.
+ */
+
+#include "php_quicpro.h"
+#include "server/live_config.h"
+#include "server/cors.h"
+#include "server/cert_store.h"
+#include "config/security_and_traffic/base_layer.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/ssl.h>
+
+#define QP_LIVE_READERS 16
+
+enum {
+    QP_LIVE_CORS      = 1 << 0,
+    QP_LIVE_RL_ENABLE = 1 << 1,
+    QP_LIVE_RL_RATE   = 1 << 2,
+    QP_LIVE_RL_BURST  = 1 << 3,
+    QP_LIVE_CERT      = 1 << 4,
+    QP_LIVE_KEY       = 1 << 5,
+    QP_LIVE_CC        = 1 << 6
+};
+
+struct quicpro_live_config_s {
+    uint64_t   generation;
+    unsigned   pending;                 /* Builder only: QP_LIVE_* keys it sets */
+
+    char      *cors;            uint64_t cors_gen;
+    quicpro_cors_policy_t *cors_policy;    /* `cors` compiled; NULL in builders */
+    bool       rl_enable;       uint64_t rl_enable_gen;
+    zend_long  rl_rate;         uint64_t rl_rate_gen;
+    zend_long  rl_burst;        uint64_t rl_burst_gen;
+    char      *cert_file;
+    char      *key_file;        uint64_t cert_gen;    /* Chain and key change together */
+    char       cc[8];           uint64_t cc_gen;
+
+    quicpro_live_config_t *retired_next;
+    uint64_t   retired_epoch;
+};
+
+static pthread_mutex_t qp_live_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic(quicpro_live_config_t *) qp_live_current = NULL;
+static _Atomic uint64_t qp_live_epoch = 1;
+static _Atomic uint64_t qp_live_seen[QP_LIVE_READERS];      /* 0: slot free */
+static _Atomic bool qp_live_has_retired = false;
+static quicpro_live_config_t *qp_live_retired = NULL;       /* Under qp_live_lock */
+
+/* The CORS list this process allocated, so a later change can free it */
+static char *qp_live_cors_owned = NULL;
+
+static void qp_live_free(quicpro_live_config_t *c)
+{
+    if (!c) {
+        return;
+    }
+    if (c->cors) pefree(c->cors, 1);
+    quicpro_cors_policy_free(c->cors_policy);
+    if (c->cert_file) pefree(c->cert_file, 1);
+    if (c->key_file) pefree(c->key_file, 1);
+    pefree(c, 1);
+}
+
+static void qp_live_replace(char **slot, const char *value)
+{
+    if (*slot) {
+        pefree(*slot, 1);
+    }
+    *slot = value ? pestrdup(value, 1) : NULL;
+}
+
+/* Frees what every registered reader has moved past. Under qp_live_lock. */
+static void qp_live_reclaim_locked(void)
+{
+    uint64_t oldest = UINT64_MAX;
+    for (int i = 0; i < QP_LIVE_READERS; i++) {
+        uint64_t seen = atomic_load(&qp_live_seen[i]);
+        if (seen && seen < oldest) {
+            oldest = seen;
+        }
+    }
+    quicpro_live_config_t **link = &qp_live_retired;
+    while (*link) {
+        quicpro_live_config_t *c = *link;
+        if (oldest >= c->retired_epoch) {
+            *link = c->retired_next;
+            qp_live_free(c);
+        } else {
+            link = &c->retired_next;
+        }
+    }
+    atomic_store(&qp_live_has_retired, qp_live_retired != NULL);
+}
+
+/*──────────────────────────── Writers ────────────────────────────────────*/
+
+quicpro_live_config_t *quicpro_live_config_begin(void)
+{
+    return pecalloc(1, sizeof(quicpro_live_config_t), 1);
+}
+
+static bool qp_live_parse_long(const char *value, zend_long *out)
+{
+    char *end;
+    errno = 0;
+    long long v = strtoll(value, &end, 10);
+    if (errno || end == value || *end || v < 0) {
+        return false;
+    }
+    *out = (zend_long)v;
+    return true;
+}
+
+/* "*" or a comma-separated list of http(s) origins */
+/* What the listeners will compile: "*", exact origins and "*." wildcards */
+static bool qp_live_valid_origins(const char *value)
+{
+    quicpro_cors_policy_t *p = quicpro_cors_compile(value);
+    bool ok = p != NULL && *value != '\0';
+    quicpro_cors_policy_free(p);
+    return ok;
+}
+
+bool quicpro_live_config_set(quicpro_live_config_t *c, const char *key, const char *value, char *err, size_t err_len)
+{
+    if (strcmp(key, "security_cors_allowed_origins") == 0) {
+        if (!qp_live_valid_origins(value)) {
+            snprintf(err, err_len, "%s must be '*' or a comma-separated list of http(s) origins", key);
+            return false;
+        }
+        qp_live_replace(&c->cors, value);
+        c->pending |= QP_LIVE_CORS;
+    } else if (strcmp(key, "security_rate_limiter_enable") == 0) {
+        if (strcmp(value, "true") == 0 || strcmp(value, "1") == 0) {
+            c->rl_enable = true;
+        } else if (strcmp(value, "false") == 0 || strcmp(value, "0") == 0) {
+            c->rl_enable = false;
+        } else {
+            snprintf(err, err_len, "%s must be true or false", key);
+            return false;
+        }
+        c->pending |= QP_LIVE_RL_ENABLE;
+    } else if (strcmp(key, "security_rate_limiter_requests_per_sec") == 0) {
+        if (!qp_live_parse_long(value, &c->rl_rate)) {
+            snprintf(err, err_len, "%s must be a non-negative integer", key);
+            return false;
+        }
+        c->pending |= QP_LIVE_RL_RATE;
+    } else if (strcmp(key, "security_rate_limiter_burst") == 0) {
+        if (!qp_live_parse_long(value, &c->rl_burst)) {
+            snprintf(err, err_len, "%s must be a non-negative integer", key);
+            return false;
+        }
+        c->pending |= QP_LIVE_RL_BURST;
+    } else if (strcmp(key, "cert_file") == 0 || strcmp(key, "key_file") == 0) {
+        bool cert = key[0] == 'c';
+        if (!*value) {
+            snprintf(err, err_len, "%s must be a path", key);
+            return false;
+        }
+        qp_live_replace(cert ? &c->cert_file : &c->key_file, value);
+        c->pending |= cert ? QP_LIVE_CERT : QP_LIVE_KEY;
+    } else if (strcmp(key, "cc_algorithm") == 0) {
+        static const char *const allowed[] = { "cubic", "reno", "bbr", "bbr2" };
+        size_t i;
+        for (i = 0; i < sizeof(allowed) / sizeof(allowed[0]) && strcmp(value, allowed[i]) != 0; i++);
+        if (i == sizeof(allowed) / sizeof(allowed[0])) {
+            snprintf(err, err_len, "%s must be cubic, reno, bbr or bbr2", key);
+            return false;
+        }
+        snprintf(c->cc, sizeof(c->cc), "%s", value);
+        c->pending |= QP_LIVE_CC;
+    } else {
+        snprintf(err, err_len, "'%s' cannot be changed at runtime", key);
+        return false;
+    }
+    return true;
+}
+
+/* The chain and key load and belong together */
+static bool qp_live_check_cert(const char *cert_file, const char *key_file, char *err, size_t err_len)
+{
+    if (!cert_file || !key_file) {
+        snprintf(err, err_len, "cert_file and key_file must both be set");
+        return false;
+    }
+    SSL_CTX *ctx = SSL_CTX_new(TLS_method());
+    bool ok = ctx
+        && SSL_CTX_use_certificate_chain_file(ctx, cert_file) == 1
+        && SSL_CTX_use_PrivateKey_file(ctx, key_file, SSL_FILETYPE_PEM) == 1
+        && SSL_CTX_check_private_key(ctx) == 1;
+    if (ctx) {
+        SSL_CTX_free(ctx);
+    }
+    if (!ok) {
+        snprintf(err, err_len, "cert_file and key_file do not load as a matching PEM chain and key");
+    }
+    return ok;
+}
+
+uint64_t quicpro_live_config_commit(quicpro_live_config_t *c, char *err, size_t err_len)
+{
+    pthread_mutex_lock(&qp_live_lock);
+
+    /* Overlay the keys `c` sets on the current snapshot */
+    quicpro_live_config_t *cur = atomic_load(&qp_live_current);
+    quicpro_live_config_t *next = pecalloc(1, sizeof(*next), 1);
+    if (cur) {
+        *next = *cur;
+        next->cors = cur->cors ? pestrdup(cur->cors, 1) : NULL;
+        next->cert_file = cur->cert_file ? pestrdup(cur->cert_file, 1) : NULL;
+        next->key_file = cur->key_file ? pestrdup(cur->key_file, 1) : NULL;
+        next->cors_policy = NULL;
+        next->retired_next = NULL;
+    }
+    uint64_t gen = (cur ? cur->generation : 0) + 1;
+    next->generation = gen;
+    next->pending = 0;
+
+    if (c->pending & QP_LIVE_CORS) {
+        qp_live_replace(&next->cors, c->cors);
+        next->cors_gen = gen;
+    }
+    if (c->pending & QP_LIVE_RL_ENABLE) {
+        next->rl_enable = c->rl_enable;
+        next->rl_enable_gen = gen;
+    }
+    if (c->pending & QP_LIVE_RL_RATE) {
+        next->rl_rate = c->rl_rate;
+        next->rl_rate_gen = gen;
+    }
+    if (c->pending & QP_LIVE_RL_BURST) {
+        next->rl_burst = c->rl_burst;
+        next->rl_burst_gen = gen;
+    }
+    if (c->pending & (QP_LIVE_CERT | QP_LIVE_KEY)) {
+        if (c->pending & QP_LIVE_CERT) qp_live_replace(&next->cert_file, c->cert_file);
+        if (c->pending & QP_LIVE_KEY) qp_live_replace(&next->key_file, c->key_file);
+        next->cert_gen = gen;
+    }
+    if (c->pending & QP_LIVE_CC) {
+        memcpy(next->cc, c->cc, sizeof(next->cc));
+        next->cc_gen = gen;
+    }
+    qp_live_free(c);
+
+    if (next->cert_gen == gen && !qp_live_check_cert(next->cert_file, next->key_file, err, err_len)) {
+        pthread_mutex_unlock(&qp_live_lock);
+        qp_live_free(next);
+        return 0;
+    }
+    /* Each snapshot owns its compiled policy, and is reclaimed with it */
+    if (next->cors && !(next->cors_policy = quicpro_cors_compile(next->cors))) {
+        snprintf(err, err_len, "security_cors_allowed_origins could not be compiled");
+        pthread_mutex_unlock(&qp_live_lock);
+        qp_live_free(next);
+        return 0;
+    }
+
+    /* Readers that announce the new epoch have let go of `cur` */
+    atomic_store(&qp_live_current, next);
+    if (cur) {
+        cur->retired_epoch = atomic_fetch_add(&qp_live_epoch, 1) + 1;
+        cur->retired_next = qp_live_retired;
+        qp_live_retired = cur;
+    }
+    qp_live_reclaim_locked();
+    pthread_mutex_unlock(&qp_live_lock);
+    return gen;
+}
+
+void quicpro_live_config_abort(quicpro_live_config_t *c)
+{
+    qp_live_free(c);
+}
+
+/*──────────────────────────── Readers ────────────────────────────────────*/
+
+void quicpro_live_config_enter(quicpro_live_reader_t *r)
+{
+    quicpro_cors_enter();
+    r->slot = -1;
+    r->generation = 0;
+    r->tls_ctx = NULL;
+    for (int i = 0; i < QP_LIVE_READERS; i++) {
+        uint64_t expected = 0;
+        if (atomic_compare_exchange_strong(&qp_live_seen[i], &expected, atomic_load(&qp_live_epoch))) {
+            r->slot = i;
+            return;
+        }
+    }
+    php_error_docref(NULL, E_WARNING, "More than %d listeners in this process; this one ignores runtime configuration changes", QP_LIVE_READERS);
+}
+
+static void qp_live_apply(quicpro_live_reader_t *r, const quicpro_live_config_t *c, quiche_config *quic_config)
+{
+    if (c->cors_gen > r->generation) {
+        qp_live_replace(&qp_live_cors_owned, c->cors);
+        quicpro_security_config.cors_allowed_origins = qp_live_cors_owned;
+    }
+    quicpro_cors_use(c->cors_policy);   /* Even unchanged: the previous snapshot's copy is reclaimed */
+    if (c->rl_enable_gen > r->generation) {
+        quicpro_security_config.rate_limiter_enable = c->rl_enable;
+    }
+    if (c->rl_rate_gen > r->generation) {
+        quicpro_security_config.rate_limiter_requests_per_sec = c->rl_rate;
+    }
+    if (c->rl_burst_gen > r->generation) {
+        quicpro_security_config.rate_limiter_burst = c->rl_burst;
+    }
+    if (quic_config && c->cert_gen > r->generation) {
+        if (quiche_config_load_cert_chain_from_pem_file(quic_config, c->cert_file) < 0
+            || quiche_config_load_priv_key_from_pem_file(quic_config, c->key_file) < 0) {
+            php_error_docref(NULL, E_WARNING, "Live configuration %llu: could not load '%s'; new connections keep the previous certificate",
+                             (unsigned long long)c->generation, c->cert_file);
+        }
+    }
+    if (r->tls_ctx && c->cert_gen > r->generation && !quicpro_cert_store_use_files(r->tls_ctx, c->cert_file, c->key_file)) {
+        php_error_docref(NULL, E_WARNING, "Live configuration %llu: could not load '%s'; new handshakes keep the previous certificate",
+                         (unsigned long long)c->generation, c->cert_file);
+    }
+    if (quic_config && c->cc_gen > r->generation) {
+        quiche_config_set_cc_algorithm_name(quic_config, c->cc);
+    }
+    r->generation = c->generation;
+}
+
+void quicpro_live_config_tick(quicpro_live_reader_t *r, quiche_config *quic_config)
+{
+    if (r->slot < 0) {
+        return;
+    }
+    /* Quiescent: nothing loaded before this point is used after it */
+    atomic_store(&qp_live_seen[r->slot], atomic_load(&qp_live_epoch));
+    if (atomic_load_explicit(&qp_live_has_retired, memory_order_relaxed) && pthread_mutex_trylock(&qp_live_lock) == 0) {
+        qp_live_reclaim_locked();
+        pthread_mutex_unlock(&qp_live_lock);
+    }
+
+    const quicpro_live_config_t *c = atomic_load(&qp_live_current);
+    if (c && c->generation != r->generation) {
+        qp_live_apply(r, c, quic_config);
+    }
+}
+
+void quicpro_live_config_leave(quicpro_live_reader_t *r)
+{
+    quicpro_cors_leave();
+    if (r->slot >= 0) {
+        atomic_store(&qp_live_seen[r->slot], 0);
+        r->slot = -1;
+    }
+}
+
+void quicpro_live_config_mshutdown(void)
+{
+    pthread_mutex_lock(&qp_live_lock);
+    qp_live_free(atomic_exchange(&qp_live_current, NULL));
+    while (qp_live_retired) {
+        quicpro_live_config_t *c = qp_live_retired;
+        qp_live_retired = c->retired_next;
+        qp_live_free(c);
+    }
+    atomic_store(&qp_live_has_retired, false);
+    pthread_mutex_unlock(&qp_live_lock);
+
+    if (qp_live_cors_owned) {
+        if (quicpro_security_config.cors_allowed_origins == qp_live_cors_owned) {
+            quicpro_security_config.cors_allowed_origins = NULL;
+        }
+        pefree(qp_live_cors_owned, 1);
+        qp_live_cors_owned = NULL;
+    }
+}
+
+/*──────────────────────────── PHP ────────────────────────────────────────*/
+
+PHP_FUNCTION(quicpro_server_reconfigure)
+{
+    HashTable *settings;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT(settings)
+    ZEND_PARSE_PARAMETERS_END();
+
+    char err[160];
+    zend_string *key;
+    zval *value;
+    quicpro_live_config_t *c = quicpro_live_config_begin();
+    if (!c) {
+        RETURN_FALSE;
+    }
+    ZEND_HASH_FOREACH_STR_KEY_VAL(settings, key, value) {
+        zend_string *text = NULL;
+        if (key && (Z_TYPE_P(value) == IS_TRUE || Z_TYPE_P(value) == IS_FALSE)) {
+            text = zend_string_init(Z_TYPE_P(value) == IS_TRUE ? "true" : "false", Z_TYPE_P(value) == IS_TRUE ? 4 : 5, 0);
+        } else if (key && (Z_TYPE_P(value) == IS_STRING || Z_TYPE_P(value) == IS_LONG)) {
+            text = zval_get_string(value);
+        }
+        bool ok = text && quicpro_live_config_set(c, ZSTR_VAL(key), ZSTR_VAL(text), err, sizeof(err));
+        if (!text) {
+            snprintf(err, sizeof(err), "settings must map names to strings, integers or booleans");
+        }
+        if (text) {
+            zend_string_release(text);
+        }
+        if (!ok) {
+            quicpro_live_config_abort(c);
+            throw_mcp_error_as_php_exception(0, "Server::reconfigure: %s.", err);
+            RETURN_FALSE;
+        }
+    } ZEND_HASH_FOREACH_END();
+
+    uint64_t gen = quicpro_live_config_commit(c, err, sizeof(err));
+    if (!gen) {
+        throw_mcp_error_as_php_exception(0, "Server::reconfigure: %s.", err);
+        RETURN_FALSE;
+    }
+    RETURN_LONG((zend_long)gen);
+}
@@ -0,0 +1,979 @@
+/*
+ * src/server/metrics.c – Native counters, gauges and HDR histograms
+ * =================================================================
+ *
+ * See include/server/metrics.h. A shard is QUICPRO_METRICS_MAX instruments'
+ * worth of slots at most, laid out in registration order and rounded up
+ * to whole cache lines, so two workers never write the same line. The
+ * registry itself (names, types, bounds) is plain process memory: it is
+ * fixed before the first fork, and every worker inherits the same copy.
+ *
+ * The server thread only reads the shards. What it needs of the
+ * configuration is copied when it starts; rendering uses persistent
+ * memory, never the request allocator.
+ */
+
+#include "php_quicpro.h"
+#include "server/metrics.h"
+#include "server/otlp.h"
+#include "config/open_telemetry/base_layer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define QP_METRICS_LINE_SLOTS  8        /* uint64_t per cache line */
+#define QP_METRICS_SCALE       1000.0   /* Recorded units per exported unit of every histogram */
+#define QP_METRICS_REQUEST_MAX 2048     /* Bytes of a scrape's request head read at most */
+
+typedef struct {
+    char    name[QUICPRO_METRICS_NAME_MAX];
+    char    help[QUICPRO_METRICS_HELP_MAX];
+    const char *unit;                   /* UCUM, for OTLP */
+    uint8_t type;                       /* quicpro_metric_type_t */
+    uint8_t nbounds;                    /* 0: the default bounds */
+    double  bounds[QUICPRO_METRICS_BOUNDS_MAX];
+} quicpro_metric_def_t;
+
+_Atomic uint64_t *quicpro_metrics_shard = NULL;
+uint32_t quicpro_metrics_offset[QUICPRO_METRICS_MAX];
+
+static quicpro_metric_def_t quicpro_metrics_defs[QUICPRO_METRICS_MAX];
+static uint32_t  quicpro_metrics_count = 0;
+static uint32_t  quicpro_metrics_slots = 0;     /* Of one shard, whole cache lines */
+static HashTable quicpro_metrics_names;         /* name → ID + 1, persistent */
+static bool      quicpro_metrics_fixed = false; /* No registering: the layout is shared now */
+static double    quicpro_metrics_default_bounds[QUICPRO_METRICS_BOUNDS_MAX];
+static uint8_t   quicpro_metrics_default_nbounds = 0;
+
+static _Atomic uint64_t *quicpro_metrics_local = NULL;  /* This process's, outside a cluster */
+
+/* The cluster's shards: 2 * nslots, the second half for odd generations */
+static _Atomic uint64_t *quicpro_metrics_seg = NULL;
+static size_t   quicpro_metrics_seg_size;
+static uint32_t quicpro_metrics_nslots;
+static bool     quicpro_metrics_disabled = false;
+static uint64_t quicpro_metrics_start_ns;       /* CLOCK_REALTIME: the start of every cumulative series */
+
+static struct {
+    bool      running;
+    pthread_t thread;
+    int       listen_fd;
+    int       wake_fd;
+    _Atomic bool stopping;
+    bool      push;
+    int       interval_ms;
+    quicpro_otlp_endpoint_t ep;
+} quicpro_metrics_srv = { .listen_fd = -1, .wake_fd = -1 };
+
+static uint64_t quicpro_metrics_realtime_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*──────────────────────────── Registry ───────────────────────────────────*/
+
+static uint32_t quicpro_metrics_width(uint8_t type)
+{
+    return type == QUICPRO_METRIC_HISTOGRAM ? QUICPRO_HDR_SLOTS : 1;
+}
+
+/* Adds an instrument, growing the private shard; the ID, or -1 when full */
+static int quicpro_metrics_add_def(const char *name, size_t name_len, uint8_t type, const char *help, const char *unit)
+{
+    if (quicpro_metrics_count == QUICPRO_METRICS_MAX) {
+        return -1;
+    }
+    uint32_t id = quicpro_metrics_count++;
+    quicpro_metric_def_t *d = &quicpro_metrics_defs[id];
+    memset(d, 0, sizeof(*d));
+    snprintf(d->name, sizeof(d->name), "%.*s", (int)name_len, name);
+    snprintf(d->help, sizeof(d->help), "%s", help ? help : "");
+    d->unit = unit;
+    d->type = type;
+
+    uint32_t used = quicpro_metrics_count > 1
+        ? quicpro_metrics_offset[id - 1] + quicpro_metrics_width(quicpro_metrics_defs[id - 1].type) : 0;
+    quicpro_metrics_offset[id] = used;
+    used += quicpro_metrics_width(type);
+    uint32_t slots = (used + QP_METRICS_LINE_SLOTS - 1) / QP_METRICS_LINE_SLOTS * QP_METRICS_LINE_SLOTS;
+    if (slots > quicpro_metrics_slots) {
+        quicpro_metrics_local = perealloc((void *)quicpro_metrics_local, slots * sizeof(uint64_t), 1);
+        memset((void *)(quicpro_metrics_local + quicpro_metrics_slots), 0, (slots - quicpro_metrics_slots) * sizeof(uint64_t));
+        quicpro_metrics_slots = slots;
+        if (!quicpro_metrics_seg && !quicpro_metrics_disabled) {
+            quicpro_metrics_shard = quicpro_metrics_local;
+        }
+    }
+
+    zval zid;
+    ZVAL_LONG(&zid, (zend_long)id + 1);
+    zend_hash_str_update(&quicpro_metrics_names, d->name, strlen(d->name), &zid);
+    return (int)id;
+}
+
+/* The ID of `name`, -1 without one */
+static int quicpro_metrics_find(const char *name, size_t len)
+{
+    zval *zid = quicpro_metrics_count ? zend_hash_str_find(&quicpro_metrics_names, name, len) : NULL;
+    return zid ? (int)Z_LVAL_P(zid) - 1 : -1;
+}
+
+void quicpro_metrics_minit(void)
+{
+    static const struct {
+        const char *name, *help, *unit;
+        uint8_t type;
+    } builtin[QUICPRO_METRIC_BUILTIN_COUNT] = {
+        [QUICPRO_METRIC_REQUEST_DURATION] = { "quicpro_request_duration_ms",
+            "Time the request handler took, per request or stream.", "ms", QUICPRO_METRIC_HISTOGRAM },
+        [QUICPRO_METRIC_HANDSHAKE_DURATION] = { "quicpro_quic_handshake_duration_ms",
+            "Time from a QUIC connection's first packet to its completed handshake.", "ms", QUICPRO_METRIC_HISTOGRAM },
+        [QUICPRO_METRIC_STREAMS] = { "quicpro_streams_total",
+            "HTTP/2 and MCP streams opened.", "1", QUICPRO_METRIC_COUNTER },
+        [QUICPRO_METRIC_PACKETS_SENT] = { "quicpro_quic_packets_sent_total",
+            "QUIC packets sent, counted as their connection closes.", "1", QUICPRO_METRIC_COUNTER },
+        [QUICPRO_METRIC_PACKETS_LOST] = { "quicpro_quic_packets_lost_total",
+            "QUIC packets declared lost, counted as their connection closes.", "1", QUICPRO_METRIC_COUNTER },
+        [QUICPRO_METRIC_PACKETS_RETRANSMITTED] = { "quicpro_quic_packets_retransmitted_total",
+            "QUIC packets retransmitted, counted as their connection closes.", "1", QUICPRO_METRIC_COUNTER },
+        [QUICPRO_METRIC_IIBIN_ENCODED_BYTES] = { "quicpro_iibin_encoded_bytes_total",
+            "Bytes of IIBIN messages encoded.", "By", QUICPRO_METRIC_COUNTER },
+        [QUICPRO_METRIC_IIBIN_DECODED_BYTES] = { "quicpro_iibin_decoded_bytes_total",
+            "Bytes of IIBIN messages decoded.", "By", QUICPRO_METRIC_COUNTER },
+        [QUICPRO_METRIC_QUEUE_DELAY] = { "quicpro_request_queue_delay_ms",
+            "Time a request waited for its handler, with overload shedding enabled.", "ms", QUICPRO_METRIC_HISTOGRAM },
+        [QUICPRO_METRIC_REQUESTS_SHED] = { "quicpro_requests_shed_total",
+            "Requests refused because the worker was overloaded.", "1", QUICPRO_METRIC_COUNTER },
+        [QUICPRO_METRIC_ACCESS_LOG_DROPPED] = { "quicpro_access_log_dropped_total",
+            "Access log records dropped because the writer fell behind.", "1", QUICPRO_METRIC_COUNTER },
+    };
+
+    zend_hash_init(&quicpro_metrics_names, QUICPRO_METRICS_MAX, NULL, NULL, 1);
+    for (uint32_t i = 0; i < QUICPRO_METRIC_BUILTIN_COUNT; i++) {
+        quicpro_metrics_add_def(builtin[i].name, strlen(builtin[i].name), builtin[i].type, builtin[i].help, builtin[i].unit);
+    }
+    quicpro_metrics_start_ns = quicpro_metrics_realtime_ns();
+}
+
+/* From `quicpro.otel_metrics_default_histogram_boundaries`; on the PHP thread only */
+static void quicpro_metrics_load_default_bounds(void)
+{
+    const char *p = quicpro_open_telemetry_config.metrics_default_histogram_boundaries;
+    uint8_t n = 0;
+    while (p && *p && n < QUICPRO_METRICS_BOUNDS_MAX) {
+        char *end;
+        double v = strtod(p, &end);
+        if (end == p) {
+            break;
+        }
+        if (!n || v > quicpro_metrics_default_bounds[n - 1]) {
+            quicpro_metrics_default_bounds[n++] = v;
+        }
+        p = end;
+        while (*p == ',' || *p == ' ') p++;
+    }
+    quicpro_metrics_default_nbounds = n;
+}
+
+static void quicpro_metrics_fix(void)
+{
+    if (!quicpro_metrics_fixed) {
+        quicpro_metrics_load_default_bounds();
+        quicpro_metrics_fixed = true;
+    }
+}
+
+static const double *quicpro_metrics_bounds(const quicpro_metric_def_t *d, uint8_t *n)
+{
+    if (d->nbounds) {
+        *n = d->nbounds;
+        return d->bounds;
+    }
+    *n = quicpro_metrics_default_nbounds;
+    return quicpro_metrics_default_bounds;
+}
+
+/*──────────────────────────── Recording ──────────────────────────────────*/
+
+void quicpro_metrics_conn_closed(quiche_conn *conn)
+{
+    if (!quicpro_metrics_shard || !conn) {
+        return;
+    }
+    quiche_stats qs;
+    quiche_conn_stats(conn, &qs);
+    quicpro_metrics_add(QUICPRO_METRIC_PACKETS_SENT, qs.sent);
+    quicpro_metrics_add(QUICPRO_METRIC_PACKETS_LOST, qs.lost);
+    quicpro_metrics_add(QUICPRO_METRIC_PACKETS_RETRANSMITTED, qs.retrans);
+}
+
+/*──────────────────────────── Cluster ────────────────────────────────────*/
+
+static _Atomic uint64_t *quicpro_metrics_seg_shard(uint32_t i)
+{
+    return quicpro_metrics_seg + (size_t)i * quicpro_metrics_slots;
+}
+
+void quicpro_metrics_prepare(int nslots, bool enabled)
+{
+    if (quicpro_metrics_seg || nslots <= 0) {
+        return;
+    }
+    quicpro_metrics_fix();
+    if (!enabled) {
+        quicpro_metrics_disabled = true;
+        return;
+    }
+    size_t size = 2 * (size_t)nslots * quicpro_metrics_slots * sizeof(uint64_t);
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED) {
+        php_error_docref(NULL, E_WARNING, "Cluster metrics unavailable: %s", strerror(errno));
+        quicpro_metrics_disabled = true;
+        return;
+    }
+    quicpro_metrics_seg = mem;
+    quicpro_metrics_seg_size = size;
+    quicpro_metrics_nslots = (uint32_t)nslots;
+    quicpro_metrics_start_ns = quicpro_metrics_realtime_ns();
+}
+
+static void quicpro_metrics_srv_stop(void);
+
+void quicpro_metrics_release(void)
+{
+    quicpro_metrics_srv_stop();
+    if (quicpro_metrics_seg) {
+        munmap((void *)quicpro_metrics_seg, quicpro_metrics_seg_size);
+        quicpro_metrics_seg = NULL;
+    }
+    quicpro_metrics_disabled = false;
+    quicpro_metrics_fixed = false;
+    quicpro_metrics_shard = quicpro_metrics_local;
+}
+
+void quicpro_metrics_attach_worker(int worker_id, unsigned generation)
+{
+    /* The master's server thread did not come along; its sockets are the master's */
+    if (quicpro_metrics_srv.listen_fd >= 0) {
+        close(quicpro_metrics_srv.listen_fd);
+        quicpro_metrics_srv.listen_fd = -1;
+    }
+    if (quicpro_metrics_srv.wake_fd >= 0) {
+        close(quicpro_metrics_srv.wake_fd);
+        quicpro_metrics_srv.wake_fd = -1;
+    }
+    quicpro_metrics_srv.running = false;
+
+    if (!quicpro_metrics_seg || worker_id < 0 || (uint32_t)worker_id >= quicpro_metrics_nslots) {
+        quicpro_metrics_shard = quicpro_metrics_disabled ? NULL : quicpro_metrics_local;
+        return;
+    }
+    quicpro_metrics_shard = quicpro_metrics_seg_shard((uint32_t)worker_id + (generation & 1) * quicpro_metrics_nslots);
+}
+
+void quicpro_metrics_worker_exited(int worker_id, unsigned generation)
+{
+    if (!quicpro_metrics_seg || worker_id < 0 || (uint32_t)worker_id >= quicpro_metrics_nslots) {
+        return;
+    }
+    _Atomic uint64_t *s = quicpro_metrics_seg_shard((uint32_t)worker_id + (generation & 1) * quicpro_metrics_nslots);
+    for (uint32_t id = 0; id < quicpro_metrics_count; id++) {
+        if (quicpro_metrics_defs[id].type == QUICPRO_METRIC_GAUGE) {
+            atomic_store_explicit(&s[quicpro_metrics_offset[id]], 0, memory_order_relaxed);
+        }
+    }
+}
+
+/*──────────────────────────── Merging ────────────────────────────────────*/
+
+/* The shards a scrape sums: the cluster's, or this process's own */
+static uint32_t quicpro_metrics_nshards(void)
+{
+    return quicpro_metrics_seg ? 2 * quicpro_metrics_nslots : (quicpro_metrics_local ? 1 : 0);
+}
+
+static const _Atomic uint64_t *quicpro_metrics_shard_at(uint32_t i)
+{
+    return quicpro_metrics_seg ? quicpro_metrics_seg_shard(i) : quicpro_metrics_local;
+}
+
+static uint64_t quicpro_metrics_merge_counter(uint32_t id)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < quicpro_metrics_nshards(); i++) {
+        sum += atomic_load_explicit(&quicpro_metrics_shard_at(i)[quicpro_metrics_offset[id]], memory_order_relaxed);
+    }
+    return sum;
+}
+
+static double quicpro_metrics_merge_gauge(uint32_t id)
+{
+    double sum = 0;
+    for (uint32_t i = 0; i < quicpro_metrics_nshards(); i++) {
+        uint64_t bits = atomic_load_explicit(&quicpro_metrics_shard_at(i)[quicpro_metrics_offset[id]], memory_order_relaxed);
+        double v;
+        memcpy(&v, &bits, sizeof(v));
+        sum += v;
+    }
+    return sum;
+}
+
+/* count, sum, max, then the buckets, as in a shard */
+static void quicpro_metrics_merge_histogram(uint32_t id, uint64_t out[QUICPRO_HDR_SLOTS])
+{
+    memset(out, 0, QUICPRO_HDR_SLOTS * sizeof(uint64_t));
+    for (uint32_t i = 0; i < quicpro_metrics_nshards(); i++) {
+        const _Atomic uint64_t *h = &quicpro_metrics_shard_at(i)[quicpro_metrics_offset[id]];
+        out[0] += atomic_load_explicit(&h[0], memory_order_relaxed);
+        out[1] += atomic_load_explicit(&h[1], memory_order_relaxed);
+        uint64_t max = atomic_load_explicit(&h[2], memory_order_relaxed);
+        if (max > out[2]) {
+            out[2] = max;
+        }
+        for (uint32_t b = 0; b < QUICPRO_HDR_BUCKETS; b++) {
+            out[3 + b] += atomic_load_explicit(&h[3 + b], memory_order_relaxed);
+        }
+    }
+}
+
+/* The values HDR bucket `i` holds: [lo, lo + width) */
+static void quicpro_hdr_range(uint32_t i, uint64_t *lo, uint64_t *width)
+{
+    uint32_t g = i / QUICPRO_HDR_SUB, m = i % QUICPRO_HDR_SUB;
+    if (g == 0) {
+        *lo = m;
+        *width = 1;
+        return;
+    }
+    *lo = (uint64_t)(QUICPRO_HDR_SUB + m) << (g - 1);
+    *width = UINT64_C(1) << (g - 1);
+}
+
+/* Counts of values up to each bound, cumulative; a bucket counts once it lies within the bound entirely */
+static void quicpro_metrics_cumulative(const uint64_t *h, const double *bounds, uint8_t nbounds, uint64_t *out)
+{
+    uint32_t b = 0;
+    uint64_t acc = 0;
+    for (uint8_t k = 0; k < nbounds; k++) {
+        double limit = bounds[k] * QP_METRICS_SCALE;
+        for (; b < QUICPRO_HDR_BUCKETS; b++) {
+            uint64_t lo, width;
+            quicpro_hdr_range(b, &lo, &width);
+            if ((double)(lo + width - 1) > limit) {
+                break;
+            }
+            acc += h[3 + b];
+        }
+        out[k] = acc;
+    }
+}
+
+/* The value at quantile `q`, in exported units: the middle of the bucket that holds it */
+static double quicpro_metrics_quantile(const uint64_t *h, double q)
+{
+    if (!h[0]) {
+        return 0.0;
+    }
+    uint64_t rank = (uint64_t)ceil(q * (double)h[0]), acc = 0;
+    if (rank == 0) {
+        rank = 1;
+    }
+    for (uint32_t b = 0; b < QUICPRO_HDR_BUCKETS; b++) {
+        acc += h[3 + b];
+        if (acc >= rank) {
+            uint64_t lo, width;
+            quicpro_hdr_range(b, &lo, &width);
+            double mid = (double)lo + (double)(width - 1) / 2.0;
+            return (mid < (double)h[2] ? mid : (double)h[2]) / QP_METRICS_SCALE;
+        }
+    }
+    return (double)h[2] / QP_METRICS_SCALE;
+}
+
+/*──────────────────────────── Prometheus ─────────────────────────────────*/
+
+static void quicpro_metrics_printf(quicpro_otlp_buf_t *b, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (n <= 0) {
+        return;
+    }
+    quicpro_otlp_reserve(b, (size_t)n + 1);
+    va_start(ap, fmt);
+    vsnprintf((char *)b->p + b->len, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    b->len += (size_t)n;
+}
+
+/* HELP text escapes backslashes and newlines */
+static void quicpro_metrics_help(quicpro_otlp_buf_t *b, const quicpro_metric_def_t *d)
+{
+    quicpro_metrics_printf(b, "# HELP %s ", d->name);
+    for (const char *c = d->help; *c; c++) {
+        if (*c == '\\' || *c == '\n') {
+            quicpro_metrics_printf(b, "\\%c", *c == '\n' ? 'n' : '\\');
+        } else {
+            quicpro_otlp_reserve(b, 1);
+            b->p[b->len++] = (uint8_t)*c;
+        }
+    }
+    static const char *const types[] = { "counter", "gauge", "histogram" };
+    quicpro_metrics_printf(b, "\n# TYPE %s %s\n", d->name, types[d->type]);
+}
+
+/* Text format 0.0.4 of the merged shards into `b` */
+static void quicpro_metrics_render_text(quicpro_otlp_buf_t *b)
+{
+    uint64_t h[QUICPRO_HDR_SLOTS], cum[QUICPRO_METRICS_BOUNDS_MAX];
+    b->len = 0;
+    for (uint32_t id = 0; id < quicpro_metrics_count; id++) {
+        const quicpro_metric_def_t *d = &quicpro_metrics_defs[id];
+        quicpro_metrics_help(b, d);
+        if (d->type == QUICPRO_METRIC_COUNTER) {
+            quicpro_metrics_printf(b, "%s %llu\n", d->name, (unsigned long long)quicpro_metrics_merge_counter(id));
+            continue;
+        }
+        if (d->type == QUICPRO_METRIC_GAUGE) {
+            quicpro_metrics_printf(b, "%s %.15g\n", d->name, quicpro_metrics_merge_gauge(id));
+            continue;
+        }
+        uint8_t nbounds;
+        const double *bounds = quicpro_metrics_bounds(d, &nbounds);
+        quicpro_metrics_merge_histogram(id, h);
+        quicpro_metrics_cumulative(h, bounds, nbounds, cum);
+        for (uint8_t k = 0; k < nbounds; k++) {
+            quicpro_metrics_printf(b, "%s_bucket{le=\"%g\"} %llu\n", d->name, bounds[k], (unsigned long long)cum[k]);
+        }
+        quicpro_metrics_printf(b, "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %.3f\n%s_count %llu\n",
+                               d->name, (unsigned long long)h[0], d->name, (double)h[1] / QP_METRICS_SCALE,
+                               d->name, (unsigned long long)h[0]);
+    }
+}
+
+/*──────────────────────────── OTLP ───────────────────────────────────────*/
+
+static void quicpro_metrics_encode_otlp(const quicpro_otlp_endpoint_t *ep, quicpro_otlp_buf_t *b)
+{
+    uint64_t h[QUICPRO_HDR_SLOTS], cum[QUICPRO_METRICS_BOUNDS_MAX];
+    uint64_t now = quicpro_metrics_realtime_ns();
+
+    quicpro_otlp_begin(ep, b);
+    size_t rm = quicpro_otlp_open(b, 1);                            /* ExportMetricsServiceRequest.resource_metrics */
+    size_t res = quicpro_otlp_open(b, 1);                           /* ResourceMetrics.resource */
+    quicpro_otlp_kv_str(b, 1, "service.name", ep->service_name);
+    quicpro_otlp_close(b, res);
+    size_t sm = quicpro_otlp_open(b, 2);                            /* ResourceMetrics.scope_metrics */
+    size_t scope = quicpro_otlp_open(b, 1);
+    quicpro_otlp_bytes(b, 1, "quicpro_async", sizeof("quicpro_async") - 1);
+    quicpro_otlp_close(b, scope);
+
+    for (uint32_t id = 0; id < quicpro_metrics_count; id++) {
+        const quicpro_metric_def_t *d = &quicpro_metrics_defs[id];
+        size_t metric = quicpro_otlp_open(b, 2);                    /* ScopeMetrics.metrics */
+        quicpro_otlp_bytes(b, 1, d->name, strlen(d->name));
+        quicpro_otlp_bytes(b, 2, d->help, strlen(d->help));
+        if (d->unit) {
+            quicpro_otlp_bytes(b, 3, d->unit, strlen(d->unit));
+        }
+
+        if (d->type == QUICPRO_METRIC_GAUGE) {
+            size_t gauge = quicpro_otlp_open(b, 5);                 /* Metric.gauge */
+            size_t dp = quicpro_otlp_open(b, 1);
+            quicpro_otlp_fixed64(b, 3, now);
+            quicpro_otlp_double(b, 4, quicpro_metrics_merge_gauge(id));
+            quicpro_otlp_close(b, dp);
+            quicpro_otlp_close(b, gauge);
+        } else if (d->type == QUICPRO_METRIC_COUNTER) {
+            size_t sum = quicpro_otlp_open(b, 7);                   /* Metric.sum */
+            size_t dp = quicpro_otlp_open(b, 1);
+            quicpro_otlp_fixed64(b, 2, quicpro_metrics_start_ns);
+            quicpro_otlp_fixed64(b, 3, now);
+            quicpro_otlp_fixed64(b, 6, quicpro_metrics_merge_counter(id));      /* as_int */
+            quicpro_otlp_close(b, dp);
+            quicpro_otlp_tag(b, 2, 0);
+            quicpro_otlp_varint(b, 2);                              /* AGGREGATION_TEMPORALITY_CUMULATIVE */
+            quicpro_otlp_tag(b, 3, 0);
+            quicpro_otlp_varint(b, 1);                              /* is_monotonic */
+            quicpro_otlp_close(b, sum);
+        } else {
+            uint8_t nbounds;
+            const double *bounds = quicpro_metrics_bounds(d, &nbounds);
+            quicpro_metrics_merge_histogram(id, h);
+            quicpro_metrics_cumulative(h, bounds, nbounds, cum);
+
+            size_t hist = quicpro_otlp_open(b, 9);                  /* Metric.histogram */
+            size_t dp = quicpro_otlp_open(b, 1);
+            quicpro_otlp_fixed64(b, 2, quicpro_metrics_start_ns);
+            quicpro_otlp_fixed64(b, 3, now);
+            quicpro_otlp_fixed64(b, 4, h[0]);
+            quicpro_otlp_double(b, 5, (double)h[1] / QP_METRICS_SCALE);
+            /* OTLP buckets are per bound, not cumulative, with one past the last bound */
+            size_t counts = quicpro_otlp_open(b, 6);
+            for (uint8_t k = 0; k <= nbounds; k++) {
+                uint64_t upto = k < nbounds ? cum[k] : h[0];
+                quicpro_otlp_raw64(b, upto - (k ? cum[k - 1] : 0));
+            }
+            quicpro_otlp_close(b, counts);
+            if (nbounds) {
+                size_t explicit = quicpro_otlp_open(b, 7);
+                for (uint8_t k = 0; k < nbounds; k++) {
+                    uint64_t bits;
+                    memcpy(&bits, &bounds[k], sizeof(bits));
+                    quicpro_otlp_raw64(b, bits);
+                }
+                quicpro_otlp_close(b, explicit);
+            }
+            if (h[0]) {
+                quicpro_otlp_double(b, 12, (double)h[2] / QP_METRICS_SCALE);
+            }
+            quicpro_otlp_close(b, dp);
+            quicpro_otlp_tag(b, 2, 0);
+            quicpro_otlp_varint(b, 2);                              /* AGGREGATION_TEMPORALITY_CUMULATIVE */
+            quicpro_otlp_close(b, hist);
+        }
+        quicpro_otlp_close(b, metric);
+    }
+    quicpro_otlp_close(b, sm);
+    quicpro_otlp_close(b, rm);
+}
+
+/*──────────────────────────── Server thread ──────────────────────────────*/
+
+static void quicpro_metrics_write_all(int fd, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+/* One scrape: GET /metrics (or /) gets the text, anything else a 404 */
+static void quicpro_metrics_answer(int fd, quicpro_otlp_buf_t *body)
+{
+    struct timeval tv = { .tv_sec = 2 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    char req[QP_METRICS_REQUEST_MAX + 1];
+    size_t len = 0;
+    while (len < QP_METRICS_REQUEST_MAX) {
+        ssize_t n = recv(fd, req + len, QP_METRICS_REQUEST_MAX - len, 0);
+        if (n <= 0) {
+            break;
+        }
+        len += (size_t)n;
+        req[len] = '\0';
+        if (strstr(req, "\r\n\r\n")) {
+            break;
+        }
+    }
+    req[len] = '\0';
+
+    char head[160];
+    bool found = (strncmp(req, "GET /metrics", 12) == 0 && (req[12] == ' ' || req[12] == '?'))
+              || strncmp(req, "GET / ", 6) == 0;
+    if (!found) {
+        static const char not_found[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        quicpro_metrics_write_all(fd, not_found, sizeof(not_found) - 1);
+        return;
+    }
+    quicpro_metrics_render_text(body);
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                     "Content-Length: %zu\r\nConnection: close\r\n\r\n", body->len);
+    quicpro_metrics_write_all(fd, head, (size_t)n);
+    quicpro_metrics_write_all(fd, body->p, body->len);
+}
+
+static void *quicpro_metrics_main(void *arg)
+{
+    (void)arg;
+    quicpro_otlp_buf_t text = { 0 }, otlp = { 0 };
+    CURL *curl = quicpro_metrics_srv.push ? quicpro_otlp_connect(&quicpro_metrics_srv.ep) : NULL;
+    uint64_t next_push = quicpro_metrics_now_us() + (uint64_t)quicpro_metrics_srv.interval_ms * 1000;
+
+    for (;;) {
+        struct pollfd pfd[2] = {
+            { .fd = quicpro_metrics_srv.wake_fd, .events = POLLIN },
+            { .fd = quicpro_metrics_srv.listen_fd, .events = POLLIN },
+        };
+        int timeout = -1;
+        if (curl) {
+            uint64_t now = quicpro_metrics_now_us();
+            timeout = next_push > now ? (int)((next_push - now + 999) / 1000) : 0;
+        }
+        int ready = poll(pfd, quicpro_metrics_srv.listen_fd >= 0 ? 2 : 1, timeout);
+        bool stopping = atomic_load_explicit(&quicpro_metrics_srv.stopping, memory_order_acquire);
+
+        if (ready > 0 && (pfd[1].revents & POLLIN) && !stopping) {
+            int fd;
+            while ((fd = accept4(quicpro_metrics_srv.listen_fd, NULL, NULL, SOCK_CLOEXEC)) >= 0) {
+                quicpro_metrics_answer(fd, &text);
+                close(fd);
+            }
+        }
+        /* The last push on the way out carries everything counted up to the end */
+        if (curl && (stopping || quicpro_metrics_now_us() >= next_push)) {
+            quicpro_metrics_encode_otlp(&quicpro_metrics_srv.ep, &otlp);
+            quicpro_otlp_send(curl, &quicpro_metrics_srv.ep, &otlp);
+            next_push = quicpro_metrics_now_us() + (uint64_t)quicpro_metrics_srv.interval_ms * 1000;
+        }
+        if (stopping) {
+            break;
+        }
+    }
+
+    if (curl) {
+        curl_easy_cleanup(curl);
+    }
+    pefree(text.p, 1);
+    pefree(otlp.p, 1);
+    return NULL;
+}
+
+static int quicpro_metrics_listen(const char *host, int port)
+{
+    struct sockaddr_storage ss;
+    socklen_t ss_len;
+    memset(&ss, 0, sizeof(ss));
+    struct sockaddr_in *sin = (struct sockaddr_in *)&ss;
+    struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&ss;
+    if (inet_pton(AF_INET, host, &sin->sin_addr) == 1) {
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons((uint16_t)port);
+        ss_len = sizeof(*sin);
+    } else if (inet_pton(AF_INET6, host, &sin6->sin6_addr) == 1) {
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons((uint16_t)port);
+        ss_len = sizeof(*sin6);
+    } else {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = socket(ss.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr *)&ss, ss_len) != 0 || listen(fd, 64) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+bool quicpro_metrics_serve(const char *host, int port)
+{
+    if (quicpro_metrics_srv.running) {
+        return true;
+    }
+    quicpro_metrics_fix();
+    if (quicpro_metrics_disabled) {
+        return false;
+    }
+
+    quicpro_metrics_srv.push = quicpro_open_telemetry_config.enable && quicpro_open_telemetry_config.metrics_enable
+        && quicpro_otlp_endpoint_init(&quicpro_metrics_srv.ep, QUICPRO_OTLP_METRICS);
+    quicpro_metrics_srv.interval_ms = quicpro_open_telemetry_config.metrics_export_interval_ms > INT_MAX
+        ? INT_MAX : (int)quicpro_open_telemetry_config.metrics_export_interval_ms;
+    if (port > 0) {
+        quicpro_metrics_srv.listen_fd = quicpro_metrics_listen(host ? host : "127.0.0.1", port);
+        if (quicpro_metrics_srv.listen_fd < 0) {
+            php_error_docref(NULL, E_WARNING, "Metrics: cannot listen on %s:%d: %s", host ? host : "127.0.0.1", port, strerror(errno));
+        }
+    }
+    if (quicpro_metrics_srv.listen_fd < 0 && !quicpro_metrics_srv.push) {
+        quicpro_otlp_endpoint_free(&quicpro_metrics_srv.ep);
+        return false;
+    }
+
+    quicpro_metrics_srv.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    atomic_store_explicit(&quicpro_metrics_srv.stopping, false, memory_order_relaxed);
+    if (quicpro_metrics_srv.wake_fd < 0
+        || pthread_create(&quicpro_metrics_srv.thread, NULL, quicpro_metrics_main, NULL) != 0) {
+        php_error_docref(NULL, E_WARNING, "Metrics server thread could not be started: %s", strerror(errno));
+        quicpro_metrics_srv_stop();
+        return false;
+    }
+    quicpro_metrics_srv.running = true;
+    return true;
+}
+
+static void quicpro_metrics_srv_stop(void)
+{
+    if (quicpro_metrics_srv.running) {
+        uint64_t one = 1;
+        atomic_store_explicit(&quicpro_metrics_srv.stopping, true, memory_order_release);
+        (void)!write(quicpro_metrics_srv.wake_fd, &one, sizeof(one));
+        pthread_join(quicpro_metrics_srv.thread, NULL);
+        quicpro_metrics_srv.running = false;
+    }
+    if (quicpro_metrics_srv.wake_fd >= 0) {
+        close(quicpro_metrics_srv.wake_fd);
+        quicpro_metrics_srv.wake_fd = -1;
+    }
+    if (quicpro_metrics_srv.listen_fd >= 0) {
+        close(quicpro_metrics_srv.listen_fd);
+        quicpro_metrics_srv.listen_fd = -1;
+    }
+    quicpro_otlp_endpoint_free(&quicpro_metrics_srv.ep);
+    quicpro_metrics_srv.push = false;
+}
+
+void quicpro_metrics_mshutdown(void)
+{
+    quicpro_metrics_release();
+    if (quicpro_metrics_local) {
+        pefree((void *)quicpro_metrics_local, 1);
+        quicpro_metrics_local = NULL;
+    }
+    quicpro_metrics_shard = NULL;
+    quicpro_metrics_count = 0;
+    quicpro_metrics_slots = 0;
+    zend_hash_destroy(&quicpro_metrics_names);
+}
+
+/*──────────────────────────── PHP API ────────────────────────────────────*/
+
+static bool quicpro_metrics_valid_name(const char *s, size_t len)
+{
+    if (len == 0 || len >= QUICPRO_METRICS_NAME_MAX) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        char c = s[i];
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':' || (i && c >= '0' && c <= '9');
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+PHP_FUNCTION(quicpro_metrics_register)
+{
+    zend_string *name, *type, *help = NULL;
+    HashTable *boundaries = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(2, 4)
+        Z_PARAM_STR(name)
+        Z_PARAM_STR(type)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR(help)
+        Z_PARAM_ARRAY_HT_OR_NULL(boundaries)
+    ZEND_PARSE_PARAMETERS_END();
+
+    uint8_t t;
+    if (zend_string_equals_literal(type, "counter")) {
+        t = QUICPRO_METRIC_COUNTER;
+    } else if (zend_string_equals_literal(type, "gauge")) {
+        t = QUICPRO_METRIC_GAUGE;
+    } else if (zend_string_equals_literal(type, "histogram")) {
+        t = QUICPRO_METRIC_HISTOGRAM;
+    } else {
+        throw_mcp_error_as_php_exception(0, "Metrics::register: type must be \"counter\", \"gauge\" or \"histogram\".");
+        RETURN_FALSE;
+    }
+    if (!quicpro_metrics_valid_name(ZSTR_VAL(name), ZSTR_LEN(name))) {
+        throw_mcp_error_as_php_exception(0, "Metrics::register: '%s' is not a valid metric name.", ZSTR_VAL(name));
+        RETURN_FALSE;
+    }
+
+    int id = quicpro_metrics_find(ZSTR_VAL(name), ZSTR_LEN(name));
+    if (id >= 0) {
+        if (quicpro_metrics_defs[id].type != t) {
+            throw_mcp_error_as_php_exception(0, "Metrics::register: '%s' is already registered with another type.", ZSTR_VAL(name));
+            RETURN_FALSE;
+        }
+        RETURN_TRUE;
+    }
+    if (quicpro_metrics_fixed) {
+        throw_mcp_error_as_php_exception(0, "Metrics::register: instruments must be registered before the cluster starts or metrics are served.");
+        RETURN_FALSE;
+    }
+
+    double bounds[QUICPRO_METRICS_BOUNDS_MAX];
+    uint8_t nbounds = 0;
+    if (boundaries) {
+        zval *zv;
+        if (t != QUICPRO_METRIC_HISTOGRAM || zend_hash_num_elements(boundaries) > QUICPRO_METRICS_BOUNDS_MAX) {
+            throw_mcp_error_as_php_exception(0, "Metrics::register: boundaries are for histograms, %d at most.", QUICPRO_METRICS_BOUNDS_MAX);
+            RETURN_FALSE;
+        }
+        ZEND_HASH_FOREACH_VAL(boundaries, zv) {
+            if ((Z_TYPE_P(zv) != IS_LONG && Z_TYPE_P(zv) != IS_DOUBLE)
+                || (nbounds && zval_get_double(zv) <= bounds[nbounds - 1])) {
+                throw_mcp_error_as_php_exception(0, "Metrics::register: boundaries must be ascending numbers.");
+                RETURN_FALSE;
+            }
+            bounds[nbounds++] = zval_get_double(zv);
+        } ZEND_HASH_FOREACH_END();
+    }
+
+    id = quicpro_metrics_add_def(ZSTR_VAL(name), ZSTR_LEN(name), t, help ? ZSTR_VAL(help) : "", t == QUICPRO_METRIC_COUNTER ? "1" : NULL);
+    if (id < 0) {
+        throw_mcp_error_as_php_exception(0, "Metrics::register: the registry is full (%d instruments).", QUICPRO_METRICS_MAX);
+        RETURN_FALSE;
+    }
+    memcpy(quicpro_metrics_defs[id].bounds, bounds, nbounds * sizeof(double));
+    quicpro_metrics_defs[id].nbounds = nbounds;
+    RETURN_TRUE;
+}
+
+PHP_FUNCTION(quicpro_metrics_increment)
+{
+    zend_string *name;
+    zend_long by = 1;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_STR(name)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(by)
+    ZEND_PARSE_PARAMETERS_END();
+
+    int id = quicpro_metrics_find(ZSTR_VAL(name), ZSTR_LEN(name));
+    if (id < 0 || quicpro_metrics_defs[id].type == QUICPRO_METRIC_HISTOGRAM) {
+        RETURN_FALSE;
+    }
+    if (quicpro_metrics_defs[id].type == QUICPRO_METRIC_GAUGE) {
+        quicpro_metrics_gauge_add((uint32_t)id, (double)by);
+        RETURN_TRUE;
+    }
+    if (by < 0) {
+        throw_mcp_error_as_php_exception(0, "Metrics::increment: counter '%s' cannot decrease.", ZSTR_VAL(name));
+        RETURN_FALSE;
+    }
+    quicpro_metrics_add((uint32_t)id, (uint64_t)by);
+    RETURN_TRUE;
+}
+
+PHP_FUNCTION(quicpro_metrics_set)
+{
+    zend_string *name;
+    double value;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_STR(name)
+        Z_PARAM_DOUBLE(value)
+    ZEND_PARSE_PARAMETERS_END();
+
+    int id = quicpro_metrics_find(ZSTR_VAL(name), ZSTR_LEN(name));
+    if (id < 0 || quicpro_metrics_defs[id].type != QUICPRO_METRIC_GAUGE) {
+        RETURN_FALSE;
+    }
+    if (quicpro_metrics_shard) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        atomic_store_explicit(&quicpro_metrics_shard[quicpro_metrics_offset[id]], bits, memory_order_relaxed);
+    }
+    RETURN_TRUE;
+}
+
+PHP_FUNCTION(quicpro_metrics_observe)
+{
+    zend_string *name;
+    double value;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_STR(name)
+        Z_PARAM_DOUBLE(value)
+    ZEND_PARSE_PARAMETERS_END();
+
+    int id = quicpro_metrics_find(ZSTR_VAL(name), ZSTR_LEN(name));
+    if (id < 0 || quicpro_metrics_defs[id].type != QUICPRO_METRIC_HISTOGRAM) {
+        RETURN_FALSE;
+    }
+    double scaled = value * QP_METRICS_SCALE;
+    quicpro_metrics_observe((uint32_t)id, scaled > 0 && scaled < 18446744073709549568.0 ? (uint64_t)scaled : scaled > 0 ? UINT64_MAX : 0);
+    RETURN_TRUE;
+}
+
+PHP_FUNCTION(quicpro_metrics_render)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    if (!quicpro_metrics_fixed) {
+        quicpro_metrics_load_default_bounds();
+    }
+    quicpro_otlp_buf_t b = { 0 };
+    quicpro_metrics_render_text(&b);
+    RETVAL_STRINGL(b.len ? (const char *)b.p : "", b.len);
+    pefree(b.p, 1);
+}
+
+PHP_FUNCTION(quicpro_metrics_snapshot)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    uint64_t h[QUICPRO_HDR_SLOTS];
+    array_init_size(return_value, quicpro_metrics_count);
+    for (uint32_t id = 0; id < quicpro_metrics_count; id++) {
+        const quicpro_metric_def_t *d = &quicpro_metrics_defs[id];
+        if (d->type == QUICPRO_METRIC_COUNTER) {
+            add_assoc_long(return_value, d->name, (zend_long)quicpro_metrics_merge_counter(id));
+        } else if (d->type == QUICPRO_METRIC_GAUGE) {
+            add_assoc_double(return_value, d->name, quicpro_metrics_merge_gauge(id));
+        } else {
+            zval hist;
+            quicpro_metrics_merge_histogram(id, h);
+            array_init_size(&hist, 7);
+            add_assoc_long(&hist, "count", (zend_long)h[0]);
+            add_assoc_double(&hist, "sum", (double)h[1] / QP_METRICS_SCALE);
+            add_assoc_double(&hist, "max", (double)h[2] / QP_METRICS_SCALE);
+            add_assoc_double(&hist, "p50", quicpro_metrics_quantile(h, 0.50));
+            add_assoc_double(&hist, "p90", quicpro_metrics_quantile(h, 0.90));
+            add_assoc_double(&hist, "p99", quicpro_metrics_quantile(h, 0.99));
+            add_assoc_double(&hist, "p999", quicpro_metrics_quantile(h, 0.999));
+            add_assoc_zval(return_value, d->name, &hist);
+        }
+    }
+}
+
+PHP_FUNCTION(quicpro_metrics_serve)
+{
+    zend_long port = 9091;
+    zend_string *host = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(0, 2)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(port)
+        Z_PARAM_STR(host)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (port < 0 || port > 65535) {
+        throw_mcp_error_as_php_exception(0, "Metrics::serve: port must be between 0 and 65535.");
+        RETURN_FALSE;
+    }
+    if (quicpro_metrics_seg || quicpro_metrics_srv.running) {
+        throw_mcp_error_as_php_exception(0, "Metrics::serve: metrics are already served (by the cluster or an earlier call).");
+        RETURN_FALSE;
+    }
+    RETURN_BOOL(quicpro_metrics_serve(host ? ZSTR_VAL(host) : "127.0.0.1", (int)port));
+}
@@ -0,0 +1,444 @@
+/*
+ * ocsp.c  –  Shared OCSP staple cache for php-quicpro listeners
+ * -------------------------------------------------------------
+ *
+ * See include/server/ocsp.h. The table is open-addressed on the leaf
+ * fingerprint with a short probe sequence. A slot goes
+ *
+ *     EMPTY -> CLAIMED -> WANTED -> READY
+ *                    \---> NONE    (the certificate names no responder)
+ *
+ * Handshakes claim slots with a compare-and-swap and fill the request
+ * before publishing WANTED. From then on only the owner (the master, or
+ * the stand-alone fetcher thread) writes the slot. It brackets every write
+ * of the staple, and the reset of an idle slot, with the sequence counter.
+ */
+
+#include "php_quicpro.h"
+#include "server/ocsp.h"
+#include "config/tls_and_crypto/base_layer.h"
+
+#include <curl/curl.h>
+#include <openssl/err.h>
+#include <openssl/ocsp.h>
+#include <openssl/x509v3.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define QP_OCSP_SLOTS          512
+#define QP_OCSP_PROBE          8
+#define QP_OCSP_ID_MAX         128     /* DER OCSP CertID */
+#define QP_OCSP_URL_MAX        256
+#define QP_OCSP_ISSUER_MAX     4096    /* DER issuer certificate */
+#define QP_OCSP_RESP_MAX       4096    /* DER OCSP response */
+#define QP_OCSP_TIMEOUT_MS     3000
+#define QP_OCSP_PER_TICK       4       /* Fetches per tick, so a slow responder cannot stall the supervisor for long */
+#define QP_OCSP_RETRY_SEC      60      /* First retry after a failed fetch, doubling up to an hour */
+#define QP_OCSP_IDLE_SEC       86400   /* Unused staples are dropped after this */
+#define QP_OCSP_SKEW_SEC       300
+
+enum { QP_OCSP_EMPTY, QP_OCSP_CLAIMED, QP_OCSP_WANTED, QP_OCSP_READY, QP_OCSP_NONE };
+
+typedef struct {
+    _Atomic uint32_t state;
+    _Atomic uint64_t seq;               /* Odd while the staple is being written */
+    _Atomic int64_t  last_used;         /* Wall-clock seconds of the last handshake asking for it */
+    uint8_t   fp[SHA_DIGEST_LENGTH];    /* Leaf certificate */
+
+    /* The request, written by the claiming handshake */
+    uint16_t  id_len;
+    uint16_t  issuer_len;
+    uint8_t   id[QP_OCSP_ID_MAX];
+    char      url[QP_OCSP_URL_MAX];
+    uint8_t   issuer[QP_OCSP_ISSUER_MAX];
+
+    /* The staple, written by the owner */
+    uint32_t  resp_len;
+    int64_t   next_update;              /* Wall clock; the staple is served before this */
+    uint8_t   resp[QP_OCSP_RESP_MAX];
+
+    /* The owner's schedule */
+    int64_t   refresh_at;
+    uint32_t  failures;
+} qp_ocsp_slot_t;
+
+typedef struct {
+    pid_t           owner;              /* Only this process fetches */
+    qp_ocsp_slot_t  slot[QP_OCSP_SLOTS];
+} qp_ocsp_table_t;
+
+static qp_ocsp_table_t *qp_ocsp_table = NULL;
+static uint64_t          qp_ocsp_next = 0;
+static CURL             *qp_ocsp_curl = NULL;
+static pthread_t         qp_ocsp_thread;
+static bool              qp_ocsp_thread_running = false;
+static _Atomic bool      qp_ocsp_stopping = false;
+
+static uint64_t qp_ocsp_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/*──────────────────────────── Table lifecycle ────────────────────────────*/
+
+void quicpro_ocsp_prepare(void)
+{
+    if (qp_ocsp_table || !quicpro_tls_crypto_config.tls_enable_ocsp_stapling) {
+        return;
+    }
+    void *mem = mmap(NULL, sizeof(qp_ocsp_table_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        php_error_docref(NULL, E_WARNING, "OCSP staple cache unavailable; handshakes are served without staples");
+        return;
+    }
+    qp_ocsp_table = mem;
+    qp_ocsp_table->owner = getpid();
+}
+
+void quicpro_ocsp_release(void)
+{
+    if (qp_ocsp_thread_running) {
+        atomic_store(&qp_ocsp_stopping, true);
+        pthread_join(qp_ocsp_thread, NULL);
+        qp_ocsp_thread_running = false;
+    }
+    if (qp_ocsp_curl) {
+        curl_easy_cleanup(qp_ocsp_curl);
+        qp_ocsp_curl = NULL;
+    }
+    if (qp_ocsp_table) {
+        munmap(qp_ocsp_table, sizeof(*qp_ocsp_table));
+        qp_ocsp_table = NULL;
+    }
+}
+
+/*──────────────────────────── Handshakes ─────────────────────────────────*/
+
+/* The slot for `fp`, or a claimed empty one if `claimed` is given and there is room */
+static qp_ocsp_slot_t *qp_ocsp_find(const uint8_t *fp, bool *claimed)
+{
+    uint32_t h;
+    memcpy(&h, fp, sizeof(h));
+    qp_ocsp_slot_t *free_slot = NULL;
+    for (uint32_t i = 0; i < QP_OCSP_PROBE; i++) {
+        qp_ocsp_slot_t *s = &qp_ocsp_table->slot[(h + i) % QP_OCSP_SLOTS];
+        uint32_t state = atomic_load_explicit(&s->state, memory_order_acquire);
+        if (state == QP_OCSP_EMPTY) {
+            if (!free_slot) free_slot = s;
+        } else if (state != QP_OCSP_CLAIMED && memcmp(s->fp, fp, sizeof(s->fp)) == 0) {
+            return s;
+        }
+    }
+    uint32_t expected = QP_OCSP_EMPTY;
+    if (claimed && free_slot
+        && atomic_compare_exchange_strong_explicit(&free_slot->state, &expected, QP_OCSP_CLAIMED, memory_order_acq_rel, memory_order_relaxed)) {
+        *claimed = true;
+        return free_slot;
+    }
+    return NULL;
+}
+
+/* Fills a claimed slot with what the owner needs to fetch the staple */
+static void qp_ocsp_request(qp_ocsp_slot_t *s, const uint8_t *fp, SSL *ssl, X509 *leaf)
+{
+    uint32_t state = QP_OCSP_NONE;
+    X509 *issuer = NULL;
+    STACK_OF(X509) *chain = NULL;
+    SSL_get0_chain_certs(ssl, &chain);
+    if (!chain || sk_X509_num(chain) == 0) {
+        SSL_CTX_get_extra_chain_certs(SSL_get_SSL_CTX(ssl), &chain);
+    }
+    for (int i = 0; chain && i < sk_X509_num(chain); i++) {
+        if (X509_check_issued(sk_X509_value(chain, i), leaf) == X509_V_OK) {
+            issuer = sk_X509_value(chain, i);
+            break;
+        }
+    }
+
+    memcpy(s->fp, fp, sizeof(s->fp));
+    s->resp_len = 0;
+    s->refresh_at = 0;
+    s->failures = 0;
+    atomic_store_explicit(&s->last_used, (int64_t)time(NULL), memory_order_relaxed);
+
+    STACK_OF(OPENSSL_STRING) *urls = issuer ? X509_get1_ocsp(leaf) : NULL;
+    OCSP_CERTID *id = issuer ? OCSP_cert_to_id(NULL, leaf, issuer) : NULL;
+    const char *url = urls && sk_OPENSSL_STRING_num(urls) > 0 ? sk_OPENSSL_STRING_value(urls, 0) : NULL;
+    int id_len = id ? i2d_OCSP_CERTID(id, NULL) : -1;
+    int issuer_len = issuer ? i2d_X509(issuer, NULL) : -1;
+    if (url && strlen(url) < sizeof(s->url) && id_len > 0 && id_len <= QP_OCSP_ID_MAX
+        && issuer_len > 0 && issuer_len <= QP_OCSP_ISSUER_MAX) {
+        uint8_t *p = s->id;
+        s->id_len = (uint16_t)i2d_OCSP_CERTID(id, &p);
+        p = s->issuer;
+        s->issuer_len = (uint16_t)i2d_X509(issuer, &p);
+        strcpy(s->url, url);
+        state = QP_OCSP_WANTED;
+    }
+    OCSP_CERTID_free(id);
+    X509_email_free(urls);
+    atomic_store_explicit(&s->state, state, memory_order_release);
+}
+
+static int qp_ocsp_status_cb(SSL *ssl, void *arg)
+{
+    (void)arg;
+    X509 *leaf = SSL_get_certificate(ssl);
+    uint8_t fp[SHA_DIGEST_LENGTH];
+    unsigned fp_len = 0;
+    if (!leaf || !qp_ocsp_table || X509_digest(leaf, EVP_sha1(), fp, &fp_len) != 1) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    bool claimed = false;
+    qp_ocsp_slot_t *s = qp_ocsp_find(fp, &claimed);
+    if (!s) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    if (claimed) {
+        qp_ocsp_request(s, fp, ssl, leaf);   /* This handshake goes without; the next ones get it */
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    int64_t now = (int64_t)time(NULL);
+    if (atomic_load_explicit(&s->last_used, memory_order_relaxed) != now) {
+        atomic_store_explicit(&s->last_used, now, memory_order_relaxed);
+    }
+    if (atomic_load_explicit(&s->state, memory_order_acquire) != QP_OCSP_READY) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    uint8_t resp[QP_OCSP_RESP_MAX];
+    uint32_t len;
+    int64_t next_update;
+    uint64_t seq;
+    do {
+        seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+        len = s->resp_len;
+        next_update = s->next_update;
+        if (len > sizeof(resp)) {
+            len = 0;
+        }
+        memcpy(resp, s->resp, len);
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1) || atomic_load_explicit(&s->seq, memory_order_relaxed) != seq);
+
+    if (len == 0 || now >= next_update) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    unsigned char *copy = OPENSSL_memdup(resp, len);
+    if (!copy || SSL_set_tlsext_status_ocsp_resp(ssl, copy, (long)len) != 1) {
+        OPENSSL_free(copy);
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    return SSL_TLSEXT_ERR_OK;
+}
+
+/*──────────────────────────── Fetching ───────────────────────────────────*/
+
+typedef struct {
+    uint8_t buf[QP_OCSP_RESP_MAX];
+    size_t  len;
+    bool    overflow;
+} qp_ocsp_body_t;
+
+static size_t qp_ocsp_write(char *data, size_t size, size_t n, void *arg)
+{
+    qp_ocsp_body_t *b = arg;
+    size_t len = size * n;
+    if (b->len + len > sizeof(b->buf)) {
+        b->overflow = true;
+        return 0;
+    }
+    memcpy(b->buf + b->len, data, len);
+    b->len += len;
+    return len;
+}
+
+/* Seconds from now until `t`, negative once it passed */
+static int64_t qp_ocsp_seconds_until(const ASN1_GENERALIZEDTIME *t)
+{
+    int days = 0, secs = 0;
+    if (!t || ASN1_TIME_diff(&days, &secs, NULL, t) != 1) {
+        return 0;
+    }
+    return (int64_t)days * 86400 + secs;
+}
+
+/* Checks a response for `s`'s certificate; returns its validity in seconds from now, 0 if unusable */
+static int64_t qp_ocsp_check(qp_ocsp_slot_t *s, OCSP_RESPONSE *resp, OCSP_CERTID *id, int64_t *lifetime)
+{
+    int64_t valid = 0;
+    OCSP_BASICRESP *bs = OCSP_response_status(resp) == OCSP_RESPONSE_STATUS_SUCCESSFUL ? OCSP_response_get1_basic(resp) : NULL;
+    const unsigned char *p = s->issuer;
+    X509 *issuer = bs ? d2i_X509(NULL, &p, s->issuer_len) : NULL;
+    X509_STORE *store = issuer ? X509_STORE_new() : NULL;
+    STACK_OF(X509) *certs = store ? sk_X509_new_null() : NULL;
+
+    int status, reason;
+    ASN1_GENERALIZEDTIME *rev, *this_update, *next_update;
+    /* The issuer is the trust anchor: it signs the response, or the responder certificate that does */
+    if (certs && X509_STORE_add_cert(store, issuer) == 1 && sk_X509_push(certs, issuer) > 0
+        && X509_STORE_set_flags(store, X509_V_FLAG_PARTIAL_CHAIN) == 1
+        && OCSP_basic_verify(bs, certs, store, 0) == 1
+        && OCSP_resp_find_status(bs, id, &status, &reason, &rev, &this_update, &next_update) == 1
+        && status == V_OCSP_CERTSTATUS_GOOD
+        && OCSP_check_validity(this_update, next_update, QP_OCSP_SKEW_SEC, -1) == 1) {
+        /* Without a nextUpdate the responder always has fresher data; ask again in an hour */
+        valid = next_update ? qp_ocsp_seconds_until(next_update) : 3600;
+        *lifetime = valid - qp_ocsp_seconds_until(this_update);
+    }
+    sk_X509_free(certs);
+    X509_STORE_free(store);
+    X509_free(issuer);
+    OCSP_BASICRESP_free(bs);
+    ERR_clear_error();
+    return valid > 0 ? valid : 0;
+}
+
+static void qp_ocsp_fetch(qp_ocsp_slot_t *s, int64_t now)
+{
+    const unsigned char *p = s->id;
+    OCSP_CERTID *id = d2i_OCSP_CERTID(NULL, &p, s->id_len);
+    OCSP_REQUEST *req = id ? OCSP_REQUEST_new() : NULL;
+    unsigned char *req_der = NULL;
+    int req_len = -1;
+    if (req && OCSP_request_add0_id(req, id)) {
+        req_len = i2d_OCSP_REQUEST(req, &req_der);
+    } else {
+        OCSP_CERTID_free(id);
+        id = NULL;
+    }
+
+    qp_ocsp_body_t *body = pecalloc(1, sizeof(*body), 1);
+    long http_status = 0;
+    if (req_len > 0 && (qp_ocsp_curl || (qp_ocsp_curl = curl_easy_init()) != NULL)) {
+        struct curl_slist *headers = curl_slist_append(NULL, "Content-Type: application/ocsp-request");
+        CURL *h = qp_ocsp_curl;
+        curl_easy_reset(h);
+        curl_easy_setopt(h, CURLOPT_URL, s->url);
+        curl_easy_setopt(h, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(h, CURLOPT_POSTFIELDS, (const char *)req_der);
+        curl_easy_setopt(h, CURLOPT_POSTFIELDSIZE, (long)req_len);
+        curl_easy_setopt(h, CURLOPT_TIMEOUT_MS, (long)QP_OCSP_TIMEOUT_MS);
+        curl_easy_setopt(h, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(h, CURLOPT_WRITEFUNCTION, qp_ocsp_write);
+        curl_easy_setopt(h, CURLOPT_WRITEDATA, body);
+        if (curl_easy_perform(h) == CURLE_OK) {
+            curl_easy_getinfo(h, CURLINFO_RESPONSE_CODE, &http_status);
+        }
+        curl_slist_free_all(headers);
+    }
+
+    int64_t valid = 0, lifetime = 0;
+    if (http_status == 200 && !body->overflow) {
+        p = body->buf;
+        OCSP_RESPONSE *resp = d2i_OCSP_RESPONSE(NULL, &p, (long)body->len);
+        if (resp) {
+            valid = qp_ocsp_check(s, resp, id, &lifetime);
+            OCSP_RESPONSE_free(resp);
+        }
+    }
+
+    if (valid > 0) {
+        atomic_fetch_add_explicit(&s->seq, 1, memory_order_acq_rel);
+        memcpy(s->resp, body->buf, body->len);
+        s->resp_len = (uint32_t)body->len;
+        s->next_update = now + valid;
+        atomic_fetch_add_explicit(&s->seq, 1, memory_order_release);
+        atomic_store_explicit(&s->state, QP_OCSP_READY, memory_order_release);
+        /* Halfway through the validity, so a failing responder leaves plenty of retries */
+        int64_t half = lifetime > 0 && lifetime / 2 < valid ? valid - lifetime / 2 : valid / 2;
+        s->refresh_at = now + (half > QP_OCSP_RETRY_SEC ? half : QP_OCSP_RETRY_SEC);
+        s->failures = 0;
+    } else {
+        /* The previous staple, if any, is served until its nextUpdate */
+        uint32_t shift = s->failures < 6 ? s->failures : 6;
+        s->refresh_at = now + (QP_OCSP_RETRY_SEC << shift);
+        s->failures++;
+    }
+    pefree(body, 1);
+    OPENSSL_free(req_der);
+    OCSP_REQUEST_free(req);   /* Frees `id` */
+}
+
+/* Returns an idle slot to EMPTY; readers copying from it see the sequence move */
+static void qp_ocsp_drop(qp_ocsp_slot_t *s)
+{
+    atomic_fetch_add_explicit(&s->seq, 1, memory_order_acq_rel);
+    s->resp_len = 0;
+    memset(s->fp, 0, sizeof(s->fp));
+    atomic_fetch_add_explicit(&s->seq, 1, memory_order_release);
+    atomic_store_explicit(&s->state, QP_OCSP_EMPTY, memory_order_release);
+}
+
+void quicpro_ocsp_tick(void)
+{
+    qp_ocsp_table_t *t = qp_ocsp_table;
+    if (!t || t->owner != getpid()) {
+        return;
+    }
+    int64_t now = (int64_t)time(NULL);
+    int fetched = 0;
+    for (int i = 0; i < QP_OCSP_SLOTS; i++) {
+        qp_ocsp_slot_t *s = &t->slot[i];
+        uint32_t state = atomic_load_explicit(&s->state, memory_order_acquire);
+        if (state == QP_OCSP_EMPTY || state == QP_OCSP_CLAIMED) {
+            continue;
+        }
+        if (now - atomic_load_explicit(&s->last_used, memory_order_relaxed) > QP_OCSP_IDLE_SEC) {
+            qp_ocsp_drop(s);
+            continue;
+        }
+        if (state == QP_OCSP_NONE) {
+            continue;
+        }
+        if (s->refresh_at <= now && fetched < QP_OCSP_PER_TICK) {
+            qp_ocsp_fetch(s, now);
+            fetched++;
+        }
+    }
+    /* Workers file requests at any time; a scan of the table is cheap */
+    qp_ocsp_next = qp_ocsp_now_ms() + 1000;
+}
+
+uint64_t quicpro_ocsp_next_ms(void)
+{
+    return qp_ocsp_table && qp_ocsp_table->owner == getpid() ? qp_ocsp_next : 0;
+}
+
+/*──────────────────────────── Stand-alone fetcher ────────────────────────*/
+
+static void *qp_ocsp_thread_main(void *arg)
+{
+    (void)arg;
+    while (!atomic_load(&qp_ocsp_stopping)) {
+        quicpro_ocsp_tick();
+        usleep(1000 * 1000);
+    }
+    return NULL;
+}
+
+void quicpro_ocsp_install(SSL_CTX *ctx)
+{
+    quicpro_ocsp_prepare();
+    if (!qp_ocsp_table) {
+        return;
+    }
+    SSL_CTX_set_tlsext_status_cb(ctx, qp_ocsp_status_cb);
+    if (qp_ocsp_table->owner == getpid() && !qp_ocsp_thread_running) {
+        atomic_store(&qp_ocsp_stopping, false);
+        if (pthread_create(&qp_ocsp_thread, NULL, qp_ocsp_thread_main, NULL) == 0) {
+            qp_ocsp_thread_running = true;
+        } else {
+            php_error_docref(NULL, E_WARNING, "OCSP fetcher thread could not start; handshakes are served without staples");
+        }
+    }
+}
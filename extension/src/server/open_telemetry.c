@@ -0,0 +1,612 @@
+/*
+ * open_telemetry.c  –  Native span tracer and OTLP exporter for php-quicpro
+ * -------------------------------------------------------------------------
+ *
+ * Span ring protocol (one per process):
+ *
+ *   loop      span_end()  copy the span into slots[head], publish head;
+ *                         a ring that fills up to a batch writes the eventfd
+ *   exporter  thread      wakes on the eventfd or after the schedule delay,
+ *                         encodes slots[tail .. head) into an OTLP request,
+ *                         publishes tail, then sends the request
+ *
+ * `head` is only written by the loop and `tail` only by the exporter. The
+ * exporter reads nothing of the PHP configuration: what it needs is copied
+ * when the tracer starts. After a fork only the loop thread exists in the
+ * child, so the child drops what the parent had queued and starts its own
+ * exporter with its first span. The protobuf writer and the POST itself
+ * are shared with the metrics pusher (server/otlp.h).
+ */
+
+#include "php_quicpro.h"
+#include "server/open_telemetry.h"
+#include "server/cid.h"
+#include "server/otlp.h"
+#include "config/open_telemetry/base_layer.h"
+#include "config/open_telemetry/config.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define QP_OTEL_EXPORT_BATCH 512    /* Spans per request at most */
+
+enum { QP_OTEL_SAMPLE_ON, QP_OTEL_SAMPLE_OFF, QP_OTEL_SAMPLE_PARENT_RATIO };
+
+typedef struct {
+    _Alignas(64) _Atomic uint64_t head;
+    _Alignas(64) _Atomic uint64_t tail;
+    _Alignas(64) _Atomic uint64_t dropped;
+    _Atomic uint64_t exported;
+    _Atomic uint64_t failed;
+
+    quicpro_otel_span_t *slots;
+    uint64_t mask;
+    uint64_t batch;
+    int      wake_fd;
+    _Atomic bool stopping;
+    bool     running;                   /* The exporter thread of this process exists */
+    bool     forked;                    /* Set in a child: start an exporter with the first span */
+    pthread_t thread;
+
+    /* Fixed when the tracer starts */
+    quicpro_otlp_endpoint_t ep;
+    int      delay_ms;
+    uint8_t  max_attrs;
+    int      sampler;
+    uint64_t ratio_bound;               /* Root spans whose trace ID draws below this are sampled */
+    uint64_t rng[2];
+} quicpro_otel_tracer_t;
+
+static quicpro_otel_tracer_t quicpro_otel = { .wake_fd = -1 };
+
+/* See quicpro_otel_scope_open(); by value, see quicpro_otel_scope_t */
+static ZEND_TLS quicpro_otel_context_t quicpro_otel_ctx_current;
+static ZEND_TLS bool quicpro_otel_ctx_set;
+
+static inline uint64_t quicpro_otel_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* xorshift128+: IDs need to be unique, not unpredictable */
+static inline uint64_t quicpro_otel_rand(void)
+{
+    uint64_t s1 = quicpro_otel.rng[0];
+    const uint64_t s0 = quicpro_otel.rng[1];
+    quicpro_otel.rng[0] = s0;
+    s1 ^= s1 << 23;
+    quicpro_otel.rng[1] = s1 ^ s0 ^ (s1 >> 17) ^ (s0 >> 26);
+    return quicpro_otel.rng[1] + s0;
+}
+
+static void quicpro_otel_seed(void)
+{
+    if (quicpro_cid_random_bytes((uint8_t *)quicpro_otel.rng, sizeof(quicpro_otel.rng)) < 0
+        || (quicpro_otel.rng[0] | quicpro_otel.rng[1]) == 0) {
+        quicpro_otel.rng[0] = quicpro_otel_now_ns() | 1;
+        quicpro_otel.rng[1] = (uint64_t)getpid() * 0x9e3779b97f4a7c15ULL;
+    }
+}
+
+/*──────────────────────────── Span encoding ──────────────────────────────*/
+
+static void quicpro_otel_encode_span(quicpro_otlp_buf_t *b, const quicpro_otel_span_t *s)
+{
+    size_t span = quicpro_otlp_open(b, 2);                          /* ScopeSpans.spans */
+    quicpro_otlp_bytes(b, 1, s->ctx.trace_id, sizeof(s->ctx.trace_id));
+    quicpro_otlp_bytes(b, 2, s->ctx.span_id, sizeof(s->ctx.span_id));
+    if (s->has_parent) {
+        quicpro_otlp_bytes(b, 4, s->parent_span_id, sizeof(s->parent_span_id));
+    }
+    quicpro_otlp_bytes(b, 5, s->name, strnlen(s->name, sizeof(s->name)));
+    quicpro_otlp_tag(b, 6, 0);
+    quicpro_otlp_varint(b, s->kind);
+    quicpro_otlp_fixed64(b, 7, s->start_ns);
+    quicpro_otlp_fixed64(b, 8, s->end_ns);
+
+    for (unsigned i = 0; i < s->nattrs; i++) {
+        const quicpro_otel_attr_t *a = &s->attrs[i];
+        size_t kv = quicpro_otlp_open(b, 9);
+        quicpro_otlp_bytes(b, 1, a->key, strlen(a->key));
+        size_t any = quicpro_otlp_open(b, 2);
+        switch (a->type) {
+            case QUICPRO_OTEL_ATTR_STR:
+                quicpro_otlp_bytes(b, 1, a->v.s, strnlen(a->v.s, sizeof(a->v.s)));
+                break;
+            case QUICPRO_OTEL_ATTR_BOOL:
+                quicpro_otlp_tag(b, 2, 0);
+                quicpro_otlp_varint(b, a->v.b);
+                break;
+            case QUICPRO_OTEL_ATTR_INT:
+                quicpro_otlp_tag(b, 3, 0);
+                quicpro_otlp_varint(b, (uint64_t)a->v.i);
+                break;
+            default: {
+                uint64_t bits;
+                memcpy(&bits, &a->v.d, sizeof(bits));
+                quicpro_otlp_fixed64(b, 4, bits);
+                break;
+            }
+        }
+        quicpro_otlp_close(b, any);
+        quicpro_otlp_close(b, kv);
+    }
+
+    if (s->error) {
+        size_t status = quicpro_otlp_open(b, 15);
+        quicpro_otlp_tag(b, 3, 0);
+        quicpro_otlp_varint(b, 2);                                  /* STATUS_CODE_ERROR */
+        quicpro_otlp_close(b, status);
+    }
+    quicpro_otlp_close(b, span);
+}
+
+/*──────────────────────────── Exporter thread ────────────────────────────*/
+
+/* One request of up to a batch of spans; returns how many it took from the ring */
+static uint64_t quicpro_otel_export(CURL *curl, quicpro_otlp_buf_t *b)
+{
+    uint64_t tail = atomic_load_explicit(&quicpro_otel.tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&quicpro_otel.head, memory_order_acquire);
+    uint64_t n = head - tail;
+    if (n == 0) {
+        return 0;
+    }
+    if (n > quicpro_otel.batch) {
+        n = quicpro_otel.batch;
+    }
+
+    quicpro_otlp_begin(&quicpro_otel.ep, b);
+    size_t rs = quicpro_otlp_open(b, 1);                            /* ExportTraceServiceRequest.resource_spans */
+    size_t res = quicpro_otlp_open(b, 1);                           /* ResourceSpans.resource */
+    quicpro_otlp_kv_str(b, 1, "service.name", quicpro_otel.ep.service_name);
+    quicpro_otlp_close(b, res);
+    size_t ss = quicpro_otlp_open(b, 2);                            /* ResourceSpans.scope_spans */
+    size_t scope = quicpro_otlp_open(b, 1);
+    quicpro_otlp_bytes(b, 1, "quicpro_async", sizeof("quicpro_async") - 1);
+    quicpro_otlp_close(b, scope);
+    for (uint64_t i = 0; i < n; i++) {
+        quicpro_otel_encode_span(b, &quicpro_otel.slots[(tail + i) & quicpro_otel.mask]);
+    }
+    quicpro_otlp_close(b, ss);
+    quicpro_otlp_close(b, rs);
+    /* Encoded: the slots are the loop's again */
+    atomic_store_explicit(&quicpro_otel.tail, tail + n, memory_order_release);
+
+    if (curl && quicpro_otlp_send(curl, &quicpro_otel.ep, b)) {
+        atomic_fetch_add_explicit(&quicpro_otel.exported, n, memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(&quicpro_otel.failed, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&quicpro_otel.dropped, n, memory_order_relaxed);
+    }
+    return n;
+}
+
+static void *quicpro_otel_exporter_main(void *arg)
+{
+    (void)arg;
+    quicpro_otlp_buf_t b = { 0 };
+    CURL *curl = quicpro_otlp_connect(&quicpro_otel.ep);
+
+    for (;;) {
+        bool stopping = atomic_load_explicit(&quicpro_otel.stopping, memory_order_acquire);
+        if (!stopping) {
+            struct pollfd pfd = { .fd = quicpro_otel.wake_fd, .events = POLLIN };
+            if (poll(&pfd, 1, quicpro_otel.delay_ms) > 0) {
+                uint64_t v;
+                (void)!read(quicpro_otel.wake_fd, &v, sizeof(v));
+            }
+            stopping = atomic_load_explicit(&quicpro_otel.stopping, memory_order_acquire);
+        }
+        /* Full batches go out back to back; a partial one waits for the next delay */
+        while (quicpro_otel_export(curl, &b) == quicpro_otel.batch) {
+        }
+        if (stopping) {
+            break;
+        }
+    }
+
+    if (curl) {
+        curl_easy_cleanup(curl);
+    }
+    pefree(b.p, 1);
+    return NULL;
+}
+
+/*──────────────────────────── Lifecycle ──────────────────────────────────*/
+
+static bool quicpro_otel_spawn(void)
+{
+    quicpro_otel.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (quicpro_otel.wake_fd < 0) {
+        return false;
+    }
+    atomic_store_explicit(&quicpro_otel.stopping, false, memory_order_relaxed);
+    if (pthread_create(&quicpro_otel.thread, NULL, quicpro_otel_exporter_main, NULL) != 0) {
+        close(quicpro_otel.wake_fd);
+        quicpro_otel.wake_fd = -1;
+        return false;
+    }
+    quicpro_otel.running = true;
+    return true;
+}
+
+static void quicpro_otel_atfork_child(void)
+{
+    if (!quicpro_otel.running && !quicpro_otel.forked) {
+        return;
+    }
+    /* The parent's exporter did not come along; its queue is the parent's to send */
+    quicpro_otel.running = false;
+    quicpro_otel.forked = true;
+    if (quicpro_otel.wake_fd >= 0) {
+        close(quicpro_otel.wake_fd);
+        quicpro_otel.wake_fd = -1;
+    }
+    atomic_store_explicit(&quicpro_otel.head, 0, memory_order_relaxed);
+    atomic_store_explicit(&quicpro_otel.tail, 0, memory_order_relaxed);
+    atomic_store_explicit(&quicpro_otel.dropped, 0, memory_order_relaxed);
+    atomic_store_explicit(&quicpro_otel.exported, 0, memory_order_relaxed);
+    atomic_store_explicit(&quicpro_otel.failed, 0, memory_order_relaxed);
+    quicpro_otel_seed();
+}
+
+bool quicpro_otel_start(void)
+{
+    if (quicpro_otel.running) {
+        return true;
+    }
+    if (quicpro_otel.forked) {
+        return quicpro_otel_spawn();
+    }
+    if (!quicpro_open_telemetry_config.enable || !quicpro_otlp_endpoint_init(&quicpro_otel.ep, QUICPRO_OTLP_TRACES)) {
+        return false;
+    }
+
+    uint64_t nslots = 2;
+    while (nslots < (uint64_t)quicpro_open_telemetry_config.batch_processor_max_queue_size) {
+        nslots <<= 1;
+    }
+    quicpro_otel.slots = pemalloc(nslots * sizeof(quicpro_otel_span_t), 1);
+    quicpro_otel.mask = nslots - 1;
+    quicpro_otel.batch = nslots / 2 < QP_OTEL_EXPORT_BATCH ? nslots / 2 : QP_OTEL_EXPORT_BATCH;
+
+    quicpro_otel.delay_ms = quicpro_open_telemetry_config.batch_processor_schedule_delay_ms > INT_MAX
+                            ? INT_MAX : (int)quicpro_open_telemetry_config.batch_processor_schedule_delay_ms;
+    zend_long max_attrs = quicpro_open_telemetry_config.traces_max_attributes_per_span;
+    quicpro_otel.max_attrs = max_attrs < QUICPRO_OTEL_SPAN_ATTRS ? (uint8_t)max_attrs : QUICPRO_OTEL_SPAN_ATTRS;
+
+    const char *sampler = quicpro_open_telemetry_config.traces_sampler_type;
+    double ratio = quicpro_open_telemetry_config.traces_sampler_ratio;
+    quicpro_otel.sampler = sampler && strcasecmp(sampler, "always_on") == 0 ? QP_OTEL_SAMPLE_ON
+                         : sampler && strcasecmp(sampler, "always_off") == 0 ? QP_OTEL_SAMPLE_OFF
+                         : QP_OTEL_SAMPLE_PARENT_RATIO;
+    quicpro_otel.ratio_bound = ratio >= 1.0 ? UINT64_MAX : ratio <= 0.0 ? 0 : (uint64_t)(ratio * 18446744073709551616.0);
+    quicpro_otel_seed();
+
+    static bool atfork_registered = false;
+    if (!atfork_registered) {
+        pthread_atfork(NULL, NULL, quicpro_otel_atfork_child);
+        atfork_registered = true;
+    }
+    if (!quicpro_otel_spawn()) {
+        php_error_docref(NULL, E_WARNING, "OpenTelemetry exporter thread could not be started: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void quicpro_otel_shutdown(void)
+{
+    if (quicpro_otel.running) {
+        uint64_t one = 1;
+        atomic_store_explicit(&quicpro_otel.stopping, true, memory_order_release);
+        (void)!write(quicpro_otel.wake_fd, &one, sizeof(one));
+        pthread_join(quicpro_otel.thread, NULL);
+        close(quicpro_otel.wake_fd);
+        quicpro_otel.wake_fd = -1;
+        quicpro_otel.running = false;
+    }
+    if (quicpro_otel.slots) {
+        pefree(quicpro_otel.slots, 1);
+        quicpro_otel.slots = NULL;
+        quicpro_otel.forked = false;
+        quicpro_otlp_endpoint_free(&quicpro_otel.ep);
+    }
+}
+
+bool quicpro_otel_active(void)
+{
+    return quicpro_otel.running || quicpro_otel.forked;
+}
+
+/*──────────────────────────── Spans ──────────────────────────────────────*/
+
+bool quicpro_otel_span_start(quicpro_otel_span_t *span, const char *name, quicpro_otel_kind_t kind,
+                             const quicpro_otel_context_t *parent)
+{
+    if (UNEXPECTED(quicpro_otel.forked && !quicpro_otel.running) && !quicpro_otel_spawn()) {
+        quicpro_otel.forked = false;    /* Untraced rather than retried on every span */
+    }
+
+    span->kind = (uint8_t)kind;
+    span->nattrs = 0;
+    span->error = false;
+
+    uint64_t id = quicpro_otel_rand();
+    memcpy(span->ctx.span_id, &id, sizeof(id));
+    if (parent) {
+        memcpy(span->ctx.trace_id, parent->trace_id, sizeof(span->ctx.trace_id));
+        memcpy(span->parent_span_id, parent->span_id, sizeof(span->parent_span_id));
+        span->has_parent = true;
+    } else {
+        uint64_t hi = quicpro_otel_rand(), lo = quicpro_otel_rand();
+        memcpy(span->ctx.trace_id, &hi, sizeof(hi));
+        memcpy(span->ctx.trace_id + 8, &lo, sizeof(lo));
+        span->has_parent = false;
+    }
+
+    if (!quicpro_otel.running) {
+        span->ctx.sampled = false;
+    } else if (quicpro_otel.sampler != QP_OTEL_SAMPLE_PARENT_RATIO) {
+        span->ctx.sampled = quicpro_otel.sampler == QP_OTEL_SAMPLE_ON;
+    } else if (parent) {
+        span->ctx.sampled = parent->sampled;
+    } else {
+        uint64_t draw;
+        memcpy(&draw, span->ctx.trace_id + 8, sizeof(draw));
+        span->ctx.sampled = quicpro_otel.ratio_bound == UINT64_MAX || draw < quicpro_otel.ratio_bound;
+    }
+    if (!span->ctx.sampled) {
+        return false;
+    }
+
+    size_t len = strnlen(name, sizeof(span->name) - 1);
+    memcpy(span->name, name, len);
+    span->name[len] = '\0';
+    span->start_ns = quicpro_otel_now_ns();
+    return true;
+}
+
+static inline quicpro_otel_attr_t *quicpro_otel_attr_slot(quicpro_otel_span_t *span, const char *key, uint8_t type)
+{
+    if (!span->ctx.sampled || span->nattrs >= quicpro_otel.max_attrs) {
+        return NULL;
+    }
+    quicpro_otel_attr_t *a = &span->attrs[span->nattrs++];
+    a->key = key;
+    a->type = type;
+    return a;
+}
+
+void quicpro_otel_span_attr_int(quicpro_otel_span_t *span, const char *key, int64_t value)
+{
+    quicpro_otel_attr_t *a = quicpro_otel_attr_slot(span, key, QUICPRO_OTEL_ATTR_INT);
+    if (a) a->v.i = value;
+}
+
+void quicpro_otel_span_attr_double(quicpro_otel_span_t *span, const char *key, double value)
+{
+    quicpro_otel_attr_t *a = quicpro_otel_attr_slot(span, key, QUICPRO_OTEL_ATTR_DOUBLE);
+    if (a) a->v.d = value;
+}
+
+void quicpro_otel_span_attr_bool(quicpro_otel_span_t *span, const char *key, bool value)
+{
+    quicpro_otel_attr_t *a = quicpro_otel_attr_slot(span, key, QUICPRO_OTEL_ATTR_BOOL);
+    if (a) a->v.b = value;
+}
+
+void quicpro_otel_span_attr_str(quicpro_otel_span_t *span, const char *key, const char *value, size_t len)
+{
+    quicpro_otel_attr_t *a = quicpro_otel_attr_slot(span, key, QUICPRO_OTEL_ATTR_STR);
+    if (a) {
+        if (len > sizeof(a->v.s) - 1) {
+            len = sizeof(a->v.s) - 1;
+        }
+        memcpy(a->v.s, value, len);
+        a->v.s[len] = '\0';
+    }
+}
+
+void quicpro_otel_span_end(quicpro_otel_span_t *span)
+{
+    if (!span->ctx.sampled || !quicpro_otel.running) {
+        return;
+    }
+    span->end_ns = quicpro_otel_now_ns();
+
+    uint64_t head = atomic_load_explicit(&quicpro_otel.head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&quicpro_otel.tail, memory_order_acquire);
+    if (head - tail > quicpro_otel.mask) {
+        atomic_fetch_add_explicit(&quicpro_otel.dropped, 1, memory_order_relaxed);
+        return;
+    }
+    /* Attributes past nattrs are never read */
+    memcpy(&quicpro_otel.slots[head & quicpro_otel.mask], span,
+           offsetof(quicpro_otel_span_t, attrs) + span->nattrs * sizeof(quicpro_otel_attr_t));
+    atomic_store_explicit(&quicpro_otel.head, head + 1, memory_order_release);
+
+    if (head + 1 - tail == quicpro_otel.batch) {
+        uint64_t one = 1;
+        (void)!write(quicpro_otel.wake_fd, &one, sizeof(one));
+    }
+}
+
+void quicpro_otel_span_quic(quicpro_otel_span_t *span, quiche_conn *conn)
+{
+    if (!span->ctx.sampled || !conn) {
+        return;
+    }
+    quiche_stats stats;
+    quiche_path_stats path;
+    quiche_conn_stats(conn, &stats);
+    if (quiche_conn_path_stats(conn, 0, &path) == 0) {
+        quicpro_otel_span_attr_int(span, "quic.rtt_us", (int64_t)(path.rtt / 1000));
+        quicpro_otel_span_attr_int(span, "quic.cwnd", (int64_t)path.cwnd);
+    }
+    quicpro_otel_span_attr_int(span, "quic.lost", (int64_t)stats.lost);
+    quicpro_otel_span_attr_int(span, "quic.retransmits", (int64_t)stats.retrans);
+}
+
+/*──────────────────────────── Propagation ────────────────────────────────*/
+
+static const char quicpro_otel_hex[] = "0123456789abcdef";
+
+static char *quicpro_otel_hex_put(char *out, const uint8_t *in, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        *out++ = quicpro_otel_hex[in[i] >> 4];
+        *out++ = quicpro_otel_hex[in[i] & 0xf];
+    }
+    return out;
+}
+
+/* One byte of lower-case hex, as W3C Trace Context requires; -1 on anything else */
+static int quicpro_otel_hex_byte(const char *in)
+{
+    int v = 0;
+    for (int j = 0; j < 2; j++) {
+        char c = in[j];
+        if (c >= '0' && c <= '9') v = v << 4 | (c - '0');
+        else if (c >= 'a' && c <= 'f') v = v << 4 | (c - 'a' + 10);
+        else return -1;
+    }
+    return v;
+}
+
+/* False on a malformed or all-zero ID */
+static bool quicpro_otel_hex_id(uint8_t *out, const char *in, size_t len)
+{
+    uint8_t any = 0;
+    for (size_t i = 0; i < len; i++) {
+        int v = quicpro_otel_hex_byte(in + 2 * i);
+        if (v < 0) {
+            return false;
+        }
+        out[i] = (uint8_t)v;
+        any |= out[i];
+    }
+    return any != 0;
+}
+
+void quicpro_otel_traceparent_format(const quicpro_otel_context_t *ctx, char out[QUICPRO_OTEL_TRACEPARENT_LEN + 1])
+{
+    char *p = out;
+    *p++ = '0';
+    *p++ = '0';
+    *p++ = '-';
+    p = quicpro_otel_hex_put(p, ctx->trace_id, sizeof(ctx->trace_id));
+    *p++ = '-';
+    p = quicpro_otel_hex_put(p, ctx->span_id, sizeof(ctx->span_id));
+    *p++ = '-';
+    *p++ = '0';
+    *p++ = ctx->sampled ? '1' : '0';
+    *p = '\0';
+}
+
+bool quicpro_otel_traceparent_parse(const char *value, size_t len, quicpro_otel_context_t *out)
+{
+    while (len > 0 && (*value == ' ' || *value == '\t')) {
+        value++;
+        len--;
+    }
+    while (len > 0 && (value[len - 1] == ' ' || value[len - 1] == '\t')) {
+        len--;
+    }
+    if (len < QUICPRO_OTEL_TRACEPARENT_LEN || value[2] != '-' || value[35] != '-' || value[52] != '-') {
+        return false;
+    }
+    /* Version 00 is exactly this long; a later one may append fields. Version ff is invalid. */
+    int version = quicpro_otel_hex_byte(value);
+    int flags = quicpro_otel_hex_byte(value + 53);
+    if (version < 0 || version == 0xff || flags < 0
+        || (len > QUICPRO_OTEL_TRACEPARENT_LEN && (version == 0 || value[55] != '-'))) {
+        return false;
+    }
+    if (!quicpro_otel_hex_id(out->trace_id, value + 3, sizeof(out->trace_id))
+        || !quicpro_otel_hex_id(out->span_id, value + 36, sizeof(out->span_id))) {
+        return false;
+    }
+    out->sampled = flags & 1;
+    return true;
+}
+
+const quicpro_otel_context_t *quicpro_otel_current(void)
+{
+    return quicpro_otel_ctx_set ? &quicpro_otel_ctx_current : NULL;
+}
+
+bool quicpro_otel_scope_open(quicpro_otel_scope_t *scope, const char *name, quicpro_otel_kind_t kind,
+                             const quicpro_otel_context_t *parent)
+{
+    if (!parent) {
+        parent = quicpro_otel_current();
+    }
+    if (!parent && !quicpro_otel.running && !quicpro_otel.forked) {
+        scope->span.ctx.sampled = false;
+        scope->entered = false;
+        return false;
+    }
+    bool sampled = quicpro_otel_span_start(&scope->span, name, kind, parent);
+    scope->entered = sampled || parent;
+    if (scope->entered) {
+        scope->had_outer = quicpro_otel_ctx_set;
+        scope->outer = quicpro_otel_ctx_current;
+        quicpro_otel_ctx_current = scope->span.ctx;
+        quicpro_otel_ctx_set = true;
+    }
+    return sampled;
+}
+
+void quicpro_otel_scope_close(quicpro_otel_scope_t *scope)
+{
+    if (scope->entered) {
+        quicpro_otel_ctx_current = scope->outer;
+        quicpro_otel_ctx_set = scope->had_outer;
+        scope->entered = false;
+    }
+    quicpro_otel_span_end(&scope->span);
+}
+
+/*──────────────────────────── PHP API ────────────────────────────────────*/
+
+PHP_FUNCTION(quicpro_server_init_telemetry)
+{
+    zval *config = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(0, 1)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_ARRAY_OR_NULL(config)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (config && qp_config_open_telemetry_apply_userland_config(config) != SUCCESS) {
+        RETURN_FALSE;
+    }
+    RETURN_BOOL(quicpro_otel_start());
+}
+
+PHP_FUNCTION(quicpro_server_telemetry_stats)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    uint64_t head = atomic_load_explicit(&quicpro_otel.head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&quicpro_otel.tail, memory_order_relaxed);
+    array_init(return_value);
+    add_assoc_long(return_value, "spans_exported", (zend_long)atomic_load_explicit(&quicpro_otel.exported, memory_order_relaxed));
+    add_assoc_long(return_value, "spans_dropped", (zend_long)atomic_load_explicit(&quicpro_otel.dropped, memory_order_relaxed));
+    add_assoc_long(return_value, "exports_failed", (zend_long)atomic_load_explicit(&quicpro_otel.failed, memory_order_relaxed));
+    add_assoc_long(return_value, "queued", (zend_long)(head - tail));
+}
@@ -0,0 +1,259 @@
+/*
+ * src/server/otlp.c – OTLP request encoding and transport
+ * =======================================================
+ *
+ * See include/server/otlp.h. A nested message is written with room for a
+ * 5-byte length; close() moves the contents down once their size is known.
+ * The messages are small and close() runs once per nested message, so the
+ * memmove is cheaper than sizing every message twice.
+ */
+
+#include "php_quicpro.h"
+#include "server/otlp.h"
+#include "config/open_telemetry/base_layer.h"
+
+#include <string.h>
+#include <strings.h>
+
+/*──────────────────────────── Protobuf writer ────────────────────────────*/
+
+void quicpro_otlp_reserve(quicpro_otlp_buf_t *b, size_t n)
+{
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap < b->len + n) {
+            cap *= 2;
+        }
+        b->p = perealloc(b->p, cap, 1);
+        b->cap = cap;
+    }
+}
+
+static size_t quicpro_otlp_varint_into(uint8_t *out, uint64_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+void quicpro_otlp_varint(quicpro_otlp_buf_t *b, uint64_t v)
+{
+    quicpro_otlp_reserve(b, 10);
+    b->len += quicpro_otlp_varint_into(b->p + b->len, v);
+}
+
+void quicpro_otlp_tag(quicpro_otlp_buf_t *b, unsigned field, unsigned wire)
+{
+    quicpro_otlp_varint(b, (uint64_t)field << 3 | wire);
+}
+
+void quicpro_otlp_bytes(quicpro_otlp_buf_t *b, unsigned field, const void *data, size_t len)
+{
+    quicpro_otlp_tag(b, field, 2);
+    quicpro_otlp_varint(b, len);
+    quicpro_otlp_reserve(b, len);
+    memcpy(b->p + b->len, data, len);
+    b->len += len;
+}
+
+void quicpro_otlp_raw64(quicpro_otlp_buf_t *b, uint64_t v)
+{
+    quicpro_otlp_reserve(b, 8);
+    for (int i = 0; i < 8; i++) {
+        b->p[b->len++] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+void quicpro_otlp_fixed64(quicpro_otlp_buf_t *b, unsigned field, uint64_t v)
+{
+    quicpro_otlp_tag(b, field, 1);
+    quicpro_otlp_raw64(b, v);
+}
+
+void quicpro_otlp_double(quicpro_otlp_buf_t *b, unsigned field, double v)
+{
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    quicpro_otlp_fixed64(b, field, bits);
+}
+
+size_t quicpro_otlp_open(quicpro_otlp_buf_t *b, unsigned field)
+{
+    quicpro_otlp_tag(b, field, 2);
+    quicpro_otlp_reserve(b, 5);
+    size_t mark = b->len;
+    b->len += 5;
+    return mark;
+}
+
+void quicpro_otlp_close(quicpro_otlp_buf_t *b, size_t mark)
+{
+    uint8_t len[10];
+    size_t body = b->len - mark - 5;
+    size_t n = quicpro_otlp_varint_into(len, body);
+    memmove(b->p + mark + n, b->p + mark + 5, body);
+    memcpy(b->p + mark, len, n);
+    b->len = mark + n + body;
+}
+
+void quicpro_otlp_kv_str(quicpro_otlp_buf_t *b, unsigned field, const char *key, const char *value)
+{
+    size_t kv = quicpro_otlp_open(b, field);
+    quicpro_otlp_bytes(b, 1, key, strlen(key));
+    size_t any = quicpro_otlp_open(b, 2);
+    quicpro_otlp_bytes(b, 1, value, strlen(value));
+    quicpro_otlp_close(b, any);
+    quicpro_otlp_close(b, kv);
+}
+
+/*──────────────────────────── Endpoint ───────────────────────────────────*/
+
+/* Joins "k1=v1,k2=v2" into curl's "k1: v1" list */
+static struct curl_slist *quicpro_otlp_header_list(const char *spec, bool grpc)
+{
+    struct curl_slist *list = NULL;
+    list = curl_slist_append(list, grpc ? "Content-Type: application/grpc" : "Content-Type: application/x-protobuf");
+    if (grpc) {
+        list = curl_slist_append(list, "TE: trailers");
+    }
+    list = curl_slist_append(list, "Expect:");
+
+    for (const char *p = spec ? spec : ""; *p; ) {
+        const char *end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        const char *eq = memchr(p, '=', len);
+        if (eq && eq > p) {
+            char line[512];
+            int n = snprintf(line, sizeof(line), "%.*s: %.*s", (int)(eq - p), p, (int)(len - (size_t)(eq - p) - 1), eq + 1);
+            if (n > 0 && (size_t)n < sizeof(line)) {
+                list = curl_slist_append(list, line);
+            }
+        }
+        p += len;
+        if (*p == ',') p++;
+    }
+    return list;
+}
+
+static char *quicpro_otlp_url(const char *endpoint, bool grpc, quicpro_otlp_signal_t signal)
+{
+    const char *suffix = signal == QUICPRO_OTLP_METRICS
+        ? (grpc ? "/opentelemetry.proto.collector.metrics.v1.MetricsService/Export" : "/v1/metrics")
+        : (grpc ? "/opentelemetry.proto.collector.trace.v1.TraceService/Export" : "/v1/traces");
+    size_t len = strlen(endpoint);
+    if (!grpc && len >= strlen(suffix) && strcmp(endpoint + len - strlen(suffix), suffix) == 0) {
+        return pestrdup(endpoint, 1);
+    }
+    while (len > 0 && endpoint[len - 1] == '/') {
+        len--;
+    }
+    char *url = pemalloc(len + strlen(suffix) + 1, 1);
+    memcpy(url, endpoint, len);
+    strcpy(url + len, suffix);
+    return url;
+}
+
+bool quicpro_otlp_endpoint_init(quicpro_otlp_endpoint_t *ep, quicpro_otlp_signal_t signal)
+{
+    const char *endpoint = quicpro_open_telemetry_config.exporter_endpoint;
+    memset(ep, 0, sizeof(*ep));
+    if (!endpoint || !*endpoint || curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+        return false;
+    }
+    const char *protocol = quicpro_open_telemetry_config.exporter_protocol;
+    ep->grpc = !protocol || strcasecmp(protocol, "grpc") == 0;
+    ep->url = quicpro_otlp_url(endpoint, ep->grpc, signal);
+    ep->service_name = pestrdup(quicpro_open_telemetry_config.service_name ? quicpro_open_telemetry_config.service_name : "", 1);
+    ep->headers = quicpro_otlp_header_list(quicpro_open_telemetry_config.exporter_headers, ep->grpc);
+    ep->timeout_ms = (long)quicpro_open_telemetry_config.exporter_timeout_ms;
+    return true;
+}
+
+void quicpro_otlp_endpoint_free(quicpro_otlp_endpoint_t *ep)
+{
+    if (!ep->url) {
+        return;
+    }
+    pefree(ep->url, 1);
+    pefree(ep->service_name, 1);
+    curl_slist_free_all(ep->headers);
+    memset(ep, 0, sizeof(*ep));
+    curl_global_cleanup();
+}
+
+/*──────────────────────────── Transport ──────────────────────────────────*/
+
+void quicpro_otlp_begin(const quicpro_otlp_endpoint_t *ep, quicpro_otlp_buf_t *b)
+{
+    b->len = ep->grpc ? QUICPRO_OTLP_GRPC_PREFIX : 0;
+    quicpro_otlp_reserve(b, b->len);
+}
+
+static size_t quicpro_otlp_discard(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    (void)ptr;
+    (void)userdata;
+    return size * nmemb;
+}
+
+/* gRPC reports failure in the grpc-status header or trailer, behind a 200 */
+static size_t quicpro_otlp_grpc_header(char *line, size_t size, size_t nmemb, void *userdata)
+{
+    size_t len = size * nmemb;
+    if (len > 12 && strncasecmp(line, "grpc-status:", 12) == 0) {
+        const char *v = line + 12;
+        while (*v == ' ') v++;
+        *(bool *)userdata = *v == '0';
+    }
+    return len;
+}
+
+CURL *quicpro_otlp_connect(const quicpro_otlp_endpoint_t *ep)
+{
+    CURL *curl = curl_easy_init();
+    if (!curl) {
+        return NULL;
+    }
+    curl_easy_setopt(curl, CURLOPT_URL, ep->url);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, ep->headers);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, ep->timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, quicpro_otlp_discard);
+    if (ep->grpc) {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION,
+                         strncasecmp(ep->url, "https:", 6) == 0 ? CURL_HTTP_VERSION_2TLS
+                                                                : CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, quicpro_otlp_grpc_header);
+    }
+    return curl;
+}
+
+bool quicpro_otlp_send(CURL *curl, const quicpro_otlp_endpoint_t *ep, quicpro_otlp_buf_t *b)
+{
+    if (ep->grpc) {
+        uint32_t len = (uint32_t)(b->len - QUICPRO_OTLP_GRPC_PREFIX);
+        b->p[0] = 0;
+        b->p[1] = (uint8_t)(len >> 24);
+        b->p[2] = (uint8_t)(len >> 16);
+        b->p[3] = (uint8_t)(len >> 8);
+        b->p[4] = (uint8_t)len;
+    }
+
+    bool grpc_ok = true;
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, (const char *)b->p);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)b->len);
+    if (ep->grpc) {
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &grpc_ok);
+    }
+    long status = 0;
+    if (curl_easy_perform(curl) != CURLE_OK) {
+        return false;
+    }
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    return status >= 200 && status < 300 && grpc_ok;
+}
@@ -0,0 +1,121 @@
+/*
+ * overload.c  –  CoDel admission for the php-quicpro listeners
+ * ------------------------------------------------------------
+ *
+ * State is per worker (see include/server/overload.h):
+ *
+ *   above_until_us   0 while the last sojourn was under the target;
+ *                    otherwise when a standing queue counts as overload
+ *   overloaded_us    when the overload began, 0: none
+ *
+ * As in CoDel, one sojourn under the target proves that the queue drained
+ * and resets both. Shed requests are measured too: their sojourn says
+ * as much about the queue as an admitted one's.
+ */
+
+#include "php_quicpro.h"
+#include "server/overload.h"
+#include "server/priority.h"
+#include "server/metrics.h"
+#include "config/security_and_traffic/base_layer.h"
+
+#define QP_OL_IDLE_US 1000  /* A wait this short did not drain the socket: input arrived during the last round */
+
+static ZEND_TLS struct {
+    uint64_t wait_us;           /* When the loop began to wait, 0: not waiting */
+    uint64_t round_us;          /* When the current round began */
+    uint64_t arrival_us;        /* Its input arrived this late at the latest */
+    uint64_t above_until_us;
+    uint64_t overloaded_us;
+} qp_ol;
+
+bool quicpro_overload_enabled(void)
+{
+    return quicpro_security_config.overload_shedding_enable;
+}
+
+quicpro_overload_class_t quicpro_overload_classify(const char *priority, size_t priority_len, bool websocket)
+{
+    quicpro_priority_t prio = QUICPRO_PRIORITY_DEFAULT;
+    if (priority) {
+        quicpro_priority_parse(priority, priority_len, &prio);
+    }
+    if (prio.urgency <= QUICPRO_PRIORITY_CRITICAL_CONTROL) {
+        return QUICPRO_OVERLOAD_CRITICAL;
+    }
+    if (websocket || prio.urgency >= QUICPRO_PRIORITY_LOW_WS) {
+        return QUICPRO_OVERLOAD_LOW;
+    }
+    return QUICPRO_OVERLOAD_NORMAL;
+}
+
+void quicpro_overload_wait_begin(void)
+{
+    if (quicpro_overload_enabled()) {
+        qp_ol.wait_us = quicpro_metrics_now_us();
+    }
+}
+
+void quicpro_overload_wait_end(void)
+{
+    if (!quicpro_overload_enabled()) {
+        return;
+    }
+    uint64_t now = quicpro_metrics_now_us();
+    bool waited = qp_ol.wait_us && now - qp_ol.wait_us >= QP_OL_IDLE_US;
+    qp_ol.arrival_us = waited || !qp_ol.round_us ? now : qp_ol.round_us;
+    qp_ol.round_us = now;
+    qp_ol.wait_us = 0;
+}
+
+uint64_t quicpro_overload_round_arrival_us(void)
+{
+    return qp_ol.arrival_us ? qp_ol.arrival_us : quicpro_metrics_now_us();
+}
+
+uint64_t quicpro_overload_rx_arrival_us(const struct timespec *rx_ts)
+{
+    if (!rx_ts || !rx_ts->tv_sec) {
+        return quicpro_overload_round_arrival_us();
+    }
+    struct timespec real;
+    clock_gettime(CLOCK_REALTIME, &real);
+    int64_t ago_us = ((int64_t)real.tv_sec - (int64_t)rx_ts->tv_sec) * 1000000
+                   + ((int64_t)real.tv_nsec - (int64_t)rx_ts->tv_nsec) / 1000;
+    uint64_t now = quicpro_metrics_now_us();
+    return ago_us > 0 && (uint64_t)ago_us < now ? now - (uint64_t)ago_us : now;
+}
+
+bool quicpro_overload_admit(quicpro_overload_class_t cls, uint64_t arrived_us)
+{
+    if (!quicpro_overload_enabled()) {
+        return true;
+    }
+    uint64_t now = quicpro_metrics_now_us();
+    uint64_t sojourn = now > arrived_us ? now - arrived_us : 0;
+    uint64_t target = (uint64_t)quicpro_security_config.overload_target_ms * 1000;
+    uint64_t interval = (uint64_t)quicpro_security_config.overload_interval_ms * 1000;
+    quicpro_metrics_observe(QUICPRO_METRIC_QUEUE_DELAY, sojourn);
+
+    if (sojourn < target) {
+        qp_ol.above_until_us = 0;
+        qp_ol.overloaded_us = 0;
+    } else if (!qp_ol.above_until_us) {
+        qp_ol.above_until_us = now + interval;
+    } else if (now >= qp_ol.above_until_us && !qp_ol.overloaded_us) {
+        qp_ol.overloaded_us = now;
+    }
+
+    bool shed;
+    if (!qp_ol.overloaded_us || cls == QUICPRO_OVERLOAD_CRITICAL) {
+        shed = false;
+    } else if (cls == QUICPRO_OVERLOAD_LOW) {
+        shed = true;
+    } else {
+        shed = now - qp_ol.overloaded_us >= interval;
+    }
+    if (shed) {
+        quicpro_metrics_add(QUICPRO_METRIC_REQUESTS_SHED, 1);
+    }
+    return !shed;
+}
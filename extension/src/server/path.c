@@ -0,0 +1,80 @@
+/*
+ * path.c  –  Path events and path-aware sending for php-quicpro listeners
+ * -----------------------------------------------------------------------
+ *
+ * Server-side migration handling:
+ *
+ *   NEW               probe the path (PATH_CHALLENGE) so it can be
+ *                     validated before the client commits to it
+ *   VALIDATED         count it; still unused until the peer migrates
+ *   PEER_MIGRATED     the peer sends non-probing packets on a validated
+ *                     path: that path's peer becomes `peer_addr`
+ *   FAILED/CLOSED     nothing to do; quiche keeps using the old path
+ */
+
+#include "php_quicpro.h"
+#include "server/path.h"
+#include "server/router.h"
+#include "server/capture.h"
+#include "config/quic_transport/base_layer.h"
+
+#include <string.h>
+
+void quicpro_server_path_events(quicpro_session_t *s)
+{
+    quiche_path_event *ev;
+
+    while ((ev = quiche_conn_path_event_next(s->conn)) != NULL) {
+        struct sockaddr_storage local, peer;
+        socklen_t local_len = sizeof(local);
+        socklen_t peer_len = sizeof(peer);
+        uint64_t seq;
+
+        switch (quiche_path_event_type(ev)) {
+            case QUICHE_PATH_EVENT_NEW:
+                quiche_path_event_new(ev, &local, &local_len, &peer, &peer_len);
+                /* Fails harmlessly when the client left us no spare DCID */
+                quiche_conn_probe_path(s->conn, (struct sockaddr *)&local, local_len,
+                                       (struct sockaddr *)&peer, peer_len, &seq);
+                break;
+
+            case QUICHE_PATH_EVENT_VALIDATED:
+                s->paths_validated++;
+                break;
+
+            case QUICHE_PATH_EVENT_PEER_MIGRATED:
+                quiche_path_event_peer_migrated(ev, &local, &local_len, &peer, &peer_len);
+                memcpy(&s->peer_addr, &peer, peer_len);
+                s->peer_addr_len = peer_len;
+                s->migrations++;
+                break;
+
+            default:
+                break;
+        }
+        quiche_path_event_free(ev);
+    }
+}
+
+void quicpro_server_path_flush(quicpro_session_t *s, int fd)
+{
+    /* Up to the largest datagram DPLPMTUD may reach, behind a router header.
+     * One per thread: the listener's I/O thread flushes too (server/io_thread.h). */
+    static _Thread_local uint8_t out[QUICPRO_UDP_PAYLOAD_MAX + QUICPRO_ROUTER_ENCAP_LEN];
+    quiche_send_info si;
+    /* Through a router, every packet goes to it behind a header naming the peer */
+    size_t head = s->relay_addr_len ? QUICPRO_ROUTER_ENCAP_LEN : 0;
+
+    for (;;) {
+        ssize_t sent = quiche_conn_send(s->conn, out + head, sizeof(out) - head, &si);
+        if (sent < 0) {
+            break;   /* QUICHE_ERR_DONE or a fatal error */
+        }
+        quicpro_capture_tx(s, (struct sockaddr *)&si.to, out + head, (size_t)sent);
+        if (!head) {
+            sendto(fd, out, (size_t)sent, 0, (struct sockaddr *)&si.to, si.to_len);
+        } else if (quicpro_router_wrap(out, (struct sockaddr *)&si.to, si.to_len)) {
+            sendto(fd, out, (size_t)sent + head, 0, (struct sockaddr *)&s->relay_addr, s->relay_addr_len);
+        }
+    }
+}
@@ -0,0 +1,253 @@
+/*
+ * src/server/priority.c – RFC 9218 Extensible Priorities
+ * ======================================================
+ *
+ * See include/server/priority.h. The field parser follows RFC 8941's
+ * dictionary grammar far enough to skip what it does not use: string,
+ * token, byte sequence and decimal values, inner lists and parameters
+ * are stepped over, not decoded.
+ */
+
+#include "php_quicpro.h"
+#include "server/priority.h"
+#include "client/session.h"
+
+#include <zend_exceptions.h>
+#include <string.h>
+
+extern int le_quicpro_session;
+
+/*──── Field values ────*/
+
+static bool prio_is_lcalpha(char c) { return c >= 'a' && c <= 'z'; }
+static bool prio_is_digit(char c)   { return c >= '0' && c <= '9'; }
+
+static const char *prio_skip_ows(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+static const char *prio_skip_sp(const char *p, const char *end) {
+    while (p < end && *p == ' ') p++;
+    return p;
+}
+
+/* A key ("u", "i", ...) at `p`; NULL if there is none */
+static const char *prio_key(const char *p, const char *end) {
+    if (p == end || !(prio_is_lcalpha(*p) || *p == '*')) {
+        return NULL;
+    }
+    for (p++; p < end && (prio_is_lcalpha(*p) || prio_is_digit(*p) || *p == '_' || *p == '-' || *p == '.' || *p == '*'); p++);
+    return p;
+}
+
+/* 0 or 1 for a boolean, the value for an integer, -1 for any other bare item; NULL if malformed */
+static const char *prio_bare_item(const char *p, const char *end, int64_t *num, bool *is_bool, bool *is_int) {
+    *is_bool = *is_int = false;
+    if (p == end) {
+        return NULL;
+    }
+    if (*p == '?') {
+        if (end - p < 2 || (p[1] != '0' && p[1] != '1')) return NULL;
+        *is_bool = true;
+        *num = p[1] == '1';
+        return p + 2;
+    }
+    if (*p == '-' || prio_is_digit(*p)) {
+        bool neg = *p == '-';
+        const char *q = p + neg, *digits = q;
+        int64_t v = 0;
+        for (; q < end && prio_is_digit(*q) && q - digits < 15; q++) v = v * 10 + (*q - '0');
+        if (q == digits) return NULL;
+        if (q < end && *q == '.') {
+            for (q++; q < end && prio_is_digit(*q); q++);   /* A decimal: never a valid u */
+            *num = -1;
+            return q;
+        }
+        if (q < end && prio_is_digit(*q)) return NULL;     /* More than 15 digits */
+        *is_int = true;
+        *num = neg ? -v : v;
+        return q;
+    }
+    if (*p == '"') {
+        for (p++; p < end && *p != '"'; p++) {
+            if (*p == '\\' && ++p == end) return NULL;
+        }
+        return p < end ? p + 1 : NULL;
+    }
+    if (*p == ':') {
+        const char *close = memchr(p + 1, ':', end - p - 1);
+        return close ? close + 1 : NULL;
+    }
+    if ((*p >= 'A' && *p <= 'Z') || prio_is_lcalpha(*p) || *p == '*') {
+        for (p++; p < end && (unsigned char)*p > 0x20 && (unsigned char)*p < 0x7f
+                  && !strchr("\"(),;=[]{}\\ ", *p); p++);
+        return p;
+    }
+    return NULL;
+}
+
+/* Steps over ";key[=item]" parameters; NULL stays NULL */
+static const char *prio_skip_params(const char *p, const char *end) {
+    while (p && p < end && *p == ';') {
+        p = prio_key(prio_skip_sp(p + 1, end), end);
+        if (!p) return NULL;
+        if (p < end && *p == '=') {
+            int64_t num;
+            bool is_bool, is_int;
+            p = prio_bare_item(p + 1, end, &num, &is_bool, &is_int);
+            if (!p) return NULL;
+        }
+    }
+    return p;
+}
+
+/* A member's value: a bare item, or an inner list, which carries nothing RFC 9218 uses */
+static const char *prio_item_or_list(const char *p, const char *end, int64_t *num, bool *is_bool, bool *is_int) {
+    if (p == end || *p != '(') {
+        return prio_bare_item(p, end, num, is_bool, is_int);
+    }
+    *is_bool = *is_int = false;
+    p = prio_skip_sp(p + 1, end);
+    while (p < end && *p != ')') {
+        p = prio_skip_params(prio_bare_item(p, end, num, is_bool, is_int), end);
+        if (!p) return NULL;
+        if (p < end && *p != ' ' && *p != ')') return NULL;
+        p = prio_skip_sp(p, end);
+    }
+    *is_bool = *is_int = false;
+    return p < end ? p + 1 : NULL;
+}
+
+bool quicpro_priority_parse(const char *value, size_t len, quicpro_priority_t *prio) {
+    const char *p = value, *end = value + len;
+    quicpro_priority_t out = *prio;
+
+    p = prio_skip_sp(p, end);
+    while (p < end) {
+        const char *key = p;
+        p = prio_key(p, end);
+        if (!p) return false;
+        size_t key_len = (size_t)(p - key);
+
+        int64_t num = 1;
+        bool is_bool = true, is_int = false;
+        if (p < end && *p == '=') {
+            p = prio_item_or_list(p + 1, end, &num, &is_bool, &is_int);
+            if (!p) return false;
+        }
+        p = prio_skip_params(p, end);
+        if (!p) return false;
+
+        /* A later member of the same name replaces an earlier one */
+        if (key_len == 1 && key[0] == 'u' && is_int && num >= 0 && num <= QUICPRO_PRIORITY_URGENCY_MAX) {
+            out.urgency = (uint8_t)num;
+        } else if (key_len == 1 && key[0] == 'i' && is_bool) {
+            out.incremental = num != 0;
+        }
+
+        p = prio_skip_ows(p, end);
+        if (p == end) break;
+        if (*p != ',') return false;
+        p = prio_skip_ows(p + 1, end);
+        if (p == end) return false;     /* A trailing comma */
+    }
+    *prio = out;
+    return true;
+}
+
+size_t quicpro_priority_format(quicpro_priority_t prio, char out[QUICPRO_PRIORITY_VALUE_MAX]) {
+    out[0] = 'u';
+    out[1] = '=';
+    out[2] = (char)('0' + MIN(prio.urgency, QUICPRO_PRIORITY_URGENCY_MAX));
+    if (!prio.incremental) {
+        return 3;
+    }
+    memcpy(out + 3, ", i", 3);
+    return 6;
+}
+
+bool quicpro_priority_from_zval(zval *zv, quicpro_priority_t *prio) {
+    ZVAL_DEREF(zv);
+    switch (Z_TYPE_P(zv)) {
+        case IS_STRING:
+            if (!quicpro_priority_parse(Z_STRVAL_P(zv), Z_STRLEN_P(zv), prio)) {
+                zend_value_error("Priority \"%s\" is not an RFC 9218 priority field value", Z_STRVAL_P(zv));
+                return false;
+            }
+            return true;
+        case IS_LONG:
+            if (Z_LVAL_P(zv) < 0 || Z_LVAL_P(zv) > QUICPRO_PRIORITY_URGENCY_MAX) {
+                zend_value_error("Priority urgency must be between 0 and %d", QUICPRO_PRIORITY_URGENCY_MAX);
+                return false;
+            }
+            prio->urgency = (uint8_t)Z_LVAL_P(zv);
+            return true;
+        case IS_ARRAY: {
+            zval *u = zend_hash_str_find(Z_ARRVAL_P(zv), "urgency", sizeof("urgency") - 1);
+            zval *i = zend_hash_str_find(Z_ARRVAL_P(zv), "incremental", sizeof("incremental") - 1);
+            if (u && !quicpro_priority_from_zval(u, prio)) {
+                return false;
+            }
+            if (i) {
+                prio->incremental = zend_is_true(i);
+            }
+            return true;
+        }
+        default:
+            zend_type_error("Priority must be of type string, int or array, %s given", zend_zval_type_name(zv));
+            return false;
+    }
+}
+
+/*──── Transport ────*/
+
+bool quicpro_priority_apply_quic(quiche_conn *conn, uint64_t stream_id, quicpro_priority_t prio) {
+    return quiche_conn_stream_priority(conn, stream_id, prio.urgency, prio.incremental) == 0;
+}
+
+static int prio_on_update(uint8_t *value, uint64_t len, void *argp) {
+    quicpro_priority_t *prio = (quicpro_priority_t *)argp;
+    *prio = QUICPRO_PRIORITY_DEFAULT;
+    quicpro_priority_parse((const char *)value, (size_t)len, prio);
+    return 0;
+}
+
+bool quicpro_priority_take_update(quiche_h3_conn *h3, uint64_t stream_id, quicpro_priority_t *prio) {
+    quicpro_priority_t update;
+    if (quiche_h3_take_last_priority_update(h3, stream_id, prio_on_update, &update) != 0) {
+        return false;
+    }
+    *prio = update;
+    return true;
+}
+
+/*──── PHP ────*/
+
+PHP_FUNCTION(quicpro_stream_set_priority)
+{
+    zval *z_session_res, *z_priority;
+    zend_long stream_id;
+
+    ZEND_PARSE_PARAMETERS_START(3, 3)
+        Z_PARAM_RESOURCE(z_session_res)
+        Z_PARAM_LONG(stream_id)
+        Z_PARAM_ZVAL(z_priority)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = (quicpro_session_t *)zend_fetch_resource_ex(z_session_res, "Quicpro Session", le_quicpro_session);
+    if (!s || !s->conn) {
+        zend_value_error("Invalid or closed session resource");
+        RETURN_THROWS();
+    }
+    if (stream_id < 0) {
+        zend_argument_value_error(2, "must be a stream ID");
+        RETURN_THROWS();
+    }
+    quicpro_priority_t prio = QUICPRO_PRIORITY_DEFAULT;
+    if (!quicpro_priority_from_zval(z_priority, &prio)) {
+        RETURN_THROWS();
+    }
+    /* Fails only for a stream that is gone, or was never opened */
+    RETURN_BOOL(quicpro_priority_apply_quic(s->conn, (uint64_t)stream_id, prio));
+}
@@ -0,0 +1,323 @@
+/*
+ * src/server/profiler.c – Always-available hot path profiler
+ * ==========================================================
+ *
+ * See include/server/profiler.h. Every phase has one histogram of 64 log2
+ * buckets of cycle counts. The loop thread is its only writer, so a bump
+ * is a relaxed load and store with no locked instruction. Cycles become
+ * nanoseconds only on export: the counter is calibrated against
+ * CLOCK_MONOTONIC over the time since the profile started, and over at
+ * least a millisecond.
+ */
+
+#include "php_quicpro.h"
+#include "server/profiler.h"
+#include "server/otlp.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define QP_PROF_BUCKETS 64
+
+typedef struct {
+    _Atomic uint64_t count;
+    _Atomic uint64_t ticks;
+    _Atomic uint64_t buckets[QP_PROF_BUCKETS];
+} qp_prof_hist_t;
+
+/* A reader's copy of the histograms */
+typedef struct {
+    uint64_t count[QUICPRO_PROF_PHASES];
+    uint64_t total_ns[QUICPRO_PROF_PHASES];
+    uint64_t self_ns[QUICPRO_PROF_PHASES];
+    uint64_t buckets[QUICPRO_PROF_PHASES][QP_PROF_BUCKETS];
+    double   ns_per_tick;
+    uint64_t started_wall_ns;
+    uint64_t duration_ns;
+} qp_prof_view_t;
+
+_Atomic bool quicpro_prof_enabled = false;
+
+static qp_prof_hist_t qp_prof_hist[QUICPRO_PROF_PHASES];
+static _Atomic uint64_t qp_prof_started_ticks = 0;
+static _Atomic uint64_t qp_prof_started_ns = 0;         /* CLOCK_MONOTONIC */
+static _Atomic uint64_t qp_prof_started_wall_ns = 0;    /* CLOCK_REALTIME */
+
+static const char *const qp_prof_names[QUICPRO_PROF_PHASES] = {
+    [QUICPRO_PROF_RECV]         = "recv",
+    [QUICPRO_PROF_CONN_RECV]    = "conn_recv",
+    [QUICPRO_PROF_H3_POLL]      = "h3_poll",
+    [QUICPRO_PROF_PHP_CALLBACK] = "php_callback",
+    [QUICPRO_PROF_IIBIN_ENCODE] = "iibin_encode",
+    [QUICPRO_PROF_IIBIN_DECODE] = "iibin_decode",
+    [QUICPRO_PROF_SEND]         = "send",
+};
+
+/* The phase a phase runs inside, for the stacks; QUICPRO_PROF_PHASES for none */
+static inline quicpro_prof_phase_t qp_prof_parent(quicpro_prof_phase_t p)
+{
+    return (p == QUICPRO_PROF_IIBIN_ENCODE || p == QUICPRO_PROF_IIBIN_DECODE)
+        ? QUICPRO_PROF_PHP_CALLBACK : QUICPRO_PROF_PHASES;
+}
+
+static inline uint64_t qp_prof_clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#define QP_PROF_BUMP(field, n) \
+    atomic_store_explicit(&(field), atomic_load_explicit(&(field), memory_order_relaxed) + (n), memory_order_relaxed)
+
+/*──────────────────────────── Recording ──────────────────────────────────*/
+
+void quicpro_prof_record(quicpro_prof_phase_t phase, uint64_t ticks)
+{
+    qp_prof_hist_t *h = &qp_prof_hist[phase];
+    unsigned b = ticks ? 63u - (unsigned)__builtin_clzll(ticks) : 0;
+    QP_PROF_BUMP(h->count, 1);
+    QP_PROF_BUMP(h->ticks, ticks);
+    QP_PROF_BUMP(h->buckets[b], 1);
+}
+
+bool quicpro_prof_set_enabled(bool on)
+{
+    if (on && !atomic_load(&quicpro_prof_enabled)) {
+        for (int p = 0; p < QUICPRO_PROF_PHASES; p++) {
+            atomic_store_explicit(&qp_prof_hist[p].count, 0, memory_order_relaxed);
+            atomic_store_explicit(&qp_prof_hist[p].ticks, 0, memory_order_relaxed);
+            for (int b = 0; b < QP_PROF_BUCKETS; b++) {
+                atomic_store_explicit(&qp_prof_hist[p].buckets[b], 0, memory_order_relaxed);
+            }
+        }
+        atomic_store(&qp_prof_started_ticks, quicpro_prof_ticks());
+        atomic_store(&qp_prof_started_ns, qp_prof_clock_ns(CLOCK_MONOTONIC));
+        atomic_store(&qp_prof_started_wall_ns, qp_prof_clock_ns(CLOCK_REALTIME));
+    }
+    return atomic_exchange(&quicpro_prof_enabled, on);
+}
+
+/*──────────────────────────── Reading ────────────────────────────────────*/
+
+static double qp_prof_ns_per_tick(void)
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+    uint64_t t0 = atomic_load(&qp_prof_started_ticks), n0 = atomic_load(&qp_prof_started_ns);
+    if (!n0) {
+        t0 = quicpro_prof_ticks();
+        n0 = qp_prof_clock_ns(CLOCK_MONOTONIC);
+    }
+    uint64_t t1, n1;
+    do {
+        t1 = quicpro_prof_ticks();
+        n1 = qp_prof_clock_ns(CLOCK_MONOTONIC);
+    } while (n1 - n0 < 1000000);
+    return t1 > t0 ? (double)(n1 - n0) / (double)(t1 - t0) : 1.0;
+#else
+    return 1.0;   /* The counter already is CLOCK_MONOTONIC */
+#endif
+}
+
+static void qp_prof_view(qp_prof_view_t *v)
+{
+    memset(v, 0, sizeof(*v));
+    v->ns_per_tick = qp_prof_ns_per_tick();
+    v->started_wall_ns = atomic_load(&qp_prof_started_wall_ns);
+    uint64_t started = atomic_load(&qp_prof_started_ns);
+    v->duration_ns = started ? qp_prof_clock_ns(CLOCK_MONOTONIC) - started : 0;
+
+    for (int p = 0; p < QUICPRO_PROF_PHASES; p++) {
+        v->count[p] = atomic_load_explicit(&qp_prof_hist[p].count, memory_order_relaxed);
+        v->total_ns[p] = (uint64_t)((double)atomic_load_explicit(&qp_prof_hist[p].ticks, memory_order_relaxed) * v->ns_per_tick);
+        for (int b = 0; b < QP_PROF_BUCKETS; b++) {
+            v->buckets[p][b] = atomic_load_explicit(&qp_prof_hist[p].buckets[b], memory_order_relaxed);
+        }
+        v->self_ns[p] = v->total_ns[p];
+    }
+    /* A parent's own weight leaves out its children; IIBIN outside a handler may exceed it */
+    for (int p = 0; p < QUICPRO_PROF_PHASES; p++) {
+        quicpro_prof_phase_t parent = qp_prof_parent(p);
+        if (parent != QUICPRO_PROF_PHASES) {
+            v->self_ns[parent] = v->self_ns[parent] > v->total_ns[p] ? v->self_ns[parent] - v->total_ns[p] : 0;
+        }
+    }
+}
+
+size_t quicpro_prof_folded(char **out)
+{
+    qp_prof_view_t v;
+    qp_prof_view(&v);
+
+    char text[QUICPRO_PROF_PHASES * 80];
+    size_t len = 0;
+    for (int p = 0; p < QUICPRO_PROF_PHASES; p++) {
+        if (!v.count[p]) {
+            continue;
+        }
+        quicpro_prof_phase_t parent = qp_prof_parent(p);
+        len += (size_t)snprintf(text + len, sizeof(text) - len, "quicpro;%s%s%s %llu\n",
+                                parent != QUICPRO_PROF_PHASES ? qp_prof_names[parent] : "",
+                                parent != QUICPRO_PROF_PHASES ? ";" : "",
+                                qp_prof_names[p], (unsigned long long)v.self_ns[p]);
+    }
+    *out = pemalloc(len + 1, 1);
+    memcpy(*out, text, len);
+    (*out)[len] = '\0';
+    return len;
+}
+
+/* A ValueType of pprof's profile.proto */
+static void qp_prof_value_type(quicpro_otlp_buf_t *b, unsigned field, uint64_t type, uint64_t unit)
+{
+    size_t m = quicpro_otlp_open(b, field);
+    quicpro_otlp_tag(b, 1, 0);
+    quicpro_otlp_varint(b, type);
+    quicpro_otlp_tag(b, 2, 0);
+    quicpro_otlp_varint(b, unit);
+    quicpro_otlp_close(b, m);
+}
+
+size_t quicpro_prof_pprof(char **out)
+{
+    /* String table: fixed entries, then one per phase. Function and location i+2 is phase i, 1 the root. */
+    enum { S_EMPTY, S_CALLS, S_COUNT, S_WALL, S_NANOSECONDS, S_ROOT, S_PHASES };
+    static const char *const fixed[S_PHASES] = { "", "calls", "count", "wall", "nanoseconds", "quicpro" };
+
+    qp_prof_view_t v;
+    qp_prof_view(&v);
+    quicpro_otlp_buf_t b = {0};
+
+    qp_prof_value_type(&b, 1, S_CALLS, S_COUNT);
+    qp_prof_value_type(&b, 1, S_WALL, S_NANOSECONDS);
+
+    for (int p = 0; p < QUICPRO_PROF_PHASES; p++) {
+        if (!v.count[p]) {
+            continue;
+        }
+        size_t sample = quicpro_otlp_open(&b, 2);
+        size_t ids = quicpro_otlp_open(&b, 1);   /* Leaf first */
+        quicpro_otlp_varint(&b, (uint64_t)p + 2);
+        if (qp_prof_parent(p) != QUICPRO_PROF_PHASES) {
+            quicpro_otlp_varint(&b, (uint64_t)qp_prof_parent(p) + 2);
+        }
+        quicpro_otlp_varint(&b, 1);
+        quicpro_otlp_close(&b, ids);
+        size_t values = quicpro_otlp_open(&b, 2);
+        quicpro_otlp_varint(&b, v.count[p]);
+        quicpro_otlp_varint(&b, v.self_ns[p]);
+        quicpro_otlp_close(&b, values);
+        quicpro_otlp_close(&b, sample);
+    }
+
+    for (uint64_t id = 1; id <= QUICPRO_PROF_PHASES + 1; id++) {
+        uint64_t name = id == 1 ? S_ROOT : S_PHASES + id - 2;
+
+        size_t loc = quicpro_otlp_open(&b, 4);
+        quicpro_otlp_tag(&b, 1, 0);
+        quicpro_otlp_varint(&b, id);
+        size_t line = quicpro_otlp_open(&b, 4);
+        quicpro_otlp_tag(&b, 1, 0);
+        quicpro_otlp_varint(&b, id);
+        quicpro_otlp_close(&b, line);
+        quicpro_otlp_close(&b, loc);
+
+        size_t fn = quicpro_otlp_open(&b, 5);
+        quicpro_otlp_tag(&b, 1, 0);
+        quicpro_otlp_varint(&b, id);
+        quicpro_otlp_tag(&b, 2, 0);
+        quicpro_otlp_varint(&b, name);
+        quicpro_otlp_tag(&b, 3, 0);
+        quicpro_otlp_varint(&b, name);
+        quicpro_otlp_close(&b, fn);
+    }
+
+    for (int s = 0; s < S_PHASES; s++) {
+        quicpro_otlp_bytes(&b, 6, fixed[s], strlen(fixed[s]));
+    }
+    for (int p = 0; p < QUICPRO_PROF_PHASES; p++) {
+        quicpro_otlp_bytes(&b, 6, qp_prof_names[p], strlen(qp_prof_names[p]));
+    }
+
+    quicpro_otlp_tag(&b, 9, 0);
+    quicpro_otlp_varint(&b, v.started_wall_ns);
+    quicpro_otlp_tag(&b, 10, 0);
+    quicpro_otlp_varint(&b, v.duration_ns);
+    qp_prof_value_type(&b, 11, S_WALL, S_NANOSECONDS);
+    quicpro_otlp_tag(&b, 12, 0);
+    quicpro_otlp_varint(&b, 1);
+
+    *out = (char *)b.p;
+    return b.len;
+}
+
+/*──────────────────────────── PHP ────────────────────────────────────────*/
+
+PHP_FUNCTION(quicpro_profiler_enable)
+{
+    bool on = true;
+
+    ZEND_PARSE_PARAMETERS_START(0, 1)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_BOOL(on)
+    ZEND_PARSE_PARAMETERS_END();
+
+    RETURN_BOOL(quicpro_prof_set_enabled(on));
+}
+
+PHP_FUNCTION(quicpro_profiler_export)
+{
+    zend_string *format = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(0, 1)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR(format)
+    ZEND_PARSE_PARAMETERS_END();
+
+    char *data;
+    size_t len;
+    if (!format || zend_string_equals_literal(format, "folded")) {
+        len = quicpro_prof_folded(&data);
+    } else if (zend_string_equals_literal(format, "pprof")) {
+        len = quicpro_prof_pprof(&data);
+    } else {
+        throw_mcp_error_as_php_exception(0, "Profiler::export: format must be \"folded\" or \"pprof\".");
+        RETURN_FALSE;
+    }
+    RETVAL_STRINGL(data ? data : "", len);
+    if (data) {
+        pefree(data, 1);
+    }
+}
+
+PHP_FUNCTION(quicpro_profiler_snapshot)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    qp_prof_view_t v;
+    qp_prof_view(&v);
+
+    array_init_size(return_value, QUICPRO_PROF_PHASES);
+    for (int p = 0; p < QUICPRO_PROF_PHASES; p++) {
+        zval phase, buckets;
+        array_init_size(&phase, 3);
+        add_assoc_long(&phase, "count", (zend_long)v.count[p]);
+        add_assoc_long(&phase, "total_ns", (zend_long)v.total_ns[p]);
+        array_init(&buckets);
+        for (int b = 0; b < QP_PROF_BUCKETS; b++) {
+            if (v.buckets[p][b]) {
+                /* Short buckets can round to the same nanosecond; they share its entry */
+                zend_ulong upper = (zend_ulong)ceil((double)((uint64_t)2 << (b < 62 ? b : 62)) * v.ns_per_tick);
+                zval *same = zend_hash_index_find(Z_ARRVAL(buckets), upper);
+                if (same) {
+                    ZVAL_LONG(same, Z_LVAL_P(same) + (zend_long)v.buckets[p][b]);
+                } else {
+                    add_index_long(&buckets, upper, (zend_long)v.buckets[p][b]);
+                }
+            }
+        }
+        add_assoc_zval(&phase, "buckets", &buckets);
+        add_assoc_zval(return_value, qp_prof_names[p], &phase);
+    }
+}
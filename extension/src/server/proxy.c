@@ -0,0 +1,1232 @@
+/*
+ * src/server/proxy.c – L7 HTTP/3 reverse proxy on the listeners
+ * ==============================================================
+ *
+ * See include/server/proxy.h. A splice is one client stream and the
+ * upstream request it became. Splices hang off their client connection
+ * (quicpro_session_t.proxy); the connections that have any, and the
+ * upstream QUIC connections the proxy holds, are listed per worker so
+ * that a tick reaches all of them.
+ *
+ * Each direction is pulled, not pushed: a splice reads its source only as
+ * far as its window has room and the sink took the last bytes, so quiche
+ * keeps the rest (and withholds credit from the sender) until then. On the
+ * HTTP/2 side libcurl callbacks pause the transfer instead.
+ */
+
+#include "php_quicpro.h"
+#include "server/proxy.h"
+#include "client/mux.h"                /* Events of a shared connection's other streams */
+#include "client/pool.h"
+#include "poll/poll.h"
+#include "server/profiler.h"
+#include "server/priority.h"           /* The client's priority for the response */
+#include "server/h3_settings.h"
+#include "cluster/cluster_stats.h"
+#include "config/quic_transport/base_layer.h"
+
+#include <curl/curl.h>
+#include <quiche.h>
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+
+#define QP_PX_H3_NO_ERROR   0x100
+#define QP_PX_H3_INTERNAL   0x102
+#define QP_PX_H3_CANCELLED  0x10c
+
+extern int le_quicpro_session;
+extern int le_quicpro_cfg;
+
+typedef enum { QP_PX_H3, QP_PX_H2, QP_PX_H2C } qp_px_kind_t;
+
+typedef struct {
+    zend_string   *host;            /* NULL: any; "*.x": the subdomains of x */
+    zend_string   *path;            /* A prefix; NULL: any */
+    HashTable     *headers;         /* Lower-case name → value; NULL: none */
+    qp_px_kind_t   kind;
+    char           up_host[QUICPRO_MAX_HOST_LEN];
+    zend_long      up_port;
+    zend_string   *up_authority;    /* "host:port" */
+    zend_resource *cfg;             /* Quicpro\Config of an h3:// upstream, referenced */
+    bool           preserve_host;
+} qp_px_route_t;
+
+/* An upstream QUIC connection the proxy holds a reference to */
+typedef struct qp_px_up_s {
+    zend_resource      *res;
+    quicpro_session_t  *s;
+    const qp_px_route_t *route;     /* The first route that used it; upstreams are compared by address and config */
+    HashTable           streams;    /* Upstream stream ID → splice, not owning */
+    bool                watched;    /* Its socket is in the listener's epoll set */
+    bool                goaway;     /* Takes no new streams */
+    struct qp_px_up_s  *next;
+} qp_px_up_t;
+
+/* Request and response fields: [name length][value length][name][value], repeated */
+typedef struct {
+    smart_str a;
+    uint32_t  n;
+} qp_px_fields_t;
+
+typedef struct {
+    quicpro_proxy_conn_t *pc;
+    uint64_t       sid;             /* The client's stream */
+    const qp_px_route_t *route;
+    qp_px_fields_t req_fields;
+    quicpro_priority_t prio;        /* From the request's priority field */
+    bool           req_body;        /* DATA follows the client's HEADERS */
+    bool           req_fin;         /* The client's side is complete */
+    bool           req_fin_sent;
+    /* Upstream: an HTTP/3 stream, or a libcurl transfer */
+    qp_px_up_t    *up;
+    int64_t        up_sid;          /* -1 until the request went out */
+    CURL          *easy;
+    struct curl_slist *curl_headers;
+    bool           upload_paused, download_paused;
+    /* Response */
+    qp_px_fields_t resp_fields;
+    long           resp_status;
+    bool           resp_ready;      /* Fields complete */
+    bool           resp_started;    /* Fields sent to the client */
+    bool           resp_fin;        /* The upstream's side is complete */
+    bool           done;            /* Swept on the next pass */
+    size_t         req_off, req_len, resp_off, resp_len;
+    uint8_t        req[QUICPRO_PROXY_WINDOW];
+    uint8_t        resp[QUICPRO_PROXY_WINDOW];
+} qp_px_splice_t;
+
+struct quicpro_proxy_conn_s {
+    quicpro_session_t    *s;
+    HashTable             streams;  /* Client stream ID → splice, owning */
+    quicpro_proxy_conn_t *prev, *next;
+};
+
+static ZEND_TLS struct {
+    HashTable            *routes;   /* In order added; qp_px_route_t *, owning */
+    quicpro_proxy_conn_t *conns;    /* Client connections with splices */
+    qp_px_up_t           *ups;
+    CURLM                *multi;    /* HTTP/2 upstreams */
+    int                   running;  /* Transfers on `multi` */
+    int                   epoll_fd; /* The listener's, -1: none */
+} qp_px = { .epoll_fd = -1 };
+
+/* Tag of every upstream socket in the listener's epoll set; the listener ignores it */
+static char qp_px_wake;
+
+/*──────────────────────────────── Fields ─────────────────────────────────*/
+
+static void qp_px_field_add(qp_px_fields_t *f, const char *name, size_t name_len, const char *value, size_t value_len)
+{
+    uint32_t len[2] = { (uint32_t)name_len, (uint32_t)value_len };
+    smart_str_appendl(&f->a, (const char *)len, sizeof(len));
+    smart_str_appendl(&f->a, name, name_len);
+    smart_str_appendl(&f->a, value, value_len);
+    f->n++;
+}
+
+static const char *qp_px_field_next(const char *p, const char **name, size_t *name_len, const char **value, size_t *value_len)
+{
+    uint32_t len[2];
+    memcpy(len, p, sizeof(len));
+    *name = p + sizeof(len);
+    *name_len = len[0];
+    *value = *name + len[0];
+    *value_len = len[1];
+    return *value + len[1];
+}
+
+static bool qp_px_field_find(const qp_px_fields_t *f, const char *want, size_t want_len, const char **value, size_t *value_len)
+{
+    const char *p = f->a.s ? ZSTR_VAL(f->a.s) : NULL, *name;
+    size_t name_len;
+    for (uint32_t i = 0; i < f->n; i++) {
+        p = qp_px_field_next(p, &name, &name_len, value, value_len);
+        if (name_len == want_len && memcmp(name, want, want_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* The fields as quiche headers, pointing into `f`; efree() the array */
+static quiche_h3_header *qp_px_field_array(const qp_px_fields_t *f)
+{
+    quiche_h3_header *h = safe_emalloc(MAX(f->n, 1), sizeof(*h), 0);
+    const char *p = f->a.s ? ZSTR_VAL(f->a.s) : NULL, *name, *value;
+    size_t name_len, value_len;
+    for (uint32_t i = 0; i < f->n; i++) {
+        p = qp_px_field_next(p, &name, &name_len, &value, &value_len);
+        h[i] = (quiche_h3_header){ (const uint8_t *)name, name_len, (const uint8_t *)value, value_len };
+    }
+    return h;
+}
+
+/* Connection-specific fields (RFC 9110 §7.6.1), which a proxy does not forward */
+static bool qp_px_hop_by_hop(const char *name, size_t len)
+{
+    static const char *const hop[] = { "connection", "keep-alive", "proxy-connection", "transfer-encoding", "upgrade", "te", NULL };
+    for (int i = 0; hop[i]; i++) {
+        if (strlen(hop[i]) == len && strncasecmp(name, hop[i], len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int qp_px_on_header(uint8_t *name, size_t name_len, uint8_t *value, size_t value_len, void *argp)
+{
+    qp_px_field_add(argp, (const char *)name, name_len, (const char *)value, value_len);
+    return 0;
+}
+
+/*──────────────────────────────── Routes ─────────────────────────────────*/
+
+static void qp_px_route_dtor(zval *zv)
+{
+    qp_px_route_t *r = Z_PTR_P(zv);
+    if (r->host) zend_string_release(r->host);
+    if (r->path) zend_string_release(r->path);
+    if (r->headers) {
+        zend_hash_destroy(r->headers);
+        FREE_HASHTABLE(r->headers);
+    }
+    if (r->cfg) zend_list_delete(r->cfg);
+    zend_string_release(r->up_authority);
+    efree(r);
+}
+
+/* :authority (or Host) without its port */
+static void qp_px_request_host(const qp_px_fields_t *f, const char **host, size_t *len)
+{
+    if (!qp_px_field_find(f, ":authority", 10, host, len) && !qp_px_field_find(f, "host", 4, host, len)) {
+        *host = "";
+        *len = 0;
+        return;
+    }
+    const char *p = *host, *end = p + *len;
+    if (p < end && *p == '[') {
+        const char *close = memchr(p, ']', (size_t)(end - p));
+        *len = close ? (size_t)(close - p + 1) : *len;
+        return;
+    }
+    const char *colon = memchr(p, ':', (size_t)(end - p));
+    if (colon) {
+        *len = (size_t)(colon - p);
+    }
+}
+
+static const qp_px_route_t *qp_px_match(const qp_px_fields_t *f)
+{
+    const char *host, *path, *value;
+    size_t host_len, path_len, value_len;
+    const qp_px_route_t *r;
+
+    if (!qp_px.routes) {
+        return NULL;
+    }
+    qp_px_request_host(f, &host, &host_len);
+    if (!qp_px_field_find(f, ":path", 5, &path, &path_len)) {
+        path = "";
+        path_len = 0;
+    }
+    ZEND_HASH_FOREACH_PTR(qp_px.routes, r) {
+        if (r->host) {
+            const char *want = ZSTR_VAL(r->host);
+            size_t want_len = ZSTR_LEN(r->host);
+            if (want_len > 2 && want[0] == '*' && want[1] == '.') {
+                /* "*.example.com" takes "a.example.com", not "example.com" */
+                if (host_len < want_len || strncasecmp(host + host_len - (want_len - 1), want + 1, want_len - 1) != 0) {
+                    continue;
+                }
+            } else if (host_len != want_len || strncasecmp(host, want, want_len) != 0) {
+                continue;
+            }
+        }
+        if (r->path && (path_len < ZSTR_LEN(r->path) || memcmp(path, ZSTR_VAL(r->path), ZSTR_LEN(r->path)) != 0)) {
+            continue;
+        }
+        if (r->headers) {
+            zend_string *name;
+            zend_string *want;
+            bool all = true;
+            ZEND_HASH_FOREACH_STR_KEY_PTR(r->headers, name, want) {
+                if (!qp_px_field_find(f, ZSTR_VAL(name), ZSTR_LEN(name), &value, &value_len)
+                    || value_len != ZSTR_LEN(want) || memcmp(value, ZSTR_VAL(want), value_len) != 0) {
+                    all = false;
+                    break;
+                }
+            } ZEND_HASH_FOREACH_END();
+            if (!all) {
+                continue;
+            }
+        }
+        return r;
+    } ZEND_HASH_FOREACH_END();
+    return NULL;
+}
+
+static void qp_px_header_value_dtor(zval *zv)
+{
+    zend_string_release((zend_string *)Z_PTR_P(zv));
+}
+
+PHP_FUNCTION(quicpro_proxy_route)
+{
+    HashTable *match;
+    zend_string *upstream;
+    zval *options = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(2, 3)
+        Z_PARAM_ARRAY_HT(match)
+        Z_PARAM_STR(upstream)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_ARRAY_OR_NULL(options)
+    ZEND_PARSE_PARAMETERS_END();
+
+    HashTable *opts = options ? Z_ARRVAL_P(options) : NULL;
+    qp_px_route_t *r = ecalloc(1, sizeof(*r));
+    const char *u = ZSTR_VAL(upstream), *hp;
+    zend_long default_port;
+
+    if (strncasecmp(u, "h3://", 5) == 0) {
+        r->kind = QP_PX_H3;
+        hp = u + 5;
+        default_port = 443;
+    } else if (strncasecmp(u, "https://", 8) == 0) {
+        r->kind = QP_PX_H2;
+        hp = u + 8;
+        default_port = 443;
+    } else if (strncasecmp(u, "http://", 7) == 0) {
+        r->kind = QP_PX_H2C;
+        hp = u + 7;
+        default_port = 80;
+    } else {
+        efree(r);
+        zend_argument_value_error(2, "must be an h3://, https:// or http:// URL");
+        RETURN_THROWS();
+    }
+
+    /* host[:port], an IPv6 address in brackets */
+    const char *end = hp + strcspn(hp, "/"), *colon = NULL;
+    const char *host = hp, *host_end = end;
+    if (*hp == '[') {
+        const char *close = memchr(hp, ']', (size_t)(end - hp));
+        host = hp + 1;
+        host_end = close ? close : end;
+        colon = close && close + 1 < end && close[1] == ':' ? close + 1 : NULL;
+    } else if ((colon = memchr(hp, ':', (size_t)(end - hp))) != NULL) {
+        host_end = colon;
+    }
+    char *stop = NULL;
+    r->up_port = colon ? ZEND_STRTOL(colon + 1, &stop, 10) : default_port;
+    if (host_end == host || (size_t)(host_end - host) >= sizeof(r->up_host) || (colon && stop != end)
+        || r->up_port <= 0 || r->up_port > 65535) {
+        efree(r);
+        zend_argument_value_error(2, "must name a host and an optional port");
+        RETURN_THROWS();
+    }
+    memcpy(r->up_host, host, (size_t)(host_end - host));
+    r->up_authority = zend_string_init(hp, (size_t)(end - hp), 0);
+
+    zval *zv;
+    if (r->kind == QP_PX_H3) {
+        zv = opts ? zend_hash_str_find(opts, "config", sizeof("config") - 1) : NULL;
+        quicpro_cfg_t *cfg = zv && Z_TYPE_P(zv) == IS_RESOURCE
+                           ? (quicpro_cfg_t *)zend_fetch_resource_ex(zv, "Quicpro\\Config", le_quicpro_cfg) : NULL;
+        if (!cfg || !cfg->quiche_cfg) {
+            zend_string_release(r->up_authority);
+            efree(r);
+            if (!EG(exception)) {
+                zend_value_error("An h3:// upstream needs a Quicpro\\Config in option \"config\"");
+            }
+            RETURN_THROWS();
+        }
+        r->cfg = Z_RES_P(zv);
+        GC_ADDREF(r->cfg);
+    }
+    zv = opts ? zend_hash_str_find(opts, "preserve_host", sizeof("preserve_host") - 1) : NULL;
+    r->preserve_host = !zv || zend_is_true(zv);
+
+    if ((zv = zend_hash_str_find(match, "host", sizeof("host") - 1)) && Z_TYPE_P(zv) != IS_NULL) {
+        r->host = zval_get_string(zv);
+    }
+    if ((zv = zend_hash_str_find(match, "path", sizeof("path") - 1)) && Z_TYPE_P(zv) != IS_NULL) {
+        r->path = zval_get_string(zv);
+    }
+    if ((zv = zend_hash_str_find(match, "headers", sizeof("headers") - 1)) && Z_TYPE_P(zv) == IS_ARRAY) {
+        zend_string *name;
+        zval *value;
+        ALLOC_HASHTABLE(r->headers);
+        zend_hash_init(r->headers, 4, NULL, qp_px_header_value_dtor, 0);
+        ZEND_HASH_FOREACH_STR_KEY_VAL(Z_ARRVAL_P(zv), name, value) {
+            if (name) {
+                zend_string *lower = zend_string_tolower(name);
+                zend_hash_update_ptr(r->headers, lower, zval_get_string(value));
+                zend_string_release(lower);
+            }
+        } ZEND_HASH_FOREACH_END();
+    }
+
+    if (!qp_px.routes) {
+        ALLOC_HASHTABLE(qp_px.routes);
+        zend_hash_init(qp_px.routes, 8, NULL, qp_px_route_dtor, 0);
+    }
+    zend_hash_next_index_insert_ptr(qp_px.routes, r);
+    RETURN_TRUE;
+}
+
+/*─────────────────────────── Upstream QUIC ───────────────────────────────*/
+
+static bool qp_px_up_alive(const qp_px_up_t *up)
+{
+    quicpro_session_t *s = up->s;
+    return s && s->conn && !s->is_closed && !quiche_conn_is_closed(s->conn) && !quiche_conn_is_draining(s->conn);
+}
+
+static void qp_px_up_watch(qp_px_up_t *up)
+{
+    if (up->watched || qp_px.epoll_fd < 0 || up->s->sock < 0) {
+        return;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &qp_px_wake };
+    up->watched = epoll_ctl(qp_px.epoll_fd, EPOLL_CTL_ADD, up->s->sock, &ev) == 0;
+}
+
+/* A connection to the route's upstream with a stream to spare, or NULL with nothing thrown */
+static qp_px_up_t *qp_px_up_get(const qp_px_route_t *r)
+{
+    quicpro_cfg_t *cfg = r->cfg->ptr;
+    for (qp_px_up_t *up = qp_px.ups; up; up = up->next) {
+        if (up->route->cfg->ptr == cfg && up->route->up_port == r->up_port && strcmp(up->route->up_host, r->up_host) == 0
+            && !up->goaway && qp_px_up_alive(up)
+            && (!quiche_conn_is_established(up->s->conn) || quiche_conn_peer_streams_left_bidi(up->s->conn) > 0)) {
+            return up;
+        }
+    }
+
+    /* As quicpro_mcp_open(): a warm pooled connection if there is one we do not hold yet */
+    size_t host_len = strlen(r->up_host);
+    bool pooled = quicpro_quic_transport_config.client_pool_enable;
+    quicpro_pool_key_t key = { r->up_host, host_len, r->up_port, "h3", cfg };
+    zend_resource *res = pooled
+        ? quicpro_client_pool_checkout(&key, (uint32_t)quicpro_quic_transport_config.client_pool_max_streams_per_conn) : NULL;
+    for (qp_px_up_t *up = qp_px.ups; res && up; up = up->next) {
+        if (up->res == res) {
+            zend_list_delete(res);
+            res = NULL;
+        }
+    }
+    if (!res) {
+        quicpro_session_t *s = quicpro_client_session_open(r->up_host, host_len, r->up_port, cfg, -1, NULL);
+        if (!s) {
+            zend_clear_exception();
+            return NULL;
+        }
+        s->resource = zend_register_resource(s, le_quicpro_session);
+        if (pooled) {
+            quicpro_client_pool_add(&key, s);
+        }
+        res = s->resource;
+    }
+
+    qp_px_up_t *up = ecalloc(1, sizeof(*up));
+    up->res = res;
+    up->s = res->ptr;
+    up->route = r;
+    zend_hash_init(&up->streams, 8, NULL, NULL, 0);
+    up->next = qp_px.ups;
+    qp_px.ups = up;
+    qp_px_up_watch(up);
+    return up;
+}
+
+static void qp_px_up_free(qp_px_up_t *up)
+{
+    if (up->watched && qp_px.epoll_fd >= 0 && up->s->sock >= 0) {
+        epoll_ctl(qp_px.epoll_fd, EPOLL_CTL_DEL, up->s->sock, NULL);
+    }
+    zend_hash_destroy(&up->streams);
+    zend_list_delete(up->res);
+    efree(up);
+}
+
+/*───────────────────────────── Splices ───────────────────────────────────*/
+
+static void qp_px_splice_dtor(zval *zv)
+{
+    qp_px_splice_t *sp = Z_PTR_P(zv);
+    if (sp->easy) {
+        curl_multi_remove_handle(qp_px.multi, sp->easy);
+        curl_easy_cleanup(sp->easy);
+    }
+    if (sp->curl_headers) {
+        curl_slist_free_all(sp->curl_headers);
+    }
+    if (sp->up && sp->up_sid >= 0) {
+        /* Whatever the upstream still sends for it is of no use now */
+        if (!sp->resp_fin && qp_px_up_alive(sp->up)) {
+            quiche_conn_stream_shutdown(sp->up->s->conn, (uint64_t)sp->up_sid, QUICHE_SHUTDOWN_READ, QP_PX_H3_CANCELLED);
+            quiche_conn_stream_shutdown(sp->up->s->conn, (uint64_t)sp->up_sid, QUICHE_SHUTDOWN_WRITE, QP_PX_H3_CANCELLED);
+        }
+        zend_hash_index_del(&sp->up->streams, (zend_ulong)sp->up_sid);
+    }
+    smart_str_free(&sp->req_fields.a);
+    smart_str_free(&sp->resp_fields.a);
+    efree(sp);
+}
+
+/* Stops reading a client request nobody needs the rest of */
+static void qp_px_stop_request(qp_px_splice_t *sp)
+{
+    if (!sp->req_fin) {
+        quiche_conn_stream_shutdown(sp->pc->s->conn, sp->sid, QUICHE_SHUTDOWN_READ, QP_PX_H3_NO_ERROR);
+    }
+}
+
+/* An answer of our own, without a body */
+static void qp_px_answer(qp_px_splice_t *sp, const char *status)
+{
+    quiche_h3_header h[2] = {
+        { (const uint8_t *)":status", 7, (const uint8_t *)status, strlen(status) },
+        { (const uint8_t *)"content-length", 14, (const uint8_t *)"0", 1 },
+    };
+    quicpro_session_t *s = sp->pc->s;
+    if (quiche_h3_send_response(s->h3, s->conn, sp->sid, h, 2, true) < 0) {
+        quiche_conn_stream_shutdown(s->conn, sp->sid, QUICHE_SHUTDOWN_WRITE, QP_PX_H3_INTERNAL);
+    }
+    qp_px_stop_request(sp);
+    sp->done = true;
+}
+
+/* The upstream failed: a 502 while the client has no response yet, else a reset */
+static void qp_px_fail(qp_px_splice_t *sp)
+{
+    if (sp->done) {
+        return;
+    }
+    if (!sp->resp_started) {
+        qp_px_answer(sp, "502");
+        return;
+    }
+    quiche_conn_stream_shutdown(sp->pc->s->conn, sp->sid, QUICHE_SHUTDOWN_WRITE, QP_PX_H3_INTERNAL);
+    qp_px_stop_request(sp);
+    sp->done = true;
+}
+
+/* The fields the upstream gets: the client's, less hop-by-hop ones, plus x-forwarded-* */
+static void qp_px_upstream_fields(const qp_px_splice_t *sp, qp_px_fields_t *out, bool pseudo)
+{
+    const qp_px_route_t *r = sp->route;
+    const quicpro_session_t *s = sp->pc->s;
+    const char *p = sp->req_fields.a.s ? ZSTR_VAL(sp->req_fields.a.s) : NULL, *name, *value;
+    size_t name_len, value_len;
+    char ip[INET6_ADDRSTRLEN] = "";
+    smart_str xff = {0};
+
+    if (s->peer_addr.ss_family == AF_INET6) {
+        inet_ntop(AF_INET6, &((const struct sockaddr_in6 *)&s->peer_addr)->sin6_addr, ip, sizeof(ip));
+    } else if (s->peer_addr.ss_family == AF_INET) {
+        inet_ntop(AF_INET, &((const struct sockaddr_in *)&s->peer_addr)->sin_addr, ip, sizeof(ip));
+    }
+    for (uint32_t i = 0; i < sp->req_fields.n; i++) {
+        p = qp_px_field_next(p, &name, &name_len, &value, &value_len);
+        if (qp_px_hop_by_hop(name, name_len) || (name_len && name[0] == ':' && !pseudo)) {
+            continue;
+        }
+        if (name_len == 15 && memcmp(name, "x-forwarded-for", 15) == 0) {
+            smart_str_appendl(&xff, value, value_len);
+            smart_str_appends(&xff, ", ");
+            continue;
+        }
+        if (name_len == 17 && memcmp(name, "x-forwarded-proto", 17) == 0) {
+            continue;
+        }
+        if (!r->preserve_host && ((name_len == 10 && memcmp(name, ":authority", 10) == 0)
+                                  || (name_len == 4 && memcmp(name, "host", 4) == 0))) {
+            value = ZSTR_VAL(r->up_authority);
+            value_len = ZSTR_LEN(r->up_authority);
+        }
+        qp_px_field_add(out, name, name_len, value, value_len);
+    }
+    smart_str_appends(&xff, ip);
+    smart_str_0(&xff);
+    qp_px_field_add(out, "x-forwarded-for", 15, ZSTR_VAL(xff.s), ZSTR_LEN(xff.s));
+    qp_px_field_add(out, "x-forwarded-proto", 17, "https", 5);
+    smart_str_free(&xff);
+}
+
+/* HTTP/3 upstream: sends the request once the connection can take it */
+static void qp_px_h3_send_request(qp_px_splice_t *sp)
+{
+    quicpro_session_t *u = sp->up->s;
+    if (!quiche_conn_is_established(u->conn) && !quiche_conn_is_in_early_data(u->conn)) {
+        return;
+    }
+    qp_px_fields_t f = {0};
+    qp_px_upstream_fields(sp, &f, true);
+    quiche_h3_header *h = qp_px_field_array(&f);
+    int64_t sid = quiche_h3_send_request(u->h3, u->conn, h, f.n, !sp->req_body);
+    efree(h);
+    smart_str_free(&f.a);
+
+    if (sid >= 0) {
+        sp->up_sid = sid;
+        zend_hash_index_add_new_ptr(&sp->up->streams, (zend_ulong)sid, sp);
+        sp->req_fin_sent = !sp->req_body;
+    } else if (sid == QUICHE_H3_TRANSPORT_ERR_STREAM_LIMIT) {
+        /* This connection is full: the next tick tries another */
+        sp->up = qp_px_up_get(sp->route);
+        if (!sp->up) {
+            qp_px_fail(sp);
+        }
+    } else if (sid != QUICHE_H3_ERR_STREAM_BLOCKED) {
+        qp_px_fail(sp);
+    }
+}
+
+/*──────────────────────────── Upstream HTTP/2 ────────────────────────────*/
+
+static size_t qp_px_curl_header(char *line, size_t size, size_t n, void *ud)
+{
+    qp_px_splice_t *sp = ud;
+    size_t len = size * n, end = len;
+    while (end && (line[end - 1] == '\r' || line[end - 1] == '\n')) end--;
+
+    if (end >= 5 && memcmp(line, "HTTP/", 5) == 0) {
+        /* A status line: informational responses before it are not forwarded */
+        const char *sp_at = memchr(line, ' ', end);
+        sp->resp_status = sp_at ? strtol(sp_at + 1, NULL, 10) : 0;
+        smart_str_free(&sp->resp_fields.a);
+        sp->resp_fields.n = 0;
+        char status[8];
+        int sl = snprintf(status, sizeof(status), "%ld", sp->resp_status);
+        qp_px_field_add(&sp->resp_fields, ":status", 7, status, (size_t)sl);
+    } else if (end == 0) {
+        sp->resp_ready = sp->resp_status >= 200;
+    } else {
+        const char *colon = memchr(line, ':', end);
+        if (colon && colon > line && (size_t)(colon - line) < 256 && !qp_px_hop_by_hop(line, (size_t)(colon - line))) {
+            char name[256];
+            size_t name_len = (size_t)(colon - line);
+            zend_str_tolower_copy(name, line, name_len);
+            const char *v = colon + 1;
+            while (v < line + end && (*v == ' ' || *v == '\t')) v++;
+            qp_px_field_add(&sp->resp_fields, name, name_len, v, (size_t)(line + end - v));
+        }
+    }
+    return len;
+}
+
+static size_t qp_px_curl_write(char *data, size_t size, size_t n, void *ud)
+{
+    qp_px_splice_t *sp = ud;
+    size_t len = size * n;
+    if (sp->done) {
+        return 0;   /* The client is gone: abort */
+    }
+    if (sp->resp_off) {
+        memmove(sp->resp, sp->resp + sp->resp_off, sp->resp_len - sp->resp_off);
+        sp->resp_len -= sp->resp_off;
+        sp->resp_off = 0;
+    }
+    if (len > sizeof(sp->resp) - sp->resp_len) {
+        sp->download_paused = true;
+        return CURL_WRITEFUNC_PAUSE;    /* Delivered again once unpaused */
+    }
+    memcpy(sp->resp + sp->resp_len, data, len);
+    sp->resp_len += len;
+    return len;
+}
+
+static size_t qp_px_curl_read(char *buf, size_t size, size_t n, void *ud)
+{
+    qp_px_splice_t *sp = ud;
+    size_t avail = sp->req_len - sp->req_off, want = size * n;
+    if (avail) {
+        size_t take = MIN(avail, want);
+        memcpy(buf, sp->req + sp->req_off, take);
+        sp->req_off += take;
+        return take;
+    }
+    if (sp->req_fin) {
+        sp->req_fin_sent = true;
+        return 0;
+    }
+    sp->upload_paused = true;
+    return CURL_READFUNC_PAUSE;
+}
+
+static int qp_px_curl_socket(CURL *easy, curl_socket_t fd, int what, void *ud, void *sockp)
+{
+    (void)easy; (void)ud; (void)sockp;
+    if (qp_px.epoll_fd < 0) {
+        return 0;
+    }
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(qp_px.epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        return 0;
+    }
+    struct epoll_event ev = { .events = (what & CURL_POLL_IN ? EPOLLIN : 0) | (what & CURL_POLL_OUT ? EPOLLOUT : 0),
+                              .data.ptr = &qp_px_wake };
+    if (epoll_ctl(qp_px.epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+        epoll_ctl(qp_px.epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    }
+    return 0;
+}
+
+static void qp_px_curl_pause(qp_px_splice_t *sp)
+{
+    curl_easy_pause(sp->easy, (sp->download_paused ? CURLPAUSE_RECV : 0) | (sp->upload_paused ? CURLPAUSE_SEND : 0));
+}
+
+static bool qp_px_h2_start(qp_px_splice_t *sp)
+{
+    const qp_px_route_t *r = sp->route;
+    if (!qp_px.multi) {
+        if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK || !(qp_px.multi = curl_multi_init())) {
+            return false;
+        }
+        curl_multi_setopt(qp_px.multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(qp_px.multi, CURLMOPT_SOCKETFUNCTION, qp_px_curl_socket);
+    }
+    const char *method = "GET", *path = "/", *value;
+    size_t method_len = 3, path_len = 1, value_len;
+    qp_px_field_find(&sp->req_fields, ":method", 7, &method, &method_len);
+    qp_px_field_find(&sp->req_fields, ":path", 5, &path, &path_len);
+
+    CURL *easy = curl_easy_init();
+    if (!easy) {
+        return false;
+    }
+    sp->easy = easy;
+    char *url = emalloc(ZSTR_LEN(r->up_authority) + path_len + 16);
+    sprintf(url, "%s://%s%.*s", r->kind == QP_PX_H2 ? "https" : "http", ZSTR_VAL(r->up_authority), (int)path_len, path);
+    char *verb = estrndup(method, method_len);
+    curl_easy_setopt(easy, CURLOPT_URL, url);
+    curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, verb);    /* Copied by libcurl */
+    efree(url);
+    efree(verb);
+    if (method_len == 4 && memcmp(method, "HEAD", 4) == 0) {
+        curl_easy_setopt(easy, CURLOPT_NOBODY, 1L);
+    }
+    curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, r->kind == QP_PX_H2 ? CURL_HTTP_VERSION_2TLS : CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE);
+    curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);            /* Wait to multiplex instead of opening another connection */
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, sp);
+    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, qp_px_curl_header);
+    curl_easy_setopt(easy, CURLOPT_HEADERDATA, sp);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, qp_px_curl_write);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, sp);
+    if (sp->req_body) {
+        curl_easy_setopt(easy, CURLOPT_UPLOAD, 1L);
+        curl_easy_setopt(easy, CURLOPT_READFUNCTION, qp_px_curl_read);
+        curl_easy_setopt(easy, CURLOPT_READDATA, sp);
+        if (qp_px_field_find(&sp->req_fields, "content-length", 14, &value, &value_len)) {
+            curl_easy_setopt(easy, CURLOPT_INFILESIZE_LARGE, (curl_off_t)ZEND_STRTOL(value, NULL, 10));
+        }
+    } else {
+        sp->req_fin_sent = true;
+    }
+
+    /* Regular fields only; libcurl writes the pseudo-headers from the URL and Host */
+    qp_px_fields_t f = {0};
+    qp_px_upstream_fields(sp, &f, false);
+    const char *p = f.a.s ? ZSTR_VAL(f.a.s) : NULL, *name;
+    size_t name_len;
+    bool host = false;
+    smart_str line = {0};
+    for (uint32_t i = 0; i < f.n; i++) {
+        p = qp_px_field_next(p, &name, &name_len, &value, &value_len);
+        if (name_len == 14 && memcmp(name, "content-length", 14) == 0) {
+            continue;
+        }
+        host |= name_len == 4 && memcmp(name, "host", 4) == 0;
+        smart_str_appendl(&line, name, name_len);
+        smart_str_appends(&line, ": ");
+        smart_str_appendl(&line, value, value_len);
+        smart_str_0(&line);
+        sp->curl_headers = curl_slist_append(sp->curl_headers, ZSTR_VAL(line.s));
+        ZSTR_LEN(line.s) = 0;
+    }
+    if (!host) {
+        const char *authority;
+        size_t authority_len;
+        if (!r->preserve_host || !qp_px_field_find(&sp->req_fields, ":authority", 10, &authority, &authority_len)) {
+            authority = ZSTR_VAL(r->up_authority);
+            authority_len = ZSTR_LEN(r->up_authority);
+        }
+        smart_str_appends(&line, "host: ");
+        smart_str_appendl(&line, authority, authority_len);
+        smart_str_0(&line);
+        sp->curl_headers = curl_slist_append(sp->curl_headers, ZSTR_VAL(line.s));
+    }
+    sp->curl_headers = curl_slist_append(sp->curl_headers, "expect:");
+    smart_str_free(&line);
+    smart_str_free(&f.a);
+    curl_easy_setopt(easy, CURLOPT_HTTPHEADER, sp->curl_headers);
+
+    if (curl_multi_add_handle(qp_px.multi, easy) != CURLM_OK) {
+        return false;
+    }
+    qp_px.running++;
+    return true;
+}
+
+static void qp_px_h2_run(void)
+{
+    CURLMsg *msg;
+    int left;
+
+    if (!qp_px.multi || !qp_px.running) {
+        return;
+    }
+    curl_multi_perform(qp_px.multi, &qp_px.running);
+    while ((msg = curl_multi_info_read(qp_px.multi, &left))) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+        qp_px_splice_t *sp = NULL;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&sp);
+        if (!sp) {
+            continue;
+        }
+        if (msg->data.result == CURLE_OK && sp->resp_ready) {
+            sp->resp_fin = true;
+        } else {
+            qp_px_fail(sp);
+        }
+    }
+}
+
+/*─────────────────────────────── Splicing ────────────────────────────────*/
+
+/* Takes what the client sent as far as the window has room */
+static void qp_px_pull_request(qp_px_splice_t *sp)
+{
+    quicpro_session_t *s = sp->pc->s;
+    if (sp->req_off == sp->req_len) {
+        sp->req_off = sp->req_len = 0;
+    }
+    while (sp->req_len < sizeof(sp->req)) {
+        ssize_t n = quiche_h3_recv_body(s->h3, s->conn, sp->sid, sp->req + sp->req_len, sizeof(sp->req) - sp->req_len);
+        if (n <= 0) {
+            break;
+        }
+        sp->req_len += (size_t)n;
+    }
+}
+
+static void qp_px_pump_request(qp_px_splice_t *sp)
+{
+    if (sp->req_fin_sent) {
+        return;
+    }
+    if (sp->easy) {
+        qp_px_pull_request(sp);
+        if (sp->upload_paused && (sp->req_len > sp->req_off || sp->req_fin)) {
+            sp->upload_paused = false;
+            qp_px_curl_pause(sp);
+        }
+        return;
+    }
+    if (!sp->up) {
+        return;
+    }
+    if (sp->up_sid < 0) {
+        qp_px_pull_request(sp);     /* Buffered while the connection is set up */
+        qp_px_h3_send_request(sp);
+        if (sp->up_sid < 0 || sp->req_fin_sent) {
+            return;
+        }
+    }
+    quicpro_session_t *u = sp->up->s;
+    for (;;) {
+        if (sp->req_off == sp->req_len) {
+            qp_px_pull_request(sp);
+            if (sp->req_off == sp->req_len) {
+                break;
+            }
+        }
+        ssize_t sent = quiche_h3_send_body(u->h3, u->conn, (uint64_t)sp->up_sid, sp->req + sp->req_off, sp->req_len - sp->req_off, false);
+        if (sent <= 0) {
+            break;
+        }
+        sp->req_off += (size_t)sent;
+        if (sp->req_off < sp->req_len) {
+            break;
+        }
+    }
+    if (sp->req_fin && sp->req_off == sp->req_len
+        && quiche_h3_send_body(u->h3, u->conn, (uint64_t)sp->up_sid, NULL, 0, true) >= 0) {
+        sp->req_fin_sent = true;
+    }
+}
+
+static void qp_px_pump_response(qp_px_splice_t *sp)
+{
+    quicpro_session_t *s = sp->pc->s;
+    if (!sp->resp_ready) {
+        return;
+    }
+    if (!sp->resp_started) {
+        quiche_h3_header *h = qp_px_field_array(&sp->resp_fields);
+        int rc = quiche_h3_send_response(s->h3, s->conn, sp->sid, h, sp->resp_fields.n, false);
+        efree(h);
+        if (rc == QUICHE_H3_ERR_STREAM_BLOCKED) {
+            return;
+        }
+        if (rc < 0) {
+            sp->done = true;    /* The client's stream is gone */
+            return;
+        }
+        sp->resp_started = true;
+    }
+    for (;;) {
+        if (sp->resp_off == sp->resp_len) {
+            sp->resp_off = sp->resp_len = 0;
+            if (sp->easy || !sp->up) {
+                break;
+            }
+            quicpro_session_t *u = sp->up->s;
+            ssize_t n = quiche_h3_recv_body(u->h3, u->conn, (uint64_t)sp->up_sid, sp->resp, sizeof(sp->resp));
+            if (n <= 0) {
+                break;
+            }
+            sp->resp_len = (size_t)n;
+        }
+        ssize_t sent = quiche_h3_send_body(s->h3, s->conn, sp->sid, sp->resp + sp->resp_off, sp->resp_len - sp->resp_off, false);
+        if (sent < 0 && sent != QUICHE_H3_ERR_DONE) {
+            sp->done = true;
+            return;
+        }
+        if (sent <= 0) {
+            break;
+        }
+        sp->resp_off += (size_t)sent;
+        if (sp->resp_off < sp->resp_len) {
+            break;
+        }
+    }
+    if (sp->easy && sp->download_paused && sp->resp_off == sp->resp_len) {
+        sp->download_paused = false;
+        qp_px_curl_pause(sp);
+    }
+    if (sp->resp_fin && sp->resp_off == sp->resp_len && quiche_h3_send_body(s->h3, s->conn, sp->sid, NULL, 0, true) >= 0) {
+        qp_px_stop_request(sp);
+        sp->done = true;
+    }
+}
+
+static void qp_px_pump(qp_px_splice_t *sp)
+{
+    if (!sp->done) {
+        qp_px_pump_request(sp);
+    }
+    if (!sp->done) {
+        qp_px_pump_response(sp);
+    }
+}
+
+/* Routes a complete request head and starts its upstream request */
+static void qp_px_open(qp_px_splice_t *sp)
+{
+    sp->route = qp_px_match(&sp->req_fields);
+    if (!sp->route) {
+        qp_px_answer(sp, "404");
+        return;
+    }
+    QUICPRO_WORKER_STAT(requests);
+    if (sp->route->kind == QP_PX_H3) {
+        sp->up = qp_px_up_get(sp->route);
+        if (!sp->up) {
+            qp_px_fail(sp);
+        }
+    } else if (!qp_px_h2_start(sp)) {
+        qp_px_fail(sp);
+    }
+}
+
+/* The client connection's events; returns the requests it routed */
+static zend_long qp_px_poll_client(quicpro_proxy_conn_t *pc)
+{
+    quicpro_session_t *s = pc->s;
+    quiche_h3_event *ev;
+    int64_t sid;
+    zend_long routed = 0;
+
+    while ((sid = quicpro_prof_h3_conn_poll(s->h3, s->conn, &ev)) >= 0) {
+        qp_px_splice_t *sp = zend_hash_index_find_ptr(&pc->streams, (zend_ulong)sid);
+        switch (quiche_h3_event_type(ev)) {
+            case QUICHE_H3_EVENT_HEADERS:
+                if (!sp) {
+                    /* A later HEADERS on a known stream is trailers, which are not forwarded */
+                    sp = emalloc(sizeof(*sp));
+                    memset(sp, 0, offsetof(qp_px_splice_t, req));
+                    sp->pc = pc;
+                    sp->sid = (uint64_t)sid;
+                    sp->up_sid = -1;
+                    zend_hash_index_add_new_ptr(&pc->streams, (zend_ulong)sid, sp);
+                    quiche_h3_event_for_each_header(ev, qp_px_on_header, &sp->req_fields);
+                    sp->req_body = quiche_h3_event_headers_has_more_frames(ev);
+                    sp->req_fin = !sp->req_body;
+                    /* The response goes out at the client's priority; an update sent ahead of the request wins */
+                    const char *prio_value;
+                    size_t prio_len;
+                    sp->prio = QUICPRO_PRIORITY_DEFAULT;
+                    if (qp_px_field_find(&sp->req_fields, "priority", sizeof("priority")-1, &prio_value, &prio_len)) {
+                        quicpro_priority_parse(prio_value, prio_len, &sp->prio);
+                    }
+                    quicpro_priority_take_update(s->h3, sp->sid, &sp->prio);
+                    quicpro_priority_apply_quic(s->conn, sp->sid, sp->prio);
+                    QUICPRO_WORKER_STAT(streams);
+                    qp_px_open(sp);
+                    routed++;
+                }
+                break;
+            case QUICHE_H3_EVENT_DATA:
+                if (sp) {
+                    qp_px_pump(sp);
+                }
+                break;
+            case QUICHE_H3_EVENT_FINISHED:
+                if (sp) {
+                    sp->req_fin = true;
+                    qp_px_pump(sp);
+                }
+                break;
+            case QUICHE_H3_EVENT_RESET:
+                if (sp) {
+                    sp->req_fin = true;
+                    sp->done = true;
+                }
+                break;
+            case QUICHE_H3_EVENT_PRIORITY_UPDATE:
+                /* Before its request, the update waits in quiche for the HEADERS above */
+                if (sp && quicpro_priority_take_update(s->h3, sp->sid, &sp->prio)) {
+                    quicpro_priority_apply_quic(s->conn, sp->sid, sp->prio);
+                }
+                break;
+            default:
+                break;
+        }
+        quiche_h3_event_free(ev);
+    }
+    return routed;
+}
+
+/* Pumps every splice of the connection and drops the finished ones */
+static void qp_px_conn_pump(quicpro_proxy_conn_t *pc)
+{
+    zend_ulong sid;
+    qp_px_splice_t *sp;
+    ZEND_HASH_FOREACH_NUM_KEY_PTR(&pc->streams, sid, sp) {
+        qp_px_pump(sp);
+        if (sp->done) {
+            zend_hash_index_del(&pc->streams, sid);
+        }
+    } ZEND_HASH_FOREACH_END();
+}
+
+/* The upstream connection's events */
+static void qp_px_poll_upstream(qp_px_up_t *up)
+{
+    quicpro_session_t *u = up->s;
+    quiche_h3_event *ev;
+    int64_t sid;
+
+    quicpro_session_pump_rx(u);
+    if (quiche_conn_timeout_as_millis(u->conn) == 0) {
+        quiche_conn_on_timeout(u->conn);
+    }
+    while ((sid = quicpro_prof_h3_conn_poll(u->h3, u->conn, &ev)) >= 0) {
+        qp_px_splice_t *sp = zend_hash_index_find_ptr(&up->streams, (zend_ulong)sid);
+        if (!sp) {
+            if (quiche_h3_event_type(ev) == QUICHE_H3_EVENT_GOAWAY) {
+                up->goaway = true;
+            }
+            /* A pooled connection's other users: multiplexed requests and, through them, MCP calls */
+            if (!quicpro_h3_mux_dispatch(u, ev, (uint64_t)sid)) {
+                quiche_h3_event_free(ev);
+            }
+            continue;
+        }
+        switch (quiche_h3_event_type(ev)) {
+            case QUICHE_H3_EVENT_HEADERS:
+                if (!sp->resp_ready) {
+                    quiche_h3_event_for_each_header(ev, qp_px_on_header, &sp->resp_fields);
+                    sp->resp_ready = true;
+                }
+                qp_px_pump_response(sp);
+                break;
+            case QUICHE_H3_EVENT_DATA:
+                qp_px_pump_response(sp);
+                break;
+            case QUICHE_H3_EVENT_FINISHED:
+                sp->resp_fin = true;
+                qp_px_pump_response(sp);
+                break;
+            case QUICHE_H3_EVENT_RESET:
+                sp->resp_fin = true;    /* Nothing to cancel upstream any more */
+                qp_px_fail(sp);
+                break;
+            default:
+                break;
+        }
+        quiche_h3_event_free(ev);
+    }
+}
+
+/*──────────────────────────────── Driving ────────────────────────────────*/
+
+static void qp_px_conn_unlink(quicpro_proxy_conn_t *pc)
+{
+    if (pc->prev) pc->prev->next = pc->next;
+    else qp_px.conns = pc->next;
+    if (pc->next) pc->next->prev = pc->prev;
+}
+
+void quicpro_proxy_conn_free(quicpro_proxy_conn_t *pc)
+{
+    if (!pc) {
+        return;
+    }
+    zend_hash_destroy(&pc->streams);
+    qp_px_conn_unlink(pc);
+    pc->s->proxy = NULL;
+    efree(pc);
+}
+
+bool quicpro_proxy_conn_idle(const quicpro_proxy_conn_t *pc)
+{
+    return zend_hash_num_elements(&pc->streams) == 0;
+}
+
+/* Sends what the upstreams were given, and lets go of closed ones */
+static void qp_px_flush_upstreams(void)
+{
+    for (qp_px_up_t **link = &qp_px.ups; *link; ) {
+        qp_px_up_t *up = *link;
+        if (qp_px_up_alive(up)) {
+            quicpro_session_pump_tx(up->s);
+            link = &up->next;
+            continue;
+        }
+        /* Its requests fail; no splice points at it afterwards */
+        for (quicpro_proxy_conn_t *pc = qp_px.conns; pc; pc = pc->next) {
+            qp_px_splice_t *sp;
+            ZEND_HASH_FOREACH_PTR(&pc->streams, sp) {
+                if (sp->up == up) {
+                    if (sp->up_sid >= 0) {
+                        zend_hash_index_del(&up->streams, (zend_ulong)sp->up_sid);
+                    }
+                    sp->up = NULL;
+                    sp->up_sid = -1;
+                    qp_px_fail(sp);
+                }
+            } ZEND_HASH_FOREACH_END();
+        }
+        *link = up->next;
+        qp_px_up_free(up);
+    }
+}
+
+void quicpro_proxy_tick(int epoll_fd)
+{
+    if (epoll_fd != qp_px.epoll_fd) {
+        /* Another listener: its epoll set has none of our sockets yet */
+        qp_px.epoll_fd = epoll_fd;
+        for (qp_px_up_t *up = qp_px.ups; up; up = up->next) {
+            up->watched = false;
+            qp_px_up_watch(up);
+        }
+    }
+    if (!qp_px.conns && !qp_px.ups && !qp_px.running) {
+        return;
+    }
+    for (qp_px_up_t *up = qp_px.ups; up; up = up->next) {
+        if (qp_px_up_alive(up)) {
+            qp_px_poll_upstream(up);
+        }
+    }
+    qp_px_h2_run();
+    for (quicpro_proxy_conn_t *pc = qp_px.conns; pc; pc = pc->next) {
+        qp_px_conn_pump(pc);
+    }
+    qp_px_h2_run();     /* Unpaused transfers move on now, not a round later */
+    qp_px_flush_upstreams();
+}
+
+bool quicpro_proxy_busy(void)
+{
+    return qp_px.conns || qp_px.ups || qp_px.running;
+}
+
+PHP_FUNCTION(quicpro_proxy_serve)
+{
+    zval *z_session_res;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_RESOURCE(z_session_res)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = (quicpro_session_t *)zend_fetch_resource_ex(z_session_res, "Quicpro Session", le_quicpro_session);
+    if (!s || !s->conn) {
+        zend_value_error("Invalid or closed session resource");
+        RETURN_THROWS();
+    }
+    if (!s->h3) {
+        s->h3_cfg = quiche_h3_config_new();
+        if (s->h3_cfg) {
+            quicpro_h3_settings_apply(s->h3_cfg);
+            s->h3 = quiche_h3_conn_new_with_transport(s->conn, s->h3_cfg);
+        }
+        if (!s->h3) {
+            zend_throw_exception(NULL, "Failed to initialize HTTP/3 on the connection", 0);
+            RETURN_THROWS();
+        }
+    }
+    if (!s->proxy) {
+        quicpro_proxy_conn_t *pc = ecalloc(1, sizeof(*pc));
+        pc->s = s;
+        zend_hash_init(&pc->streams, 8, NULL, qp_px_splice_dtor, 0);
+        pc->next = qp_px.conns;
+        if (qp_px.conns) qp_px.conns->prev = pc;
+        qp_px.conns = pc;
+        s->proxy = pc;
+    }
+
+    zend_long routed = qp_px_poll_client(s->proxy);
+    qp_px_conn_pump(s->proxy);
+    qp_px_h2_run();
+    qp_px_flush_upstreams();   /* New requests leave now, not at the next tick */
+    RETURN_LONG(routed);
+}
+
+void quicpro_proxy_rshutdown(void)
+{
+    while (qp_px.conns) {
+        quicpro_proxy_conn_free(qp_px.conns);
+    }
+    while (qp_px.ups) {
+        qp_px_up_t *up = qp_px.ups;
+        qp_px.ups = up->next;
+        qp_px_up_free(up);
+    }
+    if (qp_px.multi) {
+        curl_multi_cleanup(qp_px.multi);
+        qp_px.multi = NULL;
+        qp_px.running = 0;
+    }
+    if (qp_px.routes) {
+        zend_hash_destroy(qp_px.routes);
+        FREE_HASHTABLE(qp_px.routes);
+        qp_px.routes = NULL;
+    }
+    qp_px.epoll_fd = -1;
+}
@@ -0,0 +1,404 @@
+/*
+ * src/server/qlog.c – Sampled qlog events in a binary ring
+ * ========================================================
+ *
+ * See include/server/qlog.h. The ring has one writer, the thread running
+ * the server loop. A reader copies the records it wants and then checks
+ * the head again: any record the writer may have reached meanwhile is
+ * dropped from the copy, so no lock is needed on either side.
+ */
+
+#include "php_quicpro.h"
+#include "server/qlog.h"
+#include "config/quic_transport/base_layer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef enum {
+    QP_QLOG_CONN_STARTED = 1,           /* a: peer port, b: local port, c: 1 for IPv6 */
+    QP_QLOG_HANDSHAKE_COMPLETED,
+    QP_QLOG_PACKETS_RECEIVED,           /* a: packets, b: bytes */
+    QP_QLOG_PACKETS_SENT,               /* a: packets, b: bytes */
+    QP_QLOG_PACKETS_LOST,               /* a: packets, b: bytes */
+    QP_QLOG_PACKETS_RETRANSMITTED,      /* a: packets */
+    QP_QLOG_METRICS_UPDATED,            /* a: smoothed RTT, b: min RTT, c: RTT variance (ns), d: cwnd, e: delivery rate */
+    QP_QLOG_CONN_CLOSED                 /* a: 0 local, 1 remote, 2 neither (idle); b: 1 for an application code; c: code */
+} qp_qlog_type_t;
+
+typedef struct {
+    uint64_t time_us;                   /* CLOCK_REALTIME */
+    uint64_t group;
+    uint16_t type;                      /* qp_qlog_type_t */
+    uint8_t  pad[6];
+    uint64_t a, b, c, d, e;
+} qp_qlog_record_t;
+
+/* What a dump starts with; host byte order, like the records */
+typedef struct {
+    char     magic[8];                  /* QUICPRO_QLOG_MAGIC */
+    uint32_t record_size;
+    uint32_t pid;
+    uint64_t count;
+    uint64_t overwritten;               /* Records lost to the ring wrapping */
+} qp_qlog_dump_header_t;
+
+_Static_assert(sizeof(qp_qlog_record_t) == 64, "qlog records are one cache line");
+
+static qp_qlog_record_t *quicpro_qlog_ring = NULL;
+static uint64_t          quicpro_qlog_mask;
+static _Atomic uint64_t  quicpro_qlog_head = 0;
+static uint64_t          quicpro_qlog_rng = 0;
+
+static uint64_t quicpro_qlog_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/* xorshift64*: sampling needs no more, and no syscall per connection */
+static double quicpro_qlog_random(void)
+{
+    if (!quicpro_qlog_rng) {
+        quicpro_qlog_rng = quicpro_qlog_now_us() ^ ((uint64_t)getpid() << 32) ^ 0x9e3779b97f4a7c15ULL;
+    }
+    quicpro_qlog_rng ^= quicpro_qlog_rng >> 12;
+    quicpro_qlog_rng ^= quicpro_qlog_rng << 25;
+    quicpro_qlog_rng ^= quicpro_qlog_rng >> 27;
+    return (double)((quicpro_qlog_rng * 0x2545f4914f6cdd1dULL) >> 11) * 0x1.0p-53;
+}
+
+static bool quicpro_qlog_ring_ready(void)
+{
+    if (quicpro_qlog_ring) {
+        return true;
+    }
+    uint64_t n = 1;
+    while (n < (uint64_t)quicpro_quic_transport_config.qlog_ring_events && n < (UINT64_C(1) << 24)) {
+        n <<= 1;
+    }
+    quicpro_qlog_ring = pecalloc(n, sizeof(qp_qlog_record_t), 1);
+    quicpro_qlog_mask = n - 1;
+    atomic_store_explicit(&quicpro_qlog_head, 0, memory_order_relaxed);
+    return true;
+}
+
+static void quicpro_qlog_emit(uint64_t group, qp_qlog_type_t type, uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t e)
+{
+    uint64_t head = atomic_load_explicit(&quicpro_qlog_head, memory_order_relaxed);
+    qp_qlog_record_t *r = &quicpro_qlog_ring[head & quicpro_qlog_mask];
+    r->time_us = quicpro_qlog_now_us();
+    r->group = group;
+    r->type = (uint16_t)type;
+    r->a = a;
+    r->b = b;
+    r->c = c;
+    r->d = d;
+    r->e = e;
+    atomic_store_explicit(&quicpro_qlog_head, head + 1, memory_order_release);
+}
+
+static uint16_t quicpro_qlog_port(const struct sockaddr_storage *ss)
+{
+    if (ss->ss_family == AF_INET6) {
+        return ntohs(((const struct sockaddr_in6 *)ss)->sin6_port);
+    }
+    return ss->ss_family == AF_INET ? ntohs(((const struct sockaddr_in *)ss)->sin_port) : 0;
+}
+
+/*──────────────────────────── Recording ──────────────────────────────────*/
+
+void quicpro_qlog_conn_started(quicpro_session_t *session, const uint8_t *scid, size_t scid_len)
+{
+    double ratio = quicpro_quic_transport_config.qlog_sample_ratio;
+    if (ratio <= 0.0 || session->qlog || (ratio < 1.0 && quicpro_qlog_random() >= ratio) || !quicpro_qlog_ring_ready()) {
+        return;
+    }
+    quicpro_qlog_conn_t *q = pecalloc(1, sizeof(*q), 1);
+    memcpy(&q->group, scid, scid_len < sizeof(q->group) ? scid_len : sizeof(q->group));
+    session->qlog = q;
+    quicpro_qlog_emit(q->group, QP_QLOG_CONN_STARTED, quicpro_qlog_port(&session->peer_addr),
+                      quicpro_qlog_port(&session->local_addr), session->peer_addr.ss_family == AF_INET6, 0, 0);
+}
+
+void quicpro_qlog_tick(quicpro_session_t *session)
+{
+    quicpro_qlog_conn_t *q = session->qlog;
+    if (!session->conn) {
+        return;
+    }
+    if (!q->established && quiche_conn_is_established(session->conn)) {
+        q->established = true;
+        quicpro_qlog_emit(q->group, QP_QLOG_HANDSHAKE_COMPLETED, 0, 0, 0, 0, 0);
+    }
+
+    quiche_stats st;
+    quiche_conn_stats(session->conn, &st);
+    if (st.recv != q->recv) {
+        quicpro_qlog_emit(q->group, QP_QLOG_PACKETS_RECEIVED, st.recv - q->recv, st.recv_bytes - q->recv_bytes, 0, 0, 0);
+        q->recv = st.recv;
+        q->recv_bytes = st.recv_bytes;
+    }
+    if (st.sent != q->sent) {
+        quicpro_qlog_emit(q->group, QP_QLOG_PACKETS_SENT, st.sent - q->sent, st.sent_bytes - q->sent_bytes, 0, 0, 0);
+        q->sent = st.sent;
+        q->sent_bytes = st.sent_bytes;
+    }
+    if (st.lost != q->lost) {
+        quicpro_qlog_emit(q->group, QP_QLOG_PACKETS_LOST, st.lost - q->lost, st.lost_bytes - q->lost_bytes, 0, 0, 0);
+        q->lost = st.lost;
+        q->lost_bytes = st.lost_bytes;
+    }
+    if (st.retrans != q->retrans) {
+        quicpro_qlog_emit(q->group, QP_QLOG_PACKETS_RETRANSMITTED, st.retrans - q->retrans, 0, 0, 0, 0);
+        q->retrans = st.retrans;
+    }
+
+    quiche_path_stats ps;
+    if (quiche_conn_path_stats(session->conn, 0, &ps) == 0
+        && (ps.rtt != q->rtt || ps.min_rtt != q->min_rtt || ps.rttvar != q->rttvar || ps.cwnd != q->cwnd)) {
+        quicpro_qlog_emit(q->group, QP_QLOG_METRICS_UPDATED, ps.rtt, ps.min_rtt, ps.rttvar, ps.cwnd, ps.delivery_rate);
+        q->rtt = ps.rtt;
+        q->min_rtt = ps.min_rtt;
+        q->rttvar = ps.rttvar;
+        q->cwnd = ps.cwnd;
+    }
+}
+
+void quicpro_qlog_conn_closed(quicpro_session_t *session)
+{
+    quicpro_qlog_conn_t *q = session->qlog;
+    if (!q) {
+        return;
+    }
+    if (session->conn) {
+        quicpro_qlog_tick(session);
+        bool is_app = false;
+        uint64_t code = 0;
+        const uint8_t *reason;
+        size_t reason_len;
+        uint64_t owner = 2;
+        if (quiche_conn_peer_error(session->conn, &is_app, &code, &reason, &reason_len)) {
+            owner = 1;
+        } else if (quiche_conn_local_error(session->conn, &is_app, &code, &reason, &reason_len)) {
+            owner = 0;
+        }
+        quicpro_qlog_emit(q->group, QP_QLOG_CONN_CLOSED, owner, is_app, code, 0, 0);
+    }
+    pefree(q, 1);
+    session->qlog = NULL;
+}
+
+/*──────────────────────────── Reading ────────────────────────────────────*/
+
+size_t quicpro_qlog_snapshot(char **out)
+{
+    *out = NULL;
+    if (!quicpro_qlog_ring) {
+        return 0;
+    }
+    uint64_t cap = quicpro_qlog_mask + 1;
+    uint64_t head = atomic_load_explicit(&quicpro_qlog_head, memory_order_acquire);
+    uint64_t first = head > cap ? head - cap : 0;
+
+    char *dump = pemalloc(sizeof(qp_qlog_dump_header_t) + (size_t)(head - first) * sizeof(qp_qlog_record_t), 1);
+    qp_qlog_record_t *records = (qp_qlog_record_t *)(dump + sizeof(qp_qlog_dump_header_t));
+    for (uint64_t i = first; i < head; i++) {
+        records[i - first] = quicpro_qlog_ring[i & quicpro_qlog_mask];
+    }
+
+    /* The writer may have overwritten the oldest records while they were copied */
+    uint64_t now = atomic_load_explicit(&quicpro_qlog_head, memory_order_acquire);
+    uint64_t valid = now >= cap ? now - cap + 1 : 0;
+    uint64_t skip = valid > first ? valid - first : 0;
+    if (skip > head - first) {
+        skip = head - first;
+    }
+    if (skip) {
+        memmove(records, records + skip, (size_t)(head - first - skip) * sizeof(qp_qlog_record_t));
+    }
+
+    qp_qlog_dump_header_t hdr = {
+        .record_size = sizeof(qp_qlog_record_t),
+        .pid = (uint32_t)getpid(),
+        .count = head - first - skip,
+        .overwritten = first + skip,
+    };
+    memcpy(hdr.magic, QUICPRO_QLOG_MAGIC, sizeof(hdr.magic));
+    memcpy(dump, &hdr, sizeof(hdr));
+    *out = dump;
+    return sizeof(hdr) + (size_t)hdr.count * sizeof(qp_qlog_record_t);
+}
+
+typedef struct {
+    char  *p;
+    size_t len;
+    size_t cap;
+} qp_qlog_text_t;
+
+static void quicpro_qlog_printf(qp_qlog_text_t *t, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (n <= 0) {
+        return;
+    }
+    if (t->len + (size_t)n + 1 > t->cap) {
+        size_t cap = t->cap ? t->cap : 4096;
+        while (cap < t->len + (size_t)n + 1) {
+            cap *= 2;
+        }
+        t->p = perealloc(t->p, cap, 1);
+        t->cap = cap;
+    }
+    va_start(ap, fmt);
+    vsnprintf(t->p + t->len, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    t->len += (size_t)n;
+}
+
+/* One JSON-SEQ record: RS, the event, LF */
+static void quicpro_qlog_event(qp_qlog_text_t *t, const qp_qlog_record_t *r)
+{
+    quicpro_qlog_printf(t, "\x1e{\"time\":%.3f,\"group_id\":\"%016llx\",", (double)r->time_us / 1000.0,
+                        (unsigned long long)__builtin_bswap64(r->group));
+    unsigned long long a = r->a, b = r->b, c = r->c, d = r->d, e = r->e;
+    switch (r->type) {
+        case QP_QLOG_CONN_STARTED:
+            quicpro_qlog_printf(t, "\"name\":\"connectivity:connection_started\",\"data\":{\"ip_version\":\"%s\",\"src_port\":%llu,\"dst_port\":%llu}}\n",
+                                c ? "ipv6" : "ipv4", a, b);
+            break;
+        case QP_QLOG_HANDSHAKE_COMPLETED:
+            quicpro_qlog_printf(t, "\"name\":\"connectivity:connection_state_updated\",\"data\":{\"new\":\"handshake_completed\"}}\n");
+            break;
+        case QP_QLOG_PACKETS_RECEIVED:
+            quicpro_qlog_printf(t, "\"name\":\"quicpro:packets_received\",\"data\":{\"count\":%llu,\"bytes\":%llu}}\n", a, b);
+            break;
+        case QP_QLOG_PACKETS_SENT:
+            quicpro_qlog_printf(t, "\"name\":\"quicpro:packets_sent\",\"data\":{\"count\":%llu,\"bytes\":%llu}}\n", a, b);
+            break;
+        case QP_QLOG_PACKETS_LOST:
+            quicpro_qlog_printf(t, "\"name\":\"quicpro:packets_lost\",\"data\":{\"count\":%llu,\"bytes\":%llu}}\n", a, b);
+            break;
+        case QP_QLOG_PACKETS_RETRANSMITTED:
+            quicpro_qlog_printf(t, "\"name\":\"quicpro:packets_retransmitted\",\"data\":{\"count\":%llu}}\n", a);
+            break;
+        case QP_QLOG_METRICS_UPDATED:
+            quicpro_qlog_printf(t, "\"name\":\"recovery:metrics_updated\",\"data\":{\"smoothed_rtt\":%.3f,\"min_rtt\":%.3f,"
+                                   "\"rtt_variance\":%.3f,\"congestion_window\":%llu,\"delivery_rate\":%llu}}\n",
+                                (double)a / 1e6, (double)b / 1e6, (double)c / 1e6, d, e);
+            break;
+        case QP_QLOG_CONN_CLOSED:
+            if (a == 2) {
+                quicpro_qlog_printf(t, "\"name\":\"connectivity:connection_closed\",\"data\":{\"trigger\":\"idle_timeout\"}}\n");
+            } else {
+                quicpro_qlog_printf(t, "\"name\":\"connectivity:connection_closed\",\"data\":{\"owner\":\"%s\",\"%s\":%llu}}\n",
+                                    a ? "remote" : "local", b ? "application_code" : "connection_code", c);
+            }
+            break;
+        default:
+            quicpro_qlog_printf(t, "\"name\":\"quicpro:unknown\",\"data\":{\"type\":%u}}\n", (unsigned)r->type);
+            break;
+    }
+}
+
+bool quicpro_qlog_json_seq(const char *dump, size_t len, char **out, size_t *out_len)
+{
+    qp_qlog_dump_header_t hdr;
+    if (len < sizeof(hdr)) {
+        return false;
+    }
+    memcpy(&hdr, dump, sizeof(hdr));
+    if (memcmp(hdr.magic, QUICPRO_QLOG_MAGIC, sizeof(hdr.magic)) != 0 || hdr.record_size != sizeof(qp_qlog_record_t)
+        || hdr.count > (len - sizeof(hdr)) / sizeof(qp_qlog_record_t)) {
+        return false;
+    }
+
+    qp_qlog_text_t t = { 0 };
+    quicpro_qlog_printf(&t, "\x1e{\"qlog_version\":\"0.3\",\"qlog_format\":\"JSON-SEQ\",\"title\":\"quicpro_async worker %u\","
+                            "\"description\":\"%llu earlier events overwritten\",\"trace\":{\"vantage_point\":{\"type\":\"server\"},"
+                            "\"common_fields\":{\"time_format\":\"absolute\"}}}\n",
+                        hdr.pid, (unsigned long long)hdr.overwritten);
+    for (uint64_t i = 0; i < hdr.count; i++) {
+        qp_qlog_record_t r;
+        memcpy(&r, dump + sizeof(hdr) + i * sizeof(r), sizeof(r));
+        quicpro_qlog_event(&t, &r);
+    }
+    *out = t.p;
+    *out_len = t.len;
+    return true;
+}
+
+void quicpro_qlog_mshutdown(void)
+{
+    if (quicpro_qlog_ring) {
+        pefree(quicpro_qlog_ring, 1);
+        quicpro_qlog_ring = NULL;
+    }
+}
+
+/*──────────────────────────── PHP API ────────────────────────────────────*/
+
+PHP_FUNCTION(quicpro_qlog_dump)
+{
+    zend_string *path = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(0, 1)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR_OR_NULL(path)
+    ZEND_PARSE_PARAMETERS_END();
+
+    char *dump;
+    size_t len = quicpro_qlog_snapshot(&dump);
+    if (!path) {
+        RETVAL_STRINGL(dump ? dump : "", len);
+        if (dump) {
+            pefree(dump, 1);
+        }
+        return;
+    }
+
+    FILE *f = fopen(ZSTR_VAL(path), "wb");
+    bool ok = f && fwrite(dump ? dump : "", 1, len, f) == len;
+    if (f && fclose(f) != 0) {
+        ok = false;
+    }
+    if (dump) {
+        pefree(dump, 1);
+    }
+    if (!ok) {
+        php_error_docref(NULL, E_WARNING, "Qlog::dump: cannot write '%s': %s", ZSTR_VAL(path), strerror(errno));
+    }
+    RETURN_BOOL(ok);
+}
+
+PHP_FUNCTION(quicpro_qlog_to_json_seq)
+{
+    zend_string *dump;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(dump)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (ZSTR_LEN(dump) == 0) {
+        RETURN_EMPTY_STRING();
+    }
+    char *text;
+    size_t len;
+    if (!quicpro_qlog_json_seq(ZSTR_VAL(dump), ZSTR_LEN(dump), &text, &len)) {
+        throw_mcp_error_as_php_exception(0, "Qlog::toJsonSeq: the argument is not a qlog dump of this build.");
+        RETURN_FALSE;
+    }
+    RETVAL_STRINGL(text, len);
+    pefree(text, 1);
+}
@@ -0,0 +1,293 @@
+/*
+ * rate_limit.c  –  Cluster-wide token buckets for php-quicpro
+ * ----------------------------------------------------------
+ *
+ * The table is one MAP_SHARED anonymous mapping:
+ *
+ *   header  hash seeds, slot count, pressure level
+ *   slots   nslots x { tag, tat_ns }, probed within a window of
+ *           QP_RL_PROBES slots (two cache lines)
+ *
+ * A bucket is GCRA: `tat_ns` is the CLOCK_MONOTONIC instant at which the
+ * bucket will be full again. Taking `cost` tokens moves it `cost`
+ * emission intervals later. The take is refused when that would put it
+ * more than `burst` intervals ahead of now. A tag is a key's hash with
+ * the low bit set, so 0 means a slot that was never used. A slot whose
+ * tat_ns has passed behaves exactly like an empty one, so another key may
+ * claim it with a CAS on the tag. When a claim races with the old key's
+ * last update, one key is charged a token the other took. That is
+ * tolerable.
+ */
+
+#include "php_quicpro.h"
+#include "server/rate_limit.h"
+#include "server/cid.h"
+#include "cancel.h"
+#include "config/security_and_traffic/base_layer.h"
+
+#include <netinet/in.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#define QP_RL_PROBES 8
+
+enum { QP_RL_KEY_ADDR = 0, QP_RL_KEY_APP = 1 };
+
+typedef struct {
+    _Atomic uint64_t tag;
+    _Atomic uint64_t tat_ns;
+} quicpro_rate_limit_slot_t;
+
+typedef struct {
+    uint64_t seed[2];                   /* One per key namespace */
+    uint64_t nslots;                    /* Power of two */
+    _Atomic uint32_t pressure;          /* Set by the supervisor: rate and burst >> pressure */
+    _Alignas(64) quicpro_rate_limit_slot_t slots[];
+} quicpro_rate_limit_table_t;
+
+static quicpro_rate_limit_table_t *quicpro_rate_limit_table = NULL;
+static size_t quicpro_rate_limit_table_size = 0;
+
+static inline uint64_t quicpro_rate_limit_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t quicpro_rate_limit_mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t quicpro_rate_limit_hash(uint64_t seed, const uint8_t *p, size_t len)
+{
+    uint64_t h = seed ^ ((uint64_t)len * 0x9e3779b97f4a7c15ULL);
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = quicpro_rate_limit_mix(h ^ w);
+        p += 8;
+        len -= 8;
+    }
+    uint64_t w = 0;
+    memcpy(&w, p, len);
+    return quicpro_rate_limit_mix(h ^ w);
+}
+
+static inline bool quicpro_rate_limit_enabled(void)
+{
+    return quicpro_security_config.rate_limiter_enable && quicpro_security_config.rate_limiter_requests_per_sec > 0;
+}
+
+/*──────────────────────────── Table lifecycle ────────────────────────────*/
+
+void quicpro_rate_limit_prepare(void)
+{
+    if (quicpro_rate_limit_table || !quicpro_rate_limit_enabled()) {
+        return;
+    }
+
+    uint64_t nslots = QP_RL_PROBES;
+    while (nslots < (uint64_t)quicpro_security_config.rate_limiter_table_size) {
+        nslots <<= 1;
+    }
+    size_t size = sizeof(quicpro_rate_limit_table_t) + nslots * sizeof(quicpro_rate_limit_slot_t);
+
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        php_error_docref(NULL, E_WARNING, "Rate limiter table unavailable (%zu bytes); requests are not rate-limited", size);
+        return;
+    }
+
+    quicpro_rate_limit_table_t *t = mem;
+    t->nslots = nslots;
+    if (quicpro_cid_random_bytes((uint8_t *)t->seed, sizeof(t->seed)) < 0) {
+        munmap(mem, size);
+        return;
+    }
+
+    quicpro_rate_limit_table = t;
+    quicpro_rate_limit_table_size = size;
+}
+
+void quicpro_rate_limit_release(void)
+{
+    if (quicpro_rate_limit_table) {
+        munmap(quicpro_rate_limit_table, quicpro_rate_limit_table_size);
+        quicpro_rate_limit_table = NULL;
+        quicpro_rate_limit_table_size = 0;
+    }
+}
+
+/*──────────────────────────── Checks ─────────────────────────────────────*/
+
+/* The emission interval and the burst, under the current pressure */
+static void quicpro_rate_limit_params(uint64_t *interval, uint64_t *burst)
+{
+    unsigned shift = atomic_load_explicit(&quicpro_rate_limit_table->pressure, memory_order_relaxed);
+    *interval = (1000000000ULL / (uint64_t)quicpro_security_config.rate_limiter_requests_per_sec) << shift;
+    *burst = quicpro_security_config.rate_limiter_burst > 0 ? (uint64_t)quicpro_security_config.rate_limiter_burst >> shift : 0;
+    if (*interval == 0) {
+        *interval = 1;
+    }
+    if (*burst == 0) {
+        *burst = 1;
+    }
+}
+
+/* One GCRA step on a slot this key holds; false if over the limit */
+static bool quicpro_rate_limit_take(_Atomic uint64_t *tat_ns, uint64_t now, uint64_t cost)
+{
+    uint64_t interval, burst;
+    quicpro_rate_limit_params(&interval, &burst);
+    uint64_t limit = now + burst * interval;
+
+    uint64_t tat = atomic_load_explicit(tat_ns, memory_order_relaxed);
+    for (;;) {
+        uint64_t next = (tat > now ? tat : now) + cost * interval;
+        if (next > limit) {
+            return false;
+        }
+        if (atomic_compare_exchange_weak_explicit(tat_ns, &tat, next, memory_order_relaxed, memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+/* The slot `key` holds, or one it claims in its probe window; NULL if every one is in use */
+static quicpro_rate_limit_slot_t *quicpro_rate_limit_find(quicpro_rate_limit_table_t *t, unsigned ns, const void *key, size_t len, uint64_t now)
+{
+    uint64_t h = quicpro_rate_limit_hash(t->seed[ns], key, len);
+    uint64_t tag = h | 1;
+    uint64_t mask = t->nslots - 1;
+    uint64_t base = (h >> 32) & mask & ~(uint64_t)(QP_RL_PROBES - 1);
+    quicpro_rate_limit_slot_t *free_slot = NULL;
+    uint64_t free_tag = 0;
+
+    for (uint64_t i = 0; i < QP_RL_PROBES; i++) {
+        quicpro_rate_limit_slot_t *slot = &t->slots[base + i];
+        uint64_t cur = atomic_load_explicit(&slot->tag, memory_order_relaxed);
+        if (cur == tag) {
+            return slot;
+        }
+        if (!free_slot && (cur == 0 || atomic_load_explicit(&slot->tat_ns, memory_order_relaxed) <= now)) {
+            free_slot = slot;
+            free_tag = cur;
+        }
+    }
+    if (!free_slot) {
+        return NULL;
+    }
+    if (!atomic_compare_exchange_strong_explicit(&free_slot->tag, &free_tag, tag, memory_order_relaxed, memory_order_relaxed)
+        && free_tag != tag) {
+        return NULL;    /* Another key claimed it first */
+    }
+    return free_slot;
+}
+
+static bool quicpro_rate_limit_check_key(unsigned ns, const void *key, size_t len, uint32_t cost)
+{
+    if (!quicpro_rate_limit_enabled()) {
+        return true;
+    }
+    /* Outside a cluster nobody prepared the table; a private one still limits this process. */
+    quicpro_rate_limit_prepare();
+    quicpro_rate_limit_table_t *t = quicpro_rate_limit_table;
+    if (!t) {
+        return true;
+    }
+
+    uint64_t now = quicpro_rate_limit_now_ns();
+    quicpro_rate_limit_slot_t *slot = quicpro_rate_limit_find(t, ns, key, len, now);
+    if (!slot) {
+        return true;    /* Fail open: the table is too small for the keys in flight */
+    }
+    return quicpro_rate_limit_take(&slot->tat_ns, now, cost);
+}
+
+bool quicpro_rate_limit_admit(const void *key, size_t len, uint32_t cost)
+{
+    return quicpro_rate_limit_check_key(QP_RL_KEY_APP, key, len, cost);
+}
+
+bool quicpro_rate_limit_set(const void *key, size_t len, uint64_t block_ms)
+{
+    if (!quicpro_rate_limit_enabled()) {
+        return false;
+    }
+    quicpro_rate_limit_prepare();
+    quicpro_rate_limit_table_t *t = quicpro_rate_limit_table;
+    if (!t) {
+        return false;
+    }
+
+    uint64_t now = quicpro_rate_limit_now_ns();
+    quicpro_rate_limit_slot_t *slot = quicpro_rate_limit_find(t, QP_RL_KEY_APP, key, len, now);
+    if (!slot) {
+        return false;
+    }
+    uint64_t tat = 0;
+    if (block_ms) {
+        uint64_t interval, burst;
+        quicpro_rate_limit_params(&interval, &burst);
+        tat = now + burst * interval + block_ms * 1000000ULL;   /* Every take overshoots the limit until then */
+    }
+    atomic_store_explicit(&slot->tat_ns, tat, memory_order_relaxed);
+    return true;
+}
+
+bool quicpro_rate_limit_admit_addr(const struct sockaddr *addr)
+{
+    if (!addr) {
+        return true;
+    }
+    if (addr->sa_family == AF_INET) {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)addr;
+        return quicpro_rate_limit_check_key(QP_RL_KEY_ADDR, &in->sin_addr, 4, 1);
+    }
+    if (addr->sa_family == AF_INET6) {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)addr;
+        if (IN6_IS_ADDR_V4MAPPED(&in6->sin6_addr)) {
+            return quicpro_rate_limit_check_key(QP_RL_KEY_ADDR, in6->sin6_addr.s6_addr + 12, 4, 1);
+        }
+        return quicpro_rate_limit_check_key(QP_RL_KEY_ADDR, in6->sin6_addr.s6_addr, 8, 1);   /* The /64 */
+    }
+    return true;
+}
+
+void quicpro_rate_limit_set_pressure(unsigned level)
+{
+    if (quicpro_rate_limit_table) {
+        if (level > QUICPRO_RATE_LIMIT_MAX_PRESSURE) {
+            level = QUICPRO_RATE_LIMIT_MAX_PRESSURE;
+        }
+        atomic_store_explicit(&quicpro_rate_limit_table->pressure, level, memory_order_relaxed);
+    }
+}
+
+/*──────────────────────────── PHP API ────────────────────────────────────*/
+
+PHP_FUNCTION(quicpro_rate_limit_check)
+{
+    zend_string *key;
+    zend_long cost = 1;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_STR(key)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(cost)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (cost < 0 || cost > UINT32_MAX) {
+        throw_mcp_error_as_php_exception(0, "RateLimiter::check: cost must be between 0 and %u.", UINT32_MAX);
+        RETURN_FALSE;
+    }
+    RETURN_BOOL(quicpro_rate_limit_admit(ZSTR_VAL(key), ZSTR_LEN(key), (uint32_t)cost));
+}
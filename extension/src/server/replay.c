@@ -0,0 +1,608 @@
+/*
+ * replay.c  –  In-process trace replay for php-quicpro listeners
+ * -----------------------------------------------------------------------
+ *
+ * The trace is parsed once into records (time, connection, stream, fin and
+ * a slice of one shared byte buffer), linked per trace connection. Every
+ * client walks the records of its trace connection: at speed 0 it writes
+ * them as fast as flow control allows, otherwise once they are due. A
+ * write quiche only partly accepts is continued in a later round.
+ *
+ * Clients are numbered; client i replays trace connection i % n in loop
+ * i / n and lives at fd00::<i>, so the listener's datagrams find their
+ * client from the address alone.
+ *
+ * A request is a client-initiated bidirectional stream. Its latency runs
+ * from its first write to the FIN of the response. A client closes its
+ * connection once every record is written and every request answered.
+ */
+
+#include "php_quicpro.h"
+#include "server/replay.h"
+#include "server/cid.h"
+#include "config/quic_transport/base_layer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <zend_exceptions.h>
+
+#define QP_RP_DGRAM 1500
+#define QP_RP_READ  65536
+
+typedef struct {
+    uint64_t t_us;
+    uint32_t conn;              /* Dense trace connection index */
+    uint32_t next;              /* Next record of that connection, or UINT32_MAX */
+    uint64_t stream;
+    bool     fin;
+    size_t   off, len;          /* Into rp->data */
+} qp_rp_record_t;
+
+typedef struct {
+    quiche_conn        *conn;
+    struct sockaddr_in6 addr;
+    uint32_t            rec;            /* Next record to write, or UINT32_MAX */
+    size_t              written;        /* Of that record */
+    uint64_t            start_us;       /* Relative to the replay start */
+    uint64_t            first_t_us;     /* Of its trace connection */
+    HashTable           pending;        /* Stream id => first write, us */
+    bool                closing, finished;
+} qp_rp_client_t;
+
+struct quicpro_replay {
+    qp_rp_record_t      *recs;
+    uint32_t             nrecs;
+    uint8_t             *data;
+    uint32_t            *conn_first;    /* First record of each trace connection */
+    uint32_t             nconns;
+    uint64_t             span_us;       /* Of the trace */
+
+    qp_rp_client_t      *clients;
+    uint32_t             nclients, next_client, active, done;
+    quiche_config       *config;
+    struct sockaddr_storage server_addr;
+    socklen_t            server_addr_len;
+    char                 server_name[256];
+
+    double               speed;
+    zend_long            max_connections, timeout_ms;
+    uint64_t             start_us;
+    struct rusage        ru_start;
+    bool                 moved;         /* A datagram went either way since the last step */
+
+    uint64_t             requests, responses, resets, failed;
+    uint64_t             rx, tx, rx_bytes, response_bytes, stream_bytes;   /* rx, tx: of the listener */
+    uint32_t            *lat_us;
+    size_t               nlat, lat_cap;
+};
+
+static uint64_t qp_rp_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static int qp_rp_hex(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/*  Parses the whole trace; on error throws and returns false. */
+static bool qp_rp_parse(quicpro_replay_t *rp, const char *path, const char *p, size_t size)
+{
+    const char *end = p + size;
+    HashTable labels;                   /* Trace label => dense index */
+    uint32_t cap = 0, line = 0, *conn_last = NULL;
+    size_t data_len = 0;
+    uint64_t t0 = 0;
+    bool ok = false;
+
+    zend_hash_init(&labels, 16, NULL, NULL, 0);
+    rp->data = emalloc(size / 2 + 1);   /* Hex halves, so the bytes always fit */
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        line++;
+        while (p < eol && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        if (p == eol || *p == '#') {
+            p = eol + 1;
+            continue;
+        }
+
+        char *q;
+        uint64_t t = strtoull(p, &q, 10);
+        zend_ulong label = strtoull(q, &q, 10);
+        uint64_t stream = strtoull(q, &q, 10);
+        unsigned long fin = strtoul(q, &q, 10);
+        while (q < eol && (*q == ' ' || *q == '\t')) q++;
+        if (q >= eol || fin > 1) {
+            zend_throw_exception_ex(NULL, 0, "Replay trace %s, line %u: expected <t_us> <conn> <stream_id> <fin> <hex>", path, line);
+            goto out;
+        }
+
+        size_t off = data_len;
+        if (*q == '-') {
+            q++;
+        } else {
+            while (q + 1 < eol && qp_rp_hex(q[0]) >= 0 && qp_rp_hex(q[1]) >= 0) {
+                rp->data[data_len++] = (uint8_t)(qp_rp_hex(q[0]) << 4 | qp_rp_hex(q[1]));
+                q += 2;
+            }
+        }
+        while (q < eol && (*q == ' ' || *q == '\t' || *q == '\r')) q++;
+        if (q != eol) {
+            zend_throw_exception_ex(NULL, 0, "Replay trace %s, line %u: stream data is not hex", path, line);
+            goto out;
+        }
+
+        zval *idx = zend_hash_index_find(&labels, label);
+        uint32_t conn;
+        if (idx) {
+            conn = (uint32_t)Z_LVAL_P(idx);
+        } else {
+            zval zv;
+            conn = rp->nconns++;
+            ZVAL_LONG(&zv, conn);
+            zend_hash_index_add_new(&labels, label, &zv);
+            rp->conn_first = safe_erealloc(rp->conn_first, rp->nconns, sizeof(uint32_t), 0);
+            conn_last = safe_erealloc(conn_last, rp->nconns, sizeof(uint32_t), 0);
+            rp->conn_first[conn] = rp->nrecs;
+            conn_last[conn] = UINT32_MAX;
+        }
+
+        if (rp->nrecs == cap) {
+            cap = cap ? cap * 2 : 1024;
+            rp->recs = safe_erealloc(rp->recs, cap, sizeof(qp_rp_record_t), 0);
+        }
+        if (rp->nrecs == 0) t0 = t;
+        qp_rp_record_t *r = &rp->recs[rp->nrecs];
+        r->t_us = t > t0 ? t - t0 : 0;
+        r->conn = conn;
+        r->next = UINT32_MAX;
+        r->stream = stream;
+        r->fin = fin == 1;
+        r->off = off;
+        r->len = data_len - off;
+        if (conn_last[conn] != UINT32_MAX) {
+            rp->recs[conn_last[conn]].next = rp->nrecs;
+        }
+        conn_last[conn] = rp->nrecs++;
+        if (r->t_us > rp->span_us) rp->span_us = r->t_us;
+
+        p = eol + 1;
+    }
+
+    if (rp->nrecs == 0) {
+        zend_throw_exception_ex(NULL, 0, "Replay trace %s holds no stream data", path);
+        goto out;
+    }
+    ok = true;
+out:
+    if (conn_last) efree(conn_last);
+    zend_hash_destroy(&labels);
+    return ok;
+}
+
+static bool qp_rp_options(quicpro_replay_t *rp, HashTable *options, const char **alpn)
+{
+    zval *zv;
+
+    rp->max_connections = 64;
+    rp->timeout_ms = 10000;
+    *alpn = "h3";
+    strcpy(rp->server_name, "localhost");
+    if (!options) {
+        return true;
+    }
+    if ((zv = zend_hash_str_find(options, ZEND_STRL("speed")))) {
+        rp->speed = zval_get_double(zv);
+        if (!(rp->speed >= 0)) {
+            zend_argument_value_error(4, "option 'speed' must be 0 or greater");
+            return false;
+        }
+    }
+    if ((zv = zend_hash_str_find(options, ZEND_STRL("loops")))) {
+        zend_long loops = zval_get_long(zv);
+        if (loops < 1 || (uint64_t)loops * rp->nconns > UINT32_MAX / 2) {
+            zend_argument_value_error(4, "option 'loops' must be between 1 and %u", (unsigned)(UINT32_MAX / 2 / rp->nconns));
+            return false;
+        }
+        rp->nclients = (uint32_t)loops * rp->nconns;
+    }
+    if ((zv = zend_hash_str_find(options, ZEND_STRL("max_connections")))) {
+        rp->max_connections = zval_get_long(zv);
+        if (rp->max_connections < 1) {
+            zend_argument_value_error(4, "option 'max_connections' must be greater than 0");
+            return false;
+        }
+    }
+    if ((zv = zend_hash_str_find(options, ZEND_STRL("timeout_ms")))) {
+        rp->timeout_ms = zval_get_long(zv);
+        if (rp->timeout_ms < 1) {
+            zend_argument_value_error(4, "option 'timeout_ms' must be greater than 0");
+            return false;
+        }
+    }
+    if ((zv = zend_hash_str_find(options, ZEND_STRL("alpn"))) && Z_TYPE_P(zv) == IS_STRING) {
+        if (Z_STRLEN_P(zv) == 0 || Z_STRLEN_P(zv) > 255) {
+            zend_argument_value_error(4, "option 'alpn' must be 1 to 255 bytes");
+            return false;
+        }
+        *alpn = Z_STRVAL_P(zv);
+    }
+    if ((zv = zend_hash_str_find(options, ZEND_STRL("server_name"))) && Z_TYPE_P(zv) == IS_STRING) {
+        if (Z_STRLEN_P(zv) >= sizeof(rp->server_name)) {
+            zend_argument_value_error(4, "option 'server_name' is too long");
+            return false;
+        }
+        memcpy(rp->server_name, Z_STRVAL_P(zv), Z_STRLEN_P(zv) + 1);
+    }
+    return true;
+}
+
+quicpro_replay_t *quicpro_replay_open(const char *path, const struct sockaddr *server_addr,
+                                      socklen_t server_addr_len, HashTable *options)
+{
+    php_stream *stream = php_stream_open_wrapper((char *)path, "rb", REPORT_ERRORS, NULL);
+    if (!stream) {
+        zend_throw_exception_ex(NULL, 0, "Cannot open replay trace %s", path);
+        return NULL;
+    }
+    zend_string *trace = php_stream_copy_to_mem(stream, PHP_STREAM_COPY_ALL, 0);
+    php_stream_close(stream);
+
+    quicpro_replay_t *rp = ecalloc(1, sizeof(*rp));
+    const char *alpn;
+    bool ok = trace && qp_rp_parse(rp, path, ZSTR_VAL(trace), ZSTR_LEN(trace));
+    if (trace) zend_string_release(trace);
+    if (!trace && !EG(exception)) {
+        zend_throw_exception_ex(NULL, 0, "Replay trace %s is empty", path);
+    }
+    rp->nclients = rp->nconns;
+    if (!ok || !qp_rp_options(rp, options, &alpn)) {
+        quicpro_replay_free(rp);
+        return NULL;
+    }
+
+    memcpy(&rp->server_addr, server_addr, server_addr_len);
+    rp->server_addr_len = server_addr_len;
+
+    /* The client: generous windows, so flow control paces nothing the recording did not */
+    uint8_t protos[256];
+    size_t alpn_len = strlen(alpn);
+    protos[0] = (uint8_t)alpn_len;
+    memcpy(protos + 1, alpn, alpn_len);
+    rp->config = quiche_config_new(QUICHE_PROTOCOL_VERSION);
+    if (!rp->config) {
+        zend_throw_exception(NULL, "Failed to create the replay clients' QUIC config", 0);
+        quicpro_replay_free(rp);
+        return NULL;
+    }
+    quiche_config_set_application_protos(rp->config, protos, alpn_len + 1);
+    quiche_config_verify_peer(rp->config, false);
+    quiche_config_set_max_idle_timeout(rp->config, (uint64_t)rp->timeout_ms);
+    quiche_config_set_initial_max_data(rp->config, 64 * 1024 * 1024);
+    quiche_config_set_initial_max_stream_data_bidi_local(rp->config, 16 * 1024 * 1024);
+    quiche_config_set_initial_max_stream_data_bidi_remote(rp->config, 1024 * 1024);
+    quiche_config_set_initial_max_stream_data_uni(rp->config, 1024 * 1024);
+    quiche_config_set_initial_max_streams_bidi(rp->config, 128);
+    quiche_config_set_initial_max_streams_uni(rp->config, 128);
+    quiche_config_set_disable_active_migration(rp->config, true);
+
+    rp->clients = safe_emalloc(rp->nclients, sizeof(qp_rp_client_t), 0);
+    memset(rp->clients, 0, (size_t)rp->nclients * sizeof(qp_rp_client_t));
+    for (uint32_t i = 0; i < rp->nclients; i++) {
+        qp_rp_client_t *c = &rp->clients[i];
+        uint32_t tc = i % rp->nconns, loop = i / rp->nconns;
+
+        c->rec = rp->conn_first[tc];
+        c->first_t_us = rp->recs[c->rec].t_us;
+        c->start_us = rp->speed > 0 ? (uint64_t)(((double)loop * (rp->span_us + 1) + c->first_t_us) / rp->speed) : 0;
+        c->addr.sin6_family = AF_INET6;
+        c->addr.sin6_addr.s6_addr[0] = 0xfd;
+        c->addr.sin6_port = htons((uint16_t)(40000 + i % 20000));
+        memcpy(&c->addr.sin6_addr.s6_addr[12], &(uint32_t){ htonl(i) }, 4);
+    }
+
+    rp->lat_cap = 1024;
+    rp->lat_us = safe_emalloc(rp->lat_cap, sizeof(uint32_t), 0);
+    rp->start_us = qp_rp_now_us();
+    getrusage(RUSAGE_SELF, &rp->ru_start);
+    return rp;
+}
+
+static void qp_rp_connect(quicpro_replay_t *rp, qp_rp_client_t *c, uint64_t rel_us)
+{
+    uint8_t scid[QUICHE_MAX_CONN_ID_LEN];
+
+    if (rp->speed == 0) {
+        c->start_us = rel_us;           /* Its timeout runs from here, not from the replay start */
+    }
+    rp->active++;
+    zend_hash_init(&c->pending, 8, NULL, NULL, 0);
+    quicpro_cid_generate(scid, sizeof(scid));
+    c->conn = quiche_connect(rp->server_name, scid, sizeof(scid),
+                             (struct sockaddr *)&c->addr, sizeof(c->addr),
+                             (struct sockaddr *)&rp->server_addr, rp->server_addr_len, rp->config);
+    if (!c->conn) {
+        rp->failed++;
+        c->finished = true;
+        rp->active--;
+        rp->done++;
+        zend_hash_destroy(&c->pending);
+    }
+}
+
+/*  Writes the client's due records until one is not (fully) accepted. */
+static void qp_rp_write(quicpro_replay_t *rp, qp_rp_client_t *c, uint64_t rel_us)
+{
+    while (c->rec != UINT32_MAX) {
+        qp_rp_record_t *r = &rp->recs[c->rec];
+        if (rp->speed > 0 && (double)(r->t_us - c->first_t_us) / rp->speed + c->start_us > rel_us) {
+            return;
+        }
+
+        uint64_t ec = 0;
+        size_t left = r->len - c->written;
+        ssize_t n = quiche_conn_stream_send(c->conn, r->stream, rp->data + r->off + c->written, left, r->fin, &ec);
+        if (n == QUICHE_ERR_DONE || n == QUICHE_ERR_STREAM_LIMIT) {
+            return;                     /* Blocked by flow control or stream credit */
+        }
+        if (n < 0) {
+            rp->resets++;               /* Stopped by the server: skip the rest of this write */
+            n = (ssize_t)left;
+        } else {
+            if ((r->stream & 0x3) == 0 && !zend_hash_index_exists(&c->pending, r->stream)) {
+                zval zv;
+                ZVAL_LONG(&zv, (zend_long)qp_rp_now_us());
+                zend_hash_index_add_new(&c->pending, r->stream, &zv);
+                rp->requests++;
+            }
+            rp->stream_bytes += (uint64_t)n;
+        }
+        c->written += (size_t)n;
+        if (c->written < r->len) {
+            return;
+        }
+        c->written = 0;
+        c->rec = r->next;
+    }
+}
+
+static void qp_rp_latency(quicpro_replay_t *rp, uint64_t us)
+{
+    if (rp->nlat == rp->lat_cap) {
+        rp->lat_cap *= 2;
+        rp->lat_us = safe_erealloc(rp->lat_us, rp->lat_cap, sizeof(uint32_t), 0);
+    }
+    rp->lat_us[rp->nlat++] = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+static void qp_rp_read(quicpro_replay_t *rp, qp_rp_client_t *c)
+{
+    static uint8_t buf[QP_RP_READ];
+    quiche_stream_iter *it = quiche_conn_readable(c->conn);
+    uint64_t id;
+
+    while (quiche_stream_iter_next(it, &id)) {
+        for (;;) {
+            bool fin = false;
+            uint64_t ec = 0;
+            ssize_t n = quiche_conn_stream_recv(c->conn, id, buf, sizeof(buf), &fin, &ec);
+            if (n < 0 && n != QUICHE_ERR_DONE) {
+                if (zend_hash_index_del(&c->pending, id) == SUCCESS) {
+                    rp->resets++;       /* Reset by the server: the request is over, unanswered */
+                }
+                break;
+            }
+            if (n > 0) {
+                rp->response_bytes += (uint64_t)n;
+            }
+            if (fin) {
+                zval *sent = zend_hash_index_find(&c->pending, id);
+                if (sent) {
+                    qp_rp_latency(rp, qp_rp_now_us() - (uint64_t)Z_LVAL_P(sent));
+                    zend_hash_index_del(&c->pending, id);
+                    rp->responses++;
+                }
+                break;
+            }
+            if (n == QUICHE_ERR_DONE) {
+                break;
+            }
+        }
+    }
+    quiche_stream_iter_free(it);
+}
+
+bool quicpro_replay_step(quicpro_replay_t *rp, quicpro_udp_dgram_cb rx, void *ctx)
+{
+    static uint8_t out[QP_RP_DGRAM];
+
+    if (!rp->moved) {
+        /* Nothing moved last round: only timers and due records are left, nap briefly */
+        struct timespec nap = { 0, 100000 };
+        nanosleep(&nap, NULL);
+    }
+    rp->moved = false;
+
+    uint64_t rel_us = qp_rp_now_us() - rp->start_us;
+    while (rp->next_client < rp->nclients) {
+        qp_rp_client_t *c = &rp->clients[rp->next_client];
+        bool due = rp->speed > 0 ? c->start_us <= rel_us : rp->active < (uint32_t)rp->max_connections;
+        if (!due) break;
+        rp->next_client++;
+        qp_rp_connect(rp, c, rel_us);
+    }
+
+    for (uint32_t i = 0; i < rp->next_client; i++) {
+        qp_rp_client_t *c = &rp->clients[i];
+        if (c->finished) continue;
+
+        if (quiche_conn_timeout_as_nanos(c->conn) == 0) {
+            quiche_conn_on_timeout(c->conn);
+        }
+        if (quiche_conn_is_established(c->conn) && !c->closing) {
+            qp_rp_write(rp, c, rel_us);
+            qp_rp_read(rp, c);
+            if (c->rec == UINT32_MAX && zend_hash_num_elements(&c->pending) == 0) {
+                quiche_conn_close(c->conn, true, 0x100 /* H3_NO_ERROR */, NULL, 0);
+                c->closing = true;
+            }
+        }
+        if (!c->closing && rel_us - c->start_us > (uint64_t)rp->timeout_ms * 1000) {
+            quiche_conn_close(c->conn, false, 0x0, NULL, 0);
+            c->closing = true;
+            rp->failed++;
+        }
+
+        quiche_send_info si;
+        ssize_t n;
+        while ((n = quiche_conn_send(c->conn, out, sizeof(out), &si)) > 0) {
+            rp->rx++;
+            rp->rx_bytes += (uint64_t)n;
+            rp->moved = true;
+            rx(ctx, out, (size_t)n, (struct sockaddr *)&c->addr, sizeof(c->addr), NULL);
+        }
+
+        if (quiche_conn_is_closed(c->conn)) {
+            if (!c->closing) {
+                rp->failed++;           /* Closed by the server or by its idle timer */
+            }
+            zend_hash_destroy(&c->pending);
+            quiche_conn_free(c->conn);
+            c->conn = NULL;
+            c->finished = true;
+            rp->active--;
+            rp->done++;
+        }
+    }
+    return rp->done < rp->nclients;
+}
+
+void quicpro_replay_deliver(quicpro_replay_t *rp, quicpro_session_t *s)
+{
+    static uint8_t out[QUICPRO_UDP_PAYLOAD_MAX];
+    quiche_send_info si;
+    ssize_t n;
+
+    while ((n = quiche_conn_send(s->conn, out, sizeof(out), &si)) > 0) {
+        const struct sockaddr_in6 *to = (const struct sockaddr_in6 *)&si.to;
+        uint32_t i;
+        memcpy(&i, &to->sin6_addr.s6_addr[12], 4);
+        i = ntohl(i);
+        if (to->sin6_family != AF_INET6 || i >= rp->next_client || rp->clients[i].finished) {
+            continue;                   /* Its client is gone: lost on the wire, as it were */
+        }
+
+        qp_rp_client_t *c = &rp->clients[i];
+        quiche_recv_info ri = {
+            .from = (struct sockaddr *)&rp->server_addr, .from_len = rp->server_addr_len,
+            .to = (struct sockaddr *)&c->addr, .to_len = sizeof(c->addr),
+        };
+        rp->tx++;
+        rp->moved = true;
+        quiche_conn_recv(c->conn, out, (size_t)n, &ri);
+    }
+}
+
+static int qp_rp_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double qp_rp_ms(const struct timeval *a, const struct timeval *b)
+{
+    return (double)(b->tv_sec - a->tv_sec) * 1e3 + (double)(b->tv_usec - a->tv_usec) / 1e3;
+}
+
+void quicpro_replay_results(quicpro_replay_t *rp, zval *return_value)
+{
+    struct rusage ru;
+    zval lat;
+    double elapsed_ms = (double)(qp_rp_now_us() - rp->start_us) / 1e3;
+
+    getrusage(RUSAGE_SELF, &ru);
+    array_init(return_value);
+    add_assoc_long(return_value, "connections", (zend_long)rp->nclients);
+    add_assoc_long(return_value, "failed", (zend_long)rp->failed);
+    add_assoc_long(return_value, "requests", (zend_long)rp->requests);
+    add_assoc_long(return_value, "responses", (zend_long)rp->responses);
+    add_assoc_long(return_value, "resets", (zend_long)rp->resets);
+    add_assoc_long(return_value, "stream_bytes", (zend_long)rp->stream_bytes);
+    add_assoc_long(return_value, "response_bytes", (zend_long)rp->response_bytes);
+    add_assoc_long(return_value, "datagrams_in", (zend_long)rp->rx);
+    add_assoc_long(return_value, "datagrams_out", (zend_long)rp->tx);
+    add_assoc_long(return_value, "bytes_in", (zend_long)rp->rx_bytes);
+    add_assoc_double(return_value, "elapsed_ms", elapsed_ms);
+    add_assoc_double(return_value, "cpu_user_ms", qp_rp_ms(&rp->ru_start.ru_utime, &ru.ru_utime));
+    add_assoc_double(return_value, "cpu_sys_ms", qp_rp_ms(&rp->ru_start.ru_stime, &ru.ru_stime));
+    add_assoc_double(return_value, "rps", elapsed_ms > 0 ? (double)rp->responses * 1e3 / elapsed_ms : 0.0);
+
+    qsort(rp->lat_us, rp->nlat, sizeof(uint32_t), qp_rp_cmp);
+    array_init(&lat);
+    static const struct { const char *name; double q; } qs[] = {
+        { "p50", 0.50 }, { "p90", 0.90 }, { "p99", 0.99 }, { "p99.9", 0.999 }, { "max", 1.0 },
+    };
+    for (size_t i = 0; i < sizeof(qs) / sizeof(qs[0]); i++) {
+        size_t at = rp->nlat ? (size_t)(qs[i].q * (double)(rp->nlat - 1) + 0.5) : 0;
+        add_assoc_long(&lat, qs[i].name, rp->nlat ? (zend_long)rp->lat_us[at] : 0);
+    }
+    add_assoc_zval(return_value, "latency_us", &lat);
+}
+
+void quicpro_replay_free(quicpro_replay_t *rp)
+{
+    if (!rp) return;
+    for (uint32_t i = 0; rp->clients && i < rp->next_client; i++) {
+        if (rp->clients[i].conn) {
+            quiche_conn_free(rp->clients[i].conn);
+            zend_hash_destroy(&rp->clients[i].pending);
+        }
+    }
+    if (rp->config) quiche_config_free(rp->config);
+    if (rp->clients) efree(rp->clients);
+    if (rp->recs) efree(rp->recs);
+    if (rp->data) efree(rp->data);
+    if (rp->conn_first) efree(rp->conn_first);
+    if (rp->lat_us) efree(rp->lat_us);
+    efree(rp);
+}
+
+/*  SSLKEYLOGFILE, read once per process */
+static const char *qp_rp_keylog_path(void)
+{
+    static const char *path;
+    static bool looked;
+    if (!looked) {
+        const char *env = getenv("SSLKEYLOGFILE");
+        path = env && *env ? env : NULL;
+        looked = true;
+    }
+    return path;
+}
+
+void quicpro_replay_keylog_config(quiche_config *config)
+{
+    if (qp_rp_keylog_path()) {
+        quiche_config_log_keys(config);
+    }
+}
+
+void quicpro_replay_keylog_conn(quiche_conn *conn)
+{
+    const char *path = qp_rp_keylog_path();
+    if (path && !quiche_conn_set_keylog_path(conn, path)) {
+        php_error_docref(NULL, E_WARNING, "Cannot write TLS keys to SSLKEYLOGFILE %s", path);
+    }
+}
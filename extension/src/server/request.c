@@ -0,0 +1,604 @@
+/*
+ * request.c  –  Pooled, lazily materialised Quicpro\Request objects for php-quicpro
+ * ---------------------------------------------------------------------------------
+ *
+ * While attached, an object only reads through its view. Every accessor
+ * that needs a zval or zend_string creates it on first use and keeps it
+ * until reset, so asking twice costs nothing extra. Detaching forces the
+ * lazy parts, after which the view is not consulted again. A spooled
+ * body is the exception: the object reads it through its own descriptor,
+ * attached or not, and never forces it into memory itself.
+ */
+
+#include "php_quicpro.h"
+#include "php_quicpro_arginfo.h"
+#include "server/request.h"
+#include "server/header_template.h"
+#include "cluster/cluster_stats.h"
+
+#include <zend_exceptions.h>
+#include <zend_interfaces.h>
+#include <zend_smart_str.h>
+#include <ext/spl/spl_exceptions.h>
+#include <php_streams.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+typedef struct {
+    quicpro_request_view_t view;
+    bool                   attached;
+    zend_string           *method;     /* NULL until asked for */
+    zend_string           *uri;
+    zend_string           *body;
+    int                    body_fd;    /* A spooled body: a duplicate the object owns; -1 if none */
+    uint64_t               body_fd_len;
+    zval                   headers;    /* UNDEF until asked for */
+    zend_object            std;
+} quicpro_request_object;
+
+zend_class_entry *quicpro_ce_request;
+static zend_object_handlers quicpro_request_handlers;
+
+static inline quicpro_request_object *request_from_obj(zend_object *obj)
+{
+    return (quicpro_request_object *)((char *)obj - XtOffsetOf(quicpro_request_object, std));
+}
+
+#define THIS_REQUEST() request_from_obj(Z_OBJ_P(ZEND_THIS))
+
+/*──────────────────────────── Lazy fields ────────────────────────────────*/
+
+static zend_string *lazy_string(zend_string **slot, const char *p, size_t len)
+{
+    if (!*slot) {
+        *slot = len ? zend_string_init(p, len, 0) : ZSTR_EMPTY_ALLOC();
+    }
+    return *slot;
+}
+
+static zend_string *request_method(quicpro_request_object *r)
+{
+    return lazy_string(&r->method, r->view.method, r->view.method_len);
+}
+
+static zend_string *request_uri(quicpro_request_object *r)
+{
+    return lazy_string(&r->uri, r->view.uri, r->view.uri_len);
+}
+
+/* The spooled body read whole, as body() has to */
+static zend_string *read_spooled_body(quicpro_request_object *r)
+{
+    if (r->body_fd_len == 0) {
+        return ZSTR_EMPTY_ALLOC();
+    }
+    zend_string *body = zend_string_safe_alloc(1, (size_t)r->body_fd_len, 0, 0);
+    size_t done = 0;
+    while (done < r->body_fd_len) {
+        ssize_t n = pread(r->body_fd, ZSTR_VAL(body) + done, (size_t)r->body_fd_len - done, (off_t)done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            php_error_docref(NULL, E_WARNING, "Cannot read the spooled request body: %s", n < 0 ? strerror(errno) : "truncated");
+            break;
+        }
+        done += (size_t)n;
+    }
+    ZSTR_LEN(body) = done;
+    ZSTR_VAL(body)[done] = '\0';
+    return body;
+}
+
+static zend_string *request_body(quicpro_request_object *r)
+{
+    if (!r->body && r->body_fd >= 0) {
+        r->body = read_spooled_body(r);
+    }
+    return lazy_string(&r->body, r->view.body, r->view.body_len);
+}
+
+static bool request_has_body(quicpro_request_object *r)
+{
+    if (r->body) return ZSTR_LEN(r->body) > 0;
+    return r->body_fd >= 0 ? r->body_fd_len > 0 : r->view.body_len > 0;
+}
+
+/* A descriptor of the spooled body with a file offset of its own, at 0 */
+static int spooled_body_reader(quicpro_request_object *r)
+{
+    char proc[32];
+    snprintf(proc, sizeof(proc), "/proc/self/fd/%d", r->body_fd);
+    int fd = open(proc, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 && (fd = fcntl(r->body_fd, F_DUPFD_CLOEXEC, 0)) >= 0) {
+        lseek(fd, 0, SEEK_SET); /* No /proc: the offset is shared with other duplicates */
+    }
+    return fd;
+}
+
+/* HTTP/1 header views to an array with lower-cased names (interned when well-known) */
+static void materialise_h1_headers(quicpro_request_object *r)
+{
+    array_init_size(&r->headers, (uint32_t)r->view.h1_num_headers);
+    for (size_t i = 0; i < r->view.h1_num_headers; i++) {
+        const quicpro_h1_header_t *h = &r->view.h1_headers[i];
+        zend_string *name = quicpro_header_name(h->name, h->name_len);
+
+        zval *prev = zend_hash_find(Z_ARRVAL(r->headers), name);
+        if (prev) {
+            /* RFC 9110 §5.3: repeated fields combine into one list */
+            zend_string *joined = zend_string_concat3(Z_STRVAL_P(prev), Z_STRLEN_P(prev), ", ", 2, h->value, h->value_len);
+            zval_ptr_dtor(prev);
+            ZVAL_STR(prev, joined);
+        } else {
+            zval value;
+            ZVAL_STRINGL(&value, h->value, h->value_len);
+            zend_hash_add_new(Z_ARRVAL(r->headers), name, &value);
+        }
+        zend_string_release(name);
+    }
+}
+
+static zval *request_headers(quicpro_request_object *r)
+{
+    if (Z_TYPE(r->headers) == IS_UNDEF) {
+        if (r->attached && r->view.h1_headers) {
+            materialise_h1_headers(r);
+        } else {
+            array_init(&r->headers);
+        }
+    }
+    return &r->headers;
+}
+
+/* One header by name, without building the array when the views can answer */
+static zend_string *request_header(quicpro_request_object *r, const char *name, size_t name_len)
+{
+    if (Z_TYPE(r->headers) == IS_UNDEF && r->attached && r->view.h1_headers) {
+        const quicpro_h1_header_t *first = NULL;
+        smart_str joined = {0};
+
+        for (size_t i = 0; i < r->view.h1_num_headers; i++) {
+            const quicpro_h1_header_t *h = &r->view.h1_headers[i];
+            if (h->name_len != name_len || strncasecmp(h->name, name, name_len) != 0) {
+                continue;
+            }
+            if (!first) {
+                first = h;
+                continue;
+            }
+            if (!joined.s) {
+                smart_str_appendl(&joined, first->value, first->value_len);
+            }
+            smart_str_appendl(&joined, ", ", 2);
+            smart_str_appendl(&joined, h->value, h->value_len);
+        }
+        if (joined.s) {
+            return smart_str_extract(&joined);
+        }
+        return first ? zend_string_init(first->value, first->value_len, 0) : NULL;
+    }
+
+    zend_string *key = quicpro_header_name(name, name_len);
+    zval *v = zend_hash_find(Z_ARRVAL_P(request_headers(r)), key);
+    zend_string_release(key);
+    return v && Z_TYPE_P(v) == IS_STRING ? zend_string_copy(Z_STR_P(v)) : NULL;
+}
+
+/*──────────────────────────── Life cycle ─────────────────────────────────*/
+
+static void request_reset(quicpro_request_object *r)
+{
+    if (r->method) { zend_string_release(r->method); r->method = NULL; }
+    if (r->uri)    { zend_string_release(r->uri);    r->uri = NULL; }
+    if (r->body)   { zend_string_release(r->body);   r->body = NULL; }
+    if (r->body_fd >= 0) { close(r->body_fd); r->body_fd = -1; }
+    r->body_fd_len = 0;
+    zval_ptr_dtor(&r->headers);
+    ZVAL_UNDEF(&r->headers);
+    memset(&r->view, 0, sizeof(r->view));
+    r->view.protocol = "";
+    r->attached = false;
+}
+
+static zend_object *request_create(zend_class_entry *ce)
+{
+    quicpro_request_object *r = zend_object_alloc(sizeof(quicpro_request_object), ce);
+    zend_object_std_init(&r->std, ce);
+    object_properties_init(&r->std, ce);
+    r->std.handlers = &quicpro_request_handlers;
+
+    r->method = r->uri = r->body = NULL;
+    r->body_fd = -1;
+    r->body_fd_len = 0;
+    ZVAL_UNDEF(&r->headers);
+    memset(&r->view, 0, sizeof(r->view));
+    r->view.protocol = "";
+    r->attached = false;
+    return &r->std;
+}
+
+static void request_free_obj(zend_object *obj)
+{
+    request_reset(request_from_obj(obj));
+    zend_object_std_dtor(obj);
+}
+
+void quicpro_request_pool_init(quicpro_request_pool_t *pool)
+{
+    pool->idle = NULL;
+}
+
+void quicpro_request_pool_free(quicpro_request_pool_t *pool)
+{
+    if (pool->idle) {
+        OBJ_RELEASE(pool->idle);
+        pool->idle = NULL;
+    }
+}
+
+zend_object *quicpro_request_acquire(quicpro_request_pool_t *pool, const quicpro_request_view_t *view)
+{
+    zend_object *obj = pool->idle;
+    pool->idle = NULL;
+    if (!obj) {
+        obj = request_create(quicpro_ce_request);
+    }
+
+    quicpro_request_object *r = request_from_obj(obj);
+    r->view = *view;
+    r->attached = true;
+    QUICPRO_WORKER_STAT(requests);
+    if (view->headers) {
+        ZVAL_COPY(&r->headers, view->headers);
+    }
+    if (view->spool) {
+        /* Ours to keep: the listener closes its own once the callback returned */
+        r->body_fd = fcntl(view->spool->fd, F_DUPFD_CLOEXEC, 0);
+        r->body_fd_len = view->spool->len;
+        if (r->body_fd < 0) {
+            php_error_docref(NULL, E_WARNING, "Cannot hand over the spooled request body: %s", strerror(errno));
+            r->body_fd_len = 0;
+        }
+    }
+    return obj;
+}
+
+void quicpro_request_release(quicpro_request_pool_t *pool, zend_object *obj)
+{
+    quicpro_request_object *r = request_from_obj(obj);
+
+    if (GC_REFCOUNT(obj) > 1) {
+        /* Retained by the handler: copy out of the buffers the view points into */
+        request_method(r);
+        request_uri(r);
+        if (r->body_fd < 0) {
+            request_body(r); /* A spooled one stays where it is */
+        }
+        request_headers(r);
+        r->attached = false;
+        OBJ_RELEASE(obj);
+        return;
+    }
+
+    request_reset(r);
+    if (pool->idle) {
+        OBJ_RELEASE(pool->idle);
+    }
+    pool->idle = obj;
+}
+
+/*──────────────────────────── Methods ────────────────────────────────────*/
+
+PHP_METHOD(QuicRequest, method)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    RETURN_STR_COPY(request_method(THIS_REQUEST()));
+}
+
+PHP_METHOD(QuicRequest, uri)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    RETURN_STR_COPY(request_uri(THIS_REQUEST()));
+}
+
+PHP_METHOD(QuicRequest, protocol)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    RETURN_STRING(THIS_REQUEST()->view.protocol);
+}
+
+PHP_METHOD(QuicRequest, body)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    RETURN_STR_COPY(request_body(THIS_REQUEST()));
+}
+
+PHP_METHOD(QuicRequest, headers)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    RETURN_COPY(request_headers(THIS_REQUEST()));
+}
+
+PHP_METHOD(QuicRequest, header)
+{
+    zend_string *name;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    zend_string *value = request_header(THIS_REQUEST(), ZSTR_VAL(name), ZSTR_LEN(name));
+    if (!value) {
+        RETURN_NULL();
+    }
+    RETURN_STR(value);
+}
+
+/* The body as a readable stream from its start: a spooled one without copying it */
+PHP_METHOD(QuicRequest, bodyStream)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_request_object *r = THIS_REQUEST();
+    php_stream *stream;
+
+    if (r->body_fd >= 0) {
+        int fd = spooled_body_reader(r);
+        if (fd < 0) {
+            php_error_docref(NULL, E_WARNING, "Cannot open the spooled request body: %s", strerror(errno));
+            RETURN_FALSE;
+        }
+        stream = php_stream_fopen_from_fd(fd, "rb", NULL);
+        if (!stream) {
+            close(fd);
+            RETURN_FALSE;
+        }
+    } else {
+        zend_string *body = request_body(r);
+        stream = php_stream_memory_create(TEMP_STREAM_DEFAULT);
+        php_stream_write(stream, ZSTR_VAL(body), ZSTR_LEN(body));
+        php_stream_rewind(stream);
+    }
+    php_stream_to_zval(stream, return_value);
+}
+
+static int64_t write_body_to_fd(int fd, const char *p, size_t len)
+{
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, p + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return (int64_t)done;
+}
+
+/*
+ * Writes the body to `path`, replacing what was there. A local file gets
+ * a spooled body by copy_file_range()/splice(); any other wrapper
+ * (quicpro-fs:// for the object store) through its stream.
+ */
+PHP_METHOD(QuicRequest, saveBody)
+{
+    zend_string *path;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_PATH_STR(path)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_request_object *r = THIS_REQUEST();
+    const char *local = NULL;
+
+    if (php_stream_locate_url_wrapper(ZSTR_VAL(path), &local, 0) == &php_plain_files_wrapper) {
+        if (php_check_open_basedir(local)) {
+            RETURN_FALSE;
+        }
+        int fd = open(local, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (fd < 0) {
+            php_error_docref(NULL, E_WARNING, "Cannot open %s: %s", local, strerror(errno));
+            RETURN_FALSE;
+        }
+        int64_t n;
+        if (r->body_fd >= 0) {
+            n = quicpro_body_spool_copy(r->body_fd, r->body_fd_len, fd);
+        } else {
+            zend_string *body = request_body(r);
+            n = write_body_to_fd(fd, ZSTR_VAL(body), ZSTR_LEN(body));
+        }
+        if (close(fd) < 0) {
+            n = -1; /* Delayed write errors surface here, on NFS for one */
+        }
+        if (n < 0) {
+            php_error_docref(NULL, E_WARNING, "Cannot write the request body to %s: %s", local, strerror(errno));
+            RETURN_FALSE;
+        }
+        RETURN_LONG((zend_long)n);
+    }
+
+    php_stream *out = php_stream_open_wrapper(ZSTR_VAL(path), "wb", REPORT_ERRORS, NULL);
+    if (!out) {
+        RETURN_FALSE;
+    }
+    size_t n = 0;
+    bool ok;
+    if (r->body_fd >= 0) {
+        int fd = spooled_body_reader(r);
+        php_stream *in = fd >= 0 ? php_stream_fopen_from_fd(fd, "rb", NULL) : NULL;
+        if (!in && fd >= 0) {
+            close(fd);
+        }
+        ok = in && php_stream_copy_to_stream_ex(in, out, PHP_STREAM_COPY_ALL, &n) == SUCCESS && n == r->body_fd_len;
+        if (in) {
+            php_stream_close(in);
+        }
+    } else {
+        zend_string *body = request_body(r);
+        n = ZSTR_LEN(body);
+        ok = php_stream_write(out, ZSTR_VAL(body), n) == (ssize_t)n;
+    }
+    /* A quicpro-fs:// object is stored, or fails, on close */
+    php_stream_close(out);
+    if (EG(exception)) {
+        RETURN_THROWS();
+    }
+    if (!ok) {
+        php_error_docref(NULL, E_WARNING, "Cannot write the request body to %s", ZSTR_VAL(path));
+        RETURN_FALSE;
+    }
+    RETURN_LONG((zend_long)n);
+}
+
+/* The array the listeners used to pass: method, uri, protocol, headers and body (if any) */
+PHP_METHOD(QuicRequest, toArray)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_request_object *r = THIS_REQUEST();
+
+    array_init_size(return_value, 5);
+    add_assoc_str(return_value, "method", zend_string_copy(request_method(r)));
+    add_assoc_str(return_value, "uri", zend_string_copy(request_uri(r)));
+    add_assoc_string(return_value, "protocol", (char *)r->view.protocol);
+    Z_TRY_ADDREF_P(request_headers(r));
+    add_assoc_zval(return_value, "headers", request_headers(r));
+    if (ZSTR_LEN(request_body(r))) {
+        add_assoc_str(return_value, "body", zend_string_copy(request_body(r)));
+    }
+}
+
+/*──────────────────────────── ArrayAccess ────────────────────────────────*/
+
+typedef enum { FIELD_HEADER, FIELD_METHOD, FIELD_URI, FIELD_PROTOCOL, FIELD_HEADERS, FIELD_BODY } request_field_t;
+
+static request_field_t request_field(zend_string *key)
+{
+    if (zend_string_equals_literal(key, "method"))   return FIELD_METHOD;
+    if (zend_string_equals_literal(key, "uri"))      return FIELD_URI;
+    if (zend_string_equals_literal(key, "protocol")) return FIELD_PROTOCOL;
+    if (zend_string_equals_literal(key, "headers"))  return FIELD_HEADERS;
+    if (zend_string_equals_literal(key, "body"))     return FIELD_BODY;
+    return FIELD_HEADER;
+}
+
+PHP_METHOD(QuicRequest, offsetExists)
+{
+    zval *offset;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ZVAL(offset)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_request_object *r = THIS_REQUEST();
+    zend_string *key = zval_get_string(offset);
+    bool exists;
+
+    switch (request_field(key)) {
+        case FIELD_BODY:
+            exists = request_has_body(r);
+            break;
+        case FIELD_HEADER: {
+            zend_string *value = request_header(r, ZSTR_VAL(key), ZSTR_LEN(key));
+            exists = value != NULL;
+            if (value) zend_string_release(value);
+            break;
+        }
+        default:
+            exists = true;
+    }
+    zend_string_release(key);
+    RETURN_BOOL(exists);
+}
+
+PHP_METHOD(QuicRequest, offsetGet)
+{
+    zval *offset;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ZVAL(offset)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_request_object *r = THIS_REQUEST();
+    zend_string *key = zval_get_string(offset);
+
+    switch (request_field(key)) {
+        case FIELD_METHOD:   RETVAL_STR_COPY(request_method(r)); break;
+        case FIELD_URI:      RETVAL_STR_COPY(request_uri(r)); break;
+        case FIELD_PROTOCOL: RETVAL_STRING(r->view.protocol); break;
+        case FIELD_HEADERS:  RETVAL_COPY(request_headers(r)); break;
+        case FIELD_BODY:
+            /* Absent, as the array's 'body' key was, when there is none */
+            if (request_has_body(r)) RETVAL_STR_COPY(request_body(r));
+            break;
+        case FIELD_HEADER: {
+            zend_string *value = request_header(r, ZSTR_VAL(key), ZSTR_LEN(key));
+            if (value) RETVAL_STR(value);
+            break;
+        }
+    }
+    zend_string_release(key);
+}
+
+PHP_METHOD(QuicRequest, offsetSet)
+{
+    zval *offset, *value;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_ZVAL(offset)
+        Z_PARAM_ZVAL(value)
+    ZEND_PARSE_PARAMETERS_END();
+
+    zend_throw_exception_ex(spl_ce_LogicException, 0, "Quicpro\\Request is read-only");
+}
+
+PHP_METHOD(QuicRequest, offsetUnset)
+{
+    zval *offset;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ZVAL(offset)
+    ZEND_PARSE_PARAMETERS_END();
+
+    zend_throw_exception_ex(spl_ce_LogicException, 0, "Quicpro\\Request is read-only");
+}
+
+/*──────────────────────────── Registration ───────────────────────────────*/
+
+static const zend_function_entry quicpro_request_methods[] = {
+    PHP_ME(QuicRequest, method,       arginfo_Quicpro_Request_method,       ZEND_ACC_PUBLIC)
+    PHP_ME(QuicRequest, uri,          arginfo_Quicpro_Request_uri,          ZEND_ACC_PUBLIC)
+    PHP_ME(QuicRequest, protocol,     arginfo_Quicpro_Request_protocol,     ZEND_ACC_PUBLIC)
+    PHP_ME(QuicRequest, body,         arginfo_Quicpro_Request_body,         ZEND_ACC_PUBLIC)
+    PHP_ME(QuicRequest, bodyStream,   arginfo_Quicpro_Request_bodyStream,   ZEND_ACC_PUBLIC)
+    PHP_ME(QuicRequest, saveBody,     arginfo_Quicpro_Request_saveBody,     ZEND_ACC_PUBLIC)
+    PHP_ME(QuicRequest, headers,      arginfo_Quicpro_Request_headers,      ZEND_ACC_PUBLIC)
+    PHP_ME(QuicRequest, header,       arginfo_Quicpro_Request_header,       ZEND_ACC_PUBLIC)
+    PHP_ME(QuicRequest, toArray,      arginfo_Quicpro_Request_toArray,      ZEND_ACC_PUBLIC)
+    PHP_ME(QuicRequest, offsetExists, arginfo_Quicpro_Request_offsetExists, ZEND_ACC_PUBLIC)
+    PHP_ME(QuicRequest, offsetGet,    arginfo_Quicpro_Request_offsetGet,    ZEND_ACC_PUBLIC)
+    PHP_ME(QuicRequest, offsetSet,    arginfo_Quicpro_Request_offsetSet,    ZEND_ACC_PUBLIC)
+    PHP_ME(QuicRequest, offsetUnset,  arginfo_Quicpro_Request_offsetUnset,  ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+void quicpro_request_minit(void)
+{
+    zend_class_entry ce;
+    INIT_NS_CLASS_ENTRY(ce, "Quicpro", "Request", quicpro_request_methods);
+    quicpro_ce_request = zend_register_internal_class(&ce);
+    quicpro_ce_request->ce_flags |= ZEND_ACC_FINAL;
+#ifdef ZEND_ACC_NO_DYNAMIC_PROPERTIES
+    /* A pooled object must not carry a handler's state into the next request */
+    quicpro_ce_request->ce_flags |= ZEND_ACC_NO_DYNAMIC_PROPERTIES;
+#endif
+    quicpro_ce_request->create_object = request_create;
+    zend_class_implements(quicpro_ce_request, 1, zend_ce_arrayaccess);
+
+    memcpy(&quicpro_request_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    quicpro_request_handlers.offset = XtOffsetOf(quicpro_request_object, std);
+    quicpro_request_handlers.free_obj = request_free_obj;
+    quicpro_request_handlers.clone_obj = NULL;   /* Views cannot be shared */
+}
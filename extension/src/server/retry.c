@@ -0,0 +1,249 @@
+/*
+ * retry.c  –  Stateless Retry and address-validation tokens for php-quicpro
+ * -------------------------------------------------------------------------
+ *
+ * Token layout (all integers big-endian):
+ *
+ *   0      magic (QP_TOKEN_MAGIC)
+ *   1..8   expiry, CLOCK_MONOTONIC milliseconds
+ *   9      odcid_len
+ *   10..   odcid
+ *   ..+16  HMAC-SHA256(key, bytes above || peer IP || peer port), truncated
+ *
+ * The key is 32 bytes from the CID generator, drawn lazily and again after
+ * fork(), so a token is only valid at the worker that minted it. A listener
+ * thread other than PHP's has it drawn before it starts, so it only reads it.
+ */
+
+#include "php_quicpro.h"
+#include "server/retry.h"
+#include "server/cid.h"
+#include "config/quic_transport/base_layer.h"
+
+#include <netinet/in.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#define QP_TOKEN_MAGIC      0x51
+#define QP_TOKEN_HDR_LEN    10
+#define QP_TOKEN_TAG_LEN    16
+#define QP_RETRY_PKT_MAX    1350
+
+static uint8_t quicpro_retry_key[32];
+static pid_t quicpro_retry_key_pid = 0;
+
+static inline uint64_t quicpro_retry_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+bool quicpro_retry_key_prepare(void)
+{
+    pid_t pid = getpid();
+    if (quicpro_retry_key_pid == pid) {
+        return true;
+    }
+    if (quicpro_cid_random_bytes(quicpro_retry_key, sizeof(quicpro_retry_key)) < 0) {
+        return false;
+    }
+    quicpro_retry_key_pid = pid;
+    return true;
+}
+
+/*──────────────────────────── Tokens ─────────────────────────────────────*/
+
+/* Computes the tag over the token body and the peer's address and port. */
+static bool quicpro_retry_tag(const uint8_t *body, size_t body_len,
+                              const struct sockaddr *peer, socklen_t peer_len,
+                              uint8_t tag[QP_TOKEN_TAG_LEN])
+{
+    uint8_t msg[QUICPRO_RETRY_TOKEN_MAX + 16 + 2];
+    size_t n = body_len;
+    memcpy(msg, body, body_len);
+
+    if (peer->sa_family == AF_INET && peer_len >= (socklen_t)sizeof(struct sockaddr_in)) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)peer;
+        memcpy(msg + n, &sin->sin_addr, 4);
+        n += 4;
+        memcpy(msg + n, &sin->sin_port, 2);
+        n += 2;
+    } else if (peer->sa_family == AF_INET6 && peer_len >= (socklen_t)sizeof(struct sockaddr_in6)) {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)peer;
+        memcpy(msg + n, &sin6->sin6_addr, 16);
+        n += 16;
+        memcpy(msg + n, &sin6->sin6_port, 2);
+        n += 2;
+    } else {
+        return false;
+    }
+
+    uint8_t mac[EVP_MAX_MD_SIZE];
+    unsigned int mac_len = 0;
+    if (!HMAC(EVP_sha256(), quicpro_retry_key, sizeof(quicpro_retry_key), msg, n, mac, &mac_len)) {
+        return false;
+    }
+    memcpy(tag, mac, QP_TOKEN_TAG_LEN);
+    return true;
+}
+
+ssize_t quicpro_retry_token_mint(uint8_t *out, size_t cap, const uint8_t *odcid, size_t odcid_len,
+                                 const struct sockaddr *peer, socklen_t peer_len)
+{
+    size_t body_len = QP_TOKEN_HDR_LEN + odcid_len;
+    if (odcid_len > QUICHE_MAX_CONN_ID_LEN || cap < body_len + QP_TOKEN_TAG_LEN || !quicpro_retry_key_prepare()) {
+        return -1;
+    }
+
+    uint64_t expiry = quicpro_retry_now_ms() + QUICPRO_RETRY_TOKEN_LIFETIME_MS;
+    out[0] = QP_TOKEN_MAGIC;
+    for (int i = 0; i < 8; i++) {
+        out[1 + i] = (uint8_t)(expiry >> (56 - 8 * i));
+    }
+    out[9] = (uint8_t)odcid_len;
+    memcpy(out + QP_TOKEN_HDR_LEN, odcid, odcid_len);
+
+    if (!quicpro_retry_tag(out, body_len, peer, peer_len, out + body_len)) {
+        return -1;
+    }
+    return (ssize_t)(body_len + QP_TOKEN_TAG_LEN);
+}
+
+bool quicpro_retry_token_validate(const uint8_t *token, size_t token_len,
+                                  const struct sockaddr *peer, socklen_t peer_len,
+                                  uint8_t *odcid, size_t *odcid_len)
+{
+    /* Everything that does not need the HMAC is rejected first. */
+    if (token_len < QP_TOKEN_HDR_LEN + QP_TOKEN_TAG_LEN || token[0] != QP_TOKEN_MAGIC) {
+        return false;
+    }
+    size_t cid_len = token[9];
+    size_t body_len = QP_TOKEN_HDR_LEN + cid_len;
+    if (cid_len > QUICHE_MAX_CONN_ID_LEN || token_len != body_len + QP_TOKEN_TAG_LEN) {
+        return false;
+    }
+
+    uint64_t expiry = 0;
+    for (int i = 0; i < 8; i++) {
+        expiry = (expiry << 8) | token[1 + i];
+    }
+    if (expiry < quicpro_retry_now_ms() || quicpro_retry_key_pid != getpid()) {
+        return false;
+    }
+
+    uint8_t tag[QP_TOKEN_TAG_LEN];
+    if (!quicpro_retry_tag(token, body_len, peer, peer_len, tag)
+        || CRYPTO_memcmp(tag, token + body_len, QP_TOKEN_TAG_LEN) != 0) {
+        return false;
+    }
+
+    memcpy(odcid, token + QP_TOKEN_HDR_LEN, cid_len);
+    *odcid_len = cid_len;
+    return true;
+}
+
+/*──────────────────────────── Accept-rate tracking ───────────────────────*/
+
+static void quicpro_retry_roll_window(quicpro_retry_state_t *st, uint64_t now)
+{
+    if (now - st->window_start_ms >= 1000) {
+        /* An idle gap of more than one window resets the rate to zero. */
+        st->last_rate = (now - st->window_start_ms < 2000) ? st->accepts : 0;
+        st->accepts = 0;
+        st->window_start_ms = now;
+    }
+}
+
+void quicpro_retry_note_accept(quicpro_retry_state_t *st)
+{
+    quicpro_retry_roll_window(st, quicpro_retry_now_ms());
+    st->accepts++;
+}
+
+static bool quicpro_retry_in_force(quicpro_retry_state_t *st)
+{
+    if (st->always || quicpro_quic_transport_config.stateless_retry_enable) {
+        return true;
+    }
+    zend_long threshold = quicpro_quic_transport_config.stateless_retry_auto_threshold;
+    if (threshold <= 0) {
+        return false;
+    }
+    quicpro_retry_roll_window(st, quicpro_retry_now_ms());
+    return st->accepts > (uint32_t)threshold || st->last_rate > (uint32_t)threshold;
+}
+
+/*──────────────────────────── Screening ──────────────────────────────────*/
+
+quicpro_retry_verdict_t quicpro_retry_screen(quicpro_retry_state_t *st, int fd,
+                                             const uint8_t *pkt, size_t pkt_len,
+                                             uint32_t version, uint8_t type,
+                                             const uint8_t *scid, size_t scid_len,
+                                             const uint8_t *dcid, size_t dcid_len,
+                                             const uint8_t *token, size_t token_len,
+                                             const struct sockaddr *peer, socklen_t peer_len,
+                                             uint8_t *odcid, size_t *odcid_len)
+{
+    uint8_t out[QP_RETRY_PKT_MAX];
+    *odcid_len = 0;
+
+    // A short header matching no session reports version 0: it must not be negotiated
+    if (pkt_len == 0 || !(pkt[0] & 0x80)) {
+        return QUICPRO_RETRY_DROP;
+    }
+    // Nothing a client may start with is this small; replying would amplify a spoofed sender
+    if (pkt_len < QUICPRO_RETRY_MIN_DATAGRAM) {
+        return QUICPRO_RETRY_DROP;
+    }
+
+    if (!quiche_version_is_supported(version)) {
+        ssize_t n = quiche_negotiate_version(scid, scid_len, dcid, dcid_len, out, sizeof(out));
+        if (n > 0) {
+            sendto(fd, out, (size_t)n, 0, peer, peer_len);
+        }
+        return QUICPRO_RETRY_SENT;
+    }
+
+    // Handshake and 0-RTT packets for no session start nothing and earn no Retry
+    if (type != QUICPRO_RETRY_TYPE_INITIAL) {
+        return QUICPRO_RETRY_DROP;
+    }
+
+    bool in_force = quicpro_retry_in_force(st);
+
+    if (token_len > 0) {
+        if (quicpro_retry_token_validate(token, token_len, peer, peer_len, odcid, odcid_len)) {
+            return QUICPRO_RETRY_ACCEPT;
+        }
+        st->tokens_rejected++;
+        /* Without Retry in force, a stale or foreign token is simply ignored. */
+        return in_force ? QUICPRO_RETRY_DROP : QUICPRO_RETRY_ACCEPT;
+    }
+
+    if (!in_force) {
+        return QUICPRO_RETRY_ACCEPT;
+    }
+
+    uint8_t new_scid[QUICHE_MAX_CONN_ID_LEN];
+    uint8_t tok[QUICPRO_RETRY_TOKEN_MAX];
+    if (quicpro_cid_generate(new_scid, sizeof(new_scid)) < 0) {
+        return QUICPRO_RETRY_DROP;
+    }
+    ssize_t tok_len = quicpro_retry_token_mint(tok, sizeof(tok), dcid, dcid_len, peer, peer_len);
+    if (tok_len < 0) {
+        return QUICPRO_RETRY_DROP;
+    }
+
+    ssize_t n = quiche_retry(scid, scid_len, dcid, dcid_len, new_scid, sizeof(new_scid),
+                             tok, (size_t)tok_len, version, out, sizeof(out));
+    if (n > 0 && sendto(fd, out, (size_t)n, 0, peer, peer_len) == n) {
+        st->retries_sent++;
+    }
+    return QUICPRO_RETRY_SENT;
+}
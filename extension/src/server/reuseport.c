@@ -0,0 +1,295 @@
+/*
+ * reuseport.c  –  SO_REUSEPORT connection-ID steering for php-quicpro
+ * -------------------------------------------------------------------
+ *
+ * The steering program is a couple of dozen hand-assembled eBPF
+ * instructions, loaded with the raw bpf() syscall so the extension does not
+ * need libbpf or a BPF toolchain at build time. For each datagram it:
+ *
+ *   1. locates the DCID (offset 1 in a short header, offset 6 in a long
+ *      header whose DCID has our length),
+ *   2. reads the big-endian worker id from the first two DCID bytes,
+ *   3. calls bpf_sk_select_reuseport(map, &worker_id),
+ *   4. failing that, selects the slot the flow hash picks among the current
+ *      generation's active workers, and returns SK_PASS. The active count
+ *      is read from a one-entry array map the master updates as it scales.
+ *
+ * A failed selection leaves the kernel's hash choice in place, so foreign
+ * or malformed packets never get dropped by the program itself.
+ */
+
+#include "php_quicpro.h"
+#include "server/reuseport.h"
+
+#include <quiche.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+static int quicpro_reuseport_worker = -1;     /* Map slot: worker id in its generation's half */
+static int quicpro_reuseport_workers = 0;
+static int quicpro_reuseport_map_fd = -1;
+static int quicpro_reuseport_prog_fd = -1;
+static int quicpro_reuseport_active_fd = -1; /* ARRAY map: [0] = active workers */
+
+void quicpro_reuseport_bind_worker(int worker_id, unsigned generation)
+{
+    quicpro_reuseport_worker = worker_id + (int)(generation & 1) * quicpro_reuseport_workers;
+}
+
+int quicpro_reuseport_worker_id(void)
+{
+    return quicpro_reuseport_worker;
+}
+
+void quicpro_reuseport_stamp_cid(uint8_t *cid, size_t len)
+{
+    if (quicpro_reuseport_worker < 0 || len < QUICPRO_REUSEPORT_CID_WORKER_BYTES) {
+        return;
+    }
+    cid[0] = (uint8_t)(quicpro_reuseport_worker >> 8);
+    cid[1] = (uint8_t)quicpro_reuseport_worker;
+}
+
+#ifdef __linux__
+
+#include <linux/bpf.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#ifndef SO_ATTACH_REUSEPORT_EBPF
+# define SO_ATTACH_REUSEPORT_EBPF 52
+#endif
+
+/*──────────────────────────── Instruction helpers ────────────────────────*/
+
+#define QP_INSN(c, d, s, o, i) \
+    ((struct bpf_insn){ .code = (c), .dst_reg = (d), .src_reg = (s), .off = (o), .imm = (i) })
+
+#define QP_MOV64_REG(d, s)       QP_INSN(BPF_ALU64 | BPF_MOV | BPF_X, d, s, 0, 0)
+#define QP_MOV64_IMM(d, i)       QP_INSN(BPF_ALU64 | BPF_MOV | BPF_K, d, 0, 0, i)
+#define QP_ALU64_IMM(op, d, i)   QP_INSN(BPF_ALU64 | (op) | BPF_K, d, 0, 0, i)
+#define QP_ALU64_REG(op, d, s)   QP_INSN(BPF_ALU64 | (op) | BPF_X, d, s, 0, 0)
+#define QP_LDX(sz, d, s, o)      QP_INSN(BPF_LDX | (sz) | BPF_MEM, d, s, o, 0)
+#define QP_STX(sz, d, s, o)      QP_INSN(BPF_STX | (sz) | BPF_MEM, d, s, o, 0)
+#define QP_JMP_REG(op, d, s, o)  QP_INSN(BPF_JMP | (op) | BPF_X, d, s, o, 0)
+#define QP_JMP_IMM(op, d, i, o)  QP_INSN(BPF_JMP | (op) | BPF_K, d, 0, o, i)
+#define QP_JA(o)                 QP_INSN(BPF_JMP | BPF_JA, 0, 0, o, 0)
+#define QP_CALL(f)               QP_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, f)
+#define QP_EXIT()                QP_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+
+/* UDP header, then QUIC: flags, version(4), dcid_len(1), dcid... */
+#define QP_UDP_HLEN              8
+#define QP_SHORT_DCID_OFF        (QP_UDP_HLEN + 1)
+#define QP_LONG_DCID_LEN_OFF     (QP_UDP_HLEN + 5)
+#define QP_LONG_DCID_OFF         (QP_UDP_HLEN + 6)
+
+static long quicpro_bpf(int cmd, union bpf_attr *attr)
+{
+    return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+static int quicpro_reuseport_load_prog(int map_fd, int active_fd, int first_slot)
+{
+    /* Jump offsets count instructions after the jump; LD_IMM64 is two slots. */
+    struct bpf_insn insns[] = {
+        /*  0 */ QP_MOV64_REG(BPF_REG_6, BPF_REG_1),
+        /*  1 */ QP_LDX(BPF_DW, BPF_REG_2, BPF_REG_1, offsetof(struct sk_reuseport_md, data)),
+        /*  2 */ QP_LDX(BPF_DW, BPF_REG_3, BPF_REG_1, offsetof(struct sk_reuseport_md, data_end)),
+        /*  3 */ QP_MOV64_REG(BPF_REG_4, BPF_REG_2),
+        /*  4 */ QP_ALU64_IMM(BPF_ADD, BPF_REG_4, QP_LONG_DCID_OFF + QUICPRO_REUSEPORT_CID_WORKER_BYTES),
+        /*  5 */ QP_JMP_REG(BPF_JGT, BPF_REG_4, BPF_REG_3, 21),              /* -> 27 */
+        /*  6 */ QP_LDX(BPF_B, BPF_REG_5, BPF_REG_2, QP_UDP_HLEN),
+        /*  7 */ QP_JMP_IMM(BPF_JSET, BPF_REG_5, 0x80, 2),                   /* -> 10 */
+        /*  8 */ QP_MOV64_IMM(BPF_REG_7, QP_SHORT_DCID_OFF),
+        /*  9 */ QP_JA(3),                                                   /* -> 13 */
+        /* 10 */ QP_LDX(BPF_B, BPF_REG_5, BPF_REG_2, QP_LONG_DCID_LEN_OFF),
+        /* 11 */ QP_JMP_IMM(BPF_JNE, BPF_REG_5, QUICHE_MAX_CONN_ID_LEN, 15),  /* -> 27 */
+        /* 12 */ QP_MOV64_IMM(BPF_REG_7, QP_LONG_DCID_OFF),
+        /* 13 */ QP_ALU64_REG(BPF_ADD, BPF_REG_2, BPF_REG_7),
+        /* 14 */ QP_LDX(BPF_B, BPF_REG_5, BPF_REG_2, 0),
+        /* 15 */ QP_ALU64_IMM(BPF_LSH, BPF_REG_5, 8),
+        /* 16 */ QP_LDX(BPF_B, BPF_REG_0, BPF_REG_2, 1),
+        /* 17 */ QP_ALU64_REG(BPF_OR, BPF_REG_5, BPF_REG_0),
+        /* 18 */ QP_STX(BPF_W, BPF_REG_10, BPF_REG_5, -4),
+        /* 19 */ QP_MOV64_REG(BPF_REG_1, BPF_REG_6),
+        /* 20 */ QP_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_2, BPF_PSEUDO_MAP_FD, 0, map_fd),
+        /* 21 */ QP_INSN(0, 0, 0, 0, 0),
+        /* 22 */ QP_MOV64_REG(BPF_REG_3, BPF_REG_10),
+        /* 23 */ QP_ALU64_IMM(BPF_ADD, BPF_REG_3, -4),
+        /* 24 */ QP_MOV64_IMM(BPF_REG_4, 0),
+        /* 25 */ QP_CALL(BPF_FUNC_sk_select_reuseport),
+        /* 26 */ QP_JMP_IMM(BPF_JEQ, BPF_REG_0, 0, 20),                     /* -> 47 */
+        /* Not a CID we issued, or its worker is gone: pick one of the current generation's active workers */
+        /* 27 */ QP_LDX(BPF_W, BPF_REG_7, BPF_REG_6, offsetof(struct sk_reuseport_md, hash)),
+        /* 28 */ QP_INSN(BPF_ST | BPF_W | BPF_MEM, BPF_REG_10, 0, -8, 0),
+        /* 29 */ QP_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, active_fd),
+        /* 30 */ QP_INSN(0, 0, 0, 0, 0),
+        /* 31 */ QP_MOV64_REG(BPF_REG_2, BPF_REG_10),
+        /* 32 */ QP_ALU64_IMM(BPF_ADD, BPF_REG_2, -8),
+        /* 33 */ QP_CALL(BPF_FUNC_map_lookup_elem),
+        /* 34 */ QP_JMP_IMM(BPF_JEQ, BPF_REG_0, 0, 12),                     /* -> 47 */
+        /* 35 */ QP_LDX(BPF_W, BPF_REG_5, BPF_REG_0, 0),
+        /* 36 */ QP_JMP_IMM(BPF_JEQ, BPF_REG_5, 0, 10),                     /* -> 47 */
+        /* 37 */ QP_ALU64_REG(BPF_MOD, BPF_REG_7, BPF_REG_5),
+        /* 38 */ QP_ALU64_IMM(BPF_ADD, BPF_REG_7, first_slot),
+        /* 39 */ QP_STX(BPF_W, BPF_REG_10, BPF_REG_7, -4),
+        /* 40 */ QP_MOV64_REG(BPF_REG_1, BPF_REG_6),
+        /* 41 */ QP_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_2, BPF_PSEUDO_MAP_FD, 0, map_fd),
+        /* 42 */ QP_INSN(0, 0, 0, 0, 0),
+        /* 43 */ QP_MOV64_REG(BPF_REG_3, BPF_REG_10),
+        /* 44 */ QP_ALU64_IMM(BPF_ADD, BPF_REG_3, -4),
+        /* 45 */ QP_MOV64_IMM(BPF_REG_4, 0),
+        /* 46 */ QP_CALL(BPF_FUNC_sk_select_reuseport),
+        /* 47 */ QP_MOV64_IMM(BPF_REG_0, SK_PASS),
+        /* 48 */ QP_EXIT(),
+    };
+    static const char license[] = "Dual MIT/GPL";
+
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_SK_REUSEPORT;
+    attr.insns     = (uint64_t)(uintptr_t)insns;
+    attr.insn_cnt  = sizeof(insns) / sizeof(insns[0]);
+    attr.license   = (uint64_t)(uintptr_t)license;
+
+    return (int)quicpro_bpf(BPF_PROG_LOAD, &attr);
+}
+
+void quicpro_reuseport_prepare(int num_workers, bool cid_steering)
+{
+    if (quicpro_reuseport_prog_fd >= 0) {
+        return;
+    }
+    quicpro_reuseport_workers = num_workers;
+    if (num_workers < 2 || !cid_steering) {
+        return;
+    }
+    if (2 * num_workers > (1 << (8 * QUICPRO_REUSEPORT_CID_WORKER_BYTES))) {
+        php_error_docref(NULL, E_NOTICE, "Too many workers for connection-ID steering; using hash distribution");
+        return;
+    }
+
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type    = BPF_MAP_TYPE_REUSEPORT_SOCKARRAY;
+    attr.key_size    = sizeof(uint32_t);
+    attr.value_size  = sizeof(uint32_t);
+    attr.max_entries = (uint32_t)(2 * num_workers);   /* Two generations during a reload */
+
+    int map_fd = (int)quicpro_bpf(BPF_MAP_CREATE, &attr);
+    if (map_fd < 0) {
+        php_error_docref(NULL, E_NOTICE, "Connection-ID steering unavailable (map: %s); using hash distribution", strerror(errno));
+        return;
+    }
+
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type    = BPF_MAP_TYPE_ARRAY;
+    attr.key_size    = sizeof(uint32_t);
+    attr.value_size  = sizeof(uint32_t);
+    attr.max_entries = 1;
+    int active_fd = (int)quicpro_bpf(BPF_MAP_CREATE, &attr);
+    if (active_fd < 0) {
+        php_error_docref(NULL, E_NOTICE, "Connection-ID steering unavailable (map: %s); using hash distribution", strerror(errno));
+        close(map_fd);
+        return;
+    }
+
+    int prog_fd = quicpro_reuseport_load_prog(map_fd, active_fd, 0);
+    if (prog_fd < 0) {
+        php_error_docref(NULL, E_NOTICE, "Connection-ID steering unavailable (program: %s); using hash distribution", strerror(errno));
+        close(active_fd);
+        close(map_fd);
+        return;
+    }
+
+    quicpro_reuseport_map_fd    = map_fd;
+    quicpro_reuseport_active_fd = active_fd;
+    quicpro_reuseport_prog_fd   = prog_fd;
+    quicpro_reuseport_set_active(num_workers);
+}
+
+void quicpro_reuseport_set_active(int active_workers)
+{
+    if (quicpro_reuseport_active_fd < 0) {
+        return;
+    }
+    uint32_t key = 0;
+    uint32_t value = (uint32_t)active_workers;
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = (uint32_t)quicpro_reuseport_active_fd;
+    attr.key    = (uint64_t)(uintptr_t)&key;
+    attr.value  = (uint64_t)(uintptr_t)&value;
+    attr.flags  = BPF_ANY;
+    if (quicpro_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0) {
+        php_error_docref(NULL, E_WARNING, "Cannot steer new connections to %d workers: %s", active_workers, strerror(errno));
+    }
+}
+
+void quicpro_reuseport_set_generation(unsigned generation)
+{
+    if (quicpro_reuseport_prog_fd < 0) {
+        return;
+    }
+    int n = quicpro_reuseport_workers;
+    int prog_fd = quicpro_reuseport_load_prog(quicpro_reuseport_map_fd, quicpro_reuseport_active_fd, (int)(generation & 1) * n);
+    if (prog_fd < 0) {
+        /* The old program keeps steering new connections to the old generation's slots */
+        php_error_docref(NULL, E_WARNING, "Cannot steer new connections to the reloaded workers: %s", strerror(errno));
+        return;
+    }
+    close(quicpro_reuseport_prog_fd);
+    quicpro_reuseport_prog_fd = prog_fd;
+}
+
+void quicpro_reuseport_release(void)
+{
+    if (quicpro_reuseport_prog_fd >= 0) {
+        close(quicpro_reuseport_prog_fd);
+        quicpro_reuseport_prog_fd = -1;
+    }
+    if (quicpro_reuseport_map_fd >= 0) {
+        close(quicpro_reuseport_map_fd);
+        quicpro_reuseport_map_fd = -1;
+    }
+    if (quicpro_reuseport_active_fd >= 0) {
+        close(quicpro_reuseport_active_fd);
+        quicpro_reuseport_active_fd = -1;
+    }
+}
+
+int quicpro_reuseport_attach(int fd)
+{
+    if (quicpro_reuseport_prog_fd < 0 || quicpro_reuseport_worker < 0) {
+        return 0;
+    }
+
+    /* The program belongs to the whole group; every worker re-attaches the same one. */
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_EBPF,
+                   &quicpro_reuseport_prog_fd, sizeof(quicpro_reuseport_prog_fd)) < 0) {
+        return -1;
+    }
+
+    uint32_t key = (uint32_t)quicpro_reuseport_worker;
+    uint32_t value = (uint32_t)fd;
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = (uint32_t)quicpro_reuseport_map_fd;
+    attr.key    = (uint64_t)(uintptr_t)&key;
+    attr.value  = (uint64_t)(uintptr_t)&value;
+    attr.flags  = BPF_ANY;   /* A restarted worker replaces its predecessor's slot */
+
+    return quicpro_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0 ? -1 : 0;
+}
+
+#else /* !__linux__ */
+
+void quicpro_reuseport_prepare(int num_workers, bool cid_steering) { (void)cid_steering; quicpro_reuseport_workers = num_workers; }
+void quicpro_reuseport_set_generation(unsigned generation) { (void)generation; }
+void quicpro_reuseport_set_active(int active_workers) { (void)active_workers; }
+void quicpro_reuseport_release(void) {}
+int quicpro_reuseport_attach(int fd) { (void)fd; return 0; }
+
+#endif
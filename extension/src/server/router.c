@@ -0,0 +1,1004 @@
+/*
+ * src/server/router.c – Stateless QUIC router tier
+ * ================================================
+ *
+ * See include/server/router.h. The keys of the CID obfuscation, the
+ * relay tags and the DCID hash all come from SHA-256 of
+ * quicpro.router_connection_id_entropy_salt, so routers and backends that
+ * share the salt agree without talking to each other.
+ */
+
+#include "php_quicpro.h"
+#include "server/router.h"
+#include "poll/udp_batch.h"
+#include "cluster/cluster_stats.h"
+#include "config/bare_metal_tuning/base_layer.h"
+#include "config/router_and_loadbalancer/base_layer.h"
+
+#include <zend_exceptions.h>
+#include <arpa/inet.h>
+#include <curl/curl.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <openssl/sha.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define QP_RT_MARKER0     0x00
+#define QP_RT_MARKER1     0x01
+#define QP_RT_TAG_AT      20
+#define QP_RT_TABLE       65537         /* Maglev lookup entries; prime */
+#define QP_RT_MAX         65535         /* Backends addressable by a 16-bit id */
+
+/*──────────────────────────────── Keys ───────────────────────────────────*/
+
+static const char *qp_rt_salt;          /* The salt the keys were derived from */
+static uint64_t    qp_rt_key[2];
+
+static inline uint64_t qp_rt_rotl(uint64_t x, int b)
+{
+    return (x << b) | (x >> (64 - b));
+}
+
+#define QP_SIPROUND                                                        \
+    do {                                                                   \
+        v0 += v1; v1 = qp_rt_rotl(v1, 13); v1 ^= v0; v0 = qp_rt_rotl(v0, 32); \
+        v2 += v3; v3 = qp_rt_rotl(v3, 16); v3 ^= v2;                        \
+        v0 += v3; v3 = qp_rt_rotl(v3, 21); v3 ^= v0;                        \
+        v2 += v1; v1 = qp_rt_rotl(v1, 17); v1 ^= v2; v2 = qp_rt_rotl(v2, 32); \
+    } while (0)
+
+/* SipHash-2-4 */
+static uint64_t qp_rt_siphash(uint64_t k0, uint64_t k1, const uint8_t *p, size_t len)
+{
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0, v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0, v3 = 0x7465646279746573ULL ^ k1;
+    uint64_t b = (uint64_t)len << 56;
+    size_t i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t m = 0;
+        for (int j = 0; j < 8; j++) {
+            m |= (uint64_t)p[i + j] << (8 * j);
+        }
+        v3 ^= m;
+        QP_SIPROUND;
+        QP_SIPROUND;
+        v0 ^= m;
+    }
+    for (int j = 0; i + j < len; j++) {
+        b |= (uint64_t)p[i + j] << (8 * j);
+    }
+    v3 ^= b;
+    QP_SIPROUND;
+    QP_SIPROUND;
+    v0 ^= b;
+    v2 ^= 0xff;
+    QP_SIPROUND;
+    QP_SIPROUND;
+    QP_SIPROUND;
+    QP_SIPROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+static void qp_rt_keys(void)
+{
+    const char *salt = quicpro_router_loadbalancer_config.connection_id_entropy_salt;
+    if (salt == qp_rt_salt && qp_rt_salt) {
+        return;
+    }
+    uint8_t d[SHA256_DIGEST_LENGTH];
+    SHA256((const unsigned char *)(salt ? salt : ""), salt ? strlen(salt) : 0, d);
+    qp_rt_key[0] = qp_rt_key[1] = 0;
+    for (int i = 0; i < 8; i++) {
+        qp_rt_key[0] |= (uint64_t)d[i] << (8 * i);
+        qp_rt_key[1] |= (uint64_t)d[8 + i] << (8 * i);
+    }
+    qp_rt_salt = salt;
+}
+
+/* Keyed differently for each use, so one never reveals another's values */
+static inline uint64_t qp_rt_hash(unsigned use, const uint8_t *p, size_t len)
+{
+    return qp_rt_siphash(qp_rt_key[0] ^ use, qp_rt_key[1], p, len);
+}
+
+enum { QP_RT_USE_CID = 1, QP_RT_USE_TAG, QP_RT_USE_PICK, QP_RT_USE_OFFSET, QP_RT_USE_SKIP };
+
+/*──────────────────────────── Connection IDs ─────────────────────────────*/
+
+static inline uint16_t qp_rt_cid_mask(const uint8_t *cid, size_t len)
+{
+    return (uint16_t)qp_rt_hash(QP_RT_USE_CID, cid + QUICPRO_ROUTER_CID_ID_AT + 2, len - QUICPRO_ROUTER_CID_ID_AT - 2);
+}
+
+void quicpro_router_stamp_cid(uint8_t *cid, size_t len)
+{
+    zend_long id = quicpro_router_loadbalancer_config.server_id;
+    if (id <= 0 || len < QUICPRO_ROUTER_CID_ID_AT + 4) {
+        return;
+    }
+    qp_rt_keys();
+    uint16_t v = (uint16_t)id ^ qp_rt_cid_mask(cid, len);
+    cid[QUICPRO_ROUTER_CID_ID_AT] = (uint8_t)(v >> 8);
+    cid[QUICPRO_ROUTER_CID_ID_AT + 1] = (uint8_t)v;
+}
+
+/* The server id a CID carries; meaningless (but stable) for one no backend issued */
+static inline unsigned qp_rt_cid_id(const uint8_t *cid, size_t len)
+{
+    if (len < QUICPRO_ROUTER_CID_ID_AT + 4) {
+        return 0;
+    }
+    uint16_t v = (uint16_t)(cid[QUICPRO_ROUTER_CID_ID_AT] << 8 | cid[QUICPRO_ROUTER_CID_ID_AT + 1]);
+    return v ^ qp_rt_cid_mask(cid, len);
+}
+
+/*─────────────────────────────── Relaying ────────────────────────────────*/
+
+static inline uint64_t qp_rt_tag(const uint8_t *hdr)
+{
+    return qp_rt_hash(QP_RT_USE_TAG, hdr, QP_RT_TAG_AT);
+}
+
+static inline bool qp_rt_is_relayed(const uint8_t *p, size_t len)
+{
+    return len > QUICPRO_ROUTER_ENCAP_LEN && p[0] == QP_RT_MARKER0 && p[1] == QP_RT_MARKER1;
+}
+
+bool quicpro_router_wrap(uint8_t *hdr, const struct sockaddr *client, socklen_t client_len)
+{
+    hdr[0] = QP_RT_MARKER0;
+    hdr[1] = QP_RT_MARKER1;
+    if (client->sa_family == AF_INET6 && client_len >= (socklen_t)sizeof(struct sockaddr_in6)) {
+        const struct sockaddr_in6 *a = (const struct sockaddr_in6 *)client;
+        memcpy(hdr + 2, &a->sin6_port, 2);
+        memcpy(hdr + 4, &a->sin6_addr, 16);
+    } else if (client->sa_family == AF_INET && client_len >= (socklen_t)sizeof(struct sockaddr_in)) {
+        const struct sockaddr_in *a = (const struct sockaddr_in *)client;
+        memcpy(hdr + 2, &a->sin_port, 2);
+        memset(hdr + 4, 0, 10);
+        hdr[14] = hdr[15] = 0xff;
+        memcpy(hdr + 16, &a->sin_addr, 4);
+    } else {
+        return false;
+    }
+    uint64_t tag = qp_rt_tag(hdr);
+    for (int i = 0; i < 8; i++) {
+        hdr[QP_RT_TAG_AT + i] = (uint8_t)(tag >> (8 * i));
+    }
+    return true;
+}
+
+/* Checks the tag and reads the client address of a header */
+static bool qp_rt_open(const uint8_t *hdr, struct sockaddr_storage *client, socklen_t *client_len)
+{
+    uint64_t tag = qp_rt_tag(hdr), got = 0;
+    for (int i = 0; i < 8; i++) {
+        got |= (uint64_t)hdr[QP_RT_TAG_AT + i] << (8 * i);
+    }
+    if (tag != got) {
+        return false;
+    }
+    struct sockaddr_in6 *a = (struct sockaddr_in6 *)client;
+    memset(a, 0, sizeof(*a));
+    a->sin6_family = AF_INET6;
+    memcpy(&a->sin6_port, hdr + 2, 2);
+    memcpy(&a->sin6_addr, hdr + 4, 16);
+    *client_len = sizeof(*a);
+    return true;
+}
+
+int quicpro_router_unwrap(uint8_t **buf, size_t *len, const struct sockaddr **peer, socklen_t *peer_len,
+                          quicpro_router_relay_t *relay)
+{
+    if (!qp_rt_is_relayed(*buf, *len)) {
+        return 0;
+    }
+    /* Only a backend takes relayed datagrams, and only with a valid tag */
+    if (quicpro_router_loadbalancer_config.server_id <= 0) {
+        return -1;
+    }
+    qp_rt_keys();
+    if (!qp_rt_open(*buf, &relay->client, &relay->client_len) || *peer_len > (socklen_t)sizeof(relay->via)) {
+        return -1;
+    }
+    memcpy(&relay->via, *peer, *peer_len);
+    relay->via_len = *peer_len;
+    *buf += QUICPRO_ROUTER_ENCAP_LEN;
+    *len -= QUICPRO_ROUTER_ENCAP_LEN;
+    *peer = (const struct sockaddr *)&relay->client;
+    *peer_len = relay->client_len;
+    return 1;
+}
+
+void quicpro_router_note_path(quicpro_session_t *s, const quicpro_router_relay_t *relay, int relayed)
+{
+    if (relayed > 0) {
+        memcpy(&s->relay_addr, &relay->via, relay->via_len);
+        s->relay_addr_len = relay->via_len;
+    } else {
+        s->relay_addr_len = 0;
+    }
+}
+
+/*──────────────────────────────── Backends ───────────────────────────────*/
+
+#define QP_RT_PROBE_MS     1000         /* One health probe round */
+#define QP_RT_DOWN_AFTER   3            /* Rounds without an answer before a backend is down */
+#define QP_RT_UP_AFTER     2            /* Answered rounds before it is up again */
+#define QP_RT_PROBE_LEN    1200         /* Servers negotiate versions only for full-size Initials */
+#define QP_RT_PROBE_VER    0x1a2a3a4aU  /* A reserved version no server supports */
+#define QP_RT_AGENT_MAX    (1 << 20)    /* Largest backend list taken from the agent */
+#define QP_RT_AGENT_MS     2000
+
+static inline uint64_t qp_rt_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+typedef struct {
+    struct sockaddr_in6 addr;
+    uint16_t            id;
+    uint16_t            weight;         /* 0: draining */
+    uint8_t             misses, answers;
+    bool                up, answered;
+} qp_rt_member_t;
+
+/*
+ * A routing table. Once published it is never written again: the control
+ * thread builds the next one beside it and swaps the pointer, and frees
+ * the old one when the forwarding loop has moved past it.
+ */
+typedef struct qp_rt_table {
+    uint64_t             gen;
+    struct qp_rt_table  *retired;       /* Control thread: older tables not yet freed */
+    unsigned             max_id, nready;
+    struct sockaddr_in6 *addr;          /* max_id + 1, by server id */
+    uint8_t             *live;          /* By server id: up, draining or not */
+    uint16_t            *ready;         /* The nready ids that take new handshakes */
+    uint16_t            *lookup;        /* Maglev: QP_RT_TABLE ids; NULL: ready[hash % nready] */
+} qp_rt_table_t;
+
+typedef struct {
+    _Atomic(qp_rt_table_t *) table;
+    _Atomic uint64_t     seen;          /* The forwarding loop holds no table older than this */
+    atomic_bool          stopping;
+    pthread_t            thread;
+    bool                 started;
+    int                  wake;          /* eventfd */
+    /* The control thread's own; copied from the configuration before it starts */
+    qp_rt_member_t      *members;
+    unsigned             count;
+    bool                 maglev;
+    char                *agent_url;     /* NULL: static discovery */
+    uint64_t             poll_ns;
+    int                  probe_fd;
+    uint32_t             round;
+    uint64_t             gen;
+    qp_rt_table_t       *retired;
+} qp_rt_ctl_t;
+
+/* Both threads: "host:port" in [p, end) to an IPv6 (or IPv4-mapped) address */
+static int qp_rt_resolve(const char *p, const char *end, struct sockaddr_in6 *out)
+{
+    const char *colon = end;
+    while (colon > p && *colon != ':') colon--;
+    if (colon == p || colon + 1 == end) {
+        return EAI_NONAME;
+    }
+    char host[256], port[8];
+    const char *h = p;
+    size_t hl = (size_t)(colon - p);
+    if (hl >= 2 && h[0] == '[' && h[hl - 1] == ']') {
+        h++;
+        hl -= 2;
+    }
+    if (hl >= sizeof(host) || (size_t)(end - colon - 1) >= sizeof(port)) {
+        return EAI_NONAME;
+    }
+    memcpy(host, h, hl);
+    host[hl] = '\0';
+    memcpy(port, colon + 1, (size_t)(end - colon - 1));
+    port[end - colon - 1] = '\0';
+
+    /* The listen socket is dual-stack, so IPv4 backends are addressed mapped */
+    struct addrinfo hints = {0}, *res = NULL;
+    hints.ai_family = AF_INET6;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_V4MAPPED | AI_NUMERICSERV;
+    int rc = getaddrinfo(host, port, &hints, &res);
+    if (rc != 0 || !res) {
+        return rc ? rc : EAI_NONAME;
+    }
+    memcpy(out, res->ai_addr, sizeof(*out));
+    freeaddrinfo(res);
+    return 0;
+}
+
+/* The static list: each backend's id is its position, from 1 */
+static bool qp_rt_parse_backends(qp_rt_ctl_t *ctl, const char *list)
+{
+    const char *p = list ? list : "";
+    unsigned cap = 0;
+
+    while (*p) {
+        while (*p == ' ' || *p == ',') p++;
+        const char *end = p;
+        while (*end && *end != ',') end++;
+        const char *last = end;
+        while (last > p && last[-1] == ' ') last--;
+        if (last == p) {
+            p = end;
+            continue;
+        }
+        if (ctl->count == QP_RT_MAX) {
+            zend_throw_exception_ex(NULL, 0, "At most %d router backends are supported", QP_RT_MAX);
+            return false;
+        }
+        if (ctl->count == cap) {
+            cap = cap ? cap * 2 : 8;
+            ctl->members = realloc(ctl->members, cap * sizeof(*ctl->members));
+            if (!ctl->members) {
+                zend_throw_exception_ex(NULL, 0, "Out of memory for the router backends");
+                return false;
+            }
+        }
+        qp_rt_member_t *m = &ctl->members[ctl->count];
+        memset(m, 0, sizeof(*m));
+        int rc = qp_rt_resolve(p, last, &m->addr);
+        if (rc != 0) {
+            zend_throw_exception_ex(NULL, 0, "Cannot resolve router backend '%.*s', expected host:port: %s",
+                                    (int)(last - p), p, gai_strerror(rc));
+            return false;
+        }
+        m->id = (uint16_t)++ctl->count;
+        m->weight = 1;
+        m->up = true;
+        p = end;
+    }
+    if (ctl->count == 0) {
+        zend_throw_exception_ex(NULL, 0, "Router mode needs at least one backend in quicpro.router_backend_static_list");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Maglev: each backend walks its own permutation of the table (an offset
+ * and a skip from its address) and takes the next free entry in turn until
+ * the table is full, so every backend ends up with a share in proportion
+ * to its weight and a removed backend's entries go to the others with few
+ * other moves. A turn is taken per `wmax` of credit, so equal weights fill
+ * the table exactly as unweighted Maglev does, and routers that see the
+ * same backends build the same table.
+ */
+static bool qp_rt_build_maglev(const qp_rt_member_t *members, const uint16_t *pos, unsigned n, uint16_t *lookup)
+{
+    uint32_t *offset = malloc(n * sizeof(uint32_t) * 4);
+    if (!offset) {
+        return false;
+    }
+    uint32_t *skip = offset + n, *next = skip + n, *credit = next + n;
+    uint32_t filled = 0, wmax = 1;
+
+    memset(lookup, 0xff, QP_RT_TABLE * sizeof(uint16_t));
+    for (unsigned i = 0; i < n; i++) {
+        const qp_rt_member_t *m = &members[pos[i]];
+        uint8_t name[18];
+        memcpy(name, &m->addr.sin6_addr, 16);
+        memcpy(name + 16, &m->addr.sin6_port, 2);
+        offset[i] = (uint32_t)(qp_rt_hash(QP_RT_USE_OFFSET, name, sizeof(name)) % QP_RT_TABLE);
+        skip[i] = (uint32_t)(qp_rt_hash(QP_RT_USE_SKIP, name, sizeof(name)) % (QP_RT_TABLE - 1)) + 1;
+        next[i] = credit[i] = 0;
+        wmax = MAX(wmax, m->weight);
+    }
+    while (filled < QP_RT_TABLE) {
+        for (unsigned i = 0; i < n && filled < QP_RT_TABLE; i++) {
+            for (credit[i] += members[pos[i]].weight; credit[i] >= wmax && filled < QP_RT_TABLE; credit[i] -= wmax) {
+                uint32_t c;
+                do {
+                    c = (uint32_t)((offset[i] + (uint64_t)next[i] * skip[i]) % QP_RT_TABLE);
+                    next[i]++;
+                } while (lookup[c] != UINT16_MAX);
+                lookup[c] = members[pos[i]].id;
+                filled++;
+            }
+        }
+    }
+    free(offset);
+    return true;
+}
+
+/* The table for the members as they are now, in one allocation; NULL if out of memory */
+static qp_rt_table_t *qp_rt_table_build(const qp_rt_ctl_t *ctl)
+{
+    unsigned max_id = 0, nready = 0;
+    for (unsigned i = 0; i < ctl->count; i++) {
+        max_id = MAX(max_id, ctl->members[i].id);
+        nready += ctl->members[i].up && ctl->members[i].weight;
+    }
+    size_t size = sizeof(qp_rt_table_t) + (max_id + 1) * sizeof(struct sockaddr_in6)
+                + nready * sizeof(uint16_t) + nready * sizeof(uint16_t)
+                + (ctl->maglev && nready ? QP_RT_TABLE * sizeof(uint16_t) : 0) + (max_id + 1);
+    qp_rt_table_t *t = calloc(1, size);
+    if (!t) {
+        return NULL;
+    }
+    t->max_id = max_id;
+    t->addr = (struct sockaddr_in6 *)(t + 1);
+    t->ready = (uint16_t *)(t->addr + max_id + 1);
+    uint16_t *pos = t->ready + nready;          /* Member positions, for the build */
+    t->lookup = ctl->maglev && nready ? pos + nready : NULL;
+    t->live = (uint8_t *)(t->lookup ? t->lookup + QP_RT_TABLE : pos + nready);
+
+    for (unsigned i = 0; i < ctl->count; i++) {
+        const qp_rt_member_t *m = &ctl->members[i];
+        if (!m->up) {
+            continue;
+        }
+        t->addr[m->id] = m->addr;
+        t->live[m->id] = 1;
+        if (m->weight) {
+            pos[t->nready] = (uint16_t)i;
+            t->ready[t->nready++] = m->id;
+        }
+    }
+    if (t->lookup && !qp_rt_build_maglev(ctl->members, pos, t->nready, t->lookup)) {
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+/* Frees the retired tables the forwarding loop has moved past */
+static void qp_rt_reclaim(qp_rt_ctl_t *ctl)
+{
+    uint64_t seen = atomic_load_explicit(&ctl->seen, memory_order_acquire);
+    qp_rt_table_t **link = &ctl->retired;
+    while (*link) {
+        qp_rt_table_t *t = *link;
+        if (t->gen < seen) {
+            *link = t->retired;
+            free(t);
+        } else {
+            link = &t->retired;
+        }
+    }
+}
+
+/* Builds and swaps in the table for the members; on failure the current one stays */
+static void qp_rt_publish(qp_rt_ctl_t *ctl)
+{
+    qp_rt_table_t *t = qp_rt_table_build(ctl);
+    if (!t) {
+        return;
+    }
+    t->gen = ++ctl->gen;
+    qp_rt_table_t *old = atomic_exchange_explicit(&ctl->table, t, memory_order_acq_rel);
+    if (old) {
+        old->retired = ctl->retired;
+        ctl->retired = old;
+    }
+    qp_rt_reclaim(ctl);
+}
+
+/*─────────────────────────────── Discovery ───────────────────────────────*/
+
+typedef struct {
+    char  *p;
+    size_t len;
+} qp_rt_agent_body_t;
+
+static size_t qp_rt_agent_write(char *data, size_t size, size_t n, void *ud)
+{
+    qp_rt_agent_body_t *b = ud;
+    size_t add = size * n;
+    if (b->len + add > QP_RT_AGENT_MAX) {
+        return 0;
+    }
+    char *p = realloc(b->p, b->len + add + 1);
+    if (!p) {
+        return 0;
+    }
+    memcpy(p + b->len, data, add);
+    b->p = p;
+    b->len += add;
+    b->p[b->len] = '\0';
+    return add;
+}
+
+static int qp_rt_member_cmp(const void *a, const void *b)
+{
+    return (int)((const qp_rt_member_t *)a)->id - (int)((const qp_rt_member_t *)b)->id;
+}
+
+/*
+ * Asks the health agent for the backends: one "<id> <host:port> [weight]"
+ * per line. Members that stay keep their health; true if anything changed.
+ * Without an answer the list the router has stays as it is.
+ */
+static bool qp_rt_discover(qp_rt_ctl_t *ctl, CURL *curl)
+{
+    qp_rt_agent_body_t body = {0};
+    long status = 0;
+
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, qp_rt_agent_write);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+    if (curl_easy_perform(curl) != CURLE_OK
+        || curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status) != CURLE_OK || status != 200 || !body.p) {
+        free(body.p);
+        return false;
+    }
+
+    qp_rt_member_t *next = NULL;
+    unsigned count = 0, cap = 0;
+    for (char *line = body.p, *eol; *line; line = eol) {
+        eol = line + strcspn(line, "\r\n");
+        if (*eol) *eol++ = '\0';
+        char *save, *id_s = strtok_r(line, " \t", &save), *addr_s = strtok_r(NULL, " \t", &save);
+        char *weight_s = strtok_r(NULL, " \t", &save), *stop;
+        if (!id_s || *id_s == '#' || !addr_s) {
+            continue;
+        }
+        long id = strtol(id_s, &stop, 10), weight = weight_s ? strtol(weight_s, NULL, 10) : 1;
+        qp_rt_member_t m = {0};
+        if (*stop || id < 1 || id > QP_RT_MAX || qp_rt_resolve(addr_s, addr_s + strlen(addr_s), &m.addr) != 0) {
+            continue;
+        }
+        m.id = (uint16_t)id;
+        m.weight = (uint16_t)MIN(MAX(weight, 0), UINT16_MAX);
+        m.up = true;
+        for (unsigned i = 0; i < ctl->count; i++) {
+            const qp_rt_member_t *o = &ctl->members[i];
+            if (o->id == m.id && memcmp(&o->addr, &m.addr, sizeof(m.addr)) == 0) {
+                m.up = o->up;
+                m.misses = o->misses;
+                m.answers = o->answers;
+                m.answered = o->answered;
+                break;
+            }
+        }
+        if (count == cap) {
+            cap = cap ? cap * 2 : 16;
+            qp_rt_member_t *grown = realloc(next, cap * sizeof(*next));
+            if (!grown) {
+                free(next);
+                free(body.p);
+                return false;
+            }
+            next = grown;
+        }
+        next[count++] = m;
+    }
+    free(body.p);
+
+    /* In id order, the first of any duplicates kept */
+    if (count) {
+        qsort(next, count, sizeof(*next), qp_rt_member_cmp);
+        unsigned kept = 1;
+        for (unsigned i = 1; i < count; i++) {
+            if (next[i].id != next[kept - 1].id) {
+                next[kept++] = next[i];
+            }
+        }
+        count = kept;
+    }
+    bool changed = count != ctl->count;
+    for (unsigned i = 0; !changed && i < count; i++) {
+        const qp_rt_member_t *a = &next[i], *o = &ctl->members[i];
+        changed = a->id != o->id || a->weight != o->weight || memcmp(&a->addr, &o->addr, sizeof(a->addr)) != 0;
+    }
+    free(ctl->members);
+    ctl->members = next;
+    ctl->count = count;
+    return changed;
+}
+
+/*──────────────────────────────── Health ─────────────────────────────────*/
+
+/*
+ * Each round sends every backend an Initial of an unsupported version,
+ * which a QUIC server answers with Version Negotiation without setting up
+ * any state. The probe's source CID names the member and the round, and
+ * comes back as the answer's destination CID.
+ */
+static void qp_rt_probe(qp_rt_ctl_t *ctl)
+{
+    uint8_t pkt[QP_RT_PROBE_LEN] = {0};
+    ctl->round++;
+    pkt[0] = 0xc0;
+    pkt[1] = (uint8_t)(QP_RT_PROBE_VER >> 24);
+    pkt[2] = (uint8_t)(QP_RT_PROBE_VER >> 16);
+    pkt[3] = (uint8_t)(QP_RT_PROBE_VER >> 8);
+    pkt[4] = (uint8_t)QP_RT_PROBE_VER;
+    pkt[5] = 8;                                 /* DCID */
+    pkt[14] = 8;                                /* SCID at 15 */
+    pkt[23] = 0;                                /* No token */
+    for (unsigned i = 0; i < ctl->count; i++) {
+        uint8_t name[8] = { (uint8_t)(i >> 8), (uint8_t)i, (uint8_t)(ctl->round >> 24), (uint8_t)(ctl->round >> 16),
+                            (uint8_t)(ctl->round >> 8), (uint8_t)ctl->round, 0, 0 };
+        memcpy(pkt + 6, name, 8);
+        memcpy(pkt + 15, name, 8);
+        ctl->members[i].answered = false;
+        sendto(ctl->probe_fd, pkt, sizeof(pkt), 0, (const struct sockaddr *)&ctl->members[i].addr,
+               sizeof(ctl->members[i].addr));
+    }
+}
+
+static void qp_rt_probe_answers(qp_rt_ctl_t *ctl)
+{
+    uint8_t pkt[QP_RT_PROBE_LEN];
+    struct sockaddr_in6 from;
+    socklen_t from_len = sizeof(from);
+    ssize_t n;
+
+    while ((n = recvfrom(ctl->probe_fd, pkt, sizeof(pkt), MSG_DONTWAIT, (struct sockaddr *)&from, &from_len)) >= 0) {
+        from_len = sizeof(from);
+        if (n < 14 || !(pkt[0] & 0x80) || pkt[1] || pkt[2] || pkt[3] || pkt[4] || pkt[5] != 8) {
+            continue;
+        }
+        unsigned i = (unsigned)pkt[6] << 8 | pkt[7];
+        uint32_t round = (uint32_t)pkt[8] << 24 | (uint32_t)pkt[9] << 16 | (uint32_t)pkt[10] << 8 | pkt[11];
+        if (i < ctl->count && round == ctl->round && from.sin6_port == ctl->members[i].addr.sin6_port
+            && memcmp(&from.sin6_addr, &ctl->members[i].addr.sin6_addr, 16) == 0) {
+            ctl->members[i].answered = true;
+        }
+    }
+}
+
+/* At the end of a round: true if a backend went down or came back */
+static bool qp_rt_health(qp_rt_ctl_t *ctl)
+{
+    bool changed = false;
+    for (unsigned i = 0; i < ctl->count; i++) {
+        qp_rt_member_t *m = &ctl->members[i];
+        if (m->answered) {
+            m->misses = 0;
+            m->answers = (uint8_t)MIN(m->answers + 1, QP_RT_UP_AFTER);
+        } else {
+            m->answers = 0;
+            m->misses = (uint8_t)MIN(m->misses + 1, QP_RT_DOWN_AFTER);
+        }
+        bool up = m->up ? m->misses < QP_RT_DOWN_AFTER : m->answers >= QP_RT_UP_AFTER;
+        changed |= up != m->up;
+        m->up = up;
+    }
+    return changed;
+}
+
+/* Owns the members: rediscovers, probes and republishes until stopped. Never touches PHP. */
+static void *qp_rt_control_main(void *arg)
+{
+    qp_rt_ctl_t *ctl = arg;
+    CURL *curl = NULL;
+    uint64_t probe_at = 0, poll_at = 0;
+
+    if (ctl->agent_url && (curl = curl_easy_init()) != NULL) {
+        curl_easy_setopt(curl, CURLOPT_URL, ctl->agent_url);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)QP_RT_AGENT_MS);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    }
+    while (!atomic_load_explicit(&ctl->stopping, memory_order_acquire)) {
+        uint64_t now = qp_rt_now_ns();
+        bool changed = false, moved = false;
+        if (curl && now >= poll_at) {
+            /* New members start up, and a round that probed the old list is started over */
+            changed = moved = qp_rt_discover(ctl, curl);
+            poll_at = now + ctl->poll_ns;
+        }
+        if (now >= probe_at || moved) {
+            if (ctl->round && !moved) {
+                changed |= qp_rt_health(ctl);
+            }
+            qp_rt_probe(ctl);
+            probe_at = now + QP_RT_PROBE_MS * 1000000ULL;
+        }
+        if (changed) {
+            qp_rt_publish(ctl);
+        }
+
+        struct pollfd fds[2] = { { .fd = ctl->probe_fd, .events = POLLIN }, { .fd = ctl->wake, .events = POLLIN } };
+        now = qp_rt_now_ns();
+        int wait_ms = probe_at > now ? (int)((probe_at - now) / 1000000ULL) + 1 : 0;
+        if (poll(fds, 2, wait_ms) > 0 && (fds[0].revents & POLLIN)) {
+            qp_rt_probe_answers(ctl);
+        }
+        qp_rt_reclaim(ctl);
+    }
+    if (curl) {
+        curl_easy_cleanup(curl);
+    }
+    return NULL;
+}
+
+static void qp_rt_ctl_free(qp_rt_ctl_t *ctl)
+{
+    if (ctl->started) {
+        uint64_t one = 1;
+        atomic_store_explicit(&ctl->stopping, true, memory_order_release);
+        (void)!write(ctl->wake, &one, sizeof(one));
+        pthread_join(ctl->thread, NULL);
+    }
+    qp_rt_table_t *t = atomic_load_explicit(&ctl->table, memory_order_relaxed);
+    if (t) {
+        t->retired = ctl->retired;
+        ctl->retired = t;
+    }
+    while (ctl->retired) {
+        t = ctl->retired;
+        ctl->retired = t->retired;
+        free(t);
+    }
+    if (ctl->wake >= 0) close(ctl->wake);
+    if (ctl->probe_fd >= 0) close(ctl->probe_fd);
+    free(ctl->members);
+    free(ctl->agent_url);
+}
+
+/* The backends per quicpro.router_backend_discovery_mode, and the thread that keeps them current */
+static bool qp_rt_ctl_start(qp_rt_ctl_t *ctl)
+{
+    const qp_router_loadbalancer_config_t *c = &quicpro_router_loadbalancer_config;
+    ctl->wake = ctl->probe_fd = -1;
+    ctl->maglev = !c->hashing_algorithm || strcasecmp(c->hashing_algorithm, "round_robin") != 0;
+    ctl->poll_ns = (uint64_t)MAX(c->backend_mcp_poll_interval_sec, 1) * 1000000000ULL;
+
+    if (c->backend_discovery_mode && strcasecmp(c->backend_discovery_mode, "mcp") == 0) {
+        const char *ep = c->backend_mcp_endpoint ? c->backend_mcp_endpoint : "";
+        if (!*ep) {
+            zend_throw_exception_ex(NULL, 0, "Router discovery mode \"mcp\" needs quicpro.router_backend_mcp_endpoint");
+            return false;
+        }
+        size_t len = strlen(ep) + sizeof("http:///backends");
+        ctl->agent_url = malloc(len);
+        if (!ctl->agent_url || curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+            zend_throw_exception_ex(NULL, 0, "Router could not set up backend discovery");
+            return false;
+        }
+        snprintf(ctl->agent_url, len, "%s%s/backends", strstr(ep, "://") ? "" : "http://", ep);
+    } else if (!qp_rt_parse_backends(ctl, c->backend_static_list)) {
+        return false;
+    }
+
+    /* The first table goes out before the thread exists; in "mcp" mode it is empty until the agent answers */
+    qp_rt_publish(ctl);
+    ctl->probe_fd = socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    ctl->wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (!atomic_load_explicit(&ctl->table, memory_order_relaxed) || ctl->probe_fd < 0 || ctl->wake < 0) {
+        zend_throw_exception_ex(NULL, 0, "Router could not set up its backend table: %s", strerror(errno));
+        return false;
+    }
+    int off = 0;
+    setsockopt(ctl->probe_fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    if (pthread_create(&ctl->thread, NULL, qp_rt_control_main, ctl) != 0) {
+        zend_throw_exception_ex(NULL, 0, "Router could not start its control thread");
+        return false;
+    }
+    ctl->started = true;
+    return true;
+}
+
+/*──────────────────────────────── Router ─────────────────────────────────*/
+
+typedef struct {
+    qp_rt_ctl_t         *ctl;
+    uint64_t             gen;           /* Of the table this batch uses */
+    /* Rate limit */
+    uint64_t             tokens, burst, pps, refilled_ns;
+    /* Send vector */
+    unsigned             capacity;
+    struct mmsghdr      *msgs;
+    struct iovec        (*iov)[2];
+    uint8_t            (*hdr)[QUICPRO_ROUTER_ENCAP_LEN];
+    struct sockaddr_in6 *dest;
+} qp_rt_t;
+
+/* The destination connection ID: from a long header, or the length our backends issue */
+static inline bool qp_rt_dcid(const uint8_t *p, size_t len, const uint8_t **dcid, size_t *dcid_len)
+{
+    if (len < 1 || !(p[0] & 0x40)) {
+        return false;
+    }
+    if (p[0] & 0x80) {
+        if (len < 6 || p[5] > QUICHE_MAX_CONN_ID_LEN || len < 6 + (size_t)p[5]) {
+            return false;
+        }
+        *dcid = p + 6;
+        *dcid_len = p[5];
+    } else {
+        if (len < 1 + QUICHE_MAX_CONN_ID_LEN) {
+            return false;
+        }
+        *dcid = p + 1;
+        *dcid_len = QUICHE_MAX_CONN_ID_LEN;
+    }
+    return true;
+}
+
+/*
+ * A live backend named by the CID keeps its connections, draining or not;
+ * anything else is hashed over the backends taking new handshakes. NULL:
+ * none is.
+ */
+static inline const struct sockaddr_in6 *qp_rt_pick(const qp_rt_table_t *t, const uint8_t *dcid, size_t len)
+{
+    unsigned id = qp_rt_cid_id(dcid, len);
+    if (id >= 1 && id <= t->max_id && t->live[id]) {
+        return &t->addr[id];
+    }
+    if (t->nready == 0) {
+        return NULL;
+    }
+    uint64_t h = qp_rt_hash(QP_RT_USE_PICK, dcid, len);
+    return &t->addr[t->lookup ? t->lookup[h % QP_RT_TABLE] : t->ready[h % t->nready]];
+}
+
+static void qp_rt_refill(qp_rt_t *rt)
+{
+    uint64_t now = qp_rt_now_ns(), add = (now - rt->refilled_ns) * rt->pps / 1000000000ULL;
+    if (add) {
+        rt->tokens = MIN(rt->tokens + add, rt->burst);
+        rt->refilled_ns = now;
+    }
+}
+
+static void qp_rt_send(int fd, qp_rt_t *rt, unsigned n)
+{
+    unsigned sent = 0;
+    while (sent < n) {
+#ifdef __linux__
+        int rc = sendmmsg(fd, rt->msgs + sent, n - sent, 0);
+#else
+        int rc = sendmsg(fd, &rt->msgs[sent].msg_hdr, 0) < 0 ? -1 : 1;
+#endif
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                return;   /* The rest is lost; QUIC recovers it */
+            }
+            sent++;       /* This destination failed; the others still go */
+            continue;
+        }
+        sent += (unsigned)rc;
+    }
+}
+
+/* Relays one received batch: client datagrams to their backend, backend datagrams to their client */
+static void qp_rt_forward(int fd, qp_rt_t *rt, quicpro_udp_rx_batch_t *rx, int n)
+{
+    unsigned out = 0;
+    qp_rt_refill(rt);
+
+    /* One table for the whole batch; the control thread frees it once a later one is seen */
+    const qp_rt_table_t *t = atomic_load_explicit(&rt->ctl->table, memory_order_acquire);
+    if (t->gen != rt->gen) {
+        rt->gen = t->gen;
+        atomic_store_explicit(&rt->ctl->seen, t->gen, memory_order_release);
+    }
+
+    for (int i = 0; i < n; i++) {
+        uint8_t *p = quicpro_udp_rx_slot_data(rx, (unsigned)i);
+        size_t len = quicpro_udp_rx_slot_len(rx, (unsigned)i);
+        if (quicpro_udp_rx_slot_truncated(rx, (unsigned)i) || rt->tokens == 0) {
+            continue;
+        }
+
+        struct msghdr *h = &rt->msgs[out].msg_hdr;
+        memset(h, 0, sizeof(*h));
+        if (qp_rt_is_relayed(p, len)) {
+            socklen_t dest_len;
+            if (!qp_rt_open(p, (struct sockaddr_storage *)&rt->dest[out], &dest_len)) {
+                continue;
+            }
+            rt->iov[out][0].iov_base = p + QUICPRO_ROUTER_ENCAP_LEN;
+            rt->iov[out][0].iov_len = len - QUICPRO_ROUTER_ENCAP_LEN;
+            h->msg_iovlen = 1;
+            h->msg_name = &rt->dest[out];
+            h->msg_namelen = dest_len;
+        } else {
+            const uint8_t *dcid;
+            size_t dcid_len;
+            const struct sockaddr_in6 *backend;
+            if (!qp_rt_dcid(p, len, &dcid, &dcid_len) || !(backend = qp_rt_pick(t, dcid, dcid_len))
+                || !quicpro_router_wrap(rt->hdr[out], (const struct sockaddr *)&rx->from[i], rx->msgs[i].msg_hdr.msg_namelen)) {
+                continue;
+            }
+            rt->iov[out][0].iov_base = rt->hdr[out];
+            rt->iov[out][0].iov_len = QUICPRO_ROUTER_ENCAP_LEN;
+            rt->iov[out][1].iov_base = p;
+            rt->iov[out][1].iov_len = len;
+            h->msg_iovlen = 2;
+            h->msg_name = (void *)backend;
+            h->msg_namelen = sizeof(struct sockaddr_in6);
+        }
+        h->msg_iov = rt->iov[out];
+        rt->tokens--;
+        out++;
+    }
+    if (out) {
+        qp_rt_send(fd, rt, out);
+    }
+}
+
+static void qp_rt_free(qp_rt_t *rt)
+{
+    if (rt->msgs) efree(rt->msgs);
+    if (rt->iov) efree(rt->iov);
+    if (rt->hdr) efree(rt->hdr);
+    if (rt->dest) efree(rt->dest);
+}
+
+int quicpro_router_run(int fd, bool *running)
+{
+    qp_rt_ctl_t ctl = {0};
+    qp_rt_t rt = { .ctl = &ctl };
+    qp_rt_keys();
+    if (!qp_rt_ctl_start(&ctl)) {
+        qp_rt_ctl_free(&ctl);
+        return -1;
+    }
+
+    int ep = epoll_create1(0);
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = fd };
+    if (ep < 0 || epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        zend_throw_exception_ex(NULL, 0, "Router could not watch its socket: %s", strerror(errno));
+        if (ep >= 0) close(ep);
+        qp_rt_ctl_free(&ctl);
+        return -1;
+    }
+
+    quicpro_udp_rx_batch_t *rx = quicpro_udp_rx_batch_new((unsigned)quicpro_bare_metal_config.io_max_batch_read_packets,
+                                                          quicpro_udp_rx_slot_size(0));
+    rt.capacity = rx->capacity;
+    rt.msgs = safe_emalloc(rt.capacity, sizeof(*rt.msgs), 0);
+    rt.iov = safe_emalloc(rt.capacity, sizeof(*rt.iov), 0);
+    rt.hdr = safe_emalloc(rt.capacity, sizeof(*rt.hdr), 0);
+    rt.dest = safe_emalloc(rt.capacity, sizeof(*rt.dest), 0);
+    rt.pps = (uint64_t)MAX(quicpro_router_loadbalancer_config.max_forwarding_pps, 1);
+    rt.burst = MAX(rt.pps / 100, (uint64_t)rt.capacity);   /* 10 ms worth */
+    rt.tokens = rt.burst;
+    rt.refilled_ns = qp_rt_now_ns();
+
+    while (*running) {
+        struct epoll_event got;
+        quicpro_worker_wait_begin();
+        int ready = epoll_wait(ep, &got, 1, 100);
+        quicpro_worker_wait_end(ready);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            zend_throw_exception_ex(NULL, 0, "epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+        /* Drain until EAGAIN or the budget, as the listeners do */
+        unsigned budget = (unsigned)quicpro_bare_metal_config.io_max_drain_packets;
+        while (budget) {
+            int n = quicpro_udp_recv_batch(fd, rx);
+            if (n <= 0) {
+                break;
+            }
+            qp_rt_forward(fd, &rt, rx, n);
+            budget = (unsigned)n >= budget ? 0 : budget - (unsigned)n;
+        }
+    }
+
+    close(ep);
+    quicpro_udp_rx_batch_free(rx);
+    qp_rt_free(&rt);
+    qp_rt_ctl_free(&ctl);
+    return EG(exception) ? -1 : 0;
+}
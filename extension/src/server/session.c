@@ -24,6 +24,8 @@
 #include "session.h"               /* quicpro_session_t definition */
 #include "php_quicpro.h"           /* core extension definitions */
 #include "php_quicpro_arginfo.h"   /* PHP_ARGINFO for methods */
+#include "config/app_http3_websockets_webtransport/base_layer.h" /* quicpro.webtransport_enable */
+#include "server/h3_settings.h"     /* SETTINGS from quicpro.h3_* */
 #include <Zend/zend_exceptions.h>   /* zend_throw_exception() */
 #include <quiche.h>                /* quiche_connect, quiche_h3_* APIs */
 #include <openssl/rand.h>          /* RAND_bytes() for generating connection IDs */
@@ -292,6 +294,10 @@ PHP_METHOD(QuicSession, __construct)
 
     /* 7) Initialize HTTP/3 on top of our QUIC transport */
     s->h3_cfg = quiche_h3_config_new();
+    if (s->h3_cfg) {
+        quicpro_h3_settings_apply(s->h3_cfg);
+        quiche_h3_config_enable_extended_connect(s->h3_cfg, quicpro_app_protocols_config.webtransport_enable);
+    }
     s->h3     = quiche_h3_conn_new_with_transport(s->conn, s->h3_cfg);
     if (!s->h3) {
         quiche_conn_free(s->conn);
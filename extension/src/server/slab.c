@@ -0,0 +1,164 @@
+/*
+ * slab.c  –  Fixed-size slab allocator and session pool for php-quicpro
+ * ---------------------------------------------------------------------
+ *
+ * Each chunk starts with a one-cache-line header linking it to the next
+ * chunk; slots follow at QUICPRO_SLAB_ALIGN boundaries. Free slots store
+ * the free-list link in their first bytes. Allocation order: free list,
+ * then the unused tail of the newest chunk, then a fresh chunk.
+ */
+
+#include "php_quicpro.h"
+#include "server/slab.h"
+#include "cluster/cluster_stats.h"
+#include "server/metrics.h"
+#include "server/qlog.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+typedef struct quicpro_slab_chunk_s {
+    struct quicpro_slab_chunk_s *next;
+} quicpro_slab_chunk_t;
+
+typedef struct quicpro_slab_free_s {
+    struct quicpro_slab_free_s *next;
+} quicpro_slab_free_t;
+
+struct quicpro_slab_s {
+    size_t                slot_size;
+    size_t                chunk_size;
+    quicpro_slab_chunk_t *chunks;
+    uint8_t              *bump;       /* Next never-used slot in the newest chunk. */
+    uint8_t              *bump_end;
+    quicpro_slab_free_t  *free_list;
+    size_t                in_use;
+    size_t                mapped;
+};
+
+#define QP_SLAB_HDR  QUICPRO_SLAB_ALIGN
+
+quicpro_slab_t *quicpro_slab_new(size_t obj_size)
+{
+    quicpro_slab_t *s = pecalloc(1, sizeof(*s), 1);
+    if (obj_size < sizeof(quicpro_slab_free_t)) {
+        obj_size = sizeof(quicpro_slab_free_t);
+    }
+    s->slot_size = (obj_size + QUICPRO_SLAB_ALIGN - 1) & ~(size_t)(QUICPRO_SLAB_ALIGN - 1);
+    s->chunk_size = QUICPRO_SLAB_CHUNK_SIZE;
+    while (s->chunk_size < QP_SLAB_HDR + s->slot_size) {
+        s->chunk_size <<= 1;
+    }
+    return s;
+}
+
+void quicpro_slab_destroy(quicpro_slab_t *s)
+{
+    if (!s) {
+        return;
+    }
+    quicpro_slab_chunk_t *c = s->chunks;
+    while (c) {
+        quicpro_slab_chunk_t *next = c->next;
+        munmap(c, s->chunk_size);
+        c = next;
+    }
+    pefree(s, 1);
+}
+
+static bool quicpro_slab_grow(quicpro_slab_t *s)
+{
+    void *mem = mmap(NULL, s->chunk_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return false;
+    }
+#ifdef MADV_HUGEPAGE
+    /* Best effort: one TLB entry for ~1800 sessions. */
+    madvise(mem, s->chunk_size, MADV_HUGEPAGE);
+#endif
+    quicpro_slab_chunk_t *c = mem;
+    c->next = s->chunks;
+    s->chunks = c;
+    s->bump = (uint8_t *)mem + QP_SLAB_HDR;
+    s->bump_end = (uint8_t *)mem + s->chunk_size;
+    s->mapped += s->chunk_size;
+    return true;
+}
+
+void *quicpro_slab_alloc(quicpro_slab_t *s)
+{
+    void *p;
+    if (s->free_list) {
+        p = s->free_list;
+        s->free_list = s->free_list->next;
+    } else {
+        if ((size_t)(s->bump_end - s->bump) < s->slot_size && !quicpro_slab_grow(s)) {
+            return NULL;
+        }
+        p = s->bump;
+        s->bump += s->slot_size;
+    }
+    s->in_use++;
+    return memset(p, 0, s->slot_size);
+}
+
+void quicpro_slab_free(quicpro_slab_t *s, void *p)
+{
+    if (!p) {
+        return;
+    }
+    quicpro_slab_free_t *f = p;
+    f->next = s->free_list;
+    s->free_list = f;
+    s->in_use--;
+}
+
+size_t quicpro_slab_in_use(const quicpro_slab_t *s)
+{
+    return s ? s->in_use : 0;
+}
+
+size_t quicpro_slab_mapped_bytes(const quicpro_slab_t *s)
+{
+    return s ? s->mapped : 0;
+}
+
+/*──────────────────────────── Server session pool ────────────────────────*/
+
+/* Survives requests so a long-running worker keeps recycling the same slots. */
+static quicpro_slab_t *quicpro_session_slab = NULL;
+
+quicpro_session_t *quicpro_server_session_alloc(void)
+{
+    if (!quicpro_session_slab) {
+        quicpro_session_slab = quicpro_slab_new(sizeof(quicpro_session_t));
+    }
+    quicpro_session_t *session = quicpro_slab_alloc(quicpro_session_slab);
+    if (session) {
+        session->sock = -1;
+        session->handshake_started_us = quicpro_metrics_now_us();
+        QUICPRO_WORKER_STAT(connections_accepted);
+    }
+    return session;
+}
+
+void quicpro_session_dtor_internal(void *ptr)
+{
+    quicpro_session_t *session = ptr;
+    if (!session) {
+        return;
+    }
+    /* Userland may still hold the resource; detach it so it cannot reach the recycled slot. */
+    if (session->resource) {
+        session->resource->ptr = NULL;
+        zend_list_close(session->resource);
+        session->resource = NULL;
+    }
+    quicpro_worker_stats_conn_closed(session->conn);
+    quicpro_metrics_conn_closed(session->conn);
+    quicpro_qlog_conn_closed(session);
+    quicpro_session_free_members(session);
+    quicpro_slab_free(quicpro_session_slab, session);
+}
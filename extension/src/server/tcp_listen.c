@@ -0,0 +1,121 @@
+/*
+ * tcp_listen.c  –  Listening sockets for the TCP listeners of php-quicpro
+ * -----------------------------------------------------------------------
+ *
+ * See include/server/tcp_listen.h. Every option is best effort: a kernel
+ * without TCP Fast Open or TCP_DEFER_ACCEPT still serves, it just skips
+ * the saving. Only SO_REUSEPORT, bind() and listen() decide whether the
+ * listener starts.
+ */
+
+#include "php_quicpro.h"
+#include "server/tcp_listen.h"
+#include "config/tcp_transport/base_layer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+static void qp_tcp_setopt(int fd, int level, int name, int value, const char *label)
+{
+    if (setsockopt(fd, level, name, &value, sizeof(value)) < 0) {
+        php_error_docref(NULL, E_NOTICE, "TCP listener runs without %s: %s", label, strerror(errno));
+    }
+}
+
+/* Fills `addr` from an IPv6 or IPv4 literal; IPv4 becomes its mapped IPv6 form */
+static int qp_tcp_addr(struct sockaddr_in6 *addr, const char *host, zend_long port)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sin6_family = AF_INET6;
+    addr->sin6_port = htons((uint16_t)port);
+    if (!host || !host[0] || inet_pton(AF_INET6, host, &addr->sin6_addr) == 1) {
+        return 0;
+    }
+    struct in_addr v4;
+    if (inet_pton(AF_INET, host, &v4) != 1) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (v4.s_addr == htonl(INADDR_ANY)) {
+        return 0;   /* "0.0.0.0" means every address, IPv6 included */
+    }
+    addr->sin6_addr.s6_addr[10] = 0xff;
+    addr->sin6_addr.s6_addr[11] = 0xff;
+    memcpy(&addr->sin6_addr.s6_addr[12], &v4, sizeof(v4));
+    return 0;
+}
+
+int quicpro_tcp_listen(const char *host, zend_long port)
+{
+    const qp_tcp_transport_config_t *cfg = &quicpro_tcp_transport_config;
+    struct sockaddr_in6 addr;
+    if (qp_tcp_addr(&addr, host, port) < 0) {
+        return -1;
+    }
+
+    int fd = socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int on = 1, off = 0;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    if (cfg->tcp_reuse_port_enable && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+        goto fail;
+    }
+
+    /* Inherited by every accepted socket */
+    if (cfg->tcp_nodelay_enable) {
+        qp_tcp_setopt(fd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+    } else if (cfg->tcp_cork_enable) {
+        qp_tcp_setopt(fd, IPPROTO_TCP, TCP_CORK, 1, "TCP_CORK");
+    }
+    if (cfg->tcp_keepalive_enable) {
+        qp_tcp_setopt(fd, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE");
+        qp_tcp_setopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, (int)cfg->tcp_keepalive_time_sec, "TCP_KEEPIDLE");
+        qp_tcp_setopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, (int)cfg->tcp_keepalive_interval_sec, "TCP_KEEPINTVL");
+        qp_tcp_setopt(fd, IPPROTO_TCP, TCP_KEEPCNT, (int)cfg->tcp_keepalive_probes, "TCP_KEEPCNT");
+    }
+    if (cfg->tcp_defer_accept_sec > 0) {
+        qp_tcp_setopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, (int)cfg->tcp_defer_accept_sec, "TCP_DEFER_ACCEPT");
+    }
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        goto fail;
+    }
+    /* After bind: the Fast Open queue belongs to the bound socket */
+    if (cfg->tcp_fastopen_queue_len > 0) {
+        qp_tcp_setopt(fd, IPPROTO_TCP, TCP_FASTOPEN, (int)cfg->tcp_fastopen_queue_len, "TCP Fast Open");
+    }
+    if (listen(fd, (int)cfg->tcp_listen_backlog) < 0) {
+        goto fail;
+    }
+    return fd;
+
+fail:;
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return -1;
+}
+
+int quicpro_tcp_listen_arm(int listen_fd, int epoll_fd, void *data)
+{
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLET | EPOLLEXCLUSIVE, .data.ptr = data };
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+}
+
+int quicpro_tcp_accept(int listen_fd, struct sockaddr_storage *peer)
+{
+    socklen_t peer_len = sizeof(*peer);
+    int fd;
+    do {
+        fd = accept4(listen_fd, (struct sockaddr *)peer, &peer_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    } while (fd < 0 && (errno == EINTR || errno == ECONNABORTED));
+    return fd;
+}
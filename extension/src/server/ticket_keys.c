@@ -0,0 +1,267 @@
+/*
+ * ticket_keys.c  –  Shared TLS session ticket key ring for php-quicpro
+ * --------------------------------------------------------------------
+ *
+ * Slot layout: 16-byte key name, 32-byte HMAC-SHA256 key, 32-byte
+ * AES-256-CBC key. TCP listeners use all of it. quiche (BoringSSL) wants
+ * 48 bytes, name || hmac[0..16) || aes[0..16), which it uses as
+ * HMAC-SHA256 + AES-128-CBC.
+ *
+ * Every slot holds random keys from the start, and the slot before the
+ * first key is never matched as the previous one. Keys come from
+ * RAND_bytes(), which the TLS offload threads may call concurrently with
+ * the listener.
+ */
+
+#include "php_quicpro.h"
+#include "server/ticket_keys.h"
+#include "config/tls_and_crypto/base_layer.h"
+
+#include <limits.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+# include <openssl/core_names.h>
+#else
+# include <openssl/hmac.h>
+#endif
+
+#define QP_TICKET_RING  4
+
+typedef struct {
+    uint8_t  name[QUICPRO_TICKET_KEY_NAME_LEN];
+    uint8_t  hmac[QUICPRO_TICKET_KEY_SECRET_LEN];
+    uint8_t  aes[QUICPRO_TICKET_KEY_SECRET_LEN];
+} quicpro_ticket_key_t;
+
+typedef struct {
+    _Atomic uint64_t     generation;   /* Slot generation % QP_TICKET_RING is current. */
+    pid_t                owner;        /* Only this process rotates. */
+    uint64_t             rotated_at;   /* CLOCK_MONOTONIC seconds. */
+    quicpro_ticket_key_t slot[QP_TICKET_RING];
+} quicpro_ticket_ring_t;
+
+static quicpro_ticket_ring_t *quicpro_ticket_ring = NULL;
+static atomic_flag quicpro_ticket_rotating = ATOMIC_FLAG_INIT;   /* Handshake pool threads tick too */
+
+static inline uint64_t quicpro_ticket_now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec;
+}
+
+static bool quicpro_ticket_keys_fill(quicpro_ticket_key_t *k)
+{
+    return RAND_bytes((unsigned char *)k, sizeof(*k)) == 1;
+}
+
+/*──────────────────────────── Ring lifecycle ─────────────────────────────*/
+
+void quicpro_ticket_keys_prepare(void)
+{
+    if (quicpro_ticket_ring) {
+        return;
+    }
+    void *mem = mmap(NULL, sizeof(quicpro_ticket_ring_t), PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        php_error_docref(NULL, E_WARNING, "Shared session ticket keys unavailable; every worker falls back to its own key");
+        return;
+    }
+
+    quicpro_ticket_ring_t *r = mem;
+    for (int i = 0; i < QP_TICKET_RING; i++) {
+        /* No slot may keep the zeroed pages' all-zero key */
+        if (!quicpro_ticket_keys_fill(&r->slot[i])) {
+            OPENSSL_cleanse(r, sizeof(*r));
+            munmap(mem, sizeof(*r));
+            return;
+        }
+    }
+    r->owner = getpid();
+    r->rotated_at = quicpro_ticket_now_sec();
+    /* Generation 0 means "no key"; the first key lives in slot 1. */
+    atomic_store_explicit(&r->generation, 1, memory_order_release);
+    quicpro_ticket_ring = r;
+}
+
+void quicpro_ticket_keys_release(void)
+{
+    if (quicpro_ticket_ring) {
+        munmap(quicpro_ticket_ring, sizeof(*quicpro_ticket_ring));
+        quicpro_ticket_ring = NULL;
+    }
+}
+
+void quicpro_ticket_keys_tick(void)
+{
+    quicpro_ticket_ring_t *r = quicpro_ticket_ring;
+    if (!r || r->owner != getpid()) {
+        return;
+    }
+    uint64_t now = quicpro_ticket_now_sec();
+    if (now - r->rotated_at < (uint64_t)quicpro_tls_crypto_config.tls_session_ticket_lifetime_sec) {
+        return;
+    }
+
+    if (atomic_flag_test_and_set_explicit(&quicpro_ticket_rotating, memory_order_acquire)) {
+        return;   /* Another thread of this process is rotating */
+    }
+    uint64_t gen = atomic_load_explicit(&r->generation, memory_order_relaxed);
+    if (now - r->rotated_at >= (uint64_t)quicpro_tls_crypto_config.tls_session_ticket_lifetime_sec
+        && quicpro_ticket_keys_fill(&r->slot[(gen + 1) % QP_TICKET_RING])) {
+        r->rotated_at = now;
+        atomic_store_explicit(&r->generation, gen + 1, memory_order_release);
+    }
+    /* On a failed draw the current key stays and the next tick retries */
+    atomic_flag_clear_explicit(&quicpro_ticket_rotating, memory_order_release);
+}
+
+int quicpro_ticket_keys_next_tick_ms(void)
+{
+    quicpro_ticket_ring_t *r = quicpro_ticket_ring;
+    if (!r || r->owner != getpid()) {
+        return -1;
+    }
+    uint64_t lifetime = (uint64_t)quicpro_tls_crypto_config.tls_session_ticket_lifetime_sec;
+    uint64_t age = quicpro_ticket_now_sec() - r->rotated_at;
+    if (age >= lifetime) {
+        return 1000;   /* A draw failed; retry it shortly rather than spin */
+    }
+    uint64_t wait = (lifetime - age) * 1000;
+    return wait > INT_MAX ? INT_MAX : (int)wait;
+}
+
+uint64_t quicpro_ticket_keys_generation(void)
+{
+    return quicpro_ticket_ring ? atomic_load_explicit(&quicpro_ticket_ring->generation, memory_order_acquire) : 0;
+}
+
+/* Copies the current and previous key; returns the generation they belong to. */
+static uint64_t quicpro_ticket_keys_snapshot(quicpro_ticket_key_t *cur, quicpro_ticket_key_t *prev)
+{
+    quicpro_ticket_ring_t *r = quicpro_ticket_ring;
+    for (;;) {
+        uint64_t gen = atomic_load_explicit(&r->generation, memory_order_acquire);
+        *cur = r->slot[gen % QP_TICKET_RING];
+        if (prev) {
+            *prev = r->slot[(gen - 1) % QP_TICKET_RING];
+        }
+        atomic_thread_fence(memory_order_acquire);
+        /* The writer only touches slot gen + 1; two rotations mid-copy would be needed to tear. */
+        if (atomic_load_explicit(&r->generation, memory_order_relaxed) - gen < QP_TICKET_RING - 2) {
+            return gen;
+        }
+    }
+}
+
+/*──────────────────────────── QUIC listeners ─────────────────────────────*/
+
+void quicpro_ticket_keys_apply_quiche(quiche_config *cfg, uint64_t *applied)
+{
+    if (!quicpro_ticket_ring) {
+        quicpro_ticket_keys_prepare();
+        if (!quicpro_ticket_ring) {
+            return;
+        }
+    }
+    quicpro_ticket_keys_tick();
+    if (quicpro_ticket_keys_generation() == *applied) {
+        return;
+    }
+
+    quicpro_ticket_key_t k;
+    uint8_t key[48];
+    *applied = quicpro_ticket_keys_snapshot(&k, NULL);
+    memcpy(key, k.name, 16);
+    memcpy(key + 16, k.hmac, 16);
+    memcpy(key + 32, k.aes, 16);
+    quiche_config_set_ticket_key(cfg, key, sizeof(key));
+    OPENSSL_cleanse(key, sizeof(key));
+    OPENSSL_cleanse(&k, sizeof(k));
+}
+
+/*──────────────────────────── TCP listeners ──────────────────────────────*/
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+typedef EVP_MAC_CTX quicpro_ticket_mac_ctx_t;
+
+static int quicpro_ticket_mac_init(EVP_MAC_CTX *hctx, const uint8_t *key)
+{
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, "SHA256", 0),
+        OSSL_PARAM_construct_end()
+    };
+    return EVP_MAC_init(hctx, key, QUICPRO_TICKET_KEY_SECRET_LEN, params);
+}
+#else
+typedef HMAC_CTX quicpro_ticket_mac_ctx_t;
+
+static int quicpro_ticket_mac_init(HMAC_CTX *hctx, const uint8_t *key)
+{
+    return HMAC_Init_ex(hctx, key, QUICPRO_TICKET_KEY_SECRET_LEN, EVP_sha256(), NULL);
+}
+#endif
+
+/* enc: 1 = issue (returns 1), 0 = decrypt (1 ok, 2 ok but renew, 0 unknown key). */
+static int quicpro_ticket_key_cb(SSL *ssl, unsigned char *key_name, unsigned char *iv,
+                                 EVP_CIPHER_CTX *ectx, quicpro_ticket_mac_ctx_t *hctx, int enc)
+{
+    (void)ssl;
+    quicpro_ticket_key_t cur, prev;
+    int rc = 0;
+
+    quicpro_ticket_keys_tick();
+    uint64_t gen = quicpro_ticket_keys_snapshot(&cur, &prev);
+
+    if (enc) {
+        if (RAND_bytes(iv, EVP_MAX_IV_LENGTH) == 1) {
+            memcpy(key_name, cur.name, QUICPRO_TICKET_KEY_NAME_LEN);
+            if (EVP_EncryptInit_ex(ectx, EVP_aes_256_cbc(), NULL, cur.aes, iv) == 1
+                && quicpro_ticket_mac_init(hctx, cur.hmac) == 1) {
+                rc = 1;
+            } else {
+                rc = -1;
+            }
+        } else {
+            rc = -1;
+        }
+    } else {
+        const quicpro_ticket_key_t *k = NULL;
+        if (memcmp(key_name, cur.name, QUICPRO_TICKET_KEY_NAME_LEN) == 0) {
+            k = &cur;
+            rc = 1;
+        } else if (gen > 1 && memcmp(key_name, prev.name, QUICPRO_TICKET_KEY_NAME_LEN) == 0) {
+            k = &prev;
+            rc = 2;   /* Valid, but re-issue under the current key */
+        }
+        if (k && (EVP_DecryptInit_ex(ectx, EVP_aes_256_cbc(), NULL, k->aes, iv) != 1
+                  || quicpro_ticket_mac_init(hctx, k->hmac) != 1)) {
+            rc = -1;
+        }
+    }
+
+    OPENSSL_cleanse(&cur, sizeof(cur));
+    OPENSSL_cleanse(&prev, sizeof(prev));
+    return rc;
+}
+
+void quicpro_ticket_keys_install(SSL_CTX *ctx)
+{
+    quicpro_ticket_keys_prepare();
+    if (!quicpro_ticket_ring) {
+        return;   /* OpenSSL keeps its per-context random key */
+    }
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, quicpro_ticket_key_cb);
+#else
+    SSL_CTX_set_tlsext_ticket_key_cb(ctx, quicpro_ticket_key_cb);
+#endif
+}
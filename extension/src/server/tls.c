@@ -24,6 +24,8 @@
 
 #include "php_quicpro.h"               /* Core extension declarations */
 #include "php_quicpro_arginfo.h"       /* Arginfo metadata for these functions */
+#include "poll/txstamp.h"              /* quicpro_txstamp_add_stats() */
+#include "poll/udp_batch.h"            /* Received ECN codepoints */
 
 #include <quiche.h>                    /* quiche QUIC + HTTP/3 API */
 #include <openssl/ssl.h>               /* OpenSSL SSL/TLS APIs */
@@ -184,6 +186,16 @@ PHP_FUNCTION(quicpro_import_session_ticket)
  *   3. Call quiche_conn_stats() to get per‑packet counters.
  *   4. Call quiche_conn_path_stats() for RTT and cwnd.
  *   5. Populate a PHP array with these metrics and return it.
+ *   6. Append the kernel timestamp data: `last_rx_ts_ns` and, once
+ *      timestamping is enabled, `tx_timestamps` with the sched / send /
+ *      wire / nic_rtt latency histograms (see include/poll/txstamp.h).
+ *   7. Append the ECN codepoints received so far, `ecn_rx_ect0`,
+ *      `ecn_rx_ect1` and `ecn_rx_ce`, counted by the recvmmsg() engine
+ *      (see include/poll/udp_batch.h).
+ *
+ * For every connection of a listener or reactor in one call, see
+ * Quicpro\Server::connectionStats() and quicpro_reactor_stats()
+ * (include/server/conn_stats.h).
  */
 PHP_FUNCTION(quicpro_get_stats)
 {
@@ -215,6 +227,16 @@ PHP_FUNCTION(quicpro_get_stats)
     add_assoc_long(return_value, "lost",   (zend_long)qs.lost);
     add_assoc_long(return_value, "rtt_ns", (zend_long)ps.rtt);
     add_assoc_long(return_value, "cwnd",   (zend_long)ps.cwnd);
+
+    /* Kernel RX stamp of the newest datagram and TX latency histograms */
+    quicpro_txstamp_add_stats(s, return_value);
+
+    /* quiche never sees the marks; these are the only record of them */
+    const uint64_t *ecn = s->rx_batch ? s->rx_batch->ecn_rx : NULL;
+    const uint64_t *rel = s->ecn_rx_released;   /* Batches released while idle (poll/hibernate.h) */
+    add_assoc_long(return_value, "ecn_rx_ect0", (zend_long)(rel[QUICPRO_ECN_ECT0] + (ecn ? ecn[QUICPRO_ECN_ECT0] : 0)));
+    add_assoc_long(return_value, "ecn_rx_ect1", (zend_long)(rel[QUICPRO_ECN_ECT1] + (ecn ? ecn[QUICPRO_ECN_ECT1] : 0)));
+    add_assoc_long(return_value, "ecn_rx_ce",   (zend_long)(rel[QUICPRO_ECN_CE]   + (ecn ? ecn[QUICPRO_ECN_CE]   : 0)));
 }
 
 
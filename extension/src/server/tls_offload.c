@@ -0,0 +1,291 @@
+/*
+ * tls_offload.c  –  Off-loop TLS handshakes for the php-quicpro TCP listeners
+ * ---------------------------------------------------------------------------
+ *
+ * Thread pool protocol:
+ *
+ *   loop    step()   in_flight = true, push on `queue`, signal
+ *   worker           pop, SSL_accept until it blocks or finishes,
+ *                    push on `done`, write the eventfd
+ *   loop    reap()   in_flight = false; hand back finished handshakes and
+ *                    those whose socket fired meanwhile (`rearm`)
+ *
+ * `in_flight`, `rearm` and `has_result` are only touched by the loop;
+ * `result` is written by the worker before the hand-off under `lock`.
+ */
+
+#include "php_quicpro.h"
+#include "server/tls_offload.h"
+#include "cluster/cluster_stats.h"
+#include "config/tls_and_crypto/base_layer.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+
+struct quicpro_tls_offload_s {
+    pthread_mutex_t          lock;
+    pthread_cond_t           wake;
+    quicpro_tls_handshake_t *queue_head;
+    quicpro_tls_handshake_t *queue_tail;
+    quicpro_tls_handshake_t *done;
+    bool                     stopping;
+    int                      done_fd;
+    int                      nthreads;
+    pthread_t                threads[];
+};
+
+/*──────────────────────────── Handshake steps ────────────────────────────*/
+
+/* Mirrors the engine's wait fds into the loop's epoll set. */
+static void quicpro_tls_async_sync(quicpro_tls_handshake_t *hs)
+{
+#ifdef SSL_MODE_ASYNC
+    size_t nadd = 0, ndel = 0;
+    if (!SSL_get_changed_async_fds(hs->ssl, NULL, &nadd, NULL, &ndel) || (nadd == 0 && ndel == 0)) {
+        return;
+    }
+    OSSL_ASYNC_FD add[nadd + 1], del[ndel + 1];
+    SSL_get_changed_async_fds(hs->ssl, add, &nadd, del, &ndel);
+
+    for (size_t i = 0; i < ndel; i++) {
+        epoll_ctl(hs->epoll_fd, EPOLL_CTL_DEL, del[i], NULL);
+    }
+    for (size_t i = 0; i < nadd; i++) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = hs->owner };
+        epoll_ctl(hs->epoll_fd, EPOLL_CTL_ADD, add[i], &ev);
+    }
+#else
+    (void)hs;
+#endif
+}
+
+static int quicpro_tls_handshake_run(quicpro_tls_handshake_t *hs)
+{
+    ERR_clear_error();
+    int ret = SSL_accept(hs->ssl);
+    if (ret == 1) {
+        quicpro_tls_async_sync(hs);
+        return QUICPRO_TLS_HS_DONE;
+    }
+    return quicpro_tls_io_pending(hs, ret) ? QUICPRO_TLS_HS_PENDING : QUICPRO_TLS_HS_FAILED;
+}
+
+bool quicpro_tls_io_pending(quicpro_tls_handshake_t *hs, int ret)
+{
+    switch (SSL_get_error(hs->ssl, ret)) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            return true;
+#ifdef SSL_ERROR_WANT_ASYNC
+        case SSL_ERROR_WANT_ASYNC:
+            quicpro_tls_async_sync(hs);
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+void quicpro_tls_handshake_forget(quicpro_tls_handshake_t *hs)
+{
+#ifdef SSL_MODE_ASYNC
+    size_t n = 0;
+    if (!hs->ssl || !SSL_get_all_async_fds(hs->ssl, NULL, &n) || n == 0) {
+        return;
+    }
+    OSSL_ASYNC_FD fds[n];
+    SSL_get_all_async_fds(hs->ssl, fds, &n);
+    for (size_t i = 0; i < n; i++) {
+        epoll_ctl(hs->epoll_fd, EPOLL_CTL_DEL, fds[i], NULL);
+    }
+#else
+    (void)hs;
+#endif
+}
+
+void quicpro_tls_handshake_init(quicpro_tls_handshake_t *hs, SSL *ssl, int epoll_fd, void *owner)
+{
+    memset(hs, 0, sizeof(*hs));
+    hs->ssl = ssl;
+    hs->epoll_fd = epoll_fd;
+    hs->owner = owner;
+}
+
+static void quicpro_tls_offload_submit(quicpro_tls_offload_t *o, quicpro_tls_handshake_t *hs)
+{
+    hs->in_flight = true;
+    hs->rearm = false;
+    hs->next = NULL;
+
+    pthread_mutex_lock(&o->lock);
+    if (o->queue_tail) {
+        o->queue_tail->next = hs;
+    } else {
+        o->queue_head = hs;
+    }
+    o->queue_tail = hs;
+    pthread_cond_signal(&o->wake);
+    pthread_mutex_unlock(&o->lock);
+}
+
+int quicpro_tls_handshake_step(quicpro_tls_offload_t *o, quicpro_tls_handshake_t *hs)
+{
+    int result;
+    if (!o) {
+        result = quicpro_tls_handshake_run(hs);
+    } else if (hs->in_flight) {
+        hs->rearm = true;   /* Edge-triggered: remember it for reap() */
+        return QUICPRO_TLS_HS_PENDING;
+    } else if (hs->has_result) {
+        hs->has_result = false;
+        result = hs->result;
+    } else {
+        quicpro_tls_offload_submit(o, hs);
+        return QUICPRO_TLS_HS_PENDING;
+    }
+    if (result == QUICPRO_TLS_HS_DONE) {
+        QUICPRO_WORKER_STAT(handshakes_ok);
+    } else if (result == QUICPRO_TLS_HS_FAILED) {
+        QUICPRO_WORKER_STAT(handshakes_failed);
+    }
+    return result;
+}
+
+/*──────────────────────────── Thread pool ────────────────────────────────*/
+
+static void *quicpro_tls_offload_worker(void *arg)
+{
+    quicpro_tls_offload_t *o = arg;
+
+    pthread_mutex_lock(&o->lock);
+    for (;;) {
+        while (!o->queue_head && !o->stopping) {
+            pthread_cond_wait(&o->wake, &o->lock);
+        }
+        if (o->stopping) {
+            break;
+        }
+        quicpro_tls_handshake_t *hs = o->queue_head;
+        o->queue_head = hs->next;
+        if (!o->queue_head) {
+            o->queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&o->lock);
+
+        int result = quicpro_tls_handshake_run(hs);
+
+        pthread_mutex_lock(&o->lock);
+        hs->result = result;
+        hs->next = o->done;
+        o->done = hs;
+        uint64_t one = 1;
+        (void)!write(o->done_fd, &one, sizeof(one));
+    }
+    pthread_mutex_unlock(&o->lock);
+    return NULL;
+}
+
+quicpro_tls_offload_t *quicpro_tls_offload_new(SSL_CTX *ctx)
+{
+    const char *mode = quicpro_tls_crypto_config.tls_tcp_handshake_offload;
+
+    if (strcasecmp(mode, "async") == 0) {
+#ifdef SSL_MODE_ASYNC
+        SSL_CTX_set_mode(ctx, SSL_MODE_ASYNC);
+#else
+        php_error_docref(NULL, E_WARNING, "This OpenSSL has no async mode; TLS handshakes run inline");
+#endif
+        return NULL;
+    }
+    if (strcasecmp(mode, "threads") != 0) {
+        return NULL;
+    }
+
+    int n = (int)quicpro_tls_crypto_config.tls_tcp_handshake_threads;
+    quicpro_tls_offload_t *o = pecalloc(1, sizeof(*o) + (size_t)n * sizeof(pthread_t), 1);
+    pthread_mutex_init(&o->lock, NULL);
+    pthread_cond_init(&o->wake, NULL);
+    o->done_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (o->done_fd < 0) {
+        php_error_docref(NULL, E_WARNING, "TLS handshake pool unavailable (eventfd: %s); handshakes run inline", strerror(errno));
+        quicpro_tls_offload_destroy(o);
+        return NULL;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (pthread_create(&o->threads[i], NULL, quicpro_tls_offload_worker, o) != 0) {
+            break;
+        }
+        o->nthreads++;
+    }
+    if (o->nthreads == 0) {
+        php_error_docref(NULL, E_WARNING, "TLS handshake pool could not start a thread; handshakes run inline");
+        quicpro_tls_offload_destroy(o);
+        return NULL;
+    }
+    return o;
+}
+
+void quicpro_tls_offload_destroy(quicpro_tls_offload_t *o)
+{
+    if (!o) {
+        return;
+    }
+    pthread_mutex_lock(&o->lock);
+    o->stopping = true;
+    pthread_cond_broadcast(&o->wake);
+    pthread_mutex_unlock(&o->lock);
+
+    for (int i = 0; i < o->nthreads; i++) {
+        pthread_join(o->threads[i], NULL);
+    }
+    if (o->done_fd >= 0) {
+        close(o->done_fd);
+    }
+    pthread_cond_destroy(&o->wake);
+    pthread_mutex_destroy(&o->lock);
+    pefree(o, 1);
+}
+
+void quicpro_tls_offload_watch(quicpro_tls_offload_t *o, int epoll_fd)
+{
+    if (o) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = o };
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, o->done_fd, &ev);
+    }
+}
+
+quicpro_tls_handshake_t *quicpro_tls_offload_reap(quicpro_tls_offload_t *o)
+{
+    uint64_t count;
+    (void)!read(o->done_fd, &count, sizeof(count));
+
+    pthread_mutex_lock(&o->lock);
+    quicpro_tls_handshake_t *hs = o->done;
+    o->done = NULL;
+    pthread_mutex_unlock(&o->lock);
+
+    quicpro_tls_handshake_t *ready = NULL;
+    while (hs) {
+        quicpro_tls_handshake_t *next = hs->next;
+        hs->in_flight = false;
+        if (hs->result != QUICPRO_TLS_HS_PENDING) {
+            hs->has_result = true;
+        } else if (!hs->rearm) {
+            hs = next;   /* Blocked on the socket; its next edge steps it */
+            continue;
+        }
+        hs->next = ready;
+        ready = hs;
+        hs = next;
+    }
+    return ready;
+}
@@ -0,0 +1,107 @@
+/*
+ * tls_output.c  –  Record-sized output batching for the php-quicpro TCP listeners
+ * -------------------------------------------------------------------------------
+ *
+ * Writes are never partial: without SSL_MODE_ENABLE_PARTIAL_WRITE,
+ * SSL_write_ex() either takes the whole buffer or reports that it must be
+ * called again with it. `*done` therefore only moves after a write has
+ * succeeded. A retry computes the same pointer and length from it.
+ */
+
+#include "php_quicpro.h"
+#include "server/tls_output.h"
+
+#include <string.h>
+
+void quicpro_tls_output_init(quicpro_tls_output_t *o)
+{
+    o->stage = NULL;
+    o->stage_len = 0;
+    o->stage_busy = false;
+}
+
+void quicpro_tls_output_free(quicpro_tls_output_t *o)
+{
+    if (o->stage) {
+        efree(o->stage);
+    }
+    quicpro_tls_output_init(o);
+}
+
+size_t quicpro_tls_output_stage(quicpro_tls_output_t *o, const void *p, size_t len)
+{
+    if (o->stage_busy) {
+        return 0;
+    }
+    if (!o->stage) {
+        o->stage = emalloc(QUICPRO_TLS_RECORD_MAX);
+    }
+    size_t room = QUICPRO_TLS_RECORD_MAX - o->stage_len;
+    if (len > room) {
+        len = room;
+    }
+    memcpy(o->stage + o->stage_len, p, len);
+    o->stage_len += len;
+    return len;
+}
+
+int quicpro_tls_output_write(quicpro_tls_handshake_t *hs, const void *p, size_t len)
+{
+    size_t written;
+    if (SSL_write_ex(hs->ssl, p, len, &written) == 1) {
+        return 1;
+    }
+    return quicpro_tls_io_pending(hs, 0) ? 0 : -1;
+}
+
+int quicpro_tls_output_flush(quicpro_tls_handshake_t *hs, quicpro_tls_output_t *o)
+{
+    if (o->stage_len == 0) {
+        return 1;
+    }
+    int ret = quicpro_tls_output_write(hs, o->stage, o->stage_len);
+    if (ret <= 0) {
+        o->stage_busy = ret == 0;
+        return ret;
+    }
+    o->stage_len = 0;
+    o->stage_busy = false;
+    return 1;
+}
+
+int quicpro_tls_output_gather(quicpro_tls_handshake_t *hs, quicpro_tls_output_t *o,
+                              const quicpro_tls_iov_t *iov, size_t iovcnt, size_t *done, bool hold_tail)
+{
+    for (;;) {
+        size_t skip = *done, i = 0;
+        while (i < iovcnt && skip >= iov[i].len) {
+            skip -= iov[i].len;
+            i++;
+        }
+        if (i == iovcnt) {
+            return hold_tail ? 1 : quicpro_tls_output_flush(hs, o);
+        }
+
+        const char *p = iov[i].base + skip;
+        size_t rem = iov[i].len - skip;
+
+        if (o->stage_len == 0 && rem >= QUICPRO_TLS_OUTPUT_DIRECT_MIN) {
+            size_t n = rem < QUICPRO_TLS_OUTPUT_DIRECT_MAX ? rem : QUICPRO_TLS_OUTPUT_DIRECT_MAX;
+            int ret = quicpro_tls_output_write(hs, p, n);
+            if (ret <= 0) {
+                return ret;
+            }
+            *done += n;
+            continue;
+        }
+
+        size_t took = quicpro_tls_output_stage(o, p, rem);
+        *done += took;
+        if (took < rem) {
+            int ret = quicpro_tls_output_flush(hs, o);   /* Full (or still busy): send the record */
+            if (ret <= 0) {
+                return ret;
+            }
+        }
+    }
+}
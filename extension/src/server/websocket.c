@@ -13,8 +13,18 @@
 #include "session.h"
 #include "cancel.h"
 #include "mcp.h" /* For quicpro_mcp_connect if used by ws_connect */
+#include "server/ws_frame.h"
+#include "server/ws_deflate.h"
+#include "websocket/websocket.h"
+#include "config/app_http3_websockets_webtransport/base_layer.h"
+#include "poll/poll.h"
+#include "poll/scheduler.h"
 
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
 #include <quiche.h>
+#include <time.h>
 #include <zend_API.h>
 #include <zend_exceptions.h>
 #include <zend_smart_str.h>
@@ -36,6 +46,13 @@ typedef enum {
     WS_STATE_CLOSED
 } quicpro_ws_state_t;
 
+/* A frame waiting for stream credit. Broadcast frames are shared, so `frame` is refcounted. */
+typedef struct _quicpro_ws_out {
+    zend_string *frame;
+    size_t off;                 /* Bytes of `frame` already accepted by the stream */
+    struct _quicpro_ws_out *next;
+} quicpro_ws_out_t;
+
 /*
  * C struct to represent an active WebSocket connection.
  * This will be managed as a PHP resource of type `le_quicpro_ws`.
@@ -45,10 +62,61 @@ typedef struct _quicpro_ws_conn_internal {
     uint64_t stream_id;         /* The QUIC stream ID used for this WebSocket connection */
     quicpro_ws_state_t state;   /* The current state of the WebSocket connection */
     zend_string *last_error;    /* Last error message specific to this connection */
-    /* Buffers for handling fragmented frames would be added here */
-    smart_str read_buffer;
+    /*
+     * Receive side. Only a partial header, or a whole control frame, is ever
+     * buffered here; data payloads stream straight to the caller.
+     */
+    uint8_t rx_buf[QUICPRO_WS_MAX_HEADER + 125];
+    size_t rx_len;
+    quicpro_ws_frame_t rx_frame; /* The data frame whose payload is being read */
+    uint64_t rx_left;           /* Payload bytes of rx_frame not read yet */
+    uint64_t rx_off;            /* Payload bytes of rx_frame read so far (mask phase) */
+    zend_bool rx_in_frame;
+    zend_bool peer_fin;         /* The peer finished the QUIC stream */
+    /* Message being reassembled from its fragments */
+    zend_bool msg_active;
+    zend_bool msg_binary;
+    zend_bool msg_compressed;
+    size_t msg_len;             /* Decoded bytes so far, bounded by websocket_default_max_payload_size */
+    smart_str message;          /* quicpro_ws_receive(): the message so far */
+    quicpro_ws_deflate_t *deflate; /* NULL unless permessage-deflate was negotiated */
+    zend_bool is_server;        /* Accepted side of the upgrade: frames go out unmasked */
+    /* Frames the stream has not taken yet, oldest first */
+    quicpro_ws_out_t *out_head;
+    quicpro_ws_out_t *out_tail;
+    size_t out_bytes;
 } quicpro_ws_conn_internal_t;
 
+static void ws_hub_forget(quicpro_ws_conn_internal_t *ws_conn);
+static void ws_drop_queue(quicpro_ws_conn_internal_t *ws_conn);
+
+/*
+ * Worker-wide codec counters for quicpro_ws_get_stats(). `bytes_copied`
+ * counts every byte of a frame moved between buffers on our side: into a
+ * frame being built, into and out of the QUIC stream, and out of rx_buf.
+ */
+static struct {
+    uint64_t frames_sent, frames_received;
+    uint64_t wire_bytes_sent, wire_bytes_received;
+    uint64_t bytes_copied;
+    uint64_t mask_bytes, mask_ns;
+    uint64_t deflate_in, deflate_out, inflate_in, inflate_out;
+} ws_stats;
+
+static uint64_t ws_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* quicpro_ws_mask_copy() with its time and volume added to ws_stats. */
+static void ws_mask_copy(uint8_t *dst, const uint8_t *src, size_t len, const uint8_t mask[4], size_t offset) {
+    uint64_t start = ws_now_ns();
+    quicpro_ws_mask_copy(dst, src, len, mask, offset);
+    ws_stats.mask_ns += ws_now_ns() - start;
+    ws_stats.mask_bytes += len;
+}
+
 
 /* --- Resource Destructor --- */
 /* This function is called by the Zend Engine when a WebSocket resource is garbage collected. */
@@ -63,92 +131,480 @@ static void quicpro_ws_conn_dtor(zend_resource *rsrc) {
         if (ws_conn->last_error) {
             zend_string_release(ws_conn->last_error);
         }
-        smart_str_free(&ws_conn->read_buffer);
+        smart_str_free(&ws_conn->message);
+        quicpro_ws_deflate_free(ws_conn->deflate);
+        ws_hub_forget(ws_conn);
+        ws_drop_queue(ws_conn);
         efree(ws_conn);
     }
 }
 
 /* --- Static Helper Functions --- */
 
+/* --- Send Queue --- */
+
+static void ws_drop_queue(quicpro_ws_conn_internal_t *ws_conn) {
+    while (ws_conn->out_head) {
+        quicpro_ws_out_t *o = ws_conn->out_head;
+        ws_conn->out_head = o->next;
+        zend_string_release(o->frame);
+        efree(o);
+    }
+    ws_conn->out_tail = NULL;
+    ws_conn->out_bytes = 0;
+}
+
+/* Queues a reference to `frame` behind anything already waiting. */
+static void ws_enqueue(quicpro_ws_conn_internal_t *ws_conn, zend_string *frame) {
+    quicpro_ws_out_t *o = emalloc(sizeof(*o));
+    o->frame = zend_string_copy(frame);
+    o->off = 0;
+    o->next = NULL;
+    if (ws_conn->out_tail) {
+        ws_conn->out_tail->next = o;
+    } else {
+        ws_conn->out_head = o;
+    }
+    ws_conn->out_tail = o;
+    ws_conn->out_bytes += ZSTR_LEN(frame);
+    ws_stats.frames_sent++;
+}
+
 /*
- * Creates a WebSocket frame header for a client-to-server message.
- * A full implementation would handle masking, larger payload lengths, etc.
- * This is a simplified version for unfragmented text/binary messages.
+ * Hands queued frames to the QUIC stream until it runs out of flow-control
+ * credit. Returns 0, or the quiche error that broke the stream (the queue
+ * is then dropped and the connection closed).
  */
-static void create_ws_frame_header(smart_str *buf, uint8_t opcode, size_t payload_len, zend_bool is_masked) {
-    uint8_t header[14];
-    size_t header_len = 0;
-
-    /* First byte: FIN bit set (for unfragmented message) and opcode */
-    header[0] = 0x80 | (opcode & 0x0F);
-
-    /* Second byte: Mask bit and payload length */
-    header[1] = is_masked ? 0x80 : 0x00;
-    if (payload_len <= 125) {
-        header[1] |= (uint8_t)payload_len;
-        header_len = 2;
-    } else if (payload_len <= 65535) {
-        header[1] |= 126;
-        header[2] = (uint8_t)(payload_len >> 8);
-        header[3] = (uint8_t)(payload_len & 0xFF);
-        header_len = 4;
-    } else {
-        header[1] |= 127;
-        uint64_t len64 = payload_len; // Use 64-bit var for shifting
-        header[2] = (uint8_t)(len64 >> 56);
-        header[3] = (uint8_t)(len64 >> 48);
-        header[4] = (uint8_t)(len64 >> 40);
-        header[5] = (uint8_t)(len64 >> 32);
-        header[6] = (uint8_t)(len64 >> 24);
-        header[7] = (uint8_t)(len64 >> 16);
-        header[8] = (uint8_t)(len64 >> 8);
-        header[9] = (uint8_t)(len64 & 0xFF);
-        header_len = 10;
+static ssize_t ws_flush(quicpro_ws_conn_internal_t *ws_conn) {
+    while (ws_conn->out_head) {
+        quicpro_ws_out_t *o = ws_conn->out_head;
+        size_t left = ZSTR_LEN(o->frame) - o->off;
+        ssize_t n = quiche_stream_send(ws_conn->session->conn, ws_conn->stream_id, (uint8_t *)ZSTR_VAL(o->frame) + o->off, left, 0 /* fin=false, stream stays open */);
+
+        if (n == QUICHE_ERR_DONE) {
+            return 0;   /* Blocked; the rest goes out on a later flush */
+        }
+        if (n < 0) {
+            ws_drop_queue(ws_conn);
+            ws_conn->state = WS_STATE_CLOSED;
+            return n;
+        }
+        ws_conn->out_bytes -= (size_t)n;
+        ws_stats.wire_bytes_sent += (uint64_t)n;
+        ws_stats.bytes_copied += (uint64_t)n;
+        if ((size_t)n < left) {
+            o->off += (size_t)n;
+            return 0;
+        }
+        ws_conn->out_head = o->next;
+        if (!ws_conn->out_head) {
+            ws_conn->out_tail = NULL;
+        }
+        zend_string_release(o->frame);
+        efree(o);
+    }
+    return 0;
+}
+
+/* An unmasked (server-to-client) frame around `payload`. */
+static zend_string *ws_server_frame(uint8_t opcode, uint8_t rsv, const char *payload, size_t len) {
+    zend_string *frame = zend_string_alloc(quicpro_ws_frame_size(len, 0), 0);
+    size_t header_len = quicpro_ws_frame_header((uint8_t *)ZSTR_VAL(frame), 1 /* fin */, rsv, opcode, len, NULL);
+    memcpy(ZSTR_VAL(frame) + header_len, payload, len);
+    ZSTR_VAL(frame)[ZSTR_LEN(frame)] = '\0';
+    ws_stats.bytes_copied += len;
+    return frame;
+}
+
+/* A control frame from our side: masked unless we are the server. NULL if no mask key could be made. */
+static zend_string *ws_control_frame(quicpro_ws_conn_internal_t *ws_conn, uint8_t opcode, const uint8_t *payload, size_t len) {
+    if (ws_conn->is_server) {
+        return ws_server_frame(opcode, 0, (const char *)payload, len);
+    }
+    uint8_t mask[4];
+    if (RAND_bytes(mask, sizeof(mask)) != 1) {
+        return NULL;
     }
+    zend_string *frame = zend_string_alloc(quicpro_ws_frame_size(len, 1), 0);
+    uint8_t *out = (uint8_t *)ZSTR_VAL(frame);
+    size_t header_len = quicpro_ws_frame_header(out, 1 /* fin */, 0, opcode, len, mask);
+    ws_mask_copy(out + header_len, payload, len, mask, 0);
+    ws_stats.bytes_copied += len;
+    return frame;
+}
+
+static void ws_send_control(quicpro_ws_conn_internal_t *ws_conn, uint8_t opcode, const uint8_t *payload, size_t len) {
+    zend_string *frame = ws_control_frame(ws_conn, opcode, payload, len);
+    if (frame) {
+        ws_enqueue(ws_conn, frame);
+        zend_string_release(frame);
+        ws_flush(ws_conn);
+    }
+}
+
+/* --- Receive --- */
+
+static void ws_set_error(quicpro_ws_conn_internal_t *ws_conn, zend_string *msg) {
+    if (ws_conn->last_error) {
+        zend_string_release(ws_conn->last_error);
+    }
+    ws_conn->last_error = msg;
+}
 
-    smart_str_appendl(buf, (char*)header, header_len);
+/* Fails the connection: a Close frame with `code` goes out and nothing more is read. Returns -1. */
+static int ws_fail(quicpro_ws_conn_internal_t *ws_conn, uint16_t code, const char *why) {
+    const uint8_t status[2] = { (uint8_t)(code >> 8), (uint8_t)code };
+    if (ws_conn->state == WS_STATE_OPEN) {
+        ws_send_control(ws_conn, WS_OPCODE_CLOSE, status, sizeof(status));
+    }
+    ws_set_error(ws_conn, zend_string_init(why, strlen(why), 0));
+    ws_conn->state = WS_STATE_CLOSED;
+    return -1;
+}
+
+/* Reads up to `cap` bytes off the stream: 0 when none are available, <0 on a stream error. */
+static ssize_t ws_stream_read(quicpro_ws_conn_internal_t *ws_conn, uint8_t *dst, size_t cap) {
+    bool fin = false;
+    ssize_t n = quiche_stream_recv(ws_conn->session->conn, ws_conn->stream_id, dst, cap, &fin);
+    if (fin) {
+        ws_conn->peer_fin = true;
+    }
+    if (n > 0) {
+        ws_stats.wire_bytes_received += (uint64_t)n;
+        ws_stats.bytes_copied += (uint64_t)n;
+    }
+    return n == QUICHE_ERR_DONE ? 0 : n;
+}
+
+/* Reads until rx_buf holds `want` bytes; false if the stream has no more for now. */
+static bool ws_rx_fill(quicpro_ws_conn_internal_t *ws_conn, size_t want, ssize_t *err) {
+    while (ws_conn->rx_len < want) {
+        ssize_t n = ws_stream_read(ws_conn, ws_conn->rx_buf + ws_conn->rx_len, want - ws_conn->rx_len);
+        if (n <= 0) {
+            *err = n;
+            return false;
+        }
+        ws_conn->rx_len += (size_t)n;
+    }
+    return true;
+}
+
+static void ws_rx_consume(quicpro_ws_conn_internal_t *ws_conn, size_t n) {
+    ws_conn->rx_len -= n;
+    memmove(ws_conn->rx_buf, ws_conn->rx_buf + n, ws_conn->rx_len);
+}
+
+/* Answers a complete control frame. */
+static void ws_on_control(quicpro_ws_conn_internal_t *ws_conn, uint8_t opcode, const uint8_t *payload, size_t len) {
+    switch (opcode) {
+        case WS_OPCODE_PING:
+            ws_send_control(ws_conn, WS_OPCODE_PONG, payload, len);
+            break;
+
+        case WS_OPCODE_CLOSE: {
+            uint16_t code = len >= 2 ? (uint16_t)((payload[0] << 8) | payload[1]) : 1005;
+            if (ws_conn->state == WS_STATE_OPEN) {
+                /* Echo the status code, then stop (RFC 6455 §5.5.1) */
+                ws_send_control(ws_conn, WS_OPCODE_CLOSE, payload, len >= 2 ? 2 : 0);
+            }
+            ws_set_error(ws_conn, strpprintf(0, "WebSocket closed by peer (code %u)", code));
+            ws_conn->state = WS_STATE_CLOSED;
+            break;
+        }
+
+        default:    /* PONG */
+            break;
+    }
+}
+
+/* The stream from the peer stopped without a Close frame. */
+static int ws_rx_dry(quicpro_ws_conn_internal_t *ws_conn, ssize_t err, size_t produced) {
+    if (err < 0) {
+        return ws_fail(ws_conn, 1006, "WebSocket stream failed while reading");
+    }
+    if (produced) {
+        return 1;
+    }
+    if (ws_conn->peer_fin) {
+        ws_set_error(ws_conn, zend_string_init("WebSocket stream ended without a Close frame",
+                                               sizeof("WebSocket stream ended without a Close frame") - 1, 0));
+        ws_conn->state = WS_STATE_CLOSED;
+        return -1;
+    }
+    return 0;
 }
 
 /*
- * Parses a WebSocket frame header from the read buffer.
- * Returns the opcode and payload length. A full implementation would also return FIN, RSV bits, and masking key.
- * This is a simplified version.
+ * Decodes whatever the stream has for the current message and appends up
+ * to `limit` payload bytes of it to `out` (more once inflated). Control
+ * frames in between are answered on the way. Fragments are joined; the
+ * call stops at a message's end and sets `*msg_fin`, so two messages never
+ * share a chunk.
+ * Returns 1 with data or a message end, 0 if the stream has nothing now,
+ * -1 once the connection is closed (last_error says why).
  */
-static zend_bool parse_ws_frame_header(smart_str *read_buffer, uint8_t *opcode_out, uint64_t *payload_len_out, size_t *header_len_out) {
-    if (read_buffer->s == NULL || ZSTR_LEN(read_buffer->s) < 2) return 0; // Not enough data for a minimal header
-
-    const unsigned char *p = (const unsigned char*)ZSTR_VAL(read_buffer->s);
-    size_t buffer_len = ZSTR_LEN(read_buffer->s);
-    zend_bool fin = (p[0] & 0x80);
-    *opcode_out = (p[0] & 0x0F);
-
-    zend_bool is_masked = (p[1] & 0x80);
-    uint64_t len = (p[1] & 0x7F);
-    size_t current_pos = 2;
-
-    if (len == 126) {
-        if (buffer_len < 4) return 0;
-        *payload_len_out = ((uint64_t)p[2] << 8) | p[3];
-        current_pos = 4;
-    } else if (len == 127) {
-        if (buffer_len < 10) return 0;
-        /* Note: zend_long might truncate on 32-bit PHP. Use uint64_t. */
-        *payload_len_out = ((uint64_t)p[2] << 56) | ((uint64_t)p[3] << 48) | ((uint64_t)p[4] << 40) |
-                           ((uint64_t)p[5] << 32) | ((uint64_t)p[6] << 24) | ((uint64_t)p[7] << 16) |
-                           ((uint64_t)p[8] << 8)  | p[9];
-        current_pos = 10;
-    } else {
-        *payload_len_out = len;
+static int ws_read(quicpro_ws_conn_internal_t *ws_conn, smart_str *out, size_t limit, zend_bool *msg_fin) {
+    const size_t max_msg = (size_t)quicpro_app_protocols_config.websocket_default_max_payload_size;
+    quicpro_ws_frame_t *f = &ws_conn->rx_frame;
+    size_t produced = 0;
+    ssize_t err = 0;
+
+    *msg_fin = 0;
+    for (;;) {
+        if (ws_conn->state == WS_STATE_CLOSED) {
+            return produced ? 1 : -1;
+        }
+
+        if (!ws_conn->rx_in_frame) {
+            ssize_t header_len = quicpro_ws_frame_parse(ws_conn->rx_buf, ws_conn->rx_len, f);
+            if (header_len == QUICPRO_WS_INCOMPLETE) {
+                /* Every header fits in QUICPRO_WS_MAX_HEADER; extra bytes are payload and stay buffered */
+                if (!ws_rx_fill(ws_conn, MAX(ws_conn->rx_len + 1, QUICPRO_WS_MAX_HEADER), &err)
+                    && quicpro_ws_frame_parse(ws_conn->rx_buf, ws_conn->rx_len, f) == QUICPRO_WS_INCOMPLETE) {
+                    return ws_rx_dry(ws_conn, err, produced);
+                }
+                continue;
+            }
+            if (header_len < 0) {
+                return ws_fail(ws_conn, 1002, "Malformed WebSocket frame header");
+            }
+            if (f->masked != ws_conn->is_server) {
+                /* Clients must mask every frame; servers must not (RFC 6455 §5.1) */
+                return ws_fail(ws_conn, 1002, ws_conn->is_server ? "Unmasked WebSocket frame from client" : "Masked WebSocket frame from server");
+            }
+            bool may_compress = ws_conn->deflate && (f->opcode == WS_OPCODE_TEXT || f->opcode == WS_OPCODE_BINARY);
+            if ((f->rsv & ~QUICPRO_WS_RSV1) || ((f->rsv & QUICPRO_WS_RSV1) && !may_compress)) {
+                return ws_fail(ws_conn, 1002, "Unexpected RSV bits in WebSocket frame");
+            }
+
+            if (f->opcode & 0x08) {
+                if (f->opcode != WS_OPCODE_CLOSE && f->opcode != WS_OPCODE_PING && f->opcode != WS_OPCODE_PONG) {
+                    return ws_fail(ws_conn, 1002, "Unknown WebSocket control opcode");
+                }
+                /* Control frames are at most 125 bytes, so rx_buf holds them whole */
+                size_t frame_len = (size_t)header_len + (size_t)f->payload_len;
+                if (!ws_rx_fill(ws_conn, frame_len, &err)) {
+                    return ws_rx_dry(ws_conn, err, produced);
+                }
+                uint8_t *payload = ws_conn->rx_buf + header_len;
+                if (f->masked) {
+                    ws_mask_copy(payload, payload, (size_t)f->payload_len, f->mask, 0);
+                }
+                ws_stats.frames_received++;
+                ws_on_control(ws_conn, f->opcode, payload, (size_t)f->payload_len);
+                ws_rx_consume(ws_conn, frame_len);
+                continue;
+            }
+
+            if (f->opcode == WS_OPCODE_CONTINUATION ? !ws_conn->msg_active
+                : (f->opcode != WS_OPCODE_TEXT && f->opcode != WS_OPCODE_BINARY) || ws_conn->msg_active) {
+                return ws_fail(ws_conn, 1002, "WebSocket fragments out of order");
+            }
+            if (!ws_conn->msg_active) {
+                ws_conn->msg_active = 1;
+                ws_conn->msg_binary = f->opcode == WS_OPCODE_BINARY;
+                ws_conn->msg_compressed = (f->rsv & QUICPRO_WS_RSV1) != 0;
+                ws_conn->msg_len = 0;
+            }
+            if (!ws_conn->msg_compressed && f->payload_len > max_msg - ws_conn->msg_len) {
+                return ws_fail(ws_conn, 1009, "WebSocket message exceeds quicpro.websocket_default_max_payload_size");
+            }
+            ws_rx_consume(ws_conn, (size_t)header_len);
+            ws_stats.frames_received++;
+            ws_conn->rx_in_frame = 1;
+            ws_conn->rx_left = f->payload_len;
+            ws_conn->rx_off = 0;
+        }
+
+        /* Payload of the current data frame: buffered bytes first, then the stream */
+        while (ws_conn->rx_left > 0 && produced < limit) {
+            uint8_t scratch[16384];   /* Wire bytes of a compressed message wait here for inflate */
+            size_t want = (size_t)MIN(ws_conn->rx_left, (uint64_t)(limit - produced));
+            uint8_t *dst;
+
+            if (ws_conn->msg_compressed) {
+                want = MIN(want, sizeof(scratch));
+                dst = scratch;
+            } else {
+                smart_str_alloc(out, want, 0);
+                dst = (uint8_t *)ZSTR_VAL(out->s) + ZSTR_LEN(out->s);
+            }
+
+            size_t got = MIN(want, ws_conn->rx_len);
+            memcpy(dst, ws_conn->rx_buf, got);
+            ws_rx_consume(ws_conn, got);
+            ws_stats.bytes_copied += got;
+            if (got < want) {
+                ssize_t n = ws_stream_read(ws_conn, dst + got, want - got);
+                if (n < 0) {
+                    return ws_fail(ws_conn, 1006, "WebSocket stream failed while reading");
+                }
+                got += (size_t)n;
+            }
+            if (got == 0) {
+                break;
+            }
+
+            if (f->masked) {
+                ws_mask_copy(dst, dst, got, f->mask, (size_t)ws_conn->rx_off);
+            }
+            ws_conn->rx_off += got;
+            ws_conn->rx_left -= got;
+            produced += got;
+
+            if (ws_conn->msg_compressed) {
+                size_t before = out->s ? ZSTR_LEN(out->s) : 0;
+                if (!quicpro_ws_deflate_inflate(ws_conn->deflate, dst, got, 0, before + (max_msg - ws_conn->msg_len), out)) {
+                    return ws_fail(ws_conn, 1009, "Compressed WebSocket message is corrupt or exceeds the size limit");
+                }
+                ws_conn->msg_len += (out->s ? ZSTR_LEN(out->s) : 0) - before;
+                ws_stats.inflate_in += got;
+                ws_stats.inflate_out += (out->s ? ZSTR_LEN(out->s) : 0) - before;
+            } else {
+                ZSTR_LEN(out->s) += got;
+                ws_conn->msg_len += got;
+            }
+        }
+
+        if (ws_conn->rx_left > 0) {
+            if (produced >= limit) {
+                return 1;
+            }
+            return ws_rx_dry(ws_conn, 0, produced);
+        }
+
+        /* The frame is complete */
+        ws_conn->rx_in_frame = 0;
+        if (f->fin) {
+            if (ws_conn->msg_compressed) {
+                size_t before = out->s ? ZSTR_LEN(out->s) : 0;
+                if (!quicpro_ws_deflate_inflate(ws_conn->deflate, NULL, 0, 1, before + (max_msg - ws_conn->msg_len), out)) {
+                    return ws_fail(ws_conn, 1009, "Compressed WebSocket message is corrupt or exceeds the size limit");
+                }
+                ws_stats.inflate_out += (out->s ? ZSTR_LEN(out->s) : 0) - before;
+            }
+            ws_conn->msg_active = 0;
+            *msg_fin = 1;
+            return 1;
+        }
+    }
+}
+
+static zend_long ws_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (zend_long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Drives the session until ws_read() has something or `timeout_ms` passes.
+ * Inside a Fiber the fiber is parked instead of blocking the worker.
+ * Returns as ws_read(); 0 on timeout; -2 if an exception was thrown.
+ */
+static int ws_receive(quicpro_ws_conn_internal_t *ws_conn, zend_resource *res, zend_long timeout_ms,
+                      smart_str *out, size_t limit, zend_bool *msg_fin) {
+    quicpro_session_t *s = ws_conn->session;
+    zend_long start = ws_now_ms();
+
+    for (;;) {
+        quicpro_session_pump_rx(s);
+        if (quiche_conn_timeout_as_millis(s->conn) == 0) {
+            quiche_conn_on_timeout(s->conn);
+        }
+        int rc = ws_read(ws_conn, out, limit, msg_fin);
+        ws_flush(ws_conn);          /* Pongs and Close replies */
+        quicpro_session_pump_tx(s);
+        if (rc != 0) {
+            return rc;
+        }
+        if (quiche_conn_is_closed(s->conn)) {
+            return ws_fail(ws_conn, 1006, "QUIC connection closed under the WebSocket");
+        }
+
+        zend_long elapsed = ws_now_ms() - start;
+        if (timeout_ms >= 0 && elapsed >= timeout_ms) {
+            return 0;
+        }
+        zend_long wait_ms = timeout_ms >= 0 ? timeout_ms - elapsed : -1;
+        int64_t quic_deadline = quiche_conn_timeout_as_millis(s->conn);
+        if (quic_deadline >= 0 && (wait_ms < 0 || quic_deadline < wait_ms)) {
+            wait_ms = quic_deadline;
+        }
+
+        quicpro_sched_result_t wrc = quicpro_sched_wait(s, res, wait_ms);
+        if (wrc == QUICPRO_SCHED_ERROR) {
+            return -2;
+        }
+        if (wrc == QUICPRO_SCHED_NO_FIBER) {
+            struct pollfd pfd = { .fd = s->sock, .events = POLLIN };
+            if (poll(&pfd, 1, wait_ms < 0 ? -1 : (int)MIN(wait_ms, INT_MAX)) < 0 && errno != EINTR) {
+                throw_network_exception(errno, "Failed to wait for WebSocket data: %s", strerror(errno));
+                return -2;
+            }
+        }
+        if (s->is_closed || !s->conn) {
+            return ws_fail(ws_conn, 1006, "Session closed while waiting for WebSocket data");
+        }
     }
+}
+
+/* --- Broadcast Hub --- */
+
+/*
+ * topic => [connection address => quicpro_ws_conn_internal_t *]. The hub
+ * does not own the connections: each resource destructor takes itself
+ * out. Lives for one request.
+ */
+static HashTable *quicpro_ws_topics = NULL;
 
-    if (is_masked) {
-        if (buffer_len < current_pos + 4) return 0;
-        /* TODO: A real client needs to store and use this mask to unmask the payload. */
-        current_pos += 4;
+static void ws_topic_dtor(zval *zv) {
+    HashTable *subscribers = Z_PTR_P(zv);
+    zend_hash_destroy(subscribers);
+    efree(subscribers);
+}
+
+static void ws_hub_forget(quicpro_ws_conn_internal_t *ws_conn) {
+    HashTable *subscribers;
+
+    if (!quicpro_ws_topics) {
+        return;
     }
+    ZEND_HASH_FOREACH_PTR(quicpro_ws_topics, subscribers) {
+        zend_hash_index_del(subscribers, (zend_ulong)(uintptr_t)ws_conn);
+    } ZEND_HASH_FOREACH_END();
+}
 
-    *header_len_out = current_pos;
-    return 1;
+/*
+ * Closes a connection that cannot keep up: whatever it still had queued is
+ * dropped and a Close frame with 1008 (policy violation) goes out instead.
+ */
+static void ws_close_slow_consumer(quicpro_ws_conn_internal_t *ws_conn) {
+    static const char status[2] = { (char)(1008 >> 8), (char)(1008 & 0xFF) };
+    zend_string *close_frame = ws_server_frame(WS_OPCODE_CLOSE, 0, status, sizeof(status));
+
+    /* A partly sent frame must be finished first, or the peer loses framing */
+    quicpro_ws_out_t *partial = ws_conn->out_head && ws_conn->out_head->off ? ws_conn->out_head : NULL;
+    if (partial) {
+        ws_conn->out_head = partial->next;
+    }
+    ws_drop_queue(ws_conn);
+    if (partial) {
+        partial->next = NULL;
+        ws_conn->out_head = ws_conn->out_tail = partial;
+        ws_conn->out_bytes = ZSTR_LEN(partial->frame) - partial->off;
+    }
+    ws_enqueue(ws_conn, close_frame);
+    zend_string_release(close_frame);
+    ws_conn->state = WS_STATE_CLOSING;
+    ws_flush(ws_conn);
+}
+
+void quicpro_ws_hub_rshutdown(void) {
+    if (quicpro_ws_topics) {
+        zend_hash_destroy(quicpro_ws_topics);
+        efree(quicpro_ws_topics);
+        quicpro_ws_topics = NULL;
+    }
 }
 
 /* --- PHP_FUNCTION Implementations --- */
@@ -175,10 +631,13 @@ PHP_FUNCTION(quicpro_ws_upgrade)
 
     /*
      * Implementation Note: This function needs to:
-     * 1. Construct H3 headers for a CONNECT request, including `:method: CONNECT`, `:protocol: websocket`, etc.
+     * 1. Construct H3 headers for a CONNECT request, including `:method: CONNECT`, `:protocol: websocket`, etc.,
+     *    and `sec-websocket-extensions` from `quicpro_ws_deflate_offer()`.
      * 2. Send the request using `quiche_h3_send_request`.
      * 3. Enter a polling loop (like `mcp_poll_for_response` from mcp.c) to wait for a 2xx response.
-     * 4. If a 2xx response is received, the stream is considered upgraded.
+     * 4. If a 2xx response is received, the stream is considered upgraded. Pass its
+     *    `sec-websocket-extensions` to `quicpro_ws_deflate_confirm()`; on success set
+     *    `deflate` via `quicpro_ws_deflate_new()`, on failure fail the connection.
      * 5. Create a `quicpro_ws_conn_internal_t` struct, populate it with the session pointer and stream ID.
      * 6. Register this struct as a new PHP resource of type `le_quicpro_ws`.
      * 7. Return the new WebSocket resource.
@@ -217,40 +676,57 @@ PHP_FUNCTION(quicpro_ws_send)
         RETURN_FALSE;
     }
 
-    smart_str frame_buf = {0};
     uint8_t opcode = is_binary ? WS_OPCODE_BINARY : WS_OPCODE_TEXT;
 
-    /* Create the WebSocket frame header. Client-to-server frames must be masked. */
-    create_ws_frame_header(&frame_buf, opcode, data_len, 1 /* is_masked */);
-
-    /* Generate a 4-byte masking key */
-    uint32_t masking_key_int;
-    if (RAND_bytes((unsigned char*)&masking_key_int, 4) != 1) {
+    /* Client-to-server frames must be masked; generate a 4-byte masking key */
+    uint8_t mask[4];
+    if (!ws_conn->is_server && RAND_bytes(mask, sizeof(mask)) != 1) {
         /* OpenSSL RAND_bytes error */
-        smart_str_free(&frame_buf);
         throw_mcp_error_as_php_exception(0, "Failed to generate WebSocket masking key.");
         RETURN_FALSE;
     }
-    smart_str_appendl(&frame_buf, (char*)&masking_key_int, 4);
 
-    /* Append the masked payload */
-    size_t frame_buf_start_len = ZSTR_LEN(frame_buf.s);
-    smart_str_appendl(&frame_buf, data, data_len);
-    unsigned char* payload_ptr = (unsigned char*)ZSTR_VAL(frame_buf.s) + frame_buf_start_len;
-    unsigned char* mask_ptr = (unsigned char*)&masking_key_int;
-    for (size_t i = 0; i < data_len; ++i) {
-        payload_ptr[i] ^= mask_ptr[i % 4];
+    /* Compress with permessage-deflate if negotiated; tiny messages are not worth it */
+    zend_string *deflated = NULL;
+    uint8_t rsv = 0;
+    if (ws_conn->deflate && data_len >= QUICPRO_WS_DEFLATE_MIN_SIZE) {
+        deflated = quicpro_ws_deflate_compress(ws_conn->deflate, (const uint8_t *)data, data_len);
+        if (!deflated) {
+            throw_mcp_error_as_php_exception(0, "WebSocket message compression failed.");
+            RETURN_FALSE;
+        }
+        ws_stats.deflate_in += data_len;
+        ws_stats.deflate_out += ZSTR_LEN(deflated);
+        data = ZSTR_VAL(deflated);
+        data_len = ZSTR_LEN(deflated);
+        rsv = QUICPRO_WS_RSV1;
     }
 
-    /* Send the complete frame over the QUIC stream */
-    ssize_t sent = quiche_stream_send(ws_conn->session->conn, ws_conn->stream_id, (uint8_t*)ZSTR_VAL(frame_buf.s), ZSTR_LEN(frame_buf.s), 1 /* fin=false, stream stays open */);
-    smart_str_free(&frame_buf);
+    /* Build the frame in one exactly sized buffer; masking is the payload's only copy */
+    zend_string *frame;
+    if (ws_conn->is_server) {
+        frame = ws_server_frame(opcode, rsv, data, data_len);
+    } else {
+        frame = zend_string_alloc(quicpro_ws_frame_size(data_len, 1), 0);
+        uint8_t *out = (uint8_t *)ZSTR_VAL(frame);
+        size_t header_len = quicpro_ws_frame_header(out, 1 /* fin */, rsv, opcode, data_len, mask);
+        ws_mask_copy(out + header_len, (const uint8_t *)data, data_len, mask, 0);
+        ws_stats.bytes_copied += data_len;
+    }
+    if (deflated) {
+        zend_string_efree(deflated);
+    }
+
+    /* Queue behind any broadcast frames still waiting, then send what the stream takes */
+    ws_enqueue(ws_conn, frame);
+    zend_string_release(frame);
+    ssize_t rc = ws_flush(ws_conn);
 
-    if (sent < 0) {
+    if (rc < 0) {
         /* Note: quiche_stream_send is for raw QUIC streams. If MCP is on H3, we'd still use quiche_h3_send_body.
          * This assumes the stream has been "unwrapped" from H3 after the CONNECT upgrade.
          */
-        throw_quiche_error_as_php_exception((int)sent, "WebSocket send failed on QUIC stream.");
+        throw_quiche_error_as_php_exception((int)rc, "WebSocket send failed on QUIC stream.");
         RETURN_FALSE;
     }
 
@@ -258,26 +734,109 @@ PHP_FUNCTION(quicpro_ws_send)
 }
 
 
+/* {{{ quicpro_ws_receive(resource $ws, int $timeout_ms = -1): string|false|null
+ *
+ * Returns the next whole message, joined from its fragments and inflated
+ * if it was compressed. A message over websocket_default_max_payload_size
+ * fails the connection with 1009. Returns null on timeout (a partly
+ * received message is kept for the next call) and false once the
+ * connection is closed.
+ */
 PHP_FUNCTION(quicpro_ws_receive)
 {
-    /*
-     * TODO: Implementation for receiving WebSocket messages.
-     * 1. Parse parameters: WebSocket connection resource, optional timeout.
-     * 2. Enter a polling loop (using `select()` or `epoll()` on the socket).
-     * 3. Within the loop, call `quiche_stream_recv()` to read raw bytes from the stream into `ws_conn->read_buffer`.
-     * 4. Call `parse_ws_frame_header()` on the `read_buffer`.
-     * 5. If a full frame header is present, determine the total frame length (header + payload).
-     * 6. If the full frame is in the buffer, process it:
-     * - Handle control frames (Ping -> send Pong, Close -> handle shutdown, Pong -> ignore).
-     * - For data frames (Text, Binary, Continuation), unmask the payload (server-to-client frames are not masked).
-     * - Append payload to a message buffer (to handle fragmentation).
-     * - If FIN bit was set, the message is complete. Return the message payload as a PHP string.
-     * - Remove the processed frame from `ws_conn->read_buffer`.
-     * 7. Loop until a full message is decoded or timeout occurs.
-     */
-    zend_error(E_WARNING, "quicpro_ws_receive() is not yet fully implemented.");
-    RETURN_FALSE;
+    zval *z_ws_conn_res;
+    zend_long timeout_ms = -1;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_RESOURCE(z_ws_conn_res)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(timeout_ms)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_ws_conn_internal_t *ws_conn = (quicpro_ws_conn_internal_t *)zend_fetch_resource_ex(z_ws_conn_res, "Quicpro WebSocket Connection", le_quicpro_ws);
+    if (!ws_conn || ws_conn->state == WS_STATE_CLOSED || ws_conn->state == WS_STATE_CONNECTING) {
+        RETURN_FALSE;
+    }
+
+    zend_long deadline = timeout_ms >= 0 ? ws_now_ms() + timeout_ms : -1;
+    for (;;) {
+        zend_long left = deadline >= 0 ? MAX(deadline - ws_now_ms(), 0) : -1;
+        zend_bool fin;
+        int rc = ws_receive(ws_conn, Z_RES_P(z_ws_conn_res), left, &ws_conn->message, SIZE_MAX, &fin);
+
+        if (rc == -2) {
+            RETURN_THROWS();
+        }
+        if (rc < 0) {
+            smart_str_free(&ws_conn->message);
+            RETURN_FALSE;
+        }
+        if (rc == 0) {
+            RETURN_NULL();
+        }
+        if (fin) {
+            smart_str_0(&ws_conn->message);
+            RETVAL_STR(ws_conn->message.s ? ws_conn->message.s : ZSTR_EMPTY_ALLOC());
+            ws_conn->message.s = NULL;
+            return;
+        }
+        /* Part of the message; keep reading until its last fragment */
+    }
+}
+/* }}} */
+
+/* {{{ quicpro_ws_receive_chunk(resource $ws, int $timeout_ms = -1): array|false|null
+ *
+ * Streaming receive: returns the next piece of the current message as
+ * soon as any of it has arrived, as ['data' => string, 'binary' => bool,
+ * 'fin' => bool]. `fin` marks the message's last piece. At most
+ * quicpro.websocket_receive_chunk_size wire bytes are read per call, so a
+ * large upload is handled piece by piece while flow control holds back
+ * the rest. Returns null on timeout and false once the connection is closed.
+ */
+PHP_FUNCTION(quicpro_ws_receive_chunk)
+{
+    zval *z_ws_conn_res;
+    zend_long timeout_ms = -1;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_RESOURCE(z_ws_conn_res)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(timeout_ms)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_ws_conn_internal_t *ws_conn = (quicpro_ws_conn_internal_t *)zend_fetch_resource_ex(z_ws_conn_res, "Quicpro WebSocket Connection", le_quicpro_ws);
+    if (!ws_conn || ws_conn->state == WS_STATE_CLOSED || ws_conn->state == WS_STATE_CONNECTING) {
+        RETURN_FALSE;
+    }
+
+    /* Whatever quicpro_ws_receive() had gathered before timing out comes first */
+    smart_str chunk = ws_conn->message;
+    zend_bool fin = 0;
+    ws_conn->message.s = NULL;
+
+    if (!chunk.s || ZSTR_LEN(chunk.s) == 0) {
+        int rc = ws_receive(ws_conn, Z_RES_P(z_ws_conn_res), timeout_ms, &chunk,
+                            (size_t)quicpro_app_protocols_config.websocket_receive_chunk_size, &fin);
+        if (rc <= 0) {
+            smart_str_free(&chunk);
+            if (rc == -2) {
+                RETURN_THROWS();
+            }
+            if (rc == 0) {
+                RETURN_NULL();
+            }
+            RETURN_FALSE;
+        }
+    }
+
+    smart_str_0(&chunk);
+    array_init_size(return_value, 3);
+    add_assoc_str(return_value, "data", chunk.s ? chunk.s : ZSTR_EMPTY_ALLOC());
+    add_assoc_bool(return_value, "binary", ws_conn->msg_binary);
+    add_assoc_bool(return_value, "fin", fin);
 }
+/* }}} */
 
 
 PHP_FUNCTION(quicpro_ws_close)
@@ -311,8 +870,218 @@ PHP_FUNCTION(quicpro_ws_get_status)
 }
 
 
+/* {{{ quicpro_ws_get_stats(): array
+ *
+ * Codec counters of this worker since it started, for all connections.
+ * A benchmark takes two snapshots and divides the difference by the frame
+ * count: copies per frame, masking throughput (mask_bytes / mask_ns) and
+ * the compression ratio (deflate_in / deflate_out).
+ */
+PHP_FUNCTION(quicpro_ws_get_stats)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    array_init(return_value);
+    add_assoc_long(return_value, "frames_sent",         (zend_long)ws_stats.frames_sent);
+    add_assoc_long(return_value, "frames_received",     (zend_long)ws_stats.frames_received);
+    add_assoc_long(return_value, "wire_bytes_sent",     (zend_long)ws_stats.wire_bytes_sent);
+    add_assoc_long(return_value, "wire_bytes_received", (zend_long)ws_stats.wire_bytes_received);
+    add_assoc_long(return_value, "bytes_copied",        (zend_long)ws_stats.bytes_copied);
+    add_assoc_long(return_value, "mask_bytes",          (zend_long)ws_stats.mask_bytes);
+    add_assoc_long(return_value, "mask_ns",             (zend_long)ws_stats.mask_ns);
+    add_assoc_long(return_value, "deflate_in",          (zend_long)ws_stats.deflate_in);
+    add_assoc_long(return_value, "deflate_out",         (zend_long)ws_stats.deflate_out);
+    add_assoc_long(return_value, "inflate_in",          (zend_long)ws_stats.inflate_in);
+    add_assoc_long(return_value, "inflate_out",         (zend_long)ws_stats.inflate_out);
+}
+/* }}} */
+
+
 PHP_FUNCTION(quicpro_ws_get_last_error)
 {
     /* TODO: Return a global or per-connection WebSocket error string */
     RETURN_STRING("WebSocket error reporting not yet fully implemented.");
-}
\ No newline at end of file
+}
+
+
+/* {{{ quicpro_ws_subscribe(resource $ws, string $topic): bool
+ *
+ * Adds a server-side connection to a broadcast topic.
+ */
+PHP_FUNCTION(quicpro_ws_subscribe)
+{
+    zval *z_ws_conn_res;
+    zend_string *topic;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_RESOURCE(z_ws_conn_res)
+        Z_PARAM_STR(topic)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_ws_conn_internal_t *ws_conn = (quicpro_ws_conn_internal_t *)zend_fetch_resource_ex(z_ws_conn_res, "Quicpro WebSocket Connection", le_quicpro_ws);
+    if (!ws_conn || ws_conn->state != WS_STATE_OPEN) {
+        RETURN_FALSE;
+    }
+    if (!ws_conn->is_server) {
+        /* Published frames are encoded once, unmasked; a client must mask each one */
+        throw_mcp_error_as_php_exception(0, "Only server-side WebSocket connections can subscribe to a topic.");
+        RETURN_FALSE;
+    }
+
+    if (!quicpro_ws_topics) {
+        quicpro_ws_topics = emalloc(sizeof(HashTable));
+        zend_hash_init(quicpro_ws_topics, 8, NULL, ws_topic_dtor, 0);
+    }
+    HashTable *subscribers = zend_hash_find_ptr(quicpro_ws_topics, topic);
+    if (!subscribers) {
+        subscribers = emalloc(sizeof(HashTable));
+        zend_hash_init(subscribers, 8, NULL, NULL, 0);
+        zend_hash_add_new_ptr(quicpro_ws_topics, topic, subscribers);
+    }
+    zend_hash_index_add_ptr(subscribers, (zend_ulong)(uintptr_t)ws_conn, ws_conn);
+
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ quicpro_ws_unsubscribe(resource $ws, string $topic): bool */
+PHP_FUNCTION(quicpro_ws_unsubscribe)
+{
+    zval *z_ws_conn_res;
+    zend_string *topic;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_RESOURCE(z_ws_conn_res)
+        Z_PARAM_STR(topic)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_ws_conn_internal_t *ws_conn = (quicpro_ws_conn_internal_t *)zend_fetch_resource_ex(z_ws_conn_res, "Quicpro WebSocket Connection", le_quicpro_ws);
+    HashTable *subscribers = quicpro_ws_topics ? zend_hash_find_ptr(quicpro_ws_topics, topic) : NULL;
+    if (!ws_conn || !subscribers
+        || zend_hash_index_del(subscribers, (zend_ulong)(uintptr_t)ws_conn) == FAILURE) {
+        RETURN_FALSE;
+    }
+    if (zend_hash_num_elements(subscribers) == 0) {
+        zend_hash_del(quicpro_ws_topics, topic);
+    }
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ quicpro_ws_publish(string $topic, string $data, bool $is_binary = false): int
+ *
+ * Sends one message to every subscriber of $topic. The frame is built
+ * once and shared by reference across their send queues. Connections
+ * whose deflate resets after every message share one compressed copy per
+ * window size; all others get the plain frame, since RSV1 is per message.
+ * A subscriber whose queue would pass
+ * quicpro.websocket_send_queue_high_watermark misses this message, or is
+ * closed with 1008 if quicpro.websocket_close_slow_consumers is set.
+ * Returns the number of connections the message was queued on.
+ */
+PHP_FUNCTION(quicpro_ws_publish)
+{
+    zend_string *topic;
+    char *data;
+    size_t data_len;
+    zend_bool is_binary = 0;
+
+    ZEND_PARSE_PARAMETERS_START(2, 3)
+        Z_PARAM_STR(topic)
+        Z_PARAM_STRING(data, data_len)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_BOOL(is_binary)
+    ZEND_PARSE_PARAMETERS_END();
+
+    HashTable *subscribers = quicpro_ws_topics ? zend_hash_find_ptr(quicpro_ws_topics, topic) : NULL;
+    if (!subscribers) {
+        RETURN_LONG(0);
+    }
+
+    const size_t high_watermark = (size_t)quicpro_app_protocols_config.websocket_send_queue_high_watermark;
+    const uint8_t opcode = is_binary ? WS_OPCODE_BINARY : WS_OPCODE_TEXT;
+    zend_string *plain = NULL;
+    zend_string *deflated[16] = { NULL };   /* By window bits */
+    bool deflate_failed[16] = { false };
+    zend_long queued = 0;
+    quicpro_ws_conn_internal_t *ws_conn;
+
+    ZEND_HASH_FOREACH_PTR(subscribers, ws_conn) {
+        if (ws_conn->state != WS_STATE_OPEN) {
+            continue;
+        }
+
+        zend_string *frame = NULL;
+        int bits = ws_conn->deflate && data_len >= QUICPRO_WS_DEFLATE_MIN_SIZE
+            ? quicpro_ws_deflate_shared_window(ws_conn->deflate) : 0;
+        if (bits > 0 && bits < 16 && !deflate_failed[bits]) {
+            if (!deflated[bits]) {
+                zend_string *payload = quicpro_ws_deflate_compress_once((const uint8_t *)data, data_len, bits);
+                if (payload) {
+                    ws_stats.deflate_in += data_len;
+                    ws_stats.deflate_out += ZSTR_LEN(payload);
+                    deflated[bits] = ws_server_frame(opcode, QUICPRO_WS_RSV1, ZSTR_VAL(payload), ZSTR_LEN(payload));
+                    zend_string_efree(payload);
+                } else {
+                    deflate_failed[bits] = true;
+                }
+            }
+            frame = deflated[bits];
+        }
+        if (!frame) {
+            if (!plain) {
+                plain = ws_server_frame(opcode, 0, data, data_len);
+            }
+            frame = plain;
+        }
+
+        /* An idle connection always takes the message, however large */
+        if (ws_conn->out_bytes > 0 && ws_conn->out_bytes + ZSTR_LEN(frame) > high_watermark) {
+            if (quicpro_app_protocols_config.websocket_close_slow_consumers) {
+                ws_close_slow_consumer(ws_conn);
+            }
+            continue;
+        }
+        ws_enqueue(ws_conn, frame);
+        if (ws_flush(ws_conn) == 0) {
+            queued++;
+        }
+    } ZEND_HASH_FOREACH_END();
+
+    if (plain) {
+        zend_string_release(plain);
+    }
+    for (int i = 0; i < 16; i++) {
+        if (deflated[i]) {
+            zend_string_release(deflated[i]);
+        }
+    }
+    RETURN_LONG(queued);
+}
+/* }}} */
+
+/* {{{ quicpro_ws_flush(resource $ws): int|false
+ *
+ * Pushes queued frames into the stream as far as flow control allows and
+ * returns the number of bytes still queued.
+ */
+PHP_FUNCTION(quicpro_ws_flush)
+{
+    zval *z_ws_conn_res;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_RESOURCE(z_ws_conn_res)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_ws_conn_internal_t *ws_conn = (quicpro_ws_conn_internal_t *)zend_fetch_resource_ex(z_ws_conn_res, "Quicpro WebSocket Connection", le_quicpro_ws);
+    if (!ws_conn) {
+        RETURN_FALSE;
+    }
+    ssize_t rc = ws_flush(ws_conn);
+    if (rc < 0) {
+        throw_quiche_error_as_php_exception((int)rc, "WebSocket send failed on QUIC stream.");
+        RETURN_FALSE;
+    }
+    RETURN_LONG((zend_long)ws_conn->out_bytes);
+}
+/* }}} */
@@ -0,0 +1,1151 @@
+#include "php_quicpro.h"
+#include "webtransport/webtransport.h"
+#include "client/mux.h"
+#include "client/cancel.h"
+#include "config/app_http3_websockets_webtransport/base_layer.h"
+#include "config/quic_transport/base_layer.h"
+#include "poll/poll.h"
+#include "poll/scheduler.h"
+#include "server/profiler.h"
+#include "server/h3_settings.h"
+
+#include <quiche.h>
+#include <string.h>
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+
+/**
+ * @file extension/src/server/webtransport.c
+ * @brief WebTransport sessions on a dedicated HTTP/3 connection.
+ *
+ * Reading is pull-based. Nothing is taken off quiche until
+ * quicpro_webtransport_poll() asks, and each call reads at most
+ * WT_POLL_BUDGET stream bytes. An application that stops polling
+ * therefore stops granting flow-control credit instead of growing a
+ * buffer. Datagrams have their own quiche queue, bounded by
+ * quicpro.transport_dgram_recv_queue_len; quiche drops the oldest when it
+ * is full.
+ */
+
+extern int le_quicpro;           /* quicpro_connect() sessions */
+extern int le_quicpro_session;   /* quicpro_client_session_connect() and server sessions */
+int le_quicpro_wt;
+
+/* draft-ietf-webtrans-http3 §4.2, §5 and §9 */
+#define WT_STREAM_BIDI                  0x41
+#define WT_STREAM_UNI                   0x54
+#define WT_CAPSULE_CLOSE                0x2843
+#define WT_CAPSULE_DRAIN                0x78ae
+#define WT_MAX_CLOSE_REASON             1024
+#define WT_ERR_BUFFERED_STREAM_REJECTED 0x3994bd84
+#define WT_ERR_SESSION_GONE             0x170d7b68
+#define WT_APP_ERROR_FIRST              0x52e4a40fa8dbULL
+#define H3_STREAM_CREATION_ERROR        0x0103
+
+/*
+ * Unidirectional streams the HTTP/3 layer opens at start. quiche opens
+ * control, QPACK encoder, QPACK decoder and a grease stream. A peer opens
+ * at least the first three, and anything after those is WebTransport.
+ */
+#define WT_H3_LOCAL_UNI                 4
+#define WT_H3_PEER_UNI                  3
+
+#define WT_POLL_BUDGET                  (256 * 1024)
+#define WT_MAX_CAPSULE_BUFFER           65536
+
+typedef struct {
+    uint64_t id;
+    bool     bidi;
+    bool     local;
+    bool     claimed;       /* Peer stream: signal and session ID read */
+    bool     announced;     /* Peer stream: first event delivered */
+    bool     peer_fin;
+    bool     local_fin;
+    uint8_t  prefix[16];    /* Peer: header read so far. Local: header not yet sent. */
+    uint8_t  prefix_len;
+} quicpro_wt_stream_t;
+
+struct quicpro_wt_s {
+    quicpro_session_t *session;
+    zend_resource     *session_res;    /* Referenced while the WebTransport session lives */
+    uint64_t           session_id;     /* Stream ID of the CONNECT request */
+    bool               is_server;
+    zend_long          status;         /* Client: :status of the CONNECT response, 0 until known */
+    bool               draining;       /* DRAIN_WEBTRANSPORT_SESSION received, not yet reported */
+    bool               closed;
+    bool               close_reported;
+    uint32_t           close_code;
+    zend_string       *close_reason;
+    uint64_t           next_bidi;
+    uint64_t           next_uni;
+    uint32_t           peer_streams;   /* Open streams the peer started */
+    HashTable          streams;        /* stream ID → quicpro_wt_stream_t *, owning */
+    smart_str          capsules;       /* CONNECT stream bytes not parsed yet */
+};
+
+/* Sessions alive in this worker, bounded by quicpro.webtransport_max_concurrent_sessions */
+static uint32_t wt_live_sessions = 0;
+
+/* One datagram in either direction; a QUIC DATAGRAM frame never exceeds a UDP payload */
+static uint8_t wt_dgram_buf[65536];
+
+/*──────────────────────────── Wire helpers ───────────────────────────────*/
+
+static size_t wt_varint_len(uint64_t v) {
+    return v < (1ULL << 6) ? 1 : v < (1ULL << 14) ? 2 : v < (1ULL << 30) ? 4 : 8;
+}
+
+static size_t wt_varint_put(uint8_t *out, uint64_t v) {
+    size_t n = wt_varint_len(v);
+    for (size_t i = 0; i < n; i++) {
+        out[n - 1 - i] = (uint8_t)(v >> (8 * i));
+    }
+    out[0] |= (uint8_t)((n == 1 ? 0 : n == 2 ? 1 : n == 4 ? 2 : 3) << 6);
+    return n;
+}
+
+/* Decodes a QUIC varint; returns its length, or 0 if `len` bytes do not hold it yet. */
+static size_t wt_varint_get(const uint8_t *in, size_t len, uint64_t *v) {
+    if (len == 0) {
+        return 0;
+    }
+    size_t n = (size_t)1 << (in[0] >> 6);
+    if (len < n) {
+        return 0;
+    }
+    uint64_t x = in[0] & 0x3f;
+    for (size_t i = 1; i < n; i++) {
+        x = (x << 8) | in[i];
+    }
+    *v = x;
+    return n;
+}
+
+/* Application error codes arrive mapped into the HTTP/3 error space, which skips its reserved values (§4.4) */
+static bool wt_code_from_h3(uint64_t h3, uint32_t *code) {
+    if (h3 < WT_APP_ERROR_FIRST || (h3 - 0x21) % 0x1f == 0) {
+        return false;
+    }
+    uint64_t shifted = h3 - WT_APP_ERROR_FIRST;
+    uint64_t n = shifted - shifted / 0x1f;
+    if (n > UINT32_MAX) {
+        return false;
+    }
+    *code = (uint32_t)n;
+    return true;
+}
+
+/*──────────────────────────── Streams ────────────────────────────────────*/
+
+static void wt_stream_dtor(zval *zv) {
+    efree(Z_PTR_P(zv));
+}
+
+static quicpro_wt_stream_t *wt_stream_add(quicpro_wt_t *wt, uint64_t id, bool local) {
+    quicpro_wt_stream_t *st = ecalloc(1, sizeof(*st));
+    st->id = id;
+    st->local = local;
+    st->bidi = (id & 0x2) == 0;
+    zend_hash_index_add_new_ptr(&wt->streams, (zend_ulong)id, st);
+    if (!local) {
+        wt->peer_streams++;
+    }
+    return st;
+}
+
+static void wt_stream_forget(quicpro_wt_t *wt, quicpro_wt_stream_t *st) {
+    if (!st->local) {
+        wt->peer_streams--;
+    }
+    zend_hash_index_del(&wt->streams, (zend_ulong)st->id);
+}
+
+/* Forgets a stream once neither side will send on it again. */
+static void wt_stream_maybe_done(quicpro_wt_t *wt, quicpro_wt_stream_t *st) {
+    bool recv_done = st->peer_fin || (!st->bidi && st->local);
+    bool send_done = st->local_fin || (!st->bidi && !st->local);
+    if (recv_done && send_done) {
+        wt_stream_forget(wt, st);
+    }
+}
+
+/* Aborts both directions of a stream we will not serve. */
+static void wt_stream_abort(quicpro_wt_t *wt, uint64_t id, uint64_t code) {
+    quiche_conn_stream_shutdown(wt->session->conn, id, QUICHE_SHUTDOWN_READ, code);
+    if ((id & 0x2) == 0) {
+        quiche_conn_stream_shutdown(wt->session->conn, id, QUICHE_SHUTDOWN_WRITE, code);
+    }
+}
+
+/* Whether a readable stream the table does not know may belong to the session. */
+static bool wt_is_peer_candidate(const quicpro_wt_t *wt, uint64_t id) {
+    if ((id & 0x1) == (wt->is_server ? 1 : 0) || id == wt->session_id) {
+        return false;   /* Ours, or the CONNECT stream, which HTTP/3 reads */
+    }
+    if ((id & 0x2) == 0) {
+        /* Servers never open HTTP/3 request streams; a client's later ones are ours */
+        return !wt->is_server || id > wt->session_id;
+    }
+    return id >= (id & 0x3) + 4 * WT_H3_PEER_UNI;
+}
+
+/* Bytes still missing from a peer stream's signal value and session ID; 0 once both are in. */
+static size_t wt_prefix_missing(const quicpro_wt_stream_t *st) {
+    uint64_t v;
+    size_t a = wt_varint_get(st->prefix, st->prefix_len, &v);
+    if (a == 0) {
+        return st->prefix_len ? ((size_t)1 << (st->prefix[0] >> 6)) - st->prefix_len : 1;
+    }
+    size_t rest = st->prefix_len - a;
+    if (wt_varint_get(st->prefix + a, rest, &v) == 0) {
+        return rest ? ((size_t)1 << (st->prefix[a] >> 6)) - rest : 1;
+    }
+    return 0;
+}
+
+/* Sends what is left of a local stream's header. Returns false while some is still pending. */
+static bool wt_prefix_flush(quicpro_wt_t *wt, quicpro_wt_stream_t *st) {
+    if (st->prefix_len == 0) {
+        return true;
+    }
+    uint64_t ec = 0;
+    ssize_t n = quiche_conn_stream_send(wt->session->conn, st->id, st->prefix, st->prefix_len, false, &ec);
+    if (n <= 0) {
+        return false;
+    }
+    memmove(st->prefix, st->prefix + n, st->prefix_len - (size_t)n);
+    st->prefix_len -= (uint8_t)n;
+    return st->prefix_len == 0;
+}
+
+/*──────────────────────────── Session state ──────────────────────────────*/
+
+static void wt_set_closed(quicpro_wt_t *wt, uint32_t code, const char *reason, size_t reason_len) {
+    if (wt->closed) {
+        return;
+    }
+    wt->closed = true;
+    wt->close_code = code;
+    wt->close_reason = zend_string_init(reason, reason_len, 0);
+}
+
+/* Resets every stream of a session that has ended (§6: streams do not outlive it). */
+static void wt_teardown_streams(quicpro_wt_t *wt) {
+    quicpro_wt_stream_t *st;
+    if (wt->session->conn && !quiche_conn_is_closed(wt->session->conn)) {
+        ZEND_HASH_FOREACH_PTR(&wt->streams, st) {
+            if (!st->peer_fin && (st->bidi || !st->local)) {
+                quiche_conn_stream_shutdown(wt->session->conn, st->id, QUICHE_SHUTDOWN_READ, WT_ERR_SESSION_GONE);
+            }
+            if (!st->local_fin && (st->bidi || st->local)) {
+                quiche_conn_stream_shutdown(wt->session->conn, st->id, QUICHE_SHUTDOWN_WRITE, WT_ERR_SESSION_GONE);
+            }
+        } ZEND_HASH_FOREACH_END();
+    }
+    zend_hash_clean(&wt->streams);
+    wt->peer_streams = 0;
+}
+
+/* Ends the CONNECT stream with a CLOSE_WEBTRANSPORT_SESSION capsule. */
+static void wt_send_close(quicpro_wt_t *wt, uint32_t code, const char *reason, size_t reason_len) {
+    uint8_t capsule[16 + 4 + WT_MAX_CLOSE_REASON];
+    size_t n = wt_varint_put(capsule, WT_CAPSULE_CLOSE);
+    n += wt_varint_put(capsule + n, 4 + reason_len);
+    capsule[n++] = (uint8_t)(code >> 24);
+    capsule[n++] = (uint8_t)(code >> 16);
+    capsule[n++] = (uint8_t)(code >> 8);
+    capsule[n++] = (uint8_t)code;
+    memcpy(capsule + n, reason, reason_len);
+    n += reason_len;
+
+    if (quiche_h3_send_body(wt->session->h3, wt->session->conn, wt->session_id, capsule, n, true) < 0) {
+        /* No room for it; ending the stream closes the session all the same */
+        quiche_conn_stream_shutdown(wt->session->conn, wt->session_id, QUICHE_SHUTDOWN_WRITE, 0);
+    }
+}
+
+/* Parses the capsules buffered from the CONNECT stream. */
+static void wt_parse_capsules(quicpro_wt_t *wt) {
+    const uint8_t *p = (const uint8_t *)ZSTR_VAL(wt->capsules.s);
+    size_t len = ZSTR_LEN(wt->capsules.s), off = 0;
+
+    while (!wt->closed) {
+        uint64_t type, clen;
+        size_t a = wt_varint_get(p + off, len - off, &type);
+        size_t b = a ? wt_varint_get(p + off + a, len - off - a, &clen) : 0;
+        if (b == 0 || clen > len - off - a - b) {
+            break;
+        }
+        const uint8_t *body = p + off + a + b;
+        if (type == WT_CAPSULE_CLOSE && clen >= 4) {
+            uint32_t code = ((uint32_t)body[0] << 24) | ((uint32_t)body[1] << 16) | ((uint32_t)body[2] << 8) | body[3];
+            wt_set_closed(wt, code, (const char *)body + 4, MIN((size_t)clen - 4, WT_MAX_CLOSE_REASON));
+        } else if (type == WT_CAPSULE_DRAIN) {
+            wt->draining = true;
+        }
+        /* Unknown capsule types are skipped (RFC 9297 §3.2) */
+        off += a + b + (size_t)clen;
+    }
+
+    if (off == len) {
+        smart_str_free(&wt->capsules);
+    } else if (off > 0) {
+        memmove(ZSTR_VAL(wt->capsules.s), ZSTR_VAL(wt->capsules.s) + off, len - off);
+        ZSTR_LEN(wt->capsules.s) = len - off;
+    }
+    if (wt->capsules.s && ZSTR_LEN(wt->capsules.s) > WT_MAX_CAPSULE_BUFFER) {
+        wt_set_closed(wt, 0, ZEND_STRL("Oversized capsule on the session stream"));
+    }
+}
+
+static int wt_on_status_header(uint8_t *name, size_t name_len, uint8_t *value, size_t value_len, void *argp) {
+    quicpro_wt_t *wt = argp;
+    if (name_len == 7 && memcmp(name, ":status", 7) == 0) {
+        char buf[8];
+        size_t n = MIN(value_len, sizeof(buf) - 1);
+        memcpy(buf, value, n);
+        buf[n] = '\0';
+        wt->status = ZEND_STRTOL(buf, NULL, 10);
+    }
+    return 0;
+}
+
+/* Handles an HTTP/3 event on the CONNECT stream. */
+static void wt_on_connect_event(quicpro_wt_t *wt, quiche_h3_event *ev) {
+    quicpro_session_t *s = wt->session;
+
+    switch (quiche_h3_event_type(ev)) {
+        case QUICHE_H3_EVENT_HEADERS:
+            if (!wt->is_server && wt->status == 0) {
+                quiche_h3_event_for_each_header(ev, wt_on_status_header, wt);
+                if (wt->status < 200 || wt->status > 299) {
+                    char why[64];
+                    int n = snprintf(why, sizeof(why), "Server refused the session with status %ld", (long)wt->status);
+                    wt_set_closed(wt, 0, why, (size_t)n);
+                }
+            }
+            break;
+
+        case QUICHE_H3_EVENT_DATA: {
+            uint8_t buf[4096];
+            ssize_t n;
+            while ((n = quiche_h3_recv_body(s->h3, s->conn, wt->session_id, buf, sizeof(buf))) > 0) {
+                smart_str_appendl(&wt->capsules, (const char *)buf, (size_t)n);
+            }
+            if (wt->capsules.s) {
+                wt_parse_capsules(wt);
+            }
+            break;
+        }
+
+        case QUICHE_H3_EVENT_FINISHED:
+            wt_set_closed(wt, 0, "", 0);
+            break;
+
+        case QUICHE_H3_EVENT_RESET:
+            wt_set_closed(wt, 0, ZEND_STRL("Session stream reset by the peer"));
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Reads HTTP/3 events: the CONNECT stream's are ours, others go to the multiplexer or are dropped. */
+static void wt_h3_events(quicpro_session_t *s, quicpro_wt_t *wt) {
+    quiche_h3_event *ev;
+    int64_t stream_id;
+
+    while ((stream_id = quicpro_prof_h3_conn_poll(s->h3, s->conn, &ev)) >= 0) {
+        if (wt && (uint64_t)stream_id == wt->session_id) {
+            wt_on_connect_event(wt, ev);
+        } else if (quicpro_h3_mux_dispatch(s, ev, (uint64_t)stream_id)) {
+            continue;   /* Consumed and freed */
+        }
+        quiche_h3_event_free(ev);
+    }
+}
+
+static quicpro_wt_t *wt_new(quicpro_session_t *s, zend_resource *session_res, uint64_t session_id, bool is_server) {
+    quicpro_wt_t *wt = ecalloc(1, sizeof(*wt));
+    wt->session = s;
+    wt->session_res = session_res;
+    GC_ADDREF(session_res);
+    wt->session_id = session_id;
+    wt->is_server = is_server;
+    /* Past the CONNECT stream for a client; servers never open HTTP/3 bidi streams */
+    wt->next_bidi = is_server ? 1 : session_id + 4;
+    wt->next_uni = (is_server ? 3 : 2) + 4 * WT_H3_LOCAL_UNI;
+    zend_hash_init(&wt->streams, 8, NULL, wt_stream_dtor, 0);
+    s->wt = wt;
+    wt_live_sessions++;
+    return wt;
+}
+
+static void wt_free(quicpro_wt_t *wt) {
+    quicpro_session_t *s = wt->session;
+
+    if (s->conn && !quiche_conn_is_closed(s->conn)) {
+        if (!wt->closed) {
+            wt_send_close(wt, 0, "", 0);
+        }
+        wt_teardown_streams(wt);
+        if (!wt->is_server && s->sock >= 0) {
+            quicpro_session_pump_tx(s);
+        }
+    }
+    zend_hash_destroy(&wt->streams);
+    smart_str_free(&wt->capsules);
+    if (wt->close_reason) {
+        zend_string_release(wt->close_reason);
+    }
+    s->wt = NULL;
+    wt_live_sessions--;
+    zend_list_delete(wt->session_res);
+    efree(wt);
+}
+
+static void quicpro_wt_dtor(zend_resource *rsrc) {
+    if (rsrc->ptr) {
+        wt_free((quicpro_wt_t *)rsrc->ptr);
+    }
+}
+
+void quicpro_wt_minit(int module_number) {
+    le_quicpro_wt = zend_register_list_destructors_ex(quicpro_wt_dtor, NULL, "Quicpro\\WebTransport", module_number);
+}
+
+/*──────────────────────────── Event collection ───────────────────────────*/
+
+static void wt_event_stream(zval *events, quicpro_wt_stream_t *st, smart_str *data, bool fin) {
+    zval ev;
+    array_init_size(&ev, 6);
+    add_assoc_string(&ev, "type", "stream");
+    add_assoc_long(&ev, "stream_id", (zend_long)st->id);
+    add_assoc_bool(&ev, "bidirectional", st->bidi);
+    add_assoc_bool(&ev, "opened", !st->local && !st->announced);
+    smart_str_0(data);
+    add_assoc_str(&ev, "data", data->s ? data->s : ZSTR_EMPTY_ALLOC());
+    data->s = NULL;
+    add_assoc_bool(&ev, "fin", fin);
+    add_next_index_zval(events, &ev);
+    st->announced = true;
+}
+
+static void wt_event_reset(zval *events, uint64_t stream_id, uint64_t h3_code) {
+    uint32_t code = 0;
+    zval ev;
+    array_init_size(&ev, 3);
+    add_assoc_string(&ev, "type", "reset");
+    add_assoc_long(&ev, "stream_id", (zend_long)stream_id);
+    if (wt_code_from_h3(h3_code, &code)) {
+        add_assoc_long(&ev, "code", (zend_long)code);
+    } else {
+        add_assoc_null(&ev, "code");
+    }
+    add_next_index_zval(events, &ev);
+}
+
+/*
+ * Reads a peer stream's signal value and session ID. Returns the stream
+ * once its header is in, NULL while bytes are missing or if the stream
+ * was rejected.
+ */
+static quicpro_wt_stream_t *wt_claim(quicpro_wt_t *wt, quicpro_wt_stream_t *st) {
+    size_t missing;
+
+    while ((missing = wt_prefix_missing(st)) > 0) {
+        bool fin = false;
+        uint64_t ec = 0;
+        ssize_t n = quiche_conn_stream_recv(wt->session->conn, st->id, st->prefix + st->prefix_len, missing, &fin, &ec);
+        if (n == QUICHE_ERR_DONE) {
+            return NULL;
+        }
+        if (n < 0 || fin) {
+            wt_stream_forget(wt, st);   /* Reset or finished before it said what it is */
+            return NULL;
+        }
+        st->prefix_len += (uint8_t)n;
+    }
+
+    uint64_t signal, sid;
+    size_t a = wt_varint_get(st->prefix, st->prefix_len, &signal);
+    wt_varint_get(st->prefix + a, st->prefix_len - a, &sid);
+    if (signal != (st->bidi ? WT_STREAM_BIDI : WT_STREAM_UNI) || sid != wt->session_id) {
+        /* A grease or push stream, or another session's: not ours to read */
+        wt_stream_abort(wt, st->id, sid != wt->session_id && signal == (st->bidi ? WT_STREAM_BIDI : WT_STREAM_UNI)
+                                    ? WT_ERR_BUFFERED_STREAM_REJECTED : H3_STREAM_CREATION_ERROR);
+        wt_stream_forget(wt, st);
+        return NULL;
+    }
+    st->claimed = true;
+    st->prefix_len = 0;
+    return st;
+}
+
+/* Reads one stream of the session into an event, within `*budget` bytes. */
+static void wt_read_stream(quicpro_wt_t *wt, quicpro_wt_stream_t *st, zval *events, size_t *budget) {
+    smart_str data = {0};
+    bool fin = false;
+
+    while (*budget > 0 && !fin) {
+        uint64_t ec = 0;
+        size_t want = MIN(*budget, (size_t)16384);
+        smart_str_alloc(&data, want, 0);
+        ssize_t n = quiche_conn_stream_recv(wt->session->conn, st->id,
+                                            (uint8_t *)ZSTR_VAL(data.s) + ZSTR_LEN(data.s), want, &fin, &ec);
+        if (n == QUICHE_ERR_DONE) {
+            break;
+        }
+        if (n < 0) {
+            smart_str_free(&data);
+            if (n == QUICHE_ERR_STREAM_RESET) {
+                wt_event_reset(events, st->id, ec);
+            }
+            st->peer_fin = true;
+            wt_stream_maybe_done(wt, st);
+            return;
+        }
+        ZSTR_LEN(data.s) += (size_t)n;
+        *budget -= (size_t)n;
+    }
+
+    if ((data.s && ZSTR_LEN(data.s) > 0) || fin || (!st->local && !st->announced)) {
+        wt_event_stream(events, st, &data, fin);
+    }
+    smart_str_free(&data);
+    if (fin) {
+        st->peer_fin = true;
+        wt_stream_maybe_done(wt, st);
+    }
+}
+
+/* Collects datagrams, stream data and session events that are ready now. */
+static void wt_collect(quicpro_wt_t *wt, zval *events) {
+    quicpro_session_t *s = wt->session;
+
+    wt_h3_events(s, wt);
+
+    if (!wt->closed && quiche_conn_is_closed(s->conn)) {
+        wt_set_closed(wt, 0, ZEND_STRL("QUIC connection closed"));
+    }
+
+    if (!wt->closed) {
+        /* Datagrams: prefixed with the quarter stream ID of the session */
+        zend_long dgrams = quicpro_quic_transport_config.dgram_recv_queue_len;
+        ssize_t n;
+        while (dgrams-- > 0 && (n = quiche_conn_dgram_recv(s->conn, wt_dgram_buf, sizeof(wt_dgram_buf))) >= 0) {
+            uint64_t qsid;
+            size_t hdr = wt_varint_get(wt_dgram_buf, (size_t)n, &qsid);
+            if (hdr == 0 || qsid != wt->session_id / 4) {
+                continue;   /* Malformed or for no session we know */
+            }
+            zval ev;
+            array_init_size(&ev, 2);
+            add_assoc_string(&ev, "type", "datagram");
+            add_assoc_stringl(&ev, "data", (const char *)wt_dgram_buf + hdr, (size_t)n - hdr);
+            add_next_index_zval(events, &ev);
+        }
+
+        /* Streams */
+        size_t budget = WT_POLL_BUDGET;
+        const zend_long max_streams = quicpro_app_protocols_config.webtransport_max_streams_per_session;
+        quiche_stream_iter *readable = quiche_conn_readable(s->conn);
+        uint64_t id;
+        while (budget > 0 && quiche_stream_iter_next(readable, &id)) {
+            quicpro_wt_stream_t *st = zend_hash_index_find_ptr(&wt->streams, (zend_ulong)id);
+            if (!st) {
+                if (!wt_is_peer_candidate(wt, id)) {
+                    continue;   /* HTTP/3 reads it */
+                }
+                if ((zend_long)wt->peer_streams >= max_streams) {
+                    wt_stream_abort(wt, id, WT_ERR_BUFFERED_STREAM_REJECTED);
+                    continue;
+                }
+                st = wt_stream_add(wt, id, false);
+            }
+            if (!st->claimed && !st->local && !wt_claim(wt, st)) {
+                continue;
+            }
+            wt_read_stream(wt, st, events, &budget);
+        }
+        quiche_stream_iter_free(readable);
+
+        if (wt->draining) {
+            zval ev;
+            array_init_size(&ev, 1);
+            add_assoc_string(&ev, "type", "draining");
+            add_next_index_zval(events, &ev);
+            wt->draining = false;
+        }
+    }
+
+    if (wt->closed && !wt->close_reported) {
+        zval ev;
+        array_init_size(&ev, 3);
+        add_assoc_string(&ev, "type", "closed");
+        add_assoc_long(&ev, "code", (zend_long)wt->close_code);
+        add_assoc_str(&ev, "reason", zend_string_copy(wt->close_reason));
+        add_next_index_zval(events, &ev);
+        wt->close_reported = true;
+        wt_teardown_streams(wt);
+    }
+}
+
+/*──────────────────────────── Lookups ────────────────────────────────────*/
+
+static quicpro_session_t *wt_fetch_session(zval *z_sess) {
+    quicpro_session_t *s = (quicpro_session_t *)zend_fetch_resource2_ex(z_sess, "Quicpro\\Session", le_quicpro, le_quicpro_session);
+    if (!s) {
+        return NULL;
+    }
+    if (!s->conn || s->is_closed) {
+        throw_quic_exception(0, "Session is closed");
+        return NULL;
+    }
+    if (!quicpro_app_protocols_config.webtransport_enable) {
+        throw_quic_exception(0, "WebTransport is disabled (quicpro.webtransport_enable)");
+        return NULL;
+    }
+    if (s->wt) {
+        throw_quic_exception(0, "This connection already carries a WebTransport session");
+        return NULL;
+    }
+    return s;
+}
+
+/* The session behind a resource, or NULL after throwing if it is unusable. */
+static quicpro_wt_t *wt_fetch(zval *z_wt, bool need_open) {
+    quicpro_wt_t *wt = (quicpro_wt_t *)zend_fetch_resource_ex(z_wt, "Quicpro\\WebTransport", le_quicpro_wt);
+    if (!wt) {
+        return NULL;
+    }
+    if (!wt->session->conn || wt->session->is_closed) {
+        throw_quic_exception(0, "The WebTransport session's connection is closed");
+        return NULL;
+    }
+    if (need_open && wt->closed) {
+        throw_quic_exception(0, "The WebTransport session is closed");
+        return NULL;
+    }
+    return wt;
+}
+
+/*─────────────────────────── PHP functions ───────────────────────────────*/
+
+/* {{{ quicpro_webtransport_connect(resource $session, string $path, array $headers = [], int $timeout_ms = -1): resource
+ *
+ * Opens a WebTransport session with an extended CONNECT request and waits
+ * for a 2xx response. It first waits for the peer's SETTINGS, which must
+ * enable extended CONNECT and HTTP datagrams. $headers (name => value)
+ * are sent with the request, e.g. `origin`. The connection is dedicated
+ * to the session from now on. Throws on refusal or timeout.
+ */
+PHP_FUNCTION(quicpro_webtransport_connect)
+{
+    zval *z_sess;
+    zend_string *path;
+    HashTable *headers = NULL;
+    zend_long timeout_ms = -1;
+
+    ZEND_PARSE_PARAMETERS_START(2, 4)
+        Z_PARAM_RESOURCE(z_sess)
+        Z_PARAM_STR(path)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_ARRAY_HT(headers)
+        Z_PARAM_LONG(timeout_ms)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = wt_fetch_session(z_sess);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    if (!s->h3) {
+        throw_quic_exception(0, "Session has no HTTP/3 layer");
+        RETURN_THROWS();
+    }
+    if (wt_live_sessions >= (uint32_t)quicpro_app_protocols_config.webtransport_max_concurrent_sessions) {
+        throw_quic_exception(0, "Too many WebTransport sessions (quicpro.webtransport_max_concurrent_sessions)");
+        RETURN_THROWS();
+    }
+
+    zend_long start = quicpro_sched_clock_ms();
+    int rc;
+
+    /* The peer's SETTINGS arrive on its control stream, read by the HTTP/3 layer */
+    for (;;) {
+        quicpro_sched_pump_rx(s);
+        wt_h3_events(s, NULL);
+        quicpro_sched_pump_tx(s);
+        if (quiche_conn_is_established(s->conn) && quiche_h3_extended_connect_enabled_by_peer(s->h3)
+            && quiche_h3_dgram_enabled_by_peer(s->h3, s->conn)) {
+            break;
+        }
+        if (quiche_conn_is_closed(s->conn)) {
+            throw_quic_exception(0, "Connection closed before the peer enabled WebTransport");
+            RETURN_THROWS();
+        }
+        if ((rc = quicpro_sched_wait_conn(s, Z_RES_P(z_sess), start, timeout_ms, "WebTransport data")) <= 0) {
+            if (rc == 0) {
+                throw_quic_exception(0, "Peer did not enable extended CONNECT and HTTP datagrams in time");
+            }
+            RETURN_THROWS();
+        }
+    }
+
+    /* Pseudo-headers first (RFC 9220 §3), then the caller's fields */
+    uint32_t nfields = 5 + (headers ? zend_hash_num_elements(headers) : 0);
+    quiche_h3_header *hdrs = safe_emalloc(nfields, sizeof(*hdrs), 0);
+    zend_string **owned = safe_emalloc(nfields, 2 * sizeof(zend_string *), 0);
+    uint32_t n = 0, nowned = 0;
+
+#define WT_FIELD(nm, nl, v, vl) \
+    (hdrs[n++] = (quiche_h3_header){ (const uint8_t *)(nm), (nl), (const uint8_t *)(v), (vl) })
+    WT_FIELD(":method", 7, "CONNECT", 7);
+    WT_FIELD(":protocol", 9, "webtransport", 12);
+    WT_FIELD(":scheme", 7, "https", 5);
+    WT_FIELD(":authority", 10, s->host, strlen(s->host));
+    WT_FIELD(":path", 5, ZSTR_VAL(path), ZSTR_LEN(path));
+
+    if (headers) {
+        zend_string *name;
+        zval *value;
+        ZEND_HASH_FOREACH_STR_KEY_VAL(headers, name, value) {
+            if (!name) {
+                continue;
+            }
+            /* HTTP/3 field names are lowercase (RFC 9114 §4.2) */
+            zend_string *lname = owned[nowned++] = zend_string_tolower(name);
+            zend_string *sval = owned[nowned++] = zval_get_string(value);
+            WT_FIELD(ZSTR_VAL(lname), ZSTR_LEN(lname), ZSTR_VAL(sval), ZSTR_LEN(sval));
+        } ZEND_HASH_FOREACH_END();
+    }
+#undef WT_FIELD
+
+    int64_t stream_id = quiche_h3_send_request(s->h3, s->conn, hdrs, n, false);
+    for (uint32_t i = 0; i < nowned; i++) {
+        zend_string_release(owned[i]);
+    }
+    efree(owned);
+    efree(hdrs);
+    if (stream_id < 0) {
+        throw_quic_exception((int)stream_id, "Failed to send the WebTransport CONNECT request (quiche error %d)", (int)stream_id);
+        RETURN_THROWS();
+    }
+
+    quicpro_wt_t *wt = wt_new(s, Z_RES_P(z_sess), (uint64_t)stream_id, false);
+    for (;;) {
+        quicpro_sched_pump_tx(s);
+        quicpro_sched_pump_rx(s);
+        wt_h3_events(s, wt);
+        if (wt->status != 0 || wt->closed) {
+            break;
+        }
+        if (quiche_conn_is_closed(s->conn)) {
+            wt_set_closed(wt, 0, ZEND_STRL("Connection closed before the CONNECT response"));
+            break;
+        }
+        if ((rc = quicpro_sched_wait_conn(s, Z_RES_P(z_sess), start, timeout_ms, "WebTransport data")) <= 0) {
+            if (rc == 0) {
+                wt_set_closed(wt, 0, ZEND_STRL("Timed out waiting for the CONNECT response"));
+            }
+            break;
+        }
+    }
+
+    if (EG(exception)) {
+        wt_free(wt);
+        RETURN_THROWS();
+    }
+    if (wt->closed) {
+        throw_quic_exception(0, "WebTransport session not established: %s", ZSTR_VAL(wt->close_reason));
+        wt_free(wt);
+        RETURN_THROWS();
+    }
+    RETURN_RES(zend_register_resource(wt, le_quicpro_wt));
+}
+/* }}} */
+
+typedef struct {
+    zend_string *method;
+    zend_string *protocol;
+    zend_string *path;
+    zend_string *authority;
+    zval         headers;
+} wt_request_t;
+
+static int wt_on_request_header(uint8_t *name, size_t name_len, uint8_t *value, size_t value_len, void *argp) {
+    wt_request_t *req = argp;
+    zend_string **slot = NULL;
+
+    if (name_len > 0 && name[0] == ':') {
+        if (name_len == 7 && memcmp(name, ":method", 7) == 0) {
+            slot = &req->method;
+        } else if (name_len == 9 && memcmp(name, ":protocol", 9) == 0) {
+            slot = &req->protocol;
+        } else if (name_len == 5 && memcmp(name, ":path", 5) == 0) {
+            slot = &req->path;
+        } else if (name_len == 10 && memcmp(name, ":authority", 10) == 0) {
+            slot = &req->authority;
+        }
+        if (slot && !*slot) {
+            *slot = zend_string_init((const char *)value, value_len, 0);
+        }
+        return 0;
+    }
+    add_assoc_stringl_ex(&req->headers, (const char *)name, name_len, (const char *)value, value_len);
+    return 0;
+}
+
+static void wt_request_free(wt_request_t *req) {
+    zend_string *slots[] = { req->method, req->protocol, req->path, req->authority };
+    for (size_t i = 0; i < sizeof(slots) / sizeof(slots[0]); i++) {
+        if (slots[i]) {
+            zend_string_release(slots[i]);
+        }
+    }
+    zval_ptr_dtor(&req->headers);
+}
+
+static void wt_respond(quicpro_session_t *s, uint64_t stream_id, const char *status, bool fin) {
+    quiche_h3_header hdrs[] = {
+        { (const uint8_t *)":status", 7, (const uint8_t *)status, strlen(status) },
+        { (const uint8_t *)"sec-webtransport-http3-draft", 28, (const uint8_t *)"draft02", 7 },
+    };
+    quiche_h3_send_response(s->h3, s->conn, stream_id, hdrs, fin ? 1 : 2, fin);
+}
+
+/* {{{ quicpro_webtransport_accept(resource $session): ?array
+ *
+ * Server side: answers an extended CONNECT request for WebTransport on
+ * this connection with 200. Returns ['session' => resource, 'path' =>
+ * string, 'authority' => string, 'headers' => array], or null if no such
+ * request has arrived yet. Other requests on the connection get 501.
+ * Non-blocking; call it from the listener callback.
+ */
+PHP_FUNCTION(quicpro_webtransport_accept)
+{
+    zval *z_sess;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_RESOURCE(z_sess)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_session_t *s = wt_fetch_session(z_sess);
+    if (!s) {
+        RETURN_THROWS();
+    }
+    if (!s->h3) {
+        s->h3_cfg = quiche_h3_config_new();
+        if (s->h3_cfg) {
+            quicpro_h3_settings_apply(s->h3_cfg);
+            quiche_h3_config_enable_extended_connect(s->h3_cfg, true);
+            s->h3 = quiche_h3_conn_new_with_transport(s->conn, s->h3_cfg);
+        }
+        if (!s->h3) {
+            throw_quic_exception(0, "Failed to initialize HTTP/3 on the connection");
+            RETURN_THROWS();
+        }
+    }
+
+    quiche_h3_event *ev;
+    int64_t stream_id;
+    while ((stream_id = quicpro_prof_h3_conn_poll(s->h3, s->conn, &ev)) >= 0) {
+        if (quiche_h3_event_type(ev) != QUICHE_H3_EVENT_HEADERS) {
+            quiche_h3_event_free(ev);
+            continue;
+        }
+
+        wt_request_t req = {0};
+        array_init(&req.headers);
+        quiche_h3_event_for_each_header(ev, wt_on_request_header, &req);
+        quiche_h3_event_free(ev);
+
+        bool is_wt = req.method && zend_string_equals_literal(req.method, "CONNECT")
+                  && req.protocol && zend_string_equals_literal(req.protocol, "webtransport");
+        if (!is_wt) {
+            wt_respond(s, (uint64_t)stream_id, "501", true);
+            wt_request_free(&req);
+            continue;
+        }
+        if (wt_live_sessions >= (uint32_t)quicpro_app_protocols_config.webtransport_max_concurrent_sessions) {
+            wt_respond(s, (uint64_t)stream_id, "429", true);
+            wt_request_free(&req);
+            continue;
+        }
+
+        wt_respond(s, (uint64_t)stream_id, "200", false);
+        quicpro_wt_t *wt = wt_new(s, Z_RES_P(z_sess), (uint64_t)stream_id, true);
+        wt->status = 200;
+
+        array_init_size(return_value, 4);
+        add_assoc_resource(return_value, "session", zend_register_resource(wt, le_quicpro_wt));
+        add_assoc_str(return_value, "path", req.path ? zend_string_copy(req.path) : ZSTR_EMPTY_ALLOC());
+        add_assoc_str(return_value, "authority", req.authority ? zend_string_copy(req.authority) : ZSTR_EMPTY_ALLOC());
+        add_assoc_zval(return_value, "headers", &req.headers);
+        ZVAL_UNDEF(&req.headers);   /* Moved into the result */
+        wt_request_free(&req);
+        return;
+    }
+    RETURN_NULL();
+}
+/* }}} */
+
+/* {{{ quicpro_webtransport_open_stream(resource $wt, bool $bidirectional = true): int|false
+ *
+ * Opens a stream in the session and returns its ID, or false while the
+ * peer grants no more streams or quicpro.webtransport_max_streams_per_session
+ * of ours are open.
+ */
+PHP_FUNCTION(quicpro_webtransport_open_stream)
+{
+    zval *z_wt;
+    zend_bool bidirectional = 1;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_RESOURCE(z_wt)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_BOOL(bidirectional)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_wt_t *wt = wt_fetch(z_wt, true);
+    if (!wt) {
+        RETURN_THROWS();
+    }
+    uint32_t local = zend_hash_num_elements(&wt->streams) - wt->peer_streams;
+    if ((zend_long)local >= quicpro_app_protocols_config.webtransport_max_streams_per_session) {
+        RETURN_FALSE;
+    }
+
+    uint64_t id = bidirectional ? wt->next_bidi : wt->next_uni;
+    uint8_t prefix[16];
+    size_t n = wt_varint_put(prefix, bidirectional ? WT_STREAM_BIDI : WT_STREAM_UNI);
+    n += wt_varint_put(prefix + n, wt->session_id);
+
+    uint64_t ec = 0;
+    ssize_t sent = quiche_conn_stream_send(wt->session->conn, id, prefix, n, false, &ec);
+    if (sent == QUICHE_ERR_STREAM_LIMIT || sent == QUICHE_ERR_DONE) {
+        RETURN_FALSE;
+    }
+    if (sent < 0) {
+        throw_quic_exception((int)sent, "Failed to open a WebTransport stream (quiche error %d)", (int)sent);
+        RETURN_THROWS();
+    }
+    if (bidirectional) {
+        wt->next_bidi += 4;
+    } else {
+        wt->next_uni += 4;
+    }
+
+    quicpro_wt_stream_t *st = wt_stream_add(wt, id, true);
+    /* Whatever of the header did not fit goes out ahead of the first send */
+    memcpy(st->prefix, prefix + sent, n - (size_t)sent);
+    st->prefix_len = (uint8_t)(n - (size_t)sent);
+
+    quicpro_sched_pump_tx(wt->session);
+    RETURN_LONG((zend_long)id);
+}
+/* }}} */
+
+/* {{{ quicpro_webtransport_stream_send(resource $wt, int $stream_id, string $data, bool $fin = false): int|false
+ *
+ * Writes to a stream of the session. Returns the bytes accepted, which
+ * may be fewer than given (or 0) when flow control is exhausted. $fin
+ * takes effect only if all of $data is accepted. Returns false if the
+ * peer asked us to stop sending.
+ */
+PHP_FUNCTION(quicpro_webtransport_stream_send)
+{
+    zval *z_wt;
+    zend_long stream_id;
+    zend_string *data;
+    zend_bool fin = 0;
+
+    ZEND_PARSE_PARAMETERS_START(3, 4)
+        Z_PARAM_RESOURCE(z_wt)
+        Z_PARAM_LONG(stream_id)
+        Z_PARAM_STR(data)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_BOOL(fin)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_wt_t *wt = wt_fetch(z_wt, true);
+    if (!wt) {
+        RETURN_THROWS();
+    }
+    quicpro_wt_stream_t *st = stream_id >= 0 ? zend_hash_index_find_ptr(&wt->streams, (zend_ulong)stream_id) : NULL;
+    if (!st || (!st->bidi && !st->local) || st->local_fin) {
+        zend_argument_value_error(2, "is not a writable stream of this WebTransport session");
+        RETURN_THROWS();
+    }
+    if (!wt_prefix_flush(wt, st)) {
+        quicpro_sched_pump_tx(wt->session);
+        RETURN_LONG(0);
+    }
+
+    uint64_t ec = 0;
+    ssize_t sent = quiche_conn_stream_send(wt->session->conn, st->id, (const uint8_t *)ZSTR_VAL(data), ZSTR_LEN(data), fin, &ec);
+    if (sent == QUICHE_ERR_DONE) {
+        RETURN_LONG(0);
+    }
+    if (sent == QUICHE_ERR_STREAM_STOPPED) {
+        st->local_fin = true;
+        wt_stream_maybe_done(wt, st);
+        RETURN_FALSE;
+    }
+    if (sent < 0) {
+        throw_quic_exception((int)sent, "Failed to write to WebTransport stream %ld (quiche error %d)", (long)stream_id, (int)sent);
+        RETURN_THROWS();
+    }
+    if (fin && (size_t)sent == ZSTR_LEN(data)) {
+        st->local_fin = true;
+        wt_stream_maybe_done(wt, st);
+    }
+    quicpro_sched_pump_tx(wt->session);
+    RETURN_LONG((zend_long)sent);
+}
+/* }}} */
+
+/* {{{ quicpro_webtransport_send_datagram(resource $wt, string $data): bool
+ *
+ * Queues one unreliable datagram. Returns false if the send queue
+ * (quicpro.transport_dgram_send_queue_len) is full. Throws if $data is
+ * larger than the current path can carry.
+ */
+PHP_FUNCTION(quicpro_webtransport_send_datagram)
+{
+    zval *z_wt;
+    zend_string *data;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_RESOURCE(z_wt)
+        Z_PARAM_STR(data)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_wt_t *wt = wt_fetch(z_wt, true);
+    if (!wt) {
+        RETURN_THROWS();
+    }
+
+    size_t hdr = wt_varint_len(wt->session_id / 4);
+    ssize_t max = quiche_conn_dgram_max_writable_len(wt->session->conn);
+    if (max < 0 || ZSTR_LEN(data) + hdr > (size_t)max) {
+        throw_quic_exception(0, "Datagram of %zu bytes exceeds the %zd the current path allows",
+                             ZSTR_LEN(data), max > (ssize_t)hdr ? max - (ssize_t)hdr : 0);
+        RETURN_THROWS();
+    }
+
+    wt_varint_put(wt_dgram_buf, wt->session_id / 4);
+    memcpy(wt_dgram_buf + hdr, ZSTR_VAL(data), ZSTR_LEN(data));
+    ssize_t rc = quiche_conn_dgram_send(wt->session->conn, wt_dgram_buf, hdr + ZSTR_LEN(data));
+    if (rc == QUICHE_ERR_DONE) {
+        RETURN_FALSE;
+    }
+    if (rc < 0) {
+        throw_quic_exception((int)rc, "Failed to queue WebTransport datagram (quiche error %d)", (int)rc);
+        RETURN_THROWS();
+    }
+    quicpro_sched_pump_tx(wt->session);
+    RETURN_TRUE;
+}
+/* }}} */
+
+/* {{{ quicpro_webtransport_poll(resource $wt, int $timeout_ms = -1): array|false
+ *
+ * Drives the session until something happens or $timeout_ms elapses, and
+ * returns the events in arrival order:
+ *   ['type' => 'datagram', 'data' => string]
+ *   ['type' => 'stream', 'stream_id' => int, 'bidirectional' => bool,
+ *    'opened' => bool, 'data' => string, 'fin' => bool]
+ *   ['type' => 'reset', 'stream_id' => int, 'code' => ?int]
+ *   ['type' => 'draining']
+ *   ['type' => 'closed', 'code' => int, 'reason' => string]
+ * 'opened' marks the first event of a stream the peer started. Returns []
+ * on timeout, false once 'closed' has been delivered. Server sessions
+ * never block.
+ */
+PHP_FUNCTION(quicpro_webtransport_poll)
+{
+    zval *z_wt;
+    zend_long timeout_ms = -1;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_RESOURCE(z_wt)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(timeout_ms)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_wt_t *wt = wt_fetch(z_wt, false);
+    if (!wt) {
+        RETURN_THROWS();
+    }
+    if (wt->close_reported) {
+        RETURN_FALSE;
+    }
+
+    quicpro_session_t *s = wt->session;
+    zend_long start = quicpro_sched_clock_ms();
+
+    array_init(return_value);
+    for (;;) {
+        quicpro_sched_pump_rx(s);
+        wt_collect(wt, return_value);
+        quicpro_sched_pump_tx(s);
+        if (zend_hash_num_elements(Z_ARRVAL_P(return_value)) > 0) {
+            return;
+        }
+        int rc = quicpro_sched_wait_conn(s, wt->session_res, start, timeout_ms, "WebTransport data");
+        if (rc < 0) {
+            zval_ptr_dtor(return_value);
+            RETURN_THROWS();
+        }
+        if (rc == 0) {
+            return;
+        }
+    }
+}
+/* }}} */
+
+/* {{{ quicpro_webtransport_close(resource $wt, int $code = 0, string $reason = ""): bool
+ *
+ * Closes the session with CLOSE_WEBTRANSPORT_SESSION and resets its open
+ * streams. Returns false if it was already closed.
+ */
+PHP_FUNCTION(quicpro_webtransport_close)
+{
+    zval *z_wt;
+    zend_long code = 0;
+    zend_string *reason = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 3)
+        Z_PARAM_RESOURCE(z_wt)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(code)
+        Z_PARAM_STR(reason)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (code < 0 || code > UINT32_MAX) {
+        zend_argument_value_error(2, "must be between 0 and 4294967295");
+        RETURN_THROWS();
+    }
+    if (reason && ZSTR_LEN(reason) > WT_MAX_CLOSE_REASON) {
+        zend_argument_value_error(3, "must be at most %d bytes", WT_MAX_CLOSE_REASON);
+        RETURN_THROWS();
+    }
+
+    quicpro_wt_t *wt = wt_fetch(z_wt, false);
+    if (!wt) {
+        RETURN_THROWS();
+    }
+    if (wt->closed) {
+        RETURN_FALSE;
+    }
+
+    wt_send_close(wt, (uint32_t)code, reason ? ZSTR_VAL(reason) : "", reason ? ZSTR_LEN(reason) : 0);
+    wt_set_closed(wt, (uint32_t)code, reason ? ZSTR_VAL(reason) : "", reason ? ZSTR_LEN(reason) : 0);
+    wt->close_reported = true;  /* Closed by us; no event for it */
+    wt_teardown_streams(wt);
+    quicpro_sched_pump_tx(wt->session);
+    RETURN_TRUE;
+}
+/* }}} */
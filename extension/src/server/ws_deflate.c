@@ -0,0 +1,390 @@
+/*
+ * ws_deflate.c  –  permessage-deflate negotiation and message codec
+ * -----------------------------------------------------------------
+ *
+ * Each message is deflated with Z_SYNC_FLUSH and the trailing 00 00 ff ff
+ * is stripped. The receiver appends that tail again before inflating
+ * (RFC 7692 §7.2). Raw deflate in zlib cannot use an 8-bit window for
+ * compression, so an offer that forces one on us is declined. We inflate
+ * at any size.
+ */
+
+#include "server/ws_deflate.h"
+#include "config/app_http3_websockets_webtransport/base_layer.h"
+
+#include <string.h>
+#include <strings.h>
+
+#ifdef QUICPRO_HAVE_ZLIB
+# include <zlib.h>
+#endif
+
+#define QP_WS_DEFLATE_NAME "permessage-deflate"
+
+struct quicpro_ws_deflate_s {
+#ifdef QUICPRO_HAVE_ZLIB
+    z_stream tx;
+    z_stream rx;
+#endif
+    int      tx_bits;
+    bool     tx_reset;     /* Our no_context_takeover */
+    bool     rx_reset;     /* The peer's */
+    bool     rx_ended;     /* The current message hit a final deflate block */
+};
+
+/*──────────────────────────── Negotiation ────────────────────────────────*/
+
+typedef struct {
+    bool snct, cnct;
+    int  smwb;   /* -1 absent, 0 given without a value, else 8..15 */
+    int  cmwb;
+} quicpro_ws_ext_t;
+
+static void quicpro_ws_trim(const char **p, const char **end)
+{
+    while (*p < *end && (**p == ' ' || **p == '\t')) {
+        (*p)++;
+    }
+    while (*end > *p && ((*end)[-1] == ' ' || (*end)[-1] == '\t')) {
+        (*end)--;
+    }
+}
+
+static bool quicpro_ws_window_bits(const char *v, const char *end, int *out)
+{
+    if (end - v >= 2 && *v == '"' && end[-1] == '"') {
+        v++;
+        end--;
+    }
+    if (end - v < 1 || end - v > 2) {
+        return false;
+    }
+    int n = 0;
+    for (; v < end; v++) {
+        if (*v < '0' || *v > '9') {
+            return false;
+        }
+        n = n * 10 + (*v - '0');
+    }
+    if (n < 8 || n > 15) {
+        return false;
+    }
+    *out = n;
+    return true;
+}
+
+/* Parses one element of the extension list; false if it is not a valid permessage-deflate. */
+static bool quicpro_ws_ext_parse(const char *p, const char *end, quicpro_ws_ext_t *e)
+{
+    const char *semi = memchr(p, ';', (size_t)(end - p));
+    const char *name_end = semi ? semi : end;
+
+    *e = (quicpro_ws_ext_t){ .smwb = -1, .cmwb = -1 };
+    quicpro_ws_trim(&p, &name_end);
+    if ((size_t)(name_end - p) != sizeof(QP_WS_DEFLATE_NAME) - 1
+        || strncasecmp(p, QP_WS_DEFLATE_NAME, sizeof(QP_WS_DEFLATE_NAME) - 1) != 0) {
+        return false;
+    }
+
+    while (semi) {
+        const char *q = semi + 1;
+        semi = memchr(q, ';', (size_t)(end - q));
+        const char *q_end = semi ? semi : end;
+        const char *eq = memchr(q, '=', (size_t)(q_end - q));
+        const char *k_end = eq ? eq : q_end;
+        quicpro_ws_trim(&q, &k_end);
+        size_t klen = (size_t)(k_end - q);
+
+#define QP_WS_PARAM(lit) (klen == sizeof(lit) - 1 && strncasecmp(q, lit, klen) == 0)
+        if (QP_WS_PARAM("server_no_context_takeover") || QP_WS_PARAM("client_no_context_takeover")) {
+            bool *flag = q[0] == 's' || q[0] == 'S' ? &e->snct : &e->cnct;
+            if (eq || *flag) {
+                return false;
+            }
+            *flag = true;
+        } else if (QP_WS_PARAM("server_max_window_bits") || QP_WS_PARAM("client_max_window_bits")) {
+            int *bits = q[0] == 's' || q[0] == 'S' ? &e->smwb : &e->cmwb;
+            if (*bits != -1) {
+                return false;
+            }
+            *bits = 0;
+            if (eq) {
+                const char *v = eq + 1, *v_end = q_end;
+                quicpro_ws_trim(&v, &v_end);
+                if (!quicpro_ws_window_bits(v, v_end, bits)) {
+                    return false;
+                }
+            }
+        } else {
+            return false;
+        }
+#undef QP_WS_PARAM
+    }
+    return true;
+}
+
+void quicpro_ws_deflate_offer(smart_str *out)
+{
+#ifdef QUICPRO_HAVE_ZLIB
+    const zend_long bits = quicpro_app_protocols_config.websocket_deflate_max_window_bits;
+
+    if (!quicpro_app_protocols_config.websocket_deflate_enable) {
+        return;
+    }
+    smart_str_appends(out, QP_WS_DEFLATE_NAME "; client_max_window_bits");
+    if (bits < 15) {
+        smart_str_append_printf(out, "=%ld; server_max_window_bits=%ld", (long)bits, (long)bits);
+    }
+    if (quicpro_app_protocols_config.websocket_deflate_no_context_takeover) {
+        smart_str_appends(out, "; client_no_context_takeover; server_no_context_takeover");
+    }
+#else
+    (void)out;
+#endif
+}
+
+bool quicpro_ws_deflate_accept(const char *header, size_t len, quicpro_ws_deflate_params_t *params,
+                               smart_str *response)
+{
+#ifdef QUICPRO_HAVE_ZLIB
+    const int  bits = (int)quicpro_app_protocols_config.websocket_deflate_max_window_bits;
+    const bool nct  = quicpro_app_protocols_config.websocket_deflate_no_context_takeover;
+    const char *p = header, *end = header + len;
+
+    if (!quicpro_app_protocols_config.websocket_deflate_enable) {
+        return false;
+    }
+    while (p < end) {
+        const char *comma = memchr(p, ',', (size_t)(end - p));
+        const char *el_end = comma ? comma : end;
+        quicpro_ws_ext_t e;
+
+        if (quicpro_ws_ext_parse(p, el_end, &e) && e.smwb != 0 && e.smwb != 8) {
+            params->server_max_window_bits = (uint8_t)(e.smwb > 0 && e.smwb < bits ? e.smwb : bits);
+            params->client_max_window_bits = 15;
+            if (e.cmwb != -1) {
+                /* The client announced support; we may bound its window too */
+                params->client_max_window_bits = (uint8_t)(e.cmwb > 0 && e.cmwb < bits ? e.cmwb : bits);
+            }
+            params->server_no_context_takeover = e.snct || nct;
+            params->client_no_context_takeover = e.cnct || nct;
+
+            smart_str_appends(response, QP_WS_DEFLATE_NAME);
+            if (params->server_no_context_takeover) {
+                smart_str_appends(response, "; server_no_context_takeover");
+            }
+            if (params->client_no_context_takeover) {
+                smart_str_appends(response, "; client_no_context_takeover");
+            }
+            if (e.smwb > 0 || params->server_max_window_bits < 15) {
+                smart_str_append_printf(response, "; server_max_window_bits=%d", params->server_max_window_bits);
+            }
+            if (e.cmwb != -1 && params->client_max_window_bits < 15) {
+                smart_str_append_printf(response, "; client_max_window_bits=%d", params->client_max_window_bits);
+            }
+            return true;
+        }
+        p = comma ? comma + 1 : end;
+    }
+#else
+    (void)header; (void)len; (void)params; (void)response;
+#endif
+    return false;
+}
+
+bool quicpro_ws_deflate_confirm(const char *header, size_t len, quicpro_ws_deflate_params_t *params)
+{
+#ifdef QUICPRO_HAVE_ZLIB
+    const int   bits = (int)quicpro_app_protocols_config.websocket_deflate_max_window_bits;
+    const char *end = header + len;
+    quicpro_ws_ext_t e;
+
+    /* A server accepts exactly one offer; a list is a protocol error */
+    if (!quicpro_app_protocols_config.websocket_deflate_enable || memchr(header, ',', len)
+        || !quicpro_ws_ext_parse(header, end, &e) || e.smwb == 0 || e.cmwb == 0
+        || (bits < 15 && (e.smwb == -1 || e.smwb > bits))) {
+        return false;
+    }
+    /* We cannot compress with an 8-bit window */
+    if (e.cmwb == 8) {
+        return false;
+    }
+    params->server_max_window_bits = (uint8_t)(e.smwb > 0 ? e.smwb : 15);
+    params->client_max_window_bits = (uint8_t)(e.cmwb > 0 && e.cmwb < bits ? e.cmwb : bits);
+    params->server_no_context_takeover = e.snct;
+    params->client_no_context_takeover = e.cnct || quicpro_app_protocols_config.websocket_deflate_no_context_takeover;
+    return true;
+#else
+    (void)header; (void)len; (void)params;
+    return false;
+#endif
+}
+
+/*──────────────────────────── Codec ──────────────────────────────────────*/
+
+quicpro_ws_deflate_t *quicpro_ws_deflate_new(const quicpro_ws_deflate_params_t *params, bool is_server)
+{
+#ifdef QUICPRO_HAVE_ZLIB
+    quicpro_ws_deflate_t *d = ecalloc(1, sizeof(*d));
+    int tx_bits = is_server ? params->server_max_window_bits : params->client_max_window_bits;
+    int rx_bits = is_server ? params->client_max_window_bits : params->server_max_window_bits;
+
+    d->tx_bits  = tx_bits;
+    d->tx_reset = is_server ? params->server_no_context_takeover : params->client_no_context_takeover;
+    d->rx_reset = is_server ? params->client_no_context_takeover : params->server_no_context_takeover;
+
+    if (deflateInit2(&d->tx, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -tx_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        efree(d);
+        return NULL;
+    }
+    if (inflateInit2(&d->rx, -rx_bits) != Z_OK) {
+        deflateEnd(&d->tx);
+        efree(d);
+        return NULL;
+    }
+    return d;
+#else
+    (void)params; (void)is_server;
+    return NULL;
+#endif
+}
+
+#ifdef QUICPRO_HAVE_ZLIB
+/* Deflates `in` as one message on `z`; the caller resets or ends the stream. */
+static zend_string *quicpro_ws_deflate_run(z_stream *z, const uint8_t *in, size_t len)
+{
+    /* deflateBound() covers the stream end; a sync flush adds at most 5 bytes more */
+    size_t cap = deflateBound(z, (uLong)len) + 8;
+    zend_string *out = zend_string_alloc(cap, 0);
+
+    z->next_in   = (Bytef *)in;
+    z->avail_in  = (uInt)len;
+    z->next_out  = (Bytef *)ZSTR_VAL(out);
+    z->avail_out = (uInt)cap;
+
+    int rc = deflate(z, Z_SYNC_FLUSH);
+    size_t produced = cap - z->avail_out;
+    if (rc != Z_OK || z->avail_in != 0 || produced < 4) {
+        zend_string_efree(out);
+        return NULL;
+    }
+
+    /* Strip the 00 00 ff ff of the empty stored block the flush ended with */
+    ZSTR_LEN(out) = produced - 4;
+    ZSTR_VAL(out)[ZSTR_LEN(out)] = '\0';
+    return out;
+}
+#endif
+
+zend_string *quicpro_ws_deflate_compress(quicpro_ws_deflate_t *d, const uint8_t *in, size_t len)
+{
+#ifdef QUICPRO_HAVE_ZLIB
+    zend_string *out = quicpro_ws_deflate_run(&d->tx, in, len);
+
+    if (!out || d->tx_reset) {
+        deflateReset(&d->tx);
+    }
+    return out;
+#else
+    (void)d; (void)in; (void)len;
+    return NULL;
+#endif
+}
+
+zend_string *quicpro_ws_deflate_compress_once(const uint8_t *in, size_t len, int window_bits)
+{
+#ifdef QUICPRO_HAVE_ZLIB
+    z_stream z = {0};
+
+    if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return NULL;
+    }
+    zend_string *out = quicpro_ws_deflate_run(&z, in, len);
+    deflateEnd(&z);
+    return out;
+#else
+    (void)in; (void)len; (void)window_bits;
+    return NULL;
+#endif
+}
+
+int quicpro_ws_deflate_shared_window(const quicpro_ws_deflate_t *d)
+{
+    return d->tx_reset ? d->tx_bits : 0;
+}
+
+bool quicpro_ws_deflate_inflate(quicpro_ws_deflate_t *d, const uint8_t *in, size_t len, bool fin,
+                               size_t max_len, smart_str *out)
+{
+#ifdef QUICPRO_HAVE_ZLIB
+    static const uint8_t tail[4] = { 0x00, 0x00, 0xff, 0xff };
+    bool ok = true;
+
+    for (int part = 0; part < 2 && ok; part++) {
+        size_t n = part == 0 ? len : (fin ? sizeof(tail) : 0);
+        if (n == 0 || d->rx_ended) {
+            continue;
+        }
+        d->rx.next_in  = (Bytef *)(part == 0 ? in : tail);
+        d->rx.avail_in = (uInt)n;
+
+        /* A full output buffer may leave more pending inside zlib; go round again */
+        do {
+            size_t have = out->s ? ZSTR_LEN(out->s) : 0;
+            if (have > max_len) {
+                ok = false;
+                break;
+            }
+            size_t room = MIN(n * 4 + 4096, max_len + 1 - have);
+            smart_str_alloc(out, room, 0);
+            d->rx.next_out  = (Bytef *)ZSTR_VAL(out->s) + ZSTR_LEN(out->s);
+            d->rx.avail_out = (uInt)room;
+
+            int rc = inflate(&d->rx, Z_SYNC_FLUSH);
+            ZSTR_LEN(out->s) += room - d->rx.avail_out;
+            if ((rc != Z_OK && rc != Z_BUF_ERROR && rc != Z_STREAM_END) || ZSTR_LEN(out->s) > max_len) {
+                ok = false;
+                break;
+            }
+            if (rc == Z_STREAM_END) {
+                d->rx_ended = true;  /* The peer set BFINAL; the rest of this message is padding */
+                break;
+            }
+        } while (d->rx.avail_out == 0);
+    }
+    if (!ok || fin) {
+        if (!ok || d->rx_reset || d->rx_ended) {
+            inflateReset(&d->rx);
+        }
+        d->rx_ended = false;
+    }
+    return ok;
+#else
+    (void)d; (void)in; (void)len; (void)fin; (void)max_len; (void)out;
+    return false;
+#endif
+}
+
+zend_string *quicpro_ws_deflate_decompress(quicpro_ws_deflate_t *d, const uint8_t *in, size_t len, size_t max_len)
+{
+    smart_str out = {0};
+
+    if (!quicpro_ws_deflate_inflate(d, in, len, true, max_len, &out)) {
+        smart_str_free(&out);
+        return NULL;
+    }
+    smart_str_0(&out);
+    return out.s ? out.s : ZSTR_EMPTY_ALLOC();
+}
+
+void quicpro_ws_deflate_free(quicpro_ws_deflate_t *d)
+{
+    if (!d) {
+        return;
+    }
+#ifdef QUICPRO_HAVE_ZLIB
+    deflateEnd(&d->tx);
+    inflateEnd(&d->rx);
+#endif
+    efree(d);
+}
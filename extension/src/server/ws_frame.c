@@ -0,0 +1,144 @@
+/*
+ * ws_frame.c  –  WebSocket frame headers and payload masking
+ * ----------------------------------------------------------
+ *
+ * The mask is rotated once to the payload offset and then broadcast to a
+ * vector register. Every wide step starts at a multiple of 4 bytes into
+ * the run, so the same register lines up for each step, and the tail
+ * loop can index the rotated key with i & 3.
+ */
+
+#include "server/ws_frame.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
+
+/*──────────────────────────── Header ─────────────────────────────────────*/
+
+size_t quicpro_ws_frame_header(uint8_t *out, bool fin, uint8_t rsv, uint8_t opcode, uint64_t payload_len,
+                               const uint8_t mask[4])
+{
+    size_t n;
+
+    out[0] = (fin ? 0x80 : 0x00) | (uint8_t)((rsv & 0x07) << 4) | (opcode & 0x0F);
+    out[1] = mask ? 0x80 : 0x00;
+    if (payload_len <= 125) {
+        out[1] |= (uint8_t)payload_len;
+        n = 2;
+    } else if (payload_len <= 0xFFFF) {
+        out[1] |= 126;
+        out[2] = (uint8_t)(payload_len >> 8);
+        out[3] = (uint8_t)payload_len;
+        n = 4;
+    } else {
+        out[1] |= 127;
+        for (int i = 0; i < 8; i++) {
+            out[2 + i] = (uint8_t)(payload_len >> (56 - 8 * i));
+        }
+        n = 10;
+    }
+    if (mask) {
+        memcpy(out + n, mask, 4);
+        n += 4;
+    }
+    return n;
+}
+
+ssize_t quicpro_ws_frame_parse(const uint8_t *buf, size_t len, quicpro_ws_frame_t *f)
+{
+    size_t n = 2;
+
+    if (len < 2) {
+        return QUICPRO_WS_INCOMPLETE;
+    }
+    f->fin    = (buf[0] & 0x80) != 0;
+    f->rsv    = (buf[0] >> 4) & 0x07;
+    f->opcode = buf[0] & 0x0F;
+    f->masked = (buf[1] & 0x80) != 0;
+    f->payload_len = buf[1] & 0x7F;
+
+    if (f->payload_len == 126) {
+        if (len < 4) {
+            return QUICPRO_WS_INCOMPLETE;
+        }
+        f->payload_len = ((uint64_t)buf[2] << 8) | buf[3];
+        n = 4;
+    } else if (f->payload_len == 127) {
+        if (len < 10) {
+            return QUICPRO_WS_INCOMPLETE;
+        }
+        f->payload_len = 0;
+        for (int i = 0; i < 8; i++) {
+            f->payload_len = (f->payload_len << 8) | buf[2 + i];
+        }
+        if (f->payload_len >> 63) {
+            return QUICPRO_WS_ERROR;
+        }
+        n = 10;
+    }
+
+    /* Control frames are never fragmented and carry at most 125 bytes */
+    if ((f->opcode & 0x08) && (!f->fin || f->payload_len > 125)) {
+        return QUICPRO_WS_ERROR;
+    }
+
+    if (f->masked) {
+        if (len < n + 4) {
+            return QUICPRO_WS_INCOMPLETE;
+        }
+        memcpy(f->mask, buf + n, 4);
+        n += 4;
+    }
+    return (ssize_t)n;
+}
+
+/*──────────────────────────── Masking ────────────────────────────────────*/
+
+void quicpro_ws_mask_copy(uint8_t *dst, const uint8_t *src, size_t len, const uint8_t mask[4], size_t offset)
+{
+    const uint8_t k[4] = {
+        mask[offset & 3], mask[(offset + 1) & 3], mask[(offset + 2) & 3], mask[(offset + 3) & 3]
+    };
+    uint32_t k32;
+    size_t i = 0;
+
+    memcpy(&k32, k, 4);
+
+#if defined(__AVX2__)
+    const __m256i m256 = _mm256_set1_epi32((int)k32);
+    for (; len - i >= 32; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(v, m256));
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i m128 = _mm_set1_epi32((int)k32);
+    for (; len - i >= 16; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(v, m128));
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t m128 = vreinterpretq_u8_u32(vdupq_n_u32(k32));
+    for (; len - i >= 16; i += 16) {
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(src + i), m128));
+    }
+#endif
+
+    const uint64_t k64 = ((uint64_t)k32 << 32) | k32;
+    for (; len - i >= 8; i += 8) {
+        uint64_t w;
+        memcpy(&w, src + i, 8);
+        w ^= k64;
+        memcpy(dst + i, &w, 8);
+    }
+    for (; i < len; i++) {
+        dst[i] = src[i] ^ k[i & 3];
+    }
+}
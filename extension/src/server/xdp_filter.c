@@ -0,0 +1,618 @@
+/*
+ * xdp_filter.c  –  XDP pre-filter for the QUIC listeners
+ * -------------------------------------------------------
+ *
+ * See include/server/xdp_filter.h. Like the steering program of
+ * reuseport.c, the filter is hand-assembled eBPF loaded with the raw bpf()
+ * syscall, so neither libbpf nor a BPF toolchain is needed at build time.
+ * At a hundred instructions it is assembled with labels rather than
+ * counted jump offsets; the assembler resolves them before loading.
+ *
+ * The program keeps a few values on its stack:
+ *
+ *   -4    u32   map key (config, counters)
+ *   -8    u16   UDP destination port, key of the port map
+ *   -24   16 B  source address, IPv4 padded with zeros
+ *   -56   20 B  short-header DCID
+ *   -72   16 B  new rate window: start (ns), Initials seen
+ *
+ * and in callee-saved registers: r6 the UDP payload length, later the
+ * counter to bump; r7 the packet start, later the clock; r8 the packet
+ * end; r9 the UDP header, later the QUIC header.
+ */
+
+#include "php_quicpro.h"
+#include "server/xdp_filter.h"
+#include "config/security_and_traffic/base_layer.h"
+#include "config/bare_metal_tuning/base_layer.h"
+#include "config/router_and_loadbalancer/base_layer.h"
+
+#include <quiche.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static bool quicpro_xdp_filter_tried     = false;   /* Workers inherit it: one attempt, one notice */
+static int quicpro_xdp_filter_prog_fd    = -1;
+static int quicpro_xdp_filter_link_fd    = -1;
+static int quicpro_xdp_filter_ports_fd   = -1;   /* HASH: be16 port -> u8 */
+static int quicpro_xdp_filter_cids_fd    = -1;   /* HASH: DCID -> owner's pid */
+static int quicpro_xdp_filter_sources_fd = -1;   /* LRU_HASH: address -> rate window */
+static int quicpro_xdp_filter_conf_fd    = -1;   /* ARRAY: [0] = QP_XF_CONF_* */
+static int quicpro_xdp_filter_stats_fd   = -1;   /* PERCPU_ARRAY: QUICPRO_XDP_FILTER_* -> u64 */
+
+#define QP_XF_CONF_DCID_CHECK  0x1
+
+#ifdef __linux__
+
+#include <arpa/inet.h>
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/syscall.h>
+
+/*──────────────────────────── Instruction helpers ────────────────────────*/
+
+#define QP_INSN(c, d, s, o, i) \
+    ((struct bpf_insn){ .code = (c), .dst_reg = (d), .src_reg = (s), .off = (o), .imm = (i) })
+
+#define QP_MOV64_REG(d, s)       QP_INSN(BPF_ALU64 | BPF_MOV | BPF_X, d, s, 0, 0)
+#define QP_MOV64_IMM(d, i)       QP_INSN(BPF_ALU64 | BPF_MOV | BPF_K, d, 0, 0, i)
+#define QP_ALU64_IMM(op, d, i)   QP_INSN(BPF_ALU64 | (op) | BPF_K, d, 0, 0, i)
+#define QP_ALU64_REG(op, d, s)   QP_INSN(BPF_ALU64 | (op) | BPF_X, d, s, 0, 0)
+#define QP_BE16(d)               QP_INSN(BPF_ALU | BPF_END | BPF_TO_BE, d, 0, 0, 16)
+#define QP_LDX(sz, d, s, o)      QP_INSN(BPF_LDX | (sz) | BPF_MEM, d, s, o, 0)
+#define QP_STX(sz, d, s, o)      QP_INSN(BPF_STX | (sz) | BPF_MEM, d, s, o, 0)
+#define QP_ST(sz, d, o, i)       QP_INSN(BPF_ST | (sz) | BPF_MEM, d, 0, o, i)
+#define QP_JMP_REG(op, d, s)     QP_INSN(BPF_JMP | (op) | BPF_X, d, s, 0, 0)
+#define QP_JMP_IMM(op, d, i)     QP_INSN(BPF_JMP | (op) | BPF_K, d, 0, 0, i)
+#define QP_JA()                  QP_INSN(BPF_JMP | BPF_JA, 0, 0, 0, 0)
+#define QP_CALL(f)               QP_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, f)
+#define QP_EXIT()                QP_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+
+#define QP_IP4_HLEN              20
+#define QP_IP6_HLEN              40
+#define QP_UDP_HLEN              8
+#define QP_RATE_WINDOW_NS        1000000000
+
+/*──────────────────────────── Label assembler ────────────────────────────*/
+
+enum {
+    XF_PASS, XF_IPV4, XF_UDP, XF_LONG, XF_RATE_RESET, XF_RATE_NEW,
+    XF_MALFORMED, XF_SHORT_INITIAL, XF_RATE_LIMITED, XF_UNKNOWN_DCID,
+    XF_ACCEPT, XF_COUNT, XF_VERDICT,
+    XF_LABELS
+};
+
+#define XF_MAX_INSNS 256
+
+typedef struct {
+    struct bpf_insn insns[XF_MAX_INSNS];
+    int8_t          target[XF_MAX_INSNS];   /* Label a jump goes to, or -1 */
+    int             label_at[XF_LABELS];
+    int             n;
+} xf_asm_t;
+
+static void xf_emit(xf_asm_t *a, struct bpf_insn insn)
+{
+    if (a->n < XF_MAX_INSNS) {
+        a->target[a->n] = -1;
+        a->insns[a->n++] = insn;
+    }
+}
+
+static void xf_jmp(xf_asm_t *a, struct bpf_insn insn, int label)
+{
+    xf_emit(a, insn);
+    a->target[a->n - 1] = (int8_t)label;
+}
+
+static void xf_label(xf_asm_t *a, int label)
+{
+    a->label_at[label] = a->n;
+}
+
+/* LD_IMM64 of a map descriptor: two slots */
+static void xf_ld_map(xf_asm_t *a, int reg, int map_fd)
+{
+    xf_emit(a, QP_INSN(BPF_LD | BPF_DW | BPF_IMM, reg, BPF_PSEUDO_MAP_FD, 0, map_fd));
+    xf_emit(a, QP_INSN(0, 0, 0, 0, 0));
+}
+
+/* r1 = map, r2 = fp + key_off; r0 = bpf_map_lookup_elem() */
+static void xf_lookup(xf_asm_t *a, int map_fd, int key_off)
+{
+    xf_ld_map(a, BPF_REG_1, map_fd);
+    xf_emit(a, QP_MOV64_REG(BPF_REG_2, BPF_REG_10));
+    xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_2, key_off));
+    xf_emit(a, QP_CALL(BPF_FUNC_map_lookup_elem));
+}
+
+/* Jump offsets count instructions after the jump */
+static bool xf_resolve(xf_asm_t *a)
+{
+    if (a->n >= XF_MAX_INSNS) {
+        return false;
+    }
+    for (int i = 0; i < a->n; i++) {
+        if (a->target[i] >= 0) {
+            a->insns[i].off = (int16_t)(a->label_at[a->target[i]] - (i + 1));
+        }
+    }
+    return true;
+}
+
+/*──────────────────────────── Program ────────────────────────────────────*/
+
+static long quicpro_bpf(int cmd, union bpf_attr *attr)
+{
+    return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+static void xf_assemble(xf_asm_t *a, int32_t initials_per_sec)
+{
+    memset(a->label_at, 0, sizeof(a->label_at));
+    a->n = 0;
+
+    /* Ethernet */
+    xf_emit(a, QP_LDX(BPF_W, BPF_REG_7, BPF_REG_1, offsetof(struct xdp_md, data)));
+    xf_emit(a, QP_LDX(BPF_W, BPF_REG_8, BPF_REG_1, offsetof(struct xdp_md, data_end)));
+    xf_emit(a, QP_MOV64_REG(BPF_REG_2, BPF_REG_7));
+    xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_2, ETH_HLEN));
+    xf_jmp(a, QP_JMP_REG(BPF_JGT, BPF_REG_2, BPF_REG_8), XF_PASS);
+    xf_emit(a, QP_LDX(BPF_H, BPF_REG_3, BPF_REG_7, offsetof(struct ethhdr, h_proto)));
+    xf_jmp(a, QP_JMP_IMM(BPF_JEQ, BPF_REG_3, htons(ETH_P_IP)), XF_IPV4);
+    xf_jmp(a, QP_JMP_IMM(BPF_JNE, BPF_REG_3, htons(ETH_P_IPV6)), XF_PASS);
+
+    /* IPv6 without extension headers */
+    xf_emit(a, QP_MOV64_REG(BPF_REG_2, BPF_REG_7));
+    xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_2, ETH_HLEN + QP_IP6_HLEN));
+    xf_jmp(a, QP_JMP_REG(BPF_JGT, BPF_REG_2, BPF_REG_8), XF_PASS);
+    xf_emit(a, QP_LDX(BPF_B, BPF_REG_3, BPF_REG_7, ETH_HLEN + 6));                /* Next header */
+    xf_jmp(a, QP_JMP_IMM(BPF_JNE, BPF_REG_3, IPPROTO_UDP), XF_PASS);
+    xf_emit(a, QP_LDX(BPF_DW, BPF_REG_3, BPF_REG_7, ETH_HLEN + 8));               /* Source */
+    xf_emit(a, QP_STX(BPF_DW, BPF_REG_10, BPF_REG_3, -24));
+    xf_emit(a, QP_LDX(BPF_DW, BPF_REG_3, BPF_REG_7, ETH_HLEN + 16));
+    xf_emit(a, QP_STX(BPF_DW, BPF_REG_10, BPF_REG_3, -16));
+    xf_emit(a, QP_MOV64_REG(BPF_REG_9, BPF_REG_7));
+    xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_9, ETH_HLEN + QP_IP6_HLEN));
+    xf_jmp(a, QP_JA(), XF_UDP);
+
+    /* IPv4, unfragmented */
+    xf_label(a, XF_IPV4);
+    xf_emit(a, QP_MOV64_REG(BPF_REG_2, BPF_REG_7));
+    xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_2, ETH_HLEN + QP_IP4_HLEN));
+    xf_jmp(a, QP_JMP_REG(BPF_JGT, BPF_REG_2, BPF_REG_8), XF_PASS);
+    xf_emit(a, QP_LDX(BPF_B, BPF_REG_3, BPF_REG_7, ETH_HLEN + 9));                /* Protocol */
+    xf_jmp(a, QP_JMP_IMM(BPF_JNE, BPF_REG_3, IPPROTO_UDP), XF_PASS);
+    xf_emit(a, QP_LDX(BPF_H, BPF_REG_3, BPF_REG_7, ETH_HLEN + 6));                /* MF, fragment offset */
+    xf_emit(a, QP_ALU64_IMM(BPF_AND, BPF_REG_3, htons(0x3fff)));
+    xf_jmp(a, QP_JMP_IMM(BPF_JNE, BPF_REG_3, 0), XF_PASS);
+    xf_emit(a, QP_ST(BPF_DW, BPF_REG_10, -24, 0));
+    xf_emit(a, QP_ST(BPF_DW, BPF_REG_10, -16, 0));
+    xf_emit(a, QP_LDX(BPF_W, BPF_REG_3, BPF_REG_7, ETH_HLEN + 12));               /* Source */
+    xf_emit(a, QP_STX(BPF_W, BPF_REG_10, BPF_REG_3, -24));
+    xf_emit(a, QP_LDX(BPF_B, BPF_REG_3, BPF_REG_7, ETH_HLEN));                    /* IHL */
+    xf_emit(a, QP_ALU64_IMM(BPF_AND, BPF_REG_3, 0x0f));
+    xf_emit(a, QP_ALU64_IMM(BPF_LSH, BPF_REG_3, 2));
+    xf_jmp(a, QP_JMP_IMM(BPF_JLT, BPF_REG_3, QP_IP4_HLEN), XF_PASS);
+    xf_emit(a, QP_MOV64_REG(BPF_REG_9, BPF_REG_7));
+    xf_emit(a, QP_ALU64_REG(BPF_ADD, BPF_REG_9, BPF_REG_3));
+    xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_9, ETH_HLEN));
+
+    /* UDP to a listen port */
+    xf_label(a, XF_UDP);
+    xf_emit(a, QP_MOV64_REG(BPF_REG_2, BPF_REG_9));
+    xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_2, QP_UDP_HLEN));
+    xf_jmp(a, QP_JMP_REG(BPF_JGT, BPF_REG_2, BPF_REG_8), XF_PASS);
+    xf_emit(a, QP_LDX(BPF_H, BPF_REG_3, BPF_REG_9, 2));                          /* Destination port */
+    xf_emit(a, QP_STX(BPF_H, BPF_REG_10, BPF_REG_3, -8));
+    xf_emit(a, QP_LDX(BPF_H, BPF_REG_6, BPF_REG_9, 4));                          /* Length */
+    xf_emit(a, QP_BE16(BPF_REG_6));
+    xf_emit(a, QP_ALU64_IMM(BPF_SUB, BPF_REG_6, QP_UDP_HLEN));
+    xf_lookup(a, quicpro_xdp_filter_ports_fd, -8);
+    xf_jmp(a, QP_JMP_IMM(BPF_JEQ, BPF_REG_0, 0), XF_PASS);
+
+    /* QUIC */
+    xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_9, QP_UDP_HLEN));
+    xf_emit(a, QP_MOV64_REG(BPF_REG_2, BPF_REG_9));
+    xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_2, 1));
+    xf_jmp(a, QP_JMP_REG(BPF_JGT, BPF_REG_2, BPF_REG_8), XF_MALFORMED);
+    xf_emit(a, QP_LDX(BPF_B, BPF_REG_3, BPF_REG_9, 0));
+    xf_jmp(a, QP_JMP_IMM(BPF_JSET, BPF_REG_3, 0x80), XF_LONG);
+
+    /* Short header: ours only if the fixed bit is set and the DCID is known */
+    xf_emit(a, QP_ALU64_IMM(BPF_AND, BPF_REG_3, 0x40));
+    xf_jmp(a, QP_JMP_IMM(BPF_JEQ, BPF_REG_3, 0), XF_ACCEPT);
+    xf_emit(a, QP_ST(BPF_W, BPF_REG_10, -4, 0));
+    xf_lookup(a, quicpro_xdp_filter_conf_fd, -4);
+    xf_jmp(a, QP_JMP_IMM(BPF_JEQ, BPF_REG_0, 0), XF_ACCEPT);
+    xf_emit(a, QP_LDX(BPF_W, BPF_REG_3, BPF_REG_0, 0));
+    xf_emit(a, QP_ALU64_IMM(BPF_AND, BPF_REG_3, QP_XF_CONF_DCID_CHECK));
+    xf_jmp(a, QP_JMP_IMM(BPF_JEQ, BPF_REG_3, 0), XF_ACCEPT);
+    xf_emit(a, QP_MOV64_REG(BPF_REG_2, BPF_REG_9));
+    xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_2, 1 + QUICHE_MAX_CONN_ID_LEN));
+    xf_jmp(a, QP_JMP_REG(BPF_JGT, BPF_REG_2, BPF_REG_8), XF_UNKNOWN_DCID);
+    xf_emit(a, QP_LDX(BPF_DW, BPF_REG_3, BPF_REG_9, 1));
+    xf_emit(a, QP_STX(BPF_DW, BPF_REG_10, BPF_REG_3, -56));
+    xf_emit(a, QP_LDX(BPF_DW, BPF_REG_3, BPF_REG_9, 9));
+    xf_emit(a, QP_STX(BPF_DW, BPF_REG_10, BPF_REG_3, -48));
+    xf_emit(a, QP_LDX(BPF_W, BPF_REG_3, BPF_REG_9, 17));
+    xf_emit(a, QP_STX(BPF_W, BPF_REG_10, BPF_REG_3, -40));
+    xf_lookup(a, quicpro_xdp_filter_cids_fd, -56);
+    xf_jmp(a, QP_JMP_IMM(BPF_JEQ, BPF_REG_0, 0), XF_UNKNOWN_DCID);
+    xf_jmp(a, QP_JA(), XF_ACCEPT);
+
+    /* Long header: flags, version(4), DCID length, DCID, SCID length, SCID */
+    xf_label(a, XF_LONG);
+    xf_emit(a, QP_MOV64_REG(BPF_REG_2, BPF_REG_9));
+    xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_2, 7));
+    xf_jmp(a, QP_JMP_REG(BPF_JGT, BPF_REG_2, BPF_REG_8), XF_MALFORMED);
+    xf_emit(a, QP_LDX(BPF_W, BPF_REG_4, BPF_REG_9, 1));
+    xf_jmp(a, QP_JMP_IMM(BPF_JEQ, BPF_REG_4, 0), XF_MALFORMED);
+    xf_emit(a, QP_LDX(BPF_B, BPF_REG_5, BPF_REG_9, 5));
+    xf_jmp(a, QP_JMP_IMM(BPF_JGT, BPF_REG_5, QUICHE_MAX_CONN_ID_LEN), XF_MALFORMED);
+    xf_emit(a, QP_MOV64_REG(BPF_REG_2, BPF_REG_9));
+    xf_emit(a, QP_ALU64_REG(BPF_ADD, BPF_REG_2, BPF_REG_5));
+    xf_emit(a, QP_MOV64_REG(BPF_REG_1, BPF_REG_2));
+    xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_1, 7));
+    xf_jmp(a, QP_JMP_REG(BPF_JGT, BPF_REG_1, BPF_REG_8), XF_MALFORMED);
+    xf_emit(a, QP_LDX(BPF_B, BPF_REG_5, BPF_REG_2, 6));
+    xf_jmp(a, QP_JMP_IMM(BPF_JGT, BPF_REG_5, QUICHE_MAX_CONN_ID_LEN), XF_MALFORMED);
+    xf_jmp(a, QP_JMP_IMM(BPF_JNE, BPF_REG_4, (int32_t)htonl(QUICHE_PROTOCOL_VERSION)), XF_ACCEPT);
+    xf_emit(a, QP_ALU64_IMM(BPF_AND, BPF_REG_3, 0x30));                           /* Packet type */
+    xf_jmp(a, QP_JMP_IMM(BPF_JNE, BPF_REG_3, 0), XF_ACCEPT);
+
+    /* A v1 Initial */
+    xf_jmp(a, QP_JMP_IMM(BPF_JSLT, BPF_REG_6, QUICPRO_XDP_FILTER_MIN_INITIAL), XF_SHORT_INITIAL);
+    if (initials_per_sec > 0) {
+        xf_emit(a, QP_CALL(BPF_FUNC_ktime_get_ns));
+        xf_emit(a, QP_MOV64_REG(BPF_REG_7, BPF_REG_0));
+        xf_lookup(a, quicpro_xdp_filter_sources_fd, -24);
+        xf_jmp(a, QP_JMP_IMM(BPF_JEQ, BPF_REG_0, 0), XF_RATE_NEW);
+        xf_emit(a, QP_LDX(BPF_DW, BPF_REG_2, BPF_REG_0, 0));
+        xf_emit(a, QP_MOV64_REG(BPF_REG_3, BPF_REG_7));
+        xf_emit(a, QP_ALU64_REG(BPF_SUB, BPF_REG_3, BPF_REG_2));
+        xf_jmp(a, QP_JMP_IMM(BPF_JGT, BPF_REG_3, QP_RATE_WINDOW_NS), XF_RATE_RESET);
+        xf_emit(a, QP_LDX(BPF_DW, BPF_REG_2, BPF_REG_0, 8));
+        xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_2, 1));
+        xf_emit(a, QP_STX(BPF_DW, BPF_REG_0, BPF_REG_2, 8));
+        xf_jmp(a, QP_JMP_IMM(BPF_JGT, BPF_REG_2, initials_per_sec), XF_RATE_LIMITED);
+        xf_jmp(a, QP_JA(), XF_ACCEPT);
+
+        xf_label(a, XF_RATE_RESET);
+        xf_emit(a, QP_STX(BPF_DW, BPF_REG_0, BPF_REG_7, 0));
+        xf_emit(a, QP_ST(BPF_DW, BPF_REG_0, 8, 1));
+        xf_jmp(a, QP_JA(), XF_ACCEPT);
+
+        xf_label(a, XF_RATE_NEW);
+        xf_emit(a, QP_STX(BPF_DW, BPF_REG_10, BPF_REG_7, -72));
+        xf_emit(a, QP_ST(BPF_DW, BPF_REG_10, -64, 1));
+        xf_ld_map(a, BPF_REG_1, quicpro_xdp_filter_sources_fd);
+        xf_emit(a, QP_MOV64_REG(BPF_REG_2, BPF_REG_10));
+        xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_2, -24));
+        xf_emit(a, QP_MOV64_REG(BPF_REG_3, BPF_REG_10));
+        xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_3, -72));
+        xf_emit(a, QP_MOV64_IMM(BPF_REG_4, BPF_ANY));
+        xf_emit(a, QP_CALL(BPF_FUNC_map_update_elem));
+    }
+    xf_jmp(a, QP_JA(), XF_ACCEPT);
+
+    /* Verdicts: count, then drop anything but QUICPRO_XDP_FILTER_PASSED */
+    xf_label(a, XF_MALFORMED);
+    xf_emit(a, QP_MOV64_IMM(BPF_REG_6, QUICPRO_XDP_FILTER_MALFORMED));
+    xf_jmp(a, QP_JA(), XF_COUNT);
+    xf_label(a, XF_SHORT_INITIAL);
+    xf_emit(a, QP_MOV64_IMM(BPF_REG_6, QUICPRO_XDP_FILTER_SHORT_INITIAL));
+    xf_jmp(a, QP_JA(), XF_COUNT);
+    xf_label(a, XF_RATE_LIMITED);
+    xf_emit(a, QP_MOV64_IMM(BPF_REG_6, QUICPRO_XDP_FILTER_RATE_LIMITED));
+    xf_jmp(a, QP_JA(), XF_COUNT);
+    xf_label(a, XF_UNKNOWN_DCID);
+    xf_emit(a, QP_MOV64_IMM(BPF_REG_6, QUICPRO_XDP_FILTER_UNKNOWN_DCID));
+    xf_jmp(a, QP_JA(), XF_COUNT);
+    xf_label(a, XF_ACCEPT);
+    xf_emit(a, QP_MOV64_IMM(BPF_REG_6, QUICPRO_XDP_FILTER_PASSED));
+
+    xf_label(a, XF_COUNT);
+    xf_emit(a, QP_STX(BPF_W, BPF_REG_10, BPF_REG_6, -4));
+    xf_lookup(a, quicpro_xdp_filter_stats_fd, -4);
+    xf_jmp(a, QP_JMP_IMM(BPF_JEQ, BPF_REG_0, 0), XF_VERDICT);
+    xf_emit(a, QP_LDX(BPF_DW, BPF_REG_1, BPF_REG_0, 0));
+    xf_emit(a, QP_ALU64_IMM(BPF_ADD, BPF_REG_1, 1));                              /* Per CPU: no atomics */
+    xf_emit(a, QP_STX(BPF_DW, BPF_REG_0, BPF_REG_1, 0));
+    xf_label(a, XF_VERDICT);
+    xf_jmp(a, QP_JMP_IMM(BPF_JEQ, BPF_REG_6, QUICPRO_XDP_FILTER_PASSED), XF_PASS);
+    xf_emit(a, QP_MOV64_IMM(BPF_REG_0, XDP_DROP));
+    xf_emit(a, QP_EXIT());
+
+    /* Not for a listener, or not ours to judge */
+    xf_label(a, XF_PASS);
+    xf_emit(a, QP_MOV64_IMM(BPF_REG_0, XDP_PASS));
+    xf_emit(a, QP_EXIT());
+}
+
+static int xf_load_prog(int32_t initials_per_sec)
+{
+    static xf_asm_t a;   /* A few KiB; kept off the stack */
+    static const char license[] = "Dual MIT/GPL";
+
+    xf_assemble(&a, initials_per_sec);
+    if (!xf_resolve(&a)) {
+        errno = E2BIG;
+        return -1;
+    }
+
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type            = BPF_PROG_TYPE_XDP;
+    attr.expected_attach_type = BPF_XDP;
+    attr.insns                = (uint64_t)(uintptr_t)a.insns;
+    attr.insn_cnt             = (uint32_t)a.n;
+    attr.license              = (uint64_t)(uintptr_t)license;
+
+    return (int)quicpro_bpf(BPF_PROG_LOAD, &attr);
+}
+
+static int xf_map_create(uint32_t type, uint32_t key_size, uint32_t value_size, uint32_t max_entries, uint32_t flags)
+{
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type    = type;
+    attr.key_size    = key_size;
+    attr.value_size  = value_size;
+    attr.max_entries = max_entries;
+    attr.map_flags   = flags;
+    return (int)quicpro_bpf(BPF_MAP_CREATE, &attr);
+}
+
+static int xf_map_update(int map_fd, const void *key, const void *value)
+{
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = (uint32_t)map_fd;
+    attr.key    = (uint64_t)(uintptr_t)key;
+    attr.value  = (uint64_t)(uintptr_t)value;
+    attr.flags  = BPF_ANY;
+    return (int)quicpro_bpf(BPF_MAP_UPDATE_ELEM, &attr);
+}
+
+static void xf_close(int *fd)
+{
+    if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+static void xf_set_conf(uint32_t flags)
+{
+    uint32_t key = 0;
+    (void)xf_map_update(quicpro_xdp_filter_conf_fd, &key, &flags);
+}
+
+void quicpro_xdp_filter_prepare(void)
+{
+    const char *ifname = quicpro_security_config.xdp_filter_interface;
+    if (quicpro_xdp_filter_tried || !ifname || !*ifname) {
+        return;
+    }
+    quicpro_xdp_filter_tried = true;
+    const char *xsk_ifname = quicpro_bare_metal_config.io_xdp_interface;
+    if (xsk_ifname && strcmp(xsk_ifname, ifname) == 0) {
+        /* One XDP program per interface; the AF_XDP socket's redirect program owns it */
+        php_error_docref(NULL, E_NOTICE, "XDP pre-filter not attached: %s serves an AF_XDP socket", ifname);
+        return;
+    }
+    unsigned ifindex = if_nametoindex(ifname);
+    if (ifindex == 0) {
+        php_error_docref(NULL, E_NOTICE, "XDP pre-filter not attached: no interface %s", ifname);
+        return;
+    }
+
+    zend_long capacity = quicpro_security_config.xdp_filter_cid_capacity;
+    zend_long per_sec  = quicpro_security_config.xdp_filter_initials_per_sec;
+    const char *what = "map";
+
+    quicpro_xdp_filter_ports_fd   = xf_map_create(BPF_MAP_TYPE_HASH, sizeof(uint16_t), sizeof(uint8_t),
+                                                  QUICPRO_XDP_FILTER_PORTS, 0);
+    quicpro_xdp_filter_cids_fd    = xf_map_create(BPF_MAP_TYPE_HASH, QUICHE_MAX_CONN_ID_LEN, sizeof(uint32_t),
+                                                  (uint32_t)MIN(MAX(capacity, 1), (zend_long)UINT32_MAX),
+                                                  BPF_F_NO_PREALLOC);   /* Memory as connections come */
+    quicpro_xdp_filter_sources_fd = xf_map_create(BPF_MAP_TYPE_LRU_HASH, 16, 2 * sizeof(uint64_t),
+                                                  QUICPRO_XDP_FILTER_SOURCES, 0);
+    quicpro_xdp_filter_conf_fd    = xf_map_create(BPF_MAP_TYPE_ARRAY, sizeof(uint32_t), sizeof(uint32_t), 1, 0);
+    quicpro_xdp_filter_stats_fd   = xf_map_create(BPF_MAP_TYPE_PERCPU_ARRAY, sizeof(uint32_t), sizeof(uint64_t),
+                                                  QUICPRO_XDP_FILTER_COUNTERS, 0);
+    if (quicpro_xdp_filter_ports_fd < 0 || quicpro_xdp_filter_cids_fd < 0 || quicpro_xdp_filter_sources_fd < 0
+        || quicpro_xdp_filter_conf_fd < 0 || quicpro_xdp_filter_stats_fd < 0) {
+        goto fail;
+    }
+    /* Router listeners issue no CIDs, so every short header would be unknown */
+    xf_set_conf(quicpro_router_loadbalancer_config.router_mode_enable ? 0 : QP_XF_CONF_DCID_CHECK);
+
+    what = "program";
+    quicpro_xdp_filter_prog_fd = xf_load_prog((int32_t)MIN(per_sec, (zend_long)INT32_MAX));
+    if (quicpro_xdp_filter_prog_fd < 0) {
+        goto fail;
+    }
+
+    what = "link";
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.link_create.prog_fd        = (uint32_t)quicpro_xdp_filter_prog_fd;
+    attr.link_create.target_ifindex = ifindex;
+    attr.link_create.attach_type    = BPF_XDP;   /* Driver mode where supported, generic otherwise */
+    quicpro_xdp_filter_link_fd = (int)quicpro_bpf(BPF_LINK_CREATE, &attr);
+    if (quicpro_xdp_filter_link_fd < 0) {
+        goto fail;
+    }
+    return;
+
+fail:
+    php_error_docref(NULL, E_NOTICE, "XDP pre-filter not attached to %s (%s: %s)", ifname, what, strerror(errno));
+    quicpro_xdp_filter_release();
+}
+
+void quicpro_xdp_filter_release(void)
+{
+    xf_close(&quicpro_xdp_filter_link_fd);   /* Detaches the program */
+    xf_close(&quicpro_xdp_filter_prog_fd);
+    xf_close(&quicpro_xdp_filter_ports_fd);
+    xf_close(&quicpro_xdp_filter_cids_fd);
+    xf_close(&quicpro_xdp_filter_sources_fd);
+    xf_close(&quicpro_xdp_filter_conf_fd);
+    xf_close(&quicpro_xdp_filter_stats_fd);
+}
+
+void quicpro_xdp_filter_listen(const struct sockaddr *local)
+{
+    quicpro_xdp_filter_prepare();
+    if (quicpro_xdp_filter_link_fd < 0 || !local) {
+        return;
+    }
+    uint16_t port;
+    if (local->sa_family == AF_INET6) {
+        port = ((const struct sockaddr_in6 *)local)->sin6_port;
+    } else if (local->sa_family == AF_INET) {
+        port = ((const struct sockaddr_in *)local)->sin_port;
+    } else {
+        return;
+    }
+    uint8_t on = 1;
+    if (xf_map_update(quicpro_xdp_filter_ports_fd, &port, &on) < 0) {
+        php_error_docref(NULL, E_NOTICE, "XDP pre-filter does not cover port %u: %s", ntohs(port), strerror(errno));
+    }
+}
+
+void quicpro_xdp_filter_cid_add(const uint8_t *cid, size_t len)
+{
+    if (quicpro_xdp_filter_cids_fd < 0 || len != QUICHE_MAX_CONN_ID_LEN) {
+        return;
+    }
+    uint32_t owner = (uint32_t)getpid();
+    if (xf_map_update(quicpro_xdp_filter_cids_fd, cid, &owner) < 0 && errno == E2BIG) {
+        /* Full: better to let unknown DCIDs through than this connection's packets fall */
+        php_error_docref(NULL, E_NOTICE, "XDP pre-filter connection ID map is full; no longer checking DCIDs");
+        xf_set_conf(0);
+    }
+}
+
+void quicpro_xdp_filter_cid_del(const uint8_t *cid, size_t len)
+{
+    if (quicpro_xdp_filter_cids_fd < 0 || len != QUICHE_MAX_CONN_ID_LEN) {
+        return;
+    }
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = (uint32_t)quicpro_xdp_filter_cids_fd;
+    attr.key    = (uint64_t)(uintptr_t)cid;
+    (void)quicpro_bpf(BPF_MAP_DELETE_ELEM, &attr);
+}
+
+/* Per-CPU values come back one per possible CPU, which may exceed the online ones */
+static int xf_possible_cpus(void)
+{
+    int n = 0;
+    FILE *f = fopen("/sys/devices/system/cpu/possible", "r");
+    if (f) {
+        char line[128];
+        if (fgets(line, sizeof(line), f)) {
+            const char *p = line;
+            while (*p) {
+                char *end;
+                long v = strtol(p, &end, 10);
+                if (end == p) {
+                    p++;
+                    continue;
+                }
+                n = MAX(n, (int)v + 1);
+                p = end;
+            }
+        }
+        fclose(f);
+    }
+    return n > 0 ? n : (int)sysconf(_SC_NPROCESSORS_CONF);
+}
+
+static bool xf_read_stats(uint64_t totals[QUICPRO_XDP_FILTER_COUNTERS], bool *dcid_check)
+{
+    int cpus = xf_possible_cpus();
+    if (quicpro_xdp_filter_stats_fd < 0 || cpus <= 0) {
+        return false;
+    }
+    uint64_t *values = ecalloc((size_t)cpus, sizeof(uint64_t));
+    union bpf_attr attr;
+    for (uint32_t key = 0; key < QUICPRO_XDP_FILTER_COUNTERS; key++) {
+        totals[key] = 0;
+        memset(&attr, 0, sizeof(attr));
+        attr.map_fd = (uint32_t)quicpro_xdp_filter_stats_fd;
+        attr.key    = (uint64_t)(uintptr_t)&key;
+        attr.value  = (uint64_t)(uintptr_t)values;
+        if (quicpro_bpf(BPF_MAP_LOOKUP_ELEM, &attr) == 0) {
+            for (int i = 0; i < cpus; i++) {
+                totals[key] += values[i];
+            }
+        }
+    }
+    efree(values);
+
+    uint32_t key = 0, flags = 0;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = (uint32_t)quicpro_xdp_filter_conf_fd;
+    attr.key    = (uint64_t)(uintptr_t)&key;
+    attr.value  = (uint64_t)(uintptr_t)&flags;
+    (void)quicpro_bpf(BPF_MAP_LOOKUP_ELEM, &attr);
+    *dcid_check = (flags & QP_XF_CONF_DCID_CHECK) != 0;
+    return true;
+}
+
+#else /* !__linux__ */
+
+void quicpro_xdp_filter_prepare(void) {}
+void quicpro_xdp_filter_release(void) {}
+void quicpro_xdp_filter_listen(const struct sockaddr *local) { (void)local; }
+void quicpro_xdp_filter_cid_add(const uint8_t *cid, size_t len) { (void)cid; (void)len; }
+void quicpro_xdp_filter_cid_del(const uint8_t *cid, size_t len) { (void)cid; (void)len; }
+
+static bool xf_read_stats(uint64_t totals[QUICPRO_XDP_FILTER_COUNTERS], bool *dcid_check)
+{
+    (void)totals; (void)dcid_check;
+    return false;
+}
+
+#endif
+
+void quicpro_xdp_filter_cid_del_all(const quicpro_cid_table_t *t)
+{
+    if (quicpro_xdp_filter_cids_fd < 0 || !t) {
+        return;
+    }
+    size_t pos = 0, len;
+    const uint8_t *cid;
+    while (quicpro_cid_table_next(t, &pos, &cid, &len)) {
+        quicpro_xdp_filter_cid_del(cid, len);
+    }
+}
+
+PHP_FUNCTION(quicpro_xdp_filter_stats)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    uint64_t totals[QUICPRO_XDP_FILTER_COUNTERS];
+    bool dcid_check;
+    if (!xf_read_stats(totals, &dcid_check)) {
+        RETURN_NULL();
+    }
+    array_init(return_value);
+    add_assoc_long(return_value, "passed", (zend_long)totals[QUICPRO_XDP_FILTER_PASSED]);
+    add_assoc_long(return_value, "malformed", (zend_long)totals[QUICPRO_XDP_FILTER_MALFORMED]);
+    add_assoc_long(return_value, "short_initial", (zend_long)totals[QUICPRO_XDP_FILTER_SHORT_INITIAL]);
+    add_assoc_long(return_value, "rate_limited", (zend_long)totals[QUICPRO_XDP_FILTER_RATE_LIMITED]);
+    add_assoc_long(return_value, "unknown_dcid", (zend_long)totals[QUICPRO_XDP_FILTER_UNKNOWN_DCID]);
+    add_assoc_bool(return_value, "dcid_check", dcid_check);
+}
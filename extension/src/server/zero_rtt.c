@@ -0,0 +1,315 @@
+/*
+ * zero_rtt.c  –  0-RTT acceptance and cluster-wide anti-replay for php-quicpro
+ * ---------------------------------------------------------------------------
+ *
+ * The store is one MAP_SHARED anonymous mapping:
+ *
+ *   header      spinlock, strategy, hash seeds, window, per-bucket epochs
+ *   single_use  nslots x { tag, expiry_ms }, probed linearly (16 slots)
+ *   bloom       2 x nslots bits, QP_BLOOM_K probes by double hashing
+ *
+ * Every lookup-and-insert holds the spinlock: QP_SINGLE_USE_PROBES slots,
+ * or QP_BLOOM_K bits in each of two buckets. It is taken with a bounded
+ * spin, and a check that cannot get it fails closed, so that connection's
+ * early data waits for the handshake. A worker that died holding it costs
+ * early dispatch, never a hang.
+ *
+ * A bloom bucket that starts a new window is claimed under the lock and
+ * cleared outside it; checks in that window fail closed until the clear
+ * is done.
+ */
+
+#include "php_quicpro.h"
+#include "server/zero_rtt.h"
+#include "server/cid.h"
+#include "config/tls_and_crypto/base_layer.h"
+
+#include <stdatomic.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#define QP_SINGLE_USE_PROBES  16
+#define QP_BLOOM_K            8
+#define QP_BLOOM_BITS_PER_KEY 16
+#define QP_BLOOM_CLEAR_WORDS  512    /* 4 KiB per step of a bucket clear */
+#define QP_ZRTT_LOCK_SPINS    1024
+
+enum { QP_ZRTT_SINGLE_USE = 0, QP_ZRTT_BLOOM = 1 };
+
+typedef struct {
+    atomic_flag lock;
+    uint32_t    strategy;
+    uint64_t    seed[2];
+    uint64_t    window_ms;
+    uint64_t    nslots;           /* Power of two: slots, or bits per bloom bucket. */
+    _Atomic uint64_t bucket_epoch[2];   /* Window each bloom bucket is claimed for */
+    uint64_t    bucket_ready[2];        /* Equals bucket_epoch once the bucket is cleared */
+    uint64_t    data[];
+} quicpro_zero_rtt_store_t;
+
+static quicpro_zero_rtt_store_t *quicpro_zero_rtt_store = NULL;
+static size_t quicpro_zero_rtt_store_size = 0;
+
+static inline uint64_t quicpro_zero_rtt_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static inline uint64_t quicpro_zero_rtt_mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t quicpro_zero_rtt_hash(uint64_t seed, const uint8_t *p, size_t len)
+{
+    uint64_t h = seed ^ ((uint64_t)len * 0x9e3779b97f4a7c15ULL);
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = quicpro_zero_rtt_mix(h ^ w);
+        p += 8;
+        len -= 8;
+    }
+    uint64_t w = 0;
+    memcpy(&w, p, len);
+    return quicpro_zero_rtt_mix(h ^ w);
+}
+
+static uint64_t quicpro_zero_rtt_pow2(uint64_t v)
+{
+    uint64_t n = 64;
+    while (n < v) {
+        n <<= 1;
+    }
+    return n;
+}
+
+/*──────────────────────────── Store lifecycle ────────────────────────────*/
+
+void quicpro_zero_rtt_prepare(void)
+{
+    if (quicpro_zero_rtt_store || !quicpro_tls_crypto_config.tls_enable_early_data) {
+        return;
+    }
+
+    bool bloom = strcasecmp(quicpro_tls_crypto_config.tls_server_0rtt_anti_replay, "bloom") == 0;
+    uint64_t keys = (uint64_t)quicpro_tls_crypto_config.tls_server_0rtt_cache_size;
+    uint64_t nslots = bloom ? quicpro_zero_rtt_pow2(keys * QP_BLOOM_BITS_PER_KEY)
+                            : quicpro_zero_rtt_pow2(keys * 2);
+    size_t data_bytes = bloom ? 2 * (nslots / 8) : nslots * 2 * sizeof(uint64_t);
+    size_t size = sizeof(quicpro_zero_rtt_store_t) + data_bytes;
+
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        php_error_docref(NULL, E_WARNING, "0-RTT anti-replay store unavailable (%zu bytes); early data will wait for the handshake", size);
+        return;
+    }
+
+    quicpro_zero_rtt_store_t *st = mem;
+    atomic_flag_clear(&st->lock);
+    st->strategy = bloom ? QP_ZRTT_BLOOM : QP_ZRTT_SINGLE_USE;
+    st->window_ms = (uint64_t)quicpro_tls_crypto_config.tls_server_0rtt_replay_window_sec * 1000;
+    st->nslots = nslots;
+    if (quicpro_cid_random_bytes((uint8_t *)st->seed, sizeof(st->seed)) < 0) {
+        munmap(mem, size);
+        return;
+    }
+
+    quicpro_zero_rtt_store = st;
+    quicpro_zero_rtt_store_size = size;
+}
+
+void quicpro_zero_rtt_release(void)
+{
+    if (quicpro_zero_rtt_store) {
+        munmap(quicpro_zero_rtt_store, quicpro_zero_rtt_store_size);
+        quicpro_zero_rtt_store = NULL;
+        quicpro_zero_rtt_store_size = 0;
+    }
+}
+
+void quicpro_zero_rtt_configure(quiche_config *cfg)
+{
+    if (quicpro_tls_crypto_config.tls_enable_early_data) {
+        quiche_config_enable_early_data(cfg);
+    }
+}
+
+/*──────────────────────────── Replay checks ──────────────────────────────*/
+
+static bool quicpro_zero_rtt_lock(quicpro_zero_rtt_store_t *st)
+{
+    for (int i = 0; i < QP_ZRTT_LOCK_SPINS; i++) {
+        if (!atomic_flag_test_and_set_explicit(&st->lock, memory_order_acquire)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline void quicpro_zero_rtt_unlock(quicpro_zero_rtt_store_t *st)
+{
+    atomic_flag_clear_explicit(&st->lock, memory_order_release);
+}
+
+static bool quicpro_zero_rtt_single_use(quicpro_zero_rtt_store_t *st, uint64_t h, uint64_t now)
+{
+    uint64_t mask = st->nslots - 1;
+    uint64_t tag = h | 1;   /* 0 marks a never-used slot */
+    uint64_t *free_slot = NULL;
+
+    for (uint64_t i = 0; i < QP_SINGLE_USE_PROBES; i++) {
+        uint64_t *slot = &st->data[2 * ((h + i) & mask)];
+        bool live = slot[0] != 0 && slot[1] > now;
+        if (live && slot[0] == tag) {
+            return false;
+        }
+        if (!live && !free_slot) {
+            free_slot = slot;
+        }
+    }
+    if (!free_slot) {
+        return false;   /* Fail closed: this request waits for the handshake */
+    }
+    free_slot[0] = tag;
+    free_slot[1] = now + st->window_ms;
+    return true;
+}
+
+/* Under the lock. Sets `*claimed` when the current bucket must be cleared first. */
+static bool quicpro_zero_rtt_bloom(quicpro_zero_rtt_store_t *st, uint64_t h1, uint64_t h2, uint64_t now,
+                                   bool *claimed)
+{
+    uint64_t epoch = now / st->window_ms;
+    unsigned cur = (unsigned)(epoch & 1);
+    uint64_t words = st->nslots / 64;
+    uint64_t *bucket[2] = { st->data, st->data + words };
+
+    if (st->bucket_epoch[cur] != epoch) {
+        st->bucket_epoch[cur] = epoch;
+        *claimed = true;
+        return false;
+    }
+    if (st->bucket_ready[cur] != epoch) {
+        return false;   /* Another worker is still clearing it */
+    }
+    bool prev_valid = st->bucket_epoch[cur ^ 1] + 1 == epoch && st->bucket_ready[cur ^ 1] + 1 == epoch;
+
+    uint64_t bits[QP_BLOOM_K];
+    bool in_cur = true, in_prev = prev_valid;
+    h2 |= 1;
+    for (int i = 0; i < QP_BLOOM_K; i++) {
+        bits[i] = (h1 + (uint64_t)i * h2) & (st->nslots - 1);
+        uint64_t m = 1ULL << (bits[i] & 63);
+        in_cur  = in_cur  && (bucket[cur][bits[i] >> 6] & m);
+        in_prev = in_prev && (bucket[cur ^ 1][bits[i] >> 6] & m);
+    }
+    if (in_cur || in_prev) {
+        return false;
+    }
+    for (int i = 0; i < QP_BLOOM_K; i++) {
+        bucket[cur][bits[i] >> 6] |= 1ULL << (bits[i] & 63);
+    }
+    return true;
+}
+
+bool quicpro_zero_rtt_admit(const uint8_t *key, size_t len)
+{
+    /* Outside a cluster nobody prepared the store; a private one still works. */
+    quicpro_zero_rtt_prepare();
+    quicpro_zero_rtt_store_t *st = quicpro_zero_rtt_store;
+    if (!st || len == 0) {
+        return false;
+    }
+
+    uint64_t h1 = quicpro_zero_rtt_hash(st->seed[0], key, len);
+    uint64_t now = quicpro_zero_rtt_now_ms();
+    bool fresh;
+
+    if (st->strategy != QP_ZRTT_BLOOM) {
+        if (!quicpro_zero_rtt_lock(st)) {
+            return false;
+        }
+        fresh = quicpro_zero_rtt_single_use(st, h1, now);
+        quicpro_zero_rtt_unlock(st);
+        return fresh;
+    }
+
+    uint64_t h2 = quicpro_zero_rtt_hash(st->seed[1], key, len);
+    bool claimed = false;
+    if (!quicpro_zero_rtt_lock(st)) {
+        return false;
+    }
+    fresh = quicpro_zero_rtt_bloom(st, h1, h2, now, &claimed);
+    quicpro_zero_rtt_unlock(st);
+    if (!claimed) {
+        return fresh;
+    }
+
+    /* This window's bucket is ours to clear; stop if a later window claims it meanwhile */
+    uint64_t epoch = now / st->window_ms;
+    unsigned cur = (unsigned)(epoch & 1);
+    uint64_t words = st->nslots / 64;
+    uint64_t *bucket = st->data + cur * words;
+    for (uint64_t off = 0; off < words; off += QP_BLOOM_CLEAR_WORDS) {
+        if (atomic_load_explicit(&st->bucket_epoch[cur], memory_order_relaxed) != epoch) {
+            return false;
+        }
+        memset(bucket + off, 0, MIN(QP_BLOOM_CLEAR_WORDS, words - off) * sizeof(uint64_t));
+    }
+
+    if (!quicpro_zero_rtt_lock(st)) {
+        return false;   /* The bucket stays unready until its next window */
+    }
+    fresh = false;
+    if (st->bucket_epoch[cur] == epoch) {
+        st->bucket_ready[cur] = epoch;
+        fresh = quicpro_zero_rtt_bloom(st, h1, h2, now, &claimed);
+    }
+    quicpro_zero_rtt_unlock(st);
+    return fresh;
+}
+
+/*──────────────────────────── Session hooks ──────────────────────────────*/
+
+void quicpro_zero_rtt_note_accept(quicpro_session_t *s, const uint8_t *dcid, size_t dcid_len)
+{
+    if (dcid_len > sizeof(s->early_key)) {
+        dcid_len = sizeof(s->early_key);
+    }
+    memcpy(s->early_key, dcid, dcid_len);
+    s->early_key_len = (uint8_t)dcid_len;
+}
+
+bool quicpro_zero_rtt_dispatchable(quicpro_session_t *s)
+{
+    if (!quicpro_tls_crypto_config.tls_server_0rtt_early_dispatch || !quiche_conn_is_in_early_data(s->conn)) {
+        return false;
+    }
+    if (s->early_verdict == 0) {
+        s->early_verdict = quicpro_zero_rtt_admit(s->early_key, s->early_key_len) ? 1 : -1;
+    }
+    return s->early_verdict > 0;
+}
+
+bool quicpro_zero_rtt_offer(quicpro_session_t *s, uint64_t stream_id)
+{
+    /* Only client-initiated bidirectional streams carry requests. */
+    if ((stream_id & 3) != 0 || (stream_id >> 2) >= 64) {
+        return false;
+    }
+    uint64_t bit = 1ULL << (stream_id >> 2);
+    if (s->early_offered & bit) {
+        return false;
+    }
+    s->early_offered |= bit;
+    return true;
+}
@@ -0,0 +1,652 @@
+/*
+ * src/smart_contracts/abi.c – Precompiled ABI event layouts
+ * =========================================================
+ *
+ * See include/smart_contracts/abi.h. A directory's layouts live in
+ * persistent memory, referenced by the process cache and by every
+ * listener that opened them; a directory that changed (by the mtimes of
+ * it and its files) is compiled anew and replaces its entry, and the old
+ * layouts go with their last listener.
+ */
+
+#include "php_quicpro.h"
+#include "smart_contracts/abi.h"
+#include "smart_contracts/json.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zend_smart_str.h>
+
+#ifdef ZTS
+# include <TSRM.h>
+static MUTEX_T qp_abi_mutex = NULL;
+# define CACHE_LOCK()   tsrm_mutex_lock(qp_abi_mutex)
+# define CACHE_UNLOCK() tsrm_mutex_unlock(qp_abi_mutex)
+#else
+# define CACHE_LOCK()   /* noop */
+# define CACHE_UNLOCK() /* noop */
+#endif
+
+#define QP_ABI_MAX_FILE (16 * 1024 * 1024)
+
+struct quicpro_abi_s {
+    _Atomic uint32_t     refs;
+    uint64_t             stamp;         /* The newest mtime of the directory and its files, in ns */
+    uint32_t             count, cap;
+    quicpro_abi_event_t *events;
+    HashTable            by_topic;      /* 32 topic bytes => index + 1 */
+};
+
+static HashTable qp_abi_cache;          /* directory => quicpro_abi_t * */
+
+/*──────────────────────────── Compiling ──────────────────────────────────*/
+
+typedef struct {
+    bool     dynamic;
+    uint32_t words;
+    bool     one_word;                  /* An elementary type of one static word */
+} qp_abi_shape;
+
+static bool qp_abi_prefix(const char *s, size_t n, const char *prefix)
+{
+    size_t p = strlen(prefix);
+    return n >= p && memcmp(s, prefix, p) == 0;
+}
+
+/* The kind of the elementary type `base`, and for bytesN its N */
+static quicpro_abi_kind_t qp_abi_elementary(const char *base, size_t n, uint16_t *size)
+{
+    *size = 0;
+    if (n == 7 && memcmp(base, "address", 7) == 0) return QUICPRO_ABI_ADDRESS;
+    if (n == 4 && memcmp(base, "bool", 4) == 0) return QUICPRO_ABI_BOOL;
+    if (n == 6 && memcmp(base, "string", 6) == 0) return QUICPRO_ABI_STRING;
+    if (n == 5 && memcmp(base, "bytes", 5) == 0) return QUICPRO_ABI_BYTES;
+    if (qp_abi_prefix(base, n, "uint")) return QUICPRO_ABI_UINT;
+    if (qp_abi_prefix(base, n, "int")) return QUICPRO_ABI_INT;
+    if (qp_abi_prefix(base, n, "bytes")) {
+        int v = atoi(base + 5);
+        if (v >= 1 && v <= 32) {
+            *size = (uint16_t)v;
+            return QUICPRO_ABI_FIXED_BYTES;
+        }
+    }
+    return QUICPRO_ABI_RAW;
+}
+
+/*
+ * Appends the canonical type of the ABI input at `in` to `sig` and
+ * describes it; `field`, for a top-level input, gets its kind.
+ */
+static bool qp_abi_type(const quicpro_json_t *j, uint32_t in, smart_str *sig, qp_abi_shape *shape,
+                        quicpro_abi_field_t *field, int depth)
+{
+    uint32_t t = quicpro_json_get(j, in, "type");
+    if (t == QUICPRO_JSON_NONE || j->tok[t].type != QUICPRO_JSON_STRING || depth > 16) {
+        return false;
+    }
+    const char *type = quicpro_json_str(j, t);
+    size_t len = quicpro_json_len(j, t), base_len = 0;
+    while (base_len < len && type[base_len] != '[') {
+        base_len++;
+    }
+
+    quicpro_abi_kind_t kind = QUICPRO_ABI_RAW;
+    uint16_t size = 0;
+    memset(shape, 0, sizeof(*shape));
+    if (base_len == 5 && memcmp(type, "tuple", 5) == 0) {
+        uint32_t comps = quicpro_json_get(j, in, "components");
+        if (comps == QUICPRO_JSON_NONE || j->tok[comps].type != QUICPRO_JSON_ARRAY) {
+            return false;
+        }
+        smart_str_appendc(sig, '(');
+        uint32_t c = quicpro_json_first(j, comps);
+        for (uint32_t i = 0; i < j->tok[comps].size; i++, c = j->tok[c].skip) {
+            qp_abi_shape sub;
+            if (i) {
+                smart_str_appendc(sig, ',');
+            }
+            if (!qp_abi_type(j, c, sig, &sub, NULL, depth + 1)) {
+                return false;
+            }
+            shape->dynamic |= sub.dynamic;
+            shape->words += sub.words;
+        }
+        smart_str_appendc(sig, ')');
+        if (shape->dynamic) {
+            shape->words = 1;
+        }
+    } else {
+        /* Aliases have one canonical spelling in a signature */
+        if (base_len == 4 && memcmp(type, "uint", 4) == 0) {
+            smart_str_appends(sig, "uint256");
+        } else if (base_len == 3 && memcmp(type, "int", 3) == 0) {
+            smart_str_appends(sig, "int256");
+        } else if (base_len == 5 && memcmp(type, "fixed", 5) == 0) {
+            smart_str_appends(sig, "fixed128x18");
+        } else if (base_len == 6 && memcmp(type, "ufixed", 6) == 0) {
+            smart_str_appends(sig, "ufixed128x18");
+        } else if (base_len == 4 && memcmp(type, "byte", 4) == 0) {
+            smart_str_appends(sig, "bytes1");
+        } else {
+            smart_str_appendl(sig, type, base_len);
+        }
+        kind = base_len == 4 && memcmp(type, "byte", 4) == 0 ? QUICPRO_ABI_FIXED_BYTES : qp_abi_elementary(type, base_len, &size);
+        if (kind == QUICPRO_ABI_FIXED_BYTES && !size) {
+            size = 1;
+        }
+        shape->dynamic = kind == QUICPRO_ABI_BYTES || kind == QUICPRO_ABI_STRING;
+        shape->words = 1;
+        shape->one_word = !shape->dynamic;
+    }
+
+    /* Array suffixes, innermost first */
+    smart_str_appendl(sig, type + base_len, len - base_len);
+    uint32_t suffixes = 0;
+    bool list = false;
+    for (size_t p = base_len; p < len; suffixes++) {
+        size_t q = p + 1;
+        while (q < len && type[q] != ']') {
+            q++;
+        }
+        if (q >= len) {
+            return false;
+        }
+        if (q == p + 1) {
+            list = true;
+            shape->dynamic = true;
+            shape->words = 1;
+        } else if (!shape->dynamic) {
+            shape->words *= (uint32_t)MAX(atoi(type + p + 1), 1);
+        }
+        p = q + 1;
+    }
+
+    if (field) {
+        field->dynamic = shape->dynamic;
+        field->words = shape->words;
+        if (!suffixes) {
+            field->kind = kind;
+            field->size = size;
+        } else if (suffixes == 1 && list && shape->one_word && kind != QUICPRO_ABI_RAW) {
+            field->kind = QUICPRO_ABI_LIST;
+            field->elem = kind;
+            field->size = size;
+        } else {
+            field->kind = QUICPRO_ABI_RAW;
+        }
+    }
+    if (suffixes) {
+        shape->one_word = false;
+    }
+    return true;
+}
+
+static void qp_abi_event_free(quicpro_abi_event_t *ev)
+{
+    for (uint32_t i = 0; i < ev->nfields; i++) {
+        zend_string_release(ev->fields[i].name);
+    }
+    if (ev->fields) {
+        pefree(ev->fields, 1);
+    }
+    zend_string_release(ev->contract);
+    zend_string_release(ev->name);
+    zend_string_release(ev->signature);
+}
+
+/* Adds the events of contract `contract`'s ABI, the array at `abi` */
+static bool qp_abi_compile(quicpro_abi_t *abi, const char *contract, const quicpro_json_t *j, uint32_t arr)
+{
+    uint32_t e = quicpro_json_first(j, arr);
+    for (uint32_t i = 0; i < j->tok[arr].size; i++, e = j->tok[e].skip) {
+        uint32_t name = quicpro_json_get(j, e, "name"), inputs = quicpro_json_get(j, e, "inputs");
+        uint32_t anon = quicpro_json_get(j, e, "anonymous");
+        if (!quicpro_json_is(j, quicpro_json_get(j, e, "type"), "event") || name == QUICPRO_JSON_NONE
+            || (anon != QUICPRO_JSON_NONE && quicpro_json_len(j, anon) == 4 && memcmp(quicpro_json_str(j, anon), "true", 4) == 0)) {
+            continue;       /* Anonymous events have no topic to be found by */
+        }
+        if (inputs == QUICPRO_JSON_NONE || j->tok[inputs].type != QUICPRO_JSON_ARRAY) {
+            return false;
+        }
+
+        quicpro_abi_event_t ev = { 0 };
+        smart_str sig = {0};
+        smart_str_appendl(&sig, quicpro_json_str(j, name), quicpro_json_len(j, name));
+        smart_str_appendc(&sig, '(');
+        ev.nfields = j->tok[inputs].size;
+        ev.fields = pecalloc(MAX(ev.nfields, 1), sizeof(quicpro_abi_field_t), 1);
+        uint32_t in = quicpro_json_first(j, inputs), topic = 1;
+        bool ok = true;
+        for (uint32_t f = 0; f < ev.nfields && ok; f++, in = j->tok[in].skip) {
+            quicpro_abi_field_t *field = &ev.fields[f];
+            qp_abi_shape shape;
+            uint32_t fname = quicpro_json_get(j, in, "name"), indexed = quicpro_json_get(j, in, "indexed");
+            field->name = fname != QUICPRO_JSON_NONE
+                ? zend_string_init(quicpro_json_str(j, fname), quicpro_json_len(j, fname), 1)
+                : zend_string_init("", 0, 1);
+            if (f) {
+                smart_str_appendc(&sig, ',');
+            }
+            ok = qp_abi_type(j, in, &sig, &shape, field, 0);
+            field->indexed = indexed != QUICPRO_JSON_NONE && quicpro_json_len(j, indexed) == 4
+                && memcmp(quicpro_json_str(j, indexed), "true", 4) == 0;
+            if (field->indexed) {
+                ok = ok && topic <= 3;
+                field->at = topic++;
+            } else {
+                field->at = ev.head_words;
+                ev.head_words += field->words;
+            }
+        }
+        smart_str_appendc(&sig, ')');
+        smart_str_0(&sig);
+        ev.contract = zend_string_init(contract, strlen(contract), 1);
+        ev.name = zend_string_init(quicpro_json_str(j, name), quicpro_json_len(j, name), 1);
+        ev.signature = zend_string_init(ZSTR_VAL(sig.s), ZSTR_LEN(sig.s), 1);
+        smart_str_free(&sig);
+        if (!ok) {
+            qp_abi_event_free(&ev);
+            return false;
+        }
+        quicpro_keccak256(ZSTR_VAL(ev.signature), ZSTR_LEN(ev.signature), ev.topic);
+
+        /* The same event in several contracts (ERC-20 Transfer) decodes the same: the first wins */
+        if (zend_hash_str_exists(&abi->by_topic, (const char *)ev.topic, sizeof(ev.topic))) {
+            qp_abi_event_free(&ev);
+            continue;
+        }
+        if (abi->count == abi->cap) {
+            abi->cap = abi->cap ? abi->cap * 2 : 16;
+            abi->events = perealloc(abi->events, abi->cap * sizeof(quicpro_abi_event_t), 1);
+        }
+        abi->events[abi->count++] = ev;
+        zend_hash_str_add_ptr(&abi->by_topic, (const char *)ev.topic, sizeof(ev.topic), (void *)(uintptr_t)abi->count);
+    }
+    return true;
+}
+
+static bool qp_abi_is_json(const char *name)
+{
+    size_t n = strlen(name);
+    return n > 5 && strcmp(name + n - 5, ".json") == 0;
+}
+
+static uint64_t qp_abi_mtime(const struct stat *st)
+{
+    return (uint64_t)st->st_mtim.tv_sec * 1000000000ULL + (uint64_t)st->st_mtim.tv_nsec;
+}
+
+/* The newest mtime of `directory` and its ABI files; 0 if it cannot be read */
+static uint64_t qp_abi_stamp(const char *directory)
+{
+    struct stat st;
+    DIR *d = opendir(directory);
+    if (!d || fstat(dirfd(d), &st) < 0) {
+        if (d) closedir(d);
+        return 0;
+    }
+    uint64_t stamp = qp_abi_mtime(&st);
+    struct dirent *de;
+    while ((de = readdir(d))) {
+        if (qp_abi_is_json(de->d_name) && fstatat(dirfd(d), de->d_name, &st, 0) == 0) {
+            stamp = MAX(stamp, qp_abi_mtime(&st));
+        }
+    }
+    closedir(d);
+    return stamp;
+}
+
+static bool qp_abi_load_file(quicpro_abi_t *abi, int dir_fd, const char *file, char *err, size_t err_len)
+{
+    int fd = openat(dir_fd, file, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size > QP_ABI_MAX_FILE) {
+        snprintf(err, err_len, "%s: %s", file, fd < 0 ? strerror(errno) : "too large");
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    char *text = emalloc((size_t)st.st_size + 1);
+    size_t got = 0;
+    while (got < (size_t)st.st_size) {
+        ssize_t r = read(fd, text + got, (size_t)st.st_size - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        got += (size_t)r;
+    }
+    close(fd);
+
+    quicpro_json_t j;
+    bool ok = quicpro_json_parse(&j, text, got);
+    uint32_t arr = 0;
+    if (ok && j.tok[0].type == QUICPRO_JSON_OBJECT) {
+        arr = quicpro_json_get(&j, 0, "abi");
+    }
+    ok = ok && arr != QUICPRO_JSON_NONE && j.tok[arr].type == QUICPRO_JSON_ARRAY;
+    char contract[256];
+    snprintf(contract, sizeof(contract), "%.*s", (int)(strlen(file) - 5), file);
+    if (ok && !qp_abi_compile(abi, contract, &j, arr)) {
+        snprintf(err, err_len, "%s: an event has an input it cannot lay out", file);
+        ok = false;
+    } else if (!ok) {
+        snprintf(err, err_len, "%s: not an ABI (a JSON array, or an object with \"abi\")", file);
+    }
+    quicpro_json_free(&j);
+    efree(text);
+    return ok;
+}
+
+static quicpro_abi_t *qp_abi_build(const char *directory, uint64_t stamp, char *err, size_t err_len)
+{
+    DIR *d = opendir(directory);
+    if (!d) {
+        snprintf(err, err_len, "cannot read ABI directory %s: %s", directory, strerror(errno));
+        return NULL;
+    }
+    quicpro_abi_t *abi = pecalloc(1, sizeof(*abi), 1);
+    abi->refs = 1;
+    abi->stamp = stamp;
+    zend_hash_init(&abi->by_topic, 64, NULL, NULL, 1);
+    struct dirent *de;
+    bool ok = true;
+    while (ok && (de = readdir(d))) {
+        if (qp_abi_is_json(de->d_name)) {
+            ok = qp_abi_load_file(abi, dirfd(d), de->d_name, err, err_len);
+        }
+    }
+    closedir(d);
+    if (!ok) {
+        quicpro_abi_release(abi);
+        return NULL;
+    }
+    return abi;
+}
+
+/*──────────────────────────── Cache ──────────────────────────────────────*/
+
+quicpro_abi_t *quicpro_abi_open(const char *directory, char *err, size_t err_len)
+{
+    uint64_t stamp = qp_abi_stamp(directory);
+    size_t len = strlen(directory);
+    CACHE_LOCK();
+    quicpro_abi_t *abi = zend_hash_str_find_ptr(&qp_abi_cache, directory, len);
+    if (abi && abi->stamp == stamp && stamp) {
+        atomic_fetch_add_explicit(&abi->refs, 1, memory_order_relaxed);
+        CACHE_UNLOCK();
+        return abi;
+    }
+    CACHE_UNLOCK();
+
+    abi = qp_abi_build(directory, stamp, err, err_len);
+    if (!abi) {
+        return NULL;
+    }
+    atomic_fetch_add_explicit(&abi->refs, 1, memory_order_relaxed);
+    CACHE_LOCK();
+    zend_hash_str_update_ptr(&qp_abi_cache, directory, len, abi);
+    CACHE_UNLOCK();
+    return abi;
+}
+
+void quicpro_abi_release(quicpro_abi_t *abi)
+{
+    if (atomic_fetch_sub_explicit(&abi->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+    for (uint32_t i = 0; i < abi->count; i++) {
+        qp_abi_event_free(&abi->events[i]);
+    }
+    if (abi->events) {
+        pefree(abi->events, 1);
+    }
+    zend_hash_destroy(&abi->by_topic);
+    pefree(abi, 1);
+}
+
+uint32_t quicpro_abi_count(const quicpro_abi_t *abi)
+{
+    return abi->count;
+}
+
+const quicpro_abi_event_t *quicpro_abi_at(const quicpro_abi_t *abi, uint32_t i)
+{
+    return &abi->events[i];
+}
+
+const quicpro_abi_event_t *quicpro_abi_find(const quicpro_abi_t *abi, const uint8_t topic[QUICPRO_KECCAK_LEN])
+{
+    uintptr_t at = (uintptr_t)zend_hash_str_find_ptr(&abi->by_topic, (const char *)topic, QUICPRO_KECCAK_LEN);
+    return at ? &abi->events[at - 1] : NULL;
+}
+
+static void qp_abi_cache_dtor(zval *zv)
+{
+    quicpro_abi_release(Z_PTR_P(zv));
+}
+
+void quicpro_abi_minit(void)
+{
+    zend_hash_init(&qp_abi_cache, 4, NULL, qp_abi_cache_dtor, 1);
+#ifdef ZTS
+    qp_abi_mutex = tsrm_mutex_alloc();
+#endif
+}
+
+void quicpro_abi_mshutdown(void)
+{
+    zend_hash_destroy(&qp_abi_cache);
+#ifdef ZTS
+    tsrm_mutex_free(qp_abi_mutex);
+    qp_abi_mutex = NULL;
+#endif
+}
+
+/*──────────────────────────── Decoding ───────────────────────────────────*/
+
+static zend_string *qp_abi_hex(const uint8_t *p, size_t n)
+{
+    static const char digits[] = "0123456789abcdef";
+    zend_string *s = zend_string_alloc(2 + 2 * n, 0);
+    char *o = ZSTR_VAL(s);
+    *o++ = '0';
+    *o++ = 'x';
+    for (size_t i = 0; i < n; i++) {
+        *o++ = digits[p[i] >> 4];
+        *o++ = digits[p[i] & 15];
+    }
+    *o = '\0';
+    return s;
+}
+
+/* The 256-bit big-endian `w` in decimal, with a minus sign first if `negative` */
+static zend_string *qp_abi_decimal(const uint8_t w[32], bool negative)
+{
+    uint32_t limb[8];
+    for (int i = 0; i < 8; i++) {
+        limb[i] = (uint32_t)w[4 * i] << 24 | (uint32_t)w[4 * i + 1] << 16 | (uint32_t)w[4 * i + 2] << 8 | w[4 * i + 3];
+    }
+    char buf[80], *o = buf + sizeof(buf);
+    *--o = '\0';
+    bool zero;
+    do {
+        /* One division by 10^9 over the limbs yields nine digits */
+        uint64_t rem = 0;
+        zero = true;
+        for (int i = 0; i < 8; i++) {
+            uint64_t cur = rem << 32 | limb[i];
+            limb[i] = (uint32_t)(cur / 1000000000u);
+            rem = cur % 1000000000u;
+            zero &= limb[i] == 0;
+        }
+        for (int d = 0; d < 9 && (!zero || rem); d++) {
+            *--o = (char)('0' + rem % 10);
+            rem /= 10;
+        }
+    } while (!zero);
+    if (!*o) {
+        *--o = '0';
+    }
+    if (negative) {
+        *--o = '-';
+    }
+    return zend_string_init(o, strlen(o), 0);
+}
+
+static void qp_abi_word(quicpro_abi_kind_t kind, uint16_t size, const uint8_t w[32], zval *out)
+{
+    switch (kind) {
+        case QUICPRO_ABI_UINT: {
+            bool small = w[24] < 0x80;
+            for (int i = 0; i < 24 && small; i++) {
+                small = w[i] == 0;
+            }
+            if (small) {
+                uint64_t v = 0;
+                for (int i = 24; i < 32; i++) {
+                    v = v << 8 | w[i];
+                }
+                ZVAL_LONG(out, (zend_long)v);
+            } else {
+                ZVAL_STR(out, qp_abi_decimal(w, false));
+            }
+            return;
+        }
+        case QUICPRO_ABI_INT: {
+            uint8_t sign = w[0] & 0x80 ? 0xff : 0, mag[32];
+            bool small = (w[24] & 0x80) == (sign & 0x80);
+            for (int i = 0; i < 24 && small; i++) {
+                small = w[i] == sign;
+            }
+            if (small) {
+                uint64_t v = 0;
+                for (int i = 24; i < 32; i++) {
+                    v = v << 8 | w[i];
+                }
+                ZVAL_LONG(out, (zend_long)(int64_t)v);
+                return;
+            }
+            /* Two's complement: the magnitude of a negative value is ~w + 1 */
+            memcpy(mag, w, 32);
+            if (sign) {
+                int carry = 1;
+                for (int i = 31; i >= 0; i--) {
+                    int v = (uint8_t)~mag[i] + carry;
+                    mag[i] = (uint8_t)v;
+                    carry = v >> 8;
+                }
+            }
+            ZVAL_STR(out, qp_abi_decimal(mag, sign != 0));
+            return;
+        }
+        case QUICPRO_ABI_ADDRESS:
+            ZVAL_STR(out, qp_abi_hex(w + 12, 20));
+            return;
+        case QUICPRO_ABI_BOOL:
+            ZVAL_BOOL(out, w[31] != 0);
+            return;
+        case QUICPRO_ABI_FIXED_BYTES:
+            ZVAL_STR(out, qp_abi_hex(w, size));
+            return;
+        default:
+            ZVAL_STR(out, qp_abi_hex(w, 32));
+            return;
+    }
+}
+
+/* A word of the data as an offset or a length that fits `len`; false if not */
+static bool qp_abi_offset(const uint8_t *w, size_t len, size_t *out)
+{
+    for (int i = 0; i < 24; i++) {
+        if (w[i]) {
+            return false;
+        }
+    }
+    uint64_t v = 0;
+    for (int i = 24; i < 32; i++) {
+        v = v << 8 | w[i];
+    }
+    if (v > len) {
+        return false;
+    }
+    *out = (size_t)v;
+    return true;
+}
+
+static bool qp_abi_dynamic(const quicpro_abi_field_t *f, const uint8_t *data, size_t len, zval *out)
+{
+    size_t at, n;
+    if (!qp_abi_offset(data + (size_t)f->at * 32, len, &at) || at > len - MIN(len, 32) || len < 32) {
+        return false;
+    }
+    if (f->kind == QUICPRO_ABI_RAW) {
+        ZVAL_STR(out, qp_abi_hex(data + at, len - at));
+        return true;
+    }
+    if (!qp_abi_offset(data + at, len, &n)) {
+        return false;
+    }
+    at += 32;
+    if (f->kind == QUICPRO_ABI_LIST) {
+        if (n > (len - at) / 32) {
+            return false;
+        }
+        array_init_size(out, (uint32_t)n);
+        for (size_t i = 0; i < n; i++) {
+            zval v;
+            qp_abi_word(f->elem, f->size, data + at + i * 32, &v);
+            add_next_index_zval(out, &v);
+        }
+        return true;
+    }
+    if (n > len - at) {
+        return false;
+    }
+    if (f->kind == QUICPRO_ABI_STRING) {
+        ZVAL_STRINGL(out, (const char *)data + at, n);
+    } else {
+        ZVAL_STR(out, qp_abi_hex(data + at, n));
+    }
+    return true;
+}
+
+bool quicpro_abi_decode(const quicpro_abi_event_t *ev, const uint8_t (*topics)[32], uint32_t ntopics,
+                        const uint8_t *data, size_t len, zval *args)
+{
+    array_init_size(args, ev->nfields);
+    if (len < (size_t)ev->head_words * 32) {
+        return false;
+    }
+    for (uint32_t i = 0; i < ev->nfields; i++) {
+        const quicpro_abi_field_t *f = &ev->fields[i];
+        zval v;
+        if (f->indexed) {
+            if (f->at >= ntopics) {
+                return false;
+            }
+            /* A value that is not one word is in the topic as its hash */
+            if (f->dynamic || f->words != 1 || f->kind == QUICPRO_ABI_RAW) {
+                ZVAL_STR(&v, qp_abi_hex(topics[f->at], 32));
+            } else {
+                qp_abi_word(f->kind, f->size, topics[f->at], &v);
+            }
+        } else if (f->dynamic) {
+            if (!qp_abi_dynamic(f, data, len, &v)) {
+                return false;
+            }
+        } else if (f->kind == QUICPRO_ABI_RAW) {
+            ZVAL_STR(&v, qp_abi_hex(data + (size_t)f->at * 32, (size_t)f->words * 32));
+        } else {
+            qp_abi_word(f->kind, f->size, data + (size_t)f->at * 32, &v);
+        }
+        if (ZSTR_LEN(f->name)) {
+            zend_hash_update(Z_ARRVAL_P(args), f->name, &v);
+        } else {
+            zend_hash_index_update(Z_ARRVAL_P(args), i, &v);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,1210 @@
+/*
+ * src/smart_contracts/event_listener.c – Quicpro\SmartContracts\EventListener
+ * ===========================================================================
+ *
+ * See include/smart_contracts/event_listener.h. `next` is the first block
+ * whose events were not handed out yet; everything before it is final
+ * as far as the listener knows. Over HTTP a round reads the logs of
+ * next..min(safe head, next + batch_blocks - 1) and caches the header of
+ * the last block read, which the next round checks against the chain
+ * first. Over the socket, logs of blocks from `next` on wait in `pending`
+ * until new heads confirm them; a log of an earlier block was read by
+ * the HTTP catch-up that runs when the socket opens.
+ *
+ * Events handed out are also kept with their block in the cache, so that
+ * a reorg can hand them out again as removed. A poll that throws keeps
+ * the events it already had in `carry` for the next one.
+ */
+
+#include "php_quicpro.h"
+#include "smart_contracts/event_listener.h"
+#include "smart_contracts/abi.h"
+#include "smart_contracts/json.h"
+#include "http_client/http_client.h"
+#include "config/smart_contracts/base_layer.h"
+
+#include <curl/curl.h>
+#include <ext/spl/spl_exceptions.h>
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef CURLWS_TEXT
+# define QP_EL_WEBSOCKET 1
+#endif
+
+#define QP_EL_MAX_TOPICS     4
+#define QP_EL_WS_RETRY_MS    30000      /* After a socket failure, HTTP for this long */
+
+typedef struct {
+    uint64_t number, timestamp;
+    uint8_t  hash[32], parent[32];
+    bool     used, header;              /* header: parent and timestamp are known */
+    zval     events;                    /* The block's events handed out; UNDEF for none */
+} qp_el_block;
+
+typedef struct {
+    quicpro_abi_t *abi;                 /* NULL until constructed */
+    zend_string   *endpoint, *ws_endpoint;
+    smart_str      filter;              /* The "address" and "topics" members of the log filter */
+    HashTable      wanted;              /* Topics of the events listened for */
+    uint64_t       next, head;
+    bool           started;             /* `next` is known */
+    zend_long      confirmations, batch_blocks, poll_interval_ms, rpc_timeout_ms;
+    uint32_t       cache_cap;
+    qp_el_block   *cache;               /* A ring by number % cache_cap */
+    HashTable      by_hash;             /* 32 bytes => block number */
+    zval           carry;
+#ifdef QP_EL_WEBSOCKET
+    CURL          *ws;
+    smart_str      frame;               /* The message being received */
+    zval           pending;
+    uint64_t       ws_retry_at;
+#endif
+    zend_object    std;
+} quicpro_event_listener_object;
+
+zend_class_entry *quicpro_ce_event_listener;
+static zend_object_handlers quicpro_event_listener_handlers;
+
+static inline quicpro_event_listener_object *qp_el_from_obj(zend_object *obj)
+{
+    return (quicpro_event_listener_object *)((char *)obj - XtOffsetOf(quicpro_event_listener_object, std));
+}
+
+static quicpro_event_listener_object *qp_el_this(zval *this_zv)
+{
+    quicpro_event_listener_object *o = qp_el_from_obj(Z_OBJ_P(this_zv));
+    if (!o->abi) {
+        zend_throw_exception_ex(NULL, 0, "EventListener was not constructed");
+        return NULL;
+    }
+    return o;
+}
+
+static uint64_t qp_el_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/*──────────────────────────── Hex ────────────────────────────────────────*/
+
+static int qp_el_nibble(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    c |= 0x20;
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+/* Exactly `len` bytes from "0x" and their hex */
+static bool qp_el_unhex(const char *s, size_t n, uint8_t *out, size_t len)
+{
+    if (n != 2 + 2 * len || s[0] != '0' || (s[1] | 0x20) != 'x') {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        int hi = qp_el_nibble(s[2 + 2 * i]), lo = qp_el_nibble(s[3 + 2 * i]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+static bool qp_el_json_hash(const quicpro_json_t *j, uint32_t at, uint8_t out[32])
+{
+    return at != QUICPRO_JSON_NONE && j->tok[at].type == QUICPRO_JSON_STRING
+        && qp_el_unhex(quicpro_json_str(j, at), quicpro_json_len(j, at), out, 32);
+}
+
+static void qp_el_append_hex(smart_str *s, const uint8_t *p, size_t n)
+{
+    static const char digits[] = "0123456789abcdef";
+    smart_str_appendl(s, "0x", 2);
+    for (size_t i = 0; i < n; i++) {
+        smart_str_appendc(s, digits[p[i] >> 4]);
+        smart_str_appendc(s, digits[p[i] & 15]);
+    }
+}
+
+static void qp_el_add_hex(zval *arr, const char *key, const uint8_t *p, size_t n)
+{
+    smart_str s = {0};
+    qp_el_append_hex(&s, p, n);
+    smart_str_0(&s);
+    add_assoc_str(arr, key, s.s);
+}
+
+/*──────────────────────────── Block cache ────────────────────────────────*/
+
+static qp_el_block *qp_el_cached(quicpro_event_listener_object *o, uint64_t number)
+{
+    qp_el_block *b = &o->cache[number % o->cache_cap];
+    return b->used && b->number == number ? b : NULL;
+}
+
+static qp_el_block *qp_el_cached_hash(quicpro_event_listener_object *o, const uint8_t hash[32])
+{
+    zval *number = zend_hash_str_find(&o->by_hash, (const char *)hash, 32);
+    qp_el_block *b = number ? qp_el_cached(o, (uint64_t)Z_LVAL_P(number)) : NULL;
+    return b && memcmp(b->hash, hash, 32) == 0 ? b : NULL;
+}
+
+static void qp_el_evict(quicpro_event_listener_object *o, qp_el_block *b)
+{
+    if (!b->used) {
+        return;
+    }
+    zval *number = zend_hash_str_find(&o->by_hash, (const char *)b->hash, 32);
+    if (number && (uint64_t)Z_LVAL_P(number) == b->number) {
+        zend_hash_str_del(&o->by_hash, (const char *)b->hash, 32);
+    }
+    zval_ptr_dtor(&b->events);
+    ZVAL_UNDEF(&b->events);
+    b->used = b->header = false;
+}
+
+/* The cache's block `number` with `hash`, in place of whatever held its slot */
+static qp_el_block *qp_el_cache_put(quicpro_event_listener_object *o, uint64_t number, const uint8_t hash[32])
+{
+    qp_el_block *b = &o->cache[number % o->cache_cap];
+    if (b->used && (b->number != number || memcmp(b->hash, hash, 32) != 0)) {
+        qp_el_evict(o, b);
+    }
+    if (!b->used) {
+        zval zn;
+        b->used = true;
+        b->number = number;
+        memcpy(b->hash, hash, 32);
+        ZVAL_LONG(&zn, (zend_long)number);
+        zend_hash_str_update(&o->by_hash, (const char *)hash, 32, &zn);
+    }
+    return b;
+}
+
+/* Caches the header at `at` of a JSON-RPC block; its number in `*number` */
+static qp_el_block *qp_el_cache_header(quicpro_event_listener_object *o, const quicpro_json_t *j, uint32_t at,
+                                       uint64_t *number)
+{
+    uint8_t hash[32], parent[32];
+    uint64_t timestamp = 0;
+    if (at == QUICPRO_JSON_NONE || j->tok[at].type != QUICPRO_JSON_OBJECT
+        || !quicpro_json_u64(j, quicpro_json_get(j, at, "number"), number)
+        || !qp_el_json_hash(j, quicpro_json_get(j, at, "hash"), hash)
+        || !qp_el_json_hash(j, quicpro_json_get(j, at, "parentHash"), parent)) {
+        return NULL;
+    }
+    quicpro_json_u64(j, quicpro_json_get(j, at, "timestamp"), &timestamp);
+    qp_el_block *b = qp_el_cache_put(o, *number, hash);
+    memcpy(b->parent, parent, 32);
+    b->timestamp = timestamp;
+    b->header = true;
+    return b;
+}
+
+/* Keeps a handed-out event with its block */
+static void qp_el_keep(quicpro_event_listener_object *o, uint64_t number, const uint8_t hash[32], zval *event)
+{
+    qp_el_block *b = qp_el_cache_put(o, number, hash);
+    if (Z_ISUNDEF(b->events)) {
+        array_init(&b->events);
+    }
+    Z_ADDREF_P(event);
+    add_next_index_zval(&b->events, event);
+}
+
+static void qp_el_add_removed(zval *out, zval *event)
+{
+    zval copy;
+    ZVAL_ARR(&copy, zend_array_dup(Z_ARRVAL_P(event)));
+    add_assoc_bool(&copy, "removed", 1);
+    add_next_index_zval(out, &copy);
+}
+
+/* Hands out the events of the cached blocks after `fork` again, as removed, and forgets the blocks */
+static void qp_el_unwind(quicpro_event_listener_object *o, uint64_t fork, zval *out)
+{
+    uint64_t lo = o->next > o->cache_cap ? o->next - o->cache_cap : 0;
+    for (uint64_t n = o->next; n-- > MAX(fork + 1, lo);) {
+        qp_el_block *b = qp_el_cached(o, n);
+        if (!b) {
+            continue;
+        }
+        if (!Z_ISUNDEF(b->events)) {
+            zval *event;
+            ZEND_HASH_REVERSE_FOREACH_VAL(Z_ARRVAL(b->events), event) {
+                qp_el_add_removed(out, event);
+            } ZEND_HASH_FOREACH_END();
+        }
+        qp_el_evict(o, b);
+    }
+    o->next = fork + 1;
+}
+
+/*──────────────────────────── Logs ───────────────────────────────────────*/
+
+/*
+ * The log at `at` as an event, with its block's number and hash; false
+ * for a log of no event listened for, or one that does not decode.
+ */
+static bool qp_el_event(quicpro_event_listener_object *o, const quicpro_json_t *j, uint32_t at, zval *event,
+                        uint64_t *number, uint8_t hash[32])
+{
+    uint8_t topics[QP_EL_MAX_TOPICS][32];
+    uint32_t tt = quicpro_json_get(j, at, "topics"), dt = quicpro_json_get(j, at, "data");
+    uint32_t ntopics = tt != QUICPRO_JSON_NONE ? j->tok[tt].size : 0;
+    uint64_t log_index = 0;
+    if (!ntopics || ntopics > QP_EL_MAX_TOPICS || j->tok[tt].type != QUICPRO_JSON_ARRAY
+        || dt == QUICPRO_JSON_NONE || j->tok[dt].type != QUICPRO_JSON_STRING
+        || !quicpro_json_u64(j, quicpro_json_get(j, at, "blockNumber"), number)
+        || !qp_el_json_hash(j, quicpro_json_get(j, at, "blockHash"), hash)) {
+        return false;
+    }
+    uint32_t t = quicpro_json_first(j, tt);
+    for (uint32_t i = 0; i < ntopics; i++, t = j->tok[t].skip) {
+        if (!qp_el_json_hash(j, t, topics[i])) {
+            return false;
+        }
+    }
+    const quicpro_abi_event_t *ev = quicpro_abi_find(o->abi, topics[0]);
+    if (!ev || !zend_hash_str_exists(&o->wanted, (const char *)topics[0], 32)) {
+        return false;
+    }
+
+    size_t hex = quicpro_json_len(j, dt);
+    if (hex < 2 || hex % 2) {
+        return false;
+    }
+    size_t len = (hex - 2) / 2;
+    uint8_t *data = emalloc(MAX(len, 1));
+    zval args;
+    ZVAL_UNDEF(&args);
+    bool ok = qp_el_unhex(quicpro_json_str(j, dt), hex, data, len)
+        && quicpro_abi_decode(ev, (const uint8_t (*)[32])topics, ntopics, data, len, &args);
+    efree(data);
+    if (!ok) {
+        if (Z_TYPE(args) == IS_ARRAY) {
+            zval_ptr_dtor(&args);
+        }
+        return false;
+    }
+
+    uint32_t address = quicpro_json_get(j, at, "address"), tx = quicpro_json_get(j, at, "transactionHash");
+    uint32_t removed = quicpro_json_get(j, at, "removed");
+    quicpro_json_u64(j, quicpro_json_get(j, at, "logIndex"), &log_index);
+    array_init_size(event, 10);
+    add_assoc_stringl(event, "contract", ZSTR_VAL(ev->contract), ZSTR_LEN(ev->contract));
+    add_assoc_stringl(event, "event", ZSTR_VAL(ev->name), ZSTR_LEN(ev->name));
+    add_assoc_stringl(event, "signature", ZSTR_VAL(ev->signature), ZSTR_LEN(ev->signature));
+    add_assoc_zval(event, "args", &args);
+    if (address != QUICPRO_JSON_NONE) {
+        add_assoc_stringl(event, "address", (char *)quicpro_json_str(j, address), quicpro_json_len(j, address));
+    } else {
+        add_assoc_null(event, "address");
+    }
+    add_assoc_long(event, "block_number", (zend_long)*number);
+    qp_el_add_hex(event, "block_hash", hash, 32);
+    if (tx != QUICPRO_JSON_NONE) {
+        add_assoc_stringl(event, "transaction_hash", (char *)quicpro_json_str(j, tx), quicpro_json_len(j, tx));
+    } else {
+        add_assoc_null(event, "transaction_hash");
+    }
+    add_assoc_long(event, "log_index", (zend_long)log_index);
+    add_assoc_bool(event, "removed", removed != QUICPRO_JSON_NONE && quicpro_json_len(j, removed) == 4
+        && memcmp(quicpro_json_str(j, removed), "true", 4) == 0);
+    return true;
+}
+
+/*──────────────────────────── JSON-RPC over HTTP ─────────────────────────*/
+
+typedef struct {
+    zend_string   *text;
+    quicpro_json_t j;
+    uint32_t      *result;              /* Per call, the token of its result */
+} qp_el_reply;
+
+static void qp_el_call(smart_str *batch, uint32_t id, const char *method, const char *params, size_t params_len)
+{
+    smart_str_appendc(batch, batch->s && ZSTR_LEN(batch->s) ? ',' : '[');
+    smart_str_appends(batch, "{\"jsonrpc\":\"2.0\",\"id\":");
+    smart_str_append_unsigned(batch, id);
+    smart_str_appends(batch, ",\"method\":\"");
+    smart_str_appends(batch, method);
+    smart_str_appends(batch, "\",\"params\":");
+    smart_str_appendl(batch, params, params_len);
+    smart_str_appendc(batch, '}');
+}
+
+static void qp_el_call_block(smart_str *batch, uint32_t id, uint64_t number)
+{
+    char params[40];
+    int n = snprintf(params, sizeof(params), "[\"0x%" PRIx64 "\",false]", number);
+    qp_el_call(batch, id, "eth_getBlockByNumber", params, (size_t)n);
+}
+
+static void qp_el_reply_free(qp_el_reply *r)
+{
+    quicpro_json_free(&r->j);
+    if (r->result) {
+        efree(r->result);
+    }
+    if (r->text) {
+        zend_string_release(r->text);
+    }
+    memset(r, 0, sizeof(*r));
+}
+
+static void qp_el_throw_rpc_error(const quicpro_json_t *j, uint32_t error, const char *endpoint)
+{
+    uint32_t message = quicpro_json_get(j, error, "message");
+    if (message != QUICPRO_JSON_NONE && j->tok[message].type == QUICPRO_JSON_STRING) {
+        zend_throw_exception_ex(NULL, 0, "EventListener: %s: %.*s", endpoint,
+            (int)quicpro_json_len(j, message), quicpro_json_str(j, message));
+    } else {
+        zend_throw_exception_ex(NULL, 0, "EventListener: %s answered with an error", endpoint);
+    }
+}
+
+/* Sends the `n` calls of `batch` as one request; false with an exception thrown */
+static bool qp_el_rpc(quicpro_event_listener_object *o, smart_str *batch, uint32_t n, qp_el_reply *r)
+{
+    memset(r, 0, sizeof(*r));
+    smart_str_appendc(batch, ']');
+    smart_str_0(batch);
+    long status = quicpro_http_post(ZSTR_VAL(o->endpoint), "application/json", batch->s, o->rpc_timeout_ms, &r->text);
+    smart_str_free(batch);
+    if (!status) {
+        return false;
+    }
+    if (status != 200) {
+        zend_throw_exception_ex(NULL, 0, "EventListener: %s answered HTTP %ld", ZSTR_VAL(o->endpoint), status);
+        return false;
+    }
+    if (!quicpro_json_parse(&r->j, ZSTR_VAL(r->text), ZSTR_LEN(r->text))) {
+        zend_throw_exception_ex(NULL, 0, "EventListener: %s answered with something other than JSON", ZSTR_VAL(o->endpoint));
+        return false;
+    }
+    if (r->j.tok[0].type != QUICPRO_JSON_ARRAY) {
+        /* A node that refuses the whole batch answers with one error */
+        qp_el_throw_rpc_error(&r->j, quicpro_json_get(&r->j, 0, "error"), ZSTR_VAL(o->endpoint));
+        return false;
+    }
+    r->result = safe_emalloc(n, sizeof(uint32_t), 0);
+    for (uint32_t i = 0; i < n; i++) {
+        r->result[i] = QUICPRO_JSON_NONE;
+    }
+    uint32_t e = quicpro_json_first(&r->j, 0);
+    for (uint32_t i = 0; i < r->j.tok[0].size; i++, e = r->j.tok[e].skip) {
+        uint64_t id;
+        uint32_t error = quicpro_json_get(&r->j, e, "error");
+        if (error != QUICPRO_JSON_NONE) {
+            qp_el_throw_rpc_error(&r->j, error, ZSTR_VAL(o->endpoint));
+            return false;
+        }
+        if (quicpro_json_u64(&r->j, quicpro_json_get(&r->j, e, "id"), &id) && id < n) {
+            r->result[id] = quicpro_json_get(&r->j, e, "result");
+        }
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        if (r->result[i] == QUICPRO_JSON_NONE) {
+            zend_throw_exception_ex(NULL, 0, "EventListener: %s did not answer every call of a batch", ZSTR_VAL(o->endpoint));
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * After the block before `next` left the chain: finds the newest cached
+ * block still on it, in one batch, and unwinds to there.
+ */
+static bool qp_el_find_fork(quicpro_event_listener_object *o, zval *out)
+{
+    uint64_t lo = o->next > o->cache_cap ? o->next - o->cache_cap : 0;
+    uint64_t *numbers = safe_emalloc(o->cache_cap, sizeof(uint64_t), 0);
+    uint32_t n = 0;
+    smart_str batch = {0};
+    for (uint64_t b = lo; b < o->next; b++) {
+        if (qp_el_cached(o, b)) {
+            qp_el_call_block(&batch, n, b);
+            numbers[n++] = b;
+        }
+    }
+    qp_el_reply r;
+    if (!qp_el_rpc(o, &batch, n, &r)) {
+        qp_el_reply_free(&r);
+        efree(numbers);
+        return false;
+    }
+    uint64_t fork = numbers[0] ? numbers[0] - 1 : 0;
+    for (uint32_t i = n; i-- > 0;) {
+        uint8_t hash[32];
+        qp_el_block *b = qp_el_cached(o, numbers[i]);
+        if (qp_el_json_hash(&r.j, quicpro_json_get(&r.j, r.result[i], "hash"), hash) && memcmp(hash, b->hash, 32) == 0) {
+            fork = numbers[i];
+            break;
+        }
+    }
+    qp_el_reply_free(&r);
+    efree(numbers);
+    qp_el_unwind(o, fork, out);
+    return true;
+}
+
+/*
+ * One round over HTTP: the head and a reorg check, then the logs of the
+ * next range. 1 if more blocks are ready, 0 when caught up, -1 thrown.
+ */
+static int qp_el_http_round(quicpro_event_listener_object *o, zval *out)
+{
+    smart_str batch = {0};
+    qp_el_reply r;
+    qp_el_block *last = o->started && o->next ? qp_el_cached(o, o->next - 1) : NULL;
+    if (last && !last->header) {
+        last = NULL;
+    }
+    qp_el_call(&batch, 0, "eth_blockNumber", "[]", 2);
+    if (last) {
+        qp_el_call_block(&batch, 1, last->number);
+    }
+    if (!qp_el_rpc(o, &batch, last ? 2 : 1, &r)) {
+        qp_el_reply_free(&r);
+        return -1;
+    }
+    uint64_t head;
+    if (!quicpro_json_u64(&r.j, r.result[0], &head)) {
+        qp_el_reply_free(&r);
+        zend_throw_exception_ex(NULL, 0, "EventListener: eth_blockNumber did not answer a block number");
+        return -1;
+    }
+    bool forked = false;
+    if (last) {
+        uint8_t hash[32];
+        forked = !qp_el_json_hash(&r.j, quicpro_json_get(&r.j, r.result[1], "hash"), hash)
+            || memcmp(hash, last->hash, 32) != 0;
+    }
+    qp_el_reply_free(&r);
+    o->head = head;
+    if (forked && !qp_el_find_fork(o, out)) {
+        return -1;
+    }
+    if (head < (uint64_t)o->confirmations) {
+        return 0;
+    }
+    uint64_t safe = head - (uint64_t)o->confirmations;
+    if (!o->started) {
+        o->next = safe + 1;
+        o->started = true;
+    }
+    if (o->next > safe) {
+        return 0;
+    }
+
+    uint64_t end = MIN(safe, o->next + (uint64_t)o->batch_blocks - 1);
+    smart_str params = {0};
+    char range[80];
+    snprintf(range, sizeof(range), "[{\"fromBlock\":\"0x%" PRIx64 "\",\"toBlock\":\"0x%" PRIx64 "\",", o->next, end);
+    smart_str_appends(&params, range);
+    smart_str_append_smart_str(&params, &o->filter);
+    smart_str_appendl(&params, "}]", 2);
+    qp_el_call(&batch, 0, "eth_getLogs", ZSTR_VAL(params.s), ZSTR_LEN(params.s));
+    smart_str_free(&params);
+    qp_el_call_block(&batch, 1, end);
+    if (!qp_el_rpc(o, &batch, 2, &r)) {
+        qp_el_reply_free(&r);
+        return -1;
+    }
+
+    uint64_t number;
+    qp_el_block *tip = qp_el_cache_header(o, &r.j, r.result[1], &number);
+    uint32_t logs = r.result[0];
+    if (!tip || number != end || r.j.tok[logs].type != QUICPRO_JSON_ARRAY) {
+        /* The node has not got the block yet (a load balancer ahead of it); the next round asks again */
+        qp_el_reply_free(&r);
+        return 0;
+    }
+    zval events;
+    array_init(&events);
+    uint32_t l = quicpro_json_first(&r.j, logs);
+    bool consistent = true;
+    for (uint32_t i = 0; i < r.j.tok[logs].size && consistent; i++, l = r.j.tok[l].skip) {
+        zval event;
+        uint8_t hash[32];
+        if (qp_el_event(o, &r.j, l, &event, &number, hash)) {
+            /* A reorg between the two calls shows as logs of another block `end` */
+            consistent = number != end || memcmp(hash, tip->hash, 32) == 0;
+            add_next_index_zval(&events, &event);
+        }
+    }
+    if (!consistent) {
+        qp_el_evict(o, tip);
+        zval_ptr_dtor(&events);
+        qp_el_reply_free(&r);
+        return 1;
+    }
+    zval *event;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL(events), event) {
+        uint8_t hash[32];
+        zval *bh = zend_hash_str_find(Z_ARRVAL_P(event), "block_hash", sizeof("block_hash") - 1);
+        qp_el_unhex(Z_STRVAL_P(bh), Z_STRLEN_P(bh), hash, 32);
+        qp_el_keep(o, (uint64_t)Z_LVAL_P(zend_hash_str_find(Z_ARRVAL_P(event), "block_number", sizeof("block_number") - 1)),
+            hash, event);
+        Z_ADDREF_P(event);
+        add_next_index_zval(out, event);
+    } ZEND_HASH_FOREACH_END();
+    zval_ptr_dtor(&events);
+    qp_el_reply_free(&r);
+    o->next = end + 1;
+    return end < safe;
+}
+
+/*──────────────────────────── Subscriptions over WebSocket ───────────────*/
+
+#ifdef QP_EL_WEBSOCKET
+static void qp_el_ws_close(quicpro_event_listener_object *o)
+{
+    if (o->ws) {
+        curl_easy_cleanup(o->ws);
+        o->ws = NULL;
+    }
+    smart_str_free(&o->frame);
+    zval_ptr_dtor(&o->pending);
+    ZVAL_UNDEF(&o->pending);
+}
+
+static int qp_el_ws_wait(quicpro_event_listener_object *o, short events, int timeout_ms)
+{
+    curl_socket_t fd = CURL_SOCKET_BAD;
+    if (curl_easy_getinfo(o->ws, CURLINFO_ACTIVESOCKET, &fd) != CURLE_OK || fd == CURL_SOCKET_BAD) {
+        return -1;
+    }
+    struct pollfd p = { .fd = fd, .events = events };
+    int rc;
+    do {
+        rc = poll(&p, 1, timeout_ms);
+    } while (rc < 0 && errno == EINTR);
+    return rc;
+}
+
+static bool qp_el_ws_send(quicpro_event_listener_object *o, const char *msg, size_t len)
+{
+    for (size_t off = 0; off < len;) {
+        size_t sent = 0;
+        CURLcode rc = curl_ws_send(o->ws, msg + off, len - off, &sent, 0, CURLWS_TEXT);
+        if (rc == CURLE_AGAIN) {
+            if (qp_el_ws_wait(o, POLLOUT, (int)o->rpc_timeout_ms) <= 0) {
+                return false;
+            }
+            continue;
+        }
+        if (rc != CURLE_OK) {
+            return false;
+        }
+        off += sent;
+    }
+    return true;
+}
+
+/* Opens the socket and subscribes to new heads and to the logs; false if it cannot */
+static bool qp_el_ws_open(quicpro_event_listener_object *o)
+{
+    CURL *h = curl_easy_init();
+    if (!h) {
+        return false;
+    }
+    curl_easy_setopt(h, CURLOPT_URL, ZSTR_VAL(o->ws_endpoint));
+    curl_easy_setopt(h, CURLOPT_CONNECT_ONLY, 2L);
+    curl_easy_setopt(h, CURLOPT_CONNECTTIMEOUT_MS, (long)o->rpc_timeout_ms);
+    curl_easy_setopt(h, CURLOPT_NOSIGNAL, 1L);
+    if (curl_easy_perform(h) != CURLE_OK) {
+        curl_easy_cleanup(h);
+        return false;
+    }
+    o->ws = h;
+    array_init(&o->pending);
+
+    smart_str logs = {0};
+    smart_str_appends(&logs, "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"eth_subscribe\",\"params\":[\"logs\",{");
+    smart_str_append_smart_str(&logs, &o->filter);
+    smart_str_appends(&logs, "}]}");
+    static const char heads[] = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"eth_subscribe\",\"params\":[\"newHeads\"]}";
+    bool ok = qp_el_ws_send(o, heads, sizeof(heads) - 1) && qp_el_ws_send(o, ZSTR_VAL(logs.s), ZSTR_LEN(logs.s));
+    smart_str_free(&logs);
+    if (!ok) {
+        qp_el_ws_close(o);
+    }
+    return ok;
+}
+
+static bool qp_el_same_log(zval *a, zval *b)
+{
+    zval *ah = zend_hash_str_find(Z_ARRVAL_P(a), "block_hash", sizeof("block_hash") - 1);
+    zval *bh = zend_hash_str_find(Z_ARRVAL_P(b), "block_hash", sizeof("block_hash") - 1);
+    zval *ai = zend_hash_str_find(Z_ARRVAL_P(a), "log_index", sizeof("log_index") - 1);
+    zval *bi = zend_hash_str_find(Z_ARRVAL_P(b), "log_index", sizeof("log_index") - 1);
+    return zend_string_equals(Z_STR_P(ah), Z_STR_P(bh)) && Z_LVAL_P(ai) == Z_LVAL_P(bi);
+}
+
+/* Handles one message of the socket; false if the node refused a subscription */
+static bool qp_el_ws_message(quicpro_event_listener_object *o, const char *text, size_t len, zval *out)
+{
+    quicpro_json_t j;
+    if (!quicpro_json_parse(&j, text, len) || j.tok[0].type != QUICPRO_JSON_OBJECT) {
+        quicpro_json_free(&j);
+        return true;
+    }
+    if (quicpro_json_get(&j, 0, "error") != QUICPRO_JSON_NONE) {
+        quicpro_json_free(&j);
+        return false;
+    }
+    /* Subscription ids are not needed: a head and a log tell apart by their members */
+    uint32_t result = quicpro_json_get(&j, quicpro_json_get(&j, 0, "params"), "result");
+    uint64_t number;
+    uint8_t hash[32];
+    zval event;
+    if (result == QUICPRO_JSON_NONE) {
+        /* The answer to a subscribe */
+    } else if (quicpro_json_get(&j, result, "parentHash") != QUICPRO_JSON_NONE) {
+        if (qp_el_cache_header(o, &j, result, &number)) {
+            o->head = number;
+        }
+    } else if (qp_el_event(o, &j, result, &event, &number, hash)) {
+        if (Z_TYPE_P(zend_hash_str_find(Z_ARRVAL(event), "removed", sizeof("removed") - 1)) != IS_TRUE) {
+            if (number >= o->next) {
+                add_next_index_zval(&o->pending, &event);
+            } else {
+                zval_ptr_dtor(&event);      /* Read by the catch-up */
+            }
+        } else if (number >= o->next) {
+            zend_ulong idx;
+            zval *p;
+            ZEND_HASH_FOREACH_NUM_KEY_VAL(Z_ARRVAL(o->pending), idx, p) {
+                if (qp_el_same_log(p, &event)) {
+                    zend_hash_index_del(Z_ARRVAL(o->pending), idx);
+                    break;
+                }
+            } ZEND_HASH_FOREACH_END();
+            zval_ptr_dtor(&event);
+        } else {
+            qp_el_block *b = qp_el_cached_hash(o, hash);
+            if (b) {
+                qp_el_evict(o, b);
+            }
+            add_next_index_zval(out, &event);
+        }
+    }
+    quicpro_json_free(&j);
+    return true;
+}
+
+/* Hands out the pending events the head confirms */
+static void qp_el_ws_release(quicpro_event_listener_object *o, zval *out)
+{
+    if (o->head < (uint64_t)o->confirmations) {
+        return;
+    }
+    uint64_t safe = o->head - (uint64_t)o->confirmations;
+    zval keep, *event;
+    array_init(&keep);
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL(o->pending), event) {
+        uint64_t number = (uint64_t)Z_LVAL_P(zend_hash_str_find(Z_ARRVAL_P(event), "block_number", sizeof("block_number") - 1));
+        Z_ADDREF_P(event);
+        if (number <= safe) {
+            uint8_t hash[32];
+            zval *bh = zend_hash_str_find(Z_ARRVAL_P(event), "block_hash", sizeof("block_hash") - 1);
+            qp_el_unhex(Z_STRVAL_P(bh), Z_STRLEN_P(bh), hash, 32);
+            qp_el_keep(o, number, hash, event);
+            add_next_index_zval(out, event);
+        } else {
+            add_next_index_zval(&keep, event);
+        }
+    } ZEND_HASH_FOREACH_END();
+    zval_ptr_dtor(&o->pending);
+    ZVAL_COPY_VALUE(&o->pending, &keep);
+    o->next = MAX(o->next, safe + 1);
+}
+
+/* Receives for up to `timeout_ms`, or until there are events; false if the socket failed */
+static bool qp_el_ws_poll(quicpro_event_listener_object *o, zend_long timeout_ms, zval *out)
+{
+    uint64_t deadline = qp_el_now_ms() + (uint64_t)timeout_ms;
+    char buf[16384];
+    for (;;) {
+        size_t n = 0;
+        const struct curl_ws_frame *meta = NULL;
+        CURLcode rc = curl_ws_recv(o->ws, buf, sizeof(buf), &n, &meta);
+        if (rc == CURLE_AGAIN) {
+            qp_el_ws_release(o, out);
+            uint64_t now = qp_el_now_ms();
+            if (zend_hash_num_elements(Z_ARRVAL_P(out)) || now >= deadline) {
+                return true;
+            }
+            if (qp_el_ws_wait(o, POLLIN, (int)MIN(deadline - now, INT_MAX)) < 0) {
+                return false;
+            }
+            continue;
+        }
+        if (rc != CURLE_OK || !meta || (meta->flags & CURLWS_CLOSE)) {
+            return false;
+        }
+        if (meta->flags & (CURLWS_PING | CURLWS_PONG)) {
+            continue;                       /* libcurl answers pings itself */
+        }
+        smart_str_appendl(&o->frame, buf, n);
+        if (meta->bytesleft == 0 && !(meta->flags & CURLWS_CONT)) {
+            bool ok = !o->frame.s || qp_el_ws_message(o, ZSTR_VAL(o->frame.s), ZSTR_LEN(o->frame.s), out);
+            smart_str_free(&o->frame);
+            if (!ok) {
+                return false;
+            }
+        }
+    }
+}
+#endif
+
+static bool qp_el_poll(quicpro_event_listener_object *o, zend_long timeout_ms, zval *out)
+{
+#ifdef QP_EL_WEBSOCKET
+    if (o->ws_endpoint && !o->ws && qp_el_now_ms() >= o->ws_retry_at) {
+        if (qp_el_ws_open(o)) {
+            /* Catch up to the confirmed head over HTTP; the socket takes over from there */
+            int more;
+            while ((more = qp_el_http_round(o, out)) > 0) {
+            }
+            if (more < 0) {
+                return false;
+            }
+        } else {
+            o->ws_retry_at = qp_el_now_ms() + QP_EL_WS_RETRY_MS;
+        }
+    }
+    if (o->ws) {
+        if (qp_el_ws_poll(o, timeout_ms, out)) {
+            return true;
+        }
+        /* Unconfirmed events are dropped; HTTP reads them again from `next` */
+        qp_el_ws_close(o);
+        o->ws_retry_at = qp_el_now_ms() + QP_EL_WS_RETRY_MS;
+    }
+#endif
+    uint64_t deadline = qp_el_now_ms() + (uint64_t)timeout_ms;
+    for (;;) {
+        int more = qp_el_http_round(o, out);
+        if (more < 0) {
+            return false;
+        }
+        if (zend_hash_num_elements(Z_ARRVAL_P(out))) {
+            return true;
+        }
+        if (more) {
+            continue;
+        }
+        uint64_t now = qp_el_now_ms();
+        if (now >= deadline) {
+            return true;
+        }
+        usleep((useconds_t)(MIN(deadline - now, (uint64_t)o->poll_interval_ms) * 1000));
+    }
+}
+
+/*──────────────────────────── Methods ────────────────────────────────────*/
+
+static bool qp_el_option_long(HashTable *options, const char *key, zend_long min, zend_long max, zend_long *out)
+{
+    zval *zv = options ? zend_hash_str_find(options, key, strlen(key)) : NULL;
+    if (!zv) {
+        return true;
+    }
+    if (Z_TYPE_P(zv) != IS_LONG || Z_LVAL_P(zv) < min || Z_LVAL_P(zv) > max) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "EventListener option '%s' must be an integer within " ZEND_LONG_FMT ".." ZEND_LONG_FMT, key, min, max);
+        return false;
+    }
+    *out = Z_LVAL_P(zv);
+    return true;
+}
+
+static zend_string *qp_el_option_string(HashTable *options, const char *key, const char *fallback)
+{
+    zval *zv = options ? zend_hash_str_find(options, key, strlen(key)) : NULL;
+    if (zv && Z_TYPE_P(zv) == IS_STRING && Z_STRLEN_P(zv)) {
+        return zend_string_copy(Z_STR_P(zv));
+    }
+    if (zv && Z_TYPE_P(zv) != IS_NULL) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "EventListener option '%s' must be a string", key);
+        return NULL;
+    }
+    return fallback && *fallback ? zend_string_init(fallback, strlen(fallback), 0) : NULL;
+}
+
+/* Appends the "address" member of the log filter; false with an exception thrown */
+static bool qp_el_filter_addresses(quicpro_event_listener_object *o, zval *zv)
+{
+    HashTable single;
+    HashTable *list = NULL;
+    if (Z_TYPE_P(zv) == IS_STRING) {
+        zend_hash_init(&single, 1, NULL, NULL, 0);
+        zend_hash_next_index_insert(&single, zv);
+        list = &single;
+    } else if (Z_TYPE_P(zv) == IS_ARRAY) {
+        list = Z_ARRVAL_P(zv);
+    }
+    bool ok = list != NULL, first = true;
+    zval *a;
+    smart_str_appends(&o->filter, "\"address\":[");
+    if (ok) {
+        ZEND_HASH_FOREACH_VAL(list, a) {
+            uint8_t bytes[20];
+            if (Z_TYPE_P(a) != IS_STRING || !qp_el_unhex(Z_STRVAL_P(a), Z_STRLEN_P(a), bytes, 20)) {
+                ok = false;
+                break;
+            }
+            if (!first) {
+                smart_str_appendc(&o->filter, ',');
+            }
+            first = false;
+            smart_str_appendc(&o->filter, '"');
+            qp_el_append_hex(&o->filter, bytes, 20);
+            smart_str_appendc(&o->filter, '"');
+        } ZEND_HASH_FOREACH_END();
+    }
+    smart_str_appends(&o->filter, "],");
+    if (list == &single) {
+        zend_hash_destroy(&single);
+    }
+    if (!ok) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "EventListener option 'address' must be a 0x address or a list of them");
+    }
+    return ok;
+}
+
+/* Whether `ev` is the event `name` or "Contract.Event" names */
+static bool qp_el_names(const quicpro_abi_event_t *ev, zend_string *name)
+{
+    size_t c = ZSTR_LEN(ev->contract);
+    return zend_string_equals(ev->name, name)
+        || (ZSTR_LEN(name) == c + 1 + ZSTR_LEN(ev->name) && memcmp(ZSTR_VAL(name), ZSTR_VAL(ev->contract), c) == 0
+            && ZSTR_VAL(name)[c] == '.' && memcmp(ZSTR_VAL(name) + c + 1, ZSTR_VAL(ev->name), ZSTR_LEN(ev->name)) == 0);
+}
+
+static void qp_el_want(quicpro_event_listener_object *o, const quicpro_abi_event_t *ev)
+{
+    if (zend_hash_str_add_empty_element(&o->wanted, (const char *)ev->topic, 32)) {
+        smart_str_appends(&o->filter, zend_hash_num_elements(&o->wanted) > 1 ? ",\"" : "\"");
+        qp_el_append_hex(&o->filter, ev->topic, 32);
+        smart_str_appendc(&o->filter, '"');
+    }
+}
+
+/* Appends the "topics" member of the log filter; false with an exception thrown */
+static bool qp_el_filter_topics(quicpro_event_listener_object *o, zval *names)
+{
+    uint32_t count = quicpro_abi_count(o->abi);
+    smart_str_appends(&o->filter, "\"topics\":[[");
+    if (!names) {
+        for (uint32_t i = 0; i < count; i++) {
+            qp_el_want(o, quicpro_abi_at(o->abi, i));
+        }
+    } else {
+        zval *name;
+        if (Z_TYPE_P(names) != IS_ARRAY) {
+            zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "EventListener option 'events' must be a list of names");
+            return false;
+        }
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(names), name) {
+            bool found = false;
+            if (Z_TYPE_P(name) != IS_STRING) {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "EventListener option 'events' must be a list of names");
+                return false;
+            }
+            for (uint32_t i = 0; i < count; i++) {
+                if (qp_el_names(quicpro_abi_at(o->abi, i), Z_STR_P(name))) {
+                    qp_el_want(o, quicpro_abi_at(o->abi, i));
+                    found = true;
+                }
+            }
+            if (!found) {
+                zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+                    "EventListener: no ABI of the directory has an event %s", Z_STRVAL_P(name));
+                return false;
+            }
+        } ZEND_HASH_FOREACH_END();
+    }
+    smart_str_appends(&o->filter, "]]");
+    smart_str_0(&o->filter);
+    if (!zend_hash_num_elements(&o->wanted)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "EventListener: the ABI directory has no events");
+        return false;
+    }
+    return true;
+}
+
+PHP_METHOD(QuicproSmartContractsEventListener, __construct)
+{
+    HashTable *options = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(0, 1)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_ARRAY_HT(options)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_event_listener_object *o = qp_el_from_obj(Z_OBJ_P(ZEND_THIS));
+    if (o->abi) {
+        zend_throw_exception_ex(NULL, 0, "EventListener is already constructed");
+        RETURN_THROWS();
+    }
+    if (!quicpro_smart_contracts_config.event_listener_enable) {
+        zend_throw_exception_ex(NULL, 0, "EventListener needs quicpro.smartcontract_event_listener_enable");
+        RETURN_THROWS();
+    }
+
+    zend_long from_block = -1, cache_blocks = 256;
+    o->confirmations = 12;
+    o->batch_blocks = 2000;
+    o->poll_interval_ms = 1000;
+    o->rpc_timeout_ms = 10000;
+    if (!qp_el_option_long(options, "from_block", 0, ZEND_LONG_MAX, &from_block)
+        || !qp_el_option_long(options, "confirmations", 0, 1024, &o->confirmations)
+        || !qp_el_option_long(options, "batch_blocks", 1, 1000000, &o->batch_blocks)
+        || !qp_el_option_long(options, "cache_blocks", 16, 1 << 20, &cache_blocks)
+        || !qp_el_option_long(options, "poll_interval_ms", 1, 3600000, &o->poll_interval_ms)
+        || !qp_el_option_long(options, "rpc_timeout_ms", 1, 3600000, &o->rpc_timeout_ms)) {
+        RETURN_THROWS();
+    }
+
+    zend_string *directory = qp_el_option_string(options, "abi_directory", quicpro_smart_contracts_config.abi_directory);
+    if (EG(exception)) {
+        RETURN_THROWS();
+    }
+    o->endpoint = qp_el_option_string(options, "endpoint", quicpro_smart_contracts_config.dlt_rpc_endpoint);
+    if (!EG(exception)) {
+        o->ws_endpoint = qp_el_option_string(options, "ws_endpoint", NULL);
+    }
+    if (!EG(exception) && (!o->endpoint || !directory)) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "EventListener needs an endpoint (quicpro.smartcontract_dlt_rpc_endpoint) and an ABI directory");
+    }
+    if (EG(exception)) {
+        if (directory) zend_string_release(directory);
+        RETURN_THROWS();
+    }
+
+    char err[256];
+    quicpro_abi_t *abi = quicpro_abi_open(ZSTR_VAL(directory), err, sizeof(err));
+    zend_string_release(directory);
+    if (!abi) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0, "EventListener: %s", err);
+        RETURN_THROWS();
+    }
+    o->abi = abi;
+
+    zval *address = options ? zend_hash_str_find(options, "address", sizeof("address") - 1) : NULL;
+    if ((address && Z_TYPE_P(address) != IS_NULL && !qp_el_filter_addresses(o, address))
+        || !qp_el_filter_topics(o, options ? zend_hash_str_find(options, "events", sizeof("events") - 1) : NULL)) {
+        RETURN_THROWS();
+    }
+
+    o->cache_cap = (uint32_t)cache_blocks;
+    o->cache = ecalloc(o->cache_cap, sizeof(qp_el_block));
+    if (from_block >= 0) {
+        o->next = (uint64_t)from_block;
+        o->started = true;
+    }
+}
+
+/* The events since the last poll, waiting up to `timeout_ms` for some */
+PHP_METHOD(QuicproSmartContractsEventListener, poll)
+{
+    zend_long timeout_ms = 1000;
+
+    ZEND_PARSE_PARAMETERS_START(0, 1)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(timeout_ms)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_event_listener_object *o = qp_el_this(ZEND_THIS);
+    if (!o) {
+        RETURN_THROWS();
+    }
+    if (timeout_ms < 0) {
+        zend_argument_value_error(1, "must be greater than or equal to 0");
+        RETURN_THROWS();
+    }
+    if (!Z_ISUNDEF(o->carry)) {
+        ZVAL_COPY_VALUE(return_value, &o->carry);
+        ZVAL_UNDEF(&o->carry);
+    } else {
+        array_init(return_value);
+    }
+    if (!qp_el_poll(o, zend_hash_num_elements(Z_ARRVAL_P(return_value)) ? 0 : timeout_ms, return_value)) {
+        ZVAL_COPY_VALUE(&o->carry, return_value);
+        ZVAL_NULL(return_value);
+        RETURN_THROWS();
+    }
+}
+
+/* The chain head the listener last saw */
+PHP_METHOD(QuicproSmartContractsEventListener, head)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_event_listener_object *o = qp_el_this(ZEND_THIS);
+    if (!o) {
+        RETURN_THROWS();
+    }
+    RETURN_LONG((zend_long)o->head);
+}
+
+/* A cached block by number or 0x hash, with the events handed out of it; null if not cached */
+PHP_METHOD(QuicproSmartContractsEventListener, block)
+{
+    zval *id;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ZVAL(id)
+    ZEND_PARSE_PARAMETERS_END();
+
+    quicpro_event_listener_object *o = qp_el_this(ZEND_THIS);
+    if (!o) {
+        RETURN_THROWS();
+    }
+    qp_el_block *b = NULL;
+    uint8_t hash[32];
+    if (Z_TYPE_P(id) == IS_LONG) {
+        b = Z_LVAL_P(id) >= 0 ? qp_el_cached(o, (uint64_t)Z_LVAL_P(id)) : NULL;
+    } else if (Z_TYPE_P(id) == IS_STRING && qp_el_unhex(Z_STRVAL_P(id), Z_STRLEN_P(id), hash, 32)) {
+        b = qp_el_cached_hash(o, hash);
+    } else {
+        zend_argument_type_error(1, "must be a block number or a 0x block hash");
+        RETURN_THROWS();
+    }
+    if (!b) {
+        RETURN_NULL();
+    }
+    array_init_size(return_value, 5);
+    add_assoc_long(return_value, "number", (zend_long)b->number);
+    qp_el_add_hex(return_value, "hash", b->hash, 32);
+    if (b->header) {
+        qp_el_add_hex(return_value, "parent_hash", b->parent, 32);
+        add_assoc_long(return_value, "timestamp", (zend_long)b->timestamp);
+    }
+    if (Z_ISUNDEF(b->events)) {
+        zval events;
+        array_init(&events);
+        add_assoc_zval(return_value, "events", &events);
+    } else {
+        Z_ADDREF(b->events);
+        add_assoc_zval(return_value, "events", &b->events);
+    }
+}
+
+/* "websocket" while subscribed, else "http" */
+PHP_METHOD(QuicproSmartContractsEventListener, mode)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    quicpro_event_listener_object *o = qp_el_this(ZEND_THIS);
+    if (!o) {
+        RETURN_THROWS();
+    }
+#ifdef QP_EL_WEBSOCKET
+    if (o->ws) {
+        RETURN_STRING("websocket");
+    }
+#endif
+    RETURN_STRING("http");
+}
+
+/*──────────────────────────── Life cycle ─────────────────────────────────*/
+
+static zend_object *qp_el_create(zend_class_entry *ce)
+{
+    quicpro_event_listener_object *o = zend_object_alloc(sizeof(quicpro_event_listener_object), ce);
+    zend_object_std_init(&o->std, ce);
+    object_properties_init(&o->std, ce);
+    zend_hash_init(&o->wanted, 8, NULL, NULL, 0);
+    zend_hash_init(&o->by_hash, 64, NULL, NULL, 0);
+    o->std.handlers = &quicpro_event_listener_handlers;
+    return &o->std;
+}
+
+static void qp_el_free_obj(zend_object *obj)
+{
+    quicpro_event_listener_object *o = qp_el_from_obj(obj);
+#ifdef QP_EL_WEBSOCKET
+    qp_el_ws_close(o);
+#endif
+    if (o->cache) {
+        for (uint32_t i = 0; i < o->cache_cap; i++) {
+            zval_ptr_dtor(&o->cache[i].events);
+        }
+        efree(o->cache);
+    }
+    zend_hash_destroy(&o->by_hash);
+    zend_hash_destroy(&o->wanted);
+    zval_ptr_dtor(&o->carry);
+    smart_str_free(&o->filter);
+    if (o->endpoint) {
+        zend_string_release(o->endpoint);
+    }
+    if (o->ws_endpoint) {
+        zend_string_release(o->ws_endpoint);
+    }
+    if (o->abi) {
+        quicpro_abi_release(o->abi);
+    }
+    zend_object_std_dtor(obj);
+}
+
+/*──────────────────────────── Registration ───────────────────────────────*/
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_quicpro_event_listener_construct, 0, 0, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, options, IS_ARRAY, 0, "[]")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_event_listener_poll, 0, 0, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeout_ms, IS_LONG, 0, "1000")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_event_listener_head, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_event_listener_block, 0, 1, IS_ARRAY, 1)
+    ZEND_ARG_TYPE_MASK(0, block, MAY_BE_LONG | MAY_BE_STRING, NULL)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_quicpro_event_listener_mode, 0, 0, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry quicpro_event_listener_methods[] = {
+    PHP_ME(QuicproSmartContractsEventListener, __construct, arginfo_quicpro_event_listener_construct, ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproSmartContractsEventListener, poll,        arginfo_quicpro_event_listener_poll,      ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproSmartContractsEventListener, head,        arginfo_quicpro_event_listener_head,      ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproSmartContractsEventListener, block,       arginfo_quicpro_event_listener_block,     ZEND_ACC_PUBLIC)
+    PHP_ME(QuicproSmartContractsEventListener, mode,        arginfo_quicpro_event_listener_mode,      ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+void quicpro_event_listener_minit(void)
+{
+    zend_class_entry ce;
+    INIT_NS_CLASS_ENTRY(ce, "Quicpro\\SmartContracts", "EventListener", quicpro_event_listener_methods);
+    quicpro_ce_event_listener = zend_register_internal_class(&ce);
+    quicpro_ce_event_listener->ce_flags |= ZEND_ACC_FINAL;
+#ifdef ZEND_ACC_NO_DYNAMIC_PROPERTIES
+    quicpro_ce_event_listener->ce_flags |= ZEND_ACC_NO_DYNAMIC_PROPERTIES;
+#endif
+    quicpro_ce_event_listener->create_object = qp_el_create;
+
+    memcpy(&quicpro_event_listener_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    quicpro_event_listener_handlers.offset = XtOffsetOf(quicpro_event_listener_object, std);
+    quicpro_event_listener_handlers.free_obj = qp_el_free_obj;
+    quicpro_event_listener_handlers.clone_obj = NULL;
+}
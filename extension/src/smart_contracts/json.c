@@ -0,0 +1,206 @@
+/*
+ * src/smart_contracts/json.c – JSON token scanner
+ * ===============================================
+ *
+ * See include/smart_contracts/json.h. The scanner is recursive descent
+ * with an explicit depth limit; it checks structure, not the grammar of
+ * numbers, which the readers below parse themselves.
+ */
+
+#include "smart_contracts/json.h"
+
+#include <string.h>
+
+#define QP_JSON_MAX_DEPTH 64
+
+typedef struct {
+    quicpro_json_t *j;
+    const char     *p, *end;
+    uint32_t        cap;
+} qp_json_scan;
+
+static uint32_t qp_json_tok(qp_json_scan *s, quicpro_json_type_t type, const char *start)
+{
+    quicpro_json_t *j = s->j;
+    if (j->count == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 64;
+        j->tok = safe_erealloc(j->tok, s->cap, sizeof(quicpro_json_tok_t), 0);
+    }
+    quicpro_json_tok_t *t = &j->tok[j->count];
+    t->type = type;
+    t->start = (uint32_t)(start - j->text);
+    t->end = t->start;
+    t->size = 0;
+    t->skip = 0;
+    return j->count++;
+}
+
+static inline void qp_json_space(qp_json_scan *s)
+{
+    while (s->p < s->end && (*s->p == ' ' || *s->p == '\t' || *s->p == '\n' || *s->p == '\r')) {
+        s->p++;
+    }
+}
+
+static bool qp_json_value(qp_json_scan *s, int depth);
+
+static bool qp_json_string(qp_json_scan *s)
+{
+    uint32_t at = qp_json_tok(s, QUICPRO_JSON_STRING, ++s->p);
+    while (s->p < s->end && *s->p != '"') {
+        if (*s->p == '\\') {
+            s->p++;
+        } else if ((unsigned char)*s->p < 0x20) {
+            return false;
+        }
+        s->p++;
+    }
+    if (s->p >= s->end) {
+        return false;
+    }
+    s->j->tok[at].end = (uint32_t)(s->p++ - s->j->text);
+    s->j->tok[at].skip = at + 1;
+    return true;
+}
+
+static bool qp_json_value(qp_json_scan *s, int depth)
+{
+    qp_json_space(s);
+    if (s->p >= s->end || depth > QP_JSON_MAX_DEPTH) {
+        return false;
+    }
+    char c = *s->p;
+    if (c == '"') {
+        return qp_json_string(s);
+    }
+    if (c == '{' || c == '[') {
+        bool object = c == '{';
+        uint32_t at = qp_json_tok(s, object ? QUICPRO_JSON_OBJECT : QUICPRO_JSON_ARRAY, s->p++);
+        qp_json_space(s);
+        if (s->p < s->end && *s->p == (object ? '}' : ']')) {
+            s->p++;
+        } else {
+            for (;;) {
+                if (object) {
+                    qp_json_space(s);
+                    if (s->p >= s->end || *s->p != '"' || !qp_json_string(s)) {
+                        return false;
+                    }
+                    qp_json_space(s);
+                    if (s->p >= s->end || *s->p++ != ':') {
+                        return false;
+                    }
+                }
+                if (!qp_json_value(s, depth + 1)) {
+                    return false;
+                }
+                s->j->tok[at].size++;
+                qp_json_space(s);
+                if (s->p >= s->end) {
+                    return false;
+                }
+                if (*s->p == ',') {
+                    s->p++;
+                    continue;
+                }
+                if (*s->p++ != (object ? '}' : ']')) {
+                    return false;
+                }
+                break;
+            }
+        }
+        s->j->tok[at].end = (uint32_t)(s->p - s->j->text);
+        s->j->tok[at].skip = s->j->count;
+        return true;
+    }
+    uint32_t at = qp_json_tok(s, QUICPRO_JSON_PRIMITIVE, s->p);
+    while (s->p < s->end && !strchr(",]} \t\r\n", *s->p)) {
+        s->p++;
+    }
+    if (s->p == s->j->text + s->j->tok[at].start) {
+        return false;
+    }
+    s->j->tok[at].end = (uint32_t)(s->p - s->j->text);
+    s->j->tok[at].skip = at + 1;
+    return true;
+}
+
+bool quicpro_json_parse(quicpro_json_t *j, const char *text, size_t len)
+{
+    memset(j, 0, sizeof(*j));
+    j->text = text;
+    if (len >= UINT32_MAX) {
+        return false;
+    }
+    qp_json_scan s = { j, text, text + len, 0 };
+    if (!qp_json_value(&s, 0)) {
+        return false;
+    }
+    qp_json_space(&s);
+    return s.p == s.end;
+}
+
+void quicpro_json_free(quicpro_json_t *j)
+{
+    if (j->tok) {
+        efree(j->tok);
+    }
+    memset(j, 0, sizeof(*j));
+}
+
+bool quicpro_json_is(const quicpro_json_t *j, uint32_t at, const char *s)
+{
+    size_t n = strlen(s);
+    return at != QUICPRO_JSON_NONE && j->tok[at].type == QUICPRO_JSON_STRING && quicpro_json_len(j, at) == n
+        && memcmp(quicpro_json_str(j, at), s, n) == 0;
+}
+
+uint32_t quicpro_json_get(const quicpro_json_t *j, uint32_t obj, const char *key)
+{
+    if (obj == QUICPRO_JSON_NONE || j->tok[obj].type != QUICPRO_JSON_OBJECT) {
+        return QUICPRO_JSON_NONE;
+    }
+    uint32_t k = obj + 1;
+    for (uint32_t i = 0; i < j->tok[obj].size; i++) {
+        uint32_t v = k + 1;
+        if (quicpro_json_is(j, k, key)) {
+            return v;
+        }
+        k = j->tok[v].skip;
+    }
+    return QUICPRO_JSON_NONE;
+}
+
+bool quicpro_json_u64(const quicpro_json_t *j, uint32_t at, uint64_t *out)
+{
+    if (at == QUICPRO_JSON_NONE || j->tok[at].type == QUICPRO_JSON_OBJECT || j->tok[at].type == QUICPRO_JSON_ARRAY) {
+        return false;
+    }
+    const char *p = quicpro_json_str(j, at), *end = p + quicpro_json_len(j, at);
+    uint64_t v = 0;
+    if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        p += 2;
+        if (end - p > 16) {
+            return false;
+        }
+        for (; p < end; p++) {
+            int d = *p >= '0' && *p <= '9' ? *p - '0' : (*p | 0x20) >= 'a' && (*p | 0x20) <= 'f' ? (*p | 0x20) - 'a' + 10 : -1;
+            if (d < 0) {
+                return false;
+            }
+            v = v << 4 | (uint64_t)d;
+        }
+    } else {
+        if (p == end) {
+            return false;
+        }
+        for (; p < end; p++) {
+            if (*p < '0' || *p > '9' || v > (UINT64_MAX - (uint64_t)(*p - '0')) / 10) {
+                return false;
+            }
+            v = v * 10 + (uint64_t)(*p - '0');
+        }
+    }
+    *out = v;
+    return true;
+}
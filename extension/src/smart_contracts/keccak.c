@@ -0,0 +1,95 @@
+/*
+ * src/smart_contracts/keccak.c – Keccak-256
+ * =========================================
+ *
+ * See include/smart_contracts/keccak.h. The 24 rounds of Keccak-f[1600]
+ * on 64-bit lanes, absorbing little-endian words.
+ */
+
+#include "smart_contracts/keccak.h"
+
+#include <string.h>
+
+#define QP_KECCAK_RATE 136
+
+static const uint64_t qp_keccak_rc[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+    0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL,
+};
+
+static const unsigned qp_keccak_rot[24] = {
+    1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14, 27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44,
+};
+
+static const unsigned qp_keccak_pi[24] = {
+    10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4, 15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1,
+};
+
+static inline uint64_t qp_rol(uint64_t x, unsigned n)
+{
+    return x << n | x >> (64 - n);
+}
+
+static void qp_keccak_f(uint64_t st[25])
+{
+    for (int round = 0; round < 24; round++) {
+        uint64_t bc[5];
+        for (int i = 0; i < 5; i++) {
+            bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20];
+        }
+        for (int i = 0; i < 5; i++) {
+            uint64_t t = bc[(i + 4) % 5] ^ qp_rol(bc[(i + 1) % 5], 1);
+            for (int j = 0; j < 25; j += 5) {
+                st[j + i] ^= t;
+            }
+        }
+        uint64_t t = st[1];
+        for (int i = 0; i < 24; i++) {
+            uint64_t next = st[qp_keccak_pi[i]];
+            st[qp_keccak_pi[i]] = qp_rol(t, qp_keccak_rot[i]);
+            t = next;
+        }
+        for (int j = 0; j < 25; j += 5) {
+            for (int i = 0; i < 5; i++) {
+                bc[i] = st[j + i];
+            }
+            for (int i = 0; i < 5; i++) {
+                st[j + i] ^= ~bc[(i + 1) % 5] & bc[(i + 2) % 5];
+            }
+        }
+        st[0] ^= qp_keccak_rc[round];
+    }
+}
+
+static void qp_keccak_absorb(uint64_t st[25], const uint8_t *block)
+{
+    for (int i = 0; i < QP_KECCAK_RATE / 8; i++) {
+        uint64_t w = 0;
+        for (int b = 7; b >= 0; b--) {
+            w = w << 8 | block[i * 8 + b];
+        }
+        st[i] ^= w;
+    }
+    qp_keccak_f(st);
+}
+
+void quicpro_keccak256(const void *data, size_t len, uint8_t out[QUICPRO_KECCAK_LEN])
+{
+    uint64_t st[25] = { 0 };
+    const uint8_t *p = data;
+    for (; len >= QP_KECCAK_RATE; p += QP_KECCAK_RATE, len -= QP_KECCAK_RATE) {
+        qp_keccak_absorb(st, p);
+    }
+    uint8_t last[QP_KECCAK_RATE] = { 0 };
+    memcpy(last, p, len);
+    last[len] = 0x01;
+    last[QP_KECCAK_RATE - 1] |= 0x80;
+    qp_keccak_absorb(st, last);
+    for (int i = 0; i < QUICPRO_KECCAK_LEN; i++) {
+        out[i] = (uint8_t)(st[i / 8] >> (8 * (i % 8)));
+    }
+}
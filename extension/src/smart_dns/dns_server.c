@@ -0,0 +1,542 @@
+/*
+ * src/smart_dns/dns_server.c – Native DNS responder
+ * =================================================
+ *
+ * See include/smart_dns/dns_server.h. One epoll set holds the UDP socket,
+ * the TCP listener and the TCP connections. UDP answers go out of the
+ * transmit slot they were built in; a TCP connection answers one message
+ * at a time and reads the next only when the last answer is written.
+ */
+
+#include "smart_dns/dns_server.h"
+
+#include <zend_exceptions.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "poll/udp_batch.h"
+#include "cluster/cluster_stats.h"
+#include "config/smart_dns/base_layer.h"
+#include "config/bare_metal_tuning/base_layer.h"
+
+#define QP_DNS_TCP_CONNS        128
+#define QP_DNS_TCP_IDLE_NS      (10 * 1000000000ULL)    /* RFC 7766 §6.2.3 */
+#define QP_DNS_RELOAD_NS        1000000000ULL
+#define QP_DNS_HEADER           12
+
+static inline uint16_t qp_dns_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline void qp_dns_put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static uint64_t qp_dns_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*──────────────────────────────── Answers ────────────────────────────────*/
+
+/* Skips a (possibly compressed) name; false if it runs past `len` */
+static bool qp_dns_skip_name(const uint8_t *m, size_t len, size_t *pos)
+{
+    while (*pos < len) {
+        uint8_t l = m[*pos];
+        if ((l & 0xC0) == 0xC0) {
+            *pos += 2;
+            return *pos <= len;
+        }
+        *pos += 1 + (size_t)l;
+        if (l == 0) {
+            return *pos <= len;
+        }
+    }
+    return false;
+}
+
+/* An answer without sections: the header, and the question if there is one */
+static size_t qp_dns_error(const uint8_t *q, size_t question_end, uint8_t rcode, uint8_t *out, size_t cap)
+{
+    size_t n = question_end ? question_end : QP_DNS_HEADER;
+    if (n > cap) {
+        return 0;
+    }
+    memcpy(out, q, n);
+    out[2] = (uint8_t)(0x80 | (q[2] & 0x79));   /* QR, opcode, RD */
+    out[3] = rcode;
+    qp_dns_put16(out + 4, question_end ? 1 : 0);
+    memset(out + 6, 0, 6);
+    return n;
+}
+
+size_t quicpro_dns_respond(const quicpro_dns_zone_t *z, const quicpro_dns_sd_table_t *sd, const uint8_t *q, size_t len,
+                           uint8_t *out, size_t cap, bool udp)
+{
+    uint8_t name[QUICPRO_DNS_NAME_MAX];
+    size_t pos = QP_DNS_HEADER, n = 0;
+
+    if (len < QP_DNS_HEADER || (q[2] & 0x80) || cap < QP_DNS_HEADER) {
+        return 0;   /* Not a query: never answer an answer */
+    }
+    if ((q[2] >> 3 & 0x0F) != 0) {
+        return qp_dns_error(q, 0, QUICPRO_DNS_RCODE_NOTIMP, out, cap);
+    }
+    if (qp_dns_u16(q + 4) != 1) {
+        return qp_dns_error(q, 0, QUICPRO_DNS_RCODE_FORMERR, out, cap);
+    }
+
+    /* The question, lower-cased for the lookup; the client's case goes back as it came */
+    while (pos < len && q[pos]) {
+        uint8_t l = q[pos];
+        if (l > 63 || pos + 1 + l >= len || n + 1 + l >= sizeof(name)) {
+            return qp_dns_error(q, 0, QUICPRO_DNS_RCODE_FORMERR, out, cap);
+        }
+        name[n++] = l;
+        for (uint8_t i = 0; i < l; i++) {
+            uint8_t c = q[pos + 1 + i];
+            name[n++] = c >= 'A' && c <= 'Z' ? (uint8_t)(c | 0x20) : c;
+        }
+        pos += 1 + (size_t)l;
+    }
+    if (pos + 5 > len) {
+        return qp_dns_error(q, 0, QUICPRO_DNS_RCODE_FORMERR, out, cap);
+    }
+    name[n++] = 0;
+    pos++;
+    uint16_t qtype = qp_dns_u16(q + pos), qclass = qp_dns_u16(q + pos + 2);
+    size_t question_end = pos + 4;
+
+    /* EDNS: an OPT record among the additional ones */
+    bool edns = false;
+    uint16_t client_size = 512;
+    uint8_t version = 0;
+    unsigned skip = (unsigned)qp_dns_u16(q + 6) + qp_dns_u16(q + 8), extra = qp_dns_u16(q + 10);
+    pos = question_end;
+    for (unsigned i = 0; i < skip + extra; i++) {
+        if (!qp_dns_skip_name(q, len, &pos) || pos + 10 > len) {
+            return qp_dns_error(q, question_end, QUICPRO_DNS_RCODE_FORMERR, out, cap);
+        }
+        if (i >= skip && qp_dns_u16(q + pos) == QUICPRO_DNS_TYPE_OPT) {
+            if (edns) {
+                return qp_dns_error(q, question_end, QUICPRO_DNS_RCODE_FORMERR, out, cap);
+            }
+            edns = true;
+            client_size = MAX(qp_dns_u16(q + pos + 2), 512);
+            version = q[pos + 5];
+        }
+        pos += 10 + (size_t)qp_dns_u16(q + pos + 8);
+        if (pos > len) {
+            return qp_dns_error(q, question_end, QUICPRO_DNS_RCODE_FORMERR, out, cap);
+        }
+    }
+
+    quicpro_dns_answer_t a = { .rcode = QUICPRO_DNS_RCODE_REFUSED }, from_zone;
+    if (edns && version != 0) {
+        a.rcode = 16;                   /* BADVERS: 1 in the OPT's extended bits */
+    } else if ((qclass == 1 || qclass == 255) && qtype != QUICPRO_DNS_TYPE_AXFR && qtype != QUICPRO_DNS_TYPE_IXFR
+               && qtype != QUICPRO_DNS_TYPE_OPT) {
+        /* The agent's addresses first; other types, and names it does not know, from the zone */
+        bool known = quicpro_dns_sd_lookup(sd, name, n, qtype, &a);
+        if ((!known || !a.answer_count) && z && quicpro_dns_zone_lookup(z, name, n, qtype, &from_zone)
+            && (!known || from_zone.rcode != QUICPRO_DNS_RCODE_NXDOMAIN)) {
+            a = from_zone;
+        } else if (!known) {
+            a = (quicpro_dns_answer_t){ .rcode = QUICPRO_DNS_RCODE_REFUSED };
+        }
+    }
+
+    size_t server_size = (size_t)MIN(MAX(quicpro_smart_dns_config.dns_edns_udp_payload_size, 512), QUICPRO_DNS_UDP_MAX);
+    size_t limit = !udp ? cap : edns ? MIN(MIN((size_t)client_size, server_size), cap) : MIN((size_t)512, cap);
+    size_t opt = edns ? 11 : 0;
+    size_t total = question_end + a.answer_len + a.authority_len + a.additional_len + opt;
+    bool tc = false;
+    if (total > limit) {
+        /* The glue is optional; the rest goes over TCP */
+        total -= a.additional_len;
+        a.additional_len = a.additional_count = 0;
+        if (total > limit) {
+            tc = true;
+            a.answer_len = a.answer_count = a.authority_len = a.authority_count = 0;
+            total = question_end + opt;
+        }
+    }
+    if (total > limit) {
+        return 0;
+    }
+
+    memcpy(out, q, question_end);
+    out[2] = (uint8_t)(0x80 | (q[2] & 0x79) | (a.authoritative ? 0x04 : 0) | (tc ? 0x02 : 0));
+    out[3] = a.rcode & 0x0F;
+    qp_dns_put16(out + 4, 1);
+    qp_dns_put16(out + 6, a.answer_count);
+    qp_dns_put16(out + 8, a.authority_count);
+    qp_dns_put16(out + 10, (uint16_t)(a.additional_count + (edns ? 1 : 0)));
+    pos = question_end;
+    if (a.answer_len) {
+        memcpy(out + pos, a.answer, a.answer_len);
+        pos += a.answer_len;
+    }
+    if (a.authority_len) {
+        memcpy(out + pos, a.authority, a.authority_len);
+        pos += a.authority_len;
+    }
+    if (a.additional_len) {
+        memcpy(out + pos, a.additional, a.additional_len);
+        pos += a.additional_len;
+    }
+    if (edns) {
+        uint8_t *o = out + pos;
+        o[0] = 0;                                       /* Root owner */
+        qp_dns_put16(o + 1, QUICPRO_DNS_TYPE_OPT);
+        qp_dns_put16(o + 3, (uint16_t)server_size);     /* What we take */
+        o[5] = (uint8_t)(a.rcode >> 4);                 /* Extended RCODE */
+        o[6] = 0;                                       /* Version */
+        qp_dns_put16(o + 7, 0);                         /* Flags */
+        qp_dns_put16(o + 9, 0);                         /* No options */
+        pos += 11;
+    }
+    QUICPRO_WORKER_STAT(requests);
+    return pos;
+}
+
+/*──────────────────────────────── Sources ────────────────────────────────*/
+
+bool quicpro_dns_source_open(quicpro_dns_source_t *src)
+{
+    qp_smart_dns_config_t *cfg = &quicpro_smart_dns_config;
+    char err[256];
+    memset(src, 0, sizeof(*src));
+    if (!cfg->dns_server_enable) {
+        zend_throw_exception(NULL, "The DNS server is disabled (quicpro.dns_server_enable)", 0);
+        return false;
+    }
+    if (strcmp(cfg->dns_mode, "recursive_resolver") == 0) {
+        zend_throw_exception(NULL, "quicpro.dns_mode \"recursive_resolver\" is not served by the DNS engine", 0);
+        return false;
+    }
+
+    src->ttl = (uint32_t)MIN(cfg->dns_default_record_ttl_sec, INT32_MAX);
+    src->reload_at = qp_dns_now_ns() + QP_DNS_RELOAD_NS;
+    if (strcmp(cfg->dns_mode, "authoritative") == 0 || access(cfg->dns_static_zone_file_path, R_OK) == 0) {
+        src->zone = quicpro_dns_zone_open(cfg->dns_static_zone_file_path, src->ttl, err, sizeof(err));
+        if (!src->zone) {
+            zend_throw_exception_ex(NULL, 0, "Zone file %s: %s", cfg->dns_static_zone_file_path, err);
+            return false;
+        }
+    }
+    const char *agent = cfg->dns_health_agent_mcp_endpoint;
+    if (strcmp(cfg->dns_mode, "service_discovery") == 0 && agent && *agent) {
+        uint32_t max_ips = (uint32_t)MIN(MAX(cfg->dns_service_discovery_max_ips_per_response, 1), 64);
+        src->sd = quicpro_dns_sd_start(agent, max_ips, src->ttl, err, sizeof(err));
+        if (!src->sd) {
+            zend_throw_exception_ex(NULL, 0, "Health agent %s: %s", agent, err);
+            quicpro_dns_source_close(src);
+            return false;
+        }
+        src->sd_table = quicpro_dns_sd_acquire(src->sd);
+    }
+    return true;
+}
+
+void quicpro_dns_source_tick(quicpro_dns_source_t *src)
+{
+    if (src->sd) {
+        src->sd_table = quicpro_dns_sd_acquire(src->sd);  /* One table for the whole round */
+    }
+    uint64_t now = qp_dns_now_ns();
+    if (now < src->reload_at) {
+        return;
+    }
+    src->reload_at = now + QP_DNS_RELOAD_NS;
+
+    char err[256];
+    const char *path = quicpro_smart_dns_config.dns_static_zone_file_path;
+    if (src->zone ? !quicpro_dns_zone_stale(src->zone) : access(path, R_OK) != 0) {
+        return;
+    }
+    quicpro_dns_zone_t *z = quicpro_dns_zone_open(path, src->ttl, err, sizeof(err));
+    if (!z) {
+        php_error_docref(NULL, E_WARNING, "Zone file %s not reloaded: %s", path, err);
+        return;
+    }
+    quicpro_dns_zone_close(src->zone);
+    src->zone = z;
+}
+
+void quicpro_dns_source_close(quicpro_dns_source_t *src)
+{
+    quicpro_dns_zone_close(src->zone);
+    quicpro_dns_sd_stop(src->sd);
+    memset(src, 0, sizeof(*src));
+}
+
+/*─────────────────────────────── Sockets ─────────────────────────────────*/
+
+typedef struct {
+    int       fd;
+    uint64_t  active_ns;
+    size_t    in_len;
+    size_t    out_len, out_off;     /* An answer being written; reads wait for it */
+    uint8_t   in[2 + QUICPRO_DNS_TCP_MAX];
+    uint8_t   out[2 + QUICPRO_DNS_TCP_MAX];
+} qp_dns_tcp_t;
+
+typedef struct {
+    int                     udp, tcp, ep;
+    quicpro_dns_source_t    src;
+    quicpro_udp_rx_batch_t *rx;
+    struct mmsghdr         *msgs;
+    struct iovec           *iov;
+    uint8_t                *tx;     /* capacity × QUICPRO_DNS_UDP_MAX */
+    qp_dns_tcp_t           *conns[QP_DNS_TCP_CONNS];
+    char                    udp_tag, tcp_tag;   /* epoll tags of the two sockets */
+} qp_dns_t;
+
+/* A socket of `type` bound to the configured address, or -1 after throwing */
+static int qp_dns_socket(int type)
+{
+    const char *host = quicpro_smart_dns_config.dns_server_bind_host;
+    zend_long port = quicpro_smart_dns_config.dns_server_port;
+    struct sockaddr_in6 addr = { .sin6_family = AF_INET6, .sin6_port = htons((uint16_t)port) };
+    struct in_addr v4;
+    int one = 1, off = 0;
+
+    if (inet_pton(AF_INET6, host, &addr.sin6_addr) != 1) {
+        if (inet_pton(AF_INET, host, &v4) != 1) {
+            zend_throw_exception_ex(NULL, 0, "Invalid quicpro.dns_server_bind_host: %s", host);
+            return -1;
+        }
+        addr.sin6_addr.s6_addr[10] = 0xff;
+        addr.sin6_addr.s6_addr[11] = 0xff;
+        memcpy(&addr.sin6_addr.s6_addr[12], &v4, 4);
+    }
+    int fd = socket(AF_INET6, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0
+        || setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off)) < 0
+        || (type == SOCK_STREAM && setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0)
+        || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+        || (type == SOCK_STREAM && listen(fd, 1024) < 0)) {
+        zend_throw_exception_ex(NULL, 0, "Failed to bind the DNS server to %s:" ZEND_LONG_FMT " (%s): %s",
+                                host, port, type == SOCK_STREAM ? "TCP" : "UDP", strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void qp_dns_udp(qp_dns_t *d)
+{
+    unsigned budget = (unsigned)quicpro_bare_metal_config.io_max_drain_packets;
+    while (budget) {
+        int n = quicpro_udp_recv_batch(d->udp, d->rx);
+        if (n <= 0) {
+            return;
+        }
+        unsigned out = 0;
+        for (int i = 0; i < n; i++) {
+            if (quicpro_udp_rx_slot_truncated(d->rx, (unsigned)i)) {
+                continue;
+            }
+            uint8_t *slot = d->tx + (size_t)out * QUICPRO_DNS_UDP_MAX;
+            size_t len = quicpro_dns_respond(d->src.zone, d->src.sd_table, quicpro_udp_rx_slot_data(d->rx, (unsigned)i),
+                                             quicpro_udp_rx_slot_len(d->rx, (unsigned)i), slot, QUICPRO_DNS_UDP_MAX, true);
+            if (!len) {
+                continue;
+            }
+            d->iov[out] = (struct iovec){ slot, len };
+            d->msgs[out].msg_hdr = (struct msghdr){
+                .msg_name = &d->rx->from[i], .msg_namelen = d->rx->msgs[i].msg_hdr.msg_namelen,
+                .msg_iov = &d->iov[out], .msg_iovlen = 1,
+            };
+            out++;
+        }
+        for (unsigned sent = 0; sent < out; ) {
+            int rc = sendmmsg(d->udp, d->msgs + sent, out - sent, 0);
+            if (rc < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) break;  /* Clients retry */
+                sent++;
+                continue;
+            }
+            sent += (unsigned)rc;
+        }
+        budget = (unsigned)n >= budget ? 0 : budget - (unsigned)n;
+    }
+}
+
+static void qp_dns_tcp_close(qp_dns_t *d, int slot)
+{
+    qp_dns_tcp_t *c = d->conns[slot];
+    close(c->fd);       /* Leaves the epoll set with it */
+    efree(c);
+    d->conns[slot] = NULL;
+}
+
+static void qp_dns_tcp_accept(qp_dns_t *d)
+{
+    for (;;) {
+        int fd = accept4(d->tcp, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        int slot = 0;
+        while (slot < QP_DNS_TCP_CONNS && d->conns[slot]) slot++;
+        if (slot == QP_DNS_TCP_CONNS) {
+            close(fd);  /* Full: the client tries another server */
+            continue;
+        }
+        qp_dns_tcp_t *c = emalloc(sizeof(*c));
+        c->fd = fd;
+        c->in_len = c->out_len = c->out_off = 0;
+        c->active_ns = qp_dns_now_ns();
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT | EPOLLET, .data.u64 = (uint64_t)slot };
+        if (epoll_ctl(d->ep, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            efree(c);
+            continue;
+        }
+        d->conns[slot] = c;
+    }
+}
+
+/* Writes what is pending, answers what was read; false once the connection is done */
+static bool qp_dns_tcp_pump(qp_dns_t *d, qp_dns_tcp_t *c)
+{
+    for (;;) {
+        while (c->out_off < c->out_len) {
+            ssize_t w = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL);
+            if (w < 0) {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            c->out_off += (size_t)w;
+            c->active_ns = qp_dns_now_ns();
+        }
+        c->out_len = c->out_off = 0;
+
+        size_t want = c->in_len >= 2 ? 2 + (size_t)qp_dns_u16(c->in) : 2;
+        if (c->in_len < want) {
+            ssize_t r = recv(c->fd, c->in + c->in_len, want - c->in_len, 0);
+            if (r == 0) {
+                return false;
+            }
+            if (r < 0) {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            c->in_len += (size_t)r;
+            c->active_ns = qp_dns_now_ns();
+            continue;
+        }
+        if (want == 2) {
+            continue;   /* The length is in; read the message */
+        }
+        size_t len = quicpro_dns_respond(d->src.zone, d->src.sd_table, c->in + 2, want - 2, c->out + 2, QUICPRO_DNS_TCP_MAX, false);
+        c->in_len = 0;
+        if (!len) {
+            return false;
+        }
+        qp_dns_put16(c->out, (uint16_t)len);
+        c->out_len = 2 + len;
+    }
+}
+
+static void qp_dns_free(qp_dns_t *d)
+{
+    for (int i = 0; i < QP_DNS_TCP_CONNS; i++) {
+        if (d->conns[i]) qp_dns_tcp_close(d, i);
+    }
+    if (d->ep >= 0) close(d->ep);
+    if (d->udp >= 0) close(d->udp);
+    if (d->tcp >= 0) close(d->tcp);
+    quicpro_udp_rx_batch_free(d->rx);
+    if (d->msgs) efree(d->msgs);
+    if (d->iov) efree(d->iov);
+    if (d->tx) efree(d->tx);
+    quicpro_dns_source_close(&d->src);
+}
+
+PHP_FUNCTION(quicpro_dns_server_run)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    qp_smart_dns_config_t *cfg = &quicpro_smart_dns_config;
+    qp_dns_t d = { .udp = -1, .tcp = -1, .ep = -1 };
+    if (!quicpro_dns_source_open(&d.src)) {
+        RETURN_THROWS();
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN };
+    if ((d.udp = qp_dns_socket(SOCK_DGRAM)) < 0 || (cfg->dns_server_enable_tcp && (d.tcp = qp_dns_socket(SOCK_STREAM)) < 0)) {
+        qp_dns_free(&d);
+        RETURN_THROWS();
+    }
+    d.ep = epoll_create1(EPOLL_CLOEXEC);
+    ev.data.ptr = &d.udp_tag;
+    bool watched = d.ep >= 0 && epoll_ctl(d.ep, EPOLL_CTL_ADD, d.udp, &ev) == 0;
+    ev.data.ptr = &d.tcp_tag;
+    if (!watched || (d.tcp >= 0 && epoll_ctl(d.ep, EPOLL_CTL_ADD, d.tcp, &ev) < 0)) {
+        zend_throw_exception_ex(NULL, 0, "DNS server could not watch its sockets: %s", strerror(errno));
+        qp_dns_free(&d);
+        RETURN_THROWS();
+    }
+
+    d.rx = quicpro_udp_rx_batch_new((unsigned)quicpro_bare_metal_config.io_max_batch_read_packets, QUICPRO_UDP_RX_SLOT_SIZE);
+    d.msgs = safe_emalloc(d.rx->capacity, sizeof(*d.msgs), 0);
+    d.iov = safe_emalloc(d.rx->capacity, sizeof(*d.iov), 0);
+    d.tx = safe_emalloc(d.rx->capacity, QUICPRO_DNS_UDP_MAX, 0);
+    memset(d.msgs, 0, d.rx->capacity * sizeof(*d.msgs));
+
+    uint64_t idle_at = qp_dns_now_ns() + QP_DNS_RELOAD_NS;
+    for (;;) {
+        struct epoll_event got[64];
+        quicpro_worker_wait_begin();
+        int ready = epoll_wait(d.ep, got, 64, 1000);
+        quicpro_worker_wait_end(ready);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            zend_throw_exception_ex(NULL, 0, "epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+        quicpro_dns_source_tick(&d.src);
+        for (int i = 0; i < ready; i++) {
+            if (got[i].data.ptr == &d.udp_tag) {
+                qp_dns_udp(&d);
+            } else if (got[i].data.ptr == &d.tcp_tag) {
+                qp_dns_tcp_accept(&d);
+            }
+        }
+        /* Connection events carry their slot; the tags are addresses, never that small */
+        for (int i = 0; i < ready; i++) {
+            uint64_t slot = got[i].data.u64;
+            if (slot < QP_DNS_TCP_CONNS && d.conns[slot] && !qp_dns_tcp_pump(&d, d.conns[slot])) {
+                qp_dns_tcp_close(&d, (int)slot);
+            }
+        }
+
+        uint64_t now = qp_dns_now_ns();
+        if (now >= idle_at) {
+            idle_at = now + QP_DNS_RELOAD_NS;
+            for (int i = 0; i < QP_DNS_TCP_CONNS; i++) {
+                if (d.conns[i] && now - d.conns[i]->active_ns > QP_DNS_TCP_IDLE_NS) {
+                    qp_dns_tcp_close(&d, i);
+                }
+            }
+        }
+    }
+
+    qp_dns_free(&d);
+    RETURN_FALSE;
+}
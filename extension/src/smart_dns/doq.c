@@ -0,0 +1,215 @@
+/*
+ * src/smart_dns/doq.c – DNS over QUIC (RFC 9250) on the listeners
+ * ================================================================
+ *
+ * See include/smart_dns/doq.h. A stream's state lives only while its
+ * query arrives and its answer leaves; most queries fit one packet and
+ * get their answer in the same round, written in one call.
+ */
+
+#include "smart_dns/doq.h"
+#include "smart_dns/dns_server.h"
+#include "config/smart_dns/base_layer.h"
+
+#include <zend_exceptions.h>
+#include <string.h>
+
+#include "quiche.h"
+
+typedef struct {
+    uint8_t  prefix[2];
+    size_t   in_len;                    /* Bytes read, prefix included */
+    uint8_t *query;                     /* Allocated once the length is known */
+    uint8_t *out;                       /* The answer, length-prefixed; NULL until there is one */
+    size_t   out_len, out_off;
+} qp_doq_stream_t;
+
+struct quicpro_doq_conn_s {
+    HashTable streams;                  /* stream id => qp_doq_stream_t */
+};
+
+static quicpro_dns_source_t qp_doq_src;
+static int8_t               qp_doq_state;   /* 0 not opened, 1 open, -1 could not open */
+static uint8_t              qp_doq_buf[2 + QUICPRO_DNS_TCP_MAX];
+
+static void qp_doq_stream_dtor(zval *zv)
+{
+    qp_doq_stream_t *st = Z_PTR_P(zv);
+    if (st->query) efree(st->query);
+    if (st->out) efree(st->out);
+    efree(st);
+}
+
+/* The worker's zone and feed, opened by its first query. A failure is reported once; queries are then refused. */
+static const quicpro_dns_source_t *qp_doq_source(void)
+{
+    if (qp_doq_state == 0) {
+        qp_doq_state = quicpro_dns_source_open(&qp_doq_src) ? 1 : -1;
+        if (EG(exception)) {
+            zend_exception_error(EG(exception), E_WARNING);
+            zend_clear_exception();
+        }
+    }
+    return qp_doq_state > 0 ? &qp_doq_src : NULL;
+}
+
+static void qp_doq_abort(quicpro_session_t *s)
+{
+    static const char reason[] = "DoQ protocol error";
+    quiche_conn_close(s->conn, true, QUICPRO_DOQ_PROTOCOL_ERROR, (const uint8_t *)reason, sizeof(reason) - 1);
+}
+
+/* Writes what is left of the answer; true once it is all out, or the stream is gone */
+static bool qp_doq_send(quicpro_session_t *s, uint64_t id, qp_doq_stream_t *st, bool *wrote)
+{
+    uint64_t ec = 0;
+    ssize_t n = quiche_conn_stream_send(s->conn, id, st->out + st->out_off, st->out_len - st->out_off, true, &ec);
+    if (n == QUICHE_ERR_DONE) {
+        return false;
+    }
+    if (n < 0) {
+        return true;                    /* Stopped by the client */
+    }
+    *wrote = true;
+    st->out_off += (size_t)n;
+    return st->out_off == st->out_len;
+}
+
+bool quicpro_doq_session(const quicpro_session_t *s)
+{
+    const uint8_t *proto = NULL;
+    size_t len = 0;
+    if (!quicpro_smart_dns_config.dns_server_enable) {
+        return false;
+    }
+    quiche_conn_application_proto(s->conn, &proto, &len);
+    return len == 3 && memcmp(proto, "doq", 3) == 0;
+}
+
+bool quicpro_doq_stream(quicpro_session_t *s, uint64_t stream_id)
+{
+    if ((stream_id & 0x3) != 0) {
+        qp_doq_abort(s);                /* Queries come on client-initiated bidirectional streams only */
+        return true;
+    }
+    if (!s->doq) {
+        s->doq = emalloc(sizeof(*s->doq));
+        zend_hash_init(&s->doq->streams, 8, NULL, qp_doq_stream_dtor, 0);
+    }
+    qp_doq_stream_t *st = zend_hash_index_find_ptr(&s->doq->streams, stream_id);
+    if (!st) {
+        st = ecalloc(1, sizeof(*st));
+        zend_hash_index_add_new_ptr(&s->doq->streams, stream_id, st);
+    }
+
+    bool fin = false;
+    for (;;) {
+        uint64_t ec = 0;
+        size_t want = st->in_len < 2 ? 2 - st->in_len : 2 + (size_t)(st->prefix[0] << 8 | st->prefix[1]) - st->in_len;
+        uint8_t *into = st->in_len < 2 ? st->prefix + st->in_len : st->query + (st->in_len - 2);
+        uint8_t extra;
+        if (st->out || (want == 0 && st->in_len >= 2)) {
+            into = &extra;              /* Anything past the message is an error */
+            want = 1;
+        }
+        ssize_t n = quiche_conn_stream_recv(s->conn, stream_id, into, want, &fin, &ec);
+        if (n == QUICHE_ERR_DONE) {
+            break;
+        }
+        if (n < 0) {
+            zend_hash_index_del(&s->doq->streams, stream_id);  /* Reset by the client */
+            return false;
+        }
+        if (into == &extra && n > 0) {
+            qp_doq_abort(s);
+            return true;
+        }
+        st->in_len += (size_t)n;
+        if (st->in_len == 2 && !st->query) {
+            st->query = emalloc(MAX((size_t)(st->prefix[0] << 8 | st->prefix[1]), 1));
+        }
+        if (fin) {
+            break;
+        }
+    }
+    if (!fin || st->out) {
+        return false;
+    }
+
+    size_t len = st->in_len >= 2 ? (size_t)(st->prefix[0] << 8 | st->prefix[1]) : 0;
+    if (st->in_len < 2 || st->in_len != 2 + len || len < 2 || st->query[0] != 0 || st->query[1] != 0) {
+        qp_doq_abort(s);
+        return true;
+    }
+    const quicpro_dns_source_t *src = qp_doq_source();
+    size_t answer = quicpro_dns_respond(src ? src->zone : NULL, src ? src->sd_table : NULL, st->query, len,
+                                        qp_doq_buf + 2, QUICPRO_DNS_TCP_MAX, false);
+    if (answer == 0) {
+        qp_doq_abort(s);                /* Not a query */
+        return true;
+    }
+    qp_doq_buf[0] = (uint8_t)(answer >> 8);
+    qp_doq_buf[1] = (uint8_t)answer;
+
+    /* Straight from the scratch buffer when it all fits, as it nearly always does */
+    bool wrote = false;
+    uint64_t ec = 0;
+    ssize_t n = quiche_conn_stream_send(s->conn, stream_id, qp_doq_buf, 2 + answer, true, &ec);
+    if (n > 0) {
+        wrote = true;
+    }
+    if (n == (ssize_t)(2 + answer) || (n < 0 && n != QUICHE_ERR_DONE)) {
+        zend_hash_index_del(&s->doq->streams, stream_id);
+        return wrote;
+    }
+    st->out_off = n > 0 ? (size_t)n : 0;
+    st->out_len = 2 + answer;
+    st->out = emalloc(st->out_len);
+    memcpy(st->out, qp_doq_buf, st->out_len);
+    return wrote;
+}
+
+bool quicpro_doq_flush(quicpro_session_t *s)
+{
+    zend_ulong id;
+    qp_doq_stream_t *st;
+    bool wrote = false;
+    if (!s->doq) {
+        return false;
+    }
+    ZEND_HASH_FOREACH_NUM_KEY_PTR(&s->doq->streams, id, st) {
+        if (st->out && qp_doq_send(s, id, st, &wrote)) {
+            zend_hash_index_del(&s->doq->streams, id);
+        }
+    } ZEND_HASH_FOREACH_END();
+    return wrote;
+}
+
+void quicpro_doq_tick(void)
+{
+    if (qp_doq_state > 0) {
+        quicpro_dns_source_tick(&qp_doq_src);
+    }
+}
+
+void quicpro_doq_conn_free(quicpro_doq_conn_t *c)
+{
+    if (!c) {
+        return;
+    }
+    zend_hash_destroy(&c->streams);
+    efree(c);
+}
+
+bool quicpro_doq_conn_idle(const quicpro_doq_conn_t *c)
+{
+    return zend_hash_num_elements(&c->streams) == 0;
+}
+
+void quicpro_doq_rshutdown(void)
+{
+    if (qp_doq_state > 0) {
+        quicpro_dns_source_close(&qp_doq_src);
+    }
+    qp_doq_state = 0;
+}
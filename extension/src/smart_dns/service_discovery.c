@@ -0,0 +1,583 @@
+/*
+ * src/smart_dns/service_discovery.c – Health-aware answers from the Cluster Health Agent
+ * ======================================================================================
+ *
+ * See include/smart_dns/service_discovery.h. Everything below the table
+ * pointer belongs to the feed thread and is plain malloc(): the thread
+ * never touches PHP.
+ */
+
+#include "php.h"
+#include "smart_dns/service_discovery.h"
+
+#include <arpa/inet.h>
+#include <curl/curl.h>
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define QP_SD_LINE_MAX      1024
+#define QP_SD_CONNECT_MS    2000
+#define QP_SD_SILENT_SEC    30          /* Three missed heartbeats */
+#define QP_SD_RETRY_MS      1000
+#define QP_SD_RR_A          16          /* Owner pointer, type, class, TTL, length, address */
+#define QP_SD_RR_AAAA       28
+
+typedef struct {
+    uint8_t  addr[16];
+    bool     v6;
+    double   load;
+    uint32_t epoch;                     /* Of the connection that last named it */
+} qp_sd_node_t;
+
+/* A service's answers. Once published it is never written again. */
+typedef struct qp_sd_answer {
+    uint64_t             last_gen;      /* Newest table holding it, once replaced */
+    struct qp_sd_answer *retired;
+    uint8_t              name[QUICPRO_DNS_NAME_MAX];
+    uint8_t              name_len;
+    uint16_t             a_count, aaaa_count;
+    uint32_t             a_len, aaaa_len;
+    uint8_t              data[];        /* The A section, then the AAAA section */
+} qp_sd_answer_t;
+
+struct quicpro_dns_sd_table_s {
+    uint64_t                       gen;
+    struct quicpro_dns_sd_table_s *retired;
+    unsigned                       count;
+    const qp_sd_answer_t          *answers[];   /* By name */
+};
+
+typedef struct {
+    uint8_t         name[QUICPRO_DNS_NAME_MAX];
+    uint8_t         name_len;
+    bool            dirty;
+    qp_sd_node_t   *nodes;
+    unsigned        count, cap;
+    qp_sd_answer_t *answer;             /* Published; NULL before the first table */
+} qp_sd_service_t;
+
+struct quicpro_dns_sd_s {
+    _Atomic(quicpro_dns_sd_table_t *) table;
+    _Atomic uint64_t     seen;          /* The DNS loop holds no table older than this */
+    atomic_bool          stopping;
+    pthread_t            thread;
+    bool                 started;
+    int                  wake;          /* eventfd */
+    /* The feed thread's own */
+    char                *url;
+    uint32_t             max_ips, ttl;
+    qp_sd_service_t    **services;      /* By name */
+    unsigned             count, cap;
+    uint32_t             epoch;
+    bool                 dirty;
+    char                 line[QP_SD_LINE_MAX];
+    size_t               line_len;
+    bool                 overlong;
+    uint64_t             gen;
+    quicpro_dns_sd_table_t *retired;
+    qp_sd_answer_t      *retired_answers;
+};
+
+static int qp_sd_name_cmp(const uint8_t *a, size_t a_len, const uint8_t *b, size_t b_len)
+{
+    int c = memcmp(a, b, MIN(a_len, b_len));
+    return c ? c : (int)a_len - (int)b_len;
+}
+
+/*──────────────────────────────── Answers ────────────────────────────────*/
+
+static int qp_sd_node_cmp(const void *a, const void *b)
+{
+    const qp_sd_node_t *x = a, *y = b;
+    if (x->load != y->load) {
+        return x->load < y->load ? -1 : 1;
+    }
+    return memcmp(x->addr, y->addr, sizeof(x->addr));   /* Servers seeing the same loads answer alike */
+}
+
+static uint8_t *qp_sd_put_rr(uint8_t *p, uint16_t type, uint32_t ttl, const uint8_t *addr, uint16_t addr_len)
+{
+    *p++ = 0xC0; *p++ = 0x0C;           /* The question's name */
+    *p++ = (uint8_t)(type >> 8); *p++ = (uint8_t)type;
+    *p++ = 0; *p++ = 1;                 /* IN */
+    *p++ = (uint8_t)(ttl >> 24); *p++ = (uint8_t)(ttl >> 16); *p++ = (uint8_t)(ttl >> 8); *p++ = (uint8_t)ttl;
+    *p++ = (uint8_t)(addr_len >> 8); *p++ = (uint8_t)addr_len;
+    memcpy(p, addr, addr_len);
+    return p + addr_len;
+}
+
+/* The answers for `s` as its nodes are now, least loaded first; NULL if out of memory */
+static qp_sd_answer_t *qp_sd_answer_build(const quicpro_dns_sd_t *sd, const qp_sd_service_t *s)
+{
+    qp_sd_node_t *order = malloc(s->count * sizeof(*order));
+    if (!order) {
+        return NULL;
+    }
+    memcpy(order, s->nodes, s->count * sizeof(*order));
+    qsort(order, s->count, sizeof(*order), qp_sd_node_cmp);
+
+    unsigned a = 0, aaaa = 0;
+    for (unsigned i = 0; i < s->count; i++) {
+        if (order[i].v6) aaaa += aaaa < sd->max_ips;
+        else a += a < sd->max_ips;
+    }
+    qp_sd_answer_t *ans = malloc(sizeof(*ans) + a * QP_SD_RR_A + aaaa * QP_SD_RR_AAAA);
+    if (!ans) {
+        free(order);
+        return NULL;
+    }
+    memcpy(ans->name, s->name, s->name_len);
+    ans->name_len = s->name_len;
+    ans->a_count = ans->aaaa_count = 0;
+    ans->a_len = a * QP_SD_RR_A;
+    ans->aaaa_len = aaaa * QP_SD_RR_AAAA;
+    ans->retired = NULL;
+    ans->last_gen = UINT64_MAX;
+    uint8_t *pa = ans->data, *p6 = ans->data + ans->a_len;
+    for (unsigned i = 0; i < s->count; i++) {
+        if (!order[i].v6 && ans->a_count < a) {
+            pa = qp_sd_put_rr(pa, QUICPRO_DNS_TYPE_A, sd->ttl, order[i].addr, 4);
+            ans->a_count++;
+        } else if (order[i].v6 && ans->aaaa_count < aaaa) {
+            p6 = qp_sd_put_rr(p6, QUICPRO_DNS_TYPE_AAAA, sd->ttl, order[i].addr, 16);
+            ans->aaaa_count++;
+        }
+    }
+    free(order);
+    return ans;
+}
+
+/* Frees the retired tables and answers the DNS loop has moved past */
+static void qp_sd_reclaim(quicpro_dns_sd_t *sd)
+{
+    uint64_t seen = atomic_load_explicit(&sd->seen, memory_order_acquire);
+    quicpro_dns_sd_table_t **link = &sd->retired;
+    while (*link) {
+        quicpro_dns_sd_table_t *t = *link;
+        if (t->gen < seen) {
+            *link = t->retired;
+            free(t);
+        } else {
+            link = &t->retired;
+        }
+    }
+    qp_sd_answer_t **alink = &sd->retired_answers;
+    while (*alink) {
+        qp_sd_answer_t *a = *alink;
+        if (a->last_gen < seen) {
+            *alink = a->retired;
+            free(a);
+        } else {
+            alink = &a->retired;
+        }
+    }
+}
+
+/*
+ * Rebuilds the answers of the services a delta touched, drops the ones
+ * left without nodes, and swaps in a table over the result. What cannot
+ * be built for want of memory keeps its previous answers and stays dirty.
+ */
+static void qp_sd_publish(quicpro_dns_sd_t *sd)
+{
+    quicpro_dns_sd_table_t *t = malloc(sizeof(*t) + sd->count * sizeof(t->answers[0]));
+    if (!t) {
+        return;
+    }
+    sd->dirty = false;
+    unsigned kept = 0;
+    t->count = 0;
+    for (unsigned i = 0; i < sd->count; i++) {
+        qp_sd_service_t *s = sd->services[i];
+        if (s->dirty) {
+            qp_sd_answer_t *ans = s->count ? qp_sd_answer_build(sd, s) : NULL;
+            if (ans || !s->count) {
+                if (s->answer) {
+                    s->answer->last_gen = sd->gen;
+                    s->answer->retired = sd->retired_answers;
+                    sd->retired_answers = s->answer;
+                }
+                s->answer = ans;
+                s->dirty = false;
+            } else {
+                sd->dirty = true;
+            }
+        }
+        if (!s->count && !s->dirty) {
+            free(s->nodes);
+            free(s);
+            continue;
+        }
+        sd->services[kept++] = s;
+        if (s->answer) {
+            t->answers[t->count++] = s->answer;
+        }
+    }
+    sd->count = kept;
+
+    t->gen = ++sd->gen;
+    t->retired = NULL;
+    quicpro_dns_sd_table_t *old = atomic_exchange_explicit(&sd->table, t, memory_order_acq_rel);
+    if (old) {
+        old->retired = sd->retired;
+        sd->retired = old;
+    }
+    qp_sd_reclaim(sd);
+}
+
+/*───────────────────────────────── Feed ──────────────────────────────────*/
+
+/* "api.example.com" to lower-case wire format; 0 if it is not a name */
+static size_t qp_sd_wire(const char *s, uint8_t *out)
+{
+    size_t n = 0;
+    if (s[0] == '.' && s[1] == '\0') {
+        s++;
+    }
+    while (*s) {
+        size_t l = strcspn(s, ".");
+        if (l == 0 || l > 63 || n + 1 + l + 1 > QUICPRO_DNS_NAME_MAX) {
+            return 0;
+        }
+        out[n++] = (uint8_t)l;
+        for (size_t i = 0; i < l; i++) {
+            char c = s[i];
+            out[n++] = (uint8_t)(c >= 'A' && c <= 'Z' ? c | 0x20 : c);
+        }
+        s += l;
+        if (*s == '.') s++;
+    }
+    out[n++] = 0;
+    return n;
+}
+
+/* The position of `name` among the services, or where it would go */
+static unsigned qp_sd_find(const quicpro_dns_sd_t *sd, const uint8_t *name, size_t len, bool *found)
+{
+    unsigned lo = 0, hi = sd->count;
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+        int c = qp_sd_name_cmp(sd->services[mid]->name, sd->services[mid]->name_len, name, len);
+        if (c == 0) {
+            *found = true;
+            return mid;
+        }
+        if (c < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    *found = false;
+    return lo;
+}
+
+static qp_sd_service_t *qp_sd_service(quicpro_dns_sd_t *sd, const uint8_t *name, size_t len, bool create)
+{
+    bool found;
+    unsigned at = qp_sd_find(sd, name, len, &found);
+    if (found || !create) {
+        return found ? sd->services[at] : NULL;
+    }
+    if (sd->count == sd->cap) {
+        unsigned cap = sd->cap ? sd->cap * 2 : 64;
+        qp_sd_service_t **grown = realloc(sd->services, cap * sizeof(*grown));
+        if (!grown) {
+            return NULL;
+        }
+        sd->services = grown;
+        sd->cap = cap;
+    }
+    qp_sd_service_t *s = calloc(1, sizeof(*s));
+    if (!s) {
+        return NULL;
+    }
+    memcpy(s->name, name, len);
+    s->name_len = (uint8_t)len;
+    memmove(sd->services + at + 1, sd->services + at, (sd->count - at) * sizeof(*sd->services));
+    sd->services[at] = s;
+    sd->count++;
+    return s;
+}
+
+/* Drops the nodes the agent did not name again since it reconnected */
+static void qp_sd_sync(quicpro_dns_sd_t *sd)
+{
+    for (unsigned i = 0; i < sd->count; i++) {
+        qp_sd_service_t *s = sd->services[i];
+        unsigned kept = 0;
+        for (unsigned j = 0; j < s->count; j++) {
+            if (s->nodes[j].epoch == sd->epoch) {
+                s->nodes[kept++] = s->nodes[j];
+            }
+        }
+        if (kept != s->count) {
+            s->count = kept;
+            s->dirty = sd->dirty = true;
+        }
+    }
+}
+
+/* One line of the stream; lines that do not parse are skipped */
+static void qp_sd_line(quicpro_dns_sd_t *sd, char *line)
+{
+    char *save, *name_s = strtok_r(line, " \t", &save), *ip_s = strtok_r(NULL, " \t", &save);
+    char *load_s = strtok_r(NULL, " \t", &save);
+    if (!name_s) {
+        return;                         /* Heartbeat */
+    }
+    if (!ip_s && strcmp(name_s, "sync") == 0) {
+        qp_sd_sync(sd);
+        return;
+    }
+
+    uint8_t name[QUICPRO_DNS_NAME_MAX];
+    qp_sd_node_t node = { .epoch = sd->epoch };
+    size_t name_len = qp_sd_wire(name_s, name);
+    if (!name_len || !ip_s || !load_s) {
+        return;
+    }
+    if (inet_pton(AF_INET, ip_s, node.addr) != 1) {
+        if (inet_pton(AF_INET6, ip_s, node.addr) != 1) {
+            return;
+        }
+        node.v6 = true;
+    }
+    bool down = strcmp(load_s, "down") == 0;
+    if (!down) {
+        char *end;
+        node.load = strtod(load_s, &end);
+        if (*end || !isfinite(node.load)) {
+            return;
+        }
+    }
+
+    qp_sd_service_t *s = qp_sd_service(sd, name, name_len, !down);
+    if (!s) {
+        return;
+    }
+    for (unsigned i = 0; i < s->count; i++) {
+        qp_sd_node_t *o = &s->nodes[i];
+        if (o->v6 != node.v6 || memcmp(o->addr, node.addr, sizeof(node.addr)) != 0) {
+            continue;
+        }
+        if (down) {
+            *o = s->nodes[--s->count];
+            s->dirty = sd->dirty = true;
+        } else {
+            s->dirty |= o->load != node.load;
+            sd->dirty |= s->dirty;
+            *o = node;
+        }
+        return;
+    }
+    if (down) {
+        return;
+    }
+    if (s->count == s->cap) {
+        unsigned cap = s->cap ? s->cap * 2 : 8;
+        qp_sd_node_t *grown = realloc(s->nodes, cap * sizeof(*grown));
+        if (!grown) {
+            return;
+        }
+        s->nodes = grown;
+        s->cap = cap;
+    }
+    s->nodes[s->count++] = node;
+    s->dirty = sd->dirty = true;
+}
+
+/* A chunk of the stream is one delta: its lines are applied, then published together */
+static size_t qp_sd_write(char *data, size_t size, size_t n, void *ud)
+{
+    quicpro_dns_sd_t *sd = ud;
+    size_t len = size * n;
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+        if (c == '\n') {
+            if (!sd->overlong) {
+                sd->line[sd->line_len] = '\0';
+                qp_sd_line(sd, sd->line);
+            }
+            sd->line_len = 0;
+            sd->overlong = false;
+        } else if (c != '\r') {
+            if (sd->line_len + 1 < sizeof(sd->line)) {
+                sd->line[sd->line_len++] = c;
+            } else {
+                sd->overlong = true;
+            }
+        }
+    }
+    if (sd->dirty) {
+        qp_sd_publish(sd);
+    }
+    return len;
+}
+
+/* libcurl calls this at least once a second: a way out of the open request */
+static int qp_sd_progress(void *ud, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+{
+    quicpro_dns_sd_t *sd = ud;
+    (void)dltotal; (void)dlnow; (void)ultotal; (void)ulnow;
+    if (sd->retired || sd->retired_answers) {
+        qp_sd_reclaim(sd);
+    }
+    return atomic_load_explicit(&sd->stopping, memory_order_acquire) ? 1 : 0;
+}
+
+/* Keeps the stream open, reconnecting after a pause, until stopped. Never touches PHP. */
+static void *qp_sd_feed_main(void *arg)
+{
+    quicpro_dns_sd_t *sd = arg;
+    CURL *curl = curl_easy_init();
+    if (curl) {
+        curl_easy_setopt(curl, CURLOPT_URL, sd->url);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, (long)QP_SD_CONNECT_MS);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)QP_SD_SILENT_SEC);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, qp_sd_write);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, sd);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, qp_sd_progress);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, sd);
+    }
+    while (!atomic_load_explicit(&sd->stopping, memory_order_acquire)) {
+        if (curl) {
+            sd->epoch++;
+            sd->line_len = 0;
+            sd->overlong = false;
+            curl_easy_perform(curl);    /* Returns only when the stream breaks off */
+        }
+        struct pollfd pfd = { .fd = sd->wake, .events = POLLIN };
+        poll(&pfd, 1, QP_SD_RETRY_MS);
+        qp_sd_reclaim(sd);
+    }
+    if (curl) {
+        curl_easy_cleanup(curl);
+    }
+    return NULL;
+}
+
+/*──────────────────────────────── Public ─────────────────────────────────*/
+
+quicpro_dns_sd_t *quicpro_dns_sd_start(const char *endpoint, uint32_t max_ips, uint32_t ttl, char *err, size_t err_len)
+{
+    quicpro_dns_sd_t *sd = calloc(1, sizeof(*sd));
+    if (!sd) {
+        snprintf(err, err_len, "out of memory");
+        return NULL;
+    }
+    sd->wake = -1;
+    sd->max_ips = MAX(max_ips, 1);
+    sd->ttl = ttl;
+    size_t len = strlen(endpoint) + sizeof("http:///health/stream");
+    sd->url = malloc(len);
+    if (!sd->url || curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+        snprintf(err, err_len, "could not set up the health feed");
+        quicpro_dns_sd_stop(sd);
+        return NULL;
+    }
+    snprintf(sd->url, len, "%s%s/health/stream", strstr(endpoint, "://") ? "" : "http://", endpoint);
+
+    /* An empty table goes out before the thread exists, so there always is one */
+    qp_sd_publish(sd);
+    sd->wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (!atomic_load_explicit(&sd->table, memory_order_relaxed) || sd->wake < 0) {
+        snprintf(err, err_len, "could not set up the health table: %s", strerror(errno));
+        quicpro_dns_sd_stop(sd);
+        return NULL;
+    }
+    if (pthread_create(&sd->thread, NULL, qp_sd_feed_main, sd) != 0) {
+        snprintf(err, err_len, "could not start the health feed thread");
+        quicpro_dns_sd_stop(sd);
+        return NULL;
+    }
+    sd->started = true;
+    return sd;
+}
+
+const quicpro_dns_sd_table_t *quicpro_dns_sd_acquire(quicpro_dns_sd_t *sd)
+{
+    quicpro_dns_sd_table_t *t = atomic_load_explicit(&sd->table, memory_order_acquire);
+    atomic_store_explicit(&sd->seen, t->gen, memory_order_release);
+    return t;
+}
+
+bool quicpro_dns_sd_lookup(const quicpro_dns_sd_table_t *t, const uint8_t *name, size_t len, uint16_t qtype,
+                           quicpro_dns_answer_t *out)
+{
+    if (!t) {
+        return false;
+    }
+    unsigned lo = 0, hi = t->count;
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+        const qp_sd_answer_t *a = t->answers[mid];
+        int c = qp_sd_name_cmp(a->name, a->name_len, name, len);
+        if (c < 0) {
+            lo = mid + 1;
+        } else if (c > 0) {
+            hi = mid;
+        } else {
+            /* Other types get an empty answer: the agent knows the name, and nothing else of it */
+            *out = (quicpro_dns_answer_t){ .rcode = QUICPRO_DNS_RCODE_NOERROR, .authoritative = true };
+            if (qtype == QUICPRO_DNS_TYPE_A || qtype == QUICPRO_DNS_TYPE_ANY) {
+                out->answer = a->data;
+                out->answer_len = a->a_len;
+                out->answer_count = a->a_count;
+            }
+            if (qtype == QUICPRO_DNS_TYPE_AAAA || qtype == QUICPRO_DNS_TYPE_ANY) {
+                out->answer = out->answer ? out->answer : a->data + a->a_len;
+                out->answer_len += a->aaaa_len;
+                out->answer_count += a->aaaa_count;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void quicpro_dns_sd_stop(quicpro_dns_sd_t *sd)
+{
+    if (!sd) {
+        return;
+    }
+    if (sd->started) {
+        uint64_t one = 1;
+        atomic_store_explicit(&sd->stopping, true, memory_order_release);
+        (void)!write(sd->wake, &one, sizeof(one));
+        pthread_join(sd->thread, NULL);
+    }
+    quicpro_dns_sd_table_t *t = atomic_load_explicit(&sd->table, memory_order_relaxed);
+    if (t) {
+        t->retired = sd->retired;
+        sd->retired = t;
+    }
+    while (sd->retired) {
+        t = sd->retired;
+        sd->retired = t->retired;
+        free(t);
+    }
+    while (sd->retired_answers) {
+        qp_sd_answer_t *a = sd->retired_answers;
+        sd->retired_answers = a->retired;
+        free(a);
+    }
+    for (unsigned i = 0; i < sd->count; i++) {
+        free(sd->services[i]->answer);
+        free(sd->services[i]->nodes);
+        free(sd->services[i]);
+    }
+    free(sd->services);
+    if (sd->wake >= 0) close(sd->wake);
+    free(sd->url);
+    free(sd);
+}
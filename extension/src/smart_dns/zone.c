@@ -0,0 +1,1184 @@
+/*
+ * src/smart_dns/zone.c – Zone file compiler and index lookups
+ * ===========================================================
+ *
+ * See include/smart_dns/zone.h. The compiler parses the zone file into
+ * records, hangs them on a tree keyed by owner name, lays the tree out
+ * breadth first (so that siblings are contiguous) and writes every
+ * section of the image in one pass over the laid-out nodes.
+ */
+
+#include "smart_dns/zone.h"
+
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config/smart_dns/base_layer.h"
+
+#define QP_DZ_MAGIC         0x315a5051u     /* "QPZ1" */
+#define QP_DZ_VERSION       1
+#define QP_DZ_NONE          UINT32_MAX
+#define QP_DZ_MAX_LABELS    128
+#define QP_DZ_MAX_TOKENS    256
+
+#define QP_DZ_APEX          0x0001          /* Has the zone's SOA */
+#define QP_DZ_DELEGATION    0x0002          /* NS below an apex: answers are referrals */
+
+/*────────────────────────────── Image layout ─────────────────────────────*/
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int64_t  src_mtime_sec;         /* The zone file compiled */
+    int64_t  src_mtime_nsec;
+    uint64_t src_size;
+    uint32_t default_ttl;
+    uint32_t nnodes;
+    uint32_t nrrsets;
+    uint32_t nodes_off;             /* Offsets from the start of the image */
+    uint32_t rrsets_off;
+    uint32_t labels_off;
+    uint32_t blobs_off;
+    uint32_t size;
+} qp_dz_header_t;
+
+typedef struct {
+    uint32_t label;                 /* Offset in labels: the length byte, then the label */
+    uint32_t child;                 /* Index of the first child; children are sorted */
+    uint32_t nchild;
+    uint32_t wildcard;              /* Index of the "*" child, or QP_DZ_NONE */
+    uint32_t rrset;                 /* Index of the first RRset */
+    uint16_t nrrset;
+    uint16_t flags;
+    uint32_t auth;                  /* Offset in blobs: the SOA of an apex, the NS set of a delegation */
+    uint32_t auth_len;
+    uint32_t glue;                  /* Offset in blobs: a delegation's glue records */
+    uint32_t glue_len;
+    uint16_t auth_count;
+    uint16_t glue_count;
+} qp_dz_node_t;
+
+typedef struct {
+    uint16_t type;
+    uint16_t count;
+    uint32_t off;                   /* Offset in blobs of the answer RRs */
+    uint32_t len;
+} qp_dz_rrset_t;
+
+struct quicpro_dns_zone_s {
+    const uint8_t       *base;
+    size_t               size;
+    bool                 mapped;
+    char                *zone_file;
+    const qp_dz_header_t *h;
+    const qp_dz_node_t  *nodes;
+    const qp_dz_rrset_t *rrsets;
+    const uint8_t       *labels;
+    const uint8_t       *blobs;
+    uint32_t             labels_len, blobs_len;
+};
+
+/*──────────────────────────────── Parsing ────────────────────────────────*/
+
+typedef struct {
+    uint8_t      name[QUICPRO_DNS_NAME_MAX];
+    uint8_t      name_len;
+    uint16_t     type;
+    uint32_t     ttl;
+    uint32_t     line;
+    zend_string *rdata;
+} qp_dz_rec_t;
+
+typedef struct {
+    const char *s;
+    size_t      len;
+    bool        quoted;
+} qp_dz_tok_t;
+
+typedef struct {
+    const char  *p, *end;
+    uint32_t     line;              /* Of the entry being read */
+    uint32_t     next_line;
+    char        *err;
+    size_t       err_len;
+    uint8_t      origin[QUICPRO_DNS_NAME_MAX];
+    size_t       origin_len;        /* 0: no $ORIGIN yet */
+    uint8_t      owner[QUICPRO_DNS_NAME_MAX];
+    size_t       owner_len;         /* 0: no owner yet */
+    uint32_t     ttl;
+    qp_dz_rec_t *recs;
+    uint32_t     nrecs, cap;
+} qp_dz_parser_t;
+
+static bool qp_dz_fail(qp_dz_parser_t *P, const char *fmt, ...)
+{
+    char msg[192];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    snprintf(P->err, P->err_len, "line %u: %s", P->line, msg);
+    return false;
+}
+
+/*
+ * The tokens of the next entry: one line, or more inside parentheses.
+ * `*indented` tells whether it began with blanks (no owner). Returns the
+ * token count, 0 for an empty line, -1 at the end of the file or on error.
+ */
+static int qp_dz_entry(qp_dz_parser_t *P, qp_dz_tok_t *tok, bool *indented)
+{
+    int n = 0, depth = 0;
+
+    if (P->p >= P->end) {
+        return -1;
+    }
+    P->line = P->next_line;
+    *indented = *P->p == ' ' || *P->p == '\t';
+    while (P->p < P->end) {
+        char c = *P->p;
+        if (c == '\n') {
+            P->p++;
+            P->next_line++;
+            if (depth == 0) {
+                return n;
+            }
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == '\r') {
+            P->p++;
+            continue;
+        }
+        if (c == ';') {
+            while (P->p < P->end && *P->p != '\n') P->p++;
+            continue;
+        }
+        if (c == '(' || c == ')') {
+            depth += c == '(' ? 1 : -1;
+            if (depth < 0) {
+                qp_dz_fail(P, "unbalanced ')'");
+                return -1;
+            }
+            P->p++;
+            continue;
+        }
+        if (n == QP_DZ_MAX_TOKENS) {
+            qp_dz_fail(P, "too many fields");
+            return -1;
+        }
+        if (c == '"') {
+            const char *s = ++P->p;
+            while (P->p < P->end && *P->p != '"') {
+                if (*P->p == '\\' && P->p + 1 < P->end) P->p++;
+                if (*P->p == '\n') P->next_line++;
+                P->p++;
+            }
+            if (P->p >= P->end) {
+                qp_dz_fail(P, "unterminated string");
+                return -1;
+            }
+            tok[n++] = (qp_dz_tok_t){ s, (size_t)(P->p - s), true };
+            P->p++;
+        } else {
+            const char *s = P->p;
+            while (P->p < P->end && !strchr(" \t\r\n;()\"", *P->p)) {
+                if (*P->p == '\\' && P->p + 1 < P->end) P->p++;
+                P->p++;
+            }
+            tok[n++] = (qp_dz_tok_t){ s, (size_t)(P->p - s), false };
+        }
+    }
+    if (depth) {
+        qp_dz_fail(P, "unbalanced '('");
+        return -1;
+    }
+    return n;
+}
+
+static bool qp_dz_tok_is(const qp_dz_tok_t *t, const char *word)
+{
+    return !t->quoted && strlen(word) == t->len && strncasecmp(t->s, word, t->len) == 0;
+}
+
+/* A number of seconds: "3600", or units as in "1h30m" */
+static bool qp_dz_ttl(const qp_dz_tok_t *t, uint32_t *out)
+{
+    uint64_t total = 0, n = 0;
+    bool digits = false;
+    if (t->quoted || t->len == 0 || !isdigit((unsigned char)t->s[0])) {
+        return false;
+    }
+    for (size_t i = 0; i < t->len; i++) {
+        char c = (char)tolower((unsigned char)t->s[i]);
+        if (isdigit((unsigned char)c)) {
+            n = n * 10 + (uint64_t)(c - '0');
+            digits = true;
+        } else {
+            uint64_t unit = c == 's' ? 1 : c == 'm' ? 60 : c == 'h' ? 3600 : c == 'd' ? 86400 : c == 'w' ? 604800 : 0;
+            if (!unit || !digits) {
+                return false;
+            }
+            total += n * unit;
+            n = 0;
+            digits = false;
+        }
+        if (n > UINT32_MAX || total > UINT32_MAX) {
+            return false;
+        }
+    }
+    total += n;
+    if (total > INT32_MAX) {
+        return false;   /* RFC 2181 §8 */
+    }
+    *out = (uint32_t)total;
+    return true;
+}
+
+static bool qp_dz_u16(const qp_dz_tok_t *t, uint16_t *out)
+{
+    uint32_t v = 0;
+    if (t->quoted || t->len == 0 || t->len > 5) {
+        return false;
+    }
+    for (size_t i = 0; i < t->len; i++) {
+        if (!isdigit((unsigned char)t->s[i])) {
+            return false;
+        }
+        v = v * 10 + (uint32_t)(t->s[i] - '0');
+    }
+    if (v > UINT16_MAX) {
+        return false;
+    }
+    *out = (uint16_t)v;
+    return true;
+}
+
+/* A domain name in wire format, lower case; "@" and relative names use $ORIGIN */
+static bool qp_dz_name(qp_dz_parser_t *P, const qp_dz_tok_t *t, uint8_t *out, size_t *out_len)
+{
+    size_t i = 0, o = 0;
+
+    if (t->quoted || t->len == 0) {
+        return qp_dz_fail(P, "expected a domain name");
+    }
+    if (t->len == 1 && t->s[0] == '@') {
+        if (!P->origin_len) {
+            return qp_dz_fail(P, "'@' before any $ORIGIN");
+        }
+        memcpy(out, P->origin, P->origin_len);
+        *out_len = P->origin_len;
+        return true;
+    }
+    if (t->len == 1 && t->s[0] == '.') {
+        out[0] = 0;
+        *out_len = 1;
+        return true;
+    }
+    while (i < t->len) {
+        size_t at = o++;
+        uint8_t n = 0;
+        while (i < t->len && t->s[i] != '.') {
+            char c = t->s[i++];
+            if (c == '\\' && i < t->len) {
+                c = t->s[i++];
+            }
+            if (n == 63 || o >= QUICPRO_DNS_NAME_MAX - 1) {
+                return qp_dz_fail(P, "name \"%.*s\" too long", (int)t->len, t->s);
+            }
+            out[o++] = (uint8_t)tolower((unsigned char)c);
+            n++;
+        }
+        if (n == 0) {
+            return qp_dz_fail(P, "empty label in \"%.*s\"", (int)t->len, t->s);
+        }
+        out[at] = n;
+        if (i < t->len) {
+            i++;                        /* The dot */
+            if (i == t->len) {
+                out[o++] = 0;           /* Absolute */
+                *out_len = o;
+                return true;
+            }
+        }
+    }
+    if (!P->origin_len) {
+        return qp_dz_fail(P, "relative name \"%.*s\" before any $ORIGIN", (int)t->len, t->s);
+    }
+    if (o + P->origin_len > QUICPRO_DNS_NAME_MAX) {
+        return qp_dz_fail(P, "name \"%.*s\" too long", (int)t->len, t->s);
+    }
+    memcpy(out + o, P->origin, P->origin_len);
+    *out_len = o + P->origin_len;
+    return true;
+}
+
+static void qp_dz_put16(smart_str *s, uint16_t v)
+{
+    uint8_t b[2] = { (uint8_t)(v >> 8), (uint8_t)v };
+    smart_str_appendl(s, (const char *)b, 2);
+}
+
+static void qp_dz_put32(smart_str *s, uint32_t v)
+{
+    uint8_t b[4] = { (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v };
+    smart_str_appendl(s, (const char *)b, 4);
+}
+
+static bool qp_dz_put_name(qp_dz_parser_t *P, smart_str *s, const qp_dz_tok_t *t)
+{
+    uint8_t name[QUICPRO_DNS_NAME_MAX];
+    size_t len;
+    if (!qp_dz_name(P, t, name, &len)) {
+        return false;
+    }
+    smart_str_appendl(s, (const char *)name, len);
+    return true;
+}
+
+/* A <character-string>: \X and \DDD escapes, at most 255 bytes */
+static bool qp_dz_put_string(qp_dz_parser_t *P, smart_str *s, const qp_dz_tok_t *t)
+{
+    uint8_t buf[255];
+    size_t n = 0;
+    for (size_t i = 0; i < t->len; i++) {
+        uint8_t c = (uint8_t)t->s[i];
+        if (c == '\\' && i + 1 < t->len) {
+            if (i + 3 < t->len && isdigit((unsigned char)t->s[i + 1]) && isdigit((unsigned char)t->s[i + 2])
+                && isdigit((unsigned char)t->s[i + 3])) {
+                int v = (t->s[i + 1] - '0') * 100 + (t->s[i + 2] - '0') * 10 + (t->s[i + 3] - '0');
+                if (v > 255) {
+                    return qp_dz_fail(P, "bad escape in string");
+                }
+                c = (uint8_t)v;
+                i += 3;
+            } else {
+                c = (uint8_t)t->s[++i];
+            }
+        }
+        if (n == sizeof(buf)) {
+            return qp_dz_fail(P, "string longer than 255 bytes");
+        }
+        buf[n++] = c;
+    }
+    smart_str_appendc(s, (char)n);
+    smart_str_appendl(s, (const char *)buf, n);
+    return true;
+}
+
+/* The RDATA of `type` from the entry's remaining tokens */
+static bool qp_dz_rdata(qp_dz_parser_t *P, uint16_t type, const qp_dz_tok_t *t, int n, smart_str *rd)
+{
+    uint8_t addr[16];
+    uint16_t v[3];
+    uint32_t u[5];
+
+    switch (type) {
+        case QUICPRO_DNS_TYPE_A:
+        case QUICPRO_DNS_TYPE_AAAA: {
+            char text[INET6_ADDRSTRLEN];
+            int af = type == QUICPRO_DNS_TYPE_A ? AF_INET : AF_INET6;
+            if (n != 1 || t[0].len >= sizeof(text)) {
+                return qp_dz_fail(P, "expected one address");
+            }
+            memcpy(text, t[0].s, t[0].len);
+            text[t[0].len] = '\0';
+            if (inet_pton(af, text, addr) != 1) {
+                return qp_dz_fail(P, "bad address \"%s\"", text);
+            }
+            smart_str_appendl(rd, (const char *)addr, af == AF_INET ? 4 : 16);
+            return true;
+        }
+        case QUICPRO_DNS_TYPE_NS:
+        case QUICPRO_DNS_TYPE_CNAME:
+        case QUICPRO_DNS_TYPE_PTR:
+            if (n != 1) {
+                return qp_dz_fail(P, "expected one name");
+            }
+            return qp_dz_put_name(P, rd, &t[0]);
+        case QUICPRO_DNS_TYPE_MX:
+            if (n != 2 || !qp_dz_u16(&t[0], &v[0])) {
+                return qp_dz_fail(P, "expected a preference and a name");
+            }
+            qp_dz_put16(rd, v[0]);
+            return qp_dz_put_name(P, rd, &t[1]);
+        case QUICPRO_DNS_TYPE_SRV:
+            if (n != 4 || !qp_dz_u16(&t[0], &v[0]) || !qp_dz_u16(&t[1], &v[1]) || !qp_dz_u16(&t[2], &v[2])) {
+                return qp_dz_fail(P, "expected priority, weight, port and target");
+            }
+            for (int i = 0; i < 3; i++) qp_dz_put16(rd, v[i]);
+            return qp_dz_put_name(P, rd, &t[3]);
+        case QUICPRO_DNS_TYPE_TXT:
+            if (n < 1) {
+                return qp_dz_fail(P, "expected a string");
+            }
+            for (int i = 0; i < n; i++) {
+                if (!qp_dz_put_string(P, rd, &t[i])) {
+                    return false;
+                }
+            }
+            return true;
+        case QUICPRO_DNS_TYPE_SOA:
+            if (n != 7) {
+                return qp_dz_fail(P, "expected mname, rname, serial, refresh, retry, expire and minimum");
+            }
+            if (!qp_dz_put_name(P, rd, &t[0]) || !qp_dz_put_name(P, rd, &t[1])) {
+                return false;
+            }
+            for (int i = 0; i < 5; i++) {
+                if (!qp_dz_ttl(&t[2 + i], &u[i])) {
+                    return qp_dz_fail(P, "bad SOA number \"%.*s\"", (int)t[2 + i].len, t[2 + i].s);
+                }
+                qp_dz_put32(rd, u[i]);
+            }
+            return true;
+    }
+    return false;
+}
+
+static uint16_t qp_dz_type(const qp_dz_tok_t *t)
+{
+    static const struct { const char *name; uint16_t type; } types[] = {
+        { "A", QUICPRO_DNS_TYPE_A }, { "AAAA", QUICPRO_DNS_TYPE_AAAA }, { "NS", QUICPRO_DNS_TYPE_NS },
+        { "CNAME", QUICPRO_DNS_TYPE_CNAME }, { "PTR", QUICPRO_DNS_TYPE_PTR }, { "MX", QUICPRO_DNS_TYPE_MX },
+        { "SRV", QUICPRO_DNS_TYPE_SRV }, { "TXT", QUICPRO_DNS_TYPE_TXT }, { "SOA", QUICPRO_DNS_TYPE_SOA },
+    };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (qp_dz_tok_is(t, types[i].name)) {
+            return types[i].type;
+        }
+    }
+    return 0;
+}
+
+static bool qp_dz_parse(qp_dz_parser_t *P)
+{
+    qp_dz_tok_t *tok = safe_emalloc(QP_DZ_MAX_TOKENS, sizeof(*tok), 0);
+    bool indented, ok = true;
+    int n;
+
+    while (ok && (n = qp_dz_entry(P, tok, &indented)) >= 0) {
+        int i = 0;
+        if (n == 0) {
+            continue;
+        }
+        if (!indented && tok[0].len && tok[0].s[0] == '$') {
+            if (qp_dz_tok_is(&tok[0], "$ORIGIN") && n == 2) {
+                uint8_t origin[QUICPRO_DNS_NAME_MAX];
+                size_t len;
+                if (!(tok[1].len && tok[1].s[tok[1].len - 1] == '.') && !P->origin_len) {
+                    ok = qp_dz_fail(P, "the first $ORIGIN must be absolute");
+                } else if ((ok = qp_dz_name(P, &tok[1], origin, &len))) {
+                    memcpy(P->origin, origin, len);
+                    P->origin_len = len;
+                }
+            } else if (qp_dz_tok_is(&tok[0], "$TTL") && n == 2) {
+                if (!qp_dz_ttl(&tok[1], &P->ttl)) {
+                    ok = qp_dz_fail(P, "bad $TTL");
+                }
+            } else {
+                ok = qp_dz_fail(P, "unsupported directive \"%.*s\"", (int)tok[0].len, tok[0].s);
+            }
+            continue;
+        }
+
+        qp_dz_rec_t rec = { .line = P->line, .ttl = P->ttl };
+        if (!indented) {
+            size_t len;
+            if (!(ok = qp_dz_name(P, &tok[i++], rec.name, &len))) {
+                break;
+            }
+            memcpy(P->owner, rec.name, len);
+            P->owner_len = len;
+        } else if (!P->owner_len) {
+            ok = qp_dz_fail(P, "record without an owner");
+            break;
+        }
+        memcpy(rec.name, P->owner, P->owner_len);
+        rec.name_len = (uint8_t)P->owner_len;
+
+        /* [ttl] [class] in either order */
+        for (int k = 0; k < 2 && i < n; k++) {
+            if (qp_dz_ttl(&tok[i], &rec.ttl)) {
+                i++;
+            } else if (qp_dz_tok_is(&tok[i], "IN")) {
+                i++;
+            } else if (qp_dz_tok_is(&tok[i], "CH") || qp_dz_tok_is(&tok[i], "HS")) {
+                ok = qp_dz_fail(P, "only class IN is served");
+                break;
+            }
+        }
+        if (!ok) {
+            break;
+        }
+        if (i >= n) {
+            ok = qp_dz_fail(P, "missing record type");
+            break;
+        }
+        if (!(rec.type = qp_dz_type(&tok[i]))) {
+            ok = qp_dz_fail(P, "unsupported record type \"%.*s\"", (int)tok[i].len, tok[i].s);
+            break;
+        }
+        i++;
+
+        smart_str rd = {0};
+        if (!(ok = qp_dz_rdata(P, rec.type, tok + i, n - i, &rd))) {
+            smart_str_free(&rd);
+            break;
+        }
+        if (!rd.s || ZSTR_LEN(rd.s) > UINT16_MAX) {
+            smart_str_free(&rd);
+            ok = qp_dz_fail(P, "record data too long");
+            break;
+        }
+        smart_str_0(&rd);
+        rec.rdata = rd.s;
+        if (P->nrecs == P->cap) {
+            P->cap = P->cap ? P->cap * 2 : 256;
+            P->recs = safe_erealloc(P->recs, P->cap, sizeof(*P->recs), 0);
+        }
+        P->recs[P->nrecs++] = rec;
+    }
+    efree(tok);
+    return ok && P->err[0] == '\0';
+}
+
+/*──────────────────────────────── Building ───────────────────────────────*/
+
+typedef struct {
+    const uint8_t *name;            /* Points into a record or the parent's name */
+    uint8_t        name_len;
+    uint32_t       parent;
+    uint32_t      *recs, nrecs, rcap;
+    uint32_t      *kids, nkids, kcap;
+    uint32_t       index;           /* In the image */
+    bool           in_zone;
+} qp_dz_tnode_t;
+
+typedef struct {
+    qp_dz_tnode_t *t;
+    uint32_t       n, cap;
+    HashTable      by_name;         /* Wire name → tree node index */
+} qp_dz_tree_t;
+
+static void qp_dz_push(uint32_t **a, uint32_t *n, uint32_t *cap, uint32_t v)
+{
+    if (*n == *cap) {
+        *cap = *cap ? *cap * 2 : 4;
+        *a = safe_erealloc(*a, *cap, sizeof(**a), 0);
+    }
+    (*a)[(*n)++] = v;
+}
+
+/* The node of `name`, with its ancestors created as needed */
+static uint32_t qp_dz_node(qp_dz_tree_t *T, const uint8_t *name, uint8_t len)
+{
+    zval *zv = zend_hash_str_find(&T->by_name, (const char *)name, len);
+    if (zv) {
+        return (uint32_t)Z_LVAL_P(zv);
+    }
+    uint32_t parent = len > 1 ? qp_dz_node(T, name + 1 + name[0], (uint8_t)(len - 1 - name[0])) : QP_DZ_NONE;
+    if (T->n == T->cap) {
+        T->cap = T->cap ? T->cap * 2 : 256;
+        T->t = safe_erealloc(T->t, T->cap, sizeof(*T->t), 0);
+    }
+    uint32_t id = T->n++;
+    T->t[id] = (qp_dz_tnode_t){ .name = name, .name_len = len, .parent = parent };
+    if (parent != QP_DZ_NONE) {
+        qp_dz_push(&T->t[parent].kids, &T->t[parent].nkids, &T->t[parent].kcap, id);
+    }
+    zval v;
+    ZVAL_LONG(&v, id);
+    zend_hash_str_add_new(&T->by_name, (const char *)name, len, &v);
+    return id;
+}
+
+static int qp_dz_label_cmp(const uint8_t *a, const uint8_t *b)
+{
+    int c = memcmp(a + 1, b + 1, MIN(a[0], b[0]));
+    return c ? c : (int)a[0] - (int)b[0];
+}
+
+typedef struct {
+    const uint8_t *label;
+    uint32_t       id;
+} qp_dz_kid_t;
+
+static int qp_dz_kid_cmp(const void *x, const void *y)
+{
+    return qp_dz_label_cmp(((const qp_dz_kid_t *)x)->label, ((const qp_dz_kid_t *)y)->label);
+}
+
+static void qp_dz_sort_kids(qp_dz_tree_t *T, qp_dz_tnode_t *t)
+{
+    qp_dz_kid_t *k = safe_emalloc(t->nkids, sizeof(*k), 0);
+    for (uint32_t i = 0; i < t->nkids; i++) {
+        k[i] = (qp_dz_kid_t){ T->t[t->kids[i]].name, t->kids[i] };
+    }
+    qsort(k, t->nkids, sizeof(*k), qp_dz_kid_cmp);
+    for (uint32_t i = 0; i < t->nkids; i++) {
+        t->kids[i] = k[i].id;
+    }
+    efree(k);
+}
+
+static bool qp_dz_has(const qp_dz_rec_t *recs, const qp_dz_tnode_t *t, uint16_t type)
+{
+    for (uint32_t i = 0; i < t->nrecs; i++) {
+        if (recs[t->recs[i]].type == type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* One resource record; `owner` NULL for a pointer to the question */
+static void qp_dz_put_rr(smart_str *s, const uint8_t *owner, size_t owner_len, const qp_dz_rec_t *r, uint32_t ttl)
+{
+    if (owner) {
+        smart_str_appendl(s, (const char *)owner, owner_len);
+    } else {
+        qp_dz_put16(s, 0xC00C);
+    }
+    qp_dz_put16(s, r->type);
+    qp_dz_put16(s, 1);             /* IN */
+    qp_dz_put32(s, ttl);
+    qp_dz_put16(s, (uint16_t)ZSTR_LEN(r->rdata));
+    smart_str_appendl(s, ZSTR_VAL(r->rdata), ZSTR_LEN(r->rdata));
+}
+
+static uint32_t qp_dz_blob_at(const smart_str *blobs)
+{
+    return blobs->s ? (uint32_t)ZSTR_LEN(blobs->s) : 0;
+}
+
+/* RFC 2308 §3: the SOA in a negative answer lives for min(its TTL, its MINIMUM) */
+static uint32_t qp_dz_soa_negative_ttl(const qp_dz_rec_t *soa)
+{
+    const uint8_t *end = (const uint8_t *)ZSTR_VAL(soa->rdata) + ZSTR_LEN(soa->rdata);
+    uint32_t minimum = (uint32_t)end[-4] << 24 | (uint32_t)end[-3] << 16 | (uint32_t)end[-2] << 8 | end[-1];
+    return MIN(soa->ttl, minimum);
+}
+
+/* Appends the addresses of the host an NS record names, where the image has them */
+static void qp_dz_glue(qp_dz_tree_t *T, const qp_dz_rec_t *recs, const qp_dz_rec_t *ns, smart_str *blobs, uint16_t *count)
+{
+    const uint8_t *target = (const uint8_t *)ZSTR_VAL(ns->rdata);
+    zval *zv = zend_hash_str_find(&T->by_name, (const char *)target, ZSTR_LEN(ns->rdata));
+    if (!zv) {
+        return;
+    }
+    const qp_dz_tnode_t *t = &T->t[Z_LVAL_P(zv)];
+    for (uint32_t i = 0; i < t->nrecs; i++) {
+        const qp_dz_rec_t *r = &recs[t->recs[i]];
+        if (r->type == QUICPRO_DNS_TYPE_A || r->type == QUICPRO_DNS_TYPE_AAAA) {
+            qp_dz_put_rr(blobs, t->name, t->name_len, r, r->ttl);
+            (*count)++;
+        }
+    }
+}
+
+static bool qp_dz_build(qp_dz_parser_t *P, const struct stat *st, uint32_t default_ttl, smart_str *image)
+{
+    qp_dz_tree_t T = {0};
+    smart_str nodes = {0}, rrsets = {0}, labels = {0}, blobs = {0};
+    uint32_t nrrsets = 0;
+    bool ok = true;
+
+    zend_hash_init(&T.by_name, P->nrecs ? P->nrecs : 8, NULL, NULL, 0);
+    uint8_t root = 0;
+    qp_dz_node(&T, &root, 1);
+    for (uint32_t i = 0; i < P->nrecs; i++) {
+        uint32_t id = qp_dz_node(&T, P->recs[i].name, P->recs[i].name_len);
+        qp_dz_push(&T.t[id].recs, &T.t[id].nrecs, &T.t[id].rcap, i);
+    }
+
+    /* Breadth first: a node's children take consecutive indices */
+    uint32_t *order = safe_emalloc(T.n, sizeof(uint32_t), 0), head = 0, tail = 0;
+    order[tail++] = 0;
+    T.t[0].index = 0;
+    while (head < tail) {
+        qp_dz_tnode_t *t = &T.t[order[head++]];
+        if (t->nkids > 1) {
+            qp_dz_sort_kids(&T, t);
+        }
+        for (uint32_t k = 0; k < t->nkids; k++) {
+            T.t[t->kids[k]].index = tail;
+            order[tail++] = t->kids[k];
+        }
+    }
+
+    for (uint32_t pos = 0; ok && pos < T.n; pos++) {
+        qp_dz_tnode_t *t = &T.t[order[pos]];
+        const qp_dz_tnode_t *parent = t->parent == QP_DZ_NONE ? NULL : &T.t[t->parent];
+        bool apex = qp_dz_has(P->recs, t, QUICPRO_DNS_TYPE_SOA);
+        t->in_zone = apex || (parent && parent->in_zone);
+        qp_dz_node_t node = { .wildcard = QP_DZ_NONE, .child = t->nkids ? T.t[t->kids[0]].index : 0,
+                              .nchild = t->nkids, .rrset = nrrsets };
+
+        if (t->nrecs) {
+            P->line = P->recs[t->recs[0]].line;
+            if (!t->in_zone) {
+                ok = qp_dz_fail(P, "name outside every zone (no SOA at or above it)");
+                break;
+            }
+            if (t->nrecs > 1 && qp_dz_has(P->recs, t, QUICPRO_DNS_TYPE_CNAME)) {
+                P->line = P->recs[t->recs[1]].line;
+                ok = qp_dz_fail(P, "CNAME and other data");
+                break;
+            }
+        }
+
+        /* The label */
+        node.label = labels.s ? (uint32_t)ZSTR_LEN(labels.s) : 0;
+        smart_str_appendl(&labels, (const char *)t->name, (size_t)t->name[0] + 1);
+
+        /* RRsets in the order their types first appear */
+        for (uint32_t i = 0; i < t->nrecs; i++) {
+            uint16_t type = P->recs[t->recs[i]].type;
+            bool seen = false;
+            for (uint32_t j = 0; j < i && !seen; j++) {
+                seen = P->recs[t->recs[j]].type == type;
+            }
+            if (seen) {
+                continue;
+            }
+            qp_dz_rrset_t set = { .type = type, .off = qp_dz_blob_at(&blobs) };
+            for (uint32_t j = i; j < t->nrecs; j++) {
+                const qp_dz_rec_t *r = &P->recs[t->recs[j]];
+                if (r->type == type) {
+                    qp_dz_put_rr(&blobs, NULL, 0, r, r->ttl);
+                    set.count++;
+                }
+            }
+            set.len = qp_dz_blob_at(&blobs) - set.off;
+            smart_str_appendl(&rrsets, (const char *)&set, sizeof(set));
+            nrrsets++;
+            node.nrrset++;
+        }
+
+        /* Authority and glue */
+        if (apex) {
+            node.flags |= QP_DZ_APEX;
+            node.auth = qp_dz_blob_at(&blobs);
+            for (uint32_t i = 0; i < t->nrecs; i++) {
+                const qp_dz_rec_t *r = &P->recs[t->recs[i]];
+                if (r->type == QUICPRO_DNS_TYPE_SOA) {
+                    qp_dz_put_rr(&blobs, t->name, t->name_len, r, qp_dz_soa_negative_ttl(r));
+                    node.auth_count = 1;
+                    break;
+                }
+            }
+            node.auth_len = qp_dz_blob_at(&blobs) - node.auth;
+        } else if (t->in_zone && qp_dz_has(P->recs, t, QUICPRO_DNS_TYPE_NS)) {
+            node.flags |= QP_DZ_DELEGATION;
+            node.auth = qp_dz_blob_at(&blobs);
+            for (uint32_t i = 0; i < t->nrecs; i++) {
+                const qp_dz_rec_t *r = &P->recs[t->recs[i]];
+                if (r->type == QUICPRO_DNS_TYPE_NS) {
+                    qp_dz_put_rr(&blobs, t->name, t->name_len, r, r->ttl);
+                    node.auth_count++;
+                }
+            }
+            node.auth_len = qp_dz_blob_at(&blobs) - node.auth;
+            node.glue = qp_dz_blob_at(&blobs);
+            for (uint32_t i = 0; i < t->nrecs; i++) {
+                const qp_dz_rec_t *r = &P->recs[t->recs[i]];
+                if (r->type == QUICPRO_DNS_TYPE_NS) {
+                    qp_dz_glue(&T, P->recs, r, &blobs, &node.glue_count);
+                }
+            }
+            node.glue_len = qp_dz_blob_at(&blobs) - node.glue;
+        }
+        for (uint32_t k = 0; k < t->nkids; k++) {
+            const uint8_t *l = T.t[t->kids[k]].name;
+            if (l[0] == 1 && l[1] == '*') {
+                node.wildcard = T.t[t->kids[k]].index;
+            }
+        }
+        smart_str_appendl(&nodes, (const char *)&node, sizeof(node));
+    }
+
+    if (ok && (uint64_t)(nodes.s ? ZSTR_LEN(nodes.s) : 0) + (rrsets.s ? ZSTR_LEN(rrsets.s) : 0)
+              + ZSTR_LEN(labels.s) + qp_dz_blob_at(&blobs) + sizeof(qp_dz_header_t) > UINT32_MAX) {
+        ok = qp_dz_fail(P, "zone too large for one image");
+    }
+    if (ok) {
+        qp_dz_header_t h = {
+            .magic = QP_DZ_MAGIC, .version = QP_DZ_VERSION,
+            .src_mtime_sec = (int64_t)st->st_mtim.tv_sec, .src_mtime_nsec = (int64_t)st->st_mtim.tv_nsec,
+            .src_size = (uint64_t)st->st_size, .default_ttl = default_ttl, .nnodes = T.n, .nrrsets = nrrsets,
+        };
+        h.nodes_off = sizeof(h);
+        h.rrsets_off = h.nodes_off + T.n * (uint32_t)sizeof(qp_dz_node_t);
+        h.labels_off = h.rrsets_off + nrrsets * (uint32_t)sizeof(qp_dz_rrset_t);
+        h.blobs_off = h.labels_off + (uint32_t)ZSTR_LEN(labels.s);
+        h.size = h.blobs_off + qp_dz_blob_at(&blobs);
+        smart_str_appendl(image, (const char *)&h, sizeof(h));
+        smart_str_appendl(image, ZSTR_VAL(nodes.s), ZSTR_LEN(nodes.s));
+        if (rrsets.s) smart_str_appendl(image, ZSTR_VAL(rrsets.s), ZSTR_LEN(rrsets.s));
+        smart_str_appendl(image, ZSTR_VAL(labels.s), ZSTR_LEN(labels.s));
+        if (blobs.s) smart_str_appendl(image, ZSTR_VAL(blobs.s), ZSTR_LEN(blobs.s));
+    }
+
+    for (uint32_t i = 0; i < T.n; i++) {
+        if (T.t[i].recs) efree(T.t[i].recs);
+        if (T.t[i].kids) efree(T.t[i].kids);
+    }
+    efree(order);
+    efree(T.t);
+    zend_hash_destroy(&T.by_name);
+    smart_str_free(&nodes);
+    smart_str_free(&rrsets);
+    smart_str_free(&labels);
+    smart_str_free(&blobs);
+    return ok;
+}
+
+/* The image of `zone_file`, or false with `err` set */
+static bool qp_dz_compile(const char *zone_file, uint32_t default_ttl, smart_str *image, char *err, size_t err_len)
+{
+    struct stat st;
+    int fd = open(zone_file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        snprintf(err, err_len, "cannot open zone file %s: %s", zone_file, strerror(errno));
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    char *text = emalloc((size_t)st.st_size + 1);
+    size_t got = 0;
+    while (got < (size_t)st.st_size) {
+        ssize_t r = read(fd, text + got, (size_t)st.st_size - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        got += (size_t)r;
+    }
+    close(fd);
+
+    err[0] = '\0';
+    qp_dz_parser_t P = { .p = text, .end = text + got, .next_line = 1, .err = err, .err_len = err_len,
+                         .ttl = default_ttl };
+    bool ok = qp_dz_parse(&P) && qp_dz_build(&P, &st, default_ttl, image);
+    for (uint32_t i = 0; i < P.nrecs; i++) {
+        zend_string_release(P.recs[i].rdata);
+    }
+    if (P.recs) efree(P.recs);
+    efree(text);
+    if (!ok) {
+        smart_str_free(image);
+    }
+    return ok;
+}
+
+/* Writes next to `path` and renames, so a reader maps either image whole */
+static bool qp_dz_write(const char *path, const smart_str *image, char *err, size_t err_len)
+{
+    char tmp[PATH_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid()) >= (int)sizeof(tmp)) {
+        snprintf(err, err_len, "image path too long");
+        return false;
+    }
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        snprintf(err, err_len, "cannot write %s: %s", tmp, strerror(errno));
+        return false;
+    }
+    const char *p = ZSTR_VAL(image->s);
+    size_t left = ZSTR_LEN(image->s);
+    while (left) {
+        ssize_t w = write(fd, p, left);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) break;
+        p += w;
+        left -= (size_t)w;
+    }
+    if (left || close(fd) < 0 || rename(tmp, path) < 0) {
+        snprintf(err, err_len, "cannot write %s: %s", path, strerror(errno));
+        if (left) close(fd);
+        unlink(tmp);
+        return false;
+    }
+    return true;
+}
+
+bool quicpro_dns_zone_compile(const char *zone_file, const char *image_path, uint32_t default_ttl,
+                              char *err, size_t err_len)
+{
+    smart_str image = {0};
+    if (!qp_dz_compile(zone_file, default_ttl, &image, err, err_len)) {
+        return false;
+    }
+    bool ok = qp_dz_write(image_path, &image, err, err_len);
+    smart_str_free(&image);
+    return ok;
+}
+
+/*──────────────────────────────── Loading ────────────────────────────────*/
+
+/* Checks every offset once, so lookups need not */
+static bool qp_dz_attach(quicpro_dns_zone_t *z)
+{
+    const qp_dz_header_t *h = (const qp_dz_header_t *)z->base;
+    if (z->size < sizeof(*h) || h->magic != QP_DZ_MAGIC || h->version != QP_DZ_VERSION || h->size != z->size
+        || h->nnodes == 0 || h->nodes_off != sizeof(*h)
+        || (uint64_t)h->nnodes * sizeof(qp_dz_node_t) != (uint64_t)h->rrsets_off - h->nodes_off
+        || (uint64_t)h->nrrsets * sizeof(qp_dz_rrset_t) != (uint64_t)h->labels_off - h->rrsets_off
+        || h->labels_off > h->blobs_off || h->blobs_off > h->size) {
+        return false;
+    }
+    z->h = h;
+    z->nodes = (const qp_dz_node_t *)(z->base + h->nodes_off);
+    z->rrsets = (const qp_dz_rrset_t *)(z->base + h->rrsets_off);
+    z->labels = z->base + h->labels_off;
+    z->labels_len = h->blobs_off - h->labels_off;
+    z->blobs = z->base + h->blobs_off;
+    z->blobs_len = h->size - h->blobs_off;
+
+    for (uint32_t i = 0; i < h->nnodes; i++) {
+        const qp_dz_node_t *n = &z->nodes[i];
+        if (n->label >= z->labels_len || (uint64_t)n->label + 1 + z->labels[n->label] > z->labels_len
+            || (n->nchild && (n->child <= i || (uint64_t)n->child + n->nchild > h->nnodes))
+            || (n->wildcard != QP_DZ_NONE && (n->wildcard < n->child || n->wildcard >= n->child + n->nchild))
+            || (uint64_t)n->rrset + n->nrrset > h->nrrsets
+            || (uint64_t)n->auth + n->auth_len > z->blobs_len || (uint64_t)n->glue + n->glue_len > z->blobs_len) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < h->nrrsets; i++) {
+        if ((uint64_t)z->rrsets[i].off + z->rrsets[i].len > z->blobs_len) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Maps `image` if it was compiled from the zone file as `st` describes */
+static quicpro_dns_zone_t *qp_dz_map(const char *image, const struct stat *st, uint32_t default_ttl)
+{
+    struct stat ist;
+    int fd = open(image, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &ist) < 0 || ist.st_size < (off_t)sizeof(qp_dz_header_t)) {
+        close(fd);
+        return NULL;
+    }
+    void *base = mmap(NULL, (size_t)ist.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    const qp_dz_header_t *h = base;
+    quicpro_dns_zone_t *z = ecalloc(1, sizeof(*z));
+    z->base = base;
+    z->size = (size_t)ist.st_size;
+    z->mapped = true;
+    if (h->src_mtime_sec != (int64_t)st->st_mtim.tv_sec || h->src_mtime_nsec != (int64_t)st->st_mtim.tv_nsec
+        || h->src_size != (uint64_t)st->st_size || h->default_ttl != default_ttl || !qp_dz_attach(z)) {
+        quicpro_dns_zone_close(z);
+        return NULL;
+    }
+    return z;
+}
+
+quicpro_dns_zone_t *quicpro_dns_zone_open(const char *zone_file, uint32_t default_ttl, char *err, size_t err_len)
+{
+    char image[PATH_MAX];
+    struct stat st;
+    quicpro_dns_zone_t *z;
+
+    if (stat(zone_file, &st) < 0) {
+        snprintf(err, err_len, "cannot open zone file %s: %s", zone_file, strerror(errno));
+        return NULL;
+    }
+    bool named = snprintf(image, sizeof(image), "%s.qpz", zone_file) < (int)sizeof(image);
+    if (named && (z = qp_dz_map(image, &st, default_ttl))) {
+        z->zone_file = estrdup(zone_file);
+        return z;
+    }
+
+    smart_str buf = {0};
+    if (!qp_dz_compile(zone_file, default_ttl, &buf, err, err_len)) {
+        return NULL;
+    }
+    /* Shared through the page cache if the image can be written; private otherwise */
+    char ignored[128];
+    if (named && qp_dz_write(image, &buf, ignored, sizeof(ignored)) && stat(zone_file, &st) == 0
+        && (z = qp_dz_map(image, &st, default_ttl))) {
+        smart_str_free(&buf);
+        z->zone_file = estrdup(zone_file);
+        return z;
+    }
+    z = ecalloc(1, sizeof(*z));
+    z->size = ZSTR_LEN(buf.s);
+    z->base = emalloc(z->size);
+    memcpy((void *)z->base, ZSTR_VAL(buf.s), z->size);
+    smart_str_free(&buf);
+    z->zone_file = estrdup(zone_file);
+    qp_dz_attach(z);
+    return z;
+}
+
+bool quicpro_dns_zone_stale(const quicpro_dns_zone_t *z)
+{
+    struct stat st;
+    return stat(z->zone_file, &st) == 0
+        && (z->h->src_mtime_sec != (int64_t)st.st_mtim.tv_sec || z->h->src_mtime_nsec != (int64_t)st.st_mtim.tv_nsec
+            || z->h->src_size != (uint64_t)st.st_size);
+}
+
+void quicpro_dns_zone_close(quicpro_dns_zone_t *z)
+{
+    if (!z) {
+        return;
+    }
+    if (z->mapped) {
+        munmap((void *)z->base, z->size);
+    } else {
+        efree((void *)z->base);
+    }
+    if (z->zone_file) {
+        efree(z->zone_file);
+    }
+    efree(z);
+}
+
+/*──────────────────────────────── Lookups ────────────────────────────────*/
+
+static const qp_dz_node_t *qp_dz_child(const quicpro_dns_zone_t *z, const qp_dz_node_t *n, const uint8_t *label)
+{
+    uint32_t lo = n->child, hi = n->child + n->nchild;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int c = qp_dz_label_cmp(z->labels + z->nodes[mid].label, label);
+        if (c == 0) {
+            return &z->nodes[mid];
+        }
+        if (c < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+static void qp_dz_authority(const quicpro_dns_zone_t *z, const qp_dz_node_t *n, quicpro_dns_answer_t *out)
+{
+    out->authority = z->blobs + n->auth;
+    out->authority_len = n->auth_len;
+    out->authority_count = n->auth_count;
+}
+
+bool quicpro_dns_zone_lookup(const quicpro_dns_zone_t *z, const uint8_t *name, size_t len, uint16_t qtype,
+                             quicpro_dns_answer_t *out)
+{
+    uint8_t at[QP_DZ_MAX_LABELS];
+    int nlabels = 0;
+    size_t pos = 0;
+
+    memset(out, 0, sizeof(*out));
+    while (pos < len && name[pos]) {
+        if (nlabels == QP_DZ_MAX_LABELS || name[pos] > 63) {
+            return false;
+        }
+        at[nlabels++] = (uint8_t)pos;
+        pos += 1 + (size_t)name[pos];
+    }
+    if (pos >= len) {
+        return false;
+    }
+
+    const qp_dz_node_t *node = &z->nodes[0], *apex = node->flags & QP_DZ_APEX ? node : NULL;
+    for (int i = nlabels - 1; i >= 0; i--) {
+        const qp_dz_node_t *child = qp_dz_child(z, node, name + at[i]);
+        if (!child) {
+            if (!apex) {
+                return false;
+            }
+            if (node->wildcard != QP_DZ_NONE) {
+                node = &z->nodes[node->wildcard];   /* Stands in for every label left */
+                break;
+            }
+            out->rcode = QUICPRO_DNS_RCODE_NXDOMAIN;
+            out->authoritative = true;
+            qp_dz_authority(z, apex, out);
+            return true;
+        }
+        node = child;
+        if (node->flags & QP_DZ_APEX) {
+            apex = node;
+        } else if ((node->flags & QP_DZ_DELEGATION) && !(i == 0 && qtype == QUICPRO_DNS_TYPE_DS)) {
+            /* Not ours to answer: a referral (the DS set of a child zone is the parent's) */
+            qp_dz_authority(z, node, out);
+            out->additional = z->blobs + node->glue;
+            out->additional_len = node->glue_len;
+            out->additional_count = node->glue_count;
+            return true;
+        }
+    }
+    if (!apex) {
+        return false;
+    }
+
+    out->authoritative = true;
+    const qp_dz_rrset_t *set = NULL, *cname = NULL;
+    for (uint16_t i = 0; i < node->nrrset; i++) {
+        const qp_dz_rrset_t *r = &z->rrsets[node->rrset + i];
+        if (r->type == qtype || (qtype == QUICPRO_DNS_TYPE_ANY && !set)) {
+            set = r;
+            break;
+        }
+        if (r->type == QUICPRO_DNS_TYPE_CNAME) {
+            cname = r;
+        }
+    }
+    set = set ? set : cname;
+    if (!set) {
+        qp_dz_authority(z, apex, out);      /* NODATA */
+        return true;
+    }
+    /* ANY gets one RRset (RFC 8482) */
+    out->answer = z->blobs + set->off;
+    out->answer_len = set->len;
+    out->answer_count = set->count;
+    return true;
+}
+
+/*────────────────────────────── PHP function ─────────────────────────────*/
+
+PHP_FUNCTION(quicpro_dns_zone_compile)
+{
+    zend_string *zone_file, *image_path = NULL;
+    char err[256], image[PATH_MAX];
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_PATH_STR(zone_file)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_PATH_STR_OR_NULL(image_path)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (image_path) {
+        snprintf(image, sizeof(image), "%s", ZSTR_VAL(image_path));
+    } else if (snprintf(image, sizeof(image), "%s.qpz", ZSTR_VAL(zone_file)) >= (int)sizeof(image)) {
+        zend_argument_value_error(1, "is too long");
+        RETURN_THROWS();
+    }
+    uint32_t ttl = (uint32_t)MIN(quicpro_smart_dns_config.dns_default_record_ttl_sec, INT32_MAX);
+    if (!quicpro_dns_zone_compile(ZSTR_VAL(zone_file), image, ttl, err, sizeof(err))) {
+        zend_throw_exception_ex(NULL, 0, "Zone file %s: %s", ZSTR_VAL(zone_file), err);
+        RETURN_THROWS();
+    }
+    RETURN_TRUE;
+}
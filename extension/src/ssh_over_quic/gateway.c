@@ -0,0 +1,498 @@
+/*
+ * src/ssh_over_quic/gateway.c – SSH-over-QUIC gateway on the listeners
+ * =====================================================================
+ *
+ * See include/ssh_over_quic/gateway.h. A channel is one client stream and
+ * the TCP connection it became; channels hang off their session
+ * (quicpro_session_t.ssh) and end with it.
+ *
+ * Each direction is pulled only as far as its pipe has room: the up pipe
+ * (client → target) takes what quiche holds for the stream and is spliced
+ * into the socket once it is writable; the down pipe (target → client) is
+ * spliced from the socket and read out no faster than the stream's send
+ * capacity. What neither side can take stays in quiche's receive buffer or
+ * the socket's, where flow control and TCP hold back the sender.
+ */
+
+#include "ssh_over_quic/gateway.h"
+#include "client/dns.h"
+#include "server/metrics.h"
+#include "config/ssh_over_quic/base_layer.h"
+
+#include <php.h>
+#include <zend_exceptions.h>
+#include <curl/curl.h>
+#include <openssl/x509.h>
+#include <quiche.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <syslog.h>
+#include <unistd.h>
+
+typedef struct {
+    int      fd;                    /* The target socket */
+    int      up[2], down[2];        /* Pipes: client → target, target → client */
+    size_t   up_queued, down_queued;
+    size_t   cap;                   /* Bytes a pipe holds */
+    uint32_t events;                /* Interest in the listener's epoll set; 0: not in it */
+    bool     connected, client_fin, target_eof, shut_wr, fin_sent;
+    uint64_t connect_by_us;         /* Until connected */
+    uint64_t active_us;             /* Last byte either way */
+    uint64_t bytes_up, bytes_down;
+} qp_ssh_chan_t;
+
+struct quicpro_ssh_conn_s {
+    HashTable          chans;       /* Stream ID → qp_ssh_chan_t */
+    quicpro_dns_addr_t target;
+    char               host[QUICPRO_MAX_HOST_LEN];
+    zend_long          port;
+    char               user[256];   /* Certificate CN, "" without one */
+    int                epoll_fd;    /* The listener's, -1: none */
+};
+
+/* Tag of every target socket in the listener's epoll set; the listener ignores it */
+static char    qp_ssh_wake;
+static uint8_t qp_ssh_buf[16 * 1024];
+static size_t  qp_ssh_page;
+
+static void qp_ssh_log(const quicpro_ssh_conn_t *c, uint64_t stream_id, const char *fmt, ...)
+{
+    char msg[512];
+    int n;
+    va_list ap;
+    if (!quicpro_ssh_over_quic_config.gateway_log_session_activity) {
+        return;
+    }
+    n = snprintf(msg, sizeof(msg), "quicpro ssh gateway: user=\"%s\" target=%s:" ZEND_LONG_FMT " stream=%" PRIu64 " ",
+                 c->user, c->host, c->port, stream_id);
+    va_start(ap, fmt);
+    vsnprintf(msg + n, sizeof(msg) - (size_t)n, fmt, ap);
+    va_end(ap);
+    php_log_err_with_severity(msg, LOG_NOTICE);
+}
+
+static void qp_ssh_chan_dtor(zval *zv)
+{
+    qp_ssh_chan_t *ch = Z_PTR_P(zv);
+    /* Closing the socket also takes it out of the epoll set */
+    if (ch->fd >= 0) close(ch->fd);
+    for (int i = 0; i < 2; i++) {
+        if (ch->up[i] >= 0) close(ch->up[i]);
+        if (ch->down[i] >= 0) close(ch->down[i]);
+    }
+    efree(ch);
+}
+
+static void qp_ssh_close(quicpro_session_t *s, uint64_t error, const char *reason)
+{
+    quiche_conn_close(s->conn, true, error, (const uint8_t *)reason, strlen(reason));
+}
+
+/*──────────────────────── Authentication & target ────────────────────────*/
+
+typedef struct {
+    char   text[QUICPRO_MAX_HOST_LEN + 8];
+    size_t len;
+} qp_ssh_profile_t;
+
+static size_t qp_ssh_profile_write(char *p, size_t size, size_t n, void *ud)
+{
+    qp_ssh_profile_t *body = ud;
+    size_t take = MIN(size * n, sizeof(body->text) - 1 - body->len);
+    memcpy(body->text + body->len, p, take);
+    body->len += take;
+    body->text[body->len] = '\0';
+    return size * n;
+}
+
+/* Asks the user profile agent for the user's target, "host[:port]" */
+static bool qp_ssh_profile_lookup(quicpro_ssh_conn_t *c)
+{
+    const char *uri = quicpro_ssh_over_quic_config.gateway_user_profile_agent_uri;
+    qp_ssh_profile_t body = {{0}, 0};
+    long status = 0;
+    CURL *curl;
+    if (!uri || !*uri || !*c->user || !(curl = curl_easy_init())) {
+        return false;
+    }
+    char *user = curl_easy_escape(curl, c->user, 0);
+    char url[2048];
+    snprintf(url, sizeof(url), "%s%suser=%s", uri, strchr(uri, '?') ? "&" : "?", user ? user : "");
+    curl_free(user);
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)quicpro_ssh_over_quic_config.gateway_target_connect_timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, qp_ssh_profile_write);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+    bool ok = curl_easy_perform(curl) == CURLE_OK
+        && curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status) == CURLE_OK && status == 200;
+    curl_easy_cleanup(curl);
+    if (!ok) {
+        return false;
+    }
+
+    char *line = body.text + strspn(body.text, " \t");
+    line[strcspn(line, " \t\r\n")] = '\0';
+    char *host = line, *colon;
+    c->port = quicpro_ssh_over_quic_config.gateway_default_target_port;
+    if (*line == '[') {                 /* "[v6]" or "[v6]:port" */
+        char *end = strchr(line, ']');
+        if (!end) {
+            return false;
+        }
+        *end = '\0';
+        host = line + 1;
+        colon = end[1] == ':' ? end + 1 : NULL;
+    } else {
+        colon = strchr(line, ':');
+        if (colon && strchr(colon + 1, ':')) {
+            colon = NULL;               /* A bare IPv6 address */
+        }
+    }
+    if (colon) {
+        *colon = '\0';
+        c->port = ZEND_STRTOL(colon + 1, NULL, 10);
+    }
+    if (!*host || c->port <= 0 || c->port > 65535) {
+        return false;
+    }
+    strlcpy(c->host, host, sizeof(c->host));
+    return true;
+}
+
+/* The connection's gateway state, created once it is authenticated and mapped; NULL after closing it */
+static quicpro_ssh_conn_t *qp_ssh_conn(quicpro_session_t *s, int epoll_fd)
+{
+    if (s->ssh) {
+        s->ssh->epoll_fd = epoll_fd;
+        return s->ssh;
+    }
+    if (!quiche_conn_is_established(s->conn) || quiche_conn_is_closed(s->conn) || quiche_conn_is_draining(s->conn)) {
+        return NULL;
+    }
+    if (strcmp(quicpro_ssh_over_quic_config.gateway_auth_mode, "mtls") != 0) {
+        qp_ssh_close(s, QUICPRO_SSH_AUTH_REQUIRED, "authentication mode not served by this gateway");
+        return NULL;
+    }
+
+    /* quiche verified any certificate the client sent; this insists that one was sent */
+    const uint8_t *der = NULL;
+    size_t der_len = 0;
+    quiche_conn_peer_cert(s->conn, &der, &der_len);
+    if (!der_len) {
+        qp_ssh_close(s, QUICPRO_SSH_AUTH_REQUIRED, "client certificate required");
+        return NULL;
+    }
+
+    quicpro_ssh_conn_t *c = ecalloc(1, sizeof(*c));
+    X509 *cert = d2i_X509(NULL, &der, (long)der_len);
+    if (cert) {
+        X509_NAME_get_text_by_NID(X509_get_subject_name(cert), NID_commonName, c->user, sizeof(c->user));
+        X509_free(cert);
+    }
+
+    bool mapped;
+    if (strcmp(quicpro_ssh_over_quic_config.gateway_target_mapping_mode, "user_profile") == 0) {
+        mapped = qp_ssh_profile_lookup(c);
+    } else {
+        strlcpy(c->host, quicpro_ssh_over_quic_config.gateway_default_target_host, sizeof(c->host));
+        c->port = quicpro_ssh_over_quic_config.gateway_default_target_port;
+        mapped = c->port > 0 && c->port <= 65535;
+    }
+    quicpro_dns_addr_t addrs[QUICPRO_DNS_MAX_ADDRS];
+    if (!mapped || quicpro_dns_resolve(c->host, (uint16_t)c->port, AF_UNSPEC, addrs, QUICPRO_DNS_MAX_ADDRS) <= 0) {
+        zend_clear_exception();
+        qp_ssh_log(c, 0, "refused: no target");
+        efree(c);
+        qp_ssh_close(s, QUICPRO_SSH_NO_TARGET, "no target for this client");
+        return NULL;
+    }
+    c->target = addrs[0];
+    c->epoll_fd = epoll_fd;
+    zend_hash_init(&c->chans, 8, NULL, qp_ssh_chan_dtor, 0);
+    s->ssh = c;
+    return c;
+}
+
+/*──────────────────────────────── Channels ───────────────────────────────*/
+
+static qp_ssh_chan_t *qp_ssh_chan_open(quicpro_ssh_conn_t *c, uint64_t stream_id)
+{
+    qp_ssh_chan_t *ch = ecalloc(1, sizeof(*ch));
+    ch->fd = ch->up[0] = ch->up[1] = ch->down[0] = ch->down[1] = -1;
+    zend_hash_index_add_new_ptr(&c->chans, stream_id, ch);
+
+    if (pipe2(ch->up, O_NONBLOCK | O_CLOEXEC) < 0 || pipe2(ch->down, O_NONBLOCK | O_CLOEXEC) < 0) {
+        return NULL;
+    }
+    fcntl(ch->up[1], F_SETPIPE_SZ, QUICPRO_SSH_WINDOW);
+    fcntl(ch->down[1], F_SETPIPE_SZ, QUICPRO_SSH_WINDOW);
+    int up_sz = fcntl(ch->up[1], F_GETPIPE_SZ), down_sz = fcntl(ch->down[1], F_GETPIPE_SZ);
+    ch->cap = (size_t)MAX(MIN(up_sz, down_sz), 0);
+
+    ch->fd = socket(c->target.addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (ch->fd < 0) {
+        return NULL;
+    }
+    int one = 1;
+    setsockopt(ch->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));   /* Keystrokes go out as typed */
+    if (connect(ch->fd, (struct sockaddr *)&c->target.addr, c->target.len) < 0 && errno != EINPROGRESS) {
+        return NULL;
+    }
+    uint64_t now = quicpro_metrics_now_us();
+    ch->connect_by_us = now + (uint64_t)quicpro_ssh_over_quic_config.gateway_target_connect_timeout_ms * 1000;
+    ch->active_us = now;
+    qp_ssh_log(c, stream_id, "opened");
+    return ch;
+}
+
+/* Resets both directions of the stream; the caller drops the channel */
+static void qp_ssh_chan_abort(quicpro_session_t *s, uint64_t stream_id, uint64_t error)
+{
+    quiche_conn_stream_shutdown(s->conn, stream_id, QUICHE_SHUTDOWN_READ, error);
+    quiche_conn_stream_shutdown(s->conn, stream_id, QUICHE_SHUTDOWN_WRITE, error);
+}
+
+/* Watches the socket for exactly what the channel waits on, so a full pipe does not wake the listener */
+static void qp_ssh_chan_watch(const quicpro_ssh_conn_t *c, qp_ssh_chan_t *ch)
+{
+    uint32_t want = 0;
+    if (!ch->connected || ch->up_queued) {
+        want |= EPOLLOUT;
+    }
+    if (ch->connected && !ch->target_eof && ch->down_queued < ch->cap) {
+        want |= EPOLLIN;
+    }
+    if (want == ch->events || c->epoll_fd < 0) {
+        return;
+    }
+    struct epoll_event ev = { .events = want, .data.ptr = &qp_ssh_wake };
+    if (epoll_ctl(c->epoll_fd, ch->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, ch->fd, &ev) == 0
+        || (errno == ENOENT && epoll_ctl(c->epoll_fd, EPOLL_CTL_ADD, ch->fd, &ev) == 0)) {
+        ch->events = want;              /* ENOENT: another listener's set had it */
+    }
+}
+
+/* Bytes the up pipe surely takes: the head buffer may be half drained and hold a page of room back */
+static size_t qp_ssh_up_room(const qp_ssh_chan_t *ch)
+{
+    if (!qp_ssh_page) {
+        long page = sysconf(_SC_PAGESIZE);
+        qp_ssh_page = page > 0 ? (size_t)page : 4096;
+    }
+    return ch->cap > ch->up_queued + qp_ssh_page ? ch->cap - ch->up_queued - qp_ssh_page : 0;
+}
+
+/*
+ * Moves what either side can take. Returns the error to reset the stream
+ * with, QUICPRO_SSH_NO_ERROR while it goes on, or UINT64_MAX once both
+ * directions have ended cleanly.
+ */
+static uint64_t qp_ssh_chan_pump(quicpro_session_t *s, uint64_t id, qp_ssh_chan_t *ch, uint64_t now, bool *wrote)
+{
+    bool moved = false;
+
+    if (!ch->connected) {
+        struct pollfd pfd = { .fd = ch->fd, .events = POLLOUT };
+        if (poll(&pfd, 1, 0) == 1) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(ch->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err) {
+                return QUICPRO_SSH_TARGET_UNREACHABLE;
+            }
+            ch->connected = true;
+        } else if (now >= ch->connect_by_us) {
+            return QUICPRO_SSH_TARGET_UNREACHABLE;
+        }
+    }
+
+    /* Client → target: quiche into the up pipe (buffered while connecting), the pipe into the socket */
+    while (!ch->client_fin) {
+        size_t room = MIN(qp_ssh_up_room(ch), sizeof(qp_ssh_buf));
+        if (room == 0) {
+            break;
+        }
+        bool fin = false;
+        uint64_t ec = 0;
+        ssize_t n = quiche_conn_stream_recv(s->conn, id, qp_ssh_buf, room, &fin, &ec);
+        if (n == QUICHE_ERR_DONE) {
+            break;
+        }
+        if (n < 0) {
+            return QUICPRO_SSH_TARGET_RESET;          /* Reset by the client */
+        }
+        if (n > 0 && write(ch->up[1], qp_ssh_buf, (size_t)n) != n) {
+            return QUICPRO_SSH_INTERNAL_ERROR;
+        }
+        ch->up_queued += (size_t)n;
+        ch->client_fin = fin;
+        moved |= n > 0;
+    }
+    if (ch->connected && ch->up_queued) {
+        /* PHP ignores SIGPIPE, so a target that went away is an EPIPE here */
+        ssize_t n = splice(ch->up[0], NULL, ch->fd, NULL, ch->up_queued, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n < 0 && errno != EAGAIN) {
+            return QUICPRO_SSH_TARGET_RESET;
+        }
+        if (n > 0) {
+            ch->up_queued -= (size_t)n;
+            ch->bytes_up += (uint64_t)n;
+            moved = true;
+        }
+    }
+    if (ch->connected && ch->client_fin && !ch->up_queued && !ch->shut_wr) {
+        shutdown(ch->fd, SHUT_WR);
+        ch->shut_wr = true;
+    }
+
+    /* Target → client: the socket into the down pipe, the pipe into the stream as far as its capacity goes */
+    if (ch->connected && !ch->target_eof && ch->down_queued < ch->cap) {
+        ssize_t n = splice(ch->fd, NULL, ch->down[1], NULL, ch->cap - ch->down_queued, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n == 0) {
+            ch->target_eof = true;
+        } else if (n < 0 && errno != EAGAIN) {
+            return QUICPRO_SSH_TARGET_RESET;
+        } else if (n > 0) {
+            ch->down_queued += (size_t)n;
+            ch->bytes_down += (uint64_t)n;
+            moved = true;
+        }
+    }
+    while (ch->down_queued) {
+        ssize_t cap = quiche_conn_stream_capacity(s->conn, id);
+        if (cap < 0) {
+            return QUICPRO_SSH_TARGET_RESET;        /* Stopped by the client */
+        }
+        size_t take = MIN(MIN(ch->down_queued, (size_t)cap), sizeof(qp_ssh_buf));
+        if (take == 0 || read(ch->down[0], qp_ssh_buf, take) != (ssize_t)take) {
+            break;
+        }
+        bool fin = ch->target_eof && take == ch->down_queued;
+        uint64_t ec = 0;
+        /* Within the stream's capacity quiche takes it all */
+        if (quiche_conn_stream_send(s->conn, id, qp_ssh_buf, take, fin, &ec) != (ssize_t)take) {
+            return QUICPRO_SSH_INTERNAL_ERROR;
+        }
+        ch->down_queued -= take;
+        ch->fin_sent = fin;
+        *wrote = true;
+    }
+    if (ch->target_eof && !ch->down_queued && !ch->fin_sent) {
+        uint64_t ec = 0;
+        ssize_t n = quiche_conn_stream_send(s->conn, id, NULL, 0, true, &ec);
+        if (n >= 0) {
+            ch->fin_sent = true;
+            *wrote = true;
+        } else if (n != QUICHE_ERR_DONE) {
+            return QUICPRO_SSH_TARGET_RESET;
+        }
+    }
+
+    if (ch->fin_sent && ch->shut_wr) {
+        return UINT64_MAX;
+    }
+    if (moved) {
+        ch->active_us = now;
+    } else if (quicpro_ssh_over_quic_config.gateway_idle_timeout_sec > 0
+               && now - ch->active_us >= (uint64_t)quicpro_ssh_over_quic_config.gateway_idle_timeout_sec * 1000000) {
+        return QUICPRO_SSH_IDLE_TIMEOUT;
+    }
+    return QUICPRO_SSH_NO_ERROR;
+}
+
+/* Pumps one channel and ends it when it is done; true if anything was written */
+static bool qp_ssh_chan_step(quicpro_session_t *s, quicpro_ssh_conn_t *c, uint64_t id, qp_ssh_chan_t *ch, uint64_t now)
+{
+    static const char *const ends[] = {
+        [QUICPRO_SSH_INTERNAL_ERROR]     = "internal error",
+        [QUICPRO_SSH_TARGET_UNREACHABLE] = "target unreachable",
+        [QUICPRO_SSH_TARGET_RESET]       = "reset",
+        [QUICPRO_SSH_IDLE_TIMEOUT]       = "idle timeout",
+    };
+    bool wrote = false;
+    uint64_t end = qp_ssh_chan_pump(s, id, ch, now, &wrote);
+    if (end == QUICPRO_SSH_NO_ERROR) {
+        qp_ssh_chan_watch(c, ch);
+        return wrote;
+    }
+    if (end != UINT64_MAX) {
+        qp_ssh_chan_abort(s, id, end);
+        wrote = true;
+    }
+    qp_ssh_log(c, id, "closed: %s, %" PRIu64 " bytes up, %" PRIu64 " bytes down",
+               end == UINT64_MAX ? "done" : ends[end], ch->bytes_up, ch->bytes_down);
+    zend_hash_index_del(&c->chans, id);
+    return wrote;
+}
+
+/*──────────────────────────────── Entry points ───────────────────────────*/
+
+bool quicpro_ssh_gateway_session(const quicpro_session_t *s)
+{
+    const uint8_t *proto = NULL;
+    size_t len = 0;
+    if (!quicpro_ssh_over_quic_config.gateway_enable) {
+        return false;
+    }
+    quiche_conn_application_proto(s->conn, &proto, &len);
+    return len == sizeof(QUICPRO_SSH_ALPN) - 1 && memcmp(proto, QUICPRO_SSH_ALPN, len) == 0;
+}
+
+bool quicpro_ssh_gateway_stream(quicpro_session_t *s, uint64_t stream_id, int epoll_fd)
+{
+    quicpro_ssh_conn_t *c = qp_ssh_conn(s, epoll_fd);
+    if (!c) {
+        return true;                    /* Closed, or the handshake is not done */
+    }
+    qp_ssh_chan_t *ch = zend_hash_index_find_ptr(&c->chans, stream_id);
+    if (!ch) {
+        if ((stream_id & 0x3) != 0) {
+            /* An SSH connection needs both directions of a client-initiated stream */
+            quiche_conn_stream_shutdown(s->conn, stream_id, QUICHE_SHUTDOWN_READ, QUICPRO_SSH_INTERNAL_ERROR);
+            return true;
+        }
+        ch = qp_ssh_chan_open(c, stream_id);
+        if (!ch) {
+            qp_ssh_log(c, stream_id, "closed: target unreachable (%s)", strerror(errno));
+            zend_hash_index_del(&c->chans, stream_id);
+            qp_ssh_chan_abort(s, stream_id, QUICPRO_SSH_TARGET_UNREACHABLE);
+            return true;
+        }
+    }
+    return qp_ssh_chan_step(s, c, stream_id, ch, quicpro_metrics_now_us());
+}
+
+bool quicpro_ssh_gateway_pump(quicpro_session_t *s, int epoll_fd)
+{
+    quicpro_ssh_conn_t *c = s->ssh;
+    zend_ulong id;
+    qp_ssh_chan_t *ch;
+    bool wrote = false;
+    if (!c) {
+        return false;
+    }
+    c->epoll_fd = epoll_fd;
+    uint64_t now = quicpro_metrics_now_us();
+    ZEND_HASH_FOREACH_NUM_KEY_PTR(&c->chans, id, ch) {
+        wrote |= qp_ssh_chan_step(s, c, id, ch, now);
+    } ZEND_HASH_FOREACH_END();
+    return wrote;
+}
+
+void quicpro_ssh_conn_free(quicpro_ssh_conn_t *c)
+{
+    if (!c) {
+        return;
+    }
+    zend_hash_destroy(&c->chans);
+    efree(c);
+}
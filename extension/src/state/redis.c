@@ -0,0 +1,612 @@
+/*
+ * src/state/redis.c – Redis backend of the state API
+ * ==================================================
+ *
+ * See include/state/state.h. One connection per worker, opened on the
+ * first call and kept across requests; a forked worker never uses its
+ * parent's. The handshake (HELLO 3, SELECT, CLIENT TRACKING) goes out in
+ * one write like every batch after it.
+ *
+ * Replies are parsed into zvals as they come: strings, integers, null and
+ * aggregates; an error reply inside an aggregate becomes false. Pushes
+ * (">") can arrive between replies at any time; an "invalidate" push
+ * drops the keys it names from the local cache, and is otherwise skipped
+ * like attributes ("|"). NOLOOP keeps the writes of this connection from
+ * invalidating what it just cached.
+ */
+
+#include "php_quicpro.h"
+#include "state/state.h"
+#include "state/state_cache.h"
+#include "client/dns.h"
+#include "config/state_management/base_layer.h"
+
+#include <ext/spl/spl_exceptions.h>
+#include <ext/standard/url.h>
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define QP_RD_DEPTH_MAX 8               /* Deeper aggregates are a protocol error */
+
+typedef enum { QP_RD_MORE = -1, QP_RD_BAD = -2 } qp_rd_status_t;
+
+static struct {
+    int     fd;
+    pid_t   pid;                        /* The process that opened it */
+    char   *in;                         /* Input, malloc()ed: it outlives requests */
+    size_t  in_off, in_len, in_cap;     /* Parsed up to in_off */
+} qp_rd = { .fd = -1 };
+
+static inline int64_t qp_rd_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void quicpro_state_redis_close(void)
+{
+    if (qp_rd.fd >= 0 && qp_rd.pid == getpid()) {
+        close(qp_rd.fd);
+    }
+    qp_rd.fd = -1;
+    qp_rd.in_off = qp_rd.in_len = 0;
+    free(qp_rd.in);
+    qp_rd.in = NULL;
+    qp_rd.in_cap = 0;
+}
+
+/*──────────────────────────────── RESP3 ──────────────────────────────────*/
+
+static void qp_rd_arg(smart_str *out, const char *p, size_t len)
+{
+    smart_str_appendc(out, '$');
+    smart_str_append_unsigned(out, len);
+    smart_str_appendl(out, "\r\n", 2);
+    smart_str_appendl(out, p, len);
+    smart_str_appendl(out, "\r\n", 2);
+}
+
+static inline void qp_rd_head(smart_str *out, size_t argc)
+{
+    smart_str_appendc(out, '*');
+    smart_str_append_unsigned(out, argc);
+    smart_str_appendl(out, "\r\n", 2);
+}
+
+/* The line at `p`, up to CRLF: its length, or QP_RD_MORE */
+static ssize_t qp_rd_line(const char *p, const char *end)
+{
+    const char *cr = memchr(p, '\r', (size_t)(end - p));
+    if (!cr || cr + 1 >= end) {
+        return QP_RD_MORE;
+    }
+    return cr[1] == '\n' ? cr - p : QP_RD_BAD;
+}
+
+/*
+ * Parses one value at `p` into `out` (left undefined for QP_RD_MORE and
+ * QP_RD_BAD). `*kind` gets its type byte. Returns the bytes it took.
+ */
+static ssize_t qp_rd_parse(const char *p, const char *end, zval *out, char *kind, int depth)
+{
+    if (p >= end) {
+        return QP_RD_MORE;
+    }
+    ssize_t line = qp_rd_line(p + 1, end);
+    if (line < 0) {
+        return line;
+    }
+    const char *body = p + 1, *next = body + line + 2;
+    char *stop;
+    long long n = 0;
+    *kind = *p;
+    switch (*p) {
+        case '+':                       /* Simple string */
+        case '-':                       /* Simple error */
+            ZVAL_STRINGL(out, body, (size_t)line);
+            return next - p;
+        case ':':                       /* Integer */
+        case '(':                       /* Big number, as far as it fits */
+            ZVAL_LONG(out, (zend_long)strtoll(body, NULL, 10));
+            return next - p;
+        case ',':                       /* Double */
+            ZVAL_DOUBLE(out, zend_strtod(body, NULL));
+            return next - p;
+        case '#':                       /* Boolean */
+            ZVAL_BOOL(out, *body == 't');
+            return next - p;
+        case '_':                       /* Null */
+            ZVAL_NULL(out);
+            return next - p;
+        case '$':                       /* Blob string */
+        case '!':                       /* Blob error */
+        case '=':                       /* Verbatim string */
+            n = strtoll(body, &stop, 10);
+            if (n < 0) {
+                ZVAL_NULL(out);         /* RESP2 null, for servers that still send it */
+                return next - p;
+            }
+            if ((size_t)(end - next) < (size_t)n + 2) {
+                return QP_RD_MORE;
+            }
+            if (next[n] != '\r' || next[n + 1] != '\n') {
+                return QP_RD_BAD;
+            }
+            ZVAL_STRINGL(out, next, (size_t)n);
+            return next + n + 2 - p;
+        case '*':                       /* Array */
+        case '~':                       /* Set */
+        case '>':                       /* Push */
+        case '%':                       /* Map: n pairs */
+        case '|': {                     /* Attribute: n pairs */
+            n = strtoll(body, &stop, 10);
+            if (n < 0) {
+                ZVAL_NULL(out);
+                return next - p;
+            }
+            if (depth >= QP_RD_DEPTH_MAX) {
+                return QP_RD_BAD;
+            }
+            if (n > (long long)(end - next)) {
+                return QP_RD_MORE;      /* Every element takes a few bytes at least */
+            }
+            if (*p == '%' || *p == '|') {
+                n *= 2;                 /* Keys and values, flattened */
+            }
+            array_init_size(out, (uint32_t)n);
+            const char *at = next;
+            for (long long i = 0; i < n; i++) {
+                zval item;
+                char item_kind;
+                ssize_t used = qp_rd_parse(at, end, &item, &item_kind, depth + 1);
+                if (used < 0) {
+                    zval_ptr_dtor(out);
+                    return used;
+                }
+                if (item_kind == '-' || item_kind == '!') {
+                    zval_ptr_dtor(&item);
+                    ZVAL_FALSE(&item);
+                }
+                zend_hash_next_index_insert_new(Z_ARRVAL_P(out), &item);
+                at += used;
+            }
+            return at - p;
+        }
+        default:
+            return QP_RD_BAD;
+    }
+}
+
+/* Drops the keys an "invalidate" push names from the local cache */
+static void qp_rd_on_push(zval *push)
+{
+    zval *what = zend_hash_index_find(Z_ARRVAL_P(push), 0), *keys = zend_hash_index_find(Z_ARRVAL_P(push), 1);
+    zval *key;
+    if (!what || Z_TYPE_P(what) != IS_STRING || !zend_string_equals_literal(Z_STR_P(what), "invalidate")
+        || !keys || Z_TYPE_P(keys) != IS_ARRAY) {
+        return;                         /* A null list (FLUSHALL) leaves it to the entries' lease */
+    }
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(keys), key) {
+        if (Z_TYPE_P(key) == IS_STRING) {
+            quicpro_state_cache_forget(Z_STRVAL_P(key), Z_STRLEN_P(key));
+        }
+    } ZEND_HASH_FOREACH_END();
+}
+
+/*
+ * The next reply from the buffer, pushes and attributes handled on the
+ * way. QP_RD_MORE when it is not all there yet; 1 for the reply, with
+ * `*error` set for an error reply.
+ */
+static int qp_rd_take(zval *out, bool *error)
+{
+    for (;;) {
+        char kind;
+        ssize_t used = qp_rd_parse(qp_rd.in + qp_rd.in_off, qp_rd.in + qp_rd.in_len, out, &kind, 0);
+        if (used < 0) {
+            return (int)used;
+        }
+        qp_rd.in_off += (size_t)used;
+        if (kind == '>' || kind == '|') {
+            if (kind == '>' && Z_TYPE_P(out) == IS_ARRAY) {
+                qp_rd_on_push(out);
+            }
+            zval_ptr_dtor(out);
+            continue;
+        }
+        *error = kind == '-' || kind == '!';
+        return 1;
+    }
+}
+
+/* Reads what the socket has, waiting until `deadline` (-1: not at all); false once it failed or closed */
+static bool qp_rd_fill(int64_t deadline)
+{
+    if (qp_rd.in_off) {                 /* Only what is not parsed yet moves, once per read */
+        memmove(qp_rd.in, qp_rd.in + qp_rd.in_off, qp_rd.in_len - qp_rd.in_off);
+        qp_rd.in_len -= qp_rd.in_off;
+        qp_rd.in_off = 0;
+    }
+    if (qp_rd.in_cap - qp_rd.in_len < 16384) {
+        size_t cap = MAX(qp_rd.in_cap * 2, 65536);
+        char *in = realloc(qp_rd.in, cap);
+        if (!in) {
+            return false;
+        }
+        qp_rd.in = in;
+        qp_rd.in_cap = cap;
+    }
+    for (;;) {
+        ssize_t n = recv(qp_rd.fd, qp_rd.in + qp_rd.in_len, qp_rd.in_cap - qp_rd.in_len, MSG_DONTWAIT);
+        if (n > 0) {
+            qp_rd.in_len += (size_t)n;
+            return true;
+        }
+        if (n == 0) {
+            errno = ECONNRESET;
+            return false;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return false;
+        }
+        if (deadline < 0) {
+            return true;
+        }
+        int64_t left = deadline - qp_rd_now_ms();
+        struct pollfd pfd = { .fd = qp_rd.fd, .events = POLLIN };
+        if (left <= 0 || poll(&pfd, 1, (int)left) <= 0) {
+            errno = ETIMEDOUT;
+            return false;
+        }
+    }
+}
+
+static bool qp_rd_send(const char *p, size_t len, int64_t deadline)
+{
+    while (len) {
+        ssize_t n = send(qp_rd.fd, p, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            p += n;
+            len -= (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return false;
+        }
+        int64_t left = deadline - qp_rd_now_ms();
+        struct pollfd pfd = { .fd = qp_rd.fd, .events = POLLOUT };
+        if (left <= 0 || poll(&pfd, 1, (int)left) <= 0) {
+            errno = ETIMEDOUT;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Sends `cmds` (`count` commands) in one write and reads their replies
+ * into `replies` in order. A failure closes the connection and throws;
+ * error replies are left for the caller, as strings with `errors` set.
+ */
+static bool qp_rd_roundtrip(const smart_str *cmds, size_t count, zval *replies, bool *errors)
+{
+    int64_t deadline = qp_rd_now_ms() + quicpro_state_management_config.request_timeout_ms;
+    size_t got = 0;
+    int r = 0;
+    if (qp_rd_send(ZSTR_VAL(cmds->s), ZSTR_LEN(cmds->s), deadline)) {
+        while (got < count) {
+            r = qp_rd_take(&replies[got], &errors[got]);
+            if (r == 1) {
+                got++;
+            } else if (r == QP_RD_BAD || !qp_rd_fill(deadline)) {
+                break;
+            }
+        }
+    }
+    if (got == count) {
+        return true;
+    }
+    int err = r == QP_RD_BAD ? 0 : errno;
+    for (size_t i = 0; i < got; i++) {
+        zval_ptr_dtor(&replies[i]);
+    }
+    quicpro_state_redis_close();
+    throw_network_exception(err, "State backend redis: %s", r == QP_RD_BAD ? "protocol error" : err ? strerror(err) : "connection closed");
+    return false;
+}
+
+/*──────────────────────────────── Connect ────────────────────────────────*/
+
+static bool qp_rd_connect_addr(const quicpro_dns_addr_t *a, int64_t deadline)
+{
+    int fd = socket(a->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    if (connect(fd, (const struct sockaddr *)&a->addr, a->len) < 0 && errno != EINPROGRESS) {
+        close(fd);
+        return false;
+    }
+    struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+    int64_t left = deadline - qp_rd_now_ms();
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (left <= 0 || poll(&pfd, 1, (int)left) != 1 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err) {
+        close(fd);
+        errno = err ? err : ETIMEDOUT;
+        return false;
+    }
+    qp_rd.fd = fd;
+    qp_rd.pid = getpid();
+    return true;
+}
+
+/* The worker's connection, opened and set up if need be; false after throwing */
+static bool qp_rd_ready(void)
+{
+    if (qp_rd.fd >= 0 && qp_rd.pid == getpid()) {
+        return true;
+    }
+    qp_rd.fd = -1;                      /* The parent's, if any: it goes on using it */
+    qp_rd.in_off = qp_rd.in_len = 0;
+
+    const char *uri = quicpro_state_management_config.default_uri;
+    php_url *url = uri && *uri ? php_url_parse(uri) : NULL;
+    if (!url || !url->host) {
+        if (url) php_url_free(url);
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "quicpro.state_manager_default_uri is not a redis://host[:port][/db] URI");
+        return false;
+    }
+
+    quicpro_dns_addr_t addrs[QUICPRO_DNS_MAX_ADDRS];
+    int count = quicpro_dns_resolve(ZSTR_VAL(url->host), url->port ? url->port : 6379, AF_UNSPEC, addrs, QUICPRO_DNS_MAX_ADDRS);
+    int64_t deadline = qp_rd_now_ms() + quicpro_state_management_config.request_timeout_ms;
+    for (int i = 0; i < count && qp_rd.fd < 0; i++) {
+        qp_rd_connect_addr(&addrs[i], deadline);
+    }
+    if (qp_rd.fd < 0) {
+        if (count > 0) {
+            throw_network_exception(errno, "State backend redis: cannot connect to %s: %s", ZSTR_VAL(url->host), strerror(errno));
+        }
+        php_url_free(url);
+        return false;
+    }
+
+    smart_str cmds = {0};
+    size_t n = 0;
+    if (url->pass) {
+        const char *user = url->user ? ZSTR_VAL(url->user) : "default";
+        qp_rd_head(&cmds, 5);
+        qp_rd_arg(&cmds, "HELLO", 5);
+        qp_rd_arg(&cmds, "3", 1);
+        qp_rd_arg(&cmds, "AUTH", 4);
+        qp_rd_arg(&cmds, user, strlen(user));
+        qp_rd_arg(&cmds, ZSTR_VAL(url->pass), ZSTR_LEN(url->pass));
+    } else {
+        qp_rd_head(&cmds, 2);
+        qp_rd_arg(&cmds, "HELLO", 5);
+        qp_rd_arg(&cmds, "3", 1);
+    }
+    n++;
+    const char *db = url->path ? ZSTR_VAL(url->path) + strspn(ZSTR_VAL(url->path), "/") : "";
+    if (*db) {
+        qp_rd_head(&cmds, 2);
+        qp_rd_arg(&cmds, "SELECT", 6);
+        qp_rd_arg(&cmds, db, strlen(db));
+        n++;
+    }
+    if (quicpro_state_management_config.local_cache_enable) {
+        qp_rd_head(&cmds, 4);
+        qp_rd_arg(&cmds, "CLIENT", 6);
+        qp_rd_arg(&cmds, "TRACKING", 8);
+        qp_rd_arg(&cmds, "ON", 2);
+        qp_rd_arg(&cmds, "NOLOOP", 6);
+        n++;
+    }
+    smart_str_0(&cmds);
+    php_url_free(url);
+
+    zval replies[3];
+    bool errors[3] = {false};
+    bool ok = qp_rd_roundtrip(&cmds, n, replies, errors);
+    smart_str_free(&cmds);
+    if (!ok) {
+        return false;
+    }
+    const char *failed = NULL;
+    for (size_t i = 0; i < n; i++) {
+        if (errors[i] && !failed) {
+            failed = Z_STRVAL(replies[i]);
+            throw_network_exception(0, "State backend redis refused the connection: %s", failed);
+        }
+        zval_ptr_dtor(&replies[i]);
+    }
+    if (failed) {
+        quicpro_state_redis_close();
+        return false;
+    }
+    return true;
+}
+
+/*──────────────────────────────── Backend ────────────────────────────────*/
+
+/* Takes the invalidations that arrived since the last call, without waiting for any */
+static void qp_rd_sync(void)
+{
+    if (qp_rd.fd < 0 || qp_rd.pid != getpid()) {
+        return;
+    }
+    if (!qp_rd_fill(-1)) {
+        quicpro_state_redis_close();    /* Closed while idle: the next call reconnects */
+        return;
+    }
+    zval push;
+    bool error;
+    while (qp_rd.in_off < qp_rd.in_len && qp_rd.in[qp_rd.in_off] == '>' && qp_rd_take(&push, &error) == 1) {
+        zval_ptr_dtor(&push);           /* Never a reply: none is outstanding */
+    }
+}
+
+static bool qp_rd_get(zend_string *const *keys, size_t n, zend_string **values, uint64_t *versions)
+{
+    if (!qp_rd_ready()) {
+        return false;
+    }
+    smart_str cmds = {0};
+    for (size_t i = 0; i < n; i++) {
+        qp_rd_head(&cmds, 4);
+        qp_rd_arg(&cmds, "HMGET", 5);
+        qp_rd_arg(&cmds, ZSTR_VAL(keys[i]), ZSTR_LEN(keys[i]));
+        qp_rd_arg(&cmds, "v", 1);
+        qp_rd_arg(&cmds, "n", 1);
+    }
+    smart_str_0(&cmds);
+    zval *replies = safe_emalloc(n, sizeof(zval), 0);
+    bool *errors = ecalloc(n, sizeof(bool));
+    bool ok = qp_rd_roundtrip(&cmds, n, replies, errors);
+    smart_str_free(&cmds);
+    if (!ok) {
+        efree(replies);
+        efree(errors);
+        return false;
+    }
+
+    const char *failed = NULL;
+    for (size_t i = 0; i < n; i++) {
+        zval *v = NULL, *ver = NULL;
+        values[i] = NULL;
+        versions[i] = 0;
+        if (errors[i]) {
+            failed = failed ? failed : Z_STRVAL(replies[i]);
+            continue;
+        }
+        if (Z_TYPE(replies[i]) == IS_ARRAY) {
+            v = zend_hash_index_find(Z_ARRVAL(replies[i]), 0);
+            ver = zend_hash_index_find(Z_ARRVAL(replies[i]), 1);
+        }
+        if (v && Z_TYPE_P(v) == IS_STRING) {
+            values[i] = zend_string_copy(Z_STR_P(v));
+            versions[i] = ver && Z_TYPE_P(ver) == IS_STRING ? (uint64_t)ZEND_STRTOUL(Z_STRVAL_P(ver), NULL, 10) : 0;
+        }
+    }
+    if (failed) {
+        throw_network_exception(0, "State backend redis: %s", failed);
+        for (size_t i = 0; i < n; i++) {
+            if (values[i]) zend_string_release(values[i]);
+            values[i] = NULL;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        zval_ptr_dtor(&replies[i]);
+    }
+    efree(replies);
+    efree(errors);
+    return !failed;
+}
+
+/* One transaction for the batch: every value lands with its version, or none does */
+static bool qp_rd_set(zend_string *const *keys, zend_string *const *values, size_t n, uint64_t *versions)
+{
+    if (!qp_rd_ready()) {
+        return false;
+    }
+    smart_str cmds = {0};
+    qp_rd_head(&cmds, 1);
+    qp_rd_arg(&cmds, "MULTI", 5);
+    for (size_t i = 0; i < n; i++) {
+        qp_rd_head(&cmds, 4);
+        qp_rd_arg(&cmds, "HINCRBY", 7);
+        qp_rd_arg(&cmds, ZSTR_VAL(keys[i]), ZSTR_LEN(keys[i]));
+        qp_rd_arg(&cmds, "n", 1);
+        qp_rd_arg(&cmds, "1", 1);
+        qp_rd_head(&cmds, 4);
+        qp_rd_arg(&cmds, "HSET", 4);
+        qp_rd_arg(&cmds, ZSTR_VAL(keys[i]), ZSTR_LEN(keys[i]));
+        qp_rd_arg(&cmds, "v", 1);
+        qp_rd_arg(&cmds, ZSTR_VAL(values[i]), ZSTR_LEN(values[i]));
+    }
+    qp_rd_head(&cmds, 1);
+    qp_rd_arg(&cmds, "EXEC", 4);
+    smart_str_0(&cmds);
+
+    size_t count = 2 * n + 2;           /* +OK, +QUEUED per command, then EXEC's array */
+    zval *replies = safe_emalloc(count, sizeof(zval), 0);
+    bool *errors = ecalloc(count, sizeof(bool));
+    bool ok = qp_rd_roundtrip(&cmds, count, replies, errors);
+    smart_str_free(&cmds);
+    if (!ok) {
+        efree(replies);
+        efree(errors);
+        return false;
+    }
+
+    zval *exec = &replies[count - 1];
+    const char *failed = NULL;
+    for (size_t i = 0; i < count && !failed; i++) {
+        failed = errors[i] ? Z_STRVAL(replies[i]) : NULL;
+    }
+    if (!failed && (Z_TYPE_P(exec) != IS_ARRAY || zend_hash_num_elements(Z_ARRVAL_P(exec)) != 2 * n)) {
+        failed = "transaction aborted";
+    }
+    for (size_t i = 0; !failed && i < n; i++) {
+        zval *ver = zend_hash_index_find(Z_ARRVAL_P(exec), 2 * i);
+        if (!ver || Z_TYPE_P(ver) != IS_LONG) {
+            failed = "a key holds something other than state";
+        } else {
+            versions[i] = (uint64_t)Z_LVAL_P(ver);
+        }
+    }
+    if (failed) {
+        throw_network_exception(0, "State backend redis: %s", failed);
+    }
+    for (size_t i = 0; i < count; i++) {
+        zval_ptr_dtor(&replies[i]);
+    }
+    efree(replies);
+    efree(errors);
+    return !failed;
+}
+
+static bool qp_rd_del(zend_string *const *keys, size_t n)
+{
+    if (!qp_rd_ready()) {
+        return false;
+    }
+    smart_str cmds = {0};
+    qp_rd_head(&cmds, n + 1);
+    qp_rd_arg(&cmds, "DEL", 3);
+    for (size_t i = 0; i < n; i++) {
+        qp_rd_arg(&cmds, ZSTR_VAL(keys[i]), ZSTR_LEN(keys[i]));
+    }
+    smart_str_0(&cmds);
+    zval reply;
+    bool error = false;
+    bool ok = qp_rd_roundtrip(&cmds, 1, &reply, &error);
+    smart_str_free(&cmds);
+    if (!ok) {
+        return false;
+    }
+    if (error) {
+        throw_network_exception(0, "State backend redis: %s", Z_STRVAL(reply));
+    }
+    zval_ptr_dtor(&reply);
+    return !error;
+}
+
+const quicpro_state_backend_t quicpro_state_redis_backend = {
+    .sync   = qp_rd_sync,
+    .get    = qp_rd_get,
+    .set    = qp_rd_set,
+    .del    = qp_rd_del,
+    .remote = true,
+};
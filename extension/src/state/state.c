@@ -0,0 +1,533 @@
+/*
+ * src/state/state.c – Key-value state for agents
+ * ==============================================
+ *
+ * See include/state/state.h. The functions validate the keys, take what
+ * a remote backend's answers the local cache already holds, and hand the
+ * rest to the backend as one batch. This file also holds the "memory"
+ * and "mcp" backends; the Redis one is src/state/redis.c.
+ */
+
+#include "php_quicpro.h"
+#include "state/state.h"
+#include "state/state_cache.h"
+#include "config/config.h"
+#include "config/state_management/base_layer.h"
+#include "mcp/mcp.h"
+
+#include <ext/spl/spl_exceptions.h>
+#include <ext/standard/url.h>
+#include <zend_exceptions.h>
+#include <zend_smart_str.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*──────────────────────────────── Memory ─────────────────────────────────*/
+
+typedef struct {
+    uint64_t     version;
+    zend_string *value;                 /* Persistent */
+} qp_state_mem_entry_t;
+
+/* Persistent, so that it lasts as long as the worker rather than the request */
+static HashTable *qp_state_mem;
+
+static void qp_state_mem_dtor(zval *zv)
+{
+    qp_state_mem_entry_t *e = Z_PTR_P(zv);
+    zend_string_release(e->value);
+    pefree(e, 1);
+}
+
+static bool qp_state_mem_get(zend_string *const *keys, size_t n, zend_string **values, uint64_t *versions)
+{
+    for (size_t i = 0; i < n; i++) {
+        qp_state_mem_entry_t *e = qp_state_mem ? zend_hash_find_ptr(qp_state_mem, keys[i]) : NULL;
+        values[i] = e ? zend_string_init(ZSTR_VAL(e->value), ZSTR_LEN(e->value), 0) : NULL;
+        versions[i] = e ? e->version : 0;
+    }
+    return true;
+}
+
+static bool qp_state_mem_set(zend_string *const *keys, zend_string *const *values, size_t n, uint64_t *versions)
+{
+    if (!qp_state_mem) {
+        qp_state_mem = pemalloc(sizeof(HashTable), 1);
+        zend_hash_init(qp_state_mem, 64, NULL, qp_state_mem_dtor, 1);
+    }
+    for (size_t i = 0; i < n; i++) {
+        qp_state_mem_entry_t *e = zend_hash_str_find_ptr(qp_state_mem, ZSTR_VAL(keys[i]), ZSTR_LEN(keys[i]));
+        if (!e) {
+            e = pecalloc(1, sizeof(*e), 1);
+            zend_hash_str_add_new_ptr(qp_state_mem, ZSTR_VAL(keys[i]), ZSTR_LEN(keys[i]), e);
+        } else {
+            zend_string_release(e->value);
+        }
+        e->value = zend_string_init(ZSTR_VAL(values[i]), ZSTR_LEN(values[i]), 1);
+        versions[i] = ++e->version;
+    }
+    return true;
+}
+
+static bool qp_state_mem_del(zend_string *const *keys, size_t n)
+{
+    for (size_t i = 0; i < n && qp_state_mem; i++) {
+        zend_hash_str_del(qp_state_mem, ZSTR_VAL(keys[i]), ZSTR_LEN(keys[i]));
+    }
+    return true;
+}
+
+static const quicpro_state_backend_t qp_state_memory_backend = {
+    .get    = qp_state_mem_get,
+    .set    = qp_state_mem_set,
+    .del    = qp_state_mem_del,
+    .remote = false,
+};
+
+/*──────────────────────────────── MCP ────────────────────────────────────*/
+
+/* The request's Config for the state agent; a resource, so it outlives the pooled sessions using it */
+static quicpro_cfg_t *qp_state_mcp_cfg;
+
+/* One call to the state agent; the reply goes to `*reply`. False after throwing. */
+static bool qp_state_mcp_call(const char *method, smart_str *payload, zend_string **reply)
+{
+    const char *uri = quicpro_state_management_config.default_uri;
+    php_url *url = uri && *uri ? php_url_parse(uri) : NULL;
+    if (!url || !url->host || !url->port) {
+        if (url) php_url_free(url);
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "quicpro.state_manager_default_uri is not an mcp://host:port URI");
+        return false;
+    }
+    if (!qp_state_mcp_cfg) {
+        zend_resource *cfg_res = quicpro_config_default();
+        if (!cfg_res) {
+            php_url_free(url);
+            return false;
+        }
+        qp_state_mcp_cfg = (quicpro_cfg_t *)cfg_res->ptr;
+    }
+    zend_resource *res = quicpro_mcp_open(ZSTR_VAL(url->host), ZSTR_LEN(url->host), url->port, qp_state_mcp_cfg, NULL);
+    php_url_free(url);
+    if (!res) {
+        return false;
+    }
+
+    zval z_session, z_payload, z_reply, options;
+    ZVAL_RES(&z_session, res);
+    smart_str_0(payload);
+    ZVAL_STR(&z_payload, payload->s ? payload->s : ZSTR_EMPTY_ALLOC());
+    payload->s = NULL;
+    array_init(&options);
+    add_assoc_long(&options, "timeout_ms", quicpro_state_management_config.request_timeout_ms);
+    int result = quicpro_mcp_call((quicpro_session_t *)res->ptr, "state", method, &z_payload, Z_ARRVAL(options), &z_reply, NULL);
+    zval_ptr_dtor(&options);
+    zval_ptr_dtor(&z_payload);
+    zval_ptr_dtor(&z_session);          /* Back to the pool, or closed */
+    if (result == FAILURE) {
+        return false;
+    }
+    *reply = Z_STR(z_reply);
+    return true;
+}
+
+static bool qp_state_mcp_get(zend_string *const *keys, size_t n, zend_string **values, uint64_t *versions)
+{
+    smart_str payload = {0};
+    zend_string *reply;
+    for (size_t i = 0; i < n; i++) {
+        smart_str_append(&payload, keys[i]);
+        smart_str_appendc(&payload, '\n');
+    }
+    if (!qp_state_mcp_call("get", &payload, &reply)) {
+        return false;
+    }
+
+    const char *p = ZSTR_VAL(reply), *end = p + ZSTR_LEN(reply);
+    size_t i = 0;
+    for (; i < n; i++) {
+        char *stop;
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        uint64_t version = nl ? (uint64_t)strtoull(p, &stop, 10) : 0;
+        size_t len = nl && *stop == ' ' ? (size_t)strtoull(stop + 1, &stop, 10) : 0;
+        if (!nl || stop != nl || len > (size_t)(end - nl - 1)) {
+            break;
+        }
+        values[i] = version ? zend_string_init(nl + 1, len, 0) : NULL;
+        versions[i] = version;
+        p = nl + 1 + len;
+    }
+    zend_string_release(reply);
+    if (i < n) {
+        while (i--) {
+            if (values[i]) zend_string_release(values[i]);
+        }
+        throw_network_exception(0, "State backend mcp: malformed reply to get");
+        return false;
+    }
+    return true;
+}
+
+static bool qp_state_mcp_set(zend_string *const *keys, zend_string *const *values, size_t n, uint64_t *versions)
+{
+    smart_str payload = {0};
+    zend_string *reply;
+    for (size_t i = 0; i < n; i++) {
+        smart_str_append(&payload, keys[i]);
+        smart_str_appendc(&payload, '\n');
+        smart_str_append_unsigned(&payload, ZSTR_LEN(values[i]));
+        smart_str_appendc(&payload, '\n');
+        smart_str_append(&payload, values[i]);
+    }
+    if (!qp_state_mcp_call("set", &payload, &reply)) {
+        return false;
+    }
+
+    const char *p = ZSTR_VAL(reply), *end = p + ZSTR_LEN(reply);
+    size_t i = 0;
+    for (; i < n; i++) {
+        char *stop;
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        versions[i] = nl ? (uint64_t)strtoull(p, &stop, 10) : 0;
+        if (!nl || stop != nl || !versions[i]) {
+            break;
+        }
+        p = nl + 1;
+    }
+    zend_string_release(reply);
+    if (i < n) {
+        throw_network_exception(0, "State backend mcp: malformed reply to set");
+        return false;
+    }
+    return true;
+}
+
+static bool qp_state_mcp_del(zend_string *const *keys, size_t n)
+{
+    smart_str payload = {0};
+    zend_string *reply;
+    for (size_t i = 0; i < n; i++) {
+        smart_str_append(&payload, keys[i]);
+        smart_str_appendc(&payload, '\n');
+    }
+    if (!qp_state_mcp_call("delete", &payload, &reply)) {
+        return false;
+    }
+    zend_string_release(reply);
+    return true;
+}
+
+static const quicpro_state_backend_t qp_state_mcp_backend = {
+    .get    = qp_state_mcp_get,
+    .set    = qp_state_mcp_set,
+    .del    = qp_state_mcp_del,
+    .remote = true,
+};
+
+/*──────────────────────────────── Calls ──────────────────────────────────*/
+
+/* The configured backend, or NULL after throwing */
+static const quicpro_state_backend_t *qp_state_backend(void)
+{
+    const char *name = quicpro_state_management_config.default_backend;
+    if (!name || strcmp(name, "memory") == 0) {
+        return &qp_state_memory_backend;
+    }
+    if (strcmp(name, "redis") == 0) {
+        return &quicpro_state_redis_backend;
+    }
+    if (strcmp(name, "mcp") == 0) {
+        return &qp_state_mcp_backend;
+    }
+    zend_throw_exception_ex(NULL, 0, "quicpro.state_manager_default_backend \"%s\" is not served by the state API", name);
+    return NULL;
+}
+
+static bool qp_state_key_valid(const zend_string *key)
+{
+    if (ZSTR_LEN(key) == 0 || ZSTR_LEN(key) > QUICPRO_STATE_KEY_MAX || memchr(ZSTR_VAL(key), '\n', ZSTR_LEN(key))) {
+        zend_throw_exception_ex(spl_ce_InvalidArgumentException, 0,
+            "State keys are 1 to %d bytes without a newline", QUICPRO_STATE_KEY_MAX);
+        return false;
+    }
+    return true;
+}
+
+/* Misses go to the backend in one batch, which the cache then keeps */
+bool quicpro_state_fetch(zend_string *const *keys, size_t n, zend_string **values)
+{
+    const quicpro_state_backend_t *b = qp_state_backend();
+    if (!b) {
+        return false;
+    }
+    if (!b->remote) {
+        uint64_t *versions = safe_emalloc(n, sizeof(uint64_t), 0);
+        bool ok = b->get(keys, n, values, versions);
+        efree(versions);
+        return ok;
+    }
+
+    if (b->sync) {
+        b->sync();
+    }
+    zend_string **missed = safe_emalloc(n, sizeof(zend_string *), 0);
+    size_t *at = safe_emalloc(n, sizeof(size_t), 0);
+    size_t misses = 0;
+    for (size_t i = 0; i < n; i++) {
+        values[i] = quicpro_state_cache_get(ZSTR_VAL(keys[i]), ZSTR_LEN(keys[i]), NULL);
+        if (!values[i]) {
+            missed[misses] = keys[i];
+            at[misses++] = i;
+        }
+    }
+
+    bool ok = true;
+    if (misses) {
+        zend_string **got = safe_emalloc(misses, sizeof(zend_string *), 0);
+        uint64_t *versions = safe_emalloc(misses, sizeof(uint64_t), 0);
+        ok = b->get(missed, misses, got, versions);
+        for (size_t j = 0; ok && j < misses; j++) {
+            values[at[j]] = got[j];
+            if (got[j]) {
+                quicpro_state_cache_put(ZSTR_VAL(missed[j]), ZSTR_LEN(missed[j]), got[j], versions[j]);
+            }
+        }
+        efree(got);
+        efree(versions);
+    }
+    if (!ok) {
+        for (size_t i = 0; i < n; i++) {
+            if (values[i]) zend_string_release(values[i]);
+        }
+    }
+    efree(missed);
+    efree(at);
+    return ok;
+}
+
+/* What a remote backend took is kept by the local cache as well */
+bool quicpro_state_store(zend_string *const *keys, zend_string *const *values, size_t n, uint64_t *versions)
+{
+    const quicpro_state_backend_t *b = qp_state_backend();
+    if (!b || !b->set(keys, values, n, versions)) {
+        if (b && b->remote) {
+            /* The batch may have landed all the same: what is kept would be stale */
+            for (size_t i = 0; i < n; i++) {
+                quicpro_state_cache_forget(ZSTR_VAL(keys[i]), ZSTR_LEN(keys[i]));
+            }
+        }
+        return false;
+    }
+    for (size_t i = 0; b->remote && i < n; i++) {
+        quicpro_state_cache_put(ZSTR_VAL(keys[i]), ZSTR_LEN(keys[i]), values[i], versions[i]);
+    }
+    return true;
+}
+
+bool quicpro_state_remove(zend_string *const *keys, size_t n)
+{
+    const quicpro_state_backend_t *b = qp_state_backend();
+    if (!b) {
+        return false;
+    }
+    bool ok = b->del(keys, n);
+    for (size_t i = 0; b->remote && i < n; i++) {
+        /* Even after a failure: the keys may be gone all the same */
+        quicpro_state_cache_forget(ZSTR_VAL(keys[i]), ZSTR_LEN(keys[i]));
+    }
+    return ok;
+}
+
+/*──────────────────────────── PHP functions ──────────────────────────────*/
+
+PHP_FUNCTION(quicpro_state_get)
+{
+    zend_string *key, *value;
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(key)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (!qp_state_key_valid(key) || !quicpro_state_fetch(&key, 1, &value)) {
+        RETURN_THROWS();
+    }
+    if (!value) {
+        RETURN_NULL();
+    }
+    RETURN_STR(value);
+}
+
+PHP_FUNCTION(quicpro_state_mget)
+{
+    HashTable *keys_ht;
+    zval *zkey;
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT(keys_ht)
+    ZEND_PARSE_PARAMETERS_END();
+
+    uint32_t count = zend_hash_num_elements(keys_ht);
+    zend_string **keys = safe_emalloc(count, sizeof(zend_string *), 0);
+    size_t n = 0;
+    ZEND_HASH_FOREACH_VAL(keys_ht, zkey) {
+        keys[n] = zval_try_get_string(zkey);
+        if (!keys[n] || !qp_state_key_valid(keys[n])) {
+            if (keys[n]) zend_string_release(keys[n]);
+            goto fail;
+        }
+        n++;
+    } ZEND_HASH_FOREACH_END();
+
+    zend_string **values = safe_emalloc(n, sizeof(zend_string *), 0);
+    if (!quicpro_state_fetch(keys, n, values)) {
+        efree(values);
+        goto fail;
+    }
+    array_init_size(return_value, (uint32_t)n);
+    for (size_t i = 0; i < n; i++) {
+        zval v;
+        if (values[i]) {
+            ZVAL_STR(&v, values[i]);
+        } else {
+            ZVAL_NULL(&v);
+        }
+        zend_symtable_update(Z_ARRVAL_P(return_value), keys[i], &v);
+        zend_string_release(keys[i]);
+    }
+    efree(values);
+    efree(keys);
+    return;
+
+fail:
+    while (n--) {
+        zend_string_release(keys[n]);
+    }
+    efree(keys);
+    RETURN_THROWS();
+}
+
+PHP_FUNCTION(quicpro_state_set)
+{
+    zend_string *key, *value;
+    uint64_t version;
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_STR(key)
+        Z_PARAM_STR(value)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (!qp_state_key_valid(key) || !quicpro_state_store(&key, &value, 1, &version)) {
+        RETURN_THROWS();
+    }
+    RETURN_LONG((zend_long)version);
+}
+
+PHP_FUNCTION(quicpro_state_mset)
+{
+    HashTable *values_ht;
+    zend_string *zkey;
+    zend_ulong index;
+    zval *zvalue;
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT(values_ht)
+    ZEND_PARSE_PARAMETERS_END();
+
+    uint32_t count = zend_hash_num_elements(values_ht);
+    zend_string **keys = safe_emalloc(count, sizeof(zend_string *), 0);
+    zend_string **values = safe_emalloc(count, sizeof(zend_string *), 0);
+    uint64_t *versions = safe_emalloc(count, sizeof(uint64_t), 0);
+    size_t n = 0;
+    bool ok = true;
+    ZEND_HASH_FOREACH_KEY_VAL(values_ht, index, zkey, zvalue) {
+        keys[n] = zkey ? zend_string_copy(zkey) : zend_long_to_str((zend_long)index);
+        values[n] = zval_try_get_string(zvalue);
+        if (!values[n] || !qp_state_key_valid(keys[n])) {
+            zend_string_release(keys[n]);
+            if (values[n]) zend_string_release(values[n]);
+            ok = false;
+            break;
+        }
+        n++;
+    } ZEND_HASH_FOREACH_END();
+
+    if (ok && n) {
+        ok = quicpro_state_store(keys, values, n, versions);
+    }
+    if (ok) {
+        array_init_size(return_value, (uint32_t)n);
+        for (size_t i = 0; i < n; i++) {
+            zval v;
+            ZVAL_LONG(&v, (zend_long)versions[i]);
+            zend_symtable_update(Z_ARRVAL_P(return_value), keys[i], &v);
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        zend_string_release(keys[i]);
+        zend_string_release(values[i]);
+    }
+    efree(keys);
+    efree(values);
+    efree(versions);
+    if (!ok) {
+        RETURN_THROWS();
+    }
+}
+
+PHP_FUNCTION(quicpro_state_delete)
+{
+    zend_string *key = NULL;
+    HashTable *keys_ht = NULL;
+    zval *zkey;
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT_OR_STR(keys_ht, key)
+    ZEND_PARSE_PARAMETERS_END();
+
+    uint32_t count = keys_ht ? zend_hash_num_elements(keys_ht) : 1;
+    zend_string **keys = safe_emalloc(count, sizeof(zend_string *), 0);
+    size_t n = 0;
+    bool ok = true;
+    if (key) {
+        keys[n++] = zend_string_copy(key);
+        ok = qp_state_key_valid(key);
+    } else {
+        ZEND_HASH_FOREACH_VAL(keys_ht, zkey) {
+            zend_string *k = zval_try_get_string(zkey);
+            if (!k) {
+                ok = false;
+                break;
+            }
+            keys[n++] = k;
+            if (!qp_state_key_valid(k)) {
+                ok = false;
+                break;
+            }
+        } ZEND_HASH_FOREACH_END();
+    }
+
+    if (ok && n) {
+        ok = quicpro_state_remove(keys, n);
+    }
+    for (size_t i = 0; i < n; i++) {
+        zend_string_release(keys[i]);
+    }
+    efree(keys);
+    if (!ok) {
+        RETURN_THROWS();
+    }
+    RETURN_TRUE;
+}
+
+/*──────────────────────────────── Lifecycle ──────────────────────────────*/
+
+void quicpro_state_rshutdown(void)
+{
+    qp_state_mcp_cfg = NULL;            /* Freed with the request's resources */
+}
+
+void quicpro_state_mshutdown(void)
+{
+    quicpro_state_redis_close();
+    if (qp_state_mem) {
+        zend_hash_destroy(qp_state_mem);
+        pefree(qp_state_mem, 1);
+        qp_state_mem = NULL;
+    }
+}
@@ -0,0 +1,141 @@
+/*
+ * src/state/state_cache.c – Local read-through cache of the state API
+ * ===================================================================
+ *
+ * See include/state/state_cache.h. The table is a cluster/shm_cache.h
+ * slot table whose slot size is fixed when it is mapped. A slot holds
+ * the key itself, as keys are short.
+ */
+
+#include "php_quicpro.h"
+#include "state/state.h"
+#include "state/state_cache.h"
+#include "cluster/shm_cache.h"
+#include "config/state_management/base_layer.h"
+
+#include <string.h>
+#include <sys/mman.h>
+
+typedef struct {
+    quicpro_shm_cache_slot_t head;  /* Key: hash of the key */
+    uint64_t      version;
+    uint16_t      key_len;
+    uint32_t      len;
+    char          name[QUICPRO_STATE_KEY_MAX];
+    unsigned char value[];
+} qp_state_slot_t;
+
+static quicpro_shm_cache_t qp_state_table;
+
+static bool qp_state_map(int flags)
+{
+    const qp_state_management_config_t *cfg = &quicpro_state_management_config;
+    return quicpro_shm_cache_map(&qp_state_table, (size_t)cfg->local_cache_entries,
+                                 sizeof(qp_state_slot_t) + (size_t)cfg->local_cache_entry_max_kb * 1024, flags);
+}
+
+static bool qp_state_ready(size_t key_len)
+{
+    if (!quicpro_state_management_config.local_cache_enable || key_len == 0 || key_len > QUICPRO_STATE_KEY_MAX) {
+        return false;
+    }
+    /* Outside a cluster nobody prepared it; a private table still serves this process */
+    return qp_state_table.slots || qp_state_map(MAP_PRIVATE);
+}
+
+static inline bool qp_state_holds(const qp_state_slot_t *slot, uint64_t h, const char *name, size_t key_len)
+{
+    return quicpro_shm_cache_holds(&slot->head, h) && slot->key_len == key_len && memcmp(slot->name, name, key_len) == 0;
+}
+
+/*──────────────────────────── Lifecycle ──────────────────────────────────*/
+
+void quicpro_state_cache_prepare(void)
+{
+    if (qp_state_table.slots || !quicpro_state_management_config.local_cache_enable) {
+        return;
+    }
+    if (!qp_state_map(MAP_SHARED)) {
+        php_error_docref(NULL, E_WARNING, "Shared state cache unavailable; every worker falls back to its own");
+    }
+}
+
+void quicpro_state_cache_release(void)
+{
+    quicpro_shm_cache_unmap(&qp_state_table);
+}
+
+/*──────────────────────────── Lookup / store ─────────────────────────────*/
+
+zend_string *quicpro_state_cache_get(const char *key, size_t key_len, uint64_t *version)
+{
+    if (!qp_state_ready(key_len)) {
+        return NULL;
+    }
+    uint64_t h = zend_inline_hash_func(key, key_len) | 1;
+    uint64_t now = quicpro_shm_cache_now_ms();
+    for (size_t way = 0; way < 2; way++) {
+        qp_state_slot_t *slot = (qp_state_slot_t *)quicpro_shm_cache_find(&qp_state_table, h, way);
+        if (!slot) {
+            continue;
+        }
+        zend_string *value = NULL;
+        if (qp_state_holds(slot, h, key, key_len) && quicpro_shm_cache_live(&slot->head, h, now)) {
+            value = zend_string_init((const char *)slot->value, slot->len, 0);
+            if (version) {
+                *version = slot->version;
+            }
+        }
+        quicpro_shm_cache_unlock(&slot->head);
+        if (value) {
+            return value;
+        }
+    }
+    return NULL;
+}
+
+void quicpro_state_cache_put(const char *key, size_t key_len, const zend_string *value, uint64_t version)
+{
+    if (!qp_state_ready(key_len)) {
+        return;
+    }
+    if (ZSTR_LEN(value) > qp_state_table.slot_size - sizeof(qp_state_slot_t)) {
+        quicpro_state_cache_forget(key, key_len);  /* An older version must not outlive this one */
+        return;
+    }
+
+    uint64_t h = zend_inline_hash_func(key, key_len) | 1;
+    uint64_t now = quicpro_shm_cache_now_ms();
+    qp_state_slot_t *slot = (qp_state_slot_t *)quicpro_shm_cache_claim(&qp_state_table, h, now);
+    if (!slot) {
+        return;
+    }
+    if (qp_state_holds(slot, h, key, key_len) && slot->version > version && quicpro_shm_cache_live(&slot->head, h, now)) {
+        quicpro_shm_cache_unlock(&slot->head);     /* A newer write got here first */
+        return;
+    }
+    quicpro_shm_cache_set(&slot->head, h, now + (uint64_t)quicpro_state_management_config.local_cache_ttl_ms);
+    slot->version = version;
+    slot->key_len = (uint16_t)key_len;
+    memcpy(slot->name, key, key_len);
+    slot->len = (uint32_t)ZSTR_LEN(value);
+    memcpy(slot->value, ZSTR_VAL(value), ZSTR_LEN(value));
+    quicpro_shm_cache_unlock(&slot->head);
+}
+
+void quicpro_state_cache_forget(const char *key, size_t key_len)
+{
+    if (!qp_state_ready(key_len)) {
+        return;
+    }
+    uint64_t h = zend_inline_hash_func(key, key_len) | 1;
+    for (size_t way = 0; way < 2; way++) {
+        qp_state_slot_t *slot = (qp_state_slot_t *)quicpro_shm_cache_find(&qp_state_table, h, way);
+        if (slot) {
+            if (qp_state_holds(slot, h, key, key_len)) {
+                quicpro_shm_cache_clear(&slot->head);
+            }
+            quicpro_shm_cache_unlock(&slot->head);
+        }
+    }
+}
@@ -9,6 +9,7 @@ help_box "Project Make Targets" \
   "unit       → Runs PHPUnit tests for PHP 8.1–8.4 using Docker containers" \
   "fuzz       → Starts C-layer fuzz harnesses to expose edge-case bugs" \
   "benchmark  → Executes performance benchmarks via Pulumi and Hetzner Cloud - requires API key - we run real servers" \
+  "netem-benchmark → QUIC vs. TCP/HTTP2 under tc netem profiles (satellite, LTE, …) in docker-compose" \
   "deploy     → Publishes artifacts or triggers GitHub Actions workflow" \
   "tree       → Helper for tree view of the lib" \
   "ext-tree   → Helper for tree view of the extension" \
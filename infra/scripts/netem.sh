@@ -0,0 +1,47 @@
+#!/usr/bin/env bash
+#───────────────────────────────────────────────────────────────────────────────
+# NETEM.SH
+# Link impairment profiles for the netem benchmark lab (run-netem-benchmark.sh).
+#
+# Each profile shapes the egress of both lab containers, so the delay and
+# loss below apply once per direction: the RTT is twice the delay. Rates
+# are (server → client, client → server), i.e. download and upload.
+#
+#   profile        delay   jitter  loss          down      up
+#   datacenter     0.1ms   0.02ms  0%            10gbit    10gbit
+#   transatlantic  40ms    2ms     0.05%         1gbit     1gbit
+#   lossy-lte      30ms    10ms    1.5% (bursty) 20mbit    5mbit
+#   satellite      300ms   5ms     0.5%          50mbit    5mbit
+#
+# USAGE:
+#   source netem.sh
+#   netem_apply container profile server|client
+#   netem_clear container
+#───────────────────────────────────────────────────────────────────────────────
+
+NETEM_PROFILES=(datacenter transatlantic lossy-lte satellite)
+
+# Prints the netem arguments of profile $1 for side $2 (server or client)
+netem_args() {
+    local profile="$1" side="$2" delay jitter loss down up
+    case "$profile" in
+        datacenter)    delay=0.1ms jitter=0.02ms loss="0%"          down=10gbit up=10gbit ;;
+        transatlantic) delay=40ms  jitter=2ms    loss="0.05%"       down=1gbit  up=1gbit  ;;
+        lossy-lte)     delay=30ms  jitter=10ms   loss="1.5% 25%"    down=20mbit up=5mbit  ;;
+        satellite)     delay=300ms jitter=5ms    loss="0.5%"        down=50mbit up=5mbit  ;;
+        *) echo "unknown netem profile: $profile (${NETEM_PROFILES[*]})" >&2; return 1 ;;
+    esac
+    # The limit must hold a full bandwidth-delay product, or netem drops on its own
+    echo "delay $delay $jitter distribution normal loss $loss rate $([[ $side == server ]] && echo "$down" || echo "$up") limit 100000"
+}
+
+netem_apply() {
+    local container="$1" profile="$2" side="$3" args
+    args=$(netem_args "$profile" "$side") || return 1
+    # shellcheck disable=SC2086
+    docker exec "$container" tc qdisc replace dev eth0 root netem $args
+}
+
+netem_clear() {
+    docker exec "$1" tc qdisc del dev eth0 root 2>/dev/null || true
+}
@@ -0,0 +1,53 @@
+#!/usr/bin/env bash
+#───────────────────────────────────────────────────────────────────────────────
+# RUN-NETEM-BENCHMARK.SH
+# QUIC vs. TCP/HTTP2 through impaired links, on the local docker network.
+#
+# Starts the `netem` compose profile (netem-server, netem-client), then for
+# every congestion controller in NETEM_CC and every profile in
+# NETEM_PROFILES (see netem.sh): restarts benchmarks/netem/server.php with
+# that controller, shapes both containers and runs benchmarks/NetemLabTest.php.
+# All rows land in benchmarks/results/netem-<timestamp>.jsonl.
+#
+# USAGE (from the package root):
+#   make netem-benchmark
+#   NETEM_PROFILES="satellite lossy-lte" NETEM_CC="cubic bbr2" make netem-benchmark
+#   NETEM_SECONDS=60 NETEM_SCENARIOS=hol make netem-benchmark
+#───────────────────────────────────────────────────────────────────────────────
+set -euo pipefail
+cd "$(dirname "${BASH_SOURCE[0]}")/../../"
+
+requested_profiles="${NETEM_PROFILES:-}"   # netem.sh defines the array of all of them
+source infra/scripts/utils.sh || true
+source infra/scripts/netem.sh
+
+read -r -a profiles <<< "${requested_profiles:-${NETEM_PROFILES[*]}}"
+read -r -a ccs <<< "${NETEM_CC:-cubic bbr2}"
+out="benchmarks/results/netem-$(date +%Y%m%d-%H%M%S).jsonl"
+mkdir -p benchmarks/results
+
+docker compose --profile netem up --build --force-recreate -d > /dev/null
+trap 'netem_clear netem-server; netem_clear netem-client; docker compose --profile netem down > /dev/null 2>&1 || true' EXIT
+
+for cc in "${ccs[@]}"; do
+    docker exec netem-server pkill -f benchmarks/netem/server.php || true
+    docker exec -d netem-server php -d "quicpro.transport_cc_algorithm=${cc}" \
+        /workspace/benchmarks/netem/server.php
+    sleep 2
+
+    for profile in "${profiles[@]}"; do
+        message "netem: ${profile}, QUIC ${cc}" 4 7
+        netem_apply netem-server "$profile" server
+        netem_apply netem-client "$profile" client
+
+        docker exec \
+            -e NETEM_PROFILE="$profile" -e NETEM_CC="$cc" \
+            -e NETEM_SECONDS="${NETEM_SECONDS:-20}" -e NETEM_SCENARIOS="${NETEM_SCENARIOS:-throughput,latency,hol}" \
+            netem-client php -d quicpro.tls_verify_peer=0 /workspace/benchmarks/NetemLabTest.php >> "$out"
+
+        netem_clear netem-server
+        netem_clear netem-client
+    done
+done
+
+message "netem results: ${out}" 10 16
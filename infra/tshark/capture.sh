@@ -0,0 +1,58 @@
+#!/usr/bin/env bash
+#───────────────────────────────────────────────────────────────────────────────
+# CAPTURE.SH
+# Records QUIC traffic and exports it for quicpro_server_replay().
+#
+# Start the server with SSLKEYLOGFILE pointing at a file: it then writes the
+# TLS secrets of every connection it accepts there, and tshark can decrypt
+# the capture. Turning a capture into a replay trace takes two steps:
+#
+#   1. record   captures UDP traffic to and from the port
+#   2. export   decrypts the capture and prints the STREAM frames the
+#               clients sent, as JSON, which benchmarks/replay/convert.php
+#               turns into a trace
+#
+# Uses tshark from PATH, else the quicpro_async.dev/tshark image on the
+# host network, with the working directory mounted (paths must then be
+# inside it).
+#
+# USAGE:
+#   SSLKEYLOGFILE=captures/keys.log php server.php &
+#   infra/tshark/capture.sh record 4433 captures/capture.pcapng     # Ctrl-C to stop
+#   infra/tshark/capture.sh export captures/capture.pcapng captures/keys.log 4433 \
+#       | php benchmarks/replay/convert.php > captures/trace.qptrace
+#───────────────────────────────────────────────────────────────────────────────
+set -euo pipefail
+
+tshark_run() {
+    if command -v tshark > /dev/null; then
+        tshark "$@"
+    else
+        docker run --rm -i --net=host --cap-add NET_ADMIN --cap-add NET_RAW \
+            -v "$PWD:/work" -w /work quicpro_async.dev/tshark:latest "$@"
+    fi
+}
+
+usage() {
+    sed -n '/^# USAGE/,/^#─/p' "$0" | sed 's/^# \{0,1\}//' >&2
+    exit 1
+}
+
+case "${1:-}" in
+    record)
+        port="${2:-4433}" out="${3:-captures/capture.pcapng}"
+        mkdir -p "$(dirname "$out")"
+        tshark_run -i any -f "udp port ${port}" -w "$out"
+        ;;
+    export)
+        [[ $# -ge 3 ]] || usage
+        file="$2" keylog="$3" port="${4:-4433}"
+        # Client to server only; one JSON object per packet, frames as nested objects
+        tshark_run -r "$file" -o "tls.keylog_file:${keylog}" \
+            -Y "udp.dstport == ${port} && quic.stream.stream_id" \
+            -T json --no-duplicate-keys -J "frame quic"
+        ;;
+    *)
+        usage
+        ;;
+esac
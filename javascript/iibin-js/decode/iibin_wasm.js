@@ -0,0 +1,313 @@
+/*
+ * iibin-js – WebAssembly decoder for Intelligent‑Intern Binary (IIBIN)
+ * ====================================================================
+ * Runs the C decoder of php‑quicpro_async (wasm/iibin_wasm.c, on the wire kernels of
+ * extension/include/iibin/iibin_wire.h) instead of the reference decoder in iibin.js.
+ * Schemas are not restated in JS: load the descriptor the server hands out
+ * (IIBIN::schemaDescriptor(), or the `quicpro-iibin-descriptor` header of an MCP call) and
+ * decode with the schema's name.
+ *
+ *   import { instantiate } from "./iibin_wasm.js";
+ *
+ *   const iibin = await instantiate(fetch("/iibin/iibin.wasm"));
+ *   const name  = iibin.loadDescriptor(descriptorBytes);     // "Telemetry"
+ *   const frame = iibin.decode(buf, name);
+ *   frame.samples;                                           // Float64Array
+ *
+ * Values follow iibin.js: 32‑bit integers and floats are numbers, 64‑bit integers bigint,
+ * strings string, bytes a Uint8Array. Repeated numeric fields that arrive packed become
+ * typed arrays, copied once out of the decoder's arena:
+ *
+ *   int32 sint32 sfixed32 enum → Int32Array      uint32 fixed32 → Uint32Array
+ *   int64 sint64 sfixed64      → BigInt64Array   uint64 fixed64 → BigUint64Array
+ *   float → Float32Array   double → Float64Array   bool → Uint8Array (0 / 1)
+ *
+ * Defaults and required fields are handled as by IIBIN::decode(). Errors throw.
+ */
+
+// Field types, as quicpro_iibin_field_type_internal (iibin_wire.h)
+const enum Type {
+    DOUBLE = 1, FLOAT, INT64, UINT64, INT32, UINT32, SINT32, SINT64,
+    FIXED64, SFIXED64, FIXED32, SFIXED32, BOOL, STRING, BYTES, MESSAGE, ENUM
+}
+
+const FLAG_REQUIRED = 0x02;
+const FLAG_REPEATED = 0x04;
+
+// Tape entry kinds and the field layout of iibin_wasm.c
+const TAPE_VALUE = 0, TAPE_BYTES = 1, TAPE_BEGIN = 2, TAPE_END = 3, TAPE_PACKED = 4;
+const TAPE_ENTRY = 16;
+const FIELD_SIZE = 32;
+
+const ERRORS: Record<number, string> = {
+    1: "malformed tag/wire_type varint",
+    2: "failed to skip unknown field",
+    3: "wire type mismatch",
+    4: "truncated or malformed value",
+    5: "packed field malformed or longer than the buffer",
+    6: "messages nested too deep",
+    7: "unknown schema",
+    8: "not an IIBIN schema descriptor, or one of another version",
+    9: "descriptor refers to a schema or enum it does not define",
+    10: "out of memory"
+};
+
+type TypedArrayCtor =
+    | Int32ArrayConstructor | Uint32ArrayConstructor | BigInt64ArrayConstructor | BigUint64ArrayConstructor
+    | Float32ArrayConstructor | Float64ArrayConstructor | Uint8ArrayConstructor;
+
+interface FieldMeta {
+    name: string;
+    tag: number;
+    type: Type;
+    flags: number;
+    ref: number;                // Schema index of a message field
+    packed?: TypedArrayCtor;    // Array type of a packed run
+    hasDefault: boolean;
+    default?: unknown;
+}
+
+interface SchemaMeta {
+    name: string;
+    fields: FieldMeta[];
+    post: FieldMeta[];          // Required or with a default
+}
+
+interface Exports {
+    memory: WebAssembly.Memory;
+    iibin_input(len: number): number;
+    iibin_load(len: number): number;
+    iibin_decode(schema: number, len: number): number;
+    iibin_tape(): number;
+    iibin_error_field(): number;
+    iibin_schema_count(): number;
+    iibin_schema_name(i: number): number;
+    iibin_schema_name_len(i: number): number;
+    iibin_schema_fields(i: number): number;
+    iibin_schema_num_fields(i: number): number;
+}
+
+function packedArrayType(type: Type): TypedArrayCtor | undefined {
+    switch (type) {
+        case Type.INT32: case Type.SINT32: case Type.SFIXED32: case Type.ENUM: return Int32Array;
+        case Type.UINT32: case Type.FIXED32:                                  return Uint32Array;
+        case Type.INT64: case Type.SINT64: case Type.SFIXED64:                return BigInt64Array;
+        case Type.UINT64: case Type.FIXED64:                                  return BigUint64Array;
+        case Type.FLOAT:                                                      return Float32Array;
+        case Type.DOUBLE:                                                     return Float64Array;
+        case Type.BOOL:                                                       return Uint8Array;
+        default:                                                              return undefined;
+    }
+}
+
+const utf8 = new TextDecoder();
+const bits = new DataView(new ArrayBuffer(8));
+
+// A TAPE_VALUE (or a long / double default) as the field's JS value
+function scalar(type: Type, lo: number, hi: number): unknown {
+    switch (type) {
+        case Type.DOUBLE:
+            bits.setUint32(0, lo, true);
+            bits.setUint32(4, hi, true);
+            return bits.getFloat64(0, true);
+        case Type.FLOAT:
+            bits.setUint32(0, lo, true);
+            return bits.getFloat32(0, true);
+        case Type.INT64: case Type.SINT64: case Type.SFIXED64:
+            return BigInt.asIntN(64, (BigInt(hi) << 32n) | BigInt(lo));
+        case Type.UINT64: case Type.FIXED64:
+            return (BigInt(hi) << 32n) | BigInt(lo);
+        case Type.UINT32: case Type.FIXED32:
+            return lo >>> 0;
+        case Type.BOOL:
+            return lo !== 0;
+        default:
+            return lo | 0;
+    }
+}
+
+function concatTyped(a: any, b: any): any {
+    const out = new a.constructor(a.length + b.length);
+    out.set(a);
+    out.set(b, a.length);
+    return out;
+}
+
+export class IIBINWasm {
+    private readonly x: Exports;
+    private readonly schemas: SchemaMeta[] = [];
+    private readonly byName = new Map<string, number>();
+    private readonly fields = new Map<number, FieldMeta>();   // By address in WASM memory
+
+    constructor(instance: WebAssembly.Instance) {
+        this.x = instance.exports as unknown as Exports;
+    }
+
+    /** Loads a schema descriptor with everything it uses and returns the name of its root schema. */
+    loadDescriptor(descriptor: Uint8Array): string {
+        const root = this.x.iibin_load(this.copyIn(descriptor));
+        this.refresh();
+        if (root < 0) throw new Error(`IIBIN: ${ERRORS[-root] ?? "error " + -root}`);
+        return this.schemas[root].name;
+    }
+
+    /** The names of the schemas loaded so far. */
+    schemaNames(): string[] {
+        return this.schemas.map(s => s.name);
+    }
+
+    /** Decodes a message of the named schema, as IIBIN::decode() does. */
+    decode(buf: Uint8Array, schemaName: string): any {
+        const index = this.byName.get(schemaName);
+        if (index === undefined) throw new Error(`IIBIN: schema '${schemaName}' is not loaded`);
+
+        const n = this.x.iibin_decode(index, this.copyIn(buf));
+        if (n < 0) {
+            const f = this.fields.get(this.x.iibin_error_field());
+            const where = f ? ` in field '${f.name}' (tag ${f.tag})` : "";
+            throw new Error(`IIBIN: decoding error: ${ERRORS[-n] ?? "error " + -n}${where} of schema '${schemaName}'`);
+        }
+        return this.build(index, n);
+    }
+
+    private copyIn(bytes: Uint8Array): number {
+        const ptr = this.x.iibin_input(bytes.length);
+        if (!ptr) throw new Error("IIBIN: out of memory");
+        new Uint8Array(this.x.memory.buffer, ptr, bytes.length).set(bytes);
+        return bytes.length;
+    }
+
+    private str(ptr: number, len: number): string {
+        return utf8.decode(new Uint8Array(this.x.memory.buffer, ptr, len));
+    }
+
+    // Reads the fields of every schema loaded since the last call
+    private refresh(): void {
+        const mem = new DataView(this.x.memory.buffer);
+        for (let i = this.schemas.length, n = this.x.iibin_schema_count(); i < n; i++) {
+            const name = this.str(this.x.iibin_schema_name(i), this.x.iibin_schema_name_len(i));
+            const base = this.x.iibin_schema_fields(i);
+            const fields: FieldMeta[] = [];
+            for (let k = 0, nf = this.x.iibin_schema_num_fields(i); k < nf; k++) {
+                const at = base + k * FIELD_SIZE;
+                const f: FieldMeta = {
+                    flags: mem.getUint8(at + 1),
+                    type: mem.getUint8(at + 2) as Type,
+                    tag: mem.getUint32(at + 4, true),
+                    name: this.str(mem.getUint32(at + 12, true), mem.getUint32(at + 16, true)),
+                    ref: mem.getInt32(at + 20, true),
+                    hasDefault: mem.getUint8(at + 3) !== 0
+                };
+                if (f.flags & FLAG_REPEATED) f.packed = packedArrayType(f.type);
+                const lo = mem.getUint32(at + 24, true), hi = mem.getUint32(at + 28, true);
+                switch (mem.getUint8(at + 3)) {
+                    case 1: f.default = null; break;
+                    case 2: f.default = false; break;
+                    case 3: f.default = true; break;
+                    case 4: {
+                        const v = BigInt.asIntN(64, (BigInt(hi) << 32n) | BigInt(lo));
+                        f.default = f.type === Type.INT64 || f.type === Type.UINT64 || f.type === Type.SINT64
+                            || f.type === Type.FIXED64 || f.type === Type.SFIXED64 ? v : Number(v);
+                        break;
+                    }
+                    case 5: f.default = scalar(Type.DOUBLE, lo, hi); break;
+                    case 6: f.default = this.str(lo, hi); break;
+                }
+                fields.push(f);
+                this.fields.set(at, f);
+            }
+            this.schemas.push({ name, fields, post: fields.filter(f => (f.flags & FLAG_REQUIRED) || f.hasDefault) });
+            this.byName.set(name, i);
+        }
+    }
+
+    // Turns the tape of the last decode into objects
+    private build(rootIndex: number, n: number): any {
+        const buffer = this.x.memory.buffer;
+        const mem = new DataView(buffer);
+        const bytes = new Uint8Array(buffer);
+        const root: any = {};
+        const stack: [any, SchemaMeta][] = [];
+        let obj = root;
+        let schema = this.schemas[rootIndex];
+
+        for (let i = 0, at = this.x.iibin_tape(); i < n; i++, at += TAPE_ENTRY) {
+            const kind = mem.getUint32(at + 4, true);
+            const lo = mem.getUint32(at + 8, true);
+            const hi = mem.getUint32(at + 12, true);
+            if (kind === TAPE_END) {
+                this.finish(obj, schema);
+                [obj, schema] = stack.pop()!;
+                continue;
+            }
+            const f = this.fields.get(mem.getUint32(at, true))!;
+            let value: any;
+            switch (kind) {
+                case TAPE_VALUE:
+                    value = scalar(f.type, lo, hi);
+                    break;
+                case TAPE_BYTES:
+                    value = f.type === Type.STRING ? utf8.decode(bytes.subarray(lo, lo + hi)) : bytes.slice(lo, lo + hi);
+                    break;
+                case TAPE_BEGIN:
+                    value = {};
+                    break;
+                case TAPE_PACKED: {
+                    const Ctor = f.packed!;
+                    const run = new Ctor(buffer.slice(lo, lo + hi * Ctor.BYTES_PER_ELEMENT));
+                    const prev = obj[f.name];
+                    obj[f.name] = prev === undefined ? run
+                        : ArrayBuffer.isView(prev) ? concatTyped(prev, run)
+                        : concatTyped((Ctor as any).from(prev.map((v: any) => (typeof v === "boolean" ? +v : v))), run);
+                    continue;
+                }
+            }
+            if (f.flags & FLAG_REPEATED) {
+                const prev = obj[f.name];
+                if (prev === undefined) obj[f.name] = [value];
+                else if (ArrayBuffer.isView(prev)) obj[f.name] = concatTyped(prev, (f.packed as any).of(typeof value === "boolean" ? +value : value));
+                else prev.push(value);
+            } else {
+                obj[f.name] = value;
+            }
+            if (kind === TAPE_BEGIN) {
+                stack.push([obj, schema]);
+                obj = value;
+                schema = this.schemas[f.ref];
+            }
+        }
+        this.finish(root, schema);
+        return root;
+    }
+
+    private finish(obj: any, schema: SchemaMeta): void {
+        for (const f of schema.post) {
+            if (obj[f.name] !== undefined) continue;
+            if (f.flags & FLAG_REQUIRED) {
+                throw new Error(`IIBIN: required field '${f.name}' (tag ${f.tag}) not found in payload for schema '${schema.name}'`);
+            }
+            obj[f.name] = f.default;
+        }
+    }
+}
+
+/**
+ * Compiles and instantiates iibin.wasm (see wasm/build.sh). Accepts the module's bytes,
+ * a Response or a promise of one; streaming compilation is used where the runtime has it.
+ */
+export async function instantiate(source: BufferSource | Response | Promise<Response>): Promise<IIBINWasm> {
+    // wasi-libc's allocator calls no WASI function; anything else answers ENOSYS
+    const imports = { wasi_snapshot_preview1: new Proxy({}, { get: () => () => 52 }) };
+    const src = await source;
+    let instance: WebAssembly.Instance;
+    if (src instanceof Response) {
+        instance = typeof WebAssembly.instantiateStreaming === "function"
+            ? (await WebAssembly.instantiateStreaming(src, imports)).instance
+            : (await WebAssembly.instantiate(await src.arrayBuffer(), imports)).instance;
+    } else {
+        instance = (await WebAssembly.instantiate(src, imports)).instance;
+    }
+    return new IIBINWasm(instance);
+}
+
+export default { instantiate, IIBINWasm };
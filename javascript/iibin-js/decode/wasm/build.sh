@@ -0,0 +1,28 @@
+#!/usr/bin/env bash
+#───────────────────────────────────────────────────────────────────────────────
+# BUILD.SH
+# Builds iibin.wasm, the WebAssembly IIBIN decoder iibin_wasm.js loads, from
+# iibin_wasm.c and the extension's wire kernels (extension/include/iibin/
+# iibin_wire.h), with WASM SIMD (simd128) for the packed varint scans.
+#
+# Needs wasi-sdk (clang with the wasm32-wasi sysroot): WASI_SDK_PATH, else
+# /opt/wasi-sdk. The module exports its functions and memory, has no entry
+# point and imports nothing it calls; every browser and Node.js release with
+# WASM SIMD runs it.
+#
+# USAGE:
+#   javascript/iibin-js/decode/wasm/build.sh [out.wasm]    # default ../iibin.wasm
+#───────────────────────────────────────────────────────────────────────────────
+set -euo pipefail
+
+here="$(cd "$(dirname "$0")" && pwd)"
+sdk="${WASI_SDK_PATH:-/opt/wasi-sdk}"
+out="${1:-$here/../iibin.wasm}"
+
+"$sdk/bin/clang" --target=wasm32-wasi --sysroot="$sdk/share/wasi-sysroot" \
+    -O3 -msimd128 -mbulk-memory -std=c11 -Wall -Wextra \
+    -I"$here/../../../../extension/include/iibin" \
+    -nostartfiles -Wl,--no-entry -Wl,--strip-all -Wl,--export=memory \
+    -o "$out" "$here/iibin_wasm.c"
+
+echo "built $out ($(wc -c < "$out") bytes)"
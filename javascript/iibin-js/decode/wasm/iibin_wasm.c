@@ -0,0 +1,618 @@
+/*
+ * iibin-js/decode/wasm/iibin_wasm.c – IIBIN decoder for WebAssembly
+ * =================================================================
+ *
+ * The decoder loop of extension/src/iibin/iibin_decoding.c, built for the
+ * browser on the same wire kernels (extension/include/iibin/iibin_wire.h),
+ * with the simd128 versions of the packed varint scans. Schemas are loaded
+ * from the descriptors the server sends (IIBIN::schemaDescriptor(), format
+ * in extension/include/iibin/iibin_descriptor.h), so both ends work from
+ * the same compiled definition and a schema is never restated in JS.
+ *
+ * Nothing here builds JS values. decode() runs over the message once and
+ * writes a tape of 16-byte entries that ../iibin_wasm.js turns into
+ * objects:
+ *
+ *     field   pointer to the field (iibin_wasm_field), 0 for END
+ *     kind    TAPE_VALUE  lo/hi: the value as 64 bits (see below)
+ *             TAPE_BYTES  lo/hi: address and length of a string or bytes
+ *             TAPE_BEGIN  a nested message of the field starts
+ *             TAPE_END    it ends
+ *             TAPE_PACKED lo/hi: address and count of a packed run, decoded
+ *                         into the arena as the elements of the field's
+ *                         typed array
+ *
+ * Values are normalised to what the field means: sign-extended for int32,
+ * enum and sfixed32, zigzag-decoded for sint32/sint64, 0 or 1 for bool,
+ * the IEEE bits for float and double, the raw 64 bits otherwise. Packed
+ * runs of fixed-width types are the typed array already and are copied as
+ * they are; varint runs are counted with one SIMD mask per 16 bytes and
+ * decoded 16 one-byte items at a time where they allow.
+ *
+ * Build: ./build.sh (wasi-sdk clang, -msimd128).
+ */
+
+#include <stdlib.h>
+
+#include "iibin_wire.h"
+
+#define EXPORT(name) __attribute__((export_name(#name)))
+
+/* Descriptor format, see iibin_descriptor.h */
+#define DESC_VERSION 1
+
+#define DESC_KIND_ENUM   'E'
+#define DESC_KIND_SCHEMA 'S'
+
+#define DESC_FLAG_REQUIRED   0x01
+#define DESC_FLAG_REPEATED   0x02
+#define DESC_FLAG_PACKED     0x04
+
+#define DESC_DEFAULT_NONE   0
+#define DESC_DEFAULT_NULL   1
+#define DESC_DEFAULT_FALSE  2
+#define DESC_DEFAULT_TRUE   3
+#define DESC_DEFAULT_LONG   4
+#define DESC_DEFAULT_DOUBLE 5
+#define DESC_DEFAULT_STRING 6
+
+/* Errors decode() and load() return, negated */
+enum {
+    IIBIN_WASM_OK = 0,
+    IIBIN_WASM_E_MALFORMED_KEY,     /* Field key is not a varint */
+    IIBIN_WASM_E_SKIP,              /* Unknown field cannot be skipped */
+    IIBIN_WASM_E_WIRE_TYPE,         /* Known field with another wire type */
+    IIBIN_WASM_E_TRUNCATED,         /* Field value runs past its message */
+    IIBIN_WASM_E_PACKED,            /* Packed run malformed */
+    IIBIN_WASM_E_DEPTH,             /* Messages nested deeper than IIBIN_WASM_MAX_DEPTH */
+    IIBIN_WASM_E_SCHEMA,            /* No such schema */
+    IIBIN_WASM_E_DESCRIPTOR,        /* Descriptor malformed or of another version */
+    IIBIN_WASM_E_REF,               /* Descriptor names a schema or enum it does not define */
+    IIBIN_WASM_E_NOMEM
+};
+
+#define IIBIN_WASM_MAX_DEPTH 100
+
+enum { TAPE_VALUE = 0, TAPE_BYTES, TAPE_BEGIN, TAPE_END, TAPE_PACKED };
+
+/*
+ * A field as iibin_wasm.js reads it from memory: keep the layout (32 bytes,
+ * offsets in the comments) in step with FIELD_* there.
+ */
+typedef struct {
+    uint8_t     op;             /*  0 quicpro_iibin_opcode */
+    uint8_t     flags;          /*  1 IIBIN_FIELD_FLAG_* */
+    uint8_t     type;           /*  2 quicpro_iibin_field_type_internal */
+    uint8_t     default_kind;   /*  3 As in the descriptor */
+    uint32_t    tag;            /*  4 */
+    uint32_t    wire_type;      /*  8 Of a single value */
+    const char *name;           /* 12 UTF-8, not terminated */
+    uint32_t    name_len;       /* 16 */
+    int32_t     ref;            /* 20 Schema index of a message field, else -1 */
+    uint32_t    default_lo;     /* 24 Long or double bits, or string address */
+    uint32_t    default_hi;     /* 28 ... or string length */
+} iibin_wasm_field;
+
+#ifdef __wasm32__
+_Static_assert(sizeof(iibin_wasm_field) == 32, "iibin_wasm.js reads fields at a 32-byte stride");
+#endif
+
+typedef struct {
+    const char       *name;
+    uint32_t          name_len;
+    iibin_wasm_field *fields;       /* Tag order */
+    uint32_t          num_fields;
+    uint16_t         *by_tag;       /* tag → field index + 1, 0 = unknown */
+    uint32_t          by_tag_len;
+} iibin_wasm_schema;
+
+typedef struct {
+    const char *name;
+    uint32_t    name_len;
+} iibin_wasm_enum;
+
+typedef struct {
+    uint32_t field;
+    uint32_t kind;
+    uint32_t lo;
+    uint32_t hi;
+} tape_entry;
+
+static iibin_wasm_schema *schemas;
+static uint32_t num_schemas, cap_schemas;
+static iibin_wasm_enum *enums;
+static uint32_t num_enums, cap_enums;
+
+/* Scratch: the caller's input, and the tape and arena of the last decode */
+static unsigned char *input;
+static uint32_t input_cap;
+static tape_entry *tape, *tape_pos;
+static uint32_t tape_cap;
+static unsigned char *arena, *arena_pos;
+static uint32_t arena_cap;
+
+static const iibin_wasm_field *error_field;
+
+
+/* --- Descriptor loading --- */
+
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+} desc_reader;
+
+static bool desc_get_varint(desc_reader *r, uint64_t *v) {
+    return quicpro_iibin_decode_varint(&r->p, r->end, v);
+}
+
+static bool desc_get_byte(desc_reader *r, uint8_t *b) {
+    if (r->p >= r->end) return 0;
+    *b = *r->p++;
+    return 1;
+}
+
+static bool desc_get_str(desc_reader *r, const char **s, uint32_t *len) {
+    uint64_t n;
+    if (!desc_get_varint(r, &n) || n > (uint64_t)(r->end - r->p)) return 0;
+    *s = (const char *)r->p;
+    *len = (uint32_t)n;
+    r->p += n;
+    return 1;
+}
+
+static int32_t find_schema(const char *name, uint32_t len) {
+    for (uint32_t i = 0; i < num_schemas; i++) {
+        if (schemas[i].name_len == len && memcmp(schemas[i].name, name, len) == 0) return (int32_t)i;
+    }
+    return -1;
+}
+
+static int32_t find_enum(const char *name, uint32_t len) {
+    for (uint32_t i = 0; i < num_enums; i++) {
+        if (enums[i].name_len == len && memcmp(enums[i].name, name, len) == 0) return (int32_t)i;
+    }
+    return -1;
+}
+
+static bool grow(void **array, uint32_t *cap, uint32_t need, size_t size) {
+    if (need <= *cap) return 1;
+    uint32_t n = *cap ? *cap * 2 : 16;
+    while (n < need) n *= 2;
+    void *p = realloc(*array, (size_t)n * size);
+    if (!p) return 0;
+    *array = p;
+    *cap = n;
+    return 1;
+}
+
+static int desc_read_enum(desc_reader *r, const char *name, uint32_t name_len) {
+    uint64_t n, number;
+    const char *value;
+    uint32_t value_len;
+    if (!desc_get_varint(r, &n)) return -IIBIN_WASM_E_DESCRIPTOR;
+    for (uint64_t i = 0; i < n; i++) {
+        if (!desc_get_str(r, &value, &value_len) || !desc_get_varint(r, &number) || number > UINT32_MAX) {
+            return -IIBIN_WASM_E_DESCRIPTOR;
+        }
+    }
+    if (find_enum(name, name_len) < 0) {
+        if (!grow((void **)&enums, &cap_enums, num_enums + 1, sizeof(*enums))) return -IIBIN_WASM_E_NOMEM;
+        enums[num_enums++] = (iibin_wasm_enum){ name, name_len };
+    }
+    return 0;
+}
+
+static bool desc_read_default(desc_reader *r, iibin_wasm_field *f) {
+    uint64_t v;
+    const char *s;
+    uint32_t len;
+    if (!desc_get_byte(r, &f->default_kind)) return 0;
+    switch (f->default_kind) {
+        case DESC_DEFAULT_NONE: case DESC_DEFAULT_NULL: case DESC_DEFAULT_FALSE: case DESC_DEFAULT_TRUE:
+            return 1;
+        case DESC_DEFAULT_LONG:
+            if (!desc_get_varint(r, &v)) return 0;
+            v = (uint64_t)quicpro_iibin_zigzag_decode64(v);
+            break;
+        case DESC_DEFAULT_DOUBLE:
+            if (!quicpro_iibin_decode_fixed64(&r->p, r->end, &v)) return 0;
+            break;
+        case DESC_DEFAULT_STRING:
+            if (!desc_get_str(r, &s, &len)) return 0;
+            f->default_lo = (uint32_t)(uintptr_t)s;
+            f->default_hi = len;
+            return 1;
+        default:
+            return 0;
+    }
+    f->default_lo = (uint32_t)v;
+    f->default_hi = (uint32_t)(v >> 32);
+    return 1;
+}
+
+/*
+ * A schema entry. Its name is registered before the fields are read, so a
+ * schema may refer to itself. A name that is loaded already keeps its
+ * first definition; the body is only checked.
+ */
+static int desc_read_schema(desc_reader *r, const char *name, uint32_t name_len, int32_t *index) {
+    uint64_t n, tag;
+    *index = find_schema(name, name_len);
+    bool keep = *index < 0;
+    if (!desc_get_varint(r, &n) || n > (uint64_t)(r->end - r->p)) return -IIBIN_WASM_E_DESCRIPTOR;
+
+    iibin_wasm_field *fields = calloc(n ? (size_t)n : 1, sizeof(*fields));
+    if (!fields) return -IIBIN_WASM_E_NOMEM;
+    if (keep) {
+        if (!grow((void **)&schemas, &cap_schemas, num_schemas + 1, sizeof(*schemas))) {
+            free(fields);
+            return -IIBIN_WASM_E_NOMEM;
+        }
+        *index = (int32_t)num_schemas;
+        schemas[num_schemas++] = (iibin_wasm_schema){ name, name_len, fields, 0, NULL, 0 };
+    }
+
+    uint32_t max_tag = 0;
+    int rc = 0;
+    for (uint64_t i = 0; i < n && rc == 0; i++) {
+        iibin_wasm_field *f = &fields[i];
+        uint8_t type, flags;
+        const char *ref, *json_name;
+        uint32_t ref_len, json_name_len;
+        if (!desc_get_varint(r, &tag) || tag == 0 || tag > UINT32_MAX || (i && tag <= fields[i - 1].tag)
+            || !desc_get_byte(r, &type) || !desc_get_byte(r, &flags)
+            || !desc_get_str(r, &f->name, &f->name_len) || !desc_get_str(r, &ref, &ref_len)
+            || !desc_get_str(r, &json_name, &json_name_len)
+            || type == IIBIN_INTERNAL_TYPE_UNKNOWN || type > IIBIN_INTERNAL_TYPE_ENUM
+            || !desc_read_default(r, f)) {
+            rc = -IIBIN_WASM_E_DESCRIPTOR;
+            break;
+        }
+        f->tag = (uint32_t)tag;
+        f->type = type;
+        f->op = (uint8_t)quicpro_iibin_opcode_for_type((quicpro_iibin_field_type_internal)type);
+        f->wire_type = quicpro_iibin_value_wire_type((quicpro_iibin_opcode)f->op);
+        f->flags = ((flags & DESC_FLAG_REQUIRED) ? IIBIN_FIELD_FLAG_REQUIRED : IIBIN_FIELD_FLAG_OPTIONAL)
+                 | ((flags & DESC_FLAG_REPEATED) ? IIBIN_FIELD_FLAG_REPEATED : 0)
+                 | ((flags & DESC_FLAG_PACKED) ? IIBIN_FIELD_FLAG_PACKED : 0);
+        f->ref = -1;
+        if (type == IIBIN_INTERNAL_TYPE_MESSAGE) {
+            f->ref = find_schema(ref, ref_len);
+        } else if (type == IIBIN_INTERNAL_TYPE_ENUM && find_enum(ref, ref_len) < 0) {
+            rc = -IIBIN_WASM_E_REF;
+        }
+        if (type == IIBIN_INTERNAL_TYPE_MESSAGE && f->ref < 0) {
+            rc = -IIBIN_WASM_E_REF;
+        }
+        if (f->tag < IIBIN_DENSE_TAG_LIMIT) {
+            max_tag = f->tag;
+        }
+    }
+
+    if (!keep) {
+        free(fields);
+        return rc;
+    }
+    iibin_wasm_schema *s = &schemas[*index];
+    if (rc == 0 && max_tag) {
+        s->by_tag = calloc(max_tag + 1, sizeof(uint16_t));
+        if (!s->by_tag) rc = -IIBIN_WASM_E_NOMEM;
+    }
+    if (rc != 0) {
+        /* Only the last schema can fail, so it is also the last one added */
+        free(fields);
+        num_schemas--;
+        return rc;
+    }
+    s->num_fields = (uint32_t)n;
+    s->by_tag_len = max_tag ? max_tag + 1 : 0;
+    for (uint32_t i = 0; i < s->num_fields; i++) {
+        if (fields[i].tag < s->by_tag_len) s->by_tag[fields[i].tag] = (uint16_t)(i + 1);
+    }
+    return 0;
+}
+
+/*
+ * Loads the descriptor of `len` bytes in the input buffer and returns the
+ * index of its root schema, or a negative error. Like
+ * IIBIN::defineFromDescriptor(), definitions made before a failing entry
+ * stay loaded. The descriptor is kept, also after a failure: names and
+ * string defaults point into it.
+ */
+EXPORT(iibin_load)
+int32_t iibin_load(uint32_t len) {
+    if (len < 3 || input[0] != 'I' || input[1] != 'D' || input[2] != DESC_VERSION) {
+        return -IIBIN_WASM_E_DESCRIPTOR;
+    }
+    unsigned char *copy = malloc(len);
+    if (!copy) return -IIBIN_WASM_E_NOMEM;
+    memcpy(copy, input, len);
+
+    desc_reader r = { copy + 3, copy + len };
+    uint64_t count;
+    if (!desc_get_varint(&r, &count) || count == 0) {
+        free(copy);
+        return -IIBIN_WASM_E_DESCRIPTOR;
+    }
+
+    int32_t root = -1;
+    for (uint64_t i = 0; i < count; i++) {
+        uint8_t kind;
+        const char *name;
+        uint32_t name_len;
+        int rc;
+        if (!desc_get_byte(&r, &kind) || !desc_get_str(&r, &name, &name_len) || name_len == 0) {
+            return -IIBIN_WASM_E_DESCRIPTOR;
+        }
+        if (kind == DESC_KIND_ENUM && i + 1 < count) {
+            rc = desc_read_enum(&r, name, name_len);
+        } else if (kind == DESC_KIND_SCHEMA) {
+            rc = desc_read_schema(&r, name, name_len, &root);
+        } else {
+            rc = -IIBIN_WASM_E_DESCRIPTOR;
+        }
+        if (rc != 0) {
+            return rc;
+        }
+    }
+    return r.p == r.end ? root : -IIBIN_WASM_E_DESCRIPTOR;
+}
+
+
+/* --- Decoding --- */
+
+static bool skip_field(const unsigned char **p, const unsigned char *end, uint32_t wire_type) {
+    uint64_t len;
+    switch (wire_type) {
+        case QUICPRO_IIBIN_WIRETYPE_VARINT:
+            return quicpro_iibin_decode_varint(p, end, &len);
+        case QUICPRO_IIBIN_WIRETYPE_FIXED64:
+            if (end - *p < 8) return 0;
+            *p += 8;
+            return 1;
+        case QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM:
+            if (!quicpro_iibin_decode_varint(p, end, &len) || len > (uint64_t)(end - *p)) return 0;
+            *p += len;
+            return 1;
+        case QUICPRO_IIBIN_WIRETYPE_FIXED32:
+            if (end - *p < 4) return 0;
+            *p += 4;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static inline void emit(const iibin_wasm_field *f, uint32_t kind, uint64_t v) {
+    tape_pos->field = (uint32_t)(uintptr_t)f;
+    tape_pos->kind = kind;
+    tape_pos->lo = (uint32_t)v;
+    tape_pos->hi = (uint32_t)(v >> 32);
+    tape_pos++;
+}
+
+/* A varint as the field means it, see the top of the file. */
+static inline uint64_t varint_value(uint8_t op, uint64_t v) {
+    switch (op) {
+        case IIBIN_OP_INT32: case IIBIN_OP_ENUM: return (uint64_t)(int64_t)(int32_t)v;
+        case IIBIN_OP_ZIGZAG32:                  return (uint64_t)(int64_t)quicpro_iibin_zigzag_decode32((uint32_t)v);
+        case IIBIN_OP_ZIGZAG64:                  return (uint64_t)quicpro_iibin_zigzag_decode64(v);
+        case IIBIN_OP_BOOL:                      return v != 0;
+        default:                                 return v;
+    }
+}
+
+/* Bytes per element of the field's typed array: Int32Array, BigInt64Array, Uint8Array (bool) ... */
+static inline uint32_t element_size(uint8_t type) {
+    switch (type) {
+        case IIBIN_INTERNAL_TYPE_BOOL:
+            return 1;
+        case IIBIN_INTERNAL_TYPE_INT64: case IIBIN_INTERNAL_TYPE_UINT64: case IIBIN_INTERNAL_TYPE_SINT64:
+        case IIBIN_INTERNAL_TYPE_FIXED64: case IIBIN_INTERNAL_TYPE_SFIXED64: case IIBIN_INTERNAL_TYPE_DOUBLE:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+static inline void put_element(unsigned char *out, uint32_t size, uint64_t v) {
+    if (size == 8) {
+        quicpro_iibin_store_fixed64(out, v);
+    } else if (size == 4) {
+        quicpro_iibin_store_fixed32(out, (uint32_t)v);
+    } else {
+        *out = (unsigned char)v;
+    }
+}
+
+/*
+ * A packed run into the arena, aligned for its typed array. The count
+ * follows from the length for fixed-width types, whose bytes are the
+ * array's already, and from the bytes without a continuation bit for
+ * varints.
+ */
+static int decode_packed_run(const unsigned char *p, const unsigned char *run_end, const iibin_wasm_field *f) {
+    size_t run_len = (size_t)(run_end - p);
+    uint32_t size = element_size(f->type);
+    size_t count;
+
+    arena_pos = (unsigned char *)(((uintptr_t)arena_pos + 7) & ~(uintptr_t)7);
+    unsigned char *out = arena_pos;
+
+    switch (f->op) {
+        case IIBIN_OP_FIXED32: case IIBIN_OP_SFIXED32: case IIBIN_OP_FLOAT:
+        case IIBIN_OP_FIXED64: case IIBIN_OP_DOUBLE:
+            if (run_len % size) return -IIBIN_WASM_E_PACKED;
+            count = run_len / size;
+            memcpy(out, p, run_len);
+            arena_pos += run_len;
+            emit(f, TAPE_PACKED, (uint64_t)count << 32 | (uint32_t)(uintptr_t)out);
+            return 0;
+        default:
+            break;
+    }
+
+    if (run_len && run_end[-1] >= 0x80) return -IIBIN_WASM_E_PACKED;
+    count = quicpro_iibin_count_varints(p, run_end);
+    while (p < run_end) {
+        if (run_end - p >= 16 && quicpro_iibin_single_bytes16(p)) {
+            for (int i = 0; i < 16; i++) {
+                put_element(out, size, varint_value(f->op, p[i]));
+                out += size;
+            }
+            p += 16;
+            continue;
+        }
+        uint64_t v;
+        if (!quicpro_iibin_decode_varint(&p, run_end, &v)) return -IIBIN_WASM_E_PACKED;
+        put_element(out, size, varint_value(f->op, v));
+        out += size;
+    }
+    emit(f, TAPE_PACKED, (uint64_t)count << 32 | (uint32_t)(uintptr_t)arena_pos);
+    arena_pos = out;
+    return 0;
+}
+
+static int decode_message(const unsigned char **buf_ptr, const unsigned char *end, const iibin_wasm_schema *schema, int depth);
+
+static int decode_value(const unsigned char **p, const unsigned char *end, const iibin_wasm_field *f, int depth) {
+    uint64_t v;
+    uint32_t v32;
+    switch (f->op) {
+        case IIBIN_OP_FIXED32: case IIBIN_OP_FLOAT:
+            if (!quicpro_iibin_decode_fixed32(p, end, &v32)) return -IIBIN_WASM_E_TRUNCATED;
+            emit(f, TAPE_VALUE, v32);
+            return 0;
+        case IIBIN_OP_SFIXED32:
+            if (!quicpro_iibin_decode_fixed32(p, end, &v32)) return -IIBIN_WASM_E_TRUNCATED;
+            emit(f, TAPE_VALUE, (uint64_t)(int64_t)(int32_t)v32);
+            return 0;
+        case IIBIN_OP_FIXED64: case IIBIN_OP_DOUBLE:
+            if (!quicpro_iibin_decode_fixed64(p, end, &v)) return -IIBIN_WASM_E_TRUNCATED;
+            emit(f, TAPE_VALUE, v);
+            return 0;
+        case IIBIN_OP_BYTES:
+            if (!quicpro_iibin_decode_varint(p, end, &v) || v > (uint64_t)(end - *p)) return -IIBIN_WASM_E_TRUNCATED;
+            emit(f, TAPE_BYTES, v << 32 | (uint32_t)(uintptr_t)*p);
+            *p += v;
+            return 0;
+        case IIBIN_OP_MESSAGE: {
+            if (!quicpro_iibin_decode_varint(p, end, &v) || v > (uint64_t)(end - *p)) return -IIBIN_WASM_E_TRUNCATED;
+            const unsigned char *nested_end = *p + v;
+            emit(f, TAPE_BEGIN, 0);
+            int rc = decode_message(p, nested_end, &schemas[f->ref], depth + 1);
+            if (rc != 0) return rc;
+            emit(NULL, TAPE_END, 0);
+            return 0;
+        }
+        default:
+            if (!quicpro_iibin_decode_varint(p, end, &v)) return -IIBIN_WASM_E_TRUNCATED;
+            emit(f, TAPE_VALUE, varint_value(f->op, v));
+            return 0;
+    }
+}
+
+static int decode_message(const unsigned char **buf_ptr, const unsigned char *end, const iibin_wasm_schema *schema, int depth) {
+    const unsigned char *p = *buf_ptr;
+    if (depth > IIBIN_WASM_MAX_DEPTH) return -IIBIN_WASM_E_DEPTH;
+
+    while (p < end) {
+        uint64_t key;
+        if (QUICPRO_IIBIN_LIKELY(*p < 0x80)) {
+            key = *p++;
+        } else if (!quicpro_iibin_decode_varint(&p, end, &key)) {
+            return -IIBIN_WASM_E_MALFORMED_KEY;
+        }
+        uint32_t tag = (uint32_t)(key >> 3);
+        uint32_t wire_type = (uint32_t)(key & 0x7);
+        if (tag == 0) continue;
+
+        const iibin_wasm_field *f = NULL;
+        if (tag < schema->by_tag_len) {
+            uint16_t idx = schema->by_tag[tag];
+            f = idx ? &schema->fields[idx - 1] : NULL;
+        } else {
+            uint32_t lo = 0, hi = schema->num_fields;
+            while (lo < hi) {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (schema->fields[mid].tag == tag) { f = &schema->fields[mid]; break; }
+                if (schema->fields[mid].tag < tag) lo = mid + 1; else hi = mid;
+            }
+        }
+        if (!f) {
+            if (!skip_field(&p, end, wire_type)) return -IIBIN_WASM_E_SKIP;
+            continue;
+        }
+
+        int rc;
+        error_field = f;
+        if (QUICPRO_IIBIN_LIKELY(wire_type == f->wire_type)) {
+            rc = decode_value(&p, end, f, depth);
+        } else if ((f->flags & IIBIN_FIELD_FLAG_REPEATED) && wire_type == QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM
+                   && f->wire_type != QUICPRO_IIBIN_WIRETYPE_LENGTH_DELIM) {
+            uint64_t len;
+            if (!quicpro_iibin_decode_varint(&p, end, &len) || len > (uint64_t)(end - p)) return -IIBIN_WASM_E_PACKED;
+            rc = decode_packed_run(p, p + len, f);
+            p += len;
+        } else {
+            rc = -IIBIN_WASM_E_WIRE_TYPE;
+        }
+        if (rc != 0) return rc;
+    }
+    error_field = NULL;
+    *buf_ptr = p;
+    return 0;
+}
+
+/*
+ * Decodes the message of `len` bytes in the input buffer as schema
+ * `schema` and returns the number of tape entries, or a negative error
+ * (iibin_error_field() then names the field). Every entry takes at least
+ * one byte of input and every arena element at most eight, so both are
+ * sized up front and the loop never checks for room.
+ */
+EXPORT(iibin_decode)
+int32_t iibin_decode(uint32_t schema, uint32_t len) {
+    if (schema >= num_schemas) return -IIBIN_WASM_E_SCHEMA;
+    if (!grow((void **)&tape, &tape_cap, len + 1, sizeof(*tape))
+        || !grow((void **)&arena, &arena_cap, len * 8 + 8, 1)) {
+        return -IIBIN_WASM_E_NOMEM;
+    }
+    tape_pos = tape;
+    arena_pos = arena;
+    error_field = NULL;
+
+    const unsigned char *p = input;
+    int rc = decode_message(&p, input + len, &schemas[schema], 0);
+    return rc != 0 ? rc : (int32_t)(tape_pos - tape);
+}
+
+
+/* --- Memory shared with iibin_wasm.js --- */
+
+/* Address of an input buffer of at least `len` bytes for the next load() or decode(), 0 if out of memory. */
+EXPORT(iibin_input)
+uint32_t iibin_input(uint32_t len) {
+    return grow((void **)&input, &input_cap, len + 1, 1) ? (uint32_t)(uintptr_t)input : 0;
+}
+
+EXPORT(iibin_tape)
+uint32_t iibin_tape(void) { return (uint32_t)(uintptr_t)tape; }
+
+EXPORT(iibin_error_field)
+uint32_t iibin_error_field(void) { return (uint32_t)(uintptr_t)error_field; }
+
+EXPORT(iibin_schema_count)
+uint32_t iibin_schema_count(void) { return num_schemas; }
+
+EXPORT(iibin_schema_name)
+uint32_t iibin_schema_name(uint32_t i) { return i < num_schemas ? (uint32_t)(uintptr_t)schemas[i].name : 0; }
+
+EXPORT(iibin_schema_name_len)
+uint32_t iibin_schema_name_len(uint32_t i) { return i < num_schemas ? schemas[i].name_len : 0; }
+
+EXPORT(iibin_schema_fields)
+uint32_t iibin_schema_fields(uint32_t i) { return i < num_schemas ? (uint32_t)(uintptr_t)schemas[i].fields : 0; }
+
+EXPORT(iibin_schema_num_fields)
+uint32_t iibin_schema_num_fields(uint32_t i) { return i < num_schemas ? schemas[i].num_fields : 0; }
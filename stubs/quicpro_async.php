@@ -129,15 +129,44 @@ namespace Quicpro {
         /**
          * Sends a unary (request-response) RPC to an MCP service.
          *
-         * @param string $request_payload_binary A binary payload created with Quicpro\IIBIN::encode().
+         * @param string|array|object $request_payload A binary payload created with Quicpro\IIBIN::encode(),
+         *        or the message itself with $options['schema'] naming its IIBIN schema. A message is
+         *        encoded straight into the request stream as flow control allows.
+         * @param array $options 'schema' (string), 'timeout_ms' (int, default 30000; sent on as
+         *        quicpro-timeout-ms), 'idempotent' (bool), 'hedge' (a second MCP connection: the call
+         *        goes there too when late, the first reply wins), 'hedge_after_ms' (int; default: the
+         *        method's observed p95).
          * @return string The binary response payload, to be decoded with Quicpro\IIBIN::decode().
          */
-        public function request(string $service_name, string $method_name, string $request_payload_binary, array $options = []): string
+        public function request(string $service_name, string $method_name, string|array|object $request_payload, array $options = []): string
         {
             // C-level implementation
             return '';
         }
 
+        /**
+         * Streams a readable PHP stream to an MCP service in bounded chunks, as flow control allows.
+         *
+         * @param array $options 'offset' (int, resume point; default: the stream's position),
+         *        'on_progress' (fn(int $offset, ?int $total): ?bool, false cancels), 'timeout_ms' (int).
+         */
+        public function uploadFromStream(string $service_name, string $method_name, string $stream_identifier, $stream, string $initial_metadata = '', array $options = []): bool
+        {
+            // C-level implementation
+            return false;
+        }
+
+        /**
+         * Writes an MCP service's response into a writable PHP stream as it arrives.
+         *
+         * @param array $options The same as uploadFromStream(); a nonzero 'offset' asks the agent to resume there.
+         */
+        public function downloadToStream(string $service_name, string $method_name, string $request_payload, $stream, array $options = []): bool
+        {
+            // C-level implementation
+            return false;
+        }
+
         public function close(): void
         {
             // C-level implementation
@@ -200,9 +229,181 @@ namespace Quicpro {
         }
 
         /**
+         * Encodes into $stream in chunks of about 16 KiB, after a sizing
+         * pass. Nothing is written if $phpData does not fit the schema.
+         *
+         * @param array|object $phpData
+         * @param resource $stream
+         * @return int Bytes written.
+         */
+        public static function encodeToStream(string $schemaName, $phpData, $stream): int
+        {
+            // C-level implementation
+            return 0;
+        }
+
+        /**
+         * With $arena the result is an immutable array in request-lifetime
+         * memory, like opcache's constant arrays: no refcounting, nothing for
+         * the cycle collector, and freed in one step when the request ends.
+         * Beyond quicpro.iibin_arena_max_mb per request it is an ordinary
+         * array. Cannot be combined with $asObject.
+         *
+         * @return array|object
+         */
+        public static function decode(string $schemaName, string $binaryData, bool $asObject = false, bool $arena = false)
+        {
+            // C-level implementation
+            return [];
+        }
+
+        /**
+         * Decodes nothing up front: each field is decoded on first read.
+         * The view keeps a reference to $binaryData.
+         */
+        public static function decodeView(string $schemaName, string $binaryData): IIBIN\View
+        {
+            // C-level implementation
+            return new IIBIN\View();
+        }
+
+        /**
+         * IIBIN::encode() for every message of a list in one call, with
+         * one schema lookup. Keys are kept.
+         *
+         * @param array<array|object> $messages
+         * @return array<string>
+         */
+        public static function encodeMany(string $schemaName, array $messages): array
+        {
+            // C-level implementation
+            return [];
+        }
+
+        /**
+         * Encodes a list of messages of one schema column by column: integer
+         * deltas, bit-packed bools and dictionary strings. Much smaller than
+         * a repeated field of the same rows when the rows look alike.
+         *
+         * @param array<array|object> $rows
+         */
+        public static function encodeBatch(string $schemaName, array $rows): string
+        {
+            // C-level implementation
+            return '';
+        }
+
+        /**
+         * Checks and unpacks the columns of an encodeBatch() result. Rows
+         * become arrays only when they are read.
+         */
+        public static function decodeBatch(string $schemaName, string $binaryData): IIBIN\Batch
+        {
+            // C-level implementation
+            return new IIBIN\Batch();
+        }
+
+        /**
+         * The schema's ID: a fingerprint of its definition and of every
+         * schema and enum it uses. Equal definitions get equal IDs in every
+         * process; never 0.
+         */
+        public static function schemaId(string $schemaName): int
+        {
+            // C-level implementation
+            return 0;
+        }
+
+        /**
+         * The canonical definition of the schema and everything it uses, for
+         * a peer's defineFromDescriptor().
+         */
+        public static function schemaDescriptor(string $schemaName): string
+        {
+            // C-level implementation
+            return '';
+        }
+
+        /**
+         * Defines what a peer's schemaDescriptor() holds and is not defined
+         * here yet, and returns the name of its schema. Throws if a local
+         * definition of the same name differs.
+         */
+        public static function defineFromDescriptor(string $descriptor): string
+        {
+            // C-level implementation
+            return '';
+        }
+
+        /**
+         * The schema with this ID, or null if none is defined.
+         */
+        public static function schemaNameById(int $id): ?string
+        {
+            // C-level implementation
+            return null;
+        }
+
+        /**
+         * Encodes into a block of the shared segment (quicpro.io_shm_path)
+         * for a process on the same host. Send the returned reference
+         * instead of the bytes. Null if the message is larger than a block
+         * or no block is free: send the bytes then.
+         *
+         * @param array|object $phpData
+         */
+        public static function encodeShared(string $schemaName, $phpData): ?int
+        {
+            // C-level implementation
+            return null;
+        }
+
+        /**
+         * Decodes the message behind a reference from encodeShared(), by
+         * default releasing its block.
+         *
          * @return array|object
          */
-        public static function decode(string $schemaName, string $binaryData, bool $asObject = false)
+        public static function decodeShared(string $schemaName, int $ref, bool $decodeAsObject = false, bool $release = true)
+        {
+            // C-level implementation
+            return [];
+        }
+
+        /** Frees the block of a reference that is not going to be decoded. */
+        public static function releaseShared(int $ref): bool
+        {
+            // C-level implementation
+            return false;
+        }
+
+        public static function isDefined(string $name): bool
+        {
+            // C-level implementation
+            return false;
+        }
+
+        public static function isSchemaDefined(string $schemaName): bool
+        {
+            // C-level implementation
+            return false;
+        }
+
+        public static function isEnumDefined(string $enumName): bool
+        {
+            // C-level implementation
+            return false;
+        }
+
+        /** @return list<string> */
+        public static function getDefinedSchemas(): array
+        {
+            // C-level implementation
+            return [];
+        }
+
+        /** @return list<string> */
+        public static function getDefinedEnums(): array
         {
             // C-level implementation
             return [];
@@ -216,6 +417,11 @@ namespace Quicpro {
     {
         /**
          * @param mixed $initialData
+         * @param array $options 'timeout_ms', 'max_concurrency', and
+         *        'run_id': checkpoints every completed step's output in
+         *        the state backend, so that a run under the same ID after
+         *        a failure resumes after the steps this one completed.
+         *        The checkpoints are deleted when the run succeeds.
          */
         public static function run($initialData, array $pipelineDefinition, array $options = []): object
         {
@@ -267,39 +473,1103 @@ namespace Quicpro {
             return null;
         }
     }
+
+    /**
+     * The request handed to the callbacks of quicpro_http1_server_listen()
+     * and quicpro_http2_server_listen(). Values are read from the listener's
+     * buffers on first access. The object is reused for the next request
+     * unless the handler keeps a reference to it, in which case it is
+     * copied out first.
+     *
+     * Array access works as it did on the request array: 'method', 'uri',
+     * 'protocol', 'headers', 'body', and any other key reads that header.
+     */
+    final class Request implements \ArrayAccess
+    {
+        public function method(): string
+        {
+            // C-level implementation
+            return '';
+        }
+
+        public function uri(): string
+        {
+            // C-level implementation
+            return '';
+        }
+
+        /** "HTTP/1.0", "HTTP/1.1" or "HTTP/2". */
+        public function protocol(): string
+        {
+            // C-level implementation
+            return '';
+        }
+
+        public function body(): string
+        {
+            // C-level implementation
+            return '';
+        }
+
+        /**
+         * The body as a read stream from its start. A body past
+         * quicpro.tcp_body_spool_threshold_bytes is read from its spool file
+         * rather than copied into memory.
+         *
+         * @return resource|false
+         */
+        public function bodyStream()
+        {
+            // C-level implementation
+            return false;
+        }
+
+        /**
+         * Writes the body to $path, replacing the file, and returns its
+         * length. A spooled body goes to a local file by copy_file_range()
+         * or splice(), without passing through PHP; other wrappers
+         * (quicpro-fs:// for the object store) get it as a stream.
+         */
+        public function saveBody(string $path): int|false
+        {
+            // C-level implementation
+            return false;
+        }
+
+        /** @return array<string, string> Lower-case names; repeated fields joined with ", ". */
+        public function headers(): array
+        {
+            // C-level implementation
+            return [];
+        }
+
+        /** Case-insensitive; null if the request has no such header. */
+        public function header(string $name): ?string
+        {
+            // C-level implementation
+            return null;
+        }
+
+        /** The request array the listeners used to pass. */
+        public function toArray(): array
+        {
+            // C-level implementation
+            return [];
+        }
+
+        public function offsetExists(mixed $offset): bool
+        {
+            // C-level implementation
+            return false;
+        }
+
+        public function offsetGet(mixed $offset): mixed
+        {
+            // C-level implementation
+            return null;
+        }
+
+        /** @throws \LogicException Always: the request is read-only. */
+        public function offsetSet(mixed $offset, mixed $value): void
+        {
+            // C-level implementation
+        }
+
+        /** @throws \LogicException Always: the request is read-only. */
+        public function offsetUnset(mixed $offset): void
+        {
+            // C-level implementation
+        }
+    }
 }
 
-namespace Quicpro\Exception {
+namespace Quicpro\IIBIN {
+    /**
+     * A message returned by IIBIN::decodeView(). Fields are decoded when
+     * first read, through get() or array access, and kept. Absent fields
+     * read as their default, or null.
+     *
+     * Assigning or unsetting a field marks the view modified. encode()
+     * returns the original bytes until then, and re-encodes afterwards.
+     */
+    final class View implements \ArrayAccess
+    {
+        /** @throws \Quicpro\Exception\IIBINException For a field the schema lacks. */
+        public function get(string $field): mixed
+        {
+            // C-level implementation
+            return null;
+        }
 
-    class QuicproException extends \RuntimeException {}
+        /** Whether the field is present, without decoding it. */
+        public function has(string $field): bool
+        {
+            // C-level implementation
+            return false;
+        }
 
-    // Configuration Layer
-    class ConfigException extends QuicproException {}
-    class PolicyViolationException extends ConfigException {}
-    class UnknownConfigOptionException extends ConfigException {}
-    class InvalidConfigValueException extends ConfigException {}
+        /** What IIBIN::decode() returns for the same bytes. */
+        public function toArray(): array
+        {
+            // C-level implementation
+            return [];
+        }
 
-    // Transport & Connection Layer
-    class ConnectionException extends QuicproException {}
-    class TlsHandshakeException extends ConnectionException {}
-    class ProtocolViolationException extends ConnectionException {}
-    class TimeoutException extends ConnectionException {}
-    class HandshakeTimeoutException extends TimeoutException {}
-    class IdleTimeoutException extends TimeoutException {}
-    class ResponseTimeoutException extends TimeoutException {}
+        public function encode(): string
+        {
+            // C-level implementation
+            return '';
+        }
 
-    // Stream & Frame Layer
-    class StreamException extends QuicproException {}
-    class StreamLimitException extends StreamException {}
-    class FrameException extends StreamException {}
+        public function schemaName(): string
+        {
+            // C-level implementation
+            return '';
+        }
 
-    // High-Level API Layer
-    class PipelineException extends QuicproException {}
-    class IIBINException extends QuicproException {}
-    class MCPException extends QuicproException {}
-    class WebSocketException extends QuicproException {}
+        public function offsetExists(mixed $offset): bool
+        {
+            // C-level implementation
+            return false;
+        }
 
-    // Server & Cluster Layer
-    class ServerException extends QuicproException {}
-    class ClusterException extends QuicproException {}
-}
\ No newline at end of file
+        public function offsetGet(mixed $offset): mixed
+        {
+            // C-level implementation
+            return null;
+        }
+
+        public function offsetSet(mixed $offset, mixed $value): void
+        {
+            // C-level implementation
+        }
+
+        public function offsetUnset(mixed $offset): void
+        {
+            // C-level implementation
+        }
+    }
+}
+
+namespace Quicpro\IIBIN {
+    /**
+     * The rows of an IIBIN::encodeBatch() result, read-only. Each read of a
+     * row builds what IIBIN::decode() would return for it; rows are not
+     * cached.
+     *
+     * @implements \ArrayAccess<int, array>
+     * @implements \Iterator<int, array>
+     */
+    final class Batch implements \ArrayAccess, \Countable, \Iterator
+    {
+        public function count(): int
+        {
+            // C-level implementation
+            return 0;
+        }
+
+        /** One field of every row; null where a row has neither the field nor a default. */
+        public function column(string $field): array
+        {
+            // C-level implementation
+            return [];
+        }
+
+        /** @return list<array> */
+        public function toArray(): array
+        {
+            // C-level implementation
+            return [];
+        }
+
+        public function schemaName(): string
+        {
+            // C-level implementation
+            return '';
+        }
+
+        public function offsetExists(mixed $offset): bool
+        {
+            // C-level implementation
+            return false;
+        }
+
+        public function offsetGet(mixed $offset): mixed
+        {
+            // C-level implementation
+            return null;
+        }
+
+        /** @throws \Quicpro\Exception\IIBINException Always: batches are read-only. */
+        public function offsetSet(mixed $offset, mixed $value): void
+        {
+            // C-level implementation
+        }
+
+        /** @throws \Quicpro\Exception\IIBINException Always: batches are read-only. */
+        public function offsetUnset(mixed $offset): void
+        {
+            // C-level implementation
+        }
+
+        public function current(): mixed
+        {
+            // C-level implementation
+            return null;
+        }
+
+        public function key(): mixed
+        {
+            // C-level implementation
+            return null;
+        }
+
+        public function next(): void
+        {
+            // C-level implementation
+        }
+
+        public function rewind(): void
+        {
+            // C-level implementation
+        }
+
+        public function valid(): bool
+        {
+            // C-level implementation
+            return false;
+        }
+    }
+}
+
+namespace Quicpro\Exception {
+
+    class QuicproException extends \RuntimeException {}
+
+    // Configuration Layer
+    class ConfigException extends QuicproException {}
+    class PolicyViolationException extends ConfigException {}
+    class UnknownConfigOptionException extends ConfigException {}
+    class InvalidConfigValueException extends ConfigException {}
+
+    // Transport & Connection Layer
+    class ConnectionException extends QuicproException {}
+    class TlsHandshakeException extends ConnectionException {}
+    class ProtocolViolationException extends ConnectionException {}
+    class TimeoutException extends ConnectionException {}
+    class HandshakeTimeoutException extends TimeoutException {}
+    class IdleTimeoutException extends TimeoutException {}
+    class ResponseTimeoutException extends TimeoutException {}
+
+    // Stream & Frame Layer
+    class StreamException extends QuicproException {}
+    class StreamLimitException extends StreamException {}
+    class FrameException extends StreamException {}
+
+    // High-Level API Layer
+    class PipelineException extends QuicproException {}
+    class IIBINException extends QuicproException {}
+    class MCPException extends QuicproException {}
+    class WebSocketException extends QuicproException {}
+
+    // Server & Cluster Layer
+    class ServerException extends QuicproException {}
+    class ClusterException extends QuicproException {}
+}
+
+namespace {
+
+    /**
+     * Creates a reactor that drives many sessions from one epoll set and a
+     * timer wheel of quiche deadlines.
+     *
+     * @return resource|false
+     */
+    function quicpro_reactor_new()
+    {
+        // C-level implementation
+        return false;
+    }
+
+    /**
+     * Registers a session with the reactor. The reactor keeps it alive until
+     * it is removed or its connection closes.
+     *
+     * @param resource $reactor
+     * @param resource $session
+     */
+    function quicpro_reactor_add($reactor, $session): bool
+    {
+        // C-level implementation
+        return false;
+    }
+
+    /**
+     * @param resource $reactor
+     * @param resource $session
+     */
+    function quicpro_reactor_remove($reactor, $session): bool
+    {
+        // C-level implementation
+        return false;
+    }
+
+    /**
+     * Runs one reactor tick: waits up to $timeout_ms for socket input or the
+     * earliest quiche deadline, then services only the sessions involved.
+     *
+     * @param resource $reactor
+     * @return list<resource>|false Sessions that made progress during the tick.
+     */
+    function quicpro_reactor_run($reactor, int $timeout_ms): array|false
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /**
+     * Runs one tick of the Fiber scheduler. Blocking calls made inside a
+     * Fiber (quicpro_poll(), MCP requests) park the Fiber instead of
+     * spinning; this waits up to $timeout_ms for their sessions and resumes
+     * the fibers that can continue.
+     *
+     * @return int|false Number of fibers still parked.
+     */
+    function quicpro_scheduler_run(int $timeout_ms = -1): int|false
+    {
+        // C-level implementation
+        return 0;
+    }
+
+    /**
+     * Registers a named set of response headers. Handlers of the HTTP/1 and
+     * HTTP/2 listeners answer with `'template' => $name`; the headers are
+     * sent from bytes prepared here instead of being converted per response.
+     * quicpro_server_send_early_hints() accepts a template name as well.
+     *
+     * @param array<string, string|list<string>> $headers A list value repeats the header.
+     * @throws \InvalidArgumentException On an empty or already registered name, an
+     *         invalid header, or one the server sets itself (Content-Length, Connection, ...).
+     */
+    function quicpro_header_template_register(string $name, array $headers): bool
+    {
+        // C-level implementation
+        return true;
+    }
+
+    /**
+     * Registers a callback run once if the client cancels the request being
+     * served (STOP_SENDING on its stream, or a closed connection). Waits of
+     * the handler's MCP calls then throw, and the calls are reset downstream.
+     * Only the HTTP/3 listener's and the MCP server's handlers can be cancelled.
+     *
+     * @return bool False outside such a handler.
+     */
+    function quicpro_server_on_cancel(callable $callback): bool
+    {
+        // C-level implementation
+        return true;
+    }
+
+    /**
+     * Whether the client cancelled the request being served. Lets a long
+     * CPU-bound handler stop early; false outside a handler.
+     */
+    function quicpro_request_cancelled(): bool
+    {
+        // C-level implementation
+        return false;
+    }
+
+    /**
+     * Renders a log written with quicpro.access_log_format = "binary" as
+     * JSON lines, the format the workers write otherwise. The file must come
+     * from a build with the same record layout and byte order.
+     *
+     * @param string $binary_path An access-<pid>.log of quicpro.access_log_dir.
+     * @param string $json_path Created or truncated.
+     * @return int|false The number of records, false if $json_path cannot be written.
+     * @throws \Quicpro\Exception\McpException If $binary_path is not a binary access log.
+     */
+    function quicpro_access_log_convert(string $binary_path, string $json_path): int|false
+    {
+        // C-level implementation
+        return 0;
+    }
+
+    /**
+     * Loads servers at a constant request rate, open loop: request n is sent
+     * at start + n / rate whatever the responses do, and its latency runs
+     * from then, so a stalled server shows in the percentiles. QUIC sessions
+     * connect before the clock starts.
+     *
+     * @param array $options `rate` (requests per second, required),
+     *        `duration_ms` (10000), `timeout_ms` (5000, also the handshake
+     *        limit), `max_in_flight` (10000), `connections` (1, HTTP/3
+     *        sessions per origin), `connection_config` (Quicpro\Config),
+     *        `mix` (required): a list of request kinds, each with `protocol`
+     *        and `weight` (1):
+     *        - "h1", "h2": `url`, `method`, `headers`, `body`, `options` as
+     *          for quicpro_http_batch_submit();
+     *        - "h3": `host`, `port`, `method`, `path`, `headers`, `body`;
+     *        - "mcp": `host`, `port`, `service`, `method`, `body` (encoded),
+     *          `headers`.
+     * @return array `sent`, `completed`, `errors` (transport failures and
+     *         5xx), `timeouts`, `late` (sent over 1 ms after due), `rate`,
+     *         `elapsed_ms`, `throughput`, `latency_us` (min, mean, p50, p90,
+     *         p99, p99.9, p99.99, max), `histogram` and `protocols`: the
+     *         same counts and latencies per protocol.
+     * @throws \Quicpro\Exception\NetworkException If a session cannot connect.
+     */
+    function quicpro_loadgen_run(array $options): array
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /**
+     * Combines quicpro_loadgen_run() results of concurrent runs, e.g. one per
+     * Quicpro\Cluster worker. Counts and rates add up; the latencies are
+     * recomputed from the merged histograms.
+     *
+     * @param array $results Results of quicpro_loadgen_run().
+     * @return array A result of the same shape.
+     */
+    function quicpro_loadgen_merge(array $results): array
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /**
+     * Queues HTTP/3 requests on one session. Streams are opened as the peer's
+     * stream limit allows; the remaining requests go out as earlier ones finish.
+     *
+     * @param resource $session
+     * @param array<array-key, array{method?: string, path?: string, scheme?: string,
+     *        authority?: string, headers?: array<string, string>, body?: string}> $requests
+     * @return array<array-key, int> Request ids, keyed like $requests.
+     */
+    function quicpro_http3_batch_submit($session, array $requests): array|false
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /**
+     * Drives the session until a batched request completes or $timeout_ms
+     * elapses, and returns up to $max (0: all) completions in finishing order.
+     * Inside a Fiber the fiber is parked instead of blocking the worker.
+     *
+     * @param resource $session
+     * @return list<array{id: int, stream_id: int, status: int, headers: array<string, string|list<string>>,
+     *         body: string, error?: string}>
+     */
+    function quicpro_http3_batch_wait($session, int $timeout_ms = -1, int $max = 0): array|false
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /**
+     * Number of batched requests whose completion has not been returned yet.
+     *
+     * @param resource $session
+     */
+    function quicpro_http3_batch_pending($session): int
+    {
+        // C-level implementation
+        return 0;
+    }
+
+    /**
+     * Sends a request over the best transport for the origin. Responses over
+     * TCP teach the worker which origins announce HTTP/3 (Alt-Svc: h3); later
+     * requests to those go over QUIC, and fall back to TCP when UDP gets no
+     * answer within happy_eyeballs_quic_timeout_ms. Only a request that was
+     * never sent falls back.
+     *
+     * $options: preferred_protocol ("auto", "http1.1", "http2.0", "http3.0"),
+     * happy_eyeballs_quic_timeout_ms (300), timeout_ms, connection_config,
+     * plus the options of quicpro_http_request_send() for TCP.
+     *
+     * @return array{status: int, body: ?string, headers: array, protocol: string}|false
+     * @throws \Quicpro\Exception\QuicException When the request fails over HTTP/3.
+     */
+    function quicpro_client_send_request(string $url, string $method = "GET", ?array $headers = null,
+                                         ?string $body = null, ?array $options = null): array|false
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /**
+     * Sends one request on the origin's pooled HTTP/2 connection (nghttp2, TLS
+     * with ALPN "h2"). Requests to the same origin share the connection as
+     * streams. Flow-control windows come from the quicpro.http2_* settings.
+     *
+     * $options: timeout_ms (0: none), verify_peer (default true), ca_file.
+     *
+     * @return array{status: int, body: string, headers: array<string, string|list<string>>,
+     *         trailers?: array<string, string|list<string>>}|false
+     * @throws \Quicpro\Exception\NetworkException When the connection or stream fails.
+     */
+    function quicpro_http2_request_send(string $url, string $method = "GET", ?array $headers = null,
+                                        ?string $body = null, ?array $options = null): array|false
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /**
+     * Sends all requests at once, multiplexed as streams on one connection per
+     * origin, and waits for every response. Results are keyed like $requests;
+     * a failed request holds only 'error'. $options as for
+     * quicpro_http2_request_send(), with timeout_ms covering the whole set.
+     *
+     * @param array<array-key, array{url: string, method?: string, headers?: array<string, string>,
+     *        body?: string}> $requests
+     * @return array<array-key, array{status?: int, body?: string, headers?: array, trailers?: array,
+     *         error?: string}>|false
+     */
+    function quicpro_http2_request_send_multi(array $requests, ?array $options = null): array|false
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /**
+     * Sends an HTTP/1.1 or HTTP/2 request over TCP through libcurl. Connections,
+     * DNS answers and TLS sessions are shared by every call in the worker.
+     *
+     * Large bodies need not be buffered: $options['output_stream'] (a writable
+     * stream) or $options['on_body'] (fn(string $chunk): ?bool, false aborts)
+     * receives each chunk as it arrives, and 'body' is then null.
+     * $options['on_headers'] (fn(int $status, array $headers): ?bool) runs
+     * once, before the first chunk.
+     *
+     * @return array{status: int, body: ?string, headers: array<string, string>}|false
+     * @throws \Quicpro\Exception\McpException When the transfer fails.
+     */
+    function quicpro_http_request_send(string $url, string $method = "GET", ?array $headers = null,
+                                       ?string $body = null, ?array $options = null): array|false
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /**
+     * Starts libcurl requests in parallel and returns their ids, keyed like $requests.
+     *
+     * @param array<array-key, array{url: string, method?: string, headers?: array<string, string>,
+     *        body?: string, options?: array}> $requests
+     * @return array<array-key, int>
+     */
+    function quicpro_http_batch_submit(array $requests): array|false
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /**
+     * Runs the worker's libcurl transfers until one batch request completes or
+     * $timeout_ms elapses, and returns up to $max (0: all) completions.
+     *
+     * @return list<array{id: int, status?: int, body?: string, headers?: array<string, string>, error?: string}>
+     */
+    function quicpro_http_batch_wait(int $timeout_ms = -1, int $max = 0): array|false
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /** Number of libcurl batch requests whose completion has not been returned yet. */
+    function quicpro_http_batch_pending(): int
+    {
+        // C-level implementation
+        return 0;
+    }
+
+    /**
+     * Returns the next whole WebSocket message, joined from its fragments.
+     * A message larger than quicpro.websocket_default_max_payload_size fails
+     * the connection with status 1009.
+     *
+     * @param resource $ws
+     * @return string|false|null null on timeout, false once the connection is closed.
+     */
+    function quicpro_ws_receive($ws, int $timeout_ms = -1): string|false|null
+    {
+        // C-level implementation
+        return null;
+    }
+
+    /**
+     * Streaming receive: the next piece of the current message as soon as any
+     * of it has arrived. 'fin' marks the message's last piece. At most
+     * quicpro.websocket_receive_chunk_size wire bytes are read per call.
+     *
+     * @param resource $ws
+     * @return array{data: string, binary: bool, fin: bool}|false|null
+     */
+    function quicpro_ws_receive_chunk($ws, int $timeout_ms = -1): array|false|null
+    {
+        // C-level implementation
+        return null;
+    }
+
+    /**
+     * Adds a server-side WebSocket connection to a broadcast topic.
+     *
+     * @param resource $ws
+     */
+    function quicpro_ws_subscribe($ws, string $topic): bool
+    {
+        // C-level implementation
+        return true;
+    }
+
+    /**
+     * Removes a WebSocket connection from a broadcast topic.
+     *
+     * @param resource $ws
+     */
+    function quicpro_ws_unsubscribe($ws, string $topic): bool
+    {
+        // C-level implementation
+        return true;
+    }
+
+    /**
+     * Sends one message to every subscriber of $topic. It is framed and
+     * compressed once, not once per connection. A subscriber whose send
+     * queue is past quicpro.websocket_send_queue_high_watermark misses the
+     * message, or is closed when quicpro.websocket_close_slow_consumers is on.
+     *
+     * @return int Number of connections the message was queued on.
+     */
+    function quicpro_ws_publish(string $topic, string $data, bool $is_binary = false): int
+    {
+        // C-level implementation
+        return 0;
+    }
+
+    /**
+     * Pushes queued frames into the stream as flow control allows.
+     *
+     * @param resource $ws
+     * @return int|false Bytes still queued.
+     */
+    function quicpro_ws_flush($ws): int|false
+    {
+        // C-level implementation
+        return 0;
+    }
+
+    /**
+     * WebSocket codec counters of this worker, summed over all connections
+     * since it started. Diff two snapshots for per-frame figures.
+     *
+     * @return array{frames_sent: int, frames_received: int, wire_bytes_sent: int,
+     *               wire_bytes_received: int, bytes_copied: int, mask_bytes: int,
+     *               mask_ns: int, deflate_in: int, deflate_out: int,
+     *               inflate_in: int, inflate_out: int}
+     */
+    function quicpro_ws_get_stats(): array
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /**
+     * Opens a WebTransport session with an extended CONNECT request on
+     * $session and waits for the server's 2xx. The connection is dedicated
+     * to the session from then on. Throws on refusal or timeout.
+     *
+     * @param resource $session
+     * @param array<string, string> $headers Extra request fields, e.g. origin.
+     * @return resource Quicpro\WebTransport
+     */
+    function quicpro_webtransport_connect($session, string $path, array $headers = [], int $timeout_ms = -1)
+    {
+        // C-level implementation
+        return null;
+    }
+
+    /**
+     * Server side: accepts a WebTransport CONNECT request that arrived on
+     * $session. Non-blocking; null if none is pending.
+     *
+     * @param resource $session
+     * @return array{session: resource, path: string, authority: string, headers: array<string, string>}|null
+     */
+    function quicpro_webtransport_accept($session): ?array
+    {
+        // C-level implementation
+        return null;
+    }
+
+    /**
+     * Opens a stream inside the session.
+     *
+     * @param resource $wt
+     * @return int|false The stream ID, or false while no stream credit is left.
+     */
+    function quicpro_webtransport_open_stream($wt, bool $bidirectional = true): int|false
+    {
+        // C-level implementation
+        return 0;
+    }
+
+    /**
+     * Writes to a session stream. Returns the bytes accepted, which can be
+     * fewer than given under flow control; $fin applies only if all were.
+     *
+     * @param resource $wt
+     * @return int|false False if the peer asked us to stop sending.
+     */
+    function quicpro_webtransport_stream_send($wt, int $stream_id, string $data, bool $fin = false): int|false
+    {
+        // C-level implementation
+        return 0;
+    }
+
+    /**
+     * Queues one unreliable datagram. False if the send queue is full.
+     *
+     * @param resource $wt
+     */
+    function quicpro_webtransport_send_datagram($wt, string $data): bool
+    {
+        // C-level implementation
+        return true;
+    }
+
+    /**
+     * Waits for session events: 'datagram', 'stream', 'reset', 'draining'
+     * and 'closed' (see the extension docs for their keys). [] on timeout,
+     * false once 'closed' has been delivered.
+     *
+     * @param resource $wt
+     * @return list<array<string, mixed>>|false
+     */
+    function quicpro_webtransport_poll($wt, int $timeout_ms = -1): array|false
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /**
+     * Closes the session with an application code and reason (at most
+     * 1024 bytes) and resets its streams.
+     *
+     * @param resource $wt
+     */
+    function quicpro_webtransport_close($wt, int $code = 0, string $reason = ""): bool
+    {
+        // C-level implementation
+        return true;
+    }
+
+    /**
+     * Registers the handler for one MCP service method. The extension
+     * routes "/{service}/{method}" to it in quicpro_mcp_server_serve().
+     *
+     * With 'input' the body is decoded against that IIBIN schema; 'view'
+     * hands the handler a lazy IIBIN\View instead of an array. With
+     * 'output' the return value is encoded against that schema. Without
+     * schemas the handler gets the raw body and returns a string.
+     *
+     * Routes end with the request that registered them.
+     *
+     * @param callable(mixed): mixed $handler
+     * @param array{input?: string, output?: string, view?: bool} $options
+     */
+    function quicpro_mcp_server_register(string $service, string $method, callable $handler, array $options = []): bool
+    {
+        // C-level implementation
+        return true;
+    }
+
+    /**
+     * Reads the connection's HTTP/3 events and answers every MCP call that
+     * has arrived completely. Calls from the listener's stream callback.
+     *
+     * @param resource $session A server session from quicpro_http3_server_listen().
+     * @return int Calls answered.
+     */
+    function quicpro_mcp_server_serve($session): int
+    {
+        // C-level implementation
+        return 0;
+    }
+
+    /**
+     * Sets the RFC 9218 priority of one HTTP/3 stream: quiche sends the
+     * data of more urgent streams (lower urgency, 0 to 7) first, and
+     * shares the connection round robin among incremental streams of
+     * equal urgency. Replaces what the client's priority field asked for.
+     *
+     * @param resource $session
+     * @param string|int|array{urgency?: int, incremental?: bool} $priority
+     *        A field value ("u=1, i"), an urgency, or its parts.
+     * @return bool False if the stream is gone.
+     */
+    function quicpro_stream_set_priority($session, int $streamId, string|int|array $priority): bool
+    {
+        // C-level implementation
+        return true;
+    }
+
+    /**
+     * What closed connections measured on the path to `$ip`'s prefix
+     * (/24 or /56). New connections there start at this window instead
+     * of slow-starting.
+     *
+     * @return array{cwnd_packets: int, min_rtt_us: int, age_ms: int}|null
+     *         Null if nothing recent was learned.
+     */
+    function quicpro_cc_peer_estimate(string $ip): ?array
+    {
+        // C-level implementation
+        return null;
+    }
+
+    /**
+     * Queues a batch of QUIC datagrams (RFC 9221) and flushes the
+     * connection. Returns how many were queued; fewer than given only
+     * while the send queue stays full.
+     *
+     * @param resource $session
+     * @param list<string> $datagrams
+     */
+    function quicpro_datagram_send_batch($session, array $datagrams): int
+    {
+        // C-level implementation
+        return 0;
+    }
+
+    /**
+     * Like quicpro_datagram_send_batch() for a packed buffer: each record
+     * is a 16-bit big-endian length followed by the payload.
+     *
+     * @param resource $session
+     */
+    function quicpro_datagram_send_packed($session, string $packed): int
+    {
+        // C-level implementation
+        return 0;
+    }
+
+    /**
+     * Returns up to $max received datagrams (0: the configured queue
+     * length), waiting up to $timeout_ms for the first (-1: no limit).
+     *
+     * @param resource $session
+     * @return list<string>
+     */
+    function quicpro_datagram_recv_batch($session, int $max = 0, int $timeout_ms = 0): array
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /**
+     * Like quicpro_datagram_recv_batch(), but returns one string of packed
+     * records (16-bit big-endian length, then payload). "" if none arrived.
+     *
+     * @param resource $session
+     */
+    function quicpro_datagram_recv_packed($session, int $max = 0, int $timeout_ms = 0): string
+    {
+        // C-level implementation
+        return '';
+    }
+
+    /**
+     * Counters of the session's datagram FEC (blocks_sent, repairs_sent,
+     * repairs_dropped, repairs_received, recovered, unrecovered,
+     * malformed); null while quicpro.transport_dgram_fec_source_symbols
+     * is 0.
+     *
+     * @param resource $session
+     * @return array<string, int>|null
+     */
+    function quicpro_datagram_fec_stats($session): ?array
+    {
+        // C-level implementation
+        return null;
+    }
+
+    /**
+     * Starts or stops capturing a server connection's datagrams into this
+     * worker's capture ring. Its TLS secrets are only captured when this
+     * is called before its handshake completed; sampling
+     * (quicpro.transport_capture_sample_ratio) captures whole connections.
+     *
+     * @param resource $session A server session.
+     * @return bool False if quicpro.transport_capture_ring_bytes is 0.
+     */
+    function quicpro_capture_connection($session, bool $enable = true): bool
+    {
+        // C-level implementation
+        return false;
+    }
+
+    /**
+     * This worker's captured datagrams, with the TLS secrets of their
+     * connections, as pcapng that Wireshark opens and decrypts as it is.
+     * Written to `$path` if given.
+     *
+     * @return string|bool The capture ("" if there is none), or whether
+     *         it was written to `$path`.
+     */
+    function quicpro_capture_dump(?string $path = null): string|bool
+    {
+        // C-level implementation
+        return '';
+    }
+
+    /**
+     * Opens another path to the server over `$interface` (a second
+     * uplink, LTE next to Wi-Fi). Once validated it stands by; the
+     * connection moves to whichever path has the lowest min RTT divided
+     * by its weight, and off the active one as soon as it goes silent.
+     * quiche sends on one path at a time: paths fail over and compete,
+     * they do not add up.
+     *
+     * @param resource $session An established client session.
+     * @return int The path's index; the handshake's path is 0.
+     * @throws \Quicpro\Exception\QuicException If the server has
+     *         issued no spare connection ID.
+     */
+    function quicpro_client_session_add_path($session, string $interface, int $weight = 1): int
+    {
+        // C-level implementation
+        return 0;
+    }
+
+    /**
+     * @param resource $session
+     * @return list<array{index: int, interface: string, local: string,
+     *         state: string, active: bool, weight: int, rtt_us: int,
+     *         min_rtt_us: int, cwnd: int, sent: int, recv: int, lost: int,
+     *         delivery_rate: int}> State is 'probing', 'validated' or 'failed'.
+     */
+    function quicpro_client_session_paths($session): array
+    {
+        // C-level implementation
+        return [];
+    }
+
+    /**
+     * Counters of the XDP pre-filter (quicpro.security_xdp_filter_interface),
+     * summed over all CPUs since it was attached.
+     *
+     * @return array{passed: int, malformed: int, short_initial: int,
+     *         rate_limited: int, unknown_dcid: int, dcid_check: bool}|null
+     *         Null when no filter is attached.
+     */
+    function quicpro_xdp_filter_stats(): ?array
+    {
+        // C-level implementation
+        return null;
+    }
+
+    /**
+     * Bytes stream `$streamId` accepts right now, as the peer's
+     * flow-control window and the send buffer allow.
+     *
+     * @param resource $session
+     * @throws \Quicpro\Exception\QuicException If the stream takes no more data.
+     */
+    function quicpro_stream_capacity($session, int $streamId): int
+    {
+        // C-level implementation
+        return 0;
+    }
+
+    /**
+     * Queues as much of `$data` as the stream accepts: the body of an
+     * HTTP/3 stream, or raw stream data. Should nothing fit, waits up to
+     * `$timeout_ms` for the peer to grant more; inside a Fiber the fiber
+     * is parked meanwhile (see quicpro_scheduler_run()). Server sessions
+     * never wait. `$fin` finishes the stream once all of `$data` is taken.
+     *
+     * @param resource $session
+     * @return int Bytes taken; write the rest later. 0 on timeout.
+     */
+    function quicpro_stream_write($session, int $streamId, string $data, bool $fin = false, int $timeout_ms = -1): int
+    {
+        // C-level implementation
+        return 0;
+    }
+
+    /**
+     * A stream on a duplicate of the descriptor that becomes readable when
+     * the session has input, for EventLoop::onReadable() and friends. Call
+     * quicpro_session_process() when it is readable.
+     *
+     * @param resource $session A client session.
+     * @return resource|false
+     */
+    function quicpro_session_fd($session)
+    {
+        // C-level implementation
+        return false;
+    }
+
+    /**
+     * Seconds until the session's next timer (quiche's loss detection,
+     * idle and ACK timers, or the pacer), null if none is set. Re-read it
+     * after every quicpro_session_process().
+     *
+     * @param resource $session
+     */
+    function quicpro_session_timeout($session): ?float
+    {
+        // C-level implementation
+        return null;
+    }
+
+    /**
+     * Reads what arrived, fires a due timer and sends what is ready,
+     * without blocking.
+     *
+     * @param resource $session
+     * @return bool False once the connection is closed.
+     */
+    function quicpro_session_process($session): bool
+    {
+        // C-level implementation
+        return true;
+    }
+
+    /**
+     * quicpro_session_process() for every session of an array in one call.
+     *
+     * @param array<resource> $sessions
+     * @return array{timeout: ?float, closed: list<int|string>} The earliest
+     *         timeout of the sessions still open, and the keys of those that
+     *         are closed.
+     */
+    function quicpro_session_process_many(array $sessions): array
+    {
+        // C-level implementation
+        return ['timeout' => null, 'closed' => []];
+    }
+
+    /**
+     * A stream on a duplicate of the reactor's epoll descriptor. It is
+     * readable while any of its sessions has input or a deadline is due;
+     * then quicpro_reactor_run($reactor, 0) has work.
+     *
+     * @param resource $reactor
+     * @return resource|false
+     */
+    function quicpro_reactor_fd($reactor)
+    {
+        // C-level implementation
+        return false;
+    }
+}
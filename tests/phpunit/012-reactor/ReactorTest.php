@@ -0,0 +1,95 @@
+<?php
+declare(strict_types=1);
+
+namespace QuicPro\Tests\Reactor;
+
+use PHPUnit\Framework\TestCase;
+
+/*
+ * ─────────────────────────────────────────────────────────────────────────────
+ *  FILE: ReactorTest.php
+ *  SUITE: 012-reactor
+ *
+ *  WHY THIS TEST EXISTS
+ *  --------------------
+ *  • Workers holding many client sessions drive them through one reactor
+ *    instead of calling quicpro_poll() on every session each tick.
+ *  • The reactor must report only sessions that made progress, keep idle
+ *    sessions untouched, and drop sessions whose connection has closed.
+ *
+ *  COVERED REQUIREMENTS
+ *  --------------------
+ *      1. Sessions added to a reactor complete their handshake through
+ *         quicpro_reactor_run() alone.
+ *      2. An idle tick with no I/O and no due timer returns an empty list.
+ *      3. Closed sessions are detached after being reported.
+ *
+ *  TEST ENVIRONMENT CONTRACT
+ *  -------------------------
+ *      QUIC_DEMO_HOST  (default demo-quic)
+ *      QUIC_DEMO_PORT  (default 4433)
+ * ─────────────────────────────────────────────────────────────────────────────
+ */
+final class ReactorTest extends TestCase
+{
+    private string $host;
+    private int    $port;
+
+    protected function setUp(): void
+    {
+        $this->host = getenv('QUIC_DEMO_HOST') ?: 'demo-quic';
+        $this->port = (int)(getenv('QUIC_DEMO_PORT') ?: 4433);
+
+        if (!\function_exists('quicpro_reactor_new')) {
+            self::markTestSkipped('quicpro_async extension is not loaded');
+        }
+    }
+
+    /*
+     *  TEST 1 – Empty reactor honours the timeout
+     *  ------------------------------------------
+     */
+    public function testEmptyReactorReturnsNoSessions(): void
+    {
+        $reactor = quicpro_reactor_new();
+        $start   = microtime(true);
+
+        $this->assertSame([], quicpro_reactor_run($reactor, 20));
+        $this->assertGreaterThanOrEqual(0.015, microtime(true) - $start);
+    }
+
+    /*
+     *  TEST 2 – Many sessions driven by one reactor
+     *  --------------------------------------------
+     *  EXPECTATION:
+     *      • Every session is reported at least once while handshaking.
+     *      • After close, sessions disappear from the reactor.
+     */
+    public function testReactorDrivesSessionsUntilClosed(): void
+    {
+        $reactor  = quicpro_reactor_new();
+        $sessions = [];
+
+        for ($i = 0; $i < 8; ++$i) {
+            $sess = quicpro_connect($this->host, $this->port);
+            $this->assertTrue(quicpro_reactor_add($reactor, $sess), "Add $i failed");
+            $sessions[] = $sess;
+        }
+
+        $seen     = [];
+        $deadline = microtime(true) + 5.0;
+        while (count($seen) < count($sessions) && microtime(true) < $deadline) {
+            foreach (quicpro_reactor_run($reactor, 50) as $active) {
+                $seen[(int)$active] = true;
+            }
+        }
+        $this->assertCount(count($sessions), $seen);
+
+        foreach ($sessions as $sess) {
+            $this->assertTrue(quicpro_reactor_remove($reactor, $sess));
+            $this->assertFalse(quicpro_reactor_remove($reactor, $sess));
+            quicpro_close($sess);
+        }
+        $this->assertSame([], quicpro_reactor_run($reactor, 0));
+    }
+}
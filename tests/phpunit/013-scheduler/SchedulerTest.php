@@ -0,0 +1,101 @@
+<?php
+declare(strict_types=1);
+
+namespace QuicPro\Tests\Scheduler;
+
+use Fiber;
+use PHPUnit\Framework\TestCase;
+
+/*
+ * ─────────────────────────────────────────────────────────────────────────────
+ *  FILE: SchedulerTest.php
+ *  SUITE: 013-scheduler
+ *
+ *  WHY THIS TEST EXISTS
+ *  --------------------
+ *  • On PHP 8.1–8.3 quicpro_poll() used to spin inside a Fiber because the
+ *    extension could not suspend it. It now parks the Fiber in a native
+ *    scheduler that quicpro_scheduler_run() drives.
+ *
+ *  COVERED REQUIREMENTS
+ *  --------------------
+ *      1. Without parked fibers quicpro_scheduler_run() returns 0 at once.
+ *      2. quicpro_poll() inside a Fiber suspends it; the scheduler resumes
+ *         it and several sessions complete a request concurrently.
+ *
+ *  TEST ENVIRONMENT CONTRACT
+ *  -------------------------
+ *      QUIC_DEMO_HOST  (default demo-quic)
+ *      QUIC_DEMO_PORT  (default 4433)
+ * ─────────────────────────────────────────────────────────────────────────────
+ */
+final class SchedulerTest extends TestCase
+{
+    private string $host;
+    private int    $port;
+
+    protected function setUp(): void
+    {
+        $this->host = getenv('QUIC_DEMO_HOST') ?: 'demo-quic';
+        $this->port = (int)(getenv('QUIC_DEMO_PORT') ?: 4433);
+
+        if (!\function_exists('quicpro_scheduler_run')) {
+            self::markTestSkipped('quicpro_async extension is not loaded');
+        }
+    }
+
+    /*
+     *  TEST 1 – Idle scheduler
+     *  -----------------------
+     */
+    public function testIdleSchedulerReturnsImmediately(): void
+    {
+        $start = microtime(true);
+
+        $this->assertSame(0, quicpro_scheduler_run(500));
+        $this->assertLessThan(0.1, microtime(true) - $start);
+    }
+
+    /*
+     *  TEST 2 – Fibers parked in quicpro_poll()
+     *  ----------------------------------------
+     *  EXPECTATION:
+     *      • start() returns while the handshake is still pending, i.e.
+     *        the Fiber was suspended by the extension.
+     *      • Looping on quicpro_scheduler_run() finishes every Fiber.
+     */
+    public function testPollParksFiberUntilScheduled(): void
+    {
+        $fibers = [];
+        for ($i = 0; $i < 4; ++$i) {
+            $fibers[$i] = new Fiber(function (): bool {
+                $sess     = quicpro_connect($this->host, $this->port);
+                $deadline = microtime(true) + 5.0;
+
+                // Streams can only be opened once the handshake is confirmed
+                while (($stream = quicpro_send_request($sess, '/', [], '')) === false
+                       && microtime(true) < $deadline) {
+                    quicpro_poll($sess, 100);
+                }
+                $resp = false;
+                while ($stream !== false && !($resp = quicpro_receive_response($sess, $stream))
+                       && microtime(true) < $deadline) {
+                    quicpro_poll($sess, 100);
+                }
+                quicpro_close($sess);
+                return (bool)$resp;
+            });
+            $fibers[$i]->start();
+            $this->assertTrue($fibers[$i]->isSuspended(), "Fiber $i was not parked");
+        }
+
+        $deadline = microtime(true) + 10.0;
+        while (quicpro_scheduler_run(50) > 0 && microtime(true) < $deadline) {
+        }
+
+        foreach ($fibers as $i => $fiber) {
+            $this->assertTrue($fiber->isTerminated(), "Fiber $i still running");
+            $this->assertTrue($fiber->getReturn(), "Fiber $i got no response");
+        }
+    }
+}
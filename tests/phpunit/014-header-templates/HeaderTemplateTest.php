@@ -0,0 +1,77 @@
+<?php
+declare(strict_types=1);
+
+namespace QuicPro\Tests\HeaderTemplates;
+
+use InvalidArgumentException;
+use PHPUnit\Framework\TestCase;
+
+/*
+ * ─────────────────────────────────────────────────────────────────────────────
+ *  FILE: HeaderTemplateTest.php
+ *  SUITE: 014-header-templates
+ *
+ *  WHY THIS TEST EXISTS
+ *  --------------------
+ *  • Listeners send a registered template's headers straight from the bytes
+ *    prepared at registration, so validation happens there or not at all.
+ *
+ *  COVERED REQUIREMENTS
+ *  --------------------
+ *      1. A valid set of headers, including repeated ones, registers.
+ *      2. A name cannot be registered twice.
+ *      3. Header injection (CR/LF) and framing headers are refused.
+ * ─────────────────────────────────────────────────────────────────────────────
+ */
+final class HeaderTemplateTest extends TestCase
+{
+    protected function setUp(): void
+    {
+        if (!\function_exists('quicpro_header_template_register')) {
+            self::markTestSkipped('quicpro_async extension is not loaded');
+        }
+    }
+
+    /*
+     *  TEST 1 – Registration
+     *  ---------------------
+     */
+    public function testRegistersTemplate(): void
+    {
+        $name = 'api-' . bin2hex(random_bytes(4));
+        self::assertTrue(quicpro_header_template_register($name, [
+            'Content-Type'  => 'application/json',
+            'Cache-Control' => 'no-store',
+            'Vary'          => ['accept', 'origin'],
+        ]));
+    }
+
+    /*
+     *  TEST 2 – Templates are immutable
+     *  --------------------------------
+     */
+    public function testDuplicateNameThrows(): void
+    {
+        $name = 'dup-' . bin2hex(random_bytes(4));
+        quicpro_header_template_register($name, ['x-a' => '1']);
+
+        $this->expectException(InvalidArgumentException::class);
+        quicpro_header_template_register($name, ['x-a' => '2']);
+    }
+
+    /*
+     *  TEST 3 – Invalid headers
+     *  ------------------------
+     */
+    public function testHeaderInjectionThrows(): void
+    {
+        $this->expectException(InvalidArgumentException::class);
+        quicpro_header_template_register('bad-' . bin2hex(random_bytes(4)), ['x-a' => "1\r\nSet-Cookie: a=b"]);
+    }
+
+    public function testFramingHeaderThrows(): void
+    {
+        $this->expectException(InvalidArgumentException::class);
+        quicpro_header_template_register('bad-' . bin2hex(random_bytes(4)), ['Content-Length' => '10']);
+    }
+}
@@ -0,0 +1,97 @@
+<?php
+declare(strict_types=1);
+
+namespace QuicPro\Tests\Http3Batch;
+
+use PHPUnit\Framework\TestCase;
+
+/*
+ * ─────────────────────────────────────────────────────────────────────────────
+ *  FILE: BatchRequestTest.php
+ *  SUITE: 015-http3-batch
+ *
+ *  WHY THIS TEST EXISTS
+ *  --------------------
+ *  • quicpro_http3_batch_submit() puts many requests on one session. The
+ *    multiplexer opens their streams as the peer's limit allows and hands
+ *    back completions through quicpro_http3_batch_wait().
+ *
+ *  COVERED REQUIREMENTS
+ *  --------------------
+ *      1. Submitting returns one id per request, keyed like the input.
+ *      2. Every request completes exactly once. The batch is larger than
+ *         the usual initial stream limit, so queued requests must be
+ *         opened as earlier streams finish.
+ *      3. An idle session reports nothing pending and returns [] at once.
+ *
+ *  TEST ENVIRONMENT CONTRACT
+ *  -------------------------
+ *      QUIC_DEMO_HOST  (default demo-quic)
+ *      QUIC_DEMO_PORT  (default 4433)
+ * ─────────────────────────────────────────────────────────────────────────────
+ */
+final class BatchRequestTest extends TestCase
+{
+    private string $host;
+    private int    $port;
+
+    protected function setUp(): void
+    {
+        $this->host = getenv('QUIC_DEMO_HOST') ?: 'demo-quic';
+        $this->port = (int)(getenv('QUIC_DEMO_PORT') ?: 4433);
+
+        if (!\function_exists('quicpro_http3_batch_submit')) {
+            self::markTestSkipped('quicpro_async extension is not loaded');
+        }
+    }
+
+    /*
+     *  TEST 1 – Fan-out on one connection
+     *  ----------------------------------
+     */
+    public function testBatchCompletesEveryRequest(): void
+    {
+        $sess = quicpro_connect($this->host, $this->port);
+
+        $requests = [];
+        for ($i = 0; $i < 150; ++$i) {
+            $requests["r$i"] = ['path' => '/?n=' . $i];
+        }
+        $ids = quicpro_http3_batch_submit($sess, $requests);
+
+        $this->assertSame(array_keys($requests), array_keys($ids));
+        $this->assertCount(150, array_unique($ids));
+
+        $seen     = [];
+        $deadline = microtime(true) + 10.0;
+        while (quicpro_http3_batch_pending($sess) > 0 && microtime(true) < $deadline) {
+            foreach (quicpro_http3_batch_wait($sess, 500) as $done) {
+                $this->assertArrayNotHasKey('error', $done);
+                $this->assertSame(200, $done['status']);
+                $seen[$done['id']] = ($seen[$done['id']] ?? 0) + 1;
+            }
+        }
+
+        $this->assertSame(0, quicpro_http3_batch_pending($sess));
+        $this->assertCount(150, $seen);
+        $this->assertSame([1], array_values(array_unique($seen)));
+
+        quicpro_close($sess);
+    }
+
+    /*
+     *  TEST 2 – Nothing submitted
+     *  --------------------------
+     */
+    public function testWaitWithoutRequestsReturnsEmpty(): void
+    {
+        $sess  = quicpro_connect($this->host, $this->port);
+        $start = microtime(true);
+
+        $this->assertSame(0, quicpro_http3_batch_pending($sess));
+        $this->assertSame([], quicpro_http3_batch_wait($sess, 1000));
+        $this->assertLessThan(0.1, microtime(true) - $start);
+
+        quicpro_close($sess);
+    }
+}
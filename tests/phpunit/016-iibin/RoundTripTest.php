@@ -0,0 +1,275 @@
+<?php
+declare(strict_types=1);
+
+namespace QuicPro\Tests\Iibin;
+
+use PHPUnit\Framework\TestCase;
+use Quicpro\IIBIN;
+
+/*
+ * ─────────────────────────────────────────────────────────────────────────────
+ *  FILE: RoundTripTest.php
+ *  SUITE: 016-iibin
+ *
+ *  WHY THIS TEST EXISTS
+ *  --------------------
+ *  • Every schema is compiled into a flat instruction program when it is
+ *    defined. encode() and decode() interpret that program. This suite pins
+ *    the wire format the interpreters must keep producing.
+ *
+ *  COVERED REQUIREMENTS
+ *  --------------------
+ *      1. Scalars, strings, enums, packed runs and nested messages survive
+ *         encode → decode unchanged.
+ *      2. Encoding matches the protobuf wire format byte for byte,
+ *         including a nested body longer than 127 bytes.
+ *      3. Fields absent on the wire take their declared default.
+ *      4. Packed runs of every width decode in bulk to the same lists,
+ *         including runs long enough for the 16-byte varint fast path.
+ *      5. A view reads fields on demand, hands back the original bytes
+ *         untouched and re-encodes once a field is assigned.
+ *      6. Streaming into a PHP stream yields the bytes of encode(), and
+ *         writes nothing for data that does not fit the schema.
+ *      7. A columnar batch yields, row by row, what decode() returns for
+ *         each row, and is smaller than the rows encoded one by one.
+ *      8. A schema's descriptor defines nothing new where the schema exists,
+ *         keeps its ID, and is refused when the local definition differs.
+ *      9. Arena decoding returns what decode() returns, and writes to the
+ *         result leave the arena copy untouched.
+ * ─────────────────────────────────────────────────────────────────────────────
+ */
+final class RoundTripTest extends TestCase
+{
+    private static bool $defined = false;
+
+    protected function setUp(): void
+    {
+        if (!\class_exists(IIBIN::class)) {
+            self::markTestSkipped('quicpro_async extension is not loaded');
+        }
+        if (!self::$defined) {
+            IIBIN::defineEnum('RtColor', ['RED' => 0, 'GREEN' => 1, 'BLUE' => 2]);
+            IIBIN::defineSchema('RtPoint', [
+                'x'     => ['tag' => 1, 'type' => 'sint32'],
+                'label' => ['tag' => 2, 'type' => 'string'],
+            ]);
+            IIBIN::defineSchema('RtShape', [
+                'id'     => ['tag' => 1, 'type' => 'uint64', 'required' => true],
+                'color'  => ['tag' => 2, 'type' => 'RtColor'],
+                'scale'  => ['tag' => 3, 'type' => 'double'],
+                'levels' => ['tag' => 4, 'type' => 'repeated_int32'],
+                'origin' => ['tag' => 5, 'type' => 'RtPoint'],
+                'name'   => ['tag' => 6, 'type' => 'string', 'default' => 'unnamed'],
+            ]);
+            IIBIN::defineSchema('RtPacked', [
+                'small'   => ['tag' => 1, 'type' => 'repeated_uint32'],
+                'deltas'  => ['tag' => 2, 'type' => 'repeated_sint64'],
+                'vector'  => ['tag' => 3, 'type' => 'repeated_float'],
+                'weights' => ['tag' => 4, 'type' => 'repeated_double'],
+                'flags'   => ['tag' => 5, 'type' => 'repeated_bool'],
+            ]);
+            self::$defined = true;
+        }
+    }
+
+    /*
+     *  TEST 1 – Round trip
+     *  -------------------
+     */
+    public function testRoundTrip(): void
+    {
+        $in = [
+            'id'     => 42,
+            'color'  => 2,
+            'scale'  => 1.5,
+            'levels' => [1, 300, 7],
+            'origin' => ['x' => -3, 'label' => 'home'],
+            'name'   => 'square',
+        ];
+        $out = IIBIN::decode('RtShape', IIBIN::encode('RtShape', $in));
+
+        $this->assertSame($in, $out);
+    }
+
+    /*
+     *  TEST 2 – Wire format
+     *  --------------------
+     */
+    public function testWireBytes(): void
+    {
+        $bin = IIBIN::encode('RtPoint', ['x' => -3, 'label' => 'hi']);
+        $this->assertSame("\x08\x05\x12\x02hi", $bin);
+
+        $label = \str_repeat('a', 200);
+        $bin   = IIBIN::encode('RtShape', ['id' => 1, 'origin' => ['label' => $label]]);
+        $this->assertSame("\x08\x01\x2a\xcb\x01\x12\xc8\x01" . $label, $bin);
+    }
+
+    /*
+     *  TEST 3 – Defaults
+     *  -----------------
+     */
+    public function testDefaultsFillMissingFields(): void
+    {
+        $out = IIBIN::decode('RtShape', "\x08\x07");
+
+        $this->assertSame(7, $out['id']);
+        $this->assertSame('unnamed', $out['name']);
+    }
+
+    /*
+     *  TEST 4 – Packed runs
+     *  --------------------
+     */
+    public function testPackedRunsRoundTrip(): void
+    {
+        $in = [
+            'small'   => \array_merge(\range(0, 40), [127, 128, 300, 70000, 4000000000]),
+            'deltas'  => [0, -1, 1, -64, 64, PHP_INT_MIN, PHP_INT_MAX],
+            'vector'  => [0.5, -1.25, 3.0, 1024.0],
+            'weights' => [0.1, -2.5e300, 3.0],
+            'flags'   => [true, false, true],
+        ];
+        $bin = IIBIN::encode('RtPacked', $in);
+
+        $this->assertSame("\x0a\x36\x00", \substr($bin, 0, 3));
+        $this->assertSame($in, IIBIN::decode('RtPacked', $bin));
+    }
+
+    /*
+     *  TEST 5 – Lazy views
+     *  -------------------
+     */
+    public function testViewDecodesOnDemand(): void
+    {
+        $in  = ['id' => 9, 'color' => 1, 'origin' => ['x' => 4, 'label' => 'o']];
+        $bin = IIBIN::encode('RtShape', $in);
+
+        $view = IIBIN::decodeView('RtShape', $bin);
+        $this->assertTrue($view->has('origin'));
+        $this->assertFalse($view->has('scale'));
+        $this->assertSame(['x' => 4, 'label' => 'o'], $view['origin']);
+        $this->assertSame('unnamed', $view->get('name'));
+        $this->assertNull($view['scale']);
+        $this->assertSame(IIBIN::decode('RtShape', $bin), $view->toArray());
+        $this->assertSame($bin, $view->encode());
+
+        $view['name'] = 'renamed';
+        unset($view['origin']);
+        $this->assertSame(['id' => 9, 'color' => 1, 'name' => 'renamed'],
+                          IIBIN::decode('RtShape', $view->encode()));
+    }
+
+    /*
+     *  TEST 6 – Streaming encode
+     *  -------------------------
+     */
+    public function testEncodeToStreamMatchesEncode(): void
+    {
+        $in = [
+            'id'     => 3,
+            'levels' => \range(1, 500),
+            'origin' => ['x' => 1, 'label' => \str_repeat('b', 40000)],
+            'name'   => \str_repeat('n', 300),
+        ];
+        $stream  = \fopen('php://memory', 'w+b');
+        $written = IIBIN::encodeToStream('RtShape', $in, $stream);
+        \rewind($stream);
+
+        $this->assertSame(IIBIN::encode('RtShape', $in), \stream_get_contents($stream));
+        $this->assertSame(\strlen(IIBIN::encode('RtShape', $in)), $written);
+
+        $empty = \fopen('php://memory', 'w+b');
+        try {
+            IIBIN::encodeToStream('RtShape', ['id' => 1, 'origin' => ['x' => 'not an int']], $empty);
+            $this->fail('mistyped nested field was encoded');
+        } catch (\Throwable $e) {
+            $this->assertSame(0, \ftell($empty));
+        }
+    }
+
+    /*
+     *  TEST 7 – Columnar batches
+     *  -------------------------
+     */
+    public function testBatchRowsMatchDecode(): void
+    {
+        $rows = [];
+        for ($i = 0; $i < 200; $i++) {
+            $row = ['id' => 1000 + $i, 'color' => $i % 3, 'scale' => $i / 4];
+            if ($i % 7 === 0) {
+                $row['levels'] = [$i, -$i];
+                $row['origin'] = ['x' => -$i, 'label' => 'p' . ($i % 2)];
+            }
+            if ($i % 5 === 0) {
+                $row['name'] = 'n' . ($i % 10);
+            }
+            $rows[] = $row;
+        }
+        $batch = IIBIN::encodeBatch('RtShape', $rows);
+        $each  = \array_sum(\array_map(fn ($r) => \strlen(IIBIN::encode('RtShape', $r)), $rows));
+        $this->assertLessThan($each, \strlen($batch));
+
+        $decoded = IIBIN::decodeBatch('RtShape', $batch);
+        $this->assertCount(200, $decoded);
+        foreach ($decoded as $i => $row) {
+            $this->assertSame(IIBIN::decode('RtShape', IIBIN::encode('RtShape', $rows[$i])), $row);
+        }
+        $this->assertSame(\range(1000, 1199), $decoded->column('id'));
+        $this->assertSame($decoded[14], $decoded->toArray()[14]);
+
+        $this->expectException(\Throwable::class);
+        IIBIN::encodeBatch('RtShape', [['id' => 1], ['color' => 1]]);
+    }
+
+    /*
+     *  TEST 8 – Schema descriptors
+     *  ---------------------------
+     */
+    public function testDescriptorNamesTheSameSchema(): void
+    {
+        $id = IIBIN::schemaId('RtShape');
+        $this->assertGreaterThan(0, $id);
+        $this->assertNotSame($id, IIBIN::schemaId('RtPoint'));
+        $this->assertSame('RtShape', IIBIN::schemaNameById($id));
+
+        $descriptor = IIBIN::schemaDescriptor('RtShape');
+        $this->assertSame('RtShape', IIBIN::defineFromDescriptor($descriptor));
+        $this->assertSame($id, IIBIN::schemaId('RtShape'));
+
+        /* A peer whose RtShape points at another point schema: that one is defined, RtShape is refused */
+        $this->expectException(\Throwable::class);
+        try {
+            IIBIN::defineFromDescriptor(\str_replace('RtPoint', 'RtPoinT', $descriptor));
+        } finally {
+            $this->assertTrue(IIBIN::isSchemaDefined('RtPoinT'));
+        }
+    }
+
+    /*
+     *  TEST 9 – Arena decoding
+     *  -----------------------
+     */
+    public function testArenaDecodeMatchesDecode(): void
+    {
+        $shape = [
+            'id'     => 9,
+            'levels' => \range(1, 50),
+            'origin' => ['x' => -4, 'label' => \str_repeat('long label ', 8)],
+            'name'   => 'arena',
+        ];
+        $bytes  = IIBIN::encode('RtShape', $shape);
+        $frozen = IIBIN::decode('RtShape', $bytes, false, true);
+        $this->assertSame(IIBIN::decode('RtShape', $bytes), $frozen);
+
+        /* Writes separate a private copy; the next decode is unaffected */
+        $copy = $frozen;
+        $copy['origin']['label'] = 'changed';
+        $copy['levels'][] = 51;
+        $this->assertSame(\str_repeat('long label ', 8), $frozen['origin']['label']);
+        $this->assertCount(50, IIBIN::decode('RtShape', $bytes, false, true)['levels']);
+
+        $this->expectException(\Throwable::class);
+        IIBIN::decode('RtShape', $bytes, true, true);
+    }
+}
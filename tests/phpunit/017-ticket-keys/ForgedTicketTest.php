@@ -0,0 +1,167 @@
+<?php
+declare(strict_types=1);
+
+namespace QuicPro\Tests\TicketKeys;
+
+use PHPUnit\Framework\TestCase;
+
+/*
+ * ─────────────────────────────────────────────────────────────────────────────
+ *  FILE: ForgedTicketTest.php
+ *  SUITE: 017-ticket-keys
+ *
+ *  WHY THIS TEST EXISTS
+ *  --------------------
+ *  • The TCP listeners decrypt session tickets with the shared key ring
+ *    (server/ticket_keys.h). A ring slot left as zeroed memory would let
+ *    anyone mint a ticket under an all-zero key name with all-zero AES and
+ *    HMAC keys, and resume a session of their choosing.
+ *
+ *  COVERED REQUIREMENTS
+ *  --------------------
+ *      1. A genuine ticket resumes (proves the listener resumes at all).
+ *      2. The same session, re-encrypted as a ticket under an all-zero key
+ *         name and all-zero keys, does not resume.
+ *
+ *  TEST ENVIRONMENT CONTRACT
+ *  -------------------------
+ *  A quicpro HTTP/1 or HTTP/2 TLS listener, started fresh so that its key
+ *  ring has not rotated yet, and the openssl command-line tool.
+ *
+ *      QUICPRO_TLS_TCP_HOST  (required; the test is skipped without it)
+ *      QUICPRO_TLS_TCP_PORT  (default 8443)
+ * ─────────────────────────────────────────────────────────────────────────────
+ */
+final class ForgedTicketTest extends TestCase
+{
+    private string $host;
+    private int    $port;
+    private string $dir;
+
+    protected function setUp(): void
+    {
+        $this->host = (string) getenv('QUICPRO_TLS_TCP_HOST');
+        $this->port = (int) (getenv('QUICPRO_TLS_TCP_PORT') ?: 8443);
+
+        if ($this->host === '') {
+            self::markTestSkipped('QUICPRO_TLS_TCP_HOST is not set');
+        }
+        if (trim((string) shell_exec('command -v openssl')) === '') {
+            self::markTestSkipped('openssl command-line tool not found');
+        }
+        $this->dir = sys_get_temp_dir() . '/qp-ticket-' . bin2hex(random_bytes(4));
+        mkdir($this->dir);
+    }
+
+    protected function tearDown(): void
+    {
+        if (isset($this->dir)) {
+            array_map('unlink', glob($this->dir . '/*') ?: []);
+            @rmdir($this->dir);
+        }
+    }
+
+    /*
+     *  TEST 1 – Genuine tickets resume, zero-key tickets do not
+     *  --------------------------------------------------------
+     */
+    public function testZeroKeyNameTicketIsRejected(): void
+    {
+        $genuine = $this->dir . '/genuine.pem';
+        $this->handshake(['-sess_out', $genuine]);
+        self::assertFileExists($genuine);
+        self::assertStringContainsString('Reused', $this->handshake(['-sess_in', $genuine]));
+
+        $forged = $this->dir . '/forged.pem';
+        file_put_contents($forged, $this->forge((string) file_get_contents($genuine)));
+        $out = $this->handshake(['-sess_in', $forged]);
+
+        self::assertStringContainsString('New,', $out);
+        self::assertStringNotContainsString('Reused', $out);
+    }
+
+    /** Runs one TLS 1.2 handshake (tickets are sent in the ClientHello) and returns s_client's report. */
+    private function handshake(array $args): string
+    {
+        $cmd = array_merge(
+            ['openssl', 's_client', '-connect', $this->host . ':' . $this->port, '-tls1_2', '-no_ign_eof'],
+            $args
+        );
+        return (string) shell_exec(implode(' ', array_map('escapeshellarg', $cmd)) . ' </dev/null 2>&1');
+    }
+
+    /**
+     * Re-encrypts a client's SSL_SESSION as a ticket under key name 0^16,
+     * AES-256-CBC key 0^32 and HMAC-SHA256 key 0^32, and puts it back in
+     * place of the server's ticket ([10] tlsext_tick).
+     */
+    private function forge(string $pem): string
+    {
+        $der = base64_decode(preg_replace('/-----[^-]+-----|\s+/', '', $pem), true);
+        self::assertNotFalse($der);
+
+        [$tag, $body] = self::tlv($der, 0);
+        self::assertSame(0x30, $tag);
+
+        $fields = [];
+        for ($off = 0; $off < strlen($body);) {
+            $start = $off;
+            [$tag, , $off] = self::tlv($body, $off);
+            $fields[] = [$tag, substr($body, $start, $off - $start)];
+        }
+
+        $plain = '';
+        foreach ($fields as [$tag, $raw]) {
+            if ($tag !== 0xAA) {
+                $plain .= $raw;
+            }
+        }
+        $plain = self::der(0x30, $plain);
+
+        $name = str_repeat("\0", 16);
+        $iv = random_bytes(16);
+        $ct = openssl_encrypt($plain, 'aes-256-cbc', str_repeat("\0", 32), OPENSSL_RAW_DATA, $iv);
+        $ticket = $name . $iv . $ct;
+        $ticket .= hash_hmac('sha256', $ticket, str_repeat("\0", 32), true);
+
+        $out = '';
+        $placed = false;
+        foreach ($fields as [$tag, $raw]) {
+            if ($tag === 0xAA) {
+                $raw = self::der(0xAA, self::der(0x04, $ticket));
+                $placed = true;
+            }
+            $out .= $raw;
+        }
+        self::assertTrue($placed, 'the listener issued no session ticket');
+
+        return "-----BEGIN SSL SESSION PARAMETERS-----\n"
+            . chunk_split(base64_encode(self::der(0x30, $out)), 64, "\n")
+            . "-----END SSL SESSION PARAMETERS-----\n";
+    }
+
+    /** @return array{int, string, int} tag, contents, offset past the element */
+    private static function tlv(string $buf, int $off): array
+    {
+        $tag = ord($buf[$off++]);
+        $len = ord($buf[$off++]);
+        if ($len & 0x80) {
+            $n = $len & 0x7F;
+            $len = 0;
+            for ($i = 0; $i < $n; $i++) {
+                $len = ($len << 8) | ord($buf[$off++]);
+            }
+        }
+        return [$tag, substr($buf, $off, $len), $off + $len];
+    }
+
+    private static function der(int $tag, string $contents): string
+    {
+        $len = strlen($contents);
+        if ($len < 0x80) {
+            return chr($tag) . chr($len) . $contents;
+        }
+        $bytes = ltrim(pack('N', $len), "\0");
+        return chr($tag) . chr(0x80 | strlen($bytes)) . $bytes . $contents;
+    }
+}